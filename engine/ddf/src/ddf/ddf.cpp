@@ -86,7 +86,7 @@ namespace dmDDF
         assert(desc);
 
         // Calculate number of entries in arrays, ie memory requirements for the entire message
-        uint32_t start = ib->Tell();
+        uint32_t array_counts = load_context->AddArrayCounts(desc->m_FieldCount);
         while (!ib->Eof())
         {
             uint32_t tag;
@@ -98,7 +98,8 @@ namespace dmDDF
                 if (key == 0)
                     return RESULT_WIRE_FORMAT_ERROR;
 
-                const FieldDescriptor* field = FindField(desc, key, 0);
+                uint32_t field_index;
+                const FieldDescriptor* field = FindField(desc, key, &field_index);
 
                 if (field == 0)
                 {
@@ -110,7 +111,7 @@ namespace dmDDF
                 {
                     if (field->m_Label == LABEL_REPEATED)
                     {
-                        load_context->IncreaseArrayCount(start, field->m_Number);
+                        load_context->IncreaseArrayCount(array_counts, field_index);
                     }
 
                     if (field->m_Type != TYPE_MESSAGE)
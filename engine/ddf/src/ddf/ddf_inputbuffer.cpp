@@ -272,8 +272,7 @@ namespace dmDDF
         return InputBuffer(c, length);
     #else
         InputBuffer ret = InputBuffer(m_Start, m_End - m_Start);
-        // NOTE: Very important to preserve start. Tell() is used to
-        // uniquely identify repeated fields. See function DDFCalculateRepeated(.)
+        // NOTE: Preserves the start, so that Tell() is relative to the whole buffer
         ret.m_Start = m_Start;
         ret.m_Current = m_Current;
         ret.m_End = m_Current + length;
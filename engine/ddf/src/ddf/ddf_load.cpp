@@ -127,14 +127,14 @@ namespace dmDDF
         uint8_t read_fields[DDF_MAX_FIELDS];
         memset(read_fields, 0, sizeof(read_fields));
 
+        // The messages are visited in the same order as when the repeated fields were counted
+        uint32_t array_counts = load_context->NextArrayCounts(desc->m_FieldCount);
         for (int i = 0; i < desc->m_FieldCount; ++i)
         {
             const FieldDescriptor* f = &desc->m_Fields[i];
             if (f->m_Label == LABEL_REPEATED)
             {
-                // TODO: Verify buffer_pos!!!! Correct to use Tell()?
-                uint32_t buffer_pos = input_buffer->Tell();
-                message->AllocateRepeatedBuffer(load_context, f, load_context->GetArrayCount(buffer_pos, f->m_Number));
+                message->AllocateRepeatedBuffer(load_context, f, load_context->GetArrayCount(array_counts, i));
             }
         }
 
@@ -14,7 +14,7 @@
 
 #include <string.h>
 #include <dlib/align.h>
-#include <dlib/hash.h>
+#include <dlib/math.h>
 #include "ddf_loadcontext.h"
 #include "ddf_util.h"
 
@@ -31,7 +31,7 @@ namespace dmDDF
         {
             memset(buffer, 0, buffer_size);
         }
-        m_ArrayCount.SetCapacity(2048, 2048);
+        m_ArrayCountCursor = 0;
     }
 
     Message LoadContext::AllocMessage(const Descriptor* desc)
@@ -103,6 +103,7 @@ namespace dmDDF
         m_Current = (uintptr_t)buffer;
         m_End = (uintptr_t)buffer + buffer_size;
         m_DryRun = dry_run;
+        m_ArrayCountCursor = 0;
         if (!dry_run)
         {
             memset(buffer, 0, buffer_size);
@@ -114,27 +115,32 @@ namespace dmDDF
         return (int) (m_Current - m_Start);
     }
 
-    void LoadContext::IncreaseArrayCount(uint32_t buffer_pos, uint32_t field_number)
+    uint32_t LoadContext::AddArrayCounts(uint32_t field_count)
     {
-        uint32_t key[] = {field_number, buffer_pos};
-        uint32_t hash = dmHashBufferNoReverse32((void*)key, sizeof(key));
-        if(m_ArrayCount.Full())
-            m_ArrayCount.SetCapacity(2048, m_ArrayCount.Capacity() + 1024);
-        uint32_t* value_p = m_ArrayCount.Get(hash);
-        if(value_p) {
-            (*value_p)++;
-        }
-        else {
-            m_ArrayCount.Put(hash, 1);
-        }
+        uint32_t base = m_ArrayCounts.Size();
+        if (m_ArrayCounts.Remaining() < field_count)
+            m_ArrayCounts.OffsetCapacity(dmMath::Max(field_count, dmMath::Max(m_ArrayCounts.Capacity(), 64U)));
+        m_ArrayCounts.SetSize(base + field_count);
+        memset(m_ArrayCounts.Begin() + base, 0, field_count * sizeof(uint32_t));
+        return base;
     }
 
-    uint32_t LoadContext::GetArrayCount(uint32_t buffer_pos, uint32_t field_number)
+    void LoadContext::IncreaseArrayCount(uint32_t base, uint32_t field_index)
     {
-        uint32_t key[] = {field_number, buffer_pos};
-        uint32_t hash = dmHashBufferNoReverse32((void*)key, sizeof(key));
-        uint32_t *value_p = m_ArrayCount.Get(hash);
-        return value_p == 0 ? 0 : *value_p;
+        m_ArrayCounts[base + field_index]++;
     }
-}
 
+    uint32_t LoadContext::NextArrayCounts(uint32_t field_count)
+    {
+        uint32_t base = m_ArrayCountCursor;
+        m_ArrayCountCursor += field_count;
+        assert(m_ArrayCountCursor <= m_ArrayCounts.Size());
+        return base;
+    }
+
+    uint32_t LoadContext::GetArrayCount(uint32_t base, uint32_t field_index)
+    {
+        uint32_t index = base + field_index;
+        return index < m_ArrayCounts.Size() ? m_ArrayCounts[index] : 0;
+    }
+}
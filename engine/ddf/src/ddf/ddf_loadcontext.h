@@ -16,7 +16,7 @@
 #define DDF_LOADCONTEXT_H
 
 #include <stdint.h>
-#include <dlib/hashtable.h>
+#include <dlib/array.h>
 #include "ddf.h"
 #include "ddf_message.h"
 
@@ -38,8 +38,12 @@ namespace dmDDF
         void        SetMemoryBuffer(char* buffer, int buffer_size, bool dry_run);
         int         GetMemoryUsage();
 
-        void        IncreaseArrayCount(uint32_t buffer_pos, uint32_t field_number);
-        uint32_t    GetArrayCount(uint32_t buffer_pos, uint32_t field_number);
+        // The number of elements of the repeated fields are counted before the message is loaded. The counts are stored
+        // per message in the order the messages are visited, so that the load passes can read them in the same order
+        uint32_t    AddArrayCounts(uint32_t field_count);
+        void        IncreaseArrayCount(uint32_t base, uint32_t field_index);
+        uint32_t    NextArrayCounts(uint32_t field_count);
+        uint32_t    GetArrayCount(uint32_t base, uint32_t field_index);
 
         inline uint32_t GetOptions()
         {
@@ -47,7 +51,8 @@ namespace dmDDF
         }
 
     private:
-        dmHashTable32<uint32_t> m_ArrayCount;
+        dmArray<uint32_t> m_ArrayCounts;
+        uint32_t    m_ArrayCountCursor;
 
         uintptr_t   m_Start;
         uintptr_t   m_End;
@@ -513,6 +513,148 @@ TEST(NestedArray, Load)
     dmDDF::FreeMessage(message);
 }
 
+// The element counts of the repeated fields are counted per message, in the order the messages are visited.
+// The loaded messages are compared to the protobuf messages they were encoded from, like all the other tests
+static void FillNestedRepeatedSub(TestDDF::NestedRepeatedSub* sub, uint32_t value_count, uint32_t sub_count, uint32_t name_count, uint32_t seed)
+{
+    for (uint32_t i = 0; i < value_count; ++i)
+    {
+        sub->add_values(seed * 100 + i);
+    }
+    for (uint32_t i = 0; i < sub_count; ++i)
+    {
+        TestDDF::NestedArraySub1* sub1 = sub->add_subs();
+        sub1->set_b(seed + i);
+        sub1->set_c(seed + i + 1);
+        // Every other one is empty
+        for (uint32_t j = 0; j < (i % 2) * (seed % 3 + 1); ++j)
+        {
+            sub1->add_array2()->set_a(seed * 10 + j);
+        }
+    }
+    for (uint32_t i = 0; i < name_count; ++i)
+    {
+        char tmp[32];
+        dmSnPrintf(tmp, sizeof(tmp), "name_%u_%u", seed, i);
+        sub->add_names(tmp);
+    }
+}
+
+static void AssertNestedRepeatedSub(const TestDDF::NestedRepeatedSub& pb_sub, const DUMMY::TestDDF::NestedRepeatedSub& sub)
+{
+    ASSERT_EQ((uint32_t) pb_sub.values_size(), sub.m_Values.m_Count);
+    for (int i = 0; i < pb_sub.values_size(); ++i)
+    {
+        ASSERT_EQ(pb_sub.values(i), sub.m_Values.m_Data[i]);
+    }
+
+    ASSERT_EQ((uint32_t) pb_sub.subs_size(), sub.m_Subs.m_Count);
+    for (int i = 0; i < pb_sub.subs_size(); ++i)
+    {
+        const TestDDF::NestedArraySub1& pb_sub1 = pb_sub.subs(i);
+        const DUMMY::TestDDF::NestedArraySub1& sub1 = sub.m_Subs.m_Data[i];
+        ASSERT_EQ(pb_sub1.b(), sub1.m_B);
+        ASSERT_EQ(pb_sub1.c(), sub1.m_C);
+        ASSERT_EQ((uint32_t) pb_sub1.array2_size(), sub1.m_Array2.m_Count);
+        for (int j = 0; j < pb_sub1.array2_size(); ++j)
+        {
+            ASSERT_EQ(pb_sub1.array2(j).a(), sub1.m_Array2.m_Data[j].m_A);
+        }
+    }
+
+    ASSERT_EQ((uint32_t) pb_sub.names_size(), sub.m_Names.m_Count);
+    for (int i = 0; i < pb_sub.names_size(); ++i)
+    {
+        ASSERT_STREQ(pb_sub.names(i).c_str(), sub.m_Names.m_Data[i]);
+    }
+}
+
+static void AssertNestedRepeatedLoad(const TestDDF::NestedRepeated& pb_nested)
+{
+    std::string pb_msg_str = pb_nested.SerializeAsString();
+    void* message;
+
+    dmDDF::Result e = dmDDF::LoadMessage((void*) pb_msg_str.c_str(), pb_msg_str.size(), &DUMMY::TestDDF_NestedRepeated_DESCRIPTOR, &message);
+    ASSERT_EQ(dmDDF::RESULT_OK, e);
+    DUMMY::TestDDF::NestedRepeated* nested = (DUMMY::TestDDF::NestedRepeated*) message;
+
+    AssertNestedRepeatedSub(pb_nested.first(), nested->m_First);
+    ASSERT_EQ((uint32_t) pb_nested.array_size(), nested->m_Array.m_Count);
+    for (int i = 0; i < pb_nested.array_size(); ++i)
+    {
+        AssertNestedRepeatedSub(pb_nested.array(i), nested->m_Array.m_Data[i]);
+    }
+    AssertNestedRepeatedSub(pb_nested.last(), nested->m_Last);
+    ASSERT_EQ((uint32_t) pb_nested.counts_size(), nested->m_Counts.m_Count);
+    for (int i = 0; i < pb_nested.counts_size(); ++i)
+    {
+        ASSERT_EQ(pb_nested.counts(i), nested->m_Counts.m_Data[i]);
+    }
+
+    std::string msg_str2;
+    e = DDFSaveToString(message, &DUMMY::TestDDF_NestedRepeated_DESCRIPTOR, msg_str2);
+    ASSERT_EQ(dmDDF::RESULT_OK, e);
+    ASSERT_EQ(pb_msg_str, msg_str2);
+
+    dmDDF::FreeMessage(message);
+}
+
+TEST(NestedRepeated, Load)
+{
+    TestDDF::NestedRepeated pb_nested;
+    FillNestedRepeatedSub(pb_nested.mutable_first(), 3, 4, 2, 1);
+    // Different counts in each element, so that the counts of one element can't be used for another
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        FillNestedRepeatedSub(pb_nested.add_array(), i % 4, (i * 5) % 7, i % 3, i + 2);
+    }
+    FillNestedRepeatedSub(pb_nested.mutable_last(), 1, 3, 5, 9);
+    pb_nested.add_counts(7);
+    pb_nested.add_counts(8);
+
+    AssertNestedRepeatedLoad(pb_nested);
+}
+
+TEST(NestedRepeated, EmptyRepeated)
+{
+    // No repeated fields at all
+    TestDDF::NestedRepeated pb_empty;
+    pb_empty.mutable_first();
+    pb_empty.mutable_last();
+    AssertNestedRepeatedLoad(pb_empty);
+
+    // Empty messages between the ones with repeated fields, and empty repeated fields before and after the ones that aren't
+    TestDDF::NestedRepeated pb_nested;
+    FillNestedRepeatedSub(pb_nested.mutable_first(), 0, 0, 0, 1);
+    FillNestedRepeatedSub(pb_nested.add_array(), 0, 0, 0, 2);
+    FillNestedRepeatedSub(pb_nested.add_array(), 2, 0, 0, 3);
+    FillNestedRepeatedSub(pb_nested.add_array(), 0, 0, 0, 4);
+    FillNestedRepeatedSub(pb_nested.add_array(), 0, 3, 0, 5);
+    FillNestedRepeatedSub(pb_nested.add_array(), 0, 0, 2, 6);
+    FillNestedRepeatedSub(pb_nested.add_array(), 0, 0, 0, 7);
+    FillNestedRepeatedSub(pb_nested.mutable_last(), 0, 0, 0, 8);
+
+    AssertNestedRepeatedLoad(pb_nested);
+}
+
+TEST(NestedRepeated, ManyMessages)
+{
+    // More messages than fit in the initial count storage
+    TestDDF::NestedRepeated pb_nested;
+    FillNestedRepeatedSub(pb_nested.mutable_first(), 1, 1, 1, 1);
+    for (uint32_t i = 0; i < 300; ++i)
+    {
+        FillNestedRepeatedSub(pb_nested.add_array(), i % 5, i % 4, i % 2, i);
+    }
+    FillNestedRepeatedSub(pb_nested.mutable_last(), 2, 2, 2, 2);
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        pb_nested.add_counts(i);
+    }
+
+    AssertNestedRepeatedLoad(pb_nested);
+}
+
 TEST(Bytes, Load)
 {
     TestDDF::Bytes bytes;
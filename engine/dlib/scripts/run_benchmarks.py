@@ -0,0 +1,90 @@
+#! /usr/bin/env python
+# Copyright 2020-2024 The Defold Foundation
+# Copyright 2014-2020 King
+# Copyright 2009-2014 Ragnar Svensson, Christian Murray
+# Licensed under the Defold License version 1.0 (the "License"); you may not use
+# this file except in compliance with the License.
+#
+# You may obtain a copy of the License, together with FAQs at
+# https://www.defold.com/license
+#
+# Unless required by applicable law or agreed to in writing, software distributed
+# under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied. See the License for the
+# specific language governing permissions and limitations under the License.
+
+"""Run the engine microbenchmarks and merge their results into one JSON file
+
+The bench_* programs are built together with the unit tests of each module (but not run by them).
+Each program is run from its module directory, since the benchmarks load content relative to it.
+
+Synopsis:
+    python run_benchmarks.py [--output results.json] [--engine path/to/engine] [module ...]
+
+Options:
+    output  The merged JSON file, benchmarks.json by default
+    engine  The engine source directory, defaults to the parent of the dlib directory
+    module  Only run the benchmarks for the given modules (e.g. dlib gameobject)
+"""
+
+import sys, os, json, argparse, subprocess, tempfile, platform
+
+BENCHMARKS = [
+    ('dlib',       'build/src/test/bench_dlib'),
+    ('gameobject', 'build/src/gameobject/test/bench_gameobject'),
+    ('render',     'build/src/test/bench_render'),
+    ('particle',   'build/src/test/bench_particle'),
+    ('sound',      'build/src/test/bench_sound'),
+    ('resource',   'build/src/test/bench_resource'),
+    ('gamesys',    'build/src/gamesys/test/bench_gamesys'),
+]
+
+def run(engine, module, program):
+    cwd = os.path.join(engine, module)
+    exe = os.path.join(cwd, program)
+    if sys.platform == 'win32':
+        exe += '.exe'
+    if not os.path.exists(exe):
+        print("Skipping %s: %s not found" % (module, exe))
+        return True, None
+
+    fd, path = tempfile.mkstemp(suffix='.json')
+    os.close(fd)
+    try:
+        print("Running %s" % exe)
+        ret = subprocess.call([exe, '--benchmark-output=%s' % path], cwd=cwd)
+        if ret != 0:
+            print("%s failed with exit code %d" % (exe, ret))
+            return False, None
+        with open(path) as f:
+            return True, json.load(f)
+    finally:
+        os.remove(path)
+
+def main():
+    default_engine = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..'))
+
+    parser = argparse.ArgumentParser(description='Run the engine microbenchmarks')
+    parser.add_argument('--output', default='benchmarks.json', help='Merged JSON output file')
+    parser.add_argument('--engine', default=default_engine, help='Engine source directory')
+    parser.add_argument('modules', nargs='*', help='Only run these modules')
+    args = parser.parse_args()
+
+    suites = []
+    failed = False
+    for module, program in BENCHMARKS:
+        if args.modules and module not in args.modules:
+            continue
+        ok, result = run(args.engine, module, program)
+        if not ok:
+            failed = True
+        elif result is not None:
+            suites.append(result)
+
+    with open(args.output, 'w') as f:
+        json.dump({'platform': platform.platform(), 'suites': suites}, f, indent=2)
+    print("Wrote %d suites to %s" % (len(suites), args.output))
+    return 1 if failed else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
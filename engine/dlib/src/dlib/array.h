@@ -17,4 +17,74 @@
 
 #include <dmsdk/dlib/array.h>
 
+/**
+ * Array with inline storage for the first N elements, for small arrays that would otherwise
+ * need a heap allocation each (e.g. per component). When the array outgrows the inline storage,
+ * the elements are moved to an auto-allocated storage, and it behaves like a regular dmArray.
+ * Note that the capacity is never less than N, and that the array must not be grown through a
+ * dmArray<T> reference while it uses the inline storage.
+ */
+template <typename T, uint32_t N>
+class dmArraySmall : public dmArray<T>
+{
+public:
+    dmArraySmall()
+    : dmArray<T>(m_Storage, 0, N)
+    {
+    }
+
+    void SetCapacity(uint32_t capacity)
+    {
+        if (!IsInline())
+        {
+            dmArray<T>::SetCapacity(capacity);
+            return;
+        }
+        if (capacity <= N)
+        {
+            if (capacity < dmArray<T>::Size())
+                dmArray<T>::SetSize(capacity);
+            return;
+        }
+
+        // The same allocation as dmArrayUtil::SetCapacity, as it's freed by the dmArray
+        uint32_t size = dmArray<T>::Size();
+        T* storage = (T*) new uint8_t[capacity * sizeof(T)];
+        memcpy(storage, m_Storage, size * sizeof(T));
+        dmArray<T>::Set(storage, size, capacity, false);
+    }
+
+    void OffsetCapacity(int32_t offset)
+    {
+        SetCapacity((uint32_t)((int32_t)dmArray<T>::Capacity() + offset));
+    }
+
+    void PushGrow(const T& element)
+    {
+        if (dmArray<T>::Full())
+        {
+            T tmp = element;
+            uint32_t capacity = dmArray<T>::Capacity();
+            SetCapacity(capacity + (capacity / 2 > 8 ? capacity / 2 : 8));
+            dmArray<T>::Push(tmp);
+            return;
+        }
+        dmArray<T>::Push(element);
+    }
+
+    // True while the elements are in the inline storage
+    bool IsInline() const
+    {
+        return dmArray<T>::Begin() == m_Storage;
+    }
+
+private:
+    T m_Storage[N];
+
+    // The inline storage can't be swapped or copied
+    void Swap(dmArray<T>& rhs);
+    dmArraySmall(const dmArraySmall<T, N>&);
+    void operator =(const dmArraySmall<T, N>&);
+};
+
 #endif // DM_ARRAY_H
@@ -0,0 +1,182 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_BENCHMARK_H
+#define DM_BENCHMARK_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include <dlib/array.h>
+#include <dlib/time.h>
+
+/**
+ * Minimal microbenchmark harness used by the bench_* programs.
+ *
+ * A benchmark is a loop over samples, where each sample is timed separately.
+ * The first sample is treated as warmup and is not recorded:
+ *
+ *   for (dmBenchmark::Run run("gameobject.spawn_delete", 20, 1000); run.Next(); )
+ *   {
+ *       // spawn and delete 1000 instances
+ *   }
+ *
+ * Results are collected during the run and written as JSON by Report(), either to
+ * stdout or to the file given with "--benchmark-output=<path>" (or the
+ * DM_BENCHMARK_OUTPUT environment variable).
+ */
+namespace dmBenchmark
+{
+    struct Result
+    {
+        char     m_Name[64];
+        uint32_t m_Samples;
+        uint32_t m_ItemsPerSample;
+        uint64_t m_MinUs;
+        uint64_t m_MedianUs;
+        uint64_t m_MeanUs;
+        uint64_t m_MaxUs;
+    };
+
+    inline dmArray<Result>& GetResults()
+    {
+        static dmArray<Result> results;
+        return results;
+    }
+
+    class Run
+    {
+    public:
+        /**
+         * @param name Benchmark name, e.g. "message.post_dispatch"
+         * @param samples Number of timed samples (excluding warmup)
+         * @param items_per_sample Number of operations performed per sample, used to report time per item
+         */
+        Run(const char* name, uint32_t samples, uint32_t items_per_sample)
+        : m_Name(name)
+        , m_Samples(samples)
+        , m_ItemsPerSample(items_per_sample)
+        , m_Current(0)
+        , m_Start(0)
+        {
+            m_Times.SetCapacity(samples);
+        }
+
+        ~Run()
+        {
+            Finish();
+        }
+
+        /** Stops the timer for the previous sample and starts the next one. Returns false when done. */
+        bool Next()
+        {
+            uint64_t now = dmTime::GetTime();
+            if (m_Current > 1)
+                m_Times.Push(now - m_Start);
+            if (m_Current > m_Samples)
+                return false;
+            ++m_Current;
+            m_Start = dmTime::GetTime();
+            return true;
+        }
+
+    private:
+        void Finish()
+        {
+            if (m_Times.Empty())
+                return;
+
+            std::sort(m_Times.Begin(), m_Times.End());
+            uint64_t total = 0;
+            for (uint32_t i = 0; i < m_Times.Size(); ++i)
+                total += m_Times[i];
+
+            Result result;
+            memset(&result, 0, sizeof(result));
+            strncpy(result.m_Name, m_Name, sizeof(result.m_Name) - 1);
+            result.m_Samples        = m_Times.Size();
+            result.m_ItemsPerSample = m_ItemsPerSample;
+            result.m_MinUs          = m_Times[0];
+            result.m_MedianUs       = m_Times[m_Times.Size() / 2];
+            result.m_MeanUs         = total / m_Times.Size();
+            result.m_MaxUs          = m_Times[m_Times.Size() - 1];
+
+            dmArray<Result>& results = GetResults();
+            if (results.Full())
+                results.OffsetCapacity(16);
+            results.Push(result);
+            m_Times.SetSize(0);
+        }
+
+        const char*      m_Name;
+        uint32_t         m_Samples;
+        uint32_t         m_ItemsPerSample;
+        uint32_t         m_Current;
+        uint64_t         m_Start;
+        dmArray<uint64_t> m_Times;
+    };
+
+    inline void WriteJson(FILE* out, const char* suite)
+    {
+        const dmArray<Result>& results = GetResults();
+        fprintf(out, "{\n  \"suite\": \"%s\",\n  \"benchmarks\": [\n", suite);
+        for (uint32_t i = 0; i < results.Size(); ++i)
+        {
+            const Result& r = results[i];
+            double per_item_ns = r.m_ItemsPerSample > 0 ? (r.m_MedianUs * 1000.0) / r.m_ItemsPerSample : 0.0;
+            fprintf(out, "    {\"name\": \"%s\", \"samples\": %u, \"items_per_sample\": %u, "
+                         "\"min_us\": %llu, \"median_us\": %llu, \"mean_us\": %llu, \"max_us\": %llu, \"median_ns_per_item\": %.2f}%s\n",
+                    r.m_Name, r.m_Samples, r.m_ItemsPerSample,
+                    (unsigned long long)r.m_MinUs, (unsigned long long)r.m_MedianUs,
+                    (unsigned long long)r.m_MeanUs, (unsigned long long)r.m_MaxUs,
+                    per_item_ns, (i + 1) < results.Size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+    }
+
+    /**
+     * Writes the collected results for the suite as JSON.
+     * @return 0 on success
+     */
+    inline int Report(int argc, char** argv, const char* suite)
+    {
+        const char* path = getenv("DM_BENCHMARK_OUTPUT");
+        const char* arg = "--benchmark-output=";
+        for (int i = 1; i < argc; ++i)
+        {
+            if (strncmp(argv[i], arg, strlen(arg)) == 0)
+                path = argv[i] + strlen(arg);
+        }
+
+        FILE* out = stdout;
+        if (path && path[0])
+        {
+            out = fopen(path, "wb");
+            if (!out)
+            {
+                fprintf(stderr, "Failed to open benchmark output '%s'\n", path);
+                return 1;
+            }
+        }
+        WriteJson(out, suite);
+        if (out != stdout)
+            fclose(out);
+        return 0;
+    }
+}
+
+#endif // DM_BENCHMARK_H
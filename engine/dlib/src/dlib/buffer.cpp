@@ -44,6 +44,7 @@ namespace dmBuffer
         0xD3, 0xF0, 0x1D, 0xFF,
     };
     static const uint8_t GUARD_SIZE = sizeof(GUARD_VALUES);
+    static const uint8_t CHANGED_RANGE_HISTORY = 8;
 
     struct Buffer
     {
@@ -55,6 +56,15 @@ namespace dmBuffer
             uint8_t     m_ValueCount;
         };
 
+        // The structs changed by the content versions [m_FirstVersion, m_LastVersion]
+        struct ChangedRange
+        {
+            uint32_t    m_First;
+            uint32_t    m_End;
+            uint16_t    m_FirstVersion;
+            uint16_t    m_LastVersion;
+        };
+
         struct MetaData
         {
             dmhash_t    m_Name;
@@ -68,8 +78,12 @@ namespace dmBuffer
         dmArray<MetaData*> m_MetaDataArray;
         uint32_t m_Stride;          // The struct size (in bytes)
         uint32_t m_Count;           // The number of "structs" in the buffer (e.g. vertex count)
+        ChangedRange m_ChangedRanges[CHANGED_RANGE_HISTORY]; // Ring buffer of the latest changed ranges
         uint16_t m_ContentVersion;  // A running number, which user can use to signal content changes
         uint8_t  m_NumStreams;
+        uint8_t  m_ChangedRangeCount;
+        uint8_t  m_ChangedRangeHead; // The index of the latest changed range
+        uint8_t  m_ChangedRangeOpen; // If the latest changed range can still be extended
     };
 
     typedef dmOpaqueHandleContainer<Buffer> BufferContext;
@@ -358,6 +372,9 @@ namespace dmBuffer
         buffer->m_Data = (void*)((uintptr_t)data_block + header_size);
         buffer->m_Stride = struct_size;
         buffer->m_ContentVersion = 0;
+        buffer->m_ChangedRangeCount = 0;
+        buffer->m_ChangedRangeHead = 0;
+        buffer->m_ChangedRangeOpen = 0;
         new (&buffer->m_MetaDataArray) dmArray<Buffer::MetaData*>();
 
         CreateStreamsInterleaved(buffer, streams_decl, offsets);
@@ -591,13 +608,101 @@ namespace dmBuffer
         return RESULT_OK;
     }
 
+    static void AddChangedRange(Buffer* buffer, uint32_t first, uint32_t end)
+    {
+        uint16_t version = ++buffer->m_ContentVersion;
+
+        // Merges the updates in between two reads, e.g. all the writes to a stream from a script during a frame
+        if (buffer->m_ChangedRangeOpen)
+        {
+            Buffer::ChangedRange& range = buffer->m_ChangedRanges[buffer->m_ChangedRangeHead];
+            range.m_First = dmMath::Min(range.m_First, first);
+            range.m_End = dmMath::Max(range.m_End, end);
+            range.m_LastVersion = version;
+            return;
+        }
+
+        if (buffer->m_ChangedRangeCount > 0)
+            buffer->m_ChangedRangeHead = (buffer->m_ChangedRangeHead + 1) % CHANGED_RANGE_HISTORY;
+        if (buffer->m_ChangedRangeCount < CHANGED_RANGE_HISTORY)
+            buffer->m_ChangedRangeCount++;
+
+        Buffer::ChangedRange& range = buffer->m_ChangedRanges[buffer->m_ChangedRangeHead];
+        range.m_First = first;
+        range.m_End = end;
+        range.m_FirstVersion = version;
+        range.m_LastVersion = version;
+        buffer->m_ChangedRangeOpen = 1;
+    }
+
     Result UpdateContentVersion(HBuffer hbuffer)
     {
         Buffer* buffer = g_BufferContext->Get(hbuffer);
         if (!buffer) {
             return RESULT_BUFFER_INVALID;
         }
-        buffer->m_ContentVersion++;
+        AddChangedRange(buffer, 0, buffer->m_Count);
+        return RESULT_OK;
+    }
+
+    Result UpdateContentVersionRange(HBuffer hbuffer, uint32_t first, uint32_t count)
+    {
+        Buffer* buffer = g_BufferContext->Get(hbuffer);
+        if (!buffer) {
+            return RESULT_BUFFER_INVALID;
+        }
+        if (first > buffer->m_Count || count > buffer->m_Count - first) {
+            return RESULT_BUFFER_SIZE_ERROR;
+        }
+        AddChangedRange(buffer, first, first + count);
+        return RESULT_OK;
+    }
+
+    Result GetChangedRange(HBuffer hbuffer, uint32_t version, uint32_t* first, uint32_t* count)
+    {
+        Buffer* buffer = g_BufferContext->Get(hbuffer);
+        if (!buffer) {
+            return RESULT_BUFFER_INVALID;
+        }
+        buffer->m_ChangedRangeOpen = 0;
+
+        // The versions wrap around, so they're compared by their distance from the requested version
+        uint16_t since = (uint16_t)version;
+        uint16_t latest = (uint16_t)(buffer->m_ContentVersion - since);
+        if (latest == 0)
+        {
+            *first = 0;
+            *count = 0;
+            return RESULT_OK;
+        }
+
+        uint32_t range_first = buffer->m_Count;
+        uint32_t range_end = 0;
+        uint32_t index = buffer->m_ChangedRangeHead;
+        for (uint32_t i = 0; i < buffer->m_ChangedRangeCount; ++i)
+        {
+            const Buffer::ChangedRange& range = buffer->m_ChangedRanges[index];
+            uint16_t last_version = (uint16_t)(range.m_LastVersion - since);
+            if (last_version == 0 || last_version > latest)
+                break;
+
+            range_first = dmMath::Min(range_first, range.m_First);
+            range_end = dmMath::Max(range_end, range.m_End);
+
+            uint16_t first_version = (uint16_t)(range.m_FirstVersion - since);
+            if (first_version <= 1 || first_version > latest)
+            {
+                range_end = dmMath::Min(range_end, buffer->m_Count);
+                *first = range_first < range_end ? range_first : 0;
+                *count = range_first < range_end ? range_end - range_first : 0;
+                return RESULT_OK;
+            }
+            index = (index + CHANGED_RANGE_HISTORY - 1) % CHANGED_RANGE_HISTORY;
+        }
+
+        // The changes are older than the history
+        *first = 0;
+        *count = buffer->m_Count;
         return RESULT_OK;
     }
 
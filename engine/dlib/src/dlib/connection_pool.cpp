@@ -14,6 +14,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "connection_pool.h"
 #include "hashtable.h"
 #include "array.h"
@@ -21,6 +22,8 @@
 #include "log.h"
 #include "math.h"
 #include "hash.h"
+#include "http2.h"
+#include "dns.h"
 
 #include <dmsdk/dlib/mutex.h>
 #include <dlib/socket.h>
@@ -55,11 +58,15 @@ namespace dmConnectionPool
         uint64_t                m_Expires;
         dmSSLSocket::Socket     m_SSLSocket;
         dmSocket::Socket        m_Socket;
+        // An HTTP/2 connection is shared by all its users (m_Users), and is in use until the last one returns it
+        dmHttp2::HSession       m_Session;
         State                   m_State;
         uint16_t                m_Port;
         uint16_t                m_Version;
         uint16_t                m_ReuseCount;
+        uint16_t                m_Users;
         uint16_t                m_WasShutdown:1;
+        uint16_t                m_Closing:1;
     };
 
     static void DoClose(HPool pool, Connection* c);
@@ -188,20 +195,38 @@ namespace dmConnectionPool
         return ret;
     }
 
-    static bool FindConnection(HPool pool, dmhash_t id, dmSocket::Address address, uint16_t port, bool ssl, HConnection* connection)
+    static bool FindConnection(HPool pool, dmhash_t id, dmSocket::Address address, uint16_t port, bool ssl, bool http2, HConnection* connection)
     {
+        uint64_t now = dmTime::GetTime();
         uint32_t n = pool->m_Connections.Size();
         for (uint32_t i = 0; i < n; ++i) {
             Connection* c = &pool->m_Connections[i];
-            if (c->m_State == STATE_CONNECTED && c->m_ID == id) {
+            if (c->m_ID != id)
+                continue;
+
+            // HTTP/2 connections are only handed out to callers that asked for it, but may be shared
+            bool shared = c->m_Session != 0 && c->m_State == STATE_INUSE;
+            if (c->m_Session) {
+                if (!http2 || c->m_Closing || now >= c->m_Expires || !dmHttp2::IsUsable(c->m_Session))
+                    continue;
+            }
+
+            if (c->m_State == STATE_CONNECTED || shared) {
                 // We have to return a socket with the correct address family
                 bool ipv4_match = address.m_family == dmSocket::DOMAIN_IPV4 && dmSocket::IsSocketIPv4(c->m_Socket);
                 bool ipv6_match = address.m_family == dmSocket::DOMAIN_IPV6 && dmSocket::IsSocketIPv6(c->m_Socket);
                 if (ipv4_match || ipv6_match)
                 {
-                    c->m_State = STATE_INUSE;
                     c->m_ReuseCount++;
-                    *connection = MakeHandle(pool, i, c);
+                    if (shared) {
+                        // The other users hold the same handle
+                        *connection = (c->m_Version << 16) | (i & 0xffff);
+                    } else {
+                        c->m_State = STATE_INUSE;
+                        *connection = MakeHandle(pool, i, c);
+                    }
+                    if (c->m_Session)
+                        c->m_Users++;
                     return true;
                 }
             }
@@ -212,6 +237,10 @@ namespace dmConnectionPool
 
     static void DoClose(HPool pool, Connection* c)
     {
+        if (c->m_Session) {
+            dmHttp2::Delete(c->m_Session);
+            c->m_Session = 0;
+        }
         if (c->m_SSLSocket != dmSSLSocket::INVALID_SOCKET_HANDLE) {
             dmSSLSocket::Delete(c->m_SSLSocket);
             c->m_SSLSocket = dmSSLSocket::INVALID_SOCKET_HANDLE;
@@ -301,8 +330,11 @@ namespace dmConnectionPool
         return RESULT_OK;
     }
 
-    static Result Connect(HPool pool, const char* host, dmSocket::Address address, uint16_t port, bool ssl, int timeout,
-                                    dmSocket::Socket* socket, dmSSLSocket::Socket* sslsocket, dmSocket::Result* sr)
+    // The protocols we offer with ALPN when HTTP/2 is requested
+    static const char* HTTP2_ALPN_PROTOCOLS[] = { dmHttp2::ALPN_PROTOCOL, "http/1.1", 0 };
+
+    static Result Connect(HPool pool, const char* host, dmSocket::Address address, uint16_t port, bool ssl, bool http2, int timeout,
+                                    dmSocket::Socket* socket, dmSSLSocket::Socket* sslsocket, dmHttp2::HSession* session, dmSocket::Result* sr)
     {
         uint64_t connectstart = dmTime::GetTime();
 
@@ -322,7 +354,8 @@ namespace dmConnectionPool
         }
 
         if (RESULT_OK == r && ssl) {
-            dmSSLSocket::Result result = dmSSLSocket::New(*socket, host, timeout, sslsocket);
+            // HTTP/2 is only used if the server selects it during the handshake (ALPN). We don't do cleartext HTTP/2
+            dmSSLSocket::Result result = dmSSLSocket::New(*socket, host, timeout, http2 ? HTTP2_ALPN_PROTOCOLS : 0, sslsocket);
             if (dmSSLSocket::RESULT_OK != result)
             {
                 *sslsocket = dmSSLSocket::INVALID_SOCKET_HANDLE;
@@ -332,11 +365,22 @@ namespace dmConnectionPool
                     *sr = dmSocket::RESULT_UNKNOWN;
                 return RESULT_HANDSHAKE_FAILED;
             }
+
+            const char* protocol = http2 ? dmSSLSocket::GetALPNProtocol(*sslsocket) : 0;
+            if (protocol && strcmp(protocol, dmHttp2::ALPN_PROTOCOL) == 0)
+            {
+                *session = dmHttp2::New(*socket, *sslsocket);
+                if (*session == 0)
+                {
+                    *sr = dmSocket::RESULT_UNKNOWN;
+                    return RESULT_SOCKET_ERROR;
+                }
+            }
         }
         return r;
     }
 
-    Result DoDial(HPool pool, const char* host, uint16_t port, bool ssl, int timeout, int* cancelflag, HConnection* connection, dmSocket::Result* sock_res, bool ipv4, bool ipv6)
+    Result DoDial(HPool pool, const char* host, uint16_t port, bool ssl, bool http2, int timeout, int* cancelflag, HConnection* connection, dmSocket::Result* sock_res, bool ipv4, bool ipv6)
     {
         if (!pool->m_AllowNewConnections) {
             return RESULT_SHUT_DOWN;
@@ -371,7 +415,7 @@ namespace dmConnectionPool
 
             PurgeExpired(pool);
 
-            if (FindConnection(pool, conn_id, address, port, ssl, connection)) {
+            if (FindConnection(pool, conn_id, address, port, ssl, http2, connection)) {
                 return RESULT_OK;
             }
 
@@ -387,7 +431,8 @@ namespace dmConnectionPool
 
         dmSocket::Socket socket = dmSocket::INVALID_SOCKET_HANDLE;
         dmSSLSocket::Socket sslsocket = dmSSLSocket::INVALID_SOCKET_HANDLE;
-        Result r = Connect(pool, host, address, port, ssl, timeout, &socket, &sslsocket, sock_res);
+        dmHttp2::HSession session = 0;
+        Result r = Connect(pool, host, address, port, ssl, http2, timeout, &socket, &sslsocket, &session, sock_res);
 
         {
             DM_MUTEX_SCOPED_LOCK(pool->m_Mutex);
@@ -396,6 +441,8 @@ namespace dmConnectionPool
                 *connection = MakeHandle(pool, index, c);
                 c->m_Socket = socket;
                 c->m_SSLSocket = sslsocket;
+                c->m_Session = session;
+                c->m_Users = session ? 1 : 0;
                 c->m_ID = conn_id;
                 c->m_ReuseCount = 0;
                 c->m_State = STATE_INUSE;
@@ -405,6 +452,9 @@ namespace dmConnectionPool
                 c->m_WasShutdown = 0;
             } else {
                 c->m_State = STATE_FREE;
+                c->m_Session = session;
+                c->m_Socket = socket;
+                c->m_SSLSocket = sslsocket;
                 DoClose(pool, c);
             }
         }
@@ -412,32 +462,43 @@ namespace dmConnectionPool
         return r;
     }
 
-    Result Dial(HPool pool, const char* host, uint16_t port, bool ssl, int timeout, int* cancelflag, HConnection* connection, dmSocket::Result* sock_res)
+    Result Dial(HPool pool, const char* host, uint16_t port, bool ssl, bool http2, int timeout, int* cancelflag, HConnection* connection, dmSocket::Result* sock_res)
     {
+        // Resolve both address families in parallel, so that the ipv6 fallback doesn't have to wait
+        // for its own lookup. DoDial picks up the results, as the lookups are shared.
+        dmDNS::HRequest ipv4_request = dmDNS::Resolve(host, true, false);
+        dmDNS::HRequest ipv6_request = dmDNS::Resolve(host, false, true);
+
         // try connecting to the host using ipv4 first
         uint64_t dial_started = dmTime::GetTime();
-        Result r = DoDial(pool, host, port, ssl, timeout, cancelflag, connection, sock_res, 1, 0);
+        Result r = DoDial(pool, host, port, ssl, http2, timeout, cancelflag, connection, sock_res, 1, 0);
         // Only if handshake failed NOT because of timeout
-        if (r == RESULT_OK || r == RESULT_SHUT_DOWN || r == RESULT_OUT_OF_RESOURCES ||
-            (r == RESULT_HANDSHAKE_FAILED && *sock_res != dmSocket::RESULT_WOULDBLOCK))
+        if (!(r == RESULT_OK || r == RESULT_SHUT_DOWN || r == RESULT_OUT_OF_RESOURCES ||
+            (r == RESULT_HANDSHAKE_FAILED && *sock_res != dmSocket::RESULT_WOULDBLOCK)))
         {
-            return r;
-        }
-        // ipv4 connection failed - reduce timeout (if needed) and try using ipv6 instead
-        if (timeout > 0)
-        {
-            timeout = timeout - (int)(dmTime::GetTime() - dial_started);
-            if (timeout <= 0)
+            // ipv4 connection failed - reduce timeout (if needed) and try using ipv6 instead
+            bool timed_out = false;
+            if (timeout > 0)
             {
-                return RESULT_SOCKET_ERROR;
+                timeout = timeout - (int)(dmTime::GetTime() - dial_started);
+                timed_out = timeout <= 0;
             }
+            r = timed_out ? RESULT_SOCKET_ERROR : DoDial(pool, host, port, ssl, http2, timeout, cancelflag, connection, sock_res, 0, 1);
         }
-        return DoDial(pool, host, port, ssl, timeout, cancelflag, connection, sock_res, 0, 1);
+
+        dmDNS::Release(ipv4_request);
+        dmDNS::Release(ipv6_request);
+        return r;
+    }
+
+    Result Dial(HPool pool, const char* host, uint16_t port, bool ssl, int timeout, int* cancelflag, HConnection* connection, dmSocket::Result* sock_res)
+    {
+        return Dial(pool, host, port, ssl, false, timeout, cancelflag, connection, sock_res);
     }
 
     Result Dial(HPool pool, const char* host, uint16_t port, bool ssl, int timeout, HConnection* connection, dmSocket::Result* sock_res)
     {
-        return Dial(pool, host, port, ssl, timeout, 0, connection, sock_res);
+        return Dial(pool, host, port, ssl, false, timeout, 0, connection, sock_res);
     }
 
     void Return(HPool pool, HConnection connection)
@@ -446,6 +507,15 @@ namespace dmConnectionPool
 
         Connection* c = GetConnection(pool, connection);
         assert(c->m_State == STATE_INUSE);
+        if (c->m_Session) {
+            assert(c->m_Users > 0);
+            if (--c->m_Users > 0)
+                return;
+            if (c->m_Closing || !dmHttp2::IsAlive(c->m_Session)) {
+                DoClose(pool, c);
+                return;
+            }
+        }
         c->m_State = STATE_CONNECTED;
     }
 
@@ -455,6 +525,13 @@ namespace dmConnectionPool
 
         Connection* c = GetConnection(pool, connection);
         assert(c->m_State == STATE_INUSE);
+        if (c->m_Session) {
+            // The other users keep using it until they're done
+            assert(c->m_Users > 0);
+            c->m_Closing = 1;
+            if (--c->m_Users > 0)
+                return;
+        }
         DoClose(pool, c);
     }
 
@@ -476,6 +553,27 @@ namespace dmConnectionPool
         return c->m_SSLSocket;
     }
 
+    Result Warmup(HPool pool, const char* host, uint16_t port, bool ssl, bool http2, int timeout, int* cancelflag)
+    {
+        HConnection connection;
+        dmSocket::Result sock_res = dmSocket::RESULT_OK;
+        Result r = Dial(pool, host, port, ssl, http2, timeout, cancelflag, &connection, &sock_res);
+        if (r == RESULT_OK)
+        {
+            Return(pool, connection);
+        }
+        return r;
+    }
+
+    dmHttp2::HSession GetHttp2Session(HPool pool, HConnection connection)
+    {
+        DM_MUTEX_SCOPED_LOCK(pool->m_Mutex);
+
+        Connection* c = GetConnection(pool, connection);
+        assert(c->m_State == STATE_INUSE);
+        return c->m_Session;
+    }
+
     uint32_t GetReuseCount(HPool pool, HConnection connection)
     {
         DM_MUTEX_SCOPED_LOCK(pool->m_Mutex);
@@ -520,6 +618,8 @@ namespace dmConnectionPool
             Connection* c = &pool->m_Connections[i];
             if (c->m_State == STATE_CONNECTED)
             {
+                if (c->m_Session)
+                    dmHttp2::Delete(c->m_Session);
                 dmSSLSocket::Delete(c->m_SSLSocket);
                 dmSocket::Delete(c->m_Socket);
                 c->Clear();
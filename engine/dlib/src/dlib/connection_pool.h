@@ -19,6 +19,7 @@
 
 // Cannot forward declare enums
 #include <dmsdk/dlib/connection_pool.h>
+#include <dlib/http2.h>
 
 /**
  * Connection pooling
@@ -59,6 +60,32 @@ namespace dmConnectionPool
      * during testing, or subsequent tests will break when the pool has been put in shutdown mode.
      */
     void Reopen(HPool pool);
+
+    /**
+     * Connect to a host, and use HTTP/2 if requested and the server selects it with ALPN (secure connections only).
+     * An HTTP/2 connection is shared by all the callers dialing the same host, as long as the session is usable.
+     * They all get the same handle, and the connection is in use until all of them have returned it.
+     * @name dmConnectionPool::Dial
+     * @param http2 true to offer HTTP/2
+     * @return dmConnectionPool::RESULT_OK on success
+     */
+    Result Dial(HPool pool, const char* host, uint16_t port, bool ssl, bool http2, int timeout, int* cancelflag, HConnection* connection, dmSocket::Result* sock_res);
+
+    /**
+     * Connect to a host ahead of time, and leave the connection in the pool, so that the next Dial to the host
+     * doesn't have to wait for the connection and the TLS handshake. The TLS session of the host is cached as well,
+     * so that even a new connection resumes it instead of doing a full handshake.
+     * @name dmConnectionPool::Warmup
+     * @return dmConnectionPool::RESULT_OK on success
+     */
+    Result Warmup(HPool pool, const char* host, uint16_t port, bool ssl, bool http2, int timeout, int* cancelflag);
+
+    /**
+     * Get the HTTP/2 session of a connection
+     * @name dmConnectionPool::GetHttp2Session
+     * @return the session, or 0 for an HTTP/1.1 connection
+     */
+    dmHttp2::HSession GetHttp2Session(HPool pool, HConnection connection);
 }
 
 #endif // #ifndef DM_CONNECTION_POOL
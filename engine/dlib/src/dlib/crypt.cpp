@@ -206,6 +206,62 @@ namespace dmCrypt
         }
     }
 
+    struct HashState
+    {
+        HashAlgorithm m_Algorithm;
+        union
+        {
+            mbedtls_md5_context  m_Md5;
+            mbedtls_sha1_context m_Sha1;
+        };
+    };
+
+    HHashState NewHash(HashAlgorithm algorithm)
+    {
+        HashState* state = (HashState*)malloc(sizeof(HashState));
+        state->m_Algorithm = algorithm;
+        if (algorithm == HASH_ALGORITHM_MD5)
+        {
+            mbedtls_md5_init(&state->m_Md5);
+            mbedtls_md5_starts_ret(&state->m_Md5);
+        }
+        else
+        {
+            mbedtls_sha1_init(&state->m_Sha1);
+            mbedtls_sha1_starts_ret(&state->m_Sha1);
+        }
+        return state;
+    }
+
+    void UpdateHash(HHashState state, const uint8_t* buf, uint32_t buflen)
+    {
+        if (state->m_Algorithm == HASH_ALGORITHM_MD5)
+            mbedtls_md5_update_ret(&state->m_Md5, (const unsigned char*)buf, (size_t)buflen);
+        else
+            mbedtls_sha1_update_ret(&state->m_Sha1, (const unsigned char*)buf, (size_t)buflen);
+    }
+
+    void FinalizeHash(HHashState state, uint8_t* digest)
+    {
+        int ret;
+        if (state->m_Algorithm == HASH_ALGORITHM_MD5)
+            ret = mbedtls_md5_finish_ret(&state->m_Md5, (unsigned char*)digest);
+        else
+            ret = mbedtls_sha1_finish_ret(&state->m_Sha1, (unsigned char*)digest);
+        if (ret != 0) {
+            memset(digest, 0, state->m_Algorithm == HASH_ALGORITHM_MD5 ? 16 : 20);
+        }
+    }
+
+    void DeleteHash(HHashState state)
+    {
+        if (state->m_Algorithm == HASH_ALGORITHM_MD5)
+            mbedtls_md5_free(&state->m_Md5);
+        else
+            mbedtls_sha1_free(&state->m_Sha1);
+        free(state);
+    }
+
     bool Base64Encode(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t* dst_len)
     {
         size_t out_len = 0;
@@ -31,6 +31,42 @@ namespace dmCrypt
      * @return RESULT_OK if decrypting went ok.
      */
     Result Decrypt(const uint8_t* key, uint32_t keylen, const uint8_t* data, uint32_t datalen, uint8_t** output, uint32_t* outputlen);
+
+    enum HashAlgorithm
+    {
+        HASH_ALGORITHM_MD5,
+        HASH_ALGORITHM_SHA1,
+    };
+
+    typedef struct HashState* HHashState;
+
+    /**
+     * Starts hashing data that arrives in chunks, e.g. while it is being downloaded
+     * @param algorithm The algorithm
+     * @return The hash state. Delete it with DeleteHash
+     */
+    HHashState NewHash(HashAlgorithm algorithm);
+
+    /**
+     * Adds data to the hash
+     * @param state The hash state
+     * @param buf The data
+     * @param buflen
+     */
+    void UpdateHash(HHashState state, const uint8_t* buf, uint32_t buflen);
+
+    /**
+     * Writes the digest of all the data added so far. Output is 16 bytes for MD5 and 20 bytes for SHA1
+     * @param state The hash state
+     * @param digest [out] The digest
+     */
+    void FinalizeHash(HHashState state, uint8_t* digest);
+
+    /**
+     * Deletes the hash state
+     * @param state The hash state
+     */
+    void DeleteHash(HHashState state);
 }
 
 #endif /* DM_CRYPT_H */
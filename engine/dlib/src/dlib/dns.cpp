@@ -0,0 +1,316 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include "dns.h"
+#include "array.h"
+#include "hash.h"
+#include "hashtable.h"
+#include "log.h"
+#include "mutex.h"
+#include "thread.h"
+#include "time.h"
+
+namespace dmDNS
+{
+    // Maximum number of concurrent lookups
+    const uint32_t MAX_WORKERS = 4;
+    // Maximum number of cached lookups
+    const uint32_t MAX_CACHE_SIZE = 64;
+    const uint32_t WORKER_STACK_SIZE = 256 * 1024;
+
+    struct Lookup
+    {
+        char*               m_Name;
+        uint64_t            m_Key;
+        uint64_t            m_Expires;
+        dmSocket::Address   m_Address;
+        dmSocket::Result    m_Result;
+        // The requests, and the worker while the lookup is in progress
+        uint32_t            m_RefCount;
+        uint8_t             m_Ipv4 : 1;
+        uint8_t             m_Ipv6 : 1;
+        uint8_t             m_Done : 1;
+        // The lookup is in the cache table
+        uint8_t             m_Cached : 1;
+    };
+
+    struct Resolver
+    {
+        Resolver()
+        {
+            m_Mutex = dmMutex::New();
+            m_Lookups.SetCapacity(MAX_CACHE_SIZE / 2, MAX_CACHE_SIZE + 1);
+            m_Workers = 0;
+        }
+
+        ~Resolver()
+        {
+            // The detached workers might still be waiting for getaddrinfo, and we let them finish
+            if (m_Workers == 0)
+            {
+                ClearCache();
+                dmMutex::Delete(m_Mutex);
+            }
+        }
+
+        dmMutex::HMutex         m_Mutex;
+        dmHashTable64<Lookup*>  m_Lookups;
+        dmArray<Lookup*>        m_Queue;
+        uint32_t                m_Workers;
+    };
+
+    Resolver g_Resolver;
+
+    static uint64_t LookupKey(const char* name, bool ipv4, bool ipv6)
+    {
+        HashState64 hash_state;
+        dmHashInit64(&hash_state, false);
+        dmHashUpdateBuffer64(&hash_state, name, strlen(name));
+        uint8_t families = (ipv4 ? 1 : 0) | (ipv6 ? 2 : 0);
+        dmHashUpdateBuffer64(&hash_state, &families, 1);
+        return dmHashFinal64(&hash_state);
+    }
+
+    // Numeric addresses are resolved without any network access, so there is no need to wait for a worker
+    static bool IsNumericAddress(const char* name)
+    {
+        bool dot = false;
+        for (const char* c = name; *c; ++c)
+        {
+            if (*c == ':')
+                return true;
+            else if (*c == '.')
+                dot = true;
+            else if (*c < '0' || *c > '9')
+                return false;
+        }
+        return dot;
+    }
+
+    static void DeleteLookup(Lookup* lookup)
+    {
+        free(lookup->m_Name);
+        delete lookup;
+    }
+
+    static void ReleaseLookup(Lookup* lookup)
+    {
+        assert(lookup->m_RefCount > 0);
+        if (--lookup->m_RefCount == 0 && !lookup->m_Cached)
+        {
+            DeleteLookup(lookup);
+        }
+    }
+
+    static void Uncache(Lookup* lookup)
+    {
+        g_Resolver.m_Lookups.Erase(lookup->m_Key);
+        lookup->m_Cached = 0;
+        if (lookup->m_RefCount == 0)
+        {
+            DeleteLookup(lookup);
+        }
+    }
+
+    static void Finish(Lookup* lookup, dmSocket::Result result, const dmSocket::Address& address)
+    {
+        lookup->m_Result = result;
+        lookup->m_Address = address;
+        lookup->m_Expires = dmTime::GetTime() + (uint64_t) (result == dmSocket::RESULT_OK ? POSITIVE_TTL : NEGATIVE_TTL) * 1000000U;
+        lookup->m_Done = 1;
+    }
+
+    struct EvictContext
+    {
+        uint64_t m_Time;
+        Lookup*  m_Oldest;
+        dmArray<Lookup*>* m_Expired;
+    };
+
+    static void EvictCallback(EvictContext* context, const uint64_t* key, Lookup** value)
+    {
+        Lookup* lookup = *value;
+        if (!lookup->m_Done)
+            return;
+        if (lookup->m_Expires <= context->m_Time)
+        {
+            if (!context->m_Expired->Full())
+                context->m_Expired->Push(lookup);
+        }
+        else if (context->m_Oldest == 0 || lookup->m_Expires < context->m_Oldest->m_Expires)
+        {
+            context->m_Oldest = lookup;
+        }
+    }
+
+    // Makes room for a new lookup. The lookups in progress are never evicted
+    static bool MakeRoom()
+    {
+        dmArray<Lookup*> expired;
+        expired.SetCapacity(MAX_CACHE_SIZE);
+
+        EvictContext context;
+        context.m_Time = dmTime::GetTime();
+        context.m_Oldest = 0;
+        context.m_Expired = &expired;
+        g_Resolver.m_Lookups.Iterate(EvictCallback, &context);
+
+        for (uint32_t i = 0; i < expired.Size(); ++i)
+        {
+            Uncache(expired[i]);
+        }
+        if (expired.Empty() && context.m_Oldest)
+        {
+            Uncache(context.m_Oldest);
+        }
+        return !g_Resolver.m_Lookups.Full();
+    }
+
+#if defined(DM_HAS_THREADS)
+    static void Worker(void*)
+    {
+        DM_MUTEX_SCOPED_LOCK(g_Resolver.m_Mutex);
+        while (!g_Resolver.m_Queue.Empty())
+        {
+            Lookup* lookup = g_Resolver.m_Queue[0];
+            g_Resolver.m_Queue.EraseSwap(0);
+
+            dmSocket::Address address;
+            dmMutex::Unlock(g_Resolver.m_Mutex);
+            dmSocket::Result result = dmSocket::GetHostByName(lookup->m_Name, &address, lookup->m_Ipv4, lookup->m_Ipv6);
+            dmMutex::Lock(g_Resolver.m_Mutex);
+
+            Finish(lookup, result, address);
+            ReleaseLookup(lookup);
+        }
+        g_Resolver.m_Workers--;
+    }
+#endif
+
+    HRequest Resolve(const char* name, bool ipv4, bool ipv6)
+    {
+        DM_MUTEX_SCOPED_LOCK(g_Resolver.m_Mutex);
+
+        uint64_t key = LookupKey(name, ipv4, ipv6);
+        Lookup** cached = g_Resolver.m_Lookups.Get(key);
+        if (cached)
+        {
+            Lookup* lookup = *cached;
+            if (!lookup->m_Done || lookup->m_Expires > dmTime::GetTime())
+            {
+                lookup->m_RefCount++;
+                return lookup;
+            }
+            Uncache(lookup);
+        }
+
+        Lookup* lookup = new Lookup;
+        memset(lookup, 0, sizeof(*lookup));
+        lookup->m_Name = strdup(name);
+        lookup->m_Key = key;
+        lookup->m_Ipv4 = ipv4;
+        lookup->m_Ipv6 = ipv6;
+        lookup->m_RefCount = 1;
+
+        if (!g_Resolver.m_Lookups.Full() || MakeRoom())
+        {
+            g_Resolver.m_Lookups.Put(key, lookup);
+            lookup->m_Cached = 1;
+        }
+
+        bool synchronous = IsNumericAddress(name) || !dmThread::PlatformHasThreadSupport();
+        if (synchronous)
+        {
+            dmSocket::Address address;
+            dmSocket::Result result = dmSocket::GetHostByName(name, &address, ipv4, ipv6);
+            Finish(lookup, result, address);
+            return lookup;
+        }
+
+#if defined(DM_HAS_THREADS)
+        // The worker holds a reference until the lookup is done
+        lookup->m_RefCount++;
+        if (g_Resolver.m_Queue.Full())
+            g_Resolver.m_Queue.OffsetCapacity(8);
+        g_Resolver.m_Queue.Push(lookup);
+
+        if (g_Resolver.m_Workers < MAX_WORKERS)
+        {
+            dmThread::Thread thread = dmThread::New(Worker, WORKER_STACK_SIZE, 0, "dns");
+            dmThread::Detach(thread);
+            g_Resolver.m_Workers++;
+        }
+#endif
+        return lookup;
+    }
+
+    dmSocket::Result GetResult(HRequest request, dmSocket::Address* address)
+    {
+        DM_MUTEX_SCOPED_LOCK(g_Resolver.m_Mutex);
+        if (!request->m_Done)
+        {
+            return dmSocket::RESULT_WOULDBLOCK;
+        }
+        *address = request->m_Address;
+        return request->m_Result;
+    }
+
+    void Release(HRequest request)
+    {
+        DM_MUTEX_SCOPED_LOCK(g_Resolver.m_Mutex);
+        ReleaseLookup(request);
+    }
+
+    dmSocket::Result GetHostByName(const char* name, dmSocket::Address* address, uint64_t timeout, int* cancelflag, bool ipv4, bool ipv6)
+    {
+        HRequest request = Resolve(name, ipv4, ipv6);
+
+        uint64_t tend = timeout ? dmTime::GetTime() + timeout : 0xFFFFFFFFFFFFFFFF;
+        dmSocket::Result result;
+        while ((result = GetResult(request, address)) == dmSocket::RESULT_WOULDBLOCK)
+        {
+            if (tend <= dmTime::GetTime() || (cancelflag && *cancelflag))
+            {
+                result = dmSocket::RESULT_TIMEDOUT;
+                break;
+            }
+            dmTime::Sleep(2000);
+        }
+
+        Release(request);
+        return result;
+    }
+
+    static void CollectDoneCallback(dmArray<Lookup*>* done, const uint64_t* key, Lookup** value)
+    {
+        if ((*value)->m_Done)
+        {
+            done->OffsetCapacity(1);
+            done->Push(*value);
+        }
+    }
+
+    void ClearCache()
+    {
+        DM_MUTEX_SCOPED_LOCK(g_Resolver.m_Mutex);
+        dmArray<Lookup*> done;
+        g_Resolver.m_Lookups.Iterate(CollectDoneCallback, &done);
+        for (uint32_t i = 0; i < done.Size(); ++i)
+        {
+            Uncache(done[i]);
+        }
+    }
+}
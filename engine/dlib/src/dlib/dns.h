@@ -0,0 +1,81 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_DNS_H
+#define DM_DNS_H
+
+#include <stdint.h>
+#include <dlib/socket.h>
+
+/**
+ * Asynchronous host name resolution, with a cache shared by all users.
+ *
+ * The lookups are made with getaddrinfo on a few detached worker threads, so that a slow resolver
+ * never blocks the caller, or the shutdown of the application. Concurrent lookups of the same name
+ * are merged into one. As getaddrinfo doesn't expose the record TTLs, successful lookups are cached
+ * for POSITIVE_TTL, and failed ones for NEGATIVE_TTL.
+ *
+ * On platforms without threads, the lookups are made synchronously.
+ */
+namespace dmDNS
+{
+    /// Time in seconds a resolved address is cached
+    const uint32_t POSITIVE_TTL = 60;
+    /// Time in seconds a failed lookup is cached
+    const uint32_t NEGATIVE_TTL = 5;
+
+    typedef struct Lookup* HRequest;
+
+    /**
+     * Start resolving a host name. The request is served from the cache if possible.
+     * @param name the host name
+     * @param ipv4 whether or not to search for IPv4 addresses
+     * @param ipv6 whether or not to search for IPv6 addresses
+     * @return the request. Must be released with Release
+     */
+    HRequest Resolve(const char* name, bool ipv4 = true, bool ipv6 = true);
+
+    /**
+     * Get the result of a request
+     * @param request the request
+     * @param address the address (out)
+     * @return RESULT_WOULDBLOCK while the lookup is in progress, otherwise the result of the lookup
+     */
+    dmSocket::Result GetResult(HRequest request, dmSocket::Address* address);
+
+    /**
+     * Release a request. The lookup itself continues, and is cached, even if it's not finished.
+     * @param request the request
+     */
+    void Release(HRequest request);
+
+    /**
+     * Resolve a host name, and wait for the result
+     * @param name the host name
+     * @param address the address (out)
+     * @param timeout timeout in microseconds, or 0 for no timeout
+     * @param cancelflag if non null and set, will abort the call
+     * @param ipv4 whether or not to search for IPv4 addresses
+     * @param ipv6 whether or not to search for IPv6 addresses
+     * @return RESULT_OK on success, RESULT_TIMEDOUT on timeout or cancel
+     */
+    dmSocket::Result GetHostByName(const char* name, dmSocket::Address* address, uint64_t timeout, int* cancelflag, bool ipv4 = true, bool ipv6 = true);
+
+    /**
+     * Remove all finished lookups from the cache, e.g. when the network has changed
+     */
+    void ClearCache();
+}
+
+#endif // DM_DNS_H
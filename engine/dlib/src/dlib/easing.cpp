@@ -61,5 +61,20 @@ namespace dmEasing
         float diff = (t - index1 * (1.0f / (sample_count-1))) * (sample_count-1);
         return val1 * (1.0f - diff) + val2 * diff;
     }
+
+    void GetValues(Type type, const float* t, float* values, uint32_t count)
+    {
+        assert(type != TYPE_FLOAT_VECTOR && type < TYPE_COUNT);
+        const float* lookup = EASING_LOOKUP + type * (EASING_SAMPLES + 1);
+        const float scale = (float) (EASING_SAMPLES - 1);
+        // The last sample is duplicated, so the second sample can always be read without clamping the index
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            float ti   = dmMath::Clamp(t[i], 0.0f, 1.0f);
+            int index  = (int) (ti * scale);
+            float diff = (ti - index * (1.0f / scale)) * scale;
+            values[i]  = lookup[index] * (1.0f - diff) + lookup[index + 1] * diff;
+        }
+    }
 }
 
@@ -105,6 +105,15 @@ namespace dmEasing
      */
     float GetValue(Type type, float t);
     float GetValue(Curve curve, float t);
+
+    /**
+     * Evaluates a built-in easing curve for a range of times
+     * @param type curve type, must not be TYPE_FLOAT_VECTOR
+     * @param t times in the range [0,1]
+     * @param values the curve values, one per time
+     * @param count number of times
+     */
+    void GetValues(Type type, const float* t, float* values, uint32_t count);
 }
 
 #endif // DM_EASING
@@ -0,0 +1,551 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_FLAT_HASHTABLE_H
+#define DM_FLAT_HASHTABLE_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define DM_FLAT_HASHTABLE_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define DM_FLAT_HASHTABLE_NEON
+    #include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace dmFlatHashTableInternal
+{
+    // Control bytes. Full slots store the lower 7 bits of the hash (0..127)
+    static const int8_t CTRL_EMPTY   = -128; // 0x80
+    static const int8_t CTRL_DELETED = -2;   // 0xFE
+
+    static const uint32_t GROUP_WIDTH = 16;
+
+    static inline uint32_t CountTrailingZeros(uint64_t x)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+    #if defined(_M_X64) || defined(_M_ARM64)
+        _BitScanForward64(&index, x);
+    #else
+        if ((uint32_t)x)
+            _BitScanForward(&index, (uint32_t)x);
+        else
+        {
+            _BitScanForward(&index, (uint32_t)(x >> 32));
+            index += 32;
+        }
+    #endif
+        return (uint32_t)index;
+#else
+        return (uint32_t)__builtin_ctzll(x);
+#endif
+    }
+
+    // A set of slots within a group. With NEON there are 4 bits per slot, of which only the top one is kept
+    struct GroupMask
+    {
+#if defined(DM_FLAT_HASHTABLE_NEON)
+        static const uint32_t SHIFT = 2;
+#else
+        static const uint32_t SHIFT = 0;
+#endif
+        uint64_t m_Bits;
+
+        GroupMask(uint64_t bits) : m_Bits(bits) {}
+        bool     Any() const        { return m_Bits != 0; }
+        uint32_t Lowest() const     { return CountTrailingZeros(m_Bits) >> SHIFT; }
+        void     ClearLowest()      { m_Bits &= m_Bits - 1; }
+    };
+
+    // A group of GROUP_WIDTH control bytes, loaded unaligned from any slot position
+    struct Group
+    {
+#if defined(DM_FLAT_HASHTABLE_SSE2)
+        __m128i m_Ctrl;
+        Group(const int8_t* ctrl) : m_Ctrl(_mm_loadu_si128((const __m128i*)ctrl)) {}
+
+        GroupMask Match(int8_t h2) const
+        {
+            return GroupMask((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(m_Ctrl, _mm_set1_epi8(h2))));
+        }
+
+        GroupMask MatchEmpty() const
+        {
+            return Match(CTRL_EMPTY);
+        }
+
+        // Both empty and deleted slots have the top bit set
+        GroupMask MatchEmptyOrDeleted() const
+        {
+            return GroupMask((uint32_t)_mm_movemask_epi8(m_Ctrl));
+        }
+#elif defined(DM_FLAT_HASHTABLE_NEON)
+        int8x16_t m_Ctrl;
+        Group(const int8_t* ctrl) : m_Ctrl(vld1q_s8(ctrl)) {}
+
+        static GroupMask ToMask(uint8x16_t cmp)
+        {
+            uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4)), 0);
+            return GroupMask(bits & 0x8888888888888888ULL);
+        }
+
+        GroupMask Match(int8_t h2) const
+        {
+            return ToMask(vceqq_s8(m_Ctrl, vdupq_n_s8(h2)));
+        }
+
+        GroupMask MatchEmpty() const
+        {
+            return Match(CTRL_EMPTY);
+        }
+
+        GroupMask MatchEmptyOrDeleted() const
+        {
+            return ToMask(vcltq_s8(m_Ctrl, vdupq_n_s8(0)));
+        }
+#else
+        const int8_t* m_Ctrl;
+        Group(const int8_t* ctrl) : m_Ctrl(ctrl) {}
+
+        GroupMask Match(int8_t h2) const
+        {
+            uint32_t bits = 0;
+            for (uint32_t i = 0; i < GROUP_WIDTH; ++i)
+                bits |= (uint32_t)(m_Ctrl[i] == h2) << i;
+            return GroupMask(bits);
+        }
+
+        GroupMask MatchEmpty() const
+        {
+            return Match(CTRL_EMPTY);
+        }
+
+        GroupMask MatchEmptyOrDeleted() const
+        {
+            uint32_t bits = 0;
+            for (uint32_t i = 0; i < GROUP_WIDTH; ++i)
+                bits |= (uint32_t)(m_Ctrl[i] < 0) << i;
+            return GroupMask(bits);
+        }
+#endif
+    };
+
+    // Keys are often already hashes, but may also be small indices, so they are mixed before use
+    static inline uint64_t HashKey(uint64_t key)
+    {
+        uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 32);
+    }
+}
+
+/**
+ * Open addressing hashtable with the same interface as dmHashTable. The entries are stored inline
+ * in a single flat array, next to an array of one control byte per slot. Lookups probe 16 control
+ * bytes at a time (using SSE2 or NEON where available), and only touch the entries whose control
+ * byte matches 7 bits of the key hash.
+ * @note Memcpy-copy semantics (POD types). The key type needs to be an integer type.
+ * @note The table_size argument of SetCapacity is ignored. The number of slots is derived from the capacity.
+ * @note An Erase leaves a tombstone in the slot, which is reclaimed when the table runs out of
+ *       empty slots and is rehashed in place.
+ */
+template <typename KEY, typename T>
+class dmFlatHashTable
+{
+    static const uint32_t MAX_SIZE = 0x7FFFFFFF;
+
+public:
+    struct Entry
+    {
+        KEY      m_Key;
+        T        m_Value;
+    };
+
+    dmFlatHashTable()
+    {
+        memset(this, 0, sizeof(*this));
+    }
+
+    ~dmFlatHashTable()
+    {
+        if (m_Ctrl)
+        {
+            free(m_Ctrl);
+        }
+    }
+
+    /**
+     * Removes all the entries from the table.
+     */
+    void Clear()
+    {
+        if (m_Ctrl)
+        {
+            memset(m_Ctrl, dmFlatHashTableInternal::CTRL_EMPTY, m_SlotCount + dmFlatHashTableInternal::GROUP_WIDTH);
+        }
+        m_Count = 0;
+        m_GrowthLeft = MaxLoad(m_SlotCount);
+    }
+
+    /**
+     * Number of entries stored in table
+     * @return Number of entries.
+     */
+    uint32_t Size() const
+    {
+        return m_Count;
+    }
+
+    /**
+     * Maximum number of entries possible to store in table
+     * @return the capacity of the table
+     */
+    uint32_t Capacity() const
+    {
+        return m_Capacity;
+    }
+
+    /**
+     * Set hashtable capacity. New capacity must be greater or equal to current capacity
+     * @param table_size Ignored, kept for compatibility with dmHashTable
+     * @param capacity Capacity
+     */
+    void SetCapacity(uint32_t table_size, uint32_t capacity)
+    {
+        (void)table_size;
+        SetCapacity(capacity);
+    }
+
+    /**
+     * Set hashtable capacity. New capacity must be greater or equal to current capacity
+     * @param capacity Capacity
+     */
+    void SetCapacity(uint32_t capacity)
+    {
+        assert(capacity < MAX_SIZE);
+        assert(capacity >= Capacity());
+
+        uint32_t slot_count = dmFlatHashTableInternal::GROUP_WIDTH;
+        while (MaxLoad(slot_count) < capacity)
+        {
+            slot_count *= 2;
+        }
+        m_Capacity = capacity;
+
+        if (slot_count != m_SlotCount)
+        {
+            Rehash(slot_count);
+        }
+    }
+
+    /**
+     * Swaps the contents of two hash tables
+     * @param other the other table
+     */
+    void Swap(dmFlatHashTable<KEY, T>& other)
+    {
+        char buf[sizeof(*this)];
+        memcpy(buf, &other, sizeof(buf));
+        memcpy(&other, this, sizeof(buf));
+        memcpy(this, buf, sizeof(buf));
+    }
+
+    /**
+     * Check if the table is full
+     * @return true if the table is full
+     */
+    bool Full() const
+    {
+        return m_Count == m_Capacity;
+    }
+
+    /**
+     * Check if the table is empty
+     * @return true if the table is empty
+     */
+    bool Empty() const
+    {
+        return m_Count == 0;
+    }
+
+    /**
+     * Put key/value pair in hash table. NOTE: The method will "assert" if the hashtable is full.
+     * @param key Key
+     * @param value Value
+     */
+    void Put(KEY key, const T& value)
+    {
+        uint64_t hash = dmFlatHashTableInternal::HashKey((uint64_t)key);
+        Entry* entry = FindEntry(key, hash);
+        if (entry != 0)
+        {
+            entry->m_Value = value;
+            return;
+        }
+
+        assert(!Full());
+        if (m_GrowthLeft == 0)
+        {
+            // Only tombstones left, reclaim them
+            Rehash(m_SlotCount);
+        }
+
+        uint32_t index = FindInsertSlot(hash);
+        m_GrowthLeft -= m_Ctrl[index] == dmFlatHashTableInternal::CTRL_EMPTY ? 1 : 0;
+        SetCtrl(index, (int8_t)(hash & 0x7F));
+        m_Entries[index].m_Key = key;
+        m_Entries[index].m_Value = value;
+        m_Count++;
+    }
+
+    /**
+     * Get pointer to value from key
+     * @param key Key
+     * @return Pointer to value. NULL if the key/value pair doesn't exist.
+     */
+    T* Get(KEY key)
+    {
+        Entry* entry = FindEntry(key, dmFlatHashTableInternal::HashKey((uint64_t)key));
+        return entry ? &entry->m_Value : 0;
+    }
+
+    /**
+     * Get pointer to value from key. "const" version.
+     * @param key Key
+     * @return Pointer to value. NULL if the key/value pair doesn't exist.
+     */
+    const T* Get(KEY key) const
+    {
+        Entry* entry = FindEntry(key, dmFlatHashTableInternal::HashKey((uint64_t)key));
+        return entry ? &entry->m_Value : 0;
+    }
+
+    /**
+     * Remove key/value pair.
+     * @param key Key to remove
+     * @note Only valid if key exists in table
+     */
+    void Erase(KEY key)
+    {
+        Entry* entry = FindEntry(key, dmFlatHashTableInternal::HashKey((uint64_t)key));
+        assert(entry != 0 && "Key not found (erase)");
+        SetCtrl((uint32_t)(entry - m_Entries), dmFlatHashTableInternal::CTRL_DELETED);
+        --m_Count;
+    }
+
+    /**
+     * Iterate over all entries in table
+     * @param call_back Call-back called for every entry
+     * @param context Context
+     */
+    template <typename CONTEXT>
+    void Iterate(void (*call_back)(CONTEXT *context, const KEY* key, T* value), CONTEXT* context) const
+    {
+        for (uint32_t i = 0; i < m_SlotCount; ++i)
+        {
+            if (m_Ctrl[i] >= 0)
+            {
+                call_back(context, &m_Entries[i].m_Key, &m_Entries[i].m_Value);
+            }
+        }
+    }
+
+    /**
+     * Iterator to the key/value pairs of a hash table
+     */
+    struct Iterator
+    {
+        // public
+        const KEY&  GetKey()    { return m_Table.m_Entries[m_Index].m_Key; }
+        const T&    GetValue()  { return m_Table.m_Entries[m_Index].m_Value; }
+
+        Iterator(dmFlatHashTable<KEY, T>& table)
+            : m_Table(table)
+            , m_Index(0xFFFFFFFF)
+        {
+        }
+
+        bool Next()
+        {
+            while (++m_Index < m_Table.m_SlotCount)
+            {
+                if (m_Table.m_Ctrl[m_Index] >= 0)
+                    return true;
+            }
+            m_Index = m_Table.m_SlotCount;
+            return false;
+        }
+
+        // private
+        dmFlatHashTable<KEY, T>&    m_Table;
+        uint32_t                    m_Index;
+    };
+
+    /**
+     * Get an iterator for the key/value pairs
+     * @return the iterator
+     */
+    Iterator GetIterator()
+    {
+        return Iterator(*this);
+    }
+
+    /**
+     * Verify internal structure. "assert" if invalid. For unit testing
+     */
+    void Verify()
+    {
+        uint32_t real_count = 0;
+        for (uint32_t i = 0; i < m_SlotCount; ++i)
+        {
+            if (m_Ctrl[i] >= 0)
+            {
+                real_count++;
+                assert(FindEntry(m_Entries[i].m_Key, dmFlatHashTableInternal::HashKey((uint64_t)m_Entries[i].m_Key)) == &m_Entries[i]);
+            }
+        }
+        for (uint32_t i = 0; i < dmFlatHashTableInternal::GROUP_WIDTH && m_SlotCount; ++i)
+        {
+            assert(m_Ctrl[m_SlotCount + i] == m_Ctrl[i % m_SlotCount]);
+        }
+        assert(real_count == m_Count);
+    }
+
+private:
+    // Forbid assignment operator and copy-constructor
+    dmFlatHashTable(const dmFlatHashTable<KEY, T>&);
+    const dmFlatHashTable<KEY, T>& operator=(const dmFlatHashTable<KEY, T>&);
+
+    // Max number of used slots (including tombstones), 7/8 of the slots
+    static uint32_t MaxLoad(uint32_t slot_count)
+    {
+        return slot_count - slot_count / 8;
+    }
+
+    // The first GROUP_WIDTH control bytes are mirrored after the last slot, so that groups can be loaded from any slot
+    void SetCtrl(uint32_t index, int8_t ctrl)
+    {
+        m_Ctrl[index] = ctrl;
+        if (index < dmFlatHashTableInternal::GROUP_WIDTH)
+        {
+            m_Ctrl[m_SlotCount + index] = ctrl;
+        }
+    }
+
+    Entry* FindEntry(KEY key, uint64_t hash) const
+    {
+        if (m_Count == 0)
+            return 0;
+
+        const uint32_t mask = m_SlotCount - 1;
+        const int8_t h2 = (int8_t)(hash & 0x7F);
+        uint32_t pos = (uint32_t)(hash >> 7) & mask;
+        uint32_t stride = 0;
+        while (true)
+        {
+            dmFlatHashTableInternal::Group group(m_Ctrl + pos);
+            dmFlatHashTableInternal::GroupMask match = group.Match(h2);
+            while (match.Any())
+            {
+                uint32_t index = (pos + match.Lowest()) & mask;
+                if (m_Entries[index].m_Key == key)
+                    return &m_Entries[index];
+                match.ClearLowest();
+            }
+            if (group.MatchEmpty().Any())
+                return 0;
+
+            // Triangular probing visits every group when the slot count is a power of two
+            stride += dmFlatHashTableInternal::GROUP_WIDTH;
+            pos = (pos + stride) & mask;
+        }
+    }
+
+    uint32_t FindInsertSlot(uint64_t hash) const
+    {
+        const uint32_t mask = m_SlotCount - 1;
+        uint32_t pos = (uint32_t)(hash >> 7) & mask;
+        uint32_t stride = 0;
+        while (true)
+        {
+            dmFlatHashTableInternal::GroupMask mask_free = dmFlatHashTableInternal::Group(m_Ctrl + pos).MatchEmptyOrDeleted();
+            if (mask_free.Any())
+                return (pos + mask_free.Lowest()) & mask;
+
+            stride += dmFlatHashTableInternal::GROUP_WIDTH;
+            pos = (pos + stride) & mask;
+        }
+    }
+
+    void Rehash(uint32_t slot_count)
+    {
+        int8_t* old_ctrl = m_Ctrl;
+        Entry* old_entries = m_Entries;
+        uint32_t old_slot_count = m_SlotCount;
+
+        // One allocation: the control bytes, padded to 16 bytes, followed by the entries
+        uint32_t ctrl_size = (slot_count + dmFlatHashTableInternal::GROUP_WIDTH + 15) & ~15U;
+        m_Ctrl = (int8_t*) malloc(ctrl_size + sizeof(Entry) * slot_count);
+        m_Entries = (Entry*) ((uint8_t*)m_Ctrl + ctrl_size);
+        m_SlotCount = slot_count;
+        memset(m_Ctrl, dmFlatHashTableInternal::CTRL_EMPTY, slot_count + dmFlatHashTableInternal::GROUP_WIDTH);
+        m_GrowthLeft = MaxLoad(slot_count) - m_Count;
+
+        for (uint32_t i = 0; i < old_slot_count; ++i)
+        {
+            if (old_ctrl[i] >= 0)
+            {
+                uint64_t hash = dmFlatHashTableInternal::HashKey((uint64_t)old_entries[i].m_Key);
+                uint32_t index = FindInsertSlot(hash);
+                SetCtrl(index, (int8_t)(hash & 0x7F));
+                memcpy(&m_Entries[index], &old_entries[i], sizeof(Entry));
+            }
+        }
+
+        if (old_ctrl)
+        {
+            free(old_ctrl);
+        }
+    }
+
+    int8_t*     m_Ctrl;
+    Entry*      m_Entries;
+    uint32_t    m_SlotCount;
+    // Number of entries that can be inserted before running out of empty slots
+    uint32_t    m_GrowthLeft;
+    uint32_t    m_Capacity;
+    uint32_t    m_Count;
+};
+
+/**
+ * Specialized flat hash table with uint32_t as keys
+ */
+template <typename T>
+class dmFlatHashTable32 : public dmFlatHashTable<uint32_t, T> {};
+
+/**
+ * Specialized flat hash table with uint64_t as keys
+ */
+template <typename T>
+class dmFlatHashTable64 : public dmFlatHashTable<uint64_t, T> {};
+
+#endif // DM_FLAT_HASHTABLE_H
@@ -21,6 +21,7 @@
 #include "array.h"
 #include "index_pool.h"
 #include "align.h"
+#include <dlib/atomic.h>
 #include <dlib/dstrings.h>
 #include <dlib/mutex.h>
 #include <dlib/hashtable.h>
@@ -32,14 +33,21 @@ struct ReverseHashEntry
     uint16_t m_Length;
 };
 
+// The reverse hash strings are stored in large chunks, instead of one allocation each.
+// Erased strings are put in a free list per size class, and reused by strings of the same size class.
+// The known hashes are also kept in a lock free filter, so that hashing an already known string doesn't take the lock.
 struct ReverseHashContainer
 {
     static const size_t m_HashTableSize = 1024;
     static const size_t m_HashTableCapacity = 512;
-    static const size_t m_HashTableCapacityIncrement = 256;
     static const size_t m_HashStatesCapacity = 512;
     static const size_t m_HashStatesCapacityIncrement = 256;
 
+    static const uint32_t m_ChunkSize = 64 * 1024;
+    static const uint32_t m_Granularity = 8;
+    static const uint32_t m_SizeClassCount = (DMHASH_MAX_REVERSE_LENGTH + 1 + m_Granularity - 1) / m_Granularity + 1;
+    static const uint32_t m_FilterSize = 4096; // Must be a power of two
+
     dmMutex::HMutex                 m_Mutex;
     bool                            m_Enabled;
     dmHashTable32<ReverseHashEntry> m_HashTable32Entries;
@@ -47,10 +55,22 @@ struct ReverseHashContainer
     dmArray<ReverseHashEntry>       m_HashStates;
     dmIndexPool32                   m_HashStatesSlots;
 
+    dmArray<uint8_t*>               m_Chunks;
+    uint8_t*                        m_ChunkCursor;
+    uint8_t*                        m_ChunkEnd;
+    void*                           m_FreeStrings[m_SizeClassCount];
+
+    int32_atomic_t                  m_Filter32[m_FilterSize];
+    int32_atomic_t                  m_Filter64[m_FilterSize];
+
     ReverseHashContainer()
     {
         m_Mutex = dmMutex::New();
         m_Enabled = false;
+        m_ChunkCursor = 0;
+        m_ChunkEnd = 0;
+        memset(m_FreeStrings, 0, sizeof(m_FreeStrings));
+        ClearFilters();
     }
 
     ~ReverseHashContainer()
@@ -59,12 +79,6 @@ struct ReverseHashContainer
         dmMutex::Delete(m_Mutex);
     }
 
-    template <typename KEY>
-    static inline void FreeEntryCallback(void* context, const KEY* key, ReverseHashEntry* value)
-    {
-        free(value->m_Value);
-    }
-
     template <typename INDEX>
     static inline void FreeStateCallback(void* context, const INDEX index)
     {
@@ -97,10 +111,9 @@ struct ReverseHashContainer
         }
         else
         {
-            m_HashTable32Entries.Iterate(FreeEntryCallback, (void*) 0);
             m_HashTable32Entries.Clear();
-            m_HashTable64Entries.Iterate(FreeEntryCallback, (void*) 0);
             m_HashTable64Entries.Clear();
+            FreeStrings();
             if(m_HashStatesSlots.Size() != 0)
             {
                 m_HashStatesSlots.Push(0);
@@ -117,6 +130,123 @@ struct ReverseHashContainer
         }
     }
 
+    void FreeStrings()
+    {
+        for (uint32_t i = 0; i < m_Chunks.Size(); ++i)
+        {
+            free(m_Chunks[i]);
+        }
+        m_Chunks.SetCapacity(0);
+        m_ChunkCursor = 0;
+        m_ChunkEnd = 0;
+        memset(m_FreeStrings, 0, sizeof(m_FreeStrings));
+        ClearFilters();
+    }
+
+    static inline uint32_t GetSizeClass(uint32_t length)
+    {
+        return (length + 1 + m_Granularity - 1) / m_Granularity;
+    }
+
+    // Copies the string into the chunks, and null terminates it
+    char* AllocString(const void* value, uint32_t length)
+    {
+        uint32_t size_class = GetSizeClass(length);
+        uint8_t* p = (uint8_t*) m_FreeStrings[size_class];
+        if (p)
+        {
+            m_FreeStrings[size_class] = *(void**) p;
+        }
+        else
+        {
+            uint32_t size = size_class * m_Granularity;
+            if (m_ChunkCursor + size > m_ChunkEnd)
+            {
+                // The rest of the current chunk is left unused
+                m_ChunkCursor = (uint8_t*) malloc(m_ChunkSize);
+                m_ChunkEnd = m_ChunkCursor + m_ChunkSize;
+                m_Chunks.PushGrow(m_ChunkCursor);
+            }
+            p = m_ChunkCursor;
+            m_ChunkCursor += size;
+        }
+        memcpy(p, value, length);
+        p[length] = '\0';
+        return (char*) p;
+    }
+
+    void FreeString(void* value, uint32_t length)
+    {
+        uint32_t size_class = GetSizeClass(length);
+        *(void**) value = m_FreeStrings[size_class];
+        m_FreeStrings[size_class] = value;
+    }
+
+    // Returns the memory used by the strings, in bytes
+    uint32_t GetStringsMemoryUsage()
+    {
+        return m_Chunks.Size() * m_ChunkSize;
+    }
+
+    void ClearFilters()
+    {
+        for (uint32_t i = 0; i < m_FilterSize; ++i)
+        {
+            dmAtomicStore32(&m_Filter32[i], 0);
+            dmAtomicStore32(&m_Filter64[i], 0);
+        }
+    }
+
+    // The filter slot of a 64 bit hash holds the upper bits, which are never 0
+    static inline int32_t GetFilterValue64(uint64_t hash)
+    {
+        return (int32_t)((uint32_t)(hash >> 32) | 1);
+    }
+
+    // True if the hash is known to be in the table. It may still be in the table if false
+    bool IsKnown32(uint32_t hash)
+    {
+        return hash != 0 && dmAtomicGet32(&m_Filter32[hash & (m_FilterSize - 1)]) == (int32_t) hash;
+    }
+
+    bool IsKnown64(uint64_t hash)
+    {
+        return dmAtomicGet32(&m_Filter64[hash & (m_FilterSize - 1)]) == GetFilterValue64(hash);
+    }
+
+    void SetKnown32(uint32_t hash, bool known)
+    {
+        int32_atomic_t* slot = &m_Filter32[hash & (m_FilterSize - 1)];
+        if (known)
+            dmAtomicStore32(slot, (int32_t) hash);
+        else if (dmAtomicGet32(slot) == (int32_t) hash)
+            dmAtomicStore32(slot, 0);
+    }
+
+    void SetKnown64(uint64_t hash, bool known)
+    {
+        int32_atomic_t* slot = &m_Filter64[hash & (m_FilterSize - 1)];
+        int32_t value = GetFilterValue64(hash);
+        if (known)
+            dmAtomicStore32(slot, value);
+        else if (dmAtomicGet32(slot) == value)
+            dmAtomicStore32(slot, 0);
+    }
+
+    // Adds the string to the table (if it's not already there). Must be called with the mutex locked
+    template <typename TABLE, typename KEY>
+    void Put(TABLE* hash_table, KEY hash, const void* value, uint32_t length)
+    {
+        if (hash_table->Get(hash) != 0)
+            return;
+        if (hash_table->Full())
+        {
+            uint32_t capacity = hash_table->Capacity() * 2;
+            hash_table->SetCapacity(capacity / 2 + 1, capacity);
+        }
+        hash_table->Put(hash, ReverseHashEntry(AllocString(value, length), length));
+    }
+
     inline uint32_t AllocReverseHashStatesSlot()
     {
         if(m_HashStatesSlots.Remaining() == 0)
@@ -175,6 +305,12 @@ void dmHashEnableReverseHash(bool enable)
     dmHashContainer().Enable(enable);
 }
 
+uint32_t dmHashReverseMemoryUsage()
+{
+    DM_MUTEX_SCOPED_LOCK(dmHashContainer().m_Mutex);
+    return dmHashContainer().GetStringsMemoryUsage();
+}
+
 #define mmix(h,k) { k *= m; k ^= k >> r; k *= m; h *= m; h ^= k; }
 
 // Based on MurmurHash2A but endian neutral
@@ -226,21 +362,11 @@ uint32_t dmHashBuffer32(const void * key, uint32_t len)
 {
     uint32_t h = dmHashBufferNoReverse32(key, len);
 
-    if (dmHashContainer().m_Enabled && len <= DMHASH_MAX_REVERSE_LENGTH)
+    if (dmHashContainer().m_Enabled && len <= DMHASH_MAX_REVERSE_LENGTH && !dmHashContainer().IsKnown32(h))
     {
         DM_MUTEX_SCOPED_LOCK(dmHashContainer().m_Mutex);
-        dmHashTable32<ReverseHashEntry>* hash_table = &dmHashContainer().m_HashTable32Entries;
-        if (hash_table->Get(h) == 0)
-        {
-            if (hash_table->Full())
-            {
-                hash_table->SetCapacity(dmHashContainer().m_HashTableSize, hash_table->Capacity() + dmHashContainer().m_HashTableCapacityIncrement);
-            }
-            char* copy = (char*) malloc(len + 1);
-            memcpy(copy, key, len);
-            copy[len] = '\0';
-            hash_table->Put(h, ReverseHashEntry(copy, len));
-        }
+        dmHashContainer().Put(&dmHashContainer().m_HashTable32Entries, h, key, len);
+        dmHashContainer().SetKnown32(h, true);
     }
 
     return h;
@@ -303,21 +429,11 @@ uint64_t dmHashBuffer64(const void * key, uint32_t len)
 {
     uint64_t h = dmHashBufferNoReverse64(key, len);
 
-    if (dmHashContainer().m_Enabled && len <= DMHASH_MAX_REVERSE_LENGTH)
+    if (dmHashContainer().m_Enabled && len <= DMHASH_MAX_REVERSE_LENGTH && !dmHashContainer().IsKnown64(h))
     {
         DM_MUTEX_SCOPED_LOCK(dmHashContainer().m_Mutex);
-        dmHashTable64<ReverseHashEntry>* hash_table = &dmHashContainer().m_HashTable64Entries;
-        if (hash_table->Get(h) == 0)
-        {
-            if (hash_table->Full())
-            {
-                hash_table->SetCapacity(dmHashContainer().m_HashTableSize, hash_table->Capacity() + dmHashContainer().m_HashTableCapacityIncrement);
-            }
-            char* copy = (char*) malloc(len + 1);
-            memcpy(copy, key, len);
-            copy[len] = '\0';
-            hash_table->Put(h, ReverseHashEntry(copy, len));
-        }
+        dmHashContainer().Put(&dmHashContainer().m_HashTable64Entries, h, key, len);
+        dmHashContainer().SetKnown64(h, true);
     }
 
     return h;
@@ -433,19 +549,10 @@ uint32_t dmHashFinal32(HashState32* hash_state)
     if (dmHashContainer().m_Enabled && hash_state->m_ReverseHashEntryIndex && hash_state->m_Size <= DMHASH_MAX_REVERSE_LENGTH)
     {
         DM_MUTEX_SCOPED_LOCK(dmHashContainer().m_Mutex);
-        dmHashTable32<ReverseHashEntry>* hash_table = &dmHashContainer().m_HashTable32Entries;
-        if (hash_table->Get(hash_state->m_Hash) == 0)
-        {
-            if (hash_table->Full())
-            {
-                hash_table->SetCapacity(dmHashContainer().m_HashTableSize, hash_table->Capacity() + dmHashContainer().m_HashTableCapacityIncrement);
-            }
-            hash_table->Put(hash_state->m_Hash, dmHashContainer().m_HashStates[hash_state->m_ReverseHashEntryIndex]);
-        }
-        else
-        {
-            free(dmHashContainer().m_HashStates[hash_state->m_ReverseHashEntryIndex].m_Value);
-        }
+        ReverseHashEntry& state = dmHashContainer().m_HashStates[hash_state->m_ReverseHashEntryIndex];
+        dmHashContainer().Put(&dmHashContainer().m_HashTable32Entries, hash_state->m_Hash, state.m_Value, state.m_Length);
+        dmHashContainer().SetKnown32(hash_state->m_Hash, true);
+        free(state.m_Value);
         dmHashContainer().FreeReverseHashStatesSlot(hash_state->m_ReverseHashEntryIndex);
         hash_state->m_ReverseHashEntryIndex = 0;
     }
@@ -569,19 +676,10 @@ uint64_t dmHashFinal64(HashState64* hash_state)
     if (dmHashContainer().m_Enabled && hash_state->m_ReverseHashEntryIndex && hash_state->m_Size <= DMHASH_MAX_REVERSE_LENGTH)
     {
         DM_MUTEX_SCOPED_LOCK(dmHashContainer().m_Mutex);
-        dmHashTable64<ReverseHashEntry>* hash_table = &dmHashContainer().m_HashTable64Entries;
-        if (hash_table->Get(hash_state->m_Hash) == 0)
-        {
-            if (hash_table->Full())
-            {
-                hash_table->SetCapacity(dmHashContainer().m_HashTableSize, hash_table->Capacity() + dmHashContainer().m_HashTableCapacityIncrement);
-            }
-            hash_table->Put(hash_state->m_Hash, dmHashContainer().m_HashStates[hash_state->m_ReverseHashEntryIndex]);
-        }
-        else
-        {
-            free(dmHashContainer().m_HashStates[hash_state->m_ReverseHashEntryIndex].m_Value);
-        }
+        ReverseHashEntry& state = dmHashContainer().m_HashStates[hash_state->m_ReverseHashEntryIndex];
+        dmHashContainer().Put(&dmHashContainer().m_HashTable64Entries, hash_state->m_Hash, state.m_Value, state.m_Length);
+        dmHashContainer().SetKnown64(hash_state->m_Hash, true);
+        free(state.m_Value);
         dmHashContainer().FreeReverseHashStatesSlot(hash_state->m_ReverseHashEntryIndex);
         hash_state->m_ReverseHashEntryIndex = 0;
     }
@@ -694,9 +792,10 @@ DM_DLLEXPORT void dmHashReverseErase32(uint32_t hash)
         ReverseHashEntry* reverse = dmHashContainer().m_HashTable32Entries.Get(hash);
         if (reverse)
         {
-            free(reverse->m_Value);
+            dmHashContainer().FreeString(reverse->m_Value, reverse->m_Length);
             dmHashContainer().m_HashTable32Entries.Erase(hash);
         }
+        dmHashContainer().SetKnown32(hash, false);
     }
 }
 
@@ -708,9 +807,10 @@ DM_DLLEXPORT void dmHashReverseErase64(uint64_t hash)
         ReverseHashEntry* reverse = dmHashContainer().m_HashTable64Entries.Get(hash);
         if (reverse)
         {
-            free(reverse->m_Value);
+            dmHashContainer().FreeString(reverse->m_Value, reverse->m_Length);
             dmHashContainer().m_HashTable64Entries.Erase(hash);
         }
+        dmHashContainer().SetKnown64(hash, false);
     }
 }
 
@@ -49,6 +49,12 @@ DM_DLLEXPORT uint32_t dmHashBufferNoReverse32(const void* buffer, uint32_t buffe
  */
 DM_DLLEXPORT void dmHashEnableReverseHash(bool enable);
 
+/**
+ * Get the memory used by the reverse hash strings
+ * @return the size in bytes
+ */
+DM_DLLEXPORT uint32_t dmHashReverseMemoryUsage();
+
 
 /**
  * Reverse hash key entry removal.
@@ -0,0 +1,1002 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include "http2.h"
+#include "http2_hpack.h"
+#include "array.h"
+#include "log.h"
+#include "math.h"
+#include "time.h"
+#include <dlib/mutex.h>
+#include <dmsdk/dlib/profile.h>
+
+namespace dmHttp2
+{
+    const char* ALPN_PROTOCOL = "h2";
+
+    static const char CONNECTION_PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+    enum FrameType
+    {
+        FRAME_DATA              = 0,
+        FRAME_HEADERS           = 1,
+        FRAME_PRIORITY          = 2,
+        FRAME_RST_STREAM        = 3,
+        FRAME_SETTINGS          = 4,
+        FRAME_PUSH_PROMISE      = 5,
+        FRAME_PING              = 6,
+        FRAME_GOAWAY            = 7,
+        FRAME_WINDOW_UPDATE     = 8,
+        FRAME_CONTINUATION      = 9,
+    };
+
+    enum FrameFlag
+    {
+        FLAG_END_STREAM         = 0x1,
+        FLAG_ACK                = 0x1,
+        FLAG_END_HEADERS        = 0x4,
+        FLAG_PADDED             = 0x8,
+        FLAG_PRIORITY           = 0x20,
+    };
+
+    enum Setting
+    {
+        SETTINGS_HEADER_TABLE_SIZE      = 1,
+        SETTINGS_ENABLE_PUSH            = 2,
+        SETTINGS_MAX_CONCURRENT_STREAMS = 3,
+        SETTINGS_INITIAL_WINDOW_SIZE    = 4,
+        SETTINGS_MAX_FRAME_SIZE         = 5,
+        SETTINGS_MAX_HEADER_LIST_SIZE   = 6,
+    };
+
+    enum ErrorCode
+    {
+        ERROR_NO_ERROR          = 0,
+        ERROR_PROTOCOL_ERROR    = 1,
+        ERROR_FLOW_CONTROL_ERROR= 3,
+        ERROR_FRAME_SIZE_ERROR  = 6,
+        ERROR_REFUSED_STREAM    = 7,
+        ERROR_CANCEL            = 8,
+        ERROR_COMPRESSION_ERROR = 9,
+    };
+
+    const uint32_t FRAME_HEADER_SIZE = 9;
+    // We never raise SETTINGS_MAX_FRAME_SIZE, so this is the largest frame we accept
+    const uint32_t MAX_FRAME_SIZE = 16384;
+    const uint32_t DEFAULT_WINDOW_SIZE = 65535;
+    const int64_t  MAX_WINDOW_SIZE = 0x7fffffff;
+    // The receive windows we advertise. Data is buffered per stream until it's read,
+    // so the stream window is also the max amount of memory used by a stream
+    const uint32_t STREAM_WINDOW_SIZE = 1024 * 1024;
+    const uint32_t CONNECTION_WINDOW_SIZE = 16 * 1024 * 1024;
+    // Used until the peer tells us otherwise. The spec says unlimited
+    const uint32_t DEFAULT_MAX_CONCURRENT_STREAMS = 100;
+    const uint32_t MAX_HEADER_BLOCK_SIZE = 256 * 1024;
+    // The socket is polled with a short timeout, so that the reading thread soon lets the other threads send
+    const uint64_t READ_TIMEOUT = 20 * 1000;
+    const uint64_t SEND_TIMEOUT = 5 * 1000000;
+    // Room for a full frame, plus what's left of the previous read
+    const uint32_t READ_BUFFER_SIZE = 2 * (FRAME_HEADER_SIZE + MAX_FRAME_SIZE);
+
+    struct Stream
+    {
+        Stream(HStream id, uint32_t send_window)
+        {
+            m_Id = id;
+            m_SendWindow = send_window;
+            m_RecvWindow = STREAM_WINDOW_SIZE;
+            m_RecvConsumed = 0;
+            m_Status = 0;
+            m_DataOffset = 0;
+            m_HeadersDone = 0;
+            m_RemoteClosed = 0;
+            m_LocalClosed = 0;
+            m_Reset = 0;
+            m_Refused = 0;
+        }
+
+        HStream             m_Id;
+        int64_t             m_SendWindow;
+        int64_t             m_RecvWindow;
+        uint32_t            m_RecvConsumed; // Read, but not yet credited with a WINDOW_UPDATE
+        int                 m_Status;
+        dmArray<char>       m_Headers;      // The decoded response headers, as "name\0value\0..."
+        dmArray<uint8_t>    m_Data;         // Received data, from m_DataOffset
+        uint32_t            m_DataOffset;
+        uint32_t            m_HeadersDone:1;
+        uint32_t            m_RemoteClosed:1;
+        uint32_t            m_LocalClosed:1;
+        uint32_t            m_Reset:1;
+        uint32_t            m_Refused:1;
+    };
+
+    struct Session
+    {
+        dmSocket::Socket    m_Socket;
+        dmSSLSocket::Socket m_SSLSocket;
+
+        // m_Mutex protects the session and stream state. m_IOMutex is held while reading or writing the socket,
+        // as well as when touching the read buffer and the header block. m_IOMutex is always locked first.
+        dmMutex::HMutex     m_Mutex;
+        dmMutex::HMutex     m_IOMutex;
+
+        HpackDecoder        m_Decoder;
+        dmArray<Stream*>    m_Streams;
+        // Control frames (acks, WINDOW_UPDATE and RST_STREAM) are queued and sent by the next thread doing I/O
+        dmArray<uint8_t>    m_Control;
+        dmArray<uint8_t>    m_WriteBuffer;
+
+        // A header block, possibly split over several CONTINUATION frames
+        dmArray<uint8_t>    m_HeaderBlock;
+        dmArray<char>       m_DecodedHeaders;
+        HStream             m_HeaderStream;
+        uint8_t             m_HeaderFlags;
+        int                 m_HeaderStatus;
+
+        HStream             m_NextStreamId;
+        int64_t             m_SendWindow;
+        int64_t             m_RecvWindow;
+        uint32_t            m_RecvConsumed;
+        uint32_t            m_PeerInitialWindowSize;
+        uint32_t            m_PeerMaxFrameSize;
+        uint32_t            m_PeerMaxConcurrentStreams;
+        // Bumped after each read, so that a thread waiting for m_IOMutex knows that it should check its stream first
+        uint32_t            m_ReadGeneration;
+
+        uint32_t            m_ReadBufferSize;
+        uint8_t             m_ReadBuffer[READ_BUFFER_SIZE];
+
+        uint32_t            m_Alive:1;
+        uint32_t            m_GoAway:1;
+    };
+
+    static uint32_t ReadU32(const uint8_t* p)
+    {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+    }
+
+    static void PushU16(dmArray<uint8_t>& out, uint16_t v)
+    {
+        uint8_t b[2] = { (uint8_t)(v >> 8), (uint8_t)v };
+        out.OffsetCapacity(sizeof(b));
+        out.PushArray(b, sizeof(b));
+    }
+
+    static void PushU32(dmArray<uint8_t>& out, uint32_t v)
+    {
+        uint8_t b[4] = { (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+        out.OffsetCapacity(sizeof(b));
+        out.PushArray(b, sizeof(b));
+    }
+
+    static void PushFrameHeader(dmArray<uint8_t>& out, uint32_t length, uint8_t type, uint8_t flags, HStream stream)
+    {
+        uint8_t h[FRAME_HEADER_SIZE] = { (uint8_t)(length >> 16), (uint8_t)(length >> 8), (uint8_t)length, type, flags,
+                                         (uint8_t)((stream >> 24) & 0x7f), (uint8_t)(stream >> 16), (uint8_t)(stream >> 8), (uint8_t)stream };
+        out.OffsetCapacity(sizeof(h));
+        out.PushArray(h, sizeof(h));
+    }
+
+    static void PushData(dmArray<uint8_t>& out, const void* data, uint32_t size)
+    {
+        out.OffsetCapacity(size);
+        out.PushArray((const uint8_t*)data, size);
+    }
+
+    static void PushString(dmArray<char>& out, const char* str)
+    {
+        uint32_t size = strlen(str) + 1;
+        out.OffsetCapacity(size);
+        out.PushArray(str, size);
+    }
+
+    static void QueueWindowUpdate(Session* s, HStream stream, uint32_t increment)
+    {
+        PushFrameHeader(s->m_Control, 4, FRAME_WINDOW_UPDATE, 0, stream);
+        PushU32(s->m_Control, increment);
+    }
+
+    static void QueueRstStream(Session* s, HStream stream, uint32_t error_code)
+    {
+        PushFrameHeader(s->m_Control, 4, FRAME_RST_STREAM, 0, stream);
+        PushU32(s->m_Control, error_code);
+    }
+
+    static void QueueGoAway(Session* s, uint32_t error_code)
+    {
+        PushFrameHeader(s->m_Control, 8, FRAME_GOAWAY, 0, 0);
+        PushU32(s->m_Control, 0); // We never accept streams from the server
+        PushU32(s->m_Control, error_code);
+    }
+
+    // Called with m_Mutex held
+    static bool ConnectionError(Session* s, uint32_t error_code, const char* reason)
+    {
+        dmLogWarning("HTTP/2 connection error: %s", reason);
+        if (s->m_Alive)
+        {
+            QueueGoAway(s, error_code);
+            s->m_Alive = 0;
+        }
+        return false;
+    }
+
+    static Stream* FindStream(Session* s, HStream id)
+    {
+        uint32_t n = s->m_Streams.Size();
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            if (s->m_Streams[i]->m_Id == id)
+                return s->m_Streams[i];
+        }
+        return 0;
+    }
+
+    // Credit data that has been read (or discarded) back to the peer. Called with m_Mutex held
+    static void ConsumeConnection(Session* s, uint32_t size)
+    {
+        s->m_RecvConsumed += size;
+        if (s->m_RecvConsumed >= CONNECTION_WINDOW_SIZE / 2)
+        {
+            QueueWindowUpdate(s, 0, s->m_RecvConsumed);
+            s->m_RecvWindow += s->m_RecvConsumed;
+            s->m_RecvConsumed = 0;
+        }
+    }
+
+    static void ConsumeStream(Session* s, Stream* stream, uint32_t size)
+    {
+        stream->m_RecvConsumed += size;
+        if (!stream->m_RemoteClosed && stream->m_RecvConsumed >= STREAM_WINDOW_SIZE / 2)
+        {
+            QueueWindowUpdate(s, stream->m_Id, stream->m_RecvConsumed);
+            stream->m_RecvWindow += stream->m_RecvConsumed;
+            stream->m_RecvConsumed = 0;
+        }
+        ConsumeConnection(s, size);
+    }
+
+    // Called with m_IOMutex held
+    static bool SendAll(Session* s, const uint8_t* data, uint32_t size)
+    {
+        uint64_t start = dmTime::GetTime();
+        while (size > 0)
+        {
+            int sent = 0;
+            dmSocket::Result r;
+            if (s->m_SSLSocket)
+                r = dmSSLSocket::Send(s->m_SSLSocket, data, (int)size, &sent);
+            else
+                r = dmSocket::Send(s->m_Socket, data, (int)size, &sent);
+
+            if (r == dmSocket::RESULT_OK)
+            {
+                data += sent;
+                size -= (uint32_t)sent;
+            }
+            else if (r != dmSocket::RESULT_TRY_AGAIN && r != dmSocket::RESULT_WOULDBLOCK)
+            {
+                return false;
+            }
+            else if (dmTime::GetTime() - start > SEND_TIMEOUT)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Called with m_IOMutex held. A partially sent frame can't be recovered from, so any error closes the session
+    static bool Send(Session* s, const dmArray<uint8_t>& data)
+    {
+        if (data.Empty())
+            return true;
+        if (SendAll(s, data.Begin(), data.Size()))
+            return true;
+
+        DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+        if (s->m_Alive)
+            dmLogWarning("HTTP/2 connection lost while sending");
+        s->m_Alive = 0;
+        return false;
+    }
+
+    // Called with m_IOMutex held
+    static bool FlushControl(Session* s)
+    {
+        {
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+            if (s->m_Control.Empty())
+                return true;
+            s->m_WriteBuffer.SetSize(0);
+            s->m_WriteBuffer.Swap(s->m_Control);
+        }
+        return Send(s, s->m_WriteBuffer);
+    }
+
+    static void OnHeader(void* ctx, const char* name, const char* value)
+    {
+        Session* s = (Session*)ctx;
+        if (name[0] == ':')
+        {
+            if (strcmp(name, ":status") == 0)
+                s->m_HeaderStatus = atoi(value);
+            return;
+        }
+        PushString(s->m_DecodedHeaders, name);
+        PushString(s->m_DecodedHeaders, value);
+    }
+
+    static bool FinishHeaderBlock(Session* s)
+    {
+        s->m_DecodedHeaders.SetSize(0);
+        s->m_HeaderStatus = 0;
+        // The block is always decoded, even for a closed stream, to keep the dynamic table in sync
+        if (!HpackDecode(&s->m_Decoder, s->m_HeaderBlock.Begin(), s->m_HeaderBlock.Size(), OnHeader, s))
+            return ConnectionError(s, ERROR_COMPRESSION_ERROR, "malformed header block");
+
+        Stream* stream = FindStream(s, s->m_HeaderStream);
+        s->m_HeaderStream = 0;
+        if (!stream || stream->m_Reset)
+            return true;
+
+        if (!stream->m_HeadersDone)
+        {
+            if (s->m_HeaderStatus >= 100 && s->m_HeaderStatus < 200)
+            {
+                // Informational response, the final response follows
+            }
+            else if (s->m_HeaderStatus == 0)
+            {
+                QueueRstStream(s, stream->m_Id, ERROR_PROTOCOL_ERROR);
+                stream->m_Reset = 1;
+                return true;
+            }
+            else
+            {
+                stream->m_Status = s->m_HeaderStatus;
+                stream->m_Headers.Swap(s->m_DecodedHeaders);
+                stream->m_HeadersDone = 1;
+            }
+        }
+        // else: the trailers, which we don't support
+
+        if (s->m_HeaderFlags & FLAG_END_STREAM)
+            stream->m_RemoteClosed = 1;
+        return true;
+    }
+
+    static bool AppendHeaderBlock(Session* s, const uint8_t* data, uint32_t size)
+    {
+        if (s->m_HeaderBlock.Size() + size > MAX_HEADER_BLOCK_SIZE)
+            return ConnectionError(s, ERROR_PROTOCOL_ERROR, "header block too large");
+        PushData(s->m_HeaderBlock, data, size);
+        return true;
+    }
+
+    // Removes the padding from a DATA or HEADERS frame
+    static bool RemovePadding(Session* s, uint8_t flags, const uint8_t** payload, uint32_t* length)
+    {
+        if (!(flags & FLAG_PADDED))
+            return true;
+        if (*length < 1 || (*payload)[0] >= *length)
+            return ConnectionError(s, ERROR_PROTOCOL_ERROR, "invalid padding");
+        *length -= 1 + (*payload)[0];
+        *payload += 1;
+        return true;
+    }
+
+    static bool ProcessData(Session* s, uint8_t flags, HStream id, const uint8_t* payload, uint32_t length)
+    {
+        if (id == 0)
+            return ConnectionError(s, ERROR_PROTOCOL_ERROR, "DATA on stream 0");
+
+        uint32_t flow_length = length;
+        s->m_RecvWindow -= flow_length;
+        if (s->m_RecvWindow < 0)
+            return ConnectionError(s, ERROR_FLOW_CONTROL_ERROR, "connection window exceeded");
+
+        if (!RemovePadding(s, flags, &payload, &length))
+            return false;
+
+        Stream* stream = FindStream(s, id);
+        if (!stream || stream->m_RemoteClosed || stream->m_Reset)
+        {
+            if (!stream && id >= s->m_NextStreamId)
+                return ConnectionError(s, ERROR_PROTOCOL_ERROR, "DATA on idle stream");
+            // A stream we've closed. Nobody will read it, so it's credited back at once
+            ConsumeConnection(s, flow_length);
+            return true;
+        }
+
+        stream->m_RecvWindow -= flow_length;
+        if (stream->m_RecvWindow < 0)
+            return ConnectionError(s, ERROR_FLOW_CONTROL_ERROR, "stream window exceeded");
+
+        if (length > 0)
+        {
+            // Compact the buffer before growing it
+            if (stream->m_DataOffset > 0 && stream->m_Data.Remaining() < length)
+            {
+                uint32_t left = stream->m_Data.Size() - stream->m_DataOffset;
+                memmove(stream->m_Data.Begin(), stream->m_Data.Begin() + stream->m_DataOffset, left);
+                stream->m_Data.SetSize(left);
+                stream->m_DataOffset = 0;
+            }
+            PushData(stream->m_Data, payload, length);
+        }
+        // The padding is never read
+        ConsumeStream(s, stream, flow_length - length);
+
+        if (flags & FLAG_END_STREAM)
+            stream->m_RemoteClosed = 1;
+        return true;
+    }
+
+    static bool ProcessSettings(Session* s, uint8_t flags, HStream id, const uint8_t* payload, uint32_t length)
+    {
+        if (id != 0)
+            return ConnectionError(s, ERROR_PROTOCOL_ERROR, "SETTINGS on a stream");
+        if (flags & FLAG_ACK)
+            return true;
+        if (length % 6 != 0)
+            return ConnectionError(s, ERROR_FRAME_SIZE_ERROR, "invalid SETTINGS size");
+
+        for (uint32_t i = 0; i < length; i += 6)
+        {
+            uint16_t setting = (uint16_t)((payload[i] << 8) | payload[i+1]);
+            uint32_t value = ReadU32(payload + i + 2);
+            switch (setting)
+            {
+            case SETTINGS_MAX_CONCURRENT_STREAMS:
+                s->m_PeerMaxConcurrentStreams = value;
+                break;
+            case SETTINGS_INITIAL_WINDOW_SIZE:
+                {
+                    if (value > MAX_WINDOW_SIZE)
+                        return ConnectionError(s, ERROR_FLOW_CONTROL_ERROR, "invalid initial window size");
+                    // The change applies to all the open streams
+                    int64_t delta = (int64_t)value - (int64_t)s->m_PeerInitialWindowSize;
+                    for (uint32_t j = 0; j < s->m_Streams.Size(); ++j)
+                        s->m_Streams[j]->m_SendWindow += delta;
+                    s->m_PeerInitialWindowSize = value;
+                }
+                break;
+            case SETTINGS_MAX_FRAME_SIZE:
+                if (value < MAX_FRAME_SIZE || value > 0xffffff)
+                    return ConnectionError(s, ERROR_PROTOCOL_ERROR, "invalid max frame size");
+                s->m_PeerMaxFrameSize = value;
+                break;
+            default:
+                // The header table size only applies to an encoder that indexes, and we don't.
+                break;
+            }
+        }
+
+        PushFrameHeader(s->m_Control, 0, FRAME_SETTINGS, FLAG_ACK, 0);
+        return true;
+    }
+
+    static bool ProcessFrame(Session* s, uint8_t type, uint8_t flags, HStream id, const uint8_t* payload, uint32_t length)
+    {
+        if (s->m_HeaderStream != 0 && type != FRAME_CONTINUATION)
+            return ConnectionError(s, ERROR_PROTOCOL_ERROR, "expected CONTINUATION");
+
+        switch (type)
+        {
+        case FRAME_DATA:
+            return ProcessData(s, flags, id, payload, length);
+
+        case FRAME_HEADERS:
+            if (id == 0)
+                return ConnectionError(s, ERROR_PROTOCOL_ERROR, "HEADERS on stream 0");
+            if (!RemovePadding(s, flags, &payload, &length))
+                return false;
+            if (flags & FLAG_PRIORITY)
+            {
+                if (length < 5)
+                    return ConnectionError(s, ERROR_FRAME_SIZE_ERROR, "invalid HEADERS size");
+                payload += 5;
+                length -= 5;
+            }
+            s->m_HeaderBlock.SetSize(0);
+            s->m_HeaderStream = id;
+            s->m_HeaderFlags = flags;
+            if (!AppendHeaderBlock(s, payload, length))
+                return false;
+            return (flags & FLAG_END_HEADERS) ? FinishHeaderBlock(s) : true;
+
+        case FRAME_CONTINUATION:
+            if (id == 0 || id != s->m_HeaderStream)
+                return ConnectionError(s, ERROR_PROTOCOL_ERROR, "unexpected CONTINUATION");
+            if (!AppendHeaderBlock(s, payload, length))
+                return false;
+            return (flags & FLAG_END_HEADERS) ? FinishHeaderBlock(s) : true;
+
+        case FRAME_RST_STREAM:
+            {
+                if (id == 0 || length != 4)
+                    return ConnectionError(s, ERROR_PROTOCOL_ERROR, "invalid RST_STREAM");
+                Stream* stream = FindStream(s, id);
+                if (stream)
+                {
+                    stream->m_Reset = 1;
+                    stream->m_Refused = ReadU32(payload) == ERROR_REFUSED_STREAM;
+                }
+                return true;
+            }
+
+        case FRAME_SETTINGS:
+            return ProcessSettings(s, flags, id, payload, length);
+
+        case FRAME_PUSH_PROMISE:
+            // We disable push in our SETTINGS
+            return ConnectionError(s, ERROR_PROTOCOL_ERROR, "unexpected PUSH_PROMISE");
+
+        case FRAME_PING:
+            if (id != 0 || length != 8)
+                return ConnectionError(s, ERROR_FRAME_SIZE_ERROR, "invalid PING");
+            if (!(flags & FLAG_ACK))
+            {
+                PushFrameHeader(s->m_Control, 8, FRAME_PING, FLAG_ACK, 0);
+                PushData(s->m_Control, payload, 8);
+            }
+            return true;
+
+        case FRAME_GOAWAY:
+            {
+                if (id != 0 || length < 8)
+                    return ConnectionError(s, ERROR_FRAME_SIZE_ERROR, "invalid GOAWAY");
+                // The streams after the last one weren't processed, and may be retried on a new connection
+                HStream last_stream = ReadU32(payload) & 0x7fffffff;
+                s->m_GoAway = 1;
+                for (uint32_t i = 0; i < s->m_Streams.Size(); ++i)
+                {
+                    Stream* stream = s->m_Streams[i];
+                    if (stream->m_Id > last_stream)
+                    {
+                        stream->m_Reset = 1;
+                        stream->m_Refused = 1;
+                    }
+                }
+                return true;
+            }
+
+        case FRAME_WINDOW_UPDATE:
+            {
+                if (length != 4)
+                    return ConnectionError(s, ERROR_FRAME_SIZE_ERROR, "invalid WINDOW_UPDATE");
+                uint32_t increment = ReadU32(payload) & 0x7fffffff;
+                if (id == 0)
+                {
+                    s->m_SendWindow += increment;
+                    if (increment == 0 || s->m_SendWindow > MAX_WINDOW_SIZE)
+                        return ConnectionError(s, ERROR_FLOW_CONTROL_ERROR, "invalid connection window update");
+                    return true;
+                }
+                Stream* stream = FindStream(s, id);
+                if (stream)
+                {
+                    stream->m_SendWindow += increment;
+                    if (increment == 0 || stream->m_SendWindow > MAX_WINDOW_SIZE)
+                    {
+                        QueueRstStream(s, id, ERROR_FLOW_CONTROL_ERROR);
+                        stream->m_Reset = 1;
+                    }
+                }
+                return true;
+            }
+
+        default:
+            // PRIORITY and unknown frame types are ignored
+            return true;
+        }
+    }
+
+    // Called with both mutexes held
+    static void ProcessFrames(Session* s)
+    {
+        uint32_t offset = 0;
+        while (s->m_Alive && s->m_ReadBufferSize - offset >= FRAME_HEADER_SIZE)
+        {
+            const uint8_t* h = s->m_ReadBuffer + offset;
+            uint32_t length = ((uint32_t)h[0] << 16) | ((uint32_t)h[1] << 8) | (uint32_t)h[2];
+            if (length > MAX_FRAME_SIZE)
+            {
+                ConnectionError(s, ERROR_FRAME_SIZE_ERROR, "frame too large");
+                break;
+            }
+            if (s->m_ReadBufferSize - offset < FRAME_HEADER_SIZE + length)
+                break;
+
+            HStream id = ReadU32(h + 5) & 0x7fffffff;
+            ProcessFrame(s, h[3], h[4], id, h + FRAME_HEADER_SIZE, length);
+            offset += FRAME_HEADER_SIZE + length;
+        }
+
+        memmove(s->m_ReadBuffer, s->m_ReadBuffer + offset, s->m_ReadBufferSize - offset);
+        s->m_ReadBufferSize -= offset;
+    }
+
+    // Reads from the socket once and processes the received frames. Called without any locks held
+    static void Pump(Session* s, uint32_t generation)
+    {
+        DM_PROFILE("Http2Pump");
+        DM_MUTEX_SCOPED_LOCK(s->m_IOMutex);
+        {
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+            // Another thread read while we were waiting for the lock, so let our caller check its stream first
+            if (generation != s->m_ReadGeneration || !s->m_Alive)
+                return;
+        }
+
+        if (!FlushControl(s))
+            return;
+
+        int received = 0;
+        int max_to_recv = (int)(READ_BUFFER_SIZE - s->m_ReadBufferSize);
+        dmSocket::Result r;
+        if (s->m_SSLSocket)
+            r = dmSSLSocket::Receive(s->m_SSLSocket, s->m_ReadBuffer + s->m_ReadBufferSize, max_to_recv, &received);
+        else
+            r = dmSocket::Receive(s->m_Socket, s->m_ReadBuffer + s->m_ReadBufferSize, max_to_recv, &received);
+
+        {
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+            s->m_ReadGeneration++;
+            if (r == dmSocket::RESULT_WOULDBLOCK || r == dmSocket::RESULT_TRY_AGAIN)
+                return;
+            if (r != dmSocket::RESULT_OK || received == 0)
+            {
+                if (s->m_Alive)
+                    dmLogWarning("HTTP/2 connection lost (%s)", r == dmSocket::RESULT_OK ? "closed by peer" : dmSocket::ResultToString(r));
+                s->m_Alive = 0;
+                return;
+            }
+
+            s->m_ReadBufferSize += (uint32_t)received;
+            ProcessFrames(s);
+        }
+
+        // Send the acks at once. This also sends our GOAWAY on a connection error
+        FlushControl(s);
+    }
+
+    // Sends the queued control frames, unless another thread is doing I/O (it will send them instead)
+    static void TryFlushControl(Session* s)
+    {
+        if (dmMutex::TryLock(s->m_IOMutex))
+        {
+            FlushControl(s);
+            dmMutex::Unlock(s->m_IOMutex);
+        }
+    }
+
+    HSession New(dmSocket::Socket socket, dmSSLSocket::Socket sslsocket)
+    {
+        Session* s = new Session;
+        s->m_Socket = socket;
+        s->m_SSLSocket = sslsocket;
+        s->m_Mutex = dmMutex::New();
+        s->m_IOMutex = dmMutex::New();
+        s->m_HeaderStream = 0;
+        s->m_HeaderFlags = 0;
+        s->m_HeaderStatus = 0;
+        s->m_NextStreamId = 1;
+        s->m_SendWindow = DEFAULT_WINDOW_SIZE;
+        s->m_RecvWindow = CONNECTION_WINDOW_SIZE;
+        s->m_RecvConsumed = 0;
+        s->m_PeerInitialWindowSize = DEFAULT_WINDOW_SIZE;
+        s->m_PeerMaxFrameSize = MAX_FRAME_SIZE;
+        s->m_PeerMaxConcurrentStreams = DEFAULT_MAX_CONCURRENT_STREAMS;
+        s->m_ReadGeneration = 0;
+        s->m_ReadBufferSize = 0;
+        s->m_Alive = 1;
+        s->m_GoAway = 0;
+
+        dmSocket::SetReceiveTimeout(socket, READ_TIMEOUT);
+        if (sslsocket)
+            dmSSLSocket::SetReceiveTimeout(sslsocket, READ_TIMEOUT);
+
+        dmArray<uint8_t> preface;
+        PushData(preface, CONNECTION_PREFACE, sizeof(CONNECTION_PREFACE) - 1);
+        PushFrameHeader(preface, 12, FRAME_SETTINGS, 0, 0);
+        PushU16(preface, SETTINGS_ENABLE_PUSH);
+        PushU32(preface, 0);
+        PushU16(preface, SETTINGS_INITIAL_WINDOW_SIZE);
+        PushU32(preface, STREAM_WINDOW_SIZE);
+        PushFrameHeader(preface, 4, FRAME_WINDOW_UPDATE, 0, 0);
+        PushU32(preface, CONNECTION_WINDOW_SIZE - DEFAULT_WINDOW_SIZE);
+
+        bool sent;
+        {
+            DM_MUTEX_SCOPED_LOCK(s->m_IOMutex);
+            sent = Send(s, preface);
+        }
+        if (!sent)
+        {
+            Delete(s);
+            return 0;
+        }
+        return s;
+    }
+
+    void Delete(HSession s)
+    {
+        {
+            DM_MUTEX_SCOPED_LOCK(s->m_IOMutex);
+            {
+                DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+                if (s->m_Alive)
+                    QueueGoAway(s, ERROR_NO_ERROR);
+                s->m_Alive = 0;
+            }
+            FlushControl(s);
+        }
+
+        for (uint32_t i = 0; i < s->m_Streams.Size(); ++i)
+            delete s->m_Streams[i];
+        dmMutex::Delete(s->m_IOMutex);
+        dmMutex::Delete(s->m_Mutex);
+        delete s;
+    }
+
+    bool IsAlive(HSession s)
+    {
+        DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+        return s->m_Alive && !s->m_GoAway;
+    }
+
+    bool IsUsable(HSession s)
+    {
+        DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+        return s->m_Alive && !s->m_GoAway && s->m_Streams.Size() < s->m_PeerMaxConcurrentStreams && s->m_NextStreamId < 0x7fffffff;
+    }
+
+    Result OpenStream(HSession s, const Header* headers, uint32_t count, bool end_stream, HStream* out)
+    {
+        DM_PROFILE("Http2OpenStream");
+        dmArray<uint8_t> block;
+        for (uint32_t i = 0; i < count; ++i)
+            HpackEncode(block, headers[i].m_Name, headers[i].m_Value);
+
+        // The stream ids must be sent in increasing order, so the id is allocated while holding the I/O lock
+        DM_MUTEX_SCOPED_LOCK(s->m_IOMutex);
+        Stream* stream;
+        uint32_t max_frame_size;
+        {
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+            if (!s->m_Alive)
+                return RESULT_SOCKET_ERROR;
+            if (s->m_GoAway)
+                return RESULT_REFUSED;
+            if (s->m_Streams.Size() >= s->m_PeerMaxConcurrentStreams)
+                return RESULT_OUT_OF_RESOURCES;
+
+            stream = new Stream(s->m_NextStreamId, s->m_PeerInitialWindowSize);
+            stream->m_LocalClosed = end_stream ? 1 : 0;
+            s->m_NextStreamId += 2;
+            s->m_Streams.OffsetCapacity(1);
+            s->m_Streams.Push(stream);
+            max_frame_size = s->m_PeerMaxFrameSize;
+        }
+        *out = stream->m_Id;
+
+        if (!FlushControl(s))
+            return RESULT_SOCKET_ERROR;
+
+        // The HEADERS frame, followed by CONTINUATION frames if the block doesn't fit
+        s->m_WriteBuffer.SetSize(0);
+        uint32_t offset = 0;
+        do
+        {
+            uint32_t size = dmMath::Min(block.Size() - offset, max_frame_size);
+            uint8_t type = offset == 0 ? FRAME_HEADERS : FRAME_CONTINUATION;
+            uint8_t flags = offset + size == block.Size() ? FLAG_END_HEADERS : 0;
+            if (offset == 0 && end_stream)
+                flags |= FLAG_END_STREAM;
+            PushFrameHeader(s->m_WriteBuffer, size, type, flags, stream->m_Id);
+            PushData(s->m_WriteBuffer, block.Begin() + offset, size);
+            offset += size;
+        } while (offset < block.Size());
+
+        return Send(s, s->m_WriteBuffer) ? RESULT_OK : RESULT_SOCKET_ERROR;
+    }
+
+    Result SendData(HSession s, HStream id, const void* data, uint32_t size, bool end_stream, uint32_t* sent)
+    {
+        *sent = 0;
+        uint32_t generation;
+        {
+            DM_MUTEX_SCOPED_LOCK(s->m_IOMutex);
+            Stream* stream;
+            uint32_t chunk;
+            {
+                DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+                stream = FindStream(s, id);
+                if (!stream || stream->m_LocalClosed)
+                    return RESULT_PROTOCOL_ERROR;
+                if (stream->m_Reset)
+                    return stream->m_Refused ? RESULT_REFUSED : RESULT_STREAM_RESET;
+                if (!s->m_Alive)
+                    return RESULT_SOCKET_ERROR;
+
+                int64_t window = dmMath::Min(s->m_SendWindow, stream->m_SendWindow);
+                chunk = (uint32_t)dmMath::Max((int64_t)0, dmMath::Min((int64_t)size, dmMath::Min(window, (int64_t)s->m_PeerMaxFrameSize)));
+                s->m_SendWindow -= chunk;
+                stream->m_SendWindow -= chunk;
+                generation = s->m_ReadGeneration;
+            }
+
+            if (chunk > 0 || size == 0)
+            {
+                if (!FlushControl(s))
+                    return RESULT_SOCKET_ERROR;
+
+                bool last = end_stream && chunk == size;
+                s->m_WriteBuffer.SetSize(0);
+                PushFrameHeader(s->m_WriteBuffer, chunk, FRAME_DATA, last ? FLAG_END_STREAM : 0, id);
+                PushData(s->m_WriteBuffer, data, chunk);
+                if (!Send(s, s->m_WriteBuffer))
+                    return RESULT_SOCKET_ERROR;
+
+                *sent = chunk;
+                if (last)
+                {
+                    DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+                    stream->m_LocalClosed = 1;
+                }
+                if (chunk == size)
+                    return RESULT_OK;
+                return RESULT_WOULDBLOCK;
+            }
+        }
+
+        // The flow control windows are full. Wait for a WINDOW_UPDATE
+        Pump(s, generation);
+        return RESULT_WOULDBLOCK;
+    }
+
+    Result ReceiveHeaders(HSession s, HStream id, int* status, FHeader callback, void* ctx)
+    {
+        Stream* stream;
+        uint32_t generation = 0;
+        {
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+            stream = FindStream(s, id);
+            if (!stream)
+                return RESULT_PROTOCOL_ERROR;
+            if (!stream->m_HeadersDone)
+            {
+                if (stream->m_Reset)
+                    return stream->m_Refused ? RESULT_REFUSED : RESULT_STREAM_RESET;
+                if (!s->m_Alive)
+                    return RESULT_SOCKET_ERROR;
+                generation = s->m_ReadGeneration;
+            }
+        }
+
+        if (stream->m_HeadersDone)
+        {
+            // The headers are never changed once they're done, so the callback is called without the lock
+            *status = stream->m_Status;
+            const char* p = stream->m_Headers.Begin();
+            const char* end = stream->m_Headers.End();
+            while (p < end)
+            {
+                const char* name = p;
+                const char* value = name + strlen(name) + 1;
+                callback(ctx, name, value);
+                p = value + strlen(value) + 1;
+            }
+            return RESULT_OK;
+        }
+
+        Pump(s, generation);
+        return RESULT_WOULDBLOCK;
+    }
+
+    Result ReceiveData(HSession s, HStream id, void* buffer, uint32_t size, uint32_t* received, bool* end)
+    {
+        *received = 0;
+        *end = false;
+        uint32_t generation;
+        bool flush = false;
+        {
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+            Stream* stream = FindStream(s, id);
+            if (!stream)
+                return RESULT_PROTOCOL_ERROR;
+
+            uint32_t available = stream->m_Data.Size() - stream->m_DataOffset;
+            if (available > 0)
+            {
+                uint32_t n = dmMath::Min(available, size);
+                memcpy(buffer, stream->m_Data.Begin() + stream->m_DataOffset, n);
+                stream->m_DataOffset += n;
+                if (stream->m_DataOffset == stream->m_Data.Size())
+                {
+                    stream->m_Data.SetSize(0);
+                    stream->m_DataOffset = 0;
+                }
+                ConsumeStream(s, stream, n);
+                *received = n;
+                *end = stream->m_RemoteClosed && stream->m_Data.Empty();
+                flush = !s->m_Control.Empty();
+            }
+            else if (stream->m_RemoteClosed)
+            {
+                *end = true;
+                return RESULT_OK;
+            }
+            else if (stream->m_Reset)
+            {
+                return stream->m_Refused ? RESULT_REFUSED : RESULT_STREAM_RESET;
+            }
+            else if (!s->m_Alive)
+            {
+                return RESULT_SOCKET_ERROR;
+            }
+            generation = s->m_ReadGeneration;
+        }
+
+        if (*received > 0)
+        {
+            // Let the peer know as soon as possible that there's room for more data
+            if (flush)
+                TryFlushControl(s);
+            return RESULT_OK;
+        }
+
+        Pump(s, generation);
+        return RESULT_WOULDBLOCK;
+    }
+
+    void CloseStream(HSession s, HStream id)
+    {
+        bool reset = false;
+        {
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+            Stream* stream = 0;
+            for (uint32_t i = 0; i < s->m_Streams.Size(); ++i)
+            {
+                if (s->m_Streams[i]->m_Id == id)
+                {
+                    stream = s->m_Streams[i];
+                    s->m_Streams.EraseSwap(i);
+                    break;
+                }
+            }
+            if (!stream)
+                return;
+
+            if (s->m_Alive && !stream->m_Reset && !(stream->m_RemoteClosed && stream->m_LocalClosed))
+            {
+                QueueRstStream(s, id, ERROR_CANCEL);
+                reset = true;
+            }
+            // Data that was never read
+            ConsumeConnection(s, stream->m_Data.Size() - stream->m_DataOffset);
+            delete stream;
+        }
+
+        if (reset)
+        {
+            DM_MUTEX_SCOPED_LOCK(s->m_IOMutex);
+            FlushControl(s);
+        }
+    }
+}
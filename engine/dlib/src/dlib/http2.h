@@ -0,0 +1,124 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_HTTP2_H
+#define DM_HTTP2_H
+
+#include <stdint.h>
+#include <dlib/socket.h>
+#include <dlib/sslsocket.h>
+
+/**
+ * HTTP/2 client session (RFC 7540). Multiplexes several requests over a single connection.
+ *
+ * All functions are thread safe, and the streams of a session may be used from different threads.
+ * There is no background thread, instead the threads waiting for a stream take turns reading from
+ * the socket. The waiting functions return RESULT_WOULDBLOCK after each read attempt so that the
+ * caller can check its own timeouts and the cancel flag.
+ */
+namespace dmHttp2
+{
+    /// The ALPN protocol id
+    extern const char* ALPN_PROTOCOL;
+
+    enum Result
+    {
+        RESULT_OK = 0,
+        RESULT_WOULDBLOCK = 1,          //!< Nothing yet. Call again
+        RESULT_SOCKET_ERROR = -1,       //!< The connection is lost
+        RESULT_PROTOCOL_ERROR = -2,     //!< The peer violated the protocol. The session is closed
+        RESULT_STREAM_RESET = -3,       //!< The peer reset the stream
+        RESULT_REFUSED = -4,            //!< The stream wasn't processed by the peer, and may be retried on a new connection
+        RESULT_OUT_OF_RESOURCES = -5,   //!< Too many concurrent streams
+    };
+
+    typedef struct Session* HSession;
+    typedef uint32_t HStream;
+
+    struct Header
+    {
+        const char* m_Name;
+        const char* m_Value;
+    };
+
+    /**
+     * Called for each response header. The strings are only valid during the call.
+     */
+    typedef void (*FHeader)(void* ctx, const char* name, const char* value);
+
+    /**
+     * Create a new session on a connected socket, and send the connection preface.
+     * The session doesn't own the sockets.
+     * @param socket the socket
+     * @param sslsocket the secure socket, or 0 for a plain connection (prior knowledge)
+     * @return the session, or 0 if the preface couldn't be sent
+     */
+    HSession New(dmSocket::Socket socket, dmSSLSocket::Socket sslsocket);
+
+    /**
+     * Delete the session. Sends GOAWAY if the connection is still alive.
+     */
+    void Delete(HSession session);
+
+    /**
+     * @return false if the connection is lost, or the peer has sent GOAWAY
+     */
+    bool IsAlive(HSession session);
+
+    /**
+     * @return true if the session is alive, and a new stream may be opened
+     */
+    bool IsUsable(HSession session);
+
+    /**
+     * Open a new stream and send the request headers. The pseudo headers (":method" etc) must come first.
+     * @param session the session
+     * @param headers the headers. The names must be lower case
+     * @param count the number of headers
+     * @param end_stream true if the request has no body
+     * @param stream the new stream (out)
+     * @return RESULT_OK on success
+     */
+    Result OpenStream(HSession session, const Header* headers, uint32_t count, bool end_stream, HStream* stream);
+
+    /**
+     * Send request body data, as far as the flow control windows allow.
+     * @param sent the number of bytes sent (out). May be less than size, along with RESULT_WOULDBLOCK
+     * @param end_stream true if this is the end of the request body
+     */
+    Result SendData(HSession session, HStream stream, const void* data, uint32_t size, bool end_stream, uint32_t* sent);
+
+    /**
+     * Wait for the response headers. The callback is called once for each header, when they have all arrived.
+     * Informational (1xx) responses are skipped
+     * @param status the response status (out)
+     * @return RESULT_OK when the headers have been received
+     */
+    Result ReceiveHeaders(HSession session, HStream stream, int* status, FHeader callback, void* ctx);
+
+    /**
+     * Receive response body data.
+     * @param received the number of bytes received (out)
+     * @param end set to true when the response is complete (out)
+     * @return RESULT_OK if data was received, or the response is complete
+     */
+    Result ReceiveData(HSession session, HStream stream, void* buffer, uint32_t size, uint32_t* received, bool* end);
+
+    /**
+     * Close the stream and free its resources. An unfinished stream is reset.
+     */
+    void CloseStream(HSession session, HStream stream);
+}
+
+#endif // DM_HTTP2_H
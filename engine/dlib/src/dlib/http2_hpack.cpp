@@ -0,0 +1,435 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include "http2_hpack.h"
+#include "math.h"
+
+namespace dmHttp2
+{
+    struct HpackStaticEntry
+    {
+        const char* m_Name;
+        const char* m_Value;
+    };
+
+    // RFC 7541, Appendix A
+    static const HpackStaticEntry STATIC_TABLE[] =
+    {
+        { ":authority",                    ""                 }, // 1
+        { ":method",                       "GET"              }, // 2
+        { ":method",                       "POST"             }, // 3
+        { ":path",                         "/"                }, // 4
+        { ":path",                         "/index.html"      }, // 5
+        { ":scheme",                       "http"             }, // 6
+        { ":scheme",                       "https"            }, // 7
+        { ":status",                       "200"              }, // 8
+        { ":status",                       "204"              }, // 9
+        { ":status",                       "206"              }, // 10
+        { ":status",                       "304"              }, // 11
+        { ":status",                       "400"              }, // 12
+        { ":status",                       "404"              }, // 13
+        { ":status",                       "500"              }, // 14
+        { "accept-charset",                ""                 }, // 15
+        { "accept-encoding",               "gzip, deflate"    }, // 16
+        { "accept-language",               ""                 }, // 17
+        { "accept-ranges",                 ""                 }, // 18
+        { "accept",                        ""                 }, // 19
+        { "access-control-allow-origin",   ""                 }, // 20
+        { "age",                           ""                 }, // 21
+        { "allow",                         ""                 }, // 22
+        { "authorization",                 ""                 }, // 23
+        { "cache-control",                 ""                 }, // 24
+        { "content-disposition",           ""                 }, // 25
+        { "content-encoding",              ""                 }, // 26
+        { "content-language",              ""                 }, // 27
+        { "content-length",                ""                 }, // 28
+        { "content-location",              ""                 }, // 29
+        { "content-range",                 ""                 }, // 30
+        { "content-type",                  ""                 }, // 31
+        { "cookie",                        ""                 }, // 32
+        { "date",                          ""                 }, // 33
+        { "etag",                          ""                 }, // 34
+        { "expect",                        ""                 }, // 35
+        { "expires",                       ""                 }, // 36
+        { "from",                          ""                 }, // 37
+        { "host",                          ""                 }, // 38
+        { "if-match",                      ""                 }, // 39
+        { "if-modified-since",             ""                 }, // 40
+        { "if-none-match",                 ""                 }, // 41
+        { "if-range",                      ""                 }, // 42
+        { "if-unmodified-since",           ""                 }, // 43
+        { "last-modified",                 ""                 }, // 44
+        { "link",                          ""                 }, // 45
+        { "location",                      ""                 }, // 46
+        { "max-forwards",                  ""                 }, // 47
+        { "proxy-authenticate",            ""                 }, // 48
+        { "proxy-authorization",           ""                 }, // 49
+        { "range",                         ""                 }, // 50
+        { "referer",                       ""                 }, // 51
+        { "refresh",                       ""                 }, // 52
+        { "retry-after",                   ""                 }, // 53
+        { "server",                        ""                 }, // 54
+        { "set-cookie",                    ""                 }, // 55
+        { "strict-transport-security",     ""                 }, // 56
+        { "transfer-encoding",             ""                 }, // 57
+        { "user-agent",                    ""                 }, // 58
+        { "vary",                          ""                 }, // 59
+        { "via",                           ""                 }, // 60
+        { "www-authenticate",              ""                 }, // 61
+    };
+
+    static const uint32_t STATIC_TABLE_SIZE = sizeof(STATIC_TABLE) / sizeof(STATIC_TABLE[0]);
+
+    // The Huffman code of RFC 7541, Appendix B, in canonical form:
+    // The number of codes of each bit length, and the symbols ordered by code
+    static const uint16_t HUFFMAN_COUNTS[31] =
+    {
+        0, 0, 0, 0, 0, 10, 26, 32, 6, 0, 5, 3, 2, 6, 2, 3,
+        0, 0, 0, 3, 8, 13, 26, 29, 12, 4, 15, 19, 29, 0, 4,
+    };
+
+    static const uint16_t HUFFMAN_EOS = 256;
+
+    static const uint16_t HUFFMAN_SYMBOLS[257] =
+    {
+         48,  49,  50,  97,  99, 101, 105, 111, 115, 116,  32,  37,  45,  46,  47,  51,
+         52,  53,  54,  55,  56,  57,  61,  65,  95,  98, 100, 102, 103, 104, 108, 109,
+        110, 112, 114, 117,  58,  66,  67,  68,  69,  70,  71,  72,  73,  74,  75,  76,
+         77,  78,  79,  80,  81,  82,  83,  84,  85,  86,  87,  89, 106, 107, 113, 118,
+        119, 120, 121, 122,  38,  42,  44,  59,  88,  90,  33,  34,  40,  41,  63,  39,
+         43, 124,  35,  62,   0,  36,  64,  91,  93, 126,  94, 125,  60,  96, 123,  92,
+        195, 208, 128, 130, 131, 162, 184, 194, 224, 226, 153, 161, 167, 172, 176, 177,
+        179, 209, 216, 217, 227, 229, 230, 129, 132, 133, 134, 136, 146, 154, 156, 160,
+        163, 164, 169, 170, 173, 178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232,
+        233,   1, 135, 137, 138, 139, 140, 141, 143, 147, 149, 150, 151, 152, 155, 157,
+        158, 165, 166, 168, 174, 175, 180, 182, 183, 188, 191, 197, 231, 239,   9, 142,
+        144, 145, 148, 159, 171, 206, 215, 225, 236, 237, 199, 207, 234, 235, 192, 193,
+        200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243, 255, 203, 204, 211,
+        212, 214, 221, 222, 223, 241, 244, 245, 246, 247, 248, 250, 251, 252, 253, 254,
+          2,   3,   4,   5,   6,   7,   8,  11,  12,  14,  15,  16,  17,  18,  19,  20,
+         21,  23,  24,  25,  26,  27,  28,  29,  30,  31, 127, 220, 249,  10,  13,  22,
+        256,
+    };
+
+    HpackDecoder::HpackDecoder()
+    : m_TableSize(0)
+    , m_MaxTableSize(HPACK_DEFAULT_TABLE_SIZE)
+    {
+    }
+
+    HpackDecoder::~HpackDecoder()
+    {
+        for (uint32_t i = 0; i < m_Table.Size(); ++i)
+        {
+            free(m_Table[i].m_Name);
+            free(m_Table[i].m_Value);
+        }
+    }
+
+    static void EvictEntries(HpackDecoder* decoder, uint32_t max_size)
+    {
+        uint32_t count = 0;
+        while (decoder->m_TableSize > max_size && count < decoder->m_Table.Size())
+        {
+            HpackEntry& entry = decoder->m_Table[count++];
+            decoder->m_TableSize -= entry.m_Size;
+            free(entry.m_Name);
+            free(entry.m_Value);
+        }
+
+        if (count > 0)
+        {
+            uint32_t remaining = decoder->m_Table.Size() - count;
+            memmove(decoder->m_Table.Begin(), decoder->m_Table.Begin() + count, remaining * sizeof(HpackEntry));
+            decoder->m_Table.SetSize(remaining);
+        }
+    }
+
+    static void AddEntry(HpackDecoder* decoder, const char* name, const char* value)
+    {
+        HpackEntry entry;
+        entry.m_Size = strlen(name) + strlen(value) + 32;
+
+        // An entry larger than the table empties it, and isn't added (RFC 7541, 4.4)
+        if (entry.m_Size > decoder->m_MaxTableSize)
+        {
+            EvictEntries(decoder, 0);
+            return;
+        }
+
+        EvictEntries(decoder, decoder->m_MaxTableSize - entry.m_Size);
+
+        entry.m_Name = strdup(name);
+        entry.m_Value = strdup(value);
+        if (decoder->m_Table.Full())
+            decoder->m_Table.OffsetCapacity(16);
+        decoder->m_Table.Push(entry);
+        decoder->m_TableSize += entry.m_Size;
+    }
+
+    // Indices start at 1, with the static table first
+    static bool GetEntry(HpackDecoder* decoder, uint64_t index, const char** name, const char** value)
+    {
+        if (index == 0)
+            return false;
+        if (index <= STATIC_TABLE_SIZE)
+        {
+            *name = STATIC_TABLE[index - 1].m_Name;
+            *value = STATIC_TABLE[index - 1].m_Value;
+            return true;
+        }
+        index -= STATIC_TABLE_SIZE;
+        if (index > decoder->m_Table.Size())
+            return false;
+        const HpackEntry& entry = decoder->m_Table[decoder->m_Table.Size() - (uint32_t)index];
+        *name = entry.m_Name;
+        *value = entry.m_Value;
+        return true;
+    }
+
+    // RFC 7541, 5.1
+    static bool DecodeInteger(const uint8_t** cursor, const uint8_t* end, uint32_t prefix_bits, uint64_t* value)
+    {
+        const uint8_t* p = *cursor;
+        if (p >= end)
+            return false;
+
+        uint32_t max_prefix = (1U << prefix_bits) - 1;
+        uint64_t v = *p++ & max_prefix;
+        if (v == max_prefix)
+        {
+            uint32_t shift = 0;
+            while (true)
+            {
+                if (p >= end || shift > 28)
+                    return false;
+                uint8_t b = *p++;
+                v += (uint64_t)(b & 0x7f) << shift;
+                shift += 7;
+                if ((b & 0x80) == 0)
+                    break;
+            }
+        }
+        *cursor = p;
+        *value = v;
+        return true;
+    }
+
+    static void PushChar(dmArray<char>& out, char c)
+    {
+        if (out.Full())
+            out.OffsetCapacity(dmMath::Max(64U, out.Capacity()));
+        out.Push(c);
+    }
+
+    static bool DecodeHuffman(const uint8_t* data, uint32_t size, dmArray<char>& out)
+    {
+        uint32_t code = 0;      // The bits of the current symbol
+        uint32_t first = 0;     // The first code of the current length
+        uint32_t index = 0;     // The index of the first code of the current length
+        uint32_t length = 0;
+        bool all_ones = true;   // If the bits of the current symbol are all ones, which is valid padding
+
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            uint8_t byte = data[i];
+            for (int bit = 7; bit >= 0; --bit)
+            {
+                uint32_t b = (byte >> bit) & 1;
+                code |= b;
+                all_ones = all_ones && b;
+                ++length;
+                uint32_t count = HUFFMAN_COUNTS[length];
+                if (code - first < count)
+                {
+                    uint16_t symbol = HUFFMAN_SYMBOLS[index + (code - first)];
+                    if (symbol == HUFFMAN_EOS)
+                        return false;
+                    PushChar(out, (char)symbol);
+                    code = first = index = length = 0;
+                    all_ones = true;
+                    continue;
+                }
+                if (length == 30)
+                    return false;
+                index += count;
+                first = (first + count) << 1;
+                code <<= 1;
+            }
+        }
+
+        // The padding must be a prefix of the EOS code (i.e. ones), and shorter than 8 bits (RFC 7541, 5.2)
+        return length < 8 && all_ones;
+    }
+
+    // RFC 7541, 5.2
+    static bool DecodeString(const uint8_t** cursor, const uint8_t* end, dmArray<char>& out)
+    {
+        if (*cursor >= end)
+            return false;
+        bool huffman = (**cursor & 0x80) != 0;
+        uint64_t length;
+        if (!DecodeInteger(cursor, end, 7, &length))
+            return false;
+        if (length > (uint64_t)(end - *cursor))
+            return false;
+
+        out.SetSize(0);
+        if (huffman)
+        {
+            if (!DecodeHuffman(*cursor, (uint32_t)length, out))
+                return false;
+        }
+        else
+        {
+            out.SetCapacity(dmMath::Max(out.Capacity(), (uint32_t)length + 1));
+            out.PushArray((const char*)*cursor, (uint32_t)length);
+        }
+        PushChar(out, 0);
+        *cursor += length;
+        return true;
+    }
+
+    bool HpackDecode(HpackDecoder* decoder, const uint8_t* data, uint32_t size, FHpackHeader callback, void* ctx)
+    {
+        const uint8_t* cursor = data;
+        const uint8_t* end = data + size;
+        bool headers_seen = false;
+
+        while (cursor < end)
+        {
+            uint8_t first = *cursor;
+            const char* name;
+            const char* value;
+
+            if (first & 0x80)
+            {
+                // Indexed header field
+                uint64_t index;
+                if (!DecodeInteger(&cursor, end, 7, &index) || !GetEntry(decoder, index, &name, &value))
+                    return false;
+                callback(ctx, name, value);
+                headers_seen = true;
+            }
+            else if ((first & 0xe0) == 0x20)
+            {
+                // Dynamic table size update, only allowed at the start of a header block
+                uint64_t max_size;
+                if (headers_seen || !DecodeInteger(&cursor, end, 5, &max_size) || max_size > HPACK_DEFAULT_TABLE_SIZE)
+                    return false;
+                decoder->m_MaxTableSize = (uint32_t)max_size;
+                EvictEntries(decoder, decoder->m_MaxTableSize);
+            }
+            else
+            {
+                // Literal header field, with incremental indexing (01), without indexing (0000) or never indexed (0001)
+                bool add_to_table = (first & 0xc0) == 0x40;
+                uint64_t index;
+                if (!DecodeInteger(&cursor, end, add_to_table ? 6 : 4, &index))
+                    return false;
+
+                if (index == 0)
+                {
+                    if (!DecodeString(&cursor, end, decoder->m_Name))
+                        return false;
+                }
+                else
+                {
+                    const char* indexed_value;
+                    if (!GetEntry(decoder, index, &name, &indexed_value))
+                        return false;
+                    // Copy it, since adding the entry below may evict the entry it refers to
+                    uint32_t name_length = strlen(name);
+                    decoder->m_Name.SetSize(0);
+                    decoder->m_Name.SetCapacity(dmMath::Max(decoder->m_Name.Capacity(), name_length + 1));
+                    decoder->m_Name.PushArray(name, name_length + 1);
+                }
+
+                if (!DecodeString(&cursor, end, decoder->m_Value))
+                    return false;
+
+                name = decoder->m_Name.Begin();
+                value = decoder->m_Value.Begin();
+                callback(ctx, name, value);
+                if (add_to_table)
+                    AddEntry(decoder, name, value);
+                headers_seen = true;
+            }
+        }
+        return true;
+    }
+
+    static void PushBytes(dmArray<uint8_t>& out, const uint8_t* data, uint32_t size)
+    {
+        if (out.Remaining() < size)
+            out.OffsetCapacity(dmMath::Max(size, out.Capacity()));
+        out.PushArray(data, size);
+    }
+
+    static void EncodeInteger(dmArray<uint8_t>& out, uint8_t first, uint32_t prefix_bits, uint32_t value)
+    {
+        uint8_t buffer[8];
+        uint32_t n = 0;
+        uint32_t max_prefix = (1U << prefix_bits) - 1;
+        if (value < max_prefix)
+        {
+            buffer[n++] = first | (uint8_t)value;
+        }
+        else
+        {
+            buffer[n++] = first | (uint8_t)max_prefix;
+            value -= max_prefix;
+            while (value >= 0x80)
+            {
+                buffer[n++] = (uint8_t)((value & 0x7f) | 0x80);
+                value >>= 7;
+            }
+            buffer[n++] = (uint8_t)value;
+        }
+        PushBytes(out, buffer, n);
+    }
+
+    static void EncodeString(dmArray<uint8_t>& out, const char* str)
+    {
+        uint32_t length = strlen(str);
+        EncodeInteger(out, 0, 7, length);
+        PushBytes(out, (const uint8_t*)str, length);
+    }
+
+    void HpackEncode(dmArray<uint8_t>& out, const char* name, const char* value)
+    {
+        uint32_t name_index = 0;
+        for (uint32_t i = 0; i < STATIC_TABLE_SIZE; ++i)
+        {
+            if (strcmp(STATIC_TABLE[i].m_Name, name) != 0)
+                continue;
+            if (strcmp(STATIC_TABLE[i].m_Value, value) == 0)
+            {
+                // Indexed header field
+                EncodeInteger(out, 0x80, 7, i + 1);
+                return;
+            }
+            if (name_index == 0)
+                name_index = i + 1;
+        }
+
+        // Literal header field without indexing
+        EncodeInteger(out, 0x00, 4, name_index);
+        if (name_index == 0)
+            EncodeString(out, name);
+        EncodeString(out, value);
+    }
+}
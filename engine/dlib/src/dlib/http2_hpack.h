@@ -0,0 +1,76 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_HTTP2_HPACK_H
+#define DM_HTTP2_HPACK_H
+
+#include <stdint.h>
+#include "array.h"
+
+/**
+ * HPACK header compression for HTTP/2 (RFC 7541)
+ */
+namespace dmHttp2
+{
+    /// The default (and max) size of the dynamic table, as we never change SETTINGS_HEADER_TABLE_SIZE
+    const uint32_t HPACK_DEFAULT_TABLE_SIZE = 4096;
+
+    struct HpackEntry
+    {
+        char*       m_Name;
+        char*       m_Value;
+        uint32_t    m_Size; // As defined by the spec: name length + value length + 32
+    };
+
+    struct HpackDecoder
+    {
+        HpackDecoder();
+        ~HpackDecoder();
+
+        /// The dynamic table, with the newest entry last
+        dmArray<HpackEntry> m_Table;
+        uint32_t            m_TableSize;
+        uint32_t            m_MaxTableSize;
+        /// Scratch buffers for the decoded strings
+        dmArray<char>       m_Name;
+        dmArray<char>       m_Value;
+    };
+
+    /**
+     * Called for each decoded header. The strings are null terminated, and only valid during the call
+     */
+    typedef void (*FHpackHeader)(void* ctx, const char* name, const char* value);
+
+    /**
+     * Decodes a complete header block
+     * @param decoder The decoder, which keeps the dynamic table between the header blocks of a connection
+     * @param data The header block
+     * @param size The size of the header block
+     * @param callback Called for each header
+     * @param ctx Passed to the callback
+     * @return false if the header block is malformed. This is a connection error (COMPRESSION_ERROR)
+     */
+    bool HpackDecode(HpackDecoder* decoder, const uint8_t* data, uint32_t size, FHpackHeader callback, void* ctx);
+
+    /**
+     * Appends a header to a header block. The header is never added to the dynamic table of the peer,
+     * so the encoder doesn't need any state.
+     * @param out The header block
+     * @param name The header name. Must be lower case
+     * @param value The header value
+     */
+    void HpackEncode(dmArray<uint8_t>& out, const char* name, const char* value);
+}
+
+#endif // DM_HTTP2_HPACK_H
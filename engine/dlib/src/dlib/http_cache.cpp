@@ -16,11 +16,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <algorithm>
 #include "dstrings.h"
 #include "http_cache.h"
 #include "log.h"
 #include "sys.h"
-#include "hashtable.h"
 #include "hash.h"
 #include "math.h"
 #include "time.h"
@@ -28,6 +28,8 @@
 #include "array.h"
 #include "poolallocator.h"
 #include "path.h"
+#include "thread.h"
+#include <dlib/atomic.h>
 #include <dlib/mutex.h>
 
 namespace dmHttpCache
@@ -35,11 +37,33 @@ namespace dmHttpCache
     // Magic file header for index file
     const uint32_t MAGIC = 0xCAAAAAAC;
     // Current index file version
-    const uint32_t VERSION = 7;
+    const uint32_t VERSION = 8;
 
     // Maximum number of cache entry creations in flight
     const uint32_t MAX_CACHE_CREATORS = 16;
 
+    // Number of slab files holding the cached content
+    const uint32_t SLAB_COUNT = 4;
+    // Marks an entry without content, ie an entry being created
+    const uint16_t SLAB_NONE = 0xffff;
+    // Maximum number of pooled read handles per slab
+    const uint32_t MAX_SLAB_READERS = 4;
+    // A slab is compacted when opening the cache if more than half of it, and at least this many bytes, is unused
+    const uint32_t SLAB_COMPACT_MIN_SIZE = 1024 * 1024;
+
+    // Minimum number of slots in the index table
+    const uint32_t MIN_TABLE_CAPACITY = 64;
+
+    // Number of entries verified by the verification thread between taking the lock
+    const uint32_t VERIFY_BATCH_SIZE = 16;
+
+    // Size of the buffer used when copying and verifying content
+    const uint32_t COPY_BUFFER_SIZE = 16 * 1024;
+
+    // Slot flags
+    const uint16_t SLOT_USED = 1;
+    const uint16_t SLOT_DELETED = 2;
+
     // Index header struct
     struct IndexHeader
     {
@@ -51,32 +75,24 @@ namespace dmHttpCache
         uint64_t m_Checksum;
         uint32_t m_SizeOfEntry;     // Making sure the size is double checked
         uint32_t m_SizeOfFileEntry; // Making sure the size is double checked
+        // Number of slots in the table. Always a power of two
+        uint32_t m_Capacity;
+        // Size of the uri strings that follow the table
+        uint32_t m_StringsSize;
+        // Used size of each slab, ie the offset where new content is appended
+        uint32_t m_SlabSize[SLAB_COUNT];
+        // Bytes in each slab not referenced by any entry
+        uint32_t m_SlabUnused[SLAB_COUNT];
     };
 
     /*
-     * In-memory representation of a cache entry
-     */
-    struct Entry
-    {
-        Entry()
-        {
-            memset(this, 0, sizeof(*this));
-        }
-        EntryInfo m_Info;
-        uint8_t  m_ReadLockCount : 8;
-        uint8_t  m_WriteLock : 1;
-    };
-
-    /*
-     * Disk (index) representation of a cache entry
+     * Disk (index) representation of a cache entry. The index is an open addressing
+     * table (linear probing) of these, stored as is, so that it's usable without rehashing
+     * when loaded.
      */
     struct FileEntry
     {
         uint64_t m_UriHash;
-        // ETag string
-        char     m_ETag[MAX_TAG_LEN];
-        // Path string
-        char     m_URI[MAX_URI_LEN];
         // The content hash is the hash of URI and ETag.
         uint64_t m_IdentifierHash;
         // Last accessed time
@@ -85,6 +101,30 @@ namespace dmHttpCache
         uint64_t m_Expires;
         // Checksum
         uint64_t m_Checksum;
+        // ETag string
+        char     m_ETag[MAX_TAG_LEN];
+        // Offset of the uri in the string block
+        uint32_t m_URIOffset;
+        // The location of the content
+        uint32_t m_Offset;
+        uint32_t m_Size;
+        uint16_t m_Slab;
+        // SLOT_USED, SLOT_DELETED or 0 for an empty slot
+        uint16_t m_Flags;
+    };
+
+    /*
+     * In-memory representation of a cache entry
+     */
+    struct Entry
+    {
+        FileEntry   m_File;
+        const char* m_URI;
+        uint8_t     m_ReadLockCount;
+        uint8_t     m_WriteLock : 1;
+        uint8_t     m_Verified : 1;
+        // The content checksum has been checked by the verification thread
+        uint8_t     m_ContentChecked : 1;
     };
 
     /*
@@ -97,10 +137,27 @@ namespace dmHttpCache
         HashState64 m_ChecksumState;
         uint64_t    m_IdentifierHash;
         uint64_t    m_UriHash;
+        uint32_t    m_Size;
         uint16_t    m_Index;
         uint32_t    m_Error : 1;
     };
 
+    /*
+     * Content file. Content is only ever appended, and the space of removed entries
+     * is reclaimed by compacting the slab when the cache is opened.
+     */
+    struct Slab
+    {
+        // Handle used for appending, opened on first write
+        FILE*           m_File;
+        // Serializes the appends, so the content can be copied without holding the cache lock
+        dmMutex::HMutex m_WriteMutex;
+        // Pooled read handles, see Get/Release
+        dmArray<FILE*>  m_Readers;
+        uint32_t        m_Size;
+        uint32_t        m_Unused;
+    };
+
     /*
      * The cache database
      */
@@ -110,28 +167,59 @@ namespace dmHttpCache
         {
             m_Path = strdup(path);
             m_MaxCacheEntryAge = max_entry_age;
-            m_CacheTable.SetCapacity(11, 32);
             m_Mutex = dmMutex::New();
             m_Policy = CONSISTENCY_POLICY_VERIFY;
             m_StringAllocator = dmPoolAllocator::New(4096);
+            m_IndexStrings = 0;
+            m_Count = 0;
+            m_Deleted = 0;
             m_Dirty = false;
+            m_VerifyThread = 0;
+            m_Verifying = 0;
+            m_VerifyCancel = 0;
+            for (uint32_t i = 0; i < SLAB_COUNT; ++i)
+            {
+                m_Slabs[i].m_File = 0;
+                m_Slabs[i].m_WriteMutex = dmMutex::New();
+                m_Slabs[i].m_Size = 0;
+                m_Slabs[i].m_Unused = 0;
+            }
         }
 
         ~Cache()
         {
+            for (uint32_t i = 0; i < SLAB_COUNT; ++i)
+            {
+                Slab* slab = &m_Slabs[i];
+                if (slab->m_File)
+                    fclose(slab->m_File);
+                for (uint32_t j = 0; j < slab->m_Readers.Size(); ++j)
+                    fclose(slab->m_Readers[j]);
+                dmMutex::Delete(slab->m_WriteMutex);
+            }
             free(m_Path);
+            free(m_IndexStrings);
             dmMutex::Delete(m_Mutex);
             dmPoolAllocator::Delete(m_StringAllocator);
         }
 
         char*                m_Path;
         uint64_t             m_MaxCacheEntryAge;
-        dmHashTable64<Entry> m_CacheTable;
+        // Open addressing table, see FindEntry
+        dmArray<Entry>       m_Table;
+        uint32_t             m_Count;
+        uint32_t             m_Deleted;
+        // The uri strings loaded from the index
+        char*                m_IndexStrings;
+        Slab                 m_Slabs[SLAB_COUNT];
         dmMutex::HMutex      m_Mutex;
         dmIndexPool16        m_CacheCreatorsPool;
         dmArray<CacheCreator> m_CacheCreators;
         ConsistencyPolicy    m_Policy;
         dmPoolAllocator::HPool m_StringAllocator;
+        dmThread::Thread     m_VerifyThread;
+        int32_atomic_t       m_Verifying;
+        int32_atomic_t       m_VerifyCancel;
         bool                 m_Dirty;
     };
 
@@ -141,48 +229,447 @@ namespace dmHttpCache
         params->m_MaxCacheEntryAge = 60 * 60 * 24 * 5;
     }
 
-    static void HashToString(uint64_t hash, char* str)
+    static void SlabFilePath(HCache cache, uint32_t slab, char* path, int path_len)
     {
-        static const char hex_chars[] = "0123456789abcdef";
-        for (int i = 0; i < 8; ++i)
+        dmSnPrintf(path, path_len, "%s/slab%u", cache->m_Path, slab);
+    }
+
+    static uint32_t SlotIndex(uint64_t uri_hash, uint32_t capacity)
+    {
+        return (uint32_t)(uri_hash ^ (uri_hash >> 32)) & (capacity - 1);
+    }
+
+    static Entry* FindEntry(HCache cache, uint64_t uri_hash)
+    {
+        uint32_t capacity = cache->m_Table.Size();
+        if (capacity == 0)
+            return 0;
+
+        uint32_t index = SlotIndex(uri_hash, capacity);
+        for (uint32_t i = 0; i < capacity; ++i)
         {
-            uint32_t x = (hash >> 8 * (7 - i)) & 0xff;
-            *str++ = hex_chars[x >> 4];
-            *str++ = hex_chars[x & 0xf];
+            Entry* entry = &cache->m_Table[index];
+            uint16_t flags = entry->m_File.m_Flags;
+            if (flags == 0)
+                return 0;
+            if (flags == SLOT_USED && entry->m_File.m_UriHash == uri_hash)
+                return entry;
+            index = (index + 1) & (capacity - 1);
         }
-        *str = 0;
+        return 0;
     }
 
-    static void ContentFilePath(HCache cache, uint64_t identifier_hash, char* path, int path_len)
+    // Rebuilds the table, which also gets rid of the deleted slots
+    static void Rehash(HCache cache, uint32_t capacity)
     {
-        char identifier_string[8 * 2 + 1];
-        identifier_string[sizeof(identifier_string)-1] = '\0';
-        HashToString(identifier_hash, &identifier_string[0]);
-        dmSnPrintf(path, path_len, "%s/%c%c/%s",
-                    cache->m_Path,
-                    identifier_string[0],
-                    identifier_string[1],
-                    &identifier_string[2]);
+        dmArray<Entry> table;
+        table.SetCapacity(capacity);
+        table.SetSize(capacity);
+        memset(table.Begin(), 0, sizeof(Entry) * capacity);
+
+        for (uint32_t i = 0; i < cache->m_Table.Size(); ++i)
+        {
+            Entry* entry = &cache->m_Table[i];
+            if (entry->m_File.m_Flags != SLOT_USED)
+                continue;
+            uint32_t index = SlotIndex(entry->m_File.m_UriHash, capacity);
+            while (table[index].m_File.m_Flags != 0)
+                index = (index + 1) & (capacity - 1);
+            table[index] = *entry;
+        }
+
+        cache->m_Table.Swap(table);
+        cache->m_Deleted = 0;
     }
 
-    static void RemoveCachedContentFile(HCache cache, uint64_t identifier_hash)
+    static Entry* InsertEntry(HCache cache, uint64_t uri_hash)
     {
-        char path[DMPATH_MAX_PATH];
-        ContentFilePath(cache, identifier_hash, path, sizeof(path));
-        dmSys::Result r = dmSys::Unlink(path);
-        if (r != dmSys::RESULT_OK)
+        uint32_t capacity = cache->m_Table.Size();
+        // Keep the load factor, including the deleted slots, below 3/4
+        if ((cache->m_Count + cache->m_Deleted + 1) * 4 > capacity * 3)
         {
-            dmLogWarning("Unable to remove %s", path);
-            cache->m_Dirty = true;
+            uint32_t new_capacity = dmMath::Max(capacity, MIN_TABLE_CAPACITY);
+            while ((cache->m_Count + 1) * 2 > new_capacity)
+                new_capacity *= 2;
+            Rehash(cache, new_capacity);
+            capacity = new_capacity;
+        }
+
+        uint32_t index = SlotIndex(uri_hash, capacity);
+        while (cache->m_Table[index].m_File.m_Flags == SLOT_USED)
+            index = (index + 1) & (capacity - 1);
+
+        Entry* entry = &cache->m_Table[index];
+        if (entry->m_File.m_Flags == SLOT_DELETED)
+            cache->m_Deleted--;
+        memset(entry, 0, sizeof(*entry));
+        entry->m_File.m_UriHash = uri_hash;
+        entry->m_File.m_Slab = SLAB_NONE;
+        entry->m_File.m_Flags = SLOT_USED;
+        cache->m_Count++;
+        return entry;
+    }
+
+    static void ReleaseContent(HCache cache, Entry* entry)
+    {
+        if (entry->m_File.m_Slab != SLAB_NONE)
+        {
+            cache->m_Slabs[entry->m_File.m_Slab].m_Unused += entry->m_File.m_Size;
+            entry->m_File.m_Slab = SLAB_NONE;
+            entry->m_File.m_Offset = 0;
+            entry->m_File.m_Size = 0;
         }
     }
 
+    static void EraseEntry(HCache cache, Entry* entry)
+    {
+        ReleaseContent(cache, entry);
+        entry->m_File.m_Flags = SLOT_DELETED;
+        cache->m_Count--;
+        cache->m_Deleted++;
+    }
+
     static bool IsValidHeader(IndexHeader* header)
     {
          return header->m_Magic == MAGIC &&
                 header->m_Version == VERSION &&
                 header->m_SizeOfEntry == (uint32_t)sizeof(Entry) &&
-                header->m_SizeOfFileEntry == (uint32_t)sizeof(FileEntry);
+                header->m_SizeOfFileEntry == (uint32_t)sizeof(FileEntry) &&
+                header->m_Capacity > 0 && (header->m_Capacity & (header->m_Capacity - 1)) == 0;
+    }
+
+    // Removes the content directories of cache versions before the slab files
+    static void RemoveLegacyContent(HCache cache)
+    {
+        static const char hex_chars[] = "0123456789abcdef";
+        char path[DMPATH_MAX_PATH];
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            dmSnPrintf(path, sizeof(path), "%s/%c%c", cache->m_Path, hex_chars[i >> 4], hex_chars[i & 0xf]);
+            if (dmSys::IsDir(path) == dmSys::RESULT_OK)
+            {
+                dmSys::RmTree(path);
+            }
+        }
+    }
+
+    static void RemoveSlabs(HCache cache)
+    {
+        char path[DMPATH_MAX_PATH];
+        for (uint32_t i = 0; i < SLAB_COUNT; ++i)
+        {
+            SlabFilePath(cache, i, path, sizeof(path));
+            if (dmSys::Exists(path))
+            {
+                dmSys::Unlink(path);
+            }
+            cache->m_Slabs[i].m_Size = 0;
+            cache->m_Slabs[i].m_Unused = 0;
+        }
+    }
+
+    static bool LoadIndex(HCache cache, const char* cache_file, void* buffer, size_t size)
+    {
+        IndexHeader* header = (IndexHeader*) buffer;
+        if (size < sizeof(IndexHeader) || !IsValidHeader(header))
+        {
+            if (size >= sizeof(IndexHeader) && header->m_Magic == MAGIC && header->m_Version < VERSION)
+            {
+                RemoveLegacyContent(cache);
+            }
+            dmLogError("Invalid cache index file '%s'. Removing file.", cache_file);
+            return false;
+        }
+
+        uint64_t table_size = (uint64_t) header->m_Capacity * sizeof(FileEntry);
+        if (size != sizeof(IndexHeader) + table_size + header->m_StringsSize)
+        {
+            dmLogError("Invalid cache index file '%s'. Removing file.", cache_file);
+            return false;
+        }
+
+        uint64_t checksum = dmHashBuffer64((void*) (((uintptr_t) buffer) + sizeof(IndexHeader)), size - sizeof(IndexHeader));
+        if (checksum != header->m_Checksum)
+        {
+            dmLogError("Corrupt cache index file '%s'. Removing file.", cache_file);
+            return false;
+        }
+
+        const FileEntry* file_entries = (const FileEntry*) (((uintptr_t) buffer) + sizeof(IndexHeader));
+        const char* strings = (const char*) (((uintptr_t) file_entries) + table_size);
+
+        // The strings are kept as is, and referenced by the entries
+        cache->m_IndexStrings = (char*) malloc(header->m_StringsSize + 1);
+        memcpy(cache->m_IndexStrings, strings, header->m_StringsSize);
+        cache->m_IndexStrings[header->m_StringsSize] = '\0';
+
+        // The size of the slabs may differ from the index, if the slabs were modified after the index was written.
+        uint32_t slab_size[SLAB_COUNT];
+        char path[DMPATH_MAX_PATH];
+        for (uint32_t i = 0; i < SLAB_COUNT; ++i)
+        {
+            dmSys::StatInfo info;
+            SlabFilePath(cache, i, path, sizeof(path));
+            uint64_t actual_size = dmSys::Stat(path, &info) == dmSys::RESULT_OK ? info.m_Size : 0;
+            slab_size[i] = (uint32_t) dmMath::Min((uint64_t) header->m_SlabSize[i], actual_size);
+            cache->m_Slabs[i].m_Size = slab_size[i];
+            cache->m_Slabs[i].m_Unused = dmMath::Min(header->m_SlabUnused[i], slab_size[i]);
+        }
+
+        // The slots are loaded in place, ie without rehashing
+        uint32_t capacity = header->m_Capacity;
+        cache->m_Table.SetCapacity(capacity);
+        cache->m_Table.SetSize(capacity);
+        memset(cache->m_Table.Begin(), 0, sizeof(Entry) * capacity);
+
+        uint64_t current_time = dmTime::GetTime();
+        for (uint32_t i = 0; i < capacity; ++i)
+        {
+            const FileEntry* file_entry = &file_entries[i];
+            Entry* entry = &cache->m_Table[i];
+            entry->m_File = *file_entry;
+            if (file_entry->m_Flags != SLOT_USED)
+            {
+                if (file_entry->m_Flags != 0)
+                {
+                    entry->m_File.m_Flags = SLOT_DELETED;
+                    cache->m_Deleted++;
+                }
+                continue;
+            }
+
+            cache->m_Count++;
+            bool valid = file_entry->m_URIOffset < header->m_StringsSize &&
+                         file_entry->m_Slab < SLAB_COUNT &&
+                         (uint64_t) file_entry->m_Offset + file_entry->m_Size <= slab_size[file_entry->m_Slab];
+            entry->m_URI = valid ? &cache->m_IndexStrings[file_entry->m_URIOffset] : "";
+
+            if (!valid)
+            {
+                // The content is missing
+                entry->m_File.m_Slab = SLAB_NONE;
+                EraseEntry(cache, entry);
+                cache->m_Dirty = true;
+            }
+            else if (file_entry->m_LastAccessed + cache->m_MaxCacheEntryAge < current_time)
+            {
+                // Remove old cache entry
+                EraseEntry(cache, entry);
+                cache->m_Dirty = true;
+            }
+        }
+
+        return true;
+    }
+
+    struct SlabRegion
+    {
+        uint32_t m_Offset;
+        uint32_t m_Size;
+        uint32_t m_Slot;
+    };
+
+    static bool SlabRegionPred(const SlabRegion& a, const SlabRegion& b)
+    {
+        return a.m_Offset < b.m_Offset;
+    }
+
+    static bool CopyContent(FILE* dst, FILE* src, uint32_t size, uint8_t* buffer)
+    {
+        while (size > 0)
+        {
+            uint32_t n = dmMath::Min(size, COPY_BUFFER_SIZE);
+            if (fread(buffer, 1, n, src) != n || fwrite(buffer, 1, n, dst) != n)
+            {
+                return false;
+            }
+            size -= n;
+        }
+        return true;
+    }
+
+    // Rewrites the slab without the unused parts. Only called from Open, ie without any readers.
+    static void CompactSlab(HCache cache, uint32_t slab_index)
+    {
+        Slab* slab = &cache->m_Slabs[slab_index];
+
+        dmArray<SlabRegion> regions;
+        for (uint32_t i = 0; i < cache->m_Table.Size(); ++i)
+        {
+            Entry* entry = &cache->m_Table[i];
+            if (entry->m_File.m_Flags == SLOT_USED && entry->m_File.m_Slab == slab_index)
+            {
+                SlabRegion region;
+                region.m_Offset = entry->m_File.m_Offset;
+                region.m_Size = entry->m_File.m_Size;
+                region.m_Slot = i;
+                regions.OffsetCapacity(1);
+                regions.Push(region);
+            }
+        }
+        std::sort(regions.Begin(), regions.End(), SlabRegionPred);
+
+        char path[DMPATH_MAX_PATH];
+        char tmp_path[DMPATH_MAX_PATH];
+        SlabFilePath(cache, slab_index, path, sizeof(path));
+        dmSnPrintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+        FILE* src = fopen(path, "rb");
+        FILE* dst = fopen(tmp_path, "wb");
+        bool ok = src != 0 && dst != 0;
+
+        uint8_t* buffer = (uint8_t*) malloc(COPY_BUFFER_SIZE);
+        uint32_t offset = 0;
+        for (uint32_t i = 0; ok && i < regions.Size(); ++i)
+        {
+            ok = fseek(src, regions[i].m_Offset, SEEK_SET) == 0 && CopyContent(dst, src, regions[i].m_Size, buffer);
+            regions[i].m_Offset = offset;
+            offset += regions[i].m_Size;
+        }
+        free(buffer);
+
+        if (src)
+            fclose(src);
+        if (dst)
+            ok = fclose(dst) == 0 && ok;
+
+        if (ok && dmSys::Rename(path, tmp_path) == dmSys::RESULT_OK)
+        {
+            for (uint32_t i = 0; i < regions.Size(); ++i)
+            {
+                cache->m_Table[regions[i].m_Slot].m_File.m_Offset = regions[i].m_Offset;
+            }
+            slab->m_Size = offset;
+            slab->m_Unused = 0;
+            cache->m_Dirty = true;
+        }
+        else
+        {
+            dmLogWarning("Unable to compact http cache file '%s'", path);
+            dmSys::Unlink(tmp_path);
+        }
+    }
+
+    struct VerifyItem
+    {
+        uint64_t m_UriHash;
+        uint64_t m_IdentifierHash;
+        uint64_t m_Checksum;
+        uint32_t m_Offset;
+        uint32_t m_Size;
+        uint16_t m_Slab;
+        bool     m_Ok;
+    };
+
+    static bool VerifyItemPred(const VerifyItem& a, const VerifyItem& b)
+    {
+        if (a.m_Slab != b.m_Slab)
+            return a.m_Slab < b.m_Slab;
+        return a.m_Offset < b.m_Offset;
+    }
+
+    static bool VerifyContent(FILE* file, const VerifyItem* item, uint8_t* buffer)
+    {
+        if (fseek(file, item->m_Offset, SEEK_SET) != 0)
+            return false;
+
+        HashState64 hash_state;
+        dmHashInit64(&hash_state, false);
+        uint32_t size = item->m_Size;
+        while (size > 0)
+        {
+            uint32_t n = dmMath::Min(size, COPY_BUFFER_SIZE);
+            if (fread(buffer, 1, n, file) != n)
+                return false;
+            dmHashUpdateBuffer64(&hash_state, buffer, n);
+            size -= n;
+        }
+        return dmHashFinal64(&hash_state) == item->m_Checksum;
+    }
+
+    /*
+     * Checks the content checksums in the background. The entries are read in slab order, and in batches,
+     * and a corrupt entry is removed, so that it is downloaded again the next time it's requested.
+     */
+    static void VerifyThread(void* arg)
+    {
+        Cache* cache = (Cache*) arg;
+
+        dmArray<VerifyItem> items;
+        {
+            DM_MUTEX_SCOPED_LOCK(cache->m_Mutex);
+            items.SetCapacity(cache->m_Count);
+            for (uint32_t i = 0; i < cache->m_Table.Size(); ++i)
+            {
+                Entry* entry = &cache->m_Table[i];
+                if (entry->m_File.m_Flags != SLOT_USED || entry->m_File.m_Slab == SLAB_NONE || entry->m_ContentChecked)
+                    continue;
+
+                VerifyItem item;
+                item.m_UriHash = entry->m_File.m_UriHash;
+                item.m_IdentifierHash = entry->m_File.m_IdentifierHash;
+                item.m_Checksum = entry->m_File.m_Checksum;
+                item.m_Offset = entry->m_File.m_Offset;
+                item.m_Size = entry->m_File.m_Size;
+                item.m_Slab = entry->m_File.m_Slab;
+                item.m_Ok = false;
+                items.Push(item);
+            }
+        }
+        std::sort(items.Begin(), items.End(), VerifyItemPred);
+
+        FILE* files[SLAB_COUNT] = {};
+        uint8_t* buffer = (uint8_t*) malloc(COPY_BUFFER_SIZE);
+        char path[DMPATH_MAX_PATH];
+
+        for (uint32_t start = 0; start < items.Size() && !dmAtomicGet32(&cache->m_VerifyCancel); start += VERIFY_BATCH_SIZE)
+        {
+            uint32_t end = dmMath::Min(start + VERIFY_BATCH_SIZE, items.Size());
+            for (uint32_t i = start; i < end; ++i)
+            {
+                VerifyItem* item = &items[i];
+                if (!files[item->m_Slab])
+                {
+                    SlabFilePath(cache, item->m_Slab, path, sizeof(path));
+                    files[item->m_Slab] = fopen(path, "rb");
+                }
+                item->m_Ok = files[item->m_Slab] != 0 && VerifyContent(files[item->m_Slab], item, buffer);
+            }
+
+            DM_MUTEX_SCOPED_LOCK(cache->m_Mutex);
+            for (uint32_t i = start; i < end; ++i)
+            {
+                VerifyItem* item = &items[i];
+                Entry* entry = FindEntry(cache, item->m_UriHash);
+                // Skip entries that have been updated meanwhile
+                if (entry == 0 || entry->m_WriteLock ||
+                    entry->m_File.m_IdentifierHash != item->m_IdentifierHash ||
+                    entry->m_File.m_Slab != item->m_Slab ||
+                    entry->m_File.m_Offset != item->m_Offset)
+                {
+                    continue;
+                }
+
+                if (item->m_Ok)
+                {
+                    entry->m_ContentChecked = 1;
+                }
+                else if (entry->m_ReadLockCount == 0)
+                {
+                    dmLogWarning("Corrupt http cache entry '%s'. Removing entry.", entry->m_URI);
+                    EraseEntry(cache, entry);
+                    cache->m_Dirty = true;
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < SLAB_COUNT; ++i)
+        {
+            if (files[i])
+                fclose(files[i]);
+        }
+        free(buffer);
+        dmAtomicStore32(&cache->m_Verifying, 0);
     }
 
     Result Open(NewParams* params, HCache* cache)
@@ -217,6 +704,8 @@ namespace dmHttpCache
             memset(h, 0, sizeof(*h));
         }
 
+        // The whole index is read with a single read, and used as is
+        bool loaded = false;
         char cache_file[DMPATH_MAX_PATH];
         dmSnPrintf(cache_file, sizeof(cache_file), "%s/%s", path, "index");
         FILE* f = fopen(cache_file, "rb");
@@ -226,134 +715,113 @@ namespace dmHttpCache
             size_t size = ftell(f);
             fseek(f, 0, SEEK_SET);
             void* buffer = malloc(size);
-            (void)fread(buffer, 1, size, f);
-            IndexHeader* header = (IndexHeader*) buffer;
-            if (size < (sizeof(IndexHeader)) || !IsValidHeader(header))
+            size_t nread = fread(buffer, 1, size, f);
+            fclose(f);
+
+            loaded = nread == size && LoadIndex(c, cache_file, buffer, size);
+            free(buffer);
+            if (!loaded)
             {
-                dmLogError("Invalid cache index file '%s'. Removing file.", cache_file);
                 // We remove the file and return RESULT_OK
                 dmSys::Unlink(cache_file);
+                c->m_Table.SetSize(0);
+                c->m_Count = 0;
+                c->m_Deleted = 0;
             }
-            else
+        }
+
+        if (!loaded)
+        {
+            // Without an index the content can't be used
+            RemoveSlabs(c);
+        }
+
+        for (uint32_t i = 0; i < SLAB_COUNT; ++i)
+        {
+            Slab* slab = &c->m_Slabs[i];
+            if (slab->m_Unused >= SLAB_COMPACT_MIN_SIZE && slab->m_Unused * 2 > slab->m_Size)
             {
-                uint64_t checksum = dmHashBuffer64((void*) (((uintptr_t) buffer) + sizeof(IndexHeader)), size - sizeof(IndexHeader));
-                if (checksum != header->m_Checksum)
-                {
-                    dmLogError("Corrupt cache index file '%s'. Removing file.", cache_file);
-                }
-                else
-                {
-                    uint32_t n_entries = (size - sizeof(IndexHeader)) / sizeof(FileEntry);
-                    FileEntry* entries = (FileEntry*) (((uintptr_t) buffer) + sizeof(IndexHeader));
-                    uint32_t capacity = n_entries + 128;
-                    c->m_CacheTable.SetCapacity(2 * capacity / 3, capacity);
-                    uint64_t current_time = dmTime::GetTime();
-                    for (uint32_t i = 0; i < n_entries; ++i)
-                    {
-                        if (entries[i].m_LastAccessed + c->m_MaxCacheEntryAge >= current_time)
-                        {
-                            // Keep cache entry, ie within max age
-                            Entry e;
-                            memcpy(e.m_Info.m_ETag, entries[i].m_ETag, sizeof(e.m_Info.m_ETag));
-                            e.m_Info.m_URI = dmPoolAllocator::Duplicate(c->m_StringAllocator, entries[i].m_URI);
-                            e.m_Info.m_IdentifierHash = entries[i].m_IdentifierHash;
-                            e.m_Info.m_LastAccessed = entries[i].m_LastAccessed;
-                            e.m_Info.m_Expires = entries[i].m_Expires;
-                            e.m_Info.m_Checksum = entries[i].m_Checksum;
-                            c->m_CacheTable.Put(entries[i].m_UriHash, e);
-                        }
-                        else
-                        {
-                            // Remove old cache entry
-                            RemoveCachedContentFile(c, entries[i].m_IdentifierHash);
-                        }
-                    }
-                }
+                CompactSlab(c, i);
             }
-            free(buffer);
-            fclose(f);
+        }
+
+        if (params->m_VerifyContent && c->m_Count > 0 && dmThread::PlatformHasThreadSupport())
+        {
+            c->m_Verifying = 1;
+            c->m_VerifyThread = dmThread::New(VerifyThread, 0x10000, c, "httpcacheverify");
         }
 
         *cache = c;
         return RESULT_OK;
     }
 
-    struct WriteEntryContext
+    static Result WriteIndex(HCache cache, FILE* f)
     {
-        FILE* m_File;
-        bool m_Error;
-        HashState64 m_HashState;
-        WriteEntryContext(FILE* f)
+        // Keep the index small if many entries were removed
+        if (cache->m_Table.Empty() || cache->m_Deleted * 4 > cache->m_Table.Size())
         {
-            m_File = f;
-            m_Error = false;
-            dmHashInit64(&m_HashState, false);
+            uint32_t capacity = MIN_TABLE_CAPACITY;
+            while ((cache->m_Count + 1) * 2 > capacity)
+                capacity *= 2;
+            Rehash(cache, capacity);
         }
-    };
 
-    static void WriteEntry(WriteEntryContext* context, const uint64_t* key, Entry* entry)
-    {
-        if (context->m_Error)
-            return;
+        uint32_t capacity = cache->m_Table.Size();
 
-        if(entry->m_WriteLock)
+        dmArray<FileEntry> file_entries;
+        file_entries.SetCapacity(capacity);
+        file_entries.SetSize(capacity);
+        dmArray<char> strings;
+
+        for (uint32_t i = 0; i < capacity; ++i)
         {
-            dmLogWarning("Invalid http cache state. Not yet flushed cache entry (etag: %s).", entry->m_Info.m_ETag);
-            return;
-        }
+            Entry* entry = &cache->m_Table[i];
+            FileEntry* file_entry = &file_entries[i];
+            *file_entry = entry->m_File;
 
-        FileEntry file_entry;
-        memset(&file_entry, 0, sizeof(file_entry));
+            if (entry->m_File.m_Flags != SLOT_USED)
+                continue;
 
-        file_entry.m_UriHash = *key;
-        memcpy(file_entry.m_ETag, entry->m_Info.m_ETag, sizeof(file_entry.m_ETag));
-        dmStrlCpy(file_entry.m_URI, entry->m_Info.m_URI, sizeof(file_entry.m_URI));
-        file_entry.m_IdentifierHash = entry->m_Info.m_IdentifierHash;
-        file_entry.m_LastAccessed = entry->m_Info.m_LastAccessed;
-        file_entry.m_Expires = entry->m_Info.m_Expires;
-        file_entry.m_Checksum = entry->m_Info.m_Checksum;
+            if (entry->m_WriteLock)
+            {
+                dmLogWarning("Invalid http cache state. Not yet flushed cache entry (etag: %s).", entry->m_File.m_ETag);
+                // Keep the slot, as it might be part of a probe sequence
+                memset(file_entry, 0, sizeof(*file_entry));
+                file_entry->m_Flags = SLOT_DELETED;
+                continue;
+            }
 
-        dmHashUpdateBuffer64(&context->m_HashState, &file_entry, sizeof(file_entry));
-        size_t n_written = fwrite(&file_entry, 1, sizeof(file_entry), context->m_File);
-        if (n_written != sizeof(file_entry))
-        {
-            context->m_Error = true;
+            uint32_t uri_len = strlen(entry->m_URI) + 1;
+            file_entry->m_URIOffset = strings.Size();
+            strings.OffsetCapacity(uri_len);
+            strings.PushArray(entry->m_URI, uri_len);
         }
-    }
 
-    static Result WriteIndex(HCache cache, FILE* f)
-    {
         IndexHeader header;
-
+        memset(&header, 0, sizeof(header));
         header.m_Magic = MAGIC;
         header.m_Version = VERSION;
-        header.m_Checksum = 0;
         header.m_SizeOfEntry = (uint32_t)sizeof(Entry);
         header.m_SizeOfFileEntry = (uint32_t)sizeof(FileEntry);
-        size_t n_written = fwrite(&header, 1, sizeof(header), f);
-        if (n_written != sizeof(header))
+        header.m_Capacity = capacity;
+        header.m_StringsSize = strings.Size();
+        for (uint32_t i = 0; i < SLAB_COUNT; ++i)
         {
-            return RESULT_IO_ERROR;
+            header.m_SlabSize[i] = cache->m_Slabs[i].m_Size;
+            header.m_SlabUnused[i] = cache->m_Slabs[i].m_Unused;
         }
-        else
+
+        HashState64 hash_state;
+        dmHashInit64(&hash_state, false);
+        dmHashUpdateBuffer64(&hash_state, file_entries.Begin(), sizeof(FileEntry) * capacity);
+        dmHashUpdateBuffer64(&hash_state, strings.Begin(), strings.Size());
+        header.m_Checksum = dmHashFinal64(&hash_state);
+
+        if (fwrite(&header, 1, sizeof(header), f) != sizeof(header) ||
+            fwrite(file_entries.Begin(), sizeof(FileEntry), capacity, f) != capacity ||
+            fwrite(strings.Begin(), 1, strings.Size(), f) != strings.Size())
         {
-            WriteEntryContext context(f);
-            cache->m_CacheTable.Iterate(&WriteEntry, &context);
-            if (context.m_Error)
-            {
-                return RESULT_IO_ERROR;
-            }
-            else
-            {
-                // Rewrite header with checksum
-                fseek(f, 0, SEEK_SET);
-                header.m_Checksum = dmHashFinal64(&context.m_HashState);
-                size_t n_written = fwrite(&header, 1, sizeof(header), f);
-                if (n_written != sizeof(header))
-                {
-                    return RESULT_IO_ERROR;
-                }
-            }
+            return RESULT_IO_ERROR;
         }
         return RESULT_OK;
     }
@@ -373,7 +841,8 @@ namespace dmHttpCache
         FILE* f = fopen(cache_file, "wb");
         if (f) {
             Result r = WriteIndex(cache, f);
-            fclose(f);
+            if (fclose(f) != 0)
+                r = RESULT_IO_ERROR;
             if (r != RESULT_OK) {
                 dmLogError("Error writing to index file '%s'", cache_file);
                 dmSys::Unlink(cache_file);
@@ -389,17 +858,24 @@ namespace dmHttpCache
 
     Result Close(HCache cache)
     {
+        if (cache->m_VerifyThread)
+        {
+            dmAtomicStore32(&cache->m_VerifyCancel, 1);
+            dmThread::Join(cache->m_VerifyThread);
+        }
+
         for (uint32_t i = 0; i < MAX_CACHE_CREATORS; ++i)
         {
             CacheCreator* h = &cache->m_CacheCreators[i];
-            if (h->m_Filename)
+            if (h->m_File)
             {
-                free(h->m_Filename);
+                fclose(h->m_File);
             }
 
-            if (h->m_File)
+            if (h->m_Filename)
             {
-                fclose(h->m_File);
+                dmSys::Unlink(h->m_Filename);
+                free(h->m_Filename);
             }
         }
 
@@ -425,11 +901,11 @@ namespace dmHttpCache
         dmHashUpdateBuffer64(&hash_state, etag, strlen(etag));
         uint64_t identifier_hash = dmHashFinal64(&hash_state);
 
-        Entry* entry = cache->m_CacheTable.Get(uri_hash);
+        Entry* entry = FindEntry(cache, uri_hash);
         if (entry)
         {
             // NOTE: Empty string is "no" etag so cache updates with identical tag is valid only for empty etag
-            if (entry->m_Info.m_IdentifierHash == identifier_hash && etag[0])
+            if (entry->m_File.m_IdentifierHash == identifier_hash && etag[0])
             {
                 dmLogWarning("Trying to update existing cache entry for uri: '%s' with etag: '%s'.", uri, etag);
                 return RESULT_ALREADY_CACHED;
@@ -448,46 +924,50 @@ namespace dmHttpCache
                 }
             }
         }
+
+        if (cache->m_CacheCreatorsPool.Remaining() == 0)
+        {
+            return RESULT_OUT_OF_RESOURCES;
+        }
+
+        if (entry)
+        {
+            // The old content is replaced
+            ReleaseContent(cache, entry);
+        }
         else
         {
             // New entry
-            Entry new_entry;
-            if (cache->m_CacheTable.Full())
-            {
-                uint32_t new_capacity = cache->m_CacheTable.Capacity() + 128;
-                cache->m_CacheTable.SetCapacity(dmMath::Max(1U, 2 * new_capacity / 3), new_capacity);
-            }
-            cache->m_CacheTable.Put(uri_hash, new_entry);
+            entry = InsertEntry(cache, uri_hash);
+            entry->m_URI = dmPoolAllocator::Duplicate(cache->m_StringAllocator, uri);
         }
 
-        entry = cache->m_CacheTable.Get(uri_hash);
-        dmStrlCpy(entry->m_Info.m_ETag, etag, sizeof(entry->m_Info.m_ETag));
-        entry->m_Info.m_URI = dmPoolAllocator::Duplicate(cache->m_StringAllocator, uri);
-        entry->m_Info.m_IdentifierHash = identifier_hash;
-        entry->m_Info.m_LastAccessed = dmTime::GetTime();
+        dmStrlCpy(entry->m_File.m_ETag, etag, sizeof(entry->m_File.m_ETag));
+        entry->m_File.m_IdentifierHash = identifier_hash;
+        entry->m_File.m_LastAccessed = dmTime::GetTime();
         if (max_age > 0) {
-            entry->m_Info.m_Expires = dmTime::GetTime() + max_age * 1000000U;
+            entry->m_File.m_Expires = dmTime::GetTime() + max_age * 1000000U;
         } else {
             // For clarity set m_Expries to 0 when max_age is 0 (i.e expires 1970..)
-            entry->m_Info.m_Expires = 0;
+            entry->m_File.m_Expires = 0;
         }
+        entry->m_Verified = 0;
+        entry->m_ContentChecked = 0;
         entry->m_WriteLock = 1;
 
-        if (cache->m_CacheCreatorsPool.Remaining() == 0)
-        {
-            return RESULT_OUT_OF_RESOURCES;
-        }
         uint16_t index = cache->m_CacheCreatorsPool.Pop();
 
         int file_name_len = strlen(cache->m_Path) + 1 /* slash */ + 8 /* tempXXXX */ + 1 /* '\0' */;
         char* file_name = (char*) malloc(file_name_len);
         dmSnPrintf(file_name, file_name_len, "%s/temp%04d", cache->m_Path, (int) index);
-        FILE* f = fopen(file_name, "wb");
+        // The content is copied into a slab on End
+        FILE* f = fopen(file_name, "w+b");
         if (f == 0)
         {
             dmLogError("Unable to open temporary file: '%s'", file_name);
             free(file_name);
             cache->m_CacheCreatorsPool.Push(index);
+            EraseEntry(cache, entry);
             return RESULT_IO_ERROR;
         }
 
@@ -497,7 +977,8 @@ namespace dmHttpCache
         handle->m_File = f;
         handle->m_Filename = file_name;
         handle->m_IdentifierHash = identifier_hash;
-        handle->m_UriHash = dmHashString64(uri);
+        handle->m_UriHash = uri_hash;
+        handle->m_Size = 0;
         handle->m_Error = 0;
         *cache_creator = handle;
 
@@ -541,6 +1022,7 @@ namespace dmHttpCache
             cache_creator->m_Error = 1;
             return RESULT_IO_ERROR;
         }
+        cache_creator->m_Size += content_len;
 
         return RESULT_OK;
     }
@@ -550,77 +1032,102 @@ namespace dmHttpCache
         cache_creator->m_Error = 1;
     }
 
-    Result End(HCache cache, HCacheCreator cache_creator)
+    // Appends the content of the temporary file to the slab. Called without the cache lock
+    static bool AppendToSlab(HCache cache, uint32_t slab_index, uint32_t offset, HCacheCreator cache_creator)
     {
-        dmMutex::ScopedLock lock(cache->m_Mutex);
-
-        assert(cache_creator->m_File && cache_creator->m_Filename);
-        uint64_t identifier_hash = cache_creator->m_IdentifierHash;
+        Slab* slab = &cache->m_Slabs[slab_index];
+        DM_MUTEX_SCOPED_LOCK(slab->m_WriteMutex);
 
-        fclose(cache_creator->m_File);
-        cache_creator->m_File = 0;
+        char path[DMPATH_MAX_PATH];
+        SlabFilePath(cache, slab_index, path, sizeof(path));
+        if (!slab->m_File)
+        {
+            slab->m_File = fopen(path, "r+b");
+            if (!slab->m_File)
+                slab->m_File = fopen(path, "w+b");
+            if (!slab->m_File)
+            {
+                dmLogError("Unable to open cache file: '%s'", path);
+                return false;
+            }
+        }
 
-        uint64_t uri_hash = cache_creator->m_UriHash;
-        Entry* entry = cache->m_CacheTable.Get(uri_hash);
-        assert(entry);
+        uint8_t* buffer = (uint8_t*) malloc(COPY_BUFFER_SIZE);
+        bool ok = fseek(cache_creator->m_File, 0, SEEK_SET) == 0 &&
+                  fseek(slab->m_File, offset, SEEK_SET) == 0 &&
+                  CopyContent(slab->m_File, cache_creator->m_File, cache_creator->m_Size, buffer) &&
+                  fflush(slab->m_File) == 0;
+        free(buffer);
 
-        if (cache_creator->m_Error)
+        if (!ok)
         {
-            dmSys::Unlink(cache_creator->m_Filename);
-            FreeCacheCreator(cache, cache_creator);
-            cache->m_CacheTable.Erase(uri_hash);
-            return RESULT_IO_ERROR;
+            dmLogError("Error writing to cache file: '%s'", path);
         }
+        return ok;
+    }
 
-        char path[DMPATH_MAX_PATH];
-        ContentFilePath(cache, identifier_hash, path, sizeof(path));
-        if (dmSys::Exists(path))
+    Result End(HCache cache, HCacheCreator cache_creator)
+    {
+        assert(cache_creator->m_File && cache_creator->m_Filename);
+
+        uint32_t slab_index = 0;
+        uint32_t offset = 0;
         {
-            dmSys::Result r = dmSys::Unlink(path);
-            if (r != dmSys::RESULT_OK)
+            dmMutex::ScopedLock lock(cache->m_Mutex);
+
+            Entry* entry = FindEntry(cache, cache_creator->m_UriHash);
+            assert(entry);
+
+            // Reserve the space in the smallest slab
+            for (uint32_t i = 1; i < SLAB_COUNT; ++i)
             {
-                dmLogError("Unable to remove cache file: %s", path);
-                FreeCacheCreator(cache, cache_creator);
-                cache->m_CacheTable.Erase(uri_hash);
-                return RESULT_IO_ERROR;
+                if (cache->m_Slabs[i].m_Size < cache->m_Slabs[slab_index].m_Size)
+                    slab_index = i;
             }
-        }
-        else
-        {
-            // Modify path and remove last part of hash temporarily
-            // ie, .../5d/a7b8fa56d18877 to .../5d
-            char* last_slash = strrchr(path, '/');
-            char save = *last_slash;
-            *last_slash = '\0';
-            if (!dmSys::Exists(path))
+            Slab* slab = &cache->m_Slabs[slab_index];
+
+            if (!cache_creator->m_Error && (uint64_t) slab->m_Size + cache_creator->m_Size > 0xffffffffU)
             {
-                dmSys::Result r = dmSys::Mkdir(path, 0755);
-                if (r != dmSys::RESULT_OK)
-                {
-                    dmLogError("Unable to create directory '%s'", path);
-                    FreeCacheCreator(cache, cache_creator);
-                    cache->m_CacheTable.Erase(uri_hash);
-                    return RESULT_IO_ERROR;
-                }
+                dmLogError("Http cache is full");
+                cache_creator->m_Error = 1;
             }
-            *last_slash = save;
+
+            if (cache_creator->m_Error)
+            {
+                FreeCacheCreator(cache, cache_creator);
+                EraseEntry(cache, entry);
+                return RESULT_IO_ERROR;
+            }
+
+            offset = slab->m_Size;
+            slab->m_Size += cache_creator->m_Size;
         }
 
+        bool ok = AppendToSlab(cache, slab_index, offset, cache_creator);
+
+        dmMutex::ScopedLock lock(cache->m_Mutex);
+        Entry* entry = FindEntry(cache, cache_creator->m_UriHash);
+        assert(entry);
         assert(entry->m_WriteLock);
-        assert(entry->m_Info.m_IdentifierHash == identifier_hash);
+        assert(entry->m_File.m_IdentifierHash == cache_creator->m_IdentifierHash);
         entry->m_WriteLock = 0;
-        entry->m_Info.m_Checksum = dmHashFinal64(&cache_creator->m_ChecksumState);
 
-        if (dmSys::RESULT_OK != dmSys::Rename(path, cache_creator->m_Filename))
+        if (!ok)
         {
-            char errmsg[128] = {};
-            dmStrError(errmsg, sizeof(errmsg), errno);
-            dmLogError("Unable to rename temporary cache file from '%s' to '%s'. %s (%d)", cache_creator->m_Filename, path, errmsg, errno);
+            // The reserved space is lost until the slab is compacted
+            cache->m_Slabs[slab_index].m_Unused += cache_creator->m_Size;
             FreeCacheCreator(cache, cache_creator);
-            cache->m_CacheTable.Erase(uri_hash);
+            EraseEntry(cache, entry);
+            cache->m_Dirty = true;
             return RESULT_IO_ERROR;
         }
 
+        entry->m_File.m_Slab = (uint16_t) slab_index;
+        entry->m_File.m_Offset = offset;
+        entry->m_File.m_Size = cache_creator->m_Size;
+        entry->m_File.m_Checksum = dmHashFinal64(&cache_creator->m_ChecksumState);
+        entry->m_ContentChecked = 1;
+
         FreeCacheCreator(cache, cache_creator);
         cache->m_Dirty = true;
 
@@ -632,11 +1139,11 @@ namespace dmHttpCache
         dmMutex::ScopedLock lock(cache->m_Mutex);
 
         uint64_t uri_hash = dmHashString64(uri);
-        Entry* entry = cache->m_CacheTable.Get(uri_hash);
+        Entry* entry = FindEntry(cache, uri_hash);
         if (entry != 0)
         {
-            if (entry->m_Info.m_ETag[0]) {
-                dmStrlCpy(tag_buffer, entry->m_Info.m_ETag, tag_buffer_len);
+            if (entry->m_File.m_ETag[0]) {
+                dmStrlCpy(tag_buffer, entry->m_File.m_ETag, tag_buffer_len);
                 return RESULT_OK;
             } else {
                 return RESULT_NO_ETAG;
@@ -648,15 +1155,27 @@ namespace dmHttpCache
         }
     }
 
+    static void FillEntryInfo(Entry* entry, EntryInfo* info)
+    {
+        memset(info, 0, sizeof(*info));
+        memcpy(info->m_ETag, entry->m_File.m_ETag, sizeof(info->m_ETag));
+        info->m_URI = (char*) entry->m_URI;
+        info->m_IdentifierHash = entry->m_File.m_IdentifierHash;
+        info->m_LastAccessed = entry->m_File.m_LastAccessed;
+        info->m_Expires = entry->m_File.m_Expires;
+        info->m_Checksum = entry->m_File.m_Checksum;
+        info->m_Verified = entry->m_Verified;
+    }
+
     Result GetInfo(HCache cache, const char* uri, EntryInfo* info)
     {
         dmMutex::ScopedLock lock(cache->m_Mutex);
 
         uint64_t uri_hash = dmHashString64(uri);
-        Entry* entry = cache->m_CacheTable.Get(uri_hash);
+        Entry* entry = FindEntry(cache, uri_hash);
         if (entry != 0)
         {
-            memcpy(info, &entry->m_Info, sizeof(*info));
+            FillEntryInfo(entry, info);
             info->m_Valid = dmTime::GetTime() < info->m_Expires;
             return RESULT_OK;
         }
@@ -677,8 +1196,8 @@ namespace dmHttpCache
         uint64_t identifier_hash = dmHashFinal64(&hash_state);
 
         uint64_t uri_hash = dmHashString64(uri);
-        Entry* entry = cache->m_CacheTable.Get(uri_hash);
-        if (entry != 0 && entry->m_Info.m_IdentifierHash == identifier_hash)
+        Entry* entry = FindEntry(cache, uri_hash);
+        if (entry != 0 && entry->m_File.m_IdentifierHash == identifier_hash)
         {
             if (entry->m_WriteLock)
             {
@@ -686,32 +1205,50 @@ namespace dmHttpCache
                 return RESULT_LOCKED;
             }
 
-            entry->m_Info.m_LastAccessed = dmTime::GetTime();
+            entry->m_File.m_LastAccessed = dmTime::GetTime();
 
-            char path[DMPATH_MAX_PATH];
-            ContentFilePath(cache, identifier_hash, path, sizeof(path));
-            FILE* f = fopen(path, "rb");
-            if (f)
+            // Reuse a pooled handle, so that a cache hit is a seek and a read
+            Slab* slab = &cache->m_Slabs[entry->m_File.m_Slab];
+            FILE* f = 0;
+            if (!slab->m_Readers.Empty())
             {
-                if (file_size)
+                f = slab->m_Readers.Back();
+                slab->m_Readers.Pop();
+            }
+            else
+            {
+                char path[DMPATH_MAX_PATH];
+                SlabFilePath(cache, entry->m_File.m_Slab, path, sizeof(path));
+                f = fopen(path, "rb");
+                if (!f)
                 {
-                    fseek(f, 0L, SEEK_END);
-                    *file_size = ftell(f);
-                    fseek(f, 0L, SEEK_SET);
+                    dmLogError("Unable to open %s", path);
+                    // Remove invalid cache entry
+                    EraseEntry(cache, entry);
+                    cache->m_Dirty = true;
+                    return RESULT_NO_ENTRY;
                 }
-
-                *file = f;
-                entry->m_ReadLockCount++;
-                *checksum = entry->m_Info.m_Checksum;
-                return RESULT_OK;
+                // The callers read in large chunks, and a buffer could hold stale data when the handle is reused
+                setvbuf(f, 0, _IONBF, 0);
             }
-            else
+
+            if (fseek(f, entry->m_File.m_Offset, SEEK_SET) != 0)
             {
-                dmLogError("Unable to open %s", path);
-                // Remove invalid cache entry
-                cache->m_CacheTable.Erase(uri_hash);
+                fclose(f);
+                EraseEntry(cache, entry);
+                cache->m_Dirty = true;
                 return RESULT_NO_ENTRY;
             }
+
+            if (file_size)
+            {
+                *file_size = entry->m_File.m_Size;
+            }
+
+            *file = f;
+            entry->m_ReadLockCount++;
+            *checksum = entry->m_File.m_Checksum;
+            return RESULT_OK;
         }
 
         return RESULT_NO_ENTRY;
@@ -722,10 +1259,10 @@ namespace dmHttpCache
         dmMutex::ScopedLock lock(cache->m_Mutex);
 
         uint64_t uri_hash = dmHashString64(uri);
-        Entry* entry = cache->m_CacheTable.Get(uri_hash);
+        Entry* entry = FindEntry(cache, uri_hash);
         if (entry != 0)
         {
-            entry->m_Info.m_Verified = verified;
+            entry->m_Verified = verified;
             return RESULT_OK;
         }
         else
@@ -745,40 +1282,36 @@ namespace dmHttpCache
         uint64_t identifier_hash = dmHashFinal64(&hash_state);
 
         uint64_t uri_hash = dmHashString64(uri);
-        Entry* entry = cache->m_CacheTable.Get(uri_hash);
+        Entry* entry = FindEntry(cache, uri_hash);
         assert(entry);
-        assert(entry->m_Info.m_IdentifierHash == identifier_hash);
-        assert(strcmp(uri, entry->m_Info.m_URI) == 0);
+        assert(entry->m_File.m_IdentifierHash == identifier_hash);
+        assert(strcmp(uri, entry->m_URI) == 0);
         assert(entry->m_ReadLockCount > 0);
         --entry->m_ReadLockCount;
 
-        fclose(file);
+        Slab* slab = &cache->m_Slabs[entry->m_File.m_Slab];
+        if (slab->m_Readers.Size() < MAX_SLAB_READERS)
+        {
+            if (slab->m_Readers.Full())
+                slab->m_Readers.SetCapacity(MAX_SLAB_READERS);
+            slab->m_Readers.Push(file);
+        }
+        else
+        {
+            fclose(file);
+        }
         return RESULT_OK;
     }
 
     uint32_t GetEntryCount(HCache cache)
     {
         dmMutex::ScopedLock lock(cache->m_Mutex);
-        return cache->m_CacheTable.Size();
+        return cache->m_Count;
     }
 
-    struct IterateContext
-    {
-        IterateContext(HCache cache, void* context, void (*callback)(void* context, const EntryInfo* entry_info))
-        {
-            m_Cache = cache;
-            m_Context = context;
-            m_Callback = callback;
-        }
-
-        HCache m_Cache;
-        void*  m_Context;
-        void (*m_Callback)(void* context, const EntryInfo* entry_info);
-    };
-
-    static void IterateCallback(IterateContext *context, const uint64_t* key, Entry* value)
+    bool IsVerifyingContent(HCache cache)
     {
-        context->m_Callback(context->m_Context, &value->m_Info);
+        return dmAtomicGet32(&cache->m_Verifying) != 0;
     }
 
     void SetConsistencyPolicy(HCache cache, ConsistencyPolicy policy)
@@ -796,8 +1329,15 @@ namespace dmHttpCache
     void Iterate(HCache cache, void* context, void (*call_back)(void* context, const EntryInfo* entry_info))
     {
         dmMutex::ScopedLock lock(cache->m_Mutex);
-        IterateContext iterate_context(cache, context, call_back);
-        cache->m_CacheTable.Iterate(&IterateCallback, &iterate_context);
+        for (uint32_t i = 0; i < cache->m_Table.Size(); ++i)
+        {
+            Entry* entry = &cache->m_Table[i];
+            if (entry->m_File.m_Flags != SLOT_USED)
+                continue;
+            EntryInfo info;
+            FillEntryInfo(entry, &info);
+            call_back(context, &info);
+        }
     }
 
 }
@@ -96,6 +96,10 @@ namespace dmHttpCache
         /// Default value is 60 * 60 * 24 * 5, ie 5 days
         uint64_t    m_MaxCacheEntryAge;
 
+        /// Verify the content checksums on a background thread. Corrupt entries are removed.
+        /// Default value is 0. See IsVerifyingContent
+        uint32_t    m_VerifyContent : 1;
+
         NewParams()
         {
             SetDefaultParams(this);
@@ -173,11 +177,13 @@ namespace dmHttpCache
     Result GetInfo(HCache cache, const char* uri, EntryInfo* info);
 
     /**
-     * Get file for cache entry
+     * Get file for cache entry. The content is stored along with other entries, so the file is positioned
+     * at the start of the content, and must not be read beyond file_size bytes. The file must be returned with Release.
      * @param cache cache
      * @param uri uri
      * @param etag etag
      * @param file file representing the cached content
+     * @param file_size size of the content (out)
      * @param checksum content checksum (dmHashString64)
      * @return RESULT_OK on success.
      */
@@ -209,6 +215,13 @@ namespace dmHttpCache
      */
     uint32_t GetEntryCount(HCache cache);
 
+    /**
+     * Check if the content is still being verified, see NewParams::m_VerifyContent
+     * @param cache http cache handle
+     * @return true if the verification is in progress
+     */
+    bool IsVerifyingContent(HCache cache);
+
     /**
      * Set consistency policy
      * @param cache cache
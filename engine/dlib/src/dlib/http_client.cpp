@@ -19,7 +19,9 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include "math.h"
+#include "array.h"
 #include "http_client.h"
+#include "http2.h"
 #include "log.h"
 #include "sys.h"
 #include "dstrings.h"
@@ -127,6 +129,12 @@ namespace dmHttpClient
         dmSocket::Socket                m_Socket;
         dmSSLSocket::Socket             m_SSLSocket;
 
+        // HTTP/2. The session is shared with the other requests to the same host
+        dmHttp2::HSession               m_Session;
+        dmHttp2::HStream                m_Stream;
+        dmArray<char>                   m_RequestHeaders; // From WriteHeader(), as "name\0value\0..."
+        uint32_t                        m_StreamRefused : 1;
+
         Response(HClient client)
         {
             m_Client = client;
@@ -145,6 +153,9 @@ namespace dmHttpClient
             m_Connection = 0;
             m_Socket = 0;
             m_SSLSocket = 0;
+            m_Session = 0;
+            m_Stream = 0;
+            m_StreamRefused = 0;
         }
         Result Connect(const char* host, uint16_t port, bool secure, int timeout, int* canceled);
         ~Response();
@@ -184,6 +195,7 @@ namespace dmHttpClient
         uint16_t            m_Port;
         uint16_t            m_IgnoreCache:1;
         uint16_t            m_ChunkedTransfer:1;
+        uint16_t            m_Http2:1;
         int*                m_CancelFlag;
 
         // Used both for reading header and content. NOTE: Extra byte for null-termination
@@ -193,15 +205,19 @@ namespace dmHttpClient
     Result Response::Connect(const char* host, uint16_t port, bool secure, int timeout, int* canceled)
     {
         m_Pool = g_PoolCreator.GetPool();
-        dmConnectionPool::Result r = dmConnectionPool::Dial(m_Pool, host, port, secure, timeout, canceled, &m_Connection, &m_Client->m_SocketResult);
+        dmConnectionPool::Result r = dmConnectionPool::Dial(m_Pool, host, port, secure, m_Client->m_Http2, timeout, canceled, &m_Connection, &m_Client->m_SocketResult);
 
         if (r == dmConnectionPool::RESULT_OK) {
 
             m_Socket = dmConnectionPool::GetSocket(m_Pool, m_Connection);
             m_SSLSocket = dmConnectionPool::GetSSLSocket(m_Pool, m_Connection);
+            m_Session = dmConnectionPool::GetHttp2Session(m_Pool, m_Connection);
 
-            dmSocket::SetSendTimeout(m_Socket, SOCKET_TIMEOUT);
-            dmSocket::SetReceiveTimeout(m_Socket, SOCKET_TIMEOUT);
+            // A shared HTTP/2 connection is read by all its users, and the session sets the timeouts
+            if (!m_Session) {
+                dmSocket::SetSendTimeout(m_Socket, SOCKET_TIMEOUT);
+                dmSocket::SetReceiveTimeout(m_Socket, SOCKET_TIMEOUT);
+            }
 
             return RESULT_OK;
         } else {
@@ -211,7 +227,13 @@ namespace dmHttpClient
 
     Response::~Response()
     {
-        if (m_Connection) {
+        if (m_Session) {
+            if (m_Stream)
+                dmHttp2::CloseStream(m_Session, m_Stream);
+            // The pool closes the connection when the last user returns it, if the session is lost
+            dmConnectionPool::Return(m_Pool, m_Connection);
+        }
+        else if (m_Connection) {
             if (m_CloseConnection || m_Client->m_SocketResult != dmSocket::RESULT_OK) {
                 dmConnectionPool::Close(m_Pool, m_Connection);
             } else {
@@ -298,6 +320,9 @@ namespace dmHttpClient
             case OPTION_REQUEST_CHUNKED_TRANSFER:
                 client->m_ChunkedTransfer = value != 0 ? 1 : 0;
                 break;
+            case OPTION_REQUEST_HTTP2:
+                client->m_Http2 = value != 0 ? 1 : 0;
+                break;
             default:
                 return RESULT_INVAL_ERROR;
         }
@@ -495,13 +520,46 @@ namespace dmHttpClient
         return RESULT_OK;
     }
 
+    static dmSocket::Result Http2ToSocketResult(Response* response, dmHttp2::Result r)
+    {
+        if (r == dmHttp2::RESULT_OK)
+            return dmSocket::RESULT_OK;
+        // The server didn't process the stream, so it's safe to retry it on a new connection
+        if (r == dmHttp2::RESULT_REFUSED || r == dmHttp2::RESULT_OUT_OF_RESOURCES)
+            response->m_StreamRefused = 1;
+        return dmSocket::RESULT_CONNRESET;
+    }
+
+    static dmSocket::Result SendDataHttp2(Response* response, const char* buffer, uint32_t length, bool end_stream)
+    {
+        do
+        {
+            uint32_t sent = 0;
+            dmHttp2::Result r = dmHttp2::SendData(response->m_Session, response->m_Stream, buffer, length, end_stream, &sent);
+            buffer += sent;
+            length -= sent;
+            if (r == dmHttp2::RESULT_OK)
+                break;
+            if (r != dmHttp2::RESULT_WOULDBLOCK)
+                return Http2ToSocketResult(response, r);
+            // Waiting for the server to open the flow control window
+            if (HasRequestTimedOut(response->m_Client))
+                return dmSocket::RESULT_WOULDBLOCK;
+        } while (true);
+        return dmSocket::RESULT_OK;
+    }
+
     Result Write(HResponse response, const void* buffer, uint32_t buffer_size)
     {
         HClient client = response->m_Client;
         if (client->m_SocketResult != dmSocket::RESULT_OK) {
             return RESULT_SOCKET_ERROR;
         }
-        dmSocket::Result sock_res = SendAll(response, (const char*) buffer, buffer_size);
+        dmSocket::Result sock_res;
+        if (response->m_Session)
+            sock_res = SendDataHttp2(response, (const char*) buffer, buffer_size, false);
+        else
+            sock_res = SendAll(response, (const char*) buffer, buffer_size);
         if (sock_res != dmSocket::RESULT_OK)
         {
             client->m_SocketResult = sock_res;
@@ -519,6 +577,25 @@ namespace dmHttpClient
         }
         dmSocket::Result sock_res;
 
+        if (response->m_Session)
+        {
+            // Sent with the HEADERS frame when the stream is opened
+            // The host is sent as ":authority", and the connection specific headers aren't allowed in HTTP/2
+            if (dmStrCaseCmp(name, "Host") == 0 || dmStrCaseCmp(name, "Connection") == 0 || dmStrCaseCmp(name, "Keep-Alive") == 0 ||
+                dmStrCaseCmp(name, "Proxy-Connection") == 0 || dmStrCaseCmp(name, "Transfer-Encoding") == 0 || dmStrCaseCmp(name, "Upgrade") == 0)
+            {
+                return RESULT_OK;
+            }
+            uint32_t name_len = strlen(name);
+            uint32_t value_len = strlen(value);
+            dmArray<char>& headers = response->m_RequestHeaders;
+            headers.OffsetCapacity(name_len + value_len + 2);
+            for (uint32_t i = 0; i <= name_len; ++i)
+                headers.Push((char)tolower(name[i]));
+            headers.PushArray(value, value_len + 1);
+            return RESULT_OK;
+        }
+
         // DEF-2889 most webservers have a header length limit of 8096 bytes
         char buf[8096];
         const int bufsize = sizeof(buf);
@@ -642,6 +719,151 @@ bail:
         return client->m_SocketResult;
     }
 
+    static dmSocket::Result SendRequestHttp2(HClient client, HResponse response, const char* encoded_path, const char* method)
+    {
+        bool has_body = strcmp(method, "POST") == 0 || strcmp(method, "PUT") == 0 || strcmp(method, "PATCH") == 0;
+        uint32_t send_content_length = 0;
+
+        response->m_RequestHeaders.SetSize(0);
+        if (client->m_HttpWriteHeaders) {
+            Result header_result = client->m_HttpWriteHeaders(response, client->m_Userdata);
+            if (header_result != RESULT_OK) {
+                return client->m_SocketResult;
+            }
+        }
+        if (!client->m_IgnoreCache && client->m_HttpCache)
+        {
+            char etag[64];
+            dmHttpCache::Result cache_result = dmHttpCache::GetETag(client->m_HttpCache, client->m_URI, etag, sizeof(etag));
+            if (cache_result == dmHttpCache::RESULT_OK)
+            {
+                WriteHeader(response, "If-None-Match", etag);
+            }
+        }
+        if (has_body) {
+            // There is no chunked transfer encoding in HTTP/2, the body is sent in DATA frames
+            send_content_length = client->m_HttpSendContentLength(response, client->m_Userdata);
+            char buf[64];
+            dmSnPrintf(buf, sizeof(buf), "%d", send_content_length);
+            WriteHeader(response, "Content-Length", buf);
+        }
+
+        char authority[256];
+        if (client->m_Port == 443)
+            dmStrlCpy(authority, client->m_Hostname, sizeof(authority));
+        else
+            dmSnPrintf(authority, sizeof(authority), "%s:%d", client->m_Hostname, (int) client->m_Port);
+
+        dmArray<dmHttp2::Header> headers;
+        headers.SetCapacity(16);
+        dmHttp2::Header pseudo[] = {
+            { ":method", method },
+            { ":scheme", "https" },
+            { ":authority", authority },
+            { ":path", encoded_path },
+        };
+        headers.PushArray(pseudo, DM_ARRAY_SIZE(pseudo));
+
+        const char* p = response->m_RequestHeaders.Begin();
+        const char* end = response->m_RequestHeaders.End();
+        while (p < end)
+        {
+            dmHttp2::Header header;
+            header.m_Name = p;
+            header.m_Value = p + strlen(p) + 1;
+            p = header.m_Value + strlen(header.m_Value) + 1;
+            if (headers.Full())
+                headers.OffsetCapacity(16);
+            headers.Push(header);
+        }
+
+        dmHttp2::Result r = dmHttp2::OpenStream(response->m_Session, headers.Begin(), headers.Size(), !has_body, &response->m_Stream);
+        if (r != dmHttp2::RESULT_OK) {
+            client->m_SocketResult = Http2ToSocketResult(response, r);
+            return client->m_SocketResult;
+        }
+
+        if (has_body)
+        {
+            Result post_result = client->m_HttpWrite(response, 0, send_content_length, client->m_Userdata);
+            if (post_result != RESULT_OK) {
+                return client->m_SocketResult;
+            }
+            dmSocket::Result sock_res = SendDataHttp2(response, 0, 0, true);
+            if (sock_res != dmSocket::RESULT_OK) {
+                client->m_SocketResult = sock_res;
+            }
+        }
+        return client->m_SocketResult;
+    }
+
+    static Result RecvHeadersHttp2(HClient client, Response* response)
+    {
+        response->m_Major = 2;
+        response->m_Minor = 0;
+        while (true)
+        {
+            // The status is set before the header callbacks are called, as HandleHeader() passes it on
+            dmHttp2::Result r = dmHttp2::ReceiveHeaders(response->m_Session, response->m_Stream, &response->m_Status, &HandleHeader, response);
+            if (r == dmHttp2::RESULT_OK)
+                return RESULT_OK;
+
+            if (r != dmHttp2::RESULT_WOULDBLOCK) {
+                client->m_SocketResult = Http2ToSocketResult(response, r);
+                return RESULT_SOCKET_ERROR;
+            }
+            if (HasRequestTimedOut(client)) {
+                client->m_SocketResult = dmSocket::RESULT_WOULDBLOCK;
+                return RESULT_SOCKET_ERROR;
+            }
+        }
+    }
+
+    static Result DoTransferHttp2(HClient client, Response* response, bool add_to_cache, const char* method)
+    {
+        int total_transferred = 0;
+        while (true)
+        {
+            uint32_t recv_bytes = 0;
+            bool end = false;
+            dmHttp2::Result r = dmHttp2::ReceiveData(response->m_Session, response->m_Stream, client->m_Buffer, BUFFER_SIZE, &recv_bytes, &end);
+            if (r == dmHttp2::RESULT_OK)
+            {
+                if (recv_bytes > 0)
+                {
+                    // NOTE: We have an extra byte for null-termination so no buffer overrun here.
+                    client->m_Buffer[recv_bytes] = '\0';
+                    client->m_HttpContent(response, client->m_Userdata, response->m_Status, client->m_Buffer, recv_bytes, response->m_ContentLength, method);
+                    if (response->m_CacheCreator && add_to_cache)
+                    {
+                        dmHttpCache::Add(client->m_HttpCache, response->m_CacheCreator, client->m_Buffer, recv_bytes);
+                    }
+                    total_transferred += (int) recv_bytes;
+                }
+                if (end)
+                    break;
+            }
+            else if (r == dmHttp2::RESULT_WOULDBLOCK)
+            {
+                if (HasRequestTimedOut(client)) {
+                    client->m_SocketResult = dmSocket::RESULT_WOULDBLOCK;
+                    return RESULT_SOCKET_ERROR;
+                }
+            }
+            else
+            {
+                client->m_SocketResult = Http2ToSocketResult(response, r);
+                return RESULT_SOCKET_ERROR;
+            }
+        }
+
+        if (response->m_ContentLength != -1 && total_transferred != response->m_ContentLength)
+        {
+            return RESULT_PARTIAL_CONTENT;
+        }
+        return RESULT_OK;
+    }
+
     static Result DoTransfer(HClient client, Response* response, int to_transfer, HttpContent http_content, bool add_to_cache, const char* method)
     {
         // to_transfer can be set to -1 when the "Content-Length" is unknown
@@ -796,10 +1018,13 @@ bail:
             else
             {
                 // NOTE: We have an extra byte for null-termination so no buffer overrun here.
+                // The file is shared with other cache entries, so we only read the size of the entry
+                uint32_t remaining = file_size;
                 size_t nread;
                 do
                 {
-                    nread = fread(client->m_Buffer, 1, BUFFER_SIZE, file);
+                    nread = remaining > 0 ? fread(client->m_Buffer, 1, dmMath::Min(remaining, (uint32_t) BUFFER_SIZE), file) : 0;
+                    remaining -= (uint32_t) nread;
                     client->m_Buffer[nread] = '\0';
                     client->m_HttpContent(response, client->m_Userdata, response->m_Status, client->m_Buffer, nread, file_size, 0);
                 }
@@ -823,7 +1048,15 @@ bail:
 
         client->m_HttpContent(response, client->m_Userdata, response->m_Status, 0, 0, 0, 0);
 
-        if (strcmp(method, "HEAD") == 0) {
+        if (response->m_Session) {
+            // The body is framed by the stream, so the same loop handles all the transfers
+            if (strcmp(method, "HEAD") == 0) {
+                client->m_HttpContent(response, client->m_Userdata, response->m_Status, client->m_Buffer, 0, response->m_ContentLength, method);
+                return RESULT_OK;
+            }
+            r = DoTransferHttp2(client, response, true, method);
+        }
+        else if (strcmp(method, "HEAD") == 0) {
             // A response from a HEAD request should not attempt to read any body despite
             // content length being non-zero, but we still call DoTransfer (with a
             // content length of 0) to ensure that the response is setup properly
@@ -917,7 +1150,10 @@ bail:
     {
         dmSocket::Result sock_res;
 
-        sock_res = SendRequest(client, &response, path, method);
+        if (response.m_Session)
+            sock_res = SendRequestHttp2(client, &response, path, method);
+        else
+            sock_res = SendRequest(client, &response, path, method);
 
         bool method_is_head = strcmp(method, "HEAD") == 0;
 
@@ -926,7 +1162,7 @@ bail:
             return RESULT_SOCKET_ERROR;
         }
 
-        Result r = RecvAndParseHeaders(client, &response);
+        Result r = response.m_Session ? RecvHeadersHttp2(client, &response) : RecvAndParseHeaders(client, &response);
         if (r != RESULT_OK)
         {
             response.m_CloseConnection = 1;
@@ -1047,7 +1283,16 @@ bail:
 
                 uint32_t count = dmConnectionPool::GetReuseCount(response.m_Pool, response.m_Connection);
 
-                if (count > 0 && response.m_TotalReceived == 0) {
+                bool retry;
+                if (response.m_Session) {
+                    // The server didn't process the request: the stream was refused, or the
+                    // shared connection was lost before we got any response
+                    retry = response.m_StreamRefused || (count > 0 && response.m_Status == 0 && !dmHttp2::IsAlive(response.m_Session));
+                } else {
+                    retry = count > 0 && response.m_TotalReceived == 0;
+                }
+
+                if (retry) {
                     client->m_Statistics.m_Reconnections++;
                     // We assume that the connection was closed by remote peer
                     // as the total received data is zero bytes.
@@ -1081,10 +1326,12 @@ bail:
         if (cache_result == dmHttpCache::RESULT_OK)
         {
             // NOTE: We have an extra byte for null-termination so no buffer overrun here.
+            uint32_t remaining = file_size;
             size_t nread;
             do
             {
-                nread = fread(client->m_Buffer, 1, BUFFER_SIZE, file);
+                nread = remaining > 0 ? fread(client->m_Buffer, 1, dmMath::Min(remaining, (uint32_t) BUFFER_SIZE), file) : 0;
+                remaining -= (uint32_t) nread;
                 client->m_Buffer[nread] = '\0';
                 client->m_HttpContent(&response, client->m_Userdata, 304, client->m_Buffer, nread, file_size, "GET");
             }
@@ -1193,6 +1440,18 @@ bail:
         dmConnectionPool::Reopen(pool);
     }
 
+    Result Warmup(const char* hostname, uint16_t port, bool secure, bool http2, int timeout, int* cancelflag)
+    {
+        dmConnectionPool::HPool pool = g_PoolCreator.GetPool();
+        dmConnectionPool::Result r = dmConnectionPool::Warmup(pool, hostname, port, secure, http2, timeout, cancelflag);
+        if (r != dmConnectionPool::RESULT_OK)
+        {
+            dmLogWarning("Failed to warm up connection to %s:%d (%d)", hostname, port, r);
+            return r == dmConnectionPool::RESULT_HANDSHAKE_FAILED ? RESULT_HANDSHAKE_FAILED : RESULT_SOCKET_ERROR;
+        }
+        return RESULT_OK;
+    }
+
     uint32_t GetNumPoolConnections()
     {
         dmConnectionPool::HPool pool = g_PoolCreator.GetPool();
@@ -110,6 +110,8 @@ namespace dmHttpClient
         OPTION_REQUEST_IGNORE_CACHE,
         /// Use chunked transfer encoding for POST/PUT if request data is larger than 16k
         OPTION_REQUEST_CHUNKED_TRANSFER,
+        /// Use HTTP/2 if the server supports it (secure connections only). The requests to the same host are then multiplexed over a shared connection
+        OPTION_REQUEST_HTTP2,
     };
 
     /**
@@ -287,6 +289,19 @@ namespace dmHttpClient
     */
     void ReopenConnectionPool();
 
+    /**
+     * Connect to a host ahead of the first request, e.g. during startup, and keep the connection in the internal
+     * connection pool. Blocks until connected, so it's best called from a worker thread.
+     * @param hostname Hostname
+     * @param port Port number
+     * @param secure true for https connections
+     * @param http2 true to offer HTTP/2 to secure hosts
+     * @param timeout Timeout in microseconds, or 0 for no timeout
+     * @param cancelflag If non null and set, will abort the call
+     * @return RESULT_OK on success
+     */
+    Result Warmup(const char* hostname, uint16_t port, bool secure, bool http2, int timeout, int* cancelflag);
+
     /**
      * Convert result value to string
      * @param result Result to convert
@@ -12,6 +12,7 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include <stdlib.h>
 #include <string.h>
 #include <dlib/log.h>
 #include "image.h"
@@ -31,35 +32,103 @@
 #define STBI_FAILURE_USERMSG
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_NO_THREAD_LOCALS
+// The SSE2 paths are picked automatically, the NEON paths have to be asked for
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define STBI_NEON
+#endif
 #include "../stb/stb_image.h"
 
 namespace dmImage
 {
-    static void PremultiplyRGBA(uint8_t* buffer, int width, int height)
+    static inline uint8_t Premultiply(uint32_t c, uint32_t a)
     {
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                int index = (y * width + x) * 4;
-                uint32_t a = buffer[index + 3];
-                uint32_t r = (buffer[index + 0] * a + 255) >> 8;
-                uint32_t g = (buffer[index + 1] * a + 255) >> 8;
-                uint32_t b = (buffer[index + 2] * a + 255) >> 8;
-                buffer[index + 0] = r;
-                buffer[index + 1] = g;
-                buffer[index + 2] = b;
+        return (uint8_t) ((c * a + 255) >> 8);
+    }
+
+    // Copies a row of pixels, premultiplying the color with the alpha if needed.
+    // The source and the destination may be the same row.
+    static void CopyRow(const uint8_t* src, uint8_t* dst, uint32_t width, uint32_t comp, bool premult)
+    {
+        if (!premult || (comp != 2 && comp != 4))
+        {
+            if (src != dst)
+                memcpy(dst, src, width * comp);
+            return;
+        }
+
+        if (comp == 4)
+        {
+            for (uint32_t x = 0; x < width; ++x, src += 4, dst += 4)
+            {
+                uint32_t a = src[3];
+                dst[0] = Premultiply(src[0], a);
+                dst[1] = Premultiply(src[1], a);
+                dst[2] = Premultiply(src[2], a);
+                dst[3] = (uint8_t) a;
+            }
+        }
+        else
+        {
+            for (uint32_t x = 0; x < width; ++x, src += 2, dst += 2)
+            {
+                uint32_t a = src[1];
+                dst[0] = Premultiply(src[0], a);
+                dst[1] = (uint8_t) a;
             }
         }
     }
 
-    static void PremultiplyLuminance(uint8_t* buffer, int width, int height)
+    // Premultiplies and flips the image in a single pass over the pixels.
+    // The source and the destination may be the same buffer.
+    static void ConvertPixels(const uint8_t* src, uint8_t* dst, uint32_t width, uint32_t height, uint32_t comp, bool premult, bool flip_vertically)
     {
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                int index     = (y * width + x) * 2;
-                uint32_t a    = buffer[index + 1];
-                uint32_t r    = (buffer[index] * a + 255) >> 8;
-                buffer[index] = r;
-            }
+        uint32_t stride = width * comp;
+        if (!flip_vertically)
+        {
+            if (src == dst && !premult)
+                return;
+            for (uint32_t y = 0; y < height; ++y)
+                CopyRow(src + y * stride, dst + y * stride, width, comp, premult);
+            return;
+        }
+
+        if (src != dst)
+        {
+            for (uint32_t y = 0; y < height; ++y)
+                CopyRow(src + y * stride, dst + (height - 1 - y) * stride, width, comp, premult);
+            return;
+        }
+
+        // In place, swap the rows from the top and the bottom through a temporary row
+        uint8_t tmp_stack[2048];
+        uint8_t* tmp = stride <= sizeof(tmp_stack) ? tmp_stack : (uint8_t*) malloc(stride);
+        for (uint32_t y = 0; y < height / 2; ++y)
+        {
+            uint8_t* top = dst + y * stride;
+            uint8_t* bottom = dst + (height - 1 - y) * stride;
+            CopyRow(top, tmp, width, comp, premult);
+            CopyRow(bottom, top, width, comp, premult);
+            memcpy(bottom, tmp, stride);
+        }
+        if (height & 1)
+        {
+            uint8_t* middle = dst + (height / 2) * stride;
+            CopyRow(middle, middle, width, comp, premult);
+        }
+        if (tmp != tmp_stack)
+            free(tmp);
+    }
+
+    static bool ToType(int comp, Type* type)
+    {
+        switch (comp) {
+        case 1: *type = TYPE_LUMINANCE; return true;
+        case 2: *type = TYPE_LUMINANCE_ALPHA; return true;
+        case 3: *type = TYPE_RGB; return true;
+        case 4: *type = TYPE_RGBA; return true;
+        default:
+            dmLogError("Unexpected number of components in image (%d)", comp);
+            return false;
         }
     }
 
@@ -82,54 +151,77 @@ namespace dmImage
         delete image;
     }
 
+    // Note that the vertical flip isn't done with stbi_set_flip_vertically_on_load(), since that is a global
+    // setting. This way, images can be loaded on several threads at the same time.
     Result Load(const void* buffer, uint32_t buffer_size, bool premult, bool flip_vertically, Image* image)
     {
         int x, y, comp;
+        unsigned char* ret = stbi_load_from_memory((const stbi_uc*) buffer, (int) buffer_size, &x, &y, &comp, 0);
+        if (!ret)
+        {
+            dmLogError("Failed to load image: '%s'", stbi_failure_reason());
+            return RESULT_IMAGE_ERROR;
+        }
 
-        stbi_set_flip_vertically_on_load(flip_vertically);
+        Image i;
+        i.m_Width = (uint32_t) x;
+        i.m_Height = (uint32_t) y;
+        if (!ToType(comp, &i.m_Type))
+        {
+            free(ret);
+            return RESULT_IMAGE_ERROR;
+        }
 
-        unsigned char* ret = stbi_load_from_memory((const stbi_uc*) buffer, (int) buffer_size, &x, &y, &comp, 0);
+        ConvertPixels(ret, ret, i.m_Width, i.m_Height, (uint32_t) comp, premult, flip_vertically);
 
-        // Reset to default state
-        stbi_set_flip_vertically_on_load(0);
-
-        if (ret) {
-            Image i;
-            i.m_Width = (uint32_t) x;
-            i.m_Height = (uint32_t) y;
-            switch (comp) {
-            case 1:
-                i.m_Type = TYPE_LUMINANCE;
-                break;
-            case 2:
-                i.m_Type = TYPE_LUMINANCE_ALPHA;
-                if (premult)
-                {
-                    PremultiplyLuminance(ret, x, y);
-                }
-                break;
-            case 3:
-                i.m_Type = TYPE_RGB;
-                break;
-            case 4:
-                i.m_Type = TYPE_RGBA;
-                if (premult)
-                {
-                    PremultiplyRGBA(ret, x, y);
-                }
-                break;
-            default:
-                dmLogError("Unexpected number of components in image (%d)", comp);
-                free(ret);
-                return RESULT_IMAGE_ERROR;
-            }
-            i.m_Buffer = (void*) ret;
-            *image = i;
-            return RESULT_OK;
-        } else {
+        i.m_Buffer = (void*) ret;
+        *image = i;
+        return RESULT_OK;
+    }
+
+    Result GetInfo(const void* buffer, uint32_t buffer_size, uint32_t* width, uint32_t* height, Type* type)
+    {
+        int x, y, comp;
+        if (!stbi_info_from_memory((const stbi_uc*) buffer, (int) buffer_size, &x, &y, &comp))
+        {
+            dmLogError("Failed to read image info: '%s'", stbi_failure_reason());
+            return RESULT_IMAGE_ERROR;
+        }
+        if (!ToType(comp, type))
+            return RESULT_IMAGE_ERROR;
+        *width = (uint32_t) x;
+        *height = (uint32_t) y;
+        return RESULT_OK;
+    }
+
+    Result LoadInto(const void* buffer, uint32_t buffer_size, bool premult, bool flip_vertically, void* out, uint32_t out_size, Image* image)
+    {
+        int x, y, comp;
+        unsigned char* ret = stbi_load_from_memory((const stbi_uc*) buffer, (int) buffer_size, &x, &y, &comp, 0);
+        if (!ret)
+        {
             dmLogError("Failed to load image: '%s'", stbi_failure_reason());
             return RESULT_IMAGE_ERROR;
         }
+
+        Image i;
+        i.m_Width = (uint32_t) x;
+        i.m_Height = (uint32_t) y;
+        bool ok = ToType(comp, &i.m_Type);
+        if (ok && i.m_Width * i.m_Height * (uint32_t) comp > out_size)
+        {
+            dmLogError("The image (%u x %u x %d) doesn't fit in the destination (%u bytes)", i.m_Width, i.m_Height, comp, out_size);
+            ok = false;
+        }
+
+        if (ok)
+        {
+            ConvertPixels(ret, (uint8_t*) out, i.m_Width, i.m_Height, (uint32_t) comp, premult, flip_vertically);
+            i.m_Buffer = out;
+            *image = i;
+        }
+        free(ret);
+        return ok ? RESULT_OK : RESULT_IMAGE_ERROR;
     }
 
     void Free(Image* image)
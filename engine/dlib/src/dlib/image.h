@@ -49,6 +49,34 @@ namespace dmImage
      */
     Result Load(const void* buffer, uint32_t buffer_size, bool premult, bool flip_vertically, HImage image);
 
+    /**
+     * Get the size and the type of an image, without decoding it
+     *
+     * @param buffer image buffer
+     * @param buffer_size image buffer size
+     * @param width output width
+     * @param height output height
+     * @param type output type
+     * @return RESULT_OK on success
+     */
+    Result GetInfo(const void* buffer, uint32_t buffer_size, uint32_t* width, uint32_t* height, Type* type);
+
+    /**
+     * Load image from buffer into memory owned by the caller, e.g. a dmBuffer or texture upload memory.
+     * The premultiplication and the flip are done as the pixels are written to the destination.
+     * The buffer of the image points to the destination, and must not be freed with Free().
+     *
+     * @param buffer image buffer
+     * @param buffer_size image buffer size
+     * @param premult premultiply alpha or not
+     * @param flip_vertically flip the image vertically
+     * @param out destination, at least width * height * BytesPerPixel(type) bytes (see GetInfo)
+     * @param out_size destination size
+     * @param image output
+     * @return RESULT_OK on success
+     */
+    Result LoadInto(const void* buffer, uint32_t buffer_size, bool premult, bool flip_vertically, void* out, uint32_t out_size, HImage image);
+
     /**
      * Free loaded image
      * @param image image to free
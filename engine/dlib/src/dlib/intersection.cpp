@@ -14,6 +14,15 @@
 
 #include <dmsdk/dlib/intersection.h>
 #include <stdint.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define DM_INTERSECTION_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define DM_INTERSECTION_NEON
+    #include <arm_neon.h>
+#endif
 
 namespace dmIntersection
 {
@@ -157,4 +166,143 @@ bool TestFrustumOBB(const Frustum& frustum, const dmVMath::Matrix4& world, dmVMa
     return true; // inside the frustum but false positives may also happen. They are ok when used for frustum culling where the object will be hidden later in the rendering pipeline.
 }
 
+void CreateWorldAABB(const dmVMath::Matrix4& world, const dmVMath::Vector3& aabb_min, const dmVMath::Vector3& aabb_max, WorldAABB& out)
+{
+    // Arvo, "Transforming Axis-Aligned Bounding Boxes"
+    dmVMath::Point3 local_center = dmVMath::Point3((aabb_min + aabb_max) * 0.5f);
+    dmVMath::Vector3 local_extents = (aabb_max - aabb_min) * 0.5f;
+    dmVMath::Vector4 center = world * local_center;
+    dmVMath::Vector3 extents = dmVMath::AbsPerElem(world.getCol0().getXYZ()) * local_extents.getX() +
+                               dmVMath::AbsPerElem(world.getCol1().getXYZ()) * local_extents.getY() +
+                               dmVMath::AbsPerElem(world.getCol2().getXYZ()) * local_extents.getZ();
+    out.m_Center[0] = center.getX();
+    out.m_Center[1] = center.getY();
+    out.m_Center[2] = center.getZ();
+    out.m_Center[3] = 0.0f;
+    out.m_Extents[0] = extents.getX();
+    out.m_Extents[1] = extents.getY();
+    out.m_Extents[2] = extents.getZ();
+    out.m_Extents[3] = 0.0f;
+}
+
+bool TestFrustumWorldAABB(const Frustum& frustum, const WorldAABB& box)
+{
+    int num_planes = frustum.m_NumPlanes;
+    for (int i = 0; i < num_planes; ++i)
+    {
+        const Plane& plane = frustum.m_Planes[i];
+        float distance = plane.getX() * box.m_Center[0] + plane.getY() * box.m_Center[1] + plane.getZ() * box.m_Center[2] + plane.getW();
+        float radius = fabsf(plane.getX()) * box.m_Extents[0] + fabsf(plane.getY()) * box.m_Extents[1] + fabsf(plane.getZ()) * box.m_Extents[2];
+        if (distance + radius < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if defined(DM_INTERSECTION_SSE2) || defined(DM_INTERSECTION_NEON)
+
+// The boxes as structure of arrays, four at a time
+struct WorldAABB4
+{
+    float m_CenterX[4];
+    float m_CenterY[4];
+    float m_CenterZ[4];
+    float m_ExtentX[4];
+    float m_ExtentY[4];
+    float m_ExtentZ[4];
+};
+
+static inline void GatherWorldAABB4(const WorldAABB* boxes, WorldAABB4& out)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        out.m_CenterX[i] = boxes[i].m_Center[0];
+        out.m_CenterY[i] = boxes[i].m_Center[1];
+        out.m_CenterZ[i] = boxes[i].m_Center[2];
+        out.m_ExtentX[i] = boxes[i].m_Extents[0];
+        out.m_ExtentY[i] = boxes[i].m_Extents[1];
+        out.m_ExtentZ[i] = boxes[i].m_Extents[2];
+    }
+}
+
+#endif
+
+void TestFrustumWorldAABBs(const Frustum& frustum, const WorldAABB* boxes, uint32_t count, uint8_t* results)
+{
+    uint32_t i = 0;
+
+#if defined(DM_INTERSECTION_SSE2) || defined(DM_INTERSECTION_NEON)
+    int num_planes = frustum.m_NumPlanes;
+    float planes[6][4];
+    float abs_normals[6][3];
+    for (int p = 0; p < num_planes; ++p)
+    {
+        const Plane& plane = frustum.m_Planes[p];
+        planes[p][0] = plane.getX();
+        planes[p][1] = plane.getY();
+        planes[p][2] = plane.getZ();
+        planes[p][3] = plane.getW();
+        abs_normals[p][0] = fabsf(planes[p][0]);
+        abs_normals[p][1] = fabsf(planes[p][1]);
+        abs_normals[p][2] = fabsf(planes[p][2]);
+    }
+
+    WorldAABB4 soa;
+    for (; i + 4 <= count; i += 4)
+    {
+        GatherWorldAABB4(&boxes[i], soa);
+
+    #if defined(DM_INTERSECTION_SSE2)
+        __m128 cx = _mm_loadu_ps(soa.m_CenterX);
+        __m128 cy = _mm_loadu_ps(soa.m_CenterY);
+        __m128 cz = _mm_loadu_ps(soa.m_CenterZ);
+        __m128 ex = _mm_loadu_ps(soa.m_ExtentX);
+        __m128 ey = _mm_loadu_ps(soa.m_ExtentY);
+        __m128 ez = _mm_loadu_ps(soa.m_ExtentZ);
+        __m128 zero = _mm_setzero_ps();
+        __m128 outside = zero;
+        for (int p = 0; p < num_planes; ++p)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes[p][0])), _mm_mul_ps(cy, _mm_set1_ps(planes[p][1]))),
+                                         _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes[p][2])), _mm_set1_ps(planes[p][3])));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(abs_normals[p][0])), _mm_mul_ps(ey, _mm_set1_ps(abs_normals[p][1]))),
+                                       _mm_mul_ps(ez, _mm_set1_ps(abs_normals[p][2])));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        }
+        int mask = _mm_movemask_ps(outside);
+        results[i + 0] = (mask & 1) ? 0 : 1;
+        results[i + 1] = (mask & 2) ? 0 : 1;
+        results[i + 2] = (mask & 4) ? 0 : 1;
+        results[i + 3] = (mask & 8) ? 0 : 1;
+    #else
+        float32x4_t cx = vld1q_f32(soa.m_CenterX);
+        float32x4_t cy = vld1q_f32(soa.m_CenterY);
+        float32x4_t cz = vld1q_f32(soa.m_CenterZ);
+        float32x4_t ex = vld1q_f32(soa.m_ExtentX);
+        float32x4_t ey = vld1q_f32(soa.m_ExtentY);
+        float32x4_t ez = vld1q_f32(soa.m_ExtentZ);
+        float32x4_t zero = vdupq_n_f32(0.0f);
+        uint32x4_t outside = vdupq_n_u32(0);
+        for (int p = 0; p < num_planes; ++p)
+        {
+            float32x4_t distance = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(planes[p][3]), cx, planes[p][0]), cy, planes[p][1]), cz, planes[p][2]);
+            float32x4_t radius = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(ex, abs_normals[p][0]), ey, abs_normals[p][1]), ez, abs_normals[p][2]);
+            outside = vorrq_u32(outside, vcltq_f32(vaddq_f32(distance, radius), zero));
+        }
+        results[i + 0] = vgetq_lane_u32(outside, 0) ? 0 : 1;
+        results[i + 1] = vgetq_lane_u32(outside, 1) ? 0 : 1;
+        results[i + 2] = vgetq_lane_u32(outside, 2) ? 0 : 1;
+        results[i + 3] = vgetq_lane_u32(outside, 3) ? 0 : 1;
+    #endif
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        results[i] = TestFrustumWorldAABB(frustum, boxes[i]) ? 1 : 0;
+    }
+}
+
 } // dmIntersection
@@ -14,14 +14,15 @@
 
 
 #include <stdio.h> // printf
-
-#include <dmsdk/dlib/array.h>
+#include <string.h> // memset
 
 #include <dmsdk/dlib/array.h>
 #include <dmsdk/dlib/atomic.h>
 #include <dmsdk/dlib/profile.h>
 #include <dmsdk/dlib/log.h>
+#include <dmsdk/dlib/spinlock.h>
 #include <dlib/thread.h>
+#include <dlib/time.h>
 #include <dlib/math.h>
 #include <dlib/dstrings.h>
 
@@ -30,120 +31,404 @@
     #include <dmsdk/dlib/mutex.h>
 #endif
 
-#include "jc/ringbuffer.h"
 #include "job_thread.h"
 
 namespace dmJobThread
 {
 
-struct JobItem
+static const uint32_t JOB_PAGE_SIZE_BITS = 8;
+static const uint32_t JOB_PAGE_SIZE      = 1 << JOB_PAGE_SIZE_BITS;
+static const uint32_t MAX_JOB_PAGES      = 256; // 65536 jobs in flight
+static const uint32_t INVALID_INDEX      = 0xFFFFFFFF;
+
+enum JobState
 {
-    void*       m_Context;
-    void*       m_Data;
-    FProcess    m_Process;
-    FCallback   m_Callback;
-    int         m_Result;
+    JOB_STATE_FREE,
+    JOB_STATE_CREATED,
+    JOB_STATE_PUSHED,
+    JOB_STATE_FINISHED,
 };
 
-struct JobThreadContext
+struct Job
 {
-    jc::RingBuffer<JobItem>                 m_Work;
-    jc::RingBuffer<JobItem>                 m_Done;
+    void*           m_Context;
+    void*           m_Data;
+    FProcess        m_Process;
+    FCallback       m_Callback;
+    int             m_Result;
+    // Number of things that must happen before the job can run (push + dependencies)
+    int32_atomic_t  m_PendingCount;
+    int32_atomic_t  m_State;
+    int32_atomic_t  m_Generation;
+    // Linked list of jobs waiting for this job. Protected by JobContext::m_JobLock
+    uint32_t        m_FirstDependent;
+};
 
-#if defined(DM_HAS_THREADS)
-    dmMutex::HMutex                         m_Mutex;
-    dmConditionVariable::HConditionVariable m_WakeupCond;
-    bool                                    m_Run;
-#endif
+struct JobLink
+{
+    uint32_t m_Job;
+    uint32_t m_Next;
+};
+
+// A double ended queue of job indices.
+// The owning worker pushes and pops at the back, other threads steal from the front
+struct JobQueue
+{
+    dmSpinlock::Spinlock    m_Lock;
+    uint32_t*               m_Items;
+    uint32_t                m_Capacity; // power of two
+    uint32_t                m_Front;
+    uint32_t                m_Back;
+};
+
+struct JobContext;
+
+struct WorkerContext
+{
+    JobContext*    m_Context;
+    uint32_t       m_Index;
+    int32_atomic_t m_SystemThreadId; // Set when the thread has started
 };
 
 struct JobContext
 {
+    Job*                    m_JobPages[MAX_JOB_PAGES];
+    uint32_t                m_JobPageCount;
+    dmArray<uint32_t>       m_FreeJobs;
+    dmArray<JobLink>        m_Links;
+    uint32_t                m_FirstFreeLink;
+    dmSpinlock::Spinlock    m_JobLock;
+
+    JobQueue*               m_Queues;
+    uint32_t                m_QueueCount;
+    int32_atomic_t          m_NextQueue;
+    int32_atomic_t          m_QueuedCount;
+
+    dmArray<uint32_t>       m_Done;
+    dmArray<uint32_t>       m_DoneScratch; // Only used by the main thread, in Update()
+    dmSpinlock::Spinlock    m_DoneLock;
+
 #if defined(DM_HAS_THREADS)
-    dmArray<dmThread::Thread> m_Threads;
+    dmArray<dmThread::Thread>               m_Threads;
+    WorkerContext*                          m_Workers;
+    dmThread::TlsKey                        m_WorkerKey;
+    dmMutex::HMutex                         m_Mutex;
+    dmConditionVariable::HConditionVariable m_WakeupCond;
+    int32_atomic_t                          m_SleepingCount;
+    int32_atomic_t                          m_Run;
 #endif
-    JobThreadContext    m_ThreadContext;
 };
 
-static void PutWork(JobThreadContext* ctx, const JobItem* item)
+static inline HJob MakeHandle(uint32_t generation, uint32_t index)
+{
+    return (((uint64_t)generation) << 32) | index;
+}
+
+static inline Job* GetJobByIndex(JobContext* ctx, uint32_t index)
+{
+    return &ctx->m_JobPages[index >> JOB_PAGE_SIZE_BITS][index & (JOB_PAGE_SIZE - 1)];
+}
+
+// Returns 0 if the handle is stale
+static Job* GetJob(JobContext* ctx, HJob hjob)
+{
+    uint32_t index = (uint32_t)(hjob & 0xFFFFFFFF);
+    uint32_t generation = (uint32_t)(hjob >> 32);
+    if (index >= ctx->m_JobPageCount * JOB_PAGE_SIZE)
+        return 0;
+    Job* job = GetJobByIndex(ctx, index);
+    if ((uint32_t)dmAtomicGet32(&job->m_Generation) != generation)
+        return 0;
+    return job;
+}
+
+static void QueueInit(JobQueue* queue)
+{
+    dmSpinlock::Create(&queue->m_Lock);
+    queue->m_Capacity = 64;
+    queue->m_Items = (uint32_t*)malloc(queue->m_Capacity * sizeof(uint32_t));
+    queue->m_Front = 0;
+    queue->m_Back = 0;
+}
+
+static void QueueFree(JobQueue* queue)
+{
+    free(queue->m_Items);
+    dmSpinlock::Destroy(&queue->m_Lock);
+}
+
+static void QueuePushBack(JobQueue* queue, uint32_t index)
+{
+    DM_SPINLOCK_SCOPED_LOCK(queue->m_Lock);
+    if ((queue->m_Back - queue->m_Front) == queue->m_Capacity)
+    {
+        uint32_t old_mask = queue->m_Capacity - 1;
+        uint32_t new_capacity = queue->m_Capacity * 2;
+        uint32_t* items = (uint32_t*)malloc(new_capacity * sizeof(uint32_t));
+        for (uint32_t i = queue->m_Front; i != queue->m_Back; ++i)
+            items[i & (new_capacity - 1)] = queue->m_Items[i & old_mask];
+        free(queue->m_Items);
+        queue->m_Items = items;
+        queue->m_Capacity = new_capacity;
+    }
+    queue->m_Items[queue->m_Back & (queue->m_Capacity - 1)] = index;
+    queue->m_Back++;
+}
+
+static bool QueuePopBack(JobQueue* queue, uint32_t* index)
+{
+    DM_SPINLOCK_SCOPED_LOCK(queue->m_Lock);
+    if (queue->m_Back == queue->m_Front)
+        return false;
+    queue->m_Back--;
+    *index = queue->m_Items[queue->m_Back & (queue->m_Capacity - 1)];
+    return true;
+}
+
+static bool QueuePopFront(JobQueue* queue, uint32_t* index)
+{
+    DM_SPINLOCK_SCOPED_LOCK(queue->m_Lock);
+    if (queue->m_Back == queue->m_Front)
+        return false;
+    *index = queue->m_Items[queue->m_Front & (queue->m_Capacity - 1)];
+    queue->m_Front++;
+    return true;
+}
+
+static uint32_t AllocJob(JobContext* ctx)
+{
+    DM_SPINLOCK_SCOPED_LOCK(ctx->m_JobLock);
+    if (ctx->m_FreeJobs.Empty())
+    {
+        if (ctx->m_JobPageCount == MAX_JOB_PAGES)
+            return INVALID_INDEX;
+
+        Job* page = new Job[JOB_PAGE_SIZE];
+        memset(page, 0, sizeof(Job) * JOB_PAGE_SIZE);
+        for (uint32_t i = 0; i < JOB_PAGE_SIZE; ++i)
+            page[i].m_Generation = 1;
+
+        uint32_t base = ctx->m_JobPageCount * JOB_PAGE_SIZE;
+        ctx->m_JobPages[ctx->m_JobPageCount++] = page;
+
+        ctx->m_FreeJobs.OffsetCapacity(JOB_PAGE_SIZE);
+        for (uint32_t i = 0; i < JOB_PAGE_SIZE; ++i)
+            ctx->m_FreeJobs.Push(base + JOB_PAGE_SIZE - 1 - i);
+    }
+    uint32_t index = ctx->m_FreeJobs.Back();
+    ctx->m_FreeJobs.Pop();
+    return index;
+}
+
+// Assumes m_JobLock is held
+static void FreeJobNoLock(JobContext* ctx, uint32_t index)
+{
+    Job* job = GetJobByIndex(ctx, index);
+    int32_t generation = job->m_Generation + 1;
+    if (generation == 0)
+        generation = 1;
+    dmAtomicStore32(&job->m_Generation, generation);
+    dmAtomicStore32(&job->m_State, JOB_STATE_FREE);
+    ctx->m_FreeJobs.Push(index);
+}
+
+static uint32_t GetCurrentQueue(JobContext* ctx)
 {
 #if defined(DM_HAS_THREADS)
-    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+    WorkerContext* worker = (WorkerContext*)dmThread::GetTlsValue(ctx->m_WorkerKey);
+    if (worker)
+        return worker->m_Index;
 #endif
-    if (ctx->m_Work.Full())
-        ctx->m_Work.SetCapacity(ctx->m_Work.Capacity() + 8);
-    ctx->m_Work.Push(*item);
+    return INVALID_INDEX;
 }
 
-static void PutDone(JobThreadContext* ctx, JobItem* item)
+// Puts the job in a queue, without waking any worker
+static void EnqueueJob(JobContext* ctx, uint32_t index)
+{
+    uint32_t queue_index = GetCurrentQueue(ctx);
+    if (queue_index == INVALID_INDEX)
+        queue_index = ((uint32_t)dmAtomicIncrement32(&ctx->m_NextQueue)) % ctx->m_QueueCount;
+
+    QueuePushBack(&ctx->m_Queues[queue_index], index);
+    dmAtomicIncrement32(&ctx->m_QueuedCount);
+}
+
+// Wakes sleeping workers for 'count' newly queued jobs. Must not be called with a spinlock held,
+// since it may block on the mutex
+static void WakeWorkers(JobContext* ctx, uint32_t count)
 {
 #if defined(DM_HAS_THREADS)
-    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+    if (count > 0 && dmAtomicGet32(&ctx->m_SleepingCount) > 0)
+    {
+        DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+        if (count == 1)
+            dmConditionVariable::Signal(ctx->m_WakeupCond);
+        else
+            dmConditionVariable::Broadcast(ctx->m_WakeupCond);
+    }
+#else
+    (void)ctx;
+    (void)count;
 #endif
-    if (ctx->m_Done.Full())
-        ctx->m_Done.SetCapacity(ctx->m_Done.Capacity() + 8);
-    ctx->m_Done.Push(*item);
 }
 
-#if defined(DM_HAS_THREADS)
-static void JobThread(void* _ctx)
+static void ScheduleJob(JobContext* ctx, uint32_t index)
 {
-    JobThreadContext* ctx = (JobThreadContext*)_ctx;
-    while (true)
+    EnqueueJob(ctx, index);
+    WakeWorkers(ctx, 1);
+}
+
+static void FinishJob(JobContext* ctx, uint32_t index)
+{
+    Job* job = GetJobByIndex(ctx, index);
+
+    // The workers are woken after the job lock is released, so that other threads don't spin on it while we wait for the mutex
+    uint32_t scheduled_count = 0;
     {
-        JobItem item = {};
+        DM_SPINLOCK_SCOPED_LOCK(ctx->m_JobLock);
+        dmAtomicStore32(&job->m_State, JOB_STATE_FINISHED);
+
+        // Queue the callback before releasing the dependents, so that
+        // the callback is guaranteed to be called by the next Update() once a dependent has finished
+        if (job->m_Callback)
         {
-            DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+            DM_SPINLOCK_SCOPED_LOCK(ctx->m_DoneLock);
+            ctx->m_Done.PushGrow(index);
+        }
 
-            if (!ctx->m_Run)
-                break;
+        uint32_t link_index = job->m_FirstDependent;
+        job->m_FirstDependent = INVALID_INDEX;
+        while (link_index != INVALID_INDEX)
+        {
+            JobLink& link = ctx->m_Links[link_index];
+            uint32_t next = link.m_Next;
 
-            while(ctx->m_Work.Empty())
+            Job* dependent = GetJobByIndex(ctx, link.m_Job);
+            if (dmAtomicDecrement32(&dependent->m_PendingCount) == 1)
             {
-                dmConditionVariable::Wait(ctx->m_WakeupCond, ctx->m_Mutex);
-                if (!ctx->m_Run)
-                    return;
+                EnqueueJob(ctx, link.m_Job);
+                ++scheduled_count;
             }
-            item = ctx->m_Work.Pop();
+
+            link.m_Next = ctx->m_FirstFreeLink;
+            ctx->m_FirstFreeLink = link_index;
+            link_index = next;
         }
 
+        if (!job->m_Callback)
+            FreeJobNoLock(ctx, index);
+    }
+
+    WakeWorkers(ctx, scheduled_count);
+}
+
+static void ProcessJob(JobContext* ctx, uint32_t index)
+{
+    Job* job = GetJobByIndex(ctx, index);
+    {
+        DM_PROFILE("JobThread");
+        job->m_Result = job->m_Process ? job->m_Process(job->m_Context, job->m_Data) : 0;
+    }
+    FinishJob(ctx, index);
+}
+
+// Tries the preferred queue first (newest job first), then steals from the other queues (oldest job first)
+static bool RunOneJob(JobContext* ctx, uint32_t preferred_queue)
+{
+    uint32_t index;
+    bool found = false;
+    if (preferred_queue != INVALID_INDEX)
+        found = QueuePopBack(&ctx->m_Queues[preferred_queue], &index);
+
+    uint32_t start = preferred_queue != INVALID_INDEX ? preferred_queue + 1 : 0;
+    for (uint32_t i = 0; i < ctx->m_QueueCount && !found; ++i)
+    {
+        uint32_t queue_index = (start + i) % ctx->m_QueueCount;
+        if (queue_index == preferred_queue)
+            continue;
+        found = QueuePopFront(&ctx->m_Queues[queue_index], &index);
+    }
+
+    if (!found)
+        return false;
+
+    dmAtomicDecrement32(&ctx->m_QueuedCount);
+    ProcessJob(ctx, index);
+    return true;
+}
+
+#if defined(DM_HAS_THREADS)
+static void JobThread(void* _worker)
+{
+    WorkerContext* worker = (WorkerContext*)_worker;
+    JobContext* ctx = worker->m_Context;
+    dmThread::SetTlsValue(ctx->m_WorkerKey, worker);
+    dmAtomicStore32(&worker->m_SystemThreadId, dmThread::GetCurrentThreadSystemId());
+
+    while (dmAtomicGet32(&ctx->m_Run))
+    {
+        if (RunOneJob(ctx, worker->m_Index))
+            continue;
+
+        DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+        dmAtomicIncrement32(&ctx->m_SleepingCount);
+        while (dmAtomicGet32(&ctx->m_QueuedCount) == 0 && dmAtomicGet32(&ctx->m_Run))
         {
-            DM_PROFILE("JobThread");
-            item.m_Result = item.m_Process(item.m_Context, item.m_Data);
-            PutDone(ctx, &item);
+            dmConditionVariable::Wait(ctx->m_WakeupCond, ctx->m_Mutex);
         }
+        dmAtomicDecrement32(&ctx->m_SleepingCount);
     }
 }
-#else
-static void UpdateSingleThread(JobThreadContext* ctx)
+#endif
+
+static void UpdateSingleThread(JobContext* ctx)
 {
-    if (ctx->m_Work.Empty())
-        return;
     // TODO: Perhaps time scope a number of items!
-    JobItem item = ctx->m_Work.Pop();
-
-    item.m_Result = item.m_Process(item.m_Context, item.m_Data);
-    PutDone(ctx, &item);
+    RunOneJob(ctx, INVALID_INDEX);
 }
-#endif
 
 HContext Create(const JobThreadCreationParams& create_params)
 {
     JobContext* context = new JobContext;
+    memset(context->m_JobPages, 0, sizeof(context->m_JobPages));
+    context->m_JobPageCount = 0;
+    context->m_FirstFreeLink = INVALID_INDEX;
+    context->m_NextQueue = 0;
+    context->m_QueuedCount = 0;
+    dmSpinlock::Create(&context->m_JobLock);
+    dmSpinlock::Create(&context->m_DoneLock);
+
+    uint32_t thread_count = 0;
 #if defined(DM_HAS_THREADS)
-    context->m_ThreadContext.m_Mutex = dmMutex::New();
-    context->m_ThreadContext.m_WakeupCond = dmConditionVariable::New();
-    context->m_ThreadContext.m_Run = true;
+    thread_count = dmMath::Min(create_params.m_ThreadCount, DM_MAX_JOB_THREAD_COUNT);
+#endif
+
+    // We always need at least one queue, even if there are no worker threads
+    context->m_QueueCount = dmMath::Max(thread_count, 1U);
+    context->m_Queues = new JobQueue[context->m_QueueCount];
+    for (uint32_t i = 0; i < context->m_QueueCount; ++i)
+        QueueInit(&context->m_Queues[i]);
 
-    uint32_t thread_count = dmMath::Min(create_params.m_ThreadCount, DM_MAX_JOB_THREAD_COUNT);
+#if defined(DM_HAS_THREADS)
+    context->m_Mutex = dmMutex::New();
+    context->m_WakeupCond = dmConditionVariable::New();
+    context->m_WorkerKey = dmThread::AllocTls();
+    context->m_SleepingCount = 0;
+    context->m_Run = 1;
+
+    context->m_Workers = new WorkerContext[context->m_QueueCount];
     context->m_Threads.SetCapacity(thread_count);
     context->m_Threads.SetSize(thread_count);
 
-    for (int i = 0; i < thread_count; ++i)
+    for (uint32_t i = 0; i < thread_count; ++i)
     {
+        context->m_Workers[i].m_Context = context;
+        context->m_Workers[i].m_Index = i;
+        context->m_Workers[i].m_SystemThreadId = 0;
+
         char name_buf[128];
         dmSnPrintf(name_buf, sizeof(name_buf), "%s_%d", create_params.m_ThreadNames[i], i);
-        context->m_Threads[i] = dmThread::New(JobThread, 0x80000, (void*)&context->m_ThreadContext, name_buf);
+        context->m_Threads[i] = dmThread::New(JobThread, 0x80000, (void*)&context->m_Workers[i], name_buf);
     }
 #endif
     return context;
@@ -156,37 +441,212 @@ void Destroy(HContext context)
 
 #if defined(DM_HAS_THREADS)
     {
-        DM_MUTEX_SCOPED_LOCK(context->m_ThreadContext.m_Mutex);
+        DM_MUTEX_SCOPED_LOCK(context->m_Mutex);
 
-        context->m_ThreadContext.m_Run = false;;
+        dmAtomicStore32(&context->m_Run, 0);
 
-        dmConditionVariable::Broadcast(context->m_ThreadContext.m_WakeupCond);
+        dmConditionVariable::Broadcast(context->m_WakeupCond);
     }
 
-    for (int i = 0; i < context->m_Threads.Size(); ++i)
+    for (uint32_t i = 0; i < context->m_Threads.Size(); ++i)
     {
         dmThread::Join(context->m_Threads[i]);
     }
-    dmConditionVariable::Delete(context->m_ThreadContext.m_WakeupCond);
-    dmMutex::Delete(context->m_ThreadContext.m_Mutex);
+    dmThread::FreeTls(context->m_WorkerKey);
+    dmConditionVariable::Delete(context->m_WakeupCond);
+    dmMutex::Delete(context->m_Mutex);
+    delete[] context->m_Workers;
 #endif // DM_HAS_THREADS
 
+    for (uint32_t i = 0; i < context->m_QueueCount; ++i)
+        QueueFree(&context->m_Queues[i]);
+    delete[] context->m_Queues;
+
+    for (uint32_t i = 0; i < context->m_JobPageCount; ++i)
+        delete[] context->m_JobPages[i];
+
+    dmSpinlock::Destroy(&context->m_JobLock);
+    dmSpinlock::Destroy(&context->m_DoneLock);
+
     delete context;
 }
 
+HJob CreateJob(HContext context, FProcess process, FCallback callback, void* user_context, void* data)
+{
+    uint32_t index = AllocJob(context);
+    if (index == INVALID_INDEX)
+    {
+        dmLogError("Max number of jobs reached (%u)", JOB_PAGE_SIZE * MAX_JOB_PAGES);
+        return INVALID_JOB;
+    }
+
+    Job* job = GetJobByIndex(context, index);
+    job->m_Context = user_context;
+    job->m_Data = data;
+    job->m_Process = process;
+    job->m_Callback = callback;
+    job->m_Result = 0;
+    job->m_PendingCount = 1; // Released when the job is pushed
+    job->m_FirstDependent = INVALID_INDEX;
+    dmAtomicStore32(&job->m_State, JOB_STATE_CREATED);
+    return MakeHandle((uint32_t)job->m_Generation, index);
+}
+
+bool AddDependency(HContext context, HJob hjob, HJob hdependency)
+{
+    if (hjob == hdependency)
+        return false;
+
+    DM_SPINLOCK_SCOPED_LOCK(context->m_JobLock);
+    Job* job = GetJob(context, hjob);
+    if (!job || job->m_State != JOB_STATE_CREATED)
+    {
+        dmLogError("Dependencies can only be added to jobs that are not yet pushed");
+        return false;
+    }
+
+    Job* dependency = GetJob(context, hdependency);
+    if (!dependency || dependency->m_State == JOB_STATE_FINISHED)
+        return true; // Already done
+
+    uint32_t link_index = context->m_FirstFreeLink;
+    if (link_index != INVALID_INDEX)
+    {
+        context->m_FirstFreeLink = context->m_Links[link_index].m_Next;
+    }
+    else
+    {
+        if (context->m_Links.Full())
+            context->m_Links.OffsetCapacity(64);
+        link_index = context->m_Links.Size();
+        context->m_Links.SetSize(link_index + 1);
+    }
+
+    JobLink& link = context->m_Links[link_index];
+    link.m_Job = (uint32_t)(hjob & 0xFFFFFFFF);
+    link.m_Next = dependency->m_FirstDependent;
+    dependency->m_FirstDependent = link_index;
+    dmAtomicIncrement32(&job->m_PendingCount);
+    return true;
+}
+
+void PushJob(HContext context, HJob hjob)
+{
+    Job* job = GetJob(context, hjob);
+    if (!job)
+        return;
+    dmAtomicStore32(&job->m_State, JOB_STATE_PUSHED);
+    if (dmAtomicDecrement32(&job->m_PendingCount) == 1)
+        ScheduleJob(context, (uint32_t)(hjob & 0xFFFFFFFF));
+}
+
 void PushJob(HContext context, FProcess process, FCallback callback, void* user_context, void* data)
 {
-    JobItem item;
-    item.m_Context = user_context;
-    item.m_Data = data;
-    item.m_Process = process;
-    item.m_Callback = callback;
-    item.m_Result = 0;
+    HJob job = CreateJob(context, process, callback, user_context, data);
+    PushJob(context, job);
+}
+
+bool IsJobFinished(HContext context, HJob hjob)
+{
+    DM_SPINLOCK_SCOPED_LOCK(context->m_JobLock);
+    Job* job = GetJob(context, hjob);
+    return !job || job->m_State == JOB_STATE_FINISHED;
+}
+
+void WaitForJob(HContext context, HJob job)
+{
+    DM_PROFILE("WaitForJob");
+    uint32_t queue_index = GetCurrentQueue(context);
+    uint32_t spin_count = 0;
+    while (!IsJobFinished(context, job))
+    {
+        if (RunOneJob(context, queue_index))
+        {
+            spin_count = 0;
+            continue;
+        }
+        // The remaining work is being processed by other threads
+        if (++spin_count > 64)
+            dmTime::Sleep(0);
+    }
+}
+
+struct ParallelForChunk
+{
+    FParallelFor    m_Fn;
+    void*           m_Context;
+    uint32_t        m_Begin;
+    uint32_t        m_End;
+};
+
+static int ParallelForProcess(void* context, void* data)
+{
+    ParallelForChunk* chunk = (ParallelForChunk*)data;
+    chunk->m_Fn(chunk->m_Context, chunk->m_Begin, chunk->m_End);
+    return 0;
+}
+
+void ParallelFor(HContext context, uint32_t count, uint32_t grain, FParallelFor fn, void* user_context)
+{
+    if (count == 0)
+        return;
+
+    grain = dmMath::Max(grain, 1U);
+    uint32_t worker_count = context ? GetWorkerCount(context) : 0;
+    if (worker_count == 0 || count <= grain)
+    {
+        fn(user_context, 0, count);
+        return;
+    }
+
+    // A few chunks per thread (including the caller) helps balancing uneven workloads
+    const uint32_t max_chunks = 64;
+    uint32_t chunk_count = dmMath::Min((count + grain - 1) / grain, dmMath::Min((worker_count + 1) * 4, max_chunks));
+    uint32_t chunk_size = (count + chunk_count - 1) / chunk_count;
+    chunk_count = (count + chunk_size - 1) / chunk_size;
+
+    // The chunks are only referenced until WaitForJob() returns
+    ParallelForChunk chunks[max_chunks];
 
-    PutWork(&context->m_ThreadContext, &item);
+    HJob root = CreateJob(context, 0, 0, 0, 0);
+    for (uint32_t i = 0; i < chunk_count; ++i)
+    {
+        ParallelForChunk& chunk = chunks[i];
+        chunk.m_Fn = fn;
+        chunk.m_Context = user_context;
+        chunk.m_Begin = i * chunk_size;
+        chunk.m_End = dmMath::Min(chunk.m_Begin + chunk_size, count);
+
+        HJob job = root ? CreateJob(context, ParallelForProcess, 0, 0, &chunk) : INVALID_JOB;
+        if (job == INVALID_JOB)
+        {
+            // Out of jobs, do it ourselves
+            fn(user_context, chunk.m_Begin, chunk.m_End);
+            continue;
+        }
+        AddDependency(context, root, job);
+        PushJob(context, job);
+    }
+
+    if (root)
+    {
+        PushJob(context, root);
+        WaitForJob(context, root);
+    }
+}
+
+uint32_t GetWorkerSystemThreadIds(HContext context, int32_t* out_ids, uint32_t max_count)
+{
+    uint32_t count = 0;
 #if defined(DM_HAS_THREADS)
-    dmConditionVariable::Signal(context->m_ThreadContext.m_WakeupCond);
+    for (uint32_t i = 0; context && i < context->m_Threads.Size() && count < max_count; ++i)
+    {
+        int32_t id = dmAtomicGet32(&context->m_Workers[i].m_SystemThreadId);
+        if (id != 0)
+            out_ids[count++] = id;
+    }
 #endif
+    return count;
 }
 
 uint32_t GetWorkerCount(HContext context)
@@ -202,33 +662,30 @@ void Update(HContext context)
 {
     DM_PROFILE("Update");
 
-#if !defined(DM_HAS_THREADS)
-    UpdateSingleThread(&context->m_ThreadContext);
-#endif
-
-    // Lock for as little as possible, by copying the items to an array owned by this thread
-    uint32_t size;
-    dmArray<JobItem> items;
+    if (GetWorkerCount(context) == 0)
+        UpdateSingleThread(context);
 
+    // Lock for as little as possible, by swapping the items to an array owned by this thread
+    dmArray<uint32_t>& items = context->m_DoneScratch;
     {
-#if defined(DM_HAS_THREADS)
-        DM_MUTEX_SCOPED_LOCK(context->m_ThreadContext.m_Mutex);
-#endif
-        size = context->m_ThreadContext.m_Done.Size();
-        items.SetCapacity(size);
-
-        for(uint32_t i = 0; i < size; ++i)
-            items.Push(context->m_ThreadContext.m_Done[i]);
-        context->m_ThreadContext.m_Done.Clear();
+        DM_SPINLOCK_SCOPED_LOCK(context->m_DoneLock);
+        items.Swap(context->m_Done);
     }
 
     // Now do the callbacks
+    uint32_t size = items.Size();
     for(uint32_t i = 0; i < size; ++i)
     {
-        JobItem& item = items[i];
-        if (item.m_Callback)
-            item.m_Callback(item.m_Context, item.m_Data, item.m_Result);
+        Job* job = GetJobByIndex(context, items[i]);
+        job->m_Callback(job->m_Context, job->m_Data, job->m_Result);
+    }
+
+    {
+        DM_SPINLOCK_SCOPED_LOCK(context->m_JobLock);
+        for(uint32_t i = 0; i < size; ++i)
+            FreeJobNoLock(context, items[i]);
     }
+    items.SetSize(0);
 }
 
 } // namespace dmJobThread
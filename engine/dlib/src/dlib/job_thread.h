@@ -20,10 +20,13 @@
 namespace dmJobThread
 {
     typedef struct JobContext* HContext;
+    typedef uint64_t HJob;
     typedef int (*FProcess)(void* context, void* data);
     typedef void (*FCallback)(void* context, void* data, int result);
+    typedef void (*FParallelFor)(void* context, uint32_t begin, uint32_t end);
 
-    static const uint8_t DM_MAX_JOB_THREAD_COUNT = 8;
+    static const uint8_t DM_MAX_JOB_THREAD_COUNT = 32;
+    static const HJob    INVALID_JOB = 0;
 
     struct JobThreadCreationParams
     {
@@ -36,7 +39,35 @@ namespace dmJobThread
     void     Update(HContext context); // Flushes any items and calls PostProcess
     void     PushJob(HContext context, FProcess process, FCallback callback, void* user_context, void* data);
     uint32_t GetWorkerCount(HContext context);
+    // Gets the system ids of the worker threads that have started (see dmThread::GetCurrentThreadSystemId). Returns the number of ids written
+    uint32_t GetWorkerSystemThreadIds(HContext context, int32_t* out_ids, uint32_t max_count);
     bool     PlatformHasThreadSupport();
+
+    /*
+     * Job graph api
+     *
+     * A job is created in a "held" state, which allows for adding dependencies before it's scheduled.
+     * Once pushed, the job is run as soon as all its dependencies have been processed.
+     * The process function may be 0, which makes the job a pure synchronization point.
+     * The callback (if any) is called on the main thread from Update(). After that, the handle is no longer valid.
+     */
+
+    // Creates a new job. Returns INVALID_JOB if the job couldn't be created
+    HJob     CreateJob(HContext context, FProcess process, FCallback callback, void* user_context, void* data);
+    // Makes the "job" wait for the "dependency" to finish. Must be called before the job is pushed
+    bool     AddDependency(HContext context, HJob job, HJob dependency);
+    // Schedules the job. If possible, it's put in the current worker's queue
+    void     PushJob(HContext context, HJob job);
+    // Returns true if the job has been processed (or the handle is no longer valid)
+    bool     IsJobFinished(HContext context, HJob job);
+    // Waits for a job to finish. The calling thread will help processing other jobs while waiting.
+    // Note that the job callback is still called from Update()
+    void     WaitForJob(HContext context, HJob job);
+
+    // Splits the range [0, count) into chunks of at least "grain" elements and processes them in parallel.
+    // The calling thread participates, and the function returns when all chunks are processed.
+    // If the context is 0, has no worker threads, or the range is small, the function is called directly.
+    void     ParallelFor(HContext context, uint32_t count, uint32_t grain, FParallelFor fn, void* user_context);
 }
 
 #endif // DM_JOB_THREAD_H
@@ -61,6 +61,37 @@ namespace dmLZ4
      */
     Result CompressBuffer(const void* buffer, uint32_t buffer_size, void* compressed_buffer, int* compressed_size);
 
+    /**
+     * Decompress buffer from LZ4-format (inflate), that was compressed with a dictionary
+     * The dictionary must be the same as the one used when compressing the data.
+     *
+     * @param buffer buffer to decompress
+     * @param buffer_size buffer size
+     * @param dictionary the dictionary
+     * @param dictionary_size dictionary size. Only the last 64Kb of the dictionary are used
+     * @param decompressed_buffer Pre-allocated buffer to decompress data into
+     * @param max_output max size of decompressed data
+     * @param decompressed_size Actual decompressed size will be written to this
+     * @return dmLZ4::RESULT_OK on success
+     */
+    Result DecompressBufferWithDictionary(const void* buffer, uint32_t buffer_size, const void* dictionary, uint32_t dictionary_size,
+                                          void* decompressed_buffer, uint32_t max_output, int* decompressed_size);
+
+    /**
+     * Compress buffer to LZ4-format (deflate) using a dictionary
+     * The dictionary holds data that is common with the buffer, which makes small buffers compress much better.
+     *
+     * @param buffer buffer to compress
+     * @param buffer_size buffer size
+     * @param dictionary the dictionary
+     * @param dictionary_size dictionary size. Only the last 64Kb of the dictionary are used
+     * @param compressed_buffer Pre-allocated buffer to compress data into
+     * @param compressed_size Actual compressed size will be written to this
+     * @return dmLZ4::RESULT_OK on success
+     */
+    Result CompressBufferWithDictionary(const void* buffer, uint32_t buffer_size, const void* dictionary, uint32_t dictionary_size,
+                                        void* compressed_buffer, int* compressed_size);
+
     /**
      * Helper method to get a "worst case" size of compressed data.
      *
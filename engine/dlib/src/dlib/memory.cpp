@@ -14,7 +14,12 @@
 
 #include "memory.h"
 #include "dalloca.h"
+#include <assert.h>
 #include <stdlib.h>
+#include <string.h>
+#include <dmsdk/dlib/align.h>
+#include <dmsdk/dlib/spinlock.h>
+#include <dmsdk/dlib/thread.h>
 #include <errno.h>
 #if defined(__ANDROID__) || defined(_MSC_VER)
 #include <malloc.h>
@@ -22,6 +27,44 @@
 
 namespace dmMemory
 {
+    // Zero until SetAllocator() is called, in which case the platform allocator is used
+    static Allocator        g_Allocator;
+    static AllocatorStats   g_AllocatorStats;
+
+    void SetAllocator(const Allocator* allocator)
+    {
+        if (allocator)
+            g_Allocator = *allocator;
+        else
+            memset(&g_Allocator, 0, sizeof(g_Allocator));
+    }
+
+    void GetAllocatorStats(AllocatorStats* stats)
+    {
+        *stats = g_AllocatorStats;
+    }
+
+    static void* AllocatorAlloc(uint32_t size, uint32_t alignment)
+    {
+        void* memory = g_Allocator.m_Alloc(g_Allocator.m_Context, size, alignment);
+        if (memory && g_Allocator.m_GetSize)
+        {
+            int32_t usable_size = (int32_t)g_Allocator.m_GetSize(g_Allocator.m_Context, memory);
+            dmAtomicAdd32(&g_AllocatorStats.m_Active, usable_size);
+            dmAtomicAdd32(&g_AllocatorStats.m_Allocated, usable_size);
+            dmAtomicIncrement32(&g_AllocatorStats.m_AllocationCount);
+        }
+        return memory;
+    }
+
+    static void AllocatorFree(void* memory)
+    {
+        if (memory && g_Allocator.m_GetSize)
+        {
+            dmAtomicSub32(&g_AllocatorStats.m_Active, (int32_t)g_Allocator.m_GetSize(g_Allocator.m_Context, memory));
+        }
+        g_Allocator.m_Free(g_Allocator.m_Context, memory);
+    }
 
     Result AlignedMalloc(void **memptr, unsigned alignment, unsigned size)
     {
@@ -31,6 +74,15 @@ namespace dmMemory
             return RESULT_INVAL;
         }
 
+        if (g_Allocator.m_Alloc)
+        {
+            if ((alignment & (alignment - 1)) != 0) {
+                return RESULT_INVAL;
+            }
+            *memptr = AllocatorAlloc(size, alignment);
+            return *memptr ? RESULT_OK : RESULT_NOMEM;
+        }
+
 #if defined(__ANDROID__)
         *(memptr) = memalign(alignment, size);
         if (*(memptr) == 0) {
@@ -58,6 +110,11 @@ namespace dmMemory
 
     void AlignedFree(void* memptr)
     {
+        if (g_Allocator.m_Free)
+        {
+            AllocatorFree(memptr);
+            return;
+        }
 #if defined(__GNUC__)
         free(memptr);
 #elif defined(_MSC_VER)
@@ -66,4 +123,257 @@ namespace dmMemory
         #error "dmMemory::AlignedFree not implemented for this platform."
 #endif
     }
+
+    // The frame arena keeps one buffer per buffered frame. Each buffer is a list of pages, where the
+    // first page is the one being allocated from. When a buffer needed more than one page during a frame,
+    // the pages are merged into a single page when the buffer is reset, so that the arena settles at
+    // the frame's high water mark.
+    const uint32_t FRAME_ARENA_MIN_PAGE_SIZE = 64 * 1024;
+
+    // The page data follows the header in the same allocation
+    struct FramePage
+    {
+        FramePage*  m_Next;
+        uint32_t    m_Size;
+        uint32_t    m_Used;
+    };
+
+    static const uint32_t FRAME_PAGE_HEADER_SIZE = DM_ALIGN(sizeof(FramePage), 16);
+
+    static inline uint8_t* GetFramePageData(FramePage* page)
+    {
+        return (uint8_t*) page + FRAME_PAGE_HEADER_SIZE;
+    }
+
+    static void* AllocFramePageMemory(uint32_t size)
+    {
+        if (g_Allocator.m_Alloc)
+            return AllocatorAlloc(size, 16);
+        return malloc(size);
+    }
+
+    static void FreeFramePage(FramePage* page)
+    {
+        if (g_Allocator.m_Free)
+            AllocatorFree(page);
+        else
+            free(page);
+    }
+
+    struct FrameArena
+    {
+        FrameArena()
+        {
+            memset(m_Buffers, 0, sizeof(m_Buffers));
+            m_Current = 0;
+            dmSpinlock::Create(&m_Lock);
+        }
+
+        ~FrameArena()
+        {
+            for (uint32_t i = 0; i < FRAME_ARENA_BUFFER_COUNT; ++i)
+            {
+                FramePage* page = m_Buffers[i];
+                while (page)
+                {
+                    FramePage* next = page->m_Next;
+                    FreeFramePage(page);
+                    page = next;
+                }
+                m_Buffers[i] = 0;
+            }
+            dmSpinlock::Destroy(&m_Lock);
+        }
+
+        FramePage*              m_Buffers[FRAME_ARENA_BUFFER_COUNT];
+        uint32_t                m_Current;
+        dmSpinlock::Spinlock    m_Lock;
+    } g_FrameArena;
+
+    static FramePage* NewFramePage(uint32_t size, FramePage* next)
+    {
+        FramePage* page = (FramePage*) AllocFramePageMemory(FRAME_PAGE_HEADER_SIZE + size);
+        if (page)
+        {
+            page->m_Next = next;
+            page->m_Size = size;
+            page->m_Used = 0;
+        }
+        return page;
+    }
+
+    // Returns the aligned offset of the allocation within the page, or the page size if it doesn't fit
+    static uint32_t FitFrameAllocation(FramePage* page, uint32_t size, uint32_t alignment)
+    {
+        uintptr_t base = (uintptr_t) GetFramePageData(page);
+        uint32_t offset = (uint32_t) (DM_ALIGN(base + page->m_Used, alignment) - base);
+        if (offset > page->m_Size || page->m_Size - offset < size)
+            return page->m_Size;
+        return offset;
+    }
+
+    void* FrameAlloc(uint32_t size, uint32_t alignment)
+    {
+        assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+        DM_SPINLOCK_SCOPED_LOCK(g_FrameArena.m_Lock);
+
+        FramePage** buffer = &g_FrameArena.m_Buffers[g_FrameArena.m_Current];
+        FramePage* page = *buffer;
+
+        uint32_t offset = page ? FitFrameAllocation(page, size, alignment) : 0;
+        if (page == 0 || offset == page->m_Size)
+        {
+            // Grow geometrically, the pages are merged at the next reset anyway
+            uint32_t page_size = page ? page->m_Size * 2 : FRAME_ARENA_MIN_PAGE_SIZE;
+            if (page_size < size + alignment)
+                page_size = size + alignment;
+
+            page = NewFramePage(page_size, page);
+            if (!page)
+                return 0;
+            *buffer = page;
+            offset = FitFrameAllocation(page, size, alignment);
+        }
+
+        page->m_Used = offset + size;
+        return GetFramePageData(page) + offset;
+    }
+
+    void FrameReset()
+    {
+        DM_SPINLOCK_SCOPED_LOCK(g_FrameArena.m_Lock);
+
+        g_FrameArena.m_Current = (g_FrameArena.m_Current + 1) % FRAME_ARENA_BUFFER_COUNT;
+
+        FramePage** buffer = &g_FrameArena.m_Buffers[g_FrameArena.m_Current];
+        FramePage* page = *buffer;
+        if (!page)
+            return;
+
+        if (page->m_Next)
+        {
+            uint32_t total_size = 0;
+            while (page)
+            {
+                FramePage* next = page->m_Next;
+                total_size += page->m_Size;
+                FreeFramePage(page);
+                page = next;
+            }
+            // If this fails, we'll try again at the next allocation
+            page = NewFramePage(total_size, 0);
+            *buffer = page;
+        }
+
+        if (page)
+        {
+            page->m_Used = 0;
+        }
+    }
+
+    uint32_t GetFrameArenaSize()
+    {
+        DM_SPINLOCK_SCOPED_LOCK(g_FrameArena.m_Lock);
+
+        uint32_t size = 0;
+        for (uint32_t i = 0; i < FRAME_ARENA_BUFFER_COUNT; ++i)
+        {
+            for (FramePage* page = g_FrameArena.m_Buffers[i]; page; page = page->m_Next)
+            {
+                size += page->m_Size;
+            }
+        }
+        return size;
+    }
+
+    // The tag of each thread is stored in a thread local value. The previous tags are kept by ScopedTag,
+    // so that there's no stack to allocate per thread.
+    struct Tags
+    {
+        Tags()
+        {
+            memset(m_Stats, 0, sizeof(m_Stats));
+            m_Key = dmThread::AllocTls();
+            m_KeyValid = 1;
+        }
+
+        ~Tags()
+        {
+            m_KeyValid = 0;
+            dmThread::FreeTls(m_Key);
+        }
+
+        TagStats            m_Stats[TAG_COUNT];
+        dmThread::TlsKey    m_Key;
+        // Allocations may happen before the construction, e.g. in the memory profiler library
+        int32_atomic_t      m_KeyValid;
+    } g_Tags;
+
+    const char* GetTagName(Tag tag)
+    {
+        switch (tag)
+        {
+            case TAG_UNTAGGED:  return "untagged";
+            case TAG_RENDER:    return "render";
+            case TAG_GUI:       return "gui";
+            case TAG_PHYSICS:   return "physics";
+            case TAG_LUA:       return "lua";
+            case TAG_SOUND:     return "sound";
+            case TAG_RESOURCE:  return "resource";
+            default:            return "unknown";
+        }
+    }
+
+    Tag SetCurrentTag(Tag tag)
+    {
+        Tag previous = GetCurrentTag();
+        if (g_Tags.m_KeyValid)
+            dmThread::SetTlsValue(g_Tags.m_Key, (void*)(uintptr_t)tag);
+        return previous;
+    }
+
+    Tag GetCurrentTag()
+    {
+        if (!g_Tags.m_KeyValid)
+            return TAG_UNTAGGED;
+        return (Tag)(uintptr_t)dmThread::GetTlsValue(g_Tags.m_Key);
+    }
+
+    void TrackAlloc(uint32_t size)
+    {
+        TrackAlloc(GetCurrentTag(), size);
+    }
+
+    void TrackAlloc(Tag tag, uint32_t size)
+    {
+        assert(tag < TAG_COUNT);
+        dmAtomicAdd32(&g_Tags.m_Stats[tag].m_Active, (int32_t)size);
+    }
+
+    void TrackFree(Tag tag, uint32_t size)
+    {
+        assert(tag < TAG_COUNT);
+        dmAtomicSub32(&g_Tags.m_Stats[tag].m_Active, (int32_t)size);
+    }
+
+    void SetTagActive(Tag tag, uint32_t size)
+    {
+        assert(tag < TAG_COUNT);
+        dmAtomicStore32(&g_Tags.m_Stats[tag].m_Active, (int32_t)size);
+    }
+
+    void GetTagStats(Tag tag, TagStats* stats)
+    {
+        assert(tag < TAG_COUNT);
+        *stats = g_Tags.m_Stats[tag];
+    }
+
+    void CountTagAllocation(Tag tag, uint32_t size)
+    {
+        if (tag >= TAG_COUNT)
+            return;
+        dmAtomicAdd32(&g_Tags.m_Stats[tag].m_Allocated, (int32_t)size);
+        dmAtomicIncrement32(&g_Tags.m_Stats[tag].m_AllocationCount);
+    }
 }
@@ -16,5 +16,151 @@
 #define DM_MEMORY_H
 
 #include <dmsdk/dlib/memory.h>
+#include <dmsdk/dlib/atomic.h>
+
+namespace dmMemory
+{
+    // Number of frames an allocation from FrameAlloc stays valid
+    const uint32_t FRAME_ARENA_BUFFER_COUNT = 2;
+
+    /**
+     * Marks the end of a frame. Memory returned by FrameAlloc during the oldest buffered
+     * frame is reused from here on. Must not be called while other threads use FrameAlloc.
+     */
+    void FrameReset();
+
+    /**
+     * Get the number of bytes currently reserved by the frame arena
+     * @return number of bytes
+     */
+    uint32_t GetFrameArenaSize();
+
+    /**
+     * Allocator used by AlignedMalloc() and the frame arena, e.g. an allocator with per thread caches.
+     * The alignment is always a power of two.
+     */
+    struct Allocator
+    {
+        void*       (*m_Alloc)(void* context, uint32_t size, uint32_t alignment);
+        void        (*m_Free)(void* context, void* memory);
+        /// Optional. Gets the usable size of an allocation, which enables the allocator stats
+        uint32_t    (*m_GetSize)(void* context, void* memory);
+        void*       m_Context;
+    };
+
+    /**
+     * Sets the allocator used by AlignedMalloc() and the frame arena. Since memory must be freed
+     * by the allocator it was allocated with, this must be called before any such allocation is made,
+     * e.g. first thing in main(), and the allocator must outlive them.
+     * @param allocator the allocator, or 0 to use the platform allocator
+     */
+    void SetAllocator(const Allocator* allocator);
+
+    /**
+     * Memory use of the allocator set with SetAllocator()
+     */
+    struct AllocatorStats
+    {
+        /// Bytes currently in use
+        int32_atomic_t m_Active;
+        /// Bytes allocated in total
+        int32_atomic_t m_Allocated;
+        /// Number of allocations in total
+        int32_atomic_t m_AllocationCount;
+    };
+
+    /**
+     * Gets the memory use of the allocator. Only counted if the allocator implements m_GetSize
+     */
+    void GetAllocatorStats(AllocatorStats* stats);
+
+    /**
+     * Memory tags, to account the memory use per subsystem
+     */
+    enum Tag
+    {
+        TAG_UNTAGGED,
+        TAG_RENDER,
+        TAG_GUI,
+        TAG_PHYSICS,
+        TAG_LUA,
+        TAG_SOUND,
+        TAG_RESOURCE,
+        TAG_COUNT,
+    };
+
+    /**
+     * Memory use of a tag
+     */
+    struct TagStats
+    {
+        /// Bytes currently in use, as accounted with TrackAlloc() and TrackFree(), or SetTagActive()
+        int32_atomic_t m_Active;
+        /// Bytes allocated on the threads while the tag was current. Only counted by the memory profiler library
+        int32_atomic_t m_Allocated;
+        /// Number of allocations on the threads while the tag was current. Only counted by the memory profiler library
+        int32_atomic_t m_AllocationCount;
+    };
+
+    const char* GetTagName(Tag tag);
+
+    /**
+     * Sets the tag of the current thread
+     * @return the previous tag
+     */
+    Tag SetCurrentTag(Tag tag);
+
+    /**
+     * Gets the tag of the current thread. TAG_UNTAGGED by default
+     */
+    Tag GetCurrentTag();
+
+    /**
+     * Accounts memory in use, to the tag of the current thread
+     */
+    void TrackAlloc(uint32_t size);
+
+    /**
+     * Accounts memory in use, to a specific tag
+     */
+    void TrackAlloc(Tag tag, uint32_t size);
+    void TrackFree(Tag tag, uint32_t size);
+
+    /**
+     * Sets the memory in use of memory that is measured rather than tracked, e.g. the Lua heap
+     */
+    void SetTagActive(Tag tag, uint32_t size);
+
+    /**
+     * Counts an allocation made while the tag was current. Called by the memory profiler library, for all allocations
+     */
+    void CountTagAllocation(Tag tag, uint32_t size);
+
+    /**
+     * Gets the memory use of a tag
+     */
+    void GetTagStats(Tag tag, TagStats* stats);
+
+    /**
+     * Makes a tag current for the rest of the scope, e.g. for the allocations of a subsystem
+     */
+    struct ScopedTag
+    {
+        Tag m_Previous;
+        ScopedTag(Tag tag)
+        {
+            m_Previous = SetCurrentTag(tag);
+        }
+
+        ~ScopedTag()
+        {
+            SetCurrentTag(m_Previous);
+        }
+    };
+
+    #define DM_MEMORY_TAG_PASTE(x, y) x ## y
+    #define DM_MEMORY_TAG_PASTE2(x, y) DM_MEMORY_TAG_PASTE(x, y)
+    #define DM_MEMORY_TAG(tag) dmMemory::ScopedTag DM_MEMORY_TAG_PASTE2(memory_tag, __LINE__)(tag);
+}
 
 #endif // DM_MEMORY_H
@@ -20,6 +20,7 @@
 #include <dlib/dstrings.h>
 
 #include "memprofile.h"
+#include "memory.h"
 #include "dlib.h"
 
 // TODO: Reverse this if statement to set which platforms are actually supported!
@@ -113,6 +114,8 @@ namespace dmMemProfile
         Stats* m_Stats;
         bool*  m_IsEnabled;
         void (*m_AddCounter)(const char*, uint32_t);
+        dmMemory::Tag (*m_GetCurrentTag)();
+        void (*m_CountTagAllocation)(dmMemory::Tag, uint32_t);
     };
 }
 
@@ -137,6 +140,8 @@ namespace dmMemProfile
             data.m_Stats = &dmMemProfile::g_Stats;
             data.m_IsEnabled = &dmMemProfile::g_IsEnabled;
             data.m_AddCounter = dmProfile::AddCounter;
+            data.m_GetCurrentTag = dmMemory::GetCurrentTag;
+            data.m_CountTagAllocation = dmMemory::CountTagAllocation;
 
             init(&data);
         }
@@ -241,6 +246,8 @@ namespace dmMemProfile
     pthread_mutex_t* g_Mutex = 0;
     Stats* g_ExtStats = 0;
     void (*g_AddCounter)(const char*, uint32_t) = 0;
+    dmMemory::Tag (*g_GetCurrentTag)() = 0;
+    void (*g_CountTagAllocation)(dmMemory::Tag, uint32_t) = 0;
 
     int g_TraceFile = -1;
 
@@ -263,6 +270,8 @@ namespace dmMemProfile
         *internal_data->m_IsEnabled = true;
         g_ExtStats = internal_data->m_Stats;
         g_AddCounter = internal_data->m_AddCounter;
+        g_GetCurrentTag = internal_data->m_GetCurrentTag;
+        g_CountTagAllocation = internal_data->m_CountTagAllocation;
 
         char* trace = getenv("DMMEMPROFILE_TRACE");
         if (trace && strlen(trace) > 0 && trace[0] != '0')
@@ -291,6 +300,13 @@ namespace dmMemProfile
         // We leak a mutex delibrity here
     }
 
+    // Counts the allocation to the memory tag of the current thread. The frees can't be counted, since the tag of the allocation isn't stored
+    static void CountTagAllocation(uint32_t size)
+    {
+        if (g_CountTagAllocation)
+            g_CountTagAllocation(g_GetCurrentTag(), size);
+    }
+
     void DumpBacktracePlatform(int file)
     {
         char buf[256];
@@ -380,6 +396,7 @@ DM_DLLEXPORT void *malloc(size_t size)
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_TotalAllocated, (uint32_t) usable_size);
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_TotalActive, (uint32_t) usable_size);
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_AllocationCount, 1U);
+            dmMemProfile::CountTagAllocation((uint32_t) usable_size);
 
             if (dmMemProfile::g_AddCounter)
             {
@@ -424,6 +441,7 @@ DM_DLLEXPORT void *memalign(size_t alignment, size_t size)
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_TotalAllocated, (uint32_t) usable_size);
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_TotalActive, (uint32_t) usable_size);
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_AllocationCount, 1U);
+            dmMemProfile::CountTagAllocation((uint32_t) usable_size);
 
             dmMemProfile::g_AddCounter("Memory.Allocations", 1U);
             dmMemProfile::g_AddCounter("Memory.Amount", usable_size);
@@ -465,6 +483,7 @@ DM_DLLEXPORT int posix_memalign(void **memptr, size_t alignment, size_t size)
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_TotalAllocated, (uint32_t) usable_size);
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_TotalActive, (uint32_t) usable_size);
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_AllocationCount, 1U);
+            dmMemProfile::CountTagAllocation((uint32_t) usable_size);
 
             dmMemProfile::g_AddCounter("Memory.Allocations", 1U);
             dmMemProfile::g_AddCounter("Memory.Amount", usable_size);
@@ -505,6 +524,7 @@ DM_DLLEXPORT void *calloc(size_t count, size_t size)
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_TotalAllocated, (uint32_t) usable_size);
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_TotalActive, (uint32_t) usable_size);
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_AllocationCount, 1U);
+            dmMemProfile::CountTagAllocation((uint32_t) usable_size);
 
             dmMemProfile::g_AddCounter("Memory.Allocations", 1U);
             dmMemProfile::g_AddCounter("Memory.Amount", usable_size);
@@ -561,6 +581,7 @@ DM_DLLEXPORT void *realloc(void* ptr, size_t size)
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_TotalAllocated, (uint32_t) usable_size);
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_TotalActive, (uint32_t) usable_size);
             dmAtomicAdd32(&dmMemProfile::g_ExtStats->m_AllocationCount, 1U);
+            dmMemProfile::CountTagAllocation((uint32_t) usable_size);
 
             dmMemProfile::g_AddCounter("Memory.Allocations", 1U);
             dmMemProfile::g_AddCounter("Memory.Amount", usable_size);
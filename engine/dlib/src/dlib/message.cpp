@@ -24,6 +24,7 @@
 #include <dlib/mutex.h>
 #include <dlib/static_assert.h>
 #include <dlib/spinlock.h>
+#include <dlib/thread.h>
 #include <dlib/profile/profile.h>
 
 DM_PROPERTY_GROUP(rmtp_Message, "dmMessage");
@@ -34,26 +35,43 @@ namespace dmMessage
     // Alignment of allocations
     const uint32_t DM_MESSAGE_ALIGNMENT = 16U;
 
+    // Number of payload arenas. Each posting thread is assigned an arena the first time it posts,
+    // so that threads posting concurrently don't contend on the same page.
+    const uint32_t DM_MESSAGE_ARENA_COUNT = 16U;
+
+    // Max number of recycled pages kept around. Pages beyond this are deleted when released.
+    const uint32_t DM_MESSAGE_MAX_FREE_PAGES = 64U;
+
     struct MemoryPage
     {
-        uint8_t     m_Memory[DM_MESSAGE_PAGE_SIZE];
-        uint32_t    m_Current;
-        MemoryPage* m_NextPage;
+        // Each message is prefixed with a pointer back to its page (padded to the alignment),
+        // hence the extra space to still fit a message of DM_MESSAGE_MAX_DATA_SIZE
+        uint8_t         m_Memory[DM_MESSAGE_PAGE_SIZE + DM_MESSAGE_ALIGNMENT];
+        uint32_t        m_Current;
+        // One reference per undispatched message, plus one while the page is the current page of an arena
+        int32_atomic_t  m_RefCount;
+        MemoryPage*     m_NextPage;
     };
 
-    struct MemoryAllocator
+    // The arena lock is only contended if more than DM_MESSAGE_ARENA_COUNT threads post at the same time
+    struct DM_ALIGNED(64) MemoryArena
     {
-        MemoryAllocator()
-        {
-            m_CurrentPage = 0;
-            m_FreePages = 0;
-            m_FullPages = 0;
-        }
-        MemoryPage* m_CurrentPage;
-        MemoryPage* m_FreePages;
-        MemoryPage* m_FullPages;
+        dmSpinlock::Spinlock m_Lock;
+        MemoryPage*          m_CurrentPage;
     };
 
+    struct MemoryAllocator
+    {
+        MemoryArena          m_Arenas[DM_MESSAGE_ARENA_COUNT];
+        dmSpinlock::Spinlock m_FreePagesLock;
+        MemoryPage*          m_FreePages;
+        uint32_t             m_FreePageCount;
+        int32_atomic_t       m_NextArena;
+        dmSpinlock::Spinlock m_ArenaKeyLock;
+        dmThread::TlsKey     m_ArenaKey;       // Allocated on the first post, freed by Finalize()
+        int32_atomic_t       m_HasArenaKey;
+    } g_MessageAllocator;
+
     struct GlobalInit
     {
         GlobalInit() {
@@ -65,24 +83,136 @@ namespace dmMessage
 
     static Result GetSocketNoLock(dmhash_t name_hash, HSocket* out_socket);
 
-    static void AllocateNewPage(MemoryAllocator* allocator)
+    // Pointer atomics for the lock-free socket queues
+    static inline Message* AtomicExchangeMessage(Message** ptr, Message* value)
+    {
+#if defined(_MSC_VER)
+        return (Message*) InterlockedExchangePointer((PVOID volatile*) ptr, (PVOID) value);
+#else
+        // Acquire barrier, which is what the consumer needs to see the message contents
+        return __sync_lock_test_and_set(ptr, value);
+#endif
+    }
+
+    static inline Message* AtomicCompareExchangeMessage(Message** ptr, Message* value, Message* comparand)
+    {
+#if defined(_MSC_VER)
+        return (Message*) InterlockedCompareExchangePointer((PVOID volatile*) ptr, (PVOID) value, (PVOID) comparand);
+#else
+        return __sync_val_compare_and_swap(ptr, comparand, value);
+#endif
+    }
+
+    static inline Message* AtomicGetMessage(Message** ptr)
+    {
+        return AtomicCompareExchangeMessage(ptr, 0, 0);
+    }
+
+    static void InitAllocator(MemoryAllocator* allocator)
     {
-        if (allocator->m_CurrentPage)
+        for (uint32_t i = 0; i < DM_MESSAGE_ARENA_COUNT; ++i)
         {
-            // Link current page to full pages
-            allocator->m_CurrentPage->m_NextPage = allocator->m_FullPages;
-            allocator->m_FullPages = allocator->m_CurrentPage;
+            dmSpinlock::Create(&allocator->m_Arenas[i].m_Lock);
+            allocator->m_Arenas[i].m_CurrentPage = 0;
         }
+        dmSpinlock::Create(&allocator->m_FreePagesLock);
+        allocator->m_FreePages = 0;
+        allocator->m_FreePageCount = 0;
+        dmAtomicStore32(&allocator->m_NextArena, 0);
+        dmSpinlock::Create(&allocator->m_ArenaKeyLock);
+        dmAtomicStore32(&allocator->m_HasArenaKey, 0);
+    }
 
-        MemoryPage* new_page = 0;
+    static void DestroyAllocator(MemoryAllocator* allocator)
+    {
+        // Pages still referenced by undispatched messages are left alone, and are deleted as the messages are released
+        for (uint32_t i = 0; i < DM_MESSAGE_ARENA_COUNT; ++i)
+        {
+            MemoryArena* arena = &allocator->m_Arenas[i];
+            MemoryPage* page = arena->m_CurrentPage;
+            arena->m_CurrentPage = 0;
+            if (page && dmAtomicDecrement32(&page->m_RefCount) == 1)
+            {
+                delete page;
+            }
+            dmSpinlock::Destroy(&arena->m_Lock);
+        }
 
-        if (allocator->m_FreePages)
+        // The free list lock is kept alive, since messages can still be released after this point.
+        // Setting the count to max makes any such page be deleted rather than recycled
+        MemoryPage* p;
         {
-            // Free page to use
-            new_page = allocator->m_FreePages;
-            allocator->m_FreePages = new_page->m_NextPage;
+            DM_SPINLOCK_SCOPED_LOCK(allocator->m_FreePagesLock);
+            p = allocator->m_FreePages;
+            allocator->m_FreePages = 0;
+            allocator->m_FreePageCount = DM_MESSAGE_MAX_FREE_PAGES;
         }
-        else
+        while (p)
+        {
+            MemoryPage* next = p->m_NextPage;
+            delete p;
+            p = next;
+        }
+        // The thread local key is freed by Finalize(), since threads may still post while static destructors run
+    }
+
+    static MemoryArena* GetThreadArena(MemoryAllocator* allocator)
+    {
+        if (!dmAtomicGet32(&allocator->m_HasArenaKey))
+        {
+            DM_SPINLOCK_SCOPED_LOCK(allocator->m_ArenaKeyLock);
+            if (!dmAtomicGet32(&allocator->m_HasArenaKey))
+            {
+                allocator->m_ArenaKey = dmThread::AllocTls();
+                dmAtomicStore32(&allocator->m_HasArenaKey, 1);
+            }
+        }
+
+        // The index is stored +1 so that 0 means "not yet assigned"
+        uintptr_t index = (uintptr_t) dmThread::GetTlsValue(allocator->m_ArenaKey);
+        if (index == 0)
+        {
+            index = 1 + (uint32_t) dmAtomicIncrement32(&allocator->m_NextArena) % DM_MESSAGE_ARENA_COUNT;
+            dmThread::SetTlsValue(allocator->m_ArenaKey, (void*) index);
+        }
+        return &allocator->m_Arenas[index - 1];
+    }
+
+    static void ReleasePage(MemoryAllocator* allocator, MemoryPage* page)
+    {
+        if (dmAtomicDecrement32(&page->m_RefCount) != 1)
+        {
+            return;
+        }
+
+        {
+            DM_SPINLOCK_SCOPED_LOCK(allocator->m_FreePagesLock);
+            if (allocator->m_FreePageCount < DM_MESSAGE_MAX_FREE_PAGES)
+            {
+                page->m_NextPage = allocator->m_FreePages;
+                allocator->m_FreePages = page;
+                allocator->m_FreePageCount++;
+                return;
+            }
+        }
+        delete page;
+    }
+
+    static MemoryPage* AllocateNewPage(MemoryAllocator* allocator)
+    {
+        MemoryPage* new_page = 0;
+        {
+            DM_SPINLOCK_SCOPED_LOCK(allocator->m_FreePagesLock);
+            if (allocator->m_FreePages)
+            {
+                // Free page to use
+                new_page = allocator->m_FreePages;
+                allocator->m_FreePages = new_page->m_NextPage;
+                allocator->m_FreePageCount--;
+            }
+        }
+
+        if (!new_page)
         {
             // Allocate new page
             new_page = new MemoryPage;
@@ -90,39 +220,60 @@ namespace dmMessage
 
         new_page->m_Current = 0;
         new_page->m_NextPage = 0;
-
-        allocator->m_CurrentPage = new_page;
+        dmAtomicStore32(&new_page->m_RefCount, 1);
+        return new_page;
     }
 
-    static void* AllocateMessage(MemoryAllocator* allocator, uint32_t size)
+    static Message* AllocateMessage(MemoryAllocator* allocator, uint32_t size)
     {
         // At least ALIGNMENT bytes alignment of size in order to ensure that the next allocation is aligned
         size += DM_MESSAGE_ALIGNMENT-1;
         size &= ~(DM_MESSAGE_ALIGNMENT-1);
         assert(size <= DM_MESSAGE_PAGE_SIZE);
+        size += DM_MESSAGE_ALIGNMENT; // The page pointer prefix
+
+        MemoryArena* arena = GetThreadArena(allocator);
+
+        DM_SPINLOCK_SCOPED_LOCK(arena->m_Lock);
 
-        if (allocator->m_CurrentPage == 0 || (DM_MESSAGE_PAGE_SIZE-allocator->m_CurrentPage->m_Current) < size)
+        MemoryPage* page = arena->m_CurrentPage;
+        if (page == 0 || (sizeof(page->m_Memory) - page->m_Current) < size)
         {
             // No current page or allocation didn't fit.
-            AllocateNewPage(allocator);
+            // The old page is recycled once all messages on it are dispatched
+            if (page)
+            {
+                ReleasePage(allocator, page);
+            }
+            page = AllocateNewPage(allocator);
+            arena->m_CurrentPage = page;
         }
 
-        MemoryPage* page = allocator->m_CurrentPage;
-        void* ret = (void*) ((uintptr_t) &page->m_Memory[0] + page->m_Current);
+        uint8_t* ret = &page->m_Memory[page->m_Current];
         page->m_Current += size;
-        return ret;
+        dmAtomicIncrement32(&page->m_RefCount);
+
+        *(MemoryPage**) ret = page;
+        return (Message*) (ret + DM_MESSAGE_ALIGNMENT);
+    }
+
+    static void FreeMessage(MemoryAllocator* allocator, Message* message)
+    {
+        MemoryPage* page = *(MemoryPage**) ((uint8_t*) message - DM_MESSAGE_ALIGNMENT);
+        ReleasePage(allocator, page);
     }
 
+    // Messages are pushed lock-free onto an intrusive stack which the dispatcher takes as a whole
+    // and reverses into posting order. The mutex and condition variable are only used by DispatchBlocking
     struct MessageSocket
     {
         uint32_t        m_RefCount; // Is protected by "g_MessageSpinlock"
         dmhash_t        m_NameHash;
-        Message*        m_Header;
-        Message*        m_Tail;
+        Message*        m_Header;   // Most recently posted message
+        int32_atomic_t  m_Waiting;  // Number of threads blocking in DispatchBlocking
         const char*     m_Name;
         dmMutex::HMutex m_Mutex;
         dmConditionVariable::HConditionVariable m_Condition;
-        MemoryAllocator m_Allocator;
     };
 
     const uint32_t MAX_SOCKETS = 256;
@@ -151,6 +302,7 @@ namespace dmMessage
         {
             dmAtomicStore32(&m_Deleted, 0);
             dmSpinlock::Create(&g_MessageSpinlock);
+            InitAllocator(&g_MessageAllocator);
         }
 
         ~ContextDestroyer()
@@ -165,10 +317,22 @@ namespace dmMessage
                 }
             }
             dmSpinlock::Destroy(&g_MessageSpinlock);
+            DestroyAllocator(&g_MessageAllocator);
         }
         int32_atomic_t m_Deleted;
     } g_ContextDestroyer;
 
+    void Finalize()
+    {
+        MemoryAllocator* allocator = &g_MessageAllocator;
+        DM_SPINLOCK_SCOPED_LOCK(allocator->m_ArenaKeyLock);
+        if (dmAtomicGet32(&allocator->m_HasArenaKey))
+        {
+            dmAtomicStore32(&allocator->m_HasArenaKey, 0);
+            dmThread::FreeTls(allocator->m_ArenaKey);
+        }
+    }
+
     Result NewSocket(const char* name, HSocket* socket)
     {
         if (dmAtomicGet32(&g_ContextDestroyer.m_Deleted))
@@ -204,7 +368,7 @@ namespace dmMessage
         MessageSocket s;
         s.m_RefCount = 1;
         s.m_Header = 0;
-        s.m_Tail = 0;
+        dmAtomicStore32(&s.m_Waiting, 0);
         s.m_NameHash = name_hash;
         s.m_Name = strdup(name);
         s.m_Mutex = dmMutex::New();
@@ -218,37 +382,20 @@ namespace dmMessage
 
     static void DisposeSocket(MessageSocket* s)
     {
-        Message *message_object = s->m_Header;
+        Message *message_object = AtomicExchangeMessage(&s->m_Header, 0);
         while (message_object)
         {
             if (message_object->m_DestroyCallback)
             {
                 message_object->m_DestroyCallback(message_object);
             }
-            message_object = message_object->m_Next;
+            Message* next = message_object->m_Next;
+            FreeMessage(&g_MessageAllocator, message_object);
+            message_object = next;
         }
 
         free((void*) s->m_Name);
 
-        MemoryPage* p = s->m_Allocator.m_FreePages;
-        while (p)
-        {
-            MemoryPage* next = p->m_NextPage;
-            delete p;
-            p = next;
-        }
-        p = s->m_Allocator.m_FullPages;
-        while (p)
-        {
-            MemoryPage* next = p->m_NextPage;
-            delete p;
-            p = next;
-        }
-        if (s->m_Allocator.m_CurrentPage)
-        {
-            delete s->m_Allocator.m_CurrentPage;
-        }
-
         dmConditionVariable::Delete(s->m_Condition);
 
         dmMutex::Delete(s->m_Mutex);
@@ -394,11 +541,7 @@ namespace dmMessage
         MessageSocket* s = AcquireSocket(socket);
         if (s != 0)
         {
-            bool has_messages;
-            {
-                DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
-                has_messages = s->m_Header != 0;
-            }
+            bool has_messages = AtomicGetMessage(&s->m_Header) != 0;
             ReleaseSocket(s);
             return has_messages;
         }
@@ -445,12 +588,9 @@ namespace dmMessage
         url->m_Fragment = fragment;
     }
 
-    Result Post(const URL* sender, const URL* receiver, dmhash_t message_id, uintptr_t user_data1, uintptr_t user_data2,
-                    uintptr_t descriptor, const void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback)
+    static Result DoPost(const URL* sender, const URL* receiver, dmhash_t message_id, uintptr_t user_data1, uintptr_t user_data2,
+                         uintptr_t descriptor, const void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback, bool reference)
     {
-        DM_PROFILE("Post");
-        //Currently called out by the Thread Sanitizer: DM_PROPERTY_ADD_U32(rmtp_Messages, 1);
-
         if (receiver == 0x0)
         {
             return RESULT_SOCKET_NOT_FOUND;
@@ -462,11 +602,9 @@ namespace dmMessage
             return RESULT_SOCKET_NOT_FOUND;
         }
 
-        dmMutex::Lock(s->m_Mutex);
-
-        MemoryAllocator* allocator = &s->m_Allocator;
-        uint32_t data_size = sizeof(Message) + message_data_size;
-        Message *new_message = (Message *) AllocateMessage(allocator, data_size);
+        // A referenced payload only stores the pointer, so it never needs more than part of a page
+        uint32_t data_size = sizeof(Message) + (reference ? sizeof(void*) : message_data_size);
+        Message *new_message = AllocateMessage(&g_MessageAllocator, data_size);
         if (sender != 0x0)
         {
             new_message->m_Sender = *sender;
@@ -481,34 +619,55 @@ namespace dmMessage
         new_message->m_UserData2 = user_data2;
         new_message->m_Descriptor = descriptor;
         new_message->m_DataSize = message_data_size;
-        new_message->m_Next = 0;
         new_message->m_DestroyCallback = destroy_callback;
-        memcpy(&new_message->m_Data[0], message_data, message_data_size);
-
-        bool is_first_message = !s->m_Header;
-
-        if (!s->m_Header)
+        if (reference)
         {
-            s->m_Header = new_message;
-            s->m_Tail = new_message;
+            new_message->m_Flags = MESSAGE_FLAG_REFERENCE;
+            *(const void**)&new_message->m_Data[0] = message_data;
         }
         else
         {
-            s->m_Tail->m_Next = new_message;
-            s->m_Tail = new_message;
+            new_message->m_Flags = 0;
+            memcpy(&new_message->m_Data[0], message_data, message_data_size);
+        }
+
+        // The compare-exchange is a full barrier, publishing the message contents before the message itself
+        Message* head = AtomicGetMessage(&s->m_Header);
+        while (true)
+        {
+            new_message->m_Next = head;
+            Message* prev = AtomicCompareExchangeMessage(&s->m_Header, new_message, head);
+            if (prev == head)
+                break;
+            head = prev;
         }
 
-        if (is_first_message)
+        if (head == 0 && dmAtomicGet32(&s->m_Waiting))
         {
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
             dmConditionVariable::Signal(s->m_Condition);
         }
-        dmMutex::Unlock(s->m_Mutex);
 
         ReleaseSocket(s);
 
         return RESULT_OK;
     }
 
+    Result Post(const URL* sender, const URL* receiver, dmhash_t message_id, uintptr_t user_data1, uintptr_t user_data2,
+                    uintptr_t descriptor, const void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback)
+    {
+        DM_PROFILE("Post");
+        //Currently called out by the Thread Sanitizer: DM_PROPERTY_ADD_U32(rmtp_Messages, 1);
+        return DoPost(sender, receiver, message_id, user_data1, user_data2, descriptor, message_data, message_data_size, destroy_callback, false);
+    }
+
+    Result PostRef(const URL* sender, const URL* receiver, dmhash_t message_id, uintptr_t user_data1, uintptr_t user_data2,
+                   uintptr_t descriptor, void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback)
+    {
+        DM_PROFILE("PostRef");
+        return DoPost(sender, receiver, message_id, user_data1, user_data2, descriptor, message_data, message_data_size, destroy_callback, true);
+    }
+
     Result Post(const URL* sender, const URL* receiver, dmhash_t message_id, uintptr_t user_data1, uintptr_t descriptor,
                     const void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback)
     {
@@ -550,60 +709,55 @@ namespace dmMessage
             return 0;
         }
 
-        dmMutex::Lock(s->m_Mutex);
-
-        MemoryAllocator* allocator = &s->m_Allocator;
-
-        if (!s->m_Header)
+        Message* message_object = AtomicExchangeMessage(&s->m_Header, 0);
+        if (!message_object)
         {
-            if (blocking) {
-                dmConditionVariable::Wait(s->m_Condition, s->m_Mutex);
-            } else {
-                dmMutex::Unlock(s->m_Mutex);
+            if (!blocking)
+            {
                 ReleaseSocket(s);
                 return 0;
             }
-        }
 
+            // Announcing the waiter before checking the queue pairs with Post checking it after pushing,
+            // so either the poster sees the waiter or we see the message
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+            dmAtomicIncrement32(&s->m_Waiting);
+            while ((message_object = AtomicExchangeMessage(&s->m_Header, 0)) == 0)
+            {
+                dmConditionVariable::Wait(s->m_Condition, s->m_Mutex);
+            }
+            dmAtomicDecrement32(&s->m_Waiting);
+        }
 
         char buffer[128];
         const char* profiler_string = GetProfilerString(s->m_Name, buffer, sizeof(buffer));
         DM_PROFILE_DYN(profiler_string, 0);
 
-        uint32_t dispatch_count = 0;
-
-        Message *message_object = s->m_Header;
-        s->m_Header = 0;
-        s->m_Tail = 0;
-
-        // Unlink full pages
-        MemoryPage* full_pages = allocator->m_FullPages;
-        allocator->m_FullPages = 0;
-
-        dmMutex::Unlock(s->m_Mutex);
+        // The messages were pushed in reverse posting order
+        Message* reversed = 0;
+        while (message_object)
+        {
+            Message* next = message_object->m_Next;
+            message_object->m_Next = reversed;
+            reversed = message_object;
+            message_object = next;
+        }
+        message_object = reversed;
 
+        uint32_t dispatch_count = 0;
         while (message_object)
         {
             dispatch_callback(message_object, user_ptr);
             if (message_object->m_DestroyCallback) {
                 message_object->m_DestroyCallback(message_object);
             }
-            message_object = message_object->m_Next;
+            // The memory may be reused as soon as it's released
+            Message* next = message_object->m_Next;
+            FreeMessage(&g_MessageAllocator, message_object);
+            message_object = next;
             dispatch_count++;
         }
 
-        // Reclaim all full pages active when dispatch started
-        dmMutex::Lock(s->m_Mutex);
-        MemoryPage* p = full_pages;
-        while (p)
-        {
-            MemoryPage* next = p->m_NextPage;
-            p->m_NextPage = allocator->m_FreePages;
-            allocator->m_FreePages = p;
-            p = next;
-        }
-        dmMutex::Unlock(s->m_Mutex);
-
         ReleaseSocket(s);
 
         return dispatch_count;
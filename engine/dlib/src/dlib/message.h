@@ -34,6 +34,13 @@ namespace dmMessage
     typedef void(*DispatchCallback)(dmMessage::Message *message, void* user_ptr);
 
 
+    /**
+     * Free the per thread state of the message system.
+     * @note No other thread may post messages while, or after, this is called. Posting from the
+     *       calling thread afterwards is allowed, and sets up the state again
+     */
+    void Finalize();
+
     /**
      * Create a new socket
      * @param name Socket name. Its length must be more than 0 and it cannot contain the characters '#' or ':' (@see ParseURL)
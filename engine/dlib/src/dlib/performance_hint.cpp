@@ -0,0 +1,226 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "performance_hint.h"
+
+#if defined(ANDROID)
+
+#include <dlfcn.h>
+#include <math.h>
+#include <stddef.h>
+#include <dlib/log.h>
+#include <dlib/time.h>
+
+namespace dmPerformanceHint
+{
+    // From android/performance_hint.h and android/thermal.h, which aren't in all the NDK versions we build with
+    struct APerformanceHintManager;
+    struct APerformanceHintSession;
+    struct AThermalManager;
+
+    typedef APerformanceHintManager* (*FGetManager)();
+    typedef APerformanceHintSession* (*FCreateSession)(APerformanceHintManager* manager, const int32_t* thread_ids, size_t size, int64_t initial_target_nanos);
+    typedef int  (*FUpdateTargetWorkDuration)(APerformanceHintSession* session, int64_t target_nanos);
+    typedef int  (*FReportActualWorkDuration)(APerformanceHintSession* session, int64_t actual_nanos);
+    typedef void (*FCloseSession)(APerformanceHintSession* session);
+    typedef AThermalManager* (*FAcquireManager)();
+    typedef void  (*FReleaseManager)(AThermalManager* manager);
+    typedef float (*FGetThermalHeadroom)(AThermalManager* manager, int forecast_seconds);
+
+    // The OS doesn't update the headroom more often than this
+    static const uint64_t THERMAL_POLL_INTERVAL = 1000000;
+
+    struct Session
+    {
+        APerformanceHintSession* m_Session;
+        uint64_t                 m_TargetDuration;
+    };
+
+    struct Functions
+    {
+        void*                     m_Library;
+        FGetManager               m_GetManager;
+        FCreateSession            m_CreateSession;
+        FUpdateTargetWorkDuration m_UpdateTargetWorkDuration;
+        FReportActualWorkDuration m_ReportActualWorkDuration;
+        FCloseSession             m_CloseSession;
+        FAcquireManager           m_AcquireThermalManager;
+        FReleaseManager           m_ReleaseThermalManager;
+        FGetThermalHeadroom       m_GetThermalHeadroom;
+
+        AThermalManager*          m_ThermalManager;
+        uint64_t                  m_ThermalPollTime;
+        float                     m_ThermalHeadroom;
+        uint8_t                   m_Loaded : 1;
+        uint8_t                   m_ThermalValid : 1;
+    };
+
+    static Functions g_Functions = {};
+
+    static Functions* LoadFunctions()
+    {
+        Functions* f = &g_Functions;
+        if (f->m_Loaded)
+            return f;
+        f->m_Loaded = 1;
+
+        f->m_Library = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+        if (!f->m_Library)
+            return f;
+
+        // Any of these are 0 if the API level is too low
+        f->m_GetManager               = (FGetManager) dlsym(f->m_Library, "APerformanceHint_getManager");
+        f->m_CreateSession            = (FCreateSession) dlsym(f->m_Library, "APerformanceHint_createSession");
+        f->m_UpdateTargetWorkDuration = (FUpdateTargetWorkDuration) dlsym(f->m_Library, "APerformanceHint_updateTargetWorkDuration");
+        f->m_ReportActualWorkDuration = (FReportActualWorkDuration) dlsym(f->m_Library, "APerformanceHint_reportActualWorkDuration");
+        f->m_CloseSession             = (FCloseSession) dlsym(f->m_Library, "APerformanceHint_closeSession");
+        f->m_AcquireThermalManager    = (FAcquireManager) dlsym(f->m_Library, "AThermal_acquireManager");
+        f->m_ReleaseThermalManager    = (FReleaseManager) dlsym(f->m_Library, "AThermal_releaseManager");
+        f->m_GetThermalHeadroom       = (FGetThermalHeadroom) dlsym(f->m_Library, "AThermal_getThermalHeadroom");
+        return f;
+    }
+
+    HSession NewSession(const int32_t* thread_ids, uint32_t thread_count, uint64_t target_duration)
+    {
+        Functions* f = LoadFunctions();
+        if (!f->m_GetManager || !f->m_CreateSession || !f->m_UpdateTargetWorkDuration || !f->m_ReportActualWorkDuration || !f->m_CloseSession)
+            return 0;
+        if (thread_count == 0 || target_duration == 0)
+            return 0;
+
+        APerformanceHintManager* manager = f->m_GetManager();
+        if (!manager)
+            return 0;
+
+        APerformanceHintSession* hint_session = f->m_CreateSession(manager, thread_ids, thread_count, (int64_t) target_duration * 1000);
+        if (!hint_session)
+        {
+            dmLogWarning("Unable to create a performance hint session for %u threads", thread_count);
+            return 0;
+        }
+
+        Session* session = new Session;
+        session->m_Session        = hint_session;
+        session->m_TargetDuration = target_duration;
+        return session;
+    }
+
+    void DeleteSession(HSession session)
+    {
+        if (!session)
+            return;
+        g_Functions.m_CloseSession(session->m_Session);
+        delete session;
+    }
+
+    void SetTargetDuration(HSession session, uint64_t target_duration)
+    {
+        if (!session || target_duration == 0 || session->m_TargetDuration == target_duration)
+            return;
+        session->m_TargetDuration = target_duration;
+        g_Functions.m_UpdateTargetWorkDuration(session->m_Session, (int64_t) target_duration * 1000);
+    }
+
+    void ReportDuration(HSession session, uint64_t duration)
+    {
+        // The OS rejects durations of 0
+        if (!session || duration == 0)
+            return;
+        g_Functions.m_ReportActualWorkDuration(session->m_Session, (int64_t) duration * 1000);
+    }
+
+    bool GetThermalHeadroom(uint32_t forecast_seconds, float* out_headroom)
+    {
+        Functions* f = LoadFunctions();
+        if (!f->m_AcquireThermalManager || !f->m_ReleaseThermalManager || !f->m_GetThermalHeadroom)
+            return false;
+
+        if (!f->m_ThermalManager)
+        {
+            f->m_ThermalManager = f->m_AcquireThermalManager();
+            if (!f->m_ThermalManager)
+                return false;
+        }
+
+        uint64_t time = dmTime::GetTime();
+        if (!f->m_ThermalValid || time - f->m_ThermalPollTime >= THERMAL_POLL_INTERVAL)
+        {
+            f->m_ThermalPollTime = time;
+            float headroom = f->m_GetThermalHeadroom(f->m_ThermalManager, (int) forecast_seconds);
+            // NaN when the device has no thermal model, or when it's polled too often
+            if (!isnan(headroom))
+            {
+                f->m_ThermalHeadroom = headroom;
+                f->m_ThermalValid = 1;
+            }
+        }
+
+        *out_headroom = f->m_ThermalHeadroom;
+        return f->m_ThermalValid;
+    }
+
+    void Finalize()
+    {
+        Functions* f = &g_Functions;
+        if (f->m_ThermalManager)
+        {
+            f->m_ReleaseThermalManager(f->m_ThermalManager);
+            f->m_ThermalManager = 0;
+        }
+        f->m_ThermalValid = 0;
+    }
+}
+
+#else
+
+namespace dmPerformanceHint
+{
+    HSession NewSession(const int32_t* thread_ids, uint32_t thread_count, uint64_t target_duration)
+    {
+        (void)thread_ids;
+        (void)thread_count;
+        (void)target_duration;
+        return 0;
+    }
+
+    void DeleteSession(HSession session)
+    {
+        (void)session;
+    }
+
+    void SetTargetDuration(HSession session, uint64_t target_duration)
+    {
+        (void)session;
+        (void)target_duration;
+    }
+
+    void ReportDuration(HSession session, uint64_t duration)
+    {
+        (void)session;
+        (void)duration;
+    }
+
+    bool GetThermalHeadroom(uint32_t forecast_seconds, float* out_headroom)
+    {
+        (void)forecast_seconds;
+        (void)out_headroom;
+        return false;
+    }
+
+    void Finalize()
+    {
+    }
+}
+
+#endif
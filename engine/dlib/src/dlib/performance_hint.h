@@ -0,0 +1,66 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_PERFORMANCE_HINT_H
+#define DM_PERFORMANCE_HINT_H
+
+#include <stdint.h>
+
+/*
+ * Reports the work duration of the frame threads to the OS, so that it can pick the CPU clocks and cores
+ * ahead of time, and reads the thermal headroom of the device.
+ *
+ * On Android it's the ADPF PerformanceHintManager (API 33) and AThermal_getThermalHeadroom (API 31). The
+ * functions are looked up at runtime, so older devices simply report that they aren't supported.
+ * On the other platforms nothing is supported.
+ */
+
+namespace dmPerformanceHint
+{
+    typedef struct Session* HSession;
+
+    // How far ahead the engine and sys.get_thermal_headroom() forecast the thermal headroom
+    const static uint32_t THERMAL_FORECAST_SECONDS = 10;
+
+    /**
+     * Creates a session for the threads
+     * @param thread_ids [type: const int32_t*] the system ids of the threads, see dmThread::GetCurrentThreadSystemId
+     * @param thread_count [type: uint32_t] the number of threads
+     * @param target_duration [type: uint64_t] the target work duration of a frame, in microseconds
+     * @return the session, or 0 if the platform doesn't support performance hints
+     */
+    HSession NewSession(const int32_t* thread_ids, uint32_t thread_count, uint64_t target_duration);
+
+    void DeleteSession(HSession session);
+
+    // Sets the target work duration of a frame, in microseconds. Only calls the OS if the target changed
+    void SetTargetDuration(HSession session, uint64_t target_duration);
+
+    // Reports the actual work duration of a frame, in microseconds
+    void ReportDuration(HSession session, uint64_t duration);
+
+    /**
+     * Gets the thermal headroom, where 0 is no heat and 1 is where the device starts to throttle.
+     * The OS is asked at most once per second, and the last value is returned in between.
+     * @param forecast_seconds [type: uint32_t] how far ahead to forecast the headroom
+     * @param out_headroom [type: float*] the headroom
+     * @return false if the platform doesn't report the thermal headroom
+     */
+    bool GetThermalHeadroom(uint32_t forecast_seconds, float* out_headroom);
+
+    // Releases the thermal manager, if it was acquired by GetThermalHeadroom
+    void Finalize();
+}
+
+#endif // DM_PERFORMANCE_HINT_H
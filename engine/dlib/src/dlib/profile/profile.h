@@ -32,6 +32,9 @@ namespace dmProfile
     {
         uint32_t m_Port;
         uint32_t m_SleepBetweenServerUpdates;
+        // Record the scopes in per thread event buffers, merged into the sample trees on a separate thread,
+        // instead of sending them to Remotery. The samples are then not shown in the Remotery web ui.
+        bool     m_NativeSamples;
     };
 
     /**
@@ -16,16 +16,28 @@
 
 #include <stdio.h> // vsnprintf
 #include <stdarg.h> // va_start et al
+#include <stdlib.h> // free
+#include <string.h> // strlen, strdup
 
 #include "dlib/dlib.h"
 #include "dlib/log.h"
 #include "dlib/atomic.h"
+#include "dlib/dstrings.h"
 #include "dlib/spinlock.h"
+#include "dlib/thread.h"
+#include "dlib/time.h"
 
 #include "dlib/hash.h"
+#include "dlib/hashtable.h"
 
 #include "dmsdk/external/remotery/Remotery.h"
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
 namespace dmProfile
 {
     static Remotery*                g_Remotery = 0;
@@ -36,6 +48,87 @@ namespace dmProfile
     static int32_atomic_t           g_ProfilerInitialized = 0;
     static dmSpinlock::Spinlock     g_ProfilerLock;
 
+    // *******************************************************************
+    // Native samples
+    //
+    // Each thread records its scopes as time stamped events in a ring buffer of its own, that only it writes to.
+    // The merge thread replays the events into aggregated sample trees, and passes each finished root sample
+    // to the sample tree callback, the same way as Remotery does.
+    // Recording an event needs no locks or allocations, apart from the first time a thread sees a name.
+
+    static const uint32_t NATIVE_MAX_THREADS        = 64;
+    static const uint32_t NATIVE_EVENT_COUNT        = 4096; // Power of two
+    static const uint32_t NATIVE_NAME_CACHE_SIZE    = 256;  // Power of two
+    static const uint32_t NATIVE_MAX_SAMPLES        = 1024; // Unique samples per root sample
+    static const uint32_t NATIVE_MERGE_INTERVAL     = 2000; // us
+    static const uint32_t NATIVE_PUBLISH_INTERVAL   = 32;   // Max events recorded within a root scope before they're published
+
+    enum NativeEventType
+    {
+        NATIVE_EVENT_SCOPE_BEGIN,
+        NATIVE_EVENT_SCOPE_END,
+        NATIVE_EVENT_COUNTER,
+    };
+
+    struct NativeEvent
+    {
+        uint64_t m_Value; // The ticks, or the amount of a counter
+        uint32_t m_NameHash;
+        uint32_t m_Type;
+    };
+
+    struct NativeSample
+    {
+        const char*     m_Name;
+        uint32_t        m_NameHash;
+        uint32_t        m_CallCount;
+        uint64_t        m_Start;
+        uint64_t        m_Time;
+        uint64_t        m_ChildTime;
+        uint64_t        m_CallStart;
+        NativeSample*   m_Parent;
+        NativeSample*   m_FirstChild;
+        NativeSample*   m_LastChild;
+        NativeSample*   m_Sibling;
+    };
+
+    struct NativeThread
+    {
+        NativeEvent     m_Events[NATIVE_EVENT_COUNT];
+        int32_atomic_t  m_WriteIndex;   // The events published to the merge thread
+        int32_atomic_t  m_ReadIndex;
+
+        // Only used by the recording thread
+        uint32_t        m_Written;
+        uint32_t        m_ReadIndexCache;
+        uint32_t        m_Depth;        // Recorded scopes that haven't ended
+        uint32_t        m_SkipDepth;    // Scopes that weren't recorded since the buffer was full
+        uint32_t        m_NameCache[NATIVE_NAME_CACHE_SIZE];
+
+        // Only used by the merge thread
+        NativeSample    m_Samples[NATIVE_MAX_SAMPLES];
+        uint32_t        m_SampleCount;
+        uint32_t        m_DroppedDepth; // Scopes that weren't merged since the sample tree was full
+        NativeSample*   m_Current;
+
+        char            m_Name[64];     // Guarded by g_ProfilerLock
+    };
+
+    // Marks a thread that came after all the NATIVE_MAX_THREADS buffers were taken
+    static NativeThread* const      NATIVE_THREAD_NONE = (NativeThread*)(uintptr_t)1;
+
+    static bool                     g_NativeSamples = false;
+    static dmThread::TlsKey         g_NativeThreadKey;
+    static NativeThread*            g_NativeThreads[NATIVE_MAX_THREADS];
+    static int32_atomic_t           g_NativeThreadCount = 0;
+    static dmHashTable32<char*>     g_NativeNames;
+    static dmSpinlock::Spinlock     g_NativeLock; // Guards the thread registration and the names
+    static dmThread::Thread         g_NativeMergeThread;
+    static int32_atomic_t           g_NativeMergeActive = 0;
+    static uint64_t                 g_NativeTicksStart;
+    static uint64_t                 g_NativeTimeStart;
+    static double                   g_NativeTimePerTick = 0.0;
+
     static inline rmtSample* SampleFromHandle(HSample sample)
     {
         return (rmtSample*)sample;
@@ -60,7 +153,8 @@ namespace dmProfile
 
     static void SampleTreeCallback(void* ctx, rmtSampleTree* sample_tree)
     {
-        if (!IsInitialized())
+        // With the native samples, the only trees left here are from Remotery's own thread
+        if (!IsInitialized() || g_NativeSamples)
             return;
 
         DM_SPINLOCK_SCOPED_LOCK(g_ProfilerLock);
@@ -87,6 +181,344 @@ namespace dmProfile
         }
     }
 
+    // The scopes are timed with the cpu counter where there is one, since reading the system time costs more
+    // than the rest of the scope. The ticks are converted to microseconds on the merge thread.
+    static inline uint64_t GetNativeTicks()
+    {
+    #if (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+    #elif defined(__aarch64__)
+        uint64_t ticks;
+        __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+    #else
+        return dmTime::GetTime();
+    #endif
+    }
+
+    static void CalibrateNativeTicks()
+    {
+        uint64_t ticks = GetNativeTicks() - g_NativeTicksStart;
+        uint64_t time = dmTime::GetTime() - g_NativeTimeStart;
+        if (ticks > 0 && time > 0)
+            g_NativeTimePerTick = time / (double)ticks;
+    }
+
+    static inline uint64_t NativeTicksToTime(uint64_t ticks)
+    {
+        return g_NativeTimeStart + (uint64_t)((int64_t)(ticks - g_NativeTicksStart) * g_NativeTimePerTick);
+    }
+
+    static NativeThread* GetNativeThread()
+    {
+        NativeThread* thread = (NativeThread*)dmThread::GetTlsValue(g_NativeThreadKey);
+        if (thread)
+            return thread != NATIVE_THREAD_NONE ? thread : 0;
+
+        DM_SPINLOCK_SCOPED_LOCK(g_NativeLock);
+
+        uint32_t index = (uint32_t)dmAtomicGet32(&g_NativeThreadCount);
+        if (index == NATIVE_MAX_THREADS)
+        {
+            dmLogWarning("Out of profiler thread buffers (%u), the samples of this thread are not recorded", NATIVE_MAX_THREADS);
+            dmThread::SetTlsValue(g_NativeThreadKey, NATIVE_THREAD_NONE);
+            return 0;
+        }
+
+        thread = new NativeThread;
+        memset(thread, 0, sizeof(*thread));
+        dmSnPrintf(thread->m_Name, sizeof(thread->m_Name), "Thread%u", index);
+
+        g_NativeThreads[index] = thread;
+        dmAtomicStore32(&g_NativeThreadCount, (int32_t)index + 1);
+        dmThread::SetTlsValue(g_NativeThreadKey, thread);
+        return thread;
+    }
+
+    // The same hash as Remotery, so that the two can share the hash caches of the scopes
+    static inline uint32_t GetNativeNameHash(const char* name, uint64_t* name_hash)
+    {
+        uint32_t* hash_cache = (uint32_t*)name_hash;
+        if (hash_cache && *hash_cache)
+            return *hash_cache;
+
+        size_t name_len = strlen(name);
+        uint32_t hash = _rmt_HashString32(name, (int)(name_len < 256 ? name_len : 256), 0);
+        if (hash_cache)
+            *hash_cache = hash;
+        return hash;
+    }
+
+    static inline void RegisterNativeName(NativeThread* thread, uint32_t name_hash, const char* name)
+    {
+        uint32_t* cached = &thread->m_NameCache[name_hash & (NATIVE_NAME_CACHE_SIZE - 1)];
+        if (*cached == name_hash)
+            return;
+
+        // The name is copied, since dynamic names (e.g. from Lua) may not outlive the scope
+        DM_SPINLOCK_SCOPED_LOCK(g_NativeLock);
+        if (!g_NativeNames.Get(name_hash))
+        {
+            if (g_NativeNames.Full())
+                g_NativeNames.SetCapacity(g_NativeNames.Capacity()/2 + 128, g_NativeNames.Capacity() + 256);
+            g_NativeNames.Put(name_hash, strdup(name));
+        }
+        *cached = name_hash;
+    }
+
+    static const char* GetNativeName(uint32_t name_hash)
+    {
+        DM_SPINLOCK_SCOPED_LOCK(g_NativeLock);
+        char** name = g_NativeNames.Get(name_hash);
+        return name ? *name : "<unknown>";
+    }
+
+    // Checks that there's room for count more events, on top of the end events of the open scopes
+    static inline bool HasNativeEventSpace(NativeThread* thread, uint32_t count)
+    {
+        uint32_t needed = thread->m_Depth + count;
+        uint32_t write = thread->m_Written;
+        if (NATIVE_EVENT_COUNT - (write - thread->m_ReadIndexCache) >= needed)
+            return true;
+        thread->m_ReadIndexCache = (uint32_t)dmAtomicGet32(&thread->m_ReadIndex);
+        return NATIVE_EVENT_COUNT - (write - thread->m_ReadIndexCache) >= needed;
+    }
+
+    static inline void PushNativeEvent(NativeThread* thread, NativeEventType type, uint32_t name_hash, uint64_t value)
+    {
+        uint32_t write = thread->m_Written++;
+        NativeEvent* event = &thread->m_Events[write & (NATIVE_EVENT_COUNT - 1)];
+        event->m_Value = value;
+        event->m_NameHash = name_hash;
+        event->m_Type = (uint32_t)type;
+    }
+
+    // The events are published in batches, to keep the atomic operations (and their barriers) out of most scopes
+    static inline void PublishNativeEvents(NativeThread* thread)
+    {
+        uint32_t published = (uint32_t)thread->m_WriteIndex;
+        if (thread->m_Depth == 0 || thread->m_Written - published >= NATIVE_PUBLISH_INTERVAL)
+            dmAtomicAdd32(&thread->m_WriteIndex, (int32_t)(thread->m_Written - published));
+    }
+
+    static void NativeScopeBegin(const char* name, uint64_t* name_hash)
+    {
+        NativeThread* thread = GetNativeThread();
+        if (!thread)
+            return;
+
+        if (thread->m_SkipDepth != 0 || !HasNativeEventSpace(thread, 2))
+        {
+            thread->m_SkipDepth++;
+            return;
+        }
+
+        uint32_t hash = GetNativeNameHash(name, name_hash);
+        RegisterNativeName(thread, hash, name);
+        PushNativeEvent(thread, NATIVE_EVENT_SCOPE_BEGIN, hash, GetNativeTicks());
+        thread->m_Depth++;
+        PublishNativeEvents(thread);
+    }
+
+    static void NativeScopeEnd()
+    {
+        NativeThread* thread = GetNativeThread();
+        if (!thread)
+            return;
+
+        if (thread->m_SkipDepth != 0)
+        {
+            thread->m_SkipDepth--;
+            return;
+        }
+
+        if (thread->m_Depth == 0) // Unbalanced
+            return;
+
+        // Always fits, as the begin event made room for it
+        PushNativeEvent(thread, NATIVE_EVENT_SCOPE_END, 0, GetNativeTicks());
+        thread->m_Depth--;
+        PublishNativeEvents(thread);
+    }
+
+    static void NativeAddCounter(const char* name, uint32_t amount)
+    {
+        NativeThread* thread = GetNativeThread();
+        // The counters are added to the current scope, and dropped along with it
+        if (!thread || thread->m_Depth == 0 || thread->m_SkipDepth != 0 || !HasNativeEventSpace(thread, 1))
+            return;
+
+        uint32_t hash = GetNativeNameHash(name, 0);
+        RegisterNativeName(thread, hash, name);
+        PushNativeEvent(thread, NATIVE_EVENT_COUNTER, hash, amount);
+        PublishNativeEvents(thread);
+    }
+
+    // Gets the child sample with the given name, which aggregates all the calls within the parent
+    static NativeSample* GetNativeSample(NativeThread* thread, NativeSample* parent, uint32_t name_hash, uint64_t time)
+    {
+        if (parent)
+        {
+            for (NativeSample* child = parent->m_FirstChild; child; child = child->m_Sibling)
+            {
+                if (child->m_NameHash == name_hash)
+                    return child;
+            }
+        }
+
+        if (thread->m_SampleCount == NATIVE_MAX_SAMPLES)
+            return 0;
+
+        NativeSample* sample = &thread->m_Samples[thread->m_SampleCount++];
+        memset(sample, 0, sizeof(*sample));
+        sample->m_Name = GetNativeName(name_hash);
+        sample->m_NameHash = name_hash;
+        sample->m_Start = time;
+        sample->m_Parent = parent;
+
+        if (parent)
+        {
+            if (parent->m_LastChild)
+                parent->m_LastChild->m_Sibling = sample;
+            else
+                parent->m_FirstChild = sample;
+            parent->m_LastChild = sample;
+        }
+        return sample;
+    }
+
+    static void MergeNativeEvent(NativeThread* thread, const NativeEvent& event)
+    {
+        switch (event.m_Type)
+        {
+        case NATIVE_EVENT_SCOPE_BEGIN:
+            {
+                if (thread->m_DroppedDepth != 0)
+                {
+                    thread->m_DroppedDepth++;
+                    break;
+                }
+
+                // A new root sample starts a new tree
+                if (thread->m_Current == 0)
+                    thread->m_SampleCount = 0;
+
+                uint64_t time = NativeTicksToTime(event.m_Value);
+                NativeSample* sample = GetNativeSample(thread, thread->m_Current, event.m_NameHash, time);
+                if (!sample)
+                {
+                    thread->m_DroppedDepth++;
+                    break;
+                }
+                sample->m_CallCount++;
+                sample->m_CallStart = time;
+                thread->m_Current = sample;
+            }
+            break;
+
+        case NATIVE_EVENT_SCOPE_END:
+            {
+                if (thread->m_DroppedDepth != 0)
+                {
+                    thread->m_DroppedDepth--;
+                    break;
+                }
+
+                NativeSample* sample = thread->m_Current;
+                if (!sample)
+                    break;
+                uint64_t end = NativeTicksToTime(event.m_Value);
+                uint64_t time = end > sample->m_CallStart ? end - sample->m_CallStart : 0;
+                sample->m_Time += time;
+                if (sample->m_Parent)
+                    sample->m_Parent->m_ChildTime += time;
+                thread->m_Current = sample->m_Parent;
+
+                if (thread->m_Current == 0 && IsInitialized())
+                {
+                    DM_SPINLOCK_SCOPED_LOCK(g_ProfilerLock);
+                    if (g_SampleTreeCallback)
+                        g_SampleTreeCallback(g_SampleTreeCallbackCtx, thread->m_Name, (HSample)sample);
+                }
+            }
+            break;
+
+        case NATIVE_EVENT_COUNTER:
+            {
+                NativeSample* parent = thread->m_Current;
+                if (thread->m_DroppedDepth != 0 || !parent)
+                    break;
+
+                NativeSample* sample = GetNativeSample(thread, parent, event.m_NameHash, parent->m_CallStart);
+                if (sample)
+                    sample->m_CallCount += (uint32_t)event.m_Value;
+            }
+            break;
+        }
+    }
+
+    static void MergeNativeThread(NativeThread* thread)
+    {
+        uint32_t read = (uint32_t)thread->m_ReadIndex;
+        uint32_t write = (uint32_t)dmAtomicGet32(&thread->m_WriteIndex);
+        for (; read != write; ++read)
+        {
+            MergeNativeEvent(thread, thread->m_Events[read & (NATIVE_EVENT_COUNT - 1)]);
+        }
+        // A full barrier, so that the events are read before the thread may overwrite them
+        dmAtomicAdd32(&thread->m_ReadIndex, (int32_t)(read - (uint32_t)thread->m_ReadIndex));
+    }
+
+    static void NativeMergeThread(void*)
+    {
+        while (dmAtomicGet32(&g_NativeMergeActive))
+        {
+            // Sleeps first, so that the ticks are calibrated over at least one interval
+            dmTime::Sleep(NATIVE_MERGE_INTERVAL);
+            CalibrateNativeTicks();
+
+            uint32_t count = (uint32_t)dmAtomicGet32(&g_NativeThreadCount);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                MergeNativeThread(g_NativeThreads[i]);
+            }
+        }
+    }
+
+    static void FreeNativeName(void*, const uint32_t* key, char** name)
+    {
+        free(*name);
+    }
+
+    static void InitializeNativeSamples()
+    {
+        g_NativeThreadKey = dmThread::AllocTls();
+        dmSpinlock::Create(&g_NativeLock);
+        if (g_NativeNames.Capacity() == 0)
+            g_NativeNames.SetCapacity(256, 512);
+        dmAtomicStore32(&g_NativeThreadCount, 0);
+
+        g_NativeTicksStart = GetNativeTicks();
+        g_NativeTimeStart = dmTime::GetTime();
+    }
+
+    static void FinalizeNativeSamples()
+    {
+        uint32_t count = (uint32_t)dmAtomicGet32(&g_NativeThreadCount);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            delete g_NativeThreads[i];
+            g_NativeThreads[i] = 0;
+        }
+        dmAtomicStore32(&g_NativeThreadCount, 0);
+
+        g_NativeNames.Iterate(FreeNativeName, (void*)0);
+        g_NativeNames.Clear();
+
+        dmSpinlock::Destroy(&g_NativeLock);
+        dmThread::FreeTls(g_NativeThreadKey);
+    }
+
     void Initialize(const Options* options)
     {
         if (!dLib::IsDebugMode())
@@ -121,9 +553,23 @@ namespace dmProfile
 
         rmt_SetCurrentThreadName("Main");
 
+        if (options && options->m_NativeSamples)
+        {
+            InitializeNativeSamples();
+            g_NativeSamples = true;
+        }
+
         dmSpinlock::Create(&g_ProfilerLock);
         dmAtomicStore32(&g_ProfilerInitialized, 1);
 
+        if (g_NativeSamples)
+        {
+            SetThreadName("Main");
+
+            dmAtomicStore32(&g_NativeMergeActive, 1);
+            g_NativeMergeThread = dmThread::New(NativeMergeThread, 0x80000, 0, "profile_merge");
+        }
+
         dmLogInfo("Initialized Remotery (ws://127.0.0.1:%d/rmt)", settings->port);
     }
 
@@ -140,6 +586,13 @@ namespace dmProfile
 
     void Finalize()
     {
+        // The merge thread delivers the sample trees under the lock below
+        if (dmAtomicGet32(&g_NativeMergeActive))
+        {
+            dmAtomicStore32(&g_NativeMergeActive, 0);
+            dmThread::Join(g_NativeMergeThread);
+        }
+
         {
             DM_SPINLOCK_SCOPED_LOCK(g_ProfilerLock);
             dmAtomicStore32(&g_ProfilerInitialized, 0);
@@ -155,6 +608,12 @@ namespace dmProfile
         }
 
         dmSpinlock::Destroy(&g_ProfilerLock);
+
+        if (g_NativeSamples)
+        {
+            g_NativeSamples = false;
+            FinalizeNativeSamples();
+        }
     }
 
     HProfile BeginFrame()
@@ -173,6 +632,13 @@ namespace dmProfile
             return;
         DM_SPINLOCK_SCOPED_LOCK(g_ProfilerLock);
         rmt_SetCurrentThreadName(name);
+
+        if (g_NativeSamples)
+        {
+            NativeThread* thread = GetNativeThread();
+            if (thread)
+                dmStrlCpy(thread->m_Name, name, sizeof(thread->m_Name));
+        }
     }
 
     void EndFrame(HProfile profile)
@@ -191,8 +657,11 @@ namespace dmProfile
 
     void AddCounter(const char* name, uint32_t amount)
     {
-        // Not supported currently.
+        // Only supported with the native samples, where it's added as a child sample to the current scope
         // Used by mem profiler to dynamically insert a property at runtime
+        if (!IsInitialized() || !g_NativeSamples)
+            return;
+        NativeAddCounter(name, amount);
     }
 
     uint64_t GetTicksPerSecond()
@@ -254,7 +723,8 @@ namespace dmProfile
 
     void ProfileScope::StartScope(const char* name, uint64_t* name_hash)
     {
-        if (!IsInitialized()) {
+        // The native samples are only on while initialized, and saves the atomic check
+        if (!g_NativeSamples && !IsInitialized()) {
             return;
         }
         if (name != 0)
@@ -262,7 +732,10 @@ namespace dmProfile
             valid = 1;
             if (name[0] == 0)
                 name = "<empty>";
-            _rmt_BeginCPUSample(name, RMTSF_Aggregate, (uint32_t*)name_hash);
+            if (g_NativeSamples)
+                NativeScopeBegin(name, name_hash);
+            else
+                _rmt_BeginCPUSample(name, RMTSF_Aggregate, (uint32_t*)name_hash);
         }
     }
 
@@ -270,24 +743,34 @@ namespace dmProfile
     {
         if (valid)
         {
-            rmt_EndCPUSample();
+            // The native samples are turned off by the finalization
+            if (g_NativeSamples)
+                NativeScopeEnd();
+            else
+                rmt_EndCPUSample();
         }
     }
 
     void ScopeBegin(const char* name, uint64_t* name_hash)
     {
-        if (!IsInitialized()) {
+        if (!g_NativeSamples && !IsInitialized()) {
             return;
         }
-        _rmt_BeginCPUSample(name, RMTSF_Aggregate, (uint32_t*)name_hash);
+        if (g_NativeSamples)
+            NativeScopeBegin(name[0] ? name : "<empty>", name_hash);
+        else
+            _rmt_BeginCPUSample(name, RMTSF_Aggregate, (uint32_t*)name_hash);
     }
 
     void ScopeEnd()
     {
-        if (!IsInitialized()) {
+        if (!g_NativeSamples && !IsInitialized()) {
             return;
         }
-        rmt_EndCPUSample();
+        if (g_NativeSamples)
+            NativeScopeEnd();
+        else
+            rmt_EndCPUSample();
     }
 
     // *******************************************************************
@@ -300,13 +783,21 @@ namespace dmProfile
 
     SampleIterator::~SampleIterator()
     {
-        delete (rmtSampleIterator*)m_IteratorImpl;
+        // With the native samples, the implementation is the parent sample
+        if (!g_NativeSamples)
+            delete (rmtSampleIterator*)m_IteratorImpl;
     }
 
     SampleIterator* SampleIterateChildren(HSample sample, SampleIterator* iter)
     {
         iter->m_Sample = 0;
 
+        if (g_NativeSamples)
+        {
+            iter->m_IteratorImpl = sample;
+            return iter;
+        }
+
         rmtSampleIterator* rmt_iter = new rmtSampleIterator;
         rmt_IterateChildren(rmt_iter, SampleFromHandle(sample));
 
@@ -316,6 +807,14 @@ namespace dmProfile
 
     bool SampleIterateNext(SampleIterator* iter)
     {
+        if (g_NativeSamples)
+        {
+            NativeSample* prev = (NativeSample*)iter->m_Sample;
+            NativeSample* next = prev ? prev->m_Sibling : ((NativeSample*)iter->m_IteratorImpl)->m_FirstChild;
+            iter->m_Sample = (HSample)next;
+            return next != 0;
+        }
+
         rmtSampleIterator* rmt_iter = (rmtSampleIterator*)iter->m_IteratorImpl;
         bool result = rmt_IterateNext(rmt_iter);
         iter->m_Sample = SampleToHandle(rmt_iter->sample);
@@ -324,36 +823,57 @@ namespace dmProfile
 
     uint32_t SampleGetNameHash(HSample sample)
     {
+        if (g_NativeSamples)
+            return ((NativeSample*)sample)->m_NameHash;
         return (uint32_t)rmt_SampleGetNameHash(SampleFromHandle(sample));
     }
 
     const char* SampleGetName(HSample sample)
     {
+        if (g_NativeSamples)
+            return ((NativeSample*)sample)->m_Name;
         return rmt_SampleGetName(SampleFromHandle(sample));
     }
 
     uint64_t SampleGetStart(HSample sample)
     {
+        if (g_NativeSamples)
+            return ((NativeSample*)sample)->m_Start;
         return rmt_SampleGetStart(SampleFromHandle(sample));
     }
 
     uint64_t SampleGetTime(HSample sample)
     {
+        if (g_NativeSamples)
+            return ((NativeSample*)sample)->m_Time;
         return rmt_SampleGetTime(SampleFromHandle(sample));
     }
 
     uint64_t SampleGetSelfTime(HSample sample)
     {
+        if (g_NativeSamples)
+        {
+            NativeSample* native = (NativeSample*)sample;
+            return native->m_Time > native->m_ChildTime ? native->m_Time - native->m_ChildTime : 0;
+        }
         return rmt_SampleGetSelfTime(SampleFromHandle(sample));
     }
 
     uint32_t SampleGetCallCount(HSample sample)
     {
+        if (g_NativeSamples)
+            return ((NativeSample*)sample)->m_CallCount;
         return rmt_SampleGetCallCount(SampleFromHandle(sample));
     }
 
     uint32_t SampleGetColor(HSample sample)
     {
+        if (g_NativeSamples)
+        {
+            uint32_t hash = ((NativeSample*)sample)->m_NameHash;
+            return (127 + ((hash & 255) >> 1)) << 16 | (127 + (((hash >> 8) & 255) >> 1)) << 8 | (127 + (((hash >> 16) & 255) >> 1));
+        }
+
         uint8_t r, g, b;
         rmt_SampleGetColour(SampleFromHandle(sample), &r, &g, &b);
         return r << 16 | g << 8 | b;
@@ -137,6 +137,38 @@ namespace dmSocket
     Result ReceiveFrom(Socket socket, void* buffer, int length, int* received_bytes,
                        Address* from_addr, uint16_t* from_port);
 
+    /**
+     * A datagram for SendToBatch and ReceiveFromBatch
+     */
+    struct Datagram
+    {
+        void*    m_Data;
+        uint32_t m_Size;    //!< The size of the data. For ReceiveFromBatch, the size of the buffer in, and the received size out
+        Address  m_Address;
+        uint16_t m_Port;
+    };
+
+    /**
+     * Send several datagrams, with as few system calls as possible (sendmmsg on Linux and Android)
+     * @param socket Socket to send the datagrams on
+     * @param datagrams The datagrams
+     * @param count Number of datagrams
+     * @param sent Number of datagrams sent (result). The datagrams are sent in order
+     * @return RESULT_OK if any datagram was sent. Otherwise the error of the first datagram
+     */
+    Result SendToBatch(Socket socket, const Datagram* datagrams, uint32_t count, uint32_t* sent);
+
+    /**
+     * Receive several datagrams, with as few system calls as possible (recvmmsg on Linux and Android).
+     * Waits for the first datagram like ReceiveFrom, and then returns the ones that are already available.
+     * @param socket Socket to receive the datagrams on
+     * @param datagrams The datagrams. The data and size of each datagram is the buffer to receive it to
+     * @param count Number of datagrams
+     * @param received Number of datagrams received (result)
+     * @return RESULT_OK if any datagram was received
+     */
+    Result ReceiveFromBatch(Socket socket, Datagram* datagrams, uint32_t count, uint32_t* received);
+
 
     /**
      * Get name, address and port for socket
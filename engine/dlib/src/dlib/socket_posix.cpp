@@ -587,6 +587,186 @@ namespace dmSocket
         return result >= 0 ? RESULT_OK : NativeToResultCompat(DM_SOCKET_ERRNO);
     }
 
+#if defined(__linux__)
+    // Batch size of sendmmsg and recvmmsg
+    static const uint32_t MAX_BATCH_SIZE = 32;
+
+    union SockAddr
+    {
+        struct sockaddr_in  m_IPv4;
+        struct sockaddr_in6 m_IPv6;
+    };
+
+    static socklen_t ToSockAddr(bool ipv4, Address address, uint16_t port, SockAddr* sock_addr)
+    {
+        memset(sock_addr, 0, sizeof(*sock_addr));
+        if (ipv4)
+        {
+            sock_addr->m_IPv4.sin_family = AF_INET;
+            sock_addr->m_IPv4.sin_addr.s_addr = *IPv4(&address);
+            sock_addr->m_IPv4.sin_port = htons(port);
+            return sizeof(sock_addr->m_IPv4);
+        }
+        sock_addr->m_IPv6.sin6_family = AF_INET6;
+        memcpy(&sock_addr->m_IPv6.sin6_addr, IPv6(&address), sizeof(struct in6_addr));
+        sock_addr->m_IPv6.sin6_port = htons(port);
+        return sizeof(sock_addr->m_IPv6);
+    }
+
+    static void FromSockAddr(bool ipv4, const SockAddr* sock_addr, Address* address, uint16_t* port)
+    {
+        if (ipv4)
+        {
+            address->m_family = DOMAIN_IPV4;
+            *IPv4(address) = sock_addr->m_IPv4.sin_addr.s_addr;
+            *port = ntohs(sock_addr->m_IPv4.sin_port);
+        }
+        else
+        {
+            address->m_family = DOMAIN_IPV6;
+            memcpy(IPv6(address), &sock_addr->m_IPv6.sin6_addr, sizeof(struct in6_addr));
+            *port = ntohs(sock_addr->m_IPv6.sin6_port);
+        }
+    }
+
+    Result SendToBatch(Socket socket, const Datagram* datagrams, uint32_t count, uint32_t* sent)
+    {
+        *sent = 0;
+        bool ipv4 = IsSocketIPv4(socket);
+        if (!ipv4 && !IsSocketIPv6(socket))
+        {
+            dmLogError("Failed to send to remote host, unsupported address family!");
+            return RESULT_AFNOSUPPORT;
+        }
+
+        struct mmsghdr messages[MAX_BATCH_SIZE];
+        struct iovec iov[MAX_BATCH_SIZE];
+        SockAddr addresses[MAX_BATCH_SIZE];
+        while (*sent < count)
+        {
+            uint32_t n = count - *sent < MAX_BATCH_SIZE ? count - *sent : MAX_BATCH_SIZE;
+            memset(messages, 0, sizeof(messages[0]) * n);
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                const Datagram& datagram = datagrams[*sent + i];
+                assert(datagram.m_Address.m_family == (ipv4 ? DOMAIN_IPV4 : DOMAIN_IPV6));
+                iov[i].iov_base = datagram.m_Data;
+                iov[i].iov_len = datagram.m_Size;
+                messages[i].msg_hdr.msg_name = &addresses[i];
+                messages[i].msg_hdr.msg_namelen = ToSockAddr(ipv4, datagram.m_Address, datagram.m_Port, &addresses[i]);
+                messages[i].msg_hdr.msg_iov = &iov[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int r = sendmmsg(socket, messages, n, MSG_NOSIGNAL);
+            if (r < 0)
+            {
+                return *sent > 0 ? RESULT_OK : NativeToResultCompat(DM_SOCKET_ERRNO);
+            }
+            *sent += (uint32_t) r;
+            if ((uint32_t) r < n)
+            {
+                break;
+            }
+        }
+        return RESULT_OK;
+    }
+
+    Result ReceiveFromBatch(Socket socket, Datagram* datagrams, uint32_t count, uint32_t* received)
+    {
+        *received = 0;
+        bool ipv4 = IsSocketIPv4(socket);
+        if (!ipv4 && !IsSocketIPv6(socket))
+        {
+            dmLogError("Failed to receive from remote host, unsupported address family!");
+            return RESULT_AFNOSUPPORT;
+        }
+
+        struct mmsghdr messages[MAX_BATCH_SIZE];
+        struct iovec iov[MAX_BATCH_SIZE];
+        SockAddr addresses[MAX_BATCH_SIZE];
+        while (*received < count)
+        {
+            uint32_t n = count - *received < MAX_BATCH_SIZE ? count - *received : MAX_BATCH_SIZE;
+            memset(messages, 0, sizeof(messages[0]) * n);
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                Datagram& datagram = datagrams[*received + i];
+                iov[i].iov_base = datagram.m_Data;
+                iov[i].iov_len = datagram.m_Size;
+                messages[i].msg_hdr.msg_name = &addresses[i];
+                messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+                messages[i].msg_hdr.msg_iov = &iov[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            // Only the first batch may wait, as the following ones should only pick up what's already there
+            int flags = *received == 0 ? MSG_WAITFORONE : MSG_DONTWAIT;
+            int r = recvmmsg(socket, messages, n, flags, 0);
+            if (r < 0)
+            {
+                return *received > 0 ? RESULT_OK : NativeToResultCompat(DM_SOCKET_ERRNO);
+            }
+            for (int i = 0; i < r; ++i)
+            {
+                Datagram& datagram = datagrams[*received + i];
+                datagram.m_Size = messages[i].msg_len;
+                FromSockAddr(ipv4, &addresses[i], &datagram.m_Address, &datagram.m_Port);
+            }
+            *received += (uint32_t) r;
+            if ((uint32_t) r < n)
+            {
+                break;
+            }
+        }
+        return RESULT_OK;
+    }
+#else
+    Result SendToBatch(Socket socket, const Datagram* datagrams, uint32_t count, uint32_t* sent)
+    {
+        *sent = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            int sent_bytes = 0;
+            Result r = SendTo(socket, datagrams[i].m_Data, (int) datagrams[i].m_Size, &sent_bytes, datagrams[i].m_Address, datagrams[i].m_Port);
+            if (r != RESULT_OK)
+            {
+                return *sent > 0 ? RESULT_OK : r;
+            }
+            ++*sent;
+        }
+        return RESULT_OK;
+    }
+
+    Result ReceiveFromBatch(Socket socket, Datagram* datagrams, uint32_t count, uint32_t* received)
+    {
+        *received = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            // Only the first datagram may wait
+            if (i > 0)
+            {
+                Selector selector;
+                SelectorSet(&selector, SELECTOR_KIND_READ, socket);
+                if (Select(&selector, 0) != RESULT_OK || !SelectorIsSet(&selector, SELECTOR_KIND_READ, socket))
+                {
+                    break;
+                }
+            }
+
+            int received_bytes = 0;
+            Result r = ReceiveFrom(socket, datagrams[i].m_Data, (int) datagrams[i].m_Size, &received_bytes, &datagrams[i].m_Address, &datagrams[i].m_Port);
+            if (r != RESULT_OK)
+            {
+                return *received > 0 ? RESULT_OK : r;
+            }
+            datagrams[i].m_Size = (uint32_t) received_bytes;
+            ++*received;
+        }
+        return RESULT_OK;
+    }
+#endif
+
     Result GetName(Socket socket, Address* address, uint16_t* port)
     {
         int result = -1;
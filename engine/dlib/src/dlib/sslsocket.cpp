@@ -13,8 +13,11 @@
 // specific language governing permissions and limitations under the License.
 
 #include "sslsocket.h"
+#include "array.h"
+#include "hash.h"
 #include "log.h"
 #include "math.h"
+#include "mutex.h"
 #include "time.h"
 
 #include <errno.h>
@@ -69,11 +72,29 @@ struct SSLSocket
     uint64_t                    m_TimeStart;  // for read timeouts
     uint64_t                    m_TimeLimit1;
     uint64_t                    m_TimeLimit2;
+    bool                        m_SessionOffered;
 };
 
+// A session that may be resumed, with a session ticket or the session id
+struct CachedSession
+{
+    uint64_t                    m_Key;
+    uint64_t                    m_Expires;
+    mbedtls_ssl_session         m_Session;
+};
+
+// Max number of hosts with a cached session
+static const uint32_t MAX_CACHED_SESSIONS = 32;
+// Max time a session is resumed, unless the ticket lifetime is shorter.
+// A server that has forgotten the session simply does a full handshake.
+static const uint64_t MAX_SESSION_LIFETIME = 2 * 60 * 60 * 1000000ULL;
+
 struct SSLSocketContext
 {
     mbedtls_x509_crt*           m_x509CertChain;
+    // The cached sessions are shared by all sockets, and hence by the connection pools
+    dmMutex::HMutex             m_SessionMutex;
+    dmArray<CachedSession*>     m_Sessions;
 } g_SSLSocketContext;
 
 #define MBEDTLS_RESULT_TO_STRING_CASE(x) case x: return #x;
@@ -152,9 +173,142 @@ static dmSocket::Result SSLToSocket(int r) {
     }
 }
 
+static void FreeSession(CachedSession* session)
+{
+    mbedtls_ssl_session_free(&session->m_Session);
+    free(session);
+}
+
+static uint64_t SessionKey(const char* host)
+{
+    return dmHashString64(host);
+}
+
+static bool LoadSession(uint64_t key, mbedtls_ssl_context* ssl)
+{
+    if (!g_SSLSocketContext.m_SessionMutex)
+    {
+        return false;
+    }
+
+    DM_MUTEX_SCOPED_LOCK(g_SSLSocketContext.m_SessionMutex);
+    dmArray<CachedSession*>& sessions = g_SSLSocketContext.m_Sessions;
+    for (uint32_t i = 0; i < sessions.Size(); ++i)
+    {
+        CachedSession* session = sessions[i];
+        if (session->m_Key != key)
+            continue;
+
+        if (session->m_Expires <= dmTime::GetTime())
+        {
+            FreeSession(session);
+            sessions.EraseSwap(i);
+            return false;
+        }
+        // The session is copied into the context
+        return mbedtls_ssl_set_session(ssl, &session->m_Session) == 0;
+    }
+    return false;
+}
+
+static void StoreSession(uint64_t key, mbedtls_ssl_context* ssl)
+{
+    if (!g_SSLSocketContext.m_SessionMutex)
+    {
+        return;
+    }
+
+    CachedSession* session = (CachedSession*) malloc(sizeof(CachedSession));
+    session->m_Key = key;
+    mbedtls_ssl_session_init(&session->m_Session);
+    if (mbedtls_ssl_get_session(ssl, &session->m_Session) != 0)
+    {
+        FreeSession(session);
+        return;
+    }
+
+    uint64_t lifetime = MAX_SESSION_LIFETIME;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
+    if (session->m_Session.ticket != 0 && session->m_Session.ticket_lifetime != 0)
+    {
+        lifetime = dmMath::Min(lifetime, (uint64_t) session->m_Session.ticket_lifetime * 1000000U);
+    }
+#endif
+    uint64_t now = dmTime::GetTime();
+    session->m_Expires = now + lifetime;
+
+    DM_MUTEX_SCOPED_LOCK(g_SSLSocketContext.m_SessionMutex);
+    dmArray<CachedSession*>& sessions = g_SSLSocketContext.m_Sessions;
+    // Replace the session of the host, or the one that expires first if the cache is full
+    uint32_t replace = sessions.Size();
+    for (uint32_t i = 0; i < sessions.Size(); ++i)
+    {
+        if (sessions[i]->m_Key == key)
+        {
+            replace = i;
+            break;
+        }
+        if (sessions.Full() && (replace == sessions.Size() || sessions[i]->m_Expires < sessions[replace]->m_Expires))
+        {
+            replace = i;
+        }
+    }
+
+    if (replace < sessions.Size())
+    {
+        FreeSession(sessions[replace]);
+        sessions[replace] = session;
+    }
+    else
+    {
+        sessions.Push(session);
+    }
+}
+
+static void RemoveSession(uint64_t key)
+{
+    if (!g_SSLSocketContext.m_SessionMutex)
+    {
+        return;
+    }
+
+    DM_MUTEX_SCOPED_LOCK(g_SSLSocketContext.m_SessionMutex);
+    dmArray<CachedSession*>& sessions = g_SSLSocketContext.m_Sessions;
+    for (uint32_t i = 0; i < sessions.Size(); ++i)
+    {
+        if (sessions[i]->m_Key == key)
+        {
+            FreeSession(sessions[i]);
+            sessions.EraseSwap(i);
+            return;
+        }
+    }
+}
+
+void ClearSessionCache()
+{
+    if (!g_SSLSocketContext.m_SessionMutex)
+    {
+        return;
+    }
+
+    DM_MUTEX_SCOPED_LOCK(g_SSLSocketContext.m_SessionMutex);
+    dmArray<CachedSession*>& sessions = g_SSLSocketContext.m_Sessions;
+    for (uint32_t i = 0; i < sessions.Size(); ++i)
+    {
+        FreeSession(sessions[i]);
+    }
+    sessions.SetSize(0);
+}
+
 Result Initialize()
 {
     g_SSLSocketContext.m_x509CertChain = 0;
+    if (!g_SSLSocketContext.m_SessionMutex)
+    {
+        g_SSLSocketContext.m_SessionMutex = dmMutex::New();
+        g_SSLSocketContext.m_Sessions.SetCapacity(MAX_CACHED_SESSIONS);
+    }
     return RESULT_OK;
 }
 
@@ -166,6 +320,13 @@ Result Finalize()
         free((void*)g_SSLSocketContext.m_x509CertChain);
     }
     g_SSLSocketContext.m_x509CertChain = 0;
+
+    if (g_SSLSocketContext.m_SessionMutex)
+    {
+        ClearSessionCache();
+        dmMutex::Delete(g_SSLSocketContext.m_SessionMutex);
+        g_SSLSocketContext.m_SessionMutex = 0;
+    }
     return RESULT_OK;
 }
 
@@ -262,6 +423,11 @@ static int RecvTimeout( void* _ctx, unsigned char *buf, size_t len, uint32_t tim
 }
 
 Result New(dmSocket::Socket socket, const char* host, uint64_t timeout, SSLSocket** sslsocket)
+{
+    return New(socket, host, timeout, 0, sslsocket);
+}
+
+Result New(dmSocket::Socket socket, const char* host, uint64_t timeout, const char** alpn_protocols, SSLSocket** sslsocket)
 {
     uint64_t handshakestart = dmTime::GetTime();
 
@@ -307,8 +473,21 @@ Result New(dmSocket::Socket socket, const char* host, uint64_t timeout, SSLSocke
     }
 
     mbedtls_ssl_conf_rng( c->m_MbedConf, mbedtls_ctr_drbg_random, c->m_MbedCtrDrbg );
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    // Ask for session tickets, as they allow resuming sessions with servers that don't keep a session cache
+    mbedtls_ssl_conf_session_tickets( c->m_MbedConf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED );
+#endif
     mbedtls_ssl_conf_authmode( c->m_MbedConf, MBEDTLS_SSL_VERIFY_NONE );
 
+    if (alpn_protocols)
+    {
+        if( ( ret = mbedtls_ssl_conf_alpn_protocols( c->m_MbedConf, alpn_protocols ) ) != 0 )
+        {
+            SSL_LOGE("mbedtls_ssl_conf_alpn_protocols failed", ret);
+            return RESULT_SSL_INIT_FAILED;
+        }
+    }
+
     // In order to not have it block (unless timeout == 0)
     dmSocket::SetSendTimeout(socket, (int)timeout);
     dmSocket::SetReceiveTimeout(socket, (int)timeout);
@@ -353,6 +532,10 @@ Result New(dmSocket::Socket socket, const char* host, uint64_t timeout, SSLSocke
     mbedtls_ssl_set_bio(c->m_SSLContext, c->m_SSLNetContext, mbedtls_net_send, NULL, RecvTimeout);
     mbedtls_ssl_set_timer_cb(c->m_SSLContext, c, TimingSetDelay, TimingGetDelay);
 
+    // Offer the previous session with the host, to skip the key exchange and certificate verification
+    uint64_t session_key = SessionKey(host);
+    c->m_SessionOffered = LoadSession(session_key, c->m_SSLContext);
+
     do
     {
         ret = mbedtls_ssl_handshake( c->m_SSLContext );
@@ -367,6 +550,12 @@ Result New(dmSocket::Socket socket, const char* host, uint64_t timeout, SSLSocke
 
     if (ret != 0)
     {
+        // Don't offer the session again, in case it's the reason the handshake failed
+        if (c->m_SessionOffered)
+        {
+            RemoveSession(session_key);
+        }
+
         char buffer[512] = "";
         mbedtls_strerror(ret, buffer, sizeof(buffer));
         dmLogError("SSLSocket mbedtls_ssl_handshake: %d - %s",ret, buffer);
@@ -392,6 +581,9 @@ Result New(dmSocket::Socket socket, const char* host, uint64_t timeout, SSLSocke
         return RESULT_HANDSHAKE_FAILED;
     }
 
+    // Store the session (including a new session ticket, if the server sent one) for the next connection to the host
+    StoreSession(session_key, c->m_SSLContext);
+
     *sslsocket = c;
     return RESULT_OK;
 }
@@ -469,6 +661,11 @@ dmSocket::Result SetReceiveTimeout(Socket socket, uint64_t timeout)
     return dmSocket::RESULT_OK;
 }
 
+const char* GetALPNProtocol(Socket socket)
+{
+    return mbedtls_ssl_get_alpn_protocol(socket->m_SSLContext);
+}
+
 #undef SSL_LOGW
 #undef SSL_LOGE
 
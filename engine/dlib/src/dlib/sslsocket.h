@@ -46,6 +46,29 @@ namespace dmSSLSocket
      * @return RESULT_OK on success
      */
     Result SetSslPublicKeys(const uint8_t* key, uint32_t keylen);
+
+    /**
+     * Create a new secure socket, and offer the given protocols to the server with ALPN
+     * @name dmSSLSocket::New
+     * @param alpn_protocols null terminated list of protocol ids, in order of preference (e.g. "h2", "http/1.1").
+     *                       The list must outlive the socket.
+     * @return RESULT_OK on success
+     */
+    Result New(dmSocket::Socket socket, const char* host, uint64_t timeout, const char** alpn_protocols, Socket* sslsocket);
+
+    /**
+     * Get the protocol selected by the server with ALPN
+     * @name dmSSLSocket::GetALPNProtocol
+     * @return the protocol id, or 0 if the server didn't select any
+     */
+    const char* GetALPNProtocol(Socket socket);
+
+    /**
+     * Forget the cached TLS sessions. New sockets cache the session of the handshake by host name, and offer
+     * it to the server on the next connection to the same host, so that it may be resumed without a full handshake.
+     * @name dmSSLSocket::ClearSessionCache
+     */
+    void ClearSessionCache();
 }
 
 #endif // DM_SSLSOCKET_H
\ No newline at end of file
@@ -17,7 +17,8 @@
 
 #include <dmsdk/dlib/thread.h>
 
-#if !defined(__EMSCRIPTEN__)
+// Web builds only have threads when built with pthreads (SharedArrayBuffer), which requires a cross origin isolated host
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
     #define DM_HAS_THREADS
 #endif
 
@@ -42,6 +43,13 @@ namespace dmThread
         return false;
     #endif
     }
+
+    /*# get the system id of the calling thread
+     * The id the OS scheduler knows the thread by, e.g. the tid on Linux and Android
+     * @name dmThread::GetCurrentThreadSystemId
+     * @return the id, or 0 if the platform doesn't have one
+     */
+    int32_t GetCurrentThreadSystemId();
 }
 
 #endif // DM_THREAD_H
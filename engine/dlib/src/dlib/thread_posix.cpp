@@ -17,11 +17,21 @@
 #include <stdlib.h>
 #include <dlib/profile/profile.h>
 #include <dmsdk/dlib/thread.h>
+#include <dlib/thread.h>
 
 #if defined(_WIN32)
 #include <wchar.h>
 #endif
 
+#if defined(__linux__) || defined(ANDROID)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__EMSCRIPTEN_PTHREADS__)
+#include <emscripten/threading.h>
+#endif
+
 namespace dmThread
 {
     struct ThreadData
@@ -124,12 +134,23 @@ namespace dmThread
         return pthread_self();
     }
 
+    int32_t GetCurrentThreadSystemId()
+    {
+#if defined(__linux__) || defined(ANDROID)
+        return (int32_t) syscall(SYS_gettid);
+#else
+        return 0;
+#endif
+    }
+
 #if !defined(DM_DLIB_THREAD_USE_CUSTOM_SETNAME)
     void SetThreadName(Thread thread, const char* name)
     {
 #if defined(__MACH__)
         (void)thread;
         pthread_setname_np(name);
+#elif defined(__EMSCRIPTEN_PTHREADS__)
+        emscripten_set_thread_name(thread, name);
 #elif defined(__EMSCRIPTEN__)
 #else
         pthread_setname_np(thread, name);
@@ -15,6 +15,7 @@
 #include <assert.h>
 #include <dlib/profile/profile.h>
 #include <dmsdk/dlib/thread.h>
+#include <dlib/thread.h>
 
 #include <stdlib.h>
 #include <wchar.h>
@@ -97,4 +98,9 @@ namespace dmThread
     {
         return ::GetCurrentThread();
     }
+
+    int32_t GetCurrentThreadSystemId()
+    {
+        return (int32_t) ::GetCurrentThreadId();
+    }
 }
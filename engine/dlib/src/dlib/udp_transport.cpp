@@ -0,0 +1,358 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "udp_transport.h"
+#include "atomic.h"
+#include "log.h"
+#include "math.h"
+#include "thread.h"
+
+namespace dmUdpTransport
+{
+    // Max number of packets per system call
+    const uint32_t BATCH_SIZE = 32;
+    const uint32_t THREAD_STACK_SIZE = 0x10000;
+    const uint32_t SLOT_ALIGNMENT = 16;
+
+    struct SlotHeader
+    {
+        dmSocket::Address m_Address;
+        uint32_t          m_Size;
+        uint16_t          m_Port;
+    };
+
+    const uint32_t SLOT_DATA_OFFSET = (sizeof(SlotHeader) + SLOT_ALIGNMENT - 1) & ~(SLOT_ALIGNMENT - 1);
+
+    /*
+     * Single producer/single consumer ring of fixed size slots. Head and tail are counters that wrap
+     * around, and only the producer writes the head, and only the consumer writes the tail.
+     * They are advanced with dmAtomicAdd32, as it's a full barrier, whereas dmAtomicStore32 is only
+     * an acquire barrier on some platforms.
+     */
+    struct Ring
+    {
+        uint8_t*       m_Slots;
+        uint32_t       m_SlotSize;
+        uint32_t       m_Mask;
+        int32_atomic_t m_Head;
+        int32_atomic_t m_Tail;
+    };
+
+    struct Transport
+    {
+        dmSocket::Socket m_Socket;
+        dmThread::Thread m_Thread;
+        Ring             m_Send;
+        Ring             m_Receive;
+        uint32_t         m_MaxPacketSize;
+        uint32_t         m_PollTimeout;
+        uint16_t         m_Port;
+        int32_atomic_t   m_Run;
+        int32_atomic_t   m_PacketsSent;
+        int32_atomic_t   m_PacketsReceived;
+        int32_atomic_t   m_SendErrors;
+        int32_atomic_t   m_ReceiveDropped;
+        // Receive buffer for the packets that are dropped
+        uint8_t*         m_Scratch;
+    };
+
+    NewParams::NewParams()
+    {
+        m_Address.m_family = dmSocket::DOMAIN_IPV4;
+        m_Port = 0;
+        m_MaxPacketSize = 1472;
+        m_SendQueueSize = 256;
+        m_ReceiveQueueSize = 256;
+        m_PollTimeout = 1000;
+    }
+
+    static uint32_t NextPowerOfTwo(uint32_t n)
+    {
+        uint32_t p = 1;
+        while (p < n)
+            p <<= 1;
+        return p;
+    }
+
+    static void InitRing(Ring* ring, uint32_t count, uint32_t max_packet_size)
+    {
+        count = NextPowerOfTwo(dmMath::Max(count, 1U));
+        ring->m_SlotSize = (SLOT_DATA_OFFSET + max_packet_size + SLOT_ALIGNMENT - 1) & ~(SLOT_ALIGNMENT - 1);
+        ring->m_Slots = (uint8_t*) malloc(ring->m_SlotSize * count);
+        ring->m_Mask = count - 1;
+        ring->m_Head = 0;
+        ring->m_Tail = 0;
+    }
+
+    static inline SlotHeader* GetSlot(Ring* ring, uint32_t counter)
+    {
+        return (SlotHeader*) (ring->m_Slots + (counter & ring->m_Mask) * ring->m_SlotSize);
+    }
+
+    static inline uint8_t* GetSlotData(SlotHeader* slot)
+    {
+        return (uint8_t*) slot + SLOT_DATA_OFFSET;
+    }
+
+    static void FlushSendQueue(Transport* transport)
+    {
+        Ring* ring = &transport->m_Send;
+        uint32_t tail = (uint32_t) dmAtomicGet32(&ring->m_Tail);
+        uint32_t head = (uint32_t) dmAtomicGet32(&ring->m_Head);
+
+        dmSocket::Datagram datagrams[BATCH_SIZE];
+        while (tail != head)
+        {
+            uint32_t count = dmMath::Min(head - tail, BATCH_SIZE);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                SlotHeader* slot = GetSlot(ring, tail + i);
+                datagrams[i].m_Data = GetSlotData(slot);
+                datagrams[i].m_Size = slot->m_Size;
+                datagrams[i].m_Address = slot->m_Address;
+                datagrams[i].m_Port = slot->m_Port;
+            }
+
+            uint32_t sent = 0;
+            dmSocket::Result r = dmSocket::SendToBatch(transport->m_Socket, datagrams, count, &sent);
+            if (r == dmSocket::RESULT_WOULDBLOCK)
+            {
+                // The socket buffer is full. Try again the next round
+                break;
+            }
+            else if (r != dmSocket::RESULT_OK)
+            {
+                // Drop the packet, so that e.g. an unreachable host doesn't block the queue
+                dmAtomicAdd32(&transport->m_SendErrors, 1);
+                sent = 1;
+            }
+            else
+            {
+                dmAtomicAdd32(&transport->m_PacketsSent, (int32_t) sent);
+            }
+
+            tail += sent;
+            dmAtomicAdd32(&ring->m_Tail, (int32_t) sent);
+        }
+    }
+
+    static void ReceivePackets(Transport* transport)
+    {
+        Ring* ring = &transport->m_Receive;
+        uint32_t head = (uint32_t) dmAtomicGet32(&ring->m_Head);
+        uint32_t tail = (uint32_t) dmAtomicGet32(&ring->m_Tail);
+        uint32_t free_slots = ring->m_Mask + 1 - (head - tail);
+
+        dmSocket::Datagram datagrams[BATCH_SIZE];
+        if (free_slots == 0)
+        {
+            // Read the packets anyway, or the socket would stay readable
+            for (uint32_t i = 0; i < BATCH_SIZE; ++i)
+            {
+                datagrams[i].m_Data = transport->m_Scratch;
+                datagrams[i].m_Size = transport->m_MaxPacketSize;
+            }
+            uint32_t received = 0;
+            dmSocket::ReceiveFromBatch(transport->m_Socket, datagrams, BATCH_SIZE, &received);
+            dmAtomicAdd32(&transport->m_ReceiveDropped, (int32_t) received);
+            return;
+        }
+
+        uint32_t count = dmMath::Min(free_slots, BATCH_SIZE);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            datagrams[i].m_Data = GetSlotData(GetSlot(ring, head + i));
+            datagrams[i].m_Size = transport->m_MaxPacketSize;
+        }
+
+        uint32_t received = 0;
+        dmSocket::Result r = dmSocket::ReceiveFromBatch(transport->m_Socket, datagrams, count, &received);
+        if (r != dmSocket::RESULT_OK)
+        {
+            return;
+        }
+
+        for (uint32_t i = 0; i < received; ++i)
+        {
+            SlotHeader* slot = GetSlot(ring, head + i);
+            slot->m_Size = datagrams[i].m_Size;
+            slot->m_Address = datagrams[i].m_Address;
+            slot->m_Port = datagrams[i].m_Port;
+        }
+
+        dmAtomicAdd32(&transport->m_PacketsReceived, (int32_t) received);
+        dmAtomicAdd32(&ring->m_Head, (int32_t) received);
+    }
+
+    static void Service(Transport* transport, int32_t timeout)
+    {
+        FlushSendQueue(transport);
+
+        dmSocket::Selector selector;
+        dmSocket::SelectorSet(&selector, dmSocket::SELECTOR_KIND_READ, transport->m_Socket);
+        dmSocket::Result r = dmSocket::Select(&selector, timeout);
+        if (r == dmSocket::RESULT_OK && dmSocket::SelectorIsSet(&selector, dmSocket::SELECTOR_KIND_READ, transport->m_Socket))
+        {
+            ReceivePackets(transport);
+        }
+    }
+
+    static void Loop(void* arg)
+    {
+        Transport* transport = (Transport*) arg;
+        while (dmAtomicGet32(&transport->m_Run))
+        {
+            Service(transport, (int32_t) transport->m_PollTimeout);
+        }
+    }
+
+    static void DeleteTransport(Transport* transport)
+    {
+        if (transport->m_Socket != dmSocket::INVALID_SOCKET_HANDLE)
+        {
+            dmSocket::Delete(transport->m_Socket);
+        }
+        free(transport->m_Send.m_Slots);
+        free(transport->m_Receive.m_Slots);
+        free(transport->m_Scratch);
+        delete transport;
+    }
+
+    Result New(const NewParams* params, HTransport* out_transport)
+    {
+        *out_transport = 0;
+        if (params->m_MaxPacketSize == 0 || params->m_MaxPacketSize > 0xFFFF ||
+            (params->m_Address.m_family != dmSocket::DOMAIN_IPV4 && params->m_Address.m_family != dmSocket::DOMAIN_IPV6))
+        {
+            return RESULT_INVALID_PARAMS;
+        }
+
+        Transport* transport = new Transport;
+        memset(transport, 0, sizeof(*transport));
+        transport->m_Socket = dmSocket::INVALID_SOCKET_HANDLE;
+        transport->m_MaxPacketSize = params->m_MaxPacketSize;
+        transport->m_PollTimeout = params->m_PollTimeout;
+
+        dmSocket::Result sr = dmSocket::New(params->m_Address.m_family, dmSocket::TYPE_DGRAM, dmSocket::PROTOCOL_UDP, &transport->m_Socket);
+        if (sr == dmSocket::RESULT_OK)
+            sr = dmSocket::Bind(transport->m_Socket, params->m_Address, params->m_Port);
+        if (sr == dmSocket::RESULT_OK)
+            sr = dmSocket::SetBlocking(transport->m_Socket, false);
+        dmSocket::Address address;
+        if (sr == dmSocket::RESULT_OK)
+            sr = dmSocket::GetName(transport->m_Socket, &address, &transport->m_Port);
+        if (sr != dmSocket::RESULT_OK)
+        {
+            dmLogError("Failed to create udp transport on port %d: %s", params->m_Port, dmSocket::ResultToString(sr));
+            DeleteTransport(transport);
+            return RESULT_SOCKET_ERROR;
+        }
+
+        InitRing(&transport->m_Send, params->m_SendQueueSize, params->m_MaxPacketSize);
+        InitRing(&transport->m_Receive, params->m_ReceiveQueueSize, params->m_MaxPacketSize);
+        transport->m_Scratch = (uint8_t*) malloc(params->m_MaxPacketSize);
+
+        transport->m_Run = 1;
+        if (dmThread::PlatformHasThreadSupport())
+        {
+            transport->m_Thread = dmThread::New(Loop, THREAD_STACK_SIZE, transport, "udp_transport");
+        }
+
+        *out_transport = transport;
+        return RESULT_OK;
+    }
+
+    void Delete(HTransport transport)
+    {
+        dmAtomicStore32(&transport->m_Run, 0);
+        if (transport->m_Thread)
+        {
+            dmThread::Join(transport->m_Thread);
+        }
+        DeleteTransport(transport);
+    }
+
+    uint16_t GetPort(HTransport transport)
+    {
+        return transport->m_Port;
+    }
+
+    Result Send(HTransport transport, const void* data, uint32_t size, dmSocket::Address address, uint16_t port)
+    {
+        if (size > transport->m_MaxPacketSize)
+        {
+            return RESULT_TOO_LARGE;
+        }
+
+        Ring* ring = &transport->m_Send;
+        uint32_t head = (uint32_t) dmAtomicGet32(&ring->m_Head);
+        uint32_t tail = (uint32_t) dmAtomicGet32(&ring->m_Tail);
+        if (head - tail > ring->m_Mask)
+        {
+            return RESULT_FULL;
+        }
+
+        SlotHeader* slot = GetSlot(ring, head);
+        slot->m_Address = address;
+        slot->m_Port = port;
+        slot->m_Size = size;
+        memcpy(GetSlotData(slot), data, size);
+
+        dmAtomicAdd32(&ring->m_Head, 1);
+        return RESULT_OK;
+    }
+
+    uint32_t Receive(HTransport transport, Packet* packets, uint32_t max_count)
+    {
+        Ring* ring = &transport->m_Receive;
+        uint32_t tail = (uint32_t) dmAtomicGet32(&ring->m_Tail);
+        uint32_t head = (uint32_t) dmAtomicGet32(&ring->m_Head);
+        uint32_t count = dmMath::Min(head - tail, max_count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            SlotHeader* slot = GetSlot(ring, tail + i);
+            packets[i].m_Data = GetSlotData(slot);
+            packets[i].m_Size = slot->m_Size;
+            packets[i].m_Address = slot->m_Address;
+            packets[i].m_Port = slot->m_Port;
+        }
+        return count;
+    }
+
+    void Release(HTransport transport, uint32_t count)
+    {
+        Ring* ring = &transport->m_Receive;
+        assert(count <= (uint32_t) (dmAtomicGet32(&ring->m_Head) - dmAtomicGet32(&ring->m_Tail)));
+        dmAtomicAdd32(&ring->m_Tail, (int32_t) count);
+    }
+
+    void Update(HTransport transport)
+    {
+        if (!transport->m_Thread)
+        {
+            Service(transport, 0);
+        }
+    }
+
+    void GetStats(HTransport transport, Stats* stats)
+    {
+        stats->m_PacketsSent = (uint32_t) dmAtomicGet32(&transport->m_PacketsSent);
+        stats->m_PacketsReceived = (uint32_t) dmAtomicGet32(&transport->m_PacketsReceived);
+        stats->m_SendErrors = (uint32_t) dmAtomicGet32(&transport->m_SendErrors);
+        stats->m_ReceiveDropped = (uint32_t) dmAtomicGet32(&transport->m_ReceiveDropped);
+    }
+}
@@ -0,0 +1,137 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_UDP_TRANSPORT_H
+#define DM_UDP_TRANSPORT_H
+
+#include <stdint.h>
+#include <dlib/socket.h>
+
+/**
+ * UDP transport for real-time networking.
+ *
+ * The datagrams are sent and received in batches on a background thread (see dmSocket::SendToBatch),
+ * and passed to and from the user through two single producer/single consumer rings. The rings are
+ * lock free, so a transport may be used from one thread (e.g. the main thread) without ever blocking on the
+ * network thread. The received packets are read in place from the ring, without copying.
+ *
+ * On platforms without threads, the network is serviced by Update.
+ */
+namespace dmUdpTransport
+{
+    typedef struct Transport* HTransport;
+
+    enum Result
+    {
+        RESULT_OK = 0,
+        RESULT_FULL = -1,           //!< The send queue is full
+        RESULT_TOO_LARGE = -2,      //!< The packet is larger than NewParams::m_MaxPacketSize
+        RESULT_SOCKET_ERROR = -3,
+        RESULT_INVALID_PARAMS = -4,
+    };
+
+    struct NewParams
+    {
+        NewParams();
+
+        /// The address to bind to. Also decides the address family of the transport. Defaults to any IPv4 address
+        dmSocket::Address m_Address;
+        /// The port to bind to, or 0 for any port
+        uint16_t          m_Port;
+        /// Max size of a packet. Defaults to 1472, which fits an Ethernet frame with IPv4 and UDP headers
+        uint32_t          m_MaxPacketSize;
+        /// Number of packets in the send queue. Rounded up to a power of two
+        uint32_t          m_SendQueueSize;
+        /// Number of packets in the receive queue. Rounded up to a power of two. Packets that don't fit are dropped
+        uint32_t          m_ReceiveQueueSize;
+        /// Max time in microseconds the network thread waits for incoming packets before checking the send queue
+        uint32_t          m_PollTimeout;
+    };
+
+    struct Packet
+    {
+        const uint8_t*    m_Data;
+        uint32_t          m_Size;
+        dmSocket::Address m_Address;
+        uint16_t          m_Port;
+    };
+
+    struct Stats
+    {
+        uint32_t m_PacketsSent;
+        uint32_t m_PacketsReceived;
+        uint32_t m_SendErrors;
+        /// Packets dropped as the receive queue was full
+        uint32_t m_ReceiveDropped;
+    };
+
+    /**
+     * Create a transport, and start its network thread
+     * @param params parameters
+     * @param transport the transport (out)
+     * @return RESULT_OK on success
+     */
+    Result New(const NewParams* params, HTransport* transport);
+
+    /**
+     * Stop the network thread, and delete the transport. Packets that haven't been sent are discarded.
+     */
+    void Delete(HTransport transport);
+
+    /**
+     * @return the port the transport is bound to
+     */
+    uint16_t GetPort(HTransport transport);
+
+    /**
+     * Queue a packet for sending. The data is copied
+     * @param transport the transport
+     * @param data the packet data
+     * @param size the packet size
+     * @param address the address to send to. Must be of the same family as the transport
+     * @param port the port to send to
+     * @return RESULT_OK on success, RESULT_FULL if the send queue is full
+     */
+    Result Send(HTransport transport, const void* data, uint32_t size, dmSocket::Address address, uint16_t port);
+
+    /**
+     * Get the received packets, oldest first, without removing them from the queue. The packet data is
+     * read in place, and is valid until the packets are released with Release.
+     * @param transport the transport
+     * @param packets the packets (out)
+     * @param max_count max number of packets to get
+     * @return number of packets
+     */
+    uint32_t Receive(HTransport transport, Packet* packets, uint32_t max_count);
+
+    /**
+     * Remove the oldest received packets from the queue, making their slots available for new packets
+     * @param transport the transport
+     * @param count number of packets to release. Must not be more than returned by Receive
+     */
+    void Release(HTransport transport, uint32_t count);
+
+    /**
+     * Sends the queued packets, and receives the incoming ones, without blocking. Only needed on
+     * platforms without threads, and does nothing otherwise.
+     */
+    void Update(HTransport transport);
+
+    /**
+     * Get the transport statistics. The counters are updated by the network thread.
+     */
+    void GetStats(HTransport transport, Stats* stats);
+}
+
+#endif // DM_UDP_TRANSPORT_H
@@ -87,5 +87,33 @@ Result GetEntryData(HZip zip, void* buffer, uint32_t buffer_size)
     return RESULT_OK;
 }
 
+Result GetEntryInfo(HZip zip, uint32_t index, char* name_buffer, uint32_t name_buffer_size, EntryInfo* info)
+{
+    unsigned long long size, stored_size;
+    int deflated, is_dir;
+    if (zip_entry_stat_byindex(zip, (int)index, name_buffer, name_buffer_size, &size, &stored_size, &deflated, &is_dir) != 0)
+        return RESULT_NO_SUCH_ENTRY;
+    info->m_Size = (uint32_t)(size & 0xFFFFFFFF);
+    info->m_StoredSize = (uint32_t)(stored_size & 0xFFFFFFFF);
+    info->m_Deflated = deflated != 0;
+    info->m_IsDir = is_dir != 0;
+    return RESULT_OK;
+}
+
+Result GetEntryStoredData(HZip zip, uint32_t index, void* buffer, uint32_t buffer_size)
+{
+    ssize_t nread = zip_entry_rawread_byindex(zip, (int)index, buffer, (size_t)buffer_size);
+    if (nread < 0)
+        return RESULT_BUFFER_NOT_LARGE_ENOUGH;
+    return RESULT_OK;
+}
+
+Result Inflate(const void* data, uint32_t data_size, void* buffer, uint32_t buffer_size)
+{
+    ssize_t nwritten = zip_inflate(data, (size_t)data_size, buffer, (size_t)buffer_size);
+    if (nwritten < 0)
+        return RESULT_DATA_ERROR;
+    return RESULT_OK;
+}
 
 } // namespace
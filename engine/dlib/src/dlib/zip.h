@@ -28,6 +28,15 @@ namespace dmZip
         RESULT_OK,
         RESULT_NO_SUCH_ENTRY,
         RESULT_BUFFER_NOT_LARGE_ENOUGH,
+        RESULT_DATA_ERROR,
+    };
+
+    struct EntryInfo
+    {
+        uint32_t m_Size;        // The uncompressed size
+        uint32_t m_StoredSize;  // The size in the archive
+        bool     m_Deflated;    // If the stored data needs to be inflated
+        bool     m_IsDir;
     };
 
     /*# Opens a read only zip archive
@@ -84,6 +93,23 @@ namespace dmZip
      *
      */
     Result GetEntryData(HZip zip, void* buffer, uint32_t buffer_size);
+
+    /*# gets the info of an entry by index, without opening it
+     * Only the central directory is read
+     * @param name_buffer [type: char*] buffer for the entry name, or 0
+     */
+    Result GetEntryInfo(HZip zip, uint32_t index, char* name_buffer, uint32_t name_buffer_size, EntryInfo* info);
+
+    /*# gets the stored data of an entry by index, without opening it
+     * The data is still deflated if EntryInfo::m_Deflated is set (see Inflate).
+     * The archive file is read, so calls on the same archive must be serialized.
+     */
+    Result GetEntryStoredData(HZip zip, uint32_t index, void* buffer, uint32_t buffer_size);
+
+    /*# inflates stored entry data
+     * Each call has its own decompressor state, so it's thread safe.
+     */
+    Result Inflate(const void* data, uint32_t data_size, void* buffer, uint32_t buffer_size);
 }
 
 #endif // DM_ZIP_H
\ No newline at end of file
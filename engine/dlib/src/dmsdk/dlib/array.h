@@ -328,6 +328,17 @@ public:
      */
     void Push(const T& element);
 
+    /*# array push with growth
+     *
+     * Add an element to the end of the array, growing the capacity if the array is full.
+     * The capacity grows by 50% (and at least 8 elements) at a time, which makes repeated pushes amortized O(1).
+     * Only allowed for auto-allocated arrays, unless there is room for the element.
+     *
+     * @name PushGrow
+     * @param element [type:const T&] element element to add
+     */
+    void PushGrow(const T& element);
+
     /*# array push array
      *
      * Add an array of elements to the end of the array
@@ -558,6 +569,21 @@ void dmArray<T>::Push(const T& element)
     *m_End++ = element;
 }
 
+template <typename T>
+void dmArray<T>::PushGrow(const T& element)
+{
+    if (m_End == m_Back)
+    {
+        // The element may be stored in the array itself
+        T tmp = element;
+        uint32_t capacity = Capacity();
+        SetCapacity(capacity + (capacity / 2 > 8 ? capacity / 2 : 8));
+        *m_End++ = tmp;
+        return;
+    }
+    *m_End++ = element;
+}
+
 template <typename T>
 void dmArray<T>::PushArray(const T* array, uint32_t count)
 {
@@ -400,6 +400,32 @@ namespace dmBuffer
      */
     Result UpdateContentVersion(HBuffer hbuffer);
 
+    /*# Update the internal frame counter, for a range of changed structs.
+     * Same as [ref:dmBuffer::UpdateContentVersion], but also records which structs were changed,
+     * so that a consumer can copy only that part of the buffer. See [ref:dmBuffer::GetChangedRange]
+     *
+     * @name dmBuffer::UpdateContentVersionRange
+     * @param type [type:dmBuffer::HBuffer] The value type
+     * @param first [type:uint32_t] The index of the first changed struct
+     * @param count [type:uint32_t] The number of changed structs
+     * @return result [type:dmBuffer::Result] Returns BUFFER_OK if all went ok
+     */
+    Result UpdateContentVersionRange(HBuffer hbuffer, uint32_t first, uint32_t count);
+
+    /*# Gets the range of structs that have changed since a content version
+     * If the changes since the version are no longer known, the whole buffer is returned.
+     * The changes made after this call are recorded as a new range, so that each consumer that polls once
+     * per frame (up to 8 frames apart) gets a precise range.
+     *
+     * @name dmBuffer::GetChangedRange
+     * @param type [type:dmBuffer::HBuffer] The value type
+     * @param version [type:uint32_t] The content version the consumer last copied
+     * @param first [type:uint32_t*] The index of the first changed struct
+     * @param count [type:uint32_t*] The number of changed structs, 0 if the buffer hasn't changed
+     * @return result [type:dmBuffer::Result] Returns BUFFER_OK if all went ok
+     */
+    Result GetChangedRange(HBuffer hbuffer, uint32_t version, uint32_t* first, uint32_t* count);
+
     /*# set a metadata entry
      *
      * Create or update a new metadata entry with a number of values of a specific type.
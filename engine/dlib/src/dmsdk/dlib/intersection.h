@@ -15,6 +15,7 @@
 #ifndef DMSDK_INTERSECTION_H
 #define DMSDK_INTERSECTION_H
 
+#include <stdint.h>
 #include <dmsdk/dlib/vmath.h>
 
 /*# Intersection math structs and functions
@@ -135,6 +136,50 @@ namespace dmIntersection
      */
     bool TestFrustumOBB(const Frustum& frustum, const dmVMath::Matrix4& world, dmVMath::Vector3& aabb_min, dmVMath::Vector3& aabb_max);
 
+    /*# world space axis aligned bounding box
+     * An axis aligned bounding box in world space, stored as center and half extents.
+     * Used for testing many boxes against a frustum at once.
+     * @struct
+     * @name WorldAABB
+     * @member m_Center [type:float[4]] the center of the box. The w component is unused.
+     * @member m_Extents [type:float[4]] the half extents of the box. The w component is unused.
+     */
+    struct WorldAABB
+    {
+        float m_Center[4];
+        float m_Extents[4];
+    };
+
+    /*#
+     * Calculates the world space axis aligned box that encloses a transformed local box
+     * @name CreateWorldAABB
+     * @param world [type: dmVMath::Matrix4&] The world transform of the box
+     * @param aabb_min [type: dmVMath::Vector3&] the minimum corner of the box. In local space.
+     * @param aabb_max [type: dmVMath::Vector3&] the maximum corner of the box. In local space.
+     * @param out [type: dmIntersection::WorldAABB&] the world space box
+     */
+    void CreateWorldAABB(const dmVMath::Matrix4& world, const dmVMath::Vector3& aabb_min, const dmVMath::Vector3& aabb_max, WorldAABB& out);
+
+    /*#
+     * Tests intersection between a frustum and a world space box
+     * @name TestFrustumWorldAABB
+     * @param frustum [type: dmIntersection::Frustum&] the frustum
+     * @param box [type: dmIntersection::WorldAABB&] the box
+     * @return intersects [type: bool] Returns true if the objects intersect
+     */
+    bool TestFrustumWorldAABB(const Frustum& frustum, const WorldAABB& box);
+
+    /*#
+     * Tests intersection between a frustum and a number of world space boxes.
+     * The boxes are tested several at a time, using SIMD instructions where available.
+     * @name TestFrustumWorldAABBs
+     * @param frustum [type: dmIntersection::Frustum&] the frustum
+     * @param boxes [type: dmIntersection::WorldAABB*] the boxes
+     * @param count [type: uint32_t] the number of boxes
+     * @param results [type: uint8_t*] set to 1 for each box that intersects the frustum, and 0 otherwise
+     */
+    void TestFrustumWorldAABBs(const Frustum& frustum, const WorldAABB* boxes, uint32_t count, uint8_t* results);
+
 } // dmIntersection
 
 #endif // DMSDK_INTERSECTION_H
@@ -24,6 +24,8 @@
  * @path engine/dlib/src/dmsdk/dlib/memory.h
  */
 
+#include <stdint.h>
+
 namespace dmMemory
 {
     /*# aligned memory allocation result
@@ -59,6 +61,23 @@ namespace dmMemory
      * @param memptr [type: void*] A pointer to the memory block that was returned by dmMemory::AlignedMalloc
      */
     void AlignedFree(void* memptr);
+
+    /*#
+     * Allocate size bytes of uninitialized scratch memory from the frame arena.
+     * The memory is owned by the engine and must not be freed. It stays valid until the end
+     * of the next frame, which allows data produced during the update to be used during the render.
+     * This function is thread safe.
+     * @name FrameAlloc
+     * @param size [type: uint32_t] Size of the requested memory allocation.
+     * @param alignment [type: uint32_t] The alignment value, which must be an integer power of 2.
+     * @return memory [type: void*] Pointer to the allocated memory, or 0 if out of memory.
+     * @examples
+     *
+     * ```cpp
+     * float* scratch = (float*)dmMemory::FrameAlloc(count * sizeof(float), 16);
+     * ```
+     */
+    void* FrameAlloc(uint32_t size, uint32_t alignment);
 }
 
 #endif // DMSDK_MEMORY_H
@@ -217,6 +217,7 @@ namespace dmMessage
      * @member m_UserData2 [type: uintptr_t] User data pointer
      * @member m_Descriptor [type: uintptr_t] User specified descriptor of the message data
      * @member m_DataSize [type: uint32_t] Size of message data in bytes
+     * @member m_Flags [type: uint32_t] See dmMessage::MessageFlags
      * @member m_Next [type: dmMessage::Message*] Ptr to next message (or 0 if last)
      * @member m_DestroyCallback [type: dmMessage::MessageDestroyCallback] If set, will be called after each dispatch
      * @member m_Data [type: uint8_t*] Payload
@@ -230,11 +231,35 @@ namespace dmMessage
         uintptr_t              m_UserData2;         //! User data pointer
         uintptr_t              m_Descriptor;        //! User specified descriptor of the message data
         uint32_t               m_DataSize;          //! Size of message data in bytes
+        uint32_t               m_Flags;             //! See dmMessage::MessageFlags
         struct Message*        m_Next;              //! Ptr to next message (or 0 if last)
         MessageDestroyCallback m_DestroyCallback;   //! If set, will be called after each dispatch
         uint8_t DM_ALIGNED(16) m_Data[0];           //! Payload
     };
 
+    /*#
+     * @enum
+     * @name MessageFlags
+     * @member MESSAGE_FLAG_REFERENCE The payload isn't stored in the message, m_Data holds a pointer to it. See dmMessage::PostRef
+     */
+    enum MessageFlags
+    {
+        MESSAGE_FLAG_REFERENCE = 1 << 0,
+    };
+
+    /*#
+     * Get the payload of a message, regardless of whether it was posted by value or by reference
+     * @name GetData
+     * @param message [type: dmMessage::Message*] The message
+     * @return data [type: void*] The payload
+     */
+    inline void* GetData(const Message* message)
+    {
+        if (message->m_Flags & MESSAGE_FLAG_REFERENCE)
+            return *(void**)message->m_Data;
+        return (void*)message->m_Data;
+    }
+
     /**
      * Post an message to a socket
      * @note Message data is copied by value
@@ -253,6 +278,26 @@ namespace dmMessage
     Result Post(const URL* sender, const URL* receiver, dmhash_t message_id, uintptr_t user_data1, uintptr_t user_data2,
                 uintptr_t descriptor, const void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback);
 
+    /*#
+     * Post a message to a socket, without copying the payload. The payload must stay valid until the message is
+     * dispatched, and is typically freed by the destroy callback, see dmMessage::GetData.
+     * There is no size limit for the payload, since only the pointer is stored in the socket.
+     * @note The receivers must read the payload with dmMessage::GetData
+     * @name PostRef
+     * @param sender [type: dmMessage::URL*] The sender URL if the receiver wants to respond. 0x0 is accepted
+     * @param receiver [type: dmMessage::URL*] The receiver URL, must not be 0x0
+     * @param message_id [type: dmhash_t] Message id
+     * @param user_data1 [type: uintptr_t] User data that can be used when both the sender and receiver are known
+     * @param user_data2 [type: uintptr_t] User data that can be used when both the sender and receiver are known.
+     * @param descriptor [type: uintptr_t] User specified descriptor of the message data
+     * @param message_data [type: void*] Message data, owned by the message until it's dispatched
+     * @param message_data_size [type: uint32_t] Message data size in bytes
+     * @param destroy_callback [type: dmMessage::MessageDestroyCallback] if set, will be called after the message dispatch
+     * @return RESULT_OK if the message was posted. Otherwise the caller still owns the message data
+     */
+    Result PostRef(const URL* sender, const URL* receiver, dmhash_t message_id, uintptr_t user_data1, uintptr_t user_data2,
+                   uintptr_t descriptor, void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback);
+
     /** post a ddf message to a socket
      * Post a DDF message to a socket. A helper wrapper for Post()'ing a DDF message
      * @note Message data is copied by value
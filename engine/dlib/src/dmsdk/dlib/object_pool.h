@@ -47,6 +47,13 @@ private:
     {
         uint32_t m_Physical;
         uint32_t m_Next;
+        uint32_t m_Version; // Increased when the object is freed
+    };
+
+    struct SortEntry
+    {
+        uint32_t m_Key;
+        uint32_t m_Physical;
     };
 
     dmArray<T>          m_Objects; // All objects [0..Size()]
@@ -97,6 +104,7 @@ public:
         } else {
             m_Entries.SetSize(size + 1);
             e = &m_Entries[size];
+            e->m_Version = 0;
         }
         e->m_Next = 0xffffffff;
         e->m_Physical = size;
@@ -164,6 +172,7 @@ public:
         m_Objects.EraseSwap(e->m_Physical);
 
         // Put in free list
+        e->m_Version++;
         e->m_Next = m_FirstFree;
         m_FirstFree = e - m_Entries.Begin();
     }
@@ -192,6 +201,108 @@ public:
         return o;
     }
 
+    /*#
+     * Get a handle to the object, that can be checked for validity after the object is freed
+     * @name GetHandle
+     * @param index [type: uint32_t] index of the object
+     * @return handle [type: uint64_t] the handle, the version in high 32 bits and the index in the low 32 bits
+     */
+    uint64_t GetHandle(uint32_t index)
+    {
+        return ((uint64_t)m_Entries[index].m_Version << 32) | index;
+    }
+
+    /*#
+     * Get object from a handle
+     * @name GetFromHandle
+     * @param handle [type: uint64_t] handle of the object, see GetHandle
+     * @return object [type: T*] a pointer to the object, or 0 if the object has been freed
+     */
+    T* GetFromHandle(uint64_t handle)
+    {
+        uint32_t index = (uint32_t)handle;
+        if (index >= m_Entries.Size())
+            return 0;
+        Entry* e = &m_Entries[index];
+        if (e->m_Version != (uint32_t)(handle >> 32))
+            return 0;
+        return &m_Objects[e->m_Physical];
+    }
+
+    /*#
+     * Sorts the objects on a key, e.g. a hash of the material and textures, so that objects that are rendered together
+     * are next to each other in memory. The logical indices and the handles are kept. The sort is stable, and linear in the
+     * number of objects (a radix sort).
+     * @note The order of the objects returned by GetRawObjects() changes
+     * @name Sort
+     * @param key [type: uint32_t (*)(const T&)] function, or function object, that returns the key of an object
+     * @return changed [type: bool] true if the order changed
+     */
+    template <typename KeyFn>
+    bool Sort(KeyFn key)
+    {
+        uint32_t size = m_Objects.Size();
+        if (size < 2)
+            return false;
+
+        dmArray<SortEntry> entries;
+        entries.SetCapacity(size);
+        entries.SetSize(size);
+        bool sorted = true;
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            entries[i].m_Key = key(m_Objects[i]);
+            entries[i].m_Physical = i;
+            sorted = sorted && (i == 0 || entries[i-1].m_Key <= entries[i].m_Key);
+        }
+        if (sorted)
+            return false;
+
+        dmArray<SortEntry> tmp;
+        tmp.SetCapacity(size);
+        tmp.SetSize(size);
+        for (uint32_t shift = 0; shift < 32; shift += 8)
+        {
+            uint32_t offsets[256] = {0};
+            for (uint32_t i = 0; i < size; ++i)
+                offsets[(entries[i].m_Key >> shift) & 0xFF]++;
+            // All keys have the same byte
+            if (offsets[(entries[0].m_Key >> shift) & 0xFF] == size)
+                continue;
+
+            uint32_t offset = 0;
+            for (uint32_t b = 0; b < 256; ++b)
+            {
+                uint32_t count = offsets[b];
+                offsets[b] = offset;
+                offset += count;
+            }
+            for (uint32_t i = 0; i < size; ++i)
+                tmp[offsets[(entries[i].m_Key >> shift) & 0xFF]++] = entries[i];
+            entries.Swap(tmp);
+        }
+
+        // Reorder the objects, and reuse the key for the logical index
+        dmArray<T> objects;
+        objects.SetCapacity(m_Objects.Capacity());
+        objects.SetSize(size);
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            uint32_t physical = entries[i].m_Physical;
+            objects[i] = m_Objects[physical];
+            entries[i].m_Key = m_ToLogical[physical];
+        }
+        m_Objects.Swap(objects);
+
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            uint32_t logical = entries[i].m_Key;
+            m_ToLogical[i] = logical;
+            m_Entries[logical].m_Physical = i;
+        }
+        return true;
+    }
+
     /*#
      * Set object from logical index
      * @name Set
@@ -368,7 +368,8 @@ namespace dmSocket
     Result GetHostByName(const char* name, Address* address, bool ipv4 = true, bool ipv6 = true);
 
     /*# get host by name with timeout and cancelability
-     * Get host by name with timeout and cancelability
+     * Get host by name with timeout and cancelability. Concurrent lookups of the same name are merged,
+     * and the result is cached for a short while.
      * @note On HTML5, this function is a wrapper for dmSocket::GetHostByName
      * @name GetHostByName
      * @param name [type:const char*] Hostname to resolve
@@ -0,0 +1,105 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+#include "../../src/dlib/benchmark.h"
+#include "../../src/dlib/hash.h"
+#include "../../src/dlib/hashtable.h"
+#include "../../src/dlib/flat_hashtable.h"
+#include "../../src/dlib/message.h"
+#include "../../src/dlib/profile/profile.h"
+
+static const dmhash_t HASH_MESSAGE = 0x35d47694;
+
+struct BenchMessageData
+{
+    float    m_Values[4];
+    uint32_t m_Index;
+};
+
+static void CountMessage(dmMessage::Message* message, void* user_ptr)
+{
+    uint32_t* count = (uint32_t*)user_ptr;
+    *count += ((BenchMessageData*)message->m_Data)->m_Index & 1;
+}
+
+TEST(dmBenchmark, MessagePostDispatch)
+{
+    const uint32_t message_count = 4096;
+
+    dmMessage::URL receiver;
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("bench_socket", &receiver.m_Socket));
+    receiver.m_Path = 0;
+    receiver.m_Fragment = 0;
+
+    BenchMessageData data = {};
+    uint32_t count = 0;
+    for (dmBenchmark::Run run("message.post_dispatch", 50, message_count); run.Next(); )
+    {
+        for (uint32_t i = 0; i < message_count; ++i)
+        {
+            data.m_Index = i;
+            dmMessage::Post(0x0, &receiver, HASH_MESSAGE, 0, 0x0, &data, sizeof(data), 0);
+        }
+        dmMessage::Dispatch(receiver.m_Socket, CountMessage, &count);
+    }
+    ASSERT_NE(0u, count);
+
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(receiver.m_Socket));
+}
+
+template <typename TABLE>
+static void BenchHashTableLookup(const char* name)
+{
+    const uint32_t count = 8192;
+    TABLE table;
+    table.SetCapacity(count / 2, count);
+    for (uint32_t i = 0; i < count; ++i)
+        table.Put(dmHashBuffer64(&i, sizeof(i)), i);
+
+    dmArray<dmhash_t> keys;
+    keys.SetCapacity(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t k = (i * 7919) % count;
+        keys.Push(dmHashBuffer64(&k, sizeof(k)));
+    }
+
+    uint32_t sum = 0;
+    for (dmBenchmark::Run run(name, 50, count); run.Next(); )
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            sum += *table.Get(keys[i]);
+    }
+    ASSERT_NE(0u, sum);
+}
+
+TEST(dmBenchmark, HashTableLookup)
+{
+    BenchHashTableLookup<dmHashTable64<uint32_t> >("hashtable.lookup");
+    BenchHashTableLookup<dmFlatHashTable64<uint32_t> >("flat_hashtable.lookup");
+}
+
+int main(int argc, char **argv)
+{
+    dmProfile::Initialize(0);
+    jc_test_init(&argc, argv);
+    int ret = jc_test_run_all();
+    dmProfile::Finalize();
+    if (ret == 0)
+        ret = dmBenchmark::Report(argc, argv, "dlib");
+    return ret;
+}
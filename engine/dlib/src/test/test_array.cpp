@@ -225,6 +225,65 @@ TEST(dmArray, Map)
     ASSERT_EQ(expected_sum, sum);
 }
 
+TEST(dmArray, PushGrow)
+{
+    dmArray<uint32_t> a;
+    uint32_t reallocations = 0;
+    const uint32_t* storage = a.Begin();
+    for (uint32_t i = 0; i < 10000; ++i)
+    {
+        a.PushGrow(i);
+        if (a.Begin() != storage)
+        {
+            storage = a.Begin();
+            ++reallocations;
+        }
+    }
+    ASSERT_EQ(10000u, a.Size());
+    ASSERT_GE(a.Capacity(), a.Size());
+    for (uint32_t i = 0; i < a.Size(); ++i)
+        ASSERT_EQ(i, a[i]);
+    // The growth is geometric
+    ASSERT_GT(20u, reallocations);
+
+    // Pushing an element of the array itself, when the array is reallocated
+    a.SetCapacity(a.Size());
+    a.PushGrow(a[5]);
+    ASSERT_EQ(5u, a.Back());
+}
+
+TEST(dmArraySmall, Inline)
+{
+    dmArraySmall<uint32_t, 4> a;
+    ASSERT_TRUE(a.IsInline());
+    ASSERT_EQ(0u, a.Size());
+    ASSERT_EQ(4u, a.Capacity());
+
+    for (uint32_t i = 0; i < 4; ++i)
+        a.Push(i);
+    a.SetCapacity(2);
+    ASSERT_TRUE(a.IsInline());
+    ASSERT_EQ(2u, a.Size());
+    ASSERT_EQ(4u, a.Capacity());
+
+    // Growing past the inline storage moves the elements to the heap
+    for (uint32_t i = 2; i < 100; ++i)
+        a.PushGrow(i);
+    ASSERT_FALSE(a.IsInline());
+    ASSERT_EQ(100u, a.Size());
+    for (uint32_t i = 0; i < a.Size(); ++i)
+        ASSERT_EQ(i, a[i]);
+
+    a.OffsetCapacity(16);
+    ASSERT_EQ(100u, a.Size());
+    ASSERT_EQ(99u, a.Back());
+
+    dmArraySmall<uint32_t, 2> b;
+    b.OffsetCapacity(1);
+    ASSERT_FALSE(b.IsInline());
+    ASSERT_EQ(3u, b.Capacity());
+}
+
 TEST(Macros, ArraySize)
 {
     char a_c1[5] = {};
@@ -653,6 +653,57 @@ TEST_F(GetDataTest, CheckOverwrite)
     }
 }
 
+TEST_F(GetDataTest, ChangedRange)
+{
+    uint32_t version = 0;
+    uint32_t first = 0;
+    uint32_t changed = 0;
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetContentVersion(buffer, &version));
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetChangedRange(buffer, version, &first, &changed));
+    ASSERT_EQ(0u, changed);
+
+    ASSERT_EQ(dmBuffer::RESULT_BUFFER_SIZE_ERROR, dmBuffer::UpdateContentVersionRange(buffer, 3, 2));
+
+    // The updates in between two reads are merged
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::UpdateContentVersionRange(buffer, 2, 1));
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::UpdateContentVersionRange(buffer, 1, 1));
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetChangedRange(buffer, version, &first, &changed));
+    ASSERT_EQ(1u, first);
+    ASSERT_EQ(2u, changed);
+
+    uint32_t version_a = 0;
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetContentVersion(buffer, &version_a));
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::UpdateContentVersionRange(buffer, 3, 1));
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetChangedRange(buffer, version_a, &first, &changed));
+    ASSERT_EQ(3u, first);
+    ASSERT_EQ(1u, changed);
+
+    // A consumer that is behind gets all the changes since its version
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetChangedRange(buffer, version, &first, &changed));
+    ASSERT_EQ(1u, first);
+    ASSERT_EQ(3u, changed);
+
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::UpdateContentVersion(buffer));
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetChangedRange(buffer, version_a, &first, &changed));
+    ASSERT_EQ(0u, first);
+    ASSERT_EQ(count, changed);
+
+    // Changes older than the history are reported as the whole buffer
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetContentVersion(buffer, &version));
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::UpdateContentVersionRange(buffer, 0, 1));
+        ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetChangedRange(buffer, version + i + 1, &first, &changed));
+        ASSERT_EQ(0u, changed);
+    }
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetChangedRange(buffer, version + 14, &first, &changed));
+    ASSERT_EQ(0u, first);
+    ASSERT_EQ(1u, changed);
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetChangedRange(buffer, version, &first, &changed));
+    ASSERT_EQ(0u, first);
+    ASSERT_EQ(count, changed);
+}
+
 
 TEST_P(AlignmentTest, CheckAlignment)
 {
@@ -239,6 +239,30 @@ TEST_F(dmConnectionPoolTest, ConnectFailed)
     ASSERT_EQ(dmConnectionPool::RESULT_SOCKET_ERROR, r);
 }
 
+TEST_F(dmConnectionPoolTest, Warmup)
+{
+    SCOPED_TRACE("");
+    CheckStats(MAX_CONNECTIONS, 0, 0);
+
+    dmConnectionPool::Result r = dmConnectionPool::Warmup(pool, g_HttpAddress, g_HttpPort, false, false, 0, 0);
+    ASSERT_EQ(dmConnectionPool::RESULT_OK, r);
+
+    SCOPED_TRACE("");
+    CheckStats(MAX_CONNECTIONS - 1, 1, 0);
+
+    // The warm connection is reused
+    dmConnectionPool::HConnection c;
+    dmSocket::Result sr;
+    r = dmConnectionPool::Dial(pool, g_HttpAddress, g_HttpPort, false, false, 0, 0, &c, &sr);
+    ASSERT_EQ(dmConnectionPool::RESULT_OK, r);
+    ASSERT_EQ(1U, dmConnectionPool::GetReuseCount(pool, c));
+
+    SCOPED_TRACE("");
+    CheckStats(MAX_CONNECTIONS - 1, 0, 1);
+
+    dmConnectionPool::Close(pool, c);
+}
+
 static void Usage()
 {
     dmLogError("Usage: <exe> <config>");
@@ -107,6 +107,33 @@ TEST(dmCrypt, SHA1)
     ASSERT_ARRAY_EQ(expected, digest);
 }
 
+TEST(dmCrypt, IncrementalHash)
+{
+    const char* s = "This is a string";
+    uint32_t len = strlen(s);
+
+    uint8_t expected_md5[16] = {0};
+    uint8_t expected_sha1[20] = {0};
+    dmCrypt::HashMd5((const uint8_t*)s, len, expected_md5);
+    dmCrypt::HashSha1((const uint8_t*)s, len, expected_sha1);
+
+    uint8_t digest_md5[16] = {0};
+    dmCrypt::HHashState state = dmCrypt::NewHash(dmCrypt::HASH_ALGORITHM_MD5);
+    dmCrypt::UpdateHash(state, (const uint8_t*)s, 5);
+    dmCrypt::UpdateHash(state, (const uint8_t*)s + 5, len - 5);
+    dmCrypt::FinalizeHash(state, digest_md5);
+    dmCrypt::DeleteHash(state);
+    ASSERT_ARRAY_EQ(expected_md5, digest_md5);
+
+    uint8_t digest_sha1[20] = {0};
+    state = dmCrypt::NewHash(dmCrypt::HASH_ALGORITHM_SHA1);
+    for (uint32_t i = 0; i < len; ++i)
+        dmCrypt::UpdateHash(state, (const uint8_t*)s + i, 1);
+    dmCrypt::FinalizeHash(state, digest_sha1);
+    dmCrypt::DeleteHash(state);
+    ASSERT_ARRAY_EQ(expected_sha1, digest_sha1);
+}
+
 TEST(dmCrypt, SHA256)
 {
     uint8_t expected[] = {0x4E,0x95,0x18,0x57,0x54,0x22,0xC9,0x08,0x73,0x96,0x88,0x7C,0xE2,0x04,0x77,0xAB,0x5F,0x55,0x0A,0x4A,0xA3,0xD1,0x61,0xC5,0xC2,0x2A,0x99,0x6B,0x0A,0xBB,0x8B,0x35};
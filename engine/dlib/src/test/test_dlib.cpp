@@ -18,6 +18,7 @@
 #include <map>
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
+#include "../dlib/dstrings.h"
 #include "../dlib/hash.h"
 #include "../dlib/log.h"
 
@@ -427,6 +428,35 @@ TEST_F(dlib, HashReverseErase)
     free((void*) buffer);
 }
 
+TEST_F(dlib, HashReverseReuse)
+{
+    char buffer[64];
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        dmSnPrintf(buffer, sizeof(buffer), "/reuse_instance%u", i);
+        dmHashString64(buffer);
+    }
+    uint32_t memory_usage = dmHashReverseMemoryUsage();
+    ASSERT_LT(0u, memory_usage);
+
+    // The erased strings are reused by new strings of the same size
+    for (uint32_t n = 0; n < 10; ++n)
+    {
+        for (uint32_t i = 0; i < 1000; ++i)
+        {
+            dmSnPrintf(buffer, sizeof(buffer), "/reuse_instance%u", i);
+            uint64_t hash = dmHashString64(buffer);
+            dmHashReverseErase64(hash);
+            ASSERT_EQ((const void*) 0, dmHashReverse64(hash, 0));
+
+            // Hashing it again after the erase adds it back
+            dmHashString64(buffer);
+            ASSERT_STREQ(buffer, (const char*) dmHashReverse64(hash, 0));
+        }
+    }
+    ASSERT_EQ(memory_usage, dmHashReverseMemoryUsage());
+}
+
 TEST_F(dlib, HashIncrementalRelease)
 {
     for(uint32_t i = 0; i < 2; ++i)
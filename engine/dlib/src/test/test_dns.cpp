@@ -0,0 +1,150 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include <stdint.h>
+#include <dlib/dstrings.h>
+#include <dlib/socket.h>
+#include <dlib/time.h>
+#include "../dlib/dns.h"
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+template <> char* jc_test_print_value(char* buffer, size_t buffer_len, dmSocket::Result r) {
+    return buffer + dmSnPrintf(buffer, buffer_len, "%s", dmSocket::ResultToString(r));
+}
+
+static dmSocket::Result Wait(dmDNS::HRequest request, dmSocket::Address* address)
+{
+    dmSocket::Result r;
+    for (int i = 0; i < 5000; ++i)
+    {
+        r = dmDNS::GetResult(request, address);
+        if (r != dmSocket::RESULT_WOULDBLOCK)
+            break;
+        dmTime::Sleep(1000);
+    }
+    return r;
+}
+
+class dmDNSTest : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        dmDNS::ClearCache();
+    }
+};
+
+TEST_F(dmDNSTest, Localhost)
+{
+    dmSocket::Address address;
+    dmDNS::HRequest request = dmDNS::Resolve("localhost", true, false);
+    ASSERT_NE((dmDNS::HRequest)0, request);
+    ASSERT_EQ(dmSocket::RESULT_OK, Wait(request, &address));
+    ASSERT_EQ(dmSocket::DOMAIN_IPV4, address.m_family);
+    dmDNS::Release(request);
+}
+
+TEST_F(dmDNSTest, NumericAddress)
+{
+    dmSocket::Address address;
+    dmDNS::HRequest request = dmDNS::Resolve("127.0.0.1", true, false);
+    // Numeric addresses never wait for a worker
+    ASSERT_EQ(dmSocket::RESULT_OK, dmDNS::GetResult(request, &address));
+    ASSERT_EQ(dmSocket::DOMAIN_IPV4, address.m_family);
+    ASSERT_EQ(dmSocket::AddressFromIPString("127.0.0.1"), address);
+    dmDNS::Release(request);
+}
+
+TEST_F(dmDNSTest, SharedLookup)
+{
+    dmDNS::HRequest request1 = dmDNS::Resolve("localhost", true, false);
+    dmDNS::HRequest request2 = dmDNS::Resolve("localhost", true, false);
+    ASSERT_EQ(request1, request2);
+
+    // Different address families are different lookups
+    dmDNS::HRequest request3 = dmDNS::Resolve("localhost", false, true);
+    ASSERT_NE(request1, request3);
+
+    dmSocket::Address address;
+    ASSERT_EQ(dmSocket::RESULT_OK, Wait(request1, &address));
+    dmDNS::Release(request1);
+    ASSERT_EQ(dmSocket::RESULT_OK, Wait(request2, &address));
+    dmDNS::Release(request2);
+    Wait(request3, &address);
+    dmDNS::Release(request3);
+}
+
+TEST_F(dmDNSTest, Cached)
+{
+    dmSocket::Address address1, address2;
+    dmDNS::HRequest request = dmDNS::Resolve("localhost", true, false);
+    ASSERT_EQ(dmSocket::RESULT_OK, Wait(request, &address1));
+    dmDNS::Release(request);
+
+    // The finished lookup is kept in the cache, and the result is available immediately
+    request = dmDNS::Resolve("localhost", true, false);
+    ASSERT_EQ(dmSocket::RESULT_OK, dmDNS::GetResult(request, &address2));
+    ASSERT_EQ(address1, address2);
+    dmDNS::Release(request);
+
+    dmDNS::ClearCache();
+    request = dmDNS::Resolve("localhost", true, false);
+    ASSERT_EQ(dmSocket::RESULT_OK, Wait(request, &address2));
+    dmDNS::Release(request);
+}
+
+TEST_F(dmDNSTest, NotFound)
+{
+    dmSocket::Address address;
+    dmDNS::HRequest request = dmDNS::Resolve("localhost.invalid", true, false);
+    ASSERT_EQ(dmSocket::RESULT_HOST_NOT_FOUND, Wait(request, &address));
+    dmDNS::Release(request);
+
+    // Failed lookups are cached as well
+    request = dmDNS::Resolve("localhost.invalid", true, false);
+    ASSERT_EQ(dmSocket::RESULT_HOST_NOT_FOUND, dmDNS::GetResult(request, &address));
+    dmDNS::Release(request);
+}
+
+TEST_F(dmDNSTest, GetHostByName)
+{
+    dmSocket::Address address;
+    ASSERT_EQ(dmSocket::RESULT_OK, dmDNS::GetHostByName("localhost", &address, 5 * 1000000, 0, true, false));
+    ASSERT_EQ(dmSocket::DOMAIN_IPV4, address.m_family);
+
+    // A cached result is returned even if the call is cancelled
+    int cancel = 1;
+    ASSERT_EQ(dmSocket::RESULT_OK, dmDNS::GetHostByName("localhost", &address, 0, &cancel, true, false));
+}
+
+TEST_F(dmDNSTest, GetHostByNameCancel)
+{
+    dmSocket::Address address;
+    int cancel = 1;
+    dmSocket::Result r = dmDNS::GetHostByName("cancel.localhost.invalid", &address, 0, &cancel, true, false);
+    // The lookup may finish before the first check of the flag
+    ASSERT_TRUE(r == dmSocket::RESULT_TIMEDOUT || r == dmSocket::RESULT_HOST_NOT_FOUND);
+}
+
+int main(int argc, char **argv)
+{
+    dmSocket::Initialize();
+    jc_test_init(&argc, argv);
+    int ret = jc_test_run_all();
+    dmSocket::Finalize();
+    return ret;
+}
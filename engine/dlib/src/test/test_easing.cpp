@@ -108,6 +108,23 @@ TEST(dmEasing, CurstomCurve)
     }
 }
 
+TEST(dmEasing, GetValues)
+{
+    const uint32_t count = 103;
+    float t[count];
+    float values[count];
+    for (uint32_t i = 0; i < count; ++i) {
+        t[i] = i / 100.0f - 0.01f; // includes samples outside [0,1]
+    }
+
+    for (uint32_t type = 0; type < dmEasing::TYPE_FLOAT_VECTOR; ++type) {
+        dmEasing::GetValues((dmEasing::Type) type, t, values, count);
+        for (uint32_t i = 0; i < count; ++i) {
+            ASSERT_NEAR(dmEasing::GetValue((dmEasing::Type) type, t[i]), values[i], 0.00001f);
+        }
+    }
+}
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);
@@ -0,0 +1,188 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <map>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+#include "dlib/flat_hashtable.h"
+
+TEST(dmFlatHashTable, EmptyConstructor)
+{
+    dmFlatHashTable32<int> ht;
+
+    EXPECT_EQ(0U, ht.Size());
+    EXPECT_EQ(0U, ht.Capacity());
+    EXPECT_TRUE(ht.Full());
+    EXPECT_TRUE(ht.Empty());
+    EXPECT_EQ(0, ht.Get(1));
+}
+
+TEST(dmFlatHashTable, SimplePut)
+{
+    dmFlatHashTable<uint32_t, uint32_t> ht;
+    ht.SetCapacity(10, 10);
+    ht.Put(12, 23);
+
+    uint32_t* val = ht.Get(12);
+    ASSERT_NE((uintptr_t) 0, (uintptr_t) val);
+    EXPECT_EQ((uint32_t) 23, *val);
+
+    ht.Put(12, 24);
+    EXPECT_EQ(1U, ht.Size());
+    EXPECT_EQ((uint32_t) 24, *ht.Get(12));
+    ht.Verify();
+}
+
+TEST(dmFlatHashTable, FillAndErase)
+{
+    const uint32_t count = 1000;
+    dmFlatHashTable64<uint32_t> ht;
+    ht.SetCapacity(count);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ht.Put(i, i * 2);
+    }
+    ASSERT_TRUE(ht.Full());
+    ht.Verify();
+
+    // Erasing and reinserting must reuse the tombstones rather than running out of slots
+    for (uint32_t iter = 0; iter < 10; ++iter)
+    {
+        for (uint32_t i = 0; i < count; i += 2)
+        {
+            ht.Erase(i + iter * count);
+        }
+        ht.Verify();
+        for (uint32_t i = 0; i < count; i += 2)
+        {
+            ASSERT_EQ(0, ht.Get(i + iter * count));
+            ht.Put(i + (iter + 1) * count, i);
+        }
+        ht.Verify();
+        ASSERT_TRUE(ht.Full());
+    }
+}
+
+TEST(dmFlatHashTable, Grow)
+{
+    dmFlatHashTable64<uint64_t> ht;
+    uint64_t key = 0x12345678;
+    for (uint32_t i = 0; i < 5000; ++i)
+    {
+        if (ht.Full())
+        {
+            ht.SetCapacity(ht.Capacity() + 64);
+        }
+        ht.Put(key * (i + 1), i);
+    }
+    ht.Verify();
+    for (uint32_t i = 0; i < 5000; ++i)
+    {
+        uint64_t* value = ht.Get(key * (i + 1));
+        ASSERT_NE((uintptr_t) 0, (uintptr_t) value);
+        ASSERT_EQ(i, *value);
+    }
+}
+
+static void IterateCallback(uint32_t* sum, const uint64_t* key, uint32_t* value)
+{
+    *sum += *value;
+}
+
+TEST(dmFlatHashTable, Iterate)
+{
+    dmFlatHashTable64<uint32_t> ht;
+    ht.SetCapacity(100);
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        ht.Put(i * 7919, i);
+        expected += i;
+    }
+    ht.Erase(7919);
+    expected -= 1;
+
+    uint32_t sum = 0;
+    ht.Iterate(IterateCallback, &sum);
+    ASSERT_EQ(expected, sum);
+
+    sum = 0;
+    uint32_t n = 0;
+    dmFlatHashTable64<uint32_t>::Iterator iter = ht.GetIterator();
+    while (iter.Next())
+    {
+        ASSERT_EQ(iter.GetKey(), iter.GetValue() * 7919);
+        sum += iter.GetValue();
+        n++;
+    }
+    ASSERT_EQ(expected, sum);
+    ASSERT_EQ(99U, n);
+
+    ht.Clear();
+    ASSERT_TRUE(ht.Empty());
+    ASSERT_FALSE(ht.GetIterator().Next());
+}
+
+TEST(dmFlatHashTable, Random)
+{
+    srand(42);
+    std::map<uint32_t, uint32_t> reference;
+    dmFlatHashTable32<uint32_t> ht;
+    ht.SetCapacity(512);
+
+    for (uint32_t i = 0; i < 100000; ++i)
+    {
+        // Small key range to get plenty of collisions, overwrites and erases
+        uint32_t key = rand() % 1024;
+        if (rand() % 2 == 0 && !ht.Full())
+        {
+            ht.Put(key, i);
+            reference[key] = i;
+        }
+        else if (reference.find(key) != reference.end())
+        {
+            ht.Erase(key);
+            reference.erase(key);
+        }
+        ASSERT_EQ((uint32_t) reference.size(), ht.Size());
+    }
+    ht.Verify();
+
+    for (uint32_t key = 0; key < 1024; ++key)
+    {
+        std::map<uint32_t, uint32_t>::iterator it = reference.find(key);
+        uint32_t* value = ht.Get(key);
+        if (it == reference.end())
+        {
+            ASSERT_EQ(0, value);
+        }
+        else
+        {
+            ASSERT_NE((uintptr_t) 0, (uintptr_t) value);
+            ASSERT_EQ(it->second, *value);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
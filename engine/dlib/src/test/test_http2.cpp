@@ -0,0 +1,391 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <dlib/array.h>
+#include <dlib/http2.h>
+#include <dlib/http2_hpack.h>
+#include <dlib/network_constants.h>
+#include <dlib/socket.h>
+#include <dlib/thread.h>
+#include <dlib/time.h>
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+typedef std::vector<std::pair<std::string, std::string> > Headers;
+
+static void CollectHeader(void* ctx, const char* name, const char* value)
+{
+    ((Headers*)ctx)->push_back(std::make_pair(std::string(name), std::string(value)));
+}
+
+static void FromHex(const char* hex, dmArray<uint8_t>& out)
+{
+    uint32_t n = strlen(hex) / 2;
+    out.SetCapacity(n);
+    out.SetSize(0);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        char byte[3] = { hex[i*2], hex[i*2+1], 0 };
+        out.Push((uint8_t)strtol(byte, 0, 16));
+    }
+}
+
+static bool Decode(dmHttp2::HpackDecoder* decoder, const char* hex, Headers* headers)
+{
+    dmArray<uint8_t> block;
+    FromHex(hex, block);
+    headers->clear();
+    return dmHttp2::HpackDecode(decoder, block.Begin(), block.Size(), CollectHeader, headers);
+}
+
+#define ASSERT_HEADER(_HEADERS, _INDEX, _NAME, _VALUE) \
+    ASSERT_STREQ(_NAME, (_HEADERS)[_INDEX].first.c_str()); \
+    ASSERT_STREQ(_VALUE, (_HEADERS)[_INDEX].second.c_str());
+
+// RFC 7541, C.3: Requests without Huffman coding
+TEST(dmHttp2, HpackDecodeRequests)
+{
+    dmHttp2::HpackDecoder decoder;
+    Headers headers;
+
+    ASSERT_TRUE(Decode(&decoder, "828684410f7777772e6578616d706c652e636f6d", &headers));
+    ASSERT_EQ(4U, headers.size());
+    ASSERT_HEADER(headers, 0, ":method", "GET");
+    ASSERT_HEADER(headers, 1, ":scheme", "http");
+    ASSERT_HEADER(headers, 2, ":path", "/");
+    ASSERT_HEADER(headers, 3, ":authority", "www.example.com");
+    ASSERT_EQ(57U, decoder.m_TableSize);
+
+    ASSERT_TRUE(Decode(&decoder, "828684be58086e6f2d6361636865", &headers));
+    ASSERT_EQ(5U, headers.size());
+    ASSERT_HEADER(headers, 3, ":authority", "www.example.com");
+    ASSERT_HEADER(headers, 4, "cache-control", "no-cache");
+    ASSERT_EQ(110U, decoder.m_TableSize);
+
+    ASSERT_TRUE(Decode(&decoder, "828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565", &headers));
+    ASSERT_EQ(5U, headers.size());
+    ASSERT_HEADER(headers, 1, ":scheme", "https");
+    ASSERT_HEADER(headers, 2, ":path", "/index.html");
+    ASSERT_HEADER(headers, 3, ":authority", "www.example.com");
+    ASSERT_HEADER(headers, 4, "custom-key", "custom-value");
+    ASSERT_EQ(164U, decoder.m_TableSize);
+}
+
+// RFC 7541, C.4: Requests with Huffman coding
+TEST(dmHttp2, HpackDecodeHuffman)
+{
+    dmHttp2::HpackDecoder decoder;
+    Headers headers;
+
+    ASSERT_TRUE(Decode(&decoder, "828684418cf1e3c2e5f23a6ba0ab90f4ff", &headers));
+    ASSERT_EQ(4U, headers.size());
+    ASSERT_HEADER(headers, 3, ":authority", "www.example.com");
+
+    ASSERT_TRUE(Decode(&decoder, "828684be5886a8eb10649cbf", &headers));
+    ASSERT_EQ(5U, headers.size());
+    ASSERT_HEADER(headers, 4, "cache-control", "no-cache");
+
+    ASSERT_TRUE(Decode(&decoder, "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf", &headers));
+    ASSERT_EQ(5U, headers.size());
+    ASSERT_HEADER(headers, 4, "custom-key", "custom-value");
+    ASSERT_EQ(164U, decoder.m_TableSize);
+}
+
+// RFC 7541, C.6: Responses with Huffman coding, and a 256 byte table to test the evictions
+TEST(dmHttp2, HpackDecodeEviction)
+{
+    dmHttp2::HpackDecoder decoder;
+    decoder.m_MaxTableSize = 256;
+    Headers headers;
+
+    ASSERT_TRUE(Decode(&decoder, "488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c78f0b97c8e9ae82ae43d3", &headers));
+    ASSERT_EQ(4U, headers.size());
+    ASSERT_HEADER(headers, 0, ":status", "302");
+    ASSERT_HEADER(headers, 1, "cache-control", "private");
+    ASSERT_HEADER(headers, 2, "date", "Mon, 21 Oct 2013 20:13:21 GMT");
+    ASSERT_HEADER(headers, 3, "location", "https://www.example.com");
+    ASSERT_EQ(222U, decoder.m_TableSize);
+
+    ASSERT_TRUE(Decode(&decoder, "4883640effc1c0bf", &headers));
+    ASSERT_EQ(4U, headers.size());
+    ASSERT_HEADER(headers, 0, ":status", "307");
+    ASSERT_HEADER(headers, 3, "location", "https://www.example.com");
+    ASSERT_EQ(222U, decoder.m_TableSize);
+    ASSERT_EQ(4U, decoder.m_Table.Size());
+}
+
+TEST(dmHttp2, HpackDecodeErrors)
+{
+    dmHttp2::HpackDecoder decoder;
+    Headers headers;
+
+    ASSERT_FALSE(Decode(&decoder, "80", &headers));            // Index 0
+    ASSERT_FALSE(Decode(&decoder, "be", &headers));            // Empty dynamic table
+    ASSERT_FALSE(Decode(&decoder, "410f7777", &headers));      // Truncated string
+    ASSERT_FALSE(Decode(&decoder, "ffffffffffffff", &headers)); // Integer overflow
+    ASSERT_FALSE(Decode(&decoder, "8240", &headers));          // Truncated literal
+    ASSERT_FALSE(Decode(&decoder, "823f", &headers));          // Table size update after a header
+    ASSERT_FALSE(Decode(&decoder, "0081ff0000", &headers));    // Huffman padding longer than 7 bits
+}
+
+TEST(dmHttp2, HpackEncode)
+{
+    dmArray<uint8_t> block;
+    dmHttp2::HpackEncode(block, ":method", "GET");
+    dmHttp2::HpackEncode(block, ":scheme", "https");
+    dmHttp2::HpackEncode(block, ":path", "/archive/data.zip");
+    dmHttp2::HpackEncode(block, ":authority", "www.example.com");
+    dmHttp2::HpackEncode(block, "x-defold-test", "a value that is longer than one hundred and twenty seven bytes, so that the length needs more than the seven bits of the prefix");
+
+    dmHttp2::HpackDecoder decoder;
+    Headers headers;
+    ASSERT_TRUE(dmHttp2::HpackDecode(&decoder, block.Begin(), block.Size(), CollectHeader, &headers));
+    ASSERT_EQ(5U, headers.size());
+    ASSERT_HEADER(headers, 0, ":method", "GET");
+    ASSERT_HEADER(headers, 1, ":scheme", "https");
+    ASSERT_HEADER(headers, 2, ":path", "/archive/data.zip");
+    ASSERT_HEADER(headers, 3, ":authority", "www.example.com");
+    ASSERT_HEADER(headers, 4, "x-defold-test", "a value that is longer than one hundred and twenty seven bytes, so that the length needs more than the seven bits of the prefix");
+
+    // Nothing is added to the dynamic table of the peer
+    ASSERT_EQ(0U, decoder.m_Table.Size());
+    ASSERT_EQ(0x82, block[0]);
+    ASSERT_EQ(0x87, block[1]);
+}
+
+// A minimal HTTP/2 server, which answers the requests in reverse order once it has got them all
+struct TestServer
+{
+    dmSocket::Socket    m_Listen;
+    uint16_t            m_Port;
+    uint32_t            m_NumRequests;
+    bool                m_SettingsAcked;
+    bool                m_GotGoAway;
+};
+
+static bool ServerRecv(dmSocket::Socket socket, uint8_t* buffer, uint32_t size)
+{
+    while (size > 0)
+    {
+        int received = 0;
+        dmSocket::Result r = dmSocket::Receive(socket, buffer, size, &received);
+        if (r == dmSocket::RESULT_WOULDBLOCK || r == dmSocket::RESULT_TRY_AGAIN)
+            continue;
+        if (r != dmSocket::RESULT_OK || received == 0)
+            return false;
+        buffer += received;
+        size -= received;
+    }
+    return true;
+}
+
+static void ServerSendFrame(dmSocket::Socket socket, uint8_t type, uint8_t flags, uint32_t stream, const void* payload, uint32_t size)
+{
+    uint8_t h[9] = { (uint8_t)(size >> 16), (uint8_t)(size >> 8), (uint8_t)size, type, flags,
+                     (uint8_t)(stream >> 24), (uint8_t)(stream >> 16), (uint8_t)(stream >> 8), (uint8_t)stream };
+    int sent;
+    dmSocket::Send(socket, h, sizeof(h), &sent);
+    if (size > 0)
+        dmSocket::Send(socket, payload, size, &sent);
+}
+
+static void CollectPath(void* ctx, const char* name, const char* value)
+{
+    if (strcmp(name, ":path") == 0)
+        *(std::string*)ctx = value;
+}
+
+static void ServerThread(void* arg)
+{
+    TestServer* server = (TestServer*)arg;
+    dmSocket::Socket socket;
+    dmSocket::Address address;
+    if (dmSocket::Accept(server->m_Listen, &address, &socket) != dmSocket::RESULT_OK)
+        return;
+
+    uint8_t preface[24];
+    ServerRecv(socket, preface, sizeof(preface));
+    if (memcmp(preface, "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n", sizeof(preface)) != 0)
+    {
+        dmSocket::Delete(socket);
+        return;
+    }
+
+    const uint8_t settings[] = { 0, 3, 0, 0, 0, 10 }; // SETTINGS_MAX_CONCURRENT_STREAMS
+    ServerSendFrame(socket, 4, 0, 0, settings, sizeof(settings));
+
+    dmHttp2::HpackDecoder decoder;
+    std::vector<std::pair<uint32_t, std::string> > requests;
+    uint8_t payload[16384];
+    uint8_t h[9];
+    while (ServerRecv(socket, h, sizeof(h)))
+    {
+        uint32_t length = (h[0] << 16) | (h[1] << 8) | h[2];
+        uint32_t stream = ((h[5] & 0x7f) << 24) | (h[6] << 16) | (h[7] << 8) | h[8];
+        if (length > sizeof(payload) || !ServerRecv(socket, payload, length))
+            break;
+
+        if (h[3] == 4 && (h[4] & 1)) // SETTINGS ack
+            server->m_SettingsAcked = true;
+        else if (h[3] == 4)
+            ServerSendFrame(socket, 4, 1, 0, 0, 0);
+        else if (h[3] == 7) // GOAWAY
+            server->m_GotGoAway = true;
+        else if (h[3] == 1) // HEADERS, always with END_HEADERS and END_STREAM here
+        {
+            std::string path;
+            dmHttp2::HpackDecode(&decoder, payload, length, CollectPath, &path);
+            requests.push_back(std::make_pair(stream, path));
+            if (requests.size() == server->m_NumRequests)
+            {
+                for (int i = (int)requests.size() - 1; i >= 0; --i)
+                {
+                    uint32_t id = requests[i].first;
+                    if (requests[i].second == "/refuse")
+                    {
+                        const uint8_t refused[] = { 0, 0, 0, 7 };
+                        ServerSendFrame(socket, 3, 0, id, refused, sizeof(refused));
+                        continue;
+                    }
+                    std::string body = "response" + requests[i].second;
+                    dmArray<uint8_t> block;
+                    dmHttp2::HpackEncode(block, ":status", "200");
+                    dmHttp2::HpackEncode(block, "content-type", "text/plain");
+                    ServerSendFrame(socket, 1, 4, id, block.Begin(), block.Size());
+                    // Two DATA frames, the first one padded
+                    uint8_t padded[64];
+                    padded[0] = 3;
+                    memcpy(padded + 1, body.c_str(), 4);
+                    memset(padded + 5, 0, 3);
+                    ServerSendFrame(socket, 0, 0x8, id, padded, 8);
+                    ServerSendFrame(socket, 0, 1, id, body.c_str() + 4, body.size() - 4);
+                }
+            }
+        }
+    }
+
+    dmSocket::Delete(socket);
+}
+
+static std::string ReceiveBody(dmHttp2::HSession session, dmHttp2::HStream stream)
+{
+    std::string body;
+    uint64_t start = dmTime::GetTime();
+    while (dmTime::GetTime() - start < 5000000)
+    {
+        char buffer[4];
+        uint32_t received;
+        bool end;
+        dmHttp2::Result r = dmHttp2::ReceiveData(session, stream, buffer, sizeof(buffer), &received, &end);
+        if (r == dmHttp2::RESULT_WOULDBLOCK)
+            continue;
+        if (r != dmHttp2::RESULT_OK)
+            break;
+        body.append(buffer, received);
+        if (end)
+            break;
+    }
+    return body;
+}
+
+static dmHttp2::Result WaitForHeaders(dmHttp2::HSession session, dmHttp2::HStream stream, int* status, Headers* headers)
+{
+    uint64_t start = dmTime::GetTime();
+    dmHttp2::Result r = dmHttp2::RESULT_WOULDBLOCK;
+    while (r == dmHttp2::RESULT_WOULDBLOCK && dmTime::GetTime() - start < 5000000)
+    {
+        r = dmHttp2::ReceiveHeaders(session, stream, status, CollectHeader, headers);
+    }
+    return r;
+}
+
+TEST(dmHttp2, Session)
+{
+    TestServer server;
+    server.m_NumRequests = 3;
+    server.m_SettingsAcked = false;
+    server.m_GotGoAway = false;
+
+    dmSocket::Address address;
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::GetHostByName(DM_LOOPBACK_ADDRESS_IPV4, &address, true, false));
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::New(address.m_family, dmSocket::TYPE_STREAM, dmSocket::PROTOCOL_TCP, &server.m_Listen));
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::Bind(server.m_Listen, address, 0));
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::GetName(server.m_Listen, &address, &server.m_Port));
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::Listen(server.m_Listen, 10));
+    dmThread::Thread thread = dmThread::New(&ServerThread, 0x80000, (void*)&server, "server");
+
+    dmSocket::Socket socket;
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::New(address.m_family, dmSocket::TYPE_STREAM, dmSocket::PROTOCOL_TCP, &socket));
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::Connect(socket, address, server.m_Port));
+
+    dmHttp2::HSession session = dmHttp2::New(socket, 0);
+    ASSERT_NE((dmHttp2::HSession)0, session);
+    ASSERT_TRUE(dmHttp2::IsUsable(session));
+
+    const char* paths[] = { "/a", "/refuse", "/b" };
+    dmHttp2::HStream streams[3];
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        dmHttp2::Header headers[] = {
+            { ":method", "GET" },
+            { ":scheme", "http" },
+            { ":authority", "localhost" },
+            { ":path", paths[i] },
+        };
+        ASSERT_EQ(dmHttp2::RESULT_OK, dmHttp2::OpenStream(session, headers, 4, true, &streams[i]));
+    }
+    ASSERT_EQ(1U, streams[0]);
+    ASSERT_EQ(3U, streams[1]);
+    ASSERT_EQ(5U, streams[2]);
+
+    // The responses arrive in reverse order, over the same connection
+    int status = 0;
+    Headers headers;
+    ASSERT_EQ(dmHttp2::RESULT_OK, WaitForHeaders(session, streams[0], &status, &headers));
+    ASSERT_EQ(200, status);
+    ASSERT_EQ(1U, headers.size());
+    ASSERT_HEADER(headers, 0, "content-type", "text/plain");
+    ASSERT_STREQ("response/a", ReceiveBody(session, streams[0]).c_str());
+
+    headers.clear();
+    ASSERT_EQ(dmHttp2::RESULT_OK, WaitForHeaders(session, streams[2], &status, &headers));
+    ASSERT_STREQ("response/b", ReceiveBody(session, streams[2]).c_str());
+
+    ASSERT_EQ(dmHttp2::RESULT_REFUSED, WaitForHeaders(session, streams[1], &status, &headers));
+
+    for (uint32_t i = 0; i < 3; ++i)
+        dmHttp2::CloseStream(session, streams[i]);
+
+    ASSERT_TRUE(dmHttp2::IsAlive(session));
+    dmHttp2::Delete(session);
+    dmSocket::Shutdown(socket, dmSocket::SHUTDOWNTYPE_READWRITE);
+    dmSocket::Delete(socket);
+
+    dmThread::Join(thread);
+    dmSocket::Delete(server.m_Listen);
+
+    ASSERT_TRUE(server.m_SettingsAcked);
+    ASSERT_TRUE(server.m_GotGoAway);
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
@@ -72,21 +72,18 @@ public:
     dmHttpCache::Result Get(dmHttpCache::HCache cache, const char* uri, const char* etag, void** content, uint64_t* checksum, uint32_t* size_out = 0)
     {
         FILE* f = 0;
+        uint32_t size = 0;
         dmHttpCache::Result r;
-        r = dmHttpCache::Get(cache, uri, etag, &f, 0, checksum);
+        r = dmHttpCache::Get(cache, uri, etag, &f, &size, checksum);
         if (r != dmHttpCache::RESULT_OK)
             return r;
 
-        fseek(f, 0, SEEK_END);
-        size_t size = ftell(f);
-        fseek(f, 0, SEEK_SET);
-
         void* buffer = malloc(size);
         size_t n_read = fread(buffer, 1, size, f);
         // ... not ASSERT_EQ here due to
         // ...assertions that generate a fatal failure (FAIL* and ASSERT_*) can only be used in void-returning functions...
         // http://code.google.com/p/googletest/wiki/AdvancedGuide
-        EXPECT_EQ(size, n_read);
+        EXPECT_EQ(size, (uint32_t) n_read);
         *content = buffer;
         if (size_out)
             *size_out = size;
@@ -263,12 +260,17 @@ static void CorruptFile(void*, const char* path, bool isdir)
     fclose(f);
 }
 
-static void CorruptDirs(void* ctx, const char* path, bool isdir)
+static bool IsSlabFile(const char* path)
 {
     const char* basename = strrchr(path, '/');
-    if (isdir && basename && strlen(basename+1) == 2)
+    return basename && strncmp(basename+1, "slab", 4) == 0;
+}
+
+static void CorruptSlabs(void* ctx, const char* path, bool isdir)
+{
+    if (!isdir && IsSlabFile(path))
     {
-        dmSys::IterateTree(path, false, false, ctx, CorruptFile);
+        CorruptFile(ctx, path, isdir);
     }
 }
 
@@ -302,7 +304,7 @@ TEST_F(dmHttpCacheTest, CorruptContent)
 
     ASSERT_EQ(1U, dmHttpCache::GetEntryCount(cache));
 
-    dmSys::IterateTree(m_Path, false, false, 0, CorruptDirs);
+    dmSys::IterateTree(m_Path, false, false, 0, CorruptSlabs);
 
     // Get content, ensure that the checksum is incorrect
     r = Get(cache, "uri", "etag", &buffer, &checksum, &size);
@@ -316,19 +318,11 @@ TEST_F(dmHttpCacheTest, CorruptContent)
     ASSERT_EQ(dmHttpCache::RESULT_OK, r);
 }
 
-static void MissingContent_File(void*, const char* path, bool isdir)
+static void MissingContent_Slabs(void*, const char* path, bool isdir)
 {
-    if (isdir)
-        return;
-    dmSys::Unlink(path);
-}
-
-static void MissingContent_Dirs(void* ctx, const char* path, bool isdir)
-{
-    const char* basename = strrchr(path, '/');
-    if (isdir && basename && strlen(basename+1) == 2)
+    if (!isdir && IsSlabFile(path))
     {
-        dmSys::IterateTree(path, false, false, ctx, MissingContent_File);
+        dmSys::Unlink(path);
     }
 }
 
@@ -362,9 +356,15 @@ TEST_F(dmHttpCacheTest, MissingContent)
 
     ASSERT_EQ(1U, dmHttpCache::GetEntryCount(cache));
 
-    dmSys::IterateTree(m_Path, false, false, 0, MissingContent_Dirs);
+    r = dmHttpCache::Close(cache);
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
 
-    // Get content, ensure that the checksum is incorrect
+    dmSys::IterateTree(m_Path, false, false, 0, MissingContent_Slabs);
+
+    r = dmHttpCache::Open(&params, &cache);
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+
+    // Get content, ensure that the entry is removed
     r = Get(cache, "uri", "etag", &buffer, &checksum, &size);
     ASSERT_EQ(dmHttpCache::RESULT_NO_ENTRY, r);
     ASSERT_EQ(0U, dmHttpCache::GetEntryCount(cache));
@@ -764,6 +764,139 @@ TEST_F(dmHttpCacheTest, Persist)
     dmHttpCache::Close(cache);
 }
 
+TEST_F(dmHttpCacheTest, ManyEntries)
+{
+    dmHttpCache::HCache cache;
+    dmHttpCache::NewParams params;
+    params.m_Path = m_Path;
+    dmHttpCache::Result r = dmHttpCache::Open(&params, &cache);
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+
+    const uint32_t count = 1000;
+    char uri[32];
+    char data[32];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmSnPrintf(uri, sizeof(uri), "uri%u", i);
+        dmSnPrintf(data, sizeof(data), "data%u", i);
+        r = Put(cache, uri, "etag", data, strlen(data));
+        ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+    }
+    ASSERT_EQ(count, dmHttpCache::GetEntryCount(cache));
+
+    dmHttpCache::Close(cache);
+    r = dmHttpCache::Open(&params, &cache);
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+    ASSERT_EQ(count, dmHttpCache::GetEntryCount(cache));
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmSnPrintf(uri, sizeof(uri), "uri%u", i);
+        dmSnPrintf(data, sizeof(data), "data%u", i);
+
+        void* buffer = 0;
+        uint64_t checksum;
+        uint32_t size;
+        r = Get(cache, uri, "etag", &buffer, &checksum, &size);
+        ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+        ASSERT_EQ(dmHashString64(data), checksum);
+        ASSERT_EQ(strlen(data), size);
+        ASSERT_TRUE(memcmp(data, buffer, size) == 0);
+        free(buffer);
+    }
+
+    dmHttpCache::Close(cache);
+}
+
+TEST_F(dmHttpCacheTest, VerifyContent)
+{
+    dmHttpCache::HCache cache;
+    dmHttpCache::NewParams params;
+    params.m_Path = m_Path;
+    dmHttpCache::Result r = dmHttpCache::Open(&params, &cache);
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+
+    // The entries are stored in different slabs
+    r = Put(cache, "uri1", "etag1", "data1", strlen("data1"));
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+    r = Put(cache, "uri2", "etag2", "data2", strlen("data2"));
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+    dmHttpCache::Close(cache);
+
+    char path[1024];
+    dmSnPrintf(path, sizeof(path), "%s/slab0", m_Path);
+    CorruptFile(0, path, false);
+
+    params.m_VerifyContent = 1;
+    r = dmHttpCache::Open(&params, &cache);
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+
+    for (int i = 0; i < 500 && dmHttpCache::IsVerifyingContent(cache); ++i)
+    {
+        dmTime::Sleep(10 * 1000);
+    }
+    ASSERT_FALSE(dmHttpCache::IsVerifyingContent(cache));
+    ASSERT_EQ(1U, dmHttpCache::GetEntryCount(cache));
+
+    void* buffer = 0;
+    uint64_t checksum;
+    r = Get(cache, "uri1", "etag1", &buffer, &checksum);
+    ASSERT_EQ(dmHttpCache::RESULT_NO_ENTRY, r);
+
+    r = Get(cache, "uri2", "etag2", &buffer, &checksum);
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+    ASSERT_EQ(dmHashString64("data2"), checksum);
+    free(buffer);
+
+    dmHttpCache::Close(cache);
+}
+
+TEST_F(dmHttpCacheTest, CompactSlabs)
+{
+    dmHttpCache::HCache cache;
+    dmHttpCache::NewParams params;
+    params.m_Path = m_Path;
+    dmHttpCache::Result r = dmHttpCache::Open(&params, &cache);
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+
+    const uint32_t data_size = 3 * 1024 * 1024 / 2;
+    char* data = (char*) malloc(data_size);
+    for (uint32_t i = 0; i < data_size; ++i)
+        data[i] = (char) i;
+
+    // The first version ends up in the first slab, and is unused after the update
+    r = Put(cache, "uri", "etag1", data, data_size);
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+    data[0] = 'x';
+    r = Put(cache, "uri", "etag2", data, data_size);
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+    dmHttpCache::Close(cache);
+
+    char path[1024];
+    dmSnPrintf(path, sizeof(path), "%s/slab0", m_Path);
+    dmSys::StatInfo info;
+    ASSERT_EQ(dmSys::RESULT_OK, dmSys::Stat(path, &info));
+    ASSERT_EQ(data_size, (uint32_t) info.m_Size);
+
+    r = dmHttpCache::Open(&params, &cache);
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+    ASSERT_EQ(dmSys::RESULT_OK, dmSys::Stat(path, &info));
+    ASSERT_EQ(0U, (uint32_t) info.m_Size);
+
+    void* buffer = 0;
+    uint64_t checksum;
+    uint32_t size;
+    r = Get(cache, "uri", "etag2", &buffer, &checksum, &size);
+    ASSERT_EQ(dmHttpCache::RESULT_OK, r);
+    ASSERT_EQ(data_size, size);
+    ASSERT_EQ(dmHashBuffer64(data, data_size), checksum);
+    ASSERT_TRUE(memcmp(data, buffer, size) == 0);
+    free(buffer);
+    free(data);
+
+    dmHttpCache::Close(cache);
+}
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);
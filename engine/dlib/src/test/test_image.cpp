@@ -298,6 +298,73 @@ TEST(dmImage, case2319)
     dmImage::Free(&image);
 }
 
+// Checks the premultiplied and flipped image against the plain image
+static void CheckPremultFlip(const void* data, uint32_t data_size, bool premult, bool flip_vertically)
+{
+    dmImage::Image ref;
+    ASSERT_EQ(dmImage::RESULT_OK, dmImage::Load(data, data_size, false, false, &ref));
+    dmImage::Image image;
+    ASSERT_EQ(dmImage::RESULT_OK, dmImage::Load(data, data_size, premult, flip_vertically, &image));
+
+    uint32_t width, height;
+    dmImage::Type type;
+    ASSERT_EQ(dmImage::RESULT_OK, dmImage::GetInfo(data, data_size, &width, &height, &type));
+    ASSERT_EQ(ref.m_Width, width);
+    ASSERT_EQ(ref.m_Height, height);
+    ASSERT_EQ(ref.m_Type, type);
+
+    uint32_t bpp = dmImage::BytesPerPixel(type);
+    uint32_t size = width * height * bpp;
+    uint8_t* out = (uint8_t*) malloc(size);
+    dmImage::Image into;
+    ASSERT_EQ(dmImage::RESULT_OK, dmImage::LoadInto(data, data_size, premult, flip_vertically, out, size, &into));
+    ASSERT_EQ((void*) out, into.m_Buffer);
+
+    bool has_alpha = type == dmImage::TYPE_RGBA || type == dmImage::TYPE_LUMINANCE_ALPHA;
+    const uint8_t* src = (const uint8_t*) ref.m_Buffer;
+    const uint8_t* dst = (const uint8_t*) image.m_Buffer;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        uint32_t src_y = flip_vertically ? height - 1 - y : y;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const uint8_t* s = &src[(src_y * width + x) * bpp];
+            uint32_t alpha = s[bpp - 1];
+            for (uint32_t c = 0; c < bpp; ++c)
+            {
+                uint32_t expected = s[c];
+                if (premult && has_alpha && c != bpp - 1)
+                    expected = (expected * alpha + 255) >> 8;
+                uint32_t index = (y * width + x) * bpp + c;
+                ASSERT_EQ(expected, (uint32_t) dst[index]);
+                ASSERT_EQ(expected, (uint32_t) out[index]);
+            }
+        }
+    }
+
+    free(out);
+    dmImage::Free(&image);
+    dmImage::Free(&ref);
+}
+
+TEST(dmImage, PremultFlip)
+{
+    for (int iter = 0; iter < 4; iter++) {
+        bool premult = (iter & 1) != 0;
+        bool flip_vertically = (iter & 2) != 0;
+        CheckPremultFlip(COLOR_CHECK_2X2_PNG, COLOR_CHECK_2X2_PNG_SIZE, premult, flip_vertically);
+        CheckPremultFlip(GRAY_ALPHA_CHECK_2X2_PNG, GRAY_ALPHA_CHECK_2X2_PNG_SIZE, premult, flip_vertically);
+        CheckPremultFlip(CASE2319_JPG, CASE2319_JPG_SIZE, premult, flip_vertically);
+    }
+}
+
+TEST(dmImage, LoadIntoTooSmall)
+{
+    uint8_t out[4];
+    dmImage::Image image;
+    ASSERT_EQ(dmImage::RESULT_IMAGE_ERROR, dmImage::LoadInto(COLOR_CHECK_2X2_PNG, COLOR_CHECK_2X2_PNG_SIZE, false, false, out, sizeof(out), &image));
+}
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);
@@ -313,8 +313,54 @@ TEST(dmVMath, TestFrustumOBBCorners)
     }
 }
 
+TEST(dmVMath, TestFrustumWorldAABBs)
+{
+    dmVMath::Point3 cam_pos = dmVMath::Point3(0.0f, 0.0f, 0.0f);
+    dmVMath::Matrix4 view = Matrix4::lookAt(cam_pos, dmVMath::Point3(0.0f, 0.0f, -1.0f), dmVMath::Vector3(0,1,0));
+    dmVMath::Matrix4 proj = dmVMath::Matrix4::perspective(PER_FRUSTUM_FOV, PER_FRUSTUM_RATIO, PER_FRUSTUM_NEAR, PER_FRUSTUM_FAR);
+
+    dmIntersection::Frustum frustum;
+    dmIntersection::CreateFrustumFromMatrix(proj * view, true, 6, frustum);
+
+    // Not a multiple of the batch size, to also test the remainder
+    const uint32_t count = 255;
+    dmIntersection::WorldAABB boxes[count];
+    uint8_t results[count];
 
+    dmVMath::Vector3 min_point(-1.0f, -1.0f, -1.0f);
+    dmVMath::Vector3 max_point( 1.0f,  1.0f,  1.0f);
+    uint32_t visible_count = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        // A spiral of rotated boxes, going in and out of the frustum
+        float t = i * 0.1f;
+        dmVMath::Vector3 position(cosf(t) * t, sinf(t) * t, -t * 5.0f);
+        dmVMath::Matrix4 world = dmVMath::Matrix4::translation(position) * dmVMath::Matrix4::rotationZYX(dmVMath::Vector3(t, t * 2.0f, t * 3.0f)) * dmVMath::Matrix4::scale(dmVMath::Vector3(1.0f, 2.0f, 3.0f));
+        dmIntersection::CreateWorldAABB(world, min_point, max_point, boxes[i]);
+
+        // The box encloses the OBB, so it's never culled when the OBB is visible
+        if (dmIntersection::TestFrustumOBB(frustum, world, min_point, max_point))
+        {
+            ASSERT_TRUE(dmIntersection::TestFrustumWorldAABB(frustum, boxes[i]));
+        }
+    }
 
+    dmIntersection::TestFrustumWorldAABBs(frustum, boxes, count, results);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_EQ(dmIntersection::TestFrustumWorldAABB(frustum, boxes[i]) ? 1 : 0, results[i]);
+        visible_count += results[i];
+    }
+    ASSERT_LT(0u, visible_count);
+    ASSERT_GT(count, visible_count);
+
+    // An axis aligned box just outside and just inside the near plane
+    dmIntersection::WorldAABB box;
+    dmIntersection::CreateWorldAABB(dmVMath::Matrix4::translation(dmVMath::Vector3(0.0f, 0.0f, -PER_FRUSTUM_NEAR + 1.1f)), min_point, max_point, box);
+    ASSERT_FALSE(dmIntersection::TestFrustumWorldAABB(frustum, box));
+    dmIntersection::CreateWorldAABB(dmVMath::Matrix4::translation(dmVMath::Vector3(0.0f, 0.0f, -PER_FRUSTUM_NEAR + 0.9f)), min_point, max_point, box);
+    ASSERT_TRUE(dmIntersection::TestFrustumWorldAABB(frustum, box));
+}
 
 int main(int argc, char **argv)
 {
@@ -12,9 +12,11 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include <string.h>
 #include "dlib/job_thread.h"
 #include "dlib/array.h"
 #include "dlib/time.h"
+#include <dmsdk/dlib/atomic.h>
 
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
@@ -82,6 +84,182 @@ TEST(dmJobThread, PushJobsMultipleThreads)
     ASSERT_TRUE(tests_done);
 }
 
+struct DependencyContext
+{
+    int32_atomic_t  m_Counter;
+    int32_t         m_Order[64];
+};
+
+static int ProcessOrdered(void* context, void* data)
+{
+    DependencyContext* ctx = (DependencyContext*)context;
+    int32_t index = dmAtomicIncrement32(&ctx->m_Counter);
+    ctx->m_Order[(uintptr_t)data] = index;
+    return 1;
+}
+
+static int ProcessCount(void* context, void* data)
+{
+    dmAtomicIncrement32((int32_atomic_t*)context);
+    return 1;
+}
+
+static void CallbackCount(void* context, void* data, int result)
+{
+    (*(int*)data) += result;
+}
+
+static dmJobThread::HContext CreateContext(uint8_t thread_count)
+{
+    dmJobThread::JobThreadCreationParams params;
+    for (uint8_t i = 0; i < thread_count; ++i)
+        params.m_ThreadNames[i] = "DefoldTestJobThread";
+    params.m_ThreadCount = thread_count;
+    return dmJobThread::Create(params);
+}
+
+TEST(dmJobThread, Dependencies)
+{
+    dmJobThread::HContext ctx = CreateContext(4);
+
+    DependencyContext dctx;
+    dctx.m_Counter = 0;
+
+    // A chain where each job depends on the previous one
+    const uint32_t count = DM_ARRAY_SIZE(dctx.m_Order);
+    dmJobThread::HJob jobs[count];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        jobs[i] = dmJobThread::CreateJob(ctx, ProcessOrdered, 0, (void*)&dctx, (void*)(uintptr_t)i);
+        ASSERT_NE(dmJobThread::INVALID_JOB, jobs[i]);
+        if (i > 0)
+        {
+            ASSERT_TRUE(dmJobThread::AddDependency(ctx, jobs[i], jobs[i-1]));
+        }
+    }
+
+    // Push them in reverse order, to make sure they're held back by the dependencies
+    for (int32_t i = (int32_t)count - 1; i >= 0; --i)
+        dmJobThread::PushJob(ctx, jobs[i]);
+
+    dmJobThread::WaitForJob(ctx, jobs[count-1]);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_EQ((int32_t)i, dctx.m_Order[i]);
+        ASSERT_TRUE(dmJobThread::IsJobFinished(ctx, jobs[i]));
+    }
+
+    dmJobThread::Destroy(ctx);
+}
+
+TEST(dmJobThread, WaitForManyJobs)
+{
+    for (uint8_t thread_count = 0; thread_count <= 8; thread_count += 4)
+    {
+        dmJobThread::HContext ctx = CreateContext(thread_count);
+
+        int32_atomic_t counter = 0;
+        int callback_count = 0;
+
+        // All jobs are dependencies of a root job that does no processing
+        dmJobThread::HJob root = dmJobThread::CreateJob(ctx, 0, 0, 0, 0);
+        const uint32_t count = 2000;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            dmJobThread::HJob job = dmJobThread::CreateJob(ctx, ProcessCount, CallbackCount, (void*)&counter, (void*)&callback_count);
+            ASSERT_TRUE(dmJobThread::AddDependency(ctx, root, job));
+            dmJobThread::PushJob(ctx, job);
+        }
+        dmJobThread::PushJob(ctx, root);
+
+        // The calling thread helps out
+        dmJobThread::WaitForJob(ctx, root);
+        ASSERT_EQ((int32_t)count, dmAtomicGet32(&counter));
+
+        // The callbacks are invoked on the main thread
+        ASSERT_EQ(0, callback_count);
+        dmJobThread::Update(ctx);
+        ASSERT_EQ((int)count, callback_count);
+
+        dmJobThread::Destroy(ctx);
+    }
+}
+
+TEST(dmJobThread, StaleHandle)
+{
+    dmJobThread::HContext ctx = CreateContext(1);
+
+    int callback_count = 0;
+    int32_atomic_t counter = 0;
+    dmJobThread::HJob job = dmJobThread::CreateJob(ctx, ProcessCount, CallbackCount, (void*)&counter, (void*)&callback_count);
+    dmJobThread::PushJob(ctx, job);
+    dmJobThread::WaitForJob(ctx, job);
+    dmJobThread::Update(ctx);
+    ASSERT_EQ(1, callback_count);
+
+    // The handle is no longer valid, and shouldn't affect new jobs reusing the slot
+    dmJobThread::HJob job2 = dmJobThread::CreateJob(ctx, ProcessCount, 0, (void*)&counter, 0);
+    ASSERT_NE(job, job2);
+    ASSERT_TRUE(dmJobThread::IsJobFinished(ctx, job));
+    ASSERT_FALSE(dmJobThread::IsJobFinished(ctx, job2));
+    ASSERT_TRUE(dmJobThread::AddDependency(ctx, job2, job));
+    dmJobThread::PushJob(ctx, job2);
+    dmJobThread::WaitForJob(ctx, job2);
+    ASSERT_EQ(2, dmAtomicGet32(&counter));
+
+    dmJobThread::Destroy(ctx);
+}
+
+struct ParallelForContext
+{
+    uint32_t        m_Values[10000];
+    int32_atomic_t  m_CallCount;
+};
+
+static void ParallelForFn(void* context, uint32_t begin, uint32_t end)
+{
+    ParallelForContext* ctx = (ParallelForContext*)context;
+    for (uint32_t i = begin; i < end; ++i)
+        ctx->m_Values[i] += i;
+    dmAtomicIncrement32(&ctx->m_CallCount);
+}
+
+TEST(dmJobThread, ParallelFor)
+{
+    dmJobThread::HContext contexts[] = { 0, CreateContext(0), CreateContext(4) };
+    for (uint32_t c = 0; c < DM_ARRAY_SIZE(contexts); ++c)
+    {
+        ParallelForContext* pctx = new ParallelForContext;
+        memset(pctx, 0, sizeof(*pctx));
+
+        const uint32_t count = DM_ARRAY_SIZE(pctx->m_Values);
+        dmJobThread::ParallelFor(contexts[c], count, 100, ParallelForFn, pctx);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            ASSERT_EQ(i, pctx->m_Values[i]);
+        }
+
+        if (contexts[c] && dmJobThread::GetWorkerCount(contexts[c]) > 0)
+        {
+            ASSERT_LT(1, dmAtomicGet32(&pctx->m_CallCount));
+        }
+        else
+        {
+            ASSERT_EQ(1, dmAtomicGet32(&pctx->m_CallCount));
+        }
+
+        // Smaller than the grain size
+        pctx->m_CallCount = 0;
+        dmJobThread::ParallelFor(contexts[c], 10, 100, ParallelForFn, pctx);
+        ASSERT_EQ(1, dmAtomicGet32(&pctx->m_CallCount));
+
+        delete pctx;
+        dmJobThread::Destroy(contexts[c]);
+    }
+}
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);
@@ -69,6 +69,35 @@ TEST(dmLZ4, Compress)
     ASSERT_EQ(memcmp("bar", decompressed, 3), 0);
 }
 
+TEST(dmLZ4, CompressWithDictionary)
+{
+    const char* dictionary = "{\"position\": [0, 0, 0], \"rotation\": [0, 0, 0, 1], \"scale\": [1, 1, 1]}";
+    const char* data = "{\"position\": [10, 0, 0], \"rotation\": [0, 0, 0, 1], \"scale\": [2, 2, 2]}";
+    uint32_t dictionary_size = (uint32_t)strlen(dictionary);
+    uint32_t data_size = (uint32_t)strlen(data);
+
+    char compressed[256];
+    char decompressed[256];
+    int compressed_size, dictionary_compressed_size, decompressed_size;
+
+    dmLZ4::Result r = dmLZ4::CompressBuffer(data, data_size, compressed, &compressed_size);
+    ASSERT_EQ(dmLZ4::RESULT_OK, r);
+
+    r = dmLZ4::CompressBufferWithDictionary(data, data_size, dictionary, dictionary_size, compressed, &dictionary_compressed_size);
+    ASSERT_EQ(dmLZ4::RESULT_OK, r);
+    // Most of the data is found in the dictionary
+    ASSERT_LT(dictionary_compressed_size, compressed_size / 2);
+
+    r = dmLZ4::DecompressBufferWithDictionary(compressed, dictionary_compressed_size, dictionary, dictionary_size, decompressed, data_size, &decompressed_size);
+    ASSERT_EQ(dmLZ4::RESULT_OK, r);
+    ASSERT_EQ((int)data_size, decompressed_size);
+    ASSERT_ARRAY_EQ_LEN(data, decompressed, data_size);
+
+    // The data can't be decompressed without the dictionary
+    r = dmLZ4::DecompressBuffer(compressed, dictionary_compressed_size, decompressed, data_size, &decompressed_size);
+    ASSERT_NE(dmLZ4::RESULT_OK, r);
+}
+
 char * RandomCharArray(int max, int *real)
 {
     char *tmp;
@@ -14,9 +14,11 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
 #include "../dlib/memory.h"
+#include "../dlib/thread.h"
 
 TEST(dmMemory, Malloc)
 {
@@ -52,6 +54,200 @@ TEST(dmMemory, AlignedMalloc)
     dummy = 0;
 }
 
+TEST(dmMemory, FrameAlloc)
+{
+    uint8_t* a = (uint8_t*)dmMemory::FrameAlloc(100, 16);
+    uint8_t* b = (uint8_t*)dmMemory::FrameAlloc(1, 1);
+    uint8_t* c = (uint8_t*)dmMemory::FrameAlloc(256, 64);
+    ASSERT_TRUE(a != 0);
+    ASSERT_TRUE(b != 0);
+    ASSERT_TRUE(c != 0);
+    ASSERT_EQ(0u, ((uintptr_t)a % 16));
+    ASSERT_EQ(0u, ((uintptr_t)c % 64));
+    ASSERT_TRUE(b >= a + 100);
+    ASSERT_TRUE(c > b);
+    memset(a, 1, 100);
+    memset(c, 3, 256);
+
+    // Still valid during the next frame
+    dmMemory::FrameReset();
+    uint8_t* d = (uint8_t*)dmMemory::FrameAlloc(100, 16);
+    ASSERT_TRUE(d != 0);
+    memset(d, 2, 100);
+    ASSERT_EQ(1, a[99]);
+    ASSERT_EQ(3, c[255]);
+
+    // The memory of the first frame is reused after it expired
+    for (uint32_t i = 1; i < dmMemory::FRAME_ARENA_BUFFER_COUNT; ++i)
+    {
+        dmMemory::FrameReset();
+    }
+    ASSERT_EQ(a, (uint8_t*)dmMemory::FrameAlloc(100, 16));
+    dmMemory::FrameReset();
+}
+
+TEST(dmMemory, FrameAllocGrow)
+{
+    for (uint32_t i = 0; i < dmMemory::FRAME_ARENA_BUFFER_COUNT; ++i)
+    {
+        dmMemory::FrameReset();
+    }
+
+    // Overflow the pages of each buffer a few times, then make sure the size settles after the merge
+    const uint32_t size = 1024 * 1024;
+    for (uint32_t frame = 0; frame < dmMemory::FRAME_ARENA_BUFFER_COUNT; ++frame)
+    {
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            uint8_t* p = (uint8_t*)dmMemory::FrameAlloc(size, 16);
+            ASSERT_TRUE(p != 0);
+            memset(p, 0, size);
+        }
+        dmMemory::FrameReset();
+    }
+
+    uint32_t arena_size = dmMemory::GetFrameArenaSize();
+    for (uint32_t frame = 0; frame < 4; ++frame)
+    {
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            ASSERT_TRUE(dmMemory::FrameAlloc(size, 16) != 0);
+        }
+        dmMemory::FrameReset();
+    }
+    ASSERT_GE(arena_size, dmMemory::GetFrameArenaSize());
+}
+
+static void TagThread(void* arg)
+{
+    dmMemory::Tag* tag = (dmMemory::Tag*)arg;
+    *tag = dmMemory::GetCurrentTag();
+    DM_MEMORY_TAG(dmMemory::TAG_SOUND);
+    dmMemory::TrackAlloc(100);
+}
+
+TEST(dmMemory, Tags)
+{
+    dmMemory::TagStats sound_before, sound, physics;
+    dmMemory::GetTagStats(dmMemory::TAG_SOUND, &sound_before);
+
+    ASSERT_EQ(dmMemory::TAG_UNTAGGED, dmMemory::GetCurrentTag());
+    {
+        DM_MEMORY_TAG(dmMemory::TAG_PHYSICS);
+        ASSERT_EQ(dmMemory::TAG_PHYSICS, dmMemory::GetCurrentTag());
+        {
+            DM_MEMORY_TAG(dmMemory::TAG_GUI);
+            ASSERT_EQ(dmMemory::TAG_GUI, dmMemory::GetCurrentTag());
+        }
+        ASSERT_EQ(dmMemory::TAG_PHYSICS, dmMemory::GetCurrentTag());
+
+        // The tags are per thread
+        dmMemory::Tag thread_tag = dmMemory::TAG_COUNT;
+        dmThread::Thread thread = dmThread::New(TagThread, 0x80000, &thread_tag, "tag_thread");
+        dmThread::Join(thread);
+        ASSERT_EQ(dmMemory::TAG_UNTAGGED, thread_tag);
+        ASSERT_EQ(dmMemory::TAG_PHYSICS, dmMemory::GetCurrentTag());
+
+        dmMemory::TrackAlloc(1000);
+        dmMemory::TrackAlloc(24);
+        dmMemory::TrackFree(dmMemory::TAG_PHYSICS, 1000);
+    }
+    ASSERT_EQ(dmMemory::TAG_UNTAGGED, dmMemory::GetCurrentTag());
+
+    dmMemory::GetTagStats(dmMemory::TAG_SOUND, &sound);
+    ASSERT_EQ(sound_before.m_Active + 100, sound.m_Active);
+    dmMemory::TrackFree(dmMemory::TAG_SOUND, 100);
+
+    dmMemory::GetTagStats(dmMemory::TAG_PHYSICS, &physics);
+    ASSERT_EQ(24, physics.m_Active);
+
+    dmMemory::SetTagActive(dmMemory::TAG_PHYSICS, 4096);
+    dmMemory::GetTagStats(dmMemory::TAG_PHYSICS, &physics);
+    ASSERT_EQ(4096, physics.m_Active);
+
+    ASSERT_STREQ("lua", dmMemory::GetTagName(dmMemory::TAG_LUA));
+}
+
+struct TestAllocation
+{
+    void*       m_Memory;
+    uint32_t    m_Size;
+};
+
+struct TestAllocator
+{
+    uint32_t m_AllocCount;
+    uint32_t m_FreeCount;
+};
+
+// Keeps the allocation info right before the aligned memory
+static void* TestAlloc(void* context, uint32_t size, uint32_t alignment)
+{
+    TestAllocator* allocator = (TestAllocator*)context;
+    allocator->m_AllocCount++;
+    uint8_t* memory = (uint8_t*)malloc(size + alignment + sizeof(TestAllocation));
+    uintptr_t aligned = ((uintptr_t)memory + sizeof(TestAllocation) + alignment - 1) & ~((uintptr_t)alignment - 1);
+    TestAllocation* allocation = (TestAllocation*)(aligned - sizeof(TestAllocation));
+    allocation->m_Memory = memory;
+    allocation->m_Size = size;
+    return (void*)aligned;
+}
+
+static void TestFree(void* context, void* memory)
+{
+    TestAllocator* allocator = (TestAllocator*)context;
+    allocator->m_FreeCount++;
+    free(((TestAllocation*)((uintptr_t)memory - sizeof(TestAllocation)))->m_Memory);
+}
+
+static uint32_t TestGetSize(void* context, void* memory)
+{
+    return ((TestAllocation*)((uintptr_t)memory - sizeof(TestAllocation)))->m_Size;
+}
+
+TEST(dmMemory, Allocator)
+{
+    TestAllocator test_allocator = {0};
+    dmMemory::Allocator allocator;
+    allocator.m_Alloc = TestAlloc;
+    allocator.m_Free = TestFree;
+    allocator.m_GetSize = TestGetSize;
+    allocator.m_Context = &test_allocator;
+
+    dmMemory::AllocatorStats before, stats;
+    dmMemory::GetAllocatorStats(&before);
+
+    dmMemory::SetAllocator(&allocator);
+
+    void* a = 0;
+    void* b = 0;
+    ASSERT_EQ(dmMemory::RESULT_OK, dmMemory::AlignedMalloc(&a, 16, 100));
+    ASSERT_EQ(dmMemory::RESULT_OK, dmMemory::AlignedMalloc(&b, 256, 1000));
+    ASSERT_EQ(0u, ((uintptr_t)a % 16));
+    ASSERT_EQ(0u, ((uintptr_t)b % 256));
+    ASSERT_EQ(dmMemory::RESULT_INVAL, dmMemory::AlignedMalloc(&a, 6, 100));
+    ASSERT_EQ(2u, test_allocator.m_AllocCount);
+
+    dmMemory::GetAllocatorStats(&stats);
+    ASSERT_EQ(before.m_Active + 1100, stats.m_Active);
+    ASSERT_EQ(before.m_Allocated + 1100, stats.m_Allocated);
+    ASSERT_EQ(before.m_AllocationCount + 2, stats.m_AllocationCount);
+
+    dmMemory::AlignedFree(a);
+    dmMemory::AlignedFree(b);
+    ASSERT_EQ(2u, test_allocator.m_FreeCount);
+
+    dmMemory::GetAllocatorStats(&stats);
+    ASSERT_EQ(before.m_Active, stats.m_Active);
+    ASSERT_EQ(before.m_Allocated + 1100, stats.m_Allocated);
+
+    dmMemory::SetAllocator(0);
+
+    ASSERT_EQ(dmMemory::RESULT_OK, dmMemory::AlignedMalloc(&a, 16, 100));
+    dmMemory::AlignedFree(a);
+    ASSERT_EQ(2u, test_allocator.m_AllocCount);
+}
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);
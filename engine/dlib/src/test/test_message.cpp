@@ -365,6 +365,66 @@ TEST(dmMessage, ThreadTest2)
 
     ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(receiver.m_Socket));
 }
+
+struct PostOrderContext
+{
+    dmMessage::URL* m_Receiver;
+    uint32_t        m_Index;
+};
+
+static void PostOrderThread(void* arg)
+{
+    PostOrderContext* ctx = (PostOrderContext*) arg;
+
+    for (uint32_t i = 0; i < 4096; ++i)
+    {
+        dmMessage::Result result = dmMessage::Post(0x0, ctx->m_Receiver, m_HashMessage1, ctx->m_Index, 0x0, &i, sizeof(i), 0);
+        T_ASSERT_EQ(dmMessage::RESULT_OK, result);
+    }
+}
+
+static void HandleOrderMessage(dmMessage::Message *message_object, void *user_ptr)
+{
+    // Messages from the same thread must be dispatched in the order they were posted
+    uint32_t* next = (uint32_t*) user_ptr;
+    uint32_t index = (uint32_t) message_object->m_UserData1;
+    uint32_t value = *(uint32_t*) message_object->m_Data;
+    T_ASSERT_EQ(next[index], value);
+    next[index]++;
+}
+
+TEST(dmMessage, ThreadOrder)
+{
+    dmMessage::URL receiver;
+    dmMessage::ResetURL(&receiver);
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("my_socket", &receiver.m_Socket));
+
+    const uint32_t thread_count = 8;
+    PostOrderContext contexts[thread_count];
+    dmThread::Thread threads[thread_count];
+    uint32_t next[thread_count] = {0};
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        contexts[i].m_Receiver = &receiver;
+        contexts[i].m_Index = i;
+        threads[i] = dmThread::New(&PostOrderThread, 0xf0000, (void*) &contexts[i], "post");
+    }
+
+    uint32_t count = 0;
+    while (count < 4096 * thread_count)
+    {
+        count += dmMessage::Dispatch(receiver.m_Socket, HandleOrderMessage, next);
+    }
+
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        dmThread::Join(threads[i]);
+        ASSERT_EQ(4096U, next[i]);
+    }
+
+    ASSERT_FALSE(dmMessage::HasMessages(receiver.m_Socket));
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(receiver.m_Socket));
+}
 #endif // DM_NO_THREAD_SUPPORT
 
 void HandleIntegrityMessage(dmMessage::Message *message_object, void *user_ptr)
@@ -474,6 +534,62 @@ TEST(dmMessage, MessagePostDispatch)
     ASSERT_EQ(8111, g_PostDistpatchCalled);
 }
 
+static const uint32_t LARGE_PAYLOAD_SIZE = 1024 * 1024;
+
+void HandleLargeMessage(dmMessage::Message *message_object, void *user_ptr)
+{
+    const uint8_t* data = (const uint8_t*)dmMessage::GetData(message_object);
+    ASSERT_EQ(LARGE_PAYLOAD_SIZE, message_object->m_DataSize);
+    ASSERT_EQ(0xAB, data[0]);
+    ASSERT_EQ(0xAB, data[LARGE_PAYLOAD_SIZE-1]);
+    *(const void**)user_ptr = data;
+}
+
+void FreeLargeMessage(dmMessage::Message* message)
+{
+    free(dmMessage::GetData(message));
+}
+
+TEST(dmMessage, PostRef)
+{
+    dmMessage::URL receiver;
+    dmMessage::ResetURL(&receiver);
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("my_socket", &receiver.m_Socket));
+
+    // Larger than a page, and the receiver gets the same pointer
+    void* payload = malloc(LARGE_PAYLOAD_SIZE);
+    memset(payload, 0xAB, LARGE_PAYLOAD_SIZE);
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::PostRef(0x0, &receiver, m_HashMessage1, 0, 0, 0, payload, LARGE_PAYLOAD_SIZE, FreeLargeMessage));
+
+    const void* received = 0;
+    ASSERT_EQ(1u, dmMessage::Dispatch(receiver.m_Socket, HandleLargeMessage, (void*)&received));
+    ASSERT_EQ(payload, received);
+
+    // Freed when the socket is deleted
+    payload = malloc(LARGE_PAYLOAD_SIZE);
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::PostRef(0x0, &receiver, m_HashMessage1, 0, 0, 0, payload, LARGE_PAYLOAD_SIZE, FreeLargeMessage));
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(receiver.m_Socket));
+}
+
+TEST(dmMessage, Finalize)
+{
+    dmMessage::URL receiver;
+    dmMessage::ResetURL(&receiver);
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("my_socket", &receiver.m_Socket));
+    uint32_t sent = 1;
+    uint32_t received = 0;
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::Post(0x0, &receiver, 0, (uintptr_t)&sent, 0x0, 0x0, 0, 0));
+
+    // Pending messages survive, and posting sets up the per thread state again
+    dmMessage::Finalize();
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::Post(0x0, &receiver, 0, (uintptr_t)&sent, 0x0, 0x0, 0, 0));
+    ASSERT_EQ(2u, dmMessage::Dispatch(receiver.m_Socket, HandleUserDataMessage, (void*)&received));
+    ASSERT_EQ(sent, received);
+
+    dmMessage::Finalize();
+    dmMessage::Finalize();
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(receiver.m_Socket));
+}
 
 int main(int argc, char **argv)
 {
@@ -178,6 +178,80 @@ TEST(dmObjectPool, Stress)
     }
 }
 
+TEST(dmObjectPool, Handles)
+{
+    dmObjectPool<Object> pool;
+    pool.SetCapacity(4);
+
+    uint32_t id = pool.Alloc();
+    pool.Get(id).m_Value = 1;
+    uint64_t handle = pool.GetHandle(id);
+    ASSERT_EQ(&pool.Get(id), pool.GetFromHandle(handle));
+
+    pool.Free(id, true);
+    ASSERT_EQ((Object*)0, pool.GetFromHandle(handle));
+
+    // The index is reused, but not the handle
+    uint32_t id2 = pool.Alloc();
+    ASSERT_EQ(id, id2);
+    ASSERT_EQ((Object*)0, pool.GetFromHandle(handle));
+    ASSERT_EQ(&pool.Get(id2), pool.GetFromHandle(pool.GetHandle(id2)));
+    ASSERT_EQ((Object*)0, pool.GetFromHandle(3));
+}
+
+static uint32_t GetKey(const Object& object)
+{
+    return object.m_Value % 1000;
+}
+
+TEST(dmObjectPool, Sort)
+{
+    dmObjectPool<Object> pool;
+    const uint32_t n = 64;
+    pool.SetCapacity(n);
+
+    std::map<uint32_t, uint32_t> mapping;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t id = pool.Alloc();
+        uint32_t value = (uint32_t)(rand() % 1000) + 1000 * i;
+        pool.Get(id).m_Value = value;
+        mapping[id] = value;
+    }
+    pool.Free(7, true);
+    mapping.erase(7);
+    uint64_t handle = pool.GetHandle(9);
+
+    ASSERT_TRUE(pool.Sort(GetKey));
+    ASSERT_FALSE(pool.Sort(GetKey));
+
+    dmArray<Object>& objects = pool.GetRawObjects();
+    ASSERT_EQ(n - 1, objects.Size());
+    for (uint32_t i = 1; i < objects.Size(); i++) {
+        uint32_t prev = objects[i-1].m_Value;
+        uint32_t value = objects[i].m_Value;
+        ASSERT_LE(GetKey(objects[i-1]), GetKey(objects[i]));
+        // Stable
+        if (GetKey(objects[i-1]) == GetKey(objects[i])) {
+            ASSERT_LT(prev, value);
+        }
+    }
+
+    for (std::map<uint32_t, uint32_t>::iterator i = mapping.begin(); i != mapping.end(); ++i) {
+        ASSERT_EQ(i->second, pool.Get(i->first).m_Value);
+    }
+    ASSERT_EQ(&pool.Get(9), pool.GetFromHandle(handle));
+
+    // The mapping is still valid when objects are freed and allocated
+    pool.Free(3, true);
+    mapping.erase(3);
+    uint32_t id = pool.Alloc();
+    pool.Get(id).m_Value = 5;
+    mapping[id] = 5;
+    for (std::map<uint32_t, uint32_t>::iterator i = mapping.begin(); i != mapping.end(); ++i) {
+        ASSERT_EQ(i->second, pool.Get(i->first).m_Value);
+    }
+}
+
 
 int main(int argc, char **argv)
 {
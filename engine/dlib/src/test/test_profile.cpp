@@ -266,6 +266,138 @@ TEST(dmProfile, Profile)
 #endif // Disable
 
 
+struct NativeSampleCtx
+{
+    dmMutex::HMutex             m_Mutex;
+    std::vector<TestSample>     m_Samples;
+    std::vector<int>            m_Depths;
+    std::vector<std::string>    m_Threads;
+};
+
+static void TraverseNativeSampleTree(NativeSampleCtx* ctx, int depth, dmProfile::HSample sample)
+{
+    TestSample out;
+    dmStrlCpy(out.m_Name, dmProfile::SampleGetName(sample), sizeof(out.m_Name));
+    out.m_Elapsed = dmProfile::SampleGetTime(sample);
+    out.m_Count = dmProfile::SampleGetCallCount(sample);
+    ctx->m_Samples.push_back(out);
+    ctx->m_Depths.push_back(depth);
+
+    dmProfile::SampleIterator iter;
+    dmProfile::SampleIterateChildren(sample, &iter);
+    while (dmProfile::SampleIterateNext(&iter))
+    {
+        TraverseNativeSampleTree(ctx, depth + 1, iter.m_Sample);
+    }
+}
+
+static void NativeSampleTreeCallback(void* _ctx, const char* thread_name, dmProfile::HSample root)
+{
+    NativeSampleCtx* ctx = (NativeSampleCtx*)_ctx;
+    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+    ctx->m_Threads.push_back(thread_name);
+    TraverseNativeSampleTree(ctx, 0, root);
+}
+
+static void NativeSampleWorker(void*)
+{
+    DM_PROFILE("worker");
+    DM_PROFILE("worker_child");
+}
+
+static bool WaitForNativeSamples(NativeSampleCtx* ctx, uint32_t count)
+{
+    for (int i = 0; i < 1000; ++i)
+    {
+        {
+            DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+            if (ctx->m_Samples.size() >= count)
+                return true;
+        }
+        dmTime::Sleep(1000);
+    }
+    return false;
+}
+
+TEST(dmProfile, NativeSamples)
+{
+    NativeSampleCtx ctx;
+    ctx.m_Mutex = dmMutex::New();
+
+    dmProfile::SetSampleTreeCallback(&ctx, NativeSampleTreeCallback);
+
+    dmProfile::Options options;
+    options.m_Port = 0;
+    options.m_SleepBetweenServerUpdates = 0;
+    options.m_NativeSamples = true;
+    dmProfile::Initialize(&options);
+
+    if (dmProfile::IsInitialized()) // false for profile null (i.e. on unsupported platforms)
+    {
+        {
+            DM_PROFILE("root");
+            for (int i = 0; i < 3; ++i)
+            {
+                DM_PROFILE("child");
+                dmTime::BusyWait(1000);
+                dmProfile::AddCounter("counter", 2);
+            }
+            {
+                DM_PROFILE("");
+                dmProfile::ScopeBegin("dynamic", 0);
+                dmProfile::ScopeEnd();
+            }
+        }
+
+        ASSERT_TRUE(WaitForNativeSamples(&ctx, 5));
+        {
+            DM_MUTEX_SCOPED_LOCK(ctx.m_Mutex);
+            ASSERT_EQ(1U, (uint32_t)ctx.m_Threads.size());
+            ASSERT_STREQ("Main", ctx.m_Threads[0].c_str());
+            ASSERT_EQ(5U, (uint32_t)ctx.m_Samples.size());
+
+            // The calls are aggregated per parent
+            ASSERT_STREQ("root", ctx.m_Samples[0].m_Name);
+            ASSERT_EQ(1U, ctx.m_Samples[0].m_Count);
+            ASSERT_EQ(0, ctx.m_Depths[0]);
+            ASSERT_STREQ("child", ctx.m_Samples[1].m_Name);
+            ASSERT_EQ(3U, ctx.m_Samples[1].m_Count);
+            ASSERT_EQ(1, ctx.m_Depths[1]);
+            ASSERT_GE(ctx.m_Samples[0].m_Elapsed, ctx.m_Samples[1].m_Elapsed);
+            ASSERT_LE(2000U, ctx.m_Samples[1].m_Elapsed); // 3 ms, with some room for the calibration of the ticks
+            ASSERT_STREQ("counter", ctx.m_Samples[2].m_Name);
+            ASSERT_EQ(6U, ctx.m_Samples[2].m_Count);
+            ASSERT_EQ(2, ctx.m_Depths[2]);
+            ASSERT_STREQ("<empty>", ctx.m_Samples[3].m_Name);
+            ASSERT_EQ(1, ctx.m_Depths[3]);
+            ASSERT_STREQ("dynamic", ctx.m_Samples[4].m_Name);
+            ASSERT_EQ(2, ctx.m_Depths[4]);
+
+            ctx.m_Samples.clear();
+            ctx.m_Depths.clear();
+            ctx.m_Threads.clear();
+        }
+
+        dmThread::Thread thread = dmThread::New(NativeSampleWorker, 0x80000, 0, "native_worker");
+        dmThread::Join(thread);
+
+        ASSERT_TRUE(WaitForNativeSamples(&ctx, 2));
+        {
+            DM_MUTEX_SCOPED_LOCK(ctx.m_Mutex);
+            ASSERT_EQ(1U, (uint32_t)ctx.m_Threads.size());
+            ASSERT_STREQ("native_worker", ctx.m_Threads[0].c_str());
+            ASSERT_STREQ("worker", ctx.m_Samples[0].m_Name);
+            ASSERT_STREQ("worker_child", ctx.m_Samples[1].m_Name);
+            ASSERT_EQ(1, ctx.m_Depths[1]);
+        }
+    }
+
+    dmProfile::Finalize();
+    dmProfile::SetSampleTreeCallback(0, 0);
+
+    dmMutex::Delete(ctx.m_Mutex);
+}
+
 DM_PROPERTY_GROUP(prop_TestGroup1, "");
 DM_PROPERTY_BOOL(prop_TestBOOL, 0, FrameReset, "", &prop_TestGroup1);
 DM_PROPERTY_S32(propt_TestS32, 0, FrameReset, "", &prop_TestGroup1);
@@ -0,0 +1,234 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include <stdint.h>
+#include <string.h>
+#include <dlib/dstrings.h>
+#include <dlib/socket.h>
+#include <dlib/time.h>
+#include <dlib/udp_transport.h>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+static dmSocket::Address Localhost()
+{
+    return dmSocket::AddressFromIPString("127.0.0.1");
+}
+
+static uint32_t WaitForPackets(dmUdpTransport::HTransport transport, dmUdpTransport::Packet* packets, uint32_t count)
+{
+    uint32_t received = 0;
+    for (int i = 0; i < 2000; ++i)
+    {
+        dmUdpTransport::Update(transport);
+        received = dmUdpTransport::Receive(transport, packets, count);
+        if (received == count)
+            break;
+        dmTime::Sleep(1000);
+    }
+    return received;
+}
+
+TEST(dmSocket, SendReceiveBatch)
+{
+    dmSocket::Socket server;
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::New(dmSocket::DOMAIN_IPV4, dmSocket::TYPE_DGRAM, dmSocket::PROTOCOL_UDP, &server));
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::Bind(server, Localhost(), 0));
+    dmSocket::Address address;
+    uint16_t port;
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::GetName(server, &address, &port));
+
+    dmSocket::Socket client;
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::New(dmSocket::DOMAIN_IPV4, dmSocket::TYPE_DGRAM, dmSocket::PROTOCOL_UDP, &client));
+
+    // More than one batch of sendmmsg
+    const uint32_t count = 50;
+    uint32_t values[count];
+    dmSocket::Datagram datagrams[count];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        values[i] = i;
+        datagrams[i].m_Data = &values[i];
+        datagrams[i].m_Size = sizeof(values[i]);
+        datagrams[i].m_Address = Localhost();
+        datagrams[i].m_Port = port;
+    }
+    uint32_t sent = 0;
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::SendToBatch(client, datagrams, count, &sent));
+    ASSERT_EQ(count, sent);
+
+    uint32_t buffers[count][2];
+    uint32_t received = 0;
+    while (received < count)
+    {
+        for (uint32_t i = received; i < count; ++i)
+        {
+            datagrams[i].m_Data = buffers[i];
+            datagrams[i].m_Size = sizeof(buffers[i]);
+        }
+        uint32_t n = 0;
+        ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::ReceiveFromBatch(server, datagrams + received, count - received, &n));
+        ASSERT_LT(0U, n);
+        received += n;
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_EQ(sizeof(uint32_t), datagrams[i].m_Size);
+        ASSERT_EQ(i, buffers[i][0]);
+        ASSERT_EQ(dmSocket::DOMAIN_IPV4, datagrams[i].m_Address.m_family);
+        ASSERT_TRUE(Localhost() == datagrams[i].m_Address);
+    }
+
+    // Nothing left, and the socket doesn't wait
+    ASSERT_EQ(dmSocket::RESULT_OK, dmSocket::SetBlocking(server, false));
+    ASSERT_EQ(dmSocket::RESULT_WOULDBLOCK, dmSocket::ReceiveFromBatch(server, datagrams, count, &received));
+    ASSERT_EQ(0U, received);
+
+    dmSocket::Delete(client);
+    dmSocket::Delete(server);
+}
+
+class dmUdpTransportTest : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        dmUdpTransport::NewParams params;
+        params.m_Address = Localhost();
+        ASSERT_EQ(dmUdpTransport::RESULT_OK, dmUdpTransport::New(&params, &m_Server));
+        ASSERT_EQ(dmUdpTransport::RESULT_OK, dmUdpTransport::New(&params, &m_Client));
+        ASSERT_NE(0, dmUdpTransport::GetPort(m_Server));
+    }
+
+    virtual void TearDown()
+    {
+        dmUdpTransport::Delete(m_Client);
+        dmUdpTransport::Delete(m_Server);
+    }
+
+    dmUdpTransport::HTransport m_Server;
+    dmUdpTransport::HTransport m_Client;
+};
+
+TEST_F(dmUdpTransportTest, SendReceive)
+{
+    const uint32_t count = 100;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        char buffer[32];
+        uint32_t size = dmSnPrintf(buffer, sizeof(buffer), "packet %d", i);
+        ASSERT_EQ(dmUdpTransport::RESULT_OK, dmUdpTransport::Send(m_Client, buffer, size, Localhost(), dmUdpTransport::GetPort(m_Server)));
+    }
+
+    dmUdpTransport::Packet packets[count];
+    ASSERT_EQ(count, WaitForPackets(m_Server, packets, count));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        char buffer[32];
+        uint32_t size = dmSnPrintf(buffer, sizeof(buffer), "packet %d", i);
+        ASSERT_EQ(size, packets[i].m_Size);
+        ASSERT_EQ(0, memcmp(buffer, packets[i].m_Data, size));
+        ASSERT_EQ(dmUdpTransport::GetPort(m_Client), packets[i].m_Port);
+        ASSERT_TRUE(Localhost() == packets[i].m_Address);
+    }
+
+    // The packets stay in the queue until released
+    ASSERT_EQ(count, dmUdpTransport::Receive(m_Server, packets, count));
+    dmUdpTransport::Release(m_Server, count / 2);
+    ASSERT_EQ(count / 2, dmUdpTransport::Receive(m_Server, packets, count));
+    ASSERT_EQ(0, memcmp("packet 50", packets[0].m_Data, packets[0].m_Size));
+    dmUdpTransport::Release(m_Server, count / 2);
+    ASSERT_EQ(0U, dmUdpTransport::Receive(m_Server, packets, count));
+
+    dmUdpTransport::Stats stats;
+    dmUdpTransport::GetStats(m_Client, &stats);
+    ASSERT_EQ(count, stats.m_PacketsSent);
+    dmUdpTransport::GetStats(m_Server, &stats);
+    ASSERT_EQ(count, stats.m_PacketsReceived);
+    ASSERT_EQ(0U, stats.m_ReceiveDropped);
+}
+
+TEST_F(dmUdpTransportTest, TooLarge)
+{
+    uint8_t buffer[2048] = {};
+    ASSERT_EQ(dmUdpTransport::RESULT_TOO_LARGE, dmUdpTransport::Send(m_Client, buffer, sizeof(buffer), Localhost(), dmUdpTransport::GetPort(m_Server)));
+    ASSERT_EQ(dmUdpTransport::RESULT_OK, dmUdpTransport::Send(m_Client, buffer, 1472, Localhost(), dmUdpTransport::GetPort(m_Server)));
+
+    dmUdpTransport::Packet packet;
+    ASSERT_EQ(1U, WaitForPackets(m_Server, &packet, 1));
+    ASSERT_EQ(1472U, packet.m_Size);
+    dmUdpTransport::Release(m_Server, 1);
+}
+
+TEST(dmUdpTransport, ReceiveQueueFull)
+{
+    dmUdpTransport::NewParams params;
+    params.m_Address = Localhost();
+    params.m_ReceiveQueueSize = 3; // Rounded up to 4
+    dmUdpTransport::HTransport server, client;
+    ASSERT_EQ(dmUdpTransport::RESULT_OK, dmUdpTransport::New(&params, &server));
+    params.m_ReceiveQueueSize = 256;
+    ASSERT_EQ(dmUdpTransport::RESULT_OK, dmUdpTransport::New(&params, &client));
+
+    const uint32_t count = 20;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_EQ(dmUdpTransport::RESULT_OK, dmUdpTransport::Send(client, &i, sizeof(i), Localhost(), dmUdpTransport::GetPort(server)));
+    }
+
+    dmUdpTransport::Stats stats;
+    for (int i = 0; i < 2000; ++i)
+    {
+        dmUdpTransport::GetStats(server, &stats);
+        if (stats.m_PacketsReceived + stats.m_ReceiveDropped == count)
+            break;
+        dmTime::Sleep(1000);
+    }
+    ASSERT_EQ(4U, stats.m_PacketsReceived);
+    ASSERT_EQ(count - 4, stats.m_ReceiveDropped);
+
+    // The oldest packets are kept
+    dmUdpTransport::Packet packets[count];
+    ASSERT_EQ(4U, dmUdpTransport::Receive(server, packets, count));
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        uint32_t value;
+        memcpy(&value, packets[i].m_Data, sizeof(value));
+        ASSERT_EQ(i, value);
+    }
+
+    dmUdpTransport::Delete(client);
+    dmUdpTransport::Delete(server);
+}
+
+TEST(dmUdpTransport, InvalidParams)
+{
+    dmUdpTransport::NewParams params;
+    params.m_Address = dmSocket::Address();
+    dmUdpTransport::HTransport transport;
+    ASSERT_EQ(dmUdpTransport::RESULT_INVALID_PARAMS, dmUdpTransport::New(&params, &transport));
+    ASSERT_EQ((dmUdpTransport::HTransport)0, transport);
+}
+
+int main(int argc, char **argv)
+{
+    dmSocket::Initialize();
+    jc_test_init(&argc, argv);
+    int ret = jc_test_run_all();
+    dmSocket::Finalize();
+    return ret;
+}
@@ -122,6 +122,70 @@ TEST(dmZip, Iterate)
     dmZip::Close(zip);
 }
 
+TEST(dmZip, StoredData)
+{
+    char path[128];
+    dmTestUtil::MakeHostPath(path, sizeof(path), "src/test/data/foo.zip");
+
+    dmZip::HZip zip;
+    dmZip::Result zr = dmZip::Open(path, &zip);
+    ASSERT_EQ(dmZip::RESULT_OK, zr);
+
+    const char* names[] = {
+            "dir/",
+            "dir/data.bin",
+            "hello.txt",
+        };
+
+    uint32_t num_entries = dmZip::GetNumEntries(zip);
+    ASSERT_EQ(3u, num_entries);
+
+    dmZip::EntryInfo info;
+    ASSERT_EQ(dmZip::RESULT_NO_SUCH_ENTRY, dmZip::GetEntryInfo(zip, num_entries, 0, 0, &info));
+
+    for (uint32_t i = 0; i < num_entries; ++i)
+    {
+        char name[64];
+        zr = dmZip::GetEntryInfo(zip, i, name, sizeof(name), &info);
+        ASSERT_EQ(dmZip::RESULT_OK, zr);
+        ASSERT_STREQ(names[i], name);
+        ASSERT_EQ(i == 0, info.m_IsDir);
+        if (info.m_IsDir)
+            continue;
+
+        // The stored and inflated data is the same as the extracted data
+        zr = dmZip::OpenEntry(zip, i);
+        ASSERT_EQ(dmZip::RESULT_OK, zr);
+        uint32_t size = 0;
+        dmZip::GetEntrySize(zip, &size);
+        ASSERT_EQ(size, info.m_Size);
+        uint8_t* data = (uint8_t*)malloc(size);
+        ASSERT_EQ(dmZip::RESULT_OK, dmZip::GetEntryData(zip, data, size));
+        dmZip::CloseEntry(zip);
+
+        uint8_t* stored = (uint8_t*)malloc(info.m_StoredSize);
+        ASSERT_EQ(dmZip::RESULT_OK, dmZip::GetEntryStoredData(zip, i, stored, info.m_StoredSize));
+
+        uint8_t* inflated = (uint8_t*)malloc(info.m_Size);
+        if (info.m_Deflated)
+        {
+            ASSERT_EQ(dmZip::RESULT_OK, dmZip::Inflate(stored, info.m_StoredSize, inflated, info.m_Size));
+        }
+        else
+        {
+            ASSERT_EQ(info.m_Size, info.m_StoredSize);
+            memcpy(inflated, stored, info.m_Size);
+        }
+        ASSERT_EQ(0, memcmp(data, inflated, info.m_Size));
+
+        free(inflated);
+        free(stored);
+        free(data);
+    }
+
+    dmZip::Close(zip);
+}
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);
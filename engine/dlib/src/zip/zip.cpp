@@ -780,6 +780,88 @@ int zip_total_entries(struct zip_t *zip) {
   return (int)zip->archive.m_total_files;
 }
 
+// DEFOLD: Reads the central directory only, and doesn't allocate the entry name
+int zip_entry_stat_byindex(struct zip_t *zip, int index, char *name,
+                           size_t namesize, unsigned long long *uncomp_size,
+                           unsigned long long *comp_size, int *deflated,
+                           int *isdir) {
+  miniz::mz_zip_archive *pzip = NULL;
+  miniz::mz_zip_archive_file_stat stats;
+
+  if (!zip) {
+    // zip_t handler is not initialized
+    return -1;
+  }
+
+  pzip = &(zip->archive);
+  if (pzip->m_zip_mode != miniz::MZ_ZIP_MODE_READING || index < 0 ||
+      (miniz::mz_uint)index >= pzip->m_total_files) {
+    return -1;
+  }
+
+  if (!mz_zip_reader_file_stat(pzip, (miniz::mz_uint)index, &stats)) {
+    return -1;
+  }
+
+  if (name && namesize > 0) {
+    mz_zip_reader_get_filename(pzip, (miniz::mz_uint)index, name,
+                               (miniz::mz_uint)namesize);
+    for (char *c = name; *c; ++c) {
+      if (*c == '\\')
+        *c = '/';
+    }
+  }
+
+  *uncomp_size = stats.m_uncomp_size;
+  *comp_size = stats.m_comp_size;
+  *deflated = stats.m_method == MZ_DEFLATED;
+  *isdir = mz_zip_reader_is_file_a_directory(pzip, (miniz::mz_uint)index);
+  return 0;
+}
+
+// DEFOLD: The data is read as it's stored, so that it can be inflated elsewhere
+ssize_t zip_entry_rawread_byindex(struct zip_t *zip, int index, void *buf,
+                                  size_t bufsize) {
+  miniz::mz_zip_archive *pzip = NULL;
+  miniz::mz_zip_archive_file_stat stats;
+
+  if (!zip) {
+    // zip_t handler is not initialized
+    return -1;
+  }
+
+  pzip = &(zip->archive);
+  if (pzip->m_zip_mode != miniz::MZ_ZIP_MODE_READING || index < 0 ||
+      (miniz::mz_uint)index >= pzip->m_total_files) {
+    return -1;
+  }
+
+  if (!mz_zip_reader_file_stat(pzip, (miniz::mz_uint)index, &stats) ||
+      stats.m_comp_size > bufsize) {
+    return -1;
+  }
+
+  // The archive is read straight into the buffer, no extra i/o buffer is
+  // allocated
+  if (!mz_zip_reader_extract_to_mem_no_alloc(
+          pzip, (miniz::mz_uint)index, buf, bufsize,
+          miniz::MZ_ZIP_FLAG_COMPRESSED_DATA, NULL, 0)) {
+    return -1;
+  }
+
+  return (ssize_t)stats.m_comp_size;
+}
+
+// DEFOLD: The decompressor state is on the stack, so it may run on any thread
+ssize_t zip_inflate(const void *src, size_t srcsize, void *buf,
+                    size_t bufsize) {
+  size_t n = miniz::tinfl_decompress_mem_to_mem(buf, bufsize, src, srcsize, 0);
+  if (n == TINFL_DECOMPRESS_MEM_TO_MEM_FAILED) {
+    return -1;
+  }
+  return (ssize_t)n;
+}
+
 // int zip_create(const char *zipname, const char *filenames[], size_t len) {
 //   int status = 0;
 //   size_t i;
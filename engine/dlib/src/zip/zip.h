@@ -282,6 +282,54 @@ zip_entry_extract(struct zip_t *zip,
  */
 extern int zip_total_entries(struct zip_t *zip);
 
+/**
+ * DEFOLD: Gets the name and sizes of an entry, without opening it.
+ *
+ * @param zip zip archive handler.
+ * @param index index in the zip archive.
+ * @param name output buffer for the entry name (optional).
+ * @param namesize size of the name buffer (in bytes).
+ * @param uncomp_size the uncompressed size of the entry.
+ * @param comp_size the stored size of the entry.
+ * @param deflated 1 if the stored data is deflated.
+ * @param isdir 1 if the entry is a directory.
+ *
+ * @return the return code - 0 on success, negative number (< 0) on error.
+ */
+extern int zip_entry_stat_byindex(struct zip_t *zip, int index, char *name,
+                                  size_t namesize,
+                                  unsigned long long *uncomp_size,
+                                  unsigned long long *comp_size, int *deflated,
+                                  int *isdir);
+
+/**
+ * DEFOLD: Reads the stored (possibly deflated) data of an entry, without
+ * opening it. The archive file is read, so the calls must be serialized.
+ *
+ * @param zip zip archive handler.
+ * @param index index in the zip archive.
+ * @param buf preallocated output buffer, at least the stored size.
+ * @param bufsize output buffer size (in bytes).
+ *
+ * @return the number of bytes read on success, -1 on error.
+ */
+extern ssize_t zip_entry_rawread_byindex(struct zip_t *zip, int index,
+                                         void *buf, size_t bufsize);
+
+/**
+ * DEFOLD: Inflates raw deflated data (see zip_entry_rawread_byindex). Each
+ * call has its own decompressor state, so it may be called from any thread.
+ *
+ * @param src deflated data.
+ * @param srcsize deflated data size (in bytes).
+ * @param buf preallocated output buffer.
+ * @param bufsize output buffer size (in bytes).
+ *
+ * @return the number of bytes written on success, -1 on error.
+ */
+extern ssize_t zip_inflate(const void *src, size_t srcsize, void *buf,
+                           size_t bufsize);
+
 /**
  * Creates a new archive and puts files into a single zip archive.
  *
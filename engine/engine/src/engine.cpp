@@ -31,7 +31,9 @@
 #include <dlib/http_client.h>
 #include <dlib/log.h>
 #include <dlib/math.h>
+#include <dlib/memory.h>
 #include <dlib/memprofile.h>
+#include <dlib/message.h>
 #include <dlib/path.h>
 #include <dlib/profile.h>
 #include <dlib/socket.h>
@@ -175,6 +177,9 @@ namespace dmEngine
         dmExtension::DispatchEvent( &params, &event );
 
         dmGameSystem::OnWindowFocus(focus != 0);
+
+        if (engine->m_RenderContext)
+            dmRender::InvalidateRender(engine->m_RenderContext);
     }
 
     static void OnWindowIconify(void* user_data, uint32_t iconify)
@@ -194,6 +199,16 @@ namespace dmEngine
         dmExtension::DispatchEvent( &params, &event );
 
         dmGameSystem::OnWindowIconify(iconify != 0);
+
+        if (engine->m_RenderContext)
+            dmRender::InvalidateRender(engine->m_RenderContext);
+    }
+
+    // A hot reloaded resource may change what is on screen, when the engine renders on demand
+    static void ResourceReloadedCallback(const dmResource::ResourceReloadedParams* params)
+    {
+        Engine* engine = (Engine*)params->m_UserData;
+        dmRender::InvalidateRender(engine->m_RenderContext);
     }
 
     static void SetupComponentCreateContext(HEngine engine, dmGameObject::ComponentTypeCreateCtx& component_create_ctx)
@@ -226,6 +241,8 @@ namespace dmEngine
     , m_MainCollection(0)
     , m_LastReloadMTime(0)
     , m_MouseSensitivity(1.0f)
+    , m_JobThreadContext(0)
+    , m_ParallelJobThreadContext(0)
     , m_GraphicsContext(0)
     , m_RenderContext(0)
     , m_SharedScriptContext(0x0)
@@ -246,10 +263,26 @@ namespace dmEngine
     , m_ConnectionAppMode(false)
     , m_RunWhileIconified(false)
     , m_UseSwVSync(false)
+    , m_PipelinedFlip(false)
+    , m_FlipPending(false)
+    , m_AdaptivePacing(false)
+    , m_Headless(false)
+    , m_Deterministic(false)
+    , m_PerformanceHintCreated(false)
+    , m_ThermalThrottled(false)
+    , m_RenderOnDemand(false)
+    , m_LowLatencyInput(false)
     , m_Width(960)
     , m_Height(640)
     , m_InvPhysicalWidth(1.0f/960)
     , m_InvPhysicalHeight(1.0f/640)
+    , m_FrameWorkTime(0)
+    , m_FrameWaitTime(0)
+    , m_PerformanceHint(0)
+    , m_ThermalHeadroomLimit(0.0f)
+    , m_ThermalUpdateFrequency(0)
+    , m_IdleUpdateFrequency(0)
+    , m_IdleFrames(0)
     {
         m_EngineService = engine_service;
         m_Register = dmGameObject::NewRegister();
@@ -295,6 +328,11 @@ namespace dmEngine
 
         dmGameObject::DeleteCollections(engine->m_Register); // Delete all collections and game objects
 
+        // Destroy the unreferenced resources while their types are still registered
+        if (engine->m_Factory) {
+            dmResource::SetCacheEnabled(engine->m_Factory, false);
+        }
+
         dmHttpClient::ShutdownConnectionPool();
 
         // Reregister the types before the rest of the contexts are deleted
@@ -326,10 +364,20 @@ namespace dmEngine
 
         UnloadBootstrapContent(engine);
 
+        // The sound system waits for its decode jobs, so it is finalized before the job thread
         dmSound::Finalize();
 
+        dmPerformanceHint::DeleteSession(engine->m_PerformanceHint);
+        dmPerformanceHint::Finalize();
+
+        dmJobThread::Destroy(engine->m_ParallelJobThreadContext);
+
         dmInput::DeleteContext(engine->m_InputContext);
 
+        if (engine->m_RenderOnDemand && engine->m_Factory)
+        {
+            dmResource::UnregisterResourceReloadedCallback(engine->m_Factory, ResourceReloadedCallback, engine);
+        }
         dmRender::DeleteRenderContext(engine->m_RenderContext, engine->m_RenderScriptContext);
 
         if (engine->m_HidContext)
@@ -542,11 +590,106 @@ namespace dmEngine
         }
     }
 
+    // The tick rate when a fixed one is needed, but none is configured
+    static const uint32_t DEFAULT_TICK_RATE = 60;
+
+    // The lowest frame rate the adaptive pacing will go to is the refresh rate divided by this
+    static const uint32_t MAX_PACING_SWAP_INTERVAL = 4;
+
+    // When rendering on demand, the frames after the last change are still rendered, so that
+    // every buffer of the swap chain has the final image before the engine goes idle
+    static const uint32_t RENDER_ON_DEMAND_GRACE_FRAMES = 3;
+
     static void SetUpdateFrequency(HEngine engine, uint32_t frequency)
     {
         engine->m_UpdateFrequency = frequency;
     }
 
+    // The update frequency is restored when the thermal headroom is this much below the limit again
+    static const float THERMAL_HEADROOM_HYSTERESIS = 0.1f;
+    // The lowest update frequency the thermal throttling goes to
+    static const uint32_t MIN_THERMAL_UPDATE_FREQUENCY = 15;
+
+    // The work time a frame should fit within, in microseconds
+    static uint64_t GetTargetFrameTime(HEngine engine)
+    {
+        if (engine->m_AdaptivePacing)
+        {
+            return (uint64_t)(GetFramePacingDt(&engine->m_FramePacing) * 1000000.0f);
+        }
+        uint32_t frequency = engine->m_UpdateFrequency;
+        if (frequency == 0)
+        {
+            frequency = dmGraphics::GetWindowRefreshRate(engine->m_GraphicsContext);
+        }
+        return 1000000 / (frequency > 0 ? frequency : DEFAULT_TICK_RATE);
+    }
+
+    static void CreatePerformanceHint(HEngine engine)
+    {
+        int32_t thread_ids[1 + 2 * dmJobThread::DM_MAX_JOB_THREAD_COUNT];
+        uint32_t thread_count = 0;
+
+        int32_t main_thread_id = dmThread::GetCurrentThreadSystemId();
+        if (main_thread_id != 0)
+        {
+            thread_ids[thread_count++] = main_thread_id;
+        }
+        thread_count += dmJobThread::GetWorkerSystemThreadIds(engine->m_JobThreadContext, thread_ids + thread_count, dmJobThread::DM_MAX_JOB_THREAD_COUNT);
+        thread_count += dmJobThread::GetWorkerSystemThreadIds(engine->m_ParallelJobThreadContext, thread_ids + thread_count, dmJobThread::DM_MAX_JOB_THREAD_COUNT);
+
+        engine->m_PerformanceHint = dmPerformanceHint::NewSession(thread_ids, thread_count, GetTargetFrameTime(engine));
+        engine->m_PerformanceHintCreated = true;
+    }
+
+    // Reports the frame to the OS, and lowers the update frequency ahead of the thermal throttling
+    static void UpdatePerformanceHint(HEngine engine)
+    {
+        if (!engine->m_PerformanceHintCreated)
+        {
+            CreatePerformanceHint(engine);
+        }
+
+        if (engine->m_PerformanceHint)
+        {
+            dmPerformanceHint::SetTargetDuration(engine->m_PerformanceHint, GetTargetFrameTime(engine));
+            dmPerformanceHint::ReportDuration(engine->m_PerformanceHint, engine->m_FrameWorkTime);
+        }
+
+        // The adaptive pacing already lowers the frame rate when the frames get slower,
+        // and the deterministic mode doesn't use the update frequency
+        if (engine->m_ThermalHeadroomLimit <= 0.0f || engine->m_AdaptivePacing || engine->m_Deterministic)
+        {
+            return;
+        }
+
+        float headroom;
+        if (!dmPerformanceHint::GetThermalHeadroom(dmPerformanceHint::THERMAL_FORECAST_SECONDS, &headroom))
+        {
+            return;
+        }
+
+        if (!engine->m_ThermalThrottled && headroom >= engine->m_ThermalHeadroomLimit)
+        {
+            uint32_t frequency = engine->m_UpdateFrequency;
+            if (frequency == 0)
+            {
+                frequency = dmGraphics::GetWindowRefreshRate(engine->m_GraphicsContext);
+                frequency = frequency > 0 ? frequency : DEFAULT_TICK_RATE;
+            }
+            engine->m_ThermalThrottled = true;
+            engine->m_ThermalUpdateFrequency = engine->m_UpdateFrequency;
+            SetUpdateFrequency(engine, dmMath::Max(frequency / 2, MIN_THERMAL_UPDATE_FREQUENCY));
+            dmLogInfo("Thermal headroom is %.2f, the update frequency is lowered to %u", headroom, engine->m_UpdateFrequency);
+        }
+        else if (engine->m_ThermalThrottled && headroom < engine->m_ThermalHeadroomLimit - THERMAL_HEADROOM_HYSTERESIS)
+        {
+            engine->m_ThermalThrottled = false;
+            SetUpdateFrequency(engine, engine->m_ThermalUpdateFrequency);
+            dmLogInfo("Thermal headroom is %.2f, the update frequency is restored", headroom);
+        }
+    }
+
     struct LuaCallstackCtx
     {
         bool     m_First;
@@ -600,6 +743,91 @@ namespace dmEngine
         return (dmPlatform::PlatformGraphicsApi) -1;
     }
 
+    enum StartupJob
+    {
+        STARTUP_JOB_FACTORY,
+        STARTUP_JOB_SOUND,
+        STARTUP_JOB_PHYSICS,
+        STARTUP_JOB_COUNT,
+    };
+
+    // Engine startup steps that are independent of the graphics context and of each other
+    struct StartupContext
+    {
+        StartupContext(HEngine engine, dmJobThread::HContext job_thread)
+        : m_Engine(engine)
+        , m_JobThread(job_thread)
+        , m_ResourceUri(0)
+        , m_SoundResult(dmSound::RESULT_UNKNOWN_ERROR)
+        {
+            for (uint32_t i = 0; i < STARTUP_JOB_COUNT; ++i)
+                m_Jobs[i] = dmJobThread::INVALID_JOB;
+        }
+
+        // The jobs reference the context, so they must be done if Init() fails early
+        ~StartupContext();
+
+        HEngine                         m_Engine;
+        dmJobThread::HContext           m_JobThread;
+        dmJobThread::HJob               m_Jobs[STARTUP_JOB_COUNT];
+        dmResource::NewFactoryParams    m_FactoryParams;
+        const char*                     m_ResourceUri;
+        dmSound::InitializeParams       m_SoundParams;
+        dmSound::Result                 m_SoundResult;
+        dmPhysics::NewContextParams     m_PhysicsParams;
+    };
+
+    static int StartupNewFactory(void* context, void* data)
+    {
+        StartupContext* startup = (StartupContext*) context;
+        startup->m_Engine->m_Factory = dmResource::NewFactory(&startup->m_FactoryParams, startup->m_ResourceUri);
+        return 0;
+    }
+
+    static int StartupInitSound(void* context, void* data)
+    {
+        StartupContext* startup = (StartupContext*) context;
+        startup->m_SoundResult = dmSound::Initialize(startup->m_Engine->m_Config, &startup->m_SoundParams);
+        return 0;
+    }
+
+    static int StartupNewPhysics(void* context, void* data)
+    {
+        StartupContext* startup = (StartupContext*) context;
+        dmGameSystem::PhysicsContext& physics_context = startup->m_Engine->m_PhysicsContext;
+        if (physics_context.m_3D)
+            physics_context.m_Context3D = dmPhysics::NewContext3D(startup->m_PhysicsParams);
+        else
+            physics_context.m_Context2D = dmPhysics::NewContext2D(startup->m_PhysicsParams);
+        return 0;
+    }
+
+    static void StartStartupJob(StartupContext* startup, StartupJob job, dmJobThread::FProcess process)
+    {
+        startup->m_Jobs[job] = dmJobThread::CreateJob(startup->m_JobThread, process, 0, startup, 0);
+        if (startup->m_Jobs[job] == dmJobThread::INVALID_JOB)
+        {
+            process(startup, 0);
+            return;
+        }
+        dmJobThread::PushJob(startup->m_JobThread, startup->m_Jobs[job]);
+    }
+
+    static void WaitForStartupJob(StartupContext* startup, StartupJob job)
+    {
+        if (startup->m_Jobs[job] != dmJobThread::INVALID_JOB)
+        {
+            dmJobThread::WaitForJob(startup->m_JobThread, startup->m_Jobs[job]);
+            startup->m_Jobs[job] = dmJobThread::INVALID_JOB;
+        }
+    }
+
+    StartupContext::~StartupContext()
+    {
+        for (uint32_t i = 0; i < STARTUP_JOB_COUNT; ++i)
+            WaitForStartupJob(this, (StartupJob) i);
+    }
+
     /*
      The game.projectc is located using the following scheme:
 
@@ -776,6 +1004,12 @@ namespace dmEngine
             }
         }
 
+        // A benchmark runs with vsync disabled and a fixed dt (see CalcTimeStep)
+        if (!InitBenchmark(&engine->m_Benchmark, argc, argv))
+        {
+            return false;
+        }
+
         dmBuffer::NewContext();
 
         dmHID::NewContextParams new_hid_params = dmHID::NewContextParams();
@@ -914,9 +1148,15 @@ namespace dmEngine
             return false;
         }
 
+#if defined(DM_HEADLESS)
+        engine->m_Headless = true;
+#else
+        engine->m_Headless = dmConfigFile::GetInt(engine->m_Config, "engine.headless", 0) != 0;
+#endif
+
         bool setting_vsync     = dmConfigFile::GetInt(engine->m_Config, "display.vsync", true); // Deprecated
         uint32_t swap_interval = dmConfigFile::GetInt(engine->m_Config, "display.swap_interval", 1);
-        if (!setting_vsync)
+        if (!setting_vsync || engine->m_Benchmark.m_FrameCount || engine->m_Headless)
         {
             swap_interval = 0;
         }
@@ -926,6 +1166,114 @@ namespace dmEngine
         job_thread_create_param.m_ThreadCount    = 1;
         engine->m_JobThreadContext               = dmJobThread::Create(job_thread_create_param);
 
+        // The graphics backends expect a single worker in the job thread above, so we use a separate pool for the parallel loops
+        uint32_t parallel_job_thread_count = dmMath::Min((uint32_t)dmConfigFile::GetInt(engine->m_Config, "job_thread.count", 3), (uint32_t)dmJobThread::DM_MAX_JOB_THREAD_COUNT);
+        dmJobThread::JobThreadCreationParams parallel_job_thread_create_param;
+        for (uint32_t i = 0; i < parallel_job_thread_count; ++i)
+            parallel_job_thread_create_param.m_ThreadNames[i] = "DefoldWorker";
+        parallel_job_thread_create_param.m_ThreadCount = (uint8_t)parallel_job_thread_count;
+        engine->m_ParallelJobThreadContext = dmJobThread::Create(parallel_job_thread_create_param);
+
+        // The steps below don't need the graphics context, so they run on the worker threads while it's being created.
+        // Each is waited for right before its result is first used
+        StartupContext startup(engine, engine->m_ParallelJobThreadContext);
+
+        const uint32_t max_resources = dmConfigFile::GetInt(engine->m_Config, dmResource::MAX_RESOURCES_KEY, 1024);
+        dmResource::NewFactoryParams& params = startup.m_FactoryParams;
+        params.m_MaxResources = max_resources;
+        params.m_LoadThreadCount = dmConfigFile::GetInt(engine->m_Config, dmResource::LOAD_THREAD_COUNT_KEY, 2);
+        params.m_Flags = 0;
+
+        if (dLib::IsDebugMode())
+        {
+            params.m_Flags = RESOURCE_FACTORY_FLAGS_RELOAD_SUPPORT;
+
+            int32_t http_cache = dmConfigFile::GetInt(engine->m_Config, "resource.http_cache", 1);
+            if (http_cache)
+                params.m_Flags |= RESOURCE_FACTORY_FLAGS_HTTP_CACHE;
+
+            // Records the load order, for laying out the archive. See /resource_load_order in the engine service
+            if (dmConfigFile::GetInt(engine->m_Config, "resource.load_order", 0))
+                params.m_Flags |= RESOURCE_FACTORY_FLAGS_LOAD_ORDER;
+        }
+
+        int32_t liveupdate_enable = dmConfigFile::GetInt(engine->m_Config, "liveupdate.enabled", 1);
+        int32_t liveupdate_mount_on_start = dmConfigFile::GetInt(engine->m_Config, "liveupdate.mount_on_start", 1);
+        if (liveupdate_enable && liveupdate_mount_on_start)
+        {
+            params.m_Flags |= RESOURCE_FACTORY_FLAGS_LIVE_UPDATE_MOUNTS_ON_START;
+        }
+
+#if !defined(DM_RELEASE)
+        params.m_ArchiveIndex.m_Data = (const void*) BUILTINS_ARCI;
+        params.m_ArchiveIndex.m_Size = BUILTINS_ARCI_SIZE;
+        params.m_ArchiveData.m_Data = (const void*) BUILTINS_ARCD;
+        params.m_ArchiveData.m_Size = BUILTINS_ARCD_SIZE;
+        params.m_ArchiveManifest.m_Data = (const void*) BUILTINS_DMANIFEST;
+        params.m_ArchiveManifest.m_Size = BUILTINS_DMANIFEST_SIZE;
+#endif
+
+        const char* resource_uri = dmConfigFile::GetString(engine->m_Config, "resource.uri", project_file_uri);
+        dmLogInfo("Loading data from: %s", resource_uri);
+        startup.m_ResourceUri = resource_uri;
+        StartStartupJob(&startup, STARTUP_JOB_FACTORY, StartupNewFactory);
+
+        dmSound::InitializeParams& sound_params = startup.m_SoundParams;
+        sound_params.m_OutputDevice = "default";
+        sound_params.m_JobThread = engine->m_ParallelJobThreadContext;
+#if defined(__EMSCRIPTEN__)
+        // The web audio device can only be used from the main thread, also in pthread builds.
+        // The sounds are still decoded ahead on the job thread workers when they are available
+        sound_params.m_UseThread = false;
+#else
+        sound_params.m_UseThread = dmConfigFile::GetInt(engine->m_Config, "sound.use_thread", 1) != 0;
+#endif
+#if defined(DM_PLATFORM_IOS) || defined(ANDROID) || defined(__EMSCRIPTEN__)
+        // The platform setup registers with the application (the UIApplication delegate and the audio session
+        // notifications on iOS, the activity on Android, the web audio context), which must be done on the main thread
+        StartupInitSound(&startup, 0);
+#else
+        StartStartupJob(&startup, STARTUP_JOB_SOUND, StartupInitSound);
+#endif
+
+        dmPhysics::NewContextParams& physics_params = startup.m_PhysicsParams;
+        physics_params.m_WorldCount = dmConfigFile::GetInt(engine->m_Config, "physics.world_count", 4);
+        const char* physics_type = dmConfigFile::GetString(engine->m_Config, "physics.type", "2D");
+        physics_params.m_Gravity.setX(dmConfigFile::GetFloat(engine->m_Config, "physics.gravity_x", 0.0f));
+        physics_params.m_Gravity.setY(dmConfigFile::GetFloat(engine->m_Config, "physics.gravity_y", -10.0f));
+        physics_params.m_Gravity.setZ(dmConfigFile::GetFloat(engine->m_Config, "physics.gravity_z", 0.0f));
+        physics_params.m_Scale = dmConfigFile::GetFloat(engine->m_Config, "physics.scale", 1.0f);
+        physics_params.m_RayCastLimit2D = dmConfigFile::GetInt(engine->m_Config, "physics.ray_cast_limit_2d", 64);
+        physics_params.m_RayCastLimit3D = dmConfigFile::GetInt(engine->m_Config, "physics.ray_cast_limit_3d", 128);
+        physics_params.m_TriggerOverlapCapacity = dmConfigFile::GetInt(engine->m_Config, "physics.trigger_overlap_capacity", 16);
+        physics_params.m_JobThread = engine->m_ParallelJobThreadContext;
+        physics_params.m_WorkerCount = dmConfigFile::GetInt(engine->m_Config, "physics.worker_count", 0);
+        physics_params.m_VelocityThreshold = dmConfigFile::GetFloat(engine->m_Config, "physics.velocity_threshold", 1.0f);
+        if (physics_params.m_Scale < dmPhysics::MIN_SCALE || physics_params.m_Scale > dmPhysics::MAX_SCALE)
+        {
+            dmLogWarning("Physics scale must be in the range %.2f - %.2f and has been clamped.", dmPhysics::MIN_SCALE, dmPhysics::MAX_SCALE);
+            if (physics_params.m_Scale < dmPhysics::MIN_SCALE)
+                physics_params.m_Scale = dmPhysics::MIN_SCALE;
+            if (physics_params.m_Scale > dmPhysics::MAX_SCALE)
+                physics_params.m_Scale = dmPhysics::MAX_SCALE;
+        }
+        physics_params.m_ContactImpulseLimit = dmConfigFile::GetFloat(engine->m_Config, "physics.contact_impulse_limit", 0.0f);
+        physics_params.m_AllowDynamicTransforms = dmConfigFile::GetInt(engine->m_Config, "physics.allow_dynamic_transforms", 1) ? 1 : 0;
+        if (dmStrCaseCmp(physics_type, "3D") == 0)
+        {
+            engine->m_PhysicsContext.m_3D = true;
+        }
+        else if (dmStrCaseCmp(physics_type, "2D") == 0)
+        {
+            engine->m_PhysicsContext.m_3D = false;
+        }
+        else
+        {
+            dmLogWarning("Unsupported physics type '%s'. Defaults to 2D", physics_type);
+            engine->m_PhysicsContext.m_3D = false;
+        }
+        StartStartupJob(&startup, STARTUP_JOB_PHYSICS, StartupNewPhysics);
+
         dmGraphics::ContextParams graphics_context_params;
         graphics_context_params.m_DefaultTextureMinFilter = ConvertMinTextureFilter(dmConfigFile::GetString(engine->m_Config, "graphics.default_texture_min_filter", "linear"));
         graphics_context_params.m_DefaultTextureMagFilter = ConvertMagTextureFilter(dmConfigFile::GetString(engine->m_Config, "graphics.default_texture_mag_filter", "linear"));
@@ -940,6 +1288,18 @@ namespace dmEngine
         graphics_context_params.m_JobThread               = engine->m_JobThreadContext;
         graphics_context_params.m_SwapInterval            = swap_interval;
 
+        char pipeline_cache_path[DMPATH_MAX_PATH];
+        if (dmConfigFile::GetInt(engine->m_Config, "graphics.pipeline_cache", 1))
+        {
+            char application_support_path[DMPATH_MAX_PATH];
+            const char* application_dir = dmConfigFile::GetString(engine->m_Config, "project.title_as_file_name", "defold");
+            if (dmSys::GetApplicationSupportPath(application_dir, application_support_path, sizeof(application_support_path)) == dmSys::RESULT_OK)
+            {
+                dmPath::Concat(application_support_path, "pipeline_cache.bin", pipeline_cache_path, sizeof(pipeline_cache_path));
+                graphics_context_params.m_PipelineCachePath = pipeline_cache_path;
+            }
+        }
+
         engine->m_GraphicsContext = dmGraphics::NewContext(graphics_context_params);
         if (engine->m_GraphicsContext == 0x0)
         {
@@ -959,46 +1319,38 @@ namespace dmEngine
         engine->m_RunWhileIconified = dmConfigFile::GetInt(engine->m_Config, "engine.run_while_iconified", 0);
 #endif
 
+        engine->m_PipelinedFlip = dmConfigFile::GetInt(engine->m_Config, "engine.pipelined_flip", 0) != 0;
         engine->m_FixedUpdateFrequency = dmConfigFile::GetInt(engine->m_Config, "engine.fixed_update_frequency", 60);
         engine->m_MaxTimeStep = dmConfigFile::GetFloat(engine->m_Config, "engine.max_time_step", 0.5);
+        engine->m_RenderOnDemand = dmConfigFile::GetInt(engine->m_Config, "engine.render_on_demand", 0) != 0;
+        engine->m_IdleUpdateFrequency = dmConfigFile::GetInt(engine->m_Config, "engine.idle_update_frequency", 15);
 
         dmGameSystem::OnWindowCreated(physical_width, physical_height);
 
         SetUpdateFrequency(engine, dmConfigFile::GetInt(engine->m_Config, "display.update_frequency", 0));
-
-        const uint32_t max_resources = dmConfigFile::GetInt(engine->m_Config, dmResource::MAX_RESOURCES_KEY, 1024);
-        dmResource::NewFactoryParams params;
-        params.m_MaxResources = max_resources;
-        params.m_Flags = 0;
-
-        if (dLib::IsDebugMode())
+        if (engine->m_Headless && engine->m_UpdateFrequency == 0)
         {
-            params.m_Flags = RESOURCE_FACTORY_FLAGS_RELOAD_SUPPORT;
-
-            int32_t http_cache = dmConfigFile::GetInt(engine->m_Config, "resource.http_cache", 1);
-            if (http_cache)
-                params.m_Flags |= RESOURCE_FACTORY_FLAGS_HTTP_CACHE;
+            // There's no vsync to wait for, so the tick rate is always fixed
+            SetUpdateFrequency(engine, DEFAULT_TICK_RATE);
         }
 
-        int32_t liveupdate_enable = dmConfigFile::GetInt(engine->m_Config, "liveupdate.enabled", 1);
-        int32_t liveupdate_mount_on_start = dmConfigFile::GetInt(engine->m_Config, "liveupdate.mount_on_start", 1);
-        if (liveupdate_enable && liveupdate_mount_on_start)
+        engine->m_Deterministic = dmConfigFile::GetInt(engine->m_Config, "engine.deterministic", 0) != 0;
+
+        // The pacing only changes the swap interval, so it needs vsync to be on.
+        // It also changes the dt, which the deterministic mode doesn't allow.
+        if (dmConfigFile::GetInt(engine->m_Config, "display.adaptive_pacing", 0) && swap_interval > 0 && !engine->m_Deterministic)
         {
-            params.m_Flags |= RESOURCE_FACTORY_FLAGS_LIVE_UPDATE_MOUNTS_ON_START;
+            uint32_t refresh_rate = dmGraphics::GetWindowRefreshRate(engine->m_GraphicsContext);
+            engine->m_AdaptivePacing = true;
+            InitFramePacing(&engine->m_FramePacing, refresh_rate, MAX_PACING_SWAP_INTERVAL, refresh_rate);
+            engine->m_FramePacing.m_Divisor = dmMath::Min(swap_interval, MAX_PACING_SWAP_INTERVAL);
         }
 
-#if !defined(DM_RELEASE)
-        params.m_ArchiveIndex.m_Data = (const void*) BUILTINS_ARCI;
-        params.m_ArchiveIndex.m_Size = BUILTINS_ARCI_SIZE;
-        params.m_ArchiveData.m_Data = (const void*) BUILTINS_ARCD;
-        params.m_ArchiveData.m_Size = BUILTINS_ARCD_SIZE;
-        params.m_ArchiveManifest.m_Data = (const void*) BUILTINS_DMANIFEST;
-        params.m_ArchiveManifest.m_Size = BUILTINS_DMANIFEST_SIZE;
-#endif
+        // E.g. 0.9 halves the update frequency just before the device starts to throttle (see sys.get_thermal_headroom)
+        engine->m_ThermalHeadroomLimit = dmConfigFile::GetFloat(engine->m_Config, "engine.thermal_headroom_limit", 0.0f);
 
-        const char* resource_uri = dmConfigFile::GetString(engine->m_Config, "resource.uri", project_file_uri);
-        dmLogInfo("Loading data from: %s", resource_uri);
-        engine->m_Factory = dmResource::NewFactory(&params, resource_uri);
+
+        WaitForStartupJob(&startup, STARTUP_JOB_FACTORY);
         if (!engine->m_Factory)
         {
             return false;
@@ -1012,6 +1364,7 @@ namespace dmEngine
         script_params.m_Factory         = engine->m_Factory;
         script_params.m_ConfigFile      = engine->m_Config;
         script_params.m_GraphicsContext = engine->m_GraphicsContext;
+        script_params.m_JobThread       = engine->m_JobThreadContext;
 
         bool shared = dmConfigFile::GetInt(engine->m_Config, "script.shared_state", 0);
         if (shared)
@@ -1038,16 +1391,9 @@ namespace dmEngine
             module_script_contexts.Push(engine->m_GuiScriptContext);
         }
 
-        dmSound::InitializeParams sound_params;
-        sound_params.m_OutputDevice = "default";
-#if defined(__EMSCRIPTEN__)
-        sound_params.m_UseThread = false;
-#else
-        sound_params.m_UseThread = dmConfigFile::GetInt(engine->m_Config, "sound.use_thread", 1) != 0;
-#endif
-        dmSound::Result soundInit = dmSound::Initialize(engine->m_Config, &sound_params);
-        if (dmSound::RESULT_OK == soundInit) {
-            dmLogInfo("Initialised sound device '%s'", sound_params.m_OutputDevice);
+        WaitForStartupJob(&startup, STARTUP_JOB_SOUND);
+        if (dmSound::RESULT_OK == startup.m_SoundResult) {
+            dmLogInfo("Initialised sound device '%s'", startup.m_SoundParams.m_OutputDevice);
         } else {
             dmLogWarning("Failed to initialize sound system.");
         }
@@ -1059,6 +1405,10 @@ namespace dmEngine
             return false;
         }
         dmGameObject::SetInputStackDefaultCapacity(engine->m_Register, dmConfigFile::GetInt(engine->m_Config, dmGameObject::COLLECTION_MAX_INPUT_STACK_ENTRIES_KEY, dmGameObject::DEFAULT_MAX_INPUT_STACK_CAPACITY));
+        dmGameObject::SetInputBatchDispatch(engine->m_Register, dmConfigFile::GetInt(engine->m_Config, "input.batch_dispatch", 0) != 0);
+        engine->m_LowLatencyInput = dmConfigFile::GetInt(engine->m_Config, "input.low_latency", 0) != 0;
+        dmGameObject::SetDeterministic(engine->m_Register, engine->m_Deterministic);
+        dmGameObject::SetJobThread(engine->m_Register, engine->m_ParallelJobThreadContext);
 
         dmRender::RenderContextParams render_params;
         render_params.m_MaxRenderTypes = 16;
@@ -1077,15 +1427,23 @@ namespace dmEngine
         render_params.m_MaxDebugVertexCount = 0;
 #endif
         render_params.m_MaxBatches = (uint32_t) dmConfigFile::GetInt(engine->m_Config, "graphics.max_font_batches", 128);
+        render_params.m_JobThread = engine->m_ParallelJobThreadContext;
         engine->m_RenderContext = dmRender::NewRenderContext(engine->m_GraphicsContext, render_params);
+        if (engine->m_RenderOnDemand)
+        {
+            dmResource::RegisterResourceReloadedCallback(engine->m_Factory, ResourceReloadedCallback, engine);
+        }
 
         dmGameObject::Initialize(engine->m_Register, engine->m_GOScriptContext);
 
         engine->m_ParticleFXContext.m_Factory = engine->m_Factory;
         engine->m_ParticleFXContext.m_RenderContext = engine->m_RenderContext;
+        engine->m_ParticleFXContext.m_JobThread = engine->m_ParallelJobThreadContext;
         engine->m_ParticleFXContext.m_MaxParticleFXCount = dmConfigFile::GetInt(engine->m_Config, dmParticle::MAX_INSTANCE_COUNT_KEY, 64);
         engine->m_ParticleFXContext.m_MaxEmitterCount = dmConfigFile::GetInt(engine->m_Config, dmParticle::MAX_EMITTER_COUNT_KEY, 64);
         engine->m_ParticleFXContext.m_MaxParticleCount = dmConfigFile::GetInt(engine->m_Config, dmParticle::MAX_PARTICLE_COUNT_KEY, 1024);
+        engine->m_ParticleFXContext.m_OffscreenMode = dmConfigFile::GetInt(engine->m_Config, dmParticle::OFFSCREEN_MODE_KEY, dmParticle::OFFSCREEN_MODE_SIMULATE);
+        engine->m_ParticleFXContext.m_SortInterval = dmConfigFile::GetInt(engine->m_Config, dmParticle::SORT_INTERVAL_KEY, 1);
         engine->m_ParticleFXContext.m_Debug = false;
 
         dmInput::NewContextParams input_params;
@@ -1140,48 +1498,13 @@ namespace dmEngine
 
         engine->m_GuiContext = dmGui::NewContext(&gui_params);
 
-        dmPhysics::NewContextParams physics_params;
-        physics_params.m_WorldCount = dmConfigFile::GetInt(engine->m_Config, "physics.world_count", 4);
-        const char* physics_type = dmConfigFile::GetString(engine->m_Config, "physics.type", "2D");
-        physics_params.m_Gravity.setX(dmConfigFile::GetFloat(engine->m_Config, "physics.gravity_x", 0.0f));
-        physics_params.m_Gravity.setY(dmConfigFile::GetFloat(engine->m_Config, "physics.gravity_y", -10.0f));
-        physics_params.m_Gravity.setZ(dmConfigFile::GetFloat(engine->m_Config, "physics.gravity_z", 0.0f));
-        physics_params.m_Scale = dmConfigFile::GetFloat(engine->m_Config, "physics.scale", 1.0f);
-        physics_params.m_RayCastLimit2D = dmConfigFile::GetInt(engine->m_Config, "physics.ray_cast_limit_2d", 64);
-        physics_params.m_RayCastLimit3D = dmConfigFile::GetInt(engine->m_Config, "physics.ray_cast_limit_3d", 128);
-        physics_params.m_TriggerOverlapCapacity = dmConfigFile::GetInt(engine->m_Config, "physics.trigger_overlap_capacity", 16);
-        physics_params.m_VelocityThreshold = dmConfigFile::GetFloat(engine->m_Config, "physics.velocity_threshold", 1.0f);
-        if (physics_params.m_Scale < dmPhysics::MIN_SCALE || physics_params.m_Scale > dmPhysics::MAX_SCALE)
-        {
-            dmLogWarning("Physics scale must be in the range %.2f - %.2f and has been clamped.", dmPhysics::MIN_SCALE, dmPhysics::MAX_SCALE);
-            if (physics_params.m_Scale < dmPhysics::MIN_SCALE)
-                physics_params.m_Scale = dmPhysics::MIN_SCALE;
-            if (physics_params.m_Scale > dmPhysics::MAX_SCALE)
-                physics_params.m_Scale = dmPhysics::MAX_SCALE;
-        }
-        physics_params.m_ContactImpulseLimit = dmConfigFile::GetFloat(engine->m_Config, "physics.contact_impulse_limit", 0.0f);
-        physics_params.m_AllowDynamicTransforms = dmConfigFile::GetInt(engine->m_Config, "physics.allow_dynamic_transforms", 1) ? 1 : 0;
-        if (dmStrCaseCmp(physics_type, "3D") == 0)
-        {
-            engine->m_PhysicsContext.m_3D = true;
-            engine->m_PhysicsContext.m_Context3D = dmPhysics::NewContext3D(physics_params);
-        }
-        else if (dmStrCaseCmp(physics_type, "2D") == 0)
-        {
-            engine->m_PhysicsContext.m_3D = false;
-            engine->m_PhysicsContext.m_Context2D = dmPhysics::NewContext2D(physics_params);
-        }
-        else
-        {
-            dmLogWarning("Unsupported physics type '%s'. Defaults to 2D", physics_type);
-            engine->m_PhysicsContext.m_3D = false;
-            engine->m_PhysicsContext.m_Context2D = dmPhysics::NewContext2D(physics_params);
-        }
+        WaitForStartupJob(&startup, STARTUP_JOB_PHYSICS);
         engine->m_PhysicsContext.m_MaxCollisionObjectCount = dmConfigFile::GetInt(engine->m_Config, dmGameSystem::PHYSICS_MAX_COLLISION_OBJECTS_KEY, 128);
         engine->m_PhysicsContext.m_MaxCollisionCount = dmConfigFile::GetInt(engine->m_Config, dmGameSystem::PHYSICS_MAX_COLLISIONS_KEY, 64);
         engine->m_PhysicsContext.m_MaxContactPointCount = dmConfigFile::GetInt(engine->m_Config, dmGameSystem::PHYSICS_MAX_CONTACTS_KEY, 128);
         engine->m_PhysicsContext.m_UseFixedTimestep = dmConfigFile::GetInt(engine->m_Config, dmGameSystem::PHYSICS_USE_FIXED_TIMESTEP, 1) ? 1 : 0;
         engine->m_PhysicsContext.m_MaxFixedTimesteps = dmConfigFile::GetInt(engine->m_Config, dmGameSystem::PHYSICS_MAX_FIXED_TIMESTEPS, 2);
+        engine->m_PhysicsContext.m_FixedTimestepInterpolation = dmConfigFile::GetInt(engine->m_Config, dmGameSystem::PHYSICS_FIXED_TIMESTEP_INTERPOLATION, 0) ? 1 : 0;
         // TODO: Should move inside the ifdef release? Is this usable without the debug callbacks?
         engine->m_PhysicsContext.m_Debug = (bool) dmConfigFile::GetInt(engine->m_Config, "physics.debug", 0);
 
@@ -1190,6 +1513,7 @@ namespace dmEngine
         debug_callbacks.m_UserData = engine->m_RenderContext;
         debug_callbacks.m_DrawLines = PhysicsDebugRender::DrawLines;
         debug_callbacks.m_DrawTriangles = PhysicsDebugRender::DrawTriangles;
+        debug_callbacks.m_IsVisible = PhysicsDebugRender::IsVisible;
         debug_callbacks.m_Alpha = dmConfigFile::GetFloat(engine->m_Config, "physics.debug_alpha", 0.9f);
         debug_callbacks.m_Scale = physics_params.m_Scale;
         debug_callbacks.m_InvScale = 1.0f / physics_params.m_Scale;
@@ -1203,10 +1527,14 @@ namespace dmEngine
         engine->m_SpriteContext.m_RenderContext = engine->m_RenderContext;
         engine->m_SpriteContext.m_MaxSpriteCount = dmConfigFile::GetInt(engine->m_Config, "sprite.max_count", 128);
         engine->m_SpriteContext.m_Subpixels = dmConfigFile::GetInt(engine->m_Config, "sprite.subpixels", 1);
+        engine->m_SpriteContext.m_JobThread = engine->m_ParallelJobThreadContext;
 
         engine->m_ModelContext.m_RenderContext = engine->m_RenderContext;
         engine->m_ModelContext.m_Factory = engine->m_Factory;
         engine->m_ModelContext.m_MaxModelCount = dmConfigFile::GetInt(engine->m_Config, "model.max_count", 128);
+        engine->m_ModelContext.m_JobThread = engine->m_ParallelJobThreadContext;
+        engine->m_ModelContext.m_PoseUpdateDistance = dmConfigFile::GetFloat(engine->m_Config, "model.pose_update_distance", 0.0f);
+        engine->m_ModelContext.m_LodScreenSize      = dmConfigFile::GetFloat(engine->m_Config, "model.lod_screen_size", 0.0f);
 
         engine->m_LabelContext.m_RenderContext      = engine->m_RenderContext;
         engine->m_LabelContext.m_MaxLabelCount      = dmConfigFile::GetInt(engine->m_Config, "label.max_count", 64);
@@ -1221,11 +1549,15 @@ namespace dmEngine
 
         engine->m_CollectionProxyContext.m_Factory = engine->m_Factory;
         engine->m_CollectionProxyContext.m_MaxCollectionProxyCount = dmConfigFile::GetInt(engine->m_Config, dmGameSystem::COLLECTION_PROXY_MAX_COUNT_KEY, 8);
+        engine->m_CollectionProxyContext.m_InitTimeBudget = dmConfigFile::GetInt(engine->m_Config, dmGameSystem::COLLECTION_PROXY_INIT_TIME_BUDGET_KEY, 4) * 1000;
 
         engine->m_FactoryContext.m_MaxFactoryCount = dmConfigFile::GetInt(engine->m_Config, dmGameSystem::FACTORY_MAX_COUNT_KEY, 128);
         engine->m_FactoryContext.m_Factory = engine->m_Factory;
         engine->m_CollectionFactoryContext.m_MaxCollectionFactoryCount = dmConfigFile::GetInt(engine->m_Config, dmGameSystem::COLLECTION_FACTORY_MAX_COUNT_KEY, 128);
         engine->m_CollectionFactoryContext.m_Factory = engine->m_Factory;
+
+        dmGameSystem::SetTextureStreamingBudget(dmConfigFile::GetInt(engine->m_Config, dmGameSystem::TEXTURE_STREAMING_BUDGET_KEY, 0) * 1024 * 1024); // MB -> bytes
+
         if (shared)
         {
             engine->m_FactoryContext.m_ScriptContext = engine->m_SharedScriptContext;
@@ -1264,6 +1596,20 @@ namespace dmEngine
         if (fact_result != dmResource::RESULT_OK)
             goto bail;
 
+        {
+            // Keep unreferenced resources that are expensive to load around, in case they're requested again
+            uint32_t cache_budget = (uint32_t) dmConfigFile::GetInt(engine->m_Config, dmResource::CACHE_BUDGET_KEY, 0);
+            const char* cached_types[] = { "texturec", "glyph_bankc", "wavc", "oggc", "opusc" };
+            for (uint32_t i = 0; i < DM_ARRAY_SIZE(cached_types); ++i)
+            {
+                HResourceType type;
+                if (dmResource::GetTypeFromExtension(engine->m_Factory, cached_types[i], &type) == dmResource::RESULT_OK)
+                {
+                    ResourceTypeSetCacheBudget(type, cache_budget);
+                }
+            }
+        }
+
         go_result = dmGameSystem::RegisterComponentTypes(engine->m_Factory, engine->m_Register, engine->m_RenderContext, &engine->m_PhysicsContext, &engine->m_ParticleFXContext, &engine->m_SpriteContext,
                                                                                                 &engine->m_CollectionProxyContext, &engine->m_FactoryContext, &engine->m_CollectionFactoryContext,
                                                                                                 &engine->m_ModelContext, &engine->m_LabelContext, &engine->m_TilemapContext,
@@ -1450,7 +1796,7 @@ namespace dmEngine
 
         if (engine->m_EngineService)
         {
-            dmEngineService::InitProfiler(engine->m_EngineService, engine->m_Factory, engine->m_Register);
+            dmEngineService::InitProfiler(engine->m_EngineService, engine->m_Factory, engine->m_Register, dmScript::GetLuaState(engine->m_GOScriptContext));
         }
 
         {
@@ -1467,6 +1813,11 @@ namespace dmEngine
             dmExtension::DispatchEvent( &params, &event );
         }
 
+        if (engine->m_Benchmark.m_FrameCount)
+        {
+            StartBenchmark(&engine->m_Benchmark, engine->m_GraphicsContext, dmConfigFile::GetString(engine->m_Config, "bootstrap.main_collection", "/logic/main.collectionc"), engine->m_FixedUpdateFrequency);
+        }
+
         engine->m_PreviousFrameTime = dmTime::GetTime();
 
         return true;
@@ -1536,6 +1887,7 @@ bail:
         input_action.m_HasGamepadPacket = action->m_HasGamepadPacket;
 
         input_action.m_UserID = action->m_UserID;
+        input_action.m_Timestamp = action->m_Timestamp;
 
         input_buffer->Push(input_action);
     }
@@ -1570,6 +1922,86 @@ bail:
         return memcount;
     }
 
+    static void RecordPixelReadback(void* user_data, uint32_t readback_id, const void* pixels, uint32_t size)
+    {
+        RecordData* record_data = (RecordData*) user_data;
+        dmRecord::Result r = dmRecord::RecordFrame(record_data->m_Recorder, pixels, size, dmRecord::BUFFER_FORMAT_BGRA);
+        if (r != dmRecord::RESULT_OK)
+        {
+            dmLogError("Error while recoding frame (%d)", r);
+        }
+    }
+
+    // Reads back the frame for the recorder, if it's running, and presents it
+    static void FlipFrame(HEngine engine)
+    {
+        DM_PROFILE("Flip");
+        uint64_t flip_start = dmTime::GetTime();
+
+        // The frame is read back asynchronously when possible, and recorded when the pixels arrive a few frames later
+        RecordData* record_data = &engine->m_RecordData;
+        bool pixel_readback = record_data->m_Recorder && dmGraphics::IsPixelReadbackSupported(engine->m_GraphicsContext);
+        if (pixel_readback && record_data->m_FrameCount % record_data->m_FramePeriod == 0)
+        {
+            if (!dmGraphics::ReadPixelsAsync(engine->m_GraphicsContext, record_data->m_FrameCount))
+            {
+                // All the readbacks are in flight, wait for them rather than dropping the frame
+                dmGraphics::ResolvePixelReadbacks(engine->m_GraphicsContext, RecordPixelReadback, record_data, true);
+                dmGraphics::ReadPixelsAsync(engine->m_GraphicsContext, record_data->m_FrameCount);
+            }
+        }
+
+        dmGraphics::Flip(engine->m_GraphicsContext);
+
+        if (record_data->m_Recorder)
+        {
+            if (pixel_readback)
+            {
+                dmGraphics::ResolvePixelReadbacks(engine->m_GraphicsContext, RecordPixelReadback, record_data, false);
+            }
+            else if (record_data->m_FrameCount % record_data->m_FramePeriod == 0)
+            {
+                uint32_t width = dmGraphics::GetWidth(engine->m_GraphicsContext);
+                uint32_t height = dmGraphics::GetHeight(engine->m_GraphicsContext);
+                uint32_t buffer_size = width * height * 4;
+
+                dmGraphics::ReadPixels(engine->m_GraphicsContext, record_data->m_Buffer, buffer_size);
+
+                dmRecord::Result r = dmRecord::RecordFrame(record_data->m_Recorder, record_data->m_Buffer, buffer_size, dmRecord::BUFFER_FORMAT_BGRA);
+                if (r != dmRecord::RESULT_OK)
+                {
+                    dmLogError("Error while recoding frame (%d)", r);
+                }
+            }
+            record_data->m_FrameCount++;
+        }
+
+        engine->m_FrameWaitTime += dmTime::GetTime() - flip_start;
+    }
+
+    // Returns true if the frame needs to be rendered, when the engine renders on demand
+    static bool IsRenderNeeded(HEngine engine, bool has_input)
+    {
+        // Always consumed, so that the invalidations of an idle frame don't carry over
+        bool invalidated = dmRender::ConsumeRenderInvalidated(engine->m_RenderContext);
+        if (invalidated || has_input || dmGameObject::HasAnimations(engine->m_Register))
+        {
+            engine->m_IdleFrames = 0;
+            return true;
+        }
+        if (engine->m_IdleFrames < RENDER_ON_DEMAND_GRACE_FRAMES)
+        {
+            ++engine->m_IdleFrames;
+            return true;
+        }
+        return false;
+    }
+
+    static bool IsIdle(HEngine engine)
+    {
+        return engine->m_RenderOnDemand && engine->m_IdleFrames >= RENDER_ON_DEMAND_GRACE_FRAMES;
+    }
+
     static void StepFrame(HEngine engine, float dt)
     {
         uint64_t frame_start = dmTime::GetTime();
@@ -1610,6 +2042,8 @@ bail:
         {
             DM_PROFILE("Frame");
 
+            bool rendered = false;
+            bool render_frame = true;
             {
                 DM_PROFILE("Sim");
 
@@ -1672,6 +2106,13 @@ bail:
 
                 dmSound::Update();
 
+                if (engine->m_LowLatencyInput)
+                {
+                    // Sample the keyboard and mouse again, to pick up what happened during the script and sound updates
+                    DM_PROFILE("HidPoll");
+                    dmHID::Poll(engine->m_HidContext);
+                }
+
                 bool esc_pressed = false;
                 if (engine->m_QuitOnEsc)
                 {
@@ -1691,7 +2132,15 @@ bail:
                 dmInput::UpdateBinding(engine->m_GameInputBinding, dt);
 
                 engine->m_InputBuffer.SetSize(0);
-                dmInput::ForEachActive(engine->m_GameInputBinding, GOActionCallback, engine);
+                if (engine->m_Benchmark.m_FrameCount)
+                {
+                    // The device input is replaced, to run the same frames each time
+                    AddBenchmarkInput(&engine->m_Benchmark, &engine->m_InputBuffer);
+                }
+                else
+                {
+                    dmInput::ForEachActive(engine->m_GameInputBinding, GOActionCallback, engine);
+                }
 
                 // Sort input so that text and marked text is triggered last
                 // NOTE: Due to Korean keyboards on iOS will send a backspace sometimes to "replace" a character with a new one,
@@ -1715,9 +2164,23 @@ bail:
                 update_context.m_AccumFrameTime = engine->m_AccumFrameTime;
                 dmGameObject::Update(engine->m_MainCollection, &update_context);
 
+                if (engine->m_RenderOnDemand)
+                {
+                    render_frame = IsRenderNeeded(engine, input_buffer_size > 0);
+                }
+
+                // The previous frame has been rendering on the GPU while this frame was simulated
+                if (engine->m_FlipPending)
+                {
+                    engine->m_FlipPending = false;
+                    FlipFrame(engine);
+                }
+
                 // Don't render while iconified
-                if (!dmGraphics::GetWindowStateParam(engine->m_GraphicsContext, dmPlatform::WINDOW_STATE_ICONIFIED))
+                if (!engine->m_Headless && render_frame && !dmGraphics::GetWindowStateParam(engine->m_GraphicsContext, dmPlatform::WINDOW_STATE_ICONIFIED))
                 {
+                    rendered = true;
+
                     // Call pre render functions for extensions, if available.
                     // We do it here before we render rest of the frame
                     // if any extension wants to render on under of the game.
@@ -1762,12 +2225,22 @@ bail:
                         dmRender::DrawRenderList(engine->m_RenderContext, 0x0, 0x0, 0x0);
                     }
                 }
+                else if (!render_frame && engine->m_RenderScriptPrototype)
+                {
+                    // The render script messages don't pile up while idle. Those that change what is drawn
+                    // invalidate the render, and the next frame is rendered
+                    dmRender::RenderListBegin(engine->m_RenderContext);
+                    dmRender::DispatchRenderScriptInstance(engine->m_RenderScriptPrototype->m_Instance);
+                    dmRender::RenderListEnd(engine->m_RenderContext);
+                }
 
                 dmGameObject::PostUpdate(engine->m_MainCollection);
                 dmGameObject::PostUpdate(engine->m_Register);
 
                 dmRender::ClearRenderObjects(engine->m_RenderContext);
 
+                dmGameSystem::UpdateTextureStreaming(engine->m_GraphicsContext);
+
 
                 dmMessage::Dispatch(engine->m_SystemSocket, Dispatch, engine);
             } // Sim
@@ -1789,13 +2262,16 @@ bail:
             }
 
 #if !defined(DM_RELEASE)
-            dmProfiler::RenderProfiler(profile, engine->m_GraphicsContext, engine->m_RenderContext, ResFontGetHandle(engine->m_SystemFont));
+            if (!engine->m_Headless && render_frame)
+            {
+                dmProfiler::RenderProfiler(profile, engine->m_GraphicsContext, engine->m_RenderContext, ResFontGetHandle(engine->m_SystemFont));
+            }
 #endif
             // Call post render functions for extensions, if available.
             // We do it here at the end of the frame (before swap buffers/flip)
             // in case any extension wants to render just before the Flip().
             // Don't do this while iconified
-            if (!dmGraphics::GetWindowStateParam(engine->m_GraphicsContext, dmPlatform::WINDOW_STATE_ICONIFIED))
+            if (!engine->m_Headless && render_frame && !dmGraphics::GetWindowStateParam(engine->m_GraphicsContext, dmPlatform::WINDOW_STATE_ICONIFIED))
             {
                 dmExtension::Params ext_params;
                 ext_params.m_ConfigFile = engine->m_Config;
@@ -1808,7 +2284,28 @@ bail:
                 dmExtension::PostRender(&ext_params);
             }
 
-            if (engine->m_UseSwVSync && engine->m_UpdateFrequency > 0)
+            // The garbage collector runs in the time that is left of the frame
+            {
+                uint64_t frame_time = (uint64_t)(dt * 1000000.0f);
+                if (engine->m_SharedScriptContext)
+                {
+                    uint64_t elapsed = dmTime::GetTime() - frame_start;
+                    dmScript::StepGarbageCollector(engine->m_SharedScriptContext, frame_time > elapsed ? frame_time - elapsed : 0);
+                }
+                else
+                {
+                    dmScript::HContext script_contexts[] = {engine->m_GOScriptContext, engine->m_RenderScriptContext, engine->m_GuiScriptContext};
+                    for (uint32_t i = 0; i < DM_ARRAY_SIZE(script_contexts); ++i)
+                    {
+                        if (!script_contexts[i])
+                            continue;
+                        uint64_t elapsed = dmTime::GetTime() - frame_start;
+                        dmScript::StepGarbageCollector(script_contexts[i], frame_time > elapsed ? frame_time - elapsed : 0);
+                    }
+                }
+            }
+
+            if (engine->m_UseSwVSync && (engine->m_UpdateFrequency > 0 || engine->m_AdaptivePacing))
             {
                 DM_PROFILE("SoftwareVsync");
                 uint64_t current = dmTime::GetTime();
@@ -1817,9 +2314,16 @@ bail:
                 uint64_t elapsed = current - frame_start;
                 uint64_t remainder = uint64_t(target_time*1000000) - elapsed;
 
+                uint64_t last_poll = current;
                 while (remainder > 500) // dont bother with less than 0.5ms
                 {
                     uint64_t t1 = dmTime::GetTime();
+                    if (engine->m_LowLatencyInput && t1 - last_poll >= 1000)
+                    {
+                        // Record key and mouse button changes with ~1ms precision instead of once per frame
+                        dmHID::Poll(engine->m_HidContext);
+                        last_poll = t1;
+                    }
                     dmTime::Sleep(100); // sleep in chunks of 0.1ms
                     uint64_t t2 = dmTime::GetTime();
                     uint64_t slept = t2 - t1;
@@ -1827,28 +2331,17 @@ bail:
                         break;
                     remainder -= slept;
                 }
+                engine->m_FrameWaitTime += dmTime::GetTime() - current;
             }
 
-            dmGraphics::Flip(engine->m_GraphicsContext);
-
-            RecordData* record_data = &engine->m_RecordData;
-            if (record_data->m_Recorder)
+            if (engine->m_PipelinedFlip && rendered)
             {
-                if (record_data->m_FrameCount % record_data->m_FramePeriod == 0)
-                {
-                    uint32_t width = dmGraphics::GetWidth(engine->m_GraphicsContext);
-                    uint32_t height = dmGraphics::GetHeight(engine->m_GraphicsContext);
-                    uint32_t buffer_size = width * height * 4;
-
-                    dmGraphics::ReadPixels(engine->m_GraphicsContext, record_data->m_Buffer, buffer_size);
-
-                    dmRecord::Result r = dmRecord::RecordFrame(record_data->m_Recorder, record_data->m_Buffer, buffer_size, dmRecord::BUFFER_FORMAT_BGRA);
-                    if (r != dmRecord::RESULT_OK)
-                    {
-                        dmLogError("Error while recoding frame (%d)", r);
-                    }
-                }
-                record_data->m_FrameCount++;
+                // The frame is presented in the next frame, after its simulation
+                engine->m_FlipPending = true;
+            }
+            else if (!engine->m_Headless && render_frame)
+            {
+                FlipFrame(engine);
             }
         }
         dmProfile::EndFrame(profile);
@@ -1863,6 +2356,26 @@ bail:
         uint64_t frame_time = time - engine->m_PreviousFrameTime; // The actual time between two engine frames
         engine->m_PreviousFrameTime = time;
 
+        // The benchmark steps one frame at a time, with a fixed dt
+        if (engine->m_Benchmark.m_FrameCount)
+        {
+            step_dt = engine->m_Benchmark.m_Dt;
+            num_steps = 1;
+            return;
+        }
+
+        // The adaptive pacing steps one frame per swap, with the same dt until the swap interval changes
+        if (engine->m_AdaptivePacing)
+        {
+            if (UpdateFramePacing(&engine->m_FramePacing, frame_time, engine->m_FrameWorkTime))
+            {
+                SetSwapInterval(engine, engine->m_FramePacing.m_Divisor);
+            }
+            step_dt = GetFramePacingDt(&engine->m_FramePacing);
+            num_steps = 1;
+            return;
+        }
+
         float frame_dt = (float)(frame_time / 1000000.0);
 
         // Never allow for large hitches
@@ -1870,6 +2383,18 @@ bail:
             frame_dt = engine->m_MaxTimeStep;
         }
 
+        // The deterministic mode always steps with the fixed dt, and the frame time only decides how many steps to take
+        if (engine->m_Deterministic)
+        {
+            uint32_t frequency = engine->m_FixedUpdateFrequency ? engine->m_FixedUpdateFrequency : DEFAULT_TICK_RATE;
+            float fixed_dt = 1.0f / (float)frequency;
+            engine->m_AccumFrameTime += frame_dt;
+            num_steps = (uint32_t)(engine->m_AccumFrameTime / fixed_dt);
+            step_dt = fixed_dt;
+            engine->m_AccumFrameTime = engine->m_AccumFrameTime - num_steps * fixed_dt;
+            return;
+        }
+
         // Variable frame rate
         if (engine->m_UpdateFrequency == 0)
         {
@@ -1899,6 +2424,8 @@ bail:
         engine->m_AccumFrameTime = engine->m_AccumFrameTime - num_steps * fixed_dt;
     }
 
+    static void Exit(HEngine engine, int32_t code);
+
     void Step(HEngine engine)
     {
         engine->m_Alive = true;
@@ -1908,15 +2435,56 @@ bail:
         float step_dt;      // The dt for each step (the game frame)
         uint32_t num_steps; // Number of times to loop over the StepFrame function
 
+        // Nothing is presented while idle, so there's no vsync to block on. The engine sleeps until the next idle tick
+        if (IsIdle(engine) && engine->m_IdleUpdateFrequency > 0 && !engine->m_Benchmark.m_FrameCount)
+        {
+            DM_PROFILE("IdleSleep");
+            uint64_t tick_time = 1000000 / engine->m_IdleUpdateFrequency;
+            uint64_t elapsed = dmTime::GetTime() - engine->m_PreviousFrameTime;
+            if (elapsed < tick_time)
+            {
+                dmTime::Sleep((uint32_t)(tick_time - elapsed));
+            }
+        }
+
         CalcTimeStep(engine, step_dt, num_steps);
 
+        // Without vsync to block on, the headless engine sleeps until the next tick instead of polling for it
+        if (num_steps == 0 && engine->m_Headless && engine->m_UpdateFrequency > 0)
+        {
+            DM_PROFILE("HeadlessSleep");
+            float tick_dt = 1.0f / (float)engine->m_UpdateFrequency;
+            float remaining = tick_dt - engine->m_AccumFrameTime;
+            if (remaining > 0.0f)
+            {
+                dmTime::Sleep((uint32_t)(remaining * 1000000.0f));
+            }
+            return;
+        }
+
         for (uint32_t i = 0; i < num_steps; ++i)
         {
             DM_PROFILE("Step");
+            uint64_t frame_start = dmTime::GetTime();
+            engine->m_FrameWaitTime = 0;
+
             // We currently cannot separate the update from the render,
             // since some of the update is done in the render updates (e.g. sprite transforms)
             StepFrame(engine, step_dt);
 
+            uint64_t frame_time = dmTime::GetTime() - frame_start;
+            engine->m_FrameWorkTime = frame_time > engine->m_FrameWaitTime ? frame_time - engine->m_FrameWaitTime : 0;
+
+            UpdatePerformanceHint(engine);
+
+            if (engine->m_Benchmark.m_FrameCount && EndBenchmarkFrame(&engine->m_Benchmark, engine->m_GraphicsContext, frame_time))
+            {
+                Exit(engine, 0);
+            }
+
+            // Frame scratch memory from two frames ago is reused from here on
+            dmMemory::FrameReset();
+
             if (!engine->m_Alive)
                 break;
         }
@@ -2034,6 +2602,7 @@ bail:
                 RecordData* record_data = &self->m_RecordData;
                 if (record_data->m_Recorder)
                 {
+                    dmGraphics::ResolvePixelReadbacks(self->m_GraphicsContext, RecordPixelReadback, record_data, true);
                     dmRecord::Delete(record_data->m_Recorder);
                     delete[] record_data->m_Buffer;
                     record_data->m_Recorder = 0;
@@ -2048,6 +2617,9 @@ bail:
             {
                 dmSystemDDF::SetUpdateFrequency* m = (dmSystemDDF::SetUpdateFrequency*) message->m_Data;
                 SetUpdateFrequency(self, (uint32_t) m->m_Frequency);
+                // The script takes over the frame rate
+                self->m_AdaptivePacing = false;
+                self->m_ThermalThrottled = false;
             }
             else if (descriptor == dmEngineDDF::HideApp::m_DDFDescriptor) // "hide_app"
             {
@@ -2057,6 +2629,7 @@ bail:
             {
                 dmSystemDDF::SetVsync* m = (dmSystemDDF::SetVsync*) message->m_Data;
                 SetSwapInterval(self, m->m_SwapInterval);
+                self->m_AdaptivePacing = false;
             }
             else if (descriptor == dmEngineDDF::RunScript::m_DDFDescriptor) // "run_script"
             {
@@ -2134,10 +2707,14 @@ bail:
         if (fact_error != dmResource::RESULT_OK)
             return false;
 
-        const char* render_path = dmConfigFile::GetString(config, "bootstrap.render", "/builtins/render/default.renderc");
-        fact_error = dmResource::Get(engine->m_Factory, render_path, (void**)&engine->m_RenderScriptPrototype);
-        if (fact_error != dmResource::RESULT_OK)
-            return false;
+        // The render script isn't loaded when there's nothing to render to
+        if (!engine->m_Headless)
+        {
+            const char* render_path = dmConfigFile::GetString(config, "bootstrap.render", "/builtins/render/default.renderc");
+            fact_error = dmResource::Get(engine->m_Factory, render_path, (void**)&engine->m_RenderScriptPrototype);
+            if (fact_error != dmResource::RESULT_OK)
+                return false;
+        }
 
         const char* display_profiles_path = dmConfigFile::GetString(config, "display.display_profiles", "/builtins/render/default.display_profilesc");
         fact_error = dmResource::Get(engine->m_Factory, display_profiles_path, (void**)&engine->m_DisplayProfiles);
@@ -2203,6 +2780,7 @@ void dmEngineFinalize()
         dmEngineService::Delete(dmEngine::g_EngineService);
     }
     dmGraphics::Finalize();
+    dmMessage::Finalize();
     dmLog::LogFinalize();
     dmMemProfile::Finalize();
     dmSSLSocket::Finalize();
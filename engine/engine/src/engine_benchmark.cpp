@@ -0,0 +1,326 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "engine_benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dlib/dstrings.h>
+#include <dlib/log.h>
+#include <dlib/math.h>
+#include <dlib/time.h>
+#include <profiler/profiler.h>
+
+namespace dmEngine
+{
+    static const char* DEFAULT_REPORT_PATH = "benchmark_report.json";
+
+    Benchmark::Benchmark()
+    : m_Collection(0)
+    , m_StartTime(0)
+    , m_MemoryHighWater(0)
+    , m_FrameCount(0)
+    , m_NextInput(0)
+    , m_Dt(0.0f)
+    {
+        m_ReportPath[0] = 0;
+        memset(&m_GraphicsStart, 0, sizeof(m_GraphicsStart));
+        memset(m_TagHighWater, 0, sizeof(m_TagHighWater));
+    }
+
+    static int InputFrameSort(const void* _a, const void* _b)
+    {
+        const BenchmarkInput* a = (const BenchmarkInput*)_a;
+        const BenchmarkInput* b = (const BenchmarkInput*)_b;
+        return a->m_Frame < b->m_Frame ? -1 : (a->m_Frame > b->m_Frame ? 1 : 0);
+    }
+
+    static bool LoadInput(Benchmark* benchmark, const char* path)
+    {
+        FILE* file = fopen(path, "rb");
+        if (!file)
+        {
+            dmLogError("Could not open the benchmark input '%s'", path);
+            return false;
+        }
+
+        char line[512];
+        uint32_t line_number = 0;
+        while (fgets(line, sizeof(line), file))
+        {
+            ++line_number;
+            if (line[0] == '#' || line[0] == '\n' || line[0] == '\r' || line[0] == 0)
+                continue;
+
+            char action[256];
+            BenchmarkInput input;
+            memset(&input, 0, sizeof(input));
+            int n = sscanf(line, "%u %255s %f %f %f", &input.m_Frame, action, &input.m_Value, &input.m_X, &input.m_Y);
+            if (n != 3 && n != 5)
+            {
+                dmLogError("Invalid benchmark input on line %u of '%s'", line_number, path);
+                fclose(file);
+                return false;
+            }
+            input.m_ActionId = dmHashString64(action);
+            input.m_PositionSet = n == 5;
+
+            if (benchmark->m_Input.Full())
+                benchmark->m_Input.OffsetCapacity(64);
+            benchmark->m_Input.Push(input);
+        }
+        fclose(file);
+
+        // A stable order isn't needed, since an action has one value per frame
+        if (!benchmark->m_Input.Empty())
+            qsort(benchmark->m_Input.Begin(), benchmark->m_Input.Size(), sizeof(BenchmarkInput), InputFrameSort);
+        return true;
+    }
+
+    bool InitBenchmark(Benchmark* benchmark, int argc, char* argv[])
+    {
+        const char benchmark_arg[] = "--benchmark=";
+        const char report_arg[] = "--benchmark-report=";
+        const char input_arg[] = "--benchmark-input=";
+
+        const char* input_path = 0;
+        int frame_count = 0;
+        dmStrlCpy(benchmark->m_ReportPath, DEFAULT_REPORT_PATH, sizeof(benchmark->m_ReportPath));
+        for (int i = 0; i < argc; ++i)
+        {
+            const char* arg = argv[i];
+            if (strncmp(benchmark_arg, arg, sizeof(benchmark_arg)-1) == 0)
+            {
+                frame_count = atoi(arg + sizeof(benchmark_arg)-1);
+            }
+            else if (strncmp(report_arg, arg, sizeof(report_arg)-1) == 0)
+            {
+                dmStrlCpy(benchmark->m_ReportPath, arg + sizeof(report_arg)-1, sizeof(benchmark->m_ReportPath));
+            }
+            else if (strncmp(input_arg, arg, sizeof(input_arg)-1) == 0)
+            {
+                input_path = arg + sizeof(input_arg)-1;
+            }
+        }
+
+        if (frame_count <= 0)
+            return true;
+
+        if (input_path && !LoadInput(benchmark, input_path))
+            return false;
+
+        benchmark->m_FrameCount = (uint32_t)frame_count;
+        benchmark->m_FrameTimes.SetCapacity(benchmark->m_FrameCount);
+        return true;
+    }
+
+    void StartBenchmark(Benchmark* benchmark, dmGraphics::HContext graphics_context, const char* collection, uint32_t fixed_update_frequency)
+    {
+        benchmark->m_Collection = collection;
+        benchmark->m_Dt = 1.0f / (fixed_update_frequency > 0 ? fixed_update_frequency : 60);
+        benchmark->m_StartTime = dmTime::GetTime();
+        dmGraphics::GetStats(graphics_context, &benchmark->m_GraphicsStart);
+        if (!dmProfiler::StartScopeStats())
+        {
+            dmLogWarning("The profiler isn't available, the benchmark report won't have any scope timings");
+        }
+        dmLogInfo("Running a benchmark of %u frames, with a dt of %.4f", benchmark->m_FrameCount, benchmark->m_Dt);
+    }
+
+    static void PushInput(dmArray<dmGameObject::InputAction>* input_buffer, const BenchmarkInput& input, bool pressed, bool released)
+    {
+        dmGameObject::InputAction action;
+        action.m_ActionId = input.m_ActionId;
+        action.m_Value = input.m_Value;
+        action.m_Pressed = pressed;
+        action.m_Released = released;
+        action.m_PositionSet = input.m_PositionSet;
+        action.m_X = input.m_X;
+        action.m_Y = input.m_Y;
+        action.m_ScreenX = input.m_X;
+        action.m_ScreenY = input.m_Y;
+
+        if (input_buffer->Full())
+            input_buffer->OffsetCapacity(16);
+        input_buffer->Push(action);
+    }
+
+    void AddBenchmarkInput(Benchmark* benchmark, dmArray<dmGameObject::InputAction>* input_buffer)
+    {
+        dmArray<BenchmarkInput>& held = benchmark->m_HeldInput;
+        uint32_t frame = benchmark->m_FrameTimes.Size();
+
+        // The changes of this frame
+        while (benchmark->m_NextInput < benchmark->m_Input.Size() && benchmark->m_Input[benchmark->m_NextInput].m_Frame <= frame)
+        {
+            const BenchmarkInput& input = benchmark->m_Input[benchmark->m_NextInput++];
+
+            uint32_t index = 0;
+            while (index < held.Size() && held[index].m_ActionId != input.m_ActionId)
+                ++index;
+            bool was_held = index < held.Size();
+
+            if (input.m_Value > 0.0f)
+            {
+                if (was_held)
+                {
+                    held[index] = input;
+                }
+                else
+                {
+                    if (held.Full())
+                        held.OffsetCapacity(16);
+                    held.Push(input);
+                    held.Back().m_Pressed = 1;
+                }
+            }
+            else if (was_held)
+            {
+                BenchmarkInput released = held[index];
+                released.m_Value = 0.0f;
+                if (input.m_PositionSet)
+                {
+                    released.m_X = input.m_X;
+                    released.m_Y = input.m_Y;
+                }
+                PushInput(input_buffer, released, false, true);
+                held.EraseSwap(index);
+            }
+        }
+
+        // The held actions repeat each frame, like the device input
+        for (uint32_t i = 0; i < held.Size(); ++i)
+        {
+            PushInput(input_buffer, held[i], held[i].m_Pressed, false);
+            held[i].m_Pressed = 0;
+        }
+    }
+
+    static int FloatSort(const void* _a, const void* _b)
+    {
+        float a = *(const float*)_a;
+        float b = *(const float*)_b;
+        return a < b ? -1 : (a > b ? 1 : 0);
+    }
+
+    static float GetPercentile(const dmArray<float>& sorted, float percentile)
+    {
+        uint32_t index = (uint32_t)(percentile * sorted.Size());
+        return sorted[dmMath::Min(index, sorted.Size() - 1)];
+    }
+
+    struct WriteScopeStatsContext
+    {
+        FILE* m_File;
+        bool  m_First;
+    };
+
+    static void WriteScopeStats(void* _ctx, const dmProfiler::ScopeStats* stats)
+    {
+        WriteScopeStatsContext* ctx = (WriteScopeStatsContext*)_ctx;
+        char name[256];
+        dmStrlCpy(name, stats->m_Name, sizeof(name));
+        for (char* c = name; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20)
+                *c = '_';
+        }
+        fprintf(ctx->m_File, "%s    {\"name\": \"%s\", \"total_ms\": %.3f, \"max_ms\": %.3f, \"count\": %u, \"frames\": %u}",
+                ctx->m_First ? "" : ",\n", name, stats->m_Time / 1000.0, stats->m_MaxFrameTime / 1000.0, stats->m_Count, stats->m_FrameCount);
+        ctx->m_First = false;
+    }
+
+    static bool WriteReport(Benchmark* benchmark, dmGraphics::HContext graphics_context)
+    {
+        FILE* file = fopen(benchmark->m_ReportPath, "wb");
+        if (!file)
+        {
+            dmLogError("Could not open the benchmark report '%s'", benchmark->m_ReportPath);
+            return false;
+        }
+
+        uint32_t frame_count = benchmark->m_FrameTimes.Size();
+        dmArray<float> sorted;
+        sorted.SetCapacity(frame_count);
+        sorted.SetSize(frame_count);
+        memcpy(sorted.Begin(), benchmark->m_FrameTimes.Begin(), frame_count * sizeof(float));
+        qsort(sorted.Begin(), frame_count, sizeof(float), FloatSort);
+
+        double total = 0.0;
+        for (uint32_t i = 0; i < frame_count; ++i)
+            total += sorted[i];
+
+        fprintf(file, "{\n");
+        fprintf(file, "  \"collection\": \"%s\",\n", benchmark->m_Collection ? benchmark->m_Collection : "");
+        fprintf(file, "  \"frames\": %u,\n", frame_count);
+        fprintf(file, "  \"dt\": %f,\n", benchmark->m_Dt);
+        fprintf(file, "  \"duration_ms\": %.3f,\n", (dmTime::GetTime() - benchmark->m_StartTime) / 1000.0);
+        fprintf(file, "  \"frame_time_ms\": {\"min\": %.3f, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n",
+                sorted[0], total / frame_count, GetPercentile(sorted, 0.5f), GetPercentile(sorted, 0.9f),
+                GetPercentile(sorted, 0.95f), GetPercentile(sorted, 0.99f), sorted[frame_count - 1]);
+
+        WriteScopeStatsContext scope_ctx;
+        scope_ctx.m_File = file;
+        scope_ctx.m_First = true;
+        fprintf(file, "  \"scopes\": [\n");
+        dmProfiler::IterateScopeStats(&scope_ctx, WriteScopeStats);
+        fprintf(file, "\n  ],\n");
+
+        fprintf(file, "  \"memory\": {\n");
+        fprintf(file, "    \"process_peak\": %llu,\n", (unsigned long long)benchmark->m_MemoryHighWater);
+        fprintf(file, "    \"tags_peak\": {");
+        for (uint32_t i = 0; i < dmMemory::TAG_COUNT; ++i)
+        {
+            fprintf(file, "%s\"%s\": %u", i == 0 ? "" : ", ", dmMemory::GetTagName((dmMemory::Tag)i), benchmark->m_TagHighWater[i]);
+        }
+        fprintf(file, "}\n  },\n");
+
+        dmGraphics::Stats end, stats;
+        dmGraphics::GetStats(graphics_context, &end);
+        dmGraphics::SubtractStats(end, benchmark->m_GraphicsStart, &stats);
+        fprintf(file, "  \"render\": {\"draw_calls\": %u, \"instanced_draw_calls\": %u, \"dispatch_calls\": %u, \"program_changes\": %u, "
+                      "\"texture_binds\": %u, \"constant_uploads\": %u, \"vertex_bytes\": %u, \"index_bytes\": %u, \"texture_bytes\": %u}\n",
+                stats.m_DrawCalls, stats.m_InstancedDrawCalls, stats.m_DispatchCalls, stats.m_ProgramChanges,
+                stats.m_TextureBinds, stats.m_ConstantUploads, stats.m_VertexBytesUploaded, stats.m_IndexBytesUploaded, stats.m_TextureBytesUploaded);
+        fprintf(file, "}\n");
+
+        bool ok = ferror(file) == 0;
+        fclose(file);
+        if (ok)
+            dmLogInfo("Wrote the benchmark report to '%s'", benchmark->m_ReportPath);
+        return ok;
+    }
+
+    bool EndBenchmarkFrame(Benchmark* benchmark, dmGraphics::HContext graphics_context, uint64_t frame_time)
+    {
+        benchmark->m_FrameTimes.Push((float)(frame_time / 1000.0));
+
+        benchmark->m_MemoryHighWater = dmMath::Max(benchmark->m_MemoryHighWater, dmProfiler::GetMemoryUsage());
+        for (uint32_t i = 0; i < dmMemory::TAG_COUNT; ++i)
+        {
+            dmMemory::TagStats stats;
+            dmMemory::GetTagStats((dmMemory::Tag)i, &stats);
+            benchmark->m_TagHighWater[i] = dmMath::Max(benchmark->m_TagHighWater[i], (uint32_t)stats.m_Active);
+        }
+
+        if (benchmark->m_FrameTimes.Size() < benchmark->m_FrameCount)
+            return false;
+
+        WriteReport(benchmark, graphics_context);
+        dmProfiler::StopScopeStats();
+        return true;
+    }
+}
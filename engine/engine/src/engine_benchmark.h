@@ -0,0 +1,91 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_ENGINE_BENCHMARK_H
+#define DM_ENGINE_BENCHMARK_H
+
+#include <stdint.h>
+#include <dlib/array.h>
+#include <dlib/hash.h>
+#include <dlib/memory.h>
+#include <dlib/path.h>
+#include <graphics/graphics.h>
+#include <gameobject/gameobject.h>
+
+/*
+ * The benchmark mode runs a fixed number of frames with a fixed dt and no vsync, writes a report and exits:
+ *
+ *   dmengine --benchmark=<frames> [--benchmark-report=<path>] [--benchmark-input=<path>]
+ *
+ * The main collection is set as usual, e.g. --config=bootstrap.main_collection=/level.collectionc
+ * The dt is 1 / engine.fixed_update_frequency, so that the fixed updates run once per frame.
+ *
+ * The input file replaces the device input, with one action per line:
+ *
+ *   <frame> <action> <value> [<x> <y>]
+ *
+ * The action is held from the frame until a line sets its value to 0. The position is in virtual screen space.
+ */
+
+namespace dmEngine
+{
+    struct BenchmarkInput
+    {
+        uint32_t m_Frame;
+        dmhash_t m_ActionId;
+        float    m_Value;
+        float    m_X;
+        float    m_Y;
+        uint8_t  m_PositionSet : 1;
+        uint8_t  m_Pressed : 1;     // Held, and pressed this frame
+    };
+
+    struct Benchmark
+    {
+        Benchmark();
+
+        char                    m_ReportPath[DMPATH_MAX_PATH];
+        const char*             m_Collection;
+        dmArray<float>          m_FrameTimes;       // In milliseconds
+        dmArray<BenchmarkInput> m_Input;            // Sorted on frame
+        dmArray<BenchmarkInput> m_HeldInput;        // The actions with a value above 0
+        dmGraphics::Stats       m_GraphicsStart;
+        uint64_t                m_StartTime;
+        uint64_t                m_MemoryHighWater;
+        uint32_t                m_TagHighWater[dmMemory::TAG_COUNT];
+        uint32_t                m_FrameCount;       // 0 when not running a benchmark
+        uint32_t                m_NextInput;
+        float                   m_Dt;
+    };
+
+    /**
+     * Parses the benchmark arguments. The m_FrameCount is 0 if there's no --benchmark argument
+     * @return false if the input file couldn't be loaded
+     */
+    bool InitBenchmark(Benchmark* benchmark, int argc, char* argv[]);
+
+    // Called when the engine has been initialized, before the first frame
+    void StartBenchmark(Benchmark* benchmark, dmGraphics::HContext graphics_context, const char* collection, uint32_t fixed_update_frequency);
+
+    // Adds the replayed input actions of the current frame
+    void AddBenchmarkInput(Benchmark* benchmark, dmArray<dmGameObject::InputAction>* input_buffer);
+
+    /**
+     * Adds a frame to the benchmark
+     * @return true when all frames have run, and the report has been written
+     */
+    bool EndBenchmarkFrame(Benchmark* benchmark, dmGraphics::HContext graphics_context, uint64_t frame_time);
+}
+
+#endif // DM_ENGINE_BENCHMARK_H
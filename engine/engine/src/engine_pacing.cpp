@@ -0,0 +1,98 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include "engine_pacing.h"
+
+#include <dlib/log.h>
+#include <dlib/math.h>
+
+namespace dmEngine
+{
+    // Raise the divisor when more than this fraction of the window missed the target
+    static const float MISSED_WINDOW_RATIO  = 0.1f;
+    // Lower the divisor when the average cost is below this fraction of the faster frame time
+    static const float HEADROOM_RATIO       = 0.7f;
+
+    FramePacing::FramePacing()
+    : m_WorkTime(0)
+    , m_RefreshRate(60)
+    , m_Divisor(1)
+    , m_MaxDivisor(1)
+    , m_WindowSize(1)
+    , m_FrameCount(0)
+    , m_MissedCount(0)
+    {
+    }
+
+    static uint64_t GetTargetTime(uint32_t refresh_rate, uint32_t divisor)
+    {
+        return (1000000 * (uint64_t)divisor) / refresh_rate;
+    }
+
+    void InitFramePacing(FramePacing* pacing, uint32_t refresh_rate, uint32_t max_divisor, uint32_t window_size)
+    {
+        *pacing = FramePacing();
+        pacing->m_RefreshRate = refresh_rate ? refresh_rate : 60;
+        pacing->m_MaxDivisor = dmMath::Max(1u, max_divisor);
+        pacing->m_WindowSize = dmMath::Max(1u, window_size);
+    }
+
+    bool UpdateFramePacing(FramePacing* pacing, uint64_t frame_interval, uint64_t work_time)
+    {
+        // A frame counts as missed when it's closer to the next vblank than to its own
+        uint64_t target_time = GetTargetTime(pacing->m_RefreshRate, pacing->m_Divisor);
+        if (frame_interval > target_time + GetTargetTime(pacing->m_RefreshRate, 1) / 2)
+        {
+            pacing->m_MissedCount++;
+        }
+        pacing->m_WorkTime += work_time;
+        pacing->m_FrameCount++;
+
+        if (pacing->m_FrameCount < pacing->m_WindowSize)
+        {
+            return false;
+        }
+
+        uint32_t divisor = pacing->m_Divisor;
+        uint64_t average_work_time = pacing->m_WorkTime / pacing->m_FrameCount;
+        if (pacing->m_MissedCount > (uint32_t)(pacing->m_FrameCount * MISSED_WINDOW_RATIO))
+        {
+            if (divisor < pacing->m_MaxDivisor)
+                divisor++;
+        }
+        else if (divisor > 1 && average_work_time < (uint64_t)(GetTargetTime(pacing->m_RefreshRate, divisor - 1) * HEADROOM_RATIO))
+        {
+            divisor--;
+        }
+
+        pacing->m_WorkTime = 0;
+        pacing->m_FrameCount = 0;
+        pacing->m_MissedCount = 0;
+
+        if (divisor == pacing->m_Divisor)
+        {
+            return false;
+        }
+
+        dmLogInfo("Frame pacing changed to %u fps (average frame cost %.2f ms)", pacing->m_RefreshRate / divisor, average_work_time / 1000.0f);
+        pacing->m_Divisor = divisor;
+        return true;
+    }
+
+    float GetFramePacingDt(const FramePacing* pacing)
+    {
+        return (float)pacing->m_Divisor / (float)pacing->m_RefreshRate;
+    }
+}
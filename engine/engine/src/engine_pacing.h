@@ -0,0 +1,57 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#ifndef DM_ENGINE_PACING_H
+#define DM_ENGINE_PACING_H
+
+#include <stdint.h>
+
+/*
+ * Adaptive frame pacing (display.adaptive_pacing=1) locks the frame rate to the refresh rate
+ * divided by a swap interval. The interval is raised when frames keep missing the vblank,
+ * and lowered again when the frame cost fits within the faster rate with some margin.
+ * The game gets the same dt each frame, instead of alternating between e.g. 16 and 33 ms.
+ */
+
+namespace dmEngine
+{
+    struct FramePacing
+    {
+        FramePacing();
+
+        uint64_t m_WorkTime;        // Sum over the window, in microseconds
+        uint32_t m_RefreshRate;
+        uint32_t m_Divisor;         // The swap interval, 1 is every vblank
+        uint32_t m_MaxDivisor;
+        uint32_t m_WindowSize;      // Number of frames between each decision
+        uint32_t m_FrameCount;      // Frames in the current window
+        uint32_t m_MissedCount;     // Frames in the current window that took longer than the target
+    };
+
+    void InitFramePacing(FramePacing* pacing, uint32_t refresh_rate, uint32_t max_divisor, uint32_t window_size);
+
+    /**
+     * Adds a frame
+     * @param frame_interval [type: uint64_t] the time since the previous frame, in microseconds
+     * @param work_time [type: uint64_t] the time the frame was busy, excluding the vsync wait, in microseconds
+     * @return true if the divisor changed
+     */
+    bool UpdateFramePacing(FramePacing* pacing, uint64_t frame_interval, uint64_t work_time);
+
+    // The dt to step the game with at the current divisor
+    float GetFramePacingDt(const FramePacing* pacing);
+}
+
+#endif // DM_ENGINE_PACING_H
@@ -40,6 +40,9 @@
 
 #include "engine.h"
 #include "engine_service.h"
+#include "engine_benchmark.h"
+#include "engine_pacing.h"
+#include <dlib/performance_hint.h>
 #include "engine.h"
 #include <engine/engine_ddf.h>
 #include <dmsdk/gamesys/resources/res_font.h>
@@ -122,6 +125,7 @@ namespace dmEngine
         float                                       m_MouseSensitivity;
 
         dmJobThread::HContext                       m_JobThreadContext;
+        dmJobThread::HContext                       m_ParallelJobThreadContext; // Used for parallel loops, the main thread participates
         dmGraphics::HContext                        m_GraphicsContext;
         dmRender::HRenderContext                    m_RenderContext;
         dmGameSystem::PhysicsContext                m_PhysicsContext;
@@ -159,6 +163,15 @@ namespace dmEngine
         bool                                        m_ConnectionAppMode;        //!< If the app was started on a device, listening for connections
         bool                                        m_RunWhileIconified;
         bool                                        m_UseSwVSync;
+        bool                                        m_PipelinedFlip;            // Present each frame after the next frame's simulation
+        bool                                        m_FlipPending;
+        bool                                        m_AdaptivePacing;
+        bool                                        m_Headless;                 // No rendering, and the frames are paced with sleeps (see DM_HEADLESS)
+        bool                                        m_Deterministic;            // Every step has the same dt, for lockstep simulations
+        bool                                        m_PerformanceHintCreated;   // The session is created in the first frame, when the job threads have started
+        bool                                        m_ThermalThrottled;
+        bool                                        m_RenderOnDemand;           // Only render the frames where something has changed
+        bool                                        m_LowLatencyInput;          // Keyboard and mouse are sampled right before input dispatch, and while waiting for vsync
         uint64_t                                    m_PreviousFrameTime;        // Used to calculate dt
         float                                       m_AccumFrameTime;           // Used to trigger frame updates when using m_UpdateFrequency != 0
         uint32_t                                    m_UpdateFrequency;
@@ -169,8 +182,17 @@ namespace dmEngine
         float                                       m_InvPhysicalWidth;
         float                                       m_InvPhysicalHeight;
         float                                       m_MaxTimeStep;
+        uint64_t                                    m_FrameWorkTime;            // The time of the last frame, excluding the flip and vsync waits
+        uint64_t                                    m_FrameWaitTime;
+        FramePacing                                 m_FramePacing;
+        dmPerformanceHint::HSession                 m_PerformanceHint;
+        float                                       m_ThermalHeadroomLimit;     // 0 when the engine doesn't throttle itself
+        uint32_t                                    m_ThermalUpdateFrequency;   // The update frequency before it was lowered
+        uint32_t                                    m_IdleUpdateFrequency;      // The update frequency when nothing is rendered (see m_RenderOnDemand)
+        uint32_t                                    m_IdleFrames;               // The number of frames since the render was last invalidated
 
         RecordData                                  m_RecordData;
+        Benchmark                                   m_Benchmark;
     };
 
 
@@ -15,19 +15,30 @@
 #include <stdint.h>
 #include <string.h>
 #include <dlib/webserver.h>
+#include <dlib/array.h>
+#include <dlib/atomic.h>
+#include <dlib/hash.h>
+#include <dlib/hashtable.h>
 #include <dlib/message.h>
 #include <dlib/dstrings.h>
 #include <dlib/math.h>
+#include <dlib/memory.h>
+#include <dlib/mutex.h>
 #include <dlib/log.h>
+#include <dlib/network_constants.h>
 #include <dlib/profile.h>
 #include <dlib/ssdp.h>
 #include <dlib/socket.h>
 #include <dlib/sys.h>
 #include <dlib/template.h>
+#include <dlib/thread.h>
+#include <dlib/time.h>
 #include <ddf/ddf.h>
 #include <resource/resource.h>
+#include <script/script.h>
 #include <gameobject/gameobject.h>
 #include <gamesys/components/comp_gui.h> 
+#include <profiler/profiler.h>
 #include "engine_service.h"
 #include "engine_version.h"
 
@@ -55,11 +66,16 @@ namespace dmEngineService
     "</root>\n";
 
     static const char INFO_TEMPLATE[] =
-    "{\"version\": \"${ENGINE_VERSION}\", \"platform\": \"${ENGINE_PLATFORM}\", \"sha1\": \"${ENGINE_SHA1}\"}";
+    "{\"version\": \"${ENGINE_VERSION}\", \"platform\": \"${ENGINE_PLATFORM}\", \"sha1\": \"${ENGINE_SHA1}\", \"stream_port\": ${DEFOLD_STREAM_PORT}}";
 
     static const char INTERNAL_SERVER_ERROR[] = "(500) Internal server error";
     const char* const FOURCC_RESOURCES = "RESS";
 
+    // The binary stream, see below
+    struct StreamServer;
+    static void DeleteStream(StreamServer* stream);
+    static void UpdateStream(StreamServer* stream);
+
     struct EngineService
     {
         static void HttpServerHeader(void* user_data, const char* key, const char* value)
@@ -273,6 +289,10 @@ namespace dmEngineService
             {
                 return self->m_LogPortText;
             }
+            else if (strcmp(key, "DEFOLD_STREAM_PORT") == 0)
+            {
+                return self->m_StreamPortText;
+            }
             else if (strcmp(key, "NAME") == 0)
             {
                 return self->m_Name;
@@ -312,6 +332,8 @@ namespace dmEngineService
 
         bool Init(uint16_t port)
         {
+            m_Stream = 0;
+            dmStrlCpy(m_StreamPortText, "0", sizeof(m_StreamPortText));
             dmTemplate::Format(this, m_InfoJson, sizeof(m_InfoJson), INFO_TEMPLATE, ReplaceCallback);
 
             dmSys::SystemInfo info;
@@ -474,6 +496,11 @@ namespace dmEngineService
 
         void Final()
         {
+            if (m_Stream)
+            {
+                DeleteStream(m_Stream);
+            }
+
             dmWebServer::Delete(m_WebServer);
 
             if (m_WebServerRedirect)
@@ -494,6 +521,7 @@ namespace dmEngineService
         uint16_t             m_Port;
         char                 m_PortText[16];
         char                 m_LogPortText[16];
+        char                 m_StreamPortText[16];
         char                 m_Name[128];
         char                 m_LocalAddress[128];
 
@@ -504,6 +532,7 @@ namespace dmEngineService
         char                 m_InfoJson[sizeof(INFO_TEMPLATE) + 512]; // 512 is rather arbitrary :-)
 
         dmProfile::HProfile  m_Profile;
+        StreamServer*        m_Stream;     // Created with the profiler endpoints
     };
 
     HEngineService New(uint16_t port)
@@ -543,6 +572,11 @@ namespace dmEngineService
 
         engine_service->m_Profile = 0; // Don't leave a dangling pointer
 
+        if (engine_service->m_Stream)
+        {
+            UpdateStream(engine_service->m_Stream);
+        }
+
         if (engine_service->m_SSDP)
         {
             dmSSDP::Update(engine_service->m_SSDP, false);
@@ -751,10 +785,95 @@ namespace dmEngineService
         }
     }
 
+    struct SceneProfileRequestContext
+    {
+        dmWebServer::Request* m_Request;
+        bool                  m_First;
+    };
+
+    static void SendSceneProfileStats(dmWebServer::Request* request, const dmGameObject::SceneProfileStats* stats)
+    {
+        char buffer[128];
+        for (uint32_t i = 0; i < dmGameObject::SCENE_PROFILE_FUNCTION_COUNT; ++i)
+        {
+            if (stats->m_Count[i] == 0)
+                continue;
+            dmSnPrintf(buffer, sizeof(buffer), ", \"%s\": {\"count\": %u, \"time\": %llu}",
+                                               dmGameObject::GetSceneProfileFunctionName((dmGameObject::SceneProfileFunction)i),
+                                               stats->m_Count[i], (unsigned long long)stats->m_Time[i]);
+            SendText(request, buffer);
+        }
+    }
+
+    static void SceneProfileComponentFunction(void* _ctx, dmhash_t collection_id, const char* component_type, const dmGameObject::SceneProfileStats* stats)
+    {
+        SceneProfileRequestContext* ctx = (SceneProfileRequestContext*)_ctx;
+        char buffer[256];
+        dmSnPrintf(buffer, sizeof(buffer), "%s\n{\"collection\": \"%s\", \"type\": \"%s\"",
+                                           ctx->m_First ? "" : ",", dmHashReverseSafe64(collection_id), component_type);
+        SendText(ctx->m_Request, buffer);
+        SendSceneProfileStats(ctx->m_Request, stats);
+        SendText(ctx->m_Request, "}");
+        ctx->m_First = false;
+    }
+
+    static void SceneProfileScriptFunction(void* _ctx, const char* script, const dmGameObject::SceneProfileStats* stats)
+    {
+        SceneProfileRequestContext* ctx = (SceneProfileRequestContext*)_ctx;
+        SendText(ctx->m_Request, ctx->m_First ? "\n{\"script\": \"" : ",\n{\"script\": \"");
+        SendText(ctx->m_Request, script);
+        SendText(ctx->m_Request, "\"");
+        SendSceneProfileStats(ctx->m_Request, stats);
+        SendText(ctx->m_Request, "}");
+        ctx->m_First = false;
+    }
+
+    // Sends the scene profile, with the calls and the time (in microseconds) per component type and collection, and per script file.
+    // The profile is controlled with /gameobjects_data/profile/start, /gameobjects_data/profile/stop and /gameobjects_data/profile/reset
+    static void HttpSceneProfileRequestCallback(dmGameObject::HRegister regist, const char* command, dmWebServer::Request* request)
+    {
+        if (strcmp(command, "/start") == 0)
+        {
+            dmGameObject::SetSceneProfileEnabled(regist, true);
+        }
+        else if (strcmp(command, "/stop") == 0)
+        {
+            dmGameObject::SetSceneProfileEnabled(regist, false);
+        }
+        else if (strcmp(command, "/reset") == 0)
+        {
+            dmGameObject::ResetSceneProfile(regist);
+        }
+
+        dmWebServer::SetStatusCode(request, 200);
+        dmWebServer::SendAttribute(request, "Content-Type", "application/json");
+        dmWebServer::SendAttribute(request, "Access-Control-Allow-Origin", "*");
+        dmWebServer::SendAttribute(request, "Cache-Control", "no-store");
+
+        SendText(request, dmGameObject::IsSceneProfileEnabled(regist) ? "{\"running\": true,\n\"components\": [" : "{\"running\": false,\n\"components\": [");
+
+        SceneProfileRequestContext ctx;
+        ctx.m_Request = request;
+        ctx.m_First = true;
+        dmGameObject::IterateSceneProfileComponents(regist, SceneProfileComponentFunction, &ctx);
+        SendText(request, "\n],\n\"scripts\": [");
+
+        ctx.m_First = true;
+        dmGameObject::IterateSceneProfileScripts(regist, SceneProfileScriptFunction, &ctx);
+        SendText(request, "\n]}\n");
+    }
+
     static void HttpGameObjectRequestCallback(void* context, dmWebServer::Request* request)
     {
         dmGameObject::HRegister regist = (dmGameObject::HRegister)context;
 
+        const char* command = request->m_Resource + strlen("/gameobjects_data");
+        if (strncmp(command, "/profile", strlen("/profile")) == 0)
+        {
+            HttpSceneProfileRequestCallback(regist, command + strlen("/profile"), request);
+            return;
+        }
+
         dmGameObject::SceneNode root;
         if (!dmGameObject::TraverseGetRoot(regist, &root))
         {
@@ -877,8 +996,1036 @@ namespace dmEngineService
         OutputJsonSceneGraph(&root, request, 0);
     }
 
+    //
+    // Resource load trace
+    //
+
+    struct LoadTraceTypeTotals
+    {
+        const char* m_Extension;
+        uint32_t    m_Count;
+        uint64_t    m_LoadTime;
+        uint64_t    m_Size;
+    };
+
+    struct LoadTraceRequestContext
+    {
+        dmWebServer::Request*           m_Request;
+        dmArray<LoadTraceTypeTotals>    m_Types;
+        bool                            m_First;
+    };
+
+    static bool LoadTraceIteratorFunction(const dmResource::LoadTraceEntry& entry, void* user_ctx)
+    {
+        LoadTraceRequestContext* ctx = (LoadTraceRequestContext*)user_ctx;
+        char buffer[1024];
+        dmSnPrintf(buffer, sizeof(buffer), "%s\n{\"path\": \"%s\", \"type\": \"%s\", \"start\": %llu, \"size_on_disc\": %u, \"size\": %u, "
+                                           "\"load\": %u, \"preload\": %u, \"create\": %u, \"postcreate\": %u}",
+                                           ctx->m_First ? "" : ",", dmHashReverseSafe64(entry.m_Id), entry.m_Extension ? entry.m_Extension : "",
+                                           (unsigned long long)entry.m_StartTime, entry.m_SizeOnDisc, entry.m_Size,
+                                           entry.m_LoadTime, entry.m_PreloadTime, entry.m_CreateTime, entry.m_PostCreateTime);
+        ctx->m_First = false;
+        return SendText(ctx->m_Request, buffer) == dmWebServer::RESULT_OK;
+    }
+
+    static bool LoadTraceResourceIteratorFunction(const dmResource::IteratorResource& resource, void* user_ctx)
+    {
+        LoadTraceRequestContext* ctx = (LoadTraceRequestContext*)user_ctx;
+        const char* extension = resource.m_Extension ? resource.m_Extension : "";
+
+        LoadTraceTypeTotals* totals = 0;
+        for (uint32_t i = 0; i < ctx->m_Types.Size(); ++i)
+        {
+            if (strcmp(ctx->m_Types[i].m_Extension, extension) == 0)
+            {
+                totals = &ctx->m_Types[i];
+                break;
+            }
+        }
+        if (!totals)
+        {
+            if (ctx->m_Types.Full())
+                ctx->m_Types.OffsetCapacity(16);
+            LoadTraceTypeTotals new_totals = {extension, 0, 0, 0};
+            ctx->m_Types.Push(new_totals);
+            totals = &ctx->m_Types.Back();
+        }
+        totals->m_Count++;
+        totals->m_LoadTime += resource.m_LoadTime;
+        totals->m_Size += resource.m_Size;
+        return true;
+    }
+
+    // Sends the stage timings of the most recently created resources, and the load time per resource type of the loaded resources
+    static void HttpResourceLoadTraceRequestCallback(void* context, dmWebServer::Request* request)
+    {
+        dmResource::HFactory factory = (dmResource::HFactory)context;
+
+        dmWebServer::SetStatusCode(request, 200);
+        dmWebServer::SendAttribute(request, "Content-Type", "application/json");
+        dmWebServer::SendAttribute(request, "Access-Control-Allow-Origin", "*");
+        dmWebServer::SendAttribute(request, "Cache-Control", "no-store");
+
+        LoadTraceRequestContext ctx;
+        ctx.m_Request = request;
+        ctx.m_First = true;
+
+        SendText(request, "{\"loads\": [");
+        dmResource::IterateLoadTrace(factory, LoadTraceIteratorFunction, &ctx);
+        SendText(request, "\n],\n\"types\": [");
+
+        dmResource::IterateResources(factory, LoadTraceResourceIteratorFunction, &ctx);
+        for (uint32_t i = 0; i < ctx.m_Types.Size(); ++i)
+        {
+            const LoadTraceTypeTotals& totals = ctx.m_Types[i];
+            char buffer[256];
+            dmSnPrintf(buffer, sizeof(buffer), "%s\n{\"type\": \"%s\", \"count\": %u, \"load_time\": %llu, \"size\": %llu}",
+                                               i == 0 ? "" : ",", totals.m_Extension, totals.m_Count,
+                                               (unsigned long long)totals.m_LoadTime, (unsigned long long)totals.m_Size);
+            SendText(request, buffer);
+        }
+        SendText(request, "\n]}\n");
+    }
+
+    struct LoadOrderRequestContext
+    {
+        dmWebServer::Request*   m_Request;
+        bool                    m_First;
+    };
+
+    static bool LoadOrderIteratorFunction(const dmResource::LoadOrderEntry& entry, void* user_ctx)
+    {
+        LoadOrderRequestContext* ctx = (LoadOrderRequestContext*)user_ctx;
+        char buffer[2 * dmResource::RESOURCE_PATH_MAX + 64];
+        dmSnPrintf(buffer, sizeof(buffer), "%s\n{\"path\": \"%s\", \"group\": \"%s\"}", ctx->m_First ? "" : ",", entry.m_Path, entry.m_Group);
+        ctx->m_First = false;
+        return SendText(ctx->m_Request, buffer) == dmWebServer::RESULT_OK;
+    }
+
+    // Sends the resources in the order they were first loaded, for laying out the archive in the same order.
+    // Empty unless the engine is started with resource.load_order = 1
+    static void HttpResourceLoadOrderRequestCallback(void* context, dmWebServer::Request* request)
+    {
+        dmResource::HFactory factory = (dmResource::HFactory)context;
+
+        dmWebServer::SetStatusCode(request, 200);
+        dmWebServer::SendAttribute(request, "Content-Type", "application/json");
+        dmWebServer::SendAttribute(request, "Access-Control-Allow-Origin", "*");
+        dmWebServer::SendAttribute(request, "Cache-Control", "no-store");
+
+        LoadOrderRequestContext ctx;
+        ctx.m_Request = request;
+        ctx.m_First = true;
+
+        SendText(request, "{\"resources\": [");
+        dmResource::IterateLoadOrder(factory, LoadOrderIteratorFunction, &ctx);
+        SendText(request, "\n]}\n");
+    }
+
+    //
+    // Lua sampling profiler
+    //
+
+    struct LuaProfileRequestContext
+    {
+        dmWebServer::Request*   m_Request;
+        bool                    m_First;
+    };
+
+    static void LuaProfileEntryFunction(void* user_ctx, const dmScript::LuaProfilerEntry* entry)
+    {
+        LuaProfileRequestContext* ctx = (LuaProfileRequestContext*)user_ctx;
+        char buffer[256];
+        dmSnPrintf(buffer, sizeof(buffer), "%s\n{\"source\": \"%s\", \"name\": \"%s\", \"line\": %u, \"self\": %u, \"total\": %u}",
+                                           ctx->m_First ? "" : ",", entry->m_Source, entry->m_Name, entry->m_Line, entry->m_SelfSamples, entry->m_TotalSamples);
+        ctx->m_First = false;
+        SendText(ctx->m_Request, buffer);
+    }
+
+    static void LuaProfileStackFunction(void* user_ctx, uint64_t time, const uint32_t* functions, uint32_t depth)
+    {
+        LuaProfileRequestContext* ctx = (LuaProfileRequestContext*)user_ctx;
+        char buffer[64];
+        dmSnPrintf(buffer, sizeof(buffer), "%s\n{\"time\": %llu, \"functions\": [", ctx->m_First ? "" : ",", (unsigned long long)time);
+        SendText(ctx->m_Request, buffer);
+        for (uint32_t i = 0; i < depth; ++i)
+        {
+            dmSnPrintf(buffer, sizeof(buffer), "%s%u", i == 0 ? "" : ",", functions[i]);
+            SendText(ctx->m_Request, buffer);
+        }
+        SendText(ctx->m_Request, "]}");
+        ctx->m_First = false;
+    }
+
+    // Sends the samples of the Lua sampling profiler. The stacks are lists of indices into the functions, starting with the running function.
+    // The profiler is controlled with /lua_profile/start, /lua_profile/stop and /lua_profile/reset
+    static void HttpLuaProfileRequestCallback(void* context, dmWebServer::Request* request)
+    {
+        lua_State* L = (lua_State*)context;
+
+        const char* command = request->m_Resource + strlen("/lua_profile");
+        if (strcmp(command, "/start") == 0)
+        {
+            dmScript::StartLuaProfiler(L, 1000);
+        }
+        else if (strcmp(command, "/stop") == 0)
+        {
+            dmScript::StopLuaProfiler();
+        }
+        else if (strcmp(command, "/reset") == 0)
+        {
+            dmScript::ResetLuaProfiler();
+        }
+
+        dmWebServer::SetStatusCode(request, 200);
+        dmWebServer::SendAttribute(request, "Content-Type", "application/json");
+        dmWebServer::SendAttribute(request, "Access-Control-Allow-Origin", "*");
+        dmWebServer::SendAttribute(request, "Cache-Control", "no-store");
+
+        char buffer[128];
+        dmSnPrintf(buffer, sizeof(buffer), "{\"running\": %s, \"count\": %u,\n\"functions\": [",
+                                           dmScript::IsLuaProfilerRunning() ? "true" : "false", dmScript::GetLuaProfilerSampleCount());
+        SendText(request, buffer);
+
+        LuaProfileRequestContext ctx;
+        ctx.m_Request = request;
+        ctx.m_First = true;
+        dmScript::IterateLuaProfilerEntries(dmScript::LUA_PROFILER_ENTRY_FUNCTION, LuaProfileEntryFunction, &ctx);
+        SendText(request, "\n],\n\"lines\": [");
+
+        ctx.m_First = true;
+        dmScript::IterateLuaProfilerEntries(dmScript::LUA_PROFILER_ENTRY_LINE, LuaProfileEntryFunction, &ctx);
+        SendText(request, "\n],\n\"stacks\": [");
+
+        ctx.m_First = true;
+        dmScript::IterateLuaProfilerStacks(LuaProfileStackFunction, &ctx);
+        SendText(request, "\n]}\n");
+    }
+
+    // Starts and stops the profile captures, with /profile_capture/start and /profile_capture/stop.
+    // The captures are written on the device, to the path in the profiler.capture setting or "profile_capture.json"
+    static void HttpProfileCaptureRequestCallback(void* context, dmWebServer::Request* request)
+    {
+        const char* command = request->m_Resource + strlen("/profile_capture");
+        bool ok = true;
+        if (strcmp(command, "/start") == 0)
+        {
+            ok = dmProfiler::StartCapture(0);
+        }
+        else if (strcmp(command, "/stop") == 0)
+        {
+            dmProfiler::StopCapture();
+        }
+
+        dmWebServer::SetStatusCode(request, ok ? 200 : 500);
+        dmWebServer::SendAttribute(request, "Content-Type", "application/json");
+        dmWebServer::SendAttribute(request, "Access-Control-Allow-Origin", "*");
+        dmWebServer::SendAttribute(request, "Cache-Control", "no-store");
+        SendText(request, dmProfiler::IsCapturing() ? "{\"capturing\": true}\n" : "{\"capturing\": false}\n");
+    }
+
+    // Sends the memory use per memory tag, and the size of the loaded resources per resource type
+    static void HttpMemoryRequestCallback(void* context, dmWebServer::Request* request)
+    {
+        dmResource::HFactory factory = (dmResource::HFactory)context;
+
+        dmWebServer::SetStatusCode(request, 200);
+        dmWebServer::SendAttribute(request, "Content-Type", "application/json");
+        dmWebServer::SendAttribute(request, "Access-Control-Allow-Origin", "*");
+        dmWebServer::SendAttribute(request, "Cache-Control", "no-store");
+
+        SendText(request, "{\"tags\": [");
+        for (uint32_t i = 0; i < dmMemory::TAG_COUNT; ++i)
+        {
+            dmMemory::TagStats stats;
+            dmMemory::GetTagStats((dmMemory::Tag)i, &stats);
+
+            // The allocated bytes and the allocation count are only counted with the memory profiler library
+            char buffer[256];
+            dmSnPrintf(buffer, sizeof(buffer), "%s\n{\"tag\": \"%s\", \"active\": %d, \"allocated\": %u, \"allocations\": %u}",
+                                               i == 0 ? "" : ",", dmMemory::GetTagName((dmMemory::Tag)i),
+                                               (int32_t)stats.m_Active, (uint32_t)stats.m_Allocated, (uint32_t)stats.m_AllocationCount);
+            SendText(request, buffer);
+        }
+        SendText(request, "\n],\n\"resource_types\": [");
+
+        LoadTraceRequestContext ctx;
+        ctx.m_Request = request;
+        ctx.m_First = true;
+        dmResource::IterateResources(factory, LoadTraceResourceIteratorFunction, &ctx);
+        for (uint32_t i = 0; i < ctx.m_Types.Size(); ++i)
+        {
+            const LoadTraceTypeTotals& totals = ctx.m_Types[i];
+            char buffer[256];
+            dmSnPrintf(buffer, sizeof(buffer), "%s\n{\"type\": \"%s\", \"count\": %u, \"size\": %llu}",
+                                               i == 0 ? "" : ",", totals.m_Extension, totals.m_Count, (unsigned long long)totals.m_Size);
+            SendText(request, buffer);
+        }
+        SendText(request, "\n]}\n");
+    }
+
 #undef CHECK_RESULT_BOOL
 
+    //
+    // Binary stream
+    //
+    // A persistent TCP connection that pushes the profiler frames, and the changes to the resources and the game objects,
+    // instead of the tools polling the http endpoints. The port is found in /info, as "stream_port".
+    //
+    // On connection, the engine sends "DMST" followed by the protocol version (uint32_t). Then follows a sequence of messages,
+    // each a fourcc, the payload size (uint32_t) and the payload. Fixed size values are in the (little endian) native byte order,
+    // "varint" is an unsigned LEB128 and "svarint" a zigzag encoded varint.
+    //
+    // SNAM: uint32_t scope name hash, varint length, name. Sent before the first frame with the scope
+    // HNAM: uint64_t hash, varint length, string. Sent before the first message with the hash, if the hash can be reversed
+    // FRAM: varint dropped frame count, varint frame time (us), uint32_t scope count, then for each scope:
+    //       uint32_t name hash, svarint time delta (us), svarint call count delta.
+    //       The deltas are against the previous frame sent on the connection, and scopes that didn't change are left out
+    // RESS: uint32_t count, then for each resource: uint8_t op, uint64_t path hash, and unless it's a removal,
+    //       varint size, varint size on disc, varint reference count
+    // GOBJ: uint32_t count, then for each game object: uint8_t op, uint64_t key, and unless it's a removal,
+    //       uint64_t id hash, uint64_t resource hash, uint64_t type hash, uint64_t parent key (0 for the root objects).
+    //       The key is an opaque handle, that is unique while the instance is alive
+    //
+    // The main thread only takes snapshots, at most every STREAM_SNAPSHOT_INTERVAL and only while a tool is connected. The messages
+    // are serialized and sent on the stream thread, and each tick sends at most STREAM_TICK_BYTE_BUDGET bytes: the frames that don't
+    // fit are dropped, and the resource and game object changes are postponed to the next tick.
+    //
+
+    static const uint32_t   STREAM_VERSION = 1;
+    static const uint64_t   STREAM_TICK_INTERVAL = 16000;       // us
+    static const uint32_t   STREAM_TICK_BYTE_BUDGET = 32 * 1024;
+    static const uint64_t   STREAM_SNAPSHOT_INTERVAL = 500000;  // us
+    static const uint32_t   STREAM_MAX_PENDING_FRAMES = 32;
+    static const int32_t    STREAM_ACCEPT_TIMEOUT = 100000;     // us, also how quickly the thread notices a shutdown
+
+    enum StreamOp
+    {
+        STREAM_OP_ADD       = 0,
+        STREAM_OP_UPDATE    = 1,
+        STREAM_OP_REMOVE    = 2,
+    };
+
+    struct StreamScope
+    {
+        uint32_t m_NameHash;
+        uint32_t m_Time;
+        uint32_t m_Count;
+    };
+
+    struct StreamFrame
+    {
+        uint64_t m_FrameTime;
+        uint32_t m_FirstScope;  // Index into the scope array
+        uint32_t m_ScopeCount;
+    };
+
+    struct StreamSentScope
+    {
+        uint32_t m_Time;
+        uint32_t m_Count;
+        uint32_t m_Frame;       // The latest frame with the scope
+    };
+
+    struct StreamResource
+    {
+        dmhash_t m_Id;
+        uint32_t m_Size;
+        uint32_t m_SizeOnDisc;
+        uint32_t m_RefCount;
+        uint32_t m_Generation;  // The latest snapshot with the resource
+    };
+
+    struct StreamGameObject
+    {
+        uint64_t m_Id;          // The key
+        dmhash_t m_Name;
+        dmhash_t m_Resource;
+        dmhash_t m_Type;
+        uint64_t m_Parent;
+        uint32_t m_Generation;  // The latest snapshot with the game object
+    };
+
+    // The changes of the snapshots of one kind, against the state sent on the connection
+    template <typename T>
+    struct StreamDiff
+    {
+        dmArray<T>          m_Snapshot;
+        dmHashTable64<T>    m_Sent;
+        dmArray<uint64_t>   m_Removed;
+        uint32_t            m_Cursor;       // The next snapshot entry to compare
+        uint32_t            m_Generation;
+        bool                m_Done;         // If the removals of the snapshot are sent
+    };
+
+    struct StreamServer
+    {
+        dmResource::HFactory                m_Factory;
+        dmGameObject::HRegister             m_Register;
+        dmSocket::Socket                    m_ServerSocket;
+        dmThread::Thread                    m_Thread;
+        dmMutex::HMutex                     m_Mutex;
+        uint16_t                            m_Port;
+        int32_atomic_t                      m_Running;
+        int32_atomic_t                      m_Connected;
+
+        // Main thread
+        uint64_t                            m_SnapshotTime;
+
+        // Guarded by the mutex
+        dmArray<StreamFrame>                m_PendingFrames;
+        dmArray<StreamScope>                m_PendingScopes;
+        dmHashTable32<char*>                m_ScopeNames;
+        dmArray<StreamResource>             m_ResourceSnapshot;     // Written by the main thread while m_HasSnapshot is false
+        dmArray<StreamGameObject>           m_GameObjectSnapshot;
+        uint32_t                            m_DroppedFrames;
+        bool                                m_HasSnapshot;
+
+        // Stream thread
+        dmSocket::Socket                    m_Socket;
+        dmArray<uint8_t>                    m_Buffer;
+        dmArray<uint8_t>                    m_Entries;
+        dmArray<StreamFrame>                m_Frames;
+        dmArray<StreamScope>                m_Scopes;
+        dmHashTable32<StreamSentScope>      m_SentScopes;
+        dmHashTable64<bool>                 m_SentHashes;
+        StreamDiff<StreamResource>          m_Resources;
+        StreamDiff<StreamGameObject>        m_GameObjects;
+        uint32_t                            m_FrameIndex;
+        uint32_t                            m_DroppedSinceSent;
+    };
+
+    template <typename TABLE, typename KEY, typename T>
+    static void StreamPut(TABLE& table, KEY key, const T& value)
+    {
+        if (table.Full())
+            table.SetCapacity(table.Capacity()/2 + 64, table.Capacity() + 128);
+        table.Put(key, value);
+    }
+
+    static void StreamWrite(dmArray<uint8_t>& buffer, const void* data, uint32_t size)
+    {
+        if (buffer.Remaining() < size)
+            buffer.OffsetCapacity(dmMath::Max(size, 4096u));
+        buffer.PushArray((const uint8_t*)data, size);
+    }
+
+    static void StreamWriteVarint(dmArray<uint8_t>& buffer, uint64_t value)
+    {
+        uint8_t bytes[10];
+        uint32_t count = 0;
+        do
+        {
+            uint8_t b = (uint8_t)(value & 0x7f);
+            value >>= 7;
+            bytes[count++] = b | (value ? 0x80 : 0);
+        } while (value);
+        StreamWrite(buffer, bytes, count);
+    }
+
+    static void StreamWriteSVarint(dmArray<uint8_t>& buffer, int64_t value)
+    {
+        StreamWriteVarint(buffer, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+    }
+
+    static uint32_t StreamBeginMessage(dmArray<uint8_t>& buffer, const char* fourcc)
+    {
+        uint32_t offset = buffer.Size();
+        uint32_t size = 0;
+        StreamWrite(buffer, fourcc, 4);
+        StreamWrite(buffer, &size, 4);
+        return offset;
+    }
+
+    static void StreamEndMessage(dmArray<uint8_t>& buffer, uint32_t offset)
+    {
+        uint32_t size = buffer.Size() - offset - 8;
+        memcpy(&buffer[offset + 4], &size, 4);
+    }
+
+    // Sends the name of a hash the first time it's used on the connection
+    static void StreamWriteHashName(StreamServer* stream, dmhash_t hash)
+    {
+        if (hash == 0 || stream->m_SentHashes.Get(hash))
+            return;
+        StreamPut(stream->m_SentHashes, hash, true);
+
+        uint32_t length = 0;
+        const char* name = (const char*)dmHashReverse64(hash, &length);
+        if (!name)
+            return;
+
+        uint32_t offset = StreamBeginMessage(stream->m_Buffer, "HNAM");
+        StreamWrite(stream->m_Buffer, &hash, 8);
+        StreamWriteVarint(stream->m_Buffer, length);
+        StreamWrite(stream->m_Buffer, name, length);
+        StreamEndMessage(stream->m_Buffer, offset);
+    }
+
+    static uint32_t StreamHashNameMaxSize(StreamServer* stream, dmhash_t hash)
+    {
+        if (hash == 0 || stream->m_SentHashes.Get(hash))
+            return 0;
+        uint32_t length = 0;
+        return dmHashReverse64(hash, &length) ? 8 + 8 + 5 + length : 0;
+    }
+
+    // The per kind parts of the snapshot diffs
+
+    static dmhash_t StreamEntryKey(const StreamResource& resource)
+    {
+        return resource.m_Id;
+    }
+
+    static bool StreamEntryEquals(const StreamResource& a, const StreamResource& b)
+    {
+        return a.m_Size == b.m_Size && a.m_SizeOnDisc == b.m_SizeOnDisc && a.m_RefCount == b.m_RefCount;
+    }
+
+    static uint32_t StreamEntryMaxSize(StreamServer* stream, const StreamResource& resource)
+    {
+        return 1 + 8 + 3 * 5 + StreamHashNameMaxSize(stream, resource.m_Id);
+    }
+
+    static void StreamWriteEntry(StreamServer* stream, const StreamResource& resource)
+    {
+        StreamWriteHashName(stream, resource.m_Id);
+        StreamWriteVarint(stream->m_Entries, resource.m_Size);
+        StreamWriteVarint(stream->m_Entries, resource.m_SizeOnDisc);
+        StreamWriteVarint(stream->m_Entries, resource.m_RefCount);
+    }
+
+    static uint64_t StreamEntryKey(const StreamGameObject& object)
+    {
+        return object.m_Id;
+    }
+
+    static bool StreamEntryEquals(const StreamGameObject& a, const StreamGameObject& b)
+    {
+        return a.m_Name == b.m_Name && a.m_Resource == b.m_Resource && a.m_Type == b.m_Type && a.m_Parent == b.m_Parent;
+    }
+
+    static uint32_t StreamEntryMaxSize(StreamServer* stream, const StreamGameObject& object)
+    {
+        return 1 + 5 * 8 + StreamHashNameMaxSize(stream, object.m_Name) + StreamHashNameMaxSize(stream, object.m_Resource) + StreamHashNameMaxSize(stream, object.m_Type);
+    }
+
+    static void StreamWriteEntry(StreamServer* stream, const StreamGameObject& object)
+    {
+        StreamWriteHashName(stream, object.m_Name);
+        StreamWriteHashName(stream, object.m_Resource);
+        StreamWriteHashName(stream, object.m_Type);
+        StreamWrite(stream->m_Entries, &object.m_Name, 8);
+        StreamWrite(stream->m_Entries, &object.m_Resource, 8);
+        StreamWrite(stream->m_Entries, &object.m_Type, 8);
+        StreamWrite(stream->m_Entries, &object.m_Parent, 8);
+    }
+
+    template <typename T>
+    static void StreamCollectRemoved(StreamDiff<T>* diff, const uint64_t* key, T* entry)
+    {
+        if (entry->m_Generation != diff->m_Generation)
+        {
+            if (diff->m_Removed.Full())
+                diff->m_Removed.OffsetCapacity(256);
+            diff->m_Removed.Push(*key);
+        }
+    }
+
+    static uint32_t StreamBudgetLeft(StreamServer* stream)
+    {
+        uint32_t used = stream->m_Buffer.Size() + stream->m_Entries.Size();
+        return used < STREAM_TICK_BYTE_BUDGET ? STREAM_TICK_BYTE_BUDGET - used : 0;
+    }
+
+    // Writes the changes that fit in the budget. The rest is written in the next ticks
+    template <typename T>
+    static void StreamWriteChanges(StreamServer* stream, StreamDiff<T>* diff, const char* fourcc)
+    {
+        if (diff->m_Done)
+            return;
+
+        stream->m_Entries.SetSize(0);
+        uint32_t count = 0;
+        bool out_of_budget = false;
+
+        for (; diff->m_Cursor < diff->m_Snapshot.Size(); ++diff->m_Cursor)
+        {
+            T entry = diff->m_Snapshot[diff->m_Cursor];
+            entry.m_Generation = diff->m_Generation;
+
+            uint64_t key = StreamEntryKey(entry);
+            T* sent = diff->m_Sent.Get(key);
+            if (sent && StreamEntryEquals(*sent, entry))
+            {
+                sent->m_Generation = diff->m_Generation;
+                continue;
+            }
+
+            if (StreamEntryMaxSize(stream, entry) > StreamBudgetLeft(stream))
+            {
+                out_of_budget = true;
+                break;
+            }
+
+            uint8_t op = sent ? STREAM_OP_UPDATE : STREAM_OP_ADD;
+            StreamWrite(stream->m_Entries, &op, 1);
+            StreamWrite(stream->m_Entries, &key, 8);
+            StreamWriteEntry(stream, entry);
+            StreamPut(diff->m_Sent, key, entry);
+            ++count;
+        }
+
+        if (!out_of_budget)
+        {
+            // The entries that weren't in the snapshot are removed
+            diff->m_Removed.SetSize(0);
+            diff->m_Sent.Iterate(StreamCollectRemoved<T>, diff);
+            for (uint32_t i = 0; i < diff->m_Removed.Size(); ++i)
+            {
+                if (1 + 8 > StreamBudgetLeft(stream))
+                {
+                    out_of_budget = true;
+                    break;
+                }
+                uint8_t op = STREAM_OP_REMOVE;
+                uint64_t key = diff->m_Removed[i];
+                StreamWrite(stream->m_Entries, &op, 1);
+                StreamWrite(stream->m_Entries, &key, 8);
+                diff->m_Sent.Erase(key);
+                ++count;
+            }
+            diff->m_Done = !out_of_budget;
+        }
+
+        if (count == 0)
+            return;
+
+        uint32_t offset = StreamBeginMessage(stream->m_Buffer, fourcc);
+        StreamWrite(stream->m_Buffer, &count, 4);
+        StreamWrite(stream->m_Buffer, stream->m_Entries.Begin(), stream->m_Entries.Size());
+        StreamEndMessage(stream->m_Buffer, offset);
+    }
+
+    template <typename T>
+    static void StreamResetDiff(StreamDiff<T>* diff)
+    {
+        diff->m_Snapshot.SetSize(0);
+        diff->m_Sent.Clear();
+        diff->m_Cursor = 0;
+        diff->m_Done = true;
+    }
+
+    template <typename T>
+    static void StreamTakeSnapshot(StreamDiff<T>* diff, dmArray<T>& snapshot)
+    {
+        diff->m_Snapshot.Swap(snapshot);
+        snapshot.SetSize(0);
+        diff->m_Cursor = 0;
+        diff->m_Generation++;
+        diff->m_Done = false;
+    }
+
+    // Profiler frames
+
+    struct StreamFrameContext
+    {
+        StreamServer*   m_Stream;
+        uint32_t        m_Count;
+    };
+
+    static void StreamWriteStaleScope(StreamFrameContext* ctx, const uint32_t* key, StreamSentScope* sent)
+    {
+        // The scope wasn't in this frame
+        StreamServer* stream = ctx->m_Stream;
+        if (sent->m_Frame == stream->m_FrameIndex || (sent->m_Time == 0 && sent->m_Count == 0))
+            return;
+        StreamWrite(stream->m_Entries, key, 4);
+        StreamWriteSVarint(stream->m_Entries, -(int64_t)sent->m_Time);
+        StreamWriteSVarint(stream->m_Entries, -(int64_t)sent->m_Count);
+        sent->m_Time = 0;
+        sent->m_Count = 0;
+        ctx->m_Count++;
+    }
+
+    static void StreamWriteFrame(StreamServer* stream, const StreamFrame& frame)
+    {
+        // The delta state can't be rolled back, so the frame is only written if it fits, whatever the scopes are
+        uint32_t max_size = 8 + 5 + 10 + 4 + (frame.m_ScopeCount + stream->m_SentScopes.Size()) * (4 + 2 * 10);
+        if (max_size > StreamBudgetLeft(stream))
+        {
+            stream->m_DroppedSinceSent++;
+            return;
+        }
+
+        stream->m_FrameIndex++;
+        stream->m_Entries.SetSize(0);
+
+        StreamFrameContext ctx;
+        ctx.m_Stream = stream;
+        ctx.m_Count = 0;
+        for (uint32_t i = 0; i < frame.m_ScopeCount; ++i)
+        {
+            const StreamScope& scope = stream->m_Scopes[frame.m_FirstScope + i];
+            StreamSentScope* sent = stream->m_SentScopes.Get(scope.m_NameHash);
+            if (!sent)
+            {
+                StreamSentScope new_sent = {0, 0, 0};
+                StreamPut(stream->m_SentScopes, scope.m_NameHash, new_sent);
+                sent = stream->m_SentScopes.Get(scope.m_NameHash);
+            }
+            sent->m_Frame = stream->m_FrameIndex;
+            if (sent->m_Time == scope.m_Time && sent->m_Count == scope.m_Count)
+                continue;
+
+            StreamWrite(stream->m_Entries, &scope.m_NameHash, 4);
+            StreamWriteSVarint(stream->m_Entries, (int64_t)scope.m_Time - (int64_t)sent->m_Time);
+            StreamWriteSVarint(stream->m_Entries, (int64_t)scope.m_Count - (int64_t)sent->m_Count);
+            sent->m_Time = scope.m_Time;
+            sent->m_Count = scope.m_Count;
+            ctx.m_Count++;
+        }
+        stream->m_SentScopes.Iterate(StreamWriteStaleScope, &ctx);
+
+        uint32_t offset = StreamBeginMessage(stream->m_Buffer, "FRAM");
+        StreamWriteVarint(stream->m_Buffer, stream->m_DroppedSinceSent);
+        StreamWriteVarint(stream->m_Buffer, frame.m_FrameTime);
+        StreamWrite(stream->m_Buffer, &ctx.m_Count, 4);
+        StreamWrite(stream->m_Buffer, stream->m_Entries.Begin(), stream->m_Entries.Size());
+        StreamEndMessage(stream->m_Buffer, offset);
+        stream->m_DroppedSinceSent = 0;
+    }
+
+    // Called on the profiler thread
+    static void StreamFrameCallback(void* ctx, uint64_t frame_time, const dmProfiler::FrameScope* scopes, uint32_t count)
+    {
+        StreamServer* stream = (StreamServer*)ctx;
+        if (!dmAtomicGet32(&stream->m_Connected))
+            return;
+
+        DM_MUTEX_SCOPED_LOCK(stream->m_Mutex);
+        if (stream->m_PendingFrames.Full())
+        {
+            stream->m_DroppedFrames++;
+            return;
+        }
+
+        StreamFrame frame = {frame_time, stream->m_PendingScopes.Size(), count};
+        stream->m_PendingFrames.Push(frame);
+
+        if (stream->m_PendingScopes.Remaining() < count)
+            stream->m_PendingScopes.OffsetCapacity(count + 256);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const dmProfiler::FrameScope& scope = scopes[i];
+            StreamScope stream_scope = {scope.m_NameHash, scope.m_Time, scope.m_Count};
+            stream->m_PendingScopes.Push(stream_scope);
+            if (!stream->m_ScopeNames.Get(scope.m_NameHash))
+                StreamPut(stream->m_ScopeNames, scope.m_NameHash, strdup(scope.m_Name));
+        }
+    }
+
+    // Stream thread
+
+    static bool StreamSend(StreamServer* stream, const uint8_t* data, uint32_t size)
+    {
+        uint32_t total_sent = 0;
+        while (total_sent < size)
+        {
+            int sent = 0;
+            dmSocket::Result r = dmSocket::Send(stream->m_Socket, data + total_sent, size - total_sent, &sent);
+            if (r == dmSocket::RESULT_TRY_AGAIN && dmAtomicGet32(&stream->m_Running))
+                continue;
+            if (r != dmSocket::RESULT_OK)
+                return false;
+            total_sent += sent;
+        }
+        return true;
+    }
+
+    static void StreamDisconnect(StreamServer* stream)
+    {
+        dmAtomicStore32(&stream->m_Connected, 0);
+        dmSocket::Shutdown(stream->m_Socket, dmSocket::SHUTDOWNTYPE_READWRITE);
+        dmSocket::Delete(stream->m_Socket);
+        stream->m_Socket = dmSocket::INVALID_SOCKET_HANDLE;
+        dmLogInfo("Engine service stream disconnected");
+    }
+
+    static void StreamAccept(StreamServer* stream)
+    {
+        dmSocket::Selector selector;
+        dmSocket::SelectorZero(&selector);
+        dmSocket::SelectorSet(&selector, dmSocket::SELECTOR_KIND_READ, stream->m_ServerSocket);
+        if (dmSocket::Select(&selector, STREAM_ACCEPT_TIMEOUT) != dmSocket::RESULT_OK ||
+            !dmSocket::SelectorIsSet(&selector, dmSocket::SELECTOR_KIND_READ, stream->m_ServerSocket))
+        {
+            return;
+        }
+
+        dmSocket::Address address;
+        dmSocket::Socket socket;
+        if (dmSocket::Accept(stream->m_ServerSocket, &address, &socket) != dmSocket::RESULT_OK)
+            return;
+
+        dmSocket::SetNoDelay(socket, true);
+        dmSocket::SetSendTimeout(socket, 1000000);
+        stream->m_Socket = socket;
+
+        // The new connection gets everything from the start
+        stream->m_SentScopes.Clear();
+        stream->m_SentHashes.Clear();
+        StreamResetDiff(&stream->m_Resources);
+        StreamResetDiff(&stream->m_GameObjects);
+        stream->m_FrameIndex = 0;
+        stream->m_DroppedSinceSent = 0;
+        {
+            DM_MUTEX_SCOPED_LOCK(stream->m_Mutex);
+            stream->m_PendingFrames.SetSize(0);
+            stream->m_PendingScopes.SetSize(0);
+            stream->m_DroppedFrames = 0;
+            stream->m_HasSnapshot = false;
+        }
+
+        uint8_t header[8];
+        memcpy(header, "DMST", 4);
+        memcpy(header + 4, &STREAM_VERSION, 4);
+        if (!StreamSend(stream, header, sizeof(header)))
+        {
+            StreamDisconnect(stream);
+            return;
+        }
+
+        dmAtomicStore32(&stream->m_Connected, 1);
+        dmLogInfo("Engine service stream connected");
+    }
+
+    static bool StreamTick(StreamServer* stream)
+    {
+        DM_PROFILE("StreamTick");
+        stream->m_Buffer.SetSize(0);
+        stream->m_Frames.SetSize(0);
+        stream->m_Scopes.SetSize(0);
+        {
+            DM_MUTEX_SCOPED_LOCK(stream->m_Mutex);
+            stream->m_Frames.Swap(stream->m_PendingFrames);
+            stream->m_Scopes.Swap(stream->m_PendingScopes);
+            stream->m_DroppedSinceSent += stream->m_DroppedFrames;
+            stream->m_DroppedFrames = 0;
+
+            if (stream->m_HasSnapshot)
+            {
+                StreamTakeSnapshot(&stream->m_Resources, stream->m_ResourceSnapshot);
+                StreamTakeSnapshot(&stream->m_GameObjects, stream->m_GameObjectSnapshot);
+                stream->m_HasSnapshot = false;
+            }
+
+            for (uint32_t i = 0; i < stream->m_Scopes.Size(); ++i)
+            {
+                uint32_t name_hash = stream->m_Scopes[i].m_NameHash;
+                if (stream->m_SentScopes.Get(name_hash))
+                    continue;
+                StreamSentScope new_sent = {0, 0, 0};
+                StreamPut(stream->m_SentScopes, name_hash, new_sent);
+
+                char** name = stream->m_ScopeNames.Get(name_hash);
+                uint32_t length = name ? (uint32_t)strlen(*name) : 0;
+                uint32_t offset = StreamBeginMessage(stream->m_Buffer, "SNAM");
+                StreamWrite(stream->m_Buffer, &name_hash, 4);
+                StreamWriteVarint(stream->m_Buffer, length);
+                StreamWrite(stream->m_Buffer, name ? *name : "", length);
+                StreamEndMessage(stream->m_Buffer, offset);
+            }
+        }
+
+        for (uint32_t i = 0; i < stream->m_Frames.Size(); ++i)
+        {
+            StreamWriteFrame(stream, stream->m_Frames[i]);
+        }
+
+        StreamWriteChanges(stream, &stream->m_Resources, FOURCC_RESOURCES);
+        StreamWriteChanges(stream, &stream->m_GameObjects, "GOBJ");
+
+        if (stream->m_Buffer.Empty())
+            return true;
+        return StreamSend(stream, stream->m_Buffer.Begin(), stream->m_Buffer.Size());
+    }
+
+    static void StreamThread(void* ctx)
+    {
+        StreamServer* stream = (StreamServer*)ctx;
+        while (dmAtomicGet32(&stream->m_Running))
+        {
+            if (stream->m_Socket == dmSocket::INVALID_SOCKET_HANDLE)
+            {
+                StreamAccept(stream);
+                continue;
+            }
+
+            uint64_t tick_start = dmTime::GetTime();
+            if (!StreamTick(stream))
+            {
+                StreamDisconnect(stream);
+                continue;
+            }
+
+            uint64_t elapsed = dmTime::GetTime() - tick_start;
+            if (elapsed < STREAM_TICK_INTERVAL)
+                dmTime::Sleep((uint32_t)(STREAM_TICK_INTERVAL - elapsed));
+        }
+
+        if (stream->m_Socket != dmSocket::INVALID_SOCKET_HANDLE)
+            StreamDisconnect(stream);
+    }
+
+    // Main thread snapshots
+
+    static bool StreamResourceIterator(const dmResource::IteratorResource& resource, void* user_ctx)
+    {
+        dmArray<StreamResource>* resources = (dmArray<StreamResource>*)user_ctx;
+        StreamResource entry = {resource.m_Id, resource.m_Size, resource.m_SizeOnDisc, resource.m_RefCount, 0};
+        if (resources->Full())
+            resources->OffsetCapacity(256);
+        resources->Push(entry);
+        return true;
+    }
+
+    static void StreamCollectGameObjects(dmGameObject::SceneNode* node, uint64_t parent, dmArray<StreamGameObject>* objects)
+    {
+        static const dmhash_t s_PropertyId = dmHashString64("id");
+        static const dmhash_t s_PropertyResource = dmHashString64("resource");
+        static const dmhash_t s_PropertyType = dmHashString64("type");
+
+        if (node->m_Type == dmGameObject::SCENE_NODE_TYPE_COMPONENT || node->m_Type == dmGameObject::SCENE_NODE_TYPE_SUBCOMPONENT)
+            return;
+
+        if (node->m_Type == dmGameObject::SCENE_NODE_TYPE_GAMEOBJECT)
+        {
+            StreamGameObject object;
+            memset(&object, 0, sizeof(object));
+            object.m_Id = (uint64_t)(uintptr_t)node->m_Instance;
+            object.m_Parent = parent;
+
+            dmGameObject::SceneNodePropertyIterator pit = TraverseIterateProperties(node);
+            while(dmGameObject::TraverseIteratePropertiesNext(&pit))
+            {
+                if (pit.m_Property.m_NameHash == s_PropertyId)
+                    object.m_Name = pit.m_Property.m_Value.m_Hash;
+                else if (pit.m_Property.m_NameHash == s_PropertyResource)
+                    object.m_Resource = pit.m_Property.m_Value.m_Hash;
+                else if (pit.m_Property.m_NameHash == s_PropertyType)
+                    object.m_Type = pit.m_Property.m_Value.m_Hash;
+            }
+
+            if (objects->Full())
+                objects->OffsetCapacity(256);
+            objects->Push(object);
+            parent = object.m_Id;
+        }
+
+        dmGameObject::SceneNodeIterator it = dmGameObject::TraverseIterateChildren(node);
+        while(dmGameObject::TraverseIterateNext(&it))
+        {
+            StreamCollectGameObjects(&it.m_Node, parent, objects);
+        }
+    }
+
+    static void UpdateStream(StreamServer* stream)
+    {
+        if (!dmAtomicGet32(&stream->m_Connected))
+            return;
+
+        uint64_t time = dmTime::GetTime();
+        if (time < stream->m_SnapshotTime + STREAM_SNAPSHOT_INTERVAL)
+            return;
+
+        {
+            DM_MUTEX_SCOPED_LOCK(stream->m_Mutex);
+            if (stream->m_HasSnapshot) // The previous one isn't picked up yet
+                return;
+        }
+
+        DM_PROFILE("StreamSnapshot");
+        stream->m_SnapshotTime = time;
+
+        // The stream thread doesn't touch the snapshot arrays until m_HasSnapshot is set
+        stream->m_ResourceSnapshot.SetSize(0);
+        dmResource::IterateResources(stream->m_Factory, StreamResourceIterator, &stream->m_ResourceSnapshot);
+
+        stream->m_GameObjectSnapshot.SetSize(0);
+        dmGameObject::SceneNode root;
+        if (dmGameObject::TraverseGetRoot(stream->m_Register, &root))
+        {
+            StreamCollectGameObjects(&root, 0, &stream->m_GameObjectSnapshot);
+        }
+
+        DM_MUTEX_SCOPED_LOCK(stream->m_Mutex);
+        stream->m_HasSnapshot = true;
+    }
+
+    static StreamServer* NewStream(dmResource::HFactory factory, dmGameObject::HRegister regist)
+    {
+        dmSocket::Address address;
+        dmSocket::Result r = dmSocket::GetHostByName(DM_UNIVERSAL_BIND_ADDRESS_IPV4, &address);
+        dmSocket::Socket server_socket = dmSocket::INVALID_SOCKET_HANDLE;
+        if (r == dmSocket::RESULT_OK)
+            r = dmSocket::New(address.m_family, dmSocket::TYPE_STREAM, dmSocket::PROTOCOL_TCP, &server_socket);
+        if (r == dmSocket::RESULT_OK)
+        {
+            dmSocket::SetReuseAddress(server_socket, true);
+            r = dmSocket::Bind(server_socket, address, 0);
+        }
+        if (r == dmSocket::RESULT_OK)
+            r = dmSocket::Listen(server_socket, 1);
+
+        uint16_t port = 0;
+        if (r == dmSocket::RESULT_OK)
+            r = dmSocket::GetName(server_socket, &address, &port);
+
+        if (r != dmSocket::RESULT_OK)
+        {
+            dmLogWarning("Unable to create the engine service stream socket (%d): %s", r, dmSocket::ResultToString(r));
+            if (server_socket != dmSocket::INVALID_SOCKET_HANDLE)
+                dmSocket::Delete(server_socket);
+            return 0;
+        }
+
+        StreamServer* stream = new StreamServer();
+        stream->m_Factory = factory;
+        stream->m_Register = regist;
+        stream->m_ServerSocket = server_socket;
+        stream->m_Socket = dmSocket::INVALID_SOCKET_HANDLE;
+        stream->m_Port = port;
+        stream->m_Mutex = dmMutex::New();
+        stream->m_PendingFrames.SetCapacity(STREAM_MAX_PENDING_FRAMES);
+        stream->m_Frames.SetCapacity(STREAM_MAX_PENDING_FRAMES);
+        stream->m_Resources.m_Done = true;
+        stream->m_GameObjects.m_Done = true;
+        dmAtomicStore32(&stream->m_Running, 1);
+
+        stream->m_Thread = dmThread::New(StreamThread, 0x20000, stream, "engine_stream");
+        dmProfiler::SetFrameCallback(stream, StreamFrameCallback);
+        return stream;
+    }
+
+    static void FreeScopeName(void*, const uint32_t*, char** name)
+    {
+        free(*name);
+    }
+
+    static void DeleteStream(StreamServer* stream)
+    {
+        dmProfiler::SetFrameCallback(0, 0);
+
+        dmAtomicStore32(&stream->m_Running, 0);
+        dmThread::Join(stream->m_Thread);
+        dmSocket::Delete(stream->m_ServerSocket);
+
+        stream->m_ScopeNames.Iterate(FreeScopeName, (void*)0);
+        dmMutex::Delete(stream->m_Mutex);
+        delete stream;
+    }
+
     //
     // All profilers' setup
     //
@@ -891,7 +2038,7 @@ namespace dmEngineService
         dmWebServer::Send(request, PROFILER_HTML, PROFILER_HTML_SIZE);
     }
 
-    void InitProfiler(HEngineService engine_service, dmResource::HFactory factory, dmGameObject::HRegister regist)
+    void InitProfiler(HEngineService engine_service, dmResource::HFactory factory, dmGameObject::HRegister regist, lua_State* L)
     {
         dmWebServer::HandlerParams resource_params;
         resource_params.m_Handler = HttpResourceRequestCallback;
@@ -911,6 +2058,39 @@ namespace dmEngineService
         scenegraph_params.m_Userdata = regist;
         dmWebServer::AddHandler(engine_service->m_WebServer, "/scene_graph", &scenegraph_params);
 
+        dmWebServer::HandlerParams load_trace_params;
+        load_trace_params.m_Handler = HttpResourceLoadTraceRequestCallback;
+        load_trace_params.m_Userdata = factory;
+        dmWebServer::AddHandler(engine_service->m_WebServer, "/resource_load_trace", &load_trace_params);
+
+        dmWebServer::HandlerParams load_order_params;
+        load_order_params.m_Handler = HttpResourceLoadOrderRequestCallback;
+        load_order_params.m_Userdata = factory;
+        dmWebServer::AddHandler(engine_service->m_WebServer, "/resource_load_order", &load_order_params);
+
+        dmWebServer::HandlerParams lua_profile_params;
+        lua_profile_params.m_Handler = HttpLuaProfileRequestCallback;
+        lua_profile_params.m_Userdata = L;
+        dmWebServer::AddHandler(engine_service->m_WebServer, "/lua_profile", &lua_profile_params);
+
+        dmWebServer::HandlerParams profile_capture_params;
+        profile_capture_params.m_Handler = HttpProfileCaptureRequestCallback;
+        profile_capture_params.m_Userdata = 0;
+        dmWebServer::AddHandler(engine_service->m_WebServer, "/profile_capture", &profile_capture_params);
+
+        dmWebServer::HandlerParams memory_params;
+        memory_params.m_Handler = HttpMemoryRequestCallback;
+        memory_params.m_Userdata = factory;
+        dmWebServer::AddHandler(engine_service->m_WebServer, "/memory", &memory_params);
+
+        engine_service->m_Stream = NewStream(factory, regist);
+        if (engine_service->m_Stream)
+        {
+            dmSnPrintf(engine_service->m_StreamPortText, sizeof(engine_service->m_StreamPortText), "%d", (int) engine_service->m_Stream->m_Port);
+            dmTemplate::Format(engine_service, engine_service->m_InfoJson, sizeof(engine_service->m_InfoJson), INFO_TEMPLATE, EngineService::ReplaceCallback);
+            dmLogInfo("Engine service stream listening on port %u", (unsigned int) engine_service->m_Stream->m_Port);
+        }
+
         // The entry point to the engine service profiler
         dmWebServer::HandlerParams profile_params;
         profile_params.m_Handler = ProfileHandler;
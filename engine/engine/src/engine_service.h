@@ -18,6 +18,7 @@
 #include <stdint.h>
 
 struct ResourceFactory;
+struct lua_State;
 
 namespace dmResource
 {
@@ -52,7 +53,7 @@ namespace dmEngineService
     uint16_t GetPort(HEngineService engine_service);
     dmWebServer::HServer GetWebServer(HEngineService engine_service);
 
-    void InitProfiler(HEngineService engine_service, dmResource::HFactory factory, dmGameObject::HRegister regist);
+    void InitProfiler(HEngineService engine_service, dmResource::HFactory factory, dmGameObject::HRegister regist, lua_State* L);
 
     struct ResourceHandlerParams
     {
@@ -22,6 +22,7 @@ namespace PhysicsDebugRender
 {
     void DrawLines(dmVMath::Point3* points, uint32_t point_count, dmVMath::Vector4 color, void* user_data);
     void DrawTriangles(dmVMath::Point3* points, uint32_t point_count, dmVMath::Vector4 color, void* user_data);
+    bool IsVisible(dmVMath::Point3 center, float radius, void* user_data);
 }
 
 #endif
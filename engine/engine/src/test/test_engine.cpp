@@ -12,6 +12,9 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include <stdio.h>
+#include <string.h>
+
 #include <testmain/testmain.h>
 #include <dlib/testutil.h>
 
@@ -23,6 +26,7 @@
 #include "test_engine.h"
 #include "../../../graphics/src/graphics_private.h"
 #include "../engine.h"
+#include "../engine_pacing.h"
 
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
@@ -189,6 +193,34 @@ TEST_F(EngineTest, RenderScript)
     ASSERT_EQ(frame_count, 1u);
 }
 
+TEST_F(EngineTest, RenderScriptPipelinedFlip)
+{
+    uint32_t frame_count = 0;
+    char project_path[256];
+    const char* argv[] = {"test_engine", "--config=engine.pipelined_flip=1", "--config=bootstrap.main_collection=/render_script/main.collectionc", "--config=bootstrap.render=/render_script/default.renderc", "--config=dmengine.unload_builtins=0", MAKE_PATH(project_path, "/game.projectc")};
+    ASSERT_EQ(0, Launch(DM_ARRAY_SIZE(argv), (char**)argv, 0, PostRunFrameCount, &frame_count));
+    ASSERT_EQ(frame_count, 1u);
+}
+
+TEST_F(EngineTest, RenderScriptRenderOnDemand)
+{
+    uint32_t frame_count = 0;
+    char project_path[256];
+    const char* argv[] = {"test_engine", "--config=engine.render_on_demand=1", "--config=bootstrap.main_collection=/render_script/main.collectionc", "--config=bootstrap.render=/render_script/default.renderc", "--config=dmengine.unload_builtins=0", MAKE_PATH(project_path, "/game.projectc")};
+    ASSERT_EQ(0, Launch(DM_ARRAY_SIZE(argv), (char**)argv, 0, PostRunFrameCount, &frame_count));
+    ASSERT_EQ(frame_count, 1u);
+}
+
+TEST_F(EngineTest, Headless)
+{
+    uint32_t frame_count = 0;
+    char project_path[256];
+    // No render script is loaded, and the frames are ticked at the update frequency
+    const char* argv[] = {"test_engine", "--config=engine.headless=1", "--config=display.update_frequency=120", "--config=bootstrap.main_collection=/render_script/main.collectionc", "--config=dmengine.unload_builtins=0", MAKE_PATH(project_path, "/game.projectc")};
+    ASSERT_EQ(0, Launch(DM_ARRAY_SIZE(argv), (char**)argv, 0, PostRunFrameCount, &frame_count));
+    ASSERT_EQ(frame_count, 1u);
+}
+
 TEST_F(EngineTest, CameraAqcuireFocus)
 {
     uint32_t frame_count = 0;
@@ -428,6 +460,56 @@ TEST_F(EngineTest, ModelComponent)
     ASSERT_EQ(0, Launch(DM_ARRAY_SIZE(argv), (char**)argv, 0, 0, 0));
 }
 
+TEST_F(EngineTest, Benchmark)
+{
+    const char* report_path = "test_engine_benchmark.json";
+    remove(report_path);
+
+    uint32_t frame_count = 0;
+    char project_path[256];
+    const char* argv[] = {"test_engine", "--benchmark=10", "--benchmark-report=test_engine_benchmark.json", "--config=dmengine.unload_builtins=0", MAKE_PATH(project_path, "/game.projectc")};
+    ASSERT_EQ(0, Launch(DM_ARRAY_SIZE(argv), (char**)argv, 0, PostRunFrameCount, &frame_count));
+    ASSERT_EQ(10u, frame_count);
+
+    FILE* file = fopen(report_path, "rb");
+    ASSERT_NE((FILE*)0, file);
+    char report[256];
+    size_t size = fread(report, 1, sizeof(report) - 1, file);
+    fclose(file);
+    report[size] = 0;
+    ASSERT_NE((char*)0, strstr(report, "\"frames\": 10"));
+    remove(report_path);
+}
+
+TEST(FramePacing, Adapt)
+{
+    dmEngine::FramePacing pacing;
+    dmEngine::InitFramePacing(&pacing, 60, 3, 10);
+    ASSERT_EQ(1u, pacing.m_Divisor);
+
+    // Frames that miss the vblank lower the rate when the window is complete
+    for (uint32_t i = 0; i < 9; ++i)
+        ASSERT_FALSE(dmEngine::UpdateFramePacing(&pacing, 33333, 20000));
+    ASSERT_TRUE(dmEngine::UpdateFramePacing(&pacing, 33333, 20000));
+    ASSERT_EQ(2u, pacing.m_Divisor);
+    ASSERT_NEAR(2.0f / 60.0f, dmEngine::GetFramePacingDt(&pacing), 0.0001f);
+
+    // The same cost holds the lower rate
+    for (uint32_t i = 0; i < 10; ++i)
+        ASSERT_FALSE(dmEngine::UpdateFramePacing(&pacing, 33333, 20000));
+    ASSERT_EQ(2u, pacing.m_Divisor);
+
+    // A cost that fits the higher rate with margin goes back to it
+    for (uint32_t i = 0; i < 10; ++i)
+        dmEngine::UpdateFramePacing(&pacing, 33333, 8000);
+    ASSERT_EQ(1u, pacing.m_Divisor);
+
+    // It never goes beyond the max divisor
+    for (uint32_t i = 0; i < 100; ++i)
+        dmEngine::UpdateFramePacing(&pacing, 200000, 150000);
+    ASSERT_EQ(3u, pacing.m_Divisor);
+}
+
 
 
 // Adding new test make sure it's linked in main.collection in a collection proxy
@@ -54,6 +54,7 @@ namespace dmGameObject
      * @member m_World [type: void**] Out-parameter of the pointer in which to store the created world
      * @member m_MaxComponentInstances [type: uint32_t] Max components count of this type in current collection counted at the build stage.
      *                                         If component in factory then value is 0xFFFFFFFF
+     * @member m_RandomSeed [type: uint32_t] Seed for any random state of the world. 0 unless the register is deterministic
      */
     struct ComponentNewWorldParams
     {
@@ -62,6 +63,7 @@ namespace dmGameObject
         uint32_t m_MaxInstances;
         void** m_World;
         uint32_t m_MaxComponentInstances;
+        uint32_t m_RandomSeed;
     };
 
     /*#
@@ -365,6 +367,31 @@ namespace dmGameObject
      */
     typedef UpdateResult (*ComponentsPostUpdate)(const ComponentsPostUpdateParams& params);
 
+    /*#
+     * Parameters for ComponentsHashState callback.
+     * @struct
+     * @name ComponentsHashStateParams
+     * @member m_Collection [type: HCollection] Collection handle
+     * @member m_World [type: void*] Component world
+     * @member m_Context [type: void*] User context
+     */
+    struct ComponentsHashStateParams
+    {
+        HCollection m_Collection;
+        void* m_World;
+        void* m_Context;
+    };
+
+    /*#
+     * Component hash state function. Hashes the simulation state of the world that isn't in the
+     * game object transforms, e.g. velocities. The hash should not depend on the order of the components.
+     * @typedef
+     * @name ComponentsHashState
+     * @param params [type: const dmGameObject::ComponentsHashStateParams&] Hash parameters
+     * @return hash [type: uint64_t] The hash of the world
+     */
+    typedef uint64_t (*ComponentsHashState)(const ComponentsHashStateParams& params);
+
     /*#
      * Parameters to ComponentOnMessage callback.
      * @struct
@@ -419,6 +446,37 @@ namespace dmGameObject
      */
     typedef InputResult (*ComponentOnInput)(const ComponentOnInputParams& params);
 
+    /*#
+     * Parameters to ComponentOnInputBatch callback.
+     * @struct
+     * @name ComponentOnInputBatchParams
+     * @member m_Instance [type: HInstance] Instance handle
+     * @member m_InputActions [type: const InputAction**] The actions of the frame that haven't been consumed by a listener above
+     * @member m_InputActionCount [type: uint32_t] Number of actions
+     * @member m_Results [type: InputResult*] How the component handled each action, initialized to INPUT_RESULT_IGNORED
+     * @member m_Context [type: void*] User context
+     * @member m_UserData [type: uintptr_t*] User data storage pointer
+     */
+    struct ComponentOnInputBatchParams
+    {
+        HInstance m_Instance;
+        const InputAction** m_InputActions;
+        uint32_t m_InputActionCount;
+        InputResult* m_Results;
+        void* m_Context;
+        uintptr_t* m_UserData;
+    };
+
+    /*#
+     * Component on-input-batch function. Called once per listener with all the actions of the frame,
+     * instead of ComponentOnInput, when the register dispatches input in batches
+     * @typedef
+     * @name ComponentOnInputBatch
+     * @param params [type: const dmGameObject::ComponentOnInputBatchParams&] Input parameters
+     * @return result [type: InputResult] INPUT_RESULT_UNKNOWN_ERROR on failure, the results per action are set in m_Results
+     */
+    typedef InputResult (*ComponentOnInputBatch)(const ComponentOnInputBatchParams& params);
+
     /*#
      * Parameters to ComponentOnReload callback.
      * @struct
@@ -656,6 +714,14 @@ namespace dmGameObject
      */
     void ComponentTypeSetOnMessageFn(HComponentType type, ComponentOnMessage fn);
 
+    /*# set the component hash state callback
+     * Set the component hash state callback. Optional. Called by HashCollectionState().
+     * @name ComponentTypeSetHashStateFn
+     * @param type [type: HComponentType] the type
+     * @param fn [type: ComponentsHashState] callback
+     */
+    void ComponentTypeSetHashStateFn(HComponentType type, ComponentsHashState fn);
+
     /*# set the component on-input callback
      * Set the component on-input callback. Called once per frame, before the Update function.
      * @name ComponentTypeSetOnInputFn
@@ -664,6 +730,15 @@ namespace dmGameObject
      */
     void ComponentTypeSetOnInputFn(HComponentType type, ComponentOnInput fn);
 
+    /*# set the component on-input-batch callback
+     * Set the component on-input-batch callback. Optional. When set, and the register dispatches
+     * input in batches, it's called instead of the on-input callback.
+     * @name ComponentTypeSetOnInputBatchFn
+     * @param type [type: HComponentType] the type
+     * @param fn [type: ComponentOnInputBatch] callback
+     */
+    void ComponentTypeSetOnInputBatchFn(HComponentType type, ComponentOnInputBatch fn);
+
     /*# set the component on-reload callback
      * Set the component on-reload callback. Called when the resource of a component instance is reloaded.
      * @name ComponentTypeSetOnReloadFn
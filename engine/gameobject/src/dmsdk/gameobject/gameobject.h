@@ -458,6 +458,8 @@ namespace dmGameObject
         uint32_t m_GamepadIndex;
         uint32_t m_UserID;
         dmHID::GamepadPacket m_GamepadPacket;
+        /// Time of the latest key or mouse button state change (dmTime::GetTime()), 0 if unknown
+        uint64_t m_Timestamp;
 
         uint8_t  m_IsGamepad : 1;
         uint8_t  m_GamepadUnknown : 1;
@@ -519,6 +521,27 @@ namespace dmGameObject
     HInstance Spawn(HCollection collection, HPrototype prototype, const char* prototype_name, dmhash_t id,
                       HPropertyContainer properties, const dmVMath::Point3& position, const dmVMath::Quat& rotation, const dmVMath::Vector3& scale);
 
+    /*# spawn a batch of new game objects
+     * Spawns `count` gameobject instances from the same prototype. Compared to calling #Spawn repeatedly,
+     * the instance buffer checks and allocations are done once for the batch, and each component type
+     * gets all of its create calls for the batch in sequence.
+     * @name SpawnBatch
+     * @param collection [type: HCollection] Gameobject collection
+     * @param prototype [type: HPrototype] Prototype
+     * @param prototype_name [type: const char*] Prototype file name (.goc)
+     * @param count [type: uint32_t] Number of instances to spawn
+     * @param ids [type: const dmhash_t*] Ids of the spawned instances (`count` entries)
+     * @param properties [type: HPropertyContainer] Container with override properties, shared by all instances
+     * @param positions [type: const dmVMath::Point3*] Positions of the spawned objects (`count` entries)
+     * @param rotations [type: const dmVMath::Quat*] Rotations of the spawned objects (`count` entries)
+     * @param scales [type: const dmVMath::Vector3*] Scales of the spawned objects (`count` entries)
+     * @param out_instances [type: HInstance*] Receives the spawned instances (`count` entries), 0 for each instance that failed
+     * @return spawned [type: uint32_t] the number of instances successfully spawned
+     */
+    uint32_t SpawnBatch(HCollection collection, HPrototype prototype, const char* prototype_name, uint32_t count, const dmhash_t* ids,
+                        HPropertyContainer properties, const dmVMath::Point3* positions, const dmVMath::Quat* rotations, const dmVMath::Vector3* scales,
+                        HInstance* out_instances);
+
     /*#
      * Retrieve a collection from the specified instance
      * @name GetCollection
@@ -562,6 +585,16 @@ namespace dmGameObject
      */
     uint32_t AcquireInstanceIndex(HCollection collection);
 
+    /*#
+     * Retrieve several instance indices from the index pool for the collection, with a single lock.
+     * @name AcquireInstanceIndices
+     * @param collection [type: dmGameObject::HCollection] Collection from which to retrieve the instance indices.
+     * @param count [type: uint32_t] Number of indices to retrieve.
+     * @param out_indices [type: uint32_t*] Receives the indices (at least `count` entries).
+     * @return acquired [type: uint32_t] number of indices retrieved, less than `count` if the pool is exhausted.
+     */
+    uint32_t AcquireInstanceIndices(HCollection collection, uint32_t count, uint32_t* out_indices);
+
     /*#
      * Assign an index to the instance, only if the instance is not null.
      * @name AssignInstanceIndex
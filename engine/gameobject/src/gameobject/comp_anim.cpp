@@ -15,6 +15,8 @@
 
 #include "comp_anim.h"
 
+#include <string.h> // memset
+
 #include <dlib/index_pool.h>
 #include <dlib/profile.h>
 
@@ -23,6 +25,7 @@
 #include "component.h"
 #include "gameobject_script.h"
 #include "gameobject_props_lua.h"
+#include "gameobject_private.h"
 
 extern "C"
 {
@@ -60,6 +63,8 @@ namespace dmGameObject
         uint16_t            m_NextListener;
         uint16_t            m_Index;
         uint16_t            m_Next;
+        // Resolved when the animation is started, see GetPropertyHandle
+        uint16_t            m_ComponentIndex;
         uint16_t            m_Playing : 1;
         uint16_t            m_Finished : 1;
         uint16_t            m_Composite : 1;
@@ -67,9 +72,23 @@ namespace dmGameObject
         uint16_t            m_FirstUpdate : 1;
     };
 
+    // An animation to evaluate this frame, at the eased time m_T
+    struct AnimationEval
+    {
+        uint16_t m_Animation;
+        uint16_t m_Easing;
+        float    m_T;
+    };
+
     struct AnimWorld
     {
         dmArray<Animation>                  m_Animations;
+        // Scratch buffers for the evaluation, the animations are grouped by easing type
+        // so that each built-in curve can be evaluated for all its animations at once
+        dmArray<AnimationEval>              m_Evals;
+        dmArray<uint16_t>                   m_EvalAnimations;
+        dmArray<float>                      m_EvalT;
+        uint32_t                            m_EvalCounts[dmEasing::TYPE_COUNT];
         dmArray<uint16_t>                   m_AnimMap;
         dmIndexPool<uint16_t>               m_AnimMapIndexPool;
         dmHashTable<uintptr_t, uint16_t>    m_InstanceToIndex;
@@ -77,6 +96,19 @@ namespace dmGameObject
         uint32_t                            m_InUpdate : 1;
     };
 
+    // For the animations without a value pointer, which are set through the component
+    static void GetAnimationPropertyHandle(const Animation& anim, PropertyHandle* handle)
+    {
+        handle->m_Instance = anim.m_Instance;
+        handle->m_ComponentId = anim.m_ComponentId;
+        handle->m_PropertyId = anim.m_PropertyId;
+        handle->m_Options.m_Index = 0;
+        handle->m_ValuePtr = 0x0;
+        handle->m_Type = PROPERTY_TYPE_NUMBER;
+        handle->m_ComponentIndex = anim.m_ComponentIndex;
+        handle->m_ReadOnly = 0;
+    }
+
     CreateResult CompAnimNewWorld(const ComponentNewWorldParams& params)
     {
         if (params.m_World != 0x0)
@@ -154,6 +186,70 @@ namespace dmGameObject
 
     static void RemoveAnimationCallback(AnimWorld* world, Animation* anim);
 
+    static void EvaluateAnimations(AnimWorld* world)
+    {
+        uint32_t eval_count = world->m_Evals.Size();
+        if (eval_count == 0)
+        {
+            return;
+        }
+
+        // Group the animations by easing type
+        uint32_t offsets[dmEasing::TYPE_COUNT];
+        uint32_t offset = 0;
+        for (uint32_t type = 0; type < dmEasing::TYPE_COUNT; ++type)
+        {
+            offsets[type] = offset;
+            offset += world->m_EvalCounts[type];
+        }
+        world->m_EvalAnimations.SetSize(eval_count);
+        world->m_EvalT.SetSize(eval_count);
+        uint16_t* animations = world->m_EvalAnimations.Begin();
+        float* t = world->m_EvalT.Begin();
+        for (uint32_t i = 0; i < eval_count; ++i)
+        {
+            const AnimationEval& eval = world->m_Evals[i];
+            uint32_t index = offsets[eval.m_Easing]++;
+            animations[index] = eval.m_Animation;
+            t[index] = eval.m_T;
+        }
+
+        // Evaluate the curves in place, the custom curves have one vector each
+        offset = 0;
+        for (uint32_t type = 0; type < dmEasing::TYPE_COUNT; ++type)
+        {
+            uint32_t count = world->m_EvalCounts[type];
+            if (type == dmEasing::TYPE_FLOAT_VECTOR)
+            {
+                for (uint32_t i = offset; i < offset + count; ++i)
+                {
+                    t[i] = dmEasing::GetValue(world->m_Animations[animations[i]].m_Easing, t[i]);
+                }
+            }
+            else if (count > 0)
+            {
+                dmEasing::GetValues((dmEasing::Type)type, t + offset, t + offset, count);
+            }
+            offset += count;
+        }
+
+        for (uint32_t i = 0; i < eval_count; ++i)
+        {
+            Animation& anim = world->m_Animations[animations[i]];
+            float v = anim.m_From + (anim.m_To - anim.m_From) * t[i];
+            if (anim.m_Value != 0x0)
+            {
+                *anim.m_Value = v;
+            }
+            else
+            {
+                PropertyHandle handle;
+                GetAnimationPropertyHandle(anim, &handle);
+                SetProperty(handle, PropertyVar(v));
+            }
+        }
+    }
+
     CreateResult CompAnimAddToUpdate(const ComponentAddToUpdateParams& params) {
         // Intentional pass-through
         return CREATE_RESULT_OK;
@@ -173,7 +269,9 @@ namespace dmGameObject
          * have an incorrect value when read by the newly started animation to
          * retrieve the from-value.
          *
-         * The second pass advances and evaluates the animations.
+         * The second pass advances and evaluates the animations. The animations are
+         * gathered and grouped by easing type, then evaluated per curve and finally
+         * written to the properties.
          *
          * The third pass prunes stopped animations and call callbacks.
          *
@@ -187,6 +285,15 @@ namespace dmGameObject
 
         DM_PROPERTY_ADD_U32(rmtp_ComponentsAnim, size);
 
+        if (world->m_Evals.Capacity() < size)
+        {
+            world->m_Evals.SetCapacity(size);
+            world->m_EvalAnimations.SetCapacity(size);
+            world->m_EvalT.SetCapacity(size);
+        }
+        world->m_Evals.SetSize(0);
+        memset(world->m_EvalCounts, 0, sizeof(world->m_EvalCounts));
+
         uint32_t i = 0;
         for (i = 0; i < size; ++i)
         {
@@ -210,9 +317,9 @@ namespace dmGameObject
                     else
                     {
                         PropertyDesc desc;
-                        PropertyOptions property_opt;
-                        property_opt.m_Index = 0;
-                        GetProperty(anim.m_Instance, anim.m_ComponentId, anim.m_PropertyId, property_opt, desc);
+                        PropertyHandle handle;
+                        GetAnimationPropertyHandle(anim, &handle);
+                        GetProperty(handle, desc);
                         anim.m_From = (float)desc.m_Variant.m_Number;
                     }
                 }
@@ -308,24 +415,19 @@ namespace dmGameObject
                         t = 2.0f - t;
                     }
                 }
-                t = dmEasing::GetValue(anim.m_Easing, t);
-                float v = anim.m_From + (anim.m_To - anim.m_From) * t;
-                if (anim.m_Value != 0x0)
-                {
-                    *anim.m_Value = v;
-                }
-                else
-                {
-                    PropertyOptions property_opt;
-                    property_opt.m_Index = 0;
-                    SetProperty(anim.m_Instance, anim.m_ComponentId, anim.m_PropertyId, property_opt, PropertyVar(v));
-                }
+                AnimationEval eval;
+                eval.m_Animation = (uint16_t)i;
+                eval.m_Easing    = (uint16_t)anim.m_Easing.type;
+                eval.m_T         = t;
+                world->m_Evals.Push(eval);
+                world->m_EvalCounts[eval.m_Easing]++;
             }
             if (completed)
             {
                 StopAnimation(&anim, true);
             }
         }
+        EvaluateAnimations(world);
         i = 0;
         // Prune canceled animations and call callbacks
         while (i < size)
@@ -401,6 +503,7 @@ namespace dmGameObject
 
     static bool PlayAnimation(AnimWorld* world, HInstance instance, dmhash_t component_id,
                      dmhash_t property_id,
+                     uint16_t component_index,
                      Playback playback,
                      float* value,
                      float from,
@@ -460,6 +563,7 @@ namespace dmGameObject
         animation.m_Instance = instance;
         animation.m_ComponentId = component_id;
         animation.m_PropertyId = property_id;
+        animation.m_ComponentIndex = component_index;
         animation.m_Playback = playback;
         animation.m_Easing = easing;
         animation.m_Value = value;
@@ -507,10 +611,10 @@ namespace dmGameObject
     }
 
     static bool PlayCompositeAnimation(AnimWorld* world, HInstance instance, dmhash_t component_id,
-            dmhash_t property_id, Playback playback, float duration, float delay, dmEasing::Curve easing, AnimationStopped animation_stopped,
+            dmhash_t property_id, uint16_t component_index, Playback playback, float duration, float delay, dmEasing::Curve easing, AnimationStopped animation_stopped,
             void* userdata1, void* userdata2)
     {
-        return PlayAnimation(world, instance, component_id, property_id, playback, 0x0, 0, 0, easing,
+        return PlayAnimation(world, instance, component_id, property_id, component_index, playback, 0x0, 0, 0, easing,
                 duration, delay, animation_stopped, userdata1, userdata2, true);
     }
 
@@ -550,6 +654,12 @@ namespace dmGameObject
         {
             return prop_result;
         }
+        // So that the properties without a value pointer are set without looking up the component each frame
+        uint16_t component_index = INVALID_COMPONENT_INDEX;
+        if (component_id != 0)
+        {
+            GetComponentIndex(instance, component_id, &component_index);
+        }
         if (prop_desc.m_ReadOnly)
         {
             return PROPERTY_RESULT_UNSUPPORTED_OPERATION;
@@ -577,7 +687,7 @@ namespace dmGameObject
 
         if (element_count > 1)
         {
-            if (!PlayCompositeAnimation(world, instance, component_id, property_id, playback,
+            if (!PlayCompositeAnimation(world, instance, component_id, property_id, component_index, playback,
                     duration, delay, easing, animation_stopped, userdata1, userdata2))
                 return PROPERTY_RESULT_BUFFER_OVERFLOW;
 
@@ -589,14 +699,14 @@ namespace dmGameObject
                 float* val_ptr = 0x0;
                 if (prop_desc.m_ValuePtr != 0x0)
                     val_ptr = prop_desc.m_ValuePtr + i;
-                if (!PlayAnimation(world, instance, component_id, prop_desc.m_ElementIds[i], playback, val_ptr,
+                if (!PlayAnimation(world, instance, component_id, prop_desc.m_ElementIds[i], component_index, playback, val_ptr,
                         *(v + i), to.m_V4[i], easing, duration, delay, 0x0, 0x0, 0x0, false))
                     return PROPERTY_RESULT_BUFFER_OVERFLOW;
             }
         }
         else
         {
-            if (!PlayAnimation(world, instance, component_id, property_id, playback, prop_desc.m_ValuePtr,
+            if (!PlayAnimation(world, instance, component_id, property_id, component_index, playback, prop_desc.m_ValuePtr,
                     (float)prop_desc.m_Variant.m_Number, (float)to.m_Number, easing, duration, delay, animation_stopped,
                     userdata1, userdata2, false))
                 return PROPERTY_RESULT_BUFFER_OVERFLOW;
@@ -748,4 +858,19 @@ namespace dmGameObject
             world->m_ListenerInstanceToIndex.Erase((uintptr_t)userdata1);
         }
     }
+
+    bool HasAnimations(HRegister regist)
+    {
+        DM_MUTEX_SCOPED_LOCK(regist->m_Mutex);
+        for (uint32_t i = 0; i < regist->m_Collections.Size(); ++i)
+        {
+            Collection* collection = regist->m_Collections[i];
+            if (collection->m_HCollection == 0)
+                continue;
+            AnimWorld* world = GetWorld(collection->m_HCollection);
+            if (world != 0x0 && !world->m_Animations.Empty())
+                return true;
+        }
+        return false;
+    }
 }
@@ -17,6 +17,7 @@
 
 #include <dlib/dstrings.h>
 #include <dlib/profile.h>
+#include <dlib/time.h>
 
 #include <script/script.h>
 
@@ -44,6 +45,11 @@ namespace dmGameObject
             uint32_t component_count = dmMath::Min(params.m_MaxComponentInstances, params.m_MaxInstances);
             CompScriptWorld* w = new CompScriptWorld(component_count);
             w->m_ScriptWorld = dmScript::NewScriptWorld((dmScript::HContext)params.m_Context);
+            if (params.m_RandomSeed != 0)
+            {
+                // A deterministic collection, where math.random gives the same numbers on every client
+                dmScript::SetScriptWorldRandomSeed(w->m_ScriptWorld, params.m_RandomSeed);
+            }
             *params.m_World = w;
 
             return CREATE_RESULT_OK;
@@ -231,16 +237,23 @@ namespace dmGameObject
         RunScriptParams run_params;
         run_params.m_UpdateContext = params.m_UpdateContext;
         CompScriptWorld* script_world = (CompScriptWorld*)params.m_World;
+        HRegister regist = params.m_Collection->m_Collection->m_Register;
+        SceneProfileFunction profile_function = function == SCRIPT_FUNCTION_UPDATE ? SCENE_PROFILE_FUNCTION_UPDATE : SCENE_PROFILE_FUNCTION_FIXED_UPDATE;
         uint32_t size = script_world->m_Instances.Size();
         for (uint32_t i = 0; i < size; ++i)
         {
             HScriptInstance script_instance = script_world->m_Instances[i];
             if (script_instance->m_Update) {
+                uint64_t profile_start = regist->m_SceneProfileEnabled ? dmTime::GetTime() : 0;
                 ScriptResult ret = RunScript(L, script_instance->m_Script, function, script_instance, run_params);
                 if (ret == SCRIPT_RESULT_FAILED)
                 {
                     result = UPDATE_RESULT_UNKNOWN_ERROR;
                 }
+                if (profile_start && script_instance->m_Script->m_FunctionReferences[function] != LUA_NOREF)
+                {
+                    AddScriptProfileSample(regist, script_instance->m_Script->m_LuaModule->m_Source.m_Filename, profile_function, profile_start);
+                }
             }
         }
 
@@ -333,7 +346,7 @@ namespace dmGameObject
             // TODO: setjmp/longjmp here... how to handle?!!! We are not running "from lua" here
             // lua_cpcall?
             message_name = ((const dmDDF::Descriptor*)message->m_Descriptor)->m_Name;
-            dmScript::PushDDF(L, (const dmDDF::Descriptor*)message->m_Descriptor, (const char*) message->m_Data, true);
+            dmScript::PushDDF(L, (const dmDDF::Descriptor*)message->m_Descriptor, (const char*) dmMessage::GetData(message), true);
         }
         else
         {
@@ -343,7 +356,7 @@ namespace dmGameObject
                 message_name = (const char*)dmHashReverse64(message->m_Id, 0);
             }
             if (message->m_DataSize > 0)
-                dmScript::PushTable(L, (const char*)message->m_Data, message->m_DataSize);
+                dmScript::PushTable(L, (const char*)dmMessage::GetData(message), message->m_DataSize);
             else
                 lua_newtable(L);
         }
@@ -387,7 +400,7 @@ namespace dmGameObject
         {
             if (params.m_Message->m_Id == dmGameObjectDDF::ScriptMessage::m_DDFDescriptor->m_NameHash)
             {
-                dmGameObjectDDF::ScriptMessage* script_message = (dmGameObjectDDF::ScriptMessage*)params.m_Message->m_Data;
+                dmGameObjectDDF::ScriptMessage* script_message = (dmGameObjectDDF::ScriptMessage*)dmMessage::GetData(params.m_Message);
                 uint32_t payload_message_size = 0;
 
                 const dmDDF::Descriptor* descriptor = dmDDF::GetDescriptorFromHash(script_message->m_DescriptorHash);
@@ -397,7 +410,7 @@ namespace dmGameObject
                     return UPDATE_RESULT_OK;
                 }
 
-                const uint8_t* packed_payload = ((uint8_t*)params.m_Message->m_Data) + sizeof(dmGameObjectDDF::ScriptMessage);
+                const uint8_t* packed_payload = ((uint8_t*)dmMessage::GetData(params.m_Message)) + sizeof(dmGameObjectDDF::ScriptMessage);
 
                 dmDDF::Result ddf_result = dmDDF::LoadMessage(packed_payload, script_message->m_PayloadSize, descriptor, &payload_message, 0, &payload_message_size);
                 if (ddf_result != dmDDF::RESULT_OK)
@@ -413,6 +426,7 @@ namespace dmGameObject
                 message->m_Receiver     = params.m_Message->m_Receiver;
                 message->m_Id           = descriptor->m_NameHash;
                 message->m_DataSize     = payload_message_size;
+                message->m_Flags        = 0;
                 message->m_Descriptor   = (uintptr_t)descriptor;
                 message->m_UserData1    = 0; // should we copy the current m_UserData1?
                 message->m_UserData2    = 0; // deprecated (the Lua function reference)
@@ -458,7 +472,13 @@ namespace dmGameObject
 
         if (function_ref != LUA_NOREF)
         {
+            HRegister regist = script_instance->m_Instance->m_Collection->m_Register;
+            uint64_t profile_start = regist->m_SceneProfileEnabled ? dmTime::GetTime() : 0;
             result = HandleMessage(params.m_Context, script_instance, message, function_ref, is_callback, deref_function_ref);
+            if (profile_start)
+            {
+                AddScriptProfileSample(regist, script_instance->m_Script->m_LuaModule->m_Source.m_Filename, SCENE_PROFILE_FUNCTION_ON_MESSAGE, profile_start);
+            }
         }
 
         if (payload_message)
@@ -470,246 +490,259 @@ namespace dmGameObject
         return result;
     }
 
-    InputResult CompScriptOnInput(const ComponentOnInputParams& params)
+    // Pushes the action table of on_input
+    static void PushInputAction(lua_State* L, const InputAction* action)
     {
-        DM_PROFILE("RunScript");
-        InputResult result = INPUT_RESULT_IGNORED;
+        lua_createtable(L, 0, 16);
 
-        ScriptInstance* script_instance = (ScriptInstance*)*params.m_UserData;
+        int action_table = lua_gettop(L);
 
-        int function_ref = script_instance->m_Script->m_FunctionReferences[SCRIPT_FUNCTION_ONINPUT];
-        if (function_ref != LUA_NOREF)
+        if (action->m_IsGamepad)
         {
-            lua_State* L = GetLuaState(params.m_Context);
-            int top = lua_gettop(L);
-            (void)top;
-
-            lua_rawgeti(L, LUA_REGISTRYINDEX, script_instance->m_InstanceReference);
-            dmScript::SetInstance(L);
-
-            lua_rawgeti(L, LUA_REGISTRYINDEX, function_ref);
-            lua_rawgeti(L, LUA_REGISTRYINDEX, script_instance->m_InstanceReference);
+            lua_pushnumber(L, action->m_GamepadIndex);
+            lua_setfield(L, action_table, "gamepad");
 
-            // 0 is reserved for pure mouse movement
-            if (params.m_InputAction->m_ActionId != 0)
-            {
-                dmScript::PushHash(L, params.m_InputAction->m_ActionId);
-            }
-            else
-            {
-                lua_pushnil(L);
-            }
+            lua_pushinteger(L, action->m_UserID);
+            lua_setfield(L, action_table, "userid");
 
-            lua_createtable(L, 0, 16);
+            lua_pushboolean(L, action->m_GamepadUnknown);
+            lua_setfield(L, action_table, "gamepad_unknown");
+        }
 
-            int action_table = lua_gettop(L);
+        if (action->m_GamepadConnected)
+        {
+            lua_pushlstring(L, action->m_Text, action->m_TextCount);
+            lua_setfield(L, action_table, "gamepad_name");
+        }
 
-            if (params.m_InputAction->m_IsGamepad)
+        if (action->m_HasGamepadPacket)
+        {
+            dmHID::GamepadPacket gamepadPacket = action->m_GamepadPacket;
+            lua_pushliteral(L, "gamepad_axis");
+            lua_createtable(L, dmHID::MAX_GAMEPAD_AXIS_COUNT, 0);
+            for (int i = 0; i < dmHID::MAX_GAMEPAD_AXIS_COUNT; ++i)
             {
-                lua_pushnumber(L, params.m_InputAction->m_GamepadIndex);
-                lua_setfield(L, action_table, "gamepad");
-
-                lua_pushinteger(L, params.m_InputAction->m_UserID);
-                lua_setfield(L, action_table, "userid");
-
-                lua_pushboolean(L, params.m_InputAction->m_GamepadUnknown);
-                lua_setfield(L, action_table, "gamepad_unknown");
+                lua_pushinteger(L, (lua_Integer) (i+1));
+                lua_pushnumber(L, gamepadPacket.m_Axis[i]);
+                lua_settable(L, -3);
             }
+            lua_settable(L, -3);
 
-            if (params.m_InputAction->m_GamepadConnected)
+            lua_pushliteral(L, "gamepad_buttons");
+            lua_createtable(L, dmHID::MAX_GAMEPAD_BUTTON_COUNT, 0);
+            for (int i = 0; i < dmHID::MAX_GAMEPAD_BUTTON_COUNT; ++i)
             {
-                lua_pushlstring(L, params.m_InputAction->m_Text, params.m_InputAction->m_TextCount);
-                lua_setfield(L, action_table, "gamepad_name");
+                lua_pushinteger(L, (lua_Integer) (i+1));
+                lua_pushnumber(L, dmHID::GetGamepadButton(&gamepadPacket, i));
+                lua_settable(L, -3);
             }
+            lua_settable(L, -3);
 
-            if (params.m_InputAction->m_HasGamepadPacket)
+            lua_pushliteral(L, "gamepad_hats");
+            lua_createtable(L, dmHID::MAX_GAMEPAD_HAT_COUNT, 0);
+            for (int i = 0; i < dmHID::MAX_GAMEPAD_HAT_COUNT; ++i)
             {
-                dmHID::GamepadPacket gamepadPacket = params.m_InputAction->m_GamepadPacket;
-                lua_pushliteral(L, "gamepad_axis");
-                lua_createtable(L, dmHID::MAX_GAMEPAD_AXIS_COUNT, 0);
-                for (int i = 0; i < dmHID::MAX_GAMEPAD_AXIS_COUNT; ++i)
+                lua_pushinteger(L, (lua_Integer) (i+1));
+                uint8_t hat_value;
+                if (dmHID::GetGamepadHat(&gamepadPacket, i, &hat_value))
                 {
-                    lua_pushinteger(L, (lua_Integer) (i+1));
-                    lua_pushnumber(L, gamepadPacket.m_Axis[i]);
-                    lua_settable(L, -3);
+                    lua_pushnumber(L, hat_value);
                 }
-                lua_settable(L, -3);
-
-                lua_pushliteral(L, "gamepad_buttons");
-                lua_createtable(L, dmHID::MAX_GAMEPAD_BUTTON_COUNT, 0);
-                for (int i = 0; i < dmHID::MAX_GAMEPAD_BUTTON_COUNT; ++i)
-                {
-                    lua_pushinteger(L, (lua_Integer) (i+1));
-                    lua_pushnumber(L, dmHID::GetGamepadButton(&gamepadPacket, i));
-                    lua_settable(L, -3);
-                }
-                lua_settable(L, -3);
-
-                lua_pushliteral(L, "gamepad_hats");
-                lua_createtable(L, dmHID::MAX_GAMEPAD_HAT_COUNT, 0);
-                for (int i = 0; i < dmHID::MAX_GAMEPAD_HAT_COUNT; ++i)
+                else
                 {
-                    lua_pushinteger(L, (lua_Integer) (i+1));
-                    uint8_t hat_value;
-                    if (dmHID::GetGamepadHat(&gamepadPacket, i, &hat_value))
-                    {
-                        lua_pushnumber(L, hat_value);
-                    }
-                    else
-                    {
-                        lua_pushnumber(L, 0);
-                    }
-                    lua_settable(L, -3);
+                    lua_pushnumber(L, 0);
                 }
                 lua_settable(L, -3);
             }
+            lua_settable(L, -3);
+        }
 
-            if (params.m_InputAction->m_ActionId != 0)
-            {
-                lua_pushliteral(L, "value");
-                lua_pushnumber(L, params.m_InputAction->m_Value);
-                lua_settable(L, action_table);
+        if (action->m_ActionId != 0)
+        {
+            lua_pushliteral(L, "value");
+            lua_pushnumber(L, action->m_Value);
+            lua_settable(L, action_table);
 
-                lua_pushliteral(L, "pressed");
-                lua_pushboolean(L, params.m_InputAction->m_Pressed);
-                lua_settable(L, action_table);
+            lua_pushliteral(L, "pressed");
+            lua_pushboolean(L, action->m_Pressed);
+            lua_settable(L, action_table);
 
-                lua_pushliteral(L, "released");
-                lua_pushboolean(L, params.m_InputAction->m_Released);
-                lua_settable(L, action_table);
+            lua_pushliteral(L, "released");
+            lua_pushboolean(L, action->m_Released);
+            lua_settable(L, action_table);
 
-                lua_pushliteral(L, "repeated");
-                lua_pushboolean(L, params.m_InputAction->m_Repeated);
-                lua_settable(L, action_table);
-            }
+            lua_pushliteral(L, "repeated");
+            lua_pushboolean(L, action->m_Repeated);
+            lua_settable(L, action_table);
 
-            if (params.m_InputAction->m_PositionSet)
+            if (action->m_Timestamp != 0)
             {
-                lua_pushliteral(L, "x");
-                lua_pushnumber(L, params.m_InputAction->m_X);
+                lua_pushliteral(L, "timestamp");
+                lua_pushnumber(L, action->m_Timestamp / 1000000.0);
                 lua_settable(L, action_table);
+            }
+        }
 
-                lua_pushliteral(L, "y");
-                lua_pushnumber(L, params.m_InputAction->m_Y);
-                lua_settable(L, action_table);
+        if (action->m_PositionSet)
+        {
+            lua_pushliteral(L, "x");
+            lua_pushnumber(L, action->m_X);
+            lua_settable(L, action_table);
 
-                lua_pushliteral(L, "dx");
-                lua_pushnumber(L, params.m_InputAction->m_DX);
-                lua_settable(L, action_table);
+            lua_pushliteral(L, "y");
+            lua_pushnumber(L, action->m_Y);
+            lua_settable(L, action_table);
 
-                lua_pushliteral(L, "dy");
-                lua_pushnumber(L, params.m_InputAction->m_DY);
-                lua_settable(L, action_table);
+            lua_pushliteral(L, "dx");
+            lua_pushnumber(L, action->m_DX);
+            lua_settable(L, action_table);
 
-                lua_pushliteral(L, "screen_x");
-                lua_pushnumber(L, params.m_InputAction->m_ScreenX);
-                lua_settable(L, action_table);
+            lua_pushliteral(L, "dy");
+            lua_pushnumber(L, action->m_DY);
+            lua_settable(L, action_table);
 
-                lua_pushliteral(L, "screen_y");
-                lua_pushnumber(L, params.m_InputAction->m_ScreenY);
-                lua_settable(L, action_table);
+            lua_pushliteral(L, "screen_x");
+            lua_pushnumber(L, action->m_ScreenX);
+            lua_settable(L, action_table);
 
-                lua_pushliteral(L, "screen_dx");
-                lua_pushnumber(L, params.m_InputAction->m_ScreenDX);
-                lua_settable(L, action_table);
+            lua_pushliteral(L, "screen_y");
+            lua_pushnumber(L, action->m_ScreenY);
+            lua_settable(L, action_table);
 
-                lua_pushliteral(L, "screen_dy");
-                lua_pushnumber(L, params.m_InputAction->m_ScreenDY);
-                lua_settable(L, action_table);
-            }
+            lua_pushliteral(L, "screen_dx");
+            lua_pushnumber(L, action->m_ScreenDX);
+            lua_settable(L, action_table);
 
-            if (params.m_InputAction->m_AccelerationSet)
-            {
-                lua_pushliteral(L, "acc_x");
-                lua_pushnumber(L, params.m_InputAction->m_AccX);
-                lua_settable(L, action_table);
+            lua_pushliteral(L, "screen_dy");
+            lua_pushnumber(L, action->m_ScreenDY);
+            lua_settable(L, action_table);
+        }
 
-                lua_pushliteral(L, "acc_y");
-                lua_pushnumber(L, params.m_InputAction->m_AccY);
-                lua_settable(L, action_table);
+        if (action->m_AccelerationSet)
+        {
+            lua_pushliteral(L, "acc_x");
+            lua_pushnumber(L, action->m_AccX);
+            lua_settable(L, action_table);
 
-                lua_pushliteral(L, "acc_z");
-                lua_pushnumber(L, params.m_InputAction->m_AccZ);
-                lua_settable(L, action_table);
-            }
+            lua_pushliteral(L, "acc_y");
+            lua_pushnumber(L, action->m_AccY);
+            lua_settable(L, action_table);
 
-            if (params.m_InputAction->m_TouchCount > 0)
+            lua_pushliteral(L, "acc_z");
+            lua_pushnumber(L, action->m_AccZ);
+            lua_settable(L, action_table);
+        }
+
+        if (action->m_TouchCount > 0)
+        {
+            int tc = action->m_TouchCount;
+            lua_pushliteral(L, "touch");
+            lua_createtable(L, tc, 0);
+            for (int i = 0; i < tc; ++i)
             {
-                int tc = params.m_InputAction->m_TouchCount;
-                lua_pushliteral(L, "touch");
-                lua_createtable(L, tc, 0);
-                for (int i = 0; i < tc; ++i)
-                {
-                    const dmHID::Touch& t = params.m_InputAction->m_Touch[i];
+                const dmHID::Touch& t = action->m_Touch[i];
 
-                    lua_pushinteger(L, (lua_Integer) (i+1));
-                    lua_createtable(L, 0, 6);
+                lua_pushinteger(L, (lua_Integer) (i+1));
+                lua_createtable(L, 0, 6);
 
-                    lua_pushliteral(L, "id");
-                    lua_pushinteger(L, (lua_Integer) t.m_Id);
-                    lua_settable(L, -3);
+                lua_pushliteral(L, "id");
+                lua_pushinteger(L, (lua_Integer) t.m_Id);
+                lua_settable(L, -3);
 
-                    lua_pushliteral(L, "tap_count");
-                    lua_pushinteger(L, (lua_Integer) t.m_TapCount);
-                    lua_settable(L, -3);
+                lua_pushliteral(L, "tap_count");
+                lua_pushinteger(L, (lua_Integer) t.m_TapCount);
+                lua_settable(L, -3);
 
-                    lua_pushliteral(L, "pressed");
-                    lua_pushboolean(L, t.m_Phase == dmHID::PHASE_BEGAN);
-                    lua_settable(L, -3);
+                lua_pushliteral(L, "pressed");
+                lua_pushboolean(L, t.m_Phase == dmHID::PHASE_BEGAN);
+                lua_settable(L, -3);
 
-                    lua_pushliteral(L, "released");
-                    lua_pushboolean(L, t.m_Phase == dmHID::PHASE_ENDED || t.m_Phase == dmHID::PHASE_CANCELLED);
-                    lua_settable(L, -3);
+                lua_pushliteral(L, "released");
+                lua_pushboolean(L, t.m_Phase == dmHID::PHASE_ENDED || t.m_Phase == dmHID::PHASE_CANCELLED);
+                lua_settable(L, -3);
 
-                    lua_pushliteral(L, "x");
-                    lua_pushinteger(L, (lua_Integer) t.m_X);
-                    lua_settable(L, -3);
+                lua_pushliteral(L, "x");
+                lua_pushinteger(L, (lua_Integer) t.m_X);
+                lua_settable(L, -3);
 
-                    lua_pushliteral(L, "y");
-                    lua_pushinteger(L, (lua_Integer) t.m_Y);
-                    lua_settable(L, -3);
+                lua_pushliteral(L, "y");
+                lua_pushinteger(L, (lua_Integer) t.m_Y);
+                lua_settable(L, -3);
 
-                    lua_pushliteral(L, "screen_x");
-                    lua_pushnumber(L, (lua_Integer) t.m_ScreenX);
-                    lua_settable(L, -3);
+                lua_pushliteral(L, "screen_x");
+                lua_pushnumber(L, (lua_Integer) t.m_ScreenX);
+                lua_settable(L, -3);
 
-                    lua_pushliteral(L, "screen_y");
-                    lua_pushnumber(L, (lua_Integer) t.m_ScreenY);
-                    lua_settable(L, -3);
+                lua_pushliteral(L, "screen_y");
+                lua_pushnumber(L, (lua_Integer) t.m_ScreenY);
+                lua_settable(L, -3);
 
-                    lua_pushliteral(L, "dx");
-                    lua_pushinteger(L, (lua_Integer) t.m_DX);
-                    lua_settable(L, -3);
+                lua_pushliteral(L, "dx");
+                lua_pushinteger(L, (lua_Integer) t.m_DX);
+                lua_settable(L, -3);
 
-                    lua_pushliteral(L, "dy");
-                    lua_pushinteger(L, (lua_Integer) t.m_DY);
-                    lua_settable(L, -3);
+                lua_pushliteral(L, "dy");
+                lua_pushinteger(L, (lua_Integer) t.m_DY);
+                lua_settable(L, -3);
 
-                    lua_pushstring(L, "screen_dx");
-                    lua_pushnumber(L, (lua_Integer) t.m_ScreenDX);
-                    lua_rawset(L, -3);
+                lua_pushstring(L, "screen_dx");
+                lua_pushnumber(L, (lua_Integer) t.m_ScreenDX);
+                lua_rawset(L, -3);
 
-                    lua_pushstring(L, "screen_dy");
-                    lua_pushnumber(L, (lua_Integer) t.m_ScreenDY);
-                    lua_rawset(L, -3);
+                lua_pushstring(L, "screen_dy");
+                lua_pushnumber(L, (lua_Integer) t.m_ScreenDY);
+                lua_rawset(L, -3);
 
-                    lua_settable(L, -3);
-                }
                 lua_settable(L, -3);
             }
+            lua_settable(L, -3);
+        }
+
+        if (action->m_HasText)
+        {
+            int tc = action->m_TextCount;
+            lua_pushliteral(L, "text");
+            if (tc == 0) {
+                lua_pushstring(L, "");
+            } else {
+                lua_pushlstring(L, action->m_Text, tc);
+            }
+            lua_settable(L, -3);
+        }
+    }
+
+    InputResult CompScriptOnInput(const ComponentOnInputParams& params)
+    {
+        DM_PROFILE("RunScript");
+        InputResult result = INPUT_RESULT_IGNORED;
+
+        ScriptInstance* script_instance = (ScriptInstance*)*params.m_UserData;
+
+        int function_ref = script_instance->m_Script->m_FunctionReferences[SCRIPT_FUNCTION_ONINPUT];
+        if (function_ref != LUA_NOREF)
+        {
+            lua_State* L = GetLuaState(params.m_Context);
+            int top = lua_gettop(L);
+            (void)top;
+
+            lua_rawgeti(L, LUA_REGISTRYINDEX, script_instance->m_InstanceReference);
+            dmScript::SetInstance(L);
 
-            if (params.m_InputAction->m_HasText)
+            lua_rawgeti(L, LUA_REGISTRYINDEX, function_ref);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, script_instance->m_InstanceReference);
+
+            // 0 is reserved for pure mouse movement
+            if (params.m_InputAction->m_ActionId != 0)
             {
-                int tc = params.m_InputAction->m_TextCount;
-                lua_pushliteral(L, "text");
-                if (tc == 0) {
-                    lua_pushstring(L, "");
-                } else {
-                    lua_pushlstring(L, params.m_InputAction->m_Text, tc);
-                }
-                lua_settable(L, -3);
+                dmScript::PushHash(L, params.m_InputAction->m_ActionId);
+            }
+            else
+            {
+                lua_pushnil(L);
             }
 
+            PushInputAction(L, params.m_InputAction);
+
             int arg_count = 3;
             int input_ret = lua_gettop(L) - arg_count;
             int ret;
@@ -751,6 +784,101 @@ namespace dmGameObject
         return result;
     }
 
+    InputResult CompScriptOnInputBatch(const ComponentOnInputBatchParams& params)
+    {
+        ScriptInstance* script_instance = (ScriptInstance*)*params.m_UserData;
+
+        int function_ref = script_instance->m_Script->m_FunctionReferences[SCRIPT_FUNCTION_ONINPUT_BATCH];
+        if (function_ref == LUA_NOREF)
+        {
+            // The script only has on_input, which gets the actions one at a time
+            for (uint32_t i = 0; i < params.m_InputActionCount; ++i)
+            {
+                ComponentOnInputParams input_params;
+                input_params.m_Instance = params.m_Instance;
+                input_params.m_InputAction = params.m_InputActions[i];
+                input_params.m_Context = params.m_Context;
+                input_params.m_UserData = params.m_UserData;
+                params.m_Results[i] = CompScriptOnInput(input_params);
+                if (params.m_Results[i] == INPUT_RESULT_UNKNOWN_ERROR)
+                    return INPUT_RESULT_UNKNOWN_ERROR;
+            }
+            return INPUT_RESULT_IGNORED;
+        }
+
+        DM_PROFILE("RunScript");
+        InputResult result = INPUT_RESULT_IGNORED;
+
+        lua_State* L = GetLuaState(params.m_Context);
+        int top = lua_gettop(L);
+        (void)top;
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, script_instance->m_InstanceReference);
+        dmScript::SetInstance(L);
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, function_ref);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, script_instance->m_InstanceReference);
+
+        lua_createtable(L, params.m_InputActionCount, 0);
+        for (uint32_t i = 0; i < params.m_InputActionCount; ++i)
+        {
+            const InputAction* action = params.m_InputActions[i];
+            PushInputAction(L, action);
+
+            // 0 is reserved for pure mouse movement
+            if (action->m_ActionId != 0)
+            {
+                dmScript::PushHash(L, action->m_ActionId);
+                lua_setfield(L, -2, "action_id");
+            }
+            lua_rawseti(L, -2, i + 1);
+        }
+
+        int arg_count = 2;
+        int input_ret = lua_gettop(L) - arg_count;
+        int ret;
+        {
+            char buffer[128];
+            const char* profiler_string = dmScript::GetProfilerString(L, 0, script_instance->m_Script->m_LuaModule->m_Source.m_Filename, SCRIPT_FUNCTION_NAMES[SCRIPT_FUNCTION_ONINPUT_BATCH], 0, buffer, sizeof(buffer));
+            DM_PROFILE_DYN(profiler_string, 0);
+
+            ret = dmScript::PCall(L, arg_count, LUA_MULTRET);
+        }
+        if (ret != 0)
+        {
+            result = INPUT_RESULT_UNKNOWN_ERROR;
+        }
+        else
+        {
+            int nretval = lua_gettop(L) - input_ret + 1;
+            if (nretval > 0)
+            {
+                if (nretval == 1 && lua_isboolean(L, -1))
+                {
+                    // Returning true consumes all the actions
+                    if (lua_toboolean(L, -1))
+                    {
+                        for (uint32_t i = 0; i < params.m_InputActionCount; ++i)
+                            params.m_Results[i] = INPUT_RESULT_CONSUMED;
+                    }
+                }
+                else
+                {
+                    dmLogError("Script %s must return a boolean value (true/false), or no value at all.", SCRIPT_FUNCTION_NAMES[SCRIPT_FUNCTION_ONINPUT_BATCH]);
+                    result = INPUT_RESULT_UNKNOWN_ERROR;
+                }
+
+                lua_pop(L, nretval);
+            }
+        }
+
+        lua_pushnil(L);
+        dmScript::SetInstance(L);
+
+        assert(top == lua_gettop(L));
+        return result;
+    }
+
     void CompScriptOnReload(const ComponentOnReloadParams& params)
     {
         HScriptInstance script_instance = (HScriptInstance)*params.m_UserData;
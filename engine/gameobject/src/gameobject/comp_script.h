@@ -40,6 +40,8 @@ namespace dmGameObject
 
     InputResult CompScriptOnInput(const ComponentOnInputParams& params);
 
+    InputResult CompScriptOnInputBatch(const ComponentOnInputBatchParams& params);
+
     void CompScriptOnReload(const ComponentOnReloadParams& params);
 
     PropertyResult CompScriptSetProperties(const ComponentSetPropertiesParams& params);
@@ -115,8 +115,10 @@ void ComponentTypeSetRenderFn(HComponentType type, ComponentsRender fn)
 void ComponentTypeSetUpdateFn(HComponentType type, ComponentsUpdate fn)                     { type->m_UpdateFunction = fn; }
 void ComponentTypeSetFixedUpdateFn(HComponentType type, ComponentsFixedUpdate fn)           { type->m_FixedUpdateFunction = fn; }
 void ComponentTypeSetPostUpdateFn(HComponentType type, ComponentsPostUpdate fn)             { type->m_PostUpdateFunction = fn; }
+void ComponentTypeSetHashStateFn(HComponentType type, ComponentsHashState fn)              { type->m_HashStateFunction = fn; }
 void ComponentTypeSetOnMessageFn(HComponentType type, ComponentOnMessage fn)                { type->m_OnMessageFunction = fn; }
 void ComponentTypeSetOnInputFn(HComponentType type, ComponentOnInput fn)                    { type->m_OnInputFunction = fn; }
+void ComponentTypeSetOnInputBatchFn(HComponentType type, ComponentOnInputBatch fn)          { type->m_OnInputBatchFunction = fn; }
 void ComponentTypeSetOnReloadFn(HComponentType type, ComponentOnReload fn)                  { type->m_OnReloadFunction = fn; }
 void ComponentTypeSetSetPropertiesFn(HComponentType type, ComponentSetProperties fn)        { type->m_SetPropertiesFunction = fn; }
 void ComponentTypeSetGetPropertyFn(HComponentType type, ComponentGetProperty fn)            { type->m_GetPropertyFunction = fn; }
@@ -45,8 +45,10 @@ namespace dmGameObject
         ComponentsFixedUpdate   m_FixedUpdateFunction;
         ComponentsRender        m_RenderFunction;
         ComponentsPostUpdate    m_PostUpdateFunction;
+        ComponentsHashState     m_HashStateFunction;
         ComponentOnMessage      m_OnMessageFunction;
         ComponentOnInput        m_OnInputFunction;
+        ComponentOnInputBatch   m_OnInputBatchFunction;
         ComponentOnReload       m_OnReloadFunction;
         ComponentSetProperties  m_SetPropertiesFunction;
         ComponentGetProperty    m_GetPropertyFunction;
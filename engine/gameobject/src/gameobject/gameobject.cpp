@@ -15,6 +15,8 @@
 #include <new>
 #include <algorithm>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <dlib/dstrings.h>
 #include <dlib/log.h>
 #include <dlib/hashtable.h>
@@ -26,6 +28,7 @@
 #include <dlib/math.h>
 #include <dlib/vmath.h>
 #include <dlib/mutex.h>
+#include <dlib/time.h>
 #include <ddf/ddf.h>
 #include "gameobject.h"
 #include "gameobject_script.h"
@@ -33,6 +36,7 @@
 #include "gameobject_props_lua.h"
 #include "gameobject_props_ddf.h"
 #include "gameobject_props.h"
+#include "gameobject_transform_batch.h"
 
 #include "gameobject/gameobject_ddf.h"
 
@@ -183,11 +187,21 @@ namespace dmGameObject
         m_ComponentTypeCount = 0;
         m_DefaultCollectionCapacity = DEFAULT_MAX_COLLECTION_CAPACITY;
         m_DefaultInputStackCapacity = DEFAULT_MAX_INPUT_STACK_CAPACITY;
+        m_JobThread = 0;
+        m_SceneProfileEnabled = false;
+        m_InputBatchDispatch = false;
+        m_Deterministic = false;
         m_Mutex = dmMutex::New();
     }
 
+    static void FreeScriptProfileEntry(void*, const dmhash_t*, ScriptProfileEntry* entry)
+    {
+        free(entry->m_Filename);
+    }
+
     Register::~Register()
     {
+        m_ScriptProfile.Iterate(FreeScriptProfileEntry, (void*) 0);
         dmMutex::Delete(m_Mutex);
     }
 
@@ -216,7 +230,7 @@ namespace dmGameObject
         m_InstanceIndices.SetCapacity(max_instances);
         m_WorldTransforms.SetCapacity(max_instances);
         m_WorldTransforms.SetSize(max_instances);
-        m_IDToInstance.SetCapacity(dmMath::Max(1U, max_instances/3), max_instances);
+        m_IDToInstance.SetCapacity(max_instances);
         m_InputFocusStack.SetCapacity(max_input_stack_entries);
         m_NameHash = 0;
         m_ComponentSocket = 0;
@@ -234,6 +248,10 @@ namespace dmGameObject
         m_Initialized = 0;
         m_FixedAccumTime = 0.0f;
         m_FirstUpdate = 1;
+        m_ProfileStats = 0;
+        m_SlicedCursor = 0;
+        m_SlicedInit = 0;
+        m_SlicedFinal = 0;
 
         m_InstancesToDeleteHead = INVALID_INSTANCE_INDEX;
         m_InstancesToDeleteTail = INVALID_INSTANCE_INDEX;
@@ -261,6 +279,12 @@ namespace dmGameObject
         return regist->m_DefaultCollectionCapacity;
     }
 
+    void SetJobThread(HRegister regist, dmJobThread::HContext job_thread)
+    {
+        assert(regist != 0x0);
+        regist->m_JobThread = job_thread;
+    }
+
     void SetInputStackDefaultCapacity(HRegister regist, uint32_t capacity)
     {
         assert(regist != 0x0);
@@ -368,6 +392,13 @@ namespace dmGameObject
         Collection* collection = new Collection(0, 0, max_instances, GetInputStackDefaultCapacity(regist));
         collection->m_Mutex = dmMutex::New();
 
+        // The seed only depends on the name, so that the collection gets the same seed on every client
+        uint32_t random_seed = 0;
+        if (regist->m_Deterministic)
+        {
+            random_seed = dmMath::Max(1u, dmHashString32(name));
+        }
+
         for (uint32_t i = 0; i < regist->m_ComponentTypeCount; ++i)
         {
             if (regist->m_ComponentTypes[i].m_NewWorldFunction)
@@ -378,6 +409,7 @@ namespace dmGameObject
                 params.m_MaxComponentInstances = GetMaxComponentInstances(regist->m_ComponentTypes[i].m_NameHash, collection_desc);
                 params.m_MaxInstances = max_instances;
                 params.m_World = &collection->m_ComponentWorlds[i];
+                params.m_RandomSeed = random_seed;
                 regist->m_ComponentTypes[i].m_NewWorldFunction(params);
             }
         }
@@ -400,6 +432,7 @@ namespace dmGameObject
             if (regist->m_ComponentTypes[i].m_DeleteWorldFunction)
                 regist->m_ComponentTypes[i].m_DeleteWorldFunction(params);
         }
+        free(collection->m_ProfileStats);
         dmMutex::Delete(collection->m_Mutex);
         delete collection;
     }
@@ -632,7 +665,13 @@ namespace dmGameObject
 
         bool operator ()(const uint16_t& a, const uint16_t& b) const
         {
-            return m_Register->m_ComponentTypes[a].m_UpdateOrderPrio < m_Register->m_ComponentTypes[b].m_UpdateOrderPrio;
+            uint16_t prio_a = m_Register->m_ComponentTypes[a].m_UpdateOrderPrio;
+            uint16_t prio_b = m_Register->m_ComponentTypes[b].m_UpdateOrderPrio;
+            // Types with the same priority keep their registration order, so that the update order
+            // doesn't depend on the std::sort implementation of the platform
+            if (prio_a != prio_b)
+                return prio_a < prio_b;
+            return a < b;
         }
     };
 
@@ -688,12 +727,12 @@ namespace dmGameObject
          * Remove instance from m_LevelIndices using an erase-swap operation
          */
 
-        dmArray<uint16_t>& level = collection->m_LevelIndices[instance->m_Depth];
+        dmArray<InstanceIndex>& level = collection->m_LevelIndices[instance->m_Depth];
         assert(level.Size() > 0);
         assert(instance->m_LevelIndex < level.Size());
 
-        uint16_t level_index = instance->m_LevelIndex;
-        uint16_t swap_in_index = level.EraseSwap(level_index);
+        InstanceIndex level_index = instance->m_LevelIndex;
+        InstanceIndex swap_in_index = level.EraseSwap(level_index);
         HInstance swap_in_instance = collection->m_Instances[swap_in_index];
         assert(swap_in_instance->m_Index == swap_in_index);
         swap_in_instance->m_LevelIndex = level_index;
@@ -705,7 +744,7 @@ namespace dmGameObject
      * ** 10 elements as min
      * ** Up to max_instances as max
      */
-    static void ExpandLevel(dmArray<uint16_t>& level, uint32_t max_instances)
+    static void ExpandLevel(dmArray<InstanceIndex>& level, uint32_t max_instances)
     {
         const uint32_t min_offset = 10;
         const uint32_t max_offset = max_instances - level.Capacity();
@@ -718,18 +757,18 @@ namespace dmGameObject
         /*
          * Insert instance in m_LevelIndices at level set in instance->m_Depth
          */
-        dmArray<uint16_t>& level = collection->m_LevelIndices[instance->m_Depth];
+        dmArray<InstanceIndex>& level = collection->m_LevelIndices[instance->m_Depth];
         if (level.Full())
             ExpandLevel(level, collection->m_MaxInstances);
         assert(!level.Full());
 
-        uint16_t level_index = (uint16_t)level.Size();
+        InstanceIndex level_index = (InstanceIndex)level.Size();
         level.SetSize(level_index + 1);
         level[level_index] = instance->m_Index;
         instance->m_LevelIndex = level_index;
     }
 
-    static HInstance AllocInstance(Prototype* proto, const char* prototype_name) {
+    static uint32_t CountComponentInstanceUserData(Prototype* proto, const char* prototype_name) {
         // Count number of component userdata fields required
         uint32_t component_instance_userdata_count = 0;
         for (uint32_t i = 0; i < proto->m_ComponentCount; ++i)
@@ -744,36 +783,142 @@ namespace dmGameObject
             if (component_type->m_InstanceHasUserData)
                 component_instance_userdata_count++;
         }
+        return component_instance_userdata_count;
+    }
+
+    struct InstancePool
+    {
+        dmResource::HFactory    m_Factory;
+        Prototype*              m_Prototype;
+        // Free instance memory blocks, each sized for m_ComponentInstanceUserDataCount
+        dmArray<void*>          m_Free;
+        uint32_t                m_ComponentInstanceUserDataCount;
+        // Number of instances from the pool that are alive
+        uint32_t                m_LiveCount;
+        uint32_t                m_Deleted : 1;
+    };
 
+    static inline uint32_t InstanceMemorySize(uint32_t component_instance_userdata_count) {
         uint32_t component_userdata_size = sizeof(((Instance*)0)->m_ComponentInstanceUserData[0]);
+        return sizeof(Instance) + component_instance_userdata_count * component_userdata_size;
+    }
+
+    static void FreeInstancePool(InstancePool* pool) {
+        for (uint32_t i = 0; i < pool->m_Free.Size(); ++i)
+            operator delete (pool->m_Free[i]);
+        dmResource::Release(pool->m_Factory, pool->m_Prototype);
+        delete pool;
+    }
+
+    static HInstance AllocInstance(Prototype* proto, InstancePool* pool, uint32_t component_instance_userdata_count) {
         // NOTE: Allocate actual Instance with *all* component instance user-data accounted
-        void* instance_memory = ::operator new (sizeof(Instance) + component_instance_userdata_count * component_userdata_size);
+        void* instance_memory;
+        // The count only differs from the pool's if the prototype was hot reloaded
+        if (pool && !pool->m_Free.Empty() && pool->m_ComponentInstanceUserDataCount == component_instance_userdata_count)
+        {
+            instance_memory = pool->m_Free.Back();
+            pool->m_Free.Pop();
+        }
+        else
+        {
+            instance_memory = ::operator new (InstanceMemorySize(component_instance_userdata_count));
+        }
         Instance* instance = new(instance_memory) Instance(proto);
         instance->m_ComponentInstanceUserDataCount = component_instance_userdata_count;
+        if (pool)
+        {
+            instance->m_Pool = pool;
+            pool->m_LiveCount++;
+        }
         return instance;
     }
 
+    // Returns the instance memory to its pool, or frees it
+    static void FreeInstanceMemory(void* instance_memory, InstancePool* pool, uint32_t component_instance_userdata_count) {
+        if (!pool)
+        {
+            operator delete (instance_memory);
+            return;
+        }
+
+        assert(pool->m_LiveCount > 0);
+        pool->m_LiveCount--;
+        if (!pool->m_Deleted && !pool->m_Free.Full() && pool->m_ComponentInstanceUserDataCount == component_instance_userdata_count)
+        {
+            pool->m_Free.Push(instance_memory);
+        }
+        else
+        {
+            operator delete (instance_memory);
+        }
+
+        if (pool->m_Deleted && pool->m_LiveCount == 0)
+            FreeInstancePool(pool);
+    }
+
     static void DeallocInstance(HInstance instance) {
         instance->~Instance();
         void* instance_memory = (void*) instance;
+        InstancePool* pool = instance->m_Pool;
+        uint32_t component_instance_userdata_count = instance->m_ComponentInstanceUserDataCount;
 
         // This is required for failing test
         // TODO: #ifdef on something...?
         // Clear all memory excluding ComponentInstanceUserData
         memset(instance_memory, 0xcc, sizeof(Instance));
-        operator delete (instance_memory);
+        FreeInstanceMemory(instance_memory, pool, component_instance_userdata_count);
+    }
+
+    HInstancePool NewInstancePool(dmResource::HFactory factory, HPrototype prototype, const char* prototype_name, uint32_t preallocate, uint32_t max_size) {
+        InstancePool* pool = new InstancePool;
+        pool->m_Factory = factory;
+        pool->m_Prototype = prototype;
+        pool->m_ComponentInstanceUserDataCount = CountComponentInstanceUserData(prototype, prototype_name);
+        pool->m_LiveCount = 0;
+        pool->m_Deleted = 0;
+        dmResource::IncRef(factory, prototype);
+
+        pool->m_Free.SetCapacity(max_size);
+        preallocate = dmMath::Min(preallocate, max_size);
+        uint32_t size = InstanceMemorySize(pool->m_ComponentInstanceUserDataCount);
+        for (uint32_t i = 0; i < preallocate; ++i)
+        {
+            pool->m_Free.Push(::operator new (size));
+        }
+        return pool;
     }
 
-    HInstance NewInstance(Collection* collection, Prototype* proto, const char* prototype_name) {
+    void DeleteInstancePool(HInstancePool pool) {
+        if (pool->m_LiveCount == 0)
+        {
+            FreeInstancePool(pool);
+            return;
+        }
+        // The live instances still rely on the prototype reference
+        for (uint32_t i = 0; i < pool->m_Free.Size(); ++i)
+            operator delete (pool->m_Free[i]);
+        pool->m_Free.SetSize(0);
+        pool->m_Deleted = 1;
+    }
+
+    HPrototype GetInstancePoolPrototype(HInstancePool pool) {
+        return pool->m_Prototype;
+    }
+
+    uint32_t GetInstancePoolFreeCount(HInstancePool pool) {
+        return pool->m_Free.Size();
+    }
+
+    static HInstance NewInstanceInternal(Collection* collection, Prototype* proto, InstancePool* pool, uint32_t component_instance_userdata_count) {
         if (collection->m_InstanceIndices.Remaining() == 0)
         {
             dmLogError("The game object instance could not be created since the buffer is full (%d). Increase the capacity with collection.max_instances", collection->m_InstanceIndices.Capacity());
             return 0;
         }
-        HInstance instance = AllocInstance(proto, prototype_name);
+        HInstance instance = AllocInstance(proto, pool, component_instance_userdata_count);
         instance->m_Collection = collection;
         instance->m_ScaleAlongZ = collection->m_ScaleAlongZ;
-        uint16_t instance_index = collection->m_InstanceIndices.Pop();
+        InstanceIndex instance_index = collection->m_InstanceIndices.Pop();
         instance->m_Index = instance_index;
         assert(collection->m_Instances[instance_index] == 0);
         collection->m_Instances[instance_index] = instance;
@@ -783,12 +928,16 @@ namespace dmGameObject
         return instance;
     }
 
+    HInstance NewInstance(Collection* collection, Prototype* proto, const char* prototype_name) {
+        return NewInstanceInternal(collection, proto, 0, CountComponentInstanceUserData(proto, prototype_name));
+    }
+
     HInstance NewInstance(HCollection hcollection, Prototype* proto, const char* prototype_name){
         return NewInstance(hcollection->m_Collection, proto, prototype_name);
     }
 
     void UndoNewInstance(Collection* collection, HInstance instance) {
-        if (instance->m_Prototype != &EMPTY_PROTOTYPE) {
+        if (instance->m_Prototype != &EMPTY_PROTOTYPE && !instance->m_Pool) {
             dmResource::Release(collection->m_Factory, instance->m_Prototype);
         }
         EraseSwapLevelIndex(collection, instance);
@@ -798,8 +947,8 @@ namespace dmGameObject
             Unlink(collection, instance);
         }
 
-        uint16_t instance_index = instance->m_Index;
-        operator delete ((void*)instance);
+        InstanceIndex instance_index = instance->m_Index;
+        FreeInstanceMemory((void*)instance, instance->m_Pool, instance->m_ComponentInstanceUserDataCount);
         collection->m_Instances[instance_index] = 0x0;
         collection->m_InstanceIndices.Push(instance_index);
         assert(collection->m_IDToInstance.Size() <= collection->m_InstanceIndices.Size());
@@ -809,6 +958,56 @@ namespace dmGameObject
         UndoNewInstance(hcollection->m_Collection, instance);
     }
 
+    static CreateResult CreateComponent(Collection* collection, HInstance instance, uint32_t component_index, uintptr_t* component_instance_data)
+    {
+        Prototype::Component* component = &instance->m_Prototype->m_Components[component_index];
+        ComponentType* component_type = component->m_Type;
+        assert(component_type);
+
+        if (component_instance_data)
+            *component_instance_data = 0;
+
+        ComponentCreateParams params;
+        params.m_Instance = instance;
+        params.m_Position = component->m_Position;
+        params.m_Rotation = component->m_Rotation;
+        params.m_Scale = component->m_Scale;
+        params.m_ComponentIndex = component_index;
+        params.m_Resource = component->m_Resource;
+        params.m_World = collection->m_ComponentWorlds[component->m_TypeIndex];
+        params.m_Context = component_type->m_Context;
+        params.m_UserData = component_instance_data;
+        params.m_PropertySet = component->m_PropertySet;
+        return component_type->m_CreateFunction(params);
+    }
+
+    // Destroys the first 'components_created' components of an instance whose creation failed
+    static void DestroyCreatedComponents(Collection* collection, HInstance instance, uint32_t components_created)
+    {
+        Prototype* proto = instance->m_Prototype;
+        uint32_t next_component_instance_data = 0;
+        for (uint32_t i = 0; i < components_created; ++i)
+        {
+            Prototype::Component* component = &proto->m_Components[i];
+            ComponentType* component_type = component->m_Type;
+            assert(component_type);
+            uintptr_t* component_instance_data = 0;
+            if (component_type->m_InstanceHasUserData)
+            {
+                component_instance_data = &instance->m_ComponentInstanceUserData[next_component_instance_data++];
+            }
+            assert(next_component_instance_data <= instance->m_ComponentInstanceUserDataCount);
+
+            ComponentDestroyParams params;
+            params.m_Collection = collection->m_HCollection;
+            params.m_Instance = instance;
+            params.m_World = collection->m_ComponentWorlds[component->m_TypeIndex];
+            params.m_Context = component_type->m_Context;
+            params.m_UserData = component_instance_data;
+            component_type->m_DestroyFunction(params);
+        }
+    }
+
     bool CreateComponents(Collection* collection, HInstance instance) {
         DM_PROFILE("CreateComponents");
 
@@ -822,8 +1021,7 @@ namespace dmGameObject
         }
         for (uint32_t i = 0; i < proto->m_ComponentCount; ++i)
         {
-            Prototype::Component* component = &proto->m_Components[i];
-            ComponentType* component_type = component->m_Type;
+            ComponentType* component_type = proto->m_Components[i].m_Type;
             assert(component_type);
 
             DM_PROFILE_DYN(component_type->m_Name, 0);
@@ -832,22 +1030,10 @@ namespace dmGameObject
             if (component_type->m_InstanceHasUserData)
             {
                 component_instance_data = &instance->m_ComponentInstanceUserData[next_component_instance_data++];
-                *component_instance_data = 0;
             }
             assert(next_component_instance_data <= instance->m_ComponentInstanceUserDataCount);
 
-            ComponentCreateParams params;
-            params.m_Instance = instance;
-            params.m_Position = component->m_Position;
-            params.m_Rotation = component->m_Rotation;
-            params.m_Scale = component->m_Scale;
-            params.m_ComponentIndex = i;
-            params.m_Resource = component->m_Resource;
-            params.m_World = collection->m_ComponentWorlds[component->m_TypeIndex];
-            params.m_Context = component_type->m_Context;
-            params.m_UserData = component_instance_data;
-            params.m_PropertySet = component->m_PropertySet;
-            CreateResult create_result =  component_type->m_CreateFunction(params);
+            CreateResult create_result = CreateComponent(collection, instance, i, component_instance_data);
             if (create_result == CREATE_RESULT_OK)
             {
                 components_created++;
@@ -861,27 +1047,7 @@ namespace dmGameObject
 
         if (!ok)
         {
-            uint32_t next_component_instance_data = 0;
-            for (uint32_t i = 0; i < components_created; ++i)
-            {
-                Prototype::Component* component = &proto->m_Components[i];
-                ComponentType* component_type = component->m_Type;
-                assert(component_type);
-                uintptr_t* component_instance_data = 0;
-                if (component_type->m_InstanceHasUserData)
-                {
-                    component_instance_data = &instance->m_ComponentInstanceUserData[next_component_instance_data++];
-                }
-                assert(next_component_instance_data <= instance->m_ComponentInstanceUserDataCount);
-
-                ComponentDestroyParams params;
-                params.m_Collection = collection->m_HCollection;
-                params.m_Instance = instance;
-                params.m_World = collection->m_ComponentWorlds[component->m_TypeIndex];
-                params.m_Context = component_type->m_Context;
-                params.m_UserData = component_instance_data;
-                component_type->m_DestroyFunction(params);
-            }
+            DestroyCreatedComponents(collection, instance, components_created);
         }
 
         return ok;
@@ -977,6 +1143,20 @@ namespace dmGameObject
         return index;
     }
 
+    uint32_t AcquireInstanceIndices(HCollection hcollection, uint32_t count, uint32_t* out_indices)
+    {
+        Collection* collection = hcollection->m_Collection;
+        dmMutex::Lock(collection->m_Mutex);
+        uint32_t acquired = dmMath::Min(count, collection->m_InstanceIdPool.Remaining());
+        for (uint32_t i = 0; i < acquired; ++i)
+        {
+            out_indices[i] = collection->m_InstanceIdPool.Pop();
+        }
+        dmMutex::Unlock(collection->m_Mutex);
+
+        return acquired;
+    }
+
     void ReleaseInstanceIndex(uint32_t index, Collection* collection)
     {
         dmMutex::Lock(collection->m_Mutex);
@@ -1045,8 +1225,8 @@ namespace dmGameObject
             return;
         }
         instance->m_ToBeAdded = 1;
-        uint16_t index = instance->m_Index;
-        uint16_t tail = collection->m_InstancesToAddTail;
+        InstanceIndex index = instance->m_Index;
+        InstanceIndex tail = collection->m_InstancesToAddTail;
         if (tail != INVALID_INSTANCE_INDEX) {
             HInstance tail_instance = collection->m_Instances[tail];
             tail_instance->m_NextToAdd = index;
@@ -1106,7 +1286,7 @@ namespace dmGameObject
             dmLogError("Instances can not be added to update during the update.");
             return false;
         }
-        uint16_t index = collection->m_InstancesToAddHead;
+        InstanceIndex index = collection->m_InstancesToAddHead;
         bool result = true;
         while (index != INVALID_INSTANCE_INDEX) {
             HInstance instance = collection->m_Instances[index];
@@ -1160,19 +1340,21 @@ namespace dmGameObject
     }
 
     // Supplied 'proto' will be released after this function is done.
-    static HInstance SpawnInternal(Collection* collection, Prototype *proto, const char *prototype_name, dmhash_t id, HPropertyContainer property_container, const Point3& position, const Quat& rotation, const Vector3& scale)
+    static HInstance SpawnInternal(Collection* collection, Prototype *proto, InstancePool* pool, const char *prototype_name, dmhash_t id, HPropertyContainer property_container, const Point3& position, const Quat& rotation, const Vector3& scale)
     {
         if (collection->m_ToBeDeleted) {
             dmLogWarning("Spawning is not allowed when the collection is being deleted.");
             return 0;
         }
 
-        HInstance instance = dmGameObject::NewInstance(collection, proto, prototype_name);
+        HInstance instance = NewInstanceInternal(collection, proto, pool, CountComponentInstanceUserData(proto, prototype_name));
         if (instance == 0) {
             return 0;
         }
 
-        dmResource::IncRef(collection->m_Factory, proto);
+        // The pool holds the prototype reference for its instances
+        if (!pool)
+            dmResource::IncRef(collection->m_Factory, proto);
 
         SetPosition(instance, position);
         SetRotation(instance, rotation);
@@ -1317,7 +1499,7 @@ namespace dmGameObject
 
 
     // Returns if successful or not
-    static bool CollectionSpawnFromDescInternal(Collection* collection, dmGameObjectDDF::CollectionDesc* collection_desc, InstancePropertyBuffers *property_buffers, InstanceIdMap *id_mapping, dmTransform::Transform const &transform)
+    static bool CollectionSpawnFromDescInternal(Collection* collection, dmGameObjectDDF::CollectionDesc* collection_desc, InstancePropertyBuffers *property_buffers, InstanceIdMap *id_mapping, dmTransform::Transform const &transform, InstancePool** pools)
     {
         // Path prefix for collection objects
         char root_path[32];
@@ -1341,7 +1523,16 @@ namespace dmGameObject
             dmResource::HFactory factory = collection->m_Factory;
             dmGameObject::HInstance instance = 0x0;
 
-            if (instance_desc.m_Prototype)
+            InstancePool* pool = pools ? pools[i] : 0;
+            if (pool)
+            {
+                instance = NewInstanceInternal(collection, pool->m_Prototype, pool, pool->m_ComponentInstanceUserDataCount);
+                if (instance == 0) {
+                    success = false;
+                    break;
+                }
+            }
+            else if (instance_desc.m_Prototype)
             {
                 dmResource::Result error = dmResource::Get(factory, instance_desc.m_Prototype, (void**)&proto);
                 if (error == dmResource::RESULT_OK) {
@@ -1626,13 +1817,20 @@ namespace dmGameObject
     bool SpawnFromCollection(HCollection hcollection, HCollectionDesc collection_desc, InstancePropertyBuffers *property_buffers,
                              const Point3& position, const Quat& rotation, const Vector3& scale,
                              InstanceIdMap *instances)
+    {
+        return SpawnFromCollection(hcollection, collection_desc, property_buffers, position, rotation, scale, instances, 0);
+    }
+
+    bool SpawnFromCollection(HCollection hcollection, HCollectionDesc collection_desc, InstancePropertyBuffers *property_buffers,
+                             const Point3& position, const Quat& rotation, const Vector3& scale,
+                             InstanceIdMap *instances, HInstancePool* pools)
     {
         dmTransform::Transform transform;
         transform.SetTranslation(Vector3(position));
         transform.SetRotation(rotation);
         transform.SetScale(scale);
 
-        bool success = CollectionSpawnFromDescInternal(hcollection->m_Collection, (dmGameObjectDDF::CollectionDesc*)collection_desc, property_buffers, instances, transform);
+        bool success = CollectionSpawnFromDescInternal(hcollection->m_Collection, (dmGameObjectDDF::CollectionDesc*)collection_desc, property_buffers, instances, transform, pools);
 
         return success;
     }
@@ -1644,7 +1842,19 @@ namespace dmGameObject
             return 0x0;
         }
 
-        HInstance instance = SpawnInternal(hcollection->m_Collection, proto, prototype_name, id, property_container, position, rotation, scale);
+        HInstance instance = SpawnInternal(hcollection->m_Collection, proto, 0, prototype_name, id, property_container, position, rotation, scale);
+
+        if (instance == 0) {
+            dmLogError("Could not spawn an instance of prototype %s.", prototype_name);
+        }
+
+        return instance;
+    }
+
+    HInstance SpawnFromPool(HCollection hcollection, HInstancePool pool, const char* prototype_name, dmhash_t id, HPropertyContainer property_container, const Point3& position, const Quat& rotation, const Vector3& scale)
+    {
+        assert(!pool->m_Deleted);
+        HInstance instance = SpawnInternal(hcollection->m_Collection, pool->m_Prototype, pool, prototype_name, id, property_container, position, rotation, scale);
 
         if (instance == 0) {
             dmLogError("Could not spawn an instance of prototype %s.", prototype_name);
@@ -1653,6 +1863,144 @@ namespace dmGameObject
         return instance;
     }
 
+    static uint32_t SpawnBatchInternal(HCollection hcollection, HPrototype proto, InstancePool* pool, const char* prototype_name, uint32_t count, const dmhash_t* ids,
+                                       HPropertyContainer property_container, const Point3* positions, const Quat* rotations, const Vector3* scales,
+                                       HInstance* out_instances)
+    {
+        DM_PROFILE("SpawnBatch");
+
+        memset(out_instances, 0, sizeof(HInstance) * count);
+
+        if (proto == 0x0) {
+            dmLogError("No prototype to spawn from.");
+            return 0;
+        }
+
+        Collection* collection = hcollection->m_Collection;
+        if (collection->m_ToBeDeleted) {
+            dmLogWarning("Spawning is not allowed when the collection is being deleted.");
+            return 0;
+        }
+
+        if (proto->m_ComponentCount > 0xFFFF ) {
+            dmLogWarning("Too many components in game object: %u (max is 65536)", proto->m_ComponentCount);
+            return 0;
+        }
+
+        uint32_t remaining = collection->m_InstanceIndices.Remaining();
+        if (remaining < count)
+        {
+            dmLogError("Only %u of %u game object instances could be created since the buffer is full (%d). Increase the capacity with collection.max_instances", remaining, count, collection->m_InstanceIndices.Capacity());
+            count = remaining;
+        }
+
+        // Grow the root level once for the whole batch
+        dmArray<InstanceIndex>& root_level = collection->m_LevelIndices[0];
+        if (root_level.Remaining() < count)
+            root_level.OffsetCapacity(count - root_level.Remaining());
+
+        uint32_t component_instance_userdata_count = CountComponentInstanceUserData(proto, prototype_name);
+
+        uint32_t created = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            HInstance instance = NewInstanceInternal(collection, proto, pool, component_instance_userdata_count);
+            assert(instance != 0);
+            if (!pool)
+                dmResource::IncRef(collection->m_Factory, proto);
+
+            SetPosition(instance, positions[i]);
+            SetRotation(instance, rotations[i]);
+            SetScale(instance, scales[i]);
+            collection->m_WorldTransforms[instance->m_Index] = dmTransform::ToMatrix4(instance->m_Transform);
+
+            dmHashInit64(&instance->m_CollectionPathHashState, true);
+            dmHashUpdateBuffer64(&instance->m_CollectionPathHashState, ID_SEPARATOR, strlen(ID_SEPARATOR));
+
+            if (SetIdentifier(collection, instance, ids[i]) == RESULT_IDENTIFIER_IN_USE)
+            {
+                dmLogError("The identifier '%s' is already in use.", dmHashReverseSafe64(ids[i]));
+                UndoNewInstance(collection, instance);
+                continue;
+            }
+            out_instances[i] = instance;
+            ++created;
+        }
+
+        // Create the components one prototype component at a time, so that each component world
+        // receives all of its create calls for the batch in one go
+        uint32_t next_component_instance_data = 0;
+        for (uint32_t c = 0; c < proto->m_ComponentCount && created > 0; ++c)
+        {
+            ComponentType* component_type = proto->m_Components[c].m_Type;
+            DM_PROFILE_DYN(component_type->m_Name, 0);
+
+            uint32_t userdata_index = next_component_instance_data;
+            if (component_type->m_InstanceHasUserData)
+                next_component_instance_data++;
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                HInstance instance = out_instances[i];
+                if (!instance)
+                    continue;
+
+                uintptr_t* component_instance_data = component_type->m_InstanceHasUserData ? &instance->m_ComponentInstanceUserData[userdata_index] : 0;
+                if (CreateComponent(collection, instance, c, component_instance_data) != CREATE_RESULT_OK)
+                {
+                    DestroyCreatedComponents(collection, instance, c);
+                    ReleaseIdentifier(collection, instance);
+                    UndoNewInstance(collection, instance);
+                    out_instances[i] = 0;
+                    --created;
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            HInstance instance = out_instances[i];
+            if (!instance)
+                continue;
+
+            bool success = SetScriptPropertiesFromBuffer(instance, prototype_name, property_container);
+            if (success && !InitInstance(collection, instance))
+            {
+                dmLogError("Could not initialize when spawning %s.", prototype_name);
+                success = false;
+            }
+
+            if (success) {
+                AddToUpdate(collection, instance);
+            } else {
+                Delete(collection, instance, false);
+                out_instances[i] = 0;
+                --created;
+            }
+        }
+
+        if (created != count) {
+            dmLogError("Could not spawn %u of %u instances of prototype %s.", count - created, count, prototype_name);
+        }
+
+        return created;
+    }
+
+    uint32_t SpawnBatch(HCollection hcollection, HPrototype proto, const char* prototype_name, uint32_t count, const dmhash_t* ids,
+                        HPropertyContainer property_container, const Point3* positions, const Quat* rotations, const Vector3* scales,
+                        HInstance* out_instances)
+    {
+        return SpawnBatchInternal(hcollection, proto, 0, prototype_name, count, ids, property_container, positions, rotations, scales, out_instances);
+    }
+
+    uint32_t SpawnBatchFromPool(HCollection hcollection, HInstancePool pool, const char* prototype_name, uint32_t count, const dmhash_t* ids,
+                                HPropertyContainer property_container, const Point3* positions, const Quat* rotations, const Vector3* scales,
+                                HInstance* out_instances)
+    {
+        assert(!pool->m_Deleted);
+        return SpawnBatchInternal(hcollection, pool->m_Prototype, pool, prototype_name, count, ids, property_container, positions, rotations, scales, out_instances);
+    }
+
     static void MoveDown(Collection* collection, Instance* instance)
     {
         /*
@@ -1800,7 +2148,83 @@ namespace dmGameObject
 
     bool Init(HCollection hcollection)
     {
-        return InitCollection(hcollection->m_Collection);
+        Collection* collection = hcollection->m_Collection;
+        collection->m_SlicedInit = 0;
+        collection->m_SlicedOrder.SetSize(0);
+        return InitCollection(collection);
+    }
+
+    // Stores the live instances in hierarchy order, roots first
+    static void BuildSlicedOrder(Collection* collection)
+    {
+        dmArray<InstanceIndex>& order = collection->m_SlicedOrder;
+        order.SetSize(0);
+        uint32_t count = collection->m_InstanceIndices.Size();
+        if (order.Capacity() < count)
+        {
+            order.SetCapacity(count);
+        }
+        for (uint32_t level = 0; level < MAX_HIERARCHICAL_DEPTH; ++level)
+        {
+            const dmArray<InstanceIndex>& level_indices = collection->m_LevelIndices[level];
+            uint32_t level_count = level_indices.Size();
+            if (level_count == 0)
+                break;
+            for (uint32_t i = 0; i < level_count && !order.Full(); ++i)
+            {
+                order.Push(level_indices[i]);
+            }
+        }
+        collection->m_SlicedCursor = 0;
+    }
+
+    bool InitSliced(HCollection hcollection, uint32_t time_budget, bool* out_done)
+    {
+        DM_PROFILE("InitSliced");
+        Collection* collection = hcollection->m_Collection;
+        assert(collection->m_InUpdate == 0 && "Initializing instances during Update(.) is not permitted");
+
+        if (!collection->m_SlicedInit)
+        {
+            UpdateTransforms(collection);
+            BuildSlicedOrder(collection);
+            collection->m_SlicedInit = 1;
+        }
+
+        bool result = true;
+        uint64_t start = dmTime::GetTime();
+        dmArray<InstanceIndex>& order = collection->m_SlicedOrder;
+        while (collection->m_SlicedCursor < order.Size())
+        {
+            // The instances spawned by the init functions are already initialized
+            Instance* instance = collection->m_Instances[order[collection->m_SlicedCursor++]];
+            if (instance != 0x0 && !instance->m_Initialized && !instance->m_ToBeDeleted)
+            {
+                if (!InitInstance(collection, instance))
+                    result = false;
+                if (dmTime::GetTime() - start >= time_budget)
+                    break;
+            }
+        }
+
+        *out_done = collection->m_SlicedCursor == order.Size();
+        if (!*out_done)
+            return result;
+
+        for (uint32_t i = 0; i < order.Size(); ++i)
+        {
+            Instance* instance = collection->m_Instances[order[i]];
+            if (instance != 0x0 && !DoAddToUpdate(collection, instance))
+                result = false;
+        }
+        dmMessage::HSocket sockets[] = {collection->m_ComponentSocket, collection->m_FrameSocket};
+        if (!DispatchMessages(collection, sockets, 2))
+            result = false;
+
+        order.SetSize(0);
+        collection->m_SlicedInit = 0;
+        collection->m_Initialized = 1;
+        return result;
     }
 
     static bool FinalComponents(Collection* collection, HInstance instance)
@@ -1876,22 +2300,65 @@ namespace dmGameObject
 
     bool Final(HCollection hcollection)
     {
-        return FinalCollection(hcollection->m_Collection);
+        Collection* collection = hcollection->m_Collection;
+        collection->m_SlicedInit = 0;
+        collection->m_SlicedFinal = 0;
+        collection->m_SlicedOrder.SetSize(0);
+        return FinalCollection(collection);
     }
 
-    void Delete(Collection* collection, HInstance instance, bool recursive)
+    bool FinalSliced(HCollection hcollection, uint32_t time_budget, bool* out_done)
     {
-        assert(collection->m_Instances[instance->m_Index] == instance);
-        assert(instance->m_Collection == collection);
+        DM_PROFILE("FinalSliced");
+        Collection* collection = hcollection->m_Collection;
+        assert(collection->m_InUpdate == 0 && "Finalizing instances during Update(.) is not permitted");
 
-        // NOTE: Do not add for delete twice.
-        if (instance->m_ToBeDeleted)
-            return;
+        if (!collection->m_SlicedFinal)
+        {
+            BuildSlicedOrder(collection);
+            // Children before parents
+            collection->m_SlicedCursor = collection->m_SlicedOrder.Size();
+            collection->m_SlicedFinal = 1;
+        }
 
-        // NOTE: No point in deleting when the collection is being deleted
-        // Actually dangerous, since we can be anywhere in the sequential game object destruction
-        if (collection->m_ToBeDeleted)
-            return;
+        bool result = true;
+        uint64_t start = dmTime::GetTime();
+        dmArray<InstanceIndex>& order = collection->m_SlicedOrder;
+        while (collection->m_SlicedCursor > 0)
+        {
+            Instance* instance = collection->m_Instances[order[--collection->m_SlicedCursor]];
+            if (instance != 0x0 && instance->m_Initialized)
+            {
+                if (!FinalInstance(collection, instance))
+                    result = false;
+                if (dmTime::GetTime() - start >= time_budget)
+                    break;
+            }
+        }
+
+        *out_done = collection->m_SlicedCursor == 0;
+        if (*out_done)
+        {
+            order.SetSize(0);
+            collection->m_SlicedFinal = 0;
+            collection->m_Initialized = 0;
+        }
+        return result;
+    }
+
+    void Delete(Collection* collection, HInstance instance, bool recursive)
+    {
+        assert(collection->m_Instances[instance->m_Index] == instance);
+        assert(instance->m_Collection == collection);
+
+        // NOTE: Do not add for delete twice.
+        if (instance->m_ToBeDeleted)
+            return;
+
+        // NOTE: No point in deleting when the collection is being deleted
+        // Actually dangerous, since we can be anywhere in the sequential game object destruction
+        if (collection->m_ToBeDeleted)
+            return;
 
         // If recursive, Delete child hierarchy recursively, child to parent order (leaf first).
         if(recursive)
@@ -1909,8 +2376,8 @@ namespace dmGameObject
         // Delete instance
         instance->m_ToBeDeleted = 1;
 
-        uint16_t index = instance->m_Index;
-        uint16_t tail = collection->m_InstancesToDeleteTail;
+        InstanceIndex index = instance->m_Index;
+        InstanceIndex tail = collection->m_InstancesToDeleteTail;
         if (tail != INVALID_INSTANCE_INDEX) {
             HInstance tail_instance = collection->m_Instances[tail];
             tail_instance->m_NextToDelete = index;
@@ -1927,10 +2394,10 @@ namespace dmGameObject
 
     static void RemoveFromAddToUpdate(Collection* collection, HInstance instance)
     {
-        uint16_t index = instance->m_Index;
+        InstanceIndex index = instance->m_Index;
         assert(collection->m_InstancesToAddTail == index || instance->m_NextToAdd != INVALID_INSTANCE_INDEX);
-        uint16_t* prev_index_ptr = &collection->m_InstancesToAddHead;
-        uint16_t prev_index = *prev_index_ptr;
+        InstanceIndex* prev_index_ptr = &collection->m_InstancesToAddHead;
+        InstanceIndex prev_index = *prev_index_ptr;
         while (prev_index != index) {
             prev_index_ptr = &collection->m_Instances[prev_index]->m_NextToAdd;
             if (collection->m_InstancesToAddTail == *prev_index_ptr) {
@@ -1946,6 +2413,8 @@ namespace dmGameObject
         instance->m_ToBeAdded = 0;
     }
 
+    static void ClearInputFilter(Collection* collection, HInstance instance);
+
     static void DoDeleteInstance(Collection* collection, HInstance instance)
     {
         DM_PROFILE("DoDeleteInstance");
@@ -1981,7 +2450,7 @@ namespace dmGameObject
         EraseSwapLevelIndex(collection, instance);
         MoveAllUp(collection, instance);
 
-        if (prototype != &EMPTY_PROTOTYPE)
+        if (prototype != &EMPTY_PROTOTYPE && !instance->m_Pool)
             dmResource::Release(factory, prototype);
         collection->m_InstanceIndices.Push(instance->m_Index);
         collection->m_Instances[instance->m_Index] = 0;
@@ -2006,6 +2475,7 @@ namespace dmGameObject
         {
             collection->m_InputFocusStack.Pop();
         }
+        ClearInputFilter(collection, instance);
 
         DeallocInstance(instance);
 
@@ -2172,11 +2642,11 @@ namespace dmGameObject
         return instance->m_Bone;
     }
 
-    static uint32_t DoSetBoneTransforms(HCollection hcollection, dmTransform::Transform* component_transform, uint16_t first_index, dmTransform::Transform* transforms, uint32_t transform_count)
+    static uint32_t DoSetBoneTransforms(HCollection hcollection, dmTransform::Transform* component_transform, InstanceIndex first_index, dmTransform::Transform* transforms, uint32_t transform_count)
     {
         if (transform_count == 0)
             return 0;
-        uint16_t current_index = first_index;
+        InstanceIndex current_index = first_index;
         uint32_t count = 0;
         Collection* collection = hcollection->m_Collection;
         while (current_index != INVALID_INSTANCE_INDEX)
@@ -2207,8 +2677,8 @@ namespace dmGameObject
         return DoSetBoneTransforms(instance->m_Collection->m_HCollection, &component_transform, instance->m_Index, transforms, transform_count);
     }
 
-    static void DeleteBones(Collection* collection, uint16_t first_index) {
-        uint16_t current_index = first_index;
+    static void DeleteBones(Collection* collection, InstanceIndex first_index) {
+        InstanceIndex current_index = first_index;
         while (current_index != INVALID_INSTANCE_INDEX) {
             HInstance instance = collection->m_Instances[current_index];
             if (instance->m_Bone && instance->m_ToBeDeleted == 0) {
@@ -2224,6 +2694,210 @@ namespace dmGameObject
         return DeleteBones(parent->m_Collection, parent->m_FirstChildIndex);
     }
 
+    static const char* SCENE_PROFILE_FUNCTION_NAMES[SCENE_PROFILE_FUNCTION_COUNT] =
+    {
+        "update",
+        "fixed_update",
+        "post_update",
+        "render",
+        "on_message",
+    };
+
+    // Only the bytes used by the type are hashed, since the rest of the union isn't initialized
+    static uint64_t HashProperty(dmhash_t instance_id, dmhash_t property_id, const PropertyVar& var)
+    {
+        uint32_t size = 0;
+        switch (var.m_Type)
+        {
+            case PROPERTY_TYPE_NUMBER:  size = sizeof(var.m_Number); break;
+            case PROPERTY_TYPE_HASH:    size = sizeof(var.m_Hash); break;
+            case PROPERTY_TYPE_URL:     size = sizeof(dmMessage::URL); break;
+            case PROPERTY_TYPE_VECTOR3: size = sizeof(float) * 3; break;
+            case PROPERTY_TYPE_VECTOR4:
+            case PROPERTY_TYPE_QUAT:    size = sizeof(float) * 4; break;
+            case PROPERTY_TYPE_BOOLEAN: size = sizeof(var.m_Bool); break;
+            case PROPERTY_TYPE_MATRIX4: size = sizeof(var.m_M4); break;
+            default: break;
+        }
+
+        uint8_t buffer[sizeof(dmhash_t) * 2 + sizeof(uint32_t) + sizeof(var.m_M4)];
+        uint32_t type = (uint32_t)var.m_Type;
+        memcpy(buffer, &instance_id, sizeof(instance_id));
+        memcpy(buffer + sizeof(dmhash_t), &property_id, sizeof(property_id));
+        memcpy(buffer + sizeof(dmhash_t) * 2, &type, sizeof(type));
+        memcpy(buffer + sizeof(dmhash_t) * 2 + sizeof(uint32_t), &var.m_Number, size);
+        return dmHashBufferNoReverse64(buffer, sizeof(dmhash_t) * 2 + sizeof(uint32_t) + size);
+    }
+
+    uint64_t HashCollectionState(HCollection hcollection, const dmhash_t* component_ids, const dmhash_t* property_ids, uint32_t property_count)
+    {
+        DM_PROFILE("HashCollectionState");
+        Collection* collection = hcollection->m_Collection;
+
+        // The hashes of the instances and properties are summed, so that their order doesn't matter.
+        // They're not added to the reverse hash table, since there's one per instance and tick.
+        uint64_t hash = 0;
+
+        // The id and the local transform, without the padding of the vector types
+        struct InstanceState
+        {
+            dmhash_t m_Identifier;
+            float    m_Position[3];
+            float    m_Rotation[4];
+            float    m_Scale[3];
+        } state;
+
+        uint32_t n = collection->m_Instances.Size();
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            Instance* instance = collection->m_Instances[i];
+            if (instance == 0x0 || instance->m_ToBeDeleted)
+                continue;
+
+            state.m_Identifier = instance->m_Identifier;
+            memcpy(state.m_Position, instance->m_Transform.GetPositionPtr(), sizeof(state.m_Position));
+            memcpy(state.m_Rotation, instance->m_Transform.GetRotationPtr(), sizeof(state.m_Rotation));
+            memcpy(state.m_Scale, instance->m_Transform.GetScalePtr(), sizeof(state.m_Scale));
+            hash += dmHashBufferNoReverse64(&state, sizeof(state));
+
+            for (uint32_t p = 0; p < property_count; ++p)
+            {
+                PropertyDesc desc;
+                if (GetProperty(instance, component_ids[p], property_ids[p], PropertyOptions(), desc) == PROPERTY_RESULT_OK)
+                {
+                    hash += HashProperty(instance->m_Identifier, property_ids[p], desc.m_Variant);
+                }
+            }
+        }
+
+        // The component types are visited in the order of the register, which is the same on every client
+        HRegister regist = collection->m_Register;
+        for (uint32_t i = 0; i < regist->m_ComponentTypeCount; ++i)
+        {
+            ComponentType* type = &regist->m_ComponentTypes[i];
+            if (!type->m_HashStateFunction)
+                continue;
+
+            ComponentsHashStateParams params;
+            params.m_Collection = hcollection;
+            params.m_World = collection->m_ComponentWorlds[i];
+            params.m_Context = type->m_Context;
+            uint64_t world_hash[2] = { type->m_NameHash, type->m_HashStateFunction(params) };
+            hash += dmHashBufferNoReverse64(world_hash, sizeof(world_hash));
+        }
+        return hash;
+    }
+
+    const char* GetSceneProfileFunctionName(SceneProfileFunction function)
+    {
+        return SCENE_PROFILE_FUNCTION_NAMES[function];
+    }
+
+    void SetSceneProfileEnabled(HRegister regist, bool enabled)
+    {
+        regist->m_SceneProfileEnabled = enabled;
+    }
+
+    bool IsSceneProfileEnabled(HRegister regist)
+    {
+        return regist->m_SceneProfileEnabled;
+    }
+
+    void ResetSceneProfile(HRegister regist)
+    {
+        DM_MUTEX_SCOPED_LOCK(regist->m_Mutex);
+        for (uint32_t i = 0; i < regist->m_Collections.Size(); ++i)
+        {
+            Collection* collection = regist->m_Collections[i];
+            if (collection->m_ProfileStats)
+            {
+                memset(collection->m_ProfileStats, 0, sizeof(SceneProfileStats) * MAX_COMPONENT_TYPES);
+            }
+        }
+        regist->m_ScriptProfile.Iterate(FreeScriptProfileEntry, (void*) 0);
+        regist->m_ScriptProfile.Clear();
+    }
+
+    void AddComponentProfileSample(Collection* collection, uint32_t type_index, SceneProfileFunction function, uint64_t start_time)
+    {
+        if (!collection->m_ProfileStats)
+        {
+            collection->m_ProfileStats = (SceneProfileStats*) calloc(MAX_COMPONENT_TYPES, sizeof(SceneProfileStats));
+        }
+        SceneProfileStats& stats = collection->m_ProfileStats[type_index];
+        stats.m_Time[function] += dmTime::GetTime() - start_time;
+        stats.m_Count[function]++;
+    }
+
+    void AddScriptProfileSample(HRegister regist, const char* filename, SceneProfileFunction function, uint64_t start_time)
+    {
+        uint64_t elapsed = dmTime::GetTime() - start_time;
+
+        dmhash_t filename_hash = dmHashString64(filename);
+        ScriptProfileEntry* entry = regist->m_ScriptProfile.Get(filename_hash);
+        if (!entry)
+        {
+            if (regist->m_ScriptProfile.Full())
+            {
+                uint32_t capacity = regist->m_ScriptProfile.Capacity() + 128;
+                regist->m_ScriptProfile.SetCapacity(capacity / 2 + 64, capacity);
+            }
+            ScriptProfileEntry new_entry;
+            memset(&new_entry, 0, sizeof(new_entry));
+            new_entry.m_Filename = strdup(filename);
+            regist->m_ScriptProfile.Put(filename_hash, new_entry);
+            entry = regist->m_ScriptProfile.Get(filename_hash);
+        }
+        entry->m_Stats.m_Time[function] += elapsed;
+        entry->m_Stats.m_Count[function]++;
+    }
+
+    void IterateSceneProfileComponents(HRegister regist, FSceneProfileComponentCallback callback, void* ctx)
+    {
+        DM_MUTEX_SCOPED_LOCK(regist->m_Mutex);
+        for (uint32_t i = 0; i < regist->m_Collections.Size(); ++i)
+        {
+            Collection* collection = regist->m_Collections[i];
+            if (!collection->m_ProfileStats)
+            {
+                continue;
+            }
+
+            for (uint32_t j = 0; j < regist->m_ComponentTypeCount; ++j)
+            {
+                const SceneProfileStats& stats = collection->m_ProfileStats[j];
+                uint32_t count = 0;
+                for (uint32_t f = 0; f < SCENE_PROFILE_FUNCTION_COUNT; ++f)
+                {
+                    count += stats.m_Count[f];
+                }
+                if (count > 0)
+                {
+                    callback(ctx, collection->m_NameHash, regist->m_ComponentTypes[j].m_Name, &stats);
+                }
+            }
+        }
+    }
+
+    struct SceneProfileScriptContext
+    {
+        FSceneProfileScriptCallback m_Callback;
+        void*                       m_Context;
+    };
+
+    static void SceneProfileScriptIterator(SceneProfileScriptContext* ctx, const dmhash_t*, ScriptProfileEntry* entry)
+    {
+        ctx->m_Callback(ctx->m_Context, entry->m_Filename, &entry->m_Stats);
+    }
+
+    void IterateSceneProfileScripts(HRegister regist, FSceneProfileScriptCallback callback, void* ctx)
+    {
+        SceneProfileScriptContext iterate_ctx;
+        iterate_ctx.m_Callback = callback;
+        iterate_ctx.m_Context  = ctx;
+        regist->m_ScriptProfile.Iterate(SceneProfileScriptIterator, &iterate_ctx);
+    }
+
     struct DispatchMessagesContext
     {
         Collection* m_Collection;
@@ -2267,7 +2941,7 @@ namespace dmGameObject
             }
             else if (descriptor == dmGameObjectDDF::SetParent::m_DDFDescriptor)
             {
-                dmGameObjectDDF::SetParent* sp = (dmGameObjectDDF::SetParent*)message->m_Data;
+                dmGameObjectDDF::SetParent* sp = (dmGameObjectDDF::SetParent*)dmMessage::GetData(message);
                 dmGameObject::HInstance parent = 0;
                 if (sp->m_ParentId != 0)
                 {
@@ -2365,6 +3039,7 @@ namespace dmGameObject
                 }
                 {
                     DM_PROFILE("OnMessageFunction");
+                    uint64_t profile_start = collection->m_Register->m_SceneProfileEnabled ? dmTime::GetTime() : 0;
                     ComponentOnMessageParams params;
                     params.m_Instance = instance;
                     params.m_World = collection->m_ComponentWorlds[component->m_TypeIndex];
@@ -2374,6 +3049,8 @@ namespace dmGameObject
                     UpdateResult res = component_type->m_OnMessageFunction(params);
                     if (res != UPDATE_RESULT_OK)
                         context->m_Success = false;
+                    if (profile_start)
+                        AddComponentProfileSample(collection, component->m_TypeIndex, SCENE_PROFILE_FUNCTION_ON_MESSAGE, profile_start);
                 }
             }
             else
@@ -2400,6 +3077,7 @@ namespace dmGameObject
                     }
                     {
                         DM_PROFILE("OnMessageFunction");
+                        uint64_t profile_start = collection->m_Register->m_SceneProfileEnabled ? dmTime::GetTime() : 0;
                         ComponentOnMessageParams params;
                         params.m_Instance = instance;
                         params.m_World = collection->m_ComponentWorlds[component->m_TypeIndex];
@@ -2409,6 +3087,8 @@ namespace dmGameObject
                         UpdateResult res = component_type->m_OnMessageFunction(params);
                         if (res != UPDATE_RESULT_OK)
                             context->m_Success = false;
+                        if (profile_start)
+                            AddComponentProfileSample(collection, component->m_TypeIndex, SCENE_PROFILE_FUNCTION_ON_MESSAGE, profile_start);
                     }
                 }
                 else
@@ -2485,64 +3165,102 @@ namespace dmGameObject
         }
     }
 
-    void UpdateTransforms(Collection* collection)
+    // Levels with fewer instances than this are updated on the calling thread
+    static const uint32_t TRANSFORM_PARALLEL_THRESHOLD = 2048;
+    static const uint32_t TRANSFORM_PARALLEL_GRAIN_SIZE = 8 * TRANSFORM_BATCH_SIZE;
+
+    // Gathers the local transforms of the instances into batches, and composes them with the parent world transforms
+    static void UpdateLevelTransforms(Collection* collection, const InstanceIndex* indices, uint32_t count, bool is_root)
     {
-        DM_PROFILE("UpdateTransforms");
+        LocalTransformBatch batch;
+        const Matrix4* parents[TRANSFORM_BATCH_SIZE];
+        Matrix4* out[TRANSFORM_BATCH_SIZE];
+        Matrix4* world_transforms = collection->m_WorldTransforms.Begin();
+        bool scale_along_z = collection->m_ScaleAlongZ;
 
-        // Calculate world transforms
-        // First root-level instances
-        dmArray<uint16_t>& root_level = collection->m_LevelIndices[0];
-        uint32_t root_count = root_level.Size();
-        for (uint32_t i = 0; i < root_count; ++i)
+        for (uint32_t start = 0; start < count; start += TRANSFORM_BATCH_SIZE)
         {
-            uint16_t index = root_level[i];
-            Instance* instance = collection->m_Instances[index];
-            CheckEuler(instance);
-            collection->m_WorldTransforms[index] = dmTransform::ToMatrix4(instance->m_Transform);
-            uint16_t parent_index = instance->m_Parent;
-            assert(parent_index == INVALID_INSTANCE_INDEX);
-        }
-
-
-        if (collection->m_ScaleAlongZ) {
-            for (uint32_t level_i = 1; level_i < MAX_HIERARCHICAL_DEPTH; ++level_i)
+            uint32_t batch_count = dmMath::Min(TRANSFORM_BATCH_SIZE, count - start);
+            for (uint32_t i = 0; i < batch_count; ++i)
             {
-                dmArray<uint16_t>& level = collection->m_LevelIndices[level_i];
-                uint32_t instance_count = level.Size();
-                for (uint32_t i = 0; i < instance_count; ++i)
+                InstanceIndex index = indices[start + i];
+                Instance* instance = collection->m_Instances[index];
+                CheckEuler(instance);
+
+                const dmTransform::Transform& transform = instance->m_Transform;
+                const Vector3& position = transform.GetTranslation();
+                const Quat& rotation = transform.GetRotation();
+                const Vector3& scale = transform.GetScale();
+                batch.m_PositionX[i] = position.getX();
+                batch.m_PositionY[i] = position.getY();
+                batch.m_PositionZ[i] = position.getZ();
+                batch.m_RotationX[i] = rotation.getX();
+                batch.m_RotationY[i] = rotation.getY();
+                batch.m_RotationZ[i] = rotation.getZ();
+                batch.m_RotationW[i] = rotation.getW();
+                batch.m_ScaleX[i] = scale.getX();
+                batch.m_ScaleY[i] = scale.getY();
+                batch.m_ScaleZ[i] = scale.getZ();
+
+                InstanceIndex parent_index = instance->m_Parent;
+                if (is_root)
+                {
+                    assert(parent_index == INVALID_INSTANCE_INDEX);
+                }
+                else
                 {
-                    uint16_t index = level[i];
-                    Instance* instance = collection->m_Instances[index];
-                    CheckEuler(instance);
-                    Matrix4* trans = &collection->m_WorldTransforms[index];
-
-                    uint16_t parent_index = instance->m_Parent;
                     assert(parent_index != INVALID_INSTANCE_INDEX);
-
-                    Matrix4* parent_trans = &collection->m_WorldTransforms[parent_index];
-                    Matrix4 own = dmTransform::ToMatrix4(instance->m_Transform);
-                    *trans = *parent_trans * own;
+                    parents[i] = &world_transforms[parent_index];
                 }
+                out[i] = &world_transforms[index];
             }
-        } else {
-            for (uint32_t level_i = 1; level_i < MAX_HIERARCHICAL_DEPTH; ++level_i)
-            {
-                dmArray<uint16_t>& level = collection->m_LevelIndices[level_i];
-                uint32_t instance_count = level.Size();
-                for (uint32_t i = 0; i < instance_count; ++i)
-                {
-                    uint16_t index = level[i];
-                    Instance* instance = collection->m_Instances[index];
-                    CheckEuler(instance);
-                    Matrix4* trans = &collection->m_WorldTransforms[index];
 
-                    uint16_t parent_index = instance->m_Parent;
-                    assert(parent_index != INVALID_INSTANCE_INDEX);
+            ComposeTransformBatch(&batch, batch_count, is_root ? 0 : parents, out, scale_along_z);
+        }
+    }
 
-                    Matrix4* parent_trans = &collection->m_WorldTransforms[parent_index];
-                    Matrix4 own = dmTransform::ToMatrix4(instance->m_Transform);
-                    *trans = dmTransform::MulNoScaleZ(*parent_trans, own);
-                }
+    struct UpdateLevelTransformsContext
+    {
+        Collection*             m_Collection;
+        const InstanceIndex*    m_Indices;
+        bool                    m_IsRoot;
+    };
+
+    static void UpdateLevelTransformsRange(void* _ctx, uint32_t begin, uint32_t end)
+    {
+        DM_PROFILE("UpdateLevelTransformsRange");
+        UpdateLevelTransformsContext* ctx = (UpdateLevelTransformsContext*)_ctx;
+        UpdateLevelTransforms(ctx->m_Collection, ctx->m_Indices + begin, end - begin, ctx->m_IsRoot);
+    }
+
+    void UpdateTransforms(Collection* collection)
+    {
+        DM_PROFILE("UpdateTransforms");
+
+        dmJobThread::HContext job_thread = collection->m_Register->m_JobThread;
+
+        // Calculate world transforms, level by level since each level depends on the previous one.
+        // The instances within a level are independent, so large levels are split across the job workers.
+        // ParallelFor returns when the whole level is done, which is the barrier before the next level.
+        // First root-level instances
+        for (uint32_t level_i = 0; level_i < MAX_HIERARCHICAL_DEPTH; ++level_i)
+        {
+            dmArray<InstanceIndex>& level = collection->m_LevelIndices[level_i];
+            uint32_t instance_count = level.Size();
+            if (instance_count == 0)
+                continue;
+
+            if (job_thread && instance_count >= TRANSFORM_PARALLEL_THRESHOLD)
+            {
+                UpdateLevelTransformsContext ctx;
+                ctx.m_Collection = collection;
+                ctx.m_Indices = level.Begin();
+                ctx.m_IsRoot = level_i == 0;
+                dmJobThread::ParallelFor(job_thread, instance_count, TRANSFORM_PARALLEL_GRAIN_SIZE, UpdateLevelTransformsRange, &ctx);
+            }
+            else
+            {
+                UpdateLevelTransforms(collection, level.Begin(), instance_count, level_i == 0);
             }
         }
 
@@ -2596,6 +3314,7 @@ namespace dmGameObject
             if (component_type->m_UpdateFunction)
             {
                 DM_PROFILE_DYN(component_type->m_Name, 0);
+                uint64_t profile_start = collection->m_Register->m_SceneProfileEnabled ? dmTime::GetTime() : 0;
                 ComponentsUpdateParams params;
                 params.m_Collection = collection->m_HCollection;
                 params.m_UpdateContext = &dynamic_update_context;
@@ -2607,6 +3326,8 @@ namespace dmGameObject
                 UpdateResult res = component_type->m_UpdateFunction(params, update_result);
                 if (res != UPDATE_RESULT_OK)
                     ret = false;
+                if (profile_start)
+                    AddComponentProfileSample(collection, update_index, SCENE_PROFILE_FUNCTION_UPDATE, profile_start);
 
                 // Mark the collections transforms as dirty if this component has updated
                 // them in its update function.
@@ -2656,6 +3377,7 @@ namespace dmGameObject
                         if (component_type->m_FixedUpdateFunction)
                         {
                             DM_PROFILE_DYN(component_type->m_Name, 0);
+                            uint64_t profile_start = collection->m_Register->m_SceneProfileEnabled ? dmTime::GetTime() : 0;
                             ComponentsUpdateParams params;
                             params.m_Collection = collection->m_HCollection;
                             params.m_UpdateContext = &fixed_update_context;
@@ -2667,6 +3389,8 @@ namespace dmGameObject
                             UpdateResult res = component_type->m_FixedUpdateFunction(params, update_result);
                             if (res != UPDATE_RESULT_OK)
                                 ret = false;
+                            if (profile_start)
+                                AddComponentProfileSample(collection, update_index, SCENE_PROFILE_FUNCTION_FIXED_UPDATE, profile_start);
 
                             // Mark the collections transforms as dirty if this component has updated
                             // them in its update function.
@@ -2712,6 +3436,7 @@ namespace dmGameObject
             if (component_type->m_RenderFunction)
             {
                 DM_PROFILE_DYN(component_type->m_Name, 0);
+                uint64_t profile_start = collection->m_Register->m_SceneProfileEnabled ? dmTime::GetTime() : 0;
                 ComponentsRenderParams params;
                 params.m_Collection = hcollection;
                 params.m_World = collection->m_ComponentWorlds[update_index];
@@ -2719,6 +3444,8 @@ namespace dmGameObject
                 UpdateResult res = component_type->m_RenderFunction(params);
                 if (res != UPDATE_RESULT_OK)
                     ret = false;
+                if (profile_start)
+                    AddComponentProfileSample(collection, update_index, SCENE_PROFILE_FUNCTION_RENDER, profile_start);
             }
         }
         return ret;
@@ -2756,6 +3483,7 @@ namespace dmGameObject
             if (component_type->m_PostUpdateFunction)
             {
                 DM_PROFILE_DYN(component_type->m_Name, 0);
+                uint64_t profile_start = reg->m_SceneProfileEnabled ? dmTime::GetTime() : 0;
                 ComponentsPostUpdateParams params;
                 params.m_Collection = collection->m_HCollection;
                 params.m_World = collection->m_ComponentWorlds[update_index];
@@ -2763,6 +3491,8 @@ namespace dmGameObject
                 UpdateResult res = component_type->m_PostUpdateFunction(params);
                 if (res != UPDATE_RESULT_OK && result)
                     result = false;
+                if (profile_start)
+                    AddComponentProfileSample(collection, update_index, SCENE_PROFILE_FUNCTION_POST_UPDATE, profile_start);
             }
         }
 
@@ -2775,11 +3505,11 @@ namespace dmGameObject
             while (collection->m_InstancesToDeleteHead != INVALID_INSTANCE_INDEX && pass_count < max_pass_count) {
                 ++pass_count;
                 // Save the list and clear the head and tail
-                uint16_t head = collection->m_InstancesToDeleteHead;
+                InstanceIndex head = collection->m_InstancesToDeleteHead;
                 collection->m_InstancesToDeleteHead = INVALID_INSTANCE_INDEX;
                 collection->m_InstancesToDeleteTail = INVALID_INSTANCE_INDEX;
 
-                uint16_t index = head;
+                InstanceIndex index = head;
                 while (index != INVALID_INSTANCE_INDEX) {
                     Instance* instance = collection->m_Instances[index];
 
@@ -2856,10 +3586,200 @@ namespace dmGameObject
         return result;
     }
 
+    static inline uint64_t GetInputFilterKey(HInstance instance, dmhash_t action_id)
+    {
+        return action_id ^ ((uint64_t)(instance->m_Index + 1) * 0x9E3779B97F4A7C15ULL);
+    }
+
+    static inline bool IsInputFiltered(Collection* collection, HInstance instance, const InputAction& input_action)
+    {
+        return instance->m_InputFiltered && collection->m_InputFilter.Get(GetInputFilterKey(instance, input_action.m_ActionId)) == 0;
+    }
+
+    struct InputFilterKeysContext
+    {
+        dmArray<uint64_t>* m_Keys;
+        uint16_t           m_Index;
+    };
+
+    static void CollectInputFilterKeys(InputFilterKeysContext* context, const uint64_t* key, uint16_t* index)
+    {
+        if (*index == context->m_Index)
+        {
+            if (context->m_Keys->Full())
+                context->m_Keys->OffsetCapacity(16);
+            context->m_Keys->Push(*key);
+        }
+    }
+
+    static void ClearInputFilter(Collection* collection, HInstance instance)
+    {
+        if (!instance->m_InputFiltered)
+            return;
+
+        dmArray<uint64_t> keys;
+        InputFilterKeysContext context;
+        context.m_Keys = &keys;
+        context.m_Index = instance->m_Index;
+        collection->m_InputFilter.Iterate(CollectInputFilterKeys, &context);
+        for (uint32_t i = 0; i < keys.Size(); ++i)
+        {
+            collection->m_InputFilter.Erase(keys[i]);
+        }
+        instance->m_InputFiltered = 0;
+    }
+
+    void SetInputFilter(HInstance instance, const dmhash_t* action_ids, uint32_t action_id_count)
+    {
+        Collection* collection = instance->m_Collection;
+        ClearInputFilter(collection, instance);
+        if (action_id_count == 0)
+            return;
+
+        dmFlatHashTable64<uint16_t>& filter = collection->m_InputFilter;
+        if (filter.Size() + action_id_count > filter.Capacity())
+        {
+            filter.SetCapacity(filter.Size() + action_id_count + 32);
+        }
+        for (uint32_t i = 0; i < action_id_count; ++i)
+        {
+            filter.Put(GetInputFilterKey(instance, action_ids[i]), instance->m_Index);
+        }
+        instance->m_InputFiltered = 1;
+    }
+
+    void SetInputBatchDispatch(HRegister regist, bool batch)
+    {
+        regist->m_InputBatchDispatch = batch;
+    }
+
+    void SetDeterministic(HRegister regist, bool deterministic)
+    {
+        regist->m_Deterministic = deterministic;
+    }
+
+    bool IsDeterministic(HRegister regist)
+    {
+        return regist->m_Deterministic;
+    }
+
+    // Visits the listeners from the top of the stack, and gives each component all the remaining actions at once
+    static UpdateResult DispatchInputBatched(Collection* collection, InputAction* input_actions, uint32_t input_action_count)
+    {
+        dmArray<const InputAction*> actions;
+        dmArray<InputAction*> listener_actions;
+        dmArray<InputResult> results;
+        dmArray<uint8_t> consumed;
+        actions.SetCapacity(input_action_count);
+        listener_actions.SetCapacity(input_action_count);
+        results.SetCapacity(input_action_count);
+        consumed.SetCapacity(input_action_count);
+
+        uint32_t stack_size = collection->m_InputFocusStack.Size();
+        for (uint32_t k = 0; k < stack_size; ++k)
+        {
+            HInstance instance = collection->m_InputFocusStack[stack_size - 1 - k];
+
+            listener_actions.SetSize(0);
+            for (uint32_t i = 0; i < input_action_count; ++i)
+            {
+                InputAction& input_action = input_actions[i];
+                if ((input_action.m_ActionId != 0 || input_action.m_PositionSet || input_action.m_AccelerationSet) && !IsInputFiltered(collection, instance, input_action))
+                {
+                    listener_actions.Push(&input_action);
+                }
+            }
+            uint32_t action_count = listener_actions.Size();
+            if (action_count == 0)
+                continue;
+
+            actions.SetSize(action_count);
+            consumed.SetSize(action_count);
+            memset(consumed.Begin(), 0, action_count);
+            for (uint32_t i = 0; i < action_count; ++i)
+            {
+                actions[i] = listener_actions[i];
+            }
+
+            Prototype* prototype = instance->m_Prototype;
+            uint32_t components_size = prototype->m_ComponentCount;
+            uint32_t next_component_instance_data = 0;
+            for (uint32_t l = 0; l < components_size; ++l)
+            {
+                ComponentType* component_type = prototype->m_Components[l].m_Type;
+                assert(component_type);
+                uintptr_t* component_instance_data = 0;
+                if (component_type->m_InstanceHasUserData)
+                {
+                    component_instance_data = &instance->m_ComponentInstanceUserData[next_component_instance_data++];
+                }
+
+                if (component_type->m_OnInputBatchFunction)
+                {
+                    results.SetSize(action_count);
+                    for (uint32_t i = 0; i < action_count; ++i)
+                    {
+                        results[i] = INPUT_RESULT_IGNORED;
+                    }
+
+                    ComponentOnInputBatchParams params;
+                    params.m_Instance = instance;
+                    params.m_InputActions = actions.Begin();
+                    params.m_InputActionCount = action_count;
+                    params.m_Results = results.Begin();
+                    params.m_Context = component_type->m_Context;
+                    params.m_UserData = component_instance_data;
+                    if (component_type->m_OnInputBatchFunction(params) == INPUT_RESULT_UNKNOWN_ERROR)
+                        return UPDATE_RESULT_UNKNOWN_ERROR;
+                    for (uint32_t i = 0; i < action_count; ++i)
+                    {
+                        if (results[i] == INPUT_RESULT_CONSUMED)
+                            consumed[i] = 1;
+                        else if (results[i] == INPUT_RESULT_UNKNOWN_ERROR)
+                            return UPDATE_RESULT_UNKNOWN_ERROR;
+                    }
+                }
+                else if (component_type->m_OnInputFunction)
+                {
+                    for (uint32_t i = 0; i < action_count; ++i)
+                    {
+                        ComponentOnInputParams params;
+                        params.m_Instance = instance;
+                        params.m_InputAction = actions[i];
+                        params.m_Context = component_type->m_Context;
+                        params.m_UserData = component_instance_data;
+                        InputResult comp_res = component_type->m_OnInputFunction(params);
+                        if (comp_res == INPUT_RESULT_CONSUMED)
+                            consumed[i] = 1;
+                        else if (comp_res == INPUT_RESULT_UNKNOWN_ERROR)
+                            return UPDATE_RESULT_UNKNOWN_ERROR;
+                    }
+                }
+            }
+
+            // As with the per action dispatch, all the components of the listener see an action before it's consumed
+            for (uint32_t i = 0; i < action_count; ++i)
+            {
+                if (consumed[i])
+                {
+                    InputAction* input_action = listener_actions[i];
+                    memset(input_action, 0, sizeof(InputAction));
+                    input_action->m_Consumed = 1;
+                }
+            }
+        }
+        return UPDATE_RESULT_OK;
+    }
+
     UpdateResult DispatchInput(Collection* collection, InputAction* input_actions, uint32_t input_action_count)
     {
         DM_PROFILE("DispatchInput");
 
+        if (collection->m_Register->m_InputBatchDispatch)
+        {
+            return DispatchInputBatched(collection, input_actions, input_action_count);
+        }
+
         // iterate stacks from top to bottom
         for (uint32_t i = 0; i < input_action_count; ++i)
         {
@@ -2870,6 +3790,8 @@ namespace dmGameObject
                 for (uint32_t k = 0; k < stack_size; ++k)
                 {
                     HInstance instance = collection->m_InputFocusStack[stack_size - 1 - k];
+                    if (IsInputFiltered(collection, instance, input_action))
+                        continue;
                     Prototype* prototype = instance->m_Prototype;
                     uint32_t components_size = prototype->m_ComponentCount;
 
@@ -3249,6 +4171,63 @@ namespace dmGameObject
         instance->m_Transform.SetRotation(dmVMath::EulerToQuat(instance->m_EulerRotation));
     }
 
+    // The user data of the component, if its type has instance user data
+    static uintptr_t* GetComponentUserData(HInstance instance, uint16_t component_index)
+    {
+        Prototype::Component* components = instance->m_Prototype->m_Components;
+        if (!components[component_index].m_Type->m_InstanceHasUserData)
+            return 0;
+
+        uint32_t next_component_instance_data = 0;
+        for (uint32_t i = 0; i < component_index; ++i)
+        {
+            if (components[i].m_Type->m_InstanceHasUserData)
+                ++next_component_instance_data;
+        }
+        return &instance->m_ComponentInstanceUserData[next_component_instance_data];
+    }
+
+    static PropertyResult GetComponentProperty(HInstance instance, uint16_t component_index, dmhash_t property_id, PropertyOptions options, PropertyDesc& out_value)
+    {
+        Prototype::Component& component = instance->m_Prototype->m_Components[component_index];
+        ComponentType* type = component.m_Type;
+        if (!type->m_GetPropertyFunction)
+            return PROPERTY_RESULT_NOT_FOUND;
+
+        ComponentGetPropertyParams p;
+        p.m_Context = type->m_Context;
+        p.m_World = instance->m_Collection->m_ComponentWorlds[component.m_TypeIndex];
+        p.m_Instance = instance;
+        p.m_PropertyId = property_id;
+        p.m_Options = options;
+        p.m_UserData = GetComponentUserData(instance, component_index);
+        PropertyDesc prop_desc;
+        PropertyResult result = type->m_GetPropertyFunction(p, prop_desc);
+        if (result == PROPERTY_RESULT_OK)
+        {
+            out_value = prop_desc;
+        }
+        return result;
+    }
+
+    static PropertyResult SetComponentProperty(HInstance instance, uint16_t component_index, dmhash_t property_id, PropertyOptions options, const PropertyVar& value)
+    {
+        Prototype::Component& component = instance->m_Prototype->m_Components[component_index];
+        ComponentType* type = component.m_Type;
+        if (!type->m_SetPropertyFunction)
+            return PROPERTY_RESULT_NOT_FOUND;
+
+        ComponentSetPropertyParams p;
+        p.m_Context = type->m_Context;
+        p.m_World = instance->m_Collection->m_ComponentWorlds[component.m_TypeIndex];
+        p.m_Instance = instance;
+        p.m_PropertyId = property_id;
+        p.m_UserData = GetComponentUserData(instance, component_index);
+        p.m_Value = value;
+        p.m_Options = options;
+        return type->m_SetPropertyFunction(p);
+    }
+
     PropertyResult GetProperty(HInstance instance, dmhash_t component_id, dmhash_t property_id, PropertyOptions options, PropertyDesc& out_value)
     {
         if (instance == 0)
@@ -3423,41 +4402,7 @@ namespace dmGameObject
             uint16_t component_index;
             if (RESULT_OK == GetComponentIndex(instance, component_id, &component_index))
             {
-                Prototype::Component* components = instance->m_Prototype->m_Components;
-                Prototype::Component& component = components[component_index];
-                ComponentType* type = component.m_Type;
-                if (type->m_GetPropertyFunction)
-                {
-                    uintptr_t* user_data = 0;
-                    if (type->m_InstanceHasUserData)
-                    {
-                        uint32_t next_component_instance_data = 0;
-                        for (uint32_t i = 0; i < component_index; ++i)
-                        {
-                            if (components[i].m_Type->m_InstanceHasUserData)
-                                ++next_component_instance_data;
-                        }
-                        user_data = &instance->m_ComponentInstanceUserData[next_component_instance_data];
-                    }
-                    ComponentGetPropertyParams p;
-                    p.m_Context = type->m_Context;
-                    p.m_World = instance->m_Collection->m_ComponentWorlds[component.m_TypeIndex];
-                    p.m_Instance = instance;
-                    p.m_PropertyId = property_id;
-                    p.m_Options = options;
-                    p.m_UserData = user_data;
-                    PropertyDesc prop_desc;
-                    PropertyResult result = type->m_GetPropertyFunction(p, prop_desc);
-                    if (result == PROPERTY_RESULT_OK)
-                    {
-                        out_value = prop_desc;
-                    }
-                    return result;
-                }
-                else
-                {
-                    return PROPERTY_RESULT_NOT_FOUND;
-                }
+                return GetComponentProperty(instance, component_index, property_id, options, out_value);
             }
             else
             {
@@ -3624,36 +4569,7 @@ namespace dmGameObject
             uint16_t component_index;
             if (RESULT_OK == GetComponentIndex(instance, component_id, &component_index))
             {
-                Prototype::Component* components = instance->m_Prototype->m_Components;
-                Prototype::Component& component = components[component_index];
-                ComponentType* type = component.m_Type;
-                if (type->m_SetPropertyFunction)
-                {
-                    uintptr_t* user_data = 0;
-                    if (type->m_InstanceHasUserData)
-                    {
-                        uint32_t next_component_instance_data = 0;
-                        for (uint32_t i = 0; i < component_index; ++i)
-                        {
-                            if (components[i].m_Type->m_InstanceHasUserData)
-                                ++next_component_instance_data;
-                        }
-                        user_data = &instance->m_ComponentInstanceUserData[next_component_instance_data];
-                    }
-                    ComponentSetPropertyParams p;
-                    p.m_Context = type->m_Context;
-                    p.m_World = instance->m_Collection->m_ComponentWorlds[component.m_TypeIndex];
-                    p.m_Instance = instance;
-                    p.m_PropertyId = property_id;
-                    p.m_UserData = user_data;
-                    p.m_Value = value;
-                    p.m_Options = options;
-                    return type->m_SetPropertyFunction(p);
-                }
-                else
-                {
-                    return PROPERTY_RESULT_NOT_FOUND;
-                }
+                return SetComponentProperty(instance, component_index, property_id, options, value);
             }
             else
             {
@@ -3663,18 +4579,60 @@ namespace dmGameObject
         return PROPERTY_RESULT_OK;
     }
 
+    PropertyResult GetPropertyHandle(HInstance instance, dmhash_t component_id, dmhash_t property_id, PropertyOptions options, PropertyHandle* out_handle)
+    {
+        if (instance == 0)
+            return PROPERTY_RESULT_INVALID_INSTANCE;
+
+        uint16_t component_index = INVALID_COMPONENT_INDEX;
+        if (component_id != 0 && RESULT_OK != GetComponentIndex(instance, component_id, &component_index))
+            return PROPERTY_RESULT_COMP_NOT_FOUND;
+
+        PropertyDesc desc;
+        PropertyResult result = component_index == INVALID_COMPONENT_INDEX
+                                    ? GetProperty(instance, 0, property_id, options, desc)
+                                    : GetComponentProperty(instance, component_index, property_id, options, desc);
+        if (result != PROPERTY_RESULT_OK)
+            return result;
+
+        out_handle->m_Instance = instance;
+        out_handle->m_ComponentId = component_id;
+        out_handle->m_PropertyId = property_id;
+        out_handle->m_Options = options;
+        out_handle->m_ValuePtr = desc.m_ValuePtr;
+        out_handle->m_Type = desc.m_Variant.m_Type;
+        out_handle->m_ComponentIndex = component_index;
+        out_handle->m_ReadOnly = desc.m_ReadOnly;
+        return PROPERTY_RESULT_OK;
+    }
+
+    PropertyResult GetProperty(const PropertyHandle& handle, PropertyDesc& out_value)
+    {
+        if (handle.m_ComponentIndex == INVALID_COMPONENT_INDEX)
+            return GetProperty(handle.m_Instance, 0, handle.m_PropertyId, handle.m_Options, out_value);
+        return GetComponentProperty(handle.m_Instance, handle.m_ComponentIndex, handle.m_PropertyId, handle.m_Options, out_value);
+    }
+
+    PropertyResult SetProperty(const PropertyHandle& handle, const PropertyVar& value)
+    {
+        if (handle.m_ComponentIndex == INVALID_COMPONENT_INDEX)
+            return SetProperty(handle.m_Instance, 0, handle.m_PropertyId, handle.m_Options, value);
+        return SetComponentProperty(handle.m_Instance, handle.m_ComponentIndex, handle.m_PropertyId, handle.m_Options, value);
+    }
+
     // Recreate the instance at the given index with a new prototype.
     // Specifically:
     //  - recreate components and call init/final functions
     //  - patch data structures for identification and input stack
     //  - copy the rest of the fields
     // The old instance is destroyed.
-    static void RecreateInstance(Collection* collection, uint16_t index, Prototype* old_proto, Prototype* new_proto, const char* new_proto_name) {
+    static void RecreateInstance(Collection* collection, InstanceIndex index, Prototype* old_proto, Prototype* new_proto, const char* new_proto_name) {
         HInstance instance = collection->m_Instances[index];
         // We don't support recreating instances that are 'transitioning'
         assert(instance->m_ToBeAdded == 0);
         assert(instance->m_ToBeDeleted == 0);
-        HInstance new_instance = AllocInstance(new_proto, new_proto_name);
+        // The new instance takes over the pool of the old one
+        HInstance new_instance = AllocInstance(new_proto, instance->m_Pool, CountComponentInstanceUserData(new_proto, new_proto_name));
         if (!new_instance) {
             return;
         }
@@ -3736,11 +4694,11 @@ namespace dmGameObject
         Collection* collection = (Collection*) params->m_UserData;
         for (uint32_t level_i = 0; level_i < MAX_HIERARCHICAL_DEPTH; ++level_i)
         {
-            dmArray<uint16_t>& level = collection->m_LevelIndices[level_i];
+            dmArray<InstanceIndex>& level = collection->m_LevelIndices[level_i];
             uint32_t instance_count = level.Size();
             for (uint32_t i = 0; i < instance_count; ++i)
             {
-                uint16_t index = level[i];
+                InstanceIndex index = level[i];
                 Instance* instance = collection->m_Instances[index];
                 Prototype* prototype = (Prototype*)ResourceDescriptorGetResource(params->m_Resource);
                 if (instance->m_Prototype == prototype) {
@@ -3785,7 +4743,7 @@ namespace dmGameObject
     {
         Collection* collection = hcollection->m_Collection;
         uint32_t count = 0;
-        uint16_t index = collection->m_InstancesToAddHead;
+        InstanceIndex index = collection->m_InstancesToAddHead;
         while (index != INVALID_INSTANCE_INDEX) {
             index = collection->m_Instances[index]->m_NextToAdd;
             ++count;
@@ -3797,7 +4755,7 @@ namespace dmGameObject
     {
         Collection* collection = hcollection->m_Collection;
         uint32_t count = 0;
-        uint16_t index = collection->m_InstancesToDeleteHead;
+        InstanceIndex index = collection->m_InstancesToDeleteHead;
         while (index != INVALID_INSTANCE_INDEX) {
             index = collection->m_Instances[index]->m_NextToDelete;
             ++count;
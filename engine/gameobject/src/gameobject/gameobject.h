@@ -21,6 +21,7 @@
 
 #include <dlib/easing.h>
 #include <dlib/hashtable.h>
+#include <dlib/job_thread.h>
 #include <dlib/message.h>
 #include <dlib/transform.h>
 
@@ -97,6 +98,13 @@ namespace dmGameObject
      */
     void SetInputStackDefaultCapacity(HRegister regist, uint32_t capacity);
 
+    /**
+     * Set the job thread context used for updating the transforms of large collections in parallel.
+     * @param regist Register
+     * @param job_thread Job thread context. 0 means that the transforms are updated on the calling thread
+     */
+    void SetJobThread(HRegister regist, dmJobThread::HContext job_thread);
+
     /**
      * Creates a new gameobject collection
      * @param name Collection name, which must be unique and follow the same naming as for sockets
@@ -149,6 +157,77 @@ namespace dmGameObject
                              const Point3& position, const Quat& rotation, const Vector3& scale,
                              InstanceIdMap *instances);
 
+    /**
+     * Pool of game object instance memory for a prototype
+     */
+    typedef struct InstancePool* HInstancePool;
+
+    /**
+     * Create a pool for instances spawned from a prototype. Deleted instances return their memory to the pool,
+     * and while an instance is alive its reference to the prototype is held by the pool instead.
+     * The components are still created and destroyed with each spawn and delete.
+     * @param factory Resource factory the prototype was loaded from
+     * @param prototype Prototype. A reference is held until the pool and all its instances are deleted
+     * @param prototype_name Name of the prototype, used for error reporting
+     * @param preallocate Number of instances to allocate up front
+     * @param max_size Max number of free instances kept in the pool
+     * @return The pool
+     */
+    HInstancePool NewInstancePool(dmResource::HFactory factory, HPrototype prototype, const char* prototype_name, uint32_t preallocate, uint32_t max_size);
+
+    /**
+     * Delete a pool. If instances from the pool are still alive, the pool is freed when the last one is deleted.
+     * @param pool Pool
+     */
+    void DeleteInstancePool(HInstancePool pool);
+
+    /**
+     * Get the prototype of a pool
+     * @param pool Pool
+     * @return The prototype
+     */
+    HPrototype GetInstancePoolPrototype(HInstancePool pool);
+
+    /**
+     * Get the number of free instances in a pool
+     * @param pool Pool
+     * @return The number of free instances
+     */
+    uint32_t GetInstancePoolFreeCount(HInstancePool pool);
+
+    /**
+     * Spawns a new gameobject instance from the prototype of a pool, see Spawn.
+     * @param collection Gameobject collection
+     * @param pool Pool
+     * @param prototype_name Name of the prototype, used for error reporting
+     * @param id Id of the spawned instance
+     * @param property_container Container with script properties
+     * @param position Position of the spawned object
+     * @param rotation Rotation of the spawned object
+     * @param scale Scale of the spawned object
+     * return the spawned instance, 0 at failure
+     */
+    HInstance SpawnFromPool(HCollection collection, HInstancePool pool, const char* prototype_name, dmhash_t id,
+                            HPropertyContainer property_container, const Point3& position, const Quat& rotation, const Vector3& scale);
+
+    /**
+     * Spawns several gameobject instances from the prototype of a pool, see SpawnBatch.
+     * return the number of spawned instances
+     */
+    uint32_t SpawnBatchFromPool(HCollection collection, HInstancePool pool, const char* prototype_name, uint32_t count, const dmhash_t* ids,
+                                HPropertyContainer property_container, const Point3* positions, const Quat* rotations, const Vector3* scales,
+                                HInstance* out_instances);
+
+    /**
+     * Spawns a collection, see SpawnFromCollection, with the instance memory taken from pools.
+     * @param pools One pool per instance in the collection description, in the same order. Entries may be 0, and
+     *              the pool prototype must match the prototype of the instance.
+     * return true on success
+     */
+    bool SpawnFromCollection(HCollection collection, HCollectionDesc collection_desc, InstancePropertyBuffers *property_buffers,
+                             const Point3& position, const Quat& rotation, const Vector3& scale,
+                             InstanceIdMap *instances, HInstancePool* pools);
+
     /**
      * Delete all gameobject instances in the collection
      * @param collection Gameobject collection
@@ -203,6 +282,27 @@ namespace dmGameObject
      */
     bool Final(HCollection collection);
 
+    /**
+     * Initializes the instances of the collection over several calls, a few at a time, parents before children.
+     * Each call initializes instances until the time budget is spent, but always at least one. The instances
+     * are added to the update, and the messages posted from their init functions are dispatched, in the
+     * call that initializes the last one.
+     * @param collection Game object collection
+     * @param time_budget Time budget of the call, in microseconds
+     * @param out_done Set to true when all instances are initialized
+     * @return false if any instance failed to initialize
+     */
+    bool InitSliced(HCollection collection, uint32_t time_budget, bool* out_done);
+
+    /**
+     * Finalizes the instances of the collection over several calls, children before parents.
+     * @param collection Game object collection
+     * @param time_budget Time budget of the call, in microseconds
+     * @param out_done Set to true when all instances are finalized
+     * @return false if any instance failed to finalize
+     */
+    bool FinalSliced(HCollection collection, uint32_t time_budget, bool* out_done);
+
     /**
      * Update all gameobjects and its components and dispatches all message to script.
      * The order is to update each component type, one at a time, of the collection each iteration.
@@ -244,6 +344,47 @@ namespace dmGameObject
     void AcquireInputFocus(HCollection collection, HInstance instance);
     void ReleaseInputFocus(HCollection collection, HInstance instance);
 
+    /**
+     * Sets if DispatchInput() goes through the listeners one at a time, and gives each component type with
+     * an on-input-batch function all the remaining actions at once. The listeners are still visited from
+     * the top of the input stack, and consumed actions aren't passed further down. Off by default.
+     * @param regist Register
+     * @param batch True to dispatch in batches
+     */
+    void SetInputBatchDispatch(HRegister regist, bool batch);
+
+    /**
+     * Limits the actions dispatched to an instance to the given action ids. The actions without an id
+     * (mouse movement) are not dispatched to an instance with a filter.
+     * @param instance Instance
+     * @param action_ids The action ids, or 0 to remove the filter
+     * @param action_id_count Number of action ids
+     */
+    void SetInputFilter(HInstance instance, const dmhash_t* action_ids, uint32_t action_id_count);
+
+    /**
+     * Sets if the collections created from now on are deterministic. Each of them gets its own
+     * math.random state, seeded from the collection name, so that the scripts of a collection get
+     * the same numbers on every client regardless of the other collections. Off by default.
+     * @param regist Register
+     * @param deterministic True to make new collections deterministic
+     */
+    void SetDeterministic(HRegister regist, bool deterministic);
+    bool IsDeterministic(HRegister regist);
+
+    /**
+     * Hashes the simulation state of the collection, to detect when two simulations have diverged.
+     * The hash covers the id and local transform of every instance, the given component properties and the
+     * state of the component types with a hash state function (e.g. the physics). It doesn't depend on the
+     * order of the instances, so two collections with the same objects in the same state get the same hash.
+     * @param collection Collection
+     * @param component_ids The component of each property, e.g. hash("script"). Instances without the component are skipped
+     * @param property_ids The properties to hash, e.g. hash("health")
+     * @param property_count Number of properties
+     * @return the hash of the state
+     */
+    uint64_t HashCollectionState(HCollection collection, const dmhash_t* component_ids, const dmhash_t* property_ids, uint32_t property_count);
+
     /**
      * Retrieve a factory from the specified collection
      * @param collection Game object collection
@@ -335,6 +476,54 @@ namespace dmGameObject
      */
     PropertyResult SetProperty(HInstance instance, dmhash_t component_id, dmhash_t property_id, PropertyOptions options, const PropertyVar& value);
 
+    /// Component index of a property of the instance itself, e.g. position
+    const uint16_t INVALID_COMPONENT_INDEX = 0xffff;
+
+    /**
+     * A property resolved once by GetPropertyHandle, so that it can be get and set repeatedly
+     * without looking up the component. The handle is valid as long as the instance is, since the
+     * components of an instance are only deleted with it.
+     */
+    struct PropertyHandle
+    {
+        HInstance       m_Instance;
+        dmhash_t        m_ComponentId;
+        dmhash_t        m_PropertyId;
+        PropertyOptions m_Options;
+        /// Pointer to the value, if the property has one. Writing through it bypasses the setter of the component
+        float*          m_ValuePtr;
+        PropertyType    m_Type;
+        uint16_t        m_ComponentIndex;
+        uint16_t        m_ReadOnly : 1;
+    };
+
+    /**
+     * Resolves a property to a handle
+     * @param instance Instance of the game object
+     * @param component_id Id of the component, or 0 for the properties of the instance
+     * @param property_id Id of the property
+     * @param options Property options
+     * @param out_handle The resolved property
+     * @return PROPERTY_RESULT_OK if the property was found
+     */
+    PropertyResult GetPropertyHandle(HInstance instance, dmhash_t component_id, dmhash_t property_id, PropertyOptions options, PropertyHandle* out_handle);
+
+    /**
+     * Retrieve a property from a resolved handle
+     * @param handle The property
+     * @param out_value Description of the retrieved property value
+     * @return PROPERTY_RESULT_OK if the out-parameters were written
+     */
+    PropertyResult GetProperty(const PropertyHandle& handle, PropertyDesc& out_value);
+
+    /**
+     * Sets the value of a property from a resolved handle
+     * @param handle The property
+     * @param value Value and type of the property
+     * @return PROPERTY_RESULT_OK if the value could be set
+     */
+    PropertyResult SetProperty(const PropertyHandle& handle, const PropertyVar& value);
+
     typedef void (*AnimationStopped)(dmGameObject::HInstance instance, dmhash_t component_id, dmhash_t property_id,
                                         bool finished, void* userdata1, void* userdata2);
 
@@ -363,6 +552,13 @@ namespace dmGameObject
      */
     void CancelAnimationCallbacks(HCollection collection, void* userdata1);
 
+    /**
+     * Checks if any collection in the register has running property animations (see Animate)
+     * @param regist Register
+     * @return true if there are animations running
+     */
+    bool HasAnimations(HRegister regist);
+
     struct ModuleContext
     {
         dmArray<dmScript::HContext> m_ScriptContexts;
@@ -391,6 +587,43 @@ namespace dmGameObject
      * tracked by the collection, e.g resource.release(id) has been called
      */
     void RemoveDynamicResourceHash(HCollection collection, dmhash_t resource_hash);
+
+    /*
+     * Scene profile
+     * Accumulates the number of calls and the time spent in the functions of each component type, per collection,
+     * and in the Lua callbacks of each game object script file. It's disabled by default, since every call is timed.
+     */
+    enum SceneProfileFunction
+    {
+        SCENE_PROFILE_FUNCTION_UPDATE,
+        SCENE_PROFILE_FUNCTION_FIXED_UPDATE,
+        SCENE_PROFILE_FUNCTION_POST_UPDATE,
+        SCENE_PROFILE_FUNCTION_RENDER,
+        SCENE_PROFILE_FUNCTION_ON_MESSAGE,
+        SCENE_PROFILE_FUNCTION_COUNT
+    };
+
+    struct SceneProfileStats
+    {
+        uint64_t m_Time[SCENE_PROFILE_FUNCTION_COUNT];  // In microseconds
+        uint32_t m_Count[SCENE_PROFILE_FUNCTION_COUNT];
+    };
+
+    // Returns the name used for the function in the reports, e.g. "fixed_update"
+    const char* GetSceneProfileFunctionName(SceneProfileFunction function);
+
+    void SetSceneProfileEnabled(HRegister regist, bool enabled);
+    bool IsSceneProfileEnabled(HRegister regist);
+    // Clears the accumulated stats
+    void ResetSceneProfile(HRegister regist);
+
+    typedef void (*FSceneProfileComponentCallback)(void* ctx, dmhash_t collection_id, const char* component_type, const SceneProfileStats* stats);
+    typedef void (*FSceneProfileScriptCallback)(void* ctx, const char* script, const SceneProfileStats* stats);
+
+    // Calls the callback for each component type with any calls, in each collection
+    void IterateSceneProfileComponents(HRegister regist, FSceneProfileComponentCallback callback, void* ctx);
+    // Calls the callback for each script file with any calls
+    void IterateSceneProfileScripts(HRegister regist, FSceneProfileScriptCallback callback, void* ctx);
 }
 
 #endif // DM_GAMEOBJECT_H
@@ -38,6 +38,7 @@ namespace dmGameObject
         ComponentTypeSetFixedUpdateFn(type, CompScriptFixedUpdate);
         ComponentTypeSetOnMessageFn(type, CompScriptOnMessage);
         ComponentTypeSetOnInputFn(type, CompScriptOnInput);
+        ComponentTypeSetOnInputBatchFn(type, CompScriptOnInputBatch);
         ComponentTypeSetOnReloadFn(type, CompScriptOnReload);
         ComponentTypeSetSetPropertiesFn(type, CompScriptSetProperties);
         ComponentTypeSetGetPropertyFn(type, CompScriptGetProperty);
@@ -15,9 +15,11 @@
 #ifndef GAMEOBJECT_COMMON_H
 #define GAMEOBJECT_COMMON_H
 
+#include <dlib/flat_hashtable.h>
 #include <dlib/hash.h>
 #include <dlib/hashtable.h>
 #include <dlib/index_pool.h>
+#include <dlib/job_thread.h>
 #include <dlib/math.h>
 #include <dlib/mutex.h>
 #include <dlib/transform.h>
@@ -85,8 +87,20 @@ namespace dmGameObject
         dmArray<void*> m_PropertyResources;
     };
 
-    // Invalid instance index. Implies that maximum number of instances is 32766 (ie 0x7fff - 1)
-    const uint32_t INVALID_INSTANCE_INDEX = 0x7fff;
+    // Instance indices are 15 bits by default, which caps a collection at 32766 instances.
+    // Build with DM_GAMEOBJECT_WIDE_INDICES to use 31 bit indices for very large collections.
+#if defined(DM_GAMEOBJECT_WIDE_INDICES)
+    typedef uint32_t        InstanceIndex;
+    typedef dmIndexPool32   InstanceIndexPool;
+    const uint32_t INSTANCE_INDEX_BITS = 31;
+#else
+    typedef uint16_t        InstanceIndex;
+    typedef dmIndexPool16   InstanceIndexPool;
+    const uint32_t INSTANCE_INDEX_BITS = 15;
+#endif
+
+    // Invalid instance index. Implies that maximum number of instances is INVALID_INSTANCE_INDEX - 1
+    const uint32_t INVALID_INSTANCE_INDEX = (1U << INSTANCE_INDEX_BITS) - 1;
 
     // NOTE: Actual size of Instance is sizeof(Instance) + sizeof(uintptr_t) * m_UserDataCount
     struct Instance
@@ -98,6 +112,7 @@ namespace dmGameObject
             m_EulerRotation = Vector3(0.0f, 0.0f, 0.0f);
             m_PrevEulerRotation = Vector3(0.0f, 0.0f, 0.0f);
             m_Prototype = prototype;
+            m_Pool = 0;
             m_IdentifierIndex = INVALID_INSTANCE_POOL_INDEX;
             m_Identifier = UNNAMED_IDENTIFIER;
             dmHashInit64(&m_CollectionPathHashState, false);
@@ -106,6 +121,7 @@ namespace dmGameObject
             m_ScaleAlongZ = 0;
             m_Bone = 0;
             m_Generated = 0;
+            m_InputFiltered = 0;
             m_Parent = INVALID_INSTANCE_INDEX;
             m_Index = INVALID_INSTANCE_INDEX;
             m_LevelIndex = INVALID_INSTANCE_INDEX;
@@ -121,23 +137,39 @@ namespace dmGameObject
         {
         }
 
+        // The fields are ordered by access frequency: the transform and the scene graph links used by
+        // UpdateTransforms and the update lists come first, identifiers and hash state last.
+
         dmTransform::Transform m_Transform;
 
-        // Shadowed rotation expressed in euler coordinates
-        Vector3 m_EulerRotation;
-        // Previous euler rotation, used to detect if the euler rotation has changed and should overwrite the real rotation (needed by animation)
-        Vector3 m_PrevEulerRotation;
-        // Collection this instances belongs to. Added for GetWorldPosition.
-        // We should consider to remove this (memory footprint)
-        struct Collection* m_Collection;
-        Prototype*      m_Prototype;
+        // Index to parent
+        InstanceIndex   m_Parent : INSTANCE_INDEX_BITS;
+        InstanceIndex   m_Pad3 : 1;
 
-        uint32_t        m_IdentifierIndex;
-        dmhash_t        m_Identifier;
+        // Index to Collection::m_Instances
+        InstanceIndex   m_Index : INSTANCE_INDEX_BITS;
+        // Used for deferred deletion
+        InstanceIndex   m_ToBeDeleted : 1;
 
-        // Collection path hash-state. Used for calculating global identifiers. Contains the hash-state for the collection-path to the instance.
-        // We might, in the future, for memory reasons, move this hash-state to a data-structure shared among all instances from the same collection.
-        HashState64     m_CollectionPathHashState;
+        // Index to Collection::m_LevelIndex. Index is relative to current level (m_Depth), eg first object in level L always has level-index 0
+        // Level-index is used to reorder Collection::m_LevelIndex entries in O(1). Given an instance we need to find where the
+        // instance index is located in Collection::m_LevelIndex
+        InstanceIndex   m_LevelIndex : INSTANCE_INDEX_BITS;
+        InstanceIndex   m_Pad2 : 1;
+
+        // Next sibling index. Index to Collection::m_Instances
+        InstanceIndex   m_SiblingIndex : INSTANCE_INDEX_BITS;
+        InstanceIndex   m_ToBeAdded : 1;
+
+        // First child index. Index to Collection::m_Instances
+        InstanceIndex   m_FirstChildIndex : INSTANCE_INDEX_BITS;
+        InstanceIndex   m_Pad4 : 1;
+
+        // Index to next instance to delete or INVALID_INSTANCE_INDEX
+        InstanceIndex   m_NextToDelete;
+
+        // Index to next instance to add-to-update or INVALID_INSTANCE_INDEX
+        InstanceIndex   m_NextToAdd;
 
         // Hierarchical depth
         uint16_t        m_Depth : 8;
@@ -149,36 +181,30 @@ namespace dmGameObject
         uint16_t        m_Bone : 1;
         // If this is a generated instance, i.e. if the instance id is uniquely generated
         uint16_t        m_Generated : 1;
+        // If the instance has action ids in Collection::m_InputFilter (see SetInputFilter)
+        uint16_t        m_InputFiltered : 1;
         // Padding
-        uint16_t        m_Pad : 4;
+        uint16_t        m_Pad : 3;
 
-        // Index to parent
-        uint16_t        m_Parent : 16;
-
-        // Index to Collection::m_Instances
-        uint16_t        m_Index : 15;
-        // Used for deferred deletion
-        uint16_t        m_ToBeDeleted : 1;
-
-        // Index to Collection::m_LevelIndex. Index is relative to current level (m_Depth), eg first object in level L always has level-index 0
-        // Level-index is used to reorder Collection::m_LevelIndex entries in O(1). Given an instance we need to find where the
-        // instance index is located in Collection::m_LevelIndex
-        uint16_t        m_LevelIndex : 15;
-        uint16_t        m_Pad2 : 1;
+        // Collection this instances belongs to. Added for GetWorldPosition.
+        // We should consider to remove this (memory footprint)
+        struct Collection* m_Collection;
 
-        // Index to next instance to delete or INVALID_INSTANCE_INDEX
-        uint16_t        m_NextToDelete : 16;
+        // Shadowed rotation expressed in euler coordinates
+        Vector3 m_EulerRotation;
+        // Previous euler rotation, used to detect if the euler rotation has changed and should overwrite the real rotation (needed by animation)
+        Vector3 m_PrevEulerRotation;
 
-        // Index to next instance to add-to-update or INVALID_INSTANCE_INDEX
-        uint16_t        m_NextToAdd;
+        Prototype*      m_Prototype;
+        // The pool the instance memory came from, see NewInstancePool. Pooled instances don't hold a reference to the prototype
+        struct InstancePool* m_Pool;
 
-        // Next sibling index. Index to Collection::m_Instances
-        uint16_t        m_SiblingIndex : 15;
-        uint16_t        m_ToBeAdded : 1;
+        uint32_t        m_IdentifierIndex;
+        dmhash_t        m_Identifier;
 
-        // First child index. Index to Collection::m_Instances
-        uint16_t        m_FirstChildIndex : 15;
-        uint16_t        m_Pad4 : 1;
+        // Collection path hash-state. Used for calculating global identifiers. Contains the hash-state for the collection-path to the instance.
+        // We might, in the future, for memory reasons, move this hash-state to a data-structure shared among all instances from the same collection.
+        HashState64     m_CollectionPathHashState;
 
         uint32_t        m_ComponentInstanceUserDataCount;
         uintptr_t       m_ComponentInstanceUserData[0];
@@ -189,6 +215,12 @@ namespace dmGameObject
 
     #define DM_GAMEOBJECT_CURRENT_IDENTIFIER_PATH_MAX (512)
 
+    struct ScriptProfileEntry
+    {
+        char*             m_Filename;
+        SceneProfileStats m_Stats;
+    };
+
     struct Register
     {
         uint32_t                    m_ComponentTypeCount;
@@ -201,6 +233,16 @@ namespace dmGameObject
         // Default capacity of collections
         uint32_t                    m_DefaultCollectionCapacity;
         uint32_t                    m_DefaultInputStackCapacity;
+        // Optional. Used for updating the transforms of large collections in parallel
+        dmJobThread::HContext       m_JobThread;
+
+        // The stats of the scene profile, per script file (see SetSceneProfileEnabled)
+        dmHashTable64<ScriptProfileEntry> m_ScriptProfile;
+        bool                        m_SceneProfileEnabled;
+        // See SetInputBatchDispatch
+        bool                        m_InputBatchDispatch;
+        // See SetDeterministic
+        bool                        m_Deterministic;
 
         Register();
         ~Register();
@@ -235,7 +277,7 @@ namespace dmGameObject
         dmArray<Instance*>       m_Instances;
 
         // Index pool for mapping Instance::m_Index to m_Instances
-        dmIndexPool16            m_InstanceIndices;
+        InstanceIndexPool        m_InstanceIndices;
 
         // Resources referenced through property overrides inside the collection
         dmArray<void*>           m_PropertyResources;
@@ -245,17 +287,21 @@ namespace dmGameObject
         // Two dimensional table of indices with stride "max_instances"
         // Level 0 contains root-nodes in [0..m_LevelIndices[0].Size()-1]
         // Level 1 contains level 1 indices in [0..m_LevelIndices[1].Size()-1]
-        dmArray<uint16_t>        m_LevelIndices[MAX_HIERARCHICAL_DEPTH];
+        dmArray<InstanceIndex>   m_LevelIndices[MAX_HIERARCHICAL_DEPTH];
 
         // Array of world transforms. Calculated using m_LevelIndices above
         dmArray<Matrix4>         m_WorldTransforms;
 
         // Identifier to Instance mapping
-        dmHashTable64<Instance*> m_IDToInstance;
+        dmFlatHashTable64<Instance*> m_IDToInstance;
 
         // Stack keeping track of which instance has the input focus
         dmArray<Instance*>       m_InputFocusStack;
 
+        // The action ids that each filtered instance listens to, keyed on the action id mixed with the instance index.
+        // The value is the instance index.
+        dmFlatHashTable64<uint16_t> m_InputFilter;
+
         // Array of dynamically created resources (i.e runtime-only resources)
         dmArray<dmhash_t>        m_DynamicResources;
 
@@ -275,14 +321,21 @@ namespace dmGameObject
         dmIndexPool32            m_InstanceIdPool;
 
         // Head of linked list of instances scheduled for deferred deletion
-        uint16_t                 m_InstancesToDeleteHead;
+        InstanceIndex            m_InstancesToDeleteHead;
         // Tail of the same list, for O(1) appending
-        uint16_t                 m_InstancesToDeleteTail;
+        InstanceIndex            m_InstancesToDeleteTail;
 
         // Head of linked list of instances scheduled to be added to update
-        uint16_t                 m_InstancesToAddHead;
+        InstanceIndex            m_InstancesToAddHead;
         // Tail of the same list, for O(1) appending
-        uint16_t                 m_InstancesToAddTail;
+        InstanceIndex            m_InstancesToAddTail;
+
+        // The stats of the scene profile, one per component type. Allocated when first needed.
+        SceneProfileStats*       m_ProfileStats;
+
+        // The instances of a time sliced init or final, in the order they're visited (see InitSliced)
+        dmArray<InstanceIndex>   m_SlicedOrder;
+        uint32_t                 m_SlicedCursor;
 
         float                    m_FixedAccumTime;  // Accumulated time between fixed updates. Scaled time.
 
@@ -295,6 +348,9 @@ namespace dmGameObject
         uint32_t                 m_DirtyTransforms : 1;
         uint32_t                 m_Initialized : 1;
         uint32_t                 m_FirstUpdate : 1;
+        // Set while a time sliced init or final is in progress
+        uint32_t                 m_SlicedInit : 1;
+        uint32_t                 m_SlicedFinal : 1;
     };
 
     struct CollectionHandle
@@ -302,6 +358,10 @@ namespace dmGameObject
         Collection* m_Collection;
     };
 
+    // Adds a call to the scene profile, that started at start_time (see dmTime::GetTime())
+    void AddComponentProfileSample(Collection* collection, uint32_t type_index, SceneProfileFunction function, uint64_t start_time);
+    void AddScriptProfileSample(HRegister regist, const char* filename, SceneProfileFunction function, uint64_t start_time);
+
     // Used by res_collection.cpp
     HInstance NewInstance(Collection* collection, Prototype* proto, const char* prototype_name);
     HInstance GetInstanceFromIdentifier(Collection* collection, dmhash_t identifier); // TODO: Mostly duplicate: replace with HCollection version
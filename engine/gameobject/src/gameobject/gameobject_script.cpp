@@ -165,7 +165,8 @@ namespace dmGameObject
         "fixed_update",
         "on_message",
         "on_input",
-        "on_reload"
+        "on_reload",
+        "on_input_batch"
     };
 
     static const char* TYPE_NAMES[PROPERTY_TYPE_COUNT] = {
@@ -406,7 +407,7 @@ namespace dmGameObject
     {
         ScriptInstance* i = ScriptInstance_Check(L);
         Instance* instance = i->m_Instance;
-        if (lua_gettop(L) == instance_arg && !lua_isnil(L, instance_arg)) {
+        if (!lua_isnoneornil(L, instance_arg)) {
             dmMessage::URL receiver;
             dmScript::ResolveURL(L, instance_arg, &receiver, 0x0);
             if (receiver.m_Socket != dmGameObject::GetMessageSocket(i->m_Instance->m_Collection->m_HCollection))
@@ -424,6 +425,29 @@ namespace dmGameObject
         return instance;
     }
 
+    // Sets the optional "out" argument to the value and pushes it, or pushes a new vector if there's no such argument
+    static void PushVector3Result(lua_State* L, int out_arg, const dmVMath::Vector3& v)
+    {
+        if (lua_isnoneornil(L, out_arg))
+        {
+            dmScript::PushVector3(L, v);
+            return;
+        }
+        *dmScript::CheckVector3(L, out_arg) = v;
+        lua_pushvalue(L, out_arg);
+    }
+
+    static void PushQuatResult(lua_State* L, int out_arg, const dmVMath::Quat& q)
+    {
+        if (lua_isnoneornil(L, out_arg))
+        {
+            dmScript::PushQuat(L, q);
+            return;
+        }
+        *dmScript::CheckQuat(L, out_arg) = q;
+        lua_pushvalue(L, out_arg);
+    }
+
     void GetComponentFromLua(lua_State* L, int index, HCollection collection, const char* component_ext, dmGameObject::HComponent* out_component, dmMessage::URL* url, dmGameObject::HComponentWorld* out_world)
     {
         dmMessage::URL sender;
@@ -891,12 +915,260 @@ namespace dmGameObject
         return 0;
     }
 
+    static dmhash_t CheckPropertyId(lua_State* L, int index)
+    {
+        if (lua_isstring(L, index))
+        {
+            return dmHashString64(lua_tostring(L, index));
+        }
+        return dmScript::CheckHash(L, index);
+    }
+
+    // Resolves an element of the id table of go.get_many/go.set_many. Hashed ids (as returned by go.get_id and factory.create)
+    // refer to game objects in the same collection, and are looked up without going through the url resolution.
+    static HInstance ResolveBatchInstance(lua_State* L, int index, HCollection collection, dmMessage::HSocket socket, const char* function_name, dmMessage::URL* target)
+    {
+        dmMessage::ResetURL(target);
+        dmhash_t* id = dmScript::ToHash(L, index);
+        if (id != 0)
+        {
+            target->m_Socket = socket;
+            target->m_Path = *id;
+        }
+        else
+        {
+            dmScript::ResolveURL(L, index, target, 0);
+            if (target->m_Socket != socket)
+            {
+                luaL_error(L, "%s can only access instances within the same collection.", function_name);
+                return 0; // Actually never reached
+            }
+        }
+
+        HInstance target_instance = GetInstanceFromIdentifier(collection, target->m_Path);
+        if (target_instance == 0)
+        {
+            DM_HASH_REVERSE_MEM(hash_ctx, 256);
+            luaL_error(L, "Could not find any instance with id '%s'.", dmHashReverseSafe64Alloc(&hash_ctx, target->m_Path));
+            return 0; // Actually never reached
+        }
+        return target_instance;
+    }
+
+    // Stores a vector or quaternion value into an existing value of the same type, instead of creating a new one
+    static bool SetVarInPlace(lua_State* L, int index, const PropertyVar& var)
+    {
+        switch (var.m_Type)
+        {
+        case PROPERTY_TYPE_VECTOR3:
+            {
+                dmVMath::Vector3* v = dmScript::ToVector3(L, index);
+                if (v != 0)
+                {
+                    *v = dmVMath::Vector3(var.m_V4[0], var.m_V4[1], var.m_V4[2]);
+                    return true;
+                }
+            }
+            break;
+        case PROPERTY_TYPE_VECTOR4:
+            {
+                dmVMath::Vector4* v = dmScript::ToVector4(L, index);
+                if (v != 0)
+                {
+                    *v = dmVMath::Vector4(var.m_V4[0], var.m_V4[1], var.m_V4[2], var.m_V4[3]);
+                    return true;
+                }
+            }
+            break;
+        case PROPERTY_TYPE_QUAT:
+            {
+                dmVMath::Quat* q = dmScript::ToQuat(L, index);
+                if (q != 0)
+                {
+                    *q = dmVMath::Quat(var.m_V4[0], var.m_V4[1], var.m_V4[2], var.m_V4[3]);
+                    return true;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+        return false;
+    }
+
+    /*# gets a named property of many game objects or components
+     * Gets the same property of a list of game objects or components in one call. This is faster than calling
+     * [ref:go.get] for each of them, in particular when the ids are hashes.
+     *
+     * If an `out` table is given, the values are stored in it. Vectors and quaternions already in the table
+     * are updated in place, which doesn't create any garbage.
+     *
+     * Array properties are not supported, use [ref:go.get] for those.
+     *
+     * @name go.get_many
+     * @param ids [type:table] list of urls of the game objects or components having the property
+     * @param property [type:string|hash] id of the property to retrieve
+     * @param [out] [type:table] optional table to store the values in
+     * @return values [type:table] the values of the property, in the same order as the ids
+     * @examples
+     *
+     * Get the positions of a swarm of game objects each frame:
+     *
+     * ```lua
+     * function init(self)
+     *     self.ids = {}
+     *     for i=1,100 do
+     *         self.ids[i] = factory.create("#factory")
+     *     end
+     *     self.positions = {}
+     * end
+     *
+     * function update(self, dt)
+     *     go.get_many(self.ids, "position", self.positions)
+     * end
+     * ```
+     */
+    int Script_GetMany(lua_State* L)
+    {
+        ScriptInstance* i = ScriptInstance_Check(L);
+        HCollection collection = dmGameObject::GetCollection(i->m_Instance);
+        dmMessage::HSocket socket = dmGameObject::GetMessageSocket(collection);
+
+        luaL_checktype(L, 1, LUA_TTABLE);
+        dmhash_t property_id = CheckPropertyId(L, 2);
+        lua_settop(L, 3);
+        if (lua_isnil(L, 3))
+        {
+            lua_newtable(L);
+            lua_replace(L, 3);
+        }
+        luaL_checktype(L, 3, LUA_TTABLE);
+
+        dmGameObject::PropertyOptions property_options;
+        property_options.m_Index = 0;
+        property_options.m_HasKey = 0;
+
+        uint32_t count = lua_objlen(L, 1);
+        for (uint32_t n = 1; n <= count; ++n)
+        {
+            lua_rawgeti(L, 1, n);
+            dmMessage::URL target;
+            dmGameObject::HInstance target_instance = ResolveBatchInstance(L, 4, collection, socket, "go.get_many", &target);
+
+            dmGameObject::PropertyDesc property_desc;
+            dmGameObject::PropertyResult result = dmGameObject::GetProperty(target_instance, target.m_Fragment, property_id, property_options, property_desc);
+            if (result == dmGameObject::PROPERTY_RESULT_OK && property_desc.m_ValueType == dmGameObject::PROP_VALUE_ARRAY && property_desc.m_ArrayLength > 1)
+            {
+                DM_HASH_REVERSE_MEM(hash_ctx, 256);
+                return luaL_error(L, "go.get_many does not support the array property '%s', use go.get instead.", dmHashReverseSafe64Alloc(&hash_ctx, property_id));
+            }
+            if (result != dmGameObject::PROPERTY_RESULT_OK)
+            {
+                // Let the error refer to the failing id rather than the id table
+                lua_replace(L, 1);
+                return CheckGetPropertyResult(L, "go", result, property_desc, property_id, target, property_options, false);
+            }
+
+            lua_rawgeti(L, 3, n);
+            if (!SetVarInPlace(L, 5, property_desc.m_Variant))
+            {
+                dmGameObject::LuaPushVar(L, property_desc.m_Variant);
+                lua_rawseti(L, 3, n);
+            }
+            lua_settop(L, 3);
+        }
+        return 1;
+    }
+
+    /*# sets a named property of many game objects or components
+     * Sets the same property of a list of game objects or components in one call. This is faster than calling
+     * [ref:go.set] for each of them, in particular when the ids are hashes.
+     *
+     * The value is either a single value that is set for all of them, or a table with one value for each id.
+     *
+     * @name go.set_many
+     * @param ids [type:table] list of urls of the game objects or components having the property
+     * @param property [type:string|hash] id of the property to set
+     * @param values [type:any|table] the value to set, or a table with the values to set, in the same order as the ids
+     * @examples
+     *
+     * Move a swarm of game objects:
+     *
+     * ```lua
+     * function update(self, dt)
+     *     for i=1,#self.ids do
+     *         vmath.add_to(self.positions[i], self.positions[i], self.velocities[i] * dt)
+     *     end
+     *     go.set_many(self.ids, "position", self.positions)
+     * end
+     * ```
+     *
+     * Tint all the sprites of a swarm:
+     *
+     * ```lua
+     * go.set_many(self.sprites, "tint", vmath.vector4(1, 0, 0, 1))
+     * ```
+     */
+    int Script_SetMany(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+
+        ScriptInstance* i = ScriptInstance_Check(L);
+        HCollection collection = dmGameObject::GetCollection(i->m_Instance);
+        dmMessage::HSocket socket = dmGameObject::GetMessageSocket(collection);
+
+        luaL_checktype(L, 1, LUA_TTABLE);
+        dmhash_t property_id = CheckPropertyId(L, 2);
+        luaL_checkany(L, 3);
+
+        dmGameObject::PropertyOptions property_options = {};
+
+        // A single value is converted once, and set for all instances
+        bool per_instance = lua_istable(L, 3);
+        dmGameObject::PropertyVar property_var;
+        dmGameObject::PropertyResult var_result = dmGameObject::PROPERTY_RESULT_OK;
+        if (!per_instance)
+        {
+            var_result = dmGameObject::LuaToVar(L, 3, property_var);
+        }
+
+        uint32_t count = lua_objlen(L, 1);
+        for (uint32_t n = 1; n <= count; ++n)
+        {
+            lua_rawgeti(L, 1, n);
+            dmMessage::URL target;
+            dmGameObject::HInstance target_instance = ResolveBatchInstance(L, lua_gettop(L), collection, socket, "go.set_many", &target);
+
+            dmGameObject::PropertyResult result = var_result;
+            if (per_instance)
+            {
+                lua_rawgeti(L, 3, n);
+                result = dmGameObject::LuaToVar(L, -1, property_var);
+                lua_pop(L, 1);
+            }
+
+            if (result == PROPERTY_RESULT_OK)
+            {
+                result = dmGameObject::SetProperty(target_instance, target.m_Fragment, property_id, property_options, property_var);
+            }
+            if (result != PROPERTY_RESULT_OK)
+            {
+                // Let the error refer to the failing id rather than the id table
+                lua_replace(L, 1);
+                return HandleGoSetResult(L, result, property_id, target_instance, target, property_options);
+            }
+            lua_pop(L, 1);
+        }
+        return 0;
+    }
+
     /*# gets the position of a game object instance
      * The position is relative the parent (if any). Use [ref:go.get_world_position] to retrieve the global world position.
      *
      * @name go.get_position
      * @replaces request_transform transform_response
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the position for, by default the instance of the calling script
+     * @param [out] [type:vector3] optional vector3 that is set to the position and returned, instead of creating a new one
      * @return position [type:vector3] instance position
      * @examples
      *
@@ -911,11 +1183,23 @@ namespace dmGameObject
      * ```lua
      * local pos = go.get_position("my_gameobject")
      * ```
+     *
+     * Get the position into an existing vector, which doesn't create any garbage:
+     *
+     * ```lua
+     * function init(self)
+     *     self.position = vmath.vector3()
+     * end
+     *
+     * function update(self, dt)
+     *     go.get_position(nil, self.position)
+     * end
+     * ```
      */
     int Script_GetPosition(lua_State* L)
     {
         Instance* instance = ResolveInstance(L, 1);
-        dmScript::PushVector3(L, dmVMath::Vector3(dmGameObject::GetPosition(instance)));
+        PushVector3Result(L, 2, dmVMath::Vector3(dmGameObject::GetPosition(instance)));
         return 1;
     }
 
@@ -924,6 +1208,7 @@ namespace dmGameObject
      *
      * @name go.get_rotation
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the rotation for, by default the instance of the calling script
+     * @param [out] [type:quaternion] optional quaternion that is set to the rotation and returned, instead of creating a new one
      * @return rotation [type:quaternion] instance rotation
      * @examples
      *
@@ -942,7 +1227,7 @@ namespace dmGameObject
     int Script_GetRotation(lua_State* L)
     {
         Instance* instance = ResolveInstance(L, 1);
-        dmScript::PushQuat(L, dmGameObject::GetRotation(instance));
+        PushQuatResult(L, 2, dmGameObject::GetRotation(instance));
         return 1;
     }
 
@@ -951,6 +1236,7 @@ namespace dmGameObject
      *
      * @name go.get_scale
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the scale for, by default the instance of the calling script
+     * @param [out] [type:vector3] optional vector3 that is set to the scale and returned, instead of creating a new one
      * @return scale [type:vector3] instance scale factor
      * @examples
      *
@@ -969,7 +1255,7 @@ namespace dmGameObject
     static int Script_GetScale(lua_State* L)
     {
         Instance* instance = ResolveInstance(L, 1);
-        dmScript::PushVector3(L, dmGameObject::GetScale(instance));
+        PushVector3Result(L, 2, dmGameObject::GetScale(instance));
         return 1;
     }
 
@@ -1279,6 +1565,7 @@ namespace dmGameObject
      *
      * @name go.get_world_position
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the world position for, by default the instance of the calling script
+     * @param [out] [type:vector3] optional vector3 that is set to the world position and returned, instead of creating a new one
      * @return position [type:vector3] instance world position
      * @examples
      *
@@ -1297,7 +1584,7 @@ namespace dmGameObject
     int Script_GetWorldPosition(lua_State* L)
     {
         Instance* instance = ResolveInstance(L, 1);
-        dmScript::PushVector3(L, dmVMath::Vector3(dmGameObject::GetWorldPosition(instance)));
+        PushVector3Result(L, 2, dmVMath::Vector3(dmGameObject::GetWorldPosition(instance)));
         return 1;
     }
 
@@ -1307,6 +1594,7 @@ namespace dmGameObject
      *
      * @name go.get_world_rotation
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the world rotation for, by default the instance of the calling script
+     * @param [out] [type:quaternion] optional quaternion that is set to the world rotation and returned, instead of creating a new one
      * @return rotation [type:quaternion] instance world rotation
      * @examples
      *
@@ -1325,7 +1613,7 @@ namespace dmGameObject
     int Script_GetWorldRotation(lua_State* L)
     {
         Instance* instance = ResolveInstance(L, 1);
-        dmScript::PushQuat(L, dmGameObject::GetWorldRotation(instance));
+        PushQuatResult(L, 2, dmGameObject::GetWorldRotation(instance));
         return 1;
     }
 
@@ -1337,6 +1625,7 @@ namespace dmGameObject
      *
      * @name go.get_world_scale
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the world scale for, by default the instance of the calling script
+     * @param [out] [type:vector3] optional vector3 that is set to the world scale and returned, instead of creating a new one
      * @return scale [type:vector3] instance world 3D scale factor
      * @examples
      *
@@ -1355,7 +1644,7 @@ namespace dmGameObject
     int Script_GetWorldScale(lua_State* L)
     {
         Instance* instance = ResolveInstance(L, 1);
-        dmScript::PushVector3(L, dmGameObject::GetWorldScale(instance));
+        PushVector3Result(L, 2, dmGameObject::GetWorldScale(instance));
         return 1;
     }
 
@@ -2097,6 +2386,51 @@ namespace dmGameObject
     }
 
 
+    /*# sets the actions that the game object listens to
+     *
+     * Limits the input actions dispatched to the game object to the given action ids.
+     * Listeners with a filter are skipped for all other actions, without calling
+     * `on_input`, and they don't get the actions without an id (mouse movement).
+     * The filter applies to all the components of the game object.
+     *
+     * @name go.set_input_filter
+     * @param [action_ids] [type:table] list of action ids (hash or string) to listen to, or nil to remove the filter
+     *
+     * @examples
+     *
+     * ```lua
+     * function init(self)
+     *     msg.post(".", "acquire_input_focus")
+     *     go.set_input_filter({ "jump", hash("fire") })
+     * end
+     * ```
+     */
+    int Script_SetInputFilter(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+        ScriptInstance* i = ScriptInstance_Check(L);
+
+        if (lua_isnoneornil(L, 1))
+        {
+            dmGameObject::SetInputFilter(i->m_Instance, 0, 0);
+            return 0;
+        }
+
+        luaL_checktype(L, 1, LUA_TTABLE);
+        uint32_t count = (uint32_t) lua_objlen(L, 1);
+        dmArray<dmhash_t> action_ids;
+        action_ids.SetCapacity(count);
+        for (uint32_t a = 0; a < count; ++a)
+        {
+            lua_rawgeti(L, 1, a + 1);
+            action_ids.Push(dmScript::CheckHashOrString(L, -1));
+            lua_pop(L, 1);
+        }
+        dmGameObject::SetInputFilter(i->m_Instance, action_ids.Begin(), action_ids.Size());
+        return 0;
+    }
+
+
     /*# convert position to game object's coordinate space
     * [icon:attention] The function uses world transformation calculated at the end of previous frame.
     *
@@ -2160,6 +2494,8 @@ namespace dmGameObject
     {
         {"get",                     Script_Get},
         {"set",                     Script_Set},
+        {"get_many",                Script_GetMany},
+        {"set_many",                Script_SetMany},
         {"get_position",            Script_GetPosition},
         {"get_rotation",            Script_GetRotation},
         {"get_scale",               Script_GetScale},
@@ -2182,6 +2518,7 @@ namespace dmGameObject
         {"delete_all",              Script_DeleteAll},
         {"property",                Script_Property},
         {"exists",                  Script_Exists},
+        {"set_input_filter",        Script_SetInputFilter},
         {"world_to_local_position", Script_WorldToLocalPosition},
         {"world_to_local_transform",Script_WorldToLocalTransfrom},
         {0, 0}
@@ -2811,6 +3148,7 @@ bail:
      * `pressed`   | If the input was pressed this frame. This is not present for mouse movement.
      * `released`  | If the input was released this frame. This is not present for mouse movement.
      * `repeated`  | If the input was repeated this frame. This is similar to how a key on a keyboard is repeated when you hold it down. This is not present for mouse movement.
+     * `timestamp` | Time in seconds, on the same clock as `socket.gettime()`, when the state of a bound key or mouse button last changed. Only present for key and mouse button input.
      * `x`         | The x value of a pointer device, if present.
      * `y`         | The y value of a pointer device, if present.
      * `screen_x`  | The screen space x value of a pointer device, if present.
@@ -51,6 +51,7 @@ namespace dmGameObject
         SCRIPT_FUNCTION_ONMESSAGE,
         SCRIPT_FUNCTION_ONINPUT,
         SCRIPT_FUNCTION_ONRELOAD,
+        SCRIPT_FUNCTION_ONINPUT_BATCH,
         MAX_SCRIPT_FUNCTION_COUNT
     };
 
@@ -0,0 +1,168 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "gameobject_transform_batch.h"
+#include <assert.h>
+#include <math.h>
+#include <dlib/static_assert.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define DM_TRANSFORM_BATCH_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define DM_TRANSFORM_BATCH_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace dmGameObject
+{
+#if defined(DM_TRANSFORM_BATCH_SSE2)
+    typedef __m128 Vec4f;
+    static inline Vec4f Load(const float* p)        { return _mm_loadu_ps(p); }
+    static inline void  Store(float* p, Vec4f v)    { _mm_storeu_ps(p, v); }
+    static inline Vec4f Splat(float f)              { return _mm_set1_ps(f); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)       { return _mm_add_ps(a, b); }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)       { return _mm_sub_ps(a, b); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)       { return _mm_mul_ps(a, b); }
+#elif defined(DM_TRANSFORM_BATCH_NEON)
+    typedef float32x4_t Vec4f;
+    static inline Vec4f Load(const float* p)        { return vld1q_f32(p); }
+    static inline void  Store(float* p, Vec4f v)    { vst1q_f32(p, v); }
+    static inline Vec4f Splat(float f)              { return vdupq_n_f32(f); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)       { return vaddq_f32(a, b); }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)       { return vsubq_f32(a, b); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)       { return vmulq_f32(a, b); }
+#else
+    struct Vec4f { float v[4]; };
+    static inline Vec4f Load(const float* p)        { Vec4f r; for (int i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+    static inline void  Store(float* p, Vec4f v)    { for (int i = 0; i < 4; ++i) p[i] = v.v[i]; }
+    static inline Vec4f Splat(float f)              { Vec4f r; for (int i = 0; i < 4; ++i) r.v[i] = f; return r; }
+    static inline Vec4f Add(Vec4f a, Vec4f b)       { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)       { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)       { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+#endif
+
+    // a * b + c
+    static inline Vec4f MulAdd(Vec4f a, Vec4f b, Vec4f c)
+    {
+        return Add(Mul(a, b), c);
+    }
+
+    // The scaled rotation part of the local matrices, column major
+    struct LocalMatrixBatch
+    {
+        float DM_ALIGNED(16) m_M[9][TRANSFORM_BATCH_SIZE];
+    };
+
+    static void PadBatch(LocalTransformBatch* batch, uint32_t count)
+    {
+        // Identity transforms, so that the unused lanes don't compute on garbage
+        for (uint32_t i = count; i < ((count + 3) & ~3U); ++i)
+        {
+            batch->m_PositionX[i] = batch->m_PositionY[i] = batch->m_PositionZ[i] = 0.0f;
+            batch->m_RotationX[i] = batch->m_RotationY[i] = batch->m_RotationZ[i] = 0.0f;
+            batch->m_RotationW[i] = 1.0f;
+            batch->m_ScaleX[i] = batch->m_ScaleY[i] = batch->m_ScaleZ[i] = 1.0f;
+        }
+    }
+
+    // Same as Matrix4(rotation, translation) followed by appendScale(scale), for 4 transforms at a time
+    static void ToLocalMatrices(const LocalTransformBatch* batch, uint32_t count, LocalMatrixBatch* local)
+    {
+        const Vec4f one = Splat(1.0f);
+        for (uint32_t i = 0; i < count; i += 4)
+        {
+            Vec4f qx = Load(&batch->m_RotationX[i]);
+            Vec4f qy = Load(&batch->m_RotationY[i]);
+            Vec4f qz = Load(&batch->m_RotationZ[i]);
+            Vec4f qw = Load(&batch->m_RotationW[i]);
+            Vec4f sx = Load(&batch->m_ScaleX[i]);
+            Vec4f sy = Load(&batch->m_ScaleY[i]);
+            Vec4f sz = Load(&batch->m_ScaleZ[i]);
+
+            Vec4f qx2 = Add(qx, qx);
+            Vec4f qy2 = Add(qy, qy);
+            Vec4f qz2 = Add(qz, qz);
+            Vec4f qxqx2 = Mul(qx, qx2);
+            Vec4f qxqy2 = Mul(qx, qy2);
+            Vec4f qxqz2 = Mul(qx, qz2);
+            Vec4f qxqw2 = Mul(qw, qx2);
+            Vec4f qyqy2 = Mul(qy, qy2);
+            Vec4f qyqz2 = Mul(qy, qz2);
+            Vec4f qyqw2 = Mul(qw, qy2);
+            Vec4f qzqz2 = Mul(qz, qz2);
+            Vec4f qzqw2 = Mul(qw, qz2);
+
+            Store(&local->m_M[0][i], Mul(Sub(Sub(one, qyqy2), qzqz2), sx));
+            Store(&local->m_M[1][i], Mul(Add(qxqy2, qzqw2), sx));
+            Store(&local->m_M[2][i], Mul(Sub(qxqz2, qyqw2), sx));
+            Store(&local->m_M[3][i], Mul(Sub(qxqy2, qzqw2), sy));
+            Store(&local->m_M[4][i], Mul(Sub(Sub(one, qxqx2), qzqz2), sy));
+            Store(&local->m_M[5][i], Mul(Add(qyqz2, qxqw2), sy));
+            Store(&local->m_M[6][i], Mul(Add(qxqz2, qyqw2), sz));
+            Store(&local->m_M[7][i], Mul(Sub(qyqz2, qxqw2), sz));
+            Store(&local->m_M[8][i], Mul(Sub(Sub(one, qxqx2), qyqy2), sz));
+        }
+    }
+
+    DM_STATIC_ASSERT(sizeof(dmVMath::Matrix4) == 16 * sizeof(float), Invalid_Matrix4_Size);
+
+    void ComposeTransformBatch(LocalTransformBatch* batch, uint32_t count, const dmVMath::Matrix4* const* parents, dmVMath::Matrix4* const* out, bool scale_along_z)
+    {
+        assert(count <= TRANSFORM_BATCH_SIZE);
+
+        PadBatch(batch, count);
+
+        LocalMatrixBatch local;
+        ToLocalMatrices(batch, count, &local);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            float* o = (float*) out[i];
+            const float px = batch->m_PositionX[i];
+            const float py = batch->m_PositionY[i];
+            const float pz = batch->m_PositionZ[i];
+
+            if (parents == 0)
+            {
+                o[0]  = local.m_M[0][i]; o[1]  = local.m_M[1][i]; o[2]  = local.m_M[2][i]; o[3]  = 0.0f;
+                o[4]  = local.m_M[3][i]; o[5]  = local.m_M[4][i]; o[6]  = local.m_M[5][i]; o[7]  = 0.0f;
+                o[8]  = local.m_M[6][i]; o[9]  = local.m_M[7][i]; o[10] = local.m_M[8][i]; o[11] = 0.0f;
+                o[12] = px;              o[13] = py;              o[14] = pz;              o[15] = 1.0f;
+                continue;
+            }
+
+            const float* p = (const float*) parents[i];
+            Vec4f c0 = Load(p);
+            Vec4f c1 = Load(p + 4);
+            Vec4f c2 = Load(p + 8);
+            Vec4f c3 = Load(p + 12);
+
+            Store(o,     MulAdd(c0, Splat(local.m_M[0][i]), MulAdd(c1, Splat(local.m_M[1][i]), Mul(c2, Splat(local.m_M[2][i])))));
+            Store(o + 4, MulAdd(c0, Splat(local.m_M[3][i]), MulAdd(c1, Splat(local.m_M[4][i]), Mul(c2, Splat(local.m_M[5][i])))));
+            Store(o + 8, MulAdd(c0, Splat(local.m_M[6][i]), MulAdd(c1, Splat(local.m_M[7][i]), Mul(c2, Splat(local.m_M[8][i])))));
+
+            // See dmTransform::MulNoScaleZ, the translation uses the parent with a normalized z axis
+            if (!scale_along_z)
+            {
+                float len_sqr = p[8] * p[8] + p[9] * p[9] + p[10] * p[10] + p[11] * p[11];
+                if (len_sqr > 0.0f)
+                {
+                    c2 = Mul(c2, Splat(1.0f / sqrtf(len_sqr)));
+                }
+            }
+            Store(o + 12, MulAdd(c0, Splat(px), MulAdd(c1, Splat(py), MulAdd(c2, Splat(pz), c3))));
+        }
+    }
+}
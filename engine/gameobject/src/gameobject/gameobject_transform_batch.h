@@ -0,0 +1,51 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_GAMEOBJECT_TRANSFORM_BATCH_H
+#define DM_GAMEOBJECT_TRANSFORM_BATCH_H
+
+#include <stdint.h>
+#include <dmsdk/dlib/align.h>
+#include <dmsdk/dlib/vmath.h>
+
+namespace dmGameObject
+{
+    // Number of local transforms gathered per batch. Must be a multiple of 4
+    const uint32_t TRANSFORM_BATCH_SIZE = 64;
+
+    // Local transforms in structure-of-arrays layout, so that they can be converted to matrices 4 at a time
+    struct LocalTransformBatch
+    {
+        float DM_ALIGNED(16) m_PositionX[TRANSFORM_BATCH_SIZE];
+        float DM_ALIGNED(16) m_PositionY[TRANSFORM_BATCH_SIZE];
+        float DM_ALIGNED(16) m_PositionZ[TRANSFORM_BATCH_SIZE];
+        float DM_ALIGNED(16) m_RotationX[TRANSFORM_BATCH_SIZE];
+        float DM_ALIGNED(16) m_RotationY[TRANSFORM_BATCH_SIZE];
+        float DM_ALIGNED(16) m_RotationZ[TRANSFORM_BATCH_SIZE];
+        float DM_ALIGNED(16) m_RotationW[TRANSFORM_BATCH_SIZE];
+        float DM_ALIGNED(16) m_ScaleX[TRANSFORM_BATCH_SIZE];
+        float DM_ALIGNED(16) m_ScaleY[TRANSFORM_BATCH_SIZE];
+        float DM_ALIGNED(16) m_ScaleZ[TRANSFORM_BATCH_SIZE];
+    };
+
+    /*
+     * Computes out[i] = parents[i] * ToMatrix4(local i) for each of the count (<= TRANSFORM_BATCH_SIZE) transforms in the batch.
+     * If parents is 0, the local matrices are written as is (root instances).
+     * If scale_along_z is false, the translation is not affected by the parent z scale (see dmTransform::MulNoScaleZ).
+     * The batch is padded up to a multiple of 4 in place. Uses SSE2 or NEON where available.
+     */
+    void ComposeTransformBatch(LocalTransformBatch* batch, uint32_t count, const dmVMath::Matrix4* const* parents, dmVMath::Matrix4* const* out, bool scale_along_z);
+}
+
+#endif // DM_GAMEOBJECT_TRANSFORM_BATCH_H
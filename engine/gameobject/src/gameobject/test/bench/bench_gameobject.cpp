@@ -0,0 +1,222 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <testmain/testmain.h> // TestMainPlatformInit
+#include <ddf/ddf.h>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+#include <stdint.h>
+
+#include <dlib/array.h>
+#include <dlib/benchmark.h>
+#include <dlib/hash.h>
+#include <dlib/job_thread.h>
+
+#include "../gameobject.h"
+#include "../gameobject_private.h"
+
+#include <dmsdk/resource/resource.h>
+
+using namespace dmVMath;
+
+class GameObjectBench : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        m_UpdateContext.m_DT = 1.0f / 60.0f;
+
+        dmResource::NewFactoryParams params;
+        params.m_MaxResources = 16;
+        params.m_Flags = RESOURCE_FACTORY_FLAGS_EMPTY;
+        m_Factory = dmResource::NewFactory(&params, "build/src/gameobject/test/bench");
+        dmScript::ContextParams script_context_params = {};
+        m_ScriptContext = dmScript::NewContext(script_context_params);
+        dmScript::Initialize(m_ScriptContext);
+        m_Register = dmGameObject::NewRegister();
+        dmGameObject::Initialize(m_Register, m_ScriptContext);
+
+        m_Contexts.SetCapacity(7,16);
+        m_Contexts.Put(dmHashString64("goc"), m_Register);
+        m_Contexts.Put(dmHashString64("collectionc"), m_Register);
+        m_Contexts.Put(dmHashString64("scriptc"), m_ScriptContext);
+        m_Contexts.Put(dmHashString64("luac"), &m_ModuleContext);
+        dmResource::RegisterTypes(m_Factory, &m_Contexts);
+
+        dmGameObject::ComponentTypeCreateCtx component_create_ctx = {};
+        component_create_ctx.m_Script = m_ScriptContext;
+        component_create_ctx.m_Register = m_Register;
+        component_create_ctx.m_Factory = m_Factory;
+        dmGameObject::CreateRegisteredComponentTypes(&component_create_ctx);
+        dmGameObject::SortComponentTypes(m_Register);
+
+        m_Collection = dmGameObject::NewCollection("collection", m_Factory, m_Register, MAX_INSTANCES, 0x0);
+    }
+
+    virtual void TearDown()
+    {
+        dmGameObject::DeleteCollection(m_Collection);
+        dmGameObject::PostUpdate(m_Register);
+        dmScript::Finalize(m_ScriptContext);
+        dmScript::DeleteContext(m_ScriptContext);
+        dmResource::DeleteFactory(m_Factory);
+        dmGameObject::DeleteRegister(m_Register);
+    }
+
+    void BenchUpdateTransforms(const char* name, uint32_t root_count);
+
+public:
+    static const uint32_t MAX_INSTANCES = 16384;
+
+    dmScript::HContext m_ScriptContext;
+    dmGameObject::UpdateContext m_UpdateContext;
+    dmGameObject::HRegister m_Register;
+    dmGameObject::HCollection m_Collection;
+    dmResource::HFactory m_Factory;
+    dmGameObject::ModuleContext m_ModuleContext;
+    dmHashTable64<void*> m_Contexts;
+};
+
+TEST_F(GameObjectBench, SpawnDelete)
+{
+    const uint32_t count = 1000;
+    dmGameObject::HPrototype prototype = 0x0;
+    ASSERT_EQ(dmResource::RESULT_OK, dmResource::Get(m_Factory, "/empty.goc", (void**)&prototype));
+
+    dmArray<dmGameObject::HInstance> instances;
+    instances.SetCapacity(count);
+    for (dmBenchmark::Run run("gameobject.spawn_delete", 20, count); run.Next(); )
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t index = dmGameObject::AcquireInstanceIndex(m_Collection);
+            dmhash_t id = dmGameObject::ConstructInstanceId(index);
+            dmGameObject::HInstance instance = dmGameObject::Spawn(m_Collection, prototype, "/empty.goc", id, 0, Point3((float)i, 0, 0), Quat::identity(), Vector3(1, 1, 1));
+            dmGameObject::AssignInstanceIndex(index, instance);
+            instances.Push(instance);
+        }
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            dmGameObject::Delete(m_Collection, instances[i], false);
+        }
+        instances.SetSize(0);
+        dmGameObject::PostUpdate(m_Collection);
+    }
+
+    dmResource::Release(m_Factory, prototype);
+}
+
+TEST_F(GameObjectBench, SpawnBatchDelete)
+{
+    const uint32_t count = 1000;
+    dmGameObject::HPrototype prototype = 0x0;
+    ASSERT_EQ(dmResource::RESULT_OK, dmResource::Get(m_Factory, "/empty.goc", (void**)&prototype));
+
+    dmArray<uint32_t> indices;
+    dmArray<dmhash_t> ids;
+    dmArray<Point3> positions;
+    dmArray<Quat> rotations;
+    dmArray<Vector3> scales;
+    dmArray<dmGameObject::HInstance> instances;
+    indices.SetCapacity(count); indices.SetSize(count);
+    ids.SetCapacity(count); ids.SetSize(count);
+    positions.SetCapacity(count); positions.SetSize(count);
+    rotations.SetCapacity(count); rotations.SetSize(count);
+    scales.SetCapacity(count); scales.SetSize(count);
+    instances.SetCapacity(count); instances.SetSize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        positions[i] = Point3((float)i, 0, 0);
+        rotations[i] = Quat::identity();
+        scales[i] = Vector3(1, 1, 1);
+    }
+
+    for (dmBenchmark::Run run("gameobject.spawn_batch_delete", 20, count); run.Next(); )
+    {
+        dmGameObject::AcquireInstanceIndices(m_Collection, count, indices.Begin());
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            ids[i] = dmGameObject::ConstructInstanceId(indices[i]);
+        }
+        dmGameObject::SpawnBatch(m_Collection, prototype, "/empty.goc", count, ids.Begin(), 0, positions.Begin(), rotations.Begin(), scales.Begin(), instances.Begin());
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            dmGameObject::AssignInstanceIndex(indices[i], instances[i]);
+            dmGameObject::Delete(m_Collection, instances[i], false);
+        }
+        dmGameObject::PostUpdate(m_Collection);
+    }
+
+    dmResource::Release(m_Factory, prototype);
+}
+
+void GameObjectBench::BenchUpdateTransforms(const char* name, uint32_t root_count)
+{
+    // Three levels deep: root -> child -> leaf
+    for (uint32_t i = 0; i < root_count; ++i)
+    {
+        dmGameObject::HInstance root = dmGameObject::New(m_Collection, 0x0);
+        dmGameObject::HInstance child = dmGameObject::New(m_Collection, 0x0);
+        dmGameObject::HInstance leaf = dmGameObject::New(m_Collection, 0x0);
+        dmGameObject::SetPosition(root, Point3((float)i, 0.0f, 0.0f));
+        dmGameObject::SetRotation(root, Quat::rotationZ(0.01f * i));
+        dmGameObject::SetPosition(child, Point3(0.0f, 1.0f, 0.0f));
+        dmGameObject::SetScale(child, 2.0f);
+        dmGameObject::SetPosition(leaf, Point3(0.0f, 0.0f, 1.0f));
+        dmGameObject::SetParent(child, root);
+        dmGameObject::SetParent(leaf, child);
+    }
+
+    for (dmBenchmark::Run run(name, 50, root_count * 3); run.Next(); )
+    {
+        dmGameObject::Update(m_Collection, &m_UpdateContext);
+    }
+}
+
+TEST_F(GameObjectBench, UpdateTransforms)
+{
+    BenchUpdateTransforms("gameobject.update_transforms", 4096);
+}
+
+TEST_F(GameObjectBench, UpdateTransformsParallel)
+{
+    dmJobThread::JobThreadCreationParams job_thread_params;
+    job_thread_params.m_ThreadNames[0] = "bench_worker1";
+    job_thread_params.m_ThreadNames[1] = "bench_worker2";
+    job_thread_params.m_ThreadNames[2] = "bench_worker3";
+    job_thread_params.m_ThreadCount = 3;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_params);
+    dmGameObject::SetJobThread(m_Register, job_thread);
+
+    BenchUpdateTransforms("gameobject.update_transforms_parallel", 4096);
+
+    dmGameObject::SetJobThread(m_Register, 0);
+    dmJobThread::Destroy(job_thread);
+}
+
+extern "C" void dmExportedSymbols();
+
+int main(int argc, char **argv)
+{
+    dmExportedSymbols();
+    TestMainPlatformInit();
+    dmDDF::RegisterAllTypes();
+    jc_test_init(&argc, argv);
+    int ret = jc_test_run_all();
+    if (ret == 0)
+        ret = dmBenchmark::Report(argc, argv, "gameobject");
+    return ret;
+}
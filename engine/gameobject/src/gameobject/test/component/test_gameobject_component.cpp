@@ -15,6 +15,7 @@
 #include <jc_test/jc_test.h>
 
 #include <map>
+#include <string>
 
 #include <dlib/dstrings.h>
 #include <dlib/hash.h>
@@ -346,6 +347,130 @@ TEST_F(ComponentTest, TestUpdate)
     ASSERT_EQ((uint32_t) 1, m_ComponentDestroyCountMap[TestGameObjectDDF::AResource::m_DDFHash]);
 }
 
+TEST_F(ComponentTest, TestInitFinalSliced)
+{
+    const uint32_t count = 3;
+    dmGameObject::HInstance instances[count];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        instances[i] = dmGameObject::New(m_Collection, "/go1.goc");
+        ASSERT_NE((void*) 0, (void*) instances[i]);
+    }
+
+    // With no time budget, one instance is initialized per call
+    bool done = false;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_FALSE(done);
+        ASSERT_TRUE(dmGameObject::InitSliced(m_Collection, 0, &done));
+        ASSERT_EQ(i + 1, m_ComponentInitCountMap[TestGameObjectDDF::AResource::m_DDFHash]);
+        ASSERT_EQ(done ? count : 0, m_ComponentAddToUpdateCountMap[TestGameObjectDDF::AResource::m_DDFHash]);
+    }
+    ASSERT_TRUE(done);
+
+    ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+    ASSERT_EQ(1u, m_ComponentUpdateCountMap[TestGameObjectDDF::AResource::m_DDFHash]);
+
+    done = false;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_FALSE(done);
+        ASSERT_TRUE(dmGameObject::FinalSliced(m_Collection, 0, &done));
+        ASSERT_EQ(i + 1, m_ComponentFinalCountMap[TestGameObjectDDF::AResource::m_DDFHash]);
+    }
+    ASSERT_TRUE(done);
+
+    // Already finalized
+    ASSERT_TRUE(dmGameObject::Final(m_Collection));
+    ASSERT_EQ(count, m_ComponentFinalCountMap[TestGameObjectDDF::AResource::m_DDFHash]);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmGameObject::Delete(m_Collection, instances[i], false);
+    }
+    ASSERT_TRUE(dmGameObject::PostUpdate(m_Collection));
+}
+
+static void SceneProfileComponentCallback(void* ctx, dmhash_t collection_id, const char* component_type, const dmGameObject::SceneProfileStats* stats)
+{
+    std::map<std::string, dmGameObject::SceneProfileStats>* result = (std::map<std::string, dmGameObject::SceneProfileStats>*) ctx;
+    (*result)[component_type] = *stats;
+}
+
+TEST_F(ComponentTest, TestSceneProfile)
+{
+    dmGameObject::HInstance go = dmGameObject::New(m_Collection, "/go1.goc");
+    ASSERT_NE((void*) 0, (void*) go);
+    dmGameObject::Init(m_Collection);
+
+    // Nothing is counted until it's enabled
+    ASSERT_FALSE(dmGameObject::IsSceneProfileEnabled(m_Register));
+    ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+
+    std::map<std::string, dmGameObject::SceneProfileStats> result;
+    dmGameObject::IterateSceneProfileComponents(m_Register, SceneProfileComponentCallback, &result);
+    ASSERT_EQ(0u, result.size());
+
+    dmGameObject::SetSceneProfileEnabled(m_Register, true);
+    ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+    ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+    dmGameObject::SetSceneProfileEnabled(m_Register, false);
+    ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+
+    dmGameObject::IterateSceneProfileComponents(m_Register, SceneProfileComponentCallback, &result);
+    ASSERT_EQ(1u, result.count("a"));
+    ASSERT_EQ(2u, result["a"].m_Count[dmGameObject::SCENE_PROFILE_FUNCTION_UPDATE]);
+    ASSERT_EQ(0u, result["a"].m_Count[dmGameObject::SCENE_PROFILE_FUNCTION_RENDER]);
+    ASSERT_STREQ("update", dmGameObject::GetSceneProfileFunctionName(dmGameObject::SCENE_PROFILE_FUNCTION_UPDATE));
+
+    dmGameObject::ResetSceneProfile(m_Register);
+    result.clear();
+    dmGameObject::IterateSceneProfileComponents(m_Register, SceneProfileComponentCallback, &result);
+    ASSERT_EQ(0u, result.size());
+
+    dmGameObject::Delete(m_Collection, go, false);
+    ASSERT_TRUE(dmGameObject::PostUpdate(m_Collection));
+}
+
+TEST_F(ComponentTest, TestHashCollectionState)
+{
+    dmGameObject::HInstance go1 = dmGameObject::New(m_Collection, "/go1.goc");
+    dmGameObject::HInstance go2 = dmGameObject::New(m_Collection, "/go1.goc");
+    ASSERT_EQ(dmGameObject::RESULT_OK, dmGameObject::SetIdentifier(m_Collection, go1, "go1"));
+    ASSERT_EQ(dmGameObject::RESULT_OK, dmGameObject::SetIdentifier(m_Collection, go2, "go2"));
+    dmGameObject::SetPosition(go2, dmVMath::Point3(1.0f, 2.0f, 3.0f));
+
+    uint64_t hash = dmGameObject::HashCollectionState(m_Collection, 0, 0, 0);
+    ASSERT_EQ(hash, dmGameObject::HashCollectionState(m_Collection, 0, 0, 0));
+
+    dmGameObject::SetPosition(go1, dmVMath::Point3(0.0f, 0.0f, 1.0f));
+    uint64_t moved_hash = dmGameObject::HashCollectionState(m_Collection, 0, 0, 0);
+    ASSERT_NE(hash, moved_hash);
+    dmGameObject::SetPosition(go1, dmVMath::Point3(0.0f, 0.0f, 0.0f));
+    ASSERT_EQ(hash, dmGameObject::HashCollectionState(m_Collection, 0, 0, 0));
+
+    // The same objects, created in the other order, give the same hash
+    dmGameObject::HCollection collection = dmGameObject::NewCollection("collection2", m_Factory, m_Register, 1024, 0x0);
+    dmGameObject::HInstance other2 = dmGameObject::New(collection, "/go1.goc");
+    dmGameObject::HInstance other1 = dmGameObject::New(collection, "/go1.goc");
+    ASSERT_EQ(dmGameObject::RESULT_OK, dmGameObject::SetIdentifier(collection, other2, "go2"));
+    ASSERT_EQ(dmGameObject::RESULT_OK, dmGameObject::SetIdentifier(collection, other1, "go1"));
+    dmGameObject::SetPosition(other2, dmVMath::Point3(1.0f, 2.0f, 3.0f));
+    ASSERT_EQ(hash, dmGameObject::HashCollectionState(collection, 0, 0, 0));
+
+    // A property that the instances don't have doesn't change the hash
+    dmhash_t component_id = dmHashString64("script");
+    dmhash_t property_id = dmHashString64("does_not_exist");
+    ASSERT_EQ(hash, dmGameObject::HashCollectionState(collection, &component_id, &property_id, 1));
+
+    dmGameObject::DeleteCollection(collection);
+    dmGameObject::PostUpdate(m_Register);
+
+    dmGameObject::Delete(m_Collection, go1, false);
+    dmGameObject::Delete(m_Collection, go2, false);
+    ASSERT_TRUE(dmGameObject::PostUpdate(m_Collection));
+}
+
 TEST_F(ComponentTest, TestPostDeleteUpdate)
 {
     dmGameObject::HInstance go = dmGameObject::New(m_Collection, "/go1.goc");
@@ -285,3 +285,131 @@ TEST_F(FactoryTest, FactoryCreateCallback)
     dmGameObject::HInstance instance = Spawn(m_Factory, m_Collection, "/test_create.goc", id, 0, Point3(2.0f, 0.0f, 0.0f), Quat(), Vector3(2, 2, 2));
     ASSERT_NE((void*)0, instance);
 }
+
+TEST_F(FactoryTest, FactorySpawnBatch)
+{
+    const uint32_t count = 16;
+    uint32_t indices[count];
+    dmhash_t ids[count];
+    Point3 positions[count];
+    Quat rotations[count];
+    Vector3 scales[count];
+    dmGameObject::HInstance instances[count];
+
+    ASSERT_EQ(count, dmGameObject::AcquireInstanceIndices(m_Collection, count, indices));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ids[i] = dmGameObject::ConstructInstanceId(indices[i]);
+        positions[i] = Point3((float)i, 0.0f, 0.0f);
+        rotations[i] = Quat::identity();
+        scales[i] = Vector3(2, 2, 2);
+    }
+
+    dmGameObject::HPrototype prototype = 0x0;
+    ASSERT_EQ(dmResource::RESULT_OK, dmResource::Get(m_Factory, "/test.goc", (void**)&prototype));
+    uint32_t spawned = dmGameObject::SpawnBatch(m_Collection, prototype, "/test.goc", count, ids, 0, positions, rotations, scales, instances);
+    dmResource::Release(m_Factory, prototype);
+
+    ASSERT_EQ(count, spawned);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_NE((void*)0, instances[i]);
+        ASSERT_EQ(ids[i], dmGameObject::GetIdentifier(instances[i]));
+        ASSERT_EQ(instances[i], dmGameObject::GetInstanceFromIdentifier(m_Collection, ids[i]));
+        ASSERT_EQ((float)i, dmGameObject::GetPosition(instances[i]).getX());
+        ASSERT_EQ(2.0f, dmGameObject::GetUniformScale(instances[i]));
+    }
+
+    // Identifiers already in use are rejected per instance
+    dmGameObject::HInstance duplicates[count];
+    ASSERT_EQ(dmResource::RESULT_OK, dmResource::Get(m_Factory, "/test.goc", (void**)&prototype));
+    spawned = dmGameObject::SpawnBatch(m_Collection, prototype, "/test.goc", count, ids, 0, positions, rotations, scales, duplicates);
+    dmResource::Release(m_Factory, prototype);
+    ASSERT_EQ(0u, spawned);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_EQ((void*)0, duplicates[i]);
+    }
+}
+
+TEST_F(FactoryTest, FactoryInstancePool)
+{
+    dmGameObject::HPrototype prototype = 0x0;
+    ASSERT_EQ(dmResource::RESULT_OK, dmResource::Get(m_Factory, "/test.goc", (void**)&prototype));
+    dmGameObject::HInstancePool pool = dmGameObject::NewInstancePool(m_Factory, prototype, "/test.goc", 2, 4);
+    // The pool holds its own reference to the prototype
+    dmResource::Release(m_Factory, prototype);
+    ASSERT_EQ(prototype, dmGameObject::GetInstancePoolPrototype(pool));
+    ASSERT_EQ(2u, dmGameObject::GetInstancePoolFreeCount(pool));
+
+    const uint32_t count = 6;
+    dmGameObject::HInstance instances[count];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t index = dmGameObject::AcquireInstanceIndex(m_Collection);
+        dmhash_t id = dmGameObject::ConstructInstanceId(index);
+        instances[i] = dmGameObject::SpawnFromPool(m_Collection, pool, "/test.goc", id, 0, Point3((float)i, 0.0f, 0.0f), Quat(), Vector3(1, 1, 1));
+        ASSERT_NE((void*)0, instances[i]);
+        dmGameObject::AssignInstanceIndex(index, instances[i]);
+        ASSERT_EQ((float)i, dmGameObject::GetPosition(instances[i]).getX());
+    }
+    ASSERT_EQ(0u, dmGameObject::GetInstancePoolFreeCount(pool));
+
+    // Deleted instances return to the pool, up to the max size
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmGameObject::Delete(m_Collection, instances[i], false);
+    }
+    dmGameObject::PostUpdate(m_Collection);
+    ASSERT_EQ(4u, dmGameObject::GetInstancePoolFreeCount(pool));
+
+    uint32_t index = dmGameObject::AcquireInstanceIndex(m_Collection);
+    dmhash_t id = dmGameObject::ConstructInstanceId(index);
+    dmGameObject::HInstance instance = dmGameObject::SpawnFromPool(m_Collection, pool, "/test.goc", id, 0, Point3(), Quat(), Vector3(1, 1, 1));
+    ASSERT_NE((void*)0, instance);
+    dmGameObject::AssignInstanceIndex(index, instance);
+    ASSERT_EQ(3u, dmGameObject::GetInstancePoolFreeCount(pool));
+    ASSERT_EQ(instance, dmGameObject::GetInstanceFromIdentifier(m_Collection, id));
+
+    // The pool outlives the deletion while it has live instances
+    dmGameObject::DeleteInstancePool(pool);
+    dmGameObject::Delete(m_Collection, instance, false);
+    dmGameObject::PostUpdate(m_Collection);
+    ASSERT_EQ((void*)0, dmGameObject::GetInstanceFromIdentifier(m_Collection, id));
+}
+
+TEST_F(FactoryTest, FactorySpawnBatchCreateFail)
+{
+    const uint32_t count = 3;
+    uint32_t indices[count];
+    dmhash_t ids[count];
+    Point3 positions[count];
+    Quat rotations[count];
+    Vector3 scales[count];
+    dmGameObject::HInstance instances[count];
+
+    ASSERT_EQ(count, dmGameObject::AcquireInstanceIndices(m_Collection, count, indices));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ids[i] = dmGameObject::ConstructInstanceId(indices[i]);
+        positions[i] = Point3(2.0f, 0.0f, 0.0f);
+        rotations[i] = Quat::identity();
+        scales[i] = Vector3(1, 1, 1);
+    }
+
+    // The test component only accepts "/instance0", so the remaining instances fail and are rolled back
+    uint32_t instance_count = m_Collection->m_Collection->m_InstanceIndices.Size();
+    dmGameObject::HPrototype prototype = 0x0;
+    ASSERT_EQ(dmResource::RESULT_OK, dmResource::Get(m_Factory, "/test_create.goc", (void**)&prototype));
+    uint32_t spawned = dmGameObject::SpawnBatch(m_Collection, prototype, "/test_create.goc", count, ids, 0, positions, rotations, scales, instances);
+    dmResource::Release(m_Factory, prototype);
+
+    ASSERT_EQ(1u, spawned);
+    ASSERT_EQ(instance_count + 1, m_Collection->m_Collection->m_InstanceIndices.Size());
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        bool expected = ids[i] == dmHashString64("/instance0");
+        ASSERT_EQ(expected, instances[i] != 0);
+        ASSERT_EQ(expected, dmGameObject::GetInstanceFromIdentifier(m_Collection, ids[i]) != 0);
+    }
+}
@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <map>
 #include <dlib/hash.h>
+#include <dlib/job_thread.h>
 #include <dlib/message.h>
 #include <dlib/dstrings.h>
 #include <dlib/time.h>
@@ -906,6 +907,84 @@ TEST_F(HierarchyTest, TestEmptyInstance)
     dmGameObject::Delete(m_Collection, go, false);
 }
 
+TEST_F(HierarchyTest, TestParallelTransforms)
+{
+    const uint32_t count = 3000;
+    dmGameObject::HCollection collection = dmGameObject::NewCollection("parallel", m_Factory, m_Register, count * 3, 0x0);
+    ASSERT_NE((void*) 0, collection);
+
+    dmJobThread::JobThreadCreationParams job_thread_params;
+    job_thread_params.m_ThreadNames[0] = "test_worker1";
+    job_thread_params.m_ThreadNames[1] = "test_worker2";
+    job_thread_params.m_ThreadNames[2] = "test_worker3";
+    job_thread_params.m_ThreadCount = 3;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_params);
+    dmGameObject::SetJobThread(m_Register, job_thread);
+
+    // Three levels, each large enough to be split across the workers
+    dmArray<dmGameObject::HInstance> leaves;
+    leaves.SetCapacity(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmGameObject::HInstance root = dmGameObject::New(collection, 0x0);
+        dmGameObject::HInstance child = dmGameObject::New(collection, 0x0);
+        dmGameObject::HInstance leaf = dmGameObject::New(collection, 0x0);
+        ASSERT_NE((void*) 0, leaf);
+        dmGameObject::SetPosition(root, Point3((float)i, 0.0f, 0.0f));
+        dmGameObject::SetScale(root, 2.0f);
+        dmGameObject::SetPosition(child, Point3(0.0f, 1.0f, 0.0f));
+        dmGameObject::SetPosition(leaf, Point3(0.0f, 0.0f, 1.0f));
+        ASSERT_EQ(dmGameObject::RESULT_OK, dmGameObject::SetParent(child, root));
+        ASSERT_EQ(dmGameObject::RESULT_OK, dmGameObject::SetParent(leaf, child));
+        leaves.Push(leaf);
+    }
+
+    ASSERT_TRUE(dmGameObject::Update(collection, &m_UpdateContext));
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Point3 p = dmGameObject::GetWorldPosition(leaves[i]);
+        ASSERT_NEAR((float)i, p.getX(), EPSILON);
+        ASSERT_NEAR(2.0f, p.getY(), EPSILON);
+        // The collection doesn't scale along z
+        ASSERT_NEAR(1.0f, p.getZ(), EPSILON);
+    }
+
+    dmGameObject::SetJobThread(m_Register, 0);
+    dmGameObject::DeleteCollection(collection);
+    dmGameObject::PostUpdate(m_Register);
+    dmJobThread::Destroy(job_thread);
+}
+
+TEST_F(HierarchyTest, TestInstanceIndexLimits)
+{
+    ASSERT_EQ((void*) 0, dmGameObject::NewCollection("too_big", m_Factory, m_Register, dmGameObject::INVALID_INSTANCE_INDEX + 1, 0x0));
+
+    // All index fields must be able to hold the largest valid index, and the invalid index
+    const uint32_t max_index = dmGameObject::INVALID_INSTANCE_INDEX - 1;
+    dmGameObject::Instance instance(0x0);
+    instance.m_Parent = max_index;
+    instance.m_Index = max_index;
+    instance.m_LevelIndex = max_index;
+    instance.m_SiblingIndex = max_index;
+    instance.m_FirstChildIndex = max_index;
+    instance.m_NextToDelete = max_index;
+    instance.m_NextToAdd = max_index;
+    ASSERT_EQ(max_index, (uint32_t) instance.m_Parent);
+    ASSERT_EQ(max_index, (uint32_t) instance.m_Index);
+    ASSERT_EQ(max_index, (uint32_t) instance.m_LevelIndex);
+    ASSERT_EQ(max_index, (uint32_t) instance.m_SiblingIndex);
+    ASSERT_EQ(max_index, (uint32_t) instance.m_FirstChildIndex);
+    ASSERT_EQ(max_index, (uint32_t) instance.m_NextToDelete);
+    ASSERT_EQ(max_index, (uint32_t) instance.m_NextToAdd);
+    ASSERT_EQ(0u, (uint32_t) instance.m_ToBeDeleted);
+    ASSERT_EQ(0u, (uint32_t) instance.m_ToBeAdded);
+
+    dmGameObject::Instance invalid(0x0);
+    ASSERT_EQ(dmGameObject::INVALID_INSTANCE_INDEX, (uint32_t) invalid.m_Parent);
+    ASSERT_EQ(dmGameObject::INVALID_INSTANCE_INDEX, (uint32_t) invalid.m_FirstChildIndex);
+}
+
 struct TestHierarchyCtx
 {
     int num_collections;
@@ -0,0 +1,205 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <jc_test/jc_test.h>
+
+#include <assert.h>
+#include <math.h>
+#include <dlib/array.h>
+#include <dlib/math.h>
+#include <dlib/transform.h>
+#include "../gameobject_transform_batch.h"
+
+using namespace dmVMath;
+
+// The batch kernel uses a different order of operations than the vector math library
+static const float TRANSFORM_BATCH_EPSILON = 0.00001f;
+
+static uint32_t g_TransformBatchSeed = 0;
+
+// Deterministic, so that a failure can be reproduced
+static float RandomFloat(float min, float max)
+{
+    g_TransformBatchSeed = g_TransformBatchSeed * 1664525u + 1013904223u;
+    return min + (max - min) * ((g_TransformBatchSeed >> 8) / (float) (1 << 24));
+}
+
+static dmTransform::Transform RandomTransform()
+{
+    Vector3 position(RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f));
+    Quat rotation = normalize(Quat(RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f)));
+    // Non uniform and z scaled, so that the scale along z setting makes a difference
+    Vector3 scale(RandomFloat(0.25f, 2.0f), RandomFloat(0.25f, 2.0f), RandomFloat(0.25f, 4.0f));
+    return dmTransform::Transform(position, rotation, scale);
+}
+
+static void SetBatchTransform(dmGameObject::LocalTransformBatch* batch, uint32_t i, const dmTransform::Transform& transform)
+{
+    const Vector3& position = transform.GetTranslation();
+    const Quat& rotation = transform.GetRotation();
+    const Vector3& scale = transform.GetScale();
+    batch->m_PositionX[i] = position.getX();
+    batch->m_PositionY[i] = position.getY();
+    batch->m_PositionZ[i] = position.getZ();
+    batch->m_RotationX[i] = rotation.getX();
+    batch->m_RotationY[i] = rotation.getY();
+    batch->m_RotationZ[i] = rotation.getZ();
+    batch->m_RotationW[i] = rotation.getW();
+    batch->m_ScaleX[i] = scale.getX();
+    batch->m_ScaleY[i] = scale.getY();
+    batch->m_ScaleZ[i] = scale.getZ();
+}
+
+// What the transform update computed per instance before the batches
+static Matrix4 ReferenceWorldMatrix(const Matrix4* parent, const dmTransform::Transform& local, bool scale_along_z)
+{
+    Matrix4 local_matrix = dmTransform::ToMatrix4(local);
+    if (parent == 0)
+    {
+        return local_matrix;
+    }
+    return scale_along_z ? *parent * local_matrix : dmTransform::MulNoScaleZ(*parent, local_matrix);
+}
+
+// The error is relative to the largest element, since an element can be the small sum of large products
+static void AssertMatrixNear(const Matrix4& expected, const Matrix4& actual, float epsilon)
+{
+    float max_element = 1.0f;
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        for (uint32_t r = 0; r < 4; ++r)
+        {
+            max_element = dmMath::Max(max_element, fabsf(expected.getElem(c, r)));
+        }
+    }
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        for (uint32_t r = 0; r < 4; ++r)
+        {
+            ASSERT_NEAR(expected.getElem(c, r), actual.getElem(c, r), epsilon * max_element);
+        }
+    }
+}
+
+// Composes count transforms, with or without parents, and checks them against the reference
+static void TestComposeTransformBatch(uint32_t count, bool with_parents, bool scale_along_z)
+{
+    dmGameObject::LocalTransformBatch batch;
+    dmTransform::Transform locals[dmGameObject::TRANSFORM_BATCH_SIZE];
+    Matrix4 parent_matrices[dmGameObject::TRANSFORM_BATCH_SIZE];
+    const Matrix4* parents[dmGameObject::TRANSFORM_BATCH_SIZE];
+    // One more than the batch, to check that nothing is written past the last transform
+    Matrix4 results[dmGameObject::TRANSFORM_BATCH_SIZE + 1];
+    Matrix4* out[dmGameObject::TRANSFORM_BATCH_SIZE];
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        locals[i] = RandomTransform();
+        SetBatchTransform(&batch, i, locals[i]);
+        parent_matrices[i] = dmTransform::ToMatrix4(RandomTransform());
+        parents[i] = &parent_matrices[i];
+        out[i] = &results[i];
+    }
+    Matrix4 sentinel = Matrix4::scale(Vector3(3.0f));
+    results[count] = sentinel;
+
+    dmGameObject::ComposeTransformBatch(&batch, count, with_parents ? parents : 0, out, scale_along_z);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Matrix4 expected = ReferenceWorldMatrix(with_parents ? parents[i] : 0, locals[i], scale_along_z);
+        AssertMatrixNear(expected, results[i], TRANSFORM_BATCH_EPSILON);
+    }
+    AssertMatrixNear(sentinel, results[count], 0.0f);
+}
+
+TEST(TransformBatch, Roots)
+{
+    g_TransformBatchSeed = 1;
+    const uint32_t counts[] = { 1, 2, 3, 4, 5, 7, 13, 63, dmGameObject::TRANSFORM_BATCH_SIZE };
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(counts); ++i)
+    {
+        TestComposeTransformBatch(counts[i], false, true);
+        TestComposeTransformBatch(counts[i], false, false);
+    }
+}
+
+TEST(TransformBatch, Parents)
+{
+    g_TransformBatchSeed = 2;
+    const uint32_t counts[] = { 1, 2, 3, 4, 5, 7, 13, 63, dmGameObject::TRANSFORM_BATCH_SIZE };
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(counts); ++i)
+    {
+        TestComposeTransformBatch(counts[i], true, true);
+    }
+}
+
+TEST(TransformBatch, ParentsNoScaleAlongZ)
+{
+    g_TransformBatchSeed = 3;
+    const uint32_t counts[] = { 1, 2, 3, 4, 5, 7, 13, 63, dmGameObject::TRANSFORM_BATCH_SIZE };
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(counts); ++i)
+    {
+        TestComposeTransformBatch(counts[i], true, false);
+    }
+}
+
+// The transform update composes one hierarchy level at a time, the parents being the outputs of the previous level
+static void TestComposeTransformChains(uint32_t chain_count, uint32_t depth, bool scale_along_z)
+{
+    const uint32_t max_depth = 4;
+    assert(chain_count <= dmGameObject::TRANSFORM_BATCH_SIZE && depth <= max_depth);
+
+    dmTransform::Transform locals[max_depth][dmGameObject::TRANSFORM_BATCH_SIZE];
+    Matrix4 world[max_depth][dmGameObject::TRANSFORM_BATCH_SIZE];
+    Matrix4 expected[max_depth][dmGameObject::TRANSFORM_BATCH_SIZE];
+
+    for (uint32_t level = 0; level < depth; ++level)
+    {
+        dmGameObject::LocalTransformBatch batch;
+        const Matrix4* parents[dmGameObject::TRANSFORM_BATCH_SIZE];
+        Matrix4* out[dmGameObject::TRANSFORM_BATCH_SIZE];
+        for (uint32_t i = 0; i < chain_count; ++i)
+        {
+            locals[level][i] = RandomTransform();
+            SetBatchTransform(&batch, i, locals[level][i]);
+            // Reverse the order every other level, so that the parents aren't at the same index in the batch
+            uint32_t parent_index = (level % 2) ? chain_count - 1 - i : i;
+            parents[i] = level > 0 ? &world[level - 1][parent_index] : 0;
+            out[i] = &world[level][i];
+            expected[level][i] = ReferenceWorldMatrix(level > 0 ? &expected[level - 1][parent_index] : 0, locals[level][i], scale_along_z);
+        }
+        dmGameObject::ComposeTransformBatch(&batch, chain_count, level > 0 ? parents : 0, out, scale_along_z);
+    }
+
+    // The error grows with each level
+    for (uint32_t level = 0; level < depth; ++level)
+    {
+        for (uint32_t i = 0; i < chain_count; ++i)
+        {
+            AssertMatrixNear(expected[level][i], world[level][i], (level + 1) * TRANSFORM_BATCH_EPSILON);
+        }
+    }
+}
+
+TEST(TransformBatch, ParentChains)
+{
+    g_TransformBatchSeed = 4;
+    const uint32_t counts[] = { 1, 3, 6, 17, dmGameObject::TRANSFORM_BATCH_SIZE };
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(counts); ++i)
+    {
+        TestComposeTransformChains(counts[i], 4, true);
+        TestComposeTransformChains(counts[i], 4, false);
+    }
+}
@@ -12,6 +12,8 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include <string.h>
+
 #include <jc_test/jc_test.h>
 
 #include <dmsdk/dlib/vmath.h>
@@ -282,6 +284,85 @@ TEST_F(InputTest, TextComponentTextInput)
     ASSERT_EQ(dmGameObject::UPDATE_RESULT_OK, r);
 }
 
+TEST_F(InputTest, TestInputFilter)
+{
+    dmGameObject::HInstance go = dmGameObject::New(m_Collection, "/component_input.goc");
+    ASSERT_NE((void*) 0, (void*) go);
+
+    dmGameObject::AcquireInputFocus(m_Collection, go);
+
+    dmhash_t other_action = dmHashString64("other_action");
+    dmGameObject::SetInputFilter(go, &other_action, 1);
+
+    dmGameObject::InputAction action;
+    action.m_ActionId = dmHashString64("test_action");
+    action.m_Value = 1.0f;
+    action.m_Pressed = 1;
+
+    // Filtered out, the components aren't called
+    ASSERT_EQ(dmGameObject::UPDATE_RESULT_OK, dmGameObject::DispatchInput(m_Collection, &action, 1));
+    ASSERT_EQ(0U, m_InputCounter);
+    ASSERT_EQ(0U, action.m_Consumed);
+
+    dmhash_t action_ids[] = { other_action, dmHashString64("test_action") };
+    dmGameObject::SetInputFilter(go, action_ids, 2);
+    ASSERT_EQ(dmGameObject::UPDATE_RESULT_OK, dmGameObject::DispatchInput(m_Collection, &action, 1));
+    ASSERT_EQ(1U, m_InputCounter);
+    ASSERT_EQ(1U, action.m_Consumed);
+
+    dmGameObject::SetInputFilter(go, 0, 0);
+    action.m_ActionId = dmHashString64("test_action");
+    action.m_Consumed = 0;
+    ASSERT_EQ(dmGameObject::UPDATE_RESULT_OK, dmGameObject::DispatchInput(m_Collection, &action, 1));
+    ASSERT_EQ(2U, m_InputCounter);
+
+    dmGameObject::SetInputFilter(go, &other_action, 1);
+    dmGameObject::Delete(m_Collection, go, false);
+    dmGameObject::PostUpdate(m_Collection);
+}
+
+TEST_F(InputTest, TestInputBatchDispatch)
+{
+    dmGameObject::SetInputBatchDispatch(m_Register, true);
+
+    // Components without a batch function get the actions one at a time
+    dmGameObject::HInstance go = dmGameObject::New(m_Collection, "/component_input.goc");
+    ASSERT_NE((void*) 0, (void*) go);
+    dmGameObject::AcquireInputFocus(m_Collection, go);
+
+    dmGameObject::InputAction actions[2];
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        actions[i].m_ActionId = dmHashString64("test_action");
+        actions[i].m_Value = 1.0f;
+        actions[i].m_Pressed = 1;
+    }
+    ASSERT_EQ(dmGameObject::UPDATE_RESULT_OK, dmGameObject::DispatchInput(m_Collection, actions, 2));
+    ASSERT_EQ(2U, m_InputCounter);
+    ASSERT_EQ(1U, actions[0].m_Consumed);
+    ASSERT_EQ(1U, actions[1].m_Consumed);
+
+    // on_input_batch gets all the actions in one call, and consumes them
+    dmGameObject::HInstance batch_go = dmGameObject::New(m_Collection, "/component_input_batch.goc");
+    ASSERT_NE((void*) 0, (void*) batch_go);
+    dmGameObject::AcquireInputFocus(m_Collection, batch_go);
+
+    memset(actions, 0, sizeof(actions));
+    actions[0].m_ActionId = dmHashString64("test_action");
+    actions[0].m_Value = 1.0f;
+    actions[0].m_Pressed = 1;
+    actions[1].m_PositionSet = 1;
+    actions[1].m_X = 1.0f;
+    actions[1].m_Y = 2.0f;
+    ASSERT_EQ(dmGameObject::UPDATE_RESULT_OK, dmGameObject::DispatchInput(m_Collection, actions, 2));
+    ASSERT_EQ(1U, actions[0].m_Consumed);
+    ASSERT_EQ(1U, actions[1].m_Consumed);
+    // The listener below didn't see the consumed actions
+    ASSERT_EQ(2U, m_InputCounter);
+
+    dmGameObject::SetInputBatchDispatch(m_Register, false);
+}
+
 TEST_F(InputTest, TestDeleteFocusInstance)
 {
     dmGameObject::HInstance go = dmGameObject::New(m_Collection, "/component_input.goc");
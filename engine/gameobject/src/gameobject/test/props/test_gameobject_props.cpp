@@ -537,6 +537,40 @@ TEST_F(PropsTest, PropsGetSet)
     dmGameObject::Delete(m_Collection, go, false);
 }
 
+TEST_F(PropsTest, PropsHandle)
+{
+    dmGameObject::HInstance go = dmGameObject::New(m_Collection, "/props_go.goc");
+    ASSERT_TRUE(dmGameObject::Init(m_Collection));
+
+    dmGameObject::PropertyOptions opt;
+    dmGameObject::PropertyHandle handle;
+    dmGameObject::PropertyDesc desc;
+
+    // The instance properties
+    dmGameObject::SetPosition(go, Point3(1, 2, 3));
+    ASSERT_EQ(dmGameObject::PROPERTY_RESULT_OK, dmGameObject::GetPropertyHandle(go, 0, hash("position.y"), opt, &handle));
+    ASSERT_EQ(dmGameObject::INVALID_COMPONENT_INDEX, handle.m_ComponentIndex);
+    ASSERT_EQ(dmGameObject::PROPERTY_TYPE_NUMBER, handle.m_Type);
+    ASSERT_EQ(2.0f, *handle.m_ValuePtr);
+    ASSERT_EQ(dmGameObject::PROPERTY_RESULT_OK, dmGameObject::SetProperty(handle, dmGameObject::PropertyVar(5.0f)));
+    ASSERT_EQ(5.0f, dmGameObject::GetPosition(go).getY());
+
+    // The component properties
+    ASSERT_EQ(dmGameObject::PROPERTY_RESULT_OK, dmGameObject::GetPropertyHandle(go, hash("script"), hash("number"), opt, &handle));
+    ASSERT_NE(dmGameObject::INVALID_COMPONENT_INDEX, handle.m_ComponentIndex);
+    ASSERT_EQ(dmGameObject::PROPERTY_RESULT_OK, dmGameObject::GetProperty(handle, desc));
+    ASSERT_EQ(200.0, desc.m_Variant.m_Number);
+    ASSERT_EQ(dmGameObject::PROPERTY_RESULT_OK, dmGameObject::SetProperty(handle, dmGameObject::PropertyVar(300.0f)));
+    ASSERT_EQ(dmGameObject::PROPERTY_RESULT_OK, dmGameObject::GetProperty(go, hash("script"), hash("number"), opt, desc));
+    ASSERT_EQ(300.0, desc.m_Variant.m_Number);
+
+    ASSERT_EQ(dmGameObject::PROPERTY_RESULT_COMP_NOT_FOUND, dmGameObject::GetPropertyHandle(go, hash("none"), hash("number"), opt, &handle));
+    ASSERT_EQ(dmGameObject::PROPERTY_RESULT_NOT_FOUND, dmGameObject::GetPropertyHandle(go, hash("script"), hash("none"), opt, &handle));
+    ASSERT_EQ(dmGameObject::PROPERTY_RESULT_INVALID_INSTANCE, dmGameObject::GetPropertyHandle(0, 0, hash("position"), opt, &handle));
+
+    dmGameObject::Delete(m_Collection, go, false);
+}
+
 #undef ASSERT_GET_PROP_NUM
 #undef ASSERT_SET_PROP_NUM
 #undef ASSERT_GET_PROP_V1
@@ -51,6 +51,16 @@ namespace dmGameSystem
                                                 uint32_t index, dmhash_t id,
                                                 const dmVMath::Point3& position, const dmVMath::Quat& rotation, const dmVMath::Vector3& scale,
                                                 dmGameObject::HPropertyContainer properties);
+
+    /*#
+     * Spawns `count` instances from the factory prototype in one batch. Each entry in `indices`
+     * is assigned to its spawned instance, or released back to the collection if that instance failed.
+     * @return spawned [type: uint32_t] the number of instances successfully spawned
+     */
+    uint32_t CompFactorySpawnBatch(HFactoryWorld world, HFactoryComponent component, dmGameObject::HCollection collection,
+                                    uint32_t count, const uint32_t* indices, const dmhash_t* ids,
+                                    const dmVMath::Point3* positions, const dmVMath::Quat* rotations, const dmVMath::Vector3* scales,
+                                    dmGameObject::HPropertyContainer properties, dmGameObject::HInstance* out_instances);
 }
 
 #endif // DMSDK_GAMESYS_FACTORY_H
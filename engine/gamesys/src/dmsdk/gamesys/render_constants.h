@@ -138,6 +138,15 @@ namespace dmGameSystem
      */
     int AreRenderConstantsUpdated(HComponentRenderConstants constants);
 
+    /*# get the version of the constants
+     * The version changes each time a constant is set to a new value, added or removed.
+     * Comparing versions is a cheap way to tell if the constants changed since they were last used.
+     * @name GetRenderConstantsVersion
+     * @param constants [type: dmGameSystem::HComponentRenderConstants] the constants
+     * @return version [type: uint32_t] the current version
+     */
+    uint32_t GetRenderConstantsVersion(HComponentRenderConstants constants);
+
     /*# set the constants of a render object
      * @name EnableRenderObjectConstants
      * @param ro [type: dmRender::RenderObject*] the render object
@@ -16,12 +16,15 @@
 #define DMSDK_GAMESYS_RES_ANIMATIONSET_H
 
 #include <rig/rig_ddf.h>
+#include <dmsdk/rig/rig.h>
 
 namespace dmGameSystem
 {
     struct AnimationSetResource
     {
-        dmRigDDF::AnimationSet* m_AnimationSet;
+        /// The tracks of the animations are moved to m_CompressedAnimationSet, if set
+        dmRigDDF::AnimationSet*         m_AnimationSet;
+        dmRig::HCompressedAnimationSet  m_CompressedAnimationSet;
     };
 }
 
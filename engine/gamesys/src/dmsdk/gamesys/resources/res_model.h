@@ -41,6 +41,14 @@ namespace dmGameSystem
     struct TextureResource;
     struct RenderTargetResource;
 
+    static const uint32_t MODEL_MAX_LOD_COUNT = 3; // The full mesh, and up to two simplified levels
+
+    struct ModelResourceLod
+    {
+        uint32_t                    m_IndexOffset; // The first index of the level in the index buffer
+        uint32_t                    m_IndexCount;
+    };
+
     struct ModelResourceBuffers
     {
         dmGraphics::HVertexBuffer   m_VertexBuffer;
@@ -48,12 +56,17 @@ namespace dmGameSystem
         uint32_t                    m_VertexCount;
         uint32_t                    m_IndexCount;
         dmGraphics::Type            m_IndexBufferElementType;
+        uint32_t                    m_VertexOffset;  // The first vertex of the mesh in m_VertexBuffer
+        uint32_t                    m_IndexOffset;   // The first index of the mesh in m_IndexBuffer
+        ModelResourceLod            m_Lods[MODEL_MAX_LOD_COUNT]; // m_Lods[0] is the full mesh, the simplified levels use the same vertices
+        uint8_t                     m_LodCount;
         uint8_t                     m_LastUsedFrame; // Used for statistics
+        uint8_t                     m_SharedBuffers : 1; // The buffers hold all the meshes of the model, and are owned by the first mesh
     };
 
     struct MeshInfo
     {
-        ModelResourceBuffers*   m_Buffers; // Currently a vertex+index buffer per mesh
+        ModelResourceBuffers*   m_Buffers; // A vertex+index buffer per mesh, or shared by all meshes if multi-draw indirect is supported
         dmRigDDF::Model*        m_Model;   // For the transform
         dmRigDDF::Mesh*         m_Mesh;
     };
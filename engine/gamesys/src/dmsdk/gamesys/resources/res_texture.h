@@ -21,9 +21,10 @@ namespace dmGameSystem
 {
     struct TextureResource
     {
-        dmGraphics::HTexture m_Texture;
-        uint8_t              m_Uploading:1;
-        uint8_t              m_DelayDelete:1;
+        dmGraphics::HTexture         m_Texture;
+        struct TextureStreamingInfo* m_StreamingInfo; // Non-null if the higher mipmaps are streamed in on demand
+        uint8_t                      m_Uploading:1;
+        uint8_t                      m_DelayDelete:1;
 
         TextureResource();
     };
@@ -13,6 +13,7 @@
 // specific language governing permissions and limitations under the License.
 
 #include "comp_camera.h"
+#include <string.h> // memcmp
 
 #include <dlib/array.h>
 #include <dlib/hash.h>
@@ -22,6 +23,7 @@
 #include <dlib/profile.h>
 
 #include <render/render.h>
+#include <sound/sound.h>
 
 #include <gameobject/gameobject_ddf.h>
 
@@ -56,6 +58,9 @@ namespace dmGameSystem
     {
         dmArray<CameraComponent>  m_Cameras;
         dmArray<CameraComponent*> m_CameraStack;
+        // The camera in focus is the listener of the spatial sounds. Its last position, for its velocity
+        dmVMath::Point3           m_ListenerPosition;
+        CameraComponent*          m_Listener;
     };
 
     static const dmhash_t CAMERA_PROP_FOV               = dmHashString64("fov");
@@ -253,8 +258,16 @@ namespace dmGameSystem
             if (!camera->m_AddedToUpdate)
                 continue;
 
+            dmVMath::Matrix4 view = camera->m_View;
+            dmVMath::Matrix4 projection = camera->m_Projection;
             CompCameraUpdateViewProjection(camera, render_context);
 
+            // A moved camera changes the whole screen, when the engine renders on demand
+            if (memcmp(&view, &camera->m_View, sizeof(view)) != 0 || memcmp(&projection, &camera->m_Projection, sizeof(projection)) != 0)
+            {
+                dmRender::InvalidateRender(render_context);
+            }
+
             // Legacy, at some point we should deprecate this
             if (!PostRenderScriptSetViewProjectionMsg(camera, CameraToURL(camera)))
             {
@@ -262,6 +275,23 @@ namespace dmGameSystem
             }
         }
 
+        if (num_cameras > 0)
+        {
+            CameraComponent* camera = camera_world->m_CameraStack[num_cameras - 1];
+            dmVMath::Point3 pos = dmGameObject::GetWorldPosition(camera->m_Instance);
+            dmVMath::Quat rot = dmGameObject::GetWorldRotation(camera->m_Instance);
+            float dt = params.m_UpdateContext->m_DT;
+            // No velocity when the focus changed, to not get a doppler shift from the jump
+            dmVMath::Vector3 velocity(0.0f);
+            if (camera == camera_world->m_Listener && dt > 0.0f)
+            {
+                velocity = (pos - camera_world->m_ListenerPosition) / dt;
+            }
+            camera_world->m_Listener = camera;
+            camera_world->m_ListenerPosition = pos;
+            dmSound::SetListener(pos, rot, velocity);
+        }
+
         return dmGameObject::UPDATE_RESULT_OK;
     }
 
@@ -45,6 +45,7 @@ namespace dmGameSystem
     static dmResource::Result LoadCollectionResources(dmResource::HFactory, CollectionFactoryComponent*);
     static void UnloadCollectionResources(dmResource::HFactory, CollectionFactoryComponent*);
     static CollectionFactoryResource* GetResource(CollectionFactoryComponent* component);
+    static void DeletePools(CollectionFactoryComponent* component);
 
     struct CollectionFactoryComponent
     {
@@ -53,6 +54,10 @@ namespace dmGameSystem
         CollectionFactoryResource*  m_Resource;         // set from the Editor
         CollectionFactoryResource*  m_CustomResource;   // set from script as an override
         dmResource::HPreloader      m_Preloader;
+        dmGameObject::HInstancePool* m_Pools;           // one per instance in the collection, see GetPools
+        uint32_t                    m_PoolCount;
+        uint32_t                    m_PoolSize;
+        uint32_t                    m_PoolPreallocate;
         int                         m_PreloaderCallbackRef;
         int                         m_PreloaderSelfRef;
         int                         m_PreloaderURLRef;
@@ -124,6 +129,9 @@ namespace dmGameSystem
         CollectionFactoryComponent* fc = (CollectionFactoryComponent*)*params.m_UserData;
         CleanupAsyncLoading(dmScript::GetLuaState(((CollectionFactoryContext*)params.m_Context)->m_ScriptContext), fc);
         uint32_t index = fc - &fw->m_Components[0];
+        DeletePools(fc);
+        fc->m_PoolSize = 0;
+        fc->m_PoolPreallocate = 0;
         fc->m_Resource = 0x0;
         if (fc->m_CustomResource)
             dmGameSystem::ResCollectionFactoryDestroyResource(fw->m_Factory, fc->m_CustomResource);
@@ -257,6 +265,8 @@ namespace dmGameSystem
 
     static void UnloadCollectionResources(dmResource::HFactory factory, CollectionFactoryComponent* component)
     {
+        // The pools hold references to the prototypes
+        DeletePools(component);
         dmArray<void*>& r = GetResource(component)->m_CollectionResources;
         for(uint32_t i = 0; i < r.Size(); ++i)
         {
@@ -404,8 +414,55 @@ namespace dmGameSystem
 
     void CompCollectionFactorySetResource(CollectionFactoryComponent* component, CollectionFactoryResource* resource)
     {
+        DeletePools(component);
         component->m_CustomResource = resource;
     }
 
+    static void DeletePools(CollectionFactoryComponent* component)
+    {
+        for (uint32_t i = 0; i < component->m_PoolCount; ++i)
+        {
+            if (component->m_Pools[i])
+                dmGameObject::DeleteInstancePool(component->m_Pools[i]);
+        }
+        delete[] component->m_Pools;
+        component->m_Pools = 0;
+        component->m_PoolCount = 0;
+    }
+
+    void CompCollectionFactorySetPoolSize(CollectionFactoryComponent* component, uint32_t size, uint32_t preallocate)
+    {
+        DeletePools(component);
+        component->m_PoolSize = size;
+        component->m_PoolPreallocate = preallocate;
+    }
+
+    dmGameObject::HInstancePool* CompCollectionFactoryGetPools(CollectionFactoryWorld* world, CollectionFactoryComponent* component)
+    {
+        if (component->m_PoolSize == 0)
+            return 0;
+        if (component->m_Pools)
+            return component->m_Pools;
+
+        dmGameObjectDDF::CollectionDesc* collection_desc = (dmGameObjectDDF::CollectionDesc*) GetResource(component)->m_CollectionDesc;
+        uint32_t count = collection_desc->m_Instances.m_Count;
+        component->m_Pools = new dmGameObject::HInstancePool[count];
+        component->m_PoolCount = count;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const dmGameObjectDDF::InstanceDesc& instance_desc = collection_desc->m_Instances[i];
+            component->m_Pools[i] = 0;
+            if (instance_desc.m_Prototype == 0x0)
+                continue;
+            dmGameObject::HPrototype prototype;
+            if (dmResource::Get(world->m_Factory, instance_desc.m_Prototype, (void**)&prototype) != dmResource::RESULT_OK)
+                continue;
+            component->m_Pools[i] = dmGameObject::NewInstancePool(world->m_Factory, prototype, instance_desc.m_Prototype,
+                                                                  component->m_PoolPreallocate, component->m_PoolSize);
+            dmResource::Release(world->m_Factory, prototype);
+        }
+        return component->m_Pools;
+    }
+
 }
 
@@ -61,6 +61,11 @@ namespace dmGameSystem
     CollectionFactoryResource*  CompCollectionFactoryGetDefaultResource(CollectionFactoryComponent* component);
     CollectionFactoryResource*  CompCollectionFactoryGetCustomResource(CollectionFactoryComponent* component);
     void                        CompCollectionFactorySetResource(CollectionFactoryComponent* component, CollectionFactoryResource* resource);
+
+    // Pool the instances of the spawned collections. A size of 0 disables the pools
+    void                        CompCollectionFactorySetPoolSize(CollectionFactoryComponent* component, uint32_t size, uint32_t preallocate);
+    // One pool per instance in the collection, or 0 if pooling is disabled
+    dmGameObject::HInstancePool* CompCollectionFactoryGetPools(CollectionFactoryWorld* world, CollectionFactoryComponent* component);
 }
 
 #endif
@@ -54,12 +54,17 @@ namespace dmGameSystem
     using namespace dmVMath;
 
     const char* COLLECTION_PROXY_MAX_COUNT_KEY = "collection_proxy.max_count";
+    const char* COLLECTION_PROXY_INIT_TIME_BUDGET_KEY = "collection_proxy.init_time_budget";
 
     static const dmhash_t COLLECTION_PROXY_LOAD_HASH = dmHashString64("load");
     static const dmhash_t COLLECTION_PROXY_ASYNC_LOAD_HASH = dmHashString64("async_load");
     static const dmhash_t COLLECTION_PROXY_UNLOAD_HASH = dmHashString64("unload");
     static const dmhash_t COLLECTION_PROXY_INIT_HASH = dmHashString64("init");
     static const dmhash_t COLLECTION_PROXY_FINAL_HASH = dmHashString64("final");
+    static const dmhash_t COLLECTION_PROXY_ASYNC_INIT_HASH = dmHashString64("async_init");
+    static const dmhash_t COLLECTION_PROXY_ASYNC_FINAL_HASH = dmHashString64("async_final");
+    static const dmhash_t COLLECTION_PROXY_INITIALIZED_HASH = dmHashString64("proxy_initialized");
+    static const dmhash_t COLLECTION_PROXY_FINALIZED_HASH = dmHashString64("proxy_finalized");
     static const dmhash_t COLLECTION_PROXY_LOADED_HASH = dmHashString64("proxy_loaded");
     static const dmhash_t COLLECTION_PROXY_UNLOADED_HASH = dmHashString64("proxy_unloaded");
 
@@ -79,10 +84,14 @@ namespace dmGameSystem
         uint32_t                        m_Unloaded : 1;
         uint32_t                        m_AddedToUpdate : 1;
         uint32_t                        m_Loading : 1;
+        uint32_t                        m_AsyncInit : 1;    // Initializing over several frames, see async_init
+        uint32_t                        m_AsyncFinal : 1;   // Finalizing over several frames, see async_final
 
         dmResource::HPreloader          m_Preloader;
         dmMessage::URL                  m_LoadSender;
         dmMessage::URL                  m_LoadReceiver;
+        dmMessage::URL                  m_AsyncInitSender;  // Also used by async_final
+        dmMessage::URL                  m_AsyncInitReceiver;
 
         ProxyLoadCallback               m_Callback;
         void*                           m_CallbackCtx;
@@ -155,6 +164,30 @@ namespace dmGameSystem
         }
     }
 
+    static void PostAsyncInitComplete(CollectionProxyComponent* proxy, dmhash_t message_id)
+    {
+        if (dmMessage::IsSocketValid(proxy->m_AsyncInitSender.m_Socket))
+        {
+            dmMessage::Result msg_result = dmMessage::Post(&proxy->m_AsyncInitReceiver, &proxy->m_AsyncInitSender, message_id, 0, 0, 0, 0, 0);
+            if (msg_result != dmMessage::RESULT_OK)
+            {
+                dmLogWarning("%s could not be posted: %d", dmHashReverseSafe64(message_id), msg_result);
+            }
+        }
+    }
+
+    // Finals what has been initialized, also when an async_init hasn't finished
+    static void FinalCollection(CollectionProxyComponent* proxy)
+    {
+        if (proxy->m_Initialized || proxy->m_AsyncInit || proxy->m_AsyncFinal)
+        {
+            dmGameObject::Final(proxy->m_Collection);
+        }
+        proxy->m_Initialized = 0;
+        proxy->m_AsyncInit = 0;
+        proxy->m_AsyncFinal = 0;
+    }
+
     static bool PreloadCompleteCallback(const dmResource::PreloaderCompleteCallbackParams* params)
     {
         return (DoLoad(params->m_Factory, (CollectionProxyComponent *) params->m_UserData) == dmGameObject::UPDATE_RESULT_OK);
@@ -247,8 +280,7 @@ namespace dmGameSystem
             }
             if (collection != 0)
             {
-                if (proxy_world->m_Components[i].m_Initialized)
-                    dmGameObject::Final(collection);
+                FinalCollection(proxy);
                 dmResource::Release(factory, collection);
             }
         }
@@ -300,10 +332,9 @@ namespace dmGameSystem
     dmGameObject::CreateResult CompCollectionProxyFinal(const dmGameObject::ComponentFinalParams& params)
     {
         CollectionProxyComponent* proxy = (CollectionProxyComponent*)*params.m_UserData;
-        if (proxy->m_Initialized)
+        if (proxy->m_Collection != 0)
         {
-            proxy->m_Initialized = 0;
-            dmGameObject::Final(proxy->m_Collection);
+            FinalCollection(proxy);
         }
         return dmGameObject::CREATE_RESULT_OK;
     }
@@ -343,7 +374,33 @@ namespace dmGameSystem
             if (proxy->m_Collection != 0)
             {
                 DM_PROPERTY_ADD_U32(rmtp_CollectionProxyLoaded, 1);
-                if (proxy->m_DelayedEnable != proxy->m_Enabled)
+                CollectionProxyContext* context = (CollectionProxyContext*)params.m_Context;
+                if (proxy->m_AsyncInit)
+                {
+                    bool done = false;
+                    if (!dmGameObject::InitSliced(proxy->m_Collection, context->m_InitTimeBudget, &done))
+                        result = dmGameObject::UPDATE_RESULT_UNKNOWN_ERROR;
+                    if (done)
+                    {
+                        proxy->m_AsyncInit = 0;
+                        proxy->m_Initialized = 1;
+                        PostAsyncInitComplete(proxy, COLLECTION_PROXY_INITIALIZED_HASH);
+                    }
+                }
+                else if (proxy->m_AsyncFinal)
+                {
+                    bool done = false;
+                    if (!dmGameObject::FinalSliced(proxy->m_Collection, context->m_InitTimeBudget, &done))
+                        result = dmGameObject::UPDATE_RESULT_UNKNOWN_ERROR;
+                    if (done)
+                    {
+                        proxy->m_AsyncFinal = 0;
+                        PostAsyncInitComplete(proxy, COLLECTION_PROXY_FINALIZED_HASH);
+                    }
+                }
+
+                // A partially initialized collection stays disabled until it's done
+                if (proxy->m_DelayedEnable != proxy->m_Enabled && !proxy->m_AsyncInit)
                 {
                     proxy->m_Enabled = proxy->m_DelayedEnable;
                 }
@@ -553,6 +610,10 @@ namespace dmGameSystem
             return dmGameObject::RESULT_UNKNOWN_ERROR;
         }
 
+        if (proxy->m_AsyncInit || proxy->m_AsyncFinal)
+        {
+            FinalCollection(proxy);
+        }
         dmResource::Release(context->m_Factory, proxy->m_Collection);
         proxy->m_Collection = 0;
         proxy->m_Initialized = 0;
@@ -579,14 +640,38 @@ namespace dmGameSystem
         return CompCollectionProxyUnloadInternal(world->m_Context, proxy, cbk, cbk_ctx, 0, 0);
     }
 
-    static dmGameObject::Result CompCollectionProxyInitializeInternal(HCollectionProxyComponent proxy, dmMessage::Message* message)
+    static dmGameObject::Result CompCollectionProxyInitializeInternal(HCollectionProxyComponent proxy, dmMessage::Message* message, bool init_async)
     {
         if (proxy->m_Collection != 0)
         {
-            if (proxy->m_Initialized == 0)
+            if (proxy->m_AsyncInit || proxy->m_AsyncFinal)
             {
-                dmGameObject::Init(proxy->m_Collection);
-                proxy->m_Initialized = 1;
+                LogMessageError(message, "The collection %s is being initialized or finalized.", GetCollectionResorcePath(proxy));
+                if (message)
+                    return dmGameObject::RESULT_OK; // The message code path doesn't catch errors
+                return dmGameObject::RESULT_UNKNOWN_ERROR;
+            }
+            else if (proxy->m_Initialized == 0)
+            {
+                if (init_async)
+                {
+                    // The instances are initialized in the update, see InitSliced
+                    proxy->m_AsyncInit = 1;
+                    if (message)
+                    {
+                        proxy->m_AsyncInitSender = message->m_Sender;
+                        proxy->m_AsyncInitReceiver = message->m_Receiver;
+                    }
+                    else
+                    {
+                        dmMessage::ResetURL(&proxy->m_AsyncInitSender);
+                    }
+                }
+                else
+                {
+                    dmGameObject::Init(proxy->m_Collection);
+                    proxy->m_Initialized = 1;
+                }
             }
             else
             {
@@ -609,15 +694,45 @@ namespace dmGameSystem
     dmGameObject::Result CompCollectionProxyInitialize(HCollectionProxyWorld world, HCollectionProxyComponent proxy)
     {
         (void)world;
-        return CompCollectionProxyInitializeInternal(proxy, 0);
+        return CompCollectionProxyInitializeInternal(proxy, 0, false);
     }
 
-    static dmGameObject::Result CompCollectionProxyFinalizeInternal(HCollectionProxyComponent proxy, dmMessage::Message* message)
+    static dmGameObject::Result CompCollectionProxyFinalizeInternal(HCollectionProxyComponent proxy, dmMessage::Message* message, bool final_async)
     {
-        if (proxy->m_Initialized == 1 && proxy->m_Collection != 0x0)
+        if (proxy->m_AsyncFinal)
+        {
+            LogMessageError(message, "The collection %s is already being finalized.", GetCollectionResorcePath(proxy));
+            if (message)
+                return dmGameObject::RESULT_OK; // The message code path doesn't catch errors
+            return dmGameObject::RESULT_UNKNOWN_ERROR;
+        }
+        else if (proxy->m_AsyncInit && proxy->m_Collection != 0x0)
+        {
+            // The init was cancelled, so only the instances initialized so far are finalized
+            FinalCollection(proxy);
+        }
+        else if (proxy->m_Initialized == 1 && proxy->m_Collection != 0x0)
         {
-            dmGameObject::Final(proxy->m_Collection);
             proxy->m_Initialized = 0;
+            if (final_async)
+            {
+                // The collection is disabled while its instances are finalized in the update, see FinalSliced
+                proxy->m_AsyncFinal = 1;
+                proxy->m_DelayedEnable = 0;
+                if (message)
+                {
+                    proxy->m_AsyncInitSender = message->m_Sender;
+                    proxy->m_AsyncInitReceiver = message->m_Receiver;
+                }
+                else
+                {
+                    dmMessage::ResetURL(&proxy->m_AsyncInitSender);
+                }
+            }
+            else
+            {
+                dmGameObject::Final(proxy->m_Collection);
+            }
         }
         else
         {
@@ -632,7 +747,7 @@ namespace dmGameSystem
     dmGameObject::Result CompCollectionProxyFinalize(HCollectionProxyWorld world, HCollectionProxyComponent proxy)
     {
         (void)world;
-        return CompCollectionProxyFinalizeInternal(proxy, 0);
+        return CompCollectionProxyFinalizeInternal(proxy, 0, false);
     }
 
     static dmGameObject::Result CompCollectionProxyEnableInternal(HCollectionProxyComponent proxy, dmMessage::Message* message)
@@ -643,7 +758,8 @@ namespace dmGameSystem
             {
                 proxy->m_DelayedEnable = 1;
 
-                if (proxy->m_Initialized == 0)
+                // An async_init in progress enables the collection when it's done
+                if (proxy->m_Initialized == 0 && !proxy->m_AsyncInit)
                 {
                     dmGameObject::Init(proxy->m_Collection);
                     proxy->m_Initialized = 1;
@@ -721,14 +837,16 @@ namespace dmGameSystem
             dmGameObject::Result r = CompCollectionProxyUnloadInternal(context, proxy, 0, 0, &params.m_Message->m_Sender, params.m_Message);
             return dmGameObject::RESULT_OK == r ? dmGameObject::UPDATE_RESULT_OK : dmGameObject::UPDATE_RESULT_UNKNOWN_ERROR;
         }
-        else if (params.m_Message->m_Id == COLLECTION_PROXY_INIT_HASH)
+        else if (params.m_Message->m_Id == COLLECTION_PROXY_INIT_HASH || params.m_Message->m_Id == COLLECTION_PROXY_ASYNC_INIT_HASH)
         {
-            dmGameObject::Result r = CompCollectionProxyInitializeInternal(proxy, params.m_Message);
+            bool init_async = COLLECTION_PROXY_ASYNC_INIT_HASH == params.m_Message->m_Id;
+            dmGameObject::Result r = CompCollectionProxyInitializeInternal(proxy, params.m_Message, init_async);
             return dmGameObject::RESULT_OK == r ? dmGameObject::UPDATE_RESULT_OK : dmGameObject::UPDATE_RESULT_UNKNOWN_ERROR;
         }
-        else if (params.m_Message->m_Id == COLLECTION_PROXY_FINAL_HASH)
+        else if (params.m_Message->m_Id == COLLECTION_PROXY_FINAL_HASH || params.m_Message->m_Id == COLLECTION_PROXY_ASYNC_FINAL_HASH)
         {
-            dmGameObject::Result r = CompCollectionProxyFinalizeInternal(proxy, params.m_Message);
+            bool final_async = COLLECTION_PROXY_ASYNC_FINAL_HASH == params.m_Message->m_Id;
+            dmGameObject::Result r = CompCollectionProxyFinalizeInternal(proxy, params.m_Message, final_async);
             return dmGameObject::RESULT_OK == r ? dmGameObject::UPDATE_RESULT_OK : dmGameObject::UPDATE_RESULT_UNKNOWN_ERROR;
         }
         else if (params.m_Message->m_Id == dmGameObjectDDF::Enable::m_DDFDescriptor->m_NameHash)
@@ -890,6 +1008,38 @@ namespace dmGameSystem
      * ```
      */
 
+    /*# tells a collection proxy to initialize the loaded collection over several frames
+     * Post this message to a collection-proxy-component to initialize the game objects and components in the referenced collection,
+     * a few at a time each frame, so that a large collection doesn't stall a single frame. The time spent per frame is set
+     * with the project setting `collection_proxy.init_time_budget`, in milliseconds.
+     * When all game objects are initialized, the message [ref:proxy_initialized] will be sent back to the script.
+     *
+     * The collection stays disabled while it's being initialized, and an [ref:enable] posted meanwhile takes effect when it's done.
+     *
+     * @message
+     * @name async_init
+     * @examples
+     *
+     * ```lua
+     * function on_message(self, message_id, message, sender)
+     *     if message_id == hash("proxy_loaded") then
+     *         msg.post(sender, "async_init")
+     *     elseif message_id == hash("proxy_initialized") then
+     *         msg.post(sender, "enable")
+     *     end
+     * end
+     * ```
+     */
+
+    /*# reports that a collection proxy has initialized its referenced collection
+     *
+     * This message is sent back to the script that posted [ref:async_init] when all
+     * game objects in the referenced collection are initialized.
+     *
+     * @message
+     * @name proxy_initialized
+     */
+
     /*# tells a collection proxy to enable the referenced collection
      * Post this message to a collection-proxy-component to enable the referenced collection, which in turn enables the contained game objects and components.
      * If the referenced collection was not initialized prior to this call, it will automatically be initialized.
@@ -974,6 +1124,35 @@ namespace dmGameSystem
      * ```
      */
 
+    /*# tells a collection proxy to finalize the referenced collection over several frames
+     * Post this message to a collection-proxy-component to finalize the game objects and components in the referenced collection,
+     * a few at a time each frame, within the same time budget as [ref:async_init]. The collection is disabled at once.
+     * When all game objects are finalized, the message [ref:proxy_finalized] will be sent back to the script.
+     *
+     * @message
+     * @name async_final
+     * @examples
+     *
+     * ```lua
+     * function on_message(self, message_id, message, sender)
+     *     if message_id == hash("end_level") then
+     *         msg.post("#proxy", "async_final")
+     *     elseif message_id == hash("proxy_finalized") then
+     *         msg.post(sender, "unload")
+     *     end
+     * end
+     * ```
+     */
+
+    /*# reports that a collection proxy has finalized its referenced collection
+     *
+     * This message is sent back to the script that posted [ref:async_final] when all
+     * game objects in the referenced collection are finalized.
+     *
+     * @message
+     * @name proxy_finalized
+     */
+
     /*# tells a collection proxy to start unloading the referenced collection
      *
      * Post this message to a collection-proxy-component to start the unloading of the referenced collection.
@@ -20,6 +20,7 @@
 #include <dlib/log.h>
 #include <dlib/math.h>
 #include <dlib/static_assert.h>
+#include <dmsdk/dlib/align.h>
 #include <dmsdk/dlib/vmath.h>
 #include <dmsdk/dlib/profile.h>
 #include <dmsdk/gameobject/script.h>
@@ -56,6 +57,8 @@ namespace dmGameSystem
     const char* PHYSICS_USE_FIXED_TIMESTEP          = "physics.use_fixed_timestep";
     /// Config key for using max updates during a single step
     const char* PHYSICS_MAX_FIXED_TIMESTEPS         = "physics.max_fixed_timesteps";
+    /// Config key for interpolating the transforms of dynamic objects between the fixed steps
+    const char* PHYSICS_FIXED_TIMESTEP_INTERPOLATION = "physics.fixed_timestep_interpolation";
 
     static const dmhash_t PROP_LINEAR_DAMPING = dmHashString64("linear_damping");
     static const dmhash_t PROP_ANGULAR_DAMPING = dmHashString64("angular_damping");
@@ -91,6 +94,18 @@ namespace dmGameSystem
         JointEntry* m_JointEntry;
     };
 
+    /// The body transforms of the two latest fixed steps, which the game object transform is interpolated between
+    struct TransformInterpolation
+    {
+        Point3  m_PreviousPosition;
+        Point3  m_CurrentPosition;
+        /// The transform last written to the game object
+        Point3  m_Position;
+        Quat    m_PreviousRotation;
+        Quat    m_CurrentRotation;
+        Quat    m_Rotation;
+    };
+
     struct CollisionComponent
     {
         CollisionObjectResource* m_Resource;
@@ -110,6 +125,9 @@ namespace dmGameSystem
 
         dmPhysics::HCollisionShape3D* m_ShapeBuffer;
 
+        /// Only set for dynamic objects, when interpolating between the fixed steps
+        TransformInterpolation* m_Interpolation;
+
         uint16_t m_Mask;
         uint16_t m_ComponentIndex;
         // True if the physics is 3D
@@ -139,11 +157,15 @@ namespace dmGameSystem
             dmPhysics::HWorld3D m_World3D;
         };
         float       m_CurrentDT;    // Used to calculate joint reaction force and torque.
-        float       m_AccumTime;    // Time saved from last component type update
+        float       m_AccumTime;    // Time left until the next fixed step, when interpolating between the fixed steps
+        float       m_FixedDT;      // The latest fixed step
         uint8_t     m_ComponentTypeIndex;
         uint8_t     m_3D : 1;
         uint8_t     m_FirstUpdate : 1;
+        uint8_t     m_BatchEvents : 1;  // Buffer the listener events of a step and deliver them in one call
         dmArray<CollisionComponent*> m_Components;
+        dmArray<uint8_t>    m_EventBuffer;  // PhysicsEventHeader followed by the DDF data, for each event
+        uint32_t            m_EventCount;
     };
 
     // Forward declarations
@@ -159,6 +181,16 @@ namespace dmGameSystem
         world_transform = dmGameObject::GetWorldTransform(instance);
     }
 
+    static inline bool IsEqual(const Point3& a, const Point3& b)
+    {
+        return a.getX() == b.getX() && a.getY() == b.getY() && a.getZ() == b.getZ();
+    }
+
+    static inline bool IsEqual(const Quat& a, const Quat& b)
+    {
+        return a.getX() == b.getX() && a.getY() == b.getY() && a.getZ() == b.getZ() && a.getW() == b.getW();
+    }
+
     // TODO: Allow the SetWorldTransform to have a physics context which we can check instead!!
     static int g_NumPhysicsTransformsUpdated = 0;
 
@@ -168,18 +200,31 @@ namespace dmGameSystem
             return;
         CollisionComponent* component = (CollisionComponent*)user_data;
         dmGameObject::HInstance instance = component->m_Instance;
-        if (component->m_3D)
+        if (component->m_Interpolation)
         {
-            dmGameObject::SetPosition(instance, position);
+            // The game object is moved when the transforms are interpolated, after the fixed steps
+            TransformInterpolation* interpolation = component->m_Interpolation;
+            interpolation->m_CurrentPosition = position;
+            if (!component->m_3D)
+            {
+                interpolation->m_CurrentPosition.setZ(interpolation->m_Position.getZ());
+            }
+            interpolation->m_CurrentRotation = rotation;
+            return;
         }
-        else
+        dmVMath::Point3 old_position = dmGameObject::GetPosition(instance);
+        dmVMath::Point3 p = position;
+        if (!component->m_3D)
         {
             // Preserve z for 2D physics
-            dmVMath::Point3 p = dmGameObject::GetPosition(instance);
-            p.setX(position.getX());
-            p.setY(position.getY());
-            dmGameObject::SetPosition(instance, p);
+            p.setZ(old_position.getZ());
+        }
+        // Bodies at rest write back the transform they already have, which would only trigger a transform update
+        if (IsEqual(p, old_position) && IsEqual(rotation, dmGameObject::GetRotation(instance)))
+        {
+            return;
         }
+        dmGameObject::SetPosition(instance, p);
         dmGameObject::SetRotation(instance, rotation);
         ++g_NumPhysicsTransformsUpdated;
     }
@@ -323,16 +368,23 @@ namespace dmGameSystem
             dmGameSystemDDF::TileGrid* tile_grid = tile_grid_resource->m_TileGrid;
             dmArray<dmPhysics::HCollisionShape2D>& shapes = resource->m_TileGridResource->m_GridShapes;
             uint32_t shape_count = shapes.Size();
-            dmPhysics::HullFlags flags;
 
             TextureSetResource* texture_set_resource = tile_grid_resource->m_TextureSet;
             dmGameSystemDDF::TextureSet* tile_set = texture_set_resource->m_TextureSet;
 
+            // Set the non-empty tiles of all layers at once
+            uint32_t total_cell_count = 0;
+            for (uint32_t i = 0; i < shape_count; ++i)
+            {
+                total_cell_count += tile_grid->m_Layers[i].m_Cell.m_Count;
+            }
+            dmArray<dmPhysics::GridShapeHullDesc> hulls;
+            hulls.SetCapacity(total_cell_count);
+
             for (uint32_t i = 0; i < shape_count; ++i)
             {
                 dmGameSystemDDF::TileLayer* layer = &tile_grid->m_Layers[i];
 
-                // Set non-empty tiles
                 uint32_t cell_count = layer->m_Cell.m_Count;
                 for (uint32_t j = 0; j < cell_count; ++j)
                 {
@@ -341,19 +393,25 @@ namespace dmGameSystem
 
                     if (tile < tile_set->m_ConvexHulls.m_Count && tile_set->m_ConvexHulls[tile].m_Count > 0)
                     {
-                        uint32_t cell_x = cell->m_X - tile_grid_resource->m_MinCellX;
-                        uint32_t cell_y = cell->m_Y - tile_grid_resource->m_MinCellY;
-                        flags.m_FlipHorizontal = cell->m_HFlip;
-                        flags.m_FlipVertical = cell->m_VFlip;
-                        flags.m_Rotate90 = cell->m_Rotate90;
-                        dmPhysics::SetGridShapeHull(component->m_Object2D, i, cell_y, cell_x, tile, flags);
-                        uint32_t child = cell_x + tile_grid_resource->m_ColumnCount * cell_y;
-                        uint16_t group = GetGroupBitIndex(world, texture_set_resource->m_HullCollisionGroups[tile], false);
-                        dmPhysics::SetCollisionObjectFilter(component->m_Object2D, i, child, group, component->m_Mask);
+                        dmPhysics::GridShapeHullDesc desc;
+                        desc.m_ShapeIndex = i;
+                        desc.m_Row = cell->m_Y - tile_grid_resource->m_MinCellY;
+                        desc.m_Column = cell->m_X - tile_grid_resource->m_MinCellX;
+                        desc.m_Hull = tile;
+                        desc.m_Group = GetGroupBitIndex(world, texture_set_resource->m_HullCollisionGroups[tile], false);
+                        desc.m_Mask = component->m_Mask;
+                        desc.m_Flags.m_FlipHorizontal = cell->m_HFlip;
+                        desc.m_Flags.m_FlipVertical = cell->m_VFlip;
+                        desc.m_Flags.m_Rotate90 = cell->m_Rotate90;
+                        hulls.Push(desc);
                     }
                 }
+            }
+            dmPhysics::SetGridShapeHulls(component->m_Object2D, hulls.Begin(), hulls.Size());
 
-                dmPhysics::SetGridShapeEnable(component->m_Object2D, i, layer->m_IsVisible);
+            for (uint32_t i = 0; i < shape_count; ++i)
+            {
+                dmPhysics::SetGridShapeEnable(component->m_Object2D, i, tile_grid->m_Layers[i].m_IsVisible);
             }
         }
     }
@@ -468,10 +526,24 @@ namespace dmGameSystem
         component->m_FlippedX = 0;
         component->m_FlippedY = 0;
         component->m_ShapeBuffer = 0;
+        component->m_Interpolation = 0x0;
+        if (physics_context->m_UseFixedTimestep && physics_context->m_FixedTimestepInterpolation
+            && co_res->m_DDF->m_Type == dmPhysicsDDF::COLLISION_OBJECT_TYPE_DYNAMIC)
+        {
+            TransformInterpolation* interpolation = new TransformInterpolation;
+            interpolation->m_Position = dmGameObject::GetPosition(params.m_Instance);
+            interpolation->m_PreviousPosition = interpolation->m_Position;
+            interpolation->m_CurrentPosition = interpolation->m_Position;
+            interpolation->m_Rotation = dmGameObject::GetRotation(params.m_Instance);
+            interpolation->m_PreviousRotation = interpolation->m_Rotation;
+            interpolation->m_CurrentRotation = interpolation->m_Rotation;
+            component->m_Interpolation = interpolation;
+        }
 
         CollisionWorld* world = (CollisionWorld*)params.m_World;
         if (!CreateCollisionObject(physics_context, world, params.m_Instance, component, false))
         {
+            delete component->m_Interpolation;
             delete component;
             return dmGameObject::CREATE_RESULT_UNKNOWN_ERROR;
         }
@@ -557,6 +629,7 @@ namespace dmGameSystem
             }
         }
 
+        delete component->m_Interpolation;
         delete component;
         return dmGameObject::CREATE_RESULT_OK;
     }
@@ -594,15 +667,43 @@ namespace dmGameSystem
         }
     }
 
+    static void PushPhysicsEvent(CollisionWorld* world, const dmDDF::Descriptor* desc, const char* data)
+    {
+        assert(desc->m_Size <= PHYSICS_EVENT_MAX_DATA_SIZE);
+        const uint32_t header_size = sizeof(PhysicsEventHeader);
+        const uint32_t size = header_size + DM_ALIGN(desc->m_Size, header_size);
+
+        dmArray<uint8_t>& buffer = world->m_EventBuffer;
+        if (buffer.Remaining() < size)
+        {
+            buffer.OffsetCapacity(dmMath::Max(size, buffer.Capacity()));
+        }
+        uint8_t* event = buffer.End();
+        buffer.SetSize(buffer.Size() + size);
+
+        PhysicsEventHeader header;
+        header.m_Descriptor = desc;
+        header.m_Size = size;
+        memcpy(event, &header, header_size);
+        memcpy(event + header_size, data, desc->m_Size);
+        world->m_EventCount++;
+    }
+
     void RunPhysicsCallback(CollisionWorld* world, const dmDDF::Descriptor* desc, const char* data)
     {
+        if (world->m_BatchEvents)
+        {
+            PushPhysicsEvent(world, desc, data);
+            return;
+        }
         RunCollisionWorldCallback(world->m_CallbackInfo, desc, data);
     }
 
     bool CollisionCallback(void* user_data_a, uint16_t group_a, void* user_data_b, uint16_t group_b, void* user_data)
     {
         CollisionUserData* cud = (CollisionUserData*)user_data;
-        if (cud->m_Count < cud->m_Context->m_MaxCollisionCount)
+        // The buffered events aren't limited, they don't use the message queues
+        if (cud->m_World->m_BatchEvents || cud->m_Count < cud->m_Context->m_MaxCollisionCount)
         {
             CollisionWorld* world = cud->m_World;
             cud->m_Count += 1;
@@ -663,7 +764,7 @@ namespace dmGameSystem
     bool ContactPointCallback(const dmPhysics::ContactPoint& contact_point, void* user_data)
     {
         CollisionUserData* cud = (CollisionUserData*)user_data;
-        if (cud->m_Count < cud->m_Context->m_MaxContactPointCount)
+        if (cud->m_World->m_BatchEvents || cud->m_Count < cud->m_Context->m_MaxContactPointCount)
         {
             CollisionWorld* world = cud->m_World;
             cud->m_Count += 1;
@@ -1033,7 +1134,19 @@ namespace dmGameSystem
             dmPhysics::StepWorld2D(world->m_World2D, *step_ctx);
         }
 
-        if (collision_user_data->m_Count >= physics_context->m_MaxCollisionCount)
+        if (world->m_EventCount > 0)
+        {
+            DM_PROFILE("PhysicsEvents");
+            // The listener might have been removed, or switched to unbatched mode, while the events were buffered
+            if (world->m_BatchEvents)
+            {
+                RunCollisionWorldBatchCallback(world->m_CallbackInfo, world->m_EventBuffer.Begin(), world->m_EventCount);
+            }
+            world->m_EventBuffer.SetSize(0);
+            world->m_EventCount = 0;
+        }
+
+        if (!world->m_BatchEvents && collision_user_data->m_Count >= physics_context->m_MaxCollisionCount)
         {
             if (!g_CollisionOverflowWarning)
             {
@@ -1045,7 +1158,7 @@ namespace dmGameSystem
         {
             g_CollisionOverflowWarning = false;
         }
-        if (contact_user_data->m_Count >= physics_context->m_MaxContactPointCount)
+        if (!world->m_BatchEvents && contact_user_data->m_Count >= physics_context->m_MaxContactPointCount)
         {
             if (!g_ContactOverflowWarning)
             {
@@ -1139,12 +1252,115 @@ namespace dmGameSystem
         return dmGameObject::UPDATE_RESULT_OK;
     }
 
+    // Puts the game objects back at the transforms of the latest fixed step, since the physics might read them back
+    static void BeginInterpolatedStep(CollisionWorld* world, dmGameObject::HCollection collection)
+    {
+        DM_PROFILE("BeginInterpolatedStep");
+        bool restored = false;
+        uint32_t num_components = world->m_Components.Size();
+        for (uint32_t i = 0; i < num_components; ++i)
+        {
+            CollisionComponent* component = world->m_Components[i];
+            TransformInterpolation* interpolation = component->m_Interpolation;
+            if (interpolation == 0x0)
+                continue;
+
+            dmGameObject::HInstance instance = component->m_Instance;
+            Point3 position = dmGameObject::GetPosition(instance);
+            Quat rotation = dmGameObject::GetRotation(instance);
+            if (!component->m_3D)
+            {
+                interpolation->m_Position.setZ(position.getZ());
+                interpolation->m_CurrentPosition.setZ(position.getZ());
+            }
+
+            if (!IsEqual(position, interpolation->m_Position) || !IsEqual(rotation, interpolation->m_Rotation))
+            {
+                // Moved by a script since it was interpolated, which takes precedence
+                interpolation->m_CurrentPosition = position;
+                interpolation->m_CurrentRotation = rotation;
+            }
+            else if (!IsEqual(position, interpolation->m_CurrentPosition) || !IsEqual(rotation, interpolation->m_CurrentRotation))
+            {
+                dmGameObject::SetPosition(instance, interpolation->m_CurrentPosition);
+                dmGameObject::SetRotation(instance, interpolation->m_CurrentRotation);
+                restored = true;
+            }
+            interpolation->m_Position = interpolation->m_CurrentPosition;
+            interpolation->m_Rotation = interpolation->m_CurrentRotation;
+            interpolation->m_PreviousPosition = interpolation->m_CurrentPosition;
+            interpolation->m_PreviousRotation = interpolation->m_CurrentRotation;
+        }
+
+        if (restored)
+        {
+            dmGameObject::UpdateTransforms(collection);
+        }
+    }
+
+    // Moves the game objects to the transforms at the time left until the next fixed step
+    static void InterpolateTransforms(CollisionWorld* world, dmGameObject::HCollection collection)
+    {
+        if (world->m_FixedDT <= 0.0f)
+            return;
+
+        DM_PROFILE("InterpolateTransforms");
+        const float t = dmMath::Clamp(world->m_AccumTime / world->m_FixedDT, 0.0f, 1.0f);
+        bool updated = false;
+        uint32_t num_components = world->m_Components.Size();
+        for (uint32_t i = 0; i < num_components; ++i)
+        {
+            CollisionComponent* component = world->m_Components[i];
+            TransformInterpolation* interpolation = component->m_Interpolation;
+            if (interpolation == 0x0)
+                continue;
+
+            dmGameObject::HInstance instance = component->m_Instance;
+            Point3 position = dmGameObject::GetPosition(instance);
+            Quat rotation = dmGameObject::GetRotation(instance);
+            if (!component->m_3D)
+            {
+                interpolation->m_Position.setZ(position.getZ());
+                interpolation->m_PreviousPosition.setZ(position.getZ());
+                interpolation->m_CurrentPosition.setZ(position.getZ());
+            }
+            // Leave the objects moved by a script
+            if (!IsEqual(position, interpolation->m_Position) || !IsEqual(rotation, interpolation->m_Rotation))
+                continue;
+            // Nothing to interpolate for bodies at rest that are already in place
+            if (IsEqual(interpolation->m_PreviousPosition, interpolation->m_CurrentPosition) && IsEqual(interpolation->m_PreviousRotation, interpolation->m_CurrentRotation)
+                && IsEqual(position, interpolation->m_CurrentPosition) && IsEqual(rotation, interpolation->m_CurrentRotation))
+                continue;
+
+            interpolation->m_Position = lerp(t, interpolation->m_PreviousPosition, interpolation->m_CurrentPosition);
+            interpolation->m_Rotation = slerp(t, interpolation->m_PreviousRotation, interpolation->m_CurrentRotation);
+            dmGameObject::SetPosition(instance, interpolation->m_Position);
+            dmGameObject::SetRotation(instance, interpolation->m_Rotation);
+            updated = true;
+        }
+
+        if (updated)
+        {
+            dmGameObject::UpdateTransforms(collection);
+        }
+    }
+
     dmGameObject::UpdateResult CompCollisionObjectUpdate(const dmGameObject::ComponentsUpdateParams& params, dmGameObject::ComponentsUpdateResult& update_result)
     {
 
         PhysicsContext* physics_context = (PhysicsContext*)params.m_Context;
         if (physics_context->m_UseFixedTimestep)
+        {
+            // The fixed updates of the frame run after this update, and use up the time in fixed steps.
+            // The time isn't passing when the collection is paused, and the objects should keep their transforms.
+            CollisionWorld* world = (CollisionWorld*)params.m_World;
+            const dmGameObject::UpdateContext* update_context = params.m_UpdateContext;
+            if (world != 0x0 && physics_context->m_FixedTimestepInterpolation && update_context->m_TimeScale > 0.001f)
+            {
+                world->m_AccumTime = update_context->m_AccumFrameTime * update_context->m_TimeScale + update_context->m_DT;
+            }
             return dmGameObject::UPDATE_RESULT_OK; // Let the fixed update handle this
+        }
 
         return CompCollisionObjectUpdateInternal(params, update_result);
     }
@@ -1155,6 +1371,14 @@ namespace dmGameSystem
         if (!physics_context->m_UseFixedTimestep)
             return dmGameObject::UPDATE_RESULT_OK; // Let the dynamic update handle this
 
+        CollisionWorld* world = (CollisionWorld*)params.m_World;
+        if (world != 0x0 && physics_context->m_FixedTimestepInterpolation)
+        {
+            world->m_AccumTime -= params.m_UpdateContext->m_DT;
+            world->m_FixedDT = params.m_UpdateContext->m_DT;
+            BeginInterpolatedStep(world, params.m_Collection);
+        }
+
         return CompCollisionObjectUpdateInternal(params, update_result);
     }
 
@@ -1171,6 +1395,12 @@ namespace dmGameSystem
         if (!CompCollisionObjectDispatchPhysicsMessages(physics_context, world, params.m_Collection))
             return dmGameObject::UPDATE_RESULT_UNKNOWN_ERROR;
 
+        // After the fixed updates of the frame
+        if (physics_context->m_UseFixedTimestep && physics_context->m_FixedTimestepInterpolation)
+        {
+            InterpolateTransforms(world, params.m_Collection);
+        }
+
         return dmGameObject::UPDATE_RESULT_OK;
     }
 
@@ -1272,26 +1502,29 @@ namespace dmGameSystem
                 return dmGameObject::UPDATE_RESULT_UNKNOWN_ERROR;
             }
 
-            dmPhysics::HullFlags flags;
-            flags.m_FlipHorizontal = ddf->m_FlipHorizontal;
-            flags.m_FlipVertical = ddf->m_FlipVertical;
-            flags.m_Rotate90 = ddf->m_Rotate90;
-            bool success = dmPhysics::SetGridShapeHull(component->m_Object2D, ddf->m_Shape, row, column, hull, flags);
+            dmPhysics::GridShapeHullDesc desc;
+            desc.m_ShapeIndex = ddf->m_Shape;
+            desc.m_Row = row;
+            desc.m_Column = column;
+            desc.m_Hull = hull;
+            desc.m_Group = 0;
+            desc.m_Mask = 0;
+            // Hull-index of 0xffffffff is empty cell
+            if (hull != ~0u)
+            {
+                desc.m_Group = GetGroupBitIndex((CollisionWorld*)params.m_World, tile_grid_resource->m_TextureSet->m_HullCollisionGroups[hull], false);
+                desc.m_Mask = component->m_Mask;
+            }
+            desc.m_Flags.m_FlipHorizontal = ddf->m_FlipHorizontal;
+            desc.m_Flags.m_FlipVertical = ddf->m_FlipVertical;
+            desc.m_Flags.m_Rotate90 = ddf->m_Rotate90;
+            // Only refilters the contacts of the edited cell
+            bool success = dmPhysics::SetGridShapeHulls(component->m_Object2D, &desc, 1);
             if (!success)
             {
                 dmLogError("SetGridShapeHull: unable to set hull %d for shape %d", hull, ddf->m_Shape);
                 return dmGameObject::UPDATE_RESULT_UNKNOWN_ERROR;
             }
-            uint32_t child = column + tile_grid_resource->m_ColumnCount * row;
-            uint16_t group = 0;
-            uint16_t mask = 0;
-            // Hull-index of 0xffffffff is empty cell
-            if (hull != ~0u)
-            {
-                group = GetGroupBitIndex((CollisionWorld*)params.m_World, tile_grid_resource->m_TextureSet->m_HullCollisionGroups[hull], false);
-                mask = component->m_Mask;
-            }
-            dmPhysics::SetCollisionObjectFilter(component->m_Object2D, ddf->m_Shape, child, group, mask);
         }
         else if(params.m_Message->m_Id == dmPhysicsDDF::EnableGridShapeLayer::m_DDFDescriptor->m_NameHash)
         {
@@ -1307,6 +1540,62 @@ namespace dmGameSystem
         return dmGameObject::UPDATE_RESULT_OK;
     }
 
+    uint64_t CompCollisionObjectHashState(const dmGameObject::ComponentsHashStateParams& params)
+    {
+        PhysicsContext* physics_context = (PhysicsContext*)params.m_Context;
+        CollisionWorld* world = (CollisionWorld*)params.m_World;
+
+        // The state of the bodies, without the padding of the vector types
+        struct BodyState
+        {
+            dmhash_t m_Identifier;
+            uint32_t m_ComponentIndex;
+            float    m_Position[3];
+            float    m_Rotation[4];
+            float    m_LinearVelocity[3];
+            float    m_AngularVelocity[3];
+        } state;
+
+        // Summed, so that the order of the components doesn't matter
+        uint64_t hash = 0;
+        uint32_t count = world->m_Components.Size();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            CollisionComponent* component = world->m_Components[i];
+            Point3 position;
+            Quat rotation;
+            Vector3 linear_velocity;
+            Vector3 angular_velocity;
+            if (physics_context->m_3D)
+            {
+                if (!component->m_Object3D)
+                    continue;
+                position = dmPhysics::GetWorldPosition3D(physics_context->m_Context3D, component->m_Object3D);
+                rotation = dmPhysics::GetWorldRotation3D(physics_context->m_Context3D, component->m_Object3D);
+                linear_velocity = dmPhysics::GetLinearVelocity3D(physics_context->m_Context3D, component->m_Object3D);
+                angular_velocity = dmPhysics::GetAngularVelocity3D(physics_context->m_Context3D, component->m_Object3D);
+            }
+            else
+            {
+                if (!component->m_Object2D)
+                    continue;
+                position = dmPhysics::GetWorldPosition2D(physics_context->m_Context2D, component->m_Object2D);
+                rotation = dmPhysics::GetWorldRotation2D(physics_context->m_Context2D, component->m_Object2D);
+                linear_velocity = dmPhysics::GetLinearVelocity2D(physics_context->m_Context2D, component->m_Object2D);
+                angular_velocity = dmPhysics::GetAngularVelocity2D(physics_context->m_Context2D, component->m_Object2D);
+            }
+
+            state.m_Identifier = dmGameObject::GetIdentifier(component->m_Instance);
+            state.m_ComponentIndex = component->m_ComponentIndex;
+            state.m_Position[0] = position.getX(); state.m_Position[1] = position.getY(); state.m_Position[2] = position.getZ();
+            state.m_Rotation[0] = rotation.getX(); state.m_Rotation[1] = rotation.getY(); state.m_Rotation[2] = rotation.getZ(); state.m_Rotation[3] = rotation.getW();
+            state.m_LinearVelocity[0] = linear_velocity.getX(); state.m_LinearVelocity[1] = linear_velocity.getY(); state.m_LinearVelocity[2] = linear_velocity.getZ();
+            state.m_AngularVelocity[0] = angular_velocity.getX(); state.m_AngularVelocity[1] = angular_velocity.getY(); state.m_AngularVelocity[2] = angular_velocity.getZ();
+            hash += dmHashBufferNoReverse64(&state, sizeof(state));
+        }
+        return hash;
+    }
+
     void CompCollisionObjectOnReload(const dmGameObject::ComponentOnReloadParams& params)
     {
         PhysicsContext* physics_context = (PhysicsContext*)params.m_Context;
@@ -1484,6 +1773,45 @@ namespace dmGameSystem
         }
     }
 
+    void RayCastBatch(void* _world, const dmPhysics::RayCastRequest* requests, uint32_t count, dmPhysics::RayCastResponse* responses)
+    {
+        CollisionWorld* world = (CollisionWorld*)_world;
+        if (world->m_3D)
+        {
+            dmPhysics::RayCastBatch3D(world->m_World3D, requests, count, responses);
+        }
+        else
+        {
+            dmPhysics::RayCastBatch2D(world->m_World2D, requests, count, responses);
+        }
+    }
+
+    void QueryBox(void* _world, const dmVMath::Point3& position, const dmVMath::Quat& rotation, const dmVMath::Vector3& half_extents, uint16_t mask, dmArray<dmPhysics::OverlapResponse>& results)
+    {
+        CollisionWorld* world = (CollisionWorld*)_world;
+        if (world->m_3D)
+        {
+            dmPhysics::QueryBox3D(world->m_World3D, position, rotation, half_extents, mask, results);
+        }
+        else
+        {
+            dmPhysics::QueryBox2D(world->m_World2D, position, rotation, half_extents, mask, results);
+        }
+    }
+
+    void QuerySphere(void* _world, const dmVMath::Point3& position, float radius, uint16_t mask, dmArray<dmPhysics::OverlapResponse>& results)
+    {
+        CollisionWorld* world = (CollisionWorld*)_world;
+        if (world->m_3D)
+        {
+            dmPhysics::QuerySphere3D(world->m_World3D, position, radius, mask, results);
+        }
+        else
+        {
+            dmPhysics::QueryCircle2D(world->m_World2D, position, radius, mask, results);
+        }
+    }
+
     // Find a JointEntry in the linked list of a collision component based on the joint id.
     static JointEntry* FindJointEntry(CollisionWorld* world, CollisionComponent* component, dmhash_t id)
     {
@@ -2002,10 +2330,11 @@ namespace dmGameSystem
         return world->m_CallbackInfo;
     }
 
-    void SetCollisionWorldCallback(void* _world, void* callback_info)
+    void SetCollisionWorldCallback(void* _world, void* callback_info, bool batch_events)
     {
         CollisionWorld* world = (CollisionWorld*)_world;
         world->m_CallbackInfo = callback_info;
+        world->m_BatchEvents = callback_info != 0x0 && batch_events;
     }
 
     dmhash_t GetCollisionGroup(void* _world, void* _component)
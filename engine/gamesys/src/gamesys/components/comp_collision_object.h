@@ -51,6 +51,8 @@ namespace dmGameSystem
 
     dmGameObject::UpdateResult CompCollisionObjectOnMessage(const dmGameObject::ComponentOnMessageParams& params);
 
+    uint64_t CompCollisionObjectHashState(const dmGameObject::ComponentsHashStateParams& params);
+
     void*                      CompCollisionObjectGetComponent(const dmGameObject::ComponentGetParams& params);
 
     void CompCollisionObjectOnReload(const dmGameObject::ComponentOnReloadParams& params);
@@ -65,6 +67,10 @@ namespace dmGameSystem
 
     // For script_physics.cpp
     void RayCast(void* world, const dmPhysics::RayCastRequest& request, dmArray<dmPhysics::RayCastResponse>& results);
+    void RayCastBatch(void* world, const dmPhysics::RayCastRequest* requests, uint32_t count, dmPhysics::RayCastResponse* responses);
+    void QueryBox(void* world, const dmVMath::Point3& position, const dmVMath::Quat& rotation, const dmVMath::Vector3& half_extents, uint16_t mask, dmArray<dmPhysics::OverlapResponse>& results);
+    // A circle in 2D physics
+    void QuerySphere(void* world, const dmVMath::Point3& position, float radius, uint16_t mask, dmArray<dmPhysics::OverlapResponse>& results);
     uint64_t GetLSBGroupHash(void* world, uint16_t mask);
     dmhash_t CompCollisionObjectGetIdentifier(void* component);
 
@@ -89,9 +95,21 @@ namespace dmGameSystem
     bool SetCollisionMaskBit(void* _world, void* _component, dmhash_t group_hash, bool boolvalue);
     void UpdateMass(void* _world, void* _component, float mass);
 
+    // The header of an event in the event buffer of a world, followed by the DDF data of the event
+    struct PhysicsEventHeader
+    {
+        const dmDDF::Descriptor*    m_Descriptor;
+        uint32_t                    m_Size;     // Size including the header, a multiple of sizeof(PhysicsEventHeader)
+    };
+
+    // The largest DDF data of a buffered event
+    static const uint32_t PHYSICS_EVENT_MAX_DATA_SIZE = 512;
+
     void* GetCollisionWorldCallback(void* _world);
-    void SetCollisionWorldCallback(void* _world, void* callback_info);
+    // With batch_events set, the events of a step are buffered and delivered in one call after the step
+    void SetCollisionWorldCallback(void* _world, void* callback_info, bool batch_events);
     void RunCollisionWorldCallback(void* callback_data, const dmDDF::Descriptor* desc, const char* data);
+    void RunCollisionWorldBatchCallback(void* callback_data, const uint8_t* events, uint32_t event_count);
 
     struct ShapeInfo
     {
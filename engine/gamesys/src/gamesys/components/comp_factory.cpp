@@ -44,6 +44,9 @@ namespace dmGameSystem
     static void CleanupAsyncLoading(lua_State*, FactoryComponent*);
     static bool PreloadCompleteCallback(const dmResource::PreloaderCompleteCallbackParams*);
     static void LoadComplete(const dmGameObject::ComponentsUpdateParams&, FactoryComponent*, const dmResource::Result);
+    static void DeletePool(FactoryComponent*);
+    static dmGameObject::HInstance CompFactorySpawnInstance(FactoryWorld*, FactoryComponent*, dmGameObject::HCollection, dmhash_t,
+                                                            const dmVMath::Point3&, const dmVMath::Quat&, const dmVMath::Vector3&, dmGameObject::HPropertyContainer);
 
     struct FactoryComponent
     {
@@ -52,6 +55,9 @@ namespace dmGameSystem
         FactoryResource*        m_Resource;
         FactoryResource*        m_CustomResource;
         dmResource::HPreloader  m_Preloader;
+        dmGameObject::HInstancePool m_Pool;
+        uint32_t                m_PoolSize;
+        uint32_t                m_PoolPreallocate;
         int                     m_PreloaderCallbackRef;
         int                     m_PreloaderSelfRef;
         int                     m_PreloaderURLRef;
@@ -131,6 +137,9 @@ namespace dmGameSystem
         FactoryComponent* component = (FactoryComponent*)*params.m_UserData;
         CleanupAsyncLoading(dmScript::GetLuaState(((FactoryContext*)params.m_Context)->m_ScriptContext), component);
         uint32_t index = component - &world->m_Components[0];
+        DeletePool(component);
+        component->m_PoolSize = 0;
+        component->m_PoolPreallocate = 0;
         component->m_Resource = 0x0;
         if (component->m_CustomResource)
             dmGameSystem::ResFactoryDestroyResource(world->m_Factory, component->m_CustomResource);
@@ -227,9 +236,7 @@ namespace dmGameSystem
             {
                 scale = create->m_Scale3;
             }
-            dmGameObject::HPrototype prototype = CompFactoryGetPrototype(world, fc);
-            dmGameObject::HInstance spawned_instance =  dmGameObject::Spawn(collection, prototype, CompFactoryGetPrototypePath(world, fc),
-                                                                            id, properties, create->m_Position, create->m_Rotation, scale);
+            dmGameObject::HInstance spawned_instance = CompFactorySpawnInstance(world, fc, collection, id, create->m_Position, create->m_Rotation, scale, properties);
             if (index != dmGameObject::INVALID_INSTANCE_POOL_INDEX)
             {
                 if (spawned_instance != 0x0)
@@ -330,6 +337,8 @@ namespace dmGameSystem
         }
         if(resource->m_Prototype)
         {
+            // The pool holds a reference to the prototype
+            DeletePool(component);
             dmResource::Release(world->m_Factory, resource->m_Prototype);
             resource->m_Prototype = 0;
         }
@@ -387,8 +396,42 @@ namespace dmGameSystem
 
     void CompFactorySetResource(HFactoryWorld world, HFactoryComponent component, FactoryResource* resource)
     {
+        DeletePool(component);
         component->m_CustomResource = resource;
     }
+
+    static void DeletePool(HFactoryComponent component)
+    {
+        if (component->m_Pool)
+        {
+            dmGameObject::DeleteInstancePool(component->m_Pool);
+            component->m_Pool = 0;
+        }
+    }
+
+    // The pool is created when the prototype is available, at the latest when spawning
+    static dmGameObject::HInstancePool GetPool(HFactoryWorld world, HFactoryComponent component, dmGameObject::HPrototype prototype)
+    {
+        if (component->m_PoolSize == 0 || prototype == 0)
+            return 0;
+        if (!component->m_Pool)
+        {
+            component->m_Pool = dmGameObject::NewInstancePool(world->m_Factory, prototype, CompFactoryGetPrototypePath(world, component),
+                                                              component->m_PoolPreallocate, component->m_PoolSize);
+        }
+        return component->m_Pool;
+    }
+
+    void CompFactorySetPoolSize(HFactoryWorld world, HFactoryComponent component, uint32_t size, uint32_t preallocate)
+    {
+        DeletePool(component);
+        component->m_PoolSize = size;
+        component->m_PoolPreallocate = preallocate;
+
+        FactoryResource* resource = CompFactoryGetResourceInternal(component);
+        if (resource->m_Prototype)
+            GetPool(world, component, resource->m_Prototype);
+    }
     // end scripting
 
     dmGameObject::PropertyResult CompFactoryGetProperty(const dmGameObject::ComponentGetPropertyParams& params, dmGameObject::PropertyDesc& out_value)
@@ -464,15 +507,25 @@ namespace dmGameSystem
     }
 
 
+    static dmGameObject::HInstance CompFactorySpawnInstance(HFactoryWorld world, HFactoryComponent component, dmGameObject::HCollection collection, dmhash_t id,
+                                                            const dmVMath::Point3& position, const dmVMath::Quat& rotation, const dmVMath::Vector3& scale,
+                                                            dmGameObject::HPropertyContainer properties)
+    {
+        dmGameObject::HPrototype prototype = CompFactoryGetPrototype(world, component);
+        const char* path = CompFactoryGetPrototypePath(world, component);
+
+        dmGameObject::HInstancePool pool = GetPool(world, component, prototype);
+        if (pool)
+            return dmGameObject::SpawnFromPool(collection, pool, path, id, properties, position, rotation, scale);
+        return dmGameObject::Spawn(collection, prototype, path, id, properties, position, rotation, scale);
+    }
+
     dmGameObject::HInstance CompFactorySpawn(HFactoryWorld world, HFactoryComponent component, dmGameObject::HCollection collection,
                                                 uint32_t index, dmhash_t id,
                                                 const dmVMath::Point3& position, const dmVMath::Quat& rotation, const dmVMath::Vector3& scale,
                                                 dmGameObject::HPropertyContainer properties)
     {
-        dmGameObject::HPrototype prototype = CompFactoryGetPrototype(world, component);
-        const char* path = CompFactoryGetPrototypePath(world, component);
-
-        dmGameObject::HInstance instance = dmGameObject::Spawn(collection, prototype, path, id, properties, position, rotation, scale);
+        dmGameObject::HInstance instance = CompFactorySpawnInstance(world, component, collection, id, position, rotation, scale, properties);
         if (instance != 0x0)
         {
             dmGameObject::AssignInstanceIndex(index, instance);
@@ -484,5 +537,32 @@ namespace dmGameSystem
         return instance;
     }
 
+    uint32_t CompFactorySpawnBatch(HFactoryWorld world, HFactoryComponent component, dmGameObject::HCollection collection,
+                                    uint32_t count, const uint32_t* indices, const dmhash_t* ids,
+                                    const dmVMath::Point3* positions, const dmVMath::Quat* rotations, const dmVMath::Vector3* scales,
+                                    dmGameObject::HPropertyContainer properties, dmGameObject::HInstance* out_instances)
+    {
+        dmGameObject::HPrototype prototype = CompFactoryGetPrototype(world, component);
+        const char* path = CompFactoryGetPrototypePath(world, component);
+
+        dmGameObject::HInstancePool pool = GetPool(world, component, prototype);
+        uint32_t spawned;
+        if (pool)
+            spawned = dmGameObject::SpawnBatchFromPool(collection, pool, path, count, ids, properties, positions, rotations, scales, out_instances);
+        else
+            spawned = dmGameObject::SpawnBatch(collection, prototype, path, count, ids, properties, positions, rotations, scales, out_instances);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (out_instances[i] != 0x0)
+            {
+                dmGameObject::AssignInstanceIndex(indices[i], out_instances[i]);
+            }
+            else
+            {
+                dmGameObject::ReleaseInstanceIndex(indices[i], collection);
+            }
+        }
+        return spawned;
+    }
 
 }
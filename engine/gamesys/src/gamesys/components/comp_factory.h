@@ -42,6 +42,9 @@ namespace dmGameSystem
     HFactoryResource    CompFactoryGetDefaultResource(HFactoryWorld world, HFactoryComponent component);
     HFactoryResource    CompFactoryGetCustomResource(HFactoryWorld world, HFactoryComponent component);
 
+    // Pool the spawned instances. A size of 0 disables the pool
+    void                CompFactorySetPoolSize(HFactoryWorld world, HFactoryComponent component, uint32_t size, uint32_t preallocate);
+
 }
 
 #endif
@@ -13,6 +13,7 @@
 // specific language governing permissions and limitations under the License.
 
 #include <string.h>
+#include <float.h>
 
 #include <dlib/dlib.h>
 #include <dlib/array.h>
@@ -55,6 +56,17 @@
 
 DM_PROPERTY_EXTERN(rmtp_Gui);
 DM_PROPERTY_U32(rmtp_GuiVertexCount, 0, FrameReset, "#", &rmtp_Gui);
+DM_PROPERTY_U32(rmtp_GuiBatchCount, 0, FrameReset, "#", &rmtp_Gui);
+DM_PROPERTY_U32(rmtp_GuiMergedNodes, 0, FrameReset, "# entries moved to merge batches", &rmtp_Gui);
+DM_PROPERTY_GROUP(rmtp_GuiBatchBreaks, "Gui batch breaks, by the state that changed", &rmtp_Gui);
+DM_PROPERTY_U32(rmtp_GuiBatchBreakNodeType, 0, FrameReset, "#", &rmtp_GuiBatchBreaks);
+DM_PROPERTY_U32(rmtp_GuiBatchBreakBlendMode, 0, FrameReset, "#", &rmtp_GuiBatchBreaks);
+DM_PROPERTY_U32(rmtp_GuiBatchBreakTexture, 0, FrameReset, "#", &rmtp_GuiBatchBreaks);
+DM_PROPERTY_U32(rmtp_GuiBatchBreakMaterial, 0, FrameReset, "#", &rmtp_GuiBatchBreaks);
+DM_PROPERTY_U32(rmtp_GuiBatchBreakFont, 0, FrameReset, "#", &rmtp_GuiBatchBreaks);
+DM_PROPERTY_U32(rmtp_GuiBatchBreakStencil, 0, FrameReset, "#", &rmtp_GuiBatchBreaks);
+DM_PROPERTY_U32(rmtp_GuiBatchBreakEmitter, 0, FrameReset, "#", &rmtp_GuiBatchBreaks);
+DM_PROPERTY_U32(rmtp_GuiBatchBreakConstants, 0, FrameReset, "#", &rmtp_GuiBatchBreaks);
 
 namespace dmGameSystem
 {
@@ -125,6 +137,7 @@ namespace dmGameSystem
         uint32_t                    m_MaxParticleFXCount;
         uint32_t                    m_MaxParticleCount;
         uint32_t                    m_MaxAnimationCount;
+        uint8_t                     m_MergeBatches : 1;
     };
 
     static void GuiResourceReloadedCallback(const dmResource::ResourceReloadedParams* params)
@@ -919,8 +932,8 @@ namespace dmGameSystem
         gui_component->m_AddedToUpdate = 0;
 
         dmGui::NewSceneParams scene_params;
-        // This is a hard cap since the render key has 13 bits for node index (see gui.cpp)
-        assert(scene_desc->m_MaxNodes <= 8192);
+        // This is a hard cap since the node handle has 16 bits for the node index (see gui.h)
+        assert(scene_desc->m_MaxNodes <= dmGui::MAX_NODE_COUNT);
         scene_params.m_MaxNodes = scene_desc->m_MaxNodes;
         scene_params.m_UserData = gui_component;
         scene_params.m_MaxFonts = 64;
@@ -1104,7 +1117,7 @@ namespace dmGameSystem
         ApplyStencilClipping(gui_context, state, params.m_StencilTestParams);
     }
 
-    static inline dmGraphics::HTexture GetNodeTexture(dmGui::HScene scene, dmGui::HNode node)
+    static inline TextureResource* GetNodeTextureResource(dmGui::HScene scene, dmGui::HNode node)
     {
         dmGui::NodeTextureType texture_type;
         dmGui::HTextureSource texture_source = dmGui::GetNodeTexture(scene, node, &texture_type);
@@ -1113,16 +1126,29 @@ namespace dmGameSystem
         {
             TextureSetResource* texture_set_res = (TextureSetResource*) texture_source;
             assert(texture_set_res->m_Texture);
-            return texture_set_res->m_Texture->m_Texture;
+            return texture_set_res->m_Texture;
         }
         else if (texture_type == dmGui::NODE_TEXTURE_TYPE_TEXTURE)
         {
-            TextureResource* texture_res = (TextureResource*) texture_source;
-            return texture_res->m_Texture;
+            return (TextureResource*) texture_source;
         }
         return 0;
     }
 
+    static inline dmGraphics::HTexture GetNodeTexture(dmGui::HScene scene, dmGui::HNode node)
+    {
+        TextureResource* texture_res = GetNodeTextureResource(scene, node);
+        return texture_res ? texture_res->m_Texture : 0;
+    }
+
+    // Gets the texture to draw the node with, and lets texture streaming know that it is drawn
+    static inline dmGraphics::HTexture GetNodeRenderTexture(dmGui::HScene scene, dmGui::HNode node)
+    {
+        TextureResource* texture_res = GetNodeTextureResource(scene, node);
+        ReportTextureFullSize(texture_res);
+        return texture_res ? texture_res->m_Texture : 0;
+    }
+
     static inline dmGameSystemDDF::TextureSet* GetNodeTextureSetDDF(dmGui::HScene scene, dmGui::HNode node)
     {
         dmGui::TextureSetAnimDesc* anim_desc = dmGui::GetNodeTextureSet(scene, node);
@@ -1258,6 +1284,7 @@ namespace dmGameSystem
 
         TextureResource* texture_res = (TextureResource*) first_emitter_render_data->m_Texture;
         dmGraphics::HTexture texture = texture_res ? texture_res->m_Texture : 0;
+        ReportTextureFullSize(texture_res);
 
         ro.Init();
         ro.m_VertexDeclaration = gui_world->m_VertexDeclaration;
@@ -1473,7 +1500,7 @@ namespace dmGameSystem
         }
 
         // Set default texture
-        dmGraphics::HTexture texture = dmGameSystem::GetNodeTexture(scene, first_node);
+        dmGraphics::HTexture texture = GetNodeRenderTexture(scene, first_node);
         if (texture) {
             ro.m_Textures[0] = texture;
         } else {
@@ -1527,7 +1554,7 @@ namespace dmGameSystem
         }
 
         // Set default texture
-        dmGraphics::HTexture texture = dmGameSystem::GetNodeTexture(scene, first_node);
+        dmGraphics::HTexture texture = GetNodeRenderTexture(scene, first_node);
         if (texture)
             ro.m_Textures[0] = texture;
         else
@@ -1850,7 +1877,7 @@ namespace dmGameSystem
         ro.m_Material          = GetNodeMaterial(gui_context, scene, first_node);
 
         // Set default texture
-        dmGraphics::HTexture texture = dmGameSystem::GetNodeTexture(scene, first_node);
+        dmGraphics::HTexture texture = GetNodeRenderTexture(scene, first_node);
         if (texture)
             ro.m_Textures[0] = texture;
         else
@@ -2059,164 +2086,309 @@ namespace dmGameSystem
         return dmGui::GetNodeRenderConstantsHash(scene, node);
     }
 
-    // Called from gui.cpp
-    static void RenderNodes(dmGui::HScene scene,
-                    const dmGui::RenderEntry* entries,
-                    const Matrix4* node_transforms,
-                    const float* node_opacities,
-                    const dmGui::StencilScope** stencil_scopes,
-                    uint32_t node_count,
-                    void* context)
+    enum GuiBatchBreak
     {
-        DM_PROFILE("RenderNodes");
-
-        if (node_count == 0)
-            return;
-
-        RenderGuiContext* gui_context = (RenderGuiContext*) context;
-        GuiWorld* gui_world = gui_context->m_GuiWorld;
-
-        gui_world->m_RenderedParticlesSize = 0;
-        gui_context->m_FirstStencil = true;
+        GUI_BATCH_BREAK_NODE_TYPE   = 1 << 0,
+        GUI_BATCH_BREAK_BLEND_MODE  = 1 << 1,
+        GUI_BATCH_BREAK_TEXTURE     = 1 << 2,
+        GUI_BATCH_BREAK_MATERIAL    = 1 << 3,
+        GUI_BATCH_BREAK_FONT        = 1 << 4,
+        GUI_BATCH_BREAK_STENCIL     = 1 << 5,
+        GUI_BATCH_BREAK_EMITTER     = 1 << 6,
+        GUI_BATCH_BREAK_CONSTANTS   = 1 << 7,
+    };
 
-        dmGui::HNode first_node                         = entries[0].m_Node;
-        dmGui::BlendMode prev_blend_mode                = dmGui::GetNodeBlendMode(scene, first_node);
-        dmGui::NodeType prev_node_type                  = dmGui::GetNodeType(scene, first_node);
-        uint32_t prev_custom_type                       = dmGui::GetNodeCustomType(scene, first_node);
-        uint64_t prev_combined_type                     = GetCombinedNodeType(prev_node_type, prev_custom_type);
-        dmGraphics::HTexture prev_texture               = GetNodeTexture(scene, first_node);
-        void* prev_font                                 = dmGui::GetNodeFont(scene, first_node);
-        HComponentRenderConstants prev_render_constants = (HComponentRenderConstants) dmGui::GetNodeRenderConstants(scene, first_node);
-        const dmGui::StencilScope* prev_stencil_scope   = stencil_scopes[0];
-        uint32_t prev_emitter_batch_key                 = 0;
-        dmRender::HMaterial prev_material               = 0;
-        uint32_t prev_constants_hash                    = GetRenderConstantsHash(scene, first_node, prev_render_constants);
+    static void GetBatchState(RenderGuiContext* gui_context, dmGui::HScene scene, const dmGui::RenderEntry& entry, const dmGui::StencilScope* stencil_scope, GuiBatchState* state)
+    {
+        dmGui::HNode node          = entry.m_Node;
+        state->m_NodeType          = dmGui::GetNodeType(scene, node);
+        state->m_CustomType        = dmGui::GetNodeCustomType(scene, node);
+        state->m_CombinedType      = GetCombinedNodeType(state->m_NodeType, state->m_CustomType);
+        state->m_BlendMode         = dmGui::GetNodeBlendMode(scene, node);
+        state->m_Texture           = GetNodeTexture(scene, node);
+        state->m_Font              = dmGui::GetNodeFont(scene, node);
+        state->m_StencilScope      = stencil_scope;
+        state->m_EmitterBatchKey   = 0;
+        state->m_RenderConstants   = (HComponentRenderConstants) dmGui::GetNodeRenderConstants(scene, node);
+        state->m_ConstantsHash     = GetRenderConstantsHash(scene, node, state->m_RenderConstants);
 
-        if (prev_node_type == dmGui::NODE_TYPE_PARTICLEFX)
+        if (state->m_NodeType == dmGui::NODE_TYPE_PARTICLEFX)
         {
-            dmParticle::EmitterRenderData* emitter_render_data = (dmParticle::EmitterRenderData*)entries[0].m_RenderData;
-            prev_emitter_batch_key = emitter_render_data->m_MixedHashNoMaterial;
+            dmParticle::EmitterRenderData* emitter_render_data = (dmParticle::EmitterRenderData*)entry.m_RenderData;
+            state->m_EmitterBatchKey = emitter_render_data->m_MixedHashNoMaterial;
         }
 
-        if (prev_node_type == dmGui::NODE_TYPE_TEXT)
+        if (state->m_NodeType == dmGui::NODE_TYPE_TEXT)
         {
-            prev_material = GetTextNodeMaterial(gui_context, scene, first_node, (dmRender::HFontMap) prev_font);
+            state->m_Material = GetTextNodeMaterial(gui_context, scene, node, (dmRender::HFontMap) state->m_Font);
         }
         else
         {
-            prev_material = GetNodeMaterial(gui_context, scene, first_node);
+            state->m_Material = GetNodeMaterial(gui_context, scene, node);
         }
+    }
 
-        uint32_t i = 0;
-        uint32_t start = 0;
+    // Returns the GuiBatchBreak flags for the state that differs
+    static uint32_t GetBatchBreaks(const GuiBatchState& a, const GuiBatchState& b)
+    {
+        uint32_t breaks = 0;
+        breaks |= a.m_CombinedType    != b.m_CombinedType    ? GUI_BATCH_BREAK_NODE_TYPE  : 0;
+        breaks |= a.m_BlendMode       != b.m_BlendMode       ? GUI_BATCH_BREAK_BLEND_MODE : 0;
+        breaks |= a.m_Texture         != b.m_Texture         ? GUI_BATCH_BREAK_TEXTURE    : 0;
+        breaks |= a.m_Material        != b.m_Material        ? GUI_BATCH_BREAK_MATERIAL   : 0;
+        breaks |= a.m_Font            != b.m_Font            ? GUI_BATCH_BREAK_FONT       : 0;
+        breaks |= a.m_StencilScope    != b.m_StencilScope    ? GUI_BATCH_BREAK_STENCIL    : 0;
+        breaks |= a.m_EmitterBatchKey != b.m_EmitterBatchKey ? GUI_BATCH_BREAK_EMITTER    : 0;
+        breaks |= a.m_ConstantsHash   != b.m_ConstantsHash   ? GUI_BATCH_BREAK_CONSTANTS  : 0;
+        return breaks;
+    }
+
+    static void AddBatchBreakProperties(uint32_t breaks)
+    {
+        DM_PROPERTY_ADD_U32(rmtp_GuiBatchBreakNodeType,  (breaks & GUI_BATCH_BREAK_NODE_TYPE)  ? 1 : 0);
+        DM_PROPERTY_ADD_U32(rmtp_GuiBatchBreakBlendMode, (breaks & GUI_BATCH_BREAK_BLEND_MODE) ? 1 : 0);
+        DM_PROPERTY_ADD_U32(rmtp_GuiBatchBreakTexture,   (breaks & GUI_BATCH_BREAK_TEXTURE)    ? 1 : 0);
+        DM_PROPERTY_ADD_U32(rmtp_GuiBatchBreakMaterial,  (breaks & GUI_BATCH_BREAK_MATERIAL)   ? 1 : 0);
+        DM_PROPERTY_ADD_U32(rmtp_GuiBatchBreakFont,      (breaks & GUI_BATCH_BREAK_FONT)       ? 1 : 0);
+        DM_PROPERTY_ADD_U32(rmtp_GuiBatchBreakStencil,   (breaks & GUI_BATCH_BREAK_STENCIL)    ? 1 : 0);
+        DM_PROPERTY_ADD_U32(rmtp_GuiBatchBreakEmitter,   (breaks & GUI_BATCH_BREAK_EMITTER)    ? 1 : 0);
+        DM_PROPERTY_ADD_U32(rmtp_GuiBatchBreakConstants, (breaks & GUI_BATCH_BREAK_CONSTANTS)  ? 1 : 0);
+    }
 
-        while (i < node_count)
+    static void CalcMergeEntryBounds(dmGui::HScene scene, dmGui::HNode node, const Matrix4& transform, GuiMergeEntry* merge_entry)
+    {
+        dmGui::NodeType node_type = merge_entry->m_State.m_NodeType;
+        if (node_type != dmGui::NODE_TYPE_BOX && node_type != dmGui::NODE_TYPE_PIE && node_type != dmGui::NODE_TYPE_TEXT)
         {
-            dmGui::HNode node                          = entries[i].m_Node;
-            dmGui::BlendMode blend_mode                = dmGui::GetNodeBlendMode(scene, node);
-            dmGui::NodeType node_type                  = dmGui::GetNodeType(scene, node);
-            uint32_t custom_type                       = dmGui::GetNodeCustomType(scene, node);
-            uint64_t combined_type                     = GetCombinedNodeType(node_type, custom_type);
-            dmGraphics::HTexture texture               = GetNodeTexture(scene, node);
-            void* font                                 = dmGui::GetNodeFont(scene, node);
-            const dmGui::StencilScope* stencil_scope   = stencil_scopes[i];
-            uint32_t emitter_batch_key                 = 0;
-            dmRender::HMaterial material               = 0;
-            HComponentRenderConstants render_constants = (HComponentRenderConstants) dmGui::GetNodeRenderConstants(scene, node);
-            uint32_t constants_hash                    = GetRenderConstantsHash(scene, node, render_constants);
+            merge_entry->m_Bounded = 0;
+            return;
+        }
 
-            if (node_type == dmGui::NODE_TYPE_PARTICLEFX)
+        // Box and pie nodes are drawn within the unit quad of their transform
+        float min_x = 0.0f, min_y = 0.0f, max_x = 1.0f, max_y = 1.0f;
+        if (node_type == dmGui::NODE_TYPE_TEXT)
+        {
+            // The transform of text nodes doesn't include the size. Since the placement of the text depends on the
+            // alignment, we use a box that holds the text for any alignment, with some room for outlines and shadows.
+            Vector4 size = dmGui::GetNodeProperty(scene, node, dmGui::PROPERTY_SIZE);
+            dmRender::TextMetrics metrics;
+            memset(&metrics, 0, sizeof(metrics));
+            dmRender::HFontMap font_map = (dmRender::HFontMap) merge_entry->m_State.m_Font;
+            const char* text = dmGui::GetNodeText(scene, node);
+            if (font_map && text)
             {
-                dmParticle::EmitterRenderData* emitter_render_data = (dmParticle::EmitterRenderData*)entries[i].m_RenderData;
-                emitter_batch_key = emitter_render_data->m_MixedHashNoMaterial;
+                dmRender::GetTextMetrics(font_map, text, size.getX(), dmGui::GetNodeLineBreak(scene, node),
+                                         dmGui::GetNodeTextLeading(scene, node), dmGui::GetNodeTextTracking(scene, node), &metrics);
             }
+            float margin_x = metrics.m_Width + metrics.m_MaxAscent;
+            float margin_y = metrics.m_Height + metrics.m_MaxAscent + metrics.m_MaxDescent;
+            min_x = -margin_x;
+            min_y = -margin_y;
+            max_x = size.getX() + margin_x;
+            max_y = size.getY() + margin_y;
+        }
+
+        const Point3 corners[] = { Point3(min_x, min_y, 0.0f), Point3(max_x, min_y, 0.0f), Point3(min_x, max_y, 0.0f), Point3(max_x, max_y, 0.0f) };
+        merge_entry->m_Min[0] = merge_entry->m_Min[1] = FLT_MAX;
+        merge_entry->m_Max[0] = merge_entry->m_Max[1] = -FLT_MAX;
+        for (uint32_t i = 0; i < DM_ARRAY_SIZE(corners); ++i)
+        {
+            Vector4 p = transform * corners[i];
+            merge_entry->m_Min[0] = dmMath::Min(merge_entry->m_Min[0], (float) p.getX());
+            merge_entry->m_Min[1] = dmMath::Min(merge_entry->m_Min[1], (float) p.getY());
+            merge_entry->m_Max[0] = dmMath::Max(merge_entry->m_Max[0], (float) p.getX());
+            merge_entry->m_Max[1] = dmMath::Max(merge_entry->m_Max[1], (float) p.getY());
+        }
+        merge_entry->m_Bounded = 1;
+    }
+
+    // Moving an entry past another one keeps the visual result if they don't overlap, and neither of them
+    // writes to the stencil buffer in a way the other one depends on
+    static inline bool CanMovePast(const GuiMergeEntry& entry, const GuiMergeEntry& other)
+    {
+        if (!other.m_Bounded || other.m_State.m_StencilScope != entry.m_State.m_StencilScope)
+            return false;
+        return other.m_Max[0] <= entry.m_Min[0] || entry.m_Max[0] <= other.m_Min[0] ||
+               other.m_Max[1] <= entry.m_Min[1] || entry.m_Max[1] <= other.m_Min[1];
+    }
 
-            if (node_type == dmGui::NODE_TYPE_TEXT)
+    uint32_t MergeBatchEntries(GuiMergeEntry* merge_entries, uint32_t count)
+    {
+        uint32_t moved = 0;
+        for (uint32_t i = 1; i < count; ++i)
+        {
+            GuiMergeEntry& merge_entry = merge_entries[i];
+            const dmGui::StencilScope* stencil_scope = merge_entry.m_State.m_StencilScope;
+
+            // Entries drawing into the stencil buffer (i.e. clippers) stay where they are
+            if (!merge_entry.m_Bounded || (stencil_scope && stencil_scope->m_WriteMask != 0))
+                continue;
+
+            if (GetBatchBreaks(merge_entries[i - 1].m_State, merge_entry.m_State) == 0)
+                continue;
+
+            uint32_t end = i > MAX_MERGE_DISTANCE ? i - MAX_MERGE_DISTANCE : 0;
+            uint32_t target = i;
+            for (uint32_t j = i; j > end; --j)
             {
-                material = GetTextNodeMaterial(gui_context, scene, node, (dmRender::HFontMap) font);
+                const GuiMergeEntry& other = merge_entries[j - 1];
+                if (GetBatchBreaks(other.m_State, merge_entry.m_State) == 0)
+                {
+                    target = j;
+                    break;
+                }
+                if (!CanMovePast(merge_entry, other))
+                    break;
             }
-            else
+
+            if (target != i)
             {
-                material = GetNodeMaterial(gui_context, scene, node);
+                GuiMergeEntry tmp = merge_entry;
+                memmove(&merge_entries[target + 1], &merge_entries[target], sizeof(GuiMergeEntry) * (i - target));
+                merge_entries[target] = tmp;
+                ++moved;
             }
+        }
 
-            bool batch_change = combined_type          != prev_combined_type ||
-                                blend_mode             != prev_blend_mode    ||
-                                texture                != prev_texture       ||
-                                material               != prev_material      ||
-                                font                   != prev_font          ||
-                                prev_stencil_scope     != stencil_scope      ||
-                                prev_emitter_batch_key != emitter_batch_key  ||
-                                prev_constants_hash    != constants_hash;
+        return moved;
+    }
 
-            bool flush = (i > 0 && batch_change);
+    // Reorders the render entries so that entries that can be drawn in the same batch end up next to each other.
+    // An entry is only moved back past entries it doesn't overlap, so the visual order is kept.
+    static void MergeBatches(RenderGuiContext* gui_context, dmGui::HScene scene,
+                    const dmGui::RenderEntry** entries,
+                    const Matrix4** node_transforms,
+                    const float** node_opacities,
+                    const dmGui::StencilScope*** stencil_scopes,
+                    uint32_t node_count)
+    {
+        DM_PROFILE("MergeBatches");
 
-            if (flush)
-            {
-                uint32_t n = i - start;
+        GuiWorld* gui_world = gui_context->m_GuiWorld;
+        dmArray<GuiMergeEntry>& merge_entries = gui_world->m_MergeEntries;
+        if (merge_entries.Capacity() < node_count)
+        {
+            merge_entries.SetCapacity(node_count);
+            gui_world->m_MergedRenderEntries.SetCapacity(node_count);
+            gui_world->m_MergedTransforms.SetCapacity(node_count);
+            gui_world->m_MergedOpacities.SetCapacity(node_count);
+            gui_world->m_MergedStencilScopes.SetCapacity(node_count);
+        }
+        merge_entries.SetSize(node_count);
 
-                switch (prev_node_type)
-                {
-                    case dmGui::NODE_TYPE_TEXT:
-                        RenderTextNodes(scene, entries + start, node_transforms + start, node_opacities + start, stencil_scopes + start, prev_render_constants, n, gui_context);
-                        break;
-                    case dmGui::NODE_TYPE_BOX:
-                        RenderBoxNodes(scene, entries + start, node_transforms + start, node_opacities + start, stencil_scopes + start, prev_render_constants, n, gui_context);
-                        break;
-                    case dmGui::NODE_TYPE_PIE:
-                        RenderPieNodes(scene, entries + start, node_transforms + start, node_opacities + start, stencil_scopes + start, prev_render_constants, n, gui_context);
-                        break;
-                    case dmGui::NODE_TYPE_PARTICLEFX:
-                        RenderParticlefxNodes(scene, entries + start, node_transforms + start, node_opacities + start, stencil_scopes + start, prev_render_constants, n, gui_context);
-                        break;
-                    case dmGui::NODE_TYPE_CUSTOM:
-                        RenderCustomNodes(scene, prev_custom_type, GetCompGuiCustomType(gui_world->m_CompGuiContext, prev_custom_type), entries + start, node_transforms + start, node_opacities + start, stencil_scopes + start, prev_render_constants, n, gui_context);
-                        break;
-                    default:
-                        break;
-                }
+        for (uint32_t i = 0; i < node_count; ++i)
+        {
+            const dmGui::RenderEntry& entry = (*entries)[i];
+            GuiMergeEntry& merge_entry = merge_entries[i];
+            merge_entry.m_Index = i;
+            GetBatchState(gui_context, scene, entry, (*stencil_scopes)[i], &merge_entry.m_State);
+            CalcMergeEntryBounds(scene, entry.m_Node, (*node_transforms)[i], &merge_entry);
+        }
 
-                start = i;
-            }
-            prev_node_type = node_type;
-            prev_custom_type = custom_type;
-            prev_combined_type = combined_type;
-            prev_blend_mode = blend_mode;
-            prev_texture = texture;
-            prev_material = material;
-            prev_font = font;
-            prev_stencil_scope = stencil_scope;
-            prev_emitter_batch_key = emitter_batch_key;
-            prev_render_constants = render_constants;
-            prev_constants_hash = constants_hash;
+        uint32_t moved = MergeBatchEntries(merge_entries.Begin(), node_count);
+        DM_PROPERTY_ADD_U32(rmtp_GuiMergedNodes, moved);
+        if (moved == 0)
+            return;
 
-            ++i;
+        gui_world->m_MergedRenderEntries.SetSize(node_count);
+        gui_world->m_MergedTransforms.SetSize(node_count);
+        gui_world->m_MergedOpacities.SetSize(node_count);
+        gui_world->m_MergedStencilScopes.SetSize(node_count);
+        for (uint32_t i = 0; i < node_count; ++i)
+        {
+            uint32_t index = merge_entries[i].m_Index;
+            gui_world->m_MergedRenderEntries[i] = (*entries)[index];
+            gui_world->m_MergedTransforms[i]    = (*node_transforms)[index];
+            gui_world->m_MergedOpacities[i]     = (*node_opacities)[index];
+            gui_world->m_MergedStencilScopes[i] = (*stencil_scopes)[index];
         }
 
-        uint32_t n = i - start;
-        if (n > 0) {
-            switch (prev_node_type)
+        *entries         = gui_world->m_MergedRenderEntries.Begin();
+        *node_transforms = gui_world->m_MergedTransforms.Begin();
+        *node_opacities  = gui_world->m_MergedOpacities.Begin();
+        *stencil_scopes  = gui_world->m_MergedStencilScopes.Begin();
+    }
+
+    static void RenderNodeBatch(dmGui::HScene scene,
+                    const GuiBatchState& state,
+                    const dmGui::RenderEntry* entries,
+                    const Matrix4* node_transforms,
+                    const float* node_opacities,
+                    const dmGui::StencilScope** stencil_scopes,
+                    uint32_t n,
+                    RenderGuiContext* gui_context)
+    {
+        GuiWorld* gui_world = gui_context->m_GuiWorld;
+        DM_PROPERTY_ADD_U32(rmtp_GuiBatchCount, 1);
+
+        switch (state.m_NodeType)
+        {
+            case dmGui::NODE_TYPE_TEXT:
+                RenderTextNodes(scene, entries, node_transforms, node_opacities, stencil_scopes, state.m_RenderConstants, n, gui_context);
+                break;
+            case dmGui::NODE_TYPE_BOX:
+                RenderBoxNodes(scene, entries, node_transforms, node_opacities, stencil_scopes, state.m_RenderConstants, n, gui_context);
+                break;
+            case dmGui::NODE_TYPE_PIE:
+                RenderPieNodes(scene, entries, node_transforms, node_opacities, stencil_scopes, state.m_RenderConstants, n, gui_context);
+                break;
+            case dmGui::NODE_TYPE_PARTICLEFX:
+                RenderParticlefxNodes(scene, entries, node_transforms, node_opacities, stencil_scopes, state.m_RenderConstants, n, gui_context);
+                break;
+            case dmGui::NODE_TYPE_CUSTOM:
+                RenderCustomNodes(scene, state.m_CustomType, GetCompGuiCustomType(gui_world->m_CompGuiContext, state.m_CustomType), entries, node_transforms, node_opacities, stencil_scopes, state.m_RenderConstants, n, gui_context);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Called from gui.cpp
+    static void RenderNodes(dmGui::HScene scene,
+                    const dmGui::RenderEntry* entries,
+                    const Matrix4* node_transforms,
+                    const float* node_opacities,
+                    const dmGui::StencilScope** stencil_scopes,
+                    uint32_t node_count,
+                    void* context)
+    {
+        DM_PROFILE("RenderNodes");
+
+        if (node_count == 0)
+            return;
+
+        RenderGuiContext* gui_context = (RenderGuiContext*) context;
+        GuiWorld* gui_world = gui_context->m_GuiWorld;
+
+        gui_world->m_RenderedParticlesSize = 0;
+        gui_context->m_FirstStencil = true;
+
+        if (gui_world->m_CompGuiContext->m_MergeBatches)
+        {
+            MergeBatches(gui_context, scene, &entries, &node_transforms, &node_opacities, &stencil_scopes, node_count);
+        }
+
+        GuiBatchState prev_state;
+        GetBatchState(gui_context, scene, entries[0], stencil_scopes[0], &prev_state);
+
+        uint32_t start = 0;
+        for (uint32_t i = 1; i < node_count; ++i)
+        {
+            GuiBatchState state;
+            GetBatchState(gui_context, scene, entries[i], stencil_scopes[i], &state);
+
+            uint32_t breaks = GetBatchBreaks(prev_state, state);
+            if (breaks)
             {
-                case dmGui::NODE_TYPE_TEXT:
-                    RenderTextNodes(scene, entries + start, node_transforms + start, node_opacities + start, stencil_scopes + start, prev_render_constants, n, gui_context);
-                    break;
-                case dmGui::NODE_TYPE_BOX:
-                    RenderBoxNodes(scene, entries + start, node_transforms + start, node_opacities + start, stencil_scopes + start, prev_render_constants, n, gui_context);
-                    break;
-                case dmGui::NODE_TYPE_PIE:
-                    RenderPieNodes(scene, entries + start, node_transforms + start, node_opacities + start, stencil_scopes + start, prev_render_constants, n, gui_context);
-                    break;
-                case dmGui::NODE_TYPE_PARTICLEFX:
-                    RenderParticlefxNodes(scene, entries + start, node_transforms + start, node_opacities + start, stencil_scopes + start, prev_render_constants, n, gui_context);
-                    break;
-                case dmGui::NODE_TYPE_CUSTOM:
-                    RenderCustomNodes(scene, prev_custom_type, GetCompGuiCustomType(gui_world->m_CompGuiContext, prev_custom_type), entries + start, node_transforms + start, node_opacities + start, stencil_scopes + start, prev_render_constants, n, gui_context);
-                    break;
-                default:
-                    break;
+                AddBatchBreakProperties(breaks);
+                RenderNodeBatch(scene, prev_state, entries + start, node_transforms + start, node_opacities + start, stencil_scopes + start, i - start, gui_context);
+                start = i;
             }
+            prev_state = state;
         }
 
+        RenderNodeBatch(scene, prev_state, entries + start, node_transforms + start, node_opacities + start, stencil_scopes + start, node_count - start, gui_context);
+
         dmGraphics::SetVertexBufferData(gui_world->m_VertexBuffer,
                                         gui_world->m_ClientVertexBuffer.Size() * sizeof(BoxVertex),
                                         gui_world->m_ClientVertexBuffer.Begin(),
@@ -2444,15 +2616,25 @@ namespace dmGameSystem
         dmParticle::Update(gui_world->m_ParticleContext, params.m_UpdateContext->m_DT, &FetchAnimationCallback);
         const uint32_t count = gui_world->m_Components.Size();
         DM_PROPERTY_ADD_U32(rmtp_Gui, count);
+        bool animating = false;
         for (uint32_t i = 0; i < count; ++i)
         {
             GuiComponent* gui_component = gui_world->m_Components[i];
             if (gui_component->m_Enabled && gui_component->m_AddedToUpdate)
             {
                 dmGui::UpdateScene(gui_component->m_Scene, params.m_UpdateContext->m_DT);
+                if (dmGui::GetAnimationCount(gui_component->m_Scene) > 0 || dmGui::GetParticlefxCount(gui_component->m_Scene) > 0)
+                    animating = true;
             }
         }
 
+        // Animated nodes keep rendering when the engine renders on demand
+        if (animating)
+        {
+            CompGuiContext* gui_context = (CompGuiContext*)params.m_Context;
+            dmRender::InvalidateRender(gui_context->m_RenderContext);
+        }
+
         return dmGameObject::UPDATE_RESULT_OK;
     }
 
@@ -2596,6 +2778,7 @@ namespace dmGameSystem
             gui_input_action.m_AccZ = params.m_InputAction->m_AccZ;
             gui_input_action.m_AccelerationSet = params.m_InputAction->m_AccelerationSet;
             gui_input_action.m_UserID = params.m_InputAction->m_UserID;
+            gui_input_action.m_Timestamp = params.m_InputAction->m_Timestamp;
 
             gui_input_action.m_TouchCount = params.m_InputAction->m_TouchCount;
             int tc = params.m_InputAction->m_TouchCount;
@@ -3080,6 +3263,7 @@ namespace dmGameSystem
         gui_context->m_MaxParticleFXCount = dmConfigFile::GetInt(ctx->m_Config, "gui.max_particlefx_count", 64);
         gui_context->m_MaxParticleCount = dmConfigFile::GetInt(ctx->m_Config, "gui.max_particle_count", 1024);
         gui_context->m_MaxAnimationCount = dmConfigFile::GetInt(ctx->m_Config, "gui.max_animation_count", 1024);
+        gui_context->m_MergeBatches = dmConfigFile::GetInt(ctx->m_Config, "gui.merge_batches", 0) != 0;
 
         int32_t max_gui_count = dmConfigFile::GetInt(ctx->m_Config, "gui.max_instance_count", 128);
         gui_context->m_Worlds.SetCapacity(max_gui_count);
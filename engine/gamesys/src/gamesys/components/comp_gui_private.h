@@ -128,6 +128,35 @@ namespace dmGameSystem
         CompGuiNodeSetNodeDescFn    m_SetNodeDesc;
     };
 
+    // The state that decides if two render entries can be drawn in the same batch
+    struct GuiBatchState
+    {
+        uint64_t                    m_CombinedType;
+        dmGraphics::HTexture        m_Texture;
+        void*                       m_Font;
+        dmRender::HMaterial         m_Material;
+        const dmGui::StencilScope*  m_StencilScope;
+        HComponentRenderConstants   m_RenderConstants;
+        uint32_t                    m_ConstantsHash;
+        uint32_t                    m_EmitterBatchKey;
+        uint32_t                    m_CustomType;
+        dmGui::NodeType             m_NodeType;
+        dmGui::BlendMode            m_BlendMode;
+    };
+
+    // The max number of entries a render entry is moved back when merging batches
+    static const uint32_t MAX_MERGE_DISTANCE = 32;
+
+    // A render entry while the entries are reordered to merge batches (see "gui.merge_batches")
+    struct GuiMergeEntry
+    {
+        GuiBatchState   m_State;
+        uint32_t        m_Index;        // Index into the entries from dmGui::RenderScene
+        float           m_Min[2];       // Screen space bounds
+        float           m_Max[2];
+        uint32_t        m_Bounded : 1;  // Not set if the bounds are unknown (e.g. particlefx), other entries can't be moved past it
+    };
+
     struct GuiWorld
     {
         dmArray<GuiRenderObject>                 m_GuiRenderObjects;
@@ -139,6 +168,12 @@ namespace dmGameSystem
         uint32_t                                 m_BoxVertexStreamDeclarationCount;
         uint32_t                                 m_BoxVertexStructSize;
         dmArray<BoxVertex>                       m_ClientVertexBuffer;
+        // Scratch buffers for the reordered render entries
+        dmArray<GuiMergeEntry>                   m_MergeEntries;
+        dmArray<dmGui::RenderEntry>              m_MergedRenderEntries;
+        dmArray<dmVMath::Matrix4>                m_MergedTransforms;
+        dmArray<float>                           m_MergedOpacities;
+        dmArray<const dmGui::StencilScope*>      m_MergedStencilScopes;
         dmGraphics::HTexture                     m_WhiteTexture;
         dmParticle::HParticleContext             m_ParticleContext;
         dmGraphics::VertexAttributeInfos         m_ParticleAttributeInfos;
@@ -152,6 +187,10 @@ namespace dmGameSystem
     };
 
     typedef BoxVertex ParticleGuiVertex;
+
+    // Moves each entry back, at most MAX_MERGE_DISTANCE entries and only past entries it doesn't overlap,
+    // to the closest entry it can be batched with. Returns the number of moved entries
+    uint32_t MergeBatchEntries(GuiMergeEntry* merge_entries, uint32_t count);
 }
 
 #endif // DM_GAMESYS_COMP_GUI_PRIVATE_H
@@ -12,6 +12,8 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include <math.h>
+
 #include "comp_light.h"
 #include "resources/res_light.h"
 #include <gamesys/gamesys_ddf.h>
@@ -153,6 +155,34 @@ namespace dmGameSystem
         return dmGameObject::UPDATE_RESULT_OK;
     }
 
+    dmGameObject::UpdateResult CompLightRender(const dmGameObject::ComponentsRenderParams& params)
+    {
+        LightWorld* light_world = (LightWorld*) params.m_World;
+        dmRender::HRenderContext render_context = (dmRender::HRenderContext) params.m_Context;
+
+        // The lights are culled into the clusters of the render context, so that all the materials can use them
+        for (uint32_t i = 0; i < light_world->m_Lights.Size(); ++i)
+        {
+            Light* light = light_world->m_Lights[i];
+            if (!light->m_AddedToUpdate) {
+                continue;
+            }
+            dmGameSystemDDF::LightDesc* light_desc = *light->m_LightResource;
+            Quat rotation = dmGameObject::GetWorldRotation(light->m_Instance);
+
+            dmRender::LightParams light_params;
+            light_params.m_Position = dmGameObject::GetWorldPosition(light->m_Instance);
+            light_params.m_Direction = dmVMath::Rotate(rotation, Vector3(0.0f, 0.0f, -1.0f));
+            light_params.m_Color = light_desc->m_Color;
+            light_params.m_Intensity = light_desc->m_Intensity;
+            light_params.m_Range = light_desc->m_Range;
+            light_params.m_ConeAngle = light_desc->m_ConeAngle * ((float) M_PI / 180.0f);
+            light_params.m_Type = light_desc->m_Type == dmGameSystemDDF::SPOT ? dmRender::LIGHT_TYPE_SPOT : dmRender::LIGHT_TYPE_POINT;
+            dmRender::AddLight(render_context, light_params);
+        }
+        return dmGameObject::UPDATE_RESULT_OK;
+    }
+
     dmGameObject::UpdateResult CompLightOnMessage(const dmGameObject::ComponentOnMessageParams& params)
     {
         return dmGameObject::UPDATE_RESULT_OK;
@@ -31,6 +31,8 @@ namespace dmGameSystem
 
     dmGameObject::UpdateResult CompLightUpdate(const dmGameObject::ComponentsUpdateParams& params, dmGameObject::ComponentsUpdateResult& update_result);
 
+    dmGameObject::UpdateResult CompLightRender(const dmGameObject::ComponentsRenderParams& params);
+
     dmGameObject::UpdateResult CompLightOnMessage(const dmGameObject::ComponentOnMessageParams& params);
 
     void*                      CompLightGetComponent(const dmGameObject::ComponentGetParams& params);
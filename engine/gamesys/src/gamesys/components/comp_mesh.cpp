@@ -83,8 +83,11 @@ namespace dmGameSystem
     struct VertexBufferInfo
     {
         dmGraphics::HVertexBuffer m_VertexBuffer;
+        dmBuffer::HBuffer m_Buffer;         // The buffer that was last copied to the vertex buffer
         uint32_t m_RefCount;
         uint32_t m_Version;
+        uint32_t m_ContentVersion;          // The content version of m_Buffer when it was copied
+        uint32_t m_DataSize;
     };
 
     struct MeshWorld
@@ -146,6 +149,9 @@ namespace dmGameSystem
         info.m_RefCount = 1;
         info.m_VertexBuffer = vertex_buffer;
         info.m_Version = version;
+        info.m_Buffer = 0;
+        info.m_ContentVersion = 0;
+        info.m_DataSize = 0;
         if (world->m_ResourceToVertexBuffer.Full()) {
             uint32_t capacity = world->m_ResourceToVertexBuffer.Capacity() + 8;
             world->m_ResourceToVertexBuffer.SetCapacity(capacity/3, capacity);
@@ -185,14 +191,41 @@ namespace dmGameSystem
         return dmHashFinal32(&state);
     }
 
-    static void CopyBufferToVertexBuffer(dmBuffer::HBuffer buffer, dmGraphics::HVertexBuffer vertex_buffer, uint32_t vert_size, uint32_t elem_count, dmGraphics::BufferUsage buffer_usage)
+    // Only the structs that changed since the last copy are uploaded, as long as it's the same buffer
+    static void CopyBufferToVertexBuffer(VertexBufferInfo* info, dmGameSystem::BufferResource* br, dmGraphics::BufferUsage buffer_usage)
     {
         uint8_t* bytes = 0x0;
         uint32_t size = 0;
-        dmBuffer::Result r = dmBuffer::GetBytes(buffer, (void**)&bytes, &size);
+        dmBuffer::Result r = dmBuffer::GetBytes(br->m_Buffer, (void**)&bytes, &size);
         assert(r == dmBuffer::RESULT_OK);
 
-        dmGraphics::SetVertexBufferData(vertex_buffer, vert_size * elem_count, bytes, buffer_usage);
+        uint32_t content_version = 0;
+        dmBuffer::GetContentVersion(br->m_Buffer, &content_version);
+
+        uint32_t data_size = br->m_Stride * br->m_ElementCount;
+        if (info->m_Buffer == br->m_Buffer && info->m_DataSize == data_size)
+        {
+            uint32_t first = 0;
+            uint32_t count = 0;
+            dmBuffer::GetChangedRange(br->m_Buffer, info->m_ContentVersion, &first, &count);
+            count = dmMath::Min(count, br->m_ElementCount - dmMath::Min(first, br->m_ElementCount));
+            if (count > 0)
+            {
+                uint32_t offset = first * br->m_Stride;
+                dmGraphics::SetVertexBufferSubData(info->m_VertexBuffer, offset, count * br->m_Stride, bytes + offset);
+            }
+        }
+        else
+        {
+            // Starts a new changed range for the next copy
+            uint32_t first, count;
+            dmBuffer::GetChangedRange(br->m_Buffer, content_version, &first, &count);
+            dmGraphics::SetVertexBufferData(info->m_VertexBuffer, data_size, bytes, buffer_usage);
+        }
+
+        info->m_Buffer = br->m_Buffer;
+        info->m_ContentVersion = content_version;
+        info->m_DataSize = data_size;
     }
 
     static void CreateVertexBuffer(MeshWorld* world, dmGameSystem::BufferResource* br, uint32_t version)
@@ -203,7 +236,8 @@ namespace dmGameSystem
             vertex_buffer = AllocVertexBuffer(world, world->m_GraphicsContext);
             AddVertexBufferInfo(world, br->m_NameHash, vertex_buffer, version); // ref count == 1
 
-            CopyBufferToVertexBuffer(br->m_Buffer, vertex_buffer, br->m_Stride, br->m_ElementCount, dmGraphics::BUFFER_USAGE_STREAM_DRAW);
+            VertexBufferInfo* info = world->m_ResourceToVertexBuffer.Get(br->m_NameHash);
+            CopyBufferToVertexBuffer(info, br, dmGraphics::BUFFER_USAGE_STREAM_DRAW);
         }
         else
         {
@@ -501,7 +535,7 @@ namespace dmGameSystem
                 {
                     info->m_Version = component.m_BufferVersion;
 
-                    CopyBufferToVertexBuffer(br->m_Buffer, info->m_VertexBuffer, br->m_Stride, br->m_ElementCount, dmGraphics::BUFFER_USAGE_DYNAMIC_DRAW);
+                    CopyBufferToVertexBuffer(info, br, dmGraphics::BUFFER_USAGE_DYNAMIC_DRAW);
                 }
             }
 
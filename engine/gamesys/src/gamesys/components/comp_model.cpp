@@ -16,6 +16,7 @@
 
 #include <string.h>
 #include <float.h>
+#include <algorithm> // std::sort
 
 #include <dlib/array.h>
 #include <dlib/hash.h>
@@ -25,6 +26,7 @@
 #include <dlib/dstrings.h>
 #include <dlib/object_pool.h>
 #include <dlib/math.h>
+#include <dmsdk/dlib/atomic.h>
 #include <dmsdk/dlib/vmath.h>
 #include <dmsdk/dlib/intersection.h>
 #include <graphics/graphics.h>
@@ -80,6 +82,7 @@ namespace dmGameSystem
         dmVMath::Matrix4            m_World;
         dmVMath::Vector3            m_AabbMin;
         dmVMath::Vector3            m_AabbMax;
+        dmIntersection::WorldAABB   m_WorldAABB; // The world space bounds, updated with the transform
         struct ModelComponent*      m_Component;
         ModelResourceBuffers*       m_Buffers;
         dmRigDDF::Model*            m_Model;    // Used for world space materials
@@ -90,6 +93,7 @@ namespace dmGameSystem
         uint32_t                    m_Enabled                     : 1;
         uint32_t                    m_AttributeRenderDataIndex    : 16;
         uint32_t                    m_PerInstanceCustomAttributes : 1;
+        uint32_t                    m_Lod                         : 2; // The level of detail of ModelResourceBuffers::m_Lods to draw
     };
 
     struct ModelComponent
@@ -114,7 +118,8 @@ namespace dmGameSystem
         uint8_t                          m_DoRender : 1;
         uint8_t                          m_AddedToUpdate : 1;
         uint8_t                          m_ReHash : 1;
-        uint8_t                          : 4;
+        uint8_t                          m_Occluder : 1; // The meshes hide what is behind them (see dmRender::AddOccluder)
+        uint8_t                          : 3;
     };
 
     struct ModelWorld
@@ -125,12 +130,15 @@ namespace dmGameSystem
         dmGraphics::HVertexDeclaration   m_InstanceVertexDeclaration;
         dmArray<uint8_t>                 m_InstanceBufferDataLocalSpace;
         dmRender::HBufferedRenderBuffer  m_InstanceBufferLocalSpace;
+        dmArray<uint8_t>                 m_IndirectBufferData; // dmGraphics::DrawIndexedIndirectCommand
+        dmRender::HBufferedRenderBuffer  m_IndirectBuffer;
         dmRender::HBufferedRenderBuffer* m_VertexBuffers;
         dmArray<uint8_t>*                m_VertexBufferData;
         uint32_t*                        m_VertexBufferDispatchCounts;
         // Temporary scratch array for instances, only used during the creation phase of components
         dmArray<dmGameObject::HInstance> m_ScratchInstances;
         dmRig::HRigContext               m_RigContext;
+        dmJobThread::HContext            m_JobThread;
         uint32_t                         m_MaxElementsVertices;
         uint32_t                         m_MaxBatchIndex;
         // For profiling data:
@@ -140,6 +148,9 @@ namespace dmGameSystem
     };
 
     static const uint32_t VERTEX_BUFFER_MAX_BATCHES = 16;     // Max dmRender::RenderListEntry.m_MinorOrder (4 bits)
+    static const uint32_t MODEL_PARALLEL_GRAIN_SIZE = 64;     // Number of models per job when updating in parallel
+    static const uint32_t MAX_POSE_UPDATE_INTERVAL  = 8;      // Max number of updates between evaluating the pose of distant models
+    static const float    LOD_HYSTERESIS            = 0.1f;   // How far past a threshold the screen size must be before the level of detail changes
     static const uint8_t VX_DECL_BASE_BUFFER        = 0;
     static const uint8_t VX_DECL_INSTANCE_BUFFER    = 1;
     static const uint8_t VX_DECL_CUSTOM_BUFFER      = 2;
@@ -148,6 +159,7 @@ namespace dmGameSystem
     static const dmhash_t PROP_ANIMATION     = dmHashString64("animation");
     static const dmhash_t PROP_CURSOR        = dmHashString64("cursor");
     static const dmhash_t PROP_PLAYBACK_RATE = dmHashString64("playback_rate");
+    static const dmhash_t PROP_OCCLUDER      = dmHashString64("occluder");
 
     static void ResourceReloadedCallback(const dmResource::ResourceReloadedParams* params);
     static void DestroyComponent(ModelWorld* world, uint32_t index);
@@ -158,6 +170,7 @@ namespace dmGameSystem
         dmRender::HRenderContext render_context = context->m_RenderContext;
         ModelWorld* world = new ModelWorld();
         uint32_t comp_count = dmMath::Min(params.m_MaxComponentInstances, context->m_MaxModelCount);
+        world->m_JobThread = context->m_JobThread;
 
         dmRig::NewContextParams rig_params = {0};
         rig_params.m_MaxRigInstanceCount = comp_count;
@@ -167,6 +180,7 @@ namespace dmGameSystem
             dmLogFatal("Unable to create model rig context: %d", rr);
             return dmGameObject::CREATE_RESULT_UNKNOWN_ERROR;
         }
+        dmRig::SetContextJobThread(world->m_RigContext, world->m_JobThread);
 
         world->m_Components.SetCapacity(comp_count);
         world->m_RenderObjects.SetCapacity(comp_count);
@@ -191,6 +205,7 @@ namespace dmGameSystem
         world->m_InstanceVertexDeclaration = dmGraphics::NewVertexDeclaration(graphics_context, stream_declaration_instance);
         world->m_MaxElementsVertices       = dmGraphics::GetMaxElementsVertices(graphics_context);
         world->m_InstanceBufferLocalSpace  = dmRender::NewBufferedRenderBuffer(context->m_RenderContext, dmRender::RENDER_BUFFER_TYPE_VERTEX_BUFFER);
+        world->m_IndirectBuffer            = dmRender::NewBufferedRenderBuffer(context->m_RenderContext, dmRender::RENDER_BUFFER_TYPE_VERTEX_BUFFER);
 
         world->m_CurrentFrameTick = 0;
         world->m_VertexBuffers = new dmRender::HBufferedRenderBuffer[VERTEX_BUFFER_MAX_BATCHES];
@@ -222,6 +237,7 @@ namespace dmGameSystem
         {
             dmRender::DeleteBufferedRenderBuffer(context->m_RenderContext, world->m_VertexBuffers[i]);
         }
+        dmRender::DeleteBufferedRenderBuffer(context->m_RenderContext, world->m_IndirectBuffer);
 
         dmResource::UnregisterResourceReloadedCallback(((ModelContext*)params.m_Context)->m_Factory, ResourceReloadedCallback, world);
 
@@ -401,18 +417,78 @@ namespace dmGameSystem
         return texture_res;
     }
 
+    static inline TextureResource* GetRenderTexture(const ModelComponent* component, const MaterialResource* material, uint32_t material_index, uint32_t texture_index)
+    {
+        TextureResource* texture_res = component->m_Textures[texture_index];
+        if (!texture_res)
+        {
+            texture_res = GetTextureFromSamplerNameHash(&component->m_Resource->m_Materials[material_index], material, texture_index, material->m_SamplerNames[texture_index]);
+        }
+        return texture_res;
+    }
+
     static void FillTextures(dmRender::RenderObject* ro, const ModelComponent* component, uint32_t material_index)
     {
         MaterialResource* material = GetMaterialResource(component, component->m_Resource, material_index);
         for(uint32_t i = 0; i < material->m_NumTextures; ++i)
         {
-            TextureResource* texture_res = component->m_Textures[i];
-            if (!texture_res)
+            TextureResource* texture_res = GetRenderTexture(component, material, material_index, i);
+            ro->m_Textures[i] = texture_res ? texture_res->m_Texture : 0;
+        }
+    }
+
+    // Approximates the size in pixels that the render item covers on screen, from its projected bounding box
+    static float GetScreenSize(const MeshRenderItem* render_item, const dmVMath::Matrix4& view_proj, float viewport_width, float viewport_height)
+    {
+        dmVMath::Matrix4 world_view_proj = view_proj * render_item->m_World;
+        const dmVMath::Vector3& aabb_min = render_item->m_AabbMin;
+        const dmVMath::Vector3& aabb_max = render_item->m_AabbMax;
+
+        float min_x = FLT_MAX, min_y = FLT_MAX;
+        float max_x = -FLT_MAX, max_y = -FLT_MAX;
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            dmVMath::Point3 corner((i & 1) ? aabb_max.getX() : aabb_min.getX(),
+                                   (i & 2) ? aabb_max.getY() : aabb_min.getY(),
+                                   (i & 4) ? aabb_max.getZ() : aabb_min.getZ());
+            dmVMath::Vector4 clip = world_view_proj * corner;
+
+            // A corner behind the camera means the item is very close, so it needs full detail
+            if (clip.getW() <= 0.0f)
             {
-                texture_res = GetTextureFromSamplerNameHash(&component->m_Resource->m_Materials[material_index], material, i, material->m_SamplerNames[i]);
+                return FLT_MAX;
             }
 
-            ro->m_Textures[i] = texture_res ? texture_res->m_Texture : 0;
+            float x = clip.getX() / clip.getW();
+            float y = clip.getY() / clip.getW();
+            min_x = dmMath::Min(min_x, x);
+            min_y = dmMath::Min(min_y, y);
+            max_x = dmMath::Max(max_x, x);
+            max_y = dmMath::Max(max_y, y);
+        }
+
+        return dmMath::Max((max_x - min_x) * 0.5f * viewport_width, (max_y - min_y) * 0.5f * viewport_height);
+    }
+
+    // Lets texture streaming know how large the textures of the visible items are drawn
+    static void ReportTextureScreenSizes(dmRender::HRenderContext render_context, dmRender::RenderListEntry* buf, uint32_t* begin, uint32_t* end)
+    {
+        dmGraphics::HContext graphics_context = dmRender::GetGraphicsContext(render_context);
+        const dmVMath::Matrix4& view_proj     = dmRender::GetViewProjectionMatrix(render_context);
+        float viewport_width                  = (float) dmGraphics::GetWindowWidth(graphics_context);
+        float viewport_height                 = (float) dmGraphics::GetWindowHeight(graphics_context);
+
+        for (uint32_t *i = begin; i != end; ++i)
+        {
+            const MeshRenderItem* render_item = (MeshRenderItem*) buf[*i].m_UserData;
+            const ModelComponent* component   = render_item->m_Component;
+            MaterialResource* material        = GetMaterialResource(component, component->m_Resource, render_item->m_MaterialIndex);
+            float screen_size                 = GetScreenSize(render_item, view_proj, viewport_width, viewport_height);
+
+            for (uint32_t t = 0; t < material->m_NumTextures; ++t)
+            {
+                ReportTextureScreenSize(GetRenderTexture(component, material, render_item->m_MaterialIndex, t), screen_size);
+            }
         }
     }
     static void HashMaterial(HashState32* state, const dmGameSystem::MaterialResource* material)
@@ -430,8 +506,17 @@ namespace dmGameSystem
             return;
         }
 
-        // We need to hash the mesh pointer for instance grouping
-        dmHashUpdateBuffer32(state, item.m_Mesh, sizeof(*item.m_Mesh));
+        if (item.m_Buffers->m_SharedBuffers)
+        {
+            // All meshes of the model are drawn with one multi-draw, as long as they use the same material
+            dmHashUpdateBuffer32(state, &item.m_Buffers->m_VertexBuffer, sizeof(item.m_Buffers->m_VertexBuffer));
+            dmHashUpdateBuffer32(state, &item.m_MaterialIndex, sizeof(item.m_MaterialIndex));
+        }
+        else
+        {
+            // We need to hash the mesh pointer for instance grouping
+            dmHashUpdateBuffer32(state, item.m_Mesh, sizeof(*item.m_Mesh));
+        }
 
         // If we use an override material, we don't need to hash the override values
         if (component->m_Material && component->m_Material->m_Material == material)
@@ -781,6 +866,7 @@ namespace dmGameSystem
             item.m_BoneIndex = dmRig::INVALID_BONE_INDEX;
             item.m_AttributeRenderDataIndex = ATTRIBUTE_RENDER_DATA_INDEX_UNUSED;
             item.m_InstanceRenderHash = 0;
+            item.m_Lod = 0;
 
             // This model is a child under a bone, but isn't actually skinned
             if (item.m_Model->m_BoneId && bone_id_to_indices)
@@ -825,6 +911,7 @@ namespace dmGameSystem
         {
             create_params.m_BoneIndices  = rig_resource->m_SkeletonRes == 0x0 ? 0x0 : &rig_resource->m_SkeletonRes->m_BoneIndices;
             create_params.m_AnimationSet = rig_resource->m_AnimationSetRes == 0x0 ? 0x0 : rig_resource->m_AnimationSetRes->m_AnimationSet;
+            create_params.m_CompressedAnimationSet = rig_resource->m_AnimationSetRes == 0x0 ? 0x0 : rig_resource->m_AnimationSetRes->m_CompressedAnimationSet;
         }
         else
         {
@@ -970,6 +1057,40 @@ namespace dmGameSystem
     }
     #endif
 
+    static inline uint32_t GetIndexTypeSize(const ModelResourceBuffers* buffers)
+    {
+        return buffers->m_IndexBufferElementType == dmGraphics::TYPE_UNSIGNED_INT ? 4 : 2;
+    }
+
+    static inline const ModelResourceLod& GetLod(const MeshRenderItem* render_item)
+    {
+        return render_item->m_Buffers->m_Lods[render_item->m_Lod];
+    }
+
+    // The byte offset of the first index of the level of detail, as expected by dmGraphics::DrawElements
+    static inline uint32_t GetIndexByteOffset(const MeshRenderItem* render_item)
+    {
+        return GetLod(render_item).m_IndexOffset * GetIndexTypeSize(render_item->m_Buffers);
+    }
+
+    // We only count the buffers of a mesh once per frame
+    static void UpdateBuffersStatistics(ModelWorld* world, ModelResourceBuffers* buffers)
+    {
+        if (buffers->m_LastUsedFrame != world->m_CurrentFrameTick)
+        {
+            if (buffers->m_SharedBuffers)
+            {
+                // Only the part of the buffers used by the mesh
+                world->m_StatisticsVertexDataSize += buffers->m_VertexCount * sizeof(dmRig::RigModelVertex) + buffers->m_IndexCount * GetIndexTypeSize(buffers);
+            }
+            else
+            {
+                world->m_StatisticsVertexDataSize += dmGraphics::GetIndexBufferSize(buffers->m_IndexBuffer) + dmGraphics::GetVertexBufferSize(buffers->m_VertexBuffer);
+            }
+            buffers->m_LastUsedFrame = world->m_CurrentFrameTick;
+        }
+    }
+
     static void RenderBatchLocalVSInstanced(ModelWorld* world, dmRender::HRenderContext render_context,
         dmRender::HMaterial render_context_material, uint32_t material_index,
         ModelComponent* component, dmRender::RenderListEntry *buf, uint32_t* begin, uint32_t* end, dmGraphics::HVertexDeclaration inst_decl)
@@ -1005,13 +1126,14 @@ namespace dmGameSystem
         ro.Init();
         ro.m_Material                                     = GetComponentMaterial(component, component->m_Resource, material_index);
         ro.m_PrimitiveType                                = dmGraphics::PRIMITIVE_TRIANGLES;
-        ro.m_VertexStart                                  = 0;
-        ro.m_VertexCount                                  = render_item->m_Buffers->m_IndexCount;
+        ro.m_VertexStart                                  = GetIndexByteOffset(render_item);
+        ro.m_VertexCount                                  = GetLod(render_item).m_IndexCount;
         ro.m_IndexBuffer                                  = render_item->m_Buffers->m_IndexBuffer;              // May be 0
         ro.m_IndexType                                    = render_item->m_Buffers->m_IndexBufferElementType;
         ro.m_InstanceCount                                = instance_count;
         ro.m_VertexDeclarations[VX_DECL_BASE_BUFFER]      = world->m_VertexDeclaration;
         ro.m_VertexBuffers[VX_DECL_BASE_BUFFER]           = render_item->m_Buffers->m_VertexBuffer;
+        ro.m_VertexBufferOffsets[VX_DECL_BASE_BUFFER]     = render_item->m_Buffers->m_VertexOffset * sizeof(dmRig::RigModelVertex);
         ro.m_WorldTransform                               = render_item->m_World;
         ro.m_VertexDeclarations[VX_DECL_INSTANCE_BUFFER]  = world->m_InstanceVertexDeclaration;
         ro.m_VertexBuffers[VX_DECL_INSTANCE_BUFFER]       = (dmGraphics::HVertexBuffer) dmRender::GetBuffer(render_context, world->m_InstanceBufferLocalSpace);
@@ -1126,11 +1248,7 @@ namespace dmGameSystem
         world->m_InstanceBufferDataLocalSpace.SetSize(instance_write_ptr - world->m_InstanceBufferDataLocalSpace.Begin());
 
         // Update statistics for the render item
-        if (render_item->m_Buffers->m_LastUsedFrame != world->m_CurrentFrameTick)
-        {
-            world->m_StatisticsVertexDataSize += dmGraphics::GetIndexBufferSize(ro.m_IndexBuffer) + dmGraphics::GetVertexBufferSize(ro.m_VertexBuffers[VX_DECL_BASE_BUFFER]);
-            render_item->m_Buffers->m_LastUsedFrame = world->m_CurrentFrameTick;
-        }
+        UpdateBuffersStatistics(world, render_item->m_Buffers);
         world->m_StatisticsVertexCount += ro.m_VertexCount;
     }
 
@@ -1158,13 +1276,14 @@ namespace dmGameSystem
             ro.Init();
             ro.m_Material              = GetComponentMaterial(component, component->m_Resource, material_index);
             ro.m_PrimitiveType         = dmGraphics::PRIMITIVE_TRIANGLES;
-            ro.m_VertexStart           = 0;
-            ro.m_VertexCount           = buffers->m_IndexCount;
-            ro.m_IndexBuffer           = buffers->m_IndexBuffer;              // May be 0
-            ro.m_IndexType             = buffers->m_IndexBufferElementType;
-            ro.m_WorldTransform        = render_item->m_World;
-            ro.m_VertexDeclarations[0] = world->m_VertexDeclaration;
-            ro.m_VertexBuffers[0]      = buffers->m_VertexBuffer;
+            ro.m_VertexStart            = GetIndexByteOffset(render_item);
+            ro.m_VertexCount            = GetLod(render_item).m_IndexCount;
+            ro.m_IndexBuffer            = buffers->m_IndexBuffer;              // May be 0
+            ro.m_IndexType              = buffers->m_IndexBufferElementType;
+            ro.m_WorldTransform         = render_item->m_World;
+            ro.m_VertexDeclarations[0]  = world->m_VertexDeclaration;
+            ro.m_VertexBuffers[0]       = buffers->m_VertexBuffer;
+            ro.m_VertexBufferOffsets[0] = buffers->m_VertexOffset * sizeof(dmRig::RigModelVertex);
 
             if (render_context_material_custom_attributes || render_item->m_AttributeRenderDataIndex != ATTRIBUTE_RENDER_DATA_INDEX_UNUSED)
             {
@@ -1209,12 +1328,145 @@ namespace dmGameSystem
             dmRender::AddToRender(render_context, &ro);
 
             // Update statistics for render item. We only count the render item once per frame
-            if (render_item->m_Buffers->m_LastUsedFrame != world->m_CurrentFrameTick)
+            UpdateBuffersStatistics(world, buffers);
+            world->m_StatisticsVertexCount += ro.m_VertexCount;
+        }
+    }
+
+    // Sorts the entries of a batch so that the instances of each mesh are consecutive
+    struct RenderItemBuffersPred
+    {
+        const dmRender::RenderListEntry* m_Buf;
+        RenderItemBuffersPred(const dmRender::RenderListEntry* buf) : m_Buf(buf) {}
+
+        bool operator ()(uint32_t a, uint32_t b) const
+        {
+            const MeshRenderItem* item_a = (const MeshRenderItem*) m_Buf[a].m_UserData;
+            const MeshRenderItem* item_b = (const MeshRenderItem*) m_Buf[b].m_UserData;
+            return item_a->m_Buffers < item_b->m_Buffers;
+        }
+    };
+
+    // Draws the instances of all the meshes in the batch with one draw call, where the meshes are from the same shared buffers.
+    // Each mesh gets a draw command, which reads the instance data of the mesh through the first instance of the command.
+    static void RenderBatchLocalVSMultiDraw(ModelWorld* world, dmRender::HRenderContext render_context,
+        uint32_t material_index, ModelComponent* component, dmRender::RenderListEntry *buf, uint32_t* begin, uint32_t* end)
+    {
+        DM_PROFILE("RenderBatchLocalMultiDraw");
+
+        MeshRenderItem* render_item = (MeshRenderItem*) buf[*begin].m_UserData;
+        uint32_t instance_count     = end - begin;
+
+        uint32_t required_instance_buffer_memory = instance_count * sizeof(ModelInstanceData);
+        if (world->m_InstanceBufferDataLocalSpace.Remaining() < required_instance_buffer_memory)
+        {
+            world->m_InstanceBufferDataLocalSpace.OffsetCapacity(required_instance_buffer_memory - world->m_InstanceBufferDataLocalSpace.Remaining());
+        }
+
+        // At most one command per instance
+        uint32_t required_indirect_buffer_memory = instance_count * sizeof(dmGraphics::DrawIndexedIndirectCommand);
+        if (world->m_IndirectBufferData.Remaining() < required_indirect_buffer_memory)
+        {
+            world->m_IndirectBufferData.OffsetCapacity(required_indirect_buffer_memory - world->m_IndirectBufferData.Remaining());
+        }
+
+        world->m_RenderObjects.SetSize(world->m_RenderObjects.Size()+1);
+        dmRender::RenderObject& ro  = world->m_RenderObjects.Back();
+
+        ro.Init();
+        ro.m_Material                                     = GetComponentMaterial(component, component->m_Resource, material_index);
+        ro.m_PrimitiveType                                = dmGraphics::PRIMITIVE_TRIANGLES;
+        ro.m_IndexBuffer                                  = render_item->m_Buffers->m_IndexBuffer;
+        ro.m_IndexType                                    = render_item->m_Buffers->m_IndexBufferElementType;
+        ro.m_VertexDeclarations[VX_DECL_BASE_BUFFER]      = world->m_VertexDeclaration;
+        ro.m_VertexBuffers[VX_DECL_BASE_BUFFER]           = render_item->m_Buffers->m_VertexBuffer;
+        ro.m_WorldTransform                               = render_item->m_World;
+        ro.m_VertexDeclarations[VX_DECL_INSTANCE_BUFFER]  = world->m_InstanceVertexDeclaration;
+        ro.m_VertexBuffers[VX_DECL_INSTANCE_BUFFER]       = (dmGraphics::HVertexBuffer) dmRender::GetBuffer(render_context, world->m_InstanceBufferLocalSpace);
+        ro.m_VertexBufferOffsets[VX_DECL_INSTANCE_BUFFER] = world->m_InstanceBufferDataLocalSpace.Size();
+        ro.m_IndirectBuffer                               = (dmGraphics::HVertexBuffer) dmRender::GetBuffer(render_context, world->m_IndirectBuffer);
+        ro.m_IndirectBufferOffset                         = world->m_IndirectBufferData.Size();
+
+        assert(dmGraphics::GetVertexDeclarationStride(world->m_InstanceVertexDeclaration) == sizeof(ModelInstanceData));
+        ModelInstanceData* instance_data           = (ModelInstanceData*) world->m_InstanceBufferDataLocalSpace.End();
+        dmGraphics::DrawIndexedIndirectCommand* cmd = (dmGraphics::DrawIndexedIndirectCommand*) world->m_IndirectBufferData.End();
+        uint32_t draw_count = 0;
+
+        // The level of detail is part of the batch key, so it is the same for all instances
+        for (uint32_t *i=begin;i!=end;)
+        {
+            const MeshRenderItem* mesh_render_item = (MeshRenderItem*) buf[*i].m_UserData;
+            ModelResourceBuffers* buffers          = mesh_render_item->m_Buffers;
+            const ModelResourceLod& lod            = GetLod(mesh_render_item);
+            uint32_t first_instance                = i - begin;
+
+            for (; i != end && ((MeshRenderItem*) buf[*i].m_UserData)->m_Buffers == buffers; ++i)
             {
-                world->m_StatisticsVertexDataSize += dmGraphics::GetIndexBufferSize(ro.m_IndexBuffer) + dmGraphics::GetVertexBufferSize(ro.m_VertexBuffers[0]);
-                render_item->m_Buffers->m_LastUsedFrame = world->m_CurrentFrameTick;
+                const MeshRenderItem* instance_render_item = (MeshRenderItem*) buf[*i].m_UserData;
+                instance_data->m_WorldTransform  = instance_render_item->m_World;
+                instance_data->m_NormalTransform = dmRender::GetNormalMatrix(render_context, instance_data->m_WorldTransform);
+                instance_data++;
             }
-            world->m_StatisticsVertexCount += ro.m_VertexCount;
+
+            cmd->m_IndexCount    = lod.m_IndexCount;
+            cmd->m_InstanceCount = (i - begin) - first_instance;
+            cmd->m_FirstIndex    = lod.m_IndexOffset;
+            cmd->m_VertexOffset  = (int32_t) buffers->m_VertexOffset;
+            cmd->m_FirstInstance = first_instance;
+            cmd++;
+            draw_count++;
+
+            UpdateBuffersStatistics(world, buffers);
+            world->m_StatisticsVertexCount += lod.m_IndexCount * cmd[-1].m_InstanceCount;
+        }
+
+        ro.m_IndirectDrawCount = draw_count;
+
+        FillTextures(&ro, component, material_index);
+
+        if (component->m_RenderConstants)
+        {
+            dmGameSystem::EnableRenderObjectConstants(&ro, component->m_RenderConstants);
+        }
+
+        dmRender::AddToRender(render_context, &ro);
+
+        world->m_InstanceBufferDataLocalSpace.SetSize((uint8_t*) instance_data - world->m_InstanceBufferDataLocalSpace.Begin());
+        world->m_IndirectBufferData.SetSize((uint8_t*) cmd - world->m_IndirectBufferData.Begin());
+    }
+
+    // Meshes with shared buffers are batched together, regardless of the mesh (see HashRenderItem)
+    static void RenderBatchLocalVSSharedBuffers(ModelWorld* world, dmRender::HRenderContext render_context,
+        dmRender::HMaterial render_context_material, uint32_t material_index,
+        ModelComponent* component, dmRender::RenderListEntry *buf, uint32_t* begin, uint32_t* end, dmGraphics::HVertexDeclaration inst_decl)
+    {
+        std::sort(begin, end, RenderItemBuffersPred(buf));
+
+        const MeshRenderItem* first_item   = (MeshRenderItem*) buf[*begin].m_UserData;
+        const MeshRenderItem* last_item    = (MeshRenderItem*) buf[*(end - 1)].m_UserData;
+        bool single_mesh                   = first_item->m_Buffers == last_item->m_Buffers;
+        bool custom_attributes             = render_context_material && HasCustomVertexAttributes(render_context_material);
+        for (uint32_t *i=begin;i!=end && !custom_attributes;i++)
+        {
+            custom_attributes = ((MeshRenderItem*) buf[*i].m_UserData)->m_AttributeRenderDataIndex != ATTRIBUTE_RENDER_DATA_INDEX_UNUSED;
+        }
+
+        if (!single_mesh && !custom_attributes)
+        {
+            RenderBatchLocalVSMultiDraw(world, render_context, material_index, component, buf, begin, end);
+            return;
+        }
+
+        // The custom vertex attributes are written per mesh, so each mesh is drawn by itself
+        for (uint32_t *i=begin;i!=end;)
+        {
+            uint32_t* mesh_begin = i;
+            const ModelResourceBuffers* buffers = ((MeshRenderItem*) buf[*i].m_UserData)->m_Buffers;
+            while (i != end && ((MeshRenderItem*) buf[*i].m_UserData)->m_Buffers == buffers)
+            {
+                ++i;
+            }
+            RenderBatchLocalVSInstanced(world, render_context, render_context_material, material_index, component, buf, mesh_begin, i, inst_decl);
         }
     }
 
@@ -1228,7 +1480,11 @@ namespace dmGameSystem
         dmRender::HMaterial material             = GetRenderMaterial(render_context_material,component, component->m_Resource, material_index);
         dmGraphics::HVertexDeclaration inst_decl = dmRender::GetVertexDeclaration(material, dmGraphics::VERTEX_STEP_FUNCTION_INSTANCE);
 
-        if (inst_decl)
+        if (inst_decl && render_item->m_Buffers->m_SharedBuffers)
+        {
+            RenderBatchLocalVSSharedBuffers(world, render_context, render_context_material, material_index, component, buf, begin, end, inst_decl);
+        }
+        else if (inst_decl)
         {
             RenderBatchLocalVSInstanced(world, render_context, render_context_material, material_index, component, buf, begin, end, inst_decl);
         }
@@ -1491,6 +1747,8 @@ namespace dmGameSystem
         dmRender::HMaterial render_context_material = dmRender::GetContextMaterial(render_context);
         dmRender::HMaterial material = GetRenderMaterial(render_context_material, component, component->m_Resource, 0);
 
+        ReportTextureScreenSizes(render_context, buf, begin, end);
+
         switch(GetRenderMaterialVertexSpace(material))
         {
             case dmRenderDDF::MaterialDesc::VERTEX_SPACE_WORLD:
@@ -1527,20 +1785,25 @@ namespace dmGameSystem
             {
                 item.m_World = world * dmTransform::ToMatrix4(model->m_Local);
             }
+            dmIntersection::CreateWorldAABB(item.m_World, item.m_AabbMin, item.m_AabbMax, item.m_WorldAABB);
         }
     }
 
     // TODO: What are the dependencies here?
     // Why can we not call this in the CompModelUpdate() function?
 
-    static void UpdateTransforms(ModelWorld* world)
+    struct ModelTransformContext
     {
-        DM_PROFILE(__FUNCTION__);
+        ModelWorld*     m_World;
+        int32_atomic_t  m_NumRenderItems;
+    };
 
-        const dmArray<ModelComponent*>& components = world->m_Components.GetRawObjects();
-        uint32_t n = components.Size();
+    static void UpdateTransformsRange(void* _ctx, uint32_t begin, uint32_t end)
+    {
+        ModelTransformContext* ctx = (ModelTransformContext*)_ctx;
+        const dmArray<ModelComponent*>& components = ctx->m_World->m_Components.GetRawObjects();
         uint32_t num_render_items = 0;
-        for (uint32_t i = 0; i < n; ++i)
+        for (uint32_t i = begin; i < end; ++i)
         {
             ModelComponent* c = components[i];
 
@@ -1564,7 +1827,19 @@ namespace dmGameSystem
 
             num_render_items += c->m_RenderItems.Size();
         }
+        dmAtomicAdd32(&ctx->m_NumRenderItems, (int32_t)num_render_items);
+    }
+
+    static void UpdateTransforms(ModelWorld* world)
+    {
+        DM_PROFILE(__FUNCTION__);
+
+        ModelTransformContext ctx;
+        ctx.m_World = world;
+        ctx.m_NumRenderItems = 0;
+        dmJobThread::ParallelFor(world->m_JobThread, world->m_Components.GetRawObjects().Size(), MODEL_PARALLEL_GRAIN_SIZE, UpdateTransformsRange, &ctx);
 
+        uint32_t num_render_items = (uint32_t)dmAtomicGet32(&ctx.m_NumRenderItems);
         if (world->m_RenderObjects.Capacity() < num_render_items)
             world->m_RenderObjects.SetCapacity(num_render_items);
     }
@@ -1578,11 +1853,38 @@ namespace dmGameSystem
         return dmGameObject::CREATE_RESULT_OK;
     }
 
+    // The pose of a model is evaluated less often the further it is from the camera, one more update between
+    // the evaluations for each ModelContext::m_PoseUpdateDistance. The camera is the view of the last rendered frame.
+    static void UpdatePoseUpdateIntervals(ModelWorld* world, ModelContext* context)
+    {
+        const Matrix4& view = dmRender::GetViewMatrix(context->m_RenderContext);
+        Vector3 camera_position = OrthoInverse(view).getTranslation();
+        float inv_distance = 1.0f / context->m_PoseUpdateDistance;
+
+        const dmArray<ModelComponent*>& components = world->m_Components.GetRawObjects();
+        const uint32_t count = components.Size();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            ModelComponent* component = components[i];
+            if (!component->m_RigInstance)
+                continue;
+
+            float distance = Length(component->m_World.getTranslation() - camera_position);
+            uint32_t interval = 1 + (uint32_t)(distance * inv_distance);
+            dmRig::SetPoseUpdateInterval(component->m_RigInstance, dmMath::Min(interval, MAX_POSE_UPDATE_INTERVAL));
+        }
+    }
+
     dmGameObject::UpdateResult CompModelUpdate(const dmGameObject::ComponentsUpdateParams& params, dmGameObject::ComponentsUpdateResult& update_result)
     {
         ModelWorld* world = (ModelWorld*)params.m_World;
         ModelContext* context = (ModelContext*)params.m_Context;
 
+        if (context->m_PoseUpdateDistance > 0.0f)
+        {
+            UpdatePoseUpdateIntervals(world, context);
+        }
+
         dmRig::Result rig_res = dmRig::Update(world->m_RigContext, params.m_UpdateContext->m_DT);
 
         const dmArray<ModelComponent*>& components = world->m_Components.GetRawObjects();
@@ -1616,6 +1918,8 @@ namespace dmGameSystem
 
         dmRender::TrimBuffer(context->m_RenderContext, world->m_InstanceBufferLocalSpace);
         dmRender::RewindBuffer(context->m_RenderContext, world->m_InstanceBufferLocalSpace);
+        dmRender::TrimBuffer(context->m_RenderContext, world->m_IndirectBuffer);
+        dmRender::RewindBuffer(context->m_RenderContext, world->m_IndirectBuffer);
 
         world->m_MaxBatchIndex = 0;
         world->m_CurrentFrameTick++;
@@ -1632,13 +1936,32 @@ namespace dmGameSystem
 
         const dmIntersection::Frustum frustum = *params.m_Frustum;
         uint32_t num_entries = params.m_NumEntries;
-        for (uint32_t i = 0; i < num_entries; ++i)
+
+        // The bounds are packed and tested in batches
+        const uint32_t batch_size = 64;
+        dmIntersection::WorldAABB bounds[batch_size];
+        uint8_t results[batch_size];
+        for (uint32_t batch_start = 0; batch_start < num_entries; batch_start += batch_size)
         {
-            dmRender::RenderListEntry* entry = &params.m_Entries[i];
-            MeshRenderItem* render_item = (MeshRenderItem*)entry->m_UserData;
+            uint32_t batch_count = dmMath::Min(batch_size, num_entries - batch_start);
+            dmRender::RenderListEntry* entries = &params.m_Entries[batch_start];
+            for (uint32_t i = 0; i < batch_count; ++i)
+            {
+                bounds[i] = ((MeshRenderItem*)entries[i].m_UserData)->m_WorldAABB;
+            }
+            dmIntersection::TestFrustumWorldAABBs(frustum, bounds, batch_count, results);
 
-            bool intersect = dmIntersection::TestFrustumOBB(frustum, render_item->m_World, render_item->m_AabbMin, render_item->m_AabbMax);
-            entry->m_Visibility = intersect ? dmRender::VISIBILITY_FULL : dmRender::VISIBILITY_NONE;
+            for (uint32_t i = 0; i < batch_count; ++i)
+            {
+                dmRender::RenderListEntry* entry = &entries[i];
+                MeshRenderItem* render_item = (MeshRenderItem*)entry->m_UserData;
+
+                bool intersect = results[i] != 0;
+                // The occluders are never tested against themselves
+                if (intersect && params.m_OcclusionBuffer && !render_item->m_Component->m_Occluder)
+                    intersect = !dmRender::IsOccluded(params.m_OcclusionBuffer, render_item->m_World, render_item->m_AabbMin, render_item->m_AabbMax);
+                entry->m_Visibility = intersect ? dmRender::VISIBILITY_FULL : dmRender::VISIBILITY_NONE;
+            }
         }
     }
 
@@ -1654,6 +1977,7 @@ namespace dmGameSystem
                 world->m_StatisticsVertexDataSize = 0;
 
                 world->m_InstanceBufferDataLocalSpace.SetSize(0);
+                world->m_IndirectBufferData.SetSize(0);
                 world->m_RenderObjects.SetSize(0);
 
                 for (uint32_t batch_index = 0; batch_index < VERTEX_BUFFER_MAX_BATCHES; ++batch_index)
@@ -1677,6 +2001,11 @@ namespace dmGameSystem
                     world->m_StatisticsVertexDataSize += world->m_InstanceBufferDataLocalSpace.Size();
                 }
 
+                if (!world->m_IndirectBufferData.Empty())
+                {
+                    dmRender::SetBufferData(params.m_Context, world->m_IndirectBuffer, world->m_IndirectBufferData.Size(), world->m_IndirectBufferData.Begin(), dmGraphics::BUFFER_USAGE_DYNAMIC_DRAW);
+                }
+
                 for (uint32_t batch_index = 0; batch_index < VERTEX_BUFFER_MAX_BATCHES; ++batch_index)
                 {
                     dmArray<uint8_t>& vertex_buffer_data = world->m_VertexBufferData[batch_index];
@@ -1701,6 +2030,49 @@ namespace dmGameSystem
         }
     }
 
+    // The level of detail to use for a size on screen, in fractions of the screen height.
+    // Level n is used below lod_screen_size / 2^(n-1)
+    static uint32_t GetLodForScreenSize(float size, float lod_screen_size, uint32_t lod_count)
+    {
+        uint32_t lod = 0;
+        while (lod + 1 < lod_count && size < lod_screen_size / (1 << lod))
+        {
+            lod++;
+        }
+        return lod;
+    }
+
+    // Selects the level of detail from the projected size of the mesh bounds. The level only changes once the size
+    // is some margin past the threshold, so that a mesh at the threshold doesn't flicker between two levels.
+    static uint32_t SelectLod(const MeshRenderItem& render_item, const Matrix4& view_proj, const Vector3& camera_up, float lod_screen_size)
+    {
+        uint32_t lod_count = render_item.m_Buffers->m_LodCount;
+        if (lod_count <= 1)
+            return 0;
+        uint32_t lod = dmMath::Min((uint32_t) render_item.m_Lod, lod_count - 1);
+
+        Vector3 half_extents = (render_item.m_AabbMax - render_item.m_AabbMin) * 0.5f;
+        Point3 local_center  = Point3((render_item.m_AabbMax + render_item.m_AabbMin) * 0.5f);
+        Point3 center        = Point3((render_item.m_World * local_center).getXYZ());
+        float radius         = Length((render_item.m_World * half_extents).getXYZ());
+
+        Vector4 clip_center  = view_proj * center;
+        Vector4 clip_edge    = view_proj * (center + camera_up * radius);
+        if (clip_center.getW() <= 0.0f || clip_edge.getW() <= 0.0f)
+            return lod; // Behind the camera, and culled anyway
+
+        // The NDC height of the screen is 2, so the distance between the points is the size of the diameter on screen
+        float size = dmMath::Abs(clip_edge.getY() / clip_edge.getW() - clip_center.getY() / clip_center.getW());
+
+        uint32_t coarser = GetLodForScreenSize(size * (1.0f + LOD_HYSTERESIS), lod_screen_size, lod_count);
+        if (coarser > lod)
+            return coarser;
+        uint32_t finer = GetLodForScreenSize(size * (1.0f - LOD_HYSTERESIS), lod_screen_size, lod_count);
+        if (finer < lod)
+            return finer;
+        return lod;
+    }
+
     dmGameObject::UpdateResult CompModelRender(const dmGameObject::ComponentsRenderParams& params)
     {
         ModelContext* context = (ModelContext*)params.m_Context;
@@ -1727,6 +2099,11 @@ namespace dmGameSystem
         dmRender::HRenderListDispatch dispatch = dmRender::RenderListMakeDispatch(render_context, &RenderListDispatch, &RenderListFrustumCulling, world);
         dmRender::RenderListEntry* write_ptr = render_list;
 
+        // The view is from the last frame, which is close enough for selecting the level of detail
+        const bool use_lods       = context->m_LodScreenSize > 0.0f;
+        const Matrix4& view_proj  = dmRender::GetViewProjectionMatrix(render_context);
+        const Vector3 camera_up   = dmRender::GetViewMatrix(render_context).getRow(1).getXYZ();
+
         const uint32_t max_elements_vertices = world->m_MaxElementsVertices;
         uint32_t minor_order = 0; // Will translate to vb index. (When we're generating vertex buffers on the fly, if material vertex space == world space)
         uint32_t vertex_count_total = 0;
@@ -1743,6 +2120,9 @@ namespace dmGameSystem
                 if (!render_item.m_Enabled)
                     continue;
 
+                if (component.m_Occluder)
+                    dmRender::AddOccluder(render_context, render_item.m_World, render_item.m_AabbMin, render_item.m_AabbMax);
+
                 uint32_t vertex_count = render_item.m_Buffers->m_VertexCount;
                 if(vertex_count_total + vertex_count >= max_elements_vertices)
                 {
@@ -1753,11 +2133,22 @@ namespace dmGameSystem
 
                 dmRender::HMaterial mesh_material = GetComponentMaterial(&component, component.m_Resource, render_item.m_MaterialIndex);
 
+                // The world space meshes are generated from the full mesh each frame
+                if (use_lods && dmRender::GetMaterialVertexSpace(mesh_material) == dmRenderDDF::MaterialDesc::VERTEX_SPACE_LOCAL)
+                {
+                    render_item.m_Lod = SelectLod(render_item, view_proj, camera_up, context->m_LodScreenSize);
+                }
+                else
+                {
+                    render_item.m_Lod = 0;
+                }
+
                 const Vector4 trans = render_item.m_World.getCol(3);
                 write_ptr->m_WorldPosition = Point3(trans.getX(), trans.getY(), trans.getZ());
                 write_ptr->m_UserData = (uintptr_t) &render_item;
                 // TODO: Currently assuming only one material for all meshes
-                write_ptr->m_BatchKey   = render_item.m_InstanceRenderHash;
+                // The levels of detail use different indices, so they can't be instanced together
+                write_ptr->m_BatchKey   = render_item.m_InstanceRenderHash + render_item.m_Lod;
                 write_ptr->m_TagListKey = dmRender::GetMaterialTagListKey(mesh_material);
                 write_ptr->m_Dispatch   = dispatch;
                 write_ptr->m_MinorOrder = minor_order;
@@ -1935,6 +2326,11 @@ namespace dmGameSystem
             out_value.m_Variant = dmGameObject::PropertyVar(dmRig::GetPlaybackRate(component->m_RigInstance));
             return dmGameObject::PROPERTY_RESULT_OK;
         }
+        else if (params.m_PropertyId == PROP_OCCLUDER)
+        {
+            out_value.m_Variant = dmGameObject::PropertyVar(component->m_Occluder != 0);
+            return dmGameObject::PROPERTY_RESULT_OK;
+        }
         else if (params.m_PropertyId == PROP_MATERIAL)
         {
             return GetResourceProperty(dmGameObject::GetFactory(params.m_Instance), GetMaterialResource(component, component->m_Resource, 0), out_value);
@@ -1992,6 +2388,14 @@ namespace dmGameSystem
             }
             return dmGameObject::PROPERTY_RESULT_OK;
         }
+        else if (params.m_PropertyId == PROP_OCCLUDER)
+        {
+            if (params.m_Value.m_Type != dmGameObject::PROPERTY_TYPE_BOOLEAN)
+                return dmGameObject::PROPERTY_RESULT_TYPE_MISMATCH;
+
+            component->m_Occluder = params.m_Value.m_Bool;
+            return dmGameObject::PROPERTY_RESULT_OK;
+        }
         else if (params.m_PropertyId == PROP_MATERIAL)
         {
             dmGameObject::PropertyResult res = SetResourceProperty(dmGameObject::GetFactory(params.m_Instance), params.m_Value, MATERIAL_EXT_HASH, (void**)&component->m_Material);
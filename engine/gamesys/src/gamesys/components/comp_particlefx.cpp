@@ -19,6 +19,7 @@
 #include <assert.h>
 
 #include <dmsdk/dlib/vmath.h>
+#include <dmsdk/dlib/intersection.h>
 #include <dlib/index_pool.h>
 #include <dlib/hash.h>
 #include <dlib/log.h>
@@ -33,6 +34,7 @@
 #include "../gamesys_private.h"
 
 #include "resources/res_particlefx.h"
+#include "resources/res_texture.h"
 #include "resources/res_textureset.h"
 #include "resources/res_material.h"
 
@@ -45,6 +47,9 @@ namespace dmGameSystem
 {
     using namespace dmVMath;
 
+    // The number of emitters in a batch before the vertices are generated on the job threads
+    static const uint32_t PARTICLE_PARALLEL_VERTEX_THRESHOLD = 4;
+
     struct ParticleFXWorld;
 
     struct ParticleFXComponentPrototype
@@ -68,6 +73,17 @@ namespace dmGameSystem
         uint16_t m_Padding : 15;
     };
 
+    // An emitter in a render batch, whose vertices are written to a range reserved for it
+    struct EmitterVertexJob
+    {
+        const dmParticle::EmitterRenderData*    m_RenderData;
+        dmGraphics::VertexAttributeInfos        m_AttributeInfos;
+        uint32_t                                m_VertexStart;
+        uint32_t                                m_VertexCount;
+        uint32_t                                m_VerticesWritten;
+        dmParticle::GenerateVertexDataResult    m_Result;
+    };
+
     struct ParticleFXWorld
     {
         dmArray<ParticleFXComponent>            m_Components;
@@ -79,6 +95,8 @@ namespace dmGameSystem
         dmParticle::HParticleContext            m_ParticleContext;
         dmRender::HBufferedRenderBuffer         m_VertexBuffer;
         dmArray<uint8_t>                        m_VertexBufferData;
+        dmArray<EmitterVertexJob>               m_VertexJobs;
+        dmJobThread::HContext                   m_JobThread;
         uint32_t                                m_VerticesWritten;
         uint32_t                                m_EmitterCount;
         uint32_t                                m_DispatchCount;
@@ -95,6 +113,10 @@ namespace dmGameSystem
         world->m_Context = ctx;
         uint32_t particle_fx_count = dmMath::Min(params.m_MaxComponentInstances, ctx->m_MaxParticleFXCount);
         world->m_ParticleContext = dmParticle::CreateContext(ctx->m_MaxParticleFXCount, ctx->m_MaxParticleCount);
+        world->m_JobThread = ctx->m_JobThread;
+        dmParticle::SetContextJobThread(world->m_ParticleContext, ctx->m_JobThread);
+        dmParticle::SetContextOffscreenMode(world->m_ParticleContext, (dmParticle::OffscreenMode) ctx->m_OffscreenMode);
+        dmParticle::SetContextSortInterval(world->m_ParticleContext, ctx->m_SortInterval);
         world->m_Components.SetCapacity(particle_fx_count);
         world->m_Prototypes.SetCapacity(particle_fx_count);
         world->m_Prototypes.SetSize(particle_fx_count);
@@ -260,6 +282,9 @@ namespace dmGameSystem
         dmRender::TrimBuffer(ctx->m_RenderContext, w->m_VertexBuffer);
         dmRender::RewindBuffer(ctx->m_RenderContext, w->m_VertexBuffer);
 
+        // Includes the frame where the last instance was pruned, so that it's removed from the screen
+        dmRender::InvalidateRender(ctx->m_RenderContext);
+
         return dmGameObject::UPDATE_RESULT_OK;
     }
 
@@ -275,6 +300,100 @@ namespace dmGameSystem
         return context_material ? context_material : GetComponentMaterial(rd);
     }
 
+    static void LogGenerateVertexDataResult(ParticleFXContext* pfx_context, dmParticle::GenerateVertexDataResult res, uint32_t entry)
+    {
+        if (res == dmParticle::GENERATE_VERTEX_DATA_MAX_PARTICLES_EXCEEDED)
+        {
+            dmLogWarning("Maximum number of particles (%d) exceeded, particles will not be rendered. Change \"%s\" in the config file.",
+                pfx_context->m_MaxParticleCount, dmParticle::MAX_PARTICLE_COUNT_KEY);
+        }
+        else if (res == dmParticle::GENERATE_VERTEX_DATA_INVALID_INSTANCE)
+        {
+            dmLogWarning("Cannot generate vertex data for emitter (%d), particle instance handle is invalid.", entry);
+        }
+    }
+
+    struct EmitterVertexJobContext
+    {
+        ParticleFXWorld*    m_World;
+        uint8_t*            m_VertexBuffer;
+    };
+
+    static void GenerateVertexDataRange(void* _ctx, uint32_t begin, uint32_t end)
+    {
+        DM_PROFILE("ParticleGenerateVertexDataRange");
+        EmitterVertexJobContext* ctx = (EmitterVertexJobContext*) _ctx;
+        ParticleFXWorld* pfx_world = ctx->m_World;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            EmitterVertexJob& job = pfx_world->m_VertexJobs[i];
+            job.m_Result = dmParticle::GenerateVertexDataRange(pfx_world->m_ParticleContext, pfx_world->m_DT,
+                job.m_RenderData->m_Instance, job.m_RenderData->m_EmitterIndex, job.m_AttributeInfos, Vector4(1,1,1,1),
+                ctx->m_VertexBuffer, job.m_VertexStart, job.m_VertexCount, &job.m_VerticesWritten);
+
+            // Degenerate triangles for the vertices that weren't written, e.g. if the instance is sleeping
+            if (job.m_VerticesWritten < job.m_VertexCount)
+            {
+                uint32_t stride = job.m_AttributeInfos.m_VertexStride;
+                memset(ctx->m_VertexBuffer + (job.m_VertexStart + job.m_VerticesWritten) * stride, 0, (job.m_VertexCount - job.m_VerticesWritten) * stride);
+            }
+        }
+    }
+
+    // Each emitter in the batch gets a range of the vertex buffer, from the vertex count of its particles, and the ranges are then written on the job threads.
+    // Returns the new size of the vertex buffer data.
+    static uint32_t GenerateVertexDataParallel(ParticleFXWorld* pfx_world, dmRender::RenderListEntry* buf, uint32_t* begin, uint32_t* end, dmGraphics::VertexAttributeInfos* material_attribute_info, uint8_t* vertex_buffer, uint32_t vb_size, uint32_t vb_max_size)
+    {
+        dmParticle::HParticleContext particle_context = pfx_world->m_ParticleContext;
+        const uint32_t vx_stride = material_attribute_info->m_VertexStride;
+        const uint32_t max_vertex_count = vb_max_size / vx_stride;
+        uint32_t vertex_index = vb_size / vx_stride;
+
+        dmArray<EmitterVertexJob>& jobs = pfx_world->m_VertexJobs;
+        jobs.SetSize(0);
+        if (jobs.Capacity() < (uint32_t)(end - begin))
+        {
+            jobs.SetCapacity(end - begin);
+        }
+
+        for (uint32_t *i = begin; i != end; ++i)
+        {
+            EmitterVertexJob job;
+            job.m_RenderData = (dmParticle::EmitterRenderData*) buf[*i].m_UserData;
+            FillAttributeInfos(0, INVALID_DYNAMIC_ATTRIBUTE_INDEX, // Not supported yet
+                    job.m_RenderData->m_Attributes,
+                    job.m_RenderData->m_AttributeCount,
+                    material_attribute_info,
+                    &job.m_AttributeInfos);
+
+            uint32_t vertex_count = 0;
+            if (job.m_RenderData->m_Instance != dmParticle::INVALID_INSTANCE)
+            {
+                vertex_count = dmParticle::GetEmitterVertexCount(particle_context, job.m_RenderData->m_Instance, job.m_RenderData->m_EmitterIndex);
+            }
+            job.m_VertexStart     = vertex_index;
+            job.m_VertexCount     = dmMath::Min(vertex_count, max_vertex_count - vertex_index);
+            job.m_VerticesWritten = 0;
+            job.m_Result          = dmParticle::GENERATE_VERTEX_DATA_OK;
+            vertex_index += job.m_VertexCount;
+            jobs.Push(job);
+        }
+
+        EmitterVertexJobContext ctx;
+        ctx.m_World        = pfx_world;
+        ctx.m_VertexBuffer = vertex_buffer;
+        dmJobThread::ParallelFor(pfx_world->m_JobThread, jobs.Size(), 1, GenerateVertexDataRange, &ctx);
+
+        for (uint32_t i = 0; i < jobs.Size(); ++i)
+        {
+            if (jobs[i].m_Result != dmParticle::GENERATE_VERTEX_DATA_OK)
+            {
+                LogGenerateVertexDataResult(pfx_world->m_Context, jobs[i].m_Result, begin[i]);
+            }
+        }
+        return vertex_index * vx_stride;
+    }
+
     static void RenderBatch(ParticleFXWorld* pfx_world, dmRender::HRenderContext render_context, dmRender::RenderListEntry* buf, uint32_t* begin, uint32_t* end)
     {
         DM_PROFILE("ParticleRenderBatch");
@@ -316,30 +435,30 @@ namespace dmGameSystem
         // Same default coordinate space as the editor
         FillMaterialAttributeInfos(material, vx_decl, &material_attribute_info, dmGraphics::COORDINATE_SPACE_WORLD);
 
-        for (uint32_t *i = begin; i != end; ++i)
+        uint32_t worker_count = pfx_world->m_JobThread ? dmJobThread::GetWorkerCount(pfx_world->m_JobThread) : 0;
+        if (worker_count > 0 && (uint32_t)(end - begin) >= PARTICLE_PARALLEL_VERTEX_THRESHOLD)
         {
-            const dmParticle::EmitterRenderData* emitter_render_data = (dmParticle::EmitterRenderData*) buf[*i].m_UserData;
+            vb_size = GenerateVertexDataParallel(pfx_world, buf, begin, end, &material_attribute_info, vertex_buffer.Begin(), vb_size, vb_max_size);
+        }
+        else
+        {
+            for (uint32_t *i = begin; i != end; ++i)
+            {
+                const dmParticle::EmitterRenderData* emitter_render_data = (dmParticle::EmitterRenderData*) buf[*i].m_UserData;
 
-            FillAttributeInfos(0, INVALID_DYNAMIC_ATTRIBUTE_INDEX, // Not supported yet
-                    emitter_render_data->m_Attributes,
-                    emitter_render_data->m_AttributeCount,
-                    &material_attribute_info,
-                    &emitter_attribute_info);
+                FillAttributeInfos(0, INVALID_DYNAMIC_ATTRIBUTE_INDEX, // Not supported yet
+                        emitter_render_data->m_Attributes,
+                        emitter_render_data->m_AttributeCount,
+                        &material_attribute_info,
+                        &emitter_attribute_info);
 
-            dmParticle::GenerateVertexDataResult res = dmParticle::GenerateVertexData(particle_context,
-                pfx_world->m_DT, emitter_render_data->m_Instance, emitter_render_data->m_EmitterIndex,
-                emitter_attribute_info, Vector4(1,1,1,1), (void*) vertex_buffer.Begin(), vb_max_size, &vb_size);
+                dmParticle::GenerateVertexDataResult res = dmParticle::GenerateVertexData(particle_context,
+                    pfx_world->m_DT, emitter_render_data->m_Instance, emitter_render_data->m_EmitterIndex,
+                    emitter_attribute_info, Vector4(1,1,1,1), (void*) vertex_buffer.Begin(), vb_max_size, &vb_size);
 
-            if (res != dmParticle::GENERATE_VERTEX_DATA_OK)
-            {
-                if (res == dmParticle::GENERATE_VERTEX_DATA_MAX_PARTICLES_EXCEEDED)
-                {
-                    dmLogWarning("Maximum number of particles (%d) exceeded, particles will not be rendered. Change \"%s\" in the config file.",
-                        pfx_context->m_MaxParticleCount, dmParticle::MAX_PARTICLE_COUNT_KEY);
-                }
-                else if (res == dmParticle::GENERATE_VERTEX_DATA_INVALID_INSTANCE)
+                if (res != dmParticle::GENERATE_VERTEX_DATA_OK)
                 {
-                    dmLogWarning("Cannot generate vertex data for emitter (%d), particle instance handle is invalid.", (*i));
+                    LogGenerateVertexDataResult(pfx_context, res, *i);
                 }
             }
         }
@@ -359,6 +478,7 @@ namespace dmGameSystem
 
         TextureResource* texture_res = (TextureResource*) first->m_Texture;
         dmGraphics::HTexture texture = texture_res ? texture_res->m_Texture : 0;
+        ReportTextureFullSize(texture_res);
 
         dmRender::RenderObject& ro = pfx_world->m_RenderObjects[ro_index];
         ro.Init();
@@ -387,6 +507,26 @@ namespace dmGameSystem
         pfx_world->m_VerticesWritten += ro_vertex_count;
     }
 
+    static void RenderListFrustumCulling(dmRender::RenderListVisibilityParams const &params)
+    {
+        DM_PROFILE("ParticleFX");
+
+        // The emitters that are culled don't generate any vertices, which lets the particle context know that they are off-screen
+        const dmIntersection::Frustum frustum = *params.m_Frustum;
+        const Matrix4 identity = Matrix4::identity();
+        uint32_t num_entries = params.m_NumEntries;
+        for (uint32_t i = 0; i < num_entries; ++i)
+        {
+            dmRender::RenderListEntry* entry = &params.m_Entries[i];
+            const dmParticle::EmitterRenderData* render_data = (dmParticle::EmitterRenderData*) entry->m_UserData;
+
+            Vector3 aabb_min = render_data->m_AabbMin;
+            Vector3 aabb_max = render_data->m_AabbMax;
+            bool intersect = dmIntersection::TestFrustumOBB(frustum, identity, aabb_min, aabb_max);
+            entry->m_Visibility = intersect ? dmRender::VISIBILITY_FULL : dmRender::VISIBILITY_NONE;
+        }
+    }
+
     static void RenderListDispatch(dmRender::RenderListDispatchParams const &params)
     {
         ParticleFXWorld* pfx_world = (ParticleFXWorld*)params.m_UserData;
@@ -434,7 +574,7 @@ namespace dmGameSystem
         }
 
         dmRender::RenderListEntry* render_list = dmRender::RenderListAlloc(ctx->m_RenderContext, world_emitter_count);
-        dmRender::HRenderListDispatch dispatch = dmRender::RenderListMakeDispatch(ctx->m_RenderContext, &RenderListDispatch, pfx_world);
+        dmRender::HRenderListDispatch dispatch = dmRender::RenderListMakeDispatch(ctx->m_RenderContext, &RenderListDispatch, &RenderListFrustumCulling, pfx_world);
         dmRender::RenderListEntry* write_ptr = render_list;
 
         for (uint32_t i = 0; i < count; ++i)
@@ -14,6 +14,7 @@
 
 #include "comp_private.h"
 #include "resources/res_textureset.h"
+#include <dlib/array.h>
 #include <dlib/log.h>
 #include <dmsdk/dlib/vmath.h>
 #include <render/render.h>
@@ -298,18 +299,22 @@ dmGameObject::PropertyResult SetResourceProperty(dmResource::HFactory factory, c
 struct CompRenderConstants
 {
     CompRenderConstants();
-    dmArray<dmRender::HConstant>    m_RenderConstants;
-    dmHashTable64<dmhash_t>         m_ConstantChecksums; // Maps name_hash to data hash
-    dmRender::HNamedConstantBuffer  m_ConstantBuffer;
-    bool                            m_Updated; // true if the hashes of the values has changed
+    dmArraySmall<dmRender::HConstant, 4>    m_RenderConstants; // Most components only have a few constants
+    dmRender::HNamedConstantBuffer          m_ConstantBuffer;
+    uint32_t                                m_Version;       // Incremented each time a value is changed, added or removed
+    uint32_t                                m_HashVersion;   // The version that m_Hash was calculated for
+    uint32_t                                m_BufferVersion; // The version that m_ConstantBuffer was last filled with
+    uint32_t                                m_Hash;          // The hash of the names and values
+    bool                                    m_Updated; // true if the values have changed since they were last hashed
 };
 
 CompRenderConstants::CompRenderConstants()
 {
-    // We need to make sure these arrays aren't reallocated, since we might hand pointers off to comp_anim.cpp
-    m_RenderConstants.SetCapacity(4);
-    m_ConstantChecksums.SetCapacity(5, 8);
     m_ConstantBuffer = dmRender::NewNamedConstantBuffer();
+    m_Version = 1;
+    m_HashVersion = 0;
+    m_BufferVersion = 0;
+    m_Hash = 0;
     m_Updated = false;
 }
 
@@ -366,35 +371,11 @@ bool GetRenderConstant(HComponentRenderConstants constants, dmhash_t name_hash,
     return true;
 }
 
-static inline dmhash_t HashConstant(dmhash_t name_hash, const dmVMath::Vector4* values, uint32_t num_values)
+// The values are compared as they are set, so that the hash and the constant buffer are only updated when something actually changed
+static inline void SetChanged(HComponentRenderConstants constants)
 {
-    HashState32 state;
-    dmHashInit32(&state, false);
-    dmHashUpdateBuffer32(&state, &name_hash, sizeof(name_hash));
-    dmHashUpdateBuffer32(&state, values, sizeof(values[0]) * num_values);
-    return dmHashFinal32(&state);
-}
-
-// TODO: Is a hash really necessary? Isn't enough to compare the bits before/after?
-//       Previously we did "if (lengthSqr(value - prev_value) > 0)"
-static void UpdateChecksums(HComponentRenderConstants constants, dmhash_t name_hash, dmVMath::Vector4* values, uint32_t num_values)
-{
-    // Update hash
-    dmhash_t new_hash = HashConstant(name_hash, values, num_values);
-    dmhash_t* old_hash = constants->m_ConstantChecksums.Get(name_hash);
-
-    if (old_hash == 0 || *old_hash != new_hash)
-    {
-        constants->m_Updated = true;
-    }
-
-    if (constants->m_ConstantChecksums.Full())
-    {
-        uint32_t capacity = constants->m_ConstantChecksums.Capacity() + 8;
-        constants->m_ConstantChecksums.SetCapacity(capacity, capacity*2);
-    }
-
-    constants->m_ConstantChecksums.Put(name_hash, new_hash);
+    constants->m_Version++;
+    constants->m_Updated = true;
 }
 
 static dmRender::HConstant FindOrCreateConstant(HComponentRenderConstants constants, dmhash_t name_hash, dmRender::HMaterial material)
@@ -406,11 +387,7 @@ static dmRender::HConstant FindOrCreateConstant(HComponentRenderConstants consta
     }
     // it didn't exist, so we'll add it
     dmRender::HConstant constant = dmRender::NewConstant(name_hash);
-    if (constants->m_RenderConstants.Full())
-    {
-        constants->m_RenderConstants.OffsetCapacity(4);
-    }
-    constants->m_RenderConstants.Push(constant);
+    constants->m_RenderConstants.PushGrow(constant);
 
     dmRender::HConstant material_constant;
     if (!dmRender::GetMaterialProgramConstant(material, name_hash, material_constant))
@@ -451,17 +428,15 @@ static dmRender::HConstant FindOrCreateConstant(HComponentRenderConstants consta
     }
     // it didn't exist, so we'll add it
     dmRender::HConstant constant = dmRender::NewConstant(name_hash);
-    if (constants->m_RenderConstants.Full())
-    {
-        constants->m_RenderConstants.OffsetCapacity(4);
-    }
-    constants->m_RenderConstants.Push(constant);
+    constants->m_RenderConstants.PushGrow(constant);
     return constant;
 }
 
 void SetRenderConstant(HComponentRenderConstants constants, dmRender::HMaterial material, dmhash_t name_hash, int32_t value_index, uint32_t* element_index, const dmGameObject::PropertyVar& var)
 {
+    uint32_t num_constants = constants->m_RenderConstants.Size();
     dmRender::HConstant constant = FindOrCreateConstant(constants, name_hash, material);
+    bool changed = num_constants != constants->m_RenderConstants.Size();
 
     uint32_t num_values = 0;
     dmVMath::Vector4* values = dmRender::GetConstantValues(constant, &num_values);
@@ -486,61 +461,86 @@ void SetRenderConstant(HComponentRenderConstants constants, dmRender::HMaterial
             dmLogError("Setting a specific element in a matrix constant for the property %s[%u] is not supported.", dmHashReverseSafe64(name_hash), value_index);
             return;
         }
+        changed |= memcmp(v, var.m_M4, sizeof(var.m_M4)) != 0;
         memcpy(v, var.m_M4, sizeof(var.m_M4));
     }
     else
     {
+        Vector4 value = *v;
         if (element_index == 0x0)
-            *v = Vector4(var.m_V4[0], var.m_V4[1], var.m_V4[2], var.m_V4[3]);
+            value = Vector4(var.m_V4[0], var.m_V4[1], var.m_V4[2], var.m_V4[3]);
         else
-            v->setElem(*element_index, (float)var.m_Number);
+            value.setElem(*element_index, (float)var.m_Number);
+        changed |= memcmp(v, &value, sizeof(value)) != 0;
+        *v = value;
     }
 
-    UpdateChecksums(constants, name_hash, values, num_values);
+    if (changed)
+    {
+        SetChanged(constants);
+    }
 }
 
 void SetRenderConstant(HComponentRenderConstants constants, dmhash_t name_hash, dmVMath::Vector4* values, uint32_t num_values)
 {
+    uint32_t num_constants = constants->m_RenderConstants.Size();
     dmRender::HConstant constant = FindOrCreateConstant(constants, name_hash);
-    dmRender::SetConstantValues(constant, values, num_values);
-    UpdateChecksums(constants, name_hash, values, num_values);
+    bool changed = num_constants != constants->m_RenderConstants.Size();
+
+    uint32_t prev_num_values = 0;
+    dmVMath::Vector4* prev_values = dmRender::GetConstantValues(constant, &prev_num_values);
+    changed |= prev_num_values != num_values || memcmp(prev_values, values, sizeof(values[0]) * num_values) != 0;
+    if (changed)
+    {
+        dmRender::SetConstantValues(constant, values, num_values);
+        SetChanged(constants);
+    }
 }
 
 int ClearRenderConstant(HComponentRenderConstants constants, dmhash_t name_hash)
 {
     int index = FindRenderConstant(constants, name_hash);
-    if (index >= 0)
-    {
-        constants->m_RenderConstants.EraseSwap(index);
-    }
-
-    dmhash_t* checksum = constants->m_ConstantChecksums.Get(name_hash);
-    if (checksum)
+    if (index < 0)
     {
-        constants->m_ConstantChecksums.Erase(name_hash);
-        constants->m_Updated |= checksum != 0; // did it exist?
+        return 0;
     }
-    return checksum != 0 ? 1 : 0;
+    constants->m_RenderConstants.EraseSwap(index);
+    SetChanged(constants);
+    return 1;
 }
 
 void HashRenderConstants(HComponentRenderConstants constants, HashState32* state)
 {
-    // Padding in the SetConstant-struct forces us to hash the individual fields
-
-    uint32_t size = constants->m_RenderConstants.Size();
-    for (uint32_t i = 0; i < size; ++i)
+    // The hash of the values is kept until they change, so rehashing a component doesn't rehash all its constants
+    if (constants->m_HashVersion != constants->m_Version)
     {
-        dmRender::HConstant constant = constants->m_RenderConstants[i];
-        uint32_t num_values;
-        dmVMath::Vector4* values = dmRender::GetConstantValues(constant, &num_values);
-        dmhash_t name_hash = dmRender::GetConstantName(constant);
-        dmHashUpdateBuffer32(state, &name_hash, sizeof(name_hash));
-        dmHashUpdateBuffer32(state, values, sizeof(values[0]) * num_values);
+        HashState32 constants_state;
+        dmHashInit32(&constants_state, false);
+
+        // Padding in the SetConstant-struct forces us to hash the individual fields
+        uint32_t size = constants->m_RenderConstants.Size();
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            dmRender::HConstant constant = constants->m_RenderConstants[i];
+            uint32_t num_values;
+            dmVMath::Vector4* values = dmRender::GetConstantValues(constant, &num_values);
+            dmhash_t name_hash = dmRender::GetConstantName(constant);
+            dmHashUpdateBuffer32(&constants_state, &name_hash, sizeof(name_hash));
+            dmHashUpdateBuffer32(&constants_state, values, sizeof(values[0]) * num_values);
+        }
+        constants->m_Hash = dmHashFinal32(&constants_state);
+        constants->m_HashVersion = constants->m_Version;
     }
+    dmHashUpdateBuffer32(state, &constants->m_Hash, sizeof(constants->m_Hash));
 
     constants->m_Updated = false;
 }
 
+uint32_t GetRenderConstantsVersion(HComponentRenderConstants constants)
+{
+    return constants->m_Version;
+}
+
 int AreRenderConstantsUpdated(HComponentRenderConstants constants)
 {
     return constants->m_Updated ? 1 : 0;
@@ -549,8 +549,13 @@ int AreRenderConstantsUpdated(HComponentRenderConstants constants)
 void EnableRenderObjectConstants(dmRender::RenderObject* ro, HComponentRenderConstants constants)
 {
     ro->m_ConstantBuffer = constants->m_ConstantBuffer;
-    dmRender::ClearNamedConstantBuffer(ro->m_ConstantBuffer);
-    dmRender::SetNamedConstants(ro->m_ConstantBuffer, constants->m_RenderConstants.Begin(), constants->m_RenderConstants.Size());
+    // The buffer is shared by all render objects of the component, and only needs to be refilled after a change
+    if (constants->m_BufferVersion != constants->m_Version)
+    {
+        dmRender::ClearNamedConstantBuffer(ro->m_ConstantBuffer);
+        dmRender::SetNamedConstants(ro->m_ConstantBuffer, constants->m_RenderConstants.Begin(), constants->m_RenderConstants.Size());
+        constants->m_BufferVersion = constants->m_Version;
+    }
 }
 
 
@@ -20,6 +20,7 @@
 #include <dlib/index_pool.h>
 #include <dlib/log.h>
 #include <dlib/hash.h>
+#include <dlib/math.h>
 #include <dlib/object_pool.h>
 #include <dlib/profile.h>
 #include <sound/sound.h>
@@ -46,6 +47,8 @@ namespace dmGameSystem
         dmMessage::URL          m_Receiver;
         dmGameObject::HInstance m_Instance;
         uintptr_t               m_LuaCallback;
+        // Last world position of a spatial sound, for its velocity
+        dmVMath::Point3         m_Position;
         float                   m_Delay;
         uint32_t                m_PlayId;
 
@@ -53,7 +56,9 @@ namespace dmGameSystem
         uint8_t                 m_PauseRequested        : 1;
         uint8_t                 m_Paused                : 1;
         uint8_t                 m_ShouldDispatchEvents  : 1;
-        uint8_t                                         : 4;
+        // Follows the position of m_Instance
+        uint8_t                 m_Spatial               : 1;
+        uint8_t                                         : 3;
     };
 
     struct SoundComponent
@@ -62,6 +67,9 @@ namespace dmGameSystem
         float   m_Pan;
         float   m_Gain;
         float   m_Speed;
+        // The sounds are spatial when the max distance is above 0
+        float   m_MinDistance;
+        float   m_MaxDistance;
     };
 
     struct SoundWorld
@@ -75,6 +83,8 @@ namespace dmGameSystem
     static const dmhash_t SOUND_PROP_PAN    = dmHashString64("pan");
     static const dmhash_t SOUND_PROP_SPEED  = dmHashString64("speed");
     static const dmhash_t SOUND_PROP_SOUND  = dmHashString64("sound");
+    static const dmhash_t SOUND_PROP_MIN_DISTANCE = dmHashString64("min_distance");
+    static const dmhash_t SOUND_PROP_MAX_DISTANCE = dmHashString64("max_distance");
 
     dmGameObject::CreateResult CompSoundNewWorld(const dmGameObject::ComponentNewWorldParams& params)
     {
@@ -128,6 +138,8 @@ namespace dmGameSystem
         component->m_Gain   = component->m_Resource->m_Gain;
         component->m_Pan    = component->m_Resource->m_Pan;
         component->m_Speed  = component->m_Resource->m_Speed;
+        component->m_MinDistance = 1.0f;
+        component->m_MaxDistance = 0.0f;
 
         *params.m_UserData = (uintptr_t)index;
         return dmGameObject::CREATE_RESULT_OK;
@@ -143,6 +155,19 @@ namespace dmGameSystem
     {
         SoundWorld* world = (SoundWorld*)params.m_World;
         uint32_t index = *params.m_UserData;
+        SoundComponent* component = &world->m_Components.Get(index);
+
+        // The sounds keep playing after the game object is deleted, at its last position
+        uint32_t size = world->m_Entries.Size();
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            PlayEntry& entry = world->m_Entries[i];
+            if (entry.m_SoundInstance != 0 && entry.m_Sound == component->m_Resource && entry.m_Instance == params.m_Instance)
+            {
+                entry.m_Spatial = 0;
+            }
+        }
+
         world->m_Components.Free(index, false);
 
         return dmGameObject::CREATE_RESULT_OK;
@@ -211,6 +236,15 @@ namespace dmGameSystem
             if (entry.m_SoundInstance != 0)
             {
                 DM_PROPERTY_ADD_U32(rmtp_SoundPlaying, 1);
+                if (entry.m_Spatial)
+                {
+                    // The attenuation etc is computed by the sound system, from the position
+                    dmVMath::Point3 position = dmGameObject::GetWorldPosition(entry.m_Instance);
+                    float dt = params.m_UpdateContext->m_DT;
+                    dmVMath::Vector3 velocity = dt > 0.0f ? (position - entry.m_Position) / dt : dmVMath::Vector3(0.0f);
+                    entry.m_Position = position;
+                    dmSound::SetPosition(entry.m_SoundInstance, position, velocity);
+                }
                 float prev_delay = entry.m_Delay;
                 entry.m_Delay -= params.m_UpdateContext->m_DT;
                 if (entry.m_Delay < 0.0f)
@@ -359,6 +393,42 @@ namespace dmGameSystem
      * @param [play_id] [type:number] id number supplied when the message was posted.
      */
 
+    static void SetEntrySpatial(PlayEntry& entry, const SoundComponent* component)
+    {
+        entry.m_Spatial = component->m_MaxDistance > 0.0f;
+        if (!entry.m_Spatial)
+        {
+            dmSound::SetSpatial(entry.m_SoundInstance, 0);
+            return;
+        }
+
+        dmSound::SpatialParams params;
+        params.m_MinDistance = component->m_MinDistance;
+        params.m_MaxDistance = component->m_MaxDistance;
+        dmSound::SetSpatial(entry.m_SoundInstance, &params);
+        entry.m_Position = dmGameObject::GetWorldPosition(entry.m_Instance);
+        dmSound::SetPosition(entry.m_SoundInstance, entry.m_Position, dmVMath::Vector3(0.0f));
+    }
+
+    static dmGameObject::PropertyResult SoundSetDistance(SoundWorld* world, dmGameObject::HInstance instance, SoundComponent* component, dmhash_t property_id, float value)
+    {
+        if (property_id == SOUND_PROP_MIN_DISTANCE)
+            component->m_MinDistance = dmMath::Max(0.0f, value);
+        else
+            component->m_MaxDistance = dmMath::Max(0.0f, value);
+
+        uint32_t size = world->m_Entries.Size();
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            PlayEntry& entry = world->m_Entries[i];
+            if (entry.m_SoundInstance != 0 && entry.m_Sound == component->m_Resource && entry.m_Instance == instance)
+            {
+                SetEntrySpatial(entry, component);
+            }
+        }
+        return dmGameObject::PROPERTY_RESULT_OK;
+    }
+
     static dmGameObject::PropertyResult SoundSetParameter(SoundWorld* world, dmGameObject::HInstance instance, SoundComponent* component, dmSound::Parameter type, float value)
     {
         switch(type) {
@@ -453,6 +523,11 @@ namespace dmGameSystem
                     dmSound::SetParameter(entry.m_SoundInstance, dmSound::PARAMETER_PAN, dmVMath::Vector4(pan, 0, 0, 0));
                     dmSound::SetParameter(entry.m_SoundInstance, dmSound::PARAMETER_SPEED, dmVMath::Vector4(speed, 0, 0, 0));
                     dmSound::SetLooping(entry.m_SoundInstance, sound->m_Looping, (sound->m_Looping && !sound->m_Loopcount) ? -1 : sound->m_Loopcount ); // loopcounter semantics differ a bit from loopcount. If -1, it means loopforever, otherwise it contains the # of loops remaining.
+                    entry.m_Spatial = 0;
+                    if (component->m_MaxDistance > 0.0f)
+                    {
+                        SetEntrySpatial(entry, component);
+                    }
 
                     entry.m_Listener = params.m_Message->m_Sender;
                     uintptr_t callback = params.m_Message->m_UserData2;
@@ -555,6 +630,12 @@ namespace dmGameSystem
 
         if (params.m_PropertyId == SOUND_PROP_SOUND) {
             return GetResourceProperty(dmGameObject::GetFactory(params.m_Instance), component->m_Resource->m_SoundDataRes, out_value);
+        } else if (params.m_PropertyId == SOUND_PROP_MIN_DISTANCE) {
+            out_value.m_Variant = dmGameObject::PropertyVar(component->m_MinDistance);
+            return dmGameObject::PROPERTY_RESULT_OK;
+        } else if (params.m_PropertyId == SOUND_PROP_MAX_DISTANCE) {
+            out_value.m_Variant = dmGameObject::PropertyVar(component->m_MaxDistance);
+            return dmGameObject::PROPERTY_RESULT_OK;
         } else {
             dmSound::Parameter parameter = GetSoundParameterType(params.m_PropertyId);
             if (parameter == dmSound::PARAMETER_MAX) {
@@ -573,6 +654,10 @@ namespace dmGameSystem
         if (params.m_Value.m_Type != dmGameObject::PROPERTY_TYPE_NUMBER)
             return dmGameObject::PROPERTY_RESULT_TYPE_MISMATCH;
 
+        if (params.m_PropertyId == SOUND_PROP_MIN_DISTANCE || params.m_PropertyId == SOUND_PROP_MAX_DISTANCE) {
+            return SoundSetDistance(world, params.m_Instance, component, params.m_PropertyId, params.m_Value.m_Number);
+        }
+
         dmSound::Parameter parameter = GetSoundParameterType(params.m_PropertyId);
         if (parameter == dmSound::PARAMETER_MAX) {
             return dmGameObject::PROPERTY_RESULT_NOT_FOUND;
@@ -15,10 +15,12 @@
 #include "comp_sprite.h"
 
 #include <string.h>
+#include <math.h>
 #include <float.h>
 #include <algorithm>
 
 #include <dlib/array.h>
+#include <dlib/atomic.h>
 #include <dlib/hash.h>
 #include <dlib/log.h>
 #include <dlib/message.h>
@@ -33,6 +35,7 @@
 #include <gameobject/gameobject_ddf.h>
 
 #include "../resources/res_sprite.h"
+#include "../resources/res_texture.h"
 #include "../gamesys.h"
 #include "../gamesys_private.h"
 #include "comp_private.h"
@@ -65,6 +68,33 @@ namespace dmGameSystem
         SpriteResourceOverrides() : m_Material(0) {}
     };
 
+    // The state the vertices of a sprite are generated from. The attribute values aren't part of it, changing
+    // them marks the vertices as dirty instead (see SpriteComponent::m_VerticesDirty).
+    struct SpriteVertexCacheKey
+    {
+        Matrix4                             m_World;
+        Vector4                             m_Slice9;
+        Vector3                             m_Size;
+        dmhash_t                            m_Animation;
+        const dmGameSystemDDF::TextureSet*  m_TextureSets[dmRender::RenderObject::MAX_TEXTURE_COUNT];
+        uint32_t                            m_NumTextures;
+        uint32_t                            m_Frame;
+        uint32_t                            m_VertexStride;
+        uint32_t                            m_Flags;
+    };
+
+    // The vertices and indices from the last time the sprite was generated, so they can be copied as long as
+    // the sprite doesn't change. The indices are relative to the first vertex of the sprite.
+    struct SpriteVertexCache
+    {
+        SpriteVertexCacheKey m_Key;
+        uint8_t*             m_Data; // The vertices, followed by the indices as uint32_t
+        uint32_t             m_DataCapacity;
+        uint32_t             m_VertexDataSize;
+        uint32_t             m_IndexCount;
+        uint8_t              m_Valid : 1;
+    };
+
     struct SpriteComponent
     {
         Matrix4                     m_World;
@@ -78,6 +108,7 @@ namespace dmGameSystem
         SpriteResource*             m_Resource;
         SpriteResourceOverrides*    m_Overrides;
         HComponentRenderConstants   m_RenderConstants;
+        SpriteVertexCache*          m_VertexCache;
 
         dmMessage::URL              m_Listener;
         int32_t                     m_FunctionRef; // Animation callback function
@@ -86,6 +117,7 @@ namespace dmGameSystem
 
         uint32_t                    m_AnimationID; // index into array
         uint32_t                    m_DynamicVertexAttributeIndex;
+        uint32_t                    m_SpatialProxy;
 
         /// Currently playing animation
         dmhash_t                    m_CurrentAnimation;
@@ -106,35 +138,67 @@ namespace dmGameSystem
         uint16_t                    m_AddedToUpdate : 1;
         uint16_t                    m_ReHash : 1;
         uint16_t                    m_UseSlice9 : 1;
-        uint16_t                    : 6;
+        uint16_t                    m_VerticesDirty : 1;
+        uint16_t                    : 5;
     };
 
     const uint32_t MAX_TEXTURE_COUNT = dmRender::RenderObject::MAX_TEXTURE_COUNT;
 
+    // Number of sprites per job when updating the sprites in parallel
+    static const uint32_t SPRITE_PARALLEL_GRAIN_SIZE = 256;
+    // Minimum number of sprites in a batch, before we generate the vertices in parallel
+    static const uint32_t SPRITE_PARALLEL_VERTEX_THRESHOLD = 512;
+    static const uint32_t SPRITE_MAX_VERTEX_JOBS = 16;
+    // How much the bounds in the spatial index are enlarged, so that moving sprites don't have to update the tree every frame
+    static const float    SPRITE_SPATIAL_INDEX_MARGIN = 16.0f;
+    // The dynamic vertex buffer has room for this many dispatches (e.g. render predicates) per frame. The rest are uploaded.
+    static const uint32_t SPRITE_DYNAMIC_VERTEX_DISPATCH_COUNT = 2;
+
+    // Scratch buffers used while generating the vertices (one per job)
+    struct SpriteVertexScratch
+    {
+        // We currently assume the vertex format uses 2-tuple UVs
+        dmArray<float>                      m_UVs[MAX_TEXTURE_COUNT];
+        dmArray<Vector4>                    m_PositionWorld;
+        dmArray<Vector4>                    m_PositionLocal;
+    };
+
     struct SpriteWorld
     {
         dmObjectPool<SpriteComponent>       m_Components;
         DynamicAttributePool                m_DynamicVertexAttributePool;
         dmArray<dmRender::RenderObject*>    m_RenderObjects;
         dmArray<float>                      m_BoundingVolumes;
-        // We currently assume the vertex format uses 2-tuple UVs
-        dmArray<float>                      m_ScratchUVs[MAX_TEXTURE_COUNT];
-        dmArray<Vector4>                    m_ScratchPositionWorld;
-        dmArray<Vector4>                    m_ScratchPositionLocal;
+        dmRender::HSpatialIndex             m_SpatialIndex;
+        SpriteVertexScratch                 m_VertexScratch[SPRITE_MAX_VERTEX_JOBS];
+        dmJobThread::HContext               m_JobThread;
         uint32_t                            m_RenderObjectsInUse;
         dmRender::HBufferedRenderBuffer     m_VertexBuffer;
         uint8_t*                            m_VertexBufferData;
         uint8_t*                            m_VertexBufferWritePtr;
+        uint8_t*                            m_VertexBufferBase;         // m_VertexBufferData, or the reserved part of m_DynamicVertexBuffer
+        dmGraphics::HDynamicVertexBuffer    m_DynamicVertexBuffer;      // Written directly, if the graphics adapter supports it
+        uint32_t                            m_DynamicVertexOffset;
         dmRender::HBufferedRenderBuffer     m_IndexBuffer;
+        dmRender::HBufferedRenderBuffer     m_InstanceBuffer;   // Per sprite data for materials with instanced vertex attributes
+        dmArray<uint8_t>                    m_InstanceBufferData;
+        uint32_t                            m_InstanceDispatchCount;
         uint32_t                            m_VerticesWritten;
         uint32_t                            m_VertexMemorySize;
         uint32_t                            m_VertexCount;
         uint32_t                            m_IndexCount;
+        // The allocated size of the buffers, which only grow
+        uint32_t                            m_VertexMemoryCapacity;
+        uint32_t                            m_VertexCapacity;
+        uint32_t                            m_IndexCapacity;
+        // The number of sprites the collection was created for, which the buffers are first allocated for
+        uint32_t                            m_PlannedSpriteCount;
         uint32_t                            m_DispatchCount;
         uint8_t*                            m_IndexBufferData;
         uint8_t*                            m_IndexBufferWritePtr;
         uint8_t                             m_Is16BitIndex : 1;
         uint8_t                             m_ReallocBuffers : 1;
+        uint8_t                             m_SortComponents : 1;       // Keeps the sprites of a batch next to each other in memory
     };
 
     struct TexturesData
@@ -177,6 +241,11 @@ namespace dmGameSystem
     static float GetPlaybackRate(SpriteComponent* component);
     static void SetPlaybackRate(SpriteComponent* component, float playback_rate);
 
+    static inline bool IsWritingDynamicVertices(const SpriteWorld* sprite_world)
+    {
+        return sprite_world->m_VertexBufferBase != sprite_world->m_VertexBufferData;
+    }
+
     static void ReAllocateBuffers(SpriteWorld* sprite_world, dmRender::HRenderContext render_context) {
         if (sprite_world->m_VertexBuffer)
         {
@@ -184,12 +253,32 @@ namespace dmGameSystem
             sprite_world->m_VertexBuffer = 0;
         }
 
+        // The first allocation fits the planned sprites, and the buffers grow geometrically after that,
+        // so that gameplay doesn't reallocate them each time a few sprites are added
+        uint32_t vertex_count    = sprite_world->m_VertexCount;
+        uint32_t vertex_stride   = vertex_count ? sprite_world->m_VertexMemorySize / vertex_count : 0;
+        uint32_t vertex_capacity = dmMath::Max(sprite_world->m_VertexCapacity + sprite_world->m_VertexCapacity / 2, sprite_world->m_PlannedSpriteCount * SPRITE_VERTEX_COUNT_LEGACY);
+        uint32_t index_capacity  = dmMath::Max(sprite_world->m_IndexCapacity + sprite_world->m_IndexCapacity / 2, sprite_world->m_PlannedSpriteCount * SPRITE_INDEX_COUNT_LEGACY);
+        // Don't grow past what 16 bit indices can address, unless needed
+        if (vertex_count <= 65536)
+            vertex_capacity = dmMath::Min(vertex_capacity, 65536u);
+        vertex_capacity = dmMath::Max(vertex_capacity, vertex_count);
+        index_capacity  = dmMath::Max(index_capacity, sprite_world->m_IndexCount);
+        uint32_t vertex_memsize = dmMath::Max(vertex_capacity * vertex_stride, sprite_world->m_VertexMemorySize);
+
+        sprite_world->m_VertexCapacity       = vertex_capacity;
+        sprite_world->m_IndexCapacity        = index_capacity;
+        sprite_world->m_VertexMemoryCapacity = vertex_memsize;
+
         sprite_world->m_VertexBuffer     = dmRender::NewBufferedRenderBuffer(render_context, dmRender::RENDER_BUFFER_TYPE_VERTEX_BUFFER);
-        uint32_t vertex_memsize          = sprite_world->m_VertexMemorySize;
         sprite_world->m_VertexBufferData = (uint8_t*) realloc(sprite_world->m_VertexBufferData, vertex_memsize);
 
-        uint32_t index_data_type_size   = sprite_world->m_VertexCount <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
-        size_t indices_memsize          = sprite_world->m_IndexCount * index_data_type_size;
+        dmGraphics::HContext graphics_context = dmRender::GetGraphicsContext(render_context);
+        dmGraphics::DeleteDynamicVertexBuffer(graphics_context, sprite_world->m_DynamicVertexBuffer);
+        sprite_world->m_DynamicVertexBuffer = dmGraphics::NewDynamicVertexBuffer(graphics_context, vertex_memsize * SPRITE_DYNAMIC_VERTEX_DISPATCH_COUNT);
+
+        uint32_t index_data_type_size   = vertex_capacity <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+        size_t indices_memsize          = index_capacity * index_data_type_size;
         sprite_world->m_Is16BitIndex    = index_data_type_size == sizeof(uint16_t) ? 1 : 0;
         sprite_world->m_IndexBufferData = (uint8_t*)realloc(sprite_world->m_IndexBufferData, indices_memsize);
 
@@ -212,11 +301,19 @@ namespace dmGameSystem
         sprite_world->m_BoundingVolumes.SetCapacity(comp_count);
         sprite_world->m_BoundingVolumes.SetSize(comp_count);
         memset(sprite_world->m_Components.GetRawObjects().Begin(), 0, sizeof(SpriteComponent) * comp_count);
+        // Only planned when the collection knows how many sprites it has, rather than the max count
+        sprite_world->m_PlannedSpriteCount = params.m_MaxComponentInstances != 0xFFFFFFFF ? comp_count : 0;
+        sprite_world->m_JobThread = sprite_context->m_JobThread;
+        sprite_world->m_SpatialIndex = dmRender::NewSpatialIndex(SPRITE_SPATIAL_INDEX_MARGIN);
         sprite_world->m_RenderObjectsInUse = 0;
         sprite_world->m_VertexBuffer     = 0;
         sprite_world->m_VertexBufferData = 0;
+        sprite_world->m_VertexBufferBase = 0;
+        sprite_world->m_DynamicVertexBuffer = 0;
         sprite_world->m_IndexBuffer      = 0;
         sprite_world->m_IndexBufferData  = 0;
+        sprite_world->m_InstanceBuffer   = dmRender::NewBufferedRenderBuffer(sprite_context->m_RenderContext, dmRender::RENDER_BUFFER_TYPE_VERTEX_BUFFER);
+        sprite_world->m_InstanceDispatchCount = 0;
 
         InitializeMaterialAttributeInfos(sprite_world->m_DynamicVertexAttributePool, 8);
 
@@ -238,8 +335,12 @@ namespace dmGameSystem
         SpriteContext* sprite_context = (SpriteContext*)params.m_Context;
         dmRender::DeleteBufferedRenderBuffer(sprite_context->m_RenderContext, sprite_world->m_VertexBuffer);
         free(sprite_world->m_VertexBufferData);
+        dmGraphics::DeleteDynamicVertexBuffer(dmRender::GetGraphicsContext(sprite_context->m_RenderContext), sprite_world->m_DynamicVertexBuffer);
         dmRender::DeleteBufferedRenderBuffer(sprite_context->m_RenderContext, sprite_world->m_IndexBuffer);
         free(sprite_world->m_IndexBufferData);
+        dmRender::DeleteBufferedRenderBuffer(sprite_context->m_RenderContext, sprite_world->m_InstanceBuffer);
+
+        dmRender::DeleteSpatialIndex(sprite_world->m_SpatialIndex);
 
         delete sprite_world;
         return dmGameObject::CREATE_RESULT_OK;
@@ -476,6 +577,16 @@ namespace dmGameSystem
         return texture ? texture->m_Texture : 0;
     }
 
+    // The texture sets are part of the batch key, so all sprites in a batch share them
+    static inline void ResolveTextureSets(TexturesData* textures, const SpriteComponent* component)
+    {
+        for (uint32_t i = 0; i < textures->m_NumTextures; ++i)
+        {
+            textures->m_Resources[i]   = GetTextureSetByIndex(component, i);
+            textures->m_TextureSets[i] = textures->m_Resources[i]->m_TextureSet;
+        }
+    }
+
     static void UpdateCurrentAnimationFrame(SpriteComponent* component) {
         TextureSetResource* texture_set = GetFirstTextureSet(component);
         dmGameSystemDDF::TextureSet* texture_set_ddf = texture_set->m_TextureSet;
@@ -579,6 +690,13 @@ namespace dmGameSystem
 
         component->m_MixedHash = dmHashFinal32(&state);
         component->m_ReHash = 0;
+        // The material, textures or overrides may have changed
+        component->m_VerticesDirty = 1;
+    }
+
+    static inline uint32_t GetBatchKey(const SpriteComponent& component)
+    {
+        return component.m_MixedHash;
     }
 
     dmGameObject::CreateResult CompSpriteCreate(const dmGameObject::ComponentCreateParams& params)
@@ -593,6 +711,7 @@ namespace dmGameSystem
         uint32_t index = sprite_world->m_Components.Alloc();
         SpriteComponent* component = &sprite_world->m_Components.Get(index);
         memset(component, 0, sizeof(SpriteComponent));
+        sprite_world->m_SortComponents = 1;
 
         component->m_Instance = params.m_Instance;
         component->m_Position = Vector3(params.m_Position);
@@ -613,6 +732,7 @@ namespace dmGameSystem
                 component->m_Resource->m_DDF->m_SizeMode == dmGameSystemDDF::SpriteDesc::SIZE_MODE_MANUAL;
 
         component->m_DynamicVertexAttributeIndex = INVALID_DYNAMIC_ATTRIBUTE_INDEX;
+        component->m_SpatialProxy = dmRender::INVALID_SPATIAL_PROXY; // Added with the first transform update
         component->m_Size = Vector3(0.0f, 0.0f, 0.0f);
         component->m_AnimationID = 0;
 
@@ -655,6 +775,17 @@ namespace dmGameSystem
 
         FreeMaterialAttribute(sprite_world->m_DynamicVertexAttributePool, component->m_DynamicVertexAttributeIndex);
 
+        if (component->m_VertexCache)
+        {
+            free(component->m_VertexCache->m_Data);
+            delete component->m_VertexCache;
+        }
+
+        if (component->m_SpatialProxy != dmRender::INVALID_SPATIAL_PROXY)
+        {
+            dmRender::RemoveSpatialProxy(sprite_world->m_SpatialIndex, component->m_SpatialProxy);
+        }
+
         sprite_world->m_Components.Free(index, true);
         return dmGameObject::CREATE_RESULT_OK;
     }
@@ -710,6 +841,143 @@ namespace dmGameSystem
         dmGraphics::SetWriteAttributeStreamDesc(&params->m_PageIndices, pi_channels, dmGraphics::VertexAttribute::VECTOR_TYPE_SCALAR, pi_channels_count, true);
     }
 
+    // The common sprite vertex formats only use float attributes, which are either written straight from the
+    // positions, uvs and page indices of the sprite, or are constant. For those we can skip the generic attribute
+    // conversion in dmGraphics::WriteAttributes and copy the floats directly.
+    struct SpriteVertexLayout
+    {
+        enum Source
+        {
+            SOURCE_POSITION_WORLD,
+            SOURCE_TEXCOORD,
+            SOURCE_PAGE_INDEX,
+            SOURCE_CONSTANT,
+        };
+
+        struct Attribute
+        {
+            const float* m_Value; // For SOURCE_CONSTANT
+            uint8_t      m_Source;
+            uint8_t      m_Channel;
+            uint8_t      m_ElementCount;
+        };
+
+        Attribute m_Attributes[dmGraphics::MAX_VERTEX_STREAM_COUNT];
+        uint32_t  m_AttributeCount;
+        uint32_t  m_TexCoordChannelCount;
+        uint32_t  m_PageIndexChannelCount;
+    };
+
+    // Returns false if any of the per vertex attributes needs the generic conversion
+    static bool GetSpriteVertexLayout(const dmGraphics::VertexAttributeInfos* infos, SpriteVertexLayout* layout)
+    {
+        memset(layout, 0, sizeof(*layout));
+
+        for (uint32_t i = 0; i < infos->m_NumInfos; ++i)
+        {
+            const dmGraphics::VertexAttributeInfo& info = infos->m_Infos[i];
+            if (info.m_StepFunction != dmGraphics::VERTEX_STEP_FUNCTION_VERTEX)
+            {
+                continue;
+            }
+
+            uint32_t element_count = dmGraphics::VectorTypeToElementCount(info.m_VectorType);
+            if (info.m_DataType != dmGraphics::VertexAttribute::TYPE_FLOAT || element_count > 4 || info.m_VectorType == dmGraphics::VertexAttribute::VECTOR_TYPE_MAT2)
+            {
+                return false;
+            }
+
+            SpriteVertexLayout::Attribute& attribute = layout->m_Attributes[layout->m_AttributeCount++];
+            attribute.m_ElementCount = element_count;
+
+            switch (info.m_SemanticType)
+            {
+                case dmGraphics::VertexAttribute::SEMANTIC_TYPE_POSITION:
+                    if (info.m_CoordinateSpace == dmGraphics::COORDINATE_SPACE_LOCAL)
+                    {
+                        return false;
+                    }
+                    attribute.m_Source = SpriteVertexLayout::SOURCE_POSITION_WORLD;
+                    break;
+
+                case dmGraphics::VertexAttribute::SEMANTIC_TYPE_TEXCOORD:
+                    if (attribute.m_ElementCount > 2)
+                    {
+                        return false;
+                    }
+                    attribute.m_Source  = SpriteVertexLayout::SOURCE_TEXCOORD;
+                    attribute.m_Channel = layout->m_TexCoordChannelCount++;
+                    break;
+
+                case dmGraphics::VertexAttribute::SEMANTIC_TYPE_PAGE_INDEX:
+                    if (info.m_VectorType != dmGraphics::VertexAttribute::VECTOR_TYPE_SCALAR)
+                    {
+                        return false;
+                    }
+                    attribute.m_Source  = SpriteVertexLayout::SOURCE_PAGE_INDEX;
+                    attribute.m_Channel = layout->m_PageIndexChannelCount++;
+                    break;
+
+                case dmGraphics::VertexAttribute::SEMANTIC_TYPE_WORLD_MATRIX:
+                    return false;
+
+                default:
+                    // No engine provided data, so the value of the attribute is written as is
+                    if (info.m_ValuePtr == 0 || info.m_ValueVectorType != info.m_VectorType)
+                    {
+                        return false;
+                    }
+                    attribute.m_Source = SpriteVertexLayout::SOURCE_CONSTANT;
+                    attribute.m_Value  = (const float*) info.m_ValuePtr;
+                    break;
+            }
+        }
+        return true;
+    }
+
+    static inline bool CanUseSpriteVertexLayout(const SpriteVertexLayout* layout, float** uv_channels, float** pi_channels, uint32_t channel_count)
+    {
+        if (layout == 0x0 || layout->m_TexCoordChannelCount > channel_count || layout->m_PageIndexChannelCount > channel_count)
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < layout->m_TexCoordChannelCount; ++i)
+        {
+            if (uv_channels[i] == 0x0)
+                return false;
+        }
+        for (uint32_t i = 0; i < layout->m_PageIndexChannelCount; ++i)
+        {
+            if (pi_channels[i] == 0x0)
+                return false;
+        }
+        return true;
+    }
+
+    // Produces the same output as dmGraphics::WriteAttributes for a layout where GetSpriteVertexLayout succeeded
+    static inline uint8_t* WriteSpriteVertex(uint8_t* write_ptr, const SpriteVertexLayout* layout, uint32_t vertex_index, const Vector4& position_world, float** uv_channels, float** pi_channels)
+    {
+        float* out = (float*) write_ptr;
+        for (uint32_t i = 0; i < layout->m_AttributeCount; ++i)
+        {
+            const SpriteVertexLayout::Attribute& attribute = layout->m_Attributes[i];
+            const float* src = 0;
+            switch (attribute.m_Source)
+            {
+                case SpriteVertexLayout::SOURCE_POSITION_WORLD: src = (const float*) &position_world; break;
+                case SpriteVertexLayout::SOURCE_TEXCOORD:       src = uv_channels[attribute.m_Channel] + vertex_index * 2; break;
+                case SpriteVertexLayout::SOURCE_PAGE_INDEX:     src = pi_channels[attribute.m_Channel]; break;
+                default:                                        src = attribute.m_Value; break;
+            }
+            for (uint32_t e = 0; e < attribute.m_ElementCount; ++e)
+            {
+                out[e] = src[e];
+            }
+            out += attribute.m_ElementCount;
+        }
+        return (uint8_t*) out;
+    }
+
     static void CreateVertexDataSlice9(
         uint8_t* vertices,
         uint8_t* indices,
@@ -728,7 +996,8 @@ namespace dmGameSystem
         dmArray<dmVMath::Vector4>* scratch_positions_local,
         bool flip_u,
         bool flip_v,
-        dmGraphics::VertexAttributeInfos* sprite_infos)
+        dmGraphics::VertexAttributeInfos* sprite_infos,
+        const SpriteVertexLayout* sprite_layout)
     {
         // render 9-sliced node
         //   0 1     2 3
@@ -870,23 +1139,47 @@ namespace dmGameSystem
         uint32_t sp_width = sprite_size.getX();
         uint32_t sp_height = sprite_size.getY();
         uint32_t vertex_index = 0;
-        for (int y=0; y<4; y++)
+
+        if (CanUseSpriteVertexLayout(sprite_layout, scratch_uv_ptrs, scratch_pi_ptrs, uv_channels_count))
         {
-            for (int x=0; x<4; x++)
+            // The grid is planar, so each vertex is a sum of one scaled x and y axis of the world matrix
+            Vector4 world_xs[4], world_ys[4];
+            for (int i = 0; i < 4; i++)
             {
-                Point3 p = Point3(xs[x] - 0.5, ys[y] - 0.5, 0);
+                world_xs[i] = world_matrix.getCol0() * (float) (xs[i] - 0.5);
+                world_ys[i] = world_matrix.getCol1() * (float) (ys[i] - 0.5);
+            }
+            const Vector4 translation = world_matrix.getCol3();
 
-                if (has_local_position_attribute)
+            for (int y=0; y<4; y++)
+            {
+                for (int x=0; x<4; x++)
                 {
-                    (*scratch_positions_local)[vertex_index] = Vector4(
-                        p.getX() * sp_width,
-                        p.getY() * sp_height,
-                        0.0f, 1.0f);
+                    Vector4 p = world_xs[x] + world_ys[y] + translation;
+                    vertices = WriteSpriteVertex(vertices, sprite_layout, vertex_index++, p, scratch_uv_ptrs, scratch_pi_ptrs);
                 }
+            }
+        }
+        else
+        {
+            for (int y=0; y<4; y++)
+            {
+                for (int x=0; x<4; x++)
+                {
+                    Point3 p = Point3(xs[x] - 0.5, ys[y] - 0.5, 0);
 
-                (*scratch_positions_world)[vertex_index] = world_matrix * p;
+                    if (has_local_position_attribute)
+                    {
+                        (*scratch_positions_local)[vertex_index] = Vector4(
+                            p.getX() * sp_width,
+                            p.getY() * sp_height,
+                            0.0f, 1.0f);
+                    }
+
+                    (*scratch_positions_world)[vertex_index] = world_matrix * p;
 
-                vertices = dmGraphics::WriteAttributes(vertices, vertex_index++, params);
+                    vertices = dmGraphics::WriteAttributes(vertices, vertex_index++, params);
+                }
             }
         }
 
@@ -1153,47 +1446,181 @@ namespace dmGameSystem
         }
     }
 
-    static void CreateVertexData(SpriteWorld* sprite_world, dmGraphics::VertexAttributeInfos* material_attribute_info, bool has_local_position_attribute, uint8_t** vb_where, uint8_t** ib_where, dmRender::RenderListEntry* buf, uint32_t* begin, uint32_t* end)
+    static void GetVertexAndIndexCount(TexturesData* textures, const SpriteComponent* component, uint32_t* vertex_count, uint32_t* index_count);
+
+    static void MakeVertexCacheKey(const SpriteComponent* component, const TexturesData* textures, uint32_t vertex_stride, SpriteVertexCacheKey* key)
     {
-        DM_PROFILE("CreateVertexData");
+        // Cleared, since the keys are compared with memcmp
+        memset(key, 0, sizeof(*key));
+        key->m_World        = component->m_World;
+        key->m_Slice9       = component->m_Slice9;
+        key->m_Size         = component->m_Size;
+        key->m_Animation    = component->m_CurrentAnimation;
+        key->m_NumTextures  = textures->m_NumTextures;
+        for (uint32_t i = 0; i < textures->m_NumTextures; ++i)
+        {
+            key->m_TextureSets[i] = textures->m_TextureSets[i];
+        }
+        key->m_Frame        = component->m_CurrentAnimationFrame;
+        key->m_VertexStride = vertex_stride;
+        key->m_Flags        = component->m_FlipHorizontal | (component->m_FlipVertical << 1) | (component->m_UseSlice9 << 2);
+    }
+
+    static inline bool IsVertexCacheValid(const SpriteComponent* component, const SpriteVertexCacheKey& key)
+    {
+        const SpriteVertexCache* cache = component->m_VertexCache;
+        return cache && cache->m_Valid && !component->m_VerticesDirty && memcmp(&cache->m_Key, &key, sizeof(key)) == 0;
+    }
+
+    static void WriteCachedVertices(const SpriteVertexCache* cache, uint32_t vertex_offset, bool is_16_bit_index, uint8_t* vertices, uint8_t* indices)
+    {
+        memcpy(vertices, cache->m_Data, cache->m_VertexDataSize);
+
+        const uint32_t* relative_indices = (const uint32_t*) (cache->m_Data + cache->m_VertexDataSize);
+        if (is_16_bit_index)
+        {
+            for (uint32_t i = 0; i < cache->m_IndexCount; ++i)
+            {
+                ((uint16_t*) indices)[i] = vertex_offset + relative_indices[i];
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < cache->m_IndexCount; ++i)
+            {
+                ((uint32_t*) indices)[i] = vertex_offset + relative_indices[i];
+            }
+        }
+    }
+
+    // Called before the vertices of a sprite are generated. Sprites that change every frame (e.g. moving sprites) would
+    // only pay for the copy, so the vertices are only kept once the sprite is unchanged since it was last generated.
+    // Returns true if the vertices should be generated into the cache.
+    static bool BeginVertexCache(SpriteComponent* component, const SpriteVertexCacheKey& key)
+    {
+        SpriteVertexCache* cache = component->m_VertexCache;
+        if (cache == 0x0)
+        {
+            cache = new SpriteVertexCache;
+            memset(cache, 0, sizeof(*cache));
+            component->m_VertexCache = cache;
+        }
 
+        bool unchanged = !component->m_VerticesDirty && memcmp(&cache->m_Key, &key, sizeof(key)) == 0;
+        cache->m_Key   = key;
+        cache->m_Valid = 0;
+        component->m_VerticesDirty = 0;
+        return unchanged;
+    }
+
+    static void ReserveVertexCache(SpriteVertexCache* cache, uint32_t vertex_data_size, uint32_t index_count)
+    {
+        uint32_t data_size = vertex_data_size + index_count * sizeof(uint32_t);
+        if (cache->m_DataCapacity < data_size)
+        {
+            cache->m_Data         = (uint8_t*) realloc(cache->m_Data, data_size);
+            cache->m_DataCapacity = data_size;
+        }
+    }
+
+    // Called after the vertices of a sprite were generated into the cache, with the indices relative to the first
+    // vertex and in the index type of the world. The indices are widened to uint32_t in place.
+    static void EndVertexCache(SpriteVertexCache* cache, uint32_t vertex_data_size, uint32_t index_count, bool is_16_bit_index)
+    {
+        if (is_16_bit_index)
+        {
+            // Backwards, so that no index is overwritten before it is read
+            const uint16_t* indices_16 = (const uint16_t*) (cache->m_Data + vertex_data_size);
+            uint32_t* indices_32       = (uint32_t*) (cache->m_Data + vertex_data_size);
+            for (uint32_t i = index_count; i > 0; --i)
+            {
+                indices_32[i - 1] = indices_16[i - 1];
+            }
+        }
+
+        cache->m_VertexDataSize = vertex_data_size;
+        cache->m_IndexCount     = index_count;
+        cache->m_Valid          = 1;
+    }
+
+    // Writes the vertices and indices for a range of sprites in a batch.
+    // Returns the vertex offset after the last written vertex
+    static uint32_t CreateVertexDataRange(SpriteWorld* sprite_world, SpriteVertexScratch* scratch, const TexturesData* batch_textures, dmGraphics::VertexAttributeInfos* material_attribute_info, bool has_local_position_attribute,
+                                            uint32_t vertex_offset, uint8_t** vb_where, uint8_t** ib_where, dmRender::RenderListEntry* buf, uint32_t* begin, uint32_t* end)
+    {
         uint8_t* vertices        = *vb_where;
         uint8_t* indices         = *ib_where;
         uint32_t index_type_size = sprite_world->m_Is16BitIndex ? sizeof(uint16_t) : sizeof(uint32_t);
 
-        const dmArray<SpriteComponent>& components = sprite_world->m_Components.GetRawObjects();
+        dmArray<SpriteComponent>& components = sprite_world->m_Components.GetRawObjects();
 
-        // The offset for the indices
-        uint32_t vertex_offset = sprite_world->m_VerticesWritten;
         uint32_t vertex_stride = material_attribute_info->m_VertexStride;
 
-        uint32_t component_index = (uint32_t)buf[*begin].m_UserData;
-        const SpriteComponent* first = (const SpriteComponent*) &sprite_world->m_Components.GetRawObjects()[component_index];
-
         // The list of pointers to the scratch uvs and page indices
         float* scratch_uv_ptrs[MAX_TEXTURE_COUNT] = {};
         float* scratch_pi_ptrs[MAX_TEXTURE_COUNT] = {};
 
-        TexturesData textures = {};
-        textures.m_NumTextures = GetNumTextures(first);
-        for (uint32_t i = 0; i < textures.m_NumTextures; ++i)
-        {
-            textures.m_Resources[i] = GetTextureSetByIndex(first, i);
-            textures.m_TextureSets[i] = textures.m_Resources[i]->m_TextureSet;
-        }
+        // The animation data is resolved per sprite, so we need our own copy
+        TexturesData textures = *batch_textures;
 
         dmGraphics::VertexAttributeInfos sprite_attribute_info = {};
         dmGraphics::WriteAttributeParams write_params = {};
 
+        SpriteVertexLayout material_layout;
+        SpriteVertexLayout sprite_layout;
+        bool material_layout_valid = !has_local_position_attribute && GetSpriteVertexLayout(material_attribute_info, &material_layout);
+
         for (uint32_t* i = begin; i != end; ++i)
         {
-            uint32_t component_index         = (uint32_t)buf[*i].m_UserData;
-            const SpriteComponent* component = (const SpriteComponent*) &components[component_index];
-            const Matrix4& world_matrix      = component->m_World;
+            uint32_t component_index    = (uint32_t)buf[*i].m_UserData;
+            SpriteComponent* component  = &components[component_index];
+            const Matrix4& world_matrix = component->m_World;
 
             float sp_width  = component->m_Size.getX();
             float sp_height = component->m_Size.getY();
 
+            // We need to pad the buffer if the vertex stride doesn't start at an even byte offset from the start
+            const uint32_t vb_buffer_offset = vertices - sprite_world->m_VertexBufferBase;
+            vertex_offset = vb_buffer_offset / vertex_stride;
+
+            if (vb_buffer_offset % vertex_stride != 0)
+            {
+                vertices      += vertex_stride - vb_buffer_offset % vertex_stride;
+                vertex_offset += 1;
+            }
+
+            SpriteVertexCacheKey cache_key;
+            MakeVertexCacheKey(component, &textures, vertex_stride, &cache_key);
+            if (IsVertexCacheValid(component, cache_key))
+            {
+                const SpriteVertexCache* cache = component->m_VertexCache;
+                WriteCachedVertices(cache, vertex_offset, sprite_world->m_Is16BitIndex, vertices, indices);
+                vertices      += cache->m_VertexDataSize;
+                indices       += cache->m_IndexCount * index_type_size;
+                vertex_offset += cache->m_VertexDataSize / vertex_stride;
+                continue;
+            }
+
+            // The vertex and index buffers may be write-only (mapped) memory, so the vertices that are kept are
+            // generated into the cache first, and then copied to the buffers
+            uint8_t* sprite_vertices       = vertices;
+            uint8_t* sprite_indices        = indices;
+            uint32_t sprite_vertex_offset  = vertex_offset;
+            SpriteVertexCache* cache       = BeginVertexCache(component, cache_key) ? component->m_VertexCache : 0x0;
+            uint32_t cache_vertex_data_size = 0;
+            if (cache)
+            {
+                uint32_t cache_vertex_count, cache_index_count;
+                GetVertexAndIndexCount(&textures, component, &cache_vertex_count, &cache_index_count);
+                cache_vertex_data_size = cache_vertex_count * vertex_stride;
+                ReserveVertexCache(cache, cache_vertex_data_size, cache_index_count);
+                vertices      = cache->m_Data;
+                indices       = cache->m_Data + cache_vertex_data_size;
+                vertex_offset = 0;
+            }
+            uint8_t* generated_vertices = vertices;
+            uint8_t* generated_indices  = indices;
+
             // Get the correct animation frames, and other meta data
             ResolveAnimationData(&textures, component->m_CurrentAnimation, component->m_CurrentAnimationFrame);
 
@@ -1211,14 +1638,14 @@ namespace dmGameSystem
                 sprite_attribute_info_ptr = &sprite_attribute_info;
             }
 
-            // We need to pad the buffer if the vertex stride doesn't start at an even byte offset from the start
-            const uint32_t vb_buffer_offset = vertices - sprite_world->m_VertexBufferData;
-            vertex_offset = vb_buffer_offset / vertex_stride;
-
-            if (vb_buffer_offset % vertex_stride != 0)
+            const SpriteVertexLayout* layout = 0;
+            if (sprite_attribute_info_ptr == material_attribute_info)
             {
-                vertices      += vertex_stride - vb_buffer_offset % vertex_stride;
-                vertex_offset += 1;
+                layout = material_layout_valid ? &material_layout : 0;
+            }
+            else if (!has_local_position_attribute && GetSpriteVertexLayout(sprite_attribute_info_ptr, &sprite_layout))
+            {
+                layout = &sprite_layout;
             }
 
             // if num_texture == 0, then we don't have a texture set to get any vertex/uv coordinates from
@@ -1235,16 +1662,16 @@ namespace dmGameSystem
                 // to respect face winding (and backface culling)
                 int reverse = flipx ^ flipy;
 
-                ResolvePositionAndUVDataFromGeometry(&textures, sprite_world->m_ScratchPositionWorld, sprite_world->m_ScratchUVs, scratch_uv_ptrs, scratch_pi_ptrs, scaleX, scaleY, reverse);
+                ResolvePositionAndUVDataFromGeometry(&textures, scratch->m_PositionWorld, scratch->m_UVs, scratch_uv_ptrs, scratch_pi_ptrs, scaleX, scaleY, reverse);
 
                 if (has_local_position_attribute)
                 {
-                    EnsureSize(sprite_world->m_ScratchPositionLocal, sprite_world->m_ScratchPositionWorld.Size());
+                    EnsureSize(scratch->m_PositionLocal, scratch->m_PositionWorld.Size());
                 }
 
                 const float* world_matrix_channel[]    = { (float*) &world_matrix };
-                const float* world_position_channels[] = { (float*) sprite_world->m_ScratchPositionWorld.Begin() };
-                const float* local_position_channels[] = { (float*) sprite_world->m_ScratchPositionLocal.Begin() };
+                const float* world_position_channels[] = { (float*) scratch->m_PositionWorld.Begin() };
+                const float* local_position_channels[] = { (float*) scratch->m_PositionLocal.Begin() };
 
                 FillWriteVertexAttributeParams(&write_params, sprite_attribute_info_ptr,
                     world_matrix_channel,
@@ -1255,18 +1682,18 @@ namespace dmGameSystem
                     (const float**) scratch_pi_ptrs,
                     textures.m_NumTextures);
 
-                uint32_t num_vertices = sprite_world->m_ScratchPositionWorld.Size();
+                uint32_t num_vertices = scratch->m_PositionWorld.Size();
                 for (uint32_t vertex_index = 0; vertex_index < num_vertices; ++vertex_index)
                 {
                     if (has_local_position_attribute)
                     {
-                        sprite_world->m_ScratchPositionLocal[vertex_index] = Vector4(
-                            sprite_world->m_ScratchPositionWorld[vertex_index].getX() * sp_width,
-                            sprite_world->m_ScratchPositionWorld[vertex_index].getY() * sp_height,
+                        scratch->m_PositionLocal[vertex_index] = Vector4(
+                            scratch->m_PositionWorld[vertex_index].getX() * sp_width,
+                            scratch->m_PositionWorld[vertex_index].getY() * sp_height,
                             0.0f, 1.0f);
                     }
 
-                    sprite_world->m_ScratchPositionWorld[vertex_index] = world_matrix * sprite_world->m_ScratchPositionWorld[vertex_index];
+                    scratch->m_PositionWorld[vertex_index] = world_matrix * scratch->m_PositionWorld[vertex_index];
                     vertices = dmGraphics::WriteAttributes(vertices, vertex_index, write_params);
                 }
 
@@ -1314,9 +1741,9 @@ namespace dmGameSystem
                     int flipy = component->m_FlipVertical;
                     CreateVertexDataSlice9(vertices, indices, sprite_world->m_Is16BitIndex, has_local_position_attribute,
                         world_matrix, component->m_Size, component->m_Slice9, vertex_offset, vertex_stride,
-                        &textures, sprite_world->m_ScratchUVs, scratch_uv_ptrs, scratch_pi_ptrs,
-                        &sprite_world->m_ScratchPositionWorld, &sprite_world->m_ScratchPositionLocal,
-                        flipx, flipy, sprite_attribute_info_ptr);
+                        &textures, scratch->m_UVs, scratch_uv_ptrs, scratch_pi_ptrs,
+                        &scratch->m_PositionWorld, &scratch->m_PositionLocal,
+                        flipx, flipy, sprite_attribute_info_ptr, layout);
 
                     indices       += index_type_size * SPRITE_INDEX_COUNT_SLICE9;
                     vertices      += SPRITE_VERTEX_COUNT_SLICE9 * vertex_stride;
@@ -1329,13 +1756,17 @@ namespace dmGameSystem
                     //    Thus we can use the corresponding quad for each image
                     // B) The first image is a quad, and any remapping
                     //    for any subsequent geometry would yield a wuad anyways.
-                    ResolveUVDataFromQuads(&textures, sprite_world->m_ScratchUVs, scratch_uv_ptrs, scratch_pi_ptrs, component->m_FlipHorizontal, component->m_FlipVertical);
+                    ResolveUVDataFromQuads(&textures, scratch->m_UVs, scratch_uv_ptrs, scratch_pi_ptrs, component->m_FlipHorizontal, component->m_FlipVertical);
 
+                    // The corners are +-0.5 along the x and y axis of the world matrix
+                    const Vector4 half_x      = world_matrix.getCol0() * 0.5f;
+                    const Vector4 half_y      = world_matrix.getCol1() * 0.5f;
+                    const Vector4 translation = world_matrix.getCol3();
                     Vector4 positions_world[] = {
-                        world_matrix * Point3(-0.5f, -0.5f, 0.0f),
-                        world_matrix * Point3(-0.5f,  0.5f, 0.0f),
-                        world_matrix * Point3( 0.5f,  0.5f, 0.0f),
-                        world_matrix * Point3( 0.5f, -0.5f, 0.0f)};
+                        (-half_x - half_y) + translation,
+                        (-half_x + half_y) + translation,
+                        ( half_x + half_y) + translation,
+                        ( half_x - half_y) + translation};
 
                     Vector4 positions_local[4];
                     if (has_local_position_attribute)
@@ -1360,10 +1791,20 @@ namespace dmGameSystem
                         (const float**) scratch_pi_ptrs,
                         textures.m_NumTextures);
 
-                    vertices = dmGraphics::WriteAttributes(vertices, 0, write_params);
-                    vertices = dmGraphics::WriteAttributes(vertices, 1, write_params);
-                    vertices = dmGraphics::WriteAttributes(vertices, 2, write_params);
-                    vertices = dmGraphics::WriteAttributes(vertices, 3, write_params);
+                    if (CanUseSpriteVertexLayout(layout, scratch_uv_ptrs, scratch_pi_ptrs, textures.m_NumTextures))
+                    {
+                        vertices = WriteSpriteVertex(vertices, layout, 0, positions_world[0], scratch_uv_ptrs, scratch_pi_ptrs);
+                        vertices = WriteSpriteVertex(vertices, layout, 1, positions_world[1], scratch_uv_ptrs, scratch_pi_ptrs);
+                        vertices = WriteSpriteVertex(vertices, layout, 2, positions_world[2], scratch_uv_ptrs, scratch_pi_ptrs);
+                        vertices = WriteSpriteVertex(vertices, layout, 3, positions_world[3], scratch_uv_ptrs, scratch_pi_ptrs);
+                    }
+                    else
+                    {
+                        vertices = dmGraphics::WriteAttributes(vertices, 0, write_params);
+                        vertices = dmGraphics::WriteAttributes(vertices, 1, write_params);
+                        vertices = dmGraphics::WriteAttributes(vertices, 2, write_params);
+                        vertices = dmGraphics::WriteAttributes(vertices, 3, write_params);
+                    }
 
                 #if 0
                     for (int f = 0; f < 4; ++f)
@@ -1394,12 +1835,332 @@ namespace dmGameSystem
                     indices       += SPRITE_INDEX_COUNT_LEGACY * index_type_size;
                 }
             }
+
+            if (cache)
+            {
+                assert((uint32_t) (vertices - generated_vertices) == cache_vertex_data_size);
+                EndVertexCache(cache, vertices - generated_vertices, (indices - generated_indices) / index_type_size, sprite_world->m_Is16BitIndex);
+                WriteCachedVertices(cache, sprite_vertex_offset, sprite_world->m_Is16BitIndex, sprite_vertices, sprite_indices);
+                vertices      = sprite_vertices + cache->m_VertexDataSize;
+                indices       = sprite_indices + cache->m_IndexCount * index_type_size;
+                vertex_offset = sprite_vertex_offset + cache->m_VertexDataSize / vertex_stride;
+            }
+        }
+
+        *vb_where = vertices;
+        *ib_where = indices;
+        return vertex_offset;
+    }
+
+    static void GetVertexAndIndexCount(TexturesData* textures, const SpriteComponent* component, uint32_t* vertex_count, uint32_t* index_count)
+    {
+        if (textures->m_NumTextures != 0)
+        {
+            ResolveAnimationData(textures, component->m_CurrentAnimation, component->m_CurrentAnimationFrame);
+            if (!CanUseQuads(textures))
+            {
+                const dmGameSystemDDF::SpriteGeometry* geometry = textures->m_Geometries[0];
+                *vertex_count = geometry->m_Vertices.m_Count / 2;
+                *index_count  = geometry->m_Indices.m_Count;
+                return;
+            }
+        }
+
+        if (component->m_UseSlice9)
+        {
+            *vertex_count = SPRITE_VERTEX_COUNT_SLICE9;
+            *index_count  = SPRITE_INDEX_COUNT_SLICE9;
+        }
+        else
+        {
+            *vertex_count = SPRITE_VERTEX_COUNT_LEGACY;
+            *index_count  = SPRITE_INDEX_COUNT_LEGACY;
+        }
+    }
+
+    struct SpriteVertexChunk
+    {
+        uint32_t*   m_Begin;
+        uint32_t*   m_End;
+        uint8_t*    m_Vertices;
+        uint8_t*    m_Indices;
+        uint32_t    m_VertexOffset;
+    };
+
+    struct SpriteVertexJobContext
+    {
+        SpriteWorld*                        m_World;
+        const TexturesData*                 m_Textures;
+        dmGraphics::VertexAttributeInfos*   m_MaterialAttributeInfo;
+        dmRender::RenderListEntry*          m_Buf;
+        SpriteVertexChunk                   m_Chunks[SPRITE_MAX_VERTEX_JOBS];
+        bool                                m_HasLocalPositionAttribute;
+    };
+
+    static void CreateVertexDataChunks(void* _ctx, uint32_t begin, uint32_t end)
+    {
+        DM_PROFILE("CreateVertexDataChunk");
+        SpriteVertexJobContext* ctx = (SpriteVertexJobContext*)_ctx;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            SpriteVertexChunk& chunk = ctx->m_Chunks[i];
+            CreateVertexDataRange(ctx->m_World, &ctx->m_World->m_VertexScratch[i], ctx->m_Textures, ctx->m_MaterialAttributeInfo, ctx->m_HasLocalPositionAttribute,
+                                    chunk.m_VertexOffset, &chunk.m_Vertices, &chunk.m_Indices, ctx->m_Buf, chunk.m_Begin, chunk.m_End);
+        }
+    }
+
+    static void CreateVertexData(SpriteWorld* sprite_world, dmGraphics::VertexAttributeInfos* material_attribute_info, bool has_local_position_attribute, uint8_t** vb_where, uint8_t** ib_where, dmRender::RenderListEntry* buf, uint32_t* begin, uint32_t* end)
+    {
+        DM_PROFILE("CreateVertexData");
+
+        const dmArray<SpriteComponent>& components = sprite_world->m_Components.GetRawObjects();
+
+        uint32_t component_index = (uint32_t)buf[*begin].m_UserData;
+        const SpriteComponent* first = (const SpriteComponent*) &components[component_index];
+
+        TexturesData textures = {};
+        textures.m_NumTextures = GetNumTextures(first);
+        ResolveTextureSets(&textures, first);
+
+        uint32_t count = end - begin;
+        uint32_t worker_count = sprite_world->m_JobThread ? dmJobThread::GetWorkerCount(sprite_world->m_JobThread) : 0;
+        if (worker_count == 0 || count < SPRITE_PARALLEL_VERTEX_THRESHOLD)
+        {
+            sprite_world->m_VerticesWritten = CreateVertexDataRange(sprite_world, &sprite_world->m_VertexScratch[0], &textures, material_attribute_info, has_local_position_attribute,
+                                                                    sprite_world->m_VerticesWritten, vb_where, ib_where, buf, begin, end);
+            return;
+        }
+
+        // We need to pad the buffer if the vertex stride doesn't start at an even byte offset from the start
+        uint8_t* vertices        = *vb_where;
+        uint8_t* indices         = *ib_where;
+        uint32_t vertex_stride   = material_attribute_info->m_VertexStride;
+        uint32_t index_type_size = sprite_world->m_Is16BitIndex ? sizeof(uint16_t) : sizeof(uint32_t);
+        uint32_t vb_buffer_offset = vertices - sprite_world->m_VertexBufferBase;
+        if (vb_buffer_offset % vertex_stride != 0)
+        {
+            vertices += vertex_stride - vb_buffer_offset % vertex_stride;
+        }
+
+        // Split the batch into chunks, and calculate where in the buffers each chunk starts writing
+        SpriteVertexJobContext ctx;
+        ctx.m_World                     = sprite_world;
+        ctx.m_Textures                  = &textures;
+        ctx.m_MaterialAttributeInfo     = material_attribute_info;
+        ctx.m_Buf                       = buf;
+        ctx.m_HasLocalPositionAttribute = has_local_position_attribute;
+
+        uint32_t chunk_count = dmMath::Min(worker_count + 1, SPRITE_MAX_VERTEX_JOBS);
+        uint32_t chunk_size = (count + chunk_count - 1) / chunk_count;
+
+        TexturesData count_textures = textures;
+        uint32_t num_chunks = 0;
+        uint32_t* iter = begin;
+        while (iter != end)
+        {
+            SpriteVertexChunk& chunk = ctx.m_Chunks[num_chunks++];
+            chunk.m_Begin        = iter;
+            chunk.m_End          = iter + dmMath::Min(chunk_size, (uint32_t)(end - iter));
+            chunk.m_Vertices     = vertices;
+            chunk.m_Indices      = indices;
+            chunk.m_VertexOffset = (vertices - sprite_world->m_VertexBufferBase) / vertex_stride;
+
+            for (; iter != chunk.m_End; ++iter)
+            {
+                const SpriteComponent* component = &components[(uint32_t)buf[*iter].m_UserData];
+                uint32_t vertex_count, index_count;
+                GetVertexAndIndexCount(&count_textures, component, &vertex_count, &index_count);
+                vertices += vertex_count * vertex_stride;
+                indices  += index_count * index_type_size;
+            }
+        }
+
+        dmJobThread::ParallelFor(sprite_world->m_JobThread, num_chunks, 1, CreateVertexDataChunks, &ctx);
+
+        sprite_world->m_VerticesWritten = (vertices - sprite_world->m_VertexBufferBase) / vertex_stride;
+
+        *vb_where = vertices;
+        *ib_where = indices;
+    }
+
+    // The color of the sprite is the value of the first color attribute of the material, as the vertex path writes it.
+    // It's written to the per instance color attributes, since the unit quad is shared by all sprites in the batch.
+    static Vector4 GetSpriteColor(const dmGraphics::VertexAttributeInfos* attribute_infos)
+    {
+        Vector4 color(1.0f);
+        for (uint32_t i = 0; i < attribute_infos->m_NumInfos; ++i)
+        {
+            const dmGraphics::VertexAttributeInfo& info = attribute_infos->m_Infos[i];
+            if (info.m_SemanticType != dmGraphics::VertexAttribute::SEMANTIC_TYPE_COLOR)
+                continue;
+
+            if (info.m_ValuePtr)
+            {
+                uint32_t element_count     = dmMath::Min(4U, dmGraphics::VectorTypeToElementCount(info.m_ValueVectorType));
+                uint32_t bytes_per_element = dmGraphics::GetTypeSize(dmGraphics::GetGraphicsType(info.m_DataType));
+                for (uint32_t e = 0; e < element_count; ++e)
+                {
+                    color.setElem(e, dmGraphics::VertexAttributeDataTypeToFloat(info.m_DataType, info.m_ValuePtr + e * bytes_per_element));
+                }
+            }
+            break;
         }
+        return color;
+    }
 
-        sprite_world->m_VerticesWritten = vertex_offset;
+    // Instanced sprites are drawn as one unit quad, and the sprites are expanded by the vertex shader from the
+    // per instance attributes of the material:
+    //  - The vertex attributes get the corners of the unit quad: positions in [-0.5, 0.5] and texture coordinates in [0, 1]
+    //  - The world matrix (which includes the sprite size) and the page indices are written per instance
+    //  - The texture coordinates are written per instance as the rectangle (u0, v0, u1, v1) of the current frame
+    //  - The color attributes are written per instance from the color of the sprite
+    // The render constants (e.g. "tint") are part of the batch key and are set on the render object, as in the vertex path.
+    // Sprite trimming, slice-9 and images that are rotated in the atlas aren't supported by the instanced path.
+    static void CreateInstanceData(SpriteWorld* sprite_world, dmRender::HMaterial material, dmGraphics::HVertexDeclaration inst_decl,
+                                    uint8_t** vb_where, uint8_t** ib_where, dmRender::RenderListEntry* buf, uint32_t* begin, uint32_t* end)
+    {
+        DM_PROFILE("CreateInstanceData");
+
+        const dmArray<SpriteComponent>& components = sprite_world->m_Components.GetRawObjects();
+        const SpriteComponent* first = &components[(uint32_t)buf[*begin].m_UserData];
+        SpriteVertexScratch* scratch = &sprite_world->m_VertexScratch[0];
 
+        TexturesData textures = {};
+        textures.m_NumTextures = GetNumTextures(first);
+        ResolveTextureSets(&textures, first);
+        uint32_t num_uv_channels = dmMath::Max(1U, textures.m_NumTextures);
+
+        dmGraphics::HVertexDeclaration vx_decl = dmRender::GetVertexDeclaration(material, dmGraphics::VERTEX_STEP_FUNCTION_VERTEX);
+        dmGraphics::VertexAttributeInfos material_attribute_info;
+        FillMaterialAttributeInfos(material, vx_decl, &material_attribute_info, dmGraphics::COORDINATE_SPACE_WORLD);
+
+        // The unit quad
+        uint8_t* vertices      = *vb_where;
+        uint32_t vertex_stride = dmGraphics::GetVertexDeclarationStride(vx_decl);
+        if (vertex_stride > 0)
+        {
+            uint32_t vb_buffer_offset = vertices - sprite_world->m_VertexBufferBase;
+            if (vb_buffer_offset % vertex_stride != 0)
+            {
+                vertices += vertex_stride - vb_buffer_offset % vertex_stride;
+            }
+        }
+        uint32_t vertex_offset = vertex_stride > 0 ? (vertices - sprite_world->m_VertexBufferBase) / vertex_stride : 0;
+
+        {
+            static const Vector4 positions[] = {
+                Vector4(-0.5f, -0.5f, 0.0f, 1.0f),
+                Vector4(-0.5f,  0.5f, 0.0f, 1.0f),
+                Vector4( 0.5f,  0.5f, 0.0f, 1.0f),
+                Vector4( 0.5f, -0.5f, 0.0f, 1.0f)};
+            static const float uvs[] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f };
+            static const float page_index = 0.0f;
+            const Matrix4 identity = Matrix4::identity();
+
+            const float* world_matrix_channel[] = { (float*) &identity };
+            const float* position_channels[]    = { (float*) positions };
+            const float* uv_channels[MAX_TEXTURE_COUNT];
+            const float* pi_channels[MAX_TEXTURE_COUNT];
+            for (uint32_t i = 0; i < num_uv_channels; ++i)
+            {
+                uv_channels[i] = uvs;
+                pi_channels[i] = &page_index;
+            }
+
+            dmGraphics::WriteAttributeParams write_params;
+            FillWriteVertexAttributeParams(&write_params, &material_attribute_info,
+                world_matrix_channel, position_channels, position_channels,
+                uv_channels, num_uv_channels, pi_channels, num_uv_channels);
+
+            for (uint32_t i = 0; i < SPRITE_VERTEX_COUNT_LEGACY; ++i)
+            {
+                vertices = dmGraphics::WriteAttributes(vertices, i, write_params);
+            }
+        }
+
+        uint8_t* indices = *ib_where;
+        static const uint32_t quad_indices[SPRITE_INDEX_COUNT_LEGACY] = { 0, 1, 2, 2, 3, 0 };
+        for (uint32_t i = 0; i < SPRITE_INDEX_COUNT_LEGACY; ++i)
+        {
+            if (sprite_world->m_Is16BitIndex)
+                ((uint16_t*)indices)[i] = vertex_offset + quad_indices[i];
+            else
+                ((uint32_t*)indices)[i] = vertex_offset + quad_indices[i];
+        }
+        indices += SPRITE_INDEX_COUNT_LEGACY * (sprite_world->m_Is16BitIndex ? sizeof(uint16_t) : sizeof(uint32_t));
+
+        sprite_world->m_VerticesWritten = vertex_offset + SPRITE_VERTEX_COUNT_LEGACY;
         *vb_where = vertices;
         *ib_where = indices;
+
+        // The instances
+        uint32_t instance_stride = dmGraphics::GetVertexDeclarationStride(inst_decl);
+        uint32_t required_memory = (end - begin) * instance_stride;
+        dmArray<uint8_t>& instance_data = sprite_world->m_InstanceBufferData;
+        if (instance_data.Remaining() < required_memory)
+        {
+            instance_data.OffsetCapacity(dmMath::Max(required_memory - instance_data.Remaining(), instance_data.Capacity()));
+        }
+        uint8_t* instance_write_ptr = instance_data.End();
+
+        dmGraphics::VertexAttributeInfos sprite_attribute_info = {};
+        dmGraphics::WriteAttributeParams write_params = {};
+        write_params.m_StepFunction = dmGraphics::VERTEX_STEP_FUNCTION_INSTANCE;
+
+        Vector4 uv_rects[MAX_TEXTURE_COUNT];
+        const float* uv_rect_channels[MAX_TEXTURE_COUNT];
+        float* scratch_uv_ptrs[MAX_TEXTURE_COUNT] = {};
+        float* scratch_pi_ptrs[MAX_TEXTURE_COUNT] = {};
+        for (uint32_t i = 0; i < num_uv_channels; ++i)
+        {
+            uv_rect_channels[i] = (float*) &uv_rects[i];
+            scratch_pi_ptrs[i]  = &textures.m_PageIndices[i];
+        }
+
+        Vector4 color;
+        const float* color_channel[] = { (float*) &color };
+
+        for (uint32_t* i = begin; i != end; ++i)
+        {
+            const SpriteComponent* component = &components[(uint32_t)buf[*i].m_UserData];
+
+            if (textures.m_NumTextures != 0)
+            {
+                ResolveAnimationData(&textures, component->m_CurrentAnimation, component->m_CurrentAnimationFrame);
+            }
+            ResolveUVDataFromQuads(&textures, scratch->m_UVs, scratch_uv_ptrs, scratch_pi_ptrs, component->m_FlipHorizontal, component->m_FlipVertical);
+
+            for (uint32_t t = 0; t < num_uv_channels; ++t)
+            {
+                const float* uvs = scratch->m_UVs[t].Begin();
+                uv_rects[t] = Vector4(uvs[0], uvs[1], uvs[4], uvs[5]);
+            }
+
+            dmGraphics::VertexAttributeInfos* sprite_attribute_info_ptr = &material_attribute_info;
+            if (component->m_Resource->m_DDF->m_Attributes.m_Count > 0 || component->m_DynamicVertexAttributeIndex != INVALID_DYNAMIC_ATTRIBUTE_INDEX)
+            {
+                FillAttributeInfos(&sprite_world->m_DynamicVertexAttributePool,
+                    component->m_DynamicVertexAttributeIndex,
+                    component->m_Resource->m_DDF->m_Attributes.m_Data,
+                    component->m_Resource->m_DDF->m_Attributes.m_Count,
+                    &material_attribute_info,
+                    &sprite_attribute_info);
+                sprite_attribute_info_ptr = &sprite_attribute_info;
+            }
+
+            color = GetSpriteColor(sprite_attribute_info_ptr);
+
+            const float* world_matrix_channel[] = { (float*) &component->m_World };
+            write_params.m_VertexAttributeInfos = sprite_attribute_info_ptr;
+            dmGraphics::SetWriteAttributeStreamDesc(&write_params.m_WorldMatrix, world_matrix_channel, dmGraphics::VertexAttribute::VECTOR_TYPE_MAT4, 1, true);
+            dmGraphics::SetWriteAttributeStreamDesc(&write_params.m_Colors, color_channel, dmGraphics::VertexAttribute::VECTOR_TYPE_VEC4, 1, true);
+            dmGraphics::SetWriteAttributeStreamDesc(&write_params.m_TexCoords, uv_rect_channels, dmGraphics::VertexAttribute::VECTOR_TYPE_VEC4, num_uv_channels, true);
+            dmGraphics::SetWriteAttributeStreamDesc(&write_params.m_PageIndices, (const float**) scratch_pi_ptrs, dmGraphics::VertexAttribute::VECTOR_TYPE_SCALAR, num_uv_channels, true);
+
+            instance_write_ptr = dmGraphics::WriteAttributes(instance_write_ptr, 0, write_params);
+        }
+
+        instance_data.SetSize(instance_write_ptr - instance_data.Begin());
     }
 
     static void RenderBatch(SpriteWorld* sprite_world, dmRender::HRenderContext render_context, dmRender::RenderListEntry *buf, uint32_t* begin, uint32_t* end)
@@ -1423,26 +2184,36 @@ namespace dmGameSystem
         }
 
         dmRender::RenderObject& ro = *sprite_world->m_RenderObjects[sprite_world->m_RenderObjectsInUse++];
-        dmRender::HMaterial material           = GetRenderMaterial(render_context, first);
-        dmGraphics::HVertexDeclaration vx_decl = dmRender::GetVertexDeclaration(material);
-
-        dmGraphics::VertexAttributeInfos material_attribute_info;
-        // Same default coordinate space as the editor
-        FillMaterialAttributeInfos(material, vx_decl, &material_attribute_info, dmGraphics::COORDINATE_SPACE_WORLD);
+        dmRender::HMaterial material             = GetRenderMaterial(render_context, first);
+        dmGraphics::HVertexDeclaration inst_decl = dmRender::GetVertexDeclaration(material, dmGraphics::VERTEX_STEP_FUNCTION_INSTANCE);
+        dmGraphics::HVertexDeclaration vx_decl   = inst_decl ? dmRender::GetVertexDeclaration(material, dmGraphics::VERTEX_STEP_FUNCTION_VERTEX) : dmRender::GetVertexDeclaration(material);
 
         // Fill in vertex buffer
         uint8_t* vb_begin = sprite_world->m_VertexBufferWritePtr;
         uint8_t* ib_begin = (uint8_t*)sprite_world->m_IndexBufferWritePtr;
         uint8_t* vb_iter  = vb_begin;
         uint8_t* ib_iter  = ib_begin;
+        uint32_t instance_offset = sprite_world->m_InstanceBufferData.Size();
 
-        dmGraphics::VertexAttributeInfoMetadata material_attribute_info_meta = dmGraphics::GetVertexAttributeInfosMetaData(material_attribute_info);
-        CreateVertexData(sprite_world, &material_attribute_info, material_attribute_info_meta.m_HasAttributeLocalPosition, &vb_iter, &ib_iter, buf, begin, end);
+        if (inst_decl)
+        {
+            CreateInstanceData(sprite_world, material, inst_decl, &vb_iter, &ib_iter, buf, begin, end);
+        }
+        else
+        {
+            dmGraphics::VertexAttributeInfos material_attribute_info;
+            // Same default coordinate space as the editor
+            FillMaterialAttributeInfos(material, vx_decl, &material_attribute_info, dmGraphics::COORDINATE_SPACE_WORLD);
+
+            dmGraphics::VertexAttributeInfoMetadata material_attribute_info_meta = dmGraphics::GetVertexAttributeInfosMetaData(material_attribute_info);
+            CreateVertexData(sprite_world, &material_attribute_info, material_attribute_info_meta.m_HasAttributeLocalPosition, &vb_iter, &ib_iter, buf, begin, end);
+        }
 
         sprite_world->m_VertexBufferWritePtr = vb_iter;
         sprite_world->m_IndexBufferWritePtr = ib_iter;
 
-        if (dmRender::GetBufferIndex(render_context, sprite_world->m_VertexBuffer) < sprite_world->m_DispatchCount)
+        bool dynamic_vertices = IsWritingDynamicVertices(sprite_world);
+        if (!dynamic_vertices && dmRender::GetBufferIndex(render_context, sprite_world->m_VertexBuffer) < sprite_world->m_DispatchCount)
         {
             dmRender::AddRenderBuffer(render_context, sprite_world->m_VertexBuffer);
         }
@@ -1453,12 +2224,22 @@ namespace dmGameSystem
 
         ro.Init();
         ro.m_VertexDeclaration = vx_decl;
-        ro.m_VertexBuffer = (dmGraphics::HVertexBuffer) dmRender::GetBuffer(render_context, sprite_world->m_VertexBuffer);
+        if (dynamic_vertices)
+        {
+            ro.m_VertexBuffer           = dmGraphics::GetDynamicVertexBufferHandle(sprite_world->m_DynamicVertexBuffer);
+            ro.m_VertexBufferOffsets[0] = sprite_world->m_DynamicVertexOffset;
+        }
+        else
+        {
+            ro.m_VertexBuffer = (dmGraphics::HVertexBuffer) dmRender::GetBuffer(render_context, sprite_world->m_VertexBuffer);
+        }
         ro.m_IndexBuffer = (dmGraphics::HIndexBuffer) dmRender::GetBuffer(render_context, sprite_world->m_IndexBuffer);
         ro.m_Material = GetComponentMaterial(first);
         for(uint32_t i = 0; i < resource->m_NumTextures; ++i)
         {
-            ro.m_Textures[i] = GetMaterialTexture(first, i);
+            TextureResource* texture = GetTextureResource(first, i);
+            ReportTextureFullSize(texture);
+            ro.m_Textures[i] = texture ? texture->m_Texture : 0;
         }
 
         ro.m_PrimitiveType = dmGraphics::PRIMITIVE_TRIANGLES;
@@ -1475,6 +2256,18 @@ namespace dmGameSystem
         ro.m_VertexStart = index_offset;
         ro.m_VertexCount = num_elements;
 
+        if (inst_decl)
+        {
+            if (dmRender::GetBufferIndex(render_context, sprite_world->m_InstanceBuffer) < sprite_world->m_InstanceDispatchCount)
+            {
+                dmRender::AddRenderBuffer(render_context, sprite_world->m_InstanceBuffer);
+            }
+            ro.m_VertexDeclarations[1]   = inst_decl;
+            ro.m_VertexBuffers[1]        = (dmGraphics::HVertexBuffer) dmRender::GetBuffer(render_context, sprite_world->m_InstanceBuffer);
+            ro.m_VertexBufferOffsets[1]  = instance_offset;
+            ro.m_InstanceCount           = end - begin;
+        }
+
         HComponentRenderConstants constants = GetRenderConstants(first);
         if (constants) {
             dmGameSystem::EnableRenderObjectConstants(&ro, constants);
@@ -1515,22 +2308,21 @@ namespace dmGameSystem
         dmRender::AddToRender(render_context, &ro);
     }
 
-    static void UpdateTransforms(SpriteWorld* sprite_world, bool sub_pixels)
+    struct SpriteTransformContext
     {
-        DM_PROFILE("UpdateTransforms");
+        SpriteWorld*    m_World;
+        bool            m_ScaleAlongZ;
+        bool            m_SubPixels;
+    };
 
+    static void UpdateTransformsRange(void* _ctx, uint32_t begin, uint32_t end)
+    {
+        SpriteTransformContext* ctx = (SpriteTransformContext*)_ctx;
+        SpriteWorld* sprite_world = ctx->m_World;
         dmArray<SpriteComponent>& components = sprite_world->m_Components.GetRawObjects();
-        uint32_t n = components.Size();
-
-        bool scale_along_z = false;
-        if (n > 0) {
-            SpriteComponent* c = &components[0];
-            scale_along_z = dmGameObject::ScaleAlongZ(dmGameObject::GetCollection(c->m_Instance));
-        }
-        // Note: We update all sprites, even though they might be disabled, or not added to update
 
-        if (scale_along_z) {
-            for (uint32_t i = 0; i < n; ++i)
+        if (ctx->m_ScaleAlongZ) {
+            for (uint32_t i = begin; i < end; ++i)
             {
                 SpriteComponent* c = &components[i];
                 Matrix4 local = dmTransform::ToMatrix4(dmTransform::Transform(c->m_Position, c->m_Rotation, 1.0f));
@@ -1544,7 +2336,7 @@ namespace dmGameSystem
             }
         } else
         {
-            for (uint32_t i = 0; i < n; ++i)
+            for (uint32_t i = begin; i < end; ++i)
             {
                 SpriteComponent* c = &components[i];
                 Matrix4 local = dmTransform::ToMatrix4(dmTransform::Transform(c->m_Position, c->m_Rotation, 1.0f));
@@ -1560,8 +2352,8 @@ namespace dmGameSystem
         }
 
         // The "sub_pixels" is set by default
-        if (!sub_pixels) {
-            for (uint32_t i = 0; i < n; ++i) {
+        if (!ctx->m_SubPixels) {
+            for (uint32_t i = begin; i < end; ++i) {
                 SpriteComponent* c = &components[i];
                 Vector4 position = c->m_World.getCol3();
                 position.setX((int) position.getX());
@@ -1571,6 +2363,50 @@ namespace dmGameSystem
         }
     }
 
+    static void UpdateTransforms(SpriteWorld* sprite_world, bool sub_pixels)
+    {
+        DM_PROFILE("UpdateTransforms");
+
+        dmArray<SpriteComponent>& components = sprite_world->m_Components.GetRawObjects();
+        uint32_t n = components.Size();
+
+        bool scale_along_z = false;
+        if (n > 0) {
+            SpriteComponent* c = &components[0];
+            scale_along_z = dmGameObject::ScaleAlongZ(dmGameObject::GetCollection(c->m_Instance));
+        }
+        // Note: We update all sprites, even though they might be disabled, or not added to update
+
+        SpriteTransformContext ctx;
+        ctx.m_World = sprite_world;
+        ctx.m_ScaleAlongZ = scale_along_z;
+        ctx.m_SubPixels = sub_pixels;
+        dmJobThread::ParallelFor(sprite_world->m_JobThread, n, SPRITE_PARALLEL_GRAIN_SIZE, UpdateTransformsRange, &ctx);
+    }
+
+    // Moves the bounds in the spatial index along with the transforms, which only changes the tree
+    // for the sprites that moved outside of their enlarged bounds
+    static void UpdateSpatialIndex(SpriteWorld* sprite_world)
+    {
+        DM_PROFILE("UpdateSpatialIndex");
+
+        dmArray<SpriteComponent>& components = sprite_world->m_Components.GetRawObjects();
+        const float* radiuses = sprite_world->m_BoundingVolumes.Begin();
+        uint32_t n = components.Size();
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            SpriteComponent* c = &components[i];
+            Point3 center = Point3(c->m_World.getCol3().getXYZ());
+            float radius = sqrtf(radiuses[i]);
+            Vector3 extents(radius, radius, radius);
+
+            if (c->m_SpatialProxy == dmRender::INVALID_SPATIAL_PROXY)
+                c->m_SpatialProxy = dmRender::AddSpatialProxy(sprite_world->m_SpatialIndex, center - extents, center + extents);
+            else
+                dmRender::UpdateSpatialProxy(sprite_world->m_SpatialIndex, c->m_SpatialProxy, center - extents, center + extents);
+        }
+    }
+
     static bool GetSender(SpriteComponent* component, dmMessage::URL* out_sender)
     {
         dmMessage::URL sender;
@@ -1648,13 +2484,21 @@ namespace dmGameSystem
     }
 
 
-    static void Animate(SpriteWorld* sprite_world, float dt)
+    struct SpriteAnimateContext
     {
-        DM_PROFILE("Animate");
+        SpriteWorld*    m_World;
+        float           m_DT;
+        int32_atomic_t  m_Ticked; // If any sprite changed its frame
+    };
 
-        dmArray<SpriteComponent>& components = sprite_world->m_Components.GetRawObjects();
-        uint32_t n = components.Size();
-        for (uint32_t i = 0; i < n; ++i)
+    static void AnimateRange(void* _ctx, uint32_t begin, uint32_t end)
+    {
+        SpriteAnimateContext* ctx = (SpriteAnimateContext*)_ctx;
+        float dt = ctx->m_DT;
+
+        dmArray<SpriteComponent>& components = ctx->m_World->m_Components.GetRawObjects();
+        bool ticked = false;
+        for (uint32_t i = begin; i < end; ++i)
         {
             SpriteComponent* component = &components[i];
             // NOTE: texture_set = c->m_Resource might be NULL so it's essential to "continue" here
@@ -1689,8 +2533,24 @@ namespace dmGameSystem
             if (component->m_DoTick) {
                 component->m_DoTick = 0;
                 UpdateCurrentAnimationFrame(component);
+                ticked = true;
             }
         }
+        if (ticked)
+            dmAtomicStore32(&ctx->m_Ticked, 1);
+    }
+
+    // Returns true if any sprite changed its frame
+    static bool Animate(SpriteWorld* sprite_world, float dt)
+    {
+        DM_PROFILE("Animate");
+
+        SpriteAnimateContext ctx;
+        ctx.m_World = sprite_world;
+        ctx.m_DT = dt;
+        ctx.m_Ticked = 0;
+        dmJobThread::ParallelFor(sprite_world->m_JobThread, sprite_world->m_Components.GetRawObjects().Size(), SPRITE_PARALLEL_GRAIN_SIZE, AnimateRange, &ctx);
+        return dmAtomicGet32(&ctx.m_Ticked) != 0;
     }
 
     static void UpdateVertexAndIndexCount(SpriteWorld* sprite_world, dmRender::HRenderContext render_context)
@@ -1738,11 +2598,7 @@ namespace dmGameSystem
                 continue;
             }
 
-            for (uint32_t i = 0; i < textures.m_NumTextures; ++i)
-            {
-                textures.m_Resources[i] = GetTextureSetByIndex(component, i);
-                textures.m_TextureSets[i] = textures.m_Resources[i]->m_TextureSet;
-            }
+            ResolveTextureSets(&textures, component);
 
             // Get the correct animation frames, and other meta data
             ResolveAnimationData(&textures, component->m_CurrentAnimation, component->m_CurrentAnimationFrame);
@@ -1780,7 +2636,7 @@ namespace dmGameSystem
             }
         }
 
-        sprite_world->m_ReallocBuffers   = vertex_memsize > sprite_world->m_VertexMemorySize || num_indices > sprite_world->m_IndexCount;
+        sprite_world->m_ReallocBuffers   = vertex_memsize > sprite_world->m_VertexMemoryCapacity || num_indices > sprite_world->m_IndexCapacity || num_vertices > sprite_world->m_VertexCapacity;
         sprite_world->m_VertexCount      = num_vertices;
         sprite_world->m_IndexCount       = num_indices;
         sprite_world->m_VertexMemorySize = vertex_memsize;
@@ -1803,18 +2659,28 @@ namespace dmGameSystem
          */
 
         SpriteWorld* world = (SpriteWorld*)params.m_World;
-        Animate(world, params.m_UpdateContext->m_DT);
+        bool ticked = Animate(world, params.m_UpdateContext->m_DT);
 
         PostMessages(world);
 
         SpriteContext* sprite_context = (SpriteContext*)params.m_Context;
+        if (ticked)
+            dmRender::InvalidateRender(sprite_context->m_RenderContext);
         dmRender::TrimBuffer(sprite_context->m_RenderContext, world->m_VertexBuffer);
         dmRender::RewindBuffer(sprite_context->m_RenderContext, world->m_VertexBuffer);
+        if (world->m_DynamicVertexBuffer)
+        {
+            dmGraphics::BeginDynamicVertexBuffer(dmRender::GetGraphicsContext(sprite_context->m_RenderContext), world->m_DynamicVertexBuffer);
+        }
 
         dmRender::TrimBuffer(sprite_context->m_RenderContext, world->m_IndexBuffer);
         dmRender::RewindBuffer(sprite_context->m_RenderContext, world->m_IndexBuffer);
 
+        dmRender::TrimBuffer(sprite_context->m_RenderContext, world->m_InstanceBuffer);
+        dmRender::RewindBuffer(sprite_context->m_RenderContext, world->m_InstanceBuffer);
+
         world->m_DispatchCount = 0;
+        world->m_InstanceDispatchCount = 0;
 
         return dmGameObject::UPDATE_RESULT_OK;
     }
@@ -1824,17 +2690,16 @@ namespace dmGameSystem
         DM_PROFILE("Sprite");
 
         SpriteWorld* sprite_world = (SpriteWorld*)params.m_UserData;
-        const float* radiuses = sprite_world->m_BoundingVolumes.Begin();
+        const SpriteComponent* components = sprite_world->m_Components.GetRawObjects().Begin();
 
-        const dmIntersection::Frustum frustum = *params.m_Frustum;
+        // The spatial index is culled by the renderer before this is called (see RenderListSetSpatialIndex)
         uint32_t num_entries = params.m_NumEntries;
         for (uint32_t i = 0; i < num_entries; ++i)
         {
             dmRender::RenderListEntry* entry = &params.m_Entries[i];
 
-            float radius_sq = radiuses[entry->m_UserData];
-
-            bool intersect = dmIntersection::TestFrustumSphereSq(frustum, entry->m_WorldPosition, radius_sq);
+            uint32_t proxy = components[entry->m_UserData].m_SpatialProxy;
+            bool intersect = dmRender::IsSpatialProxyVisible(sprite_world->m_SpatialIndex, proxy);
             entry->m_Visibility = intersect ? dmRender::VISIBILITY_FULL : dmRender::VISIBILITY_NONE;
         }
     }
@@ -1846,21 +2711,42 @@ namespace dmGameSystem
         switch (params.m_Operation)
         {
             case dmRender::RENDER_LIST_OPERATION_BEGIN:
-                world->m_VertexBufferWritePtr = world->m_VertexBufferData;
+                world->m_VertexBufferBase = 0;
+                if (world->m_DynamicVertexBuffer)
+                {
+                    world->m_VertexBufferBase = (uint8_t*) dmGraphics::ReserveDynamicVertexData(dmRender::GetGraphicsContext(params.m_Context), world->m_DynamicVertexBuffer,
+                                                                                                   world->m_VertexMemorySize, &world->m_DynamicVertexOffset);
+                }
+                // Full for this frame, or not supported
+                if (!world->m_VertexBufferBase)
+                {
+                    world->m_VertexBufferBase = world->m_VertexBufferData;
+                }
+                world->m_VertexBufferWritePtr = world->m_VertexBufferBase;
                 world->m_IndexBufferWritePtr = world->m_IndexBufferData;
+                world->m_InstanceBufferData.SetSize(0);
                 world->m_RenderObjectsInUse = 0;
                 break;
             case dmRender::RENDER_LIST_OPERATION_END:
                 {
-                    uint32_t vertex_data_size = world->m_VertexBufferWritePtr - world->m_VertexBufferData;
+                    uint32_t vertex_data_size = world->m_VertexBufferWritePtr - world->m_VertexBufferBase;
                     uint32_t index_data_size  = world->m_IndexBufferWritePtr - world->m_IndexBufferData;
 
+                    bool dynamic_vertices = IsWritingDynamicVertices(world);
+                    if (dynamic_vertices)
+                    {
+                        dmGraphics::CommitDynamicVertexData(dmRender::GetGraphicsContext(params.m_Context), world->m_DynamicVertexBuffer, vertex_data_size);
+                    }
+
                     // JG: The renderer executes the dispatch function for begin/end regardless if something is actually batched or not
                     //     This behaviour can cause side-effects on certain platforms and non-opengl graphics adapters.
                     //     We might want to change how that process is setup, but for now this is a safer change.
                     if (vertex_data_size && index_data_size)
                     {
-                        dmRender::SetBufferData(params.m_Context, world->m_VertexBuffer, vertex_data_size, world->m_VertexBufferData, dmGraphics::BUFFER_USAGE_DYNAMIC_DRAW);
+                        if (!dynamic_vertices)
+                        {
+                            dmRender::SetBufferData(params.m_Context, world->m_VertexBuffer, vertex_data_size, world->m_VertexBufferData, dmGraphics::BUFFER_USAGE_DYNAMIC_DRAW);
+                        }
                         dmRender::SetBufferData(params.m_Context, world->m_IndexBuffer, index_data_size, world->m_IndexBufferData, dmGraphics::BUFFER_USAGE_DYNAMIC_DRAW);
 
                         DM_PROPERTY_ADD_U32(rmtp_SpriteVertexCount, world->m_VertexCount);
@@ -1869,6 +2755,13 @@ namespace dmGameSystem
 
                         world->m_DispatchCount++;
                     }
+
+                    if (!world->m_InstanceBufferData.Empty())
+                    {
+                        dmRender::SetBufferData(params.m_Context, world->m_InstanceBuffer, world->m_InstanceBufferData.Size(), world->m_InstanceBufferData.Begin(), dmGraphics::BUFFER_USAGE_DYNAMIC_DRAW);
+                        DM_PROPERTY_ADD_U32(rmtp_SpriteVertexSize, world->m_InstanceBufferData.Size());
+                        world->m_InstanceDispatchCount++;
+                    }
                 }
                 break;
             default:
@@ -1886,7 +2779,17 @@ namespace dmGameSystem
 
         sprite_world->m_VerticesWritten = 0;
 
+        // Sorted on the batch key, so that RenderBatch reads the sprites of a batch sequentially.
+        // It's done before the per frame data that are indexed by the physical index are calculated.
+        if (sprite_world->m_SortComponents)
+        {
+            DM_PROFILE("SortComponents");
+            sprite_world->m_SortComponents = 0;
+            sprite_world->m_Components.Sort(GetBatchKey);
+        }
+
         UpdateTransforms(sprite_world, sprite_context->m_Subpixels); // TODO: Why is this not in the update function?
+        UpdateSpatialIndex(sprite_world);
 
         UpdateVertexAndIndexCount(sprite_world, render_context);
 
@@ -1904,6 +2807,7 @@ namespace dmGameSystem
         // Submit all sprites as entries in the render list for sorting.
         dmRender::RenderListEntry* render_list = dmRender::RenderListAlloc(render_context, sprite_count);
         dmRender::HRenderListDispatch sprite_dispatch = dmRender::RenderListMakeDispatch(render_context, &RenderListDispatch, &RenderListFrustumCulling, sprite_world);
+        dmRender::RenderListSetSpatialIndex(render_context, sprite_dispatch, sprite_world->m_SpatialIndex);
         dmRender::RenderListEntry* write_ptr = render_list;
 
         for (uint32_t i = 0; i < sprite_count; ++i)
@@ -1915,7 +2819,9 @@ namespace dmGameSystem
             HComponentRenderConstants constants = GetRenderConstants(&component);
             if (component.m_ReHash || (constants && dmGameSystem::AreRenderConstantsUpdated(constants)))
             {
+                uint32_t prev_hash = component.m_MixedHash;
                 ReHash(&component);
+                sprite_world->m_SortComponents |= prev_hash != component.m_MixedHash;
             }
 
             const Vector4 trans = component.m_World.getCol(3);
@@ -2185,6 +3091,9 @@ namespace dmGameSystem
         SpriteComponent* component = &sprite_world->m_Components.Get(*params.m_UserData);
         dmhash_t set_property = params.m_PropertyId;
 
+        // Most properties (e.g. the vertex attributes) affect the vertices
+        component->m_VerticesDirty = 1;
+
         if (IsReferencingProperty(SPRITE_PROP_SCALE, set_property))
         {
             return SetProperty(set_property, params.m_Value, component->m_Scale, SPRITE_PROP_SCALE);
@@ -2396,8 +3305,25 @@ namespace dmGameSystem
         *ix_buffer = world->m_IndexBuffer;
     }
 
+    void GetSpriteWorldInstanceBuffer(void* sprite_world, dmRender::HBufferedRenderBuffer* instance_buffer)
+    {
+        *instance_buffer = ((SpriteWorld*) sprite_world)->m_InstanceBuffer;
+    }
+
     void GetSpriteWorldDynamicAttributePool(void* sprite_world, DynamicAttributePool** pool_out)
     {
         *pool_out = &((SpriteWorld*) sprite_world)->m_DynamicVertexAttributePool;
     }
+
+    uint32_t GetSpriteWorldVertexCacheCount(void* sprite_world)
+    {
+        dmArray<SpriteComponent>& components = ((SpriteWorld*) sprite_world)->m_Components.GetRawObjects();
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < components.Size(); ++i)
+        {
+            const SpriteVertexCache* cache = components[i].m_VertexCache;
+            count += cache && cache->m_Valid ? 1 : 0;
+        }
+        return count;
+    }
 }
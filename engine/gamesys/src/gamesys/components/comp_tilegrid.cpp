@@ -34,6 +34,7 @@
 #include "../gamesys_private.h"
 #include "../gamesys.h"
 #include "../resources/res_material.h"
+#include "../resources/res_texture.h"
 #include "../resources/res_textureset.h"
 #include "../resources/res_tilegrid.h"
 #include <gamesys/physics_ddf.h>
@@ -45,10 +46,17 @@ DM_PROPERTY_U32(rmtp_Tilemap, 0, FrameReset, "# components", &rmtp_Components);
 DM_PROPERTY_U32(rmtp_TilemapTileCount, 0, FrameReset, "# vertices", &rmtp_Tilemap);
 DM_PROPERTY_U32(rmtp_TilemapVertexCount, 0, FrameReset, "# vertices", &rmtp_Tilemap);
 DM_PROPERTY_U32(rmtp_TilemapVertexSize, 0, FrameReset, "size of vertices in bytes", &rmtp_Tilemap);
+DM_PROPERTY_U32(rmtp_TilemapRegionBufferCount, 0, FrameReset, "# region buffers drawn", &rmtp_Tilemap);
 
 namespace dmGameSystem
 {
     const uint32_t TILEGRID_REGION_SIZE = 32;
+    const uint32_t TILEGRID_REGION_VERTEX_COUNT = TILEGRID_REGION_SIZE * TILEGRID_REGION_SIZE * 6;
+    // The regions are drawn from their own buffers once unchanged for this many frames. Regions that change often
+    // (e.g. animated with tilemap.set_tile()) keep writing to the shared vertex buffer instead.
+    const uint32_t TILEGRID_REGION_STATIC_FRAME_COUNT = 2;
+    // The region buffers that haven't been drawn for this many frames are deleted
+    const uint32_t TILEGRID_REGION_BUFFER_MAX_UNUSED_FRAMES = 120;
 
     using namespace dmVMath;
 
@@ -58,9 +66,23 @@ namespace dmGameSystem
     {
         uint8_t m_Dirty      : 1;
         uint8_t m_Occupied   : 1;
-        uint8_t              : 6;
+        uint8_t m_UnchangedFrames : 2; // Number of updates since the tiles last changed, saturated
+        uint8_t              : 4;
     };
 
+    // The vertices of a layer in a region, kept in a vertex buffer of its own once the
+    // region is static (see TILEGRID_REGION_STATIC_FRAME_COUNT). Static regions are then drawn without writing any vertices.
+    struct TileGridRegionBuffer
+    {
+        dmGraphics::HVertexBuffer m_VertexBuffer;
+        uint32_t                  m_VertexCount;
+        uint32_t                  m_LastUsedFrame;
+        uint8_t                   m_Valid : 1;
+        uint8_t                   : 7;
+    };
+
+    struct TileGridChunk;
+
     struct TileGridLayer
     {
         uint8_t m_IsVisible:1;
@@ -77,12 +99,12 @@ namespace dmGameSystem
 
         TileGridComponent()
         : m_Instance(0)
-        , m_Cells(0)
-        , m_CellFlags(0)
         , m_RenderConstants(0)
         , m_Material(0)
         , m_TextureSet(0)
         , m_Resource(0)
+        , m_RegionBuffersTextureSet(0)
+        , m_UnchangedFrames(0)
         {
         }
 
@@ -90,21 +112,33 @@ namespace dmGameSystem
         dmVMath::Quat               m_Rotation;
         dmVMath::Matrix4            m_World;
         dmGameObject::HInstance     m_Instance;
-        uint16_t*                   m_Cells;
-        Flags*                      m_CellFlags;
+        dmArray<TileGridChunk*>     m_Chunks; // The cells of each region, or 0 if the region never had any tiles
         dmArray<TileGridRegion>     m_Regions;
+        dmArray<TileGridRegionBuffer> m_RegionBuffers; // One per layer and region, [layer * region count + region index]
         dmArray<TileGridLayer>      m_Layers;
+        dmArray<uint32_t>           m_RenderEntries; // Handles into the world's persistent render list
         uint32_t                    m_MixedHash;
         HComponentRenderConstants   m_RenderConstants;
         MaterialResource*           m_Material;
         TextureSetResource*         m_TextureSet;
         TileGridResource*           m_Resource;
+        TextureSetResource*         m_RegionBuffersTextureSet; // The texture set the region buffers were created with
         uint16_t                    m_RegionsX; // number of regions in the x dimension
         uint16_t                    m_RegionsY; // number of regions in the y dimension
         uint16_t                    m_Occupied; // Number of occupied regions (regions with visible tiles)
         uint8_t                     m_Enabled : 1;
         uint8_t                     m_AddedToUpdate : 1;
         uint8_t                     : 6;
+        uint8_t                     m_UnchangedFrames; // Number of updates since the world transform last changed, saturated
+    };
+
+    // The cells of all layers in a region, laid out as [layer][y][x] within the region.
+    // Chunks are only allocated for regions that have tiles, so the cell memory follows
+    // the number of occupied regions rather than the size of the map.
+    struct TileGridChunk
+    {
+        uint16_t*                   m_Cells; // 0xffff for empty cells
+        TileGridComponent::Flags*   m_Flags;
     };
 
     struct TileGridVertex
@@ -120,6 +154,7 @@ namespace dmGameSystem
         }
 
         dmRender::HRenderContext        m_RenderContext;
+        dmRender::HPersistentRenderList m_RenderList;
         dmArray<TileGridComponent*>     m_Components;
         dmArray<dmRender::RenderObject> m_RenderObjects;
         dmGraphics::HVertexDeclaration  m_VertexDeclaration;
@@ -127,10 +162,12 @@ namespace dmGameSystem
         TileGridVertex*                 m_VertexBufferData;
         TileGridVertex*                 m_VertexBufferDataEnd;
         TileGridVertex*                 m_VertexBufferWritePtr;
+        TileGridVertex*                 m_RegionVertexData; // Scratch buffer for creating the region buffers
 
         uint32_t                        m_MaxTilemapCount;
         uint32_t                        m_MaxTileCount;
         uint32_t                        m_DispatchCount;
+        uint32_t                        m_Frame;
     };
 
     static void TileGridWorldAllocate(TileGridWorld* world)
@@ -151,6 +188,7 @@ namespace dmGameSystem
         uint32_t vcount = 6 * world->m_MaxTileCount;
         world->m_VertexBufferData = (TileGridVertex*) malloc(sizeof(TileGridVertex) * vcount);
         world->m_VertexBufferDataEnd = world->m_VertexBufferData + vcount;
+        world->m_RegionVertexData = (TileGridVertex*) malloc(sizeof(TileGridVertex) * TILEGRID_REGION_VERTEX_COUNT);
     }
 
     dmGameObject::CreateResult CompTileGridNewWorld(const dmGameObject::ComponentNewWorldParams& params)
@@ -163,6 +201,7 @@ namespace dmGameSystem
         world->m_MaxTileCount = context->m_MaxTileCount;
 
         world->m_Components.SetCapacity(comp_count);
+        world->m_RenderList = dmRender::NewPersistentRenderList();
 
         world->m_VertexDeclaration = 0;
 
@@ -178,7 +217,9 @@ namespace dmGameSystem
             dmGraphics::DeleteVertexDeclaration(world->m_VertexDeclaration);
             dmRender::DeleteBufferedRenderBuffer(world->m_RenderContext, world->m_VertexBuffer);
             free(world->m_VertexBufferData);
+            free(world->m_RegionVertexData);
         }
+        dmRender::DeletePersistentRenderList(world->m_RenderList);
         delete world;
         return dmGameObject::CREATE_RESULT_OK;
     }
@@ -215,19 +256,63 @@ namespace dmGameSystem
         cell_y = y - component->m_Resource->m_MinCellY;
     }
 
+    static inline uint32_t GetRegionIndex(const TileGridComponent* component, int32_t cell_x, int32_t cell_y)
+    {
+        return (cell_y / TILEGRID_REGION_SIZE) * component->m_RegionsX + (cell_x / TILEGRID_REGION_SIZE);
+    }
+
+    // The index of the cell within its chunk
+    static inline uint32_t GetChunkCellIndex(uint32_t layer, int32_t cell_x, int32_t cell_y)
+    {
+        return layer * TILEGRID_REGION_SIZE * TILEGRID_REGION_SIZE + (cell_y % TILEGRID_REGION_SIZE) * TILEGRID_REGION_SIZE + (cell_x % TILEGRID_REGION_SIZE);
+    }
+
+    static TileGridChunk* NewChunk(uint32_t layer_count)
+    {
+        uint32_t cell_count = layer_count * TILEGRID_REGION_SIZE * TILEGRID_REGION_SIZE;
+        // One allocation for the chunk, the cells and the flags
+        uint8_t* mem = (uint8_t*)malloc(sizeof(TileGridChunk) + cell_count * (sizeof(uint16_t) + sizeof(TileGridComponent::Flags)));
+        TileGridChunk* chunk = (TileGridChunk*)mem;
+        chunk->m_Cells = (uint16_t*)(mem + sizeof(TileGridChunk));
+        chunk->m_Flags = (TileGridComponent::Flags*)(chunk->m_Cells + cell_count);
+        memset(chunk->m_Cells, 0xff, cell_count * sizeof(uint16_t));
+        memset(chunk->m_Flags, 0, cell_count * sizeof(TileGridComponent::Flags));
+        return chunk;
+    }
+
+    static void DeleteChunks(TileGridComponent* component)
+    {
+        for (uint32_t i = 0; i < component->m_Chunks.Size(); ++i)
+        {
+            free(component->m_Chunks[i]);
+        }
+        component->m_Chunks.SetSize(0);
+    }
+
+    // Returns the chunk of the cell, and creates it if needed
+    static TileGridChunk* GetOrCreateChunk(TileGridComponent* component, int32_t cell_x, int32_t cell_y)
+    {
+        TileGridChunk** chunk = &component->m_Chunks[GetRegionIndex(component, cell_x, cell_y)];
+        if (!*chunk)
+            *chunk = NewChunk(component->m_Layers.Size());
+        return *chunk;
+    }
+
     uint16_t GetTileGridTile(const TileGridComponent* component, uint32_t layer, int32_t cell_x, int32_t cell_y)
     {
-        TileGridResource* resource = component->m_Resource;
-        uint32_t cell_index = CalculateCellIndex(layer, cell_x, cell_y, resource->m_ColumnCount, resource->m_RowCount);
-        uint16_t cell = (component->m_Cells[cell_index] + 1);
+        const TileGridChunk* chunk = component->m_Chunks[GetRegionIndex(component, cell_x, cell_y)];
+        if (!chunk)
+            return 0;
+        uint16_t cell = (chunk->m_Cells[GetChunkCellIndex(layer, cell_x, cell_y)] + 1);
         return cell;
     }
 
     uint8_t GetTileTransformMask(const TileGridComponent* component, uint32_t layer, int32_t cell_x, int32_t cell_y)
     {
-        TileGridResource* resource = component->m_Resource;
-        uint32_t cell_index = CalculateCellIndex(layer, cell_x, cell_y, resource->m_ColumnCount, resource->m_RowCount);
-        TileGridComponent::Flags* flags = &component->m_CellFlags[cell_index];
+        const TileGridChunk* chunk = component->m_Chunks[GetRegionIndex(component, cell_x, cell_y)];
+        if (!chunk)
+            return 0;
+        TileGridComponent::Flags* flags = &chunk->m_Flags[GetChunkCellIndex(layer, cell_x, cell_y)];
         return flags->m_TransformMask;
     }
 
@@ -237,6 +322,58 @@ namespace dmGameSystem
         layer->m_IsVisible = visible;
     }
 
+    static inline TileGridRegionBuffer* GetRegionBuffer(TileGridComponent* component, uint32_t layer, uint32_t region_index)
+    {
+        return &component->m_RegionBuffers[layer * component->m_Regions.Size() + region_index];
+    }
+
+    // The buffers are recreated when the region is drawn next time it is unchanged
+    static void InvalidateRegionBuffers(TileGridComponent* component, uint32_t region_index)
+    {
+        uint32_t n_layers = component->m_Layers.Size();
+        for (uint32_t l = 0; l < n_layers; ++l)
+        {
+            GetRegionBuffer(component, l, region_index)->m_Valid = 0;
+        }
+    }
+
+    static void InvalidateAllRegionBuffers(TileGridComponent* component)
+    {
+        for (uint32_t i = 0; i < component->m_RegionBuffers.Size(); ++i)
+        {
+            component->m_RegionBuffers[i].m_Valid = 0;
+        }
+    }
+
+    static void DeleteRegionBuffers(TileGridComponent* component)
+    {
+        for (uint32_t i = 0; i < component->m_RegionBuffers.Size(); ++i)
+        {
+            TileGridRegionBuffer* region_buffer = &component->m_RegionBuffers[i];
+            if (region_buffer->m_VertexBuffer)
+            {
+                dmGraphics::DeleteVertexBuffer(region_buffer->m_VertexBuffer);
+            }
+        }
+        component->m_RegionBuffers.SetSize(0);
+    }
+
+    // Deletes the buffers of the regions that haven't been drawn for a while (e.g. outside of the view)
+    static void DeleteUnusedRegionBuffers(TileGridComponent* component, uint32_t frame)
+    {
+        for (uint32_t i = 0; i < component->m_RegionBuffers.Size(); ++i)
+        {
+            TileGridRegionBuffer* region_buffer = &component->m_RegionBuffers[i];
+            if (region_buffer->m_VertexBuffer && region_buffer->m_LastUsedFrame + TILEGRID_REGION_BUFFER_MAX_UNUSED_FRAMES < frame)
+            {
+                dmGraphics::DeleteVertexBuffer(region_buffer->m_VertexBuffer);
+                region_buffer->m_VertexBuffer = 0;
+                region_buffer->m_VertexCount = 0;
+                region_buffer->m_Valid = 0;
+            }
+        }
+    }
+
     static void SetRegionDirty(TileGridComponent* component, int32_t cell_x, int32_t cell_y)
     {
         uint32_t region_x = cell_x / TILEGRID_REGION_SIZE;
@@ -244,15 +381,20 @@ namespace dmGameSystem
         uint32_t region_index = region_y * component->m_RegionsX + region_x;
         TileGridRegion* region = &component->m_Regions[region_index];
         region->m_Dirty = 1;
+        InvalidateRegionBuffers(component, region_index);
     }
 
     void SetTileGridTile(TileGridComponent* component, uint32_t layer, int32_t cell_x, int32_t cell_y, uint32_t tile, uint8_t transform_mask)
     {
-        TileGridResource* resource = component->m_Resource;
-        uint32_t cell_index = CalculateCellIndex(layer, cell_x, cell_y, resource->m_ColumnCount, resource->m_RowCount);
-        component->m_Cells[cell_index] = tile;
+        // Clearing a cell in a region without tiles doesn't need a chunk
+        if ((uint16_t)tile == 0xffff && !component->m_Chunks[GetRegionIndex(component, cell_x, cell_y)])
+            return;
+
+        TileGridChunk* chunk = GetOrCreateChunk(component, cell_x, cell_y);
+        uint32_t cell_index = GetChunkCellIndex(layer, cell_x, cell_y);
+        chunk->m_Cells[cell_index] = tile;
 
-        TileGridComponent::Flags* flags = &component->m_CellFlags[cell_index];
+        TileGridComponent::Flags* flags = &chunk->m_Flags[cell_index];
         flags->m_TransformMask = transform_mask;
 
         SetRegionDirty(component, cell_x, cell_y);
@@ -289,7 +431,17 @@ namespace dmGameSystem
 
         component->m_Regions.SetCapacity(region_count);
         component->m_Regions.SetSize(region_count);
-        memset(&component->m_Regions[0], 0xFF, region_count * sizeof(TileGridRegion)); // mark them all dirty
+        memset(&component->m_Regions[0], 0, region_count * sizeof(TileGridRegion));
+        for (uint32_t i = 0; i < region_count; ++i)
+        {
+            component->m_Regions[i].m_Dirty = 1;
+        }
+
+        DeleteRegionBuffers(component);
+        uint32_t region_buffer_count = region_count * component->m_Layers.Size();
+        component->m_RegionBuffers.SetCapacity(region_buffer_count);
+        component->m_RegionBuffers.SetSize(region_buffer_count);
+        memset(component->m_RegionBuffers.Begin(), 0, region_buffer_count * sizeof(TileGridRegionBuffer));
     }
 
     static uint32_t UpdateRegion(TileGridComponent* component, uint32_t region_x, uint32_t region_y)
@@ -297,41 +449,34 @@ namespace dmGameSystem
         uint32_t index = region_y * component->m_RegionsX + region_x;
         TileGridRegion* region = &component->m_Regions[index];
         if (!region->m_Dirty) {
+            if (region->m_UnchangedFrames < TILEGRID_REGION_STATIC_FRAME_COUNT)
+                region->m_UnchangedFrames++;
             return region->m_Occupied;
         }
         region->m_Dirty = 0;
-
-        TileGridResource* resource = component->m_Resource;
-        dmGameSystemDDF::TileGrid* tile_grid_ddf = resource->m_TileGrid;
-
-        uint32_t n_layers = tile_grid_ddf->m_Layers.m_Count;
-
-        uint32_t column_count = resource->m_ColumnCount;
-        uint32_t row_count = resource->m_RowCount;
-        int32_t min_x = resource->m_MinCellX + region_x * TILEGRID_REGION_SIZE;
-        int32_t min_y = resource->m_MinCellY + region_y * TILEGRID_REGION_SIZE;
-        int32_t max_x = dmMath::Min(min_x + (int32_t)TILEGRID_REGION_SIZE, resource->m_MinCellX + (int32_t)column_count);
-        int32_t max_y = dmMath::Min(min_y + (int32_t)TILEGRID_REGION_SIZE, resource->m_MinCellY + (int32_t)row_count);
-
+        region->m_UnchangedFrames = 0;
         region->m_Occupied = 0;
 
+        const TileGridChunk* chunk = component->m_Chunks[index];
+        if (!chunk)
+            return region->m_Occupied;
+
+        // The cells outside of the map (in the last row or column of regions) are always empty
+        uint32_t n_layers = component->m_Layers.Size();
+        const uint32_t cells_per_layer = TILEGRID_REGION_SIZE * TILEGRID_REGION_SIZE;
         for (uint32_t j = 0; j < n_layers; ++j)
         {
             TileGridLayer* layer = &component->m_Layers[j];
             if (!layer->m_IsVisible)
                 continue;
 
-            for (int32_t y = min_y; y < max_y; ++y)
+            const uint16_t* cells = &chunk->m_Cells[j * cells_per_layer];
+            for (uint32_t i = 0; i < cells_per_layer; ++i)
             {
-                for (int32_t x = min_x; x < max_x; ++x)
+                if (cells[i] != 0xffff)
                 {
-                    uint32_t cell = CalculateCellIndex(j, x - resource->m_MinCellX, y - resource->m_MinCellY, column_count, row_count);
-                    uint16_t tile = component->m_Cells[cell];
-                    if (tile != 0xffff)
-                    {
-                        region->m_Occupied = 1;
-                        return region->m_Occupied;
-                    }
+                    region->m_Occupied = 1;
+                    return region->m_Occupied;
                 }
             }
         }
@@ -355,27 +500,20 @@ namespace dmGameSystem
         TileGridResource* resource = component->m_Resource;
         dmGameSystemDDF::TileGrid* tile_grid_ddf = resource->m_TileGrid;
         uint32_t n_layers = tile_grid_ddf->m_Layers.m_Count;
-        uint32_t cell_count = resource->m_ColumnCount * resource->m_RowCount * n_layers;
-        if (component->m_Cells != 0x0)
-        {
-            delete [] component->m_Cells;
-        }
-        component->m_Cells = new uint16_t[cell_count];
-        memset(component->m_Cells, 0xff, cell_count * sizeof(uint16_t));
-        if (component->m_CellFlags != 0x0)
-        {
-            delete [] component->m_CellFlags;
-        }
-        component->m_CellFlags = new TileGridComponent::Flags[cell_count];
-        memset(component->m_CellFlags, 0, cell_count * sizeof(TileGridComponent::Flags));
         int32_t min_x = resource->m_MinCellX;
         int32_t min_y = resource->m_MinCellY;
-        uint32_t column_count = resource->m_ColumnCount;
-        uint32_t row_count = resource->m_RowCount;
 
         component->m_Layers.SetCapacity(n_layers);
         component->m_Layers.SetSize(n_layers);
 
+        CreateRegions(component, resource);
+
+        DeleteChunks(component);
+        uint32_t region_count = component->m_Regions.Size();
+        component->m_Chunks.SetCapacity(region_count);
+        component->m_Chunks.SetSize(region_count);
+        memset(component->m_Chunks.Begin(), 0, region_count * sizeof(TileGridChunk*));
+
         for (uint32_t i = 0; i < n_layers; ++i)
         {
             dmGameSystemDDF::TileLayer* layer_ddf = &tile_grid_ddf->m_Layers[i];
@@ -386,10 +524,13 @@ namespace dmGameSystem
             for (uint32_t j = 0; j < n_cells; ++j)
             {
                 dmGameSystemDDF::TileCell* cell = &layer_ddf->m_Cell[j];
-                uint32_t cell_index = CalculateCellIndex(i, cell->m_X - min_x, cell->m_Y - min_y, column_count, row_count);
-                component->m_Cells[cell_index] = (uint16_t)cell->m_Tile;
+                int32_t cell_x = cell->m_X - min_x;
+                int32_t cell_y = cell->m_Y - min_y;
+                TileGridChunk* chunk = GetOrCreateChunk(component, cell_x, cell_y);
+                uint32_t cell_index = GetChunkCellIndex(i, cell_x, cell_y);
+                chunk->m_Cells[cell_index] = (uint16_t)cell->m_Tile;
 
-                TileGridComponent::Flags* flags = &component->m_CellFlags[cell_index];
+                TileGridComponent::Flags* flags = &chunk->m_Flags[cell_index];
                 flags->m_TransformMask = 0;
                 if (cell->m_HFlip)
                 {
@@ -406,11 +547,20 @@ namespace dmGameSystem
             }
         }
 
-        CreateRegions(component, resource);
         component->m_Occupied = UpdateRegions(component);
         return n_layers;
     }
 
+    // Removes the render entries of the component, starting at 'first'
+    static void RemoveRenderEntries(TileGridWorld* world, TileGridComponent* component, uint32_t first)
+    {
+        for (uint32_t i = first; i < component->m_RenderEntries.Size(); ++i)
+        {
+            dmRender::RemovePersistentRenderListEntry(world->m_RenderList, component->m_RenderEntries[i]);
+        }
+        component->m_RenderEntries.SetSize(first);
+    }
+
     dmGameObject::CreateResult CompTileGridCreate(const dmGameObject::ComponentCreateParams& params)
     {
         TileGridWorld* world = (TileGridWorld*) params.m_World;
@@ -465,14 +615,17 @@ namespace dmGameSystem
                     dmResource::Release(dmGameObject::GetFactory(params.m_Instance), tile_grid->m_TextureSet);
                 }
 
-                delete [] tile_grid->m_Cells;
-                delete [] tile_grid->m_CellFlags;
+                DeleteChunks(tile_grid);
+                DeleteRegionBuffers(tile_grid);
 
                 if (tile_grid->m_RenderConstants)
                 {
                     dmGameSystem::DestroyRenderConstants(tile_grid->m_RenderConstants);
                 }
 
+                // The render entries of the component moved into this slot are updated with the new index when rendered
+                RemoveRenderEntries(world, tile_grid, 0);
+
                 world->m_Components.EraseSwap(i);
                 delete tile_grid;
                 return dmGameObject::CREATE_RESULT_OK;
@@ -500,11 +653,18 @@ namespace dmGameSystem
     dmGameObject::UpdateResult CompTileGridUpdate(const dmGameObject::ComponentsUpdateParams& params, dmGameObject::ComponentsUpdateResult& update_result)
     {
         TileGridWorld* world = (TileGridWorld*)params.m_World;
+        world->m_Frame++;
+        bool delete_unused_region_buffers = (world->m_Frame % TILEGRID_REGION_BUFFER_MAX_UNUSED_FRAMES) == 0;
+
         dmArray<TileGridComponent*>& components = world->m_Components;
         uint32_t n = components.Size();
         for (uint32_t i = 0; i < n; ++i)
         {
             TileGridComponent* component = components[i];
+            if (delete_unused_region_buffers) {
+                DeleteUnusedRegionBuffers(component, world->m_Frame);
+            }
+
             if (!component->m_Enabled || !component->m_AddedToUpdate) {
                 continue;
             }
@@ -516,13 +676,28 @@ namespace dmGameSystem
 
             Matrix4 local(component->m_Rotation, component->m_Translation);
             const Matrix4& go_world = dmGameObject::GetWorldMatrix(component->m_Instance);
+            Matrix4 world_matrix;
             if (dmGameObject::ScaleAlongZ(component->m_Instance))
             {
-                component->m_World = go_world * local;
+                world_matrix = go_world * local;
             }
             else
             {
-                component->m_World = dmTransform::MulNoScaleZ(go_world, local);
+                world_matrix = dmTransform::MulNoScaleZ(go_world, local);
+            }
+
+            // The region buffers are in world space, so they're recreated when the tile map moves
+            TextureSetResource* texture_set = GetTextureSet(component);
+            if (memcmp(&world_matrix, &component->m_World, sizeof(world_matrix)) != 0 || texture_set != component->m_RegionBuffersTextureSet)
+            {
+                component->m_World = world_matrix;
+                component->m_RegionBuffersTextureSet = texture_set;
+                component->m_UnchangedFrames = 0;
+                InvalidateAllRegionBuffers(component);
+            }
+            else if (component->m_UnchangedFrames < TILEGRID_REGION_STATIC_FRAME_COUNT)
+            {
+                component->m_UnchangedFrames++;
             }
         }
         DM_PROPERTY_ADD_U32(rmtp_Tilemap, world->m_Components.Size());
@@ -548,9 +723,9 @@ namespace dmGameSystem
         region_y = (ptr >> 48) & 0xFFFF;
     }
 
-    TileGridVertex* CreateVertexData(TileGridWorld* world, TileGridVertex* where, TextureSetResource* texture_set, dmRender::RenderListEntry* buf, uint32_t* begin, uint32_t* end)
+    // Writes the vertices of a layer in a region, returns 0 if they don't fit between 'where' and 'where_end'
+    static TileGridVertex* CreateVertexData(const TileGridComponent* component, TextureSetResource* texture_set, uint32_t layer, uint32_t region_x, uint32_t region_y, TileGridVertex* where, TileGridVertex* where_end)
     {
-        DM_PROFILE("CreateVertexData");
         /*
          *   0----3
          *   | \  |
@@ -575,72 +750,70 @@ namespace dmGameSystem
         uint32_t tile_width = texture_set_ddf->m_TileWidth;
         uint32_t tile_height = texture_set_ddf->m_TileHeight;
 
-        for (uint32_t* i = begin; i != end; ++i)
-        {
-            uint32_t index, layer, region_x, region_y;
-            DecodeGridAndLayer(buf[*i].m_UserData, index, layer, region_x, region_y);
+        const TileGridResource* resource = component->m_Resource;
+        dmGameSystemDDF::TileGrid* tile_grid_ddf = resource->m_TileGrid;
+        dmGameSystemDDF::TileLayer* layer_ddf = &tile_grid_ddf->m_Layers[layer];
 
-            const TileGridComponent* component = world->m_Components[index];
-            const TileGridResource* resource = component->m_Resource;
-            dmGameSystemDDF::TileGrid* tile_grid_ddf = resource->m_TileGrid;
-            dmGameSystemDDF::TileLayer* layer_ddf = &tile_grid_ddf->m_Layers[layer];
+        const Matrix4& w = component->m_World;
+        const float z = layer_ddf->m_Z;
 
-            const Matrix4& w = component->m_World;
-            const float z = layer_ddf->m_Z;
+        uint32_t column_count = resource->m_ColumnCount;
+        uint32_t row_count = resource->m_RowCount;
 
-            uint32_t column_count = resource->m_ColumnCount;
-            uint32_t row_count = resource->m_RowCount;
+        const TileGridChunk* chunk = component->m_Chunks[region_y * component->m_RegionsX + region_x];
+        if (!chunk)
+        {
+            return where;
+        }
 
-            int32_t min_x = resource->m_MinCellX + region_x * TILEGRID_REGION_SIZE;
-            int32_t min_y = resource->m_MinCellY + region_y * TILEGRID_REGION_SIZE;
-            int32_t max_x = dmMath::Min(min_x + (int32_t)TILEGRID_REGION_SIZE, resource->m_MinCellX + (int32_t)column_count);
-            int32_t max_y = dmMath::Min(min_y + (int32_t)TILEGRID_REGION_SIZE, resource->m_MinCellY + (int32_t)row_count);
+        int32_t min_x = resource->m_MinCellX + region_x * TILEGRID_REGION_SIZE;
+        int32_t min_y = resource->m_MinCellY + region_y * TILEGRID_REGION_SIZE;
+        int32_t max_x = dmMath::Min(min_x + (int32_t)TILEGRID_REGION_SIZE, resource->m_MinCellX + (int32_t)column_count);
+        int32_t max_y = dmMath::Min(min_y + (int32_t)TILEGRID_REGION_SIZE, resource->m_MinCellY + (int32_t)row_count);
 
-            for (int32_t y = min_y; y < max_y; ++y)
+        for (int32_t y = min_y; y < max_y; ++y)
+        {
+            for (int32_t x = min_x; x < max_x; ++x)
             {
-                for (int32_t x = min_x; x < max_x; ++x)
+                uint32_t cell = GetChunkCellIndex(layer, x - resource->m_MinCellX, y - resource->m_MinCellY);
+                uint16_t tile = chunk->m_Cells[cell];
+                if (tile == 0xffff)
                 {
-                    uint32_t cell = CalculateCellIndex(layer, x - resource->m_MinCellX, y - resource->m_MinCellY, column_count, row_count);
-                    uint16_t tile = component->m_Cells[cell];
-                    if (tile == 0xffff)
-                    {
-                        continue;
-                    }
+                    continue;
+                }
 
-                    if( where >= world->m_VertexBufferDataEnd )
-                    {
-                        dmLogError("Out of tiles to render (%zu). You can change this with the game.project setting tilemap.max_tile_count", (size_t)((world->m_VertexBufferDataEnd - world->m_VertexBufferData) / 6));
-                        return world->m_VertexBufferDataEnd;
-                    }
+                if( where >= where_end )
+                {
+                    return 0;
+                }
 
-                    float p[4];
-                    CalculateCellBounds(x, y, 1, 1, p);
-                    const float* puv = &tex_coords[tile * 8];
-
-                    TileGridComponent::Flags flags = component->m_CellFlags[cell];
-                    const int* tex_lookup = &tex_coord_order[flags.m_TransformMask * 6];
-
-                    #define SET_VERTEX(_I, _X, _Y, _Z, _U, _V) \
-                        { \
-                            const Vector4 v = w * Point3(_X * tile_width, _Y * tile_height, _Z); \
-                            where[_I].x = v.getX(); \
-                            where[_I].y = v.getY(); \
-                            where[_I].z = v.getZ(); \
-                            where[_I].u = _U; \
-                            where[_I].v = _V; \
-                        }
+                float p[4];
+                CalculateCellBounds(x, y, 1, 1, p);
+                const float* puv = &tex_coords[tile * 8];
+
+                TileGridComponent::Flags flags = chunk->m_Flags[cell];
+                const int* tex_lookup = &tex_coord_order[flags.m_TransformMask * 6];
+
+                #define SET_VERTEX(_I, _X, _Y, _Z, _U, _V) \
+                    { \
+                        const Vector4 v = w * Point3(_X * tile_width, _Y * tile_height, _Z); \
+                        where[_I].x = v.getX(); \
+                        where[_I].y = v.getY(); \
+                        where[_I].z = v.getZ(); \
+                        where[_I].u = _U; \
+                        where[_I].v = _V; \
+                    }
 
-                    SET_VERTEX(0, p[0], p[1], z, puv[tex_lookup[0] * 2], puv[tex_lookup[0] * 2 + 1]);
-                    SET_VERTEX(1, p[0], p[3], z, puv[tex_lookup[1] * 2], puv[tex_lookup[1] * 2 + 1]);
-                    SET_VERTEX(2, p[2], p[3], z, puv[tex_lookup[2] * 2], puv[tex_lookup[2] * 2 + 1]);
-                    SET_VERTEX(3, p[2], p[3], z, puv[tex_lookup[3] * 2], puv[tex_lookup[3] * 2 + 1]);
-                    SET_VERTEX(4, p[2], p[1], z, puv[tex_lookup[4] * 2], puv[tex_lookup[4] * 2 + 1]);
-                    SET_VERTEX(5, p[0], p[1], z, puv[tex_lookup[5] * 2], puv[tex_lookup[5] * 2 + 1]);
+                SET_VERTEX(0, p[0], p[1], z, puv[tex_lookup[0] * 2], puv[tex_lookup[0] * 2 + 1]);
+                SET_VERTEX(1, p[0], p[3], z, puv[tex_lookup[1] * 2], puv[tex_lookup[1] * 2 + 1]);
+                SET_VERTEX(2, p[2], p[3], z, puv[tex_lookup[2] * 2], puv[tex_lookup[2] * 2 + 1]);
+                SET_VERTEX(3, p[2], p[3], z, puv[tex_lookup[3] * 2], puv[tex_lookup[3] * 2 + 1]);
+                SET_VERTEX(4, p[2], p[1], z, puv[tex_lookup[4] * 2], puv[tex_lookup[4] * 2 + 1]);
+                SET_VERTEX(5, p[0], p[1], z, puv[tex_lookup[5] * 2], puv[tex_lookup[5] * 2 + 1]);
 
-                    where += 6;
+                where += 6;
 
-                    #undef SET_VERTEX
-                }
+                #undef SET_VERTEX
             }
         }
         return where;
@@ -652,70 +825,69 @@ namespace dmGameSystem
         TileGridWorld* tilegrid_world = (TileGridWorld*)params.m_UserData;
         const dmIntersection::Frustum frustum = *params.m_Frustum;
         uint32_t num_entries = params.m_NumEntries;
-        for (uint32_t i = 0; i < num_entries; ++i)
+
+        // The region bounds are packed and tested in batches
+        const uint32_t batch_size = 64;
+        dmIntersection::WorldAABB bounds[batch_size];
+        uint8_t results[batch_size];
+        for (uint32_t batch_start = 0; batch_start < num_entries; batch_start += batch_size)
         {
-            dmRender::RenderListEntry* entry = &params.m_Entries[i];
-            uint32_t index, layer, region_x, region_y;
-            //entry->m_UserData - encoded region info
-            DecodeGridAndLayer(entry->m_UserData, index, layer, region_x, region_y);
-            TileGridComponent* component = tilegrid_world->m_Components[index];
+            uint32_t batch_count = dmMath::Min(batch_size, num_entries - batch_start);
+            dmRender::RenderListEntry* entries = &params.m_Entries[batch_start];
+            for (uint32_t i = 0; i < batch_count; ++i)
+            {
+                uint32_t index, layer, region_x, region_y;
+                // m_UserData - encoded region info
+                DecodeGridAndLayer(entries[i].m_UserData, index, layer, region_x, region_y);
+                TileGridComponent* component = tilegrid_world->m_Components[index];
+
+                TileGridResource* resource = component->m_Resource;
+                TextureSetResource* texture_set = GetTextureSet(component);
+                int32_t tile_width = (int32_t)texture_set->m_TextureSet->m_TileWidth;
+                int32_t tile_height = (int32_t)texture_set->m_TextureSet->m_TileHeight;
+
+                int32_t column_count = (int32_t)resource->m_ColumnCount;
+                int32_t row_count = (int32_t)resource->m_RowCount;
+                int32_t min_x = resource->m_MinCellX + region_x * TILEGRID_REGION_SIZE;
+                int32_t min_y = resource->m_MinCellY + region_y * TILEGRID_REGION_SIZE;
+
+                int32_t region_max_x = min_x + TILEGRID_REGION_SIZE;
+                int32_t tilemap_max_x = resource->m_MinCellX + column_count;
+                int32_t region_max_y = min_y + TILEGRID_REGION_SIZE;
+                int32_t tilemap_max_y = resource->m_MinCellY + row_count;
+                int32_t max_x = dmMath::Min(region_max_x, tilemap_max_x);
+                int32_t max_y = dmMath::Min(region_max_y, tilemap_max_y);
+
+                dmVMath::Vector3 min_corner = dmVMath::Vector3((float)(min_x * tile_width), (float)(min_y * tile_height), 0.f);
+                dmVMath::Vector3 max_corner = dmVMath::Vector3((float)(max_x * tile_width), (float)(max_y * tile_height), 0.f);
+                dmIntersection::CreateWorldAABB(component->m_World, min_corner, max_corner, bounds[i]);
+            }
+            dmIntersection::TestFrustumWorldAABBs(frustum, bounds, batch_count, results);
 
-            TileGridResource* resource = component->m_Resource;
-            TextureSetResource* texture_set = GetTextureSet(component);
-            int32_t tile_width = (int32_t)texture_set->m_TextureSet->m_TileWidth;
-            int32_t tile_height = (int32_t)texture_set->m_TextureSet->m_TileHeight;
-
-            int32_t column_count = (int32_t)resource->m_ColumnCount;
-            int32_t row_count = (int32_t)resource->m_RowCount;
-            int32_t min_x = resource->m_MinCellX + region_x * TILEGRID_REGION_SIZE;
-            int32_t min_y = resource->m_MinCellY + region_y * TILEGRID_REGION_SIZE;
-
-            int32_t region_max_x = min_x + TILEGRID_REGION_SIZE;
-            int32_t tilemap_max_x = resource->m_MinCellX + column_count;
-            int32_t region_max_y = min_y + TILEGRID_REGION_SIZE;
-            int32_t tilemap_max_y = resource->m_MinCellY + row_count;
-            int32_t max_x = dmMath::Min(region_max_x, tilemap_max_x);
-            int32_t max_y = dmMath::Min(region_max_y, tilemap_max_y);
-
-            dmVMath::Vector3 min_corner = dmVMath::Vector3((float)(min_x * tile_width), (float)(min_y * tile_height), 0.f);
-            dmVMath::Vector3 max_corner = dmVMath::Vector3((float)(max_x * tile_width), (float)(max_y * tile_height), 0.f);
-            bool intersect = dmIntersection::TestFrustumOBB(frustum, component->m_World, min_corner, max_corner);
-            entry->m_Visibility = intersect ? dmRender::VISIBILITY_FULL : dmRender::VISIBILITY_NONE;
+            for (uint32_t i = 0; i < batch_count; ++i)
+            {
+                entries[i].m_Visibility = results[i] ? dmRender::VISIBILITY_FULL : dmRender::VISIBILITY_NONE;
+            }
         }
     }
 
-    static void RenderBatch(TileGridWorld* world, dmRender::HRenderContext render_context, dmRender::RenderListEntry *buf, uint32_t* begin, uint32_t* end)
+    static void AddRenderObject(TileGridWorld* world, dmRender::HRenderContext render_context, TileGridComponent* first, TextureSetResource* texture_set,
+                                dmGraphics::HVertexBuffer vertex_buffer, uint32_t vertex_start, uint32_t vertex_count)
     {
-        DM_PROFILE("TileGridRenderBatch");
-
-        uint32_t index, layer, region_x, region_y;
-        DecodeGridAndLayer(buf[*begin].m_UserData, index, layer, region_x, region_y);
-        TileGridComponent* first = world->m_Components[index];
-        assert(first->m_Enabled);
-
         TileGridResource* resource = first->m_Resource;
-        TextureSetResource* texture_set = GetTextureSet(first);
 
         dmRender::RenderObject& ro = *world->m_RenderObjects.End();
         world->m_RenderObjects.SetSize(world->m_RenderObjects.Size()+1);
 
-        // Fill in vertex buffer
-        TileGridVertex* vb_begin = world->m_VertexBufferWritePtr;
-        world->m_VertexBufferWritePtr = CreateVertexData(world, vb_begin, texture_set, buf, begin, end);
-
-        if (dmRender::GetBufferIndex(render_context, world->m_VertexBuffer) < world->m_DispatchCount)
-        {
-            dmRender::AddRenderBuffer(render_context, world->m_VertexBuffer);
-        }
-
         ro.Init();
         ro.m_VertexDeclaration = world->m_VertexDeclaration;
-        ro.m_VertexBuffer      = (dmGraphics::HVertexBuffer) dmRender::GetBuffer(render_context, world->m_VertexBuffer);
+        ro.m_VertexBuffer      = vertex_buffer;
         ro.m_PrimitiveType = dmGraphics::PRIMITIVE_TRIANGLES;
-        ro.m_VertexStart = vb_begin - world->m_VertexBufferData;
-        ro.m_VertexCount = (world->m_VertexBufferWritePtr - vb_begin);
+        ro.m_VertexStart = vertex_start;
+        ro.m_VertexCount = vertex_count;
         ro.m_Material = GetMaterial(first);
         ro.m_Textures[0] = texture_set->m_Texture->m_Texture;
+        ReportTextureFullSize(texture_set->m_Texture);
 
         if (first->m_RenderConstants) {
             dmGameSystem::EnableRenderObjectConstants(&ro, first->m_RenderConstants);
@@ -756,6 +928,112 @@ namespace dmGameSystem
         dmRender::AddToRender(render_context, &ro);
     }
 
+    // Draws the vertices written to the shared vertex buffer since 'vb_begin'
+    static void FlushVertexData(TileGridWorld* world, dmRender::HRenderContext render_context, TileGridComponent* first, TextureSetResource* texture_set, TileGridVertex* vb_begin)
+    {
+        if (world->m_VertexBufferWritePtr == vb_begin)
+        {
+            return;
+        }
+
+        if (dmRender::GetBufferIndex(render_context, world->m_VertexBuffer) < world->m_DispatchCount)
+        {
+            dmRender::AddRenderBuffer(render_context, world->m_VertexBuffer);
+        }
+
+        dmGraphics::HVertexBuffer vertex_buffer = (dmGraphics::HVertexBuffer) dmRender::GetBuffer(render_context, world->m_VertexBuffer);
+        AddRenderObject(world, render_context, first, texture_set, vertex_buffer, vb_begin - world->m_VertexBufferData, world->m_VertexBufferWritePtr - vb_begin);
+    }
+
+    // Draws a layer of an unchanged region from its own vertex buffer, which is only written when the region has changed
+    static void DrawRegionBuffer(TileGridWorld* world, dmRender::HRenderContext render_context, TileGridComponent* first, TileGridComponent* component,
+                                 uint32_t layer, uint32_t region_x, uint32_t region_y)
+    {
+        TextureSetResource* texture_set = GetTextureSet(component);
+        uint32_t region_index = region_y * component->m_RegionsX + region_x;
+        TileGridRegionBuffer* region_buffer = GetRegionBuffer(component, layer, region_index);
+        region_buffer->m_LastUsedFrame = world->m_Frame;
+
+        if (!region_buffer->m_Valid)
+        {
+            DM_PROFILE("CreateRegionBuffer");
+            TileGridVertex* vertices = world->m_RegionVertexData;
+            TileGridVertex* vertices_end = CreateVertexData(component, texture_set, layer, region_x, region_y, vertices, vertices + TILEGRID_REGION_VERTEX_COUNT);
+            assert(vertices_end); // A region has room for all its tiles
+
+            if (region_buffer->m_VertexBuffer)
+            {
+                dmGraphics::DeleteVertexBuffer(region_buffer->m_VertexBuffer);
+                region_buffer->m_VertexBuffer = 0;
+            }
+
+            region_buffer->m_VertexCount = vertices_end - vertices;
+            if (region_buffer->m_VertexCount > 0)
+            {
+                uint32_t vertex_data_size = sizeof(TileGridVertex) * region_buffer->m_VertexCount;
+                region_buffer->m_VertexBuffer = dmGraphics::NewVertexBuffer(dmRender::GetGraphicsContext(world->m_RenderContext), vertex_data_size, vertices, dmGraphics::BUFFER_USAGE_STATIC_DRAW);
+                DM_PROPERTY_ADD_U32(rmtp_TilemapVertexSize, vertex_data_size);
+            }
+            region_buffer->m_Valid = 1;
+        }
+
+        if (region_buffer->m_VertexCount == 0)
+        {
+            return;
+        }
+
+        AddRenderObject(world, render_context, first, texture_set, region_buffer->m_VertexBuffer, 0, region_buffer->m_VertexCount);
+        DM_PROPERTY_ADD_U32(rmtp_TilemapRegionBufferCount, 1);
+        DM_PROPERTY_ADD_U32(rmtp_TilemapTileCount, region_buffer->m_VertexCount/6);
+        DM_PROPERTY_ADD_U32(rmtp_TilemapVertexCount, region_buffer->m_VertexCount);
+    }
+
+    static void RenderBatch(TileGridWorld* world, dmRender::HRenderContext render_context, dmRender::RenderListEntry *buf, uint32_t* begin, uint32_t* end)
+    {
+        DM_PROFILE("TileGridRenderBatch");
+
+        uint32_t index, layer, region_x, region_y;
+        DecodeGridAndLayer(buf[*begin].m_UserData, index, layer, region_x, region_y);
+        TileGridComponent* first = world->m_Components[index];
+        assert(first->m_Enabled);
+
+        TextureSetResource* texture_set = GetTextureSet(first);
+
+        // Fill in vertex buffer, with the regions that aren't static
+        TileGridVertex* vb_begin = world->m_VertexBufferWritePtr;
+        for (uint32_t* i = begin; i != end; ++i)
+        {
+            DecodeGridAndLayer(buf[*i].m_UserData, index, layer, region_x, region_y);
+            TileGridComponent* component = world->m_Components[index];
+            const TileGridRegion* region = &component->m_Regions[region_y * component->m_RegionsX + region_x];
+
+            if (!region->m_Dirty && region->m_UnchangedFrames >= TILEGRID_REGION_STATIC_FRAME_COUNT && component->m_UnchangedFrames >= TILEGRID_REGION_STATIC_FRAME_COUNT)
+            {
+                // Draw the vertices written so far first, to keep the draw order of the batch
+                FlushVertexData(world, render_context, first, texture_set, vb_begin);
+                vb_begin = world->m_VertexBufferWritePtr;
+
+                DrawRegionBuffer(world, render_context, first, component, layer, region_x, region_y);
+                continue;
+            }
+
+            if (world->m_VertexBufferWritePtr == world->m_VertexBufferDataEnd)
+            {
+                continue;
+            }
+
+            TileGridVertex* where = CreateVertexData(component, texture_set, layer, region_x, region_y, world->m_VertexBufferWritePtr, world->m_VertexBufferDataEnd);
+            if (where == 0)
+            {
+                dmLogError("Out of tiles to render (%zu). You can change this with the game.project setting tilemap.max_tile_count", (size_t)((world->m_VertexBufferDataEnd - world->m_VertexBufferData) / 6));
+                where = world->m_VertexBufferDataEnd;
+            }
+            world->m_VertexBufferWritePtr = where;
+        }
+
+        FlushVertexData(world, render_context, first, texture_set, vb_begin);
+    }
+
     static void RenderListDispatch(dmRender::RenderListDispatchParams const &params)
     {
         TileGridWorld* world = (TileGridWorld*) params.m_UserData;
@@ -830,15 +1108,15 @@ namespace dmGameSystem
             world->m_RenderObjects.SetCapacity(num_render_entries);
         }
 
+        // The entries are kept in a persistent render list, and only the ones that changed since the last frame are updated
         dmRender::HRenderContext render_context = context->m_RenderContext;
-        dmRender::RenderListEntry* render_list = dmRender::RenderListAlloc(render_context, num_render_entries);
         dmRender::HRenderListDispatch dispatch = dmRender::RenderListMakeDispatch(render_context, &RenderListDispatch, &RenderListFrustumCulling, world);
-        dmRender::RenderListEntry* write_ptr = render_list;
 
         for (uint32_t i = 0; i < n; ++i)
         {
             TileGridComponent* component = components[i];
             if (!component->m_Enabled || !component->m_AddedToUpdate || !component->m_Occupied) {
+                RemoveRenderEntries(world, component, 0);
                 continue;
             }
 
@@ -854,6 +1132,14 @@ namespace dmGameSystem
             uint32_t tile_width = texture_set_ddf->m_TileWidth;
             uint32_t tile_height = texture_set_ddf->m_TileHeight;
 
+            dmRender::RenderListEntry entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.m_TagListKey = dmRender::GetMaterialTagListKey(GetMaterial(component));
+            entry.m_BatchKey = component->m_MixedHash;
+            entry.m_MinorOrder = 0;
+            entry.m_MajorOrder = dmRender::RENDER_ORDER_WORLD;
+
+            uint32_t num_entries = 0;
             uint32_t n_layers = tile_grid_ddf->m_Layers.m_Count;
             for (uint32_t l = 0; l < n_layers; ++l)
             {
@@ -872,20 +1158,29 @@ namespace dmGameSystem
 
                         Vector4 trans = component->m_World * Point3(x * tile_width, y * tile_height, layer_ddf->m_Z);
 
-                        write_ptr->m_WorldPosition = Point3(trans.getXYZ());
-                        write_ptr->m_UserData = EncodeRegionInfo(i, l, x, y);
-                        write_ptr->m_TagListKey = dmRender::GetMaterialTagListKey(GetMaterial(component));
-                        write_ptr->m_BatchKey = component->m_MixedHash;
-                        write_ptr->m_Dispatch = dispatch;
-                        write_ptr->m_MinorOrder = 0;
-                        write_ptr->m_MajorOrder = dmRender::RENDER_ORDER_WORLD;
-                        ++write_ptr;
+                        entry.m_WorldPosition = Point3(trans.getXYZ());
+                        entry.m_UserData = EncodeRegionInfo(i, l, x, y);
+
+                        // The entries are written in the same order each frame, so an unchanged tile map updates nothing
+                        dmArray<uint32_t>& handles = component->m_RenderEntries;
+                        if (num_entries < handles.Size())
+                        {
+                            dmRender::UpdatePersistentRenderListEntry(world->m_RenderList, handles[num_entries], entry);
+                        }
+                        else
+                        {
+                            if (handles.Full())
+                                handles.OffsetCapacity(dmMath::Max(16U, handles.Capacity()));
+                            handles.Push(dmRender::AddPersistentRenderListEntry(world->m_RenderList, entry));
+                        }
+                        ++num_entries;
                     }
                 }
             }
+            RemoveRenderEntries(world, component, num_entries);
         }
 
-        dmRender::RenderListSubmit(render_context, render_list, write_ptr);
+        dmRender::RenderListSubmitPersistent(render_context, dispatch, world->m_RenderList);
 
         return dmGameObject::UPDATE_RESULT_OK;
     }
@@ -1030,4 +1325,20 @@ namespace dmGameSystem
         TileGridWorld* world = (TileGridWorld*) tilegrid_world;
         *vx_buffer = world->m_VertexBuffer;
     }
+
+    // For tests
+    uint32_t GetTileGridWorldRegionBufferCount(void* tilegrid_world)
+    {
+        TileGridWorld* world = (TileGridWorld*) tilegrid_world;
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < world->m_Components.Size(); ++i)
+        {
+            const dmArray<TileGridRegionBuffer>& region_buffers = world->m_Components[i]->m_RegionBuffers;
+            for (uint32_t j = 0; j < region_buffers.Size(); ++j)
+            {
+                count += region_buffers[j].m_Valid && region_buffers[j].m_VertexBuffer != 0;
+            }
+        }
+        return count;
+    }
 }
@@ -114,6 +114,7 @@ namespace dmGameSystem
         REGISTER_RESOURCE_TYPE("glyph_bankc", 0, ResGlyphBankPreload, ResGlyphBankCreate, 0, ResGlyphBankDestroy, ResGlyphBankRecreate);
         REGISTER_RESOURCE_TYPE("wavc", 0, 0, ResSoundDataCreate, 0, ResSoundDataDestroy, ResSoundDataRecreate);
         REGISTER_RESOURCE_TYPE("oggc", 0, 0, ResSoundDataCreate, 0, ResSoundDataDestroy, ResSoundDataRecreate);
+        REGISTER_RESOURCE_TYPE("opusc", 0, 0, ResSoundDataCreate, 0, ResSoundDataDestroy, ResSoundDataRecreate);
         REGISTER_RESOURCE_TYPE("soundc", 0, ResSoundPreload, ResSoundCreate, 0, ResSoundDestroy, ResSoundRecreate);
         REGISTER_RESOURCE_TYPE("camerac", 0, 0, ResCameraCreate, 0, ResCameraDestroy, ResCameraRecreate);
         REGISTER_RESOURCE_TYPE("input_bindingc", input_context, 0, ResInputBindingCreate, 0, ResInputBindingDestroy, ResInputBindingRecreate);
@@ -135,6 +136,28 @@ namespace dmGameSystem
 
 #undef REGISTER_RESOURCE_TYPE
 
+        // These types only build their data from the loaded file, so they can be created on the load threads
+        const char* thread_safe_create_types[] = { "convexshapec", "glyph_bankc", "skeletonc" };
+        for (uint32_t i = 0; i < DM_ARRAY_SIZE(thread_safe_create_types); ++i)
+        {
+            HResourceType type;
+            if (dmResource::GetTypeFromExtension(factory, thread_safe_create_types[i], &type) == dmResource::RESULT_OK)
+            {
+                ResourceTypeSetCreateThreadSafe(type, true);
+            }
+        }
+
+        // These types only read the loaded file, and copy what they keep, so they can use the data in place in the archive
+        const char* load_in_place_types[] = { "texturec", "bufferc", "wavc", "oggc", "opusc" };
+        for (uint32_t i = 0; i < DM_ARRAY_SIZE(load_in_place_types); ++i)
+        {
+            HResourceType type;
+            if (dmResource::GetTypeFromExtension(factory, load_in_place_types[i], &type) == dmResource::RESULT_OK)
+            {
+                ResourceTypeSetLoadInPlace(type, true);
+            }
+        }
+
         return e;
     }
 
@@ -225,6 +248,8 @@ namespace dmGameSystem
                 &CompCollisionObjectOnReload, CompCollisionObjectGetProperty, CompCollisionObjectSetProperty,
                 0, CompCollisionIterProperties,
                 1);
+        // The physics state is part of dmGameObject::HashCollectionState
+        dmGameObject::ComponentTypeSetHashStateFn(dmGameObject::FindComponentType(regist, type, 0), CompCollisionObjectHashState);
 
         REGISTER_COMPONENT_TYPE("camerac", 500, render_context,
                 &CompCameraNewWorld, &CompCameraDeleteWorld,
@@ -279,7 +304,7 @@ namespace dmGameSystem
         REGISTER_COMPONENT_TYPE("lightc", 1000, render_context,
                 CompLightNewWorld, CompLightDeleteWorld,
                 CompLightCreate, CompLightDestroy, 0, 0, CompLightAddToUpdate, CompLightGetComponent,
-                CompLightUpdate, 0, 0, 0, CompLightOnMessage, 0,
+                CompLightUpdate, 0, CompLightRender, 0, CompLightOnMessage, 0,
                 0, 0, 0,
                 0, 0,
                 1);
@@ -46,12 +46,18 @@ namespace dmGameSystem
     extern const char* PHYSICS_USE_FIXED_TIMESTEP;
     /// Config key for using max updates during a single step
     extern const char* PHYSICS_MAX_FIXED_TIMESTEPS;
+    /// Config key for interpolating the transforms of dynamic objects between the fixed steps
+    extern const char* PHYSICS_FIXED_TIMESTEP_INTERPOLATION;
     /// Config key to use for tweaking maximum number of collection proxies
     extern const char* COLLECTION_PROXY_MAX_COUNT_KEY;
+    /// Config key for the time per frame, in milliseconds, that async_init and async_final spend on a collection
+    extern const char* COLLECTION_PROXY_INIT_TIME_BUDGET_KEY;
     /// Config key to use for tweaking maximum number of factories
     extern const char* FACTORY_MAX_COUNT_KEY;
     /// Config key to use for tweaking maximum number of collection factories
     extern const char* COLLECTION_FACTORY_MAX_COUNT_KEY;
+    /// Config key for the texture streaming memory budget in megabytes, 0 disables texture streaming
+    extern const char* TEXTURE_STREAMING_BUDGET_KEY;
 
     struct TilemapContext
     {
@@ -88,6 +94,7 @@ namespace dmGameSystem
         bool        m_Debug;
         bool        m_3D;
         bool        m_UseFixedTimestep;
+        bool        m_FixedTimestepInterpolation;
         uint32_t    m_MaxFixedTimesteps;
     };
 
@@ -99,9 +106,12 @@ namespace dmGameSystem
         }
         dmResource::HFactory m_Factory;
         dmRender::HRenderContext m_RenderContext;
+        dmJobThread::HContext m_JobThread; // Optional. Used for parallel updates
         uint32_t m_MaxParticleFXCount;
         uint32_t m_MaxParticleCount;
         uint32_t m_MaxEmitterCount;
+        uint32_t m_OffscreenMode; // dmParticle::OffscreenMode
+        uint32_t m_SortInterval;
         bool m_Debug;
     };
 
@@ -120,6 +130,7 @@ namespace dmGameSystem
             memset(this, 0, sizeof(*this));
         }
         dmRender::HRenderContext    m_RenderContext;
+        dmJobThread::HContext       m_JobThread; // Optional. Used for parallel updates
         uint32_t                    m_MaxSpriteCount;
         uint32_t                    m_Subpixels : 1;
     };
@@ -132,7 +143,10 @@ namespace dmGameSystem
         }
         dmRender::HRenderContext    m_RenderContext;
         dmResource::HFactory        m_Factory;
+        dmJobThread::HContext       m_JobThread; // Optional. Used for parallel updates
         uint32_t                    m_MaxModelCount;
+        float                       m_PoseUpdateDistance; // If > 0, distant models have their pose evaluated less often
+        float                       m_LodScreenSize;      // If > 0, meshes smaller than this fraction of the screen height use their simplified levels
     };
 
     struct SoundContext
@@ -168,6 +182,7 @@ namespace dmGameSystem
         }
         dmResource::HFactory m_Factory;
         uint32_t m_MaxCollectionProxyCount;
+        uint32_t m_InitTimeBudget;  // In microseconds, see async_init
     };
 
     struct FactoryContext
@@ -219,6 +234,17 @@ namespace dmGameSystem
     void OnWindowIconify(bool iconfiy);
     void OnWindowResized(int width, int height);
     void OnWindowCreated(int width, int height);
+
+    /**
+     * Sets the GPU memory budget in bytes for streamed textures. With a budget of 0, textures are loaded whole.
+     */
+    void SetTextureStreamingBudget(uint32_t budget);
+
+    /**
+     * Streams in mipmaps for the textures reported on-screen (see ReportTextureScreenSize),
+     * evicting mipmaps of off-screen textures when the budget is exceeded. Called once per frame.
+     */
+    void UpdateTextureStreaming(dmGraphics::HContext context);
 }
 
 #endif // DM_GAMESYS_H
@@ -36,6 +36,7 @@
 #include "scripts/script_sys_gamesys.h"
 #include "scripts/script_camera.h"
 #include "scripts/script_http.h"
+#include "scripts/script_image.h"
 
 #include "components/comp_gui.h"
 
@@ -145,6 +146,7 @@ namespace dmGameSystem
         ScriptCollectionProxyRegister(context);
         ScriptSysGameSysRegister(context);
         ScriptHttpRegister(context);
+        ScriptImageRegister(context);
 
         assert(top == lua_gettop(L));
         return result;
@@ -18,6 +18,7 @@
 #include <resource/resource.h>
 #include <dlib/log.h>
 #include <dmsdk/dlib/vmath.h>
+#include <rig/rig.h>
 
 namespace dmGameSystem
 {
@@ -25,6 +26,31 @@ namespace dmGameSystem
 
     static dmResource::Result AcquireResources(dmResource::HFactory factory, AnimationSetResource* resource, const char* filename)
     {
+        dmRig::CompressAnimationParams params;
+        resource->m_CompressedAnimationSet = dmRig::CompressAnimationSet(resource->m_AnimationSet, params);
+        if (resource->m_CompressedAnimationSet == 0x0)
+        {
+            // The animations are played from the tracks in the animation set
+            return dmResource::RESULT_OK;
+        }
+
+        // The tracks are the bulk of the animation set, so the message is copied without them to release their memory
+        dmRigDDF::AnimationSet* animation_set = resource->m_AnimationSet;
+        uint32_t animation_count = animation_set->m_Animations.m_Count;
+        for (uint32_t i = 0; i < animation_count; ++i)
+        {
+            animation_set->m_Animations[i].m_Tracks.m_Count = 0;
+        }
+
+        dmRigDDF::AnimationSet* stripped_animation_set = 0x0;
+        dmDDF::Result e = dmDDF::CopyMessage(animation_set, &dmRigDDF_AnimationSet_DESCRIPTOR, (void**) &stripped_animation_set);
+        if (e != dmDDF::RESULT_OK)
+        {
+            dmLogWarning("Unable to release the animation tracks of '%s' (%d)", filename, e);
+            return dmResource::RESULT_OK;
+        }
+        dmDDF::FreeMessage(animation_set);
+        resource->m_AnimationSet = stripped_animation_set;
         return dmResource::RESULT_OK;
     }
 
@@ -32,6 +58,10 @@ namespace dmGameSystem
     {
         if (resource->m_AnimationSet != 0x0)
             dmDDF::FreeMessage(resource->m_AnimationSet);
+        if (resource->m_CompressedAnimationSet != 0x0)
+            dmRig::DeleteCompressedAnimationSet(resource->m_CompressedAnimationSet);
+        resource->m_AnimationSet = 0x0;
+        resource->m_CompressedAnimationSet = 0x0;
     }
 
     static dmResource::Result ResAnimationSetPreload(const dmResource::ResourcePreloadParams* params)
@@ -89,6 +119,8 @@ namespace dmGameSystem
 
     static ResourceResult RegisterResourceTypeAnimationSet(HResourceTypeContext ctx, HResourceType type)
     {
+        // The track compression only touches the animation set itself, so it can run on the load threads
+        ResourceTypeSetCreateThreadSafe(type, true);
         return (ResourceResult)dmResource::SetupType(ctx,
                                            type,
                                            0,
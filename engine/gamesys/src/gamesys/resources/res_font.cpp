@@ -368,6 +368,7 @@ namespace dmGameSystem
         glyph->m_DataImageWidth = inglyph->m_Width;
         glyph->m_DataImageHeight = inglyph->m_Height;
         font->m_DynamicGlyphs.Put(codepoint, glyph);
+        dmRender::InvalidateFontMapGlyph(font->m_FontMap, codepoint);
 
         dmResource::SetResourceSize(font->m_Resource, GetResourceSize(font));
         return dmResource::RESULT_OK;
@@ -380,6 +381,7 @@ namespace dmGameSystem
             return dmResource::RESULT_RESOURCE_NOT_FOUND;
 
         font->m_DynamicGlyphs.Erase(codepoint);
+        dmRender::InvalidateFontMapGlyph(font->m_FontMap, codepoint);
 
         DynamicGlyph* glyph = *glyphp;
         free((void*)glyph->m_Data);
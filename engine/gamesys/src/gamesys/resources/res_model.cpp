@@ -23,6 +23,7 @@
 #include <gamesys/model_ddf.h>
 
 #include <dlib/log.h>
+#include <dlib/math.h>
 #include <dlib/path.h>
 #include <dlib/dstrings.h>
 #include <dlib/memory.h>
@@ -31,6 +32,7 @@
 #include <dmsdk/dlib/transform.h>
 #include <rig/rig.h>
 #include <algorithm> // std::sort
+#include <float.h> // FLT_MAX
 
 namespace dmGameSystem
 {
@@ -135,6 +137,128 @@ namespace dmGameSystem
         return out_write_ptr;
     }
 
+    static const uint32_t LOD_MIN_TRIANGLE_COUNT             = 512; // Smaller meshes don't get any simplified levels
+    static const uint32_t LOD_GRID_SIZES[MODEL_MAX_LOD_COUNT] = { 0, 48, 16 }; // The grid cells per axis, for each simplified level
+    static const float    LOD_MAX_TRIANGLE_RATIO             = 0.75f; // A level is only kept if it removes enough triangles from the level before it
+
+    static void GetMeshIndices(const dmRigDDF::Mesh* mesh, dmArray<uint32_t>& out_indices)
+    {
+        bool is_32bit = mesh->m_IndicesFormat == dmRigDDF::INDEXBUFFER_FORMAT_32;
+        uint32_t index_count = mesh->m_Indices.m_Count / (is_32bit ? 4 : 2);
+        out_indices.SetCapacity(index_count);
+        out_indices.SetSize(index_count);
+        for (uint32_t i = 0; i < index_count; ++i)
+        {
+            out_indices[i] = is_32bit ? ((const uint32_t*) mesh->m_Indices.m_Data)[i] : ((const uint16_t*) mesh->m_Indices.m_Data)[i];
+        }
+    }
+
+    // Simplifies the triangles by vertex clustering. The bounds of the mesh are split into a grid, and the vertices of each cell
+    // are merged into the first vertex in it. The triangles that become degenerate are removed. Since only existing vertices
+    // are used, a level only needs its own indices.
+    static void SimplifyIndices(const float* positions, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, uint32_t grid_size, dmArray<uint32_t>& out_indices)
+    {
+        float aabb_min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float aabb_max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (uint32_t i = 0; i < vertex_count; ++i)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                aabb_min[c] = dmMath::Min(aabb_min[c], positions[i*3+c]);
+                aabb_max[c] = dmMath::Max(aabb_max[c], positions[i*3+c]);
+            }
+        }
+
+        float inv_cell_size[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            float extent = aabb_max[c] - aabb_min[c];
+            inv_cell_size[c] = extent > 0.0f ? (grid_size - 1) / extent : 0.0f;
+        }
+
+        dmArray<uint32_t> cells;
+        cells.SetCapacity(grid_size * grid_size * grid_size);
+        cells.SetSize(cells.Capacity());
+        memset(cells.Begin(), 0xFF, cells.Size() * sizeof(uint32_t));
+
+        dmArray<uint32_t> remap;
+        remap.SetCapacity(vertex_count);
+        remap.SetSize(vertex_count);
+        for (uint32_t i = 0; i < vertex_count; ++i)
+        {
+            uint32_t cell[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                cell[c] = (uint32_t) ((positions[i*3+c] - aabb_min[c]) * inv_cell_size[c] + 0.5f);
+            }
+            uint32_t& representative = cells[cell[0] + (cell[1] + cell[2] * grid_size) * grid_size];
+            if (representative == 0xFFFFFFFF)
+                representative = i;
+            remap[i] = representative;
+        }
+
+        out_indices.SetCapacity(index_count);
+        out_indices.SetSize(0);
+        for (uint32_t i = 0; i + 2 < index_count; i += 3)
+        {
+            uint32_t a = remap[indices[i+0]];
+            uint32_t b = remap[indices[i+1]];
+            uint32_t c = remap[indices[i+2]];
+            if (a == b || b == c || a == c)
+                continue;
+            out_indices.Push(a);
+            out_indices.Push(b);
+            out_indices.Push(c);
+        }
+    }
+
+    // Creates the simplified levels of a mesh, and appends their indices to lod_indices. The offsets of the levels
+    // are relative to the start of lod_indices. Returns the number of levels, including the full mesh.
+    static uint32_t CreateLods(const dmRigDDF::Mesh* mesh, ModelResourceLod lods[MODEL_MAX_LOD_COUNT], dmArray<uint32_t>& lod_indices)
+    {
+        uint32_t vertex_count = mesh->m_Positions.m_Count / 3;
+        if (mesh->m_Indices.m_Count == 0 || vertex_count == 0)
+            return 1;
+
+        dmArray<uint32_t> indices;
+        GetMeshIndices(mesh, indices);
+        if (indices.Size() / 3 < LOD_MIN_TRIANGLE_COUNT)
+            return 1;
+
+        uint32_t lod_count = 1;
+        uint32_t prev_index_count = indices.Size();
+        dmArray<uint32_t> simplified;
+        for (uint32_t lod = 1; lod < MODEL_MAX_LOD_COUNT; ++lod)
+        {
+            SimplifyIndices(mesh->m_Positions.m_Data, vertex_count, indices.Begin(), indices.Size(), LOD_GRID_SIZES[lod], simplified);
+            if (simplified.Empty() || simplified.Size() > prev_index_count * LOD_MAX_TRIANGLE_RATIO)
+                continue;
+
+            if (lod_indices.Remaining() < simplified.Size())
+                lod_indices.OffsetCapacity(simplified.Size() - lod_indices.Remaining());
+            lods[lod_count].m_IndexOffset = lod_indices.Size();
+            lods[lod_count].m_IndexCount  = simplified.Size();
+            lod_indices.PushArray(simplified.Begin(), simplified.Size());
+
+            prev_index_count = simplified.Size();
+            lod_count++;
+        }
+        return lod_count;
+    }
+
+    static void WriteIndices(const uint32_t* indices, uint32_t index_count, bool is_32bit, uint8_t* out)
+    {
+        if (is_32bit)
+        {
+            memcpy(out, indices, index_count * sizeof(uint32_t));
+            return;
+        }
+        for (uint32_t i = 0; i < index_count; ++i)
+        {
+            ((uint16_t*) out)[i] = (uint16_t) indices[i];
+        }
+    }
+
     static ModelResourceBuffers* CreateBuffers(dmGraphics::HContext context, const dmRigDDF::Mesh* ddf_mesh, dmArray<dmRig::RigModelVertex>& scratch_buffer)
     {
         ModelResourceBuffers* buffers = new ModelResourceBuffers;
@@ -171,20 +295,148 @@ namespace dmGameSystem
 
         buffers->m_IndexBuffer = 0;
         buffers->m_IndexCount = 0;
+        buffers->m_LodCount = 1;
         if (index_buffer != 0)
         {
             uint32_t index_type_size = dmGraphics::TYPE_UNSIGNED_INT == index_element_type ? 4 : 2;
-            buffers->m_IndexBuffer = dmGraphics::NewIndexBuffer(context, num_indices * index_type_size, index_buffer, dmGraphics::BUFFER_USAGE_STATIC_DRAW);
             buffers->m_IndexBufferElementType = index_element_type;
             buffers->m_IndexCount = num_indices;
+
+            // The simplified levels are stored after the indices of the full mesh
+            dmArray<uint32_t> lod_indices;
+            buffers->m_LodCount = CreateLods(ddf_mesh, buffers->m_Lods, lod_indices);
+            if (buffers->m_LodCount > 1)
+            {
+                dmArray<uint8_t> index_data;
+                index_data.SetCapacity((num_indices + lod_indices.Size()) * index_type_size);
+                index_data.SetSize(index_data.Capacity());
+                memcpy(index_data.Begin(), index_buffer, num_indices * index_type_size);
+                WriteIndices(lod_indices.Begin(), lod_indices.Size(), index_type_size == 4, index_data.Begin() + num_indices * index_type_size);
+                for (uint32_t lod = 1; lod < buffers->m_LodCount; ++lod)
+                {
+                    buffers->m_Lods[lod].m_IndexOffset += num_indices;
+                }
+                buffers->m_IndexBuffer = dmGraphics::NewIndexBuffer(context, index_data.Size(), index_data.Begin(), dmGraphics::BUFFER_USAGE_STATIC_DRAW);
+            }
+            else
+            {
+                buffers->m_IndexBuffer = dmGraphics::NewIndexBuffer(context, num_indices * index_type_size, index_buffer, dmGraphics::BUFFER_USAGE_STATIC_DRAW);
+            }
         }
+        buffers->m_Lods[0].m_IndexOffset = 0;
+        buffers->m_Lods[0].m_IndexCount  = buffers->m_IndexCount;
 
         return buffers;
     }
 
+    static bool CanShareBuffers(dmGraphics::HContext context, const ModelResource* resource)
+    {
+        // The meshes are drawn from the same buffers with multi-draw indirect, which needs indexed meshes
+        if (!dmGraphics::IsMultiDrawIndirectSupported(context) || resource->m_Meshes.Size() < 2)
+            return false;
+        for (uint32_t i = 0; i < resource->m_Meshes.Size(); ++i)
+        {
+            if (resource->m_Meshes[i].m_Mesh->m_Indices.m_Count == 0)
+                return false;
+        }
+        return true;
+    }
+
+    // Packs all meshes into one vertex buffer and one index buffer. The indices stay relative to the first vertex of each mesh.
+    static void CreateSharedBuffers(dmGraphics::HContext context, ModelResource* resource, dmArray<dmRig::RigModelVertex>& scratch_buffer)
+    {
+        uint32_t mesh_count   = resource->m_Meshes.Size();
+        uint32_t vertex_count = 0;
+        uint32_t index_count  = 0;
+        bool use_32bit_indices = false;
+        for (uint32_t i = 0; i < mesh_count; ++i)
+        {
+            const dmRigDDF::Mesh* mesh = resource->m_Meshes[i].m_Mesh;
+            bool is_32bit = mesh->m_IndicesFormat == dmRigDDF::INDEXBUFFER_FORMAT_32;
+            vertex_count += mesh->m_Positions.m_Count / 3;
+            index_count  += mesh->m_Indices.m_Count / (is_32bit ? 4 : 2);
+            use_32bit_indices |= is_32bit;
+        }
+
+        // The simplified levels of all meshes are stored after the indices of the full meshes
+        dmArray<uint32_t> lod_indices;
+        for (uint32_t i = 0; i < mesh_count; ++i)
+        {
+            ModelResourceBuffers* buffers = new ModelResourceBuffers;
+            memset(buffers, 0, sizeof(ModelResourceBuffers));
+            buffers->m_LodCount = CreateLods(resource->m_Meshes[i].m_Mesh, buffers->m_Lods, lod_indices);
+            resource->m_Meshes[i].m_Buffers = buffers;
+        }
+
+        uint32_t index_type_size = use_32bit_indices ? 4 : 2;
+        dmArray<uint8_t> index_buffer_data;
+        index_buffer_data.SetCapacity((index_count + lod_indices.Size()) * index_type_size);
+        index_buffer_data.SetSize(index_buffer_data.Capacity());
+        uint8_t* index_data = index_buffer_data.Begin();
+        WriteIndices(lod_indices.Begin(), lod_indices.Size(), use_32bit_indices, index_data + index_count * index_type_size);
+
+        scratch_buffer.SetCapacity(vertex_count);
+        scratch_buffer.SetSize(vertex_count);
+
+        dmRig::RigModelVertex* vertex_write_ptr = scratch_buffer.Begin();
+        uint32_t index_offset = 0;
+        for (uint32_t i = 0; i < mesh_count; ++i)
+        {
+            const dmRigDDF::Mesh* mesh = resource->m_Meshes[i].m_Mesh;
+            bool is_32bit = mesh->m_IndicesFormat == dmRigDDF::INDEXBUFFER_FORMAT_32;
+            uint32_t mesh_index_count = mesh->m_Indices.m_Count / (is_32bit ? 4 : 2);
+
+            ModelResourceBuffers* buffers     = resource->m_Meshes[i].m_Buffers;
+            buffers->m_VertexCount            = mesh->m_Positions.m_Count / 3;
+            buffers->m_IndexCount             = mesh_index_count;
+            buffers->m_IndexBufferElementType = use_32bit_indices ? dmGraphics::TYPE_UNSIGNED_INT : dmGraphics::TYPE_UNSIGNED_SHORT;
+            buffers->m_VertexOffset           = vertex_write_ptr - scratch_buffer.Begin();
+            buffers->m_IndexOffset            = index_offset;
+            buffers->m_SharedBuffers          = 1;
+            buffers->m_Lods[0].m_IndexOffset  = index_offset;
+            buffers->m_Lods[0].m_IndexCount   = mesh_index_count;
+            for (uint32_t lod = 1; lod < buffers->m_LodCount; ++lod)
+            {
+                buffers->m_Lods[lod].m_IndexOffset += index_count;
+            }
+
+            vertex_write_ptr = CreateVertexData(mesh, vertex_write_ptr);
+
+            if (use_32bit_indices == is_32bit)
+            {
+                memcpy(index_data + index_offset * index_type_size, mesh->m_Indices.m_Data, mesh_index_count * index_type_size);
+            }
+            else
+            {
+                const uint16_t* src = (const uint16_t*) mesh->m_Indices.m_Data;
+                uint32_t* dst = ((uint32_t*) index_data) + index_offset;
+                for (uint32_t j = 0; j < mesh_index_count; ++j)
+                {
+                    dst[j] = src[j];
+                }
+            }
+            index_offset += mesh_index_count;
+        }
+
+        dmGraphics::HVertexBuffer vertex_buffer = dmGraphics::NewVertexBuffer(context, vertex_count * sizeof(dmRig::RigModelVertex), scratch_buffer.Begin(), dmGraphics::BUFFER_USAGE_STATIC_DRAW);
+        dmGraphics::HIndexBuffer index_buffer   = dmGraphics::NewIndexBuffer(context, index_buffer_data.Size(), index_data, dmGraphics::BUFFER_USAGE_STATIC_DRAW);
+
+        for (uint32_t i = 0; i < mesh_count; ++i)
+        {
+            resource->m_Meshes[i].m_Buffers->m_VertexBuffer = vertex_buffer;
+            resource->m_Meshes[i].m_Buffers->m_IndexBuffer  = index_buffer;
+        }
+    }
+
     static void CreateBuffers(dmGraphics::HContext context, ModelResource* resource)
     {
         dmArray<dmRig::RigModelVertex> scratch_buffer;
+        if (CanShareBuffers(context, resource))
+        {
+            CreateSharedBuffers(context, resource, scratch_buffer);
+            return;
+        }
+
         for (uint32_t i = 0; i < resource->m_Meshes.Size(); ++i)
         {
             MeshInfo& info = resource->m_Meshes[i];
@@ -328,10 +580,13 @@ namespace dmGameSystem
         return result;
     }
 
-    static void ReleaseBuffers(ModelResourceBuffers* buffers)
+    static void ReleaseBuffers(ModelResourceBuffers* buffers, bool owns_buffers)
     {
-        dmGraphics::DeleteVertexBuffer(buffers->m_VertexBuffer);
-        dmGraphics::DeleteIndexBuffer(buffers->m_IndexBuffer);
+        if (owns_buffers)
+        {
+            dmGraphics::DeleteVertexBuffer(buffers->m_VertexBuffer);
+            dmGraphics::DeleteIndexBuffer(buffers->m_IndexBuffer);
+        }
         delete buffers;
     }
 
@@ -340,7 +595,11 @@ namespace dmGameSystem
         for (uint32_t i = 0; i < resource->m_Meshes.Size(); ++i)
         {
             MeshInfo& info = resource->m_Meshes[i];
-            ReleaseBuffers(info.m_Buffers);
+            if (info.m_Buffers)
+            {
+                // The shared buffers are owned by the first mesh
+                ReleaseBuffers(info.m_Buffers, !info.m_Buffers->m_SharedBuffers || i == 0);
+            }
         }
         resource->m_Meshes.SetSize(0);
 
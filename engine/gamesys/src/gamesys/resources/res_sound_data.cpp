@@ -12,12 +12,63 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include <stdlib.h>
 #include <string.h>
+#include <resource/resource.h>
 #include <sound/sound.h>
 #include "res_sound_data.h"
 
 namespace dmGameSystem
 {
+    // Sounds at least this large are streamed from the resource file while playing, if the sound type
+    // and the mount it's loaded from supports it, instead of keeping the whole file in memory
+    static const uint32_t SOUND_STREAM_THRESHOLD = 512 * 1024;
+
+    struct SoundDataStream
+    {
+        dmResource::HFactory m_Factory;
+        char*                m_Path;
+    };
+
+    static dmSound::Result StreamGetData(void* context, uint32_t offset, uint32_t size, void* out, uint32_t* out_size)
+    {
+        SoundDataStream* stream = (SoundDataStream*) context;
+        dmResource::Result r = dmResource::ReadResourcePartial(stream->m_Factory, stream->m_Path, offset, size, out, out_size);
+        return r == dmResource::RESULT_OK ? dmSound::RESULT_OK : dmSound::RESULT_INVALID_STREAM_DATA;
+    }
+
+    static void DeleteStream(SoundDataStream* stream)
+    {
+        if (stream)
+        {
+            free(stream->m_Path);
+            delete stream;
+        }
+    }
+
+    static SoundDataStream* NewStream(const dmResource::ResourceCreateParams* params, dmSound::SoundDataType type, dmSound::HSoundData* sound_data)
+    {
+        // Check that the resource can be read partially, and that it's the same data we just loaded
+        uint8_t header[16];
+        uint32_t nread = 0;
+        dmResource::Result r = dmResource::ReadResourcePartial(params->m_Factory, params->m_Filename, 0, sizeof(header), header, &nread);
+        if (r != dmResource::RESULT_OK || nread != sizeof(header) || memcmp(header, params->m_Buffer, sizeof(header)) != 0)
+        {
+            return 0;
+        }
+
+        SoundDataStream* stream = new SoundDataStream;
+        stream->m_Factory = params->m_Factory;
+        stream->m_Path = strdup(params->m_Filename);
+        dmSound::Result sr = dmSound::NewSoundDataStreaming(StreamGetData, stream, params->m_BufferSize, type, sound_data, dmResource::GetNameHash(params->m_Resource));
+        if (sr != dmSound::RESULT_OK)
+        {
+            DeleteStream(stream);
+            return 0;
+        }
+        return stream;
+    }
+
     static dmSound::SoundDataType TryToGetTypeFromBuffer(char* buffer, dmSound::SoundDataType default_type, uint32_t bufferSize)
     {
         dmSound::SoundDataType type = default_type;
@@ -38,6 +89,11 @@ namespace dmGameSystem
         {
             type = dmSound::SOUND_DATA_TYPE_WAV;
         };
+        // The first ogg page of an Opus stream holds only the "OpusHead" packet, right after the one byte segment table
+        if (type == dmSound::SOUND_DATA_TYPE_OGG_VORBIS && bufferSize >= 36 && memcmp(buffer + 28, "OpusHead", 8) == 0)
+        {
+            type = dmSound::SOUND_DATA_TYPE_OPUS;
+        }
         return type;
     }
 
@@ -52,16 +108,30 @@ namespace dmGameSystem
         {
             type = dmSound::SOUND_DATA_TYPE_OGG_VORBIS;
         }
+        else if (filename_len > 6 && strcmp(params->m_Filename + filename_len - 6, ".opusc") == 0)
+        {
+            type = dmSound::SOUND_DATA_TYPE_OPUS;
+        }
 
-        dmSound::Result r = dmSound::NewSoundData(params->m_Buffer, params->m_BufferSize, type, &sound_data, dmResource::GetNameHash(params->m_Resource));
-        if (r != dmSound::RESULT_OK)
+        SoundDataStream* stream = 0;
+        if (params->m_BufferSize >= SOUND_STREAM_THRESHOLD)
         {
-            return dmResource::RESULT_OUT_OF_RESOURCES;
+            stream = NewStream(params, type, &sound_data);
+        }
+
+        if (!stream)
+        {
+            dmSound::Result r = dmSound::NewSoundData(params->m_Buffer, params->m_BufferSize, type, &sound_data, dmResource::GetNameHash(params->m_Resource));
+            if (r != dmSound::RESULT_OK)
+            {
+                return dmResource::RESULT_OUT_OF_RESOURCES;
+            }
         }
 
         SoundDataResource* sound_data_res = new SoundDataResource();
 
         sound_data_res->m_SoundData = sound_data;
+        sound_data_res->m_Stream = stream;
         sound_data_res->m_Type = type;
 
         dmResource::SetResource(params->m_Resource, sound_data_res);
@@ -73,6 +143,8 @@ namespace dmGameSystem
     {
         SoundDataResource* sound_data_res = (SoundDataResource*) dmResource::GetResource(params->m_Resource);
         dmSound::Result r = dmSound::DeleteSoundData(sound_data_res->m_SoundData);
+        // The sound system is done with the stream once DeleteSoundData() has returned
+        DeleteStream(sound_data_res->m_Stream);
         delete sound_data_res;
         
         if (r != dmSound::RESULT_OK)
@@ -97,8 +169,10 @@ namespace dmGameSystem
 
         dmSound::HSoundData old_sound_data = sound_data_res->m_SoundData;
         dmSound::DeleteSoundData(old_sound_data);
+        DeleteStream(sound_data_res->m_Stream);
 
         sound_data_res->m_SoundData = sound_data;
+        sound_data_res->m_Stream = 0;
 
         dmResource::SetResource(params->m_Resource, sound_data_res);
         dmResource::SetResourceSize(params->m_Resource, dmSound::GetSoundResourceSize(sound_data));
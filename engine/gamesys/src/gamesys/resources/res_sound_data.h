@@ -25,8 +25,12 @@ namespace dmSound
 
 namespace dmGameSystem
 {
+    struct SoundDataStream;
+
     struct SoundDataResource {
         dmSound::HSoundData m_SoundData;
+        // Set if the sound data is streamed from the resource file
+        SoundDataStream* m_Stream;
         int m_Type;
     };
 
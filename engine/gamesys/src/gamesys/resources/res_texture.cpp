@@ -17,28 +17,70 @@
 
 #include <dmsdk/gamesys/resources/res_texture.h>
 
+#include <dlib/array.h>
 #include <dlib/log.h>
 #include <dlib/profile.h>
 #include <dlib/time.h>
 #include <dlib/math.h>
 #include <graphics/graphics.h>
+#include <resource/resource.h>
 
 namespace dmGameSystem
 {
     static const uint32_t MAX_MIPMAP_COUNT = 15; // 2^14 => 16384 (+1 for base mipmap)
 
+    const char* TEXTURE_STREAMING_BUDGET_KEY = "graphics.texture_streaming_budget";
+
+    static const uint32_t TEXTURE_STREAMING_RESIDENT_SIZE = 128; // Streamed textures are loaded with the mipmaps of this size and below
+    static const uint32_t TEXTURE_STREAMING_EVICT_FRAMES  = 120; // Frames a texture must be off-screen before its higher mipmaps may be evicted
+
     TextureResource::TextureResource()
     {
         memset(this, 0, sizeof(*this));
     }
 
+    static const uint32_t INVALID_ALTERNATIVE = 0xFFFFFFFF;
+
     struct ImageDesc
     {
         dmGraphics::TextureImage* m_DDFImage;
         uint8_t*                  m_DecompressedData[MAX_MIPMAP_COUNT];
         uint32_t                  m_DecompressedDataSize[MAX_MIPMAP_COUNT];
+        // The alternative to upload, picked (and transcoded) by SelectAlternative
+        uint32_t                  m_Alternative;
+        dmGraphics::TextureFormat m_Format;
+        uint32_t                  m_MipMapCount;
+        uint8_t                   m_AlternativeSelected : 1;
+    };
+
+    struct TextureStreamingInfo
+    {
+        // The image data is kept while there are mipmaps left to upload. It is freed once all mipmaps
+        // are resident, and loaded again from the resource file if they are evicted later.
+        dmResource::HFactory             m_Factory;
+        char*                            m_Path;
+        ImageDesc*                       m_ImageDesc;
+        dmGraphics::TextureImage::Image* m_Image;
+        uint32_t                         m_MipMapSizes[MAX_MIPMAP_COUNT];
+        dmGraphics::TextureFormat        m_Format;
+        uint32_t                         m_LastReportFrame;
+        uint16_t                         m_Width;
+        uint16_t                         m_Height;
+        uint8_t                          m_MipMapCount;
+        uint8_t                          m_ResidentMipMap;  // The highest resolution mipmap currently in the texture
+        uint8_t                          m_InitialMipMap;   // The mipmap the texture was loaded with, never evicted
+        uint8_t                          m_RequestedMipMap; // The mipmap needed for the on-screen size reported this frame
+    };
+
+    struct TextureStreamingContext
+    {
+        dmArray<TextureResource*> m_Textures;
+        uint32_t                  m_Budget;
+        uint32_t                  m_Frame;
     };
 
+    static TextureStreamingContext g_TextureStreaming;
+
 #define CASE_TT(_X, _T) case dmGraphics::TextureImage::_X: return dmGraphics::TEXTURE_ ## _T
     dmGraphics::TextureType TextureImageToTextureType(dmGraphics::TextureImage::Type type)
     {
@@ -91,8 +133,45 @@ namespace dmGameSystem
         return (dmGraphics::TextureFormat)-1;
     }
 
+    static void DestroyImage(ImageDesc* image_desc);
+
+    static void FreeStreamingImage(TextureStreamingInfo* info)
+    {
+        if (info->m_ImageDesc)
+        {
+            dmDDF::FreeMessage(info->m_ImageDesc->m_DDFImage);
+            DestroyImage(info->m_ImageDesc);
+            info->m_ImageDesc = 0;
+            info->m_Image     = 0;
+        }
+    }
+
+    static void StopTextureStreaming(TextureResource* resource)
+    {
+        TextureStreamingInfo* info = resource->m_StreamingInfo;
+        if (!info)
+        {
+            return;
+        }
+
+        for (uint32_t i = 0; i < g_TextureStreaming.m_Textures.Size(); ++i)
+        {
+            if (g_TextureStreaming.m_Textures[i] == resource)
+            {
+                g_TextureStreaming.m_Textures.EraseSwap(i);
+                break;
+            }
+        }
+
+        FreeStreamingImage(info);
+        free(info->m_Path);
+        delete info;
+        resource->m_StreamingInfo = 0;
+    }
+
     static void DestroyTexture(TextureResource* resource)
     {
+        StopTextureStreaming(resource);
         dmGraphics::DeleteTexture(resource->m_Texture);
         delete resource;
     }
@@ -120,19 +199,69 @@ namespace dmGameSystem
         dmGraphics::SetTextureAsync(texture, params, 0, (void*) 0);
     }
 
-    static dmResource::Result AcquireResources(const char* path, dmGraphics::HContext context, ImageDesc* image_desc,
-        ResTextureUploadParams upload_params, dmGraphics::HTexture texture, dmGraphics::HTexture* texture_out)
+    static bool CanStreamTexture(dmGraphics::HContext context, dmGraphics::TextureImage* ddf_image, dmGraphics::TextureImage::Image* image, uint32_t num_mips)
     {
-        DM_PROFILE_DYN(path, 0);
+        uint32_t max_size = dmGraphics::GetMaxTextureSize(context);
+        return ddf_image->m_Type == dmGraphics::TextureImage::TYPE_2D &&
+               ddf_image->m_Count == 1 &&
+               (ddf_image->m_UsageFlags == 0 || ddf_image->m_UsageFlags == dmGraphics::TEXTURE_USAGE_FLAG_SAMPLE) &&
+               num_mips > 1 &&
+               dmMath::Max(image->m_Width, image->m_Height) > TEXTURE_STREAMING_RESIDENT_SIZE &&
+               image->m_Width <= max_size && image->m_Height <= max_size;
+    }
 
-        dmResource::Result result = dmResource::RESULT_FORMAT_ERROR;
-        for (uint32_t i = 0; i < image_desc->m_DDFImage->m_Alternatives.m_Count; ++i)
+    static void GetMipMapData(ImageDesc* image_desc, dmGraphics::TextureImage::Image* image, uint32_t mipmap, const void** data, uint32_t* data_size)
+    {
+        if (image_desc->m_DecompressedData[mipmap] == 0)
+        {
+            *data      = &image->m_Data[image->m_MipMapOffset[mipmap]];
+            *data_size = image->m_MipMapSize[mipmap];
+        }
+        else
+        {
+            *data      = image_desc->m_DecompressedData[mipmap];
+            *data_size = image_desc->m_DecompressedDataSize[mipmap];
+        }
+    }
+
+    // The first alternative in a compressed format that the device can upload as is, e.g. native ASTC.
+    // It is picked over an earlier alternative that would have to be transcoded at load time.
+    // Returns 0 if there is no such alternative.
+    static uint32_t GetPreferredAlternative(dmGraphics::HContext context, dmGraphics::TextureImage* ddf_image)
+    {
+        for (uint32_t i = 0; i < ddf_image->m_Alternatives.m_Count; ++i)
+        {
+            dmGraphics::TextureImage::Image* image = &ddf_image->m_Alternatives[i];
+            dmGraphics::TextureFormat format = TextureImageToTextureFormat(image->m_Format);
+            if (!dmGraphics::IsFormatTranscoded(image->m_CompressionType) &&
+                dmGraphics::IsTextureFormatCompressed(format) &&
+                dmGraphics::IsTextureFormatSupported(context, format))
+            {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    // Picks the alternative to upload, and transcodes it if needed. This is called from the preload step,
+    // so that the transcoding happens on the load thread instead of blocking the main thread.
+    // The graphics context is only queried for the supported formats here.
+    static void SelectAlternative(const char* path, dmGraphics::HContext context, ImageDesc* image_desc)
+    {
+        DM_PROFILE(__FUNCTION__);
+
+        image_desc->m_AlternativeSelected = 1;
+        image_desc->m_Alternative         = INVALID_ALTERNATIVE;
+
+        uint32_t preferred = GetPreferredAlternative(context, image_desc->m_DDFImage);
+        for (uint32_t n = 0; n < image_desc->m_DDFImage->m_Alternatives.m_Count; ++n)
         {
+            // The preferred alternative is tried first, then the others in order
+            uint32_t i = n == 0 ? preferred : (n <= preferred ? n - 1 : n);
             dmGraphics::TextureImage::Image* image    = &image_desc->m_DDFImage->m_Alternatives[i];
             dmGraphics::TextureFormat original_format = TextureImageToTextureFormat(image->m_Format);
             dmGraphics::TextureFormat output_format   = original_format;
             uint32_t num_mips                         = image->m_MipMapOffset.m_Count;
-            bool specific_mip_requested               = upload_params.m_UploadSpecificMipmap;
 
             if (dmGraphics::IsFormatTranscoded(image->m_CompressionType))
             {
@@ -150,130 +279,182 @@ namespace dmGameSystem
                 continue;
             }
 
-            result = dmResource::RESULT_OK;
+            image_desc->m_Alternative = i;
+            image_desc->m_Format      = output_format;
+            image_desc->m_MipMapCount = num_mips;
+            return;
+        }
+    }
+
+    // Uploads the selected alternative of the image. A new texture is created if *texture_inout is 0
+    static dmResource::Result UploadImage(dmGraphics::HContext context, ImageDesc* image_desc, const ResTextureUploadParams& upload_params,
+        dmGraphics::HTexture* texture_inout, TextureStreamingInfo* streaming)
+    {
+        dmGraphics::TextureImage::Image* image  = &image_desc->m_DDFImage->m_Alternatives[image_desc->m_Alternative];
+        dmGraphics::TextureFormat output_format = image_desc->m_Format;
+        uint32_t num_mips                       = image_desc->m_MipMapCount;
+        bool specific_mip_requested             = upload_params.m_UploadSpecificMipmap;
+        dmGraphics::HTexture texture            = *texture_inout;
+
+        dmGraphics::TextureParams params;
+        dmGraphics::GetDefaultTextureFilters(context, params.m_MinFilter, params.m_MagFilter);
+
+        params.m_Format    = output_format;
+        params.m_Width     = image->m_Width;
+        params.m_Height    = image->m_Height;
+        params.m_Depth     = image_desc->m_DDFImage->m_Count;
+        params.m_X         = upload_params.m_X;
+        params.m_Y         = upload_params.m_Y;
+        params.m_SubUpdate = upload_params.m_SubUpdate;
+        params.m_MipMap    = specific_mip_requested ? upload_params.m_MipMap : 0;
+
+        // When streaming, the texture is created from the first mipmap that fits the resident size
+        uint32_t base_mip = 0;
+        if (streaming && !texture && !specific_mip_requested && CanStreamTexture(context, image_desc->m_DDFImage, image, num_mips))
+        {
+            while (base_mip + 1 < num_mips && dmMath::Max(dmGraphics::GetMipmapSize(image->m_Width, base_mip), dmGraphics::GetMipmapSize(image->m_Height, base_mip)) > TEXTURE_STREAMING_RESIDENT_SIZE)
+            {
+                base_mip++;
+            }
 
-            dmGraphics::TextureParams params;
-            dmGraphics::GetDefaultTextureFilters(context, params.m_MinFilter, params.m_MagFilter);
+            params.m_Width  = dmGraphics::GetMipmapSize(image->m_Width, base_mip);
+            params.m_Height = dmGraphics::GetMipmapSize(image->m_Height, base_mip);
 
-            params.m_Format    = output_format;
-            params.m_Width     = image->m_Width;
-            params.m_Height    = image->m_Height;
-            params.m_Depth     = image_desc->m_DDFImage->m_Count;
-            params.m_X         = upload_params.m_X;
-            params.m_Y         = upload_params.m_Y;
-            params.m_SubUpdate = upload_params.m_SubUpdate;
-            params.m_MipMap    = specific_mip_requested ? upload_params.m_MipMap : 0;
+            streaming->m_ImageDesc       = image_desc;
+            streaming->m_Image           = image;
+            streaming->m_Format          = output_format;
+            streaming->m_Width           = image->m_Width;
+            streaming->m_Height          = image->m_Height;
+            streaming->m_MipMapCount     = num_mips;
+            streaming->m_ResidentMipMap  = base_mip;
+            streaming->m_InitialMipMap   = base_mip;
+            streaming->m_RequestedMipMap = base_mip;
 
-            if (!texture)
+            for (uint32_t i = 0; i < num_mips; ++i)
             {
-                dmGraphics::TextureCreationParams creation_params;
+                const void* data;
+                GetMipMapData(image_desc, image, i, &data, &streaming->m_MipMapSizes[i]);
+            }
+        }
 
-                creation_params.m_Type           = TextureImageToTextureType(image_desc->m_DDFImage->m_Type);
-                creation_params.m_Width          = image->m_Width;
-                creation_params.m_Height         = image->m_Height;
-                creation_params.m_Depth          = image_desc->m_DDFImage->m_Count;
-                creation_params.m_OriginalWidth  = image->m_OriginalWidth;
-                creation_params.m_OriginalHeight = image->m_OriginalHeight;
-                creation_params.m_MipMapCount    = num_mips;
+        if (!texture)
+        {
+            dmGraphics::TextureCreationParams creation_params;
 
-                if (image_desc->m_DDFImage->m_UsageFlags != 0)
-                {
-                    creation_params.m_UsageHintBits = image_desc->m_DDFImage->m_UsageFlags;
-                }
-                texture = dmGraphics::NewTexture(context, creation_params);
-            }
-            else
-            {
-                uint16_t tex_width_full    = dmGraphics::GetTextureWidth(texture);
-                uint16_t tex_height_full   = dmGraphics::GetTextureHeight(texture);
-                uint16_t tex_width_mipmap  = dmGraphics::GetMipmapSize(tex_width_full, params.m_MipMap);
-                uint16_t tex_height_mipmap = dmGraphics::GetMipmapSize(tex_height_full, params.m_MipMap);
-                uint8_t  tex_mipmap_count  = dmGraphics::GetMipmapCount(dmMath::Max(tex_width_full, tex_height_full));
+            creation_params.m_Type           = TextureImageToTextureType(image_desc->m_DDFImage->m_Type);
+            creation_params.m_Width          = params.m_Width;
+            creation_params.m_Height         = params.m_Height;
+            creation_params.m_Depth          = image_desc->m_DDFImage->m_Count;
+            creation_params.m_OriginalWidth  = image->m_OriginalWidth;
+            creation_params.m_OriginalHeight = image->m_OriginalHeight;
+            creation_params.m_MipMapCount    = num_mips - base_mip;
 
-                if (specific_mip_requested && params.m_MipMap > tex_mipmap_count)
-                {
-                    dmLogError("Texture mipmap level %u exceeds maximum mipmap level %u.", params.m_MipMap, tex_mipmap_count);
-                    result = dmResource::RESULT_INVALID_DATA;
-                    break;
-                }
+            if (image_desc->m_DDFImage->m_UsageFlags != 0)
+            {
+                creation_params.m_UsageHintBits = image_desc->m_DDFImage->m_UsageFlags;
+            }
+            texture = dmGraphics::NewTexture(context, creation_params);
+            *texture_inout = texture;
+        }
+        else
+        {
+            uint16_t tex_width_full    = dmGraphics::GetTextureWidth(texture);
+            uint16_t tex_height_full   = dmGraphics::GetTextureHeight(texture);
+            uint16_t tex_width_mipmap  = dmGraphics::GetMipmapSize(tex_width_full, params.m_MipMap);
+            uint16_t tex_height_mipmap = dmGraphics::GetMipmapSize(tex_height_full, params.m_MipMap);
+            uint8_t  tex_mipmap_count  = dmGraphics::GetMipmapCount(dmMath::Max(tex_width_full, tex_height_full));
 
-                if (params.m_SubUpdate && ((params.m_X + params.m_Width) > tex_width_mipmap || (params.m_Y + params.m_Height) > tex_height_mipmap))
-                {
-                    dmLogError("Texture size %ux%u at offset %u,%u exceeds maximum texture size (%ux%u) for mipmap level %u.",
-                        params.m_Width, params.m_Height, params.m_X, params.m_Y, tex_width_mipmap, tex_height_mipmap, params.m_MipMap);
-                    result = dmResource::RESULT_INVALID_DATA;
-                    break;
-                }
+            if (specific_mip_requested && params.m_MipMap > tex_mipmap_count)
+            {
+                dmLogError("Texture mipmap level %u exceeds maximum mipmap level %u.", params.m_MipMap, tex_mipmap_count);
+                return dmResource::RESULT_INVALID_DATA;
             }
 
-            // Need to revert to simple bilinear filtering if no mipmaps were supplied
-            if (image->m_MipMapOffset.m_Count <= 1) {
-                if (params.m_MinFilter == dmGraphics::TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST) {
-                    params.m_MinFilter = dmGraphics::TEXTURE_FILTER_LINEAR;
-                } else if (params.m_MinFilter == dmGraphics::TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST) {
-                    params.m_MinFilter = dmGraphics::TEXTURE_FILTER_NEAREST;
-                }
+            if (params.m_SubUpdate && ((params.m_X + params.m_Width) > tex_width_mipmap || (params.m_Y + params.m_Height) > tex_height_mipmap))
+            {
+                dmLogError("Texture size %ux%u at offset %u,%u exceeds maximum texture size (%ux%u) for mipmap level %u.",
+                    params.m_Width, params.m_Height, params.m_X, params.m_Y, tex_width_mipmap, tex_height_mipmap, params.m_MipMap);
+                return dmResource::RESULT_INVALID_DATA;
             }
+        }
 
-            uint32_t max_size = dmGraphics::GetMaxTextureSize(context);
-            if (params.m_Width > max_size || params.m_Height > max_size) {
-                // dmGraphics::SetTextureAsync will fail if texture is too big; fall back to 1x1 texture.
-                dmLogError("Texture size %ux%u exceeds maximum supported texture size (%ux%u). Using blank texture.", params.m_Width, params.m_Height, max_size, max_size);
-                SetBlankTexture(texture, params);
-                break;
+        // Need to revert to simple bilinear filtering if no mipmaps were supplied
+        if (image->m_MipMapOffset.m_Count <= 1) {
+            if (params.m_MinFilter == dmGraphics::TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST) {
+                params.m_MinFilter = dmGraphics::TEXTURE_FILTER_LINEAR;
+            } else if (params.m_MinFilter == dmGraphics::TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST) {
+                params.m_MinFilter = dmGraphics::TEXTURE_FILTER_NEAREST;
             }
+        }
+
+        uint32_t max_size = dmGraphics::GetMaxTextureSize(context);
+        if (params.m_Width > max_size || params.m_Height > max_size) {
+            // dmGraphics::SetTextureAsync will fail if texture is too big; fall back to 1x1 texture.
+            dmLogError("Texture size %ux%u exceeds maximum supported texture size (%ux%u). Using blank texture.", params.m_Width, params.m_Height, max_size, max_size);
+            SetBlankTexture(texture, params);
+            return dmResource::RESULT_OK;
+        }
 
-            // This should not be happening if the max width/height check goes through
-            assert(image->m_MipMapOffset.m_Count <= MAX_MIPMAP_COUNT);
+        // This should not be happening if the max width/height check goes through
+        assert(image->m_MipMapOffset.m_Count <= MAX_MIPMAP_COUNT);
 
-            // If we requested to upload a specific mipmap, upload only that level
-            // It is expected that we only have offsets for that level in the image desc as well
-            // -> See script_resource.cpp::SetTexture
-            if (specific_mip_requested)
+        // If we requested to upload a specific mipmap, upload only that level
+        // It is expected that we only have offsets for that level in the image desc as well
+        // -> See script_resource.cpp::SetTexture
+        if (specific_mip_requested)
+        {
+            if (image_desc->m_DecompressedData[0] == 0)
             {
-                if (image_desc->m_DecompressedData[0] == 0)
-                {
-                    params.m_Data     = &image->m_Data[image->m_MipMapOffset[0]];
-                    params.m_DataSize = image->m_MipMapSize[0];
-                }
-                else
-                {
-                    params.m_Data     = image_desc->m_DecompressedData[0];
-                    params.m_DataSize = image_desc->m_DecompressedDataSize[0];
-                }
-                dmGraphics::SetTextureAsync(texture, params, 0, 0);
+                params.m_Data     = &image->m_Data[image->m_MipMapOffset[0]];
+                params.m_DataSize = image->m_MipMapSize[0];
             }
             else
             {
-                for (uint32_t i = 0; i < num_mips; ++i)
+                params.m_Data     = image_desc->m_DecompressedData[0];
+                params.m_DataSize = image_desc->m_DecompressedDataSize[0];
+            }
+            dmGraphics::SetTextureAsync(texture, params, 0, 0);
+        }
+        else
+        {
+            for (uint32_t i = base_mip; i < num_mips; ++i)
+            {
+                GetMipMapData(image_desc, image, i, &params.m_Data, &params.m_DataSize);
+
+                params.m_MipMap   = i - base_mip;
+                dmGraphics::SetTextureAsync(texture, params, 0, 0);
+
+                params.m_Width >>= 1;
+                params.m_Height >>= 1;
+                if (params.m_Width == 0)
                 {
-                    if (image_desc->m_DecompressedData[i] == 0)
-                    {
-                        params.m_Data     = &image->m_Data[image->m_MipMapOffset[i]];
-                        params.m_DataSize = image->m_MipMapSize[i];
-                    }
-                    else
-                    {
-                        params.m_Data     = image_desc->m_DecompressedData[i];
-                        params.m_DataSize = image_desc->m_DecompressedDataSize[i];
-                    }
-
-                    params.m_MipMap   = i;
-                    dmGraphics::SetTextureAsync(texture, params, 0, 0);
-
-                    params.m_Width >>= 1;
-                    params.m_Height >>= 1;
-                    if (params.m_Width == 0)
-                    {
-                        params.m_Width = 1;
-                    }
-                    if (params.m_Height == 0)
-                    {
-                        params.m_Height = 1;
-                    }
+                    params.m_Width = 1;
+                }
+                if (params.m_Height == 0)
+                {
+                    params.m_Height = 1;
                 }
             }
-            break;
+        }
+        return dmResource::RESULT_OK;
+    }
+
+    // If streaming is non-null and the texture qualifies, only the lowest mipmaps are uploaded and streaming is filled in.
+    static dmResource::Result AcquireResources(const char* path, dmGraphics::HContext context, ImageDesc* image_desc,
+        ResTextureUploadParams upload_params, dmGraphics::HTexture texture, dmGraphics::HTexture* texture_out, TextureStreamingInfo* streaming)
+    {
+        DM_PROFILE_DYN(path, 0);
+
+        // Images that didn't go through the preload step, e.g. from resource.set_texture, are transcoded here
+        if (!image_desc->m_AlternativeSelected)
+        {
+            SelectAlternative(path, context, image_desc);
+        }
+
+        dmResource::Result result = dmResource::RESULT_FORMAT_ERROR;
+        if (image_desc->m_Alternative != INVALID_ALTERNATIVE)
+        {
+            result = UploadImage(context, image_desc, upload_params, &texture, streaming);
         }
 
         if (result == dmResource::RESULT_FORMAT_ERROR)
@@ -340,7 +521,15 @@ namespace dmGameSystem
             return dmResource::RESULT_FORMAT_ERROR;
         }
 
-        ImageDesc* image_desc = CreateImage((dmGraphics::HContext) params->m_Context, texture_image);
+        dmGraphics::HContext graphics_context = (dmGraphics::HContext) params->m_Context;
+        ImageDesc* image_desc = CreateImage(graphics_context, texture_image);
+
+        // Transcode on the load thread, only the upload is left for the create step
+        if (texture_image->m_Alternatives.m_Count > 0)
+        {
+            SelectAlternative(params->m_Filename, graphics_context, image_desc);
+        }
+
         *params->m_PreloadData = image_desc;
         return dmResource::RESULT_OK;
     }
@@ -362,9 +551,14 @@ namespace dmGameSystem
         }
 
         texture_res->m_Uploading = 0;
-        ImageDesc* image_desc = (ImageDesc*) params->m_PreloadData;
-        dmDDF::FreeMessage(image_desc->m_DDFImage);
-        DestroyImage(image_desc);
+
+        // Streamed textures keep the image data to upload the higher mipmaps later
+        if (!texture_res->m_StreamingInfo)
+        {
+            ImageDesc* image_desc = (ImageDesc*) params->m_PreloadData;
+            dmDDF::FreeMessage(image_desc->m_DDFImage);
+            DestroyImage(image_desc);
+        }
         dmResource::SetResourceSize(params->m_Resource, dmGraphics::GetTextureResourceSize(texture_res->m_Texture));
         return dmResource::RESULT_OK;
     }
@@ -380,15 +574,33 @@ namespace dmGameSystem
         if (image_desc->m_DDFImage->m_Alternatives.m_Count > 0)
         {
             texture_res->m_Uploading = 1;
-            dmResource::Result r = AcquireResources(params->m_Filename, graphics_context, image_desc, upload_params, 0, &texture_res->m_Texture);
+
+            TextureStreamingInfo* streaming = 0;
+            if (g_TextureStreaming.m_Budget > 0)
+            {
+                streaming = new TextureStreamingInfo;
+                memset(streaming, 0, sizeof(TextureStreamingInfo));
+            }
+
+            dmResource::Result r = AcquireResources(params->m_Filename, graphics_context, image_desc, upload_params, 0, &texture_res->m_Texture, streaming);
             if (r == dmResource::RESULT_OK)
             {
+                if (streaming && streaming->m_ImageDesc)
+                {
+                    streaming->m_Factory         = params->m_Factory;
+                    streaming->m_Path            = strdup(params->m_Filename);
+                    texture_res->m_StreamingInfo = streaming;
+                    g_TextureStreaming.m_Textures.OffsetCapacity(g_TextureStreaming.m_Textures.Full() ? 16 : 0);
+                    g_TextureStreaming.m_Textures.Push(texture_res);
+                    streaming = 0;
+                }
                 dmResource::SetResource(params->m_Resource, texture_res);
             }
             else
             {
                 delete texture_res;
             }
+            delete streaming;
             return r;
         }
         else
@@ -453,9 +665,12 @@ namespace dmGameSystem
             upload_params = recreate_params->m_UploadParams;
         }
 
+        // The new data replaces the whole texture, so it is no longer streamed
+        StopTextureStreaming(texture_res);
+
         // Set up the new texture (version), wait for it to finish before issuing new requests
         SynchronizeTexture(texture, true);
-        dmResource::Result r = AcquireResources(params->m_Filename, graphics_context, image_desc, upload_params, texture, &texture);
+        dmResource::Result r = AcquireResources(params->m_Filename, graphics_context, image_desc, upload_params, texture, &texture, 0);
 
         // Texture might have changed
         texture_res->m_Texture = texture;
@@ -475,4 +690,245 @@ namespace dmGameSystem
         }
         return r;
     }
+    static uint32_t GetMipChainSize(const TextureStreamingInfo* info, uint32_t base_mip)
+    {
+        uint32_t size = 0;
+        for (uint32_t i = base_mip; i < info->m_MipMapCount; ++i)
+        {
+            size += info->m_MipMapSizes[i];
+        }
+        return size;
+    }
+
+    // Loads the image data of a streamed texture again, after it was freed when all mipmaps became resident
+    static bool LoadStreamingImage(dmGraphics::HContext context, TextureStreamingInfo* info)
+    {
+        DM_PROFILE(__FUNCTION__);
+
+        dmResource::LoadBufferType buffer;
+        uint32_t buffer_size;
+        dmResource::Result r = dmResource::LoadResourceFromBuffer(info->m_Factory, info->m_Path, info->m_Path, &buffer_size, &buffer);
+        if (r != dmResource::RESULT_OK)
+        {
+            dmLogError("Failed to load %s for texture streaming: %s", info->m_Path, dmResource::ResultToString(r));
+            return false;
+        }
+
+        dmGraphics::TextureImage* texture_image;
+        dmDDF::Result e = dmDDF::LoadMessage<dmGraphics::TextureImage>(buffer.Begin(), buffer_size, &texture_image);
+        if (e != dmDDF::RESULT_OK)
+        {
+            dmLogError("Failed to load %s for texture streaming", info->m_Path);
+            return false;
+        }
+
+        ImageDesc* image_desc = CreateImage(context, texture_image);
+        SelectAlternative(info->m_Path, context, image_desc);
+
+        // The mipmaps must be the ones already in the texture
+        if (image_desc->m_Alternative == INVALID_ALTERNATIVE || image_desc->m_Format != info->m_Format || image_desc->m_MipMapCount != info->m_MipMapCount)
+        {
+            dmLogError("The image data of %s no longer matches the streamed texture", info->m_Path);
+            dmDDF::FreeMessage(texture_image);
+            DestroyImage(image_desc);
+            return false;
+        }
+
+        info->m_ImageDesc = image_desc;
+        info->m_Image     = &texture_image->m_Alternatives[image_desc->m_Alternative];
+        return true;
+    }
+
+    // Replaces the texture contents with the mipmap chain starting at base_mip
+    static bool UploadMipChain(dmGraphics::HContext context, TextureResource* resource, uint32_t base_mip)
+    {
+        DM_PROFILE(__FUNCTION__);
+        TextureStreamingInfo* info = resource->m_StreamingInfo;
+
+        if (!info->m_ImageDesc && !LoadStreamingImage(context, info))
+        {
+            // Keep the mipmaps that are in the texture, rather than trying to load the data again every frame
+            info->m_InitialMipMap = info->m_ResidentMipMap;
+            return false;
+        }
+
+        dmGraphics::TextureParams params;
+        dmGraphics::GetDefaultTextureFilters(context, params.m_MinFilter, params.m_MagFilter);
+        params.m_Format = info->m_Format;
+        params.m_Width  = dmGraphics::GetMipmapSize(info->m_Width, base_mip);
+        params.m_Height = dmGraphics::GetMipmapSize(info->m_Height, base_mip);
+        params.m_Depth  = 1;
+
+        for (uint32_t i = base_mip; i < info->m_MipMapCount; ++i)
+        {
+            GetMipMapData(info->m_ImageDesc, info->m_Image, i, &params.m_Data, &params.m_DataSize);
+            params.m_MipMap = i - base_mip;
+            dmGraphics::SetTexture(resource->m_Texture, params);
+
+            params.m_Width  = dmMath::Max(1U, params.m_Width >> 1);
+            params.m_Height = dmMath::Max(1U, params.m_Height >> 1);
+        }
+
+        info->m_ResidentMipMap = base_mip;
+
+        // The backends can't change the base mipmap of a texture, so evicting means uploading the smaller
+        // mipmaps again. Until then there is no need to keep a CPU copy of a fully resident texture.
+        if (base_mip == 0)
+        {
+            FreeStreamingImage(info);
+        }
+        return true;
+    }
+
+    static uint32_t GetWantedMipMap(const TextureStreamingInfo* info)
+    {
+        if (g_TextureStreaming.m_Frame - info->m_LastReportFrame < TEXTURE_STREAMING_EVICT_FRAMES)
+        {
+            return dmMath::Min(info->m_RequestedMipMap, info->m_InitialMipMap);
+        }
+        return info->m_InitialMipMap;
+    }
+
+    // Picks the texture that holds more mipmaps than it needs and has been off-screen the longest
+    static TextureResource* FindEvictionCandidate(TextureResource* exclude)
+    {
+        TextureResource* candidate = 0;
+        uint32_t candidate_frame   = 0;
+        for (uint32_t i = 0; i < g_TextureStreaming.m_Textures.Size(); ++i)
+        {
+            TextureResource* resource  = g_TextureStreaming.m_Textures[i];
+            TextureStreamingInfo* info = resource->m_StreamingInfo;
+            if (resource == exclude || resource->m_Uploading || info->m_ResidentMipMap >= GetWantedMipMap(info))
+            {
+                continue;
+            }
+
+            if (!candidate || info->m_LastReportFrame < candidate_frame)
+            {
+                candidate       = resource;
+                candidate_frame = info->m_LastReportFrame;
+            }
+        }
+        return candidate;
+    }
+
+    // Used by the unit tests
+    bool GetTextureStreamingState(TextureResource* resource, uint32_t* resident_mipmap, bool* has_image)
+    {
+        TextureStreamingInfo* info = resource->m_StreamingInfo;
+        if (!info)
+        {
+            return false;
+        }
+        *resident_mipmap = info->m_ResidentMipMap;
+        *has_image       = info->m_ImageDesc != 0;
+        return true;
+    }
+
+    void SetTextureStreamingBudget(uint32_t budget)
+    {
+        g_TextureStreaming.m_Budget = budget;
+    }
+
+    void ReportTextureScreenSize(TextureResource* resource, float screen_size)
+    {
+        TextureStreamingInfo* info = resource ? resource->m_StreamingInfo : 0;
+        if (!info)
+        {
+            return;
+        }
+
+        // Pick the smallest mipmap that still covers the on-screen size
+        uint32_t full_size = dmMath::Max(info->m_Width, info->m_Height);
+        uint32_t mip       = 0;
+        while (mip + 1 < info->m_MipMapCount && (float) (full_size >> (mip + 1)) >= screen_size)
+        {
+            mip++;
+        }
+
+        if (info->m_LastReportFrame != g_TextureStreaming.m_Frame)
+        {
+            info->m_LastReportFrame = g_TextureStreaming.m_Frame;
+            info->m_RequestedMipMap = mip;
+        }
+        else
+        {
+            info->m_RequestedMipMap = dmMath::Min(info->m_RequestedMipMap, (uint8_t) mip);
+        }
+    }
+
+    void ReportTextureFullSize(TextureResource* resource)
+    {
+        TextureStreamingInfo* info = resource ? resource->m_StreamingInfo : 0;
+        if (info)
+        {
+            ReportTextureScreenSize(resource, (float) dmMath::Max(info->m_Width, info->m_Height));
+        }
+    }
+
+    void UpdateTextureStreaming(dmGraphics::HContext context)
+    {
+        DM_PROFILE(__FUNCTION__);
+
+        if (g_TextureStreaming.m_Textures.Empty())
+        {
+            g_TextureStreaming.m_Frame++;
+            return;
+        }
+
+        uint32_t resident_size  = 0;
+        TextureResource* target = 0;
+        uint32_t target_missing = 0;
+
+        for (uint32_t i = 0; i < g_TextureStreaming.m_Textures.Size(); ++i)
+        {
+            TextureResource* resource  = g_TextureStreaming.m_Textures[i];
+            TextureStreamingInfo* info = resource->m_StreamingInfo;
+            resident_size += GetMipChainSize(info, info->m_ResidentMipMap);
+
+            if (resource->m_Uploading || info->m_LastReportFrame != g_TextureStreaming.m_Frame)
+            {
+                continue;
+            }
+
+            uint32_t missing = info->m_ResidentMipMap > info->m_RequestedMipMap ? info->m_ResidentMipMap - info->m_RequestedMipMap : 0;
+            if (missing > target_missing)
+            {
+                target         = resource;
+                target_missing = missing;
+            }
+        }
+
+        // Only stream in a single mipmap level per frame to spread out the upload cost
+        if (target)
+        {
+            TextureStreamingInfo* info = target->m_StreamingInfo;
+            uint32_t new_mip           = info->m_ResidentMipMap - 1;
+            uint32_t cost              = GetMipChainSize(info, new_mip) - GetMipChainSize(info, info->m_ResidentMipMap);
+
+            while (resident_size + cost > g_TextureStreaming.m_Budget)
+            {
+                TextureResource* victim = FindEvictionCandidate(target);
+                if (!victim)
+                {
+                    break;
+                }
+
+                TextureStreamingInfo* victim_info = victim->m_StreamingInfo;
+                uint32_t victim_size              = GetMipChainSize(victim_info, victim_info->m_ResidentMipMap);
+                if (!UploadMipChain(context, victim, victim_info->m_ResidentMipMap + 1))
+                {
+                    continue;
+                }
+                resident_size -= victim_size - GetMipChainSize(victim_info, victim_info->m_ResidentMipMap);
+            }
+
+            if (resident_size + cost <= g_TextureStreaming.m_Budget)
+            {
+                UploadMipChain(context, target, new_mip);
+            }
+        }
+
+        g_TextureStreaming.m_Frame++;
+    }
 }
@@ -49,6 +49,18 @@ namespace dmGameSystem
     dmResource::Result ResTextureDestroy(const dmResource::ResourceDestroyParams* params);
 
     dmResource::Result ResTextureRecreate(const dmResource::ResourceRecreateParams* params);
+
+    /**
+     * Reports the on-screen size, in pixels, that a texture is drawn at this frame.
+     * For streamed textures this decides which mipmaps should be resident, see UpdateTextureStreaming.
+     */
+    void ReportTextureScreenSize(TextureResource* resource, float screen_size);
+
+    /**
+     * Reports that a texture is drawn this frame, by a component that doesn't know the on-screen size (e.g. sprites and gui).
+     * Streamed textures get all of their mipmaps while drawn, and may have the higher ones evicted once they are no longer drawn.
+     */
+    void ReportTextureFullSize(TextureResource* resource);
 }
 
 #endif
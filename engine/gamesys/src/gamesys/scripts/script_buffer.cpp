@@ -26,6 +26,7 @@
 
 #include <dmsdk/script/script.h>
 #include <dmsdk/gamesys/script.h>
+#include <script/script.h>
 
 #if defined(_WIN32)
 #include <malloc.h>
@@ -890,7 +891,7 @@ namespace dmGameSystem
         uint32_t count = index / stream->m_TypeCount;
         uint32_t component = index % stream->m_TypeCount;
         stream->m_Set(stream->m_Data, count * stream->m_Stride + component, luaL_checknumber(L, 3));
-        dmBuffer::UpdateContentVersion(stream->m_Buffer);
+        dmBuffer::UpdateContentVersionRange(stream->m_Buffer, count, 1);
         return 0;
     }
 
@@ -1160,6 +1161,11 @@ namespace dmGameSystem
         uint32_t* m_TypeHash;
     };
 
+    static void PushJsonBuffer(lua_State* L, dmBuffer::HBuffer buffer)
+    {
+        dmScript::PushBuffer(L, dmScript::LuaHBuffer(buffer, dmScript::OWNER_LUA));
+    }
+
     void ScriptBufferRegister(const ScriptLibContext& context)
     {
         lua_State* L = context.m_LuaState;
@@ -1197,6 +1203,9 @@ namespace dmGameSystem
 
         lua_pop(L, 1);
         assert(top == lua_gettop(L));
+
+        // Lets json.decode_stream decode numeric arrays into buffers
+        dmScript::RegisterJsonBufferPusher(PushJsonBuffer);
     }
 
 }
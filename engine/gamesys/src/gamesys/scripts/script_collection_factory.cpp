@@ -366,7 +366,7 @@ namespace dmGameSystem
 
         dmGameObject::InstanceIdMap instances;
         bool success = dmGameObject::SpawnFromCollection(collection, CompCollectionFactoryGetResource(component)->m_CollectionDesc, &prop_bufs,
-                                                         position, rotation, scale, &instances);
+                                                         position, rotation, scale, &instances, CompCollectionFactoryGetPools(world, component));
 
         lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
         dmScript::SetInstance(L);
@@ -399,6 +399,54 @@ namespace dmGameSystem
         return 1;
     }
 
+    /*# pools the game objects created by a collection factory
+     *
+     * Keeps the memory of deleted game objects created by the collection factory, and reuses it when the
+     * collection factory creates new ones. There is one pool per game object in the collection, so
+     * `size` and `preallocate` are per game object in the collection.
+     *
+     * The components are still created and the `init()` function is still called for each new game object,
+     * so the game objects start from their default state and properties, just as without a pool.
+     *
+     * @name collectionfactory.set_pool_size
+     * @param [url] [type:string|hash|url] the collection factory component
+     * @param size [type:number] the max number of deleted game objects to keep in each pool. 0 disables the pools
+     * @param [preallocate] [type:number] the number of game objects to allocate up front in each pool, 0 by default.
+     *
+     * @note
+     *   - The pools are created, and the preallocation happens, at the next [ref:collectionfactory.create]
+     *   - Changing the prototype with [ref:collectionfactory.set_prototype] or [ref:collectionfactory.unload] empties the pools
+     *
+     * @examples
+     *
+     * How to pool a collection of enemies, ten at a time
+     *
+     * ```lua
+     * function init(self)
+     *     collectionfactory.set_pool_size("#enemy_factory", 10)
+     * end
+     * ```
+     */
+    static int CollectionFactoryComp_SetPoolSize(lua_State* L)
+    {
+        int top = lua_gettop(L);
+
+        CollectionFactoryComponent* component;
+        dmScript::GetComponentFromLua(L, 1, COLLECTION_FACTORY_EXT, 0, (void**)&component, 0);
+
+        int size = luaL_checkinteger(L, 2);
+        int preallocate = luaL_optinteger(L, 3, 0);
+        if (size < 0 || preallocate < 0)
+        {
+            return luaL_error(L, "collectionfactory.set_pool_size expects non-negative sizes, got %d and %d", size, preallocate);
+        }
+
+        CompCollectionFactorySetPoolSize(component, (uint32_t)size, (uint32_t)preallocate);
+
+        assert(top == lua_gettop(L));
+        return 0;
+    }
+
     /*# changes the prototype for the collection factory
      *
      * Changes the prototype for the collection factory.
@@ -507,6 +555,7 @@ namespace dmGameSystem
         {"unload",            CollectionFactoryComp_Unload},
         {"get_status",        CollectionFactoryComp_GetStatus},
         {"set_prototype",     CollectionFactoryComp_SetPrototype},
+        {"set_pool_size",     CollectionFactoryComp_SetPoolSize},
         {0, 0}
     };
 
@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <assert.h>
 
+#include <dlib/array.h>
 #include <dlib/hash.h>
 #include <dlib/log.h>
 #include <dlib/math.h>
@@ -196,6 +197,18 @@ namespace dmGameSystem
     }
 
 
+    static dmVMath::Vector3 FactoryComp_CheckScale(lua_State* L, int index)
+    {
+        // We check for zero in the ToTransform/ResetScale in transform.h
+        dmVMath::Vector3* v = dmScript::ToVector3(L, index);
+        if (v != 0)
+        {
+            return *v;
+        }
+        float val = luaL_checknumber(L, index);
+        return dmVMath::Vector3(val, val, val);
+    }
+
     /*# make a factory create a new game object
      *
      * The URL identifies which factory should create the game object.
@@ -314,17 +327,7 @@ namespace dmGameSystem
         dmVMath::Vector3 scale;
         if (top >= 5 && !lua_isnil(L, 5))
         {
-            // We check for zero in the ToTransform/ResetScale in transform.h
-            dmVMath::Vector3* v = dmScript::ToVector3(L, 5);
-            if (v != 0)
-            {
-                scale = *v;
-            }
-            else
-            {
-                float val = luaL_checknumber(L, 5);
-                scale = dmVMath::Vector3(val, val, val);
-            }
+            scale = FactoryComp_CheckScale(L, 5);
         }
         else
         {
@@ -380,6 +383,240 @@ namespace dmGameSystem
         return 1;
     }
 
+    // Reads argument 'index' as either a single value or a table of 'count' values
+    static void FactoryComp_CheckPositions(lua_State* L, int index, uint32_t count, const dmVMath::Point3& default_value, dmArray<dmVMath::Point3>& out)
+    {
+        out.SetCapacity(count);
+        out.SetSize(count);
+        if (lua_istable(L, index))
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                lua_rawgeti(L, index, i + 1);
+                out[i] = dmVMath::Point3(*dmScript::CheckVector3(L, -1));
+                lua_pop(L, 1);
+            }
+            return;
+        }
+        dmVMath::Point3 value = lua_isnoneornil(L, index) ? default_value : dmVMath::Point3(*dmScript::CheckVector3(L, index));
+        for (uint32_t i = 0; i < count; ++i)
+            out[i] = value;
+    }
+
+    static void FactoryComp_CheckRotations(lua_State* L, int index, uint32_t count, const dmVMath::Quat& default_value, dmArray<dmVMath::Quat>& out)
+    {
+        out.SetCapacity(count);
+        out.SetSize(count);
+        if (lua_istable(L, index))
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                lua_rawgeti(L, index, i + 1);
+                out[i] = *dmScript::CheckQuat(L, -1);
+                lua_pop(L, 1);
+            }
+            return;
+        }
+        dmVMath::Quat value = lua_isnoneornil(L, index) ? default_value : *dmScript::CheckQuat(L, index);
+        for (uint32_t i = 0; i < count; ++i)
+            out[i] = value;
+    }
+
+    static void FactoryComp_CheckScales(lua_State* L, int index, uint32_t count, const dmVMath::Vector3& default_value, dmArray<dmVMath::Vector3>& out)
+    {
+        out.SetCapacity(count);
+        out.SetSize(count);
+        if (lua_istable(L, index))
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                lua_rawgeti(L, index, i + 1);
+                out[i] = FactoryComp_CheckScale(L, -1);
+                lua_pop(L, 1);
+            }
+            return;
+        }
+        dmVMath::Vector3 value = lua_isnoneornil(L, index) ? default_value : FactoryComp_CheckScale(L, index);
+        for (uint32_t i = 0; i < count; ++i)
+            out[i] = value;
+    }
+
+    /*# make a factory create several new game objects
+     *
+     * The URL identifies which factory should create the game objects.
+     * All game objects are created from the same prototype in a single batch, which is considerably
+     * cheaper than calling [ref:factory.create] once per object when spawning waves of objects.
+     *
+     * The position, rotation and scale parameters each take either a single value used for all
+     * created game objects, or a table with one value per game object.
+     *
+     * @name factory.create_many
+     * @param url [type:string|hash|url] the factory that should create the game objects.
+     * @param count [type:number] the number of game objects to create.
+     * @param [positions] [type:vector3|table] the position(s) of the new game objects, the position of the game object calling `factory.create_many()` is used by default, or if the value is `nil`.
+     * @param [rotations] [type:quaternion|table] the rotation(s) of the new game objects, the rotation of the game object calling `factory.create_many()` is used by default, or if the value is `nil`.
+     * @param [properties] [type:table] the properties defined in a script attached to the new game objects, shared by all of them.
+     * @param [scales] [type:number|vector3|table] the scale(s) of the new game objects (must be greater than 0), the scale of the game object containing the factory is used by default, or if the value is `nil`
+     * @return ids [type:table] the global ids of the spawned game objects, in creation order. Objects that could not be created are left out.
+     * @examples
+     *
+     * How to create a wave of enemies in a row:
+     *
+     * ```lua
+     * function init(self)
+     *     local positions = {}
+     *     for i = 1, 50 do
+     *         positions[i] = vmath.vector3(i * 20, 400, 0)
+     *     end
+     *     self.enemies = factory.create_many("#factory", 50, positions)
+     * end
+     * ```
+     */
+    static int FactoryComp_CreateMany(lua_State* L)
+    {
+        int top = lua_gettop(L);
+
+        dmGameObject::HInstance sender_instance = dmScript::CheckGOInstance(L);
+        dmGameObject::HCollection collection = dmGameObject::GetCollection(sender_instance);
+
+        HFactoryWorld world;
+        HFactoryComponent component;
+        dmMessage::URL receiver;
+        dmScript::GetComponentFromLua(L, 1, FACTORY_EXT, (dmGameObject::HComponentWorld*)&world, (dmGameObject::HComponent*)&component, &receiver);
+
+        int count = luaL_checkinteger(L, 2);
+        if (count < 0)
+        {
+            return luaL_error(L, "factory.create_many expects a non-negative count, got %d", count);
+        }
+
+        dmArray<dmVMath::Point3> positions;
+        dmArray<dmVMath::Quat> rotations;
+        dmArray<dmVMath::Vector3> scales;
+        FactoryComp_CheckPositions(L, 3, count, dmGameObject::GetWorldPosition(sender_instance), positions);
+        FactoryComp_CheckRotations(L, 4, count, dmGameObject::GetWorldRotation(sender_instance), rotations);
+        FactoryComp_CheckScales(L, 6, count, dmGameObject::GetWorldScale(sender_instance), scales);
+
+        dmGameObject::HPropertyContainer properties = 0;
+        if (top >= 5 && lua_istable(L, 5))
+        {
+            properties = dmGameObject::PropertyContainerCreateFromLua(L, 5);
+        }
+
+        dmArray<uint32_t> indices;
+        dmArray<dmhash_t> ids;
+        indices.SetCapacity(count);
+        indices.SetSize(dmGameObject::AcquireInstanceIndices(collection, count, indices.Begin()));
+        if (indices.Size() < (uint32_t)count)
+        {
+            dmLogError("factory.create_many can only create %u of %d gameobjects since the buffer is full. See `collection.max_instances` in game.project", indices.Size(), count);
+        }
+
+        uint32_t acquired = indices.Size();
+        ids.SetCapacity(acquired);
+        ids.SetSize(acquired);
+        for (uint32_t i = 0; i < acquired; ++i)
+        {
+            ids[i] = dmGameObject::ConstructInstanceId(indices[i]);
+        }
+
+        lua_createtable(L, acquired, 0);
+
+        // Without a calling game object instance, the objects are spawned through messages, as in factory.create
+        bool msg_passing = dmGameObject::GetInstanceFromLua(L) == 0x0;
+        if (msg_passing)
+        {
+            for (uint32_t i = 0; i < acquired; ++i)
+            {
+                FactoryComp_CreateWithMessage(L, collection, &receiver, indices[i], ids[i], properties, positions[i], rotations[i], scales[i]);
+                // We currently don't know if the creation succeeds
+                dmScript::PushHash(L, ids[i]);
+                lua_rawseti(L, -2, i + 1);
+            }
+        }
+        else if (acquired > 0)
+        {
+            // Since the spawning will invoke any scripts on the new instances,
+            // we need a way to restore the state
+            dmScript::GetInstance(L);
+            int ref = dmScript::Ref(L, LUA_REGISTRYINDEX);
+
+            dmArray<dmGameObject::HInstance> instances;
+            instances.SetCapacity(acquired);
+            instances.SetSize(acquired);
+            CompFactorySpawnBatch(world, component, collection, acquired, indices.Begin(), ids.Begin(),
+                                  positions.Begin(), rotations.Begin(), scales.Begin(), properties, instances.Begin());
+
+            lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+            dmScript::SetInstance(L);
+            dmScript::Unref(L, LUA_REGISTRYINDEX, ref);
+
+            int n = 0;
+            for (uint32_t i = 0; i < acquired; ++i)
+            {
+                if (instances[i] != 0)
+                {
+                    dmScript::PushHash(L, ids[i]);
+                    lua_rawseti(L, -2, ++n);
+                }
+            }
+        }
+
+        dmGameObject::PropertyContainerDestroy(properties);
+
+        assert(top + 1 == lua_gettop(L));
+        return 1;
+    }
+
+    /*# pools the game objects created by a factory
+     *
+     * Keeps the memory of deleted game objects created by the factory, and reuses it when the factory
+     * creates new ones. This avoids the allocations and prototype reference counting when repeatedly
+     * creating and deleting the same kind of game objects, such as bullets or effects.
+     *
+     * The components are still created and the `init()` function is still called for each new game object,
+     * so the game objects start from their default state and properties, just as without a pool.
+     *
+     * @name factory.set_pool_size
+     * @param [url] [type:string|hash|url] the factory component
+     * @param size [type:number] the max number of deleted game objects to keep in the pool. 0 disables the pool
+     * @param [preallocate] [type:number] the number of game objects to allocate up front, 0 by default.
+     *
+     * @note
+     *   - The preallocation happens as soon as the prototype is loaded
+     *   - Changing the prototype with [ref:factory.set_prototype] or [ref:factory.unload] empties the pool
+     *
+     * @examples
+     *
+     * How to pool the bullets of a gun
+     *
+     * ```lua
+     * function init(self)
+     *     factory.set_pool_size("#bullet_factory", 64, 32)
+     * end
+     * ```
+     */
+    static int FactoryComp_SetPoolSize(lua_State* L)
+    {
+        int top = lua_gettop(L);
+
+        HFactoryWorld world;
+        HFactoryComponent component;
+        dmScript::GetComponentFromLua(L, 1, FACTORY_EXT, (dmGameObject::HComponentWorld*)&world, (dmGameObject::HComponent*)&component, 0);
+
+        int size = luaL_checkinteger(L, 2);
+        int preallocate = luaL_optinteger(L, 3, 0);
+        if (size < 0 || preallocate < 0)
+        {
+            return luaL_error(L, "factory.set_pool_size expects non-negative sizes, got %d and %d", size, preallocate);
+        }
+
+        CompFactorySetPoolSize(world, component, (uint32_t)size, (uint32_t)preallocate);
+
+        assert(top == lua_gettop(L));
+        return 0;
+    }
+
     /*# changes the prototype for the factory
      *
      * Changes the prototype for the factory.
@@ -481,10 +718,12 @@ namespace dmGameSystem
     static const luaL_reg FACTORY_COMP_FUNCTIONS[] =
     {
         {"create",            FactoryComp_Create},
+        {"create_many",       FactoryComp_CreateMany},
         {"load",              FactoryComp_Load},
         {"unload",            FactoryComp_Unload},
         {"get_status",        FactoryComp_GetStatus},
         {"set_prototype",     FactoryComp_SetPrototype},
+        {"set_pool_size",     FactoryComp_SetPoolSize},
         {0, 0}
     };
 
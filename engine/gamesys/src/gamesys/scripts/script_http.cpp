@@ -83,7 +83,7 @@ namespace dmGameSystem
      * : [type:table] The response data. Contains the fields:
      *
      * - [type:number] `status`: the status of the response
-     * - [type:string] `response`: the response data (if not saved on disc)
+     * - [type:string|buffer] `response`: the response data (if not saved on disc). A buffer if the option `response_buffer` is true
      * - [type:table] `headers`: all the returned headers
      * - [type:string] `path`: the stored path (if saved to disc)
      * - [type:string] `error`: if any unforeseen errors occurred (e.g. file I/O)
@@ -99,6 +99,7 @@ namespace dmGameSystem
      * - [type:boolean] `ignore_cache`: don't return cached data if we get a 304. [icon:attention] Not available in HTML5 build
      * - [type:boolean] `chunked_transfer`: use chunked transfer encoding for https requests larger than 16kb. Defaults to true. [icon:attention] Not available in HTML5 build
      * - [type:boolean] `report_progress`: when it is true, the amount of bytes sent and/or received for a request will be passed into the callback function
+     * - [type:boolean] `response_buffer`: when it is true, the response data is returned as a buffer with a single "data" stream of uint8, instead of a string. Large responses then don't have to be copied into Lua strings
      *
      *
      * @examples
@@ -203,6 +204,7 @@ namespace dmGameSystem
             bool ignore_cache = false;
             bool chunked_transfer = true;
             bool report_progress = false;
+            uint32_t response_type = dmHttpService::RESPONSE_TYPE_STRING;
             if (top > 5 && !lua_isnil(L, 6)) {
                 luaL_checktype(L, 6, LUA_TTABLE);
                 lua_pushvalue(L, 6);
@@ -229,6 +231,10 @@ namespace dmGameSystem
                     {
                         report_progress = lua_toboolean(L, -1);
                     }
+                    else if (strcmp(attr, "response_buffer") == 0)
+                    {
+                        response_type = lua_toboolean(L, -1) ? dmHttpService::RESPONSE_TYPE_BUFFER : dmHttpService::RESPONSE_TYPE_STRING;
+                    }
 
                     lua_pop(L, 1);
                 }
@@ -259,7 +265,8 @@ namespace dmGameSystem
             dmMessage::ResetURL(&receiver);
             receiver.m_Socket = dmHttpService::GetSocket(g_Service);
 
-            dmMessage::Result r = dmMessage::Post(&sender, &receiver, dmHttpDDF::HttpRequest::m_DDFHash, 0, (uintptr_t)callback, (uintptr_t) dmHttpDDF::HttpRequest::m_DDFDescriptor, buf, post_len, 0);
+            // The response type isn't part of the HttpRequest message, and is passed as user data 1
+            dmMessage::Result r = dmMessage::Post(&sender, &receiver, dmHttpDDF::HttpRequest::m_DDFHash, (uintptr_t)response_type, (uintptr_t)callback, (uintptr_t) dmHttpDDF::HttpRequest::m_DDFDescriptor, buf, post_len, 0);
             if (r != dmMessage::RESULT_OK) {
                 dmLogError("Failed to create HTTP request");
             }
@@ -301,6 +308,7 @@ namespace dmGameSystem
             {
                 params.m_ThreadCount = dmConfigFile::GetInt(config_file, "network.http_thread_count", params.m_ThreadCount);
                 params.m_UseHttpCache = dmConfigFile::GetInt(config_file, "network.http_cache_enabled", params.m_UseHttpCache);
+                params.m_WarmupUrls = dmConfigFile::GetString(config_file, "network.http_warmup_urls", 0);
             }
 
         #if defined(DM_NO_HTTP_CACHE)
@@ -55,6 +55,7 @@ namespace dmGameSystem
         void*           m_RequestData;
         const char*     m_Path;
         int             m_Callback;
+        uint32_t        m_ResponseType;
     };
 
     struct RequestParams
@@ -84,7 +85,7 @@ namespace dmGameSystem
 
     static void MessageDestroyCallback(dmMessage::Message* message)
     {
-        dmHttpDDF::HttpResponse* response = (dmHttpDDF::HttpResponse*)message->m_Data;
+        dmHttpDDF::HttpResponse* response = &((dmHttpService::Response*)message->m_Data)->m_DDF;
         free((void*) response->m_Headers);
         free((void*) response->m_Response);
         if (response->m_Path)
@@ -97,7 +98,9 @@ namespace dmGameSystem
                              const char* headers, uint32_t headers_length,
                              const char* response, uint32_t response_length)
     {
-        dmHttpDDF::HttpResponse resp;
+        dmHttpService::Response message;
+        message.m_ResponseType = ctx->m_ResponseType;
+        dmHttpDDF::HttpResponse& resp = message.m_DDF;
         resp.m_Status = status;
         resp.m_Headers = (uint64_t) headers;
         resp.m_HeadersLength = headers_length;
@@ -110,7 +113,7 @@ namespace dmGameSystem
         resp.m_Response = (uint64_t) malloc(response_length);
         memcpy((void*) resp.m_Response, response, response_length);
 
-        if (dmMessage::RESULT_OK != dmMessage::Post(0, &ctx->m_Requester, dmHttpDDF::HttpResponse::m_DDFHash, 0, (uintptr_t)ctx->m_Callback, (uintptr_t) dmHttpDDF::HttpResponse::m_DDFDescriptor, &resp, sizeof(resp), MessageDestroyCallback) )
+        if (dmMessage::RESULT_OK != dmMessage::Post(0, &ctx->m_Requester, dmHttpDDF::HttpResponse::m_DDFHash, 0, (uintptr_t)ctx->m_Callback, (uintptr_t) dmHttpDDF::HttpResponse::m_DDFDescriptor, &message, sizeof(message), MessageDestroyCallback) )
         {
             free((void*) resp.m_Headers);
             free((void*) resp.m_Response);
@@ -154,6 +157,7 @@ namespace dmGameSystem
 
         int callback = 0;
         const char* path = 0;
+        uint32_t response_type = dmHttpService::RESPONSE_TYPE_STRING;
         dmMessage::URL sender;
         if (dmScript::GetURL(L, &sender)) {
             RequestParams request_params;
@@ -220,6 +224,10 @@ namespace dmGameSystem
                     {
                         path = luaL_checkstring(L, -1);
                     }
+                    else if (strcmp(attr, "response_buffer") == 0)
+                    {
+                        response_type = lua_toboolean(L, -1) ? dmHttpService::RESPONSE_TYPE_BUFFER : dmHttpService::RESPONSE_TYPE_STRING;
+                    }
                     lua_pop(L, 1);
                 }
                 lua_pop(L, 1);
@@ -230,6 +238,7 @@ namespace dmGameSystem
             ctx->m_Requester = sender;
             ctx->m_RequestData = request_params.m_SendData;
             ctx->m_Path = 0;
+            ctx->m_ResponseType = response_type;
             if (path)
             {
                 size_t length = strlen(path) + 1;
@@ -19,6 +19,7 @@
 #include <dlib/log.h>
 #include <dlib/path.h>
 #include <dlib/sys.h>
+#include <dmsdk/gamesys/script.h>
 
 namespace dmGameSystem
 {
@@ -52,7 +53,8 @@ namespace dmGameSystem
     dmScript::Result HttpResponseDecoder(lua_State* L, const dmDDF::Descriptor* desc, const char* data)
     {
         assert(desc == dmHttpDDF::HttpResponse::m_DDFDescriptor);
-        dmHttpDDF::HttpResponse* resp = (dmHttpDDF::HttpResponse*) data;
+        const dmHttpService::Response* message = (const dmHttpService::Response*) data;
+        const dmHttpDDF::HttpResponse* resp = &message->m_DDF;
 
         char* headers = (char*) resp->m_Headers;
         char* response = (char*) resp->m_Response;
@@ -74,6 +76,27 @@ namespace dmGameSystem
 
             lua_pushstring(L, resp->m_Path);
             lua_setfield(L, -2, "path");
+        } else if (message->m_ResponseType == dmHttpService::RESPONSE_TYPE_BUFFER) {
+            // The buffer is created here, as the buffer api may only be used from the main thread
+            dmBuffer::StreamDeclaration streams_decl[] = {{ dmHashString64("data"), dmBuffer::VALUE_TYPE_UINT8, 1 }};
+            dmBuffer::HBuffer buffer = 0;
+            void* buffer_data = 0;
+            uint32_t buffer_datasize = 0;
+            if (dmBuffer::RESULT_OK == dmBuffer::Create(resp->m_ResponseLength, streams_decl, 1, &buffer) &&
+                dmBuffer::RESULT_OK == dmBuffer::GetBytes(buffer, &buffer_data, &buffer_datasize))
+            {
+                memcpy(buffer_data, response, resp->m_ResponseLength);
+                dmScript::LuaHBuffer luabuf(buffer, dmScript::OWNER_LUA);
+                dmScript::PushBuffer(L, luabuf);
+                lua_setfield(L, -2, "response");
+            }
+            else
+            {
+                if (buffer)
+                    dmBuffer::Destroy(buffer);
+                lua_pushstring(L, "Failed to create response buffer");
+                lua_setfield(L, -2, "error");
+            }
         } else {
             lua_pushlstring(L, response, resp->m_ResponseLength);
             lua_setfield(L, -2, "response");
@@ -19,9 +19,11 @@
 
 #include <dlib/log.h>
 #include <dlib/image.h>
+#include <dlib/job_thread.h>
 #include <extension/extension.h>
 
 #include "script_buffer.h"
+#include "script_image.h"
 
 #include "../gamesys.h"
 
@@ -98,6 +100,63 @@ namespace dmGameSystem
         lua_rawset(L, -3);
     }
 
+    struct ImageModule
+    {
+        dmJobThread::HContext m_JobThread;
+        uint32_t              m_NextRequestId;
+    } g_ImageModule;
+
+    static void CheckLoadOptions(lua_State* L, int index, bool* premult, bool* flip_vertically, bool* as_buffer)
+    {
+        // Parse as options table
+        if (lua_istable(L, index))
+        {
+            lua_pushvalue(L, index);
+
+            lua_getfield(L, -1, "premultiply_alpha");
+            if (!lua_isnil(L, -1))
+                *premult = dmScript::CheckBoolean(L, -1);
+            lua_pop(L, 1);
+
+            lua_getfield(L, -1, "flip_vertically");
+            if (!lua_isnil(L, -1))
+                *flip_vertically = dmScript::CheckBoolean(L, -1);
+            lua_pop(L, 1);
+
+            if (as_buffer)
+            {
+                lua_getfield(L, -1, "as_buffer");
+                if (!lua_isnil(L, -1))
+                    *as_buffer = dmScript::CheckBoolean(L, -1);
+                lua_pop(L, 1);
+            }
+
+            lua_pop(L, 1);
+        }
+        // backwards compatability
+        else
+        {
+            *premult = dmScript::CheckBoolean(L, index);
+        }
+    }
+
+    // Creates a buffer that the image can be decoded straight into
+    static dmBuffer::HBuffer CreateImageBuffer(const dmImage::Image& image, uint8_t** out_data, uint32_t* out_size)
+    {
+        uint8_t bytes_per_pixel = dmImage::BytesPerPixel(image.m_Type);
+
+        dmBuffer::StreamDeclaration streams_decl[] = {
+            { dmHashString64("data"), dmBuffer::VALUE_TYPE_UINT8, bytes_per_pixel }
+        };
+
+        dmBuffer::HBuffer buffer = 0;
+        if (dmBuffer::Create(image.m_Width * image.m_Height, streams_decl, 1, &buffer) != dmBuffer::RESULT_OK)
+            return 0;
+
+        dmBuffer::GetBytes(buffer, (void**)out_data, out_size);
+        return buffer;
+    }
+
     /*# load image from buffer
     * Load image (PNG or JPEG) from buffer.
     *
@@ -146,28 +205,7 @@ namespace dmGameSystem
 
         if (top >= 2)
         {
-            // Parse as options table
-            if (lua_istable(L, 2))
-            {
-                lua_pushvalue(L, 2);
-
-                lua_getfield(L, -1, "premultiply_alpha");
-                if (!lua_isnil(L, -1))
-                    premult = dmScript::CheckBoolean(L, -1);
-                lua_pop(L, 1);
-
-                lua_getfield(L, -1, "flip_vertically");
-                if (!lua_isnil(L, -1))
-                    flip_vertically = dmScript::CheckBoolean(L, -1);
-                lua_pop(L, 1);
-
-                lua_pop(L, 1);
-            }
-            // backwards compatability
-            else
-            {
-                premult = dmScript::CheckBoolean(L, 2);
-            }
+            CheckLoadOptions(L, 2, &premult, &flip_vertically, 0);
         }
 
         dmImage::Image image;
@@ -257,70 +295,38 @@ namespace dmGameSystem
 
         if (top >= 2)
         {
-            // Parse as options table
-            if (lua_istable(L, 2))
-            {
-                lua_pushvalue(L, 2);
-
-                lua_getfield(L, -1, "premultiply_alpha");
-                if (!lua_isnil(L, -1))
-                    premult = dmScript::CheckBoolean(L, -1);
-                lua_pop(L, 1);
-
-                lua_getfield(L, -1, "flip_vertically");
-                if (!lua_isnil(L, -1))
-                    flip_vertically = dmScript::CheckBoolean(L, -1);
-                lua_pop(L, 1);
-
-                lua_pop(L, 1);
-            }
-            // backwards compatability
-            else
-            {
-                premult = dmScript::CheckBoolean(L, 2);
-            }
+            CheckLoadOptions(L, 2, &premult, &flip_vertically, 0);
         }
 
+        // The size is known up front, so the image is decoded straight into the buffer
         dmImage::Image image;
-        dmImage::Result r = dmImage::Load(buffer, buffer_len, premult, flip_vertically, &image);
-        if (r == dmImage::RESULT_OK) {
+        dmBuffer::HBuffer image_buffer = 0;
+        dmImage::Result r = dmImage::GetInfo(buffer, buffer_len, &image.m_Width, &image.m_Height, &image.m_Type);
+        if (r == dmImage::RESULT_OK)
+        {
+            uint8_t* buffer_data     = 0;
+            uint32_t buffer_datasize = 0;
+            image_buffer = CreateImageBuffer(image, &buffer_data, &buffer_datasize);
+            r = image_buffer ? dmImage::LoadInto(buffer, buffer_len, premult, flip_vertically, buffer_data, buffer_datasize, &image) : dmImage::RESULT_IMAGE_ERROR;
+        }
 
-            uint8_t bytes_per_pixel = dmImage::BytesPerPixel(image.m_Type);
-            if (bytes_per_pixel == 0) {
-                dmImage::Free(&image);
-                luaL_error(L, "unknown image type %d", image.m_Type);
-            }
+        if (r == dmImage::RESULT_OK) {
 
             lua_newtable(L);
 
             PushImageParameters(L, image);
 
-            uint32_t imagesize = image.m_Width * image.m_Height;
-            uint32_t datasize = bytes_per_pixel * imagesize;
-
             lua_pushliteral(L, "buffer");
 
-            dmBuffer::StreamDeclaration streams_decl[] = {
-                { dmHashString64("data"), dmBuffer::VALUE_TYPE_UINT8, bytes_per_pixel }
-            };
-
-            dmBuffer::HBuffer buffer = 0;
-            dmBuffer::Create(imagesize, streams_decl, 1, &buffer);
-
-            uint8_t* buffer_data     = 0;
-            uint32_t buffer_datasize = 0;
-            dmBuffer::GetBytes(buffer, (void**)&buffer_data, &buffer_datasize);
-            memcpy(buffer_data, image.m_Buffer, datasize);
-
-            dmScript::LuaHBuffer luabuf(buffer, dmScript::OWNER_LUA);
+            dmScript::LuaHBuffer luabuf(image_buffer, dmScript::OWNER_LUA);
             dmScript::PushBuffer(L, luabuf);
 
             lua_rawset(L, -3);
-
-            dmImage::Free(&image);
         }
         else
         {
+            if (image_buffer)
+                dmBuffer::Destroy(image_buffer);
             dmLogWarning("failed to load image (%d)", r);
             lua_pushnil(L);
         }
@@ -329,10 +335,218 @@ namespace dmGameSystem
         return 1;
     }
 
+    struct LoadImageRequest
+    {
+        dmScript::LuaCallbackInfo* m_CallbackInfo;
+        uint8_t*                   m_Data;  // A copy of the encoded image, the Lua string may be collected
+        uint32_t                   m_DataSize;
+        dmImage::Image             m_Image;
+        dmBuffer::HBuffer          m_Buffer;
+        uint8_t*                   m_BufferData;
+        uint32_t                   m_BufferDataSize;
+        uint32_t                   m_Id;
+        uint8_t                    m_Premult : 1;
+        uint8_t                    m_FlipVertically : 1;
+    };
+
+    // Called from a job thread
+    static int LoadImageJob(void* context, void* data)
+    {
+        LoadImageRequest* request = (LoadImageRequest*) context;
+        if (request->m_Buffer)
+            return (int) dmImage::LoadInto(request->m_Data, request->m_DataSize, request->m_Premult, request->m_FlipVertically, request->m_BufferData, request->m_BufferDataSize, &request->m_Image);
+        return (int) dmImage::Load(request->m_Data, request->m_DataSize, request->m_Premult, request->m_FlipVertically, &request->m_Image);
+    }
+
+    // Called from the main thread
+    static void LoadImageJobComplete(void* context, void* data, int result)
+    {
+        LoadImageRequest* request = (LoadImageRequest*) context;
+        dmImage::Result r = (dmImage::Result) result;
+        if (r != dmImage::RESULT_OK)
+            dmLogWarning("failed to load image (%d)", r);
+
+        bool buffer_passed = false;
+        if (dmScript::IsCallbackValid(request->m_CallbackInfo))
+        {
+            lua_State* L = dmScript::GetCallbackLuaContext(request->m_CallbackInfo);
+            DM_LUA_STACK_CHECK(L, 0);
+
+            // function(self, request_id, image)
+            if (dmScript::SetupCallback(request->m_CallbackInfo))
+            {
+                lua_pushnumber(L, request->m_Id);
+
+                if (r == dmImage::RESULT_OK)
+                {
+                    lua_newtable(L);
+                    PushImageParameters(L, request->m_Image);
+
+                    lua_pushliteral(L, "buffer");
+                    if (request->m_Buffer)
+                    {
+                        dmScript::LuaHBuffer luabuf(request->m_Buffer, dmScript::OWNER_LUA);
+                        dmScript::PushBuffer(L, luabuf);
+                        buffer_passed = true;
+                    }
+                    else
+                    {
+                        const dmImage::Image& image = request->m_Image;
+                        lua_pushlstring(L, (const char*) image.m_Buffer, dmImage::BytesPerPixel(image.m_Type) * image.m_Width * image.m_Height);
+                    }
+                    lua_rawset(L, -3);
+                }
+                else
+                {
+                    lua_pushnil(L);
+                }
+
+                dmScript::PCall(L, 3, 0);
+                dmScript::TeardownCallback(request->m_CallbackInfo);
+            }
+            else
+            {
+                dmLogError("Failed to setup image.load_async callback (has the calling script been destroyed?)");
+            }
+        }
+
+        dmScript::DestroyCallback(request->m_CallbackInfo);
+        if (request->m_Buffer && !buffer_passed)
+            dmBuffer::Destroy(request->m_Buffer);
+        else if (!request->m_Buffer && r == dmImage::RESULT_OK)
+            dmImage::Free(&request->m_Image);
+        free(request->m_Data);
+        delete request;
+    }
+
+    /*# load image from buffer asynchronously
+    * Load image (PNG or JPEG) from buffer on a worker thread. The callback is called when the image is loaded.
+    * If the engine doesn't have any worker threads, the image is loaded right away, and the callback is called before the function returns.
+    *
+    * @name image.load_async
+    * @param buffer [type:string] image data buffer
+    * @param [options] [type:table] An optional table containing parameters for loading the image. Supported entries:
+    *
+    * `premultiply_alpha`
+    * : [type:boolean] True if alpha should be premultiplied into the color components. Defaults to `false`.
+    *
+    * `flip_vertically`
+    * : [type:boolean] True if the image contents should be flipped vertically. Defaults to `false`.
+    *
+    * `as_buffer`
+    * : [type:boolean] True if the image should be decoded straight into a buffer object, like [ref:image.load_buffer]. Defaults to `false`.
+    *
+    * @param callback [type:function(self, request_id, image)] function to call when the image is loaded
+    *
+    * `self`
+    * : [type:object] The current object.
+    *
+    * `request_id`
+    * : [type:number] The id returned by image.load_async.
+    *
+    * `image`
+    * : [type:table|nil] The image object, see [ref:image.load], or `nil` if loading failed. The `buffer` field is a buffer object if `as_buffer` is set.
+    *
+    * @return request_id [type:number] the id of the request
+    *
+    * @examples
+    *
+    * How to load an image from an URL without blocking the game, and create a GUI texture from it:
+    *
+    * ```lua
+    * local imgurl = "http://www.site.com/image.png"
+    * http.request(imgurl, "GET", function(self, id, response)
+    *         image.load_async(response.response, function(self, request_id, img)
+    *             if img then
+    *                 gui.new_texture("image_node", img.width, img.height, img.type, img.buffer)
+    *             end
+    *         end)
+    *     end)
+    * ```
+    */
+    static int Image_LoadAsync(lua_State* L)
+    {
+        int top = lua_gettop(L);
+        luaL_checktype(L, 1, LUA_TSTRING);
+        size_t buffer_len = 0;
+        const char* buffer = lua_tolstring(L, 1, &buffer_len);
+
+        bool premult = false;
+        bool flip_vertically = false;
+        bool as_buffer = false;
+
+        int callback_index = 2;
+        if (top >= 3)
+        {
+            CheckLoadOptions(L, 2, &premult, &flip_vertically, &as_buffer);
+            callback_index = 3;
+        }
+        luaL_checktype(L, callback_index, LUA_TFUNCTION);
+
+        LoadImageRequest* request = new LoadImageRequest;
+        request->m_CallbackInfo   = 0;
+        request->m_Data           = 0;
+        request->m_DataSize       = 0;
+        request->m_Buffer         = 0;
+        request->m_BufferData     = 0;
+        request->m_BufferDataSize = 0;
+        request->m_Id             = 0;
+        request->m_Premult        = premult;
+        request->m_FlipVertically = flip_vertically;
+
+        // The buffer is created on the main thread, the job only decodes into its memory
+        if (as_buffer)
+        {
+            dmImage::Image info;
+            if (dmImage::GetInfo(buffer, buffer_len, &info.m_Width, &info.m_Height, &info.m_Type) == dmImage::RESULT_OK)
+            {
+                request->m_Buffer = CreateImageBuffer(info, &request->m_BufferData, &request->m_BufferDataSize);
+            }
+
+            if (!request->m_Buffer)
+            {
+                delete request;
+                dmLogWarning("failed to load image (%d)", dmImage::RESULT_IMAGE_ERROR);
+                lua_pushnil(L);
+                assert(top + 1 == lua_gettop(L));
+                return 1;
+            }
+        }
+
+        request->m_CallbackInfo = dmScript::CreateCallback(dmScript::GetMainThread(L), callback_index);
+        if (request->m_CallbackInfo == 0x0)
+        {
+            if (request->m_Buffer)
+                dmBuffer::Destroy(request->m_Buffer);
+            delete request;
+            return luaL_error(L, "image.load_async failed to create callback");
+        }
+
+        request->m_Data = (uint8_t*) malloc(buffer_len);
+        memcpy(request->m_Data, buffer, buffer_len);
+        request->m_DataSize = (uint32_t) buffer_len;
+        request->m_Id       = ++g_ImageModule.m_NextRequestId;
+
+        uint32_t id = request->m_Id;
+        if (g_ImageModule.m_JobThread)
+        {
+            dmJobThread::PushJob(g_ImageModule.m_JobThread, LoadImageJob, LoadImageJobComplete, request, 0);
+        }
+        else
+        {
+            LoadImageJobComplete(request, 0, LoadImageJob(request, 0));
+        }
+
+        lua_pushnumber(L, id);
+        assert(top + 1 == lua_gettop(L));
+        return 1;
+    }
+
     static const luaL_reg ScriptImage_methods[] =
     {
         {"load",        Image_Load},
         {"load_buffer", Image_LoadBuffer},
+        {"load_async",  Image_LoadAsync},
         {0, 0}
     };
 
@@ -357,6 +571,12 @@ namespace dmGameSystem
         assert(top == lua_gettop(L));
     }
 
+    // The image module is registered by the extension below, this only picks up the job thread used by image.load_async
+    void ScriptImageRegister(const ScriptLibContext& context)
+    {
+        g_ImageModule.m_JobThread = context.m_JobThread;
+    }
+
     static dmExtension::Result ScriptImageInitialize(dmExtension::Params* params)
     {
         lua_State* L = params->m_L;
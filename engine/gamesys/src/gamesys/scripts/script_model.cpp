@@ -102,6 +102,26 @@ namespace dmGameSystem
      * The playback_rate is a non-negative number, a negative value will be clamped to 0.
      */
 
+    /*# [type:boolean] model occluder
+     *
+     * If the model hides the models behind it. The bounds of each mesh are drawn into a small depth buffer
+     * each frame, and models that are entirely covered are culled. Only use it for solid models that fill
+     * their bounds, such as walls and large rocks. The type of the property is boolean.
+     *
+     * @name occluder
+     * @property
+     *
+     * @examples
+     *
+     * How to make the walls of a level occlude the models behind them:
+     *
+     * ```lua
+     * function init(self)
+     *   go.set("#model", "occluder", true)
+     * end
+     * ```
+     */
+
      /*# [type:hash] model animation
      *
      * The current animation set on the component. The type of the property is hash.
@@ -15,10 +15,12 @@
 #include <float.h>
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
 
 #include <dlib/hash.h>
 #include <dlib/log.h>
 #include <dlib/math.h>
+#include <dmsdk/dlib/align.h>
 #include <gameobject/script.h>
 
 #include "gamesys.h"
@@ -145,6 +147,10 @@ namespace dmGameSystem
     {
         dmMessage::HSocket m_Socket;
         uint32_t m_ComponentIndex;
+        // Scratch buffers for physics.raycast_batch and the overlap queries, kept here since a Lua error would leak local arrays
+        dmArray<dmPhysics::RayCastRequest>  m_RayCastRequests;
+        dmArray<dmPhysics::RayCastResponse> m_RayCastResponses;
+        dmArray<dmPhysics::OverlapResponse> m_OverlapResponses;
     };
 
     /*# [type:number] collision object mass
@@ -509,6 +515,262 @@ namespace dmGameSystem
         return 1;
     }
 
+    /*# performs several ray casts at once
+     *
+     * Performs a number of ray casts synchronously and returns the closest hit of each ray. It gives the same hits
+     * as calling [ref:physics.raycast] for each ray, but the rays are cast in one call and may be processed in
+     * parallel, which is considerably cheaper for a large number of rays (e.g. line of sight tests).
+     *
+     * @name physics.raycast_batch
+     * @param rays [type:table] a lua table containing the rays, each a table with the world positions `from` and `to` as [type:vector3]
+     * @param groups [type:table] a lua table containing the hashed groups for which to test collisions against
+     * @return results [type:table] a list with one result per ray, in the same order as the rays. The result is `false` if the ray
+     * missed, otherwise a table as returned by [ref:physics.raycast]. See [ref:ray_cast_response] for details on the returned values.
+     * @examples
+     *
+     * How to test the line of sight of a number of agents:
+     *
+     * ```lua
+     * function update(self, dt)
+     *     local rays = {}
+     *     for i, agent in ipairs(self.agents) do
+     *         rays[i] = { from = agent.position, to = self.player_position }
+     *     end
+     *     local results = physics.raycast_batch(rays, self.groups)
+     *     for i, result in ipairs(results) do
+     *         self.agents[i].can_see_player = result and result.group == hash("player")
+     *     end
+     * end
+     * ```
+     */
+    int Physics_RayCastBatch(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 1);
+
+        dmMessage::URL sender;
+        if (!dmScript::GetURL(L, &sender)) {
+            return luaL_error(L, "could not find a requesting instance for physics.raycast_batch");
+        }
+
+        dmScript::GetGlobal(L, PHYSICS_CONTEXT_HASH);
+        PhysicsScriptContext* context = (PhysicsScriptContext*)lua_touserdata(L, -1);
+        lua_pop(L, 1);
+
+        dmGameObject::HInstance sender_instance = CheckGoInstance(L);
+        dmGameObject::HCollection collection = dmGameObject::GetCollection(sender_instance);
+        void* world = dmGameObject::GetWorld(collection, context->m_ComponentIndex);
+        if (world == 0x0)
+        {
+            return DM_LUA_ERROR("Physics world doesn't exist. Make sure you have at least one physics component in collection.");
+        }
+
+        luaL_checktype(L, 1, LUA_TTABLE);
+
+        uint32_t mask = 0;
+        luaL_checktype(L, 2, LUA_TTABLE);
+        lua_pushnil(L);
+        while (lua_next(L, 2) != 0)
+        {
+            mask |= CompCollisionGetGroupBitIndex(world, dmScript::CheckHash(L, -1));
+            lua_pop(L, 1);
+        }
+
+        uint32_t count = (uint32_t)lua_objlen(L, 1);
+        dmArray<dmPhysics::RayCastRequest>& requests = context->m_RayCastRequests;
+        dmArray<dmPhysics::RayCastResponse>& responses = context->m_RayCastResponses;
+        if (requests.Capacity() < count)
+        {
+            requests.SetCapacity(count);
+            responses.SetCapacity(count);
+        }
+        requests.SetSize(count);
+        responses.SetSize(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            lua_rawgeti(L, 1, i + 1);
+            if (!lua_istable(L, -1))
+            {
+                lua_pop(L, 1);
+                return DM_LUA_ERROR("ray %d must be a table with the fields 'from' and 'to'", i + 1);
+            }
+
+            dmPhysics::RayCastRequest& request = requests[i];
+            request = dmPhysics::RayCastRequest();
+            lua_getfield(L, -1, "from");
+            request.m_From = dmVMath::Point3(*dmScript::CheckVector3(L, -1));
+            lua_pop(L, 1);
+            lua_getfield(L, -1, "to");
+            request.m_To = dmVMath::Point3(*dmScript::CheckVector3(L, -1));
+            lua_pop(L, 1);
+            request.m_Mask = mask;
+
+            lua_pop(L, 1);
+        }
+
+        dmGameSystem::RayCastBatch(world, requests.Begin(), count, responses.Begin());
+
+        lua_createtable(L, count, 0);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (responses[i].m_Hit)
+            {
+                lua_newtable(L);
+                PushRayCastResponse(L, world, responses[i]);
+            }
+            else
+            {
+                lua_pushboolean(L, 0);
+            }
+            lua_rawseti(L, -2, i + 1);
+        }
+
+        return 1;
+    }
+
+    static void* CheckOverlapWorld(lua_State* L, PhysicsScriptContext* context)
+    {
+        dmGameObject::HInstance sender_instance = CheckGoInstance(L);
+        dmGameObject::HCollection collection = dmGameObject::GetCollection(sender_instance);
+        void* world = dmGameObject::GetWorld(collection, context->m_ComponentIndex);
+        if (world == 0x0)
+        {
+            luaL_error(L, "Physics world doesn't exist. Make sure you have at least one physics component in collection.");
+        }
+        return world;
+    }
+
+    static uint16_t CheckGroupMask(lua_State* L, void* world, int index)
+    {
+        uint16_t mask = 0;
+        luaL_checktype(L, index, LUA_TTABLE);
+        lua_pushnil(L);
+        while (lua_next(L, index) != 0)
+        {
+            mask |= CompCollisionGetGroupBitIndex(world, dmScript::CheckHash(L, -1));
+            lua_pop(L, 1);
+        }
+        return mask;
+    }
+
+    static void PushOverlapResults(lua_State* L, void* world, const dmArray<dmPhysics::OverlapResponse>& results)
+    {
+        if (results.Empty())
+        {
+            lua_pushnil(L);
+            return;
+        }
+
+        uint32_t count = results.Size();
+        lua_createtable(L, count, 0);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const dmPhysics::OverlapResponse& response = results[i];
+            lua_createtable(L, 0, 2);
+            dmScript::PushHash(L, dmGameSystem::GetLSBGroupHash(world, response.m_CollisionObjectGroup));
+            lua_setfield(L, -2, "group");
+            dmScript::PushHash(L, dmGameSystem::CompCollisionObjectGetIdentifier(response.m_CollisionObjectUserData));
+            lua_setfield(L, -2, "id");
+            lua_rawseti(L, -2, i + 1);
+        }
+    }
+
+    /*# finds the collision objects overlapping a box
+     *
+     * Finds the collision objects with shapes overlapping a box, in the same frame. Collision objects of types kinematic, dynamic
+     * and static are tested against, but not trigger objects. This is considerably cheaper than creating a temporary trigger
+     * for the test, and waiting for its messages.
+     *
+     * @name physics.overlap_box
+     * @param position [type:vector3] the world position of the center of the box
+     * @param dimensions [type:vector3] the size of the box. In 2D physics only x and y are used
+     * @param groups [type:table] a lua table containing the hashed groups for which to test collisions against
+     * @param [rotation] [type:quaternion] the rotation of the box. In 2D physics only the rotation around the z-axis is used
+     * @return result [type:table|nil] a list of the overlapping objects, or `nil` if there are none. Each object is a table with the
+     * `id` [type:hash] of the instance and the `group` [type:hash] of the collision object.
+     * @examples
+     *
+     * ```lua
+     * local hits = physics.overlap_box(go.get_world_position(), vmath.vector3(100, 50, 0), { hash("enemy") })
+     * if hits then
+     *     for _, hit in ipairs(hits) do
+     *         msg.post(hit.id, "stunned")
+     *     end
+     * end
+     * ```
+     */
+    static int Physics_OverlapBox(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 1);
+
+        dmScript::GetGlobal(L, PHYSICS_CONTEXT_HASH);
+        PhysicsScriptContext* context = (PhysicsScriptContext*)lua_touserdata(L, -1);
+        lua_pop(L, 1);
+
+        void* world = CheckOverlapWorld(L, context);
+        dmVMath::Point3 position(*dmScript::CheckVector3(L, 1));
+        dmVMath::Vector3 half_extents = *dmScript::CheckVector3(L, 2) * 0.5f;
+        uint16_t mask = CheckGroupMask(L, world, 3);
+        dmVMath::Quat rotation = dmVMath::Quat::identity();
+        if (!lua_isnoneornil(L, 4))
+        {
+            rotation = *dmScript::CheckQuat(L, 4);
+        }
+
+        dmArray<dmPhysics::OverlapResponse>& results = context->m_OverlapResponses;
+        dmGameSystem::QueryBox(world, position, rotation, half_extents, mask, results);
+        PushOverlapResults(L, world, results);
+        return 1;
+    }
+
+    /*# finds the collision objects overlapping a sphere
+     *
+     * Finds the collision objects with shapes overlapping a sphere, in the same frame. See [ref:physics.overlap_box].
+     * In 2D physics, this is the same as [ref:physics.overlap_circle].
+     *
+     * @name physics.overlap_sphere
+     * @param position [type:vector3] the world position of the center of the sphere
+     * @param radius [type:number] the radius of the sphere
+     * @param groups [type:table] a lua table containing the hashed groups for which to test collisions against
+     * @return result [type:table|nil] a list of the overlapping objects, or `nil` if there are none. Each object is a table with the
+     * `id` [type:hash] of the instance and the `group` [type:hash] of the collision object.
+     * @examples
+     *
+     * ```lua
+     * local hits = physics.overlap_sphere(self.explosion_position, 200, { hash("enemy"), hash("crate") })
+     * ```
+     */
+
+    /*# finds the collision objects overlapping a circle
+     *
+     * Finds the collision objects with shapes overlapping a circle, in the same frame. See [ref:physics.overlap_box].
+     * In 3D physics, this is the same as [ref:physics.overlap_sphere].
+     *
+     * @name physics.overlap_circle
+     * @param position [type:vector3] the world position of the center of the circle, z is ignored
+     * @param radius [type:number] the radius of the circle
+     * @param groups [type:table] a lua table containing the hashed groups for which to test collisions against
+     * @return result [type:table|nil] a list of the overlapping objects, or `nil` if there are none. Each object is a table with the
+     * `id` [type:hash] of the instance and the `group` [type:hash] of the collision object.
+     */
+    static int Physics_OverlapSphere(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 1);
+
+        dmScript::GetGlobal(L, PHYSICS_CONTEXT_HASH);
+        PhysicsScriptContext* context = (PhysicsScriptContext*)lua_touserdata(L, -1);
+        lua_pop(L, 1);
+
+        void* world = CheckOverlapWorld(L, context);
+        dmVMath::Point3 position(*dmScript::CheckVector3(L, 1));
+        float radius = luaL_checknumber(L, 2);
+        uint16_t mask = CheckGroupMask(L, world, 3);
+
+        dmArray<dmPhysics::OverlapResponse>& results = context->m_OverlapResponses;
+        dmGameSystem::QuerySphere(world, position, radius, mask, results);
+        PushOverlapResults(L, world, results);
+        return 1;
+    }
+
     // Matches JointResult in physics.h
     static const char* PhysicsResultString[] = {
         "result ok",
@@ -1554,6 +1816,14 @@ namespace dmGameSystem
      * `data`
      * : [type:table] The callback value data is a table that contains event-related data. See the documentation for details on the messages.
      *
+     * @param [options] [type:table] a lua table containing options for the listener.
+     *
+     * `batch`
+     * : [type:boolean] Set to `true` to receive all the events of a physics step in one call, after the step.
+     * The callback is then called as `callback(self, events)`, where `events` is a list of the event data tables.
+     * Each table also contains the type of the event in the field `event`.
+     * The buffered events aren't limited by `physics.max_collisions` and `physics.max_contacts`.
+     *
      * @examples
      *
      * ```lua
@@ -1631,6 +1901,22 @@ namespace dmGameSystem
      *     physics.set_listener(physics_world_listener)
      * end
      * ```
+     *
+     * How to receive the events of a step in one call:
+     *
+     * ```lua
+     * local function physics_world_events(self, events)
+     *   for _, data in ipairs(events) do
+     *     if data.event == hash("contact_point_event") then
+     *       pprint(data.a.id, data.b.id, data.applied_impulse)
+     *     end
+     *   end
+     * end
+     *
+     * function init(self)
+     *     physics.set_listener(physics_world_events, { batch = true })
+     * end
+     * ```
      */
     static int Physics_SetListener(lua_State* L)
     {
@@ -1651,13 +1937,21 @@ namespace dmGameSystem
 
         dmScript::LuaCallbackInfo* cbk = (dmScript::LuaCallbackInfo*)GetCollisionWorldCallback(world);
 
+        bool batch_events = false;
+        if (lua_istable(L, 2))
+        {
+            lua_getfield(L, 2, "batch");
+            batch_events = lua_isnil(L, -1) ? false : lua_toboolean(L, -1);
+            lua_pop(L, 1);
+        }
+
         int type = lua_type(L, 1);
         if (type == LUA_TNONE || type == LUA_TNIL)
         {
             if (cbk != 0x0)
             {
                 dmScript::DestroyCallback(cbk);
-                SetCollisionWorldCallback(world, 0x0);
+                SetCollisionWorldCallback(world, 0x0, false);
             }
         }
         else if (type == LUA_TFUNCTION)
@@ -1665,10 +1959,10 @@ namespace dmGameSystem
             if (cbk != 0x0)
             {
                 dmScript::DestroyCallback(cbk);
-                SetCollisionWorldCallback(world, 0x0);
+                SetCollisionWorldCallback(world, 0x0, false);
             }
             cbk = dmScript::CreateCallback(L, 1);
-            SetCollisionWorldCallback(world, cbk);
+            SetCollisionWorldCallback(world, cbk, batch_events);
         }
         else
         {
@@ -1742,11 +2036,56 @@ namespace dmGameSystem
         dmScript::TeardownCallback(cbk);
     }
 
+    void RunCollisionWorldBatchCallback(void* callback_data, const uint8_t* events, uint32_t event_count)
+    {
+        dmScript::LuaCallbackInfo* cbk = (dmScript::LuaCallbackInfo*)callback_data;
+        if (!dmScript::IsCallbackValid(cbk))
+        {
+            dmLogError("Physics world listener is invalid.");
+            return;
+        }
+        lua_State* L = dmScript::GetCallbackLuaContext(cbk);
+        DM_LUA_STACK_CHECK(L, 0);
+
+        if (!dmScript::SetupCallback(cbk))
+        {
+            dmLogError("Failed to setup physics.set_listener() callback");
+            return;
+        }
+
+        // The DDF data in the event buffer is only aligned to the event headers
+        uint8_t DM_ALIGNED(16) data[PHYSICS_EVENT_MAX_DATA_SIZE];
+
+        lua_createtable(L, event_count, 0);
+        const uint8_t* event = events;
+        for (uint32_t i = 0; i < event_count; ++i)
+        {
+            PhysicsEventHeader header;
+            memcpy(&header, event, sizeof(header));
+            const dmDDF::Descriptor* desc = header.m_Descriptor;
+            memcpy(data, event + sizeof(header), desc->m_Size);
+
+            dmScript::PushDDF(L, desc, (const char*)data, false);
+            dmScript::PushHash(L, desc->m_NameHash);
+            lua_setfield(L, -2, "event");
+            lua_rawseti(L, -2, i + 1);
+
+            event += header.m_Size;
+        }
+        int ret = dmScript::PCall(L, 2, 0);
+        (void)ret;
+        dmScript::TeardownCallback(cbk);
+    }
+
     static const luaL_reg PHYSICS_FUNCTIONS[] =
     {
         {"ray_cast",        Physics_RayCastAsync}, // Deprecated
         {"raycast_async",   Physics_RayCastAsync},
         {"raycast",         Physics_RayCast},
+        {"raycast_batch",   Physics_RayCastBatch},
+        {"overlap_box",     Physics_OverlapBox},
+        {"overlap_sphere",  Physics_OverlapSphere},
+        {"overlap_circle",  Physics_OverlapSphere},
 
         {"create_joint",    Physics_CreateJoint},
         {"destroy_joint",   Physics_DestroyJoint},
@@ -2587,7 +2587,7 @@ static int GetAtlas(lua_State* L)
 }
 
 /*# Update internal sound resource
- * Update internal sound resource (wavc/oggc) with new data
+ * Update internal sound resource (wavc/oggc/opusc) with new data
  *
  * @name resource.set_sound
  *
@@ -101,6 +101,42 @@ namespace dmGameSystem
      * ```
      */
 
+    /*# [type:number] sound max distance
+     *
+     * When above 0, the sounds played by the component are positioned at its game object, and follow it while
+     * they play. They are panned and doppler shifted relative to the camera in focus, and attenuated with the
+     * distance to it, up to the max distance. The default is 0.
+     *
+     * @name max_distance
+     * @property
+     *
+     * @examples
+     *
+     * ```lua
+     * function init(self)
+     *   go.set("#sound", "max_distance", 500)
+     * end
+     * ```
+     */
+
+    /*# [type:number] sound min distance
+     *
+     * The distance to the camera within which a positioned sound isn't attenuated. See `max_distance`.
+     * The default is 1.
+     *
+     * @name min_distance
+     * @property
+     *
+     * @examples
+     *
+     * ```lua
+     * function init(self)
+     *   go.set("#sound", "min_distance", 50)
+     *   go.set("#sound", "max_distance", 500)
+     * end
+     * ```
+     */
+
     /*# [type:hash] sound data
      *
      * The sound data used when playing the sound. The type of the property is hash.
@@ -429,6 +465,29 @@ namespace dmGameSystem
         return 1;
     }
 
+    /*# get the output latency
+     * Get the time from when a sound is mixed until it's output, given by the buffers
+     * kept queued on the sound device.
+     *
+     * With the `sound.low_latency` project setting, as few buffers as the device can play without
+     * running dry are kept queued, and the latency grows if it does run dry.
+     *
+     * @name sound.get_latency
+     * @return latency [type:number] latency in seconds
+     * @examples
+     *
+     * Schedule a beat to be heard on time:
+     *
+     * ```lua
+     * local delay = self.next_beat - socket.gettime() - sound.get_latency()
+     * ```
+     */
+    static int Sound_GetLatency(lua_State* L)
+    {
+        lua_pushnumber(L, dmSound::GetLatency());
+        return 1;
+    }
+
     /*# plays a sound
      * Make the sound component play its sound. Multiple voices are supported. The limit is set to 32 voices per sound component.
      *
@@ -733,6 +792,7 @@ namespace dmGameSystem
         {"get_groups", Sound_GetGroups},
         {"get_group_name", Sound_GetGroupName},
         {"is_phone_call_active", Sound_IsPhoneCallActive},
+        {"get_latency", Sound_GetLatency},
         {"play", Sound_Play},
         {"stop", Sound_Stop},
         {"pause", Sound_Pause},
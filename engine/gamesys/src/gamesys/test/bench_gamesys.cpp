@@ -0,0 +1,84 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "test_gamesys.h"
+
+#include <dlib/benchmark.h>
+#include <dlib/dstrings.h>
+#include <testmain/testmain.h>
+#include <ddf/ddf.h>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+using namespace dmVMath;
+
+static const uint32_t SPRITE_COUNT = 1000;
+
+class SpriteBench : public GamesysTest<const char*>
+{
+public:
+    SpriteBench()
+    {
+        m_projectOptions.m_MaxSpriteCount = SPRITE_COUNT;
+    }
+    virtual ~SpriteBench() {}
+};
+
+TEST_F(SpriteBench, GenerateVertexData)
+{
+    char id[32];
+    for (uint32_t i = 0; i < SPRITE_COUNT; ++i)
+    {
+        dmSnPrintf(id, sizeof(id), "/sprite%u", i);
+        Point3 position((float)(i % 40) * 16.0f, (float)(i / 40) * 16.0f, 0.0f);
+        dmGameObject::HInstance go = Spawn(m_Factory, m_Collection, "/sprite/valid_sprite.goc", dmHashString64(id), 0, position, Quat(0, 0, 0, 1), Vector3(1, 1, 1));
+        ASSERT_NE((void*)0, go);
+    }
+
+    ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+    ASSERT_TRUE(dmGameObject::PostUpdate(m_Collection));
+
+    // Render() collects the sprite render entries and DrawRenderList() dispatches them,
+    // which is where the sprite vertices are generated
+    for (dmBenchmark::Run run("sprite.generate_vertex_data", 100, SPRITE_COUNT); run.Next(); )
+    {
+        dmRender::RenderListBegin(m_RenderContext);
+        dmGameObject::Render(m_Collection);
+        dmRender::RenderListEnd(m_RenderContext);
+        dmRender::DrawRenderList(m_RenderContext, 0x0, 0x0, 0x0);
+        dmRender::ClearRenderObjects(m_RenderContext);
+    }
+
+    ASSERT_TRUE(dmGameObject::Final(m_Collection));
+}
+
+extern "C" void dmExportedSymbols();
+
+int main(int argc, char **argv)
+{
+    dmExportedSymbols();
+    TestMainPlatformInit();
+
+    dmLog::LogParams params;
+    dmLog::LogInitialize(&params);
+
+    dmDDF::RegisterAllTypes();
+
+    jc_test_init(&argc, argv);
+    int ret = jc_test_run_all();
+    if (ret == 0)
+        ret = dmBenchmark::Report(argc, argv, "gamesys");
+    return ret;
+}
@@ -0,0 +1,15 @@
+#version 140
+
+in mediump vec4 var_color;
+
+out vec4 out_fragColor;
+
+uniform fs_uniforms
+{
+    mediump vec4 tint;
+};
+
+void main()
+{
+    out_fragColor = var_color * tint;
+}
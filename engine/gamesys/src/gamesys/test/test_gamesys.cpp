@@ -43,7 +43,9 @@
 #include <gameobject/script.h>
 #include <gamesys/gamesys_ddf.h>
 #include <gamesys/sprite_ddf.h>
+#include "../components/comp_gui_private.h"
 #include "../components/comp_label.h"
+#include "../resources/res_texture.h"
 #include "../scripts/script_sys_gamesys.h"
 #include "../scripts/script_resource.h"
 
@@ -68,10 +70,14 @@ namespace dmGameSystem
 {
     void DumpResourceRefs(dmGameObject::HCollection collection);
     extern void GetSpriteWorldRenderBuffers(void* world, dmRender::HBufferedRenderBuffer* vx_buffer, dmRender::HBufferedRenderBuffer* ix_buffer);
+    extern void GetSpriteWorldInstanceBuffer(void* world, dmRender::HBufferedRenderBuffer* instance_buffer);
     extern void GetSpriteWorldDynamicAttributePool(void* sprite_world, DynamicAttributePool** pool_out);
+    extern uint32_t GetSpriteWorldVertexCacheCount(void* sprite_world);
     extern void GetModelWorldRenderBuffers(void* world, dmRender::HBufferedRenderBuffer** vx_buffers, uint32_t* vx_buffers_count);
     extern void GetParticleFXWorldRenderBuffers(void* world, dmRender::HBufferedRenderBuffer* vx_buffer);
     extern void GetTileGridWorldRenderBuffers(void* world, dmRender::HBufferedRenderBuffer* vx_buffer);
+    extern uint32_t GetTileGridWorldRegionBufferCount(void* world);
+    extern bool GetTextureStreamingState(TextureResource* resource, uint32_t* resident_mipmap, bool* has_image);
 }
 
 #define EPSILON 0.0001f
@@ -412,6 +418,51 @@ TEST_F(ResourceTest, TestCreateTextureFromScript)
      dmGameSystem::FinalizeScriptLibs(scriptlibcontext);
 }
 
+TEST_F(ResourceTest, TextureStreaming)
+{
+    dmGameSystem::SetTextureStreamingBudget(128 * 1024 * 1024);
+
+    dmGameSystem::TextureResource* texture_res;
+    ASSERT_EQ(dmResource::RESULT_OK, dmResource::Get(m_Factory, "/texture/blank_4096_png.texturec", (void**) &texture_res));
+
+    // The texture is created from the first mipmap that fits the resident size
+    uint32_t resident_mipmap;
+    bool has_image;
+    ASSERT_TRUE(dmGameSystem::GetTextureStreamingState(texture_res, &resident_mipmap, &has_image));
+    ASSERT_EQ(5u, resident_mipmap);
+    ASSERT_TRUE(has_image);
+    ASSERT_EQ(128, dmGraphics::GetTextureWidth(texture_res->m_Texture));
+    ASSERT_EQ(128, dmGraphics::GetTextureHeight(texture_res->m_Texture));
+
+    // Nothing is streamed in while the texture isn't drawn
+    dmGameSystem::UpdateTextureStreaming(m_GraphicsContext);
+    ASSERT_TRUE(dmGameSystem::GetTextureStreamingState(texture_res, &resident_mipmap, &has_image));
+    ASSERT_EQ(5u, resident_mipmap);
+
+    // Drawn at full size, one mipmap is streamed in per frame
+    for (uint32_t i = 0; i < 5; ++i)
+    {
+        dmGameSystem::ReportTextureFullSize(texture_res);
+        dmGameSystem::UpdateTextureStreaming(m_GraphicsContext);
+        ASSERT_TRUE(dmGameSystem::GetTextureStreamingState(texture_res, &resident_mipmap, &has_image));
+        ASSERT_EQ(4u - i, resident_mipmap);
+        ASSERT_EQ(128u << (i + 1), dmGraphics::GetTextureWidth(texture_res->m_Texture));
+    }
+
+    // The CPU copy of the image is freed once all mipmaps are resident
+    ASSERT_FALSE(has_image);
+
+    // Drawn small, the texture keeps its mipmaps while there is room in the budget
+    dmGameSystem::ReportTextureScreenSize(texture_res, 64.0f);
+    dmGameSystem::UpdateTextureStreaming(m_GraphicsContext);
+    ASSERT_TRUE(dmGameSystem::GetTextureStreamingState(texture_res, &resident_mipmap, &has_image));
+    ASSERT_EQ(0u, resident_mipmap);
+    ASSERT_EQ(4096, dmGraphics::GetTextureWidth(texture_res->m_Texture));
+
+    dmResource::Release(m_Factory, texture_res);
+    dmGameSystem::SetTextureStreamingBudget(0);
+}
+
 TEST_F(ResourceTest, TestResourceScriptBuffer)
 {
     dmGameSystem::ScriptLibContext scriptlibcontext;
@@ -1511,6 +1562,96 @@ TEST_F(GuiTest, MaxDynamictextures)
     ASSERT_TRUE(dmGameObject::Final(m_Collection));
 }
 
+static void InitMergeEntry(dmGameSystem::GuiMergeEntry* entry, uint32_t index, dmGraphics::HTexture texture, float x, float y)
+{
+    memset(entry, 0, sizeof(*entry));
+    entry->m_Index            = index;
+    entry->m_State.m_NodeType = dmGui::NODE_TYPE_BOX;
+    entry->m_State.m_Texture  = texture;
+    entry->m_Min[0]           = x;
+    entry->m_Min[1]           = y;
+    entry->m_Max[0]           = x + 1.0f;
+    entry->m_Max[1]           = y + 1.0f;
+    entry->m_Bounded          = 1;
+}
+
+static void GetMergeOrder(const dmGameSystem::GuiMergeEntry* entries, uint32_t count, uint32_t* order)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        order[i] = entries[i].m_Index;
+    }
+}
+
+TEST_F(GuiTest, MergeBatchEntries)
+{
+    const dmGraphics::HTexture texture_a = 1;
+    const dmGraphics::HTexture texture_b = 2;
+    dmGameSystem::GuiMergeEntry entries[dmGameSystem::MAX_MERGE_DISTANCE + 2];
+    uint32_t order[DM_ARRAY_SIZE(entries)];
+
+    // The last entry moves back past the entry it doesn't overlap, to the entry with the same texture
+    InitMergeEntry(&entries[0], 0, texture_a, 0.0f, 0.0f);
+    InitMergeEntry(&entries[1], 1, texture_b, 2.0f, 0.0f);
+    InitMergeEntry(&entries[2], 2, texture_a, 4.0f, 0.0f);
+    ASSERT_EQ(1u, dmGameSystem::MergeBatchEntries(entries, 3));
+    GetMergeOrder(entries, 3, order);
+    ASSERT_EQ(0u, order[0]);
+    ASSERT_EQ(2u, order[1]);
+    ASSERT_EQ(1u, order[2]);
+
+    // Entries that already batch with the previous entry stay
+    InitMergeEntry(&entries[0], 0, texture_a, 0.0f, 0.0f);
+    InitMergeEntry(&entries[1], 1, texture_a, 0.0f, 0.0f);
+    InitMergeEntry(&entries[2], 2, texture_b, 0.0f, 0.0f);
+    ASSERT_EQ(0u, dmGameSystem::MergeBatchEntries(entries, 3));
+
+    // The last entry overlaps the entry in between, and would be drawn below it if moved
+    InitMergeEntry(&entries[0], 0, texture_a, 0.0f, 0.0f);
+    InitMergeEntry(&entries[1], 1, texture_b, 4.5f, 0.5f);
+    InitMergeEntry(&entries[2], 2, texture_a, 4.0f, 0.0f);
+    ASSERT_EQ(0u, dmGameSystem::MergeBatchEntries(entries, 3));
+    GetMergeOrder(entries, 3, order);
+    ASSERT_EQ(0u, order[0]);
+    ASSERT_EQ(1u, order[1]);
+    ASSERT_EQ(2u, order[2]);
+
+    // Entries can't move past entries without bounds (e.g. particlefx)
+    InitMergeEntry(&entries[0], 0, texture_a, 0.0f, 0.0f);
+    InitMergeEntry(&entries[1], 1, texture_b, 2.0f, 0.0f);
+    InitMergeEntry(&entries[2], 2, texture_a, 4.0f, 0.0f);
+    entries[1].m_Bounded = 0;
+    ASSERT_EQ(0u, dmGameSystem::MergeBatchEntries(entries, 3));
+
+    // Entries can't move past entries in another stencil scope, and clippers stay in place
+    dmGui::StencilScope scope;
+    memset(&scope, 0, sizeof(scope));
+    InitMergeEntry(&entries[0], 0, texture_a, 0.0f, 0.0f);
+    InitMergeEntry(&entries[1], 1, texture_b, 2.0f, 0.0f);
+    InitMergeEntry(&entries[2], 2, texture_a, 4.0f, 0.0f);
+    entries[1].m_State.m_StencilScope = &scope;
+    ASSERT_EQ(0u, dmGameSystem::MergeBatchEntries(entries, 3));
+
+    scope.m_WriteMask = 0xff;
+    entries[0].m_State.m_StencilScope = &scope;
+    entries[2].m_State.m_StencilScope = &scope;
+    ASSERT_EQ(0u, dmGameSystem::MergeBatchEntries(entries, 3));
+
+    // Entries move back at most MAX_MERGE_DISTANCE entries
+    const uint32_t count = DM_ARRAY_SIZE(entries);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        InitMergeEntry(&entries[i], i, i == 0 || i == count - 1 ? texture_a : texture_b, i * 2.0f, 0.0f);
+    }
+    ASSERT_EQ(0u, dmGameSystem::MergeBatchEntries(entries, count));
+
+    InitMergeEntry(&entries[count - 2], count - 2, texture_a, (count - 2) * 2.0f, 0.0f);
+    ASSERT_EQ(1u, dmGameSystem::MergeBatchEntries(entries, count - 1));
+    GetMergeOrder(entries, count - 1, order);
+    ASSERT_EQ(0u, order[0]);
+    ASSERT_EQ(count - 2, order[1]);
+}
+
 TEST_F(FontTest, GlyphBankTest)
 {
     const char path_font_1[] = "/font/glyph_bank_test_1.fontc";
@@ -3107,6 +3248,210 @@ TEST_F(ComponentTest, DispatchBuffersTest)
     ASSERT_TRUE(dmGameObject::Final(m_Collection));
 }
 
+TEST_F(ComponentTest, TileGridRegionBuffers)
+{
+    void* tilegrid_world = dmGameObject::GetWorld(m_Collection, dmGameObject::GetComponentTypeIndex(m_Collection, dmHashString64("tilemapc")));
+    ASSERT_NE((void*) 0, tilegrid_world);
+
+    ASSERT_TRUE(dmGameObject::Init(m_Collection));
+    dmGameObject::HInstance go = Spawn(m_Factory, m_Collection, "/tile/valid_tilegrid.goc", dmHashString64("/go"), 0, Point3(0, 0, 0), Quat(0, 0, 0, 1), Vector3(1, 1, 1));
+    ASSERT_NE((void*)0, go);
+
+    // The regions are written to the shared vertex buffer until they have been unchanged for a couple of frames
+    const uint32_t expected_static[] = { 0, 0, 1, 1, 0, 0, 1 };
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(expected_static); ++i)
+    {
+        // Moving the tile map makes all the regions non static
+        if (i == 4)
+        {
+            dmGameObject::SetPosition(go, Point3(10, 0, 0));
+        }
+
+        ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+
+        dmRender::RenderListBegin(m_RenderContext);
+        dmGameObject::Render(m_Collection);
+        dmRender::RenderListEnd(m_RenderContext);
+        dmRender::DrawRenderList(m_RenderContext, 0x0, 0x0, 0x0);
+
+        uint32_t region_buffer_count = dmGameSystem::GetTileGridWorldRegionBufferCount(tilegrid_world);
+        if (expected_static[i])
+        {
+            ASSERT_LT(0u, region_buffer_count);
+        }
+        else
+        {
+            ASSERT_EQ(0u, region_buffer_count);
+        }
+        dmRender::ClearRenderObjects(m_RenderContext);
+    }
+
+    ASSERT_TRUE(dmGameObject::Final(m_Collection));
+}
+
+// The tile map cells are stored in chunks per region, that are only allocated once a tile is set in the region
+TEST_F(ComponentTest, TileGridChunks)
+{
+    lua_State* L = dmScript::GetLuaState(m_ScriptContext);
+
+    ASSERT_TRUE(dmGameObject::Init(m_Collection));
+    dmGameObject::HInstance go = Spawn(m_Factory, m_Collection, "/tilegrid/chunks.goc", dmHashString64("/go"), 0, Point3(0, 0, 0), Quat(0, 0, 0, 1), Vector3(1, 1, 1));
+    ASSERT_NE((void*)0, go);
+
+    // The tests are run in the init function of the script
+    lua_getglobal(L, "tests_done");
+    ASSERT_TRUE(lua_toboolean(L, -1));
+    lua_pop(L, 1);
+
+    ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+
+    ASSERT_TRUE(dmGameObject::Final(m_Collection));
+}
+
+TEST_F(ComponentTest, SpriteVertexCache)
+{
+    void* sprite_world = dmGameObject::GetWorld(m_Collection, dmGameObject::GetComponentTypeIndex(m_Collection, dmHashString64("spritec")));
+    ASSERT_NE((void*) 0, sprite_world);
+
+    ASSERT_TRUE(dmGameObject::Init(m_Collection));
+    dmGameObject::HInstance go = Spawn(m_Factory, m_Collection, "/sprite/valid_sprite.goc", dmHashString64("/go"), 0, Point3(0, 0, 0), Quat(0, 0, 0, 1), Vector3(1, 1, 1));
+    ASSERT_NE((void*)0, go);
+
+    // The vertices are kept once the sprite is unchanged since the previous frame
+    const uint32_t expected_cached[] = { 0, 1, 1, 1, 0, 1, 1 };
+    dmArray<uint8_t> vertices[DM_ARRAY_SIZE(expected_cached)];
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(expected_cached); ++i)
+    {
+        if (i == 4)
+        {
+            dmGameObject::SetPosition(go, Point3(10, 0, 0));
+        }
+
+        ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+
+        dmRender::RenderListBegin(m_RenderContext);
+        dmGameObject::Render(m_Collection);
+        dmRender::RenderListEnd(m_RenderContext);
+        dmRender::DrawRenderList(m_RenderContext, 0x0, 0x0, 0x0);
+
+        ASSERT_EQ(expected_cached[i], dmGameSystem::GetSpriteWorldVertexCacheCount(sprite_world));
+
+        dmRender::BufferedRenderBuffer* vx_buffer;
+        dmRender::BufferedRenderBuffer* ix_buffer;
+        dmGameSystem::GetSpriteWorldRenderBuffers(sprite_world, &vx_buffer, &ix_buffer);
+        dmGraphics::VertexBuffer* gfx_vx_buffer = (dmGraphics::VertexBuffer*) vx_buffer->m_Buffers[0];
+        ASSERT_LT(0u, gfx_vx_buffer->m_Size);
+        vertices[i].SetCapacity(gfx_vx_buffer->m_Size);
+        vertices[i].PushArray((uint8_t*) gfx_vx_buffer->m_Buffer, gfx_vx_buffer->m_Size);
+
+        dmRender::ClearRenderObjects(m_RenderContext);
+    }
+
+    // The cached vertices are the same as the generated ones
+    for (uint32_t i = 1; i < DM_ARRAY_SIZE(expected_cached); ++i)
+    {
+        uint32_t first = i < 4 ? 0 : 4;
+        ASSERT_EQ(vertices[first].Size(), vertices[i].Size());
+        ASSERT_EQ(0, memcmp(vertices[first].Begin(), vertices[i].Begin(), vertices[i].Size()));
+    }
+    ASSERT_NE(0, memcmp(vertices[0].Begin(), vertices[4].Begin(), vertices[4].Size()));
+
+    ASSERT_TRUE(dmGameObject::Final(m_Collection));
+}
+
+TEST_F(ComponentTest, SpriteInstancing)
+{
+    void* sprite_world = dmGameObject::GetWorld(m_Collection, dmGameObject::GetComponentTypeIndex(m_Collection, dmHashString64("spritec")));
+    ASSERT_NE((void*) 0, sprite_world);
+
+    // Vertex format for /sprite/instancing/regular.material
+    struct vs_format_regular
+    {
+        float position[4];
+        float color[4];
+    };
+
+    // Instance format for /sprite/instancing/instanced.material, the vertices only have the local position
+    struct inst_format_instanced
+    {
+        float mtx_world[16];
+        float color[4];
+    };
+
+    ASSERT_TRUE(dmGameObject::Init(m_Collection));
+
+    // The same sprite is drawn with the vertex path and the instanced path, in one frame each
+    const char* go_paths[] = { "/sprite/instancing/regular.goc", "/sprite/instancing/instanced.goc" };
+    dmArray<uint8_t> buffers[DM_ARRAY_SIZE(go_paths)];
+
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(go_paths); ++i)
+    {
+        dmGameObject::HInstance go = Spawn(m_Factory, m_Collection, go_paths[i], dmHashString64("/go"), 0, Point3(10, 20, 0), Quat::rotationZ(0.5f), Vector3(2, 3, 1));
+        ASSERT_NE((void*)0, go);
+
+        dmGameObject::PropertyOptions opt;
+        dmGameObject::PropertyVar color(Vector4(1.0f, 0.5f, 0.25f, 1.0f));
+        dmGameObject::PropertyVar tint(Vector4(0.5f, 0.5f, 1.0f, 0.75f));
+        ASSERT_EQ(dmGameObject::PROPERTY_RESULT_OK, dmGameObject::SetProperty(go, dmHashString64("sprite"), dmHashString64("color"), opt, color));
+        ASSERT_EQ(dmGameObject::PROPERTY_RESULT_OK, dmGameObject::SetProperty(go, dmHashString64("sprite"), dmHashString64("tint"), opt, tint));
+
+        ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+
+        dmRender::RenderListBegin(m_RenderContext);
+        dmGameObject::Render(m_Collection);
+        dmRender::RenderListEnd(m_RenderContext);
+        dmRender::DrawRenderList(m_RenderContext, 0x0, 0x0, 0x0);
+
+        dmRender::BufferedRenderBuffer* buffer;
+        if (i == 0)
+        {
+            dmRender::BufferedRenderBuffer* ix_buffer;
+            dmGameSystem::GetSpriteWorldRenderBuffers(sprite_world, &buffer, &ix_buffer);
+        }
+        else
+        {
+            dmGameSystem::GetSpriteWorldInstanceBuffer(sprite_world, &buffer);
+        }
+        dmGraphics::VertexBuffer* gfx_buffer = (dmGraphics::VertexBuffer*) buffer->m_Buffers[0];
+        buffers[i].SetCapacity(gfx_buffer->m_Size);
+        buffers[i].PushArray((uint8_t*) gfx_buffer->m_Buffer, gfx_buffer->m_Size);
+
+        dmRender::ClearRenderObjects(m_RenderContext);
+
+        dmGameObject::Delete(m_Collection, go, true);
+        ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+        ASSERT_TRUE(dmGameObject::PostUpdate(m_Collection));
+    }
+
+    ASSERT_EQ(4 * sizeof(vs_format_regular), buffers[0].Size());
+    ASSERT_EQ(sizeof(inst_format_instanced), buffers[1].Size());
+
+    const vs_format_regular* vertices     = (const vs_format_regular*) buffers[0].Begin();
+    const inst_format_instanced* instance = (const inst_format_instanced*) buffers[1].Begin();
+
+    // The unit quad corners, transformed by the instance world matrix, are the vertex path positions
+    const Point3 corners[] = { Point3(-0.5f, -0.5f, 0.0f), Point3(-0.5f, 0.5f, 0.0f), Point3(0.5f, 0.5f, 0.0f), Point3(0.5f, -0.5f, 0.0f) };
+    Matrix4 world;
+    memcpy(&world, instance->mtx_world, sizeof(world));
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(corners); ++i)
+    {
+        Vector4 p = world * corners[i];
+        ASSERT_NEAR(vertices[i].position[0], p.getX(), EPSILON);
+        ASSERT_NEAR(vertices[i].position[1], p.getY(), EPSILON);
+        ASSERT_NEAR(vertices[i].position[2], p.getZ(), EPSILON);
+
+        // The sprite color is written per instance
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            ASSERT_NEAR(vertices[i].color[c], instance->color[c], EPSILON);
+        }
+    }
+    // The tint is not baked into the color, it's a render constant in both paths
+    ASSERT_NEAR(0.25f, instance->color[2], EPSILON);
+
+    ASSERT_TRUE(dmGameObject::Final(m_Collection));
+}
+
 TEST_F(ComponentTest, DispatchBuffersInstancingTest)
 {
     dmHashEnableReverseHash(true);
@@ -4177,6 +4522,43 @@ TEST_F(ScriptBufferTest, CreateBuffer)
     ASSERT_EQ(top, lua_gettop(L));
 }
 
+TEST_F(ScriptBufferTest, JsonDecodeStream)
+{
+    int top = lua_gettop(L);
+
+    ASSERT_TRUE(RunString(L, "json.decode_stream('{\"name\":\"level\",\"positions\":[1,2,3,4,5,6],\"ids\":[7,8]}', function(event, key, value) \
+                    if event == json.VALUE and key == \"positions\" then test_buffer = value end \
+                  end, { buffers = { positions = { type = buffer.VALUE_TYPE_FLOAT32, count = 3 } } })"));
+    lua_getglobal(L, "test_buffer");
+    dmScript::LuaHBuffer* buffer = dmScript::CheckBuffer(L, -1);
+    ASSERT_EQ(dmScript::OWNER_LUA, buffer->m_Owner);
+
+    uint32_t element_count = 0;
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetCount(buffer->m_Buffer, &element_count));
+    ASSERT_EQ(2u, element_count);
+
+    float* positions = 0;
+    uint32_t count = 0;
+    uint32_t components = 0;
+    uint32_t stride = 0;
+    ASSERT_EQ(dmBuffer::RESULT_OK, dmBuffer::GetStream(buffer->m_Buffer, dmHashString64("positions"), (void**)&positions, &count, &components, &stride));
+    ASSERT_EQ(3u, components);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        for (uint32_t c = 0; c < components; ++c)
+        {
+            ASSERT_EQ((float)(i * 3 + c + 1), positions[c]);
+        }
+        positions += stride;
+    }
+    lua_pop(L, 1);
+
+    ASSERT_TRUE(RunString(L, "local ok = pcall(json.decode_stream, '{\"positions\":[1,2,3,4]}', function() end, { buffers = { positions = { type = buffer.VALUE_TYPE_FLOAT32, count = 3 } } }) \
+                              assert(not ok)"));
+
+    ASSERT_EQ(top, lua_gettop(L));
+}
+
 TEST_F(ScriptBufferTest, GetBytes)
 {
     int top = lua_gettop(L);
@@ -4800,6 +5182,46 @@ TEST_F(RenderConstantsTest, HashRenderConstants)
     dmGameSystem::DestroyRenderConstants(constants);
 }
 
+TEST_F(RenderConstantsTest, Version)
+{
+    dmGameSystem::HComponentRenderConstants constants = dmGameSystem::CreateRenderConstants();
+
+    dmhash_t name_hash1 = dmHashString64("user_var1");
+    dmVMath::Vector4 value(1,2,3,4);
+    uint32_t version = dmGameSystem::GetRenderConstantsVersion(constants);
+    dmGameSystem::SetRenderConstant(constants, name_hash1, &value, 1);
+    ASSERT_NE(version, dmGameSystem::GetRenderConstantsVersion(constants));
+
+    dmRender::RenderObject ro;
+    dmGameSystem::EnableRenderObjectConstants(&ro, constants);
+    dmVMath::Vector4* values = 0;
+    uint32_t num_values = 0;
+    ASSERT_TRUE(dmRender::GetNamedConstant(ro.m_ConstantBuffer, name_hash1, &values, &num_values));
+    ASSERT_EQ(1U, num_values);
+    ASSERT_EQ(1.0f, values[0].getX());
+
+    // Setting the same value doesn't change the version
+    version = dmGameSystem::GetRenderConstantsVersion(constants);
+    dmGameSystem::SetRenderConstant(constants, name_hash1, &value, 1);
+    ASSERT_EQ(version, dmGameSystem::GetRenderConstantsVersion(constants));
+
+    // A new value is passed on to the constant buffer
+    value.setX(5.0f);
+    dmGameSystem::SetRenderConstant(constants, name_hash1, &value, 1);
+    ASSERT_NE(version, dmGameSystem::GetRenderConstantsVersion(constants));
+    dmGameSystem::EnableRenderObjectConstants(&ro, constants);
+    ASSERT_TRUE(dmRender::GetNamedConstant(ro.m_ConstantBuffer, name_hash1, &values, &num_values));
+    ASSERT_EQ(5.0f, values[0].getX());
+
+    version = dmGameSystem::GetRenderConstantsVersion(constants);
+    ASSERT_NE(0, dmGameSystem::ClearRenderConstant(constants, name_hash1));
+    ASSERT_NE(version, dmGameSystem::GetRenderConstantsVersion(constants));
+    dmGameSystem::EnableRenderObjectConstants(&ro, constants);
+    ASSERT_FALSE(dmRender::GetNamedConstant(ro.m_ConstantBuffer, name_hash1, &values, &num_values));
+
+    dmGameSystem::DestroyRenderConstants(constants);
+}
+
 #if !defined(DM_PLATFORM_VENDOR) // we need to fix our test material/shader compiler to work with the constants
 
 TEST_F(MaterialTest, CustomInstanceAttributes)
@@ -71,6 +71,7 @@ struct ProjectOptions {
   bool m_3D;
   float m_Scale;
   float m_VelocityThreshold;
+  uint32_t m_MaxSpriteCount;
 };
 
 template<typename T>
@@ -102,6 +103,7 @@ public:
         this->m_projectOptions.m_3D = false;
         this->m_projectOptions.m_Scale = 1.0f;
         this->m_projectOptions.m_VelocityThreshold = 1.0f;
+        this->m_projectOptions.m_MaxSpriteCount = 32;
     }
 protected:
     virtual void SetUp();
@@ -576,10 +578,11 @@ void GamesysTest<T>::SetUp()
     m_ParticleFXContext.m_MaxEmitterCount = 8;
 
     m_SpriteContext.m_RenderContext = m_RenderContext;
-    m_SpriteContext.m_MaxSpriteCount = 32;
+    m_SpriteContext.m_MaxSpriteCount = this->m_projectOptions.m_MaxSpriteCount;
 
     m_CollectionProxyContext.m_Factory = m_Factory;
     m_CollectionProxyContext.m_MaxCollectionProxyCount = 8;
+    m_CollectionProxyContext.m_InitTimeBudget = 4000;
 
     m_FactoryContext.m_MaxFactoryCount = 128;
     m_FactoryContext.m_ScriptContext = m_ScriptContext;
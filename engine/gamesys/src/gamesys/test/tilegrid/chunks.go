@@ -0,0 +1,8 @@
+components {
+  id: "tilemap"
+  component: "/tilegrid/chunks.tilemap"
+}
+components {
+  id: "script"
+  component: "/tilegrid/chunks.script"
+}
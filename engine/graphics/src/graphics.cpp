@@ -21,12 +21,20 @@
 #endif
 #include <string.h>
 #include <assert.h>
+#include <dlib/atomic.h>
 #include <dlib/profile.h>
 #include <dlib/math.h>
 
 DM_PROPERTY_GROUP(rmtp_Graphics, "Graphics");
 DM_PROPERTY_U32(rmtp_DrawCalls, 0, FrameReset, "# vertices", &rmtp_Graphics);
 DM_PROPERTY_U32(rmtp_DispatchCalls, 0, FrameReset, "# dispatches", &rmtp_Graphics);
+DM_PROPERTY_U32(rmtp_InstancedDrawCalls, 0, FrameReset, "# instanced draws", &rmtp_Graphics);
+DM_PROPERTY_U32(rmtp_ProgramChanges, 0, FrameReset, "# program changes", &rmtp_Graphics);
+DM_PROPERTY_U32(rmtp_TextureBinds, 0, FrameReset, "# texture binds", &rmtp_Graphics);
+DM_PROPERTY_U32(rmtp_ConstantUploads, 0, FrameReset, "# constant uploads", &rmtp_Graphics);
+DM_PROPERTY_U32(rmtp_VertexBytesUploaded, 0, FrameReset, "vertex bytes uploaded", &rmtp_Graphics);
+DM_PROPERTY_U32(rmtp_IndexBytesUploaded, 0, FrameReset, "index bytes uploaded", &rmtp_Graphics);
+DM_PROPERTY_U32(rmtp_TextureBytesUploaded, 0, FrameReset, "texture bytes uploaded", &rmtp_Graphics);
 
 #include <dlib/log.h>
 #include <dlib/dstrings.h>
@@ -37,6 +45,75 @@ namespace dmGraphics
     static GraphicsAdapter*             g_adapter = 0;
     static GraphicsAdapterFunctionTable g_functions;
 
+    // The render statistics are counted here, so that they're the same for all adapters
+    static Stats                        g_Stats;
+    static HProgram                     g_StatsProgram = 0;
+    static int32_atomic_t               g_TextureBytesUploaded = 0; // The textures may be set from the load threads
+
+    static inline void CountDraw(uint32_t instance_count)
+    {
+        g_Stats.m_DrawCalls++;
+        if (instance_count > 1)
+        {
+            g_Stats.m_InstancedDrawCalls++;
+            DM_PROPERTY_ADD_U32(rmtp_InstancedDrawCalls, 1);
+        }
+    }
+
+    static inline void CountVertexUpload(uint32_t size)
+    {
+        g_Stats.m_VertexBytesUploaded += size;
+        DM_PROPERTY_ADD_U32(rmtp_VertexBytesUploaded, size);
+    }
+
+    static inline void CountIndexUpload(uint32_t size)
+    {
+        g_Stats.m_IndexBytesUploaded += size;
+        DM_PROPERTY_ADD_U32(rmtp_IndexBytesUploaded, size);
+    }
+
+    static inline void CountTextureUpload(const TextureParams& params)
+    {
+        if (params.m_Data)
+        {
+            dmAtomicAdd32(&g_TextureBytesUploaded, (int32_t) params.m_DataSize);
+            DM_PROPERTY_ADD_U32(rmtp_TextureBytesUploaded, params.m_DataSize);
+        }
+    }
+
+    void GetStats(HContext context, Stats* out_stats)
+    {
+        (void) context;
+        *out_stats = g_Stats;
+        out_stats->m_TextureBytesUploaded = (uint32_t) dmAtomicGet32(&g_TextureBytesUploaded);
+    }
+
+    void SubtractStats(const Stats& end, const Stats& start, Stats* out)
+    {
+        out->m_DrawCalls            = end.m_DrawCalls - start.m_DrawCalls;
+        out->m_InstancedDrawCalls   = end.m_InstancedDrawCalls - start.m_InstancedDrawCalls;
+        out->m_DispatchCalls        = end.m_DispatchCalls - start.m_DispatchCalls;
+        out->m_ProgramChanges       = end.m_ProgramChanges - start.m_ProgramChanges;
+        out->m_TextureBinds         = end.m_TextureBinds - start.m_TextureBinds;
+        out->m_ConstantUploads      = end.m_ConstantUploads - start.m_ConstantUploads;
+        out->m_VertexBytesUploaded  = end.m_VertexBytesUploaded - start.m_VertexBytesUploaded;
+        out->m_IndexBytesUploaded   = end.m_IndexBytesUploaded - start.m_IndexBytesUploaded;
+        out->m_TextureBytesUploaded = end.m_TextureBytesUploaded - start.m_TextureBytesUploaded;
+    }
+
+    void AddStats(const Stats& stats, Stats* out)
+    {
+        out->m_DrawCalls            += stats.m_DrawCalls;
+        out->m_InstancedDrawCalls   += stats.m_InstancedDrawCalls;
+        out->m_DispatchCalls        += stats.m_DispatchCalls;
+        out->m_ProgramChanges       += stats.m_ProgramChanges;
+        out->m_TextureBinds         += stats.m_TextureBinds;
+        out->m_ConstantUploads      += stats.m_ConstantUploads;
+        out->m_VertexBytesUploaded  += stats.m_VertexBytesUploaded;
+        out->m_IndexBytesUploaded   += stats.m_IndexBytesUploaded;
+        out->m_TextureBytesUploaded += stats.m_TextureBytesUploaded;
+    }
+
     void RegisterGraphicsAdapter(GraphicsAdapter* adapter,
         GraphicsAdapterIsSupportedCb              is_supported_cb,
         GraphicsAdapterRegisterFunctionsCb        register_functions_cb,
@@ -1063,11 +1140,7 @@ namespace dmGraphics
     void PushSetTextureAsyncDeleteTexture(SetTextureAsyncState& state, HTexture texture)
     {
         DM_MUTEX_SCOPED_LOCK(state.m_Mutex);
-        if (state.m_PostDeleteTextures.Full())
-        {
-            state.m_PostDeleteTextures.OffsetCapacity(64);
-        }
-        state.m_PostDeleteTextures.Push(texture);
+        state.m_PostDeleteTextures.PushGrow(texture);
     }
 
     SetTextureAsyncParams GetSetTextureAsyncParams(SetTextureAsyncState& state, uint16_t index)
@@ -1204,6 +1277,8 @@ namespace dmGraphics
     }
     HVertexBuffer NewVertexBuffer(HContext context, uint32_t size, const void* data, BufferUsage buffer_usage)
     {
+        if (data)
+            CountVertexUpload(size);
         return g_functions.m_NewVertexBuffer(context, size, data, buffer_usage);
     }
     void DeleteVertexBuffer(HVertexBuffer buffer)
@@ -1212,22 +1287,99 @@ namespace dmGraphics
     }
     void SetVertexBufferData(HVertexBuffer buffer, uint32_t size, const void* data, BufferUsage buffer_usage)
     {
+        if (data)
+            CountVertexUpload(size);
         g_functions.m_SetVertexBufferData(buffer, size, data, buffer_usage);
     }
     void SetVertexBufferSubData(HVertexBuffer buffer, uint32_t offset, uint32_t size, const void* data)
     {
+        CountVertexUpload(size);
         g_functions.m_SetVertexBufferSubData(buffer, offset, size, data);
     }
     uint32_t GetVertexBufferSize(HVertexBuffer buffer)
     {
         return g_functions.m_GetVertexBufferSize(buffer);
     }
+    HDynamicVertexBuffer NewDynamicVertexBuffer(HContext context, uint32_t region_size)
+    {
+        if (!g_functions.m_NewDynamicVertexBuffer)
+            return 0;
+        return g_functions.m_NewDynamicVertexBuffer(context, region_size);
+    }
+    void DeleteDynamicVertexBuffer(HContext context, HDynamicVertexBuffer buffer)
+    {
+        if (buffer)
+            g_functions.m_DeleteDynamicVertexBuffer(context, buffer);
+    }
+    void BeginDynamicVertexBuffer(HContext context, HDynamicVertexBuffer buffer)
+    {
+        g_functions.m_BeginDynamicVertexBuffer(context, buffer);
+    }
+    void* ReserveDynamicVertexData(HContext context, HDynamicVertexBuffer buffer, uint32_t size, uint32_t* out_offset)
+    {
+        return g_functions.m_ReserveDynamicVertexData(context, buffer, size, out_offset);
+    }
+    void CommitDynamicVertexData(HContext context, HDynamicVertexBuffer buffer, uint32_t size)
+    {
+        CountVertexUpload(size);
+        g_functions.m_CommitDynamicVertexData(context, buffer, size);
+    }
+    HVertexBuffer GetDynamicVertexBufferHandle(HDynamicVertexBuffer buffer)
+    {
+        return g_functions.m_GetDynamicVertexBufferHandle(buffer);
+    }
+    bool IsGpuTimerSupported(HContext context)
+    {
+        return g_functions.m_IsGpuTimerSupported && g_functions.m_IsGpuTimerSupported(context);
+    }
+    void BeginGpuTimer(HContext context, uint32_t timer_id)
+    {
+        if (g_functions.m_BeginGpuTimer)
+            g_functions.m_BeginGpuTimer(context, timer_id);
+    }
+    void EndGpuTimer(HContext context)
+    {
+        if (g_functions.m_EndGpuTimer)
+            g_functions.m_EndGpuTimer(context);
+    }
+    void ResolveGpuTimers(HContext context, GpuTimerResultCallback callback, void* user_data)
+    {
+        if (g_functions.m_ResolveGpuTimers)
+            g_functions.m_ResolveGpuTimers(context, callback, user_data);
+    }
+    bool IsPixelReadbackSupported(HContext context)
+    {
+        return g_functions.m_IsPixelReadbackSupported && g_functions.m_IsPixelReadbackSupported(context);
+    }
+    bool ReadPixelsAsync(HContext context, uint32_t readback_id)
+    {
+        return g_functions.m_ReadPixelsAsync && g_functions.m_ReadPixelsAsync(context, readback_id);
+    }
+    void ResolvePixelReadbacks(HContext context, PixelReadbackCallback callback, void* user_data, bool wait)
+    {
+        if (g_functions.m_ResolvePixelReadbacks)
+            g_functions.m_ResolvePixelReadbacks(context, callback, user_data, wait);
+    }
+    bool IsMultiDrawIndirectSupported(HContext context)
+    {
+        return g_functions.m_IsMultiDrawIndirectSupported && g_functions.m_IsMultiDrawIndirectSupported(context);
+    }
+    void DrawElementsIndirect(HContext context, PrimitiveType prim_type, Type type, HIndexBuffer index_buffer, HVertexBuffer indirect_buffer, uint32_t indirect_offset, uint32_t draw_count)
+    {
+        if (!g_functions.m_DrawElementsIndirect)
+            return;
+        if (IsMultiDrawIndirectSupported(context) && draw_count > 0)
+            g_Stats.m_DrawCalls++;
+        g_functions.m_DrawElementsIndirect(context, prim_type, type, index_buffer, indirect_buffer, indirect_offset, draw_count);
+    }
     uint32_t GetMaxElementsVertices(HContext context)
     {
         return g_functions.m_GetMaxElementsVertices(context);
     }
     HIndexBuffer NewIndexBuffer(HContext context, uint32_t size, const void* data, BufferUsage buffer_usage)
     {
+        if (data)
+            CountIndexUpload(size);
         return g_functions.m_NewIndexBuffer(context, size, data, buffer_usage);
     }
     void DeleteIndexBuffer(HIndexBuffer buffer)
@@ -1236,10 +1388,13 @@ namespace dmGraphics
     }
     void SetIndexBufferData(HIndexBuffer buffer, uint32_t size, const void* data, BufferUsage buffer_usage)
     {
+        if (data)
+            CountIndexUpload(size);
         g_functions.m_SetIndexBufferData(buffer, size, data, buffer_usage);
     }
     void SetIndexBufferSubData(HIndexBuffer buffer, uint32_t offset, uint32_t size, const void* data)
     {
+        CountIndexUpload(size);
         g_functions.m_SetIndexBufferSubData(buffer, offset, size, data);
     }
     uint32_t GetIndexBufferSize(HIndexBuffer buffer)
@@ -1280,16 +1435,31 @@ namespace dmGraphics
     }
     void DrawElements(HContext context, PrimitiveType prim_type, uint32_t first, uint32_t count, Type type, HIndexBuffer index_buffer, uint32_t instance_count)
     {
+        CountDraw(instance_count);
         g_functions.m_DrawElements(context, prim_type, first, count, type, index_buffer, instance_count);
     }
     void Draw(HContext context, PrimitiveType prim_type, uint32_t first, uint32_t count, uint32_t instance_count)
     {
+        CountDraw(instance_count);
         g_functions.m_Draw(context, prim_type, first, count, instance_count);
     }
     void DispatchCompute(HContext context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
     {
+        g_Stats.m_DispatchCalls++;
         g_functions.m_DispatchCompute(context, group_count_x, group_count_y, group_count_z);
     }
+    bool IsComputeIndirectSupported(HContext context)
+    {
+        return g_functions.m_DispatchComputeIndirect && IsContextFeatureSupported(context, CONTEXT_FEATURE_COMPUTE_SHADER);
+    }
+    void DispatchComputeIndirect(HContext context, HVertexBuffer indirect_buffer, uint32_t indirect_offset)
+    {
+        if (!IsComputeIndirectSupported(context))
+            return;
+        assert((indirect_offset & 3) == 0);
+        g_Stats.m_DispatchCalls++;
+        g_functions.m_DispatchComputeIndirect(context, indirect_buffer, indirect_offset);
+    }
     HVertexProgram NewVertexProgram(HContext context, ShaderDesc* ddf, char* error_buffer, uint32_t error_buffer_size)
     {
         assert(ddf->m_ShaderType == dmGraphics::ShaderDesc::SHADER_TYPE_VERTEX);
@@ -1306,6 +1476,8 @@ namespace dmGraphics
     }
     void DeleteProgram(HContext context, HProgram program)
     {
+        if (program == g_StatsProgram)
+            g_StatsProgram = 0;
         g_functions.m_DeleteProgram(context, program);
     }
     bool ReloadVertexProgram(HVertexProgram prog, ShaderDesc* ddf)
@@ -1336,10 +1508,17 @@ namespace dmGraphics
     }
     void EnableProgram(HContext context, HProgram program)
     {
+        if (program != g_StatsProgram)
+        {
+            g_StatsProgram = program;
+            g_Stats.m_ProgramChanges++;
+            DM_PROPERTY_ADD_U32(rmtp_ProgramChanges, 1);
+        }
         g_functions.m_EnableProgram(context, program);
     }
     void DisableProgram(HContext context)
     {
+        g_StatsProgram = 0;
         g_functions.m_DisableProgram(context);
     }
     bool ReloadProgram(HContext context, HProgram program, HVertexProgram vert_program, HFragmentProgram frag_program)
@@ -1377,10 +1556,14 @@ namespace dmGraphics
     }
     void SetConstantV4(HContext context, const dmVMath::Vector4* data, int count, HUniformLocation base_location)
     {
+        g_Stats.m_ConstantUploads++;
+        DM_PROPERTY_ADD_U32(rmtp_ConstantUploads, 1);
         g_functions.m_SetConstantV4(context, data, count, base_location);
     }
     void SetConstantM4(HContext context, const dmVMath::Vector4* data, int count, HUniformLocation base_location)
     {
+        g_Stats.m_ConstantUploads++;
+        DM_PROPERTY_ADD_U32(rmtp_ConstantUploads, 1);
         g_functions.m_SetConstantM4(context, data, count, base_location);
     }
     void SetSampler(HContext context, HUniformLocation location, int32_t unit)
@@ -1489,10 +1672,12 @@ namespace dmGraphics
     }
     void SetTexture(HTexture texture, const TextureParams& params)
     {
+        CountTextureUpload(params);
         g_functions.m_SetTexture(texture, params);
     }
     void SetTextureAsync(HTexture texture, const TextureParams& params, SetTextureAsyncCallback callback, void* user_data)
     {
+        CountTextureUpload(params);
         g_functions.m_SetTextureAsync(texture, params, callback, user_data);
     }
     void SetTextureParams(HTexture texture, TextureFilter minfilter, TextureFilter magfilter, TextureWrap uwrap, TextureWrap vwrap, float max_anisotropy)
@@ -1533,6 +1718,8 @@ namespace dmGraphics
     }
     void EnableTexture(HContext context, uint32_t unit, uint8_t id_index, HTexture texture)
     {
+        g_Stats.m_TextureBinds++;
+        DM_PROPERTY_ADD_U32(rmtp_TextureBinds, 1);
         g_functions.m_EnableTexture(context, unit, id_index, texture);
     }
     void DisableTexture(HContext context, uint32_t unit, HTexture texture)
@@ -276,6 +276,7 @@ namespace dmGraphics
         uint32_t              m_Height;
         uint32_t              m_GraphicsMemorySize;             // The max allowed Gfx memory (default 0)
         uint32_t              m_SwapInterval;                   // Initial VSync setting (default 1)
+        const char*           m_PipelineCachePath;              // Vulkan and OpenGL. File where compiled pipelines or program binaries are kept between runs (default 0)
         uint8_t               m_VerifyGraphicsCalls : 1;
         uint8_t               m_PrintDeviceInfo : 1;
         uint8_t               m_RenderDocSupport : 1;           // Vulkan only
@@ -599,10 +600,126 @@ namespace dmGraphics
     uint32_t GetVertexBufferSize(HVertexBuffer vertex_buffer);
     uint32_t GetIndexBufferSize(HIndexBuffer buffer);
 
+    /** Dynamic vertex buffers
+     * Vertex buffers for data that is written each frame, directly into mapped buffer memory. The buffer is a ring of
+     * DYNAMIC_VERTEX_BUFFER_REGION_COUNT regions, and BeginDynamicVertexBuffer() moves to the next region once per frame,
+     * waiting for the GPU if it is still reading from it. The data is written between ReserveDynamicVertexData() and
+     * CommitDynamicVertexData(), and drawn with the returned offset as the base offset of the vertex declaration.
+     * Only supported by some adapters (OpenGL 3 / ES 3 and up). NewDynamicVertexBuffer() returns 0 otherwise, and the
+     * data should be uploaded with SetVertexBufferData() as usual.
+     */
+    static const uint32_t DYNAMIC_VERTEX_BUFFER_REGION_COUNT = 3;
+    typedef struct DynamicVertexBuffer* HDynamicVertexBuffer;
+
+    HDynamicVertexBuffer NewDynamicVertexBuffer(HContext context, uint32_t region_size);
+    void                 DeleteDynamicVertexBuffer(HContext context, HDynamicVertexBuffer buffer);
+    void                 BeginDynamicVertexBuffer(HContext context, HDynamicVertexBuffer buffer);
+    // Returns a pointer to at least size bytes, or 0 if the current region is full. out_offset is the offset into the vertex buffer.
+    void*                ReserveDynamicVertexData(HContext context, HDynamicVertexBuffer buffer, uint32_t size, uint32_t* out_offset);
+    // Ends the writes since the last reserve, where size (<= the reserved size) is the number of bytes written
+    void                 CommitDynamicVertexData(HContext context, HDynamicVertexBuffer buffer, uint32_t size);
+    // The handle to bind when drawing. The buffer must not be deleted with DeleteVertexBuffer().
+    HVertexBuffer        GetDynamicVertexBufferHandle(HDynamicVertexBuffer buffer);
+
     void     DrawElements(HContext context, PrimitiveType prim_type, uint32_t first, uint32_t count, Type type, HIndexBuffer index_buffer, uint32_t instance_count);
     void     Draw(HContext context, PrimitiveType prim_type, uint32_t first, uint32_t count, uint32_t instance_count);
     void     DispatchCompute(HContext context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z);
 
+    /** GPU timers
+     * Measures the GPU time spent between BeginGpuTimer() and EndGpuTimer(). Timers can't be nested, and at most
+     * MAX_GPU_TIMERS_PER_FRAME timers are recorded per frame. The results are not available until the GPU has finished
+     * the frame, which is usually a few frames later, and ResolveGpuTimers() calls the callback once for each timer
+     * of every frame that has finished since the last call.
+     * Only supported by some adapters (Vulkan, and OpenGL with timer queries). IsGpuTimerSupported() returns false
+     * otherwise, and the other functions do nothing.
+     */
+    static const uint32_t MAX_GPU_TIMERS_PER_FRAME = 256;
+    typedef void (*GpuTimerResultCallback)(void* user_data, uint32_t timer_id, uint64_t elapsed_ns);
+
+    bool     IsGpuTimerSupported(HContext context);
+    void     BeginGpuTimer(HContext context, uint32_t timer_id);
+    void     EndGpuTimer(HContext context);
+    void     ResolveGpuTimers(HContext context, GpuTimerResultCallback callback, void* user_data);
+
+    /** Asynchronous pixel readback
+     * Copies the back buffer into one of MAX_PIXEL_READBACKS staging buffers, without waiting for the GPU. Call
+     * ReadPixelsAsync() when the frame has been rendered, before Flip(). The pixels are in the same format as with
+     * ReadPixels(). ResolvePixelReadbacks() calls the callback once for each readback that has finished since the last
+     * call, oldest first, and frees its buffer. The pixels are only valid during the callback. With wait set, it
+     * waits for all the readbacks in flight.
+     * Only supported by some adapters (Vulkan, and OpenGL with buffer mapping and sync objects).
+     * IsPixelReadbackSupported() returns false otherwise, and the other functions do nothing.
+     */
+    static const uint32_t MAX_PIXEL_READBACKS = 3;
+    typedef void (*PixelReadbackCallback)(void* user_data, uint32_t readback_id, const void* pixels, uint32_t size);
+
+    bool     IsPixelReadbackSupported(HContext context);
+    // Returns false if all the buffers are in flight, and the frame wasn't read
+    bool     ReadPixelsAsync(HContext context, uint32_t readback_id);
+    void     ResolvePixelReadbacks(HContext context, PixelReadbackCallback callback, void* user_data, bool wait);
+
+    /** Multi-draw indirect
+     * Draws draw_count indexed draw calls with one call, where the arguments of each draw are read by the GPU from
+     * indirect_buffer, starting at the byte offset indirect_offset. The commands are tightly packed
+     * DrawIndexedIndirectCommand structs. Instance attributes are offset by m_FirstInstance, so that every draw can
+     * read its own range of a shared instance buffer.
+     * Only supported by some adapters (Vulkan, and OpenGL 4.3+). IsMultiDrawIndirectSupported() returns false
+     * otherwise, and DrawElementsIndirect() does nothing.
+     */
+    struct DrawIndexedIndirectCommand
+    {
+        uint32_t m_IndexCount;
+        uint32_t m_InstanceCount;
+        uint32_t m_FirstIndex;   // In indices, not bytes
+        int32_t  m_VertexOffset; // Added to each index before fetching the vertex
+        uint32_t m_FirstInstance;
+    };
+
+    bool     IsMultiDrawIndirectSupported(HContext context);
+    void     DrawElementsIndirect(HContext context, PrimitiveType prim_type, Type type, HIndexBuffer index_buffer, HVertexBuffer indirect_buffer, uint32_t indirect_offset, uint32_t draw_count);
+
+    /** Indirect compute dispatch
+     * Dispatches the enabled compute program, where the group counts are read by the GPU from indirect_buffer at the
+     * byte offset indirect_offset (which must be a multiple of 4), as a DispatchIndirectCommand. The buffer can be
+     * written by an earlier compute dispatch, so that the work size never has to be read back to the CPU.
+     * On Vulkan, storage buffers (VulkanNewStorageBuffer) can be used as indirect buffers as well, and vertex buffers
+     * can be bound as storage buffers.
+     * Supported wherever compute shaders are (CONTEXT_FEATURE_COMPUTE_SHADER), except for the null adapter, where
+     * DispatchComputeIndirect() does nothing.
+     */
+    struct DispatchIndirectCommand
+    {
+        uint32_t m_GroupCountX;
+        uint32_t m_GroupCountY;
+        uint32_t m_GroupCountZ;
+    };
+
+    bool     IsComputeIndirectSupported(HContext context);
+    void     DispatchComputeIndirect(HContext context, HVertexBuffer indirect_buffer, uint32_t indirect_offset);
+
+    /** Render statistics
+     * Counted by the graphics functions, whatever the adapter is. The counters only increase (and wrap around), so the
+     * statistics of a frame, or of a part of it, are the difference between two calls to GetStats().
+     */
+    struct Stats
+    {
+        uint32_t m_DrawCalls;               // Including the instanced and the indirect draws
+        uint32_t m_InstancedDrawCalls;      // Draws of more than one instance
+        uint32_t m_DispatchCalls;
+        uint32_t m_ProgramChanges;          // Enabled programs that weren't already enabled
+        uint32_t m_TextureBinds;
+        uint32_t m_ConstantUploads;
+        uint32_t m_VertexBytesUploaded;
+        uint32_t m_IndexBytesUploaded;
+        uint32_t m_TextureBytesUploaded;
+    };
+
+    void     GetStats(HContext context, Stats* out_stats);
+    // out = end - start
+    void     SubtractStats(const Stats& end, const Stats& start, Stats* out);
+    // out += stats
+    void     AddStats(const Stats& stats, Stats* out);
+
     // Shaders
     HVertexProgram       NewVertexProgram(HContext context, ShaderDesc* ddf, char* error_buffer, uint32_t error_buffer_size);
     HFragmentProgram     NewFragmentProgram(HContext context, ShaderDesc* ddf, char* error_buffer, uint32_t error_buffer_size);
@@ -876,6 +993,13 @@ namespace dmGraphics
      */
     bool IsFormatTranscoded(TextureImage::CompressionType format);
 
+    /** checks if the texture format is a block compressed gpu format
+     * @name IsTextureFormatCompressed
+     * @param format [type: dmGraphics::TextureFormat] the texture format
+     * @return true if the format is compressed
+     */
+    bool IsTextureFormatCompressed(TextureFormat format);
+
     /** checks if the texture format is compressed
      * @name Transcode
      * @param path The path of the texture
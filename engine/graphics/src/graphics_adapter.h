@@ -67,6 +67,22 @@ namespace dmGraphics
     typedef void (*SetVertexBufferDataFn)(HVertexBuffer buffer, uint32_t size, const void* data, BufferUsage buffer_usage);
     typedef void (*SetVertexBufferSubDataFn)(HVertexBuffer buffer, uint32_t offset, uint32_t size, const void* data);
     typedef uint32_t (*GetVertexBufferSizeFn)(HVertexBuffer buffer);
+    typedef HDynamicVertexBuffer (*NewDynamicVertexBufferFn)(HContext context, uint32_t region_size);
+    typedef void (*DeleteDynamicVertexBufferFn)(HContext context, HDynamicVertexBuffer buffer);
+    typedef void (*BeginDynamicVertexBufferFn)(HContext context, HDynamicVertexBuffer buffer);
+    typedef void* (*ReserveDynamicVertexDataFn)(HContext context, HDynamicVertexBuffer buffer, uint32_t size, uint32_t* out_offset);
+    typedef void (*CommitDynamicVertexDataFn)(HContext context, HDynamicVertexBuffer buffer, uint32_t size);
+    typedef HVertexBuffer (*GetDynamicVertexBufferHandleFn)(HDynamicVertexBuffer buffer);
+    typedef bool (*IsGpuTimerSupportedFn)(HContext context);
+    typedef void (*BeginGpuTimerFn)(HContext context, uint32_t timer_id);
+    typedef void (*EndGpuTimerFn)(HContext context);
+    typedef void (*ResolveGpuTimersFn)(HContext context, GpuTimerResultCallback callback, void* user_data);
+    typedef bool (*IsPixelReadbackSupportedFn)(HContext context);
+    typedef bool (*ReadPixelsAsyncFn)(HContext context, uint32_t readback_id);
+    typedef void (*ResolvePixelReadbacksFn)(HContext context, PixelReadbackCallback callback, void* user_data, bool wait);
+    typedef bool (*IsMultiDrawIndirectSupportedFn)(HContext context);
+    typedef void (*DrawElementsIndirectFn)(HContext context, PrimitiveType prim_type, Type type, HIndexBuffer index_buffer, HVertexBuffer indirect_buffer, uint32_t indirect_offset, uint32_t draw_count);
+    typedef void (*DispatchComputeIndirectFn)(HContext context, HVertexBuffer indirect_buffer, uint32_t indirect_offset);
     typedef uint32_t (*GetMaxElementsVerticesFn)(HContext context);
     typedef HIndexBuffer (*NewIndexBufferFn)(HContext context, uint32_t size, const void* data, BufferUsage buffer_usage);
     typedef void (*DeleteIndexBufferFn)(HIndexBuffer buffer);
@@ -183,6 +199,27 @@ namespace dmGraphics
         SetVertexBufferDataFn m_SetVertexBufferData;
         SetVertexBufferSubDataFn m_SetVertexBufferSubData;
         GetVertexBufferSizeFn m_GetVertexBufferSize;
+        // Optional, and not part of DM_REGISTER_GRAPHICS_FUNCTION_TABLE (see NewDynamicVertexBuffer)
+        NewDynamicVertexBufferFn m_NewDynamicVertexBuffer;
+        DeleteDynamicVertexBufferFn m_DeleteDynamicVertexBuffer;
+        BeginDynamicVertexBufferFn m_BeginDynamicVertexBuffer;
+        ReserveDynamicVertexDataFn m_ReserveDynamicVertexData;
+        CommitDynamicVertexDataFn m_CommitDynamicVertexData;
+        GetDynamicVertexBufferHandleFn m_GetDynamicVertexBufferHandle;
+        // Optional, and not part of DM_REGISTER_GRAPHICS_FUNCTION_TABLE (see IsGpuTimerSupported)
+        IsGpuTimerSupportedFn m_IsGpuTimerSupported;
+        BeginGpuTimerFn m_BeginGpuTimer;
+        EndGpuTimerFn m_EndGpuTimer;
+        ResolveGpuTimersFn m_ResolveGpuTimers;
+        // Optional, and not part of DM_REGISTER_GRAPHICS_FUNCTION_TABLE (see IsPixelReadbackSupported)
+        IsPixelReadbackSupportedFn m_IsPixelReadbackSupported;
+        ReadPixelsAsyncFn m_ReadPixelsAsync;
+        ResolvePixelReadbacksFn m_ResolvePixelReadbacks;
+        // Optional, and not part of DM_REGISTER_GRAPHICS_FUNCTION_TABLE (see IsMultiDrawIndirectSupported)
+        IsMultiDrawIndirectSupportedFn m_IsMultiDrawIndirectSupported;
+        DrawElementsIndirectFn m_DrawElementsIndirect;
+        // Optional, and not part of DM_REGISTER_GRAPHICS_FUNCTION_TABLE (see IsComputeIndirectSupported)
+        DispatchComputeIndirectFn m_DispatchComputeIndirect;
         GetMaxElementsVerticesFn m_GetMaxElementsVertices;
         NewIndexBufferFn m_NewIndexBuffer;
         DeleteIndexBufferFn m_DeleteIndexBuffer;
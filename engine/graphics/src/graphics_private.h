@@ -164,6 +164,11 @@ namespace dmGraphics
             uint16_t m_StorageBufferUnit;
         };
 
+        // Vulkan: where the uniform block was last copied to the scratch buffer, to reuse
+        // the copy for as long as the data hasn't changed. 0 means that it needs to be copied.
+        uint32_t m_UploadVersion;
+        uint32_t m_UploadOffset;
+
         uint8_t m_StageFlags;
     };
 
@@ -176,7 +181,6 @@ namespace dmGraphics
     void                 SetForceFragmentReloadFail(bool should_fail);
     void                 SetForceVertexReloadFail(bool should_fail);
     void                 SetPipelineStateValue(PipelineState& pipeline_state, State state, uint8_t value);
-    bool                 IsTextureFormatCompressed(TextureFormat format);
     bool                 IsUniformTextureSampler(ShaderDesc::ShaderDataType uniform_type);
     bool                 IsUniformStorageBuffer(ShaderDesc::ShaderDataType uniform_type);
     void                 RepackRGBToRGBA(uint32_t num_pixels, uint8_t* rgb, uint8_t* rgba);
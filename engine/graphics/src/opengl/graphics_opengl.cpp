@@ -23,6 +23,7 @@
 #include <dlib/array.h>
 #include <dlib/thread.h>
 #include <dlib/time.h>
+#include <dlib/sys.h>
 #include <dmsdk/dlib/vmath.h>
 #include <dmsdk/dlib/dstrings.h>
 
@@ -423,6 +424,67 @@ static void LogFrameBufferError(GLenum status)
     typedef void (* DM_PFNGLDRAWBUFFERSPROC) (GLsizei n, const GLenum *bufs);
     DM_PFNGLDRAWBUFFERSPROC PFN_glDrawBuffers = NULL;
 
+    // Mapped buffers and fences, for the dynamic vertex buffers. GLsync is an opaque pointer, but the type isn't declared by all headers.
+    typedef void* DM_GLsync;
+
+    typedef void (* DM_PFNGLBUFFERSTORAGEPROC) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+    DM_PFNGLBUFFERSTORAGEPROC PFN_glBufferStorage = NULL;
+
+    typedef void* (* DM_PFNGLMAPBUFFERRANGEPROC) (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+    DM_PFNGLMAPBUFFERRANGEPROC PFN_glMapBufferRange = NULL;
+
+    typedef void (* DM_PFNGLFLUSHMAPPEDBUFFERRANGEPROC) (GLenum target, GLintptr offset, GLsizeiptr length);
+    DM_PFNGLFLUSHMAPPEDBUFFERRANGEPROC PFN_glFlushMappedBufferRange = NULL;
+
+    typedef GLboolean (* DM_PFNGLUNMAPBUFFERPROC) (GLenum target);
+    DM_PFNGLUNMAPBUFFERPROC PFN_glUnmapBuffer = NULL;
+
+    typedef DM_GLsync (* DM_PFNGLFENCESYNCPROC) (GLenum condition, GLbitfield flags);
+    DM_PFNGLFENCESYNCPROC PFN_glFenceSync = NULL;
+
+    typedef GLenum (* DM_PFNGLCLIENTWAITSYNCPROC) (DM_GLsync sync, GLbitfield flags, uint64_t timeout);
+    DM_PFNGLCLIENTWAITSYNCPROC PFN_glClientWaitSync = NULL;
+
+    typedef void (* DM_PFNGLDELETESYNCPROC) (DM_GLsync sync);
+    DM_PFNGLDELETESYNCPROC PFN_glDeleteSync = NULL;
+
+    // Timer queries, for the GPU timers
+    typedef void (* DM_PFNGLGENQUERIESPROC) (GLsizei n, GLuint *ids);
+    DM_PFNGLGENQUERIESPROC PFN_glGenQueries = NULL;
+
+    typedef void (* DM_PFNGLDELETEQUERIESPROC) (GLsizei n, const GLuint *ids);
+    DM_PFNGLDELETEQUERIESPROC PFN_glDeleteQueries = NULL;
+
+    typedef void (* DM_PFNGLBEGINQUERYPROC) (GLenum target, GLuint id);
+    DM_PFNGLBEGINQUERYPROC PFN_glBeginQuery = NULL;
+
+    typedef void (* DM_PFNGLENDQUERYPROC) (GLenum target);
+    DM_PFNGLENDQUERYPROC PFN_glEndQuery = NULL;
+
+    typedef void (* DM_PFNGLGETQUERYOBJECTUIVPROC) (GLuint id, GLenum pname, GLuint *params);
+    DM_PFNGLGETQUERYOBJECTUIVPROC PFN_glGetQueryObjectuiv = NULL;
+
+    typedef void (* DM_PFNGLGETQUERYOBJECTUI64VPROC) (GLuint id, GLenum pname, uint64_t *params);
+    DM_PFNGLGETQUERYOBJECTUI64VPROC PFN_glGetQueryObjectui64v = NULL;
+
+    // Program binaries, for the program cache
+    typedef void (* DM_PFNGLGETPROGRAMBINARYPROC) (GLuint program, GLsizei buf_size, GLsizei *length, GLenum *binary_format, void *binary);
+    DM_PFNGLGETPROGRAMBINARYPROC PFN_glGetProgramBinary = NULL;
+
+    typedef void (* DM_PFNGLPROGRAMBINARYPROC) (GLuint program, GLenum binary_format, const void *binary, GLsizei length);
+    DM_PFNGLPROGRAMBINARYPROC PFN_glProgramBinary = NULL;
+
+    typedef void (* DM_PFNGLPROGRAMPARAMETERIPROC) (GLuint program, GLenum pname, GLint value);
+    DM_PFNGLPROGRAMPARAMETERIPROC PFN_glProgramParameteri = NULL;
+
+    // Multi-draw indirect, for DrawElementsIndirect
+    typedef void (* DM_PFNGLMULTIDRAWELEMENTSINDIRECTPROC) (GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+    DM_PFNGLMULTIDRAWELEMENTSINDIRECTPROC PFN_glMultiDrawElementsIndirect = NULL;
+
+    // Indirect compute dispatch, for DispatchComputeIndirect
+    typedef void (* DM_PFNGLDISPATCHCOMPUTEINDIRECTPROC) (GLintptr indirect);
+    DM_PFNGLDISPATCHCOMPUTEINDIRECTPROC PFN_glDispatchComputeIndirect = NULL;
+
     // Note: This is necessary for webgl and android to work since we don't load core functions with emsc,
     //       however we might want to do this the other way around perhaps? i.e special case for webgl
     //       and load functions like this for all other platforms.
@@ -488,6 +550,7 @@ static void LogFrameBufferError(GLenum status)
         m_Height                  = params.m_Height;
         m_Window                  = params.m_Window;
         m_JobThread               = params.m_JobThread;
+        m_PipelineCachePath       = params.m_PipelineCachePath ? strdup(params.m_PipelineCachePath) : 0;
 
         // We need to have some sort of valid default filtering
         if (m_DefaultTextureMinFilter == TEXTURE_FILTER_DEFAULT)
@@ -544,6 +607,19 @@ static void LogFrameBufferError(GLenum status)
         return state_lut[state];
     }
 
+    // Forgets the cached GL state, e.g. when something outside of the adapter may have changed it
+    static void InvalidateStateCache(OpenGLContext* context)
+    {
+        ResetStateCache(&context->m_StateCache, dmAtomicGet32(&context->m_TextureBindingsVersion));
+    }
+
+    // Called whenever textures are bound or deleted outside of EnableTexture/DisableTexture.
+    // May be called from the worker thread.
+    static inline void InvalidateTextureBindings(OpenGLContext* context)
+    {
+        dmAtomicIncrement32(&context->m_TextureBindingsVersion);
+    }
+
     static GLenum GetOpenGLType(Type type)
     {
         const GLenum type_lut[] = {
@@ -662,6 +738,203 @@ static void LogFrameBufferError(GLenum status)
         return 0x0;
     }
 
+    static const uint32_t PROGRAM_BINARY_CACHE_MAGIC   = 0x42504d44; // "DMPB"
+    static const uint32_t PROGRAM_BINARY_CACHE_VERSION = 1;
+
+    // The program cache file is this header, followed by an entry and the binary data for each program
+    struct ProgramBinaryCacheHeader
+    {
+        uint32_t m_Magic;
+        uint32_t m_Version;
+        uint64_t m_DriverHash;
+        uint32_t m_Count;
+        uint32_t m_Reserved;
+    };
+
+    struct ProgramBinaryCacheEntry
+    {
+        uint64_t m_Key;
+        uint32_t m_Format;
+        uint32_t m_Size;
+    };
+
+    static void PutProgramBinary(OpenGLContext* context, uint64_t key, const OpenGLProgramBinary& binary)
+    {
+        dmHashTable64<OpenGLProgramBinary>& binaries = context->m_ProgramBinaries;
+        if (binaries.Full())
+        {
+            uint32_t capacity = binaries.Capacity() + 64;
+            binaries.SetCapacity(capacity / 2, capacity);
+        }
+        binaries.Put(key, binary);
+    }
+
+    static bool LoadProgramFromBinary(OpenGLContext* context, GLuint program, uint64_t key)
+    {
+        if (!context->m_ProgramBinarySupport)
+        {
+            return false;
+        }
+
+        OpenGLProgramBinary* binary = context->m_ProgramBinaries.Get(key);
+        if (binary == 0x0)
+        {
+            return false;
+        }
+
+        PFN_glProgramBinary(program, binary->m_Format, binary->m_Data, binary->m_Size);
+        CLEAR_GL_ERROR;
+
+        GLint status = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status == 0)
+        {
+            // The driver may reject a binary at any time (e.g. after an update), in which case the shaders are linked again
+            free(binary->m_Data);
+            context->m_ProgramBinaries.Erase(key);
+            context->m_ProgramBinariesDirty = 1;
+            return false;
+        }
+        return true;
+    }
+
+    static void StoreProgramBinary(OpenGLContext* context, GLuint program, uint64_t key)
+    {
+        if (!context->m_ProgramBinarySupport || context->m_ProgramBinaries.Get(key) != 0x0)
+        {
+            return;
+        }
+
+        GLint size = 0;
+        glGetProgramiv(program, DMGRAPHICS_PROGRAM_BINARY_LENGTH, &size);
+        CLEAR_GL_ERROR;
+        if (size <= 0)
+        {
+            return;
+        }
+
+        OpenGLProgramBinary binary;
+        binary.m_Data   = (uint8_t*) malloc(size);
+        binary.m_Format = 0;
+
+        GLsizei length = 0;
+        PFN_glGetProgramBinary(program, size, &length, &binary.m_Format, binary.m_Data);
+        CLEAR_GL_ERROR;
+        if (length <= 0)
+        {
+            free(binary.m_Data);
+            return;
+        }
+
+        binary.m_Size = (uint32_t) length;
+        PutProgramBinary(context, key, binary);
+        context->m_ProgramBinariesDirty = 1;
+    }
+
+    static void LoadProgramBinaries(OpenGLContext* context)
+    {
+        uint32_t data_size = 0;
+        if (!context->m_PipelineCachePath || dmSys::ResourceSize(context->m_PipelineCachePath, &data_size) != dmSys::RESULT_OK || data_size < sizeof(ProgramBinaryCacheHeader))
+        {
+            return;
+        }
+
+        uint8_t* data = (uint8_t*) malloc(data_size);
+        ProgramBinaryCacheHeader header;
+        if (dmSys::LoadResource(context->m_PipelineCachePath, data, data_size, &data_size) != dmSys::RESULT_OK || data_size < sizeof(header))
+        {
+            free(data);
+            return;
+        }
+
+        memcpy(&header, data, sizeof(header));
+        if (header.m_Magic != PROGRAM_BINARY_CACHE_MAGIC || header.m_Version != PROGRAM_BINARY_CACHE_VERSION || header.m_DriverHash != context->m_DriverHash)
+        {
+            dmLogInfo("Discarding the program cache '%s', it was created for another device or driver.", context->m_PipelineCachePath);
+            free(data);
+            return;
+        }
+
+        uint32_t offset = sizeof(header);
+        for (uint32_t i = 0; i < header.m_Count; ++i)
+        {
+            ProgramBinaryCacheEntry entry;
+            if (offset + sizeof(entry) > data_size)
+                break;
+            memcpy(&entry, data + offset, sizeof(entry));
+            offset += sizeof(entry);
+
+            if (entry.m_Size == 0 || entry.m_Size > data_size - offset)
+                break;
+
+            OpenGLProgramBinary binary;
+            binary.m_Data   = (uint8_t*) malloc(entry.m_Size);
+            binary.m_Size   = entry.m_Size;
+            binary.m_Format = entry.m_Format;
+            memcpy(binary.m_Data, data + offset, entry.m_Size);
+            offset += entry.m_Size;
+
+            PutProgramBinary(context, entry.m_Key, binary);
+        }
+        free(data);
+    }
+
+    static void WriteProgramBinaryEntry(FILE* file, const uint64_t* key, OpenGLProgramBinary* binary)
+    {
+        ProgramBinaryCacheEntry entry;
+        entry.m_Key    = *key;
+        entry.m_Format = binary->m_Format;
+        entry.m_Size   = binary->m_Size;
+        fwrite(&entry, sizeof(entry), 1, file);
+        fwrite(binary->m_Data, 1, binary->m_Size, file);
+    }
+
+    static void SaveProgramBinaries(OpenGLContext* context)
+    {
+        if (!context->m_PipelineCachePath || !context->m_ProgramBinariesDirty)
+        {
+            return;
+        }
+
+        ProgramBinaryCacheHeader header;
+        memset(&header, 0, sizeof(header));
+        header.m_Magic      = PROGRAM_BINARY_CACHE_MAGIC;
+        header.m_Version    = PROGRAM_BINARY_CACHE_VERSION;
+        header.m_DriverHash = context->m_DriverHash;
+        header.m_Count      = context->m_ProgramBinaries.Size();
+
+        // Write to a temporary file first, so that we never leave a partially written cache behind
+        char tmp_path[1024];
+        dmSnPrintf(tmp_path, sizeof(tmp_path), "%s.tmp", context->m_PipelineCachePath);
+
+        FILE* file = fopen(tmp_path, "wb");
+        if (file)
+        {
+            fwrite(&header, sizeof(header), 1, file);
+            context->m_ProgramBinaries.Iterate(WriteProgramBinaryEntry, file);
+            bool written = ferror(file) == 0;
+            fclose(file);
+
+            if (!written || dmSys::Rename(context->m_PipelineCachePath, tmp_path) != dmSys::RESULT_OK)
+            {
+                dmLogWarning("Unable to write the program cache to '%s'", context->m_PipelineCachePath);
+                dmSys::Unlink(tmp_path);
+            }
+        }
+        context->m_ProgramBinariesDirty = 0;
+    }
+
+    static void FreeProgramBinary(void*, const uint64_t*, OpenGLProgramBinary* binary)
+    {
+        free(binary->m_Data);
+    }
+
+    static void DeleteProgramBinaries(OpenGLContext* context)
+    {
+        context->m_ProgramBinaries.Iterate(FreeProgramBinary, (void*) 0);
+        context->m_ProgramBinaries.Clear();
+    }
+
     static void OpenGLDeleteContext(HContext _context)
     {
         OpenGLContext* context = (OpenGLContext*) _context;
@@ -670,6 +943,9 @@ static void LogFrameBufferError(GLenum status)
             dmAtomicStore32(&context->m_DeleteContextRequested, 1);
             AcquireAuxContextOnThread(context, false);
             ResetSetTextureAsyncState(context->m_SetTextureAsyncState);
+            SaveProgramBinaries(context);
+            DeleteProgramBinaries(context);
+            free(context->m_PipelineCachePath);
             delete context;
             g_Context = 0x0;
         }
@@ -1128,6 +1404,24 @@ static void LogFrameBufferError(GLenum status)
 
         DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glInvalidateFramebuffer,   "glDiscardFramebuffer", "discard_framebuffer", "glInvalidateFramebuffer", DM_PFNGLINVALIDATEFRAMEBUFFERPROC, context);
         DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glDrawBuffers,             "glDrawBuffers",        "draw_buffers",        "glDrawBuffers",           DM_PFNGLDRAWBUFFERSPROC, context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glBufferStorage,           "glBufferStorage",           "buffer_storage",   "glBufferStorage",           DM_PFNGLBUFFERSTORAGEPROC,          context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glMapBufferRange,          "glMapBufferRange",          "map_buffer_range", "glMapBufferRange",          DM_PFNGLMAPBUFFERRANGEPROC,         context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glFlushMappedBufferRange,  "glFlushMappedBufferRange",  "map_buffer_range", "glFlushMappedBufferRange",  DM_PFNGLFLUSHMAPPEDBUFFERRANGEPROC, context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glUnmapBuffer,             "glUnmapBuffer",             NULL,               "glUnmapBuffer",             DM_PFNGLUNMAPBUFFERPROC,            context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glFenceSync,               "glFenceSync",               "sync",             "glFenceSync",               DM_PFNGLFENCESYNCPROC,              context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glClientWaitSync,          "glClientWaitSync",          "sync",             "glClientWaitSync",          DM_PFNGLCLIENTWAITSYNCPROC,         context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glDeleteSync,              "glDeleteSync",              "sync",             "glDeleteSync",              DM_PFNGLDELETESYNCPROC,             context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glGenQueries,              "glGenQueries",              "disjoint_timer_query", "glGenQueries",          DM_PFNGLGENQUERIESPROC,             context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glDeleteQueries,           "glDeleteQueries",           "disjoint_timer_query", "glDeleteQueries",       DM_PFNGLDELETEQUERIESPROC,          context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glBeginQuery,              "glBeginQuery",              "disjoint_timer_query", "glBeginQuery",          DM_PFNGLBEGINQUERYPROC,             context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glEndQuery,                "glEndQuery",                "disjoint_timer_query", "glEndQuery",            DM_PFNGLENDQUERYPROC,               context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glGetQueryObjectuiv,       "glGetQueryObjectuiv",       "disjoint_timer_query", "glGetQueryObjectuiv",   DM_PFNGLGETQUERYOBJECTUIVPROC,      context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glGetQueryObjectui64v,     "glGetQueryObjectui64v",     "disjoint_timer_query", "glGetQueryObjectui64v", DM_PFNGLGETQUERYOBJECTUI64VPROC,    context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glGetProgramBinary,        "glGetProgramBinary",        "get_program_binary",   "glGetProgramBinary",    DM_PFNGLGETPROGRAMBINARYPROC,       context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glProgramBinary,           "glProgramBinary",           "get_program_binary",   "glProgramBinary",       DM_PFNGLPROGRAMBINARYPROC,          context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glProgramParameteri,       "glProgramParameteri",       "get_program_binary",   "glProgramParameteri",   DM_PFNGLPROGRAMPARAMETERIPROC,      context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glMultiDrawElementsIndirect, "glMultiDrawElementsIndirect", "multi_draw_indirect", "glMultiDrawElementsIndirect", DM_PFNGLMULTIDRAWELEMENTSINDIRECTPROC, context);
+        DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glDispatchComputeIndirect, "glDispatchComputeIndirect", "compute_shader", "glDispatchComputeIndirect", DM_PFNGLDISPATCHCOMPUTEINDIRECTPROC, context);
     #ifdef ANDROID
         DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glTexSubImage3D,           "glTexSubImage3D",           "texture_array",           "glTexSubImage3D",           DM_PFNGLTEXSUBIMAGE3DPROC,           context);
         DMGRAPHICS_GET_PROC_ADDRESS_EXT(PFN_glTexImage3D,              "glTexImage3D",              "texture_array",           "glTexImage3D",              DM_PFNGLTEXIMAGE3DPROC,              context);
@@ -1225,6 +1519,11 @@ static void LogFrameBufferError(GLenum status)
             context->m_InstancingSupport &= PFN_glDrawElementsInstanced != 0;
             context->m_InstancingSupport &= PFN_glVertexAttribDivisor   != 0;
         #endif
+
+            // Dynamic vertex buffers are written through mapped memory, and the fences tell when the GPU is done with a region
+            context->m_MapBufferRangeSupport = PFN_glMapBufferRange != 0 && PFN_glFlushMappedBufferRange != 0 && PFN_glUnmapBuffer != 0 &&
+                                               PFN_glFenceSync != 0 && PFN_glClientWaitSync != 0 && PFN_glDeleteSync != 0;
+            context->m_BufferStorageSupport  = context->m_MapBufferRangeSupport && PFN_glBufferStorage != 0;
         }
         else
         {
@@ -1243,6 +1542,48 @@ static void LogFrameBufferError(GLenum status)
             }
         }
 
+        // https://registry.khronos.org/OpenGL/extensions/ARB/ARB_timer_query.txt
+        // https://registry.khronos.org/OpenGL/extensions/EXT/EXT_disjoint_timer_query.txt
+        context->m_TimerQueryDisjoint = OpenGLIsExtensionSupported(context, "GL_EXT_disjoint_timer_query");
+        context->m_TimerQuerySupport  = PFN_glGenQueries != 0 && PFN_glDeleteQueries != 0 && PFN_glBeginQuery != 0 && PFN_glEndQuery != 0 &&
+                                        PFN_glGetQueryObjectuiv != 0 && PFN_glGetQueryObjectui64v != 0 &&
+                                        (context->m_TimerQueryDisjoint || OpenGLIsExtensionSupported(context, "GL_ARB_timer_query"));
+
+        // https://registry.khronos.org/OpenGL/extensions/ARB/ARB_get_program_binary.txt
+        // https://registry.khronos.org/OpenGL/extensions/OES/OES_get_program_binary.txt
+        // GLES 2 has no retrievable hint, the binaries are always retrievable there
+        context->m_ProgramBinarySupport = PFN_glGetProgramBinary != 0 && PFN_glProgramBinary != 0;
+        if (context->m_ProgramBinarySupport)
+        {
+            GLint format_count = 0;
+            glGetIntegerv(DMGRAPHICS_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+            CLEAR_GL_ERROR;
+            context->m_ProgramBinarySupport = format_count > 0;
+        }
+        if (context->m_ProgramBinarySupport)
+        {
+            HashState64 driver_hash_state;
+            dmHashInit64(&driver_hash_state, false);
+            const char* driver_strings[] = { (const char*) glGetString(GL_VENDOR), (const char*) glGetString(GL_RENDERER), (const char*) glGetString(GL_VERSION) };
+            for (uint32_t i = 0; i < DM_ARRAY_SIZE(driver_strings); ++i)
+            {
+                if (driver_strings[i])
+                    dmHashUpdateBuffer64(&driver_hash_state, driver_strings[i], strlen(driver_strings[i]));
+            }
+            context->m_DriverHash = dmHashFinal64(&driver_hash_state);
+
+            context->m_ProgramBinaries.SetCapacity(32, 64);
+            context->m_ProgramBinaries.Clear();
+            LoadProgramBinaries(context);
+        }
+
+        // https://registry.khronos.org/OpenGL/extensions/ARB/ARB_multi_draw_indirect.txt
+        // https://registry.khronos.org/OpenGL/extensions/ARB/ARB_base_instance.txt
+        // The base instance is needed as well, since that is how each draw finds its instance data
+        context->m_MultiDrawIndirectSupport = PFN_glMultiDrawElementsIndirect != 0 &&
+                                              OpenGLIsExtensionSupported(context, "GL_ARB_multi_draw_indirect") &&
+                                              OpenGLIsExtensionSupported(context, "GL_ARB_base_instance");
+
         // GL_NUM_COMPRESSED_TEXTURE_FORMATS is deprecated in newer OpenGL Versions
         GLint iNumCompressedFormats = 0;
         glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &iNumCompressedFormats);
@@ -1436,6 +1777,8 @@ static void LogFrameBufferError(GLenum status)
         }
 #endif
 
+        InvalidateStateCache(context);
+
         SetSwapInterval(_context, params.m_SwapInterval);
 
         return true;
@@ -1448,6 +1791,39 @@ static void LogFrameBufferError(GLenum status)
         return context->m_Window;
     }
 
+    static void DeleteGpuTimers(OpenGLContext* context)
+    {
+        for (uint32_t i = 0; i < GPU_TIMER_FRAME_COUNT; ++i)
+        {
+            OpenGLGpuTimerFrame& frame = context->m_GpuTimerFrames[i];
+            if (frame.m_Queries[0])
+            {
+                PFN_glDeleteQueries(MAX_GPU_TIMERS_PER_FRAME, frame.m_Queries);
+            }
+            memset(&frame, 0, sizeof(frame));
+        }
+        context->m_GpuTimerFrame  = 0;
+        context->m_GpuTimerActive = 0;
+    }
+
+    static void DeletePixelReadbacks(OpenGLContext* context)
+    {
+        for (uint32_t i = 0; i < MAX_PIXEL_READBACKS; ++i)
+        {
+            OpenGLPixelReadback& readback = context->m_PixelReadbacks[i];
+            if (readback.m_Fence)
+            {
+                PFN_glDeleteSync(readback.m_Fence);
+            }
+            if (readback.m_Buffer)
+            {
+                glDeleteBuffersARB(1, &readback.m_Buffer);
+            }
+            memset(&readback, 0, sizeof(readback));
+        }
+        context->m_PixelReadback = 0;
+    }
+
     static void OpenGLCloseWindow(HContext _context)
     {
         assert(_context);
@@ -1456,6 +1832,9 @@ static void LogFrameBufferError(GLenum status)
         {
             PostDeleteTextures(context, true);
 
+            DeleteGpuTimers(context);
+            DeletePixelReadbacks(context);
+
             context->m_Width = 0;
             context->m_Height = 0;
             context->m_Extensions.SetSize(0);
@@ -1563,6 +1942,93 @@ static void LogFrameBufferError(GLenum status)
 #if defined(ANDROID)
         dmPlatform::AndroidBeginFrame(((OpenGLContext*) context)->m_Window);
 #endif
+        // Don't trust state from the previous frame, in case it was changed outside of the adapter
+        InvalidateStateCache((OpenGLContext*) context);
+    }
+
+    static bool OpenGLIsGpuTimerSupported(HContext _context)
+    {
+        return ((OpenGLContext*) _context)->m_TimerQuerySupport;
+    }
+
+    static void OpenGLBeginGpuTimer(HContext _context, uint32_t timer_id)
+    {
+        OpenGLContext* context = (OpenGLContext*) _context;
+        OpenGLGpuTimerFrame& frame = context->m_GpuTimerFrames[context->m_GpuTimerFrame];
+
+        // The timers are dropped if the GPU is more than GPU_TIMER_FRAME_COUNT frames behind
+        if (!context->m_TimerQuerySupport || context->m_GpuTimerActive || frame.m_Pending || frame.m_Count == MAX_GPU_TIMERS_PER_FRAME)
+        {
+            return;
+        }
+
+        if (frame.m_Queries[0] == 0)
+        {
+            PFN_glGenQueries(MAX_GPU_TIMERS_PER_FRAME, frame.m_Queries);
+            CHECK_GL_ERROR;
+        }
+
+        frame.m_TimerIds[frame.m_Count] = timer_id;
+        PFN_glBeginQuery(DMGRAPHICS_TIME_ELAPSED, frame.m_Queries[frame.m_Count]);
+        CHECK_GL_ERROR;
+        frame.m_Count++;
+        context->m_GpuTimerActive = 1;
+    }
+
+    static void OpenGLEndGpuTimer(HContext _context)
+    {
+        OpenGLContext* context = (OpenGLContext*) _context;
+        if (!context->m_GpuTimerActive)
+        {
+            return;
+        }
+        PFN_glEndQuery(DMGRAPHICS_TIME_ELAPSED);
+        CHECK_GL_ERROR;
+        context->m_GpuTimerActive = 0;
+    }
+
+    static void OpenGLResolveGpuTimers(HContext _context, GpuTimerResultCallback callback, void* user_data)
+    {
+        OpenGLContext* context = (OpenGLContext*) _context;
+        if (!context->m_TimerQuerySupport)
+        {
+            return;
+        }
+
+        // Reading the flag also clears it, so it covers all the frames resolved below
+        GLint disjoint = 0;
+        if (context->m_TimerQueryDisjoint)
+        {
+            glGetIntegerv(DMGRAPHICS_GPU_DISJOINT, &disjoint);
+        }
+
+        // Oldest frame first. The queries finish in order, so we can stop at the first frame that isn't done.
+        for (uint32_t i = 1; i <= GPU_TIMER_FRAME_COUNT; ++i)
+        {
+            OpenGLGpuTimerFrame& frame = context->m_GpuTimerFrames[(context->m_GpuTimerFrame + i) % GPU_TIMER_FRAME_COUNT];
+            if (!frame.m_Pending)
+            {
+                continue;
+            }
+
+            GLuint available = 0;
+            PFN_glGetQueryObjectuiv(frame.m_Queries[frame.m_Count - 1], DMGRAPHICS_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                break;
+            }
+
+            for (uint32_t j = 0; j < frame.m_Count && !disjoint; ++j)
+            {
+                uint64_t elapsed_ns = 0;
+                PFN_glGetQueryObjectui64v(frame.m_Queries[j], DMGRAPHICS_QUERY_RESULT, &elapsed_ns);
+                callback(user_data, frame.m_TimerIds[j], elapsed_ns);
+            }
+
+            frame.m_Count   = 0;
+            frame.m_Pending = 0;
+        }
+        CHECK_GL_ERROR;
     }
 
     static void OpenGLFlip(HContext _context)
@@ -1570,6 +2036,18 @@ static void LogFrameBufferError(GLenum status)
         DM_PROFILE(__FUNCTION__);
         OpenGLContext* context = (OpenGLContext*) _context;
         PostDeleteTextures(context, false);
+
+        if (context->m_GpuTimerActive)
+        {
+            OpenGLEndGpuTimer(_context);
+        }
+        OpenGLGpuTimerFrame& timer_frame = context->m_GpuTimerFrames[context->m_GpuTimerFrame];
+        if (timer_frame.m_Count > 0)
+        {
+            timer_frame.m_Pending = 1;
+            context->m_GpuTimerFrame = (context->m_GpuTimerFrame + 1) % GPU_TIMER_FRAME_COUNT;
+        }
+
         dmPlatform::SwapBuffers(context->m_Window);
         CHECK_GL_ERROR;
     }
@@ -1657,6 +2135,181 @@ static void LogFrameBufferError(GLenum status)
         return vertex_buffer->m_MemorySize;
     }
 
+    static void WaitForFence(void* fence)
+    {
+        DM_PROFILE(__FUNCTION__);
+        // Wait in steps of 1ms, the call can't wait forever
+        const uint64_t timeout = 1000000;
+        GLenum result = PFN_glClientWaitSync(fence, DMGRAPHICS_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        while (result == DMGRAPHICS_TIMEOUT_EXPIRED)
+        {
+            result = PFN_glClientWaitSync(fence, 0, timeout);
+        }
+        if (result == DMGRAPHICS_WAIT_FAILED)
+        {
+            dmLogWarning("Failed to wait for vertex buffer fence");
+        }
+    }
+
+    static HDynamicVertexBuffer OpenGLNewDynamicVertexBuffer(HContext _context, uint32_t region_size)
+    {
+        OpenGLContext* context = (OpenGLContext*) _context;
+        if (!context->m_MapBufferRangeSupport || region_size == 0)
+        {
+            return 0;
+        }
+
+        OpenGLDynamicVertexBuffer* buffer = new OpenGLDynamicVertexBuffer();
+        memset(buffer, 0, sizeof(*buffer));
+        buffer->m_Buffer.m_Type       = DEVICE_BUFFER_TYPE_VERTEX;
+        buffer->m_Buffer.m_MemorySize = region_size * DYNAMIC_VERTEX_BUFFER_REGION_COUNT;
+        buffer->m_RegionSize          = region_size;
+
+        glGenBuffersARB(1, &buffer->m_Buffer.m_Id);
+        CHECK_GL_ERROR;
+        glBindBufferARB(GL_ARRAY_BUFFER_ARB, buffer->m_Buffer.m_Id);
+        CHECK_GL_ERROR;
+
+        if (context->m_BufferStorageSupport)
+        {
+            // Mapped once, for the lifetime of the buffer. Coherent, so that the writes don't need to be flushed.
+            const GLbitfield flags = DMGRAPHICS_MAP_WRITE_BIT | DMGRAPHICS_MAP_PERSISTENT_BIT | DMGRAPHICS_MAP_COHERENT_BIT;
+            PFN_glBufferStorage(GL_ARRAY_BUFFER_ARB, buffer->m_Buffer.m_MemorySize, 0, flags);
+            CHECK_GL_ERROR;
+            buffer->m_Mapped = (uint8_t*) PFN_glMapBufferRange(GL_ARRAY_BUFFER_ARB, 0, buffer->m_Buffer.m_MemorySize, flags);
+            CHECK_GL_ERROR;
+            buffer->m_Persistent = buffer->m_Mapped != 0;
+        }
+        else
+        {
+            glBufferDataARB(GL_ARRAY_BUFFER_ARB, buffer->m_Buffer.m_MemorySize, 0, GL_DYNAMIC_DRAW);
+            CHECK_GL_ERROR;
+        }
+
+        glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+        CHECK_GL_ERROR;
+
+        if (context->m_BufferStorageSupport && !buffer->m_Persistent)
+        {
+            dmLogWarning("Failed to map dynamic vertex buffer");
+            glDeleteBuffersARB(1, &buffer->m_Buffer.m_Id);
+            delete buffer;
+            return 0;
+        }
+        return (HDynamicVertexBuffer) buffer;
+    }
+
+    static void OpenGLDeleteDynamicVertexBuffer(HContext context, HDynamicVertexBuffer _buffer)
+    {
+        OpenGLDynamicVertexBuffer* buffer = (OpenGLDynamicVertexBuffer*) _buffer;
+        for (uint32_t i = 0; i < DYNAMIC_VERTEX_BUFFER_REGION_COUNT; ++i)
+        {
+            if (buffer->m_Fences[i])
+                PFN_glDeleteSync(buffer->m_Fences[i]);
+        }
+        if (buffer->m_Mapped)
+        {
+            glBindBufferARB(GL_ARRAY_BUFFER_ARB, buffer->m_Buffer.m_Id);
+            PFN_glUnmapBuffer(GL_ARRAY_BUFFER_ARB);
+            glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+        }
+        glDeleteBuffersARB(1, &buffer->m_Buffer.m_Id);
+        CHECK_GL_ERROR;
+        delete buffer;
+    }
+
+    static void OpenGLBeginDynamicVertexBuffer(HContext context, HDynamicVertexBuffer _buffer)
+    {
+        DM_PROFILE(__FUNCTION__);
+        OpenGLDynamicVertexBuffer* buffer = (OpenGLDynamicVertexBuffer*) _buffer;
+        assert(buffer->m_Persistent || buffer->m_Mapped == 0); // Reserved, but not committed
+
+        // The draws reading from the current region have been issued, so the fence is signaled after them
+        if (buffer->m_Fences[buffer->m_Region])
+            PFN_glDeleteSync(buffer->m_Fences[buffer->m_Region]);
+        buffer->m_Fences[buffer->m_Region] = PFN_glFenceSync(DMGRAPHICS_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        CHECK_GL_ERROR;
+
+        buffer->m_Region = (buffer->m_Region + 1) % DYNAMIC_VERTEX_BUFFER_REGION_COUNT;
+        buffer->m_Offset = 0;
+
+        void* fence = buffer->m_Fences[buffer->m_Region];
+        if (fence)
+        {
+            WaitForFence(fence);
+            PFN_glDeleteSync(fence);
+            buffer->m_Fences[buffer->m_Region] = 0;
+        }
+    }
+
+    static void* OpenGLReserveDynamicVertexData(HContext context, HDynamicVertexBuffer _buffer, uint32_t size, uint32_t* out_offset)
+    {
+        OpenGLDynamicVertexBuffer* buffer = (OpenGLDynamicVertexBuffer*) _buffer;
+        if (size == 0 || buffer->m_Offset + size > buffer->m_RegionSize)
+        {
+            return 0;
+        }
+
+        uint32_t region_start = buffer->m_Region * buffer->m_RegionSize;
+        uint8_t* data = 0;
+        if (buffer->m_Persistent)
+        {
+            data = buffer->m_Mapped + region_start + buffer->m_Offset;
+        }
+        else
+        {
+            assert(buffer->m_Mapped == 0);
+            // The fences keep track of the regions in use, so the mapping doesn't need to wait for the GPU
+            const GLbitfield flags = DMGRAPHICS_MAP_WRITE_BIT | DMGRAPHICS_MAP_INVALIDATE_RANGE_BIT | DMGRAPHICS_MAP_UNSYNCHRONIZED_BIT | DMGRAPHICS_MAP_FLUSH_EXPLICIT_BIT;
+            glBindBufferARB(GL_ARRAY_BUFFER_ARB, buffer->m_Buffer.m_Id);
+            CHECK_GL_ERROR;
+            buffer->m_Mapped = (uint8_t*) PFN_glMapBufferRange(GL_ARRAY_BUFFER_ARB, region_start + buffer->m_Offset, buffer->m_RegionSize - buffer->m_Offset, flags);
+            CHECK_GL_ERROR;
+            glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+            CHECK_GL_ERROR;
+            buffer->m_MappedOffset = buffer->m_Offset;
+            data = buffer->m_Mapped;
+        }
+
+        if (data)
+        {
+            buffer->m_Reserved = size;
+            *out_offset = region_start + buffer->m_Offset;
+        }
+        return data;
+    }
+
+    static void OpenGLCommitDynamicVertexData(HContext context, HDynamicVertexBuffer _buffer, uint32_t size)
+    {
+        OpenGLDynamicVertexBuffer* buffer = (OpenGLDynamicVertexBuffer*) _buffer;
+        assert(size <= buffer->m_Reserved);
+
+        if (!buffer->m_Persistent && buffer->m_Mapped)
+        {
+            glBindBufferARB(GL_ARRAY_BUFFER_ARB, buffer->m_Buffer.m_Id);
+            CHECK_GL_ERROR;
+            if (size > 0)
+            {
+                PFN_glFlushMappedBufferRange(GL_ARRAY_BUFFER_ARB, buffer->m_Offset - buffer->m_MappedOffset, size);
+                CHECK_GL_ERROR;
+            }
+            PFN_glUnmapBuffer(GL_ARRAY_BUFFER_ARB);
+            CHECK_GL_ERROR;
+            glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+            CHECK_GL_ERROR;
+            buffer->m_Mapped = 0;
+        }
+
+        // Keep the next allocation aligned
+        buffer->m_Offset   = dmMath::Min(buffer->m_RegionSize, (buffer->m_Offset + size + 15) & ~15U);
+        buffer->m_Reserved = 0;
+    }
+
+    static HVertexBuffer OpenGLGetDynamicVertexBufferHandle(HDynamicVertexBuffer buffer)
+    {
+        return (HVertexBuffer) &((OpenGLDynamicVertexBuffer*) buffer)->m_Buffer;
+    }
+
     static uint32_t OpenGLGetMaxElementsVertices(HContext context)
     {
         return ((OpenGLContext*) context)->m_MaxElementVertices;
@@ -1831,9 +2484,23 @@ static void LogFrameBufferError(GLenum status)
         dmLogInfo("Attribute: %d, %d, %d, %d, %d, %d", loc, component_count, opengl_type, normalize, stride, offset);
     #endif
 
-        // TODO: We should cache these bindings and skip applying them if they haven't changed
-        glEnableVertexAttribArray(loc);
-        CHECK_GL_ERROR;
+        OpenGLStateCache& cache = context->m_StateCache;
+        if (loc < 32)
+        {
+            uint32_t loc_bit = 1 << loc;
+            if (!(cache.m_Known & STATE_CACHE_VERTEX_ATTRIBS) || !(cache.m_EnabledVertexAttribs & loc_bit))
+            {
+                glEnableVertexAttribArray(loc);
+                CHECK_GL_ERROR;
+                cache.m_EnabledVertexAttribs |= loc_bit;
+            }
+            cache.m_UsedVertexAttribs |= loc_bit;
+        }
+        else
+        {
+            glEnableVertexAttribArray(loc);
+            CHECK_GL_ERROR;
+        }
 
         glVertexAttribPointer(
             loc,
@@ -1863,6 +2530,14 @@ static void LogFrameBufferError(GLenum status)
             BindVertexDeclarationProgram(context, vertex_declaration, program);
         }
 
+        // The attributes of all declarations enabled before a draw call are used by it,
+        // the rest are disabled in DrawSetup
+        if (context->m_StateCache.m_VertexAttribsApplied)
+        {
+            context->m_StateCache.m_UsedVertexAttribs    = 0;
+            context->m_StateCache.m_VertexAttribsApplied = 0;
+        }
+
         for (uint32_t i=0; i<vertex_declaration->m_StreamCount; i++)
         {
             if (vertex_declaration->m_Streams[i].m_Location != -1)
@@ -1893,6 +2568,7 @@ static void LogFrameBufferError(GLenum status)
         assert(context);
         assert(vertex_declaration);
 
+        // Attributes tracked by the state cache are left enabled, and disabled by the next draw call that doesn't use them
         for (uint32_t i=0; i<vertex_declaration->m_StreamCount; i++)
         {
             if (vertex_declaration->m_Streams[i].m_Location != -1)
@@ -1902,8 +2578,11 @@ static void LogFrameBufferError(GLenum status)
 
                 for (int j = 0; j < sub_vector_count; ++j)
                 {
-                    glDisableVertexAttribArray(base_location + j);
-                    CHECK_GL_ERROR;
+                    if (base_location + j >= 32)
+                    {
+                        glDisableVertexAttribArray(base_location + j);
+                        CHECK_GL_ERROR;
+                    }
                 }
             }
         }
@@ -1915,10 +2594,29 @@ static void LogFrameBufferError(GLenum status)
         CHECK_GL_ERROR;
     }
 
+    static void ApplyVertexAttribs(OpenGLContext* context)
+    {
+        OpenGLStateCache& cache = context->m_StateCache;
+        uint32_t unused = cache.m_EnabledVertexAttribs & ~cache.m_UsedVertexAttribs;
+        for (uint32_t loc = 0; unused; ++loc, unused >>= 1)
+        {
+            if (unused & 1)
+            {
+                glDisableVertexAttribArray(loc);
+                CHECK_GL_ERROR;
+            }
+        }
+        cache.m_EnabledVertexAttribs = cache.m_UsedVertexAttribs;
+        cache.m_Known               |= STATE_CACHE_VERTEX_ATTRIBS;
+        cache.m_VertexAttribsApplied = 1;
+    }
+
     static void DrawSetup(OpenGLContext* context)
     {
         OpenGLProgram* program = context->m_CurrentProgram;
 
+        ApplyVertexAttribs(context);
+
         if (context->m_IsGles3Version)
         {
             for (int i = 0; i < program->m_UniformBuffers.Size(); ++i)
@@ -1970,6 +2668,47 @@ static void LogFrameBufferError(GLenum status)
         }
     }
 
+    static bool OpenGLIsMultiDrawIndirectSupported(HContext context)
+    {
+        return ((OpenGLContext*) context)->m_MultiDrawIndirectSupport;
+    }
+
+    static void OpenGLDrawElementsIndirect(HContext _context, PrimitiveType prim_type, Type type, HIndexBuffer index_buffer, HVertexBuffer indirect_buffer, uint32_t indirect_offset, uint32_t draw_count)
+    {
+        OpenGLContext* context = (OpenGLContext*) _context;
+        if (!context->m_MultiDrawIndirectSupport || draw_count == 0)
+        {
+            return;
+        }
+
+        DM_PROFILE(__FUNCTION__);
+        DM_PROPERTY_ADD_U32(rmtp_DrawCalls, 1);
+        assert(index_buffer);
+        assert(indirect_buffer);
+
+        DrawSetup(context);
+
+    #ifdef DM_HAVE_PLATFORM_COMPUTE_SUPPORT
+        // The commands may have been written by a compute program
+        if (context->m_ComputeSupport)
+        {
+            glMemoryBarrier(DMGRAPHICS_BARRIER_BIT_COMMAND);
+            CHECK_GL_ERROR;
+        }
+    #endif
+
+        glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER, ((OpenGLBuffer*) index_buffer)->m_Id);
+        CHECK_GL_ERROR;
+        glBindBufferARB(DMGRAPHICS_DRAW_INDIRECT_BUFFER, ((OpenGLBuffer*) indirect_buffer)->m_Id);
+        CHECK_GL_ERROR;
+
+        PFN_glMultiDrawElementsIndirect(GetOpenGLPrimitiveType(prim_type), GetOpenGLType(type), (GLvoid*)(uintptr_t) indirect_offset, draw_count, sizeof(DrawIndexedIndirectCommand));
+        CHECK_GL_ERROR;
+
+        glBindBufferARB(DMGRAPHICS_DRAW_INDIRECT_BUFFER, 0);
+        CHECK_GL_ERROR;
+    }
+
     static void OpenGLDraw(HContext context, PrimitiveType prim_type, uint32_t first, uint32_t count, uint32_t instance_count)
     {
         DM_PROFILE(__FUNCTION__);
@@ -1984,25 +2723,56 @@ static void LogFrameBufferError(GLenum status)
             glDrawArraysInstanced(GetOpenGLPrimitiveType(prim_type), first, count, dmMath::Max((uint32_t) 1, instance_count));
             CHECK_GL_ERROR;
         }
-        else
-        {
-            glDrawArrays(GetOpenGLPrimitiveType(prim_type), first, count);
-            CHECK_GL_ERROR
-        }
+        else
+        {
+            glDrawArrays(GetOpenGLPrimitiveType(prim_type), first, count);
+            CHECK_GL_ERROR
+        }
+    }
+
+    static void OpenGLDispatchCompute(HContext _context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+    {
+    #ifdef DM_HAVE_PLATFORM_COMPUTE_SUPPORT
+        OpenGLContext* context = (OpenGLContext*) _context;
+        if (context->m_ComputeSupport)
+        {
+            DM_PROFILE(__FUNCTION__);
+            DM_PROPERTY_ADD_U32(rmtp_DispatchCalls, 1);
+
+            DrawSetup((OpenGLContext*) _context);
+
+            glDispatchCompute(group_count_x, group_count_y, group_count_z);
+            CHECK_GL_ERROR;
+
+            glMemoryBarrier(DMGRAPHICS_BARRIER_BIT_SHADER_IMAGE_ACCESS);
+            CHECK_GL_ERROR;
+        }
+    #endif
     }
 
-    static void OpenGLDispatchCompute(HContext _context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+    static void OpenGLDispatchComputeIndirect(HContext _context, HVertexBuffer indirect_buffer, uint32_t indirect_offset)
     {
     #ifdef DM_HAVE_PLATFORM_COMPUTE_SUPPORT
         OpenGLContext* context = (OpenGLContext*) _context;
-        if (context->m_ComputeSupport)
+        if (context->m_ComputeSupport && PFN_glDispatchComputeIndirect)
         {
             DM_PROFILE(__FUNCTION__);
             DM_PROPERTY_ADD_U32(rmtp_DispatchCalls, 1);
+            assert(indirect_buffer);
 
-            DrawSetup((OpenGLContext*) _context);
+            DrawSetup(context);
 
-            glDispatchCompute(group_count_x, group_count_y, group_count_z);
+            // The group counts may have been written by an earlier dispatch
+            glMemoryBarrier(DMGRAPHICS_BARRIER_BIT_COMMAND);
+            CHECK_GL_ERROR;
+
+            glBindBufferARB(DMGRAPHICS_DISPATCH_INDIRECT_BUFFER, ((OpenGLBuffer*) indirect_buffer)->m_Id);
+            CHECK_GL_ERROR;
+
+            PFN_glDispatchComputeIndirect((GLintptr) indirect_offset);
+            CHECK_GL_ERROR;
+
+            glBindBufferARB(DMGRAPHICS_DISPATCH_INDIRECT_BUFFER, 0);
             CHECK_GL_ERROR;
 
             glMemoryBarrier(DMGRAPHICS_BARRIER_BIT_SHADER_IMAGE_ACCESS);
@@ -2082,6 +2852,7 @@ static void LogFrameBufferError(GLenum status)
         }
         OpenGLShader* shader = new OpenGLShader();
         shader->m_Id         = shader_id;
+        shader->m_SourceHash = dmHashBuffer64(ddf_shader->m_Source.m_Data, ddf_shader->m_Source.m_Count);
         shader->m_Language   = ddf_shader->m_Language;
 
         CreateShaderMeta(&ddf->m_Reflection, &shader->m_ShaderMeta);
@@ -2233,6 +3004,18 @@ static void LogFrameBufferError(GLenum status)
         }
     }
 
+    // The size of the cached value of a uniform outside of a uniform block, zero for types that aren't cached
+    static uint32_t GetUniformValueSize(GLenum type, GLint count)
+    {
+        if (type == GL_FLOAT_VEC4)
+            return sizeof(GLfloat) * 4 * count;
+        else if (type == GL_FLOAT_MAT4)
+            return sizeof(GLfloat) * 16 * count;
+        else if (IsTypeTextureType(GetGraphicsType(type)))
+            return sizeof(GLint) * count;
+        return 0;
+    }
+
     static void BuildUniforms(OpenGLContext* context, OpenGLProgram* program, OpenGLShader** shaders, uint32_t num_shaders)
     {
         if (context->m_IsGles3Version)
@@ -2300,6 +3083,9 @@ static void LogFrameBufferError(GLenum status)
             uniform.m_Count         = uniform_size;
             uniform.m_Type          = uniform_type;
             uniform.m_IsTextureType = IsTypeTextureType(GetGraphicsType(uniform_type));
+            uniform.m_ValueOffset   = 0;
+            uniform.m_ValueSize     = uniform_block_index == -1 ? GetUniformValueSize(uniform_type, uniform_size) : 0;
+            uniform.m_ValueKnownSize = 0;
 
         #if 0
             dmLogInfo("Uniform[%d]: %s, %llu", i, uniform.m_Name, uniform.m_Location);
@@ -2317,6 +3103,59 @@ static void LogFrameBufferError(GLenum status)
                 CLEAR_GL_ERROR
             }
         }
+
+        uint32_t value_size = 0;
+        for (int i = 0; i < num_uniforms; ++i)
+        {
+            program->m_Uniforms[i].m_ValueOffset = value_size;
+            value_size += program->m_Uniforms[i].m_ValueSize;
+        }
+        program->m_UniformValues.SetCapacity(value_size);
+        program->m_UniformValues.SetSize(value_size);
+    }
+
+    // Relinking a program resets the values of its uniforms
+    static void ResetUniformValues(OpenGLProgram* program)
+    {
+        for (int i = 0; i < program->m_Uniforms.Size(); ++i)
+        {
+            program->m_Uniforms[i].m_ValueKnownSize = 0;
+        }
+    }
+
+    // Returns true if the value differs from the last one set for the uniform at the location,
+    // and remembers it. Uniforms whose values aren't cached always return true.
+    static bool UpdateUniformValue(OpenGLProgram* program, HUniformLocation location, const void* data, uint32_t size)
+    {
+        if (program == 0x0)
+        {
+            return true;
+        }
+
+        uint32_t num_uniforms = program->m_Uniforms.Size();
+        for (int i = 0; i < num_uniforms; ++i)
+        {
+            OpenGLUniform& uniform = program->m_Uniforms[i];
+            if (uniform.m_Location != location)
+            {
+                continue;
+            }
+
+            if (size > uniform.m_ValueSize)
+            {
+                return true;
+            }
+
+            uint8_t* value = program->m_UniformValues.Begin() + uniform.m_ValueOffset;
+            if (size <= uniform.m_ValueKnownSize && memcmp(value, data, size) == 0)
+            {
+                return false;
+            }
+            memcpy(value, data, size);
+            uniform.m_ValueKnownSize = dmMath::Max(uniform.m_ValueKnownSize, size);
+            return true;
+        }
+        return true;
     }
 
     static inline void IncreaseModificationVersion(OpenGLContext* context)
@@ -2421,12 +3260,27 @@ static void LogFrameBufferError(GLenum status)
         }
 #endif
 
-        if (!LinkProgram(p))
+        // The shaders stay attached even when the program is created from a binary, so that it can be relinked on reload
+        uint64_t source_hashes[] = { vertex_shader->m_SourceHash, fragment_shader->m_SourceHash };
+        uint64_t program_key     = dmHashBuffer64(source_hashes, sizeof(source_hashes));
+
+        if (!LoadProgramFromBinary((OpenGLContext*) context, p, program_key))
         {
-            delete program;
-            glDeleteProgram(p);
-            CHECK_GL_ERROR;
-            return 0;
+            if (((OpenGLContext*) context)->m_ProgramBinarySupport && PFN_glProgramParameteri)
+            {
+                PFN_glProgramParameteri(p, DMGRAPHICS_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+                CLEAR_GL_ERROR;
+            }
+
+            if (!LinkProgram(p))
+            {
+                delete program;
+                glDeleteProgram(p);
+                CHECK_GL_ERROR;
+                return 0;
+            }
+
+            StoreProgramBinary((OpenGLContext*) context, p, program_key);
         }
 
         program->m_Id       = p;
@@ -2441,10 +3295,11 @@ static void LogFrameBufferError(GLenum status)
 
     static void OpenGLDeleteProgram(HContext context, HProgram program)
     {
-        (void) context;
         OpenGLProgram* program_ptr = (OpenGLProgram*) program;
         glDeleteProgram(program_ptr->m_Id);
 
+        ForgetCachedProgram(&((OpenGLContext*) context)->m_StateCache, program_ptr->m_Id);
+
         for (int i = 0; i < program_ptr->m_Uniforms.Size(); ++i)
         {
             free(program_ptr->m_Uniforms[i].m_Name);
@@ -2509,11 +3364,12 @@ static void LogFrameBufferError(GLenum status)
 
         if (success)
         {
-            GLuint id = ((OpenGLShader*) prog)->m_Id;
-            glShaderSource(id, 1, (const GLchar**) &ddf_shader->m_Source.m_Data, (GLint*) &ddf_shader->m_Source.m_Count);
+            OpenGLShader* shader = (OpenGLShader*) prog;
+            glShaderSource(shader->m_Id, 1, (const GLchar**) &ddf_shader->m_Source.m_Data, (GLint*) &ddf_shader->m_Source.m_Count);
             CHECK_GL_ERROR;
-            glCompileShader(id);
+            glCompileShader(shader->m_Id);
             CHECK_GL_ERROR;
+            shader->m_SourceHash = dmHashBuffer64(ddf_shader->m_Source.m_Data, ddf_shader->m_Source.m_Count);
         }
 
         return success;
@@ -2537,11 +3393,12 @@ static void LogFrameBufferError(GLenum status)
 
         if (success)
         {
-            GLuint id = ((OpenGLShader*) prog)->m_Id;
-            glShaderSource(id, 1, (const GLchar**) &ddf_shader->m_Source.m_Data, (GLint*) &ddf_shader->m_Source.m_Count);
+            OpenGLShader* shader = (OpenGLShader*) prog;
+            glShaderSource(shader->m_Id, 1, (const GLchar**) &ddf_shader->m_Source.m_Data, (GLint*) &ddf_shader->m_Source.m_Count);
             CHECK_GL_ERROR;
-            glCompileShader(id);
+            glCompileShader(shader->m_Id);
             CHECK_GL_ERROR;
+            shader->m_SourceHash = dmHashBuffer64(ddf_shader->m_Source.m_Data, ddf_shader->m_Source.m_Count);
         }
 
         return success;
@@ -2596,21 +3453,28 @@ static void LogFrameBufferError(GLenum status)
         return language == ShaderDesc::LANGUAGE_GLSL_SM140 || language == ShaderDesc::LANGUAGE_GLSL_SM330;
     }
 
+    static void UseProgram(OpenGLContext* context, GLuint id)
+    {
+        if (UpdateCachedProgram(&context->m_StateCache, id))
+        {
+            glUseProgram(id);
+            CHECK_GL_ERROR;
+        }
+    }
+
     static void OpenGLEnableProgram(HContext _context, HProgram _program)
     {
         OpenGLContext* context = (OpenGLContext*) _context;
         OpenGLProgram* program = (OpenGLProgram*) _program;
         context->m_CurrentProgram = program;
-        glUseProgram(program->m_Id);
-        CHECK_GL_ERROR;
+        UseProgram(context, program->m_Id);
     }
 
     static void OpenGLDisableProgram(HContext _context)
     {
         OpenGLContext* context = (OpenGLContext*) _context;
         context->m_CurrentProgram = 0;
-        glUseProgram(0);
-        CHECK_GL_ERROR;
+        UseProgram(context, 0);
     }
 
     static bool TryLinkProgram(GLuint* ids, int num_ids)
@@ -2663,6 +3527,7 @@ static void LogFrameBufferError(GLenum status)
         CHECK_GL_ERROR;
 
         BuildAttributes(program_ptr);
+        ResetUniformValues(program_ptr);
         return true;
     }
 
@@ -2676,7 +3541,8 @@ static void LogFrameBufferError(GLenum status)
         OpenGLProgram* program_ptr = (OpenGLProgram*) program;
         glLinkProgram(program_ptr->m_Id);
         CHECK_GL_ERROR;
-        
+        ResetUniformValues(program_ptr);
+
         return true;
     }
 
@@ -2698,11 +3564,12 @@ static void LogFrameBufferError(GLenum status)
 
         if (success)
         {
-            GLuint id = ((OpenGLShader*) prog)->m_Id;
-            glShaderSource(id, 1, (const GLchar**) &ddf_shader->m_Source.m_Data, (GLint*) &ddf_shader->m_Source.m_Count);
+            OpenGLShader* shader = (OpenGLShader*) prog;
+            glShaderSource(shader->m_Id, 1, (const GLchar**) &ddf_shader->m_Source.m_Data, (GLint*) &ddf_shader->m_Source.m_Count);
             CHECK_GL_ERROR;
-            glCompileShader(id);
+            glCompileShader(shader->m_Id);
             CHECK_GL_ERROR;
+            shader->m_SourceHash = dmHashBuffer64(ddf_shader->m_Source.m_Data, ddf_shader->m_Source.m_Count);
         }
 
         return success;
@@ -2803,10 +3670,13 @@ static void LogFrameBufferError(GLenum status)
             OpenGLUniformBuffer& ubo = ((OpenGLContext*) context)->m_CurrentProgram->m_UniformBuffers[block_index];
 
             uint8_t* data_ptr = ubo.m_BlockMemory + ubo.m_Offsets[member_index];
-            memcpy(data_ptr, data, sizeof(Vector4) * count);
-            ubo.m_Dirty = true;
+            if (memcmp(data_ptr, data, sizeof(Vector4) * count) != 0)
+            {
+                memcpy(data_ptr, data, sizeof(Vector4) * count);
+                ubo.m_Dirty = true;
+            }
         }
-        else
+        else if (UpdateUniformValue(((OpenGLContext*) context)->m_CurrentProgram, base_location, data, sizeof(Vector4) * count))
         {
             glUniform4fv(base_location, count, (const GLfloat*) data);
             CHECK_GL_ERROR;
@@ -2824,10 +3694,13 @@ static void LogFrameBufferError(GLenum status)
             OpenGLUniformBuffer& ubo = ((OpenGLContext*) context)->m_CurrentProgram->m_UniformBuffers[block_index];
 
             uint8_t* data_ptr = ubo.m_BlockMemory + ubo.m_Offsets[member_index];
-            memcpy(data_ptr, data, sizeof(Vector4) * count * 4);
-            ubo.m_Dirty = true;
+            if (memcmp(data_ptr, data, sizeof(Vector4) * count * 4) != 0)
+            {
+                memcpy(data_ptr, data, sizeof(Vector4) * count * 4);
+                ubo.m_Dirty = true;
+            }
         }
-        else
+        else if (UpdateUniformValue(((OpenGLContext*) context)->m_CurrentProgram, base_location, data, sizeof(Vector4) * count * 4))
         {
             glUniformMatrix4fv(base_location, count, 0, (const GLfloat*) data);
             CHECK_GL_ERROR;
@@ -2837,8 +3710,12 @@ static void LogFrameBufferError(GLenum status)
     static void OpenGLSetSampler(HContext context, HUniformLocation location, int32_t unit)
     {
         assert(context);
-        glUniform1i(location, unit);
-        CHECK_GL_ERROR;
+        GLint value = unit;
+        if (UpdateUniformValue(((OpenGLContext*) context)->m_CurrentProgram, location, &value, sizeof(value)))
+        {
+            glUniform1i(location, unit);
+            CHECK_GL_ERROR;
+        }
     }
 
     static inline GLint GetDepthBufferFormat(OpenGLContext* context)
@@ -3013,6 +3890,7 @@ static void LogFrameBufferError(GLenum status)
                 CHECK_GL_ERROR;
 
                 glBindTexture(GL_TEXTURE_2D, 0);
+                InvalidateTextureBindings(context);
             #ifdef GL_DEPTH_STENCIL_ATTACHMENT
                 GLenum attachments[] = { GL_DEPTH_STENCIL_ATTACHMENT };
                 AttachRenderTargetAttachment(context, rt->m_DepthStencilAttachment, attachments, DM_ARRAY_SIZE(attachments));
@@ -3404,6 +4282,9 @@ static void LogFrameBufferError(GLenum status)
         glGenTextures(num_texture_ids, gl_texture_ids);
         CHECK_GL_ERROR;
 
+        // The names may belong to deleted textures that are still bound
+        InvalidateTextureBindings(context);
+
         OpenGLTexture* tex    = new OpenGLTexture();
         tex->m_Type           = texture_type;
         tex->m_TextureIds     = gl_texture_ids;
@@ -3427,6 +4308,7 @@ static void LogFrameBufferError(GLenum status)
         tex->m_MipMapCount = 0;
         tex->m_DataState = 0;
         tex->m_ResourceSize = 0;
+        tex->m_AppliedParamsValid = 0;
 
         return StoreAssetInContainer(context->m_AssetHandleContainer, tex, ASSET_TYPE_TEXTURE);
     }
@@ -3442,6 +4324,7 @@ static void LogFrameBufferError(GLenum status)
             glDeleteTextures(tex->m_NumTextureIds, tex->m_TextureIds);
             CHECK_GL_ERROR;
             free(tex->m_TextureIds);
+            InvalidateTextureBindings(context);
         }
 
         context->m_AssetHandleContainer.Release(texture);
@@ -3570,29 +4453,65 @@ static void LogFrameBufferError(GLenum status)
         GLenum gl_min_filter = GetOpenGLTextureFilter(minfilter == TEXTURE_FILTER_DEFAULT ? g_Context->m_DefaultTextureMinFilter : minfilter);
         GLenum gl_mag_filter = GetOpenGLTextureFilter(magfilter == TEXTURE_FILTER_DEFAULT ? g_Context->m_DefaultTextureMagFilter : magfilter);
 
+        GLenum gl_wrap_s     = GetOpenGLTextureWrap(uwrap);
+        GLenum gl_wrap_t     = GetOpenGLTextureWrap(vwrap);
+
         // Using a mipmapped min filter without any mipmaps will break the sampler
         if (tex->m_MipMapCount <= 1)
         {
             gl_min_filter = GetNonMipMapVersionOfFilter(gl_min_filter);
         }
 
-        glTexParameteri(gl_type, GL_TEXTURE_MIN_FILTER, gl_min_filter);
-        CHECK_GL_ERROR;
+        // The applied parameters are only tracked for textures backed by a single texture object.
+        // Image textures may be bound as images instead, in which case the parameters end up elsewhere.
+        bool trackable = tex->m_NumTextureIds == 1 && tex->m_Type != TEXTURE_TYPE_IMAGE_2D;
+        bool known     = trackable && tex->m_AppliedParamsValid;
 
-        glTexParameteri(gl_type, GL_TEXTURE_MAG_FILTER, gl_mag_filter);
-        CHECK_GL_ERROR;
+        if (!known || tex->m_AppliedMinFilter != gl_min_filter)
+        {
+            glTexParameteri(gl_type, GL_TEXTURE_MIN_FILTER, gl_min_filter);
+            CHECK_GL_ERROR;
+        }
 
-        glTexParameteri(gl_type, GL_TEXTURE_WRAP_S, GetOpenGLTextureWrap(uwrap));
-        CHECK_GL_ERROR
+        if (!known || tex->m_AppliedMagFilter != gl_mag_filter)
+        {
+            glTexParameteri(gl_type, GL_TEXTURE_MAG_FILTER, gl_mag_filter);
+            CHECK_GL_ERROR;
+        }
 
-        glTexParameteri(gl_type, GL_TEXTURE_WRAP_T, GetOpenGLTextureWrap(vwrap));
-        CHECK_GL_ERROR
+        if (!known || tex->m_AppliedWrapS != gl_wrap_s)
+        {
+            glTexParameteri(gl_type, GL_TEXTURE_WRAP_S, gl_wrap_s);
+            CHECK_GL_ERROR
+        }
 
-        if (g_Context->m_AnisotropySupport && max_anisotropy > 1.0f)
+        if (!known || tex->m_AppliedWrapT != gl_wrap_t)
         {
-            glTexParameterf(gl_type, GL_TEXTURE_MAX_ANISOTROPY_EXT, dmMath::Min(max_anisotropy, g_Context->m_MaxAnisotropy));
+            glTexParameteri(gl_type, GL_TEXTURE_WRAP_T, gl_wrap_t);
             CHECK_GL_ERROR
         }
+
+        if (!known)
+        {
+            tex->m_AppliedAnisotropy = 1.0f;
+        }
+
+        if (g_Context->m_AnisotropySupport && max_anisotropy > 1.0f)
+        {
+            float anisotropy = dmMath::Min(max_anisotropy, g_Context->m_MaxAnisotropy);
+            if (!known || tex->m_AppliedAnisotropy != anisotropy)
+            {
+                glTexParameterf(gl_type, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+                CHECK_GL_ERROR
+                tex->m_AppliedAnisotropy = anisotropy;
+            }
+        }
+
+        tex->m_AppliedMinFilter   = gl_min_filter;
+        tex->m_AppliedMagFilter   = gl_mag_filter;
+        tex->m_AppliedWrapS       = gl_wrap_s;
+        tex->m_AppliedWrapT       = gl_wrap_t;
+        tex->m_AppliedParamsValid = trackable;
     }
 
     static uint8_t OpenGLGetNumTextureHandles(HTexture texture)
@@ -4069,6 +4988,7 @@ static void LogFrameBufferError(GLenum status)
 
         glBindTexture(type, 0);
         CHECK_GL_ERROR;
+        InvalidateTextureBindings(g_Context);
 
         if (unpackAlignment != 4)
         {
@@ -4189,6 +5109,25 @@ static void LogFrameBufferError(GLenum status)
         return false;
     }
 
+    static void SetActiveTextureUnit(OpenGLContext* context, uint32_t unit)
+    {
+        if (UpdateCachedActiveTextureUnit(&context->m_StateCache, unit))
+        {
+            glActiveTexture(TEXTURE_UNIT_NAMES[unit]);
+            CHECK_GL_ERROR;
+        }
+    }
+
+    // Binds the texture to the active texture unit, which must be the unit passed in
+    static void BindTextureUnit(OpenGLContext* context, uint32_t unit, GLenum type, GLuint id)
+    {
+        if (UpdateCachedTextureUnit(&context->m_StateCache, dmAtomicGet32(&context->m_TextureBindingsVersion), unit, type, id))
+        {
+            glBindTexture(type, id);
+            CHECK_GL_ERROR;
+        }
+    }
+
     static void OpenGLEnableTexture(HContext _context, uint32_t unit, uint8_t id_index, HTexture texture)
     {
         OpenGLContext* context = (OpenGLContext*) _context;
@@ -4201,8 +5140,7 @@ static void LogFrameBufferError(GLenum status)
         CHECK_GL_ERROR;
 #endif
 
-        glActiveTexture(TEXTURE_UNIT_NAMES[unit]);
-        CHECK_GL_ERROR;
+        SetActiveTextureUnit(context, unit);
 
         bool bind_as_texture = true;
         if (tex->m_Type == TEXTURE_TYPE_IMAGE_2D)
@@ -4212,8 +5150,7 @@ static void LogFrameBufferError(GLenum status)
 
         if (bind_as_texture)
         {
-            glBindTexture(GetOpenGLTextureType(tex->m_Type), tex->m_TextureIds[id_index]);
-            CHECK_GL_ERROR;
+            BindTextureUnit(context, unit, GetOpenGLTextureType(tex->m_Type), tex->m_TextureIds[id_index]);
             OpenGLSetTextureParams(texture, tex->m_Params.m_MinFilter, tex->m_Params.m_MagFilter, tex->m_Params.m_UWrap, tex->m_Params.m_VWrap, 1.0f);
         }
     }
@@ -4228,8 +5165,7 @@ static void LogFrameBufferError(GLenum status)
         OpenGLContext* context = (OpenGLContext*) _context;
         OpenGLTexture* tex     = GetAssetFromContainer<OpenGLTexture>(context->m_AssetHandleContainer, texture);
 
-        glActiveTexture(TEXTURE_UNIT_NAMES[unit]);
-        CHECK_GL_ERROR;
+        SetActiveTextureUnit(context, unit);
 
         bool unbind_as_texture = true;
         if (tex->m_Type == TEXTURE_TYPE_IMAGE_2D)
@@ -4239,8 +5175,7 @@ static void LogFrameBufferError(GLenum status)
 
         if (unbind_as_texture)
         {
-            glBindTexture(GetOpenGLTextureType(tex->m_Type), 0);
-            CHECK_GL_ERROR;
+            BindTextureUnit(context, unit, GetOpenGLTextureType(tex->m_Type), 0);
         }
     }
 
@@ -4256,6 +5191,96 @@ static void LogFrameBufferError(GLenum status)
         CHECK_GL_ERROR;
     }
 
+    static bool OpenGLIsPixelReadbackSupported(HContext _context)
+    {
+        return ((OpenGLContext*) _context)->m_MapBufferRangeSupport;
+    }
+
+    static bool OpenGLReadPixelsAsync(HContext _context, uint32_t readback_id)
+    {
+        OpenGLContext* context = (OpenGLContext*) _context;
+        OpenGLPixelReadback& readback = context->m_PixelReadbacks[context->m_PixelReadback];
+        if (!context->m_MapBufferRangeSupport || readback.m_Pending)
+        {
+            return false;
+        }
+
+        uint32_t w    = dmGraphics::GetWidth(_context);
+        uint32_t h    = dmGraphics::GetHeight(_context);
+        uint32_t size = w * h * 4;
+
+        if (readback.m_Buffer == 0)
+        {
+            glGenBuffersARB(1, &readback.m_Buffer);
+            CHECK_GL_ERROR;
+        }
+
+        glBindBufferARB(DMGRAPHICS_PIXEL_PACK_BUFFER, readback.m_Buffer);
+        if (readback.m_Size != size)
+        {
+            glBufferDataARB(DMGRAPHICS_PIXEL_PACK_BUFFER, size, 0, DMGRAPHICS_STREAM_READ);
+            readback.m_Size = size;
+        }
+
+        // With a pack buffer bound, the pixels are written to the buffer at offset 0 and the call returns immediately
+        glReadPixels(0, 0, w, h, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+        glBindBufferARB(DMGRAPHICS_PIXEL_PACK_BUFFER, 0);
+        CHECK_GL_ERROR;
+
+        readback.m_Fence      = PFN_glFenceSync(DMGRAPHICS_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        readback.m_ReadbackId = readback_id;
+        readback.m_Pending    = 1;
+
+        context->m_PixelReadback = (context->m_PixelReadback + 1) % MAX_PIXEL_READBACKS;
+        return true;
+    }
+
+    static void OpenGLResolvePixelReadbacks(HContext _context, PixelReadbackCallback callback, void* user_data, bool wait)
+    {
+        OpenGLContext* context = (OpenGLContext*) _context;
+        if (!context->m_MapBufferRangeSupport)
+        {
+            return;
+        }
+
+        // Oldest first. The readbacks finish in order, so we can stop at the first one that isn't done.
+        for (uint32_t i = 0; i < MAX_PIXEL_READBACKS; ++i)
+        {
+            OpenGLPixelReadback& readback = context->m_PixelReadbacks[(context->m_PixelReadback + i) % MAX_PIXEL_READBACKS];
+            if (!readback.m_Pending)
+            {
+                continue;
+            }
+
+            if (wait)
+            {
+                WaitForFence(readback.m_Fence);
+            }
+            else
+            {
+                GLenum result = PFN_glClientWaitSync(readback.m_Fence, DMGRAPHICS_SYNC_FLUSH_COMMANDS_BIT, 0);
+                if (result != DMGRAPHICS_ALREADY_SIGNALED && result != DMGRAPHICS_CONDITION_SATISFIED)
+                {
+                    break;
+                }
+            }
+
+            PFN_glDeleteSync(readback.m_Fence);
+            readback.m_Fence   = 0;
+            readback.m_Pending = 0;
+
+            glBindBufferARB(DMGRAPHICS_PIXEL_PACK_BUFFER, readback.m_Buffer);
+            const void* pixels = PFN_glMapBufferRange(DMGRAPHICS_PIXEL_PACK_BUFFER, 0, readback.m_Size, DMGRAPHICS_MAP_READ_BIT);
+            if (pixels)
+            {
+                callback(user_data, readback.m_ReadbackId, pixels, readback.m_Size);
+                PFN_glUnmapBuffer(DMGRAPHICS_PIXEL_PACK_BUFFER);
+            }
+            glBindBufferARB(DMGRAPHICS_PIXEL_PACK_BUFFER, 0);
+            CHECK_GL_ERROR;
+        }
+    }
+
     static void OpenGLEnableState(HContext context, State state)
     {
         assert(context);
@@ -4266,8 +5291,11 @@ static void LogFrameBufferError(GLenum status)
             return;
         }
     #endif
-        glEnable(GetOpenGLState(state));
-        CHECK_GL_ERROR
+        if (UpdateCachedState(&((OpenGLContext*) context)->m_StateCache, state, true))
+        {
+            glEnable(GetOpenGLState(state));
+            CHECK_GL_ERROR
+        }
 
         SetPipelineStateValue(((OpenGLContext*) context)->m_PipelineState, state, 1);
     }
@@ -4282,8 +5310,11 @@ static void LogFrameBufferError(GLenum status)
             return;
         }
     #endif
-        glDisable(GetOpenGLState(state));
-        CHECK_GL_ERROR
+        if (UpdateCachedState(&((OpenGLContext*) context)->m_StateCache, state, false))
+        {
+            glDisable(GetOpenGLState(state));
+            CHECK_GL_ERROR
+        }
 
         SetPipelineStateValue(((OpenGLContext*) context)->m_PipelineState, state, 0);
     }
@@ -4316,10 +5347,18 @@ static void LogFrameBufferError(GLenum status)
         #endif
         };
 
-        glBlendFunc(blend_factor_lut[source_factor], blend_factor_lut[destinaton_factor]);
-        CHECK_GL_ERROR
-
-        OpenGLContext* context = (OpenGLContext*) _context;
+        OpenGLContext* context  = (OpenGLContext*) _context;
+        OpenGLStateCache& cache = context->m_StateCache;
+        GLenum gl_src           = blend_factor_lut[source_factor];
+        GLenum gl_dst           = blend_factor_lut[destinaton_factor];
+        if (!(cache.m_Known & STATE_CACHE_BLEND_FUNC) || cache.m_BlendSrc != gl_src || cache.m_BlendDst != gl_dst)
+        {
+            glBlendFunc(gl_src, gl_dst);
+            CHECK_GL_ERROR
+            cache.m_BlendSrc = gl_src;
+            cache.m_BlendDst = gl_dst;
+            cache.m_Known   |= STATE_CACHE_BLEND_FUNC;
+        }
 
         context->m_PipelineState.m_BlendSrcFactor = source_factor;
         context->m_PipelineState.m_BlendDstFactor = destinaton_factor;
@@ -4328,23 +5367,35 @@ static void LogFrameBufferError(GLenum status)
     static void OpenGLSetColorMask(HContext _context, bool red, bool green, bool blue, bool alpha)
     {
         assert(_context);
-        glColorMask(red, green, blue, alpha);
-        CHECK_GL_ERROR;
-
         OpenGLContext* context = (OpenGLContext*) _context;
 
         uint8_t write_mask = red   ? DM_GRAPHICS_STATE_WRITE_R : 0;
         write_mask        |= green ? DM_GRAPHICS_STATE_WRITE_G : 0;
         write_mask        |= blue  ? DM_GRAPHICS_STATE_WRITE_B : 0;
         write_mask        |= alpha ? DM_GRAPHICS_STATE_WRITE_A : 0;
+
+        OpenGLStateCache& cache = context->m_StateCache;
+        if (!(cache.m_Known & STATE_CACHE_COLOR_MASK) || cache.m_ColorMask != write_mask)
+        {
+            glColorMask(red, green, blue, alpha);
+            CHECK_GL_ERROR;
+            cache.m_ColorMask = write_mask;
+            cache.m_Known    |= STATE_CACHE_COLOR_MASK;
+        }
         context->m_PipelineState.m_WriteColorMask = write_mask;
     }
 
     static void OpenGLSetDepthMask(HContext context, bool mask)
     {
         assert(context);
-        glDepthMask(mask);
-        CHECK_GL_ERROR;
+        OpenGLStateCache& cache = ((OpenGLContext*) context)->m_StateCache;
+        if (!(cache.m_Known & STATE_CACHE_DEPTH_MASK) || cache.m_DepthMask != mask)
+        {
+            glDepthMask(mask);
+            CHECK_GL_ERROR;
+            cache.m_DepthMask = mask;
+            cache.m_Known    |= STATE_CACHE_DEPTH_MASK;
+        }
 
         ((OpenGLContext*) context)->m_PipelineState.m_WriteDepth = mask;
     }
@@ -4379,8 +5430,15 @@ static void LogFrameBufferError(GLenum status)
     static void OpenGLSetDepthFunc(HContext context, CompareFunc func)
     {
         assert(context);
-        glDepthFunc(GetOpenGLCompareFunc(func));
-        CHECK_GL_ERROR
+        OpenGLStateCache& cache = ((OpenGLContext*) context)->m_StateCache;
+        GLenum gl_func          = GetOpenGLCompareFunc(func);
+        if (!(cache.m_Known & STATE_CACHE_DEPTH_FUNC) || cache.m_DepthFunc != gl_func)
+        {
+            glDepthFunc(gl_func);
+            CHECK_GL_ERROR
+            cache.m_DepthFunc = gl_func;
+            cache.m_Known    |= STATE_CACHE_DEPTH_FUNC;
+        }
         ((OpenGLContext*) context)->m_PipelineState.m_DepthTestFunc = func;
     }
 
@@ -4394,18 +5452,57 @@ static void LogFrameBufferError(GLenum status)
     static void OpenGLSetStencilMask(HContext context, uint32_t mask)
     {
         assert(context);
-        glStencilMask(mask);
-        CHECK_GL_ERROR;
+        OpenGLStateCache& cache = ((OpenGLContext*) context)->m_StateCache;
+        if (!(cache.m_Known & STATE_CACHE_STENCIL_WRITE_MASK) || cache.m_StencilWriteMask != mask)
+        {
+            glStencilMask(mask);
+            CHECK_GL_ERROR;
+            cache.m_StencilWriteMask = mask;
+            cache.m_Known           |= STATE_CACHE_STENCIL_WRITE_MASK;
+        }
         ((OpenGLContext*) context)->m_PipelineState.m_StencilWriteMask = mask;
     }
 
+    // Face index 0 is the front face, 1 is the back face
+    static inline bool IsStencilFuncCached(const OpenGLStateCache& cache, uint32_t face, GLenum func, uint32_t ref, uint32_t mask)
+    {
+        uint32_t known_bit = face == 0 ? STATE_CACHE_STENCIL_FUNC_FRONT : STATE_CACHE_STENCIL_FUNC_BACK;
+        return (cache.m_Known & known_bit) && cache.m_StencilFunc[face] == func && cache.m_StencilRef[face] == (GLint) ref && cache.m_StencilCompareMask[face] == mask;
+    }
+
+    static inline void CacheStencilFunc(OpenGLStateCache& cache, uint32_t face, GLenum func, uint32_t ref, uint32_t mask)
+    {
+        cache.m_StencilFunc[face]        = func;
+        cache.m_StencilRef[face]         = (GLint) ref;
+        cache.m_StencilCompareMask[face] = mask;
+        cache.m_Known                   |= face == 0 ? STATE_CACHE_STENCIL_FUNC_FRONT : STATE_CACHE_STENCIL_FUNC_BACK;
+    }
+
+    static inline bool IsStencilOpCached(const OpenGLStateCache& cache, uint32_t face, const GLenum ops[3])
+    {
+        uint32_t known_bit = face == 0 ? STATE_CACHE_STENCIL_OP_FRONT : STATE_CACHE_STENCIL_OP_BACK;
+        return (cache.m_Known & known_bit) && memcmp(cache.m_StencilOp[face], ops, sizeof(cache.m_StencilOp[face])) == 0;
+    }
+
+    static inline void CacheStencilOp(OpenGLStateCache& cache, uint32_t face, const GLenum ops[3])
+    {
+        memcpy(cache.m_StencilOp[face], ops, sizeof(cache.m_StencilOp[face]));
+        cache.m_Known |= face == 0 ? STATE_CACHE_STENCIL_OP_FRONT : STATE_CACHE_STENCIL_OP_BACK;
+    }
+
     static void OpenGLSetStencilFunc(HContext _context, CompareFunc func, uint32_t ref, uint32_t mask)
     {
         assert(_context);
-        glStencilFunc(GetOpenGLCompareFunc(func), ref, mask);
-        CHECK_GL_ERROR
-
         OpenGLContext* context = (OpenGLContext*) _context;
+
+        GLenum gl_func = GetOpenGLCompareFunc(func);
+        if (!IsStencilFuncCached(context->m_StateCache, 0, gl_func, ref, mask) || !IsStencilFuncCached(context->m_StateCache, 1, gl_func, ref, mask))
+        {
+            glStencilFunc(gl_func, ref, mask);
+            CHECK_GL_ERROR
+            CacheStencilFunc(context->m_StateCache, 0, gl_func, ref, mask);
+            CacheStencilFunc(context->m_StateCache, 1, gl_func, ref, mask);
+        }
         context->m_PipelineState.m_StencilFrontTestFunc = (uint8_t) func;
         context->m_PipelineState.m_StencilBackTestFunc  = (uint8_t) func;
         context->m_PipelineState.m_StencilReference     = (uint8_t) ref;
@@ -4415,10 +5512,21 @@ static void LogFrameBufferError(GLenum status)
     static void OpenGLSetStencilFuncSeparate(HContext _context, FaceType face_type, CompareFunc func, uint32_t ref, uint32_t mask)
     {
         assert(_context);
-        glStencilFuncSeparate(GetOpenGLFaceTypeFunc(face_type), GetOpenGLCompareFunc(func), ref, mask);
-        CHECK_GL_ERROR
-
         OpenGLContext* context = (OpenGLContext*) _context;
+
+        GLenum gl_func = GetOpenGLCompareFunc(func);
+        bool front     = face_type != FACE_TYPE_BACK;
+        bool back      = face_type != FACE_TYPE_FRONT;
+        if ((front && !IsStencilFuncCached(context->m_StateCache, 0, gl_func, ref, mask)) ||
+            (back && !IsStencilFuncCached(context->m_StateCache, 1, gl_func, ref, mask)))
+        {
+            glStencilFuncSeparate(GetOpenGLFaceTypeFunc(face_type), gl_func, ref, mask);
+            CHECK_GL_ERROR
+            if (front)
+                CacheStencilFunc(context->m_StateCache, 0, gl_func, ref, mask);
+            if (back)
+                CacheStencilFunc(context->m_StateCache, 1, gl_func, ref, mask);
+        }
         if (face_type == FACE_TYPE_BACK)
         {
             context->m_PipelineState.m_StencilBackTestFunc = (uint8_t) func;
@@ -4445,10 +5553,16 @@ static void LogFrameBufferError(GLenum status)
             GL_INVERT,
         };
 
-        glStencilOp(stencil_op_lut[sfail], stencil_op_lut[dpfail], stencil_op_lut[dppass]);
-        CHECK_GL_ERROR;
-
         OpenGLContext* context = (OpenGLContext*) _context;
+
+        GLenum gl_ops[] = { stencil_op_lut[sfail], stencil_op_lut[dpfail], stencil_op_lut[dppass] };
+        if (!IsStencilOpCached(context->m_StateCache, 0, gl_ops) || !IsStencilOpCached(context->m_StateCache, 1, gl_ops))
+        {
+            glStencilOp(gl_ops[0], gl_ops[1], gl_ops[2]);
+            CHECK_GL_ERROR;
+            CacheStencilOp(context->m_StateCache, 0, gl_ops);
+            CacheStencilOp(context->m_StateCache, 1, gl_ops);
+        }
         context->m_PipelineState.m_StencilFrontOpFail      = sfail;
         context->m_PipelineState.m_StencilFrontOpDepthFail = dpfail;
         context->m_PipelineState.m_StencilFrontOpPass      = dppass;
@@ -4471,10 +5585,21 @@ static void LogFrameBufferError(GLenum status)
             GL_INVERT,
         };
 
-        glStencilOpSeparate(GetOpenGLFaceTypeFunc(face_type), stencil_op_lut[sfail], stencil_op_lut[dpfail], stencil_op_lut[dppass]);
-        CHECK_GL_ERROR;
-
         OpenGLContext* context = (OpenGLContext*) _context;
+
+        GLenum gl_ops[] = { stencil_op_lut[sfail], stencil_op_lut[dpfail], stencil_op_lut[dppass] };
+        bool front      = face_type != FACE_TYPE_BACK;
+        bool back       = face_type != FACE_TYPE_FRONT;
+        if ((front && !IsStencilOpCached(context->m_StateCache, 0, gl_ops)) ||
+            (back && !IsStencilOpCached(context->m_StateCache, 1, gl_ops)))
+        {
+            glStencilOpSeparate(GetOpenGLFaceTypeFunc(face_type), gl_ops[0], gl_ops[1], gl_ops[2]);
+            CHECK_GL_ERROR;
+            if (front)
+                CacheStencilOp(context->m_StateCache, 0, gl_ops);
+            if (back)
+                CacheStencilOp(context->m_StateCache, 1, gl_ops);
+        }
         if (face_type == FACE_TYPE_BACK)
         {
             context->m_PipelineState.m_StencilBackOpFail       = sfail;
@@ -4492,8 +5617,15 @@ static void LogFrameBufferError(GLenum status)
     static void OpenGLSetCullFace(HContext context, FaceType face_type)
     {
         assert(context);
-        glCullFace(GetOpenGLFaceTypeFunc(face_type));
-        CHECK_GL_ERROR
+        OpenGLStateCache& cache = ((OpenGLContext*) context)->m_StateCache;
+        GLenum gl_face          = GetOpenGLFaceTypeFunc(face_type);
+        if (!(cache.m_Known & STATE_CACHE_CULL_FACE) || cache.m_CullFace != gl_face)
+        {
+            glCullFace(gl_face);
+            CHECK_GL_ERROR
+            cache.m_CullFace = gl_face;
+            cache.m_Known   |= STATE_CACHE_CULL_FACE;
+        }
 
         ((OpenGLContext*) context)->m_PipelineState.m_CullFaceType = face_type;
     }
@@ -4507,7 +5639,14 @@ static void LogFrameBufferError(GLenum status)
             GL_CW,
         };
 
-        glFrontFace(face_winding_lut[face_winding]);
+        OpenGLStateCache& cache = ((OpenGLContext*) context)->m_StateCache;
+        GLenum gl_winding       = face_winding_lut[face_winding];
+        if (!(cache.m_Known & STATE_CACHE_FRONT_FACE) || cache.m_FrontFace != gl_winding)
+        {
+            glFrontFace(gl_winding);
+            cache.m_FrontFace = gl_winding;
+            cache.m_Known    |= STATE_CACHE_FRONT_FACE;
+        }
 
         ((OpenGLContext*) context)->m_PipelineState.m_FaceWinding = face_winding;
     }
@@ -4515,8 +5654,15 @@ static void LogFrameBufferError(GLenum status)
     static void OpenGLSetPolygonOffset(HContext context, float factor, float units)
     {
         assert(context);
-        glPolygonOffset(factor, units);
-        CHECK_GL_ERROR;
+        OpenGLStateCache& cache = ((OpenGLContext*) context)->m_StateCache;
+        if (!(cache.m_Known & STATE_CACHE_POLYGON_OFFSET) || cache.m_PolygonOffset[0] != factor || cache.m_PolygonOffset[1] != units)
+        {
+            glPolygonOffset(factor, units);
+            CHECK_GL_ERROR;
+            cache.m_PolygonOffset[0] = factor;
+            cache.m_PolygonOffset[1] = units;
+            cache.m_Known           |= STATE_CACHE_POLYGON_OFFSET;
+        }
     }
 
     static bool OpenGLIsAssetHandleValid(HContext _context, HAssetHandle asset_handle)
@@ -4580,6 +5726,22 @@ static void LogFrameBufferError(GLenum status)
     {
         GraphicsAdapterFunctionTable fn_table = {};
         DM_REGISTER_GRAPHICS_FUNCTION_TABLE(fn_table, OpenGL);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, NewDynamicVertexBuffer);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, DeleteDynamicVertexBuffer);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, BeginDynamicVertexBuffer);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, ReserveDynamicVertexData);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, CommitDynamicVertexData);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, GetDynamicVertexBufferHandle);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, IsGpuTimerSupported);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, BeginGpuTimer);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, EndGpuTimer);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, ResolveGpuTimers);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, IsPixelReadbackSupported);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, ReadPixelsAsync);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, ResolvePixelReadbacks);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, IsMultiDrawIndirectSupported);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, DrawElementsIndirect);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, OpenGL, DispatchComputeIndirect);
         return fn_table;
     }
 }
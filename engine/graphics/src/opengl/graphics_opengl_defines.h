@@ -105,6 +105,12 @@
     #define DMGRAPHICS_BARRIER_BIT_SHADER_IMAGE_ACCESS       (0x00000020)
 #endif
 
+#ifdef GL_COMMAND_BARRIER_BIT
+    #define DMGRAPHICS_BARRIER_BIT_COMMAND                   (GL_COMMAND_BARRIER_BIT)
+#else
+    #define DMGRAPHICS_BARRIER_BIT_COMMAND                   (0x00000040)
+#endif
+
 // GL_READ_WRITE
 #ifdef GL_READ_WRITE
     #define DMGRAPHICS_READ_WRITE               (GL_READ_WRITE)
@@ -499,4 +505,40 @@
 #define GL_UNIFORM_BLOCK_INDEX                           0x8A3A
 #endif
 
+// Buffer mapping and sync objects
+#define DMGRAPHICS_MAP_READ_BIT                             (0x0001)
+#define DMGRAPHICS_MAP_WRITE_BIT                            (0x0002)
+#define DMGRAPHICS_MAP_INVALIDATE_RANGE_BIT                 (0x0004)
+#define DMGRAPHICS_MAP_FLUSH_EXPLICIT_BIT                   (0x0010)
+#define DMGRAPHICS_MAP_UNSYNCHRONIZED_BIT                   (0x0020)
+#define DMGRAPHICS_MAP_PERSISTENT_BIT                       (0x0040)
+#define DMGRAPHICS_MAP_COHERENT_BIT                         (0x0080)
+#define DMGRAPHICS_SYNC_GPU_COMMANDS_COMPLETE               (0x9117)
+#define DMGRAPHICS_SYNC_FLUSH_COMMANDS_BIT                  (0x00000001)
+#define DMGRAPHICS_TIMEOUT_EXPIRED                          (0x911B)
+#define DMGRAPHICS_WAIT_FAILED                              (0x911D)
+#define DMGRAPHICS_ALREADY_SIGNALED                         (0x911A)
+#define DMGRAPHICS_CONDITION_SATISFIED                      (0x911C)
+
+// Pixel readback
+#define DMGRAPHICS_PIXEL_PACK_BUFFER                        (0x88EB)
+#define DMGRAPHICS_STREAM_READ                              (0x88E1)
+
+// Timer queries
+#define DMGRAPHICS_TIME_ELAPSED                             (0x88BF)
+#define DMGRAPHICS_QUERY_RESULT                             (0x8866)
+#define DMGRAPHICS_QUERY_RESULT_AVAILABLE                   (0x8867)
+#define DMGRAPHICS_GPU_DISJOINT                             (0x8FBB)
+
+// Program binaries
+#define DMGRAPHICS_PROGRAM_BINARY_RETRIEVABLE_HINT          (0x8257)
+#define DMGRAPHICS_PROGRAM_BINARY_LENGTH                    (0x8741)
+#define DMGRAPHICS_NUM_PROGRAM_BINARY_FORMATS               (0x87FE)
+
+// Multi-draw indirect
+#define DMGRAPHICS_DRAW_INDIRECT_BUFFER                     (0x8F3F)
+
+// Indirect compute dispatch
+#define DMGRAPHICS_DISPATCH_INDIRECT_BUFFER                 (0x90EE)
+
 #endif // DMGRAPHICS_OPENGL_DEFINES_H
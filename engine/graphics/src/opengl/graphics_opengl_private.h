@@ -15,8 +15,11 @@
 #ifndef __GRAPHICS_DEVICE_OPENGL__
 #define __GRAPHICS_DEVICE_OPENGL__
 
+#include <assert.h>
+#include <string.h>
 #include <dlib/atomic.h>
 #include <dlib/math.h>
+#include <dlib/hashtable.h>
 #include <dmsdk/dlib/atomic.h>
 #include <dmsdk/vectormath/cpp/vectormath_aos.h>
 #include <dlib/opaque_handle_container.h>
@@ -52,6 +55,13 @@ namespace dmGraphics
         uint16_t          m_OriginalHeight;
         uint16_t          m_MipMapCount;
         uint8_t           m_UsageHintFlags;
+        // The sampler parameters last applied to the texture object (see SetTextureParams)
+        GLenum            m_AppliedMinFilter;
+        GLenum            m_AppliedMagFilter;
+        GLenum            m_AppliedWrapS;
+        GLenum            m_AppliedWrapT;
+        float             m_AppliedAnisotropy;
+        uint8_t           m_AppliedParamsValid : 1;
     };
 
     struct OpenGLRenderTargetAttachment
@@ -80,9 +90,18 @@ namespace dmGraphics
     {
         GLuint               m_Id;
         ShaderMeta           m_ShaderMeta;
+        uint64_t             m_SourceHash;
         ShaderDesc::Language m_Language;
     };
 
+    // A linked program as returned by glGetProgramBinary, so it can be recreated without compiling and linking the shaders
+    struct OpenGLProgramBinary
+    {
+        uint8_t* m_Data;
+        uint32_t m_Size;
+        GLenum   m_Format;
+    };
+
     struct OpenGLBuffer
     {
         GLuint           m_Id;
@@ -90,6 +109,40 @@ namespace dmGraphics
         uint32_t         m_MemorySize;
     };
 
+    // A vertex buffer split into one region per frame in flight (see NewDynamicVertexBuffer)
+    struct OpenGLDynamicVertexBuffer
+    {
+        OpenGLBuffer m_Buffer;
+        void*        m_Fences[DYNAMIC_VERTEX_BUFFER_REGION_COUNT]; // Signaled when the GPU is done with the region
+        uint8_t*     m_Mapped;       // The whole buffer if persistently mapped, otherwise the mapped part of the current region
+        uint32_t     m_RegionSize;
+        uint32_t     m_Region;
+        uint32_t     m_Offset;       // Write offset into the current region
+        uint32_t     m_MappedOffset; // Where m_Mapped starts in the current region, if not persistently mapped
+        uint32_t     m_Reserved;
+        uint8_t      m_Persistent : 1;
+    };
+
+    // The timer queries of one frame (see BeginGpuTimer). Pending until the results have been read.
+    static const uint32_t GPU_TIMER_FRAME_COUNT = 4;
+    struct OpenGLGpuTimerFrame
+    {
+        GLuint   m_Queries[MAX_GPU_TIMERS_PER_FRAME];
+        uint32_t m_TimerIds[MAX_GPU_TIMERS_PER_FRAME];
+        uint32_t m_Count;
+        uint8_t  m_Pending : 1;
+    };
+
+    // A pixel pack buffer that the back buffer is read into (see ReadPixelsAsync). Pending until it has been resolved.
+    struct OpenGLPixelReadback
+    {
+        GLuint   m_Buffer;
+        void*    m_Fence;       // Signaled when the pixels have been copied to the buffer
+        uint32_t m_Size;
+        uint32_t m_ReadbackId;
+        uint8_t  m_Pending : 1;
+    };
+
     struct OpenGLVertexAttribute
     {
         dmhash_t m_NameHash;
@@ -117,6 +170,9 @@ namespace dmGraphics
         HUniformLocation m_Location;
         GLint            m_Count;
         GLenum           m_Type;
+        uint32_t         m_ValueOffset;    // Offset into OpenGLProgram::m_UniformValues
+        uint32_t         m_ValueSize;      // Zero if the values aren't cached
+        uint32_t         m_ValueKnownSize; // Number of bytes (from the start) that holds the current value
         uint8_t          m_TextureUnit   : 7;
         uint8_t          m_IsTextureType : 1;
     };
@@ -128,8 +184,138 @@ namespace dmGraphics
         dmArray<OpenGLVertexAttribute> m_Attributes;
         dmArray<OpenGLUniformBuffer>   m_UniformBuffers;
         dmArray<OpenGLUniform>         m_Uniforms;
+        dmArray<uint8_t>               m_UniformValues; // Last values set for the uniforms outside of uniform blocks
+    };
+
+    // Shadow copy of the GL state set through the adapter, used to skip redundant GL calls.
+    // A value is only trusted when its STATE_CACHE_* bit is set in m_Known (see InvalidateStateCache).
+    static const uint32_t STATE_CACHE_TEXTURE_UNIT_COUNT = 32;
+    struct OpenGLStateCache
+    {
+        GLenum   m_TextureTypes[STATE_CACHE_TEXTURE_UNIT_COUNT];
+        GLuint   m_TextureIds[STATE_CACHE_TEXTURE_UNIT_COUNT];
+        uint32_t m_TextureUnitsKnown;     // Bit per texture unit
+        int32_t  m_TextureBindingsVersion; // The OpenGLContext::m_TextureBindingsVersion the texture units are valid for
+        uint32_t m_ActiveTextureUnit;
+        GLuint   m_Program;
+        uint32_t m_EnabledStates;         // Bit per dmGraphics::State
+        uint32_t m_KnownStates;           // Bit per dmGraphics::State
+        uint32_t m_EnabledVertexAttribs;  // Bit per attribute location
+        uint32_t m_UsedVertexAttribs;     // Attributes enabled for the next draw call
+        GLenum   m_BlendSrc;
+        GLenum   m_BlendDst;
+        GLenum   m_DepthFunc;
+        GLenum   m_CullFace;
+        GLenum   m_FrontFace;
+        GLuint   m_StencilWriteMask;
+        GLenum   m_StencilFunc[2];        // Front, back
+        GLint    m_StencilRef[2];
+        GLuint   m_StencilCompareMask[2];
+        GLenum   m_StencilOp[2][3];       // Front, back: fail, depth fail, pass
+        float    m_PolygonOffset[2];
+        uint32_t m_Known;
+        uint8_t  m_ColorMask;
+        uint8_t  m_DepthMask               : 1;
+        uint8_t  m_VertexAttribsApplied    : 1; // A draw call has used m_UsedVertexAttribs
+    };
+
+    enum StateCacheBit
+    {
+        STATE_CACHE_ACTIVE_TEXTURE_UNIT = 1 << 0,
+        STATE_CACHE_PROGRAM             = 1 << 1,
+        STATE_CACHE_BLEND_FUNC          = 1 << 2,
+        STATE_CACHE_COLOR_MASK          = 1 << 3,
+        STATE_CACHE_DEPTH_MASK          = 1 << 4,
+        STATE_CACHE_DEPTH_FUNC          = 1 << 5,
+        STATE_CACHE_CULL_FACE           = 1 << 6,
+        STATE_CACHE_FRONT_FACE          = 1 << 7,
+        STATE_CACHE_STENCIL_WRITE_MASK  = 1 << 8,
+        STATE_CACHE_STENCIL_FUNC_FRONT  = 1 << 9,
+        STATE_CACHE_STENCIL_FUNC_BACK   = 1 << 10,
+        STATE_CACHE_STENCIL_OP_FRONT    = 1 << 11,
+        STATE_CACHE_STENCIL_OP_BACK     = 1 << 12,
+        STATE_CACHE_POLYGON_OFFSET      = 1 << 13,
+        STATE_CACHE_VERTEX_ATTRIBS      = 1 << 14,
     };
 
+    // Forgets all cached values. The enabled vertex attributes are kept as a superset, so that stale ones still get disabled.
+    static inline void ResetStateCache(OpenGLStateCache* cache, int32_t texture_bindings_version)
+    {
+        uint32_t enabled_attribs = cache->m_EnabledVertexAttribs;
+        memset(cache, 0, sizeof(*cache));
+        cache->m_EnabledVertexAttribs   = enabled_attribs;
+        cache->m_TextureBindingsVersion = texture_bindings_version;
+    }
+
+    // The UpdateCached* functions record the new value, and return true if the GL call has to be made
+
+    static inline bool UpdateCachedState(OpenGLStateCache* cache, uint32_t state, bool enabled)
+    {
+        uint32_t state_bit = 1 << state;
+        if ((cache->m_KnownStates & state_bit) && ((cache->m_EnabledStates & state_bit) != 0) == enabled)
+        {
+            return false;
+        }
+        cache->m_KnownStates |= state_bit;
+        if (enabled)
+            cache->m_EnabledStates |= state_bit;
+        else
+            cache->m_EnabledStates &= ~state_bit;
+        return true;
+    }
+
+    static inline bool UpdateCachedProgram(OpenGLStateCache* cache, GLuint id)
+    {
+        if ((cache->m_Known & STATE_CACHE_PROGRAM) && cache->m_Program == id)
+        {
+            return false;
+        }
+        cache->m_Program = id;
+        cache->m_Known  |= STATE_CACHE_PROGRAM;
+        return true;
+    }
+
+    // The name may be reused by a new program, while the deleted one is still in use
+    static inline void ForgetCachedProgram(OpenGLStateCache* cache, GLuint id)
+    {
+        if (cache->m_Program == id)
+        {
+            cache->m_Known &= ~STATE_CACHE_PROGRAM;
+        }
+    }
+
+    static inline bool UpdateCachedActiveTextureUnit(OpenGLStateCache* cache, uint32_t unit)
+    {
+        if ((cache->m_Known & STATE_CACHE_ACTIVE_TEXTURE_UNIT) && cache->m_ActiveTextureUnit == unit)
+        {
+            return false;
+        }
+        cache->m_ActiveTextureUnit = unit;
+        cache->m_Known            |= STATE_CACHE_ACTIVE_TEXTURE_UNIT;
+        return true;
+    }
+
+    // The texture units are only trusted for the texture bindings version they were bound with
+    static inline bool UpdateCachedTextureUnit(OpenGLStateCache* cache, int32_t texture_bindings_version, uint32_t unit, GLenum type, GLuint id)
+    {
+        assert(unit < STATE_CACHE_TEXTURE_UNIT_COUNT);
+        if (cache->m_TextureBindingsVersion != texture_bindings_version)
+        {
+            cache->m_TextureUnitsKnown      = 0;
+            cache->m_TextureBindingsVersion = texture_bindings_version;
+        }
+
+        uint32_t unit_bit = 1 << unit;
+        if ((cache->m_TextureUnitsKnown & unit_bit) && cache->m_TextureTypes[unit] == type && cache->m_TextureIds[unit] == id)
+        {
+            return false;
+        }
+        cache->m_TextureTypes[unit]  = type;
+        cache->m_TextureIds[unit]    = id;
+        cache->m_TextureUnitsKnown  |= unit_bit;
+        return true;
+    }
+
     struct OpenGLContext
     {
         OpenGLContext(const ContextParams& params);
@@ -144,9 +330,23 @@ namespace dmGraphics
         int32_atomic_t          m_DeleteContextRequested;
 
         OpenGLProgram*          m_CurrentProgram;
+        OpenGLStateCache        m_StateCache;
+        // Bumped whenever textures are bound outside of EnableTexture/DisableTexture (uploads, deletes etc).
+        // Atomic since textures may be uploaded and deleted from the worker thread.
+        int32_atomic_t          m_TextureBindingsVersion;
 
         dmOpaqueHandleContainer<uintptr_t> m_AssetHandleContainer;
 
+        dmHashTable64<OpenGLProgramBinary> m_ProgramBinaries; // Keyed by the shader source hashes, persisted to m_PipelineCachePath
+        char*                   m_PipelineCachePath;
+        uint64_t                m_DriverHash; // Program binaries are only valid for the driver that created them
+
+        OpenGLGpuTimerFrame     m_GpuTimerFrames[GPU_TIMER_FRAME_COUNT];
+        uint32_t                m_GpuTimerFrame;
+
+        OpenGLPixelReadback     m_PixelReadbacks[MAX_PIXEL_READBACKS];
+        uint32_t                m_PixelReadback; // The next readback to use
+
         PipelineState           m_PipelineState;
         uint32_t                m_Width;
         uint32_t                m_Height;
@@ -177,6 +377,14 @@ namespace dmGraphics
         uint32_t                m_StorageBufferSupport             : 1;
         uint32_t                m_RenderDocSupport                 : 1;
         uint32_t                m_InstancingSupport                : 1;
+        uint32_t                m_MapBufferRangeSupport            : 1;
+        uint32_t                m_BufferStorageSupport             : 1;
+        uint32_t                m_TimerQuerySupport                : 1;
+        uint32_t                m_TimerQueryDisjoint               : 1; // EXT_disjoint_timer_query, results are invalid if GL_GPU_DISJOINT is set
+        uint32_t                m_GpuTimerActive                   : 1;
+        uint32_t                m_ProgramBinarySupport             : 1;
+        uint32_t                m_ProgramBinariesDirty             : 1;
+        uint32_t                m_MultiDrawIndirectSupport         : 1;
     };
 }
 #endif // __GRAPHICS_DEVICE_OPENGL__
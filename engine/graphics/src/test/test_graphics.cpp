@@ -250,6 +250,81 @@ TEST_F(dmGraphicsTest, VertexBuffer)
     dmGraphics::DeleteVertexBuffer(vertex_buffer);
 }
 
+// The null adapter doesn't map buffer memory, so the callers keep uploading the data
+TEST_F(dmGraphicsTest, DynamicVertexBufferUnsupported)
+{
+    ASSERT_EQ((dmGraphics::HDynamicVertexBuffer) 0, dmGraphics::NewDynamicVertexBuffer(m_Context, 1024));
+    dmGraphics::DeleteDynamicVertexBuffer(m_Context, 0);
+}
+
+static void GpuTimerResultUnexpected(void* user_data, uint32_t timer_id, uint64_t elapsed_ns)
+{
+    *(uint32_t*) user_data += 1;
+}
+
+// The null adapter has no GPU timers, so they must be safe to call anyway
+TEST_F(dmGraphicsTest, GpuTimerUnsupported)
+{
+    ASSERT_FALSE(dmGraphics::IsGpuTimerSupported(m_Context));
+    dmGraphics::BeginGpuTimer(m_Context, 1);
+    dmGraphics::EndGpuTimer(m_Context);
+    dmGraphics::Flip(m_Context);
+
+    uint32_t result_count = 0;
+    dmGraphics::ResolveGpuTimers(m_Context, GpuTimerResultUnexpected, &result_count);
+    ASSERT_EQ(0u, result_count);
+}
+
+static void PixelReadbackUnexpected(void* user_data, uint32_t readback_id, const void* pixels, uint32_t size)
+{
+    *(uint32_t*) user_data += 1;
+}
+
+// The null adapter has no asynchronous readback, so it must be safe to call anyway
+TEST_F(dmGraphicsTest, PixelReadbackUnsupported)
+{
+    ASSERT_FALSE(dmGraphics::IsPixelReadbackSupported(m_Context));
+    ASSERT_FALSE(dmGraphics::ReadPixelsAsync(m_Context, 1));
+    dmGraphics::Flip(m_Context);
+
+    uint32_t result_count = 0;
+    dmGraphics::ResolvePixelReadbacks(m_Context, PixelReadbackUnexpected, &result_count, true);
+    ASSERT_EQ(0u, result_count);
+}
+
+// The null adapter has no indirect draws, so they must be safe to call anyway
+TEST_F(dmGraphicsTest, MultiDrawIndirectUnsupported)
+{
+    ASSERT_FALSE(dmGraphics::IsMultiDrawIndirectSupported(m_Context));
+
+    uint16_t indices[] = { 0, 1, 2 };
+    dmGraphics::DrawIndexedIndirectCommand command = { 3, 1, 0, 0, 0 };
+    dmGraphics::HIndexBuffer index_buffer = dmGraphics::NewIndexBuffer(m_Context, sizeof(indices), indices, dmGraphics::BUFFER_USAGE_STATIC_DRAW);
+    dmGraphics::HVertexBuffer indirect_buffer = dmGraphics::NewVertexBuffer(m_Context, sizeof(command), &command, dmGraphics::BUFFER_USAGE_STATIC_DRAW);
+
+    dmGraphics::DrawElementsIndirect(m_Context, dmGraphics::PRIMITIVE_TRIANGLES, dmGraphics::TYPE_UNSIGNED_SHORT, index_buffer, indirect_buffer, 0, 1);
+
+    dmGraphics::DeleteVertexBuffer(indirect_buffer);
+    dmGraphics::DeleteIndexBuffer(index_buffer);
+}
+
+// The null adapter has no indirect dispatch either
+TEST_F(dmGraphicsTest, ComputeIndirectUnsupported)
+{
+    ASSERT_FALSE(dmGraphics::IsComputeIndirectSupported(m_Context));
+
+    dmGraphics::DispatchIndirectCommand command = { 1, 1, 1 };
+    dmGraphics::HVertexBuffer indirect_buffer = dmGraphics::NewVertexBuffer(m_Context, sizeof(command), &command, dmGraphics::BUFFER_USAGE_STATIC_DRAW);
+
+    dmGraphics::Stats stats_start, stats_end;
+    dmGraphics::GetStats(m_Context, &stats_start);
+    dmGraphics::DispatchComputeIndirect(m_Context, indirect_buffer, 0);
+    dmGraphics::GetStats(m_Context, &stats_end);
+    ASSERT_EQ(stats_start.m_DispatchCalls, stats_end.m_DispatchCalls);
+
+    dmGraphics::DeleteVertexBuffer(indirect_buffer);
+}
+
 TEST_F(dmGraphicsTest, IndexBuffer)
 {
     char data[16];
@@ -397,6 +472,72 @@ TEST_F(dmGraphicsTest, Drawing)
     dmGraphics::DeleteVertexStreamDeclaration(stream_declaration);
 }
 
+TEST_F(dmGraphicsTest, Stats)
+{
+    float v[] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+    uint32_t i[] = { 0, 1, 2 };
+
+    dmGraphics::Stats start;
+    dmGraphics::GetStats(m_Context, &start);
+
+    dmGraphics::HVertexStreamDeclaration stream_declaration = dmGraphics::NewVertexStreamDeclaration(m_Context);
+    dmGraphics::AddVertexStream(stream_declaration, "position", 3, dmGraphics::TYPE_FLOAT, false);
+
+    dmGraphics::HVertexDeclaration vd = dmGraphics::NewVertexDeclaration(m_Context, stream_declaration);
+    dmGraphics::HVertexBuffer vb = dmGraphics::NewVertexBuffer(m_Context, sizeof(v), v, dmGraphics::BUFFER_USAGE_STREAM_DRAW);
+    dmGraphics::HIndexBuffer ib = dmGraphics::NewIndexBuffer(m_Context, sizeof(i), i, dmGraphics::BUFFER_USAGE_STREAM_DRAW);
+    dmGraphics::SetVertexBufferSubData(vb, 0, sizeof(float) * 3, v);
+
+    dmGraphics::EnableVertexBuffer(m_Context, vb, 0);
+    dmGraphics::EnableVertexDeclaration(m_Context, vd, 0);
+    dmGraphics::DrawElements(m_Context, dmGraphics::PRIMITIVE_TRIANGLES, 0, 3, dmGraphics::TYPE_UNSIGNED_INT, ib, 1);
+    dmGraphics::DrawElements(m_Context, dmGraphics::PRIMITIVE_TRIANGLES, 0, 3, dmGraphics::TYPE_UNSIGNED_INT, ib, 4);
+    dmGraphics::Draw(m_Context, dmGraphics::PRIMITIVE_TRIANGLES, 0, 3, 1);
+    dmGraphics::DisableVertexDeclaration(m_Context, vd);
+    dmGraphics::DisableVertexBuffer(m_Context, vb);
+
+    dmGraphics::TextureCreationParams creation_params;
+    dmGraphics::TextureParams params;
+    creation_params.m_Width = WIDTH;
+    creation_params.m_Height = HEIGHT;
+    creation_params.m_OriginalWidth = WIDTH;
+    creation_params.m_OriginalHeight = HEIGHT;
+    params.m_DataSize = WIDTH * HEIGHT;
+    params.m_Data = new char[params.m_DataSize];
+    params.m_Width = WIDTH;
+    params.m_Height = HEIGHT;
+    params.m_Format = dmGraphics::TEXTURE_FORMAT_LUMINANCE;
+    dmGraphics::HTexture texture = dmGraphics::NewTexture(m_Context, creation_params);
+    dmGraphics::SetTexture(texture, params);
+    delete [] (char*)params.m_Data;
+
+    dmGraphics::EnableTexture(m_Context, 0, 0, texture);
+    dmGraphics::DisableTexture(m_Context, 0, texture);
+
+    dmGraphics::Stats end, stats;
+    dmGraphics::GetStats(m_Context, &end);
+    dmGraphics::SubtractStats(end, start, &stats);
+
+    ASSERT_EQ(3u, stats.m_DrawCalls);
+    ASSERT_EQ(1u, stats.m_InstancedDrawCalls);
+    ASSERT_EQ(0u, stats.m_DispatchCalls);
+    ASSERT_EQ(1u, stats.m_TextureBinds);
+    ASSERT_EQ(sizeof(v) + sizeof(float) * 3, stats.m_VertexBytesUploaded);
+    ASSERT_EQ(sizeof(i), stats.m_IndexBytesUploaded);
+    ASSERT_EQ(WIDTH * HEIGHT, stats.m_TextureBytesUploaded);
+
+    dmGraphics::Stats total = start;
+    dmGraphics::AddStats(stats, &total);
+    ASSERT_EQ(end.m_DrawCalls, total.m_DrawCalls);
+    ASSERT_EQ(end.m_VertexBytesUploaded, total.m_VertexBytesUploaded);
+
+    dmGraphics::DeleteTexture(texture);
+    dmGraphics::DeleteIndexBuffer(ib);
+    dmGraphics::DeleteVertexBuffer(vb);
+    dmGraphics::DeleteVertexDeclaration(vd);
+    dmGraphics::DeleteVertexStreamDeclaration(stream_declaration);
+}
+
 static inline dmGraphics::ShaderDesc MakeDDFShaderDesc(dmGraphics::ShaderDesc::Shader* shader,
     dmGraphics::ShaderDesc::ShaderType type,
     dmGraphics::ShaderDesc::ResourceBinding* inputs, uint32_t input_count,
@@ -0,0 +1,178 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+#include <dlib/atomic.h>
+#include <dlib/thread.h>
+
+#include "opengl/graphics_opengl_defines.h"
+#include "graphics_private.h"
+#include "opengl/graphics_opengl_private.h"
+
+// The state cache decides which GL calls the adapter makes, so it can be tested without a GL context
+
+// Not all platform GL headers define GL_TEXTURE_CUBE_MAP, and the cache only compares the value
+static const GLenum TEXTURE_TYPE_CUBE_MAP = 0x8513;
+
+TEST(OpenGLStateCache, States)
+{
+    dmGraphics::OpenGLStateCache cache;
+    dmGraphics::ResetStateCache(&cache, 0);
+
+    // Nothing is known after a reset, so both enabling and disabling goes to GL
+    ASSERT_TRUE(dmGraphics::UpdateCachedState(&cache, dmGraphics::STATE_DEPTH_TEST, false));
+    ASSERT_TRUE(dmGraphics::UpdateCachedState(&cache, dmGraphics::STATE_BLEND, true));
+
+    ASSERT_FALSE(dmGraphics::UpdateCachedState(&cache, dmGraphics::STATE_DEPTH_TEST, false));
+    ASSERT_FALSE(dmGraphics::UpdateCachedState(&cache, dmGraphics::STATE_BLEND, true));
+
+    ASSERT_TRUE(dmGraphics::UpdateCachedState(&cache, dmGraphics::STATE_DEPTH_TEST, true));
+    ASSERT_FALSE(dmGraphics::UpdateCachedState(&cache, dmGraphics::STATE_DEPTH_TEST, true));
+    ASSERT_TRUE(dmGraphics::UpdateCachedState(&cache, dmGraphics::STATE_BLEND, false));
+    ASSERT_FALSE(dmGraphics::UpdateCachedState(&cache, dmGraphics::STATE_BLEND, false));
+
+    // The other states are unaffected
+    ASSERT_TRUE(dmGraphics::UpdateCachedState(&cache, dmGraphics::STATE_CULL_FACE, true));
+    ASSERT_FALSE(dmGraphics::UpdateCachedState(&cache, dmGraphics::STATE_DEPTH_TEST, true));
+}
+
+TEST(OpenGLStateCache, Program)
+{
+    dmGraphics::OpenGLStateCache cache;
+    dmGraphics::ResetStateCache(&cache, 0);
+
+    ASSERT_TRUE(dmGraphics::UpdateCachedProgram(&cache, 3));
+    ASSERT_FALSE(dmGraphics::UpdateCachedProgram(&cache, 3));
+    ASSERT_TRUE(dmGraphics::UpdateCachedProgram(&cache, 4));
+
+    // Deleting another program keeps the current one
+    dmGraphics::ForgetCachedProgram(&cache, 3);
+    ASSERT_FALSE(dmGraphics::UpdateCachedProgram(&cache, 4));
+
+    // The name of a deleted program can be reused by the next one
+    dmGraphics::ForgetCachedProgram(&cache, 4);
+    ASSERT_TRUE(dmGraphics::UpdateCachedProgram(&cache, 4));
+    ASSERT_FALSE(dmGraphics::UpdateCachedProgram(&cache, 4));
+}
+
+TEST(OpenGLStateCache, TextureBinding)
+{
+    dmGraphics::OpenGLStateCache cache;
+    dmGraphics::ResetStateCache(&cache, 0);
+
+    ASSERT_TRUE(dmGraphics::UpdateCachedActiveTextureUnit(&cache, 0));
+    ASSERT_FALSE(dmGraphics::UpdateCachedActiveTextureUnit(&cache, 0));
+    ASSERT_TRUE(dmGraphics::UpdateCachedTextureUnit(&cache, 0, 0, GL_TEXTURE_2D, 5));
+    ASSERT_FALSE(dmGraphics::UpdateCachedTextureUnit(&cache, 0, 0, GL_TEXTURE_2D, 5));
+
+    ASSERT_TRUE(dmGraphics::UpdateCachedActiveTextureUnit(&cache, 1));
+    ASSERT_TRUE(dmGraphics::UpdateCachedTextureUnit(&cache, 0, 1, GL_TEXTURE_2D, 5));
+    ASSERT_FALSE(dmGraphics::UpdateCachedTextureUnit(&cache, 0, 1, GL_TEXTURE_2D, 5));
+    ASSERT_TRUE(dmGraphics::UpdateCachedTextureUnit(&cache, 0, 1, GL_TEXTURE_2D, 6));
+    ASSERT_TRUE(dmGraphics::UpdateCachedTextureUnit(&cache, 0, 1, TEXTURE_TYPE_CUBE_MAP, 6));
+    ASSERT_FALSE(dmGraphics::UpdateCachedTextureUnit(&cache, 0, 1, TEXTURE_TYPE_CUBE_MAP, 6));
+
+    // Unit 0 is still bound
+    ASSERT_FALSE(dmGraphics::UpdateCachedTextureUnit(&cache, 0, 0, GL_TEXTURE_2D, 5));
+
+    // A texture was bound outside of the cache, e.g. by an upload, so none of the units can be trusted
+    ASSERT_TRUE(dmGraphics::UpdateCachedTextureUnit(&cache, 1, 0, GL_TEXTURE_2D, 5));
+    ASSERT_TRUE(dmGraphics::UpdateCachedTextureUnit(&cache, 1, 1, TEXTURE_TYPE_CUBE_MAP, 6));
+    ASSERT_FALSE(dmGraphics::UpdateCachedTextureUnit(&cache, 1, 0, GL_TEXTURE_2D, 5));
+    ASSERT_FALSE(dmGraphics::UpdateCachedTextureUnit(&cache, 1, 1, TEXTURE_TYPE_CUBE_MAP, 6));
+
+    // The active unit isn't affected by the texture bindings
+    ASSERT_FALSE(dmGraphics::UpdateCachedActiveTextureUnit(&cache, 1));
+
+    uint32_t last_unit = dmGraphics::STATE_CACHE_TEXTURE_UNIT_COUNT - 1;
+    ASSERT_TRUE(dmGraphics::UpdateCachedTextureUnit(&cache, 1, last_unit, GL_TEXTURE_2D, 7));
+    ASSERT_FALSE(dmGraphics::UpdateCachedTextureUnit(&cache, 1, last_unit, GL_TEXTURE_2D, 7));
+}
+
+struct TextureUploadThreadContext
+{
+    int32_atomic_t* m_TextureBindingsVersion;
+    uint32_t        m_UploadCount;
+};
+
+// Bumps the version like the texture uploads on the worker thread do (see InvalidateTextureBindings)
+static void TextureUploadThread(void* _ctx)
+{
+    TextureUploadThreadContext* ctx = (TextureUploadThreadContext*) _ctx;
+    for (uint32_t i = 0; i < ctx->m_UploadCount; ++i)
+    {
+        dmAtomicIncrement32(ctx->m_TextureBindingsVersion);
+    }
+}
+
+TEST(OpenGLStateCache, TextureUploadOnWorkerThread)
+{
+    int32_atomic_t texture_bindings_version = 0;
+
+    dmGraphics::OpenGLStateCache cache;
+    dmGraphics::ResetStateCache(&cache, dmAtomicGet32(&texture_bindings_version));
+
+    ASSERT_TRUE(dmGraphics::UpdateCachedTextureUnit(&cache, dmAtomicGet32(&texture_bindings_version), 0, GL_TEXTURE_2D, 5));
+    ASSERT_FALSE(dmGraphics::UpdateCachedTextureUnit(&cache, dmAtomicGet32(&texture_bindings_version), 0, GL_TEXTURE_2D, 5));
+
+    TextureUploadThreadContext ctx;
+    ctx.m_TextureBindingsVersion = &texture_bindings_version;
+    ctx.m_UploadCount = 1000;
+    dmThread::Thread thread = dmThread::New(TextureUploadThread, 0x80000, &ctx, "upload");
+    dmThread::Join(thread);
+    ASSERT_EQ(1000, dmAtomicGet32(&texture_bindings_version));
+
+    // The upload left another texture bound
+    ASSERT_TRUE(dmGraphics::UpdateCachedTextureUnit(&cache, dmAtomicGet32(&texture_bindings_version), 0, GL_TEXTURE_2D, 5));
+    ASSERT_FALSE(dmGraphics::UpdateCachedTextureUnit(&cache, dmAtomicGet32(&texture_bindings_version), 0, GL_TEXTURE_2D, 5));
+}
+
+TEST(OpenGLStateCache, Reset)
+{
+    dmGraphics::OpenGLStateCache cache;
+    dmGraphics::ResetStateCache(&cache, 0);
+
+    dmGraphics::UpdateCachedState(&cache, dmGraphics::STATE_BLEND, true);
+    dmGraphics::UpdateCachedProgram(&cache, 3);
+    dmGraphics::UpdateCachedActiveTextureUnit(&cache, 2);
+    dmGraphics::UpdateCachedTextureUnit(&cache, 0, 2, GL_TEXTURE_2D, 5);
+    cache.m_EnabledVertexAttribs = 0x5;
+
+    // E.g. at the start of a frame, in case GL was called outside of the adapter
+    dmGraphics::ResetStateCache(&cache, 7);
+
+    ASSERT_TRUE(dmGraphics::UpdateCachedState(&cache, dmGraphics::STATE_BLEND, true));
+    ASSERT_TRUE(dmGraphics::UpdateCachedProgram(&cache, 3));
+    ASSERT_TRUE(dmGraphics::UpdateCachedActiveTextureUnit(&cache, 2));
+    ASSERT_TRUE(dmGraphics::UpdateCachedTextureUnit(&cache, 7, 2, GL_TEXTURE_2D, 5));
+    ASSERT_EQ(7, cache.m_TextureBindingsVersion);
+    ASSERT_EQ(0u, cache.m_Known & ~(uint32_t) (dmGraphics::STATE_CACHE_PROGRAM | dmGraphics::STATE_CACHE_ACTIVE_TEXTURE_UNIT));
+
+    // The enabled vertex attributes are kept, so that stale ones are still disabled by the next draw call
+    ASSERT_EQ(0x5u, cache.m_EnabledVertexAttribs);
+    ASSERT_EQ(0u, cache.m_UsedVertexAttribs);
+
+    // After the reset, the units are valid for the new version only
+    ASSERT_FALSE(dmGraphics::UpdateCachedTextureUnit(&cache, 7, 2, GL_TEXTURE_2D, 5));
+    ASSERT_TRUE(dmGraphics::UpdateCachedTextureUnit(&cache, 8, 2, GL_TEXTURE_2D, 5));
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
@@ -0,0 +1,459 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+#include <string.h>
+#include <dlib/array.h>
+#include <dlib/profile.h>
+
+#include "vulkan/graphics_vulkan_defines.h"
+#include "vulkan/graphics_vulkan_private.h"
+
+// Normally defined in graphics.cpp
+DM_PROPERTY_GROUP(rmtp_Graphics, "Graphics");
+
+// Non dispatchable handles are pointers on 64 bit platforms and integers on 32 bit platforms
+template<typename T>
+static T MakeHandle(uintptr_t id)
+{
+    return (T) id;
+}
+
+TEST(VulkanBindings, IndexBuffer)
+{
+    dmGraphics::CommandBufferBindings bindings;
+    dmGraphics::ResetCommandBufferBindings(&bindings);
+
+    VkBuffer buffer_a = MakeHandle<VkBuffer>(1);
+    VkBuffer buffer_b = MakeHandle<VkBuffer>(2);
+
+    ASSERT_TRUE(dmGraphics::UpdateBoundIndexBuffer(&bindings, buffer_a, VK_INDEX_TYPE_UINT16));
+    ASSERT_FALSE(dmGraphics::UpdateBoundIndexBuffer(&bindings, buffer_a, VK_INDEX_TYPE_UINT16));
+
+    // The same buffer read with another index type must be bound again
+    ASSERT_TRUE(dmGraphics::UpdateBoundIndexBuffer(&bindings, buffer_a, VK_INDEX_TYPE_UINT32));
+    ASSERT_FALSE(dmGraphics::UpdateBoundIndexBuffer(&bindings, buffer_a, VK_INDEX_TYPE_UINT32));
+
+    ASSERT_TRUE(dmGraphics::UpdateBoundIndexBuffer(&bindings, buffer_b, VK_INDEX_TYPE_UINT32));
+    ASSERT_FALSE(dmGraphics::UpdateBoundIndexBuffer(&bindings, buffer_b, VK_INDEX_TYPE_UINT32));
+
+    // Nothing is bound in a command buffer that just began
+    dmGraphics::ResetCommandBufferBindings(&bindings);
+    ASSERT_TRUE(dmGraphics::UpdateBoundIndexBuffer(&bindings, buffer_b, VK_INDEX_TYPE_UINT32));
+}
+
+TEST(VulkanBindings, VertexBuffers)
+{
+    dmGraphics::CommandBufferBindings bindings;
+    dmGraphics::ResetCommandBufferBindings(&bindings);
+
+    VkBuffer buffers[] = { MakeHandle<VkBuffer>(1), MakeHandle<VkBuffer>(2) };
+    VkDeviceSize offsets[] = { 0, 64 };
+
+    ASSERT_TRUE(dmGraphics::UpdateBoundVertexBuffers(&bindings, buffers, offsets, 2));
+    ASSERT_FALSE(dmGraphics::UpdateBoundVertexBuffers(&bindings, buffers, offsets, 2));
+
+    // Fewer buffers
+    ASSERT_TRUE(dmGraphics::UpdateBoundVertexBuffers(&bindings, buffers, offsets, 1));
+    ASSERT_FALSE(dmGraphics::UpdateBoundVertexBuffers(&bindings, buffers, offsets, 1));
+    ASSERT_TRUE(dmGraphics::UpdateBoundVertexBuffers(&bindings, buffers, offsets, 2));
+
+    // Same buffers at other offsets, e.g. the next batch in a shared vertex buffer
+    offsets[1] = 128;
+    ASSERT_TRUE(dmGraphics::UpdateBoundVertexBuffers(&bindings, buffers, offsets, 2));
+    ASSERT_FALSE(dmGraphics::UpdateBoundVertexBuffers(&bindings, buffers, offsets, 2));
+
+    buffers[1] = MakeHandle<VkBuffer>(3);
+    ASSERT_TRUE(dmGraphics::UpdateBoundVertexBuffers(&bindings, buffers, offsets, 2));
+    ASSERT_FALSE(dmGraphics::UpdateBoundVertexBuffers(&bindings, buffers, offsets, 2));
+
+    dmGraphics::ResetCommandBufferBindings(&bindings);
+    ASSERT_TRUE(dmGraphics::UpdateBoundVertexBuffers(&bindings, buffers, offsets, 2));
+}
+
+TEST(VulkanBindings, DescriptorSets)
+{
+    dmGraphics::CommandBufferBindings bindings;
+    dmGraphics::ResetCommandBufferBindings(&bindings);
+
+    VkPipelineLayout layout_a = MakeHandle<VkPipelineLayout>(1);
+    VkPipelineLayout layout_b = MakeHandle<VkPipelineLayout>(2);
+    VkDescriptorSet sets[] = { MakeHandle<VkDescriptorSet>(10), MakeHandle<VkDescriptorSet>(11) };
+    uint32_t dynamic_offsets[] = { 0, 256, 512 };
+
+    ASSERT_TRUE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 3));
+
+    // Consecutive draws of a batch
+    ASSERT_FALSE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 3));
+    ASSERT_FALSE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 3));
+
+    // New uniform data in the scratch buffer, same sets
+    dynamic_offsets[2] = 768;
+    ASSERT_TRUE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 3));
+    ASSERT_FALSE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 3));
+
+    // Other textures, same uniform data
+    sets[1] = MakeHandle<VkDescriptorSet>(12);
+    ASSERT_TRUE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 3));
+    ASSERT_FALSE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 3));
+
+    // Another program with the same sets and offsets, but another pipeline layout
+    ASSERT_TRUE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_b, sets, 2, dynamic_offsets, 3));
+    ASSERT_FALSE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_b, sets, 2, dynamic_offsets, 3));
+    ASSERT_TRUE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 3));
+
+    // Fewer sets or dynamic offsets
+    ASSERT_TRUE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 1, dynamic_offsets, 3));
+    ASSERT_FALSE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 1, dynamic_offsets, 3));
+    ASSERT_TRUE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 1, dynamic_offsets, 2));
+    ASSERT_FALSE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 1, dynamic_offsets, 2));
+
+    // Only the bound sets are compared, not what was left from an earlier bind with more sets
+    sets[1] = MakeHandle<VkDescriptorSet>(13);
+    ASSERT_TRUE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 2));
+    ASSERT_FALSE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 2));
+
+    // Programs without uniform blocks have no dynamic offsets
+    ASSERT_TRUE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 0));
+    ASSERT_FALSE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 0));
+
+    dmGraphics::ResetCommandBufferBindings(&bindings);
+    ASSERT_TRUE(dmGraphics::UpdateBoundDescriptorSets(&bindings, layout_a, sets, 2, dynamic_offsets, 0));
+}
+
+// The device memory allocator only calls these, so they are stubbed instead of linking against a driver
+struct VulkanMemoryStub
+{
+    VkPhysicalDeviceMemoryProperties m_MemoryProperties;
+    uintptr_t                        m_NextMemory;
+    uint32_t                         m_LiveAllocations;
+    uint32_t                         m_MapCount;
+    VkDeviceSize                     m_LastMapOffset;
+};
+
+static VulkanMemoryStub g_VulkanMemoryStub;
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceMemoryProperties(VkPhysicalDevice physicalDevice, VkPhysicalDeviceMemoryProperties* pMemoryProperties)
+{
+    *pMemoryProperties = g_VulkanMemoryStub.m_MemoryProperties;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAllocateMemory(VkDevice device, const VkMemoryAllocateInfo* pAllocateInfo, const VkAllocationCallbacks* pAllocator, VkDeviceMemory* pMemory)
+{
+    *pMemory = MakeHandle<VkDeviceMemory>(++g_VulkanMemoryStub.m_NextMemory);
+    g_VulkanMemoryStub.m_LiveAllocations++;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkFreeMemory(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* pAllocator)
+{
+    g_VulkanMemoryStub.m_LiveAllocations--;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkMapMemory(VkDevice device, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size, VkMemoryMapFlags flags, void** ppData)
+{
+    // Never dereferenced, only the offsets from it are checked
+    *ppData = (void*) 0x10000;
+    g_VulkanMemoryStub.m_MapCount++;
+    g_VulkanMemoryStub.m_LastMapOffset = offset;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkUnmapMemory(VkDevice device, VkDeviceMemory memory)
+{
+}
+
+static const uint32_t MEMORY_TYPE_DEVICE = 0; // 1GB heap, 32MB blocks
+static const uint32_t MEMORY_TYPE_HOST   = 1; // 64MB heap, 8MB blocks
+static const uint32_t MEMORY_TYPE_LAZY   = 2;
+
+static const uint32_t DEVICE_BLOCK_SIZE = 32 * 1024 * 1024;
+static const uint32_t HOST_BLOCK_SIZE   = 8 * 1024 * 1024;
+
+class VulkanMemoryTest : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        memset(&g_VulkanMemoryStub, 0, sizeof(g_VulkanMemoryStub));
+        VkPhysicalDeviceMemoryProperties& props = g_VulkanMemoryStub.m_MemoryProperties;
+        props.memoryHeapCount     = 2;
+        props.memoryHeaps[0].size  = 1024 * 1024 * 1024;
+        props.memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        props.memoryHeaps[1].size  = 64 * 1024 * 1024;
+        props.memoryTypeCount     = 3;
+        props.memoryTypes[MEMORY_TYPE_DEVICE].heapIndex     = 0;
+        props.memoryTypes[MEMORY_TYPE_DEVICE].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        props.memoryTypes[MEMORY_TYPE_HOST].heapIndex       = 1;
+        props.memoryTypes[MEMORY_TYPE_HOST].propertyFlags   = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        props.memoryTypes[MEMORY_TYPE_LAZY].heapIndex       = 0;
+        props.memoryTypes[MEMORY_TYPE_LAZY].propertyFlags   = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    }
+
+    virtual void TearDown()
+    {
+        // Also makes the next test read the memory properties again
+        dmGraphics::DestroyDeviceMemory(0);
+        ASSERT_EQ(0u, g_VulkanMemoryStub.m_LiveAllocations);
+    }
+
+    dmGraphics::DeviceBuffer::VulkanHandle Allocate(uint32_t size, uint32_t alignment, uint32_t memory_type_index, dmGraphics::DeviceMemoryUsage usage)
+    {
+        VkMemoryRequirements req;
+        req.size           = size;
+        req.alignment      = alignment;
+        req.memoryTypeBits = 1 << memory_type_index;
+
+        dmGraphics::DeviceBuffer::VulkanHandle handle;
+        memset(&handle, 0, sizeof(handle));
+        EXPECT_EQ(VK_SUCCESS, dmGraphics::AllocateDeviceMemory(0, 0, req, memory_type_index, usage, &handle));
+        return handle;
+    }
+
+    dmGraphics::DeviceMemoryStats GetStats()
+    {
+        dmGraphics::DeviceMemoryStats stats;
+        dmGraphics::GetDeviceMemoryStats(&stats);
+        return stats;
+    }
+};
+
+TEST_F(VulkanMemoryTest, SplitWithAlignment)
+{
+    dmGraphics::DeviceBuffer::VulkanHandle a = Allocate(100, 1, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+    ASSERT_NE((dmGraphics::DeviceMemoryBlock*) 0, a.m_MemoryBlock);
+    ASSERT_EQ(0u, a.m_MemoryOffset);
+    ASSERT_EQ(100u, a.m_MemoryAllocSize);
+
+    // The padding [100, 256) stays free
+    dmGraphics::DeviceBuffer::VulkanHandle b = Allocate(256, 256, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+    ASSERT_EQ(256u, b.m_MemoryOffset);
+
+    // First fit, in the padding
+    dmGraphics::DeviceBuffer::VulkanHandle c = Allocate(100, 4, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+    ASSERT_EQ(100u, c.m_MemoryOffset);
+
+    // [200, 256) is large enough, but not once aligned
+    dmGraphics::DeviceBuffer::VulkanHandle d = Allocate(8, 64, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+    ASSERT_EQ(512u, d.m_MemoryOffset);
+
+    // Fills [200, 256) exactly
+    dmGraphics::DeviceBuffer::VulkanHandle e = Allocate(56, 8, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+    ASSERT_EQ(200u, e.m_MemoryOffset);
+
+    // Right after d
+    dmGraphics::DeviceBuffer::VulkanHandle f = Allocate(256, 1, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+    ASSERT_EQ(520u, f.m_MemoryOffset);
+
+    dmGraphics::DeviceBuffer::VulkanHandle* handles[] = { &a, &b, &c, &d, &e, &f };
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(handles); ++i)
+    {
+        ASSERT_EQ(a.m_Memory, handles[i]->m_Memory);
+        ASSERT_EQ(a.m_MemoryBlock, handles[i]->m_MemoryBlock);
+    }
+
+    // Images are kept in other blocks than buffers
+    dmGraphics::DeviceBuffer::VulkanHandle image = Allocate(100, 1, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_IMAGE);
+    ASSERT_NE(a.m_Memory, image.m_Memory);
+    ASSERT_EQ(0u, image.m_MemoryOffset);
+
+    dmGraphics::DeviceMemoryStats stats = GetStats();
+    ASSERT_EQ(2u, stats.m_AllocationCount);
+    ASSERT_EQ(7u, stats.m_SuballocationCount);
+    ASSERT_EQ(100u + 256 + 100 + 8 + 56 + 256 + 100, stats.m_Heaps[0].m_Used);
+    ASSERT_EQ(2u * DEVICE_BLOCK_SIZE, stats.m_Heaps[0].m_Reserved);
+
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(handles); ++i)
+    {
+        dmGraphics::FreeDeviceMemory(0, handles[i]);
+        ASSERT_EQ(VK_NULL_HANDLE, handles[i]->m_Memory);
+    }
+    dmGraphics::FreeDeviceMemory(0, &image);
+
+    // One empty block is kept per memory type and kind
+    stats = GetStats();
+    ASSERT_EQ(2u, stats.m_AllocationCount);
+    ASSERT_EQ(0u, stats.m_SuballocationCount);
+    ASSERT_EQ(0u, stats.m_Heaps[0].m_Used);
+}
+
+TEST_F(VulkanMemoryTest, MergeFreesInAnyOrder)
+{
+    const uint32_t count = 8;
+    const uint32_t orders[][count] = {
+        { 0, 1, 2, 3, 4, 5, 6, 7 },
+        { 7, 6, 5, 4, 3, 2, 1, 0 },
+        { 1, 3, 5, 7, 0, 2, 4, 6 }, // Merges with both neighbours
+        { 3, 4, 2, 5, 1, 6, 0, 7 },
+        { 6, 0, 4, 2, 7, 1, 5, 3 },
+    };
+
+    VkDeviceMemory block_memory = VK_NULL_HANDLE;
+    for (uint32_t o = 0; o < DM_ARRAY_SIZE(orders); ++o)
+    {
+        dmGraphics::DeviceBuffer::VulkanHandle handles[count];
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            handles[i] = Allocate(1024, 1024, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+            ASSERT_EQ(i * 1024, handles[i].m_MemoryOffset);
+        }
+
+        // The empty block is reused
+        if (o == 0)
+            block_memory = handles[0].m_Memory;
+        ASSERT_EQ(block_memory, handles[0].m_Memory);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            dmGraphics::FreeDeviceMemory(0, &handles[orders[o][i]]);
+
+            // A single hole, not next to the free space after the last allocation, so a larger allocation doesn't fit in it
+            if (i == 0 && orders[o][0] != count - 1)
+            {
+                dmGraphics::DeviceBuffer::VulkanHandle larger = Allocate(2048, 1, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+                ASSERT_EQ(count * 1024, larger.m_MemoryOffset);
+                dmGraphics::FreeDeviceMemory(0, &larger);
+            }
+        }
+
+        // The largest allocation that isn't dedicated only fits if all the ranges were merged back into one
+        dmGraphics::DeviceBuffer::VulkanHandle half = Allocate(DEVICE_BLOCK_SIZE / 2, 1, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+        ASSERT_EQ(block_memory, half.m_Memory);
+        ASSERT_EQ(0u, half.m_MemoryOffset);
+        dmGraphics::DeviceBuffer::VulkanHandle other_half = Allocate(DEVICE_BLOCK_SIZE / 2, 1, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+        ASSERT_EQ(block_memory, other_half.m_Memory);
+        ASSERT_EQ(DEVICE_BLOCK_SIZE / 2, other_half.m_MemoryOffset);
+        dmGraphics::FreeDeviceMemory(0, &other_half);
+        dmGraphics::FreeDeviceMemory(0, &half);
+
+        ASSERT_EQ(1u, GetStats().m_AllocationCount);
+    }
+}
+
+TEST_F(VulkanMemoryTest, FullBlock)
+{
+    dmGraphics::DeviceBuffer::VulkanHandle a = Allocate(HOST_BLOCK_SIZE / 2, 16, MEMORY_TYPE_HOST, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+    dmGraphics::DeviceBuffer::VulkanHandle b = Allocate(HOST_BLOCK_SIZE / 2, 16, MEMORY_TYPE_HOST, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+    ASSERT_EQ(a.m_Memory, b.m_Memory);
+    ASSERT_EQ(HOST_BLOCK_SIZE / 2, b.m_MemoryOffset);
+    ASSERT_EQ(1u, GetStats().m_AllocationCount);
+
+    // The block is full, so a new one is allocated
+    dmGraphics::DeviceBuffer::VulkanHandle c = Allocate(16, 16, MEMORY_TYPE_HOST, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+    ASSERT_NE((dmGraphics::DeviceMemoryBlock*) 0, c.m_MemoryBlock);
+    ASSERT_NE(a.m_MemoryBlock, c.m_MemoryBlock);
+    ASSERT_NE(a.m_Memory, c.m_Memory);
+    ASSERT_EQ(0u, c.m_MemoryOffset);
+
+    dmGraphics::DeviceMemoryStats stats = GetStats();
+    ASSERT_EQ(2u, stats.m_AllocationCount);
+    ASSERT_EQ(3u, stats.m_SuballocationCount);
+    ASSERT_EQ(2u * HOST_BLOCK_SIZE, stats.m_Heaps[1].m_Reserved);
+    ASSERT_EQ(HOST_BLOCK_SIZE + 16u, stats.m_Heaps[1].m_Used);
+    ASSERT_EQ(0u, stats.m_Heaps[0].m_Reserved);
+
+    // A block is mapped once for all its allocations
+    void* data_a = 0;
+    void* data_b = 0;
+    ASSERT_EQ(VK_SUCCESS, dmGraphics::MapDeviceMemory(0, a, 0, 16, &data_a));
+    ASSERT_EQ(VK_SUCCESS, dmGraphics::MapDeviceMemory(0, b, 8, 16, &data_b));
+    ASSERT_EQ(1u, g_VulkanMemoryStub.m_MapCount);
+    ASSERT_EQ(HOST_BLOCK_SIZE / 2 + 8, (uint32_t) ((uint8_t*) data_b - (uint8_t*) data_a));
+
+    // Freeing space in the first block makes it the first fit again
+    dmGraphics::FreeDeviceMemory(0, &b);
+    dmGraphics::DeviceBuffer::VulkanHandle d = Allocate(16, 16, MEMORY_TYPE_HOST, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER);
+    ASSERT_EQ(a.m_Memory, d.m_Memory);
+    ASSERT_EQ(HOST_BLOCK_SIZE / 2, d.m_MemoryOffset);
+
+    // The second block is the only empty one, so it is kept
+    dmGraphics::FreeDeviceMemory(0, &c);
+    ASSERT_EQ(2u, GetStats().m_AllocationCount);
+
+    // Now both are empty, so one of them is released
+    dmGraphics::FreeDeviceMemory(0, &d);
+    dmGraphics::FreeDeviceMemory(0, &a);
+    stats = GetStats();
+    ASSERT_EQ(1u, stats.m_AllocationCount);
+    ASSERT_EQ(0u, stats.m_SuballocationCount);
+    ASSERT_EQ(HOST_BLOCK_SIZE, stats.m_Heaps[1].m_Reserved);
+    ASSERT_EQ(0u, stats.m_Heaps[1].m_Used);
+    ASSERT_EQ(1u, g_VulkanMemoryStub.m_LiveAllocations);
+}
+
+TEST_F(VulkanMemoryTest, Dedicated)
+{
+    struct Case
+    {
+        uint32_t                      m_Size;
+        uint32_t                      m_MemoryTypeIndex;
+        dmGraphics::DeviceMemoryUsage m_Usage;
+        bool                          m_Dedicated;
+    };
+    const Case cases[] = {
+        { 256,                       MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_DEDICATED,  true },
+        { 256,                       MEMORY_TYPE_LAZY,   dmGraphics::DEVICE_MEMORY_USAGE_IMAGE,      true },
+        { DEVICE_BLOCK_SIZE / 8,     MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_ATTACHMENT, true },
+        { DEVICE_BLOCK_SIZE / 8 - 1, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_ATTACHMENT, false },
+        { DEVICE_BLOCK_SIZE / 2 + 1, MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_BUFFER,     true },
+        { DEVICE_BLOCK_SIZE / 2,     MEMORY_TYPE_DEVICE, dmGraphics::DEVICE_MEMORY_USAGE_IMAGE,      false },
+        { HOST_BLOCK_SIZE / 2 + 1,   MEMORY_TYPE_HOST,   dmGraphics::DEVICE_MEMORY_USAGE_BUFFER,     true },
+    };
+
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(cases); ++i)
+    {
+        uint32_t allocation_count = GetStats().m_AllocationCount;
+
+        dmGraphics::DeviceBuffer::VulkanHandle handle = Allocate(cases[i].m_Size, 256, cases[i].m_MemoryTypeIndex, cases[i].m_Usage);
+        ASSERT_EQ(cases[i].m_Size, handle.m_MemoryAllocSize);
+        uint32_t heap_index = g_VulkanMemoryStub.m_MemoryProperties.memoryTypes[cases[i].m_MemoryTypeIndex].heapIndex;
+
+        if (cases[i].m_Dedicated)
+        {
+            ASSERT_EQ((dmGraphics::DeviceMemoryBlock*) 0, handle.m_MemoryBlock);
+            ASSERT_EQ(0u, handle.m_MemoryOffset);
+            ASSERT_EQ(allocation_count + 1, GetStats().m_AllocationCount);
+            ASSERT_EQ(0u, GetStats().m_SuballocationCount);
+            ASSERT_EQ(cases[i].m_Size, GetStats().m_Heaps[heap_index].m_Used);
+
+            // Dedicated allocations are mapped on their own
+            void* data = 0;
+            uint32_t map_count = g_VulkanMemoryStub.m_MapCount;
+            ASSERT_EQ(VK_SUCCESS, dmGraphics::MapDeviceMemory(0, handle, 64, 16, &data));
+            ASSERT_EQ(map_count + 1, g_VulkanMemoryStub.m_MapCount);
+            ASSERT_EQ(64u, (uint32_t) g_VulkanMemoryStub.m_LastMapOffset);
+            dmGraphics::UnmapDeviceMemory(0, handle);
+
+            dmGraphics::FreeDeviceMemory(0, &handle);
+            ASSERT_EQ(allocation_count, GetStats().m_AllocationCount);
+        }
+        else
+        {
+            ASSERT_NE((dmGraphics::DeviceMemoryBlock*) 0, handle.m_MemoryBlock);
+            ASSERT_EQ(1u, GetStats().m_SuballocationCount);
+            dmGraphics::FreeDeviceMemory(0, &handle);
+            ASSERT_EQ(0u, GetStats().m_SuballocationCount);
+        }
+        ASSERT_EQ(0u, GetStats().m_Heaps[heap_index].m_Used);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
@@ -12,9 +12,11 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include <dlib/atomic.h>
 #include <dlib/log.h>
 #include <dlib/math.h>
 #include <dlib/profile.h>
+#include <dlib/time.h>
 #include "graphics.h"
 #include <basis/transcoder/basisu_transcoder.h>
 
@@ -287,6 +289,27 @@ namespace dmGraphics
         return true;
     }
 
+    // The textures are transcoded on the resource load threads, so the first call may come from several threads at once
+    static int32_atomic_t g_TranscoderInitState = 0; // 0: not initialized, 1: initializing, 2: initialized
+
+    static void InitTranscoder()
+    {
+        if (dmAtomicGet32(&g_TranscoderInitState) == 2)
+            return;
+
+        if (dmAtomicCompareStore32(&g_TranscoderInitState, 1, 0) == 0)
+        {
+            basist::basisu_transcoder_init();
+            dmAtomicStore32(&g_TranscoderInitState, 2);
+            return;
+        }
+
+        while (dmAtomicGet32(&g_TranscoderInitState) != 2)
+        {
+            dmTime::Sleep(0);
+        }
+    }
+
     bool Transcode(const char* path, dmGraphics::TextureImage::Image* image, uint8_t image_count, dmGraphics::TextureFormat format,
                     uint8_t** images, uint32_t* sizes, uint32_t* num_transcoded_mips)
     {
@@ -294,12 +317,7 @@ namespace dmGraphics
 
         assert(image_count > 0);
 
-        static int first = 1;
-        if (first)
-        {
-            first = 0;
-            basist::basisu_transcoder_init();
-        }
+        InitTranscoder();
 
         basist::transcoder_texture_format transcoder_format;
         if (!TextureFormatToBasisFormat(format, transcoder_format))
@@ -115,6 +115,7 @@ PFN_vkDestroyRenderPass vkDestroyRenderPass;
 PFN_vkDestroyFramebuffer vkDestroyFramebuffer;
 PFN_vkDestroyShaderModule vkDestroyShaderModule;
 PFN_vkDestroyPipelineCache vkDestroyPipelineCache;
+PFN_vkGetPipelineCacheData vkGetPipelineCacheData;
 PFN_vkCreateQueryPool vkCreateQueryPool;
 PFN_vkDestroyQueryPool vkDestroyQueryPool;
 PFN_vkGetQueryPoolResults vkGetQueryPoolResults;
@@ -122,6 +123,7 @@ PFN_vkCmdBeginQuery vkCmdBeginQuery;
 PFN_vkCmdEndQuery vkCmdEndQuery;
 PFN_vkCmdResetQueryPool vkCmdResetQueryPool;
 PFN_vkCmdCopyQueryPoolResults vkCmdCopyQueryPoolResults;
+PFN_vkCmdWriteTimestamp vkCmdWriteTimestamp;
 PFN_vkCreateAndroidSurfaceKHR vkCreateAndroidSurfaceKHR;
 PFN_vkDestroySurfaceKHR vkDestroySurfaceKHR;
 PFN_vkGetPhysicalDeviceSurfaceSupportKHR vkGetPhysicalDeviceSurfaceSupportKHR;
@@ -265,6 +267,7 @@ namespace dmGraphics
         vkDestroyFramebuffer = (PFN_vkDestroyFramebuffer) vkGetInstanceProcAddr(vk_instance, "vkDestroyFramebuffer");
         vkDestroyShaderModule = (PFN_vkDestroyShaderModule) vkGetInstanceProcAddr(vk_instance, "vkDestroyShaderModule");
         vkDestroyPipelineCache = (PFN_vkDestroyPipelineCache) vkGetInstanceProcAddr(vk_instance, "vkDestroyPipelineCache");
+        vkGetPipelineCacheData = (PFN_vkGetPipelineCacheData) vkGetInstanceProcAddr(vk_instance, "vkGetPipelineCacheData");
         vkCreateQueryPool = (PFN_vkCreateQueryPool) vkGetInstanceProcAddr(vk_instance, "vkCreateQueryPool");
         vkDestroyQueryPool = (PFN_vkDestroyQueryPool) vkGetInstanceProcAddr(vk_instance, "vkDestroyQueryPool");
         vkGetQueryPoolResults = (PFN_vkGetQueryPoolResults) vkGetInstanceProcAddr(vk_instance, "vkGetQueryPoolResults");
@@ -272,6 +275,7 @@ namespace dmGraphics
         vkCmdEndQuery = (PFN_vkCmdEndQuery) vkGetInstanceProcAddr(vk_instance, "vkCmdEndQuery");
         vkCmdResetQueryPool = (PFN_vkCmdResetQueryPool) vkGetInstanceProcAddr(vk_instance, "vkCmdResetQueryPool");
         vkCmdCopyQueryPoolResults = (PFN_vkCmdCopyQueryPoolResults) vkGetInstanceProcAddr(vk_instance, "vkCmdCopyQueryPoolResults");
+        vkCmdWriteTimestamp = (PFN_vkCmdWriteTimestamp) vkGetInstanceProcAddr(vk_instance, "vkCmdWriteTimestamp");
         vkCreateAndroidSurfaceKHR = (PFN_vkCreateAndroidSurfaceKHR) vkGetInstanceProcAddr(vk_instance, "vkCreateAndroidSurfaceKHR");
         vkDestroySurfaceKHR = (PFN_vkDestroySurfaceKHR) vkGetInstanceProcAddr(vk_instance, "vkDestroySurfaceKHR");
         vkGetPhysicalDeviceSurfaceSupportKHR = (PFN_vkGetPhysicalDeviceSurfaceSupportKHR) vkGetInstanceProcAddr(vk_instance, "vkGetPhysicalDeviceSurfaceSupportKHR");
@@ -12,11 +12,14 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include <stdio.h>
+
 #include <dlib/math.h>
 #include <dlib/array.h>
 #include <dlib/profile.h>
 #include <dlib/dstrings.h>
 #include <dlib/log.h>
+#include <dlib/sys.h>
 
 #include <dmsdk/vectormath/cpp/vectormath_aos.h>
 
@@ -117,6 +120,7 @@ namespace dmGraphics
         m_VerifyGraphicsCalls     = params.m_VerifyGraphicsCalls;
         m_UseValidationLayers     = params.m_UseValidationLayers;
         m_RenderDocSupport        = params.m_RenderDocSupport;
+        m_PipelineCachePath       = params.m_PipelineCachePath ? strdup(params.m_PipelineCachePath) : 0;
         m_Window                  = params.m_Window;
         m_Width                   = params.m_Width;
         m_Height                  = params.m_Height;
@@ -180,6 +184,242 @@ namespace dmGraphics
         return VK_SUCCESS;
     }
 
+    static VkResult CreateTextureUploadRing(VkPhysicalDevice vk_physical_device, VkDevice vk_device, VkCommandPool vk_command_pool, TextureUploadRing* ring)
+    {
+        memset(ring, 0, sizeof(TextureUploadRing));
+        ring->m_StagingBuffer.m_Usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+        VkResult res = CreateDeviceBuffer(vk_physical_device, vk_device, DM_TEXTURE_UPLOAD_RING_SIZE,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &ring->m_StagingBuffer);
+        if (res != VK_SUCCESS)
+        {
+            return res;
+        }
+
+        // The ring stays mapped for the lifetime of the context
+        res = ring->m_StagingBuffer.MapMemory(vk_device);
+        if (res != VK_SUCCESS)
+        {
+            return res;
+        }
+
+        VkFenceCreateInfo vk_create_fence_info;
+        memset(&vk_create_fence_info, 0, sizeof(vk_create_fence_info));
+        vk_create_fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        for (uint8_t i = 0; i < DM_MAX_TEXTURE_UPLOAD_BATCHES; ++i)
+        {
+            res = CreateCommandBuffers(vk_device, vk_command_pool, 1, &ring->m_Batches[i].m_CommandBuffer);
+            if (res != VK_SUCCESS)
+            {
+                return res;
+            }
+
+            if (vkCreateFence(vk_device, &vk_create_fence_info, 0, &ring->m_Batches[i].m_Fence) != VK_SUCCESS)
+            {
+                return VK_ERROR_INITIALIZATION_FAILED;
+            }
+        }
+
+        return VK_SUCCESS;
+    }
+
+    // Reclaims the ring memory of submitted batches in submission order. If wait_for_oldest is set,
+    // the oldest batch in flight is waited on so that at least one batch is retired.
+    static void RetireTextureUploads(VkDevice vk_device, TextureUploadRing* ring, bool wait_for_oldest)
+    {
+        while (ring->m_InFlightCount > 0)
+        {
+            TextureUploadBatch& batch = ring->m_Batches[ring->m_FirstBatch];
+            uint64_t timeout = wait_for_oldest ? UINT64_MAX : 0;
+
+            if (vkWaitForFences(vk_device, 1, &batch.m_Fence, VK_TRUE, timeout) != VK_SUCCESS)
+            {
+                break;
+            }
+
+            vkResetFences(vk_device, 1, &batch.m_Fence);
+            ring->m_Used         -= batch.m_RingBytes;
+            batch.m_RingBytes     = 0;
+            ring->m_FirstBatch    = (ring->m_FirstBatch + 1) % DM_MAX_TEXTURE_UPLOAD_BATCHES;
+            ring->m_InFlightCount--;
+            wait_for_oldest       = false;
+        }
+
+        if (ring->m_InFlightCount == 0 && !ring->m_Recording)
+        {
+            ring->m_Head = 0;
+        }
+    }
+
+    // Submits the recorded texture copies, if any. Since they are submitted on the graphics queue
+    // ahead of any command buffer that samples the textures, no additional waiting is needed.
+    static void FlushTextureUploads(VulkanContext* context)
+    {
+        TextureUploadRing* ring = &context->m_TextureUploadRing;
+        if (!ring->m_Recording)
+        {
+            return;
+        }
+
+        TextureUploadBatch& batch = ring->m_Batches[(ring->m_FirstBatch + ring->m_InFlightCount) % DM_MAX_TEXTURE_UPLOAD_BATCHES];
+
+        VkResult res = vkEndCommandBuffer(batch.m_CommandBuffer);
+        CHECK_VK_ERROR(res);
+
+        VkSubmitInfo vk_submit_info;
+        memset(&vk_submit_info, 0, sizeof(vk_submit_info));
+        vk_submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        vk_submit_info.commandBufferCount = 1;
+        vk_submit_info.pCommandBuffers    = &batch.m_CommandBuffer;
+
+        res = vkQueueSubmit(context->m_LogicalDevice.m_GraphicsQueue, 1, &vk_submit_info, batch.m_Fence);
+        CHECK_VK_ERROR(res);
+
+        ring->m_Recording = 0;
+        ring->m_InFlightCount++;
+    }
+
+    // Returns the command buffer that texture copies are recorded into, starting a new batch if needed.
+    static VkCommandBuffer GetTextureUploadCommandBuffer(VulkanContext* context)
+    {
+        VkDevice vk_device       = context->m_LogicalDevice.m_Device;
+        TextureUploadRing* ring  = &context->m_TextureUploadRing;
+
+        if (!ring->m_Recording)
+        {
+            if (ring->m_InFlightCount == DM_MAX_TEXTURE_UPLOAD_BATCHES)
+            {
+                RetireTextureUploads(vk_device, ring, true);
+            }
+
+            TextureUploadBatch& batch = ring->m_Batches[(ring->m_FirstBatch + ring->m_InFlightCount) % DM_MAX_TEXTURE_UPLOAD_BATCHES];
+
+            VkCommandBufferBeginInfo vk_command_buffer_begin_info;
+            memset(&vk_command_buffer_begin_info, 0, sizeof(VkCommandBufferBeginInfo));
+            vk_command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            vk_command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+            VkResult res = vkBeginCommandBuffer(batch.m_CommandBuffer, &vk_command_buffer_begin_info);
+            CHECK_VK_ERROR(res);
+
+            ring->m_Recording = 1;
+        }
+
+        return ring->m_Batches[(ring->m_FirstBatch + ring->m_InFlightCount) % DM_MAX_TEXTURE_UPLOAD_BATCHES].m_CommandBuffer;
+    }
+
+    // Allocates size bytes from the staging ring. Returns false if the request can never fit in the ring.
+    static bool AllocateTextureUploadData(VulkanContext* context, uint32_t size, uint32_t alignment, uint32_t* offset_out)
+    {
+        VkDevice vk_device      = context->m_LogicalDevice.m_Device;
+        TextureUploadRing* ring = &context->m_TextureUploadRing;
+
+        if (size > DM_TEXTURE_UPLOAD_RING_SIZE)
+        {
+            return false;
+        }
+
+        RetireTextureUploads(vk_device, ring, false);
+
+        while (true)
+        {
+            uint32_t offset = ((ring->m_Head + alignment - 1) / alignment) * alignment;
+            uint32_t bytes  = offset - ring->m_Head + size;
+
+            if (offset + size > DM_TEXTURE_UPLOAD_RING_SIZE)
+            {
+                // Skip the tail end of the ring and wrap around
+                offset = 0;
+                bytes  = DM_TEXTURE_UPLOAD_RING_SIZE - ring->m_Head + size;
+            }
+
+            if (ring->m_Used + bytes <= DM_TEXTURE_UPLOAD_RING_SIZE)
+            {
+                GetTextureUploadCommandBuffer(context);
+                ring->m_Batches[(ring->m_FirstBatch + ring->m_InFlightCount) % DM_MAX_TEXTURE_UPLOAD_BATCHES].m_RingBytes += bytes;
+                ring->m_Used += bytes;
+                ring->m_Head  = offset + size;
+                *offset_out   = offset;
+                return true;
+            }
+
+            // The ring is full, submit what we have and wait for the oldest batch to finish
+            FlushTextureUploads(context);
+            RetireTextureUploads(vk_device, ring, true);
+        }
+    }
+
+    static void DestroyTextureUploadRing(VkDevice vk_device, VkCommandPool vk_command_pool, TextureUploadRing* ring)
+    {
+        while (ring->m_InFlightCount > 0)
+        {
+            RetireTextureUploads(vk_device, ring, true);
+        }
+
+        for (uint8_t i = 0; i < DM_MAX_TEXTURE_UPLOAD_BATCHES; ++i)
+        {
+            vkFreeCommandBuffers(vk_device, vk_command_pool, 1, &ring->m_Batches[i].m_CommandBuffer);
+            vkDestroyFence(vk_device, ring->m_Batches[i].m_Fence, 0);
+        }
+
+        ring->m_StagingBuffer.UnmapMemory(vk_device);
+        DestroyDeviceBuffer(vk_device, &ring->m_StagingBuffer.m_Handle);
+    }
+
+    static VkResult CreateGpuTimerQueries(VkDevice vk_device, const PhysicalDevice* physical_device, uint16_t queue_family_ix, GpuTimerQueries* queries)
+    {
+        VkQueryPoolCreateInfo vk_create_info;
+        memset(&vk_create_info, 0, sizeof(vk_create_info));
+        vk_create_info.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        vk_create_info.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+        vk_create_info.queryCount = DM_MAX_FRAMES_IN_FLIGHT * MAX_GPU_TIMERS_PER_FRAME * 2;
+
+        uint32_t valid_bits        = physical_device->m_QueueFamilyProperties[queue_family_ix].timestampValidBits;
+        queries->m_TimestampMask   = valid_bits >= 64 ? ~0ULL : ((1ULL << valid_bits) - 1);
+        queries->m_TimestampPeriod = physical_device->m_Properties.limits.timestampPeriod;
+
+        return vkCreateQueryPool(vk_device, &vk_create_info, 0, &queries->m_QueryPool);
+    }
+
+    static void DestroyGpuTimerQueries(VkDevice vk_device, GpuTimerQueries* queries)
+    {
+        if (queries->m_QueryPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(vk_device, queries->m_QueryPool, 0);
+            queries->m_QueryPool = VK_NULL_HANDLE;
+        }
+    }
+
+    // Called when the submit fence of the frame has been waited on, so the results are available
+    static void ReadGpuTimerQueries(VkDevice vk_device, GpuTimerQueries* queries, uint32_t frame_in_flight)
+    {
+        uint32_t count = queries->m_Count[frame_in_flight];
+        if (count == 0)
+        {
+            return;
+        }
+
+        uint64_t timestamps[MAX_GPU_TIMERS_PER_FRAME * 2];
+        VkResult res = vkGetQueryPoolResults(vk_device, queries->m_QueryPool, frame_in_flight * MAX_GPU_TIMERS_PER_FRAME * 2, count * 2,
+            sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+        queries->m_Count[frame_in_flight] = 0;
+        queries->m_ResultCount            = 0;
+        if (res != VK_SUCCESS)
+        {
+            return;
+        }
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & queries->m_TimestampMask;
+            queries->m_ResultIds[i]   = queries->m_TimerIds[frame_in_flight][i];
+            queries->m_ResultTimes[i] = (uint64_t) ((double) ticks * queries->m_TimestampPeriod);
+        }
+        queries->m_ResultCount = count;
+    }
+
     static VkResult CreateMainScratchBuffers(VkPhysicalDevice vk_physical_device, VkDevice vk_device,
         uint8_t swap_chain_image_count, uint32_t scratch_buffer_size, uint16_t descriptor_count,
         DescriptorAllocator* descriptor_allocators_out, ScratchBuffer* scratch_buffers_out)
@@ -653,6 +893,23 @@ namespace dmGraphics
         res = CreateMainFrameSyncObjects(vk_device, DM_MAX_FRAMES_IN_FLIGHT, context->m_FrameResources);
         CHECK_VK_ERROR(res);
 
+        // Create the staging ring used for texture uploads
+        res = CreateTextureUploadRing(context->m_PhysicalDevice.m_Device, vk_device, context->m_LogicalDevice.m_CommandPool, &context->m_TextureUploadRing);
+        CHECK_VK_ERROR(res);
+
+        // Create the timestamp queries for the GPU timers, if the graphics queue supports them
+        if (context->m_PhysicalDevice.m_Properties.limits.timestampComputeAndGraphics)
+        {
+            res = CreateGpuTimerQueries(vk_device, &context->m_PhysicalDevice, context->m_LogicalDevice.m_QueueFamily.m_GraphicsQueueIx, &context->m_GpuTimerQueries);
+            context->m_TimestampSupport = res == VK_SUCCESS;
+        }
+
+        // All the physical device features are enabled on the logical device. Without multiDrawIndirect,
+        // the indirect draws are issued one at a time instead.
+        context->m_DrawIndirectSupport = context->m_PhysicalDevice.m_Features.drawIndirectFirstInstance;
+        context->m_MultiDrawSupport    = context->m_PhysicalDevice.m_Features.multiDrawIndirect &&
+                                         context->m_PhysicalDevice.m_Properties.limits.maxDrawIndirectCount > 1;
+
 
         // Create scratch buffer and descriptor allocators, one for each swap chain image
         //   Note: These constants are guessed and equals roughly 256 draw calls and 64kb
@@ -731,25 +988,51 @@ namespace dmGraphics
             return;
         }
 
-        // Flush all current commands
-        SynchronizeDevice(vk_device);
-
-        DestroyMainFrameBuffers(context);
-
-        // Destroy main Depth/Stencil buffer
         VulkanTexture* depth_stencil_texture = &context->m_MainTextureDepthStencil;
-        DestroyDeviceBuffer(vk_device, &depth_stencil_texture->m_DeviceBuffer.m_Handle);
-        DestroyTexture(vk_device, &depth_stencil_texture->m_Handle);
-
-        DestroySwapChain(vk_device, context->m_SwapChain);
+        ResourcesToDestroyList* resources_to_destroy = 0;
 
-        // At this point, we've destroyed the framebuffers, depth/stencil textures, and the swapchain
-        // and the platform may do extra setup
         if (cb)
         {
+            // The platform may recreate the surface, so nothing can refer to the old swap chain
+            SynchronizeDevice(vk_device);
+
+            DestroyMainFrameBuffers(context);
+            DestroyDeviceBuffer(vk_device, &depth_stencil_texture->m_DeviceBuffer.m_Handle);
+            DestroyTexture(vk_device, &depth_stencil_texture->m_Handle);
+            DestroySwapChain(vk_device, context->m_SwapChain);
+
             VkResult res = cb(cb_ctx);
             CHECK_VK_ERROR(res);
         }
+        else
+        {
+            // The frames in flight may still use the old resources. The submit fence of the previous frame
+            // is the last one to be signaled, so the resources are destroyed when it has been waited on.
+            uint8_t frame_ix = (context->m_CurrentFrameInFlight + context->m_NumFramesInFlight - 1) % context->m_NumFramesInFlight;
+            resources_to_destroy = &context->m_FrameResources[frame_ix].m_ResourcesToDestroy;
+
+            ResourceToDestroy resource;
+            resource.m_ResourceType = RESOURCE_TYPE_RENDER_TARGET;
+            resource.m_RenderTarget.m_RenderPass = VK_NULL_HANDLE; // The main render pass is kept
+            for (uint32_t i = 0; i < context->m_MainFrameBuffers.Size(); ++i)
+            {
+                resource.m_RenderTarget.m_Framebuffer = context->m_MainFrameBuffers[i];
+                PushResourceToDestroy(resources_to_destroy, resource);
+            }
+            context->m_MainFrameBuffers.SetCapacity(0);
+            context->m_MainFrameBuffers.SetSize(0);
+
+            resource.m_ResourceType = RESOURCE_TYPE_TEXTURE;
+            resource.m_Texture      = depth_stencil_texture->m_Handle;
+            PushResourceToDestroy(resources_to_destroy, resource);
+
+            resource.m_ResourceType = RESOURCE_TYPE_DEVICE_BUFFER;
+            resource.m_DeviceBuffer = depth_stencil_texture->m_DeviceBuffer.m_Handle;
+            PushResourceToDestroy(resources_to_destroy, resource);
+
+            memset(&depth_stencil_texture->m_Handle, 0, sizeof(depth_stencil_texture->m_Handle));
+            memset(&depth_stencil_texture->m_DeviceBuffer.m_Handle, 0, sizeof(depth_stencil_texture->m_DeviceBuffer.m_Handle));
+        }
 
         // Update swap chain capabilities
         SwapChainCapabilities swap_chain_capabilities;
@@ -758,8 +1041,8 @@ namespace dmGraphics
 
         const bool want_vsync = context->m_SwapInterval != 0;
 
-        // Create the swap chain
-        VkResult res = UpdateSwapChain(&context->m_PhysicalDevice, &context->m_LogicalDevice, width, height, want_vsync, context->m_SwapChainCapabilities, context->m_SwapChain);
+        // Create the swap chain, with the old one (if any) handed over to the new one
+        VkResult res = UpdateSwapChain(&context->m_PhysicalDevice, &context->m_LogicalDevice, width, height, want_vsync, context->m_SwapChainCapabilities, context->m_SwapChain, resources_to_destroy);
         CHECK_VK_ERROR(res);
 
         // Create the main Depth/Stencil buffer
@@ -777,15 +1060,13 @@ namespace dmGraphics
 
         context->m_WindowWidth  = context->m_SwapChain->m_ImageExtent.width;
         context->m_WindowHeight = context->m_SwapChain->m_ImageExtent.height;
+        context->m_SwapChainOutOfDate = 0;
 
         res = CreateMainFrameBuffers(context);
         CHECK_VK_ERROR(res);
 
         res = SetupMainRenderTarget(context);
         CHECK_VK_ERROR(res);
-
-        // Flush once again to make sure all transitions are complete
-        SynchronizeDevice(vk_device);
     }
 
     void FlushResourcesToDestroy(VkDevice vk_device, ResourcesToDestroyList* resource_list)
@@ -810,6 +1091,9 @@ namespace dmGraphics
                     case RESOURCE_TYPE_RENDER_TARGET:
                         DestroyRenderTarget(vk_device, &resource.m_RenderTarget);
                         break;
+                    case RESOURCE_TYPE_SWAP_CHAIN:
+                        vkDestroySwapchainKHR(vk_device, resource.m_SwapChain, 0);
+                        break;
                     default:
                         assert(0);
                         break;
@@ -940,6 +1224,86 @@ namespace dmGraphics
         }
     }
 
+    // The driver validates the cache data as well, but some drivers are known to crash on data from other devices or driver versions
+    static bool IsPipelineCacheDataValid(const VkPhysicalDeviceProperties& properties, const uint8_t* data, uint32_t data_size)
+    {
+        VkPipelineCacheHeaderVersionOne header;
+        if (data_size < sizeof(header))
+        {
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+        return header.headerSize >= sizeof(header) &&
+               header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+               header.vendorID == properties.vendorID &&
+               header.deviceID == properties.deviceID &&
+               memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    static VkResult CreateDriverPipelineCache(VulkanContext* context)
+    {
+        uint8_t* data      = 0;
+        uint32_t data_size = 0;
+
+        if (context->m_PipelineCachePath && dmSys::ResourceSize(context->m_PipelineCachePath, &data_size) == dmSys::RESULT_OK && data_size > 0)
+        {
+            data = (uint8_t*) malloc(data_size);
+            if (dmSys::LoadResource(context->m_PipelineCachePath, data, data_size, &data_size) != dmSys::RESULT_OK ||
+                !IsPipelineCacheDataValid(context->m_PhysicalDevice.m_Properties, data, data_size))
+            {
+                dmLogInfo("Discarding the pipeline cache '%s', it was created for another device or driver.", context->m_PipelineCachePath);
+                free(data);
+                data      = 0;
+                data_size = 0;
+            }
+        }
+
+        VkPipelineCacheCreateInfo vk_pipeline_cache_create_info = {};
+        vk_pipeline_cache_create_info.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        vk_pipeline_cache_create_info.initialDataSize = data_size;
+        vk_pipeline_cache_create_info.pInitialData    = data;
+
+        VkResult res = vkCreatePipelineCache(context->m_LogicalDevice.m_Device, &vk_pipeline_cache_create_info, 0, &context->m_DriverPipelineCache);
+        free(data);
+        return res;
+    }
+
+    static void SaveDriverPipelineCache(VulkanContext* context)
+    {
+        if (!context->m_PipelineCachePath || context->m_DriverPipelineCache == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        VkDevice vk_device = context->m_LogicalDevice.m_Device;
+        size_t data_size   = 0;
+        if (vkGetPipelineCacheData(vk_device, context->m_DriverPipelineCache, &data_size, 0) != VK_SUCCESS || data_size == 0)
+        {
+            return;
+        }
+
+        void* data   = malloc(data_size);
+        VkResult res = vkGetPipelineCacheData(vk_device, context->m_DriverPipelineCache, &data_size, data);
+
+        // Write to a temporary file first, so that we never leave a partially written cache behind
+        char tmp_path[1024];
+        dmSnPrintf(tmp_path, sizeof(tmp_path), "%s.tmp", context->m_PipelineCachePath);
+
+        FILE* file = res == VK_SUCCESS ? fopen(tmp_path, "wb") : 0;
+        if (file)
+        {
+            bool written = fwrite(data, 1, data_size, file) == data_size;
+            fclose(file);
+
+            if (!written || dmSys::Rename(context->m_PipelineCachePath, tmp_path) != dmSys::RESULT_OK)
+            {
+                dmLogWarning("Unable to write the pipeline cache to '%s'", context->m_PipelineCachePath);
+                dmSys::Unlink(tmp_path);
+            }
+        }
+        free(data);
+    }
+
     bool InitializeVulkan(HContext _context)
     {
         VulkanContext* context = (VulkanContext*) _context;
@@ -1119,6 +1483,14 @@ namespace dmGraphics
         context->m_PipelineCache.SetCapacity(32,64);
         context->m_TextureSamplers.SetCapacity(4);
 
+        res = CreateDriverPipelineCache(context);
+        if (res != VK_SUCCESS)
+        {
+            // Not fatal, the pipelines are created without a cache
+            dmLogWarning("Could not create a pipeline cache for Vulkan, reason: %s", VkResultToStr(res));
+            context->m_DriverPipelineCache = VK_NULL_HANDLE;
+        }
+
         // Create framebuffers, default renderpass etc.
         res = CreateMainRenderingResources(context);
         if (res != VK_SUCCESS)
@@ -1238,6 +1610,7 @@ bail:
                 context->m_Instance = VK_NULL_HANDLE;
             }
 
+            free(context->m_PipelineCachePath);
             delete context;
             g_VulkanContext = 0x0;
         }
@@ -1260,6 +1633,14 @@ bail:
         VulkanContext* context = (VulkanContext*) _context;
         NativeBeginFrame(context);
 
+        // The swap chain is recreated before anything is recorded, so that the resize is handled in a single frame
+        if (context->m_SwapChainOutOfDate)
+        {
+            context->m_WindowWidth  = dmPlatform::GetWindowWidth(context->m_Window);
+            context->m_WindowHeight = dmPlatform::GetWindowHeight(context->m_Window);
+            SwapChainChanged(context, &context->m_WindowWidth, &context->m_WindowHeight, 0, 0);
+        }
+
         FrameResource& current_frame_resource = context->m_FrameResources[context->m_CurrentFrameInFlight];
 
         VkDevice vk_device = context->m_LogicalDevice.m_Device;
@@ -1267,6 +1648,25 @@ bail:
         vkWaitForFences(vk_device, 1, &current_frame_resource.m_SubmitFence, VK_TRUE, UINT64_MAX);
         vkResetFences(vk_device, 1, &current_frame_resource.m_SubmitFence);
 
+        if (current_frame_resource.m_ResourcesToDestroy.Size() > 0)
+        {
+            FlushResourcesToDestroy(vk_device, &current_frame_resource.m_ResourcesToDestroy);
+        }
+
+        if (context->m_TimestampSupport)
+        {
+            ReadGpuTimerQueries(vk_device, &context->m_GpuTimerQueries, context->m_CurrentFrameInFlight);
+        }
+
+        for (uint32_t i = 0; i < MAX_PIXEL_READBACKS; ++i)
+        {
+            PixelReadback& readback = context->m_PixelReadbacks[i];
+            if (readback.m_Pending && readback.m_FrameInFlight == context->m_CurrentFrameInFlight)
+            {
+                readback.m_Done = 1;
+            }
+        }
+
         VkResult res      = context->m_SwapChain->Advance(vk_device, current_frame_resource.m_ImageAvailable);
         uint32_t frame_ix = context->m_SwapChain->m_ImageIndex;
 
@@ -1297,10 +1697,16 @@ bail:
             FlushResourcesToDestroy(vk_device, context->m_MainResourcesToDestroy[frame_ix]);
         }
 
-        // Reset the scratch buffer for this swapchain image, so we can reuse its descriptors
-        // for the uniform resource bindings.
+        // Reset the scratch buffer for this swapchain image, so we can reuse it for the uniform data.
+        // The descriptor sets are kept between frames, and are only released when a resource they may refer to
+        // has been destroyed, or when the pools have grown too large.
         ScratchBuffer* scratchBuffer = &context->m_MainScratchBuffers[frame_ix];
-        ResetScratchBuffer(context->m_LogicalDevice.m_Device, scratchBuffer);
+        DescriptorAllocator* descriptor_allocator = scratchBuffer->m_DescriptorAllocator;
+        bool reset_descriptors = descriptor_allocator->m_CacheVersion != context->m_DescriptorCacheVersion ||
+                                 descriptor_allocator->m_DescriptorPoolIndex >= DM_MAX_CACHED_DESCRIPTOR_POOLS;
+        ResetScratchBuffer(context->m_LogicalDevice.m_Device, scratchBuffer, reset_descriptors);
+        descriptor_allocator->m_CacheVersion = context->m_DescriptorCacheVersion;
+        scratchBuffer->m_Version = ++context->m_ScratchBufferVersion;
 
         // TODO: Investigate if we don't have to map the memory every frame
         res = scratchBuffer->m_DeviceBuffer.MapMemory(vk_device);
@@ -1315,11 +1721,19 @@ bail:
 
         vkBeginCommandBuffer(context->m_MainCommandBuffers[frame_ix], &vk_command_buffer_begin_info);
 
+        // The queries must be reset outside of a render pass
+        if (context->m_TimestampSupport)
+        {
+            vkCmdResetQueryPool(context->m_MainCommandBuffers[frame_ix], context->m_GpuTimerQueries.m_QueryPool,
+                context->m_CurrentFrameInFlight * MAX_GPU_TIMERS_PER_FRAME * 2, MAX_GPU_TIMERS_PER_FRAME * 2);
+        }
+
         RenderTarget* rt           = GetAssetFromContainer<RenderTarget>(context->m_AssetHandleContainer, context->m_MainRenderTarget);
         rt->m_Handle.m_Framebuffer = context->m_MainFrameBuffers[frame_ix];
 
-        context->m_FrameBegun      = 1;
-        context->m_CurrentPipeline = 0;
+        context->m_FrameBegun             = 1;
+        context->m_CurrentPipeline        = 0;
+        ResetCommandBufferBindings(&context->m_MainBindings);
 
         VulkanTexture* tex_sc = GetAssetFromContainer<VulkanTexture>(context->m_AssetHandleContainer, context->m_CurrentSwapchainTexture);
         assert(tex_sc);
@@ -1344,11 +1758,17 @@ bail:
         uint32_t frame_ix = context->m_SwapChain->m_ImageIndex;
         FrameResource& current_frame_resource = context->m_FrameResources[context->m_CurrentFrameInFlight];
 
+        // A timer that is still running at the end of the frame is dropped
+        context->m_GpuTimerQueries.m_Active = 0;
+
         EndRenderPass(context);
 
         VkResult res = vkEndCommandBuffer(context->m_MainCommandBuffers[frame_ix]);
         CHECK_VK_ERROR(res);
 
+        // Texture copies recorded this frame must execute before the frame samples them
+        FlushTextureUploads(context);
+
         VkPipelineStageFlags vk_pipeline_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
         VkSubmitInfo vk_submit_info;
@@ -1380,7 +1800,11 @@ bail:
         // but that causes the presentation function to return a suboptimal result, which we don't care about right now.
         // A more "proper" way of doing this would be to actually use the preTransform values, but I don't know how it works.
         res = vkQueuePresentKHR(context->m_LogicalDevice.m_PresentQueue, &vk_present_info);
-        if (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR)
+        if (res == VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            context->m_SwapChainOutOfDate = 1;
+        }
+        else if (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR)
         {
             CHECK_VK_ERROR(res);
         }
@@ -1525,13 +1949,19 @@ bail:
             case RESOURCE_TYPE_TEXTURE:
                 resource_to_destroy.m_Texture = ((VulkanTexture*) resource)->m_Handle;
                 DestroyResourceDeferred(resource_list, &((VulkanTexture*) resource)->m_DeviceBuffer);
+                g_VulkanContext->m_DescriptorCacheVersion++;
                 break;
             case RESOURCE_TYPE_DEVICE_BUFFER:
                 resource_to_destroy.m_DeviceBuffer = ((DeviceBuffer*) resource)->m_Handle;
                 ((DeviceBuffer*) resource)->UnmapMemory(g_VulkanContext->m_LogicalDevice.m_Device);
+                if (((DeviceBuffer*) resource)->m_Usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT))
+                {
+                    g_VulkanContext->m_DescriptorCacheVersion++;
+                }
                 break;
             case RESOURCE_TYPE_PROGRAM:
                 resource_to_destroy.m_Program = ((Program*) resource)->m_Handle;
+                g_VulkanContext->m_DescriptorCacheVersion++;
                 break;
             case RESOURCE_TYPE_RENDER_TARGET:
                 resource_to_destroy.m_RenderTarget = ((RenderTarget*) resource)->m_Handle;
@@ -1550,7 +1980,7 @@ bail:
         resource->m_Destroyed = 1;
     }
 
-    static Pipeline* GetOrCreateComputePipeline(VkDevice vk_device, PipelineCache& pipelineCache, Program* program)
+    static Pipeline* GetOrCreateComputePipeline(VkDevice vk_device, VkPipelineCache vk_pipeline_cache, PipelineCache& pipelineCache, Program* program)
     {
         HashState64 pipeline_hash_state;
         dmHashInit64(&pipeline_hash_state, false);
@@ -1563,7 +1993,7 @@ bail:
         {
             Pipeline new_pipeline = {};
 
-            VkResult res = CreateComputePipeline(vk_device, program, &new_pipeline);
+            VkResult res = CreateComputePipeline(vk_device, vk_pipeline_cache, program, &new_pipeline);
             CHECK_VK_ERROR(res);
 
             if (pipelineCache.Full())
@@ -1580,7 +2010,7 @@ bail:
         return cached_pipeline;
     }
 
-    static Pipeline* GetOrCreatePipeline(VkDevice vk_device, VkSampleCountFlagBits vk_sample_count,
+    static Pipeline* GetOrCreatePipeline(VkDevice vk_device, VkPipelineCache vk_pipeline_cache, VkSampleCountFlagBits vk_sample_count,
         const PipelineState pipelineState, PipelineCache& pipelineCache,
         Program* program, RenderTarget* rt, VertexDeclaration** vertexDeclaration, uint32_t vertexDeclarationCount)
     {
@@ -1611,7 +2041,7 @@ bail:
             vk_scissor.offset.x = 0;
             vk_scissor.offset.y = 0;
 
-            VkResult res = CreateGraphicsPipeline(vk_device, vk_scissor, vk_sample_count, pipelineState, program, vertexDeclaration, vertexDeclarationCount, rt, &new_pipeline);
+            VkResult res = CreateGraphicsPipeline(vk_device, vk_pipeline_cache, vk_scissor, vk_sample_count, pipelineState, program, vertexDeclaration, vertexDeclarationCount, rt, &new_pipeline);
             CHECK_VK_ERROR(res);
 
             if (pipelineCache.Full())
@@ -1649,7 +2079,9 @@ bail:
 
     static HVertexBuffer VulkanNewVertexBuffer(HContext context, uint32_t size, const void* data, BufferUsage buffer_usage)
     {
-        VkBufferUsageFlags usage_flags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        // Vertex buffers can also hold the commands for DrawElementsIndirect and DispatchComputeIndirect,
+        // and be written by compute programs as storage buffers
+        VkBufferUsageFlags usage_flags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
         if (buffer_usage & BUFFER_USAGE_TRANSFER)
         {
             usage_flags |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
@@ -2018,6 +2450,7 @@ bail:
         // otherwise its memory might be getting wrriten to while we are reading from it.
         if (texture->m_ImageLayout[0] != VK_IMAGE_LAYOUT_GENERAL && image_layout != texture->m_ImageLayout[0])
         {
+            FlushTextureUploads(context);
             VkResult res = TransitionImageLayout(context->m_LogicalDevice.m_Device,
                 context->m_LogicalDevice.m_CommandPool,
                 context->m_LogicalDevice.m_GraphicsQueue,
@@ -2049,17 +2482,25 @@ bail:
         vk_write_desc_info.pBufferInfo    = &vk_buffer_info;
     }
 
-    static void UpdateDescriptorSets(VulkanContext* context, VkDevice vk_device, VkDescriptorSet* vk_descriptor_sets, Program* program, ScratchBuffer* scratch_buffer, uint32_t* dynamic_offsets, uint32_t dynamic_alignment)
+    // Writes the uniform data to the scratch buffer and makes sure the program has descriptor sets for the currently bound resources.
+    // The uniform blocks are addressed by the dynamic offsets, so descriptor sets that were written for the same set layouts,
+    // textures, storage buffers and scratch buffer are reused from the descriptor set cache of the scratch buffer.
+    static VkResult UpdateDescriptorSets(VulkanContext* context, VkDevice vk_device, Program* program, ScratchBuffer* scratch_buffer, uint32_t* dynamic_offsets, uint32_t dynamic_alignment)
     {
         const uint32_t max_write_descriptors = MAX_SET_COUNT * MAX_BINDINGS_PER_SET_COUNT;
         VkWriteDescriptorSet vk_write_descriptors[max_write_descriptors];
         VkDescriptorImageInfo vk_write_image_descriptors[max_write_descriptors];
         VkDescriptorBufferInfo vk_write_buffer_descriptors[max_write_descriptors];
+        uint8_t write_descriptor_sets[max_write_descriptors];
 
         uint16_t uniform_to_write_index = 0;
         uint16_t image_to_write_index   = 0;
         uint16_t buffer_to_write_index  = 0;
 
+        HashState64 resources_hash_state;
+        dmHashInit64(&resources_hash_state, false);
+        dmHashUpdateBuffer64(&resources_hash_state, program->m_Handle.m_DescriptorSetLayouts, sizeof(VkDescriptorSetLayout) * program->m_Handle.m_DescriptorSetLayoutsCount);
+
         for (int set = 0; set < program->m_MaxSet; ++set)
         {
             for (int binding = 0; binding < program->m_MaxBinding; ++binding)
@@ -2069,10 +2510,12 @@ bail:
                 if (pgm_res.m_Res == 0x0)
                     continue;
 
+                write_descriptor_sets[uniform_to_write_index] = set;
+
                 VkWriteDescriptorSet& vk_write_desc_info = vk_write_descriptors[uniform_to_write_index++];
                 vk_write_desc_info.sType                 = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
                 vk_write_desc_info.pNext                 = 0;
-                vk_write_desc_info.dstSet                = vk_descriptor_sets[set];
+                vk_write_desc_info.dstSet                = VK_NULL_HANDLE;
                 vk_write_desc_info.dstBinding            = binding;
                 vk_write_desc_info.dstArrayElement       = 0;
                 vk_write_desc_info.descriptorCount       = 1;
@@ -2083,46 +2526,64 @@ bail:
                 switch(pgm_res.m_Res->m_BindingFamily)
                 {
                     case ShaderResourceBinding::BINDING_FAMILY_TEXTURE:
+                    {
+                        VkDescriptorImageInfo& vk_image_info = vk_write_image_descriptors[image_to_write_index++];
                         UpdateImageDescriptor(context,
                             context->m_TextureUnits[pgm_res.m_TextureUnit],
                             pgm_res.m_Res,
-                            vk_write_image_descriptors[image_to_write_index++],
+                            vk_image_info,
                             vk_write_desc_info);
-                        break;
+                        // Hash the members separately, the struct has padding
+                        dmHashUpdateBuffer64(&resources_hash_state, &vk_image_info.sampler, sizeof(vk_image_info.sampler));
+                        dmHashUpdateBuffer64(&resources_hash_state, &vk_image_info.imageView, sizeof(vk_image_info.imageView));
+                        dmHashUpdateBuffer64(&resources_hash_state, &vk_image_info.imageLayout, sizeof(vk_image_info.imageLayout));
+                    } break;
                     case ShaderResourceBinding::BINDING_FAMILY_STORAGE_BUFFER:
                     {
                         const StorageBufferBinding binding = context->m_CurrentStorageBuffers[pgm_res.m_StorageBufferUnit];
+                        VkDescriptorBufferInfo& vk_buffer_info = vk_write_buffer_descriptors[buffer_to_write_index++];
                         UpdateUniformBufferDescriptor(context,
                             ((DeviceBuffer*) binding.m_Buffer)->m_Handle.m_Buffer,
                             VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-                            vk_write_buffer_descriptors[buffer_to_write_index++],
+                            vk_buffer_info,
                             vk_write_desc_info,
                             binding.m_BufferOffset,
                             VK_WHOLE_SIZE);
+                        dmHashUpdateBuffer64(&resources_hash_state, &vk_buffer_info.buffer, sizeof(vk_buffer_info.buffer));
+                        dmHashUpdateBuffer64(&resources_hash_state, &vk_buffer_info.offset, sizeof(vk_buffer_info.offset));
                     } break;
                     case ShaderResourceBinding::BINDING_FAMILY_UNIFORM_BUFFER:
                     {
-                        dynamic_offsets[pgm_res.m_DynamicOffsetIndex] = (uint32_t) scratch_buffer->m_MappedDataCursor;
                         const uint32_t uniform_size_nonalign          = pgm_res.m_Res->m_BindingInfo.m_BlockSize;
                         const uint32_t uniform_size_align             = DM_ALIGN(uniform_size_nonalign, dynamic_alignment);
 
                         assert(uniform_size_nonalign > 0);
 
-                        // Copy client data to aligned host memory
-                        // The data_offset here is the offset into the programs uniform data,
-                        // i.e the source buffer.
-                        memcpy(&((uint8_t*)scratch_buffer->m_DeviceBuffer.m_MappedDataPtr)[scratch_buffer->m_MappedDataCursor],
-                            &program->m_UniformData[pgm_res.m_DataOffset], uniform_size_nonalign);
+                        // The block is only copied if it has changed since it was last copied to this scratch buffer
+                        if (pgm_res.m_UploadVersion == 0 || pgm_res.m_UploadVersion != scratch_buffer->m_Version)
+                        {
+                            // Copy client data to aligned host memory
+                            // The data_offset here is the offset into the programs uniform data,
+                            // i.e the source buffer.
+                            memcpy(&((uint8_t*)scratch_buffer->m_DeviceBuffer.m_MappedDataPtr)[scratch_buffer->m_MappedDataCursor],
+                                &program->m_UniformData[pgm_res.m_DataOffset], uniform_size_nonalign);
+
+                            pgm_res.m_UploadVersion = scratch_buffer->m_Version;
+                            pgm_res.m_UploadOffset  = scratch_buffer->m_MappedDataCursor;
+                            scratch_buffer->m_MappedDataCursor += uniform_size_align;
+                        }
+                        dynamic_offsets[pgm_res.m_DynamicOffsetIndex] = pgm_res.m_UploadOffset;
 
+                        VkDescriptorBufferInfo& vk_buffer_info = vk_write_buffer_descriptors[buffer_to_write_index++];
                         UpdateUniformBufferDescriptor(context,
                             scratch_buffer->m_DeviceBuffer.m_Handle.m_Buffer,
                             VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
-                            vk_write_buffer_descriptors[buffer_to_write_index++],
+                            vk_buffer_info,
                             vk_write_desc_info,
                             0,
                             uniform_size_align);
-
-                        scratch_buffer->m_MappedDataCursor += uniform_size_align;
+                        dmHashUpdateBuffer64(&resources_hash_state, &vk_buffer_info.buffer, sizeof(vk_buffer_info.buffer));
+                        dmHashUpdateBuffer64(&resources_hash_state, &vk_buffer_info.range, sizeof(vk_buffer_info.range));
                     } break;
                     case ShaderResourceBinding::BINDING_FAMILY_GENERIC:
                     default: continue;
@@ -2130,7 +2591,38 @@ bail:
             }
         }
 
+        uint64_t resources_hash = dmHashFinal64(&resources_hash_state);
+
+        DescriptorAllocator* descriptor_allocator = scratch_buffer->m_DescriptorAllocator;
+        uint32_t* cached_set_index = descriptor_allocator->m_CachedSets.Get(resources_hash);
+        if (cached_set_index)
+        {
+            memcpy(program->m_DescriptorSets, &descriptor_allocator->m_DescriptorSets[*cached_set_index], sizeof(VkDescriptorSet) * program->m_Handle.m_DescriptorSetLayoutsCount);
+            return VK_SUCCESS;
+        }
+
+        VkDescriptorSet* vk_descriptor_set_list = 0x0;
+        VkResult res = descriptor_allocator->Allocate(vk_device, program->m_Handle.m_DescriptorSetLayouts, program->m_Handle.m_DescriptorSetLayoutsCount, program->m_TotalResourcesCount, &vk_descriptor_set_list);
+        if (res != VK_SUCCESS)
+        {
+            return res;
+        }
+
+        for (int i = 0; i < uniform_to_write_index; ++i)
+        {
+            vk_write_descriptors[i].dstSet = vk_descriptor_set_list[write_descriptor_sets[i]];
+        }
+
         vkUpdateDescriptorSets(vk_device, uniform_to_write_index, vk_write_descriptors, 0, 0);
+
+        if (descriptor_allocator->m_CachedSets.Full())
+        {
+            descriptor_allocator->m_CachedSets.SetCapacity(256, descriptor_allocator->m_CachedSets.Capacity() + 64);
+        }
+        descriptor_allocator->m_CachedSets.Put(resources_hash, (uint32_t) (vk_descriptor_set_list - descriptor_allocator->m_DescriptorSets));
+
+        memcpy(program->m_DescriptorSets, vk_descriptor_set_list, sizeof(VkDescriptorSet) * program->m_Handle.m_DescriptorSetLayoutsCount);
+        return VK_SUCCESS;
     }
 
     static VkResult CommitUniforms(VulkanContext* context, VkCommandBuffer vk_command_buffer, VkDevice vk_device,
@@ -2145,21 +2637,28 @@ bail:
             return VK_SUCCESS;
         }
 
-        VkDescriptorSet* vk_descriptor_set_list = 0x0;
-        VkResult res = scratch_buffer->m_DescriptorAllocator->Allocate(vk_device, program_ptr->m_Handle.m_DescriptorSetLayouts, program_ptr->m_Handle.m_DescriptorSetLayoutsCount, num_descriptors, &vk_descriptor_set_list);
+        VkResult res = UpdateDescriptorSets(context, vk_device, program_ptr, scratch_buffer, dynamic_offsets, alignment);
         if (res != VK_SUCCESS)
         {
             return res;
         }
 
-        UpdateDescriptorSets(context, vk_device, vk_descriptor_set_list, program_ptr, scratch_buffer, dynamic_offsets, alignment);
+        const uint32_t num_sets = program_ptr->m_Handle.m_DescriptorSetLayoutsCount;
+
+        // Draw calls from the same batch, or with the same resources and unchanged uniform data, end up with the same
+        // descriptor sets and offsets. Only the graphics bindings of the main command buffer are tracked.
+        if (bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS &&
+            !UpdateBoundDescriptorSets(&context->m_MainBindings, program_ptr->m_Handle.m_PipelineLayout, program_ptr->m_DescriptorSets, num_sets, dynamic_offsets, num_dynamic_offsets))
+        {
+            return VK_SUCCESS;
+        }
 
         vkCmdBindDescriptorSets(vk_command_buffer,
             bind_point,
             program_ptr->m_Handle.m_PipelineLayout,
             0,
-            program_ptr->m_Handle.m_DescriptorSetLayoutsCount,
-            vk_descriptor_set_list,
+            num_sets,
+            program_ptr->m_DescriptorSets,
             num_dynamic_offsets,
             dynamic_offsets);
 
@@ -2174,6 +2673,7 @@ bail:
         VkResult res = CreateScratchBuffer(context->m_PhysicalDevice.m_Device, context->m_LogicalDevice.m_Device,
             newDataSize, false, scratchBuffer->m_DescriptorAllocator, scratchBuffer);
         scratchBuffer->m_DeviceBuffer.MapMemory(context->m_LogicalDevice.m_Device);
+        scratchBuffer->m_Version = ++context->m_ScratchBufferVersion;
 
         return res;
     }
@@ -2224,7 +2724,7 @@ bail:
         VkResult res               = CommitUniforms(context, vk_command_buffer, vk_device, program_ptr, VK_PIPELINE_BIND_POINT_COMPUTE, scratchBuffer, context->m_DynamicOffsetBuffer, dynamic_alignment);
         CHECK_VK_ERROR(res);
 
-        Pipeline* pipeline = GetOrCreateComputePipeline(vk_device, context->m_PipelineCache, program_ptr);
+        Pipeline* pipeline = GetOrCreateComputePipeline(vk_device, context->m_DriverPipelineCache, context->m_PipelineCache, program_ptr);
         vkCmdBindPipeline(vk_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, *pipeline);
     }
 
@@ -2308,7 +2808,7 @@ bail:
             vk_sample_count = context->m_SwapChain->m_SampleCountFlag;
         }
 
-        Pipeline* pipeline = GetOrCreatePipeline(vk_device, vk_sample_count,
+        Pipeline* pipeline = GetOrCreatePipeline(vk_device, context->m_DriverPipelineCache, vk_sample_count,
             pipeline_state_draw, context->m_PipelineCache,
             program_ptr, current_rt, vx_declarations, num_vx_buffers);
 
@@ -2329,10 +2829,17 @@ bail:
                 vk_index_type = VK_INDEX_TYPE_UINT32;
             }
 
-            vkCmdBindIndexBuffer(vk_command_buffer, indexBuffer->m_Handle.m_Buffer, 0, vk_index_type);
+            if (UpdateBoundIndexBuffer(&context->m_MainBindings, indexBuffer->m_Handle.m_Buffer, vk_index_type))
+            {
+                vkCmdBindIndexBuffer(vk_command_buffer, indexBuffer->m_Handle.m_Buffer, 0, vk_index_type);
+            }
         }
 
-        vkCmdBindVertexBuffers(vk_command_buffer, 0, num_vx_buffers, vk_buffers, vk_buffer_offsets);
+        // Consecutive draw calls from the same batch usually use the same buffers
+        if (UpdateBoundVertexBuffers(&context->m_MainBindings, vk_buffers, vk_buffer_offsets, num_vx_buffers))
+        {
+            vkCmdBindVertexBuffers(vk_command_buffer, 0, num_vx_buffers, vk_buffers, vk_buffer_offsets);
+        }
     }
 
     static void VulkanDrawElements(HContext _context, PrimitiveType prim_type, uint32_t first, uint32_t count, Type type, HIndexBuffer index_buffer, uint32_t instance_count)
@@ -2367,6 +2874,112 @@ bail:
         vkCmdDraw(vk_command_buffer, count, dmMath::Max((uint32_t) 1, instance_count), first, 0);
     }
 
+    static bool VulkanIsMultiDrawIndirectSupported(HContext _context)
+    {
+        return ((VulkanContext*) _context)->m_DrawIndirectSupport;
+    }
+
+    static void VulkanDrawElementsIndirect(HContext _context, PrimitiveType prim_type, Type type, HIndexBuffer index_buffer, HVertexBuffer indirect_buffer, uint32_t indirect_offset, uint32_t draw_count)
+    {
+        VulkanContext* context = (VulkanContext*) _context;
+        if (!context->m_DrawIndirectSupport || draw_count == 0)
+        {
+            return;
+        }
+
+        DM_PROFILE(__FUNCTION__);
+        DM_PROPERTY_ADD_U32(rmtp_DrawCalls, 1);
+
+        assert(context->m_FrameBegun);
+        const uint8_t image_ix = context->m_SwapChain->m_ImageIndex;
+        VkCommandBuffer vk_command_buffer = context->m_MainCommandBuffers[image_ix];
+        context->m_PipelineState.m_PrimtiveType = prim_type;
+        DrawSetup(context, vk_command_buffer, &context->m_MainScratchBuffers[image_ix], (DeviceBuffer*) index_buffer, type);
+
+        VkBuffer vk_indirect_buffer = ((DeviceBuffer*) indirect_buffer)->m_Handle.m_Buffer;
+        const uint32_t stride = sizeof(DrawIndexedIndirectCommand);
+
+        if (context->m_MultiDrawSupport)
+        {
+            uint32_t max_draw_count = context->m_PhysicalDevice.m_Properties.limits.maxDrawIndirectCount;
+            for (uint32_t i = 0; i < draw_count; i += max_draw_count)
+            {
+                uint32_t count = dmMath::Min(max_draw_count, draw_count - i);
+                vkCmdDrawIndexedIndirect(vk_command_buffer, vk_indirect_buffer, indirect_offset + i * stride, count, stride);
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < draw_count; ++i)
+            {
+                vkCmdDrawIndexedIndirect(vk_command_buffer, vk_indirect_buffer, indirect_offset + i * stride, 1, stride);
+            }
+        }
+    }
+
+    static bool VulkanIsGpuTimerSupported(HContext _context)
+    {
+        return ((VulkanContext*) _context)->m_TimestampSupport;
+    }
+
+    static void VulkanBeginGpuTimer(HContext _context, uint32_t timer_id)
+    {
+        VulkanContext* context   = (VulkanContext*) _context;
+        GpuTimerQueries& queries = context->m_GpuTimerQueries;
+        uint32_t frame_in_flight = context->m_CurrentFrameInFlight;
+        uint32_t count           = queries.m_Count[frame_in_flight];
+
+        if (!context->m_TimestampSupport || !context->m_FrameBegun || queries.m_Active || count == MAX_GPU_TIMERS_PER_FRAME)
+        {
+            return;
+        }
+
+        queries.m_TimerIds[frame_in_flight][count] = timer_id;
+        vkCmdWriteTimestamp(context->m_MainCommandBuffers[context->m_SwapChain->m_ImageIndex], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            queries.m_QueryPool, (frame_in_flight * MAX_GPU_TIMERS_PER_FRAME + count) * 2);
+        queries.m_Active = 1;
+    }
+
+    static void VulkanEndGpuTimer(HContext _context)
+    {
+        VulkanContext* context   = (VulkanContext*) _context;
+        GpuTimerQueries& queries = context->m_GpuTimerQueries;
+        uint32_t frame_in_flight = context->m_CurrentFrameInFlight;
+
+        if (!queries.m_Active)
+        {
+            return;
+        }
+
+        vkCmdWriteTimestamp(context->m_MainCommandBuffers[context->m_SwapChain->m_ImageIndex], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            queries.m_QueryPool, (frame_in_flight * MAX_GPU_TIMERS_PER_FRAME + queries.m_Count[frame_in_flight]) * 2 + 1);
+        queries.m_Count[frame_in_flight]++;
+        queries.m_Active = 0;
+    }
+
+    static void VulkanResolveGpuTimers(HContext _context, GpuTimerResultCallback callback, void* user_data)
+    {
+        GpuTimerQueries& queries = ((VulkanContext*) _context)->m_GpuTimerQueries;
+        for (uint32_t i = 0; i < queries.m_ResultCount; ++i)
+        {
+            callback(user_data, queries.m_ResultIds[i], queries.m_ResultTimes[i]);
+        }
+        queries.m_ResultCount = 0;
+    }
+
+    // Makes the buffers written by a compute dispatch readable as commands by DrawElementsIndirect and DispatchComputeIndirect.
+    // The barrier can't be recorded within a render pass, which is why it follows every dispatch.
+    static void IndirectCommandBarrier(VkCommandBuffer vk_command_buffer)
+    {
+        VkMemoryBarrier vk_memory_barrier = {};
+        vk_memory_barrier.sType           = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        vk_memory_barrier.srcAccessMask   = VK_ACCESS_SHADER_WRITE_BIT;
+        vk_memory_barrier.dstAccessMask   = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+        vkCmdPipelineBarrier(vk_command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            0, 1, &vk_memory_barrier, 0, 0, 0, 0);
+    }
+
     static void VulkanDispatchCompute(HContext _context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
     {
         DM_PROFILE(__FUNCTION__);
@@ -2384,6 +2997,26 @@ bail:
         VkCommandBuffer vk_command_buffer = context->m_MainCommandBuffers[image_ix];
         DrawSetupCompute(context, vk_command_buffer, &context->m_MainScratchBuffers[image_ix]);
         vkCmdDispatch(vk_command_buffer, group_count_x, group_count_y, group_count_z);
+        IndirectCommandBarrier(vk_command_buffer);
+    }
+
+    static void VulkanDispatchComputeIndirect(HContext _context, HVertexBuffer indirect_buffer, uint32_t indirect_offset)
+    {
+        DM_PROFILE(__FUNCTION__);
+        DM_PROPERTY_ADD_U32(rmtp_DispatchCalls, 1);
+        VulkanContext* context = (VulkanContext*) _context;
+        assert(indirect_buffer);
+
+        if (IsRenderTargetbound(context, context->m_CurrentRenderTarget))
+        {
+            EndRenderPass(context);
+        }
+
+        const uint8_t image_ix = context->m_SwapChain->m_ImageIndex;
+        VkCommandBuffer vk_command_buffer = context->m_MainCommandBuffers[image_ix];
+        DrawSetupCompute(context, vk_command_buffer, &context->m_MainScratchBuffers[image_ix]);
+        vkCmdDispatchIndirect(vk_command_buffer, ((DeviceBuffer*) indirect_buffer)->m_Handle.m_Buffer, indirect_offset);
+        IndirectCommandBarrier(vk_command_buffer);
     }
 
     static bool ValidateShaderModule(VulkanContext* context, ShaderModule* shader, char* error_buffer, uint32_t error_buffer_size)
@@ -2597,6 +3230,7 @@ bail:
                         const ShaderResourceTypeInfo& type_info       = stage_type_infos[res.m_Type.m_TypeIndex];
                         program_resource_binding.m_DataOffset         = info.m_UniformDataSize;
                         program_resource_binding.m_DynamicOffsetIndex = info.m_UniformBufferCount;
+                        program_resource_binding.m_UploadVersion      = 0;
 
                         info.m_UniformBufferCount++;
                         info.m_UniformDataSize        += res.m_BindingInfo.m_BlockSize;
@@ -2948,9 +3582,14 @@ bail:
         return INVALID_UNIFORM_LOCATION;
     }
 
-    static inline void WriteConstantData(uint32_t offset, uint8_t* uniform_data_ptr, uint8_t* data_ptr, uint32_t data_size)
+    static inline void WriteConstantData(ProgramResourceBinding& pgm_res, uint32_t offset, uint8_t* uniform_data_ptr, uint8_t* data_ptr, uint32_t data_size)
     {
-        memcpy(&uniform_data_ptr[offset], data_ptr, data_size);
+        // Most constants are set to the same value for each draw, in which case the previous copy of the block is reused
+        if (memcmp(&uniform_data_ptr[offset], data_ptr, data_size) != 0)
+        {
+            memcpy(&uniform_data_ptr[offset], data_ptr, data_size);
+            pgm_res.m_UploadVersion = 0;
+        }
     }
 
     static void VulkanSetConstantV4(HContext _context, const dmVMath::Vector4* data, int count, HUniformLocation base_location)
@@ -2970,7 +3609,7 @@ bail:
         const ShaderResourceTypeInfo&           type_info = type_infos[pgm_res.m_Res->m_Type.m_TypeIndex];
 
         uint32_t offset = pgm_res.m_DataOffset + type_info.m_Members[member].m_Offset;
-        WriteConstantData(offset, program_ptr->m_UniformData, (uint8_t*) data, sizeof(dmVMath::Vector4) * count);
+        WriteConstantData(pgm_res, offset, program_ptr->m_UniformData, (uint8_t*) data, sizeof(dmVMath::Vector4) * count);
     }
 
     static void VulkanSetConstantM4(HContext _context, const dmVMath::Vector4* data, int count, HUniformLocation base_location)
@@ -2990,7 +3629,7 @@ bail:
         const ShaderResourceTypeInfo&           type_info = type_infos[pgm_res.m_Res->m_Type.m_TypeIndex];
 
         uint32_t offset = pgm_res.m_DataOffset + type_info.m_Members[member].m_Offset;
-        WriteConstantData(offset, program_ptr->m_UniformData, (uint8_t*) data, sizeof(dmVMath::Vector4) * 4 * count);
+        WriteConstantData(pgm_res, offset, program_ptr->m_UniformData, (uint8_t*) data, sizeof(dmVMath::Vector4) * 4 * count);
     }
 
     static void VulkanSetSampler(HContext _context, HUniformLocation location, int32_t unit)
@@ -3694,6 +4333,42 @@ bail:
         return offset;
     }
 
+    static void RecordTextureLayoutTransition(VkCommandBuffer vk_command_buffer, VulkanTexture* texture, uint32_t mipmap, uint32_t layer_count,
+        VkImageLayout vk_to_layout, VkAccessFlags vk_src_access, VkAccessFlags vk_dst_access, VkPipelineStageFlags vk_src_stage, VkPipelineStageFlags vk_dst_stage)
+    {
+        VkImageMemoryBarrier vk_memory_barrier            = {};
+        vk_memory_barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        vk_memory_barrier.oldLayout                       = texture->m_ImageLayout[mipmap];
+        vk_memory_barrier.newLayout                       = vk_to_layout;
+        vk_memory_barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        vk_memory_barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        vk_memory_barrier.srcAccessMask                   = vk_src_access;
+        vk_memory_barrier.dstAccessMask                   = vk_dst_access;
+        vk_memory_barrier.image                           = texture->m_Handle.m_Image;
+        vk_memory_barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        vk_memory_barrier.subresourceRange.baseMipLevel   = mipmap;
+        vk_memory_barrier.subresourceRange.levelCount     = 1;
+        vk_memory_barrier.subresourceRange.baseArrayLayer = 0;
+        vk_memory_barrier.subresourceRange.layerCount     = layer_count;
+
+        vkCmdPipelineBarrier(vk_command_buffer, vk_src_stage, vk_dst_stage, 0, 0, 0, 0, 0, 1, &vk_memory_barrier);
+
+        texture->m_ImageLayout[mipmap] = vk_to_layout;
+    }
+
+    static inline uint32_t GetTextureUploadAlignment(VulkanTexture* texture)
+    {
+        // Buffer offsets for image copies must be a multiple of both four and the texel block size,
+        // compressed blocks are either 8 or 16 bytes and are covered by the 16 byte minimum.
+        uint32_t texel_size = IsTextureFormatCompressed(texture->m_GraphicsFormat) ? 1 : dmMath::Max(1U, GetTextureFormatBitsPerPixel(texture->m_GraphicsFormat) / 8);
+        uint32_t alignment  = 16;
+        while (alignment % texel_size)
+        {
+            alignment += 16;
+        }
+        return alignment;
+    }
+
     static void CopyToTexture(VulkanContext* context, const TextureParams& params,
         bool useStageBuffer, uint32_t texDataSize, void* texDataPtr, VulkanTexture* textureOut)
     {
@@ -3701,6 +4376,72 @@ bail:
         uint8_t layer_count = textureOut->m_Depth;
         assert(layer_count > 0);
 
+        uint32_t ring_offset = 0;
+        if (useStageBuffer && AllocateTextureUploadData(context, texDataSize, GetTextureUploadAlignment(textureOut), &ring_offset))
+        {
+            uint32_t slice_size = texDataSize / layer_count;
+
+        #ifdef __MACH__
+            // Note: There is an annoying validation issue on osx for layered compressed data that causes a validation error
+            //       due to misalignment of the data when using a stage buffer. The offsets in the stage buffer needs to be
+            //       8 byte aligned but for compressed data that is not the case for the lowest mipmaps.
+            //       This might need some more investigation, but for now we don't want a crash at least...
+            if (slice_size < 8 && layer_count > 1)
+            {
+                return;
+            }
+        #endif
+
+            TextureUploadRing* ring = &context->m_TextureUploadRing;
+            memcpy((uint8_t*) ring->m_StagingBuffer.m_MappedDataPtr + ring_offset, texDataPtr, texDataSize);
+
+            // The copy is recorded into the current upload batch, which is submitted at the latest
+            // before the next frame is submitted. The layout changes are recorded in the same command
+            // buffer, instead of waiting for the queue to become idle for each step.
+            VkCommandBuffer vk_command_buffer = GetTextureUploadCommandBuffer(context);
+
+            RecordTextureLayoutTransition(vk_command_buffer, textureOut, params.m_MipMap, layer_count,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+            // NOTE: We should check max layer count in the device properties!
+            VkBufferImageCopy* vk_copy_regions = new VkBufferImageCopy[layer_count];
+            for (int i = 0; i < layer_count; ++i)
+            {
+                VkBufferImageCopy& vk_copy_region = vk_copy_regions[i];
+                vk_copy_region.bufferOffset                    = ring_offset + i * slice_size;
+                vk_copy_region.bufferRowLength                 = 0;
+                vk_copy_region.bufferImageHeight               = 0;
+                vk_copy_region.imageOffset.x                   = params.m_X;
+                vk_copy_region.imageOffset.y                   = params.m_Y;
+                vk_copy_region.imageOffset.z                   = 0;
+                vk_copy_region.imageExtent.width               = params.m_Width;
+                vk_copy_region.imageExtent.height              = params.m_Height;
+                vk_copy_region.imageExtent.depth               = 1;
+                vk_copy_region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+                vk_copy_region.imageSubresource.mipLevel       = params.m_MipMap;
+                vk_copy_region.imageSubresource.baseArrayLayer = i;
+                vk_copy_region.imageSubresource.layerCount     = 1;
+            }
+
+            vkCmdCopyBufferToImage(vk_command_buffer, ring->m_StagingBuffer.m_Handle.m_Buffer,
+                textureOut->m_Handle.m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                layer_count, vk_copy_regions);
+
+            RecordTextureLayoutTransition(vk_command_buffer, textureOut, params.m_MipMap, layer_count,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+            delete[] vk_copy_regions;
+            return;
+        }
+
+        // Anything below records and submits its own commands, so previously batched
+        // copies must be submitted first to keep the order of the uploads.
+        FlushTextureUploads(context);
+
         // TODO There is potentially a bunch of redundancy here.
         //      * Can we use a single command buffer for these updates,
         //        and not create a new one in every transition?
@@ -3709,6 +4450,7 @@ bail:
         //        per mipmap instead of batching in one cmd
         if (useStageBuffer)
         {
+            // The upload doesn't fit in the staging ring, use a dedicated stage buffer for it
             uint32_t slice_size = texDataSize / layer_count;
 
         #ifdef __MACH__
@@ -3989,6 +4731,13 @@ bail:
 
         context->m_PipelineCache.Iterate(DestroyPipelineCacheCb, context);
 
+        SaveDriverPipelineCache(context);
+        if (context->m_DriverPipelineCache != VK_NULL_HANDLE)
+        {
+            vkDestroyPipelineCache(vk_device, context->m_DriverPipelineCache, 0);
+            context->m_DriverPipelineCache = VK_NULL_HANDLE;
+        }
+
         DestroyDeviceBuffer(vk_device, &context->m_MainTextureDepthStencil.m_DeviceBuffer.m_Handle);
         DestroyTexture(vk_device, &context->m_MainTextureDepthStencil.m_Handle);
         DestroyTexture(vk_device, &context->m_DefaultTexture2D->m_Handle);
@@ -4000,6 +4749,10 @@ bail:
         vkFreeCommandBuffers(vk_device, context->m_LogicalDevice.m_CommandPool, context->m_MainCommandBuffers.Size(), context->m_MainCommandBuffers.Begin());
         vkFreeCommandBuffers(vk_device, context->m_LogicalDevice.m_CommandPool, 1, &context->m_MainCommandBufferUploadHelper);
 
+        DestroyTextureUploadRing(vk_device, context->m_LogicalDevice.m_CommandPool, &context->m_TextureUploadRing);
+        DestroyGpuTimerQueries(vk_device, &context->m_GpuTimerQueries);
+        DestroyPixelReadbacks(vk_device, context);
+
         for (uint8_t i=0; i < context->m_MainFrameBuffers.Size(); i++)
         {
             vkDestroyFramebuffer(vk_device, context->m_MainFrameBuffers[i], 0);
@@ -4027,12 +4780,14 @@ bail:
 
         for (size_t i = 0; i < DM_MAX_FRAMES_IN_FLIGHT; i++) {
             FrameResource& frame_resource = context->m_FrameResources[i];
+            FlushResourcesToDestroy(vk_device, &frame_resource.m_ResourcesToDestroy);
             vkDestroySemaphore(vk_device, frame_resource.m_RenderFinished, 0);
             vkDestroySemaphore(vk_device, frame_resource.m_ImageAvailable, 0);
             vkDestroyFence(vk_device, frame_resource.m_SubmitFence, 0);
         }
 
         DestroySwapChain(vk_device, context->m_SwapChain);
+        DestroyDeviceMemory(vk_device);
         DestroyLogicalDevice(&context->m_LogicalDevice);
         DestroyPhysicalDevice(&context->m_PhysicalDevice);
     }
@@ -4256,6 +5011,149 @@ bail:
         }
     }
 
+    static void DestroyPixelReadbacks(VkDevice vk_device, VulkanContext* context)
+    {
+        for (uint32_t i = 0; i < MAX_PIXEL_READBACKS; ++i)
+        {
+            PixelReadback& readback = context->m_PixelReadbacks[i];
+            if (readback.m_Buffer.m_Handle.m_Buffer != VK_NULL_HANDLE)
+            {
+                readback.m_Buffer.UnmapMemory(vk_device);
+                DestroyDeviceBuffer(vk_device, &readback.m_Buffer.m_Handle);
+            }
+            memset(&readback, 0, sizeof(readback));
+        }
+        context->m_PixelReadback = 0;
+    }
+
+    static bool VulkanIsPixelReadbackSupported(HContext _context)
+    {
+        return true;
+    }
+
+    static bool VulkanReadPixelsAsync(HContext _context, uint32_t readback_id)
+    {
+        VulkanContext* context  = (VulkanContext*) _context;
+        VkDevice vk_device      = context->m_LogicalDevice.m_Device;
+        PixelReadback& readback = context->m_PixelReadbacks[context->m_PixelReadback];
+
+        if (!context->m_FrameBegun || readback.m_Pending)
+        {
+            return false;
+        }
+
+        uint32_t w    = context->m_WindowWidth;
+        uint32_t h    = context->m_WindowHeight;
+        uint32_t size = w * h * 4;
+
+        if (readback.m_Size != size)
+        {
+            // The buffer isn't used by the GPU once it has been resolved
+            if (readback.m_Buffer.m_Handle.m_Buffer != VK_NULL_HANDLE)
+            {
+                readback.m_Buffer.UnmapMemory(vk_device);
+                DestroyDeviceBuffer(vk_device, &readback.m_Buffer.m_Handle);
+            }
+
+            readback.m_Buffer = DeviceBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+            VkResult res = CreateDeviceBuffer(context->m_PhysicalDevice.m_Device, vk_device, size,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &readback.m_Buffer);
+            CHECK_VK_ERROR(res);
+
+            // The buffer stays mapped until it is destroyed
+            res = readback.m_Buffer.MapMemory(vk_device);
+            CHECK_VK_ERROR(res);
+            readback.m_Size = size;
+        }
+
+        HRenderTarget current_rt_h = context->m_CurrentRenderTarget;
+        bool in_render_pass = EndRenderPass(context);
+
+        // The main render pass leaves the swap chain image in the present layout. The copy is recorded into
+        // the frame's command buffer, so unlike ReadPixels() there's no separate submit to wait for.
+        VkCommandBuffer vk_command_buffer = context->m_MainCommandBuffers[context->m_SwapChain->m_ImageIndex];
+
+        VkImageMemoryBarrier vk_memory_barrier            = {};
+        vk_memory_barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        vk_memory_barrier.oldLayout                       = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        vk_memory_barrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        vk_memory_barrier.srcAccessMask                   = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        vk_memory_barrier.dstAccessMask                   = VK_ACCESS_TRANSFER_READ_BIT;
+        vk_memory_barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        vk_memory_barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        vk_memory_barrier.image                           = context->m_SwapChain->Image();
+        vk_memory_barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        vk_memory_barrier.subresourceRange.levelCount     = 1;
+        vk_memory_barrier.subresourceRange.layerCount     = 1;
+
+        vkCmdPipelineBarrier(vk_command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, 0, 0, 0, 1, &vk_memory_barrier);
+
+        VkBufferImageCopy vk_copy_region = {};
+        vk_copy_region.imageExtent.width           = w;
+        vk_copy_region.imageExtent.height          = h;
+        vk_copy_region.imageExtent.depth           = 1;
+        vk_copy_region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        vk_copy_region.imageSubresource.layerCount = 1;
+
+        vkCmdCopyImageToBuffer(vk_command_buffer, context->m_SwapChain->Image(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            readback.m_Buffer.m_Handle.m_Buffer, 1, &vk_copy_region);
+
+        vk_memory_barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        vk_memory_barrier.newLayout     = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        vk_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vk_memory_barrier.dstAccessMask = 0;
+
+        vkCmdPipelineBarrier(vk_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, 0, 0, 0, 1, &vk_memory_barrier);
+
+        if (in_render_pass)
+        {
+            BeginRenderPass(context, current_rt_h);
+        }
+
+        readback.m_ReadbackId    = readback_id;
+        readback.m_FrameInFlight = context->m_CurrentFrameInFlight;
+        readback.m_Pending       = 1;
+        readback.m_Done          = 0;
+
+        context->m_PixelReadback = (context->m_PixelReadback + 1) % MAX_PIXEL_READBACKS;
+        return true;
+    }
+
+    static void VulkanResolvePixelReadbacks(HContext _context, PixelReadbackCallback callback, void* user_data, bool wait)
+    {
+        VulkanContext* context = (VulkanContext*) _context;
+        VkDevice vk_device     = context->m_LogicalDevice.m_Device;
+
+        // Oldest first
+        for (uint32_t i = 0; i < MAX_PIXEL_READBACKS; ++i)
+        {
+            PixelReadback& readback = context->m_PixelReadbacks[(context->m_PixelReadback + i) % MAX_PIXEL_READBACKS];
+            if (!readback.m_Pending)
+            {
+                continue;
+            }
+
+            if (!readback.m_Done)
+            {
+                // A readback of the current frame can't finish until the frame has been submitted
+                bool submitted = !context->m_FrameBegun || readback.m_FrameInFlight != context->m_CurrentFrameInFlight;
+                if (!wait || !submitted)
+                {
+                    break;
+                }
+
+                // The fence is only reset in BeginFrame, after which the readback would have been done
+                vkWaitForFences(vk_device, 1, &context->m_FrameResources[readback.m_FrameInFlight].m_SubmitFence, VK_TRUE, UINT64_MAX);
+            }
+
+            callback(user_data, readback.m_ReadbackId, readback.m_Buffer.m_MappedDataPtr, readback.m_Size);
+            readback.m_Pending = 0;
+            readback.m_Done    = 0;
+        }
+    }
+
     static dmPlatform::HWindow VulkanGetWindow(HContext context)
     {
         return ((VulkanContext*) context)->m_Window;
@@ -4361,7 +5259,8 @@ bail:
     HStorageBuffer VulkanNewStorageBuffer(HContext _context, uint32_t buffer_size)
     {
         VulkanContext* context       = (VulkanContext*) _context;
-        DeviceBuffer* storage_buffer = new DeviceBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        // Storage buffers can also hold the commands for DrawElementsIndirect and DispatchComputeIndirect
+        DeviceBuffer* storage_buffer = new DeviceBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
 
         if (buffer_size > 0)
         {
@@ -4462,6 +5361,8 @@ bail:
         DeviceBuffer* buffer   = (DeviceBuffer*) _buffer;
         VulkanTexture* texture = GetAssetFromContainer<VulkanTexture>(context->m_AssetHandleContainer, _texture);
 
+        FlushTextureUploads(context);
+
         OneTimeCommandBuffer cmd_buffer(context);
         VkResult res = cmd_buffer.Begin();
         CHECK_VK_ERROR(res);
@@ -4745,6 +5646,7 @@ bail:
         uint8_t* buffer_ptr = (uint8_t*) buffer->m_MappedDataPtr + buffer_offset;
 
         WriteConstantData(
+            program_ptr->m_ResourceBindings[set][binding],
             program_ptr->m_ResourceBindings[set][binding].m_DataOffset,
             program_ptr->m_UniformData,
             buffer_ptr,
@@ -4875,6 +5777,8 @@ bail:
             clear_value.uint32[i]  = (uint32_t) values[i];
         }
 
+        FlushTextureUploads(context);
+
         VkResult res = TransitionImageLayout(
             context->m_LogicalDevice.m_Device,
             context->m_LogicalDevice.m_CommandPool,
@@ -5003,6 +5907,16 @@ bail:
     {
         GraphicsAdapterFunctionTable fn_table = {};
         DM_REGISTER_GRAPHICS_FUNCTION_TABLE(fn_table, Vulkan);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, Vulkan, IsGpuTimerSupported);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, Vulkan, BeginGpuTimer);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, Vulkan, EndGpuTimer);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, Vulkan, ResolveGpuTimers);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, Vulkan, IsPixelReadbackSupported);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, Vulkan, ReadPixelsAsync);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, Vulkan, ResolvePixelReadbacks);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, Vulkan, IsMultiDrawIndirectSupported);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, Vulkan, DrawElementsIndirect);
+        DM_REGISTER_GRAPHICS_FUNCTION(fn_table, Vulkan, DispatchComputeIndirect);
         return fn_table;
     }
 }
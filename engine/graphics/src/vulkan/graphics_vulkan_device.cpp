@@ -250,6 +250,7 @@ namespace dmGraphics
             m_DescriptorSetIndex  = 0;
             m_DescriptorPoolIndex = 0;
         }
+        m_CachedSets.Clear();
     }
 
     VkResult OneTimeCommandBuffer::Begin()
@@ -292,7 +293,7 @@ namespace dmGraphics
         {
             return VK_SUCCESS;
         }
-        return vkMapMemory(vk_device, m_Handle.m_Memory, offset, size > 0 ? size : m_MemorySize, 0, &m_MappedDataPtr);
+        return MapDeviceMemory(vk_device, m_Handle, offset, size > 0 ? size : m_MemorySize, &m_MappedDataPtr);
     }
 
     void DeviceBuffer::UnmapMemory(VkDevice vk_device)
@@ -301,7 +302,7 @@ namespace dmGraphics
         {
             return;
         }
-        vkUnmapMemory(vk_device, m_Handle.m_Memory);
+        UnmapDeviceMemory(vk_device, m_Handle);
         m_MappedDataPtr = 0;
     }
 
@@ -732,13 +733,6 @@ namespace dmGraphics
         VkMemoryRequirements vk_buffer_memory_req;
         vkGetBufferMemoryRequirements(vk_device, bufferOut->m_Handle.m_Buffer, &vk_buffer_memory_req);
 
-        VkMemoryAllocateInfo vk_memory_alloc_info;
-        memset(&vk_memory_alloc_info, 0, sizeof(vk_memory_alloc_info));
-
-        vk_memory_alloc_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        vk_memory_alloc_info.allocationSize  = vk_buffer_memory_req.size;
-        vk_memory_alloc_info.memoryTypeIndex = 0;
-
         uint32_t memory_type_index = 0;
         if (!GetMemoryTypeIndex(vk_physical_device, vk_buffer_memory_req.memoryTypeBits, vk_memory_flags, &memory_type_index))
         {
@@ -746,15 +740,13 @@ namespace dmGraphics
             goto bail;
         }
 
-        vk_memory_alloc_info.memoryTypeIndex = memory_type_index;
-
-        res = vkAllocateMemory(vk_device, &vk_memory_alloc_info, 0, &bufferOut->m_Handle.m_Memory);
+        res = AllocateDeviceMemory(vk_physical_device, vk_device, vk_buffer_memory_req, memory_type_index, DEVICE_MEMORY_USAGE_BUFFER, &bufferOut->m_Handle);
         if (res != VK_SUCCESS)
         {
             goto bail;
         }
 
-        res = vkBindBufferMemory(vk_device, bufferOut->m_Handle.m_Buffer, bufferOut->m_Handle.m_Memory, 0);
+        res = vkBindBufferMemory(vk_device, bufferOut->m_Handle.m_Buffer, bufferOut->m_Handle.m_Memory, bufferOut->m_Handle.m_MemoryOffset);
         if (res != VK_SUCCESS)
         {
             return res;
@@ -774,6 +766,9 @@ bail:
         descriptorAllocator->m_DescriptorSetMax   = descriptor_count;
         descriptorAllocator->m_DescriptorsPerPool = descriptor_count;
         AllocateDescriptorSets(descriptorAllocator);
+        // The allocators are zero initialized, and Clear() sets up the free list of the cache
+        descriptorAllocator->m_CachedSets.SetCapacity(256, descriptor_count);
+        descriptorAllocator->m_CachedSets.Clear();
         return AllocateDescriptorPool(descriptorAllocator, vk_device);
     }
 
@@ -872,14 +867,12 @@ bail:
         VkMemoryRequirements vk_memory_req;
         vkGetImageMemoryRequirements(vk_device, textureOut->m_Handle.m_Image, &vk_memory_req);
 
-        VkMemoryAllocateInfo vk_memory_alloc_info;
-        memset(&vk_memory_alloc_info, 0, sizeof(vk_memory_alloc_info));
-
-        vk_memory_alloc_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        vk_memory_alloc_info.allocationSize  = vk_memory_req.size;
-        vk_memory_alloc_info.memoryTypeIndex = 0;
-
         uint32_t memory_type_index = 0;
+        DeviceMemoryUsage memory_usage = vk_tiling == VK_IMAGE_TILING_LINEAR ? DEVICE_MEMORY_USAGE_BUFFER : DEVICE_MEMORY_USAGE_IMAGE;
+        if (vk_usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
+        {
+            memory_usage = DEVICE_MEMORY_USAGE_ATTACHMENT;
+        }
 
         // Lazy / memorless might not be supported on this platform
         if (vk_memory_flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT && !GetMemoryTypeIndex(vk_physical_device, vk_memory_req.memoryTypeBits, vk_memory_flags, &memory_type_index))
@@ -893,15 +886,13 @@ bail:
             goto bail;
         }
 
-        vk_memory_alloc_info.memoryTypeIndex = memory_type_index;
-
-        res = vkAllocateMemory(vk_device, &vk_memory_alloc_info, 0, &device_buffer.m_Handle.m_Memory);
+        res = AllocateDeviceMemory(vk_physical_device, vk_device, vk_memory_req, memory_type_index, memory_usage, &device_buffer.m_Handle);
         if (res != VK_SUCCESS)
         {
             goto bail;
         }
 
-        res = vkBindImageMemory(vk_device, textureOut->m_Handle.m_Image, device_buffer.m_Handle.m_Memory, 0);
+        res = vkBindImageMemory(vk_device, textureOut->m_Handle.m_Image, device_buffer.m_Handle.m_Memory, device_buffer.m_Handle.m_MemoryOffset);
         if (res != VK_SUCCESS)
         {
             goto bail;
@@ -1192,7 +1183,7 @@ bail:
         VK_COMPARE_OP_ALWAYS
     };
 
-    VkResult CreateComputePipeline(VkDevice vk_device, Program* program, Pipeline* pipelineOut)
+    VkResult CreateComputePipeline(VkDevice vk_device, VkPipelineCache vk_pipeline_cache, Program* program, Pipeline* pipelineOut)
     {
         assert(pipelineOut && *pipelineOut == VK_NULL_HANDLE);
 
@@ -1204,10 +1195,10 @@ bail:
         vk_pipeline_create_info.layout             = program->m_Handle.m_PipelineLayout;
         vk_pipeline_create_info.pNext              = 0;
         vk_pipeline_create_info.stage              = program->m_ComputeModule->m_PipelineStageInfo;
-        return vkCreateComputePipelines(vk_device, 0, 1, &vk_pipeline_create_info, 0, pipelineOut);
+        return vkCreateComputePipelines(vk_device, vk_pipeline_cache, 1, &vk_pipeline_create_info, 0, pipelineOut);
     }
 
-    VkResult CreateGraphicsPipeline(VkDevice vk_device, VkRect2D vk_scissor, VkSampleCountFlagBits vk_sample_count,
+    VkResult CreateGraphicsPipeline(VkDevice vk_device, VkPipelineCache vk_pipeline_cache, VkRect2D vk_scissor, VkSampleCountFlagBits vk_sample_count,
         PipelineState pipelineState, Program* program, VertexDeclaration** vertexDeclarations, uint32_t vertexDeclarationCount,
         RenderTarget* render_target, Pipeline* pipelineOut)
     {
@@ -1414,13 +1405,16 @@ bail:
         vk_pipeline_info.basePipelineHandle  = VK_NULL_HANDLE;
         vk_pipeline_info.basePipelineIndex   = -1;
 
-        return vkCreateGraphicsPipelines(vk_device, VK_NULL_HANDLE, 1, &vk_pipeline_info, 0, pipelineOut);
+        return vkCreateGraphicsPipelines(vk_device, vk_pipeline_cache, 1, &vk_pipeline_info, 0, pipelineOut);
     }
 
-    void ResetScratchBuffer(VkDevice vk_device, ScratchBuffer* scratchBuffer)
+    void ResetScratchBuffer(VkDevice vk_device, ScratchBuffer* scratchBuffer, bool reset_descriptors)
     {
         assert(scratchBuffer);
-        scratchBuffer->m_DescriptorAllocator->Reset(vk_device);
+        if (reset_descriptors)
+        {
+            scratchBuffer->m_DescriptorAllocator->Reset(vk_device);
+        }
         scratchBuffer->m_MappedDataCursor = 0;
     }
 
@@ -1470,6 +1464,10 @@ bail:
         {
             vkDestroyDescriptorPool(vk_device, allocator->m_DescriptorPools[i].m_DescriptorPool, 0);
         }
+
+        // Swap with an empty table, so the memory is released when it goes out of scope
+        dmHashTable64<uint32_t> cached_sets;
+        allocator->m_CachedSets.Swap(cached_sets);
     }
 
     void DestroyTexture(VkDevice vk_device, VulkanTexture::VulkanHandle* handle)
@@ -1516,11 +1514,7 @@ bail:
             handle->m_Buffer = VK_NULL_HANDLE;
         }
 
-        if (handle->m_Memory != VK_NULL_HANDLE)
-        {
-            vkFreeMemory(vk_device, handle->m_Memory, 0);
-            handle->m_Memory = VK_NULL_HANDLE;
-        }
+        FreeDeviceMemory(vk_device, handle);
     }
 
     void DestroyShaderModule(VkDevice vk_device, ShaderModule* shaderModule)
@@ -112,6 +112,7 @@ extern PFN_vkDestroyRenderPass vkDestroyRenderPass;
 extern PFN_vkDestroyFramebuffer vkDestroyFramebuffer;
 extern PFN_vkDestroyShaderModule vkDestroyShaderModule;
 extern PFN_vkDestroyPipelineCache vkDestroyPipelineCache;
+extern PFN_vkGetPipelineCacheData vkGetPipelineCacheData;
 extern PFN_vkCreateQueryPool vkCreateQueryPool;
 extern PFN_vkDestroyQueryPool vkDestroyQueryPool;
 extern PFN_vkGetQueryPoolResults vkGetQueryPoolResults;
@@ -119,6 +120,7 @@ extern PFN_vkCmdBeginQuery vkCmdBeginQuery;
 extern PFN_vkCmdEndQuery vkCmdEndQuery;
 extern PFN_vkCmdResetQueryPool vkCmdResetQueryPool;
 extern PFN_vkCmdCopyQueryPoolResults vkCmdCopyQueryPoolResults;
+extern PFN_vkCmdWriteTimestamp vkCmdWriteTimestamp;
 extern PFN_vkResetDescriptorPool vkResetDescriptorPool;
 extern PFN_vkCmdCopyImageToBuffer vkCmdCopyImageToBuffer;
 
@@ -0,0 +1,486 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <assert.h>
+#include <string.h>
+
+#include <dlib/array.h>
+#include <dlib/math.h>
+#include <dlib/log.h>
+#include <dlib/profile.h>
+
+#include "graphics_vulkan_defines.h"
+#include "graphics_vulkan_private.h"
+
+DM_PROPERTY_EXTERN(rmtp_Graphics);
+DM_PROPERTY_GROUP(rmtp_VulkanMemory, "Vulkan memory", &rmtp_Graphics);
+DM_PROPERTY_U64(rmtp_VulkanMemoryDeviceUsed, 0, NoFlags, "device local bytes used", &rmtp_VulkanMemory);
+DM_PROPERTY_U64(rmtp_VulkanMemoryDeviceReserved, 0, NoFlags, "device local bytes reserved", &rmtp_VulkanMemory);
+DM_PROPERTY_U64(rmtp_VulkanMemoryHostUsed, 0, NoFlags, "host bytes used", &rmtp_VulkanMemory);
+DM_PROPERTY_U64(rmtp_VulkanMemoryHostReserved, 0, NoFlags, "host bytes reserved", &rmtp_VulkanMemory);
+DM_PROPERTY_U32(rmtp_VulkanMemoryAllocations, 0, NoFlags, "# vkAllocateMemory", &rmtp_VulkanMemory);
+DM_PROPERTY_U32(rmtp_VulkanMemorySuballocations, 0, NoFlags, "# suballocations", &rmtp_VulkanMemory);
+
+// The device memory is allocated in large blocks per memory type, that the buffers and the
+// textures are suballocated from. Some drivers only allow a few thousand vkAllocateMemory calls
+// (maxMemoryAllocationCount), and the calls themselves are slow.
+// Buffers and optimally tiled images are kept in separate blocks, so that the bufferImageGranularity
+// never has to be taken into account. Large allocations, large render targets and lazily allocated
+// memory get a dedicated vkAllocateMemory call.
+
+namespace dmGraphics
+{
+    static const uint32_t DEVICE_MEMORY_BLOCK_SIZE     = 32 * 1024 * 1024;
+    static const uint32_t DEVICE_MEMORY_MIN_BLOCK_SIZE = 1024 * 1024;
+
+    struct DeviceMemoryRange
+    {
+        uint32_t m_Offset;
+        uint32_t m_Size;
+    };
+
+    struct DeviceMemoryBlock
+    {
+        VkDeviceMemory             m_Memory;
+        void*                      m_MappedDataPtr; // Host visible blocks are mapped once and stay mapped
+        dmArray<DeviceMemoryRange> m_FreeRanges;    // Sorted on offset, adjacent ranges are always merged
+        uint32_t                   m_Size;
+        uint32_t                   m_Used;
+        uint32_t                   m_AllocationCount;
+        uint16_t                   m_MemoryTypeIndex;
+        uint16_t                   m_Kind;
+    };
+
+    struct DeviceMemoryAllocator
+    {
+        VkPhysicalDeviceMemoryProperties m_MemoryProperties;
+        dmArray<DeviceMemoryBlock*>      m_Blocks[VK_MAX_MEMORY_TYPES][DEVICE_MEMORY_KIND_COUNT];
+        DeviceMemoryStats                m_Stats;
+        uint32_t                         m_Initialized : 1;
+    };
+
+    static DeviceMemoryAllocator g_DeviceMemory;
+
+    static void InitializeDeviceMemory(VkPhysicalDevice vk_physical_device)
+    {
+        if (g_DeviceMemory.m_Initialized)
+        {
+            return;
+        }
+        vkGetPhysicalDeviceMemoryProperties(vk_physical_device, &g_DeviceMemory.m_MemoryProperties);
+        memset(&g_DeviceMemory.m_Stats, 0, sizeof(g_DeviceMemory.m_Stats));
+        g_DeviceMemory.m_Stats.m_HeapCount = g_DeviceMemory.m_MemoryProperties.memoryHeapCount;
+        g_DeviceMemory.m_Initialized = 1;
+    }
+
+    static uint32_t GetHeapIndex(uint32_t memory_type_index)
+    {
+        return g_DeviceMemory.m_MemoryProperties.memoryTypes[memory_type_index].heapIndex;
+    }
+
+    // Small heaps (e.g. the host visible device local heap on some desktop GPUs) get smaller blocks
+    static uint32_t GetBlockSize(uint32_t memory_type_index)
+    {
+        VkDeviceSize heap_size = g_DeviceMemory.m_MemoryProperties.memoryHeaps[GetHeapIndex(memory_type_index)].size;
+        VkDeviceSize block_size = dmMath::Min((VkDeviceSize) DEVICE_MEMORY_BLOCK_SIZE, heap_size / 8);
+        return (uint32_t) dmMath::Max((VkDeviceSize) DEVICE_MEMORY_MIN_BLOCK_SIZE, block_size);
+    }
+
+    static void UpdateDeviceMemoryProperties()
+    {
+        uint64_t device_used = 0, device_reserved = 0, host_used = 0, host_reserved = 0;
+        for (uint32_t i = 0; i < g_DeviceMemory.m_Stats.m_HeapCount; ++i)
+        {
+            const DeviceMemoryHeapStats& heap = g_DeviceMemory.m_Stats.m_Heaps[i];
+            if (g_DeviceMemory.m_MemoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+            {
+                device_used     += heap.m_Used;
+                device_reserved += heap.m_Reserved;
+            }
+            else
+            {
+                host_used     += heap.m_Used;
+                host_reserved += heap.m_Reserved;
+            }
+        }
+        DM_PROPERTY_SET_U64(rmtp_VulkanMemoryDeviceUsed, device_used);
+        DM_PROPERTY_SET_U64(rmtp_VulkanMemoryDeviceReserved, device_reserved);
+        DM_PROPERTY_SET_U64(rmtp_VulkanMemoryHostUsed, host_used);
+        DM_PROPERTY_SET_U64(rmtp_VulkanMemoryHostReserved, host_reserved);
+        DM_PROPERTY_SET_U32(rmtp_VulkanMemoryAllocations, g_DeviceMemory.m_Stats.m_AllocationCount);
+        DM_PROPERTY_SET_U32(rmtp_VulkanMemorySuballocations, g_DeviceMemory.m_Stats.m_SuballocationCount);
+    }
+
+    static VkResult AllocateMemory(VkDevice vk_device, VkDeviceSize size, uint32_t memory_type_index, VkDeviceMemory* vk_memory_out)
+    {
+        VkMemoryAllocateInfo vk_memory_alloc_info;
+        memset(&vk_memory_alloc_info, 0, sizeof(vk_memory_alloc_info));
+
+        vk_memory_alloc_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        vk_memory_alloc_info.allocationSize  = size;
+        vk_memory_alloc_info.memoryTypeIndex = memory_type_index;
+
+        VkResult res = vkAllocateMemory(vk_device, &vk_memory_alloc_info, 0, vk_memory_out);
+        if (res == VK_SUCCESS)
+        {
+            g_DeviceMemory.m_Stats.m_Heaps[GetHeapIndex(memory_type_index)].m_Reserved += size;
+            g_DeviceMemory.m_Stats.m_AllocationCount++;
+        }
+        return res;
+    }
+
+    static void FreeMemory(VkDevice vk_device, VkDeviceMemory vk_memory, VkDeviceSize size, uint32_t memory_type_index)
+    {
+        vkFreeMemory(vk_device, vk_memory, 0);
+        g_DeviceMemory.m_Stats.m_Heaps[GetHeapIndex(memory_type_index)].m_Reserved -= size;
+        g_DeviceMemory.m_Stats.m_AllocationCount--;
+    }
+
+    static DeviceMemoryBlock* NewBlock(VkDevice vk_device, uint32_t memory_type_index, DeviceMemoryKind kind)
+    {
+        uint32_t block_size = GetBlockSize(memory_type_index);
+        VkDeviceMemory vk_memory;
+        if (AllocateMemory(vk_device, block_size, memory_type_index, &vk_memory) != VK_SUCCESS)
+        {
+            return 0;
+        }
+
+        DeviceMemoryBlock* block = new DeviceMemoryBlock;
+        block->m_Memory          = vk_memory;
+        block->m_MappedDataPtr   = 0;
+        block->m_Size            = block_size;
+        block->m_Used            = 0;
+        block->m_AllocationCount = 0;
+        block->m_MemoryTypeIndex = (uint16_t) memory_type_index;
+        block->m_Kind            = (uint16_t) kind;
+
+        DeviceMemoryRange range = { 0, block_size };
+        block->m_FreeRanges.SetCapacity(16);
+        block->m_FreeRanges.Push(range);
+
+        dmArray<DeviceMemoryBlock*>& blocks = g_DeviceMemory.m_Blocks[memory_type_index][kind];
+        if (blocks.Full())
+        {
+            blocks.OffsetCapacity(4);
+        }
+        blocks.Push(block);
+        return block;
+    }
+
+    static void DeleteBlock(VkDevice vk_device, DeviceMemoryBlock* block)
+    {
+        if (block->m_MappedDataPtr)
+        {
+            vkUnmapMemory(vk_device, block->m_Memory);
+        }
+        FreeMemory(vk_device, block->m_Memory, block->m_Size, block->m_MemoryTypeIndex);
+        delete block;
+    }
+
+    static void InsertRange(dmArray<DeviceMemoryRange>& ranges, uint32_t index, const DeviceMemoryRange& range)
+    {
+        if (ranges.Full())
+        {
+            ranges.OffsetCapacity(16);
+        }
+        ranges.SetSize(ranges.Size() + 1);
+        memmove(ranges.Begin() + index + 1, ranges.Begin() + index, (ranges.Size() - index - 1) * sizeof(DeviceMemoryRange));
+        ranges[index] = range;
+    }
+
+    static void EraseRange(dmArray<DeviceMemoryRange>& ranges, uint32_t index)
+    {
+        memmove(ranges.Begin() + index, ranges.Begin() + index + 1, (ranges.Size() - index - 1) * sizeof(DeviceMemoryRange));
+        ranges.SetSize(ranges.Size() - 1);
+    }
+
+    // First fit. The alignment padding stays in the free list.
+    static bool AllocateFromBlock(DeviceMemoryBlock* block, uint32_t size, uint32_t alignment, uint32_t* offset_out)
+    {
+        if (block->m_Size - block->m_Used < size)
+        {
+            return false;
+        }
+
+        dmArray<DeviceMemoryRange>& ranges = block->m_FreeRanges;
+        for (uint32_t i = 0; i < ranges.Size(); ++i)
+        {
+            DeviceMemoryRange range = ranges[i];
+            uint32_t offset  = ((range.m_Offset + alignment - 1) / alignment) * alignment;
+            uint32_t padding = offset - range.m_Offset;
+            if (range.m_Size < padding + size)
+            {
+                continue;
+            }
+
+            DeviceMemoryRange rest = { offset + size, range.m_Size - padding - size };
+            if (padding > 0)
+            {
+                ranges[i].m_Size = padding;
+                if (rest.m_Size > 0)
+                {
+                    InsertRange(ranges, i + 1, rest);
+                }
+            }
+            else if (rest.m_Size > 0)
+            {
+                ranges[i] = rest;
+            }
+            else
+            {
+                EraseRange(ranges, i);
+            }
+
+            block->m_Used += size;
+            block->m_AllocationCount++;
+            *offset_out = offset;
+            return true;
+        }
+        return false;
+    }
+
+    static void FreeToBlock(DeviceMemoryBlock* block, uint32_t offset, uint32_t size)
+    {
+        dmArray<DeviceMemoryRange>& ranges = block->m_FreeRanges;
+
+        uint32_t index = 0;
+        while (index < ranges.Size() && ranges[index].m_Offset < offset)
+        {
+            ++index;
+        }
+
+        bool merge_prev = index > 0 && ranges[index - 1].m_Offset + ranges[index - 1].m_Size == offset;
+        bool merge_next = index < ranges.Size() && offset + size == ranges[index].m_Offset;
+
+        if (merge_prev && merge_next)
+        {
+            ranges[index - 1].m_Size += size + ranges[index].m_Size;
+            EraseRange(ranges, index);
+        }
+        else if (merge_prev)
+        {
+            ranges[index - 1].m_Size += size;
+        }
+        else if (merge_next)
+        {
+            ranges[index].m_Offset = offset;
+            ranges[index].m_Size  += size;
+        }
+        else
+        {
+            DeviceMemoryRange range = { offset, size };
+            InsertRange(ranges, index, range);
+        }
+
+        block->m_Used -= size;
+        block->m_AllocationCount--;
+    }
+
+    static bool UseDedicatedAllocation(VkDeviceSize size, uint32_t memory_type_index, DeviceMemoryUsage usage)
+    {
+        if (usage == DEVICE_MEMORY_USAGE_DEDICATED)
+        {
+            return true;
+        }
+        // Lazily allocated memory only makes sense when the driver can back the whole allocation on demand
+        if (g_DeviceMemory.m_MemoryProperties.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+        {
+            return true;
+        }
+        uint32_t block_size = GetBlockSize(memory_type_index);
+        if (usage == DEVICE_MEMORY_USAGE_ATTACHMENT)
+        {
+            return size >= block_size / 8;
+        }
+        return size > block_size / 2;
+    }
+
+    static VkResult AllocateDedicated(VkDevice vk_device, uint32_t size, uint32_t memory_type_index, DeviceBuffer::VulkanHandle* handle)
+    {
+        VkResult res = AllocateMemory(vk_device, size, memory_type_index, &handle->m_Memory);
+        if (res != VK_SUCCESS)
+        {
+            return res;
+        }
+        handle->m_MemoryBlock     = 0;
+        handle->m_MemoryOffset    = 0;
+        handle->m_MemoryAllocSize = size;
+        handle->m_MemoryTypeIndex = memory_type_index;
+        g_DeviceMemory.m_Stats.m_Heaps[GetHeapIndex(memory_type_index)].m_Used += size;
+        UpdateDeviceMemoryProperties();
+        return VK_SUCCESS;
+    }
+
+    VkResult AllocateDeviceMemory(VkPhysicalDevice vk_physical_device, VkDevice vk_device, const VkMemoryRequirements& vk_memory_req,
+        uint32_t memory_type_index, DeviceMemoryUsage usage, DeviceBuffer::VulkanHandle* handle)
+    {
+        InitializeDeviceMemory(vk_physical_device);
+
+        assert(vk_memory_req.size < 0x80000000);
+        uint32_t size = (uint32_t) vk_memory_req.size;
+
+        if (UseDedicatedAllocation(vk_memory_req.size, memory_type_index, usage))
+        {
+            return AllocateDedicated(vk_device, size, memory_type_index, handle);
+        }
+
+        DeviceMemoryKind kind = usage == DEVICE_MEMORY_USAGE_BUFFER ? DEVICE_MEMORY_KIND_LINEAR : DEVICE_MEMORY_KIND_OPTIMAL;
+        uint32_t alignment = dmMath::Max((uint32_t) vk_memory_req.alignment, 1U);
+
+        DeviceMemoryBlock* block = 0;
+        uint32_t offset = 0;
+
+        dmArray<DeviceMemoryBlock*>& blocks = g_DeviceMemory.m_Blocks[memory_type_index][kind];
+        for (uint32_t i = 0; i < blocks.Size(); ++i)
+        {
+            if (AllocateFromBlock(blocks[i], size, alignment, &offset))
+            {
+                block = blocks[i];
+                break;
+            }
+        }
+
+        if (block == 0)
+        {
+            block = NewBlock(vk_device, memory_type_index, kind);
+            if (block == 0 || !AllocateFromBlock(block, size, alignment, &offset))
+            {
+                // The heap may still fit the allocation itself
+                return AllocateDedicated(vk_device, size, memory_type_index, handle);
+            }
+        }
+
+        handle->m_Memory          = block->m_Memory;
+        handle->m_MemoryBlock     = block;
+        handle->m_MemoryOffset    = offset;
+        handle->m_MemoryAllocSize = size;
+        handle->m_MemoryTypeIndex = memory_type_index;
+        g_DeviceMemory.m_Stats.m_Heaps[GetHeapIndex(memory_type_index)].m_Used += size;
+        g_DeviceMemory.m_Stats.m_SuballocationCount++;
+        UpdateDeviceMemoryProperties();
+        return VK_SUCCESS;
+    }
+
+    void FreeDeviceMemory(VkDevice vk_device, DeviceBuffer::VulkanHandle* handle)
+    {
+        if (handle->m_Memory == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        g_DeviceMemory.m_Stats.m_Heaps[GetHeapIndex(handle->m_MemoryTypeIndex)].m_Used -= handle->m_MemoryAllocSize;
+
+        DeviceMemoryBlock* block = handle->m_MemoryBlock;
+        if (block == 0)
+        {
+            FreeMemory(vk_device, handle->m_Memory, handle->m_MemoryAllocSize, handle->m_MemoryTypeIndex);
+        }
+        else
+        {
+            FreeToBlock(block, handle->m_MemoryOffset, handle->m_MemoryAllocSize);
+            g_DeviceMemory.m_Stats.m_SuballocationCount--;
+
+            // One empty block is kept per memory type, so that a buffer that is recreated often doesn't allocate a new block each time
+            if (block->m_AllocationCount == 0)
+            {
+                dmArray<DeviceMemoryBlock*>& blocks = g_DeviceMemory.m_Blocks[block->m_MemoryTypeIndex][block->m_Kind];
+                uint32_t block_index = blocks.Size();
+                bool has_empty_block = false;
+                for (uint32_t i = 0; i < blocks.Size(); ++i)
+                {
+                    if (blocks[i] == block)
+                        block_index = i;
+                    else if (blocks[i]->m_AllocationCount == 0)
+                        has_empty_block = true;
+                }
+                if (has_empty_block)
+                {
+                    blocks.EraseSwap(block_index);
+                    DeleteBlock(vk_device, block);
+                }
+            }
+        }
+
+        handle->m_Memory          = VK_NULL_HANDLE;
+        handle->m_MemoryBlock     = 0;
+        handle->m_MemoryOffset    = 0;
+        handle->m_MemoryAllocSize = 0;
+        UpdateDeviceMemoryProperties();
+    }
+
+    VkResult MapDeviceMemory(VkDevice vk_device, const DeviceBuffer::VulkanHandle& handle, uint32_t offset, uint32_t size, void** data_out)
+    {
+        DeviceMemoryBlock* block = handle.m_MemoryBlock;
+        if (block == 0)
+        {
+            return vkMapMemory(vk_device, handle.m_Memory, offset, size, 0, data_out);
+        }
+
+        // A memory object can only be mapped once, so the whole block is mapped for all its allocations
+        if (block->m_MappedDataPtr == 0)
+        {
+            VkResult res = vkMapMemory(vk_device, block->m_Memory, 0, VK_WHOLE_SIZE, 0, &block->m_MappedDataPtr);
+            if (res != VK_SUCCESS)
+            {
+                block->m_MappedDataPtr = 0;
+                return res;
+            }
+        }
+        *data_out = (uint8_t*) block->m_MappedDataPtr + handle.m_MemoryOffset + offset;
+        return VK_SUCCESS;
+    }
+
+    void UnmapDeviceMemory(VkDevice vk_device, const DeviceBuffer::VulkanHandle& handle)
+    {
+        // Blocks stay mapped until they are released
+        if (handle.m_MemoryBlock == 0)
+        {
+            vkUnmapMemory(vk_device, handle.m_Memory);
+        }
+    }
+
+    void DestroyDeviceMemory(VkDevice vk_device)
+    {
+        if (!g_DeviceMemory.m_Initialized)
+        {
+            return;
+        }
+
+        for (uint32_t t = 0; t < VK_MAX_MEMORY_TYPES; ++t)
+        {
+            for (uint32_t k = 0; k < DEVICE_MEMORY_KIND_COUNT; ++k)
+            {
+                dmArray<DeviceMemoryBlock*>& blocks = g_DeviceMemory.m_Blocks[t][k];
+                for (uint32_t i = 0; i < blocks.Size(); ++i)
+                {
+                    if (blocks[i]->m_AllocationCount > 0)
+                    {
+                        dmLogWarning("Releasing device memory block with %u live allocations", blocks[i]->m_AllocationCount);
+                    }
+                    DeleteBlock(vk_device, blocks[i]);
+                }
+                blocks.SetCapacity(0);
+            }
+        }
+
+        memset(&g_DeviceMemory.m_Stats, 0, sizeof(g_DeviceMemory.m_Stats));
+        g_DeviceMemory.m_Initialized = 0;
+        UpdateDeviceMemoryProperties();
+    }
+
+    void GetDeviceMemoryStats(DeviceMemoryStats* stats)
+    {
+        *stats = g_DeviceMemory.m_Stats;
+    }
+}
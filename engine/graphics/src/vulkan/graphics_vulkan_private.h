@@ -15,7 +15,9 @@
 #ifndef __GRAPHICS_DEVICE_VULKAN__
 #define __GRAPHICS_DEVICE_VULKAN__
 
+#include <assert.h>
 #include <stdint.h>
+#include <string.h>
 #include <dlib/hashtable.h>
 #include <dlib/opaque_handle_container.h>
 
@@ -34,6 +36,9 @@ namespace dmGraphics
     const static uint8_t DM_MAX_TEXTURE_UNITS          = 32;
     const static uint8_t DM_RENDERTARGET_BACKBUFFER_ID = 0;
     const static uint8_t DM_MAX_FRAMES_IN_FLIGHT       = 2; // In flight frames - number of concurrent frames being processed
+    const static uint8_t DM_MAX_CACHED_DESCRIPTOR_POOLS = 4; // Descriptor pools in use before the cached descriptor sets are released
+    const static uint8_t DM_MAX_TEXTURE_UPLOAD_BATCHES = 4; // Number of texture upload submissions that can be in flight at once
+    const static uint32_t DM_TEXTURE_UPLOAD_RING_SIZE  = 8 * 1024 * 1024;
 
     enum VulkanResourceType
     {
@@ -41,6 +46,7 @@ namespace dmGraphics
         RESOURCE_TYPE_TEXTURE       = 1,
         RESOURCE_TYPE_PROGRAM       = 2,
         RESOURCE_TYPE_RENDER_TARGET = 3,
+        RESOURCE_TYPE_SWAP_CHAIN    = 4,
     };
 
     struct OneTimeCommandBuffer
@@ -53,6 +59,52 @@ namespace dmGraphics
         VkCommandBuffer        m_CmdBuffer;
     };
 
+    // The buffers and graphics descriptor sets that are bound in a command buffer,
+    // so that binds that wouldn't change anything aren't recorded again
+    struct CommandBufferBindings
+    {
+        VkBuffer         m_IndexBuffer;
+        VkIndexType      m_IndexType;
+        VkBuffer         m_VertexBuffers[MAX_VERTEX_BUFFERS];
+        VkDeviceSize     m_VertexBufferOffsets[MAX_VERTEX_BUFFERS];
+        uint32_t         m_VertexBufferCount;
+        VkPipelineLayout m_PipelineLayout;
+        VkDescriptorSet  m_DescriptorSets[MAX_SET_COUNT];
+        uint32_t         m_DescriptorSetCount;
+        uint32_t         m_DynamicOffsets[MAX_SET_COUNT * MAX_BINDINGS_PER_SET_COUNT];
+        uint32_t         m_DynamicOffsetCount;
+    };
+
+    enum DeviceMemoryUsage
+    {
+        DEVICE_MEMORY_USAGE_BUFFER     = 0,
+        DEVICE_MEMORY_USAGE_IMAGE      = 1,
+        DEVICE_MEMORY_USAGE_ATTACHMENT = 2, // Large attachments get a dedicated allocation
+        DEVICE_MEMORY_USAGE_DEDICATED  = 3,
+    };
+
+    // Buffers and optimally tiled images are suballocated from separate blocks
+    enum DeviceMemoryKind
+    {
+        DEVICE_MEMORY_KIND_LINEAR  = 0,
+        DEVICE_MEMORY_KIND_OPTIMAL = 1,
+        DEVICE_MEMORY_KIND_COUNT   = 2,
+    };
+
+    struct DeviceMemoryHeapStats
+    {
+        uint64_t m_Used;     // Bytes in live allocations
+        uint64_t m_Reserved; // Bytes allocated from the driver
+    };
+
+    struct DeviceMemoryStats
+    {
+        DeviceMemoryHeapStats m_Heaps[VK_MAX_MEMORY_HEAPS];
+        uint32_t              m_HeapCount;
+        uint32_t              m_AllocationCount;    // Live vkAllocateMemory allocations
+        uint32_t              m_SuballocationCount; // Live allocations within the memory blocks
+    };
+
     struct DeviceBuffer
     {
         DeviceBuffer(){}
@@ -67,8 +119,12 @@ namespace dmGraphics
 
         struct VulkanHandle
         {
-            VkBuffer       m_Buffer;
-            VkDeviceMemory m_Memory;
+            VkBuffer                  m_Buffer;
+            VkDeviceMemory            m_Memory;
+            struct DeviceMemoryBlock* m_MemoryBlock;     // The block the memory is suballocated from, 0 for dedicated allocations
+            uint32_t                  m_MemoryOffset;    // Offset into m_Memory
+            uint32_t                  m_MemoryAllocSize;
+            uint32_t                  m_MemoryTypeIndex;
         };
 
         void*              m_MappedDataPtr;
@@ -136,6 +192,10 @@ namespace dmGraphics
         uint32_t                m_DescriptorSetMax;
         uint32_t                m_DescriptorPoolIndex;
         uint32_t                m_DescriptorsPerPool;
+        // Written descriptor sets, by a hash of the set layouts and the bound resources. The value is the index of the
+        // first set in m_DescriptorSets. The sets are kept until the allocator is reset.
+        dmHashTable64<uint32_t> m_CachedSets;
+        uint32_t                m_CacheVersion; // See VulkanContext::m_DescriptorCacheVersion
 
         VkResult Allocate(VkDevice vk_device, VkDescriptorSetLayout* vk_descriptor_set_layout, uint8_t setCount, uint32_t descriptor_count, VkDescriptorSet** vk_descriptor_set_out);
         void     Reset(VkDevice vk_device);
@@ -146,11 +206,13 @@ namespace dmGraphics
         ScratchBuffer()
         : m_DeviceBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
         , m_MappedDataCursor(0)
+        , m_Version(0)
         {}
 
         DescriptorAllocator* m_DescriptorAllocator;
         DeviceBuffer         m_DeviceBuffer;
         uint32_t             m_MappedDataCursor;
+        uint32_t             m_Version; // Unique for each reset or resize of the buffer, see ProgramResourceBinding::m_UploadVersion
     };
 
     struct SubPass
@@ -212,9 +274,59 @@ namespace dmGraphics
 
     struct FrameResource
     {
-        VkSemaphore m_ImageAvailable;
-        VkSemaphore m_RenderFinished;
-        VkFence     m_SubmitFence;
+        VkSemaphore            m_ImageAvailable;
+        VkSemaphore            m_RenderFinished;
+        VkFence                m_SubmitFence;
+        ResourcesToDestroyList m_ResourcesToDestroy; // Flushed when the submit fence has been waited on
+    };
+
+    // A batch of staged texture copies that are recorded into the same command buffer
+    // and submitted once. The ring memory used by the batch is reclaimed when the fence is signaled.
+    struct TextureUploadBatch
+    {
+        VkCommandBuffer m_CommandBuffer;
+        VkFence         m_Fence;
+        uint32_t        m_RingBytes; // Staging ring bytes consumed by this batch, including alignment padding
+    };
+
+    // Persistently mapped staging memory for texture uploads, sub-allocated in submission order
+    struct TextureUploadRing
+    {
+        DeviceBuffer       m_StagingBuffer;
+        TextureUploadBatch m_Batches[DM_MAX_TEXTURE_UPLOAD_BATCHES];
+        uint32_t           m_Head;
+        uint32_t           m_Used;
+        uint8_t            m_FirstBatch;
+        uint8_t            m_InFlightCount;
+        uint8_t            m_Recording : 1;
+    };
+
+    // Timestamp queries for the GPU timers, two per timer. The pool has one range of queries per frame in flight,
+    // which is read back when the submit fence of the frame has been waited on.
+    struct GpuTimerQueries
+    {
+        VkQueryPool m_QueryPool;
+        uint32_t    m_TimerIds[DM_MAX_FRAMES_IN_FLIGHT][MAX_GPU_TIMERS_PER_FRAME];
+        uint32_t    m_Count[DM_MAX_FRAMES_IN_FLIGHT];
+        // The results of the last finished frame, until they are resolved
+        uint32_t    m_ResultIds[MAX_GPU_TIMERS_PER_FRAME];
+        uint64_t    m_ResultTimes[MAX_GPU_TIMERS_PER_FRAME];
+        uint32_t    m_ResultCount;
+        uint64_t    m_TimestampMask;
+        float       m_TimestampPeriod; // Nanoseconds per tick
+        uint8_t     m_Active : 1;
+    };
+
+    // A host visible buffer that the swap chain image is copied into (see ReadPixelsAsync). The copy is recorded
+    // into the main command buffer, so it has finished when the submit fence of the frame has been waited on.
+    struct PixelReadback
+    {
+        DeviceBuffer m_Buffer;
+        uint32_t     m_Size;       // The size of the pixels, the buffer may be larger
+        uint32_t     m_ReadbackId;
+        uint8_t      m_FrameInFlight;
+        uint8_t      m_Pending : 1;
+        uint8_t      m_Done    : 1;
     };
 
     struct RenderPassAttachment
@@ -284,6 +396,9 @@ namespace dmGraphics
         VulkanHandle                    m_Handle;
         ProgramResourceBinding          m_ResourceBindings[MAX_SET_COUNT][MAX_BINDINGS_PER_SET_COUNT];
 
+        // The descriptor sets for the resources bound by the current draw call
+        VkDescriptorSet                 m_DescriptorSets[MAX_SET_COUNT];
+
         ShaderModule*                   m_VertexModule;
         ShaderModule*                   m_FragmentModule;
         ShaderModule*                   m_ComputeModule;
@@ -311,6 +426,7 @@ namespace dmGraphics
             VulkanTexture::VulkanHandle m_Texture;
             Program::VulkanHandle       m_Program;
             RenderTarget::VulkanHandle  m_RenderTarget;
+            VkSwapchainKHR              m_SwapChain;
         };
         VulkanResourceType m_ResourceType;
     };
@@ -367,6 +483,8 @@ namespace dmGraphics
         HTexture                           m_TextureUnits[DM_MAX_TEXTURE_UNITS];
         dmOpaqueHandleContainer<uintptr_t> m_AssetHandleContainer;
         PipelineCache                      m_PipelineCache;
+        VkPipelineCache                    m_DriverPipelineCache; // Persisted to m_PipelineCachePath, so that the pipelines don't have to be compiled again on the next run
+        char*                              m_PipelineCachePath;
         PipelineState                      m_PipelineState;
         SwapChain*                         m_SwapChain;
         SwapChainCapabilities              m_SwapChainCapabilities;
@@ -378,6 +496,8 @@ namespace dmGraphics
         dmArray<TextureSampler>            m_TextureSamplers;
         uint32_t*                          m_DynamicOffsetBuffer;
         uint16_t                           m_DynamicOffsetBufferSize;
+        uint32_t                           m_ScratchBufferVersion;
+        uint32_t                           m_DescriptorCacheVersion; // Changed when a resource that a cached descriptor set may refer to is destroyed
 
         VkPhysicalDeviceFragmentShaderInterlockFeaturesEXT m_FragmentShaderInterlockFeatures;
 
@@ -386,6 +506,10 @@ namespace dmGraphics
         dmArray<VkFramebuffer>          m_MainFrameBuffers;
         dmArray<VkCommandBuffer>        m_MainCommandBuffers;
         VkCommandBuffer                 m_MainCommandBufferUploadHelper;
+        TextureUploadRing               m_TextureUploadRing;
+        GpuTimerQueries                 m_GpuTimerQueries;
+        PixelReadback                   m_PixelReadbacks[MAX_PIXEL_READBACKS];
+        uint32_t                        m_PixelReadback; // The next readback to use
         ResourcesToDestroyList*         m_MainResourcesToDestroy[3];
         dmArray<ScratchBuffer>          m_MainScratchBuffers;
         dmArray<DescriptorAllocator>    m_MainDescriptorAllocators;
@@ -405,6 +529,9 @@ namespace dmGraphics
         Pipeline*                       m_CurrentPipeline;
         HTexture                        m_CurrentSwapchainTexture;
 
+        // What is currently bound in the main command buffer
+        CommandBufferBindings           m_MainBindings;
+
         // Misc state
         TextureFilter                   m_DefaultTextureMinFilter;
         TextureFilter                   m_DefaultTextureMagFilter;
@@ -429,6 +556,10 @@ namespace dmGraphics
         uint32_t                        m_CullFaceChanged      : 1;
         uint32_t                        m_UseValidationLayers  : 1;
         uint32_t                        m_RenderDocSupport     : 1;
+        uint32_t                        m_TimestampSupport     : 1;
+        uint32_t                        m_DrawIndirectSupport  : 1;
+        uint32_t                        m_MultiDrawSupport     : 1;
+        uint32_t                        m_SwapChainOutOfDate   : 1; // Set when presenting, and the swap chain is recreated in the next frame
     };
 
     // Implemented in graphics_vulkan_context.cpp
@@ -459,8 +590,8 @@ namespace dmGraphics
     VkResult CreateRenderPass(VkDevice vk_device, VkSampleCountFlagBits vk_sample_flags, RenderPassAttachment* colorAttachments, uint8_t numColorAttachments, RenderPassAttachment* depthStencilAttachment, RenderPassAttachment* resolveAttachment, VkRenderPass* renderPassOut);
     VkResult CreateDeviceBuffer(VkPhysicalDevice vk_physical_device, VkDevice vk_device, VkDeviceSize vk_size, VkMemoryPropertyFlags vk_memory_flags, DeviceBuffer* bufferOut);
     VkResult CreateShaderModule(VkDevice vk_device, const void* source, uint32_t sourceSize, VkShaderStageFlagBits stage_flag, ShaderModule* shaderModuleOut);
-    VkResult CreateGraphicsPipeline(VkDevice vk_device, VkRect2D vk_scissor, VkSampleCountFlagBits vk_sample_count, const PipelineState pipelineState, Program* program, VertexDeclaration** vertexDeclarations, uint32_t vertexDeclarationCount, RenderTarget* render_target, Pipeline* pipelineOut);
-    VkResult CreateComputePipeline(VkDevice vk_device, Program* program, Pipeline* pipelineOut);
+    VkResult CreateGraphicsPipeline(VkDevice vk_device, VkPipelineCache vk_pipeline_cache, VkRect2D vk_scissor, VkSampleCountFlagBits vk_sample_count, const PipelineState pipelineState, Program* program, VertexDeclaration** vertexDeclarations, uint32_t vertexDeclarationCount, RenderTarget* render_target, Pipeline* pipelineOut);
+    VkResult CreateComputePipeline(VkDevice vk_device, VkPipelineCache vk_pipeline_cache, Program* program, Pipeline* pipelineOut);
 
     // Destroy functions
     void DestroyDeviceBuffer(VkDevice vk_device, DeviceBuffer::VulkanHandle* handle);
@@ -491,12 +622,21 @@ namespace dmGraphics
     VkResult WriteToDeviceBuffer(VkDevice vk_device, VkDeviceSize size, VkDeviceSize offset, const void* data, DeviceBuffer* buffer);
     void     DestroyPipelineCacheCb(VulkanContext* context, const uint64_t* key, Pipeline* value);
     void     FlushResourcesToDestroy(VkDevice vk_device, ResourcesToDestroyList* resource_list);
-    void     ResetScratchBuffer(VkDevice vk_device, ScratchBuffer* scratchBuffer);
+    void     ResetScratchBuffer(VkDevice vk_device, ScratchBuffer* scratchBuffer, bool reset_descriptors);
+
+    // Implemented in graphics_vulkan_memory.cpp
+    VkResult AllocateDeviceMemory(VkPhysicalDevice vk_physical_device, VkDevice vk_device, const VkMemoryRequirements& vk_memory_req, uint32_t memory_type_index, DeviceMemoryUsage usage, DeviceBuffer::VulkanHandle* handle);
+    void     FreeDeviceMemory(VkDevice vk_device, DeviceBuffer::VulkanHandle* handle);
+    VkResult MapDeviceMemory(VkDevice vk_device, const DeviceBuffer::VulkanHandle& handle, uint32_t offset, uint32_t size, void** data_out);
+    void     UnmapDeviceMemory(VkDevice vk_device, const DeviceBuffer::VulkanHandle& handle);
+    void     DestroyDeviceMemory(VkDevice vk_device);
+    void     GetDeviceMemoryStats(DeviceMemoryStats* stats);
 
     // Implemented in graphics_vulkan_swap_chain.cpp
     //   wantedWidth and wantedHeight might be written to, we might not get the
     //   dimensions we wanted from Vulkan.
-    VkResult UpdateSwapChain(PhysicalDevice* physicalDevice, LogicalDevice* logicalDevice, uint32_t* wantedWidth, uint32_t* wantedHeight, bool wantVSync, SwapChainCapabilities& capabilities, SwapChain* swapChain);
+    //   The old swap chain is retired, and destroyed through oldResources if it's set.
+    VkResult UpdateSwapChain(PhysicalDevice* physicalDevice, LogicalDevice* logicalDevice, uint32_t* wantedWidth, uint32_t* wantedHeight, bool wantVSync, SwapChainCapabilities& capabilities, SwapChain* swapChain, ResourcesToDestroyList* oldResources = 0);
     void     DestroySwapChain(VkDevice vk_device, SwapChain* swapChain);
     void     GetSwapChainCapabilities(VkPhysicalDevice vk_device, const VkSurfaceKHR surface, SwapChainCapabilities& capabilities);
 
@@ -512,6 +652,76 @@ namespace dmGraphics
         vkDeviceWaitIdle(vk_device);
     }
 
+    static inline void PushResourceToDestroy(ResourcesToDestroyList* resource_list, const ResourceToDestroy& resource)
+    {
+        if (resource_list->Full())
+        {
+            resource_list->OffsetCapacity(8);
+        }
+        resource_list->Push(resource);
+    }
+
+    // Called when the command buffer begins, nothing is bound in it yet
+    static inline void ResetCommandBufferBindings(CommandBufferBindings* bindings)
+    {
+        bindings->m_IndexBuffer        = VK_NULL_HANDLE;
+        bindings->m_IndexType          = VK_INDEX_TYPE_UINT16;
+        bindings->m_VertexBufferCount  = 0;
+        bindings->m_PipelineLayout     = VK_NULL_HANDLE;
+        bindings->m_DescriptorSetCount = 0;
+        bindings->m_DynamicOffsetCount = 0;
+    }
+
+    // Returns true if vkCmdBindIndexBuffer has to be recorded
+    static inline bool UpdateBoundIndexBuffer(CommandBufferBindings* bindings, VkBuffer buffer, VkIndexType index_type)
+    {
+        if (bindings->m_IndexBuffer == buffer && bindings->m_IndexType == index_type)
+        {
+            return false;
+        }
+        bindings->m_IndexBuffer = buffer;
+        bindings->m_IndexType   = index_type;
+        return true;
+    }
+
+    // Returns true if vkCmdBindVertexBuffers has to be recorded
+    static inline bool UpdateBoundVertexBuffers(CommandBufferBindings* bindings, const VkBuffer* buffers, const VkDeviceSize* offsets, uint32_t count)
+    {
+        assert(count <= MAX_VERTEX_BUFFERS);
+        if (bindings->m_VertexBufferCount == count &&
+            memcmp(bindings->m_VertexBuffers, buffers, sizeof(VkBuffer) * count) == 0 &&
+            memcmp(bindings->m_VertexBufferOffsets, offsets, sizeof(VkDeviceSize) * count) == 0)
+        {
+            return false;
+        }
+        memcpy(bindings->m_VertexBuffers, buffers, sizeof(VkBuffer) * count);
+        memcpy(bindings->m_VertexBufferOffsets, offsets, sizeof(VkDeviceSize) * count);
+        bindings->m_VertexBufferCount = count;
+        return true;
+    }
+
+    // Returns true if vkCmdBindDescriptorSets has to be recorded. The sets are always bound from set 0.
+    static inline bool UpdateBoundDescriptorSets(CommandBufferBindings* bindings, VkPipelineLayout pipeline_layout,
+        const VkDescriptorSet* sets, uint32_t set_count, const uint32_t* dynamic_offsets, uint32_t dynamic_offset_count)
+    {
+        assert(set_count <= MAX_SET_COUNT);
+        assert(dynamic_offset_count <= MAX_SET_COUNT * MAX_BINDINGS_PER_SET_COUNT);
+        if (bindings->m_PipelineLayout == pipeline_layout &&
+            bindings->m_DescriptorSetCount == set_count &&
+            bindings->m_DynamicOffsetCount == dynamic_offset_count &&
+            memcmp(bindings->m_DescriptorSets, sets, sizeof(VkDescriptorSet) * set_count) == 0 &&
+            memcmp(bindings->m_DynamicOffsets, dynamic_offsets, sizeof(uint32_t) * dynamic_offset_count) == 0)
+        {
+            return false;
+        }
+        bindings->m_PipelineLayout     = pipeline_layout;
+        bindings->m_DescriptorSetCount = set_count;
+        bindings->m_DynamicOffsetCount = dynamic_offset_count;
+        memcpy(bindings->m_DescriptorSets, sets, sizeof(VkDescriptorSet) * set_count);
+        memcpy(bindings->m_DynamicOffsets, dynamic_offsets, sizeof(uint32_t) * dynamic_offset_count);
+        return true;
+    }
+
     // Implemented per supported platform
     const char** GetExtensionNames(uint16_t* num_extensions);
     const char** GetValidationLayers(uint16_t* num_layers, bool use_validation, bool use_renderdoc);
@@ -93,7 +93,7 @@ namespace dmGraphics
 
     VkResult UpdateSwapChain(PhysicalDevice* physicalDevice, LogicalDevice* logicalDevice,
         uint32_t* wantedWidth, uint32_t* wantedHeight,
-        bool wantVSync, SwapChainCapabilities& capabilities, SwapChain* swapChain)
+        bool wantVSync, SwapChainCapabilities& capabilities, SwapChain* swapChain, ResourcesToDestroyList* oldResources)
     {
         VkSwapchainKHR vk_old_swap_chain    = swapChain->m_SwapChain;
         VkDevice vk_device                  = logicalDevice->m_Device;
@@ -220,7 +220,28 @@ namespace dmGraphics
             return res;
         }
 
-        if (vk_old_swap_chain != VK_NULL_HANDLE)
+        if (vk_old_swap_chain != VK_NULL_HANDLE && oldResources)
+        {
+            // The frames in flight may still use the retired swap chain, so it's destroyed when they're done
+            ResourceToDestroy resource;
+            resource.m_ResourceType = RESOURCE_TYPE_TEXTURE;
+            for (uint32_t i=0; i < swapChain->m_ImageViews.Size(); i++)
+            {
+                resource.m_Texture.m_Image     = VK_NULL_HANDLE; // Owned by the swap chain
+                resource.m_Texture.m_ImageView = swapChain->m_ImageViews[i];
+                PushResourceToDestroy(oldResources, resource);
+            }
+            resource.m_Texture = swapChain->m_ResolveTexture->m_Handle;
+            PushResourceToDestroy(oldResources, resource);
+
+            resource.m_ResourceType = RESOURCE_TYPE_SWAP_CHAIN;
+            resource.m_SwapChain    = vk_old_swap_chain;
+            PushResourceToDestroy(oldResources, resource);
+
+            swapChain->m_ResolveTexture->m_Handle.m_Image     = VK_NULL_HANDLE;
+            swapChain->m_ResolveTexture->m_Handle.m_ImageView = VK_NULL_HANDLE;
+        }
+        else if (vk_old_swap_chain != VK_NULL_HANDLE)
         {
             DestroyVkSwapChain(vk_device, vk_old_swap_chain, swapChain->m_ImageViews);
             DestroyTexture(vk_device, &swapChain->m_ResolveTexture->m_Handle);
@@ -93,6 +93,11 @@ static GraphicsAdapter g_webgpu_adapter(ADAPTER_FAMILY_WEBGPU);
 static const int8_t g_webgpu_adapter_priority = 0;
 static WebGPUContext* g_WebGPUContext         = NULL;
 
+// Shorter draw call sequences are encoded directly, a render bundle doesn't save enough calls to pay for itself
+static const uint32_t WEBGPU_RENDER_BUNDLE_MIN_DRAW_CALLS    = 4;
+// Render bundles that haven't been executed for this many frames are released
+static const uint32_t WEBGPU_RENDER_BUNDLE_MAX_UNUSED_FRAMES = 60;
+
 DM_REGISTER_GRAPHICS_ADAPTER(GraphicsAdapterWebGPU, &g_webgpu_adapter, WebGPUIsSupported, WebGPURegisterFunctionTable, WebGPUGetContext, g_webgpu_adapter_priority);
 
 static WGPUSampler WebGPUGetOrCreateSampler(WebGPUContext* context, TextureFilter minfilter, TextureFilter magfilter, TextureWrap uwrap, TextureWrap vwrap, float max_anisotropy)
@@ -903,6 +908,7 @@ static bool InitializeWebGPUContext(WebGPUContext* context, const ContextParams&
     context->m_BindGroupCache.SetCapacity(32, 64);
     context->m_RenderPipelineCache.SetCapacity(32, 64);
     context->m_ComputePipelineCache.SetCapacity(32, 64);
+    context->m_RenderBundleCache.SetCapacity(32, 64);
     SetSwapInterval(context, params.m_SwapInterval);
 
     context->m_TextureFormatSupport |= 1ULL << TEXTURE_FORMAT_RGB; // Transcoded
@@ -990,8 +996,44 @@ static bool InitializeWebGPUContext(WebGPUContext* context, const ContextParams&
     return true;
 }
 
+struct WebGPUReleaseRenderBundlesContext
+{
+    dmArray<uint64_t> m_Keys;
+    uint32_t          m_MinFrame;
+};
+
+static void WebGPUReleaseRenderBundleCallback(WebGPUReleaseRenderBundlesContext* release_context, const uint64_t* key, WebGPURenderBundle* bundle)
+{
+    if (bundle->m_LastUsedFrame < release_context->m_MinFrame)
+    {
+        if (bundle->m_Bundle)
+        {
+            wgpuRenderBundleRelease(bundle->m_Bundle);
+        }
+        if (release_context->m_Keys.Full())
+        {
+            release_context->m_Keys.OffsetCapacity(64);
+        }
+        release_context->m_Keys.Push(*key);
+    }
+}
+
+// The bundles keep their buffers and bind groups alive, so they are released when they are no longer used
+static void WebGPUReleaseRenderBundles(WebGPUContext* context, uint32_t min_frame)
+{
+    TRACE_CALL;
+    WebGPUReleaseRenderBundlesContext release_context;
+    release_context.m_MinFrame = min_frame;
+    context->m_RenderBundleCache.Iterate(WebGPUReleaseRenderBundleCallback, &release_context);
+    for (uint32_t i = 0; i < release_context.m_Keys.Size(); ++i)
+    {
+        context->m_RenderBundleCache.Erase(release_context.m_Keys[i]);
+    }
+}
+
 static void DestroyWebGPUContext(WebGPUContext* context)
 {
+    WebGPUReleaseRenderBundles(context, 0xFFFFFFFF);
     if (context->m_Surface)
         wgpuSurfaceRelease(context->m_Surface);
     if (context->m_Adapter)
@@ -1122,6 +1164,148 @@ static void WebGPUGetDefaultTextureFilters(HContext _context, TextureFilter& out
     out_mag_filter         = context->m_DefaultTextureMagFilter;
 }
 
+static inline void WebGPUEncodeSetPipeline(WGPURenderPassEncoder encoder, WGPURenderPipeline pipeline) { wgpuRenderPassEncoderSetPipeline(encoder, pipeline); }
+static inline void WebGPUEncodeSetPipeline(WGPURenderBundleEncoder encoder, WGPURenderPipeline pipeline) { wgpuRenderBundleEncoderSetPipeline(encoder, pipeline); }
+static inline void WebGPUEncodeSetBindGroup(WGPURenderPassEncoder encoder, uint32_t set, WGPUBindGroup group) { wgpuRenderPassEncoderSetBindGroup(encoder, set, group, 0, 0); }
+static inline void WebGPUEncodeSetBindGroup(WGPURenderBundleEncoder encoder, uint32_t set, WGPUBindGroup group) { wgpuRenderBundleEncoderSetBindGroup(encoder, set, group, 0, 0); }
+static inline void WebGPUEncodeSetVertexBuffer(WGPURenderPassEncoder encoder, uint32_t slot, WGPUBuffer buffer, uint64_t size) { wgpuRenderPassEncoderSetVertexBuffer(encoder, slot, buffer, 0, size); }
+static inline void WebGPUEncodeSetVertexBuffer(WGPURenderBundleEncoder encoder, uint32_t slot, WGPUBuffer buffer, uint64_t size) { wgpuRenderBundleEncoderSetVertexBuffer(encoder, slot, buffer, 0, size); }
+static inline void WebGPUEncodeSetIndexBuffer(WGPURenderPassEncoder encoder, WGPUBuffer buffer, WGPUIndexFormat format, uint64_t size) { wgpuRenderPassEncoderSetIndexBuffer(encoder, buffer, format, 0, size); }
+static inline void WebGPUEncodeSetIndexBuffer(WGPURenderBundleEncoder encoder, WGPUBuffer buffer, WGPUIndexFormat format, uint64_t size) { wgpuRenderBundleEncoderSetIndexBuffer(encoder, buffer, format, 0, size); }
+static inline void WebGPUEncodeDraw(WGPURenderPassEncoder encoder, uint32_t count, uint32_t first) { wgpuRenderPassEncoderDraw(encoder, count, 1, first, 0); }
+static inline void WebGPUEncodeDraw(WGPURenderBundleEncoder encoder, uint32_t count, uint32_t first) { wgpuRenderBundleEncoderDraw(encoder, count, 1, first, 0); }
+static inline void WebGPUEncodeDrawIndexed(WGPURenderPassEncoder encoder, uint32_t count, uint32_t first) { wgpuRenderPassEncoderDrawIndexed(encoder, count, 1, first, 0, 0); }
+static inline void WebGPUEncodeDrawIndexed(WGPURenderBundleEncoder encoder, uint32_t count, uint32_t first) { wgpuRenderBundleEncoderDrawIndexed(encoder, count, 1, first, 0, 0); }
+
+// Encodes the draw calls into a render pass or a render bundle, and only sets the state that differs from the previous draw call
+template <typename Encoder>
+static void WebGPUEncodeDrawCalls(Encoder encoder, const WebGPUDrawCall* draw_calls, uint32_t count)
+{
+    TRACE_CALL;
+    const WebGPUDrawCall* prev = NULL;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const WebGPUDrawCall& draw_call = draw_calls[i];
+        if (!prev || prev->m_Pipeline != draw_call.m_Pipeline)
+        {
+            WebGPUEncodeSetPipeline(encoder, draw_call.m_Pipeline);
+        }
+        for (uint32_t set = 0; set < draw_call.m_BindGroupCount; ++set)
+        {
+            if (draw_call.m_BindGroups[set] && (!prev || prev->m_BindGroups[set] != draw_call.m_BindGroups[set]))
+            {
+                WebGPUEncodeSetBindGroup(encoder, set, draw_call.m_BindGroups[set]);
+            }
+        }
+        for (uint32_t slot = 0; slot < MAX_VERTEX_BUFFERS; ++slot)
+        {
+            if (draw_call.m_VertexBuffers[slot] && (!prev || prev->m_VertexBuffers[slot] != draw_call.m_VertexBuffers[slot] || prev->m_VertexBufferSizes[slot] != draw_call.m_VertexBufferSizes[slot]))
+            {
+                WebGPUEncodeSetVertexBuffer(encoder, slot, draw_call.m_VertexBuffers[slot], draw_call.m_VertexBufferSizes[slot]);
+            }
+        }
+        if (draw_call.m_IndexBuffer)
+        {
+            if (!prev || prev->m_IndexBuffer != draw_call.m_IndexBuffer || prev->m_IndexBufferSize != draw_call.m_IndexBufferSize || prev->m_IndexFormat != draw_call.m_IndexFormat)
+            {
+                WebGPUEncodeSetIndexBuffer(encoder, draw_call.m_IndexBuffer, draw_call.m_IndexFormat, draw_call.m_IndexBufferSize);
+            }
+            WebGPUEncodeDrawIndexed(encoder, draw_call.m_Count, draw_call.m_First);
+        }
+        else
+        {
+            WebGPUEncodeDraw(encoder, draw_call.m_Count, draw_call.m_First);
+        }
+        prev = &draw_call;
+    }
+}
+
+static WGPURenderBundle WebGPUCreateRenderBundle(WebGPUContext* context, const WebGPUDrawCall* draw_calls, uint32_t count)
+{
+    TRACE_CALL;
+    WebGPURenderTarget* target = context->m_CurrentRenderPass.m_Target;
+
+    WGPUTextureFormat color_formats[MAX_BUFFER_COLOR_ATTACHMENTS];
+    for (int i = 0; i < target->m_ColorBufferCount; ++i)
+    {
+        WebGPUTexture* texture = GetAssetFromContainer<WebGPUTexture>(context->m_AssetHandleContainer, target->m_TextureColor[i]);
+        color_formats[i]       = texture->m_Format;
+    }
+
+    WGPURenderBundleEncoderDescriptor desc = {};
+    desc.colorFormats       = color_formats;
+    desc.colorFormatCount   = target->m_ColorBufferCount;
+    desc.depthStencilFormat = WGPUTextureFormat_Undefined;
+    desc.sampleCount        = target->m_Multisample;
+    if (target->m_TextureDepthStencil)
+    {
+        WebGPUTexture* texture  = GetAssetFromContainer<WebGPUTexture>(context->m_AssetHandleContainer, target->m_TextureDepthStencil);
+        desc.depthStencilFormat = texture->m_Format;
+    }
+
+    WGPURenderBundleEncoder encoder = wgpuDeviceCreateRenderBundleEncoder(context->m_Device, &desc);
+    WebGPUEncodeDrawCalls(encoder, draw_calls, count);
+    WGPURenderBundle bundle = wgpuRenderBundleEncoderFinish(encoder, NULL);
+    wgpuRenderBundleEncoderRelease(encoder);
+    return bundle;
+}
+
+// Encodes the pending draw calls of the current render pass. A sequence of draw calls that has been seen before, in this or
+// an earlier frame, is recorded into a render bundle once and then executed with a single call.
+static void WebGPUFlushDrawCalls(WebGPUContext* context)
+{
+    TRACE_CALL;
+    const uint32_t count = context->m_PendingDrawCalls.Size();
+    if (count == 0)
+    {
+        return;
+    }
+
+    const WebGPUDrawCall* draw_calls = context->m_PendingDrawCalls.Begin();
+    WGPURenderPassEncoder encoder    = context->m_CurrentRenderPass.m_Encoder;
+    context->m_PendingDrawCalls.SetSize(0);
+
+    if (count < WEBGPU_RENDER_BUNDLE_MIN_DRAW_CALLS)
+    {
+        WebGPUEncodeDrawCalls(encoder, draw_calls, count);
+        return;
+    }
+
+    HashState64 bundle_hash_state;
+    dmHashInit64(&bundle_hash_state, false);
+    dmHashUpdateBuffer64(&bundle_hash_state, &context->m_CurrentRenderPass.m_Target, sizeof(context->m_CurrentRenderPass.m_Target));
+    dmHashUpdateBuffer64(&bundle_hash_state, draw_calls, sizeof(WebGPUDrawCall) * count);
+    const uint64_t bundle_hash = dmHashFinal64(&bundle_hash_state);
+
+    WebGPURenderBundle* bundle = context->m_RenderBundleCache.Get(bundle_hash);
+    if (!bundle)
+    {
+        WebGPURenderBundle new_bundle = {};
+        new_bundle.m_LastUsedFrame    = context->m_FrameIndex;
+        if (context->m_RenderBundleCache.Full())
+            context->m_RenderBundleCache.SetCapacity(32, context->m_RenderBundleCache.Capacity() + 16);
+        context->m_RenderBundleCache.Put(bundle_hash, new_bundle);
+        WebGPUEncodeDrawCalls(encoder, draw_calls, count);
+        return;
+    }
+
+    if (!bundle->m_Bundle)
+    {
+        bundle->m_Bundle = WebGPUCreateRenderBundle(context, draw_calls, count);
+    }
+    bundle->m_LastUsedFrame = context->m_FrameIndex;
+    wgpuRenderPassEncoderExecuteBundles(encoder, 1, &bundle->m_Bundle);
+}
+
+static void WebGPUPushDrawCall(WebGPUContext* context, const WebGPUDrawCall& draw_call)
+{
+    if (context->m_PendingDrawCalls.Full())
+    {
+        context->m_PendingDrawCalls.OffsetCapacity(64);
+    }
+    context->m_PendingDrawCalls.Push(draw_call);
+}
+
 static void WebGPUEndRenderPass(WebGPUContext* context);
 
 static void WebGPUEndComputePass(WebGPUContext* context)
@@ -1152,6 +1336,7 @@ static void WebGPUEndRenderPass(WebGPUContext* context)
     if (context->m_CurrentRenderPass.m_Encoder)
     {
         assert(context->m_CurrentRenderPass.m_Target);
+        WebGPUFlushDrawCalls(context);
         wgpuRenderPassEncoderEnd(context->m_CurrentRenderPass.m_Encoder);
         wgpuRenderPassEncoderRelease(context->m_CurrentRenderPass.m_Encoder);
         memset(&context->m_CurrentRenderPass, 0, sizeof(context->m_CurrentRenderPass));
@@ -1250,6 +1435,7 @@ static void WebGPUBeginRenderPass(WebGPUContext* context, const float* clearColo
 
     if (context->m_ViewportChanged)
     {
+        WebGPUFlushDrawCalls(context);
         const int32_t vx1 = dmMath::Clamp(context->m_ViewportRect[0], 0, int32_t(context->m_CurrentRenderPass.m_Target->m_Width));
         const int32_t vy1 = dmMath::Clamp(context->m_ViewportRect[1], 0, int32_t(context->m_CurrentRenderPass.m_Target->m_Height));
         const int32_t vx2 = dmMath::Clamp(context->m_ViewportRect[2], 0, int32_t(context->m_CurrentRenderPass.m_Target->m_Width));
@@ -1258,8 +1444,12 @@ static void WebGPUBeginRenderPass(WebGPUContext* context, const float* clearColo
         wgpuRenderPassEncoderSetScissorRect(context->m_CurrentRenderPass.m_Encoder, context->m_CurrentRenderPass.m_Target->m_Scissor[0], context->m_CurrentRenderPass.m_Target->m_Scissor[1], context->m_CurrentRenderPass.m_Target->m_Scissor[2], context->m_CurrentRenderPass.m_Target->m_Scissor[3]);
         context->m_ViewportChanged = 0;
     }
-    if (context->m_CurrentPipelineState.m_StencilReference)
+    if (context->m_CurrentPipelineState.m_StencilReference != context->m_CurrentRenderPass.m_StencilReference)
+    {
+        WebGPUFlushDrawCalls(context);
         wgpuRenderPassEncoderSetStencilReference(context->m_CurrentRenderPass.m_Encoder, context->m_CurrentPipelineState.m_StencilReference);
+        context->m_CurrentRenderPass.m_StencilReference = context->m_CurrentPipelineState.m_StencilReference;
+    }
 }
 
 static void WebGPUClear(HContext _context, uint32_t flags, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha, float depth, uint32_t stencil)
@@ -1337,6 +1527,11 @@ static void WebGPUFlip(HContext _context)
             context->m_CurrentUniforms.m_Alloc = 0;
         }
     }
+
+    if (++context->m_FrameIndex % WEBGPU_RENDER_BUNDLE_MAX_UNUSED_FRAMES == 0)
+    {
+        WebGPUReleaseRenderBundles(context, context->m_FrameIndex - WEBGPU_RENDER_BUNDLE_MAX_UNUSED_FRAMES);
+    }
     dmPlatform::SwapBuffers(context->m_Window);
 }
 
@@ -1359,7 +1554,8 @@ static HVertexBuffer WebGPUNewVertexBuffer(HContext _context, uint32_t size, con
 {
     TRACE_CALL;
     WebGPUContext* context     = (WebGPUContext*)_context;
-    WGPUBufferUsageFlags usage = WGPUBufferUsage(WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst);
+    // Vertex buffers can also hold the group counts for DispatchComputeIndirect, written by compute programs
+    WGPUBufferUsageFlags usage = WGPUBufferUsage(WGPUBufferUsage_Vertex | WGPUBufferUsage_Indirect | WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst);
     if (buffer_usage & BUFFER_USAGE_TRANSFER)
         usage |= WGPUBufferUsage_CopySrc;
     WebGPUBuffer* buffer = new WebGPUBuffer(usage);
@@ -1785,46 +1981,41 @@ static void WebGPUSetupComputePipeline(WebGPUContext* context)
     }
 }
 
-static void WebGPUSetupRenderPipeline(WebGPUContext* context, WebGPUBuffer* indexBuffer, Type indexBufferType)
+static void WebGPUSetupRenderPipeline(WebGPUContext* context, WebGPUBuffer* indexBuffer, Type indexBufferType, WebGPUDrawCall* draw_call)
 {
     TRACE_CALL;
     WebGPUBeginRenderPass(context);
     WebGPUUpdateBindGroups(context);
 
+    memset(draw_call, 0, sizeof(*draw_call));
+
     // Get the pipeline for the active draw state
-    WGPURenderPipeline pipeline = WebGPUGetOrCreateRenderPipeline(context);
-    if (pipeline != context->m_CurrentRenderPass.m_Pipeline)
-    {
-        wgpuRenderPassEncoderSetPipeline(context->m_CurrentRenderPass.m_Encoder, pipeline);
-        context->m_CurrentRenderPass.m_Pipeline = pipeline;
-    }
+    draw_call->m_Pipeline = WebGPUGetOrCreateRenderPipeline(context);
 
-    // Set the indexbuffer
-    if (indexBuffer && indexBuffer != context->m_CurrentRenderPass.m_IndexBuffer)
+    // The indexbuffer
+    if (indexBuffer)
     {
         assert(indexBufferType == TYPE_UNSIGNED_SHORT || indexBufferType == TYPE_UNSIGNED_INT);
-        wgpuRenderPassEncoderSetIndexBuffer(context->m_CurrentRenderPass.m_Encoder, indexBuffer->m_Buffer, indexBufferType == TYPE_UNSIGNED_INT ? WGPUIndexFormat_Uint32 : WGPUIndexFormat_Uint16, 0, indexBuffer->m_Used);
-        context->m_CurrentRenderPass.m_IndexBuffer = indexBuffer;
+        draw_call->m_IndexBuffer     = indexBuffer->m_Buffer;
+        draw_call->m_IndexBufferSize = indexBuffer->m_Used;
+        draw_call->m_IndexFormat     = indexBufferType == TYPE_UNSIGNED_INT ? WGPUIndexFormat_Uint32 : WGPUIndexFormat_Uint16;
     }
 
-    // Set the vertexbuffer(s)
+    // The vertexbuffer(s)
     for (int slot = 0; slot < MAX_VERTEX_BUFFERS; ++slot)
     {
-        if (context->m_CurrentVertexBuffers[slot] && context->m_CurrentVertexBuffers[slot] != context->m_CurrentRenderPass.m_VertexBuffers[slot])
+        if (context->m_CurrentVertexBuffers[slot])
         {
-            wgpuRenderPassEncoderSetVertexBuffer(context->m_CurrentRenderPass.m_Encoder, slot, context->m_CurrentVertexBuffers[slot]->m_Buffer, 0, context->m_CurrentVertexBuffers[slot]->m_Used);
-            context->m_CurrentRenderPass.m_VertexBuffers[slot] = context->m_CurrentVertexBuffers[slot];
+            draw_call->m_VertexBuffers[slot]     = context->m_CurrentVertexBuffers[slot]->m_Buffer;
+            draw_call->m_VertexBufferSizes[slot] = context->m_CurrentVertexBuffers[slot]->m_Used;
         }
     }
 
-    // Set the bind groups
+    // The bind groups
+    draw_call->m_BindGroupCount = context->m_CurrentProgram->m_MaxSet;
     for (int set = 0; set < context->m_CurrentProgram->m_MaxSet; ++set)
     {
-        if (context->m_CurrentProgram->m_BindGroups[set] && context->m_CurrentProgram->m_BindGroups[set] != context->m_CurrentRenderPass.m_BindGroups[set])
-        {
-            wgpuRenderPassEncoderSetBindGroup(context->m_CurrentRenderPass.m_Encoder, set, context->m_CurrentProgram->m_BindGroups[set], 0, 0);
-            context->m_CurrentRenderPass.m_BindGroups[set] = context->m_CurrentProgram->m_BindGroups[set];
-        }
+        draw_call->m_BindGroups[set] = context->m_CurrentProgram->m_BindGroups[set];
     }
 }
 
@@ -1836,8 +2027,11 @@ static void WebGPUDrawElements(HContext _context, PrimitiveType prim_type, uint3
     // TODO: Instancing!
     WebGPUContext* context                         = (WebGPUContext*)_context;
     context->m_CurrentPipelineState.m_PrimtiveType = prim_type;
-    WebGPUSetupRenderPipeline(context, (WebGPUBuffer*)index_buffer, type);
-    wgpuRenderPassEncoderDrawIndexed(context->m_CurrentRenderPass.m_Encoder, count, 1, first / (type == TYPE_UNSIGNED_SHORT ? 2 : 4), 0, 0);
+    WebGPUDrawCall draw_call;
+    WebGPUSetupRenderPipeline(context, (WebGPUBuffer*)index_buffer, type, &draw_call);
+    draw_call.m_First = first / (type == TYPE_UNSIGNED_SHORT ? 2 : 4);
+    draw_call.m_Count = count;
+    WebGPUPushDrawCall(context, draw_call);
 }
 
 static void WebGPUDraw(HContext _context, PrimitiveType prim_type, uint32_t first, uint32_t count, uint32_t instance_count)
@@ -1847,8 +2041,11 @@ static void WebGPUDraw(HContext _context, PrimitiveType prim_type, uint32_t firs
     // TODO: Instancing!
     WebGPUContext* context                         = (WebGPUContext*)_context;
     context->m_CurrentPipelineState.m_PrimtiveType = prim_type;
-    WebGPUSetupRenderPipeline(context, NULL, TYPE_BYTE);
-    wgpuRenderPassEncoderDraw(context->m_CurrentRenderPass.m_Encoder, count, 1, first, 0);
+    WebGPUDrawCall draw_call;
+    WebGPUSetupRenderPipeline(context, NULL, TYPE_BYTE, &draw_call);
+    draw_call.m_First = first;
+    draw_call.m_Count = count;
+    WebGPUPushDrawCall(context, draw_call);
 }
 
 static void WebGPUDispatchCompute(HContext _context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
@@ -1859,6 +2056,16 @@ static void WebGPUDispatchCompute(HContext _context, uint32_t group_count_x, uin
     wgpuComputePassEncoderDispatchWorkgroups(context->m_CurrentComputePass.m_Encoder, group_count_x, group_count_y, group_count_z);
 }
 
+static void WebGPUDispatchComputeIndirect(HContext _context, HVertexBuffer indirect_buffer, uint32_t indirect_offset)
+{
+    TRACE_CALL;
+    WebGPUContext* context = (WebGPUContext*)_context;
+    WebGPUBuffer* buffer   = (WebGPUBuffer*)indirect_buffer;
+    assert(buffer && buffer->m_Buffer);
+    WebGPUSetupComputePipeline(context);
+    wgpuComputePassEncoderDispatchWorkgroupsIndirect(context->m_CurrentComputePass.m_Encoder, buffer->m_Buffer, indirect_offset);
+}
+
 static bool WebGPUCreateShaderModuleFromDDF(WebGPUContext* context, WebGPUShaderModule* shader, ShaderDesc* ddf)
 {
     TRACE_CALL;
@@ -2384,7 +2591,7 @@ static void WebGPUSetConstantV4(HContext _context, const Vector4* data, int coun
 
     const ProgramResourceBinding& pgm_res   = context->m_CurrentProgram->m_ResourceBindings[set][binding];
     const ShaderResourceTypeInfo& type_info = (*pgm_res.m_TypeInfos)[pgm_res.m_Res->m_Type.m_TypeIndex];
-    if (memcpy(context->m_CurrentProgram->m_UniformData + pgm_res.m_DataOffset + type_info.m_Members[member].m_Offset,
+    if (memcmp(context->m_CurrentProgram->m_UniformData + pgm_res.m_DataOffset + type_info.m_Members[member].m_Offset,
                (uint8_t*)data,
                sizeof(dmVMath::Vector4) * count))
     {
@@ -2673,6 +2880,8 @@ static void WebGPUDeleteRenderTarget(HRenderTarget _rt)
     }
     if (rt->m_TextureDepthStencil)
         WebGPUDeleteTexture(rt->m_TextureDepthStencil);
+    // The cached render bundles are keyed on the render target address, which may be reused by a new target
+    WebGPUReleaseRenderBundles(g_WebGPUContext, 0xFFFFFFFF);
     delete rt;
     g_WebGPUContext->m_AssetHandleContainer.Release(_rt);
 }
@@ -3020,5 +3229,6 @@ static GraphicsAdapterFunctionTable WebGPURegisterFunctionTable()
 {
     GraphicsAdapterFunctionTable fn_table = {};
     DM_REGISTER_GRAPHICS_FUNCTION_TABLE(fn_table, WebGPU);
+    DM_REGISTER_GRAPHICS_FUNCTION(fn_table, WebGPU, DispatchComputeIndirect);
     return fn_table;
 }
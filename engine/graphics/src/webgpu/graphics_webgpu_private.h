@@ -157,12 +157,32 @@ namespace dmGraphics
 
     struct WebGPURenderPass
     {
-        WGPUBindGroup         m_BindGroups[MAX_SET_COUNT];
-        WebGPUBuffer*         m_VertexBuffers[MAX_VERTEX_BUFFERS];
         WebGPURenderTarget*   m_Target;
         WGPURenderPassEncoder m_Encoder;
-        WGPURenderPipeline    m_Pipeline;
-        WebGPUBuffer*         m_IndexBuffer;
+        uint32_t              m_StencilReference;
+    };
+
+    // The state of a draw call in a render pass. The draw calls are encoded when the pass state changes or the pass ends,
+    // so that a sequence that was also drawn in an earlier frame can be replayed from a render bundle.
+    // Zero initialized before it is filled in, since the whole struct is hashed.
+    struct WebGPUDrawCall
+    {
+        WGPURenderPipeline m_Pipeline;
+        WGPUBindGroup      m_BindGroups[MAX_SET_COUNT];
+        WGPUBuffer         m_VertexBuffers[MAX_VERTEX_BUFFERS];
+        uint64_t           m_VertexBufferSizes[MAX_VERTEX_BUFFERS];
+        WGPUBuffer         m_IndexBuffer;
+        uint64_t           m_IndexBufferSize;
+        WGPUIndexFormat    m_IndexFormat;
+        uint32_t           m_First;
+        uint32_t           m_Count;
+        uint32_t           m_BindGroupCount;
+    };
+
+    struct WebGPURenderBundle
+    {
+        WGPURenderBundle m_Bundle;        // NULL until the draw call sequence has been seen twice
+        uint32_t         m_LastUsedFrame;
     };
 
     struct WebGPUTextureSampler
@@ -182,6 +202,8 @@ namespace dmGraphics
         dmHashTable64<WGPUComputePipeline> m_ComputePipelineCache;
         dmHashTable64<WGPUBindGroup>       m_BindGroupCache;
         dmHashTable64<WGPUSampler>         m_SamplerCache;
+        dmHashTable64<WebGPURenderBundle>  m_RenderBundleCache;
+        dmArray<WebGPUDrawCall>            m_PendingDrawCalls;
 
         dmPlatform::HWindow                m_Window;
 
@@ -223,6 +245,7 @@ namespace dmGraphics
         WebGPUProgram*      m_CurrentProgram;
         WebGPURenderTarget* m_CurrentRenderTarget;
 
+        uint32_t            m_FrameIndex;
         uint32_t            m_OriginalWidth;
         uint32_t            m_OriginalHeight;
         uint32_t            m_Width;
@@ -26,6 +26,7 @@
 #include <dlib/hash.h>
 #include <dlib/hashtable.h>
 #include <dlib/math.h>
+#include <dlib/memory.h>
 #include <dlib/vmath.h>
 #include <dlib/transform.h>
 #include <dlib/message.h>
@@ -304,7 +305,7 @@ namespace dmGui
     void SetDefaultNewSceneParams(NewSceneParams* params)
     {
         memset(params, 0, sizeof(*params));
-        // The default max value for a scene is 512 (same as in gui_ddf.proto). Absolute max value is 2^INDEX_RANGE.
+        // The default max value for a scene is 512 (same as in gui_ddf.proto). Absolute max value is MAX_NODE_COUNT.
         params->m_MaxNodes           = 512;
         params->m_MaxAnimations      = 128;
         params->m_MaxTextures        = 32;
@@ -327,6 +328,7 @@ namespace dmGui
 
     HScene NewScene(HContext context, const NewSceneParams* params)
     {
+        DM_MEMORY_TAG(dmMemory::TAG_GUI);
         lua_State* L = context->m_LuaState;
         int top = lua_gettop(L);
         (void) top;
@@ -356,8 +358,10 @@ namespace dmGui
         scene->m_Context = context;
         scene->m_Script = 0x0;
         scene->m_ParticlefxContext = params->m_ParticlefxContext;
+        assert(params->m_MaxNodes <= MAX_NODE_COUNT);
         scene->m_Nodes.SetCapacity(params->m_MaxNodes);
         scene->m_NodePool.SetCapacity(params->m_MaxNodes);
+        scene->m_NodeIdIndex.SetCapacity(dmMath::Max(1U, (params->m_MaxNodes*2)/3), dmMath::Max(1U, params->m_MaxNodes));
         scene->m_Animations.SetCapacity(params->m_MaxAnimations);
         scene->m_Textures.SetCapacity(params->m_MaxTextures*2, params->m_MaxTextures);
         scene->m_DynamicTextures.SetCapacity(params->m_MaxDynamicTextures*2, params->m_MaxDynamicTextures);
@@ -374,6 +378,7 @@ namespace dmGui
         scene->m_RenderTail = INVALID_INDEX;
         scene->m_NextVersionNumber = 0;
         scene->m_RenderOrder = 0;
+        scene->m_RenderEntriesDirty = 1;
         scene->m_Width = context->m_DefaultProjectWidth;
         scene->m_Height = context->m_DefaultProjectHeight;
         scene->m_FetchTextureSetAnimCallback = params->m_FetchTextureSetAnimCallback;
@@ -839,6 +844,7 @@ namespace dmGui
             if (nodes[i].m_Node.m_LayerHash == layer_hash)
                 nodes[i].m_Node.m_LayerIndex = index;
         }
+        scene->m_RenderEntriesDirty = 1;
         return RESULT_OK;
     }
 
@@ -938,6 +944,7 @@ namespace dmGui
             set_node_callback(scene, GetNodeHandle(n), n->m_Node.m_NodeDescTable[index]);
             n->m_Node.m_DirtyLocal = 1;
         }
+        scene->m_RenderEntriesDirty = 1;
         return RESULT_OK;
     }
 
@@ -1259,18 +1266,16 @@ namespace dmGui
         }
     }
 
-    static uint16_t CollectRenderEntries(HScene scene, uint16_t start_index, uint16_t order, dmArray<InternalClippingNode>& clippers, dmArray<RenderEntry>& render_entries) {
+    // The order is 32 bits, since clippers and particlefx emitters use more than one render key per node (see INDEX_RANGE)
+    static uint32_t CollectRenderEntries(HScene scene, uint16_t start_index, uint32_t order, dmArray<InternalClippingNode>& clippers, dmArray<RenderEntry>& render_entries) {
         #define PUSH_RENDER_ENTRY(e) \
-            if (render_entries.Full()) \
-                render_entries.OffsetCapacity(16U); \
-            render_entries.Push(e);
+            render_entries.PushGrow(e);
 
         uint16_t index = start_index;
-        uint32_t active_nodes = 0;
         while (index != INVALID_INDEX) {
             InternalNode* n = &scene->m_Nodes[index];
             if (n->m_Node.m_Enabled) {
-                ++active_nodes;
+                ++scene->m_ActiveNodeCount;
                 HNode node = GetNodeHandle(n);
                 uint16_t layer = GetLayerIndex(scene, n);
                 if (n->m_ClipperIndex != INVALID_INDEX) {
@@ -1343,14 +1348,23 @@ namespace dmGui
         }
         #undef PUSH_RENDER_ENTRY
 
-        DM_PROPERTY_ADD_U32(rmtp_GuiActiveNodes, active_nodes);
         return order;
     }
 
     static void CollectNodes(HScene scene, dmArray<InternalClippingNode>& clippers, dmArray<RenderEntry>& render_entries)
     {
+        // There is at most one clipper per node
+        if (clippers.Capacity() < scene->m_Nodes.Size())
+        {
+            clippers.SetCapacity(scene->m_Nodes.Size());
+        }
+        clippers.SetSize(0);
+        render_entries.SetSize(0);
+        scene->m_ActiveNodeCount = 0;
+
         CollectClippers(scene, scene->m_RenderHead, 0, 0, clippers, INVALID_INDEX);
         CollectRenderEntries(scene, scene->m_RenderHead, 0, clippers, render_entries);
+        std::sort(render_entries.Begin(), render_entries.End(), RenderEntrySortPred());
     }
 
     static inline bool IsVisible(InternalNode* n, float opacity)
@@ -1362,12 +1376,12 @@ namespace dmGui
 
     void RenderScene(HScene scene, const RenderSceneParams& params, void* context)
     {
+        DM_MEMORY_TAG(dmMemory::TAG_GUI);
         Context* c = scene->m_Context;
 
         c->m_RenderNodes.SetSize(0);
         c->m_RenderTransforms.SetSize(0);
         c->m_RenderOpacities.SetSize(0);
-        c->m_StencilClippingNodes.SetSize(0);
         c->m_StencilScopes.SetSize(0);
         c->m_StencilScopeIndices.SetSize(0);
         uint32_t capacity = scene->m_NodePool.Size() * 2;
@@ -1378,7 +1392,6 @@ namespace dmGui
             c->m_RenderOpacities.SetCapacity(capacity);
             c->m_SceneTraversalCache.m_Data.SetCapacity(capacity);
             c->m_SceneTraversalCache.m_Data.SetSize(capacity);
-            c->m_StencilClippingNodes.SetCapacity(capacity);
             c->m_StencilScopes.SetCapacity(capacity);
             c->m_StencilScopeIndices.SetCapacity(capacity);
         }
@@ -1389,9 +1402,26 @@ namespace dmGui
             c->m_SceneTraversalCache.m_Version = 0;
         }
 
-        CollectNodes(scene, c->m_StencilClippingNodes, c->m_RenderNodes);
-        uint32_t node_count = c->m_RenderNodes.Size();
-        std::sort(c->m_RenderNodes.Begin(), c->m_RenderNodes.End(), RenderEntrySortPred());
+        // The render entries only depend on the structure of the scene, so they are only collected again when that changes.
+        // The emitters of the particlefx nodes come and go without the scene knowing, so those scenes are always collected.
+        if (scene->m_RenderEntriesDirty || scene->m_AliveParticlefxs.Size() != 0)
+        {
+            CollectNodes(scene, scene->m_ClippingNodes, scene->m_RenderEntries);
+            scene->m_RenderEntriesDirty = 0;
+        }
+        DM_PROPERTY_ADD_U32(rmtp_GuiActiveNodes, scene->m_ActiveNodeCount);
+
+        // The entries are pruned below, so we work on a copy
+        uint32_t node_count = scene->m_RenderEntries.Size();
+        if (c->m_RenderNodes.Capacity() < node_count)
+        {
+            c->m_RenderNodes.SetCapacity(node_count);
+        }
+        c->m_RenderNodes.SetSize(node_count);
+        if (node_count)
+        {
+            memcpy(c->m_RenderNodes.Begin(), scene->m_RenderEntries.Begin(), sizeof(RenderEntry) * node_count);
+        }
         Matrix4 transform;
 
         if (c->m_RenderNodes.Capacity() > c->m_RenderTransforms.Capacity())
@@ -1401,7 +1431,6 @@ namespace dmGui
             c->m_RenderOpacities.SetCapacity(new_capacity);
             c->m_SceneTraversalCache.m_Data.SetCapacity(new_capacity);
             c->m_SceneTraversalCache.m_Data.SetSize(new_capacity);
-            c->m_StencilClippingNodes.SetCapacity(new_capacity);
             c->m_StencilScopes.SetCapacity(new_capacity);
             c->m_StencilScopeIndices.SetCapacity(new_capacity);
         }
@@ -1434,12 +1463,12 @@ namespace dmGui
             c->m_RenderTransforms.Push(transform);
             c->m_RenderOpacities.Push(opacity);
             if (n->m_ClipperIndex != INVALID_INDEX) {
-                InternalClippingNode* clipper = &c->m_StencilClippingNodes[n->m_ClipperIndex];
+                InternalClippingNode* clipper = &scene->m_ClippingNodes[n->m_ClipperIndex];
                 if (clipper->m_NodeIndex == index) {
                     if (clipper->m_VisibleRenderKey == entry.m_RenderKey) {
                         StencilScope* scope = 0x0;
                         if (clipper->m_ParentIndex != INVALID_INDEX) {
-                            scope = &c->m_StencilClippingNodes[clipper->m_ParentIndex].m_ChildScope;
+                            scope = &scene->m_ClippingNodes[clipper->m_ParentIndex].m_ChildScope;
                         }
                         c->m_StencilScopes.Push(scope);
                     } else {
@@ -1725,7 +1754,7 @@ namespace dmGui
                     if (message->m_Descriptor)
                     {
                         message_name = ((const dmDDF::Descriptor*)message->m_Descriptor)->m_Name;
-                        dmScript::PushDDF(L, (dmDDF::Descriptor*)message->m_Descriptor, (const char*) message->m_Data, true);
+                        dmScript::PushDDF(L, (dmDDF::Descriptor*)message->m_Descriptor, (const char*) dmMessage::GetData(message), true);
                     }
                     else
                     {
@@ -1736,7 +1765,7 @@ namespace dmGui
                         }
                         if (message->m_DataSize > 0)
                         {
-                            dmScript::PushTable(L, (const char*) message->m_Data, message->m_DataSize);
+                            dmScript::PushTable(L, (const char*) dmMessage::GetData(message), message->m_DataSize);
                         }
                         else
                         {
@@ -1840,6 +1869,13 @@ namespace dmGui
                         lua_pushstring(L, "repeated");
                         lua_pushboolean(L, ia->m_Repeated);
                         lua_rawset(L, -3);
+
+                        if (ia->m_Timestamp != 0)
+                        {
+                            lua_pushstring(L, "timestamp");
+                            lua_pushnumber(L, ia->m_Timestamp / 1000000.0);
+                            lua_rawset(L, -3);
+                        }
                     }
 
                     if (ia->m_PositionSet)
@@ -2072,6 +2108,7 @@ namespace dmGui
 
     Result UpdateScene(HScene scene, float dt)
     {
+        DM_MEMORY_TAG(dmMemory::TAG_GUI);
         Result result = RunScript(scene, SCRIPT_FUNCTION_UPDATE, LUA_NOREF, (void*)&dt);
 
         uint32_t node_count = scene->m_Nodes.Size();
@@ -2370,6 +2407,8 @@ namespace dmGui
     {
         InternalNode* n = GetNode(scene, node);
         n->m_NameHash = id;
+        // Another node may already be cached for this id, and GetNodeById should still return the first one
+        scene->m_NodeIdIndex.Erase(id);
     }
 
     void SetNodeId(HScene scene, HNode node, const char* id)
@@ -2389,10 +2428,32 @@ namespace dmGui
         return GetNodeById(scene, name_hash);
     }
 
+    static inline void CacheNodeId(HScene scene, dmhash_t id, uint16_t index)
+    {
+        if (!scene->m_NodeIdIndex.Full())
+            scene->m_NodeIdIndex.Put(id, index);
+    }
+
     HNode GetNodeById(HScene scene, dmhash_t id)
     {
         uint32_t n = scene->m_Nodes.Size();
         InternalNode* nodes = scene->m_Nodes.Begin();
+
+        // The cached index is only a hint. Nodes are deleted and reused without updating the cache,
+        // so we make sure it's still a live node with the same id
+        uint16_t* cached_index = scene->m_NodeIdIndex.Get(id);
+        if (cached_index)
+        {
+            uint16_t index = *cached_index;
+            if (index < n)
+            {
+                InternalNode* node = &nodes[index];
+                if (node->m_NameHash == id && node->m_Index == index && !node->m_Deleted)
+                    return GetNodeHandle(node);
+            }
+            scene->m_NodeIdIndex.Erase(id);
+        }
+
         HNode foundNode = 0;
         for (uint32_t i = 0; i < n; ++i)
         {
@@ -2407,6 +2468,7 @@ namespace dmGui
                 // another one
                 if (!node->m_Deleted)
                 {
+                    CacheNodeId(scene, id, (uint16_t)i);
                     break;
                 }
             }
@@ -2424,6 +2486,11 @@ namespace dmGui
         return scene->m_AliveParticlefxs.Size();
     }
 
+    uint32_t GetAnimationCount(HScene scene)
+    {
+        return scene->m_Animations.Size();
+    }
+
     static void GetNodeList(HScene scene, InternalNode* n, uint16_t** out_head, uint16_t** out_tail)
     {
         if (n->m_ParentIndex != INVALID_INDEX)
@@ -2441,6 +2508,7 @@ namespace dmGui
 
     static void AddToNodeList(HScene scene, InternalNode* n, InternalNode* parent_n, InternalNode* prev_n)
     {
+        scene->m_RenderEntriesDirty = 1;
         uint16_t* head = &scene->m_RenderHead, * tail = &scene->m_RenderTail;
         uint16_t parent_index = INVALID_INDEX;
         if (parent_n != 0x0)
@@ -2485,6 +2553,7 @@ namespace dmGui
 
     static void RemoveFromNodeList(HScene scene, InternalNode* n)
     {
+        scene->m_RenderEntriesDirty = 1;
         // Remove from list
         if (n->m_PrevIndex != INVALID_INDEX)
             scene->m_Nodes[n->m_PrevIndex].m_NextIndex = n->m_NextIndex;
@@ -2609,7 +2678,9 @@ namespace dmGui
         scene->m_RenderHead = INVALID_INDEX;
         scene->m_RenderTail = INVALID_INDEX;
         scene->m_NodePool.Clear();
+        scene->m_NodeIdIndex.Clear();
         scene->m_Animations.SetSize(0);
+        scene->m_RenderEntriesDirty = 1;
     }
 
     static Vector4 ApplyAdjustOnReferenceScale(const Vector4& reference_scale, uint32_t adjust_mode)
@@ -2761,6 +2832,8 @@ namespace dmGui
             }
         }
         scene->m_Animations.SetSize(0);
+        // The reset state has the enabled and clipping flags
+        scene->m_RenderEntriesDirty = 1;
     }
 
     uint16_t GetRenderOrder(HScene scene)
@@ -3195,6 +3268,7 @@ namespace dmGui
             InternalNode* n = GetNode(scene, node);
             n->m_Node.m_LayerHash = layer_id;
             n->m_Node.m_LayerIndex = *layer_index;
+            scene->m_RenderEntriesDirty = 1;
             return RESULT_OK;
         }
         else
@@ -3367,6 +3441,7 @@ namespace dmGui
     {
         InternalNode* n = GetNode(scene, node);
         n->m_Node.m_ClippingMode = mode;
+        scene->m_RenderEntriesDirty = 1;
     }
 
     ClippingMode GetNodeClippingMode(HScene scene, HNode node)
@@ -3379,6 +3454,7 @@ namespace dmGui
     {
         InternalNode* n = GetNode(scene, node);
         n->m_Node.m_ClippingVisible = (uint32_t) visible;
+        scene->m_RenderEntriesDirty = 1;
     }
 
     bool GetNodeClippingVisible(HScene scene, HNode node)
@@ -3391,6 +3467,7 @@ namespace dmGui
     {
         InternalNode* n = GetNode(scene, node);
         n->m_Node.m_ClippingInverted = (uint32_t) inverted;
+        scene->m_RenderEntriesDirty = 1;
     }
 
     bool GetNodeClippingInverted(HScene scene, HNode node)
@@ -3976,6 +4053,7 @@ namespace dmGui
     {
         InternalNode* n = GetNode(scene, node);
         n->m_Node.m_Enabled = enabled;
+        scene->m_RenderEntriesDirty = 1;
         if(enabled)
         {
             SetDirtyLocalRecursive(scene, node);
@@ -4229,6 +4307,7 @@ namespace dmGui
         out_n->m_ChildHead = INVALID_INDEX;
         out_n->m_ChildTail = INVALID_INDEX;
         scene->m_NextVersionNumber = (version + 1) % ((1 << 16) - 1);
+        CacheNodeId(scene, out_n->m_NameHash, index); // The generated id is unique
 
         if (n->m_Node.m_CustomType != 0)
         {
@@ -177,6 +177,9 @@ namespace dmGui
     struct NewSceneParams;
     void SetDefaultNewSceneParams(NewSceneParams* params);
 
+    /// Max number of nodes in a scene, the node index is stored in 16 bits of the node handle
+    const uint32_t MAX_NODE_COUNT = 0xffff;
+
     struct NewSceneParams
     {
         uint32_t m_MaxNodes;
@@ -402,6 +405,8 @@ namespace dmGui
         uint32_t m_GamepadIndex;
         uint32_t m_UserID;
         dmHID::GamepadPacket m_GamepadPacket;
+        /// Time of the latest key or mouse button state change (dmTime::GetTime()), 0 if unknown
+        uint64_t m_Timestamp;
 
         uint8_t  m_IsGamepad : 1;
         uint8_t  m_GamepadUnknown : 1;
@@ -852,6 +857,7 @@ namespace dmGui
 
     uint32_t GetNodeCount(HScene scene);
     uint32_t GetParticlefxCount(HScene scene);
+    uint32_t GetAnimationCount(HScene scene);
 
     void DeleteNode(HScene scene, HNode node, bool delete_headless_pfx);
 
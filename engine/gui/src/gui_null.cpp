@@ -412,6 +412,11 @@ namespace dmGui
         return 0;
     }
 
+    uint32_t GetAnimationCount(HScene scene)
+    {
+        return 0;
+    }
+
 
     void ClearNodes(HScene scene)
     {
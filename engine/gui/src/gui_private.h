@@ -94,7 +94,6 @@ namespace dmGui
         dmArray<RenderEntry>            m_RenderNodes;
         dmArray<dmVMath::Matrix4>       m_RenderTransforms;
         dmArray<float>                	m_RenderOpacities;
-        dmArray<InternalClippingNode>   m_StencilClippingNodes;
         dmArray<StencilScope*>          m_StencilScopes;
         dmArray<uint16_t>               m_StencilScopeIndices;
         dmArray<HNode>                  m_ScratchBoneNodes;
@@ -263,6 +262,7 @@ namespace dmGui
         Script*                               m_Script;
         dmIndexPool16                         m_NodePool;
         dmArray<InternalNode>                 m_Nodes;
+        dmHashTable64<uint16_t>               m_NodeIdIndex; // Node id -> node index cache for GetNodeById (validated on lookup)
         dmArray<Animation>                    m_Animations;
         dmHashTable<uintptr_t, dmhash_t>      m_ResourceToPath;
         dmHashTable64<void*>                  m_Fonts;
@@ -272,6 +272,11 @@ namespace dmGui
         dmParticle::HParticleContext          m_ParticlefxContext;
         dmHashTable64<dmParticle::HPrototype> m_Particlefxs;
         dmArray<ParticlefxComponent>          m_AliveParticlefxs;
+        // The sorted render entries and the clippers they refer to, kept between frames until the node hierarchy,
+        // the enabled state, the layers or the clipping of any node changes (see m_RenderEntriesDirty)
+        dmArray<RenderEntry>                  m_RenderEntries;
+        dmArray<InternalClippingNode>         m_ClippingNodes;
+        uint32_t                              m_ActiveNodeCount;
         dmHashTable64<uint16_t>               m_Layers;
         dmArray<dmhash_t>                     m_Layouts;
         dmArray<void*>                        m_LayoutsNodeDescs;
@@ -285,6 +290,7 @@ namespace dmGui
         uint16_t                              m_RenderOrder; // For the render-key
         uint16_t                              m_NextLayerIndex;
         uint16_t                              m_ResChanged : 1;
+        uint16_t                              m_RenderEntriesDirty : 1;
         uint32_t                              m_Width;
         uint32_t                              m_Height;
         dmScript::ScriptWorld*                m_ScriptWorld;
@@ -2551,7 +2551,10 @@ namespace dmGui
         HNode hnode;
         InternalNode* n = LuaCheckNodeInternal(L, 1, &hnode);
         int clipping_mode = (int) luaL_checknumber(L, 2);
-        n->m_Node.m_ClippingMode = (ClippingMode) clipping_mode;
+        (void) n;
+
+        Scene* scene = GuiScriptInstance_Check(L);
+        dmGui::SetNodeClippingMode(scene, hnode, (ClippingMode) clipping_mode);
         return 0;
     }
 
@@ -2582,7 +2585,10 @@ namespace dmGui
         HNode hnode;
         InternalNode* n = LuaCheckNodeInternal(L, 1, &hnode);
         int visible = lua_toboolean(L, 2);
-        n->m_Node.m_ClippingVisible = visible;
+        (void) n;
+
+        Scene* scene = GuiScriptInstance_Check(L);
+        dmGui::SetNodeClippingVisible(scene, hnode, visible != 0);
         return 0;
     }
 
@@ -2613,7 +2619,10 @@ namespace dmGui
         HNode hnode;
         InternalNode* n = LuaCheckNodeInternal(L, 1, &hnode);
         int inverted = lua_toboolean(L, 2);
-        n->m_Node.m_ClippingInverted = inverted;
+        (void) n;
+
+        Scene* scene = GuiScriptInstance_Check(L);
+        dmGui::SetNodeClippingInverted(scene, hnode, inverted != 0);
         return 0;
     }
 
@@ -4804,6 +4813,150 @@ namespace dmGui
     }
 
 
+    // Checks that the batch arguments are tables (arrays) of the same length, and returns the length
+    static uint32_t CheckBatchArguments(lua_State* L, int nodes_index, int values_index)
+    {
+        luaL_checktype(L, nodes_index, LUA_TTABLE);
+        luaL_checktype(L, values_index, LUA_TTABLE);
+        uint32_t count = (uint32_t)lua_objlen(L, nodes_index);
+        uint32_t value_count = (uint32_t)lua_objlen(L, values_index);
+        if (count != value_count)
+        {
+            luaL_error(L, "The number of nodes (%d) and values (%d) must be the same", count, value_count);
+        }
+        return count;
+    }
+
+    /*# sets the positions of several nodes
+     *
+     * Sets the positions of a list of nodes in one call. This is the same as calling
+     * [ref:gui.set_position] for each node, but with less overhead when many nodes are updated every frame.
+     *
+     * @name gui.set_positions
+     * @param nodes [type:table] list of nodes
+     * @param positions [type:table] list of new positions (vmath.vector3 or vmath.vector4), one for each node
+     * @examples
+     *
+     * Scroll a list of nodes:
+     *
+     * ```lua
+     * for i, node in ipairs(self.nodes) do
+     *     self.positions[i].y = self.positions[i].y + dy
+     * end
+     * gui.set_positions(self.nodes, self.positions)
+     * ```
+     */
+    static int LuaSetPositions(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+
+        uint32_t count = CheckBatchArguments(L, 1, 2);
+        for (uint32_t i = 1; i <= count; ++i)
+        {
+            lua_rawgeti(L, 1, i);
+            InternalNode* n = LuaCheckNodeInternal(L, -1, 0);
+            lua_rawgeti(L, 2, i);
+            if (!n->m_Node.m_IsBone)
+            {
+                Vector4& position = n->m_Node.m_Properties[PROPERTY_POSITION];
+                Vector3* v3 = dmScript::ToVector3(L, -1);
+                if (v3)
+                    position = Vector4(*v3, position.getW());
+                else
+                    position = *dmScript::CheckVector4(L, -1);
+                n->m_Node.m_DirtyLocal = 1;
+            }
+            lua_pop(L, 2);
+        }
+        return 0;
+    }
+
+    // Sets a property on the node from the value at the given stack index (see gui.set)
+    static void SetNodePropertyFromLua(lua_State* L, int index, Scene* scene, HNode hnode, const dmGui::PropDesc* pd, dmhash_t property_hash)
+    {
+        if (pd->m_Component == 0xff)
+        {
+            if (pd->m_Property == dmGui::PROPERTY_ROTATION)
+            {
+                Quat* q = dmScript::ToQuat(L, index);
+                if (!q)
+                    luaL_error(L, "Unable to set property '%s', the value must be a vmath.quat", dmHashReverseSafe64(property_hash));
+                dmGui::SetNodeProperty(scene, hnode, pd->m_Property, Vector4(*q));
+                return;
+            }
+
+            Vector4* v4 = dmScript::ToVector4(L, index);
+            if (v4)
+            {
+                dmGui::SetNodeProperty(scene, hnode, pd->m_Property, *v4);
+                return;
+            }
+
+            Vector3* v3 = dmScript::ToVector3(L, index);
+            if (!v3)
+                luaL_error(L, "Unable to set property '%s', the value must be a vmath.vector4 or a vmath.vector3", dmHashReverseSafe64(property_hash));
+            Vector4 current_value = dmGui::GetNodeProperty(scene, hnode, pd->m_Property);
+            current_value.setXYZ(*v3);
+            dmGui::SetNodeProperty(scene, hnode, pd->m_Property, current_value);
+            return;
+        }
+
+        if (!lua_isnumber(L, index))
+            luaL_error(L, "Unable to set property '%s', vector elements can only be set by numbers", dmHashReverseSafe64(property_hash));
+
+        Vector4 current_value = dmGui::GetNodeProperty(scene, hnode, pd->m_Property);
+        current_value.setElem(pd->m_Component, (float) lua_tonumber(L, index));
+        dmGui::SetNodeProperty(scene, hnode, pd->m_Property, current_value);
+    }
+
+    /*# sets a property on several nodes
+     *
+     * Sets a named property on a list of nodes in one call. The property is only looked up once,
+     * which makes this cheaper than calling [ref:gui.set] for each node.
+     * Only the built in node properties are supported (e.g. "position", "scale", "color.w"), not material constants.
+     *
+     * @name gui.set_properties
+     * @param nodes [type:table] list of nodes
+     * @param property [type:string|constant] the property to set
+     * @param values [type:table] list of values, one for each node. See [ref:gui.set] for the value types
+     * @examples
+     *
+     * Fade out a list of nodes:
+     *
+     * ```lua
+     * local alphas = {}
+     * for i = 1, #self.nodes do
+     *     alphas[i] = self.alpha
+     * end
+     * gui.set_properties(self.nodes, "color.w", alphas)
+     * ```
+     */
+    static int LuaSetProperties(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+
+        Scene* scene = GuiScriptInstance_Check(L);
+
+        dmhash_t property_hash = dmScript::CheckHashOrString(L, 2);
+        dmGui::PropDesc* pd = dmGui::GetPropertyDesc(property_hash);
+        if (!pd)
+        {
+            return DM_LUA_ERROR("Property '%s' not found", dmHashReverseSafe64(property_hash));
+        }
+
+        uint32_t count = CheckBatchArguments(L, 1, 3);
+        for (uint32_t i = 1; i <= count; ++i)
+        {
+            lua_rawgeti(L, 1, i);
+            HNode hnode;
+            LuaCheckNodeInternal(L, -1, &hnode);
+            lua_rawgeti(L, 3, i);
+            SetNodePropertyFromLua(L, -1, scene, hnode, pd, property_hash);
+            lua_pop(L, 2);
+        }
+        return 0;
+    }
+
 #define REGGETSET(name, luaname) \
         {"get_"#luaname, LuaGet##name},\
         {"set_"#luaname, LuaSet##name},\
@@ -4815,6 +4968,8 @@ namespace dmGui
         {"set_id",          LuaSetId},
         {"get",             LuaGet},
         {"set",             LuaSet},
+        {"set_properties",  LuaSetProperties},
+        {"set_positions",   LuaSetPositions},
         {"get_index",       LuaGetIndex},
         {"delete_node",     LuaDeleteNode},
         {"animate",         LuaAnimate},
@@ -5533,6 +5688,7 @@ namespace dmGui
      * `pressed`   | If the input was pressed this frame. This is not present for mouse movement.
      * `released`  | If the input was released this frame. This is not present for mouse movement.
      * `repeated`  | If the input was repeated this frame. This is similar to how a key on a keyboard is repeated when you hold it down. This is not present for mouse movement.
+     * `timestamp` | Time in seconds, on the same clock as `socket.gettime()`, when the state of a bound key or mouse button last changed. Only present for key and mouse button input.
      * `x`         | The x value of a pointer device, if present.
      * `y`         | The y value of a pointer device, if present.
      * `screen_x`  | The screen space x value of a pointer device, if present.
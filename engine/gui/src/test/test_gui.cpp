@@ -309,6 +309,31 @@ TEST_F(dmGuiTest, Name)
     ASSERT_EQ(dmGui::RESULT_OK, dmGui::InitScene(m_Scene));
 }
 
+TEST_F(dmGuiTest, NameLookupCache)
+{
+    dmGui::HNode node1 = dmGui::NewNode(m_Scene, Point3(5,5,0), Vector3(10,10,0), dmGui::NODE_TYPE_BOX, 0);
+    dmGui::SetNodeId(m_Scene, node1, "my_node");
+    ASSERT_EQ(node1, dmGui::GetNodeById(m_Scene, "my_node"));
+    ASSERT_EQ(node1, dmGui::GetNodeById(m_Scene, "my_node")); // cached
+
+    // Renaming the node invalidates the cached lookup
+    dmGui::SetNodeId(m_Scene, node1, "other_node");
+    ASSERT_EQ((dmGui::HNode) 0, dmGui::GetNodeById(m_Scene, "my_node"));
+    ASSERT_EQ(node1, dmGui::GetNodeById(m_Scene, "other_node"));
+
+    // A deleted node isn't returned, even if the slot is reused
+    dmGui::DeleteNode(m_Scene, node1, true);
+    dmGui::HNode node2 = dmGui::NewNode(m_Scene, Point3(5,5,0), Vector3(10,10,0), dmGui::NODE_TYPE_BOX, 0);
+    ASSERT_EQ((dmGui::HNode) 0, dmGui::GetNodeById(m_Scene, "other_node"));
+    dmGui::SetNodeId(m_Scene, node2, "other_node");
+    ASSERT_EQ(node2, dmGui::GetNodeById(m_Scene, "other_node"));
+
+    // Clones can be found by their generated id
+    dmGui::HNode clone;
+    ASSERT_EQ(dmGui::RESULT_OK, dmGui::CloneNode(m_Scene, node2, &clone));
+    ASSERT_EQ(clone, dmGui::GetNodeById(m_Scene, dmGui::GetNodeId(m_Scene, clone)));
+}
+
 TEST_F(dmGuiTest, ContextAndSceneResolution)
 {
     uint32_t width, height;
@@ -1124,6 +1149,7 @@ TEST_F(dmGuiTest, AnimateNode2)
     dmGui::AnimateNodeHash(m_Scene, node, property, Vector4(1,0,0,0), dmEasing::Curve(dmEasing::TYPE_LINEAR), dmGui::PLAYBACK_ONCE_FORWARD, 1.1f, 0, 0, 0, 0);
 
     ASSERT_NEAR(dmGui::GetNodePosition(m_Scene, node).getX(), 0.0f, EPSILON);
+    ASSERT_EQ(1U, dmGui::GetAnimationCount(m_Scene));
 
     // Animation
     for (int i = 0; i < 200; ++i)
@@ -1132,6 +1158,7 @@ TEST_F(dmGuiTest, AnimateNode2)
     }
 
     ASSERT_NEAR(dmGui::GetNodePosition(m_Scene, node).getX(), 1.0f, EPSILON);
+    ASSERT_EQ(0U, dmGui::GetAnimationCount(m_Scene));
     dmGui::DeleteNode(m_Scene, node, true);
 }
 
@@ -3794,6 +3821,57 @@ TEST_F(dmGuiTest, MoveNodesLoad)
     dmGui::DeleteScene(scene);
 }
 
+// Verify that the render entries kept between frames follow the changes to the scene
+TEST_F(dmGuiTest, RenderEntriesRetained)
+{
+    Vector3 size(10, 10, 0);
+    Point3 pos(size * 0.5f);
+
+    std::map<dmGui::HNode, uint16_t> order;
+
+    dmGui::RenderSceneParams render_params;
+    render_params.m_RenderNodes = RenderNodesOrder;
+
+    dmGui::HNode n1 = dmGui::NewNode(m_Scene, pos, size, dmGui::NODE_TYPE_BOX, 0);
+    dmGui::HNode n2 = dmGui::NewNode(m_Scene, pos, size, dmGui::NODE_TYPE_BOX, 0);
+    dmGui::RenderScene(m_Scene, render_params, &order);
+    ASSERT_EQ(2u, order.size());
+    ASSERT_FALSE(m_Scene->m_RenderEntriesDirty);
+
+    // Unchanged scene
+    dmGui::RenderScene(m_Scene, render_params, &order);
+    ASSERT_EQ(2u, order.size());
+    ASSERT_EQ(0u, order[n1]);
+    ASSERT_EQ(1u, order[n2]);
+
+    // Property changes don't affect the entries
+    dmGui::SetNodePosition(m_Scene, n1, Point3(1.0f, 2.0f, 0.0f));
+    ASSERT_FALSE(m_Scene->m_RenderEntriesDirty);
+
+    dmGui::SetNodeEnabled(m_Scene, n1, false);
+    ASSERT_TRUE(m_Scene->m_RenderEntriesDirty);
+    dmGui::RenderScene(m_Scene, render_params, &order);
+    ASSERT_EQ(1u, order.size());
+    ASSERT_EQ(0u, order[n2]);
+
+    dmGui::SetNodeEnabled(m_Scene, n1, true);
+    dmGui::MoveNodeAbove(m_Scene, n1, n2);
+    dmGui::RenderScene(m_Scene, render_params, &order);
+    ASSERT_EQ(2u, order.size());
+    ASSERT_EQ(0u, order[n2]);
+    ASSERT_EQ(1u, order[n1]);
+
+    dmGui::SetNodeClippingMode(m_Scene, n2, dmGui::CLIPPING_MODE_STENCIL);
+    ASSERT_TRUE(m_Scene->m_RenderEntriesDirty);
+    dmGui::RenderScene(m_Scene, render_params, &order);
+    ASSERT_FALSE(m_Scene->m_RenderEntriesDirty);
+
+    dmGui::DeleteNode(m_Scene, n2);
+    dmGui::RenderScene(m_Scene, render_params, &order);
+    ASSERT_EQ(1u, order.size());
+    ASSERT_EQ(0u, order[n1]);
+}
+
 // Verify specific use cases of parenting nodes:
 // - single node (nop)
 //   - parent to nil
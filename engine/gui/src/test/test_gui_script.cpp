@@ -387,6 +387,50 @@ TEST_F(dmGuiScriptTest, TestCloneNode)
     dmGui::DeleteScript(script);
 }
 
+TEST_F(dmGuiScriptTest, TestBatchSetters)
+{
+    dmGui::HScript script = NewScript(m_Context);
+
+    dmGui::NewSceneParams params;
+    params.m_MaxNodes = 64;
+    params.m_MaxAnimations = 32;
+    params.m_UserData = this;
+    dmGui::HScene scene = dmGui::NewScene(m_Context, &params);
+    dmGui::SetSceneScript(scene, script);
+
+    const char* src =
+            "function init(self)\n"
+            "    local nodes = {}\n"
+            "    local positions = {}\n"
+            "    local alphas = {}\n"
+            "    for i = 1, 3 do\n"
+            "        nodes[i] = gui.new_box_node(vmath.vector3(0), vmath.vector3(1))\n"
+            "        positions[i] = vmath.vector3(i, 2 * i, 0)\n"
+            "        alphas[i] = i / 4\n"
+            "    end\n"
+            "    gui.set_positions(nodes, positions)\n"
+            "    gui.set_properties(nodes, \"color.w\", alphas)\n"
+            "    gui.set_properties(nodes, \"scale\", { vmath.vector3(2), vmath.vector3(3), vmath.vector3(4) })\n"
+            "    for i = 1, 3 do\n"
+            "        assert(gui.get_position(nodes[i]) == positions[i])\n"
+            "        assert(gui.get_color(nodes[i]).w == alphas[i])\n"
+            "        assert(gui.get_scale(nodes[i]) == vmath.vector3(i + 1))\n"
+            "    end\n"
+            "    assert(not pcall(gui.set_positions, nodes, { vmath.vector3() }))\n"
+            "    assert(not pcall(gui.set_properties, nodes, \"color.w\", { 1, 2, \"a\" }))\n"
+            "end\n";
+
+    dmGui::Result result = SetScript(script, LuaSourceFromStr(src));
+    ASSERT_EQ(dmGui::RESULT_OK, result);
+
+    result = dmGui::InitScene(scene);
+    ASSERT_EQ(dmGui::RESULT_OK, result);
+
+    dmGui::DeleteScene(scene);
+
+    dmGui::DeleteScript(script);
+}
+
 TEST_F(dmGuiScriptTest, TestCloneTree)
 {
     dmGui::HScript script = NewScript(m_Context);
@@ -17,6 +17,7 @@
 
 #include <dlib/log.h>
 #include <dlib/dstrings.h>
+#include <dlib/time.h>
 #include <dlib/utf8.h>
 
 #include <platform/platform_window.h>
@@ -294,6 +295,9 @@ namespace dmHID
         {
             int key_index = (int) key - dmPlatform::PLATFORM_KEY_START;
 
+            if (GetKey(&keyboard->m_Packet, key) != value)
+                keyboard->m_KeyTimestamps[key_index] = dmTime::GetTime();
+
             if (value)
                 keyboard->m_Packet.m_Keys[key_index / 32] |= (1 << (key_index % 32));
             else
@@ -301,6 +305,14 @@ namespace dmHID
         }
     }
 
+    uint64_t GetKeyTimestamp(HKeyboard keyboard, Key key)
+    {
+        if (keyboard != 0x0)
+            return keyboard->m_KeyTimestamps[(int) key - dmPlatform::PLATFORM_KEY_START];
+        else
+            return 0;
+    }
+
     bool GetMouseButton(MousePacket* packet, MouseButton button)
     {
         if (packet != 0x0)
@@ -313,6 +325,9 @@ namespace dmHID
     {
         if (mouse != 0x0)
         {
+            if (GetMouseButton(&mouse->m_Packet, button) != value)
+                mouse->m_ButtonTimestamps[button] = dmTime::GetTime();
+
             if (value)
                 mouse->m_Packet.m_Buttons[button / 32] |= (1 << (button % 32));
             else
@@ -320,6 +335,14 @@ namespace dmHID
         }
     }
 
+    uint64_t GetMouseButtonTimestamp(HMouse mouse, MouseButton button)
+    {
+        if (mouse != 0x0)
+            return mouse->m_ButtonTimestamps[button];
+        else
+            return 0;
+    }
+
     void SetMousePosition(HMouse mouse, int32_t x, int32_t y)
     {
         if (mouse != 0x0)
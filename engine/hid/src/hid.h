@@ -149,6 +149,15 @@ namespace dmHID
      */
     void Update(HContext context);
 
+    /**
+     * Samples keyboard and mouse button state without running the full device update.
+     * Meant to be called repeatedly while the engine is idle (e.g. waiting for vsync)
+     * so that state changes are recorded with a more accurate timestamp.
+     *
+     * @param context the context to poll from
+     */
+    void Poll(HContext context);
+
     /**
      * Retrieves the number of buttons on a given gamepad.
      *
@@ -275,6 +284,24 @@ namespace dmHID
      */
     bool GetKey(KeyboardPacket* packet, Key key);
 
+    /**
+     * Get the time when the state of a key last changed.
+     *
+     * @param keyboard keyboard handle
+     * @param key The requested key
+     * @return Time in microseconds, as given by dmTime::GetTime(), 0 if the key never changed state
+     */
+    uint64_t GetKeyTimestamp(HKeyboard keyboard, Key key);
+
+    /**
+     * Get the time when the state of a mouse button last changed.
+     *
+     * @param mouse mouse handle
+     * @param button The requested button
+     * @return Time in microseconds, as given by dmTime::GetTime(), 0 if the button never changed state
+     */
+    uint64_t GetMouseButtonTimestamp(HMouse mouse, MouseButton button);
+
     /**
      * Set current marked text
      *
@@ -69,6 +69,11 @@ namespace dmHID
         context->m_Gamepads[0].m_AxisCount = MAX_GAMEPAD_AXIS_COUNT;
     }
 
+    void Poll(HContext context)
+    {
+        dmPlatform::PollEvents(context->m_Window);
+    }
+
     void GetGamepadDeviceName(HContext context, HGamepad gamepad, char name[MAX_GAMEPAD_NAME_LENGTH])
     {
         dmStrlCpy(name, "null_device", MAX_GAMEPAD_NAME_LENGTH);
@@ -36,6 +36,7 @@ namespace dmHID
     struct Keyboard
     {
         KeyboardPacket  m_Packet;
+        uint64_t        m_KeyTimestamps[MAX_KEY_COUNT];       // dmTime::GetTime() of the last state change
         uint32_t        m_Index : 31;
         uint32_t        m_Connected : 1;
     };
@@ -43,6 +44,7 @@ namespace dmHID
     struct Mouse
     {
         MousePacket     m_Packet;
+        uint64_t        m_ButtonTimestamps[MAX_MOUSE_BUTTON_COUNT]; // dmTime::GetTime() of the last state change
         uint32_t        m_Index : 31;
         uint32_t        m_Connected : 1;
     };
@@ -18,6 +18,7 @@
 #include <dlib/log.h>
 #include <dlib/dstrings.h>
 #include <dlib/math.h>
+#include <dlib/time.h>
 
 #include <platform/platform_window.h>
 
@@ -208,9 +209,9 @@ namespace dmHID
         }
     }
 
-    void Update(HContext context)
+    static void UpdateKeyboardAndMouse(HContext context)
     {
-        dmPlatform::PollEvents(context->m_Window);
+        uint64_t time = dmTime::GetTime();
 
         // Update keyboard
         if (!context->m_IgnoreKeyboard)
@@ -227,6 +228,9 @@ namespace dmHID
                     int state      = dmPlatform::GetKey(context->m_Window, key_value);
                     uint32_t mask  = 1 << (i % 32);
 
+                    if (((keyboard->m_Packet.m_Keys[i / 32] & mask) != 0) != (state != 0))
+                        keyboard->m_KeyTimestamps[i] = time;
+
                     if (state)
                         keyboard->m_Packet.m_Keys[i / 32] |= mask;
                     else
@@ -254,6 +258,9 @@ namespace dmHID
                     int button_value = GetMouseButtonValue((MouseButton) i);
                     int state        = dmPlatform::GetMouseButton(context->m_Window, button_value);
 
+                    if (((packet.m_Buttons[i / 32] & mask) != 0) != (state != 0))
+                        mouse->m_ButtonTimestamps[i] = time;
+
                     if (state)
                         packet.m_Buttons[i / 32] |= mask;
                     else
@@ -270,6 +277,18 @@ namespace dmHID
                 dmPlatform::GetMousePosition(context->m_Window, &packet.m_PositionX, &packet.m_PositionY);
             }
         }
+    }
+
+    void Poll(HContext context)
+    {
+        dmPlatform::PollEvents(context->m_Window);
+        UpdateKeyboardAndMouse(context);
+    }
+
+    void Update(HContext context)
+    {
+        dmPlatform::PollEvents(context->m_Window);
+        UpdateKeyboardAndMouse(context);
 
         if (!context->m_IgnoreGamepads)
         {
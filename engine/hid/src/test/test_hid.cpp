@@ -15,6 +15,8 @@
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
 
+#include <dlib/time.h>
+
 #include "../hid.h"
 
 class HIDTest : public jc_test_base_class
@@ -131,6 +133,42 @@ TEST_F(HIDTest, Mouse)
         ASSERT_FALSE(dmHID::GetMouseButton(&packet, (dmHID::MouseButton)i));
 }
 
+TEST_F(HIDTest, Timestamps)
+{
+    dmHID::Update(m_Context);
+
+    ASSERT_EQ(0u, dmHID::GetKeyTimestamp(m_Keyboard, dmHID::KEY_SPACE));
+    ASSERT_EQ(0u, dmHID::GetMouseButtonTimestamp(m_Mouse, dmHID::MOUSE_BUTTON_LEFT));
+
+    uint64_t before = dmTime::GetTime();
+    dmHID::SetKey(m_Keyboard, dmHID::KEY_SPACE, true);
+    dmHID::SetMouseButton(m_Mouse, dmHID::MOUSE_BUTTON_LEFT, true);
+
+    uint64_t key_pressed = dmHID::GetKeyTimestamp(m_Keyboard, dmHID::KEY_SPACE);
+    uint64_t button_pressed = dmHID::GetMouseButtonTimestamp(m_Mouse, dmHID::MOUSE_BUTTON_LEFT);
+    ASSERT_LE(before, key_pressed);
+    ASSERT_LE(before, button_pressed);
+    ASSERT_EQ(0u, dmHID::GetKeyTimestamp(m_Keyboard, dmHID::KEY_ENTER));
+
+    // Setting the same state again is not a change
+    dmTime::Sleep(1000);
+    dmHID::SetKey(m_Keyboard, dmHID::KEY_SPACE, true);
+    dmHID::SetMouseButton(m_Mouse, dmHID::MOUSE_BUTTON_LEFT, true);
+    ASSERT_EQ(key_pressed, dmHID::GetKeyTimestamp(m_Keyboard, dmHID::KEY_SPACE));
+    ASSERT_EQ(button_pressed, dmHID::GetMouseButtonTimestamp(m_Mouse, dmHID::MOUSE_BUTTON_LEFT));
+
+    dmHID::SetKey(m_Keyboard, dmHID::KEY_SPACE, false);
+    dmHID::SetMouseButton(m_Mouse, dmHID::MOUSE_BUTTON_LEFT, false);
+    ASSERT_LT(key_pressed, dmHID::GetKeyTimestamp(m_Keyboard, dmHID::KEY_SPACE));
+    ASSERT_LT(button_pressed, dmHID::GetMouseButtonTimestamp(m_Mouse, dmHID::MOUSE_BUTTON_LEFT));
+
+    // Polling keeps the state set above, as the null device doesn't sample anything
+    dmHID::Poll(m_Context);
+    dmHID::KeyboardPacket packet;
+    ASSERT_TRUE(dmHID::GetKeyboardPacket(m_Keyboard, &packet));
+    ASSERT_FALSE(dmHID::GetKey(&packet, dmHID::KEY_SPACE));
+}
+
 TEST_F(HIDTest, Gamepad)
 {
     dmHID::Update(m_Context);
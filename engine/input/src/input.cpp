@@ -558,6 +558,7 @@ namespace dmInput
         action->m_GamepadDisconnected = 0;
         action->m_GamepadConnected = 0;
         action->m_HasGamepadPacket = 0;
+        action->m_Timestamp = 0;
     }
 
     struct UpdateActionContext
@@ -646,6 +647,7 @@ namespace dmInput
                     {
                         if (dmMath::Abs(action->m_Value) < v)
                             action->m_Value = v;
+                        action->m_Timestamp = dmMath::Max(action->m_Timestamp, dmHID::GetKeyTimestamp(keyboard_binding->m_Keyboard, KEY_MAP[trigger.m_Input]));
                     }
                 }
                 *prev_packet = *packet;
@@ -760,6 +762,10 @@ namespace dmInput
                         {
                             action->m_Value = v;
                         }
+                        if (trigger.m_Input != dmInputDDF::MOUSE_WHEEL_UP && trigger.m_Input != dmInputDDF::MOUSE_WHEEL_DOWN)
+                        {
+                            action->m_Timestamp = dmMath::Max(action->m_Timestamp, dmHID::GetMouseButtonTimestamp(mouse_binding->m_Mouse, MOUSE_BUTTON_MAP[trigger.m_Input]));
+                        }
                     }
                 }
                 *prev_packet = *packet;
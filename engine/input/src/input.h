@@ -44,6 +44,8 @@ namespace dmInput
         uint32_t     m_GamepadIndex;
         uint32_t     m_UserID;
         dmHID::GamepadPacket m_GamepadPacket;
+        /// Time of the latest key or mouse button state change among the triggers (dmTime::GetTime()), 0 if unknown
+        uint64_t     m_Timestamp;
 
         uint32_t m_IsGamepad : 1;
         uint32_t m_GamepadUnknown : 1;
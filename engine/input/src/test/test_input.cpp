@@ -163,6 +163,10 @@ TEST_F(InputTest, Keyboard)
     ASSERT_TRUE(dmInput::Pressed(binding, key_0_id));
     ASSERT_FALSE(dmInput::Released(binding, key_0_id));
 
+    uint64_t pressed_timestamp = dmInput::GetAction(binding, key_0_id)->m_Timestamp;
+    ASSERT_EQ(dmHID::GetKeyTimestamp(keyboard, dmHID::KEY_0), pressed_timestamp);
+    ASSERT_NE(0u, pressed_timestamp);
+
     dmHID::SetKey(keyboard, dmHID::KEY_0, false);
 
     dmHID::Update(m_HidContext);
@@ -170,6 +174,7 @@ TEST_F(InputTest, Keyboard)
 
     ASSERT_FALSE(dmInput::Pressed(binding, key_0_id));
     ASSERT_TRUE(dmInput::Released(binding, key_0_id));
+    ASSERT_LE(pressed_timestamp, dmInput::GetAction(binding, key_0_id)->m_Timestamp);
 
     dmHID::Update(m_HidContext);
     dmInput::UpdateBinding(binding, m_DT);
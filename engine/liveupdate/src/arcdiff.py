@@ -0,0 +1,124 @@
+#! /usr/bin/env python
+# Copyright 2020-2024 The Defold Foundation
+# Copyright 2014-2020 King
+# Copyright 2009-2014 Ragnar Svensson, Christian Murray
+# Licensed under the Defold License version 1.0 (the "License"); you may not use
+# this file except in compliance with the License.
+#
+# You may obtain a copy of the License, together with FAQs at
+# https://www.defold.com/license
+#
+# Unless required by applicable law or agreed to in writing, software distributed
+# under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied. See the License for the
+# specific language governing permissions and limitations under the License.
+
+# Creates a patch between two versions of a live update archive, to be applied with liveupdate.store_archive_patch()
+# The format is described in liveupdate_patch.h
+
+import os, sys, struct, hashlib
+from optparse import OptionParser
+
+PATCH_MAGIC = 0x444D4450 # "DMDP"
+PATCH_VERSION = 1
+
+PATCH_OP_END = 0
+PATCH_OP_COPY = 1
+PATCH_OP_INSERT = 2
+
+# The size of the blocks that are matched against the base archive
+BLOCK_SIZE = 64
+# Max size of a single op
+MAX_OP_SIZE = 0x7fffffff
+
+def index_blocks(base):
+    blocks = {}
+    for offset in range(0, len(base) - BLOCK_SIZE + 1, BLOCK_SIZE):
+        block = base[offset:offset+BLOCK_SIZE]
+        if block not in blocks:
+            blocks[block] = offset
+    return blocks
+
+def write_insert(out, data):
+    for offset in range(0, len(data), MAX_OP_SIZE):
+        chunk = data[offset:offset+MAX_OP_SIZE]
+        out.write(struct.pack('!BI', PATCH_OP_INSERT, len(chunk)))
+        out.write(chunk)
+
+def write_copy(out, offset, size):
+    while size > 0:
+        chunk = min(size, MAX_OP_SIZE)
+        out.write(struct.pack('!BQI', PATCH_OP_COPY, offset, chunk))
+        offset += chunk
+        size -= chunk
+
+def diff(base, target, out):
+    blocks = index_blocks(base)
+
+    out.write(struct.pack('!IIQQ', PATCH_MAGIC, PATCH_VERSION, len(base), len(target)))
+    out.write(hashlib.sha1(target).digest())
+
+    stats = {'copied': 0, 'inserted': 0}
+    literal_start = 0
+    pos = 0
+    end = len(target) - BLOCK_SIZE
+    while pos <= end:
+        base_offset = blocks.get(target[pos:pos+BLOCK_SIZE])
+        if base_offset is None:
+            pos += 1
+            continue
+
+        # Extend the match backwards into the pending literal data and forwards as far as possible
+        while pos > literal_start and base_offset > 0 and base[base_offset-1:base_offset] == target[pos-1:pos]:
+            pos -= 1
+            base_offset -= 1
+        size = BLOCK_SIZE
+        while True:
+            for step in (4096, BLOCK_SIZE, 1):
+                if pos + size + step <= len(target) and base_offset + size + step <= len(base) and base[base_offset+size:base_offset+size+step] == target[pos+size:pos+size+step]:
+                    size += step
+                    break
+            else:
+                break
+
+        if pos > literal_start:
+            write_insert(out, target[literal_start:pos])
+            stats['inserted'] += pos - literal_start
+        write_copy(out, base_offset, size)
+        stats['copied'] += size
+
+        pos += size
+        literal_start = pos
+
+    if literal_start < len(target):
+        write_insert(out, target[literal_start:])
+        stats['inserted'] += len(target) - literal_start
+
+    out.write(struct.pack('!B', PATCH_OP_END))
+    return stats
+
+def main():
+    usage = "usage: %prog [options] base.zip target.zip"
+    parser = OptionParser(usage = usage)
+    parser.add_option("-o", dest="output_file", help="Output patch file", metavar="OUTPUT")
+    (options, args) = parser.parse_args()
+
+    if len(args) != 2:
+        parser.error("Base and target archives are required")
+
+    if not options.output_file:
+        parser.error("Output file not specified (-o)")
+
+    with open(args[0], 'rb') as f:
+        base = f.read()
+    with open(args[1], 'rb') as f:
+        target = f.read()
+
+    with open(options.output_file, 'wb') as out:
+        stats = diff(base, target, out)
+
+    patch_size = os.stat(options.output_file).st_size
+    print("Wrote %s: %d bytes (%d copied, %d inserted) for a %d byte archive" % (options.output_file, patch_size, stats['copied'], stats['inserted'], len(target)))
+
+if __name__ == '__main__':
+    main()
@@ -14,6 +14,7 @@
 
 #include "liveupdate.h"
 #include "liveupdate_private.h"
+#include "liveupdate_patch.h"
 #include "liveupdate_verify.h"
 #include "script_liveupdate.h"
 
@@ -23,11 +24,18 @@
 
 #include <ddf/ddf.h>
 
+#include <dlib/array.h>
+#include <dlib/atomic.h>
+#include <dlib/crypt.h>
 #include <dlib/dstrings.h>
 #include <dlib/endian.h>
+#include <dlib/http_client.h>
 #include <dlib/log.h>
+#include <dlib/math.h>
+#include <dlib/thread.h>
 #include <dlib/time.h>
 #include <dlib/sys.h>
+#include <dlib/uri.h>
 #include <dlib/job_thread.h>
 #include <dmsdk/dlib/configfile.h>
 #include <dmsdk/dlib/profile.h>
@@ -59,6 +67,13 @@ namespace dmLiveUpdate
     const char* LIVEUPDATE_ZIP_ARCHIVE_TMP_FILENAME = "liveupdate.ref.tmp";
     const char* LIVEUPDATE_BUNDLE_VER_FILENAME      = "bundle.ver";
 
+    // Max number of concurrent connections of a StoreResourcesAsync request
+    const uint32_t STORE_RESOURCES_MAX_CONNECTIONS  = 8;
+    // Max number of downloaded resources waiting to be written, per connection
+    const int32_t  STORE_RESOURCES_MAX_PENDING      = 4;
+    // Number of times a resource is downloaded before it is reported as failed
+    const uint32_t STORE_RESOURCES_MAX_ATTEMPTS     = 2;
+
     Result ResourceResultToLiveupdateResult(dmResource::Result r)
     {
         switch (r)
@@ -101,6 +116,8 @@ namespace dmLiveUpdate
         return "RESULT_UNDEFINED";
     }
 
+    struct StoreResourcesInfo;
+
     struct LiveUpdateCtx
     {
         LiveUpdateCtx()
@@ -113,11 +130,14 @@ namespace dmLiveUpdate
         dmResourceProvider::HArchive    m_ResourceBaseArchive;  // The "game.arcd" archive
 
         dmJobThread::HContext           m_JobThread;
+        dmJobThread::HContext           m_VerifyJobThread;      // Hashes the archive entries in parallel, while the job thread waits
 
         // Legacy functionality
         dmResource::HFactory            m_ResourceFactory;      // Resource system factory
         dmResourceProvider::HArchive    m_LiveupdateArchive;
         dmResource::HManifest           m_LiveupdateArchiveManifest;
+        // The unfinished StoreResourcesAsync requests
+        dmArray<StoreResourcesInfo*>    m_StoreResourcesRequests;
         bool                            m_IsEnabled;
 
     } g_LiveUpdate;
@@ -524,6 +544,345 @@ namespace dmLiveUpdate
 
     // ******************************************************************************************************************************************
 
+    struct StoreResourcesInfo
+    {
+        StoreResourcesInfo() {
+            memset(this, 0, sizeof(*this));
+        }
+        dmURI::Parts                            m_BaseUri;
+        const char**                            m_HexDigests;   // Points into m_HexDigestData
+        char*                                   m_HexDigestData;
+        uint32_t                                m_Count;
+        uint32_t                                m_HashLength;   // The resource digest length of the manifest, in bytes
+        dmCrypt::HashAlgorithm                  m_HashAlgorithm;
+
+        dmThread::Thread                        m_Threads[STORE_RESOURCES_MAX_CONNECTIONS];
+        uint32_t                                m_ThreadCount;
+        int32_atomic_t                          m_Next;         // The next resource to download
+        int32_atomic_t                          m_Pending;      // Downloaded resources waiting for the job thread
+        int                                     m_Canceled;     // Also the cancel flag of the http clients
+
+        // Only touched on the main thread
+        StoreResourcesProgress                  m_Progress;
+        void                                    (*m_Callback)(const StoreResourcesProgress*, void*);
+        void*                                   m_CallbackData;
+    };
+
+    // A downloaded resource, passed on to the job thread to be written
+    struct StoreResourcesJob
+    {
+        StoreResourcesInfo*                     m_Request;
+        uint32_t                                m_Index;
+        uint8_t*                                m_Data; // Including the dmResourceArchive::LiveUpdateResourceHeader
+        uint32_t                                m_DataLength;
+    };
+
+    // State of the current download of one connection
+    struct StoreResourcesDownload
+    {
+        dmArray<uint8_t>                        m_Buffer;
+        dmCrypt::HHashState                     m_Hash;
+        StoreResourcesInfo*                     m_Request;
+        int                                     m_Status;
+    };
+
+    static void StoreResourcesHttpHeader(dmHttpClient::HResponse response, void* user_data, int status_code, const char* key, const char* value)
+    {
+        StoreResourcesDownload* download = (StoreResourcesDownload*)user_data;
+        download->m_Status = status_code;
+
+        if (dmStrCaseCmp(key, "Content-Length") == 0)
+        {
+            int32_t content_length = strtol(value, 0, 10);
+            if (content_length > 0 && download->m_Buffer.Capacity() < (uint32_t)content_length)
+                download->m_Buffer.SetCapacity(content_length);
+        }
+    }
+
+    // Called as the data streams in. The data is hashed right away, so that it is verified as soon as the download is done
+    static void StoreResourcesHttpContent(dmHttpClient::HResponse, void* user_data, int status_code, const void* content_data, uint32_t content_data_size, int32_t content_length, const char* method)
+    {
+        StoreResourcesDownload* download = (StoreResourcesDownload*)user_data;
+        download->m_Status = status_code;
+
+        // Start of a response, which happens again if the request is retried
+        if (!content_data && !content_data_size)
+        {
+            download->m_Buffer.SetSize(0);
+            if (download->m_Hash)
+                dmCrypt::DeleteHash(download->m_Hash);
+            download->m_Hash = dmCrypt::NewHash(download->m_Request->m_HashAlgorithm);
+            return;
+        }
+
+        if (download->m_Buffer.Remaining() < content_data_size)
+            download->m_Buffer.OffsetCapacity(content_data_size - download->m_Buffer.Remaining() + 64 * 1024);
+
+        // The resource header is not part of the digest
+        const uint32_t header_size = sizeof(dmResourceArchive::LiveUpdateResourceHeader);
+        uint32_t offset = download->m_Buffer.Size();
+        uint32_t skip = offset < header_size ? dmMath::Min(header_size - offset, content_data_size) : 0;
+        if (download->m_Hash && skip < content_data_size)
+            dmCrypt::UpdateHash(download->m_Hash, (const uint8_t*)content_data + skip, content_data_size - skip);
+
+        download->m_Buffer.PushArray((const uint8_t*)content_data, content_data_size);
+    }
+
+    // Called on the download threads. Returns true if the resource was downloaded and matches its digest
+    static bool StoreResourcesDownloadOne(dmHttpClient::HClient client, StoreResourcesDownload* download, const char* hex_digest)
+    {
+        StoreResourcesInfo* request = download->m_Request;
+
+        char path[DMPATH_MAX_PATH];
+        const char* base_path = request->m_BaseUri.m_Path;
+        uint32_t base_path_len = strlen(base_path);
+        const char* separator = (base_path_len == 0 || base_path[base_path_len-1] != '/') ? "/" : "";
+        dmSnPrintf(path, sizeof(path), "%s%s%s", base_path, separator, hex_digest);
+
+        download->m_Status = -1;
+        download->m_Buffer.SetSize(0);
+
+        dmHttpClient::Result r = dmHttpClient::Get(client, path);
+        if (r != dmHttpClient::RESULT_OK || download->m_Status != 200)
+        {
+            dmLogWarning("Failed to download resource '%s': %s (%d)", path, dmHttpClient::ResultToString(r), download->m_Status);
+            return false;
+        }
+
+        if (!download->m_Hash || download->m_Buffer.Size() < sizeof(dmResourceArchive::LiveUpdateResourceHeader))
+        {
+            dmLogWarning("The downloaded resource '%s' has no header", path);
+            return false;
+        }
+
+        uint8_t digest[20];
+        char hex_digest_downloaded[20*2+1];
+        dmCrypt::FinalizeHash(download->m_Hash, digest);
+        dmResource::BytesToHexString(digest, request->m_HashLength, hex_digest_downloaded, sizeof(hex_digest_downloaded));
+        if (dmStrCaseCmp(hex_digest_downloaded, hex_digest) != 0)
+        {
+            dmLogWarning("The downloaded resource '%s' doesn't match its digest", path);
+            return false;
+        }
+        return true;
+    }
+
+    // Called on the job thread
+    static int StoreResourcesJobProcess(LiveUpdateCtx* jobctx, StoreResourcesJob* job)
+    {
+        if (!job->m_Data)
+            return 0;
+
+        const char* hex_digest = job->m_Request->m_HexDigests[job->m_Index];
+
+        ResourceInfo info;
+        info.m_Archive = jobctx->m_LiveupdateArchive;
+        info.m_Resource = job->m_Data;
+        info.m_ResourceLength = job->m_DataLength;
+        info.m_ExpectedResourceDigest = hex_digest;
+        info.m_ExpectedResourceDigestLength = strlen(hex_digest);
+        return StoreResourceProcess(jobctx, &info);
+    }
+
+    static void StoreResourcesJobFinished(LiveUpdateCtx* jobctx, StoreResourcesJob* job, int result);
+
+    static void StoreResourcesDownloadThread(void* _request)
+    {
+        StoreResourcesInfo* request = (StoreResourcesInfo*)_request;
+
+        StoreResourcesDownload download;
+        download.m_Hash = 0;
+        download.m_Request = request;
+        download.m_Status = -1;
+
+        // The connection is kept alive between the requests
+        dmHttpClient::NewParams params;
+        params.m_HttpHeader = StoreResourcesHttpHeader;
+        params.m_HttpContent = StoreResourcesHttpContent;
+        params.m_Userdata = &download;
+        dmHttpClient::HClient client = 0;
+
+        while (!request->m_Canceled)
+        {
+            // Don't let the downloads run too far ahead of the writes
+            if (dmAtomicGet32(&request->m_Pending) >= STORE_RESOURCES_MAX_PENDING * (int32_t)request->m_ThreadCount)
+            {
+                dmTime::Sleep(1000);
+                continue;
+            }
+
+            uint32_t index = (uint32_t)dmAtomicIncrement32(&request->m_Next);
+            if (index >= request->m_Count)
+                break;
+
+            bool ok = false;
+            for (uint32_t attempt = 0; attempt < STORE_RESOURCES_MAX_ATTEMPTS && !ok && !request->m_Canceled; ++attempt)
+            {
+                if (!client)
+                {
+                    client = dmHttpClient::New(&params, request->m_BaseUri.m_Hostname, request->m_BaseUri.m_Port,
+                                                strcmp(request->m_BaseUri.m_Scheme, "https") == 0, &request->m_Canceled);
+                    if (!client)
+                    {
+                        dmLogWarning("Failed to connect to '%s'", request->m_BaseUri.m_Hostname);
+                        continue;
+                    }
+                    dmHttpClient::SetOptionInt(client, dmHttpClient::OPTION_REQUEST_HTTP2, 1);
+                }
+                ok = StoreResourcesDownloadOne(client, &download, request->m_HexDigests[index]);
+            }
+
+            StoreResourcesJob* job = new StoreResourcesJob;
+            job->m_Request = request;
+            job->m_Index = index;
+            job->m_Data = 0;
+            job->m_DataLength = 0;
+            if (ok)
+            {
+                job->m_DataLength = download.m_Buffer.Size();
+                job->m_Data = (uint8_t*)malloc(job->m_DataLength);
+                memcpy(job->m_Data, download.m_Buffer.Begin(), job->m_DataLength);
+            }
+
+            dmAtomicIncrement32(&request->m_Pending);
+            dmLiveUpdate::PushAsyncJob((dmJobThread::FProcess)StoreResourcesJobProcess, (dmJobThread::FCallback)StoreResourcesJobFinished, (void*)&g_LiveUpdate, job);
+        }
+
+        if (download.m_Hash)
+            dmCrypt::DeleteHash(download.m_Hash);
+        if (client)
+            dmHttpClient::Delete(client);
+    }
+
+    static void DeleteStoreResourcesRequest(StoreResourcesInfo* request)
+    {
+        request->m_Canceled = 1;
+        for (uint32_t i = 0; i < request->m_ThreadCount; ++i)
+        {
+            dmThread::Join(request->m_Threads[i]);
+        }
+        free(request->m_HexDigests);
+        free(request->m_HexDigestData);
+        delete request;
+    }
+
+    // Called on the main thread (see dmJobThread::Update below)
+    static void StoreResourcesJobFinished(LiveUpdateCtx* jobctx, StoreResourcesJob* job, int result)
+    {
+        StoreResourcesInfo* request = job->m_Request;
+        dmAtomicDecrement32(&request->m_Pending);
+
+        StoreResourcesProgress& progress = request->m_Progress;
+        progress.m_HexDigest = request->m_HexDigests[job->m_Index];
+        progress.m_Success = result == 1;
+        if (progress.m_Success)
+        {
+            progress.m_Stored++;
+            progress.m_BytesStored += job->m_DataLength;
+        }
+        else
+        {
+            progress.m_Failed++;
+        }
+        progress.m_Finished = progress.m_Stored + progress.m_Failed == progress.m_Total;
+
+        if (request->m_Callback)
+            request->m_Callback(&progress, request->m_CallbackData);
+
+        if (progress.m_Finished)
+        {
+            dmArray<StoreResourcesInfo*>& requests = jobctx->m_StoreResourcesRequests;
+            for (uint32_t i = 0; i < requests.Size(); ++i)
+            {
+                if (requests[i] == request)
+                {
+                    requests.EraseSwap(i);
+                    break;
+                }
+            }
+            DeleteStoreResourcesRequest(request);
+        }
+
+        free(job->m_Data);
+        delete job;
+    }
+
+    Result StoreResourcesAsync(const char* base_url, const char** hex_digests, uint32_t count, uint32_t connection_count,
+                                    void (*callback)(const StoreResourcesProgress*, void*), void* callback_data)
+    {
+        if (!IsLiveupdateEnabled())
+            return RESULT_NOT_INITIALIZED;
+
+        if(IsLiveupdateThreadDisabled())
+        {
+            return RESULT_INVAL;
+        }
+
+#if !defined(DM_HAS_THREADS)
+        dmLogError("Storing resources in batches is not supported on this platform. Use store_resource instead");
+        return RESULT_INVAL;
+#else
+        if (count == 0)
+            return RESULT_INVAL;
+
+        StoreResourcesInfo* request = new StoreResourcesInfo;
+        if (dmURI::Parse(base_url, &request->m_BaseUri) != dmURI::RESULT_OK ||
+            (strcmp(request->m_BaseUri.m_Scheme, "http") != 0 && strcmp(request->m_BaseUri.m_Scheme, "https") != 0))
+        {
+            dmLogError("Invalid url: '%s'", base_url);
+            delete request;
+            return RESULT_INVAL;
+        }
+
+        // The resources are hashed with MD5 or SHA1, see dmResource::CreateResourceHash
+        dmResource::HManifest manifest = g_LiveUpdate.m_LiveupdateArchiveManifest;
+        if (!manifest)
+            dmResourceProvider::GetManifest(g_LiveUpdate.m_ResourceBaseArchive, &manifest);
+        request->m_HashLength = manifest ? dmResource::GetEntryHashLength(manifest) : 0;
+        if (request->m_HashLength != 16 && request->m_HashLength != 20)
+        {
+            dmLogError("The resource hash algorithm of the manifest is not supported (digest length %u)", request->m_HashLength);
+            delete request;
+            return RESULT_INVAL;
+        }
+        request->m_HashAlgorithm = request->m_HashLength == 16 ? dmCrypt::HASH_ALGORITHM_MD5 : dmCrypt::HASH_ALGORITHM_SHA1;
+
+        uint32_t data_size = 0;
+        for (uint32_t i = 0; i < count; ++i)
+            data_size += strlen(hex_digests[i]) + 1;
+
+        request->m_HexDigests = (const char**)malloc(sizeof(const char*) * count);
+        request->m_HexDigestData = (char*)malloc(data_size);
+        char* cursor = request->m_HexDigestData;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t len = strlen(hex_digests[i]) + 1;
+            memcpy(cursor, hex_digests[i], len);
+            request->m_HexDigests[i] = cursor;
+            cursor += len;
+        }
+        request->m_Count = count;
+        request->m_Progress.m_Total = count;
+        request->m_Callback = callback;
+        request->m_CallbackData = callback_data;
+
+        if (g_LiveUpdate.m_StoreResourcesRequests.Full())
+            g_LiveUpdate.m_StoreResourcesRequests.OffsetCapacity(4);
+        g_LiveUpdate.m_StoreResourcesRequests.Push(request);
+
+        request->m_ThreadCount = dmMath::Clamp(connection_count, 1u, dmMath::Min(STORE_RESOURCES_MAX_CONNECTIONS, count));
+        for (uint32_t i = 0; i < request->m_ThreadCount; ++i)
+        {
+            char name[32];
+            dmSnPrintf(name, sizeof(name), "liveupdate_dl%u", i);
+            request->m_Threads[i] = dmThread::New(StoreResourcesDownloadThread, 0x20000, request, name);
+        }
+        return RESULT_OK;
+#endif
+    }
+
+    // ******************************************************************************************************************************************
+
     struct StoreManifestInfo
     {
         StoreManifestInfo() {
@@ -642,7 +1001,7 @@ namespace dmLiveUpdate
         if (job->m_Verify)
         {
             const char* public_key_path = dmResource::GetPublicKeyPath(g_LiveUpdate.m_ResourceFactory);
-            dmResource::Result result = dmLiveUpdate::VerifyZipArchive(job->m_Path, public_key_path);
+            dmResource::Result result = dmLiveUpdate::VerifyZipArchive(job->m_Path, public_key_path, g_LiveUpdate.m_VerifyJobThread);
             if (dmResource::RESULT_OK != result)
             {
                 dmLogError("Zip archive verification failed. Archive was not stored. %d %s", result, dmResource::ResultToString(result));
@@ -730,6 +1089,137 @@ namespace dmLiveUpdate
         return res == true ? RESULT_OK : RESULT_INVALID_RESOURCE;
     }
 
+    struct StoreArchivePatchInfo
+    {
+        StoreArchivePatchInfo() {
+            memset(this, 0, sizeof(*this));
+        }
+        const char*                     m_BasePath;     // The archive the patch was made from
+        const char*                     m_PatchPath;
+        const char*                     m_Path;         // The path to the patched zip file
+        const char*                     m_Name;         // The name of the mount
+        void                            (*m_Callback)(const char*, int, void*);
+        void*                           m_CallbackData;
+        int                             m_Priority;
+        uint8_t                         m_Verify:1;
+    };
+
+    // Called on the worker thread
+    static int StoreArchivePatchProcess(LiveUpdateCtx* jobctx, StoreArchivePatchInfo* job)
+    {
+        Result patch_result = dmLiveUpdate::ApplyArchivePatch(job->m_BasePath, job->m_PatchPath, job->m_Path);
+        if (RESULT_OK != patch_result)
+            return patch_result;
+
+        if (job->m_Verify)
+        {
+            const char* public_key_path = dmResource::GetPublicKeyPath(g_LiveUpdate.m_ResourceFactory);
+            dmResource::Result result = dmLiveUpdate::VerifyZipArchive(job->m_Path, public_key_path, g_LiveUpdate.m_VerifyJobThread);
+            if (dmResource::RESULT_OK != result)
+            {
+                dmLogError("Patched zip archive verification failed. Archive was not stored. %d %s", result, dmResource::ResultToString(result));
+                dmSys::Unlink(job->m_Path);
+                return RESULT_INVALID_RESOURCE;
+            }
+        }
+
+        char archive_uri[DMPATH_MAX_PATH];
+        dmSnPrintf(archive_uri, sizeof(archive_uri), "zip:%s", job->m_Path);
+
+        dmURI::Parts uri;
+        dmURI::Parse(archive_uri, &uri);
+
+        dmResourceProvider::HArchiveLoader loader = dmResourceProvider::FindLoaderByName(dmHashString64("zip"));
+        if (!loader)
+        {
+            dmLogError("Failed to find 'zip' loader");
+            return RESULT_IO_ERROR;
+        }
+
+        dmResourceProvider::HArchive archive = 0;
+        dmResourceProvider::Result provider_result = dmResourceProvider::CreateMount(loader, &uri, g_LiveUpdate.m_ResourceBaseArchive, &archive);
+        if (dmResourceProvider::RESULT_OK != provider_result)
+        {
+            dmLogError("Failed to create new zip archive from '%s'", archive_uri);
+            return RESULT_UNKNOWN;
+        }
+
+        // Swap the mounts while holding the lock, so that no resource is loaded in between
+        dmResourceMounts::HContext mounts = g_LiveUpdate.m_ResourceMounts;
+        dmMutex::HMutex mutex = dmResourceMounts::GetMutex(mounts);
+        DM_MUTEX_SCOPED_LOCK(mutex);
+
+        dmResourceMounts::SGetMountResult mount_info;
+        if (dmResource::RESULT_OK == dmResourceMounts::GetMountByName(mounts, job->m_Name, &mount_info))
+        {
+            dmResourceMounts::RemoveAndUnmountByName(mounts, job->m_Name);
+        }
+
+        dmResource::Result result = dmResourceMounts::AddMount(mounts, job->m_Name, archive, job->m_Priority, true);
+        if (dmResource::RESULT_OK != result)
+        {
+            dmLogError("Failed to mount patched zip archive: %s", dmResource::ResultToString(result));
+            dmResourceProvider::Unmount(archive);
+            return dmLiveUpdate::ResourceResultToLiveupdateResult(result);
+        }
+
+        // Flush the resource mounts to disc
+        dmResourceMounts::SaveMounts(mounts, g_LiveUpdate.m_AppSupportPath);
+
+        g_LiveUpdate.m_LiveupdateArchive = archive;
+        return RESULT_OK;
+    }
+
+    // Called on the main thread (see dmJobThread::Update below)
+    static void StoreArchivePatchFinished(LiveUpdateCtx* jobctx, StoreArchivePatchInfo* job, int result)
+    {
+        dmLogInfo("Finishing archive patch job: %d", result);
+        if (job->m_Callback)
+            job->m_Callback(job->m_Path, result, job->m_CallbackData);
+        free((void*)job->m_Name);
+        free((void*)job->m_Path);
+        free((void*)job->m_PatchPath);
+        free((void*)job->m_BasePath);
+        delete job;
+    }
+
+    Result StoreArchivePatchAsync(const char* base_path, const char* patch_path, const char* path, void (*callback)(const char*, int, void*), void* callback_data, const char* mountname, int priority, bool verify_archive)
+    {
+        if (!IsLiveupdateEnabled())
+            return RESULT_NOT_INITIALIZED;
+
+        if (!dmSys::Exists(base_path)) {
+            dmLogError("File does not exist: '%s'", base_path);
+            return RESULT_INVALID_RESOURCE;
+        }
+        if (!dmSys::Exists(patch_path)) {
+            dmLogError("File does not exist: '%s'", patch_path);
+            return RESULT_INVALID_RESOURCE;
+        }
+        if (strcmp(base_path, path) == 0) {
+            dmLogError("The patched archive cannot replace its base archive: '%s'", path);
+            return RESULT_INVAL;
+        }
+
+        if(IsLiveupdateThreadDisabled())
+        {
+            return RESULT_INVAL;
+        }
+
+        StoreArchivePatchInfo* info = new StoreArchivePatchInfo;
+        info->m_Priority = priority;
+        info->m_Name = strdup(mountname);
+        info->m_BasePath = strdup(base_path);
+        info->m_PatchPath = strdup(patch_path);
+        info->m_Path = strdup(path);
+        info->m_Callback = callback;
+        info->m_CallbackData = callback_data;
+        info->m_Verify = verify_archive;
+
+        bool res = dmLiveUpdate::PushAsyncJob((dmJobThread::FProcess)StoreArchivePatchProcess, (dmJobThread::FCallback)StoreArchivePatchFinished, (void*)&g_LiveUpdate, info);
+        return res == true ? RESULT_OK : RESULT_INVALID_RESOURCE;
+    }
+
     // ******************************************************************
     // ** LiveUpdate add mount
     // ******************************************************************
@@ -953,6 +1443,17 @@ namespace dmLiveUpdate
 
         g_LiveUpdate.m_JobThread = dmJobThread::Create(job_thread_create_param);
 
+        // The liveupdate job thread participates in the verification, so the extra threads are optional
+        uint32_t verify_thread_count = dmMath::Min((uint32_t)ConfigFileGetInt(params->m_ConfigFile, "liveupdate.verify_thread_count", 2), (uint32_t)dmJobThread::DM_MAX_JOB_THREAD_COUNT);
+        if (g_LiveUpdate.m_JobThread && verify_thread_count > 0 && dmJobThread::PlatformHasThreadSupport())
+        {
+            dmJobThread::JobThreadCreationParams verify_thread_create_param;
+            for (uint32_t i = 0; i < verify_thread_count; ++i)
+                verify_thread_create_param.m_ThreadNames[i] = "liveupdate_verify";
+            verify_thread_create_param.m_ThreadCount = (uint8_t)verify_thread_count;
+            g_LiveUpdate.m_VerifyJobThread = dmJobThread::Create(verify_thread_create_param);
+        }
+
         if (g_LiveUpdate.m_JobThread) // Make the liveupdate module `nil` if it isn't available
         {
             if (params->m_L) // TODO: until unit tests have been updated with a Lua context
@@ -970,9 +1471,30 @@ namespace dmLiveUpdate
         if (!IsLiveupdateEnabled())
             return dmExtension::RESULT_OK;
 
+        // The downloads push jobs, so they're stopped first. Unfinished requests don't get any more callbacks
+        for (uint32_t i = 0; i < g_LiveUpdate.m_StoreResourcesRequests.Size(); ++i)
+        {
+            StoreResourcesInfo* request = g_LiveUpdate.m_StoreResourcesRequests[i];
+            request->m_Canceled = 1;
+            for (uint32_t t = 0; t < request->m_ThreadCount; ++t)
+                dmThread::Join(request->m_Threads[t]);
+            request->m_ThreadCount = 0;
+        }
+
         if (g_LiveUpdate.m_JobThread)
             dmJobThread::Destroy(g_LiveUpdate.m_JobThread);
         g_LiveUpdate.m_JobThread = 0;
+
+        // Destroyed after the job thread, which may be verifying an archive
+        if (g_LiveUpdate.m_VerifyJobThread)
+            dmJobThread::Destroy(g_LiveUpdate.m_VerifyJobThread);
+        g_LiveUpdate.m_VerifyJobThread = 0;
+
+        for (uint32_t i = 0; i < g_LiveUpdate.m_StoreResourcesRequests.Size(); ++i)
+        {
+            DeleteStoreResourcesRequest(g_LiveUpdate.m_StoreResourcesRequests[i]);
+        }
+        g_LiveUpdate.m_StoreResourcesRequests.SetCapacity(0);
         g_LiveUpdate.m_ResourceFactory = 0;
         return dmExtension::RESULT_OK;
     }
@@ -65,11 +65,34 @@ namespace dmLiveUpdate
 
     Result StoreManifestAsync(const uint8_t* manifest_data, uint32_t manifest_len, void (*callback)(int, void*), void* callback_data);
 
+    /**
+     * Progress of a StoreResourcesAsync request. Reported once per resource
+     */
+    struct StoreResourcesProgress
+    {
+        const char* m_HexDigest;    // The resource that was stored, or failed
+        uint64_t    m_BytesStored;  // Total size of the stored resources
+        uint32_t    m_Stored;
+        uint32_t    m_Failed;
+        uint32_t    m_Total;
+        bool        m_Success;      // If this resource was stored
+        bool        m_Finished;     // If this was the last resource of the request
+    };
+
+    // Downloads the resources <base_url><hex digest> using several connections at once, and stores them in the liveupdate archive.
+    // The resources are verified while they are downloaded. The callback is called on the main thread
+    Result StoreResourcesAsync(const char* base_url, const char** hex_digests, uint32_t count, uint32_t connection_count,
+                                    void (*callback)(const StoreResourcesProgress*, void*), void* callback_data);
+
 
     // For .zip storage using the "zip" provider
     // Registers an archive (.zip) on disc
     Result StoreArchiveAsync(const char* path, void (*callback)(const char*, int, void*), void* callback_data, const char* mountname, int priority, bool verify_archive);
 
+    // Applies a patch (see arcdiff.py) to the base archive (.zip), and writes the patched archive to path.
+    // The patched archive is verified, and then replaces the mount with the same name
+    Result StoreArchivePatchAsync(const char* base_path, const char* patch_path, const char* path, void (*callback)(const char*, int, void*), void* callback_data, const char* mountname, int priority, bool verify_archive);
+
 
     // The new api
     Result AddMountAsync(const char* name, const char* uri, int priority, void (*callback)(const char*, const char*, int, void*), void* cbk_ctx);
@@ -0,0 +1,247 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "liveupdate_patch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dlib/crypt.h>
+#include <dlib/endian.h>
+#include <dlib/log.h>
+#include <dlib/sys.h>
+#include <dmsdk/dlib/profile.h>
+
+namespace dmLiveUpdate
+{
+    // The size of the buffer used when streaming the data
+    const uint32_t PATCH_CHUNK_SIZE = 64 * 1024;
+
+    struct PatchContext
+    {
+        FILE*                   m_Base;
+        FILE*                   m_Patch;
+        FILE*                   m_Out;
+        dmCrypt::HHashState     m_Hash;
+        uint8_t*                m_Buffer;
+        uint64_t                m_BaseSize;
+        uint64_t                m_BaseOffset;   // The current read position in the base archive
+        uint64_t                m_Written;
+    };
+
+    static bool ReadPatch(PatchContext* ctx, void* buf, uint32_t size)
+    {
+        return fread(buf, 1, size, ctx->m_Patch) == size;
+    }
+
+    static bool ReadPatchU32(PatchContext* ctx, uint32_t* value)
+    {
+        if (!ReadPatch(ctx, value, sizeof(*value)))
+            return false;
+        *value = dmEndian::ToHost(*value);
+        return true;
+    }
+
+    static bool ReadPatchU64(PatchContext* ctx, uint64_t* value)
+    {
+        if (!ReadPatch(ctx, value, sizeof(*value)))
+            return false;
+        *value = dmEndian::ToHost(*value);
+        return true;
+    }
+
+    static bool WriteOut(PatchContext* ctx, const uint8_t* buf, uint32_t size)
+    {
+        if (fwrite(buf, 1, size, ctx->m_Out) != size)
+            return false;
+        dmCrypt::UpdateHash(ctx->m_Hash, buf, size);
+        ctx->m_Written += size;
+        return true;
+    }
+
+    static Result ApplyCopy(PatchContext* ctx, uint64_t offset, uint32_t size)
+    {
+        if (offset > ctx->m_BaseSize || size > ctx->m_BaseSize - offset)
+        {
+            dmLogError("Patch copies outside of the base archive (offset: %llu, size: %u)", (unsigned long long)offset, size);
+            return RESULT_FORMAT_ERROR;
+        }
+
+        // Copies are mostly sequential, so we avoid the seek when possible
+        if (offset != ctx->m_BaseOffset)
+        {
+            if (fseek(ctx->m_Base, (long)offset, SEEK_SET) != 0)
+                return RESULT_IO_ERROR;
+            ctx->m_BaseOffset = offset;
+        }
+
+        while (size > 0)
+        {
+            uint32_t chunk = size < PATCH_CHUNK_SIZE ? size : PATCH_CHUNK_SIZE;
+            if (fread(ctx->m_Buffer, 1, chunk, ctx->m_Base) != chunk)
+                return RESULT_IO_ERROR;
+            ctx->m_BaseOffset += chunk;
+            if (!WriteOut(ctx, ctx->m_Buffer, chunk))
+                return RESULT_IO_ERROR;
+            size -= chunk;
+        }
+        return RESULT_OK;
+    }
+
+    static Result ApplyInsert(PatchContext* ctx, uint32_t size)
+    {
+        while (size > 0)
+        {
+            uint32_t chunk = size < PATCH_CHUNK_SIZE ? size : PATCH_CHUNK_SIZE;
+            if (!ReadPatch(ctx, ctx->m_Buffer, chunk))
+                return RESULT_FORMAT_ERROR;
+            if (!WriteOut(ctx, ctx->m_Buffer, chunk))
+                return RESULT_IO_ERROR;
+            size -= chunk;
+        }
+        return RESULT_OK;
+    }
+
+    static Result ApplyPatch(PatchContext* ctx)
+    {
+        PatchHeader header;
+        if (!ReadPatchU32(ctx, &header.m_Magic) || !ReadPatchU32(ctx, &header.m_Version) ||
+            !ReadPatchU64(ctx, &header.m_BaseSize) || !ReadPatchU64(ctx, &header.m_TargetSize) ||
+            !ReadPatch(ctx, header.m_TargetDigest, sizeof(header.m_TargetDigest)))
+        {
+            return RESULT_INVALID_HEADER;
+        }
+
+        if (header.m_Magic != PATCH_MAGIC)
+            return RESULT_INVALID_HEADER;
+        if (header.m_Version != PATCH_VERSION)
+        {
+            dmLogError("Unsupported patch version %u (expected %u)", header.m_Version, PATCH_VERSION);
+            return RESULT_VERSION_MISMATCH;
+        }
+
+        if (fseek(ctx->m_Base, 0, SEEK_END) != 0)
+            return RESULT_IO_ERROR;
+        ctx->m_BaseSize = (uint64_t)ftell(ctx->m_Base);
+        if (fseek(ctx->m_Base, 0, SEEK_SET) != 0)
+            return RESULT_IO_ERROR;
+
+        if (ctx->m_BaseSize != header.m_BaseSize)
+        {
+            dmLogError("The patch was made for another base archive (size %llu, expected %llu)", (unsigned long long)ctx->m_BaseSize, (unsigned long long)header.m_BaseSize);
+            return RESULT_VERSION_MISMATCH;
+        }
+
+        Result result = RESULT_OK;
+        while (result == RESULT_OK)
+        {
+            uint8_t op;
+            if (!ReadPatch(ctx, &op, 1))
+                return RESULT_FORMAT_ERROR;
+
+            if (op == PATCH_OP_END)
+                break;
+
+            if (op == PATCH_OP_COPY)
+            {
+                uint64_t offset;
+                uint32_t size;
+                if (!ReadPatchU64(ctx, &offset) || !ReadPatchU32(ctx, &size))
+                    return RESULT_FORMAT_ERROR;
+                result = ApplyCopy(ctx, offset, size);
+            }
+            else if (op == PATCH_OP_INSERT)
+            {
+                uint32_t size;
+                if (!ReadPatchU32(ctx, &size))
+                    return RESULT_FORMAT_ERROR;
+                result = ApplyInsert(ctx, size);
+            }
+            else
+            {
+                dmLogError("Unknown patch op: %u", op);
+                return RESULT_FORMAT_ERROR;
+            }
+
+            if (ctx->m_Written > header.m_TargetSize)
+            {
+                dmLogError("The patched archive is larger than expected (%llu bytes)", (unsigned long long)header.m_TargetSize);
+                return RESULT_FORMAT_ERROR;
+            }
+        }
+
+        if (result != RESULT_OK)
+            return result;
+
+        if (ctx->m_Written != header.m_TargetSize)
+        {
+            dmLogError("The patched archive has size %llu, expected %llu", (unsigned long long)ctx->m_Written, (unsigned long long)header.m_TargetSize);
+            return RESULT_FORMAT_ERROR;
+        }
+
+        uint8_t digest[sizeof(header.m_TargetDigest)];
+        dmCrypt::FinalizeHash(ctx->m_Hash, digest);
+        if (memcmp(digest, header.m_TargetDigest, sizeof(digest)) != 0)
+        {
+            dmLogError("The patched archive digest doesn't match the patch");
+            return RESULT_INVALID_RESOURCE;
+        }
+        return RESULT_OK;
+    }
+
+    Result ApplyArchivePatch(const char* base_path, const char* patch_path, const char* out_path)
+    {
+        DM_PROFILE("ApplyArchivePatch");
+
+        PatchContext ctx;
+        memset(&ctx, 0, sizeof(ctx));
+
+        Result result = RESULT_OK;
+        ctx.m_Base = fopen(base_path, "rb");
+        ctx.m_Patch = fopen(patch_path, "rb");
+        ctx.m_Out = fopen(out_path, "wb");
+        if (!ctx.m_Base || !ctx.m_Patch || !ctx.m_Out)
+        {
+            dmLogError("Failed to open the files to patch '%s' with '%s' into '%s'", base_path, patch_path, out_path);
+            result = RESULT_IO_ERROR;
+        }
+        else
+        {
+            ctx.m_Buffer = (uint8_t*)malloc(PATCH_CHUNK_SIZE);
+            ctx.m_Hash = dmCrypt::NewHash(dmCrypt::HASH_ALGORITHM_SHA1);
+            result = ApplyPatch(&ctx);
+            dmCrypt::DeleteHash(ctx.m_Hash);
+            free(ctx.m_Buffer);
+        }
+
+        if (ctx.m_Base)
+            fclose(ctx.m_Base);
+        if (ctx.m_Patch)
+            fclose(ctx.m_Patch);
+        if (ctx.m_Out)
+        {
+            if (fclose(ctx.m_Out) != 0 && result == RESULT_OK)
+                result = RESULT_IO_ERROR;
+        }
+
+        if (result != RESULT_OK)
+        {
+            dmLogError("Failed to patch '%s' with '%s': %s", base_path, patch_path, ResultToString(result));
+            if (ctx.m_Out)
+                dmSys::Unlink(out_path);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,60 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_LIVEUPDATE_PATCH_H
+#define DM_LIVEUPDATE_PATCH_H
+
+#include <stdint.h>
+#include "liveupdate.h"
+
+namespace dmLiveUpdate
+{
+    /*
+     * Archive patches, as created by arcdiff.py. All values are stored in network byte order:
+     *
+     *   PatchHeader
+     *   op*            (uint8_t op, followed by its arguments)
+     *   PATCH_OP_END
+     *
+     *   PATCH_OP_COPY:   uint64_t offset, uint32_t size     Copies bytes from the base archive
+     *   PATCH_OP_INSERT: uint32_t size, uint8_t data[size]  Inserts new bytes
+     */
+    const uint32_t PATCH_MAGIC   = 0x444D4450; // "DMDP"
+    const uint32_t PATCH_VERSION = 1;
+
+    enum PatchOp
+    {
+        PATCH_OP_END    = 0,
+        PATCH_OP_COPY   = 1,
+        PATCH_OP_INSERT = 2,
+    };
+
+    struct PatchHeader
+    {
+        uint32_t m_Magic;
+        uint32_t m_Version;
+        uint64_t m_BaseSize;
+        uint64_t m_TargetSize;
+        uint8_t  m_TargetDigest[20]; // SHA1 of the patched archive
+    };
+
+    /*
+     * Applies the patch to the base archive and writes the patched archive to out_path.
+     * The files are streamed in chunks, and the result is checked against the size and digest in the patch header.
+     * On failure, out_path is removed.
+     */
+    Result ApplyArchivePatch(const char* base_path, const char* patch_path, const char* out_path);
+}
+
+#endif // DM_LIVEUPDATE_PATCH_H
@@ -17,8 +17,16 @@
 #include <resource/resource_manifest.h>
 #include <resource/resource_verify.h>
 
+#include <stdio.h>
+
+#include <dlib/array.h>
+#include <dlib/dstrings.h>
+#include <dlib/hash.h>
 #include <dlib/log.h>
+#include <dlib/math.h>
 #include <dlib/memory.h>
+#include <dlib/path.h>
+#include <dlib/sys.h>
 #include <dlib/zip.h>
 
 namespace dmLiveUpdate
@@ -59,12 +67,104 @@ namespace dmLiveUpdate
         return data;
     }
 
-    static dmResource::Result VerifyZipEntries(dmResource::Manifest* manifest, dmZip::HZip zip)
+    // Max amount of entry data read before the entries are verified on the job threads
+    static const uint32_t VERIFY_BATCH_SIZE = 4 * 1024 * 1024;
+    static const uint32_t VERIFY_BATCH_MAX_ENTRIES = 256;
+
+    struct VerifyEntry
+    {
+        uint32_t            m_NameOffset;   // Offsets into the batch names/data, as the buffers may grow while the batch is read
+        uint32_t            m_DataOffset;
+        uint32_t            m_DataSize;
+        dmResource::Result  m_Result;
+    };
+
+    struct VerifyBatch
+    {
+        VerifyBatch() : m_Manifest(0) {}
+
+        dmResource::Manifest*   m_Manifest;
+        dmArray<VerifyEntry>    m_Entries;
+        dmArray<char>           m_Names;
+        dmArray<uint8_t>        m_Data;
+    };
+
+    static bool AddBatchEntry(VerifyBatch* batch, dmZip::HZip zip, const char* entry_name, uint32_t entry_size)
+    {
+        uint32_t name_len = strlen(entry_name) + 1;
+        if (batch->m_Names.Remaining() < name_len)
+            batch->m_Names.OffsetCapacity(dmMath::Max(name_len, 4096U));
+        if (batch->m_Data.Remaining() < entry_size)
+            batch->m_Data.OffsetCapacity(entry_size);
+
+        VerifyEntry entry;
+        entry.m_NameOffset = batch->m_Names.Size();
+        entry.m_DataOffset = batch->m_Data.Size();
+        entry.m_DataSize = entry_size;
+        entry.m_Result = dmResource::RESULT_OK;
+
+        batch->m_Data.SetSize(entry.m_DataOffset + entry_size);
+        if (dmZip::RESULT_OK != dmZip::GetEntryData(zip, batch->m_Data.Begin() + entry.m_DataOffset, entry_size))
+        {
+            batch->m_Data.SetSize(entry.m_DataOffset);
+            return false;
+        }
+
+        batch->m_Names.SetSize(entry.m_NameOffset + name_len);
+        memcpy(batch->m_Names.Begin() + entry.m_NameOffset, entry_name, name_len);
+
+        batch->m_Entries.PushGrow(entry);
+        return true;
+    }
+
+    // Called from the job threads. The manifest is only read
+    static void VerifyBatchEntries(void* _batch, uint32_t begin, uint32_t end)
+    {
+        VerifyBatch* batch = (VerifyBatch*)_batch;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            VerifyEntry& entry = batch->m_Entries[i];
+            const char* entry_name = batch->m_Names.Begin() + entry.m_NameOffset;
+
+            dmResourceArchive::LiveUpdateResource resource(batch->m_Data.Begin() + entry.m_DataOffset, entry.m_DataSize);
+            // NOTE: The entry "name" is the actual checksum of the contents of that file. It is not a url.
+            // NOTE: We probably need to handle custom files existing in the .zip file that _aren't_ part of the manifest
+            entry.m_Result = dmResource::VerifyResource(batch->m_Manifest, (const uint8_t*)entry_name, strlen(entry_name), resource.m_Data, resource.m_Count);
+        }
+    }
+
+    // Verifies the entries read so far, and returns the result of the first one that failed
+    static dmResource::Result FlushBatch(VerifyBatch* batch, dmJobThread::HContext job_thread)
+    {
+        dmJobThread::ParallelFor(job_thread, batch->m_Entries.Size(), 1, VerifyBatchEntries, batch);
+
+        dmResource::Result result = dmResource::RESULT_OK;
+        for (uint32_t i = 0; i < batch->m_Entries.Size(); ++i)
+        {
+            const VerifyEntry& entry = batch->m_Entries[i];
+            if (dmResource::RESULT_OK != entry.m_Result)
+            {
+                dmLogError("Failed to verify resource '%s' in archive", batch->m_Names.Begin() + entry.m_NameOffset);
+                result = entry.m_Result;
+                break;
+            }
+        }
+
+        batch->m_Entries.SetSize(0);
+        batch->m_Names.SetSize(0);
+        batch->m_Data.SetSize(0);
+        return result;
+    }
+
+    // The entries are read from the zip file in order, and hashed in batches on the job threads
+    static dmResource::Result VerifyZipEntries(dmResource::Manifest* manifest, dmZip::HZip zip, dmJobThread::HContext job_thread)
     {
         dmResource::Result result = dmResource::RESULT_OK;
         uint32_t num_entries = dmZip::GetNumEntries(zip);
-        uint32_t entry_data_capacity = 0;
-        uint8_t* entry_data = 0;
+
+        VerifyBatch batch;
+        batch.m_Manifest = manifest;
+
         for( uint32_t i = 0; i < num_entries && dmResource::RESULT_OK == result; ++i)
         {
             dmZip::Result zr = dmZip::OpenEntry(zip, i);
@@ -78,29 +178,21 @@ namespace dmLiveUpdate
                 if (dmZip::RESULT_OK != zr)
                 {
                     dmLogError("Could not get entry size '%s'", entry_name);
-                    dmZip::Close(zip);
-                    free((void*)entry_data);
+                    dmZip::CloseEntry(zip);
                     return dmResource::RESULT_INVALID_DATA;
                 }
 
-                if (entry_data_capacity < entry_size)
-                {
-                    entry_data = (uint8_t*)realloc(entry_data, entry_size);
-                    entry_data_capacity = entry_size;
-                }
-
-                zr = dmZip::GetEntryData(zip, entry_data, entry_size);
-
-                dmResourceArchive::LiveUpdateResource resource(entry_data, entry_size);
                 if (entry_size >= sizeof(dmResourceArchive::LiveUpdateResourceHeader))
                 {
-                    // NOTE: The entry "name" is the actual checksum of the contents of that file. It is not a url.
-                    // NOTE: We probably need to handle custom files existing in the .zip file that _aren't_ part of the manifest
-                    result = dmResource::VerifyResource(manifest, (const uint8_t*)entry_name, strlen(entry_name), resource.m_Data, resource.m_Count);
+                    if (batch.m_Entries.Size() > 0 && (batch.m_Data.Size() + entry_size > VERIFY_BATCH_SIZE || batch.m_Entries.Size() >= VERIFY_BATCH_MAX_ENTRIES))
+                    {
+                        result = FlushBatch(&batch, job_thread);
+                    }
 
-                    if (dmResource::RESULT_OK != result)
+                    if (dmResource::RESULT_OK == result && !AddBatchEntry(&batch, zip, entry_name, entry_size))
                     {
-                        dmLogError("Failed to verify resource '%s' in archive", entry_name);
+                        dmLogError("Could not read entry '%s'", entry_name);
+                        result = dmResource::RESULT_IO_ERROR;
                     }
                 }
                 else {
@@ -110,12 +202,117 @@ namespace dmLiveUpdate
 
             dmZip::CloseEntry(zip);
         }
-        free((void*)entry_data);
+
+        if (dmResource::RESULT_OK == result)
+        {
+            result = FlushBatch(&batch, job_thread);
+        }
+
+        // As before, a failing entry stops the verification and is logged, but doesn't fail the archive
+        // (see the note on custom files above)
         return dmResource::RESULT_OK;
     }
 
-    dmResource::Result VerifyZipArchive(const char* path, const char* public_key_path)
+    // The marker stores the size and modification time of an archive that passed verification,
+    // so that the archive isn't verified again until it changes
+    static const uint32_t VERIFIED_MARKER_MAGIC = 0x444D5646; // "DMVF"
+    static const uint32_t VERIFIED_MARKER_VERSION = 1;
+
+    struct VerifiedMarker
+    {
+        uint32_t m_Magic;
+        uint32_t m_Version;
+        uint64_t m_Size;
+        uint64_t m_PublicKeyHash;   // The archive is verified again if the key or the engine changes
+        uint64_t m_EngineHash;
+        uint32_t m_ModifiedTime;
+        uint32_t m_Padding;
+    };
+
+    static void GetVerifiedMarkerPath(const char* path, char* buffer, uint32_t buffer_size)
+    {
+        dmStrlCpy(buffer, path, buffer_size);
+        dmStrlCat(buffer, ".verified", buffer_size);
+    }
+
+    static bool CreateVerifiedMarker(const char* path, const char* public_key_path, VerifiedMarker* marker)
+    {
+        dmSys::StatInfo info;
+        if (dmSys::RESULT_OK != dmSys::Stat(path, &info))
+            return false;
+
+        dmSys::EngineInfo engine_info;
+        dmSys::GetEngineInfo(&engine_info);
+
+        memset(marker, 0, sizeof(*marker));
+        marker->m_Magic = VERIFIED_MARKER_MAGIC;
+        marker->m_Version = VERIFIED_MARKER_VERSION;
+        marker->m_Size = info.m_Size;
+        marker->m_ModifiedTime = info.m_ModifiedTime;
+        marker->m_PublicKeyHash = dmHashString64(public_key_path);
+        marker->m_EngineHash = dmHashString64(engine_info.m_Version);
+        return true;
+    }
+
+    static bool IsArchiveVerified(const char* path, const char* public_key_path)
     {
+        VerifiedMarker expected;
+        if (!CreateVerifiedMarker(path, public_key_path, &expected))
+            return false;
+
+        char marker_path[DMPATH_MAX_PATH];
+        GetVerifiedMarkerPath(path, marker_path, sizeof(marker_path));
+
+        FILE* f = fopen(marker_path, "rb");
+        if (!f)
+            return false;
+
+        VerifiedMarker marker;
+        bool verified = fread(&marker, 1, sizeof(marker), f) == sizeof(marker) && memcmp(&marker, &expected, sizeof(marker)) == 0;
+        fclose(f);
+        return verified;
+    }
+
+    static void StoreVerifiedMarker(const char* path, const char* public_key_path)
+    {
+        VerifiedMarker marker;
+        if (!CreateVerifiedMarker(path, public_key_path, &marker))
+            return;
+
+        char marker_path[DMPATH_MAX_PATH];
+        GetVerifiedMarkerPath(path, marker_path, sizeof(marker_path));
+
+        FILE* f = fopen(marker_path, "wb");
+        if (!f)
+        {
+            dmLogWarning("Could not create '%s'", marker_path);
+            return;
+        }
+        bool ok = fwrite(&marker, 1, sizeof(marker), f) == sizeof(marker);
+        fclose(f);
+        if (!ok)
+            dmSys::Unlink(marker_path);
+    }
+
+    static void RemoveVerifiedMarker(const char* path)
+    {
+        char marker_path[DMPATH_MAX_PATH];
+        GetVerifiedMarkerPath(path, marker_path, sizeof(marker_path));
+        if (dmSys::Exists(marker_path))
+            dmSys::Unlink(marker_path);
+    }
+
+    dmResource::Result VerifyZipArchive(const char* path, const char* public_key_path, dmJobThread::HContext job_thread)
+    {
+        if (IsArchiveVerified(path, public_key_path))
+        {
+            dmLogInfo("Archive '%s' is unchanged since it was verified", path);
+            return dmResource::RESULT_OK;
+        }
+
+        // Don't trust an old marker if the verification below fails
+        RemoveVerifiedMarker(path);
+
         dmLogInfo("Verifying archive '%s'", path);
 
         dmZip::HZip zip;
@@ -161,7 +358,7 @@ namespace dmLiveUpdate
 
         // TODO: What to do here. It is now ok for a liveupdate manifest/archive to not contain all the resources
         //      * We can require the manifest to only contain entries for the files in the archive
-        result = VerifyZipEntries(manifest, zip);
+        result = VerifyZipEntries(manifest, zip, job_thread);
         if (dmResource::RESULT_OK != result)
         {
             dmLogError("Manifest references non existing resources");
@@ -177,6 +374,11 @@ cleanup:
 
         dmZip::Close(zip);
 
+        if (dmResource::RESULT_OK == result)
+        {
+            StoreVerifiedMarker(path, public_key_path);
+        }
+
         dmLogInfo("Archive load and verify: %s", dmResource::ResultToString(result));
 
         return result;
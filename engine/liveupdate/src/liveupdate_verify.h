@@ -17,10 +17,13 @@
 
 #include "liveupdate.h"
 #include <resource/resource.h>
+#include <dlib/job_thread.h>
 
 namespace dmLiveUpdate
 {
-    dmResource::Result VerifyZipArchive(const char* path, const char* public_key_path);
+    // Verifies the manifest signature and the entry hashes. The entries are hashed on the job threads, if a context is given.
+    // A marker file is stored next to a verified archive, and it isn't verified again until its size or modification time changes
+    dmResource::Result VerifyZipArchive(const char* path, const char* public_key_path, dmJobThread::HContext job_thread);
 }
 
 #endif // DM_LIVEUPDATE_VERIFY_H
@@ -16,6 +16,7 @@
 #include "liveupdate.h"
 #include "liveupdate_private.h"
 
+#include <dlib/array.h>
 #include <dlib/log.h>
 #include <dlib/uri.h>
 #include <extension/extension.h>
@@ -151,6 +152,97 @@ namespace dmLiveUpdate
         return 0;
     }
 
+    static void Callback_StoreResources(const dmLiveUpdate::StoreResourcesProgress* progress, void* _cbk)
+    {
+        dmScript::LuaCallbackInfo* cbk = (dmScript::LuaCallbackInfo*)_cbk;
+
+        if (dmScript::IsCallbackValid(cbk))
+        {
+            lua_State* L = dmScript::GetCallbackLuaContext(cbk);
+            DM_LUA_STACK_CHECK(L, 0)
+
+            if (dmScript::SetupCallback(cbk))
+            {
+                lua_pushstring(L, progress->m_HexDigest);
+                lua_pushboolean(L, progress->m_Success);
+
+                lua_newtable(L);
+                lua_pushinteger(L, progress->m_Stored);
+                lua_setfield(L, -2, "stored");
+                lua_pushinteger(L, progress->m_Failed);
+                lua_setfield(L, -2, "failed");
+                lua_pushinteger(L, progress->m_Total);
+                lua_setfield(L, -2, "total");
+                lua_pushnumber(L, (lua_Number)progress->m_BytesStored);
+                lua_setfield(L, -2, "bytes");
+                lua_pushboolean(L, progress->m_Finished);
+                lua_setfield(L, -2, "finished");
+
+                dmScript::PCall(L, 4, 0); // instance + 3
+
+                dmScript::TeardownCallback(cbk);
+            }
+            else
+            {
+                dmLogError("Failed to setup callback");
+            }
+        }
+
+        if (progress->m_Finished)
+        {
+            dmScript::DestroyCallback(cbk);
+        }
+    }
+
+    static int Resource_StoreResources(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+        int top = lua_gettop(L);
+
+        const char* base_url = luaL_checkstring(L, 1);
+        luaL_checktype(L, 2, LUA_TTABLE);
+
+        uint32_t connections = 4;
+        if (top > 3 && !lua_isnil(L, 4)) {
+            luaL_checktype(L, 4, LUA_TTABLE);
+            lua_pushvalue(L, 4);
+            lua_pushnil(L);
+            while (lua_next(L, -2)) {
+                const char* attr = lua_tostring(L, -2);
+                if (strcmp(attr, "connections") == 0)
+                {
+                    connections = (uint32_t)luaL_checkinteger(L, -1);
+                }
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+        }
+
+        // The strings are copied by StoreResourcesAsync, so they only need to live until it returns
+        uint32_t count = (uint32_t)lua_objlen(L, 2);
+        dmArray<const char*> hex_digests;
+        hex_digests.SetCapacity(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            lua_rawgeti(L, 2, i+1);
+            const char* hex_digest = lua_tostring(L, -1);
+            lua_pop(L, 1);
+            if (!hex_digest)
+                return DM_LUA_ERROR("The resource digest at index %u is not a string", i+1);
+            hex_digests.Push(hex_digest);
+        }
+
+        dmScript::LuaCallbackInfo* cbk = dmScript::CreateCallback(L, 3);
+
+        dmLiveUpdate::Result res = dmLiveUpdate::StoreResourcesAsync(base_url, hex_digests.Begin(), count, connections, Callback_StoreResources, cbk);
+        if (dmLiveUpdate::RESULT_OK != res)
+        {
+            dmLogError("The liveupdate resources could not be stored: %s", dmLiveUpdate::ResultToString(res));
+            dmScript::DestroyCallback(cbk);
+        }
+        return 0;
+    }
+
     static void Callback_StoreManifest(int _result, void* _cbk)
     {
         dmLiveUpdate::Result result = (dmLiveUpdate::Result)_result;
@@ -257,6 +349,45 @@ namespace dmLiveUpdate
         return 0;
     }
 
+    static int Resource_StoreArchivePatch(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+        int top = lua_gettop(L);
+
+        const char* base_path = luaL_checkstring(L, 1);
+        const char* patch_path = luaL_checkstring(L, 2);
+        const char* path = luaL_checkstring(L, 3);
+
+        dmScript::LuaCallbackInfo* cbk = dmScript::CreateCallback(L, 4);
+
+        bool verify_archive = true;
+        if (top > 4 && !lua_isnil(L, 5)) {
+            luaL_checktype(L, 5, LUA_TTABLE);
+            lua_pushvalue(L, 5);
+            lua_pushnil(L);
+            while (lua_next(L, -2)) {
+                const char* attr = lua_tostring(L, -2);
+                if (strcmp(attr, "verify") == 0)
+                {
+                    verify_archive = lua_toboolean(L, -1);
+                }
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+        }
+
+        const char* name = LIVEUPDATE_LEGACY_MOUNT_NAME;
+        int priority = LIVEUPDATE_LEGACY_MOUNT_PRIORITY;
+
+        dmLiveUpdate::Result res = dmLiveUpdate::StoreArchivePatchAsync(base_path, patch_path, path, Callback_StoreArchive, cbk, name, priority, verify_archive);
+        if (dmLiveUpdate::RESULT_OK != res)
+        {
+            dmLogError("The liveupdate archive patch '%s' could not be applied: %s", patch_path, dmLiveUpdate::ResultToString(res));
+            dmScript::DestroyCallback(cbk);
+        }
+        return 0;
+    }
+
     // ************************************************************************************
     // Mount support
 
@@ -386,8 +517,10 @@ namespace dmLiveUpdate
         {"get_current_manifest", dmLiveUpdate::Resource_GetCurrentManifest},        /// bogus data, and never used?
         {"is_using_liveupdate_data", dmLiveUpdate::Resource_IsUsingLiveUpdateData},
         {"store_resource", dmLiveUpdate::Resource_StoreResource}, // Stores a single resource
+        {"store_resources", dmLiveUpdate::Resource_StoreResources}, // Downloads and stores many resources
         {"store_manifest", dmLiveUpdate::Resource_StoreManifest}, // Store a .dmanifest file
         {"store_archive", dmLiveUpdate::Resource_StoreArchive},   // Store a .zip archive
+        {"store_archive_patch", dmLiveUpdate::Resource_StoreArchivePatch},   // Patch a .zip archive, and store the result
 
 // New api
         {"get_mounts",      dmLiveUpdate::Resource_GetMounts},      // Gets a list of the current mounts
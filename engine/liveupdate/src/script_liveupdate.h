@@ -100,6 +100,58 @@ namespace dmLiveUpdate
  * ```
  */
 
+/*# download and store many resources to the data archive
+ *
+ * Downloads the resources from `base_url .. hexdigest`, using several connections at once,
+ * and stores them in the data archive. Each resource is verified while it is downloaded,
+ * and a resource that fails to download or verify is retried once.
+ *
+ * @note The request is asynchronous
+ * @note Not supported on platforms without threads (HTML5). Use `liveupdate.store_resource` there
+ *
+ * @name liveupdate.store_resources
+ * @param base_url [type:string] The url to download the resources from, e.g. "http://example.defold.com:8000/"
+ * @param hexdigests [type:table] The hashes of the resources to store,
+ * retrieved through collectionproxy.missing_resources.
+ * @param callback [type:function(self, hexdigest, status, progress)] The callback
+ * function that is executed once for each resource.
+ *
+ * `self`
+ * : [type:object] The current object.
+ *
+ * `hexdigest`
+ * : [type:string] The hexdigest of the resource.
+ *
+ * `status`
+ * : [type:boolean] Whether or not the resource was successfully stored.
+ *
+ * `progress`
+ * : [type:table] The progress of the whole request:
+ *
+ * - [type:number] `stored`: Number of stored resources
+ * - [type:number] `failed`: Number of resources that failed
+ * - [type:number] `total`: Number of resources in the request
+ * - [type:number] `bytes`: Total size of the stored resources
+ * - [type:boolean] `finished`: If this was the last resource of the request
+ *
+ * @param [options] [type:table] Optional table with extra parameters. Supported entries:
+ *
+ * - [type:number] `connections`: The number of concurrent downloads (1 to 8). Default is 4
+ *
+ * @examples
+ *
+ * ```lua
+ * local function load_resources(self, target)
+ *      local resources = collectionproxy.missing_resources(target)
+ *      liveupdate.store_resources("http://example.defold.com:8000/", resources, function(self, hexdigest, status, progress)
+ *           if progress.finished then
+ *                print(string.format("Stored %d of %d resources", progress.stored, progress.total))
+ *           end
+ *      end, { connections = 8 })
+ * end
+ * ```
+ */
+
 /*# create, verify, and store a manifest to device
  *
  * Create a new manifest from a buffer. The created manifest is verified
@@ -278,6 +330,50 @@ namespace dmLiveUpdate
  *
  */
 
+/*# applies a patch to a live update archive
+ *
+ * Applies a patch, created with `arcdiff.py`, to a previously downloaded zip archive. The patched archive
+ * is written to a new file in chunks on a worker thread, and is checked against the digest in the patch.
+ * Just like `liveupdate.store_archive`, the contents are then verified against the manifest, and the
+ * patched archive replaces the current live update archive.
+ *
+ * @name liveupdate.store_archive_patch
+ * @param base_path [type:string] the path to the archive that the patch was created from
+ * @param patch_path [type:string] the path to the patch file
+ * @param path [type:string] the path of the patched archive. Must not be the same as `base_path`
+ * @param callback [type:function(self, path, status)] the callback function
+ * executed after the patched archive has been stored
+ *
+ * `self`
+ * : [type:object] The current object.
+ *
+ * `path`
+ * : [type:string] The path of the patched archive.
+ *
+ * `status`
+ * : [type:boolean] true if the archive was patched and stored
+ *
+ * @param [options] [type:table] optional table with extra parameters. Supported entries:
+ *
+ * - [type:boolean] `verify`: if the patched archive should be verified as well as stored (defaults to true)
+ *
+ * @examples
+ *
+ * ```lua
+ * local function store_archive_cb(self, path, status)
+ *     if status == true then
+ *         os.remove(self.base_path)
+ *         sys.reboot()
+ *     end
+ * end
+ *
+ * function on_patch_downloaded(self, patch_path)
+ *     local path = sys.get_save_file("LiveUpdateDemo", "defold.resourcepack.v2.zip")
+ *     liveupdate.store_archive_patch(self.base_path, patch_path, path, store_archive_cb)
+ * end
+ * ```
+ */
+
 /*# is any liveupdate data mounted and currently in use
  *
  * Is any liveupdate data mounted and currently in use?
@@ -0,0 +1,209 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <dlib/array.h>
+#include <dlib/crypt.h>
+#include <dlib/endian.h>
+#include <dlib/sys.h>
+#include "../liveupdate_patch.h"
+
+#define BASE_PATH   "tmp/patch_base.zip"
+#define PATCH_PATH  "tmp/patch.dmdp"
+#define OUT_PATH    "tmp/patch_out.zip"
+
+static void WriteFile(const char* path, const uint8_t* data, uint32_t size)
+{
+    FILE* f = fopen(path, "wb");
+    ASSERT_NE((FILE*)0, f);
+    ASSERT_EQ(size, (uint32_t)fwrite(data, 1, size, f));
+    fclose(f);
+}
+
+static bool ReadFile(const char* path, dmArray<uint8_t>& data)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return false;
+    uint8_t buf[256];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    {
+        data.OffsetCapacity(n);
+        data.PushArray(buf, n);
+    }
+    fclose(f);
+    return true;
+}
+
+class PatchWriter
+{
+public:
+    void PushU8(uint8_t v)
+    {
+        m_Data.OffsetCapacity(1);
+        m_Data.Push(v);
+    }
+    void PushU32(uint32_t v)
+    {
+        v = dmEndian::ToNetwork(v);
+        m_Data.OffsetCapacity(sizeof(v));
+        m_Data.PushArray((uint8_t*)&v, sizeof(v));
+    }
+    void PushU64(uint64_t v)
+    {
+        v = dmEndian::ToNetwork(v);
+        m_Data.OffsetCapacity(sizeof(v));
+        m_Data.PushArray((uint8_t*)&v, sizeof(v));
+    }
+    void Header(uint64_t base_size, const uint8_t* target, uint32_t target_size)
+    {
+        PushU32(dmLiveUpdate::PATCH_MAGIC);
+        PushU32(dmLiveUpdate::PATCH_VERSION);
+        PushU64(base_size);
+        PushU64(target_size);
+
+        uint8_t digest[20];
+        dmCrypt::HHashState hash = dmCrypt::NewHash(dmCrypt::HASH_ALGORITHM_SHA1);
+        dmCrypt::UpdateHash(hash, target, target_size);
+        dmCrypt::FinalizeHash(hash, digest);
+        dmCrypt::DeleteHash(hash);
+        m_Data.OffsetCapacity(sizeof(digest));
+        m_Data.PushArray(digest, sizeof(digest));
+    }
+    void Copy(uint64_t offset, uint32_t size)
+    {
+        PushU8(dmLiveUpdate::PATCH_OP_COPY);
+        PushU64(offset);
+        PushU32(size);
+    }
+    void Insert(const char* data)
+    {
+        uint32_t size = strlen(data);
+        PushU8(dmLiveUpdate::PATCH_OP_INSERT);
+        PushU32(size);
+        m_Data.OffsetCapacity(size);
+        m_Data.PushArray((const uint8_t*)data, size);
+    }
+    void End()
+    {
+        PushU8(dmLiveUpdate::PATCH_OP_END);
+    }
+    void Write(const char* path)
+    {
+        WriteFile(path, m_Data.Begin(), m_Data.Size());
+    }
+
+    dmArray<uint8_t> m_Data;
+};
+
+static const char* BASE = "The quick brown fox jumps over the lazy dog";
+static const char* TARGET = "The quick red fox jumps over the lazy dog!";
+
+class LiveUpdatePatchTest : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        dmSys::Mkdir("tmp", 0777);
+        WriteFile(BASE_PATH, (const uint8_t*)BASE, strlen(BASE));
+    }
+    virtual void TearDown()
+    {
+        dmSys::Unlink(BASE_PATH);
+        dmSys::Unlink(PATCH_PATH);
+        dmSys::Unlink(OUT_PATH);
+    }
+
+    void WriteTargetPatch(PatchWriter& writer)
+    {
+        writer.Copy(0, 10);             // "The quick "
+        writer.Insert("red");
+        writer.Copy(15, strlen(BASE) - 15); // " fox jumps over the lazy dog"
+        writer.Insert("!");
+        writer.End();
+    }
+};
+
+TEST_F(LiveUpdatePatchTest, Apply)
+{
+    PatchWriter writer;
+    writer.Header(strlen(BASE), (const uint8_t*)TARGET, strlen(TARGET));
+    WriteTargetPatch(writer);
+    writer.Write(PATCH_PATH);
+
+    ASSERT_EQ(dmLiveUpdate::RESULT_OK, dmLiveUpdate::ApplyArchivePatch(BASE_PATH, PATCH_PATH, OUT_PATH));
+
+    dmArray<uint8_t> out;
+    ASSERT_TRUE(ReadFile(OUT_PATH, out));
+    ASSERT_EQ(strlen(TARGET), out.Size());
+    ASSERT_EQ(0, memcmp(TARGET, out.Begin(), out.Size()));
+}
+
+TEST_F(LiveUpdatePatchTest, WrongBase)
+{
+    PatchWriter writer;
+    writer.Header(strlen(BASE) + 1, (const uint8_t*)TARGET, strlen(TARGET));
+    WriteTargetPatch(writer);
+    writer.Write(PATCH_PATH);
+
+    ASSERT_EQ(dmLiveUpdate::RESULT_VERSION_MISMATCH, dmLiveUpdate::ApplyArchivePatch(BASE_PATH, PATCH_PATH, OUT_PATH));
+    ASSERT_FALSE(dmSys::Exists(OUT_PATH));
+}
+
+TEST_F(LiveUpdatePatchTest, DigestMismatch)
+{
+    PatchWriter writer;
+    writer.Header(strlen(BASE), (const uint8_t*)BASE, strlen(TARGET)); // Right size, wrong content
+    WriteTargetPatch(writer);
+    writer.Write(PATCH_PATH);
+
+    ASSERT_EQ(dmLiveUpdate::RESULT_INVALID_RESOURCE, dmLiveUpdate::ApplyArchivePatch(BASE_PATH, PATCH_PATH, OUT_PATH));
+    ASSERT_FALSE(dmSys::Exists(OUT_PATH));
+}
+
+TEST_F(LiveUpdatePatchTest, CopyOutOfBounds)
+{
+    PatchWriter writer;
+    writer.Header(strlen(BASE), (const uint8_t*)TARGET, strlen(TARGET));
+    writer.Copy(strlen(BASE) - 4, 8);
+    writer.End();
+    writer.Write(PATCH_PATH);
+
+    ASSERT_EQ(dmLiveUpdate::RESULT_FORMAT_ERROR, dmLiveUpdate::ApplyArchivePatch(BASE_PATH, PATCH_PATH, OUT_PATH));
+    ASSERT_FALSE(dmSys::Exists(OUT_PATH));
+}
+
+TEST_F(LiveUpdatePatchTest, Truncated)
+{
+    PatchWriter writer;
+    writer.Header(strlen(BASE), (const uint8_t*)TARGET, strlen(TARGET));
+    WriteTargetPatch(writer);
+    writer.m_Data.SetSize(writer.m_Data.Size() - 4);
+    writer.Write(PATCH_PATH);
+
+    ASSERT_NE(dmLiveUpdate::RESULT_OK, dmLiveUpdate::ApplyArchivePatch(BASE_PATH, PATCH_PATH, OUT_PATH));
+    ASSERT_FALSE(dmSys::Exists(OUT_PATH));
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
@@ -279,6 +279,11 @@ void InitializeJNITypes(JNIEnv* env, TypeInfos* infos) {
     {
         SETUP_CLASS(OptionsJNI, "Options");
         GET_FLD_TYPESTR(dummy, "I");
+        GET_FLD_TYPESTR(optimizeMeshes, "Z");
+        GET_FLD_TYPESTR(animationSampleRate, "F");
+        GET_FLD_TYPESTR(animationTranslationTolerance, "F");
+        GET_FLD_TYPESTR(animationRotationTolerance, "F");
+        GET_FLD_TYPESTR(animationScaleTolerance, "F");
     }
     #undef GET_FLD
     #undef GET_FLD_ARRAY
@@ -666,6 +671,11 @@ jobject C2J_CreateOptions(JNIEnv* env, TypeInfos* types, const Options* src) {
     if (src == 0) return 0;
     jobject obj = env->AllocObject(types->m_OptionsJNI.cls);
     dmJNI::SetInt(env, obj, types->m_OptionsJNI.dummy, src->dummy);
+    dmJNI::SetBoolean(env, obj, types->m_OptionsJNI.optimizeMeshes, src->m_OptimizeMeshes);
+    dmJNI::SetFloat(env, obj, types->m_OptionsJNI.animationSampleRate, src->m_AnimationSampleRate);
+    dmJNI::SetFloat(env, obj, types->m_OptionsJNI.animationTranslationTolerance, src->m_AnimationTranslationTolerance);
+    dmJNI::SetFloat(env, obj, types->m_OptionsJNI.animationRotationTolerance, src->m_AnimationRotationTolerance);
+    dmJNI::SetFloat(env, obj, types->m_OptionsJNI.animationScaleTolerance, src->m_AnimationScaleTolerance);
     return obj;
 }
 
@@ -2231,6 +2241,11 @@ bool J2C_CreateScene(JNIEnv* env, TypeInfos* types, jobject obj, Scene* out) {
 bool J2C_CreateOptions(JNIEnv* env, TypeInfos* types, jobject obj, Options* out) {
     if (out == 0) return false;
     out->dummy = dmJNI::GetInt(env, obj, types->m_OptionsJNI.dummy);
+    out->m_OptimizeMeshes = dmJNI::GetBoolean(env, obj, types->m_OptionsJNI.optimizeMeshes);
+    out->m_AnimationSampleRate = dmJNI::GetFloat(env, obj, types->m_OptionsJNI.animationSampleRate);
+    out->m_AnimationTranslationTolerance = dmJNI::GetFloat(env, obj, types->m_OptionsJNI.animationTranslationTolerance);
+    out->m_AnimationRotationTolerance = dmJNI::GetFloat(env, obj, types->m_OptionsJNI.animationRotationTolerance);
+    out->m_AnimationScaleTolerance = dmJNI::GetFloat(env, obj, types->m_OptionsJNI.animationScaleTolerance);
     return true;
 }
 
@@ -263,6 +263,11 @@ struct SceneJNI {
 struct OptionsJNI {
     jclass cls;
     jfieldID dummy;
+    jfieldID optimizeMeshes;
+    jfieldID animationSampleRate;
+    jfieldID animationTranslationTolerance;
+    jfieldID animationRotationTolerance;
+    jfieldID animationScaleTolerance;
 };
 struct TypeInfos {
     Vector3JNI m_Vector3JNI;
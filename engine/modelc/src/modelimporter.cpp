@@ -16,9 +16,12 @@
 #include "modelimporter.h"
 #include <dmsdk/dlib/log.h>
 #include <dmsdk/dlib/dstrings.h>
+#include <dmsdk/dlib/math.h>
 #include <stdio.h>
 #include <stdlib.h> // getenv
 #include <string.h>
+#include <atomic>
+#include <thread>
 
 
 static void SetLogLevel()
@@ -42,10 +45,21 @@ static void SetLogLevel()
     dmLogSetLevel(severity);
 }
 
+// 0 means one thread per core
+static uint32_t g_MaxThreads = 0;
+
+static void SetMaxThreadsFromEnv()
+{
+    const char* env_num_threads = getenv("DM_MODELC_NUM_THREADS");
+    if (env_num_threads)
+        g_MaxThreads = (uint32_t)atoi(env_num_threads);
+}
+
 struct ModelImporterInitializer
 {
     ModelImporterInitializer() {
         SetLogLevel();
+        SetMaxThreadsFromEnv();
     }
 } g_ModelImporterInitializer;
 
@@ -54,6 +68,12 @@ namespace dmModelImporter
 {
 
 Options::Options()
+: dummy(0)
+, m_OptimizeMeshes(false)
+, m_AnimationSampleRate(0.0f)
+, m_AnimationTranslationTolerance(0.0f)
+, m_AnimationRotationTolerance(0.0f)
+, m_AnimationScaleTolerance(0.0f)
 {
 }
 
@@ -280,4 +300,58 @@ void EnableDebugLogging(bool enable)
     dmLogSetLevel( enable ? LOG_SEVERITY_DEBUG : LOG_SEVERITY_WARNING);
 }
 
+void SetMaxThreads(uint32_t max_threads)
+{
+    g_MaxThreads = max_threads;
+}
+
+struct ParallelForContext
+{
+    void                  (*m_Fn)(void* ctx, uint32_t index);
+    void*                 m_Ctx;
+    uint32_t              m_Count;
+    std::atomic<uint32_t> m_Next;
+};
+
+static void ParallelForWorker(ParallelForContext* ctx)
+{
+    while (true)
+    {
+        uint32_t index = ctx->m_Next.fetch_add(1);
+        if (index >= ctx->m_Count)
+            break;
+        ctx->m_Fn(ctx->m_Ctx, index);
+    }
+}
+
+void ParallelFor(uint32_t count, void (*fn)(void* ctx, uint32_t index), void* ctx)
+{
+    uint32_t num_threads = g_MaxThreads;
+    if (num_threads == 0)
+        num_threads = dmMath::Max(1U, (uint32_t)std::thread::hardware_concurrency());
+    num_threads = dmMath::Min(num_threads, count);
+
+    if (num_threads <= 1)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            fn(ctx, i);
+        return;
+    }
+
+    ParallelForContext pctx;
+    pctx.m_Fn = fn;
+    pctx.m_Ctx = ctx;
+    pctx.m_Count = count;
+    pctx.m_Next = 0;
+
+    // The calling thread is one of the workers
+    std::thread* threads = new std::thread[num_threads - 1];
+    for (uint32_t i = 0; i < num_threads - 1; ++i)
+        threads[i] = std::thread(ParallelForWorker, &pctx);
+    ParallelForWorker(&pctx);
+    for (uint32_t i = 0; i < num_threads - 1; ++i)
+        threads[i].join();
+    delete[] threads;
+}
+
 }
@@ -347,7 +347,12 @@ namespace dmModelImporter
     {
         Options();
 
-        int dummy; // for the java binding to not be zero size
+        int  dummy; // for the java binding to not be zero size
+        bool m_OptimizeMeshes; // Reorder the triangles and vertices of the meshes for the GPU caches and less overdraw
+        float m_AnimationSampleRate;             // Resample the animation tracks at this many samples per second. 0 keeps the keys of the file
+        float m_AnimationTranslationTolerance;   // Max error when removing translation keys. 0 keeps all the keys
+        float m_AnimationRotationTolerance;      // Max error per quaternion component when removing rotation keys. 0 keeps all the keys
+        float m_AnimationScaleTolerance;         // Max error when removing scale keys. 0 keeps all the keys
     };
 
     // End of JNI struct api
@@ -380,6 +385,25 @@ namespace dmModelImporter
     // Switches between warning and debug level
     extern "C" DM_DLLEXPORT void EnableDebugLogging(bool enable);
 
+    // Sets the max number of threads used to convert the meshes, skins and animations of a scene.
+    // 0 uses one thread per core (default), 1 converts them on the calling thread.
+    // The DM_MODELC_NUM_THREADS environment variable sets the initial value.
+    // The result doesn't depend on the number of threads.
+    void SetMaxThreads(uint32_t max_threads);
+
+    // Calls fn for each index in [0, count), spread over the threads
+    void ParallelFor(uint32_t count, void (*fn)(void* ctx, uint32_t index), void* ctx);
+
+    // Resamples the animation tracks and removes the keys that can be interpolated within the tolerances of the options.
+    // Constant tracks are reduced to a single key.
+    void ReduceAnimation(Animation* animation, const Options* options);
+    void ReduceAnimations(Scene* scene, const Options* options);
+
+    // Reorders the triangles for the vertex cache and overdraw, and the vertices in the order they're first used.
+    // Unused vertices are removed.
+    void OptimizeMesh(Mesh* mesh);
+    void OptimizeScene(Scene* scene);
+
     void DebugScene(Scene* scene);
     void DebugStructScene(Scene* scene);
 
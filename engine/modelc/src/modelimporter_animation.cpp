@@ -0,0 +1,227 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+#include "modelimporter.h"
+#include <math.h>
+#include <string.h>
+#include <dmsdk/dlib/math.h>
+
+// Reduces the number of keys in the animation tracks:
+// * The tracks are optionally resampled at a fixed rate first
+// * Constant tracks are stored as a single key
+// * Keys that can be interpolated from their neighbours within the tolerance are removed
+// The keys keep their times, so the remaining keys are no longer evenly spaced.
+
+namespace dmModelImporter
+{
+
+static void LerpValue(const float* a, const float* b, float t, uint32_t num_components, float* out)
+{
+    for (uint32_t c = 0; c < num_components; ++c)
+        out[c] = a[c] + (b[c] - a[c]) * t;
+}
+
+static void SlerpValue(const float* a, const float* b, float t, float* out)
+{
+    float d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    // q and -q are the same rotation, take the shortest path
+    float sign = 1.0f;
+    if (d < 0.0f)
+    {
+        sign = -1.0f;
+        d = -d;
+    }
+
+    float wa = 1.0f - t;
+    float wb = t;
+    // Nearly the same rotation, a lerp is accurate enough
+    if (d < 0.9995f)
+    {
+        float angle = acosf(d);
+        float s = sinf(angle);
+        wa = sinf((1.0f - t) * angle) / s;
+        wb = sinf(t * angle) / s;
+    }
+
+    float length = 0.0f;
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        out[c] = a[c] * wa + sign * b[c] * wb;
+        length += out[c] * out[c];
+    }
+    length = sqrtf(length);
+    if (length > 0.0f)
+    {
+        for (uint32_t c = 0; c < 4; ++c)
+            out[c] /= length;
+    }
+}
+
+static void InterpolateKeys(const KeyFrame* a, const KeyFrame* b, float time, bool rotation, float* out)
+{
+    float duration = b->m_Time - a->m_Time;
+    float t = duration > 0.0f ? dmMath::Clamp((time - a->m_Time) / duration, 0.0f, 1.0f) : 0.0f;
+    if (rotation)
+        SlerpValue(a->m_Value, b->m_Value, t, out);
+    else
+        LerpValue(a->m_Value, b->m_Value, t, 3, out);
+}
+
+// The max component error, taking into account that q and -q are the same rotation
+static float ValueError(const float* value, const float* expected, bool rotation)
+{
+    uint32_t num_components = rotation ? 4 : 3;
+    float sign = 1.0f;
+    if (rotation)
+    {
+        float d = value[0] * expected[0] + value[1] * expected[1] + value[2] * expected[2] + value[3] * expected[3];
+        sign = d < 0.0f ? -1.0f : 1.0f;
+    }
+    float error = 0.0f;
+    for (uint32_t c = 0; c < num_components; ++c)
+        error = dmMath::Max(error, fabsf(sign * value[c] - expected[c]));
+    return error;
+}
+
+// Samples the keys at the time, the keys are sorted on time
+static void SampleKeys(const dmArray<KeyFrame>& keys, float time, bool rotation, float* out)
+{
+    uint32_t count = keys.Size();
+    uint32_t num_components = rotation ? 4 : 3;
+    if (time <= keys[0].m_Time)
+    {
+        memcpy(out, keys[0].m_Value, sizeof(float) * num_components);
+        return;
+    }
+    for (uint32_t i = 1; i < count; ++i)
+    {
+        if (time <= keys[i].m_Time)
+        {
+            InterpolateKeys(&keys[i-1], &keys[i], time, rotation, out);
+            return;
+        }
+    }
+    memcpy(out, keys[count-1].m_Value, sizeof(float) * num_components);
+}
+
+static void ResampleKeys(dmArray<KeyFrame>& keys, float sample_rate, bool rotation)
+{
+    if (keys.Size() < 2)
+        return;
+
+    float start = keys[0].m_Time;
+    float end = keys[keys.Size()-1].m_Time;
+    // The samples that would be closer than this to the last key are skipped
+    float epsilon = 0.001f / sample_rate;
+    float intervals = floorf((end - start - epsilon) * sample_rate);
+    uint32_t sample_count = intervals > 0.0f ? (uint32_t)intervals + 1 : 1;
+
+    dmArray<KeyFrame> samples;
+    samples.SetCapacity(sample_count + 1);
+    for (uint32_t i = 0; i < sample_count; ++i)
+    {
+        KeyFrame key;
+        memset(&key, 0, sizeof(key));
+        key.m_Time = start + i / sample_rate;
+        SampleKeys(keys, key.m_Time, rotation, key.m_Value);
+        samples.Push(key);
+    }
+    // The last key is always kept, so that the track keeps its length
+    samples.Push(keys[keys.Size()-1]);
+
+    keys.Swap(samples);
+}
+
+static bool SegmentFits(const dmArray<KeyFrame>& keys, uint32_t start, uint32_t end, bool rotation, float tolerance)
+{
+    float value[4];
+    for (uint32_t i = start + 1; i < end; ++i)
+    {
+        InterpolateKeys(&keys[start], &keys[end], keys[i].m_Time, rotation, value);
+        if (ValueError(value, keys[i].m_Value, rotation) > tolerance)
+            return false;
+    }
+    return true;
+}
+
+static void ReduceKeys(dmArray<KeyFrame>& keys, bool rotation, float tolerance)
+{
+    uint32_t count = keys.Size();
+    if (count < 2)
+        return;
+
+    bool constant = true;
+    for (uint32_t i = 1; i < count && constant; ++i)
+        constant = ValueError(keys[i].m_Value, keys[0].m_Value, rotation) <= tolerance;
+    if (constant)
+    {
+        keys.SetSize(1);
+        return;
+    }
+
+    // Greedily extends each segment between two keys as long as all keys within it can be interpolated within the tolerance.
+    // The first and the last keys are always kept.
+    dmArray<KeyFrame> reduced;
+    reduced.SetCapacity(count);
+    reduced.Push(keys[0]);
+    uint32_t start = 0;
+    while (start + 1 < count)
+    {
+        uint32_t end = start + 1;
+        while (end + 1 < count && SegmentFits(keys, start, end + 1, rotation, tolerance))
+            ++end;
+        reduced.Push(keys[end]);
+        start = end;
+    }
+
+    keys.Swap(reduced);
+}
+
+static void ReduceTrack(dmArray<KeyFrame>& keys, const Options* options, bool rotation, float tolerance)
+{
+    if (options->m_AnimationSampleRate > 0.0f)
+        ResampleKeys(keys, options->m_AnimationSampleRate, rotation);
+    if (tolerance > 0.0f)
+        ReduceKeys(keys, rotation, tolerance);
+}
+
+void ReduceAnimation(Animation* animation, const Options* options)
+{
+    for (uint32_t i = 0; i < animation->m_NodeAnimations.Size(); ++i)
+    {
+        NodeAnimation* node_animation = &animation->m_NodeAnimations[i];
+        ReduceTrack(node_animation->m_TranslationKeys, options, false, options->m_AnimationTranslationTolerance);
+        ReduceTrack(node_animation->m_RotationKeys, options, true, options->m_AnimationRotationTolerance);
+        ReduceTrack(node_animation->m_ScaleKeys, options, false, options->m_AnimationScaleTolerance);
+    }
+}
+
+struct ReduceAnimationsContext
+{
+    Scene*          m_Scene;
+    const Options*  m_Options;
+};
+
+static void ReduceAnimationTask(void* _ctx, uint32_t index)
+{
+    ReduceAnimationsContext* ctx = (ReduceAnimationsContext*)_ctx;
+    ReduceAnimation(&ctx->m_Scene->m_Animations[index], ctx->m_Options);
+}
+
+void ReduceAnimations(Scene* scene, const Options* options)
+{
+    ReduceAnimationsContext ctx = { scene, options };
+    ParallelFor(scene->m_Animations.Size(), ReduceAnimationTask, &ctx);
+}
+
+} // namespace
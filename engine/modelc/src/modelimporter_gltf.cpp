@@ -43,6 +43,7 @@ namespace dmModelImporter
 struct GltfData
 {
     cgltf_data* m_Data;
+    Options     m_Options;
 };
 
 static dmTransform::Transform& ToTransform(const dmModelImporter::Transform& in, dmTransform::Transform& out)
@@ -887,11 +888,6 @@ static void LoadPrimitives(Scene* scene, Model* model, cgltf_data* gltf_data, cg
             }
         }
 
-        if (mesh->m_Weights.Size() && mesh->m_Material)
-        {
-            mesh->m_Material->m_IsSkinned = 1;
-        }
-
         if (mesh->m_TexCoords0.Empty())
         {
             mesh->m_TexCoords0NumComponents = 2;
@@ -902,18 +898,44 @@ static void LoadPrimitives(Scene* scene, Model* model, cgltf_data* gltf_data, cg
     }
 }
 
+// The meshes, skins and animations are converted in parallel. Each task only writes to its own item,
+// so the result is the same as when converted serially
+struct LoadContext
+{
+    Scene*       m_Scene;
+    cgltf_data*  m_Data;
+};
+
+static void LoadMesh(void* _ctx, uint32_t i)
+{
+    LoadContext* ctx = (LoadContext*)_ctx;
+    cgltf_mesh* gltf_mesh = &ctx->m_Data->meshes[i]; // our "Model"
+    Model* model = &ctx->m_Scene->m_Models[i];
+    model->m_Name = CreateObjectName(gltf_mesh, "model", i);
+    model->m_Index = i;
+
+    LoadPrimitives(ctx->m_Scene, model, ctx->m_Data, gltf_mesh); // Our "Meshes"
+}
+
 static void LoadMeshes(Scene* scene, cgltf_data* gltf_data)
 {
     InitSize(scene->m_Models, gltf_data->meshes_count, gltf_data->meshes_count);
 
-    for (uint32_t i = 0; i < gltf_data->meshes_count; ++i)
+    LoadContext ctx = { scene, gltf_data };
+    ParallelFor(gltf_data->meshes_count, LoadMesh, &ctx);
+
+    // The materials are shared between the meshes, so they're updated afterwards
+    for (uint32_t i = 0; i < scene->m_Models.Size(); ++i)
     {
-        cgltf_mesh* gltf_mesh = &gltf_data->meshes[i]; // our "Model"
         Model* model = &scene->m_Models[i];
-        model->m_Name = CreateObjectName(gltf_mesh, "model", i);
-        model->m_Index = i;
-
-        LoadPrimitives(scene, model, gltf_data, gltf_mesh); // Our "Meshes"
+        for (uint32_t j = 0; j < model->m_Meshes.Size(); ++j)
+        {
+            Mesh* mesh = &model->m_Meshes[j];
+            if (mesh->m_Weights.Size() && mesh->m_Material)
+            {
+                mesh->m_Material->m_IsSkinned = 1;
+            }
+        }
     }
 }
 
@@ -1097,63 +1119,67 @@ static void SortSkinBones(Skin* skin)
     delete[] infos;
 }
 
-static void LoadSkins(Scene* scene, cgltf_data* gltf_data)
+static void LoadSkin(void* _ctx, uint32_t i)
 {
-    if (gltf_data->skins_count == 0)
-        return;
+    LoadContext* ctx = (LoadContext*)_ctx;
+    cgltf_skin* gltf_skin = &ctx->m_Data->skins[i];
 
-    InitSize(scene->m_Skins, gltf_data->skins_count, gltf_data->skins_count);
+    Skin* skin = &ctx->m_Scene->m_Skins[i];
+    skin->m_Name = CreateObjectName(gltf_skin, "skin", i);
+    skin->m_Index = i;
 
-    for (uint32_t i = 0; i < gltf_data->skins_count; ++i)
-    {
-        cgltf_skin* gltf_skin = &gltf_data->skins[i];
-
-        Skin* skin = &scene->m_Skins[i];
-        skin->m_Name = CreateObjectName(gltf_skin, "skin", i);
-        skin->m_Index = i;
+    InitSize(skin->m_Bones, gltf_skin->joints_count+1, gltf_skin->joints_count);
 
-        InitSize(skin->m_Bones, gltf_skin->joints_count+1, gltf_skin->joints_count);
+    cgltf_accessor* accessor = gltf_skin->inverse_bind_matrices;
+    for (uint32_t j = 0; j < gltf_skin->joints_count; ++j)
+    {
+        cgltf_node* gltf_joint = gltf_skin->joints[j];
+        Bone* bone = &skin->m_Bones[j];
+        bone->m_Name = CreateObjectName(gltf_joint, "bone", j);
+        bone->m_Index = j;
+        bone->m_ParentIndex = FindBoneIndex(gltf_skin, gltf_joint->parent);
 
-        cgltf_accessor* accessor = gltf_skin->inverse_bind_matrices;
-        for (uint32_t j = 0; j < gltf_skin->joints_count; ++j)
+        if (bone->m_ParentIndex != INVALID_INDEX)
         {
-            cgltf_node* gltf_joint = gltf_skin->joints[j];
-            Bone* bone = &skin->m_Bones[j];
-            bone->m_Name = CreateObjectName(gltf_joint, "bone", j);
-            bone->m_Index = j;
-            bone->m_ParentIndex = FindBoneIndex(gltf_skin, gltf_joint->parent);
-
-            if (bone->m_ParentIndex != INVALID_INDEX)
-            {
-                Bone* parent = &skin->m_Bones[bone->m_ParentIndex];
-                if (parent->m_Children.Full())
-                    parent->m_Children.OffsetCapacity(4);
-                parent->m_Children.Push(bone);
-            }
+            Bone* parent = &skin->m_Bones[bone->m_ParentIndex];
+            if (parent->m_Children.Full())
+                parent->m_Children.OffsetCapacity(4);
+            parent->m_Children.Push(bone);
+        }
 
-            // Cannot translate the bones here, since they're not created yet
-            // bone->m_Node = ...
-            if (accessor)
+        // Cannot translate the bones here, since they're not created yet
+        // bone->m_Node = ...
+        if (accessor)
+        {
+            float matrix[16];
+            if (ReadAccessorMatrix4(accessor, j, matrix))
             {
-                float matrix[16];
-                if (ReadAccessorMatrix4(accessor, j, matrix))
-                {
-                    FromMatrix4x4(matrix, bone->m_InvBindPose);
-                } else
-                {
-                    assert(false);
-                }
-            }
-            else
+                FromMatrix4x4(matrix, bone->m_InvBindPose);
+            } else
             {
-                SetIdentity(bone->m_InvBindPose);
+                assert(false);
             }
         }
+        else
+        {
+            SetIdentity(bone->m_InvBindPose);
+        }
+    }
 
-        SortSkinBones(skin);
+    SortSkinBones(skin);
 
-        // LOAD SKELETON?
-    }
+    // LOAD SKELETON?
+}
+
+static void LoadSkins(Scene* scene, cgltf_data* gltf_data)
+{
+    if (gltf_data->skins_count == 0)
+        return;
+
+    InitSize(scene->m_Skins, gltf_data->skins_count, gltf_data->skins_count);
+
+    LoadContext ctx = { scene, gltf_data };
+    ParallelFor(gltf_data->skins_count, LoadSkin, &ctx);
 }
 
 static void GenerateRootBone(Scene* scene)
@@ -1406,46 +1432,51 @@ static uint32_t CountAnimatedNodes(cgltf_animation* animation, dmHashTable64<uin
     return node_to_index.Size();
 }
 
-static void LoadAnimations(Scene* scene, cgltf_data* gltf_data)
+static void LoadAnimation(void* _ctx, uint32_t a)
 {
-    if (gltf_data->animations_count == 0)
-        return;
+    LoadContext* ctx = (LoadContext*)_ctx;
+    cgltf_data* gltf_data = ctx->m_Data;
+    Scene* scene = ctx->m_Scene;
+    cgltf_animation* gltf_animation = &gltf_data->animations[a];
+    Animation* animation = &scene->m_Animations[a];
 
-    InitSize(scene->m_Animations, gltf_data->animations_count, gltf_data->animations_count);
+    animation->m_Name = CreateObjectName(gltf_animation, "animation", a);
 
-    // first, count number of animated nodes we have
-    for (uint32_t a = 0; a < gltf_data->animations_count; ++a)
-    {
-        cgltf_animation* gltf_animation = &gltf_data->animations[a];
-        Animation* animation = &scene->m_Animations[a];
+    // Here we want to create a many individual tracks for different bones (name.type): "a.rot", "b.rot", "a.pos", "b.scale"...
+    // into a list of tracks that holds all 3 types: [a: {rot, pos, scale}, b: {rot, pos, scale}...]
+    dmHashTable64<uint32_t> node_name_to_index;
+    uint32_t node_animations_count = CountAnimatedNodes(gltf_animation, node_name_to_index);
+
+    InitSize(animation->m_NodeAnimations, node_animations_count, node_animations_count);
 
-        animation->m_Name = CreateObjectName(gltf_animation, "animation", a);
+    for (size_t i = 0; i < gltf_animation->channels_count; ++i)
+    {
+        cgltf_animation_channel* channel = &gltf_animation->channels[i];
 
-        // Here we want to create a many individual tracks for different bones (name.type): "a.rot", "b.rot", "a.pos", "b.scale"...
-        // into a list of tracks that holds all 3 types: [a: {rot, pos, scale}, b: {rot, pos, scale}...]
-        dmHashTable64<uint32_t> node_name_to_index;
-        uint32_t node_animations_count = CountAnimatedNodes(gltf_animation, node_name_to_index);
+        Node* node = TranslateNode(channel->target_node, gltf_data, scene);
+        dmhash_t node_name_hash = node->m_NameHash;
 
-        InitSize(animation->m_NodeAnimations, node_animations_count, node_animations_count);
+        uint32_t* node_index = node_name_to_index.Get(node_name_hash);
+        assert(node_index != 0);
 
-        for (size_t i = 0; i < gltf_animation->channels_count; ++i)
-        {
-            cgltf_animation_channel* channel = &gltf_animation->channels[i];
+        NodeAnimation* node_animation = &animation->m_NodeAnimations[*node_index];
+        node_animation->m_Node = node;
 
-            Node* node = TranslateNode(channel->target_node, gltf_data, scene);
-            dmhash_t node_name_hash = node->m_NameHash;
+        LoadChannel(node_animation, channel);
 
-            uint32_t* node_index = node_name_to_index.Get(node_name_hash);
-            assert(node_index != 0);
+        animation->m_Duration = node_animation->m_EndTime - node_animation->m_StartTime;
+    }
+}
 
-            NodeAnimation* node_animation = &animation->m_NodeAnimations[*node_index];
-            node_animation->m_Node = node;
+static void LoadAnimations(Scene* scene, cgltf_data* gltf_data)
+{
+    if (gltf_data->animations_count == 0)
+        return;
 
-            LoadChannel(node_animation, channel);
+    InitSize(scene->m_Animations, gltf_data->animations_count, gltf_data->animations_count);
 
-            animation->m_Duration = node_animation->m_EndTime - node_animation->m_StartTime;
-        }
-    }
+    LoadContext ctx = { scene, gltf_data };
+    ParallelFor(gltf_data->animations_count, LoadAnimation, &ctx);
 }
 
 // Based on cgltf.h: cgltf_load_buffers(...)
@@ -1540,8 +1571,35 @@ bool HasUnresolvedBuffers(Scene* scene)
     return HasUnresolvedBuffersInternal((cgltf_data*)scene->m_OpaqueSceneData);
 }
 
+// We don't have the Draco or meshopt decoders, so we read the uncompressed fallback data, if there is any
+static void WarnCompressedData(cgltf_data* data)
+{
+    for (cgltf_size i = 0; i < data->buffer_views_count; ++i)
+    {
+        if (data->buffer_views[i].has_meshopt_compression)
+        {
+            printf("Warning: Buffer view %u uses EXT_meshopt_compression which isn't supported. Using the fallback buffer\n", (uint32_t)i);
+            break;
+        }
+    }
+
+    for (cgltf_size i = 0; i < data->meshes_count; ++i)
+    {
+        for (cgltf_size j = 0; j < data->meshes[i].primitives_count; ++j)
+        {
+            if (data->meshes[i].primitives[j].has_draco_mesh_compression)
+            {
+                printf("Warning: Mesh %u uses KHR_draco_mesh_compression which isn't supported. Using the uncompressed accessors\n", (uint32_t)i);
+                return;
+            }
+        }
+    }
+}
+
 static void LoadScene(Scene* scene, cgltf_data* data)
 {
+    WarnCompressedData(data);
+
     dmHashTable64<void*> cache;
     LoadSkins(scene, data);
     LoadNodes(scene, data);
@@ -1566,6 +1624,9 @@ static bool LoadFinalizeGltf(Scene* scene)
 {
     GltfData* data = (GltfData*)scene->m_OpaqueSceneData;
     LoadScene(scene, data->m_Data);
+    if (data->m_Options.m_OptimizeMeshes)
+        OptimizeScene(scene);
+    ReduceAnimations(scene, &data->m_Options);
     return true;
 }
 
@@ -1613,6 +1674,8 @@ Scene* LoadGltfFromBuffer(Options* importeroptions, void* mem, uint32_t file_siz
     memset(scene, 0, sizeof(Scene));
     GltfData* scenedata = new GltfData;
     scenedata->m_Data = data;
+    if (importeroptions)
+        scenedata->m_Options = *importeroptions;
 
     scene->m_OpaqueSceneData = scenedata;
     scene->m_LoadFinalizeFn = LoadFinalizeGltf;
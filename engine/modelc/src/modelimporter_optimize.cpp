@@ -0,0 +1,401 @@
+
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+#include "modelimporter.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm> // std::stable_sort
+#include <dmsdk/dlib/log.h>
+#include <dmsdk/dlib/math.h>
+
+// Reorders the triangles and vertices of the meshes for the GPU:
+// * The triangles are sorted for the post transform vertex cache (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation")
+// * The runs of triangles are then reordered to draw the outward facing ones first, to reduce overdraw
+// * The vertices are stored in the order they are first used, for the pre transform (fetch) cache
+// The geometry itself is unchanged.
+
+namespace dmModelImporter
+{
+
+static const uint32_t VERTEX_CACHE_SIZE = 32; // The size the triangles are optimized for
+static const uint32_t FIFO_CACHE_SIZE = 16;   // Used to find the runs of triangles for the overdraw sorting
+static const uint32_t UNUSED_VERTEX = 0xFFFFFFFF;
+
+static float CalcVertexScore(int32_t cache_position, uint32_t remaining_triangles)
+{
+    if (remaining_triangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cache_position >= 0)
+    {
+        // The vertices of the last triangle get a fixed score, so that the next triangle doesn't just reuse them
+        if (cache_position < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - (cache_position - 3) / (float)(VERTEX_CACHE_SIZE - 3), 1.5f);
+    }
+    // Favor the vertices with few triangles left, to not leave lone triangles behind
+    score += 2.0f * powf((float)remaining_triangles, -0.5f);
+    return score;
+}
+
+static void OptimizeVertexCache(uint32_t* indices, uint32_t index_count, uint32_t vertex_count)
+{
+    uint32_t triangle_count = index_count / 3;
+
+    // The triangles of each vertex
+    dmArray<uint32_t> remaining;      // per vertex
+    dmArray<uint32_t> offsets;        // per vertex
+    dmArray<uint32_t> adjacency;      // per index
+    remaining.SetCapacity(vertex_count);
+    remaining.SetSize(vertex_count);
+    memset(remaining.Begin(), 0, vertex_count * sizeof(uint32_t));
+    for (uint32_t i = 0; i < index_count; ++i)
+        remaining[indices[i]]++;
+
+    offsets.SetCapacity(vertex_count);
+    offsets.SetSize(vertex_count);
+    uint32_t offset = 0;
+    for (uint32_t v = 0; v < vertex_count; ++v)
+    {
+        offsets[v] = offset;
+        offset += remaining[v];
+    }
+
+    adjacency.SetCapacity(index_count);
+    adjacency.SetSize(index_count);
+    dmArray<uint32_t> fill;
+    fill.SetCapacity(vertex_count);
+    fill.SetSize(vertex_count);
+    memset(fill.Begin(), 0, vertex_count * sizeof(uint32_t));
+    for (uint32_t i = 0; i < index_count; ++i)
+    {
+        uint32_t v = indices[i];
+        adjacency[offsets[v] + fill[v]++] = i / 3;
+    }
+
+    dmArray<int32_t> cache_position;
+    dmArray<float> vertex_score;
+    cache_position.SetCapacity(vertex_count);
+    cache_position.SetSize(vertex_count);
+    vertex_score.SetCapacity(vertex_count);
+    vertex_score.SetSize(vertex_count);
+    for (uint32_t v = 0; v < vertex_count; ++v)
+    {
+        cache_position[v] = -1;
+        vertex_score[v] = CalcVertexScore(-1, remaining[v]);
+    }
+
+    dmArray<float> triangle_score;
+    dmArray<uint8_t> emitted;
+    triangle_score.SetCapacity(triangle_count);
+    triangle_score.SetSize(triangle_count);
+    emitted.SetCapacity(triangle_count);
+    emitted.SetSize(triangle_count);
+    memset(emitted.Begin(), 0, triangle_count);
+    for (uint32_t t = 0; t < triangle_count; ++t)
+    {
+        const uint32_t* tri = &indices[t * 3];
+        triangle_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+    }
+
+    dmArray<uint32_t> output;
+    output.SetCapacity(index_count);
+
+    uint32_t cache[VERTEX_CACHE_SIZE + 3];
+    uint32_t cache_count = 0;
+    uint32_t new_cache[VERTEX_CACHE_SIZE + 3];
+
+    uint32_t cursor = 0; // Where to look for the next triangle, when none in the cache is left
+    int32_t best = -1;
+
+    for (uint32_t n = 0; n < triangle_count; ++n)
+    {
+        if (best < 0)
+        {
+            while (emitted[cursor])
+                ++cursor;
+            best = (int32_t)cursor;
+        }
+
+        const uint32_t* tri = &indices[best * 3];
+        emitted[best] = 1;
+        output.PushArray(tri, 3);
+
+        // Remove the triangle from its vertices
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            uint32_t v = tri[k];
+            uint32_t* list = &adjacency[offsets[v]];
+            for (uint32_t j = 0; j < remaining[v]; ++j)
+            {
+                if (list[j] == (uint32_t)best)
+                {
+                    list[j] = list[remaining[v] - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // The triangle vertices go first, the other vertices are pushed back
+        uint32_t new_count = 0;
+        new_cache[new_count++] = tri[0];
+        new_cache[new_count++] = tri[1];
+        new_cache[new_count++] = tri[2];
+        for (uint32_t j = 0; j < cache_count; ++j)
+        {
+            uint32_t v = cache[j];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                new_cache[new_count++] = v;
+        }
+
+        // Rescore the vertices in the cache, the ones that fall out get their base score back
+        for (uint32_t j = 0; j < new_count; ++j)
+        {
+            uint32_t v = new_cache[j];
+            int32_t position = j < VERTEX_CACHE_SIZE ? (int32_t)j : -1;
+            cache_position[v] = position;
+            float score = CalcVertexScore(position, remaining[v]);
+            float delta = score - vertex_score[v];
+            vertex_score[v] = score;
+            const uint32_t* list = &adjacency[offsets[v]];
+            for (uint32_t k = 0; k < remaining[v]; ++k)
+                triangle_score[list[k]] += delta;
+        }
+
+        cache_count = dmMath::Min(new_count, VERTEX_CACHE_SIZE);
+        memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+
+        // The next triangle is the best one that uses a vertex in the cache
+        best = -1;
+        float best_score = -1.0f;
+        for (uint32_t j = 0; j < cache_count; ++j)
+        {
+            uint32_t v = cache[j];
+            const uint32_t* list = &adjacency[offsets[v]];
+            for (uint32_t k = 0; k < remaining[v]; ++k)
+            {
+                uint32_t t = list[k];
+                if (triangle_score[t] > best_score)
+                {
+                    best_score = triangle_score[t];
+                    best = (int32_t)t;
+                }
+            }
+        }
+    }
+
+    memcpy(indices, output.Begin(), index_count * sizeof(uint32_t));
+}
+
+struct TriangleCluster
+{
+    uint32_t m_Start;   // first index
+    uint32_t m_Count;   // number of indices
+    float    m_Sort;
+};
+
+struct ClusterPred
+{
+    bool operator()(const TriangleCluster& a, const TriangleCluster& b) const
+    {
+        return a.m_Sort > b.m_Sort;
+    }
+};
+
+static void OptimizeOverdraw(uint32_t* indices, uint32_t index_count, const float* positions, uint32_t vertex_count)
+{
+    // A new cluster starts where a triangle misses the cache on all of its vertices,
+    // so moving the clusters around costs very little of the cache efficiency
+    dmArray<uint32_t> timestamps;
+    timestamps.SetCapacity(vertex_count);
+    timestamps.SetSize(vertex_count);
+    memset(timestamps.Begin(), 0, vertex_count * sizeof(uint32_t));
+    uint32_t time = FIFO_CACHE_SIZE + 1;
+
+    dmArray<TriangleCluster> clusters;
+    for (uint32_t i = 0; i < index_count; i += 3)
+    {
+        uint32_t misses = 0;
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            uint32_t v = indices[i + k];
+            if (time - timestamps[v] > FIFO_CACHE_SIZE)
+            {
+                timestamps[v] = time++;
+                misses++;
+            }
+        }
+
+        if (misses == 3 || clusters.Empty())
+        {
+            if (clusters.Full())
+                clusters.OffsetCapacity(dmMath::Max(16U, clusters.Capacity()));
+            TriangleCluster cluster = {i, 0, 0.0f};
+            clusters.Push(cluster);
+        }
+        clusters.Back().m_Count += 3;
+    }
+
+    if (clusters.Size() < 2)
+        return;
+
+    float mesh_center[3] = {0.0f, 0.0f, 0.0f};
+    for (uint32_t v = 0; v < vertex_count; ++v)
+    {
+        mesh_center[0] += positions[v * 3 + 0];
+        mesh_center[1] += positions[v * 3 + 1];
+        mesh_center[2] += positions[v * 3 + 2];
+    }
+    for (uint32_t k = 0; k < 3; ++k)
+        mesh_center[k] /= (float)vertex_count;
+
+    // How much the cluster faces away from the center of the mesh. Those are drawn first, as they are likely to occlude the others
+    for (uint32_t c = 0; c < clusters.Size(); ++c)
+    {
+        TriangleCluster& cluster = clusters[c];
+        float center[3] = {0.0f, 0.0f, 0.0f};
+        float normal[3] = {0.0f, 0.0f, 0.0f};
+        float area = 0.0f;
+        for (uint32_t i = cluster.m_Start; i < cluster.m_Start + cluster.m_Count; i += 3)
+        {
+            const float* p0 = &positions[indices[i + 0] * 3];
+            const float* p1 = &positions[indices[i + 1] * 3];
+            const float* p2 = &positions[indices[i + 2] * 3];
+            float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            float a = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                center[k] += (p0[k] + p1[k] + p2[k]) * (a / 3.0f);
+                normal[k] += n[k];
+            }
+            area += a;
+        }
+
+        float normal_length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (area == 0.0f || normal_length == 0.0f)
+            continue;
+
+        float sort = 0.0f;
+        for (uint32_t k = 0; k < 3; ++k)
+            sort += (center[k] / area - mesh_center[k]) * (normal[k] / normal_length);
+        cluster.m_Sort = sort;
+    }
+
+    std::stable_sort(clusters.Begin(), clusters.End(), ClusterPred());
+
+    dmArray<uint32_t> output;
+    output.SetCapacity(index_count);
+    for (uint32_t c = 0; c < clusters.Size(); ++c)
+        output.PushArray(&indices[clusters[c].m_Start], clusters[c].m_Count);
+    memcpy(indices, output.Begin(), index_count * sizeof(uint32_t));
+}
+
+template <typename T>
+static void RemapStream(dmArray<T>& stream, uint32_t num_components, const uint32_t* remap, uint32_t vertex_count, uint32_t new_vertex_count)
+{
+    if (stream.Empty() || stream.Size() != vertex_count * num_components)
+        return; // not used by this mesh
+
+    dmArray<T> output;
+    output.SetCapacity(new_vertex_count * num_components);
+    output.SetSize(new_vertex_count * num_components);
+    for (uint32_t v = 0; v < vertex_count; ++v)
+    {
+        if (remap[v] != UNUSED_VERTEX)
+            memcpy(&output[remap[v] * num_components], &stream[v * num_components], num_components * sizeof(T));
+    }
+    stream.Swap(output);
+}
+
+static void OptimizeVertexFetch(Mesh* mesh)
+{
+    uint32_t vertex_count = mesh->m_VertexCount;
+    dmArray<uint32_t> remap;
+    remap.SetCapacity(vertex_count);
+    remap.SetSize(vertex_count);
+    for (uint32_t v = 0; v < vertex_count; ++v)
+        remap[v] = UNUSED_VERTEX;
+
+    // Unused vertices are dropped
+    uint32_t new_vertex_count = 0;
+    for (uint32_t i = 0; i < mesh->m_Indices.Size(); ++i)
+    {
+        uint32_t& index = mesh->m_Indices[i];
+        if (remap[index] == UNUSED_VERTEX)
+            remap[index] = new_vertex_count++;
+        index = remap[index];
+    }
+
+    const uint32_t* r = remap.Begin();
+    RemapStream(mesh->m_Positions, 3, r, vertex_count, new_vertex_count);
+    RemapStream(mesh->m_Normals, 3, r, vertex_count, new_vertex_count);
+    RemapStream(mesh->m_Tangents, 4, r, vertex_count, new_vertex_count);
+    RemapStream(mesh->m_Colors, 4, r, vertex_count, new_vertex_count);
+    RemapStream(mesh->m_Weights, 4, r, vertex_count, new_vertex_count);
+    RemapStream(mesh->m_Bones, 4, r, vertex_count, new_vertex_count);
+    RemapStream(mesh->m_TexCoords0, mesh->m_TexCoords0NumComponents, r, vertex_count, new_vertex_count);
+    RemapStream(mesh->m_TexCoords1, mesh->m_TexCoords1NumComponents, r, vertex_count, new_vertex_count);
+    mesh->m_VertexCount = new_vertex_count;
+}
+
+void OptimizeMesh(Mesh* mesh)
+{
+    uint32_t index_count = mesh->m_Indices.Size();
+    if (index_count < 3 || (index_count % 3) != 0 || mesh->m_VertexCount == 0)
+        return;
+
+    for (uint32_t i = 0; i < index_count; ++i)
+    {
+        if (mesh->m_Indices[i] >= mesh->m_VertexCount)
+        {
+            dmLogWarning("Mesh '%s' has out of range indices, skipping optimization", mesh->m_Name ? mesh->m_Name : "");
+            return;
+        }
+    }
+
+    OptimizeVertexCache(mesh->m_Indices.Begin(), index_count, mesh->m_VertexCount);
+    if (mesh->m_Positions.Size() == mesh->m_VertexCount * 3)
+    {
+        OptimizeOverdraw(mesh->m_Indices.Begin(), index_count, mesh->m_Positions.Begin(), mesh->m_VertexCount);
+    }
+    OptimizeVertexFetch(mesh);
+}
+
+static void OptimizeMeshTask(void* ctx, uint32_t index)
+{
+    Mesh** meshes = (Mesh**)ctx;
+    OptimizeMesh(meshes[index]);
+}
+
+void OptimizeScene(Scene* scene)
+{
+    dmArray<Mesh*> meshes;
+    for (uint32_t i = 0; i < scene->m_Models.Size(); ++i)
+    {
+        Model* model = &scene->m_Models[i];
+        meshes.OffsetCapacity(model->m_Meshes.Size());
+        for (uint32_t j = 0; j < model->m_Meshes.Size(); ++j)
+            meshes.Push(&model->m_Meshes[j]);
+    }
+
+    // The meshes don't share any data, so they can be optimized in parallel
+    ParallelFor(meshes.Size(), OptimizeMeshTask, meshes.Begin());
+}
+
+} // namespace
@@ -16,6 +16,7 @@
 #include "modelimporter.h"
 #include <dlib/dstrings.h>
 #include <dlib/time.h>
+#include <math.h>
 #include <string.h>
 
 
@@ -236,6 +237,358 @@ TEST(ModelSkinnedTopNodes, MultipleModels)
     dmModelImporter::DestroyScene(scene);
 }
 
+// The average number of vertex cache misses per triangle, with a FIFO cache
+static float CalcACMR(const dmModelImporter::Mesh* mesh, uint32_t cache_size)
+{
+    uint32_t cache[64];
+    uint32_t cache_count = 0;
+    uint32_t misses = 0;
+    for (uint32_t i = 0; i < mesh->m_Indices.Size(); ++i)
+    {
+        uint32_t v = mesh->m_Indices[i];
+        bool hit = false;
+        for (uint32_t j = 0; j < cache_count && !hit; ++j)
+            hit = cache[j] == v;
+        if (hit)
+            continue;
+        misses++;
+        if (cache_count == cache_size)
+        {
+            memmove(cache, cache + 1, (cache_size - 1) * sizeof(uint32_t));
+            cache_count--;
+        }
+        cache[cache_count++] = v;
+    }
+    return misses / (float)(mesh->m_Indices.Size() / 3);
+}
+
+// Sums the triangle corners, to see that the same triangles are drawn
+static void CalcTriangleSum(const dmModelImporter::Mesh* mesh, double* sum)
+{
+    sum[0] = sum[1] = 0.0;
+    for (uint32_t i = 0; i < mesh->m_Indices.Size(); i += 3)
+    {
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const float* p = &mesh->m_Positions[mesh->m_Indices[i + k] * 3];
+            sum[0] += p[0] * (k + 1) + p[1] * 0.5; // depends on the winding
+            sum[1] += p[0] * p[1];
+        }
+    }
+}
+
+TEST(ModelOptimize, Grid)
+{
+    // A grid of quads with the triangles in random order and a few unused vertices at the end
+    const uint32_t size = 32;
+    const uint32_t num_unused = 4;
+
+    dmModelImporter::Mesh mesh;
+    mesh.m_Name = 0;
+    mesh.m_TexCoords0NumComponents = 2;
+    mesh.m_TexCoords1NumComponents = 0;
+    mesh.m_VertexCount = (size + 1) * (size + 1) + num_unused;
+    mesh.m_Positions.SetCapacity(mesh.m_VertexCount * 3);
+    mesh.m_TexCoords0.SetCapacity(mesh.m_VertexCount * 2);
+    for (uint32_t v = 0; v < mesh.m_VertexCount; ++v)
+    {
+        float x = (float)(v % (size + 1));
+        float y = (float)(v / (size + 1));
+        mesh.m_Positions.Push(x);
+        mesh.m_Positions.Push(y);
+        mesh.m_Positions.Push(0.0f);
+        mesh.m_TexCoords0.Push(x / size);
+        mesh.m_TexCoords0.Push(y / size);
+    }
+
+    mesh.m_Indices.SetCapacity(size * size * 6);
+    for (uint32_t y = 0; y < size; ++y)
+    {
+        for (uint32_t x = 0; x < size; ++x)
+        {
+            uint32_t a = y * (size + 1) + x;
+            uint32_t quad[6] = { a, a + 1, a + size + 1, a + 1, a + size + 2, a + size + 1 };
+            mesh.m_Indices.PushArray(quad, 6);
+        }
+    }
+    uint32_t seed = 1;
+    for (uint32_t i = mesh.m_Indices.Size() / 3 - 1; i > 0; --i)
+    {
+        seed = seed * 1103515245 + 12345;
+        uint32_t j = (seed >> 16) % (i + 1);
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            uint32_t tmp = mesh.m_Indices[i * 3 + k];
+            mesh.m_Indices[i * 3 + k] = mesh.m_Indices[j * 3 + k];
+            mesh.m_Indices[j * 3 + k] = tmp;
+        }
+    }
+
+    double sum_before[2];
+    CalcTriangleSum(&mesh, sum_before);
+    float acmr_before = CalcACMR(&mesh, 16);
+    uint32_t index_count = mesh.m_Indices.Size();
+
+    dmModelImporter::OptimizeMesh(&mesh);
+
+    float acmr_after = CalcACMR(&mesh, 16);
+    ASSERT_GT(acmr_before, 2.0f);
+    ASSERT_LT(acmr_after, 0.8f);
+
+    ASSERT_EQ(index_count, mesh.m_Indices.Size());
+    ASSERT_EQ((size + 1) * (size + 1), mesh.m_VertexCount);
+    ASSERT_EQ(mesh.m_VertexCount * 3, mesh.m_Positions.Size());
+    ASSERT_EQ(mesh.m_VertexCount * 2, mesh.m_TexCoords0.Size());
+
+    double sum_after[2];
+    CalcTriangleSum(&mesh, sum_after);
+    ASSERT_NEAR(sum_before[0], sum_after[0], 0.01);
+    ASSERT_NEAR(sum_before[1], sum_after[1], 0.01);
+
+    // The vertices are stored in the order they're first used, and the attributes follow them
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < mesh.m_Indices.Size(); ++i)
+    {
+        uint32_t v = mesh.m_Indices[i];
+        ASSERT_LE(v, next);
+        if (v == next)
+            next++;
+        ASSERT_NEAR(mesh.m_Positions[v * 3 + 0] / size, mesh.m_TexCoords0[v * 2 + 0], 0.0001f);
+        ASSERT_NEAR(mesh.m_Positions[v * 3 + 1] / size, mesh.m_TexCoords0[v * 2 + 1], 0.0001f);
+    }
+}
+
+TEST(ModelOptimize, LoadOptimized)
+{
+    const char* path = "./src/test/assets/car01.glb";
+
+    dmModelImporter::Options options;
+    dmModelImporter::Scene* scene = LoadScene(path, options);
+    ASSERT_NE((dmModelImporter::Scene*)0, scene);
+
+    options.m_OptimizeMeshes = true;
+    dmModelImporter::Scene* optimized = LoadScene(path, options);
+    ASSERT_NE((dmModelImporter::Scene*)0, optimized);
+
+    ASSERT_EQ(scene->m_Models.Size(), optimized->m_Models.Size());
+    for (uint32_t i = 0; i < scene->m_Models.Size(); ++i)
+    {
+        dmModelImporter::Model* model = &scene->m_Models[i];
+        ASSERT_EQ(model->m_Meshes.Size(), optimized->m_Models[i].m_Meshes.Size());
+        for (uint32_t j = 0; j < model->m_Meshes.Size(); ++j)
+        {
+            dmModelImporter::Mesh* a = &model->m_Meshes[j];
+            dmModelImporter::Mesh* b = &optimized->m_Models[i].m_Meshes[j];
+            ASSERT_EQ(a->m_Indices.Size(), b->m_Indices.Size());
+            ASSERT_LE(b->m_VertexCount, a->m_VertexCount);
+
+            double sum_a[2];
+            double sum_b[2];
+            CalcTriangleSum(a, sum_a);
+            CalcTriangleSum(b, sum_b);
+            ASSERT_NEAR(sum_a[0], sum_b[0], fabs(sum_a[0]) * 0.0001 + 0.01);
+            ASSERT_NEAR(sum_a[1], sum_b[1], fabs(sum_a[1]) * 0.0001 + 0.01);
+        }
+    }
+
+    dmModelImporter::DestroyScene(scene);
+    dmModelImporter::DestroyScene(optimized);
+}
+
+
+template <typename T>
+static bool ArraysEqual(const dmArray<T>& a, const dmArray<T>& b)
+{
+    return a.Size() == b.Size() && (a.Empty() || memcmp(a.Begin(), b.Begin(), a.Size() * sizeof(T)) == 0);
+}
+
+TEST(ModelThreads, SameResult)
+{
+    const char* path = "./src/test/assets/kay/Knight.glb";
+
+    dmModelImporter::Options options;
+    dmModelImporter::SetMaxThreads(1);
+    dmModelImporter::Scene* a = LoadScene(path, options);
+    dmModelImporter::SetMaxThreads(8);
+    dmModelImporter::Scene* b = LoadScene(path, options);
+    dmModelImporter::SetMaxThreads(0);
+    ASSERT_NE((dmModelImporter::Scene*)0, a);
+    ASSERT_NE((dmModelImporter::Scene*)0, b);
+
+    ASSERT_EQ(a->m_Models.Size(), b->m_Models.Size());
+    for (uint32_t i = 0; i < a->m_Models.Size(); ++i)
+    {
+        dmModelImporter::Model* ma = &a->m_Models[i];
+        dmModelImporter::Model* mb = &b->m_Models[i];
+        ASSERT_STREQ(ma->m_Name, mb->m_Name);
+        ASSERT_EQ(ma->m_Meshes.Size(), mb->m_Meshes.Size());
+        for (uint32_t j = 0; j < ma->m_Meshes.Size(); ++j)
+        {
+            dmModelImporter::Mesh* mesh_a = &ma->m_Meshes[j];
+            dmModelImporter::Mesh* mesh_b = &mb->m_Meshes[j];
+            ASSERT_STREQ(mesh_a->m_Name, mesh_b->m_Name);
+            ASSERT_EQ(mesh_a->m_VertexCount, mesh_b->m_VertexCount);
+            ASSERT_TRUE(ArraysEqual(mesh_a->m_Indices, mesh_b->m_Indices));
+            ASSERT_TRUE(ArraysEqual(mesh_a->m_Positions, mesh_b->m_Positions));
+            ASSERT_TRUE(ArraysEqual(mesh_a->m_Weights, mesh_b->m_Weights));
+            ASSERT_TRUE(ArraysEqual(mesh_a->m_Bones, mesh_b->m_Bones));
+            ASSERT_EQ(mesh_a->m_Material != 0, mesh_b->m_Material != 0);
+            if (mesh_a->m_Material)
+            {
+                ASSERT_EQ(mesh_a->m_Material - a->m_Materials.Begin(), mesh_b->m_Material - b->m_Materials.Begin());
+            }
+        }
+    }
+
+    ASSERT_EQ(a->m_Materials.Size(), b->m_Materials.Size());
+    for (uint32_t i = 0; i < a->m_Materials.Size(); ++i)
+        ASSERT_EQ(a->m_Materials[i].m_IsSkinned, b->m_Materials[i].m_IsSkinned);
+
+    ASSERT_EQ(a->m_Skins.Size(), b->m_Skins.Size());
+    for (uint32_t i = 0; i < a->m_Skins.Size(); ++i)
+    {
+        dmModelImporter::Skin* skin_a = &a->m_Skins[i];
+        dmModelImporter::Skin* skin_b = &b->m_Skins[i];
+        ASSERT_EQ(skin_a->m_Bones.Size(), skin_b->m_Bones.Size());
+        for (uint32_t j = 0; j < skin_a->m_Bones.Size(); ++j)
+        {
+            ASSERT_STREQ(skin_a->m_Bones[j].m_Name, skin_b->m_Bones[j].m_Name);
+            ASSERT_EQ(skin_a->m_Bones[j].m_ParentIndex, skin_b->m_Bones[j].m_ParentIndex);
+        }
+    }
+
+    ASSERT_EQ(a->m_Animations.Size(), b->m_Animations.Size());
+    for (uint32_t i = 0; i < a->m_Animations.Size(); ++i)
+    {
+        dmModelImporter::Animation* anim_a = &a->m_Animations[i];
+        dmModelImporter::Animation* anim_b = &b->m_Animations[i];
+        ASSERT_STREQ(anim_a->m_Name, anim_b->m_Name);
+        ASSERT_EQ(anim_a->m_Duration, anim_b->m_Duration);
+        ASSERT_EQ(anim_a->m_NodeAnimations.Size(), anim_b->m_NodeAnimations.Size());
+        for (uint32_t j = 0; j < anim_a->m_NodeAnimations.Size(); ++j)
+        {
+            dmModelImporter::NodeAnimation* na = &anim_a->m_NodeAnimations[j];
+            dmModelImporter::NodeAnimation* nb = &anim_b->m_NodeAnimations[j];
+            ASSERT_STREQ(na->m_Node->m_Name, nb->m_Node->m_Name);
+            ASSERT_TRUE(ArraysEqual(na->m_TranslationKeys, nb->m_TranslationKeys));
+            ASSERT_TRUE(ArraysEqual(na->m_RotationKeys, nb->m_RotationKeys));
+            ASSERT_TRUE(ArraysEqual(na->m_ScaleKeys, nb->m_ScaleKeys));
+        }
+    }
+
+    dmModelImporter::DestroyScene(a);
+    dmModelImporter::DestroyScene(b);
+}
+
+
+static void PushKey(dmArray<dmModelImporter::KeyFrame>& keys, float time, float x, float y, float z, float w)
+{
+    dmModelImporter::KeyFrame key;
+    key.m_Time = time;
+    key.m_Value[0] = x;
+    key.m_Value[1] = y;
+    key.m_Value[2] = z;
+    key.m_Value[3] = w;
+    if (keys.Full())
+        keys.OffsetCapacity(16);
+    keys.Push(key);
+}
+
+TEST(ModelAnimation, ReduceKeys)
+{
+    dmModelImporter::Animation animation;
+    memset(&animation, 0, sizeof(animation));
+    animation.m_NodeAnimations.SetCapacity(1);
+    animation.m_NodeAnimations.SetSize(1);
+    dmModelImporter::NodeAnimation* node_animation = &animation.m_NodeAnimations[0];
+    memset(node_animation, 0, sizeof(*node_animation));
+
+    for (uint32_t i = 0; i <= 10; ++i)
+    {
+        float t = i * 0.1f;
+        // A line with a bump at the middle key
+        PushKey(node_animation->m_TranslationKeys, t, i * 0.5f, i == 5 ? 1.0f : 0.0f, 0.0f, 0.0f);
+        // Constant angular speed, which a slerp between the end keys reproduces
+        PushKey(node_animation->m_RotationKeys, t, 0.0f, 0.0f, sinf(t * 0.5f), cosf(t * 0.5f));
+        PushKey(node_animation->m_ScaleKeys, t, 1.0f, 1.0f, 1.0f, 0.0f);
+    }
+
+    dmModelImporter::Options options;
+    options.m_AnimationTranslationTolerance = 0.001f;
+    options.m_AnimationRotationTolerance = 0.001f;
+    options.m_AnimationScaleTolerance = 0.001f;
+    dmModelImporter::ReduceAnimation(&animation, &options);
+
+    const float expected_times[] = { 0.0f, 0.4f, 0.5f, 0.6f, 1.0f };
+    ASSERT_EQ(5U, node_animation->m_TranslationKeys.Size());
+    for (uint32_t i = 0; i < 5; ++i)
+        ASSERT_NEAR(expected_times[i], node_animation->m_TranslationKeys[i].m_Time, 0.0001f);
+    ASSERT_NEAR(1.0f, node_animation->m_TranslationKeys[2].m_Value[1], 0.0001f);
+
+    ASSERT_EQ(2U, node_animation->m_RotationKeys.Size());
+    ASSERT_NEAR(1.0f, node_animation->m_RotationKeys[1].m_Time, 0.0001f);
+
+    // Constant tracks keep a single key
+    ASSERT_EQ(1U, node_animation->m_ScaleKeys.Size());
+    ASSERT_EQ(1.0f, node_animation->m_ScaleKeys[0].m_Value[0]);
+
+    // Resampling keeps the first and the last keys
+    dmModelImporter::Options resample;
+    resample.m_AnimationSampleRate = 30.0f;
+    dmModelImporter::ReduceAnimation(&animation, &resample);
+    ASSERT_EQ(31U, node_animation->m_TranslationKeys.Size());
+    ASSERT_NEAR(1.0f, node_animation->m_TranslationKeys[30].m_Time, 0.0001f);
+    ASSERT_NEAR(2.5f, node_animation->m_TranslationKeys[15].m_Value[0], 0.0001f);
+    ASSERT_NEAR(1.0f, node_animation->m_TranslationKeys[15].m_Value[1], 0.0001f);
+    ASSERT_EQ(31U, node_animation->m_RotationKeys.Size());
+    ASSERT_EQ(1U, node_animation->m_ScaleKeys.Size());
+
+    node_animation->m_TranslationKeys.SetCapacity(0);
+    node_animation->m_RotationKeys.SetCapacity(0);
+    node_animation->m_ScaleKeys.SetCapacity(0);
+    animation.m_NodeAnimations.SetCapacity(0);
+}
+
+TEST(ModelAnimation, LoadReduced)
+{
+    const char* path = "./src/test/assets/kay/Knight.glb";
+
+    dmModelImporter::Options options;
+    dmModelImporter::Scene* scene = LoadScene(path, options);
+    ASSERT_NE((dmModelImporter::Scene*)0, scene);
+
+    options.m_AnimationTranslationTolerance = 0.001f;
+    options.m_AnimationRotationTolerance = 0.001f;
+    options.m_AnimationScaleTolerance = 0.001f;
+    dmModelImporter::Scene* reduced = LoadScene(path, options);
+    ASSERT_NE((dmModelImporter::Scene*)0, reduced);
+
+    uint32_t key_count = 0;
+    uint32_t reduced_key_count = 0;
+    ASSERT_EQ(scene->m_Animations.Size(), reduced->m_Animations.Size());
+    for (uint32_t i = 0; i < scene->m_Animations.Size(); ++i)
+    {
+        dmModelImporter::Animation* a = &scene->m_Animations[i];
+        dmModelImporter::Animation* b = &reduced->m_Animations[i];
+        ASSERT_EQ(a->m_Duration, b->m_Duration);
+        ASSERT_EQ(a->m_NodeAnimations.Size(), b->m_NodeAnimations.Size());
+        for (uint32_t j = 0; j < a->m_NodeAnimations.Size(); ++j)
+        {
+            dmModelImporter::NodeAnimation* na = &a->m_NodeAnimations[j];
+            dmModelImporter::NodeAnimation* nb = &b->m_NodeAnimations[j];
+            ASSERT_LE(nb->m_TranslationKeys.Size(), na->m_TranslationKeys.Size());
+            ASSERT_LE(nb->m_RotationKeys.Size(), na->m_RotationKeys.Size());
+            ASSERT_LE(nb->m_ScaleKeys.Size(), na->m_ScaleKeys.Size());
+            key_count += na->m_TranslationKeys.Size() + na->m_RotationKeys.Size() + na->m_ScaleKeys.Size();
+            reduced_key_count += nb->m_TranslationKeys.Size() + nb->m_RotationKeys.Size() + nb->m_ScaleKeys.Size();
+        }
+    }
+    ASSERT_LE(reduced_key_count, key_count);
+
+    dmModelImporter::DestroyScene(scene);
+    dmModelImporter::DestroyScene(reduced);
+}
+
 
 static int TestStandalone(const char* path)
 {
@@ -15,18 +15,19 @@
 #include <string.h>
 #include <stdint.h>
 #include <float.h>
-#include <algorithm>
 #include <dlib/hash.h>
 #include <dlib/log.h>
 #include <dlib/math.h>
 #include <dlib/math.h>
 #include <dlib/vmath.h>
 #include <dlib/profile.h>
+#include <dlib/static_assert.h>
 #include <dlib/time.h>
 #include <dmsdk/dlib/vmath.h>
 
 #include "particle.h"
 #include "particle_private.h"
+#include "particle_batch.h"
 
 DM_PROPERTY_GROUP(rmtp_Particles, "Particles");
 DM_PROPERTY_U32(rmtp_ParticlesAlive, 0, FrameReset, "# particles alive", &rmtp_Particles);
@@ -50,6 +51,10 @@ namespace dmParticle
     const char* MAX_EMITTER_COUNT_KEY  = "particle_fx.max_emitter_count";
     /// Config key to use for tweaking the total maximum number of particles in a context.
     const char* MAX_PARTICLE_COUNT_KEY = "particle_fx.max_particle_count";
+    /// Config key to use for selecting how off-screen emitters are simulated.
+    const char* OFFSCREEN_MODE_KEY     = "particle_fx.offscreen_mode";
+    /// Config key to use for tweaking how often the particles are sorted.
+    const char* SORT_INTERVAL_KEY      = "particle_fx.sort_interval";
 
     /// Used for degree to radian conversion
     const float DEG_RAD = (float) (M_PI / 180.0);
@@ -112,6 +117,21 @@ namespace dmParticle
         context->m_MaxParticleCount = max_particle_count;
     }
 
+    void SetContextJobThread(HParticleContext context, dmJobThread::HContext job_thread)
+    {
+        context->m_JobThread = job_thread;
+    }
+
+    void SetContextOffscreenMode(HParticleContext context, OffscreenMode mode)
+    {
+        context->m_OffscreenMode = mode;
+    }
+
+    void SetContextSortInterval(HParticleContext context, uint32_t sort_interval)
+    {
+        context->m_SortInterval = dmMath::Max(1u, sort_interval);
+    }
+
     static Instance* GetInstance(HParticleContext context, HInstance instance)
     {
         if (instance == INVALID_INSTANCE)
@@ -270,6 +290,8 @@ namespace dmParticle
             Emitter* emitter = &i->m_Emitters[emitter_i];
             emitter->m_Particles.SetCapacity(0);
             emitter->m_RenderConstants.SetCapacity(0);
+            emitter->m_BatchModifiers.SetCapacity(0);
+            emitter->m_SortScratch.SetCapacity(0);
         }
         delete i;
     }
@@ -299,13 +321,15 @@ namespace dmParticle
     }
 
     static bool IsSleeping(Emitter* emitter);
-    static void UpdateEmitter(Prototype* prototype, Instance* instance, EmitterPrototype* emitter_prototype, Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, float dt);
+    static bool UpdateEmitter(Prototype* prototype, Instance* instance, EmitterPrototype* emitter_prototype, Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, float dt);
+    static void SimulateEmitter(Instance* instance, EmitterPrototype* emitter_prototype, Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, float dt, bool sort);
 
     static void StartEmitter(Instance* instance, Emitter* emitter)
     {
         // TODO: Fix auto-start
         SetEmitterState(instance, emitter, EMITTER_STATE_PRESPAWN);
         emitter->m_Retiring = 0;
+        emitter->m_OffscreenTime = 0.0f;
     }
 
     static void StopEmitter(Instance* instance, Emitter* emitter)
@@ -327,19 +351,28 @@ namespace dmParticle
         return emitter->m_Retiring == 0 && emitter_ddf->m_Mode == PLAY_MODE_LOOP;
     }
 
-    static void FastForwardEmitter(Prototype* prototype, Instance* instance, EmitterPrototype* emitter_prototype, Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, float time)
+    // Updates the emitter in fixed steps until the time has passed
+    static void StepEmitter(Prototype* prototype, Instance* instance, EmitterPrototype* emitter_prototype, Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, float time)
     {
-        StartEmitter(instance, emitter);
         float timer = 0.0f;
         // Hard coded for now
         float dt = 1.0f / 60.0f;
         while (timer < time)
         {
-            UpdateEmitter(prototype, instance, emitter_prototype, emitter, emitter_ddf, dt);
+            if (UpdateEmitter(prototype, instance, emitter_prototype, emitter, emitter_ddf, dt))
+            {
+                SimulateEmitter(instance, emitter_prototype, emitter, emitter_ddf, dt, true);
+            }
             timer += dt;
         }
     }
 
+    static void FastForwardEmitter(Prototype* prototype, Instance* instance, EmitterPrototype* emitter_prototype, Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, float time)
+    {
+        StartEmitter(instance, emitter);
+        StepEmitter(prototype, instance, emitter_prototype, emitter, emitter_ddf, time);
+    }
+
     static float CalculateReplayTime(float duration, float start_delay, float max_particle_life_time, float play_time)
     {
         float time = play_time;
@@ -375,6 +408,8 @@ namespace dmParticle
                 for (uint32_t emitter_i = prototype_emitter_count; emitter_i < emitter_count; ++emitter_i)
                 {
                     emitters[emitter_i].m_Particles.SetCapacity(0);
+                    emitters[emitter_i].m_BatchModifiers.SetCapacity(0);
+                    emitters[emitter_i].m_SortScratch.SetCapacity(0);
                 }
             }
             emitters.SetCapacity(prototype_emitter_count);
@@ -604,22 +639,120 @@ namespace dmParticle
     static void SortParticles(Emitter* emitter);
     static void Simulate(Instance* instance, Emitter* emitter, EmitterPrototype* prototype, dmParticleDDF::Emitter* ddf, float dt);
 
-    static void UpdateEmitter(Prototype* prototype, Instance* instance, EmitterPrototype* emitter_prototype, Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, float dt)
+    // Removes the dead particles and spawns new ones. Returns true if the particles should then be simulated with SimulateEmitter
+    static bool UpdateEmitter(Prototype* prototype, Instance* instance, EmitterPrototype* emitter_prototype, Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, float dt)
     {
         // Don't update emitter if time is standing still
         if (IsSleeping(emitter) || dt <= 0.0f)
-            return;
+            return false;
 
         UpdateParticles(instance, emitter, emitter_ddf, dt);
 
         UpdateEmitterState(instance, emitter, emitter_prototype, emitter_ddf, dt);
+        return true;
+    }
 
-        GenerateKeys(emitter, emitter_prototype->m_MaxParticleLifeTime);
-        SortParticles(emitter);
+    // Only modifies the emitter (and never calls any callbacks), so that the emitters can be simulated in parallel
+    static void SimulateEmitter(Instance* instance, EmitterPrototype* emitter_prototype, Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, float dt, bool sort)
+    {
+        if (sort)
+        {
+            GenerateKeys(emitter, emitter_prototype->m_MaxParticleLifeTime);
+            SortParticles(emitter);
+        }
 
         Simulate(instance, emitter, emitter_prototype, emitter_ddf, dt);
     }
 
+    static void SimulateEmittersRange(void* _ctx, uint32_t begin, uint32_t end)
+    {
+        DM_PROFILE("SimulateEmittersRange");
+        const EmitterSimulateJob* jobs = (const EmitterSimulateJob*) _ctx;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const EmitterSimulateJob& job = jobs[i];
+            SimulateEmitter(job.m_Instance, job.m_Prototype, job.m_Emitter, job.m_DDF, job.m_Dt, job.m_Sort);
+        }
+    }
+
+    // Whether the particles of the emitter are sorted this frame. With a sort interval above one, the emitters are sorted
+    // every sort interval frames, and not at all while off-screen.
+    static bool UpdateSortCounter(HParticleContext context, Emitter* emitter)
+    {
+        uint32_t sort_interval = context->m_SortInterval;
+        if (sort_interval <= 1)
+        {
+            return true;
+        }
+        if (emitter->m_Offscreen)
+        {
+            return false;
+        }
+        bool sort = emitter->m_SortCounter == 0;
+        emitter->m_SortCounter = (emitter->m_SortCounter + 1) % sort_interval;
+        return sort;
+    }
+
+    // Returns the time to update the emitter by, given the time dt since the last update and whether the emitter was rendered since then
+    static float UpdateOffscreenEmitter(OffscreenMode mode, Prototype* prototype, Instance* instance, EmitterPrototype* emitter_prototype, Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, float dt)
+    {
+        if (!emitter->m_Offscreen)
+        {
+            float offscreen_time = emitter->m_OffscreenTime;
+            emitter->m_OffscreenTime = 0.0f;
+            if (mode == OFFSCREEN_MODE_FAST_FORWARD && offscreen_time > 0.0f)
+            {
+                // The particles that were alive before are all gone after their max life time, so there is no need to go further
+                StepEmitter(prototype, instance, emitter_prototype, emitter, emitter_ddf, dmMath::Min(offscreen_time, emitter_prototype->m_MaxParticleLifeTime));
+            }
+            else if (mode == OFFSCREEN_MODE_REDUCED_RATE)
+            {
+                return dt + offscreen_time;
+            }
+            return dt;
+        }
+
+        if (mode == OFFSCREEN_MODE_PAUSE)
+        {
+            return 0.0f;
+        }
+
+        emitter->m_OffscreenTime += dt;
+        if (mode == OFFSCREEN_MODE_REDUCED_RATE && emitter->m_OffscreenTime >= OFFSCREEN_UPDATE_INTERVAL)
+        {
+            float offscreen_time = emitter->m_OffscreenTime;
+            emitter->m_OffscreenTime = 0.0f;
+            return offscreen_time;
+        }
+        return 0.0f;
+    }
+
+    // Updates the world space bounds in the render data from the emitter position and the bounds of the particles
+    static void UpdateEmitterBounds(Instance* instance, Emitter* emitter, dmParticleDDF::Emitter* ddf)
+    {
+        EmitterRenderData& render_data = emitter->m_RenderData;
+        Vector3 position = render_data.m_Transform.getTranslation();
+        render_data.m_AabbMin = position;
+        render_data.m_AabbMax = position;
+        if (emitter->m_Particles.Empty())
+        {
+            return;
+        }
+
+        Vector3 center = (Vector3(emitter->m_ParticleAabbMin) + Vector3(emitter->m_ParticleAabbMax)) * 0.5f;
+        Vector3 extent = (emitter->m_ParticleAabbMax - emitter->m_ParticleAabbMin) * 0.5f;
+        if (ddf->m_Space == EMISSION_SPACE_EMITTER)
+        {
+            Matrix4 transform = dmTransform::ToMatrix4(instance->m_WorldTransform);
+            center = (transform * Point3(center)).getXYZ();
+            extent = dmVMath::AbsPerElem(transform.getCol0().getXYZ()) * extent.getX()
+                   + dmVMath::AbsPerElem(transform.getCol1().getXYZ()) * extent.getY()
+                   + dmVMath::AbsPerElem(transform.getCol2().getXYZ()) * extent.getZ();
+        }
+        render_data.m_AabbMin = minPerElem(render_data.m_AabbMin, center - extent);
+        render_data.m_AabbMax = maxPerElem(render_data.m_AabbMax, center + extent);
+    }
+
     static void UpdateEmitterVelocity(Instance* instance, Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, float dt)
     {
         // Update emitter velocity (1-frame estimate)
@@ -673,6 +806,7 @@ namespace dmParticle
         dmParticleDDF::Emitter* emitter_ddf = &prototype->m_DDF->m_Emitters[emitter_index];
 
         uint32_t bytes_written = 0;
+        emitter->m_Offscreen = 0;
 
         GenerateVertexDataResult res = GENERATE_VERTEX_DATA_OK;
         if (vertex_buffer != 0x0 && vertex_buffer_size > 0)
@@ -686,12 +820,49 @@ namespace dmParticle
         return res;
     }
 
+    GenerateVertexDataResult GenerateVertexDataRange(HParticleContext context, float dt, HInstance instance, uint32_t emitter_index, const dmGraphics::VertexAttributeInfos& attribute_infos, const Vector4& color, void* vertex_buffer, uint32_t vertex_start, uint32_t vertex_count, uint32_t* out_vertex_count)
+    {
+        assert(attribute_infos.m_StructSize == sizeof(dmGraphics::VertexAttributeInfos));
+        assert(attribute_infos.m_VertexStride != 0);
+
+        DM_PROFILE(__FUNCTION__);
+        *out_vertex_count = 0;
+        if (instance == INVALID_INSTANCE)
+        {
+            return GENERATE_VERTEX_DATA_INVALID_INSTANCE;
+        }
+
+        Instance* inst = GetInstance(context, instance);
+        if (IsSleeping(inst) || vertex_buffer == 0x0)
+        {
+            return GENERATE_VERTEX_DATA_OK;
+        }
+
+        uint32_t vertex_size                = attribute_infos.m_VertexStride;
+        Prototype* prototype                = inst->m_Prototype;
+        Emitter* emitter                    = &inst->m_Emitters[emitter_index];
+        dmParticleDDF::Emitter* emitter_ddf = &prototype->m_DDF->m_Emitters[emitter_index];
+
+        // The end of the range is the end of the buffer as far as UpdateRenderData is concerned
+        uint32_t bytes_written = 0;
+        emitter->m_Offscreen = 0;
+        GenerateVertexDataResult res = UpdateRenderData(context, inst, emitter, emitter_ddf, attribute_infos, color, vertex_start, (uint8_t*) vertex_buffer, (vertex_start + vertex_count) * vertex_size, &bytes_written, dt);
+        *out_vertex_count = bytes_written / vertex_size;
+        return res;
+    }
+
     void Update(HParticleContext context, float dt, FetchAnimationCallback fetch_animation_callback)
     {
         DM_PROFILE(__FUNCTION__);
 
         uint32_t size = context->m_Instances.Size();
         uint32_t TotalAliveParticles = 0;
+
+        // The particles are spawned here, since that may call the emitter state callbacks, and then the emitters are simulated on the job threads
+        bool parallel = context->m_JobThread && dmJobThread::GetWorkerCount(context->m_JobThread) > 0;
+        dmArray<EmitterSimulateJob>& jobs = context->m_SimulateJobs;
+        jobs.SetSize(0);
+
         for (uint32_t i = 0; i < size; i++)
         {
             Instance* instance = context->m_Instances[i];
@@ -723,7 +894,27 @@ namespace dmParticle
                 dmParticleDDF::Emitter* emitter_ddf = &prototype->m_DDF->m_Emitters[emitter_i];
 
                 UpdateEmitterVelocity(instance, emitter, emitter_ddf, dt);
-                UpdateEmitter(prototype, instance, emitter_prototype, emitter, emitter_ddf, dt);
+                float emitter_dt = dt;
+                if (context->m_OffscreenMode != OFFSCREEN_MODE_SIMULATE && IsEmitterLooping(emitter, emitter_ddf))
+                {
+                    emitter_dt = UpdateOffscreenEmitter(context->m_OffscreenMode, prototype, instance, emitter_prototype, emitter, emitter_ddf, dt);
+                }
+                bool sort = UpdateSortCounter(context, emitter);
+                // Cleared when the emitter is rendered
+                emitter->m_Offscreen = 1;
+
+                if (UpdateEmitter(prototype, instance, emitter_prototype, emitter, emitter_ddf, emitter_dt))
+                {
+                    if (parallel)
+                    {
+                        EmitterSimulateJob job = { instance, emitter, emitter_prototype, emitter_ddf, emitter_dt, sort };
+                        jobs.PushGrow(job);
+                    }
+                    else
+                    {
+                        SimulateEmitter(instance, emitter_prototype, emitter, emitter_ddf, emitter_dt, sort);
+                    }
+                }
                 TotalAliveParticles += (uint32_t)emitter->m_Particles.Size();
                 FetchAnimation(emitter, emitter_prototype, fetch_animation_callback);
                 UpdateEmitterRenderData(instance_handle, emitter_i, instance, emitter, emitter_ddf);
@@ -733,6 +924,17 @@ namespace dmParticle
             }
         }
 
+        if (!jobs.Empty())
+        {
+            dmJobThread::ParallelFor(context->m_JobThread, jobs.Size(), 1, SimulateEmittersRange, jobs.Begin());
+
+            // The render data was updated before the particles were simulated
+            for (uint32_t i = 0; i < jobs.Size(); ++i)
+            {
+                UpdateEmitterBounds(jobs[i].m_Instance, jobs[i].m_Emitter, jobs[i].m_DDF);
+            }
+        }
+
         DM_PROPERTY_SET_U32(rmtp_ParticlesAlive, TotalAliveParticles);
     }
 
@@ -1326,15 +1528,6 @@ namespace dmParticle
         return res;
     }
 
-    struct SortPred
-    {
-        inline bool operator () (const Particle& p1, const Particle& p2)
-        {
-            return p1.GetSortKey().m_Key < p2.GetSortKey().m_Key;
-        }
-
-    };
-
     void GenerateKeys(Emitter* emitter, float max_particle_life_time)
     {
         dmArray<Particle>& particles = emitter->m_Particles;
@@ -1358,11 +1551,86 @@ namespace dmParticle
         }
     }
 
+    // Sorts the particles by their keys (see GenerateKeys) with a radix sort. The low 16 bits of a key is the current index
+    // of the particle, so the radix passes are only run over the life time bits, keeping the order between equal life times.
     void SortParticles(Emitter* emitter)
     {
         DM_PROFILE(__FUNCTION__);
 
-        std::sort(emitter->m_Particles.Begin(), emitter->m_Particles.End(), SortPred());
+        dmArray<Particle>& particles = emitter->m_Particles;
+        uint32_t n = particles.Size();
+        if (n < 2)
+        {
+            return;
+        }
+
+        dmArray<uint32_t>& scratch = emitter->m_SortScratch;
+        if (scratch.Capacity() < n * 2)
+        {
+            scratch.SetCapacity(n * 2);
+        }
+        scratch.SetSize(n * 2);
+        uint32_t* keys = scratch.Begin();
+        uint32_t* keys_tmp = keys + n;
+
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            keys[i] = particles[i].GetSortKey().m_Key;
+        }
+
+        for (uint32_t shift = 16; shift < 32; shift += 8)
+        {
+            uint32_t offsets[256] = {0};
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                offsets[(keys[i] >> shift) & 0xff]++;
+            }
+            // All the keys have the same digit, e.g. particles spawned in the same frame
+            if (offsets[(keys[0] >> shift) & 0xff] == n)
+            {
+                continue;
+            }
+
+            uint32_t offset = 0;
+            for (uint32_t d = 0; d < 256; ++d)
+            {
+                uint32_t count = offsets[d];
+                offsets[d] = offset;
+                offset += count;
+            }
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                uint32_t key = keys[i];
+                keys_tmp[offsets[(key >> shift) & 0xff]++] = key;
+            }
+
+            uint32_t* tmp = keys;
+            keys = keys_tmp;
+            keys_tmp = tmp;
+        }
+
+        // Move the particles to their sorted positions by following the cycles of the permutation, so that
+        // each particle is copied once. The key of a position is set to the position itself once it is done.
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            uint32_t src = keys[i] & 0xffff;
+            if (src == i)
+            {
+                continue;
+            }
+
+            Particle particle = particles[i];
+            uint32_t dst = i;
+            while (src != i)
+            {
+                particles[dst] = particles[src];
+                keys[dst] = dst;
+                dst = src;
+                src = keys[dst] & 0xffff;
+            }
+            particles[dst] = particle;
+            keys[dst] = dst;
+        }
     }
 
 #define SAMPLE_PROP(segment, x, target)\
@@ -1452,119 +1720,11 @@ namespace dmParticle
 
     }
 
-    void ApplyAcceleration(dmArray<Particle>& particles, Property* modifier_properties, const Quat& rotation, float scale, float emitter_t, float dt)
-    {
-        uint32_t particle_count = particles.Size();
-        Vector3 acc_step = rotate(rotation, ACCELERATION_LOCAL_DIR) * dt * scale;
-        const Property& magnitude_property = modifier_properties[MODIFIER_KEY_MAGNITUDE];
-        uint32_t segment_index = dmMath::Min((uint32_t)(emitter_t * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
-        float magnitude;
-        SAMPLE_PROP(magnitude_property.m_Segments[segment_index], emitter_t, magnitude)
-        float mag_spread = magnitude_property.m_Spread;
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* particle = &particles[i];
-            particle->SetVelocity(particle->GetVelocity() + acc_step * (magnitude + mag_spread * particle->GetSpreadFactor()));
-        }
-    }
-
-    void ApplyDrag(dmArray<Particle>& particles, Property* modifier_properties, dmParticleDDF::Modifier* modifier_ddf, const Quat& rotation, float emitter_t, float dt)
-    {
-        uint32_t particle_count = particles.Size();
-        Vector3 direction = rotate(rotation, DRAG_LOCAL_DIR);
-        const Property& magnitude_property = modifier_properties[MODIFIER_KEY_MAGNITUDE];
-        uint32_t segment_index = dmMath::Min((uint32_t)(emitter_t * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
-        float magnitude;
-        SAMPLE_PROP(magnitude_property.m_Segments[segment_index], emitter_t, magnitude)
-        float mag_spread = magnitude_property.m_Spread;
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* particle = &particles[i];
-            Vector3 v = particle->GetVelocity();
-            if (modifier_ddf->m_UseDirection)
-                v = projection(Point3(particle->GetVelocity()), direction) * direction;
-            // Applied drag > 1 means the particle would travel in the reverse direction
-            float applied_drag = dmMath::Min((magnitude + mag_spread * particle->GetSpreadFactor()) * dt, 1.0f);
-            particle->SetVelocity(particle->GetVelocity() - v * applied_drag);
-        }
-    }
-
-    static Vector3 GetParticleDir(Particle* particle)
+    static Vector3 GetParticleDir(const Particle* particle)
     {
         return rotate(particle->GetRotation(), PARTICLE_LOCAL_BASE_DIR);
     }
 
-    static Vector3 NonZeroVector3(Vector3 v, float sq_length, Vector3 fallback)
-    {
-        Vector3 result;
-        float neg_sq_length = -sq_length;
-        result.setX(dmMath::Select(neg_sq_length, fallback.getX(), v.getX()));
-        result.setY(dmMath::Select(neg_sq_length, fallback.getY(), v.getY()));
-        result.setZ(dmMath::Select(neg_sq_length, fallback.getZ(), v.getZ()));
-        return result;
-    }
-
-    void ApplyRadial(dmArray<Particle>& particles, Property* modifier_properties, const Point3& position, float scale, float emitter_t, float dt)
-    {
-        uint32_t particle_count = particles.Size();
-        const Property& magnitude_property = modifier_properties[MODIFIER_KEY_MAGNITUDE];
-        const Property& max_distance_property = modifier_properties[MODIFIER_KEY_MAX_DISTANCE];
-        uint32_t segment_index = dmMath::Min((uint32_t)(emitter_t * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
-        float magnitude;
-        SAMPLE_PROP(magnitude_property.m_Segments[segment_index], emitter_t, magnitude)
-        float mag_spread = magnitude_property.m_Spread;
-        // We temporarily only sample the first frame until we have decided what to animate over
-        float max_distance = max_distance_property.m_Segments[0].m_Y * scale;
-        float max_sq_distance = max_distance * max_distance;
-        float applied_factor = dt * scale;
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* particle = &particles[i];
-            Vector3 delta = particle->GetPosition() - position;
-            float delta_sq_len = lengthSqr(delta);
-            float applied_magnitude = magnitude + mag_spread * particle->GetSpreadFactor();
-            // 0 acc delta lies outside max dist
-            float a = dmMath::Select(max_sq_distance - delta_sq_len, applied_magnitude, 0.0f);
-            Vector3 dir = normalize(NonZeroVector3(delta, delta_sq_len, GetParticleDir(particle)));
-            particle->SetVelocity(particle->GetVelocity() + dir * a * applied_factor);
-        }
-    }
-
-    void ApplyVortex(dmArray<Particle>& particles, Property* modifier_properties, const Point3& position, const Quat& rotation, float scale, float emitter_t, float dt)
-    {
-        uint32_t particle_count = particles.Size();
-        const Property& magnitude_property = modifier_properties[MODIFIER_KEY_MAGNITUDE];
-        const Property& max_distance_property = modifier_properties[MODIFIER_KEY_MAX_DISTANCE];
-        uint32_t segment_index = dmMath::Min((uint32_t)(emitter_t * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
-        float magnitude;
-        SAMPLE_PROP(magnitude_property.m_Segments[segment_index], emitter_t, magnitude)
-        float mag_spread = magnitude_property.m_Spread;
-        // We temporarily only sample the first frame until we have decided what to animate over
-        float max_distance = max_distance_property.m_Segments[0].m_Y * scale;
-        float max_sq_distance = max_distance * max_distance;
-        Vector3 axis = rotate(rotation, VORTEX_LOCAL_AXIS);
-        Vector3 start = rotate(rotation, VORTEX_LOCAL_START_DIR);
-        float applied_factor = dt * scale;
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* particle = &particles[i];
-            // delta from vortex position
-            Vector3 delta = particle->GetPosition() - position;
-            // normal from vortex axis (non-unit)
-            Vector3 normal = delta - projection(Point3(delta), axis) * axis;
-            // tangent is the direction of the vortex acceleration
-            Vector3 tangent = cross(axis, normal);
-            // In case the particle is directed along the axis, give it a guaranteed orthogonal start
-            tangent = NonZeroVector3(tangent, lengthSqr(tangent), start);
-            // tangent is now guaranteed to be non-zero
-            tangent = normalize(tangent);
-            // use normal for max distance test
-            float normal_sq_len = lengthSqr(normal);
-            float acceleration = dmMath::Select(max_sq_distance - normal_sq_len, magnitude + mag_spread * particle->GetSpreadFactor(), 0.0f);
-            particle->SetVelocity(particle->GetVelocity() + tangent * acceleration * applied_factor);
-        }
-    }
-
 #undef SAMPLE_PROP
 
     static Point3 CalculateModifierPosition(Instance* instance, dmParticleDDF::Emitter* emitter_ddf, dmParticleDDF::Modifier* modifier_ddf)
@@ -1586,6 +1746,58 @@ namespace dmParticle
         return emitter_ddf->m_Rotation * modifier_ddf->m_Rotation;
     }
 
+    static float EvaluateProperty(const Property& property, float x)
+    {
+        uint32_t segment_index = dmMath::Min((uint32_t)(x * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
+        const LinearSegment& segment = property.m_Segments[segment_index];
+        return (x - segment.m_X) * segment.m_K + segment.m_Y;
+    }
+
+    static void SetupBatchModifier(Instance* instance, dmParticleDDF::Emitter* ddf, ModifierPrototype* modifier, dmParticleDDF::Modifier* modifier_ddf, float scale, float emitter_t, float dt, BatchModifier* out)
+    {
+        memset(out, 0, sizeof(*out));
+        const Property& magnitude_property = modifier->m_Properties[MODIFIER_KEY_MAGNITUDE];
+        out->m_Type            = modifier_ddf->m_Type;
+        out->m_Magnitude       = EvaluateProperty(magnitude_property, emitter_t);
+        out->m_MagnitudeSpread = magnitude_property.m_Spread;
+        out->m_UseDirection    = modifier_ddf->m_UseDirection;
+
+        Vector3 direction(0.0f);
+        Vector3 start_direction(0.0f);
+        Point3 position(0.0f);
+        switch (modifier_ddf->m_Type)
+        {
+        case dmParticleDDF::MODIFIER_TYPE_ACCELERATION:
+            direction = rotate(CalculateModifierRotation(instance, ddf, modifier_ddf), ACCELERATION_LOCAL_DIR) * dt * scale;
+            break;
+        case dmParticleDDF::MODIFIER_TYPE_DRAG:
+            direction = rotate(CalculateModifierRotation(instance, ddf, modifier_ddf), DRAG_LOCAL_DIR);
+            break;
+        case dmParticleDDF::MODIFIER_TYPE_RADIAL:
+            position = CalculateModifierPosition(instance, ddf, modifier_ddf);
+            break;
+        case dmParticleDDF::MODIFIER_TYPE_VORTEX:
+            {
+                Quat rotation = CalculateModifierRotation(instance, ddf, modifier_ddf);
+                position = CalculateModifierPosition(instance, ddf, modifier_ddf);
+                direction = rotate(rotation, VORTEX_LOCAL_AXIS);
+                start_direction = rotate(rotation, VORTEX_LOCAL_START_DIR);
+            }
+            break;
+        }
+
+        // We temporarily only sample the first frame until we have decided what to animate over
+        float max_distance = modifier->m_Properties[MODIFIER_KEY_MAX_DISTANCE].m_Segments[0].m_Y * scale;
+        out->m_MaxSqDistance = max_distance * max_distance;
+        out->m_AppliedFactor = dt * scale;
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            out->m_Direction[i]      = direction.getElem(i);
+            out->m_StartDirection[i] = start_direction.getElem(i);
+            out->m_Position[i]       = position.getElem(i);
+        }
+    }
+
     void Simulate(Instance* instance, Emitter* emitter, EmitterPrototype* prototype, dmParticleDDF::Emitter* ddf, float dt)
     {
         DM_PROFILE(__FUNCTION__);
@@ -1596,54 +1808,97 @@ namespace dmParticle
         float scale = 1.0f;
         if (ddf->m_Space == EMISSION_SPACE_WORLD)
             scale = instance->m_WorldTransform.GetScale();
-        // Apply modifiers
+
+        // The modifiers are evaluated once, and then applied to the particles in batches
         uint32_t modifier_count = prototype->m_Modifiers.Size();
+        dmArray<BatchModifier>& modifiers = emitter->m_BatchModifiers;
+        if (modifiers.Capacity() < modifier_count)
+        {
+            modifiers.SetCapacity(modifier_count);
+        }
+        modifiers.SetSize(modifier_count);
+        bool use_particle_direction = false;
         for (uint32_t i = 0; i < modifier_count; ++i)
         {
-            ModifierPrototype* modifier = &prototype->m_Modifiers[i];
             dmParticleDDF::Modifier* modifier_ddf = &ddf->m_Modifiers[i];
-            switch (modifier_ddf->m_Type)
+            SetupBatchModifier(instance, ddf, &prototype->m_Modifiers[i], modifier_ddf, scale, emitter_t, dt, &modifiers[i]);
+            use_particle_direction |= modifier_ddf->m_Type == dmParticleDDF::MODIFIER_TYPE_RADIAL;
+        }
+
+        // The largest extent of a particle quad from its position is half its diagonal, plus the pivot offset.
+        // The particles are sized by their tiles in auto size mode, instead of the size property (see UpdateRenderData).
+        const AnimationData& anim_data = emitter->m_AnimationData;
+        float size_factor = -1.0f;
+        if (ddf->m_SizeMode == SIZE_MODE_AUTO && anim_data.m_TexDims != 0x0 && anim_data.m_Playback != ANIM_PLAYBACK_NONE && anim_data.m_EndTile - anim_data.m_StartTile > 1)
+        {
+            size_factor = 0.0f;
+            for (uint32_t tile = anim_data.m_StartTile; tile < anim_data.m_EndTile; ++tile)
             {
-            case dmParticleDDF::MODIFIER_TYPE_ACCELERATION:
-                {
-                    Quat rotation = CalculateModifierRotation(instance, ddf, modifier_ddf);
-                    ApplyAcceleration(particles, modifier->m_Properties, rotation, scale, emitter_t, dt);
-                }
-                break;
-            case dmParticleDDF::MODIFIER_TYPE_DRAG:
-                {
-                    Quat rotation = CalculateModifierRotation(instance, ddf, modifier_ddf);
-                    ApplyDrag(particles, modifier->m_Properties, modifier_ddf, rotation, emitter_t, dt);
-                }
-                break;
-            case dmParticleDDF::MODIFIER_TYPE_RADIAL:
+                const float* td = &anim_data.m_TexDims[tile << 1];
+                size_factor = dmMath::Max(size_factor, dmMath::Max(td[0], td[1]));
+            }
+        }
+        const float extent_factor = 0.7072f + length(Vector3(ddf->m_Pivot));
+        Vector3 aabb_min(FLT_MAX);
+        Vector3 aabb_max(-FLT_MAX);
+        float max_extent = 0.0f;
+
+        ParticleBatch batch;
+        uint32_t particle_count = particles.Size();
+        for (uint32_t start = 0; start < particle_count; start += PARTICLE_BATCH_SIZE)
+        {
+            uint32_t count = dmMath::Min(PARTICLE_BATCH_SIZE, particle_count - start);
+            Particle* batch_particles = &particles[start];
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const Particle* p = &batch_particles[i];
+                batch.m_PositionX[i]    = p->m_Position.getX();
+                batch.m_PositionY[i]    = p->m_Position.getY();
+                batch.m_PositionZ[i]    = p->m_Position.getZ();
+                batch.m_VelocityX[i]    = p->m_Velocity.getX();
+                batch.m_VelocityY[i]    = p->m_Velocity.getY();
+                batch.m_VelocityZ[i]    = p->m_Velocity.getZ();
+                batch.m_SpreadFactor[i] = p->m_SpreadFactor;
+                if (use_particle_direction)
                 {
-                    Point3 position = CalculateModifierPosition(instance, ddf, modifier_ddf);
-                    ApplyRadial(particles, modifier->m_Properties, position, scale, emitter_t, dt);
+                    Vector3 dir = GetParticleDir(p);
+                    batch.m_DirectionX[i] = dir.getX();
+                    batch.m_DirectionY[i] = dir.getY();
+                    batch.m_DirectionZ[i] = dir.getZ();
                 }
-                break;
-            case dmParticleDDF::MODIFIER_TYPE_VORTEX:
+                else
                 {
-                    Point3 position = CalculateModifierPosition(instance, ddf, modifier_ddf);
-                    Quat rotation = CalculateModifierRotation(instance, ddf, modifier_ddf);
-                    ApplyVortex(particles, modifier->m_Properties, position, rotation, scale, emitter_t, dt);
+                    batch.m_DirectionX[i] = batch.m_DirectionY[i] = batch.m_DirectionZ[i] = 0.0f;
                 }
-                break;
+            }
+
+            SimulateParticleBatch(&batch, count, modifiers.Begin(), modifier_count, dt);
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                Particle* p = &batch_particles[i];
+                p->m_Position = Point3(batch.m_PositionX[i], batch.m_PositionY[i], batch.m_PositionZ[i]);
+                p->m_Velocity = Vector3(batch.m_VelocityX[i], batch.m_VelocityY[i], batch.m_VelocityZ[i]);
+
+                p->m_Scale[0] += p->m_Scale[0] * p->m_StretchFactorX;
+                if (!ddf->m_StretchWithVelocity)
+                    p->m_Scale[1] += p->m_Scale[1] * p->m_StretchFactorY;
+                else
+                    p->m_Scale[1] += p->m_Scale[1] * p->m_StretchFactorY * length(p->m_Velocity) * STRETCH_SCALING;
+
+                Vector3 position(p->m_Position);
+                aabb_min = minPerElem(aabb_min, position);
+                aabb_max = maxPerElem(aabb_max, position);
+                float size = size_factor >= 0.0f ? size_factor : p->m_SourceSize;
+                max_extent = dmMath::Max(max_extent, dmMath::Max(dmMath::Abs(p->m_Scale[0]), dmMath::Abs(p->m_Scale[1])) * size);
             }
         }
-        uint32_t particle_count = particles.Size();
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* p = &particles[i];
-            // NOTE This velocity integration has a larger error than normal since we don't use the velocity at the
-            // beginning of the frame, but it's ok since particle movement does not need to be very exact
-            p->SetPosition(p->GetPosition() + p->m_Velocity * dt);
 
-            p->m_Scale[0] += p->m_Scale[0] * p->m_StretchFactorX;
-            if (!ddf->m_StretchWithVelocity)
-                p->m_Scale[1] += p->m_Scale[1] * p->m_StretchFactorY;
-            else
-                p->m_Scale[1] += p->m_Scale[1] * p->m_StretchFactorY * length(p->m_Velocity) * STRETCH_SCALING;
+        if (particle_count > 0)
+        {
+            Vector3 extent(max_extent * extent_factor);
+            emitter->m_ParticleAabbMin = Point3(aabb_min - extent);
+            emitter->m_ParticleAabbMax = Point3(aabb_max + extent);
         }
     }
 
@@ -1958,6 +2213,8 @@ namespace dmParticle
         render_data.m_EmitterIndex = emitter_index;
         render_data.m_Attributes = ddf->m_Attributes.m_Data;
         render_data.m_AttributeCount = ddf->m_Attributes.m_Count;
+
+        UpdateEmitterBounds(inst, emitter, ddf);
     }
 
     // Update render data for all emitters on an instance
@@ -2265,6 +2522,12 @@ namespace dmParticle
         return name(a1, a2, a3, a4, a5, a6, a7, a8, a9);\
     }\
 
+#define DM_PARTICLE_TRAMPOLINE10(ret, name, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10) \
+    ret Particle_##name(t1 a1, t2 a2, t3 a3, t4 a4, t5 a5, t6 a6, t7 a7, t8 a8, t9 a9, t10 a10)\
+    {\
+        return name(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10);\
+    }\
+
     DM_PARTICLE_TRAMPOLINE2(HParticleContext, CreateContext, uint32_t, uint32_t);
     DM_PARTICLE_TRAMPOLINE1(void, DestroyContext, HParticleContext);
     DM_PARTICLE_TRAMPOLINE1(uint32_t, GetContextMaxParticleCount, HParticleContext);
@@ -2285,6 +2548,7 @@ namespace dmParticle
     DM_PARTICLE_TRAMPOLINE2(bool, IsSleeping, HParticleContext, HInstance);
     DM_PARTICLE_TRAMPOLINE3(void, Update, HParticleContext, float, FetchAnimationCallback);
     DM_PARTICLE_TRAMPOLINE9(GenerateVertexDataResult, GenerateVertexData, HParticleContext, float, HInstance, uint32_t, const dmGraphics::VertexAttributeInfos&, const Vector4&, void*, uint32_t, uint32_t*);
+    DM_PARTICLE_TRAMPOLINE10(GenerateVertexDataResult, GenerateVertexDataRange, HParticleContext, float, HInstance, uint32_t, const dmGraphics::VertexAttributeInfos&, const Vector4&, void*, uint32_t, uint32_t, uint32_t*);
 
     DM_PARTICLE_TRAMPOLINE2(HPrototype, NewPrototype, const void*, uint32_t);
     DM_PARTICLE_TRAMPOLINE1(HPrototype, NewPrototypeFromDDF, dmParticleDDF::ParticleFX*);
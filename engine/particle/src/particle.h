@@ -17,6 +17,7 @@
 
 #include <dmsdk/dlib/vmath.h>
 #include <dlib/hash.h>
+#include <dlib/job_thread.h>
 #include <ddf/ddf.h>
 #include <graphics/graphics.h>
 #include "particle/particle_ddf.h"
@@ -64,6 +65,10 @@ namespace dmParticle
     extern const char* MAX_EMITTER_COUNT_KEY;
     /// Config key to use for tweaking the total maximum number of particles in a context.
     extern const char* MAX_PARTICLE_COUNT_KEY;
+    /// Config key to use for selecting how off-screen emitters are simulated (see OffscreenMode).
+    extern const char* OFFSCREEN_MODE_KEY;
+    /// Config key to use for tweaking how often the particles are sorted, in frames.
+    extern const char* SORT_INTERVAL_KEY;
 
     /**
      * Render constants supplied to the render callback.
@@ -157,6 +162,9 @@ namespace dmParticle
         uint32_t                     m_EmitterIndex;
         uint32_t                     m_MixedHash;
         uint32_t                     m_MixedHashNoMaterial;
+        /// World space bounds of the emitter and its particles, updated by Update
+        dmVMath::Vector3             m_AabbMin;
+        dmVMath::Vector3             m_AabbMax;
     };
 
     /**
@@ -212,6 +220,25 @@ namespace dmParticle
         uint32_t m_StructSize;
     };
 
+    /**
+     * How looping emitters are simulated while they are off-screen, i.e. when no vertices were generated for them since the previous Update.
+     * Emitters that play once are always simulated, so that they finish.
+     */
+    enum OffscreenMode
+    {
+        /// The emitters are simulated as if they were visible
+        OFFSCREEN_MODE_SIMULATE     = 0,
+        /// The emitters are paused, and resume where they were when they are visible again
+        OFFSCREEN_MODE_PAUSE        = 1,
+        /// The emitters are simulated a few times per second (see OFFSCREEN_UPDATE_INTERVAL)
+        OFFSCREEN_MODE_REDUCED_RATE = 2,
+        /// The emitters are paused, and fast forwarded by the time spent off-screen when they are visible again
+        OFFSCREEN_MODE_FAST_FORWARD = 3,
+    };
+
+    /// The time in seconds between the updates of the off-screen emitters in OFFSCREEN_MODE_REDUCED_RATE
+    static const float OFFSCREEN_UPDATE_INTERVAL = 0.25f;
+
     // For tests
     dmVMath::Vector3 GetPosition(HParticleContext context, HInstance instance);
 
@@ -246,6 +273,28 @@ namespace dmParticle
      */
     DM_PARTICLE_PROTO(void, SetContextMaxParticleCount, HParticleContext context, uint32_t max_particle_count);
 
+    /**
+     * Set the job thread used to simulate the emitters in parallel during Update.
+     * @param context Context to update.
+     * @param job_thread Job thread context, or 0x0 to simulate the emitters on the calling thread
+     */
+    void SetContextJobThread(HParticleContext context, dmJobThread::HContext job_thread);
+
+    /**
+     * Set how the looping emitters of the context are simulated while they are off-screen.
+     * @param context Context to update.
+     * @param mode The off-screen mode, OFFSCREEN_MODE_SIMULATE by default
+     */
+    void SetContextOffscreenMode(HParticleContext context, OffscreenMode mode);
+
+    /**
+     * Set how often the particles of the emitters are sorted by their life time. Above one, the order of the particles
+     * is only approximate between sorts, and the particles of off-screen emitters aren't sorted at all.
+     * @param context Context to update.
+     * @param sort_interval Number of frames between the sorts, 1 (every frame) by default
+     */
+    void SetContextSortInterval(HParticleContext context, uint32_t sort_interval);
+
     /**
      * Create an instance from the supplied path and fetch resources using the supplied factory.
      * @param context Context in which to create the instance, must be valid.
@@ -363,6 +412,23 @@ namespace dmParticle
      */
     DM_PARTICLE_PROTO(GenerateVertexDataResult, GenerateVertexData, HParticleContext context, float dt, HInstance instance, uint32_t emitter_index, const dmGraphics::VertexAttributeInfos& attribute_infos, const dmVMath::Vector4& color, void* vertex_buffer, uint32_t vertex_buffer_size, uint32_t* out_vertex_buffer_size);
 
+    /**
+     * Generates vertex data for an emitter into a preassigned range of a vertex buffer, e.g. the ranges reserved with GetEmitterVertexCount.
+     * Unlike GenerateVertexData, the context isn't modified, so it can be called from several threads at a time for different emitters.
+     * @param context Particle context
+     * @param dt Time step.
+     * @param instance Particle instance handle
+     * @param emitter_index Emitter index for which to generate vertex data for
+     * @param attribute_infos Attribute information on the streams to write
+     * @param color The particle color to (potentially) write
+     * @param vertex_buffer Vertex buffer into which to store the particle vertex data.
+     * @param vertex_start The first vertex of the range
+     * @param vertex_count The number of vertices in the range
+     * @param out_vertex_count The number of vertices written, from vertex_start
+     * @return Result enum value
+     */
+    DM_PARTICLE_PROTO(GenerateVertexDataResult, GenerateVertexDataRange, HParticleContext context, float dt, HInstance instance, uint32_t emitter_index, const dmGraphics::VertexAttributeInfos& attribute_infos, const dmVMath::Vector4& color, void* vertex_buffer, uint32_t vertex_start, uint32_t vertex_count, uint32_t* out_vertex_count);
+
     /**
      * Debug render the status of the instances within the specified context.
      * @param context Context of the instances to render.
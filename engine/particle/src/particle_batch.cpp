@@ -0,0 +1,242 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "particle_batch.h"
+#include <assert.h>
+#include <math.h>
+
+#include "particle/particle_ddf.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define DM_PARTICLE_BATCH_SSE2
+    #include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    // Division and square root are only available on AArch64 NEON
+    #define DM_PARTICLE_BATCH_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace dmParticle
+{
+#if defined(DM_PARTICLE_BATCH_SSE2)
+    typedef __m128 Vec4f;
+    typedef __m128 Mask4;
+    static inline Vec4f Load(const float* p)                { return _mm_load_ps(p); }
+    static inline void  Store(float* p, Vec4f v)            { _mm_store_ps(p, v); }
+    static inline Vec4f Splat(float f)                      { return _mm_set1_ps(f); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)               { return _mm_add_ps(a, b); }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)               { return _mm_sub_ps(a, b); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)               { return _mm_mul_ps(a, b); }
+    static inline Vec4f Div(Vec4f a, Vec4f b)               { return _mm_div_ps(a, b); }
+    static inline Vec4f Min(Vec4f a, Vec4f b)               { return _mm_min_ps(a, b); }
+    static inline Vec4f Sqrt(Vec4f a)                       { return _mm_sqrt_ps(a); }
+    static inline Mask4 CmpGe(Vec4f a, Vec4f b)             { return _mm_cmpge_ps(a, b); }
+    static inline Vec4f Select(Mask4 m, Vec4f a, Vec4f b)   { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+#elif defined(DM_PARTICLE_BATCH_NEON)
+    typedef float32x4_t Vec4f;
+    typedef uint32x4_t  Mask4;
+    static inline Vec4f Load(const float* p)                { return vld1q_f32(p); }
+    static inline void  Store(float* p, Vec4f v)            { vst1q_f32(p, v); }
+    static inline Vec4f Splat(float f)                      { return vdupq_n_f32(f); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)               { return vaddq_f32(a, b); }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)               { return vsubq_f32(a, b); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)               { return vmulq_f32(a, b); }
+    static inline Vec4f Div(Vec4f a, Vec4f b)               { return vdivq_f32(a, b); }
+    static inline Vec4f Min(Vec4f a, Vec4f b)               { return vminq_f32(a, b); }
+    static inline Vec4f Sqrt(Vec4f a)                       { return vsqrtq_f32(a); }
+    static inline Mask4 CmpGe(Vec4f a, Vec4f b)             { return vcgeq_f32(a, b); }
+    static inline Vec4f Select(Mask4 m, Vec4f a, Vec4f b)   { return vbslq_f32(m, a, b); }
+#else
+    struct Vec4f { float v[4]; };
+    struct Mask4 { bool v[4]; };
+    static inline Vec4f Load(const float* p)                { Vec4f r; for (int i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+    static inline void  Store(float* p, Vec4f v)            { for (int i = 0; i < 4; ++i) p[i] = v.v[i]; }
+    static inline Vec4f Splat(float f)                      { Vec4f r; for (int i = 0; i < 4; ++i) r.v[i] = f; return r; }
+    static inline Vec4f Add(Vec4f a, Vec4f b)               { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)               { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)               { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+    static inline Vec4f Div(Vec4f a, Vec4f b)               { for (int i = 0; i < 4; ++i) a.v[i] /= b.v[i]; return a; }
+    static inline Vec4f Min(Vec4f a, Vec4f b)               { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+    static inline Vec4f Sqrt(Vec4f a)                       { for (int i = 0; i < 4; ++i) a.v[i] = sqrtf(a.v[i]); return a; }
+    static inline Mask4 CmpGe(Vec4f a, Vec4f b)             { Mask4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] >= b.v[i]; return r; }
+    static inline Vec4f Select(Mask4 m, Vec4f a, Vec4f b)   { for (int i = 0; i < 4; ++i) a.v[i] = m.v[i] ? a.v[i] : b.v[i]; return a; }
+#endif
+
+    // a * b + c
+    static inline Vec4f MulAdd(Vec4f a, Vec4f b, Vec4f c)
+    {
+        return Add(Mul(a, b), c);
+    }
+
+    struct Vec3x4
+    {
+        Vec4f m_X;
+        Vec4f m_Y;
+        Vec4f m_Z;
+    };
+
+    static inline Vec3x4 Splat3(const float* v)
+    {
+        Vec3x4 r = { Splat(v[0]), Splat(v[1]), Splat(v[2]) };
+        return r;
+    }
+
+    static inline Vec4f Dot(const Vec3x4& a, const Vec3x4& b)
+    {
+        return MulAdd(a.m_X, b.m_X, MulAdd(a.m_Y, b.m_Y, Mul(a.m_Z, b.m_Z)));
+    }
+
+    // v += d * s
+    static inline void AddScaled(Vec3x4& v, const Vec3x4& d, Vec4f s)
+    {
+        v.m_X = MulAdd(d.m_X, s, v.m_X);
+        v.m_Y = MulAdd(d.m_Y, s, v.m_Y);
+        v.m_Z = MulAdd(d.m_Z, s, v.m_Z);
+    }
+
+    static inline Vec3x4 Select3(Mask4 m, const Vec3x4& a, const Vec3x4& b)
+    {
+        Vec3x4 r = { Select(m, a.m_X, b.m_X), Select(m, a.m_Y, b.m_Y), Select(m, a.m_Z, b.m_Z) };
+        return r;
+    }
+
+    // Same as normalize() in the vector math library
+    static inline Vec3x4 Normalize(const Vec3x4& v)
+    {
+        Vec4f len_inv = Div(Splat(1.0f), Sqrt(Dot(v, v)));
+        Vec3x4 r = { Mul(v.m_X, len_inv), Mul(v.m_Y, len_inv), Mul(v.m_Z, len_inv) };
+        return r;
+    }
+
+    static void PadBatch(ParticleBatch* batch, uint32_t count)
+    {
+        // Still particles with a valid direction, so that the unused lanes don't compute on garbage
+        for (uint32_t i = count; i < ((count + 3) & ~3U); ++i)
+        {
+            batch->m_PositionX[i] = batch->m_PositionY[i] = batch->m_PositionZ[i] = 0.0f;
+            batch->m_VelocityX[i] = batch->m_VelocityY[i] = batch->m_VelocityZ[i] = 0.0f;
+            batch->m_SpreadFactor[i] = 0.0f;
+            batch->m_DirectionX[i] = batch->m_DirectionZ[i] = 0.0f;
+            batch->m_DirectionY[i] = 1.0f;
+        }
+    }
+
+    // The modifiers below match the scalar versions they replaced, see the modifier documentation for their behavior
+
+    static inline void ApplyAcceleration(const BatchModifier& modifier, const Vec4f& spread_factor, Vec3x4& velocity)
+    {
+        Vec4f magnitude = MulAdd(Splat(modifier.m_MagnitudeSpread), spread_factor, Splat(modifier.m_Magnitude));
+        AddScaled(velocity, Splat3(modifier.m_Direction), magnitude);
+    }
+
+    static inline void ApplyDrag(const BatchModifier& modifier, const Vec4f& spread_factor, float dt, Vec3x4& velocity)
+    {
+        Vec3x4 v = velocity;
+        if (modifier.m_UseDirection)
+        {
+            Vec3x4 direction = Splat3(modifier.m_Direction);
+            Vec4f d = Dot(velocity, direction);
+            v.m_X = Mul(d, direction.m_X);
+            v.m_Y = Mul(d, direction.m_Y);
+            v.m_Z = Mul(d, direction.m_Z);
+        }
+        // Applied drag > 1 means the particle would travel in the reverse direction
+        Vec4f magnitude = MulAdd(Splat(modifier.m_MagnitudeSpread), spread_factor, Splat(modifier.m_Magnitude));
+        Vec4f applied_drag = Min(Mul(magnitude, Splat(dt)), Splat(1.0f));
+        AddScaled(velocity, v, Sub(Splat(0.0f), applied_drag));
+    }
+
+    static inline void ApplyRadial(const BatchModifier& modifier, const Vec4f& spread_factor, const Vec3x4& position, const Vec3x4& particle_direction, Vec3x4& velocity)
+    {
+        const Vec4f zero = Splat(0.0f);
+        Vec3x4 delta = { Sub(position.m_X, Splat(modifier.m_Position[0])), Sub(position.m_Y, Splat(modifier.m_Position[1])), Sub(position.m_Z, Splat(modifier.m_Position[2])) };
+        Vec4f delta_sq_len = Dot(delta, delta);
+        Vec4f applied_magnitude = MulAdd(Splat(modifier.m_MagnitudeSpread), spread_factor, Splat(modifier.m_Magnitude));
+        // 0 acc delta lies outside max dist
+        Vec4f a = Select(CmpGe(Sub(Splat(modifier.m_MaxSqDistance), delta_sq_len), zero), applied_magnitude, zero);
+        Vec3x4 dir = Normalize(Select3(CmpGe(zero, delta_sq_len), particle_direction, delta));
+        AddScaled(velocity, dir, Mul(a, Splat(modifier.m_AppliedFactor)));
+    }
+
+    static inline void ApplyVortex(const BatchModifier& modifier, const Vec4f& spread_factor, const Vec3x4& position, Vec3x4& velocity)
+    {
+        const Vec4f zero = Splat(0.0f);
+        Vec3x4 axis = Splat3(modifier.m_Direction);
+        // delta from vortex position
+        Vec3x4 delta = { Sub(position.m_X, Splat(modifier.m_Position[0])), Sub(position.m_Y, Splat(modifier.m_Position[1])), Sub(position.m_Z, Splat(modifier.m_Position[2])) };
+        // normal from vortex axis (non-unit)
+        Vec4f d = Dot(delta, axis);
+        Vec3x4 normal = { Sub(delta.m_X, Mul(d, axis.m_X)), Sub(delta.m_Y, Mul(d, axis.m_Y)), Sub(delta.m_Z, Mul(d, axis.m_Z)) };
+        // tangent is the direction of the vortex acceleration
+        Vec3x4 tangent = { Sub(Mul(axis.m_Y, normal.m_Z), Mul(axis.m_Z, normal.m_Y)),
+                           Sub(Mul(axis.m_Z, normal.m_X), Mul(axis.m_X, normal.m_Z)),
+                           Sub(Mul(axis.m_X, normal.m_Y), Mul(axis.m_Y, normal.m_X)) };
+        // In case the particle is directed along the axis, give it a guaranteed orthogonal start
+        tangent = Normalize(Select3(CmpGe(zero, Dot(tangent, tangent)), Splat3(modifier.m_StartDirection), tangent));
+        // use normal for max distance test
+        Vec4f normal_sq_len = Dot(normal, normal);
+        Vec4f magnitude = MulAdd(Splat(modifier.m_MagnitudeSpread), spread_factor, Splat(modifier.m_Magnitude));
+        Vec4f acceleration = Select(CmpGe(Sub(Splat(modifier.m_MaxSqDistance), normal_sq_len), zero), magnitude, zero);
+        AddScaled(velocity, tangent, Mul(acceleration, Splat(modifier.m_AppliedFactor)));
+    }
+
+    void SimulateParticleBatch(ParticleBatch* batch, uint32_t count, const BatchModifier* modifiers, uint32_t modifier_count, float dt)
+    {
+        assert(count <= PARTICLE_BATCH_SIZE);
+
+        PadBatch(batch, count);
+
+        const Vec4f dt4 = Splat(dt);
+        for (uint32_t i = 0; i < count; i += 4)
+        {
+            Vec3x4 position = { Load(&batch->m_PositionX[i]), Load(&batch->m_PositionY[i]), Load(&batch->m_PositionZ[i]) };
+            Vec3x4 velocity = { Load(&batch->m_VelocityX[i]), Load(&batch->m_VelocityY[i]), Load(&batch->m_VelocityZ[i]) };
+            Vec4f spread_factor = Load(&batch->m_SpreadFactor[i]);
+
+            for (uint32_t m = 0; m < modifier_count; ++m)
+            {
+                const BatchModifier& modifier = modifiers[m];
+                switch (modifier.m_Type)
+                {
+                case dmParticleDDF::MODIFIER_TYPE_ACCELERATION:
+                    ApplyAcceleration(modifier, spread_factor, velocity);
+                    break;
+                case dmParticleDDF::MODIFIER_TYPE_DRAG:
+                    ApplyDrag(modifier, spread_factor, dt, velocity);
+                    break;
+                case dmParticleDDF::MODIFIER_TYPE_RADIAL:
+                    {
+                        Vec3x4 particle_direction = { Load(&batch->m_DirectionX[i]), Load(&batch->m_DirectionY[i]), Load(&batch->m_DirectionZ[i]) };
+                        ApplyRadial(modifier, spread_factor, position, particle_direction, velocity);
+                    }
+                    break;
+                case dmParticleDDF::MODIFIER_TYPE_VORTEX:
+                    ApplyVortex(modifier, spread_factor, position, velocity);
+                    break;
+                }
+            }
+
+            // NOTE This velocity integration has a larger error than normal since we don't use the velocity at the
+            // beginning of the frame, but it's ok since particle movement does not need to be very exact
+            AddScaled(position, velocity, dt4);
+
+            Store(&batch->m_PositionX[i], position.m_X);
+            Store(&batch->m_PositionY[i], position.m_Y);
+            Store(&batch->m_PositionZ[i], position.m_Z);
+            Store(&batch->m_VelocityX[i], velocity.m_X);
+            Store(&batch->m_VelocityY[i], velocity.m_Y);
+            Store(&batch->m_VelocityZ[i], velocity.m_Z);
+        }
+    }
+}
@@ -0,0 +1,74 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_PARTICLE_BATCH_H
+#define DM_PARTICLE_BATCH_H
+
+#include <stdint.h>
+#include <dmsdk/dlib/align.h>
+
+namespace dmParticle
+{
+    // Number of particles gathered per batch. Must be a multiple of 4
+    const uint32_t PARTICLE_BATCH_SIZE = 64;
+
+    // The simulated state of particles in structure-of-arrays layout, so that they can be processed 4 at a time
+    struct ParticleBatch
+    {
+        float DM_ALIGNED(16) m_PositionX[PARTICLE_BATCH_SIZE];
+        float DM_ALIGNED(16) m_PositionY[PARTICLE_BATCH_SIZE];
+        float DM_ALIGNED(16) m_PositionZ[PARTICLE_BATCH_SIZE];
+        float DM_ALIGNED(16) m_VelocityX[PARTICLE_BATCH_SIZE];
+        float DM_ALIGNED(16) m_VelocityY[PARTICLE_BATCH_SIZE];
+        float DM_ALIGNED(16) m_VelocityZ[PARTICLE_BATCH_SIZE];
+        float DM_ALIGNED(16) m_SpreadFactor[PARTICLE_BATCH_SIZE];
+        /// The direction of the particles, only needed by the radial modifier when a particle is at the modifier position
+        float DM_ALIGNED(16) m_DirectionX[PARTICLE_BATCH_SIZE];
+        float DM_ALIGNED(16) m_DirectionY[PARTICLE_BATCH_SIZE];
+        float DM_ALIGNED(16) m_DirectionZ[PARTICLE_BATCH_SIZE];
+    };
+
+    /**
+     * A modifier, evaluated at the current emitter time and transformed into the space of the particles
+     */
+    struct BatchModifier
+    {
+        /// dmParticleDDF::ModifierType
+        uint32_t    m_Type;
+        /// Acceleration: the acceleration direction scaled by dt and the emitter scale
+        /// Drag: the drag direction
+        /// Vortex: the vortex axis
+        float       m_Direction[3];
+        /// Vortex: the direction of the acceleration for particles along the axis
+        float       m_StartDirection[3];
+        /// Radial and vortex: the position of the modifier
+        float       m_Position[3];
+        float       m_Magnitude;
+        float       m_MagnitudeSpread;
+        /// Radial and vortex: the squared (scaled) max distance
+        float       m_MaxSqDistance;
+        /// Radial and vortex: dt scaled by the emitter scale
+        float       m_AppliedFactor;
+        /// Drag: if only the velocity along m_Direction is affected
+        uint32_t    m_UseDirection;
+    };
+
+    /*
+     * Applies the modifiers in order to the count (<= PARTICLE_BATCH_SIZE) particles in the batch, and then steps
+     * the positions by the velocities. The batch is padded up to a multiple of 4 in place. Uses SSE2 or NEON where available.
+     */
+    void SimulateParticleBatch(ParticleBatch* batch, uint32_t count, const BatchModifier* modifiers, uint32_t modifier_count, float dt);
+}
+
+#endif // DM_PARTICLE_BATCH_H
@@ -20,6 +20,7 @@
 #include <dlib/transform.h>
 
 #include "particle/particle_ddf.h"
+#include "particle_batch.h"
 
 namespace dmParticle
 {
@@ -115,6 +116,10 @@ namespace dmParticle
         AnimationData           m_AnimationData;
         /// Particle buffer.
         dmArray<Particle>       m_Particles;
+        /// The modifiers evaluated for the current frame (see Simulate)
+        dmArray<BatchModifier>  m_BatchModifiers;
+        /// The sort keys and their scratch buffer (see SortParticles), 2x the number of particles
+        dmArray<uint32_t>       m_SortScratch;
         dmArray<RenderConstant> m_RenderConstants;
         dmVMath::Vector3        m_Velocity;
         dmVMath::Point3         m_LastPosition;
@@ -128,6 +133,13 @@ namespace dmParticle
         float                   m_Timer;
         /// The amount of particles to spawn. It is accumulated over frames to handle spawn rates below the timestep.
         float                   m_ParticlesToSpawn;
+        /// Bounds of the particles in emission space, from the last time they were simulated
+        dmVMath::Point3         m_ParticleAabbMin;
+        dmVMath::Point3         m_ParticleAabbMax;
+        /// The time the emitter wasn't simulated for while it was off-screen (see OffscreenMode)
+        float                   m_OffscreenTime;
+        /// Number of frames since the particles were last sorted, modulo the sort interval of the context
+        uint32_t                m_SortCounter;
         /// Seed used to ensure a deterministic simulation
         uint32_t                m_OriginalSeed;
         uint32_t                m_Seed;
@@ -148,6 +160,21 @@ namespace dmParticle
         uint16_t                m_Retiring : 1;
         /// If this emitter needs to be rehashed
         uint16_t                m_ReHash : 1;
+        /// Set by Update and cleared when vertices are generated for the emitter, i.e. it was off-screen since the last update if still set
+        uint16_t                m_Offscreen : 1;
+    };
+
+    /**
+     * An emitter whose particles are sorted and simulated on a job thread (see Update)
+     */
+    struct EmitterSimulateJob
+    {
+        Instance*               m_Instance;
+        Emitter*                m_Emitter;
+        EmitterPrototype*       m_Prototype;
+        dmParticleDDF::Emitter* m_DDF;
+        float                   m_Dt;
+        bool                    m_Sort;
     };
 
     struct Instance
@@ -188,7 +215,10 @@ namespace dmParticle
     struct Context
     {
         Context(uint32_t max_instance_count, uint32_t max_particle_count)
-        : m_AttributeDataPtrIndex(0)
+        : m_JobThread(0)
+        , m_AttributeDataPtrIndex(0)
+        , m_OffscreenMode(OFFSCREEN_MODE_SIMULATE)
+        , m_SortInterval(1)
         , m_MaxParticleCount(max_particle_count)
         , m_NextVersionNumber(1)
         , m_InstanceSeeding(0)
@@ -212,10 +242,18 @@ namespace dmParticle
         dmArray<Instance*>  m_Instances;
         /// Index pool used to index the instance buffer.
         dmIndexPool16       m_InstanceIndexPool;
+        /// Optional, used to simulate the emitters in parallel
+        dmJobThread::HContext   m_JobThread;
+        /// The emitters to simulate on the job threads during Update
+        dmArray<EmitterSimulateJob> m_SimulateJobs;
         /// An intermediate array of pointers to use for the custom attribute backing data (Editor only!)
         dmArray<void*>      m_AttributeDataPtrs;
         /// An increasing serial number to keep track of when aqcuiring a pointer for the attribute backing data (Editor only!)
         uint32_t            m_AttributeDataPtrIndex;
+        /// How the looping emitters are simulated while off-screen
+        OffscreenMode       m_OffscreenMode;
+        /// The particles are sorted every sort interval frames
+        uint32_t            m_SortInterval;
         /// Maximum number of particles allowed
         uint32_t            m_MaxParticleCount;
         /// Version number used to create new handles.
@@ -0,0 +1,151 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+#include <stdio.h>
+
+#include <dlib/benchmark.h>
+#include <dlib/log.h>
+#include <dlib/vmath.h>
+#include <dlib/testutil.h>
+
+#include <graphics/graphics_ddf.h>
+
+#include "../particle.h"
+
+using namespace dmVMath;
+
+// Matches the vertex format used by test_particle.cpp
+struct BenchVertex
+{
+    float m_X, m_Y, m_Z;
+    float m_Red, m_Green, m_Blue, m_Alpha;
+    float m_U, m_V;
+    float m_PageIndex;
+};
+
+static inline void FillAttribute(dmGraphics::VertexAttributeInfo& info, dmhash_t name_hash, dmGraphics::VertexAttribute::SemanticType semantic_type, dmGraphics::VertexAttribute::VectorType source_vector_type)
+{
+    info.m_NameHash        = name_hash;
+    info.m_SemanticType    = semantic_type;
+    info.m_CoordinateSpace = dmGraphics::COORDINATE_SPACE_WORLD;
+    info.m_DataType        = dmGraphics::VertexAttribute::TYPE_FLOAT;
+    info.m_VectorType      = source_vector_type;
+    info.m_ValuePtr        = 0;
+    info.m_ValueVectorType = source_vector_type;
+}
+
+static bool LoadPrototype(const char* filename, dmParticle::HPrototype* prototype)
+{
+    char path[128];
+    dmTestUtil::MakeHostPathf(path, sizeof(path), "build/src/test/%s", filename);
+
+    const uint32_t MAX_FILE_SIZE = 4 * 1024;
+    unsigned char buffer[MAX_FILE_SIZE];
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        dmLogWarning("Particle FX could not be loaded: %s.", path);
+        return false;
+    }
+    uint32_t file_size = fread(buffer, 1, MAX_FILE_SIZE, f);
+    fclose(f);
+    *prototype = dmParticle::NewPrototype(buffer, file_size);
+    return *prototype != 0x0;
+}
+
+class ParticleBench : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        m_Context = dmParticle::CreateContext(INSTANCE_COUNT, INSTANCE_COUNT * PARTICLES_PER_INSTANCE);
+        m_Prototype = 0x0;
+        ASSERT_TRUE(LoadPrototype("bench_emitter.particlefxc", &m_Prototype));
+
+        FillAttribute(m_AttributeInfos.m_Infos[0], dmHashString64("position"),   dmGraphics::VertexAttribute::SEMANTIC_TYPE_POSITION,   dmGraphics::VertexAttribute::VECTOR_TYPE_VEC3);
+        FillAttribute(m_AttributeInfos.m_Infos[1], dmHashString64("color"),      dmGraphics::VertexAttribute::SEMANTIC_TYPE_COLOR,      dmGraphics::VertexAttribute::VECTOR_TYPE_VEC4);
+        FillAttribute(m_AttributeInfos.m_Infos[2], dmHashString64("texcoord0"),  dmGraphics::VertexAttribute::SEMANTIC_TYPE_TEXCOORD,   dmGraphics::VertexAttribute::VECTOR_TYPE_VEC2);
+        FillAttribute(m_AttributeInfos.m_Infos[3], dmHashString64("page_index"), dmGraphics::VertexAttribute::SEMANTIC_TYPE_PAGE_INDEX, dmGraphics::VertexAttribute::VECTOR_TYPE_SCALAR);
+        m_AttributeInfos.m_NumInfos     = 4;
+        m_AttributeInfos.m_VertexStride = sizeof(BenchVertex);
+
+        m_VertexBufferSize = dmParticle::GetVertexBufferSize(INSTANCE_COUNT * PARTICLES_PER_INSTANCE, sizeof(BenchVertex));
+        m_VertexBuffer = new uint8_t[m_VertexBufferSize];
+
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+        {
+            m_Instances[i] = dmParticle::CreateInstance(m_Context, m_Prototype, 0);
+            dmParticle::SetPosition(m_Context, m_Instances[i], Point3((float)i * 50.0f, 0.0f, 0.0f));
+            dmParticle::StartInstance(m_Context, m_Instances[i]);
+        }
+
+        // Run until the emitters have reached their steady state particle count
+        for (uint32_t i = 0; i < 90; ++i)
+            dmParticle::Update(m_Context, DT, 0x0);
+    }
+
+    virtual void TearDown()
+    {
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+            dmParticle::DestroyInstance(m_Context, m_Instances[i]);
+        dmParticle::Particle_DeletePrototype(m_Prototype);
+        dmParticle::DestroyContext(m_Context);
+        delete [] m_VertexBuffer;
+    }
+
+    static const uint32_t INSTANCE_COUNT = 32;
+    static const uint32_t PARTICLES_PER_INSTANCE = 2048;
+    static const float DT;
+
+    dmParticle::HParticleContext m_Context;
+    dmParticle::HPrototype m_Prototype;
+    dmParticle::HInstance m_Instances[INSTANCE_COUNT];
+    dmGraphics::VertexAttributeInfos m_AttributeInfos;
+    uint8_t* m_VertexBuffer;
+    uint32_t m_VertexBufferSize;
+};
+
+const float ParticleBench::DT = 1.0f / 60.0f;
+
+TEST_F(ParticleBench, Simulate)
+{
+    for (dmBenchmark::Run run("particle.simulate", 100, INSTANCE_COUNT * PARTICLES_PER_INSTANCE); run.Next(); )
+    {
+        dmParticle::Update(m_Context, DT, 0x0);
+    }
+}
+
+TEST_F(ParticleBench, GenerateVertexData)
+{
+    for (dmBenchmark::Run run("particle.generate_vertex_data", 100, INSTANCE_COUNT * PARTICLES_PER_INSTANCE); run.Next(); )
+    {
+        uint32_t vertex_buffer_size = 0;
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+        {
+            dmParticle::GenerateVertexData(m_Context, DT, m_Instances[i], 0, m_AttributeInfos, Vector4(1,1,1,1),
+                                           (void*)m_VertexBuffer, m_VertexBufferSize, &vertex_buffer_size);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    int ret = jc_test_run_all();
+    if (ret == 0)
+        ret = dmBenchmark::Report(argc, argv, "particle");
+    return ret;
+}
@@ -18,6 +18,7 @@
 #include <algorithm>
 
 #include <dlib/dstrings.h>
+#include <dlib/job_thread.h>
 #include <dlib/log.h>
 #include <dlib/math.h>
 #include <dlib/vmath.h>
@@ -644,6 +645,137 @@ TEST_F(ParticleTest, Loop)
     dmParticle::DestroyInstance(m_Context, instance);
 }
 
+// Marks the emitter as visible, like when it is rendered
+static void RenderEmitter(dmParticle::HParticleContext context, dmParticle::HInstance instance, const dmGraphics::VertexAttributeInfos& attribute_infos, float dt)
+{
+    TestVertex vertex_buffer[6];
+    uint32_t vertex_buffer_size = 0;
+    dmParticle::GenerateVertexData(context, dt, instance, 0, attribute_infos, Vector4(1,1,1,1), (void*) vertex_buffer, sizeof(vertex_buffer), &vertex_buffer_size);
+}
+
+/**
+ * Verify looping emitters that aren't rendered are paused
+ */
+TEST_F(ParticleTest, OffscreenPause)
+{
+    float dt = 0.1f;
+
+    ASSERT_TRUE(LoadPrototype("loop.particlefxc", &m_Prototype));
+    dmParticle::SetContextOffscreenMode(m_Context, dmParticle::OFFSCREEN_MODE_PAUSE);
+    dmParticle::HInstance instance = dmParticle::CreateInstance(m_Context, m_Prototype, 0x0);
+    dmParticle::Emitter* e = GetEmitter(m_Context, instance, 0);
+    dmParticle::StartInstance(m_Context, instance);
+
+    // Emitters are visible until they have been off-screen for a frame
+    dmParticle::Update(m_Context, dt, 0x0);
+    float timer = e->m_Timer;
+    ASSERT_LT(0.0f, timer);
+
+    dmParticle::Update(m_Context, dt, 0x0);
+    dmParticle::Update(m_Context, dt, 0x0);
+    ASSERT_NEAR(timer, e->m_Timer, EPSILON);
+
+    RenderEmitter(m_Context, instance, m_AttributeInfos, dt);
+    dmParticle::Update(m_Context, dt, 0x0);
+    ASSERT_NEAR(timer + dt, e->m_Timer, EPSILON);
+
+    dmParticle::DestroyInstance(m_Context, instance);
+}
+
+/**
+ * Verify looping emitters are fast forwarded by the time they weren't rendered
+ */
+TEST_F(ParticleTest, OffscreenFastForward)
+{
+    float dt = 0.1f;
+
+    ASSERT_TRUE(LoadPrototype("loop.particlefxc", &m_Prototype));
+    dmParticle::SetContextOffscreenMode(m_Context, dmParticle::OFFSCREEN_MODE_FAST_FORWARD);
+    dmParticle::HInstance instance = dmParticle::CreateInstance(m_Context, m_Prototype, 0x0);
+    dmParticle::Emitter* e = GetEmitter(m_Context, instance, 0);
+    dmParticle::StartInstance(m_Context, instance);
+
+    dmParticle::Update(m_Context, dt, 0x0);
+    float timer = e->m_Timer;
+
+    dmParticle::Update(m_Context, dt, 0x0);
+    dmParticle::Update(m_Context, dt, 0x0);
+    ASSERT_NEAR(timer, e->m_Timer, EPSILON);
+
+    // The fast forward steps at 60 fps
+    RenderEmitter(m_Context, instance, m_AttributeInfos, dt);
+    dmParticle::Update(m_Context, dt, 0x0);
+    ASSERT_NEAR(timer + 3 * dt, e->m_Timer, 2.0f / 60.0f);
+
+    dmParticle::DestroyInstance(m_Context, instance);
+}
+
+/**
+ * Verify looping emitters that aren't rendered are simulated at a reduced rate
+ */
+TEST_F(ParticleTest, OffscreenReducedRate)
+{
+    float dt = 0.1f;
+
+    ASSERT_TRUE(LoadPrototype("loop.particlefxc", &m_Prototype));
+    dmParticle::SetContextOffscreenMode(m_Context, dmParticle::OFFSCREEN_MODE_REDUCED_RATE);
+    dmParticle::HInstance instance = dmParticle::CreateInstance(m_Context, m_Prototype, 0x0);
+    dmParticle::Emitter* e = GetEmitter(m_Context, instance, 0);
+    dmParticle::StartInstance(m_Context, instance);
+
+    dmParticle::Update(m_Context, dt, 0x0);
+    float timer = e->m_Timer;
+
+    // Updated once the time since the last update reaches OFFSCREEN_UPDATE_INTERVAL
+    uint32_t frames = 0;
+    while ((frames + 1) * dt < dmParticle::OFFSCREEN_UPDATE_INTERVAL)
+    {
+        dmParticle::Update(m_Context, dt, 0x0);
+        ASSERT_NEAR(timer, e->m_Timer, EPSILON);
+        ++frames;
+    }
+    dmParticle::Update(m_Context, dt, 0x0);
+    ++frames;
+    ASSERT_NEAR(timer + frames * dt, e->m_Timer, EPSILON);
+
+    dmParticle::DestroyInstance(m_Context, instance);
+}
+
+/**
+ * Verify the bounds of the emitter contain its particles
+ */
+TEST_F(ParticleTest, EmitterBounds)
+{
+    float dt = 0.5f;
+
+    ASSERT_TRUE(LoadPrototype("mod_acc_batch.particlefxc", &m_Prototype));
+    dmParticle::HInstance instance = dmParticle::CreateInstance(m_Context, m_Prototype, 0x0);
+    dmParticle::SetPosition(m_Context, instance, Point3(10.0f, 20.0f, 0.0f));
+    dmParticle::Emitter* e = GetEmitter(m_Context, instance, 0);
+    dmParticle::StartInstance(m_Context, instance);
+
+    dmParticle::Update(m_Context, dt, 0x0);
+    dmParticle::Update(m_Context, dt, 0x0);
+
+    dmParticle::EmitterRenderData* render_data;
+    dmParticle::GetEmitterRenderData(m_Context, instance, 0, &render_data);
+
+    uint32_t particle_count = ParticleCount(e);
+    ASSERT_LT(0u, particle_count);
+    for (uint32_t i = 0; i < particle_count; ++i)
+    {
+        Point3 position = e->m_Particles[i].GetPosition();
+        ASSERT_LE(render_data->m_AabbMin.getX(), position.getX());
+        ASSERT_LE(render_data->m_AabbMin.getY(), position.getY());
+        ASSERT_LE(render_data->m_AabbMin.getZ(), position.getZ());
+        ASSERT_GE(render_data->m_AabbMax.getX(), position.getX());
+        ASSERT_GE(render_data->m_AabbMax.getY(), position.getY());
+        ASSERT_GE(render_data->m_AabbMax.getZ(), position.getZ());
+    }
+
+    dmParticle::DestroyInstance(m_Context, instance);
+}
+
 /**
  * Verify loop emitters respect delay
  */
@@ -1571,6 +1703,48 @@ TEST_F(ParticleTest, StableSort)
     dmParticle::DestroyInstance(m_Context, instance);
 }
 
+TEST_F(ParticleTest, SortInterval)
+{
+    float dt = 1.0f / 60.0f;
+
+    ASSERT_TRUE(LoadPrototype("sort.particlefxc", &m_Prototype));
+    dmParticle::SetContextSortInterval(m_Context, 2);
+    dmParticle::HInstance instance = dmParticle::CreateInstance(m_Context, m_Prototype, 0x0);
+    dmParticle::Emitter* e = GetEmitter(m_Context, instance, 0);
+
+    dmParticle::StartInstance(m_Context, instance);
+    dmParticle::Update(m_Context, dt, 0x0);
+
+    const uint32_t particle_count = 20;
+    ASSERT_EQ(particle_count, ParticleCount(e));
+
+    // Make the first particle the oldest one, which is sorted last
+    dmParticle::Particle* p = e->m_Particles.Begin();
+    p[0].SetTimeLeft(p[0].GetTimeLeft() - 10 * dt);
+    Point3 pos = p[0].GetPosition();
+    pos.setX(1000.0f);
+    p[0].SetPosition(pos);
+
+    // Not sorted this frame
+    RenderEmitter(m_Context, instance, m_AttributeInfos, dt);
+    dmParticle::Update(m_Context, dt, 0x0);
+    ASSERT_EQ(1000.0f, p[0].GetPosition().getX());
+
+    RenderEmitter(m_Context, instance, m_AttributeInfos, dt);
+    dmParticle::Update(m_Context, dt, 0x0);
+    ASSERT_EQ(1000.0f, p[particle_count - 1].GetPosition().getX());
+
+    // Off-screen emitters aren't sorted
+    p[0].SetTimeLeft(p[0].GetTimeLeft() - 20 * dt);
+    pos.setX(2000.0f);
+    p[0].SetPosition(pos);
+    dmParticle::Update(m_Context, dt, 0x0);
+    dmParticle::Update(m_Context, dt, 0x0);
+    ASSERT_EQ(2000.0f, p[0].GetPosition().getX());
+
+    dmParticle::DestroyInstance(m_Context, instance);
+}
+
 TEST_F(ParticleTest, ReloadPrototype)
 {
     ASSERT_TRUE(LoadPrototype("reload1.particlefxc", &m_Prototype));
@@ -1742,6 +1916,102 @@ TEST_F(ParticleTest, AccelerationWorld)
     dmParticle::DestroyInstance(m_Context, instance);
 }
 
+// The particles are simulated in batches, make sure all of them (including a partial batch) are affected by the modifiers
+TEST_F(ParticleTest, AccelerationBatches)
+{
+    float dt = 1.0f;
+
+    ASSERT_TRUE(LoadPrototype("mod_acc_batch.particlefxc", &m_Prototype));
+    dmParticle::HInstance instance = dmParticle::CreateInstance(m_Context, m_Prototype, 0x0);
+    dmParticle::Emitter* e = GetEmitter(m_Context, instance, 0);
+
+    dmParticle::StartInstance(m_Context, instance);
+    dmParticle::Update(m_Context, dt, 0x0);
+
+    uint32_t particle_count = ParticleCount(e);
+    ASSERT_LT(dmParticle::PARTICLE_BATCH_SIZE, particle_count);
+    ASSERT_NE(0u, particle_count % dmParticle::PARTICLE_BATCH_SIZE);
+    for (uint32_t i = 0; i < particle_count; ++i)
+    {
+        dmParticle::Particle* particle = &e->m_Particles[i];
+        ASSERT_NEAR(0.0f, particle->GetVelocity().getX(), EPSILON);
+        ASSERT_NEAR(1.0f, particle->GetVelocity().getY(), EPSILON);
+        ASSERT_NEAR(0.0f, particle->GetVelocity().getZ(), EPSILON);
+    }
+
+    dmParticle::DestroyInstance(m_Context, instance);
+}
+
+// The emitters simulated and the vertices generated on the job threads should match the serial update
+TEST_F(ParticleTest, ParallelUpdate)
+{
+    const uint32_t instance_count = 8;
+    float dt = 1.0f / 60.0f;
+
+    ASSERT_TRUE(LoadPrototype("mod_acc_batch.particlefxc", &m_Prototype));
+
+    dmJobThread::JobThreadCreationParams job_thread_params;
+    job_thread_params.m_ThreadNames[0] = "Particle1";
+    job_thread_params.m_ThreadNames[1] = "Particle2";
+    job_thread_params.m_ThreadCount = 2;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_params);
+
+    dmParticle::HParticleContext parallel_context = dmParticle::CreateContext(64, 1024);
+    dmParticle::SetContextJobThread(parallel_context, job_thread);
+
+    dmParticle::HInstance instances[instance_count];
+    dmParticle::HInstance parallel_instances[instance_count];
+    for (uint32_t i = 0; i < instance_count; ++i)
+    {
+        instances[i] = dmParticle::CreateInstance(m_Context, m_Prototype, 0x0);
+        parallel_instances[i] = dmParticle::CreateInstance(parallel_context, m_Prototype, 0x0);
+        dmParticle::StartInstance(m_Context, instances[i]);
+        dmParticle::StartInstance(parallel_context, parallel_instances[i]);
+    }
+
+    const uint32_t max_vertex_count = 1024 * 6;
+    TestVertex* vertices = new TestVertex[max_vertex_count];
+    TestVertex* parallel_vertices = new TestVertex[max_vertex_count];
+
+    for (uint32_t frame = 0; frame < 30; ++frame)
+    {
+        dmParticle::Update(m_Context, dt, 0x0);
+        dmParticle::Update(parallel_context, dt, 0x0);
+
+        memset(vertices, 0, max_vertex_count * sizeof(TestVertex));
+        memset(parallel_vertices, 0, max_vertex_count * sizeof(TestVertex));
+
+        uint32_t vertex_buffer_size = 0;
+        uint32_t vertex_start = 0;
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            ASSERT_EQ(ParticleCount(GetEmitter(m_Context, instances[i], 0)), ParticleCount(GetEmitter(parallel_context, parallel_instances[i], 0)));
+
+            dmParticle::GenerateVertexData(m_Context, dt, instances[i], 0, m_AttributeInfos, Vector4(1,1,1,1), (void*) vertices, max_vertex_count * sizeof(TestVertex), &vertex_buffer_size);
+
+            uint32_t vertex_count = dmParticle::GetEmitterVertexCount(parallel_context, parallel_instances[i], 0);
+            uint32_t vertices_written = 0;
+            ASSERT_EQ(dmParticle::GENERATE_VERTEX_DATA_OK, dmParticle::GenerateVertexDataRange(parallel_context, dt, parallel_instances[i], 0, m_AttributeInfos, Vector4(1,1,1,1), (void*) parallel_vertices, vertex_start, vertex_count, &vertices_written));
+            ASSERT_EQ(vertex_count, vertices_written);
+            vertex_start += vertices_written;
+        }
+
+        ASSERT_EQ(vertex_buffer_size, vertex_start * sizeof(TestVertex));
+        ASSERT_EQ(0, memcmp(vertices, parallel_vertices, vertex_buffer_size));
+    }
+
+    delete [] vertices;
+    delete [] parallel_vertices;
+
+    for (uint32_t i = 0; i < instance_count; ++i)
+    {
+        dmParticle::DestroyInstance(m_Context, instances[i]);
+        dmParticle::DestroyInstance(parallel_context, parallel_instances[i]);
+    }
+    dmParticle::DestroyContext(parallel_context);
+    dmJobThread::Destroy(job_thread);
+}
+
 // DEF-3355 Parent scale should only affect simulation in EMISSION_SPACE_WORLD
 TEST_F(ParticleTest, AccelerationScaledEmitter)
 {
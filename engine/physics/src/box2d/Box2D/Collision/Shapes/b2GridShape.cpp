@@ -397,6 +397,13 @@ void b2GridShape::SetCellHull(b2Body* body, uint32 row, uint32 column, uint32 hu
     assert(m_type == b2Shape::e_grid);
 
     uint32 index = row * m_columnCount + column;
+    SetCell(index, hull, flags);
+
+    body->SynchronizeSingle(this, index);
+}
+
+void b2GridShape::SetCell(uint32 index, uint32 hull, b2GridShape::CellFlags flags)
+{
     b2Assert(index < m_rowCount * m_columnCount);
     b2GridShape::Cell* cell = &m_cells[index];
     cell->m_Index = hull;
@@ -408,6 +415,4 @@ void b2GridShape::SetCellHull(b2Body* body, uint32 row, uint32 column, uint32 hu
         if (h.m_Count == 0)
             cell->m_Index = B2GRIDSHAPE_EMPTY_CELL;
     }
-
-    body->SynchronizeSingle(this, index);
 }
@@ -102,6 +102,9 @@ public:
 
     void SetCellHull(b2Body* body, uint32 row, uint32 column, uint32 hull, CellFlags flags);
 
+    /// Set the hull of a cell without synchronizing its proxy, see b2Body::SynchronizeChildren
+    void SetCell(uint32 index, uint32 hull, CellFlags flags);
+
     void ClearCellData();
 
     uint32 CalculateCellMask(b2Fixture* fixture, uint32 row, uint32 column);
@@ -63,6 +63,20 @@ public:
 	/// Get the fat AABB for a proxy.
 	const b2AABB& GetFatAABB(int32 proxyId) const;
 
+	/// Defold modification
+	/// Set the fat AABB for a proxy, without buffering a move. Used when restoring a saved world state.
+	void SetFatAABB(int32 proxyId, const b2AABB& aabb);
+
+	/// Defold modification
+	/// Get the proxies that have moved since the last call to UpdatePairs. Destroyed proxies are
+	/// e_nullProxy.
+	int32 GetMoveCount() const;
+	const int32* GetMoveBuffer() const;
+
+	/// Defold modification
+	/// Forget the moved proxies, so that no pairs are reported for them by UpdatePairs.
+	void ClearMoveBuffer();
+
 	/// Get user data from a proxy. Returns NULL if the id is invalid.
 	void* GetUserData(int32 proxyId) const;
 
@@ -157,6 +171,27 @@ inline const b2AABB& b2BroadPhase::GetFatAABB(int32 proxyId) const
 	return m_tree.GetFatAABB(proxyId);
 }
 
+// Defold modification
+inline void b2BroadPhase::SetFatAABB(int32 proxyId, const b2AABB& aabb)
+{
+	m_tree.SetFatAABB(proxyId, aabb);
+}
+
+inline int32 b2BroadPhase::GetMoveCount() const
+{
+	return m_moveCount;
+}
+
+inline const int32* b2BroadPhase::GetMoveBuffer() const
+{
+	return m_moveBuffer;
+}
+
+inline void b2BroadPhase::ClearMoveBuffer()
+{
+	m_moveCount = 0;
+}
+
 inline int32 b2BroadPhase::GetProxyCount() const
 {
 	return m_proxyCount;
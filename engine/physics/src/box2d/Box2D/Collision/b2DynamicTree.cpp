@@ -176,6 +176,24 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 	return true;
 }
 
+// Defold modification
+void b2DynamicTree::SetFatAABB(int32 proxyId, const b2AABB& aabb)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+
+	b2Assert(m_nodes[proxyId].IsLeaf());
+
+	const b2AABB& current = m_nodes[proxyId].aabb;
+	if (current.lowerBound == aabb.lowerBound && current.upperBound == aabb.upperBound)
+	{
+		return;
+	}
+
+	RemoveLeaf(proxyId);
+	m_nodes[proxyId].aabb = aabb;
+	InsertLeaf(proxyId);
+}
+
 void b2DynamicTree::InsertLeaf(int32 leaf)
 {
 	++m_insertionCount;
@@ -86,6 +86,11 @@ public:
 	/// Get the fat AABB for a proxy.
 	const b2AABB& GetFatAABB(int32 proxyId) const;
 
+	/// Defold modification
+	/// Set the fat AABB of a proxy, re-inserting it into the tree if it changed.
+	/// Used when restoring a saved world state.
+	void SetFatAABB(int32 proxyId, const b2AABB& aabb);
+
 	/// Query an AABB for overlapping proxies. The callback class
 	/// is called for each proxy that overlaps the supplied AABB.
     template <typename T>
@@ -158,13 +158,23 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 // Note: do not assume the fixture AABBs are overlapping or are valid.
 void b2Contact::Update(b2ContactListener* listener)
 {
-	b2Manifold oldManifold = m_manifold;
+	b2Manifold oldManifold;
+	bool wasTouching;
+	UpdateManifold(&oldManifold, &wasTouching);
+	FinishUpdate(listener, &oldManifold, wasTouching);
+}
+
+void b2Contact::UpdateManifold(b2Manifold* oldManifoldOut, bool* wasTouchingOut)
+{
+	b2Manifold& oldManifold = *oldManifoldOut;
+	oldManifold = m_manifold;
 
 	// Re-enable this contact.
 	m_flags |= e_enabledFlag;
 
 	bool touching = false;
 	bool wasTouching = (m_flags & e_touchingFlag) == e_touchingFlag;
+	*wasTouchingOut = wasTouching;
 
 	bool sensorA = m_fixtureA->IsSensor();
 	bool sensorB = m_fixtureB->IsSensor();
@@ -220,12 +230,6 @@ void b2Contact::Update(b2ContactListener* listener)
 				}
 			}
 		}
-
-		if (touching != wasTouching)
-		{
-			bodyA->SetAwake(true);
-			bodyB->SetAwake(true);
-		}
 	}
 
 	if (touching)
@@ -236,6 +240,18 @@ void b2Contact::Update(b2ContactListener* listener)
 	{
 		m_flags &= ~e_touchingFlag;
 	}
+}
+
+void b2Contact::FinishUpdate(b2ContactListener* listener, const b2Manifold* oldManifold, bool wasTouching)
+{
+	bool touching = (m_flags & e_touchingFlag) == e_touchingFlag;
+	bool sensor = m_fixtureA->IsSensor() || m_fixtureB->IsSensor();
+
+	if (sensor == false && touching != wasTouching)
+	{
+		m_fixtureA->GetBody()->SetAwake(true);
+		m_fixtureB->GetBody()->SetAwake(true);
+	}
 
 	if (wasTouching == false && touching == true && listener)
 	{
@@ -249,6 +265,6 @@ void b2Contact::Update(b2ContactListener* listener)
 
 	if (sensor == false && touching && listener)
 	{
-		listener->PreSolve(this, &oldManifold);
+		listener->PreSolve(this, oldManifold);
 	}
 }
@@ -144,6 +144,7 @@ protected:
 	friend class b2ContactSolver;
 	friend class b2Body;
 	friend class b2Fixture;
+	friend class b2Island;
 
 	// Flags stored in m_flags
 	enum
@@ -183,6 +184,12 @@ protected:
 
 	void Update(b2ContactListener* listener);
 
+	// Defold modification
+	// Update split in two for the parallel narrow phase. UpdateManifold only writes to the
+	// contact itself, FinishUpdate wakes the bodies and calls the listener.
+	void UpdateManifold(b2Manifold* oldManifold, bool* wasTouching);
+	void FinishUpdate(b2ContactListener* listener, const b2Manifold* oldManifold, bool wasTouching);
+
 	static b2ContactRegister s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
 	static bool s_initialized;
 
@@ -202,6 +209,12 @@ protected:
 	int32 m_indexA;
 	int32 m_indexB;
 
+	// Defold modification
+	// The indices of the bodies in the island solving the contact. These are stored with the
+	// contact since a static body can be part of several islands solved in parallel.
+	int32 m_islandIndexA;
+	int32 m_islandIndexB;
+
 	b2Manifold m_manifold;
 
 	int32 m_toiCount;
@@ -80,8 +80,9 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
 		vc->friction = contact->m_friction;
 		vc->restitution = contact->m_restitution;
-		vc->indexA = bodyA->m_islandIndex;
-		vc->indexB = bodyB->m_islandIndex;
+		// Defold modification: The island indices are stored with the contact, see b2Island::StoreContactIndices
+		vc->indexA = contact->m_islandIndexA;
+		vc->indexB = contact->m_islandIndexB;
 		vc->invMassA = bodyA->m_invMass;
 		vc->invMassB = bodyB->m_invMass;
 		vc->invIA = bodyA->m_invI;
@@ -92,8 +93,8 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 		vc->normalMass.SetZero();
 
 		b2ContactPositionConstraint* pc = m_positionConstraints + i;
-		pc->indexA = bodyA->m_islandIndex;
-		pc->indexB = bodyB->m_islandIndex;
+		pc->indexA = contact->m_islandIndexA;
+		pc->indexB = contact->m_islandIndexB;
 		pc->invMassA = bodyA->m_invMass;
 		pc->invMassB = bodyB->m_invMass;
 		pc->localCenterA = bodyA->m_sweep.localCenter;
@@ -258,3 +258,26 @@ void b2DistanceJoint::Dump()
 	b2Log("  jd.dampingRatio = %.15lef;\n", m_dampingRatio);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+// Defold modification
+struct b2DistanceJointState
+{
+	float32 impulse;
+};
+
+int32 b2DistanceJoint::GetStateSize() const
+{
+	return sizeof(b2DistanceJointState);
+}
+
+void b2DistanceJoint::SaveState(void* state) const
+{
+	b2DistanceJointState* s = (b2DistanceJointState*)state;
+	s->impulse = m_impulse;
+}
+
+void b2DistanceJoint::RestoreState(const void* state)
+{
+	const b2DistanceJointState* s = (const b2DistanceJointState*)state;
+	m_impulse = s->impulse;
+}
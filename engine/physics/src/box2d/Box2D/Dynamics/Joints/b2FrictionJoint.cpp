@@ -249,3 +249,29 @@ void b2FrictionJoint::Dump()
 	b2Log("  jd.maxTorque = %.15lef;\n", m_maxTorque);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+// Defold modification
+struct b2FrictionJointState
+{
+	b2Vec2 linearImpulse;
+	float32 angularImpulse;
+};
+
+int32 b2FrictionJoint::GetStateSize() const
+{
+	return sizeof(b2FrictionJointState);
+}
+
+void b2FrictionJoint::SaveState(void* state) const
+{
+	b2FrictionJointState* s = (b2FrictionJointState*)state;
+	s->linearImpulse = m_linearImpulse;
+	s->angularImpulse = m_angularImpulse;
+}
+
+void b2FrictionJoint::RestoreState(const void* state)
+{
+	const b2FrictionJointState* s = (const b2FrictionJointState*)state;
+	m_linearImpulse = s->linearImpulse;
+	m_angularImpulse = s->angularImpulse;
+}
@@ -421,3 +421,26 @@ void b2GearJoint::Dump()
 	b2Log("  jd.ratio = %.15lef;\n", m_ratio);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+// Defold modification
+struct b2GearJointState
+{
+	float32 impulse;
+};
+
+int32 b2GearJoint::GetStateSize() const
+{
+	return sizeof(b2GearJointState);
+}
+
+void b2GearJoint::SaveState(void* state) const
+{
+	b2GearJointState* s = (b2GearJointState*)state;
+	s->impulse = m_impulse;
+}
+
+void b2GearJoint::RestoreState(const void* state)
+{
+	const b2GearJointState* s = (const b2GearJointState*)state;
+	m_impulse = s->impulse;
+}
@@ -145,6 +145,19 @@ public:
 	/// Dump this joint to the log file.
 	virtual void Dump() { b2Log("// Dump is not supported for this joint type.\n"); }
 
+	/// Defold modification
+	/// Get the size in bytes of the solver state saved by SaveState.
+	virtual int32 GetStateSize() const { return 0; }
+
+	/// Defold modification
+	/// Save the solver state that carries over between time steps (the warm starting impulses),
+	/// so that it can be restored with RestoreState. The state must hold GetStateSize() bytes.
+	virtual void SaveState(void* state) const { B2_NOT_USED(state); }
+
+	/// Defold modification
+	/// Restore the solver state saved by SaveState.
+	virtual void RestoreState(const void* state) { B2_NOT_USED(state); }
+
 protected:
 	friend class b2World;
 	friend class b2Body;
@@ -215,3 +215,26 @@ float32 b2MouseJoint::GetReactionTorque(float32 inv_dt) const
 {
 	return inv_dt * 0.0f;
 }
+
+// Defold modification
+struct b2MouseJointState
+{
+	b2Vec2 impulse;
+};
+
+int32 b2MouseJoint::GetStateSize() const
+{
+	return sizeof(b2MouseJointState);
+}
+
+void b2MouseJoint::SaveState(void* state) const
+{
+	b2MouseJointState* s = (b2MouseJointState*)state;
+	s->impulse = m_impulse;
+}
+
+void b2MouseJoint::RestoreState(const void* state)
+{
+	const b2MouseJointState* s = (const b2MouseJointState*)state;
+	m_impulse = s->impulse;
+}
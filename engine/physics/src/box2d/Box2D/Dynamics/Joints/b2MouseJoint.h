@@ -92,6 +92,11 @@ public:
 	/// The mouse joint does not support dumping.
 	void Dump() { b2Log("Mouse joint dumping is not supported.\n"); }
 
+	/// Defold modification
+	int32 GetStateSize() const;
+	void SaveState(void* state) const;
+	void RestoreState(const void* state);
+
 protected:
 	friend class b2Joint;
 
@@ -635,3 +635,32 @@ void b2PrismaticJoint::Dump()
 	b2Log("  jd.maxMotorForce = %.15lef;\n", m_maxMotorForce);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+// Defold modification
+struct b2PrismaticJointState
+{
+	b2Vec3 impulse;
+	float32 motorImpulse;
+	int32 limitState;
+};
+
+int32 b2PrismaticJoint::GetStateSize() const
+{
+	return sizeof(b2PrismaticJointState);
+}
+
+void b2PrismaticJoint::SaveState(void* state) const
+{
+	b2PrismaticJointState* s = (b2PrismaticJointState*)state;
+	s->impulse = m_impulse;
+	s->motorImpulse = m_motorImpulse;
+	s->limitState = m_limitState;
+}
+
+void b2PrismaticJoint::RestoreState(const void* state)
+{
+	const b2PrismaticJointState* s = (const b2PrismaticJointState*)state;
+	m_impulse = s->impulse;
+	m_motorImpulse = s->motorImpulse;
+	m_limitState = (b2LimitState)s->limitState;
+}
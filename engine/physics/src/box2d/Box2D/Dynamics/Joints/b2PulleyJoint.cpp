@@ -330,3 +330,26 @@ void b2PulleyJoint::Dump()
 	b2Log("  jd.ratio = %.15lef;\n", m_ratio);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+// Defold modification
+struct b2PulleyJointState
+{
+	float32 impulse;
+};
+
+int32 b2PulleyJoint::GetStateSize() const
+{
+	return sizeof(b2PulleyJointState);
+}
+
+void b2PulleyJoint::SaveState(void* state) const
+{
+	b2PulleyJointState* s = (b2PulleyJointState*)state;
+	s->impulse = m_impulse;
+}
+
+void b2PulleyJoint::RestoreState(const void* state)
+{
+	const b2PulleyJointState* s = (const b2PulleyJointState*)state;
+	m_impulse = s->impulse;
+}
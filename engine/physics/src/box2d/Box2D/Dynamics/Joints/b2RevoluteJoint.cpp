@@ -502,3 +502,32 @@ void b2RevoluteJoint::Dump()
 	b2Log("  jd.maxMotorTorque = %.15lef;\n", m_maxMotorTorque);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+// Defold modification
+struct b2RevoluteJointState
+{
+	b2Vec3 impulse;
+	float32 motorImpulse;
+	int32 limitState;
+};
+
+int32 b2RevoluteJoint::GetStateSize() const
+{
+	return sizeof(b2RevoluteJointState);
+}
+
+void b2RevoluteJoint::SaveState(void* state) const
+{
+	b2RevoluteJointState* s = (b2RevoluteJointState*)state;
+	s->impulse = m_impulse;
+	s->motorImpulse = m_motorImpulse;
+	s->limitState = m_limitState;
+}
+
+void b2RevoluteJoint::RestoreState(const void* state)
+{
+	const b2RevoluteJointState* s = (const b2RevoluteJointState*)state;
+	m_impulse = s->impulse;
+	m_motorImpulse = s->motorImpulse;
+	m_limitState = (b2LimitState)s->limitState;
+}
@@ -154,6 +154,11 @@ public:
 	/// Dump to b2Log.
 	void Dump();
 
+	/// Defold modification
+	int32 GetStateSize() const;
+	void SaveState(void* state) const;
+	void RestoreState(const void* state);
+
 protected:
 	
 	friend class b2Joint;
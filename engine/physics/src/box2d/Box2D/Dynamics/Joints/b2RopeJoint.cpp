@@ -239,3 +239,26 @@ void b2RopeJoint::Dump()
 	b2Log("  jd.maxLength = %.15lef;\n", m_maxLength);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+// Defold modification
+struct b2RopeJointState
+{
+	float32 impulse;
+};
+
+int32 b2RopeJoint::GetStateSize() const
+{
+	return sizeof(b2RopeJointState);
+}
+
+void b2RopeJoint::SaveState(void* state) const
+{
+	b2RopeJointState* s = (b2RopeJointState*)state;
+	s->impulse = m_impulse;
+}
+
+void b2RopeJoint::RestoreState(const void* state)
+{
+	const b2RopeJointState* s = (const b2RopeJointState*)state;
+	m_impulse = s->impulse;
+}
@@ -79,6 +79,11 @@ public:
 	/// Dump joint to dmLog
 	void Dump();
 
+	/// Defold modification
+	int32 GetStateSize() const;
+	void SaveState(void* state) const;
+	void RestoreState(const void* state);
+
 protected:
 
 	friend class b2Joint;
@@ -328,3 +328,26 @@ void b2WeldJoint::Dump()
 	b2Log("  jd.dampingRatio = %.15lef;\n", m_dampingRatio);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+// Defold modification
+struct b2WeldJointState
+{
+	b2Vec3 impulse;
+};
+
+int32 b2WeldJoint::GetStateSize() const
+{
+	return sizeof(b2WeldJointState);
+}
+
+void b2WeldJoint::SaveState(void* state) const
+{
+	b2WeldJointState* s = (b2WeldJointState*)state;
+	s->impulse = m_impulse;
+}
+
+void b2WeldJoint::RestoreState(const void* state)
+{
+	const b2WeldJointState* s = (const b2WeldJointState*)state;
+	m_impulse = s->impulse;
+}
@@ -417,3 +417,32 @@ void b2WheelJoint::Dump()
 	b2Log("  jd.dampingRatio = %.15lef;\n", m_dampingRatio);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+// Defold modification
+struct b2WheelJointState
+{
+	float32 impulse;
+	float32 motorImpulse;
+	float32 springImpulse;
+};
+
+int32 b2WheelJoint::GetStateSize() const
+{
+	return sizeof(b2WheelJointState);
+}
+
+void b2WheelJoint::SaveState(void* state) const
+{
+	b2WheelJointState* s = (b2WheelJointState*)state;
+	s->impulse = m_impulse;
+	s->motorImpulse = m_motorImpulse;
+	s->springImpulse = m_springImpulse;
+}
+
+void b2WheelJoint::RestoreState(const void* state)
+{
+	const b2WheelJointState* s = (const b2WheelJointState*)state;
+	m_impulse = s->impulse;
+	m_motorImpulse = s->motorImpulse;
+	m_springImpulse = s->springImpulse;
+}
@@ -486,6 +486,25 @@ void b2Body::SynchronizeSingle(b2Shape* shape, int32 index)
     }
 }
 
+void b2Body::SynchronizeChildren(b2Fixture* fixture, const int32* childIndices, int32 count)
+{
+    // Same as SynchronizeSingle, there are no proxies to update for inactive bodies
+    if (!IsActive())
+    {
+        return;
+    }
+
+    b2Transform xf1;
+    xf1.q.Set(m_sweep.a0);
+    xf1.p = m_sweep.c0 - b2Mul(xf1.q, m_sweep.localCenter);
+
+    b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
+    for (int32 i = 0; i < count; ++i)
+    {
+        fixture->SynchronizeSingle(broadPhase, childIndices[i], xf1, m_xf);
+    }
+}
+
 void b2Body::SetActive(bool flag)
 {
 	b2Assert(m_world->IsLocked() == false);
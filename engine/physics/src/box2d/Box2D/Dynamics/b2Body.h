@@ -389,6 +389,9 @@ public:
 
     void SynchronizeSingle(b2Shape* shape, int32 index);
 
+    /// Synchronize the proxies of some of the children of a fixture, e.g. the edited cells of a grid
+    void SynchronizeChildren(b2Fixture* fixture, const int32* childIndices, int32 count);
+
     void SynchronizeFixtures();
 
 private:
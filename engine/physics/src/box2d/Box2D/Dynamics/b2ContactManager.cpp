@@ -25,6 +25,18 @@
 b2ContactFilter b2_defaultFilter;
 b2ContactListener b2_defaultListener;
 
+// Defold modification
+// A contact updated in the parallel narrow phase, with the state needed to call the listener afterwards
+struct b2ContactUpdate
+{
+	b2Contact* contact;
+	b2Manifold oldManifold;
+	bool wasTouching;
+};
+
+// Updating a contact is cheap, so it isn't worth splitting the work any finer than this
+static const int32 b2_contactUpdateGrain = 64;
+
 b2ContactManager::b2ContactManager()
 {
 	m_contactList = NULL;
@@ -32,6 +44,14 @@ b2ContactManager::b2ContactManager()
 	m_contactFilter = &b2_defaultFilter;
 	m_contactListener = &b2_defaultListener;
 	m_allocator = NULL;
+	m_taskExecutor = NULL;
+	m_updates = NULL;
+	m_updateCapacity = 0;
+}
+
+b2ContactManager::~b2ContactManager()
+{
+	b2Free(m_updates);
 }
 
 void b2ContactManager::Destroy(b2Contact* c)
@@ -104,6 +124,14 @@ void b2ContactManager::Destroy(b2Contact* c)
 // contact list.
 void b2ContactManager::Collide()
 {
+	int32 updateCount = 0;
+	if (m_taskExecutor && m_updateCapacity < m_contactCount)
+	{
+		b2Free(m_updates);
+		m_updateCapacity = m_contactCount;
+		m_updates = (b2ContactUpdate*)b2Alloc(m_updateCapacity * sizeof(b2ContactUpdate));
+	}
+
 	// Update awake contacts.
 	b2Contact* c = m_contactList;
 	while (c)
@@ -164,9 +192,44 @@ void b2ContactManager::Collide()
 		}
 
 		// The contact persists.
-		c->Update(m_contactListener);
+		if (m_taskExecutor)
+		{
+			// Defold modification: The contacts are gathered and updated in parallel below
+			m_updates[updateCount++].contact = c;
+		}
+		else
+		{
+			c->Update(m_contactListener);
+		}
 		c = c->GetNext();
 	}
+
+	if (updateCount > 0)
+	{
+		UpdateContactsParallel(updateCount);
+	}
+}
+
+void b2ContactManager::UpdateManifolds(void* context, int32 begin, int32 end)
+{
+	b2ContactUpdate* updates = (b2ContactUpdate*)context;
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2ContactUpdate* update = updates + i;
+		update->contact->UpdateManifold(&update->oldManifold, &update->wasTouching);
+	}
+}
+
+void b2ContactManager::UpdateContactsParallel(int32 count)
+{
+	m_taskExecutor->ParallelFor(count, b2_contactUpdateGrain, UpdateManifolds, m_updates);
+
+	// The bodies are woken and the listener is called in the contact list order, as when updating serially
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2ContactUpdate* update = m_updates + i;
+		update->contact->FinishUpdate(m_contactListener, &update->oldManifold, update->wasTouching);
+	}
 }
 
 void b2ContactManager::FindNewContacts()
@@ -257,12 +320,21 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 	}
 
 	// Contact creation may swap fixtures.
-	fixtureA = c->GetFixtureA();
-	fixtureB = c->GetFixtureB();
-	indexA = c->GetChildIndexA();
-	indexB = c->GetChildIndexB();
-	bodyA = fixtureA->GetBody();
-	bodyB = fixtureB->GetBody();
+	bodyA = c->GetFixtureA()->GetBody();
+	bodyB = c->GetFixtureB()->GetBody();
+
+	Insert(c);
+
+	// Wake up the bodies
+	bodyA->SetAwake(true);
+	bodyB->SetAwake(true);
+}
+
+// Defold modification
+void b2ContactManager::Insert(b2Contact* c)
+{
+	b2Body* bodyA = c->GetFixtureA()->GetBody();
+	b2Body* bodyB = c->GetFixtureB()->GetBody();
 
 	// Insert into the world.
 	c->m_prev = NULL;
@@ -299,9 +371,5 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 	}
 	bodyB->m_contactList = &c->m_nodeB;
 
-	// Wake up the bodies
-	bodyA->SetAwake(true);
-	bodyB->SetAwake(true);
-
 	++m_contactCount;
 }
@@ -25,12 +25,15 @@ class b2Contact;
 class b2ContactFilter;
 class b2ContactListener;
 class b2BlockAllocator;
+class b2TaskExecutor;
+struct b2ContactUpdate;
 
 // Delegate of b2World.
 class b2ContactManager
 {
 public:
 	b2ContactManager();
+	~b2ContactManager();
 
     // Broad-phase callback.
     void AddPair(void* proxyUserDataA, void* proxyUserDataB);
@@ -41,6 +44,11 @@ public:
 
 	void Destroy(b2Contact* c);
 
+	// Defold modification
+	// Insert a contact created with b2Contact::Create into the world and body contact lists.
+	// Doesn't wake the bodies.
+	void Insert(b2Contact* c);
+
 	void Collide();
             
 	b2BroadPhase m_broadPhase;
@@ -49,6 +57,16 @@ public:
 	b2ContactFilter* m_contactFilter;
 	b2ContactListener* m_contactListener;
 	b2BlockAllocator* m_allocator;
+
+	// Defold modification
+	// If set, the contact manifolds are updated in parallel in Collide
+	b2TaskExecutor* m_taskExecutor;
+	b2ContactUpdate* m_updates;
+	int32 m_updateCapacity;
+
+private:
+	void UpdateContactsParallel(int32 count);
+	static void UpdateManifolds(void* context, int32 begin, int32 end);
 };
 
 #endif
@@ -26,6 +26,7 @@
 #include <Box2D/Collision/b2BroadPhase.h>
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Common/b2BlockAllocator.h>
+#include <algorithm>
 
 b2Fixture::b2Fixture()
 {
@@ -265,6 +266,44 @@ void b2Fixture::Refilter(bool touchProxies)
 	}
 }
 
+// Defold modification
+void b2Fixture::SetChildFilterData(const b2Filter& filter, int32 index)
+{
+    m_filters[index * m_shape->m_filterPerChild] = filter;
+}
+
+// Defold modification
+void b2Fixture::RefilterChildren(const int32* childIndices, int32 count)
+{
+	if (m_body == NULL || count == 0)
+	{
+		return;
+	}
+
+	const int32* end = childIndices + count;
+	b2ContactEdge* edge = m_body->GetContactList();
+	while (edge)
+	{
+		b2Contact* contact = edge->contact;
+		int32 childIndex = -1;
+		if (contact->GetFixtureA() == this)
+		{
+			childIndex = contact->GetChildIndexA();
+		}
+		else if (contact->GetFixtureB() == this)
+		{
+			childIndex = contact->GetChildIndexB();
+		}
+
+		if (childIndex >= 0 && std::binary_search(childIndices, end, childIndex))
+		{
+			contact->FlagForFiltering();
+		}
+
+		edge = edge->next;
+	}
+}
+
 void b2Fixture::SetSensor(bool sensor)
 {
 	if (sensor != m_isSensor)
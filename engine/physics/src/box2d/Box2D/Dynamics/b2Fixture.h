@@ -137,6 +137,16 @@ public:
 	/// Call this if you want to establish collision that was previously disabled by b2ContactFilter::ShouldCollide.
 	void Refilter(bool touchProxies);
 
+	// Defold modification
+	/// Set the contact filtering data of a child without flagging any contacts for filtering.
+	/// Call RefilterChildren once after changing the filtering data of many children.
+	void SetChildFilterData(const b2Filter& filter, int32 index);
+
+	// Defold modification
+	/// Flag the contacts of some of the children for filtering.
+	/// @param childIndices sorted child indices
+	void RefilterChildren(const int32* childIndices, int32 count);
+
 	/// Get the parent body of this fixture. This is NULL if the fixture is not attached.
 	/// @return the parent body.
 	b2Body* GetBody();
@@ -162,6 +162,7 @@ b2Island::b2Island(
 
 	m_allocator = allocator;
 	m_listener = listener;
+	m_sharedStaticBodies = false;
 
 	m_bodies = (b2Body**)m_allocator->Allocate(bodyCapacity * sizeof(b2Body*));
 	m_contacts = (b2Contact**)m_allocator->Allocate(contactCapacity	 * sizeof(b2Contact*));
@@ -187,6 +188,11 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 
 	float32 h = step.dt;
 
+	if (m_sharedStaticBodies == false)
+	{
+		StoreContactIndices();
+	}
+
 	// Integrate velocities and apply damping. Initialize the body state.
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
@@ -198,8 +204,11 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		float32 w = b->m_angularVelocity;
 
 		// Store positions for continuous collision.
-		b->m_sweep.c0 = b->m_sweep.c;
-		b->m_sweep.a0 = b->m_sweep.a;
+		if (m_sharedStaticBodies == false || b->m_type != b2_staticBody)
+		{
+			b->m_sweep.c0 = b->m_sweep.c;
+			b->m_sweep.a0 = b->m_sweep.a;
+		}
 
 		if (b->m_type == b2_dynamicBody)
 		{
@@ -341,6 +350,11 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
 		b2Body* body = m_bodies[i];
+		// Static bodies don't move
+		if (m_sharedStaticBodies && body->m_type == b2_staticBody)
+		{
+			continue;
+		}
 		body->m_sweep.c = m_positions[i].c;
 		body->m_sweep.a = m_positions[i].a;
 		body->m_linearVelocity = m_velocities[i].v;
@@ -386,6 +400,10 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 			for (int32 i = 0; i < m_bodyCount; ++i)
 			{
 				b2Body* b = m_bodies[i];
+				if (m_sharedStaticBodies && b->m_type == b2_staticBody)
+				{
+					continue;
+				}
 				b->SetAwake(false);
 			}
 		}
@@ -397,6 +415,8 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 	b2Assert(toiIndexA < m_bodyCount);
 	b2Assert(toiIndexB < m_bodyCount);
 
+	StoreContactIndices();
+
 	// Initialize the body state.
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
@@ -524,6 +544,16 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 	Report(contactSolver.m_velocityConstraints);
 }
 
+void b2Island::StoreContactIndices()
+{
+	for (int32 i = 0; i < m_contactCount; ++i)
+	{
+		b2Contact* c = m_contacts[i];
+		c->m_islandIndexA = c->m_fixtureA->GetBody()->m_islandIndex;
+		c->m_islandIndexB = c->m_fixtureB->GetBody()->m_islandIndex;
+	}
+}
+
 void b2Island::Report(const b2ContactVelocityConstraint* constraints)
 {
 	if (m_listener == NULL)
@@ -71,6 +71,10 @@ public:
 
 	void Report(const b2ContactVelocityConstraint* constraints);
 
+	// Defold modification
+	// Store the island indices of the bodies with the contacts, for the contact solver
+	void StoreContactIndices();
+
 	b2StackAllocator* m_allocator;
 	b2ContactListener* m_listener;
 
@@ -88,6 +92,11 @@ public:
 	int32 m_bodyCapacity;
 	int32 m_contactCapacity;
 	int32 m_jointCapacity;
+
+	// Defold modification
+	// Set when the island is solved in parallel with other islands. The static bodies can then be
+	// part of several islands, so they aren't written to, and the contact indices must already be stored.
+	bool m_sharedStaticBodies;
 };
 
 #endif
@@ -62,6 +62,10 @@ b2World::b2World(const b2Vec2& gravity)
 	m_contactManager.m_allocator = &m_blockAllocator;
 
 	memset(&m_profile, 0, sizeof(b2Profile));
+
+	m_taskExecutor = NULL;
+	m_taskAllocators = NULL;
+	m_taskCount = 0;
 }
 
 b2World::~b2World()
@@ -83,6 +87,42 @@ b2World::~b2World()
 
 		b = bNext;
 	}
+
+	DestroyTaskAllocators();
+}
+
+void b2World::SetTaskExecutor(b2TaskExecutor* executor, int32 taskCount)
+{
+	b2Assert(IsLocked() == false);
+
+	DestroyTaskAllocators();
+
+	m_taskExecutor = executor;
+	m_taskCount = executor ? b2Max(taskCount, 1) : 0;
+	m_contactManager.m_taskExecutor = executor;
+
+	// Each task solves its islands with its own allocator
+	if (m_taskCount > 1)
+	{
+		m_taskAllocators = (b2StackAllocator*)b2Alloc(m_taskCount * sizeof(b2StackAllocator));
+		for (int32 i = 0; i < m_taskCount; ++i)
+		{
+			new (m_taskAllocators + i) b2StackAllocator();
+		}
+	}
+}
+
+void b2World::DestroyTaskAllocators()
+{
+	if (m_taskAllocators)
+	{
+		for (int32 i = 0; i < m_taskCount; ++i)
+		{
+			m_taskAllocators[i].~b2StackAllocator();
+		}
+		b2Free(m_taskAllocators);
+		m_taskAllocators = NULL;
+	}
 }
 
 void b2World::SetDestructionListener(b2DestructionListener* listener)
@@ -384,6 +424,216 @@ void b2World::SetAllowSleeping(bool flag)
 }
 
 // Find islands, integrate and solve constraints, solve position constraints
+// Defold modification
+// An island found in b2World::Solve, to be solved with the others once they have all been found
+struct b2IslandRange
+{
+	int32 bodyStart;
+	int32 bodyCount;
+	int32 contactStart;
+	int32 contactCount;
+	int32 jointStart;
+	int32 jointCount;
+	// False if the island must be solved serially, see RecordIsland
+	bool parallel;
+	b2Profile profile;
+};
+
+struct b2IslandSolveContext
+{
+	b2IslandRange* islands;
+	int32 islandCount;
+
+	// The bodies, contacts and joints of all the islands. A static body is listed once per island it is part of.
+	b2Body** bodies;
+	int32 bodyCount;
+	b2Contact** contacts;
+	int32 contactCount;
+	b2Joint** joints;
+	int32 jointCount;
+
+	// The islands solved in parallel, and the first of them for each task (taskCount + 1 entries)
+	int32* parallelIslands;
+	int32* taskStarts;
+	b2StackAllocator* allocators;
+
+	b2TimeStep step;
+	b2Vec2 gravity;
+	bool allowSleep;
+};
+
+static void RecordIsland(b2IslandSolveContext* context, b2Island* island)
+{
+	// A static body gets a new island index in each island it is part of,
+	// so the indices are stored with the contacts while they are valid.
+	island->StoreContactIndices();
+
+	b2IslandRange* range = context->islands + context->islandCount++;
+	range->bodyStart = context->bodyCount;
+	range->bodyCount = island->m_bodyCount;
+	range->contactStart = context->contactCount;
+	range->contactCount = island->m_contactCount;
+	range->jointStart = context->jointCount;
+	range->jointCount = island->m_jointCount;
+	range->parallel = true;
+
+	memcpy(context->bodies + context->bodyCount, island->m_bodies, island->m_bodyCount * sizeof(b2Body*));
+	memcpy(context->contacts + context->contactCount, island->m_contacts, island->m_contactCount * sizeof(b2Contact*));
+	memcpy(context->joints + context->jointCount, island->m_joints, island->m_jointCount * sizeof(b2Joint*));
+	context->bodyCount += island->m_bodyCount;
+	context->contactCount += island->m_contactCount;
+	context->jointCount += island->m_jointCount;
+
+	// The joints read the island indices from the bodies, which are only valid for
+	// the static bodies when the island is solved right after it is built.
+	for (int32 i = 0; i < island->m_jointCount; ++i)
+	{
+		b2Joint* joint = island->m_joints[i];
+		if (joint->GetType() == e_gearJoint ||
+			joint->GetBodyA()->GetType() == b2_staticBody ||
+			joint->GetBodyB()->GetType() == b2_staticBody)
+		{
+			range->parallel = false;
+			break;
+		}
+	}
+}
+
+static inline int32 GetIslandCost(const b2IslandRange* range)
+{
+	return range->bodyCount + range->contactCount + range->jointCount;
+}
+
+static void SolveIslandTasks(void* _context, int32 begin, int32 end)
+{
+	b2IslandSolveContext* context = (b2IslandSolveContext*)_context;
+	for (int32 task = begin; task < end; ++task)
+	{
+		b2StackAllocator* allocator = context->allocators + task;
+		for (int32 i = context->taskStarts[task]; i < context->taskStarts[task + 1]; ++i)
+		{
+			b2IslandRange* range = context->islands + context->parallelIslands[i];
+
+			// The contact impulses are reported afterwards, in island order
+			b2Island island(range->bodyCount, range->contactCount, range->jointCount, allocator, NULL);
+			island.m_sharedStaticBodies = true;
+			memcpy(island.m_bodies, context->bodies + range->bodyStart, range->bodyCount * sizeof(b2Body*));
+			memcpy(island.m_contacts, context->contacts + range->contactStart, range->contactCount * sizeof(b2Contact*));
+			memcpy(island.m_joints, context->joints + range->jointStart, range->jointCount * sizeof(b2Joint*));
+			island.m_bodyCount = range->bodyCount;
+			island.m_contactCount = range->contactCount;
+			island.m_jointCount = range->jointCount;
+
+			island.Solve(&range->profile, context->step, context->gravity, context->allowSleep);
+		}
+	}
+}
+
+// Reports the impulses the same way as b2Island::Report, from the impulses stored in the manifolds
+static void ReportIsland(b2ContactListener* listener, b2Contact** contacts, int32 count)
+{
+	if (listener == NULL)
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Contact* c = contacts[i];
+		const b2Manifold* manifold = c->GetManifold();
+
+		b2ContactImpulse impulse;
+		impulse.count = manifold->pointCount;
+		for (int32 j = 0; j < manifold->pointCount; ++j)
+		{
+			impulse.normalImpulses[j] = manifold->points[j].normalImpulse;
+			impulse.tangentImpulses[j] = manifold->points[j].tangentImpulse;
+		}
+
+		listener->PostSolve(c, &impulse);
+	}
+}
+
+void b2World::SolveIslandsParallel(const b2TimeStep& step, b2Island* island, b2IslandSolveContext* context)
+{
+	context->step = step;
+	context->gravity = m_gravity;
+	context->allowSleep = m_allowSleep;
+	context->allocators = m_taskAllocators;
+	context->parallelIslands = (int32*)m_stackAllocator.Allocate(context->islandCount * sizeof(int32));
+	context->taskStarts = (int32*)m_stackAllocator.Allocate((m_taskCount + 1) * sizeof(int32));
+
+	int32 parallelCount = 0;
+	int32 totalCost = 0;
+	for (int32 i = 0; i < context->islandCount; ++i)
+	{
+		if (context->islands[i].parallel)
+		{
+			context->parallelIslands[parallelCount++] = i;
+			totalCost += GetIslandCost(context->islands + i);
+		}
+	}
+
+	// Split the islands into tasks of about the same cost. Which task solves an island
+	// doesn't affect the result, since the islands don't share any (non-static) bodies.
+	int32 taskCount = b2Min(m_taskCount, parallelCount);
+	if (taskCount > 1)
+	{
+		int32 task = 1;
+		int32 cost = 0;
+		context->taskStarts[0] = 0;
+		for (int32 i = 0; i < parallelCount; ++i)
+		{
+			cost += GetIslandCost(context->islands + context->parallelIslands[i]);
+			while (task < taskCount && cost * taskCount >= totalCost * task)
+			{
+				context->taskStarts[task++] = i + 1;
+			}
+		}
+		while (task <= taskCount)
+		{
+			context->taskStarts[task++] = parallelCount;
+		}
+
+		m_taskExecutor->ParallelFor(taskCount, 1, SolveIslandTasks, context);
+	}
+
+	// Solve the remaining islands and report the impulses, in the order the islands were found
+	b2ContactListener* listener = m_contactManager.m_contactListener;
+	for (int32 i = 0; i < context->islandCount; ++i)
+	{
+		b2IslandRange* range = context->islands + i;
+		if (range->parallel && taskCount > 1)
+		{
+			ReportIsland(listener, context->contacts + range->contactStart, range->contactCount);
+		}
+		else
+		{
+			island->Clear();
+			for (int32 j = 0; j < range->bodyCount; ++j)
+			{
+				island->Add(context->bodies[range->bodyStart + j]);
+			}
+			for (int32 j = 0; j < range->contactCount; ++j)
+			{
+				island->Add(context->contacts[range->contactStart + j]);
+			}
+			for (int32 j = 0; j < range->jointCount; ++j)
+			{
+				island->Add(context->joints[range->jointStart + j]);
+			}
+			island->Solve(&range->profile, step, m_gravity, m_allowSleep);
+		}
+
+		m_profile.solveInit += range->profile.solveInit;
+		m_profile.solveVelocity += range->profile.solveVelocity;
+		m_profile.solvePosition += range->profile.solvePosition;
+	}
+
+	m_stackAllocator.Free(context->taskStarts);
+	m_stackAllocator.Free(context->parallelIslands);
+}
+
 void b2World::Solve(const b2TimeStep& step)
 {
 	m_profile.solveInit = 0.0f;
@@ -414,6 +664,23 @@ void b2World::Solve(const b2TimeStep& step)
 	// Build and simulate all awake islands.
 	int32 stackSize = m_bodyCount;
 	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
+
+	// Defold modification
+	// With a task executor, the islands are only recorded here and then solved in parallel
+	b2IslandSolveContext context;
+	if (m_taskExecutor)
+	{
+		// A static body can be part of one island per contact or joint
+		int32 contactCount = m_contactManager.m_contactCount;
+		context.islands = (b2IslandRange*)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2IslandRange));
+		context.bodies = (b2Body**)m_stackAllocator.Allocate((m_bodyCount + contactCount + m_jointCount) * sizeof(b2Body*));
+		context.contacts = (b2Contact**)m_stackAllocator.Allocate(contactCount * sizeof(b2Contact*));
+		context.joints = (b2Joint**)m_stackAllocator.Allocate(m_jointCount * sizeof(b2Joint*));
+		context.islandCount = 0;
+		context.bodyCount = 0;
+		context.contactCount = 0;
+		context.jointCount = 0;
+	}
 	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
 	{
 		if (seed->m_flags & b2Body::e_islandFlag)
@@ -528,11 +795,18 @@ void b2World::Solve(const b2TimeStep& step)
 			}
 		}
 
-		b2Profile profile;
-		island.Solve(&profile, step, m_gravity, m_allowSleep);
-		m_profile.solveInit += profile.solveInit;
-		m_profile.solveVelocity += profile.solveVelocity;
-		m_profile.solvePosition += profile.solvePosition;
+		if (m_taskExecutor)
+		{
+			RecordIsland(&context, &island);
+		}
+		else
+		{
+			b2Profile profile;
+			island.Solve(&profile, step, m_gravity, m_allowSleep);
+			m_profile.solveInit += profile.solveInit;
+			m_profile.solveVelocity += profile.solveVelocity;
+			m_profile.solvePosition += profile.solvePosition;
+		}
 
 		// Post solve cleanup.
 		for (int32 i = 0; i < island.m_bodyCount; ++i)
@@ -546,6 +820,16 @@ void b2World::Solve(const b2TimeStep& step)
 		}
 	}
 
+	if (m_taskExecutor)
+	{
+		SolveIslandsParallel(step, &island, &context);
+
+		m_stackAllocator.Free(context.joints);
+		m_stackAllocator.Free(context.contacts);
+		m_stackAllocator.Free(context.bodies);
+		m_stackAllocator.Free(context.islands);
+	}
+
 	m_stackAllocator.Free(stack);
 
 	{
@@ -1372,3 +1656,293 @@ void b2World::Dump()
 	b2Log("joints = NULL;\n");
 	b2Log("bodies = NULL;\n");
 }
+
+// Defold modification
+// A saved world state is the header, followed by the bodies (each followed by its fixture proxies)
+// in body list order, the joint states in joint list order, the moved proxies and the contacts in
+// contact list order.
+struct b2WorldStateHeader
+{
+	int32 size;
+	int32 bodyCount;
+	int32 jointCount;
+	int32 moveCount;
+	int32 contactCount;
+	int32 flags;
+	float32 inv_dt0;
+	int32 stepComplete;
+};
+
+struct b2BodyState
+{
+	b2Transform xf;
+	b2Sweep sweep;
+	b2Vec2 linearVelocity;
+	float32 angularVelocity;
+	b2Vec2 force;
+	float32 torque;
+	float32 sleepTime;
+	int32 type;
+	int32 flags;
+	int32 proxyCount;
+};
+
+struct b2ProxyState
+{
+	b2AABB aabb;
+	b2AABB fatAABB;
+	int32 proxyId;
+};
+
+struct b2ContactState
+{
+	// The contacts reference their fixtures through the broad-phase proxies
+	int32 proxyIdA;
+	int32 proxyIdB;
+	uint32 flags;
+	int32 toiCount;
+	float32 toi;
+	float32 friction;
+	float32 restitution;
+	b2Manifold manifold;
+};
+
+int32 b2World::GetStateSize() const
+{
+	int32 size = sizeof(b2WorldStateHeader) + m_bodyCount * sizeof(b2BodyState);
+	for (const b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		for (const b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			size += f->m_proxyCount * sizeof(b2ProxyState);
+		}
+	}
+	for (const b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		size += j->GetStateSize();
+	}
+	const int32* moveBuffer = m_contactManager.m_broadPhase.GetMoveBuffer();
+	int32 moveCount = m_contactManager.m_broadPhase.GetMoveCount();
+	for (int32 i = 0; i < moveCount; ++i)
+	{
+		if (moveBuffer[i] != b2BroadPhase::e_nullProxy)
+		{
+			size += sizeof(int32);
+		}
+	}
+	size += m_contactManager.m_contactCount * sizeof(b2ContactState);
+	return size;
+}
+
+void b2World::SaveState(void* buffer) const
+{
+	b2Assert(IsLocked() == false);
+
+	uint8* p = (uint8*)buffer;
+	b2WorldStateHeader* header = (b2WorldStateHeader*)p;
+	p += sizeof(b2WorldStateHeader);
+	header->bodyCount = m_bodyCount;
+	header->jointCount = m_jointCount;
+	header->contactCount = m_contactManager.m_contactCount;
+	header->flags = m_flags & e_newFixture;
+	header->inv_dt0 = m_inv_dt0;
+	header->stepComplete = m_stepComplete;
+
+	for (const b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b2BodyState* bs = (b2BodyState*)p;
+		p += sizeof(b2BodyState);
+		bs->xf = b->m_xf;
+		bs->sweep = b->m_sweep;
+		bs->linearVelocity = b->m_linearVelocity;
+		bs->angularVelocity = b->m_angularVelocity;
+		bs->force = b->m_force;
+		bs->torque = b->m_torque;
+		bs->sleepTime = b->m_sleepTime;
+		bs->type = b->m_type;
+		bs->flags = b->m_flags & (b2Body::e_awakeFlag | b2Body::e_toiFlag);
+		bs->proxyCount = 0;
+		for (const b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
+			{
+				const b2FixtureProxy* proxy = f->m_proxies + i;
+				b2ProxyState* ps = (b2ProxyState*)p;
+				p += sizeof(b2ProxyState);
+				ps->aabb = proxy->aabb;
+				ps->fatAABB = m_contactManager.m_broadPhase.GetFatAABB(proxy->proxyId);
+				ps->proxyId = proxy->proxyId;
+			}
+			bs->proxyCount += f->m_proxyCount;
+		}
+	}
+
+	for (const b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		j->SaveState(p);
+		p += j->GetStateSize();
+	}
+
+	const int32* moveBuffer = m_contactManager.m_broadPhase.GetMoveBuffer();
+	int32 moveCount = m_contactManager.m_broadPhase.GetMoveCount();
+	header->moveCount = 0;
+	for (int32 i = 0; i < moveCount; ++i)
+	{
+		if (moveBuffer[i] != b2BroadPhase::e_nullProxy)
+		{
+			*(int32*)p = moveBuffer[i];
+			p += sizeof(int32);
+			++header->moveCount;
+		}
+	}
+
+	for (const b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		b2ContactState* cs = (b2ContactState*)p;
+		p += sizeof(b2ContactState);
+		cs->proxyIdA = c->m_fixtureA->m_proxies[c->m_indexA].proxyId;
+		cs->proxyIdB = c->m_fixtureB->m_proxies[c->m_indexB].proxyId;
+		cs->flags = c->m_flags;
+		cs->toiCount = c->m_toiCount;
+		cs->toi = c->m_toi;
+		cs->friction = c->m_friction;
+		cs->restitution = c->m_restitution;
+		cs->manifold = c->m_manifold;
+	}
+
+	header->size = (int32)(p - (uint8*)buffer);
+}
+
+bool b2World::RestoreState(const void* buffer, int32 size)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked() || size < (int32)sizeof(b2WorldStateHeader))
+	{
+		return false;
+	}
+
+	const uint8* p = (const uint8*)buffer;
+	const b2WorldStateHeader* header = (const b2WorldStateHeader*)p;
+	if (header->size != size || header->bodyCount != m_bodyCount || header->jointCount != m_jointCount)
+	{
+		return false;
+	}
+
+	// Check that the world has the same structure before changing anything
+	int32 offset = sizeof(b2WorldStateHeader);
+	for (const b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		if (offset + (int32)sizeof(b2BodyState) > size)
+		{
+			return false;
+		}
+		const b2BodyState* bs = (const b2BodyState*)(p + offset);
+		offset += sizeof(b2BodyState);
+		if (bs->type != b->m_type || offset + bs->proxyCount * (int32)sizeof(b2ProxyState) > size)
+		{
+			return false;
+		}
+		const b2ProxyState* ps = (const b2ProxyState*)(p + offset);
+		int32 proxyCount = 0;
+		for (const b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
+			{
+				if (proxyCount == bs->proxyCount || ps[proxyCount].proxyId != f->m_proxies[i].proxyId)
+				{
+					return false;
+				}
+				++proxyCount;
+			}
+		}
+		if (proxyCount != bs->proxyCount)
+		{
+			return false;
+		}
+		offset += proxyCount * sizeof(b2ProxyState);
+	}
+	for (const b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		offset += j->GetStateSize();
+	}
+	if (offset + header->moveCount * (int32)sizeof(int32) + header->contactCount * (int32)sizeof(b2ContactState) != size)
+	{
+		return false;
+	}
+
+	m_flags = (m_flags & ~e_newFixture) | (header->flags & e_newFixture);
+	m_inv_dt0 = header->inv_dt0;
+	m_stepComplete = header->stepComplete != 0;
+
+	// The contacts are recreated below, without any end or begin contact callbacks
+	b2ContactListener* listener = m_contactManager.m_contactListener;
+	m_contactManager.m_contactListener = NULL;
+	while (m_contactManager.m_contactList)
+	{
+		m_contactManager.Destroy(m_contactManager.m_contactList);
+	}
+	m_contactManager.m_contactListener = listener;
+
+	p += sizeof(b2WorldStateHeader);
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		const b2BodyState* bs = (const b2BodyState*)p;
+		p += sizeof(b2BodyState);
+		b->m_xf = bs->xf;
+		b->m_sweep = bs->sweep;
+		b->m_linearVelocity = bs->linearVelocity;
+		b->m_angularVelocity = bs->angularVelocity;
+		b->m_force = bs->force;
+		b->m_torque = bs->torque;
+		b->m_sleepTime = bs->sleepTime;
+		// Only the flags that change during a time step are restored
+		const uint16 stateFlags = b2Body::e_awakeFlag | b2Body::e_toiFlag;
+		b->m_flags = (b->m_flags & ~stateFlags) | (bs->flags & stateFlags);
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
+			{
+				const b2ProxyState* ps = (const b2ProxyState*)p;
+				p += sizeof(b2ProxyState);
+				f->m_proxies[i].aabb = ps->aabb;
+				broadPhase->SetFatAABB(ps->proxyId, ps->fatAABB);
+			}
+		}
+	}
+
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		j->RestoreState(p);
+		p += j->GetStateSize();
+	}
+
+	broadPhase->ClearMoveBuffer();
+	const int32* moves = (const int32*)p;
+	for (int32 i = 0; i < header->moveCount; ++i)
+	{
+		broadPhase->TouchProxy(moves[i]);
+	}
+	p += header->moveCount * sizeof(int32);
+
+	// Contacts are inserted at the front of the world and body contact lists, so recreating
+	// them in reverse order gives the same list orders as when the state was saved
+	const b2ContactState* contacts = (const b2ContactState*)p;
+	for (int32 i = header->contactCount - 1; i >= 0; --i)
+	{
+		const b2ContactState* cs = contacts + i;
+		b2FixtureProxy* proxyA = (b2FixtureProxy*)broadPhase->GetUserData(cs->proxyIdA);
+		b2FixtureProxy* proxyB = (b2FixtureProxy*)broadPhase->GetUserData(cs->proxyIdB);
+		b2Contact* c = b2Contact::Create(proxyA->fixture, proxyA->childIndex, proxyB->fixture, proxyB->childIndex, m_contactManager.m_allocator);
+		b2Assert(c != NULL && c->m_fixtureA == proxyA->fixture);
+		c->m_flags = cs->flags;
+		c->m_toiCount = cs->toiCount;
+		c->m_toi = cs->toi;
+		c->m_friction = cs->friction;
+		c->m_restitution = cs->restitution;
+		c->m_manifold = cs->manifold;
+		m_contactManager.Insert(c);
+	}
+
+	return true;
+}
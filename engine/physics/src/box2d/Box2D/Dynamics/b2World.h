@@ -34,6 +34,8 @@ class b2Body;
 class b2Draw;
 class b2Fixture;
 class b2Joint;
+class b2Island;
+struct b2IslandSolveContext;
 
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
@@ -61,6 +63,15 @@ public:
 	/// remain in scope.
 	void SetContactListener(b2ContactListener* listener);
 
+	/// Defold modification
+	/// Register a task executor to update the contacts and solve the islands in parallel.
+	/// The results are the same as when stepping serially, and the listener callbacks are
+	/// still called on the stepping thread, in the same order. The executor is owned by you
+	/// and must remain in scope.
+	/// @param executor the task executor, or NULL to step serially
+	/// @param taskCount the number of tasks the islands are split into
+	void SetTaskExecutor(b2TaskExecutor* executor, int32 taskCount);
+
 	/// Register a routine for debug drawing. The debug draw functions are called
 	/// inside with b2World::DrawDebugData method. The debug draw object is owned
 	/// by you and must remain in scope.
@@ -204,6 +215,29 @@ public:
 	/// @warning this should be called outside of a time step.
 	void Dump();
 
+	/// Defold modification
+	/// Get the size in bytes of the state saved by SaveState.
+	int32 GetStateSize() const;
+
+	/// Defold modification
+	/// Save the simulation state of the world: the body transforms and velocities, the fixture
+	/// proxy bounds, the contacts with their manifolds and the joint impulses used for warm starting.
+	/// Stepping the world after restoring the state with RestoreState gives the same result as
+	/// stepping it after saving.
+	/// @param buffer a 4 byte aligned buffer of GetStateSize() bytes
+	/// @warning this should be called outside of a time step.
+	void SaveState(void* buffer) const;
+
+	/// Defold modification
+	/// Restore a state saved by SaveState. The world must have the same bodies, fixtures and joints,
+	/// in the same order, as when the state was saved. The contacts are recreated without calling the
+	/// contact listener.
+	/// @param buffer a 4 byte aligned state saved by SaveState
+	/// @param size the size of the state in bytes
+	/// @return false if the state doesn't match the world, which is then left unchanged
+	/// @warning this should be called outside of a time step.
+	bool RestoreState(const void* buffer, int32 size);
+
 private:
 
 	// m_flags
@@ -222,6 +256,10 @@ private:
 	void Solve(const b2TimeStep& step);
 	void SolveTOI(const b2TimeStep& step);
 
+	// Defold modification
+	void SolveIslandsParallel(const b2TimeStep& step, b2Island* island, b2IslandSolveContext* context);
+	void DestroyTaskAllocators();
+
 	void DrawJoint(b2Joint* joint);
 	void DrawShape(b2Fixture* shape, const b2Transform& xf, const b2Color& color);
 	void DrawPolygon(const b2Transform& xf, const b2PolygonShape& poly, const b2Color& color);
@@ -257,6 +295,11 @@ private:
 	bool m_stepComplete;
 
 	b2Profile m_profile;
+
+	// Defold modification
+	b2TaskExecutor* m_taskExecutor;
+	b2StackAllocator* m_taskAllocators;
+	int32 m_taskCount;
 };
 
 inline b2Body* b2World::GetBodyList()
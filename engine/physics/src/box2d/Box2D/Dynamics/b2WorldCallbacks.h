@@ -152,4 +152,22 @@ public:
 									const b2Vec2& normal, float32 fraction) = 0;
 };
 
+/// Defold modification
+/// A range of the work in a time step, [begin, end).
+typedef void (*b2TaskFn)(void* context, int32 begin, int32 end);
+
+/// Defold modification
+/// Implement this class to run the narrow phase and the island solving in parallel.
+/// See b2World::SetTaskExecutor
+class b2TaskExecutor
+{
+public:
+	virtual ~b2TaskExecutor() {}
+
+	/// Call fn for ranges covering [0, count), with at least grain items per range
+	/// (except possibly the last one). The ranges may be run in any order and on any
+	/// thread, but this must not return until all of them are done.
+	virtual void ParallelFor(int32 count, int32 grain, b2TaskFn fn, void* context) = 0;
+};
+
 #endif
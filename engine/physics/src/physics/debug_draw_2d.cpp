@@ -26,6 +26,30 @@ namespace dmPhysics
 
     }
 
+    bool DebugDraw2D::IsVisible(const b2Vec2& center, float32 radius)
+    {
+        if (!m_Callbacks->m_IsVisible)
+            return true;
+        float inv_scale = m_Callbacks->m_InvScale;
+        dmVMath::Point3 c;
+        FromB2(center, c, inv_scale);
+        return (*m_Callbacks->m_IsVisible)(c, radius * inv_scale, m_Callbacks->m_UserData);
+    }
+
+    bool DebugDraw2D::IsVisible(const b2Vec2* vertices, int32 vertexCount)
+    {
+        if (!m_Callbacks->m_IsVisible || vertexCount <= 0)
+            return true;
+        b2Vec2 lower = vertices[0];
+        b2Vec2 upper = vertices[0];
+        for (int32 i = 1; i < vertexCount; ++i)
+        {
+            lower = b2Min(lower, vertices[i]);
+            upper = b2Max(upper, vertices[i]);
+        }
+        return IsVisible(0.5f * (lower + upper), 0.5f * (upper - lower).Length());
+    }
+
     void DebugDraw2D::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
     {
         if (m_Callbacks->m_DrawLines)
@@ -34,6 +58,8 @@ namespace dmPhysics
             dmVMath::Point3 points[MAX_SEGMENT_COUNT*2];
             float inv_scale = m_Callbacks->m_InvScale;
             uint32_t segment_count = dmMath::Min(MAX_SEGMENT_COUNT, (uint32_t)vertexCount);
+            if (!IsVisible(vertices, (int32)segment_count))
+                return;
             for (uint32_t i = 0; i < segment_count; ++i)
             {
                 FromB2(vertices[i], points[2*i], inv_scale);
@@ -51,6 +77,8 @@ namespace dmPhysics
             const uint32_t MAX_TRI_COUNT = 16;
             dmVMath::Point3 points[MAX_TRI_COUNT*3];
             uint32_t triangle_count = dmMath::Min(MAX_TRI_COUNT, (uint32_t)vertexCount);
+            if (!IsVisible(vertices, (int32)triangle_count))
+                return;
             b2Vec2 b2_center(0.0f, 0.0f);
             for (uint32_t i = 0; i < triangle_count; ++i)
             {
@@ -74,7 +102,7 @@ namespace dmPhysics
 
     void DebugDraw2D::DrawCircle(const b2Vec2& center, float32 radius, const b2Color& color)
     {
-        if (m_Callbacks->m_DrawLines)
+        if (m_Callbacks->m_DrawLines && IsVisible(center, radius))
         {
             float inv_scale = m_Callbacks->m_InvScale;
             dmVMath::Point3 c;
@@ -100,7 +128,7 @@ namespace dmPhysics
 
     void DebugDraw2D::DrawSolidCircle(const b2Vec2& center, float32 radius, const b2Vec2& axis, const b2Color& color)
     {
-        if (m_Callbacks->m_DrawTriangles)
+        if (m_Callbacks->m_DrawTriangles && IsVisible(center, radius))
         {
             float inv_scale = m_Callbacks->m_InvScale;
             dmVMath::Point3 c;
@@ -127,7 +155,7 @@ namespace dmPhysics
 
     void DebugDraw2D::DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color)
     {
-        if (m_Callbacks->m_DrawLines)
+        if (m_Callbacks->m_DrawLines && IsVisible(0.5f * (p1 + p2), 0.5f * (p2 - p1).Length()))
         {
             float inv_scale = m_Callbacks->m_InvScale;
             dmVMath::Point3 points[2];
@@ -51,6 +51,11 @@ namespace dmPhysics
         virtual void DrawArrow(const b2Vec2& p, const b2Vec2& d, const b2Color& color);
 
     private:
+        /// Test if a circle (in physics units) is visible, see DebugCallbacks::m_IsVisible
+        bool IsVisible(const b2Vec2& center, float32 radius);
+        /// Test if the bounds of the vertices are visible
+        bool IsVisible(const b2Vec2* vertices, int32 vertexCount);
+
         DebugCallbacks* m_Callbacks;
     };
 }
@@ -31,9 +31,19 @@ namespace dmPhysics
 
     }
 
+    bool DebugDraw3D::IsVisible(const btVector3& center, btScalar radius)
+    {
+        if (!m_Callbacks->m_IsVisible)
+            return true;
+        float inv_scale = m_Callbacks->m_InvScale;
+        dmVMath::Point3 c;
+        FromBt(center, c, inv_scale);
+        return (*m_Callbacks->m_IsVisible)(c, radius * inv_scale, m_Callbacks->m_UserData);
+    }
+
     void DebugDraw3D::drawLine(const btVector3 &from, const btVector3 &to, const btVector3 &color)
     {
-        if (m_Callbacks->m_DrawLines != 0x0)
+        if (m_Callbacks->m_DrawLines != 0x0 && IsVisible(0.5f * (from + to), 0.5f * (to - from).length()))
         {
             float inv_scale = m_Callbacks->m_InvScale;
             dmVMath::Point3 points[2];
@@ -43,6 +53,33 @@ namespace dmPhysics
         }
     }
 
+    void DebugDraw3D::drawBox(const btVector3& bbMin, const btVector3& bbMax, const btTransform& trans, const btVector3& color)
+    {
+        // Cull the whole box once and submit its twelve edges in one batch, instead of going through drawLine per edge
+        if (m_Callbacks->m_DrawLines != 0x0 && IsVisible(trans * (0.5f * (bbMin + bbMax)), 0.5f * (bbMax - bbMin).length()))
+        {
+            float inv_scale = m_Callbacks->m_InvScale;
+            dmVMath::Point3 corners[8];
+            for (uint32_t i = 0; i < 8; ++i)
+            {
+                btVector3 corner((i & 1) ? bbMax.getX() : bbMin.getX(), (i & 2) ? bbMax.getY() : bbMin.getY(), (i & 4) ? bbMax.getZ() : bbMin.getZ());
+                FromBt(trans * corner, corners[i], inv_scale);
+            }
+            static const uint8_t edges[24] =
+            {
+                0, 1,  1, 3,  3, 2,  2, 0, // bottom
+                4, 5,  5, 7,  7, 6,  6, 4, // top
+                0, 4,  1, 5,  3, 7,  2, 6, // sides
+            };
+            dmVMath::Point3 points[24];
+            for (uint32_t i = 0; i < 24; ++i)
+            {
+                points[i] = corners[edges[i]];
+            }
+            (*m_Callbacks->m_DrawLines)(points, 24, dmVMath::Vector4(color.getX(), color.getY(), color.getZ(), m_Callbacks->m_Alpha), m_Callbacks->m_UserData);
+        }
+    }
+
     void DebugDraw3D::drawContactPoint(const btVector3 &pointOnB, const btVector3 &normalOnB, btScalar distance, int lifeTime, const btVector3 &color)
     {
         dmVMath::Point3 p;
@@ -32,6 +32,7 @@ namespace dmPhysics
         virtual ~DebugDraw3D();
 
         virtual void drawLine(const btVector3 &from, const btVector3 &to, const btVector3 &color);
+        virtual void drawBox(const btVector3& bbMin, const btVector3& bbMax, const btTransform& trans, const btVector3& color);
         virtual void drawContactPoint(const btVector3 &PointOnB, const btVector3 &normalOnB, btScalar distance, int lifeTime, const btVector3 &color);
         virtual void reportErrorWarning(const char *warningString);
         virtual void draw3dText(const btVector3 &location, const char *textString);
@@ -39,6 +40,9 @@ namespace dmPhysics
         virtual int getDebugMode() const;
 
     private:
+        /// Test if a sphere (in physics units) is visible, see DebugCallbacks::m_IsVisible
+        bool IsVisible(const btVector3& center, btScalar radius);
+
         DebugCallbacks* m_Callbacks;
         int m_DebugMode;
     };
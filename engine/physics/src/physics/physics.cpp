@@ -20,7 +20,9 @@
 
 #include <dlib/array.h>
 #include <dlib/log.h>
+#include <dlib/math.h>
 #include <dlib/profile.h>
+#include <dlib/static_assert.h>
 
 namespace dmPhysics
 {
@@ -246,4 +248,100 @@ namespace dmPhysics
         context.m_Cache = cache;
         cache->m_OverlapCache.Iterate(PruneOverlap, &context);
     }
+
+    /**
+     * An entry of the cache, followed by its overlaps, in a saved world state.
+     */
+    struct OverlapEntryState
+    {
+        uintptr_t   m_Object;
+        void*       m_UserData;
+        uint32_t    m_OverlapCount;
+        uint16_t    m_Group;
+    };
+
+    static void SaveEntry(dmArray<uint8_t>* state, const uintptr_t* key, OverlapEntry* value)
+    {
+        uint32_t size = sizeof(OverlapEntryState) + value->m_OverlapCount * sizeof(Overlap);
+        if (state->Remaining() < size)
+            state->OffsetCapacity(dmMath::Max(size, state->Capacity()));
+        uint32_t offset = state->Size();
+        state->SetSize(offset + size);
+        OverlapEntryState* entry = (OverlapEntryState*)(state->Begin() + offset);
+        memset(entry, 0, sizeof(OverlapEntryState));
+        entry->m_Object = *key;
+        entry->m_UserData = value->m_UserData;
+        entry->m_OverlapCount = value->m_OverlapCount;
+        entry->m_Group = value->m_Group;
+        memcpy(entry + 1, value->m_Overlaps, value->m_OverlapCount * sizeof(Overlap));
+    }
+
+    void OverlapCacheSave(const OverlapCache* cache, dmArray<uint8_t>& state)
+    {
+        DM_STATIC_ASSERT(sizeof(OverlapEntryState) % 8 == 0 && sizeof(Overlap) % 8 == 0, Invalid_Struct_Size);
+        cache->m_OverlapCache.Iterate(SaveEntry, &state);
+    }
+
+    static void FreeEntry(void* context, const uintptr_t* key, OverlapEntry* value)
+    {
+        free(value->m_Overlaps);
+    }
+
+    bool OverlapCacheRestore(OverlapCache* cache, const uint8_t* state, uint32_t size)
+    {
+        uint32_t entry_count = 0;
+        uint32_t offset = 0;
+        while (offset < size)
+        {
+            if (offset + sizeof(OverlapEntryState) > size)
+                return false;
+            const OverlapEntryState* entry = (const OverlapEntryState*)(state + offset);
+            if (entry->m_OverlapCount > cache->m_TriggerOverlapCapacity)
+                return false;
+            offset += sizeof(OverlapEntryState) + entry->m_OverlapCount * sizeof(Overlap);
+            ++entry_count;
+        }
+        if (offset != size)
+            return false;
+
+        cache->m_OverlapCache.Iterate(FreeEntry, (void*)0x0);
+        cache->m_OverlapCache.Clear();
+        uint32_t capacity = cache->m_OverlapCache.Capacity();
+        if (entry_count > 3 * capacity / 4)
+        {
+            capacity = entry_count + CACHE_EXPANSION;
+            cache->m_OverlapCache.SetCapacity(3 * capacity / 4, capacity);
+        }
+        offset = 0;
+        while (offset < size)
+        {
+            const OverlapEntryState* entry_state = (const OverlapEntryState*)(state + offset);
+            OverlapEntry entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.m_Overlaps = (Overlap*)malloc(cache->m_TriggerOverlapCapacity * sizeof(Overlap));
+            entry.m_UserData = entry_state->m_UserData;
+            entry.m_OverlapCount = entry_state->m_OverlapCount;
+            entry.m_Group = entry_state->m_Group;
+            memcpy(entry.m_Overlaps, entry_state + 1, entry.m_OverlapCount * sizeof(Overlap));
+            cache->m_OverlapCache.Put(entry_state->m_Object, entry);
+            offset += sizeof(OverlapEntryState) + entry.m_OverlapCount * sizeof(Overlap);
+        }
+        return true;
+    }
+
+    void PushOverlapResponse(dmArray<OverlapResponse>& results, void* user_data, uint16_t group)
+    {
+        // The shapes of an object (or the cells of a grid) are reported separately by the broadphase
+        uint32_t size = results.Size();
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            const OverlapResponse& response = results[i];
+            if (response.m_CollisionObjectUserData == user_data && response.m_CollisionObjectGroup == group)
+                return;
+        }
+        OverlapResponse response;
+        response.m_CollisionObjectUserData = user_data;
+        response.m_CollisionObjectGroup = group;
+        results.PushGrow(response);
+    }
 }
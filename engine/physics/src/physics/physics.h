@@ -20,6 +20,7 @@
 #include <dmsdk/dlib/vmath.h>
 
 #include <dlib/hash.h>
+#include <dlib/job_thread.h>
 #include <dlib/message.h>
 #include <dlib/transform.h>
 
@@ -116,6 +117,24 @@ namespace dmPhysics
         uint8_t m_Padding : 5;
     };
 
+    /**
+     * Cell edit for SetGridShapeHulls
+     */
+    struct GridShapeHullDesc
+    {
+        /// Index of the grid shape in the collision object
+        uint32_t    m_ShapeIndex;
+        uint32_t    m_Row;
+        uint32_t    m_Column;
+        /// Hull index, or GRIDSHAPE_EMPTY_CELL to clear the cell
+        uint32_t    m_Hull;
+        /// Collision group of the cell
+        uint16_t    m_Group;
+        /// Collision mask of the cell
+        uint16_t    m_Mask;
+        HullFlags   m_Flags;
+    };
+
     /**
      * Callback used to propagate the world transform of an external object into the physics simulation.
      *
@@ -247,6 +266,11 @@ namespace dmPhysics
         uint32_t m_RayCastLimit3D;
         /// Maximum number of overlapping triggers
         uint32_t m_TriggerOverlapCapacity;
+        /// Job threads used to step the worlds in parallel, see m_WorkerCount
+        dmJobThread::HContext m_JobThread;
+        /// Number of tasks the islands of a 2D world are solved in. The 3D worlds integrate their bodies on the
+        /// job threads when it is above 0. If 0, or if there is no job thread, the worlds are stepped on the calling thread only.
+        uint32_t m_WorkerCount;
         /// If true, the collision objects will retrieve the position of its game object
         uint8_t m_AllowDynamicTransforms:1;
         uint8_t :7;
@@ -399,6 +423,38 @@ namespace dmPhysics
      */
     void StepWorld2D(HWorld2D world, const StepWorldContext& context);
 
+    /**
+     * Save the simulation state of a 2D world into a flat memory blob, for rolling the world back with RestoreWorld2D.
+     * The state holds the body transforms and velocities, the contacts with the impulses used for warm starting,
+     * the joint impulses and the trigger overlaps. The shapes and the collision objects themselves are not saved.
+     *
+     * @param world Physics world
+     * @param state Array receiving the state, grown if needed
+     */
+    void SnapshotWorld2D(HWorld2D world, dmArray<uint8_t>& state);
+
+    /**
+     * Restore the simulation state of a 2D world saved by SnapshotWorld2D. The world must have the same collision objects,
+     * shapes and joints as when the state was saved, and the collision objects must have been created in the same order.
+     * No contact or trigger callbacks are called when restoring.
+     *
+     * @param world Physics world
+     * @param state State saved by SnapshotWorld2D
+     * @param state_size Size of the state in bytes
+     * @return true if the state was restored, false if it did not match the world, which is then left unchanged
+     */
+    bool RestoreWorld2D(HWorld2D world, const uint8_t* state, uint32_t state_size);
+
+    /**
+     * Set if a 2D world should always be stepped serially on the calling thread, even when the context has worker threads.
+     * The parallel step is not bit-identical to the serial one, so a world that must be stepped to the same result on
+     * every machine, e.g. when re-simulating after RestoreWorld2D in a networked game, should be deterministic.
+     *
+     * @param world Physics world
+     * @param deterministic true to always step the world serially
+     */
+    void SetDeterministicStep2D(HWorld2D world, bool deterministic);
+
     /**
      * Enable/disable debug-draw
      * @param world Physics world
@@ -528,6 +584,17 @@ namespace dmPhysics
      */
     bool SetGridShapeHull(HCollisionObject2D collision_object, uint32_t shape_index, uint32_t row, uint32_t column, uint32_t hull, HullFlags flags);
 
+    /**
+     * Set the hulls and collision filters of many cells in the grid shapes of a collision object.
+     * Only the proxies and contacts of the edited cells are updated, once per grid shape, instead of
+     * all the contacts of a grid shape per cell, as when calling SetGridShapeHull and SetCollisionObjectFilter.
+     * @param collision_object collision object
+     * @param hulls cell edits, applied in order
+     * @param hull_count number of cell edits
+     * @return false if any of the shapes is not a grid shape, in which case the other edits are still applied
+     */
+    bool SetGridShapeHulls(HCollisionObject2D collision_object, const GridShapeHullDesc* hulls, uint32_t hull_count);
+
     /**
      * Enable or disable a grid shape (layer)
      * @param shape_index index of the collision shape
@@ -1178,6 +1245,111 @@ namespace dmPhysics
      */
     void RayCast2D(HWorld2D world, const RayCastRequest& request, dmArray<RayCastResponse>& results);
 
+    /**
+     * Perform a batch of synchronous ray casts, each returning its closest hit. The rays are cast
+     * in parallel on the job threads of the context, if there are enough of them.
+     *
+     * @param world Physics world in which to perform the ray casts
+     * @param requests Array of queries, RayCastRequest::m_ReturnAllResults is ignored
+     * @param count Number of queries
+     * @param responses Array receiving one response per query. m_Hit is 0 if the ray (or a ray of 0 length) didn't hit anything
+     */
+    void RayCastBatch3D(HWorld3D world, const RayCastRequest* requests, uint32_t count, RayCastResponse* responses);
+
+    /**
+     * Perform a batch of synchronous ray casts, each returning its closest hit. The rays are cast
+     * in parallel on the job threads of the context, if there are enough of them.
+     *
+     * @param world Physics world in which to perform the ray casts
+     * @param requests Array of queries, RayCastRequest::m_ReturnAllResults is ignored
+     * @param count Number of queries
+     * @param responses Array receiving one response per query. m_Hit is 0 if the ray (or a ray of 0 length) didn't hit anything
+     */
+    void RayCastBatch2D(HWorld2D world, const RayCastRequest* requests, uint32_t count, RayCastResponse* responses);
+
+    /**
+     * Container of data for overlap query results.
+     */
+    struct OverlapResponse
+    {
+        /// User specified data for the overlapping object
+        void* m_CollisionObjectUserData;
+        /// Group of the overlapping object
+        uint16_t m_CollisionObjectGroup;
+    };
+
+    /**
+     * Find the collision objects with bounding boxes overlapping a box, by querying the broadphase directly.
+     * Trigger objects aren't reported, the same as for ray casts.
+     *
+     * @param world Physics world in which to perform the query
+     * @param min Minimum corner of the box
+     * @param max Maximum corner of the box
+     * @param mask Bit field to filter out collision objects of the corresponding groups
+     * @param results Array receiving one response per overlapping object and group. The array is cleared first
+     * @note The result array may grow during the call
+     */
+    void QueryAABB3D(HWorld3D world, const dmVMath::Point3& min, const dmVMath::Point3& max, uint16_t mask, dmArray<OverlapResponse>& results);
+
+    /**
+     * Find the collision objects with bounding boxes overlapping a box, by querying the broadphase directly.
+     * Trigger objects aren't reported, the same as for ray casts.
+     *
+     * @param world Physics world in which to perform the query
+     * @param min Minimum corner of the box, z is ignored
+     * @param max Maximum corner of the box, z is ignored
+     * @param mask Bit field to filter out collision objects of the corresponding groups
+     * @param results Array receiving one response per overlapping object and group. The array is cleared first
+     * @note The result array may grow during the call
+     */
+    void QueryAABB2D(HWorld2D world, const dmVMath::Point3& min, const dmVMath::Point3& max, uint16_t mask, dmArray<OverlapResponse>& results);
+
+    /**
+     * Find the collision objects with shapes overlapping an oriented box. See QueryAABB3D.
+     *
+     * @param world Physics world in which to perform the query
+     * @param position Center of the box
+     * @param rotation Rotation of the box
+     * @param half_extents Half the size of the box
+     * @param mask Bit field to filter out collision objects of the corresponding groups
+     * @param results Array receiving one response per overlapping object and group. The array is cleared first
+     */
+    void QueryBox3D(HWorld3D world, const dmVMath::Point3& position, const dmVMath::Quat& rotation, const dmVMath::Vector3& half_extents, uint16_t mask, dmArray<OverlapResponse>& results);
+
+    /**
+     * Find the collision objects with shapes overlapping an oriented box. See QueryAABB2D.
+     *
+     * @param world Physics world in which to perform the query
+     * @param position Center of the box, z is ignored
+     * @param rotation Rotation of the box, only the rotation around the z-axis is used
+     * @param half_extents Half the size of the box, z is ignored
+     * @param mask Bit field to filter out collision objects of the corresponding groups
+     * @param results Array receiving one response per overlapping object and group. The array is cleared first
+     */
+    void QueryBox2D(HWorld2D world, const dmVMath::Point3& position, const dmVMath::Quat& rotation, const dmVMath::Vector3& half_extents, uint16_t mask, dmArray<OverlapResponse>& results);
+
+    /**
+     * Find the collision objects with shapes overlapping a sphere. See QueryAABB3D.
+     *
+     * @param world Physics world in which to perform the query
+     * @param position Center of the sphere
+     * @param radius Radius of the sphere
+     * @param mask Bit field to filter out collision objects of the corresponding groups
+     * @param results Array receiving one response per overlapping object and group. The array is cleared first
+     */
+    void QuerySphere3D(HWorld3D world, const dmVMath::Point3& position, float radius, uint16_t mask, dmArray<OverlapResponse>& results);
+
+    /**
+     * Find the collision objects with shapes overlapping a circle. See QueryAABB2D.
+     *
+     * @param world Physics world in which to perform the query
+     * @param position Center of the circle, z is ignored
+     * @param radius Radius of the circle
+     * @param mask Bit field to filter out collision objects of the corresponding groups
+     * @param results Array receiving one response per overlapping object and group. The array is cleared first
+     */
+    void QueryCircle2D(HWorld2D world, const dmVMath::Point3& position, float radius, uint16_t mask, dmArray<OverlapResponse>& results);
+
     /**
      * Set the gravity for a 2D physics world.
      *
@@ -1234,6 +1406,15 @@ namespace dmPhysics
          * @param user_data User data as supplied when registering the drawing callbacks
          */
         void (*m_DrawTriangles)(dmVMath::Point3* points, uint32_t point_count, dmVMath::Vector4 color, void* user_data);
+        /**
+         * Optional callback to test if a bounding sphere is visible. Debug geometry outside the view is skipped before it is generated.
+         *
+         * @param center Center of the sphere, in game world units
+         * @param radius Radius of the sphere, in game world units
+         * @param user_data User data as supplied when registering the drawing callbacks
+         * @return true if the sphere is visible
+         */
+        bool (*m_IsVisible)(dmVMath::Point3 center, float radius, void* user_data);
         /// User data to be supplied to the callbacks
         void* m_UserData;
         /// Alpha to use for everything rendered
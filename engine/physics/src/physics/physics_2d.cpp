@@ -20,6 +20,7 @@
 #include <dlib/array.h>
 #include <dlib/log.h>
 #include <dlib/math.h>
+#include <dlib/memory.h>
 #include <dlib/profile.h>
 
 #include <Box2D/Box2D.h>
@@ -42,6 +43,8 @@ namespace dmPhysics
     , m_TriggerEnterLimit(0.0f)
     , m_RayCastLimit(0)
     , m_TriggerOverlapCapacity(0)
+    , m_JobThread(0)
+    , m_WorkerCount(0)
     , m_AllowDynamicTransforms(0)
     {
 
@@ -54,6 +57,7 @@ namespace dmPhysics
     , m_RayCastRequests()
     , m_DebugDraw(&context->m_DebugCallbacks)
     , m_ContactListener(this)
+    , m_TaskExecutor(context->m_JobThread)
     , m_GetWorldTransformCallback(params.m_GetWorldTransformCallback)
     , m_SetWorldTransformCallback(params.m_SetWorldTransformCallback)
     , m_AllowDynamicTransforms(context->m_AllowDynamicTransforms)
@@ -203,6 +207,31 @@ namespace dmPhysics
         m_TempStepWorldContext = context;
     }
 
+    TaskExecutor2D::TaskExecutor2D(dmJobThread::HContext job_thread)
+    : m_JobThread(job_thread)
+    {
+    }
+
+    struct ParallelForContext
+    {
+        b2TaskFn    m_Fn;
+        void*       m_Context;
+    };
+
+    static void ParallelForRange(void* _context, uint32_t begin, uint32_t end)
+    {
+        ParallelForContext* context = (ParallelForContext*)_context;
+        context->m_Fn(context->m_Context, (int32)begin, (int32)end);
+    }
+
+    void TaskExecutor2D::ParallelFor(int32 count, int32 grain, b2TaskFn fn, void* context)
+    {
+        ParallelForContext parallel_context;
+        parallel_context.m_Fn = fn;
+        parallel_context.m_Context = context;
+        dmJobThread::ParallelFor(m_JobThread, (uint32_t)count, (uint32_t)grain, ParallelForRange, &parallel_context);
+    }
+
     HContext2D NewContext2D(const NewContextParams& params)
     {
         if (params.m_Scale < MIN_SCALE || params.m_Scale > MAX_SCALE)
@@ -220,6 +249,8 @@ namespace dmPhysics
         context->m_RayCastLimit = params.m_RayCastLimit2D;
         context->m_TriggerOverlapCapacity = params.m_TriggerOverlapCapacity;
         context->m_VelocityThreshold = params.m_VelocityThreshold;
+        context->m_JobThread = params.m_JobThread;
+        context->m_WorkerCount = params.m_WorkerCount;
         context->m_AllowDynamicTransforms = params.m_AllowDynamicTransforms;
         b2ContactSolver::setVelocityThreshold(params.m_VelocityThreshold * params.m_Scale); // overrides fixed b2_velocityThreshold in b2Settings.h. Includes compensation for the scale factor so that velocityThreshold corresponds to the velocity values used in the game.
         dmMessage::Result result = dmMessage::NewSocket(PHYSICS_SOCKET_NAME, &context->m_Socket);
@@ -252,6 +283,7 @@ namespace dmPhysics
 
     HWorld2D NewWorld2D(HContext2D context, const NewWorldParams& params)
     {
+        DM_MEMORY_TAG(dmMemory::TAG_PHYSICS);
         if (context->m_Worlds.Full())
         {
             dmLogError("%s", "Physics world buffer full, world could not be created.");
@@ -261,11 +293,28 @@ namespace dmPhysics
         world->m_World.SetDebugDraw(&world->m_DebugDraw);
         world->m_World.SetContactListener(&world->m_ContactListener);
         world->m_World.SetContinuousPhysics(false);
+        if (context->m_JobThread && context->m_WorkerCount > 0)
+        {
+            world->m_World.SetTaskExecutor(&world->m_TaskExecutor, context->m_WorkerCount);
+        }
 
         context->m_Worlds.Push(world);
         return world;
     }
 
+    void SetDeterministicStep2D(HWorld2D world, bool deterministic)
+    {
+        HContext2D context = world->m_Context;
+        if (!deterministic && context->m_JobThread && context->m_WorkerCount > 0)
+        {
+            world->m_World.SetTaskExecutor(&world->m_TaskExecutor, context->m_WorkerCount);
+        }
+        else
+        {
+            world->m_World.SetTaskExecutor(0x0, 0);
+        }
+    }
+
     void DeleteWorld2D(HContext2D context, HWorld2D world)
     {
         for (uint32_t i = 0; i < context->m_Worlds.Size(); ++i)
@@ -371,11 +420,8 @@ namespace dmPhysics
         return dmMath::Min(v[0], v[1]);
     }
 
-    static void UpdateScale(HWorld2D world, b2Body* body)
+    static void UpdateScale(b2Body* body, dmTransform::Transform& world_transform)
     {
-        dmTransform::Transform world_transform;
-        (*world->m_GetWorldTransformCallback)(body->GetUserData(), world_transform);
-
         float object_scale = GetUniformScale2D(world_transform);
 
         b2Fixture* fix = body->GetFixtureList();
@@ -417,8 +463,29 @@ namespace dmPhysics
         }
     }
 
+    // Update transforms of dynamic bodies
+    static void UpdateDynamicTransforms(World2D* world)
+    {
+        if (world->m_SetWorldTransformCallback)
+        {
+            float inv_scale = world->m_Context->m_InvScale;
+            for (b2Body* body = world->m_World.GetBodyList(); body; body = body->GetNext())
+            {
+                // Sleeping bodies haven't moved since their transform was last written
+                if (body->GetType() == b2_dynamicBody && body->IsActive() && body->IsAwake())
+                {
+                    Point3 position;
+                    FromB2(body->GetPosition(), position, inv_scale);
+                    Quat rotation = Quat::rotationZ(body->GetAngle());
+                    (*world->m_SetWorldTransformCallback)(body->GetUserData(), position, rotation);
+                }
+            }
+        }
+    }
+
     void StepWorld2D(HWorld2D world, const StepWorldContext& step_context)
     {
+        DM_MEMORY_TAG(dmMemory::TAG_PHYSICS);
         float dt = step_context.m_DT;
         HContext2D context = world->m_Context;
         float scale = context->m_Scale;
@@ -434,11 +501,13 @@ namespace dmPhysics
             {
                 bool retrieve_gameworld_transform = world->m_AllowDynamicTransforms && body->GetType() != b2_staticBody;
 
+                // Fetched once, and reused for the scaling
+                dmTransform::Transform world_transform;
+
                 // translate & rotation
                 if (retrieve_gameworld_transform || body->GetType() == b2_kinematicBody)
                 {
                     Point3 old_position = GetWorldPosition2D(context, body);
-                    dmTransform::Transform world_transform;
                     (*world->m_GetWorldTransformCallback)(body->GetUserData(), world_transform);
                     Point3 position = Point3(world_transform.GetTranslation());
                     // Ignore z-component
@@ -456,8 +525,9 @@ namespace dmPhysics
                         body->SetTransform(b2_position, angle);
                         body->SetSleepingAllowed(false);
                     }
-                    else
+                    else if (!body->IsSleepingAllowed())
                     {
+                        // Unchanged, let the body fall asleep so it isn't simulated
                         body->SetSleepingAllowed(true);
                     }
                 }
@@ -465,7 +535,7 @@ namespace dmPhysics
                 // Scaling
                 if(retrieve_gameworld_transform)
                 {
-                    UpdateScale(world, body);
+                    UpdateScale(body, world_transform);
                 }
             }
         }
@@ -473,21 +543,7 @@ namespace dmPhysics
             DM_PROFILE("StepSimulation");
             world->m_ContactListener.SetStepWorldContext(&step_context);
             world->m_World.Step(dt, 10, 10);
-            float inv_scale = world->m_Context->m_InvScale;
-            // Update transforms of dynamic bodies
-            if (world->m_SetWorldTransformCallback)
-            {
-                for (b2Body* body = world->m_World.GetBodyList(); body; body = body->GetNext())
-                {
-                    if (body->GetType() == b2_dynamicBody && body->IsActive())
-                    {
-                        Point3 position;
-                        FromB2(body->GetPosition(), position, inv_scale);
-                        Quat rotation = Quat::rotationZ(body->GetAngle());
-                        (*world->m_SetWorldTransformCallback)(body->GetUserData(), position, rotation);
-                    }
-                }
-            }
+            UpdateDynamicTransforms(world);
         }
         // Perform requested ray casts
         uint32_t size = world->m_RayCastRequests.Size();
@@ -536,6 +592,52 @@ namespace dmPhysics
         world->m_World.DrawDebugData();
     }
 
+    // A saved 2D world state is the header, followed by the trigger overlaps and the Box2D world state
+    struct WorldState2DHeader
+    {
+        uint32_t m_OverlapsSize;
+        uint32_t m_WorldSize;
+    };
+
+    void SnapshotWorld2D(HWorld2D world, dmArray<uint8_t>& state)
+    {
+        DM_PROFILE("SnapshotWorld2D");
+        state.SetSize(0);
+        if (state.Capacity() < sizeof(WorldState2DHeader))
+            state.SetCapacity(sizeof(WorldState2DHeader));
+        state.SetSize(sizeof(WorldState2DHeader));
+        OverlapCacheSave(&world->m_TriggerOverlaps, state);
+        uint32_t offset = state.Size();
+
+        uint32_t world_size = (uint32_t)world->m_World.GetStateSize();
+        if (state.Remaining() < world_size)
+            state.OffsetCapacity(world_size - state.Remaining());
+        state.SetSize(offset + world_size);
+        world->m_World.SaveState(state.Begin() + offset);
+
+        WorldState2DHeader* header = (WorldState2DHeader*)state.Begin();
+        header->m_OverlapsSize = offset - sizeof(WorldState2DHeader);
+        header->m_WorldSize = world_size;
+    }
+
+    bool RestoreWorld2D(HWorld2D world, const uint8_t* state, uint32_t state_size)
+    {
+        DM_PROFILE("RestoreWorld2D");
+        if (state_size < sizeof(WorldState2DHeader))
+            return false;
+        const WorldState2DHeader* header = (const WorldState2DHeader*)state;
+        if (sizeof(WorldState2DHeader) + header->m_OverlapsSize + header->m_WorldSize != state_size)
+            return false;
+        const uint8_t* overlaps = state + sizeof(WorldState2DHeader);
+        if (!world->m_World.RestoreState(overlaps + header->m_OverlapsSize, (int32)header->m_WorldSize))
+            return false;
+        if (!OverlapCacheRestore(&world->m_TriggerOverlaps, overlaps, header->m_OverlapsSize))
+            return false;
+        // Write the restored transforms to the game objects, as after a step
+        UpdateDynamicTransforms(world);
+        return true;
+    }
+
     void UpdateOverlapCache(OverlapCache* cache, HContext2D context, b2Contact* contact_list, const StepWorldContext& step_context)
     {
         DM_PROFILE("TriggerCallbacks");
@@ -698,6 +800,75 @@ namespace dmPhysics
         return true;
     }
 
+    static int Sort_Child(const int32* a, const int32* b)
+    {
+        return *a - *b;
+    }
+
+    static void SetGridShapeHulls(b2Body* body, b2Fixture* fixture, const GridShapeHullDesc* hulls, uint32_t hull_count, dmArray<int32>& children)
+    {
+        b2GridShape* grid_shape = (b2GridShape*) fixture->GetShape();
+        uint32_t shape_index = hulls[0].m_ShapeIndex;
+        children.SetSize(0);
+        for (uint32_t i = 0; i < hull_count; ++i)
+        {
+            const GridShapeHullDesc& desc = hulls[i];
+            if (desc.m_ShapeIndex != shape_index)
+                continue;
+            b2GridShape::CellFlags f;
+            f.m_FlipHorizontal = desc.m_Flags.m_FlipHorizontal;
+            f.m_FlipVertical = desc.m_Flags.m_FlipVertical;
+            f.m_Rotate90 = desc.m_Flags.m_Rotate90;
+            uint32_t child = desc.m_Row * grid_shape->m_columnCount + desc.m_Column;
+            grid_shape->SetCell(child, desc.m_Hull, f);
+            b2Filter filter = fixture->GetFilterData(child);
+            filter.categoryBits = desc.m_Group;
+            filter.maskBits = desc.m_Mask;
+            fixture->SetChildFilterData(filter, child);
+            children.Push((int32)child);
+        }
+        // A cell can be edited more than once
+        qsort(children.Begin(), children.Size(), sizeof(int32), (int(*)(const void*, const void*))Sort_Child);
+        uint32_t child_count = 0;
+        for (uint32_t i = 0; i < children.Size(); ++i)
+        {
+            if (child_count == 0 || children[child_count - 1] != children[i])
+                children[child_count++] = children[i];
+        }
+        children.SetSize(child_count);
+        body->SynchronizeChildren(fixture, children.Begin(), children.Size());
+        fixture->RefilterChildren(children.Begin(), children.Size());
+    }
+
+    bool SetGridShapeHulls(HCollisionObject2D collision_object, const GridShapeHullDesc* hulls, uint32_t hull_count)
+    {
+        DM_PROFILE("SetGridShapeHulls");
+        b2Body* body = (b2Body*) collision_object;
+        dmArray<int32> children;
+        children.SetCapacity(hull_count);
+        bool result = true;
+        // The edits are applied one grid shape at a time, starting with the first edit of each shape
+        for (uint32_t i = 0; i < hull_count; ++i)
+        {
+            uint32_t shape_index = hulls[i].m_ShapeIndex;
+            bool done = false;
+            for (uint32_t j = 0; j < i && !done; ++j)
+            {
+                done = hulls[j].m_ShapeIndex == shape_index;
+            }
+            if (done)
+                continue;
+            b2Fixture* fixture = GetFixture(body, shape_index);
+            if (fixture == 0 || fixture->GetShape()->GetType() != b2Shape::e_grid)
+            {
+                result = false;
+                continue;
+            }
+            SetGridShapeHulls(body, fixture, hulls + i, hull_count - i, children);
+        }
+        return result;
+    }
+
     bool SetGridShapeEnable(HCollisionObject2D collision_object, uint32_t shape_index, uint32_t enable)
     {
         b2Body* body = (b2Body*) collision_object;
@@ -1420,6 +1591,171 @@ namespace dmPhysics
         }
     }
 
+    // Number of rays per task when ray casting a batch
+    static const uint32_t RAY_CAST_BATCH_GRAIN = 16;
+
+    struct RayCastBatchContext2D
+    {
+        HWorld2D                m_World;
+        const RayCastRequest*   m_Requests;
+        RayCastResponse*        m_Responses;
+    };
+
+    // The queries only read the world, so the rays can be cast in parallel
+    static void RayCastBatchRange2D(void* _context, uint32_t begin, uint32_t end)
+    {
+        RayCastBatchContext2D* context = (RayCastBatchContext2D*)_context;
+        HWorld2D world = context->m_World;
+        float scale = world->m_Context->m_Scale;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const RayCastRequest& request = context->m_Requests[i];
+            RayCastResponse& response = context->m_Responses[i];
+            response.m_Hit = 0;
+
+            const Point3 from2d = Point3(request.m_From.getX(), request.m_From.getY(), 0.0);
+            const Point3 to2d = Point3(request.m_To.getX(), request.m_To.getY(), 0.0);
+            if (lengthSqr(to2d - from2d) <= 0.0f)
+            {
+                continue;
+            }
+
+            ProcessRayCastResultCallback2D query;
+            query.m_Request = &request;
+            query.m_Context = world->m_Context;
+            query.m_IgnoredUserData = request.m_IgnoredUserData;
+            query.m_CollisionMask = request.m_Mask;
+            query.m_Response.m_Hit = 0;
+            b2Vec2 from;
+            ToB2(from2d, from, scale);
+            b2Vec2 to;
+            ToB2(to2d, to, scale);
+            world->m_World.RayCast(&query, from, to);
+            if (query.m_Response.m_Hit)
+            {
+                response = query.m_Response;
+            }
+        }
+    }
+
+    void RayCastBatch2D(HWorld2D world, const RayCastRequest* requests, uint32_t count, RayCastResponse* responses)
+    {
+        DM_PROFILE("RayCastBatch2D");
+
+        RayCastBatchContext2D context;
+        context.m_World = world;
+        context.m_Requests = requests;
+        context.m_Responses = responses;
+        dmJobThread::ParallelFor(world->m_Context->m_JobThread, count, RAY_CAST_BATCH_GRAIN, RayCastBatchRange2D, &context);
+    }
+
+    // Collects the fixtures in the broadphase overlapping the query bounds, and optionally a query shape
+    struct OverlapQueryCallback2D
+    {
+        bool QueryCallback(int32 proxy_id)
+        {
+            b2FixtureProxy* proxy = (b2FixtureProxy*)m_BroadPhase->GetUserData(proxy_id);
+            b2Fixture* fixture = proxy->fixture;
+            int32 index = proxy->childIndex;
+            // Never report triggers
+            if (fixture->IsSensor())
+                return true;
+            uint16_t group = fixture->GetFilterData(index).categoryBits;
+            if ((group & m_Mask) == 0)
+                return true;
+            // The broadphase stores enlarged bounds
+            if (!b2TestOverlap(proxy->aabb, m_AABB))
+                return true;
+
+            const b2Shape* shape = fixture->GetShape();
+            b2PolygonShape cell_shape;
+            if (shape->GetType() == b2Shape::e_grid)
+            {
+                const b2GridShape* grid_shape = (const b2GridShape*)shape;
+                if (grid_shape->m_cells[index].m_Index == B2GRIDSHAPE_EMPTY_CELL)
+                    return true;
+                if (m_Shape != 0x0)
+                {
+                    grid_shape->GetPolygonShapeForCell(index, cell_shape);
+                    shape = &cell_shape;
+                    index = 0;
+                }
+            }
+            if (m_Shape != 0x0 && !b2TestOverlap(shape, index, m_Shape, 0, fixture->GetBody()->GetTransform(), m_Transform))
+                return true;
+
+            PushOverlapResponse(*m_Results, fixture->GetBody()->GetUserData(), group);
+            return true;
+        }
+
+        const b2BroadPhase*         m_BroadPhase;
+        b2AABB                      m_AABB;
+        // Shape to test the fixtures against, or 0x0 to only test the bounds
+        const b2Shape*              m_Shape;
+        b2Transform                 m_Transform;
+        dmArray<OverlapResponse>*   m_Results;
+        uint16_t                    m_Mask;
+    };
+
+    static void QueryOverlap2D(HWorld2D world, const b2AABB& aabb, const b2Shape* shape, const b2Transform& transform, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+        results.SetSize(0);
+
+        const b2BroadPhase& broad_phase = world->m_World.GetContactManager().m_broadPhase;
+        OverlapQueryCallback2D query;
+        query.m_BroadPhase = &broad_phase;
+        query.m_AABB = aabb;
+        query.m_Shape = shape;
+        query.m_Transform = transform;
+        query.m_Results = &results;
+        query.m_Mask = mask;
+        broad_phase.Query(&query, aabb);
+    }
+
+    void QueryAABB2D(HWorld2D world, const Point3& min, const Point3& max, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+        DM_PROFILE("QueryAABB2D");
+
+        float scale = world->m_Context->m_Scale;
+        b2AABB aabb;
+        ToB2(min, aabb.lowerBound, scale);
+        ToB2(max, aabb.upperBound, scale);
+        b2Transform transform;
+        transform.SetIdentity();
+        QueryOverlap2D(world, aabb, 0x0, transform, mask, results);
+    }
+
+    void QueryBox2D(HWorld2D world, const Point3& position, const Quat& rotation, const Vector3& half_extents, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+        DM_PROFILE("QueryBox2D");
+
+        float scale = world->m_Context->m_Scale;
+        b2PolygonShape shape;
+        shape.SetAsBox(half_extents.getX() * scale, half_extents.getY() * scale);
+        b2Vec2 b2_position;
+        ToB2(position, b2_position, scale);
+        float angle = atan2(2.0f * (rotation.getW() * rotation.getZ() + rotation.getX() * rotation.getY()), 1.0f - 2.0f * (rotation.getY() * rotation.getY() + rotation.getZ() * rotation.getZ()));
+        b2Transform transform(b2_position, b2Rot(angle));
+        b2AABB aabb;
+        shape.ComputeAABB(&aabb, transform, 0);
+        QueryOverlap2D(world, aabb, &shape, transform, mask, results);
+    }
+
+    void QueryCircle2D(HWorld2D world, const Point3& position, float radius, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+        DM_PROFILE("QueryCircle2D");
+
+        float scale = world->m_Context->m_Scale;
+        b2CircleShape shape;
+        shape.m_radius = radius * scale;
+        b2Vec2 b2_position;
+        ToB2(position, b2_position, scale);
+        b2Transform transform(b2_position, b2Rot(0.0f));
+        b2AABB aabb;
+        shape.ComputeAABB(&aabb, transform, 0);
+        QueryOverlap2D(world, aabb, &shape, transform, mask, results);
+    }
+
     void SetGravity2D(HWorld2D world, const Vector3& gravity)
     {
         b2Vec2 gravity_b;
@@ -42,6 +42,18 @@ namespace dmPhysics
         const StepWorldContext* m_TempStepWorldContext;
     };
 
+    // Runs the parallel parts of the world step on the job threads
+    class TaskExecutor2D : public b2TaskExecutor
+    {
+    public:
+        TaskExecutor2D(dmJobThread::HContext job_thread);
+
+        virtual void ParallelFor(int32 count, int32 grain, b2TaskFn fn, void* context);
+
+    private:
+        dmJobThread::HContext m_JobThread;
+    };
+
     struct World2D
     {
         World2D(HContext2D context, const NewWorldParams& params);
@@ -52,6 +64,7 @@ namespace dmPhysics
         dmArray<RayCastRequest>     m_RayCastRequests;
         DebugDraw2D                 m_DebugDraw;
         ContactListener             m_ContactListener;
+        TaskExecutor2D              m_TaskExecutor;
         GetWorldTransformCallback   m_GetWorldTransformCallback;
         SetWorldTransformCallback   m_SetWorldTransformCallback;
         uint8_t                     m_AllowDynamicTransforms:1;
@@ -73,6 +86,8 @@ namespace dmPhysics
         float                       m_VelocityThreshold;
         int                         m_RayCastLimit;
         int                         m_TriggerOverlapCapacity;
+        dmJobThread::HContext       m_JobThread;
+        uint32_t                    m_WorkerCount;
         uint8_t                     m_AllowDynamicTransforms:1;
         uint8_t                     :7;
     };
@@ -49,6 +49,20 @@ namespace dmPhysics
     {
     }
 
+    void SnapshotWorld2D(HWorld2D world, dmArray<uint8_t>& state)
+    {
+        state.SetSize(0);
+    }
+
+    bool RestoreWorld2D(HWorld2D world, const uint8_t* state, uint32_t state_size)
+    {
+        return false;
+    }
+
+    void SetDeterministicStep2D(HWorld2D world, bool deterministic)
+    {
+    }
+
     void SetDrawDebug2D(HWorld2D world, bool draw_debug)
     {
     }
@@ -96,6 +110,11 @@ namespace dmPhysics
         return false;
     }
 
+    bool SetGridShapeHulls(HCollisionObject2D collision_object, const GridShapeHullDesc* hulls, uint32_t hull_count)
+    {
+        return false;
+    }
+
     bool SetGridShapeEnable(HCollisionObject2D collision_object, uint32_t shape_index, uint32_t enable)
     {
         return false;
@@ -265,6 +284,22 @@ namespace dmPhysics
     {
     }
 
+    void RayCastBatch2D(HWorld2D world, const RayCastRequest* requests, uint32_t count, RayCastResponse* responses)
+    {
+    }
+
+    void QueryAABB2D(HWorld2D world, const dmVMath::Point3& min, const dmVMath::Point3& max, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+    }
+
+    void QueryBox2D(HWorld2D world, const dmVMath::Point3& position, const dmVMath::Quat& rotation, const dmVMath::Vector3& half_extents, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+    }
+
+    void QueryCircle2D(HWorld2D world, const dmVMath::Point3& position, float radius, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+    }
+
     void SetGravity2D(HWorld2D world, const dmVMath::Vector3& gravity)
     {
     }
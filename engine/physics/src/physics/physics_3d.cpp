@@ -18,6 +18,7 @@
 #include <dlib/array.h>
 #include <dlib/log.h>
 #include <dlib/math.h>
+#include <dlib/memory.h>
 #include <dlib/profile.h>
 #include <dmsdk/dlib/vmath.h>
 
@@ -112,6 +113,73 @@ namespace dmPhysics
         SetWorldTransformCallback m_SetWorldTransform;
     };
 
+    static const uint32_t BODY_GRAIN = 64;
+
+    ParallelDynamicsWorld3D::ParallelDynamicsWorld3D(btDispatcher* dispatcher, btBroadphaseInterface* pair_cache, btConstraintSolver* solver,
+                                                     btCollisionConfiguration* collision_configuration, dmJobThread::HContext job_thread)
+    : btDiscreteDynamicsWorld(dispatcher, pair_cache, solver, collision_configuration)
+    , m_JobThread(job_thread)
+    , m_TimeStep(0.0f)
+    {
+    }
+
+    void ParallelDynamicsWorld3D::PredictMotionRange(void* _world, uint32_t begin, uint32_t end)
+    {
+        ParallelDynamicsWorld3D* world = (ParallelDynamicsWorld3D*)_world;
+        btScalar time_step = world->m_TimeStep;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            btRigidBody* body = world->m_nonStaticRigidBodies[i];
+            if (!body->isStaticOrKinematicObject())
+            {
+                body->integrateVelocities(time_step);
+                body->applyDamping(time_step);
+                body->predictIntegratedTransform(time_step, body->getInterpolationWorldTransform());
+            }
+        }
+    }
+
+    void ParallelDynamicsWorld3D::predictUnconstraintMotion(btScalar time_step)
+    {
+        BT_PROFILE("predictUnconstraintMotion");
+        m_TimeStep = time_step;
+        dmJobThread::ParallelFor(m_JobThread, m_nonStaticRigidBodies.size(), BODY_GRAIN, PredictMotionRange, this);
+    }
+
+    void ParallelDynamicsWorld3D::IntegrateTransformsRange(void* _world, uint32_t begin, uint32_t end)
+    {
+        ParallelDynamicsWorld3D* world = (ParallelDynamicsWorld3D*)_world;
+        btScalar time_step = world->m_TimeStep;
+        btTransform predicted_transform;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            btRigidBody* body = world->m_nonStaticRigidBodies[i];
+            body->setHitFraction(1.0f);
+            if (body->isActive() && !body->isStaticOrKinematicObject())
+            {
+                body->predictIntegratedTransform(time_step, predicted_transform);
+                body->proceedToTransform(predicted_transform);
+            }
+        }
+    }
+
+    void ParallelDynamicsWorld3D::integrateTransforms(btScalar time_step)
+    {
+        // The motion clamping sweeps the collision world, which is left to the base world
+        int body_count = m_nonStaticRigidBodies.size();
+        for (int i = 0; i < body_count; ++i)
+        {
+            if (m_nonStaticRigidBodies[i]->getCcdSquareMotionThreshold() != 0.0f)
+            {
+                btDiscreteDynamicsWorld::integrateTransforms(time_step);
+                return;
+            }
+        }
+
+        BT_PROFILE("integrateTransforms");
+        m_TimeStep = time_step;
+        dmJobThread::ParallelFor(m_JobThread, body_count, BODY_GRAIN, IntegrateTransformsRange, this);
+    }
     Context3D::Context3D()
     : m_Worlds()
     , m_DebugCallbacks()
@@ -123,6 +191,8 @@ namespace dmPhysics
     , m_TriggerEnterLimit(0.0f)
     , m_RayCastLimit(0)
     , m_TriggerOverlapCapacity(0)
+    , m_JobThread(0)
+    , m_WorkerCount(0)
     , m_AllowDynamicTransforms(0)
     {
 
@@ -147,7 +217,14 @@ namespace dmPhysics
 
         m_Solver = new btSequentialImpulseConstraintSolver;
 
-        m_DynamicsWorld = new btDiscreteDynamicsWorld(m_Dispatcher, m_OverlappingPairCache, m_Solver, m_CollisionConfiguration);
+        if (context->m_JobThread && context->m_WorkerCount > 0)
+        {
+            m_DynamicsWorld = new ParallelDynamicsWorld3D(m_Dispatcher, m_OverlappingPairCache, m_Solver, m_CollisionConfiguration, context->m_JobThread);
+        }
+        else
+        {
+            m_DynamicsWorld = new btDiscreteDynamicsWorld(m_Dispatcher, m_OverlappingPairCache, m_Solver, m_CollisionConfiguration);
+        }
         m_DynamicsWorld->setGravity(btVector3(context->m_Gravity.getX(), context->m_Gravity.getY(), context->m_Gravity.getZ()));
         m_DynamicsWorld->setDebugDrawer(&m_DebugDraw);
 
@@ -290,6 +367,8 @@ namespace dmPhysics
         context->m_TriggerEnterLimit = params.m_TriggerEnterLimit * params.m_Scale;
         context->m_RayCastLimit = params.m_RayCastLimit3D;
         context->m_TriggerOverlapCapacity = params.m_TriggerOverlapCapacity;
+        context->m_JobThread = params.m_JobThread;
+        context->m_WorkerCount = params.m_WorkerCount;
         context->m_AllowDynamicTransforms = params.m_AllowDynamicTransforms;
         dmMessage::Result result = dmMessage::NewSocket(PHYSICS_SOCKET_NAME, &context->m_Socket);
         if (result != dmMessage::RESULT_OK)
@@ -321,6 +400,7 @@ namespace dmPhysics
 
     HWorld3D NewWorld3D(HContext3D context, const NewWorldParams& params)
     {
+        DM_MEMORY_TAG(dmMemory::TAG_PHYSICS);
         if (context->m_Worlds.Full())
         {
             dmLogError("%s", "Physics world buffer full, world could not be created.");
@@ -364,6 +444,7 @@ namespace dmPhysics
 
     void StepWorld3D(HWorld3D world, const StepWorldContext& step_context)
     {
+        DM_MEMORY_TAG(dmMemory::TAG_PHYSICS);
         HContext3D context = world->m_Context;
         float scale = context->m_Scale;
         // Epsilon defining what transforms are considered noise and not
@@ -382,11 +463,13 @@ namespace dmPhysics
 
                 bool retrieve_gameworld_transform = world->m_AllowDynamicTransforms && !collision_object->isStaticObject();
 
+                // Fetched once, and reused for the scaling
+                dmTransform::Transform world_transform;
+
                 if (collision_object->getInternalType() == btCollisionObject::CO_GHOST_OBJECT || collision_object->isKinematicObject() || retrieve_gameworld_transform)
                 {
                     Point3 old_position = GetWorldPosition(context, collision_object);
                     Quat old_rotation = GetWorldRotation(context, collision_object);
-                    dmTransform::Transform world_transform;
                     (*world->m_GetWorldTransform)(collision_object->getUserPointer(), world_transform);
                     Point3 position = Point3(world_transform.GetTranslation());
                     Quat rotation = Quat(world_transform.GetRotation());
@@ -405,9 +488,6 @@ namespace dmPhysics
                 // Scaling
                 if (retrieve_gameworld_transform)
                 {
-                    dmTransform::Transform world_transform;
-                    world->m_GetWorldTransform(collision_object->getUserPointer(), world_transform);
-
                     // The compound shape scale always defaults to 1
                     btCollisionShape* shape = collision_object->getCollisionShape();
 
@@ -1255,6 +1335,157 @@ namespace dmPhysics
         }
     }
 
+    // Number of rays per task when ray casting a batch
+    static const uint32_t RAY_CAST_BATCH_GRAIN = 16;
+
+    struct RayCastBatchContext3D
+    {
+        HWorld3D                m_World;
+        const RayCastRequest*   m_Requests;
+        RayCastResponse*        m_Responses;
+    };
+
+    // The queries only read the world, so the rays can be cast in parallel
+    static void RayCastBatchRange3D(void* _context, uint32_t begin, uint32_t end)
+    {
+        RayCastBatchContext3D* context = (RayCastBatchContext3D*)_context;
+        HWorld3D world = context->m_World;
+        float scale = world->m_Context->m_Scale;
+        float inv_scale = world->m_Context->m_InvScale;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const RayCastRequest& request = context->m_Requests[i];
+            RayCastResponse& response = context->m_Responses[i];
+            response.m_Hit = 0;
+
+            if (lengthSqr(request.m_To - request.m_From) <= 0.0f)
+            {
+                continue;
+            }
+
+            btVector3 from;
+            ToBt(request.m_From, from, scale);
+            btVector3 to;
+            ToBt(request.m_To, to, scale);
+            RayCastResultClosestCallback3D result_callback(from, to, request.m_Mask, request.m_IgnoredUserData);
+            world->m_DynamicsWorld->rayTest(from, to, result_callback);
+            if (result_callback.hasHit())
+            {
+                ResponseFromRayCastResult(response, inv_scale, result_callback.m_closestHitFraction, result_callback.m_hitPointWorld, result_callback.m_hitNormalWorld, result_callback.m_collisionObject);
+            }
+        }
+    }
+
+    void RayCastBatch3D(HWorld3D world, const RayCastRequest* requests, uint32_t count, RayCastResponse* responses)
+    {
+        DM_PROFILE("RayCastBatch3D");
+
+        RayCastBatchContext3D context;
+        context.m_World = world;
+        context.m_Requests = requests;
+        context.m_Responses = responses;
+        dmJobThread::ParallelFor(world->m_Context->m_JobThread, count, RAY_CAST_BATCH_GRAIN, RayCastBatchRange3D, &context);
+    }
+
+    // Collects the objects in the broadphase overlapping the query bounds
+    struct AABBQueryCallback3D : public btBroadphaseAabbCallback
+    {
+        virtual bool process(const btBroadphaseProxy* proxy)
+        {
+            btCollisionObject* collision_object = (btCollisionObject*)proxy->m_clientObject;
+            // Never report triggers
+            if (!collision_object->hasContactResponse())
+                return true;
+            uint16_t group = proxy->m_collisionFilterGroup;
+            if (group & m_Mask)
+            {
+                PushOverlapResponse(*m_Results, collision_object->getUserPointer(), group);
+            }
+            return true;
+        }
+
+        dmArray<OverlapResponse>*   m_Results;
+        uint16_t                    m_Mask;
+    };
+
+    // Collects the objects with shapes overlapping the query object
+    struct OverlapContactCallback3D : public btCollisionWorld::ContactResultCallback
+    {
+        virtual bool needsCollision(btBroadphaseProxy* proxy) const
+        {
+            btCollisionObject* collision_object = (btCollisionObject*)proxy->m_clientObject;
+            return (proxy->m_collisionFilterGroup & m_Mask) != 0 && collision_object->hasContactResponse();
+        }
+
+        virtual btScalar addSingleResult(btManifoldPoint& cp, const btCollisionObject* object_a, int part_id_a, int index_a,
+                                         const btCollisionObject* object_b, int part_id_b, int index_b)
+        {
+            // Points within the contact breaking threshold are reported as well
+            if (cp.getDistance() > 0.0f)
+                return 0.0f;
+            const btCollisionObject* collision_object = object_a == m_QueryObject ? object_b : object_a;
+            PushOverlapResponse(*m_Results, collision_object->getUserPointer(), collision_object->getBroadphaseHandle()->m_collisionFilterGroup);
+            return 0.0f;
+        }
+
+        const btCollisionObject*    m_QueryObject;
+        dmArray<OverlapResponse>*   m_Results;
+        uint16_t                    m_Mask;
+    };
+
+    static void QueryOverlap3D(HWorld3D world, btCollisionShape* shape, const Point3& position, const Quat& rotation, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+        results.SetSize(0);
+
+        btVector3 bt_position;
+        ToBt(position, bt_position, world->m_Context->m_Scale);
+        btCollisionObject query_object;
+        query_object.setCollisionShape(shape);
+        query_object.setWorldTransform(btTransform(btQuaternion(rotation.getX(), rotation.getY(), rotation.getZ(), rotation.getW()), bt_position));
+
+        OverlapContactCallback3D callback;
+        callback.m_QueryObject = &query_object;
+        callback.m_Results = &results;
+        callback.m_Mask = mask;
+        world->m_DynamicsWorld->contactTest(&query_object, callback);
+    }
+
+    void QueryAABB3D(HWorld3D world, const Point3& min, const Point3& max, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+        DM_PROFILE("QueryAABB3D");
+
+        results.SetSize(0);
+
+        float scale = world->m_Context->m_Scale;
+        btVector3 aabb_min;
+        ToBt(min, aabb_min, scale);
+        btVector3 aabb_max;
+        ToBt(max, aabb_max, scale);
+
+        AABBQueryCallback3D callback;
+        callback.m_Results = &results;
+        callback.m_Mask = mask;
+        world->m_DynamicsWorld->getBroadphase()->aabbTest(aabb_min, aabb_max, callback);
+    }
+
+    void QueryBox3D(HWorld3D world, const Point3& position, const Quat& rotation, const Vector3& half_extents, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+        DM_PROFILE("QueryBox3D");
+
+        btVector3 bt_half_extents;
+        ToBt(half_extents, bt_half_extents, world->m_Context->m_Scale);
+        btBoxShape shape(bt_half_extents);
+        QueryOverlap3D(world, &shape, position, rotation, mask, results);
+    }
+
+    void QuerySphere3D(HWorld3D world, const Point3& position, float radius, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+        DM_PROFILE("QuerySphere3D");
+
+        btSphereShape shape(radius * world->m_Context->m_Scale);
+        QueryOverlap3D(world, &shape, position, Quat::identity(), mask, results);
+    }
+
     void SetGravity3D(HWorld3D world, const Vector3& gravity)
     {
         HContext3D context = world->m_Context;
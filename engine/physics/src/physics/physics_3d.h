@@ -25,6 +25,25 @@
 
 namespace dmPhysics
 {
+    // A dynamics world that runs the parallel parts of the world step on the job threads
+    class ParallelDynamicsWorld3D : public btDiscreteDynamicsWorld
+    {
+    public:
+        ParallelDynamicsWorld3D(btDispatcher* dispatcher, btBroadphaseInterface* pair_cache, btConstraintSolver* solver,
+                                btCollisionConfiguration* collision_configuration, dmJobThread::HContext job_thread);
+
+    protected:
+        virtual void predictUnconstraintMotion(btScalar time_step);
+        virtual void integrateTransforms(btScalar time_step);
+
+    private:
+        static void PredictMotionRange(void* _world, uint32_t begin, uint32_t end);
+        static void IntegrateTransformsRange(void* _world, uint32_t begin, uint32_t end);
+
+        dmJobThread::HContext   m_JobThread;
+        btScalar                m_TimeStep;
+    };
+
     struct World3D
     {
         World3D(HContext3D context, const NewWorldParams& params);
@@ -59,6 +78,8 @@ namespace dmPhysics
         float                       m_TriggerEnterLimit;
         int                         m_RayCastLimit;
         int                         m_TriggerOverlapCapacity;
+        dmJobThread::HContext       m_JobThread;
+        uint32_t                    m_WorkerCount;
         uint8_t                     m_AllowDynamicTransforms:1;
         uint8_t                     :7;
     };
@@ -217,6 +217,22 @@ namespace dmPhysics
     {
     }
 
+    void RayCastBatch3D(HWorld3D world, const RayCastRequest* requests, uint32_t count, RayCastResponse* responses)
+    {
+    }
+
+    void QueryAABB3D(HWorld3D world, const dmVMath::Point3& min, const dmVMath::Point3& max, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+    }
+
+    void QueryBox3D(HWorld3D world, const dmVMath::Point3& position, const dmVMath::Quat& rotation, const dmVMath::Vector3& half_extents, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+    }
+
+    void QuerySphere3D(HWorld3D world, const dmVMath::Point3& position, float radius, uint16_t mask, dmArray<OverlapResponse>& results)
+    {
+    }
+
     void SetGravity3D(HWorld3D world, const dmVMath::Vector3& gravity)
     {
     }
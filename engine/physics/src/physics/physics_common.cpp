@@ -31,6 +31,8 @@ namespace dmPhysics
     , m_RayCastLimit2D(0)
     , m_RayCastLimit3D(0)
     , m_TriggerOverlapCapacity(0)
+    , m_JobThread(0)
+    , m_WorkerCount(0)
     , m_AllowDynamicTransforms(0)
     {
 
@@ -94,6 +96,7 @@ namespace dmPhysics
     DebugCallbacks::DebugCallbacks()
     : m_DrawLines(0x0)
     , m_DrawTriangles(0x0)
+    , m_IsVisible(0x0)
     , m_UserData(0x0)
     , m_Alpha(1.0f)
     , m_Scale(1.0f)
@@ -125,6 +125,22 @@ namespace dmPhysics
      * if it is the last known occurrence of overlap.
      */
     void OverlapCachePrune(OverlapCache* cache, const OverlapCachePruneData& data);
+
+    /**
+     * Append the overlaps of the cache to a world state. Appends a multiple of 8 bytes.
+     */
+    void OverlapCacheSave(const OverlapCache* cache, dmArray<uint8_t>& state);
+
+    /**
+     * Replace the overlaps of the cache with the ones saved by OverlapCacheSave, without calling any callbacks.
+     * Returns false if the saved overlaps don't fit in size bytes.
+     */
+    bool OverlapCacheRestore(OverlapCache* cache, const uint8_t* state, uint32_t size);
+
+    /**
+     * Add an object to the results of an overlap query, unless it is already in the results with the same group.
+     */
+    void PushOverlapResponse(dmArray<OverlapResponse>& results, void* user_data, uint16_t group);
 }
 
 #endif // PHYSICS_PRIVATE_H
@@ -128,6 +128,10 @@ Test3D::Test3D()
 , m_GetMassFunc(dmPhysics::GetMass3D)
 , m_RequestRayCastFunc(dmPhysics::RequestRayCast3D)
 , m_RayCastFunc(dmPhysics::RayCast3D)
+, m_RayCastBatchFunc(dmPhysics::RayCastBatch3D)
+, m_QueryAABBFunc(dmPhysics::QueryAABB3D)
+, m_QueryBoxFunc(dmPhysics::QueryBox3D)
+, m_QuerySphereFunc(dmPhysics::QuerySphere3D)
 , m_SetDebugCallbacksFunc(dmPhysics::SetDebugCallbacks3D)
 , m_ReplaceShapeFunc(dmPhysics::ReplaceShape3D)
 , m_SetGravityFunc(dmPhysics::SetGravity3D)
@@ -186,6 +190,10 @@ Test2D::Test2D()
 , m_GetMassFunc(dmPhysics::GetMass2D)
 , m_RequestRayCastFunc(dmPhysics::RequestRayCast2D)
 , m_RayCastFunc(dmPhysics::RayCast2D)
+, m_RayCastBatchFunc(dmPhysics::RayCastBatch2D)
+, m_QueryAABBFunc(dmPhysics::QueryAABB2D)
+, m_QueryBoxFunc(dmPhysics::QueryBox2D)
+, m_QuerySphereFunc(dmPhysics::QueryCircle2D)
 , m_SetDebugCallbacksFunc(dmPhysics::SetDebugCallbacks2D)
 , m_ReplaceShapeFunc(dmPhysics::ReplaceShape2D)
 , m_SetGravityFunc(dmPhysics::SetGravity2D)
@@ -1246,6 +1254,147 @@ TYPED_TEST(PhysicsTest, SynchronousRayCasting)
     (*TestFixture::m_Test.m_DeleteCollisionShapeFunc)(shape);
 }
 
+TYPED_TEST(PhysicsTest, BatchRayCasting)
+{
+    const uint32_t ray_count = 100;
+    float box_half_ext = 0.5f;
+
+    VisualObject vo_a;
+    vo_a.m_Position.setX(1.0f);
+
+    VisualObject vo_b;
+    vo_b.m_Position.setX(2.5f);
+
+    typename TypeParam::CollisionShapeType shape = (*TestFixture::m_Test.m_NewBoxShapeFunc)(TestFixture::m_Context, Vector3(box_half_ext, box_half_ext, box_half_ext));
+
+    dmPhysics::CollisionObjectData data_a;
+    data_a.m_Group = 1;
+    data_a.m_Mass = 0.0f;
+    data_a.m_Type = dmPhysics::COLLISION_OBJECT_TYPE_KINEMATIC;
+    data_a.m_UserData = &vo_a;
+    typename TypeParam::CollisionObjectType box_co_a = (*TestFixture::m_Test.m_NewCollisionObjectFunc)(TestFixture::m_World, data_a, &shape, 1u);
+
+    dmPhysics::CollisionObjectData data_b;
+    data_b.m_Group = 2;
+    data_b.m_Mass = 0.0f;
+    data_b.m_Type = dmPhysics::COLLISION_OBJECT_TYPE_KINEMATIC;
+    data_b.m_UserData = &vo_b;
+    typename TypeParam::CollisionObjectType box_co_b = (*TestFixture::m_Test.m_NewCollisionObjectFunc)(TestFixture::m_World, data_b, &shape, 1u);
+
+    // Rays fanning out from the left, some of them hitting the boxes, and a ray of 0 length
+    dmArray<dmPhysics::RayCastRequest> requests;
+    requests.SetCapacity(ray_count);
+    requests.SetSize(ray_count);
+    for (uint32_t i = 0; i < ray_count; ++i)
+    {
+        dmPhysics::RayCastRequest request;
+        request.m_From = Point3(-1.0f, 0.0f, 0.0f);
+        request.m_To = Point3(5.0f, -2.0f + i * 0.04f, 0.0f);
+        request.m_Mask = (i % 2) ? 1 : 3;
+        requests[i] = request;
+    }
+    requests[ray_count - 1].m_To = requests[ray_count - 1].m_From;
+
+    dmArray<dmPhysics::RayCastResponse> responses;
+    responses.SetCapacity(ray_count);
+    responses.SetSize(ray_count);
+    (*TestFixture::m_Test.m_RayCastBatchFunc)(TestFixture::m_World, requests.Begin(), ray_count, responses.Begin());
+
+    // The same hits as when casting the rays one by one
+    uint32_t hit_count = 0;
+    dmArray<dmPhysics::RayCastResponse> hits;
+    hits.SetCapacity(8);
+    for (uint32_t i = 0; i < ray_count - 1; ++i)
+    {
+        hits.SetSize(0);
+        (*TestFixture::m_Test.m_RayCastFunc)(TestFixture::m_World, requests[i], hits);
+        ASSERT_EQ(hits.Size(), (uint32_t)responses[i].m_Hit);
+        if (responses[i].m_Hit)
+        {
+            ASSERT_EQ(hits[0].m_Fraction, responses[i].m_Fraction);
+            ASSERT_EQ(hits[0].m_Position.getX(), responses[i].m_Position.getX());
+            ASSERT_EQ(hits[0].m_Position.getY(), responses[i].m_Position.getY());
+            ASSERT_EQ(hits[0].m_CollisionObjectUserData, responses[i].m_CollisionObjectUserData);
+            ASSERT_EQ(hits[0].m_CollisionObjectGroup, responses[i].m_CollisionObjectGroup);
+            ++hit_count;
+        }
+    }
+    ASSERT_LT(0u, hit_count);
+    ASSERT_GT(ray_count - 1, hit_count);
+    ASSERT_EQ(0u, (uint32_t)responses[ray_count - 1].m_Hit);
+
+    (*TestFixture::m_Test.m_DeleteCollisionObjectFunc)(TestFixture::m_World, box_co_a);
+    (*TestFixture::m_Test.m_DeleteCollisionObjectFunc)(TestFixture::m_World, box_co_b);
+    (*TestFixture::m_Test.m_DeleteCollisionShapeFunc)(shape);
+}
+
+TYPED_TEST(PhysicsTest, OverlapQueries)
+{
+    float box_half_ext = 0.5f;
+
+    VisualObject vo_a;
+    vo_a.m_Position.setX(1.0f);
+
+    VisualObject vo_b;
+    vo_b.m_Position.setX(2.5f);
+
+    VisualObject vo_trigger;
+    vo_trigger.m_Position = Point3(1.0f, 3.0f, 0.0f);
+
+    typename TypeParam::CollisionShapeType shape = (*TestFixture::m_Test.m_NewBoxShapeFunc)(TestFixture::m_Context, Vector3(box_half_ext, box_half_ext, box_half_ext));
+
+    dmPhysics::CollisionObjectData data;
+    data.m_Group = 1;
+    data.m_Mass = 0.0f;
+    data.m_Type = dmPhysics::COLLISION_OBJECT_TYPE_KINEMATIC;
+    data.m_UserData = &vo_a;
+    typename TypeParam::CollisionObjectType box_co_a = (*TestFixture::m_Test.m_NewCollisionObjectFunc)(TestFixture::m_World, data, &shape, 1u);
+
+    data.m_Group = 2;
+    data.m_UserData = &vo_b;
+    typename TypeParam::CollisionObjectType box_co_b = (*TestFixture::m_Test.m_NewCollisionObjectFunc)(TestFixture::m_World, data, &shape, 1u);
+
+    data.m_Group = 4;
+    data.m_Type = dmPhysics::COLLISION_OBJECT_TYPE_TRIGGER;
+    data.m_UserData = &vo_trigger;
+    typename TypeParam::CollisionObjectType trigger_co = (*TestFixture::m_Test.m_NewCollisionObjectFunc)(TestFixture::m_World, data, &shape, 1u);
+
+    dmArray<dmPhysics::OverlapResponse> results;
+
+    // Triggers are never reported
+    (*TestFixture::m_Test.m_QueryAABBFunc)(TestFixture::m_World, Point3(-1.0f, -1.0f, -1.0f), Point3(4.0f, 4.0f, 1.0f), ~0, results);
+    ASSERT_EQ(2u, results.Size());
+
+    (*TestFixture::m_Test.m_QueryAABBFunc)(TestFixture::m_World, Point3(-1.0f, -1.0f, -1.0f), Point3(4.0f, 4.0f, 1.0f), 2 | 4, results);
+    ASSERT_EQ(1u, results.Size());
+    ASSERT_EQ((void*)&vo_b, results[0].m_CollisionObjectUserData);
+    ASSERT_EQ(2u, results[0].m_CollisionObjectGroup);
+
+    // In the gap between the boxes
+    (*TestFixture::m_Test.m_QuerySphereFunc)(TestFixture::m_World, Point3(1.75f, 0.0f, 0.0f), 0.2f, ~0, results);
+    ASSERT_EQ(0u, results.Size());
+
+    (*TestFixture::m_Test.m_QuerySphereFunc)(TestFixture::m_World, Point3(1.75f, 0.0f, 0.0f), 0.4f, ~0, results);
+    ASSERT_EQ(2u, results.Size());
+
+    (*TestFixture::m_Test.m_QuerySphereFunc)(TestFixture::m_World, Point3(1.0f, 3.0f, 0.0f), 1.0f, ~0, results);
+    ASSERT_EQ(0u, results.Size());
+
+    // Above box b, unless rotated so that a corner reaches down into it
+    Vector3 half_extents(box_half_ext, box_half_ext, box_half_ext);
+    (*TestFixture::m_Test.m_QueryBoxFunc)(TestFixture::m_World, Point3(2.5f, 1.1f, 0.0f), Quat::identity(), half_extents, ~0, results);
+    ASSERT_EQ(0u, results.Size());
+
+    (*TestFixture::m_Test.m_QueryBoxFunc)(TestFixture::m_World, Point3(2.5f, 1.1f, 0.0f), Quat::rotationZ((float) (0.25 * M_PI)), half_extents, ~0, results);
+    ASSERT_EQ(1u, results.Size());
+    ASSERT_EQ((void*)&vo_b, results[0].m_CollisionObjectUserData);
+
+    (*TestFixture::m_Test.m_DeleteCollisionObjectFunc)(TestFixture::m_World, box_co_a);
+    (*TestFixture::m_Test.m_DeleteCollisionObjectFunc)(TestFixture::m_World, box_co_b);
+    (*TestFixture::m_Test.m_DeleteCollisionObjectFunc)(TestFixture::m_World, trigger_co);
+    (*TestFixture::m_Test.m_DeleteCollisionShapeFunc)(shape);
+}
+
 enum Groups
 {
     GROUP_A = 1 << 0,
@@ -1578,6 +1727,33 @@ TYPED_TEST(PhysicsTest, DrawDebug)
     (*TestFixture::m_Test.m_DeleteCollisionShapeFunc)(shape);
 }
 
+bool IsNeverVisible(Point3 center, float radius, void* user_data)
+{
+    return false;
+}
+
+TYPED_TEST(PhysicsTest, DrawDebugCulled)
+{
+    bool drew = false;
+    dmPhysics::DebugCallbacks callbacks;
+    callbacks.m_DrawLines = DrawLines;
+    callbacks.m_DrawTriangles = DrawTriangles;
+    callbacks.m_IsVisible = IsNeverVisible;
+    callbacks.m_UserData = &drew;
+    (*TestFixture::m_Test.m_SetDebugCallbacksFunc)(TestFixture::m_Context, callbacks);
+
+    dmPhysics::CollisionObjectData data;
+    typename TypeParam::CollisionShapeType shape = (*TestFixture::m_Test.m_NewBoxShapeFunc)(TestFixture::m_Context, Vector3(1.0f, 1.0f, 1.0f));
+    typename TypeParam::CollisionObjectType co = (*TestFixture::m_Test.m_NewCollisionObjectFunc)(TestFixture::m_World, data, &shape, 1u);
+
+    (*TestFixture::m_Test.m_SetDrawDebugFunc)(TestFixture::m_World, true);
+    (*TestFixture::m_Test.m_StepWorldFunc)(TestFixture::m_World, TestFixture::m_StepWorldContext);
+    ASSERT_FALSE(drew);
+
+    (*TestFixture::m_Test.m_DeleteCollisionObjectFunc)(TestFixture::m_World, co);
+    (*TestFixture::m_Test.m_DeleteCollisionShapeFunc)(shape);
+}
+
 bool DistanceContactPointCallback(const dmPhysics::ContactPoint& contact_point, void* user_data)
 {
     float* distance = (float*)user_data;
@@ -2226,6 +2402,168 @@ TYPED_TEST(PhysicsTest, DisabledFromStart)
     (*TestFixture::m_Test.m_DeleteCollisionShapeFunc)(shape);
 }
 
+struct ParallelStepWorld3D
+{
+    dmPhysics::HContext3D               m_Context;
+    dmPhysics::HWorld3D                 m_World;
+    dmPhysics::HCollisionShape3D        m_GroundShape;
+    dmPhysics::HCollisionShape3D        m_BoxShape;
+    dmPhysics::HCollisionShape3D        m_SphereShape;
+    dmPhysics::HCollisionObject3D       m_Ground;
+    VisualObject                        m_GroundObject;
+    dmArray<dmPhysics::HCollisionObject3D> m_Bodies;
+    dmArray<VisualObject>               m_BodyObjects;
+    int                                 m_ContactPointCount;
+};
+
+static void CreateParallelStepWorld3D(ParallelStepWorld3D* world, dmJobThread::HContext job_thread, uint32_t worker_count)
+{
+    const uint32_t column_count = 6;
+    const uint32_t row_count = 4;
+    const uint32_t stack_height = 6;
+
+    dmPhysics::NewContextParams context_params;
+    context_params.m_Scale = PHYSICS_SCALE;
+    context_params.m_RayCastLimit3D = 64;
+    context_params.m_TriggerOverlapCapacity = 16;
+    context_params.m_JobThread = job_thread;
+    context_params.m_WorkerCount = worker_count;
+    world->m_Context = dmPhysics::NewContext3D(context_params);
+
+    dmPhysics::NewWorldParams world_params;
+    world_params.m_GetWorldTransformCallback = GetWorldTransform;
+    world_params.m_SetWorldTransformCallback = SetWorldTransform;
+    world_params.m_MaxCollisionObjectsCount = 1024;
+    world->m_World = dmPhysics::NewWorld3D(world->m_Context, world_params);
+
+    dmPhysics::CollisionObjectData data;
+    data.m_Type = dmPhysics::COLLISION_OBJECT_TYPE_STATIC;
+    data.m_Mass = 0.0f;
+    data.m_UserData = &world->m_GroundObject;
+    world->m_GroundShape = dmPhysics::NewBoxShape3D(world->m_Context, dmVMath::Vector3(200.0f, 1.0f, 200.0f));
+    world->m_Ground = dmPhysics::NewCollisionObject3D(world->m_World, data, &world->m_GroundShape, 1u);
+
+    // Separate stacks of tilted boxes and spheres on a shared static ground, so that the stacks topple and the
+    // rotations change during the steps
+    world->m_BoxShape = dmPhysics::NewBoxShape3D(world->m_Context, dmVMath::Vector3(0.5f, 0.5f, 0.5f));
+    world->m_SphereShape = dmPhysics::NewSphereShape3D(world->m_Context, 0.5f);
+    uint32_t body_count = column_count * row_count * stack_height;
+    world->m_BodyObjects.SetCapacity(body_count);
+    world->m_BodyObjects.SetSize(body_count);
+    world->m_Bodies.SetCapacity(body_count);
+    data.m_Type = dmPhysics::COLLISION_OBJECT_TYPE_DYNAMIC;
+    data.m_Mass = 1.0f;
+    for (uint32_t x = 0; x < column_count; ++x)
+    {
+        for (uint32_t z = 0; z < row_count; ++z)
+        {
+            for (uint32_t y = 0; y < stack_height; ++y)
+            {
+                VisualObject& vo = world->m_BodyObjects[world->m_Bodies.Size()];
+                vo = VisualObject();
+                vo.m_Position = dmVMath::Point3(-30.0f + x * 10.0f + (y % 2) * 0.1f, 1.6f + y * 1.1f, -20.0f + z * 10.0f);
+                vo.m_Rotation = dmVMath::Quat::rotationZ(0.1f * (y + 1)) * dmVMath::Quat::rotationX(0.05f * z);
+                data.m_UserData = &vo;
+                dmPhysics::HCollisionShape3D* shape = ((x + y) % 2) ? &world->m_SphereShape : &world->m_BoxShape;
+                world->m_Bodies.Push(dmPhysics::NewCollisionObject3D(world->m_World, data, shape, 1u));
+            }
+        }
+    }
+    world->m_ContactPointCount = 0;
+}
+
+static void DeleteParallelStepWorld3D(ParallelStepWorld3D* world)
+{
+    for (uint32_t i = 0; i < world->m_Bodies.Size(); ++i)
+    {
+        dmPhysics::DeleteCollisionObject3D(world->m_World, world->m_Bodies[i]);
+    }
+    dmPhysics::DeleteCollisionObject3D(world->m_World, world->m_Ground);
+    dmPhysics::DeleteCollisionShape3D(world->m_SphereShape);
+    dmPhysics::DeleteCollisionShape3D(world->m_BoxShape);
+    dmPhysics::DeleteCollisionShape3D(world->m_GroundShape);
+    dmPhysics::DeleteWorld3D(world->m_Context, world->m_World);
+    dmPhysics::DeleteContext3D(world->m_Context);
+}
+
+static void StepParallelStepWorld3D(ParallelStepWorld3D* world)
+{
+    dmPhysics::StepWorldContext step_context;
+    step_context.m_DT = 1.0f / 60.0f;
+    step_context.m_ContactPointCallback = ContactPointCallback;
+    step_context.m_ContactPointUserData = &world->m_ContactPointCount;
+    dmPhysics::StepWorld3D(world->m_World, step_context);
+}
+
+// Checks that the bodies of both worlds have bit-identical transforms, both in Bullet and in the visual objects
+static void AssertSameTransforms3D(ParallelStepWorld3D* serial, ParallelStepWorld3D* parallel)
+{
+    ASSERT_EQ(serial->m_Bodies.Size(), parallel->m_Bodies.Size());
+    for (uint32_t i = 0; i < serial->m_Bodies.Size(); ++i)
+    {
+        dmVMath::Point3 serial_position = dmPhysics::GetWorldPosition3D(serial->m_Context, serial->m_Bodies[i]);
+        dmVMath::Point3 parallel_position = dmPhysics::GetWorldPosition3D(parallel->m_Context, parallel->m_Bodies[i]);
+        ASSERT_EQ(serial_position.getX(), parallel_position.getX());
+        ASSERT_EQ(serial_position.getY(), parallel_position.getY());
+        ASSERT_EQ(serial_position.getZ(), parallel_position.getZ());
+
+        dmVMath::Quat serial_rotation = dmPhysics::GetWorldRotation3D(serial->m_Context, serial->m_Bodies[i]);
+        dmVMath::Quat parallel_rotation = dmPhysics::GetWorldRotation3D(parallel->m_Context, parallel->m_Bodies[i]);
+        ASSERT_EQ(serial_rotation.getX(), parallel_rotation.getX());
+        ASSERT_EQ(serial_rotation.getY(), parallel_rotation.getY());
+        ASSERT_EQ(serial_rotation.getZ(), parallel_rotation.getZ());
+        ASSERT_EQ(serial_rotation.getW(), parallel_rotation.getW());
+
+        const VisualObject& serial_object = serial->m_BodyObjects[i];
+        const VisualObject& parallel_object = parallel->m_BodyObjects[i];
+        ASSERT_EQ(serial_object.m_Position.getX(), parallel_object.m_Position.getX());
+        ASSERT_EQ(serial_object.m_Position.getY(), parallel_object.m_Position.getY());
+        ASSERT_EQ(serial_object.m_Position.getZ(), parallel_object.m_Position.getZ());
+        ASSERT_EQ(serial_object.m_Rotation.getX(), parallel_object.m_Rotation.getX());
+        ASSERT_EQ(serial_object.m_Rotation.getY(), parallel_object.m_Rotation.getY());
+        ASSERT_EQ(serial_object.m_Rotation.getZ(), parallel_object.m_Rotation.getZ());
+        ASSERT_EQ(serial_object.m_Rotation.getW(), parallel_object.m_Rotation.getW());
+    }
+}
+
+// Steps the same scene on the calling thread and with the motion prediction and transform integration on the
+// job threads. The islands are solved serially in both worlds, so every step must give the exact same transforms.
+TEST(PhysicsTest3D, ParallelStep)
+{
+    dmJobThread::JobThreadCreationParams job_thread_params;
+    job_thread_params.m_ThreadNames[0] = "test_physics_0";
+    job_thread_params.m_ThreadNames[1] = "test_physics_1";
+    job_thread_params.m_ThreadNames[2] = "test_physics_2";
+    job_thread_params.m_ThreadCount = 3;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_params);
+
+    ParallelStepWorld3D serial;
+    ParallelStepWorld3D parallel;
+    CreateParallelStepWorld3D(&serial, 0, 0);
+    CreateParallelStepWorld3D(&parallel, job_thread, 4);
+
+    // More bodies than one range of the parallel loops
+    ASSERT_LT(64u, serial.m_Bodies.Size());
+
+    dmVMath::Quat start_rotation = dmPhysics::GetWorldRotation3D(serial.m_Context, serial.m_Bodies[0]);
+    for (uint32_t i = 0; i < 120; ++i)
+    {
+        StepParallelStepWorld3D(&serial);
+        StepParallelStepWorld3D(&parallel);
+        AssertSameTransforms3D(&serial, &parallel);
+        ASSERT_EQ(serial.m_ContactPointCount, parallel.m_ContactPointCount);
+    }
+
+    // The scene must actually have collided and rotated, or the comparison proves nothing
+    ASSERT_LT(0, serial.m_ContactPointCount);
+    dmVMath::Quat end_rotation = dmPhysics::GetWorldRotation3D(serial.m_Context, serial.m_Bodies[0]);
+    ASSERT_NE(start_rotation.getZ(), end_rotation.getZ());
+
+    DeleteParallelStepWorld3D(&parallel);
+    DeleteParallelStepWorld3D(&serial);
+    dmJobThread::Destroy(job_thread);
+}
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);
@@ -125,6 +125,10 @@ struct Funcs
     typedef float (*GetMassFunc)(typename T::CollisionObjectType collision_object);
     typedef void (*RequestRayCastFunc)(typename T::WorldType world, const dmPhysics::RayCastRequest& request);
     typedef void (*RayCastFunc)(typename T::WorldType world, const dmPhysics::RayCastRequest& request, dmArray<dmPhysics::RayCastResponse>& results);
+    typedef void (*RayCastBatchFunc)(typename T::WorldType world, const dmPhysics::RayCastRequest* requests, uint32_t count, dmPhysics::RayCastResponse* responses);
+    typedef void (*QueryAABBFunc)(typename T::WorldType world, const dmVMath::Point3& min, const dmVMath::Point3& max, uint16_t mask, dmArray<dmPhysics::OverlapResponse>& results);
+    typedef void (*QueryBoxFunc)(typename T::WorldType world, const dmVMath::Point3& position, const dmVMath::Quat& rotation, const dmVMath::Vector3& half_extents, uint16_t mask, dmArray<dmPhysics::OverlapResponse>& results);
+    typedef void (*QuerySphereFunc)(typename T::WorldType world, const dmVMath::Point3& position, float radius, uint16_t mask, dmArray<dmPhysics::OverlapResponse>& results);
     typedef void (*SetDebugCallbacks)(typename T::ContextType context, const dmPhysics::DebugCallbacks& callbacks);
     typedef void (*ReplaceShapeFunc)(typename T::ContextType context, typename T::CollisionShapeType old_shape, typename T::CollisionShapeType new_shape);
     typedef void (*SetGravityFunc)(typename T::WorldType world, const dmVMath::Vector3& gravity);
@@ -184,6 +188,10 @@ struct Test3D
     Funcs<Test3D>::GetMassFunc                      m_GetMassFunc;
     Funcs<Test3D>::RequestRayCastFunc               m_RequestRayCastFunc;
     Funcs<Test3D>::RayCastFunc                      m_RayCastFunc;
+    Funcs<Test3D>::RayCastBatchFunc                 m_RayCastBatchFunc;
+    Funcs<Test3D>::QueryAABBFunc                    m_QueryAABBFunc;
+    Funcs<Test3D>::QueryBoxFunc                     m_QueryBoxFunc;
+    Funcs<Test3D>::QuerySphereFunc                  m_QuerySphereFunc;
     Funcs<Test3D>::SetDebugCallbacks                m_SetDebugCallbacksFunc;
     Funcs<Test3D>::ReplaceShapeFunc                 m_ReplaceShapeFunc;
     Funcs<Test3D>::SetGravityFunc                   m_SetGravityFunc;
@@ -242,6 +250,10 @@ struct Test2D
     Funcs<Test2D>::GetMassFunc                      m_GetMassFunc;
     Funcs<Test2D>::RequestRayCastFunc               m_RequestRayCastFunc;
     Funcs<Test2D>::RayCastFunc                      m_RayCastFunc;
+    Funcs<Test2D>::RayCastBatchFunc                 m_RayCastBatchFunc;
+    Funcs<Test2D>::QueryAABBFunc                    m_QueryAABBFunc;
+    Funcs<Test2D>::QueryBoxFunc                     m_QueryBoxFunc;
+    Funcs<Test2D>::QuerySphereFunc                  m_QuerySphereFunc;
     Funcs<Test2D>::SetDebugCallbacks                m_SetDebugCallbacksFunc;
     Funcs<Test2D>::ReplaceShapeFunc                 m_ReplaceShapeFunc;
     Funcs<Test2D>::SetGravityFunc                   m_SetGravityFunc;
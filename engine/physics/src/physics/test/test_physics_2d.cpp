@@ -369,6 +369,97 @@ TYPED_TEST(PhysicsTest, GridShapePolygon)
     }
 }
 
+TYPED_TEST(PhysicsTest, GridShapeHulls)
+{
+    const uint32_t rows = 2;
+    const uint32_t columns = 3;
+    int32_t cell_width = 16;
+    int32_t cell_height = 16;
+    float grid_radius = b2_polygonRadius;
+
+    VisualObject vo_a;
+    vo_a.m_Position = dmVMath::Point3(0, 0, 0);
+    dmPhysics::CollisionObjectData data;
+    data.m_Type = dmPhysics::COLLISION_OBJECT_TYPE_STATIC;
+    data.m_Mass = 0.0f;
+    data.m_UserData = &vo_a;
+    data.m_Group = 0xffff;
+    data.m_Mask = 0xffff;
+    data.m_Restitution = 0.0f;
+
+    const float hull_vertices[] = {-0.5f, -0.5f,
+                                    0.5f, -0.5f,
+                                    0.5f,  0.5f,
+                                   -0.5f,  0.5f};
+
+    const dmPhysics::HullDesc hulls[] = { {0, 4} };
+    dmPhysics::HHullSet2D hull_set = dmPhysics::NewHullSet2D(TestFixture::m_Context, hull_vertices, 4, hulls, 1);
+    dmPhysics::HCollisionShape2D grid_shape = dmPhysics::NewGridShape2D(TestFixture::m_Context, hull_set, dmVMath::Point3(0,0,0), cell_width, cell_height, rows, columns);
+    typename TypeParam::CollisionObjectType grid_co = (*TestFixture::m_Test.m_NewCollisionObjectFunc)(TestFixture::m_World, data, &grid_shape, 1u);
+
+    // Fill the grid, with an extra edit of the middle cell of the top row, and an edit of a missing shape
+    dmPhysics::GridShapeHullDesc edits[rows * columns + 2];
+    for (uint32_t i = 0; i < rows * columns; ++i)
+    {
+        edits[i].m_ShapeIndex = 0;
+        edits[i].m_Row = i / columns;
+        edits[i].m_Column = i % columns;
+        edits[i].m_Hull = i == 4 ? (uint32_t)dmPhysics::GRIDSHAPE_EMPTY_CELL : 0;
+        edits[i].m_Group = 1;
+        edits[i].m_Mask = 0xffff;
+    }
+    edits[rows * columns] = edits[0];
+    edits[rows * columns].m_ShapeIndex = 1;
+    edits[rows * columns + 1] = edits[4];
+    edits[rows * columns + 1].m_Hull = 0;
+    ASSERT_FALSE(dmPhysics::SetGridShapeHulls(grid_co, edits, rows * columns + 2));
+
+    VisualObject vo_b;
+    vo_b.m_Position = dmVMath::Point3(0.0f, 50.0f, 0.0f);
+    data.m_Type = dmPhysics::COLLISION_OBJECT_TYPE_DYNAMIC;
+    data.m_Mass = 1.0f;
+    data.m_UserData = &vo_b;
+    typename TypeParam::CollisionShapeType shape = (*TestFixture::m_Test.m_NewBoxShapeFunc)(TestFixture::m_Context, dmVMath::Vector3(0.5f, 0.5f, 0.0f));
+    typename TypeParam::CollisionObjectType dynamic_co = (*TestFixture::m_Test.m_NewCollisionObjectFunc)(TestFixture::m_World, data, &shape, 1u);
+
+    for (uint32_t i = 0; i < 400; ++i)
+    {
+        (*TestFixture::m_Test.m_StepWorldFunc)(TestFixture::m_World, TestFixture::m_StepWorldContext);
+    }
+    // The box rests on the top row
+    ASSERT_NEAR(16.0f + grid_radius + 0.5f, vo_b.m_Position.getY(), 0.05f);
+    ASSERT_EQ(1, vo_a.m_FirstCollisionGroup);
+
+    // Remove the cell below the box
+    edits[0] = edits[4];
+    edits[0].m_Hull = dmPhysics::GRIDSHAPE_EMPTY_CELL;
+    edits[0].m_Group = 0;
+    edits[0].m_Mask = 0;
+    ASSERT_TRUE(dmPhysics::SetGridShapeHulls(grid_co, edits, 1));
+    for (uint32_t i = 0; i < 400; ++i)
+    {
+        (*TestFixture::m_Test.m_StepWorldFunc)(TestFixture::m_World, TestFixture::m_StepWorldContext);
+    }
+    // The box rests on the bottom row
+    ASSERT_NEAR(0.0f + grid_radius + 0.5f, vo_b.m_Position.getY(), 0.05f);
+
+    // Keep the hull of the cell below the box, but filter out the box. The touching contact must be refiltered.
+    edits[0] = edits[1];
+    edits[0].m_Mask = 0;
+    ASSERT_TRUE(dmPhysics::SetGridShapeHulls(grid_co, edits, 1));
+    for (uint32_t i = 0; i < 400; ++i)
+    {
+        (*TestFixture::m_Test.m_StepWorldFunc)(TestFixture::m_World, TestFixture::m_StepWorldContext);
+    }
+    ASSERT_GT(-16.0f, vo_b.m_Position.getY());
+
+    (*TestFixture::m_Test.m_DeleteCollisionObjectFunc)(TestFixture::m_World, grid_co);
+    (*TestFixture::m_Test.m_DeleteCollisionObjectFunc)(TestFixture::m_World, dynamic_co);
+    (*TestFixture::m_Test.m_DeleteCollisionShapeFunc)(shape);
+    (*TestFixture::m_Test.m_DeleteCollisionShapeFunc)(grid_shape);
+    dmPhysics::DeleteHullSet2D(hull_set);
+}
+
 TYPED_TEST(PhysicsTest, GridShapeSphere)
 {
     /*
@@ -1842,6 +1933,218 @@ TYPED_TEST(PhysicsTest, ScriptApiBox2D)
     (*TestFixture::m_Test.m_DeleteCollisionObjectFunc)(TestFixture::m_World, dynamic_co);
 }
 
+struct ParallelStepWorld
+{
+    dmPhysics::HContext2D               m_Context;
+    dmPhysics::HWorld2D                 m_World;
+    dmPhysics::HCollisionShape2D        m_GroundShape;
+    dmPhysics::HCollisionShape2D        m_BoxShape;
+    dmPhysics::HCollisionObject2D       m_Ground;
+    VisualObject                        m_GroundObject;
+    dmArray<dmPhysics::HCollisionObject2D> m_Boxes;
+    dmArray<VisualObject>               m_BoxObjects;
+    int                                 m_ContactPointCount;
+};
+
+static void CreateParallelStepWorld(ParallelStepWorld* world, dmJobThread::HContext job_thread, uint32_t worker_count)
+{
+    const uint32_t column_count = 24;
+    const uint32_t row_count = 6;
+
+    dmPhysics::NewContextParams context_params;
+    context_params.m_Scale = PHYSICS_SCALE;
+    context_params.m_RayCastLimit2D = 64;
+    context_params.m_TriggerOverlapCapacity = 16;
+    context_params.m_JobThread = job_thread;
+    context_params.m_WorkerCount = worker_count;
+    world->m_Context = dmPhysics::NewContext2D(context_params);
+
+    dmPhysics::NewWorldParams world_params;
+    world_params.m_GetWorldTransformCallback = GetWorldTransform;
+    world_params.m_SetWorldTransformCallback = SetWorldTransform;
+    world_params.m_MaxCollisionObjectsCount = 1024;
+    world->m_World = dmPhysics::NewWorld2D(world->m_Context, world_params);
+
+    dmPhysics::CollisionObjectData data;
+    data.m_Type = dmPhysics::COLLISION_OBJECT_TYPE_STATIC;
+    data.m_Mass = 0.0f;
+    data.m_UserData = &world->m_GroundObject;
+    world->m_GroundShape = dmPhysics::NewBoxShape2D(world->m_Context, dmVMath::Vector3(200.0f, 1.0f, 0.0f));
+    world->m_Ground = dmPhysics::NewCollisionObject2D(world->m_World, data, &world->m_GroundShape, 1u);
+
+    // Separate stacks on the same static ground, so that the islands share a static body
+    world->m_BoxShape = dmPhysics::NewBoxShape2D(world->m_Context, dmVMath::Vector3(0.5f, 0.5f, 0.0f));
+    world->m_BoxObjects.SetCapacity(column_count * row_count);
+    world->m_BoxObjects.SetSize(column_count * row_count);
+    world->m_Boxes.SetCapacity(column_count * row_count);
+    data.m_Type = dmPhysics::COLLISION_OBJECT_TYPE_DYNAMIC;
+    data.m_Mass = 1.0f;
+    for (uint32_t x = 0; x < column_count; ++x)
+    {
+        for (uint32_t y = 0; y < row_count; ++y)
+        {
+            VisualObject& vo = world->m_BoxObjects[x * row_count + y];
+            vo = VisualObject();
+            vo.m_Position = dmVMath::Point3(-150.0f + x * 12.0f + (y % 2) * 0.2f, 1.6f + y * 1.1f, 0.0f);
+            data.m_UserData = &vo;
+            world->m_Boxes.Push(dmPhysics::NewCollisionObject2D(world->m_World, data, &world->m_BoxShape, 1u));
+        }
+    }
+    world->m_ContactPointCount = 0;
+}
+
+static void DeleteParallelStepWorld(ParallelStepWorld* world)
+{
+    for (uint32_t i = 0; i < world->m_Boxes.Size(); ++i)
+    {
+        dmPhysics::DeleteCollisionObject2D(world->m_World, world->m_Boxes[i]);
+    }
+    dmPhysics::DeleteCollisionObject2D(world->m_World, world->m_Ground);
+    dmPhysics::DeleteCollisionShape2D(world->m_BoxShape);
+    dmPhysics::DeleteCollisionShape2D(world->m_GroundShape);
+    dmPhysics::DeleteWorld2D(world->m_Context, world->m_World);
+    dmPhysics::DeleteContext2D(world->m_Context);
+}
+
+static void StepParallelStepWorld(ParallelStepWorld* world)
+{
+    dmPhysics::StepWorldContext step_context;
+    step_context.m_DT = 1.0f / 60.0f;
+    step_context.m_ContactPointCallback = ContactPointCallback;
+    step_context.m_ContactPointUserData = &world->m_ContactPointCount;
+    dmPhysics::StepWorld2D(world->m_World, step_context);
+}
+
+TEST(PhysicsTest2D, ParallelStep)
+{
+    dmJobThread::JobThreadCreationParams job_thread_params;
+    job_thread_params.m_ThreadNames[0] = "test_physics_0";
+    job_thread_params.m_ThreadNames[1] = "test_physics_1";
+    job_thread_params.m_ThreadNames[2] = "test_physics_2";
+    job_thread_params.m_ThreadCount = 3;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_params);
+
+    ParallelStepWorld serial;
+    ParallelStepWorld parallel;
+    CreateParallelStepWorld(&serial, 0, 0);
+    CreateParallelStepWorld(&parallel, job_thread, 4);
+
+    for (uint32_t i = 0; i < 120; ++i)
+    {
+        StepParallelStepWorld(&serial);
+        StepParallelStepWorld(&parallel);
+    }
+
+    // The parallel step must give the exact same result
+    ASSERT_LT(0, serial.m_ContactPointCount);
+    ASSERT_EQ(serial.m_ContactPointCount, parallel.m_ContactPointCount);
+    for (uint32_t i = 0; i < serial.m_BoxObjects.Size(); ++i)
+    {
+        ASSERT_EQ(serial.m_BoxObjects[i].m_Position.getX(), parallel.m_BoxObjects[i].m_Position.getX());
+        ASSERT_EQ(serial.m_BoxObjects[i].m_Position.getY(), parallel.m_BoxObjects[i].m_Position.getY());
+        ASSERT_EQ(serial.m_BoxObjects[i].m_Rotation.getZ(), parallel.m_BoxObjects[i].m_Rotation.getZ());
+    }
+
+    DeleteParallelStepWorld(&parallel);
+    DeleteParallelStepWorld(&serial);
+    dmJobThread::Destroy(job_thread);
+}
+
+TEST(PhysicsTest2D, SnapshotRestore)
+{
+    ParallelStepWorld world;
+    CreateParallelStepWorld(&world, 0, 0);
+    dmPhysics::SetDeterministicStep2D(world.m_World, true);
+
+    // Let the boxes land, so that the state has touching contacts
+    for (uint32_t i = 0; i < 30; ++i)
+    {
+        StepParallelStepWorld(&world);
+    }
+
+    dmArray<uint8_t> state;
+    dmPhysics::SnapshotWorld2D(world.m_World, state);
+    ASSERT_LT(0u, state.Size());
+    dmArray<VisualObject> snapshot_objects;
+    snapshot_objects.SetCapacity(world.m_BoxObjects.Size());
+    snapshot_objects.SetSize(world.m_BoxObjects.Size());
+    memcpy(snapshot_objects.Begin(), world.m_BoxObjects.Begin(), world.m_BoxObjects.Size() * sizeof(VisualObject));
+
+    world.m_ContactPointCount = 0;
+    for (uint32_t i = 0; i < 60; ++i)
+    {
+        StepParallelStepWorld(&world);
+    }
+    dmArray<VisualObject> expected_objects;
+    expected_objects.SetCapacity(world.m_BoxObjects.Size());
+    expected_objects.SetSize(world.m_BoxObjects.Size());
+    memcpy(expected_objects.Begin(), world.m_BoxObjects.Begin(), world.m_BoxObjects.Size() * sizeof(VisualObject));
+    int expected_contact_point_count = world.m_ContactPointCount;
+    ASSERT_LT(0, expected_contact_point_count);
+
+    ASSERT_TRUE(dmPhysics::RestoreWorld2D(world.m_World, state.Begin(), state.Size()));
+    for (uint32_t i = 0; i < world.m_BoxObjects.Size(); ++i)
+    {
+        ASSERT_EQ(snapshot_objects[i].m_Position.getX(), world.m_BoxObjects[i].m_Position.getX());
+        ASSERT_EQ(snapshot_objects[i].m_Position.getY(), world.m_BoxObjects[i].m_Position.getY());
+    }
+
+    // Stepping again from the restored state must give the exact same result
+    world.m_ContactPointCount = 0;
+    for (uint32_t i = 0; i < 60; ++i)
+    {
+        StepParallelStepWorld(&world);
+    }
+    ASSERT_EQ(expected_contact_point_count, world.m_ContactPointCount);
+    for (uint32_t i = 0; i < world.m_BoxObjects.Size(); ++i)
+    {
+        ASSERT_EQ(expected_objects[i].m_Position.getX(), world.m_BoxObjects[i].m_Position.getX());
+        ASSERT_EQ(expected_objects[i].m_Position.getY(), world.m_BoxObjects[i].m_Position.getY());
+        ASSERT_EQ(expected_objects[i].m_Rotation.getZ(), world.m_BoxObjects[i].m_Rotation.getZ());
+    }
+
+    // The state doesn't match a truncated state or a world with other collision objects
+    ASSERT_FALSE(dmPhysics::RestoreWorld2D(world.m_World, state.Begin(), state.Size() - 4));
+    dmPhysics::DeleteCollisionObject2D(world.m_World, world.m_Boxes.Back());
+    world.m_Boxes.Pop();
+    ASSERT_FALSE(dmPhysics::RestoreWorld2D(world.m_World, state.Begin(), state.Size()));
+
+    DeleteParallelStepWorld(&world);
+}
+
+TEST(PhysicsTest2D, SkipSleepingBodies)
+{
+    ParallelStepWorld world;
+    CreateParallelStepWorld(&world, 0, 0);
+
+    // Let the stacks come to rest
+    uint32_t sleeping_count = 0;
+    for (uint32_t i = 0; i < 60 * 20 && sleeping_count == 0; ++i)
+    {
+        StepParallelStepWorld(&world);
+        for (uint32_t j = 0; j < world.m_Boxes.Size(); ++j)
+        {
+            sleeping_count += dmPhysics::IsSleeping2D(world.m_Boxes[j]) ? 1 : 0;
+        }
+    }
+    ASSERT_LT(0u, sleeping_count);
+
+    // The transforms of the sleeping bodies aren't written back
+    const dmVMath::Point3 moved(-1000.0f, -1000.0f, 0.0f);
+    for (uint32_t j = 0; j < world.m_BoxObjects.Size(); ++j)
+    {
+        world.m_BoxObjects[j].m_Position = moved;
+    }
+    StepParallelStepWorld(&world);
+    for (uint32_t j = 0; j < world.m_Boxes.Size(); ++j)
+    {
+        bool written = world.m_BoxObjects[j].m_Position.getX() != moved.getX();
+        ASSERT_EQ(!dmPhysics::IsSleeping2D(world.m_Boxes[j]), written);
+    }
+
+    DeleteParallelStepWorld(&world);
+}
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);
@@ -0,0 +1,382 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "profile_capture.h"
+
+#include <stdio.h>
+#include <stdlib.h> // free
+#include <string.h> // strdup
+
+#include <dlib/array.h>
+#include <dlib/hash.h>
+#include <dlib/hashtable.h>
+#include <dlib/log.h>
+#include <dlib/math.h>
+
+namespace dmProfileCapture
+{
+    // A sample tree is flattened in depth first order
+    struct TreeSample
+    {
+        const char* m_Name;
+        uint64_t    m_Start;
+        uint64_t    m_Time;
+        uint32_t    m_Count;
+        uint32_t    m_Depth;
+    };
+
+    struct Capture
+    {
+        FILE*                   m_File;
+        dmHashTable32<uint32_t> m_ThreadIds;
+        dmHashTable32<double>   m_PropertyValues;
+        dmArray<TreeSample>     m_Tree;         // Scratch buffer
+        uint64_t                m_Time;         // The end of the latest root sample, used for the counters
+        uint32_t                m_EventCount;
+    };
+
+    struct HistoryTree
+    {
+        const char* m_ThreadName;
+        uint32_t    m_First;
+        uint32_t    m_Count;
+    };
+
+    struct HistoryFrame
+    {
+        dmArray<HistoryTree>    m_Trees;
+        dmArray<TreeSample>     m_Samples;
+    };
+
+    struct History
+    {
+        HistoryFrame*           m_Frames;       // dmArray doesn't construct the elements
+        uint32_t                m_MaxFrames;
+        dmHashTable32<char*>    m_Names;        // The sample names outlive the callbacks, so they're copied
+        uint32_t                m_Current;      // The frame being recorded
+        uint32_t                m_FrameCount;   // The number of recorded frames, including the current one
+    };
+
+    static void WriteString(FILE* file, const char* s)
+    {
+        fputc('"', file);
+        for (; *s; ++s)
+        {
+            unsigned char c = (unsigned char)*s;
+            if (c == '"' || c == '\\')
+            {
+                fputc('\\', file);
+                fputc(c, file);
+            }
+            else if (c < 0x20)
+            {
+                fprintf(file, "\\u%04x", c);
+            }
+            else
+            {
+                fputc(c, file);
+            }
+        }
+        fputc('"', file);
+    }
+
+    static void BeginEvent(Capture* capture)
+    {
+        fputs(capture->m_EventCount ? ",\n" : "\n", capture->m_File);
+        capture->m_EventCount++;
+    }
+
+    HCapture Open(const char* path)
+    {
+        FILE* file = fopen(path, "wb");
+        if (!file)
+        {
+            dmLogError("Failed to open the profile capture file '%s'", path);
+            return 0;
+        }
+
+        Capture* capture = new Capture;
+        capture->m_File = file;
+        capture->m_ThreadIds.SetCapacity(16, 32);
+        capture->m_PropertyValues.SetCapacity(128, 256);
+        capture->m_Time = 0;
+        capture->m_EventCount = 0;
+
+        fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+        return capture;
+    }
+
+    void Close(HCapture capture)
+    {
+        fputs("\n]}\n", capture->m_File);
+        fclose(capture->m_File);
+        delete capture;
+    }
+
+    uint32_t GetEventCount(HCapture capture)
+    {
+        return capture->m_EventCount;
+    }
+
+    static uint32_t GetThreadId(Capture* capture, const char* thread_name)
+    {
+        uint32_t name_hash = dmHashString32(thread_name);
+        uint32_t* id = capture->m_ThreadIds.Get(name_hash);
+        if (id)
+            return *id;
+
+        if (capture->m_ThreadIds.Full())
+            capture->m_ThreadIds.SetCapacity(capture->m_ThreadIds.Capacity(), capture->m_ThreadIds.Capacity() * 2);
+
+        uint32_t new_id = capture->m_ThreadIds.Size() + 1;
+        capture->m_ThreadIds.Put(name_hash, new_id);
+
+        BeginEvent(capture);
+        fprintf(capture->m_File, "{\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", new_id);
+        WriteString(capture->m_File, thread_name);
+        fputs("}}", capture->m_File);
+        return new_id;
+    }
+
+    static void FlattenSampleTree(dmArray<TreeSample>& out, dmProfile::HSample sample, uint32_t depth)
+    {
+        const char* name = dmProfile::SampleGetName(sample);
+
+        TreeSample tree_sample;
+        tree_sample.m_Name = name ? name : "<empty_sample_name>";
+        tree_sample.m_Start = dmProfile::SampleGetStart(sample);
+        tree_sample.m_Time = dmProfile::SampleGetTime(sample);
+        tree_sample.m_Count = dmProfile::SampleGetCallCount(sample);
+        tree_sample.m_Depth = depth;
+
+        if (out.Full())
+            out.OffsetCapacity(dmMath::Max(64U, out.Capacity()));
+        out.Push(tree_sample);
+
+        dmProfile::SampleIterator iter;
+        dmProfile::SampleIterateChildren(sample, &iter);
+        while (dmProfile::SampleIterateNext(&iter))
+        {
+            FlattenSampleTree(out, iter.m_Sample, depth + 1);
+        }
+    }
+
+    static const uint32_t MAX_TREE_DEPTH = 64;
+
+    static void WriteSampleTree(Capture* capture, const char* thread_name, const TreeSample* samples, uint32_t count)
+    {
+        uint32_t tid = GetThreadId(capture, thread_name);
+
+        // The children are laid out one after the other, since their calls are aggregated,
+        // and the trace viewers expect the slices to nest within the parent.
+        // These are the next free time, and the end, of the open parents
+        uint64_t cursors[MAX_TREE_DEPTH];
+        uint64_t ends[MAX_TREE_DEPTH];
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const TreeSample& sample = samples[i];
+            if (sample.m_Depth >= MAX_TREE_DEPTH)
+                continue;
+
+            uint64_t start = sample.m_Start;
+            uint64_t time = sample.m_Time;
+            if (sample.m_Depth > 0)
+            {
+                uint64_t cursor = cursors[sample.m_Depth - 1];
+                uint64_t end = ends[sample.m_Depth - 1];
+                time = dmMath::Min(time, end - cursor);
+                start = dmMath::Max(start, cursor);
+                if (start + time > end)
+                    start = end - time;
+                cursors[sample.m_Depth - 1] = start + time;
+            }
+            cursors[sample.m_Depth] = start;
+            ends[sample.m_Depth] = start + time;
+
+            BeginEvent(capture);
+            fprintf(capture->m_File, "{\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%llu,\"dur\":%llu,\"name\":", tid, (unsigned long long)start, (unsigned long long)time);
+            WriteString(capture->m_File, sample.m_Name);
+            fprintf(capture->m_File, ",\"args\":{\"calls\":%u}}", sample.m_Count);
+        }
+
+        if (count)
+            capture->m_Time = dmMath::Max(capture->m_Time, samples[0].m_Start + samples[0].m_Time);
+    }
+
+    void AddSampleTree(HCapture capture, const char* thread_name, dmProfile::HSample root)
+    {
+        capture->m_Tree.SetSize(0);
+        FlattenSampleTree(capture->m_Tree, root, 0);
+        WriteSampleTree(capture, thread_name, capture->m_Tree.Begin(), capture->m_Tree.Size());
+    }
+
+    void AddMarker(HCapture capture, const char* name, uint64_t time)
+    {
+        BeginEvent(capture);
+        fprintf(capture->m_File, "{\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":%llu,\"name\":", (unsigned long long)time);
+        WriteString(capture->m_File, name);
+        fputs("}", capture->m_File);
+    }
+
+    static void AddProperty(Capture* capture, dmProfile::HProperty property)
+    {
+        dmProfile::PropertyType type = dmProfile::PropertyGetType(property);
+        dmProfile::PropertyValue value = dmProfile::PropertyGetValue(property);
+
+        double number;
+        switch (type)
+        {
+        case dmProfile::PROPERTY_TYPE_BOOL: number = value.m_Bool ? 1.0 : 0.0; break;
+        case dmProfile::PROPERTY_TYPE_S32:  number = value.m_S32; break;
+        case dmProfile::PROPERTY_TYPE_U32:  number = value.m_U32; break;
+        case dmProfile::PROPERTY_TYPE_F32:  number = value.m_F32; break;
+        case dmProfile::PROPERTY_TYPE_S64:  number = (double)value.m_S64; break;
+        case dmProfile::PROPERTY_TYPE_U64:  number = (double)value.m_U64; break;
+        case dmProfile::PROPERTY_TYPE_F64:  number = value.m_F64; break;
+        default: return; // Groups
+        }
+
+        const char* name = dmProfile::PropertyGetName(property);
+        if (!name)
+            return;
+
+        uint32_t name_hash = dmHashString32(name);
+        double* prev = capture->m_PropertyValues.Get(name_hash);
+        if (prev && *prev == number)
+            return;
+
+        if (prev)
+        {
+            *prev = number;
+        }
+        else
+        {
+            if (capture->m_PropertyValues.Full())
+                capture->m_PropertyValues.SetCapacity(capture->m_PropertyValues.Capacity(), capture->m_PropertyValues.Capacity() * 2);
+            capture->m_PropertyValues.Put(name_hash, number);
+        }
+
+        BeginEvent(capture);
+        fprintf(capture->m_File, "{\"ph\":\"C\",\"pid\":0,\"ts\":%llu,\"name\":", (unsigned long long)capture->m_Time);
+        WriteString(capture->m_File, name);
+        fprintf(capture->m_File, ",\"args\":{\"value\":%.15g}}", number);
+    }
+
+    static void AddPropertyTree(Capture* capture, dmProfile::HProperty property)
+    {
+        AddProperty(capture, property);
+
+        dmProfile::PropertyIterator iter;
+        dmProfile::PropertyIterateChildren(property, &iter);
+        while (dmProfile::PropertyIterateNext(&iter))
+        {
+            AddPropertyTree(capture, iter.m_Property);
+        }
+    }
+
+    void AddProperties(HCapture capture, dmProfile::HProperty root)
+    {
+        dmProfile::PropertyIterator iter;
+        dmProfile::PropertyIterateChildren(root, &iter);
+        while (dmProfile::PropertyIterateNext(&iter))
+        {
+            AddPropertyTree(capture, iter.m_Property);
+        }
+    }
+
+    // *******************************************************************
+
+    HHistory NewHistory(uint32_t frame_count)
+    {
+        History* history = new History;
+        // The frames, and the one being recorded
+        history->m_MaxFrames = dmMath::Max(frame_count, 1U) + 1;
+        history->m_Frames = new HistoryFrame[history->m_MaxFrames];
+        history->m_Names.SetCapacity(256, 512);
+        history->m_Current = 0;
+        history->m_FrameCount = 1;
+        return history;
+    }
+
+    static void FreeName(void*, const uint32_t* key, char** name)
+    {
+        free(*name);
+    }
+
+    void DeleteHistory(HHistory history)
+    {
+        history->m_Names.Iterate(FreeName, (void*)0);
+        delete [] history->m_Frames;
+        delete history;
+    }
+
+    static const char* GetHistoryName(History* history, const char* name)
+    {
+        uint32_t name_hash = dmHashString32(name);
+        char** stored = history->m_Names.Get(name_hash);
+        if (stored)
+            return *stored;
+
+        if (history->m_Names.Full())
+            history->m_Names.SetCapacity(history->m_Names.Capacity(), history->m_Names.Capacity() * 2);
+        char* copy = strdup(name);
+        history->m_Names.Put(name_hash, copy);
+        return copy;
+    }
+
+    void RecordSampleTree(HHistory history, const char* thread_name, dmProfile::HSample root, bool end_frame)
+    {
+        HistoryFrame& frame = history->m_Frames[history->m_Current];
+
+        HistoryTree tree;
+        tree.m_ThreadName = GetHistoryName(history, thread_name);
+        tree.m_First = frame.m_Samples.Size();
+        FlattenSampleTree(frame.m_Samples, root, 0);
+        tree.m_Count = frame.m_Samples.Size() - tree.m_First;
+
+        for (uint32_t i = tree.m_First; i < frame.m_Samples.Size(); ++i)
+        {
+            frame.m_Samples[i].m_Name = GetHistoryName(history, frame.m_Samples[i].m_Name);
+        }
+
+        frame.m_Trees.PushGrow(tree);
+
+        if (end_frame)
+        {
+            // The oldest frame is reused, with the memory of its arrays
+            history->m_Current = (history->m_Current + 1) % history->m_MaxFrames;
+            history->m_FrameCount = dmMath::Min(history->m_FrameCount + 1, history->m_MaxFrames);
+
+            HistoryFrame& next = history->m_Frames[history->m_Current];
+            next.m_Trees.SetSize(0);
+            next.m_Samples.SetSize(0);
+        }
+    }
+
+    void WriteHistory(HHistory history, HCapture capture)
+    {
+        uint32_t frames = history->m_MaxFrames;
+        uint32_t first = (history->m_Current + frames - (history->m_FrameCount - 1)) % frames;
+        for (uint32_t i = 0; i < history->m_FrameCount; ++i)
+        {
+            const HistoryFrame& frame = history->m_Frames[(first + i) % frames];
+            for (uint32_t t = 0; t < frame.m_Trees.Size(); ++t)
+            {
+                const HistoryTree& tree = frame.m_Trees[t];
+                WriteSampleTree(capture, tree.m_ThreadName, &frame.m_Samples[tree.m_First], tree.m_Count);
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_PROFILE_CAPTURE_H
+#define DM_PROFILE_CAPTURE_H
+
+#include <stdint.h>
+#include <dlib/profile.h>
+
+namespace dmProfileCapture
+{
+    typedef struct Capture* HCapture;
+
+    /**
+     * Opens a capture file, in the Chrome trace event json format (which Perfetto also reads).
+     * The events are streamed to the file as they're added.
+     * @param path the file path
+     * @return the capture, or 0 if the file couldn't be opened
+     */
+    HCapture Open(const char* path);
+
+    /**
+     * Ends the trace and closes the file
+     */
+    void Close(HCapture capture);
+
+    /**
+     * Adds a sample tree, as given by the dmProfile sample tree callback.
+     * The calls of each sample are aggregated, so it's added as one slice, with the call count
+     */
+    void AddSampleTree(HCapture capture, const char* thread_name, dmProfile::HSample root);
+
+    /**
+     * Adds the properties that changed since the last time, as counters
+     */
+    void AddProperties(HCapture capture, dmProfile::HProperty root);
+
+    /**
+     * Adds a global instant event, e.g. to mark a spike
+     * @param time the time, in the same time base as the samples
+     */
+    void AddMarker(HCapture capture, const char* name, uint64_t time);
+
+    /**
+     * Gets the number of events added to the file
+     */
+    uint32_t GetEventCount(HCapture capture);
+
+    typedef struct History* HHistory;
+
+    /**
+     * Creates a rolling history of the sample trees of the last frame_count frames
+     */
+    HHistory NewHistory(uint32_t frame_count);
+    void DeleteHistory(HHistory history);
+
+    /**
+     * Records a sample tree in the current frame
+     * @param end_frame if true, the current frame ends after the tree (e.g. for the root sample of the main thread)
+     */
+    void RecordSampleTree(HHistory history, const char* thread_name, dmProfile::HSample root, bool end_frame);
+
+    /**
+     * Adds the recorded frames to the capture, oldest first
+     */
+    void WriteHistory(HHistory history, HCapture capture);
+}
+
+#endif // DM_PROFILE_CAPTURE_H
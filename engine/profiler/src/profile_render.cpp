@@ -863,9 +863,7 @@ namespace dmProfileRender
         prop.m_Type = type;
         prop.m_Indent = (uint8_t)indent;
 
-        if (frame->m_Properties.Full())
-            frame->m_Properties.OffsetCapacity(32);
-        frame->m_Properties.Push(prop);
+        frame->m_Properties.PushGrow(prop);
     }
 
 
@@ -12,18 +12,29 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "profiler.h"
 
+#include <dlib/array.h>
 #include <dlib/dlib.h>
+#include <dlib/dstrings.h>
 #include <dlib/hash.h>
+#include <dlib/hashtable.h>
 #include <dlib/log.h>
+#include <dlib/math.h>
+#include <dlib/memory.h>
+#include <dlib/path.h>
 #include <dlib/profile.h>
+#include <dlib/sys.h>
 #include <dlib/time.h>
 
 #include <render/render.h>
 #include <script/script.h>
 
 #include "profiler_private.h"
+#include "profile_capture.h"
 #include "profile_render.h"
 
 #include <algorithm> // std::sort
@@ -35,6 +46,27 @@ DM_PROPERTY_GROUP(rmtp_Profiler, "Profiler");
 DM_PROPERTY_U32(rmtp_CpuUsage, 0, FrameReset, "%% Cpu Usage", &rmtp_Profiler);
 DM_PROPERTY_U32(rmtp_Memory, 0, FrameReset, "Memory usage in kb", &rmtp_Profiler);
 
+// The memory tracked per subsystem, see dmMemory::Tag
+DM_PROPERTY_GROUP(rmtp_MemoryTags, "Memory in use (kb)", &rmtp_Profiler);
+DM_PROPERTY_U32(rmtp_MemoryRender, 0, NoFlags, "render", &rmtp_MemoryTags);
+DM_PROPERTY_U32(rmtp_MemoryGui, 0, NoFlags, "gui", &rmtp_MemoryTags);
+DM_PROPERTY_U32(rmtp_MemoryPhysics, 0, NoFlags, "physics", &rmtp_MemoryTags);
+DM_PROPERTY_U32(rmtp_MemoryLua, 0, NoFlags, "lua", &rmtp_MemoryTags);
+DM_PROPERTY_U32(rmtp_MemorySound, 0, NoFlags, "sound", &rmtp_MemoryTags);
+DM_PROPERTY_U32(rmtp_MemoryResource, 0, NoFlags, "resource", &rmtp_MemoryTags);
+// Only counted when an allocator is set with dmMemory::SetAllocator
+DM_PROPERTY_U32(rmtp_MemoryAllocator, 0, NoFlags, "allocator", &rmtp_MemoryTags);
+
+// Only counted when running with the memory profiler library
+DM_PROPERTY_GROUP(rmtp_MemoryTagAllocations, "Memory allocated per frame (kb)", &rmtp_Profiler);
+DM_PROPERTY_U32(rmtp_AllocatedRender, 0, FrameReset, "render", &rmtp_MemoryTagAllocations);
+DM_PROPERTY_U32(rmtp_AllocatedGui, 0, FrameReset, "gui", &rmtp_MemoryTagAllocations);
+DM_PROPERTY_U32(rmtp_AllocatedPhysics, 0, FrameReset, "physics", &rmtp_MemoryTagAllocations);
+DM_PROPERTY_U32(rmtp_AllocatedLua, 0, FrameReset, "lua", &rmtp_MemoryTagAllocations);
+DM_PROPERTY_U32(rmtp_AllocatedSound, 0, FrameReset, "sound", &rmtp_MemoryTagAllocations);
+DM_PROPERTY_U32(rmtp_AllocatedResource, 0, FrameReset, "resource", &rmtp_MemoryTagAllocations);
+DM_PROPERTY_U32(rmtp_AllocatedUntagged, 0, FrameReset, "untagged", &rmtp_MemoryTagAllocations);
+
 namespace dmProfiler
 {
 
@@ -52,17 +84,177 @@ static uint32_t g_ProfilerPort = 0; // 0 means use the default port of the curre
 static bool g_TrackCpuUsage = false;
 static dmProfileRender::HRenderProfile gRenderProfile = 0;
 static uint32_t gUpdateFrequency = 60;
+static uint32_t g_TagAllocated[dmMemory::TAG_COUNT] = {0}; // The allocated bytes at the previous update
 
 static dmProfileRender::ProfilerFrame*  g_ProfilerCurrentFrame = 0;
 static dmMutex::HMutex                  g_ProfilerMutex = 0;
 static dmHashTable64<int>               g_ProfilerThreadSortOrder;
 
+static dmProfileCapture::HCapture       g_ProfilerCapture = 0;
+static dmMutex::HMutex                  g_ProfilerCaptureMutex = 0;
+static const char*                      DEFAULT_CAPTURE_PATH = "profile_capture.json";
+static char                             g_ProfilerCapturePath[1024] = {0};
+
+// Spike captures, guarded by the capture mutex
+static dmProfileCapture::HHistory       g_ProfilerSpikeHistory = 0;
+static uint64_t                         g_ProfilerSpikeThreshold = 0;   // us
+static uint64_t                         g_ProfilerSpikeInterval = 0;    // us, between two spike files
+static uint32_t                         g_ProfilerSpikeFramesAfter = 0;
+static uint32_t                         g_ProfilerSpikeMaxFiles = 0;
+static uint32_t                         g_ProfilerSpikeFramesLeft = 0;  // Until the pending spike is written
+static uint32_t                         g_ProfilerSpikeCount = 0;
+static uint64_t                         g_ProfilerSpikeStart = 0;
+static uint64_t                         g_ProfilerSpikeFrameTime = 0;
+static uint64_t                         g_ProfilerSpikeWriteTime = 0;
+static char                             g_ProfilerSpikeDir[DMPATH_MAX_PATH] = {0};
+
+// The scope times of the main thread, summed over the frames (see StartScopeStats)
+struct ScopeStatsEntry
+{
+    char*    m_Name;
+    uint64_t m_Time;
+    uint64_t m_MaxFrameTime;
+    uint64_t m_FrameTime;   // In the current frame
+    uint32_t m_Count;
+    uint32_t m_FrameCount;
+};
+
+static dmHashTable32<ScopeStatsEntry>   g_ProfilerScopeStats;
+static bool                             g_ProfilerScopeStatsEnabled = false;
+
+// The per frame scope listener, guarded by the capture mutex (see SetFrameCallback)
+static FFrameCallback                   g_ProfilerFrameCallback = 0;
+static void*                            g_ProfilerFrameCallbackCtx = 0;
+static dmArray<FrameScope>              g_ProfilerFrameScopes;
+
 
 void SetUpdateFrequency(uint32_t update_frequency)
 {
     gUpdateFrequency = update_frequency;
 }
 
+bool StartCapture(const char* path)
+{
+    if (!g_ProfilerCaptureMutex) // Not initialized, or using the null implementation
+        return false;
+
+    DM_MUTEX_SCOPED_LOCK(g_ProfilerCaptureMutex);
+    if (g_ProfilerCapture)
+    {
+        dmProfileCapture::Close(g_ProfilerCapture);
+        g_ProfilerCapture = 0;
+    }
+
+    if (!path || !path[0])
+        path = g_ProfilerCapturePath[0] ? g_ProfilerCapturePath : DEFAULT_CAPTURE_PATH;
+
+    g_ProfilerCapture = dmProfileCapture::Open(path);
+    if (!g_ProfilerCapture)
+        return false;
+
+    dmLogInfo("Started profile capture to '%s'", path);
+    return true;
+}
+
+void StopCapture()
+{
+    if (!g_ProfilerCaptureMutex)
+        return;
+
+    DM_MUTEX_SCOPED_LOCK(g_ProfilerCaptureMutex);
+    if (g_ProfilerCapture)
+    {
+        dmLogInfo("Stopped profile capture (%u events)", dmProfileCapture::GetEventCount(g_ProfilerCapture));
+        dmProfileCapture::Close(g_ProfilerCapture);
+        g_ProfilerCapture = 0;
+    }
+}
+
+bool IsCapturing()
+{
+    if (!g_ProfilerCaptureMutex)
+        return false;
+
+    DM_MUTEX_SCOPED_LOCK(g_ProfilerCaptureMutex);
+    return g_ProfilerCapture != 0;
+}
+
+static void FreeScopeStatsName(void*, const uint32_t* key, ScopeStatsEntry* entry)
+{
+    free(entry->m_Name);
+}
+
+bool StartScopeStats()
+{
+    if (!g_ProfilerCaptureMutex)
+        return false;
+
+    DM_MUTEX_SCOPED_LOCK(g_ProfilerCaptureMutex);
+    g_ProfilerScopeStats.Iterate(FreeScopeStatsName, (void*)0);
+    g_ProfilerScopeStats.Clear();
+    g_ProfilerScopeStatsEnabled = true;
+    return true;
+}
+
+void StopScopeStats()
+{
+    if (!g_ProfilerCaptureMutex)
+        return;
+
+    DM_MUTEX_SCOPED_LOCK(g_ProfilerCaptureMutex);
+    g_ProfilerScopeStatsEnabled = false;
+}
+
+struct IterateScopeStatsContext
+{
+    void*               m_Context;
+    FScopeStatsCallback m_Callback;
+    uint64_t            m_TicksPerSecond;
+};
+
+static void IterateScopeStatsEntry(IterateScopeStatsContext* ctx, const uint32_t* key, ScopeStatsEntry* entry)
+{
+    ScopeStats stats;
+    stats.m_Name = entry->m_Name;
+    stats.m_Time = entry->m_Time * 1000000 / ctx->m_TicksPerSecond;
+    stats.m_MaxFrameTime = entry->m_MaxFrameTime * 1000000 / ctx->m_TicksPerSecond;
+    stats.m_Count = entry->m_Count;
+    stats.m_FrameCount = entry->m_FrameCount;
+    ctx->m_Callback(ctx->m_Context, &stats);
+}
+
+void IterateScopeStats(void* ctx, FScopeStatsCallback callback)
+{
+    if (!g_ProfilerCaptureMutex)
+        return;
+
+    IterateScopeStatsContext iterate_ctx;
+    iterate_ctx.m_Context = ctx;
+    iterate_ctx.m_Callback = callback;
+    iterate_ctx.m_TicksPerSecond = dmMath::Max((uint64_t)1, dmProfile::GetTicksPerSecond());
+
+    DM_MUTEX_SCOPED_LOCK(g_ProfilerCaptureMutex);
+    g_ProfilerScopeStats.Iterate(IterateScopeStatsEntry, &iterate_ctx);
+}
+
+bool SetFrameCallback(void* ctx, FFrameCallback callback)
+{
+    if (!g_ProfilerCaptureMutex)
+        return false;
+
+    DM_MUTEX_SCOPED_LOCK(g_ProfilerCaptureMutex);
+    g_ProfilerFrameCallback = callback;
+    g_ProfilerFrameCallbackCtx = ctx;
+    if (!callback)
+        g_ProfilerFrameScopes.SetCapacity(0);
+    return true;
+}
+
+uint64_t GetMemoryUsage()
+{
+    return dmProfilerExt::GetMemoryUsage();
+}
+
 void ToggleProfiler()
 {
     if (gRenderProfile)
@@ -521,6 +713,180 @@ static int ProfilerScopeEnd(lua_State* L)
 }
 
 
+/*# start sampling the Lua call stacks
+ *
+ * Starts the Lua sampling profiler. At most once per interval, the Lua call stack is recorded, and
+ * the samples are aggregated per function and per source line. It can be used in release builds.
+ * The samples are also available in the web profiler, and the number of samples per frame is shown in Remotery.
+ *
+ * The samples of the previous run are kept, see `profiler.reset_lua_sampling()`.
+ *
+ * @note On platforms using LuaJIT, code in JIT compiled traces isn't sampled.
+ *
+ * @name profiler.start_lua_sampling
+ * @param [interval] [type:number] time between the samples in seconds. Defaults to 0.001
+ *
+ * @examples
+ * ```lua
+ * profiler.start_lua_sampling()
+ * ```
+ */
+static int ProfilerStartLuaSampling(lua_State* L)
+{
+    DM_LUA_STACK_CHECK(L, 0);
+
+    lua_Number interval = luaL_optnumber(L, 1, 0.001);
+    if (interval < 0)
+    {
+        return DM_LUA_ERROR("The interval must be positive");
+    }
+
+    dmScript::StartLuaProfiler(dmScript::GetMainThread(L), (uint32_t)(interval * 1000000.0));
+    return 0;
+}
+
+/*# stop sampling the Lua call stacks
+ *
+ * Stops the Lua sampling profiler. The functions with the most samples are logged to the profiler.
+ *
+ * @name profiler.stop_lua_sampling
+ */
+static int ProfilerStopLuaSampling(lua_State* L)
+{
+    DM_LUA_STACK_CHECK(L, 0);
+    dmScript::StopLuaProfiler();
+    return 0;
+}
+
+/*# remove the Lua samples
+ *
+ * Removes the samples taken by the Lua sampling profiler.
+ *
+ * @name profiler.reset_lua_sampling
+ */
+static int ProfilerResetLuaSampling(lua_State* L)
+{
+    DM_LUA_STACK_CHECK(L, 0);
+    dmScript::ResetLuaProfiler();
+    return 0;
+}
+
+static void PushLuaSamplingEntry(void* ctx, const dmScript::LuaProfilerEntry* entry)
+{
+    lua_State* L = (lua_State*)ctx;
+    lua_createtable(L, 0, 5);
+    lua_pushstring(L, entry->m_Source);
+    lua_setfield(L, -2, "source");
+    lua_pushstring(L, entry->m_Name);
+    lua_setfield(L, -2, "name");
+    lua_pushnumber(L, entry->m_Line);
+    lua_setfield(L, -2, "line");
+    lua_pushnumber(L, entry->m_SelfSamples);
+    lua_setfield(L, -2, "self");
+    lua_pushnumber(L, entry->m_TotalSamples);
+    lua_setfield(L, -2, "total");
+    lua_rawseti(L, -2, (int)lua_objlen(L, -2) + 1);
+}
+
+/*# get the Lua samples
+ *
+ * Gets the samples taken by the Lua sampling profiler, aggregated per function and per source line.
+ * Each entry is a table with the following fields:
+ *
+ * `source`
+ * : [type:string] the source file
+ *
+ * `name`
+ * : [type:string] the function name, or "?" if it isn't known
+ *
+ * `line`
+ * : [type:number] the line of the function definition (functions), or the source line (lines). 0 if not known
+ *
+ * `self`
+ * : [type:number] the number of samples taken while the function or line was running
+ *
+ * `total`
+ * : [type:number] the number of samples where the function or line was on the call stack
+ *
+ * @name profiler.get_lua_samples
+ * @return samples [type:table] a table with the fields `count` (the number of samples), `functions` and `lines`
+ *
+ * @examples
+ * ```lua
+ * local samples = profiler.get_lua_samples()
+ * table.sort(samples.functions, function(a, b) return a.self > b.self end)
+ * for i = 1, math.min(10, #samples.functions) do
+ *     local f = samples.functions[i]
+ *     print(f.source, f.line, f.name, f.self * 100 / samples.count)
+ * end
+ * ```
+ */
+static int ProfilerGetLuaSamples(lua_State* L)
+{
+    DM_LUA_STACK_CHECK(L, 1);
+
+    lua_createtable(L, 0, 3);
+    lua_pushnumber(L, dmScript::GetLuaProfilerSampleCount());
+    lua_setfield(L, -2, "count");
+
+    lua_newtable(L);
+    dmScript::IterateLuaProfilerEntries(dmScript::LUA_PROFILER_ENTRY_FUNCTION, PushLuaSamplingEntry, L);
+    lua_setfield(L, -2, "functions");
+
+    lua_newtable(L);
+    dmScript::IterateLuaProfilerEntries(dmScript::LUA_PROFILER_ENTRY_LINE, PushLuaSamplingEntry, L);
+    lua_setfield(L, -2, "lines");
+    return 1;
+}
+
+/*# start a profile capture
+ *
+ * Starts writing the profiler samples of all threads, and the properties, to a file in the Chrome trace
+ * event format, which can be opened in Perfetto (https://ui.perfetto.dev) or in chrome://tracing.
+ * The events are written to the file as they come, until the capture is stopped.
+ * A running capture is stopped first.
+ *
+ * The calls of each scope are aggregated per frame, and are shown as one slice, with the call count.
+ *
+ * A capture can also be started at launch, by setting `profiler.capture` to the file path, e.g.
+ * with the command line argument `--config=profiler.capture=capture.json`,
+ * or from the engine service at `/profile_capture/start` and `/profile_capture/stop`.
+ *
+ * [icon:attention] Only available in debug builds.
+ *
+ * @name profiler.start_capture
+ * @param [path] [type:string] the file to write to. Defaults to the `profiler.capture` setting or "profile_capture.json"
+ *
+ * @examples
+ * ```lua
+ * profiler.start_capture("level_load.json")
+ * ```
+ */
+static int ProfilerStartCapture(lua_State* L)
+{
+    DM_LUA_STACK_CHECK(L, 0);
+
+    const char* path = luaL_optstring(L, 1, 0);
+    if (!StartCapture(path))
+    {
+        return DM_LUA_ERROR("Failed to start the profile capture");
+    }
+    return 0;
+}
+
+/*# stop the profile capture
+ *
+ * Stops the profile capture, and closes the file.
+ *
+ * @name profiler.stop_capture
+ */
+static int ProfilerStopCapture(lua_State* L)
+{
+    DM_LUA_STACK_CHECK(L, 0);
+    StopCapture();
+    return 0;
+}
+
 /*# continously show latest frame
 *
 * @name profiler.MODE_RUN
@@ -568,9 +934,7 @@ static void ProcessSample(dmProfileRender::ProfilerThread* thread, int indent, d
     const char* name = dmProfile::SampleGetName(sample);
     out.m_NameHash = dmHashString32(name?name:"<empty_sample_name>");
 
-    if (thread->m_Samples.Full())
-        thread->m_Samples.OffsetCapacity(32);
-    thread->m_Samples.Push(out);
+    thread->m_Samples.PushGrow(out);
 }
 
 static void TraverseSampleTree(dmProfileRender::ProfilerThread* thread, int indent, dmProfile::HSample sample)
@@ -585,11 +949,153 @@ static void TraverseSampleTree(dmProfileRender::ProfilerThread* thread, int inde
     }
 }
 
+static void WriteSpikeCapture()
+{
+    char name[64];
+    dmSnPrintf(name, sizeof(name), "profile_spike_%u.json", g_ProfilerSpikeCount % g_ProfilerSpikeMaxFiles);
+    char path[DMPATH_MAX_PATH];
+    dmPath::Concat(g_ProfilerSpikeDir, name, path, sizeof(path));
+
+    dmProfileCapture::HCapture capture = dmProfileCapture::Open(path);
+    if (!capture)
+        return;
+
+    char marker[64];
+    dmSnPrintf(marker, sizeof(marker), "Spike %.2f ms", g_ProfilerSpikeFrameTime / 1000.0);
+    dmProfileCapture::WriteHistory(g_ProfilerSpikeHistory, capture);
+    dmProfileCapture::AddMarker(capture, marker, g_ProfilerSpikeStart);
+    dmProfileCapture::Close(capture);
+
+    dmLogInfo("Frame time spike of %.2f ms, wrote profile capture to '%s'", g_ProfilerSpikeFrameTime / 1000.0, path);
+    ++g_ProfilerSpikeCount;
+}
+
+static void AddScopeStatsSample(dmProfile::HSample sample)
+{
+    uint32_t name_hash = dmProfile::SampleGetNameHash(sample);
+    ScopeStatsEntry* entry = g_ProfilerScopeStats.Get(name_hash);
+    if (!entry)
+    {
+        if (g_ProfilerScopeStats.Full())
+            g_ProfilerScopeStats.SetCapacity(g_ProfilerScopeStats.Capacity()/2 + 64, g_ProfilerScopeStats.Capacity() + 128);
+
+        const char* name = dmProfile::SampleGetName(sample);
+        ScopeStatsEntry new_entry;
+        memset(&new_entry, 0, sizeof(new_entry));
+        new_entry.m_Name = strdup(name ? name : "<empty_sample_name>");
+        g_ProfilerScopeStats.Put(name_hash, new_entry);
+        entry = g_ProfilerScopeStats.Get(name_hash);
+    }
+    entry->m_FrameTime += dmProfile::SampleGetTime(sample);
+    entry->m_Count += dmProfile::SampleGetCallCount(sample);
+
+    dmProfile::SampleIterator iter;
+    dmProfile::SampleIterateChildren(sample, &iter);
+    while (dmProfile::SampleIterateNext(&iter))
+    {
+        AddScopeStatsSample(iter.m_Sample);
+    }
+}
+
+static void AddFrameScopeSample(dmProfile::HSample sample, uint64_t ticks_per_second)
+{
+    uint32_t name_hash = dmProfile::SampleGetNameHash(sample);
+    FrameScope* scope = 0;
+    for (uint32_t i = 0; i < g_ProfilerFrameScopes.Size(); ++i)
+    {
+        if (g_ProfilerFrameScopes[i].m_NameHash == name_hash)
+        {
+            scope = &g_ProfilerFrameScopes[i];
+            break;
+        }
+    }
+    if (!scope)
+    {
+        const char* name = dmProfile::SampleGetName(sample);
+        FrameScope new_scope = {name ? name : "<empty_sample_name>", name_hash, 0, 0};
+        if (g_ProfilerFrameScopes.Full())
+            g_ProfilerFrameScopes.OffsetCapacity(64);
+        g_ProfilerFrameScopes.Push(new_scope);
+        scope = &g_ProfilerFrameScopes.Back();
+    }
+    scope->m_Time += (uint32_t)(dmProfile::SampleGetTime(sample) * 1000000 / ticks_per_second);
+    scope->m_Count += dmProfile::SampleGetCallCount(sample);
+
+    dmProfile::SampleIterator iter;
+    dmProfile::SampleIterateChildren(sample, &iter);
+    while (dmProfile::SampleIterateNext(&iter))
+    {
+        AddFrameScopeSample(iter.m_Sample, ticks_per_second);
+    }
+}
+
+static void EndScopeStatsFrame(void*, const uint32_t* key, ScopeStatsEntry* entry)
+{
+    if (entry->m_FrameTime == 0 && entry->m_Count == 0)
+        return;
+    entry->m_Time += entry->m_FrameTime;
+    entry->m_MaxFrameTime = dmMath::Max(entry->m_MaxFrameTime, entry->m_FrameTime);
+    entry->m_FrameCount++;
+    entry->m_FrameTime = 0;
+}
+
+// Keeps a rolling history of the frames, and writes it to a file when a frame exceeds the threshold
+static void RecordSpikeHistory(const char* thread_name, dmProfile::HSample root)
+{
+    // The "Frame" scope is the root of the main thread
+    bool end_frame = strcmp(thread_name, "Main") == 0;
+    dmProfileCapture::RecordSampleTree(g_ProfilerSpikeHistory, thread_name, root, end_frame);
+    if (!end_frame)
+        return;
+
+    uint64_t frame_start = dmProfile::SampleGetStart(root);
+    uint64_t frame_time = dmProfile::SampleGetTime(root);
+    if (g_ProfilerSpikeFramesLeft == 0 && frame_time > g_ProfilerSpikeThreshold)
+    {
+        bool rate_limited = g_ProfilerSpikeCount > 0 && frame_start < g_ProfilerSpikeWriteTime + g_ProfilerSpikeInterval;
+        if (!rate_limited)
+        {
+            // The frames after the spike are recorded before the file is written
+            g_ProfilerSpikeFramesLeft = g_ProfilerSpikeFramesAfter + 1;
+            g_ProfilerSpikeStart = frame_start;
+            g_ProfilerSpikeFrameTime = frame_time;
+        }
+    }
+
+    if (g_ProfilerSpikeFramesLeft > 0 && --g_ProfilerSpikeFramesLeft == 0)
+    {
+        WriteSpikeCapture();
+        g_ProfilerSpikeWriteTime = frame_start + frame_time;
+    }
+}
+
 static void SampleTreeCallback(void* _ctx, const char* thread_name, dmProfile::HSample root)
 {
     if (g_ProfilerCurrentFrame == 0) // Possibly in the process of shutting down
         return;
 
+    // The captures get all the threads
+    {
+        DM_MUTEX_SCOPED_LOCK(g_ProfilerCaptureMutex);
+        if (g_ProfilerCapture)
+            dmProfileCapture::AddSampleTree(g_ProfilerCapture, thread_name, root);
+        if (g_ProfilerSpikeHistory)
+            RecordSpikeHistory(thread_name, root);
+        if (g_ProfilerScopeStatsEnabled && strcmp(thread_name, "Main") == 0)
+        {
+            AddScopeStatsSample(root);
+            g_ProfilerScopeStats.Iterate(EndScopeStatsFrame, (void*)0);
+        }
+        if (g_ProfilerFrameCallback && strcmp(thread_name, "Main") == 0)
+        {
+            uint64_t ticks_per_second = dmMath::Max((uint64_t)1, dmProfile::GetTicksPerSecond());
+            g_ProfilerFrameScopes.SetSize(0);
+            AddFrameScopeSample(root, ticks_per_second);
+            uint64_t frame_time = dmProfile::SampleGetTime(root) * 1000000 / ticks_per_second;
+            g_ProfilerFrameCallback(g_ProfilerFrameCallbackCtx, frame_time, g_ProfilerFrameScopes.Begin(), g_ProfilerFrameScopes.Size());
+        }
+    }
+
     // TODO: Make a better selection scheme, letting the user step through the threads one by one
     if (strcmp(thread_name, "Main") != 0)
         return;
@@ -645,6 +1151,12 @@ static void PropertyTreeCallback(void* _ctx, dmProfile::HProperty root)
     if (g_ProfilerCurrentFrame == 0) // Possibly in the process of shutting down
         return;
 
+    {
+        DM_MUTEX_SCOPED_LOCK(g_ProfilerCaptureMutex);
+        if (g_ProfilerCapture)
+            dmProfileCapture::AddProperties(g_ProfilerCapture, root);
+    }
+
     DM_MUTEX_SCOPED_LOCK(g_ProfilerMutex);
 
     dmProfile::PropertyIterator iter;
@@ -667,6 +1179,13 @@ static dmExtension::Result InitializeProfiler(dmExtension::Params* params)
         dmProfiler::g_TrackCpuUsage = true;
     }
 
+    // Sample the Lua call stacks from the start, e.g. to profile the loading
+    if (dmConfigFile::GetInt(params->m_ConfigFile, "profiler.lua_sampling", 0) == 1)
+    {
+        float interval = dmConfigFile::GetFloat(params->m_ConfigFile, "profiler.lua_sampling_interval", 0.001f);
+        dmScript::StartLuaProfiler(params->m_L, (uint32_t)(dmMath::Max(interval, 0.0f) * 1000000.0f));
+    }
+
     static const luaL_reg Module_methods[] =
     {
         {"get_memory_usage",            MemoryUsage},
@@ -683,6 +1202,14 @@ static dmExtension::Result InitializeProfiler(dmExtension::Params* params)
         {"scope_begin",                 ProfilerScopeBegin},
         {"scope_end",                   ProfilerScopeEnd},
 
+        {"start_lua_sampling",          ProfilerStartLuaSampling},
+        {"stop_lua_sampling",           ProfilerStopLuaSampling},
+        {"reset_lua_sampling",          ProfilerResetLuaSampling},
+        {"get_lua_samples",             ProfilerGetLuaSamples},
+
+        {"start_capture",               ProfilerStartCapture},
+        {"stop_capture",                ProfilerStopCapture},
+
         {0, 0}
     };
 
@@ -707,6 +1234,45 @@ static dmExtension::Result InitializeProfiler(dmExtension::Params* params)
     return dmExtension::RESULT_OK;
 }
 
+// Gets the bytes allocated with the tag since the previous call
+static uint32_t GetTagAllocatedDelta(dmMemory::Tag tag, const dmMemory::TagStats& stats)
+{
+    uint32_t delta = (uint32_t)stats.m_Allocated - g_TagAllocated[tag];
+    g_TagAllocated[tag] = (uint32_t)stats.m_Allocated;
+    return delta;
+}
+
+static void UpdateMemoryTagProperties(lua_State* L)
+{
+    // The Lua heap is measured rather than tracked
+    dmMemory::SetTagActive(dmMemory::TAG_LUA, dmScript::GetLuaGCCount(L) * 1024u);
+
+    dmMemory::TagStats stats[dmMemory::TAG_COUNT];
+    for (uint32_t i = 0; i < dmMemory::TAG_COUNT; ++i)
+    {
+        dmMemory::GetTagStats((dmMemory::Tag)i, &stats[i]);
+    }
+
+    DM_PROPERTY_SET_U32(rmtp_MemoryRender, (uint32_t)stats[dmMemory::TAG_RENDER].m_Active / 1024u);
+    DM_PROPERTY_SET_U32(rmtp_MemoryGui, (uint32_t)stats[dmMemory::TAG_GUI].m_Active / 1024u);
+    DM_PROPERTY_SET_U32(rmtp_MemoryPhysics, (uint32_t)stats[dmMemory::TAG_PHYSICS].m_Active / 1024u);
+    DM_PROPERTY_SET_U32(rmtp_MemoryLua, (uint32_t)stats[dmMemory::TAG_LUA].m_Active / 1024u);
+    DM_PROPERTY_SET_U32(rmtp_MemorySound, (uint32_t)stats[dmMemory::TAG_SOUND].m_Active / 1024u);
+    DM_PROPERTY_SET_U32(rmtp_MemoryResource, (uint32_t)stats[dmMemory::TAG_RESOURCE].m_Active / 1024u);
+
+    dmMemory::AllocatorStats allocator_stats;
+    dmMemory::GetAllocatorStats(&allocator_stats);
+    DM_PROPERTY_SET_U32(rmtp_MemoryAllocator, (uint32_t)allocator_stats.m_Active / 1024u);
+
+    DM_PROPERTY_SET_U32(rmtp_AllocatedRender, GetTagAllocatedDelta(dmMemory::TAG_RENDER, stats[dmMemory::TAG_RENDER]) / 1024u);
+    DM_PROPERTY_SET_U32(rmtp_AllocatedGui, GetTagAllocatedDelta(dmMemory::TAG_GUI, stats[dmMemory::TAG_GUI]) / 1024u);
+    DM_PROPERTY_SET_U32(rmtp_AllocatedPhysics, GetTagAllocatedDelta(dmMemory::TAG_PHYSICS, stats[dmMemory::TAG_PHYSICS]) / 1024u);
+    DM_PROPERTY_SET_U32(rmtp_AllocatedLua, GetTagAllocatedDelta(dmMemory::TAG_LUA, stats[dmMemory::TAG_LUA]) / 1024u);
+    DM_PROPERTY_SET_U32(rmtp_AllocatedSound, GetTagAllocatedDelta(dmMemory::TAG_SOUND, stats[dmMemory::TAG_SOUND]) / 1024u);
+    DM_PROPERTY_SET_U32(rmtp_AllocatedResource, GetTagAllocatedDelta(dmMemory::TAG_RESOURCE, stats[dmMemory::TAG_RESOURCE]) / 1024u);
+    DM_PROPERTY_SET_U32(rmtp_AllocatedUntagged, GetTagAllocatedDelta(dmMemory::TAG_UNTAGGED, stats[dmMemory::TAG_UNTAGGED]) / 1024u);
+}
+
 static dmExtension::Result UpdateProfiler(dmExtension::Params* params)
 {
     if (g_TrackCpuUsage)
@@ -717,6 +1283,7 @@ static dmExtension::Result UpdateProfiler(dmExtension::Params* params)
     if (dLib::IsDebugMode()) {
         DM_PROPERTY_SET_U32(rmtp_CpuUsage, dmProfilerExt::GetCpuUsage()*100.0);
         DM_PROPERTY_SET_U32(rmtp_Memory, dmProfilerExt::GetMemoryUsage() / 1024u);
+        UpdateMemoryTagProperties(params->m_L);
     }
 
     dmProfilerExt::UpdatePlatformProfiler();
@@ -726,6 +1293,8 @@ static dmExtension::Result UpdateProfiler(dmExtension::Params* params)
 
 static dmExtension::Result FinalizeProfiler(dmExtension::Params* params)
 {
+    dmScript::StopLuaProfiler();
+
     if (gRenderProfile)
     {
         dmProfileRender::DeleteRenderProfile(gRenderProfile);
@@ -738,6 +1307,7 @@ static dmExtension::Result AppInitializeProfiler(dmExtension::AppParams* params)
 {
     // Note that the callback might come from a different thread!
     g_ProfilerMutex = dmMutex::New();
+    g_ProfilerCaptureMutex = dmMutex::New();
 
     g_ProfilerPort = dmConfigFile::GetInt(params->m_ConfigFile, "profiler.port", 0);
 
@@ -748,6 +1318,7 @@ static dmExtension::Result AppInitializeProfiler(dmExtension::AppParams* params)
     dmProfile::Options options;
     options.m_Port = g_ProfilerPort;
     options.m_SleepBetweenServerUpdates = dmConfigFile::GetInt(params->m_ConfigFile, "profiler.sleep_between_server_updates", 0);
+    options.m_NativeSamples = dmConfigFile::GetInt(params->m_ConfigFile, "profiler.native_samples", 0) != 0;
     dmProfile::Initialize(&options);
 
     if (!dmProfile::IsInitialized()) // We might use the null implementation
@@ -756,6 +1327,8 @@ static dmExtension::Result AppInitializeProfiler(dmExtension::AppParams* params)
         g_ProfilerCurrentFrame = 0;
         dmMutex::Delete(g_ProfilerMutex);
         g_ProfilerMutex = 0;
+        dmMutex::Delete(g_ProfilerCaptureMutex);
+        g_ProfilerCaptureMutex = 0;
         return dmExtension::RESULT_OK;
     }
 
@@ -764,6 +1337,36 @@ static dmExtension::Result AppInitializeProfiler(dmExtension::AppParams* params)
     g_ProfilerThreadSortOrder.Put(dmHashString64("sound"), 1);
     g_ProfilerThreadSortOrder.Put(dmHashString64("liveupdate"), 2);
 
+    // E.g. --config=profiler.capture=capture.json, to capture from the launch
+    const char* capture_path = dmConfigFile::GetString(params->m_ConfigFile, "profiler.capture", 0);
+    if (capture_path && capture_path[0])
+    {
+        dmStrlCpy(g_ProfilerCapturePath, capture_path, sizeof(g_ProfilerCapturePath));
+        StartCapture(capture_path);
+    }
+
+    // E.g. --config=profiler.spike_threshold=33, to write the frames around any frame longer than 33 ms
+    float spike_threshold = dmConfigFile::GetFloat(params->m_ConfigFile, "profiler.spike_threshold", 0.0f);
+    if (spike_threshold > 0.0f)
+    {
+        const char* title = dmConfigFile::GetString(params->m_ConfigFile, "project.title_as_file_name", "defold");
+        if (dmSys::GetApplicationSupportPath(title, g_ProfilerSpikeDir, sizeof(g_ProfilerSpikeDir)) != dmSys::RESULT_OK)
+        {
+            dmLogError("Unable to locate the application support path for the profile spike captures");
+        }
+        else
+        {
+            uint32_t frames = (uint32_t)dmMath::Max(dmConfigFile::GetInt(params->m_ConfigFile, "profiler.spike_frames", 60), 1);
+            float interval = dmConfigFile::GetFloat(params->m_ConfigFile, "profiler.spike_interval", 30.0f);
+
+            g_ProfilerSpikeThreshold = (uint64_t)(spike_threshold * 1000.0f);
+            g_ProfilerSpikeInterval = (uint64_t)(dmMath::Max(interval, 0.0f) * 1000000.0f);
+            g_ProfilerSpikeFramesAfter = dmMath::Min((uint32_t)dmMath::Max(dmConfigFile::GetInt(params->m_ConfigFile, "profiler.spike_frames_after", 10), 0), frames - 1);
+            g_ProfilerSpikeMaxFiles = (uint32_t)dmMath::Max(dmConfigFile::GetInt(params->m_ConfigFile, "profiler.spike_max_files", 4), 1);
+            g_ProfilerSpikeHistory = dmProfileCapture::NewHistory(frames);
+        }
+    }
+
     return dmExtension::RESULT_OK;
 }
 
@@ -778,6 +1381,21 @@ static dmExtension::Result AppFinalizeProfiler(dmExtension::AppParams* params)
     dmProfile::SetPropertyTreeCallback(0, 0);
     dmProfile::Finalize();
 
+    StopCapture();
+    g_ProfilerScopeStats.Iterate(FreeScopeStatsName, (void*)0);
+    g_ProfilerScopeStats.Clear();
+    g_ProfilerScopeStatsEnabled = false;
+    g_ProfilerFrameCallback = 0;
+    g_ProfilerFrameCallbackCtx = 0;
+    g_ProfilerFrameScopes.SetCapacity(0);
+    if (g_ProfilerSpikeHistory)
+    {
+        dmProfileCapture::DeleteHistory(g_ProfilerSpikeHistory);
+        g_ProfilerSpikeHistory = 0;
+    }
+    dmMutex::Delete(g_ProfilerCaptureMutex);
+    g_ProfilerCaptureMutex = 0;
+
     if (g_ProfilerCurrentFrame)
     {
         DM_MUTEX_SCOPED_LOCK(g_ProfilerMutex);
@@ -39,6 +39,65 @@ namespace dmProfiler
     void ToggleProfiler();
     void RenderProfiler(dmProfile::HProfile profile, dmGraphics::HContext graphics_context, dmRender::HRenderContext render_context, dmRender::HFontMap system_font_map);
 
+    /**
+     * Starts writing the profile samples and properties to a Chrome trace event file. Stops any running capture.
+     * @param path the file path. If 0, the profiler.capture setting, or "profile_capture.json" is used
+     * @return false if the file couldn't be opened, or the profiler isn't available
+     */
+    bool StartCapture(const char* path);
+    void StopCapture();
+    bool IsCapturing();
+
+    /**
+     * The time spent in a profile scope on the main thread, over the frames since StartScopeStats()
+     */
+    struct ScopeStats
+    {
+        const char* m_Name;
+        uint64_t    m_Time;         // Total time, in microseconds
+        uint64_t    m_MaxFrameTime; // The most time spent in one frame, in microseconds
+        uint32_t    m_Count;        // Number of calls
+        uint32_t    m_FrameCount;   // Number of frames with calls
+    };
+
+    typedef void (*FScopeStatsCallback)(void* ctx, const ScopeStats* stats);
+
+    /**
+     * Starts summing the scope times of each frame. Clears the previous stats
+     * @return false if the profiler isn't available
+     */
+    bool StartScopeStats();
+    void StopScopeStats();
+    void IterateScopeStats(void* ctx, FScopeStatsCallback callback);
+
+    /**
+     * The time spent in a profile scope on the main thread, in one frame
+     */
+    struct FrameScope
+    {
+        const char* m_Name;
+        uint32_t    m_NameHash;
+        uint32_t    m_Time;         // Total time, in microseconds
+        uint32_t    m_Count;        // Number of calls
+    };
+
+    typedef void (*FFrameCallback)(void* ctx, uint64_t frame_time, const FrameScope* scopes, uint32_t count);
+
+    /**
+     * Sets a callback that gets the scopes of each main thread frame, summed per scope name.
+     * The callback is called on the profiler thread, and the scopes are only valid during the call
+     * @param ctx the callback context
+     * @param callback the callback, or 0 to remove it
+     * @return false if the profiler isn't available
+     */
+    bool SetFrameCallback(void* ctx, FFrameCallback callback);
+
+    /**
+     * Gets the memory used by the process, as reported by the OS
+     * @return the memory in bytes, or 0 if not available
+     */
+    uint64_t GetMemoryUsage();
+
 } // dmProfiler
 
 #endif // DM_PROFILER_H
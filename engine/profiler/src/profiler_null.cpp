@@ -31,6 +31,46 @@ void RenderProfiler(dmProfile::HProfile , dmGraphics::HContext , dmRender::HRend
     // nop
 }
 
+bool StartCapture(const char* )
+{
+    return false;
+}
+
+void StopCapture()
+{
+    // nop
+}
+
+bool IsCapturing()
+{
+    return false;
+}
+
+bool StartScopeStats()
+{
+    return false;
+}
+
+void StopScopeStats()
+{
+    // nop
+}
+
+void IterateScopeStats(void* , FScopeStatsCallback )
+{
+    // nop
+}
+
+bool SetFrameCallback(void* , FFrameCallback )
+{
+    return false;
+}
+
+uint64_t GetMemoryUsage()
+{
+    return 0;
+}
+
 extern "C" void ProfilerExt()
 {
     // nop
@@ -0,0 +1,205 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+#include <dlib/atomic.h>
+#include <dlib/mutex.h>
+#include <dlib/profile.h>
+#include <dlib/time.h>
+
+#include "../profile_capture.h"
+
+struct CaptureCtx
+{
+    dmMutex::HMutex             m_Mutex;
+    dmProfileCapture::HCapture  m_Capture;
+    int32_atomic_t              m_Trees;
+};
+
+static void SampleTreeCallback(void* _ctx, const char* thread_name, dmProfile::HSample root)
+{
+    CaptureCtx* ctx = (CaptureCtx*)_ctx;
+    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+    dmProfileCapture::AddSampleTree(ctx->m_Capture, thread_name, root);
+    dmAtomicIncrement32(&ctx->m_Trees);
+}
+
+static std::string ReadFile(const char* path)
+{
+    std::string out;
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return out;
+    char buffer[1024];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        out.append(buffer, n);
+    fclose(file);
+    return out;
+}
+
+TEST(ProfileCapture, OpenFailure)
+{
+    ASSERT_EQ((dmProfileCapture::HCapture)0, dmProfileCapture::Open("no_such_dir/capture.json"));
+}
+
+TEST(ProfileCapture, SampleTrees)
+{
+    const char* path = "tmp_profile_capture.json";
+
+    CaptureCtx ctx;
+    ctx.m_Mutex = dmMutex::New();
+    ctx.m_Capture = dmProfileCapture::Open(path);
+    ctx.m_Trees = 0;
+    ASSERT_NE((dmProfileCapture::HCapture)0, ctx.m_Capture);
+
+    dmProfile::SetSampleTreeCallback(&ctx, SampleTreeCallback);
+
+    dmProfile::Options options;
+    options.m_Port = 0;
+    options.m_SleepBetweenServerUpdates = 0;
+    options.m_NativeSamples = true;
+    dmProfile::Initialize(&options);
+
+    bool initialized = dmProfile::IsInitialized(); // false for profile null
+    if (initialized)
+    {
+        {
+            DM_PROFILE("capture_root");
+            for (int i = 0; i < 2; ++i)
+            {
+                DM_PROFILE("capture \"child\"");
+                dmTime::BusyWait(500);
+            }
+        }
+
+        for (int i = 0; i < 1000 && dmAtomicGet32(&ctx.m_Trees) == 0; ++i)
+            dmTime::Sleep(1000);
+    }
+
+    dmProfile::Finalize();
+    dmProfile::SetSampleTreeCallback(0, 0);
+
+    uint32_t event_count = dmProfileCapture::GetEventCount(ctx.m_Capture);
+    dmProfileCapture::Close(ctx.m_Capture);
+    dmMutex::Delete(ctx.m_Mutex);
+
+    std::string json = ReadFile(path);
+    remove(path);
+
+    ASSERT_EQ(0U, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+    ASSERT_EQ(json.size() - 4, json.rfind("\n]}\n"));
+
+    if (initialized)
+    {
+        // The thread name, the root and the aggregated child
+        ASSERT_EQ(3U, event_count);
+        ASSERT_NE(std::string::npos, json.find("\"name\":\"thread_name\",\"args\":{\"name\":\"Main\"}"));
+        ASSERT_NE(std::string::npos, json.find("\"name\":\"capture_root\",\"args\":{\"calls\":1}"));
+        ASSERT_NE(std::string::npos, json.find("\"name\":\"capture \\\"child\\\"\",\"args\":{\"calls\":2}"));
+    }
+}
+
+struct HistoryCtx
+{
+    dmMutex::HMutex             m_Mutex;
+    dmProfileCapture::HHistory  m_History;
+    int32_atomic_t              m_Trees;
+};
+
+static void HistorySampleTreeCallback(void* _ctx, const char* thread_name, dmProfile::HSample root)
+{
+    HistoryCtx* ctx = (HistoryCtx*)_ctx;
+    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+    dmProfileCapture::RecordSampleTree(ctx->m_History, thread_name, root, strcmp(thread_name, "Main") == 0);
+    dmAtomicIncrement32(&ctx->m_Trees);
+}
+
+TEST(ProfileCapture, History)
+{
+    const char* path = "tmp_profile_history.json";
+
+    HistoryCtx ctx;
+    ctx.m_Mutex = dmMutex::New();
+    ctx.m_History = dmProfileCapture::NewHistory(2);
+    ctx.m_Trees = 0;
+
+    dmProfile::SetSampleTreeCallback(&ctx, HistorySampleTreeCallback);
+
+    dmProfile::Options options;
+    options.m_Port = 0;
+    options.m_SleepBetweenServerUpdates = 0;
+    options.m_NativeSamples = true;
+    dmProfile::Initialize(&options);
+
+    bool initialized = dmProfile::IsInitialized(); // false for profile null
+    if (initialized)
+    {
+        {
+            DM_PROFILE("history_frame_0");
+        }
+        {
+            DM_PROFILE("history_frame_1");
+        }
+        {
+            DM_PROFILE("history_frame_2");
+            DM_PROFILE("history_child");
+        }
+
+        for (int i = 0; i < 1000 && dmAtomicGet32(&ctx.m_Trees) < 3; ++i)
+            dmTime::Sleep(1000);
+    }
+
+    dmProfile::Finalize();
+    dmProfile::SetSampleTreeCallback(0, 0);
+
+    // The frames are written after the sample names are gone
+    dmProfileCapture::HCapture capture = dmProfileCapture::Open(path);
+    ASSERT_NE((dmProfileCapture::HCapture)0, capture);
+    dmProfileCapture::WriteHistory(ctx.m_History, capture);
+    dmProfileCapture::AddMarker(capture, "spike", 0);
+    uint32_t event_count = dmProfileCapture::GetEventCount(capture);
+    dmProfileCapture::Close(capture);
+
+    dmProfileCapture::DeleteHistory(ctx.m_History);
+    dmMutex::Delete(ctx.m_Mutex);
+
+    std::string json = ReadFile(path);
+    remove(path);
+
+    ASSERT_NE(std::string::npos, json.find("\"ph\":\"i\""));
+
+    if (initialized)
+    {
+        // Only the last two frames are kept: the thread name, three samples and the marker
+        ASSERT_EQ(5U, event_count);
+        ASSERT_EQ(std::string::npos, json.find("\"name\":\"history_frame_0\""));
+        ASSERT_NE(std::string::npos, json.find("\"name\":\"history_frame_1\""));
+        ASSERT_NE(std::string::npos, json.find("\"name\":\"history_frame_2\""));
+        ASSERT_NE(std::string::npos, json.find("\"name\":\"history_child\""));
+        ASSERT_LT(json.find("history_frame_1"), json.find("history_frame_2"));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
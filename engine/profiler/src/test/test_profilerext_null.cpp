@@ -23,6 +23,9 @@ TEST(ProfilerExt, ProfilerStubs)
     dmProfiler::SetUpdateFrequency(30);
     dmProfiler::ToggleProfiler();
     dmProfiler::RenderProfiler(0, 0, 0, 0);
+    ASSERT_FALSE(dmProfiler::StartCapture("capture.json"));
+    ASSERT_FALSE(dmProfiler::IsCapturing());
+    dmProfiler::StopCapture();
 }
 
 int main(int argc, char **argv)
@@ -24,6 +24,9 @@
 #include <vpx/vpx_encoder.h>
 #include <vpx/vp8cx.h>
 #include <dlib/log.h>
+#include <dlib/thread.h>
+#include <dlib/mutex.h>
+#include <dlib/condition_variable.h>
 
 namespace dmRecord
 {
@@ -55,6 +58,18 @@ namespace dmRecord
         vpx_codec_ctx_t     m_Codec;
         vpx_image_t         m_VpxImage;
         uint32_t            m_FrameCount;
+
+        // The frames waiting to be encoded on the encoder thread
+        dmThread::Thread                        m_Thread;
+        dmMutex::HMutex                         m_Mutex;
+        dmConditionVariable::HConditionVariable m_FrameQueued;
+        dmConditionVariable::HConditionVariable m_FrameEncoded;
+        uint8_t**                               m_Queue;
+        uint32_t                                m_QueueSize;
+        uint32_t                                m_QueueHead;
+        uint32_t                                m_QueueCount;
+        Result                                  m_EncodeResult; // The first error from the encoder thread
+        uint8_t                                 m_Quit : 1;
     };
 
     static void MemPutLE16(char *mem, unsigned int val)
@@ -180,6 +195,22 @@ namespace dmRecord
         r->m_Codec = codec;
         r->m_VpxImage = vpx_image;
         r->m_File = f;
+
+        if (params->m_QueueSize > 0)
+        {
+            uint32_t frame_size = params->m_Width * params->m_Height * 4;
+            r->m_QueueSize    = params->m_QueueSize;
+            r->m_Queue        = (uint8_t**) malloc(sizeof(uint8_t*) * r->m_QueueSize);
+            for (uint32_t i = 0; i < r->m_QueueSize; ++i)
+            {
+                r->m_Queue[i] = (uint8_t*) malloc(frame_size);
+            }
+            r->m_Mutex        = dmMutex::New();
+            r->m_FrameQueued  = dmConditionVariable::New();
+            r->m_FrameEncoded = dmConditionVariable::New();
+            r->m_Thread       = dmThread::New(EncoderThread, 0x80000, r, "record_encoder");
+        }
+
         *recorder = r;
         return RESULT_OK;
     }
@@ -239,25 +270,7 @@ namespace dmRecord
         }
     }
 
-    Result Delete(HRecorder recorder)
-    {
-        Result result = RESULT_OK;
-
-        fseek(recorder->m_File, 0, SEEK_SET);
-        if (!WriteIvfFileHeader(recorder))
-        {
-            result = RESULT_IO_ERROR;
-        }
-
-        vpx_img_free(&recorder->m_VpxImage);
-        vpx_codec_destroy(&recorder->m_Codec);
-
-        delete recorder;
-        return result;
-    }
-
-    Result RecordFrame(HRecorder recorder, const void* frame_buffer,
-            uint32_t frame_buffer_size, BufferFormat format)
+    static Result EncodeFrame(HRecorder recorder, const void* frame_buffer)
     {
         vpx_codec_iter_t iter = NULL;
         const vpx_codec_cx_pkt_t *pkt;
@@ -296,4 +309,114 @@ namespace dmRecord
 
         return RESULT_OK;
     }
+
+    static void EncoderThread(void* arg)
+    {
+        Recorder* recorder = (Recorder*) arg;
+
+        dmMutex::Lock(recorder->m_Mutex);
+        while (true)
+        {
+            while (recorder->m_QueueCount == 0 && !recorder->m_Quit)
+            {
+                dmConditionVariable::Wait(recorder->m_FrameQueued, recorder->m_Mutex);
+            }
+            if (recorder->m_QueueCount == 0)
+            {
+                break;
+            }
+
+            // The slot isn't written by RecordFrame() until it has been released below
+            const uint8_t* frame = recorder->m_Queue[recorder->m_QueueHead];
+            dmMutex::Unlock(recorder->m_Mutex);
+
+            Result r = EncodeFrame(recorder, frame);
+
+            dmMutex::Lock(recorder->m_Mutex);
+            if (r != RESULT_OK && recorder->m_EncodeResult == RESULT_OK)
+            {
+                recorder->m_EncodeResult = r;
+            }
+            recorder->m_QueueHead = (recorder->m_QueueHead + 1) % recorder->m_QueueSize;
+            recorder->m_QueueCount--;
+            dmConditionVariable::Signal(recorder->m_FrameEncoded);
+        }
+        dmMutex::Unlock(recorder->m_Mutex);
+    }
+
+    Result Delete(HRecorder recorder)
+    {
+        Result result = RESULT_OK;
+
+        if (recorder->m_Thread)
+        {
+            dmMutex::Lock(recorder->m_Mutex);
+            recorder->m_Quit = 1;
+            dmConditionVariable::Signal(recorder->m_FrameQueued);
+            dmMutex::Unlock(recorder->m_Mutex);
+
+            // The thread encodes the queued frames before it exits
+            dmThread::Join(recorder->m_Thread);
+            result = recorder->m_EncodeResult;
+
+            for (uint32_t i = 0; i < recorder->m_QueueSize; ++i)
+            {
+                free(recorder->m_Queue[i]);
+            }
+            free(recorder->m_Queue);
+            dmConditionVariable::Delete(recorder->m_FrameEncoded);
+            dmConditionVariable::Delete(recorder->m_FrameQueued);
+            dmMutex::Delete(recorder->m_Mutex);
+        }
+
+        fseek(recorder->m_File, 0, SEEK_SET);
+        if (!WriteIvfFileHeader(recorder))
+        {
+            result = RESULT_IO_ERROR;
+        }
+
+        vpx_img_free(&recorder->m_VpxImage);
+        vpx_codec_destroy(&recorder->m_Codec);
+
+        delete recorder;
+        return result;
+    }
+
+    Result RecordFrame(HRecorder recorder, const void* frame_buffer,
+            uint32_t frame_buffer_size, BufferFormat format)
+    {
+        if (recorder->m_QueueSize == 0)
+        {
+            return EncodeFrame(recorder, frame_buffer);
+        }
+
+        uint32_t frame_size = recorder->m_Width * recorder->m_Height * 4;
+        if (frame_buffer_size < frame_size)
+        {
+            return RESULT_INVAL_ERROR;
+        }
+
+        dmMutex::Lock(recorder->m_Mutex);
+        while (recorder->m_QueueCount == recorder->m_QueueSize)
+        {
+            dmConditionVariable::Wait(recorder->m_FrameEncoded, recorder->m_Mutex);
+        }
+        Result result = recorder->m_EncodeResult;
+        uint32_t slot = (recorder->m_QueueHead + recorder->m_QueueCount) % recorder->m_QueueSize;
+        dmMutex::Unlock(recorder->m_Mutex);
+
+        if (result != RESULT_OK)
+        {
+            return result;
+        }
+
+        // Only this thread adds frames, so the slot can be written without the lock
+        memcpy(recorder->m_Queue[slot], frame_buffer, frame_size);
+
+        dmMutex::Lock(recorder->m_Mutex);
+        recorder->m_QueueCount++;
+        dmConditionVariable::Signal(recorder->m_FrameQueued);
+        dmMutex::Unlock(recorder->m_Mutex);
+        return RESULT_OK;
+    }
 }
@@ -60,10 +60,22 @@ namespace dmRecord
         VideoCodec      m_VideoCodec;
         const char*     m_Filename;
         uint32_t        m_Fps;
+        // Number of frames that can wait to be encoded on the encoder thread. With 0, the frames are encoded
+        // by RecordFrame() on the calling thread.
+        uint32_t        m_QueueSize;
     };
 
     Result New(const NewParams* params, HRecorder* recorder);
+
+    /**
+     * Waits for the queued frames to be encoded, and closes the file
+     */
     Result Delete(HRecorder recorder);
+
+    /**
+     * Copies the frame to the queue, and only waits if the queue is full. An error from encoding an earlier frame
+     * is returned by the next call.
+     */
     Result RecordFrame(HRecorder recorder, const void* frame_buffer, uint32_t frame_buffer_size, BufferFormat format);
 }
 
@@ -14,6 +14,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
@@ -141,6 +142,49 @@ TEST(dmRecord, Simple)
     r = dmRecord::Delete(recorder);
     ASSERT_EQ(dmRecord::RESULT_OK, r);
 }
+
+TEST(dmRecord, Synchronous)
+{
+    dmRecord::NewParams params;
+    params.m_Width = 320;
+    params.m_Height = 240;
+    params.m_Filename = "tmp/synchronous.ivf";
+    params.m_QueueSize = 0;
+    dmRecord::HRecorder recorder = 0;
+    dmRecord::Result r = dmRecord::New(&params, &recorder);
+    ASSERT_EQ(dmRecord::RESULT_OK, r);
+
+    uint32_t buffer_size_bytes = params.m_Width * params.m_Height * sizeof(uint32_t);
+    uint32_t *buffer = new uint32_t[params.m_Width * params.m_Height];
+    memset(buffer, 0, buffer_size_bytes);
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        r = dmRecord::RecordFrame(recorder, buffer, buffer_size_bytes, dmRecord::BUFFER_FORMAT_BGRA);
+        ASSERT_EQ(dmRecord::RESULT_OK, r);
+    }
+
+    delete[] buffer;
+    r = dmRecord::Delete(recorder);
+    ASSERT_EQ(dmRecord::RESULT_OK, r);
+}
+
+TEST(dmRecord, FrameBufferTooSmall)
+{
+    dmRecord::NewParams params;
+    params.m_Width = 320;
+    params.m_Height = 240;
+    params.m_Filename = "tmp/small.ivf";
+    dmRecord::HRecorder recorder = 0;
+    dmRecord::Result r = dmRecord::New(&params, &recorder);
+    ASSERT_EQ(dmRecord::RESULT_OK, r);
+
+    uint32_t buffer[16] = {0};
+    r = dmRecord::RecordFrame(recorder, buffer, sizeof(buffer), dmRecord::BUFFER_FORMAT_BGRA);
+    ASSERT_EQ(dmRecord::RESULT_INVAL_ERROR, r);
+
+    r = dmRecord::Delete(recorder);
+    ASSERT_EQ(dmRecord::RESULT_OK, r);
+}
 #endif
 
 int main(int argc, char **argv)
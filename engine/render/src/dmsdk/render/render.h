@@ -77,6 +77,13 @@ namespace dmRender
      */
     typedef struct NamedConstantBuffer* HNamedConstantBuffer;
 
+    /*#
+     * Occlusion buffer handle. Holds the depth of the occluders, as seen from the current frustum.
+     * @typedef
+     * @name HOcclusionBuffer
+     */
+    typedef struct OcclusionBuffer* HOcclusionBuffer;
+
     /*#
      * @enum
      * @name Result
@@ -174,6 +181,9 @@ namespace dmRender
      * @member m_StencilTestParams [type: dmRender::StencilTestParams] the stencil test params
      * @member m_VertexStart [type: uint32_t] the vertex start
      * @member m_VertexCount [type: uint32_t] the vertex count
+     * @member m_IndirectBuffer [type: dmGraphics::HVertexBuffer] the buffer holding the dmGraphics::DrawIndexedIndirectCommand structs, when m_IndirectDrawCount > 0
+     * @member m_IndirectBufferOffset [type: uint32_t] the byte offset of the first command in m_IndirectBuffer
+     * @member m_IndirectDrawCount [type: uint32_t] the number of indirect draws. If non zero, the object is drawn with dmGraphics::DrawElementsIndirect and m_VertexStart, m_VertexCount and m_InstanceCount are ignored
      * @member m_SetBlendFactors [type: uint8_t:1] use the blend factors
      * @member m_SetStencilTest [type: uint8_t:1] use the stencil test
      */
@@ -212,6 +222,9 @@ namespace dmRender
         uint32_t                        m_VertexStart;
         uint32_t                        m_VertexCount;
         uint32_t                        m_InstanceCount;
+        dmGraphics::HVertexBuffer       m_IndirectBuffer;
+        uint32_t                        m_IndirectBufferOffset;
+        uint32_t                        m_IndirectDrawCount;
         uint8_t                         m_SetBlendFactors : 1;
         uint8_t                         m_SetStencilTest : 1;
         uint8_t                         m_SetFaceWinding : 1;
@@ -323,6 +336,7 @@ namespace dmRender
      * @member m_UserData [type: void*] the callback user data (registered with RenderListMakeDispatch())
      * @member m_Entries [type: dmRender::RenderListEntry] the render entry array
      * @member m_NumEntries [type: uint32_t] the number of render entries in the array
+     * @member m_OcclusionBuffer [type: dmRender::HOcclusionBuffer] the occluders drawn with the current frustum. 0 if there are no occluders
      */
     struct RenderListVisibilityParams
     {
@@ -330,10 +344,13 @@ namespace dmRender
         void*                           m_UserData;
         RenderListEntry*                m_Entries;
         uint32_t                        m_NumEntries;
+        HOcclusionBuffer                m_OcclusionBuffer;
     };
 
     /*#
      * Render dispatch function callback.
+     * @note Large render lists are culled in parallel, so the function may be called from several threads at once,
+     * each with a different range of entries. It should only write to the visibility of the given entries.
      * @typedef
      * @name RenderListDispatchFn
      * @param params [type: dmRender::RenderListDispatchParams] the params
@@ -409,6 +426,85 @@ namespace dmRender
      */
     void RenderListSubmit(HRenderContext context, RenderListEntry* begin, RenderListEntry* end);
 
+    /*#
+     * Adds a solid box that hides the render list entries behind it, for the current render frame
+     * @note Only add bounds that are entirely covered by the object (e.g. walls or large rocks), or visible entries will be culled
+     * @name AddOccluder
+     * @param context [type: dmRender::HRenderContext] the context
+     * @param world [type: dmVMath::Matrix4] the world transform of the box
+     * @param aabb_min [type: dmVMath::Vector3] the min corner of the box, in local space
+     * @param aabb_max [type: dmVMath::Vector3] the max corner of the box, in local space
+     */
+    void AddOccluder(HRenderContext context, const dmVMath::Matrix4& world, const dmVMath::Vector3& aabb_min, const dmVMath::Vector3& aabb_max);
+
+    /*#
+     * Light type
+     * @enum
+     * @name LightType
+     * @member LIGHT_TYPE_POINT
+     * @member LIGHT_TYPE_SPOT
+     */
+    enum LightType
+    {
+        LIGHT_TYPE_POINT = 0,
+        LIGHT_TYPE_SPOT  = 1,
+    };
+
+    /*#
+     * Light parameters
+     * @struct
+     * @name LightParams
+     * @member m_Position [type: dmVMath::Point3] the world space position
+     * @member m_Direction [type: dmVMath::Vector3] the world space direction of a spot light
+     * @member m_Color [type: dmVMath::Vector3] the color
+     * @member m_Intensity [type: float] the intensity, the color is multiplied with it
+     * @member m_Range [type: float] the distance the light reaches
+     * @member m_ConeAngle [type: float] the full angle of the cone of a spot light, in radians
+     * @member m_Type [type: dmRender::LightType] the light type
+     */
+    struct LightParams
+    {
+        LightParams();
+
+        dmVMath::Point3  m_Position;
+        dmVMath::Vector3 m_Direction;
+        dmVMath::Vector3 m_Color;
+        float            m_Intensity;
+        float            m_Range;
+        float            m_ConeAngle;
+        LightType        m_Type;
+    };
+
+    /*#
+     * Adds a light for the current render frame. The lights are binned into clusters for each view they are drawn with,
+     * and exposed to the materials that declare the light cluster constants.
+     * @note At most 64 lights are used per frame
+     * @name AddLight
+     * @param context [type: dmRender::HRenderContext] the context
+     * @param params [type: dmRender::LightParams] the light
+     */
+    void AddLight(HRenderContext context, const LightParams& params);
+
+    /*#
+     * Marks the next frame as changed. When the engine renders on demand, it only renders the frames
+     * where something has invalidated the render (input, animations, messages to the render script etc).
+     * Components that change their visual state outside of these call this each time they do.
+     * @name InvalidateRender
+     * @param context [type: dmRender::HRenderContext] the context
+     */
+    void InvalidateRender(HRenderContext context);
+
+    /*#
+     * Tests if a box is entirely hidden by the occluders. Safe to call from the visibility callbacks.
+     * @name IsOccluded
+     * @param buffer [type: dmRender::HOcclusionBuffer] the occlusion buffer (see RenderListVisibilityParams)
+     * @param world [type: dmVMath::Matrix4] the world transform of the box
+     * @param aabb_min [type: dmVMath::Vector3] the min corner of the box, in local space
+     * @param aabb_max [type: dmVMath::Vector3] the max corner of the box, in local space
+     * @return result [type: bool] true if the box is hidden
+     */
+    bool IsOccluded(HOcclusionBuffer buffer, const dmVMath::Matrix4& world, const dmVMath::Vector3& aabb_min, const dmVMath::Vector3& aabb_max);
+
     /*#
      * Adds a render object to the current render frame
      * @name AddToRender
@@ -19,6 +19,7 @@
 #include <dlib/array.h>
 #include <dlib/hash.h>
 #include <dlib/log.h>
+#include <dmsdk/dlib/intersection.h>
 #include <dmsdk/dlib/vmath.h>
 
 #include <graphics/graphics.h>
@@ -116,6 +117,8 @@ namespace dmRender
         debug_renderer.m_2dPredicate.m_Tags[0] = dmHashString64(DEBUG_2D_NAME);
         debug_renderer.m_2dPredicate.m_TagCount = 1;
         debug_renderer.m_RenderBatchVersion = 0;
+        debug_renderer.m_FlushedVertexCount = 0;
+        debug_renderer.m_HasCullFrustum = 0;
     }
 
     void FinalizeDebugRenderer(HRenderContext context)
@@ -153,6 +156,7 @@ namespace dmRender
             context->m_DebugRenderer.m_TypeData[i].m_RenderObject.m_VertexCount = 0;
         }
         context->m_DebugRenderer.m_RenderBatchVersion = 0;
+        context->m_DebugRenderer.m_FlushedVertexCount = 0;
     }
 
     static void LogVertexWarning(HRenderContext context)
@@ -165,56 +169,74 @@ namespace dmRender
         }
     }
 
-    void Square2d(HRenderContext context, float x0, float y0, float x1, float y1, Vector4 color)
+    // Reserves room for vertex_count vertices of the given type and returns a pointer into the client buffer,
+    // or 0 if the buffer is full. The caller writes the vertices in place.
+    static DebugVertex* AllocDebugVertices(HRenderContext context, DebugRenderType type, uint32_t vertex_count)
     {
-        if (!context->m_DebugRenderer.m_RenderContext)
-            return;
-        DebugRenderTypeData& type_data = context->m_DebugRenderer.m_TypeData[DEBUG_RENDER_TYPE_FACE_2D];
+        DebugRenderer& debug_renderer = context->m_DebugRenderer;
+        DebugRenderTypeData& type_data = debug_renderer.m_TypeData[type];
         RenderObject& ro = type_data.m_RenderObject;
-        const uint32_t vertex_count = 6;
-        if (ro.m_VertexCount + vertex_count < context->m_DebugRenderer.m_MaxVertexCount)
-        {
-            DebugVertex v[vertex_count];
-            v[0].m_Position = Vector4(x0, y0, 0.0f, 0.0f);
-            v[1].m_Position = Vector4(x0, y1, 0.0f, 0.0f);
-            v[2].m_Position = Vector4(x1, y0, 0.0f, 0.0f);
-            v[5].m_Position = Vector4(x1, y1, 0.0f, 0.0f);
-            v[3].m_Position = v[2].m_Position;
-            v[4].m_Position = v[1].m_Position;
-            for (uint32_t i = 0; i < vertex_count; ++i)
-                v[i].m_Color = color;
-            char* buffer = (char*)type_data.m_ClientBuffer;
-            memcpy(&buffer[ro.m_VertexCount * sizeof(DebugVertex)], (const void*)v, vertex_count * sizeof(DebugVertex));
-            ro.m_VertexCount += vertex_count;
-        }
-        else
+        if (ro.m_VertexCount + vertex_count >= debug_renderer.m_MaxVertexCount)
         {
             LogVertexWarning(context);
+            return 0;
         }
+        DebugVertex* v = (DebugVertex*)type_data.m_ClientBuffer + ro.m_VertexCount;
+        ro.m_VertexCount += vertex_count;
+        return v;
+    }
+
+    // Number of whole primitives of primitive_size vertices that still fit in the client buffer of the given type
+    static uint32_t GetFreeDebugVertexCount(HRenderContext context, DebugRenderType type, uint32_t primitive_size)
+    {
+        DebugRenderer& debug_renderer = context->m_DebugRenderer;
+        uint32_t used = debug_renderer.m_TypeData[type].m_RenderObject.m_VertexCount;
+        if (used + 1 >= debug_renderer.m_MaxVertexCount)
+            return 0;
+        uint32_t free_count = debug_renderer.m_MaxVertexCount - used - 1;
+        return free_count - free_count % primitive_size;
+    }
+
+    void Square2d(HRenderContext context, float x0, float y0, float x1, float y1, Vector4 color)
+    {
+        if (!context->m_DebugRenderer.m_RenderContext)
+            return;
+        DebugVertex* v = AllocDebugVertices(context, DEBUG_RENDER_TYPE_FACE_2D, 6);
+        if (!v)
+            return;
+        v[0].m_Position = Vector4(x0, y0, 0.0f, 0.0f);
+        v[1].m_Position = Vector4(x0, y1, 0.0f, 0.0f);
+        v[2].m_Position = Vector4(x1, y0, 0.0f, 0.0f);
+        v[5].m_Position = Vector4(x1, y1, 0.0f, 0.0f);
+        v[3].m_Position = v[2].m_Position;
+        v[4].m_Position = v[1].m_Position;
+        for (uint32_t i = 0; i < 6; ++i)
+            v[i].m_Color = color;
     }
 
     void Triangle3d(HRenderContext context, Point3 vertices[3], Vector4 color)
+    {
+        Triangles3D(context, vertices, 3, color);
+    }
+
+    void Triangles3D(HRenderContext context, const Point3* points, uint32_t point_count, Vector4 color)
     {
         if (!context->m_DebugRenderer.m_RenderContext)
             return;
-        DebugRenderTypeData& type_data = context->m_DebugRenderer.m_TypeData[DEBUG_RENDER_TYPE_FACE_3D];
-        RenderObject& ro = type_data.m_RenderObject;
-        const uint32_t vertex_count = 3;
-        if (ro.m_VertexCount + vertex_count < context->m_DebugRenderer.m_MaxVertexCount)
+        point_count -= point_count % 3;
+        uint32_t free_count = GetFreeDebugVertexCount(context, DEBUG_RENDER_TYPE_FACE_3D, 3);
+        if (point_count > free_count)
         {
-            DebugVertex v[vertex_count];
-            for (uint32_t i = 0; i < vertex_count; ++i)
-            {
-                v[i].m_Position = Vector4(vertices[i]);
-                v[i].m_Color = color;
-            }
-            char* buffer = (char*)type_data.m_ClientBuffer;
-            memcpy(&buffer[ro.m_VertexCount * sizeof(DebugVertex)], (const void*)v, vertex_count * sizeof(DebugVertex));
-            ro.m_VertexCount += vertex_count;
+            LogVertexWarning(context);
+            point_count = free_count;
         }
-        else
+        if (point_count == 0)
+            return;
+        DebugVertex* v = AllocDebugVertices(context, DEBUG_RENDER_TYPE_FACE_3D, point_count);
+        for (uint32_t i = 0; i < point_count; ++i)
         {
-            LogVertexWarning(context);
+            v[i].m_Position = Vector4(points[i]);
+            v[i].m_Color = color;
         }
     }
 
@@ -222,50 +244,64 @@ namespace dmRender
     {
         if (!context->m_DebugRenderer.m_RenderContext)
             return;
-        DebugRenderTypeData& type_data = context->m_DebugRenderer.m_TypeData[DEBUG_RENDER_TYPE_LINE_2D];
-        RenderObject& ro = type_data.m_RenderObject;
-        const uint32_t vertex_count = 2;
-        if (ro.m_VertexCount + vertex_count < context->m_DebugRenderer.m_MaxVertexCount)
-        {
-            DebugVertex v[vertex_count];
-            v[0].m_Position = Vector4(x0, y0, 0.0f, 0.0f);
-            v[0].m_Color = color0;
-            v[1].m_Position = Vector4(x1, y1, 0.0f, 0.0f);
-            v[1].m_Color = color1;
-            char* buffer = (char*)type_data.m_ClientBuffer;
-            memcpy(&buffer[ro.m_VertexCount * sizeof(DebugVertex)], (const void*)v, vertex_count * sizeof(DebugVertex));
-            ro.m_VertexCount += vertex_count;
-        }
-        else
-        {
-            LogVertexWarning(context);
-        }
+        DebugVertex* v = AllocDebugVertices(context, DEBUG_RENDER_TYPE_LINE_2D, 2);
+        if (!v)
+            return;
+        v[0].m_Position = Vector4(x0, y0, 0.0f, 0.0f);
+        v[0].m_Color = color0;
+        v[1].m_Position = Vector4(x1, y1, 0.0f, 0.0f);
+        v[1].m_Color = color1;
     }
 
     void Line3D(HRenderContext context, Point3 start, Point3 end, Vector4 start_color, Vector4 end_color)
     {
         if (!context->m_DebugRenderer.m_RenderContext)
             return;
-        DebugRenderTypeData& type_data = context->m_DebugRenderer.m_TypeData[DEBUG_RENDER_TYPE_LINE_3D];
-        RenderObject& ro = type_data.m_RenderObject;
-        const uint32_t vertex_count = 2;
-        if (ro.m_VertexCount + vertex_count < context->m_DebugRenderer.m_MaxVertexCount)
+        DebugVertex* v = AllocDebugVertices(context, DEBUG_RENDER_TYPE_LINE_3D, 2);
+        if (!v)
+            return;
+        v[0].m_Position = Vector4(start);
+        v[0].m_Color = start_color;
+        v[1].m_Position = Vector4(end);
+        v[1].m_Color = end_color;
+    }
+
+    void Lines3D(HRenderContext context, const Point3* points, uint32_t point_count, Vector4 color)
+    {
+        if (!context->m_DebugRenderer.m_RenderContext)
+            return;
+        point_count -= point_count % 2;
+        uint32_t free_count = GetFreeDebugVertexCount(context, DEBUG_RENDER_TYPE_LINE_3D, 2);
+        if (point_count > free_count)
         {
-            DebugVertex v[vertex_count];
-            v[0].m_Position = Vector4(start);
-            v[0].m_Color = start_color;
-            v[1].m_Position = Vector4(end);
-            v[1].m_Color = end_color;
-            char* buffer = (char*)type_data.m_ClientBuffer;
-            memcpy(&buffer[ro.m_VertexCount * sizeof(DebugVertex)], (const void*)v, vertex_count * sizeof(DebugVertex));
-            ro.m_VertexCount += vertex_count;
+            LogVertexWarning(context);
+            point_count = free_count;
         }
-        else
+        if (point_count == 0)
+            return;
+        DebugVertex* v = AllocDebugVertices(context, DEBUG_RENDER_TYPE_LINE_3D, point_count);
+        for (uint32_t i = 0; i < point_count; ++i)
         {
-            LogVertexWarning(context);
+            v[i].m_Position = Vector4(points[i]);
+            v[i].m_Color = color;
         }
     }
 
+    void SetDebugCullFrustum(HRenderContext context, const Matrix4& view_proj, FrustumPlanes num_planes)
+    {
+        DebugRenderer& debug_renderer = context->m_DebugRenderer;
+        dmIntersection::CreateFrustumFromMatrix(view_proj, true, (int) num_planes, debug_renderer.m_CullFrustum);
+        debug_renderer.m_HasCullFrustum = 1;
+    }
+
+    bool TestDebugFrustumSphere(HRenderContext context, Point3 center, float radius)
+    {
+        DebugRenderer& debug_renderer = context->m_DebugRenderer;
+        if (!debug_renderer.m_RenderContext || !debug_renderer.m_HasCullFrustum)
+            return true;
+        return dmIntersection::TestFrustumSphere(debug_renderer.m_CullFrustum, center, radius);
+    }
+
     static void DebugRenderListDispatch(dmRender::RenderListDispatchParams const &params)
     {
         DebugRenderer *debug_renderer = (DebugRenderer *)params.m_UserData;
@@ -290,7 +326,6 @@ namespace dmRender
         DebugRenderer& debug_renderer = render_context->m_DebugRenderer;
         uint32_t total_vertex_count = 0;
         uint32_t total_render_objects = 0;
-        dmGraphics::SetVertexBufferData(debug_renderer.m_VertexBuffer, 0, 0, dmGraphics::BUFFER_USAGE_STREAM_DRAW);
         for (uint32_t i = 0; i < MAX_DEBUG_RENDER_TYPE_COUNT; ++i)
         {
             DebugRenderTypeData& type_data = debug_renderer.m_TypeData[i];
@@ -304,6 +339,12 @@ namespace dmRender
             }
         }
 
+        // DrawRenderList flushes before every draw call of the render script. Vertex counts only grow until the
+        // render objects are cleared, so an unchanged total means the render list already holds the current batch.
+        if (total_vertex_count == debug_renderer.m_FlushedVertexCount)
+            return;
+        debug_renderer.m_FlushedVertexCount = total_vertex_count;
+
         dmGraphics::SetVertexBufferData(debug_renderer.m_VertexBuffer, total_vertex_count * sizeof(DebugVertex), 0, dmGraphics::BUFFER_USAGE_STREAM_DRAW);
 
         dmRender::RenderListEntry* render_list = dmRender::RenderListAlloc(render_context, total_render_objects);
@@ -313,9 +354,6 @@ namespace dmRender
         // Upgrade the batch key, since we might submit these render object multiple times
         // during a frame (because render scripts might draw lines, and then we are forced to flush
         // debug rendering during command queue execution, and thus submit the same objects again).
-        //
-        // TODO: Rewrite this so we can flush only what has been added since last time.
-        //
         debug_renderer.m_RenderBatchVersion++;
 
         for (uint32_t i = 0; i < MAX_DEBUG_RENDER_TYPE_COUNT; ++i)
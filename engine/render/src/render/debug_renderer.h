@@ -38,6 +38,11 @@ namespace dmRender
     void ClearDebugRenderObjects(HRenderContext render_context);
 
     void FlushDebug(HRenderContext render_context, uint32_t render_order);
+
+    /**
+     * Set the frustum used by TestDebugFrustumSphere
+     */
+    void SetDebugCullFrustum(HRenderContext render_context, const dmVMath::Matrix4& view_proj, FrustumPlanes num_planes);
 }
 
 #endif // DM_RENDER_DEBUG_RENDERER_H
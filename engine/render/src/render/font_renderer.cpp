@@ -15,7 +15,6 @@
 #include <string.h>
 #include <math.h>
 #include <float.h>
-#include <algorithm> // std::sort
 
 #include <dlib/align.h>
 #include <dlib/memory.h>
@@ -111,6 +110,48 @@ namespace dmRender
         int16_t              m_Y;
     };
 
+    // A laid out glyph, in the local space of the text
+    struct TextLayoutGlyph
+    {
+        uint32_t             m_Character;
+        float                m_X;
+        float                m_Y;
+        int16_t              m_Width;
+        int16_t              m_Ascent;
+        int16_t              m_Descent;
+        int16_t              m_LeftBearing;
+    };
+
+    // The result of the line breaking and glyph lookup of a text, which only depends on the string and the layout
+    // parameters. The transform and the colors of a text are applied when the vertices are created.
+    struct TextLayout
+    {
+        TextLayoutGlyph*     m_Glyphs;      // Only the glyphs that have an image
+        uint32_t             m_GlyphCount;
+        uint32_t             m_LineCount;
+        uint32_t             m_Frame;       // The last frame the layout was used
+        float                m_Width;
+    };
+
+    // The max number of cached layouts per font map
+    static const uint32_t MAX_TEXT_LAYOUT_COUNT = 1024;
+
+    // The number of texts in a batch before the vertices are written by the job threads
+    static const uint32_t TEXT_PARALLEL_VERTEX_THRESHOLD = 64;
+    static const uint32_t TEXT_PARALLEL_GRAIN_SIZE       = 16;
+
+    // The max number of inflated glyph pages per font map, see FONT_GLYPH_COMPRESSION_DEFLATE_PAGE
+    static const uint32_t MAX_GLYPH_PAGE_COUNT = 4;
+
+    struct GlyphPage
+    {
+        const uint8_t*  m_Key;      // The deflated page
+        uint8_t*        m_Data;     // The inflated page
+        uint32_t        m_DataSize;
+        uint32_t        m_Capacity;
+        uint32_t        m_Time;     // When the page was last used
+    };
+
     struct FontMap
     {
         FontMap()
@@ -125,9 +166,14 @@ namespace dmRender
         , m_MaxAscent(0.0f)
         , m_MaxDescent(0.0f)
         , m_CellTempData(0)
+        , m_CacheData(0)
         , m_Cache(0)
-        , m_CacheIndices(0)
         , m_CacheCursor(0)
+        , m_CacheEvictCursor(0)
+        , m_CacheDirtyMinY(0)
+        , m_CacheDirtyMaxY(0)
+        , m_GlyphPageTime(0)
+        , m_TextLayoutsFrame(0)
         , m_CacheWidth(0)
         , m_CacheHeight(0)
         , m_CacheCellWidth(0)
@@ -141,22 +187,46 @@ namespace dmRender
         , m_IsMonospaced(false)
         , m_Padding(0)
         {
+            memset(m_GlyphPages, 0, sizeof(m_GlyphPages));
         }
 
         ~FontMap()
         {
-            free(m_CacheIndices);
-            m_CacheIndices = 0;
-
             free(m_Cache);
             m_Cache = 0;
 
             free(m_CellTempData);
             m_CellTempData = 0;
 
+            free(m_CacheData);
+            m_CacheData = 0;
+
+            ClearGlyphPages();
+            ClearTextLayouts();
+
             dmGraphics::DeleteTexture(m_Texture);
         }
 
+        static void FreeTextLayout(void*, const uint64_t*, TextLayout** layout)
+        {
+            free(*layout);
+        }
+
+        // Called when the glyphs or the font metrics change
+        void ClearTextLayouts()
+        {
+            m_TextLayouts.Iterate(FreeTextLayout, (void*) 0);
+            m_TextLayouts.Clear();
+        }
+
+        // Called when the glyph data changes, as the pages are keyed on their address
+        void ClearGlyphPages()
+        {
+            for (uint32_t i = 0; i < MAX_GLYPH_PAGE_COUNT; ++i)
+                free(m_GlyphPages[i].m_Data);
+            memset(m_GlyphPages, 0, sizeof(m_GlyphPages));
+        }
+
         void*                   m_UserData; // The font map resources (see res_font.cpp)
         dmGraphics::HTexture    m_Texture;
         HMaterial               m_Material;
@@ -178,11 +248,21 @@ namespace dmRender
         float                   m_ShadowAlpha;
 
         uint8_t*                m_CellTempData; // a temporary unpack buffer for the compressed glyphs
+        uint8_t*                m_CacheData;    // A copy of the cache texture, the new glyphs are written here and uploaded once per batch
+
+        dmHashTable32<CacheGlyph*>  m_GlyphCache;       // Quick check what glyphs are in the cache
+        CacheGlyph*                 m_Cache;            // The data (i.e. the pool)
+        uint32_t                    m_CacheCursor;      // The number of used cells
+        uint32_t                    m_CacheEvictCursor; // The oldest cell, once all cells are used
+        uint32_t                    m_CacheDirtyMinY;   // The rows of the cache texture that need to be uploaded, in texels
+        uint32_t                    m_CacheDirtyMaxY;
 
-        dmHashTable32<CacheGlyph*>  m_GlyphCache;   // Quick check what glyphs are in the cache
-        CacheGlyph*                 m_Cache;        // The data (i.e. the pool)
-        uint16_t*                   m_CacheIndices; // Indices into the cache array
-        uint32_t                    m_CacheCursor;
+        GlyphPage                   m_GlyphPages[MAX_GLYPH_PAGE_COUNT]; // The recently inflated glyph pages
+        uint32_t                    m_GlyphPageTime;
+
+        dmHashTable64<TextLayout*>  m_TextLayouts;          // The layouts of recently drawn texts, see GetTextLayout()
+        dmArray<TextLayoutGlyph>    m_TextLayoutScratch;    // Used for texts that don't fit in the layout cache
+        uint32_t                    m_TextLayoutsFrame;     // The frame the unused layouts were last removed
 
         dmGraphics::TextureFormat m_CacheFormat;
         dmGraphics::TextureFilter m_MinFilter;
@@ -214,12 +294,6 @@ namespace dmRender
         memset((void*)tex_params.m_Data, init_val, tex_params.m_DataSize);
     }
 
-    static void CleanupFontmap(dmGraphics::TextureParams& tex_params)
-    {
-        free((void*)tex_params.m_Data);
-        tex_params.m_DataSize = 0;
-    }
-
     // Font maps have no mips, so we need to make sure we use a supported min filter
     static dmGraphics::TextureFilter ConvertMinTextureFilter(dmGraphics::TextureFilter filter)
     {
@@ -242,9 +316,11 @@ namespace dmRender
         {
             free(font_map->m_Cache);
             free(font_map->m_CellTempData);
-            free(font_map->m_CacheIndices);
             font_map->m_GlyphCache.Clear();
         }
+        font_map->ClearGlyphPages();
+        font_map->m_CacheCursor = 0;
+        font_map->m_CacheEvictCursor = 0;
 
         font_map->m_CacheCellWidth = cell_width;
         font_map->m_CacheCellHeight = cell_height;
@@ -256,15 +332,10 @@ namespace dmRender
 
         font_map->m_CellTempData = (uint8_t*)malloc(font_map->m_CacheCellWidth*font_map->m_CacheCellHeight*4);
 
-        font_map->m_CacheIndices = (uint16_t*)malloc(sizeof(uint16_t) * font_map->m_CacheCellCount);
-        memset(font_map->m_CacheIndices, 0, sizeof(uint16_t) * font_map->m_CacheCellCount);
-
         font_map->m_Cache = (CacheGlyph*)malloc(sizeof(CacheGlyph) * font_map->m_CacheCellCount);
         memset(font_map->m_Cache, 0, sizeof(CacheGlyph*) * font_map->m_CacheCellCount);
         for (uint32_t i = 0; i < font_map->m_CacheCellCount; ++i)
         {
-            font_map->m_CacheIndices[i] = i;
-
             CacheGlyph* glyph = &font_map->m_Cache[i];
             glyph->m_Glyph = 0;
             glyph->m_Frame = 0;
@@ -290,6 +361,8 @@ namespace dmRender
         assert(params.m_GetGlyph);
         assert(params.m_GetGlyphData);
 
+        font_map->ClearTextLayouts();
+
         font_map->m_NameHash = params.m_NameHash;
         font_map->m_GetGlyph = params.m_GetGlyph;
         font_map->m_GetGlyphData = params.m_GetGlyphData;
@@ -370,7 +443,12 @@ namespace dmRender
 
         InitFontmap(params, tex_params, 0);
         dmGraphics::SetTexture(font_map->m_Texture, tex_params);
-        CleanupFontmap(tex_params);
+
+        // We keep the initial data as the cpu copy of the cache
+        free(font_map->m_CacheData);
+        font_map->m_CacheData = (uint8_t*) tex_params.m_Data;
+        font_map->m_CacheDirtyMinY = 0;
+        font_map->m_CacheDirtyMaxY = 0;
     }
 
     HFontMap NewFontMap(dmGraphics::HContext graphics_context, FontMapParams& params)
@@ -401,9 +479,25 @@ namespace dmRender
 
     void SetFontMapUserData(HFontMap font_map, void* user_data)
     {
+        font_map->ClearTextLayouts();
+        font_map->ClearGlyphPages();
         font_map->m_UserData = user_data;
     }
 
+    void InvalidateFontMapGlyph(HFontMap font_map, uint32_t codepoint)
+    {
+        font_map->ClearTextLayouts();
+        font_map->ClearGlyphPages();
+
+        CacheGlyph** cache_glyph = font_map->m_GlyphCache.Get(codepoint);
+        if (cache_glyph)
+        {
+            // Keep the cell, but don't let the eviction touch the old glyph
+            (*cache_glyph)->m_Glyph = 0;
+            font_map->m_GlyphCache.Erase(codepoint);
+        }
+    }
+
     void* GetFontMapUserData(HFontMap font_map)
     {
         return font_map->m_UserData;
@@ -551,6 +645,178 @@ namespace dmRender
         return center_point;
     }
 
+    static uint64_t GetTextLayoutKey(const char* text, uint32_t text_len, const TextEntry& te)
+    {
+        float params[] = { te.m_Width, te.m_Height, te.m_Leading, te.m_Tracking };
+        uint32_t flags = (uint32_t) te.m_LineBreak | (te.m_Align << 1) | (te.m_VAlign << 3);
+
+        HashState64 key_state;
+        dmHashInit64(&key_state, false);
+        dmHashUpdateBuffer64(&key_state, text, text_len);
+        dmHashUpdateBuffer64(&key_state, params, sizeof(params));
+        dmHashUpdateBuffer64(&key_state, &flags, sizeof(flags));
+        return dmHashFinal64(&key_state);
+    }
+
+    // Breaks the text into lines, and places the glyphs that have an image
+    static void LayoutText(HFontMap font_map, const char* text, const TextEntry& te, dmArray<TextLayoutGlyph>& glyphs, uint32_t* out_line_count, float* out_layout_width)
+    {
+        DM_PROFILE("LayoutText");
+
+        float width = te.m_Width;
+        if (!te.m_LineBreak) {
+            width = FLT_MAX;
+        }
+        float line_height = font_map->m_MaxAscent + font_map->m_MaxDescent;
+        float leading = line_height * te.m_Leading;
+        float tracking = line_height * te.m_Tracking;
+
+        const uint32_t max_lines = 128;
+        TextLine lines[max_lines];
+
+        // Trailing space characters should be ignored when measuring and
+        // rendering multiline text.
+        // For single line text we still want to include spaces when the text
+        // layout is calculated (https://github.com/defold/defold/issues/5911)
+        bool measure_trailing_space = !te.m_LineBreak;
+
+        LayoutMetrics lm(font_map, tracking);
+        float layout_width;
+        int line_count = Layout(text, width, lines, max_lines, &layout_width, lm, measure_trailing_space);
+        float x_offset = OffsetX(te.m_Align, te.m_Width);
+        if (font_map->m_IsMonospaced)
+        {
+            x_offset -= font_map->m_Padding * 0.5f;
+        }
+        float y_offset = OffsetY(te.m_VAlign, te.m_Height, font_map->m_MaxAscent, font_map->m_MaxDescent, te.m_Leading, line_count);
+
+        for (int line = 0; line < line_count; ++line) {
+            TextLine& l = lines[line];
+            float x = x_offset - OffsetX(te.m_Align, l.m_Width);
+            float y = y_offset - line * leading;
+            const char* cursor = &text[l.m_Index];
+            int n = l.m_Count;
+            for (int j = 0; j < n; ++j)
+            {
+                uint32_t c = dmUtf8::NextChar(&cursor);
+
+                FontGlyph* glyph = GetGlyph(font_map, c);
+                if (!glyph) {
+                    continue;
+                }
+
+                if (glyph->m_Width > 0)
+                {
+                    if (glyphs.Full())
+                    {
+                        glyphs.OffsetCapacity(dmMath::Max(64U, glyphs.Capacity()));
+                    }
+
+                    TextLayoutGlyph layout_glyph;
+                    layout_glyph.m_Character   = c;
+                    layout_glyph.m_X           = x;
+                    layout_glyph.m_Y           = y;
+                    layout_glyph.m_Width       = (int16_t) glyph->m_Width;
+                    layout_glyph.m_Ascent      = (int16_t) glyph->m_Ascent;
+                    layout_glyph.m_Descent     = (int16_t) glyph->m_Descent;
+                    layout_glyph.m_LeftBearing = (int16_t) glyph->m_LeftBearing;
+                    glyphs.Push(layout_glyph);
+                }
+                x += glyph->m_Advance + tracking;
+            }
+        }
+
+        *out_line_count = line_count;
+        *out_layout_width = layout_width;
+    }
+
+    struct StaleTextLayoutContext
+    {
+        dmArray<uint64_t>* m_Keys;
+        uint32_t           m_Frame;
+    };
+
+    static void CollectStaleTextLayout(StaleTextLayoutContext* context, const uint64_t* key, TextLayout** layout)
+    {
+        // Keep the layouts used in this or the previous frame
+        if ((*layout)->m_Frame + 1 < context->m_Frame)
+        {
+            context->m_Keys->Push(*key);
+        }
+    }
+
+    // Makes room for another layout in the cache, returns false if the cache is full of recently used layouts
+    static bool ReserveTextLayout(HFontMap font_map, uint32_t frame)
+    {
+        dmHashTable64<TextLayout*>& layouts = font_map->m_TextLayouts;
+        if (!layouts.Full())
+        {
+            return true;
+        }
+
+        if (layouts.Capacity() < MAX_TEXT_LAYOUT_COUNT)
+        {
+            uint32_t capacity = dmMath::Min(layouts.Capacity() + 64, MAX_TEXT_LAYOUT_COUNT);
+            layouts.SetCapacity(capacity / 2, capacity);
+            return true;
+        }
+
+        // Remove the unused layouts, at most once per frame
+        if (font_map->m_TextLayoutsFrame == frame)
+        {
+            return false;
+        }
+        font_map->m_TextLayoutsFrame = frame;
+
+        dmArray<uint64_t> stale_keys;
+        stale_keys.SetCapacity(layouts.Size());
+        StaleTextLayoutContext context;
+        context.m_Keys  = &stale_keys;
+        context.m_Frame = frame;
+        layouts.Iterate(CollectStaleTextLayout, &context);
+
+        for (uint32_t i = 0; i < stale_keys.Size(); ++i)
+        {
+            TextLayout** layout = layouts.Get(stale_keys[i]);
+            free(*layout);
+            layouts.Erase(stale_keys[i]);
+        }
+        return !layouts.Full();
+    }
+
+    // Gets the cached layout of a text, or lays it out and stores it in the cache.
+    // If the cache is full, the layout is stored in scratch_layout, which is valid until the next call.
+    static const TextLayout* GetTextLayout(HFontMap font_map, uint32_t frame, uint64_t key, const char* text, const TextEntry& te, TextLayout* scratch_layout)
+    {
+        TextLayout** cached_layout = font_map->m_TextLayouts.Get(key);
+        if (cached_layout)
+        {
+            (*cached_layout)->m_Frame = frame;
+            return *cached_layout;
+        }
+
+        dmArray<TextLayoutGlyph>& glyphs = font_map->m_TextLayoutScratch;
+        glyphs.SetSize(0);
+        LayoutText(font_map, text, te, glyphs, &scratch_layout->m_LineCount, &scratch_layout->m_Width);
+        scratch_layout->m_Glyphs     = glyphs.Begin();
+        scratch_layout->m_GlyphCount = glyphs.Size();
+        scratch_layout->m_Frame      = frame;
+
+        if (!ReserveTextLayout(font_map, frame))
+        {
+            return scratch_layout;
+        }
+
+        uint32_t glyphs_size = sizeof(TextLayoutGlyph) * scratch_layout->m_GlyphCount;
+        TextLayout* layout = (TextLayout*) malloc(sizeof(TextLayout) + glyphs_size);
+        *layout = *scratch_layout;
+        layout->m_Glyphs = (TextLayoutGlyph*) (layout + 1);
+        memcpy(layout->m_Glyphs, glyphs.Begin(), glyphs_size);
+
+        font_map->m_TextLayouts.Put(key, layout);
+        return layout;
+    }
+
     void DrawText(HRenderContext render_context, HFontMap font_map, HMaterial material, uint64_t batch_key, const DrawTextParams& params)
     {
         DM_PROFILE("DrawText");
@@ -614,9 +880,19 @@ namespace dmRender
         te.m_StencilTestParamsSet = params.m_StencilTestParamsSet;
         te.m_SourceBlendFactor = params.m_SourceBlendFactor;
         te.m_DestinationBlendFactor = params.m_DestinationBlendFactor;
+        te.m_LayoutKey = GetTextLayoutKey(params.m_Text, text_len, te);
+
+        TextLayout scratch_layout;
+        const TextLayout* layout = GetTextLayout(font_map, text_context->m_Frame, te.m_LayoutKey, params.m_Text, te, &scratch_layout);
 
+        // The same metrics as GetTextMetrics()
+        float line_height = font_map->m_MaxAscent + font_map->m_MaxDescent;
         TextMetrics metrics;
-        GetTextMetrics(font_map, params.m_Text, params.m_Width, params.m_LineBreak, params.m_Leading, params.m_Tracking, &metrics);
+        metrics.m_MaxAscent  = font_map->m_MaxAscent;
+        metrics.m_MaxDescent = font_map->m_MaxDescent;
+        metrics.m_Width      = layout->m_Width;
+        metrics.m_Height     = layout->m_LineCount * (line_height * te.m_Leading) - line_height * (te.m_Leading - 1.0f);
+        metrics.m_LineCount  = layout->m_LineCount;
 
         // find center and radius for frustum culling
         dmVMath::Point3 centerpoint_local = CalcCenterPoint(font_map, te, metrics);
@@ -650,45 +926,153 @@ namespace dmRender
 
     struct FontGlyphInflaterContext {
         uint32_t m_Cursor;
+        uint32_t m_Capacity;
         uint8_t* m_Output;
     };
 
     static bool FontGlyphInflater(void* context, const void* data, uint32_t data_len)
     {
         FontGlyphInflaterContext* ctx = (FontGlyphInflaterContext*)context;
+        if (ctx->m_Cursor + data_len > ctx->m_Capacity)
+            return false;
         memcpy(ctx->m_Output + ctx->m_Cursor, data, data_len);
         ctx->m_Cursor += data_len;
         return true;
     }
 
-    struct CompareCacheGlyphPred
+    // Gets the inflated page, either from the recently used pages, or by replacing the least recently used one
+    static const uint8_t* AcquireGlyphPage(HFontMap font_map, const uint8_t* page_data, uint32_t page_size, uint32_t page_data_size)
     {
-        CacheGlyph* m_Glyphs;
-        CompareCacheGlyphPred(CacheGlyph* glyphs)
-        : m_Glyphs(glyphs) {}
+        uint32_t time = ++font_map->m_GlyphPageTime;
+        GlyphPage* oldest = &font_map->m_GlyphPages[0];
+        for (uint32_t i = 0; i < MAX_GLYPH_PAGE_COUNT; ++i)
+        {
+            GlyphPage* page = &font_map->m_GlyphPages[i];
+            if (page->m_Key == page_data && page->m_DataSize == page_data_size)
+            {
+                page->m_Time = time;
+                return page->m_Data;
+            }
+            if (page->m_Time < oldest->m_Time)
+                oldest = page;
+        }
+
+        DM_PROFILE("InflateGlyphPage");
 
-        bool operator()(uint16_t ia, uint16_t ib) const
+        GlyphPage* page = oldest;
+        page->m_Key = 0;
+        page->m_Time = time;
+        if (page->m_Capacity < page_data_size)
         {
-            const CacheGlyph& a = m_Glyphs[ia];
-            const CacheGlyph& b = m_Glyphs[ib];
-            // Sort the oldest last (e.g. 0 is at the end)
-            return a.m_Frame > b.m_Frame;
+            free(page->m_Data);
+            page->m_Data = (uint8_t*)malloc(page_data_size);
+            page->m_Capacity = page_data_size;
         }
-    };
 
-    static void SortCache(HFontMap font_map)
+        FontGlyphInflaterContext inflate_context;
+        inflate_context.m_Output = page->m_Data;
+        inflate_context.m_Cursor = 0;
+        inflate_context.m_Capacity = page_data_size;
+        dmZlib::Result zlib_result = dmZlib::InflateBuffer(page_data, page_size, &inflate_context, FontGlyphInflater);
+        if (zlib_result != dmZlib::RESULT_OK || inflate_context.m_Cursor != page_data_size)
+        {
+            dmLogError("Failed to decompress glyph page in font %s: %d", dmHashReverseSafe64(font_map->m_NameHash), zlib_result);
+            return 0;
+        }
+
+        // The whole page is delta encoded as one stream
+        delta_decode(page->m_Data, page_data_size);
+        page->m_Key = page_data;
+        page->m_DataSize = page_data_size;
+        return page->m_Data;
+    }
+
+    const uint8_t* GetGlyphImage(HFontMap font_map, const dmRender::FontGlyph* g, uint32_t* out_width, uint32_t* out_height)
     {
-        std::sort(font_map->m_CacheIndices, font_map->m_CacheIndices + font_map->m_CacheCursor, CompareCacheGlyphPred(font_map->m_Cache));
+        uint32_t glyph_data_compression; // E.g. FONT_GLYPH_COMPRESSION_NONE;
+        uint32_t glyph_data_size = 0;
+        uint32_t glyph_image_width = 0;
+        uint32_t glyph_image_height = 0;
+        uint8_t* glyph_data = (uint8_t*)font_map->m_GetGlyphData(g->m_Character, font_map->m_UserData, &glyph_data_size, &glyph_data_compression, &glyph_image_width, &glyph_image_height);
+        if (!glyph_data)
+        {
+            return 0;
+        }
+
+        *out_width = glyph_image_width;
+        *out_height = glyph_image_height;
+
+        if (FONT_GLYPH_COMPRESSION_DEFLATE == glyph_data_compression)
+        {
+            // When if came to choosing between the different algorithms, here are some speed/compression tests
+            // Decoding 100 glyphs
+            // lz4:     0.1060 ms  compression: 72%
+            // deflate: 0.2190 ms  compression: 66%
+            // png:     0.6930 ms  compression: 67%
+            // webp:    1.5170 ms  compression: 55%
+            // further improvements (different test, Android, 92 glyphs)
+            // webp          2.9440 ms  compression: 55%
+            // deflate       0.7110 ms  compression: 66%
+            // deflate+delta 0.7680 ms  compression: 62%
+
+            FontGlyphInflaterContext deflate_context;
+            deflate_context.m_Output = font_map->m_CellTempData;
+            deflate_context.m_Cursor = 0;
+            deflate_context.m_Capacity = font_map->m_CacheCellWidth * font_map->m_CacheCellHeight * 4;
+            dmZlib::Result zlib_result = dmZlib::InflateBuffer(glyph_data, glyph_data_size, &deflate_context, FontGlyphInflater);
+            if (zlib_result != dmZlib::RESULT_OK)
+            {
+                dmLogError("Failed to decompress glyph (%c) in font %s: %d", g->m_Character, dmHashReverseSafe64(font_map->m_NameHash), zlib_result);
+                return 0;
+            }
+
+            uint32_t uncompressed_size = deflate_context.m_Cursor;
+            delta_decode(font_map->m_CellTempData, uncompressed_size);
+
+            return font_map->m_CellTempData;
+        }
+        else if (FONT_GLYPH_COMPRESSION_DEFLATE_PAGE == glyph_data_compression)
+        {
+            FontGlyphPage header;
+            if (glyph_data_size < sizeof(header))
+            {
+                dmLogError("Invalid glyph page header for glyph (%c) in font %s", g->m_Character, dmHashReverseSafe64(font_map->m_NameHash));
+                return 0;
+            }
+            memcpy(&header, glyph_data, sizeof(header));
+
+            const uint8_t* page = AcquireGlyphPage(font_map, glyph_data + header.m_PageOffset, header.m_PageSize, header.m_PageDataSize);
+            uint32_t image_size = glyph_image_width * glyph_image_height * font_map->m_CacheChannels;
+            if (!page || header.m_GlyphOffset > header.m_PageDataSize || image_size > header.m_PageDataSize - header.m_GlyphOffset)
+            {
+                dmLogError("Failed to get glyph (%c) from its page in font %s", g->m_Character, dmHashReverseSafe64(font_map->m_NameHash));
+                return 0;
+            }
+            return page + header.m_GlyphOffset;
+        }
+        else if (FONT_GLYPH_COMPRESSION_NONE == glyph_data_compression)
+        {
+            return glyph_data;
+        }
+
+        dmLogOnceError("Unknown glyph compression: %u for glyph (%c) in font %s", glyph_data_compression, g->m_Character, dmHashReverseSafe64(font_map->m_NameHash));
+        return 0;
     }
 
-    // Either get a free slot, or the oldest one
+    // Either get a free slot, or the oldest one.
+    // The cells are used in order, so once they're all used, the oldest cell is the one after the last one replaced.
     static CacheGlyph* AcquireFreeGlyphFromCache(HFontMap font_map, uint32_t c, uint32_t time)
     {
         uint32_t index;
         if (font_map->m_CacheCursor < font_map->m_CacheCellCount)
+        {
             index = font_map->m_CacheCursor++;      // Get the unused slot
+        }
         else
-            index = font_map->m_CacheCellCount-1;   // Get the oldest slot
+        {
+            index = font_map->m_CacheEvictCursor;   // Get the oldest slot
+            font_map->m_CacheEvictCursor = (index + 1) % font_map->m_CacheCellCount;
+        }
 
         return &font_map->m_Cache[index];
     }
@@ -709,59 +1093,60 @@ namespace dmRender
     //     printf("Glyph cache:\n");
     //     for (uint32_t i = 0; i < font_map->m_CacheCursor; ++i)
     //     {
-    //         uint16_t index = font_map->m_CacheIndices[i];
-    //         CacheGlyph* g = &font_map->m_Cache[index];
+    //         CacheGlyph* g = &font_map->m_Cache[i];
     //         printf("%d: '%c'  t: %u  x/y: %u, %u  is_in_cache: %d\n", i, g->m_Glyph->m_Character, g->m_Frame, g->m_X, g->m_Y, IsInCache(font_map, g->m_Glyph->m_Character));
     //     }
     // }
 
     static void UpdateGlyphTexture(HFontMap font_map, dmRender::FontGlyph* g, int32_t x, int32_t y, int offset_y)
     {
-        uint32_t glyph_data_compression; // E.g. FONT_GLYPH_COMPRESSION_NONE;
-        uint32_t glyph_data_size = 0;
         uint32_t glyph_image_width = 0;
         uint32_t glyph_image_height = 0;
-        uint8_t* glyph_data = (uint8_t*)font_map->m_GetGlyphData(g->m_Character, font_map->m_UserData, &glyph_data_size, &glyph_data_compression, &glyph_image_width, &glyph_image_height);
+        const uint8_t* data = GetGlyphImage(font_map, g, &glyph_image_width, &glyph_image_height);
 
-        void* data = 0;
-        if (FONT_GLYPH_COMPRESSION_DEFLATE == glyph_data_compression)
+        // Copy the glyph into the cpu copy of the cache, it is uploaded with the other new glyphs (see UploadGlyphTexture)
+        y += offset_y;
+        if (data == 0 || x < 0 || y < 0 || x >= (int32_t) font_map->m_CacheWidth || y >= (int32_t) font_map->m_CacheHeight)
         {
-            // When if came to choosing between the different algorithms, here are some speed/compression tests
-            // Decoding 100 glyphs
-            // lz4:     0.1060 ms  compression: 72%
-            // deflate: 0.2190 ms  compression: 66%
-            // png:     0.6930 ms  compression: 67%
-            // webp:    1.5170 ms  compression: 55%
-            // further improvements (different test, Android, 92 glyphs)
-            // webp          2.9440 ms  compression: 55%
-            // deflate       0.7110 ms  compression: 66%
-            // deflate+delta 0.7680 ms  compression: 62%
-
-            FontGlyphInflaterContext deflate_context;
-            deflate_context.m_Output = font_map->m_CellTempData;
-            deflate_context.m_Cursor = 0;
-            dmZlib::Result zlib_result = dmZlib::InflateBuffer(glyph_data, glyph_data_size, &deflate_context, FontGlyphInflater);
-            if (zlib_result != dmZlib::RESULT_OK)
-            {
-                dmLogError("Failed to decompress glyph (%c) in font %s: %d", g->m_Character, dmHashReverseSafe64(font_map->m_NameHash), zlib_result);
-                return;
-            }
-
-            uint32_t uncompressed_size = deflate_context.m_Cursor;
-            delta_decode(font_map->m_CellTempData, uncompressed_size);
-
-            data = font_map->m_CellTempData;
+            return;
         }
-        else if (FONT_GLYPH_COMPRESSION_NONE == glyph_data_compression)
+        uint32_t width  = dmMath::Min(glyph_image_width, font_map->m_CacheWidth - x);
+        uint32_t height = dmMath::Min(glyph_image_height, font_map->m_CacheHeight - y);
+
+        const uint32_t channels   = font_map->m_CacheChannels;
+        const uint32_t src_stride = glyph_image_width * channels;
+        const uint32_t dst_stride = font_map->m_CacheWidth * channels;
+        uint8_t* dst = font_map->m_CacheData + y * dst_stride + x * channels;
+        const uint8_t* src = (const uint8_t*) data;
+        for (uint32_t row = 0; row < height; ++row)
+        {
+            memcpy(dst, src, width * channels);
+            dst += dst_stride;
+            src += src_stride;
+        }
+
+        if (font_map->m_CacheDirtyMinY >= font_map->m_CacheDirtyMaxY)
         {
-            data = glyph_data;
+            font_map->m_CacheDirtyMinY = y;
+            font_map->m_CacheDirtyMaxY = y + height;
         }
         else
         {
-            dmLogOnceError("Unknown glyph compression: %u for glyph (%c) in font %s", glyph_data_compression, g->m_Character, dmHashReverseSafe64(font_map->m_NameHash));
+            font_map->m_CacheDirtyMinY = dmMath::Min(font_map->m_CacheDirtyMinY, (uint32_t) y);
+            font_map->m_CacheDirtyMaxY = dmMath::Max(font_map->m_CacheDirtyMaxY, y + height);
+        }
+    }
+
+    // Uploads the rows of the cache that got new glyphs since the last upload, as a single texture update
+    static void UploadGlyphTexture(HFontMap font_map)
+    {
+        if (font_map->m_CacheDirtyMinY >= font_map->m_CacheDirtyMaxY)
+        {
             return;
         }
 
+        DM_PROFILE("UploadGlyphTexture");
+
         dmGraphics::TextureParams tex_params;
         tex_params.m_SubUpdate = true;
         tex_params.m_MipMap = 0;
@@ -769,20 +1154,27 @@ namespace dmRender
         tex_params.m_MinFilter = font_map->m_MinFilter;
         tex_params.m_MagFilter = font_map->m_MagFilter;
 
-        tex_params.m_Width = glyph_image_width;
-        tex_params.m_Height = glyph_image_height;
+        tex_params.m_Width = font_map->m_CacheWidth;
+        tex_params.m_Height = font_map->m_CacheDirtyMaxY - font_map->m_CacheDirtyMinY;
 
-        tex_params.m_X = x;
-        tex_params.m_Y = y + offset_y;
+        tex_params.m_X = 0;
+        tex_params.m_Y = font_map->m_CacheDirtyMinY;
 
-        tex_params.m_Data = data;
+        tex_params.m_Data = font_map->m_CacheData + font_map->m_CacheDirtyMinY * font_map->m_CacheWidth * font_map->m_CacheChannels;
 
         // Upload glyph data to GPU
         dmGraphics::SetTexture(font_map->m_Texture, tex_params);
+
+        font_map->m_CacheDirtyMinY = 0;
+        font_map->m_CacheDirtyMaxY = 0;
     }
 
     static void AddGlyphToCache(HFontMap font_map, uint32_t frame, uint32_t c, dmRender::FontGlyph* g, int32_t g_offset_y)
     {
+        // A cached text layout may still refer to a glyph that has since been removed from the font
+        if (!g)
+            return;
+
         // Locate a cache cell candidate
         CacheGlyph* cache_glyph = AcquireFreeGlyphFromCache(font_map, c, frame);
 
@@ -802,10 +1194,7 @@ namespace dmRender
         cache_glyph->m_Glyph = g;
 
         font_map->m_GlyphCache.Put(g->m_Character, cache_glyph);
-
-        // Sort the glyphs, so that if we need to add another one, the oldest is at the end, for fast access
         cache_glyph->m_Frame = frame;
-        SortCache(font_map);
 
         //DebugCache(font_map);
 
@@ -813,34 +1202,11 @@ namespace dmRender
 
     }
 
-    static int CreateFontVertexDataInternal(TextContext& text_context, HFontMap font_map, const char* text, const TextEntry& te, float recip_w, float recip_h, GlyphVertex* vertices, uint32_t num_vertices)
+    // Glyphs that aren't in the glyph cache are added, unless add_missing_glyphs is false (e.g. when called from a job), in which case they're skipped
+    static int CreateFontVertexDataInternal(TextContext& text_context, HFontMap font_map, const TextLayout* layout, const TextEntry& te, float recip_w, float recip_h, GlyphVertex* vertices, uint32_t num_vertices, bool add_missing_glyphs)
     {
-        float width = te.m_Width;
-        if (!te.m_LineBreak) {
-            width = FLT_MAX;
-        }
-        float line_height = font_map->m_MaxAscent + font_map->m_MaxDescent;
-        float leading = line_height * te.m_Leading;
-        float tracking = line_height * te.m_Tracking;
-
-        const uint32_t max_lines = 128;
-        TextLine lines[max_lines];
-
-        // Trailing space characters should be ignored when measuring and
-        // rendering multiline text.
-        // For single line text we still want to include spaces when the text
-        // layout is calculated (https://github.com/defold/defold/issues/5911)
-        bool measure_trailing_space = !te.m_LineBreak;
-
-        LayoutMetrics lm(font_map, tracking);
-        float layout_width;
-        int line_count = Layout(text, width, lines, max_lines, &layout_width, lm, measure_trailing_space);
-        float x_offset = OffsetX(te.m_Align, te.m_Width);
-        if (font_map->m_IsMonospaced)
-        {
-            x_offset -= font_map->m_Padding * 0.5f;
-        }
-        float y_offset = OffsetY(te.m_VAlign, te.m_Height, font_map->m_MaxAscent, font_map->m_MaxDescent, te.m_Leading, line_count);
+        const TextLayoutGlyph* layout_glyphs = layout->m_Glyphs;
+        const uint32_t layout_glyph_count = layout->m_GlyphCount;
 
         const Vector4 face_color    = dmGraphics::UnpackRGBA(te.m_FaceColor);
         const Vector4 outline_color = dmGraphics::UnpackRGBA(te.m_OutlineColor);
@@ -883,243 +1249,208 @@ namespace dmRender
             layer_count += HAS_LAYER(layer_mask,OUTLINE) + HAS_LAYER(layer_mask,SHADOW);
 
             // Calculate number of valid glyphs
-            for (int line = 0; line < line_count; ++line)
+            for (uint32_t i = 0; i < layout_glyph_count; ++i)
             {
-                TextLine& l = lines[line];
-                const char* cursor = &text[l.m_Index];
-                bool inner_break = false;
-
-                for (int j = 0; j < l.m_Count; ++j)
+                if ((vertexindex + vertices_per_quad) * layer_count > num_vertices)
                 {
-                    uint32_t c = dmUtf8::NextChar(&cursor);
-                    dmRender::FontGlyph* g = GetGlyph(font_map, c);
-                    if (!g)
-                    {
-                        continue;
-                    }
-
-                    if ((vertexindex + vertices_per_quad) * layer_count > num_vertices)
-                    {
-                        inner_break = true;
-                        break;
-                    }
-
-                    if (g->m_Width > 0)
-                    {
-                        int16_t px_cell_offset_y = font_map->m_CacheCellMaxAscent - (int16_t)g->m_Ascent;
-
-                        // Prepare the cache here aswell since we only count glyphs we definitely will render.
-                        if (!IsInCache(font_map, c))
-                        {
-                            AddGlyphToCache(font_map, text_context.m_Frame, c, g, px_cell_offset_y);
-                        }
+                    break;
+                }
 
-                        CacheGlyph* cache_glyph = GetFromCache(font_map, c);
-                        if (cache_glyph)
-                        {
-                            valid_glyph_count++;
+                uint32_t c = layout_glyphs[i].m_Character;
+                int16_t px_cell_offset_y = font_map->m_CacheCellMaxAscent - layout_glyphs[i].m_Ascent;
 
-                            vertexindex += vertices_per_quad;
-                        }
-                    }
+                // Prepare the cache here aswell since we only count glyphs we definitely will render.
+                if (add_missing_glyphs && !IsInCache(font_map, c))
+                {
+                    AddGlyphToCache(font_map, text_context.m_Frame, c, GetGlyph(font_map, c), px_cell_offset_y);
                 }
 
-                if (inner_break)
+                CacheGlyph* cache_glyph = GetFromCache(font_map, c);
+                if (cache_glyph)
                 {
-                    break;
+                    valid_glyph_count++;
+
+                    vertexindex += vertices_per_quad;
                 }
             }
 
             vertexindex = 0;
         }
 
-        for (int line = 0; line < line_count; ++line) {
-            TextLine& l = lines[line];
-            float x = x_offset - OffsetX(te.m_Align, l.m_Width);
-            float y = y_offset - line * leading;
-            const char* cursor = &text[l.m_Index];
-            int n = l.m_Count;
-            for (int j = 0; j < n; ++j)
+        for (uint32_t i = 0; i < layout_glyph_count; ++i)
+        {
+            const TextLayoutGlyph& layout_glyph = layout_glyphs[i];
+            uint32_t c = layout_glyph.m_Character;
+            float x = layout_glyph.m_X;
+            float y = layout_glyph.m_Y;
+
+            // Look ahead and see if we can produce vertices for the next glyph or not
+            if ((vertexindex + vertices_per_quad) * layer_count > num_vertices)
             {
-                uint32_t c = dmUtf8::NextChar(&cursor);
+                dmLogWarning("Character buffer exceeded (size: %d), increase the \"graphics.max_characters\" property in your game.project file.", num_vertices / 6);
+                return vertexindex * layer_count;
+            }
 
-                FontGlyph* glyph = GetGlyph(font_map, c);
-                if (!glyph) {
-                    continue;
-                }
+            int16_t width        = layout_glyph.m_Width;
+            int16_t descent      = layout_glyph.m_Descent;
+            int16_t ascent       = layout_glyph.m_Ascent;
+            int16_t left_bearing = layout_glyph.m_LeftBearing;
 
-                // Look ahead and see if we can produce vertices for the next glyph or not
-                if ((vertexindex + vertices_per_quad) * layer_count > num_vertices)
+            // Calculate y-offset in cache-cell space by moving glyphs down to baseline
+            int16_t px_cell_offset_y = font_map->m_CacheCellMaxAscent - ascent;
+
+            if (add_missing_glyphs && !IsInCache(font_map, c))
+            {
+                AddGlyphToCache(font_map, text_context.m_Frame, c, GetGlyph(font_map, c), px_cell_offset_y);
+            }
+
+            CacheGlyph* cache_glyph = GetFromCache(font_map, c);
+            if (cache_glyph)
+            {
+                uint32_t face_index = vertexindex + vertices_per_quad * valid_glyph_count * (layer_count-1);
+                uint32_t tx = cache_glyph->m_X;
+                uint32_t ty = cache_glyph->m_Y;
+
+                // Set face vertices first, this will always hold since we can't have less than 1 layer
+                GlyphVertex& v1_layer_face = vertices[face_index];
+                GlyphVertex& v2_layer_face = vertices[face_index + 1];
+                GlyphVertex& v3_layer_face = vertices[face_index + 2];
+                GlyphVertex& v4_layer_face = vertices[face_index + 3];
+                GlyphVertex& v5_layer_face = vertices[face_index + 4];
+                GlyphVertex& v6_layer_face = vertices[face_index + 5];
+
+                (Vector4&) v1_layer_face.m_Position = te.m_Transform * Vector4(x + left_bearing, y - descent, 0, 1);
+                (Vector4&) v2_layer_face.m_Position = te.m_Transform * Vector4(x + left_bearing, y + ascent, 0, 1);
+                (Vector4&) v3_layer_face.m_Position = te.m_Transform * Vector4(x + left_bearing + width, y - descent, 0, 1);
+                (Vector4&) v6_layer_face.m_Position = te.m_Transform * Vector4(x + left_bearing + width, y + ascent, 0, 1);
+
+                v1_layer_face.m_UV[0] = (tx + font_map->m_CacheCellPadding) * recip_w;
+                v1_layer_face.m_UV[1] = (ty + font_map->m_CacheCellPadding + ascent + descent + px_cell_offset_y) * recip_h;
+
+                v2_layer_face.m_UV[0] = (tx + font_map->m_CacheCellPadding) * recip_w;
+                v2_layer_face.m_UV[1] = (ty + font_map->m_CacheCellPadding + px_cell_offset_y) * recip_h;
+
+                v3_layer_face.m_UV[0] = (tx + font_map->m_CacheCellPadding + width) * recip_w;
+                v3_layer_face.m_UV[1] = (ty + font_map->m_CacheCellPadding + ascent + descent + px_cell_offset_y) * recip_h;
+
+                v6_layer_face.m_UV[0] = (tx + font_map->m_CacheCellPadding + width) * recip_w;
+                v6_layer_face.m_UV[1] = (ty + font_map->m_CacheCellPadding + px_cell_offset_y) * recip_h;
+
+                #define SET_VERTEX_FONT_PROPERTIES(v) \
+                    v.m_FaceColor[0]    = face_color[0]; \
+                    v.m_FaceColor[1]    = face_color[1]; \
+                    v.m_FaceColor[2]    = face_color[2]; \
+                    v.m_FaceColor[3]    = face_color[3]; \
+                    v.m_OutlineColor[0] = outline_color[0]; \
+                    v.m_OutlineColor[1] = outline_color[1]; \
+                    v.m_OutlineColor[2] = outline_color[2]; \
+                    v.m_OutlineColor[3] = outline_color[3]; \
+                    v.m_ShadowColor[0]  = shadow_color[0]; \
+                    v.m_ShadowColor[1]  = shadow_color[1]; \
+                    v.m_ShadowColor[2]  = shadow_color[2]; \
+                    v.m_ShadowColor[3]  = shadow_color[3]; \
+                    v.m_FaceColor[0]    = face_color[0]; \
+                    v.m_FaceColor[1]    = face_color[1]; \
+                    v.m_FaceColor[2]    = face_color[2]; \
+                    v.m_FaceColor[3]    = face_color[3]; \
+                    v.m_SdfParams[0]    = sdf_edge_value; \
+                    v.m_SdfParams[1]    = sdf_outline; \
+                    v.m_SdfParams[2]    = sdf_smoothing; \
+                    v.m_SdfParams[3]    = sdf_shadow;
+
+                SET_VERTEX_FONT_PROPERTIES(v1_layer_face)
+                SET_VERTEX_FONT_PROPERTIES(v2_layer_face)
+                SET_VERTEX_FONT_PROPERTIES(v3_layer_face)
+                SET_VERTEX_FONT_PROPERTIES(v6_layer_face)
+
+                #undef SET_VERTEX_FONT_PROPERTIES
+
+                v4_layer_face = v3_layer_face;
+                v5_layer_face = v2_layer_face;
+
+                #define SET_VERTEX_LAYER_MASK(v,f,o,s) \
+                    v.m_LayerMasks[0] = f; \
+                    v.m_LayerMasks[1] = o; \
+                    v.m_LayerMasks[2] = s;
+
+                // Set outline vertices
+                if (HAS_LAYER(layer_mask,OUTLINE))
                 {
-                    dmLogWarning("Character buffer exceeded (size: %d), increase the \"graphics.max_characters\" property in your game.project file.", num_vertices / 6);
-                    return vertexindex * layer_count;
+                    uint32_t outline_index = vertexindex + vertices_per_quad * valid_glyph_count * (layer_count-2);
+
+                    GlyphVertex& v1_layer_outline = vertices[outline_index];
+                    GlyphVertex& v2_layer_outline = vertices[outline_index + 1];
+                    GlyphVertex& v3_layer_outline = vertices[outline_index + 2];
+                    GlyphVertex& v4_layer_outline = vertices[outline_index + 3];
+                    GlyphVertex& v5_layer_outline = vertices[outline_index + 4];
+                    GlyphVertex& v6_layer_outline = vertices[outline_index + 5];
+
+                    v1_layer_outline = v1_layer_face;
+                    v2_layer_outline = v2_layer_face;
+                    v3_layer_outline = v3_layer_face;
+                    v4_layer_outline = v4_layer_face;
+                    v5_layer_outline = v5_layer_face;
+                    v6_layer_outline = v6_layer_face;
+
+                    SET_VERTEX_LAYER_MASK(v1_layer_outline,0,1,0)
+                    SET_VERTEX_LAYER_MASK(v2_layer_outline,0,1,0)
+                    SET_VERTEX_LAYER_MASK(v3_layer_outline,0,1,0)
+                    SET_VERTEX_LAYER_MASK(v4_layer_outline,0,1,0)
+                    SET_VERTEX_LAYER_MASK(v5_layer_outline,0,1,0)
+                    SET_VERTEX_LAYER_MASK(v6_layer_outline,0,1,0)
                 }
 
-                if (glyph->m_Width > 0)
+                // Set shadow vertices
+                if (HAS_LAYER(layer_mask,SHADOW))
                 {
-                    int16_t width        = (int16_t) glyph->m_Width;
-                    int16_t descent      = (int16_t) glyph->m_Descent;
-                    int16_t ascent       = (int16_t) glyph->m_Ascent;
-                    int16_t left_bearing = (int16_t) glyph->m_LeftBearing;
-
-                    // Calculate y-offset in cache-cell space by moving glyphs down to baseline
-                    int16_t px_cell_offset_y = font_map->m_CacheCellMaxAscent - ascent;
-
-                    if (!IsInCache(font_map, c))
-                    {
-                        AddGlyphToCache(font_map, text_context.m_Frame, c, glyph, px_cell_offset_y);
-                    }
-
-                    CacheGlyph* cache_glyph = GetFromCache(font_map, c);
-                    if (cache_glyph)
-                    {
-                        uint32_t face_index = vertexindex + vertices_per_quad * valid_glyph_count * (layer_count-1);
-                        uint32_t tx = cache_glyph->m_X;
-                        uint32_t ty = cache_glyph->m_Y;
-
-                        // Set face vertices first, this will always hold since we can't have less than 1 layer
-                        GlyphVertex& v1_layer_face = vertices[face_index];
-                        GlyphVertex& v2_layer_face = vertices[face_index + 1];
-                        GlyphVertex& v3_layer_face = vertices[face_index + 2];
-                        GlyphVertex& v4_layer_face = vertices[face_index + 3];
-                        GlyphVertex& v5_layer_face = vertices[face_index + 4];
-                        GlyphVertex& v6_layer_face = vertices[face_index + 5];
-
-                        (Vector4&) v1_layer_face.m_Position = te.m_Transform * Vector4(x + left_bearing, y - descent, 0, 1);
-                        (Vector4&) v2_layer_face.m_Position = te.m_Transform * Vector4(x + left_bearing, y + ascent, 0, 1);
-                        (Vector4&) v3_layer_face.m_Position = te.m_Transform * Vector4(x + left_bearing + width, y - descent, 0, 1);
-                        (Vector4&) v6_layer_face.m_Position = te.m_Transform * Vector4(x + left_bearing + width, y + ascent, 0, 1);
-
-                        v1_layer_face.m_UV[0] = (tx + font_map->m_CacheCellPadding) * recip_w;
-                        v1_layer_face.m_UV[1] = (ty + font_map->m_CacheCellPadding + ascent + descent + px_cell_offset_y) * recip_h;
-
-                        v2_layer_face.m_UV[0] = (tx + font_map->m_CacheCellPadding) * recip_w;
-                        v2_layer_face.m_UV[1] = (ty + font_map->m_CacheCellPadding + px_cell_offset_y) * recip_h;
-
-                        v3_layer_face.m_UV[0] = (tx + font_map->m_CacheCellPadding + width) * recip_w;
-                        v3_layer_face.m_UV[1] = (ty + font_map->m_CacheCellPadding + ascent + descent + px_cell_offset_y) * recip_h;
-
-                        v6_layer_face.m_UV[0] = (tx + font_map->m_CacheCellPadding + width) * recip_w;
-                        v6_layer_face.m_UV[1] = (ty + font_map->m_CacheCellPadding + px_cell_offset_y) * recip_h;
-
-                        #define SET_VERTEX_FONT_PROPERTIES(v) \
-                            v.m_FaceColor[0]    = face_color[0]; \
-                            v.m_FaceColor[1]    = face_color[1]; \
-                            v.m_FaceColor[2]    = face_color[2]; \
-                            v.m_FaceColor[3]    = face_color[3]; \
-                            v.m_OutlineColor[0] = outline_color[0]; \
-                            v.m_OutlineColor[1] = outline_color[1]; \
-                            v.m_OutlineColor[2] = outline_color[2]; \
-                            v.m_OutlineColor[3] = outline_color[3]; \
-                            v.m_ShadowColor[0]  = shadow_color[0]; \
-                            v.m_ShadowColor[1]  = shadow_color[1]; \
-                            v.m_ShadowColor[2]  = shadow_color[2]; \
-                            v.m_ShadowColor[3]  = shadow_color[3]; \
-                            v.m_FaceColor[0]    = face_color[0]; \
-                            v.m_FaceColor[1]    = face_color[1]; \
-                            v.m_FaceColor[2]    = face_color[2]; \
-                            v.m_FaceColor[3]    = face_color[3]; \
-                            v.m_SdfParams[0]    = sdf_edge_value; \
-                            v.m_SdfParams[1]    = sdf_outline; \
-                            v.m_SdfParams[2]    = sdf_smoothing; \
-                            v.m_SdfParams[3]    = sdf_shadow;
-
-                        SET_VERTEX_FONT_PROPERTIES(v1_layer_face)
-                        SET_VERTEX_FONT_PROPERTIES(v2_layer_face)
-                        SET_VERTEX_FONT_PROPERTIES(v3_layer_face)
-                        SET_VERTEX_FONT_PROPERTIES(v6_layer_face)
-
-                        #undef SET_VERTEX_FONT_PROPERTIES
-
-                        v4_layer_face = v3_layer_face;
-                        v5_layer_face = v2_layer_face;
-
-                        #define SET_VERTEX_LAYER_MASK(v,f,o,s) \
-                            v.m_LayerMasks[0] = f; \
-                            v.m_LayerMasks[1] = o; \
-                            v.m_LayerMasks[2] = s;
-
-                        // Set outline vertices
-                        if (HAS_LAYER(layer_mask,OUTLINE))
-                        {
-                            uint32_t outline_index = vertexindex + vertices_per_quad * valid_glyph_count * (layer_count-2);
-
-                            GlyphVertex& v1_layer_outline = vertices[outline_index];
-                            GlyphVertex& v2_layer_outline = vertices[outline_index + 1];
-                            GlyphVertex& v3_layer_outline = vertices[outline_index + 2];
-                            GlyphVertex& v4_layer_outline = vertices[outline_index + 3];
-                            GlyphVertex& v5_layer_outline = vertices[outline_index + 4];
-                            GlyphVertex& v6_layer_outline = vertices[outline_index + 5];
-
-                            v1_layer_outline = v1_layer_face;
-                            v2_layer_outline = v2_layer_face;
-                            v3_layer_outline = v3_layer_face;
-                            v4_layer_outline = v4_layer_face;
-                            v5_layer_outline = v5_layer_face;
-                            v6_layer_outline = v6_layer_face;
-
-                            SET_VERTEX_LAYER_MASK(v1_layer_outline,0,1,0)
-                            SET_VERTEX_LAYER_MASK(v2_layer_outline,0,1,0)
-                            SET_VERTEX_LAYER_MASK(v3_layer_outline,0,1,0)
-                            SET_VERTEX_LAYER_MASK(v4_layer_outline,0,1,0)
-                            SET_VERTEX_LAYER_MASK(v5_layer_outline,0,1,0)
-                            SET_VERTEX_LAYER_MASK(v6_layer_outline,0,1,0)
-                        }
-
-                        // Set shadow vertices
-                        if (HAS_LAYER(layer_mask,SHADOW))
-                        {
-                            uint32_t shadow_index = vertexindex;
-                            float shadow_x        = font_map->m_ShadowX;
-                            float shadow_y        = font_map->m_ShadowY;
-
-                            GlyphVertex& v1_layer_shadow = vertices[shadow_index];
-                            GlyphVertex& v2_layer_shadow = vertices[shadow_index + 1];
-                            GlyphVertex& v3_layer_shadow = vertices[shadow_index + 2];
-                            GlyphVertex& v4_layer_shadow = vertices[shadow_index + 3];
-                            GlyphVertex& v5_layer_shadow = vertices[shadow_index + 4];
-                            GlyphVertex& v6_layer_shadow = vertices[shadow_index + 5];
-
-                            v1_layer_shadow = v1_layer_face;
-                            v2_layer_shadow = v2_layer_face;
-                            v3_layer_shadow = v3_layer_face;
-                            v6_layer_shadow = v6_layer_face;
-
-                            // Shadow offsets must be calculated since we need to offset in local space (before vertex transformation)
-                            (Vector4&) v1_layer_shadow.m_Position = te.m_Transform * Vector4(x + left_bearing + shadow_x, y - descent + shadow_y, 0, 1);
-                            (Vector4&) v2_layer_shadow.m_Position = te.m_Transform * Vector4(x + left_bearing + shadow_x, y + ascent + shadow_y, 0, 1);
-                            (Vector4&) v3_layer_shadow.m_Position = te.m_Transform * Vector4(x + left_bearing + shadow_x + width, y - descent + shadow_y, 0, 1);
-                            (Vector4&) v6_layer_shadow.m_Position = te.m_Transform * Vector4(x + left_bearing + shadow_x + width, y + ascent + shadow_y, 0, 1);
-
-                            v4_layer_shadow = v3_layer_shadow;
-                            v5_layer_shadow = v2_layer_shadow;
-
-                            SET_VERTEX_LAYER_MASK(v1_layer_shadow,0,0,1)
-                            SET_VERTEX_LAYER_MASK(v2_layer_shadow,0,0,1)
-                            SET_VERTEX_LAYER_MASK(v3_layer_shadow,0,0,1)
-                            SET_VERTEX_LAYER_MASK(v4_layer_shadow,0,0,1)
-                            SET_VERTEX_LAYER_MASK(v5_layer_shadow,0,0,1)
-                            SET_VERTEX_LAYER_MASK(v6_layer_shadow,0,0,1)
-                        }
-
-                        // If we only have one layer, we need to set the mask to (1,1,1)
-                        // so that we can use the same calculations for both single and multi.
-                        // The mask is set last for layer 1 since we copy the vertices to
-                        // all other layers to avoid re-calculating their data.
-                        uint8_t is_one_layer = layer_count > 1 ? 0 : 1;
-                        SET_VERTEX_LAYER_MASK(v1_layer_face,1,is_one_layer,is_one_layer)
-                        SET_VERTEX_LAYER_MASK(v2_layer_face,1,is_one_layer,is_one_layer)
-                        SET_VERTEX_LAYER_MASK(v3_layer_face,1,is_one_layer,is_one_layer)
-                        SET_VERTEX_LAYER_MASK(v4_layer_face,1,is_one_layer,is_one_layer)
-                        SET_VERTEX_LAYER_MASK(v5_layer_face,1,is_one_layer,is_one_layer)
-                        SET_VERTEX_LAYER_MASK(v6_layer_face,1,is_one_layer,is_one_layer)
-
-                        #undef SET_VERTEX_LAYER_MASK
-
-                        vertexindex += vertices_per_quad;
-                    }
+                    uint32_t shadow_index = vertexindex;
+                    float shadow_x        = font_map->m_ShadowX;
+                    float shadow_y        = font_map->m_ShadowY;
+
+                    GlyphVertex& v1_layer_shadow = vertices[shadow_index];
+                    GlyphVertex& v2_layer_shadow = vertices[shadow_index + 1];
+                    GlyphVertex& v3_layer_shadow = vertices[shadow_index + 2];
+                    GlyphVertex& v4_layer_shadow = vertices[shadow_index + 3];
+                    GlyphVertex& v5_layer_shadow = vertices[shadow_index + 4];
+                    GlyphVertex& v6_layer_shadow = vertices[shadow_index + 5];
+
+                    v1_layer_shadow = v1_layer_face;
+                    v2_layer_shadow = v2_layer_face;
+                    v3_layer_shadow = v3_layer_face;
+                    v6_layer_shadow = v6_layer_face;
+
+                    // Shadow offsets must be calculated since we need to offset in local space (before vertex transformation)
+                    (Vector4&) v1_layer_shadow.m_Position = te.m_Transform * Vector4(x + left_bearing + shadow_x, y - descent + shadow_y, 0, 1);
+                    (Vector4&) v2_layer_shadow.m_Position = te.m_Transform * Vector4(x + left_bearing + shadow_x, y + ascent + shadow_y, 0, 1);
+                    (Vector4&) v3_layer_shadow.m_Position = te.m_Transform * Vector4(x + left_bearing + shadow_x + width, y - descent + shadow_y, 0, 1);
+                    (Vector4&) v6_layer_shadow.m_Position = te.m_Transform * Vector4(x + left_bearing + shadow_x + width, y + ascent + shadow_y, 0, 1);
+
+                    v4_layer_shadow = v3_layer_shadow;
+                    v5_layer_shadow = v2_layer_shadow;
+
+                    SET_VERTEX_LAYER_MASK(v1_layer_shadow,0,0,1)
+                    SET_VERTEX_LAYER_MASK(v2_layer_shadow,0,0,1)
+                    SET_VERTEX_LAYER_MASK(v3_layer_shadow,0,0,1)
+                    SET_VERTEX_LAYER_MASK(v4_layer_shadow,0,0,1)
+                    SET_VERTEX_LAYER_MASK(v5_layer_shadow,0,0,1)
+                    SET_VERTEX_LAYER_MASK(v6_layer_shadow,0,0,1)
                 }
-                x += glyph->m_Advance + tracking;
+
+                // If we only have one layer, we need to set the mask to (1,1,1)
+                // so that we can use the same calculations for both single and multi.
+                // The mask is set last for layer 1 since we copy the vertices to
+                // all other layers to avoid re-calculating their data.
+                uint8_t is_one_layer = layer_count > 1 ? 0 : 1;
+                SET_VERTEX_LAYER_MASK(v1_layer_face,1,is_one_layer,is_one_layer)
+                SET_VERTEX_LAYER_MASK(v2_layer_face,1,is_one_layer,is_one_layer)
+                SET_VERTEX_LAYER_MASK(v3_layer_face,1,is_one_layer,is_one_layer)
+                SET_VERTEX_LAYER_MASK(v4_layer_face,1,is_one_layer,is_one_layer)
+                SET_VERTEX_LAYER_MASK(v5_layer_face,1,is_one_layer,is_one_layer)
+                SET_VERTEX_LAYER_MASK(v6_layer_face,1,is_one_layer,is_one_layer)
+
+                #undef SET_VERTEX_LAYER_MASK
+
+                vertexindex += vertices_per_quad;
             }
         }
 
@@ -1128,6 +1459,120 @@ namespace dmRender
         return vertexindex * layer_count;
     }
 
+    // Adds the glyphs of a layout to the glyph cache, and returns the number of vertices CreateFontVertexDataInternal() will write for it
+    static uint32_t CacheLayoutGlyphs(HFontMap font_map, uint32_t frame, const TextLayout* layout, uint32_t num_vertices)
+    {
+        uint8_t layer_mask = font_map->m_LayerMask;
+        if ((layer_mask & FACE) != FACE)
+        {
+            return 0;
+        }
+        uint32_t layer_count = 1 + ((layer_mask & OUTLINE) == OUTLINE) + ((layer_mask & SHADOW) == SHADOW);
+        uint32_t vertices_per_glyph = 6 * layer_count;
+
+        uint32_t glyph_count = 0;
+        for (uint32_t i = 0; i < layout->m_GlyphCount; ++i)
+        {
+            if ((glyph_count + 1) * vertices_per_glyph > num_vertices)
+            {
+                dmLogWarning("Character buffer exceeded (size: %d), increase the \"graphics.max_characters\" property in your game.project file.", num_vertices / 6);
+                break;
+            }
+
+            const TextLayoutGlyph& layout_glyph = layout->m_Glyphs[i];
+            uint32_t c = layout_glyph.m_Character;
+            if (!IsInCache(font_map, c))
+            {
+                int16_t px_cell_offset_y = font_map->m_CacheCellMaxAscent - layout_glyph.m_Ascent;
+                AddGlyphToCache(font_map, frame, c, GetGlyph(font_map, c), px_cell_offset_y);
+            }
+
+            if (IsInCache(font_map, c))
+            {
+                glyph_count++;
+            }
+        }
+        return glyph_count * vertices_per_glyph;
+    }
+
+    struct FontVertexJobContext
+    {
+        TextContext*    m_TextContext;
+        HFontMap        m_FontMap;
+        GlyphVertex*    m_Vertices;
+        float           m_RecipW;
+        float           m_RecipH;
+    };
+
+    static void CreateFontVertexDataRange(void* _ctx, uint32_t begin, uint32_t end)
+    {
+        DM_PROFILE("CreateFontVertexDataRange");
+        FontVertexJobContext* ctx = (FontVertexJobContext*) _ctx;
+        TextContext& text_context = *ctx->m_TextContext;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const TextVertexJob& job = text_context.m_VertexJobs[i];
+            GlyphVertex* vertices = &ctx->m_Vertices[job.m_VertexStart];
+            uint32_t vertex_count = CreateFontVertexDataInternal(text_context, ctx->m_FontMap, job.m_Layout, *job.m_Entry, ctx->m_RecipW, ctx->m_RecipH, vertices, job.m_VertexCount, false);
+
+            // A glyph of this text was evicted from the cache by a later text in the batch, so fill the rest of the range with degenerate triangles
+            if (vertex_count < job.m_VertexCount)
+            {
+                memset(vertices + vertex_count, 0, (job.m_VertexCount - vertex_count) * sizeof(GlyphVertex));
+            }
+        }
+    }
+
+    // The layouts are prepared and the glyph cache is updated on this thread, and each text gets a range of the vertex buffer.
+    // The vertices are then written by the job threads.
+    static void CreateFontVertexDataParallel(HRenderContext render_context, HFontMap font_map, float recip_w, float recip_h, dmRender::RenderListEntry *buf, uint32_t* begin, uint32_t* end)
+    {
+        TextContext& text_context = render_context->m_TextContext;
+        GlyphVertex* vertices = (GlyphVertex*)text_context.m_ClientBuffer;
+
+        dmArray<TextVertexJob>& jobs = text_context.m_VertexJobs;
+        jobs.SetSize(0);
+        if (jobs.Capacity() < (uint32_t)(end - begin))
+        {
+            jobs.SetCapacity(end - begin);
+        }
+
+        for (uint32_t *i = begin;i != end; ++i)
+        {
+            const TextEntry& te = *(TextEntry*) buf[*i].m_UserData;
+            const char* text = &text_context.m_TextBuffer[te.m_StringOffset];
+            uint32_t max_vertex_count = text_context.m_MaxVertexCount - text_context.m_VertexIndex;
+
+            TextLayout scratch_layout;
+            const TextLayout* layout = GetTextLayout(font_map, text_context.m_Frame, te.m_LayoutKey, text, te, &scratch_layout);
+            if (layout == &scratch_layout)
+            {
+                // The layout cache is full, and the scratch layout is reused by the next text
+                text_context.m_VertexIndex += CreateFontVertexDataInternal(text_context, font_map, layout, te, recip_w, recip_h, &vertices[text_context.m_VertexIndex], max_vertex_count, true);
+                continue;
+            }
+
+            TextVertexJob job;
+            job.m_Entry       = &te;
+            job.m_Layout      = layout;
+            job.m_VertexStart = text_context.m_VertexIndex;
+            job.m_VertexCount = CacheLayoutGlyphs(font_map, text_context.m_Frame, layout, max_vertex_count);
+            if (job.m_VertexCount > 0)
+            {
+                jobs.Push(job);
+                text_context.m_VertexIndex += job.m_VertexCount;
+            }
+        }
+
+        FontVertexJobContext ctx;
+        ctx.m_TextContext = &text_context;
+        ctx.m_FontMap     = font_map;
+        ctx.m_Vertices    = vertices;
+        ctx.m_RecipW      = recip_w;
+        ctx.m_RecipH      = recip_h;
+        dmJobThread::ParallelFor(render_context->m_JobThread, jobs.Size(), TEXT_PARALLEL_GRAIN_SIZE, CreateFontVertexDataRange, &ctx);
+    }
+
     static void CreateFontRenderBatch(HRenderContext render_context, dmRender::RenderListEntry *buf, uint32_t* begin, uint32_t* end)
     {
         DM_PROFILE("FontRenderBatch");
@@ -1180,17 +1625,31 @@ namespace dmRender
 
         ro->m_ConstantBuffer = constants_buffer;
 
-        for (uint32_t *i = begin;i != end; ++i)
+        uint32_t worker_count = render_context->m_JobThread ? dmJobThread::GetWorkerCount(render_context->m_JobThread) : 0;
+        if (worker_count > 0 && (uint32_t)(end - begin) >= TEXT_PARALLEL_VERTEX_THRESHOLD)
         {
-            const TextEntry& te = *(TextEntry*) buf[*i].m_UserData;
-            const char* text = &text_context.m_TextBuffer[te.m_StringOffset];
+            CreateFontVertexDataParallel(render_context, font_map, im_recip, ih_recip, buf, begin, end);
+        }
+        else
+        {
+            for (uint32_t *i = begin;i != end; ++i)
+            {
+                const TextEntry& te = *(TextEntry*) buf[*i].m_UserData;
+                const char* text = &text_context.m_TextBuffer[te.m_StringOffset];
+
+                // The layout is usually cached since the DrawText() call
+                TextLayout scratch_layout;
+                const TextLayout* layout = GetTextLayout(font_map, text_context.m_Frame, te.m_LayoutKey, text, te, &scratch_layout);
 
-            int num_indices = CreateFontVertexDataInternal(text_context, font_map, text, te, im_recip, ih_recip, &vertices[text_context.m_VertexIndex], text_context.m_MaxVertexCount - text_context.m_VertexIndex);
-            text_context.m_VertexIndex += num_indices;
+                int num_indices = CreateFontVertexDataInternal(text_context, font_map, layout, te, im_recip, ih_recip, &vertices[text_context.m_VertexIndex], text_context.m_MaxVertexCount - text_context.m_VertexIndex, true);
+                text_context.m_VertexIndex += num_indices;
+            }
         }
 
         ro->m_VertexCount = text_context.m_VertexIndex - ro->m_VertexStart;
 
+        UploadGlyphTexture(font_map);
+
         dmRender::AddToRender(render_context, ro);
     }
 
@@ -1352,11 +1811,32 @@ namespace dmRender
         metrics->m_LineCount = num_lines;
     }
 
+    void PrefetchGlyphs(HRenderContext render_context, HFontMap font_map, const char* text)
+    {
+        DM_PROFILE("PrefetchGlyphs");
+        TextContext& text_context = render_context->m_TextContext;
+
+        const char* cursor = text;
+        uint32_t c;
+        while ((c = dmUtf8::NextChar(&cursor)) != 0)
+        {
+            dmRender::FontGlyph* glyph = GetGlyph(font_map, c);
+            if (!glyph || glyph->m_Width == 0 || IsInCache(font_map, c))
+            {
+                continue;
+            }
+            int16_t px_cell_offset_y = font_map->m_CacheCellMaxAscent - (int16_t) glyph->m_Ascent;
+            AddGlyphToCache(font_map, text_context.m_Frame, c, glyph, px_cell_offset_y);
+        }
+    }
+
     uint32_t GetFontMapResourceSize(HFontMap font_map)
     {
         uint32_t size = sizeof(FontMap);
         // The cache size
         size += font_map->m_CacheCellCount*( (sizeof(CacheGlyph) * sizeof(uint32_t)) );
+        // The cpu copy of the cache texture
+        size += font_map->m_CacheWidth * font_map->m_CacheHeight * font_map->m_CacheChannels;
         // The texture size
         size += dmGraphics::GetTextureResourceSize(font_map->m_Texture);
         return size;
@@ -1373,6 +1853,11 @@ namespace dmRender
         return font_map->m_MagFilter == filter;
     }
 
+    bool IsGlyphInCache(dmRender::HFontMap font_map, uint32_t codepoint)
+    {
+        return IsInCache(font_map, codepoint);
+    }
+
     const uint8_t* GetGlyphData(dmRender::HFontMap font_map, uint32_t codepoint, uint32_t* out_size, uint32_t* out_compression, uint32_t* out_width, uint32_t* out_height)
     {
         return (uint8_t*)font_map->m_GetGlyphData(codepoint, font_map->m_UserData, out_size, out_compression, out_width, out_height);
@@ -34,6 +34,21 @@ namespace dmRender
     {
         FONT_GLYPH_COMPRESSION_NONE = 0,
         FONT_GLYPH_COMPRESSION_DEFLATE = 1,
+        FONT_GLYPH_COMPRESSION_DEFLATE_PAGE = 2, // The glyph image is stored in a page shared with the neighbouring glyphs, see FontGlyphPage
+    };
+
+    /*
+     * The glyph data (after the compression byte) of a FONT_GLYPH_COMPRESSION_DEFLATE_PAGE glyph.
+     * A page is the delta encoded images of a range of glyphs, deflated as a single stream. The font map
+     * keeps the last few inflated pages, so that the neighbouring glyphs of a page are read without
+     * inflating it again. The header is stored unaligned, in little endian.
+     */
+    struct FontGlyphPage
+    {
+        int32_t  m_PageOffset;      // The offset of the deflated page, from the start of this header
+        uint32_t m_PageSize;        // The deflated size of the page
+        uint32_t m_PageDataSize;    // The inflated size of the page
+        uint32_t m_GlyphOffset;     // The offset of the glyph image within the inflated page
     };
 
     typedef dmRenderDDF::GlyphBank::Glyph FontGlyph;
@@ -236,6 +251,23 @@ namespace dmRender
      */
     void GetTextMetrics(HFontMap font_map, const char* text, float width, bool line_break, float leading, float tracking, TextMetrics* metrics);
 
+    /**
+     * Adds the glyphs of a string to the glyph cache ahead of drawing it, e.g. while loading a screen,
+     * so that the glyphs don't have to be decompressed in the frame the text is first shown.
+     * @param render_context Context to use when rendering
+     * @param font_map Font map handle
+     * @param text utf8 text to prefetch the glyphs for
+     */
+    void PrefetchGlyphs(HRenderContext render_context, HFontMap font_map, const char* text);
+
+    /**
+     * Notifies the font map that a glyph was added, changed or removed by its owner (e.g. a dynamic font).
+     * Drops the cached text layouts, and the cached copy of the glyph, so that they're rebuilt on the next draw.
+     * @param font_map Font map handle
+     * @param codepoint the codepoint of the glyph that changed
+     */
+    void InvalidateFontMapGlyph(HFontMap font_map, uint32_t codepoint);
+
     /**
      * Get the resource size for fontmap
      * @param font_map Font map handle
@@ -165,9 +165,12 @@ namespace dmRender
     // Used in unit tests
     bool VerifyFontMapMinFilter(dmRender::HFontMap font_map, dmGraphics::TextureFilter filter);
     bool VerifyFontMapMagFilter(dmRender::HFontMap font_map, dmGraphics::TextureFilter filter);
+    bool IsGlyphInCache(dmRender::HFontMap font_map, uint32_t codepoint);
 
     dmRender::FontGlyph* GetGlyph(dmRender::HFontMap font_map, uint32_t codepoint);
     const uint8_t*       GetGlyphData(dmRender::HFontMap font_map, uint32_t codepoint, uint32_t* out_size, uint32_t* out_compression, uint32_t* out_width, uint32_t* out_height);
+    // Gets the uncompressed image of the glyph. It's valid until the next call, or until the glyph data changes
+    const uint8_t*       GetGlyphImage(dmRender::HFontMap font_map, const dmRender::FontGlyph* glyph, uint32_t* out_width, uint32_t* out_height);
 }
 
 #endif // #ifndef DM_FONT_RENDERER_PRIVATE
@@ -0,0 +1,310 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <dlib/array.h>
+#include <dlib/math.h>
+#include <dlib/profile.h>
+
+#include "render.h"
+
+// The lights are binned as spheres. The screen rectangle of a light is found by projecting the corners of its view space
+// bounding box, and the depth range from its view space distance. A light is added to every cluster in that box, which
+// is conservative but cheap, and keeps the light lists of the clusters sorted by light index.
+
+namespace dmRender
+{
+    // Lights that reach closer to the eye than this (in clip space w) cover the whole screen
+    static const float LIGHT_CLUSTER_MIN_W = 0.0001f;
+
+    struct LightClusterBounds
+    {
+        uint16_t m_MinX, m_MaxX;
+        uint16_t m_MinY, m_MaxY;
+        uint16_t m_MinSlice, m_MaxSlice;
+        uint16_t m_Visible;
+    };
+
+    struct LightClusters
+    {
+        dmArray<uint32_t>           m_Offsets;  // Per cluster, into m_Indices
+        dmArray<uint32_t>           m_Counts;   // Per cluster
+        dmArray<uint16_t>           m_Indices;
+        dmArray<LightClusterBounds> m_Bounds;   // Scratch space, per light
+        dmVMath::Vector4            m_Depth;
+        uint32_t                    m_TilesX;
+        uint32_t                    m_TilesY;
+        uint32_t                    m_Slices;
+        uint32_t                    m_MaxIndices;
+        uint32_t                    m_Overflow;
+    };
+
+    HLightClusters NewLightClusters(const LightClustersParams& params)
+    {
+        assert(params.m_TilesX > 0 && params.m_TilesY > 0 && params.m_Slices > 0);
+        LightClusters* clusters = new LightClusters;
+        clusters->m_TilesX = params.m_TilesX;
+        clusters->m_TilesY = params.m_TilesY;
+        clusters->m_Slices = params.m_Slices;
+        clusters->m_MaxIndices = params.m_MaxIndices;
+        clusters->m_Overflow = 0;
+        clusters->m_Depth = dmVMath::Vector4(0.0f);
+
+        uint32_t cluster_count = params.m_TilesX * params.m_TilesY * params.m_Slices;
+        clusters->m_Offsets.SetCapacity(cluster_count);
+        clusters->m_Offsets.SetSize(cluster_count);
+        clusters->m_Counts.SetCapacity(cluster_count);
+        clusters->m_Counts.SetSize(cluster_count);
+        memset(clusters->m_Offsets.Begin(), 0, cluster_count * sizeof(uint32_t));
+        memset(clusters->m_Counts.Begin(), 0, cluster_count * sizeof(uint32_t));
+        clusters->m_Indices.SetCapacity(params.m_MaxIndices);
+        return clusters;
+    }
+
+    void DeleteLightClusters(HLightClusters clusters)
+    {
+        delete clusters;
+    }
+
+    // Gets the slice mapping of the view space distance to the eye, slice = (log(distance) or distance) * x + y. Z is 1 for the logarithmic mapping.
+    static dmVMath::Vector4 GetDepthMapping(const dmVMath::Matrix4& projection, uint32_t slices)
+    {
+        float m22 = projection.getElem(2, 2);
+        float m32 = projection.getElem(3, 2);
+        bool perspective = projection.getElem(3, 3) == 0.0f;
+
+        float near, far;
+        if (perspective)
+        {
+            near = m32 / (m22 - 1.0f);
+            far  = m32 / (m22 + 1.0f);
+        }
+        else
+        {
+            near = (m32 + 1.0f) / m22;
+            far  = (m32 - 1.0f) / m22;
+        }
+
+        if (perspective && near > 0.0f && far > near && isfinite(far))
+        {
+            float scale = slices / logf(far / near);
+            return dmVMath::Vector4(scale, -logf(near) * scale, 1.0f, 0.0f);
+        }
+
+        if (!(far > near) || !isfinite(far - near))
+        {
+            // Degenerated projection, keep all lights in the first slice
+            return dmVMath::Vector4(0.0f, 0.0f, 0.0f, 0.0f);
+        }
+        float scale = slices / (far - near);
+        return dmVMath::Vector4(scale, -near * scale, 0.0f, 0.0f);
+    }
+
+    static uint32_t GetSlice(const dmVMath::Vector4& depth, uint32_t slices, float distance)
+    {
+        float value = distance;
+        if (depth.getZ() != 0.0f)
+        {
+            value = logf(dmMath::Max(distance, 0.000001f));
+        }
+        float slice = floorf(value * depth.getX() + depth.getY());
+        return (uint32_t) dmMath::Clamp(slice, 0.0f, (float) (slices - 1));
+    }
+
+    static uint16_t GetTile(float ndc, uint32_t tiles)
+    {
+        float tile = floorf((ndc * 0.5f + 0.5f) * tiles);
+        return (uint16_t) dmMath::Clamp(tile, 0.0f, (float) (tiles - 1));
+    }
+
+    static void GetLightBounds(HLightClusters clusters, const dmVMath::Matrix4& view, const dmVMath::Matrix4& projection, const dmVMath::Vector4& light, LightClusterBounds* bounds)
+    {
+        bounds->m_Visible = 0;
+
+        float range = light.getW();
+        dmVMath::Vector4 center = view * dmVMath::Point3(light.getXYZ());
+        float distance = -center.getZ();
+
+        // The near and far planes of the projection are used as the ends of the slices, the lights beyond them are still
+        // kept in the first and last slices, so that the frustum culling of the render list decides what is visible
+        bounds->m_MinSlice = (uint16_t) GetSlice(clusters->m_Depth, clusters->m_Slices, distance - range);
+        bounds->m_MaxSlice = (uint16_t) GetSlice(clusters->m_Depth, clusters->m_Slices, distance + range);
+        bool perspective = clusters->m_Depth.getZ() != 0.0f;
+        if (perspective && distance + range < 0.0f)
+        {
+            return; // Behind the eye
+        }
+
+        float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+        bool full_screen = false;
+        for (uint32_t i = 0; i < 8 && !full_screen; ++i)
+        {
+            dmVMath::Vector4 corner(center.getX() + ((i & 1) ? range : -range),
+                                    center.getY() + ((i & 2) ? range : -range),
+                                    center.getZ() + ((i & 4) ? range : -range), 1.0f);
+            dmVMath::Vector4 clip = projection * corner;
+            float w = clip.getW();
+            if (w < LIGHT_CLUSTER_MIN_W)
+            {
+                full_screen = true;
+                break;
+            }
+            float x = clip.getX() / w;
+            float y = clip.getY() / w;
+            min_x = dmMath::Min(min_x, x);
+            min_y = dmMath::Min(min_y, y);
+            max_x = dmMath::Max(max_x, x);
+            max_y = dmMath::Max(max_y, y);
+        }
+
+        if (full_screen)
+        {
+            min_x = min_y = -1.0f;
+            max_x = max_y = 1.0f;
+        }
+        else if (max_x < -1.0f || min_x > 1.0f || max_y < -1.0f || min_y > 1.0f)
+        {
+            return; // Outside of the screen
+        }
+
+        bounds->m_MinX = GetTile(min_x, clusters->m_TilesX);
+        bounds->m_MaxX = GetTile(max_x, clusters->m_TilesX);
+        bounds->m_MinY = GetTile(min_y, clusters->m_TilesY);
+        bounds->m_MaxY = GetTile(max_y, clusters->m_TilesY);
+        bounds->m_Visible = 1;
+    }
+
+    void BuildLightClusters(HLightClusters clusters, const dmVMath::Matrix4& view, const dmVMath::Matrix4& projection, const dmVMath::Vector4* lights, uint32_t light_count)
+    {
+        DM_PROFILE("BuildLightClusters");
+        assert(light_count <= 0x10000);
+
+        const uint32_t tiles_x = clusters->m_TilesX;
+        const uint32_t tiles_xy = tiles_x * clusters->m_TilesY;
+        const uint32_t cluster_count = clusters->m_Counts.Size();
+        uint32_t* offsets = clusters->m_Offsets.Begin();
+        uint32_t* counts = clusters->m_Counts.Begin();
+
+        clusters->m_Depth = GetDepthMapping(projection, clusters->m_Slices);
+        clusters->m_Overflow = 0;
+        memset(counts, 0, cluster_count * sizeof(uint32_t));
+
+        dmArray<LightClusterBounds>& bounds = clusters->m_Bounds;
+        if (bounds.Capacity() < light_count)
+        {
+            bounds.SetCapacity(light_count);
+        }
+        bounds.SetSize(light_count);
+
+        // Count the lights of each cluster
+        for (uint32_t i = 0; i < light_count; ++i)
+        {
+            LightClusterBounds& b = bounds[i];
+            GetLightBounds(clusters, view, projection, lights[i], &b);
+            if (!b.m_Visible)
+                continue;
+
+            for (uint32_t z = b.m_MinSlice; z <= b.m_MaxSlice; ++z)
+                for (uint32_t y = b.m_MinY; y <= b.m_MaxY; ++y)
+                    for (uint32_t x = b.m_MinX; x <= b.m_MaxX; ++x)
+                        ++counts[x + y * tiles_x + z * tiles_xy];
+        }
+
+        // Allocate the ranges. Clusters that don't fit keep the lights with the lowest indices
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < cluster_count; ++i)
+        {
+            uint32_t count = dmMath::Min(counts[i], clusters->m_MaxIndices - offset);
+            clusters->m_Overflow += counts[i] - count;
+            offsets[i] = offset;
+            counts[i] = count;
+            offset += count;
+        }
+
+        dmArray<uint16_t>& indices = clusters->m_Indices;
+        indices.SetSize(offset);
+
+        // Fill the ranges, using the counts as the write cursors
+        memset(counts, 0, cluster_count * sizeof(uint32_t));
+        for (uint32_t i = 0; i < light_count; ++i)
+        {
+            const LightClusterBounds& b = bounds[i];
+            if (!b.m_Visible)
+                continue;
+
+            for (uint32_t z = b.m_MinSlice; z <= b.m_MaxSlice; ++z)
+            {
+                for (uint32_t y = b.m_MinY; y <= b.m_MaxY; ++y)
+                {
+                    for (uint32_t x = b.m_MinX; x <= b.m_MaxX; ++x)
+                    {
+                        uint32_t cluster = x + y * tiles_x + z * tiles_xy;
+                        uint32_t next = cluster + 1 < cluster_count ? offsets[cluster + 1] : offset;
+                        if (offsets[cluster] + counts[cluster] < next)
+                        {
+                            indices[offsets[cluster] + counts[cluster]++] = (uint16_t) i;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    uint32_t GetClusterLights(HLightClusters clusters, uint32_t x, uint32_t y, uint32_t slice, const uint16_t** indices)
+    {
+        assert(x < clusters->m_TilesX && y < clusters->m_TilesY && slice < clusters->m_Slices);
+        uint32_t cluster = x + (y + slice * clusters->m_TilesY) * clusters->m_TilesX;
+        *indices = clusters->m_Indices.Begin() + clusters->m_Offsets[cluster];
+        return clusters->m_Counts[cluster];
+    }
+
+    uint32_t GetLightClusterOverflow(HLightClusters clusters)
+    {
+        return clusters->m_Overflow;
+    }
+
+    uint32_t GetLightClusterSlice(HLightClusters clusters, float distance)
+    {
+        return GetSlice(clusters->m_Depth, clusters->m_Slices, distance);
+    }
+
+    void GetLightClusterData(HLightClusters clusters, dmVMath::Vector4* depth, dmVMath::Vector4* ranges, uint32_t max_ranges, dmVMath::Vector4* indices, uint32_t max_indices)
+    {
+        *depth = clusters->m_Depth;
+
+        // Two clusters per vector: offset, count, offset, count
+        uint32_t cluster_count = clusters->m_Counts.Size();
+        float* range_values = (float*) ranges;
+        uint32_t max_range_values = dmMath::Min(max_ranges * 4, cluster_count * 2);
+        for (uint32_t i = 0; i < max_range_values / 2; ++i)
+        {
+            range_values[i * 2 + 0] = (float) clusters->m_Offsets[i];
+            range_values[i * 2 + 1] = (float) clusters->m_Counts[i];
+        }
+        memset(range_values + max_range_values, 0, (max_ranges * 4 - max_range_values) * sizeof(float));
+
+        // Four light indices per vector
+        float* index_values = (float*) indices;
+        uint32_t index_count = dmMath::Min(max_indices * 4, clusters->m_Indices.Size());
+        for (uint32_t i = 0; i < index_count; ++i)
+        {
+            index_values[i] = (float) clusters->m_Indices[i];
+        }
+        memset(index_values + index_count, 0, (max_indices * 4 - index_count) * sizeof(float));
+    }
+}
@@ -310,6 +310,7 @@ namespace dmRender
         dmGraphics::HContext graphics_context    = dmRender::GetGraphicsContext(render_context);
         const dmArray<RenderConstant>& constants = material->m_Constants;
         dmGraphics::HProgram program             = material->m_Program;
+        dmGraphics::ShaderDesc::Language language = dmGraphics::GetProgramLanguage(program);
 
         uint32_t n = constants.Size();
         for (uint32_t i = 0; i < n; ++i)
@@ -318,7 +319,6 @@ namespace dmRender
             const HConstant constant                     = material_constant.m_Constant;
             dmGraphics::HUniformLocation location        = GetConstantLocation(constant);
             dmRenderDDF::MaterialDesc::ConstantType type = GetConstantType(constant);
-            dmGraphics::ShaderDesc::Language language    = dmGraphics::GetProgramLanguage(dmRender::GetMaterialProgram(material));
             SetProgramConstant(render_context, graphics_context, ro->m_WorldTransform, ro->m_TextureTransform, language, type, program, location, constant);
         }
     }
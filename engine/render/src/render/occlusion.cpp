@@ -0,0 +1,264 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <assert.h>
+#include <string.h>
+
+#include <dlib/array.h>
+#include <dlib/math.h>
+#include <dlib/profile.h>
+
+#include "render.h"
+
+// A small software rasterized depth buffer. The occluders are drawn as solid boxes, and the occludees are tested
+// conservatively with the screen rectangle and nearest depth of their projected bounds. Each tile also keeps the
+// furthest depth of its pixels, so that most tests never have to look at the individual pixels.
+
+namespace dmRender
+{
+    static const uint32_t OCCLUSION_TILE_SIZE = 8;
+    // Vertices closer to the eye than this (in clip space w) aren't projected
+    static const float    OCCLUSION_MIN_W = 0.0001f;
+    static const float    OCCLUSION_FAR_DEPTH = 1.0f;
+
+    struct OcclusionBuffer
+    {
+        dmArray<float>  m_Depth;        // Normalized device depth, per pixel
+        dmArray<float>  m_TileMaxDepth; // The furthest depth of each tile
+        uint32_t        m_Width;
+        uint32_t        m_Height;
+        uint32_t        m_TilesX;
+        uint32_t        m_TilesY;
+        dmVMath::Matrix4 m_ViewProj;
+    };
+
+    struct OcclusionVertex
+    {
+        float m_X; // Pixels
+        float m_Y;
+        float m_Z; // Normalized device depth
+    };
+
+    static const uint8_t BOX_TRIANGLES[12][3] = {
+        {0, 1, 3}, {0, 3, 2}, // -x
+        {4, 6, 7}, {4, 7, 5}, // +x
+        {0, 4, 5}, {0, 5, 1}, // -y
+        {2, 3, 7}, {2, 7, 6}, // +y
+        {0, 2, 6}, {0, 6, 4}, // -z
+        {1, 5, 7}, {1, 7, 3}, // +z
+    };
+
+    HOcclusionBuffer NewOcclusionBuffer(uint32_t width, uint32_t height)
+    {
+        assert(width > 0 && height > 0);
+        OcclusionBuffer* buffer = new OcclusionBuffer;
+        buffer->m_Width = width;
+        buffer->m_Height = height;
+        buffer->m_TilesX = (width + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE;
+        buffer->m_TilesY = (height + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE;
+        buffer->m_Depth.SetCapacity(width * height);
+        buffer->m_Depth.SetSize(width * height);
+        buffer->m_TileMaxDepth.SetCapacity(buffer->m_TilesX * buffer->m_TilesY);
+        buffer->m_TileMaxDepth.SetSize(buffer->m_TilesX * buffer->m_TilesY);
+        buffer->m_ViewProj = dmVMath::Matrix4::identity();
+        ClearOcclusionBuffer(buffer, buffer->m_ViewProj);
+        return buffer;
+    }
+
+    void DeleteOcclusionBuffer(HOcclusionBuffer buffer)
+    {
+        delete buffer;
+    }
+
+    void ClearOcclusionBuffer(HOcclusionBuffer buffer, const dmVMath::Matrix4& view_proj)
+    {
+        buffer->m_ViewProj = view_proj;
+        float* depth = buffer->m_Depth.Begin();
+        for (uint32_t i = 0; i < buffer->m_Depth.Size(); ++i)
+            depth[i] = OCCLUSION_FAR_DEPTH;
+        float* tiles = buffer->m_TileMaxDepth.Begin();
+        for (uint32_t i = 0; i < buffer->m_TileMaxDepth.Size(); ++i)
+            tiles[i] = OCCLUSION_FAR_DEPTH;
+    }
+
+    // Clamps before converting, since the projected coordinates can be far outside of the buffer
+    static inline int32_t ToPixel(float v, uint32_t size)
+    {
+        return (int32_t)dmMath::Clamp(v, 0.0f, (float)(size - 1));
+    }
+
+    static inline float EdgeFunction(const OcclusionVertex& a, const OcclusionVertex& b, float x, float y)
+    {
+        return (b.m_X - a.m_X) * (y - a.m_Y) - (b.m_Y - a.m_Y) * (x - a.m_X);
+    }
+
+    static void RasterizeTriangle(OcclusionBuffer* buffer, const OcclusionVertex& v0, const OcclusionVertex& v1, const OcclusionVertex& v2)
+    {
+        float area = EdgeFunction(v0, v1, v2.m_X, v2.m_Y);
+        if (area == 0.0f)
+            return;
+        // Both windings are drawn, so the boxes don't need a consistent winding order
+        float inv_area = 1.0f / area;
+
+        int32_t min_x = ToPixel(dmMath::Min(v0.m_X, dmMath::Min(v1.m_X, v2.m_X)), buffer->m_Width);
+        int32_t min_y = ToPixel(dmMath::Min(v0.m_Y, dmMath::Min(v1.m_Y, v2.m_Y)), buffer->m_Height);
+        int32_t max_x = ToPixel(dmMath::Max(v0.m_X, dmMath::Max(v1.m_X, v2.m_X)), buffer->m_Width);
+        int32_t max_y = ToPixel(dmMath::Max(v0.m_Y, dmMath::Max(v1.m_Y, v2.m_Y)), buffer->m_Height);
+
+        float* depth = buffer->m_Depth.Begin();
+        for (int32_t y = min_y; y <= max_y; ++y)
+        {
+            float py = y + 0.5f;
+            float* row = depth + y * buffer->m_Width;
+            for (int32_t x = min_x; x <= max_x; ++x)
+            {
+                float px = x + 0.5f;
+                float w0 = EdgeFunction(v1, v2, px, py) * inv_area;
+                float w1 = EdgeFunction(v2, v0, px, py) * inv_area;
+                float w2 = EdgeFunction(v0, v1, px, py) * inv_area;
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                    continue;
+                // The projected depth is linear in screen space
+                float z = w0 * v0.m_Z + w1 * v1.m_Z + w2 * v2.m_Z;
+                if (z < row[x])
+                    row[x] = z;
+            }
+        }
+    }
+
+    // Returns false if the corner is behind the eye
+    static inline bool ProjectCorner(const OcclusionBuffer* buffer, const dmVMath::Matrix4& mvp, float x, float y, float z, OcclusionVertex& out)
+    {
+        dmVMath::Vector4 p = mvp * dmVMath::Point3(x, y, z);
+        float w = p.getW();
+        if (w < OCCLUSION_MIN_W)
+            return false;
+        float inv_w = 1.0f / w;
+        out.m_X = (p.getX() * inv_w * 0.5f + 0.5f) * buffer->m_Width;
+        out.m_Y = (p.getY() * inv_w * 0.5f + 0.5f) * buffer->m_Height;
+        out.m_Z = p.getZ() * inv_w;
+        return true;
+    }
+
+    // Returns a bit mask of the corners that could be projected
+    static uint32_t ProjectBox(const OcclusionBuffer* buffer, const dmVMath::Matrix4& world, const dmVMath::Vector3& aabb_min, const dmVMath::Vector3& aabb_max, OcclusionVertex corners[8])
+    {
+        dmVMath::Matrix4 mvp = buffer->m_ViewProj * world;
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            float x = (i & 4) ? aabb_max.getX() : aabb_min.getX();
+            float y = (i & 2) ? aabb_max.getY() : aabb_min.getY();
+            float z = (i & 1) ? aabb_max.getZ() : aabb_min.getZ();
+            if (ProjectCorner(buffer, mvp, x, y, z, corners[i]))
+                mask |= 1 << i;
+        }
+        return mask;
+    }
+
+    void RasterizeOccluder(HOcclusionBuffer buffer, const dmVMath::Matrix4& world, const dmVMath::Vector3& aabb_min, const dmVMath::Vector3& aabb_max)
+    {
+        OcclusionVertex corners[8];
+        uint32_t mask = ProjectBox(buffer, world, aabb_min, aabb_max, corners);
+        if (mask == 0)
+            return;
+
+        // Triangles crossing the near plane are skipped rather than clipped. It only makes the occluder smaller.
+        for (uint32_t i = 0; i < 12; ++i)
+        {
+            const uint8_t* t = BOX_TRIANGLES[i];
+            uint32_t triangle_mask = (1 << t[0]) | (1 << t[1]) | (1 << t[2]);
+            if ((mask & triangle_mask) != triangle_mask)
+                continue;
+            RasterizeTriangle(buffer, corners[t[0]], corners[t[1]], corners[t[2]]);
+        }
+    }
+
+    void FinalizeOcclusionBuffer(HOcclusionBuffer buffer)
+    {
+        DM_PROFILE("FinalizeOcclusionBuffer");
+        const float* depth = buffer->m_Depth.Begin();
+        float* tiles = buffer->m_TileMaxDepth.Begin();
+        for (uint32_t ty = 0; ty < buffer->m_TilesY; ++ty)
+        {
+            uint32_t y_end = dmMath::Min((ty + 1) * OCCLUSION_TILE_SIZE, buffer->m_Height);
+            for (uint32_t tx = 0; tx < buffer->m_TilesX; ++tx)
+            {
+                uint32_t x_end = dmMath::Min((tx + 1) * OCCLUSION_TILE_SIZE, buffer->m_Width);
+                float max_depth = 0.0f;
+                for (uint32_t y = ty * OCCLUSION_TILE_SIZE; y < y_end; ++y)
+                {
+                    const float* row = depth + y * buffer->m_Width;
+                    for (uint32_t x = tx * OCCLUSION_TILE_SIZE; x < x_end; ++x)
+                        max_depth = dmMath::Max(max_depth, row[x]);
+                }
+                tiles[ty * buffer->m_TilesX + tx] = max_depth;
+            }
+        }
+    }
+
+    bool IsOccluded(HOcclusionBuffer buffer, const dmVMath::Matrix4& world, const dmVMath::Vector3& aabb_min, const dmVMath::Vector3& aabb_max)
+    {
+        OcclusionVertex corners[8];
+        if (ProjectBox(buffer, world, aabb_min, aabb_max, corners) != 0xFF)
+            return false; // Intersects the near plane
+
+        float min_x = corners[0].m_X, max_x = corners[0].m_X;
+        float min_y = corners[0].m_Y, max_y = corners[0].m_Y;
+        float min_z = corners[0].m_Z;
+        for (uint32_t i = 1; i < 8; ++i)
+        {
+            min_x = dmMath::Min(min_x, corners[i].m_X);
+            max_x = dmMath::Max(max_x, corners[i].m_X);
+            min_y = dmMath::Min(min_y, corners[i].m_Y);
+            max_y = dmMath::Max(max_y, corners[i].m_Y);
+            min_z = dmMath::Min(min_z, corners[i].m_Z);
+        }
+
+        // Outside of the screen, it's up to the frustum culling
+        if (max_x < 0.0f || max_y < 0.0f || min_x >= buffer->m_Width || min_y >= buffer->m_Height)
+            return false;
+
+        int32_t x0 = ToPixel(min_x, buffer->m_Width);
+        int32_t y0 = ToPixel(min_y, buffer->m_Height);
+        int32_t x1 = ToPixel(max_x, buffer->m_Width);
+        int32_t y1 = ToPixel(max_y, buffer->m_Height);
+
+        const float* depth = buffer->m_Depth.Begin();
+        const float* tiles = buffer->m_TileMaxDepth.Begin();
+        for (int32_t ty = y0 / OCCLUSION_TILE_SIZE; ty <= y1 / (int32_t)OCCLUSION_TILE_SIZE; ++ty)
+        {
+            for (int32_t tx = x0 / OCCLUSION_TILE_SIZE; tx <= x1 / (int32_t)OCCLUSION_TILE_SIZE; ++tx)
+            {
+                if (tiles[ty * buffer->m_TilesX + tx] < min_z)
+                    continue; // The whole tile is in front
+
+                int32_t py0 = dmMath::Max(y0, ty * (int32_t)OCCLUSION_TILE_SIZE);
+                int32_t py1 = dmMath::Min(y1, (ty + 1) * (int32_t)OCCLUSION_TILE_SIZE - 1);
+                int32_t px0 = dmMath::Max(x0, tx * (int32_t)OCCLUSION_TILE_SIZE);
+                int32_t px1 = dmMath::Min(x1, (tx + 1) * (int32_t)OCCLUSION_TILE_SIZE - 1);
+                for (int32_t y = py0; y <= py1; ++y)
+                {
+                    const float* row = depth + y * buffer->m_Width;
+                    for (int32_t x = px0; x <= px1; ++x)
+                    {
+                        if (row[x] >= min_z)
+                            return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+}
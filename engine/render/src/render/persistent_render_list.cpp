@@ -0,0 +1,213 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <assert.h>
+#include <string.h>
+
+#include <dlib/array.h>
+#include <dlib/math.h>
+#include <dlib/profile.h>
+
+#include "render_private.h"
+
+namespace dmRender
+{
+    // Values of PersistentRenderList::m_SortedIndex for handles that aren't in the sorted copy
+    static const uint32_t PERSISTENT_ENTRY_FREE     = 0xffffffff;
+    static const uint32_t PERSISTENT_ENTRY_UNSORTED = 0xfffffffe;
+
+    struct PersistentRenderList
+    {
+        dmArray<RenderListEntry>    m_Entries;      // Indexed by handle
+        dmArray<uint32_t>           m_SortedIndex;  // Index into m_Sorted, indexed by handle
+        dmArray<uint32_t>           m_FreeHandles;
+        dmArray<RenderListEntry>    m_Sorted;       // The used entries, sorted on the tag list key. Copied to the render list as is
+        dmArray<RadixSortItem>      m_SortItems;
+        uint32_t                    m_Count;
+        HRenderListDispatch         m_Dispatch;     // The dispatch currently stored in m_Sorted
+        uint8_t                     m_Dirty : 1;    // The sorted copy needs to be rebuilt
+    };
+
+    HPersistentRenderList NewPersistentRenderList()
+    {
+        PersistentRenderList* list = new PersistentRenderList;
+        list->m_Count = 0;
+        list->m_Dispatch = RENDERLIST_INVALID_DISPATCH;
+        list->m_Dirty = 0;
+        return list;
+    }
+
+    void DeletePersistentRenderList(HPersistentRenderList list)
+    {
+        delete list;
+    }
+
+    uint32_t AddPersistentRenderListEntry(HPersistentRenderList list, const RenderListEntry& entry)
+    {
+        uint32_t handle;
+        if (!list->m_FreeHandles.Empty())
+        {
+            handle = list->m_FreeHandles.Back();
+            list->m_FreeHandles.Pop();
+        }
+        else
+        {
+            if (list->m_Entries.Full())
+            {
+                uint32_t capacity = dmMath::Max(16U, list->m_Entries.Capacity() * 2);
+                list->m_Entries.SetCapacity(capacity);
+                list->m_SortedIndex.SetCapacity(capacity);
+            }
+            handle = list->m_Entries.Size();
+            list->m_Entries.SetSize(handle + 1);
+            list->m_SortedIndex.SetSize(handle + 1);
+        }
+
+        list->m_Entries[handle] = entry;
+        list->m_SortedIndex[handle] = PERSISTENT_ENTRY_UNSORTED;
+        list->m_Count++;
+        list->m_Dirty = 1;
+        return handle;
+    }
+
+    void RemovePersistentRenderListEntry(HPersistentRenderList list, uint32_t handle)
+    {
+        assert(handle < list->m_Entries.Size() && list->m_SortedIndex[handle] != PERSISTENT_ENTRY_FREE);
+        list->m_SortedIndex[handle] = PERSISTENT_ENTRY_FREE;
+        if (list->m_FreeHandles.Full())
+            list->m_FreeHandles.OffsetCapacity(dmMath::Max(16U, list->m_FreeHandles.Capacity()));
+        list->m_FreeHandles.Push(handle);
+        list->m_Count--;
+        list->m_Dirty = 1;
+    }
+
+    static bool IsEntryEqual(const RenderListEntry& a, const RenderListEntry& b)
+    {
+        // Not using memcmp, since the bit fields leave padding bits
+        return a.m_WorldPosition.getX() == b.m_WorldPosition.getX()
+            && a.m_WorldPosition.getY() == b.m_WorldPosition.getY()
+            && a.m_WorldPosition.getZ() == b.m_WorldPosition.getZ()
+            && a.m_UserData == b.m_UserData
+            && a.m_Order == b.m_Order
+            && a.m_BatchKey == b.m_BatchKey
+            && a.m_TagListKey == b.m_TagListKey
+            && a.m_MinorOrder == b.m_MinorOrder
+            && a.m_MajorOrder == b.m_MajorOrder;
+    }
+
+    bool UpdatePersistentRenderListEntry(HPersistentRenderList list, uint32_t handle, const RenderListEntry& entry)
+    {
+        assert(handle < list->m_Entries.Size() && list->m_SortedIndex[handle] != PERSISTENT_ENTRY_FREE);
+        RenderListEntry& current = list->m_Entries[handle];
+        if (IsEntryEqual(current, entry))
+            return false;
+
+        // Only a new tag list key changes the order of the sorted copy, anything else is patched in place
+        bool resort = current.m_TagListKey != entry.m_TagListKey;
+        current = entry;
+
+        uint32_t sorted_index = list->m_SortedIndex[handle];
+        if (resort || sorted_index == PERSISTENT_ENTRY_UNSORTED)
+        {
+            list->m_Dirty = 1;
+        }
+        else if (!list->m_Dirty)
+        {
+            RenderListEntry& sorted = list->m_Sorted[sorted_index];
+            sorted = entry;
+            sorted.m_Dispatch = list->m_Dispatch;
+        }
+        return true;
+    }
+
+    uint32_t GetPersistentRenderListEntryCount(HPersistentRenderList list)
+    {
+        return list->m_Count;
+    }
+
+    static void SortPersistentRenderList(HPersistentRenderList list)
+    {
+        DM_PROFILE("SortPersistentRenderList");
+
+        uint32_t count = list->m_Count;
+        if (list->m_SortItems.Capacity() < count * 2)
+            list->m_SortItems.SetCapacity(count * 2);
+        list->m_SortItems.SetSize(count * 2);
+
+        RadixSortItem* items = list->m_SortItems.Begin();
+        uint32_t num_items = 0;
+        uint32_t num_handles = list->m_Entries.Size();
+        for (uint32_t handle = 0; handle < num_handles; ++handle)
+        {
+            if (list->m_SortedIndex[handle] == PERSISTENT_ENTRY_FREE)
+                continue;
+            items[num_items].m_Key = list->m_Entries[handle].m_TagListKey;
+            items[num_items].m_Index = handle;
+            ++num_items;
+        }
+        assert(num_items == count);
+
+        const RadixSortItem* sorted = RadixSort(0, items, items + count, count);
+
+        if (list->m_Sorted.Capacity() < count)
+            list->m_Sorted.SetCapacity(list->m_Entries.Capacity());
+        list->m_Sorted.SetSize(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t handle = sorted[i].m_Index;
+            RenderListEntry& entry = list->m_Sorted[i];
+            entry = list->m_Entries[handle];
+            entry.m_Dispatch = list->m_Dispatch;
+            list->m_SortedIndex[handle] = i;
+        }
+        list->m_Dirty = 0;
+    }
+
+    void RenderListSubmitPersistent(HRenderContext render_context, HRenderListDispatch dispatch, HPersistentRenderList list)
+    {
+        DM_PROFILE("RenderListSubmitPersistent");
+
+        if (dispatch == RENDERLIST_INVALID_DISPATCH)
+            return;
+
+        if (list->m_Dispatch != dispatch)
+        {
+            list->m_Dispatch = dispatch;
+            for (uint32_t i = 0; i < list->m_Sorted.Size(); ++i)
+                list->m_Sorted[i].m_Dispatch = dispatch;
+        }
+
+        if (list->m_Dirty)
+            SortPersistentRenderList(list);
+
+        uint32_t count = list->m_Sorted.Size();
+        if (count == 0)
+            return;
+
+        RenderListEntry* entries = RenderListAlloc(render_context, count);
+        memcpy(entries, list->m_Sorted.Begin(), count * sizeof(RenderListEntry));
+
+        // The entries are already sorted on the tag list key, and are merged with the rest of the render list
+        // instead of being sorted again (see SortRenderList)
+        RenderListSortedRun run;
+        run.m_Start = render_context->m_RenderListSortIndices.Size();
+        run.m_Count = count;
+        RenderListSubmit(render_context, entries, entries + count);
+
+        dmArray<RenderListSortedRun>& runs = render_context->m_RenderListSortedRuns;
+        if (runs.Full())
+            runs.OffsetCapacity(dmMath::Max(8U, runs.Capacity()));
+        runs.Push(run);
+    }
+}
@@ -15,12 +15,14 @@
 #include <assert.h>
 #include <string.h>
 #include <float.h>
+#include <math.h>
 #include <algorithm>
 
 #include <dlib/hash.h>
 #include <dlib/hashtable.h>
 #include <dlib/profile.h>
 #include <dlib/math.h>
+#include <dlib/memory.h>
 #include <dmsdk/dlib/vmath.h>
 #include <dmsdk/dlib/intersection.h>
 
@@ -73,6 +75,17 @@ namespace dmRender
         m_TextureTransform = Matrix4::identity();
     }
 
+    LightParams::LightParams()
+    : m_Position(0.0f)
+    , m_Direction(0.0f, 0.0f, -1.0f)
+    , m_Color(1.0f)
+    , m_Intensity(1.0f)
+    , m_Range(1.0f)
+    , m_ConeAngle(0.0f)
+    , m_Type(LIGHT_TYPE_POINT)
+    {
+    }
+
     RenderContextParams::RenderContextParams()
     : m_ScriptContext(0x0)
     , m_SystemFontMap(0)
@@ -86,6 +99,7 @@ namespace dmRender
     , m_MaxCharacters(0)
     , m_CommandBufferSize(1024)
     , m_MaxDebugVertexCount(0)
+    , m_JobThread(0)
     {
 
     }
@@ -105,10 +119,36 @@ namespace dmRender
         context->m_RenderObjects.SetSize(0);
 
         context->m_GraphicsContext = graphics_context;
+        context->m_JobThread = params.m_JobThread;
+        context->m_CullFrustum = 0;
+        context->m_Occluders.SetCapacity(64);
+        dmGraphics::GetStats(graphics_context, &context->m_FrameStatsStart);
+        memset(&context->m_LastFrameStats, 0, sizeof(context->m_LastFrameStats));
+        context->m_DynamicResolution.m_FrameGpuTime = 0;
+        context->m_DynamicResolution.m_GpuTime = 0.0f;
+        context->m_DynamicResolution.m_Scale = 1.0f;
+        context->m_DynamicResolution.m_FrameCount = 0;
+        context->m_DynamicResolution.m_Enabled = 0;
+        context->m_OcclusionBuffer = NewOcclusionBuffer(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+
+        LightClustersParams light_clusters_params;
+        light_clusters_params.m_TilesX = LIGHT_CLUSTER_TILES_X;
+        light_clusters_params.m_TilesY = LIGHT_CLUSTER_TILES_Y;
+        light_clusters_params.m_Slices = LIGHT_CLUSTER_SLICES;
+        light_clusters_params.m_MaxIndices = LIGHT_CLUSTER_MAX_INDICES;
+        context->m_LightClusters = NewLightClusters(light_clusters_params);
+        context->m_LightConstants = NewNamedConstantBuffer();
+        context->m_LightClustersKey = 0;
+        context->m_Lights.SetCapacity(LIGHT_CLUSTER_MAX_LIGHTS);
+        context->m_LightSpheres.SetCapacity(LIGHT_CLUSTER_MAX_LIGHTS);
 
         context->m_SystemFontMap = params.m_SystemFontMap;
 
         context->m_Material = 0;
+        context->m_ComputeProgram = 0;
+        context->m_IndirectDrawBuffer = 0;
+        context->m_IndirectDrawOffset = 0;
+        context->m_IndirectDrawCount = 0;
         context->m_CurrentRenderCamera = 0;
 
         context->m_View = Matrix4::identity();
@@ -134,6 +174,8 @@ namespace dmRender
 
         context->m_MultiBufferingRequired = 0;
 
+        context->m_RenderInvalidated = 1;
+
         dmGraphics::AdapterFamily installed_adapter_family = dmGraphics::GetInstalledAdapterFamily();
         if (installed_adapter_family == dmGraphics::ADAPTER_FAMILY_VULKAN ||
             installed_adapter_family == dmGraphics::ADAPTER_FAMILY_VENDOR)
@@ -158,6 +200,9 @@ namespace dmRender
         FinalizeDebugRenderer(render_context);
         FinalizeTextContext(render_context);
         dmMessage::DeleteSocket(render_context->m_Socket);
+        DeleteOcclusionBuffer(render_context->m_OcclusionBuffer);
+        DeleteLightClusters(render_context->m_LightClusters);
+        DeleteNamedConstantBuffer(render_context->m_LightConstants);
         delete render_context;
 
         return RESULT_OK;
@@ -174,7 +219,237 @@ namespace dmRender
         render_context->m_RenderListSortIndices.SetSize(0);
         render_context->m_RenderListDispatch.SetSize(0);
         render_context->m_RenderListRanges.SetSize(0);
+        render_context->m_RenderListSortedRuns.SetSize(0);
+        render_context->m_RenderListSortCache.SetSize(0);
+        render_context->m_RenderListSortCacheIndices.SetSize(0);
+        render_context->m_Occluders.SetSize(0);
+        render_context->m_Lights.SetSize(0);
+        render_context->m_LightClustersKey = 0;
         render_context->m_FrustumHash = 0xFFFFFFFF; // trigger a first recalculation each frame
+        render_context->m_DebugRenderer.m_FlushedVertexCount = 0; // the debug batch is submitted again on the next flush
+
+        // The stats of the frame that just ended are kept for render.get_stats()
+        dmGraphics::Stats stats;
+        dmGraphics::GetStats(render_context->m_GraphicsContext, &stats);
+        dmGraphics::SubtractStats(stats, render_context->m_FrameStatsStart, &render_context->m_LastFrameStats);
+        render_context->m_FrameStatsStart = stats;
+        dmArray<PredicateStats>& last = render_context->m_LastPredicateStats;
+        dmArray<PredicateStats>& current = render_context->m_PredicateStats;
+        if (last.Capacity() < current.Size())
+            last.SetCapacity(current.Capacity());
+        last.SetSize(current.Size());
+        if (!current.Empty())
+            memcpy(last.Begin(), current.Begin(), current.Size() * sizeof(PredicateStats));
+        current.SetSize(0);
+
+        UpdateDynamicResolution(render_context);
+    }
+
+    // The number of frames to average the GPU time over before the scale is changed
+    static const uint32_t DYNAMIC_RESOLUTION_FRAME_COUNT = 15;
+    // The scale is raised when the GPU time is below this fraction of the target
+    static const float    DYNAMIC_RESOLUTION_HEADROOM = 0.85f;
+    static const float    DYNAMIC_RESOLUTION_MAX_STEP = 0.1f;
+
+    DynamicResolutionParams::DynamicResolutionParams()
+    : m_MinScale(0.5f)
+    , m_MaxScale(1.0f)
+    , m_TargetGpuTime(14.0f)
+    {
+    }
+
+    void EnableDynamicResolution(HRenderContext render_context, const DynamicResolutionParams& params)
+    {
+        DynamicResolution& dr = render_context->m_DynamicResolution;
+        dr.m_Params = params;
+        dr.m_Params.m_MinScale = dmMath::Clamp(params.m_MinScale, 0.1f, 1.0f);
+        dr.m_Params.m_MaxScale = dmMath::Clamp(params.m_MaxScale, dr.m_Params.m_MinScale, 1.0f);
+        dr.m_Scale = dr.m_Params.m_MaxScale;
+        dr.m_FrameGpuTime = 0;
+        dr.m_GpuTime = 0.0f;
+        dr.m_FrameCount = 0;
+        dr.m_Enabled = 1;
+    }
+
+    void DisableDynamicResolution(HRenderContext render_context)
+    {
+        render_context->m_DynamicResolution.m_Enabled = 0;
+        render_context->m_DynamicResolution.m_Scale = 1.0f;
+    }
+
+    bool IsDynamicResolutionEnabled(HRenderContext render_context)
+    {
+        return render_context->m_DynamicResolution.m_Enabled;
+    }
+
+    float GetResolutionScale(HRenderContext render_context)
+    {
+        return render_context->m_DynamicResolution.m_Scale;
+    }
+
+    void AddDynamicResolutionGpuTime(HRenderContext render_context, uint64_t elapsed_ns)
+    {
+        render_context->m_DynamicResolution.m_FrameGpuTime += elapsed_ns;
+    }
+
+    void UpdateDynamicResolution(HRenderContext render_context)
+    {
+        DynamicResolution& dr = render_context->m_DynamicResolution;
+        if (!dr.m_Enabled || dr.m_FrameGpuTime == 0)
+            return;
+
+        // The timers of about one frame finish each frame, so the sum since the last update is used as the frame time
+        float frame_gpu_time = (float)(dr.m_FrameGpuTime / 1000000.0);
+        dr.m_FrameGpuTime = 0;
+        dr.m_GpuTime += (frame_gpu_time - dr.m_GpuTime) / (float)(dr.m_FrameCount + 1);
+        if (++dr.m_FrameCount < DYNAMIC_RESOLUTION_FRAME_COUNT)
+            return;
+
+        // The GPU time is roughly proportional to the number of pixels, i.e. the square of the scale
+        float target = dr.m_Params.m_TargetGpuTime;
+        float scale = dr.m_Scale;
+        if (dr.m_GpuTime > target)
+        {
+            scale = dmMath::Max(scale * sqrtf(target / dr.m_GpuTime), scale - DYNAMIC_RESOLUTION_MAX_STEP);
+        }
+        else if (dr.m_GpuTime < target * DYNAMIC_RESOLUTION_HEADROOM)
+        {
+            scale = dmMath::Min(scale * sqrtf(target * DYNAMIC_RESOLUTION_HEADROOM / dr.m_GpuTime), scale + DYNAMIC_RESOLUTION_MAX_STEP);
+        }
+        scale = dmMath::Clamp(scale, dr.m_Params.m_MinScale, dr.m_Params.m_MaxScale);
+
+        // The frames at the previous scale aren't used for the next change
+        dr.m_GpuTime = 0.0f;
+        dr.m_FrameCount = 0;
+        dr.m_Scale = scale;
+    }
+
+    void AddPredicateStats(HRenderContext render_context, const Predicate* predicate, const dmGraphics::Stats& stats)
+    {
+        dmArray<PredicateStats>& predicate_stats = render_context->m_PredicateStats;
+        uint32_t tags_size = predicate->m_TagCount * sizeof(dmhash_t);
+        for (uint32_t i = 0; i < predicate_stats.Size(); ++i)
+        {
+            PredicateStats& entry = predicate_stats[i];
+            if (entry.m_Predicate.m_TagCount == predicate->m_TagCount && memcmp(entry.m_Predicate.m_Tags, predicate->m_Tags, tags_size) == 0)
+            {
+                dmGraphics::AddStats(stats, &entry.m_Stats);
+                return;
+            }
+        }
+
+        if (predicate_stats.Full())
+            predicate_stats.OffsetCapacity(8);
+        PredicateStats entry;
+        entry.m_Predicate.m_TagCount = predicate->m_TagCount;
+        memcpy(entry.m_Predicate.m_Tags, predicate->m_Tags, tags_size);
+        entry.m_Stats = stats;
+        predicate_stats.Push(entry);
+    }
+
+    void AddOccluder(HRenderContext render_context, const Matrix4& world, const Vector3& aabb_min, const Vector3& aabb_max)
+    {
+        dmArray<Occluder>& occluders = render_context->m_Occluders;
+        if (occluders.Full())
+            occluders.OffsetCapacity(dmMath::Max(64U, occluders.Capacity() / 2));
+        Occluder occluder;
+        occluder.m_World = world;
+        occluder.m_AabbMin = aabb_min;
+        occluder.m_AabbMax = aabb_max;
+        occluders.Push(occluder);
+
+        // The visibility of the cached draw orders may change
+        render_context->m_RenderListSortCache.SetSize(0);
+    }
+
+    uint32_t GetOccluderCount(HRenderContext render_context)
+    {
+        return render_context->m_Occluders.Size();
+    }
+
+    void AddLight(HRenderContext render_context, const LightParams& params)
+    {
+        dmArray<Light>& lights = render_context->m_Lights;
+        if (lights.Full())
+        {
+            dmLogOnceWarning("Too many lights added in a frame, only %u are used", lights.Capacity());
+            return;
+        }
+
+        Light light;
+        light.m_Sphere = Vector4(Vector3(params.m_Position), params.m_Range);
+        light.m_Color = Vector4(params.m_Color * params.m_Intensity, (float) params.m_Type);
+        Vector3 direction = params.m_Direction;
+        float length_sqr = dmVMath::LengthSqr(direction);
+        direction = length_sqr > 0.0f ? direction / sqrtf(length_sqr) : Vector3(0.0f, 0.0f, -1.0f);
+        light.m_Direction = Vector4(direction, cosf(params.m_ConeAngle * 0.5f));
+        lights.Push(light);
+
+        render_context->m_LightClustersKey = 0;
+    }
+
+    uint32_t GetLightCount(HRenderContext render_context)
+    {
+        return render_context->m_Lights.Size();
+    }
+
+    // Bins the lights for the current view and projection, unless already done
+    static void UpdateLightClusters(HRenderContext render_context)
+    {
+        HashState64 state;
+        dmHashInit64(&state, false);
+        dmHashUpdateBuffer64(&state, &render_context->m_View, sizeof(render_context->m_View));
+        dmHashUpdateBuffer64(&state, &render_context->m_Projection, sizeof(render_context->m_Projection));
+        uint64_t key = dmHashFinal64(&state) | 1; // Zero means not built
+        if (key == render_context->m_LightClustersKey)
+            return;
+        render_context->m_LightClustersKey = key;
+
+        DM_PROFILE("UpdateLightClusters");
+
+        const dmArray<Light>& lights = render_context->m_Lights;
+        uint32_t light_count = lights.Size();
+        dmArray<Vector4>& spheres = render_context->m_LightSpheres;
+        spheres.SetSize(light_count);
+        for (uint32_t i = 0; i < light_count; ++i)
+        {
+            spheres[i] = lights[i].m_Sphere;
+        }
+        BuildLightClusters(render_context->m_LightClusters, render_context->m_View, render_context->m_Projection, spheres.Begin(), light_count);
+
+        static const dmhash_t LIGHT_CLUSTER_PARAMS = dmHashString64("light_cluster_params");
+        static const dmhash_t LIGHT_CLUSTER_DEPTH  = dmHashString64("light_cluster_depth");
+        static const dmhash_t LIGHT_CLUSTERS       = dmHashString64("light_clusters");
+        static const dmhash_t LIGHT_INDICES        = dmHashString64("light_indices");
+        static const dmhash_t LIGHT_DATA           = dmHashString64("light_data");
+
+        Vector4 params((float) LIGHT_CLUSTER_TILES_X, (float) LIGHT_CLUSTER_TILES_Y, (float) LIGHT_CLUSTER_SLICES, (float) light_count);
+        Vector4 depth;
+        Vector4 ranges[LIGHT_CLUSTER_COUNT / 2];
+        Vector4 indices[LIGHT_CLUSTER_MAX_INDICES / 4];
+        Vector4 data[LIGHT_CLUSTER_MAX_LIGHTS * 3];
+        GetLightClusterData(render_context->m_LightClusters, &depth, ranges, DM_ARRAY_SIZE(ranges), indices, DM_ARRAY_SIZE(indices));
+
+        memset(data, 0, sizeof(data));
+        for (uint32_t i = 0; i < light_count; ++i)
+        {
+            data[i * 3 + 0] = lights[i].m_Sphere;
+            data[i * 3 + 1] = lights[i].m_Color;
+            data[i * 3 + 2] = lights[i].m_Direction;
+        }
+
+        HNamedConstantBuffer buffer = render_context->m_LightConstants;
+        SetNamedConstant(buffer, LIGHT_CLUSTER_PARAMS, &params, 1);
+        SetNamedConstant(buffer, LIGHT_CLUSTER_DEPTH, &depth, 1);
+        SetNamedConstant(buffer, LIGHT_CLUSTERS, ranges, DM_ARRAY_SIZE(ranges));
+        SetNamedConstant(buffer, LIGHT_INDICES, indices, DM_ARRAY_SIZE(indices));
+        SetNamedConstant(buffer, LIGHT_DATA, data, DM_ARRAY_SIZE(data));
+
+        uint32_t overflow = GetLightClusterOverflow(render_context->m_LightClusters);
+        if (overflow > 0)
+        {
+            dmLogOnceWarning("The light clusters are full, %u light indices were dropped", overflow);
+        }
     }
 
     HRenderListDispatch RenderListMakeDispatch(HRenderContext render_context, RenderListDispatchFn dispatch_fn, RenderListVisibilityFn visibility_fn, void* user_data)
@@ -190,6 +465,7 @@ namespace dmRender
         d.m_DispatchFn = dispatch_fn;
         d.m_VisibilityFn = visibility_fn;
         d.m_UserData = user_data;
+        d.m_SpatialIndex = 0;
         render_context->m_RenderListDispatch.Push(d);
 
         return render_context->m_RenderListDispatch.Size() - 1;
@@ -200,6 +476,14 @@ namespace dmRender
         return RenderListMakeDispatch(render_context, dispatch_fn, 0, user_data);
     }
 
+    void RenderListSetSpatialIndex(HRenderContext render_context, HRenderListDispatch dispatch, HSpatialIndex index)
+    {
+        if (dispatch == RENDERLIST_INVALID_DISPATCH)
+            return;
+        assert(dispatch < render_context->m_RenderListDispatch.Size());
+        render_context->m_RenderListDispatch[dispatch].m_SpatialIndex = index;
+    }
+
     // Allocate a buffer (from the array) with room for 'entries' entries.
     //
     // NOTE: Pointer might go invalid after a consecutive call to RenderListAlloc if reallocation
@@ -220,6 +504,7 @@ namespace dmRender
 
         // If we push new items after the last frustum culling, we need to reevaluate it
         render_context->m_FrustumHash = 0xFFFFFFFF;
+        render_context->m_RenderListSortCache.SetSize(0);
 
         return (render_list.Begin() + size);
     }
@@ -253,19 +538,9 @@ namespace dmRender
 
         // invalidate the ranges if this is a call to the debug rendering (happening in the middle of the frame)
         render_context->m_RenderListRanges.SetSize(0);
+        render_context->m_RenderListSortCache.SetSize(0);
     }
 
-    struct RenderListSorter
-    {
-        bool operator()(uint32_t a, uint32_t b) const
-        {
-            const RenderListSortValue& u = values[a];
-            const RenderListSortValue& v = values[b];
-            return u.m_SortKey < v.m_SortKey;
-        }
-        RenderListSortValue* values;
-    };
-
     void RenderListEnd(HRenderContext render_context)
     {
         // Unflushed leftovers are assumed to be the debug rendering
@@ -273,6 +548,18 @@ namespace dmRender
         FlushTexts(render_context, RENDER_ORDER_AFTER_WORLD, 0xffffff, true);
     }
 
+    void InvalidateRender(HRenderContext render_context)
+    {
+        render_context->m_RenderInvalidated = 1;
+    }
+
+    bool ConsumeRenderInvalidated(HRenderContext render_context)
+    {
+        bool invalidated = render_context->m_RenderInvalidated;
+        render_context->m_RenderInvalidated = 0;
+        return invalidated;
+    }
+
     void SetSystemFontMap(HRenderContext render_context, HFontMap font_map)
     {
         render_context->m_SystemFontMap = font_map;
@@ -597,6 +884,62 @@ namespace dmRender
         }
     }
 
+    static uint64_t GetSortCacheKey(HRenderContext context, uint32_t tag_count, const dmhash_t* tags, dmhash_t frustum_hash)
+    {
+        HashState64 state;
+        dmHashInit64(&state, false);
+        dmHashUpdateBuffer64(&state, &tag_count, sizeof(tag_count));
+        if (tag_count > 0)
+            dmHashUpdateBuffer64(&state, tags, tag_count * sizeof(dmhash_t));
+        dmHashUpdateBuffer64(&state, &context->m_ViewProj, sizeof(context->m_ViewProj));
+        dmHashUpdateBuffer64(&state, &frustum_hash, sizeof(frustum_hash));
+        return dmHashFinal64(&state);
+    }
+
+    // Restores a previously sorted draw order into the sort buffer
+    static bool GetCachedSortBuffer(HRenderContext context, uint64_t key)
+    {
+        const RenderListSortCacheEntry* entries = context->m_RenderListSortCache.Begin();
+        uint32_t num_entries = context->m_RenderListSortCache.Size();
+        for (uint32_t i = 0; i < num_entries; ++i)
+        {
+            const RenderListSortCacheEntry& entry = entries[i];
+            if (entry.m_Key != key)
+                continue;
+
+            context->m_RenderListSortBuffer.SetCapacity(context->m_RenderListSortIndices.Capacity());
+            context->m_RenderListSortBuffer.SetSize(entry.m_Count);
+            if (entry.m_Count > 0)
+                memcpy(context->m_RenderListSortBuffer.Begin(), context->m_RenderListSortCacheIndices.Begin() + entry.m_Start, entry.m_Count * sizeof(uint32_t));
+            return true;
+        }
+        return false;
+    }
+
+    static void CacheSortBuffer(HRenderContext context, uint64_t key)
+    {
+        // The indices of the invalidated entries are reclaimed when the cache is reused from scratch
+        if (context->m_RenderListSortCache.Empty())
+            context->m_RenderListSortCacheIndices.SetSize(0);
+
+        uint32_t count = context->m_RenderListSortBuffer.Size();
+        dmArray<uint32_t>& indices = context->m_RenderListSortCacheIndices;
+        if (indices.Remaining() < count)
+            indices.OffsetCapacity(dmMath::Max(count - indices.Remaining(), indices.Capacity() / 2));
+
+        RenderListSortCacheEntry entry;
+        entry.m_Key = key;
+        entry.m_Start = indices.Size();
+        entry.m_Count = count;
+        indices.SetSize(entry.m_Start + count);
+        if (count > 0)
+            memcpy(indices.Begin() + entry.m_Start, context->m_RenderListSortBuffer.Begin(), count * sizeof(uint32_t));
+
+        if (context->m_RenderListSortCache.Full())
+            context->m_RenderListSortCache.OffsetCapacity(8);
+        context->m_RenderListSortCache.Push(entry);
+    }
+
     static void CollectRenderEntryRange(void* _ctx, uint32_t tag_list_key, size_t start, size_t count)
     {
         HRenderContext context = (HRenderContext)_ctx;
@@ -632,6 +975,260 @@ namespace dmRender
         FindRenderListRanges(first, high - first, size - (high - rangefirst), entries, comp, ctx, callback);
     }
 
+    static const uint32_t RADIX_SORT_BITS = 8;
+    static const uint32_t RADIX_SORT_BUCKETS = 1 << RADIX_SORT_BITS;
+    static const uint32_t RADIX_SORT_MAX_CHUNKS = 16;
+    // Below this, the cost of distributing the work outweighs the gain
+    static const uint32_t RADIX_SORT_PARALLEL_THRESHOLD = 32768;
+
+    struct RadixSortContext
+    {
+        const RadixSortItem* m_Src;
+        RadixSortItem*       m_Dst;
+        uint32_t             m_Count;
+        uint32_t             m_ChunkSize;
+        uint32_t             m_Shift;
+        uint64_t             m_DiffMasks[RADIX_SORT_MAX_CHUNKS];
+        uint32_t             m_Offsets[RADIX_SORT_MAX_CHUNKS][RADIX_SORT_BUCKETS];
+    };
+
+    static void RadixSortDiffMask(void* _ctx, uint32_t chunk_begin, uint32_t chunk_end)
+    {
+        RadixSortContext* ctx = (RadixSortContext*)_ctx;
+        const uint64_t first = ctx->m_Src[0].m_Key;
+        for (uint32_t c = chunk_begin; c < chunk_end; ++c)
+        {
+            uint32_t end = dmMath::Min(ctx->m_Count, (c + 1) * ctx->m_ChunkSize);
+            uint64_t mask = 0;
+            for (uint32_t i = c * ctx->m_ChunkSize; i < end; ++i)
+                mask |= ctx->m_Src[i].m_Key ^ first;
+            ctx->m_DiffMasks[c] = mask;
+        }
+    }
+
+    static void RadixSortCount(void* _ctx, uint32_t chunk_begin, uint32_t chunk_end)
+    {
+        RadixSortContext* ctx = (RadixSortContext*)_ctx;
+        const uint32_t shift = ctx->m_Shift;
+        for (uint32_t c = chunk_begin; c < chunk_end; ++c)
+        {
+            uint32_t* counts = ctx->m_Offsets[c];
+            memset(counts, 0, sizeof(ctx->m_Offsets[c]));
+            uint32_t end = dmMath::Min(ctx->m_Count, (c + 1) * ctx->m_ChunkSize);
+            for (uint32_t i = c * ctx->m_ChunkSize; i < end; ++i)
+                counts[(ctx->m_Src[i].m_Key >> shift) & (RADIX_SORT_BUCKETS - 1)]++;
+        }
+    }
+
+    static void RadixSortScatter(void* _ctx, uint32_t chunk_begin, uint32_t chunk_end)
+    {
+        RadixSortContext* ctx = (RadixSortContext*)_ctx;
+        const uint32_t shift = ctx->m_Shift;
+        for (uint32_t c = chunk_begin; c < chunk_end; ++c)
+        {
+            uint32_t* offsets = ctx->m_Offsets[c];
+            uint32_t end = dmMath::Min(ctx->m_Count, (c + 1) * ctx->m_ChunkSize);
+            for (uint32_t i = c * ctx->m_ChunkSize; i < end; ++i)
+            {
+                const RadixSortItem& item = ctx->m_Src[i];
+                ctx->m_Dst[offsets[(item.m_Key >> shift) & (RADIX_SORT_BUCKETS - 1)]++] = item;
+            }
+        }
+    }
+
+    static void RadixSortRun(dmJobThread::HContext job_thread, uint32_t chunk_count, dmJobThread::FParallelFor fn, RadixSortContext* ctx)
+    {
+        if (chunk_count > 1)
+            dmJobThread::ParallelFor(job_thread, chunk_count, 1, fn, ctx);
+        else
+            fn(ctx, 0, chunk_count);
+    }
+
+    RadixSortItem* RadixSort(dmJobThread::HContext job_thread, RadixSortItem* items, RadixSortItem* scratch, uint32_t count)
+    {
+        if (count < 2)
+            return items;
+
+        uint32_t chunk_count = 1;
+        if (job_thread && count >= RADIX_SORT_PARALLEL_THRESHOLD)
+            chunk_count = dmMath::Min(dmJobThread::GetWorkerCount(job_thread) + 1, RADIX_SORT_MAX_CHUNKS);
+
+        RadixSortContext sort_ctx;
+        RadixSortContext* ctx = &sort_ctx;
+        ctx->m_Src = items;
+        ctx->m_Dst = scratch;
+        ctx->m_Count = count;
+        ctx->m_ChunkSize = (count + chunk_count - 1) / chunk_count;
+        chunk_count = (count + ctx->m_ChunkSize - 1) / ctx->m_ChunkSize;
+
+        // The bits that differ between any of the keys. Digits that are the same for all keys don't need a pass
+        RadixSortRun(job_thread, chunk_count, RadixSortDiffMask, ctx);
+        uint64_t diff_mask = 0;
+        for (uint32_t c = 0; c < chunk_count; ++c)
+            diff_mask |= ctx->m_DiffMasks[c];
+
+        for (uint32_t shift = 0; shift < 64; shift += RADIX_SORT_BITS)
+        {
+            if (((diff_mask >> shift) & (RADIX_SORT_BUCKETS - 1)) == 0)
+                continue;
+
+            ctx->m_Shift = shift;
+            RadixSortRun(job_thread, chunk_count, RadixSortCount, ctx);
+
+            // Each chunk writes its items for a bucket after the preceding chunks, which keeps the sort stable
+            uint32_t offset = 0;
+            for (uint32_t b = 0; b < RADIX_SORT_BUCKETS; ++b)
+            {
+                for (uint32_t c = 0; c < chunk_count; ++c)
+                {
+                    uint32_t n = ctx->m_Offsets[c][b];
+                    ctx->m_Offsets[c][b] = offset;
+                    offset += n;
+                }
+            }
+
+            RadixSortRun(job_thread, chunk_count, RadixSortScatter, ctx);
+
+            RadixSortItem* tmp = (RadixSortItem*)ctx->m_Src;
+            ctx->m_Src = ctx->m_Dst;
+            ctx->m_Dst = tmp;
+        }
+
+        return (RadixSortItem*)ctx->m_Src;
+    }
+
+    // Returns room for 'count' sort items, followed by the same amount of scratch items
+    static RadixSortItem* GetRadixSortItems(HRenderContext context, uint32_t count)
+    {
+        if (context->m_RenderListRadixItems.Capacity() < count * 2)
+            context->m_RenderListRadixItems.SetCapacity(count * 2);
+        context->m_RenderListRadixItems.SetSize(count * 2);
+        return context->m_RenderListRadixItems.Begin();
+    }
+
+    // Sorts the indices on the keys in the first 'count' items from GetRadixSortItems()
+    static void SortIndices(HRenderContext context, uint32_t* indices, uint32_t count)
+    {
+        RadixSortItem* items = context->m_RenderListRadixItems.Begin();
+        RadixSortItem* sorted = RadixSort(context->m_JobThread, items, items + count, count);
+        for (uint32_t i = 0; i < count; ++i)
+            indices[i] = sorted[i].m_Index;
+    }
+
+    // Merges two adjacent sorted ranges. Equal keys are ordered on the entry index, i.e. the order they were submitted in,
+    // which gives the same result as a stable sort of both ranges
+    static void MergeSortItems(const RadixSortItem* a, const RadixSortItem* a_end, const RadixSortItem* b, const RadixSortItem* b_end, RadixSortItem* out)
+    {
+        while (a != a_end && b != b_end)
+        {
+            if (b->m_Key < a->m_Key || (b->m_Key == a->m_Key && b->m_Index < a->m_Index))
+                *out++ = *b++;
+            else
+                *out++ = *a++;
+        }
+        while (a != a_end)
+            *out++ = *a++;
+        while (b != b_end)
+            *out++ = *b++;
+    }
+
+    // Sorts the render list on the tag list keys, when parts of it were submitted already sorted (see RenderListSubmitPersistent).
+    // Only the other entries are sorted, and the runs are then merged with them.
+    static void SortRenderListWithSortedRuns(HRenderContext context)
+    {
+        const RenderListEntry* entries = context->m_RenderList.Begin();
+        uint32_t* indices = context->m_RenderListSortIndices.Begin();
+        uint32_t count = context->m_RenderListSortIndices.Size();
+        RadixSortItem* items = GetRadixSortItems(context, count);
+        RadixSortItem* scratch = items + count;
+
+        const dmArray<RenderListSortedRun>& runs = context->m_RenderListSortedRuns;
+        uint32_t num_sorted = 0;
+        for (uint32_t r = 0; r < runs.Size(); ++r)
+            num_sorted += runs[r].m_Count;
+
+        // The unsorted entries go first, followed by each run
+        dmArray<RenderListSortedRun>& segments = context->m_RenderListMergeRuns;
+        if (segments.Capacity() < runs.Size() + 1)
+            segments.SetCapacity(runs.Size() + 1);
+        segments.SetSize(0);
+
+        uint32_t num_unsorted = count - num_sorted;
+        if (num_unsorted > 0)
+        {
+            RenderListSortedRun segment;
+            segment.m_Start = 0;
+            segment.m_Count = num_unsorted;
+            segments.Push(segment);
+        }
+
+        RadixSortItem* unsorted = items;
+        RadixSortItem* sorted = items + num_unsorted;
+        uint32_t start = 0;
+        for (uint32_t r = 0; r <= runs.Size(); ++r)
+        {
+            uint32_t end = r < runs.Size() ? runs[r].m_Start : count;
+            for (uint32_t i = start; i < end; ++i, ++unsorted)
+            {
+                unsorted->m_Key = entries[indices[i]].m_TagListKey;
+                unsorted->m_Index = indices[i];
+            }
+            if (r == runs.Size())
+                break;
+
+            RenderListSortedRun segment;
+            segment.m_Start = sorted - items;
+            segment.m_Count = runs[r].m_Count;
+            segments.Push(segment);
+
+            end += runs[r].m_Count;
+            for (uint32_t i = runs[r].m_Start; i < end; ++i, ++sorted)
+            {
+                sorted->m_Key = entries[indices[i]].m_TagListKey;
+                sorted->m_Index = indices[i];
+            }
+            start = end;
+        }
+
+        if (num_unsorted > 0)
+        {
+            RadixSortItem* result = RadixSort(context->m_JobThread, items, scratch, num_unsorted);
+            if (result != items)
+                memcpy(items, result, num_unsorted * sizeof(RadixSortItem));
+        }
+
+        // Merge adjacent segments pairwise, until there's only one left
+        RadixSortItem* src = items;
+        RadixSortItem* dst = scratch;
+        while (segments.Size() > 1)
+        {
+            uint32_t num_segments = 0;
+            for (uint32_t i = 0; i < segments.Size(); i += 2)
+            {
+                RenderListSortedRun a = segments[i];
+                if (i + 1 < segments.Size())
+                {
+                    RenderListSortedRun b = segments[i + 1];
+                    MergeSortItems(src + a.m_Start, src + a.m_Start + a.m_Count, src + b.m_Start, src + b.m_Start + b.m_Count, dst + a.m_Start);
+                    a.m_Count += b.m_Count;
+                }
+                else
+                {
+                    memcpy(dst + a.m_Start, src + a.m_Start, a.m_Count * sizeof(RadixSortItem));
+                }
+                segments[num_segments++] = a;
+            }
+            segments.SetSize(num_segments);
+
+            RadixSortItem* tmp = src;
+            src = dst;
+            dst = tmp;
+        }
+
+        for (uint32_t i = 0; i < count; ++i)
+            indices[i] = src[i].m_Index;
+    }
+
     static void SortRenderList(HRenderContext context)
     {
         DM_PROFILE("SortRenderList");
@@ -640,10 +1237,22 @@ namespace dmRender
             return;
 
         // First sort on the tag masks
+        if (!context->m_RenderListSortedRuns.Empty())
         {
-            RenderListEntrySorter sort;
-            sort.m_Base = context->m_RenderList.Begin();
-            std::stable_sort(context->m_RenderListSortIndices.Begin(), context->m_RenderListSortIndices.End(), sort);
+            SortRenderListWithSortedRuns(context);
+        }
+        else
+        {
+            const RenderListEntry* entries = context->m_RenderList.Begin();
+            uint32_t* indices = context->m_RenderListSortIndices.Begin();
+            uint32_t count = context->m_RenderListSortIndices.Size();
+            RadixSortItem* items = GetRadixSortItems(context, count);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                items[i].m_Key = entries[indices[i]].m_TagListKey;
+                items[i].m_Index = indices[i];
+            }
+            SortIndices(context, indices, count);
         }
         // Now find the ranges of tag masks
         {
@@ -661,6 +1270,10 @@ namespace dmRender
         return a->m_Dispatch == b->m_Dispatch;
     }
 
+    // Below this many render list entries, the visibility functions are called on the main thread
+    static const uint32_t FRUSTUM_CULLING_PARALLEL_THRESHOLD = 4096;
+    static const uint32_t FRUSTUM_CULLING_GRAIN_SIZE = 1024;
+
     static void SetVisibility(uint32_t count, RenderListEntry* entries, Visibility visibility)
     {
         for (uint32_t i = 0; i < count; ++i)
@@ -669,35 +1282,99 @@ namespace dmRender
         }
     }
 
-    static void FrustumCulling(HRenderContext context, const dmIntersection::Frustum& frustum)
+    static void CullRenderListRanges(void* _context, uint32_t begin, uint32_t end)
     {
-        DM_PROFILE("FrustumCulling");
-
-        uint32_t num_entries = context->m_RenderList.Size();
-        if (num_entries == 0)
-            return;
-
-        BatchIterator<RenderListEntry*> iter(num_entries, context->m_RenderList.Begin(), RenderListEntryEqFn);
-        while(iter.Next())
+        HRenderContext context = (HRenderContext)_context;
+        RenderListEntry* entries = context->m_RenderList.Begin();
+        for (uint32_t i = begin; i < end; ++i)
         {
-            RenderListEntry* batch_start = iter.Begin();
+            const RenderListCullRange& range = context->m_RenderListCullRanges[i];
+            RenderListEntry* range_start = entries + range.m_Start;
 
-            const RenderListDispatch* d = &context->m_RenderListDispatch[batch_start->m_Dispatch];
+            const RenderListDispatch* d = &context->m_RenderListDispatch[range_start->m_Dispatch];
             if (!d->m_VisibilityFn)
             {
-                SetVisibility(iter.Length(), iter.Begin(), dmRender::VISIBILITY_FULL);
+                SetVisibility(range.m_Count, range_start, dmRender::VISIBILITY_FULL);
             }
             else {
                 RenderListVisibilityParams params;
-                params.m_Frustum = &frustum;
+                params.m_Frustum = context->m_CullFrustum;
                 params.m_UserData = d->m_UserData;
-                params.m_Entries = batch_start;
-                params.m_NumEntries = iter.Length();
+                params.m_Entries = range_start;
+                params.m_NumEntries = range.m_Count;
+                params.m_OcclusionBuffer = context->m_Occluders.Empty() ? 0 : context->m_OcclusionBuffer;
                 d->m_VisibilityFn(params);
             }
         }
     }
 
+    static void DrawOccluders(HRenderContext context, const Matrix4& view_proj)
+    {
+        DM_PROFILE("DrawOccluders");
+        HOcclusionBuffer buffer = context->m_OcclusionBuffer;
+        ClearOcclusionBuffer(buffer, view_proj);
+        for (uint32_t i = 0; i < context->m_Occluders.Size(); ++i)
+        {
+            const Occluder& occluder = context->m_Occluders[i];
+            RasterizeOccluder(buffer, occluder.m_World, occluder.m_AabbMin, occluder.m_AabbMax);
+        }
+        FinalizeOcclusionBuffer(buffer);
+    }
+
+    static void FrustumCulling(HRenderContext context, const dmIntersection::Frustum& frustum, const Matrix4& view_proj)
+    {
+        DM_PROFILE("FrustumCulling");
+
+        uint32_t num_entries = context->m_RenderList.Size();
+        if (num_entries == 0)
+            return;
+
+        if (!context->m_Occluders.Empty())
+            DrawOccluders(context, view_proj);
+
+        // The spatial indices are culled before the visibility functions, which read the result
+        for (uint32_t i = 0; i < context->m_RenderListDispatch.Size(); ++i)
+        {
+            HSpatialIndex index = context->m_RenderListDispatch[i].m_SpatialIndex;
+            if (index)
+                CullSpatialIndex(index, frustum, context->m_JobThread);
+        }
+
+        // Large batches are split, so that they can be culled in parallel
+        const bool parallel = context->m_JobThread && num_entries >= FRUSTUM_CULLING_PARALLEL_THRESHOLD;
+        const uint32_t max_range_size = parallel ? FRUSTUM_CULLING_GRAIN_SIZE : num_entries;
+
+        dmArray<RenderListCullRange>& ranges = context->m_RenderListCullRanges;
+        ranges.SetSize(0);
+
+        RenderListEntry* entries = context->m_RenderList.Begin();
+        BatchIterator<RenderListEntry*> iter(num_entries, entries, RenderListEntryEqFn);
+        while(iter.Next())
+        {
+            uint32_t start = iter.Begin() - entries;
+            uint32_t count = iter.Length();
+            while (count > 0)
+            {
+                if (ranges.Full())
+                    ranges.OffsetCapacity(dmMath::Max(16U, ranges.Capacity()));
+
+                RenderListCullRange range;
+                range.m_Start = start;
+                range.m_Count = dmMath::Min(count, max_range_size);
+                ranges.Push(range);
+                start += range.m_Count;
+                count -= range.m_Count;
+            }
+        }
+
+        context->m_CullFrustum = &frustum;
+        if (parallel)
+            dmJobThread::ParallelFor(context->m_JobThread, ranges.Size(), 1, CullRenderListRanges, context);
+        else
+            CullRenderListRanges(context, 0, ranges.Size());
+        context->m_CullFrustum = 0;
+    }
+
     void SetTextureBindingByHash(dmRender::HRenderContext render_context, dmhash_t sampler_hash, dmGraphics::HTexture texture)
     {
         uint32_t num_bindings = render_context->m_TextureBindTable.Size();
@@ -722,16 +1399,11 @@ namespace dmRender
             }
         }
 
-        if (render_context->m_TextureBindTable.Full())
-        {
-            render_context->m_TextureBindTable.OffsetCapacity(4);
-        }
-
         // Otherwise, we add a new binding to the end of the list
         TextureBinding new_binding;
         new_binding.m_Samplerhash = sampler_hash;
         new_binding.m_Texture     = texture;
-        render_context->m_TextureBindTable.Push(new_binding);
+        render_context->m_TextureBindTable.PushGrow(new_binding);
     }
 
     void SetTextureBindingByUnit(HRenderContext render_context, uint32_t unit, dmGraphics::HTexture texture)
@@ -818,6 +1490,7 @@ namespace dmRender
     Result DrawRenderList(HRenderContext context, HPredicate predicate, HNamedConstantBuffer constant_buffer, const FrustumOptions* frustum_options)
     {
         DM_PROFILE("DrawRenderList");
+        DM_MEMORY_TAG(dmMemory::TAG_RENDER);
 
         // This will add new entries for the most recent debug draw render objects.
         // The internal dispatch functions knows to only actually use the latest ones.
@@ -872,7 +1545,7 @@ namespace dmRender
             {
                 dmIntersection::Frustum frustum;
                 dmIntersection::CreateFrustumFromMatrix(*frustum_matrix, true, (int) frustum_num_planes, frustum);
-                FrustumCulling(context, frustum);
+                FrustumCulling(context, frustum, *frustum_matrix);
             }
             else
             {
@@ -881,18 +1554,37 @@ namespace dmRender
             }
         }
 
-        MakeSortBuffer(context, predicate?predicate->m_TagCount:0, predicate?predicate->m_Tags:0);
-
-        if (context->m_RenderListSortBuffer.Empty())
-            return RESULT_OK;
+        uint32_t tag_count = predicate ? predicate->m_TagCount : 0;
+        dmhash_t* tags = predicate ? predicate->m_Tags : 0;
 
+        // Render scripts often draw the same predicate several times per frame (e.g. for shadow or reflection passes),
+        // so the sorted draw order is reused as long as the render list, the camera and the visibility are unchanged
+        uint64_t sort_cache_key = GetSortCacheKey(context, tag_count, tags, frustum_hash);
+        if (!GetCachedSortBuffer(context, sort_cache_key))
         {
-            DM_PROFILE("DrawRenderList_SORT");
-            RenderListSorter sort;
-            sort.values = context->m_RenderListSortValues.Begin();
-            std::stable_sort(context->m_RenderListSortBuffer.Begin(), context->m_RenderListSortBuffer.End(), sort);
+            MakeSortBuffer(context, tag_count, tags);
+
+            if (!context->m_RenderListSortBuffer.Empty())
+            {
+                DM_PROFILE("DrawRenderList_SORT");
+                const RenderListSortValue* values = context->m_RenderListSortValues.Begin();
+                uint32_t* indices = context->m_RenderListSortBuffer.Begin();
+                uint32_t count = context->m_RenderListSortBuffer.Size();
+                RadixSortItem* items = GetRadixSortItems(context, count);
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    items[i].m_Key = values[indices[i]].m_SortKey;
+                    items[i].m_Index = indices[i];
+                }
+                SortIndices(context, indices, count);
+            }
+
+            CacheSortBuffer(context, sort_cache_key);
         }
 
+        if (context->m_RenderListSortBuffer.Empty())
+            return RESULT_OK;
+
         // Construct render objects
         context->m_RenderObjects.SetSize(0);
 
@@ -969,7 +1661,27 @@ namespace dmRender
         return Draw(context, predicate, constant_buffer);
     }
 
-    void DispatchCompute(HRenderContext render_context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z, HNamedConstantBuffer constant_buffer)
+    Result DrawRenderListIndirect(HRenderContext context, HPredicate predicate, HNamedConstantBuffer constant_buffer, dmGraphics::HVertexBuffer indirect_buffer, uint32_t indirect_offset, uint32_t draw_count)
+    {
+        if (indirect_buffer == 0 || draw_count == 0)
+        {
+            return RESULT_OK;
+        }
+
+        context->m_IndirectDrawBuffer = indirect_buffer;
+        context->m_IndirectDrawOffset = indirect_offset;
+        context->m_IndirectDrawCount  = draw_count;
+
+        Result result = DrawRenderList(context, predicate, constant_buffer, 0);
+
+        context->m_IndirectDrawBuffer = 0;
+        context->m_IndirectDrawOffset = 0;
+        context->m_IndirectDrawCount  = 0;
+        return result;
+    }
+
+    static void DoDispatchCompute(HRenderContext render_context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z,
+                                  dmGraphics::HVertexBuffer indirect_buffer, uint32_t indirect_offset, HNamedConstantBuffer constant_buffer)
     {
         HComputeProgram compute_program = render_context->m_ComputeProgram;
 
@@ -1011,7 +1723,10 @@ namespace dmRender
             ApplyNamedConstantBuffer(render_context, compute_program, constant_buffer);
         }
 
-        dmGraphics::DispatchCompute(context, group_count_x, group_count_y, group_count_z);
+        if (indirect_buffer)
+            dmGraphics::DispatchComputeIndirect(context, indirect_buffer, indirect_offset);
+        else
+            dmGraphics::DispatchCompute(context, group_count_x, group_count_y, group_count_z);
 
         next_texture_unit = 0;
         for (uint32_t i = 0; i < RenderObject::MAX_TEXTURE_COUNT; ++i)
@@ -1032,10 +1747,25 @@ namespace dmRender
         TrimTextureBindingTable(render_context);
     }
 
+    void DispatchCompute(HRenderContext render_context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z, HNamedConstantBuffer constant_buffer)
+    {
+        DoDispatchCompute(render_context, group_count_x, group_count_y, group_count_z, 0, 0, constant_buffer);
+    }
+
+    void DispatchComputeIndirect(HRenderContext render_context, dmGraphics::HVertexBuffer indirect_buffer, uint32_t indirect_offset, HNamedConstantBuffer constant_buffer)
+    {
+        if (indirect_buffer == 0)
+        {
+            return;
+        }
+        DoDispatchCompute(render_context, 0, 0, 0, indirect_buffer, indirect_offset, constant_buffer);
+    }
+
     // NOTE: Currently only used externally in 1 test (fontview.cpp)
     // TODO: Replace that occurrance with DrawRenderList
     Result Draw(HRenderContext render_context, HPredicate predicate, HNamedConstantBuffer constant_buffer)
     {
+        DM_MEMORY_TAG(dmMemory::TAG_RENDER);
         if (render_context == 0x0)
             return RESULT_INVALID_CONTEXT;
 
@@ -1053,6 +1783,11 @@ namespace dmRender
 
         dmGraphics::PipelineState ps_orig = dmGraphics::GetPipelineState(context);
 
+        // The light constants are only set when the program changes
+        bool apply_lights = !render_context->m_Lights.Empty();
+        if (apply_lights)
+            UpdateLightClusters(render_context);
+
         for (uint32_t i = 0; i < render_context->m_RenderObjects.Size(); ++i)
         {
             RenderObject* ro = render_context->m_RenderObjects[i];
@@ -1079,11 +1814,19 @@ namespace dmRender
                     // resource layout than the current material.
                     memset(render_context_textures, 0, sizeof(render_context_textures));
                     GetRenderContextTextures(render_context, material->m_Samplers, render_context_textures);
+
+                    apply_lights = !render_context->m_Lights.Empty();
                 }
             }
 
             ApplyMaterialConstants(render_context, material, ro);
 
+            if (apply_lights)
+            {
+                ApplyNamedConstantBuffer(render_context, material, render_context->m_LightConstants);
+                apply_lights = false;
+            }
+
             if (ro->m_ConstantBuffer) // from components/scripts
                 ApplyNamedConstantBuffer(render_context, material, ro->m_ConstantBuffer);
 
@@ -1129,7 +1872,11 @@ namespace dmRender
                 }
             }
 
-            if (ro->m_IndexBuffer)
+            if (render_context->m_IndirectDrawBuffer && ro->m_IndexBuffer)
+                dmGraphics::DrawElementsIndirect(context, ro->m_PrimitiveType, ro->m_IndexType, ro->m_IndexBuffer, render_context->m_IndirectDrawBuffer, render_context->m_IndirectDrawOffset, render_context->m_IndirectDrawCount);
+            else if (ro->m_IndirectDrawCount > 0)
+                dmGraphics::DrawElementsIndirect(context, ro->m_PrimitiveType, ro->m_IndexType, ro->m_IndexBuffer, ro->m_IndirectBuffer, ro->m_IndirectBufferOffset, ro->m_IndirectDrawCount);
+            else if (ro->m_IndexBuffer)
                 dmGraphics::DrawElements(context, ro->m_PrimitiveType, ro->m_VertexStart, ro->m_VertexCount, ro->m_IndexType, ro->m_IndexBuffer, ro->m_InstanceCount);
             else
                 dmGraphics::Draw(context, ro->m_PrimitiveType, ro->m_VertexStart, ro->m_VertexCount, ro->m_InstanceCount);
@@ -1176,7 +1923,14 @@ namespace dmRender
         if (!context->m_DebugRenderer.m_RenderContext) {
             return RESULT_INVALID_CONTEXT;
         }
-        return DrawRenderList(context, &context->m_DebugRenderer.m_3dPredicate, 0, frustum_options);
+        Result result = DrawRenderList(context, &context->m_DebugRenderer.m_3dPredicate, 0, frustum_options);
+
+        // Remember the view of the debug pass, so that debug geometry queued next frame (e.g. physics) can be culled before it is generated
+        if (frustum_options)
+            SetDebugCullFrustum(context, frustum_options->m_Matrix, frustum_options->m_NumPlanes);
+        else
+            SetDebugCullFrustum(context, context->m_ViewProj, FRUSTUM_PLANES_SIDES);
+        return result;
     }
 
     Result DrawDebug2d(HRenderContext context) // Deprecated
@@ -21,6 +21,7 @@
 #include <dmsdk/render/render.h>
 
 #include <dlib/hash.h>
+#include <dlib/job_thread.h>
 #include <script/script.h>
 #include <script/lua_source_ddf.h>
 #include <graphics/graphics.h>
@@ -142,6 +143,8 @@ namespace dmRender
         /// Max debug vertex count
         /// NOTE: This is per debug-type and not the total sum
         uint32_t                        m_MaxDebugVertexCount;
+        /// Optional. Used for sorting large render lists in parallel
+        dmJobThread::HContext           m_JobThread;
     };
 
     struct RenderCameraData
@@ -173,6 +176,14 @@ namespace dmRender
     void RenderListBegin(HRenderContext render_context);
     void RenderListEnd(HRenderContext render_context);
 
+    /**
+     * Returns true if the render has been invalidated since the last call (see InvalidateRender), e.g.
+     * by a message that was dispatched to the render script. Clears the invalidation.
+     * @param render_context Render context
+     * @return true if the next frame needs to be rendered
+     */
+    bool ConsumeRenderInvalidated(HRenderContext render_context);
+
     void SetSystemFontMap(HRenderContext render_context, HFontMap font_map);
 
     dmGraphics::HContext GetGraphicsContext(HRenderContext render_context);
@@ -192,6 +203,11 @@ namespace dmRender
     // render list, unless they already are in place from a previous call.
     Result DrawRenderList(HRenderContext context, HPredicate predicate, HNamedConstantBuffer constant_buffer, const FrustumOptions* frustum_options);
 
+    // Like DrawRenderList, but the render objects with an index buffer are drawn with dmGraphics::DrawElementsIndirect,
+    // with draw_count dmGraphics::DrawIndexedIndirectCommand read from indirect_buffer at indirect_offset (typically
+    // written by a compute program). There is no frustum culling, as the commands decide what is drawn.
+    Result DrawRenderListIndirect(HRenderContext context, HPredicate predicate, HNamedConstantBuffer constant_buffer, dmGraphics::HVertexBuffer indirect_buffer, uint32_t indirect_offset, uint32_t draw_count);
+
     Result Draw(HRenderContext context, HPredicate predicate, HNamedConstantBuffer constant_buffer);
     Result DrawDebug3d(HRenderContext context, const FrustumOptions* frustum_options);
     Result DrawDebug2d(HRenderContext context);
@@ -236,6 +252,35 @@ namespace dmRender
      */
     void Line3D(HRenderContext context, dmVMath::Point3 start, dmVMath::Point3 end, dmVMath::Vector4 start_color, dmVMath::Vector4 end_color);
 
+    /**
+     * Render multiple debug lines in world space with one call.
+     * The vertices are written directly into the debug vertex buffer, which is cheaper than calling Line3D per line.
+     * @param context Render context handle
+     * @param points Array of points. For n points, n/2 lines will be drawn between points <0,1>, <2,3>, etc.
+     * @param point_count Number of points
+     * @param color Color
+     */
+    void Lines3D(HRenderContext context, const dmVMath::Point3* points, uint32_t point_count, dmVMath::Vector4 color);
+
+    /**
+     * Render multiple debug triangles in world space with one call.
+     * @param context Render context handle
+     * @param points Array of points. For n points, n/3 triangles will be drawn between points <0,1,2>, <3,4,5>, etc.
+     * @param point_count Number of points
+     * @param color Color
+     */
+    void Triangles3D(HRenderContext context, const dmVMath::Point3* points, uint32_t point_count, dmVMath::Vector4 color);
+
+    /**
+     * Test if a world space sphere is inside the view of the last debug 3d draw.
+     * Use it to skip generating debug geometry that would not be visible.
+     * @param context Render context handle
+     * @param center Center of the sphere
+     * @param radius Radius of the sphere
+     * @return true if the sphere is visible, or if no debug 3d draw has been made yet
+     */
+    bool TestDebugFrustumSphere(HRenderContext context, dmVMath::Point3 center, float radius);
+
     HRenderScript   NewRenderScript(HRenderContext render_context, dmLuaDDF::LuaSource *source);
 
     bool            ReloadRenderScript(HRenderContext render_context, HRenderScript render_script, dmLuaDDF::LuaSource *source);
@@ -374,6 +419,132 @@ namespace dmRender
     void                            GetRenderCameraData(HRenderContext render_context, HRenderCamera camera, RenderCameraData* data);
     void                            UpdateRenderCamera(HRenderContext render_context, HRenderCamera camera, const dmVMath::Point3* position, const dmVMath::Quat* rotation);
 
+    /** Spatial index
+     * A dynamic bounding volume tree of world space bounds, used for culling the render list entries of a component type
+     * hierarchically, instead of testing each entry. The bounds are stored enlarged by a margin, so that small movements
+     * don't change the tree. When registered with a dispatch (see RenderListSetSpatialIndex), the index is culled once per
+     * frustum before any visibility callbacks are called, and they can then use IsSpatialProxyVisible() for their entries.
+     * The index isn't thread safe, apart from IsSpatialProxyVisible() between the cull and the next modification.
+     */
+    typedef struct SpatialIndex*    HSpatialIndex;
+    static const uint32_t INVALID_SPATIAL_PROXY = 0xffffffff;
+
+    HSpatialIndex                   NewSpatialIndex(float margin);
+    void                            DeleteSpatialIndex(HSpatialIndex index);
+    uint32_t                        AddSpatialProxy(HSpatialIndex index, const dmVMath::Point3& min, const dmVMath::Point3& max);
+    void                            RemoveSpatialProxy(HSpatialIndex index, uint32_t proxy);
+    // Returns true if the proxy moved outside of its enlarged bounds, and the tree was updated
+    bool                            UpdateSpatialProxy(HSpatialIndex index, uint32_t proxy, const dmVMath::Point3& min, const dmVMath::Point3& max);
+    uint32_t                        GetSpatialProxyCount(HSpatialIndex index);
+    void                            CullSpatialIndex(HSpatialIndex index, const dmIntersection::Frustum& frustum, dmJobThread::HContext job_thread);
+    // Returns true if the proxy intersected the frustum in the last call to CullSpatialIndex()
+    bool                            IsSpatialProxyVisible(HSpatialIndex index, uint32_t proxy);
+    void                            RenderListSetSpatialIndex(HRenderContext render_context, HRenderListDispatch dispatch, HSpatialIndex index);
+
+    /** Occlusion culling
+     * A small depth buffer, where the occluders added with AddOccluder() are drawn as solid boxes in software.
+     * When there are occluders, the buffer is drawn once per frustum before any visibility callbacks are called,
+     * and they can then use IsOccluded() for their entries (see RenderListVisibilityParams::m_OcclusionBuffer).
+     * The occluders are cleared with the render list, each frame.
+     */
+    static const uint32_t OCCLUSION_BUFFER_WIDTH  = 256;
+    static const uint32_t OCCLUSION_BUFFER_HEIGHT = 128;
+
+    HOcclusionBuffer                NewOcclusionBuffer(uint32_t width, uint32_t height);
+    void                            DeleteOcclusionBuffer(HOcclusionBuffer buffer);
+    void                            ClearOcclusionBuffer(HOcclusionBuffer buffer, const dmVMath::Matrix4& view_proj);
+    void                            RasterizeOccluder(HOcclusionBuffer buffer, const dmVMath::Matrix4& world, const dmVMath::Vector3& aabb_min, const dmVMath::Vector3& aabb_max);
+    // Updates the tile depths used by IsOccluded(), after the occluders have been drawn
+    void                            FinalizeOcclusionBuffer(HOcclusionBuffer buffer);
+    uint32_t                        GetOccluderCount(HRenderContext render_context);
+
+    /** Clustered lighting
+     * The view space is split into a grid of clusters, tiles on the screen and slices of the depth (logarithmic for
+     * perspective projections), and each cluster keeps a list of the lights whose range reaches it. A shader then only
+     * loops over the lights of the cluster of the fragment.
+     * The lights added with AddLight() are binned the first time they are drawn with a view and projection, and the
+     * materials that declare the following constants (with exactly these array sizes) get them set when drawing:
+     *
+     *   light_cluster_params  vec4                              tiles x, tiles y, slices, light count
+     *   light_cluster_depth   vec4                              slice = floor((z ? log(distance) : distance) * x + y), distance is -z in view space
+     *   light_clusters        vec4[LIGHT_CLUSTER_COUNT / 2]     offset into light_indices and light count of two clusters, cluster = x + y * tiles x + slice * tiles x * tiles y
+     *   light_indices         vec4[LIGHT_CLUSTER_MAX_INDICES / 4] light indices, four per vector
+     *   light_data            vec4[LIGHT_CLUSTER_MAX_LIGHTS * 3] per light: position and range, color * intensity and type, direction and cos(cone angle / 2)
+     *
+     * The tile of a fragment is found from its normalized device coordinates, tile = floor((ndc * 0.5 + 0.5) * tiles).
+     * The lights are cleared with the render list, each frame.
+     */
+    typedef struct LightClusters*   HLightClusters;
+
+    static const uint32_t LIGHT_CLUSTER_TILES_X     = 8;
+    static const uint32_t LIGHT_CLUSTER_TILES_Y     = 4;
+    static const uint32_t LIGHT_CLUSTER_SLICES      = 8;
+    static const uint32_t LIGHT_CLUSTER_COUNT       = LIGHT_CLUSTER_TILES_X * LIGHT_CLUSTER_TILES_Y * LIGHT_CLUSTER_SLICES;
+    static const uint32_t LIGHT_CLUSTER_MAX_LIGHTS  = 64;
+    static const uint32_t LIGHT_CLUSTER_MAX_INDICES = 768;
+
+    struct LightClustersParams
+    {
+        uint32_t m_TilesX;
+        uint32_t m_TilesY;
+        uint32_t m_Slices;
+        uint32_t m_MaxIndices; // The total number of light indices in all clusters
+    };
+
+    HLightClusters                  NewLightClusters(const LightClustersParams& params);
+    void                            DeleteLightClusters(HLightClusters clusters);
+    // The lights are spheres in world space, position in xyz and range in w
+    void                            BuildLightClusters(HLightClusters clusters, const dmVMath::Matrix4& view, const dmVMath::Matrix4& projection, const dmVMath::Vector4* lights, uint32_t light_count);
+    // Returns the number of lights in the cluster, and their indices in increasing order
+    uint32_t                        GetClusterLights(HLightClusters clusters, uint32_t x, uint32_t y, uint32_t slice, const uint16_t** indices);
+    uint32_t                        GetLightClusterSlice(HLightClusters clusters, float distance);
+    // The number of light indices that didn't fit in the last build
+    uint32_t                        GetLightClusterOverflow(HLightClusters clusters);
+    // Packs the clusters into the layout of the light_cluster_depth, light_clusters and light_indices constants
+    void                            GetLightClusterData(HLightClusters clusters, dmVMath::Vector4* depth, dmVMath::Vector4* ranges, uint32_t max_ranges, dmVMath::Vector4* indices, uint32_t max_indices);
+    uint32_t                        GetLightCount(HRenderContext render_context);
+
+    /** Dynamic resolution
+     * Lowers the resolution scale when the GPU time of the frames is above the target, and raises it again when
+     * there is headroom. The GPU time is measured with the timers of the render commands, and the scale stays at
+     * the max scale when the adapter has no GPU timers (see dmGraphics::IsGpuTimerSupported). The scale is updated
+     * in RenderListBegin(), and it's up to the render script to render into a render target of the scaled size
+     * and to upscale it to the window.
+     */
+    struct DynamicResolutionParams
+    {
+        DynamicResolutionParams();
+
+        float m_MinScale;
+        float m_MaxScale;
+        float m_TargetGpuTime; // In milliseconds
+    };
+
+    void                            EnableDynamicResolution(HRenderContext render_context, const DynamicResolutionParams& params);
+    void                            DisableDynamicResolution(HRenderContext render_context);
+    bool                            IsDynamicResolutionEnabled(HRenderContext render_context);
+    // Returns 1 when dynamic resolution isn't enabled
+    float                           GetResolutionScale(HRenderContext render_context);
+
+    /** Persistent render list
+     * Render list entries that are kept between frames, for components that rarely change (e.g. level geometry).
+     * The entries have stable handles, and are only written to when they change. The list keeps a copy of its entries
+     * sorted on the tag list key, which is only rebuilt when an entry is added, removed or gets a new tag list key.
+     * RenderListSubmitPersistent() copies them to the render list each frame, where they are merged with the other entries
+     * instead of being sorted again. The m_Dispatch of the entries is ignored, and set from the dispatch given when submitting.
+     */
+    typedef struct PersistentRenderList* HPersistentRenderList;
+    static const uint32_t INVALID_PERSISTENT_RENDER_LIST_ENTRY = 0xffffffff;
+
+    HPersistentRenderList           NewPersistentRenderList();
+    void                            DeletePersistentRenderList(HPersistentRenderList list);
+    uint32_t                        AddPersistentRenderListEntry(HPersistentRenderList list, const RenderListEntry& entry);
+    void                            RemovePersistentRenderListEntry(HPersistentRenderList list, uint32_t handle);
+    // Returns true if the entry was changed
+    bool                            UpdatePersistentRenderListEntry(HPersistentRenderList list, uint32_t handle, const RenderListEntry& entry);
+    uint32_t                        GetPersistentRenderListEntryCount(HPersistentRenderList list);
+    void                            RenderListSubmitPersistent(HRenderContext render_context, HRenderListDispatch dispatch, HPersistentRenderList list);
+
     static inline dmGraphics::TextureWrap WrapFromDDF(dmRenderDDF::MaterialDesc::WrapMode wrap_mode)
     {
         switch(wrap_mode)
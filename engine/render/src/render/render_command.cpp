@@ -14,10 +14,17 @@
 
 #include <stdio.h>
 #include <dlib/log.h>
+#include <dlib/profile.h>
 #include <dmsdk/dlib/intersection.h>
 #include "render_command.h"
 #include "render_private.h"
 
+DM_PROPERTY_EXTERN(rmtp_Render);
+DM_PROPERTY_GROUP(rmtp_RenderGpu, "GPU time, from a few frames ago", &rmtp_Render);
+DM_PROPERTY_F32(rmtp_GpuDraw, 0, FrameReset, "ms spent in render.draw", &rmtp_RenderGpu);
+DM_PROPERTY_F32(rmtp_GpuDispatch, 0, FrameReset, "ms spent in render.dispatch", &rmtp_RenderGpu);
+DM_PROPERTY_F32(rmtp_GpuSetRenderTarget, 0, FrameReset, "ms spent in render.set_render_target", &rmtp_RenderGpu);
+
 namespace dmRender
 {
     Command::Command(CommandType type)
@@ -55,10 +62,67 @@ namespace dmRender
         m_Operands[3] = op3;
     }
 
+    void FreeCommandOperands(Command* commands, uint32_t command_count)
+    {
+        for (uint32_t i = 0; i < command_count; i++)
+        {
+            Command* c = &commands[i];
+            switch (c->m_Type)
+            {
+                case COMMAND_TYPE_SET_VIEW:
+                case COMMAND_TYPE_SET_PROJECTION:
+                    delete (dmVMath::Matrix4*)c->m_Operands[0];
+                    break;
+                case COMMAND_TYPE_DRAW:
+                    delete (FrustumOptions*)c->m_Operands[2];
+                    break;
+                case COMMAND_TYPE_DRAW_DEBUG3D:
+                    delete (FrustumOptions*)c->m_Operands[0];
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    enum GpuTimer
+    {
+        GPU_TIMER_DRAW              = 0,
+        GPU_TIMER_DISPATCH          = 1,
+        GPU_TIMER_SET_RENDER_TARGET = 2,
+    };
+
+    static void GpuTimerResult(void* user_data, uint32_t timer_id, uint64_t elapsed_ns)
+    {
+        dmRender::HRenderContext render_context = (dmRender::HRenderContext) user_data;
+        if (render_context->m_DynamicResolution.m_Enabled)
+        {
+            AddDynamicResolutionGpuTime(render_context, elapsed_ns);
+        }
+
+        float elapsed_ms = (float) (elapsed_ns / 1000000.0);
+        switch (timer_id)
+        {
+            case GPU_TIMER_DRAW:              DM_PROPERTY_ADD_F32(rmtp_GpuDraw, elapsed_ms); break;
+            case GPU_TIMER_DISPATCH:          DM_PROPERTY_ADD_F32(rmtp_GpuDispatch, elapsed_ms); break;
+            case GPU_TIMER_SET_RENDER_TARGET: DM_PROPERTY_ADD_F32(rmtp_GpuSetRenderTarget, elapsed_ms); break;
+            default: break;
+        }
+        (void) elapsed_ms;
+    }
+
     void ParseCommands(dmRender::HRenderContext render_context, Command* commands, uint32_t command_count)
     {
         dmGraphics::HContext context = dmRender::GetGraphicsContext(render_context);
 
+        // The GPU time of the draw, dispatch and render target commands is shown in the profiler once the GPU is done with the frame.
+        // It also drives the dynamic resolution.
+        bool gpu_timers = (dmProfile::IsInitialized() || render_context->m_DynamicResolution.m_Enabled) && dmGraphics::IsGpuTimerSupported(context);
+        if (gpu_timers)
+        {
+            dmGraphics::ResolveGpuTimers(context, GpuTimerResult, render_context);
+        }
+
         for (uint32_t i=0; i<command_count; i++)
         {
             Command* c = &commands[i];
@@ -76,7 +140,11 @@ namespace dmRender
                 }
                 case COMMAND_TYPE_SET_RENDER_TARGET:
                 {
+                    if (gpu_timers)
+                        dmGraphics::BeginGpuTimer(context, GPU_TIMER_SET_RENDER_TARGET);
                     dmGraphics::SetRenderTarget(context, c->m_Operands[0], c->m_Operands[1]);
+                    if (gpu_timers)
+                        dmGraphics::EndGpuTimer(context);
                     break;
                 }
                 case COMMAND_TYPE_ENABLE_TEXTURE:
@@ -177,9 +245,22 @@ namespace dmRender
                 case COMMAND_TYPE_DRAW:
                 {
                     FrustumOptions* frustum_options = (FrustumOptions*)c->m_Operands[2];
-                    dmRender::DrawRenderList(render_context, (dmRender::Predicate*)c->m_Operands[0],
+                    dmRender::Predicate* predicate = (dmRender::Predicate*)c->m_Operands[0];
+                    dmGraphics::Stats stats_start, stats_end, stats;
+                    dmGraphics::GetStats(context, &stats_start);
+                    if (gpu_timers)
+                        dmGraphics::BeginGpuTimer(context, GPU_TIMER_DRAW);
+                    dmRender::DrawRenderList(render_context, predicate,
                                                              (dmRender::HNamedConstantBuffer)c->m_Operands[1],
                                                              frustum_options);
+                    if (gpu_timers)
+                        dmGraphics::EndGpuTimer(context);
+                    if (predicate)
+                    {
+                        dmGraphics::GetStats(context, &stats_end);
+                        dmGraphics::SubtractStats(stats_end, stats_start, &stats);
+                        AddPredicateStats(render_context, predicate, stats);
+                    }
                     delete frustum_options;
                     break;
                 }
@@ -212,9 +293,46 @@ namespace dmRender
                 }
                 case COMMAND_TYPE_DISPATCH_COMPUTE:
                 {
+                    if (gpu_timers)
+                        dmGraphics::BeginGpuTimer(context, GPU_TIMER_DISPATCH);
                     dmRender::DispatchCompute(render_context,
                         c->m_Operands[0], c->m_Operands[1], c->m_Operands[2], // group x,y,z
                         (dmRender::HNamedConstantBuffer) c->m_Operands[3]);
+                    if (gpu_timers)
+                        dmGraphics::EndGpuTimer(context);
+                    break;
+                }
+                case COMMAND_TYPE_DISPATCH_COMPUTE_INDIRECT:
+                {
+                    if (gpu_timers)
+                        dmGraphics::BeginGpuTimer(context, GPU_TIMER_DISPATCH);
+                    dmRender::DispatchComputeIndirect(render_context,
+                        (dmGraphics::HVertexBuffer) c->m_Operands[0], (uint32_t) c->m_Operands[1],
+                        (dmRender::HNamedConstantBuffer) c->m_Operands[2]);
+                    if (gpu_timers)
+                        dmGraphics::EndGpuTimer(context);
+                    break;
+                }
+                case COMMAND_TYPE_DRAW_INDIRECT:
+                {
+                    dmRender::Predicate* predicate = (dmRender::Predicate*)c->m_Operands[0];
+                    dmGraphics::Stats stats_start, stats_end, stats;
+                    dmGraphics::GetStats(context, &stats_start);
+                    if (gpu_timers)
+                        dmGraphics::BeginGpuTimer(context, GPU_TIMER_DRAW);
+                    dmRender::DrawRenderListIndirect(render_context, predicate,
+                                                     (dmRender::HNamedConstantBuffer)c->m_Operands[1],
+                                                     (dmGraphics::HVertexBuffer)c->m_Operands[2],
+                                                     (uint32_t) c->m_Operands[3],          // byte offset
+                                                     (uint32_t) (c->m_Operands[3] >> 32)); // draw count
+                    if (gpu_timers)
+                        dmGraphics::EndGpuTimer(context);
+                    if (predicate)
+                    {
+                        dmGraphics::GetStats(context, &stats_end);
+                        dmGraphics::SubtractStats(stats_end, stats_start, &stats);
+                        AddPredicateStats(render_context, predicate, stats);
+                    }
                     break;
                 }
                 case COMMAND_TYPE_SET_RENDER_CAMERA:
@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 
+#include <dlib/hash.h>
 #include <render/render.h>
 
 namespace dmRender
@@ -49,6 +50,8 @@ namespace dmRender
         COMMAND_TYPE_SET_RENDER_CAMERA,
         COMMAND_TYPE_SET_COMPUTE,
         COMMAND_TYPE_DISPATCH_COMPUTE,
+        COMMAND_TYPE_DISPATCH_COMPUTE_INDIRECT,
+        COMMAND_TYPE_DRAW_INDIRECT,
         COMMAND_TYPE_MAX
     };
 
@@ -64,7 +67,28 @@ namespace dmRender
         uint64_t    m_Operands[4];
     };
 
+    enum CommandSlotType
+    {
+        COMMAND_SLOT_TYPE_MATRIX4,
+        COMMAND_SLOT_TYPE_CONSTANT_BUFFER,
+    };
+
+    // A named operand of a recorded command list, which is given each time the list is replayed (see render.replay).
+    // The commands refer to their slots by index + 1, where 0 means that the operand is stored in the command:
+    //  COMMAND_TYPE_SET_VIEW, COMMAND_TYPE_SET_PROJECTION: m_Operands[1] is the matrix slot
+    //  COMMAND_TYPE_DRAW: m_Operands[3] is the frustum matrix slot in the lower 16 bits, and the constant buffer slot in the upper
+    //  COMMAND_TYPE_DRAW_DEBUG3D: m_Operands[1] is the frustum matrix slot
+    struct CommandSlot
+    {
+        dmhash_t        m_Name;
+        CommandSlotType m_Type;
+    };
+
+    static const uint32_t MAX_COMMAND_SLOT_COUNT = 32;
+
     void ParseCommands(dmRender::HRenderContext render_context, Command* commands, uint32_t command_count);
+    // Frees the data owned by commands that are never parsed (ParseCommands frees it otherwise)
+    void FreeCommandOperands(Command* commands, uint32_t command_count);
 }
 
 #endif /* RENDER_COMMANDS_H_ */
@@ -18,11 +18,13 @@
 #include <string.h> // For memset
 
 #include <dmsdk/dlib/vmath.h>
+#include <dmsdk/dlib/intersection.h>
 #include <dlib/opaque_handle_container.h>
 
 #include <dlib/array.h>
 #include <dlib/message.h>
 #include <dlib/hashtable.h>
+#include <dlib/job_thread.h>
 
 #include "render.h"
 
@@ -138,8 +140,11 @@ namespace dmRender
         dmRender::HRenderContext        m_RenderContext;
         dmGraphics::HVertexBuffer       m_VertexBuffer;
         dmGraphics::HVertexDeclaration  m_VertexDeclaration;
+        dmIntersection::Frustum         m_CullFrustum;          // Frustum of the last debug 3d draw, used to cull debug geometry
         uint32_t                        m_MaxVertexCount;
         uint32_t                        m_RenderBatchVersion;
+        uint32_t                        m_FlushedVertexCount;   // Total vertex count submitted by the last flush
+        uint8_t                         m_HasCullFrustum : 1;
     };
 
     const int MAX_TEXT_RENDER_CONSTANTS = 16;
@@ -154,6 +159,7 @@ namespace dmRender
         dmGraphics::BlendFactor m_SourceBlendFactor;
         dmGraphics::BlendFactor m_DestinationBlendFactor;
         uint64_t            m_BatchKey;
+        uint64_t            m_LayoutKey;    // The key of the text layout in the font map
         uint32_t            m_FaceColor;
         uint32_t            m_StringOffset;
         uint32_t            m_OutlineColor;
@@ -174,6 +180,17 @@ namespace dmRender
         uint32_t            m_StencilTestParamsSet : 1;
     };
 
+    struct TextLayout;
+
+    // A text in a batch, whose vertices are written by a job into the range reserved for it (see CreateFontRenderBatch)
+    struct TextVertexJob
+    {
+        const TextEntry*    m_Entry;
+        const TextLayout*   m_Layout;
+        uint32_t            m_VertexStart;
+        uint32_t            m_VertexCount;
+    };
+
     struct TextContext
     {
         dmArray<dmRender::RenderObject>         m_RenderObjects;
@@ -188,6 +205,7 @@ namespace dmRender
         dmArray<char>                       m_TextBuffer;
         // Map from batch id (hash of font-map etc) to index into m_TextEntries
         dmArray<TextEntry>                  m_TextEntries;
+        dmArray<TextVertexJob>              m_VertexJobs;
         uint32_t                            m_TextEntriesFlushed;
         uint32_t                            m_Frame;
         uint32_t                            m_PreviousFrame;
@@ -206,6 +224,55 @@ namespace dmRender
         RenderListDispatchFn        m_DispatchFn;
         RenderListVisibilityFn      m_VisibilityFn;
         void*                       m_UserData;
+        HSpatialIndex               m_SpatialIndex;
+    };
+
+    // A range of render list entries with the same dispatch, culled by one call to the visibility function
+    struct RenderListCullRange
+    {
+        uint32_t m_Start;
+        uint32_t m_Count;
+    };
+
+    // A box occluder, added for the current frame (see AddOccluder)
+    struct Occluder
+    {
+        Matrix4  m_World;
+        Vector3  m_AabbMin;
+        Vector3  m_AabbMax;
+    };
+
+    // A light added for the current frame (see AddLight)
+    struct Light
+    {
+        Vector4  m_Sphere;    // World space position in xyz, range in w
+        Vector4  m_Color;     // Color * intensity in xyz, type in w
+        Vector4  m_Direction; // World space direction in xyz, cos(cone angle / 2) in w
+    };
+
+    // The render statistics of the draws with one predicate, summed over a frame (see AddPredicateStats)
+    struct PredicateStats
+    {
+        Predicate         m_Predicate;
+        dmGraphics::Stats m_Stats;
+    };
+
+    // See EnableDynamicResolution
+    struct DynamicResolution
+    {
+        DynamicResolutionParams m_Params;
+        uint64_t                m_FrameGpuTime;         // In nanoseconds, the timers resolved since the last update
+        float                   m_GpuTime;              // In milliseconds, averaged over the frames since the last change
+        float                   m_Scale;
+        uint32_t                m_FrameCount;           // Frames with GPU time since the last change
+        uint32_t                m_Enabled : 1;
+    };
+
+    // A range of the sort indices that is already sorted on the tag list key (see RenderListSubmitPersistent)
+    struct RenderListSortedRun
+    {
+        uint32_t m_Start;
+        uint32_t m_Count;
     };
 
     struct RenderListSortValue
@@ -235,6 +302,14 @@ namespace dmRender
         uint32_t m_Skip:1;      // During the current draw call
     };
 
+    // A sorted draw order, reused by later draw calls in the same frame with the same predicate and camera
+    struct RenderListSortCacheEntry
+    {
+        uint64_t m_Key;         // Hash of the predicate tags, view projection and culling frustum
+        uint32_t m_Start;       // Index into m_RenderListSortCacheIndices
+        uint32_t m_Count;
+    };
+
     struct MaterialTagList
     {
         uint32_t m_Count;
@@ -280,10 +355,30 @@ namespace dmRender
         dmArray<RenderListSortValue>m_RenderListSortValues;
         dmArray<uint32_t>           m_RenderListSortBuffer;
         dmArray<uint32_t>           m_RenderListSortIndices;
+        dmArray<RadixSortItem>      m_RenderListRadixItems;     // Sort keys and their scratch buffer, 2x the number of entries
         dmArray<RenderListRange>    m_RenderListRanges;         // Maps tagmask to a range in the (sorted) render list
+        dmArray<RenderListSortCacheEntry> m_RenderListSortCache; // Cleared whenever the ranges or the visibility are invalidated
+        dmArray<uint32_t>           m_RenderListSortCacheIndices; // The sorted indices of all cache entries
+        dmArray<RenderListCullRange> m_RenderListCullRanges;
+        dmArray<RenderListSortedRun> m_RenderListSortedRuns;    // Presorted ranges of m_RenderListSortIndices
+        dmArray<RenderListSortedRun> m_RenderListMergeRuns;     // Scratch space for merging the sorted runs
+        const dmIntersection::Frustum* m_CullFrustum;           // Only valid during FrustumCulling()
+        dmArray<Occluder>           m_Occluders;                // Cleared each frame
+        HOcclusionBuffer            m_OcclusionBuffer;          // Set in the visibility params only if there are occluders
+        dmArray<Light>              m_Lights;                   // Cleared each frame
+        dmArray<Vector4>            m_LightSpheres;             // Scratch space for BuildLightClusters()
+        HLightClusters              m_LightClusters;
+        HNamedConstantBuffer        m_LightConstants;           // The light_* constants of the last built clusters
+        uint64_t                    m_LightClustersKey;         // The view and projection the clusters were built for, 0 if not built
         dmArray<TextureBinding>     m_TextureBindTable;
         dmhash_t                    m_FrustumHash;
 
+        dmArray<PredicateStats>     m_PredicateStats;           // The draws of the current frame
+        dmArray<PredicateStats>     m_LastPredicateStats;       // The draws of the previous frame
+        dmGraphics::Stats           m_FrameStatsStart;
+        dmGraphics::Stats           m_LastFrameStats;
+        DynamicResolution           m_DynamicResolution;
+
         dmHashTable32<MaterialTagList>  m_MaterialTagLists;
 
         dmOpaqueHandleContainer<RenderCamera> m_RenderCameras;
@@ -296,11 +391,17 @@ namespace dmRender
         dmGraphics::HContext        m_GraphicsContext;
         HMaterial                   m_Material;
         HComputeProgram             m_ComputeProgram;
+        // Set while drawing with DrawRenderListIndirect
+        dmGraphics::HVertexBuffer   m_IndirectDrawBuffer;
+        uint32_t                    m_IndirectDrawOffset;
+        uint32_t                    m_IndirectDrawCount;
         dmMessage::HSocket          m_Socket;
+        dmJobThread::HContext       m_JobThread;
         uint32_t                    m_OutOfResources                : 1;
         uint32_t                    m_StencilBufferCleared          : 1;
         uint32_t                    m_MultiBufferingRequired        : 1;
         uint32_t                    m_CurrentRenderCameraUseFrustum : 1;
+        uint32_t                    m_RenderInvalidated             : 1;
     };
 
     struct BufferedRenderBuffer
@@ -318,6 +419,13 @@ namespace dmRender
 
     Result GenerateKey(HRenderContext render_context, const Matrix4& view_matrix);
 
+    // Adds the GPU time of a render command to the current frame, and updates the scale once per frame
+    void AddDynamicResolutionGpuTime(HRenderContext render_context, uint64_t elapsed_ns);
+    void UpdateDynamicResolution(HRenderContext render_context);
+
+    // Adds the stats of a draw with the predicate to the current frame
+    void AddPredicateStats(HRenderContext render_context, const Predicate* predicate, const dmGraphics::Stats& stats);
+
     void     GetProgramUniformCount(dmGraphics::HProgram program, uint32_t total_constants_count, uint32_t* constant_count_out, uint32_t* samplers_count_out);
     void     SetProgramConstantValues(dmGraphics::HContext graphics_context, dmGraphics::HProgram program, uint32_t total_constants_count, dmHashTable64<dmGraphics::HUniformLocation>& name_hash_to_location, dmArray<RenderConstant>& constants, dmArray<Sampler>& samplers);
     void     SetProgramConstant(dmRender::HRenderContext render_context, dmGraphics::HContext graphics_context, const dmVMath::Matrix4& world_matrix, const dmVMath::Matrix4& texture_matrix, dmGraphics::ShaderDesc::Language program_language, dmRenderDDF::MaterialDesc::ConstantType type, dmGraphics::HProgram program, dmGraphics::HUniformLocation location, HConstant constant);
@@ -345,6 +453,8 @@ namespace dmRender
     int32_t GetMaterialSamplerIndex(HMaterial material, dmhash_t name_hash);
 
     void    DispatchCompute(HRenderContext render_context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z, HNamedConstantBuffer constant_buffer);
+    // The group counts are read by the GPU from a dmGraphics::DispatchIndirectCommand in indirect_buffer
+    void    DispatchComputeIndirect(HRenderContext render_context, dmGraphics::HVertexBuffer indirect_buffer, uint32_t indirect_offset, HNamedConstantBuffer constant_buffer);
     void    ApplyComputeProgramConstants(HRenderContext render_context, HComputeProgram compute_program);
     int32_t GetComputeProgramSamplerIndex(HComputeProgram program, dmhash_t name_hash);
 
@@ -380,6 +490,17 @@ namespace dmRender
 
     bool FindTagListRange(RenderListRange* ranges, uint32_t num_ranges, uint32_t tag_list_key, RenderListRange& range);
 
+    struct RadixSortItem
+    {
+        uint64_t m_Key;
+        uint32_t m_Index;
+    };
+
+    // Stable LSD radix sort on the keys, 8 bits per pass. Passes over digits that are the same for all keys are skipped.
+    // The scratch buffer must have room for 'count' items. Large arrays are sorted in parallel if a job thread is given.
+    // Returns the buffer that holds the sorted items (either 'items' or 'scratch')
+    RadixSortItem* RadixSort(dmJobThread::HContext job_thread, RadixSortItem* items, RadixSortItem* scratch, uint32_t count);
+
 
     // ******************************************************************************************************
 
@@ -56,6 +56,8 @@ namespace dmRender
 
     #define RENDER_SCRIPT_PREDICATE "RenderScriptPredicate"
 
+    #define RENDER_SCRIPT_COMMAND_LIST "RenderScriptCommandList"
+
     #define RENDER_SCRIPT_LIB_NAME "render"
     #define RENDER_SCRIPT_FORMAT_NAME "format"
     #define RENDER_SCRIPT_WIDTH_NAME "width"
@@ -71,6 +73,7 @@ namespace dmRender
     static uint32_t RENDER_SCRIPT_CONSTANTBUFFER_TYPE_HASH = 0;
     static uint32_t RENDER_SCRIPT_PREDICATE_TYPE_HASH = 0;
     static uint32_t RENDER_SCRIPT_CONSTANTBUFFER_ARRAY_TYPE_HASH = 0;
+    static uint32_t RENDER_SCRIPT_COMMAND_LIST_TYPE_HASH = 0;
 
     static uint32_t RENDER_SCRIPT_FLAG_TEXTURE_BIT = 1;
 
@@ -611,6 +614,111 @@ namespace dmRender
         return true;
     }
 
+    ////////////////////////////////////////////////////////////////////
+    // Recorded command lists
+
+    struct RenderScriptCommandList
+    {
+        dmArray<Command>     m_Commands;    // Owns the matrices and frustum options of the commands
+        dmArray<CommandSlot> m_Slots;
+        int                  m_Reference;   // Keeps the predicates and constant buffers used by the commands alive
+    };
+
+    static RenderScriptCommandList* RenderScriptCommandList_Check(lua_State *L, int index)
+    {
+        return (RenderScriptCommandList*)dmScript::CheckUserType(L, index, RENDER_SCRIPT_COMMAND_LIST_TYPE_HASH, "Expected a command list (acquired from the render.end_recording function)");
+    }
+
+    static int RenderScriptCommandList_gc(lua_State *L)
+    {
+        RenderScriptCommandList* list = (RenderScriptCommandList*)lua_touserdata(L, 1);
+        FreeCommandOperands(list->m_Commands.Begin(), list->m_Commands.Size());
+        dmScript::Unref(L, LUA_REGISTRYINDEX, list->m_Reference);
+        list->~RenderScriptCommandList();
+        return 0;
+    }
+
+    static int RenderScriptCommandList_tostring(lua_State *L)
+    {
+        RenderScriptCommandList* list = (RenderScriptCommandList*)lua_touserdata(L, 1);
+        lua_pushfstring(L, "CommandList: %p (%d commands)", list, list->m_Commands.Size());
+        return 1;
+    }
+
+    static const luaL_reg RenderScriptCommandList_methods[] =
+    {
+        {0,0}
+    };
+
+    static const luaL_reg RenderScriptCommandList_meta[] =
+    {
+        {"__gc",        RenderScriptCommandList_gc},
+        {"__tostring",  RenderScriptCommandList_tostring},
+        {0, 0}
+    };
+
+    static inline bool IsRecording(RenderScriptInstance* i)
+    {
+        return i->m_RecordingReference != LUA_NOREF;
+    }
+
+    // Parameter slots are given by name
+    static inline bool IsSlotName(lua_State* L, int index)
+    {
+        return lua_type(L, index) == LUA_TSTRING || dmScript::IsHash(L, index);
+    }
+
+    // Returns the slot index + 1 for the name at 'index', adding it to the current recording if needed
+    static uint64_t CheckRecordingSlot(lua_State* L, RenderScriptInstance* i, int index, CommandSlotType type)
+    {
+        dmhash_t name = dmScript::CheckHashOrString(L, index);
+        dmArray<CommandSlot>& slots = i->m_RecordingSlots;
+        for (uint32_t s = 0; s < slots.Size(); ++s)
+        {
+            if (slots[s].m_Name == name)
+            {
+                if (slots[s].m_Type != type)
+                    return luaL_error(L, "The parameter '%s' is used for different types of values.", dmHashReverseSafe64(name));
+                return s + 1;
+            }
+        }
+        if (slots.Size() == MAX_COMMAND_SLOT_COUNT)
+            return luaL_error(L, "Too many parameters in the command list (max %d).", MAX_COMMAND_SLOT_COUNT);
+        if (slots.Full())
+            slots.SetCapacity(MAX_COMMAND_SLOT_COUNT);
+        CommandSlot slot;
+        slot.m_Name = name;
+        slot.m_Type = type;
+        slots.Push(slot);
+        return slots.Size();
+    }
+
+    // Keeps the Lua object at 'index' alive for as long as the command list being recorded
+    static void AddRecordingReference(lua_State* L, RenderScriptInstance* i, int index)
+    {
+        if (!IsRecording(i))
+            return;
+        index = index < 0 ? lua_gettop(L) + index + 1 : index;
+        lua_rawgeti(L, LUA_REGISTRYINDEX, i->m_RecordingReference);
+        lua_pushvalue(L, index);
+        lua_pushboolean(L, 1);
+        lua_rawset(L, -3);
+        lua_pop(L, 1);
+    }
+
+    // Stops an unfinished recording, and drops the commands recorded so far
+    static void CancelRecording(lua_State* L, RenderScriptInstance* i)
+    {
+        if (!IsRecording(i))
+            return;
+        uint32_t start = i->m_RecordingStart;
+        FreeCommandOperands(i->m_CommandBuffer.Begin() + start, i->m_CommandBuffer.Size() - start);
+        i->m_CommandBuffer.SetSize(start);
+        i->m_RecordingSlots.SetSize(0);
+        dmScript::Unref(L, LUA_REGISTRYINDEX, i->m_RecordingReference);
+        i->m_RecordingReference = LUA_NOREF;
+    }
+
     /*# enables a render state
      *
      * Enables a particular render state. The state will be enabled until disabled.
@@ -1753,6 +1861,7 @@ namespace dmRender
         {
             HPredicate* tmp = RenderScriptPredicate_Check(L, 1);
             predicate = *tmp;
+            AddRecordingReference(L, i, 1);
         }
         else
         {
@@ -1762,6 +1871,8 @@ namespace dmRender
         dmVMath::Matrix4* frustum_matrix = 0;
         dmRender::FrustumPlanes frustum_num_planes = dmRender::FRUSTUM_PLANES_SIDES;
         HNamedConstantBuffer constant_buffer = 0;
+        uint64_t frustum_slot = 0;
+        uint64_t constant_buffer_slot = 0;
 
         if (lua_istable(L, 2))
         {
@@ -1769,7 +1880,10 @@ namespace dmRender
             lua_pushvalue(L, 2);
 
             lua_getfield(L, -1, "frustum");
-            frustum_matrix = lua_isnil(L, -1) ? 0 : dmScript::CheckMatrix4(L, -1);
+            if (IsRecording(i) && IsSlotName(L, -1))
+                frustum_slot = CheckRecordingSlot(L, i, -1, COMMAND_SLOT_TYPE_MATRIX4);
+            else
+                frustum_matrix = lua_isnil(L, -1) ? 0 : dmScript::CheckMatrix4(L, -1);
             lua_pop(L, 1);
 
             lua_getfield(L, -1, "frustum_planes");
@@ -1777,7 +1891,15 @@ namespace dmRender
             lua_pop(L, 1);
 
             lua_getfield(L, -1, "constants");
-            constant_buffer = lua_isnil(L, -1) ? 0 : *RenderScriptConstantBuffer_Check(L, -1);
+            if (IsRecording(i) && IsSlotName(L, -1))
+            {
+                constant_buffer_slot = CheckRecordingSlot(L, i, -1, COMMAND_SLOT_TYPE_CONSTANT_BUFFER);
+            }
+            else if (!lua_isnil(L, -1))
+            {
+                constant_buffer = *RenderScriptConstantBuffer_Check(L, -1);
+                AddRecordingReference(L, i, -1);
+            }
             lua_pop(L, 1);
 
             lua_pop(L, 1);
@@ -1787,21 +1909,135 @@ namespace dmRender
             dmLogOnceWarning("This interface for render.draw() is deprecated. Please see documentation at https://defold.com/ref/stable/render/#render.draw:predicate-[constants]")
             HNamedConstantBuffer* tmp = RenderScriptConstantBuffer_Check(L, 2);
             constant_buffer = *tmp;
+            AddRecordingReference(L, i, 2);
         }
 
         // we need to pass ownership to the command queue
         FrustumOptions* frustum_options = 0;
-        if (frustum_matrix)
+        if (frustum_matrix || frustum_slot)
         {
             frustum_options = new FrustumOptions;
-            frustum_options->m_Matrix = *frustum_matrix;
+            frustum_options->m_Matrix = frustum_matrix ? *frustum_matrix : dmVMath::Matrix4::identity(); // A slot is set when replayed
             frustum_options->m_NumPlanes = frustum_num_planes;
         }
 
-        if (InsertCommand(i, Command(COMMAND_TYPE_DRAW, (uint64_t)predicate, (uint64_t) constant_buffer, (uint64_t) frustum_options)))
+        uint64_t slots = frustum_slot | (constant_buffer_slot << 16);
+        if (InsertCommand(i, Command(COMMAND_TYPE_DRAW, (uint64_t)predicate, (uint64_t) constant_buffer, (uint64_t) frustum_options, slots)))
             return 0;
+        delete frustum_options;
+        return luaL_error(L, "Command buffer is full (%d).", i->m_CommandBuffer.Capacity());
+    }
+
+    // The GPU buffers of the indirect commands are created by native code (e.g. with dmGraphics::NewVertexBuffer,
+    // or dmGraphics::VulkanNewStorageBuffer) and passed to the render script as light userdata
+    static dmGraphics::HVertexBuffer CheckIndirectBuffer(lua_State* L, int index)
+    {
+        luaL_checktype(L, index, LUA_TLIGHTUSERDATA);
+        return (dmGraphics::HVertexBuffer) lua_touserdata(L, index);
+    }
+
+    static uint32_t CheckIndirectOffset(lua_State* L, int index)
+    {
+        int offset = lua_isnil(L, index) ? 0 : luaL_checkinteger(L, index);
+        if (offset < 0 || (offset & 3) != 0)
+        {
+            luaL_error(L, "The indirect buffer offset must be a positive multiple of 4, but is %d.", offset);
+        }
+        return (uint32_t) offset;
+    }
+
+    /*# draws all objects matching a predicate, with arguments from a GPU buffer
+     * Draws all objects that match a specified predicate, like [ref:render.draw], but the arguments of the draw calls
+     * are read by the GPU from a buffer. Each object with an index buffer is drawn with `draw_count` indexed indirect
+     * commands, tightly packed as five 32 bit integers: the index count, the instance count, the first index,
+     * the vertex offset and the first instance. Objects without an index buffer are drawn as usual.
+     *
+     * The buffer is typically written by a compute program, e.g. to cull instances on the GPU, so that
+     * the number of visible instances never has to be read back by the CPU. There is no frustum culling.
+     * The buffer handle comes from a native extension.
+     *
+     * @name render.draw_indirect
+     * @param predicate [type:predicate] predicate to draw for
+     * @param buffer [type:userdata] the GPU buffer holding the indirect commands
+     * @param [options] [type:table] optional table with properties:
+     *
+     * `offset`
+     * : [type:integer] the byte offset of the first command in the buffer, a multiple of 4. default=0
+     *
+     * `draw_count`
+     * : [type:integer] the number of commands to draw for each object. default=1
+     *
+     * `constants`
+     * : [type:constant_buffer] optional constants to use while rendering
+     *
+     * @examples
+     *
+     * ```lua
+     * function update(self, dt)
+     *     -- a compute program writes the visible instance count of the trees
+     *     render.set_compute("cull_trees")
+     *     render.dispatch_compute(64, 1, 1)
+     *     render.set_compute()
+     *     render.draw_indirect(self.tree_pred, self.tree_args)
+     * end
+     * ```
+     */
+    static int RenderScript_DrawIndirect(lua_State* L)
+    {
+        RenderScriptInstance* i = RenderScriptInstance_Check(L);
+        if (!dmGraphics::IsMultiDrawIndirectSupported(i->m_RenderContext->m_GraphicsContext))
+        {
+            return luaL_error(L, "Indirect draws are not supported on this device or platform.");
+        }
+
+        HPredicate predicate = 0x0;
+        if (lua_isuserdata(L, 1))
+        {
+            predicate = *RenderScriptPredicate_Check(L, 1);
+            AddRecordingReference(L, i, 1);
+        }
         else
-            return luaL_error(L, "Command buffer is full (%d).", i->m_CommandBuffer.Capacity());
+        {
+            return luaL_error(L, "No render predicate specified.");
+        }
+
+        dmGraphics::HVertexBuffer indirect_buffer = CheckIndirectBuffer(L, 2);
+        uint32_t offset = 0;
+        int draw_count = 1;
+        HNamedConstantBuffer constant_buffer = 0;
+
+        if (lua_istable(L, 3))
+        {
+            lua_pushvalue(L, 3);
+
+            lua_getfield(L, -1, "offset");
+            offset = CheckIndirectOffset(L, -1);
+            lua_pop(L, 1);
+
+            lua_getfield(L, -1, "draw_count");
+            draw_count = lua_isnil(L, -1) ? draw_count : luaL_checkinteger(L, -1);
+            lua_pop(L, 1);
+
+            lua_getfield(L, -1, "constants");
+            if (!lua_isnil(L, -1))
+            {
+                constant_buffer = *RenderScriptConstantBuffer_Check(L, -1);
+                AddRecordingReference(L, i, -1);
+            }
+            lua_pop(L, 1);
+
+            lua_pop(L, 1);
+        }
+
+        if (draw_count < 1)
+        {
+            return luaL_error(L, "The draw count must be at least 1, but is %d.", draw_count);
+        }
+
+        uint64_t offset_and_count = (uint64_t) offset | ((uint64_t) draw_count << 32);
+        if (InsertCommand(i, Command(COMMAND_TYPE_DRAW_INDIRECT, (uint64_t) predicate, (uint64_t) constant_buffer, (uint64_t) indirect_buffer, offset_and_count)))
+            return 0;
+        return luaL_error(L, "Command buffer is full (%d).", i->m_CommandBuffer.Capacity());
     }
 
     /*# draws all 3d debug graphics
@@ -1833,6 +2069,7 @@ namespace dmRender
         RenderScriptInstance* i = RenderScriptInstance_Check(L);
         dmVMath::Matrix4* frustum_matrix = 0;
         dmRender::FrustumPlanes frustum_num_planes = dmRender::FRUSTUM_PLANES_SIDES;
+        uint64_t frustum_slot = 0;
 
         if (lua_istable(L, 1))
         {
@@ -1840,7 +2077,10 @@ namespace dmRender
             lua_pushvalue(L, 1);
 
             lua_getfield(L, -1, "frustum");
-            frustum_matrix = lua_isnil(L, -1) ? 0 : dmScript::CheckMatrix4(L, -1);
+            if (IsRecording(i) && IsSlotName(L, -1))
+                frustum_slot = CheckRecordingSlot(L, i, -1, COMMAND_SLOT_TYPE_MATRIX4);
+            else
+                frustum_matrix = lua_isnil(L, -1) ? 0 : dmScript::CheckMatrix4(L, -1);
             lua_pop(L, 1);
 
             lua_getfield(L, -1, "frustum_planes");
@@ -1852,17 +2092,17 @@ namespace dmRender
 
         // we need to pass ownership to the command queue
         FrustumOptions* frustum_options = 0;
-        if (frustum_matrix)
+        if (frustum_matrix || frustum_slot)
         {
             frustum_options = new FrustumOptions;
-            frustum_options->m_Matrix = *frustum_matrix;
+            frustum_options->m_Matrix = frustum_matrix ? *frustum_matrix : dmVMath::Matrix4::identity(); // A slot is set when replayed
             frustum_options->m_NumPlanes = frustum_num_planes;
         }
 
-        if (InsertCommand(i, Command(COMMAND_TYPE_DRAW_DEBUG3D, (uint64_t)frustum_options)))
+        if (InsertCommand(i, Command(COMMAND_TYPE_DRAW_DEBUG3D, (uint64_t)frustum_options, frustum_slot)))
             return 0;
-        else
-            return luaL_error(L, "Command buffer is full (%d).", i->m_CommandBuffer.Capacity());
+        delete frustum_options;
+        return luaL_error(L, "Command buffer is full (%d).", i->m_CommandBuffer.Capacity());
     }
 
     /* DEPRECATED. NO API DOC GENERATED.
@@ -1913,14 +2153,23 @@ namespace dmRender
     int RenderScript_SetView(lua_State* L)
     {
         RenderScriptInstance* i = RenderScriptInstance_Check(L);
-        dmVMath::Matrix4 view = *dmScript::CheckMatrix4(L, 1);
+        dmVMath::Matrix4* matrix = 0;
+        uint64_t slot = 0;
+        if (IsRecording(i) && IsSlotName(L, 1))
+        {
+            slot = CheckRecordingSlot(L, i, 1, COMMAND_SLOT_TYPE_MATRIX4);
+        }
+        else
+        {
+            dmVMath::Matrix4 view = *dmScript::CheckMatrix4(L, 1);
+            matrix = new dmVMath::Matrix4;
+            *matrix = view;
+        }
 
-        dmVMath::Matrix4* matrix = new dmVMath::Matrix4;
-        *matrix = view;
-        if (InsertCommand(i, Command(COMMAND_TYPE_SET_VIEW, (uint64_t)matrix)))
+        if (InsertCommand(i, Command(COMMAND_TYPE_SET_VIEW, (uint64_t)matrix, slot)))
             return 0;
-        else
-            return luaL_error(L, "Command buffer is full (%d).", i->m_CommandBuffer.Capacity());
+        delete matrix;
+        return luaL_error(L, "Command buffer is full (%d).", i->m_CommandBuffer.Capacity());
     }
 
     /*# sets the projection matrix
@@ -1940,13 +2189,23 @@ namespace dmRender
     int RenderScript_SetProjection(lua_State* L)
     {
         RenderScriptInstance* i = RenderScriptInstance_Check(L);
-        dmVMath::Matrix4 projection = *dmScript::CheckMatrix4(L, 1);
-        dmVMath::Matrix4* matrix = new dmVMath::Matrix4;
-        *matrix = projection;
-        if (InsertCommand(i, Command(COMMAND_TYPE_SET_PROJECTION, (uint64_t)matrix)))
-            return 0;
+        dmVMath::Matrix4* matrix = 0;
+        uint64_t slot = 0;
+        if (IsRecording(i) && IsSlotName(L, 1))
+        {
+            slot = CheckRecordingSlot(L, i, 1, COMMAND_SLOT_TYPE_MATRIX4);
+        }
         else
-            return luaL_error(L, "Command buffer is full (%d).", i->m_CommandBuffer.Capacity());
+        {
+            dmVMath::Matrix4 projection = *dmScript::CheckMatrix4(L, 1);
+            matrix = new dmVMath::Matrix4;
+            *matrix = projection;
+        }
+
+        if (InsertCommand(i, Command(COMMAND_TYPE_SET_PROJECTION, (uint64_t)matrix, slot)))
+            return 0;
+        delete matrix;
+        return luaL_error(L, "Command buffer is full (%d).", i->m_CommandBuffer.Capacity());
     }
 
     /*#
@@ -2537,6 +2796,233 @@ namespace dmRender
         return 1;
     }
 
+    static void PushStats(lua_State* L, const dmGraphics::Stats& stats)
+    {
+        lua_pushinteger(L, stats.m_DrawCalls);
+        lua_setfield(L, -2, "draw_calls");
+        lua_pushinteger(L, stats.m_InstancedDrawCalls);
+        lua_setfield(L, -2, "instanced_draw_calls");
+        lua_pushinteger(L, stats.m_DispatchCalls);
+        lua_setfield(L, -2, "dispatch_calls");
+        lua_pushinteger(L, stats.m_ProgramChanges);
+        lua_setfield(L, -2, "program_changes");
+        lua_pushinteger(L, stats.m_TextureBinds);
+        lua_setfield(L, -2, "texture_binds");
+        lua_pushinteger(L, stats.m_ConstantUploads);
+        lua_setfield(L, -2, "constant_uploads");
+        lua_pushinteger(L, stats.m_VertexBytesUploaded);
+        lua_setfield(L, -2, "vertex_bytes");
+        lua_pushinteger(L, stats.m_IndexBytesUploaded);
+        lua_setfield(L, -2, "index_bytes");
+        lua_pushinteger(L, stats.m_TextureBytesUploaded);
+        lua_setfield(L, -2, "texture_bytes");
+    }
+
+    /*# gets the render statistics of the previous frame
+     *
+     * Returns the number of draw calls, state changes and bytes uploaded to the GPU
+     * during the previous frame, in total and for each predicate passed to `render.draw()`.
+     *
+     * @name render.get_stats
+     * @return stats [type:table] table with the following fields:
+     *
+     * `draw_calls`
+     * : [type:number] number of draw calls
+     *
+     * `instanced_draw_calls`
+     * : [type:number] number of draw calls with more than one instance
+     *
+     * `dispatch_calls`
+     * : [type:number] number of compute dispatches
+     *
+     * `program_changes`
+     * : [type:number] number of times a different shader program was enabled
+     *
+     * `texture_binds`
+     * : [type:number] number of texture binds
+     *
+     * `constant_uploads`
+     * : [type:number] number of shader constants set
+     *
+     * `vertex_bytes`, `index_bytes`, `texture_bytes`
+     * : [type:number] number of bytes uploaded to vertex buffers, index buffers and textures
+     *
+     * `predicates`
+     * : [type:table] a list with the same fields per predicate, and a `tags` list with the hashed tags of the predicate
+     *
+     * @examples
+     *
+     * Print the number of draw calls of each predicate
+     *
+     * ```lua
+     * local stats = render.get_stats()
+     * for _, p in ipairs(stats.predicates) do
+     *     print(p.tags[1], p.draw_calls)
+     * end
+     * ```
+     */
+    static int RenderScript_GetStats(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 1);
+        RenderScriptInstance* i = RenderScriptInstance_Check(L);
+        RenderContext* render_context = i->m_RenderContext;
+
+        lua_newtable(L);
+        PushStats(L, render_context->m_LastFrameStats);
+
+        const dmArray<PredicateStats>& predicate_stats = render_context->m_LastPredicateStats;
+        lua_createtable(L, predicate_stats.Size(), 0);
+        for (uint32_t p = 0; p < predicate_stats.Size(); ++p)
+        {
+            const PredicateStats& entry = predicate_stats[p];
+            lua_newtable(L);
+            PushStats(L, entry.m_Stats);
+
+            lua_createtable(L, entry.m_Predicate.m_TagCount, 0);
+            for (uint32_t t = 0; t < entry.m_Predicate.m_TagCount; ++t)
+            {
+                dmScript::PushHash(L, entry.m_Predicate.m_Tags[t]);
+                lua_rawseti(L, -2, t + 1);
+            }
+            lua_setfield(L, -2, "tags");
+
+            lua_rawseti(L, -2, p + 1);
+        }
+        lua_setfield(L, -2, "predicates");
+        return 1;
+    }
+
+    /*# enables dynamic resolution
+     *
+     * Starts to adjust the resolution scale to the GPU time of the frames. The scale is lowered when the
+     * frames take longer than the target on the GPU, and raised again when there is headroom. It is updated
+     * once per frame, before the render script update.
+     *
+     * The render script renders the scene into a render target of the scaled size, and then draws it
+     * to the window, e.g. with a full screen quad. Anything drawn after that, like the GUI, is drawn at
+     * the native resolution.
+     *
+     * The GPU time is only available with adapters that support GPU timers. Otherwise the scale stays at `max_scale`.
+     *
+     * @name render.enable_dynamic_resolution
+     * @param [options] [type:table] optional table with properties:
+     *
+     * `min_scale`
+     * : [type:number] the lowest scale. Default is 0.5.
+     *
+     * `max_scale`
+     * : [type:number] the highest scale. Default is 1.
+     *
+     * `target_gpu_time`
+     * : [type:number] the GPU time to stay below, in milliseconds. Default is 14.
+     *
+     * @examples
+     *
+     * Render the scene at a lower resolution when the GPU can't keep up, and the GUI at the native resolution
+     *
+     * ```lua
+     * function init(self)
+     *     render.enable_dynamic_resolution({ min_scale = 0.6, target_gpu_time = 15 })
+     *     self.scene_rt = render.render_target("scene", { ... })
+     * end
+     *
+     * function update(self)
+     *     local scale = render.get_resolution_scale()
+     *     local w = math.floor(render.get_window_width() * scale)
+     *     local h = math.floor(render.get_window_height() * scale)
+     *     if w ~= render.get_render_target_width(self.scene_rt, render.BUFFER_COLOR_BIT) then
+     *         render.set_render_target_size(self.scene_rt, w, h)
+     *     end
+     *
+     *     render.set_render_target(self.scene_rt)
+     *     render.set_viewport(0, 0, w, h)
+     *     -- draw the scene
+     *     render.set_render_target(render.RENDER_TARGET_DEFAULT)
+     *     render.set_viewport(0, 0, render.get_window_width(), render.get_window_height())
+     *     -- draw self.scene_rt with a full screen quad, then the GUI
+     * end
+     * ```
+     */
+    static int RenderScript_EnableDynamicResolution(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+        RenderScriptInstance* i = RenderScriptInstance_Check(L);
+
+        DynamicResolutionParams params;
+        if (lua_istable(L, 1))
+        {
+            lua_pushvalue(L, 1);
+
+            lua_getfield(L, -1, "min_scale");
+            params.m_MinScale = lua_isnil(L, -1) ? params.m_MinScale : (float) luaL_checknumber(L, -1);
+            lua_pop(L, 1);
+
+            lua_getfield(L, -1, "max_scale");
+            params.m_MaxScale = lua_isnil(L, -1) ? params.m_MaxScale : (float) luaL_checknumber(L, -1);
+            lua_pop(L, 1);
+
+            lua_getfield(L, -1, "target_gpu_time");
+            params.m_TargetGpuTime = lua_isnil(L, -1) ? params.m_TargetGpuTime : (float) luaL_checknumber(L, -1);
+            lua_pop(L, 1);
+
+            lua_pop(L, 1);
+        }
+
+        if (params.m_TargetGpuTime <= 0.0f)
+        {
+            return DM_LUA_ERROR("The target GPU time must be above 0");
+        }
+
+        EnableDynamicResolution(i->m_RenderContext, params);
+        return 0;
+    }
+
+    /*# disables dynamic resolution
+     *
+     * Stops adjusting the resolution scale, and sets it back to 1.
+     *
+     * @name render.disable_dynamic_resolution
+     */
+    static int RenderScript_DisableDynamicResolution(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+        RenderScriptInstance* i = RenderScriptInstance_Check(L);
+        DisableDynamicResolution(i->m_RenderContext);
+        return 0;
+    }
+
+    /*# gets the current resolution scale
+     *
+     * The scale to multiply the window size with when sizing the scene render target.
+     * It is 1 when dynamic resolution isn't enabled. See `render.enable_dynamic_resolution()`.
+     *
+     * @name render.get_resolution_scale
+     * @return scale [type:number] the resolution scale
+     */
+    static int RenderScript_GetResolutionScale(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 1);
+        RenderScriptInstance* i = RenderScriptInstance_Check(L);
+        lua_pushnumber(L, GetResolutionScale(i->m_RenderContext));
+        return 1;
+    }
+
+    /*# invalidates the render
+     *
+     * Makes the engine render the next frame when the game is rendered on demand (see `engine.render_on_demand`
+     * in the game.project file). Call it from the render script when it animates anything by itself.
+     * Game scripts can instead post any message to the render script, e.g. `msg.post("@render:", "invalidate")`.
+     *
+     * @name render.invalidate
+     */
+    static int RenderScript_Invalidate(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+        RenderScriptInstance* i = RenderScriptInstance_Check(L);
+        InvalidateRender(i->m_RenderContext);
+        return 0;
+    }
+
     /*# creates a new render predicate
      *
      * This function returns a new render predicate for objects with materials matching
@@ -2856,7 +3342,11 @@ namespace dmRender
             lua_pushvalue(L, 4);
 
             lua_getfield(L, -1, "constants");
-            constant_buffer = lua_isnil(L, -1) ? 0 : *RenderScriptConstantBuffer_Check(L, -1);
+            if (!lua_isnil(L, -1))
+            {
+                constant_buffer = *RenderScriptConstantBuffer_Check(L, -1);
+                AddRecordingReference(L, i, -1);
+            }
             lua_pop(L, 1);
 
             lua_pop(L, 1);
@@ -2868,8 +3358,289 @@ namespace dmRender
         }
         return DM_LUA_ERROR("Command buffer is full (%d).", i->m_CommandBuffer.Capacity());
     }
+
+    /*# dispatches the currently enabled compute program, with group counts from a GPU buffer
+     * Dispatches the currently enabled compute program, like [ref:render.dispatch_compute], but the 'global working group'
+     * is read by the GPU from a buffer, as three 32 bit integers x, y and z. The buffer is typically written by an earlier
+     * compute dispatch, so that the size of the work never has to be read back by the CPU.
+     * The buffer handle comes from a native extension.
+     *
+     * @name render.dispatch_compute_indirect
+     * @param buffer [type:userdata] the GPU buffer holding the group counts
+     * @param [options] [type:table] optional table with properties:
+     *
+     * `offset`
+     * : [type:integer] the byte offset of the group counts in the buffer, a multiple of 4. default=0
+     *
+     * `constants`
+     * : [type:constant_buffer] optional constants to use while rendering
+     *
+     * @examples
+     *
+     * ```lua
+     * function update(self, dt)
+     *     -- the first pass compacts the live particles, and writes the group counts for the second pass
+     *     render.set_compute("compact_particles")
+     *     render.dispatch_compute(256, 1, 1)
+     *     render.set_compute("simulate_particles")
+     *     render.dispatch_compute_indirect(self.particle_args)
+     *     render.set_compute()
+     * end
+     * ```
+     */
+    static int RenderScript_DispatchIndirect(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+        RenderScriptInstance* i = RenderScriptInstance_Check(L);
+
+        CHECK_COMPUTE_SUPPORT(i);
+        if (!dmGraphics::IsComputeIndirectSupported(i->m_RenderContext->m_GraphicsContext))
+        {
+            return DM_LUA_ERROR("Indirect compute dispatches are not supported on this device or platform.");
+        }
+
+        dmGraphics::HVertexBuffer indirect_buffer = CheckIndirectBuffer(L, 1);
+        uint32_t offset = 0;
+        HNamedConstantBuffer constant_buffer = 0;
+
+        if (lua_istable(L, 2))
+        {
+            lua_pushvalue(L, 2);
+
+            lua_getfield(L, -1, "offset");
+            offset = CheckIndirectOffset(L, -1);
+            lua_pop(L, 1);
+
+            lua_getfield(L, -1, "constants");
+            if (!lua_isnil(L, -1))
+            {
+                constant_buffer = *RenderScriptConstantBuffer_Check(L, -1);
+                AddRecordingReference(L, i, -1);
+            }
+            lua_pop(L, 1);
+
+            lua_pop(L, 1);
+        }
+
+        if (InsertCommand(i, Command(COMMAND_TYPE_DISPATCH_COMPUTE_INDIRECT, (uint64_t) indirect_buffer, offset, (uint64_t) constant_buffer)))
+        {
+            return 0;
+        }
+        return DM_LUA_ERROR("Command buffer is full (%d).", i->m_CommandBuffer.Capacity());
+    }
 #undef CHECK_COMPUTE_SUPPORT
 
+    /*# starts recording a command list
+     *
+     * Starts recording the render commands into a command list, instead of running them this frame.
+     * The list is returned by `render.end_recording()`, and can then be replayed any number of times with `render.replay()`.
+     * Since the commands are replayed without calling into Lua, this saves time for render scripts that issue the same
+     * commands each frame.
+     *
+     * While recording, the view and projection matrices, the `frustum` and the `constants` of `render.draw()`, and the
+     * `frustum` of `render.draw_debug3d()` may be given as names (strings or hashes) instead of values. Those are parameters,
+     * which are given each time the list is replayed.
+     *
+     * The recording must end within the same function call of the render script (e.g. within `init()`).
+     * Render targets, materials and compute programs used by the commands must stay valid for as long as the list is used.
+     *
+     * @name render.begin_recording
+     * @examples
+     *
+     * ```lua
+     * function init(self)
+     *     self.tile_pred = render.predicate({"tile"})
+     *     self.gui_pred = render.predicate({"gui"})
+     *
+     *     render.begin_recording()
+     *     render.set_view("view")
+     *     render.set_projection("projection")
+     *     render.enable_state(graphics.STATE_BLEND)
+     *     render.draw(self.tile_pred, {frustum = "frustum"})
+     *     render.disable_state(graphics.STATE_BLEND)
+     *     self.world_pass = render.end_recording()
+     * end
+     *
+     * function update(self)
+     *     render.replay(self.world_pass, {view = self.view, projection = self.projection, frustum = self.projection * self.view})
+     * end
+     * ```
+     */
+    static int RenderScript_BeginRecording(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+        RenderScriptInstance* i = RenderScriptInstance_Check(L);
+        if (IsRecording(i))
+            return DM_LUA_ERROR("Already recording a command list.");
+
+        lua_newtable(L);
+        i->m_RecordingReference = dmScript::Ref(L, LUA_REGISTRYINDEX);
+        i->m_RecordingStart = i->m_CommandBuffer.Size();
+        i->m_RecordingSlots.SetSize(0);
+        return 0;
+    }
+
+    /*# ends recording a command list
+     *
+     * Ends the recording started with `render.begin_recording()`, and returns the recorded commands.
+     * None of the recorded commands are run this frame.
+     *
+     * @name render.end_recording
+     * @return list [type:command_list] the recorded command list
+     */
+    static int RenderScript_EndRecording(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 1);
+        RenderScriptInstance* i = RenderScriptInstance_Check(L);
+        if (!IsRecording(i))
+            return DM_LUA_ERROR("Not recording a command list, call render.begin_recording() first.");
+
+        RenderScriptCommandList* list = (RenderScriptCommandList*)lua_newuserdata(L, sizeof(RenderScriptCommandList));
+        new (list) RenderScriptCommandList;
+
+        // The list takes over the commands, and their data
+        uint32_t start = i->m_RecordingStart;
+        uint32_t count = i->m_CommandBuffer.Size() - start;
+        list->m_Commands.SetCapacity(count);
+        list->m_Commands.SetSize(count);
+        if (count > 0)
+            memcpy(list->m_Commands.Begin(), i->m_CommandBuffer.Begin() + start, count * sizeof(Command));
+        i->m_CommandBuffer.SetSize(start);
+
+        uint32_t slot_count = i->m_RecordingSlots.Size();
+        list->m_Slots.SetCapacity(slot_count);
+        list->m_Slots.SetSize(slot_count);
+        if (slot_count > 0)
+            memcpy(list->m_Slots.Begin(), i->m_RecordingSlots.Begin(), slot_count * sizeof(CommandSlot));
+        i->m_RecordingSlots.SetSize(0);
+
+        list->m_Reference = i->m_RecordingReference;
+        i->m_RecordingReference = LUA_NOREF;
+
+        luaL_getmetatable(L, RENDER_SCRIPT_COMMAND_LIST);
+        lua_setmetatable(L, -2);
+        return 1;
+    }
+
+    /*# replays a recorded command list
+     *
+     * Adds the commands of a list recorded with `render.begin_recording()` and `render.end_recording()` to this frame,
+     * as if they had been called at this point in the render script.
+     *
+     * @name render.replay
+     * @param list [type:command_list] the command list
+     * @param [parameters] [type:table] the values of the parameters used when recording, by name:
+     *
+     * - matrices [type:matrix4] for `render.set_view()`, `render.set_projection()` and the `frustum` options
+     * - constant buffers [type:constant_buffer] for the `constants` option of `render.draw()`
+     *
+     * @examples
+     *
+     * ```lua
+     * render.replay(self.world_pass, {view = self.view, projection = self.projection, frustum = self.projection * self.view})
+     * ```
+     */
+    static int RenderScript_Replay(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+        RenderScriptInstance* i = RenderScriptInstance_Check(L);
+        RenderScriptCommandList* list = RenderScriptCommandList_Check(L, 1);
+        if (IsRecording(i))
+            return DM_LUA_ERROR("Command lists can't be replayed while recording.");
+
+        uint32_t command_count = list->m_Commands.Size();
+        if (i->m_CommandBuffer.Remaining() < command_count)
+            return DM_LUA_ERROR("Command buffer is full (%d).", i->m_CommandBuffer.Capacity());
+
+        // Look up the parameters once
+        const dmVMath::Matrix4* matrices[MAX_COMMAND_SLOT_COUNT];
+        HNamedConstantBuffer constant_buffers[MAX_COMMAND_SLOT_COUNT];
+        uint32_t slot_count = list->m_Slots.Size();
+        if (slot_count > 0)
+        {
+            luaL_checktype(L, 2, LUA_TTABLE);
+            memset(matrices, 0, sizeof(matrices));
+            memset(constant_buffers, 0, sizeof(constant_buffers));
+
+            lua_pushnil(L);
+            while (lua_next(L, 2) != 0)
+            {
+                dmhash_t name = 0;
+                if (lua_type(L, -2) == LUA_TSTRING)
+                    name = dmHashString64(lua_tostring(L, -2));
+                else if (dmScript::IsHash(L, -2))
+                    name = *dmScript::ToHash(L, -2);
+
+                for (uint32_t s = 0; name && s < slot_count; ++s)
+                {
+                    if (list->m_Slots[s].m_Name != name)
+                        continue;
+                    if (list->m_Slots[s].m_Type == COMMAND_SLOT_TYPE_MATRIX4)
+                        matrices[s] = dmScript::CheckMatrix4(L, -1);
+                    else
+                        constant_buffers[s] = *RenderScriptConstantBuffer_Check(L, -1);
+                    break;
+                }
+                lua_pop(L, 1);
+            }
+
+            for (uint32_t s = 0; s < slot_count; ++s)
+            {
+                if (!matrices[s] && !constant_buffers[s])
+                    return DM_LUA_ERROR("No value given for the parameter '%s'.", dmHashReverseSafe64(list->m_Slots[s].m_Name));
+            }
+        }
+
+        // The commands are copied, since running them frees their data
+        for (uint32_t c = 0; c < command_count; ++c)
+        {
+            Command command = list->m_Commands[c];
+            switch (command.m_Type)
+            {
+                case COMMAND_TYPE_SET_VIEW:
+                case COMMAND_TYPE_SET_PROJECTION:
+                {
+                    uint64_t slot = command.m_Operands[1];
+                    const dmVMath::Matrix4* src = slot ? matrices[slot - 1] : (const dmVMath::Matrix4*)command.m_Operands[0];
+                    dmVMath::Matrix4* matrix = new dmVMath::Matrix4;
+                    *matrix = *src;
+                    command.m_Operands[0] = (uint64_t)matrix;
+                } break;
+                case COMMAND_TYPE_DRAW:
+                {
+                    uint64_t frustum_slot = command.m_Operands[3] & 0xffff;
+                    uint64_t constant_buffer_slot = command.m_Operands[3] >> 16;
+                    if (command.m_Operands[2])
+                    {
+                        FrustumOptions* frustum_options = new FrustumOptions;
+                        *frustum_options = *(const FrustumOptions*)command.m_Operands[2];
+                        if (frustum_slot)
+                            frustum_options->m_Matrix = *matrices[frustum_slot - 1];
+                        command.m_Operands[2] = (uint64_t)frustum_options;
+                    }
+                    if (constant_buffer_slot)
+                        command.m_Operands[1] = (uint64_t)constant_buffers[constant_buffer_slot - 1];
+                } break;
+                case COMMAND_TYPE_DRAW_DEBUG3D:
+                {
+                    uint64_t frustum_slot = command.m_Operands[1];
+                    if (command.m_Operands[0])
+                    {
+                        FrustumOptions* frustum_options = new FrustumOptions;
+                        *frustum_options = *(const FrustumOptions*)command.m_Operands[0];
+                        if (frustum_slot)
+                            frustum_options->m_Matrix = *matrices[frustum_slot - 1];
+                        command.m_Operands[0] = (uint64_t)frustum_options;
+                    }
+                } break;
+                default:
+                    break;
+            }
+            i->m_CommandBuffer.Push(command);
+        }
+        return 0;
+    }
+
     static const luaL_reg Render_methods[] =
     {
         {"enable_state",                    RenderScript_EnableState},
@@ -2898,19 +3669,29 @@ namespace dmRender
         {"set_cull_face",                   RenderScript_SetCullFace},
         {"set_polygon_offset",              RenderScript_SetPolygonOffset},
         {"draw",                            RenderScript_Draw},
+        {"draw_indirect",                   RenderScript_DrawIndirect},
         {"draw_debug3d",                    RenderScript_DrawDebug3d},
         {"draw_debug2d",                    RenderScript_DrawDebug2d},
         {"get_width",                       RenderScript_GetWidth},
         {"get_height",                      RenderScript_GetHeight},
         {"get_window_width",                RenderScript_GetWindowWidth},
         {"get_window_height",               RenderScript_GetWindowHeight},
+        {"get_stats",                       RenderScript_GetStats},
+        {"enable_dynamic_resolution",       RenderScript_EnableDynamicResolution},
+        {"disable_dynamic_resolution",      RenderScript_DisableDynamicResolution},
+        {"get_resolution_scale",            RenderScript_GetResolutionScale},
+        {"invalidate",                      RenderScript_Invalidate},
         {"predicate",                       RenderScript_Predicate},
         {"constant_buffer",                 RenderScript_ConstantBuffer},
         {"enable_material",                 RenderScript_EnableMaterial},
         {"disable_material",                RenderScript_DisableMaterial},
         {"set_compute",                     RenderScript_SetCompute},
         {"dispatch_compute",                RenderScript_Dispatch},
+        {"dispatch_compute_indirect",       RenderScript_DispatchIndirect},
         {"set_camera",                      RenderScript_SetCamera},
+        {"begin_recording",                 RenderScript_BeginRecording},
+        {"end_recording",                   RenderScript_EndRecording},
+        {"replay",                          RenderScript_Replay},
         {0, 0}
     };
 
@@ -2934,6 +3715,8 @@ namespace dmRender
 
         RENDER_SCRIPT_CONSTANTBUFFER_ARRAY_TYPE_HASH = dmScript::RegisterUserType(L, RENDER_SCRIPT_CONSTANTBUFFER_ARRAY, RenderScriptConstantBuffer_methods, RenderScriptConstantBufferArray_meta);
 
+        RENDER_SCRIPT_COMMAND_LIST_TYPE_HASH = dmScript::RegisterUserType(L, RENDER_SCRIPT_COMMAND_LIST, RenderScriptCommandList_methods, RenderScriptCommandList_meta);
+
         luaL_register(L, RENDER_SCRIPT_LIB_NAME, Render_methods);
 
         ////////////////////////////////////////////////////////////////////
@@ -3228,6 +4011,7 @@ bail:
         render_script_instance->m_InstanceReference = LUA_NOREF;
         render_script_instance->m_RenderScriptDataReference = LUA_NOREF;
         render_script_instance->m_ContextTableReference = LUA_NOREF;
+        render_script_instance->m_RecordingReference = LUA_NOREF;
     }
 
     HRenderScriptInstance NewRenderScriptInstance(dmRender::HRenderContext render_context, HRenderScript render_script)
@@ -3284,6 +4068,7 @@ bail:
         dmScript::Unref(L, LUA_REGISTRYINDEX, render_script_instance->m_InstanceReference);
         dmScript::Unref(L, LUA_REGISTRYINDEX, render_script_instance->m_RenderScriptDataReference);
         dmScript::Unref(L, LUA_REGISTRYINDEX, render_script_instance->m_ContextTableReference);
+        CancelRecording(L, render_script_instance);
 
         assert(top == lua_gettop(L));
 
@@ -3351,7 +4136,7 @@ bail:
                     // TODO: setjmp/longjmp here... how to handle?!!! We are not running "from lua" here
                     // lua_cpcall?
                     message_name = descriptor->m_Name;
-                    dmScript::PushDDF(L, descriptor, (const char*)message->m_Data, true);
+                    dmScript::PushDDF(L, descriptor, (const char*)dmMessage::GetData(message), true);
                 }
                 else
                 {
@@ -3362,7 +4147,7 @@ bail:
                     }
                     if (message->m_DataSize > 0)
                     {
-                        dmScript::PushTable(L, (const char*)message->m_Data, message->m_DataSize);
+                        dmScript::PushTable(L, (const char*)dmMessage::GetData(message), message->m_DataSize);
                     }
                     else
                     {
@@ -3390,6 +4175,12 @@ bail:
                 }
             }
 
+            if (IsRecording(script_instance))
+            {
+                dmLogError("The command list recording in '%s' wasn't ended with render.end_recording(), and is discarded.", RENDER_SCRIPT_FUNCTION_NAMES[script_function]);
+                CancelRecording(L, script_instance);
+            }
+
             lua_pushnil(L);
             dmScript::SetInstance(L);
 
@@ -3410,10 +4201,18 @@ bail:
         RenderScriptResult m_Result;
     };
 
+    // Posted by the cameras every frame, and they invalidate the render themselves when it changes
+    static const dmhash_t SET_VIEW_PROJECTION_MESSAGE_ID = dmHashString64("set_view_projection");
+
     void DispatchCallback(dmMessage::Message *message, void* user_ptr)
     {
         DispatchContext* context = (DispatchContext*)user_ptr;
         HRenderScriptInstance instance = context->m_Instance;
+        // Any other message may change what is drawn (see InvalidateRender)
+        if (message->m_Id != SET_VIEW_PROJECTION_MESSAGE_ID)
+        {
+            InvalidateRender(instance->m_RenderContext);
+        }
         if (message->m_Descriptor != 0)
         {
             dmDDF::Descriptor* descriptor = (dmDDF::Descriptor*)message->m_Descriptor;
@@ -62,7 +62,10 @@ namespace dmRender
         RenderContext*                m_RenderContext;
         HRenderScript                 m_RenderScript;
         dmScript::ScriptWorld*        m_ScriptWorld;
+        dmArray<CommandSlot>          m_RecordingSlots;
         uint32_t                      m_PredicateCount;
+        uint32_t                      m_RecordingStart;     // The first command of the current recording in m_CommandBuffer
+        int                           m_RecordingReference; // Keeps the Lua objects used by the recorded commands alive. LUA_NOREF when not recording
         int                           m_InstanceReference;
         int                           m_RenderScriptDataReference;
         int                           m_ContextTableReference;
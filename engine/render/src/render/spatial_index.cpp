@@ -0,0 +1,576 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <assert.h>
+#include <string.h>
+
+#include <dlib/array.h>
+#include <dlib/math.h>
+#include <dlib/profile.h>
+#include <dlib/job_thread.h>
+
+#include "render.h"
+
+// A dynamic bounding volume tree, kept balanced by tree rotations on insertion and removal
+// (the same approach as the b2DynamicTree in Box2D).
+
+namespace dmRender
+{
+    static const int32_t  NULL_NODE = -1;
+    // Max depth of the traversal stack. The tree is balanced, so this is way past any height we'll see.
+    static const uint32_t SPATIAL_INDEX_STACK_SIZE = 256;
+    // Below this many proxies, distributing the culling over the job threads isn't worth it
+    static const uint32_t SPATIAL_INDEX_PARALLEL_THRESHOLD = 4096;
+    static const uint32_t SPATIAL_INDEX_MAX_TASKS = 64;
+
+    struct SpatialAabb
+    {
+        float m_Min[3];
+        float m_Max[3];
+    };
+
+    struct SpatialNode
+    {
+        SpatialAabb m_Bounds;   // Enlarged by the margin for leaves, union of the children otherwise
+        int32_t     m_Parent;   // Next free node, if the node isn't used
+        int32_t     m_Child1;
+        int32_t     m_Child2;
+        int32_t     m_Height;   // 0 for leaves, -1 for free nodes
+    };
+
+    struct SpatialIndex
+    {
+        dmArray<SpatialNode>    m_Nodes;
+        dmArray<SpatialAabb>    m_LeafBounds;   // The actual bounds of the leaves
+        dmArray<uint32_t>       m_VisibleStamps;// A leaf is visible if the stamp equals the current cull stamp
+        dmArray<int32_t>        m_Tasks;        // Subtrees to cull in parallel
+        const dmIntersection::Frustum* m_Frustum;
+        float                   m_Margin;
+        int32_t                 m_Root;
+        int32_t                 m_FreeList;
+        uint32_t                m_ProxyCount;
+        uint32_t                m_CullStamp;
+    };
+
+    enum FrustumTestResult
+    {
+        FRUSTUM_OUTSIDE   = 0,
+        FRUSTUM_INTERSECT = 1,
+        FRUSTUM_INSIDE    = 2,
+    };
+
+    static inline SpatialAabb MakeAabb(const dmVMath::Point3& min, const dmVMath::Point3& max, float margin)
+    {
+        SpatialAabb aabb;
+        aabb.m_Min[0] = min.getX() - margin;
+        aabb.m_Min[1] = min.getY() - margin;
+        aabb.m_Min[2] = min.getZ() - margin;
+        aabb.m_Max[0] = max.getX() + margin;
+        aabb.m_Max[1] = max.getY() + margin;
+        aabb.m_Max[2] = max.getZ() + margin;
+        return aabb;
+    }
+
+    static inline SpatialAabb Combine(const SpatialAabb& a, const SpatialAabb& b)
+    {
+        SpatialAabb aabb;
+        for (int i = 0; i < 3; ++i)
+        {
+            aabb.m_Min[i] = dmMath::Min(a.m_Min[i], b.m_Min[i]);
+            aabb.m_Max[i] = dmMath::Max(a.m_Max[i], b.m_Max[i]);
+        }
+        return aabb;
+    }
+
+    static inline bool Contains(const SpatialAabb& outer, const SpatialAabb& inner)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (inner.m_Min[i] < outer.m_Min[i] || inner.m_Max[i] > outer.m_Max[i])
+                return false;
+        }
+        return true;
+    }
+
+    // Surface area (times 0.5), used as the cost when finding where to insert a leaf
+    static inline float GetArea(const SpatialAabb& aabb)
+    {
+        float dx = aabb.m_Max[0] - aabb.m_Min[0];
+        float dy = aabb.m_Max[1] - aabb.m_Min[1];
+        float dz = aabb.m_Max[2] - aabb.m_Min[2];
+        return dx * dy + dy * dz + dz * dx;
+    }
+
+    static FrustumTestResult TestFrustumAabb(const dmIntersection::Frustum& frustum, const SpatialAabb& aabb)
+    {
+        FrustumTestResult result = FRUSTUM_INSIDE;
+        for (int i = 0; i < frustum.m_NumPlanes; ++i)
+        {
+            const dmIntersection::Plane& plane = frustum.m_Planes[i];
+            float nx = plane.getX();
+            float ny = plane.getY();
+            float nz = plane.getZ();
+            // The corner furthest along the (inward) plane normal, and the one furthest against it
+            float d_max = plane.getW() + nx * (nx > 0 ? aabb.m_Max[0] : aabb.m_Min[0])
+                                       + ny * (ny > 0 ? aabb.m_Max[1] : aabb.m_Min[1])
+                                       + nz * (nz > 0 ? aabb.m_Max[2] : aabb.m_Min[2]);
+            if (d_max < 0)
+                return FRUSTUM_OUTSIDE;
+            float d_min = plane.getW() + nx * (nx > 0 ? aabb.m_Min[0] : aabb.m_Max[0])
+                                       + ny * (ny > 0 ? aabb.m_Min[1] : aabb.m_Max[1])
+                                       + nz * (nz > 0 ? aabb.m_Min[2] : aabb.m_Max[2]);
+            if (d_min < 0)
+                result = FRUSTUM_INTERSECT;
+        }
+        return result;
+    }
+
+    static int32_t AllocNode(SpatialIndex* index)
+    {
+        if (index->m_FreeList == NULL_NODE)
+        {
+            uint32_t old_capacity = index->m_Nodes.Capacity();
+            uint32_t capacity = dmMath::Max(16U, old_capacity * 2);
+            index->m_Nodes.SetCapacity(capacity);
+            index->m_Nodes.SetSize(capacity);
+            index->m_LeafBounds.SetCapacity(capacity);
+            index->m_LeafBounds.SetSize(capacity);
+            index->m_VisibleStamps.SetCapacity(capacity);
+            index->m_VisibleStamps.SetSize(capacity);
+
+            for (uint32_t i = old_capacity; i < capacity; ++i)
+            {
+                index->m_Nodes[i].m_Parent = i + 1 < capacity ? (int32_t)(i + 1) : NULL_NODE;
+                index->m_Nodes[i].m_Height = -1;
+                index->m_VisibleStamps[i] = 0;
+            }
+            index->m_FreeList = old_capacity;
+        }
+
+        int32_t node_index = index->m_FreeList;
+        SpatialNode& node = index->m_Nodes[node_index];
+        index->m_FreeList = node.m_Parent;
+        node.m_Parent = NULL_NODE;
+        node.m_Child1 = NULL_NODE;
+        node.m_Child2 = NULL_NODE;
+        node.m_Height = 0;
+        index->m_VisibleStamps[node_index] = 0;
+        return node_index;
+    }
+
+    static void FreeNode(SpatialIndex* index, int32_t node_index)
+    {
+        SpatialNode& node = index->m_Nodes[node_index];
+        node.m_Parent = index->m_FreeList;
+        node.m_Height = -1;
+        index->m_FreeList = node_index;
+    }
+
+    // Rotates the subtree at node A if it is unbalanced, and returns the new root of the subtree
+    static int32_t Balance(SpatialIndex* index, int32_t iA)
+    {
+        SpatialNode* nodes = index->m_Nodes.Begin();
+        SpatialNode* A = &nodes[iA];
+        if (A->m_Height < 2)
+            return iA;
+
+        int32_t iB = A->m_Child1;
+        int32_t iC = A->m_Child2;
+        SpatialNode* B = &nodes[iB];
+        SpatialNode* C = &nodes[iC];
+
+        int32_t balance = C->m_Height - B->m_Height;
+
+        // Rotate C up
+        if (balance > 1)
+        {
+            int32_t iF = C->m_Child1;
+            int32_t iG = C->m_Child2;
+            SpatialNode* F = &nodes[iF];
+            SpatialNode* G = &nodes[iG];
+
+            C->m_Child1 = iA;
+            C->m_Parent = A->m_Parent;
+            A->m_Parent = iC;
+
+            if (C->m_Parent != NULL_NODE)
+            {
+                SpatialNode* parent = &nodes[C->m_Parent];
+                if (parent->m_Child1 == iA)
+                    parent->m_Child1 = iC;
+                else
+                    parent->m_Child2 = iC;
+            }
+            else
+            {
+                index->m_Root = iC;
+            }
+
+            if (F->m_Height > G->m_Height)
+            {
+                C->m_Child2 = iF;
+                A->m_Child2 = iG;
+                G->m_Parent = iA;
+                A->m_Bounds = Combine(B->m_Bounds, G->m_Bounds);
+                C->m_Bounds = Combine(A->m_Bounds, F->m_Bounds);
+                A->m_Height = 1 + dmMath::Max(B->m_Height, G->m_Height);
+                C->m_Height = 1 + dmMath::Max(A->m_Height, F->m_Height);
+            }
+            else
+            {
+                C->m_Child2 = iG;
+                A->m_Child2 = iF;
+                F->m_Parent = iA;
+                A->m_Bounds = Combine(B->m_Bounds, F->m_Bounds);
+                C->m_Bounds = Combine(A->m_Bounds, G->m_Bounds);
+                A->m_Height = 1 + dmMath::Max(B->m_Height, F->m_Height);
+                C->m_Height = 1 + dmMath::Max(A->m_Height, G->m_Height);
+            }
+            return iC;
+        }
+
+        // Rotate B up
+        if (balance < -1)
+        {
+            int32_t iD = B->m_Child1;
+            int32_t iE = B->m_Child2;
+            SpatialNode* D = &nodes[iD];
+            SpatialNode* E = &nodes[iE];
+
+            B->m_Child1 = iA;
+            B->m_Parent = A->m_Parent;
+            A->m_Parent = iB;
+
+            if (B->m_Parent != NULL_NODE)
+            {
+                SpatialNode* parent = &nodes[B->m_Parent];
+                if (parent->m_Child1 == iA)
+                    parent->m_Child1 = iB;
+                else
+                    parent->m_Child2 = iB;
+            }
+            else
+            {
+                index->m_Root = iB;
+            }
+
+            if (D->m_Height > E->m_Height)
+            {
+                B->m_Child2 = iD;
+                A->m_Child1 = iE;
+                E->m_Parent = iA;
+                A->m_Bounds = Combine(C->m_Bounds, E->m_Bounds);
+                B->m_Bounds = Combine(A->m_Bounds, D->m_Bounds);
+                A->m_Height = 1 + dmMath::Max(C->m_Height, E->m_Height);
+                B->m_Height = 1 + dmMath::Max(A->m_Height, D->m_Height);
+            }
+            else
+            {
+                B->m_Child2 = iE;
+                A->m_Child1 = iD;
+                D->m_Parent = iA;
+                A->m_Bounds = Combine(C->m_Bounds, D->m_Bounds);
+                B->m_Bounds = Combine(A->m_Bounds, E->m_Bounds);
+                A->m_Height = 1 + dmMath::Max(C->m_Height, D->m_Height);
+                B->m_Height = 1 + dmMath::Max(A->m_Height, E->m_Height);
+            }
+            return iB;
+        }
+
+        return iA;
+    }
+
+    // Refits the bounds and heights from the node up to the root, balancing on the way
+    static void Refit(SpatialIndex* index, int32_t node_index)
+    {
+        while (node_index != NULL_NODE)
+        {
+            node_index = Balance(index, node_index);
+
+            SpatialNode* nodes = index->m_Nodes.Begin();
+            SpatialNode& node = nodes[node_index];
+            const SpatialNode& child1 = nodes[node.m_Child1];
+            const SpatialNode& child2 = nodes[node.m_Child2];
+            node.m_Height = 1 + dmMath::Max(child1.m_Height, child2.m_Height);
+            node.m_Bounds = Combine(child1.m_Bounds, child2.m_Bounds);
+
+            node_index = node.m_Parent;
+        }
+    }
+
+    static void InsertLeaf(SpatialIndex* index, int32_t leaf)
+    {
+        if (index->m_Root == NULL_NODE)
+        {
+            index->m_Root = leaf;
+            index->m_Nodes[leaf].m_Parent = NULL_NODE;
+            return;
+        }
+
+        // Find the best sibling, by the increase in surface area of the tree
+        const SpatialAabb leaf_bounds = index->m_Nodes[leaf].m_Bounds;
+        int32_t sibling = index->m_Root;
+        while (index->m_Nodes[sibling].m_Height > 0)
+        {
+            const SpatialNode& node = index->m_Nodes[sibling];
+            float area = GetArea(node.m_Bounds);
+            float combined_area = GetArea(Combine(node.m_Bounds, leaf_bounds));
+
+            // Cost of creating a new parent for this node and the new leaf
+            float cost = 2.0f * combined_area;
+            // Minimum cost of pushing the leaf further down the tree
+            float inheritance_cost = 2.0f * (combined_area - area);
+
+            float child_costs[2];
+            int32_t children[2] = { node.m_Child1, node.m_Child2 };
+            for (int i = 0; i < 2; ++i)
+            {
+                const SpatialNode& child = index->m_Nodes[children[i]];
+                float child_area = GetArea(Combine(leaf_bounds, child.m_Bounds));
+                if (child.m_Height > 0)
+                    child_area -= GetArea(child.m_Bounds);
+                child_costs[i] = child_area + inheritance_cost;
+            }
+
+            if (cost < child_costs[0] && cost < child_costs[1])
+                break;
+
+            sibling = child_costs[0] < child_costs[1] ? children[0] : children[1];
+        }
+
+        int32_t new_parent = AllocNode(index); // May reallocate the nodes
+        SpatialNode* nodes = index->m_Nodes.Begin();
+        int32_t old_parent = nodes[sibling].m_Parent;
+        nodes[new_parent].m_Parent = old_parent;
+        nodes[new_parent].m_Bounds = Combine(leaf_bounds, nodes[sibling].m_Bounds);
+        nodes[new_parent].m_Height = nodes[sibling].m_Height + 1;
+        nodes[new_parent].m_Child1 = sibling;
+        nodes[new_parent].m_Child2 = leaf;
+        nodes[sibling].m_Parent = new_parent;
+        nodes[leaf].m_Parent = new_parent;
+
+        if (old_parent != NULL_NODE)
+        {
+            if (nodes[old_parent].m_Child1 == sibling)
+                nodes[old_parent].m_Child1 = new_parent;
+            else
+                nodes[old_parent].m_Child2 = new_parent;
+        }
+        else
+        {
+            index->m_Root = new_parent;
+        }
+
+        Refit(index, nodes[leaf].m_Parent);
+    }
+
+    static void RemoveLeaf(SpatialIndex* index, int32_t leaf)
+    {
+        if (leaf == index->m_Root)
+        {
+            index->m_Root = NULL_NODE;
+            return;
+        }
+
+        SpatialNode* nodes = index->m_Nodes.Begin();
+        int32_t parent = nodes[leaf].m_Parent;
+        int32_t grand_parent = nodes[parent].m_Parent;
+        int32_t sibling = nodes[parent].m_Child1 == leaf ? nodes[parent].m_Child2 : nodes[parent].m_Child1;
+
+        FreeNode(index, parent);
+        nodes[sibling].m_Parent = grand_parent;
+
+        if (grand_parent != NULL_NODE)
+        {
+            if (nodes[grand_parent].m_Child1 == parent)
+                nodes[grand_parent].m_Child1 = sibling;
+            else
+                nodes[grand_parent].m_Child2 = sibling;
+            Refit(index, grand_parent);
+        }
+        else
+        {
+            index->m_Root = sibling;
+        }
+    }
+
+    HSpatialIndex NewSpatialIndex(float margin)
+    {
+        SpatialIndex* index = new SpatialIndex;
+        index->m_Frustum = 0;
+        index->m_Margin = margin;
+        index->m_Root = NULL_NODE;
+        index->m_FreeList = NULL_NODE;
+        index->m_ProxyCount = 0;
+        index->m_CullStamp = 1;
+        return index;
+    }
+
+    void DeleteSpatialIndex(HSpatialIndex index)
+    {
+        delete index;
+    }
+
+    uint32_t AddSpatialProxy(HSpatialIndex index, const dmVMath::Point3& min, const dmVMath::Point3& max)
+    {
+        int32_t leaf = AllocNode(index);
+        index->m_LeafBounds[leaf] = MakeAabb(min, max, 0.0f);
+        index->m_Nodes[leaf].m_Bounds = MakeAabb(min, max, index->m_Margin);
+        InsertLeaf(index, leaf);
+        index->m_ProxyCount++;
+        return (uint32_t)leaf;
+    }
+
+    void RemoveSpatialProxy(HSpatialIndex index, uint32_t proxy)
+    {
+        assert(proxy < index->m_Nodes.Size() && index->m_Nodes[proxy].m_Height == 0);
+        RemoveLeaf(index, (int32_t)proxy);
+        FreeNode(index, (int32_t)proxy);
+        index->m_ProxyCount--;
+    }
+
+    bool UpdateSpatialProxy(HSpatialIndex index, uint32_t proxy, const dmVMath::Point3& min, const dmVMath::Point3& max)
+    {
+        assert(proxy < index->m_Nodes.Size() && index->m_Nodes[proxy].m_Height == 0);
+        SpatialAabb bounds = MakeAabb(min, max, 0.0f);
+        index->m_LeafBounds[proxy] = bounds;
+
+        if (Contains(index->m_Nodes[proxy].m_Bounds, bounds))
+            return false;
+
+        RemoveLeaf(index, (int32_t)proxy);
+        index->m_Nodes[proxy].m_Bounds = MakeAabb(min, max, index->m_Margin);
+        InsertLeaf(index, (int32_t)proxy);
+        return true;
+    }
+
+    uint32_t GetSpatialProxyCount(HSpatialIndex index)
+    {
+        return index->m_ProxyCount;
+    }
+
+    bool IsSpatialProxyVisible(HSpatialIndex index, uint32_t proxy)
+    {
+        return index->m_VisibleStamps[proxy] == index->m_CullStamp;
+    }
+
+    static void CullSubtree(SpatialIndex* index, int32_t root)
+    {
+        const dmIntersection::Frustum& frustum = *index->m_Frustum;
+        const SpatialNode* nodes = index->m_Nodes.Begin();
+        const SpatialAabb* leaf_bounds = index->m_LeafBounds.Begin();
+        uint32_t* stamps = index->m_VisibleStamps.Begin();
+        const uint32_t stamp = index->m_CullStamp;
+
+        // Each entry is a node, and whether it is already known to be fully inside the frustum
+        struct StackEntry
+        {
+            int32_t m_Node;
+            bool    m_Inside;
+        } stack[SPATIAL_INDEX_STACK_SIZE];
+
+        uint32_t stack_size = 0;
+        stack[stack_size].m_Node = root;
+        stack[stack_size].m_Inside = false;
+        ++stack_size;
+
+        while (stack_size > 0)
+        {
+            --stack_size;
+            int32_t node_index = stack[stack_size].m_Node;
+            bool inside = stack[stack_size].m_Inside;
+            const SpatialNode& node = nodes[node_index];
+
+            if (node.m_Height == 0)
+            {
+                if (inside || TestFrustumAabb(frustum, leaf_bounds[node_index]) != FRUSTUM_OUTSIDE)
+                    stamps[node_index] = stamp;
+                continue;
+            }
+
+            if (!inside)
+            {
+                FrustumTestResult result = TestFrustumAabb(frustum, node.m_Bounds);
+                if (result == FRUSTUM_OUTSIDE)
+                    continue;
+                inside = result == FRUSTUM_INSIDE;
+            }
+
+            assert(stack_size + 2 <= SPATIAL_INDEX_STACK_SIZE);
+            stack[stack_size].m_Node = node.m_Child1;
+            stack[stack_size].m_Inside = inside;
+            ++stack_size;
+            stack[stack_size].m_Node = node.m_Child2;
+            stack[stack_size].m_Inside = inside;
+            ++stack_size;
+        }
+    }
+
+    static void CullSubtreesRange(void* _index, uint32_t begin, uint32_t end)
+    {
+        SpatialIndex* index = (SpatialIndex*)_index;
+        for (uint32_t i = begin; i < end; ++i)
+            CullSubtree(index, index->m_Tasks[i]);
+    }
+
+    void CullSpatialIndex(HSpatialIndex index, const dmIntersection::Frustum& frustum, dmJobThread::HContext job_thread)
+    {
+        DM_PROFILE("CullSpatialIndex");
+
+        // Invalidates the visibility from the previous cull
+        if (++index->m_CullStamp == 0)
+        {
+            memset(index->m_VisibleStamps.Begin(), 0, index->m_VisibleStamps.Size() * sizeof(uint32_t));
+            index->m_CullStamp = 1;
+        }
+
+        if (index->m_Root == NULL_NODE)
+            return;
+
+        index->m_Frustum = &frustum;
+
+        uint32_t worker_count = job_thread ? dmJobThread::GetWorkerCount(job_thread) : 0;
+        if (worker_count == 0 || index->m_ProxyCount < SPATIAL_INDEX_PARALLEL_THRESHOLD)
+        {
+            CullSubtree(index, index->m_Root);
+            index->m_Frustum = 0;
+            return;
+        }
+
+        // Split the top of the tree into a few subtrees per thread, and cull those in parallel.
+        // The leaves are disjoint, so each visibility stamp is only written by one job.
+        uint32_t task_count = dmMath::Min((worker_count + 1) * 4, SPATIAL_INDEX_MAX_TASKS);
+        dmArray<int32_t>& tasks = index->m_Tasks;
+        tasks.SetCapacity(SPATIAL_INDEX_MAX_TASKS);
+        tasks.SetSize(0);
+        tasks.Push(index->m_Root);
+
+        const SpatialNode* nodes = index->m_Nodes.Begin();
+        uint32_t next = 0;
+        while (tasks.Size() < task_count && next < tasks.Size())
+        {
+            const SpatialNode& node = nodes[tasks[next]];
+            if (node.m_Height == 0)
+            {
+                ++next;
+                continue;
+            }
+            tasks[next] = node.m_Child1;
+            tasks.Push(node.m_Child2);
+        }
+
+        dmJobThread::ParallelFor(job_thread, tasks.Size(), 1, CullSubtreesRange, index);
+        index->m_Frustum = 0;
+    }
+}
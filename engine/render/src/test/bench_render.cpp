@@ -0,0 +1,172 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+#include <dmsdk/dlib/intersection.h>
+
+#include <testmain/testmain.h>
+#include <dlib/benchmark.h>
+#include <dlib/hash.h>
+#include <dlib/math.h>
+
+#include <script/script.h>
+
+#include "render/render.h"
+#include "render/render_private.h"
+
+using namespace dmVMath;
+
+const static uint32_t WIDTH = 1280;
+const static uint32_t HEIGHT = 720;
+
+class dmRenderBench : public jc_test_base_class
+{
+protected:
+    dmPlatform::HWindow m_Window;
+    dmRender::HRenderContext m_Context;
+    dmGraphics::HContext m_GraphicsContext;
+    dmScript::HContext m_ScriptContext;
+
+    virtual void SetUp()
+    {
+        dmGraphics::InstallAdapter();
+
+        dmPlatform::WindowParams win_params = {};
+        win_params.m_Width = 20;
+        win_params.m_Height = 10;
+
+        m_Window = dmPlatform::NewWindow();
+        dmPlatform::OpenWindow(m_Window, win_params);
+
+        dmGraphics::ContextParams graphics_context_params = {};
+        graphics_context_params.m_Window                  = m_Window;
+        graphics_context_params.m_DefaultTextureMinFilter = dmGraphics::TEXTURE_FILTER_DEFAULT;
+        graphics_context_params.m_DefaultTextureMagFilter = dmGraphics::TEXTURE_FILTER_DEFAULT;
+
+        m_GraphicsContext = dmGraphics::NewContext(graphics_context_params);
+        dmRender::RenderContextParams params;
+        dmScript::ContextParams script_context_params = {};
+        script_context_params.m_GraphicsContext = m_GraphicsContext;
+        m_ScriptContext = dmScript::NewContext(script_context_params);
+        params.m_MaxRenderTargets = 1;
+        params.m_MaxInstances = 2;
+        params.m_ScriptContext = m_ScriptContext;
+        params.m_MaxDebugVertexCount = 256;
+        params.m_MaxCharacters = 256;
+        params.m_MaxBatches = 128;
+        m_Context = dmRender::NewRenderContext(m_GraphicsContext, params);
+
+        dmVMath::Matrix4 view = dmVMath::Matrix4::identity();
+        dmVMath::Matrix4 proj = dmVMath::Matrix4::orthographic(0.0f, WIDTH, 0.0f, HEIGHT, -1.0f, 1.0f);
+        dmRender::SetViewMatrix(m_Context, view);
+        dmRender::SetProjectionMatrix(m_Context, proj);
+    }
+
+    virtual void TearDown()
+    {
+        dmRender::DeleteRenderContext(m_Context, 0);
+        dmGraphics::DeleteContext(m_GraphicsContext);
+        dmScript::DeleteContext(m_ScriptContext);
+
+        dmPlatform::CloseWindow(m_Window);
+        dmPlatform::DeleteWindow(m_Window);
+    }
+
+    void BenchRenderList(const char* name, uint32_t count, bool cull);
+};
+
+static void BenchDispatch(dmRender::RenderListDispatchParams const & params)
+{
+    if (params.m_Operation == dmRender::RENDER_LIST_OPERATION_BATCH)
+    {
+        uint32_t* entries = (uint32_t*)params.m_UserData;
+        *entries += (uint32_t)(params.m_End - params.m_Begin);
+    }
+}
+
+static void BenchVisibility(dmRender::RenderListVisibilityParams const &params)
+{
+    for (uint32_t i = 0; i < params.m_NumEntries; ++i)
+    {
+        dmRender::RenderListEntry* entry = &params.m_Entries[i];
+        bool intersect = dmIntersection::TestFrustumPoint(*params.m_Frustum, entry->m_WorldPosition);
+        entry->m_Visibility = intersect ? dmRender::VISIBILITY_FULL : dmRender::VISIBILITY_NONE;
+    }
+}
+
+void dmRenderBench::BenchRenderList(const char* name, uint32_t count, bool cull)
+{
+    dmVMath::Matrix4 view_proj = dmVMath::Matrix4::orthographic(0.0f, WIDTH, 0.0f, HEIGHT, -1.0f, 1.0f);
+    dmRender::FrustumOptions frustum_options;
+    frustum_options.m_Matrix = view_proj;
+    frustum_options.m_NumPlanes = dmRender::FRUSTUM_PLANES_SIDES;
+
+    uint32_t entries_rendered = 0;
+    uint32_t seed = 17;
+    for (dmBenchmark::Run run(name, 50, count); run.Next(); )
+    {
+        dmRender::RenderListBegin(m_Context);
+        uint8_t dispatch = dmRender::RenderListMakeDispatch(m_Context, BenchDispatch, cull ? BenchVisibility : 0, &entries_rendered);
+
+        dmRender::RenderListEntry* out = dmRender::RenderListAlloc(m_Context, count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            // Spread the entries over twice the screen area so that roughly a quarter of them are culled
+            seed = seed * 1664525u + 1013904223u;
+            float x = (float)(seed >> 8 & 0xfff) * (2.0f * WIDTH / 4096.0f) - WIDTH * 0.5f;
+            float y = (float)(seed >> 20) * (2.0f * HEIGHT / 4096.0f) - HEIGHT * 0.5f;
+
+            dmRender::RenderListEntry& entry = out[i];
+            entry.m_WorldPosition = Point3(x, y, (float)(seed & 0xff) / 256.0f);
+            entry.m_MajorOrder = dmRender::RENDER_ORDER_WORLD;
+            entry.m_MinorOrder = 0;
+            entry.m_TagListKey = 0;
+            entry.m_Order = 0;
+            entry.m_BatchKey = seed & 0x1f;
+            entry.m_Dispatch = dispatch;
+            entry.m_UserData = 0;
+            entry.m_Visibility = dmRender::VISIBILITY_NONE;
+        }
+        dmRender::RenderListSubmit(m_Context, out, out + count);
+        dmRender::RenderListEnd(m_Context);
+
+        dmRender::DrawRenderList(m_Context, 0, 0, cull ? &frustum_options : 0);
+    }
+    ASSERT_NE(0u, entries_rendered);
+}
+
+TEST_F(dmRenderBench, RenderListSort)
+{
+    BenchRenderList("render.list_sort", 16384, false);
+}
+
+TEST_F(dmRenderBench, RenderListCullSort)
+{
+    BenchRenderList("render.list_cull_sort", 16384, true);
+}
+
+extern "C" void dmExportedSymbols();
+
+int main(int argc, char **argv)
+{
+    dmExportedSymbols();
+    TestMainPlatformInit();
+    jc_test_init(&argc, argv);
+    int ret = jc_test_run_all();
+    if (ret == 0)
+        ret = dmBenchmark::Report(argc, argv, "render");
+    return ret;
+}
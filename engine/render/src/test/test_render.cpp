@@ -13,6 +13,7 @@
 // specific language governing permissions and limitations under the License.
 
 #include <stdint.h>
+#include <stdlib.h> // rand
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
 #include <dmsdk/dlib/intersection.h>
@@ -20,6 +21,7 @@
 #include <testmain/testmain.h>
 #include <dlib/hash.h>
 #include <dlib/math.h>
+#include <dlib/zlib.h>
 
 #include <script/script.h>
 #include <algorithm> // std::stable_sort
@@ -238,6 +240,23 @@ TEST_F(dmRenderTest, TestLine3d)
     Line3D(m_Context, Point3(10.0f, 20.0f, 30.0f), Point3(10.0f, 20.0f, 30.0f), Vector4(0.1f, 0.2f, 0.3f, 0.4f), Vector4(0.1f, 0.2f, 0.3f, 0.4f));
 }
 
+TEST_F(dmRenderTest, TestLines3dTriangles3d)
+{
+    Point3 points[6] = { Point3(0.0f, 0.0f, 0.0f), Point3(1.0f, 0.0f, 0.0f), Point3(0.0f, 1.0f, 0.0f),
+                         Point3(1.0f, 1.0f, 0.0f), Point3(2.0f, 0.0f, 0.0f), Point3(0.0f, 2.0f, 0.0f) };
+    Lines3D(m_Context, points, 6, Vector4(0.1f, 0.2f, 0.3f, 0.4f));
+    Triangles3D(m_Context, points, 6, Vector4(0.1f, 0.2f, 0.3f, 0.4f));
+    // Incomplete primitives are ignored
+    Lines3D(m_Context, points, 1, Vector4(0.1f, 0.2f, 0.3f, 0.4f));
+    Triangles3D(m_Context, points, 2, Vector4(0.1f, 0.2f, 0.3f, 0.4f));
+}
+
+TEST_F(dmRenderTest, TestDebugFrustumSphere)
+{
+    // Without a debug 3d draw there is nothing to cull against
+    ASSERT_TRUE(TestDebugFrustumSphere(m_Context, Point3(10000.0f, 0.0f, 0.0f), 1.0f));
+}
+
 struct TestDrawDispatchCtx
 {
     int m_BeginCalls;
@@ -1257,6 +1276,85 @@ TEST_F(dmRenderTest, TestRenderListOrder)
     ASSERT_EQ(ctx.m_Z, orders[2]);
 }
 
+struct TestRenderListSortCacheCtx
+{
+    uint32_t m_BatchCalls;
+    uint32_t m_Count;
+    float    m_Z[8];
+};
+
+static void TestRenderListSortCacheDispatch(dmRender::RenderListDispatchParams const & params)
+{
+    TestRenderListSortCacheCtx *ctx = (TestRenderListSortCacheCtx*) params.m_UserData;
+    if (params.m_Operation != dmRender::RENDER_LIST_OPERATION_BATCH)
+        return;
+    ctx->m_BatchCalls++;
+    for (uint32_t* i = params.m_Begin; i != params.m_End; ++i)
+        ctx->m_Z[ctx->m_Count++] = params.m_Buf[*i].m_WorldPosition.getZ();
+}
+
+TEST_F(dmRenderTest, TestRenderListSortCache)
+{
+    // Repeated draws with the same predicate and camera reuse the sorted draw order
+    TestRenderListSortCacheCtx ctx;
+    memset(&ctx, 0x00, sizeof(TestRenderListSortCacheCtx));
+
+    dmVMath::Matrix4 view = dmVMath::Matrix4::identity();
+    dmVMath::Matrix4 proj = dmVMath::Matrix4::orthographic(0.0f, WIDTH, 0.0f, HEIGHT, 0.1f, 1.0f);
+    dmRender::SetViewMatrix(m_Context, view);
+    dmRender::SetProjectionMatrix(m_Context, proj);
+
+    dmRender::RenderListBegin(m_Context);
+    uint8_t dispatch = dmRender::RenderListMakeDispatch(m_Context, TestRenderListSortCacheDispatch, 0, &ctx);
+
+    const uint32_t n = 3;
+    const float z[n] = { 3.0f, 1.0f, 2.0f };
+    dmRender::RenderListEntry* out = dmRender::RenderListAlloc(m_Context, n);
+    for (uint32_t i=0;i!=n;i++)
+    {
+        dmRender::RenderListEntry & entry = out[i];
+        entry.m_WorldPosition = Point3(0,0,z[i]);
+        entry.m_MajorOrder = dmRender::RENDER_ORDER_WORLD;
+        entry.m_MinorOrder = 0;
+        entry.m_TagListKey = 0;
+        entry.m_Order = 0;
+        entry.m_BatchKey = 0;
+        entry.m_Dispatch = dispatch;
+        entry.m_UserData = 0;
+    }
+    dmRender::RenderListSubmit(m_Context, out, out + n);
+    dmRender::RenderListEnd(m_Context);
+
+    float first_order[n];
+    for (uint32_t pass = 0; pass < 2; ++pass)
+    {
+        memset(&ctx, 0x00, sizeof(TestRenderListSortCacheCtx));
+        dmRender::DrawRenderList(m_Context, 0, 0, 0);
+        ASSERT_EQ(1U, ctx.m_BatchCalls);
+        ASSERT_EQ(n, ctx.m_Count);
+        if (pass == 0)
+            memcpy(first_order, ctx.m_Z, sizeof(first_order));
+        for (uint32_t i = 0; i < n; ++i)
+            ASSERT_EQ(first_order[i], ctx.m_Z[i]);
+        ASSERT_EQ(1U, m_Context->m_RenderListSortCache.Size());
+        ASSERT_EQ(n, m_Context->m_RenderListSortCacheIndices.Size());
+    }
+
+    // A new camera gets its own draw order
+    dmRender::SetViewMatrix(m_Context, dmVMath::Matrix4::translation(dmVMath::Vector3(0.0f, 0.0f, -1.0f)));
+    memset(&ctx, 0x00, sizeof(TestRenderListSortCacheCtx));
+    dmRender::DrawRenderList(m_Context, 0, 0, 0);
+    ASSERT_EQ(n, ctx.m_Count);
+    ASSERT_EQ(2U, m_Context->m_RenderListSortCache.Size());
+
+    // Adding entries invalidates the cache
+    dmRender::RenderListAlloc(m_Context, 0);
+    ASSERT_EQ(0U, m_Context->m_RenderListSortCache.Size());
+
+    dmRender::RenderListBegin(m_Context);
+    ASSERT_EQ(0U, m_Context->m_RenderListSortCacheIndices.Size());
+}
+
 TEST_F(dmRenderTest, TestRenderListDebug)
 {
     // Test submitting debug drawing when there is no other drawing going on
@@ -1290,6 +1388,121 @@ static float Metric(const char* text, int n, bool measure_trailing_space)
     ASSERT_EQ(index, lines[i].m_Index);\
     ASSERT_EQ(count, lines[i].m_Count);
 
+struct TestRenderListPersistentCtx
+{
+    dmArray<uint64_t> m_Rendered;
+};
+
+static void TestRenderListPersistentDispatch(dmRender::RenderListDispatchParams const & params)
+{
+    TestRenderListPersistentCtx* ctx = (TestRenderListPersistentCtx*) params.m_UserData;
+    if (params.m_Operation != dmRender::RENDER_LIST_OPERATION_BATCH)
+        return;
+    for (uint32_t* i = params.m_Begin; i != params.m_End; ++i)
+    {
+        if (ctx->m_Rendered.Full())
+            ctx->m_Rendered.OffsetCapacity(256);
+        ctx->m_Rendered.Push(params.m_Buf[*i].m_UserData);
+    }
+}
+
+// Renders the entries, where the ones in [persistent_begin, persistent_end) are submitted through the persistent list (if any)
+static void DrawTestRenderList(dmRender::HRenderContext context, TestRenderListPersistentCtx* ctx, const dmArray<dmRender::RenderListEntry>& entries,
+                                uint32_t persistent_begin, uint32_t persistent_end, dmRender::HPersistentRenderList list)
+{
+    ctx->m_Rendered.SetSize(0);
+    dmRender::RenderListBegin(context);
+    dmRender::HRenderListDispatch dispatch = dmRender::RenderListMakeDispatch(context, TestRenderListPersistentDispatch, 0, ctx);
+
+    uint32_t ranges[][2] = { {0, persistent_begin}, {persistent_begin, persistent_end}, {persistent_end, entries.Size()} };
+    for (uint32_t r = 0; r < DM_ARRAY_SIZE(ranges); ++r)
+    {
+        if (r == 1 && list)
+        {
+            dmRender::RenderListSubmitPersistent(context, dispatch, list);
+            continue;
+        }
+        uint32_t count = ranges[r][1] - ranges[r][0];
+        dmRender::RenderListEntry* out = dmRender::RenderListAlloc(context, count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            out[i] = entries[ranges[r][0] + i];
+            out[i].m_Dispatch = dispatch;
+        }
+        dmRender::RenderListSubmit(context, out, out + count);
+    }
+
+    dmRender::RenderListEnd(context);
+    dmRender::DrawRenderList(context, 0, 0, 0);
+}
+
+TEST_F(dmRenderTest, TestRenderListPersistent)
+{
+    dmhash_t tags[] = { dmHashString64("tile"), dmHashString64("model"), dmHashString64("gui") };
+    uint32_t tag_list_keys[DM_ARRAY_SIZE(tags)];
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(tags); ++i)
+        tag_list_keys[i] = dmRender::RegisterMaterialTagList(m_Context, 1, &tags[i]);
+
+    // Lots of equal keys, to make sure the merged order is the same as if everything was sorted
+    const uint32_t count = 600;
+    dmArray<dmRender::RenderListEntry> entries;
+    entries.SetCapacity(count);
+    entries.SetSize(count);
+    memset(entries.Begin(), 0, count * sizeof(dmRender::RenderListEntry));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmRender::RenderListEntry& entry = entries[i];
+        entry.m_MajorOrder = dmRender::RENDER_ORDER_AFTER_WORLD;
+        entry.m_Order = rand() % 16;
+        entry.m_BatchKey = rand() % 4;
+        entry.m_TagListKey = tag_list_keys[rand() % DM_ARRAY_SIZE(tags)];
+        entry.m_UserData = i;
+    }
+
+    const uint32_t persistent_begin = 200;
+    const uint32_t persistent_end = 400;
+    dmRender::HPersistentRenderList list = dmRender::NewPersistentRenderList();
+    uint32_t handles[persistent_end - persistent_begin];
+    for (uint32_t i = persistent_begin; i < persistent_end; ++i)
+        handles[i - persistent_begin] = dmRender::AddPersistentRenderListEntry(list, entries[i]);
+    ASSERT_EQ(persistent_end - persistent_begin, dmRender::GetPersistentRenderListEntryCount(list));
+
+    TestRenderListPersistentCtx expected;
+    TestRenderListPersistentCtx ctx;
+
+    for (uint32_t frame = 0; frame < 3; ++frame)
+    {
+        DrawTestRenderList(m_Context, &expected, entries, persistent_begin, persistent_end, 0);
+        DrawTestRenderList(m_Context, &ctx, entries, persistent_begin, persistent_end, list);
+
+        ASSERT_EQ(count, expected.m_Rendered.Size());
+        ASSERT_EQ(expected.m_Rendered.Size(), ctx.m_Rendered.Size());
+        for (uint32_t i = 0; i < count; ++i)
+            ASSERT_EQ(expected.m_Rendered[i], ctx.m_Rendered[i]);
+
+        // Changing the order is patched in place, and changing the tag list key resorts the list
+        for (uint32_t i = persistent_begin; i < persistent_end; i += 7)
+        {
+            dmRender::RenderListEntry& entry = entries[i];
+            entry.m_Order = rand() % 16;
+            if (frame == 1)
+                entry.m_TagListKey = tag_list_keys[rand() % DM_ARRAY_SIZE(tags)];
+            dmRender::UpdatePersistentRenderListEntry(list, handles[i - persistent_begin], entry);
+        }
+        ASSERT_FALSE(dmRender::UpdatePersistentRenderListEntry(list, handles[0], entries[persistent_begin]));
+    }
+
+    // Removed entries are no longer rendered
+    for (uint32_t i = 0; i < persistent_end - persistent_begin; ++i)
+        dmRender::RemovePersistentRenderListEntry(list, handles[i]);
+    ASSERT_EQ(0u, dmRender::GetPersistentRenderListEntryCount(list));
+
+    DrawTestRenderList(m_Context, &ctx, entries, persistent_begin, persistent_end, list);
+    ASSERT_EQ(count - (persistent_end - persistent_begin), ctx.m_Rendered.Size());
+
+    dmRender::DeletePersistentRenderList(list);
+}
+
 TEST(dmFontRenderer, Layout)
 {
     const uint32_t lines_count = 256;
@@ -1459,6 +1672,276 @@ TEST_F(dmRenderTest, GetTextMetricsMeasureTrailingSpace)
     ASSERT_GT(metricsSingleLineSpace.m_Width, 0);
 }
 
+TEST_F(dmRenderTest, PrefetchGlyphs)
+{
+    // The cache texture is kept in memory, so that new glyphs can be uploaded together
+    uint32_t size = dmRender::GetFontMapResourceSize(m_SystemFontMap);
+    ASSERT_LE(128 * 128 * 1U, size);
+
+    ASSERT_FALSE(dmRender::IsGlyphInCache(m_SystemFontMap, 'A'));
+    dmRender::PrefetchGlyphs(m_Context, m_SystemFontMap, "AB");
+    ASSERT_TRUE(dmRender::IsGlyphInCache(m_SystemFontMap, 'A'));
+    ASSERT_TRUE(dmRender::IsGlyphInCache(m_SystemFontMap, 'B'));
+    ASSERT_FALSE(dmRender::IsGlyphInCache(m_SystemFontMap, 'C'));
+
+    // Repeated glyphs are only added once
+    char text[128 * 4];
+    uint32_t length = 0;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        for (uint32_t c = 32; c < 127; ++c)
+            text[length++] = (char) c;
+    }
+    text[length] = 0;
+    dmRender::PrefetchGlyphs(m_Context, m_SystemFontMap, text);
+    dmRender::PrefetchGlyphs(m_Context, m_SystemFontMap, "");
+
+    for (uint32_t c = 32; c < 127; ++c)
+    {
+        ASSERT_TRUE(dmRender::IsGlyphInCache(m_SystemFontMap, c));
+    }
+    ASSERT_FALSE(dmRender::IsGlyphInCache(m_SystemFontMap, 127));
+
+    ASSERT_EQ(size, dmRender::GetFontMapResourceSize(m_SystemFontMap));
+}
+
+static const uint32_t GLYPH_PAGE_COUNT = 3;
+
+struct GlyphPageData
+{
+    dmRender::FontGlyph m_Glyphs[GLYPH_PAGE_COUNT];
+    uint32_t            m_HeaderOffsets[GLYPH_PAGE_COUNT];
+    dmArray<uint8_t>    m_Data; // The deflated page, followed by the glyph headers
+};
+
+static bool GlyphPageWriter(void* context, const void* data, uint32_t data_len)
+{
+    dmArray<uint8_t>* out = (dmArray<uint8_t>*)context;
+    out->OffsetCapacity(data_len);
+    out->PushArray((const uint8_t*)data, data_len);
+    return true;
+}
+
+static dmRender::FontGlyph* GetPagedGlyph(uint32_t utf8, void* user_ctx)
+{
+    GlyphPageData* page = (GlyphPageData*)user_ctx;
+    return utf8 < GLYPH_PAGE_COUNT ? &page->m_Glyphs[utf8] : 0;
+}
+
+static void* GetPagedGlyphData(uint32_t codepoint, void* user_ctx, uint32_t* out_size, uint32_t* out_compression, uint32_t* out_width, uint32_t* out_height)
+{
+    GlyphPageData* page = (GlyphPageData*)user_ctx;
+    *out_size = sizeof(dmRender::FontGlyphPage);
+    *out_compression = dmRender::FONT_GLYPH_COMPRESSION_DEFLATE_PAGE;
+    *out_width = 2;
+    *out_height = 2;
+    return page->m_Data.Begin() + page->m_HeaderOffsets[codepoint];
+}
+
+TEST_F(dmRenderTest, GlyphPages)
+{
+    // Three 2x2 glyphs in a delta encoded and deflated page
+    uint8_t images[GLYPH_PAGE_COUNT * 4];
+    for (uint32_t i = 0; i < sizeof(images); ++i)
+        images[i] = (uint8_t)(i * 7 + 3);
+
+    uint8_t encoded[sizeof(images)];
+    uint8_t last = 0;
+    for (uint32_t i = 0; i < sizeof(images); ++i)
+    {
+        encoded[i] = images[i] - last;
+        last = images[i];
+    }
+
+    GlyphPageData page;
+    memset(page.m_Glyphs, 0, sizeof(page.m_Glyphs));
+    ASSERT_EQ(dmZlib::RESULT_OK, dmZlib::DeflateBuffer(encoded, sizeof(encoded), 9, &page.m_Data, GlyphPageWriter));
+    uint32_t page_size = page.m_Data.Size();
+
+    for (uint32_t i = 0; i < GLYPH_PAGE_COUNT; ++i)
+    {
+        page.m_Glyphs[i].m_Character = i;
+        page.m_HeaderOffsets[i] = page.m_Data.Size();
+
+        dmRender::FontGlyphPage header;
+        header.m_PageOffset   = -(int32_t)page.m_HeaderOffsets[i];
+        header.m_PageSize     = page_size;
+        header.m_PageDataSize = sizeof(images);
+        header.m_GlyphOffset  = i * 4;
+        GlyphPageWriter(&page.m_Data, &header, sizeof(header));
+    }
+
+    dmRender::FontMapParams font_map_params;
+    font_map_params.m_CacheWidth = 8;
+    font_map_params.m_CacheHeight = 8;
+    font_map_params.m_CacheCellWidth = 4;
+    font_map_params.m_CacheCellHeight = 4;
+    font_map_params.m_GetGlyph = GetPagedGlyph;
+    font_map_params.m_GetGlyphData = GetPagedGlyphData;
+    dmRender::HFontMap font_map = dmRender::NewFontMap(m_GraphicsContext, font_map_params);
+    dmRender::SetFontMapUserData(font_map, &page);
+
+    // The page is inflated once, and shared by the glyphs
+    for (uint32_t i = 0; i < GLYPH_PAGE_COUNT; ++i)
+    {
+        uint32_t width = 0, height = 0;
+        const uint8_t* image = dmRender::GetGlyphImage(font_map, &page.m_Glyphs[i], &width, &height);
+        ASSERT_NE((const uint8_t*)0, image);
+        ASSERT_EQ(2u, width);
+        ASSERT_EQ(2u, height);
+        ASSERT_ARRAY_EQ_LEN(images + i * 4, image, 4);
+    }
+
+    // A glyph outside of its page is rejected (the headers aren't aligned)
+    dmRender::FontGlyphPage header;
+    uint8_t* header_data = page.m_Data.Begin() + page.m_HeaderOffsets[2];
+    memcpy(&header, header_data, sizeof(header));
+    header.m_GlyphOffset = sizeof(images) - 2;
+    memcpy(header_data, &header, sizeof(header));
+    uint32_t width = 0, height = 0;
+    ASSERT_EQ((const uint8_t*)0, dmRender::GetGlyphImage(font_map, &page.m_Glyphs[2], &width, &height));
+
+    dmRender::DeleteFontMap(font_map);
+}
+
+TEST_F(dmRenderTest, TextLayoutCache)
+{
+    dmRender::DrawTextParams params;
+    params.m_Text = "Hello World";
+    dmRender::DrawText(m_Context, m_SystemFontMap, 0, 0, params);
+    dmRender::DrawText(m_Context, m_SystemFontMap, 0, 0, params);
+
+    params.m_Width = 8*2;
+    params.m_LineBreak = true;
+    dmRender::DrawText(m_Context, m_SystemFontMap, 0, 0, params);
+
+    params.m_Text = "Hello";
+    dmRender::DrawText(m_Context, m_SystemFontMap, 0, 0, params);
+
+    // The same text and layout parameters share the layout
+    const dmArray<dmRender::TextEntry>& entries = m_Context->m_TextContext.m_TextEntries;
+    ASSERT_EQ(4u, entries.Size());
+    ASSERT_EQ(entries[0].m_LayoutKey, entries[1].m_LayoutKey);
+    ASSERT_NE(entries[1].m_LayoutKey, entries[2].m_LayoutKey);
+    ASSERT_NE(entries[2].m_LayoutKey, entries[3].m_LayoutKey);
+
+    // The culling bounds are calculated from the (cached) layout
+    ASSERT_NEAR(entries[0].m_FrustumCullingRadiusSq, entries[1].m_FrustumCullingRadiusSq, EPSILON);
+
+    // Changing the glyphs clears the cached layouts
+    dmRender::SetFontMapUserData(m_SystemFontMap, m_Glyphs);
+    dmRender::DrawText(m_Context, m_SystemFontMap, 0, 0, params);
+    ASSERT_EQ(entries[3].m_LayoutKey, entries[4].m_LayoutKey);
+    ASSERT_NEAR(entries[3].m_FrustumCullingRadiusSq, entries[4].m_FrustumCullingRadiusSq, EPSILON);
+}
+
+static uint32_t DrawTextBatch(dmRender::HRenderContext context, dmRender::HFontMap font_map, uint32_t text_count, dmArray<uint8_t>& vertices)
+{
+    dmRender::RenderListBegin(context);
+
+    dmRender::DrawTextParams params;
+    params.m_Text = "Hi";
+    for (uint32_t i = 0; i < text_count; ++i)
+    {
+        params.m_WorldTransform.setTranslation(dmVMath::Vector3((float) i, (float) (i % 7), 0.0f));
+        dmRender::DrawText(context, font_map, 0, 0, params);
+    }
+    dmRender::FlushTexts(context, dmRender::RENDER_ORDER_WORLD, 0, true);
+    dmRender::RenderListEnd(context);
+    dmRender::DrawRenderList(context, 0, 0, 0);
+
+    dmRender::TextContext& text_context = context->m_TextContext;
+    uint32_t size = text_context.m_VertexIndex * dmGraphics::GetVertexDeclarationStride(text_context.m_VertexDecl);
+    vertices.SetCapacity(size);
+    vertices.SetSize(size);
+    memcpy(vertices.Begin(), text_context.m_ClientBuffer, size);
+
+    dmRender::ClearRenderObjects(context);
+    return text_context.m_VertexIndex;
+}
+
+struct DynamicGlyphs
+{
+    dmRender::FontGlyph m_Glyphs[128];
+    bool                m_Removed[128];
+};
+
+static dmRender::FontGlyph* GetDynamicGlyph(uint32_t utf8, void* user_ctx)
+{
+    DynamicGlyphs* glyphs = (DynamicGlyphs*)user_ctx;
+    return (utf8 < DM_ARRAY_SIZE(glyphs->m_Glyphs) && !glyphs->m_Removed[utf8]) ? &glyphs->m_Glyphs[utf8] : 0;
+}
+
+TEST_F(dmRenderTest, TextLayoutCacheDynamicGlyphs)
+{
+    DynamicGlyphs glyphs;
+    memcpy(glyphs.m_Glyphs, m_Glyphs, sizeof(m_Glyphs));
+    memset(glyphs.m_Removed, 0, sizeof(glyphs.m_Removed));
+
+    dmRender::FontMapParams font_map_params;
+    font_map_params.m_CacheWidth = 128;
+    font_map_params.m_CacheHeight = 128;
+    font_map_params.m_CacheCellWidth = 8;
+    font_map_params.m_CacheCellHeight = 8;
+    font_map_params.m_MaxAscent = 2;
+    font_map_params.m_MaxDescent = 1;
+    font_map_params.m_GetGlyph = GetDynamicGlyph;
+    font_map_params.m_GetGlyphData = GetGlyphData;
+    dmRender::HFontMap font_map = dmRender::NewFontMap(m_GraphicsContext, font_map_params);
+    dmRender::SetFontMapUserData(font_map, &glyphs);
+
+    // Caches the layout of "Hi"
+    dmArray<uint8_t> vertices;
+    uint32_t vertex_count = DrawTextBatch(m_Context, font_map, 1, vertices);
+    ASSERT_LT(0u, vertex_count);
+    ASSERT_TRUE(dmRender::IsGlyphInCache(font_map, 'H'));
+    ASSERT_TRUE(dmRender::IsGlyphInCache(font_map, 'i'));
+
+    // Removing a glyph drops it from the layout and the glyph cache
+    glyphs.m_Removed['i'] = true;
+    dmRender::InvalidateFontMapGlyph(font_map, 'i');
+    ASSERT_TRUE(dmRender::IsGlyphInCache(font_map, 'H'));
+    ASSERT_FALSE(dmRender::IsGlyphInCache(font_map, 'i'));
+
+    uint32_t removed_vertex_count = DrawTextBatch(m_Context, font_map, 1, vertices);
+    ASSERT_EQ(vertex_count / 2, removed_vertex_count);
+    ASSERT_FALSE(dmRender::IsGlyphInCache(font_map, 'i'));
+
+    // Adding it back lays out the text again
+    glyphs.m_Removed['i'] = false;
+    dmRender::InvalidateFontMapGlyph(font_map, 'i');
+
+    ASSERT_EQ(vertex_count, DrawTextBatch(m_Context, font_map, 1, vertices));
+    ASSERT_TRUE(dmRender::IsGlyphInCache(font_map, 'i'));
+
+    dmRender::DeleteFontMap(font_map);
+}
+
+TEST_F(dmRenderTest, TextVertexDataParallel)
+{
+    // Enough texts to write the vertices on the job threads
+    const uint32_t text_count = 100;
+
+    dmArray<uint8_t> serial_vertices;
+    uint32_t serial_vertex_count = DrawTextBatch(m_Context, m_SystemFontMap, text_count, serial_vertices);
+    ASSERT_LT(0u, serial_vertex_count);
+
+    dmJobThread::JobThreadCreationParams job_thread_params;
+    job_thread_params.m_ThreadNames[0] = "TextVertices1";
+    job_thread_params.m_ThreadNames[1] = "TextVertices2";
+    job_thread_params.m_ThreadCount = 2;
+    m_Context->m_JobThread = dmJobThread::Create(job_thread_params);
+
+    dmArray<uint8_t> parallel_vertices;
+    uint32_t parallel_vertex_count = DrawTextBatch(m_Context, m_SystemFontMap, text_count, parallel_vertices);
+
+    dmJobThread::Destroy(m_Context->m_JobThread);
+    m_Context->m_JobThread = 0;
+
+    ASSERT_EQ(serial_vertex_count, parallel_vertex_count);
+    ASSERT_EQ(0, memcmp(serial_vertices.Begin(), parallel_vertices.Begin(), serial_vertices.Size()));
+}
+
 TEST_F(dmRenderTest, TextAlignment)
 {
     dmRender::TextMetrics metrics;
@@ -1600,6 +2083,273 @@ TEST_F(dmRenderTest, FindRanges)
     ASSERT_EQ(6, range.m_Count);
 }
 
+static bool RadixSortItemLess(const dmRender::RadixSortItem& a, const dmRender::RadixSortItem& b)
+{
+    return a.m_Key < b.m_Key;
+}
+
+static void TestRadixSort(dmJobThread::HContext job_thread, uint32_t count)
+{
+    dmArray<dmRender::RadixSortItem> items;
+    dmArray<dmRender::RadixSortItem> scratch;
+    dmArray<dmRender::RadixSortItem> expected;
+    items.SetCapacity(count);
+    items.SetSize(count);
+    scratch.SetCapacity(count);
+    scratch.SetSize(count);
+
+    // Few unique values in a few of the digits, to test both stability and the skipped passes
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        items[i].m_Key = ((uint64_t)(rand() % 7) << 56) | ((uint64_t)(rand() % 300) << 20) | (rand() % 3);
+        items[i].m_Index = i;
+    }
+    expected.SetCapacity(count);
+    expected.SetSize(count);
+    memcpy(expected.Begin(), items.Begin(), count * sizeof(dmRender::RadixSortItem));
+    std::stable_sort(expected.Begin(), expected.End(), RadixSortItemLess);
+
+    dmRender::RadixSortItem* sorted = dmRender::RadixSort(job_thread, items.Begin(), scratch.Begin(), count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_EQ(expected[i].m_Key, sorted[i].m_Key);
+        ASSERT_EQ(expected[i].m_Index, sorted[i].m_Index);
+    }
+}
+
+TEST(Render, RadixSort)
+{
+    TestRadixSort(0, 1);
+    TestRadixSort(0, 2);
+    TestRadixSort(0, 1000);
+    TestRadixSort(0, 40000);
+
+    dmJobThread::JobThreadCreationParams job_thread_params;
+    job_thread_params.m_ThreadNames[0] = "RadixSort1";
+    job_thread_params.m_ThreadNames[1] = "RadixSort2";
+    job_thread_params.m_ThreadNames[2] = "RadixSort3";
+    job_thread_params.m_ThreadCount = 3;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_params);
+
+    TestRadixSort(job_thread, 1000);
+    TestRadixSort(job_thread, 40000);
+    TestRadixSort(job_thread, 100003);
+
+    dmJobThread::Destroy(job_thread);
+}
+
+static bool TestSpatialBounds(const dmIntersection::Frustum& frustum, const dmVMath::Point3& min, const dmVMath::Point3& max)
+{
+    dmVMath::Vector3 aabb_min(min);
+    dmVMath::Vector3 aabb_max(max);
+    return dmIntersection::TestFrustumOBB(frustum, dmVMath::Matrix4::identity(), aabb_min, aabb_max);
+}
+
+TEST(Render, SpatialIndex)
+{
+    const uint32_t count = 10000;
+    dmArray<dmVMath::Point3> mins;
+    dmArray<dmVMath::Point3> maxs;
+    dmArray<uint32_t> proxies;
+    mins.SetCapacity(count);
+    maxs.SetCapacity(count);
+    proxies.SetCapacity(count);
+
+    dmRender::HSpatialIndex index = dmRender::NewSpatialIndex(4.0f);
+
+    // A large 2D world, where only a small part is visible
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmVMath::Point3 center((float)(rand() % 10000), (float)(rand() % 10000), 0.0f);
+        // Half-unit extents keep the corners off the (integer) frustum planes
+        dmVMath::Vector3 extents(8.5f, 8.5f, 8.5f);
+        mins.Push(center - extents);
+        maxs.Push(center + extents);
+        proxies.Push(dmRender::AddSpatialProxy(index, mins[i], maxs[i]));
+    }
+    ASSERT_EQ(count, dmRender::GetSpatialProxyCount(index));
+
+    dmIntersection::Frustum frustum;
+    dmVMath::Matrix4 view_proj = dmVMath::Matrix4::orthographic(1000.0f, 2000.0f, 1000.0f, 2000.0f, -10.0f, 10.0f);
+    dmIntersection::CreateFrustumFromMatrix(view_proj, true, 6, frustum);
+
+    // Move half of them, some far enough to leave their enlarged bounds
+    for (uint32_t i = 0; i < count; i += 2)
+    {
+        dmVMath::Vector3 offset((float)(rand() % 64) - 32.0f, (float)(rand() % 64) - 32.0f, 0.0f);
+        mins[i] = mins[i] + offset;
+        maxs[i] = maxs[i] + offset;
+        dmRender::UpdateSpatialProxy(index, proxies[i], mins[i], maxs[i]);
+    }
+
+    // Remove every tenth
+    for (uint32_t i = 0; i < count; i += 10)
+    {
+        dmRender::RemoveSpatialProxy(index, proxies[i]);
+        proxies[i] = dmRender::INVALID_SPATIAL_PROXY;
+    }
+    ASSERT_EQ(count - count / 10, dmRender::GetSpatialProxyCount(index));
+
+    dmJobThread::JobThreadCreationParams job_thread_params;
+    job_thread_params.m_ThreadNames[0] = "SpatialIndex1";
+    job_thread_params.m_ThreadNames[1] = "SpatialIndex2";
+    job_thread_params.m_ThreadCount = 2;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_params);
+
+    dmJobThread::HContext job_threads[] = { 0, job_thread };
+    for (uint32_t j = 0; j < DM_ARRAY_SIZE(job_threads); ++j)
+    {
+        dmRender::CullSpatialIndex(index, frustum, job_threads[j]);
+
+        uint32_t visible_count = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (proxies[i] == dmRender::INVALID_SPATIAL_PROXY)
+                continue;
+            bool visible = dmRender::IsSpatialProxyVisible(index, proxies[i]);
+            ASSERT_EQ(TestSpatialBounds(frustum, mins[i], maxs[i]), visible);
+            visible_count += visible ? 1 : 0;
+        }
+        ASSERT_LT(0u, visible_count);
+        ASSERT_GT(count / 10, visible_count);
+    }
+
+    dmJobThread::Destroy(job_thread);
+    dmRender::DeleteSpatialIndex(index);
+}
+
+TEST(Render, OcclusionBuffer)
+{
+    dmRender::HOcclusionBuffer buffer = dmRender::NewOcclusionBuffer(dmRender::OCCLUSION_BUFFER_WIDTH, dmRender::OCCLUSION_BUFFER_HEIGHT);
+
+    dmVMath::Matrix4 view = dmVMath::Matrix4::lookAt(dmVMath::Point3(0.0f, 0.0f, 0.0f), dmVMath::Point3(0.0f, 0.0f, -1.0f), dmVMath::Vector3(0.0f, 1.0f, 0.0f));
+    dmVMath::Matrix4 view_proj = dmVMath::Matrix4::perspective(1.0f, 2.0f, 0.1f, 100.0f) * view;
+
+    dmVMath::Vector3 box_min(-1.0f, -1.0f, -1.0f);
+    dmVMath::Vector3 box_max(1.0f, 1.0f, 1.0f);
+    dmVMath::Matrix4 behind = dmVMath::Matrix4::translation(dmVMath::Vector3(0.0f, 0.0f, -20.0f));
+
+    // Nothing is occluded by an empty buffer
+    dmRender::ClearOcclusionBuffer(buffer, view_proj);
+    dmRender::FinalizeOcclusionBuffer(buffer);
+    ASSERT_FALSE(dmRender::IsOccluded(buffer, behind, box_min, box_max));
+
+    // A wall in front of the camera
+    dmRender::ClearOcclusionBuffer(buffer, view_proj);
+    dmRender::RasterizeOccluder(buffer, dmVMath::Matrix4::translation(dmVMath::Vector3(0.0f, 0.0f, -10.0f)), dmVMath::Vector3(-5.0f, -5.0f, -0.5f), dmVMath::Vector3(5.0f, 5.0f, 0.5f));
+    dmRender::FinalizeOcclusionBuffer(buffer);
+
+    ASSERT_TRUE(dmRender::IsOccluded(buffer, behind, box_min, box_max));
+    // In front of the wall
+    ASSERT_FALSE(dmRender::IsOccluded(buffer, dmVMath::Matrix4::translation(dmVMath::Vector3(0.0f, 0.0f, -5.0f)), box_min, box_max));
+    // Behind the wall, but only partly covered by it
+    ASSERT_FALSE(dmRender::IsOccluded(buffer, dmVMath::Matrix4::translation(dmVMath::Vector3(11.0f, 0.0f, -20.0f)), box_min, box_max));
+    // Beside the wall
+    ASSERT_FALSE(dmRender::IsOccluded(buffer, dmVMath::Matrix4::translation(dmVMath::Vector3(20.0f, 0.0f, -20.0f)), box_min, box_max));
+    // Intersecting the near plane
+    ASSERT_FALSE(dmRender::IsOccluded(buffer, dmVMath::Matrix4::identity(), box_min, box_max));
+
+    dmRender::DeleteOcclusionBuffer(buffer);
+}
+
+static bool ClusterHasLight(dmRender::HLightClusters clusters, uint32_t x, uint32_t y, uint32_t slice, uint16_t light)
+{
+    const uint16_t* indices;
+    uint32_t count = dmRender::GetClusterLights(clusters, x, y, slice, &indices);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (indices[i] == light)
+            return true;
+    }
+    return false;
+}
+
+TEST(Render, LightClusters)
+{
+    dmRender::LightClustersParams params;
+    params.m_TilesX = dmRender::LIGHT_CLUSTER_TILES_X;
+    params.m_TilesY = dmRender::LIGHT_CLUSTER_TILES_Y;
+    params.m_Slices = dmRender::LIGHT_CLUSTER_SLICES;
+    params.m_MaxIndices = dmRender::LIGHT_CLUSTER_MAX_INDICES;
+    dmRender::HLightClusters clusters = dmRender::NewLightClusters(params);
+
+    dmVMath::Matrix4 view = dmVMath::Matrix4::lookAt(dmVMath::Point3(0.0f, 0.0f, 0.0f), dmVMath::Point3(0.0f, 0.0f, -1.0f), dmVMath::Vector3(0.0f, 1.0f, 0.0f));
+    dmVMath::Matrix4 proj = dmVMath::Matrix4::perspective(1.0f, 2.0f, 0.1f, 100.0f);
+
+    dmVMath::Vector4 lights[] = {
+        dmVMath::Vector4(0.0f, 0.0f, -10.0f, 1.0f),   // In front of the camera
+        dmVMath::Vector4(0.0f, 0.0f, 10.0f, 1.0f),    // Behind the camera
+        dmVMath::Vector4(1000.0f, 0.0f, -10.0f, 1.0f),// Outside of the screen
+        dmVMath::Vector4(0.0f, 0.0f, 0.0f, 5.0f),     // Around the camera
+    };
+    dmRender::BuildLightClusters(clusters, view, proj, lights, DM_ARRAY_SIZE(lights));
+    ASSERT_EQ(0u, dmRender::GetLightClusterOverflow(clusters));
+
+    uint32_t slice = dmRender::GetLightClusterSlice(clusters, 10.0f);
+    ASSERT_LT(0u, slice);
+    ASSERT_GT(dmRender::LIGHT_CLUSTER_SLICES - 1, slice);
+    ASSERT_EQ(0u, dmRender::GetLightClusterSlice(clusters, 0.05f));
+    ASSERT_EQ(dmRender::LIGHT_CLUSTER_SLICES - 1, dmRender::GetLightClusterSlice(clusters, 1000.0f));
+
+    uint32_t center_x = dmRender::LIGHT_CLUSTER_TILES_X / 2;
+    uint32_t center_y = dmRender::LIGHT_CLUSTER_TILES_Y / 2;
+    ASSERT_TRUE(ClusterHasLight(clusters, center_x, center_y, slice, 0));
+    ASSERT_TRUE(ClusterHasLight(clusters, center_x - 1, center_y - 1, slice, 0));
+    ASSERT_FALSE(ClusterHasLight(clusters, 0, 0, slice, 0));
+    ASSERT_FALSE(ClusterHasLight(clusters, center_x, center_y, dmRender::LIGHT_CLUSTER_SLICES - 1, 0));
+
+    for (uint32_t z = 0; z < dmRender::LIGHT_CLUSTER_SLICES; ++z)
+    {
+        for (uint32_t y = 0; y < dmRender::LIGHT_CLUSTER_TILES_Y; ++y)
+        {
+            for (uint32_t x = 0; x < dmRender::LIGHT_CLUSTER_TILES_X; ++x)
+            {
+                ASSERT_FALSE(ClusterHasLight(clusters, x, y, z, 1));
+                ASSERT_FALSE(ClusterHasLight(clusters, x, y, z, 2));
+            }
+        }
+    }
+
+    // The light around the camera covers the whole screen, up to its range
+    ASSERT_TRUE(ClusterHasLight(clusters, 0, 0, 0, 3));
+    ASSERT_TRUE(ClusterHasLight(clusters, dmRender::LIGHT_CLUSTER_TILES_X - 1, dmRender::LIGHT_CLUSTER_TILES_Y - 1, 0, 3));
+    ASSERT_FALSE(ClusterHasLight(clusters, center_x, center_y, dmRender::GetLightClusterSlice(clusters, 10.0f), 3));
+
+    // The lists are sorted by light index
+    dmVMath::Vector4 overlapping[] = { lights[0], lights[3], lights[0] };
+    dmRender::BuildLightClusters(clusters, view, proj, overlapping, DM_ARRAY_SIZE(overlapping));
+    const uint16_t* indices;
+    ASSERT_EQ(2u, dmRender::GetClusterLights(clusters, center_x, center_y, slice, &indices));
+    ASSERT_EQ(0u, indices[0]);
+    ASSERT_EQ(2u, indices[1]);
+    dmRender::DeleteLightClusters(clusters);
+
+    // The lights that don't fit are dropped, and counted
+    params.m_MaxIndices = 4;
+    clusters = dmRender::NewLightClusters(params);
+    dmRender::BuildLightClusters(clusters, view, proj, &lights[3], 1);
+    ASSERT_LT(0u, dmRender::GetLightClusterOverflow(clusters));
+    uint32_t total = 0;
+    for (uint32_t z = 0; z < dmRender::LIGHT_CLUSTER_SLICES; ++z)
+        for (uint32_t y = 0; y < dmRender::LIGHT_CLUSTER_TILES_Y; ++y)
+            for (uint32_t x = 0; x < dmRender::LIGHT_CLUSTER_TILES_X; ++x)
+                total += dmRender::GetClusterLights(clusters, x, y, z, &indices);
+    ASSERT_EQ(4u, total);
+
+    // Packed for the shader constants
+    dmVMath::Vector4 depth;
+    dmVMath::Vector4 ranges[dmRender::LIGHT_CLUSTER_COUNT / 2];
+    dmVMath::Vector4 packed_indices[2];
+    dmRender::GetLightClusterData(clusters, &depth, ranges, DM_ARRAY_SIZE(ranges), packed_indices, DM_ARRAY_SIZE(packed_indices));
+    ASSERT_EQ(1.0f, depth.getZ());
+    ASSERT_EQ(0.0f, ranges[0].getX()); // Offset of the first cluster
+    ASSERT_EQ(1.0f, ranges[0].getY()); // Count of the first cluster
+    ASSERT_EQ(0.0f, packed_indices[0].getX());
+    ASSERT_EQ(0.0f, packed_indices[1].getX()); // Unused
+
+    dmRender::DeleteLightClusters(clusters);
+}
+
 TEST(Constants, Constant)
 {
     dmhash_t original_name_hash = dmHashString64("test_constant");
@@ -805,6 +805,109 @@ TEST_F(dmRenderScriptTest, TestLuaTransform)
     dmRender::DeleteRenderScript(m_Context, render_script);
 }
 
+TEST_F(dmRenderScriptTest, TestLuaCommandList)
+{
+    const char* script =
+    "function init(self)\n"
+    "    self.test_pred = render.predicate({\"one\"})\n"
+    "    render.begin_recording()\n"
+    "    render.set_view(\"view\")\n"
+    "    render.set_projection(vmath.matrix4_translation(vmath.vector3(1, 2, 3)))\n"
+    "    render.draw(self.test_pred, {frustum = hash(\"view\"), constants = \"constants\"})\n"
+    "    self.list = render.end_recording()\n"
+    "    self.test_pred = nil\n"
+    "    collectgarbage()\n"
+    "    self.constants = render.constant_buffer()\n"
+    "    self.view = vmath.matrix4_translation(vmath.vector3(4, 5, 6))\n"
+    "    render.replay(self.list, {view = self.view, constants = self.constants})\n"
+    "    render.replay(self.list, {view = vmath.matrix4(), [hash(\"constants\")] = self.constants})\n"
+    "end\n"
+    "function update(self)\n"
+    "    render.replay(self.list, {view = self.view, constants = self.constants})\n"
+    "end\n";
+    dmRender::HRenderScript render_script = dmRender::NewRenderScript(m_Context, LuaSourceFromString(script));
+    dmRender::HRenderScriptInstance render_script_instance = dmRender::NewRenderScriptInstance(m_Context, render_script);
+
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::InitRenderScriptInstance(render_script_instance));
+
+    dmArray<dmRender::Command>& commands = render_script_instance->m_CommandBuffer;
+    ASSERT_EQ(6u, commands.Size());
+
+    Matrix4 view = Matrix4::translation(Vector3(4, 5, 6));
+    Matrix4 projection = Matrix4::translation(Vector3(1, 2, 3));
+
+    dmRender::Command* command = &commands[0];
+    ASSERT_EQ(dmRender::COMMAND_TYPE_SET_VIEW, command->m_Type);
+    Matrix4* m = (Matrix4*)command->m_Operands[0];
+    ASSERT_NE((void*)0, m);
+    ASSERT_EQ(view.getElem(3, 0), m->getElem(3, 0));
+    ASSERT_EQ(view.getElem(3, 2), m->getElem(3, 2));
+
+    command = &commands[1];
+    ASSERT_EQ(dmRender::COMMAND_TYPE_SET_PROJECTION, command->m_Type);
+    m = (Matrix4*)command->m_Operands[0];
+    ASSERT_EQ(projection.getElem(3, 1), m->getElem(3, 1));
+
+    command = &commands[2];
+    ASSERT_EQ(dmRender::COMMAND_TYPE_DRAW, command->m_Type);
+    ASSERT_NE((void*)0, (void*)command->m_Operands[0]);
+    ASSERT_NE((void*)0, (void*)command->m_Operands[1]);
+    dmRender::FrustumOptions* frustum_options = (dmRender::FrustumOptions*)command->m_Operands[2];
+    ASSERT_NE((void*)0, frustum_options);
+    ASSERT_EQ(view.getElem(3, 1), frustum_options->m_Matrix.getElem(3, 1));
+
+    // The second replay has its own copies of the command data
+    command = &commands[3];
+    ASSERT_EQ(dmRender::COMMAND_TYPE_SET_VIEW, command->m_Type);
+    ASSERT_NE(commands[0].m_Operands[0], command->m_Operands[0]);
+    ASSERT_EQ(0.0f, ((Matrix4*)command->m_Operands[0])->getElem(3, 0));
+    ASSERT_EQ(commands[2].m_Operands[1], commands[5].m_Operands[1]);
+    ASSERT_NE(commands[2].m_Operands[2], commands[5].m_Operands[2]);
+
+    dmRender::ParseCommands(m_Context, &commands[0], commands.Size());
+
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::UpdateRenderScriptInstance(render_script_instance, 0.0f));
+
+    dmRender::DeleteRenderScriptInstance(render_script_instance);
+    dmRender::DeleteRenderScript(m_Context, render_script);
+}
+
+TEST_F(dmRenderScriptTest, TestLuaCommandList_InvalidUsage)
+{
+    const char* script =
+    "function init(self)\n"
+    "    self.test = 0\n"
+    "    render.begin_recording()\n"
+    "    render.set_view(\"view\")\n"
+    "    self.list = render.end_recording()\n"
+    "end\n"
+    "function update(self)\n"
+    "    self.test = self.test + 1\n"
+    "    if self.test == 1 then render.set_view(\"view\") end\n"
+    "    if self.test == 2 then render.replay(self.list, {}) end\n"
+    "    if self.test == 3 then render.replay(self.list, {view = render.constant_buffer()}) end\n"
+    "    if self.test == 4 then render.end_recording() end\n"
+    "    if self.test == 5 then render.begin_recording(); render.set_viewport(0, 0, 1, 1) end\n"
+    "end\n";
+    dmRender::HRenderScript render_script = dmRender::NewRenderScript(m_Context, LuaSourceFromString(script));
+    dmRender::HRenderScriptInstance render_script_instance = dmRender::NewRenderScriptInstance(m_Context, render_script);
+
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::InitRenderScriptInstance(render_script_instance));
+    ASSERT_EQ(0u, render_script_instance->m_CommandBuffer.Size());
+
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_FAILED, dmRender::UpdateRenderScriptInstance(render_script_instance, 0.0f));
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_FAILED, dmRender::UpdateRenderScriptInstance(render_script_instance, 0.0f));
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_FAILED, dmRender::UpdateRenderScriptInstance(render_script_instance, 0.0f));
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_FAILED, dmRender::UpdateRenderScriptInstance(render_script_instance, 0.0f));
+
+    // An unfinished recording is discarded at the end of the function
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::UpdateRenderScriptInstance(render_script_instance, 0.0f));
+    ASSERT_EQ(0u, render_script_instance->m_CommandBuffer.Size());
+
+    dmRender::DeleteRenderScriptInstance(render_script_instance);
+    dmRender::DeleteRenderScript(m_Context, render_script);
+}
+
 TEST_F(dmRenderScriptTest, TestLuaDraw_StringPredicate)
 {
     const char* script =
@@ -900,6 +1003,103 @@ TEST_F(dmRenderScriptTest, TestLuaWindowSize)
     dmRender::DeleteRenderScript(m_Context, render_script);
 }
 
+TEST_F(dmRenderScriptTest, TestLuaGetStats)
+{
+    const char* script =
+    "function init(self)\n"
+    "    self.pred = render.predicate({\"one\", \"two\"})\n"
+    "    self.frame = 0\n"
+    "end\n"
+    "function update(self)\n"
+    "    local stats = render.get_stats()\n"
+    "    assert(stats.draw_calls >= 0)\n"
+    "    assert(stats.texture_bytes >= 0)\n"
+    "    if self.frame == 0 then\n"
+    "        assert(#stats.predicates == 0)\n"
+    "    else\n"
+    "        assert(#stats.predicates == 1)\n"
+    "        local p = stats.predicates[1]\n"
+    "        assert(#p.tags == 2)\n"
+    "        assert(p.tags[1] == hash(\"one\"))\n"
+    "        assert(p.tags[2] == hash(\"two\"))\n"
+    "        assert(p.draw_calls == 0)\n"
+    "    end\n"
+    "    render.draw(self.pred)\n"
+    "    render.draw(self.pred)\n"
+    "    self.frame = self.frame + 1\n"
+    "end\n";
+    dmRender::HRenderScript render_script = dmRender::NewRenderScript(m_Context, LuaSourceFromString(script));
+    dmRender::HRenderScriptInstance render_script_instance = dmRender::NewRenderScriptInstance(m_Context, render_script);
+
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::InitRenderScriptInstance(render_script_instance));
+    dmRender::RenderListBegin(m_Context);
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::UpdateRenderScriptInstance(render_script_instance, 0.0f));
+    ASSERT_EQ(1u, m_Context->m_PredicateStats.Size());
+
+    dmRender::RenderListBegin(m_Context);
+    ASSERT_EQ(0u, m_Context->m_PredicateStats.Size());
+    ASSERT_EQ(1u, m_Context->m_LastPredicateStats.Size());
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::UpdateRenderScriptInstance(render_script_instance, 0.0f));
+
+    dmRender::DeleteRenderScriptInstance(render_script_instance);
+    dmRender::DeleteRenderScript(m_Context, render_script);
+}
+
+TEST_F(dmRenderScriptTest, TestDynamicResolution)
+{
+    ASSERT_EQ(1.0f, dmRender::GetResolutionScale(m_Context));
+
+    dmRender::DynamicResolutionParams params;
+    params.m_MinScale = 0.5f;
+    params.m_TargetGpuTime = 10.0f;
+    dmRender::EnableDynamicResolution(m_Context, params);
+    ASSERT_TRUE(dmRender::IsDynamicResolutionEnabled(m_Context));
+
+    // Over budget: the scale goes down in steps, until the min scale
+    float scale = dmRender::GetResolutionScale(m_Context);
+    for (uint32_t frame = 0; frame < 200; ++frame)
+    {
+        dmRender::AddDynamicResolutionGpuTime(m_Context, 40 * 1000000);
+        dmRender::RenderListBegin(m_Context);
+        float new_scale = dmRender::GetResolutionScale(m_Context);
+        ASSERT_LE(new_scale, scale);
+        ASSERT_LE(scale - new_scale, 0.1f + 0.0001f);
+        scale = new_scale;
+    }
+    ASSERT_EQ(0.5f, scale);
+
+    // Within the budget, but without headroom: the scale stays
+    for (uint32_t frame = 0; frame < 100; ++frame)
+    {
+        dmRender::AddDynamicResolutionGpuTime(m_Context, 9 * 1000000);
+        dmRender::RenderListBegin(m_Context);
+    }
+    ASSERT_EQ(0.5f, dmRender::GetResolutionScale(m_Context));
+
+    // Headroom: the scale goes up to the max scale
+    for (uint32_t frame = 0; frame < 200; ++frame)
+    {
+        dmRender::AddDynamicResolutionGpuTime(m_Context, 2 * 1000000);
+        dmRender::RenderListBegin(m_Context);
+    }
+    ASSERT_EQ(1.0f, dmRender::GetResolutionScale(m_Context));
+
+    const char* script =
+    "function init(self)\n"
+    "    render.enable_dynamic_resolution({ min_scale = 0.25, max_scale = 0.75, target_gpu_time = 8 })\n"
+    "    assert(render.get_resolution_scale() == 0.75)\n"
+    "    render.disable_dynamic_resolution()\n"
+    "    assert(render.get_resolution_scale() == 1)\n"
+    "end\n";
+    dmRender::HRenderScript render_script = dmRender::NewRenderScript(m_Context, LuaSourceFromString(script));
+    dmRender::HRenderScriptInstance render_script_instance = dmRender::NewRenderScriptInstance(m_Context, render_script);
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::InitRenderScriptInstance(render_script_instance));
+    ASSERT_FALSE(dmRender::IsDynamicResolutionEnabled(m_Context));
+
+    dmRender::DeleteRenderScriptInstance(render_script_instance);
+    dmRender::DeleteRenderScript(m_Context, render_script);
+}
+
 void TestDispatchCallback(dmMessage::Message *message, void* user_ptr)
 {
     if (message->m_Id == dmHashString64("test_message"))
@@ -1629,6 +1829,73 @@ TEST_F(dmRenderScriptTest, TestDispatch)
     dmRender::DeleteRenderScript(m_Context, render_script);
 }
 
+// The null adapter has no indirect draws or dispatches, so the commands are never added
+TEST_F(dmRenderScriptTest, TestIndirectUnsupported)
+{
+    const char* script =
+    "function init(self)\n"
+    "   assert(not pcall(render.dispatch_compute_indirect))\n"
+    "   assert(not pcall(render.draw_indirect, render.predicate({'tag'})))\n"
+    "end\n";
+    dmRender::HRenderScript render_script = dmRender::NewRenderScript(m_Context, LuaSourceFromString(script));
+    dmRender::HRenderScriptInstance render_script_instance = dmRender::NewRenderScriptInstance(m_Context, render_script);
+
+    ASSERT_FALSE(dmGraphics::IsComputeIndirectSupported(m_GraphicsContext));
+    ASSERT_FALSE(dmGraphics::IsMultiDrawIndirectSupported(m_GraphicsContext));
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::InitRenderScriptInstance(render_script_instance));
+    ASSERT_EQ(0u, render_script_instance->m_CommandBuffer.Size());
+
+    dmRender::DeleteRenderScriptInstance(render_script_instance);
+    dmRender::DeleteRenderScript(m_Context, render_script);
+}
+
+TEST_F(dmRenderScriptTest, TestInvalidate)
+{
+    const char* script =
+    "function init(self)\n"
+    "   render.invalidate()\n"
+    "end\n"
+    "function update(self)\n"
+    "   msg.post(\"@render:\", \"invalidate\")\n"
+    "end\n"
+    "function on_message(self, message_id, message, sender)\n"
+    "end\n";
+    dmRender::HRenderScript render_script = dmRender::NewRenderScript(m_Context, LuaSourceFromString(script));
+    dmRender::HRenderScriptInstance render_script_instance = dmRender::NewRenderScriptInstance(m_Context, render_script);
+
+    // The first frame is always rendered
+    ASSERT_TRUE(dmRender::ConsumeRenderInvalidated(m_Context));
+    ASSERT_FALSE(dmRender::ConsumeRenderInvalidated(m_Context));
+
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::InitRenderScriptInstance(render_script_instance));
+    ASSERT_TRUE(dmRender::ConsumeRenderInvalidated(m_Context));
+    ASSERT_FALSE(dmRender::ConsumeRenderInvalidated(m_Context));
+
+    dmRender::InvalidateRender(m_Context);
+    ASSERT_TRUE(dmRender::ConsumeRenderInvalidated(m_Context));
+    ASSERT_FALSE(dmRender::ConsumeRenderInvalidated(m_Context));
+
+    // The messages to the render script invalidate when they are dispatched
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::UpdateRenderScriptInstance(render_script_instance, 0.0f));
+    ASSERT_FALSE(dmRender::ConsumeRenderInvalidated(m_Context));
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::DispatchRenderScriptInstance(render_script_instance));
+    ASSERT_TRUE(dmRender::ConsumeRenderInvalidated(m_Context));
+    ASSERT_FALSE(dmRender::ConsumeRenderInvalidated(m_Context));
+
+    // Except for the view and projection, that the cameras post every frame
+    dmMessage::URL receiver;
+    dmMessage::ResetURL(&receiver);
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::GetSocket(dmRender::RENDER_SOCKET_NAME, &receiver.m_Socket));
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::Post(0x0, &receiver, dmHashString64("set_view_projection"), 0, 0, 0, 0, 0));
+    ASSERT_EQ(dmRender::RENDER_SCRIPT_RESULT_OK, dmRender::DispatchRenderScriptInstance(render_script_instance));
+    ASSERT_FALSE(dmRender::ConsumeRenderInvalidated(m_Context));
+
+    render_script_instance->m_CommandBuffer.SetSize(0);
+
+    dmRender::DeleteRenderScriptInstance(render_script_instance);
+    dmRender::DeleteRenderScript(m_Context, render_script);
+}
+
 extern "C" void dmExportedSymbols();
 
 int main(int argc, char **argv)
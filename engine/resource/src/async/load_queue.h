@@ -38,6 +38,12 @@ namespace dmLoadQueue
         FResourcePreload        m_CompleteFunction;
         ResourcePreloadHintInfo m_HintInfo;
         void*                   m_Context;
+        // If set, the resource is created on the load thread after the preload function,
+        // unless the preload function hinted any child resources
+        ResourceType*           m_CreateType;
+        dmhash_t                m_CanonicalPathHash;
+        // If the resource data may be handed out in place from a memory mapped archive, instead of being copied
+        bool                    m_LoadInPlace;
     };
 
     struct LoadResult
@@ -45,6 +51,15 @@ namespace dmLoadQueue
         dmResource::Result m_LoadResult;
         dmResource::Result m_PreloadResult;
         void* m_PreloadData;
+        // RESULT_PENDING unless the resource was created on the load thread
+        dmResource::Result m_CreateResult;
+        ResourceDescriptor m_Resource;
+        // If the buffer points into a mounted archive, and is valid after FreeLoad has been called
+        bool m_InPlace;
+        // Stage timings in microseconds, see dmResource::LoadTraceEntry. The create time is only set if m_CreateResult is
+        uint32_t m_LoadTime;
+        uint32_t m_PreloadTime;
+        uint32_t m_CreateTime;
     };
 
     HQueue CreateQueue(dmResource::HFactory factory);
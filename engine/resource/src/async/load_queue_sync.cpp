@@ -18,6 +18,8 @@
 
 #include <dlib/dstrings.h>
 #include <dlib/log.h>
+#include <dlib/profile.h>
+#include <dlib/time.h>
 
 namespace dmLoadQueue
 {
@@ -73,12 +75,28 @@ namespace dmLoadQueue
             return RESULT_INVALID_PARAM;
         }
 
-        load_result->m_LoadResult    = dmResource::LoadResource(queue->m_Factory, request->m_CanonicalPath, request->m_Name, buf, size);
+        uint64_t start = dmTime::GetTime();
+        load_result->m_InPlace = false;
+        if (request->m_PreloadInfo.m_LoadInPlace)
+        {
+            load_result->m_InPlace = dmResource::LoadResourceInPlace(queue->m_Factory, request->m_CanonicalPath, (const void**)buf, size) == dmResource::RESULT_OK;
+        }
+
+        if (load_result->m_InPlace)
+            load_result->m_LoadResult = dmResource::RESULT_OK;
+        else
+            load_result->m_LoadResult = dmResource::LoadResource(queue->m_Factory, request->m_CanonicalPath, request->m_Name, buf, size);
         load_result->m_PreloadResult = dmResource::RESULT_PENDING;
         load_result->m_PreloadData   = 0;
+        load_result->m_CreateResult  = dmResource::RESULT_PENDING;
+        load_result->m_LoadTime      = (uint32_t)(dmTime::GetTime() - start);
+        load_result->m_PreloadTime   = 0;
+        load_result->m_CreateTime    = 0;
 
         if (load_result->m_LoadResult == dmResource::RESULT_OK && request->m_PreloadInfo.m_CompleteFunction)
         {
+            DM_PROFILE("Preload");
+            start = dmTime::GetTime();
             dmResource::ResourcePreloadParams params;
             params.m_Factory             = queue->m_Factory;
             params.m_Context             = request->m_PreloadInfo.m_Context;
@@ -87,6 +105,7 @@ namespace dmLoadQueue
             params.m_HintInfo            = &request->m_PreloadInfo.m_HintInfo;
             params.m_PreloadData         = &load_result->m_PreloadData;
             load_result->m_PreloadResult = (dmResource::Result)request->m_PreloadInfo.m_CompleteFunction(&params);
+            load_result->m_PreloadTime   = (uint32_t)(dmTime::GetTime() - start);
         }
         return RESULT_OK;
     }
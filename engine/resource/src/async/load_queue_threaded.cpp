@@ -16,6 +16,8 @@
 #include "resource_private.h"
 #include "load_queue.h"
 
+#include <string.h>
+
 #include <dlib/dstrings.h>
 #include <dlib/log.h>
 #include <dlib/array.h>
@@ -23,10 +25,13 @@
 #include <dlib/mutex.h>
 #include <dlib/time.h>
 #include <dlib/condition_variable.h>
+#include <dlib/math.h>
+#include <dlib/profile.h>
 
 namespace dmLoadQueue
 {
-    // Implementation of dmLoadQueue with a thread that loads items in the order they are supplied,
+    // Implementation of dmLoadQueue with a pool of threads that pick up the items in the order they are supplied,
+    // and load them concurrently. The items may finish out of order.
 
     // Default to small buffers since a lot of what is loaded are just small objects anyway.
     // That way we can have more in flight, but throttle when max pending data grows too large anyway
@@ -36,12 +41,15 @@ namespace dmLoadQueue
     // This sets the bandwidth of the loader.
     const uint64_t MAX_PENDING_DATA = 4 * 1024 * 1024;
     const uint32_t QUEUE_SLOTS      = 16;
+    const uint32_t MAX_THREADS      = 8;
 
     struct Request
     {
         const char*                m_Name;
         const char*                m_CanonicalPath;
         dmResource::LoadBufferType m_Buffer;
+        const void*                m_InPlaceData; // Set if the data is used directly from the archive instead of m_Buffer
+        uint32_t                   m_InPlaceSize;
         PreloadInfo                m_PreloadInfo;
         LoadResult                 m_Result;
     };
@@ -49,21 +57,23 @@ namespace dmLoadQueue
     struct Queue
     {
         Request                                 m_Request[QUEUE_SLOTS];
+        dmThread::Thread                        m_Threads[MAX_THREADS];
         dmResource::HFactory                    m_Factory;
         dmMutex::HMutex                         m_Mutex;
         dmConditionVariable::HConditionVariable m_WakeupCond;
-        dmThread::Thread                        m_Thread;
+        uint32_t                                m_ThreadCount;
         uint32_t                                m_Front;
         uint32_t                                m_Back;
-        uint32_t                                m_Loaded;
+        uint32_t                                m_Next;
         uint64_t                                m_BytesWaiting;
         bool                                    m_Shutdown;
 
         // Circular queue with indexing as follow (exclusive end)
         //
-        //          m_Back           m_Loaded   m_Front
-        // [N/A]   [loaded] [loaded] [to-load]  [N/A]
+        //          m_Back                       m_Next     m_Front
+        // [N/A]   [loaded] [loading] [loaded]   [to-load]  [N/A]
         //
+        // The requests before m_Next are either loaded or being loaded by one of the threads
     };
 
     static Request* GetNextRequest(Queue* queue)
@@ -77,12 +87,12 @@ namespace dmLoadQueue
             return 0x0;
         }
 
-        if (queue->m_Loaded == queue->m_Front)
+        if (queue->m_Next == queue->m_Front)
         {
             return 0x0;
         }
 
-        return &queue->m_Request[queue->m_Loaded % QUEUE_SLOTS];
+        return &queue->m_Request[(queue->m_Next++) % QUEUE_SLOTS];
     }
 
     static void LoadThread(void* arg)
@@ -98,7 +108,6 @@ namespace dmLoadQueue
                 {
                     // Just finished one (from previous iteration)
                     queue->m_BytesWaiting += current->m_Buffer.Capacity();
-                    queue->m_Loaded++;
                     current->m_Result = result;
                     current           = 0;
                 }
@@ -110,11 +119,12 @@ namespace dmLoadQueue
                 current = GetNextRequest(queue);
                 if (current == 0x0)
                 {
-                    // Nothing to do, reset any buffers of inactive requests that are not at default capacity
+                    // Nothing to do, reset any buffers of free requests that are not at default capacity.
+                    // The buffers of the requests in use may be written by the other threads.
                     for (uint32_t i = 0; i < QUEUE_SLOTS; ++i)
                     {
                         Request* r = &queue->m_Request[i];
-                        if (r->m_Buffer.Size() == 0)
+                        if (r->m_Name == 0x0)
                         {
                             if (r->m_Buffer.Capacity() > DEFAULT_CAPACITY)
                             {
@@ -132,35 +142,92 @@ namespace dmLoadQueue
             {
                 // We use the temporary result object here to fill in the data so it can be written with the mutex held.
                 uint32_t size = 0;
+                void* data = 0;
 
                 assert(current->m_Buffer.Size() == 0);
-                if (current->m_Buffer.Capacity() != DEFAULT_CAPACITY)
+                current->m_InPlaceData = 0;
+                result.m_InPlace = false;
+                uint64_t start = dmTime::GetTime();
+                if (current->m_PreloadInfo.m_LoadInPlace)
                 {
-                    current->m_Buffer.SetCapacity(DEFAULT_CAPACITY);
+                    const void* in_place_data;
+                    if (dmResource::LoadResourceInPlace(queue->m_Factory, current->m_CanonicalPath, &in_place_data, &size) == dmResource::RESULT_OK)
+                    {
+                        current->m_InPlaceData = in_place_data;
+                        current->m_InPlaceSize = size;
+                        data = (void*)in_place_data;
+                        result.m_InPlace = true;
+                    }
                 }
 
-                result.m_LoadResult = dmResource::LoadResourceFromBuffer(queue->m_Factory, current->m_CanonicalPath, current->m_Name, &size, &current->m_Buffer);
+                if (result.m_InPlace)
+                {
+                    result.m_LoadResult = dmResource::RESULT_OK;
+                }
+                else
+                {
+                    if (current->m_Buffer.Capacity() != DEFAULT_CAPACITY)
+                    {
+                        current->m_Buffer.SetCapacity(DEFAULT_CAPACITY);
+                    }
+
+                    result.m_LoadResult = dmResource::LoadResourceFromBuffer(queue->m_Factory, current->m_CanonicalPath, current->m_Name, &size, &current->m_Buffer);
+                    data = current->m_Buffer.Begin();
+                }
                 result.m_PreloadResult = dmResource::RESULT_PENDING;
                 result.m_PreloadData   = 0;
+                result.m_CreateResult  = dmResource::RESULT_PENDING;
+                result.m_LoadTime      = (uint32_t)(dmTime::GetTime() - start);
+                result.m_PreloadTime   = 0;
+                result.m_CreateTime    = 0;
 
                 if (result.m_LoadResult == dmResource::RESULT_OK)
                 {
-                    assert(current->m_Buffer.Size() == size);
+                    assert(result.m_InPlace || current->m_Buffer.Size() == size);
                     if (current->m_PreloadInfo.m_CompleteFunction)
                     {
+                        DM_PROFILE("Preload");
+                        start = dmTime::GetTime();
                         ResourcePreloadParams params;
                         params.m_Factory       = queue->m_Factory;
                         params.m_Context       = current->m_PreloadInfo.m_Context;
-                        params.m_Buffer        = current->m_Buffer.Begin();
-                        params.m_BufferSize    = current->m_Buffer.Size();
+                        params.m_Buffer        = data;
+                        params.m_BufferSize    = size;
                         params.m_HintInfo      = &current->m_PreloadInfo.m_HintInfo;
                         params.m_PreloadData   = &result.m_PreloadData;
                         result.m_PreloadResult = (dmResource::Result)current->m_PreloadInfo.m_CompleteFunction(&params);
+                        result.m_PreloadTime   = (uint32_t)(dmTime::GetTime() - start);
                     }
                     else
                     {
                         result.m_PreloadResult = dmResource::RESULT_OK;
                     }
+
+                    // A resource without children doesn't depend on any other resource, so if its type allows it, we create it here.
+                    // The preloader still inserts it into the factory on the main thread.
+                    ResourceType* create_type = current->m_PreloadInfo.m_CreateType;
+                    if (create_type && result.m_PreloadResult == dmResource::RESULT_OK && current->m_PreloadInfo.m_HintInfo.m_HintCount == 0)
+                    {
+                        DM_PROFILE("CreateOnLoadThread");
+                        start = dmTime::GetTime();
+                        memset(&result.m_Resource, 0, sizeof(result.m_Resource));
+                        result.m_Resource.m_NameHash           = current->m_PreloadInfo.m_CanonicalPathHash;
+                        result.m_Resource.m_ReferenceCount     = 1;
+                        result.m_Resource.m_ResourceType       = create_type;
+                        result.m_Resource.m_ResourceSizeOnDisc = size;
+
+                        ResourceCreateParams params;
+                        params.m_Factory     = queue->m_Factory;
+                        params.m_Type        = create_type;
+                        params.m_Context     = create_type->m_Context;
+                        params.m_Buffer      = data;
+                        params.m_BufferSize  = size;
+                        params.m_PreloadData = result.m_PreloadData;
+                        params.m_Resource    = &result.m_Resource;
+                        params.m_Filename    = current->m_Name;
+                        result.m_CreateResult = (dmResource::Result)create_type->m_CreateFunction(&params);
+                        result.m_CreateTime   = (uint32_t)(dmTime::GetTime() - start);
+                    }
                 }
             }
         }
@@ -172,12 +239,19 @@ namespace dmLoadQueue
         q->m_Factory      = factory;
         q->m_Front        = 0;
         q->m_Back         = 0;
-        q->m_Loaded       = 0;
+        q->m_Next         = 0;
         q->m_Shutdown     = false;
         q->m_BytesWaiting = 0;
         q->m_Mutex        = dmMutex::New();
         q->m_WakeupCond   = dmConditionVariable::New();
-        q->m_Thread       = dmThread::New(&LoadThread, 128 * 1024, q, "AsyncLoad");
+        q->m_ThreadCount  = dmMath::Clamp(dmResource::GetLoadThreadCount(factory), 1u, MAX_THREADS);
+
+        for (uint32_t i = 0; i < q->m_ThreadCount; ++i)
+        {
+            char name[32];
+            dmSnPrintf(name, sizeof(name), "AsyncLoad%u", i);
+            q->m_Threads[i] = dmThread::New(&LoadThread, 128 * 1024, q, name);
+        }
 
         return q;
     }
@@ -187,10 +261,13 @@ namespace dmLoadQueue
         {
             dmMutex::ScopedLock lk(queue->m_Mutex);
             queue->m_Shutdown = true;
-            // Wake up the worker so it can exit and allow us to join
-            dmConditionVariable::Signal(queue->m_WakeupCond);
+            // Wake up the workers so they can exit and allow us to join
+            dmConditionVariable::Broadcast(queue->m_WakeupCond);
+        }
+        for (uint32_t i = 0; i < queue->m_ThreadCount; ++i)
+        {
+            dmThread::Join(queue->m_Threads[i]);
         }
-        dmThread::Join(queue->m_Thread);
         dmConditionVariable::Delete(queue->m_WakeupCond);
         dmMutex::Delete(queue->m_Mutex);
         delete queue;
@@ -209,16 +286,14 @@ namespace dmLoadQueue
         if ((queue->m_Front - queue->m_Back) == QUEUE_SLOTS)
             return 0;
 
-        if (queue->m_Loaded == queue->m_Front)
-        {
-            // The worker is sleeping waiting for request, wake it up
-            dmConditionVariable::Signal(queue->m_WakeupCond);
-        }
+        // Wake up one of the workers that are sleeping waiting for a request
+        dmConditionVariable::Signal(queue->m_WakeupCond);
 
         Request* req         = &queue->m_Request[(queue->m_Front++) % QUEUE_SLOTS];
         req->m_Name          = name;
         req->m_CanonicalPath = canonical_path;
 
+        req->m_InPlaceData         = 0;
         req->m_PreloadInfo         = *info;
         req->m_Result.m_LoadResult = dmResource::RESULT_PENDING;
 
@@ -231,8 +306,16 @@ namespace dmLoadQueue
         if (request->m_Result.m_LoadResult == dmResource::RESULT_PENDING)
             return RESULT_PENDING;
 
-        *buf         = request->m_Buffer.Begin();
-        *size        = request->m_Buffer.Size();
+        if (request->m_InPlaceData)
+        {
+            *buf  = (void*)request->m_InPlaceData;
+            *size = request->m_InPlaceSize;
+        }
+        else
+        {
+            *buf  = request->m_Buffer.Begin();
+            *size = request->m_Buffer.Size();
+        }
         *load_result = request->m_Result;
 
         return RESULT_OK;
@@ -246,14 +329,19 @@ namespace dmLoadQueue
 
         // Make sure we don't copy any data if we reallocate the buffer
         request->m_Buffer.SetSize(0);
+        request->m_InPlaceData = 0;
 
         uint32_t buffer_capacity = request->m_Buffer.Capacity();
         queue->m_BytesWaiting -= buffer_capacity;
-        // If we either have blocked further processing by exceeding MAX_PENDING_DATA or
-        // the buffer has a non-default capacity, we want to wake up the worker
-        if (buffer_capacity != DEFAULT_CAPACITY || (old_bytes_waiting >= MAX_PENDING_DATA && queue->m_BytesWaiting < MAX_PENDING_DATA))
+        // If we have blocked further processing by exceeding MAX_PENDING_DATA, all the workers
+        // may be waiting for requests. If the buffer has a non-default capacity, we want one of them to free it.
+        if (old_bytes_waiting >= MAX_PENDING_DATA && queue->m_BytesWaiting < MAX_PENDING_DATA)
+        {
+            // Wake up the threads, we can now fit new requests
+            dmConditionVariable::Broadcast(queue->m_WakeupCond);
+        }
+        else if (buffer_capacity != DEFAULT_CAPACITY)
         {
-            // Wake up thread, we can now fit a new request
             dmConditionVariable::Signal(queue->m_WakeupCond);
         }
 
@@ -261,7 +349,7 @@ namespace dmLoadQueue
         request->m_Name          = 0x0;
         request->m_CanonicalPath = 0x0;
 
-        while (queue->m_Back != queue->m_Loaded && queue->m_Request[queue->m_Back % QUEUE_SLOTS].m_Name == 0x0)
+        while (queue->m_Back != queue->m_Next && queue->m_Request[queue->m_Back % QUEUE_SLOTS].m_Name == 0x0)
         {
             queue->m_Back++;
         }
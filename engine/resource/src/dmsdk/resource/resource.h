@@ -320,6 +320,9 @@ void ResourceTypeSetCreateFn(HResourceType type, FResourceCreate fn);
 void ResourceTypeSetPostCreateFn(HResourceType type, FResourcePostCreate fn);
 void ResourceTypeSetDestroyFn(HResourceType type, FResourceDestroy fn);
 void ResourceTypeSetRecreateFn(HResourceType type, FResourceRecreate fn);
+void ResourceTypeSetCreateThreadSafe(HResourceType type, bool thread_safe);
+void ResourceTypeSetLoadInPlace(HResourceType type, bool in_place);
+void ResourceTypeSetCacheBudget(HResourceType type, uint32_t budget);
 
 // internal
 ResourceResult ResourceRegisterType(HResourceFactory factory,
@@ -203,6 +203,35 @@
  * @param fn [type: FResourceRecreate] Function to be called when recreating the resource
  */
 
+/*# set if the create function of the type may be called on the resource load threads
+ * When set, the preloader calls the create function on a load thread, right after the preload function,
+ * for the resources that don't hint any child resources. The create function must then not call
+ * any resource factory functions (such as getting other resources), and must only touch data that is safe
+ * to access from other threads. Any work that must be done on the main thread goes into the post create function.
+ * @name ResourceTypeSetCreateThreadSafe
+ * @param type [type: HResourceType] The type
+ * @param thread_safe [type: bool] If the create function is thread safe. Default is false
+ */
+
+/*# set if the resource data may be used in place
+ * When set, resources that are stored uncompressed and unencrypted in a memory mapped archive are given
+ * to the preload and create functions as a pointer directly into the archive, instead of being copied into a
+ * load buffer first. The buffer must then be treated as read only. It is valid for as long as the archive is mounted.
+ * @name ResourceTypeSetLoadInPlace
+ * @param type [type: HResourceType] The type
+ * @param in_place [type: bool] If the data may be used in place. Default is false
+ */
+
+/*# set the cache budget of the type
+ * When a resource of the type is no longer referenced, it is kept in the cache instead of being destroyed,
+ * as long as the total size of the cached resources of the type is within the budget. Getting the resource
+ * again brings it back from the cache without reloading it. The least recently released resources are destroyed first.
+ * The size of a resource is its reported resource size, or its size on disc if it doesn't report one.
+ * @name ResourceTypeSetCacheBudget
+ * @param type [type: HResourceType] The type
+ * @param budget [type: uint32_t] The budget in bytes. Default is 0, which disables the cache for the type
+ */
+
 /////////////////////////////////////////////////////////////
 // Resource descriptors
 
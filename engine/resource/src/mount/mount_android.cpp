@@ -105,6 +105,14 @@ namespace dmResource
         return RESULT_OK;
     }
 
+    void PrefetchMappedData(const void* data, uint32_t size)
+    {
+        uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+        uintptr_t start = (uintptr_t)data & ~(page_size - 1);
+        uintptr_t end = (uintptr_t)data + size;
+        madvise((void*)start, end - start, MADV_WILLNEED);
+    }
+
     Result MountManifest(const char* manifest_filename, void*& out_map, uint32_t& out_size)
     {
         out_size = 0;
@@ -135,6 +135,25 @@ Result ReadFile(HArchive archive, dmhash_t path_hash, const char* path, uint8_t*
     return archive->m_Loader->m_ReadFile(archive->m_Internal, path_hash, path, buffer, buffer_len);
 }
 
+bool CanReadConcurrently(HArchive archive)
+{
+    return archive->m_Loader->m_ConcurrentReads;
+}
+
+Result GetFileData(HArchive archive, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_len)
+{
+    if (archive->m_Loader->m_GetFileData)
+        return archive->m_Loader->m_GetFileData(archive->m_Internal, path_hash, path, data, data_len);
+    return RESULT_NOT_SUPPORTED;
+}
+
+Result ReadFilePartial(HArchive archive, dmhash_t path_hash, const char* path, uint32_t offset, uint32_t size, uint8_t* buffer, uint32_t* nread)
+{
+    if (archive->m_Loader->m_ReadFilePartial)
+        return archive->m_Loader->m_ReadFilePartial(archive->m_Internal, path_hash, path, offset, size, buffer, nread);
+    return RESULT_NOT_SUPPORTED;
+}
+
 Result GetManifest(HArchive archive, dmResource::HManifest* out_manifest)
 {
     if (archive->m_Loader->m_GetManifest)
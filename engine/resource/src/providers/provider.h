@@ -50,6 +50,10 @@ namespace dmResourceProvider
 
     typedef Result (*FGetFileSize)(HArchiveInternal archive, dmhash_t path_hash, const char* path, uint32_t* file_size);
     typedef Result (*FReadFile)(HArchiveInternal archive, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_len);
+    // Optional. Gets the file data in place (e.g. in a memory mapped archive). The data is valid while the archive is mounted
+    typedef Result (*FGetFileData)(HArchiveInternal archive, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_len);
+    // Optional. Reads a part of the file, nread is less than size at the end of the file
+    typedef Result (*FReadFilePartial)(HArchiveInternal archive, dmhash_t path_hash, const char* path, uint32_t offset, uint32_t size, uint8_t* buffer, uint32_t* nread);
     typedef Result (*FWriteFile)(HArchiveInternal archive, dmhash_t path_hash, const char* path, const uint8_t* buffer, uint32_t buffer_len);
     typedef Result (*FGetManifest)(HArchiveInternal, dmResource::HManifest*); // In order for other providers to get the base manifest
     typedef Result (*FSetManifest)(HArchiveInternal, dmResource::HManifest);  // In order to set a downloaded manifest to a provider
@@ -71,6 +75,12 @@ namespace dmResourceProvider
 
     Result GetFileSize(HArchive archive, dmhash_t path_hash, const char* path, uint32_t* file_size);
     Result ReadFile(HArchive archive, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_len);
+    // Returns true if ReadFile may be called from several threads at the same time
+    bool   CanReadConcurrently(HArchive archive);
+    // Returns RESULT_NOT_SUPPORTED if the file data isn't available in place
+    Result GetFileData(HArchive archive, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_len);
+    // Returns RESULT_NOT_SUPPORTED if the file can't be read partially (e.g. it's compressed)
+    Result ReadFilePartial(HArchive archive, dmhash_t path_hash, const char* path, uint32_t offset, uint32_t size, uint8_t* buffer, uint32_t* nread);
     Result WriteFile(HArchive archive, dmhash_t path_hash, const char* path, const uint8_t* buffer, uint32_t buffer_len);
 
 
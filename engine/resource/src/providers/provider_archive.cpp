@@ -234,6 +234,36 @@ namespace dmResourceProviderArchive
         return dmResourceProvider::RESULT_NOT_FOUND;
     }
 
+    static dmResourceProvider::Result GetFileData(dmResourceProvider::HArchiveInternal internal, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_len)
+    {
+        GameArchiveFile* archive = (GameArchiveFile*)internal;
+        EntryInfo* entry = archive->m_EntryMap.Get(path_hash);
+        if (entry)
+        {
+            if (dmResourceArchive::RESULT_OK != dmResourceArchive::GetEntryDataInPlace(archive->m_ArchiveIndex, entry->m_ArchiveInfo, data))
+                return dmResourceProvider::RESULT_NOT_SUPPORTED;
+            *data_len = dmEndian::ToNetwork(entry->m_ArchiveInfo->m_ResourceSize);
+            return dmResourceProvider::RESULT_OK;
+        }
+
+        return dmResourceProvider::RESULT_NOT_FOUND;
+    }
+
+    static dmResourceProvider::Result ReadFilePartial(dmResourceProvider::HArchiveInternal internal, dmhash_t path_hash, const char* path, uint32_t offset, uint32_t size, uint8_t* buffer, uint32_t* nread)
+    {
+        GameArchiveFile* archive = (GameArchiveFile*)internal;
+        EntryInfo* entry = archive->m_EntryMap.Get(path_hash);
+        if (entry)
+        {
+            dmResourceArchive::Result r = dmResourceArchive::ReadEntryPartial(archive->m_ArchiveIndex, entry->m_ArchiveInfo, offset, size, buffer, nread);
+            if (dmResourceArchive::RESULT_NOT_FOUND == r)
+                return dmResourceProvider::RESULT_NOT_SUPPORTED;
+            return dmResourceArchive::RESULT_OK == r ? dmResourceProvider::RESULT_OK : dmResourceProvider::RESULT_IO_ERROR;
+        }
+
+        return dmResourceProvider::RESULT_NOT_FOUND;
+    }
+
     static dmResourceProvider::Result GetManifest(dmResourceProvider::HArchiveInternal internal, dmResource::HManifest* out_manifest)
     {
         GameArchiveFile* archive = (GameArchiveFile*)internal;
@@ -253,6 +283,8 @@ namespace dmResourceProviderArchive
         loader->m_GetManifest   = GetManifest;
         loader->m_GetFileSize   = GetFileSize;
         loader->m_ReadFile      = ReadFile;
+        loader->m_GetFileData   = GetFileData;
+        loader->m_ReadFilePartial = ReadFilePartial;
     }
 
     DM_DECLARE_ARCHIVE_LOADER(ResourceProviderArchive, "archive", SetupArchiveLoader);
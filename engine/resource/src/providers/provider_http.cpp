@@ -15,11 +15,17 @@
 #include "provider.h"
 #include "provider_private.h"
 #include "../resource_util.h"
+#include "../resource_archive.h"
+#include "../resource_manifest.h"
+#include "../resource_manifest_private.h"
 
 #include <dlib/dstrings.h>
 #include <dlib/array.h>
+#include <dlib/endian.h>
 #include <dlib/hash.h>
+#include <dlib/hashtable.h>
 #include <dlib/log.h>
+#include <dlib/math.h>
 #include <dlib/sys.h>
 
 #include <dlib/http_client.h>
@@ -31,6 +37,48 @@
 namespace dmResourceProviderHttp
 {
 
+// When mounted with a manifest uri (e.g. "https://host/path/game.dmanifest"), the resources are read from the
+// archive on the server. The manifest and the archive index are downloaded when mounting, and the resource data
+// (game.arcd) is read with range requests. The requests fetch whole blocks, and a few blocks ahead, into a
+// small cache. The resources are stored in load order, so the nearby resources come with the same request.
+static const uint32_t ARCHIVE_BLOCK_SIZE        = 64 * 1024;
+static const uint32_t ARCHIVE_MAX_BLOCKS        = 64;
+static const uint32_t ARCHIVE_READ_AHEAD_BLOCKS = 3;
+static const uint32_t ARCHIVE_MAX_CACHED_READ   = ARCHIVE_BLOCK_SIZE * ARCHIVE_MAX_BLOCKS / 4; // Larger reads bypass the cache
+static const uint32_t ARCHIVE_INVALID_BLOCK     = 0xFFFFFFFF;
+
+struct ArchiveBlock
+{
+    uint8_t*    m_Data;
+    uint32_t    m_Index;    // Index of the block in the resource data, or ARCHIVE_INVALID_BLOCK
+    uint32_t    m_Size;     // Less than ARCHIVE_BLOCK_SIZE at the end of the file
+    uint32_t    m_LastUsed;
+};
+
+struct HttpArchive
+{
+    HttpArchive()
+    : m_Manifest(0)
+    , m_ArchiveIndex(0)
+    , m_UseCount(0)
+    , m_WarnedNoRanges(0)
+    {
+        memset(m_Blocks, 0, sizeof(m_Blocks));
+        for (uint32_t i = 0; i < ARCHIVE_MAX_BLOCKS; ++i)
+            m_Blocks[i].m_Index = ARCHIVE_INVALID_BLOCK;
+    }
+
+    dmResource::HManifest                           m_Manifest;
+    dmResourceArchive::HArchiveIndexContainer       m_ArchiveIndex;
+    dmArray<uint8_t>                                m_IndexData;    // The downloaded .arci
+    dmHashTable64<dmResourceArchive::EntryData*>    m_EntryMap;     // url hash -> entry in the archive
+    char                                            m_DataUri[dmResource::RESOURCE_PATH_MAX*2]; // The encoded path of the .arcd
+    ArchiveBlock                                    m_Blocks[ARCHIVE_MAX_BLOCKS];
+    dmArray<uint8_t>                                m_FetchBuffer;
+    uint32_t                                        m_UseCount;
+    uint32_t                                        m_WarnedNoRanges:1;
+};
+
 struct HttpProviderContext
 {
     dmURI::Parts            m_BaseUri;
@@ -41,6 +89,15 @@ struct HttpProviderContext
     int32_t                 m_HttpContentLength;        // Total number bytes loaded in current GET-request
     uint32_t                m_HttpTotalBytesStreamed;
     int                     m_HttpStatus;
+
+    HttpArchive*            m_Archive;                  // Only when mounted with a manifest uri
+
+    // The current range request. The data is streamed directly to the range buffer
+    uint8_t*                m_RangeBuffer;
+    uint32_t                m_RangeOffset;
+    uint32_t                m_RangeSize;
+    uint32_t                m_RangeReceived;
+    char                    m_RangeHeader[64];
 };
 
 static void HttpHeader(dmHttpClient::HResponse response, void* user_data, int status_code, const char* key, const char* value)
@@ -48,6 +105,9 @@ static void HttpHeader(dmHttpClient::HResponse response, void* user_data, int st
     HttpProviderContext* archive = (HttpProviderContext*)user_data;
     archive->m_HttpStatus = status_code;
 
+    if (archive->m_RangeBuffer)
+        return;
+
     if (dmStrCaseCmp(key, "Content-Length") == 0)
     {
         archive->m_HttpContentLength = strtol(value, 0, 10);
@@ -68,6 +128,37 @@ static void HttpContent(dmHttpClient::HResponse, void* user_data, int status_cod
     (void) status_code;
     (void) method;
 
+    if (archive->m_RangeBuffer)
+    {
+        archive->m_HttpStatus = status_code;
+        if (!content_data)
+        {
+            if (content_data_size)
+            {
+                // The request is restarted
+                archive->m_HttpTotalBytesStreamed = 0;
+                archive->m_RangeReceived = 0;
+            }
+            return;
+        }
+
+        if (status_code != 200 && status_code != 206)
+            return;
+
+        // A server without range support sends the whole file (200), so we pick the range from it
+        uint32_t range_start = status_code == 206 ? 0 : archive->m_RangeOffset;
+        uint32_t range_end = range_start + archive->m_RangeSize;
+        uint32_t begin = dmMath::Max(archive->m_HttpTotalBytesStreamed, range_start);
+        uint32_t end = dmMath::Min(archive->m_HttpTotalBytesStreamed + content_data_size, range_end);
+        if (begin < end)
+        {
+            memcpy(archive->m_RangeBuffer + (begin - range_start), (const uint8_t*)content_data + (begin - archive->m_HttpTotalBytesStreamed), end - begin);
+            archive->m_RangeReceived = dmMath::Max(archive->m_RangeReceived, end - range_start);
+        }
+        archive->m_HttpTotalBytesStreamed += content_data_size;
+        return;
+    }
+
     if (!content_data && content_data_size)
     {
         archive->m_HttpBuffer.SetSize(0);
@@ -87,6 +178,16 @@ static void HttpContent(dmHttpClient::HResponse, void* user_data, int status_cod
     archive->m_HttpTotalBytesStreamed += content_data_size;
 }
 
+static dmHttpClient::Result HttpWriteHeaders(dmHttpClient::HResponse response, void* user_data)
+{
+    HttpProviderContext* archive = (HttpProviderContext*)user_data;
+    if (archive->m_RangeBuffer)
+    {
+        return dmHttpClient::WriteHeader(response, "Range", archive->m_RangeHeader);
+    }
+    return dmHttpClient::RESULT_OK;
+}
+
 static bool MatchesUri(const dmURI::Parts* uri)
 {
     return strcmp(uri->m_Scheme, "http") == 0 || strcmp(uri->m_Scheme, "https") == 0;
@@ -100,9 +201,22 @@ static char* CreateEncodedUri(const dmURI::Parts* uri, const char* path, char* b
     return buffer;
 }
 
+static void DeleteArchive(HttpArchive* archive)
+{
+    if (archive->m_ArchiveIndex)
+        dmResourceArchive::Delete(archive->m_ArchiveIndex);
+    if (archive->m_Manifest)
+        dmResource::DeleteManifest(archive->m_Manifest);
+    for (uint32_t i = 0; i < ARCHIVE_MAX_BLOCKS; ++i)
+        delete[] archive->m_Blocks[i].m_Data;
+    delete archive;
+}
+
 static void DeleteHttpArchiveInternal(dmResourceProvider::HArchiveInternal _archive)
 {
     HttpProviderContext* archive = (HttpProviderContext*)_archive;
+    if (archive->m_Archive)
+        DeleteArchive(archive->m_Archive);
     if (archive->m_HttpClient)
         dmHttpClient::Delete(archive->m_HttpClient);
     if (archive->m_HttpCache)
@@ -110,42 +224,10 @@ static void DeleteHttpArchiveInternal(dmResourceProvider::HArchiveInternal _arch
 
     archive->m_HttpClient = 0;
     archive->m_HttpCache = 0;
+    archive->m_Archive = 0;
     delete archive;
 }
 
-static dmResourceProvider::Result Mount(const dmURI::Parts* uri, dmResourceProvider::HArchive base_archive, dmResourceProvider::HArchiveInternal* out_archive)
-{
-    if (!MatchesUri(uri))
-        return dmResourceProvider::RESULT_NOT_SUPPORTED;
-
-    HttpProviderContext* archive = new HttpProviderContext;
-    memset(archive, 0, sizeof(HttpProviderContext));
-    memcpy(&archive->m_BaseUri, uri, sizeof(dmURI::Parts));
-
-    dmHttpClient::NewParams http_params;
-    http_params.m_HttpHeader = &HttpHeader;
-    http_params.m_HttpContent = &HttpContent;
-    http_params.m_Userdata = archive;
-    http_params.m_HttpCache = archive->m_HttpCache;
-    archive->m_HttpClient = dmHttpClient::New(&http_params, uri->m_Hostname, uri->m_Port, strcmp(uri->m_Scheme, "https") == 0, 0);
-    if (!archive->m_HttpClient)
-    {
-        char buffer[dmResource::RESOURCE_PATH_MAX*2];
-        dmLogError("Failed to connect to: %s", CreateEncodedUri(uri, "", buffer, sizeof(buffer)));
-        DeleteHttpArchiveInternal(archive);
-        return dmResourceProvider::RESULT_ERROR_UNKNOWN;
-    }
-
-    *out_archive = (dmResourceProvider::HArchiveInternal)archive;
-    return dmResourceProvider::RESULT_OK;
-}
-
-static dmResourceProvider::Result Unmount(dmResourceProvider::HArchiveInternal archive)
-{
-    DeleteHttpArchiveInternal((HttpProviderContext*)archive);
-    return dmResourceProvider::RESULT_OK;
-}
-
 static void ResetHttpInfo(HttpProviderContext* archive)
 {
     archive->m_HttpContentLength = -1;
@@ -155,7 +237,7 @@ static void ResetHttpInfo(HttpProviderContext* archive)
 }
 
 // Note. This is used in a synchronous manner.
-static dmResourceProvider::Result GetRequestFromUri(HttpProviderContext* archive, const char* method, const char* path, uint32_t* buffer_length, uint8_t* buffer)
+static dmResourceProvider::Result DoRequest(HttpProviderContext* archive, const char* method, const char* encoded_uri)
 {
     ResetHttpInfo(archive);
 
@@ -163,17 +245,15 @@ static dmResourceProvider::Result GetRequestFromUri(HttpProviderContext* archive
     // if (factory->m_HttpCache)
     //     dmHttpCache::SetConsistencyPolicy(factory->m_HttpCache, dmHttpCache::CONSISTENCY_POLICY_VERIFY);
 
-    char encoded_uri[dmResource::RESOURCE_PATH_MAX*2];
-    CreateEncodedUri(&archive->m_BaseUri, path, encoded_uri, sizeof(encoded_uri));
-
     dmHttpClient::Result http_result = dmHttpClient::Request(archive->m_HttpClient, method, encoded_uri);
 
     // // Always verify cache for reloaded resources
     // if (factory->m_HttpCache)
     //     dmHttpCache::SetConsistencyPolicy(factory->m_HttpCache, dmHttpCache::CONSISTENCY_POLICY_TRUSTED);
 
+    // 206 (PARTIAL CONTENT) is the response to a range request
     bool http_result_ok = http_result == dmHttpClient::RESULT_OK ||
-                         (http_result == dmHttpClient::RESULT_NOT_200_OK && archive->m_HttpStatus == 304);
+                         (http_result == dmHttpClient::RESULT_NOT_200_OK && (archive->m_HttpStatus == 304 || archive->m_HttpStatus == 206));
 
     if (!http_result_ok)
     {
@@ -194,6 +274,258 @@ static dmResourceProvider::Result GetRequestFromUri(HttpProviderContext* archive
             return dmResourceProvider::RESULT_IO_ERROR;
         }
     }
+    return dmResourceProvider::RESULT_OK;
+}
+
+// Reads a range of the archive data into the buffer
+static dmResourceProvider::Result RequestRange(HttpProviderContext* archive, uint32_t offset, uint32_t size, uint8_t* buffer, uint32_t* nread)
+{
+    archive->m_RangeBuffer = buffer;
+    archive->m_RangeOffset = offset;
+    archive->m_RangeSize = size;
+    archive->m_RangeReceived = 0;
+    dmSnPrintf(archive->m_RangeHeader, sizeof(archive->m_RangeHeader), "bytes=%u-%u", offset, offset + size - 1);
+
+    dmResourceProvider::Result result = DoRequest(archive, "GET", archive->m_Archive->m_DataUri);
+
+    archive->m_RangeBuffer = 0;
+    if (result != dmResourceProvider::RESULT_OK)
+        return result;
+
+    if (archive->m_HttpStatus == 200 && !archive->m_Archive->m_WarnedNoRanges)
+    {
+        dmLogWarning("The server doesn't support range requests, each read downloads the whole archive: %s", archive->m_Archive->m_DataUri);
+        archive->m_Archive->m_WarnedNoRanges = 1;
+    }
+
+    *nread = archive->m_RangeReceived;
+    return dmResourceProvider::RESULT_OK;
+}
+
+static ArchiveBlock* FindBlock(HttpArchive* archive, uint32_t index)
+{
+    for (uint32_t i = 0; i < ARCHIVE_MAX_BLOCKS; ++i)
+    {
+        if (archive->m_Blocks[i].m_Index == index)
+            return &archive->m_Blocks[i];
+    }
+    return 0;
+}
+
+static ArchiveBlock* AllocateBlock(HttpArchive* archive, uint32_t index)
+{
+    // The least recently used block (the unused blocks are never used)
+    ArchiveBlock* block = &archive->m_Blocks[0];
+    for (uint32_t i = 1; i < ARCHIVE_MAX_BLOCKS; ++i)
+    {
+        if (archive->m_Blocks[i].m_LastUsed < block->m_LastUsed)
+            block = &archive->m_Blocks[i];
+    }
+    if (!block->m_Data)
+        block->m_Data = new uint8_t[ARCHIVE_BLOCK_SIZE];
+    block->m_Index = index;
+    block->m_LastUsed = ++archive->m_UseCount;
+    return block;
+}
+
+// Fetches the missing blocks from first to last, and the missing blocks just after them, with one request
+static dmResourceProvider::Result FetchBlocks(HttpProviderContext* context, uint32_t first, uint32_t last)
+{
+    HttpArchive* archive = context->m_Archive;
+
+    uint32_t count = 1;
+    while (first + count <= last + ARCHIVE_READ_AHEAD_BLOCKS && !FindBlock(archive, first + count))
+        ++count;
+
+    uint32_t size = count * ARCHIVE_BLOCK_SIZE;
+    if (archive->m_FetchBuffer.Capacity() < size)
+        archive->m_FetchBuffer.SetCapacity(size);
+
+    uint32_t nread = 0;
+    dmResourceProvider::Result result = RequestRange(context, first * ARCHIVE_BLOCK_SIZE, size, archive->m_FetchBuffer.Begin(), &nread);
+    if (result != dmResourceProvider::RESULT_OK)
+        return result;
+
+    // The response is shorter at the end of the file
+    for (uint32_t i = 0; i < count && i * ARCHIVE_BLOCK_SIZE < nread; ++i)
+    {
+        ArchiveBlock* block = AllocateBlock(archive, first + i);
+        block->m_Size = dmMath::Min(ARCHIVE_BLOCK_SIZE, nread - i * ARCHIVE_BLOCK_SIZE);
+        memcpy(block->m_Data, archive->m_FetchBuffer.Begin() + i * ARCHIVE_BLOCK_SIZE, block->m_Size);
+    }
+    return dmResourceProvider::RESULT_OK;
+}
+
+// Called by the archive to read the resource data
+static dmResourceArchive::Result ReadArchiveData(void* _context, uint32_t offset, uint32_t size, void* buffer)
+{
+    HttpProviderContext* context = (HttpProviderContext*)_context;
+    HttpArchive* archive = context->m_Archive;
+    uint8_t* out = (uint8_t*)buffer;
+
+    if (size > ARCHIVE_MAX_CACHED_READ)
+    {
+        // Read large resources directly, rather than flushing the cache
+        uint32_t nread = 0;
+        dmResourceProvider::Result result = RequestRange(context, offset, size, out, &nread);
+        return (result == dmResourceProvider::RESULT_OK && nread == size) ? dmResourceArchive::RESULT_OK : dmResourceArchive::RESULT_IO_ERROR;
+    }
+
+    uint32_t end = offset + size;
+    while (offset < end)
+    {
+        uint32_t index = offset / ARCHIVE_BLOCK_SIZE;
+        ArchiveBlock* block = FindBlock(archive, index);
+        if (!block)
+        {
+            if (FetchBlocks(context, index, (end - 1) / ARCHIVE_BLOCK_SIZE) != dmResourceProvider::RESULT_OK)
+                return dmResourceArchive::RESULT_IO_ERROR;
+            block = FindBlock(archive, index);
+        }
+
+        uint32_t block_offset = offset - index * ARCHIVE_BLOCK_SIZE;
+        if (!block || block_offset >= block->m_Size)
+            return dmResourceArchive::RESULT_IO_ERROR; // Past the end of the file
+        block->m_LastUsed = ++archive->m_UseCount;
+
+        uint32_t n = dmMath::Min(block->m_Size - block_offset, end - offset);
+        memcpy(out, block->m_Data + block_offset, n);
+        out += n;
+        offset += n;
+    }
+    return dmResourceArchive::RESULT_OK;
+}
+
+static bool IsArchiveUri(const dmURI::Parts* uri)
+{
+    const char* dot = strrchr(uri->m_Path, '.');
+    return dot != 0 && strcmp(dot, ".dmanifest") == 0;
+}
+
+// Downloads a file of the archive, and leaves it in the http buffer
+static dmResourceProvider::Result DownloadArchiveFile(HttpProviderContext* archive, const char* base_path, const char* suffix)
+{
+    char path[dmResource::RESOURCE_PATH_MAX];
+    char encoded_uri[dmResource::RESOURCE_PATH_MAX*2];
+    dmSnPrintf(path, sizeof(path), "%s%s", base_path, suffix);
+    dmURI::Encode(path, encoded_uri, sizeof(encoded_uri), 0);
+
+    dmResourceProvider::Result result = DoRequest(archive, "GET", encoded_uri);
+    if (result != dmResourceProvider::RESULT_OK)
+        dmLogError("Failed to download archive file '%s': %d", encoded_uri, result);
+    return result;
+}
+
+static dmResourceProvider::Result MountArchive(HttpProviderContext* context)
+{
+    char base_path[dmResource::RESOURCE_PATH_MAX];
+    dmStrlCpy(base_path, context->m_BaseUri.m_Path, sizeof(base_path));
+    *strrchr(base_path, '.') = 0;
+
+    HttpArchive* archive = new HttpArchive;
+    context->m_Archive = archive;
+
+    dmResourceProvider::Result result = DownloadArchiveFile(context, base_path, ".dmanifest");
+    if (result != dmResourceProvider::RESULT_OK)
+        return result;
+
+    if (dmResource::RESULT_OK != dmResource::LoadManifestFromBuffer((const uint8_t*)context->m_HttpBuffer.Begin(), context->m_HttpBuffer.Size(), &archive->m_Manifest))
+        return dmResourceProvider::RESULT_INVAL_ERROR;
+
+    result = DownloadArchiveFile(context, base_path, ".arci");
+    if (result != dmResourceProvider::RESULT_OK)
+        return result;
+
+    // The index is kept, as the archive points into it
+    uint32_t index_size = context->m_HttpBuffer.Size();
+    if (index_size < sizeof(dmResourceArchive::ArchiveIndex))
+        return dmResourceProvider::RESULT_INVAL_ERROR;
+    archive->m_IndexData.SetCapacity(index_size);
+    archive->m_IndexData.PushArray((const uint8_t*)context->m_HttpBuffer.Begin(), index_size);
+    context->m_HttpBuffer.SetCapacity(0);
+
+    char data_path[dmResource::RESOURCE_PATH_MAX];
+    dmSnPrintf(data_path, sizeof(data_path), "%s.arcd", base_path);
+    dmURI::Encode(data_path, archive->m_DataUri, sizeof(archive->m_DataUri), 0);
+
+    if (dmResourceArchive::RESULT_OK != dmResourceArchive::WrapArchiveIndex(archive->m_IndexData.Begin(), index_size, ReadArchiveData, context, &archive->m_ArchiveIndex))
+        return dmResourceProvider::RESULT_INVAL_ERROR;
+
+    uint32_t count = archive->m_Manifest->m_DDFData->m_Resources.m_Count;
+    archive->m_EntryMap.SetCapacity(dmMath::Max(1U, (count*2)/3), count);
+
+    dmLiveUpdateDDF::HashAlgorithm algorithm = archive->m_Manifest->m_DDFData->m_Header.m_ResourceHashAlgorithm;
+    uint32_t hash_len = dmResource::HashLength(algorithm);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmLiveUpdateDDF::ResourceEntry* entry = &archive->m_Manifest->m_DDFData->m_Resources.m_Data[i];
+        dmResourceArchive::EntryData* entry_data;
+        if (dmResourceArchive::RESULT_OK == dmResourceArchive::FindEntry(archive->m_ArchiveIndex, entry->m_Hash.m_Data.m_Data, hash_len, &entry_data))
+        {
+            archive->m_EntryMap.Put(entry->m_UrlHash, entry_data);
+        }
+    }
+    return dmResourceProvider::RESULT_OK;
+}
+
+static dmResourceProvider::Result Mount(const dmURI::Parts* uri, dmResourceProvider::HArchive base_archive, dmResourceProvider::HArchiveInternal* out_archive)
+{
+    if (!MatchesUri(uri))
+        return dmResourceProvider::RESULT_NOT_SUPPORTED;
+
+    HttpProviderContext* archive = new HttpProviderContext;
+    memset(archive, 0, sizeof(HttpProviderContext));
+    memcpy(&archive->m_BaseUri, uri, sizeof(dmURI::Parts));
+
+    dmHttpClient::NewParams http_params;
+    http_params.m_HttpHeader = &HttpHeader;
+    http_params.m_HttpContent = &HttpContent;
+    http_params.m_HttpWriteHeaders = &HttpWriteHeaders;
+    http_params.m_Userdata = archive;
+    http_params.m_HttpCache = archive->m_HttpCache;
+    archive->m_HttpClient = dmHttpClient::New(&http_params, uri->m_Hostname, uri->m_Port, strcmp(uri->m_Scheme, "https") == 0, 0);
+    if (!archive->m_HttpClient)
+    {
+        char buffer[dmResource::RESOURCE_PATH_MAX*2];
+        dmLogError("Failed to connect to: %s", CreateEncodedUri(uri, "", buffer, sizeof(buffer)));
+        DeleteHttpArchiveInternal(archive);
+        return dmResourceProvider::RESULT_ERROR_UNKNOWN;
+    }
+    // The resource requests are multiplexed over a single connection when the server supports it
+    dmHttpClient::SetOptionInt(archive->m_HttpClient, dmHttpClient::OPTION_REQUEST_HTTP2, 1);
+
+    if (IsArchiveUri(uri))
+    {
+        dmResourceProvider::Result result = MountArchive(archive);
+        if (result != dmResourceProvider::RESULT_OK)
+        {
+            char buffer[dmResource::RESOURCE_PATH_MAX*2];
+            dmLogError("Failed to mount archive: %s", CreateEncodedUri(uri, "", buffer, sizeof(buffer)));
+            DeleteHttpArchiveInternal(archive);
+            return result;
+        }
+    }
+
+    *out_archive = (dmResourceProvider::HArchiveInternal)archive;
+    return dmResourceProvider::RESULT_OK;
+}
+
+static dmResourceProvider::Result Unmount(dmResourceProvider::HArchiveInternal archive)
+{
+    DeleteHttpArchiveInternal((HttpProviderContext*)archive);
+    return dmResourceProvider::RESULT_OK;
+}
+
+static dmResourceProvider::Result GetRequestFromUri(HttpProviderContext* archive, const char* method, const char* path, uint32_t* buffer_length, uint8_t* buffer)
+{
+    char encoded_uri[dmResource::RESOURCE_PATH_MAX*2];
+    CreateEncodedUri(&archive->m_BaseUri, path, encoded_uri, sizeof(encoded_uri));
+
+    dmResourceProvider::Result result = DoRequest(archive, method, encoded_uri);
+    if (result != dmResourceProvider::RESULT_OK)
+    {
+        return result;
+    }
 
     bool get_file_size = strcmp(method, "HEAD") == 0;
 
@@ -225,7 +557,15 @@ static dmResourceProvider::Result GetRequestFromUri(HttpProviderContext* archive
 static dmResourceProvider::Result GetFileSize(dmResourceProvider::HArchiveInternal _archive, dmhash_t path_hash, const char* path, uint32_t* file_size)
 {
     HttpProviderContext* archive = (HttpProviderContext*)_archive;
-    (void)path_hash;
+
+    if (archive->m_Archive)
+    {
+        dmResourceArchive::EntryData** entry = archive->m_Archive->m_EntryMap.Get(path_hash);
+        if (!entry)
+            return dmResourceProvider::RESULT_NOT_FOUND;
+        *file_size = dmEndian::ToNetwork((*entry)->m_ResourceSize);
+        return dmResourceProvider::RESULT_OK;
+    }
 
     return GetRequestFromUri((HttpProviderContext*)archive, "HEAD", path, file_size, 0);
 }
@@ -233,7 +573,17 @@ static dmResourceProvider::Result GetFileSize(dmResourceProvider::HArchiveIntern
 static dmResourceProvider::Result ReadFile(dmResourceProvider::HArchiveInternal _archive, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t _buffer_len)
 {
     HttpProviderContext* archive = (HttpProviderContext*)_archive;
-    (void)path_hash;
+
+    if (archive->m_Archive)
+    {
+        dmResourceArchive::EntryData** entry = archive->m_Archive->m_EntryMap.Get(path_hash);
+        if (!entry)
+            return dmResourceProvider::RESULT_NOT_FOUND;
+        if (_buffer_len < dmEndian::ToNetwork((*entry)->m_ResourceSize))
+            return dmResourceProvider::RESULT_INVAL_ERROR;
+        dmResourceArchive::Result r = dmResourceArchive::ReadEntry(archive->m_Archive->m_ArchiveIndex, *entry, buffer);
+        return r == dmResourceArchive::RESULT_OK ? dmResourceProvider::RESULT_OK : dmResourceProvider::RESULT_IO_ERROR;
+    }
 
     uint32_t buffer_len = _buffer_len;
     dmResourceProvider::Result result = GetRequestFromUri((HttpProviderContext*)archive, "GET", path, &buffer_len, buffer);
@@ -244,6 +594,32 @@ static dmResourceProvider::Result ReadFile(dmResourceProvider::HArchiveInternal
     return dmResourceProvider::RESULT_OK;
 }
 
+static dmResourceProvider::Result ReadFilePartial(dmResourceProvider::HArchiveInternal _archive, dmhash_t path_hash, const char* path, uint32_t offset, uint32_t size, uint8_t* buffer, uint32_t* nread)
+{
+    HttpProviderContext* archive = (HttpProviderContext*)_archive;
+    if (!archive->m_Archive)
+        return dmResourceProvider::RESULT_NOT_SUPPORTED;
+
+    dmResourceArchive::EntryData** entry = archive->m_Archive->m_EntryMap.Get(path_hash);
+    if (!entry)
+        return dmResourceProvider::RESULT_NOT_FOUND;
+    dmResourceArchive::Result r = dmResourceArchive::ReadEntryPartial(archive->m_Archive->m_ArchiveIndex, *entry, offset, size, buffer, nread);
+    if (dmResourceArchive::RESULT_NOT_FOUND == r)
+        return dmResourceProvider::RESULT_NOT_SUPPORTED;
+    return dmResourceArchive::RESULT_OK == r ? dmResourceProvider::RESULT_OK : dmResourceProvider::RESULT_IO_ERROR;
+}
+
+static dmResourceProvider::Result GetManifest(dmResourceProvider::HArchiveInternal _archive, dmResource::HManifest* out_manifest)
+{
+    HttpProviderContext* archive = (HttpProviderContext*)_archive;
+    if (archive->m_Archive)
+    {
+        *out_manifest = archive->m_Archive->m_Manifest;
+        return dmResourceProvider::RESULT_OK;
+    }
+    return dmResourceProvider::RESULT_NOT_FOUND;
+}
+
 static void SetupArchiveLoaderHttp(dmResourceProvider::ArchiveLoader* loader)
 {
     loader->m_CanMount      = MatchesUri;
@@ -251,6 +627,8 @@ static void SetupArchiveLoaderHttp(dmResourceProvider::ArchiveLoader* loader)
     loader->m_Unmount       = Unmount;
     loader->m_GetFileSize   = GetFileSize;
     loader->m_ReadFile      = ReadFile;
+    loader->m_ReadFilePartial = ReadFilePartial;
+    loader->m_GetManifest   = GetManifest;
 }
 
 DM_DECLARE_ARCHIVE_LOADER(ResourceProviderHttp, "http", SetupArchiveLoaderHttp);
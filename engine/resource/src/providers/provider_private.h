@@ -38,7 +38,10 @@ namespace dmResourceProvider
 
         FGetFileSize            m_GetFileSize;
         FReadFile               m_ReadFile;
+        FGetFileData            m_GetFileData;      // For archives with the data in memory
+        FReadFilePartial        m_ReadFilePartial;  // For streaming parts of a file
         FWriteFile              m_WriteFile;        // For writeable archives
+        bool                    m_ConcurrentReads;  // If the ReadFile function can be called from several threads at once
 
         void Verify();
 
@@ -28,6 +28,7 @@
 #include <dlib/lz4.h>
 #include <dlib/math.h>
 #include <dlib/memory.h>
+#include <dlib/mutex.h>
 #include <dlib/sys.h>
 #include <dlib/zip.h>
 
@@ -41,6 +42,9 @@ struct EntryInfo
     dmLiveUpdateDDF::ResourceEntry* m_ManifestEntry; // If it's a resource provided by the manifest
     uint32_t                        m_Size;          // Used when there is no resource entry
     uint32_t                        m_EntryIndex;
+    uint32_t                        m_ZipSize;       // The uncompressed size of the zip entry
+    uint32_t                        m_StoredSize;    // The size of the zip entry, as stored in the archive
+    bool                            m_Deflated;
 };
 
 struct ZipProviderContext
@@ -49,6 +53,7 @@ struct ZipProviderContext
     dmZip::HZip                 m_Zip;
     dmResource::HManifest       m_Manifest;
     dmHashTable64<EntryInfo>    m_EntryMap; // url hash -> entry in the manifest
+    dmMutex::HMutex             m_Mutex;    // Protects the zip file handle. The entries are inflated outside of the lock
 };
 
 
@@ -70,6 +75,8 @@ static void DeleteZipArchiveInternal(dmResourceProvider::HArchiveInternal _archi
         dmResource::DeleteManifest(archive->m_Manifest);
     if (archive->m_Zip)
         dmZip::Close(archive->m_Zip);
+    if (archive->m_Mutex)
+        dmMutex::Delete(archive->m_Mutex);
     delete archive;
 }
 
@@ -81,28 +88,30 @@ static void CreateEntryMap(ZipProviderContext* archive)
     dmHashTable64<EntryInfo> temp_archive_map;
     temp_archive_map.SetCapacity(dmMath::Max(1U, (archive_entry_count * 2) / 3), archive_entry_count);
 
-    // Iterate over archive once and collect all the info about files
+    // Iterate over the central directory once and collect all the info about files.
+    // We only stat the entries, so no entry needs to be opened (or decompressed)
     for (uint32_t i = 0; i < archive_entry_count; ++i)
     {
-        dmZip::Result zr = dmZip::OpenEntry(zip, i);
+        char name[dmResource::RESOURCE_PATH_MAX];
+        dmZip::EntryInfo zip_info;
+        dmZip::Result zr = dmZip::GetEntryInfo(zip, i, name, sizeof(name), &zip_info);
         if (dmZip::RESULT_OK != zr)
         {
             dmLogError("Failed to list entry in zip file %s%s", archive->m_BaseUri.m_Location, archive->m_BaseUri.m_Path);
             continue;
         }
 
-        const char* name = dmZip::GetEntryName(zip);
-
         char archive_path[dmResource::RESOURCE_PATH_MAX];
         dmSnPrintf(archive_path, sizeof(archive_path), "%s%s", name[0] != '/' ? "/" : "", name);
         dmhash_t archive_path_hash = dmHashBufferNoReverse64(archive_path, strlen(archive_path));
 
         EntryInfo info;
         info.m_ManifestEntry = 0;
-        dmZip::GetEntrySize(zip, &info.m_Size);
-        dmZip::GetEntryIndex(zip, &info.m_EntryIndex);
-
-        dmZip::CloseEntry(zip);
+        info.m_Size = zip_info.m_Size;
+        info.m_EntryIndex = i;
+        info.m_ZipSize = zip_info.m_Size;
+        info.m_StoredSize = zip_info.m_StoredSize;
+        info.m_Deflated = zip_info.m_Deflated;
 
         temp_archive_map.Put(archive_path_hash, info);
     }
@@ -133,11 +142,9 @@ static void CreateEntryMap(ZipProviderContext* archive)
             continue;
         }
         info->m_ManifestEntry = entry;
-        EntryInfo manifest_info;
-        manifest_info.m_ManifestEntry = entry;
+        EntryInfo manifest_info = *info;
         // If we have file in manifest, get file size from there
         manifest_info.m_Size = entry->m_Size;
-        manifest_info.m_EntryIndex = info->m_EntryIndex;
         entry_map->Put(entry->m_UrlHash, manifest_info);
         DM_RESOURCE_DBG_LOG(3, "Added entry: %s %llx (%u bytes)\n", archive_path_buffer, archive_path_hash, manifest_info.m_Size);
     }
@@ -223,6 +230,8 @@ static dmResourceProvider::Result Mount(const dmURI::Parts* uri, dmResourceProvi
 
     CreateEntryMap(archive);
 
+    archive->m_Mutex = dmMutex::New();
+
     *out_archive = (dmResourceProvider::HArchiveInternal)archive;
     return dmResourceProvider::RESULT_OK;
 }
@@ -296,27 +305,59 @@ static dmResourceProvider::Result ReadFile(dmResourceProvider::HArchiveInternal
     if (buffer_len < entry->m_Size)
         return dmResourceProvider::RESULT_INVAL_ERROR;
 
-    dmZip::Result zr = dmZip::OpenEntry(archive->m_Zip, entry->m_EntryIndex);
+    // Regular files that are stored uncompressed in the zip can be read straight into the output buffer.
+    // Everything else is read as stored, and then inflated (and unpacked) without holding the lock,
+    // which lets several load threads decompress at the same time.
+    bool direct = !entry->m_ManifestEntry && !entry->m_Deflated;
+    uint8_t* stored_data = direct ? buffer : new uint8_t[dmMath::Max(1U, entry->m_StoredSize)];
+
+    dmZip::Result zr;
+    {
+        DM_MUTEX_SCOPED_LOCK(archive->m_Mutex);
+        zr = dmZip::GetEntryStoredData(archive->m_Zip, entry->m_EntryIndex, stored_data, direct ? buffer_len : entry->m_StoredSize);
+    }
+
     if (dmZip::RESULT_OK != zr)
+    {
+        if (!direct)
+            delete[] stored_data;
         return dmResourceProvider::RESULT_IO_ERROR;
+    }
+
+    if (direct)
+        return dmResourceProvider::RESULT_OK;
 
     dmResourceProvider::Result result = dmResourceProvider::RESULT_OK;
     if (entry->m_ManifestEntry)
     {
-        uint32_t raw_data_size;
-        dmZip::GetEntrySize(archive->m_Zip, &raw_data_size);
-        uint8_t* raw_data = new uint8_t[raw_data_size];
-        dmZip::GetEntryData(archive->m_Zip, (void*)raw_data, raw_data_size);
-        result = UnpackData(path, entry->m_ManifestEntry, raw_data, raw_data_size, buffer);
-        delete[] raw_data;
-    } else
+        // Liveupdate resources are unpacked from the inflated zip entry
+        uint8_t* raw_data = stored_data;
+        if (entry->m_Deflated)
+        {
+            raw_data = new uint8_t[dmMath::Max(1U, entry->m_ZipSize)];
+            zr = dmZip::Inflate(stored_data, entry->m_StoredSize, raw_data, entry->m_ZipSize);
+        }
+
+        if (dmZip::RESULT_OK == zr)
+            result = UnpackData(path, entry->m_ManifestEntry, raw_data, entry->m_ZipSize, buffer);
+        else
+            result = dmResourceProvider::RESULT_IO_ERROR;
+
+        if (raw_data != stored_data)
+            delete[] raw_data;
+    }
+    else
     {
-        // Uncompressed, regular files (i.e. no Liveupdate header)
-        dmZip::GetEntryData(archive->m_Zip, (void*)buffer, buffer_len);
+        // Compressed, regular files (i.e. no Liveupdate header)
+        zr = dmZip::Inflate(stored_data, entry->m_StoredSize, buffer, buffer_len);
+        if (dmZip::RESULT_OK != zr)
+            result = dmResourceProvider::RESULT_IO_ERROR;
     }
 
-    dmZip::CloseEntry(archive->m_Zip);
+    delete[] stored_data;
 
+    if (dmResourceProvider::RESULT_OK != result)
+        dmLogError("Failed to read '%s' from zip file %s%s", path, archive->m_BaseUri.m_Location, archive->m_BaseUri.m_Path);
     return result;
 }
 
@@ -339,6 +380,7 @@ static void SetupArchiveLoaderHttpZip(dmResourceProvider::ArchiveLoader* loader)
     loader->m_GetManifest   = GetManifest;
     loader->m_GetFileSize   = GetFileSize;
     loader->m_ReadFile      = ReadFile;
+    loader->m_ConcurrentReads = true; // The zip handle is locked internally
 }
 
 DM_DECLARE_ARCHIVE_LOADER(ResourceProviderZip, "zip", SetupArchiveLoaderHttpZip);
@@ -22,6 +22,7 @@
 #include <limits.h>
 #elif defined (__MACH__)
 #include <sys/param.h>
+#include <algorithm> // std::stable_sort
 #endif
 
 #include <dlib/crypt.h>
@@ -73,6 +74,14 @@ struct ResourceReloadedCallbackPair
 };
 
 const uint32_t MAX_RESOURCE_TYPES = 128;
+// Number of resource loads kept in the load trace. See IterateLoadTrace
+const uint32_t LOAD_TRACE_CAPACITY = 1024;
+
+struct LoadOrderItem
+{
+    uint32_t m_Path;
+    uint32_t m_Group;
+};
 
 struct ResourceFactory
 {
@@ -110,6 +119,26 @@ struct ResourceFactory
     dmResourceProvider::HArchive                 m_BuiltinMount;
     dmResourceProvider::HArchive                 m_BaseArchiveMount;
 
+    // Number of threads in the load queue of each preloader
+    uint32_t                                     m_LoadThreadCount;
+
+    // Unreferenced resources that are kept alive, oldest first. See ResourceTypeSetCacheBudget
+    dmArray<dmhash_t>                            m_Cache;
+    bool                                         m_CacheDisabled;
+
+    // Number of unfinished preloaders per PreloaderPriority
+    uint32_t                                     m_BusyPreloaders[dmResource::PRELOADER_PRIORITY_COUNT];
+
+    // The stage timings of the most recently created resources, as a ring buffer. See IterateLoadTrace
+    dmArray<dmResource::LoadTraceEntry>          m_LoadTrace;
+    uint32_t                                     m_LoadTraceNext;
+
+    // The resources in the order they were first loaded, see IterateLoadOrder. Only set with RESOURCE_FACTORY_FLAGS_LOAD_ORDER
+    // The entries are offsets into m_LoadOrderPaths, which holds the canonical paths
+    dmArray<LoadOrderItem>                       m_LoadOrder;
+    dmArray<char>                                m_LoadOrderPaths;
+    dmHashTable64<uint32_t>*                     m_LoadOrderPathOffsets;
+
     // Serial version that increases per resource insertion
     uint16_t                                     m_Version;
 };
@@ -128,6 +157,8 @@ const char* BUNDLE_PUBLIC_KEY_FILENAME          = "game.public.der";
 
 
 const char* MAX_RESOURCES_KEY = "resource.max_resources";
+const char* LOAD_THREAD_COUNT_KEY = "resource.load_thread_count";
+const char* CACHE_BUDGET_KEY = "resource.cache_budget";
 
 
 static inline uint16_t IncreaseVersion(HResourceFactory factory)
@@ -167,6 +198,7 @@ void SetDefaultNewFactoryParams(struct NewFactoryParams* params)
     params->m_ArchiveIndex.m_Size = 0;
     params->m_ArchiveData.m_Data = 0;
     params->m_ArchiveData.m_Size = 0;
+    params->m_LoadThreadCount = 2;
 }
 
 static Result AddBuiltinMount(HFactory factory, NewFactoryParams* params)
@@ -354,12 +386,22 @@ HFactory NewFactory(NewFactoryParams* params, const char* uri)
         AddBuiltinMount(factory, params);
     }
 
+    factory->m_LoadOrderPathOffsets = 0;
+    if (params->m_Flags & RESOURCE_FACTORY_FLAGS_LOAD_ORDER)
+    {
+        factory->m_LoadOrderPathOffsets = new dmHashTable64<uint32_t>();
+    }
+
+    factory->m_LoadThreadCount = dmMath::Max(1u, params->m_LoadThreadCount);
     factory->m_LoadMutex = dmMutex::New();
     return factory;
 }
 
 static void ResourceIteratorCallback(void*, const dmhash_t* id, ResourceDescriptor* resource)
 {
+    if (resource->m_ReferenceCount == 0)
+        return; // cached
+
     dmLogError("Resource: %s  ref count: %u", dmHashReverseSafe64(*id), resource->m_ReferenceCount);
 }
 
@@ -379,6 +421,11 @@ void DeleteFactory(HFactory factory)
     if (factory->m_Mounts)
         dmResourceMounts::Destroy(factory->m_Mounts);
 
+    if (factory->m_Resources)
+    {
+        ReleaseCachedResources(factory);
+    }
+
     if (factory->m_Resources && !factory->m_Resources->Empty())
     {
         dmLogError("Leaked resources:");
@@ -392,6 +439,7 @@ void DeleteFactory(HFactory factory)
         delete factory->m_ResourceHashToFilename;
     if (factory->m_ResourceReloadedCallbacks)
         delete factory->m_ResourceReloadedCallbacks;
+    delete factory->m_LoadOrderPathOffsets;
     delete factory;
 }
 
@@ -409,12 +457,13 @@ static void Dispatch(dmMessage::Message* message, void* user_ptr)
             dmResourceDDF::Reload* reload_resources = (dmResourceDDF::Reload*) message->m_Data;
             uint32_t count = reload_resources->m_Resources.m_Count;
             uint8_t* str_offset_cursor = (uint8_t*)((uintptr_t)reload_resources + *(uint32_t*)reload_resources);
+            const char** resources = (const char**)malloc(dmMath::Max(1U, count) * sizeof(const char*));
             for (uint32_t i = 0; i < count; ++i)
             {
-                const char* resource = (const char *) (uintptr_t)reload_resources + *(str_offset_cursor + i * sizeof(uint64_t));
-                ResourceDescriptor* resource_descriptor;
-                ReloadResource(factory, resource, &resource_descriptor);
+                resources[i] = (const char *) (uintptr_t)reload_resources + *(str_offset_cursor + i * sizeof(uint64_t));
             }
+            ReloadResources(factory, resources, count);
+            free(resources);
         }
         else
         {
@@ -606,7 +655,7 @@ dmResourceProvider::HArchive GetBaseArchive(HFactory factory)
     return factory->m_BaseArchiveMount;
 }
 
-// Assumes m_LoadMutex is already held
+// Only touches the mounts (which have their own mutex) and the supplied buffer
 static Result LoadResourceFromBufferLocked(HFactory factory, const char* path, const char* original_name, uint32_t* resource_size, LoadBufferType* buffer)
 {
     DM_PROFILE(__FUNCTION__);
@@ -638,14 +687,36 @@ static Result LoadResourceFromBufferLocked(HFactory factory, const char* path, c
     return RESULT_RESOURCE_NOT_FOUND;
 }
 
-// Takes the lock.
+// Called from the async load queue threads. The mounts are guarded by their own mutex, so we don't take
+// m_LoadMutex here. That way the loads don't stall while the main thread is creating resources.
 Result LoadResourceFromBuffer(HFactory factory, const char* path, const char* original_name, uint32_t* resource_size, LoadBufferType* buffer)
 {
-    // Called from async queue so we wrap around a lock
-    dmMutex::ScopedLock lk(factory->m_LoadMutex);
     return LoadResourceFromBufferLocked(factory, path, original_name, resource_size, buffer);
 }
 
+// Only touches the mounts, so it may be called from the load threads
+Result LoadResourceInPlace(HFactory factory, const char* path, const void** buffer, uint32_t* resource_size)
+{
+    DM_PROFILE(__FUNCTION__);
+
+    char normalized_path[RESOURCE_PATH_MAX];
+    GetCanonicalPath(path, normalized_path); // normalize the path
+
+    dmhash_t normalized_path_hash = dmHashString64(normalized_path);
+    return dmResourceMounts::GetResourceData(factory->m_Mounts, normalized_path_hash, normalized_path, (const uint8_t**)buffer, resource_size);
+}
+
+Result ReadResourcePartial(HFactory factory, const char* path, uint32_t offset, uint32_t size, void* buffer, uint32_t* nread)
+{
+    DM_PROFILE(__FUNCTION__);
+
+    char normalized_path[RESOURCE_PATH_MAX];
+    GetCanonicalPath(path, normalized_path); // normalize the path
+
+    dmhash_t normalized_path_hash = dmHashString64(normalized_path);
+    return dmResourceMounts::ReadResourcePartial(factory->m_Mounts, normalized_path_hash, normalized_path, offset, size, (uint8_t*)buffer, nread);
+}
+
 // Assumes m_LoadMutex is already held
 Result LoadResource(HFactory factory, const char* path, const char* original_name, void** buffer, uint32_t* resource_size)
 {
@@ -671,9 +742,12 @@ const char* GetExtFromPath(const char* path)
 }
 
 // Assumes m_LoadMutex is already held
+// The trace holds the start and load time, and gets the remaining stage timings
 static Result DoCreateResource(HFactory factory, ResourceType* resource_type, const char* name, const char* canonical_path,
-    dmhash_t canonical_path_hash, void* buffer, uint32_t buffer_size, void** resource_out)
+    dmhash_t canonical_path_hash, void* buffer, uint32_t buffer_size, LoadTraceEntry* trace, void** resource_out)
 {
+    DM_MEMORY_TAG(dmMemory::TAG_RESOURCE);
+
     // TODO: We should *NOT* allocate SResource dynamically...
     ResourceDescriptor tmp_resource;
     memset(&tmp_resource, 0, sizeof(tmp_resource));
@@ -686,6 +760,8 @@ static Result DoCreateResource(HFactory factory, ResourceType* resource_type, co
 
     if (resource_type->m_PreloadFunction)
     {
+        DM_PROFILE("Preload");
+        uint64_t start = dmTime::GetTime();
         ResourcePreloadParams params;
         params.m_Factory     = factory;
         params.m_Type        = resource_type;
@@ -696,10 +772,13 @@ static Result DoCreateResource(HFactory factory, ResourceType* resource_type, co
         params.m_Filename    = name;
         params.m_HintInfo    = 0; // No hinting now
         create_error         = (Result)resource_type->m_PreloadFunction(&params);
+        trace->m_PreloadTime = (uint32_t)(dmTime::GetTime() - start);
     }
 
     if (create_error == RESULT_OK)
     {
+        DM_PROFILE("Create");
+        uint64_t start = dmTime::GetTime();
         tmp_resource.m_ResourceSizeOnDisc = buffer_size;
         tmp_resource.m_ResourceSize       = 0; // Not everything will report a size (but instead rely on the disc size, sinze it's close enough)
 
@@ -713,10 +792,13 @@ static Result DoCreateResource(HFactory factory, ResourceType* resource_type, co
         params.m_Resource    = &tmp_resource;
         params.m_Filename    = name;
         create_error         = (Result)resource_type->m_CreateFunction(&params);
+        trace->m_CreateTime  = (uint32_t)(dmTime::GetTime() - start);
     }
 
     if (create_error == RESULT_OK && resource_type->m_PostCreateFunction)
     {
+        DM_PROFILE("PostCreate");
+        uint64_t start = dmTime::GetTime();
         ResourcePostCreateParams params;
         params.m_Factory     = factory;
         params.m_Type        = resource_type;
@@ -730,6 +812,7 @@ static Result DoCreateResource(HFactory factory, ResourceType* resource_type, co
                 break;
             dmTime::Sleep(1000);
         }
+        trace->m_PostCreateTime = (uint32_t)(dmTime::GetTime() - start);
     }
 
     // Restore to default buffer size
@@ -743,6 +826,12 @@ static Result DoCreateResource(HFactory factory, ResourceType* resource_type, co
         Result insert_error = InsertResource(factory, name, canonical_path_hash, &tmp_resource);
         if (insert_error == RESULT_OK)
         {
+            trace->m_Id         = canonical_path_hash;
+            trace->m_Extension  = resource_type->m_Extension;
+            trace->m_SizeOnDisc = tmp_resource.m_ResourceSizeOnDisc;
+            trace->m_Size       = tmp_resource.m_ResourceSize;
+            RecordLoadTrace(factory, *trace);
+
             *resource_out = tmp_resource.m_Resource;
             return RESULT_OK;
         }
@@ -764,21 +853,138 @@ static Result DoCreateResource(HFactory factory, ResourceType* resource_type, co
     }
 }
 
+static uint32_t GetCacheSize(const ResourceDescriptor* rd)
+{
+    // Not everything reports a size, default to the size on disc
+    return rd->m_ResourceSize ? rd->m_ResourceSize : rd->m_ResourceSizeOnDisc;
+}
+
+static void DestroyResource(HFactory factory, ResourceDescriptor* rd)
+{
+    ResourceType* resource_type = (ResourceType*) rd->m_ResourceType;
+
+    DM_PROFILE_DYN(resource_type->m_Extension, 0);
+
+    // The descriptor may move if the destroy function releases other resources
+    dmhash_t resource_hash = rd->m_NameHash;
+    void* resource = rd->m_Resource;
+
+    ResourceDestroyParams params;
+    params.m_Factory    = factory;
+    params.m_Type       = resource_type;
+    params.m_Context    = resource_type->m_Context;
+    params.m_Resource   = rd;
+    resource_type->m_DestroyFunction(&params);
+
+    factory->m_ResourceToHash->Erase((uintptr_t) resource);
+    factory->m_Resources->Erase(resource_hash);
+    if (factory->m_ResourceHashToFilename)
+    {
+        const char** s = factory->m_ResourceHashToFilename->Get(resource_hash);
+        factory->m_ResourceHashToFilename->Erase(resource_hash);
+        assert(s);
+        free((void*) *s);
+    }
+}
+
+static void RemoveFromCache(HFactory factory, uint32_t index)
+{
+    dmArray<dmhash_t>& cache = factory->m_Cache;
+    ResourceDescriptor* rd = factory->m_Resources->Get(cache[index]);
+    assert(rd && rd->m_ReferenceCount == 0);
+    ResourceType* resource_type = (ResourceType*) rd->m_ResourceType;
+    resource_type->m_CacheSize -= dmMath::Min(resource_type->m_CacheSize, GetCacheSize(rd));
+
+    // Keep the order, oldest first
+    uint32_t size = cache.Size();
+    memmove(&cache[index], &cache[index] + 1, (size - index - 1) * sizeof(dmhash_t));
+    cache.SetSize(size - 1);
+}
+
+static uint32_t FindInCache(HFactory factory, dmhash_t canonical_path_hash)
+{
+    dmArray<dmhash_t>& cache = factory->m_Cache;
+    for (uint32_t i = cache.Size(); i > 0; --i)
+    {
+        if (cache[i-1] == canonical_path_hash)
+        {
+            return i-1;
+        }
+    }
+    assert(false && "Unreferenced resource not in the cache");
+    return 0;
+}
+
+// Destroys the least recently released resource in the cache (of the given type, if set)
+static bool EvictCachedResource(HFactory factory, ResourceType* resource_type)
+{
+    dmArray<dmhash_t>& cache = factory->m_Cache;
+    for (uint32_t i = 0; i < cache.Size(); ++i)
+    {
+        ResourceDescriptor* rd = factory->m_Resources->Get(cache[i]);
+        if (resource_type == 0 || rd->m_ResourceType == resource_type)
+        {
+            RemoveFromCache(factory, i);
+            DestroyResource(factory, rd);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Assumes m_LoadMutex is already held
+ResourceDescriptor* GetByHash(HFactory factory, dmhash_t canonical_path_hash)
+{
+    ResourceDescriptor* rd = factory->m_Resources->Get(canonical_path_hash);
+    if (!rd)
+    {
+        return 0;
+    }
+
+    assert(factory->m_ResourceToHash->Get((uintptr_t) rd->m_Resource));
+    if (rd->m_ReferenceCount == 0)
+    {
+        RemoveFromCache(factory, FindInCache(factory, canonical_path_hash));
+    }
+    rd->m_ReferenceCount++;
+    return rd;
+}
+
+void ReleaseCachedResources(HFactory factory)
+{
+    DM_PROFILE(__FUNCTION__);
+    while (EvictCachedResource(factory, 0))
+    {
+    }
+}
+
+void SetCacheEnabled(HFactory factory, bool enable)
+{
+    factory->m_CacheDisabled = !enable;
+    if (!enable)
+    {
+        ReleaseCachedResources(factory);
+    }
+}
+
 // Assumes m_LoadMutex is already held
 static Result PrepareResourceCreation(HFactory factory, const char* canonical_path, dmhash_t canonical_path_hash, void** resource_out, HResourceType* resource_type_out)
 {
     *resource_out = 0;
 
-    // Try to get from already loaded resources
-    ResourceDescriptor* rd = factory->m_Resources->Get(canonical_path_hash);
+    // Try to get from already loaded (or cached) resources
+    ResourceDescriptor* rd = GetByHash(factory, canonical_path_hash);
     if (rd)
     {
-        assert(factory->m_ResourceToHash->Get((uintptr_t) rd->m_Resource));
-        rd->m_ReferenceCount++;
         *resource_out = rd->m_Resource;
         return RESULT_OK;
     }
 
+    // Make room by destroying unreferenced resources
+    while (factory->m_Resources->Full() && EvictCachedResource(factory, 0))
+    {
+    }
+
     if (factory->m_Resources->Full())
     {
         dmLogError("The max number of resources (%d) has been passed, tweak \"%s\" in the config file.", factory->m_Resources->Capacity(), MAX_RESOURCES_KEY);
@@ -832,6 +1038,19 @@ static Result CreateAndLoadResource(HFactory factory, const char* name, void** r
         return RESULT_OK;
     }
 
+    if (factory->m_LoadOrderPathOffsets)
+    {
+        // The outermost resource of the Get call-stack is the one being loaded
+        char group_path[RESOURCE_PATH_MAX];
+        const char* group = factory->m_GetResourceStack.Empty() ? name : factory->m_GetResourceStack[0];
+        GetCanonicalPath(group, group_path);
+        RecordLoadOrder(factory, canonical_path, canonical_path_hash, group_path);
+    }
+
+    LoadTraceEntry trace;
+    memset(&trace, 0, sizeof(trace));
+    trace.m_StartTime = dmTime::GetTime();
+
     void* buffer         = 0;
     uint32_t buffer_size = 0;
     Result result = LoadResource(factory, canonical_path, name, &buffer, &buffer_size);
@@ -840,8 +1059,9 @@ static Result CreateAndLoadResource(HFactory factory, const char* name, void** r
         return result;
     }
     assert(buffer == factory->m_Buffer.Begin());
+    trace.m_LoadTime = (uint32_t)(dmTime::GetTime() - trace.m_StartTime);
 
-    return DoCreateResource(factory, resource_type, name, canonical_path, canonical_path_hash, buffer, buffer_size, resource);
+    return DoCreateResource(factory, resource_type, name, canonical_path, canonical_path_hash, buffer, buffer_size, &trace, resource);
 }
 
 Result CreateResource(HFactory factory, const char* name, void* data, uint32_t data_size, void** resource)
@@ -870,7 +1090,11 @@ Result CreateResource(HFactory factory, const char* name, void* data, uint32_t d
         return RESULT_OK;
     }
 
-    return DoCreateResource(factory, resource_type, name, canonical_path, canonical_path_hash, data, data_size, resource);
+    LoadTraceEntry trace;
+    memset(&trace, 0, sizeof(trace));
+    trace.m_StartTime = dmTime::GetTime();
+
+    return DoCreateResource(factory, resource_type, name, canonical_path, canonical_path_hash, data, data_size, &trace, resource);
 }
 
 Result Get(HFactory factory, const char* name, void** resource)
@@ -923,23 +1147,36 @@ Result Get(HFactory factory, const char* name, void** resource)
 
 ResourceDescriptor* FindByHash(HFactory factory, uint64_t canonical_path_hash)
 {
-    return factory->m_Resources->Get(canonical_path_hash);
+    ResourceDescriptor* rd = factory->m_Resources->Get(canonical_path_hash);
+    // Unreferenced resources in the cache aren't considered loaded
+    return (rd && rd->m_ReferenceCount > 0) ? rd : 0;
 }
 
 Result Get(HFactory factory, dmhash_t name, void** resource)
 {
-    ResourceDescriptor* rd = FindByHash(factory, name);
+    ResourceDescriptor* rd = GetByHash(factory, name);
     if (!rd)
     {
         return RESULT_RESOURCE_NOT_FOUND;
     }
-    dmResource::IncRef(factory, rd->m_Resource);
     *resource = rd->m_Resource;
     return RESULT_OK;
 }
 
 Result InsertResource(HFactory factory, const char* path, uint64_t canonical_path_hash, ResourceDescriptor* descriptor)
 {
+    // A cached resource at the same path is replaced
+    ResourceDescriptor* cached = factory->m_Resources->Get(canonical_path_hash);
+    if (cached && cached->m_ReferenceCount == 0)
+    {
+        RemoveFromCache(factory, FindInCache(factory, canonical_path_hash));
+        DestroyResource(factory, cached);
+    }
+
+    while (factory->m_Resources->Full() && EvictCachedResource(factory, 0))
+    {
+    }
+
     if (factory->m_Resources->Full())
     {
         dmLogError("The max number of resources (%d) has been passed, tweak \"%s\" in the config file.", factory->m_Resources->Capacity(), MAX_RESOURCES_KEY);
@@ -1074,12 +1311,8 @@ static Result DoReloadResource(HFactory factory, const char* name, HResourceDesc
     }
 }
 
-Result ReloadResource(HFactory factory, const char* name, HResourceDescriptor* out_descriptor)
+static void LogReloadResult(const char* name, Result result, HResourceDescriptor descriptor)
 {
-    dmMutex::ScopedLock lk(factory->m_LoadMutex);
-
-    Result result = DoReloadResource(factory, name, out_descriptor);
-
     switch (result)
     {
         case RESULT_OK:
@@ -1096,13 +1329,115 @@ Result ReloadResource(HFactory factory, const char* name, HResourceDescriptor* o
             dmLogError("%s could not be reloaded since it was never loaded before.", name);
             break;
         case RESULT_NOT_SUPPORTED:
-            dmLogWarning("Reloading of resource type %s not supported.", ((ResourceType*)((*out_descriptor)->m_ResourceType))->m_Extension);
+            dmLogWarning("Reloading of resource type %s not supported.", ((ResourceType*)(descriptor->m_ResourceType))->m_Extension);
             break;
         default:
             dmLogWarning("%s could not be reloaded, unknown error: %d.", name, result);
             break;
     }
+}
+
+Result ReloadResource(HFactory factory, const char* name, HResourceDescriptor* out_descriptor)
+{
+    dmMutex::ScopedLock lk(factory->m_LoadMutex);
 
+    HResourceDescriptor descriptor;
+    Result result = DoReloadResource(factory, name, &descriptor);
+    LogReloadResult(name, result, descriptor);
+
+    if (out_descriptor)
+        *out_descriptor = descriptor;
+    return result;
+}
+
+struct ReloadEntry
+{
+    const char* m_Name;
+    dmhash_t    m_PathHash;
+    uint32_t    m_DependencyCount; // The number of other resources in the batch that this resource depends on
+};
+
+struct ReloadEntryPred
+{
+    bool operator ()(const ReloadEntry& a, const ReloadEntry& b) const
+    {
+        return a.m_DependencyCount < b.m_DependencyCount;
+    }
+};
+
+struct ReloadDependencyContext
+{
+    dmHashTable64<uint32_t>*    m_Batch; // path hash -> index into the batch
+    uint32_t                    m_Count;
+};
+
+static void ReloadDependencyCallback(void* _context, const dmResourceMounts::SGetDependenciesResult* result)
+{
+    ReloadDependencyContext* context = (ReloadDependencyContext*)_context;
+    if (context->m_Batch->Get(result->m_UrlHash))
+        context->m_Count++;
+}
+
+Result ReloadResources(HFactory factory, const char** names, uint32_t count)
+{
+    DM_PROFILE(__FUNCTION__);
+    dmMutex::ScopedLock lk(factory->m_LoadMutex);
+
+    dmArray<ReloadEntry> entries;
+    entries.SetCapacity(count);
+
+    dmHashTable64<uint32_t> batch;
+    batch.SetCapacity(dmMath::Max(1U, (count*2)/3), dmMath::Max(1U, count));
+
+    // Each resource is only reloaded once, even if it was listed several times
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        char canonical_path[RESOURCE_PATH_MAX];
+        GetCanonicalPath(names[i], canonical_path);
+        dmhash_t path_hash = dmHashBuffer64(canonical_path, strlen(canonical_path));
+        if (batch.Get(path_hash))
+            continue;
+        batch.Put(path_hash, entries.Size());
+
+        ReloadEntry entry;
+        entry.m_Name = names[i];
+        entry.m_PathHash = path_hash;
+        entry.m_DependencyCount = 0;
+        entries.Push(entry);
+    }
+
+    // If a resource depends on another resource in the batch, it also (transitively) depends on all of that resource's
+    // dependencies, so it always has a larger count. Sorting on the count reloads the dependencies before their dependants,
+    // which means that a dependant (e.g. a game object prototype) is rebuilt once, with all its dependencies already updated.
+    // The dependencies are only known for mounts that have a manifest, otherwise the requested order is kept.
+    if (entries.Size() > 1)
+    {
+        for (uint32_t i = 0; i < entries.Size(); ++i)
+        {
+            ReloadDependencyContext context;
+            context.m_Batch = &batch;
+            context.m_Count = 0;
+
+            dmResourceMounts::SGetDependenciesParams params;
+            params.m_UrlHash                = entries[i].m_PathHash;
+            params.m_OnlyMissing            = false;
+            params.m_Recursive              = true;
+            params.m_IncludeRequestedUrl    = false;
+            dmResourceMounts::GetDependencies(factory->m_Mounts, &params, ReloadDependencyCallback, &context);
+            entries[i].m_DependencyCount = context.m_Count;
+        }
+        std::stable_sort(entries.Begin(), entries.End(), ReloadEntryPred());
+    }
+
+    Result result = RESULT_OK;
+    for (uint32_t i = 0; i < entries.Size(); ++i)
+    {
+        HResourceDescriptor descriptor;
+        Result r = DoReloadResource(factory, entries[i].m_Name, &descriptor);
+        LogReloadResult(entries[i].m_Name, r, descriptor);
+        if (r != RESULT_OK && result == RESULT_OK)
+            result = r;
+    }
     return result;
 }
 
@@ -1275,7 +1610,7 @@ Result GetExtensionFromType(HFactory factory, HResourceType type, const char** e
 
 Result GetDescriptorByHash(HFactory factory, dmhash_t path_hash, HResourceDescriptor* descriptor)
 {
-    ResourceDescriptor* tmp_descriptor = factory->m_Resources->Get(path_hash);
+    ResourceDescriptor* tmp_descriptor = FindByHash(factory, path_hash);
     if (tmp_descriptor)
     {
         *descriptor = tmp_descriptor;
@@ -1295,7 +1630,7 @@ Result GetDescriptor(HFactory factory, const char* name, HResourceDescriptor* de
 
 Result GetDescriptorWithExt(HFactory factory, uint64_t hashed_name, const uint64_t* exts, uint32_t ext_count, HResourceDescriptor* descriptor)
 {
-    ResourceDescriptor* tmp_descriptor = factory->m_Resources->Get(hashed_name);
+    ResourceDescriptor* tmp_descriptor = FindByHash(factory, hashed_name);
     if (!tmp_descriptor) {
         return RESULT_NOT_LOADED;
     }
@@ -1379,25 +1714,25 @@ void Release(HFactory factory, void* resource)
     if (rd->m_ReferenceCount == 0)
     {
         ResourceType* resource_type = (ResourceType*) rd->m_ResourceType;
-
-        DM_PROFILE_DYN(resource_type->m_Extension, 0);
-
-        ResourceDestroyParams params;
-        params.m_Factory    = factory;
-        params.m_Type       = resource_type;
-        params.m_Context    = resource_type->m_Context;
-        params.m_Resource   = rd;
-        resource_type->m_DestroyFunction(&params);
-
-        factory->m_ResourceToHash->Erase((uintptr_t) resource);
-        factory->m_Resources->Erase(*resource_hash);
-        if (factory->m_ResourceHashToFilename)
+        uint32_t size = GetCacheSize(rd);
+        if (!factory->m_CacheDisabled && resource_type->m_CacheBudget > 0 && size <= resource_type->m_CacheBudget)
         {
-            const char** s = factory->m_ResourceHashToFilename->Get(*resource_hash);
-            factory->m_ResourceHashToFilename->Erase(*resource_hash);
-            assert(s);
-            free((void*) *s);
+            // Keep it around in case it's requested again, and evict the oldest ones of the type to stay within the budget
+            if (factory->m_Cache.Full())
+            {
+                factory->m_Cache.OffsetCapacity(64);
+            }
+            factory->m_Cache.Push(*resource_hash);
+            resource_type->m_CacheSize += size;
+
+            while (resource_type->m_CacheSize > resource_type->m_CacheBudget)
+            {
+                EvictCachedResource(factory, resource_type);
+            }
+            return;
         }
+
+        DestroyResource(factory, rd);
     }
 }
 
@@ -1466,6 +1801,29 @@ dmMutex::HMutex GetLoadMutex(const dmResource::HFactory factory)
     return factory->m_LoadMutex;
 }
 
+uint32_t GetLoadThreadCount(const dmResource::HFactory factory)
+{
+    return factory->m_LoadThreadCount;
+}
+
+void AddBusyPreloader(HFactory factory, PreloaderPriority priority, int32_t count)
+{
+    assert(count > 0 || factory->m_BusyPreloaders[priority] >= (uint32_t) -count);
+    factory->m_BusyPreloaders[priority] += count;
+}
+
+bool HasBusyPreloaderAbove(HFactory factory, PreloaderPriority priority)
+{
+    for (uint32_t i = priority + 1; i < PRELOADER_PRIORITY_COUNT; ++i)
+    {
+        if (factory->m_BusyPreloaders[i] != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 dmResourceMounts::HContext GetMountsContext(const dmResource::HFactory factory)
 {
     return factory->m_Mounts;
@@ -1495,6 +1853,8 @@ static void ResourceIteratorCallback(ResourceIteratorCallbackInfo* callback, con
     info.m_SizeOnDisc   = resource->m_ResourceSizeOnDisc;
     info.m_Size         = resource->m_ResourceSize ? resource->m_ResourceSize : resource->m_ResourceSizeOnDisc; // default to the size on disc if no in memory size was specified
     info.m_RefCount     = resource->m_ReferenceCount;
+    info.m_LoadTime     = resource->m_LoadTime;
+    info.m_Extension    = ((ResourceType*)resource->m_ResourceType)->m_Extension;
 
     if (callback->m_ShouldContinue)
     {
@@ -1509,6 +1869,111 @@ void IterateResources(HFactory factory, FResourceIterator callback, void* user_c
     factory->m_Resources->Iterate<>(&ResourceIteratorCallback, &callback_info);
 }
 
+void RecordLoadTrace(HFactory factory, const LoadTraceEntry& entry)
+{
+    DM_MUTEX_SCOPED_LOCK(factory->m_LoadMutex);
+
+    ResourceDescriptor* rd = factory->m_Resources->Get(entry.m_Id);
+    if (rd)
+    {
+        rd->m_LoadTime = entry.m_LoadTime + entry.m_PreloadTime + entry.m_CreateTime + entry.m_PostCreateTime;
+    }
+
+    dmArray<LoadTraceEntry>& trace = factory->m_LoadTrace;
+    if (trace.Size() < LOAD_TRACE_CAPACITY)
+    {
+        if (trace.Full())
+        {
+            trace.OffsetCapacity(dmMath::Min(128u, LOAD_TRACE_CAPACITY - trace.Capacity()));
+        }
+        trace.Push(entry);
+    }
+    else
+    {
+        trace[factory->m_LoadTraceNext] = entry;
+    }
+    factory->m_LoadTraceNext = (factory->m_LoadTraceNext + 1) % LOAD_TRACE_CAPACITY;
+}
+
+void IterateLoadTrace(HFactory factory, FLoadTraceIterator callback, void* user_ctx)
+{
+    DM_MUTEX_SCOPED_LOCK(factory->m_LoadMutex);
+    dmArray<LoadTraceEntry>& trace = factory->m_LoadTrace;
+    uint32_t size = trace.Size();
+    // Until the ring buffer is full, the oldest entry is the first one
+    uint32_t first = size < LOAD_TRACE_CAPACITY ? 0 : factory->m_LoadTraceNext;
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        if (!callback(trace[(first + i) % size], user_ctx))
+            break;
+    }
+}
+
+static uint32_t AddLoadOrderPath(HFactory factory, const char* canonical_path, dmhash_t canonical_path_hash)
+{
+    dmHashTable64<uint32_t>* offsets = factory->m_LoadOrderPathOffsets;
+    if (offsets->Full())
+    {
+        uint32_t capacity = offsets->Capacity() + 256;
+        offsets->SetCapacity(dmMath::Max(1u, (3 * capacity) / 4), capacity);
+    }
+
+    dmArray<char>& paths = factory->m_LoadOrderPaths;
+    uint32_t offset = paths.Size();
+    uint32_t length = strlen(canonical_path) + 1;
+    if (paths.Remaining() < length)
+    {
+        paths.OffsetCapacity(dmMath::Max(length, 4096u));
+    }
+    paths.PushArray(canonical_path, length);
+    offsets->Put(canonical_path_hash, offset);
+    return offset;
+}
+
+void RecordLoadOrder(HFactory factory, const char* canonical_path, dmhash_t canonical_path_hash, const char* group_canonical_path)
+{
+    // The table is only created with the factory, so it's safe to check without the lock
+    if (!factory->m_LoadOrderPathOffsets)
+    {
+        return;
+    }
+
+    DM_MUTEX_SCOPED_LOCK(factory->m_LoadMutex);
+    if (factory->m_LoadOrderPathOffsets->Get(canonical_path_hash))
+    {
+        return;
+    }
+
+    LoadOrderItem item;
+    item.m_Path = AddLoadOrderPath(factory, canonical_path, canonical_path_hash);
+
+    // The root resource is loaded before the resources it refers to, so it's usually recorded already
+    dmhash_t group_hash = dmHashString64(group_canonical_path);
+    uint32_t* group = factory->m_LoadOrderPathOffsets->Get(group_hash);
+    item.m_Group = group ? *group : AddLoadOrderPath(factory, group_canonical_path, group_hash);
+
+    if (factory->m_LoadOrder.Full())
+    {
+        factory->m_LoadOrder.OffsetCapacity(256);
+    }
+    factory->m_LoadOrder.Push(item);
+}
+
+void IterateLoadOrder(HFactory factory, FLoadOrderIterator callback, void* user_ctx)
+{
+    DM_MUTEX_SCOPED_LOCK(factory->m_LoadMutex);
+    const char* paths = factory->m_LoadOrderPaths.Begin();
+    for (uint32_t i = 0; i < factory->m_LoadOrder.Size(); ++i)
+    {
+        const LoadOrderItem& item = factory->m_LoadOrder[i];
+        LoadOrderEntry entry;
+        entry.m_Path = paths + item.m_Path;
+        entry.m_Group = paths + item.m_Group;
+        if (!callback(entry, user_ctx))
+            break;
+    }
+}
+
 const char* ResultToString(Result r)
 {
     #define DM_RESOURCE_RESULT_TO_STRING_CASE(x) case RESULT_##x: return #x;
@@ -54,6 +54,16 @@ namespace dmResource
      */
     extern const char* MAX_RESOURCES_KEY;
 
+    /**
+     * Configuration key used to tweak the number of threads loading resources asynchronously.
+     */
+    extern const char* LOAD_THREAD_COUNT_KEY;
+
+    /**
+     * Configuration key used to tweak the cache budget (in bytes) of unreferenced resources, per resource type.
+     */
+    extern const char* CACHE_BUDGET_KEY;
+
     extern const char* BUNDLE_INDEX_FILENAME;
     extern const char* BUNDLE_DATA_FILENAME;
 
@@ -77,6 +87,11 @@ namespace dmResource
      */
     #define RESOURCE_FACTORY_FLAGS_LIVE_UPDATE_MOUNTS_ON_START    (1 << 3)
 
+    /**
+     * Record the order in which the resources are first loaded. See IterateLoadOrder
+     */
+    #define RESOURCE_FACTORY_FLAGS_LOAD_ORDER     (1 << 4)
+
     typedef dmArray<char> LoadBufferType;
     typedef HResourcePreloader HPreloader;
 
@@ -102,6 +117,18 @@ namespace dmResource
      */
     typedef bool (*FPreloaderCompleteCallback)(const PreloaderCompleteCallbackParams* params);
 
+    /**
+     * Priority of a preloader, relative to the other preloaders of the factory
+     * @see SetPreloaderPriority
+     */
+    enum PreloaderPriority
+    {
+        PRELOADER_PRIORITY_LOW    = 0,
+        PRELOADER_PRIORITY_NORMAL = 1,
+        PRELOADER_PRIORITY_HIGH   = 2,
+        PRELOADER_PRIORITY_COUNT  = 3,
+    };
+
     /**
      * Set default NewFactoryParams params
      * @param params
@@ -137,7 +164,10 @@ namespace dmResource
         EmbeddedResource m_ArchiveData;
         EmbeddedResource m_ArchiveManifest;
 
-        uint32_t m_Reserved[5];
+        /// Number of threads loading resources for the preloaders. Default is 2
+        uint32_t m_LoadThreadCount;
+
+        uint32_t m_Reserved[4];
 
         NewFactoryParams()
         {
@@ -219,6 +249,17 @@ namespace dmResource
      */
     Result ReloadResource(HFactory factory, const char* name, ResourceDescriptor** out_descriptor);
 
+    /**
+     * Reload a set of resources. Duplicates are only reloaded once, and a resource is reloaded
+     * after the other resources in the set that it depends on (if the dependencies are known from a manifest)
+     * @param factory Resource factory
+     * @param names Names that identify the resources, i.e. the same names used in Get
+     * @param count Number of names
+     * @return RESULT_OK if all resources were reloaded, otherwise the first error
+     * @see ReloadResource
+     */
+    Result ReloadResources(HFactory factory, const char** names, uint32_t count);
+
     /**
      * Get type for resource
      * @param factory Factory handle
@@ -316,6 +357,24 @@ namespace dmResource
      */
     Result UpdatePreloader(HPreloader preloader, FPreloaderCompleteCallback complete_callback, PreloaderCompleteCallbackParams* complete_callback_params, uint32_t soft_time_limit);
 
+    /**
+     * Set the priority of the preloader (default PRELOADER_PRIORITY_NORMAL).
+     * While a preloader of higher priority is loading, a normal priority preloader only uses half of
+     * its soft time limit, and a low priority preloader doesn't load or create anything.
+     * A low priority preloader also yields when the soft time limit is below 1 ms.
+     * @param preloader Preloader
+     * @param priority The priority
+     */
+    void SetPreloaderPriority(HPreloader preloader, PreloaderPriority priority);
+
+    /**
+     * Set a deadline for the preloader. Once half of the time to the deadline has passed,
+     * the preloader is updated as if it had PRELOADER_PRIORITY_HIGH
+     * @param preloader Preloader
+     * @param time_limit Time until the deadline in us, or 0 to remove the deadline
+     */
+    void SetPreloaderDeadline(HPreloader preloader, uint32_t time_limit);
+
     /**
      * Destroy the preloader. Note that currently it will spin and block until
      * all loads have completed, if there still are any pending.
@@ -331,6 +390,13 @@ namespace dmResource
     */
     dmMutex::HMutex GetLoadMutex(const dmResource::HFactory factory);
 
+    /**
+     * Returns the number of threads each preloader uses to load resources
+     * @param factory Factory handle
+     * @return Thread count
+    */
+    uint32_t GetLoadThreadCount(const dmResource::HFactory factory);
+
 
     /**
      * @name
@@ -391,6 +457,8 @@ namespace dmResource
         uint32_t m_SizeOnDisc;  // The size on disc (i.e. in the .darc file)
         uint32_t m_Size;        // in memory size, may be 0
         uint32_t m_RefCount;    // The current ref count
+        uint32_t m_LoadTime;    // Time spent loading and creating the resource, in microseconds
+        const char* m_Extension; // The resource type extension, without the '.'
     };
 
     typedef bool (*FResourceIterator)(const IteratorResource& resource, void* user_ctx);
@@ -404,6 +472,68 @@ namespace dmResource
      */
     void IterateResources(HFactory factory, FResourceIterator callback, void* user_ctx);
 
+    /**
+     * The stage timings of a resource load, kept in the factory load trace
+     */
+    struct LoadTraceEntry
+    {
+        dmhash_t    m_Id;               // The canonical path hash of the resource
+        const char* m_Extension;        // The resource type extension, without the '.'
+        uint64_t    m_StartTime;        // When the load was started, see dmTime::GetTime()
+        uint32_t    m_SizeOnDisc;       // The size of the loaded data
+        uint32_t    m_Size;             // in memory size, may be 0
+        uint32_t    m_LoadTime;         // Reading (and decompressing) the data, in microseconds
+        uint32_t    m_PreloadTime;      // The preload function, in microseconds
+        uint32_t    m_CreateTime;       // The create function, in microseconds
+        uint32_t    m_PostCreateTime;   // The post create function (all calls), in microseconds
+    };
+
+    typedef bool (*FLoadTraceIterator)(const LoadTraceEntry& entry, void* user_ctx);
+
+    /**
+     * Iterates over the most recently created resources, oldest first, and invokes the callback with their load timings
+     * @param factory   The resource factory
+     * @param callback  The callback function which is invoked for each entry.
+                        It should return true if the iteration should continue, and false otherwise.
+     * @param user_ctx  The user defined context which is passed along with each callback
+     */
+    void IterateLoadTrace(HFactory factory, FLoadTraceIterator callback, void* user_ctx);
+
+    /**
+     * A resource in the order the resources were first loaded. Used for laying out the archive in load order
+     */
+    struct LoadOrderEntry
+    {
+        const char* m_Path;     // The canonical path of the resource
+        const char* m_Group;    // The canonical path of the root resource it was loaded for, e.g. the collection of a collection proxy
+    };
+
+    typedef bool (*FLoadOrderIterator)(const LoadOrderEntry& entry, void* user_ctx);
+
+    /**
+     * Iterates over the loaded resources, in the order they were first loaded. Each resource is only listed once.
+     * Only recorded if the factory was created with RESOURCE_FACTORY_FLAGS_LOAD_ORDER
+     * @param factory   The resource factory
+     * @param callback  The callback function which is invoked for each entry.
+                        It should return true if the iteration should continue, and false otherwise.
+     * @param user_ctx  The user defined context which is passed along with each callback
+     */
+    void IterateLoadOrder(HFactory factory, FLoadOrderIterator callback, void* user_ctx);
+
+    /**
+     * Destroys all unreferenced resources that are kept in the cache
+     * @param factory Factory handle
+     */
+    void ReleaseCachedResources(HFactory factory);
+
+    /**
+     * Enable or disable the caching of unreferenced resources. Disabling it also releases the cached resources.
+     * The cache budgets are set per resource type, see ResourceTypeSetCacheBudget
+     * @param factory Factory handle
+     * @param enable true to enable the cache (default)
+     */
+    void SetCacheEnabled(HFactory factory, bool enable);
+
     /*#
      */
     const char* ResultToString(Result result);
@@ -412,6 +542,12 @@ namespace dmResource
     Result LoadResource(HFactory factory, const char* path, const char* original_name, void** buffer, uint32_t* resource_size);
     // load with own buffer
     Result LoadResourceFromBuffer(HFactory factory, const char* path, const char* original_name, uint32_t* resource_size, LoadBufferType* buffer);
+    // get the data directly from a memory mapped archive, without copying it. Returns RESULT_NOT_SUPPORTED if
+    // the resource has to be loaded into a buffer. The data is read only, and valid while the archive is mounted
+    Result LoadResourceInPlace(HFactory factory, const char* path, const void** buffer, uint32_t* resource_size);
+    // read a part of the resource, e.g. for streaming. nread is less than size at the end of the resource.
+    // Returns RESULT_NOT_SUPPORTED if the resource can only be loaded whole. Thread safe
+    Result ReadResourcePartial(HFactory factory, const char* path, uint32_t offset, uint32_t size, void* buffer, uint32_t* nread);
 }
 
 #endif // DM_RESOURCE_H
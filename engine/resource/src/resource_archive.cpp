@@ -27,6 +27,7 @@
 #include <dlib/endian.h>
 #include <dlib/log.h>
 #include <dlib/lz4.h>
+#include <dlib/math.h>
 #include <dlib/memory.h>
 #include <dlib/path.h>
 #include <dlib/sys.h>
@@ -75,6 +76,121 @@ namespace dmResourceArchive
         }
     }
 
+    // The buffer size of the data file. Archives laid out in load order are mostly read front to back, so a larger
+    // buffer means fewer, larger reads
+    static const uint32_t DATA_FILE_BUFFER_SIZE = 64 * 1024;
+    // How much of the memory mapped data to request ahead, once the reads are sequential
+    static const uint32_t READ_AHEAD_SIZE       = 256 * 1024;
+    // The largest gap between two reads that still counts as sequential (e.g. a resource that was already loaded)
+    static const uint32_t READ_AHEAD_MAX_GAP    = 16 * 1024;
+
+    // Reads resource data from the data file, or with the read callback of the archive
+    static Result ReadResourceData(const ArchiveFileIndex* afi, FILE* data_file, uint32_t offset, uint32_t size, void* buffer)
+    {
+        if (afi->m_ReadData)
+        {
+            return afi->m_ReadData(afi->m_ReadDataContext, offset, size, buffer);
+        }
+        // Seeking discards the buffered data on most platforms, so we skip it when the read continues where the last one ended
+        bool at_offset = ftell(data_file) == (long)offset;
+        if ((!at_offset && fseek(data_file, offset, SEEK_SET) != 0) || fread(buffer, 1, size, data_file) != size)
+        {
+            return RESULT_IO_ERROR;
+        }
+        return RESULT_OK;
+    }
+
+    // Requests the memory mapped data after a read, if it follows the previous read
+    static void ReadAheadMappedData(const ArchiveFileIndex* afi, uint32_t offset, uint32_t size)
+    {
+        ArchiveFileIndex* mutable_afi = (ArchiveFileIndex*)afi;
+        uint32_t end = offset + size;
+        uint32_t last_end = (uint32_t)dmAtomicStore32(&mutable_afi->m_LastReadEnd, (int32_t)end);
+        if (offset < last_end || offset - last_end > READ_AHEAD_MAX_GAP)
+        {
+            return;
+        }
+
+        // Keep at least half of the read ahead size requested in front of the reads
+        uint32_t read_ahead_end = (uint32_t)dmAtomicGet32(&mutable_afi->m_ReadAheadEnd);
+        uint32_t ahead = read_ahead_end > end ? read_ahead_end - end : 0;
+        if (ahead > READ_AHEAD_SIZE)
+        {
+            ahead = 0; // Requested for reads elsewhere in the file
+        }
+        if (ahead >= READ_AHEAD_SIZE / 2)
+        {
+            return;
+        }
+        uint32_t start = end + ahead;
+        uint32_t new_end = dmMath::Min(end + READ_AHEAD_SIZE, afi->m_ResourceSize);
+        if (new_end <= start)
+        {
+            return;
+        }
+        dmAtomicStore32(&mutable_afi->m_ReadAheadEnd, (int32_t)new_end);
+        dmResource::PrefetchMappedData(afi->m_ResourceData + start, new_end - start);
+    }
+
+    // Sets up the compression dictionaries of the archive. The dictionaries are read from the data file (or the read callback)
+    // if it's given, otherwise they're pointing into the resource data
+    static Result SetupDictionaries(ArchiveFileIndex* afi, const DictionaryData* dictionaries, uint32_t count, FILE* data_file)
+    {
+        bool read_data = data_file != 0 || afi->m_ReadData != 0;
+
+        if (count > MAX_DICTIONARIES)
+        {
+            dmLogError("Too many archive dictionaries: %u (max %u)", count, MAX_DICTIONARIES);
+            return RESULT_INVALID_DATA;
+        }
+
+        uint32_t total_size = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t offset = dmEndian::ToNetwork(dictionaries[i].m_ResourceDataOffset);
+            uint32_t size = dmEndian::ToNetwork(dictionaries[i].m_Size);
+            if (!read_data && (offset > afi->m_ResourceSize || size > afi->m_ResourceSize - offset))
+            {
+                return RESULT_INVALID_DATA;
+            }
+            total_size += size;
+        }
+
+        afi->m_Dictionaries = new ArchiveDictionary[count];
+        afi->m_DictionaryCount = count;
+        if (read_data)
+        {
+            afi->m_DictionaryBuffer = new uint8_t[total_size];
+        }
+
+        uint8_t* cursor = afi->m_DictionaryBuffer;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t offset = dmEndian::ToNetwork(dictionaries[i].m_ResourceDataOffset);
+            uint32_t size = dmEndian::ToNetwork(dictionaries[i].m_Size);
+            afi->m_Dictionaries[i].m_Size = size;
+
+            if (read_data)
+            {
+                Result result = ReadResourceData(afi, data_file, offset, size, cursor);
+                if (result != RESULT_OK)
+                {
+                    return result;
+                }
+                afi->m_Dictionaries[i].m_Data = cursor;
+                cursor += size;
+            }
+            else
+            {
+                afi->m_Dictionaries[i].m_Data = afi->m_ResourceData + offset;
+            }
+        }
+        return RESULT_OK;
+    }
+
+    static void DeleteArchiveFileIndex(ArchiveFileIndex* afi);
+    static void UpdateLookupTable(HArchiveIndexContainer archive);
+
     Result LoadArchiveFromFile(const char* index_file_path, const char* data_file_path, HArchiveIndexContainer* archive)
     {
         FILE* f_index = fopen(index_file_path, "rb");
@@ -139,8 +255,40 @@ namespace dmResourceArchive
             CleanupResources(f_index, f_data, aic);
             return RESULT_IO_ERROR;
         }
+        setvbuf(f_data, 0, _IOFBF, DATA_FILE_BUFFER_SIZE);
+
+        uint32_t dictionary_offset = dmEndian::ToNetwork(ai->m_DictionaryOffset);
+        if (dictionary_offset != 0)
+        {
+            Result result = RESULT_IO_ERROR;
+            uint32_t dictionary_count = 0;
+            fseek(f_index, dictionary_offset, SEEK_SET);
+            if (fread(&dictionary_count, 1, sizeof(dictionary_count), f_index) == sizeof(dictionary_count))
+            {
+                dictionary_count = dmEndian::ToNetwork(dictionary_count);
+                if (dictionary_count > MAX_DICTIONARIES)
+                {
+                    dictionary_count = MAX_DICTIONARIES + 1; // Fails in SetupDictionaries
+                }
+                DictionaryData dictionaries[MAX_DICTIONARIES + 1];
+                uint32_t dictionaries_size = dictionary_count * sizeof(DictionaryData);
+                if (fread(dictionaries, 1, dictionaries_size, f_index) == dictionaries_size)
+                {
+                    result = SetupDictionaries(aic->m_ArchiveFileIndex, dictionaries, dictionary_count, f_data);
+                }
+            }
+
+            if (result != RESULT_OK)
+            {
+                DeleteArchiveFileIndex(aic->m_ArchiveFileIndex);
+                aic->m_ArchiveFileIndex = 0;
+                CleanupResources(f_index, f_data, aic);
+                return result;
+            }
+        }
 
         aic->m_ArchiveFileIndex->m_FileResourceData = f_data; // game.arcd file handle
+        UpdateLookupTable(aic);
         *archive = aic;
 
         fclose(f_index);
@@ -170,6 +318,74 @@ namespace dmResourceArchive
         (*archive)->m_ArchiveIndex = a;
         (*archive)->m_ArchiveIndexSize = index_buffer_size;
 
+        UpdateLookupTable(*archive);
+
+        uint32_t dictionary_offset = dmEndian::ToNetwork(a->m_DictionaryOffset);
+        if (dictionary_offset != 0)
+        {
+            if (dictionary_offset > index_buffer_size - sizeof(uint32_t))
+            {
+                return RESULT_INVALID_DATA;
+            }
+            const uint8_t* dictionary_table = (const uint8_t*)index_buffer + dictionary_offset;
+            uint32_t dictionary_count = dmEndian::ToNetwork(*(const uint32_t*)dictionary_table);
+            if (dictionary_count * sizeof(DictionaryData) > index_buffer_size - dictionary_offset - sizeof(uint32_t))
+            {
+                return RESULT_INVALID_DATA;
+            }
+            return SetupDictionaries((*archive)->m_ArchiveFileIndex, (const DictionaryData*)(dictionary_table + sizeof(uint32_t)), dictionary_count, 0);
+        }
+
+        return RESULT_OK;
+    }
+
+    Result WrapArchiveIndex(const void* index_buffer, uint32_t index_buffer_size,
+                            FReadArchiveData read_data, void* read_data_context,
+                            HArchiveIndexContainer* archive)
+    {
+        ArchiveIndex* a = (ArchiveIndex*) index_buffer;
+        uint32_t version = dmEndian::ToNetwork(a->m_Version);
+        if (version != VERSION)
+        {
+            dmLogError("Archive version differs. Expected %d, but it was %d", VERSION, version);
+            return RESULT_VERSION_MISMATCH;
+        }
+
+        ArchiveIndexContainer* aic = new ArchiveIndexContainer;
+        aic->m_IsMemMapped = true; // The index is in memory, and isn't owned by the container
+        aic->m_ArchiveIndex = a;
+        aic->m_ArchiveIndexSize = index_buffer_size;
+
+        ArchiveFileIndex* afi = new ArchiveFileIndex;
+        afi->m_ReadData = read_data;
+        afi->m_ReadDataContext = read_data_context;
+        afi->m_IsMemMapped = false;
+        aic->m_ArchiveFileIndex = afi;
+
+        UpdateLookupTable(aic);
+
+        Result result = RESULT_OK;
+        uint32_t dictionary_offset = dmEndian::ToNetwork(a->m_DictionaryOffset);
+        if (dictionary_offset != 0)
+        {
+            result = RESULT_INVALID_DATA;
+            if (dictionary_offset <= index_buffer_size - sizeof(uint32_t))
+            {
+                const uint8_t* dictionary_table = (const uint8_t*)index_buffer + dictionary_offset;
+                uint32_t dictionary_count = dmEndian::ToNetwork(*(const uint32_t*)dictionary_table);
+                if (dictionary_count * sizeof(DictionaryData) <= index_buffer_size - dictionary_offset - sizeof(uint32_t))
+                {
+                    result = SetupDictionaries(afi, (const DictionaryData*)(dictionary_table + sizeof(uint32_t)), dictionary_count, 0);
+                }
+            }
+        }
+
+        if (result != RESULT_OK)
+        {
+            Delete(aic);
+            return result;
+        }
+        *archive = aic;
         return RESULT_OK;
     }
 
@@ -179,6 +395,9 @@ namespace dmResourceArchive
         {
             delete[] afi->m_Entries;
             delete[] afi->m_Hashes;
+            delete[] afi->m_Dictionaries;
+            delete[] afi->m_DictionaryBuffer;
+            delete[] afi->m_LookupTable;
 
             if (afi->m_FileResourceData)
             {
@@ -190,6 +409,83 @@ namespace dmResourceArchive
         delete afi;
     }
 
+    static void GetHashesAndEntries(HArchiveIndexContainer archive, uint8_t** hashes, EntryData** entries)
+    {
+        // If archive is loaded from file use the member arrays for hashes and entries, otherwise read with mem offsets.
+        if (!archive->m_IsMemMapped)
+        {
+            *hashes = archive->m_ArchiveFileIndex->m_Hashes;
+            *entries = archive->m_ArchiveFileIndex->m_Entries;
+        }
+        else
+        {
+            *hashes = (uint8_t*)((uintptr_t)archive->m_ArchiveIndex + dmEndian::ToNetwork(archive->m_ArchiveIndex->m_HashOffset));
+            *entries = (EntryData*)((uintptr_t)archive->m_ArchiveIndex + dmEndian::ToNetwork(archive->m_ArchiveIndex->m_EntryDataOffset));
+        }
+    }
+
+    // The hashes are sorted, and evenly distributed, so the leading bits of a hash tell where in the list it is.
+    // The lookup table maps them to a small range of entries, so FindEntry doesn't have to binary search the whole index.
+    static const uint32_t LOOKUP_MIN_ENTRY_COUNT = 64;
+    static const uint32_t LOOKUP_MAX_BITS        = 20;
+
+    static inline uint32_t GetHashPrefix(const uint8_t* hash)
+    {
+        return ((uint32_t)hash[0] << 24) | ((uint32_t)hash[1] << 16) | ((uint32_t)hash[2] << 8) | (uint32_t)hash[3];
+    }
+
+    static void UpdateLookupTable(HArchiveIndexContainer archive)
+    {
+        ArchiveFileIndex* afi = archive->m_ArchiveFileIndex;
+        if (!afi)
+        {
+            return;
+        }
+
+        delete[] afi->m_LookupTable;
+        afi->m_LookupTable = 0;
+        afi->m_LookupHashes = 0;
+        afi->m_LookupEntryCount = 0;
+
+        uint32_t entry_count = dmEndian::ToNetwork(archive->m_ArchiveIndex->m_EntryDataCount);
+        if (entry_count < LOOKUP_MIN_ENTRY_COUNT)
+        {
+            return;
+        }
+
+        uint8_t* hashes;
+        EntryData* entries;
+        GetHashesAndEntries(archive, &hashes, &entries);
+
+        // Aim for ~2 entries per bucket
+        uint32_t bits = 1;
+        while ((2U << bits) < entry_count && bits < LOOKUP_MAX_BITS)
+        {
+            ++bits;
+        }
+
+        uint32_t bucket_count = 1U << bits;
+        uint32_t* table = new uint32_t[bucket_count + 1];
+        uint32_t bucket = 0;
+        for (uint32_t i = 0; i < entry_count; ++i)
+        {
+            uint32_t prefix = GetHashPrefix(hashes + dmResourceArchive::MAX_HASH * i) >> (32 - bits);
+            while (bucket <= prefix)
+            {
+                table[bucket++] = i;
+            }
+        }
+        while (bucket <= bucket_count)
+        {
+            table[bucket++] = entry_count;
+        }
+
+        afi->m_LookupTable = table;
+        afi->m_LookupHashes = hashes;
+        afi->m_LookupEntryCount = entry_count;
+        afi->m_LookupBits = bits;
+    }
+
     void Delete(HArchiveIndexContainer &archive)
     {
         DeleteArchiveFileIndex(archive->m_ArchiveFileIndex);
@@ -214,26 +510,23 @@ namespace dmResourceArchive
     dmResourceArchive::Result FindEntry(dmResourceArchive::HArchiveIndexContainer archive, const uint8_t* hash, uint32_t hash_len, dmResourceArchive::EntryData** entry)
     {
         uint32_t entry_count = dmEndian::ToNetwork(archive->m_ArchiveIndex->m_EntryDataCount);
-        uint32_t entry_offset = dmEndian::ToNetwork(archive->m_ArchiveIndex->m_EntryDataOffset);
-        uint32_t hash_offset = dmEndian::ToNetwork(archive->m_ArchiveIndex->m_HashOffset);
         uint8_t* hashes = 0;
         dmResourceArchive::EntryData* entries = 0;
+        GetHashesAndEntries(archive, &hashes, &entries);
 
-        // If archive is loaded from file use the member arrays for hashes and entries, otherwise read with mem offsets.
-        if (!archive->m_IsMemMapped)
+        int first = 0;
+        int last = (int)entry_count-1;
+
+        // Narrow the search down to the entries with the same leading bits, if the lookup table is up to date
+        const ArchiveFileIndex* afi = archive->m_ArchiveFileIndex;
+        if (afi && afi->m_LookupTable && afi->m_LookupHashes == hashes && afi->m_LookupEntryCount == entry_count && hash_len >= sizeof(uint32_t))
         {
-            hashes = archive->m_ArchiveFileIndex->m_Hashes;
-            entries = archive->m_ArchiveFileIndex->m_Entries;
-        }
-        else
-        {
-            hashes = (uint8_t*)((uintptr_t)archive->m_ArchiveIndex + hash_offset);
-            entries = (dmResourceArchive::EntryData*)((uintptr_t)archive->m_ArchiveIndex + entry_offset);
+            uint32_t prefix = GetHashPrefix(hash) >> (32 - afi->m_LookupBits);
+            first = (int)afi->m_LookupTable[prefix];
+            last = (int)afi->m_LookupTable[prefix + 1] - 1;
         }
 
         // Search for hash with binary search (entries are sorted on hash)
-        int first = 0;
-        int last = (int)entry_count-1;
         while (first <= last)
         {
             int mid = first + (last - first) / 2;
@@ -390,6 +683,9 @@ namespace dmResourceArchive
         {
             dst->m_EntryDataOffset = dmEndian::ToHost(dmEndian::ToNetwork(dst->m_EntryDataOffset) + dmResourceArchive::MAX_HASH * extra_entries_alloc);
         }
+
+        // The dictionary table isn't part of the copy
+        dst->m_DictionaryOffset = 0;
     }
 
     Result WriteResourceToArchive(HArchiveIndexContainer& archive, const uint8_t* buf, uint32_t buf_len, uint32_t& bytes_written, uint32_t& offset)
@@ -496,6 +792,11 @@ namespace dmResourceArchive
 
         memcpy((void*)entries_shift_src, (void*)&entry, sizeof(EntryData));
         archive->m_EntryDataCount = dmEndian::ToHost(dmEndian::ToNetwork(archive->m_EntryDataCount) + 1);
+
+        if (archive == archive_container->m_ArchiveIndex)
+        {
+            UpdateLookupTable(archive_container);
+        }
         return RESULT_OK;
     }
 
@@ -509,8 +810,14 @@ namespace dmResourceArchive
 
         bool encrypted = (flags & dmResourceArchive::ENTRY_FLAG_ENCRYPTED);
         bool compressed = (flags & dmResourceArchive::ENTRY_FLAG_COMPRESSED);
+        uint32_t dictionary = (flags & ENTRY_DICTIONARY_MASK) >> ENTRY_DICTIONARY_SHIFT;
 
         const ArchiveFileIndex* afi = archive->m_ArchiveFileIndex;
+        if (compressed && dictionary > afi->m_DictionaryCount)
+        {
+            dmLogError("Archive entry uses dictionary %u, but the archive only has %u dictionaries", dictionary, afi->m_DictionaryCount);
+            return dmResourceArchive::RESULT_INVALID_DATA;
+        }
         bool resource_memmapped = afi->m_IsMemMapped;
 
         uint8_t* temp_data = 0;
@@ -519,9 +826,8 @@ namespace dmResourceArchive
 
         if (!resource_memmapped)
         {
-            // we need to read from the file on disc
+            // we need to read from the file on disc (or with the read callback)
             FILE* resource_file = afi->m_FileResourceData;
-            fseek(resource_file, resource_offset, SEEK_SET);
 
             Result result = dmResourceArchive::RESULT_OK;
             // Note, we don't need to check if it's encrypted here, as it's guaranteed to
@@ -530,10 +836,7 @@ namespace dmResourceArchive
             if (!compressed)
             {
                 // we can read directly to the output buffer
-                if (fread(buffer, 1, size, resource_file) != size)
-                {
-                    result = dmResourceArchive::RESULT_IO_ERROR;
-                }
+                result = ReadResourceData(afi, resource_file, resource_offset, size, buffer);
                 source_data = (uint8_t*)buffer;
                 source_data_size = (uint32_t)size;
             }
@@ -541,10 +844,7 @@ namespace dmResourceArchive
             {
                 // We need a temp buffer to read to, since we can't decompress to the same buffer
                 temp_data = new uint8_t[compressed_size];
-                if (fread(temp_data, 1, compressed_size, resource_file) != compressed_size)
-                {
-                    result = RESULT_IO_ERROR;
-                }
+                result = ReadResourceData(afi, resource_file, resource_offset, compressed_size, temp_data);
                 source_data = temp_data;
                 source_data_size = compressed_size;
             }
@@ -558,6 +858,7 @@ namespace dmResourceArchive
         else
         {
             const uint8_t* archive_data = (uint8_t*) (((uintptr_t)afi->m_ResourceData + resource_offset));
+            ReadAheadMappedData(afi, resource_offset, compressed ? compressed_size : size);
 
             if (!compressed)
             {
@@ -602,7 +903,16 @@ namespace dmResourceArchive
         if (compressed)
         {
             int decompressed_size;
-            dmLZ4::Result r = dmLZ4::DecompressBuffer(source_data, source_data_size, buffer, size, &decompressed_size);
+            dmLZ4::Result r;
+            if (dictionary != 0)
+            {
+                const ArchiveDictionary& d = afi->m_Dictionaries[dictionary - 1];
+                r = dmLZ4::DecompressBufferWithDictionary(source_data, source_data_size, d.m_Data, d.m_Size, buffer, size, &decompressed_size);
+            }
+            else
+            {
+                r = dmLZ4::DecompressBuffer(source_data, source_data_size, buffer, size, &decompressed_size);
+            }
             if (dmLZ4::RESULT_OK != r)
             {
                 delete[] temp_data;
@@ -614,6 +924,56 @@ namespace dmResourceArchive
         return dmResourceArchive::RESULT_OK;
     }
 
+    Result GetEntryDataInPlace(HArchiveIndexContainer archive, const EntryData* entry, const uint8_t** data)
+    {
+        const uint32_t flags = dmEndian::ToNetwork(entry->m_Flags);
+        const ArchiveFileIndex* afi = archive->m_ArchiveFileIndex;
+        if (!afi->m_IsMemMapped || (flags & (ENTRY_FLAG_ENCRYPTED | ENTRY_FLAG_COMPRESSED)) != 0)
+        {
+            return RESULT_NOT_FOUND;
+        }
+
+        *data = afi->m_ResourceData + dmEndian::ToNetwork(entry->m_ResourceDataOffset);
+        return RESULT_OK;
+    }
+
+    Result ReadEntryPartial(HArchiveIndexContainer archive, const EntryData* entry, uint32_t offset, uint32_t size, void* buffer, uint32_t* nread)
+    {
+        const uint32_t flags = dmEndian::ToNetwork(entry->m_Flags);
+        if ((flags & (ENTRY_FLAG_ENCRYPTED | ENTRY_FLAG_COMPRESSED)) != 0)
+        {
+            return RESULT_NOT_FOUND;
+        }
+
+        const uint32_t resource_size = dmEndian::ToNetwork(entry->m_ResourceSize);
+        if (offset >= resource_size)
+        {
+            *nread = 0;
+            return RESULT_OK;
+        }
+        if (size > resource_size - offset)
+        {
+            size = resource_size - offset;
+        }
+
+        const ArchiveFileIndex* afi = archive->m_ArchiveFileIndex;
+        const uint32_t resource_offset = dmEndian::ToNetwork(entry->m_ResourceDataOffset) + offset;
+        if (afi->m_IsMemMapped)
+        {
+            memcpy(buffer, afi->m_ResourceData + resource_offset, size);
+        }
+        else
+        {
+            Result result = ReadResourceData(afi, afi->m_FileResourceData, resource_offset, size, buffer);
+            if (result != RESULT_OK)
+            {
+                return result;
+            }
+        }
+        *nread = size;
+        return RESULT_OK;
+    }
+
     Result WriteArchiveIndex(const char* path, ArchiveIndex* ai)
     {
         // Write to temporary index file, filename liveupdate.arci.tmp
@@ -685,6 +1045,7 @@ namespace dmResourceArchive
         archive_container->m_ArchiveIndex = new_index;
         // Since we store data sequentially when doing the deep-copy we want to access it in that fashion
         archive_container->m_IsMemMapped = mem_mapped;
+        UpdateLookupTable(archive_container);
     }
 
     uint32_t GetEntryCount(HArchiveIndexContainer archive)
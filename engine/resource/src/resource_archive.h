@@ -24,6 +24,7 @@
 #include <dlib/align.h>
 #include <dlib/array.h>
 #include <dlib/path.h> // DMPATH_MAX_PATH
+#include <dmsdk/dlib/atomic.h>
 
 
 namespace dmResourceArchive
@@ -60,6 +61,11 @@ namespace dmResourceArchive
         ENTRY_FLAG_LIVEUPDATE_DATA  = 1 << 2,
     };
 
+    // Bits 8-15 of the entry flags holds the compression dictionary of the entry (index + 1), or 0 if no dictionary was used
+    const static uint32_t ENTRY_DICTIONARY_SHIFT = 8;
+    const static uint32_t ENTRY_DICTIONARY_MASK  = 0xFF << ENTRY_DICTIONARY_SHIFT;
+    const static uint32_t MAX_DICTIONARIES       = 255;
+
     // part of the .arci file format
     struct DM_ALIGNED(16) EntryData
     {
@@ -72,7 +78,16 @@ namespace dmResourceArchive
         uint32_t m_ResourceDataOffset;
         uint32_t m_ResourceSize;
         uint32_t m_ResourceCompressedSize;  // 0xFFFFFFFF if uncompressed
-        uint32_t m_Flags;                   // A combination of dmResourceArchive::EntryFlag
+        uint32_t m_Flags;                   // A combination of dmResourceArchive::EntryFlag, and the dictionary (ENTRY_DICTIONARY_MASK)
+    };
+
+    // part of the .arci file format
+    // At ArchiveIndex::m_DictionaryOffset there's a uint32_t count, followed by the DictionaryData entries.
+    // The dictionaries themselves are stored in the .arcd file
+    struct DictionaryData
+    {
+        uint32_t m_ResourceDataOffset;
+        uint32_t m_Size;
     };
 
     // For memory mapped files (or files read directly into memory)
@@ -81,7 +96,7 @@ namespace dmResourceArchive
         ArchiveIndex();
 
         uint32_t m_Version;
-        uint32_t :32;
+        uint32_t m_DictionaryOffset;    // 0 if the archive has no compression dictionaries
         uint64_t m_Userdata;
         uint32_t m_EntryDataCount;
         uint32_t m_EntryDataOffset;
@@ -90,6 +105,22 @@ namespace dmResourceArchive
         uint8_t  m_ArchiveIndexMD5[16]; // 16 bytes is the size of md5
     };
 
+    struct ArchiveDictionary
+    {
+        const uint8_t*  m_Data;
+        uint32_t        m_Size;
+    };
+
+    /**
+     * Reads a part of the resource data (game.arcd), for archives where the data is neither a local file nor in memory
+     * @param context the context given when wrapping the archive
+     * @param offset offset into the resource data
+     * @param size number of bytes to read
+     * @param buffer buffer to read to
+     * @return RESULT_OK if all bytes were read
+     */
+    typedef Result (*FReadArchiveData)(void* context, uint32_t offset, uint32_t size, void* buffer);
+
     // Used if the archive is loaded from file (i.e a bundled archive of live update archive)
     struct ArchiveFileIndex
     {
@@ -103,7 +134,18 @@ namespace dmResourceArchive
         FILE*       m_FileResourceData; // game.arcd file handle
         uint8_t*    m_ResourceData;     // mem-mapped game.arcd
         uint32_t    m_ResourceSize;     // the size of the memory mapped region
+        ArchiveDictionary* m_Dictionaries;  // The compression dictionaries, shared by the entries
+        uint32_t    m_DictionaryCount;
+        uint8_t*    m_DictionaryBuffer; // Dictionaries read from the game.arcd file (if not memory mapped)
+        uint32_t*   m_LookupTable;      // For each value of the leading m_LookupBits bits of a hash, the first index in the sorted hashes (+ an end index)
+        const uint8_t* m_LookupHashes;  // The hashes the lookup table was built for
+        uint32_t    m_LookupEntryCount; // The entry count the lookup table was built for
+        uint32_t    m_LookupBits;
+        FReadArchiveData m_ReadData;    // Reads the resource data, if it's neither a file nor memory mapped
+        void*       m_ReadDataContext;
         bool        m_IsMemMapped;      // Is the data memory mapped?
+        int32_atomic_t m_LastReadEnd;   // The end of the most recently read memory mapped data, to detect sequential reads
+        int32_atomic_t m_ReadAheadEnd;  // The end of the memory mapped data that has been requested ahead of the reads
     };
 
     struct ArchiveIndexContainer
@@ -194,6 +236,20 @@ namespace dmResourceArchive
                              const void* resource_data, uint32_t resource_data_size, bool mem_mapped_data,
                              HArchiveIndexContainer* archive);
 
+    /**
+     * Wrap an archive index already loaded in memory, where the resource data is read on demand
+     * (e.g. with range requests to a server). The index memory is owned by the caller.
+     * @param index_buffer archive index memory to wrap
+     * @param index_buffer_size archive index size
+     * @param read_data reads the resource data. Called for the dictionaries when wrapping, and for each read entry
+     * @param read_data_context passed to read_data
+     * @param archive archive index container handle
+     * @return RESULT_OK on success
+     */
+    Result WrapArchiveIndex(const void* index_buffer, uint32_t index_buffer_size,
+                            FReadArchiveData read_data, void* read_data_context,
+                            HArchiveIndexContainer* archive);
+
     /**
      * Find resource entry within the loaded archives
      * @param archive archive index handle
@@ -212,6 +268,28 @@ namespace dmResourceArchive
      */
     Result ReadEntry(HArchiveIndexContainer archive, const EntryData* entry, void* buffer);
 
+    /**
+     * Get the resource data without copying it. Only possible for memory mapped archives, where
+     * the entry is neither compressed nor encrypted. The data is valid as long as the archive is.
+     * @param archive archive index handle
+     * @param entry_data entry data
+     * @param data pointer to the resource data
+     * @return RESULT_OK on success, RESULT_NOT_FOUND if the data isn't available in place
+     */
+    Result GetEntryDataInPlace(HArchiveIndexContainer archive, const EntryData* entry, const uint8_t** data);
+
+    /**
+     * Read a part of the resource data. Only possible for entries that are neither compressed nor encrypted.
+     * @param archive archive index handle
+     * @param entry_data entry data
+     * @param offset offset into the resource data
+     * @param size number of bytes to read
+     * @param buffer buffer to read to
+     * @param nread number of bytes read, less than size at the end of the resource
+     * @return RESULT_OK on success, RESULT_NOT_FOUND if the entry can't be read partially
+     */
+    Result ReadEntryPartial(HArchiveIndexContainer archive, const EntryData* entry, uint32_t offset, uint32_t size, void* buffer, uint32_t* nread);
+
     /**
      * Delete archive index. Only required for archives created with LoadArchive function
      * @param archive archive index handle
@@ -21,6 +21,7 @@
 #include <resource/liveupdate_ddf.h>
 
 #include <dlib/dstrings.h>
+#include <dlib/hashtable.h>
 #include <dlib/log.h>
 #include <dlib/mutex.h>
 #include <dlib/sys.h>
@@ -55,6 +56,10 @@ struct ResourceMountsContext
     dmResourceProvider::HArchive    m_ResourceBaseArchive;
     dmMutex::HMutex                 m_Mutex;
 
+    // Archives that can be read concurrently are read without holding m_Mutex.
+    // If such an archive is removed while being read, the last reader unmounts it.
+    dmHashTable64<uint32_t>                 m_ActiveReads;      // archive -> number of reads in progress
+    dmArray<dmResourceProvider::HArchive>   m_PendingUnmounts;
 };
 
 
@@ -71,6 +76,61 @@ static dmResource::Result ProviderResultToResult(dmResourceProvider::Result resu
 
 static dmResource::Result DestroyMounts(HContext ctx);
 
+// Assumes mutex lock is held
+static void UnmountArchive(HContext ctx, dmResourceProvider::HArchive archive)
+{
+    if (ctx->m_ActiveReads.Get((uintptr_t)archive))
+    {
+        if (ctx->m_PendingUnmounts.Full())
+            ctx->m_PendingUnmounts.OffsetCapacity(2);
+        ctx->m_PendingUnmounts.Push(archive);
+        DM_RESOURCE_DBG_LOG(1, "Deferred unmount of archive %p until its reads are done\n", archive);
+        return;
+    }
+    dmResourceProvider::Unmount(archive);
+}
+
+// Assumes mutex lock is held. The lock is released while the file is read.
+static dmResourceProvider::Result ReadFileUnlocked(HContext ctx, dmResourceProvider::HArchive archive, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_size)
+{
+    uint32_t* active_reads = ctx->m_ActiveReads.Get((uintptr_t)archive);
+    if (active_reads)
+    {
+        ++*active_reads;
+    }
+    else
+    {
+        if (ctx->m_ActiveReads.Full())
+        {
+            uint32_t capacity = ctx->m_ActiveReads.Capacity() + 8;
+            ctx->m_ActiveReads.SetCapacity((capacity*2)/3, capacity);
+        }
+        ctx->m_ActiveReads.Put((uintptr_t)archive, 1);
+    }
+
+    dmMutex::Unlock(ctx->m_Mutex);
+    dmResourceProvider::Result result = dmResourceProvider::ReadFile(archive, path_hash, path, buffer, buffer_size);
+    dmMutex::Lock(ctx->m_Mutex);
+
+    active_reads = ctx->m_ActiveReads.Get((uintptr_t)archive);
+    if (--*active_reads == 0)
+    {
+        ctx->m_ActiveReads.Erase((uintptr_t)archive);
+
+        uint32_t size = ctx->m_PendingUnmounts.Size();
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            if (ctx->m_PendingUnmounts[i] == archive)
+            {
+                ctx->m_PendingUnmounts.EraseSwap(i);
+                dmResourceProvider::Unmount(archive);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
 HContext Create(dmResourceProvider::HArchive base_archive)
 {
     ResourceMountsContext* ctx = new ResourceMountsContext;
@@ -86,6 +146,14 @@ void Destroy(HContext ctx)
         DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
         DestroyMounts(ctx);
 
+        // All load threads should be stopped by now
+        uint32_t size = ctx->m_PendingUnmounts.Size();
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            dmResourceProvider::Unmount(ctx->m_PendingUnmounts[i]);
+        }
+        ctx->m_PendingUnmounts.SetSize(0);
+
         ctx->m_CustomFiles.Clear();
     }
     dmMutex::Delete(ctx->m_Mutex);
@@ -203,7 +271,7 @@ dmResource::Result RemoveAndUnmountByName(HContext ctx, const char* name)
         ArchiveMount& mount = ctx->m_Mounts[i];
         if (strcmp(mount.m_Name, name) == 0)
         {
-            dmResourceProvider::Unmount(mount.m_Archive);
+            UnmountArchive(ctx, mount.m_Archive);
             return RemoveMountByIndexInternal(ctx, i);
         }
     }
@@ -360,7 +428,7 @@ static dmResource::Result DestroyMounts(HContext ctx)
     {
         ArchiveMount& mount = ctx->m_Mounts[i];
         free((void*)mount.m_Name);
-        dmResourceProvider::Unmount(mount.m_Archive);
+        UnmountArchive(ctx, mount.m_Archive);
     }
     ctx->m_Mounts.SetSize(0);
     return dmResource::RESULT_OK;
@@ -437,6 +505,18 @@ dmResource::Result ReadResource(HContext ctx, dmhash_t path_hash, const char* pa
     for (uint32_t i = 0; i < size; ++i)
     {
         ArchiveMount& mount = ctx->m_Mounts[i];
+        if (dmResourceProvider::CanReadConcurrently(mount.m_Archive))
+        {
+            // Since the lock is released during the read, the mounts may change, so we stop at the first archive that has the file
+            uint32_t file_size;
+            if (dmResourceProvider::RESULT_OK != dmResourceProvider::GetFileSize(mount.m_Archive, path_hash, path, &file_size))
+                continue;
+            DebugPrintMount(3, mount);
+            dmResourceProvider::Result result = ReadFileUnlocked(ctx, mount.m_Archive, path_hash, path, buffer, buffer_size);
+            DM_RESOURCE_DBG_LOG(3, "ReadResource: %s (%u bytes) - result %d\n", path, buffer_size, result);
+            return ProviderResultToResult(result);
+        }
+
         dmResourceProvider::Result result = dmResourceProvider::ReadFile(mount.m_Archive, path_hash, path, buffer, buffer_size);
         if (dmResourceProvider::RESULT_NOT_FOUND == result)
             continue;
@@ -471,9 +551,12 @@ dmResource::Result ReadResource(HContext ctx, const char* path, dmhash_t path_ha
                 buffer->SetCapacity(resource_size);
             buffer->SetSize(resource_size);
 
-            result = dmResourceProvider::ReadFile(mount.m_Archive, path_hash, path, (uint8_t*)buffer->Begin(), resource_size);
-            DM_RESOURCE_DBG_LOG(3, "ReadResource: %s (%u bytes) - result %d\n", path, resource_size, result);
             DebugPrintMount(3, mount);
+            if (dmResourceProvider::CanReadConcurrently(mount.m_Archive))
+                result = ReadFileUnlocked(ctx, mount.m_Archive, path_hash, path, (uint8_t*)buffer->Begin(), resource_size);
+            else
+                result = dmResourceProvider::ReadFile(mount.m_Archive, path_hash, path, (uint8_t*)buffer->Begin(), resource_size);
+            DM_RESOURCE_DBG_LOG(3, "ReadResource: %s (%u bytes) - result %d\n", path, resource_size, result);
             return ProviderResultToResult(result);
         }
     }
@@ -494,6 +577,58 @@ dmResource::Result ReadResource(HContext ctx, const char* path, dmhash_t path_ha
     return dmResource::RESULT_RESOURCE_NOT_FOUND;
 }
 
+dmResource::Result GetResourceData(HContext ctx, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_size)
+{
+    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+
+    uint32_t size = ctx->m_Mounts.Size();
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        ArchiveMount& mount = ctx->m_Mounts[i];
+        dmResourceProvider::Result result = dmResourceProvider::GetFileData(mount.m_Archive, path_hash, path, data, data_size);
+        if (dmResourceProvider::RESULT_OK == result)
+        {
+            DM_RESOURCE_DBG_LOG(3, "GetResourceData: %s (%u bytes)\n", path, *data_size);
+            DebugPrintMount(3, mount);
+            return dmResource::RESULT_OK;
+        }
+        if (dmResourceProvider::RESULT_NOT_FOUND == result)
+            continue;
+
+        // The mount doesn't support it, but if it has the file, it still takes precedence over the other mounts
+        uint32_t file_size;
+        if (dmResourceProvider::RESULT_NOT_FOUND == dmResourceProvider::GetFileSize(mount.m_Archive, path_hash, path, &file_size))
+            continue;
+        return dmResource::RESULT_NOT_SUPPORTED;
+    }
+
+    // Let the caller read it the regular way, which also handles the custom files
+    return dmResource::RESULT_NOT_SUPPORTED;
+}
+
+dmResource::Result ReadResourcePartial(HContext ctx, dmhash_t path_hash, const char* path, uint32_t offset, uint32_t size, uint8_t* buffer, uint32_t* nread)
+{
+    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+
+    uint32_t mount_count = ctx->m_Mounts.Size();
+    for (uint32_t i = 0; i < mount_count; ++i)
+    {
+        ArchiveMount& mount = ctx->m_Mounts[i];
+        uint32_t file_size;
+        if (dmResourceProvider::RESULT_OK != dmResourceProvider::GetFileSize(mount.m_Archive, path_hash, path, &file_size))
+            continue;
+
+        // The mount with the file takes precedence over the other mounts, even if it can't read it partially
+        dmResourceProvider::Result result = dmResourceProvider::ReadFilePartial(mount.m_Archive, path_hash, path, offset, size, buffer, nread);
+        DM_RESOURCE_DBG_LOG(3, "ReadResourcePartial: %s (%u bytes at %u) - result %d\n", path, size, offset, result);
+        if (dmResourceProvider::RESULT_NOT_SUPPORTED == result)
+            return dmResource::RESULT_NOT_SUPPORTED;
+        return ProviderResultToResult(result);
+    }
+
+    return dmResource::RESULT_RESOURCE_NOT_FOUND;
+}
+
 // ****************************************
 // Custom files
 
@@ -52,6 +52,15 @@ namespace dmResourceMounts
     dmResource::Result ReadResource(HContext ctx, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_size);
     dmResource::Result ReadResource(HContext ctx, dmhash_t path_hash, const char* path, dmArray<char>* buffer);
 
+    // Gets the resource data without copying it, from the mount that has the resource.
+    // Returns RESULT_NOT_SUPPORTED if that mount can't provide the data in place (e.g. it's compressed).
+    // The data is valid as long as the archive stays mounted
+    dmResource::Result GetResourceData(HContext ctx, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_size);
+
+    // Reads a part of the resource, from the mount that has the resource.
+    // Returns RESULT_NOT_SUPPORTED if that mount can't read it partially (e.g. it's compressed).
+    dmResource::Result ReadResourcePartial(HContext ctx, dmhash_t path_hash, const char* path, uint32_t offset, uint32_t size, uint8_t* buffer, uint32_t* nread);
+
     struct SGetMountResult
     {
         const char*                  m_Name;
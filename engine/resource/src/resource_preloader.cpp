@@ -22,6 +22,7 @@
 #include <dlib/hash.h>
 #include <dlib/hashtable.h>
 #include <dlib/log.h>
+#include <dlib/memory.h>
 #include <dlib/uri.h>
 #include <dlib/time.h>
 #include <dlib/spinlock.h>
@@ -110,6 +111,8 @@ struct ResourcePostCreateParamsInternal
 {
     ResourcePostCreateParams m_Params;
     ResourceDescriptor m_ResourceDesc;
+    // Recorded into the load trace once the post create function has finished
+    dmResource::LoadTraceEntry m_Trace;
     bool m_Destroy;
 };
 
@@ -134,10 +137,17 @@ struct PreloadRequest
     // Set for items that are pending and waiting for children to complete
     void* m_Buffer;
     uint32_t m_BufferSize;
+    // If m_Buffer points into a mounted archive, rather than being allocated from the block allocator
+    bool m_BufferInPlace;
 
     // Set once preload function has run
     void* m_PreloadData;
 
+    // Stage timings for the load trace, see dmResource::LoadTraceEntry
+    uint64_t m_StartTime;
+    uint32_t m_LoadTime;
+    uint32_t m_PreloadTime;
+
     // Set once load has completed
     dmResource::Result m_LoadResult;
     void* m_Resource;
@@ -188,6 +198,13 @@ struct ResourcePreloader
     TRequestIndex m_PersistResourceCount;
 
     dmArray<void*> m_PersistedResources;
+
+    // Scheduling among the preloaders of the factory, see SetPreloaderPriority and SetPreloaderDeadline
+    dmResource::PreloaderPriority m_Priority;
+    // The priority the preloader is counted as busy with in the factory, -1 once done
+    int32_t m_BusyPriority;
+    uint64_t m_DeadlineStart;
+    uint64_t m_Deadline;
 };
 
 namespace dmResource
@@ -481,6 +498,12 @@ namespace dmResource
 
         preloader->m_BlockAllocator = dmBlockAllocator::CreateContext();
 
+        preloader->m_Priority      = PRELOADER_PRIORITY_NORMAL;
+        preloader->m_BusyPriority  = PRELOADER_PRIORITY_NORMAL;
+        preloader->m_DeadlineStart = 0;
+        preloader->m_Deadline      = 0;
+        AddBusyPreloader(factory, PRELOADER_PRIORITY_NORMAL, 1);
+
         if (root->m_LoadResult == RESULT_OK)
         {
             root->m_LoadResult = RESULT_PENDING;
@@ -513,8 +536,10 @@ namespace dmResource
     //   2) Having failed, (or created and destroyed), leaving => RESULT_SOME_ERROR + everything free:d
     //
     // If buffer is null it means to use the items internal buffer
-    static void CreateResource(HPreloader preloader, PreloadRequest* req, void* buffer, uint32_t buffer_size)
+    // If the resource was already created on the load thread, load_result holds the created resource
+    static void CreateResource(HPreloader preloader, PreloadRequest* req, void* buffer, uint32_t buffer_size, const dmLoadQueue::LoadResult* load_result)
     {
+        DM_MEMORY_TAG(dmMemory::TAG_RESOURCE);
         assert(req->m_LoadResult == RESULT_PENDING);
         assert(req->m_PendingChildCount == 0);
 
@@ -538,26 +563,55 @@ namespace dmResource
         params.m_Resource    = &tmp_resource;
         params.m_Filename    = req->m_PathDescriptor.m_InternalizedName;
 
-        if (!buffer)
+        uint64_t create_start = dmTime::GetTime();
+        uint32_t create_time  = 0;
+
+        if (load_result && load_result->m_CreateResult != RESULT_PENDING)
         {
+            assert(buffer);
+            memcpy(&tmp_resource, &load_result->m_Resource, sizeof(ResourceDescriptor));
+            req->m_LoadResult = load_result->m_CreateResult;
+            create_time       = load_result->m_CreateTime;
+        }
+        else if (!buffer)
+        {
+            DM_PROFILE("Create");
             assert(req->m_Buffer);
             tmp_resource.m_ResourceSizeOnDisc = req->m_BufferSize;
             params.m_Buffer                   = req->m_Buffer;
             params.m_BufferSize               = req->m_BufferSize;
             req->m_LoadResult                 = (Result)resource_type->m_CreateFunction(&params);
 
-            dmBlockAllocator::Free(preloader->m_BlockAllocator, req->m_Buffer, req->m_BufferSize);
+            if (!req->m_BufferInPlace)
+            {
+                dmBlockAllocator::Free(preloader->m_BlockAllocator, req->m_Buffer, req->m_BufferSize);
+            }
 
             req->m_Buffer = 0;
+            req->m_BufferInPlace = false;
+            create_time = (uint32_t)(dmTime::GetTime() - create_start);
         }
         else
         {
+            DM_PROFILE("Create");
             tmp_resource.m_ResourceSizeOnDisc = buffer_size;
             params.m_Buffer                   = buffer;
             params.m_BufferSize               = buffer_size;
             req->m_LoadResult                 = (Result)resource_type->m_CreateFunction(&params);
+            create_time = (uint32_t)(dmTime::GetTime() - create_start);
         }
 
+        LoadTraceEntry trace;
+        memset(&trace, 0, sizeof(trace));
+        trace.m_Id          = req->m_PathDescriptor.m_CanonicalPathHash;
+        trace.m_Extension   = resource_type->m_Extension;
+        trace.m_StartTime   = req->m_StartTime;
+        trace.m_SizeOnDisc  = tmp_resource.m_ResourceSizeOnDisc;
+        trace.m_Size        = tmp_resource.m_ResourceSize;
+        trace.m_LoadTime    = req->m_LoadTime;
+        trace.m_PreloadTime = req->m_PreloadTime;
+        trace.m_CreateTime  = create_time;
+
         if (req->m_LoadResult == RESULT_OK)
         {
             if (resource_type->m_PostCreateFunction)
@@ -574,6 +628,7 @@ namespace dmResource
                 ip.m_Params.m_Context                = resource_type->m_Context;
                 ip.m_Params.m_PreloadData            = req->m_PreloadData;
                 ip.m_Params.m_Resource               = 0;
+                ip.m_Trace                           = trace;
                 memcpy(&ip.m_ResourceDesc, &tmp_resource, sizeof(ResourceDescriptor));
             }
         }
@@ -600,11 +655,10 @@ namespace dmResource
         bool destroy = false;
 
         // If someone else has loaded the resource already, use that one and mark our loaded resource for destruction
-        ResourceDescriptor* rd = FindByHash(preloader->m_Factory, req->m_PathDescriptor.m_CanonicalPathHash);
+        ResourceDescriptor* rd = GetByHash(preloader->m_Factory, req->m_PathDescriptor.m_CanonicalPathHash);
         if (rd)
         {
             // Use already loaded resource
-            rd->m_ReferenceCount++;
             req->m_Resource = rd->m_Resource;
             destroy         = true;
         }
@@ -615,6 +669,11 @@ namespace dmResource
             if (req->m_LoadResult == RESULT_OK)
             {
                 req->m_Resource = tmp_resource.m_Resource;
+                // Resources with a post create function are recorded once it has finished
+                if (!resource_type->m_PostCreateFunction)
+                {
+                    RecordLoadTrace(preloader->m_Factory, trace);
+                }
             }
             else
             {
@@ -685,7 +744,7 @@ namespace dmResource
         {
             return false;
         }
-        CreateResource(preloader, parent_req, 0, 0);
+        CreateResource(preloader, parent_req, 0, 0, 0);
         UnmarkPathInProgress(preloader, &parent_req->m_PathDescriptor);
         PreloaderTryPruneParent(preloader, parent_req);
         return true;
@@ -719,6 +778,8 @@ namespace dmResource
         }
 
         req->m_PreloadData = load_result.m_PreloadData;
+        req->m_LoadTime    = load_result.m_LoadTime;
+        req->m_PreloadTime = load_result.m_PreloadTime;
 
         bool created_resource = false;
 
@@ -727,8 +788,8 @@ namespace dmResource
         {
             if (req->m_LoadResult == RESULT_PENDING)
             {
-                // Create the resource using the loading buffer directly.
-                CreateResource(preloader, req, buffer, buffer_size);
+                // Create the resource using the loading buffer directly, unless the load thread already did
+                CreateResource(preloader, req, buffer, buffer_size, &load_result);
                 created_resource = true;
             }
             UnmarkPathInProgress(preloader, &req->m_PathDescriptor);
@@ -739,9 +800,20 @@ namespace dmResource
         }
         else
         {
-            // Keep the loaded bytes until we have loaded all children
-            req->m_Buffer = dmBlockAllocator::Allocate(preloader->m_BlockAllocator, buffer_size);
-            memcpy(req->m_Buffer, buffer, buffer_size);
+            // Only resources without children are created on the load thread
+            assert(load_result.m_CreateResult == RESULT_PENDING);
+
+            // Keep the loaded bytes until we have loaded all children. Data in place in the archive outlives the load request
+            if (load_result.m_InPlace)
+            {
+                req->m_Buffer = buffer;
+            }
+            else
+            {
+                req->m_Buffer = dmBlockAllocator::Allocate(preloader->m_BlockAllocator, buffer_size);
+                memcpy(req->m_Buffer, buffer, buffer_size);
+            }
+            req->m_BufferInPlace = load_result.m_InPlace;
             req->m_BufferSize = buffer_size;
             dmLoadQueue::FreeLoad(preloader->m_LoadQueue, req->m_LoadRequest);
             req->m_LoadRequest = 0;
@@ -833,10 +905,9 @@ namespace dmResource
         }
 
         // It might have been loaded by unhinted resource Gets or loaded by a different preloader, just grab & bump refcount
-        ResourceDescriptor* rd = FindByHash(preloader->m_Factory, req->m_PathDescriptor.m_CanonicalPathHash);
+        ResourceDescriptor* rd = GetByHash(preloader->m_Factory, req->m_PathDescriptor.m_CanonicalPathHash);
         if (rd)
         {
-            rd->m_ReferenceCount++;
             req->m_Resource   = rd->m_Resource;
             req->m_LoadResult = RESULT_OK;
             RemoveChildren(preloader, req);
@@ -864,12 +935,18 @@ namespace dmResource
         info.m_HintInfo.m_Parent    = index;
         info.m_CompleteFunction     = req->m_PathDescriptor.m_ResourceType->m_PreloadFunction;
         info.m_Context              = req->m_PathDescriptor.m_ResourceType->m_Context;
+        info.m_CreateType           = req->m_PathDescriptor.m_ResourceType->m_CreateThreadSafe ? req->m_PathDescriptor.m_ResourceType : 0;
+        info.m_CanonicalPathHash    = req->m_PathDescriptor.m_CanonicalPathHash;
+        info.m_LoadInPlace          = req->m_PathDescriptor.m_ResourceType->m_LoadInPlace != 0;
 
         // If we can't add the request to the load queue it is because the queue is full
         // We will try again once we completed loading of an item via dmLoadQueue::EndLoad
         if ((req->m_LoadRequest = dmLoadQueue::BeginLoad(preloader->m_LoadQueue, req->m_PathDescriptor.m_InternalizedName, req->m_PathDescriptor.m_InternalizedCanonicalPath, &info)))
         {
+            req->m_StartTime = dmTime::GetTime();
             MarkPathInProgress(preloader, &req->m_PathDescriptor);
+            RecordLoadOrder(preloader->m_Factory, req->m_PathDescriptor.m_InternalizedCanonicalPath, req->m_PathDescriptor.m_CanonicalPathHash,
+                            preloader->m_Request[0].m_PathDescriptor.m_InternalizedCanonicalPath);
             return true;
         }
 
@@ -886,7 +963,13 @@ namespace dmResource
         ResourcePostCreateParams& params     = ip.m_Params;
         params.m_Resource                    = &ip.m_ResourceDesc;
         ResourceType* resource_type          = params.m_Resource->m_ResourceType;
-        Result ret                           = (Result)resource_type->m_PostCreateFunction(&params);
+        uint64_t start                       = dmTime::GetTime();
+        Result ret;
+        {
+            DM_PROFILE("PostCreate");
+            ret = (Result)resource_type->m_PostCreateFunction(&params);
+        }
+        ip.m_Trace.m_PostCreateTime += (uint32_t)(dmTime::GetTime() - start);
 
         if (ret == RESULT_PENDING)
         {
@@ -911,6 +994,8 @@ namespace dmResource
             {
                 if (params.m_Resource->m_ResourceSize != 0)
                     rd->m_ResourceSize = params.m_Resource->m_ResourceSize;
+                ip.m_Trace.m_Size = params.m_Resource->m_ResourceSize;
+                RecordLoadTrace(preloader->m_Factory, ip.m_Trace);
             }
         }
 
@@ -923,11 +1008,54 @@ namespace dmResource
         return ret;
     }
 
-    Result UpdatePreloader(HPreloader preloader, FPreloaderCompleteCallback complete_callback, PreloaderCompleteCallbackParams* complete_callback_params, uint32_t soft_time_limit)
+    static void SetBusyPriority(HPreloader preloader, int32_t priority)
     {
-        DM_PROFILE("UpdatePreloader");
+        if (priority == preloader->m_BusyPriority)
+        {
+            return;
+        }
+        if (preloader->m_BusyPriority >= 0)
+        {
+            AddBusyPreloader(preloader->m_Factory, (PreloaderPriority) preloader->m_BusyPriority, -1);
+        }
+        if (priority >= 0)
+        {
+            AddBusyPreloader(preloader->m_Factory, (PreloaderPriority) priority, 1);
+        }
+        preloader->m_BusyPriority = priority;
+    }
+
+    static PreloaderPriority GetEffectivePriority(HPreloader preloader, uint64_t time)
+    {
+        // Catch up on the loading once half of the time to the deadline has passed
+        if (preloader->m_Deadline != 0 && (time - preloader->m_DeadlineStart) >= (preloader->m_Deadline - preloader->m_DeadlineStart) / 2)
+        {
+            return PRELOADER_PRIORITY_HIGH;
+        }
+        return preloader->m_Priority;
+    }
+
+    void SetPreloaderPriority(HPreloader preloader, PreloaderPriority priority)
+    {
+        preloader->m_Priority = priority;
+        if (preloader->m_BusyPriority >= 0)
+        {
+            SetBusyPriority(preloader, GetEffectivePriority(preloader, dmTime::GetTime()));
+        }
+    }
 
-        uint64_t start           = dmTime::GetTime();
+    void SetPreloaderDeadline(HPreloader preloader, uint32_t time_limit)
+    {
+        preloader->m_DeadlineStart = dmTime::GetTime();
+        preloader->m_Deadline      = time_limit ? preloader->m_DeadlineStart + time_limit : 0;
+        if (preloader->m_BusyPriority >= 0)
+        {
+            SetBusyPriority(preloader, GetEffectivePriority(preloader, preloader->m_DeadlineStart));
+        }
+    }
+
+    static Result DoUpdatePreloader(HPreloader preloader, FPreloaderCompleteCallback complete_callback, PreloaderCompleteCallbackParams* complete_callback_params, uint32_t soft_time_limit, uint64_t start)
+    {
         uint32_t empty_runs      = 0;
         bool close_to_time_limit = soft_time_limit < 1000;
 
@@ -1021,6 +1149,39 @@ namespace dmResource
         return RESULT_PENDING;
     }
 
+    Result UpdatePreloader(HPreloader preloader, FPreloaderCompleteCallback complete_callback, PreloaderCompleteCallbackParams* complete_callback_params, uint32_t soft_time_limit)
+    {
+        DM_PROFILE("UpdatePreloader");
+        DM_MEMORY_TAG(dmMemory::TAG_RESOURCE);
+
+        uint64_t start = dmTime::GetTime();
+        if (preloader->m_BusyPriority >= 0)
+        {
+            PreloaderPriority priority = GetEffectivePriority(preloader, start);
+            SetBusyPriority(preloader, priority);
+
+            // Leave the load threads and the main thread time to the preloaders of higher priority
+            bool yield = HasBusyPreloaderAbove(preloader->m_Factory, priority);
+            if (priority == PRELOADER_PRIORITY_LOW && (yield || soft_time_limit < 1000))
+            {
+                // Only pick up the hints of the items already loaded, so the tree is ready once we resume
+                PopHints(preloader);
+                return RESULT_PENDING;
+            }
+            if (yield)
+            {
+                soft_time_limit /= 2;
+            }
+        }
+
+        Result result = DoUpdatePreloader(preloader, complete_callback, complete_callback_params, soft_time_limit, start);
+        if (result != RESULT_PENDING)
+        {
+            SetBusyPriority(preloader, -1);
+        }
+        return result;
+    }
+
     void DeletePreloader(HPreloader preloader)
     {
         // Since Preload calls need their Create calls done and PostCreate calls must always follow Create calls.
@@ -1030,7 +1191,9 @@ namespace dmResource
         // This is not a super-important use-case, the only way to trigger this is to start a load and
         // then do unload before it completes or if you destroy the collection while loading.
         // The normal operation is to issue a load and progress once complete.
-        while (UpdatePreloader(preloader, 0, 0, 1000000) == RESULT_PENDING)
+        // Don't yield to the other preloaders, since we're blocking until we're done
+        SetBusyPriority(preloader, -1);
+        while (DoUpdatePreloader(preloader, 0, 0, 1000000, dmTime::GetTime()) == RESULT_PENDING)
         {
             dmLogWarning("Waiting for preloader to complete.");
         }
@@ -1078,6 +1241,7 @@ namespace dmResource
         PendingHint& hint     = preloader->m_SyncedData.m_NewHints.Back();
         hint.m_PathDescriptor = path_descriptor;
         hint.m_Parent         = info->m_Parent;
+        info->m_HintCount++;
 
         return true;
     }
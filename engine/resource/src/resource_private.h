@@ -58,6 +58,8 @@ struct ResourceDescriptor
     HResourceType   m_ResourceType;
     uint32_t        m_ResourceSizeOnDisc;
     uint32_t        m_ReferenceCount;
+    // Time spent loading and creating the resource, in microseconds. See dmResource::RecordLoadTrace
+    uint32_t        m_LoadTime;
     uint16_t        m_Version;
 };
 
@@ -76,6 +78,13 @@ struct ResourceType
     FResourceDestroy    m_DestroyFunction;
     FResourceRecreate   m_RecreateFunction;
     uint8_t             m_Index;
+    // If the create function may be called from the load threads. See ResourceTypeSetCreateThreadSafe
+    uint8_t             m_CreateThreadSafe;
+    // If the resource data may be passed to the preload and create functions directly from a memory mapped archive. See ResourceTypeSetLoadInPlace
+    uint8_t             m_LoadInPlace;
+    // Max total size of the unreferenced resources of this type to keep in the cache. See ResourceTypeSetCacheBudget
+    uint32_t            m_CacheBudget;
+    uint32_t            m_CacheSize;
 };
 
 struct ResourceTypeContext
@@ -88,6 +97,8 @@ struct ResourcePreloadHintInfo
 {
     HResourcePreloader      m_Preloader;
     int32_t                 m_Parent;
+    // Number of hints added through this info. Only touched by the thread running the preload function
+    uint32_t                m_HintCount;
 };
 
 namespace dmResource
@@ -98,7 +109,19 @@ namespace dmResource
     // load with default internal buffer and its management, returns buffer ptr in 'buffer'
     Result LoadResource(HFactory factory, const char* path, const char* original_name, void** buffer, uint32_t* resource_size);
 
+    // Tracks the number of unfinished preloaders at each priority, so that the lower priority ones can yield to them
+    void AddBusyPreloader(HFactory factory, PreloaderPriority priority, int32_t count);
+    bool HasBusyPreloaderAbove(HFactory factory, PreloaderPriority priority);
+
+    // Finds a loaded resource and increases its reference count. Also brings back unreferenced resources from the cache
+    ResourceDescriptor* GetByHash(HFactory factory, dmhash_t canonical_path_hash);
+
     Result InsertResource(HFactory factory, const char* path, uint64_t canonical_path_hash, HResourceDescriptor descriptor);
+
+    // Adds the stage timings of a created resource to the load trace, and to the resource descriptor if it is still loaded
+    void RecordLoadTrace(HFactory factory, const LoadTraceEntry& entry);
+    // Adds a resource to the load order, unless it's already in it. The group is the root resource that is being loaded
+    void RecordLoadOrder(HFactory factory, const char* canonical_path, dmhash_t canonical_path_hash, const char* group_canonical_path);
     uint32_t GetCanonicalPathFromBase(const char* base_dir, const char* relative_dir, char* buf);
 
     HResourceType FindResourceType(HFactory factory, const char* extension);
@@ -114,6 +137,8 @@ namespace dmResource
     // Files mapped with this function should be unmapped with UnmapFile(...)
     Result MapFile(const char* filename, void*& map, uint32_t& size);
     Result UnmapFile(void*& map, uint32_t size);
+    // Hints that a range of memory mapped data is about to be read
+    void PrefetchMappedData(const void* data, uint32_t size);
 
     /**
      * In the case of an app-store upgrade, we dont want the runtime to load any existing local liveupdate.manifest.
@@ -81,6 +81,21 @@ void ResourceTypeSetRecreateFn(HResourceType type, FResourceRecreate fn)
     type->m_RecreateFunction = fn;
 }
 
+void ResourceTypeSetCreateThreadSafe(HResourceType type, bool thread_safe)
+{
+    type->m_CreateThreadSafe = thread_safe ? 1 : 0;
+}
+
+void ResourceTypeSetLoadInPlace(HResourceType type, bool in_place)
+{
+    type->m_LoadInPlace = in_place ? 1 : 0;
+}
+
+void ResourceTypeSetCacheBudget(HResourceType type, uint32_t budget)
+{
+    type->m_CacheBudget = budget;
+}
+
 
 TypeCreatorDesc* g_ResourceTypeCreatorDescFirst = 0;
 
@@ -18,6 +18,7 @@
 #include "resource_util.h"
 #include "resource_verify.h"
 
+#include <dlib/atomic.h>
 #include <dlib/dalloca.h>
 #include <dlib/memory.h>
 #include <dlib/endian.h>
@@ -26,31 +27,69 @@
 
 namespace dmResource
 {
-    // Should be private, but is used in unit tests as well
-    dmResource::Result VerifyResourcesBundled(dmLiveUpdateDDF::ResourceEntry* entries, uint32_t num_entries, uint32_t hash_len, dmResourceArchive::HArchiveIndexContainer archive)
+    struct VerifyBundledContext
+    {
+        dmLiveUpdateDDF::ResourceEntry*             m_Entries;
+        uint32_t                                    m_HashLen;
+        dmResourceArchive::HArchiveIndexContainer   m_Archive;
+        int32_atomic_t                              m_FirstMissing; // Index of the first missing entry, or -1
+    };
+
+    // Called from the job threads. The archive index is only read
+    static void VerifyResourcesBundledRange(void* _ctx, uint32_t begin, uint32_t end)
     {
-        for(uint32_t i = 0; i < num_entries; ++i)
+        VerifyBundledContext* ctx = (VerifyBundledContext*)_ctx;
+        for (uint32_t i = begin; i < end; ++i)
         {
-            if (entries[i].m_Flags == dmLiveUpdateDDF::BUNDLED)
+            if (ctx->m_Entries[i].m_Flags != dmLiveUpdateDDF::BUNDLED)
+                continue;
+
+            uint8_t* hash = ctx->m_Entries[i].m_Hash.m_Data.m_Data;
+            if (dmResourceArchive::FindEntry(ctx->m_Archive, hash, ctx->m_HashLen, 0x0) == dmResourceArchive::RESULT_NOT_FOUND)
             {
-                uint8_t* hash = entries[i].m_Hash.m_Data.m_Data;
-                dmResourceArchive::Result res = dmResourceArchive::FindEntry(archive, hash, hash_len, 0x0);
-                if (res == dmResourceArchive::RESULT_NOT_FOUND)
+                // Report the same entry as the serial loop would, regardless of the chunk order
+                int32_t first = dmAtomicGet32(&ctx->m_FirstMissing);
+                while ((first < 0 || (uint32_t)first > i) && dmAtomicCompareStore32(&ctx->m_FirstMissing, (int32_t)i, first) != first)
                 {
-                    char hash_buffer[64*2+1]; // String repr. of project id SHA1 hash
-                    dmResource::BytesToHexString(hash, hash_len, hash_buffer, sizeof(hash_buffer));
-
-                    // Manifest expect the resource to be bundled, but it is not in the archive index.
-                    dmLogError("Resource '%s' (%s) is expected to be in the bundle was not found.\nResource was modified between publishing the bundle and publishing the manifest?", entries[i].m_Url, hash_buffer);
-                    return dmResource::RESULT_INVALID_DATA;
+                    first = dmAtomicGet32(&ctx->m_FirstMissing);
                 }
+                return;
             }
         }
+    }
+
+    dmResource::Result VerifyResourcesBundled(dmLiveUpdateDDF::ResourceEntry* entries, uint32_t num_entries, uint32_t hash_len, dmResourceArchive::HArchiveIndexContainer archive, dmJobThread::HContext job_thread)
+    {
+        VerifyBundledContext ctx;
+        ctx.m_Entries = entries;
+        ctx.m_HashLen = hash_len;
+        ctx.m_Archive = archive;
+        ctx.m_FirstMissing = -1;
+
+        const uint32_t grain = 256; // The lookups are cheap, so don't split the work too much
+        dmJobThread::ParallelFor(job_thread, num_entries, grain, VerifyResourcesBundledRange, &ctx);
+
+        if (ctx.m_FirstMissing >= 0)
+        {
+            dmLiveUpdateDDF::ResourceEntry* entry = &entries[ctx.m_FirstMissing];
+            char hash_buffer[64*2+1]; // String repr. of project id SHA1 hash
+            dmResource::BytesToHexString(entry->m_Hash.m_Data.m_Data, hash_len, hash_buffer, sizeof(hash_buffer));
+
+            // Manifest expect the resource to be bundled, but it is not in the archive index.
+            dmLogError("Resource '%s' (%s) is expected to be in the bundle was not found.\nResource was modified between publishing the bundle and publishing the manifest?", entry->m_Url, hash_buffer);
+            return dmResource::RESULT_INVALID_DATA;
+        }
 
         return dmResource::RESULT_OK;
     }
 
-    dmResource::Result VerifyResourcesBundled(dmResourceArchive::HArchiveIndexContainer archive, const dmResource::HManifest manifest)
+    // Should be private, but is used in unit tests as well
+    dmResource::Result VerifyResourcesBundled(dmLiveUpdateDDF::ResourceEntry* entries, uint32_t num_entries, uint32_t hash_len, dmResourceArchive::HArchiveIndexContainer archive)
+    {
+        return VerifyResourcesBundled(entries, num_entries, hash_len, archive, 0);
+    }
+
+    dmResource::Result VerifyResourcesBundled(dmResourceArchive::HArchiveIndexContainer archive, const dmResource::HManifest manifest, dmJobThread::HContext job_thread)
     {
         uint32_t entry_count = manifest->m_DDFData->m_Resources.m_Count;
         dmLiveUpdateDDF::ResourceEntry* entries = manifest->m_DDFData->m_Resources.m_Data;
@@ -58,7 +97,12 @@ namespace dmResource
         dmLiveUpdateDDF::HashAlgorithm algorithm = manifest->m_DDFData->m_Header.m_ResourceHashAlgorithm;
         uint32_t hash_len = dmResource::HashLength(algorithm);
 
-        return VerifyResourcesBundled(entries, entry_count, hash_len, archive);
+        return VerifyResourcesBundled(entries, entry_count, hash_len, archive, job_thread);
+    }
+
+    dmResource::Result VerifyResourcesBundled(dmResourceArchive::HArchiveIndexContainer archive, const dmResource::HManifest manifest)
+    {
+        return VerifyResourcesBundled(archive, manifest, 0);
     }
 
     Result VerifyResource(const dmResource::HManifest manifest, const uint8_t* expected, uint32_t expected_length, const uint8_t* data, uint32_t data_length)
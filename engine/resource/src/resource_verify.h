@@ -16,6 +16,7 @@
 #define DM_RESOURCE_VERIFY_H
 
 #include <stdint.h>
+#include <dlib/job_thread.h>
 
 #include "resource.h" // Result
 #include "resource_archive.h"
@@ -33,8 +34,12 @@ namespace dmResource
 
     Result VerifyResourcesBundled(dmResourceArchive::HArchiveIndexContainer base_archive, const Manifest* manifest);
 
+    // The entries are looked up in parallel on the job threads, if a job thread context is given
+    Result VerifyResourcesBundled(dmResourceArchive::HArchiveIndexContainer base_archive, const Manifest* manifest, dmJobThread::HContext job_thread);
+
     // Should be private, but is used in unit tests as well
     Result VerifyResourcesBundled(dmLiveUpdateDDF::ResourceEntry* entries, uint32_t num_entries, uint32_t hash_len, dmResourceArchive::HArchiveIndexContainer archive_index);
+    Result VerifyResourcesBundled(dmLiveUpdateDDF::ResourceEntry* entries, uint32_t num_entries, uint32_t hash_len, dmResourceArchive::HArchiveIndexContainer archive_index, dmJobThread::HContext job_thread);
 
 
     // Unit tests ->
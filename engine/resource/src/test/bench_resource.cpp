@@ -0,0 +1,114 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <dlib/benchmark.h>
+#include <dlib/log.h>
+
+#include "../resource.h"
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+// The .foo files are compiled by the test_resource target
+static const char* BENCH_MOUNT = "build/src/test";
+static const char* BENCH_RESOURCES[] = { "/test01.foo", "/test02.foo" };
+
+// Keeps a copy of the file data, so that loading measures the factory and the file provider, not a parser
+static dmResource::Result BenchResourceCreate(const dmResource::ResourceCreateParams* params)
+{
+    void* copy = malloc(params->m_BufferSize);
+    memcpy(copy, params->m_Buffer, params->m_BufferSize);
+    ResourceDescriptorSetResource(params->m_Resource, copy);
+    return dmResource::RESULT_OK;
+}
+
+static dmResource::Result BenchResourceDestroy(const dmResource::ResourceDestroyParams* params)
+{
+    free(ResourceDescriptorGetResource(params->m_Resource));
+    return dmResource::RESULT_OK;
+}
+
+class ResourceBench : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        dmResource::NewFactoryParams params;
+        params.m_MaxResources = 16;
+        m_Factory = dmResource::NewFactory(&params, BENCH_MOUNT);
+        ASSERT_NE((void*) 0, m_Factory);
+        ASSERT_EQ(dmResource::RESULT_OK, dmResource::RegisterType(m_Factory, "foo", this, 0, &BenchResourceCreate, 0, &BenchResourceDestroy, 0));
+    }
+
+    virtual void TearDown()
+    {
+        dmResource::DeleteFactory(m_Factory);
+    }
+
+    dmResource::HFactory m_Factory;
+};
+
+TEST_F(ResourceBench, LoadRelease)
+{
+    const uint32_t count = 256;
+    for (dmBenchmark::Run run("resource.load_release", 20, count); run.Next(); )
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            void* resource = 0;
+            ASSERT_EQ(dmResource::RESULT_OK, dmResource::Get(m_Factory, BENCH_RESOURCES[i & 1], &resource));
+            dmResource::Release(m_Factory, resource);
+        }
+    }
+}
+
+TEST_F(ResourceBench, GetCached)
+{
+    void* held[DM_ARRAY_SIZE(BENCH_RESOURCES)];
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(BENCH_RESOURCES); ++i)
+        ASSERT_EQ(dmResource::RESULT_OK, dmResource::Get(m_Factory, BENCH_RESOURCES[i], &held[i]));
+
+    const uint32_t count = 16384;
+    for (dmBenchmark::Run run("resource.get_cached", 20, count); run.Next(); )
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            void* resource = 0;
+            dmResource::Get(m_Factory, BENCH_RESOURCES[i & 1], &resource);
+            dmResource::Release(m_Factory, resource);
+        }
+    }
+
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(BENCH_RESOURCES); ++i)
+        dmResource::Release(m_Factory, held[i]);
+}
+
+extern "C" void dmExportedSymbols();
+
+int main(int argc, char **argv)
+{
+    dmExportedSymbols();
+    dmLog::LogParams params;
+    dmLog::LogInitialize(&params);
+
+    jc_test_init(&argc, argv);
+    int ret = jc_test_run_all();
+
+    if (ret == 0)
+        ret = dmBenchmark::Report(argc, argv, "resource");
+    return ret;
+}
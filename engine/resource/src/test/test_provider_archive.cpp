@@ -299,6 +299,53 @@ TEST_P(ArchiveProviderArchiveInMemory, ReadFile)
         dmMemory::AlignedFree((void*)expected_file);
     }
 }
+TEST_P(ArchiveProviderArchiveInMemory, GetFileData)
+{
+    const InMemoryParams& params = GetParam();
+
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(FILE_PATHS); ++i)
+    {
+        const char* path = FILE_PATHS[i];
+        dmhash_t path_hash = dmHashString64(path);
+
+        const uint8_t* data = 0;
+        uint32_t data_size = 0;
+        dmResourceProvider::Result result = dmResourceProvider::GetFileData(m_Archive, path_hash, path, &data, &data_size);
+        if (result == dmResourceProvider::RESULT_NOT_SUPPORTED)
+            continue; // compressed or encrypted
+        ASSERT_EQ(dmResourceProvider::RESULT_OK, result);
+
+        // The data points into the archive data
+        ASSERT_GE(data, params.m_ArcdData);
+        ASSERT_LE(data + data_size, params.m_ArcdData + params.m_ArcdDataSize);
+
+        uint8_t* buffer = new uint8_t[data_size];
+        result = dmResourceProvider::ReadFile(m_Archive, path_hash, path, buffer, data_size);
+        ASSERT_EQ(dmResourceProvider::RESULT_OK, result);
+        ASSERT_ARRAY_EQ_LEN(buffer, data, data_size);
+        delete[] buffer;
+    }
+
+    const uint8_t* data = 0;
+    uint32_t data_size = 0;
+    const char* path = "/archive_data/file1.adc";
+    dmResourceProvider::Result result = dmResourceProvider::GetFileData(m_Archive, dmHashString64(path), path, &data, &data_size);
+    if (params.m_ArcdData == RESOURCES_ARCD)
+    {
+        ASSERT_EQ(dmResourceProvider::RESULT_OK, result);
+        ASSERT_EQ(30U, data_size);
+    }
+
+    // Encrypted entries must be read into a buffer
+    path = "/archive_data/file5.scriptc";
+    result = dmResourceProvider::GetFileData(m_Archive, dmHashString64(path), path, &data, &data_size);
+    ASSERT_EQ(dmResourceProvider::RESULT_NOT_SUPPORTED, result);
+
+    path = "src/test/files/not_exist";
+    result = dmResourceProvider::GetFileData(m_Archive, dmHashString64(path), path, &data, &data_size);
+    ASSERT_EQ(dmResourceProvider::RESULT_NOT_FOUND, result);
+}
+
 InMemoryParams params_in_memory_archives[] = {
     {RESOURCES_DMANIFEST, RESOURCES_DMANIFEST_SIZE, RESOURCES_ARCI, RESOURCES_ARCI_SIZE, RESOURCES_ARCD, RESOURCES_ARCD_SIZE},
     {RESOURCES_COMPRESSED_DMANIFEST, RESOURCES_COMPRESSED_DMANIFEST_SIZE, RESOURCES_COMPRESSED_ARCI, RESOURCES_COMPRESSED_ARCI_SIZE, RESOURCES_COMPRESSED_ARCD, RESOURCES_COMPRESSED_ARCD_SIZE},
@@ -15,7 +15,9 @@
 #include <stdio.h>
 #include <stdint.h>
 
+#include <dlib/dstrings.h>
 #include <dlib/log.h>
+#include <dlib/memory.h>
 #include <dlib/testutil.h>
 #include <dlib/socket.h>
 #include <dlib/uri.h>
@@ -135,6 +137,74 @@ TEST_F(HttpProviderArchive, ReadFile)
     ASSERT_ARRAY_EQ_LEN(SOMEDATA, long_buffer, sizeof(SOMEDATA));
 }
 
+class HttpProviderArchiveRange : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        m_Loader = dmResourceProvider::FindLoaderByName(dmHashString64("http"));
+        ASSERT_NE((ArchiveLoader*)0, m_Loader);
+
+        // build/src/test/resources.dmanifest, .arci and .arcd
+        dmURI::Parts uri;
+        dmURI::Parse("http://localhost:6123/resources.dmanifest", &uri);
+
+        dmResourceProvider::Result result = dmResourceProvider::CreateMount(m_Loader, &uri, 0, &m_Archive);
+        ASSERT_EQ(dmResourceProvider::RESULT_OK, result);
+    }
+
+    virtual void TearDown()
+    {
+        dmResourceProvider::Result result = dmResourceProvider::Unmount(m_Archive);
+        ASSERT_EQ(dmResourceProvider::RESULT_OK, result);
+    }
+
+    dmResourceProvider::HArchive       m_Archive;
+    dmResourceProvider::ArchiveLoader* m_Loader;
+};
+
+TEST_F(HttpProviderArchiveRange, ReadFile)
+{
+    const char* paths[] = {
+        "/archive_data/file1.adc",
+        "/archive_data/file2.adc",
+        "/archive_data/file3.adc",
+        "/archive_data/file4.adc",
+        "/archive_data/file5.scriptc",
+    };
+
+    dmResource::HManifest manifest = 0;
+    ASSERT_EQ(dmResourceProvider::RESULT_OK, dmResourceProvider::GetManifest(m_Archive, &manifest));
+    ASSERT_NE((dmResource::HManifest)0, manifest);
+
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(paths); ++i)
+    {
+        const char* path = paths[i];
+        dmhash_t path_hash = dmHashString64(path);
+
+        char host_path[256];
+        dmSnPrintf(host_path, sizeof(host_path), "build/src/test%s", path);
+        uint32_t expected_size;
+        const uint8_t* expected = dmTestUtil::ReadHostFile(host_path, &expected_size);
+        ASSERT_NE((uint8_t*)0, expected);
+
+        uint32_t file_size;
+        ASSERT_EQ(dmResourceProvider::RESULT_OK, dmResourceProvider::GetFileSize(m_Archive, path_hash, path, &file_size));
+        ASSERT_EQ(expected_size, file_size);
+
+        uint8_t* buffer = new uint8_t[file_size];
+        ASSERT_EQ(dmResourceProvider::RESULT_OK, dmResourceProvider::ReadFile(m_Archive, path_hash, path, buffer, file_size));
+        ASSERT_ARRAY_EQ_LEN(expected, buffer, file_size);
+
+        delete[] buffer;
+        dmMemory::AlignedFree((void*)expected);
+    }
+
+    uint32_t file_size;
+    const char* path = "/archive_data/not_exist";
+    ASSERT_EQ(dmResourceProvider::RESULT_NOT_FOUND, dmResourceProvider::GetFileSize(m_Archive, dmHashString64(path), path, &file_size));
+}
+
 #if defined(DM_TEST_HTTP_SUPPORTED)
 
 extern "C" void dmExportedSymbols();
@@ -15,6 +15,7 @@
 #include <stdint.h>
 
 #include <dlib/array.h>
+#include <dlib/atomic.h>
 #include <dlib/crypt.h>
 #include <dlib/dstrings.h>
 #include <dlib/endian.h>
@@ -22,6 +23,7 @@
 #include <dlib/memory.h>
 #include <dlib/sys.h>
 #include <dlib/testutil.h>
+#include <dlib/thread.h>
 #include <dlib/uri.h>
 
 #include "../providers/provider.h"
@@ -258,6 +260,54 @@ TEST_P(ArchiveProviderZip, ReadFile)
     }
 }
 
+struct ConcurrentReadContext
+{
+    dmResourceProvider::HArchive m_Archive;
+    const uint8_t*               m_ExpectedFiles[DM_ARRAY_SIZE(FILE_PATHS)];
+    uint32_t                     m_ExpectedSizes[DM_ARRAY_SIZE(FILE_PATHS)];
+    int32_atomic_t               m_Errors;
+};
+
+static void ConcurrentReadThread(void* _ctx)
+{
+    ConcurrentReadContext* ctx = (ConcurrentReadContext*)_ctx;
+    for (uint32_t n = 0; n < 64; ++n)
+    {
+        uint32_t i = n % DM_ARRAY_SIZE(FILE_PATHS);
+        uint32_t file_size = ctx->m_ExpectedSizes[i];
+        uint8_t* buffer = new uint8_t[file_size];
+        dmResourceProvider::Result result = dmResourceProvider::ReadFile(ctx->m_Archive, dmHashString64(FILE_PATHS[i]), FILE_PATHS[i], buffer, file_size);
+        if (dmResourceProvider::RESULT_OK != result || memcmp(ctx->m_ExpectedFiles[i], buffer, file_size) != 0)
+            dmAtomicIncrement32(&ctx->m_Errors);
+        delete[] buffer;
+    }
+}
+
+TEST_P(ArchiveProviderZip, ConcurrentReads)
+{
+    ASSERT_TRUE(dmResourceProvider::CanReadConcurrently(m_Archive));
+
+    ConcurrentReadContext ctx;
+    ctx.m_Archive = m_Archive;
+    ctx.m_Errors = 0;
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(FILE_PATHS); ++i)
+    {
+        ctx.m_ExpectedFiles[i] = GetRawFile(FILE_PATHS[i], &ctx.m_ExpectedSizes[i], false);
+        ASSERT_NE((uint8_t*)0, ctx.m_ExpectedFiles[i]);
+    }
+
+    dmThread::Thread threads[4];
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(threads); ++i)
+        threads[i] = dmThread::New(&ConcurrentReadThread, 0x80000, &ctx, "zipread");
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(threads); ++i)
+        dmThread::Join(threads[i]);
+
+    ASSERT_EQ(0, dmAtomicGet32(&ctx.m_Errors));
+
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(FILE_PATHS); ++i)
+        dmMemory::AlignedFree((void*)ctx.m_ExpectedFiles[i]);
+}
+
 #define FSPREFIX ""
 #if defined(__EMSCRIPTEN__)
     #undef FSPREFIX
@@ -17,6 +17,7 @@
 #include <dlib/atomic.h>
 #include <dlib/dstrings.h>
 #include <dlib/hash.h>
+#include <dlib/job_thread.h>
 #include <dlib/log.h>
 #include <dlib/message.h>
 #include <dlib/socket.h>
@@ -226,10 +227,15 @@ protected:
         m_FooResourceCreateCallCount = 0;
         m_FooResourcePostCreateCallCount = 0;
         m_FooResourceDestroyCallCount = 0;
+        m_FooResourceCreateThread = 0;
 
         dmResource::NewFactoryParams params;
         params.m_MaxResources = 16;
+        NewFactory(&params);
+    }
 
+    void NewFactory(dmResource::NewFactoryParams* params)
+    {
         const char* original_mount_path = GetParam();
 #if defined(DM_TEST_HTTP_SUPPORTED)
         char mountpath[512];
@@ -240,7 +246,7 @@ protected:
         }
 #endif
 
-        m_Factory = dmResource::NewFactory(&params, original_mount_path);
+        m_Factory = dmResource::NewFactory(params, original_mount_path);
 
         ASSERT_NE((void*) 0, m_Factory);
         m_ResourceName = "/test.cont";
@@ -294,6 +300,7 @@ public:
     uint32_t           m_FooResourceCreateCallCount;
     uint32_t           m_FooResourcePostCreateCallCount;
     uint32_t           m_FooResourceDestroyCallCount;
+    dmThread::Thread   m_FooResourceCreateThread;
 
     dmResource::HFactory m_Factory;
     const char*        m_ResourceName;
@@ -383,6 +390,7 @@ dmResource::Result FooResourceCreate(const dmResource::ResourceCreateParams* par
     HResourceType type = params->m_Type;
     GetResourceTest* self = (GetResourceTest*) ResourceTypeGetContext(type);
     self->m_FooResourceCreateCallCount++;
+    self->m_FooResourceCreateThread = dmThread::GetCurrentThread();
 
     TestResource::ResourceFoo* resource_foo;
 
@@ -462,6 +470,102 @@ TEST_P(GetResourceTest, GetRaw)
     ASSERT_EQ(dmResource::RESULT_RESOURCE_NOT_FOUND, e);
 }
 
+struct LoadTraceContext
+{
+    uint32_t m_ContainerCount;
+    uint32_t m_FooCount;
+};
+
+static bool LoadTraceCallback(const dmResource::LoadTraceEntry& entry, void* user_ctx)
+{
+    LoadTraceContext* ctx = (LoadTraceContext*)user_ctx;
+    if (strcmp(entry.m_Extension, "cont") == 0)
+        ctx->m_ContainerCount++;
+    else if (strcmp(entry.m_Extension, "foo") == 0)
+        ctx->m_FooCount++;
+    return true;
+}
+
+static bool LoadTraceResourceCallback(const dmResource::IteratorResource& resource, void* user_ctx)
+{
+    uint32_t* count = (uint32_t*)user_ctx;
+    if (resource.m_Extension && strcmp(resource.m_Extension, "foo") == 0)
+        (*count)++;
+    return true;
+}
+
+TEST_P(GetResourceTest, LoadTrace)
+{
+    TestResourceContainer* test_resource_cont = 0;
+    dmResource::Result e = dmResource::Get(m_Factory, m_ResourceName, (void**) &test_resource_cont);
+    ASSERT_EQ(dmResource::RESULT_OK, e);
+
+    LoadTraceContext ctx = {0, 0};
+    dmResource::IterateLoadTrace(m_Factory, LoadTraceCallback, &ctx);
+    ASSERT_EQ(1u, ctx.m_ContainerCount);
+    ASSERT_EQ(m_FooResourceCreateCallCount, ctx.m_FooCount);
+
+    uint32_t foo_count = 0;
+    dmResource::IterateResources(m_Factory, LoadTraceResourceCallback, &foo_count);
+    ASSERT_EQ(m_FooResourceCreateCallCount, foo_count);
+
+    dmResource::Release(m_Factory, test_resource_cont);
+}
+
+struct LoadOrderContext
+{
+    uint32_t m_Count;
+    bool     m_GroupsMatch;
+    char     m_First[64];
+};
+
+static bool LoadOrderCallback(const dmResource::LoadOrderEntry& entry, void* user_ctx)
+{
+    LoadOrderContext* ctx = (LoadOrderContext*)user_ctx;
+    if (ctx->m_Count++ == 0)
+        dmStrlCpy(ctx->m_First, entry.m_Path, sizeof(ctx->m_First));
+    ctx->m_GroupsMatch = ctx->m_GroupsMatch && strcmp(entry.m_Group, "/test.cont") == 0;
+    return true;
+}
+
+TEST_P(GetResourceTest, LoadOrder)
+{
+    // Not recorded by default
+    TestResourceContainer* test_resource_cont = 0;
+    dmResource::Result e = dmResource::Get(m_Factory, m_ResourceName, (void**) &test_resource_cont);
+    ASSERT_EQ(dmResource::RESULT_OK, e);
+    LoadOrderContext ctx = {0, true, {0}};
+    dmResource::IterateLoadOrder(m_Factory, LoadOrderCallback, &ctx);
+    ASSERT_EQ(0u, ctx.m_Count);
+    dmResource::Release(m_Factory, test_resource_cont);
+
+    dmResource::DeleteFactory(m_Factory);
+    m_FooResourceCreateCallCount = 0;
+    dmResource::NewFactoryParams params;
+    params.m_MaxResources = 16;
+    params.m_Flags = RESOURCE_FACTORY_FLAGS_LOAD_ORDER;
+    NewFactory(&params);
+
+    e = dmResource::Get(m_Factory, m_ResourceName, (void**) &test_resource_cont);
+    ASSERT_EQ(dmResource::RESULT_OK, e);
+    dmResource::Release(m_Factory, test_resource_cont);
+
+    // The container is loaded before the resources it refers to, and they are all loaded for the container
+    dmResource::IterateLoadOrder(m_Factory, LoadOrderCallback, &ctx);
+    ASSERT_EQ(1 + m_FooResourceCreateCallCount, ctx.m_Count);
+    ASSERT_STREQ("/test.cont", ctx.m_First);
+    ASSERT_TRUE(ctx.m_GroupsMatch);
+
+    // Loading it again doesn't add the resources twice
+    e = PreloaderGet(m_Factory, m_ResourceName, (void**) &test_resource_cont);
+    ASSERT_EQ(dmResource::RESULT_OK, e);
+    dmResource::Release(m_Factory, test_resource_cont);
+
+    LoadOrderContext ctx2 = {0, true, {0}};
+    dmResource::IterateLoadOrder(m_Factory, LoadOrderCallback, &ctx2);
+    ASSERT_EQ(ctx.m_Count, ctx2.m_Count);
+}
+
 TEST_P(GetResourceTest, IncRef)
 {
     dmResource::Result e;
@@ -850,6 +954,178 @@ TEST_P(GetResourceTest, PreloadGetParallell)
     }
 }
 
+TEST_P(GetResourceTest, PreloadGetLoadThreads)
+{
+    // More load threads than there are resources to load, as well as a single one
+    const uint32_t thread_counts[] = { 1, 8 };
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(thread_counts); ++i)
+    {
+        dmResource::DeleteFactory(m_Factory);
+        m_ResourceContainerCreateCallCount = 0;
+        m_FooResourceCreateCallCount = 0;
+
+        dmResource::NewFactoryParams params;
+        params.m_MaxResources = 16;
+        params.m_LoadThreadCount = thread_counts[i];
+        NewFactory(&params);
+        ASSERT_EQ(thread_counts[i], dmResource::GetLoadThreadCount(m_Factory));
+
+        TestResourceContainer* resource = 0;
+        dmResource::Result e = PreloaderGet(m_Factory, m_ResourceName, (void**) &resource);
+        ASSERT_EQ(dmResource::RESULT_OK, e);
+        ASSERT_EQ((uint32_t) 1, m_ResourceContainerCreateCallCount);
+        ASSERT_EQ(resource->m_Resources.size(), m_FooResourceCreateCallCount);
+        ASSERT_EQ((uint32_t) 123, resource->m_Resources[0]->m_X);
+        ASSERT_EQ((uint32_t) 456, resource->m_Resources[1]->m_X);
+
+        dmResource::Release(m_Factory, resource);
+    }
+}
+
+TEST_P(GetResourceTest, PreloadCreateOnLoadThread)
+{
+    // A single load thread, so that the create calls don't race on the call count
+    dmResource::DeleteFactory(m_Factory);
+    dmResource::NewFactoryParams params;
+    params.m_MaxResources = 16;
+    params.m_LoadThreadCount = 1;
+    NewFactory(&params);
+
+    HResourceType type;
+    ASSERT_EQ(dmResource::RESULT_OK, dmResource::GetTypeFromExtension(m_Factory, "foo", &type));
+    ResourceTypeSetCreateThreadSafe(type, true);
+
+    TestResourceContainer* resource = 0;
+    dmResource::Result e = PreloaderGet(m_Factory, m_ResourceName, (void**) &resource);
+    ASSERT_EQ(dmResource::RESULT_OK, e);
+    ASSERT_EQ(resource->m_Resources.size(), m_FooResourceCreateCallCount);
+    ASSERT_EQ(m_FooResourceCreateCallCount, m_FooResourcePostCreateCallCount);
+    ASSERT_EQ((uint32_t) 123, resource->m_Resources[0]->m_X);
+    ASSERT_EQ((uint32_t) 456, resource->m_Resources[1]->m_X);
+#if !defined(__EMSCRIPTEN__)
+    // The foo resources have no children, so they were created on the load thread
+    ASSERT_NE(dmThread::GetCurrentThread(), m_FooResourceCreateThread);
+#endif
+
+    dmResource::Release(m_Factory, resource);
+    ASSERT_EQ(m_FooResourceCreateCallCount, m_FooResourceDestroyCallCount);
+}
+
+TEST_P(GetResourceTest, PreloadPriority)
+{
+    dmResource::HPreloader background = dmResource::NewPreloader(m_Factory, m_ResourceName);
+    dmResource::SetPreloaderPriority(background, dmResource::PRELOADER_PRIORITY_LOW);
+    dmResource::HPreloader foreground = dmResource::NewPreloader(m_Factory, "/test01.foo");
+
+    // The background preloader waits for the foreground one
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+        ASSERT_EQ(dmResource::RESULT_PENDING, dmResource::UpdatePreloader(background, 0, 0, 30*1000));
+    }
+    ASSERT_EQ(0U, m_ResourceContainerCreateCallCount);
+    ASSERT_EQ(0U, m_FooResourceCreateCallCount);
+
+    dmResource::Result r;
+    for (uint32_t i = 0; i < 33; ++i)
+    {
+        r = dmResource::UpdatePreloader(foreground, 0, 0, 30*1000);
+        if (r != dmResource::RESULT_PENDING)
+            break;
+        dmTime::Sleep(30000);
+    }
+    ASSERT_EQ(dmResource::RESULT_OK, r);
+    ASSERT_EQ(0U, m_ResourceContainerCreateCallCount);
+    ASSERT_EQ(1U, m_FooResourceCreateCallCount);
+
+    // A tight frame budget also holds it back
+    ASSERT_EQ(dmResource::RESULT_PENDING, dmResource::UpdatePreloader(background, 0, 0, 500));
+    ASSERT_EQ(0U, m_ResourceContainerCreateCallCount);
+
+    for (uint32_t i = 0; i < 33; ++i)
+    {
+        r = dmResource::UpdatePreloader(background, 0, 0, 30*1000);
+        if (r != dmResource::RESULT_PENDING)
+            break;
+        dmTime::Sleep(30000);
+    }
+    ASSERT_EQ(dmResource::RESULT_OK, r);
+    ASSERT_EQ(1U, m_ResourceContainerCreateCallCount);
+    ASSERT_EQ(2U, m_FooResourceCreateCallCount);
+
+    dmResource::DeletePreloader(foreground);
+    dmResource::DeletePreloader(background);
+}
+
+TEST_P(GetResourceTest, PreloadDeadline)
+{
+    dmResource::HPreloader background = dmResource::NewPreloader(m_Factory, m_ResourceName);
+    dmResource::SetPreloaderPriority(background, dmResource::PRELOADER_PRIORITY_LOW);
+    dmResource::HPreloader foreground = dmResource::NewPreloader(m_Factory, "/test01.foo");
+
+    // Past half of the time to the deadline, it no longer yields
+    dmResource::SetPreloaderDeadline(background, 1);
+    dmTime::Sleep(1000);
+
+    dmResource::Result r;
+    for (uint32_t i = 0; i < 33; ++i)
+    {
+        r = dmResource::UpdatePreloader(background, 0, 0, 30*1000);
+        if (r != dmResource::RESULT_PENDING)
+            break;
+        dmTime::Sleep(30000);
+    }
+    ASSERT_EQ(dmResource::RESULT_OK, r);
+    ASSERT_EQ(1U, m_ResourceContainerCreateCallCount);
+
+    dmResource::DeletePreloader(foreground);
+    dmResource::DeletePreloader(background);
+}
+
+TEST_P(GetResourceTest, CacheBudget)
+{
+    // Room for one of the foo resources (2 bytes each on disc)
+    HResourceType type;
+    ASSERT_EQ(dmResource::RESULT_OK, dmResource::GetTypeFromExtension(m_Factory, "foo", &type));
+    ResourceTypeSetCacheBudget(type, 2);
+
+    TestResourceContainer* resource = 0;
+    dmResource::Result e = dmResource::Get(m_Factory, m_ResourceName, (void**) &resource);
+    ASSERT_EQ(dmResource::RESULT_OK, e);
+    ASSERT_EQ(2U, m_FooResourceCreateCallCount);
+
+    // The container is destroyed, and /test02.foo (the last released) is kept in the cache
+    dmResource::Release(m_Factory, resource);
+    ASSERT_EQ(1U, m_ResourceContainerDestroyCallCount);
+    ASSERT_EQ(1U, m_FooResourceDestroyCallCount);
+
+    HResourceDescriptor descriptor;
+    ASSERT_EQ(dmResource::RESULT_NOT_LOADED, dmResource::GetDescriptor(m_Factory, "/test01.foo", &descriptor));
+    ASSERT_EQ(dmResource::RESULT_NOT_LOADED, dmResource::GetDescriptor(m_Factory, "/test02.foo", &descriptor));
+    ASSERT_EQ((ResourceDescriptor*) 0, dmResource::FindByHash(m_Factory, dmHashString64("/test02.foo")));
+
+    // Only /test01.foo is created again
+    e = dmResource::Get(m_Factory, m_ResourceName, (void**) &resource);
+    ASSERT_EQ(dmResource::RESULT_OK, e);
+    ASSERT_EQ(3U, m_FooResourceCreateCallCount);
+    ASSERT_EQ((uint32_t) 123, resource->m_Resources[0]->m_X);
+    ASSERT_EQ((uint32_t) 456, resource->m_Resources[1]->m_X);
+    ASSERT_EQ(dmResource::RESULT_OK, dmResource::GetDescriptor(m_Factory, "/test02.foo", &descriptor));
+    ASSERT_EQ(1U, descriptor->m_ReferenceCount);
+
+    dmResource::Release(m_Factory, resource);
+    ASSERT_EQ(2U, m_FooResourceDestroyCallCount);
+
+    dmResource::ReleaseCachedResources(m_Factory);
+    ASSERT_EQ(3U, m_FooResourceDestroyCallCount);
+
+    // Nothing is kept when the cache is disabled
+    dmResource::SetCacheEnabled(m_Factory, false);
+    e = dmResource::Get(m_Factory, m_ResourceName, (void**) &resource);
+    ASSERT_EQ(dmResource::RESULT_OK, e);
+    dmResource::Release(m_Factory, resource);
+    ASSERT_EQ(m_FooResourceCreateCallCount, m_FooResourceDestroyCallCount);
+}
+
 TEST_P(GetResourceTest, PreloadGetManyRefs)
 {
     // this has more references than the preloader can fit into its tree
@@ -1074,6 +1350,70 @@ TEST(RecreateTest, RecreateTest)
     dmResource::DeleteFactory(factory);
 }
 
+static void CountReloadsCallback(const ResourceReloadedParams* params) {
+    int* count = (int*)params->m_UserData;
+    (*count)++;
+}
+
+TEST(RecreateTest, ReloadResources)
+{
+    dmResource::NewFactoryParams params;
+    params.m_MaxResources = 16;
+    params.m_Flags = RESOURCE_FACTORY_FLAGS_RELOAD_SUPPORT;
+    dmResource::HFactory factory = dmResource::NewFactory(&params, MOUNT_DIR);
+    ASSERT_NE((void*) 0, factory);
+
+    int reload_count = 0;
+    dmResource::RegisterResourceReloadedCallback(factory, CountReloadsCallback, &reload_count);
+
+    dmResource::Result e = dmResource::RegisterType(factory, "foo", 0, 0, &RecreateResourceCreate, 0, &RecreateResourceDestroy, &RecreateResourceRecreate);
+    ASSERT_EQ(dmResource::RESULT_OK, e);
+
+    const char* resource_names[] = { "/__testrecreate_a__.foo", "/__testrecreate_b__.foo" };
+    int* resources[2];
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(resource_names); ++i)
+    {
+        char host_name[512];
+        const char* path = dmTestUtil::MakeHostPathf(host_name, sizeof(host_name), "%s/%s", TMP_DIR, resource_names[i]);
+        FILE* f = fopen(path, "wb");
+        ASSERT_NE((FILE*) 0, f);
+        fprintf(f, "%d", 10 + i);
+        fclose(f);
+
+        dmResource::Result fr = dmResource::Get(factory, resource_names[i], (void**) &resources[i]);
+        ASSERT_EQ(dmResource::RESULT_OK, fr);
+        ASSERT_EQ(10 + (int)i, *resources[i]);
+
+        f = fopen(path, "wb");
+        ASSERT_NE((FILE*) 0, f);
+        fprintf(f, "%d", 20 + i);
+        fclose(f);
+    }
+
+    // Duplicates are only reloaded once
+    const char* batch[] = { resource_names[0], resource_names[1], resource_names[0], "__testrecreate_b__.foo" };
+    dmResource::Result rr = dmResource::ReloadResources(factory, batch, DM_ARRAY_SIZE(batch));
+    ASSERT_EQ(dmResource::RESULT_OK, rr);
+    ASSERT_EQ(2, reload_count);
+    ASSERT_EQ(20, *resources[0]);
+    ASSERT_EQ(21, *resources[1]);
+
+    // Unknown resources are reported, but don't stop the rest of the batch
+    const char* batch_missing[] = { "/__testrecreate_missing__.foo", resource_names[0] };
+    rr = dmResource::ReloadResources(factory, batch_missing, DM_ARRAY_SIZE(batch_missing));
+    ASSERT_EQ(dmResource::RESULT_RESOURCE_NOT_FOUND, rr);
+    ASSERT_EQ(3, reload_count);
+
+    dmResource::UnregisterResourceReloadedCallback(factory, CountReloadsCallback, &reload_count);
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(resource_names); ++i)
+    {
+        char host_name[512];
+        dmSys::Unlink(dmTestUtil::MakeHostPathf(host_name, sizeof(host_name), "%s/%s", TMP_DIR, resource_names[i]));
+        dmResource::Release(factory, resources[i]);
+    }
+    dmResource::DeleteFactory(factory);
+}
+
 struct ReloadedContext
 {
     void*           m_Resource;
@@ -1547,6 +1887,57 @@ TEST_F(ResourceTest, ManifestBundledResourcesVerificationFail)
     dmResource::DeleteManifest(manifest);
 }
 
+TEST_F(ResourceTest, ManifestBundledResourcesVerificationParallel)
+{
+    dmResource::Manifest* manifest;
+    dmResource::Result result = dmResource::LoadManifestFromBuffer(RESOURCES_DMANIFEST, RESOURCES_DMANIFEST_SIZE, &manifest);
+    ASSERT_EQ(dmResource::RESULT_OK, result);
+
+    dmResourceArchive::ArchiveIndexContainer* archive = 0;
+    dmResourceArchive::Result r = dmResourceArchive::WrapArchiveBuffer(RESOURCES_ARCI, RESOURCES_ARCI_SIZE, true, RESOURCES_ARCD, RESOURCES_ARCD_SIZE, true, &archive);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, r);
+
+    dmJobThread::JobThreadCreationParams job_thread_create_param;
+    job_thread_create_param.m_ThreadNames[0] = "verify1";
+    job_thread_create_param.m_ThreadNames[1] = "verify2";
+    job_thread_create_param.m_ThreadCount = 2;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_create_param);
+
+    result = dmResource::VerifyResourcesBundled(archive, manifest, job_thread);
+    ASSERT_EQ(dmResource::RESULT_OK, result);
+
+    // Use enough entries to split the work, and make a few of them missing
+    uint32_t entry_count = manifest->m_DDFData->m_Resources.m_Count;
+    uint32_t hash_len = dmResource::HashLength(manifest->m_DDFData->m_Header.m_ResourceHashAlgorithm);
+    const uint32_t count = 4096;
+    uint8_t missing_hash[dmResourceArchive::MAX_HASH];
+    memset(missing_hash, 0xFF, sizeof(missing_hash));
+
+    dmLiveUpdateDDF::ResourceEntry* entries = (dmLiveUpdateDDF::ResourceEntry*) malloc(count * sizeof(dmLiveUpdateDDF::ResourceEntry));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        entries[i] = manifest->m_DDFData->m_Resources.m_Data[i % entry_count];
+    }
+
+    result = dmResource::VerifyResourcesBundled(entries, count, hash_len, archive, job_thread);
+    ASSERT_EQ(dmResource::RESULT_OK, result);
+
+    for (uint32_t i = count / 3; i < count; i += 500)
+    {
+        entries[i].m_Flags = dmLiveUpdateDDF::BUNDLED;
+        entries[i].m_Hash.m_Data.m_Data = missing_hash;
+        entries[i].m_Url = "not_in_bundle";
+    }
+
+    result = dmResource::VerifyResourcesBundled(entries, count, hash_len, archive, job_thread);
+    ASSERT_EQ(dmResource::RESULT_INVALID_DATA, result);
+
+    free(entries);
+    dmJobThread::Destroy(job_thread);
+    dmResourceArchive::Delete(archive);
+    dmResource::DeleteManifest(manifest);
+}
+
 TEST(ResourceUtil, HexDigestLength)
 {
     uint32_t actual = 0;
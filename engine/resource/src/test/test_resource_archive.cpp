@@ -22,6 +22,7 @@
 #include "../providers/provider_archive_private.h"
 #include <dlib/dstrings.h>
 #include <dlib/endian.h>
+#include <dlib/lz4.h>
 #include <dlib/sys.h>
 #include <dlib/testutil.h>
 #include <testmain/testmain.h>
@@ -678,6 +679,189 @@ TEST(dmResourceArchive, Wrap_Compressed)
     dmResourceArchive::Delete(archive);
 }
 
+TEST(dmResourceArchive, Wrap_CompressedDictionary)
+{
+    const char* dictionary = "go.property(\"speed\", 100)\nfunction init(self)\nend\nfunction update(self, dt)\nend\n";
+    const char* data = "go.property(\"speed\", 200)\nfunction init(self)\n\tprint(self.speed)\nend\n";
+    uint32_t dictionary_size = (uint32_t)strlen(dictionary);
+    uint32_t data_size = (uint32_t)strlen(data) + 1;
+
+    // The data file holds the dictionary followed by the compressed entry
+    uint8_t arcd[512];
+    memcpy(arcd, dictionary, dictionary_size);
+    int compressed_size;
+    ASSERT_EQ(dmLZ4::RESULT_OK, dmLZ4::CompressBufferWithDictionary(data, data_size, dictionary, dictionary_size, arcd + dictionary_size, &compressed_size));
+
+    // The index holds the header, hashes, entries and the dictionary table
+    const uint32_t hash_offset = sizeof(dmResourceArchive::ArchiveIndex);
+    const uint32_t entry_offset = hash_offset + dmResourceArchive::MAX_HASH;
+    const uint32_t dictionary_offset = entry_offset + sizeof(dmResourceArchive::EntryData);
+    const uint32_t arci_size = dictionary_offset + sizeof(uint32_t) + sizeof(dmResourceArchive::DictionaryData);
+    uint8_t* arci = new uint8_t[arci_size];
+    memset(arci, 0, arci_size);
+
+    dmResourceArchive::ArchiveIndex* ai = (dmResourceArchive::ArchiveIndex*)arci;
+    ai->m_Version = dmEndian::ToHost(dmResourceArchive::VERSION);
+    ai->m_EntryDataCount = dmEndian::ToHost(1U);
+    ai->m_HashOffset = dmEndian::ToHost(hash_offset);
+    ai->m_EntryDataOffset = dmEndian::ToHost(entry_offset);
+    ai->m_HashLength = dmEndian::ToHost(20U);
+    ai->m_DictionaryOffset = dmEndian::ToHost(dictionary_offset);
+
+    dmResourceArchive::EntryData* entry = (dmResourceArchive::EntryData*)(arci + entry_offset);
+    entry->m_ResourceDataOffset = dmEndian::ToHost(dictionary_size);
+    entry->m_ResourceSize = dmEndian::ToHost(data_size);
+    entry->m_ResourceCompressedSize = dmEndian::ToHost((uint32_t)compressed_size);
+    entry->m_Flags = dmEndian::ToHost((uint32_t)dmResourceArchive::ENTRY_FLAG_COMPRESSED | (1U << dmResourceArchive::ENTRY_DICTIONARY_SHIFT));
+
+    *(uint32_t*)(arci + dictionary_offset) = dmEndian::ToHost(1U);
+    dmResourceArchive::DictionaryData* dictionary_data = (dmResourceArchive::DictionaryData*)(arci + dictionary_offset + sizeof(uint32_t));
+    dictionary_data->m_ResourceDataOffset = dmEndian::ToHost(0U);
+    dictionary_data->m_Size = dmEndian::ToHost(dictionary_size);
+
+    dmResourceArchive::HArchiveIndexContainer archive = 0;
+    dmResourceArchive::Result result = dmResourceArchive::WrapArchiveBuffer(arci, arci_size, true, arcd, dictionary_size + compressed_size, true, &archive);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+    ASSERT_EQ(1U, archive->m_ArchiveFileIndex->m_DictionaryCount);
+
+    char buffer[512] = { 0 };
+    result = dmResourceArchive::ReadEntry(archive, entry, buffer);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+    ASSERT_STREQ(data, buffer);
+
+    // An entry referring to a missing dictionary is invalid
+    entry->m_Flags = dmEndian::ToHost((uint32_t)dmResourceArchive::ENTRY_FLAG_COMPRESSED | (2U << dmResourceArchive::ENTRY_DICTIONARY_SHIFT));
+    result = dmResourceArchive::ReadEntry(archive, entry, buffer);
+    ASSERT_EQ(dmResourceArchive::RESULT_INVALID_DATA, result);
+
+    dmResourceArchive::Delete(archive);
+    delete[] arci;
+}
+
+struct ReadDataContext
+{
+    const uint8_t* m_Data;
+    uint32_t       m_Size;
+    uint32_t       m_Reads;
+};
+
+static dmResourceArchive::Result ReadData(void* _context, uint32_t offset, uint32_t size, void* buffer)
+{
+    ReadDataContext* context = (ReadDataContext*)_context;
+    context->m_Reads++;
+    if (offset > context->m_Size || size > context->m_Size - offset)
+        return dmResourceArchive::RESULT_IO_ERROR;
+    memcpy(buffer, context->m_Data + offset, size);
+    return dmResourceArchive::RESULT_OK;
+}
+
+TEST(dmResourceArchive, WrapIndex_Compressed)
+{
+    ReadDataContext context = { RESOURCES_COMPRESSED_ARCD, RESOURCES_COMPRESSED_ARCD_SIZE, 0 };
+    dmResourceArchive::HArchiveIndexContainer archive = 0;
+    dmResourceArchive::Result result = dmResourceArchive::WrapArchiveIndex((void*) RESOURCES_COMPRESSED_ARCI, RESOURCES_COMPRESSED_ARCI_SIZE, ReadData, &context, &archive);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+
+    ASSERT_EQ(5U, dmResourceArchive::GetEntryCount(archive));
+
+    dmResourceArchive::EntryData* entry;
+    uint32_t reads = 0;
+    for (uint32_t i = 0; i < (sizeof(path_hash) / sizeof(path_hash[0])); ++i)
+    {
+        if (IsLiveUpdateResource(path_hash[i])) continue;
+
+        char buffer[1024] = { 0 };
+        result = dmResourceArchive::FindEntry(archive, compressed_content_hash[i], sizeof(compressed_content_hash[i]), &entry);
+        ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+
+        result = dmResourceArchive::ReadEntry(archive, entry, buffer);
+        ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+        ASSERT_EQ(++reads, context.m_Reads);
+
+        ASSERT_STREQ(content[i], buffer);
+    }
+
+    // A failing read is an error
+    context.m_Size = 0;
+    char buffer[1024];
+    result = dmResourceArchive::ReadEntry(archive, entry, buffer);
+    ASSERT_EQ(dmResourceArchive::RESULT_IO_ERROR, result);
+
+    dmResourceArchive::Delete(archive);
+}
+
+static int CompareHash(const void* a, const void* b)
+{
+    return memcmp(a, b, dmResourceArchive::MAX_HASH);
+}
+
+TEST(dmResourceArchive, FindEntryLookup)
+{
+    // Enough entries for the archive to use a lookup table
+    const uint32_t entry_count = 1000;
+    const uint32_t hash_len = 20;
+    const uint32_t hash_offset = sizeof(dmResourceArchive::ArchiveIndex);
+    const uint32_t entry_offset = hash_offset + entry_count * dmResourceArchive::MAX_HASH;
+    const uint32_t arci_size = entry_offset + entry_count * sizeof(dmResourceArchive::EntryData);
+    uint8_t* arci = new uint8_t[arci_size];
+    memset(arci, 0, arci_size);
+
+    dmResourceArchive::ArchiveIndex* ai = (dmResourceArchive::ArchiveIndex*)arci;
+    ai->m_Version = dmEndian::ToHost(dmResourceArchive::VERSION);
+    ai->m_EntryDataCount = dmEndian::ToHost(entry_count);
+    ai->m_HashOffset = dmEndian::ToHost(hash_offset);
+    ai->m_EntryDataOffset = dmEndian::ToHost(entry_offset);
+    ai->m_HashLength = dmEndian::ToHost(hash_len);
+
+    uint8_t* hashes = arci + hash_offset;
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < entry_count; ++i)
+    {
+        for (uint32_t j = 0; j < hash_len; ++j)
+        {
+            seed = seed * 1103515245 + 12345;
+            hashes[i * dmResourceArchive::MAX_HASH + j] = (uint8_t)(seed >> 16);
+        }
+    }
+    // Clustered hashes, that all end up at the start of the list
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        memset(hashes + i * dmResourceArchive::MAX_HASH, 0, 4);
+    }
+    qsort(hashes, entry_count, dmResourceArchive::MAX_HASH, CompareHash);
+
+    dmResourceArchive::EntryData* entries = (dmResourceArchive::EntryData*)(arci + entry_offset);
+    for (uint32_t i = 0; i < entry_count; ++i)
+    {
+        entries[i].m_ResourceDataOffset = dmEndian::ToHost(i);
+    }
+
+    dmResourceArchive::HArchiveIndexContainer archive = 0;
+    dmResourceArchive::Result result = dmResourceArchive::WrapArchiveBuffer(arci, arci_size, true, RESOURCES_ARCD, RESOURCES_ARCD_SIZE, true, &archive);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+    ASSERT_NE((uint32_t*)0, archive->m_ArchiveFileIndex->m_LookupTable);
+
+    for (uint32_t i = 0; i < entry_count; ++i)
+    {
+        dmResourceArchive::EntryData* entry = 0;
+        result = dmResourceArchive::FindEntry(archive, hashes + i * dmResourceArchive::MAX_HASH, hash_len, &entry);
+        ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+        ASSERT_EQ(&entries[i], entry);
+    }
+
+    uint8_t missing_hash[hash_len];
+    memset(missing_hash, 0xFF, sizeof(missing_hash));
+    result = dmResourceArchive::FindEntry(archive, missing_hash, hash_len, 0);
+    ASSERT_EQ(dmResourceArchive::RESULT_NOT_FOUND, result);
+
+    memset(missing_hash, 0, sizeof(missing_hash));
+    result = dmResourceArchive::FindEntry(archive, missing_hash, hash_len, 0);
+    ASSERT_EQ(dmResourceArchive::RESULT_NOT_FOUND, result);
+
+    dmResourceArchive::Delete(archive);
+    delete[] arci;
+}
+
 TEST(dmResourceArchive, LoadFromDisk)
 {
     dmResourceArchive::HArchiveIndexContainer archive = 0;
@@ -724,6 +908,47 @@ TEST(dmResourceArchive, LoadFromDisk_MissingArchive)
     ASSERT_EQ(dmResourceArchive::RESULT_IO_ERROR, result);
 }
 
+TEST(dmResourceArchive, LoadFromDisk_ReadPartial)
+{
+    dmResourceArchive::HArchiveIndexContainer archive = 0;
+    char archive_path[512];
+    char resource_path[512];
+    dmTestUtil::MakeHostPath(archive_path, sizeof(archive_path), "build/src/test/resources.arci");
+    dmTestUtil::MakeHostPath(resource_path, sizeof(resource_path), "build/src/test/resources.arcd");
+
+    dmResourceArchive::Result result = dmResourceArchive::LoadArchiveFromFile(archive_path, resource_path, &archive);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+
+    dmResourceArchive::EntryData* entry;
+    for (uint32_t i = 0; i < sizeof(path_name)/sizeof(path_name[0]); ++i)
+    {
+        if (IsLiveUpdateResource(path_hash[i])) continue;
+
+        result = dmResourceArchive::FindEntry(archive, content_hash[i], sizeof(content_hash[i]), &entry);
+        ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+
+        uint32_t length = strlen(content[i]);
+        ASSERT_LT(2u, length);
+
+        char buffer[1024] = { 0 };
+        uint32_t nread = 0;
+        result = dmResourceArchive::ReadEntryPartial(archive, entry, 1, 2, buffer, &nread);
+        ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+        ASSERT_EQ(2u, nread);
+        ASSERT_EQ(0, memcmp(content[i] + 1, buffer, 2));
+
+        // Reads past the end are clamped to the resource size
+        memset(buffer, 0, sizeof(buffer));
+        result = dmResourceArchive::ReadEntryPartial(archive, entry, 1, sizeof(buffer) - 1, buffer, &nread);
+        ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+        ASSERT_GT(sizeof(buffer) - 1, nread);
+        ASSERT_LE(length - 1, nread);
+        ASSERT_STREQ(content[i] + 1, buffer);
+    }
+
+    dmResourceArchive::Delete(archive);
+}
+
 TEST(dmResourceArchive, LoadFromDisk_Compressed)
 {
     dmResourceArchive::HArchiveIndexContainer archive = 0;
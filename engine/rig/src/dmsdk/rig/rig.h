@@ -41,6 +41,7 @@ namespace dmRig
 
     typedef struct RigContext*  HRigContext;
     typedef struct RigInstance* HRigInstance;
+    typedef struct CompressedAnimationSet* HCompressedAnimationSet;
 
     enum Result
     {
@@ -153,6 +154,7 @@ namespace dmRig
         const dmRigDDF::Skeleton*       m_Skeleton;
         const dmRigDDF::MeshSet*        m_MeshSet;
         const dmRigDDF::AnimationSet*   m_AnimationSet;
+        HCompressedAnimationSet         m_CompressedAnimationSet; // Optional, the tracks of m_AnimationSet (see CompressAnimationSet)
 
         RigPoseCallback               m_PoseCallback;
         void*                         m_PoseCBUserData1;
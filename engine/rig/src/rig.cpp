@@ -19,6 +19,7 @@
 #include <dlib/math.h>
 #include <dlib/vmath.h>
 #include <dlib/profile.h>
+#include <dlib/job_thread.h>
 #include <dmsdk/dlib/object_pool.h>
 #include <graphics/graphics.h>
 
@@ -31,6 +32,8 @@ namespace dmRig
 
     static const dmhash_t NULL_ANIMATION = dmHashString64("");
     static const float CURSOR_EPSILON = 0.0001f;
+    static const uint32_t RIG_PARALLEL_GRAIN_SIZE = 8;     // Number of instances per job when evaluating the poses in parallel
+    static const uint32_t MAX_POSE_UPDATE_INTERVAL = 255;
 
     static void DoAnimate(HRigContext context, RigInstance* instance, float dt);
     static bool DoPostUpdate(RigInstance* instance);
@@ -38,9 +41,9 @@ namespace dmRig
     struct RigContext
     {
         dmObjectPool<HRigInstance>      m_Instances;
-        // Temporary scratch buffers used for store pose as transform and matrices
-        // (avoids modifying the real pose transform data during rendering).
-        dmArray<dmVMath::Matrix4>       m_ScratchPoseMatrixBuffer;
+        dmJobThread::HContext           m_JobThread;
+        // The instances that have their pose evaluated in the current update
+        dmArray<RigInstance*>           m_EvaluateInstances;
         // Temporary scratch buffers used when transforming the vertex buffer,
         // used to creating primitives from indices.
         dmArray<dmVMath::Vector3>       m_ScratchPositionBufferWorld;
@@ -58,11 +61,17 @@ namespace dmRig
         }
 
         context->m_Instances.SetCapacity(params.m_MaxRigInstanceCount);
-        context->m_ScratchPoseMatrixBuffer.SetCapacity(0);
+        context->m_EvaluateInstances.SetCapacity(params.m_MaxRigInstanceCount);
+        context->m_JobThread = 0;
         *out = context;
         return dmRig::RESULT_OK;
     }
 
+    void SetContextJobThread(HRigContext context, dmJobThread::HContext job_thread)
+    {
+        context->m_JobThread = job_thread;
+    }
+
     void DeleteContext(HRigContext context)
     {
         delete context;
@@ -137,6 +146,9 @@ namespace dmRig
 
         SetCursor(instance, offset, true);
         SetPlaybackRate(instance, playback_rate);
+
+        // Evaluate the new animation in the next update, regardless of the pose update interval
+        instance->m_PoseUpdateCounter = instance->m_PoseUpdateInterval;
         return dmRig::RESULT_OK;
     }
 
@@ -401,6 +413,12 @@ namespace dmRig
         fraction -= sample;
         // Sample animation tracks
         const dmHashTable64<uint32_t>* bone_indices = instance->m_BoneIndices;
+        if (instance->m_CompressedAnimationSet)
+        {
+            uint32_t animation_index = (uint32_t)(animation - instance->m_AnimationSet->m_Animations.m_Data);
+            ApplyCompressedAnimation(instance->m_CompressedAnimationSet, animation_index, bone_indices, sample, fraction, pose, blend_weight);
+            return;
+        }
         uint32_t track_count = animation->m_Tracks.m_Count;
         for (uint32_t ti = 0; ti < track_count; ++ti)
         {
@@ -445,17 +463,40 @@ namespace dmRig
         }
     }
 
+    static bool UpdatePlayers(RigInstance* instance, float dt);
+    static void EvaluatePose(RigInstance* instance);
+
+    static void EvaluatePosesRange(void* ctx, uint32_t begin, uint32_t end)
+    {
+        RigInstance** instances = (RigInstance**)ctx;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            EvaluatePose(instances[i]);
+        }
+    }
+
     static void Animate(HRigContext context, float dt)
     {
         DM_PROFILE("RigAnimate");
 
         const dmArray<RigInstance*>& instances = context->m_Instances.GetRawObjects();
         uint32_t n = instances.Size();
+
+        // The players post the animation events, so they are updated serially
+        dmArray<RigInstance*>& evaluate_instances = context->m_EvaluateInstances;
+        evaluate_instances.SetSize(0);
         for (uint32_t i = 0; i < n; ++i)
         {
             RigInstance* instance = instances[i];
-            DoAnimate(context, instance, dt);
+            if (UpdatePlayers(instance, dt) && !evaluate_instances.Full())
+            {
+                evaluate_instances.Push(instance);
+            }
         }
+
+        // The instances are independent while evaluating the poses
+        DM_PROFILE("RigEvaluatePoses");
+        dmJobThread::ParallelFor(context->m_JobThread, evaluate_instances.Size(), RIG_PARALLEL_GRAIN_SIZE, EvaluatePosesRange, evaluate_instances.Begin());
     }
 
     static void ResetPose(const dmRigDDF::Skeleton* skeleton, dmArray<BonePose>& pose)
@@ -492,14 +533,51 @@ namespace dmRig
         }
     }
 
-    static void DoAnimate(HRigContext context, RigInstance* instance, float dt)
+    // Steps the cursors of the players (which posts the animation events) and the blend.
+    // Returns true if the pose should be evaluated.
+    static bool UpdatePlayers(RigInstance* instance, float dt)
     {
         // NOTE we previously checked for (!instance->m_Enabled || !instance->m_AddedToUpdate) here also
         RigPlayer* player = GetPlayer(instance);
 
         if (!player->m_Playing || !instance->m_Enabled || !player->m_Animation)
-            return;
+            return false;
+
+        UpdateBlend(instance, dt);
 
+        if (instance->m_Blending)
+        {
+            float fade_rate = instance->m_BlendTimer / instance->m_BlendDuration;
+            for (uint32_t pi = 0; pi < 2; ++pi)
+            {
+                RigPlayer* p = &instance->m_Players[pi];
+                // How much relative blending between the two players
+                float blend_weight = fade_rate;
+                if (player != p) {
+                    blend_weight = 1.0f - fade_rate;
+                }
+
+                UpdatePlayer(instance, p, dt, blend_weight);
+            }
+        }
+        else
+        {
+            UpdatePlayer(instance, player, dt, 1.0f);
+        }
+
+        // The players are always updated, so that the events are posted on time, but the pose may be evaluated less often
+        instance->m_PoseUpdateCounter++;
+        if (instance->m_PoseUpdateCounter < instance->m_PoseUpdateInterval)
+            return false;
+        instance->m_PoseUpdateCounter = 0;
+        return true;
+    }
+
+    // Evaluates the pose from the current state of the players. Only the instance itself is modified,
+    // so the poses of different instances can be evaluated in parallel.
+    static void EvaluatePose(RigInstance* instance)
+    {
+        RigPlayer* player = GetPlayer(instance);
         const dmRigDDF::Skeleton* skeleton = instance->m_Skeleton;
 
         dmArray<BonePose>& pose = instance->m_Pose;
@@ -515,8 +593,6 @@ namespace dmRig
             ik_animation[ii].m_Positive = ik->m_Positive;
         }
 
-        UpdateBlend(instance, dt);
-
         if (instance->m_Blending)
         {
             float fade_rate = instance->m_BlendTimer / instance->m_BlendDuration;
@@ -525,13 +601,6 @@ namespace dmRig
             for (uint32_t pi = 0; pi < 2; ++pi)
             {
                 RigPlayer* p = &instance->m_Players[pi];
-                // How much relative blending between the two players
-                float blend_weight = fade_rate;
-                if (player != p) {
-                    blend_weight = 1.0f - fade_rate;
-                }
-
-                UpdatePlayer(instance, p, dt, blend_weight);
                 ApplyAnimation(instance, p, pose, ik_animation, alpha);
                 if (player == p)
                 {
@@ -545,7 +614,6 @@ namespace dmRig
         }
         else
         {
-            UpdatePlayer(instance, player, dt, 1.0f);
             ApplyAnimation(instance, player, pose, ik_animation, 1.0f);
         }
 
@@ -566,6 +634,15 @@ namespace dmRig
         }
 
         UpdatePoseTransforms(pose);
+        instance->m_SkinningMatricesDirty = 1;
+    }
+
+    static void DoAnimate(HRigContext context, RigInstance* instance, float dt)
+    {
+        if (UpdatePlayers(instance, dt))
+        {
+            EvaluatePose(instance);
+        }
     }
 
     static Result PostUpdate(HRigContext context)
@@ -627,6 +704,7 @@ namespace dmRig
             instance->m_Pose[i].m_Local = bone->m_Local;
             instance->m_Pose[i].m_World = bone->m_World;
         }
+        instance->m_SkinningMatricesDirty = 1;
 
         instance->m_IKTargets.SetCapacity(skeleton->m_Iks.m_Count);
         instance->m_IKTargets.SetSize(skeleton->m_Iks.m_Count);
@@ -1127,6 +1205,39 @@ namespace dmRig
         array.SetSize(size);
     }
 
+    // Returns the pose matrices premultiplied with the bind pose inverse, so they can be directly be used to transform
+    // each vertex. They only depend on the pose, so they are calculated once and shared by all meshes of the instance.
+    static const dmArray<Matrix4>& GetSkinningMatrices(RigInstance* instance)
+    {
+        dmArray<Matrix4>& skinning_matrices = instance->m_SkinningMatrices;
+        uint32_t bone_count = GetBoneCount(instance);
+        if (!instance->m_SkinningMatricesDirty && skinning_matrices.Size() == bone_count)
+        {
+            return skinning_matrices;
+        }
+
+        DM_PROFILE(__FUNCTION__);
+        if (skinning_matrices.Capacity() < bone_count)
+        {
+            skinning_matrices.SetCapacity(bone_count);
+        }
+        skinning_matrices.SetSize(bone_count);
+
+        if (bone_count)
+        {
+            PoseToMatrix(instance->m_Pose, skinning_matrices);
+
+            const dmArray<RigBone>& bind_pose = *instance->m_BindPose;
+            for (uint32_t bi = 0; bi < bone_count; ++bi)
+            {
+                Matrix4& pose_matrix = skinning_matrices[bi];
+                pose_matrix = pose_matrix * bind_pose[bi].m_ModelToLocal;
+            }
+        }
+        instance->m_SkinningMatricesDirty = 0;
+        return skinning_matrices;
+    }
+
     uint8_t* GenerateVertexDataFromAttributes(dmRig::HRigContext context, dmRig::HRigInstance instance, dmRigDDF::Mesh* mesh, const dmVMath::Matrix4& world_matrix, const dmVMath::Matrix4& normal_matrix, const dmGraphics::VertexAttributeInfos* attribute_infos, uint32_t vertex_stride, uint8_t* vertex_data_out)
     {
         const dmRigDDF::Model* model = instance->m_Model;
@@ -1136,19 +1247,16 @@ namespace dmRig
             return vertex_data_out;
         }
 
-        dmArray<Matrix4>& pose_matrices   = context->m_ScratchPoseMatrixBuffer;
-        dmArray<Vector3>& positions_world = context->m_ScratchPositionBufferWorld;
-        dmArray<Vector3>& positions_local = context->m_ScratchPositionBufferLocal;
-        dmArray<Vector3>& normals         = context->m_ScratchNormalBuffer;
-        dmArray<Vector4>& tangents        = context->m_ScratchTangentBuffer;
+        const dmArray<Matrix4>& pose_matrices = GetSkinningMatrices(instance);
+        dmArray<Vector3>& positions_world     = context->m_ScratchPositionBufferWorld;
+        dmArray<Vector3>& positions_local     = context->m_ScratchPositionBufferLocal;
+        dmArray<Vector3>& normals             = context->m_ScratchNormalBuffer;
+        dmArray<Vector4>& tangents            = context->m_ScratchTangentBuffer;
 
-        uint32_t bone_count   = GetBoneCount(instance);
         uint32_t vertex_count = mesh->m_Positions.m_Count / 3;
 
         dmGraphics::VertexAttributeInfoMetadata meta_datas = dmGraphics::GetVertexAttributeInfosMetaData(*attribute_infos);
 
-        pose_matrices.SetSize(0);
-
         float* positions_buffer_world = 0;
         float* positions_buffer_local = 0;
         float* normals_buffer         = 0;
@@ -1156,28 +1264,6 @@ namespace dmRig
 
         if (meta_datas.m_HasAttributeWorldPosition || meta_datas.m_HasAttributeLocalPosition)
         {
-            if (bone_count)
-            {
-                // Make sure pose scratch buffers have enough space
-                if (pose_matrices.Capacity() < bone_count)
-                {
-                    uint32_t size_offset = bone_count - pose_matrices.Capacity();
-                    pose_matrices.OffsetCapacity(size_offset);
-                }
-                pose_matrices.SetSize(bone_count);
-
-                PoseToMatrix(instance->m_Pose, pose_matrices);
-
-                // Premultiply pose matrices with the bind pose inverse so they
-                // can be directly be used to transform each vertex.
-                const dmArray<RigBone>& bind_pose = *instance->m_BindPose;
-                for (uint32_t bi = 0; bi < pose_matrices.Size(); ++bi)
-                {
-                    Matrix4& pose_matrix = pose_matrices[bi];
-                    pose_matrix = pose_matrix * bind_pose[bi].m_ModelToLocal;
-                }
-            }
-
             if (meta_datas.m_HasAttributeWorldPosition)
             {
                 EnsureSize(positions_world, vertex_count);
@@ -1216,35 +1302,11 @@ namespace dmRig
             return vertex_data_out;
         }
 
-        dmArray<Matrix4>& pose_matrices   = context->m_ScratchPoseMatrixBuffer;
-        dmArray<Vector3>& positions_world = context->m_ScratchPositionBufferWorld;
-        dmArray<Vector3>& normals         = context->m_ScratchNormalBuffer;
-        dmArray<Vector4>& tangents        = context->m_ScratchTangentBuffer;
-
-        // If the rig has bones, update the pose to be local-to-model
-        uint32_t bone_count = GetBoneCount(instance);
-        if (bone_count)
-        {
-            // Make sure pose scratch buffers have enough space
-            if (pose_matrices.Capacity() < bone_count) {
-                uint32_t size_offset = bone_count - pose_matrices.Capacity();
-                pose_matrices.OffsetCapacity(size_offset);
-            }
-            pose_matrices.SetSize(bone_count);
-
-            PoseToMatrix(instance->m_Pose, pose_matrices);
-
-            // Premultiply pose matrices with the bind pose inverse so they
-            // can be directly be used to transform each vertex.
-            const dmArray<RigBone>& bind_pose = *instance->m_BindPose;
-            for (uint32_t bi = 0; bi < pose_matrices.Size(); ++bi)
-            {
-                Matrix4& pose_matrix = pose_matrices[bi];
-                pose_matrix = pose_matrix * bind_pose[bi].m_ModelToLocal;
-            }
-        } else {
-            pose_matrices.SetSize(0);
-        }
+        // If the rig has bones, the pose is local-to-model
+        const dmArray<Matrix4>& pose_matrices = GetSkinningMatrices(instance);
+        dmArray<Vector3>& positions_world     = context->m_ScratchPositionBufferWorld;
+        dmArray<Vector3>& normals             = context->m_ScratchNormalBuffer;
+        dmArray<Vector4>& tangents            = context->m_ScratchTangentBuffer;
 
         Matrix4 normal_matrix = dmVMath::Inverse(world_matrix);
         normal_matrix = dmVMath::Transpose(normal_matrix);
@@ -1293,6 +1355,11 @@ namespace dmRig
         instance->m_Enabled = enabled;
     }
 
+    void SetPoseUpdateInterval(HRigInstance instance, uint32_t interval)
+    {
+        instance->m_PoseUpdateInterval = (uint16_t)dmMath::Min(interval, MAX_POSE_UPDATE_INTERVAL);
+    }
+
     bool GetEnabled(HRigInstance instance)
     {
         return instance->m_Enabled;
@@ -1374,6 +1441,7 @@ namespace dmRig
         RigInstance* instance = context->m_Instances.Get(index);
         // If we're going to use memset, then we should explicitly clear pose and instance arrays.
         instance->m_Pose.SetCapacity(0);
+        instance->m_SkinningMatrices.SetCapacity(0);
         instance->m_IKTargets.SetCapacity(0);
         delete instance;
         context->m_Instances.Free(index, true);
@@ -1407,6 +1475,7 @@ namespace dmRig
         instance->m_Skeleton           = params.m_Skeleton;
         instance->m_MeshSet            = params.m_MeshSet;
         instance->m_AnimationSet       = params.m_AnimationSet;
+        instance->m_CompressedAnimationSet = params.m_CompressedAnimationSet;
 
         instance->m_Enabled = 1;
 
@@ -16,5 +16,50 @@
 #define DM_RIG_H
 
 #include <dmsdk/rig/rig.h>
+#include <dlib/job_thread.h>
+
+namespace dmRig
+{
+    /*
+     * Sets the job thread context used to evaluate the poses of the instances in parallel.
+     * @param job_thread Job thread context, or 0x0 to evaluate the poses on the calling thread
+     */
+    void SetContextJobThread(HRigContext context, dmJobThread::HContext job_thread);
+
+    /*
+     * Sets how often the pose of the instance is evaluated, e.g. to update instances far from the camera less often.
+     * The animation cursors and events are always updated.
+     * @param interval The pose is evaluated every interval updates, 0 and 1 means every update
+     */
+    void SetPoseUpdateInterval(HRigInstance instance, uint32_t interval);
+
+    /// The max error allowed when removing keyframes from the animation tracks.
+    /// Rotations are also quantized, which adds an error of less than 2.2e-5 per quaternion component.
+    struct CompressAnimationParams
+    {
+        CompressAnimationParams()
+        : m_PositionTolerance(0.0001f)
+        , m_RotationTolerance(0.0001f)
+        , m_ScaleTolerance(0.0001f)
+        {
+        }
+
+        float m_PositionTolerance;
+        float m_RotationTolerance; // Max error per quaternion component
+        float m_ScaleTolerance;
+    };
+
+    /*
+     * Compresses the animation tracks of an animation set, the result can be passed to InstanceCreate
+     * together with the animation set. After that, the tracks of the animation set are no longer used.
+     * Returns 0 if the tracks can't be compressed (e.g. if an animation has more than 65536 samples).
+     */
+    HCompressedAnimationSet CompressAnimationSet(const dmRigDDF::AnimationSet* animation_set, const CompressAnimationParams& params);
+
+    void DeleteCompressedAnimationSet(HCompressedAnimationSet compressed);
+
+    /// Returns the memory used by the compressed tracks, in bytes
+    uint32_t GetCompressedAnimationSetSize(HCompressedAnimationSet compressed);
+}
 
 #endif // DM_RIG_H
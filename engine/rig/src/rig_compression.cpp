@@ -0,0 +1,427 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "rig.h"
+#include "rig_private.h"
+
+#include <dlib/log.h>
+#include <dlib/math.h>
+#include <dlib/vmath.h>
+#include <dmsdk/dlib/align.h>
+
+#include <math.h>
+#include <string.h>
+
+namespace dmRig
+{
+    using namespace dmVMath;
+
+    // The sample indices of the keys are stored as uint16_t
+    static const uint32_t MAX_SAMPLE_COUNT = 65536;
+    // Keys are at most this many samples apart, which bounds the cost of the keyframe reduction
+    static const uint32_t MAX_KEY_DISTANCE = 32;
+    // The three smallest components of a unit quaternion are within [-1/sqrt(2), 1/sqrt(2)]
+    static const float QUAT_COMPONENT_RANGE = 0.70710678f;
+
+    struct ChannelScratch
+    {
+        dmArray<uint16_t> m_Keys;
+        dmArray<uint16_t> m_EncodedRotations;
+        dmArray<float>    m_Rotations;
+    };
+
+    // Smallest-three: the index of the largest component, and the other three components quantized to 16 bits.
+    // q and -q are the same rotation, so the largest component is made positive and reconstructed from the others.
+    static void EncodeQuat(const float* q, uint16_t* out)
+    {
+        uint32_t largest = 0;
+        for (uint32_t i = 1; i < 4; ++i)
+        {
+            if (fabsf(q[i]) > fabsf(q[largest]))
+                largest = i;
+        }
+        float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+        uint32_t j = 0;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            if (i == largest)
+                continue;
+            float v = dmMath::Clamp((sign * q[i] / QUAT_COMPONENT_RANGE) * 0.5f + 0.5f, 0.0f, 1.0f);
+            out[j++] = (uint16_t)(v * 65535.0f + 0.5f);
+        }
+        out[3] = (uint16_t)largest;
+    }
+
+    static Quat DecodeQuat(const uint16_t* q)
+    {
+        float c[4];
+        uint32_t largest = q[3];
+        float sum = 0.0f;
+        uint32_t j = 0;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            if (i == largest)
+                continue;
+            float v = (q[j++] * (2.0f / 65535.0f) - 1.0f) * QUAT_COMPONENT_RANGE;
+            c[i] = v;
+            sum += v * v;
+        }
+        c[largest] = sqrtf(dmMath::Max(0.0f, 1.0f - sum));
+        return Quat(c[0], c[1], c[2], c[3]);
+    }
+
+    // The max component error, taking into account that q and -q are the same rotation
+    static float QuatError(const Quat& q, const float* expected)
+    {
+        float d = q.getX() * expected[0] + q.getY() * expected[1] + q.getZ() * expected[2] + q.getW() * expected[3];
+        float sign = d < 0.0f ? -1.0f : 1.0f;
+        float error = 0.0f;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            error = dmMath::Max(error, fabsf(sign * q.getElem(i) - expected[i]));
+        }
+        return error;
+    }
+
+    static bool Vec3SampleFits(const void* ctx, uint32_t start, uint32_t end, uint32_t sample, float tolerance)
+    {
+        const float* values = (const float*)ctx;
+        float t = (sample - start) / (float)(end - start);
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            float v0 = values[start * 3 + c];
+            float v1 = values[end * 3 + c];
+            if (fabsf(v0 + (v1 - v0) * t - values[sample * 3 + c]) > tolerance)
+                return false;
+        }
+        return true;
+    }
+
+    struct QuatSamples
+    {
+        const uint16_t* m_Encoded;
+        const float*    m_Rotations;
+    };
+
+    static bool QuatSampleFits(const void* ctx, uint32_t start, uint32_t end, uint32_t sample, float tolerance)
+    {
+        const QuatSamples* samples = (const QuatSamples*)ctx;
+        float t = (sample - start) / (float)(end - start);
+        Quat q = slerp(t, DecodeQuat(&samples->m_Encoded[start * 4]), DecodeQuat(&samples->m_Encoded[end * 4]));
+        return QuatError(q, &samples->m_Rotations[sample * 4]) <= tolerance;
+    }
+
+    typedef bool (*SampleFitsFn)(const void* ctx, uint32_t start, uint32_t end, uint32_t sample, float tolerance);
+
+    static bool SegmentFits(SampleFitsFn fits, const void* ctx, uint32_t start, uint32_t end, float tolerance)
+    {
+        for (uint32_t i = start + 1; i < end; ++i)
+        {
+            if (!fits(ctx, start, end, i, tolerance))
+                return false;
+        }
+        return true;
+    }
+
+    // Greedily extends each segment between two keys as long as all samples within it can be interpolated within the tolerance.
+    // The first and the last samples are always keys.
+    static void ReduceKeys(SampleFitsFn fits, const void* ctx, uint32_t sample_count, float tolerance, dmArray<uint16_t>& keys)
+    {
+        keys.SetCapacity(sample_count);
+        keys.SetSize(0);
+        keys.Push(0);
+        uint32_t start = 0;
+        while (start + 1 < sample_count)
+        {
+            uint32_t end = start + 1;
+            while (end + 1 < sample_count && end + 1 - start <= MAX_KEY_DISTANCE && SegmentFits(fits, ctx, start, end + 1, tolerance))
+            {
+                ++end;
+            }
+            keys.Push((uint16_t)end);
+            start = end;
+        }
+    }
+
+    // Appends the data, padded to 4 bytes so that the following data is aligned for floats
+    static uint32_t AppendData(dmArray<uint8_t>& data, const void* src, uint32_t size)
+    {
+        uint32_t offset = data.Size();
+        uint32_t aligned_size = DM_ALIGN(size, 4);
+        if (data.Remaining() < aligned_size)
+        {
+            data.OffsetCapacity(dmMath::Max(aligned_size, data.Capacity()));
+        }
+        data.SetSize(offset + aligned_size);
+        memcpy(&data[offset], src, size);
+        memset(&data[offset + size], 0, aligned_size - size);
+        return offset;
+    }
+
+    static void CompressVec3Channel(const float* values, uint32_t value_count, float tolerance, ChannelScratch& scratch, dmArray<uint8_t>& data, CompressedChannel* out)
+    {
+        uint32_t sample_count = value_count / 3;
+        out->m_Offset = 0;
+        out->m_KeyCount = 0;
+        if (sample_count == 0)
+            return;
+
+        bool constant = true;
+        for (uint32_t i = 1; i < sample_count && constant; ++i)
+        {
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                if (fabsf(values[i * 3 + c] - values[c]) > tolerance)
+                {
+                    constant = false;
+                    break;
+                }
+            }
+        }
+        if (constant)
+        {
+            out->m_KeyCount = 1;
+            out->m_Offset = AppendData(data, values, 3 * sizeof(float));
+            return;
+        }
+
+        dmArray<uint16_t>& keys = scratch.m_Keys;
+        ReduceKeys(Vec3SampleFits, values, sample_count, tolerance, keys);
+        uint32_t key_count = keys.Size();
+        out->m_KeyCount = key_count;
+        out->m_Offset = AppendData(data, keys.Begin(), key_count * sizeof(uint16_t));
+        for (uint32_t k = 0; k < key_count; ++k)
+        {
+            AppendData(data, &values[keys[k] * 3], 3 * sizeof(float));
+        }
+    }
+
+    static void CompressQuatChannel(const float* values, uint32_t value_count, float tolerance, ChannelScratch& scratch, dmArray<uint8_t>& data, CompressedChannel* out)
+    {
+        uint32_t sample_count = value_count / 4;
+        out->m_Offset = 0;
+        out->m_KeyCount = 0;
+        if (sample_count == 0)
+            return;
+
+        dmArray<float>& rotations = scratch.m_Rotations;
+        rotations.SetCapacity(sample_count * 4);
+        rotations.SetSize(sample_count * 4);
+        for (uint32_t i = 0; i < sample_count; ++i)
+        {
+            const float* q = &values[i * 4];
+            float length = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+            float inv_length = length > 0.0f ? 1.0f / length : 0.0f;
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                rotations[i * 4 + c] = q[c] * inv_length;
+            }
+        }
+
+        Quat first(rotations[0], rotations[1], rotations[2], rotations[3]);
+        bool constant = true;
+        for (uint32_t i = 1; i < sample_count; ++i)
+        {
+            if (QuatError(first, &rotations[i * 4]) > tolerance)
+            {
+                constant = false;
+                break;
+            }
+        }
+        if (constant)
+        {
+            out->m_KeyCount = 1;
+            out->m_Offset = AppendData(data, rotations.Begin(), 4 * sizeof(float));
+            return;
+        }
+
+        dmArray<uint16_t>& encoded = scratch.m_EncodedRotations;
+        encoded.SetCapacity(sample_count * 4);
+        encoded.SetSize(sample_count * 4);
+        for (uint32_t i = 0; i < sample_count; ++i)
+        {
+            EncodeQuat(&rotations[i * 4], &encoded[i * 4]);
+        }
+
+        // The keys are reduced using the quantized rotations, so that the quantization error is included
+        QuatSamples samples;
+        samples.m_Encoded = encoded.Begin();
+        samples.m_Rotations = rotations.Begin();
+
+        dmArray<uint16_t>& keys = scratch.m_Keys;
+        ReduceKeys(QuatSampleFits, &samples, sample_count, tolerance, keys);
+        uint32_t key_count = keys.Size();
+        out->m_KeyCount = key_count;
+        out->m_Offset = AppendData(data, keys.Begin(), key_count * sizeof(uint16_t));
+        for (uint32_t k = 0; k < key_count; ++k)
+        {
+            AppendData(data, &encoded[keys[k] * 4], 4 * sizeof(uint16_t));
+        }
+    }
+
+    HCompressedAnimationSet CompressAnimationSet(const dmRigDDF::AnimationSet* animation_set, const CompressAnimationParams& params)
+    {
+        uint32_t animation_count = animation_set->m_Animations.m_Count;
+        uint32_t track_count = 0;
+        for (uint32_t ai = 0; ai < animation_count; ++ai)
+        {
+            const dmRigDDF::RigAnimation* animation = &animation_set->m_Animations[ai];
+            for (uint32_t ti = 0; ti < animation->m_Tracks.m_Count; ++ti)
+            {
+                const dmRigDDF::AnimationTrack* track = &animation->m_Tracks[ti];
+                if (track->m_Positions.m_Count / 3 > MAX_SAMPLE_COUNT || track->m_Rotations.m_Count / 4 > MAX_SAMPLE_COUNT || track->m_Scale.m_Count / 3 > MAX_SAMPLE_COUNT)
+                {
+                    dmLogWarning("Unable to compress the animation tracks, the animation '%s' has more than %u samples", dmHashReverseSafe64(animation->m_Id), MAX_SAMPLE_COUNT);
+                    return 0;
+                }
+            }
+            track_count += animation->m_Tracks.m_Count;
+        }
+
+        CompressedAnimationSet* compressed = new CompressedAnimationSet;
+        compressed->m_Animations.SetCapacity(animation_count);
+        compressed->m_Tracks.SetCapacity(track_count);
+
+        // Each track is compressed separately, with the data of all its channels next to each other,
+        // and the tracks of an animation are next to each other
+        ChannelScratch scratch;
+        for (uint32_t ai = 0; ai < animation_count; ++ai)
+        {
+            const dmRigDDF::RigAnimation* animation = &animation_set->m_Animations[ai];
+
+            CompressedAnimation compressed_animation;
+            compressed_animation.m_FirstTrack = compressed->m_Tracks.Size();
+            compressed_animation.m_TrackCount = animation->m_Tracks.m_Count;
+            compressed->m_Animations.Push(compressed_animation);
+
+            for (uint32_t ti = 0; ti < animation->m_Tracks.m_Count; ++ti)
+            {
+                const dmRigDDF::AnimationTrack* track = &animation->m_Tracks[ti];
+
+                CompressedTrack compressed_track;
+                compressed_track.m_BoneId = track->m_BoneId;
+                CompressVec3Channel(track->m_Positions.m_Data, track->m_Positions.m_Count, params.m_PositionTolerance, scratch, compressed->m_Data, &compressed_track.m_Positions);
+                CompressQuatChannel(track->m_Rotations.m_Data, track->m_Rotations.m_Count, params.m_RotationTolerance, scratch, compressed->m_Data, &compressed_track.m_Rotations);
+                CompressVec3Channel(track->m_Scale.m_Data, track->m_Scale.m_Count, params.m_ScaleTolerance, scratch, compressed->m_Data, &compressed_track.m_Scale);
+                compressed->m_Tracks.Push(compressed_track);
+            }
+        }
+
+        // The data array grows in steps, so trim it to what is used
+        compressed->m_Data.SetCapacity(compressed->m_Data.Size());
+        return compressed;
+    }
+
+    void DeleteCompressedAnimationSet(HCompressedAnimationSet compressed)
+    {
+        delete compressed;
+    }
+
+    uint32_t GetCompressedAnimationSetSize(HCompressedAnimationSet compressed)
+    {
+        return sizeof(CompressedAnimationSet)
+            + compressed->m_Animations.Capacity() * sizeof(CompressedAnimation)
+            + compressed->m_Tracks.Capacity() * sizeof(CompressedTrack)
+            + compressed->m_Data.Capacity();
+    }
+
+    // Returns the key before the sample, such that there is always a key after it
+    static uint32_t FindKey(const uint16_t* samples, uint32_t key_count, uint32_t sample)
+    {
+        uint32_t low = 0;
+        uint32_t high = key_count - 1;
+        while (high - low > 1)
+        {
+            uint32_t mid = (low + high) / 2;
+            if (samples[mid] <= sample)
+                low = mid;
+            else
+                high = mid;
+        }
+        return low;
+    }
+
+    static inline float KeyFraction(const uint16_t* samples, uint32_t key, uint32_t sample, float fraction)
+    {
+        float t = ((float)sample - samples[key] + fraction) / (float)(samples[key + 1] - samples[key]);
+        return dmMath::Min(t, 1.0f);
+    }
+
+    static inline const uint8_t* GetKeyValues(const uint8_t* data, const CompressedChannel& channel)
+    {
+        return data + channel.m_Offset + DM_ALIGN(channel.m_KeyCount * sizeof(uint16_t), 4);
+    }
+
+    static Vector3 SampleVec3(const uint8_t* data, const CompressedChannel& channel, uint32_t sample, float fraction)
+    {
+        if (channel.m_KeyCount == 1)
+        {
+            const float* v = (const float*)(data + channel.m_Offset);
+            return Vector3(v[0], v[1], v[2]);
+        }
+        const uint16_t* samples = (const uint16_t*)(data + channel.m_Offset);
+        const float* values = (const float*)GetKeyValues(data, channel);
+        uint32_t key = FindKey(samples, channel.m_KeyCount, sample);
+        float t = KeyFraction(samples, key, sample, fraction);
+        const float* v = &values[key * 3];
+        return lerp(t, Vector3(v[0], v[1], v[2]), Vector3(v[3], v[4], v[5]));
+    }
+
+    static Quat SampleQuat(const uint8_t* data, const CompressedChannel& channel, uint32_t sample, float fraction)
+    {
+        if (channel.m_KeyCount == 1)
+        {
+            const float* v = (const float*)(data + channel.m_Offset);
+            return Quat(v[0], v[1], v[2], v[3]);
+        }
+        const uint16_t* samples = (const uint16_t*)(data + channel.m_Offset);
+        const uint16_t* values = (const uint16_t*)GetKeyValues(data, channel);
+        uint32_t key = FindKey(samples, channel.m_KeyCount, sample);
+        float t = KeyFraction(samples, key, sample, fraction);
+        return slerp(t, DecodeQuat(&values[key * 4]), DecodeQuat(&values[key * 4 + 4]));
+    }
+
+    void ApplyCompressedAnimation(const CompressedAnimationSet* compressed, uint32_t animation_index, const dmHashTable64<uint32_t>* bone_indices,
+                                  uint32_t sample, float fraction, dmArray<BonePose>& pose, float blend_weight)
+    {
+        const CompressedAnimation& animation = compressed->m_Animations[animation_index];
+        const uint8_t* data = compressed->m_Data.Begin();
+        for (uint32_t ti = 0; ti < animation.m_TrackCount; ++ti)
+        {
+            const CompressedTrack* track = &compressed->m_Tracks[animation.m_FirstTrack + ti];
+
+            const uint32_t* bone_index = bone_indices->Get(track->m_BoneId);
+            if (!bone_index || *bone_index >= pose.Size()) {
+                continue;
+            }
+            dmTransform::Transform& transform = pose[*bone_index].m_Local;
+
+            if (track->m_Positions.m_KeyCount > 0)
+            {
+                Vector3 v = SampleVec3(data, track->m_Positions, sample, fraction);
+                transform.SetTranslation(lerp(blend_weight, transform.GetTranslation(), v));
+            }
+            if (track->m_Rotations.m_KeyCount > 0)
+            {
+                Quat q = SampleQuat(data, track->m_Rotations, sample, fraction);
+                transform.SetRotation(slerp(blend_weight, transform.GetRotation(), q));
+            }
+            if (track->m_Scale.m_KeyCount > 0)
+            {
+                Vector3 s = SampleVec3(data, track->m_Scale, sample, fraction);
+                transform.SetScale(lerp(blend_weight, transform.GetScale(), s));
+            }
+        }
+    }
+}
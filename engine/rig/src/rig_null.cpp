@@ -149,4 +149,23 @@ namespace dmRig
 
     void CopyBindPose(dmRigDDF::Skeleton& skeleton, dmArray<RigBone>& bind_pose)
     { }
+
+    void SetContextJobThread(HRigContext context, dmJobThread::HContext job_thread)
+    { }
+
+    void SetPoseUpdateInterval(HRigInstance instance, uint32_t interval)
+    { }
+
+    HCompressedAnimationSet CompressAnimationSet(const dmRigDDF::AnimationSet* animation_set, const CompressAnimationParams& params)
+    {
+        return 0;
+    }
+
+    void DeleteCompressedAnimationSet(HCompressedAnimationSet compressed)
+    { }
+
+    uint32_t GetCompressedAnimationSetSize(HCompressedAnimationSet compressed)
+    {
+        return 0;
+    }
 }
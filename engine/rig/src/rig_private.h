@@ -51,6 +51,44 @@ namespace dmRig
         bool m_Positive;
     };
 
+    /// A channel of a compressed animation track
+    struct CompressedChannel
+    {
+        /// Byte offset of the channel data in CompressedAnimationSet::m_Data. If there are more than one key, the data is
+        /// the sample index of each key (uint16_t), padded to 4 bytes, followed by the key values. Animated rotations are
+        /// stored as smallest-three quantized quaternions (see EncodeQuat), all other values are stored as floats.
+        uint32_t m_Offset;
+        /// 0 if the channel isn't animated, 1 if it is constant
+        uint32_t m_KeyCount;
+    };
+
+    struct CompressedTrack
+    {
+        dmhash_t          m_BoneId;
+        CompressedChannel m_Positions;
+        CompressedChannel m_Rotations;
+        CompressedChannel m_Scale;
+    };
+
+    struct CompressedAnimation
+    {
+        /// The tracks of the animation are stored next to each other, and so is their data
+        uint32_t m_FirstTrack;
+        uint32_t m_TrackCount;
+    };
+
+    /// The animation tracks of an animation set, with reduced keyframes. The animations are in the same order as in the animation set.
+    struct CompressedAnimationSet
+    {
+        dmArray<CompressedAnimation>  m_Animations;
+        dmArray<CompressedTrack>      m_Tracks;
+        dmArray<uint8_t>              m_Data;
+    };
+
+    /// Sets the local transform of the animated bones of an animation in the pose
+    void ApplyCompressedAnimation(const CompressedAnimationSet* compressed, uint32_t animation_index, const dmHashTable64<uint32_t>* bone_indices,
+                                  uint32_t sample, float fraction, dmArray<BonePose>& pose, float blend_weight);
+
     struct RigInstance
     {
         RigPlayer                     m_Players[2];
@@ -61,6 +99,7 @@ namespace dmRig
         const dmRigDDF::Skeleton*       m_Skeleton;
         const dmRigDDF::MeshSet*        m_MeshSet;
         const dmRigDDF::AnimationSet*   m_AnimationSet;
+        HCompressedAnimationSet         m_CompressedAnimationSet;
 
         RigPoseCallback               m_PoseCallback;
         void*                         m_PoseCBUserData1;
@@ -72,6 +111,8 @@ namespace dmRig
         void*                         m_EventCBUserData2;
         /// Animated pose, every transform is local-to-model-space and describes the delta between bind pose and animation
         dmArray<BonePose>             m_Pose;
+        /// The pose matrices premultiplied with the inverse bind pose, shared by all meshes and only recalculated when the pose changes
+        dmArray<dmVMath::Matrix4>     m_SkinningMatrices;
 
         /// Animated IK
         dmArray<IKAnimation>          m_IKAnimation;
@@ -86,13 +127,18 @@ namespace dmRig
         float                         m_BlendTimer;
         // Max bone count used by skeleton (if it is used) and meshset
         uint16_t                      m_MaxBoneCount;
+        /// The pose is evaluated every m_PoseUpdateInterval updates (0 and 1 means every update)
+        uint16_t                      m_PoseUpdateInterval;
+        /// Number of updates since the pose was last evaluated
+        uint16_t                      m_PoseUpdateCounter;
         /// Current player index
         uint8_t                       m_CurrentPlayer : 1;
         /// Whether we are currently X-fading or not
         uint8_t                       m_Blending : 1;
         uint8_t                       m_Enabled : 1;
         uint8_t                       m_DoRender : 1;
-        uint8_t                       : 4;
+        uint8_t                       m_SkinningMatricesDirty : 1;
+        uint8_t                       : 3;
     };
 }
 
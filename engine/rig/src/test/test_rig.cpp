@@ -20,6 +20,7 @@
 #include <dlib/log.h>
 #include <dlib/hash.h>
 #include <dlib/hashtable.h>
+#include <dlib/job_thread.h>
 #include <dmsdk/dlib/vmath.h>
 #include <dmsdk/dlib/dstrings.h>
 
@@ -1815,6 +1816,200 @@ TEST_F(RigInstanceTest, BoneTranslationRotation)
     ASSERT_EQ(Quat::rotationZ((float)M_PI / 2.0f), pose[0].m_World.GetRotation());
 }
 
+// The poses from the compressed animation tracks must match the poses from the tracks in the animation set
+TEST_F(RigInstanceTest, CompressedAnimation)
+{
+    dmRig::CompressAnimationParams compress_params;
+    dmRig::HCompressedAnimationSet compressed = dmRig::CompressAnimationSet(m_AnimationSet, compress_params);
+    ASSERT_NE((dmRig::HCompressedAnimationSet)0x0, compressed);
+    ASSERT_LT(0u, dmRig::GetCompressedAnimationSetSize(compressed));
+
+    dmRig::InstanceCreateParams create_params = {0};
+    create_params.m_BindPose               = &m_BindPose;
+    create_params.m_BoneIndices            = &m_BoneIndices;
+    create_params.m_Skeleton               = m_Skeleton;
+    create_params.m_MeshSet                = m_MeshSet;
+    create_params.m_AnimationSet           = m_AnimationSet;
+    create_params.m_CompressedAnimationSet = compressed;
+    create_params.m_ModelId                = dmHashString64((const char*)"test");
+    create_params.m_DefaultAnimation       = dmHashString64((const char*)"");
+
+    dmRig::HRigInstance instance = 0x0;
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceCreate(m_Context, create_params, &instance));
+
+    dmArray<dmRig::BonePose>& expected_pose = *dmRig::GetPose(m_Instance);
+    dmArray<dmRig::BonePose>& pose = *dmRig::GetPose(instance);
+
+    const char* animations[] = {"valid", "scaling", "rot_blend1", "trans_rot"};
+    for (uint32_t a = 0; a < DM_ARRAY_SIZE(animations); ++a)
+    {
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(m_Instance, dmHashString64(animations[a]), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.0f, 1.0f));
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(instance, dmHashString64(animations[a]), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.0f, 1.0f));
+
+        for (uint32_t step = 0; step < 12; ++step)
+        {
+            ASSERT_EQ(dmRig::RESULT_OK, dmRig::Update(m_Context, 0.25f));
+            ASSERT_EQ(expected_pose.Size(), pose.Size());
+            for (uint32_t i = 0; i < pose.Size(); ++i)
+            {
+                Vector3 expected_translation = expected_pose[i].m_World.GetTranslation();
+                Vector3 translation = pose[i].m_World.GetTranslation();
+                ASSERT_NEAR(expected_translation.getX(), translation.getX(), 0.001f);
+                ASSERT_NEAR(expected_translation.getY(), translation.getY(), 0.001f);
+                ASSERT_NEAR(expected_translation.getZ(), translation.getZ(), 0.001f);
+                // q and -q are the same rotation
+                ASSERT_NEAR(1.0f, fabsf(dot(expected_pose[i].m_World.GetRotation(), pose[i].m_World.GetRotation())), 0.001f);
+                Vector3 expected_scale = expected_pose[i].m_World.GetScale();
+                Vector3 scale = pose[i].m_World.GetScale();
+                ASSERT_NEAR(expected_scale.getX(), scale.getX(), 0.001f);
+                ASSERT_NEAR(expected_scale.getY(), scale.getY(), 0.001f);
+                ASSERT_NEAR(expected_scale.getZ(), scale.getZ(), 0.001f);
+            }
+        }
+    }
+
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceDestroy(m_Context, instance));
+    dmRig::DeleteCompressedAnimationSet(compressed);
+}
+
+// Samples that can be interpolated from their neighbours are removed
+TEST_F(RigContextTest, CompressAnimationReducesKeys)
+{
+    const uint32_t sample_count = 64;
+    float positions[sample_count * 3];
+    float rotations[sample_count * 4];
+    float scale[sample_count * 3];
+    for (uint32_t i = 0; i < sample_count; ++i)
+    {
+        float t = i / (float)(sample_count - 1);
+        positions[i * 3 + 0] = t * 10.0f;
+        positions[i * 3 + 1] = 1.0f;
+        positions[i * 3 + 2] = 0.0f;
+        Quat q = Quat::rotationZ((float)M_PI / 2.0f * t);
+        rotations[i * 4 + 0] = q.getX();
+        rotations[i * 4 + 1] = q.getY();
+        rotations[i * 4 + 2] = q.getZ();
+        rotations[i * 4 + 3] = q.getW();
+        scale[i * 3 + 0] = 1.0f;
+        scale[i * 3 + 1] = 1.0f;
+        scale[i * 3 + 2] = 1.0f;
+    }
+
+    dmRigDDF::AnimationTrack track;
+    memset(&track, 0, sizeof(track));
+    track.m_BoneId = dmHashString64("bone");
+    track.m_Positions.m_Data  = positions;
+    track.m_Positions.m_Count = sample_count * 3;
+    track.m_Rotations.m_Data  = rotations;
+    track.m_Rotations.m_Count = sample_count * 4;
+    track.m_Scale.m_Data      = scale;
+    track.m_Scale.m_Count     = sample_count * 3;
+
+    dmRigDDF::RigAnimation animation;
+    memset(&animation, 0, sizeof(animation));
+    animation.m_Id            = dmHashString64("ramp");
+    animation.m_Duration      = (sample_count - 1) / 30.0f;
+    animation.m_SampleRate    = 30.0f;
+    animation.m_Tracks.m_Data  = &track;
+    animation.m_Tracks.m_Count = 1;
+
+    dmRigDDF::AnimationSet animation_set;
+    memset(&animation_set, 0, sizeof(animation_set));
+    animation_set.m_Animations.m_Data  = &animation;
+    animation_set.m_Animations.m_Count = 1;
+
+    dmRig::CompressAnimationParams compress_params;
+    dmRig::HCompressedAnimationSet compressed = dmRig::CompressAnimationSet(&animation_set, compress_params);
+    ASSERT_NE((dmRig::HCompressedAnimationSet)0x0, compressed);
+    ASSERT_GT(sample_count * 10 * sizeof(float) / 4, dmRig::GetCompressedAnimationSetSize(compressed));
+    dmRig::DeleteCompressedAnimationSet(compressed);
+}
+
+// The animation cursor is always updated, but the pose is only evaluated every interval updates
+TEST_F(RigInstanceTest, PoseUpdateInterval)
+{
+    dmRig::SetPoseUpdateInterval(m_Instance, 2);
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(m_Instance, dmHashString64("valid"), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.0f, 1.0f));
+
+    dmArray<dmRig::BonePose>& pose = *dmRig::GetPose(m_Instance);
+
+    // sample 1, a new animation is always evaluated in the first update
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::Update(m_Context, 1.0f));
+    ASSERT_EQ(Quat::identity(), pose[0].m_World.GetRotation());
+    ASSERT_EQ(Quat::rotationZ((float)M_PI / 2.0f), pose[1].m_World.GetRotation());
+
+    // sample 2 is skipped
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::Update(m_Context, 1.0f));
+    ASSERT_NEAR(2.0f, dmRig::GetCursor(m_Instance, false), RIG_EPSILON_FLOAT);
+    ASSERT_EQ(Quat::identity(), pose[0].m_World.GetRotation());
+    ASSERT_EQ(Quat::rotationZ((float)M_PI / 2.0f), pose[1].m_World.GetRotation());
+
+    // sample 0 (looped)
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::Update(m_Context, 1.0f));
+    ASSERT_EQ(Quat::identity(), pose[0].m_World.GetRotation());
+    ASSERT_EQ(Quat::identity(), pose[1].m_World.GetRotation());
+}
+
+// The poses evaluated on the job threads must match the poses evaluated serially
+TEST_F(RigInstanceTest, ParallelPoses)
+{
+    const uint32_t instance_count = 32;
+
+    dmJobThread::JobThreadCreationParams job_thread_params;
+    job_thread_params.m_ThreadNames[0] = "Rig1";
+    job_thread_params.m_ThreadNames[1] = "Rig2";
+    job_thread_params.m_ThreadCount = 2;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_params);
+
+    dmRig::NewContextParams context_params = {0};
+    context_params.m_MaxRigInstanceCount = instance_count;
+    dmRig::HRigContext parallel_context;
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::NewContext(context_params, &parallel_context));
+    dmRig::SetContextJobThread(parallel_context, job_thread);
+
+    dmRig::InstanceCreateParams create_params = {0};
+    create_params.m_BindPose         = &m_BindPose;
+    create_params.m_BoneIndices      = &m_BoneIndices;
+    create_params.m_Skeleton         = m_Skeleton;
+    create_params.m_MeshSet          = m_MeshSet;
+    create_params.m_AnimationSet     = m_AnimationSet;
+    create_params.m_ModelId          = dmHashString64((const char*)"test");
+    create_params.m_DefaultAnimation = dmHashString64((const char*)"");
+
+    dmRig::HRigInstance instances[instance_count];
+    for (uint32_t i = 0; i < instance_count; ++i)
+    {
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceCreate(parallel_context, create_params, &instances[i]));
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(instances[i], dmHashString64("trans_rot"), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.0f, 1.0f));
+    }
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(m_Instance, dmHashString64("trans_rot"), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.0f, 1.0f));
+
+    dmArray<dmRig::BonePose>& expected_pose = *dmRig::GetPose(m_Instance);
+    for (uint32_t step = 0; step < 8; ++step)
+    {
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::Update(m_Context, 0.25f));
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::Update(parallel_context, 0.25f));
+
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            dmArray<dmRig::BonePose>& pose = *dmRig::GetPose(instances[i]);
+            ASSERT_EQ(expected_pose.Size(), pose.Size());
+            for (uint32_t b = 0; b < pose.Size(); ++b)
+            {
+                ASSERT_EQ(expected_pose[b].m_World.GetTranslation(), pose[b].m_World.GetTranslation());
+                ASSERT_EQ(expected_pose[b].m_World.GetRotation(), pose[b].m_World.GetRotation());
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < instance_count; ++i)
+    {
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceDestroy(parallel_context, instances[i]));
+    }
+    dmRig::DeleteContext(parallel_context);
+    dmJobThread::Destroy(job_thread);
+}
+
 // DEF-3121 - Starting new animation from inside a "animation completed callback" would previously
 // use the wrong animation for one frame.
 // In the test we register a "completion callback", play one animation forward once, then play another
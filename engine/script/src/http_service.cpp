@@ -14,6 +14,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <dlib/array.h>
 #include <dlib/dstrings.h>
@@ -39,8 +40,9 @@ namespace dmHttpService
     // (Reason: Our HTTP service threads call getaddrinfo() which
     //  resulted in a writes outside the stack space inside libc.)
     const uint32_t THREAD_STACK_SIZE = 0x20000;
-    const uint32_t DEFAULT_RESPONSE_BUFFER_SIZE = 64 * 1024;
+    const uint32_t MIN_RESPONSE_BUFFER_SIZE = 16 * 1024;
     const uint32_t DEFAULT_HEADER_BUFFER_SIZE = 16 * 1024;
+    const int WARMUP_TIMEOUT = 10 * 1000000;
 
 
     struct HttpService;
@@ -57,9 +59,14 @@ namespace dmHttpService
         int                   m_Status;
         uintptr_t             m_ResponseUserData1;
         uintptr_t             m_ResponseUserData2;
-        dmArray<char>         m_Response;
+        // The response body is handed over to the response message, so it's malloc'ed rather than a dmArray
+        char*                 m_Response;
+        uint32_t              m_ResponseSize;
+        uint32_t              m_ResponseCapacity;
+        uint32_t              m_ResponseType;
         dmArray<char>         m_Headers;
         const HttpService*    m_Service;
+        dmArray<char*>        m_WarmupUrls;
         bool                  m_CacheFlusher;
         volatile bool         m_Run;
         int                   m_Canceled;
@@ -105,27 +112,31 @@ namespace dmHttpService
     {
         Worker* worker = (Worker*) user_data;
         worker->m_Status = status_code;
-        dmArray<char>& r = worker->m_Response;
         bool method_is_head = method && strcmp(method, "HEAD") == 0;
 
         if (!method_is_head && !content_data && !content_data_size)
         {
-            r.SetSize(0);
+            worker->m_ResponseSize = 0;
             return;
         }
 
         uint32_t bytes_received = 0;
         if (!method_is_head)
         {
-            uint32_t resize_to = (uint32_t) dmMath::Max((int32_t) content_data_size, content_length);
-
-            if (r.Capacity() < resize_to)
+            uint32_t required = worker->m_ResponseSize + content_data_size;
+            if (worker->m_ResponseCapacity < required)
             {
-                r.SetCapacity(resize_to);
+                // Allocate the whole body at once if the length is known, otherwise grow geometrically
+                uint32_t capacity = dmMath::Max(worker->m_ResponseCapacity * 2, MIN_RESPONSE_BUFFER_SIZE);
+                capacity = dmMath::Max(capacity, (uint32_t) dmMath::Max(content_length, 0));
+                capacity = dmMath::Max(capacity, required);
+                worker->m_Response = (char*) realloc(worker->m_Response, capacity);
+                worker->m_ResponseCapacity = capacity;
             }
 
-            r.PushArray((char*) content_data, content_data_size);
-            bytes_received = r.Size();
+            memcpy(worker->m_Response + worker->m_ResponseSize, content_data, content_data_size);
+            worker->m_ResponseSize = required;
+            bytes_received = required;
         }
 
         if (worker->m_ReportProgress && (method_is_head || content_data_size > 0))
@@ -199,36 +210,49 @@ namespace dmHttpService
 
     static void MessageDestroyCallback(dmMessage::Message* message)
     {
-        dmHttpDDF::HttpResponse* response = (dmHttpDDF::HttpResponse*)message->m_Data;
-        free((void*) response->m_Headers);
-        free((void*) response->m_Response);
+        Response* response = (Response*)message->m_Data;
+        free((void*) response->m_DDF.m_Headers);
+        free((void*) response->m_DDF.m_Response);
     }
 
     static void SendResponse(const dmMessage::URL* requester, uintptr_t userdata1, uintptr_t userdata2, int status,
                              const char* headers, uint32_t headers_length,
-                             const char* response, uint32_t response_length,
-                             const char* filepath)
+                             const char* filepath, Worker* worker)
     {
-        dmHttpDDF::HttpResponse resp;
-        resp.m_Status = status;
-        resp.m_HeadersLength = headers_length;
-        resp.m_ResponseLength = response_length;
-
-        resp.m_Headers = (uint64_t) malloc(headers_length);
-        memcpy((void*) resp.m_Headers, headers, headers_length);
-        resp.m_Response = (uint64_t) malloc(response_length);
-        memcpy((void*) resp.m_Response, response, response_length);
-        resp.m_Path = filepath;
+        Response resp;
+        resp.m_DDF.m_Status = status;
+        resp.m_DDF.m_HeadersLength = headers_length;
+        resp.m_DDF.m_Headers = (uint64_t) malloc(headers_length);
+        memcpy((void*) resp.m_DDF.m_Headers, headers, headers_length);
+        resp.m_DDF.m_Path = filepath;
+        resp.m_ResponseType = RESPONSE_TYPE_STRING;
+
+        // The message takes over the response body of the worker, instead of copying it
+        resp.m_DDF.m_Response = 0;
+        resp.m_DDF.m_ResponseLength = 0;
+        if (worker)
+        {
+            if (worker->m_ResponseSize + worker->m_ResponseSize / 4 < worker->m_ResponseCapacity)
+            {
+                worker->m_Response = (char*) realloc(worker->m_Response, dmMath::Max(worker->m_ResponseSize, 1U));
+            }
+            resp.m_DDF.m_Response = (uint64_t) worker->m_Response;
+            resp.m_DDF.m_ResponseLength = worker->m_ResponseSize;
+            resp.m_ResponseType = worker->m_ResponseType;
+            worker->m_Response = 0;
+            worker->m_ResponseSize = 0;
+            worker->m_ResponseCapacity = 0;
+        }
 
         if (dmMessage::RESULT_OK != dmMessage::Post(0, requester, dmHttpDDF::HttpResponse::m_DDFHash, userdata1, userdata2, (uintptr_t) dmHttpDDF::HttpResponse::m_DDFDescriptor, &resp, sizeof(resp), MessageDestroyCallback) )
         {
-            free((void*) resp.m_Headers);
-            free((void*) resp.m_Response);
+            free((void*) resp.m_DDF.m_Headers);
+            free((void*) resp.m_DDF.m_Response);
             dmLogWarning("Failed to return http-response. Requester deleted?");
         }
     }
 
-    void HandleRequest(Worker* worker, const dmMessage::URL* requester, uintptr_t userdata1, uintptr_t userdata2, dmHttpDDF::HttpRequest* request)
+    void HandleRequest(Worker* worker, const dmMessage::URL* requester, uintptr_t userdata1, uintptr_t userdata2, dmHttpDDF::HttpRequest* request, uint32_t response_type)
     {
         dmURI::Parts url;
         request->m_Method = (const char*) ((uintptr_t) request + (uintptr_t) request->m_Method);
@@ -236,7 +260,7 @@ namespace dmHttpService
         dmURI::Result ur =  dmURI::Parse(request->m_Url, &url);
         if (ur != dmURI::RESULT_OK)
         {
-            SendResponse(requester, 0, 0, 0, 0, 0, 0, 0, 0);
+            SendResponse(requester, 0, 0, 0, 0, 0, 0, 0);
             return;
         }
         if (url.m_Path[0] == '\0') {
@@ -267,8 +291,8 @@ namespace dmHttpService
             memcpy(&worker->m_CurrentURL, &url, sizeof(url));
         }
 
-        worker->m_Response.SetSize(0);
-        worker->m_Response.SetCapacity(DEFAULT_RESPONSE_BUFFER_SIZE);
+        worker->m_ResponseSize = 0;
+        worker->m_ResponseType = response_type;
         worker->m_Headers.SetSize(0);
         worker->m_Headers.SetCapacity(DEFAULT_HEADER_BUFFER_SIZE);
         worker->m_Filepath = request->m_Path;
@@ -286,19 +310,20 @@ namespace dmHttpService
             dmHttpClient::SetOptionInt(worker->m_Client, dmHttpClient::OPTION_REQUEST_TIMEOUT, request->m_Timeout);
             dmHttpClient::SetOptionInt(worker->m_Client, dmHttpClient::OPTION_REQUEST_IGNORE_CACHE, request->m_IgnoreCache);
             dmHttpClient::SetOptionInt(worker->m_Client, dmHttpClient::OPTION_REQUEST_CHUNKED_TRANSFER, request->m_ChunkedTransfer);
+            dmHttpClient::SetOptionInt(worker->m_Client, dmHttpClient::OPTION_REQUEST_HTTP2, 1);
 
             dmHttpClient::Result r = dmHttpClient::Request(worker->m_Client, request->m_Method, url.m_Path);
 
             if (r == dmHttpClient::RESULT_OK || r == dmHttpClient::RESULT_NOT_200_OK) {
-                SendResponse(requester, userdata1, userdata2, worker->m_Status, worker->m_Headers.Begin(), worker->m_Headers.Size(), worker->m_Response.Begin(), worker->m_Response.Size(), worker->m_Filepath);
+                SendResponse(requester, userdata1, userdata2, worker->m_Status, worker->m_Headers.Begin(), worker->m_Headers.Size(), worker->m_Filepath, worker);
             } else {
                 // TODO: Error codes to lua?
                 dmLogError("HTTP request to '%s' failed (http result: %d  socket result: %d)", request->m_Url, r, GetLastSocketResult(worker->m_Client));
-                SendResponse(requester, userdata1, userdata2, 0, worker->m_Headers.Begin(), worker->m_Headers.Size(), worker->m_Response.Begin(), worker->m_Response.Size(), worker->m_Filepath);
+                SendResponse(requester, userdata1, userdata2, 0, worker->m_Headers.Begin(), worker->m_Headers.Size(), worker->m_Filepath, worker);
             }
         } else {
             // TODO: Error codes to lua?
-            SendResponse(requester, userdata1, userdata2, 0, worker->m_Headers.Begin(), worker->m_Headers.Size(), worker->m_Response.Begin(), worker->m_Response.Size(), worker->m_Filepath);
+            SendResponse(requester, userdata1, userdata2, 0, worker->m_Headers.Begin(), worker->m_Headers.Size(), worker->m_Filepath, worker);
             dmLogError("Unable to create HTTP connection to '%s'. No route to host?", request->m_Url);
         }
     }
@@ -317,7 +342,8 @@ namespace dmHttpService
             if (message->m_Descriptor == (uintptr_t) dmHttpDDF::HttpRequest::m_DDFDescriptor)
             {
                 dmHttpDDF::HttpRequest* request = (dmHttpDDF::HttpRequest*) &message->m_Data[0];
-                HandleRequest(worker, &message->m_Sender, 0, message->m_UserData2, request);
+                // The response type is passed as user data 1, as it isn't part of the HttpRequest message
+                HandleRequest(worker, &message->m_Sender, 0, message->m_UserData2, request, (uint32_t) message->m_UserData1);
                 free((void*) request->m_Headers);
                 free((void*) request->m_Request);
             }
@@ -367,10 +393,34 @@ namespace dmHttpService
         }
     }
 
+    static void Warmup(Worker* worker)
+    {
+        for (uint32_t i = 0; i < worker->m_WarmupUrls.Size() && worker->m_Run; ++i)
+        {
+            dmURI::Parts url;
+            if (dmURI::Parse(worker->m_WarmupUrls[i], &url) != dmURI::RESULT_OK || url.m_Hostname[0] == '\0')
+            {
+                dmLogWarning("Invalid http warmup url '%s'", worker->m_WarmupUrls[i]);
+                continue;
+            }
+            bool secure = strcmp(url.m_Scheme, "https") == 0;
+            dmHttpClient::Warmup(url.m_Hostname, url.m_Port, secure, true, WARMUP_TIMEOUT, &worker->m_Canceled);
+        }
+
+        for (uint32_t i = 0; i < worker->m_WarmupUrls.Size(); ++i)
+        {
+            free(worker->m_WarmupUrls[i]);
+        }
+        worker->m_WarmupUrls.SetCapacity(0);
+    }
+
     static void Loop(void* arg)
     {
         Worker* worker = (Worker*) arg;
 
+        // Connect to the known hosts before the first requests, which are likely to go to the same hosts
+        Warmup(worker);
+
         uint64_t flush_period = 5 * 1000000U;
         uint64_t next_flush = dmTime::GetTime() + flush_period;
         while (worker->m_Run)
@@ -408,6 +458,8 @@ namespace dmHttpService
                 // NOTE: The other cache (streaming) is called /cache
                 dmStrlCat(path, "/http-cache", sizeof(path));
                 cache_params.m_Path = path;
+                // Check the content in the background, rather than on each request
+                cache_params.m_VerifyContent = 1;
                 dmHttpCache::Result cache_r = dmHttpCache::Open(&cache_params, &service->m_HttpCache);
                 if (cache_r != dmHttpCache::RESULT_OK)
                 {
@@ -442,12 +494,36 @@ namespace dmHttpService
             worker->m_Client = 0;
             memset(&worker->m_CurrentURL, 0, sizeof(worker->m_CurrentURL));
             worker->m_Request = 0;
+            worker->m_Response = 0;
+            worker->m_ResponseSize = 0;
+            worker->m_ResponseCapacity = 0;
+            worker->m_ResponseType = RESPONSE_TYPE_STRING;
             worker->m_Status = 0;
             worker->m_Service = service;
             worker->m_CacheFlusher = i == 0 && worker->m_Service->m_HttpCache != 0;
             worker->m_Run = true;
             worker->m_Canceled = 0;
             service->m_Workers.Push(worker);
+        }
+
+        // Spread the warmup over the workers, so that the hosts are connected to in parallel
+        if (params->m_WarmupUrls)
+        {
+            char* urls = strdup(params->m_WarmupUrls);
+            char* last = 0;
+            uint32_t index = 0;
+            for (char* url = dmStrTok(urls, " ,", &last); url; url = dmStrTok(0, " ,", &last))
+            {
+                dmArray<char*>& worker_urls = service->m_Workers[index++ % threadcount]->m_WarmupUrls;
+                worker_urls.OffsetCapacity(1);
+                worker_urls.Push(strdup(url));
+            }
+            free(urls);
+        }
+
+        for (uint32_t i = 0; i < threadcount; ++i)
+        {
+            Worker* worker = service->m_Workers[i];
 
             dmThread::Thread t = dmThread::New(&Loop, THREAD_STACK_SIZE, worker, "http");
             worker->m_Thread = t;
@@ -503,6 +579,7 @@ namespace dmHttpService
             {
                 dmHttpClient::Delete(worker->m_Client);
             }
+            free(worker->m_Response);
             delete worker;
         }
 
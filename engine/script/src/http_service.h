@@ -21,17 +21,38 @@ namespace dmHttpService
 {
     typedef struct HttpService* HHttpService;
 
+    /// How the response body is delivered to the script. Passed as user data 1 of the HttpRequest message
+    enum ResponseType
+    {
+        RESPONSE_TYPE_STRING = 0,   //!< A Lua string
+        RESPONSE_TYPE_BUFFER = 1,   //!< A dmBuffer with a single "data" stream of uint8
+    };
+
+    /**
+     * The data of the HttpResponse message. The response type isn't part of the DDF message, so it follows it.
+     * The headers and the response body are allocated with malloc, and freed along with the message.
+     */
+    struct Response
+    {
+        dmHttpDDF::HttpResponse m_DDF;
+        uint32_t                m_ResponseType;
+    };
+
     typedef void (*ReportProgressCallback)(dmHttpDDF::HttpRequestProgress* msg, dmMessage::URL* url, uintptr_t user_data);
 
     struct Params
     {
     	Params()
         : m_ReportProgressCallback(0)
+        , m_WarmupUrls(0)
         , m_ThreadCount(4)
         , m_UseHttpCache(1)
     	{}
 
         ReportProgressCallback m_ReportProgressCallback;
+        /// Urls of hosts to connect to when the service starts, separated by spaces or commas.
+        /// The connections are kept in the connection pool, to speed up the first requests
+        const char*            m_WarmupUrls;
     	uint32_t               m_ThreadCount  : 4;
         uint32_t               m_UseHttpCache : 1;
     };
@@ -38,6 +38,7 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <limits.h>
@@ -47,6 +48,7 @@
 
 #include "strbuf.h"
 #include "fpconv.h"
+#include "lua_cjson.h" // DEFOLD
 
 #ifndef CJSON_MODNAME
 #define CJSON_MODNAME   "cjson"
@@ -530,7 +532,7 @@ static void json_initialize_config(lua_State *l, json_config_t* cfg, int encode_
     cfg->escape2char['u'] = 'u';          /* Unicode parsing required */
 
     // read additional config values from options table
-    if (lua_istable(l, 2))
+    if (l && lua_istable(l, 2))
     {
         lua_pushvalue(l, 2); // push config table to top of stack
 
@@ -1627,6 +1629,81 @@ int lua_cjson_decode(lua_State *l, const char* json_string, size_t json_len)
     return 1;
 }
 
+struct lua_cjson_tokenizer
+{
+    json_config_t cfg;
+    json_parse_t json;
+};
+
+lua_cjson_tokenizer* lua_cjson_tokenizer_new(const char* json_string, size_t json_len)
+{
+    lua_cjson_tokenizer* tokenizer;
+
+    /* Detect Unicode other than UTF-8, see lua_cjson_decode() */
+    if (json_len >= 2 && (!json_string[0] || !json_string[1]))
+        return NULL;
+
+    tokenizer = (lua_cjson_tokenizer*)malloc(sizeof(lua_cjson_tokenizer));
+    json_initialize_config(NULL, &tokenizer->cfg, 0);
+    tokenizer->json.cfg = &tokenizer->cfg;
+    tokenizer->json.data = json_string;
+    tokenizer->json.data_end = json_string + json_len;
+    tokenizer->json.current_depth = 0;
+    tokenizer->json.ptr = json_string;
+    tokenizer->json.tmp = strbuf_new(json_len);
+    return tokenizer;
+}
+
+void lua_cjson_tokenizer_delete(lua_cjson_tokenizer* tokenizer)
+{
+    strbuf_free(tokenizer->json.tmp);
+    free(tokenizer);
+}
+
+void lua_cjson_tokenizer_next(lua_cjson_tokenizer* tokenizer, lua_cjson_token* out)
+{
+    json_token_t token;
+    token.index = (int)(tokenizer->json.ptr - tokenizer->json.data);
+    json_next_token(&tokenizer->json, &token);
+
+    out->index = token.index;
+    out->string = 0;
+    out->string_len = 0;
+    switch (token.type) {
+    case T_OBJ_BEGIN:   out->type = LUA_CJSON_TOKEN_OBJ_BEGIN; break;
+    case T_OBJ_END:     out->type = LUA_CJSON_TOKEN_OBJ_END; break;
+    case T_ARR_BEGIN:   out->type = LUA_CJSON_TOKEN_ARR_BEGIN; break;
+    case T_ARR_END:     out->type = LUA_CJSON_TOKEN_ARR_END; break;
+    case T_COLON:       out->type = LUA_CJSON_TOKEN_COLON; break;
+    case T_COMMA:       out->type = LUA_CJSON_TOKEN_COMMA; break;
+    case T_NULL:        out->type = LUA_CJSON_TOKEN_NULL; break;
+    case T_STRING:
+        out->type = LUA_CJSON_TOKEN_STRING;
+        out->string = token.value.string;
+        out->string_len = (size_t)token.string_len;
+        break;
+    case T_NUMBER:
+        out->type = LUA_CJSON_TOKEN_NUMBER;
+        out->number = token.value.number;
+        break;
+    case T_BOOLEAN:
+        out->type = LUA_CJSON_TOKEN_BOOLEAN;
+        out->boolean = token.value.boolean;
+        break;
+    case T_END:
+        out->type = LUA_CJSON_TOKEN_END;
+        break;
+    case T_ERROR:
+        out->type = LUA_CJSON_TOKEN_ERROR;
+        out->string = token.value.string;
+        break;
+    default:
+        out->type = LUA_CJSON_TOKEN_ERROR;
+        out->string = "invalid token";
+        break;
+    }
+}
+
 #if 0 // Defold: unused
 /* ===== INITIALISATION ===== */
 
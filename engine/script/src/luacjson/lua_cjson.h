@@ -0,0 +1,62 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_LUA_CJSON_H
+#define DM_LUA_CJSON_H
+
+#include <stddef.h>
+
+// DEFOLD: Token level access to the lua_cjson decoder, used by json.decode_stream.
+// The tokenizer doesn't use a Lua state.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    LUA_CJSON_TOKEN_OBJ_BEGIN,
+    LUA_CJSON_TOKEN_OBJ_END,
+    LUA_CJSON_TOKEN_ARR_BEGIN,
+    LUA_CJSON_TOKEN_ARR_END,
+    LUA_CJSON_TOKEN_STRING,
+    LUA_CJSON_TOKEN_NUMBER,
+    LUA_CJSON_TOKEN_BOOLEAN,
+    LUA_CJSON_TOKEN_NULL,
+    LUA_CJSON_TOKEN_COLON,
+    LUA_CJSON_TOKEN_COMMA,
+    LUA_CJSON_TOKEN_END,
+    LUA_CJSON_TOKEN_ERROR
+} lua_cjson_token_type;
+
+typedef struct {
+    lua_cjson_token_type type;
+    int                  index;         // 0 based position of the token in the json data
+    const char*          string;        // The decoded string (valid until the next token), or the error message
+    size_t               string_len;
+    double               number;
+    int                  boolean;
+} lua_cjson_token;
+
+typedef struct lua_cjson_tokenizer lua_cjson_tokenizer;
+
+// The json data must be null terminated, like Lua strings are. Returns 0 if the data isn't UTF-8
+lua_cjson_tokenizer* lua_cjson_tokenizer_new(const char* json_string, size_t json_len);
+void lua_cjson_tokenizer_delete(lua_cjson_tokenizer* tokenizer);
+void lua_cjson_tokenizer_next(lua_cjson_tokenizer* tokenizer, lua_cjson_token* token);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DM_LUA_CJSON_H
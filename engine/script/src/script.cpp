@@ -34,6 +34,9 @@
 #include "script_bitop.h"
 #include "script_timer.h"
 #include "script_extensions.h"
+#include "script_gc.h"
+#include "script_allocator.h"
+#include "script_profiler.h"
 
 extern "C"
 {
@@ -78,19 +81,36 @@ namespace dmScript
         context->m_Modules.SetCapacity(127, 256);
         context->m_PathToModule.SetCapacity(127, 256);
         context->m_HashInstances.SetCapacity(443, 256);
+        context->m_HashStringCached.SetCapacity(HASH_STRING_CACHE_SIZE / 2 + 1, HASH_STRING_CACHE_SIZE);
         context->m_ScriptExtensions.SetCapacity(8);
         context->m_ConfigFile = params.m_ConfigFile;
         context->m_ResourceFactory = params.m_Factory;
         context->m_GraphicsContext = params.m_GraphicsContext;
-        context->m_LuaState = lua_open();
+        context->m_JobThread = params.m_JobThread;
+        context->m_SeededWorldCount = 0;
+        uint32_t memory_limit = params.m_ConfigFile ? (uint32_t)dmMath::Clamp(dmConfigFile::GetInt(params.m_ConfigFile, "script.memory_limit", 0), 0, 4095) : 0;
+        context->m_LuaAllocator = NewLuaAllocator(memory_limit * 1024u * 1024u);
+        context->m_LuaState = lua_newstate(LuaAlloc, context->m_LuaAllocator);
+        if (!context->m_LuaState)
+        {
+            // Custom allocators aren't supported by LuaJIT on 64 bit targets without GC64
+            DeleteLuaAllocator(context->m_LuaAllocator);
+            context->m_LuaAllocator = 0;
+            context->m_LuaState = lua_open();
+        }
         context->m_ContextTableRef = LUA_NOREF;
+        context->m_HashStringCacheRef = LUA_NOREF;
+        memset(&context->m_GC, 0, sizeof(context->m_GC));
         return context;
     }
 
     void DeleteContext(HContext context)
     {
         ClearModules(context);
+        FinalizeLuaProfiler(context->m_LuaState);
         lua_close(context->m_LuaState);
+        if (context->m_LuaAllocator)
+            DeleteLuaAllocator(context->m_LuaAllocator);
         delete context;
     }
 
@@ -99,14 +119,36 @@ namespace dmScript
 
 #define RANDOM_SEED "__random_seed"
 
-    static int Lua_Math_Random (lua_State *L)
+    static const uint32_t RANDOM_SEED_HASH = dmHashBufferNoReverse32(RANDOM_SEED, sizeof(RANDOM_SEED) - 1);
+
+    // The random state of the script world of the current instance, if it has one, otherwise the global state
+    static uint32_t* GetRandomSeed(lua_State* L)
     {
-        // More or less from lmathlib.c
-        DM_LUA_STACK_CHECK(L, 1);
+        if (GetScriptContext(L)->m_SeededWorldCount > 0)
+        {
+            lua_pushinteger(L, (lua_Integer)RANDOM_SEED_HASH);
+            GetInstanceContextValue(L);
+            if (lua_type(L, -1) == LUA_TLIGHTUSERDATA)
+            {
+                uint32_t* seed = (uint32_t*) lua_touserdata(L, -1);
+                lua_pop(L, 1);
+                return seed;
+            }
+            lua_pop(L, 1);
+        }
 
         lua_getglobal(L, RANDOM_SEED);
         uint32_t* seed = (uint32_t*) lua_touserdata(L, -1);
         lua_pop(L, 1);
+        return seed;
+    }
+
+    static int Lua_Math_Random (lua_State *L)
+    {
+        // More or less from lmathlib.c
+        DM_LUA_STACK_CHECK(L, 1);
+
+        uint32_t* seed = GetRandomSeed(L);
 
         // NOTE: + 1 changed from original lua implementation
         // Otherwise upper + 1 when dmMath::Rand() returns DM_RAND_MAX
@@ -140,12 +182,10 @@ namespace dmScript
     {
         // More or less from lmathlib.c
         DM_LUA_STACK_CHECK(L, 0);
-        lua_getglobal(L, RANDOM_SEED);
-        uint32_t* seed = (uint32_t*) lua_touserdata(L, -1);
+        uint32_t* seed = GetRandomSeed(L);
         *seed = luaL_checkint(L, 1);
         // discard first value to avoid repeated values
         dmMath::Rand(seed);
-        lua_pop(L, 1);
         return 0;
     }
 
@@ -206,7 +246,11 @@ namespace dmScript
         lua_newtable(L);
         context->m_ContextTableRef = Ref(L, LUA_REGISTRYINDEX);
 
+        lua_newtable(L);
+        context->m_HashStringCacheRef = Ref(L, LUA_REGISTRYINDEX);
+
         InitializeTimer(context);
+        InitializeGC(context);
         InitializeExtensions(context);
 
         for (HScriptExtension* l = context->m_ScriptExtensions.Begin(); l != context->m_ScriptExtensions.End(); ++l)
@@ -242,6 +286,8 @@ namespace dmScript
     {
         lua_State* L = context->m_LuaState;
 
+        FinalizeSys(context);
+
         for (HScriptExtension* l = context->m_ScriptExtensions.Begin(); l != context->m_ScriptExtensions.End(); ++l)
         {
             if ((*l)->Finalize != 0x0)
@@ -255,6 +301,7 @@ namespace dmScript
         free(seed);
         lua_pop(L, 1);
 
+        Unref(L, LUA_REGISTRYINDEX, context->m_HashStringCacheRef);
         Unref(L, LUA_REGISTRYINDEX, context->m_ContextTableRef);
     }
 
@@ -1045,6 +1092,8 @@ namespace dmScript
     {
         HContext m_Context;
         int      m_WorldContextTableRef;
+        uint32_t m_RandomSeed;          // The math.random state of the world, see SetScriptWorldRandomSeed
+        uint8_t  m_SeededRandom : 1;
     };
 
     HContext GetScriptWorldContext(HScriptWorld script_world)
@@ -1099,6 +1148,8 @@ namespace dmScript
         HScriptWorld script_world = (ScriptWorld*)malloc(sizeof(ScriptWorld));
         assert(script_world != 0x0);
         script_world->m_Context = context;
+        script_world->m_RandomSeed = 0;
+        script_world->m_SeededRandom = 0;
         lua_State* L = script_world->m_Context->m_LuaState;
         lua_newtable(L);
         script_world->m_WorldContextTableRef = Ref(L, LUA_REGISTRYINDEX);
@@ -1126,9 +1177,27 @@ namespace dmScript
         lua_State* L = script_world->m_Context->m_LuaState;
         Unref(L, LUA_REGISTRYINDEX, script_world->m_WorldContextTableRef);
 
+        if (script_world->m_SeededRandom)
+        {
+            context->m_SeededWorldCount--;
+        }
+
         free(script_world);
     }
 
+    void SetScriptWorldRandomSeed(HScriptWorld script_world, uint32_t seed)
+    {
+        assert(script_world != 0x0);
+        if (!script_world->m_SeededRandom)
+        {
+            script_world->m_SeededRandom = 1;
+            script_world->m_Context->m_SeededWorldCount++;
+        }
+        script_world->m_RandomSeed = seed;
+        // discard first value to avoid repeated values, like math.randomseed
+        dmMath::Rand(&script_world->m_RandomSeed);
+    }
+
     void UpdateScriptWorld(HScriptWorld script_world, float dt)
     {
         if (script_world == 0x0)
@@ -1168,6 +1237,13 @@ namespace dmScript
             return;
         }
         HContext context = GetScriptWorldContext(script_world);
+        if (script_world->m_SeededRandom)
+        {
+            lua_State* L = context->m_LuaState;
+            lua_pushinteger(L, (lua_Integer)RANDOM_SEED_HASH);
+            lua_pushlightuserdata(L, &script_world->m_RandomSeed);
+            SetInstanceContextValue(L);
+        }
         for (HScriptExtension* l = context->m_ScriptExtensions.Begin(); l != context->m_ScriptExtensions.End(); ++l)
         {
             if ((*l)->InitializeScriptInstance != 0x0)
@@ -1473,6 +1549,14 @@ namespace dmScript
         return (uint32_t)lua_gc(L, LUA_GCCOUNT, 0);
     }
 
+    bool GetLuaMemoryStats(HContext context, LuaMemoryStats* stats)
+    {
+        if (!context->m_LuaAllocator)
+            return false;
+        GetLuaAllocatorStats(context->m_LuaAllocator, stats);
+        return true;
+    }
+
     LuaStackCheck::LuaStackCheck(lua_State* L, int diff, const char* filename, int linenumber) : m_L(L), m_Filename(filename), m_Linenumber(linenumber), m_Top(lua_gettop(L)), m_Diff(diff)
     {
         if (!(m_Diff >= -m_Top)) {
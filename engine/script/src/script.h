@@ -19,8 +19,10 @@
 #include <dmsdk/script/script.h>
 #include <dmsdk/graphics/graphics.h>
 
+#include <dlib/buffer.h>
 #include <dlib/vmath.h>
 #include <dlib/hash.h>
+#include <dlib/job_thread.h>
 #include <dlib/message.h>
 #include <dlib/configfile.h>
 #include <dlib/log.h>
@@ -87,6 +89,8 @@ namespace dmScript
         dmConfigFile::HConfig m_ConfigFile;
         dmResource::HFactory  m_Factory;
         dmGraphics::HContext  m_GraphicsContext;
+        /// Used by sys.save_async. If 0, the files are written on the calling thread
+        dmJobThread::HContext m_JobThread;
     };
 
     /**
@@ -266,8 +270,31 @@ namespace dmScript
      */
     void PushDDF(lua_State*L, const dmDDF::Descriptor* descriptor, const char* data);
 
+    /**
+     * Serialize a range of stack values to a buffer, as a table with the values at the keys 1..count.
+     * The buffer is read with PushTable, like one written by CheckTable.
+     * @param L Lua state
+     * @param buffer Buffer that will be written to (must be DM_ALIGNED(16))
+     * @param buffer_size Buffer size
+     * @param index Index of the first value
+     * @param count Number of values
+     * @return Number of bytes used in the buffer
+     */
+    uint32_t CheckTableArgs(lua_State* L, char* buffer, uint32_t buffer_size, int index, int count);
+
     void RegisterDDFDecoder(void* descriptor, MessageDecoder decoder);
 
+    /**
+     * Pushes a buffer decoded by json.decode_stream. The buffer is owned by Lua
+     */
+    typedef void (*JsonBufferPusher)(lua_State* L, dmBuffer::HBuffer buffer);
+
+    /**
+     * Registers the function that pushes the buffers decoded by json.decode_stream.
+     * The buffers option of json.decode_stream is only available once it is registered.
+     */
+    void RegisterJsonBufferPusher(JsonBufferPusher pusher);
+
     /**
      * Removes a hash value from the currently known hashes.
      * @param L Lua state
@@ -387,6 +414,17 @@ namespace dmScript
      */
     void DeleteScriptWorld(HScriptWorld script_world);
 
+    /**
+     * Gives the script world its own math.random state, seeded with the given seed.
+     * The instances that are initialized after this call use the state of the world
+     * instead of the global one, so that each world gets the same sequence of numbers
+     * regardless of what the other worlds do.
+     *
+     * @param script_world the script world created with NewScriptWorld
+     * @param seed the seed
+     */
+    void SetScriptWorldRandomSeed(HScriptWorld script_world, uint32_t seed);
+
     /**
      * Update the script extensions
      *
@@ -533,7 +571,8 @@ namespace dmScript
      * @param context script context
      * @param source lua script to load
      * @param script_name script-name. Should be in lua require-format, i.e. syntax use for the require statement. e.g. x.y.z without any extension
-     * @param resource the resource will be released throught the resource system at finalization
+     * @param resource the resource will be released throught the resource system at finalization.
+     *                 If set, the source must stay valid as long as the resource, and it is used without being copied.
      * @param path_hash hashed path of the originating resource
      * @return RESULT_OK on success
      */
@@ -542,7 +581,8 @@ namespace dmScript
     /**
      * Reload loaded module
      * @param context script context
-     * @param source lua source to load
+     * @param source lua source to load. If the module was added with a resource, the source must be owned by
+     *               the (reloaded) resource, see AddModule
      * @param path_hash hashed path, see AddModule
      * @return RESULT_OK on success
      */
@@ -641,6 +681,113 @@ namespace dmScript
     */
     uint32_t GetLuaGCCount(lua_State* L);
 
+    /** Memory use of the Lua allocator of a context
+    */
+    struct LuaMemoryStats
+    {
+        uint32_t m_Active;          //!< Bytes in use by Lua
+        uint32_t m_Reserved;        //!< Bytes allocated from the system, for the slabs of the small blocks and for the large blocks
+        uint32_t m_AllocationCount; //!< Number of allocations, including the reallocations that grow a block
+        uint32_t m_FailedCount;     //!< Number of allocations that failed, e.g. past the memory limit
+    };
+
+    /** Gets the memory use of the Lua allocator. The memory limit is read from "script.memory_limit"
+    * (in megabytes, 0 for no limit) in the project settings.
+    * @param context script context
+    * @param stats the memory use
+    * @return false if the Lua state uses the default allocator, which isn't supported on all LuaJIT targets
+    */
+    bool GetLuaMemoryStats(HContext context, LuaMemoryStats* stats);
+
+    /** Sets the max time per frame spent on garbage collection, which is initially read from
+    * "script.gc_frame_budget" (in milliseconds) in the project settings. While the budget is
+    * non zero, the automatic Lua collector is stopped, and the collection is done in StepGarbageCollector
+    * @param context script context
+    * @param budget max time per frame in microseconds, or 0 to let Lua collect automatically
+    */
+    void SetGarbageCollectorBudget(HContext context, uint32_t budget);
+
+    /** Runs the incremental garbage collector for at most the frame budget, or the slack if it is smaller.
+    * Called by the engine at the end of each frame. It also runs any requested full collection.
+    * @param context script context
+    * @param slack time left of the frame in microseconds
+    */
+    void StepGarbageCollector(HContext context, uint64_t slack);
+
+    /** Requests a full garbage collection, which is run by the next StepGarbageCollector
+    * @param context script context
+    */
+    void RequestGarbageCollection(HContext context);
+
+    enum LuaProfilerEntryType
+    {
+        LUA_PROFILER_ENTRY_FUNCTION = 0,    //!< The samples per function. The line is where the function is defined
+        LUA_PROFILER_ENTRY_LINE     = 1,    //!< The samples per source line
+    };
+
+    /** The samples aggregated for a function or a source line by the Lua sampling profiler
+    */
+    struct LuaProfilerEntry
+    {
+        const char* m_Source;       //!< Short source name, e.g. "main/player.script", or "[C]"
+        const char* m_Name;         //!< Function name, or "?" if it isn't known
+        uint32_t    m_Line;         //!< 0 if not known (e.g. C functions)
+        uint32_t    m_SelfSamples;  //!< Samples where it was running
+        uint32_t    m_TotalSamples; //!< Samples where it was anywhere on the call stack
+    };
+
+    /** Called for each entry, in the order they were first sampled
+    * @param ctx user context
+    * @param entry the entry. Only valid during the call
+    */
+    typedef void (*LuaProfilerEntryFn)(void* ctx, const LuaProfilerEntry* entry);
+
+    /** Called for each recorded call stack, oldest first
+    * @param ctx user context
+    * @param time time of the sample (dmTime::GetTime)
+    * @param functions indices of the function entries (see LuaProfilerEntryFn), starting with the running function
+    * @param depth number of functions
+    */
+    typedef void (*LuaProfilerStackFn)(void* ctx, uint64_t time, const uint32_t* functions, uint32_t depth);
+
+    /** Starts sampling the Lua call stack of a Lua state. It's sampled from a count hook (lua_sethook), at most
+    * once per interval. Any hook already set is restored when the profiler stops.
+    * The samples of a previous run are kept, until ResetLuaProfiler is called.
+    * Only one Lua state can be sampled at a time.
+    * @param L Lua state
+    * @param interval time between samples in microseconds
+    */
+    void StartLuaProfiler(lua_State* L, uint32_t interval);
+
+    /** Stops sampling, and logs the functions with the most samples to the profiler (dmProfile::LogText)
+    */
+    void StopLuaProfiler();
+
+    /** @return true if the Lua sampling profiler is running
+    */
+    bool IsLuaProfilerRunning();
+
+    /** Removes all the samples
+    */
+    void ResetLuaProfiler();
+
+    /** @return number of samples taken since the last reset
+    */
+    uint32_t GetLuaProfilerSampleCount();
+
+    /** Iterates the aggregated samples
+    * @param type the kind of entries
+    * @param fn called for each entry
+    * @param ctx user context
+    */
+    void IterateLuaProfilerEntries(LuaProfilerEntryType type, LuaProfilerEntryFn fn, void* ctx);
+
+    /** Iterates the most recent call stacks, kept in a ring buffer
+    * @param fn called for each call stack
+    * @param ctx user context
+    */
+    void IterateLuaProfilerStacks(LuaProfilerStackFn fn, void* ctx);
+
 // DEPRECATED
 // I really don't like this callback setup (mistake on my part). It's clunky.
 // Perhaps better to have a lambda function? (now that all compilers support C++11) /MAWE
@@ -0,0 +1,242 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "script_allocator.h"
+#include "script.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+namespace dmScript
+{
+    /*
+        Lua passes the old size of a block to the allocator, so the blocks need no header.
+
+        The small blocks are allocated from a free list per size class. The free lists are refilled
+        from slabs, which are only returned to the system when the allocator is deleted, as the Lua
+        heap tends to go back to the same size after each collection. Larger blocks are allocated with
+        malloc/realloc/free.
+
+        The Lua GC can't run from within the allocator, so when the memory in use comes close to the
+        memory limit, a full collection is requested instead, which is run by the next StepGarbageCollector.
+        Allocations past the limit fail, and Lua raises a memory error.
+    */
+
+    static const uint32_t SIZE_CLASS_GRANULARITY = 16;
+    static const uint32_t MAX_SMALL_SIZE = 256;
+    static const uint32_t SLAB_SIZE = 16 * 1024;
+    static const uint32_t SIZE_CLASS_COUNT = 12;
+    static const uint32_t SIZE_CLASSES[SIZE_CLASS_COUNT] = { 16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256 };
+    // Collect when the memory in use has reached 7/8 of the limit
+    static const uint32_t COLLECT_LIMIT_NUMERATOR = 7;
+    static const uint32_t COLLECT_LIMIT_DENOMINATOR = 8;
+
+    struct FreeBlock
+    {
+        FreeBlock* m_Next;
+    };
+
+    struct Slab
+    {
+        Slab*       m_Next;
+        // Keeps the blocks 16 byte aligned
+        uint8_t     m_Padding[SIZE_CLASS_GRANULARITY - sizeof(Slab*)];
+    };
+
+    struct LuaAllocator
+    {
+        FreeBlock*          m_FreeLists[SIZE_CLASS_COUNT];
+        // The unused part of the last slab, which is shared by all size classes
+        uint8_t*            m_SlabCursor;
+        uint8_t*            m_SlabEnd;
+        Slab*               m_Slabs;
+        LuaMemoryStats   m_Stats;
+        uint32_t            m_MemoryLimit;
+        uint32_t            m_CollectLimit;
+        uint8_t             m_CollectRequested:1;
+    };
+
+    // Maps (size - 1) / SIZE_CLASS_GRANULARITY to the size class
+    static const uint8_t SIZE_CLASS_LOOKUP[MAX_SMALL_SIZE / SIZE_CLASS_GRANULARITY] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11, 11 };
+
+    static inline uint32_t GetSizeClass(size_t size)
+    {
+        return SIZE_CLASS_LOOKUP[(size - 1) / SIZE_CLASS_GRANULARITY];
+    }
+
+    LuaAllocator* NewLuaAllocator(uint32_t memory_limit)
+    {
+        LuaAllocator* allocator = (LuaAllocator*)malloc(sizeof(LuaAllocator));
+        memset(allocator, 0, sizeof(LuaAllocator));
+        allocator->m_MemoryLimit = memory_limit;
+        allocator->m_CollectLimit = (uint32_t)(((uint64_t)memory_limit * COLLECT_LIMIT_NUMERATOR) / COLLECT_LIMIT_DENOMINATOR);
+        return allocator;
+    }
+
+    void DeleteLuaAllocator(LuaAllocator* allocator)
+    {
+        Slab* slab = allocator->m_Slabs;
+        while (slab)
+        {
+            Slab* next = slab->m_Next;
+            free(slab);
+            slab = next;
+        }
+        free(allocator);
+    }
+
+    static void* AllocSmall(LuaAllocator* allocator, uint32_t size_class)
+    {
+        FreeBlock* block = allocator->m_FreeLists[size_class];
+        if (block)
+        {
+            allocator->m_FreeLists[size_class] = block->m_Next;
+            return block;
+        }
+
+        uint32_t size = SIZE_CLASSES[size_class];
+        if (allocator->m_SlabCursor + size > allocator->m_SlabEnd)
+        {
+            // Hand out the rest of the slab to the smaller size classes, so that nothing is wasted
+            for (int32_t i = (int32_t)size_class - 1; i >= 0; --i)
+            {
+                while (allocator->m_SlabCursor + SIZE_CLASSES[i] <= allocator->m_SlabEnd)
+                {
+                    FreeBlock* rest = (FreeBlock*)allocator->m_SlabCursor;
+                    rest->m_Next = allocator->m_FreeLists[i];
+                    allocator->m_FreeLists[i] = rest;
+                    allocator->m_SlabCursor += SIZE_CLASSES[i];
+                }
+            }
+
+            Slab* slab = (Slab*)malloc(SLAB_SIZE);
+            if (!slab)
+                return 0;
+            slab->m_Next = allocator->m_Slabs;
+            allocator->m_Slabs = slab;
+            allocator->m_SlabCursor = (uint8_t*)(slab + 1);
+            allocator->m_SlabEnd = (uint8_t*)slab + SLAB_SIZE;
+            allocator->m_Stats.m_Reserved += SLAB_SIZE;
+        }
+
+        void* memory = allocator->m_SlabCursor;
+        allocator->m_SlabCursor += size;
+        return memory;
+    }
+
+    static inline void FreeSmall(LuaAllocator* allocator, void* memory, uint32_t size_class)
+    {
+        FreeBlock* block = (FreeBlock*)memory;
+        block->m_Next = allocator->m_FreeLists[size_class];
+        allocator->m_FreeLists[size_class] = block;
+    }
+
+    static void* Realloc(LuaAllocator* allocator, void* ptr, size_t osize, size_t nsize)
+    {
+        bool old_small = osize <= MAX_SMALL_SIZE;
+        bool new_small = nsize <= MAX_SMALL_SIZE;
+
+        if (nsize == 0)
+        {
+            if (!ptr)
+                return 0;
+            if (old_small)
+                FreeSmall(allocator, ptr, GetSizeClass(osize));
+            else
+            {
+                free(ptr);
+                allocator->m_Stats.m_Reserved -= (uint32_t)osize;
+            }
+            return 0;
+        }
+
+        if (!old_small && !new_small)
+        {
+            void* memory = realloc(ptr, nsize);
+            if (memory)
+                allocator->m_Stats.m_Reserved += (uint32_t)nsize - (uint32_t)osize;
+            return memory;
+        }
+
+        if (ptr && old_small && new_small && GetSizeClass(osize) == GetSizeClass(nsize))
+            return ptr;
+
+        void* memory;
+        if (new_small)
+        {
+            memory = AllocSmall(allocator, GetSizeClass(nsize));
+        }
+        else
+        {
+            memory = malloc(nsize);
+            if (memory)
+                allocator->m_Stats.m_Reserved += (uint32_t)nsize;
+        }
+
+        // The old block is kept if the allocation failed, as Lua expects
+        if (memory && ptr)
+        {
+            memcpy(memory, ptr, osize < nsize ? osize : nsize);
+            Realloc(allocator, ptr, osize, 0);
+        }
+        return memory;
+    }
+
+    void* LuaAlloc(void* ud, void* ptr, size_t osize, size_t nsize)
+    {
+        LuaAllocator* allocator = (LuaAllocator*)ud;
+        if (!ptr)
+            osize = 0;
+
+        LuaMemoryStats& stats = allocator->m_Stats;
+        if (nsize > osize && allocator->m_MemoryLimit != 0)
+        {
+            uint64_t active = (uint64_t)stats.m_Active + (nsize - osize);
+            if (active > allocator->m_MemoryLimit)
+            {
+                ++stats.m_FailedCount;
+                allocator->m_CollectRequested = 1;
+                return 0;
+            }
+            if (active > allocator->m_CollectLimit && stats.m_Active <= allocator->m_CollectLimit)
+                allocator->m_CollectRequested = 1;
+        }
+
+        void* memory = Realloc(allocator, ptr, osize, nsize);
+        if (memory || nsize == 0)
+        {
+            stats.m_Active += (uint32_t)nsize - (uint32_t)osize;
+            if (nsize > osize)
+                ++stats.m_AllocationCount;
+        }
+        else
+        {
+            ++stats.m_FailedCount;
+        }
+        return memory;
+    }
+
+    void GetLuaAllocatorStats(LuaAllocator* allocator, LuaMemoryStats* stats)
+    {
+        *stats = allocator->m_Stats;
+    }
+
+    bool TakeLuaAllocatorCollectRequest(LuaAllocator* allocator)
+    {
+        bool requested = allocator->m_CollectRequested;
+        allocator->m_CollectRequested = 0;
+        return requested;
+    }
+}
@@ -0,0 +1,50 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_SCRIPT_ALLOCATOR_H
+#define DM_SCRIPT_ALLOCATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace dmScript
+{
+    struct LuaAllocator;
+    struct LuaMemoryStats;
+
+    /**
+     * Creates the allocator of a Lua state
+     * @param memory_limit max bytes in use by the Lua state, or 0 for no limit
+     */
+    LuaAllocator* NewLuaAllocator(uint32_t memory_limit);
+
+    /**
+     * Deletes the allocator. Must be called after the Lua state is closed
+     */
+    void DeleteLuaAllocator(LuaAllocator* allocator);
+
+    /**
+     * The lua_Alloc function, with the allocator as the user data
+     */
+    void* LuaAlloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+    void GetLuaAllocatorStats(LuaAllocator* allocator, LuaMemoryStats* stats);
+
+    /**
+     * Returns true once, after the memory in use has come close to the memory limit, to request a full collection
+     */
+    bool TakeLuaAllocatorCollectRequest(LuaAllocator* allocator);
+}
+
+#endif // DM_SCRIPT_ALLOCATOR_H
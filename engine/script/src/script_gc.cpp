@@ -0,0 +1,156 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "script_gc.h"
+
+#include <dlib/configfile.h>
+#include <dlib/math.h>
+#include <dlib/profile.h>
+#include <dlib/time.h>
+
+#include "script.h"
+#include "script_private.h"
+#include "script_allocator.h"
+
+extern "C"
+{
+#include <lua/lua.h>
+}
+
+DM_PROPERTY_EXTERN(rmtp_Script);
+DM_PROPERTY_U32(rmtp_LuaGCSteps, 0, FrameReset, "# gc steps", &rmtp_Script);
+
+namespace dmScript
+{
+    /*
+        When a frame budget is set, Lua's automatic collector is stopped, and the engine runs the
+        incremental collector at the end of each frame instead, in the time that is left of the frame.
+
+        A cycle is started once the memory in use has grown past GC_START_PERCENT of what was in use
+        after the previous cycle. If the frames don't have enough slack to keep up, and the memory grows
+        past GC_FORCE_PERCENT (Lua's default pause), the collector is paced by the allocations, as Lua
+        would have done on its own, regardless of the budget.
+    */
+
+    static const uint32_t GC_START_PERCENT = 125;
+    static const uint32_t GC_FORCE_PERCENT = 200;
+    static const uint32_t GC_MIN_STEP_SIZE = 16;    // KB
+    static const uint32_t GC_MAX_STEP_SIZE = 1024;  // KB
+    static const uint32_t GC_MIN_ESTIMATE = 256;    // KB. Avoids collecting too often while the heap is small
+
+    static void StopCollector(lua_State* L, GCState& gc)
+    {
+        // Stepping or collecting restarts the automatic collector, so it's stopped again afterwards
+        lua_gc(L, LUA_GCSTOP, 0);
+        gc.m_LastCount = (uint32_t)lua_gc(L, LUA_GCCOUNT, 0);
+    }
+
+    static void EndCycle(lua_State* L, GCState& gc)
+    {
+        gc.m_Estimate = dmMath::Max((uint32_t)lua_gc(L, LUA_GCCOUNT, 0), GC_MIN_ESTIMATE);
+        gc.m_Debt = 0;
+        gc.m_InCycle = 0;
+    }
+
+    void InitializeGC(HContext context)
+    {
+        float budget = context->m_ConfigFile ? dmConfigFile::GetFloat(context->m_ConfigFile, "script.gc_frame_budget", 0.0f) : 0.0f;
+        SetGarbageCollectorBudget(context, (uint32_t)(dmMath::Max(budget, 0.0f) * 1000.0f));
+    }
+
+    void SetGarbageCollectorBudget(HContext context, uint32_t budget)
+    {
+        lua_State* L = context->m_LuaState;
+        GCState& gc = context->m_GC;
+
+        if (budget == 0)
+        {
+            if (gc.m_FrameBudget != 0)
+                lua_gc(L, LUA_GCRESTART, 0);
+            gc.m_FrameBudget = 0;
+            return;
+        }
+
+        if (gc.m_FrameBudget == 0)
+        {
+            EndCycle(L, gc);
+            StopCollector(L, gc);
+        }
+        gc.m_FrameBudget = budget;
+    }
+
+    void RequestGarbageCollection(HContext context)
+    {
+        context->m_GC.m_CollectRequested = 1;
+    }
+
+    void StepGarbageCollector(HContext context, uint64_t slack)
+    {
+        lua_State* L = context->m_LuaState;
+        GCState& gc = context->m_GC;
+
+        // Taken first, so that the request isn't left for the next frame
+        bool memory_low = context->m_LuaAllocator && TakeLuaAllocatorCollectRequest(context->m_LuaAllocator);
+        if (gc.m_CollectRequested || memory_low)
+        {
+            DM_PROFILE("LuaFullGC");
+            gc.m_CollectRequested = 0;
+            lua_gc(L, LUA_GCCOLLECT, 0);
+            if (gc.m_FrameBudget != 0)
+            {
+                EndCycle(L, gc);
+                StopCollector(L, gc);
+            }
+            return;
+        }
+
+        if (gc.m_FrameBudget == 0)
+            return;
+
+        DM_PROFILE("LuaGC");
+
+        // As the automatic collector is stopped, the growth since the last step is all new allocations
+        uint32_t count = (uint32_t)lua_gc(L, LUA_GCCOUNT, 0);
+        uint32_t allocated = count > gc.m_LastCount ? count - gc.m_LastCount : 0;
+
+        bool force = count * 100 >= gc.m_Estimate * GC_FORCE_PERCENT;
+        if (!gc.m_InCycle && !force && count * 100 < gc.m_Estimate * GC_START_PERCENT)
+        {
+            gc.m_LastCount = count;
+            return;
+        }
+        gc.m_InCycle = 1;
+        gc.m_Debt += allocated;
+
+        // Scale the steps with the allocation rate, so that a frame's worth of allocations is paid off in a few steps
+        uint32_t step_size = dmMath::Clamp(allocated / 4, GC_MIN_STEP_SIZE, GC_MAX_STEP_SIZE);
+
+        uint64_t budget = dmMath::Min(slack, (uint64_t)gc.m_FrameBudget);
+        uint64_t start = dmTime::GetTime();
+        uint32_t steps = 0;
+        while ((force && gc.m_Debt > 0) || dmTime::GetTime() - start < budget)
+        {
+            ++steps;
+            if (lua_gc(L, LUA_GCSTEP, step_size))
+            {
+                EndCycle(L, gc);
+                break;
+            }
+            gc.m_Debt -= dmMath::Min(gc.m_Debt, step_size);
+        }
+
+        StopCollector(L, gc);
+        DM_PROPERTY_ADD_U32(rmtp_LuaGCSteps, steps);
+    }
+}
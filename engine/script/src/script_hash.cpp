@@ -54,6 +54,13 @@ namespace dmScript
         return (dmhash_t*)dmScript::ToUserType(L, index, SCRIPT_HASH_TYPE_HASH);
     }
 
+    static void ClearHashStringCache(lua_State* L, HContext context)
+    {
+        lua_newtable(L);
+        lua_rawseti(L, LUA_REGISTRYINDEX, context->m_HashStringCacheRef);
+        context->m_HashStringCached.Clear();
+    }
+
     /*# hashes a string
      * All ids in the engine are represented as hashes, so a string needs to be hashed
      * before it can be compared with an id.
@@ -77,6 +84,46 @@ namespace dmScript
     {
         int top = lua_gettop(L);
 
+        // The hashes of strings are cached in a table keyed by the string. Lua strings are interned,
+        // so a lookup doesn't touch the characters, and the string isn't rehashed or registered for
+        // reverse hashing again.
+        if (lua_type(L, 1) == LUA_TSTRING)
+        {
+            HContext context = dmScript::GetScriptContext(L);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, context->m_HashStringCacheRef);
+            // [-1] cache
+            lua_pushvalue(L, 1);
+            lua_rawget(L, -2);
+            // [-2] cache
+            // [-1] hash or nil
+            if (lua_isnil(L, -1))
+            {
+                lua_pop(L, 1);
+                dmhash_t hash = dmHashString64(lua_tostring(L, 1));
+                PushHash(L, hash);
+                // [-2] cache
+                // [-1] hash
+
+                // The cache is dropped when it is full, rather than growing with scripts hashing unique strings
+                if (context->m_HashStringCached.Full())
+                {
+                    ClearHashStringCache(L, context);
+                }
+                else
+                {
+                    lua_pushvalue(L, 1);
+                    lua_pushvalue(L, -2);
+                    lua_rawset(L, -4);
+                    context->m_HashStringCached.Put(hash, true);
+                }
+            }
+            lua_remove(L, -2);
+            // [-1] hash
+
+            assert(top + 1 == lua_gettop(L));
+            return 1;
+        }
+
         dmhash_t hash;
         dmhash_t* phash = ToHash(L, 1);
         if (phash != 0)
@@ -204,6 +251,14 @@ namespace dmScript
             luaL_unref(L, -1, *refp);
             lua_pop(L, 1);
             instances->Erase(hash);
+
+            // A later hash() of the same string must return the new instance of the hash, so that
+            // hashes still compare equal by identity. Released hashes are mostly game object ids,
+            // which are rarely created from strings in scripts.
+            if (context->m_HashStringCached.Get(hash) != 0x0)
+            {
+                ClearHashStringCache(L, context);
+            }
         }
 
         assert(top == lua_gettop(L));
@@ -17,7 +17,10 @@
 #include <stdint.h>
 #include <float.h>
 
+#include <dlib/array.h>
+#include <dlib/buffer.h>
 #include <dlib/dstrings.h>
+#include <dlib/math.h>
 
 #include "script.h"
 
@@ -31,6 +34,8 @@ extern "C"
     int lua_cjson_encode(lua_State* L, char** json_str, size_t* json_length);
 }
 
+#include "luacjson/lua_cjson.h"
+
 #include "script_json.h"
 #include "script_private.h"
 
@@ -171,15 +176,573 @@ namespace dmScript
         return 1;
     }
 
+    enum JsonStreamEvent
+    {
+        JSON_STREAM_EVENT_VALUE        = 0,
+        JSON_STREAM_EVENT_OBJECT_BEGIN = 1,
+        JSON_STREAM_EVENT_OBJECT_END   = 2,
+        JSON_STREAM_EVENT_ARRAY_BEGIN  = 3,
+        JSON_STREAM_EVENT_ARRAY_END    = 4,
+    };
+
+    // Same as the decode_max_depth of lua_cjson
+    static const uint32_t JSON_STREAM_MAX_DEPTH = 1000;
+
+    static const char* JSON_TOKEN_NAMES[] =
+    {
+        "T_OBJ_BEGIN",
+        "T_OBJ_END",
+        "T_ARR_BEGIN",
+        "T_ARR_END",
+        "T_STRING",
+        "T_NUMBER",
+        "T_BOOLEAN",
+        "T_NULL",
+        "T_COLON",
+        "T_COMMA",
+        "T_END",
+        "T_ERROR",
+    };
+
+    static JsonBufferPusher g_JsonBufferPusher = 0;
+
+    void RegisterJsonBufferPusher(JsonBufferPusher pusher)
+    {
+        g_JsonBufferPusher = pusher;
+    }
+
+    struct JsonStream
+    {
+        lua_State*           m_L;
+        lua_cjson_tokenizer* m_Tokenizer;
+        lua_cjson_token      m_Token;
+        int                  m_CallbackIndex;
+        int                  m_BuffersIndex;    // 0 if there is no buffers option
+        int                  m_ErrorIndex;      // Where an error raised by the callback is stored
+        uint32_t             m_Depth;
+        uint32_t             m_SkipDepth;       // The number of skipped objects and arrays we're in
+        uint32_t             m_NullAsUserdata:1;
+        uint32_t             m_CallbackFailed:1;
+        uint32_t             m_InvalidBufferType:1;
+        char                 m_Error[128];
+    };
+
+    static void JsonStreamNext(JsonStream* stream)
+    {
+        lua_cjson_tokenizer_next(stream->m_Tokenizer, &stream->m_Token);
+    }
+
+    static bool JsonStreamParseError(JsonStream* stream, const char* expected)
+    {
+        const lua_cjson_token& token = stream->m_Token;
+        const char* found = token.type == LUA_CJSON_TOKEN_ERROR ? token.string : JSON_TOKEN_NAMES[token.type];
+        dmSnPrintf(stream->m_Error, sizeof(stream->m_Error), "Expected %s but found %s at character %d", expected, found, token.index + 1);
+        return false;
+    }
+
+    // Calls the callback with the event, the key at key_index and the value at value_index (0 for nil).
+    // For the begin events, a false return value from the callback sets skip
+    static bool JsonStreamCallback(JsonStream* stream, JsonStreamEvent event, int key_index, int value_index, bool* skip)
+    {
+        if (stream->m_SkipDepth > 0)
+        {
+            return true;
+        }
+
+        lua_State* L = stream->m_L;
+        lua_pushvalue(L, stream->m_CallbackIndex);
+        lua_pushinteger(L, event);
+        if (key_index != 0)
+            lua_pushvalue(L, key_index);
+        else
+            lua_pushnil(L);
+        if (value_index != 0)
+            lua_pushvalue(L, value_index);
+        else
+            lua_pushnil(L);
+
+        if (lua_pcall(L, 3, 1, 0) != 0)
+        {
+            lua_replace(L, stream->m_ErrorIndex);
+            stream->m_CallbackFailed = 1;
+            return false;
+        }
+        if (skip != 0)
+        {
+            *skip = lua_isboolean(L, -1) && !lua_toboolean(L, -1);
+        }
+        lua_pop(L, 1);
+        return true;
+    }
+
+    static bool JsonStreamDescend(JsonStream* stream)
+    {
+        if (++stream->m_Depth > JSON_STREAM_MAX_DEPTH || !lua_checkstack(stream->m_L, 8))
+        {
+            dmSnPrintf(stream->m_Error, sizeof(stream->m_Error), "Found too many nested data structures (%u) at character %d", stream->m_Depth, stream->m_Token.index + 1);
+            return false;
+        }
+        return true;
+    }
+
+    static void StoreJsonNumber(uint8_t* out, dmBuffer::ValueType type, double value)
+    {
+        switch (type)
+        {
+            case dmBuffer::VALUE_TYPE_UINT8:    *(uint8_t*)out = (uint8_t)value; break;
+            case dmBuffer::VALUE_TYPE_UINT16:   *(uint16_t*)out = (uint16_t)value; break;
+            case dmBuffer::VALUE_TYPE_UINT32:   *(uint32_t*)out = (uint32_t)value; break;
+            case dmBuffer::VALUE_TYPE_UINT64:   *(uint64_t*)out = (uint64_t)value; break;
+            case dmBuffer::VALUE_TYPE_INT8:     *(int8_t*)out = (int8_t)value; break;
+            case dmBuffer::VALUE_TYPE_INT16:    *(int16_t*)out = (int16_t)value; break;
+            case dmBuffer::VALUE_TYPE_INT32:    *(int32_t*)out = (int32_t)value; break;
+            case dmBuffer::VALUE_TYPE_INT64:    *(int64_t*)out = (int64_t)value; break;
+            case dmBuffer::VALUE_TYPE_FLOAT32:  *(float*)out = (float)value; break;
+            default: assert(false);
+        }
+    }
+
+    // Looks up the key in the buffers option. The current token is the beginning of the array
+    static bool GetJsonStreamBufferType(JsonStream* stream, int key_index, dmBuffer::ValueType* type, uint32_t* components)
+    {
+        lua_State* L = stream->m_L;
+        if (stream->m_BuffersIndex == 0 || key_index == 0 || lua_type(L, key_index) != LUA_TSTRING)
+        {
+            return false;
+        }
+
+        lua_pushvalue(L, key_index);
+        lua_rawget(L, stream->m_BuffersIndex);
+        bool found = !lua_isnil(L, -1);
+        if (lua_istable(L, -1))
+        {
+            lua_getfield(L, -1, "type");
+            *type = (dmBuffer::ValueType)lua_tointeger(L, -1);
+            lua_getfield(L, -2, "count");
+            *components = lua_isnil(L, -1) ? 1 : (uint32_t)lua_tointeger(L, -1);
+            lua_pop(L, 2);
+        }
+        else
+        {
+            *type = (dmBuffer::ValueType)lua_tointeger(L, -1);
+            *components = 1;
+        }
+        lua_pop(L, 1);
+        if (found && (*type < 0 || *type >= dmBuffer::MAX_VALUE_TYPE_COUNT || *components == 0 || *components > 255))
+        {
+            dmSnPrintf(stream->m_Error, sizeof(stream->m_Error), "Invalid buffer type for '%s'", lua_tostring(L, key_index));
+            stream->m_InvalidBufferType = 1;
+            return false;
+        }
+        return found;
+    }
+
+    static bool JsonStreamBuffer(JsonStream* stream, int key_index, dmBuffer::ValueType type, uint32_t components)
+    {
+        lua_State* L = stream->m_L;
+        const uint32_t value_size = dmBuffer::GetSizeForValueType(type);
+
+        dmArray<uint8_t> values;
+        uint32_t count = 0;
+        JsonStreamNext(stream);
+        if (stream->m_Token.type != LUA_CJSON_TOKEN_ARR_END)
+        {
+            while (1)
+            {
+                if (stream->m_Token.type != LUA_CJSON_TOKEN_NUMBER)
+                {
+                    return JsonStreamParseError(stream, "number");
+                }
+                if (values.Remaining() < value_size)
+                {
+                    values.OffsetCapacity(dmMath::Max(values.Capacity(), 256u * value_size));
+                }
+                values.SetSize(values.Size() + value_size);
+                StoreJsonNumber(values.End() - value_size, type, stream->m_Token.number);
+                ++count;
+
+                JsonStreamNext(stream);
+                if (stream->m_Token.type == LUA_CJSON_TOKEN_ARR_END)
+                {
+                    break;
+                }
+                if (stream->m_Token.type != LUA_CJSON_TOKEN_COMMA)
+                {
+                    return JsonStreamParseError(stream, "comma or array end");
+                }
+                JsonStreamNext(stream);
+            }
+        }
+
+        if (count % components != 0)
+        {
+            dmSnPrintf(stream->m_Error, sizeof(stream->m_Error), "The number of values (%u) in '%s' is not a multiple of %u", count, lua_tostring(L, key_index), components);
+            return false;
+        }
+        if (stream->m_SkipDepth > 0)
+        {
+            return true;
+        }
+
+        dmhash_t stream_name = dmHashString64(lua_tostring(L, key_index));
+        dmBuffer::StreamDeclaration streams_decl[] = {
+            {stream_name, type, (uint8_t)components}
+        };
+        dmBuffer::HBuffer buffer = 0;
+        dmBuffer::Result r = dmBuffer::Create(count / components, streams_decl, 1, &buffer);
+        if (r != dmBuffer::RESULT_OK)
+        {
+            dmSnPrintf(stream->m_Error, sizeof(stream->m_Error), "Failed to create a buffer for '%s': %s", lua_tostring(L, key_index), dmBuffer::GetResultString(r));
+            return false;
+        }
+
+        uint8_t* data = 0;
+        uint32_t stride = 0;
+        dmBuffer::GetStream(buffer, stream_name, (void**)&data, 0, 0, &stride);
+        const uint32_t element_size = value_size * components;
+        for (uint32_t i = 0; i < count / components; ++i)
+        {
+            memcpy(data, values.Begin() + i * element_size, element_size);
+            data += stride * value_size;
+        }
+
+        g_JsonBufferPusher(L, buffer);
+        bool result = JsonStreamCallback(stream, JSON_STREAM_EVENT_VALUE, key_index, lua_gettop(L), 0);
+        if (result)
+        {
+            lua_pop(L, 1);
+        }
+        return result;
+    }
+
+    static bool JsonStreamValue(JsonStream* stream, int key_index);
+
+    static bool JsonStreamObject(JsonStream* stream, int key_index)
+    {
+        lua_State* L = stream->m_L;
+        if (!JsonStreamDescend(stream))
+        {
+            return false;
+        }
+
+        bool skip = false;
+        if (!JsonStreamCallback(stream, JSON_STREAM_EVENT_OBJECT_BEGIN, key_index, 0, &skip))
+        {
+            return false;
+        }
+        stream->m_SkipDepth += skip ? 1 : 0;
+
+        JsonStreamNext(stream);
+        if (stream->m_Token.type != LUA_CJSON_TOKEN_OBJ_END)
+        {
+            while (1)
+            {
+                if (stream->m_Token.type != LUA_CJSON_TOKEN_STRING)
+                {
+                    return JsonStreamParseError(stream, "object key string");
+                }
+                lua_pushlstring(L, stream->m_Token.string, stream->m_Token.string_len);
+                int value_key_index = lua_gettop(L);
+
+                JsonStreamNext(stream);
+                if (stream->m_Token.type != LUA_CJSON_TOKEN_COLON)
+                {
+                    return JsonStreamParseError(stream, "colon");
+                }
+                JsonStreamNext(stream);
+                if (!JsonStreamValue(stream, value_key_index))
+                {
+                    return false;
+                }
+                lua_pop(L, 1);
+
+                JsonStreamNext(stream);
+                if (stream->m_Token.type == LUA_CJSON_TOKEN_OBJ_END)
+                {
+                    break;
+                }
+                if (stream->m_Token.type != LUA_CJSON_TOKEN_COMMA)
+                {
+                    return JsonStreamParseError(stream, "comma or object end");
+                }
+                JsonStreamNext(stream);
+            }
+        }
+
+        stream->m_SkipDepth -= skip ? 1 : 0;
+        --stream->m_Depth;
+        return skip || JsonStreamCallback(stream, JSON_STREAM_EVENT_OBJECT_END, key_index, 0, 0);
+    }
+
+    static bool JsonStreamArray(JsonStream* stream, int key_index)
+    {
+        lua_State* L = stream->m_L;
+        if (!JsonStreamDescend(stream))
+        {
+            return false;
+        }
+
+        dmBuffer::ValueType type;
+        uint32_t components;
+        if (GetJsonStreamBufferType(stream, key_index, &type, &components))
+        {
+            --stream->m_Depth;
+            return JsonStreamBuffer(stream, key_index, type, components);
+        }
+        if (stream->m_InvalidBufferType)
+        {
+            return false;
+        }
+
+        bool skip = false;
+        if (!JsonStreamCallback(stream, JSON_STREAM_EVENT_ARRAY_BEGIN, key_index, 0, &skip))
+        {
+            return false;
+        }
+        stream->m_SkipDepth += skip ? 1 : 0;
+
+        JsonStreamNext(stream);
+        if (stream->m_Token.type != LUA_CJSON_TOKEN_ARR_END)
+        {
+            for (int i = 1; ; ++i)
+            {
+                lua_pushinteger(L, i);
+                if (!JsonStreamValue(stream, lua_gettop(L)))
+                {
+                    return false;
+                }
+                lua_pop(L, 1);
+
+                JsonStreamNext(stream);
+                if (stream->m_Token.type == LUA_CJSON_TOKEN_ARR_END)
+                {
+                    break;
+                }
+                if (stream->m_Token.type != LUA_CJSON_TOKEN_COMMA)
+                {
+                    return JsonStreamParseError(stream, "comma or array end");
+                }
+                JsonStreamNext(stream);
+            }
+        }
+
+        stream->m_SkipDepth -= skip ? 1 : 0;
+        --stream->m_Depth;
+        return skip || JsonStreamCallback(stream, JSON_STREAM_EVENT_ARRAY_END, key_index, 0, 0);
+    }
+
+    // The current token is the first token of the value
+    static bool JsonStreamValue(JsonStream* stream, int key_index)
+    {
+        lua_State* L = stream->m_L;
+        const lua_cjson_token& token = stream->m_Token;
+        switch (token.type)
+        {
+            case LUA_CJSON_TOKEN_OBJ_BEGIN:
+                return JsonStreamObject(stream, key_index);
+            case LUA_CJSON_TOKEN_ARR_BEGIN:
+                return JsonStreamArray(stream, key_index);
+            case LUA_CJSON_TOKEN_STRING:
+            case LUA_CJSON_TOKEN_NUMBER:
+            case LUA_CJSON_TOKEN_BOOLEAN:
+            case LUA_CJSON_TOKEN_NULL:
+                break;
+            default:
+                return JsonStreamParseError(stream, "value");
+        }
+
+        if (stream->m_SkipDepth > 0)
+        {
+            return true;
+        }
+
+        switch (token.type)
+        {
+            case LUA_CJSON_TOKEN_STRING:    lua_pushlstring(L, token.string, token.string_len); break;
+            case LUA_CJSON_TOKEN_NUMBER:    lua_pushnumber(L, token.number); break;
+            case LUA_CJSON_TOKEN_BOOLEAN:   lua_pushboolean(L, token.boolean); break;
+            default:
+                if (stream->m_NullAsUserdata)
+                    lua_pushlightuserdata(L, 0);
+                else
+                    lua_pushnil(L);
+                break;
+        }
+        bool result = JsonStreamCallback(stream, JSON_STREAM_EVENT_VALUE, key_index, lua_gettop(L), 0);
+        if (result)
+        {
+            lua_pop(L, 1);
+        }
+        return result;
+    }
+
+    /*# decode JSON from a string, without creating any tables
+     * Decode a string of JSON data, calling a function for each value, and at the beginning and end of each
+     * object and array. Unlike [ref:json.decode], no tables are created, which keeps the memory use and the
+     * garbage collection down for large documents.
+     *
+     * The callback gets the event, the key of the value in the parent object (a string), or its index in the parent
+     * array (a number), and the value for json.VALUE events. The key is nil for the root value.
+     * If the callback returns `false` for a json.OBJECT_BEGIN or json.ARRAY_BEGIN event, the content of the object or
+     * array is skipped, and there is no end event for it.
+     *
+     * Numeric arrays with a key listed in the `buffers` option are decoded straight into a buffer, which is passed
+     * in a json.VALUE event. The buffer has one stream named as the key. Arrays with `count` components, e.g.
+     * `[x, y, z, x, y, z, ...]` for `count = 3`, must have a multiple of `count` values.
+     *
+     * A Lua error is raised for syntax errors, and for errors raised by the callback.
+     *
+     * @name json.decode_stream
+     * @param json [type:string] json data
+     * @param callback [type:function(event, key, value)] function called for the values in the json data
+     *
+     * `event`
+     * : [type:constant] the event, one of
+     *
+     * - `json.VALUE`
+     * - `json.OBJECT_BEGIN`
+     * - `json.OBJECT_END`
+     * - `json.ARRAY_BEGIN`
+     * - `json.ARRAY_END`
+     *
+     * `key`
+     * : [type:string|number|nil] the key or index of the value
+     *
+     * `value`
+     * : [type:any] the value, for json.VALUE events
+     *
+     * @param [options] [type:table] table with decode options
+     *
+     * - [type:bool] `decode_null_as_userdata`: wether to decode a JSON null value as json.null or nil (default is nil)
+     * - [type:table] `buffers`: keys of numeric arrays to decode into buffers. Each value is a buffer value type, e.g. `buffer.VALUE_TYPE_FLOAT32`, or a table with `type` and `count`
+     *
+     * @examples
+     *
+     * Read the name of a level, and its heights into a buffer, skipping the enemies:
+     *
+     * ```lua
+     * local level = {}
+     * json.decode_stream(data, function(event, key, value)
+     *     if event == json.VALUE and key == "name" then
+     *         level.name = value
+     *     elseif event == json.VALUE and key == "heights" then
+     *         level.heights = value
+     *     elseif event == json.ARRAY_BEGIN and key == "enemies" then
+     *         return false
+     *     end
+     * end, { buffers = { heights = buffer.VALUE_TYPE_FLOAT32 } })
+     * ```
+     */
+    static int Json_DecodeStream(lua_State* L)
+    {
+        int top = lua_gettop(L);
+
+        size_t json_len;
+        const char* json = luaL_checklstring(L, 1, &json_len);
+        luaL_checktype(L, 2, LUA_TFUNCTION);
+
+        JsonStream stream;
+        memset(&stream, 0, sizeof(stream));
+        stream.m_L = L;
+        stream.m_CallbackIndex = 2;
+
+        if (top > 2 && !lua_isnil(L, 3))
+        {
+            luaL_checktype(L, 3, LUA_TTABLE);
+            lua_getfield(L, 3, "decode_null_as_userdata");
+            stream.m_NullAsUserdata = lua_toboolean(L, -1);
+            lua_pop(L, 1);
+
+            lua_getfield(L, 3, "buffers");
+            if (!lua_isnil(L, -1))
+            {
+                luaL_checktype(L, -1, LUA_TTABLE);
+                if (g_JsonBufferPusher == 0)
+                {
+                    return luaL_error(L, "json.decode_stream: buffers are not available");
+                }
+                stream.m_BuffersIndex = lua_gettop(L);
+            }
+            else
+            {
+                lua_pop(L, 1);
+            }
+        }
+        lua_pushnil(L);
+        stream.m_ErrorIndex = lua_gettop(L);
+
+        stream.m_Tokenizer = lua_cjson_tokenizer_new(json, json_len);
+        if (stream.m_Tokenizer == 0)
+        {
+            return luaL_error(L, "JSON parser does not support UTF-16 or UTF-32");
+        }
+
+        JsonStreamNext(&stream);
+        bool result = JsonStreamValue(&stream, 0);
+        if (result)
+        {
+            JsonStreamNext(&stream);
+            if (stream.m_Token.type != LUA_CJSON_TOKEN_END)
+            {
+                result = JsonStreamParseError(&stream, "the end");
+            }
+        }
+        lua_cjson_tokenizer_delete(stream.m_Tokenizer);
+
+        if (!result)
+        {
+            if (stream.m_CallbackFailed)
+            {
+                lua_pushvalue(L, stream.m_ErrorIndex);
+                return lua_error(L);
+            }
+            return luaL_error(L, "%s", stream.m_Error);
+        }
+
+        lua_settop(L, top);
+        return 0;
+    }
+
     /*# null
     * Represents the null primitive from a json file
     * @name json.null
     * @variable
     */
 
+    /*# value event
+    * A value, passed to the [ref:json.decode_stream] callback
+    * @name json.VALUE
+    * @constant
+    */
+
+    /*# object begin event
+    * The beginning of an object, passed to the [ref:json.decode_stream] callback
+    * @name json.OBJECT_BEGIN
+    * @constant
+    */
+
+    /*# object end event
+    * The end of an object, passed to the [ref:json.decode_stream] callback
+    * @name json.OBJECT_END
+    * @constant
+    */
+
+    /*# array begin event
+    * The beginning of an array, passed to the [ref:json.decode_stream] callback
+    * @name json.ARRAY_BEGIN
+    * @constant
+    */
+
+    /*# array end event
+    * The end of an array, passed to the [ref:json.decode_stream] callback
+    * @name json.ARRAY_END
+    * @constant
+    */
+
     static const luaL_reg ScriptJson_methods[] =
     {
         {"decode", Json_Decode},
+        {"decode_stream", Json_DecodeStream},
         {"encode", Json_Encode},
         {0, 0}
     };
@@ -195,6 +758,18 @@ namespace dmScript
         lua_pushlightuserdata(L, NULL);
         lua_setfield(L, -2, "null");
 
+#define SETCONSTANT(name) \
+        lua_pushinteger(L, (lua_Integer) JSON_STREAM_EVENT_##name); \
+        lua_setfield(L, -2, #name);\
+
+        SETCONSTANT(VALUE);
+        SETCONSTANT(OBJECT_BEGIN);
+        SETCONSTANT(OBJECT_END);
+        SETCONSTANT(ARRAY_BEGIN);
+        SETCONSTANT(ARRAY_END);
+
+#undef SETCONSTANT
+
         lua_pop(L, 2);
 
         assert(top == lua_gettop(L));
@@ -111,6 +111,23 @@ namespace dmScript
         return 1;
     }
 
+    // The module keeps a reference to the resource, so the (already patched) bytecode in the resource
+    // can be shared between all script contexts. Without a resource, we keep our own copy.
+    static void SetModuleScript(Module* module, const char* buf, uint32_t size)
+    {
+        if (module->m_Resource)
+        {
+            module->m_Script = buf;
+        }
+        else
+        {
+            char* script = (char*) realloc((void*)module->m_Script, size);
+            memcpy(script, buf, size);
+            module->m_Script = script;
+        }
+        module->m_ScriptSize = size;
+    }
+
     Result AddModule(HContext context, dmLuaDDF::LuaSource *source, const char *script_name, void* resource, dmhash_t path_hash)
     {
         dmhash_t module_hash = dmHashString64(script_name);
@@ -123,11 +140,10 @@ namespace dmScript
         uint32_t size;
         GetLuaSource(source, &buf, &size);
 
-        module.m_Script = (char*) malloc(size);
-        module.m_ScriptSize = size;
-        memcpy(module.m_Script, buf, size);
-
+        module.m_Script = 0;
         module.m_Resource = resource;
+        SetModuleScript(&module, buf, size);
+
         module.m_Filename = strdup(source->m_Filename);
 
         if (context->m_Modules.Full())
@@ -160,9 +176,7 @@ namespace dmScript
         uint32_t size;
         GetLuaSource(source, &buf, &size);
 
-        module->m_Script = (char*) realloc(module->m_Script, size);
-        module->m_ScriptSize = size;
-        memcpy(module->m_Script, buf, size);
+        SetModuleScript(module, buf, size);
 
         if (LuaLoadModule(L, buf, size, module->m_Name))
         {
@@ -190,7 +204,9 @@ namespace dmScript
         if (value->m_Resource != 0) {
             dmResource::Release((dmResource::HFactory)context, value->m_Resource);
         }
-        free(value->m_Script);
+        if (value->m_Resource == 0) {
+            free((void*)value->m_Script);
+        }
         free(value->m_Name);
         free(value->m_Filename);
     }
@@ -36,8 +36,18 @@ namespace dmScript
 {
 #define SCRIPT_LIB_NAME "msg"
 #define SCRIPT_TYPE_NAME_URL "url"
+#define SCRIPT_TYPE_NAME_PREPARED_MESSAGE "prepared_message"
 
     static uint32_t SCRIPT_URL_TYPE_HASH = 0;
+    static uint32_t SCRIPT_PREPARED_MESSAGE_TYPE_HASH = 0;
+
+    // A message with a resolved receiver and message id, created by msg.prepare
+    struct PreparedMessage
+    {
+        dmMessage::URL           m_Receiver;
+        dmhash_t                 m_MessageId;
+        const dmDDF::Descriptor* m_Descriptor;
+    };
 
 
     /*# Messaging API documentation
@@ -455,6 +465,25 @@ namespace dmScript
         return 1;
     }
 
+    static int PostMessage(lua_State* L, const dmMessage::URL* sender, const dmMessage::URL* receiver, dmhash_t message_id, const dmDDF::Descriptor* desc, const char* data, uint32_t data_size)
+    {
+        dmMessage::Result result = dmMessage::Post(sender, receiver, message_id, 0, (uintptr_t) desc, data, data_size, 0);
+        if (result == dmMessage::RESULT_SOCKET_NOT_FOUND)
+        {
+            char receiver_buffer[512];
+            UrlToString(receiver, receiver_buffer, sizeof(receiver_buffer));
+            char sender_buffer[512];
+            UrlToString(sender, sender_buffer, sizeof(sender_buffer));
+            return luaL_error(L, "Could not send message '%s' from '%s' to '%s'.", dmHashReverseSafe64(message_id), sender_buffer, receiver_buffer);
+        }
+        else if (result != dmMessage::RESULT_OK)
+        {
+            return luaL_error(L, "Could not send message to %s.", dmMessage::GetSocketName(receiver->m_Socket));
+        }
+
+        return 0;
+    }
+
     /*# posts a message to a receiving URL
      *
      * Post a message to a receiving URL. The most common case is to send messages
@@ -542,27 +571,169 @@ namespace dmScript
 
         assert(top == lua_gettop(L));
 
-        dmMessage::Result result = dmMessage::Post(&sender, &receiver, message_id, 0, (uintptr_t) desc, data, data_size, 0);
-        if (result == dmMessage::RESULT_SOCKET_NOT_FOUND)
+        return PostMessage(L, &sender, &receiver, message_id, desc, data, data_size);
+    }
+
+    /*# prepares a message for posting it many times
+     *
+     * Resolves the receiver and the message id once, and returns a prepared message which is
+     * posted with [ref:msg.post_prepared]. This avoids the url resolution and the hashing
+     * of the message id, which are done by each call to [ref:msg.post].
+     *
+     * The receiver is resolved when the message is prepared, so relative receivers are
+     * relative the script that prepares the message.
+     *
+     * @name msg.prepare
+     * @param receiver [type:string|url|hash] The receiver must be a string in URL-format, a URL object or a hashed string.
+     * @param message_id [type:string|hash] The id must be a string or a hashed string.
+     * @return message [type:prepared_message] the prepared message
+     * @examples
+     *
+     * ```lua
+     * function init(self)
+     *     self.hit = msg.prepare("/score#gui", "hit")
+     * end
+     *
+     * function on_message(self, message_id, message, sender)
+     *     if message_id == hash("collision_response") then
+     *         msg.post_prepared(self.hit, 10)
+     *     end
+     * end
+     * ```
+     */
+    int Msg_Prepare(lua_State* L)
+    {
+        int top = lua_gettop(L);
+        if (lua_isnil(L, 1))
         {
-            char receiver_buffer[512];
-            UrlToString(&receiver, receiver_buffer, sizeof(receiver_buffer));
-            char sender_buffer[512];
-            UrlToString(&sender, sender_buffer, sizeof(sender_buffer));
-            return luaL_error(L, "Could not send message '%s' from '%s' to '%s'.", dmHashReverseSafe64(message_id), sender_buffer, receiver_buffer);
+            return luaL_error(L, "The receiver shouldn't be `nil`");
         }
-        else if (result != dmMessage::RESULT_OK)
+
+        PreparedMessage prepared;
+        ResolveURL(L, 1, &prepared.m_Receiver, 0x0);
+
+        if (lua_isstring(L, 2))
         {
-            return luaL_error(L, "Could not send message to %s.", dmMessage::GetSocketName(receiver.m_Socket));
+            prepared.m_MessageId = dmHashString64(lua_tostring(L, 2));
+        }
+        else
+        {
+            prepared.m_MessageId = CheckHash(L, 2);
         }
 
-        return 0;
+        prepared.m_Descriptor = dmDDF::GetDescriptorFromHash(prepared.m_MessageId);
+        if (prepared.m_Descriptor != 0 && prepared.m_Descriptor->m_Size > MAX_MESSAGE_DATA_SIZE)
+        {
+            return luaL_error(L, "The message is too large to be sent (%d bytes, max is %d).", prepared.m_Descriptor->m_Size, MAX_MESSAGE_DATA_SIZE);
+        }
+
+        PreparedMessage* preparedp = (PreparedMessage*)lua_newuserdata(L, sizeof(PreparedMessage));
+        *preparedp = prepared;
+        luaL_getmetatable(L, SCRIPT_TYPE_NAME_PREPARED_MESSAGE);
+        lua_setmetatable(L, -2);
+
+        assert(top + 1 == lua_gettop(L));
+        return 1;
+    }
+
+    /*# posts a prepared message
+     *
+     * Posts a message prepared with [ref:msg.prepare].
+     *
+     * The message parameters are either a lua table, like for [ref:msg.post], or any number
+     * of values. The values are written directly to the message, without creating a table, and
+     * the receiver gets them in the message table at the keys 1, 2, 3 etc. Messages with built-in
+     * types, such as "enable", only take a table.
+     *
+     * [icon:attention] There is a 2 kilobyte limit to the message parameter size.
+     *
+     * @name msg.post_prepared
+     * @param message [type:prepared_message] the prepared message
+     * @param [...] [type:table|any] a lua table with message parameters, or the values to send
+     * @examples
+     *
+     * ```lua
+     * function init(self)
+     *     self.damage = msg.prepare("/player", "damage")
+     * end
+     *
+     * function update(self, dt)
+     *     msg.post_prepared(self.damage, 10, hash("fire"))
+     * end
+     * ```
+     *
+     * In the receiver:
+     *
+     * ```lua
+     * function on_message(self, message_id, message, sender)
+     *     if message_id == hash("damage") then
+     *         local amount, kind = message[1], message[2]
+     *     end
+     * end
+     * ```
+     */
+    int Msg_PostPrepared(lua_State* L)
+    {
+        int top = lua_gettop(L);
+        PreparedMessage* prepared = (PreparedMessage*)CheckUserType(L, 1, SCRIPT_PREPARED_MESSAGE_TYPE_HASH, 0);
+
+        dmMessage::URL sender;
+        dmMessage::ResetURL(&sender);
+        GetURL(L, &sender);
+
+        char DM_ALIGNED(16) data[MAX_MESSAGE_DATA_SIZE];
+        uint32_t data_size = 0;
+
+        const dmDDF::Descriptor* desc = prepared->m_Descriptor;
+        if (desc != 0)
+        {
+            if (top > 1)
+            {
+                luaL_checktype(L, 2, LUA_TTABLE);
+                lua_pushvalue(L, 2);
+            }
+            else
+            {
+                lua_newtable(L);
+            }
+            data_size = dmScript::CheckDDF(L, desc, data, MAX_MESSAGE_DATA_SIZE, -1);
+            lua_pop(L, 1);
+        }
+        else if (top == 2 && lua_istable(L, 2))
+        {
+            data_size = dmScript::CheckTable(L, data, MAX_MESSAGE_DATA_SIZE, 2);
+        }
+        else if (top > 1)
+        {
+            data_size = dmScript::CheckTableArgs(L, data, MAX_MESSAGE_DATA_SIZE, 2, top - 1);
+        }
+
+        assert(top == lua_gettop(L));
+
+        return PostMessage(L, &sender, &prepared->m_Receiver, prepared->m_MessageId, desc, data, data_size);
     }
 
+    static int PreparedMessage_tostring(lua_State* L)
+    {
+        PreparedMessage* prepared = (PreparedMessage*)lua_touserdata(L, 1);
+        char buffer[512];
+        UrlToString(&prepared->m_Receiver, buffer, sizeof(buffer));
+        lua_pushfstring(L, "%s: [%s] %s", SCRIPT_TYPE_NAME_PREPARED_MESSAGE, buffer, dmHashReverseSafe64(prepared->m_MessageId));
+        return 1;
+    }
+
+    static const luaL_reg PreparedMessage_meta[] =
+    {
+        {"__tostring",  PreparedMessage_tostring},
+        {0,0}
+    };
+
     static const luaL_reg ScriptMsg_methods[] =
     {
         {SCRIPT_TYPE_NAME_URL, URL_new},
         {"post", Msg_Post},
+        {"prepare", Msg_Prepare},
+        {"post_prepared", Msg_PostPrepared},
         {0, 0}
     };
 
@@ -571,6 +742,7 @@ namespace dmScript
         int top = lua_gettop(L);
 
         SCRIPT_URL_TYPE_HASH = dmScript::RegisterUserType(L, SCRIPT_TYPE_NAME_URL, URL_methods, URL_meta);
+        SCRIPT_PREPARED_MESSAGE_TYPE_HASH = dmScript::RegisterUserTypeLocal(L, SCRIPT_TYPE_NAME_PREPARED_MESSAGE, PreparedMessage_meta);
 
         luaL_register(L, SCRIPT_LIB_NAME, ScriptMsg_methods);
         lua_pop(L, 1);
@@ -784,4 +956,5 @@ namespace dmScript
 
 #undef SCRIPT_LIB_NAME
 #undef SCRIPT_TYPE_NAME_URL
+#undef SCRIPT_TYPE_NAME_PREPARED_MESSAGE
 }
@@ -16,12 +16,16 @@
 #define SCRIPT_PRIVATE_H
 
 #include <dlib/hashtable.h>
+#include <dlib/job_thread.h>
 
 #define SCRIPT_MAIN_THREAD "__script_main_thread"
 #define SCRIPT_ERROR_HANDLER_VAR "__error_handler"
 
 namespace dmScript
 {
+    // Max number of strings with a cached hash, see Hash_new
+    const uint32_t HASH_STRING_CACHE_SIZE = 2048;
+
 ///////////////////////////////////////////////////////////////
 // NOTE: Helper functions to get more logging on issue DEF-3714
 #define PUSH_TABLE_LOGGER_CAPACITY 128
@@ -58,7 +62,7 @@ namespace dmScript
 
     struct Module
     {
-        char*       m_Script;
+        const char* m_Script;       // Points into the resource when there is one, otherwise it's an owned copy
         uint32_t    m_ScriptSize;
         char*       m_Name;
         void*       m_Resource;
@@ -67,17 +71,45 @@ namespace dmScript
 
     typedef struct ScriptExtension* HScriptExtension;
 
+    // See script_sys.cpp
+    struct SaveJob;
+
+    // See script_allocator.cpp
+    struct LuaAllocator;
+
+    // See script_gc.cpp
+    struct GCState
+    {
+        uint32_t m_FrameBudget;     // Max time spent per frame (us), or 0 if Lua collects automatically
+        uint32_t m_LastCount;       // KB in use after the last step
+        uint32_t m_Estimate;        // KB in use after the last cycle
+        uint32_t m_Debt;            // KB allocated during the cycle, not yet paid off with collection work
+        uint8_t  m_InCycle:1;
+        uint8_t  m_CollectRequested:1;
+    };
+
     struct Context
     {
         dmConfigFile::HConfig       m_ConfigFile;
         dmResource::HFactory        m_ResourceFactory;
         dmGraphics::HContext        m_GraphicsContext;
+        dmJobThread::HContext       m_JobThread;
         dmHashTable64<Module>       m_Modules;
         dmHashTable64<Module*>      m_PathToModule;
         dmHashTable64<int>          m_HashInstances;
+        // Hashes cached by their string in the table at m_HashStringCacheRef, see Hash_new
+        dmHashTable64<bool>         m_HashStringCached;
         dmArray<HScriptExtension>   m_ScriptExtensions;
+        // The sys.save_async jobs that are not yet done
+        dmArray<SaveJob*>           m_PendingSaves;
+        // The allocator of m_LuaState, or 0 if it uses the default allocator
+        LuaAllocator*               m_LuaAllocator;
         lua_State*                  m_LuaState;
         int                         m_ContextTableRef;
+        int                         m_HashStringCacheRef;
+        GCState                     m_GC;
+        // The number of script worlds with their own random state, see SetScriptWorldRandomSeed
+        uint32_t                    m_SeededWorldCount;
     };
 
     HContext GetScriptContext(lua_State* L);
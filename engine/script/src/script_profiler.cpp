@@ -0,0 +1,339 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "script_profiler.h"
+
+#include <string.h>
+#include <dlib/array.h>
+#include <dlib/dstrings.h>
+#include <dlib/hash.h>
+#include <dlib/hashtable.h>
+#include <dlib/profile.h>
+#include <dlib/time.h>
+
+#include "script.h"
+
+extern "C"
+{
+#include <lua/lua.h>
+}
+
+DM_PROPERTY_EXTERN(rmtp_Script);
+DM_PROPERTY_U32(rmtp_LuaProfilerSamples, 0, FrameReset, "# lua profiler samples", &rmtp_Script);
+
+namespace dmScript
+{
+    /*
+        The sampler is a count hook, which is cheap enough to run every few hundred instructions.
+        It only walks the call stack once the interval has passed since the last sample, so the
+        cost is mostly decided by the interval.
+
+        Each sample adds to the entries of the functions on the stack (keyed by source and line defined),
+        and of the current lines (keyed by source and current line). The stack itself is kept in a
+        ring buffer, as indices of the function entries.
+
+        Note that with LuaJIT, code running in compiled traces doesn't call the hook.
+    */
+
+    static const int      LUA_PROFILER_HOOK_COUNT   = 1000;     // Instructions between each time check
+    static const uint32_t LUA_PROFILER_MAX_DEPTH    = 32;
+    static const uint32_t LUA_PROFILER_RING_SIZE    = 1024;     // Number of call stacks kept
+    static const uint32_t LUA_PROFILER_MAX_ENTRIES  = 8192;     // Per entry type
+    static const uint32_t LUA_PROFILER_LOG_COUNT    = 10;       // Number of functions logged when stopping
+    static const uint32_t LUA_PROFILER_NAME_SIZE    = 32;
+
+    struct LuaProfilerEntryData
+    {
+        char     m_Source[LUA_IDSIZE];
+        char     m_Name[LUA_PROFILER_NAME_SIZE];
+        uint32_t m_Line;
+        uint32_t m_SelfSamples;
+        uint32_t m_TotalSamples;
+        uint32_t m_LastSample;  // Makes sure recursive calls are only counted once per sample
+    };
+
+    struct LuaProfilerStack
+    {
+        uint64_t m_Time;
+        uint32_t m_Depth;
+        uint32_t m_Functions[LUA_PROFILER_MAX_DEPTH];
+    };
+
+    struct LuaProfilerEntries
+    {
+        dmArray<LuaProfilerEntryData>   m_Entries;
+        dmHashTable64<uint32_t>         m_Indices;
+    };
+
+    struct LuaProfiler
+    {
+        LuaProfiler()
+        : m_L(0)
+        , m_PrevHook(0)
+        , m_PrevMask(0)
+        , m_PrevCount(0)
+        , m_Interval(0)
+        , m_NextSample(0)
+        , m_SampleCount(0)
+        , m_RingHead(0)
+        , m_RingCount(0)
+        {
+        }
+
+        lua_State*                 m_L;
+        lua_Hook                   m_PrevHook;
+        int                        m_PrevMask;
+        int                        m_PrevCount;
+        uint32_t                   m_Interval;
+        uint64_t                   m_NextSample;
+        uint32_t                   m_SampleCount;
+        LuaProfilerEntries         m_Functions;
+        LuaProfilerEntries         m_Lines;
+        dmArray<LuaProfilerStack>  m_Ring;
+        uint32_t                   m_RingHead;
+        uint32_t                   m_RingCount;
+    };
+
+    static LuaProfiler g_LuaProfiler;
+
+    static uint32_t GetEntry(LuaProfilerEntries& entries, uint32_t sample, const char* source, uint32_t line, const char* name)
+    {
+        HashState64 hash_state;
+        dmHashInit64(&hash_state, false);
+        dmHashUpdateBuffer64(&hash_state, source, (uint32_t)strlen(source));
+        dmHashUpdateBuffer64(&hash_state, &line, sizeof(line));
+        uint64_t key = dmHashFinal64(&hash_state);
+
+        uint32_t* index = entries.m_Indices.Get(key);
+        if (index)
+            return *index;
+
+        if (entries.m_Entries.Size() >= LUA_PROFILER_MAX_ENTRIES)
+            return LUA_PROFILER_MAX_ENTRIES;
+
+        if (entries.m_Entries.Full())
+            entries.m_Entries.OffsetCapacity(256);
+        if (entries.m_Indices.Full())
+        {
+            uint32_t capacity = entries.m_Indices.Capacity() + 512;
+            entries.m_Indices.SetCapacity(capacity / 2 + 1, capacity);
+        }
+
+        LuaProfilerEntryData data;
+        dmStrlCpy(data.m_Source, source, sizeof(data.m_Source));
+        dmStrlCpy(data.m_Name, name ? name : "?", sizeof(data.m_Name));
+        data.m_Line = line;
+        data.m_SelfSamples = 0;
+        data.m_TotalSamples = 0;
+        data.m_LastSample = sample - 1;
+
+        uint32_t new_index = entries.m_Entries.Size();
+        entries.m_Entries.Push(data);
+        entries.m_Indices.Put(key, new_index);
+        return new_index;
+    }
+
+    static void AddSample(LuaProfilerEntries& entries, uint32_t index, uint32_t sample, bool running)
+    {
+        if (index == LUA_PROFILER_MAX_ENTRIES)
+            return;
+        LuaProfilerEntryData& data = entries.m_Entries[index];
+        if (running)
+            data.m_SelfSamples++;
+        if (data.m_LastSample != sample)
+        {
+            data.m_LastSample = sample;
+            data.m_TotalSamples++;
+        }
+    }
+
+    static void TakeSample(LuaProfiler* profiler, lua_State* L, uint64_t time)
+    {
+        uint32_t sample = ++profiler->m_SampleCount;
+
+        LuaProfilerStack& stack = profiler->m_Ring[profiler->m_RingHead];
+        profiler->m_RingHead = (profiler->m_RingHead + 1) % LUA_PROFILER_RING_SIZE;
+        if (profiler->m_RingCount < LUA_PROFILER_RING_SIZE)
+            profiler->m_RingCount++;
+
+        stack.m_Time = time;
+        stack.m_Depth = 0;
+
+        lua_Debug ar;
+        for (int level = 0; level < (int)LUA_PROFILER_MAX_DEPTH && lua_getstack(L, level, &ar); ++level)
+        {
+            lua_getinfo(L, "Snl", &ar);
+            uint32_t function_line = ar.linedefined > 0 ? (uint32_t)ar.linedefined : 0;
+            uint32_t current_line = ar.currentline > 0 ? (uint32_t)ar.currentline : 0;
+
+            uint32_t function = GetEntry(profiler->m_Functions, sample, ar.short_src, function_line, ar.name);
+            AddSample(profiler->m_Functions, function, sample, level == 0);
+
+            uint32_t line = GetEntry(profiler->m_Lines, sample, ar.short_src, current_line, ar.name);
+            AddSample(profiler->m_Lines, line, sample, level == 0);
+
+            if (function != LUA_PROFILER_MAX_ENTRIES)
+                stack.m_Functions[stack.m_Depth++] = function;
+        }
+
+        DM_PROPERTY_ADD_U32(rmtp_LuaProfilerSamples, 1);
+    }
+
+    static void LuaProfilerHook(lua_State* L, lua_Debug* ar)
+    {
+        LuaProfiler* profiler = &g_LuaProfiler;
+
+        // Pass on the events to the hook that was set before the profiler started
+        if (profiler->m_PrevHook && (ar->event != LUA_HOOKCOUNT || (profiler->m_PrevMask & LUA_MASKCOUNT)))
+        {
+            profiler->m_PrevHook(L, ar);
+        }
+
+        if (ar->event != LUA_HOOKCOUNT)
+            return;
+
+        uint64_t time = dmTime::GetTime();
+        if (time < profiler->m_NextSample)
+            return;
+        profiler->m_NextSample = time + profiler->m_Interval;
+
+        TakeSample(profiler, L, time);
+    }
+
+    void StartLuaProfiler(lua_State* L, uint32_t interval)
+    {
+        LuaProfiler* profiler = &g_LuaProfiler;
+        if (profiler->m_L)
+        {
+            StopLuaProfiler();
+        }
+
+        if (profiler->m_Ring.Empty())
+        {
+            profiler->m_Ring.SetCapacity(LUA_PROFILER_RING_SIZE);
+            profiler->m_Ring.SetSize(LUA_PROFILER_RING_SIZE);
+        }
+
+        profiler->m_L = L;
+        profiler->m_PrevHook = lua_gethook(L);
+        profiler->m_PrevMask = lua_gethookmask(L);
+        profiler->m_PrevCount = lua_gethookcount(L);
+        profiler->m_Interval = interval;
+        profiler->m_NextSample = 0;
+
+        lua_sethook(L, LuaProfilerHook, profiler->m_PrevMask | LUA_MASKCOUNT, LUA_PROFILER_HOOK_COUNT);
+    }
+
+    static void LogHotFunctions(LuaProfiler* profiler)
+    {
+        const dmArray<LuaProfilerEntryData>& entries = profiler->m_Functions.m_Entries;
+
+        // Insertion into a short list, as only a few entries are logged
+        uint32_t top[LUA_PROFILER_LOG_COUNT];
+        uint32_t top_count = 0;
+        for (uint32_t i = 0; i < entries.Size(); ++i)
+        {
+            uint32_t self_samples = entries[i].m_SelfSamples;
+            if (self_samples == 0)
+                continue;
+            uint32_t pos = top_count < LUA_PROFILER_LOG_COUNT ? top_count++ : LUA_PROFILER_LOG_COUNT;
+            while (pos > 0 && entries[top[pos - 1]].m_SelfSamples < self_samples)
+            {
+                if (pos < LUA_PROFILER_LOG_COUNT)
+                    top[pos] = top[pos - 1];
+                --pos;
+            }
+            if (pos < LUA_PROFILER_LOG_COUNT)
+                top[pos] = i;
+        }
+
+        dmProfile::LogText("Lua profiler: %u samples", profiler->m_SampleCount);
+        for (uint32_t i = 0; i < top_count; ++i)
+        {
+            const LuaProfilerEntryData& data = entries[top[i]];
+            dmProfile::LogText("  %s:%u %s self: %u total: %u", data.m_Source, data.m_Line, data.m_Name, data.m_SelfSamples, data.m_TotalSamples);
+        }
+    }
+
+    void StopLuaProfiler()
+    {
+        LuaProfiler* profiler = &g_LuaProfiler;
+        if (!profiler->m_L)
+            return;
+
+        lua_sethook(profiler->m_L, profiler->m_PrevHook, profiler->m_PrevMask, profiler->m_PrevCount);
+        profiler->m_L = 0;
+        profiler->m_PrevHook = 0;
+
+        LogHotFunctions(profiler);
+    }
+
+    bool IsLuaProfilerRunning()
+    {
+        return g_LuaProfiler.m_L != 0;
+    }
+
+    void ResetLuaProfiler()
+    {
+        LuaProfiler* profiler = &g_LuaProfiler;
+        profiler->m_SampleCount = 0;
+        profiler->m_RingHead = 0;
+        profiler->m_RingCount = 0;
+        profiler->m_Functions.m_Entries.SetSize(0);
+        profiler->m_Functions.m_Indices.Clear();
+        profiler->m_Lines.m_Entries.SetSize(0);
+        profiler->m_Lines.m_Indices.Clear();
+    }
+
+    uint32_t GetLuaProfilerSampleCount()
+    {
+        return g_LuaProfiler.m_SampleCount;
+    }
+
+    void IterateLuaProfilerEntries(LuaProfilerEntryType type, LuaProfilerEntryFn fn, void* ctx)
+    {
+        LuaProfiler* profiler = &g_LuaProfiler;
+        const dmArray<LuaProfilerEntryData>& entries = type == LUA_PROFILER_ENTRY_FUNCTION ? profiler->m_Functions.m_Entries : profiler->m_Lines.m_Entries;
+        for (uint32_t i = 0; i < entries.Size(); ++i)
+        {
+            const LuaProfilerEntryData& data = entries[i];
+            LuaProfilerEntry entry;
+            entry.m_Source = data.m_Source;
+            entry.m_Name = data.m_Name;
+            entry.m_Line = data.m_Line;
+            entry.m_SelfSamples = data.m_SelfSamples;
+            entry.m_TotalSamples = data.m_TotalSamples;
+            fn(ctx, &entry);
+        }
+    }
+
+    void IterateLuaProfilerStacks(LuaProfilerStackFn fn, void* ctx)
+    {
+        LuaProfiler* profiler = &g_LuaProfiler;
+        uint32_t start = (profiler->m_RingHead + LUA_PROFILER_RING_SIZE - profiler->m_RingCount) % LUA_PROFILER_RING_SIZE;
+        for (uint32_t i = 0; i < profiler->m_RingCount; ++i)
+        {
+            const LuaProfilerStack& stack = profiler->m_Ring[(start + i) % LUA_PROFILER_RING_SIZE];
+            fn(ctx, stack.m_Time, stack.m_Functions, stack.m_Depth);
+        }
+    }
+
+    void FinalizeLuaProfiler(lua_State* L)
+    {
+        if (g_LuaProfiler.m_L == L)
+        {
+            StopLuaProfiler();
+        }
+    }
+}
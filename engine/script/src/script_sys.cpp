@@ -39,7 +39,11 @@
 #include <dlib/socket.h>
 #include <dlib/path.h>
 #include <dlib/align.h>
+#include <dlib/atomic.h>
+#include <dlib/job_thread.h>
+#include <dlib/lz4.h>
 #include <dlib/memory.h>
+#include <dlib/performance_hint.h>
 #include <resource/resource.h>
 #include "script.h"
 #include "script/sys_ddf.h"
@@ -128,101 +132,349 @@ union SaveLoadBuffer
      * ```
      */
 
-    static int Sys_Save(lua_State* L)
+    // Writes the data to a temporary file, which is then renamed to the filename, so that the file is
+    // never left half written. May be called from a worker thread
+    static bool WriteSaveFile(const char* filename, const void* data, uint32_t data_size, char* error, uint32_t error_size)
     {
-        const char* filename = luaL_checkstring(L, 1);
-
-        luaL_checktype(L, 2, LUA_TTABLE);
-
-        uint32_t table_size = CheckTableSize(L, 2);
-
-        char* buffer = Sys_SetupTableSerializationBuffer(table_size);
-        if (!buffer)
-        {
-            return luaL_error(L, "Could not allocate %d bytes for table serialization.", table_size);
-        }
-        uint32_t n_used = CheckTable(L, buffer, table_size, 2);
-
 #if !defined(__EMSCRIPTEN__)
 
         char tmp_filename[DMPATH_MAX_PATH];
         // The counter and hash are there to make the files unique enough to avoid that the user
         // accidentally writes to it.
-        static int save_counter = 0;
+        static int32_atomic_t save_counter = 0;
         uint32_t hash = dmHashString32(filename);
-        int res = dmSnPrintf(tmp_filename, sizeof(tmp_filename), "%s.defoldtmp_%x_%d", filename, hash, save_counter++);
+        int res = dmSnPrintf(tmp_filename, sizeof(tmp_filename), "%s.defoldtmp_%x_%d", filename, hash, dmAtomicIncrement32(&save_counter));
         if (res == -1)
         {
-            Sys_FreeTableSerializationBuffer(buffer);
-            return luaL_error(L, "Could not write to the file %s. Path too long.", filename);
+            dmSnPrintf(error, error_size, "Could not write to the file %s. Path too long.", filename);
+            return false;
         }
 
         FILE* file = fopen(tmp_filename, "wb");
         if (!file)
         {
-            Sys_FreeTableSerializationBuffer(buffer);
-
         #if defined(DM_NO_ERRNO)
-            return luaL_error(L, "Could not open the file %s", tmp_filename);
+            dmSnPrintf(error, error_size, "Could not open the file %s", tmp_filename);
         #else
             char errmsg[128] = {};
             dmStrError(errmsg, sizeof(errmsg), errno);
-            return luaL_error(L, "Could not open the file %s, reason: %s.", tmp_filename, errmsg);
+            dmSnPrintf(error, error_size, "Could not open the file %s, reason: %s.", tmp_filename, errmsg);
         #endif
+            return false;
         }
 
-        bool result = fwrite(buffer, 1, n_used, file) == n_used;
+        bool result = fwrite(data, 1, data_size, file) == data_size;
         result = (fclose(file) == 0) && result;
-        Sys_FreeTableSerializationBuffer(buffer);
 
         if (!result)
         {
             dmSys::Unlink(tmp_filename);
 
         #if defined(DM_NO_ERRNO)
-            return luaL_error(L, "Could not write to the file %s.", filename);
+            dmSnPrintf(error, error_size, "Could not write to the file %s.", filename);
         #else
             char errmsg[128] = {};
             dmStrError(errmsg, sizeof(errmsg), errno);
-            return luaL_error(L, "Could not write to the file %s, reason: %s.", filename, errmsg);
+            dmSnPrintf(error, error_size, "Could not write to the file %s, reason: %s.", filename, errmsg);
         #endif
+            return false;
         }
 
         if (dmSys::Rename(filename, tmp_filename) != dmSys::RESULT_OK)
         {
-            return luaL_error(L, "Could not rename %s to the file %s.", tmp_filename, filename);
+            dmSnPrintf(error, error_size, "Could not rename %s to the file %s.", tmp_filename, filename);
+            return false;
         }
-
-        lua_pushboolean(L, result);
-        return 1;
+        return true;
 
 #else // __EMSCRIPTEN__
 
         FILE* file = fopen(filename, "wb");
         if (!file)
         {
-            Sys_FreeTableSerializationBuffer(buffer);
-            return luaL_error(L, "Could not write to the file %s.", filename);
+            dmSnPrintf(error, error_size, "Could not write to the file %s.", filename);
+            return false;
         }
 
-        bool result = fwrite(buffer, 1, n_used, file) == n_used;
+        bool result = fwrite(data, 1, data_size, file) == data_size;
         result = (fclose(file) == 0) && result;
-        Sys_FreeTableSerializationBuffer(buffer);
 
         if (!result)
         {
             dmSys::Unlink(filename);
-            return luaL_error(L, "Could not write to the file %s.", filename);
+            dmSnPrintf(error, error_size, "Could not write to the file %s.", filename);
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    static int Sys_Save(lua_State* L)
+    {
+        const char* filename = luaL_checkstring(L, 1);
+
+        luaL_checktype(L, 2, LUA_TTABLE);
+
+        uint32_t table_size = CheckTableSize(L, 2);
+
+        char* buffer = Sys_SetupTableSerializationBuffer(table_size);
+        if (!buffer)
+        {
+            return luaL_error(L, "Could not allocate %d bytes for table serialization.", table_size);
+        }
+        uint32_t n_used = CheckTable(L, buffer, table_size, 2);
+
+        char error[DMPATH_MAX_PATH + 256];
+        bool result = WriteSaveFile(filename, buffer, n_used, error, sizeof(error));
+        Sys_FreeTableSerializationBuffer(buffer);
+        if (!result)
+        {
+            return luaL_error(L, "%s", error);
         }
 
         lua_pushboolean(L, result);
         return 1;
-#endif
     }
 
+    // The files written by sys.save_async start with this header, followed by the LZ4 compressed table
+    static const uint32_t SAVE_FILE_LZ4_MAGIC = 0x345a4c44; // "DLZ4"
+
+    struct SaveFileLZ4Header
+    {
+        uint32_t m_Magic;
+        uint32_t m_Size;    // The size of the uncompressed table
+    };
+
+    struct SaveJob
+    {
+        HContext            m_Context;      // 0 if the context was finalized before the job was done
+        LuaCallbackInfo*    m_Callback;
+        dmJobThread::HJob   m_Job;
+        char*               m_Data;         // The serialized table
+        uint32_t            m_DataSize;
+        char                m_Filename[DMPATH_MAX_PATH];
+        char                m_Error[DMPATH_MAX_PATH + 256];
+    };
+
+    // Called on the worker thread
+    static int SaveJobProcess(void* context, void* data)
+    {
+        SaveJob* job = (SaveJob*)data;
+
+        int max_compressed_size = 0;
+        dmLZ4::Result r = dmLZ4::MaxCompressedSize((int)job->m_DataSize, &max_compressed_size);
+        char* compressed = 0;
+        if (r == dmLZ4::RESULT_OK)
+        {
+            compressed = (char*)malloc(sizeof(SaveFileLZ4Header) + max_compressed_size);
+        }
+        if (!compressed)
+        {
+            dmSnPrintf(job->m_Error, sizeof(job->m_Error), "Could not allocate memory to compress the file %s.", job->m_Filename);
+            dmMemory::AlignedFree(job->m_Data);
+            job->m_Data = 0;
+            return 0;
+        }
+
+        int compressed_size = 0;
+        r = dmLZ4::CompressBuffer(job->m_Data, job->m_DataSize, compressed + sizeof(SaveFileLZ4Header), &compressed_size);
+        dmMemory::AlignedFree(job->m_Data);
+        job->m_Data = 0;
+
+        bool result = false;
+        if (r == dmLZ4::RESULT_OK)
+        {
+            SaveFileLZ4Header* header = (SaveFileLZ4Header*)compressed;
+            header->m_Magic = SAVE_FILE_LZ4_MAGIC;
+            header->m_Size = job->m_DataSize;
+            result = WriteSaveFile(job->m_Filename, compressed, sizeof(SaveFileLZ4Header) + compressed_size, job->m_Error, sizeof(job->m_Error));
+        }
+        else
+        {
+            dmSnPrintf(job->m_Error, sizeof(job->m_Error), "Could not compress the file %s.", job->m_Filename);
+        }
+        free(compressed);
+        return result ? 1 : 0;
+    }
+
+    struct SaveJobCallbackArgs
+    {
+        SaveJob* m_Job;
+        bool     m_Result;
+    };
+
+    static void PushSaveJobCallbackArgs(lua_State* L, void* user_context)
+    {
+        SaveJobCallbackArgs* args = (SaveJobCallbackArgs*)user_context;
+        lua_pushstring(L, args->m_Job->m_Filename);
+        lua_pushboolean(L, args->m_Result);
+        if (args->m_Result)
+            lua_pushnil(L);
+        else
+            lua_pushstring(L, args->m_Job->m_Error);
+    }
+
+    // Called on the main thread
+    static void SaveJobFinished(void* context, void* data, int result)
+    {
+        SaveJob* job = (SaveJob*)data;
+        if (job->m_Context)
+        {
+            dmArray<SaveJob*>& pending = job->m_Context->m_PendingSaves;
+            for (uint32_t i = 0; i < pending.Size(); ++i)
+            {
+                if (pending[i] == job)
+                {
+                    pending.EraseSwap(i);
+                    break;
+                }
+            }
+        }
+
+        if (!result && !job->m_Callback)
+        {
+            dmLogError("%s", job->m_Error);
+        }
+
+        if (job->m_Callback)
+        {
+            if (dmScript::IsCallbackValid(job->m_Callback))
+            {
+                SaveJobCallbackArgs args = { job, result != 0 };
+                dmScript::InvokeCallback(job->m_Callback, PushSaveJobCallbackArgs, &args);
+            }
+            dmScript::DestroyCallback(job->m_Callback);
+        }
+        delete job;
+    }
+
+    void FinalizeSys(HContext context)
+    {
+        // The Lua state is about to be closed, so the callbacks can't be called
+        dmArray<SaveJob*>& pending = context->m_PendingSaves;
+        for (uint32_t i = 0; i < pending.Size(); ++i)
+        {
+            SaveJob* job = pending[i];
+            dmJobThread::WaitForJob(context->m_JobThread, job->m_Job);
+            job->m_Context = 0;
+            if (job->m_Callback)
+            {
+                dmScript::DestroyCallback(job->m_Callback);
+                job->m_Callback = 0;
+            }
+        }
+        pending.SetSize(0);
+    }
+
+    /*# saves a lua table to a file stored on disk, without blocking
+     * Saves a lua table to a file, like <code>sys.save</code>, but the file is compressed and written
+     * on a worker thread, which keeps the game from freezing when saving large tables.
+     * The table is serialized before the function returns, so the table may be changed right away.
+     * There is no limit on the size of the table.
+     *
+     * The file is written to a temporary file first, which is then renamed,
+     * so the file is never left half written. The saved file is loaded with <code>sys.load</code>.
+     * On platforms without threads, the file is written during the update of the engine frame.
+     *
+     * @name sys.save_async
+     * @param filename [type:string] file to write to
+     * @param table [type:table] lua table to save
+     * @param [callback] [type:function(self, filename, success, error)] function called when the file has been written
+     *
+     * `self`
+     * : [type:object] The current object.
+     *
+     * `filename`
+     * : [type:string] The file that was written.
+     *
+     * `success`
+     * : [type:boolean] `true` if the file was written.
+     *
+     * `error`
+     * : [type:string] The reason the file wasn't written, or `nil` on success.
+     *
+     * @examples
+     *
+     * Save data without blocking:
+     *
+     * ```lua
+     * local my_file_path = sys.get_save_file("my_game", "my_file")
+     * sys.save_async(my_file_path, my_table, function(self, filename, success, error)
+     *   if not success then
+     *     print(error)
+     *   end
+     * end)
+     * ```
+     */
+    static int Sys_SaveAsync(lua_State* L)
+    {
+        int top = lua_gettop(L);
+        const char* filename = luaL_checkstring(L, 1);
+        luaL_checktype(L, 2, LUA_TTABLE);
+        if (top > 2 && !lua_isnil(L, 3))
+        {
+            luaL_checktype(L, 3, LUA_TFUNCTION);
+        }
+
+        if (strlen(filename) >= DMPATH_MAX_PATH)
+        {
+            return luaL_error(L, "Could not write to the file %s. Path too long.", filename);
+        }
+
+        uint32_t table_size = CheckTableSize(L, 2);
+        char* buffer = 0;
+        dmMemory::AlignedMalloc((void**)&buffer, 16, table_size);
+        if (!buffer)
+        {
+            return luaL_error(L, "Could not allocate %d bytes for table serialization.", table_size);
+        }
+        // Note that this can raise a Lua error
+        uint32_t n_used = CheckTable(L, buffer, table_size, 2);
+
+        LuaCallbackInfo* callback = 0;
+        if (top > 2 && !lua_isnil(L, 3))
+        {
+            callback = dmScript::CreateCallback(L, 3);
+            if (!callback)
+            {
+                dmMemory::AlignedFree(buffer);
+                return luaL_error(L, "Failed to create callback");
+            }
+        }
+
+        SaveJob* job = new SaveJob;
+        job->m_Context = GetScriptContext(L);
+        job->m_Callback = callback;
+        job->m_Job = dmJobThread::INVALID_JOB;
+        job->m_Data = buffer;
+        job->m_DataSize = n_used;
+        dmStrlCpy(job->m_Filename, filename, sizeof(job->m_Filename));
+        job->m_Error[0] = 0;
+
+        dmJobThread::HContext job_thread = job->m_Context->m_JobThread;
+        if (job_thread)
+        {
+            job->m_Job = dmJobThread::CreateJob(job_thread, SaveJobProcess, SaveJobFinished, 0, job);
+        }
+
+        if (job->m_Job == dmJobThread::INVALID_JOB)
+        {
+            // Without a job thread, the file is written right away
+            SaveJobFinished(0, job, SaveJobProcess(0, job));
+            return 0;
+        }
+
+        if (job->m_Context->m_PendingSaves.Full())
+        {
+            job->m_Context->m_PendingSaves.OffsetCapacity(8);
+        }
+        job->m_Context->m_PendingSaves.Push(job);
+        dmJobThread::PushJob(job_thread, job->m_Job);
+        return 0;
+    }
 
     /*# loads a lua table from a file on disk
-     * If the file exists, it must have been created by <code>sys.save</code> to be loaded.
+     * If the file exists, it must have been created by <code>sys.save</code> or <code>sys.save_async</code> to be loaded.
      *
      * @name sys.load
      * @param filename [type:string] file to read from
@@ -266,6 +518,33 @@ union SaveLoadBuffer
             Sys_FreeTableSerializationBuffer(buffer);
             return luaL_error(L, "Could not read from the file %s.", filename);
         }
+
+        const SaveFileLZ4Header* lz4_header = (const SaveFileLZ4Header*)buffer;
+        if (nread >= sizeof(SaveFileLZ4Header) && lz4_header->m_Magic == SAVE_FILE_LZ4_MAGIC)
+        {
+            // Written by sys.save_async
+            uint32_t table_size = lz4_header->m_Size;
+            char* table_buffer = 0;
+            dmMemory::AlignedMalloc((void**)&table_buffer, 16, table_size);
+            if (!table_buffer)
+            {
+                Sys_FreeTableSerializationBuffer(buffer);
+                return luaL_error(L, "Could not allocate %d bytes for table deserialization.", table_size);
+            }
+
+            int decompressed_size = 0;
+            dmLZ4::Result r = dmLZ4::DecompressBuffer(buffer + sizeof(SaveFileLZ4Header), nread - sizeof(SaveFileLZ4Header), table_buffer, table_size, &decompressed_size);
+            Sys_FreeTableSerializationBuffer(buffer);
+            if (r != dmLZ4::RESULT_OK || (uint32_t)decompressed_size != table_size)
+            {
+                dmMemory::AlignedFree(table_buffer);
+                return luaL_error(L, "Could not decompress the file %s.", filename);
+            }
+            PushTable(L, table_buffer, table_size);
+            dmMemory::AlignedFree(table_buffer);
+            return 1;
+        }
+
         PushTable(L, buffer, nread);
         Sys_FreeTableSerializationBuffer(buffer);
         return 1;
@@ -1324,6 +1603,66 @@ union SaveLoadBuffer
         return 0;
     }
 
+    /*# get the thermal headroom of the device
+    * Gets how close the device is to being throttled because of heat, forecast 10 seconds ahead.
+    * 0 is no heat, and at 1 the device starts to throttle. The value can go above 1 when it's
+    * throttled heavily. The headroom is updated at most once per second.
+    *
+    * This is currently only supported on Android 11 (API 31) and later.
+    *
+    * When `engine.thermal_headroom_limit` is set in the "game.project" settings, the engine halves
+    * the update frequency by itself when the headroom reaches the limit.
+    *
+    * @name sys.get_thermal_headroom
+    * @return headroom [type:number|nil] the thermal headroom, or `nil` if it isn't supported
+    * @examples
+    *
+    * Lower the quality of the effects before the device gets throttled
+    *
+    * ```lua
+    * local headroom = sys.get_thermal_headroom()
+    * if headroom and headroom > 0.8 then
+    *     msg.post("/effects", "set_quality", { quality = "low" })
+    * end
+    * ```
+    */
+    static int Sys_GetThermalHeadroom(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 1);
+
+        float headroom;
+        if (dmPerformanceHint::GetThermalHeadroom(dmPerformanceHint::THERMAL_FORECAST_SECONDS, &headroom))
+        {
+            lua_pushnumber(L, headroom);
+        }
+        else
+        {
+            lua_pushnil(L);
+        }
+        return 1;
+    }
+
+    /*# collect garbage at the end of the frame
+    * Requests a full garbage collection, which is run at the end of the current frame, after
+    * the rendering. This is useful while a loading screen is shown, or right after a level has been unloaded.
+    * The incremental collection done each frame is controlled by `script.gc_frame_budget` in the "game.project" settings.
+    *
+    * @name sys.collect_garbage
+    * @examples
+    *
+    * Collect the garbage of the previous level, while the loading screen is shown
+    *
+    * ```lua
+    * sys.collect_garbage()
+    * ```
+    */
+    static int Sys_CollectGarbage(lua_State* L)
+    {
+        DM_LUA_STACK_CHECK(L, 0);
+        dmScript::RequestGarbageCollection(dmScript::GetScriptContext(L));
+        return 0;
+    }
+
     /*# serializes a lua table to a buffer and returns it
      * The buffer can later deserialized by <code>sys.deserialize</code>.
      * This method has all the same limitations as <code>sys.save</code>.
@@ -1431,6 +1770,7 @@ union SaveLoadBuffer
     static const luaL_reg ScriptSys_methods[] =
     {
         {"save", Sys_Save},
+        {"save_async", Sys_SaveAsync},
         {"load", Sys_Load},
         {"exists", Sys_Exists},
         {"get_host_path", Sys_GetHostPath},
@@ -1453,6 +1793,8 @@ union SaveLoadBuffer
         {"reboot", Sys_Reboot},
         {"set_update_frequency", Sys_SetUpdateFrequency},
         {"set_vsync_swap_interval", Sys_SetVsyncSwapInterval},
+        {"get_thermal_headroom", Sys_GetThermalHeadroom},
+        {"collect_garbage", Sys_CollectGarbage},
         {"serialize", Sys_Serialize},
         {"deserialize", Sys_Deserialize},
 
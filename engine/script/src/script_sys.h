@@ -15,6 +15,8 @@
 #ifndef DM_SCRIPT_SYS_H
 #define DM_SCRIPT_SYS_H
 
+#include <dmsdk/script/script.h>
+
 extern "C"
 {
 #include <lua/lua.h>
@@ -23,6 +25,9 @@ extern "C"
 namespace dmScript
 {
     void InitializeSys(lua_State* L);
+
+    // Waits for the pending sys.save_async jobs. Their callbacks are not called
+    void FinalizeSys(HContext context);
 }
 
 #endif // DM_SCRIPT_SYS_H
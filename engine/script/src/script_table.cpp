@@ -448,6 +448,202 @@ namespace dmScript
         return size;
     }
 
+    uint32_t DoCheckTable(lua_State* L, const TableHeader& header, const char* original_buffer, char* buffer, uint32_t buffer_size, int index, dmArray<const void*>& table_stack);
+
+    // Serializes the value at the top of the stack. The key type and count are only used in the error messages
+    static char* SaveValue(lua_State* L, const TableHeader& header, const char* original_buffer, char* buffer, const char* buffer_end, uint32_t buffer_size, int key_type, uint32_t count, dmArray<const void*>& table_stack)
+    {
+        int value_type = lua_type(L, -1);
+        switch (value_type)
+        {
+            case LUA_TBOOLEAN:
+            {
+                if (buffer_end - buffer < 1)
+                {
+                    luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
+                }
+                (*buffer++) = (char) lua_toboolean(L, -1);
+            }
+            break;
+
+            case LUA_TNUMBER:
+            {
+                // NOTE: We align lua_Number to sizeof(float) even if lua_Number probably is of double type
+                intptr_t offset = buffer - original_buffer;
+                intptr_t aligned_buffer = ((intptr_t) offset + sizeof(float)-1) & ~(sizeof(float)-1);
+                intptr_t align_size = aligned_buffer - (intptr_t) offset;
+
+                if (buffer_end - buffer < align_size)
+                {
+                    luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
+                }
+
+#ifndef NDEBUG
+                memset(buffer, 0, align_size);
+#endif
+                buffer += align_size;
+
+                if (buffer_end - buffer < int32_t(sizeof(lua_Number)) || buffer_end - buffer < align_size)
+                {
+                    luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
+                }
+
+                union
+                {
+                    lua_Number x;
+                    char buf[sizeof(lua_Number)];
+                };
+
+                x = lua_tonumber(L, -1);
+                memcpy(buffer, buf, sizeof(lua_Number));
+                buffer += sizeof(lua_Number);
+            }
+            break;
+
+            case LUA_TSTRING:
+            {
+                buffer += SaveTSTRING(L, -1, buffer, buffer_size, buffer_end, count);
+            }
+            break;
+
+            case LUA_TUSERDATA:
+            {
+                if (buffer_end - buffer < 1)
+                {
+                    luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
+                }
+
+                char* sub_type = buffer++;
+
+                // NOTE: We align lua_Number to sizeof(float) even if lua_Number probably is of double type
+                intptr_t offset = buffer - original_buffer;
+                intptr_t aligned_buffer = ((intptr_t) offset + sizeof(float)-1) & ~(sizeof(float)-1);
+                intptr_t align_size = aligned_buffer - (intptr_t) offset;
+
+                if (buffer_end - buffer < align_size)
+                {
+                    luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
+                }
+
+#ifndef NDEBUG
+                memset(buffer, 0, align_size);
+#endif
+                buffer += align_size;
+
+                float* f = (float*) (buffer);
+                dmVMath::Vector3* v3;
+                dmVMath::Vector4* v4;
+                dmVMath::Quat* q;
+                dmVMath::Matrix4* m;
+                if ((v3 = ToVector3(L, -1)))
+                {
+                    if (buffer_end - buffer < int32_t(sizeof(float) * 3))
+                    {
+                        luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
+                    }
+
+                    *sub_type = (char) SUB_TYPE_VECTOR3;
+                    *f++ = v3->getX();
+                    *f++ = v3->getY();
+                    *f++ = v3->getZ();
+
+                    buffer += sizeof(float) * 3;
+                }
+                else if ((v4 = ToVector4(L, -1)))
+                {
+                    if (buffer_end - buffer < int32_t(sizeof(float) * 4))
+                    {
+                        luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
+                    }
+
+                    *sub_type = (char) SUB_TYPE_VECTOR4;
+                    *f++ = v4->getX();
+                    *f++ = v4->getY();
+                    *f++ = v4->getZ();
+                    *f++ = v4->getW();
+
+                    buffer += sizeof(float) * 4;
+                }
+                else if ((q = ToQuat(L, -1)))
+                {
+                    if (buffer_end - buffer < int32_t(sizeof(float) * 4))
+                    {
+                        luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
+                    }
+
+                    *sub_type = (char) SUB_TYPE_QUAT;
+                    *f++ = q->getX();
+                    *f++ = q->getY();
+                    *f++ = q->getZ();
+                    *f++ = q->getW();
+
+                    buffer += sizeof(float) * 4;
+                }
+                else if ((m = ToMatrix4(L, -1)))
+                {
+                    if (buffer_end - buffer < int32_t(sizeof(float) * 16))
+                    {
+                        luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
+                    }
+
+                    *sub_type = (char) SUB_TYPE_MATRIX4;
+                    for (uint32_t i = 0; i < 4; ++i)
+                        for (uint32_t j = 0; j < 4; ++j)
+                            *f++ = m->getElem(i, j);
+
+                    buffer += sizeof(float) * 16;
+                }
+                else if (IsHash(L, -1))
+                {
+                    dmhash_t hash = *(dmhash_t*)lua_touserdata(L, -1);
+                    const uint32_t hash_size = sizeof(dmhash_t);
+
+                    if (buffer_end - buffer < int32_t(hash_size))
+                    {
+                        luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
+                    }
+
+                    *sub_type = (char) SUB_TYPE_HASH;
+
+                    memcpy(buffer, (const void*)&hash, hash_size);
+                    buffer += hash_size;
+                }
+                else if (IsURL(L, -1))
+                {
+                    dmMessage::URL* url = (dmMessage::URL*)lua_touserdata(L, -1);
+                    const uint32_t url_size = sizeof(dmMessage::URL);
+
+                    if (buffer_end - buffer < int32_t(url_size))
+                    {
+                        luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
+                    }
+
+                    *sub_type = (char) SUB_TYPE_URL;
+
+                    memcpy(buffer, (const void*)url, url_size);
+                    buffer += url_size;
+                }
+                else
+                {
+                    luaL_error(L, "unsupported value type in table: %s", lua_typename(L, value_type));
+                }
+            }
+            break;
+
+            case LUA_TTABLE:
+            {
+                uint32_t n_used = DoCheckTable(L, header, original_buffer, buffer, buffer_end - buffer, -1, table_stack);
+                buffer += n_used;
+            }
+            break;
+
+            default:
+                luaL_error(L, "unsupported value type in table: %s", lua_typename(L, value_type));
+                break;
+        }
+        return buffer;
+    }
+
     uint32_t DoCheckTable(lua_State* L, const TableHeader& header, const char* original_buffer, char* buffer, uint32_t buffer_size, int index, dmArray<const void*>& table_stack)
     {
         int top = lua_gettop(L);
@@ -511,193 +707,7 @@ namespace dmScript
                 buffer = WriteEncodedIndex(L, key, header, buffer, buffer_end);
             }
 
-            switch (value_type)
-            {
-                case LUA_TBOOLEAN:
-                {
-                    if (buffer_end - buffer < 1)
-                    {
-                        luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
-                    }
-                    (*buffer++) = (char) lua_toboolean(L, -1);
-                }
-                break;
-
-                case LUA_TNUMBER:
-                {
-                    // NOTE: We align lua_Number to sizeof(float) even if lua_Number probably is of double type
-                    intptr_t offset = buffer - original_buffer;
-                    intptr_t aligned_buffer = ((intptr_t) offset + sizeof(float)-1) & ~(sizeof(float)-1);
-                    intptr_t align_size = aligned_buffer - (intptr_t) offset;
-
-                    if (buffer_end - buffer < align_size)
-                    {
-                        luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
-                    }
-
-#ifndef NDEBUG
-                    memset(buffer, 0, align_size);
-#endif
-                    buffer += align_size;
-
-                    if (buffer_end - buffer < int32_t(sizeof(lua_Number)) || buffer_end - buffer < align_size)
-                    {
-                        luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
-                    }
-
-                    union
-                    {
-                        lua_Number x;
-                        char buf[sizeof(lua_Number)];
-                    };
-
-                    x = lua_tonumber(L, -1);
-                    memcpy(buffer, buf, sizeof(lua_Number));
-                    buffer += sizeof(lua_Number);
-                }
-                break;
-
-                case LUA_TSTRING:
-                {
-                    buffer += SaveTSTRING(L, -1, buffer, buffer_size, buffer_end, count);
-                }
-                break;
-
-                case LUA_TUSERDATA:
-                {
-                    if (buffer_end - buffer < 1)
-                    {
-                        luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
-                    }
-
-                    char* sub_type = buffer++;
-
-                    // NOTE: We align lua_Number to sizeof(float) even if lua_Number probably is of double type
-                    intptr_t offset = buffer - original_buffer;
-                    intptr_t aligned_buffer = ((intptr_t) offset + sizeof(float)-1) & ~(sizeof(float)-1);
-                    intptr_t align_size = aligned_buffer - (intptr_t) offset;
-
-                    if (buffer_end - buffer < align_size)
-                    {
-                        luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
-                    }
-
-#ifndef NDEBUG
-                    memset(buffer, 0, align_size);
-#endif
-                    buffer += align_size;
-
-                    float* f = (float*) (buffer);
-                    dmVMath::Vector3* v3;
-                    dmVMath::Vector4* v4;
-                    dmVMath::Quat* q;
-                    dmVMath::Matrix4* m;
-                    if ((v3 = ToVector3(L, -1)))
-                    {
-                        if (buffer_end - buffer < int32_t(sizeof(float) * 3))
-                        {
-                            luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
-                        }
-
-                        *sub_type = (char) SUB_TYPE_VECTOR3;
-                        *f++ = v3->getX();
-                        *f++ = v3->getY();
-                        *f++ = v3->getZ();
-
-                        buffer += sizeof(float) * 3;
-                    }
-                    else if ((v4 = ToVector4(L, -1)))
-                    {
-                        if (buffer_end - buffer < int32_t(sizeof(float) * 4))
-                        {
-                            luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
-                        }
-
-                        *sub_type = (char) SUB_TYPE_VECTOR4;
-                        *f++ = v4->getX();
-                        *f++ = v4->getY();
-                        *f++ = v4->getZ();
-                        *f++ = v4->getW();
-
-                        buffer += sizeof(float) * 4;
-                    }
-                    else if ((q = ToQuat(L, -1)))
-                    {
-                        if (buffer_end - buffer < int32_t(sizeof(float) * 4))
-                        {
-                            luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
-                        }
-
-                        *sub_type = (char) SUB_TYPE_QUAT;
-                        *f++ = q->getX();
-                        *f++ = q->getY();
-                        *f++ = q->getZ();
-                        *f++ = q->getW();
-
-                        buffer += sizeof(float) * 4;
-                    }
-                    else if ((m = ToMatrix4(L, -1)))
-                    {
-                        if (buffer_end - buffer < int32_t(sizeof(float) * 16))
-                        {
-                            luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
-                        }
-
-                        *sub_type = (char) SUB_TYPE_MATRIX4;
-                        for (uint32_t i = 0; i < 4; ++i)
-                            for (uint32_t j = 0; j < 4; ++j)
-                                *f++ = m->getElem(i, j);
-
-                        buffer += sizeof(float) * 16;
-                    }
-                    else if (IsHash(L, -1))
-                    {
-                        dmhash_t hash = *(dmhash_t*)lua_touserdata(L, -1);
-                        const uint32_t hash_size = sizeof(dmhash_t);
-
-                        if (buffer_end - buffer < int32_t(hash_size))
-                        {
-                            luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
-                        }
-
-                        *sub_type = (char) SUB_TYPE_HASH;
-
-                        memcpy(buffer, (const void*)&hash, hash_size);
-                        buffer += hash_size;
-                    }
-                    else if (IsURL(L, -1))
-                    {
-                        dmMessage::URL* url = (dmMessage::URL*)lua_touserdata(L, -1);
-                        const uint32_t url_size = sizeof(dmMessage::URL);
-
-                        if (buffer_end - buffer < int32_t(url_size))
-                        {
-                            luaL_error(L, "buffer (%d bytes) too small for table, exceeded at value (%s) for element #%d", buffer_size, lua_typename(L, key_type), count);
-                        }
-
-                        *sub_type = (char) SUB_TYPE_URL;
-
-                        memcpy(buffer, (const void*)url, url_size);
-                        buffer += url_size;
-                    }
-                    else
-                    {
-                        luaL_error(L, "unsupported value type in table: %s", lua_typename(L, value_type));
-                    }
-                }
-                break;
-
-                case LUA_TTABLE:
-                {
-                    uint32_t n_used = DoCheckTable(L, header, original_buffer, buffer, buffer_end - buffer, -1, table_stack);
-                    buffer += n_used;
-                }
-                break;
-
-                default:
-                    luaL_error(L, "unsupported value type in table: %s", lua_typename(L, value_type));
-                    break;
-            }
+            buffer = SaveValue(L, header, original_buffer, buffer, buffer_end, buffer_size, key_type, count, table_stack);
 
             lua_pop(L, 1);
         }
@@ -732,6 +742,55 @@ namespace dmScript
         }
     }
 
+    uint32_t CheckTableArgs(lua_State* L, char* buffer, uint32_t buffer_size, int index, int count)
+    {
+        assert((intptr_t)buffer % 16 == 0);
+        if (buffer_size < sizeof(TableHeader) + 4)
+        {
+            luaL_error(L, "buffer (%d bytes) too small for header (%zu bytes)", buffer_size, sizeof(TableHeader) + 4);
+            return 0;
+        }
+
+        char* original_buffer = buffer;
+        const char* buffer_end = buffer + buffer_size;
+
+        TableHeader* header = (TableHeader*)buffer;
+        header->m_Magic = TABLE_MAGIC;
+        header->m_Version = TABLE_VERSION_CURRENT;
+        buffer += sizeof(TableHeader);
+
+        // Make room for count (4 bytes)
+        char* count_buffer = buffer;
+        buffer += 4;
+
+        dmArray<const void*> table_stack;
+        uint32_t n = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            // Like in a table constructor, nil values leave holes
+            if (lua_isnil(L, index + i))
+            {
+                continue;
+            }
+            ++n;
+
+            if (buffer_end - buffer < 2)
+            {
+                luaL_error(L, "buffer (%d bytes) too small for table, exceeded at key for element #%d", buffer_size, n);
+            }
+
+            lua_pushvalue(L, index + i);
+            (*buffer++) = (char) LUA_TNUMBER;
+            (*buffer++) = (char) lua_type(L, -1);
+            buffer = WriteEncodedIndex(L, i + 1, *header, buffer, buffer_end);
+            buffer = SaveValue(L, *header, original_buffer, buffer, buffer_end, buffer_size, LUA_TNUMBER, n, table_stack);
+            lua_pop(L, 1);
+        }
+
+        memcpy(count_buffer, &n, sizeof(uint32_t));
+        return buffer - original_buffer;
+    }
+
     static const char* ReadHeader(const char* buffer, TableHeader& header)
     {
         TableHeader* buffered_header = (TableHeader*)buffer;
@@ -15,10 +15,12 @@
 #include "script_timer.h"
 #include "script_timer_private.h"
 
+#include <math.h>
 #include <string.h>
-#include <dlib/object_pool.h>
+#include <dlib/array.h>
+#include <dlib/hashtable.h>
+#include <dlib/math.h>
 #include <dlib/profile.h>
-#include <dlib/set.h>
 
 #include "script.h"
 #include "script_private.h"
@@ -42,10 +44,19 @@ namespace dmScript
      */
 
     /*
-        The timer handle is an index into an indirection layer combined with a generation counter,
-        this makes it possible to reuse the index for the indirection layer without risk of using
-        stale indexes - the caller to CancelTimer is allowed to call with an handle of a timer that already
-        has expired.
+        The timer handle is an index into the timer array combined with a generation counter,
+        this makes it possible to reuse the index without risk of using stale handles - the caller
+        to CancelTimer is allowed to call with an handle of a timer that already has expired.
+
+        The timers are kept in a hierarchical timing wheel, so that adding and cancelling a timer is O(1),
+        and an update only touches the timers that expire (plus the occasional cascade of a slot of
+        a higher level down to the lower levels).
+        The time is quantized into ticks. The first level has a slot for each of the next TIMER_WHEEL_SLOTS0 ticks.
+        Each slot of the next levels covers all the slots of the level below it.
+        Timers further into the future than the last level can hold are put in the last slot of the last
+        level, and are sorted into the right slot each time they are cascaded.
+
+        The world time is kept in double precision, so that it doesn't drift over long sessions.
 
         Each script instance needs to call KillTimers for its owner to clean up potential timers
         that has not yet been cancelled or completed (one-shot).
@@ -54,90 +65,235 @@ namespace dmScript
     static const char TIMER_WORLD_VALUE_KEY[] = "__dm_timer_world__";
     static const uint32_t TIMER_WORLD_VALUE_KEY_HASH = dmHashBuffer32(TIMER_WORLD_VALUE_KEY, sizeof(TIMER_WORLD_VALUE_KEY) - 1);
 
+    static const double   TIMER_TICKS_PER_SECOND = 256.0;
+    static const uint32_t TIMER_WHEEL_BITS0 = 8;
+    static const uint32_t TIMER_WHEEL_BITS = 6;
+    static const uint32_t TIMER_WHEEL_SLOTS0 = 1 << TIMER_WHEEL_BITS0;
+    static const uint32_t TIMER_WHEEL_SLOTS = 1 << TIMER_WHEEL_BITS;
+    static const uint32_t TIMER_WHEEL_LEVELS = 4; // Not counting the first level
+    static const uint32_t TIMER_WHEEL_SLOT_COUNT = TIMER_WHEEL_SLOTS0 + TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS;
+    static const uint64_t TIMER_WHEEL_MAX_TICKS = (1ull << (TIMER_WHEEL_BITS0 + TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)) - 1;
+
+    static const uint32_t TIMER_INDEX_BITS = 18;
+    static const uint32_t TIMER_INDEX_MASK = (1u << TIMER_INDEX_BITS) - 1;
+    static const uint32_t TIMER_GENERATION_MASK = (1u << 13) - 1; // Keeps the handles positive as Lua integers
+    static const uint32_t TIMER_INVALID_INDEX = 0xffffffffu;
+
     struct Timer
     {
         TimerCallback   m_Callback;
         uintptr_t       m_Owner;
         uintptr_t       m_UserData;
 
+        // The world time when the timer fires
+        double          m_FireTime;
+
         // Store complete timer handle with generation here to identify stale timer handles
         HTimer          m_Handle;
 
-        // How much time remaining until the timer fires
-        float           m_Remaining;
-
         // The timer delay, we need to keep this for repeating timers
         float           m_Delay;
 
+        // The list of timers in the same wheel slot. Also used for the free list
+        uint32_t        m_Next;
+        uint32_t        m_Prev;
+        // The list of timers with the same owner
+        uint32_t        m_OwnerNext;
+        uint32_t        m_OwnerPrev;
+
+        // The wheel slot, or TIMER_INVALID_INDEX if the timer isn't in the wheel
+        uint32_t        m_Slot;
+
+        // Incremented each time the timer is freed
+        uint16_t        m_Generation;
+
         // Flag if the timer should repeat
-        uint32_t        m_Repeat : 1;
+        uint16_t        m_Repeat : 1;
         // Flag if the timer is alive
-        uint32_t        m_IsAlive : 1;
+        uint16_t        m_IsAlive : 1;
+        // Flag if the timer is allocated
+        uint16_t        m_InUse : 1;
     };
 
     #define INITIAL_TIMER_CAPACITY      8u
-    #define TIMER_CAPACITY_GROWTH       16u
 
     struct TimerWorld
     {
-        dmObjectPool<Timer> m_Timers;
-        dmSet<uint16_t>     m_Instances; // the pool indices
-        dmArray<uint16_t>   m_ScratchBuffer; // When doing operations on the timer instances, we need a copy to avoid self modification of m_Instances
-        uint16_t            m_Version;   // Incremented to avoid collisions each time we push timer indexes back to the m_IndexPool
-        uint16_t            m_InUpdate : 1;
-        uint16_t            m_IsDirty : 1;
+        dmArray<Timer>                      m_Timers;
+        dmHashTable<uintptr_t, uint32_t>    m_OwnerTimers;  // The first timer of each owner
+        dmArray<uint32_t>                   m_Expired;      // The timers that expired during the update
+        dmArray<uint32_t>                   m_Dead;         // The timers that died during the update, freed at the end of it
+        uint32_t                            m_Slots[TIMER_WHEEL_SLOT_COUNT];
+        double                              m_Time;
+        uint64_t                            m_Tick;         // The current tick of the wheel
+        uint32_t                            m_FreeList;
+        uint32_t                            m_AliveCount;
+        uint16_t                            m_InUpdate : 1;
     };
 
     dmArray<TimerWorld*> g_Worlds;
 
-    static uint16_t GetIndexFromHandle(HTimer handle)
+    static uint32_t GetIndexFromHandle(HTimer handle)
+    {
+        return handle & TIMER_INDEX_MASK;
+    }
+
+    static HTimer MakeHandle(uint16_t generation, uint32_t index)
+    {
+        return (((uint32_t)generation & TIMER_GENERATION_MASK) << TIMER_INDEX_BITS) | index;
+    }
+
+    static uint64_t GetTick(double time)
+    {
+        return (uint64_t)(time * TIMER_TICKS_PER_SECOND);
+    }
+
+    static uint32_t GetWheelSlot(uint64_t tick, uint64_t current_tick)
+    {
+        if (tick < current_tick)
+        {
+            tick = current_tick;
+        }
+        uint64_t delta = tick - current_tick;
+        if (delta < TIMER_WHEEL_SLOTS0)
+        {
+            return (uint32_t)(tick & (TIMER_WHEEL_SLOTS0 - 1));
+        }
+        if (delta > TIMER_WHEEL_MAX_TICKS)
+        {
+            tick = current_tick + TIMER_WHEEL_MAX_TICKS;
+            delta = TIMER_WHEEL_MAX_TICKS;
+        }
+        uint32_t level = 1;
+        uint32_t shift = TIMER_WHEEL_BITS0;
+        while (delta >= (1ull << (shift + TIMER_WHEEL_BITS)))
+        {
+            ++level;
+            shift += TIMER_WHEEL_BITS;
+        }
+        return TIMER_WHEEL_SLOTS0 + (level - 1) * TIMER_WHEEL_SLOTS + (uint32_t)((tick >> shift) & (TIMER_WHEEL_SLOTS - 1));
+    }
+
+    static void LinkTimer(HTimerWorld timer_world, uint32_t index)
     {
-        return (uint16_t)(handle & 0xffffu);
+        Timer& timer = timer_world->m_Timers[index];
+        uint32_t slot = GetWheelSlot(GetTick(timer.m_FireTime), timer_world->m_Tick);
+        uint32_t head = timer_world->m_Slots[slot];
+        timer.m_Slot = slot;
+        timer.m_Prev = TIMER_INVALID_INDEX;
+        timer.m_Next = head;
+        if (head != TIMER_INVALID_INDEX)
+        {
+            timer_world->m_Timers[head].m_Prev = index;
+        }
+        timer_world->m_Slots[slot] = index;
     }
 
-    static HTimer MakeHandle(uint16_t generation, uint16_t lookup_index)
+    static void UnlinkTimer(HTimerWorld timer_world, uint32_t index)
     {
-        return (((uint32_t)generation) << 16) | (lookup_index);
+        Timer& timer = timer_world->m_Timers[index];
+        if (timer.m_Slot == TIMER_INVALID_INDEX)
+        {
+            return;
+        }
+        if (timer.m_Prev != TIMER_INVALID_INDEX)
+            timer_world->m_Timers[timer.m_Prev].m_Next = timer.m_Next;
+        else
+            timer_world->m_Slots[timer.m_Slot] = timer.m_Next;
+        if (timer.m_Next != TIMER_INVALID_INDEX)
+            timer_world->m_Timers[timer.m_Next].m_Prev = timer.m_Prev;
+        timer.m_Slot = TIMER_INVALID_INDEX;
     }
 
     static Timer* AllocateTimer(HTimerWorld timer_world, uintptr_t owner)
     {
         assert(timer_world != 0x0);
 
-        if (timer_world->m_Timers.Full() && timer_world->m_Timers.Capacity() == MAX_TIMER_CAPACITY)
+        dmArray<Timer>& timers = timer_world->m_Timers;
+        uint32_t index = timer_world->m_FreeList;
+        if (index == TIMER_INVALID_INDEX)
         {
-            dmLogError("Timer could not be stored since the timer buffer is full (%d).", MAX_TIMER_CAPACITY);
-            return 0x0;
+            if (timers.Size() == MAX_TIMER_CAPACITY)
+            {
+                dmLogError("Timer could not be stored since the timer buffer is full (%d).", MAX_TIMER_CAPACITY);
+                return 0x0;
+            }
+            if (timers.Full())
+            {
+                uint32_t cap = timers.Capacity() * 2;
+                if (cap > MAX_TIMER_CAPACITY)
+                    cap = MAX_TIMER_CAPACITY;
+                timers.SetCapacity(cap);
+            }
+            index = timers.Size();
+            timers.SetSize(index + 1);
+            timers[index].m_Generation = 0;
         }
-
-        if (timer_world->m_Timers.Full())
+        else
         {
-            uint32_t cap = timer_world->m_Timers.Capacity() + TIMER_CAPACITY_GROWTH;
-            if (cap > MAX_TIMER_CAPACITY)
-                cap = MAX_TIMER_CAPACITY;
-            timer_world->m_Timers.SetCapacity(cap);
-            timer_world->m_Instances.SetCapacity(cap);
+            timer_world->m_FreeList = timers[index].m_Next;
         }
 
-        uint16_t timer_index = (uint16_t)timer_world->m_Timers.Alloc();
-        Timer* timer = &timer_world->m_Timers.Get(timer_index);
-        timer_world->m_Instances.Add(timer_index);
+        dmHashTable<uintptr_t, uint32_t>& owner_timers = timer_world->m_OwnerTimers;
+        uint32_t* owner_head = owner_timers.Get(owner);
+        if (owner_head == 0 && owner_timers.Full())
+        {
+            uint32_t cap = owner_timers.Capacity() * 2;
+            owner_timers.SetCapacity(cap / 2 + 1, cap);
+        }
 
+        Timer* timer = &timers[index];
+        uint16_t generation = timer->m_Generation;
         memset(timer, 0, sizeof(Timer));
-        timer->m_Handle = MakeHandle(timer_world->m_Version, timer_index);
+        timer->m_Generation = generation;
+        timer->m_Handle = MakeHandle(generation, index);
         timer->m_Owner = owner;
+        timer->m_Slot = TIMER_INVALID_INDEX;
+        timer->m_InUse = 1;
 
-        timer_world->m_IsDirty = 1;
+        timer->m_OwnerPrev = TIMER_INVALID_INDEX;
+        timer->m_OwnerNext = owner_head ? *owner_head : TIMER_INVALID_INDEX;
+        if (owner_head)
+        {
+            timers[*owner_head].m_OwnerPrev = index;
+            *owner_head = index;
+        }
+        else
+        {
+            owner_timers.Put(owner, index);
+        }
         return timer;
     }
 
-    static void DeallocateTimer(HTimerWorld timer_world, uint16_t timer_index)
+    static void DeallocateTimer(HTimerWorld timer_world, uint32_t index)
     {
         assert(timer_world != 0x0);
 
-        timer_world->m_Instances.Remove(timer_index);
-        timer_world->m_Timers.Free(timer_index, true);
-        timer_world->m_IsDirty = 1;
+        dmArray<Timer>& timers = timer_world->m_Timers;
+        Timer& timer = timers[index];
+        UnlinkTimer(timer_world, index);
+
+        if (timer.m_OwnerPrev != TIMER_INVALID_INDEX)
+        {
+            timers[timer.m_OwnerPrev].m_OwnerNext = timer.m_OwnerNext;
+        }
+        else if (timer.m_OwnerNext != TIMER_INVALID_INDEX)
+        {
+            *timer_world->m_OwnerTimers.Get(timer.m_Owner) = timer.m_OwnerNext;
+        }
+        else
+        {
+            timer_world->m_OwnerTimers.Erase(timer.m_Owner);
+        }
+        if (timer.m_OwnerNext != TIMER_INVALID_INDEX)
+        {
+            timers[timer.m_OwnerNext].m_OwnerPrev = timer.m_OwnerPrev;
+        }
+
+        timer.m_InUse = 0;
+        ++timer.m_Generation;
+        timer.m_Next = timer_world->m_FreeList;
+        timer_world->m_FreeList = index;
     }
 
     static void FreeTimer(HTimerWorld timer_world, Timer* timer)
@@ -152,19 +308,44 @@ namespace dmScript
             DestroyCallback(callback);
         }
 
-        uint16_t index = GetIndexFromHandle(timer->m_Handle);
+        uint32_t index = GetIndexFromHandle(timer->m_Handle);
         DeallocateTimer(timer_world, index);
     }
 
+    // Marks the timer as dead. While updating, the timer is freed at the end of the update
+    static void KillTimer(HTimerWorld timer_world, Timer* timer)
+    {
+        assert(timer->m_IsAlive == 1);
+        timer->m_IsAlive = 0;
+        --timer_world->m_AliveCount;
+
+        uint32_t index = GetIndexFromHandle(timer->m_Handle);
+        UnlinkTimer(timer_world, index);
+        if (timer_world->m_InUpdate)
+        {
+            if (timer_world->m_Dead.Full())
+            {
+                timer_world->m_Dead.OffsetCapacity(dmMath::Max(16u, timer_world->m_Dead.Capacity()));
+            }
+            timer_world->m_Dead.Push(index);
+        }
+    }
+
     HTimerWorld NewTimerWorld()
     {
         TimerWorld* timer_world = new TimerWorld();
         timer_world->m_Timers.SetCapacity(INITIAL_TIMER_CAPACITY);
-        timer_world->m_Instances.SetCapacity(INITIAL_TIMER_CAPACITY);
+        timer_world->m_OwnerTimers.SetCapacity(INITIAL_TIMER_CAPACITY / 2 + 1, INITIAL_TIMER_CAPACITY);
+        for (uint32_t i = 0; i < TIMER_WHEEL_SLOT_COUNT; ++i)
+        {
+            timer_world->m_Slots[i] = TIMER_INVALID_INDEX;
+        }
 
-        timer_world->m_Version = 0;
+        timer_world->m_Time = 0.0;
+        timer_world->m_Tick = 0;
+        timer_world->m_FreeList = TIMER_INVALID_INDEX;
+        timer_world->m_AliveCount = 0;
         timer_world->m_InUpdate = 0;
-        timer_world->m_IsDirty = 0;
         return timer_world;
     }
 
@@ -174,19 +355,19 @@ namespace dmScript
         delete timer_world;
     }
 
-    static Timer* GetTimerFromIndex(HTimerWorld timer_world, uint16_t index)
+    static Timer* GetTimerFromIndex(HTimerWorld timer_world, uint32_t index)
     {
         assert(timer_world != 0x0);
-        if (!timer_world->m_Instances.Contains(index))
+        if (index >= timer_world->m_Timers.Size() || !timer_world->m_Timers[index].m_InUse)
         {
             return 0;
         }
-        return &timer_world->m_Timers.Get(index);
+        return &timer_world->m_Timers[index];
     }
 
     static Timer* GetTimerFromHandle(HTimerWorld timer_world, HTimer handle)
     {
-        uint16_t index = GetIndexFromHandle(handle);
+        uint32_t index = GetIndexFromHandle(handle);
         Timer* timer = GetTimerFromIndex(timer_world, index);
         if (!timer)
             return 0;
@@ -195,19 +376,60 @@ namespace dmScript
         return timer;
     }
 
-    static uint32_t CopyIndices(dmSet<uint16_t>& src, dmArray<uint16_t>& tgt)
+    static float GetTimeRemaining(HTimerWorld timer_world, const Timer* timer)
+    {
+        return (float)(timer->m_FireTime - timer_world->m_Time);
+    }
+
+    // Moves the expired timers of the current tick to m_Expired. The timers of earlier ticks have all expired
+    static void CollectExpiredTimers(HTimerWorld timer_world, uint64_t current_tick)
     {
-        uint32_t size = src.Size();
-        if (size > tgt.Capacity())
+        uint32_t slot = (uint32_t)(timer_world->m_Tick & (TIMER_WHEEL_SLOTS0 - 1));
+        uint32_t index = timer_world->m_Slots[slot];
+        while (index != TIMER_INVALID_INDEX)
         {
-            tgt.SetCapacity(size);
+            Timer& timer = timer_world->m_Timers[index];
+            uint32_t next = timer.m_Next;
+            if (timer_world->m_Tick < current_tick || timer.m_FireTime <= timer_world->m_Time)
+            {
+                UnlinkTimer(timer_world, index);
+                if (timer_world->m_Expired.Full())
+                {
+                    timer_world->m_Expired.OffsetCapacity(dmMath::Max(16u, timer_world->m_Expired.Capacity()));
+                }
+                timer_world->m_Expired.Push(index);
+            }
+            index = next;
         }
-        tgt.SetSize(size);
-        for (uint32_t i = 0; i < size; ++i)
+    }
+
+    // Sorts the timers of a slot into the lower levels
+    static void CascadeTimers(HTimerWorld timer_world, uint32_t slot)
+    {
+        uint32_t index = timer_world->m_Slots[slot];
+        timer_world->m_Slots[slot] = TIMER_INVALID_INDEX;
+        while (index != TIMER_INVALID_INDEX)
+        {
+            uint32_t next = timer_world->m_Timers[index].m_Next;
+            LinkTimer(timer_world, index);
+            index = next;
+        }
+    }
+
+    static void AdvanceTick(HTimerWorld timer_world)
+    {
+        uint64_t tick = ++timer_world->m_Tick;
+        uint32_t shift = TIMER_WHEEL_BITS0;
+        for (uint32_t level = 1; level <= TIMER_WHEEL_LEVELS; ++level)
         {
-            tgt[i] = src[i];
+            if ((tick & ((1ull << shift) - 1)) != 0)
+            {
+                break;
+            }
+            uint32_t slot = (uint32_t)((tick >> shift) & (TIMER_WHEEL_SLOTS - 1));
+            CascadeTimers(timer_world, TIMER_WHEEL_SLOTS0 + (level - 1) * TIMER_WHEEL_SLOTS + slot);
+            shift += TIMER_WHEEL_BITS;
         }
-        return size;
     }
 
     void UpdateTimers(HTimerWorld timer_world, float dt)
@@ -215,45 +437,41 @@ namespace dmScript
         assert(timer_world != 0x0);
         DM_PROFILE("Update");
 
-        timer_world->m_InUpdate = 1;
-
-        // We make a copy of the indices, as it's possible the m_Instances may be altered
-        // Any timers added during this update call, will be updated the next frame
-        uint32_t size = CopyIndices(timer_world->m_Instances, timer_world->m_ScratchBuffer);
+        DM_PROPERTY_ADD_U32(rmtp_TimerCount, timer_world->m_AliveCount);
 
-        DM_PROPERTY_ADD_U32(rmtp_TimerCount, size);
+        timer_world->m_InUpdate = 1;
+        timer_world->m_Time += dt;
 
-        for (uint32_t i = 0; i < size; ++i)
+        // Collect the expired timers before calling any callbacks, so that
+        // any timers added during this update call are updated the next frame
+        uint64_t current_tick = GetTick(timer_world->m_Time);
+        while (1)
         {
-            uint16_t index = timer_world->m_ScratchBuffer[i];
-            Timer* timer = GetTimerFromIndex(timer_world, index);
-            if (!timer)
+            CollectExpiredTimers(timer_world, current_tick);
+            if (timer_world->m_Tick >= current_tick)
             {
-                continue;
+                break;
             }
+            AdvanceTick(timer_world);
+        }
 
+        uint32_t size = timer_world->m_Expired.Size();
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            uint32_t index = timer_world->m_Expired[i];
+            Timer* timer = &timer_world->m_Timers[index];
             if (timer->m_IsAlive == 0)
             {
-                continue;
-            }
-
-            timer->m_Remaining -= dt;
-            if (timer->m_Remaining > 0.0f)
-            {
-                continue;
+                continue; // Cancelled by an earlier callback
             }
 
-            float elapsed_time = timer->m_Delay - timer->m_Remaining;
+            float elapsed_time = timer->m_Delay - GetTimeRemaining(timer_world, timer);
 
             TimerEventType eventType = timer->m_Repeat == 0 ? TIMER_EVENT_TRIGGER_WILL_DIE : TIMER_EVENT_TRIGGER_WILL_REPEAT;
             timer->m_Callback(timer_world, eventType, timer->m_Handle, elapsed_time, timer->m_Owner, timer->m_UserData);
 
-            if (timer_world->m_IsDirty)
-            {
-                // If the containers were reallocated, the current timer pointer needs to get fetched again
-                timer = GetTimerFromIndex(timer_world, index);
-                assert(timer);
-            }
+            // If the timer array was reallocated, the current timer pointer needs to get fetched again
+            timer = &timer_world->m_Timers[index];
 
             if (timer->m_IsAlive == 0)
             {
@@ -262,42 +480,35 @@ namespace dmScript
 
             if (timer->m_Repeat == 0)
             {
-                timer->m_IsAlive = 0;
+                KillTimer(timer_world, timer);
                 continue;
             }
 
             if (timer->m_Delay == 0.0f)
             {
-                timer->m_Remaining = 0.0f;
-                continue;
+                timer->m_FireTime = timer_world->m_Time;
             }
-
-            float wrapped_count = ((-timer->m_Remaining) / timer->m_Delay) + 1.f;
-            float offset_to_next_trigger  = floor(wrapped_count) * timer->m_Delay;
-            timer->m_Remaining += offset_to_next_trigger;
-            if (timer->m_Remaining < 0) // If the delay is very small, the floating point precision might produce issues
-                timer->m_Remaining = timer->m_Delay; // reset the timer
+            else
+            {
+                double wrapped_count = ((timer_world->m_Time - timer->m_FireTime) / timer->m_Delay) + 1.0;
+                timer->m_FireTime += floor(wrapped_count) * timer->m_Delay;
+                if (timer->m_FireTime < timer_world->m_Time) // If the delay is very small, the floating point precision might produce issues
+                    timer->m_FireTime = timer_world->m_Time + timer->m_Delay; // reset the timer
+            }
+            LinkTimer(timer_world, index);
         }
+        timer_world->m_Expired.SetSize(0);
 
         timer_world->m_InUpdate = 0;
 
         // We need to do the deletes in a separate pass, as the
-        // callbacks may remove/add indices from the pool, thus messing up the current set of indices
+        // callbacks may still refer to the timers that died during the update
+        size = timer_world->m_Dead.Size();
         for (uint32_t i = 0; i < size; ++i)
         {
-            uint16_t index = timer_world->m_ScratchBuffer[i];
-            Timer* timer = GetTimerFromIndex(timer_world, index);
-            if (timer && timer->m_IsAlive == 0)
-            {
-                FreeTimer(timer_world, timer);
-            }
-        }
-
-        if (timer_world->m_IsDirty)
-        {
-            ++timer_world->m_Version;
+            FreeTimer(timer_world, &timer_world->m_Timers[timer_world->m_Dead[i]]);
         }
-        timer_world->m_IsDirty = 0;
+        timer_world->m_Dead.SetSize(0);
     }
 
     HTimer AddTimer(HTimerWorld timer_world,
@@ -318,12 +529,14 @@ namespace dmScript
         }
 
         timer->m_Delay = delay;
-        timer->m_Remaining = delay;
+        timer->m_FireTime = timer_world->m_Time + delay;
         timer->m_UserData = userdata;
         timer->m_Callback = timer_callback;
         timer->m_Repeat = repeat;
         timer->m_IsAlive = 1;
+        ++timer_world->m_AliveCount;
 
+        LinkTimer(timer_world, GetIndexFromHandle(timer->m_Handle));
         return timer->m_Handle;
     }
 
@@ -339,13 +552,13 @@ namespace dmScript
             return false;
         }
 
-        timer->m_IsAlive = 0;
+        KillTimer(timer_world, timer);
         timer->m_Callback(timer_world, TIMER_EVENT_CANCELLED, timer->m_Handle, 0.f, timer->m_Owner, timer->m_UserData);
 
         if (timer_world->m_InUpdate == 0)
         {
-            FreeTimer(timer_world, timer);
-            ++timer_world->m_Version;
+            // The callback may have added timers
+            FreeTimer(timer_world, GetTimerFromHandle(timer_world, handle));
         }
 
         return true;
@@ -355,26 +568,17 @@ namespace dmScript
     {
         assert(timer_world != 0x0);
 
-        uint32_t size = CopyIndices(timer_world->m_Instances, timer_world->m_ScratchBuffer);
+        uint32_t* owner_head = timer_world->m_OwnerTimers.Get(owner);
+        uint32_t index = owner_head ? *owner_head : TIMER_INVALID_INDEX;
         uint32_t cancelled_count = 0;
-        for (uint32_t i = 0; i < size; ++i)
+        while (index != TIMER_INVALID_INDEX)
         {
-            uint16_t index = timer_world->m_ScratchBuffer[i];
-            Timer* timer = GetTimerFromIndex(timer_world, index);
-
-            if (!timer)
-            {
-                continue;
-            }
-
-            if (timer->m_Owner != owner)
-            {
-                continue;
-            }
+            Timer* timer = &timer_world->m_Timers[index];
+            index = timer->m_OwnerNext;
 
             if (timer->m_IsAlive == 1)
             {
-                timer->m_IsAlive = 0;
+                KillTimer(timer_world, timer);
                 ++cancelled_count;
             }
 
@@ -391,17 +595,7 @@ namespace dmScript
     uint32_t GetAliveTimers(HTimerWorld timer_world)
     {
         assert(timer_world != 0x0);
-
-        uint32_t alive_timers = 0u;
-        uint32_t size = timer_world->m_Instances.Size();
-        for (uint32_t i = 0; i < size; ++i)
-        {
-            uint16_t index = timer_world->m_Instances[i]; // the pool indices
-            Timer* timer = GetTimerFromIndex(timer_world, index);
-
-            alive_timers += timer->m_IsAlive != 0 ? 1 : 0;
-        }
-        return alive_timers;
+        return timer_world->m_AliveCount;
     }
 
     static void SetTimerWorld(HScriptWorld script_world, HTimerWorld timer_world)
@@ -632,6 +826,82 @@ namespace dmScript
         return 1;
     }
 
+    static int TimerResumeCoroutine(lua_State* L)
+    {
+        // Invoked through the timer callback as (self, handle, time_elapsed)
+        lua_State* co = lua_tothread(L, lua_upvalueindex(1));
+        if (lua_status(co) != LUA_YIELD)
+        {
+            return 0;
+        }
+
+        lua_pushnumber(co, lua_tonumber(L, 3));
+        int ret = lua_resume(co, 1);
+        if (ret != 0 && ret != LUA_YIELD)
+        {
+            lua_pushstring(L, lua_tostring(co, -1));
+            lua_pop(co, 1);
+            return lua_error(L);
+        }
+        return 0;
+    }
+
+    /*# suspend the running coroutine
+     * Suspends the running coroutine and resumes it once the delay has passed.
+     *
+     * The coroutine is resumed directly by the timer system, so a waiting
+     * coroutine costs nothing per frame. It is resumed just before the script update
+     * functions, and in the same script instance context as when it was suspended.
+     *
+     * The function must be called from within a coroutine. If the script is deleted
+     * while the coroutine is waiting, the coroutine is never resumed.
+     *
+     * @name timer.sleep
+     * @param delay [type:number] time to wait in seconds
+     * @return time_elapsed [type:number] the elapsed time since timer.sleep was called
+     * @examples
+     *
+     * ```lua
+     * local co = coroutine.wrap(function()
+     *   timer.sleep(1)
+     *   print("one second later")
+     *   timer.sleep(2)
+     *   print("two more seconds later")
+     * end)
+     * co()
+     * ```
+     *
+     */
+    static int TimerSleep(lua_State* L)
+    {
+        const double seconds = luaL_checknumber(L, 1);
+        if (seconds < 0.0)
+        {
+            return luaL_error(L, "timer.sleep does not support negative delay times");
+        }
+
+        if (lua_pushthread(L))
+        {
+            return luaL_error(L, "timer.sleep must be called from within a coroutine");
+        }
+        // [-1] running coroutine
+
+        dmScript::HTimerWorld timer_world = CheckTimerWorld(L);
+        uintptr_t owner = dmScript::GetInstanceId(L);
+
+        // The closure keeps the coroutine alive for as long as the timer holds the callback
+        lua_pushcclosure(L, TimerResumeCoroutine, 1);
+        LuaCallbackInfo* user_data = dmScript::CreateCallback(L, -1);
+        lua_pop(L, 1);
+        if (user_data == 0x0)
+        {
+            return luaL_error(L, "timer.sleep is unable to create a callback for the current script instance");
+        }
+
+        dmScript::AddTimer(timer_world, seconds, false, LuaTimerCallback, owner, (uintptr_t)user_data);
+        return lua_yield(L, 0);
+    }
+
     /*# cancel a timer
      *
      * You may cancel a timer from inside a timer callback.
@@ -704,7 +974,7 @@ namespace dmScript
             return 1;
         }
 
-        LuaTimerCallbackArgs args = { timer->m_Handle, timer->m_Delay - timer->m_Remaining };
+        LuaTimerCallbackArgs args = { timer->m_Handle, timer->m_Delay - GetTimeRemaining(timer_world, timer) };
         InvokeCallback(callback, LuaTimerCallbackArgsCB, &args);
 
         lua_pushboolean(L, 1);
@@ -757,7 +1027,7 @@ namespace dmScript
         }
 
         lua_newtable(L);
-        lua_pushnumber(L,timer->m_Remaining);
+        lua_pushnumber(L,GetTimeRemaining(timer_world, timer));
         lua_setfield(L, -2, "time_remaining");
         lua_pushnumber(L,timer->m_Delay);
         lua_setfield(L, -2, "delay");
@@ -771,6 +1041,7 @@ namespace dmScript
         { "cancel", TimerCancel },
         { "trigger", TimerTrigger},
         { "get_info", TimerGetInfo},
+        { "sleep", TimerSleep},
         { 0, 0 }
     };
 
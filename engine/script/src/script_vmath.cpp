@@ -2633,6 +2633,165 @@ namespace dmScript
         return 1;
     }
 
+    // The in place operations write the result to an existing vector or quaternion, and don't create any garbage.
+    // The result is computed before it's stored, so the output may also be one of the arguments
+
+    static int ArgumentTypeError(lua_State* L, const char* name, const char* types)
+    {
+        return luaL_error(L, "%s.%s accepts (%s) as arguments.", SCRIPT_LIB_NAME, name, types);
+    }
+
+    /*# adds two vectors in place
+     *
+     * Sets `out` to the sum of `v1` and `v2`, without creating a new vector.
+     * All vectors must be of the same type, and `out` may be one of `v1` and `v2`.
+     *
+     * @name vmath.add_to
+     * @param out [type:vector3|vector4] the vector that is set to the result
+     * @param v1 [type:vector3|vector4] first vector
+     * @param v2 [type:vector3|vector4] second vector
+     * @return out [type:vector3|vector4] the `out` vector
+     * @examples
+     *
+     * ```lua
+     * -- move a position without creating garbage
+     * vmath.add_to(self.position, self.position, self.velocity)
+     * ```
+     */
+    static int AddTo(lua_State* L)
+    {
+        Vector3* out3 = ToVector3(L, 1);
+        Vector4* out4 = ToVector4(L, 1);
+        if (out3)
+        {
+            *out3 = *CheckVector3(L, 2) + *CheckVector3(L, 3);
+        }
+        else if (out4)
+        {
+            *out4 = *CheckVector4(L, 2) + *CheckVector4(L, 3);
+        }
+        else
+        {
+            return ArgumentTypeError(L, "add_to", "vector3, vector3, vector3|vector4, vector4, vector4");
+        }
+        lua_settop(L, 1);
+        return 1;
+    }
+
+    /*# subtracts two vectors in place
+     *
+     * Sets `out` to `v1` minus `v2`, without creating a new vector.
+     * All vectors must be of the same type, and `out` may be one of `v1` and `v2`.
+     *
+     * @name vmath.sub_to
+     * @param out [type:vector3|vector4] the vector that is set to the result
+     * @param v1 [type:vector3|vector4] first vector
+     * @param v2 [type:vector3|vector4] second vector
+     * @return out [type:vector3|vector4] the `out` vector
+     * @examples
+     *
+     * ```lua
+     * local dir = vmath.vector3()
+     * vmath.sub_to(dir, target, position)
+     * ```
+     */
+    static int SubTo(lua_State* L)
+    {
+        Vector3* out3 = ToVector3(L, 1);
+        Vector4* out4 = ToVector4(L, 1);
+        if (out3)
+        {
+            *out3 = *CheckVector3(L, 2) - *CheckVector3(L, 3);
+        }
+        else if (out4)
+        {
+            *out4 = *CheckVector4(L, 2) - *CheckVector4(L, 3);
+        }
+        else
+        {
+            return ArgumentTypeError(L, "sub_to", "vector3, vector3, vector3|vector4, vector4, vector4");
+        }
+        lua_settop(L, 1);
+        return 1;
+    }
+
+    /*# multiplies in place
+     *
+     * Sets `out` to the product of the arguments, without creating a new vector or quaternion.
+     * A vector can be multiplied with a number (in any order), and a quaternion with a quaternion.
+     * `out` may be one of the arguments.
+     *
+     * @name vmath.mul_to
+     * @param out [type:vector3|vector4|quaternion] the vector or quaternion that is set to the result
+     * @param a [type:vector3|vector4|quaternion|number] first factor
+     * @param b [type:vector3|vector4|quaternion|number] second factor
+     * @return out [type:vector3|vector4|quaternion] the `out` argument
+     * @examples
+     *
+     * ```lua
+     * vmath.mul_to(self.velocity, self.velocity, 0.98)
+     * vmath.mul_to(self.rotation, self.rotation, spin)
+     * ```
+     */
+    static int MulTo(lua_State* L)
+    {
+        Vector3* out3 = ToVector3(L, 1);
+        Vector4* out4 = ToVector4(L, 1);
+        Quat* outq = ToQuat(L, 1);
+        bool scalar_first = lua_type(L, 2) == LUA_TNUMBER;
+        if (out3)
+        {
+            if (scalar_first)
+                *out3 = *CheckVector3(L, 3) * (float) lua_tonumber(L, 2);
+            else
+                *out3 = *CheckVector3(L, 2) * (float) luaL_checknumber(L, 3);
+        }
+        else if (out4)
+        {
+            if (scalar_first)
+                *out4 = *CheckVector4(L, 3) * (float) lua_tonumber(L, 2);
+            else
+                *out4 = *CheckVector4(L, 2) * (float) luaL_checknumber(L, 3);
+        }
+        else if (outq)
+        {
+            *outq = *CheckQuat(L, 2) * *CheckQuat(L, 3);
+        }
+        else
+        {
+            return ArgumentTypeError(L, "mul_to", "vector3|vector4|quaternion, ...");
+        }
+        lua_settop(L, 1);
+        return 1;
+    }
+
+    /*# rotates a vector by a quaternion in place
+     *
+     * Sets `out` to the vector `v1` rotated by the quaternion `q`, without creating a new vector.
+     * `out` may be the same vector as `v1`.
+     *
+     * @name vmath.rotate_to
+     * @param out [type:vector3] the vector that is set to the result
+     * @param q [type:quaternion] quaternion
+     * @param v1 [type:vector3] vector to rotate
+     * @return out [type:vector3] the `out` vector
+     * @examples
+     *
+     * ```lua
+     * local FORWARD = vmath.vector3(0, 0, -1)
+     * vmath.rotate_to(self.direction, self.rotation, FORWARD)
+     * ```
+     */
+    static int RotateTo(lua_State* L)
+    {
+        Vector3* out = CheckVector3(L, 1);
+        Quat* q = CheckQuat(L, 2);
+        Vector3* v = CheckVector3(L, 3);
+        *out = dmVMath::Rotate(*q, *v);
+        lua_settop(L, 1);
+        return 1;
+    }
+
     static const luaL_reg methods[] =
     {
         {SCRIPT_TYPE_NAME_VECTOR, Vector_new},
@@ -2674,6 +2833,10 @@ namespace dmScript
         {"matrix4_compose", Matrix4_Compose},
         {"matrix4_scale", Matrix4_Scale},
         {"clamp", Vector_Clamp},
+        {"add_to", AddTo},
+        {"sub_to", SubTo},
+        {"mul_to", MulTo},
+        {"rotate_to", RotateTo},
         {0, 0}
     };
 
@@ -202,10 +202,65 @@ function test_json_decode_encode()
     assert(tbl.sub.w == tbl_lua.sub.w)
 end
 
+function test_json_decode_stream()
+    local events = {}
+    json.decode_stream('{"a":[1,"two",true,null],"b":{"c":{"d":1}},"e":3}', function(event, key, value)
+        table.insert(events, { event, key, value })
+        -- skip the content of b
+        if event == json.OBJECT_BEGIN and key == "b" then
+            return false
+        end
+    end)
+    -- the order of the events follows the json data
+    local expected = {
+        { json.OBJECT_BEGIN, nil, nil },
+        { json.ARRAY_BEGIN, "a", nil },
+        { json.VALUE, 1, 1 },
+        { json.VALUE, 2, "two" },
+        { json.VALUE, 3, true },
+        { json.VALUE, 4, nil },
+        { json.ARRAY_END, "a", nil },
+        { json.OBJECT_BEGIN, "b", nil },
+        { json.VALUE, "e", 3 },
+        { json.OBJECT_END, nil, nil },
+    }
+    assert(#events == #expected)
+    for i, e in ipairs(expected) do
+        assert(events[i][1] == e[1])
+        assert(events[i][2] == e[2])
+        assert(events[i][3] == e[3])
+    end
+
+    -- root value
+    local root = nil
+    json.decode_stream('"str"', function(event, key, value) root = value end)
+    assert(root == "str")
+
+    -- null as userdata
+    json.decode_stream('null', function(event, key, value) root = value end, { decode_null_as_userdata = true })
+    assert(root == json.null)
+
+    -- syntax errors
+    local ret, msg = pcall(function() json.decode_stream('{"a":1,}', function() end) end)
+    assert(ret == false)
+    assert(string.find(msg, "Expected object key string but found T_OBJ_END at character 8", 1, true) ~= nil)
+    ret, msg = pcall(function() json.decode_stream('[1] 2', function() end) end)
+    assert(ret == false)
+    assert(string.find(msg, "Expected the end but found T_NUMBER at character 5", 1, true) ~= nil)
+    ret, msg = pcall(function() json.decode_stream('[1, 2', function() end) end)
+    assert(ret == false)
+
+    -- errors raised by the callback
+    ret, msg = pcall(function() json.decode_stream('[1]', function() error("callback error") end) end)
+    assert(ret == false)
+    assert(string.find(msg, "callback error") ~= nil)
+end
+
 function test_json()
     test_json_decode()
     test_json_encode()
     test_json_decode_encode()
+    test_json_decode_stream()
 end
 
 functions = { test_json = test_json }
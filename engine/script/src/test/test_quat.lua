@@ -114,3 +114,12 @@ assert(("foo " .. tostring(q)) == "foo vmath.quat(1, 2, 3, 4)")
 assert(("foo " .. q) == "foo vmath.quat(1, 2, 3, 4)")
 q = vmath.quat(-10.01, -10.01, -10.01, -10.01)
 assert(tostring(q) == ("" .. q))
+
+-- in place multiplication
+local q1 = vmath.quat_rotation_z(0.5)
+local q2 = vmath.quat_rotation_z(0.25)
+local out = vmath.quat()
+assert(rawequal(out, vmath.mul_to(out, q1, q2)), "mul_to returns out")
+assert(out == q1 * q2, "mul_to")
+vmath.mul_to(q1, q1, q2)
+assert(q1 == out, "mul_to in place")
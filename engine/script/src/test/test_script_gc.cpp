@@ -0,0 +1,173 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "script.h"
+#include "script_allocator.h"
+#include "test_script.h"
+
+#include <testmain/testmain.h>
+#include <dlib/math.h>
+
+#include <string.h>
+
+class ScriptGCTest : public dmScriptTest::ScriptTest
+{
+};
+
+static const char* MAKE_GARBAGE = "local t = {} for i=1,2000 do t[i] = {i, tostring(i)} end";
+
+TEST_F(ScriptGCTest, RequestCollection)
+{
+    ASSERT_TRUE(RunString(L, MAKE_GARBAGE));
+    uint32_t count = dmScript::GetLuaGCCount(L);
+
+    // Done at the end of the frame
+    ASSERT_TRUE(RunString(L, "sys.collect_garbage()"));
+    ASSERT_EQ(count, dmScript::GetLuaGCCount(L));
+
+    dmScript::StepGarbageCollector(m_Context, 0);
+    ASSERT_GT(count, dmScript::GetLuaGCCount(L));
+}
+
+TEST_F(ScriptGCTest, FrameBudget)
+{
+    lua_gc(L, LUA_GCCOLLECT, 0);
+    uint32_t base_count = dmScript::GetLuaGCCount(L);
+
+    dmScript::SetGarbageCollectorBudget(m_Context, 1000);
+
+    // The automatic collector is stopped
+    ASSERT_TRUE(RunString(L, MAKE_GARBAGE));
+    uint32_t count = dmScript::GetLuaGCCount(L);
+    ASSERT_TRUE(RunString(L, MAKE_GARBAGE));
+    ASSERT_LT(count, dmScript::GetLuaGCCount(L));
+
+    // The garbage is collected in the frames with slack
+    for (uint32_t i = 0; i < 1000 && dmScript::GetLuaGCCount(L) > base_count * 2; ++i)
+    {
+        dmScript::StepGarbageCollector(m_Context, 1000);
+    }
+    ASSERT_GE(base_count * 2, dmScript::GetLuaGCCount(L));
+
+    dmScript::SetGarbageCollectorBudget(m_Context, 0);
+}
+
+TEST_F(ScriptGCTest, KeepsUpWithoutSlack)
+{
+    dmScript::SetGarbageCollectorBudget(m_Context, 1000);
+
+    uint32_t max_count = 0;
+    for (uint32_t i = 0; i < 200; ++i)
+    {
+        ASSERT_TRUE(RunString(L, MAKE_GARBAGE));
+        dmScript::StepGarbageCollector(m_Context, 0);
+        max_count = dmMath::Max(max_count, dmScript::GetLuaGCCount(L));
+    }
+
+    // Each frame makes a few hundred KB of garbage. Without any collection, it would have grown past 50MB
+    ASSERT_GT(16U * 1024U, max_count);
+
+    dmScript::SetGarbageCollectorBudget(m_Context, 0);
+}
+
+extern "C" void dmExportedSymbols();
+
+TEST_F(ScriptGCTest, MemoryStats)
+{
+    dmScript::LuaMemoryStats stats;
+    if (!dmScript::GetLuaMemoryStats(m_Context, &stats))
+        return;
+
+    ASSERT_TRUE(RunString(L, MAKE_GARBAGE));
+    ASSERT_TRUE(dmScript::GetLuaMemoryStats(m_Context, &stats));
+    ASSERT_EQ(dmScript::GetLuaGCCount(L), stats.m_Active / 1024);
+    ASSERT_LE(stats.m_Active, stats.m_Reserved);
+    ASSERT_LT(0u, stats.m_AllocationCount);
+}
+
+TEST(LuaAllocator, SizeClasses)
+{
+    dmScript::LuaAllocator* allocator = dmScript::NewLuaAllocator(0);
+
+    void* a = dmScript::LuaAlloc(allocator, 0, 0, 20);
+    ASSERT_NE((void*)0, a);
+    ASSERT_EQ(0u, (uintptr_t)a % 16);
+    memset(a, 1, 20);
+
+    // Within the size class, the block is kept
+    ASSERT_EQ(a, dmScript::LuaAlloc(allocator, a, 20, 32));
+
+    void* b = dmScript::LuaAlloc(allocator, a, 32, 1000);
+    ASSERT_NE((void*)0, b);
+    ASSERT_EQ(1, ((uint8_t*)b)[19]);
+
+    // A freed block is reused
+    void* c = dmScript::LuaAlloc(allocator, 0, 0, 30);
+    ASSERT_EQ(a, c);
+
+    b = dmScript::LuaAlloc(allocator, b, 1000, 100000);
+    ASSERT_NE((void*)0, b);
+    ASSERT_EQ(1, ((uint8_t*)b)[19]);
+
+    dmScript::LuaMemoryStats stats;
+    dmScript::GetLuaAllocatorStats(allocator, &stats);
+    ASSERT_EQ(100030u, stats.m_Active);
+
+    ASSERT_EQ((void*)0, dmScript::LuaAlloc(allocator, b, 100000, 0));
+    ASSERT_EQ((void*)0, dmScript::LuaAlloc(allocator, c, 30, 0));
+    dmScript::GetLuaAllocatorStats(allocator, &stats);
+    ASSERT_EQ(0u, stats.m_Active);
+
+    dmScript::DeleteLuaAllocator(allocator);
+}
+
+TEST(LuaAllocator, MemoryLimit)
+{
+    dmScript::LuaAllocator* allocator = dmScript::NewLuaAllocator(1024);
+
+    void* a = dmScript::LuaAlloc(allocator, 0, 0, 512);
+    ASSERT_NE((void*)0, a);
+    ASSERT_FALSE(dmScript::TakeLuaAllocatorCollectRequest(allocator));
+
+    // Close to the limit, a collection is requested
+    void* b = dmScript::LuaAlloc(allocator, 0, 0, 400);
+    ASSERT_NE((void*)0, b);
+    ASSERT_TRUE(dmScript::TakeLuaAllocatorCollectRequest(allocator));
+    ASSERT_FALSE(dmScript::TakeLuaAllocatorCollectRequest(allocator));
+
+    // Past the limit, the allocation fails and the block is kept
+    ASSERT_EQ((void*)0, dmScript::LuaAlloc(allocator, a, 512, 700));
+    ASSERT_TRUE(dmScript::TakeLuaAllocatorCollectRequest(allocator));
+
+    dmScript::LuaMemoryStats stats;
+    dmScript::GetLuaAllocatorStats(allocator, &stats);
+    ASSERT_EQ(912u, stats.m_Active);
+    ASSERT_EQ(1u, stats.m_FailedCount);
+
+    dmScript::LuaAlloc(allocator, a, 512, 0);
+    a = dmScript::LuaAlloc(allocator, 0, 0, 600);
+    ASSERT_NE((void*)0, a);
+
+    dmScript::LuaAlloc(allocator, a, 600, 0);
+    dmScript::LuaAlloc(allocator, b, 400, 0);
+    dmScript::DeleteLuaAllocator(allocator);
+}
+
+int main(int argc, char **argv)
+{
+    dmExportedSymbols();
+    TestMainPlatformInit();
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
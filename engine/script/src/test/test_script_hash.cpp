@@ -14,6 +14,7 @@
 
 #include "script.h"
 #include "script_hash.h"
+#include "script_private.h"
 #include "test_script.h"
 
 #include <testmain/testmain.h>
@@ -66,6 +67,40 @@ TEST_F(ScriptHashTest, TestHash)
     ASSERT_EQ(top, lua_gettop(L));
 }
 
+TEST_F(ScriptHashTest, TestHashStringCache)
+{
+    int top = lua_gettop(L);
+
+    ASSERT_TRUE(RunString(L,
+        "local h = hash(\"cached\")\n"
+        "assert(rawequal(h, hash(\"cached\")))\n"
+        "assert(rawequal(h, hash(h)))\n"
+        "assert(h == hash(\"cached\"))\n"
+        "cached_hash = h\n"
+        ));
+
+    // The cache is dropped when full
+    char script[256];
+    dmSnPrintf(script, sizeof(script),
+        "for i=1,%u do hash(\"unique\" .. i) end\n"
+        "assert(rawequal(cached_hash, hash(\"cached\")))\n"
+        "assert(rawequal(hash(\"unique1\"), hash(\"unique1\")))\n",
+        dmScript::HASH_STRING_CACHE_SIZE * 2);
+    ASSERT_TRUE(RunString(L, script));
+
+    // A released hash is created again
+    ASSERT_TRUE(RunString(L, "released_hash = hash(\"released\")"));
+    dmScript::ReleaseHash(L, dmHashString64("released"));
+    ASSERT_TRUE(RunString(L,
+        "local h = hash(\"released\")\n"
+        "assert(not rawequal(h, released_hash))\n"
+        "assert(rawequal(h, hash(\"released\")))\n"
+        "assert(rawequal(cached_hash, hash(\"cached\")))\n"
+        ));
+
+    ASSERT_EQ(top, lua_gettop(L));
+}
+
 TEST_F(ScriptHashTest, TestHashUnknown)
 {
     int top = lua_gettop(L);
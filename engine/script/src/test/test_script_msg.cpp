@@ -681,6 +681,97 @@ TEST_F(ScriptMsgTest, TestPost)
     ASSERT_EQ(top, lua_gettop(L));
 }
 
+void DispatchCallbackArgs(dmMessage::Message *message, void* user_ptr)
+{
+    assert(message->m_Id == dmHashString64("args"));
+    TableUserData* user_data = (TableUserData*)user_ptr;
+    lua_State* L = user_data->L;
+    dmScript::PushTable(L, (const char*)message->m_Data, message->m_DataSize);
+    lua_setglobal(L, "__args");
+    assert(user_data->m_URL.m_Socket == message->m_Receiver.m_Socket);
+    assert(user_data->m_URL.m_Path == message->m_Receiver.m_Path);
+    assert(user_data->m_URL.m_Fragment == message->m_Receiver.m_Fragment);
+}
+
+TEST_F(ScriptMsgTest, TestPostPrepared)
+{
+    int top = lua_gettop(L);
+
+    dmMessage::HSocket socket;
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("socket", &socket));
+
+    // DDF
+    ASSERT_TRUE(dmScriptTest::RunString(L,
+        "local m = msg.prepare(\"socket:\", \"sub_msg\")\n"
+        "msg.post_prepared(m, {uint_value = 3})\n"
+        ));
+    uint32_t test_value = 0;
+    ASSERT_EQ(1u, dmMessage::Dispatch(socket, DispatchCallbackDDF, &test_value));
+    ASSERT_EQ(3u, test_value);
+
+    // Empty DDF
+    ASSERT_TRUE(dmScriptTest::RunString(L,
+        "local m = msg.prepare(\"socket:\", hash(\"empty_msg\"))\n"
+        "msg.post_prepared(m)\n"
+        ));
+    test_value = 0;
+    ASSERT_EQ(1u, dmMessage::Dispatch(socket, DispatchCallbackDDF, &test_value));
+    ASSERT_EQ(2u, test_value);
+
+    // table, posted many times
+    ASSERT_TRUE(dmScriptTest::RunString(L,
+        "local m = msg.prepare(\"socket:path2#fragment2\", \"table\")\n"
+        "msg.post_prepared(m, {uint_value = 1})\n"
+        "msg.post_prepared(m, {uint_value = 1})\n"
+        ));
+    TableUserData user_data;
+    user_data.L = L;
+    user_data.m_TestValue = 0;
+    user_data.m_URL.m_Socket = socket;
+    user_data.m_URL.m_Path = dmHashString64("path2");
+    user_data.m_URL.m_Fragment = dmHashString64("fragment2");
+    ASSERT_EQ(2u, dmMessage::Dispatch(socket, DispatchCallbackTable, &user_data));
+    ASSERT_EQ(1u, user_data.m_TestValue);
+
+    // values, relative receiver
+    ASSERT_TRUE(dmScriptTest::RunString(L,
+        "local m = msg.prepare(\"path2#fragment2\", \"args\")\n"
+        "msg.post_prepared(m, 10, nil, hash(\"fire\"), \"text\", vmath.vector3(1, 2, 3), {a = true})\n"
+        ));
+    user_data.m_URL.m_Socket = m_DefaultURL.m_Socket;
+    ASSERT_EQ(1u, dmMessage::Dispatch(m_DefaultURL.m_Socket, DispatchCallbackArgs, &user_data));
+    ASSERT_TRUE(dmScriptTest::RunString(L,
+        "assert(__args[1] == 10)\n"
+        "assert(__args[2] == nil)\n"
+        "assert(__args[3] == hash(\"fire\"))\n"
+        "assert(__args[4] == \"text\")\n"
+        "assert(__args[5] == vmath.vector3(1, 2, 3))\n"
+        "assert(__args[6].a == true)\n"
+        ));
+
+    // no values
+    ASSERT_TRUE(dmScriptTest::RunString(L,
+        "local m = msg.prepare(\"path2#fragment2\", \"args\")\n"
+        "msg.post_prepared(m)\n"
+        ));
+    ASSERT_EQ(1u, dmMessage::Dispatch(m_DefaultURL.m_Socket, DispatchCallbackArgs, &user_data));
+    ASSERT_TRUE(dmScriptTest::RunString(L,
+        "assert(next(__args) == nil)\n"
+        ));
+
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(socket));
+
+    ASSERT_FALSE(dmScriptTest::RunString(L,
+        "msg.post_prepared(msg.url(), 1)\n"
+        ));
+    ASSERT_FALSE(dmScriptTest::RunString(L,
+        "msg.post_prepared(msg.prepare(\".\", \"sub_msg\"), 1)\n"
+        ));
+
+    ASSERT_EQ(top+2, lua_gettop(L));
+    lua_pop(L, lua_gettop(L)-top);
+}
+
 TEST_F(ScriptMsgTest, TestFailPost)
 {
     int top = lua_gettop(L);
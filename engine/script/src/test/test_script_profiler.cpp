@@ -0,0 +1,176 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "script.h"
+#include "test_script.h"
+
+#include <string.h>
+#include <testmain/testmain.h>
+
+class ScriptProfilerTest : public dmScriptTest::ScriptTest
+{
+    void TearDown() override
+    {
+        dmScript::StopLuaProfiler();
+        dmScript::ResetLuaProfiler();
+        dmScriptTest::ScriptTest::TearDown();
+    }
+};
+
+// Spins for about 50ms, mostly in hot_function
+static const char* BUSY_SCRIPT =
+    "function hot_function(n)\n"
+    "    local x = 0\n"
+    "    for i = 1, n do x = x + math.sin(i) end\n"
+    "    return x\n"
+    "end\n"
+    "function busy()\n"
+    "    local start = os.clock()\n"
+    "    while os.clock() - start < 0.05 do hot_function(1000) end\n"
+    "end\n"
+    "busy()\n";
+
+struct FindEntryContext
+{
+    const char* m_Name;
+    uint32_t    m_Index;
+    uint32_t    m_Count;
+    uint32_t    m_FoundIndex;
+    uint32_t    m_SelfSamples;
+    uint32_t    m_TotalSamples;
+};
+
+static void FindEntry(void* _ctx, const dmScript::LuaProfilerEntry* entry)
+{
+    FindEntryContext* ctx = (FindEntryContext*)_ctx;
+    if (strcmp(entry->m_Name, ctx->m_Name) == 0)
+    {
+        ctx->m_FoundIndex = ctx->m_Index;
+        ctx->m_SelfSamples += entry->m_SelfSamples;
+        ctx->m_TotalSamples += entry->m_TotalSamples;
+    }
+    ctx->m_Index++;
+    ctx->m_Count++;
+}
+
+static FindEntryContext FindEntries(dmScript::LuaProfilerEntryType type, const char* name)
+{
+    FindEntryContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.m_Name = name;
+    ctx.m_FoundIndex = ~0u;
+    dmScript::IterateLuaProfilerEntries(type, FindEntry, &ctx);
+    return ctx;
+}
+
+struct StackContext
+{
+    uint32_t m_Count;
+    uint32_t m_LeafCount; // Stacks with the function as the running function
+    uint32_t m_Function;
+    uint64_t m_LastTime;
+    bool     m_Ordered;
+};
+
+static void CheckStack(void* _ctx, uint64_t time, const uint32_t* functions, uint32_t depth)
+{
+    StackContext* ctx = (StackContext*)_ctx;
+    ctx->m_Ordered = ctx->m_Ordered && time >= ctx->m_LastTime;
+    ctx->m_LastTime = time;
+    ctx->m_Count++;
+    if (depth > 0 && functions[0] == ctx->m_Function)
+        ctx->m_LeafCount++;
+}
+
+TEST_F(ScriptProfilerTest, Sampling)
+{
+    ASSERT_FALSE(dmScript::IsLuaProfilerRunning());
+    dmScript::StartLuaProfiler(L, 100);
+    ASSERT_TRUE(dmScript::IsLuaProfilerRunning());
+
+    ASSERT_TRUE(RunString(L, BUSY_SCRIPT));
+
+    dmScript::StopLuaProfiler();
+    ASSERT_FALSE(dmScript::IsLuaProfilerRunning());
+
+    uint32_t count = dmScript::GetLuaProfilerSampleCount();
+    ASSERT_LT(10u, count);
+
+    FindEntryContext hot = FindEntries(dmScript::LUA_PROFILER_ENTRY_FUNCTION, "hot_function");
+    ASSERT_NE(~0u, hot.m_FoundIndex);
+    ASSERT_LT(0u, hot.m_SelfSamples);
+    ASSERT_LE(hot.m_SelfSamples, hot.m_TotalSamples);
+    ASSERT_GE(count, hot.m_TotalSamples);
+
+    // busy() is on the stack in all samples, but hardly ever running
+    FindEntryContext busy = FindEntries(dmScript::LUA_PROFILER_ENTRY_FUNCTION, "busy");
+    ASSERT_NE(~0u, busy.m_FoundIndex);
+    ASSERT_LT(busy.m_SelfSamples, busy.m_TotalSamples);
+
+    // The lines of hot_function add up to the function
+    FindEntryContext hot_lines = FindEntries(dmScript::LUA_PROFILER_ENTRY_LINE, "hot_function");
+    ASSERT_LT(0u, hot_lines.m_Count);
+    ASSERT_EQ(hot.m_SelfSamples, hot_lines.m_SelfSamples);
+
+    StackContext stacks;
+    memset(&stacks, 0, sizeof(stacks));
+    stacks.m_Function = hot.m_FoundIndex;
+    stacks.m_Ordered = true;
+    dmScript::IterateLuaProfilerStacks(CheckStack, &stacks);
+    ASSERT_TRUE(stacks.m_Ordered);
+    ASSERT_EQ(count < 1024 ? count : 1024, stacks.m_Count);
+    ASSERT_LT(0u, stacks.m_LeafCount);
+
+    // No samples while stopped
+    ASSERT_TRUE(RunString(L, "busy()"));
+    ASSERT_EQ(count, dmScript::GetLuaProfilerSampleCount());
+
+    dmScript::ResetLuaProfiler();
+    ASSERT_EQ(0u, dmScript::GetLuaProfilerSampleCount());
+    ASSERT_EQ(0u, FindEntries(dmScript::LUA_PROFILER_ENTRY_FUNCTION, "hot_function").m_Count);
+}
+
+static int g_HookCalls = 0;
+static void TestHook(lua_State* L, lua_Debug* ar)
+{
+    g_HookCalls++;
+}
+
+TEST_F(ScriptProfilerTest, KeepsPreviousHook)
+{
+    lua_sethook(L, TestHook, LUA_MASKCALL, 0);
+
+    g_HookCalls = 0;
+    dmScript::StartLuaProfiler(L, 100);
+    ASSERT_TRUE(RunString(L, "local function f() end for i=1,10 do f() end"));
+    dmScript::StopLuaProfiler();
+
+    // The calls are still passed on to the previous hook
+    ASSERT_LE(10, g_HookCalls);
+
+    ASSERT_TRUE(lua_gethook(L) == TestHook);
+    ASSERT_EQ(LUA_MASKCALL, lua_gethookmask(L));
+
+    lua_sethook(L, 0, 0, 0);
+}
+
+extern "C" void dmExportedSymbols();
+
+int main(int argc, char **argv)
+{
+    dmExportedSymbols();
+    TestMainPlatformInit();
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
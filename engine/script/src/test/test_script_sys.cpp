@@ -16,7 +16,9 @@
 #include "test_script.h"
 
 #include <testmain/testmain.h>
+#include <dlib/job_thread.h>
 #include <dlib/log.h>
+#include <dlib/time.h>
 
 class ScriptSysTest : public dmScriptTest::ScriptTest
 {
@@ -46,6 +48,58 @@ TEST_F(ScriptSysTest, TestSys)
     ASSERT_EQ(top, lua_gettop(L));
 }
 
+TEST_F(ScriptSysTest, TestSaveAsync)
+{
+    dmJobThread::JobThreadCreationParams job_thread_params = {};
+    job_thread_params.m_ThreadNames[0] = "test_jobs";
+    job_thread_params.m_ThreadCount = 1;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_params);
+
+    dmScript::ContextParams context_params = {};
+    context_params.m_ConfigFile = m_ConfigFile;
+    context_params.m_Factory    = m_ResourceFactory;
+    context_params.m_JobThread  = job_thread;
+    dmScript::HContext context = dmScript::NewContext(context_params);
+    dmScript::Initialize(context);
+    lua_State* L = dmScript::GetLuaState(context);
+
+    ASSERT_TRUE(RunString(L, "test_file = sys.get_save_file(\"my_game\", \"save_async.save\") \
+                              os.remove(test_file) \
+                              local data = {} \
+                              for i=1,100000 do data[i] = i end \
+                              sys.save_async(test_file, data) \
+                              data[1] = 0"));
+
+    // The file is renamed into place once it has been written
+    bool exists = false;
+    for (int i = 0; i < 1000 && !exists; ++i)
+    {
+        dmJobThread::Update(job_thread);
+        ASSERT_TRUE(RunString(L, "test_file_exists = sys.exists(test_file)"));
+        lua_getglobal(L, "test_file_exists");
+        exists = lua_toboolean(L, -1);
+        lua_pop(L, 1);
+        dmTime::Sleep(2000);
+    }
+    ASSERT_TRUE(exists);
+
+    ASSERT_TRUE(RunString(L, "local data = sys.load(test_file) \
+                              assert(#data == 100000) \
+                              assert(data[1] == 1) \
+                              assert(data[100000] == 100000)"));
+
+    // Pending saves are waited for when the context is finalized
+    ASSERT_TRUE(RunString(L, "sys.save_async(test_file, { value = 1 })"));
+    dmScript::Finalize(context);
+    dmScript::DeleteContext(context);
+    dmJobThread::Update(job_thread);
+
+    ASSERT_TRUE(RunString(this->L, "local data = sys.load(sys.get_save_file(\"my_game\", \"save_async.save\")) \
+                                    assert(data.value == 1)"));
+
+    dmJobThread::Destroy(job_thread);
+}
+
 extern "C" void dmExportedSymbols();
 
 int main(int argc, char **argv)
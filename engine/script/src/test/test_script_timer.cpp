@@ -706,6 +706,91 @@ TEST_F(ScriptTimerTest, TestKillTimers)
     dmScript::DeleteTimerWorld(timer_world);
 }
 
+static double g_WheelTime = 0.0;
+
+static void WheelTestCallback(dmScript::HTimerWorld timer_world, dmScript::TimerEventType event_type, dmScript::HTimer timer_handle, float time_elapsed, uintptr_t owner, uintptr_t userdata)
+{
+    if (event_type != dmScript::TIMER_EVENT_CANCELLED)
+    {
+        ++TimerTestCallback::callback_count;
+        *(double*)userdata = g_WheelTime;
+    }
+}
+
+TEST_F(ScriptTimerTest, TestTimerWheelDelays)
+{
+    dmScript::HTimerWorld timer_world = dmScript::NewTimerWorld();
+
+    // Delays that end up on the different levels of the timer wheel
+    const float delays[] = { 0.0f, 0.003f, 0.5f, 0.999f, 1.0f, 1.25f, 3.0f, 63.9f, 64.5f, 300.0f, 4095.0f, 4100.0f, 20000.0f };
+    const uint32_t count = sizeof(delays) / sizeof(delays[0]);
+    double fired[count];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        fired[i] = -1.0;
+        dmScript::HTimer handle = dmScript::AddTimer(timer_world, delays[i], false, WheelTestCallback, 0x10, (uintptr_t)&fired[i]);
+        ASSERT_NE(dmScript::INVALID_TIMER_HANDLE, handle);
+    }
+
+    g_WheelTime = 0.0;
+    const float dt = 0.25f;
+    while (g_WheelTime < 20001.0)
+    {
+        g_WheelTime += dt;
+        dmScript::UpdateTimers(timer_world, dt);
+    }
+
+    ASSERT_EQ(count, TimerTestCallback::callback_count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        // Each timer fires in the first update where its delay has passed
+        ASSERT_LE(delays[i], fired[i]);
+        ASSERT_LE(fired[i], delays[i] + dt);
+    }
+
+    ASSERT_EQ(0u, GetAliveTimers(timer_world));
+    dmScript::DeleteTimerWorld(timer_world);
+}
+
+TEST_F(ScriptTimerTest, TestManyTimers)
+{
+    dmScript::HTimerWorld timer_world = dmScript::NewTimerWorld();
+
+    // More timers than fit in a 16 bit index
+    const uint32_t count = 100000;
+    dmArray<dmScript::HTimer> handles;
+    handles.SetCapacity(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        handles.Push(dmScript::AddTimer(timer_world, 1.0f + (i % 100) * 0.5f, false, TestCallback, i % 16, 0x0));
+        ASSERT_NE(dmScript::INVALID_TIMER_HANDLE, handles.Back());
+    }
+    ASSERT_EQ(count, GetAliveTimers(timer_world));
+
+    // Cancel every other timer
+    for (uint32_t i = 0; i < count; i += 2)
+    {
+        ASSERT_TRUE(dmScript::CancelTimer(timer_world, handles[i]));
+    }
+    ASSERT_EQ(count / 2, TimerTestCallback::cancel_count);
+
+    for (uint32_t i = 0; i < 20; ++i)
+    {
+        dmScript::UpdateTimers(timer_world, 1.0f);
+    }
+    ASSERT_EQ(count / 2 - GetAliveTimers(timer_world), TimerTestCallback::callback_count);
+
+    uint32_t killed = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        killed += dmScript::KillTimers(timer_world, i);
+    }
+    ASSERT_EQ(count / 2, TimerTestCallback::callback_count + killed);
+    ASSERT_EQ(0u, GetAliveTimers(timer_world));
+
+    dmScript::DeleteTimerWorld(timer_world);
+}
+
 static dmScript::HTimer cb_callback_handle = dmScript::INVALID_TIMER_HANDLE;
 static uint32_t cb_callback_counter = 0u;
 static float cb_elapsed_time = 0.0f;
@@ -1022,6 +1107,82 @@ TEST_F(ScriptTimerTest, TestLuaTimerGetInfo)
 }
 
 
+TEST_F(ScriptTimerTest, TestLuaSleep)
+{
+    int top = lua_gettop(L);
+    LuaInit(L);
+
+    dmScript::HScriptWorld script_world = dmScript::NewScriptWorld(m_Context);
+
+    const char pre_script[] =
+        "assert(not pcall(timer.sleep, 1))\n"
+        "\n"
+        "co = coroutine.create(function()\n"
+        "    local elapsed_time = timer.sleep(1)\n"
+        "    test.callback_counter(1, elapsed_time)\n"
+        "    elapsed_time = timer.sleep(0.5)\n"
+        "    test.callback_counter(2, elapsed_time)\n"
+        "end)\n"
+        "assert(coroutine.resume(co))\n"
+        "\n"
+        "co_killed = coroutine.create(function()\n"
+        "    timer.sleep(10)\n"
+        "    test.callback_counter(3, 0)\n"
+        "end)\n"
+        "assert(coroutine.resume(co_killed))\n"
+        "\n";
+
+    const char post_script[] =
+        "assert(coroutine.status(co) == \"dead\")\n"
+        "assert(coroutine.status(co_killed) == \"suspended\")\n";
+
+    cb_callback_counter = 0u;
+    cb_elapsed_time = 0.0f;
+
+    const char* SCRIPTINSTANCE = "TestScriptInstance";
+
+    dmScript::RegisterUserType(L, SCRIPTINSTANCE, ScriptInstance_methods, ScriptInstance_meta);
+
+    CreateScriptInstance(L, SCRIPTINSTANCE);
+    dmScript::SetInstance(L);
+
+    ASSERT_TRUE(dmScript::IsInstanceValid(L));
+    dmScript::InitializeInstance(script_world);
+
+    ASSERT_TRUE(RunString(L, pre_script));
+    ASSERT_EQ(top, lua_gettop(L));
+    ASSERT_EQ(0u, cb_callback_counter);
+
+    dmScript::UpdateScriptWorld(script_world, 0.5f);
+    ASSERT_EQ(0u, cb_callback_counter);
+
+    dmScript::UpdateScriptWorld(script_world, 0.5f);
+    ASSERT_EQ(1u, cb_callback_counter);
+    ASSERT_EQ(1, cb_callback_handle);
+    ASSERT_EQ(1.0f, cb_elapsed_time);
+
+    dmScript::UpdateScriptWorld(script_world, 0.5f);
+    ASSERT_EQ(2u, cb_callback_counter);
+    ASSERT_EQ(2, cb_callback_handle);
+    ASSERT_EQ(1.5f, cb_elapsed_time);
+
+    ASSERT_TRUE(RunString(L, post_script));
+    ASSERT_EQ(top, lua_gettop(L));
+
+    // The sleeping coroutine must not be resumed once the instance is gone
+    FinalizeInstance(script_world);
+    dmScript::UpdateScriptWorld(script_world, 10.0f);
+    ASSERT_EQ(2u, cb_callback_counter);
+
+    dmScript::GetInstance(L);
+    DeleteScriptInstance(L);
+
+    lua_pushnil(L);
+    dmScript::SetInstance(L);
+
+    dmScript::DeleteScriptWorld(script_world);
+}
+
 TEST_F(ScriptTimerTest, TestLuaStress)
 {
     int top = lua_gettop(L);
@@ -210,6 +210,21 @@ TEST_F(ScriptVmathTest, TestQuatFail)
     ASSERT_FALSE(RunString(L, "local q = vmath.quat_matrix4()"));
 }
 
+TEST_F(ScriptVmathTest, TestInPlaceFail)
+{
+    // Mixed types
+    ASSERT_FALSE(RunString(L, "vmath.add_to(vmath.vector3(), vmath.vector3(), vmath.vector4())"));
+    ASSERT_FALSE(RunString(L, "vmath.sub_to(vmath.vector4(), vmath.vector3(), vmath.vector3())"));
+    // No output
+    ASSERT_FALSE(RunString(L, "vmath.add_to(1, vmath.vector3(), vmath.vector3())"));
+    ASSERT_FALSE(RunString(L, "vmath.mul_to(nil, vmath.vector3(), 2)"));
+    // Vectors are only multiplied with numbers
+    ASSERT_FALSE(RunString(L, "vmath.mul_to(vmath.vector3(), vmath.vector3(), vmath.vector3())"));
+    ASSERT_FALSE(RunString(L, "vmath.mul_to(vmath.quat(), vmath.quat(), 2)"));
+    // Rotate
+    ASSERT_FALSE(RunString(L, "vmath.rotate_to(vmath.vector4(), vmath.quat(), vmath.vector3())"));
+}
+
 TEST_F(ScriptVmathTest, TestTransform)
 {
     int top = lua_gettop(L);
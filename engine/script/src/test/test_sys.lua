@@ -104,6 +104,25 @@ function test_sys()
     assert(data['xp'] == data_prim['xp'])
     assert(data['name'] == data_prim['name'])
 
+    -- save file compressed (without a job thread, the file is written right away)
+    print("Saving file async")
+    local large_data = { name = "Async Save" }
+    for i=1,100000 do large_data[i] = i end
+    sys.save_async(file, large_data)
+    ret, msg = pcall(function() data_prim = sys.load(file) end)
+    if not ret then
+        print(msg)
+        assert(false, "expected sys.load() to load a file saved with sys.save_async()")
+    end
+    assert(data_prim['name'] == "Async Save")
+    assert(#data_prim == 100000)
+    assert(data_prim[100000] == 100000)
+
+    ret, msg = pcall(function() sys.save_async(long_file, valid_data) end)
+    if ret then
+        assert(false, "expected lua error for sys.save_async with too long path")
+    end
+
     -- get_config_string
     print("Testing get_config_string")
     assert(sys.get_config_string("main.does_not_exists") == nil)
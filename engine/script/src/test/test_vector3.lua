@@ -130,3 +130,18 @@ assert(("foo " .. tostring(v)) == "foo vmath.vector3(1, 2, 3)")
 assert(("foo " .. v) == "foo vmath.vector3(1, 2, 3)")
 v = vmath.vector3(-10.01, -10.01, -10.01)
 assert(tostring(v) == ("" .. v))
+
+-- in place operations
+local out = vmath.vector3()
+local a = vmath.vector3(1, 2, 3)
+local b = vmath.vector3(4, 5, 6)
+assert(rawequal(out, vmath.add_to(out, a, b)), "add_to returns out")
+assert(out.x == 5 and out.y == 7 and out.z == 9, "add_to")
+vmath.sub_to(out, out, a)
+assert(out == b, "sub_to")
+vmath.mul_to(out, a, 2)
+assert(out.x == 2 and out.y == 4 and out.z == 6, "mul_to")
+vmath.mul_to(out, 0.5, out)
+assert(out == a, "mul_to scalar first")
+vmath.rotate_to(out, vmath.quat(0, 0, math.sin(math.pi/4), math.cos(math.pi/4)), vmath.vector3(1, 0, 0))
+assert(math.abs(out.x) < 0.000001 and math.abs(out.y - 1) < 0.000001 and out.z == 0, "rotate_to")
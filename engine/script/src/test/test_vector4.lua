@@ -140,3 +140,14 @@ assert(("foo " .. tostring(v)) == "foo vmath.vector4(1, 2, 3, 4)")
 assert(("foo " .. v) == "foo vmath.vector4(1, 2, 3, 4)")
 v = vmath.vector4(-10.01, -10.01, -10.01, -10.01)
 assert(tostring(v) == ("" .. v))
+
+-- in place operations
+local out = vmath.vector4()
+local a = vmath.vector4(1, 2, 3, 4)
+local b = vmath.vector4(5, 6, 7, 8)
+assert(rawequal(out, vmath.add_to(out, a, b)), "add_to returns out")
+assert(out.x == 6 and out.y == 8 and out.z == 10 and out.w == 12, "add_to")
+vmath.sub_to(out, out, b)
+assert(out == a, "sub_to")
+vmath.mul_to(out, out, 3)
+assert(out.x == 3 and out.y == 6 and out.z == 9 and out.w == 12, "mul_to")
@@ -0,0 +1,246 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <dlib/log.h>
+#include <dlib/math.h>
+#include <dlib/profile.h>
+
+#include <opus/opusfile.h>
+
+#include "sound_codec.h"
+#include "sound_decoder.h"
+
+namespace dmSoundCodec
+{
+    namespace
+    {
+        // Opus streams are always decoded at 48 kHz, whatever rate they were encoded from
+        const uint32_t OPUS_RATE = 48000;
+
+        struct DecodeStreamInfo
+        {
+            Info m_Info;
+            OggOpusFile* m_File;
+            size_t m_Size, m_Cursor;
+            DataSource m_Source;
+            ogg_int64_t m_SeekTo;
+            ogg_int64_t m_PcmLength;
+        };
+    }
+
+    static uint32_t MemoryRead(void* context, uint32_t offset, void* buffer, uint32_t size)
+    {
+        memcpy(buffer, (const char*) context + offset, size);
+        return size;
+    }
+
+    // The functions below mimic the usual fread etc functions, reading from the data source
+    static int OpusRead(void* datasource, unsigned char* ptr, int nbytes)
+    {
+        DecodeStreamInfo* info = (DecodeStreamInfo*) datasource;
+        if (info->m_Cursor >= info->m_Size) {
+            return 0;
+        }
+
+        size_t tot = dmMath::Min((size_t) nbytes, info->m_Size - info->m_Cursor);
+        tot = ReadSource(&info->m_Source, (uint32_t) info->m_Cursor, ptr, (uint32_t) tot);
+        info->m_Cursor += tot;
+        return (int) tot;
+    }
+
+    static int OpusSeek(void* datasource, opus_int64 offset, int whence)
+    {
+        DecodeStreamInfo* info = (DecodeStreamInfo*) datasource;
+
+        opus_int64 cursor;
+        if (whence == SEEK_SET)
+            cursor = offset;
+        else if (whence == SEEK_CUR)
+            cursor = (opus_int64) info->m_Cursor + offset;
+        else if (whence == SEEK_END)
+            cursor = (opus_int64) info->m_Size + offset;
+        else
+            return -1;
+
+        if (cursor < 0)
+            return -1;
+        info->m_Cursor = (size_t) cursor;
+        return 0;
+    }
+
+    static opus_int64 OpusTell(void* datasource)
+    {
+        DecodeStreamInfo* info = (DecodeStreamInfo*) datasource;
+        return (opus_int64) info->m_Cursor;
+    }
+
+    static Result OpusOpenSourceStream(const DataSource* source, HDecodeStream* stream)
+    {
+        DecodeStreamInfo* tmp = new DecodeStreamInfo();
+        tmp->m_Source = *source;
+        tmp->m_Size = source->m_Size;
+        tmp->m_Cursor = 0;
+
+        OpusFileCallbacks cb;
+        cb.read = OpusRead;
+        cb.seek = OpusSeek;
+        cb.tell = OpusTell;
+        cb.close = 0;
+
+        int error = 0;
+        tmp->m_File = op_open_callbacks(tmp, &cb, 0, 0, &error);
+        if (!tmp->m_File)
+        {
+            delete tmp;
+            return RESULT_INVALID_FORMAT;
+        }
+
+        // Anything but mono is down mixed to stereo
+        int channels = op_channel_count(tmp->m_File, -1);
+        tmp->m_Info.m_Rate = OPUS_RATE;
+        tmp->m_Info.m_Size = 0;
+        tmp->m_Info.m_Channels = channels == 1 ? 1 : 2;
+        tmp->m_Info.m_BitsPerSample = 16;
+
+        tmp->m_PcmLength = op_pcm_total(tmp->m_File, -1);
+        tmp->m_SeekTo = -1;
+
+        *stream = tmp;
+        return RESULT_OK;
+    }
+
+    static Result OpusOpenStream(const void* buffer, uint32_t buffer_size, HDecodeStream* stream)
+    {
+        DataSource source;
+        source.m_Read = MemoryRead;
+        source.m_Context = (void*) buffer;
+        source.m_Size = buffer_size;
+        return OpusOpenSourceStream(&source, stream);
+    }
+
+    static Result OpusDecode(HDecodeStream stream, char* buffer, uint32_t buffer_size, uint32_t* decoded)
+    {
+        DM_PROFILE(__FUNCTION__);
+
+        DecodeStreamInfo* streamInfo = (DecodeStreamInfo*) stream;
+        const uint32_t channels = streamInfo->m_Info.m_Channels;
+        const uint32_t stride = channels * sizeof(opus_int16);
+        uint32_t got_bytes = 0;
+
+        // Seeks are deferred to decode time.
+        if (streamInfo->m_SeekTo != -1)
+        {
+            op_pcm_seek(streamInfo->m_File, streamInfo->m_SeekTo);
+            streamInfo->m_SeekTo = -1;
+        }
+
+        // op_read returns at most one Opus packet per call, so loop until the buffer is full
+        while (true)
+        {
+            const uint32_t remaining = (buffer_size - got_bytes) / stride;
+            if (!remaining)
+            {
+                break;
+            }
+
+            opus_int16* pcm = (opus_int16*) &buffer[got_bytes];
+            int frames;
+            if (channels == 1)
+                frames = op_read(streamInfo->m_File, pcm, (int) remaining, 0);
+            else
+                frames = op_read_stereo(streamInfo->m_File, pcm, (int) (remaining * 2));
+
+            if (frames == 0)
+            {
+                // reached end of file
+                break;
+            }
+
+            if (frames < 0)
+            {
+                // A hole in the data is skipped over by the next read
+                if (frames == OP_HOLE)
+                    continue;
+                return RESULT_DECODE_ERROR;
+            }
+
+            got_bytes += (uint32_t) frames * stride;
+        }
+
+        *decoded = got_bytes;
+        return RESULT_OK;
+    }
+
+    static Result OpusResetStream(HDecodeStream stream)
+    {
+        DecodeStreamInfo* streamInfo = (DecodeStreamInfo*) stream;
+        op_raw_seek(streamInfo->m_File, 0);
+        streamInfo->m_SeekTo = -1;
+        return RESULT_OK;
+    }
+
+    static Result OpusSkipInStream(HDecodeStream stream, uint32_t bytes, uint32_t* skipped)
+    {
+        DecodeStreamInfo* streamInfo = (DecodeStreamInfo*) stream;
+        if (streamInfo->m_PcmLength > 0)
+        {
+            // if in skip mode already, use that position.
+            ogg_int64_t pos = streamInfo->m_SeekTo;
+            if (pos == -1)
+                pos = op_pcm_tell(streamInfo->m_File);
+
+            // clamp to end of stream
+            const ogg_int64_t stride = streamInfo->m_Info.m_Channels * streamInfo->m_Info.m_BitsPerSample / 8;
+            ogg_int64_t newpos = pos + bytes / stride;
+            if (newpos > streamInfo->m_PcmLength)
+                newpos = streamInfo->m_PcmLength;
+
+            streamInfo->m_SeekTo = newpos;
+            *skipped = (uint32_t)((newpos - pos) * stride);
+            return RESULT_OK;
+        }
+        else
+        {
+            // unseekable stream.
+            *skipped = 0;
+            return RESULT_UNSUPPORTED;
+        }
+    }
+
+    static void OpusCloseStream(HDecodeStream stream)
+    {
+        DecodeStreamInfo* streamInfo = (DecodeStreamInfo*) stream;
+        op_free(streamInfo->m_File);
+        delete streamInfo;
+    }
+
+    static void OpusGetInfo(HDecodeStream stream, struct Info* out)
+    {
+        *out = ((DecodeStreamInfo*) stream)->m_Info;
+    }
+
+    static int64_t OpusGetInternalPos(HDecodeStream stream)
+    {
+        DecodeStreamInfo* streamInfo = (DecodeStreamInfo*) stream;
+        return streamInfo->m_SeekTo == -1 ? (int64_t) op_pcm_tell(streamInfo->m_File) : streamInfo->m_SeekTo;
+    }
+
+    DM_DECLARE_SOUND_DECODER(AudioDecoderOpus, "OpusDecoderOpusfile", FORMAT_OPUS, 8,
+                             OpusOpenStream, OpusCloseStream, OpusDecode,
+                             OpusResetStream, OpusSkipInStream, OpusGetInfo,
+                             OpusGetInternalPos, OpusOpenSourceStream);
+}
@@ -125,5 +125,6 @@ namespace dmSoundCodec
                              5, // baseline score (1-10)
                              StbVorbisOpenStream, StbVorbisCloseStream, StbVorbisDecode,
                              StbVorbisResetStream, StbVorbisSkipInStream, StbVorbisGetInfo,
-                             StbVorbisGetInternalPos);
+                             StbVorbisGetInternalPos,
+                             0); // decodes from memory only
 }
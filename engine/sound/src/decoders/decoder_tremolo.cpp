@@ -32,24 +32,32 @@ namespace dmSoundCodec
             Info m_Info;
             OggVorbis_File m_File;
             size_t m_Size, m_Cursor;
-            const char *m_Buffer;
+            DataSource m_Source;
             ogg_int64_t m_SeekTo;
             ogg_int64_t m_PcmLength;
         };
     }
 
-    // The functions below mimic the usual fopen/fread etc functions, reading from a buffer
-    // in memory
+    static uint32_t MemoryRead(void* context, uint32_t offset, void* buffer, uint32_t size)
+    {
+        memcpy(buffer, (const char*) context + offset, size);
+        return size;
+    }
+
+    // The functions below mimic the usual fopen/fread etc functions, reading from the data source
     static size_t OggRead(void *ptr, size_t size, size_t nmemb, void *datasource)
     {
         DecodeStreamInfo *info = (DecodeStreamInfo*) datasource;
 
         size_t tot = nmemb * size;
+        if (info->m_Cursor >= info->m_Size) {
+            return 0;
+        }
         if (tot > (info->m_Size - info->m_Cursor)) {
             tot = info->m_Size - info->m_Cursor;
         }
 
-        memcpy(ptr, &info->m_Buffer[info->m_Cursor], tot);
+        tot = ReadSource(&info->m_Source, (uint32_t) info->m_Cursor, ptr, (uint32_t) tot);
         info->m_Cursor += tot;
         return tot;
     }
@@ -80,11 +88,11 @@ namespace dmSoundCodec
         return info->m_Cursor;
     }
 
-    static Result TremoloOpenStream(const void* buffer, uint32_t buffer_size, HDecodeStream* stream)
+    static Result TremoloOpenSourceStream(const DataSource* source, HDecodeStream* stream)
     {
         DecodeStreamInfo *tmp = new DecodeStreamInfo();
-        tmp->m_Buffer = (const char*) buffer;
-        tmp->m_Size = buffer_size;
+        tmp->m_Source = *source;
+        tmp->m_Size = source->m_Size;
         tmp->m_Cursor = 0;
 
         ov_callbacks cb;
@@ -114,6 +122,15 @@ namespace dmSoundCodec
         return RESULT_OK;
     }
 
+    static Result TremoloOpenStream(const void* buffer, uint32_t buffer_size, HDecodeStream* stream)
+    {
+        DataSource source;
+        source.m_Read = MemoryRead;
+        source.m_Context = (void*) buffer;
+        source.m_Size = buffer_size;
+        return TremoloOpenSourceStream(&source, stream);
+    }
+
     static Result TremoloDecode(HDecodeStream stream, char* buffer, uint32_t buffer_size, uint32_t* decoded)
     {
         DM_PROFILE(__FUNCTION__);
@@ -217,5 +234,5 @@ namespace dmSoundCodec
     DM_DECLARE_SOUND_DECODER(AudioDecoderTremolo, "VorbisDecoderTremolo", FORMAT_VORBIS, 8,
                              TremoloOpenStream, TremoloCloseStream, TremoloDecode,
                              TremoloResetStream, TremoloSkipInStream, TremoloGetInfo,
-                             TremoloGetInternalPos);
+                             TremoloGetInternalPos, TremoloOpenSourceStream);
 }
@@ -21,6 +21,9 @@
 #include "sound.h"
 #include "sound_decoder.h"
 
+#define WAVE_FORMAT_PCM 1
+#define WAVE_FORMAT_IMA_ADPCM 0x11
+
 #if DM_ENDIAN == DM_ENDIAN_LITTLE
 #define FOUR_CC(a,b,c,d) (((uint32_t)d << 24) | ((uint32_t)c << 16) | ((uint32_t)b << 8) | ((uint32_t)a))
 #else
@@ -100,6 +103,19 @@ namespace dmSoundCodec
 
         };
 
+        // Follows the FmtChunk of IMA ADPCM data
+        struct AdpcmFmtExtension
+        {
+            uint16_t m_ExtraSize;
+            uint16_t m_SamplesPerBlock;
+
+            void Swap()
+            {
+                m_ExtraSize = Swap16(m_ExtraSize);
+                m_SamplesPerBlock = Swap16(m_SamplesPerBlock);
+            }
+        };
+
         struct DataChunk : CommonHeader
         {
             char m_Data[0];
@@ -111,52 +127,152 @@ namespace dmSoundCodec
         struct DecodeStreamInfo {
             Info m_Info;
             uint32_t m_Cursor;
-            const void* m_Buffer;
+            // Offset of the PCM data in the source
+            uint32_t m_DataOffset;
+            // Size of a frame, reads are kept aligned to it
+            uint32_t m_FrameSize;
+            DataSource m_Source;
+            // IMA ADPCM only, else m_BlockAlign is 0. The data is decoded a block at a time into m_Block,
+            // and m_Cursor and m_Info.m_Size are in decoded bytes
+            uint32_t m_BlockAlign;
+            uint32_t m_SamplesPerBlock;
+            uint32_t m_DataSize;
+            uint32_t m_BlockIndex;
+            // Decoded bytes in m_Block
+            uint32_t m_BlockSize;
+            int16_t* m_Block;
+            uint8_t* m_BlockData;
+        };
+
+        const uint32_t INVALID_BLOCK = 0xffffffff;
+
+        const int16_t IMA_STEP_TABLE[89] = {
+            7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+            50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+            337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+            2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+            15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+        };
+
+        const int8_t IMA_INDEX_TABLE[16] = {
+            -1, -1, -1, -1, 2, 4, 6, 8,
+            -1, -1, -1, -1, 2, 4, 6, 8
         };
+
+        // Number of frames in an ADPCM block of size bytes. The header holds the first frame
+        static uint32_t GetAdpcmBlockFrames(uint32_t size, uint32_t channels)
+        {
+            uint32_t header_size = 4 * channels;
+            if (size < header_size)
+                return 0;
+            // Whole groups of 4 bytes per channel, with 8 samples each
+            return 1 + ((size - header_size) / (4 * channels)) * 8;
+        }
+
+        /*
+         * Decodes an IMA ADPCM block to interleaved 16 bit samples. Each channel starts with a header of the
+         * first sample and the step index, followed by groups of 4 bytes per channel, low nibble first.
+         */
+        static void DecodeAdpcmBlock(const uint8_t* in, uint32_t channels, uint32_t frames, int16_t* out)
+        {
+            for (uint32_t c = 0; c < channels; ++c)
+            {
+                const uint8_t* header = in + 4 * c;
+                int32_t predictor = (int16_t) (header[0] | (header[1] << 8));
+                int32_t index = dmMath::Clamp((int32_t) header[2], 0, 88);
+                out[c] = (int16_t) predictor;
+
+                const uint8_t* data = in + 4 * channels + 4 * c;
+                for (uint32_t i = 1; i < frames; ++i)
+                {
+                    uint32_t n = i - 1;
+                    uint8_t byte = data[(n / 8) * 4 * channels + (n % 8) / 2];
+                    uint32_t nibble = (n & 1) ? (byte >> 4) : (byte & 0xf);
+
+                    int32_t step = IMA_STEP_TABLE[index];
+                    int32_t diff = step >> 3;
+                    if (nibble & 1) diff += step >> 2;
+                    if (nibble & 2) diff += step >> 1;
+                    if (nibble & 4) diff += step;
+                    predictor += (nibble & 8) ? -diff : diff;
+                    predictor = dmMath::Clamp(predictor, -32768, 32767);
+                    index = dmMath::Clamp(index + IMA_INDEX_TABLE[nibble], 0, 88);
+
+                    out[i * channels + c] = (int16_t) predictor;
+                }
+            }
+        }
+
+        static uint32_t MemoryRead(void* context, uint32_t offset, void* buffer, uint32_t size)
+        {
+            memcpy(buffer, (const char*) context + offset, size);
+            return size;
+        }
     }
 
-    static Result WavOpenStream(const void* buffer, uint32_t buffer_size, HDecodeStream* stream)
+    static Result WavOpenSourceStream(const DataSource* source, HDecodeStream* stream)
     {
-        RiffHeader* header = (RiffHeader*) buffer;
+        RiffHeader header;
         DecodeStreamInfo streamTemp;
 
         bool fmt_found = false;
         bool data_found = false;
 
-        if (buffer_size < sizeof(RiffHeader)) {
+        const uint32_t size = source->m_Size;
+        if (ReadSource(source, 0, &header, sizeof(RiffHeader)) != sizeof(RiffHeader)) {
             return RESULT_INVALID_FORMAT;
         }
 
-        if (header->m_ChunkID == FOUR_CC('R', 'I', 'F', 'F') &&
-            header->m_Format == FOUR_CC('W', 'A', 'V', 'E')) {
+        if (header.m_ChunkID == FOUR_CC('R', 'I', 'F', 'F') &&
+            header.m_Format == FOUR_CC('W', 'A', 'V', 'E')) {
 
-            const char* begin = (const char*) buffer;
-            const char* current = (const char*) buffer;
-            const char* end = (const char*) buffer + buffer_size;
-            current += sizeof(RiffHeader);
+            uint64_t current = sizeof(RiffHeader);
             do {
                 CommonHeader header;
-                if (current + sizeof(header) > end) {
+                if (current + sizeof(header) > size) {
                     // not enough bytes left for a full header. just ignore this.
                     break;
                 }
 
-                memcpy(&header, current, sizeof(header));
+                ReadSource(source, (uint32_t) current, &header, sizeof(header));
                 header.SwapHeader();
                 if (header.m_ChunkID == FOUR_CC('f', 'm', 't', ' ')) {
                     FmtChunk fmt;
-                    if (current + sizeof(fmt) > end) {
-                        dmLogWarning("WAV sound data seems corrupt or truncated at position %d out of %d", (int)(current - begin), buffer_size);
+                    if (current + sizeof(fmt) > size ||
+                        ReadSource(source, (uint32_t) current, &fmt, sizeof(fmt)) != sizeof(fmt)) {
+                        dmLogWarning("WAV sound data seems corrupt or truncated at position %d out of %d", (int) current, size);
                         return RESULT_INVALID_FORMAT;
                     }
 
-                    memcpy(&fmt, current, sizeof(fmt));
                     fmt.Swap();
                     fmt_found = true;
 
-                    if( fmt.m_AudioFormat != 1 )
+                    streamTemp.m_BlockAlign = 0;
+                    streamTemp.m_SamplesPerBlock = 0;
+                    if (fmt.m_AudioFormat == WAVE_FORMAT_IMA_ADPCM)
+                    {
+                        AdpcmFmtExtension ext;
+                        if (current + sizeof(fmt) + sizeof(ext) > size ||
+                            ReadSource(source, (uint32_t) (current + sizeof(fmt)), &ext, sizeof(ext)) != sizeof(ext)) {
+                            dmLogWarning("WAV sound data seems corrupt or truncated at position %d out of %d", (int) current, size);
+                            return RESULT_INVALID_FORMAT;
+                        }
+                        ext.Swap();
+
+                        uint32_t channels = fmt.m_NumChannels;
+                        if (fmt.m_BitsPerSample != 4 || channels < 1 || channels > 2 ||
+                            ext.m_SamplesPerBlock == 0 || ext.m_SamplesPerBlock > GetAdpcmBlockFrames(fmt.m_BlockAlign, channels))
+                        {
+                            dmLogWarning("Unsupported IMA ADPCM wav-file, with %d channels, block size %d and %d samples per block", fmt.m_NumChannels, fmt.m_BlockAlign, ext.m_SamplesPerBlock);
+                            return RESULT_INVALID_FORMAT;
+                        }
+                        streamTemp.m_BlockAlign = fmt.m_BlockAlign;
+                        streamTemp.m_SamplesPerBlock = ext.m_SamplesPerBlock;
+                        fmt.m_BitsPerSample = 16;
+                    }
+                    else if (fmt.m_AudioFormat != WAVE_FORMAT_PCM)
                     {
-                        dmLogWarning("Only wav-files with 8 or 16 bit PCM format (format=1) supported, got format=%d and bitdepth=%d", fmt.m_AudioFormat, fmt.m_BitsPerSample);
+                        dmLogWarning("Only wav-files with 8 or 16 bit PCM format (format=1) or IMA ADPCM (format=17) supported, got format=%d and bitdepth=%d", fmt.m_AudioFormat, fmt.m_BitsPerSample);
                         return RESULT_INVALID_FORMAT;
                     }
                     streamTemp.m_Info.m_Rate = fmt.m_SampleRate;
@@ -165,26 +281,39 @@ namespace dmSoundCodec
 
                 } else if (header.m_ChunkID == FOUR_CC('d', 'a', 't', 'a')) {
                     // NOTE: We don't byte-swap PCM-data and a potential problem on big-endian architectures
-                    DataChunk data;
-                    if (current + sizeof(data) > end) {
-                        dmLogWarning("WAV sound data seems corrupt or truncated at position %d out of %d", (int)(current - begin), buffer_size);
+                    if (current + sizeof(DataChunk) > size) {
+                        dmLogWarning("WAV sound data seems corrupt or truncated at position %d out of %d", (int) current, size);
                         return RESULT_INVALID_FORMAT;
                     }
 
-                    memcpy(&data, current, sizeof(data));
-                    data.Swap();
-                    streamTemp.m_Buffer = (void*) (current + sizeof(DataChunk));
-                    streamTemp.m_Info.m_Size = data.m_ChunkSize;
+                    streamTemp.m_DataOffset = (uint32_t) (current + sizeof(DataChunk));
+                    streamTemp.m_DataSize = dmMath::Min(header.m_ChunkSize, size - streamTemp.m_DataOffset);
+                    streamTemp.m_Info.m_Size = header.m_ChunkSize;
                     data_found = true;
                 }
-                current += header.m_ChunkSize + sizeof(CommonHeader);
-            } while (current < end && !(fmt_found && data_found));
+                current += (uint64_t) header.m_ChunkSize + sizeof(CommonHeader);
+            } while (current < size && !(fmt_found && data_found));
 
             if (fmt_found && data_found) {
                 // Allocate stream output and copy temporary data over there.
                 // Doing this last-minute avoids having to worry about deallocating
                 // on failure. NOTE: Maybe pool allocate here.
                 streamTemp.m_Cursor = 0;
+                streamTemp.m_FrameSize = dmMath::Max(1U, (uint32_t) streamTemp.m_Info.m_Channels * (streamTemp.m_Info.m_BitsPerSample / 8));
+                streamTemp.m_Source = *source;
+                streamTemp.m_BlockIndex = INVALID_BLOCK;
+                streamTemp.m_BlockSize = 0;
+                streamTemp.m_Block = 0;
+                streamTemp.m_BlockData = 0;
+                if (streamTemp.m_BlockAlign)
+                {
+                    // The last block may be short
+                    uint32_t blocks = streamTemp.m_DataSize / streamTemp.m_BlockAlign;
+                    uint32_t last_frames = dmMath::Min(streamTemp.m_SamplesPerBlock, GetAdpcmBlockFrames(streamTemp.m_DataSize % streamTemp.m_BlockAlign, streamTemp.m_Info.m_Channels));
+                    streamTemp.m_Info.m_Size = (blocks * streamTemp.m_SamplesPerBlock + last_frames) * streamTemp.m_FrameSize;
+                    streamTemp.m_Block = new int16_t[streamTemp.m_SamplesPerBlock * streamTemp.m_Info.m_Channels];
+                    streamTemp.m_BlockData = new uint8_t[streamTemp.m_BlockAlign];
+                }
                 DecodeStreamInfo *streamOut = new DecodeStreamInfo;
                 *streamOut = streamTemp;
                 *stream = streamOut;
@@ -197,10 +326,21 @@ namespace dmSoundCodec
         }
     }
 
+    static Result WavOpenStream(const void* buffer, uint32_t buffer_size, HDecodeStream* stream)
+    {
+        DataSource source;
+        source.m_Read = MemoryRead;
+        source.m_Context = (void*) buffer;
+        source.m_Size = buffer_size;
+        return WavOpenSourceStream(&source, stream);
+    }
+
     static void WavCloseStream(HDecodeStream stream)
     {
         assert(stream);
         DecodeStreamInfo *streamInfo = (DecodeStreamInfo *) stream;
+        delete[] streamInfo->m_Block;
+        delete[] streamInfo->m_BlockData;
         delete streamInfo;
     }
 
@@ -211,16 +351,62 @@ namespace dmSoundCodec
         return RESULT_OK;
     }
 
+    static uint32_t AdpcmDecodeStream(DecodeStreamInfo* streamInfo, char* buffer, uint32_t buffer_size)
+    {
+        const uint32_t channels = streamInfo->m_Info.m_Channels;
+        const uint32_t block_bytes = streamInfo->m_SamplesPerBlock * streamInfo->m_FrameSize;
+        uint32_t n = dmMath::Min(buffer_size, streamInfo->m_Info.m_Size - streamInfo->m_Cursor);
+        n -= n % streamInfo->m_FrameSize;
+
+        uint32_t done = 0;
+        while (done < n)
+        {
+            uint32_t cursor = streamInfo->m_Cursor + done;
+            uint32_t block = cursor / block_bytes;
+            if (block != streamInfo->m_BlockIndex)
+            {
+                uint32_t offset = block * streamInfo->m_BlockAlign;
+                uint32_t size = dmMath::Min(streamInfo->m_BlockAlign, streamInfo->m_DataSize - offset);
+                size = ReadSource(&streamInfo->m_Source, streamInfo->m_DataOffset + offset, streamInfo->m_BlockData, size);
+                uint32_t frames = dmMath::Min(streamInfo->m_SamplesPerBlock, GetAdpcmBlockFrames(size, channels));
+                if (frames == 0)
+                    break;
+                DecodeAdpcmBlock(streamInfo->m_BlockData, channels, frames, streamInfo->m_Block);
+                streamInfo->m_BlockIndex = block;
+                streamInfo->m_BlockSize = frames * streamInfo->m_FrameSize;
+            }
+
+            // A truncated block ends the data early
+            uint32_t block_offset = cursor - block * block_bytes;
+            if (block_offset >= streamInfo->m_BlockSize)
+                break;
+            uint32_t count = dmMath::Min(n - done, streamInfo->m_BlockSize - block_offset);
+            memcpy(buffer + done, (const char*) streamInfo->m_Block + block_offset, count);
+            done += count;
+        }
+        return done;
+    }
+
     static Result WavDecodeStream(HDecodeStream stream, char* buffer, uint32_t buffer_size, uint32_t* decoded)
     {
         DecodeStreamInfo *streamInfo = (DecodeStreamInfo *) stream;
 
         DM_PROFILE(__FUNCTION__);
 
+        if (streamInfo->m_BlockAlign)
+        {
+            uint32_t n = AdpcmDecodeStream(streamInfo, buffer, buffer_size);
+            *decoded = n;
+            streamInfo->m_Cursor += n;
+            return RESULT_OK;
+        }
+
         assert(streamInfo->m_Cursor <= streamInfo->m_Info.m_Size);
         uint32_t n = dmMath::Min(buffer_size, streamInfo->m_Info.m_Size - streamInfo->m_Cursor);
+        n = ReadSource(&streamInfo->m_Source, streamInfo->m_DataOffset + streamInfo->m_Cursor, buffer, n);
+        // A short read means the data ended early, keep the output to whole frames
+        n -= n % streamInfo->m_FrameSize;
         *decoded = n;
-        memcpy(buffer, (const char*) streamInfo->m_Buffer + streamInfo->m_Cursor, n);
         streamInfo->m_Cursor += n;
         return RESULT_OK;
     }
@@ -250,5 +436,5 @@ namespace dmSoundCodec
                              0,
                              WavOpenStream, WavCloseStream, WavDecodeStream,
                              WavResetStream, WavSkipInStream, WavGetInfo,
-                             WavGetInternalPos);
+                             WavGetInternalPos, WavOpenSourceStream);
 }
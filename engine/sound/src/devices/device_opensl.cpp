@@ -13,6 +13,7 @@
 // specific language governing permissions and limitations under the License.
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <dlib/array.h>
@@ -25,12 +26,14 @@
 #include "sound.h"
 
 #include <SLES/OpenSLES.h>
+#include <SLES/OpenSLES_Android.h>
 
 /**
  * OpenSL ES audio device
  *
- * - Mix-rate is hard-coded to 44100 but should probably match hardware mix-rate
- *   in order to reduce latency
+ * - Mix-rate is the native rate of the output, which the fast (low latency) mixer path requires
+ * - In low latency mode, the native burst size is reported to the mixer, and the player
+ *   requests the low latency performance mode where supported (API level 25)
  * - SL_ENGINEOPTION_THREADSAFE is set to false. Hence, all api-calls to OpenSL must
  *   be performed from a single thread.
  * - Error checking isn't complete and we assume that basic
@@ -118,6 +121,8 @@ namespace dmDeviceOpenSL
     struct OpenSLDevice
     {
         uint32_t        m_MixRate;
+        // Native burst size in low latency mode, else 0
+        uint32_t        m_FrameCount;
 
         Queue           m_Free;
         Queue           m_Playing;
@@ -141,6 +146,7 @@ namespace dmDeviceOpenSL
         OpenSLDevice()
         {
             m_MixRate = 0;
+            m_FrameCount = 0;
 
             m_SL = 0;
             m_Engine = 0;
@@ -208,6 +214,45 @@ namespace dmDeviceOpenSL
         return (int)sample_rate;
     }
 
+    // The native burst size of the output, or 0 if unknown
+    static int GetFramesPerBuffer()
+    {
+        dmAndroid::ThreadAttacher thread;
+        JNIEnv* env = thread.GetEnv();
+        if (env == 0)
+        {
+            return 0;
+        }
+
+        jclass context_class = env->FindClass("android/content/Context");
+        jmethodID get_system_service = env->GetMethodID(context_class, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;");
+        jstring audio_service = env->NewStringUTF("audio");
+        jobject audio_manager = env->CallObjectMethod(thread.GetActivity()->clazz, get_system_service, audio_service);
+
+        int frames = 0;
+        if (audio_manager)
+        {
+            jclass audio_manager_class = env->FindClass("android/media/AudioManager");
+            jmethodID get_property = env->GetMethodID(audio_manager_class, "getProperty", "(Ljava/lang/String;)Ljava/lang/String;");
+            jstring key = env->NewStringUTF("android.media.property.OUTPUT_FRAMES_PER_BUFFER");
+            jstring value = (jstring) env->CallObjectMethod(audio_manager, get_property, key);
+            if (value)
+            {
+                const char* str = env->GetStringUTFChars(value, 0);
+                frames = atoi(str);
+                env->ReleaseStringUTFChars(value, str);
+                env->DeleteLocalRef(value);
+            }
+            env->DeleteLocalRef(key);
+            env->DeleteLocalRef(audio_manager_class);
+            env->DeleteLocalRef(audio_manager);
+        }
+        env->DeleteLocalRef(audio_service);
+        env->DeleteLocalRef(context_class);
+
+        return dmMath::Max(frames, 0);
+    }
+
     dmSound::Result DeviceOpenSLOpen(const dmSound::OpenDeviceParams* params, dmSound::HDevice* device)
     {
         assert(params);
@@ -228,8 +273,9 @@ namespace dmDeviceOpenSL
         const SLboolean required[] = { };
         SLInterfaceID ids[] = { };
 
-        const SLboolean required_player[] = {SL_BOOLEAN_TRUE, SL_BOOLEAN_TRUE};
-        SLInterfaceID ids_player[] = {SL_IID_VOLUME, SL_IID_BUFFERQUEUE};
+        // The configuration interface is only used to request the low latency path
+        const SLboolean required_player[] = {SL_BOOLEAN_TRUE, SL_BOOLEAN_TRUE, SL_BOOLEAN_FALSE};
+        SLInterfaceID ids_player[] = {SL_IID_VOLUME, SL_IID_BUFFERQUEUE, SL_IID_ANDROIDCONFIGURATION};
         assert(sizeof(required_player)/sizeof(required_player[0]) == sizeof(ids_player)/sizeof(ids_player[0]));
 
         OpenSLDevice* opensl = 0;
@@ -292,6 +338,19 @@ namespace dmDeviceOpenSL
             goto cleanup_mix;
         }
 
+#if defined(SL_ANDROID_KEY_PERFORMANCE_MODE)
+        if (params->m_LowLatency)
+        {
+            SLAndroidConfigurationItf config = 0;
+            if ((*player)->GetInterface(player, SL_IID_ANDROIDCONFIGURATION, &config) == SL_RESULT_SUCCESS)
+            {
+                SLuint32 mode = SL_ANDROID_PERFORMANCE_LATENCY;
+                // Not fatal, the player then uses the default path
+                CheckAndPrintError((*config)->SetConfiguration(config, SL_ANDROID_KEY_PERFORMANCE_MODE, &mode, sizeof(mode)));
+            }
+        }
+#endif
+
         res = (*player)->Realize(player, SL_BOOLEAN_FALSE);
         if (CheckAndPrintError(res))
             goto cleanup_player;
@@ -310,6 +369,10 @@ namespace dmDeviceOpenSL
 
         opensl = new OpenSLDevice;
         opensl->m_MixRate = rate;
+        if (params->m_LowLatency)
+        {
+            opensl->m_FrameCount = (uint32_t) GetFramesPerBuffer();
+        }
 
         opensl->m_Free.SetSize(params->m_BufferCount);
         opensl->m_Ready.SetSize(params->m_BufferCount);
@@ -418,6 +481,7 @@ cleanup_sl:
         assert(info);
         OpenSLDevice* opensl = (OpenSLDevice*) device;
         info->m_MixRate = opensl->m_MixRate;
+        info->m_FrameCount = opensl->m_FrameCount;
     }
 
     void DeviceOpenSLStart(dmSound::HDevice device)
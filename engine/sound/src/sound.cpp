@@ -19,6 +19,7 @@
 #include <dlib/index_pool.h>
 #include <dlib/log.h>
 #include <dlib/math.h>
+#include <dlib/memory.h>
 #include <dlib/mutex.h>
 #include <dlib/profile.h>
 #include <dlib/thread.h>
@@ -29,9 +30,11 @@
 #include "sound.h"
 #include "sound_codec.h"
 #include "sound_private.h"
+#include "sound_mix.h"
 
 #include <math.h>
 #include <cfloat>
+#include <algorithm>
 
 /**
  * Defold simple sound system
@@ -45,6 +48,8 @@ namespace dmSound
     #define SOUND_MAX_MIX_CHANNELS (2)
     #define SOUND_OUTBUFFER_COUNT (6)
     #define SOUND_MAX_SPEED (5)
+    // Max ratio between the rate of a sound and the mix rate. Higher rates are resampled without filtering
+    #define SOUND_MAX_DOWNSAMPLE (2)
 
     // TODO: How many bits?
     const uint32_t RESAMPLE_FRACTION_BITS = 31;
@@ -52,10 +57,27 @@ namespace dmSound
     const dmhash_t MASTER_GROUP_HASH = dmHashString64("master");
     const uint32_t GROUP_MEMORY_BUFFER_COUNT = 64;
 
+    // Low latency mode keeps between LOW_LATENCY_MIN_BUFFERS and SOUND_OUTBUFFER_COUNT buffers queued, see GetLowLatencyFreeSlots()
+    const uint32_t LOW_LATENCY_MIN_BUFFERS = 2;
+    // Seconds without underruns before a queued buffer is dropped again
+    const uint32_t LOW_LATENCY_SETTLE_TIME = 10;
+    // Smallest mix buffer in low latency mode, since each buffer has a fixed cost
+    const uint32_t LOW_LATENCY_MIN_FRAME_COUNT = 256;
+
+    // Streamed sound data keeps a few chunks of the encoded data in memory
+    const uint32_t STREAM_CHUNK_SIZE = 16 * 1024;
+    const uint32_t STREAM_CHUNK_COUNT = 4;
+    const uint32_t INVALID_STREAM_CHUNK = 0xffffffff;
+
+    // Max number of commands queued from the game thread between two updates of the mixer
+    const uint32_t COMMAND_QUEUE_SIZE = 1024;
+
+    const uint8_t DEFAULT_PRIORITY = 128;
+
     static void SoundThread(void* ctx);
 
     /**
-     * Value with memory for "ramping" of values. See also struct Ramp below.
+     * Value with memory for "ramping" of values. See also struct Ramp in sound_mix.h
      */
     struct Value
     {
@@ -105,28 +127,6 @@ namespace dmSound
         float m_Next;
     };
 
-    /**
-     * Helper for calculating ramps
-     */
-    struct Ramp
-    {
-        float m_From, m_To, m_TotalSamplesRecip;
-
-        Ramp(const Value* value, uint32_t buffer, uint32_t total_buffers, uint32_t total_samples)
-        {
-            float ramp_length = (value->m_Current - value->m_Prev) / total_buffers;
-            m_From = value->m_Prev + ramp_length * buffer;
-            m_To = m_From + ramp_length;
-            m_TotalSamplesRecip = 1.0f / total_samples;
-        }
-
-        inline float GetValue(int i) const
-        {
-            float mix = i * m_TotalSamplesRecip;
-            return m_From + mix * (m_To - m_From);
-        }
-    };
-
     /**
      * Context with data for mixing N buffers, i.e. during update
      */
@@ -145,50 +145,192 @@ namespace dmSound
 
     Ramp GetRamp(const MixContext* mix_context, const Value* value, uint32_t total_samples)
     {
-        Ramp ramp(value, mix_context->m_CurrentBuffer, mix_context->m_TotalBuffers, total_samples);
+        Ramp ramp(value->m_Prev, value->m_Current, mix_context->m_CurrentBuffer, mix_context->m_TotalBuffers, total_samples);
         return ramp;
     }
 
+    struct StreamChunk
+    {
+        // Chunk number in the encoded data, or INVALID_STREAM_CHUNK
+        uint32_t m_Index;
+        uint32_t m_Size;
+        uint32_t m_LastUse;
+        uint8_t  m_Data[STREAM_CHUNK_SIZE];
+    };
+
+    // Compressed sound data decoded to pcm wav data, shared by the sound data and the instances playing it
+    struct DecodedSound
+    {
+        void*         m_Data;
+        uint32_t      m_Size;
+        // One for the sound data, while it's cached, and one per instance
+        uint32_t      m_RefCount;
+        uint32_t      m_LastUse;
+    };
+
     struct SoundData
     {
         dmhash_t      m_NameHash;
         void*         m_Data;
         int           m_Size;
+        // Streamed sound data only. m_GetData is cleared when the owner deletes the sound data
+        FSoundDataGetData m_GetData;
+        void*         m_GetDataContext;
+        StreamChunk*  m_Chunks;
+        uint32_t      m_StreamSize;
+        uint32_t      m_StreamUseCounter;
+        // Chunk to read ahead on the sound thread, or INVALID_STREAM_CHUNK
+        uint32_t      m_PrefetchChunk;
         // Index in m_SoundData
         uint16_t      m_Index;
         SoundDataType m_Type;
         uint16_t      m_RefCount;
+        // The decoded data, if it's in the decoded cache. m_Data is always the original data
+        DecodedSound* m_Decoded;
+        // Decoded size of the data the last time it was decoded, so that it's not decoded again when it doesn't fit the cache
+        uint32_t      m_DecodedSize;
+        // Too large to decode, or failed to decode
+        bool          m_Undecodable;
+        // See GetGroupSoundDataSize()
+        uint32_t      m_SizeStamp;
+    };
+
+    enum DecodeState
+    {
+        DECODE_STATE_IDLE,
+        DECODE_STATE_QUEUED,
+        DECODE_STATE_RUNNING,
+    };
+
+    /**
+     * Ring buffer of decoded frames, filled ahead of the mixer by a decode job.
+     * While a job is running, it owns the decoder of the instance
+     */
+    struct DecodeLookahead
+    {
+        char*           m_Buffer;
+        uint32_t        m_Size;     // power of two
+        // Free running byte counters
+        int32_atomic_t  m_Write;
+        int32_atomic_t  m_Read;
+        int32_atomic_t  m_State;    // DecodeState
+        int32_atomic_t  m_Result;   // dmSoundCodec::Result of the last decode
+        int32_atomic_t  m_EndOfStream;
     };
 
     struct SoundInstance
     {
         dmSoundCodec::HDecoder m_Decoder;
+        // The decoded data the decoder reads, if any
+        DecodedSound* m_DecodedSound;
         void*       m_Frames;
         dmhash_t    m_Group;
 
         Value       m_Gain;     // default: 1.0f
         Value       m_Pan;      // 0 = -45deg left, 1 = 45 deg right
         float       m_Speed;    // 1.0 = normal speed, 0.5 = half speed, 2.0 = double speed
+        // The speed as set by the game thread. The doppler shift of a spatial instance is added to m_Speed
+        float       m_BaseSpeed;
         uint32_t    m_FrameCount;
         uint64_t    m_FrameFraction;
 
+        // Spatial instances, see UpdateSpatial()
+        float       m_Position[3];
+        float       m_Velocity[3];
+        float       m_MinDistance;
+        float       m_MaxDistance;
+        float       m_AttenuationA;
+        float       m_AttenuationB;
+        float       m_DopplerFactor;
+
         uint16_t    m_Index;
         uint16_t    m_SoundDataIndex;
         uint8_t     m_Looping : 1;
         uint8_t     m_EndOfStream : 1;
         uint8_t     m_Playing : 1;
-        uint8_t     : 5;
+        // Advances the playback without being decoded or mixed. See UpdateVoices()
+        uint8_t     m_Virtual : 1;
+        // Lost its voice, and is faded out before becoming virtual
+        uint8_t     m_Stolen : 1;
+        // Skipped frames while virtual, and is faded in when it gets a voice
+        uint8_t     m_Skipped : 1;
+        uint8_t     m_Spatial : 1;
+        // The spatial values were applied since it started playing
+        uint8_t     m_SpatialApplied : 1;
+        uint8_t     m_Priority;
         int8_t      m_Loopcounter; // if set to 3, there will be 3 loops effectively playing the sound 4 times.
+        // Playing state as last requested by the game thread. Not a bit field, since the mixer writes m_Playing
+        uint8_t     m_RequestedPlaying;
+
+        // m_Playing, as published by the mixer
+        int32_atomic_t m_IsPlaying;
+        // Number of queued commands that change the playing state
+        int32_atomic_t m_PendingPlayCommands;
+
+        // Only for compressed sounds in memory, when there are job workers
+        DecodeLookahead m_Lookahead;
+    };
+
+    struct GroupMemory
+    {
+        float    m_SumSquaredMemory[SOUND_MAX_MIX_CHANNELS * GROUP_MEMORY_BUFFER_COUNT];
+        float    m_PeakMemorySq[SOUND_MAX_MIX_CHANNELS * GROUP_MEMORY_BUFFER_COUNT];
+        int      m_NextMemorySlot;
     };
 
     struct SoundGroup
     {
         dmhash_t m_NameHash;
         Value    m_Gain;
+        // Gain as last set by the game thread
+        float    m_RequestedGain;
         float*   m_MixBuffer;
-        float    m_SumSquaredMemory[SOUND_MAX_MIX_CHANNELS * GROUP_MEMORY_BUFFER_COUNT];
-        float    m_PeakMemorySq[SOUND_MAX_MIX_CHANNELS * GROUP_MEMORY_BUFFER_COUNT];
-        int      m_NextMemorySlot;
+        GroupMemory m_Memory;
+        // Copies of m_Memory published by the mixer, read by GetGroupRMS/GetGroupPeak without locking
+        GroupMemory m_Snapshots[2];
+        int32_atomic_t m_SnapshotVersion;
+        // 0 means no limit
+        uint32_t m_MaxVoices;
+        uint32_t m_VoiceCount;
+    };
+
+    enum CommandType
+    {
+        COMMAND_PLAY,
+        COMMAND_STOP,
+        COMMAND_PAUSE,
+        COMMAND_SET_LOOPING,
+        COMMAND_SET_PARAMETER,
+        COMMAND_SET_INSTANCE_GROUP,
+        COMMAND_SET_GROUP_GAIN,
+        COMMAND_SET_PRIORITY,
+        COMMAND_SET_GROUP_VOICE_LIMIT,
+        COMMAND_SET_SPATIAL,
+        COMMAND_SET_POSITION,
+        COMMAND_SET_LISTENER,
+    };
+
+    // A change of instance or group state, applied by the mixer
+    struct Command
+    {
+        CommandType     m_Type;
+        SoundInstance*  m_Instance;
+        dmhash_t        m_Group;
+        Parameter       m_Parameter;
+        float           m_Value;
+        int8_t          m_Loopcounter;
+        bool            m_Flag; // pause, or looping
+        uint32_t        m_Count; // priority, or voice limit
+        float           m_Vector[9]; // position and velocity (and listener right vector), or spatial params
+    };
+
+    // A playing instance, as sorted when assigning the voices
+    struct VoiceCandidate
+    {
+        float    m_Gain;
+        uint16_t m_Index;
+        uint8_t  m_Priority;
+        uint8_t  m_Real;
     };
 
     struct SoundSystem
@@ -198,13 +340,47 @@ namespace dmSound
         HDevice                       m_Device;
         dmThread::Thread              m_Thread;
         dmMutex::HMutex               m_Mutex;
+        // Held while refilling streamed sound data. Taken before m_Mutex
+        dmMutex::HMutex               m_StreamMutex;
+        uint8_t*                      m_StreamBuffer;
+        uint16_t                      m_NextStreamData;
 
         dmArray<SoundInstance>  m_Instances;
         dmIndexPool16           m_InstancesPool;
 
+        // Single producer (the game thread), single consumer (the mixer, or anyone holding m_Mutex) queue.
+        // The indices are free running, and wrap around
+        Command                 m_Commands[COMMAND_QUEUE_SIZE];
+        int32_atomic_t          m_CommandWrite;
+        int32_atomic_t          m_CommandRead;
+
         dmArray<SoundData>      m_SoundData;
         dmIndexPool16           m_SoundDataPool;
 
+        dmJobThread::HContext   m_JobThread;
+        // Size of the lookahead buffer of an instance, or 0 if there are no job workers
+        uint32_t                m_LookaheadSize;
+        uint32_t                m_MaxDecodedSize;
+        // Budget of the decoded sounds. Sounds no instance is playing are evicted, least recently used first
+        uint32_t                m_DecodedCacheSize;
+        uint32_t                m_DecodedCacheUsage;
+        uint32_t                m_DecodedUseCounter;
+        uint32_t                m_SizeStamp;
+        // Decode jobs that have been pushed, but not run
+        int32_atomic_t          m_DecodeJobCount;
+
+        uint32_t                m_MaxVoices;
+        VoiceStealMode          m_VoiceStealMode;
+        dmArray<VoiceCandidate> m_VoiceCandidates;
+        // Published by the mixer, see GetVoiceCounts()
+        int32_atomic_t          m_RealVoiceCount;
+        int32_atomic_t          m_VirtualVoiceCount;
+
+        SpatialListener         m_Listener;
+        // The spatial instances of an update, and their SpatialStream streams of m_Instances.Size() floats each
+        dmArray<uint16_t>       m_SpatialInstances;
+        dmArray<float>          m_SpatialStreams;
+
         dmHashTable<dmhash_t, int> m_GroupMap;
         SoundGroup              m_Groups[MAX_GROUPS];
 
@@ -219,6 +395,14 @@ namespace dmSound
         int16_t*                m_OutBuffers[SOUND_OUTBUFFER_COUNT];
         uint16_t                m_NextOutBuffer;
 
+        // Number of buffers kept queued on the device, read by GetLatency()
+        int32_atomic_t          m_TargetBufferCount;
+        // Frames queued since the last underrun, or since the buffer count was last lowered
+        uint32_t                m_FramesWithoutUnderrun;
+        bool                    m_LowLatency;
+        // Buffers were queued since the device started. Else all slots are free, without an underrun
+        bool                    m_IsDeviceFed;
+
         bool                    m_IsDeviceStarted;
         bool                    m_IsAudioInterrupted;
         bool                    m_HasWindowFocus;
@@ -255,7 +439,14 @@ namespace dmSound
         params->m_BufferSize = 12 * 4096;
         params->m_FrameCount = 768;
         params->m_MaxInstances = 256;
+        params->m_JobThread = 0;
+        params->m_DecodeLookahead = 4;
+        params->m_MaxDecodedSize = 0;
+        params->m_DecodedCacheSize = 4 * 1024 * 1024;
+        params->m_MaxVoices = 0;
+        params->m_VoiceStealMode = VOICE_STEAL_VIRTUALIZE;
         params->m_UseThread = true;
+        params->m_LowLatency = false;
     }
 
     Result RegisterDevice(struct DeviceType* device)
@@ -296,6 +487,7 @@ namespace dmSound
         SoundGroup* group = &sound->m_Groups[index];
         group->m_NameHash = group_hash;
         group->m_Gain.Reset(1.0f);
+        group->m_RequestedGain = 1.0f;
         size_t mix_buffer_size = sound->m_FrameCount * sizeof(float) * SOUND_MAX_MIX_CHANNELS;
         group->m_MixBuffer = (float*) malloc(mix_buffer_size);
         memset(group->m_MixBuffer, 0, mix_buffer_size);
@@ -310,11 +502,18 @@ namespace dmSound
             return r;
         }
 
+        bool low_latency = params->m_LowLatency;
+        if (config)
+        {
+            low_latency = dmConfigFile::GetInt(config, "sound.low_latency", (int32_t) low_latency) != 0;
+        }
+
         HDevice device = 0;
         OpenDeviceParams device_params;
         // TODO: m_BufferCount configurable?
         device_params.m_BufferCount = SOUND_OUTBUFFER_COUNT;
         device_params.m_FrameCount = params->m_FrameCount;
+        device_params.m_LowLatency = low_latency;
         DeviceType* device_type;
         DeviceInfo device_info;
         r = OpenDevice(params->m_OutputDevice, &device_params, &device_type, &device);
@@ -328,6 +527,14 @@ namespace dmSound
             device_type->m_DeviceInfo(device, &device_info);
         }
 
+        // Mixes whole bursts of the device, but no more than the device buffers hold
+        uint32_t frame_count = params->m_FrameCount;
+        if (low_latency && device_info.m_FrameCount > 0)
+        {
+            uint32_t burst = device_info.m_FrameCount;
+            frame_count = dmMath::Min(frame_count, ((LOW_LATENCY_MIN_FRAME_COUNT + burst - 1) / burst) * burst);
+        }
+
         float master_gain = params->m_MasterGain;
 
         g_SoundSystem = new SoundSystem();
@@ -345,6 +552,11 @@ namespace dmSound
         uint32_t max_buffers = params->m_MaxBuffers;
         uint32_t max_sources = params->m_MaxSources;
         uint32_t max_instances = params->m_MaxInstances;
+        uint32_t decode_lookahead = params->m_DecodeLookahead;
+        uint32_t max_decoded_size = params->m_MaxDecodedSize;
+        uint32_t decoded_cache_size = params->m_DecodedCacheSize;
+        uint32_t max_voices = params->m_MaxVoices;
+        uint32_t voice_steal_mode = (uint32_t) params->m_VoiceStealMode;
 
         if (config)
         {
@@ -353,8 +565,42 @@ namespace dmSound
             max_buffers = (uint32_t) dmConfigFile::GetInt(config, "sound.max_sound_buffers", (int32_t) max_buffers);
             max_sources = (uint32_t) dmConfigFile::GetInt(config, "sound.max_sound_sources", (int32_t) max_sources);
             max_instances = (uint32_t) dmConfigFile::GetInt(config, "sound.max_sound_instances", (int32_t) max_instances);
+            decode_lookahead = (uint32_t) dmConfigFile::GetInt(config, "sound.decode_lookahead", (int32_t) decode_lookahead);
+            max_decoded_size = (uint32_t) dmConfigFile::GetInt(config, "sound.max_decoded_size", (int32_t) max_decoded_size);
+            decoded_cache_size = (uint32_t) dmConfigFile::GetInt(config, "sound.decoded_cache_size", (int32_t) decoded_cache_size);
+            max_voices = (uint32_t) dmConfigFile::GetInt(config, "sound.max_voices", (int32_t) max_voices);
+            voice_steal_mode = (uint32_t) dmConfigFile::GetInt(config, "sound.voice_steal_mode", (int32_t) voice_steal_mode);
         }
 
+        sound->m_JobThread = 0;
+        sound->m_LookaheadSize = 0;
+        if (params->m_JobThread && dmJobThread::GetWorkerCount(params->m_JobThread) > 0 && decode_lookahead > 0)
+        {
+            sound->m_JobThread = params->m_JobThread;
+            uint32_t size = decode_lookahead * frame_count * sizeof(int16_t) * SOUND_MAX_MIX_CHANNELS;
+            sound->m_LookaheadSize = 1;
+            while (sound->m_LookaheadSize < size)
+                sound->m_LookaheadSize <<= 1;
+        }
+        sound->m_MaxDecodedSize = max_decoded_size;
+        sound->m_DecodedCacheSize = decoded_cache_size;
+        sound->m_DecodedCacheUsage = 0;
+        sound->m_DecodedUseCounter = 0;
+        sound->m_SizeStamp = 0;
+        dmAtomicStore32(&sound->m_DecodeJobCount, 0);
+
+        sound->m_MaxVoices = max_voices;
+        sound->m_VoiceStealMode = voice_steal_mode == VOICE_STEAL_STOP ? VOICE_STEAL_STOP : VOICE_STEAL_VIRTUALIZE;
+        sound->m_VoiceCandidates.SetCapacity(max_instances);
+        dmAtomicStore32(&sound->m_RealVoiceCount, 0);
+        dmAtomicStore32(&sound->m_VirtualVoiceCount, 0);
+
+        memset(&sound->m_Listener, 0, sizeof(sound->m_Listener));
+        sound->m_Listener.m_Right[0] = 1.0f;
+        sound->m_SpatialInstances.SetCapacity(max_instances);
+        sound->m_SpatialStreams.SetCapacity(SPATIAL_STREAM_COUNT * max_instances);
+        sound->m_SpatialStreams.SetSize(SPATIAL_STREAM_COUNT * max_instances);
+
         sound->m_Instances.SetCapacity(max_instances);
         sound->m_Instances.SetSize(max_instances);
         sound->m_InstancesPool.SetCapacity(max_instances);
@@ -366,9 +612,10 @@ namespace dmSound
             instance->m_SoundDataIndex = 0xffff;
             // NOTE: +1 for "over-fetch" when up-sampling
             // NOTE: and x SOUND_MAX_SPEED for potential pitch range
-            instance->m_Frames = malloc((params->m_FrameCount * SOUND_MAX_SPEED + 1) * sizeof(int16_t) * SOUND_MAX_MIX_CHANNELS);
+            instance->m_Frames = malloc((frame_count * SOUND_MAX_SPEED + 1) * sizeof(int16_t) * SOUND_MAX_MIX_CHANNELS);
             instance->m_FrameCount = 0;
             instance->m_Speed = 1.0f;
+            instance->m_BaseSpeed = 1.0f;
         }
 
         sound->m_SoundData.SetCapacity(max_sound_data);
@@ -377,15 +624,23 @@ namespace dmSound
         for (uint32_t i = 0; i < max_sound_data; ++i)
         {
             sound->m_SoundData[i].m_Index = 0xffff;
+            sound->m_SoundData[i].m_GetData = 0;
+            sound->m_SoundData[i].m_Chunks = 0;
+            sound->m_SoundData[i].m_Decoded = 0;
         }
 
         sound->m_MixRate = device_info.m_MixRate;
-        sound->m_FrameCount = params->m_FrameCount;
+        sound->m_FrameCount = frame_count;
         for (int i = 0; i < SOUND_OUTBUFFER_COUNT; ++i) {
-            sound->m_OutBuffers[i] = (int16_t*) malloc(params->m_FrameCount * sizeof(int16_t) * SOUND_MAX_MIX_CHANNELS);
+            sound->m_OutBuffers[i] = (int16_t*) malloc(frame_count * sizeof(int16_t) * SOUND_MAX_MIX_CHANNELS);
         }
         sound->m_NextOutBuffer = 0;
 
+        sound->m_LowLatency = low_latency;
+        sound->m_IsDeviceFed = false;
+        sound->m_FramesWithoutUnderrun = 0;
+        dmAtomicStore32(&sound->m_TargetBufferCount, low_latency ? LOW_LATENCY_MIN_BUFFERS : SOUND_OUTBUFFER_COUNT);
+
         sound->m_GroupMap.SetCapacity(MAX_GROUPS * 2 + 1, MAX_GROUPS);
         for (uint32_t i = 0; i < MAX_GROUPS; ++i) {
             memset(&sound->m_Groups[i], 0, sizeof(SoundGroup));
@@ -394,22 +649,187 @@ namespace dmSound
         int master_index = GetOrCreateGroup("master");
         SoundGroup* master = &sound->m_Groups[master_index];
         master->m_Gain.Reset(master_gain);
+        master->m_RequestedGain = master_gain;
+
+        dmAtomicStore32(&sound->m_CommandWrite, 0);
+        dmAtomicStore32(&sound->m_CommandRead, 0);
 
         dmAtomicStore32(&sound->m_IsRunning, 1);
         dmAtomicStore32(&sound->m_IsPaused, 0);
         dmAtomicStore32(&sound->m_Status, (int)RESULT_NOTHING_TO_PLAY);
 
+        sound->m_StreamBuffer = (uint8_t*) malloc(STREAM_CHUNK_SIZE);
+        sound->m_NextStreamData = 0;
+
         sound->m_Thread = 0;
         sound->m_Mutex = 0;
+        sound->m_StreamMutex = 0;
         if (params->m_UseThread)
         {
             sound->m_Mutex = dmMutex::New();
+            sound->m_StreamMutex = dmMutex::New();
             sound->m_Thread = dmThread::New((dmThread::ThreadStart)SoundThread, 0x80000, sound, "sound");
         }
 
         return r;
     }
 
+    // Copies up to size decoded bytes from the lookahead buffer. If buffer is 0, they're skipped
+    static uint32_t ReadLookahead(DecodeLookahead* lookahead, char* buffer, uint32_t size)
+    {
+        uint32_t read = (uint32_t) dmAtomicGet32(&lookahead->m_Read);
+        uint32_t n = dmMath::Min(size, (uint32_t) dmAtomicGet32(&lookahead->m_Write) - read);
+        if (buffer)
+        {
+            uint32_t offset = read & (lookahead->m_Size - 1);
+            uint32_t first = dmMath::Min(n, lookahead->m_Size - offset);
+            memcpy(buffer, lookahead->m_Buffer + offset, first);
+            memcpy(buffer + first, lookahead->m_Buffer, n - first);
+        }
+        dmAtomicAdd32(&lookahead->m_Read, (int32_t) n);
+        return n;
+    }
+
+    // Decodes into the free space of the lookahead buffer. Called from a decode job
+    static void FillLookahead(SoundSystem* sound, SoundInstance* instance)
+    {
+        DM_PROFILE(__FUNCTION__);
+        DecodeLookahead* lookahead = &instance->m_Lookahead;
+        uint32_t write = (uint32_t) dmAtomicGet32(&lookahead->m_Write);
+        uint32_t free_size = lookahead->m_Size - (write - (uint32_t) dmAtomicGet32(&lookahead->m_Read));
+        while (free_size > 0 && !dmAtomicGet32(&lookahead->m_EndOfStream))
+        {
+            // The size is a power of two, so the contiguous space is a multiple of the frame size
+            uint32_t offset = write & (lookahead->m_Size - 1);
+            uint32_t n = dmMath::Min(free_size, lookahead->m_Size - offset);
+            uint32_t decoded = 0;
+            dmSoundCodec::Result r = dmSoundCodec::Decode(sound->m_CodecContext, instance->m_Decoder, lookahead->m_Buffer + offset, n, &decoded);
+            write += decoded;
+            free_size -= decoded;
+            dmAtomicAdd32(&lookahead->m_Write, (int32_t) decoded);
+            if (r != dmSoundCodec::RESULT_OK)
+            {
+                dmAtomicStore32(&lookahead->m_Result, (int32_t) r);
+                dmAtomicStore32(&lookahead->m_EndOfStream, 1);
+            }
+            else if (decoded < n)
+            {
+                dmAtomicStore32(&lookahead->m_EndOfStream, 1);
+            }
+        }
+    }
+
+    static int DecodeJob(void* context, void* data)
+    {
+        SoundSystem* sound = (SoundSystem*) context;
+        SoundInstance* instance = (SoundInstance*) data;
+        // The job may have been cancelled by the mixer, in which case it must not touch the decoder
+        if (dmAtomicCompareStore32(&instance->m_Lookahead.m_State, DECODE_STATE_RUNNING, DECODE_STATE_QUEUED) == DECODE_STATE_QUEUED)
+        {
+            FillLookahead(sound, instance);
+            dmAtomicCompareStore32(&instance->m_Lookahead.m_State, DECODE_STATE_IDLE, DECODE_STATE_RUNNING);
+        }
+        dmAtomicDecrement32(&sound->m_DecodeJobCount);
+        return 0;
+    }
+
+    // Makes sure that no decode job uses the decoder of the instance. A job that hasn't started is cancelled, a running one is waited for
+    static void CancelDecodeJob(DecodeLookahead* lookahead)
+    {
+        if (dmAtomicCompareStore32(&lookahead->m_State, DECODE_STATE_IDLE, DECODE_STATE_QUEUED) == DECODE_STATE_QUEUED)
+            return;
+        while (dmAtomicGet32(&lookahead->m_State) == DECODE_STATE_RUNNING)
+        {
+            dmTime::Sleep(0);
+        }
+    }
+
+    // Called by the mixer, with m_Mutex held
+    static void ScheduleDecodeJobs(SoundSystem* sound)
+    {
+        uint32_t instances = sound->m_Instances.Size();
+        for (uint32_t i = 0; i < instances; ++i)
+        {
+            SoundInstance* instance = &sound->m_Instances[i];
+            DecodeLookahead* lookahead = &instance->m_Lookahead;
+            if (!lookahead->m_Buffer || !instance->m_Playing || instance->m_Virtual || dmAtomicGet32(&lookahead->m_EndOfStream))
+                continue;
+
+            // Wait until there's room for a couple of mix buffers, to not decode in too small pieces
+            uint32_t used = (uint32_t) dmAtomicGet32(&lookahead->m_Write) - (uint32_t) dmAtomicGet32(&lookahead->m_Read);
+            if (used > lookahead->m_Size / 2)
+                continue;
+
+            if (dmAtomicCompareStore32(&lookahead->m_State, DECODE_STATE_QUEUED, DECODE_STATE_IDLE) != DECODE_STATE_IDLE)
+                continue;
+
+            dmAtomicIncrement32(&sound->m_DecodeJobCount);
+            dmJobThread::HJob job = dmJobThread::CreateJob(sound->m_JobThread, DecodeJob, 0, sound, instance);
+            if (job == dmJobThread::INVALID_JOB)
+            {
+                dmAtomicStore32(&lookahead->m_State, DECODE_STATE_IDLE);
+                dmAtomicDecrement32(&sound->m_DecodeJobCount);
+                continue;
+            }
+            dmJobThread::PushJob(sound->m_JobThread, job);
+        }
+    }
+
+    // Decodes size bytes of the instance, from the lookahead buffer if there is one. If buffer is 0, the bytes are skipped
+    static dmSoundCodec::Result DecodeInstance(SoundSystem* sound, SoundInstance* instance, char* buffer, uint32_t size, uint32_t* decoded)
+    {
+        DecodeLookahead* lookahead = &instance->m_Lookahead;
+        if (!lookahead->m_Buffer)
+        {
+            if (buffer)
+                return dmSoundCodec::Decode(sound->m_CodecContext, instance->m_Decoder, buffer, size, decoded);
+            return dmSoundCodec::Skip(sound->m_CodecContext, instance->m_Decoder, size, decoded);
+        }
+
+        uint32_t n = ReadLookahead(lookahead, buffer, size);
+        if (n < size)
+        {
+            // Underrun. Take over the decoder, and continue where the job left off
+            CancelDecodeJob(lookahead);
+            n += ReadLookahead(lookahead, buffer ? buffer + n : 0, size - n);
+            if (n < size && !dmAtomicGet32(&lookahead->m_EndOfStream))
+            {
+                uint32_t left = size - n;
+                uint32_t m = 0;
+                dmSoundCodec::Result r;
+                if (buffer)
+                    r = dmSoundCodec::Decode(sound->m_CodecContext, instance->m_Decoder, buffer + n, left, &m);
+                else
+                    r = dmSoundCodec::Skip(sound->m_CodecContext, instance->m_Decoder, left, &m);
+                n += m;
+                if (r != dmSoundCodec::RESULT_OK)
+                    dmAtomicStore32(&lookahead->m_Result, (int32_t) r);
+                if (r != dmSoundCodec::RESULT_OK || m < left)
+                    dmAtomicStore32(&lookahead->m_EndOfStream, 1);
+            }
+        }
+        *decoded = n;
+
+        // Errors are reported once the frames decoded before them are used
+        if (n < size)
+            return (dmSoundCodec::Result) dmAtomicGet32(&lookahead->m_Result);
+        return dmSoundCodec::RESULT_OK;
+    }
+
+    static void ResetInstanceDecoder(SoundSystem* sound, SoundInstance* instance)
+    {
+        DecodeLookahead* lookahead = &instance->m_Lookahead;
+        if (lookahead->m_Buffer)
+        {
+            CancelDecodeJob(lookahead);
+            dmAtomicStore32(&lookahead->m_Write, 0);
+            dmAtomicStore32(&lookahead->m_Read, 0);
+            dmAtomicStore32(&lookahead->m_Result, (int32_t) dmSoundCodec::RESULT_OK);
+            dmAtomicStore32(&lookahead->m_EndOfStream, 0);
+        }
+        dmSoundCodec::Reset(sound->m_CodecContext, instance->m_Decoder);
+    }
+
     Result Finalize()
     {
         SoundSystem* sound = g_SoundSystem;
@@ -421,6 +841,23 @@ namespace dmSound
         {
             dmThread::Join(sound->m_Thread);
             dmMutex::Delete(sound->m_Mutex);
+            dmMutex::Delete(sound->m_StreamMutex);
+        }
+
+        // The decode jobs use the decoders, so they must be done before the codec context is deleted
+        for (uint32_t i = 0; i < sound->m_Instances.Size(); ++i)
+        {
+            DecodeLookahead* lookahead = &sound->m_Instances[i].m_Lookahead;
+            if (lookahead->m_Buffer)
+            {
+                CancelDecodeJob(lookahead);
+                free(lookahead->m_Buffer);
+                lookahead->m_Buffer = 0;
+            }
+        }
+        while (dmAtomicGet32(&sound->m_DecodeJobCount) > 0)
+        {
+            dmTime::Sleep(0);
         }
 
         PlatformFinalize();
@@ -443,6 +880,7 @@ namespace dmSound
             for (int i = 0; i < SOUND_OUTBUFFER_COUNT; ++i) {
                 free((void*) sound->m_OutBuffers[i]);
             }
+            free(sound->m_StreamBuffer);
 
             for (uint32_t i = 0; i < MAX_GROUPS; i++) {
                 SoundGroup* g = &sound->m_Groups[i];
@@ -470,16 +908,259 @@ namespace dmSound
     }
 
 
+    static dmSoundCodec::Format GetCodecFormat(SoundDataType type)
+    {
+        if (type == SOUND_DATA_TYPE_OGG_VORBIS) {
+            return dmSoundCodec::FORMAT_VORBIS;
+        }
+        if (type == SOUND_DATA_TYPE_OPUS) {
+            return dmSoundCodec::FORMAT_OPUS;
+        }
+        assert(type == SOUND_DATA_TYPE_WAV);
+        return dmSoundCodec::FORMAT_WAV;
+    }
+
+    static void WriteLE16(uint8_t* p, uint16_t v)
+    {
+        p[0] = (uint8_t) v;
+        p[1] = (uint8_t) (v >> 8);
+    }
+
+    static void WriteLE32(uint8_t* p, uint32_t v)
+    {
+        WriteLE16(p, (uint16_t) v);
+        WriteLE16(p + 2, (uint16_t) (v >> 16));
+    }
+
+    // Decodes a small compressed sound to pcm wav data, so that playing it costs no decoding
+    static bool DecodeSoundData(HSoundData sound_data, uint32_t max_size, char** out, uint32_t* out_size)
+    {
+        const uint32_t header_size = 44;
+        dmSoundCodec::Info info;
+        char* data = 0;
+        uint32_t data_size = 0;
+        dmSoundCodec::Result r = dmSoundCodec::DecodeToMemory(GetCodecFormat(sound_data->m_Type), sound_data->m_Data, sound_data->m_Size, header_size, max_size, &info, &data, &data_size);
+        if (r != dmSoundCodec::RESULT_OK)
+        {
+            free(data);
+            return false;
+        }
+
+        uint8_t* header = (uint8_t*) data;
+        uint16_t block_align = info.m_Channels * (info.m_BitsPerSample / 8);
+        memcpy(header, "RIFF", 4);
+        WriteLE32(header + 4, header_size - 8 + data_size);
+        memcpy(header + 8, "WAVEfmt ", 8);
+        WriteLE32(header + 16, 16);
+        WriteLE16(header + 20, 1); // PCM
+        WriteLE16(header + 22, info.m_Channels);
+        WriteLE32(header + 24, info.m_Rate);
+        WriteLE32(header + 28, info.m_Rate * block_align);
+        WriteLE16(header + 32, block_align);
+        WriteLE16(header + 34, info.m_BitsPerSample);
+        memcpy(header + 36, "data", 4);
+        WriteLE32(header + 40, data_size);
+
+        *out = data;
+        *out_size = header_size + data_size;
+        return true;
+    }
+
+    // Called with m_Mutex held
+    static void ReleaseDecodedSound(SoundSystem* sound, DecodedSound* decoded)
+    {
+        assert(decoded->m_RefCount > 0);
+        if (--decoded->m_RefCount > 0)
+            return;
+        sound->m_DecodedCacheUsage -= decoded->m_Size;
+        dmMemory::TrackFree(dmMemory::TAG_SOUND, decoded->m_Size);
+        free(decoded->m_Data);
+        delete decoded;
+    }
+
+    // Called with m_Mutex held
+    static void UncacheDecodedSound(SoundSystem* sound, SoundData* sound_data)
+    {
+        if (sound_data->m_Decoded)
+        {
+            ReleaseDecodedSound(sound, sound_data->m_Decoded);
+            sound_data->m_Decoded = 0;
+        }
+    }
+
+    // Evicts the least recently used decoded sounds that aren't playing, until size fits the cache. Called with m_Mutex held
+    static bool ReserveDecodedCache(SoundSystem* sound, uint32_t size)
+    {
+        if (size > sound->m_DecodedCacheSize)
+            return false;
+
+        while (sound->m_DecodedCacheUsage + size > sound->m_DecodedCacheSize)
+        {
+            SoundData* lru = 0;
+            uint32_t n = sound->m_SoundData.Size();
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                SoundData* sd = &sound->m_SoundData[i];
+                if (sd->m_Decoded && sd->m_Decoded->m_RefCount == 1 && (!lru || sd->m_Decoded->m_LastUse < lru->m_Decoded->m_LastUse))
+                    lru = sd;
+            }
+            if (!lru)
+                return false;
+            UncacheDecodedSound(sound, lru);
+        }
+        return true;
+    }
+
+    // Puts the decoded data of a compressed sound in the decoded cache, unless it's already there
+    static void CacheDecodedSound(SoundSystem* sound, SoundData* sound_data)
+    {
+        if (sound_data->m_Type == SOUND_DATA_TYPE_WAV || sound_data->m_Undecodable || sound->m_MaxDecodedSize == 0 || !sound_data->m_Data)
+            return;
+
+        {
+            DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
+            if (sound_data->m_Decoded)
+                return;
+            // Don't decode what wouldn't fit anyway
+            if (sound_data->m_DecodedSize > 0 && !ReserveDecodedCache(sound, sound_data->m_DecodedSize))
+                return;
+        }
+
+        // Decoded without the lock, since the mixer doesn't use the compressed data of the sound data
+        DM_PROFILE("DecodeSoundData");
+        char* data;
+        uint32_t size;
+        if (!DecodeSoundData(sound_data, sound->m_MaxDecodedSize, &data, &size))
+        {
+            sound_data->m_Undecodable = true;
+            return;
+        }
+        sound_data->m_DecodedSize = size;
+
+        DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
+        if (!ReserveDecodedCache(sound, size))
+        {
+            free(data);
+            return;
+        }
+
+        DecodedSound* decoded = new DecodedSound;
+        decoded->m_Data = data;
+        decoded->m_Size = size;
+        decoded->m_RefCount = 1;
+        decoded->m_LastUse = ++sound->m_DecodedUseCounter;
+        sound->m_DecodedCacheUsage += size;
+        dmMemory::TrackAlloc(dmMemory::TAG_SOUND, size);
+        sound_data->m_Decoded = decoded;
+    }
+
     static Result SetSoundDataNoLock(HSoundData sound_data, const void* sound_buffer, uint32_t sound_buffer_size)
     {
+        // Instances already playing the decoded data keep their reference
+        UncacheDecodedSound(g_SoundSystem, sound_data);
+        sound_data->m_DecodedSize = 0;
+        sound_data->m_Undecodable = false;
+
+        if (sound_data->m_Data)
+            dmMemory::TrackFree(dmMemory::TAG_SOUND, sound_data->m_Size);
         free(sound_data->m_Data);
         sound_data->m_Data = malloc(sound_buffer_size);
         sound_data->m_Size = sound_buffer_size;
+        dmMemory::TrackAlloc(dmMemory::TAG_SOUND, sound_buffer_size);
         memcpy(sound_data->m_Data, sound_buffer, sound_buffer_size);
+
+        // Instances already streaming keep using the chunks they have, new instances play from memory
+        sound_data->m_GetData = 0;
+        sound_data->m_GetDataContext = 0;
         return RESULT_OK;
     }
 
-    Result NewSoundData(const void* sound_buffer, uint32_t sound_buffer_size, SoundDataType type, HSoundData* sound_data, dmhash_t name)
+    static StreamChunk* FindStreamChunk(SoundData* sound_data, uint32_t index)
+    {
+        for (uint32_t i = 0; i < STREAM_CHUNK_COUNT; ++i)
+        {
+            if (sound_data->m_Chunks[i].m_Index == index)
+                return &sound_data->m_Chunks[i];
+        }
+        return 0;
+    }
+
+    static StreamChunk* GetLeastRecentlyUsedStreamChunk(SoundData* sound_data)
+    {
+        StreamChunk* lru = &sound_data->m_Chunks[0];
+        for (uint32_t i = 1; i < STREAM_CHUNK_COUNT; ++i)
+        {
+            StreamChunk* chunk = &sound_data->m_Chunks[i];
+            if (chunk->m_Index == INVALID_STREAM_CHUNK)
+                return chunk;
+            if (chunk->m_LastUse < lru->m_LastUse)
+                lru = chunk;
+        }
+        return lru;
+    }
+
+    static uint32_t GetStreamChunkSize(SoundData* sound_data, uint32_t index)
+    {
+        return dmMath::Min(STREAM_CHUNK_SIZE, sound_data->m_StreamSize - index * STREAM_CHUNK_SIZE);
+    }
+
+    // Returns the chunk, reading it if it isn't resident. Called with m_Mutex held
+    static StreamChunk* GetStreamChunk(SoundData* sound_data, uint32_t index)
+    {
+        StreamChunk* chunk = FindStreamChunk(sound_data, index);
+        if (!chunk)
+        {
+            if (!sound_data->m_GetData)
+                return 0;
+
+            DM_PROFILE("StreamChunkMiss");
+            chunk = GetLeastRecentlyUsedStreamChunk(sound_data);
+            uint32_t nread = 0;
+            Result r = sound_data->m_GetData(sound_data->m_GetDataContext, index * STREAM_CHUNK_SIZE, GetStreamChunkSize(sound_data, index), chunk->m_Data, &nread);
+            if (r != RESULT_OK)
+            {
+                dmLogError("Failed to read streamed sound data (%d)", r);
+                chunk->m_Index = INVALID_STREAM_CHUNK;
+                return 0;
+            }
+            chunk->m_Index = index;
+            chunk->m_Size = nread;
+        }
+        chunk->m_LastUse = ++sound_data->m_StreamUseCounter;
+        return chunk;
+    }
+
+    // dmSoundCodec::DataSource read function for streamed sound data. Called with m_Mutex held
+    static uint32_t StreamRead(void* context, uint32_t offset, void* buffer, uint32_t size)
+    {
+        SoundData* sound_data = (SoundData*) context;
+        uint32_t done = 0;
+        while (done < size)
+        {
+            uint32_t pos = offset + done;
+            uint32_t index = pos / STREAM_CHUNK_SIZE;
+            StreamChunk* chunk = GetStreamChunk(sound_data, index);
+            if (!chunk)
+                break;
+
+            uint32_t chunk_offset = pos - index * STREAM_CHUNK_SIZE;
+            if (chunk_offset >= chunk->m_Size)
+                break;
+
+            uint32_t n = dmMath::Min(size - done, chunk->m_Size - chunk_offset);
+            memcpy((uint8_t*) buffer + done, chunk->m_Data + chunk_offset, n);
+            done += n;
+
+            uint32_t next = index + 1;
+            if (next * STREAM_CHUNK_SIZE < sound_data->m_StreamSize && !FindStreamChunk(sound_data, next))
+            {
+                sound_data->m_PrefetchChunk = next;
+            }
+        }
+        return done;
+    }
+
+    static SoundData* AllocateSoundData(SoundDataType type, dmhash_t name)
     {
         SoundSystem* sound = g_SoundSystem;
 
@@ -488,9 +1169,8 @@ namespace dmSound
             DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
             if (sound->m_SoundDataPool.Remaining() == 0)
             {
-                *sound_data = 0;
                 dmLogError("Out of sound data slots (%u). Increase the project setting 'sound.max_sound_data'", sound->m_SoundDataPool.Capacity());
-                return RESULT_OUT_OF_INSTANCES;
+                return 0;
             }
 
             index = sound->m_SoundDataPool.Pop();
@@ -502,32 +1182,97 @@ namespace dmSound
         sd->m_Index = index;
         sd->m_Data = 0;
         sd->m_Size = 0;
+        sd->m_Decoded = 0;
+        sd->m_DecodedSize = 0;
+        sd->m_Undecodable = false;
+        sd->m_SizeStamp = 0;
+        sd->m_GetData = 0;
+        sd->m_GetDataContext = 0;
+        sd->m_Chunks = 0;
+        sd->m_StreamSize = 0;
+        sd->m_StreamUseCounter = 0;
+        sd->m_PrefetchChunk = INVALID_STREAM_CHUNK;
         sd->m_RefCount = 1;
+        return sd;
+    }
+
+    Result NewSoundData(const void* sound_buffer, uint32_t sound_buffer_size, SoundDataType type, HSoundData* sound_data, dmhash_t name)
+    {
+        SoundData* sd = AllocateSoundData(type, name);
+        if (!sd)
+        {
+            *sound_data = 0;
+            return RESULT_OUT_OF_INSTANCES;
+        }
 
         Result result = SetSoundDataNoLock(sd, sound_buffer, sound_buffer_size);
         if (result == RESULT_OK)
+        {
+            CacheDecodedSound(g_SoundSystem, sd);
             *sound_data = sd;
+        }
         else
             DeleteSoundData(sd);
 
         return result;
     }
 
+    Result NewSoundDataStreaming(FSoundDataGetData cbk, void* cbk_ctx, uint32_t size, SoundDataType type, HSoundData* sound_data, dmhash_t name)
+    {
+        *sound_data = 0;
+        if (!dmSoundCodec::IsDataSourceSupported(GetCodecFormat(type)))
+        {
+            return RESULT_UNSUPPORTED;
+        }
+
+        SoundData* sd = AllocateSoundData(type, name);
+        if (!sd)
+        {
+            return RESULT_OUT_OF_INSTANCES;
+        }
+
+        sd->m_Chunks = (StreamChunk*) malloc(STREAM_CHUNK_COUNT * sizeof(StreamChunk));
+        for (uint32_t i = 0; i < STREAM_CHUNK_COUNT; ++i)
+        {
+            sd->m_Chunks[i].m_Index = INVALID_STREAM_CHUNK;
+            sd->m_Chunks[i].m_Size = 0;
+            sd->m_Chunks[i].m_LastUse = 0;
+        }
+        sd->m_StreamSize = size;
+        sd->m_Size = size;
+        sd->m_GetData = cbk;
+        sd->m_GetDataContext = cbk_ctx;
+
+        *sound_data = sd;
+        return RESULT_OK;
+    }
+
     Result SetSoundData(HSoundData sound_data, const void* sound_buffer, uint32_t sound_buffer_size)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        return SetSoundDataNoLock(sound_data, sound_buffer, sound_buffer_size);
+        Result result;
+        {
+            DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_StreamMutex);
+            DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
+            result = SetSoundDataNoLock(sound_data, sound_buffer, sound_buffer_size);
+        }
+        if (result == RESULT_OK)
+            CacheDecodedSound(g_SoundSystem, sound_data);
+        return result;
     }
 
     uint32_t GetSoundResourceSize(HSoundData sound_data)
     {
-        return sound_data->m_Size + sizeof(SoundData);
+        uint32_t size = sound_data->m_Data ? sound_data->m_Size : 0;
+        if (sound_data->m_Chunks)
+            size += STREAM_CHUNK_COUNT * sizeof(StreamChunk);
+        if (sound_data->m_Decoded)
+            size += sound_data->m_Decoded->m_Size;
+        return size + sizeof(SoundData);
     }
 
-    Result DeleteSoundData(HSoundData sound_data)
+    // Called with m_Mutex held
+    static Result ReleaseSoundDataNoLock(SoundSystem* sound, HSoundData sound_data)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        
         sound_data->m_RefCount --;
         if (sound_data->m_RefCount > 0)
         {
@@ -535,29 +1280,205 @@ namespace dmSound
         }
 
         if (sound_data->m_Data != 0x0)
+        {
+            dmMemory::TrackFree(dmMemory::TAG_SOUND, sound_data->m_Size);
             free((void*) sound_data->m_Data);
+        }
+        sound_data->m_Data = 0;
+        UncacheDecodedSound(sound, sound_data);
+
+        free(sound_data->m_Chunks);
+        sound_data->m_Chunks = 0;
+        sound_data->m_GetData = 0;
+        sound_data->m_GetDataContext = 0;
 
-        SoundSystem* sound = g_SoundSystem;
         sound->m_SoundDataPool.Push(sound_data->m_Index);
         sound_data->m_Index = 0xffff;
 
         return RESULT_OK;
     }
 
+    Result DeleteSoundData(HSoundData sound_data)
+    {
+        SoundSystem* sound = g_SoundSystem;
+        // Wait for an ongoing refill, since the owner may free the stream callback context once we return
+        DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_StreamMutex);
+        DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
+
+        // Instances still playing a streamed sound play out the chunks that are already read
+        sound_data->m_GetData = 0;
+        sound_data->m_GetDataContext = 0;
+        return ReleaseSoundDataNoLock(sound, sound_data);
+    }
+
+    static inline void SetPlaying(SoundInstance* instance, bool playing)
+    {
+        instance->m_Playing = playing;
+        dmAtomicStore32(&instance->m_IsPlaying, (int32_t)playing);
+    }
+
+    // Called by the mixer, or with m_Mutex held
+    static void ApplyCommand(SoundSystem* sound, const Command* command)
+    {
+        SoundInstance* instance = command->m_Instance;
+        switch (command->m_Type)
+        {
+            case COMMAND_PLAY:
+            case COMMAND_STOP:
+            case COMMAND_PAUSE:
+                if (command->m_Type == COMMAND_PLAY)
+                {
+                    if (!instance->m_Playing)
+                        instance->m_SpatialApplied = 0;
+                    SetPlaying(instance, true);
+                }
+                else if (command->m_Type == COMMAND_STOP)
+                {
+                    SetPlaying(instance, false);
+                    ResetInstanceDecoder(sound, instance);
+                }
+                else
+                {
+                    SetPlaying(instance, !command->m_Flag);
+                }
+                // After the state is published, see IsPlaying()
+                dmAtomicDecrement32(&instance->m_PendingPlayCommands);
+                break;
+
+            case COMMAND_SET_LOOPING:
+                instance->m_Looping = (uint32_t) command->m_Flag;
+                instance->m_Loopcounter = command->m_Loopcounter;
+                break;
+
+            case COMMAND_SET_PARAMETER:
+                {
+                    bool reset = !instance->m_Playing;
+                    if (command->m_Parameter == PARAMETER_GAIN)
+                        instance->m_Gain.Set(command->m_Value, reset);
+                    else if (command->m_Parameter == PARAMETER_PAN)
+                        instance->m_Pan.Set(command->m_Value, reset);
+                    else
+                    {
+                        instance->m_BaseSpeed = command->m_Value;
+                        instance->m_Speed = command->m_Value;
+                    }
+                }
+                break;
+
+            case COMMAND_SET_INSTANCE_GROUP:
+                instance->m_Group = command->m_Group;
+                break;
+
+            case COMMAND_SET_GROUP_GAIN:
+                {
+                    // If all playing sounds is currently at gain zero
+                    // we can safely do a hard reset of the group gain
+                    bool reset = true;
+                    uint32_t instances = sound->m_Instances.Size();
+                    for (uint32_t i = 0; i < instances; ++i)
+                    {
+                        SoundInstance* si = &sound->m_Instances[i];
+                        if (si->m_Group != command->m_Group)
+                        {
+                            continue;
+                        }
+                        if (si->m_Playing || si->m_FrameCount > 0)
+                        {
+                            if (si->m_Gain.m_Prev == 0.0)
+                            {
+                                continue;
+                            }
+                            reset = false;
+                            break;
+                        }
+                    }
+                    SoundGroup* group = &sound->m_Groups[*sound->m_GroupMap.Get(command->m_Group)];
+                    group->m_Gain.Set(command->m_Value, reset);
+                }
+                break;
+
+            case COMMAND_SET_PRIORITY:
+                instance->m_Priority = (uint8_t) command->m_Count;
+                break;
+
+            case COMMAND_SET_GROUP_VOICE_LIMIT:
+                sound->m_Groups[*sound->m_GroupMap.Get(command->m_Group)].m_MaxVoices = command->m_Count;
+                break;
+
+            case COMMAND_SET_SPATIAL:
+                instance->m_Spatial = command->m_Flag;
+                instance->m_SpatialApplied = 0;
+                instance->m_MinDistance = command->m_Vector[0];
+                instance->m_MaxDistance = command->m_Vector[1];
+                instance->m_AttenuationA = command->m_Vector[2];
+                instance->m_AttenuationB = command->m_Vector[3];
+                instance->m_DopplerFactor = command->m_Vector[4];
+                instance->m_Speed = instance->m_BaseSpeed;
+                break;
+
+            case COMMAND_SET_POSITION:
+                memcpy(instance->m_Position, &command->m_Vector[0], sizeof(instance->m_Position));
+                memcpy(instance->m_Velocity, &command->m_Vector[3], sizeof(instance->m_Velocity));
+                break;
+
+            case COMMAND_SET_LISTENER:
+                memcpy(sound->m_Listener.m_Position, &command->m_Vector[0], sizeof(sound->m_Listener.m_Position));
+                memcpy(sound->m_Listener.m_Velocity, &command->m_Vector[3], sizeof(sound->m_Listener.m_Velocity));
+                memcpy(sound->m_Listener.m_Right, &command->m_Vector[6], sizeof(sound->m_Listener.m_Right));
+                break;
+        }
+    }
+
+    // Applies the queued commands. Called by the mixer, or with m_Mutex held
+    static void FlushCommands(SoundSystem* sound)
+    {
+        uint32_t read = (uint32_t) dmAtomicGet32(&sound->m_CommandRead);
+        uint32_t write = (uint32_t) dmAtomicGet32(&sound->m_CommandWrite);
+        while (read != write)
+        {
+            ApplyCommand(sound, &sound->m_Commands[read % COMMAND_QUEUE_SIZE]);
+            ++read;
+            dmAtomicIncrement32(&sound->m_CommandRead);
+        }
+    }
+
+    // Called from the game thread only
+    static void PushCommand(SoundSystem* sound, const Command& command)
+    {
+        uint32_t write = (uint32_t) dmAtomicGet32(&sound->m_CommandWrite);
+        if (write - (uint32_t) dmAtomicGet32(&sound->m_CommandRead) == COMMAND_QUEUE_SIZE)
+        {
+            // The mixer is behind (or there is no sound thread, and Update() isn't called), so make room on this thread
+            DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
+            FlushCommands(sound);
+        }
+        sound->m_Commands[write % COMMAND_QUEUE_SIZE] = command;
+        dmAtomicIncrement32(&sound->m_CommandWrite);
+    }
+
+    static void PushPlayCommand(SoundSystem* sound, SoundInstance* instance, CommandType type, bool pause)
+    {
+        instance->m_RequestedPlaying = type == COMMAND_PLAY || (type == COMMAND_PAUSE && !pause);
+        dmAtomicIncrement32(&instance->m_PendingPlayCommands);
+
+        Command command;
+        memset(&command, 0, sizeof(command));
+        command.m_Type = type;
+        command.m_Instance = instance;
+        command.m_Flag = pause;
+        PushCommand(sound, command);
+    }
+
     Result NewSoundInstance(HSoundData sound_data, HSoundInstance* sound_instance)
     {
         SoundSystem* ss = g_SoundSystem;
 
         dmSoundCodec::HDecoder decoder;
+        dmSoundCodec::Format codec_format;
+        DecodedSound* decoded;
 
-        dmSoundCodec::Format codec_format = dmSoundCodec::FORMAT_WAV;
-        if (sound_data->m_Type == SOUND_DATA_TYPE_WAV) {
-            codec_format = dmSoundCodec::FORMAT_WAV;
-        } else if (sound_data->m_Type == SOUND_DATA_TYPE_OGG_VORBIS) {
-            codec_format = dmSoundCodec::FORMAT_VORBIS;
-        } else {
-            assert(0);
-        }
+        // Decodes it again if it was evicted from the decoded cache
+        CacheDecodedSound(ss, sound_data);
 
         uint16_t index;
         {
@@ -570,13 +1491,37 @@ namespace dmSound
                 return RESULT_OUT_OF_INSTANCES;
             }
 
-            dmSoundCodec::Result r = dmSoundCodec::NewDecoder(ss->m_CodecContext, codec_format, sound_data->m_Data, sound_data->m_Size, &decoder);
+            decoded = sound_data->m_Decoded;
+            codec_format = decoded ? dmSoundCodec::FORMAT_WAV : GetCodecFormat(sound_data->m_Type);
+
+            dmSoundCodec::Result r;
+            if (decoded)
+            {
+                r = dmSoundCodec::NewDecoder(ss->m_CodecContext, codec_format, decoded->m_Data, decoded->m_Size, &decoder);
+            }
+            else if (sound_data->m_GetData)
+            {
+                dmSoundCodec::DataSource source;
+                source.m_Read = StreamRead;
+                source.m_Context = sound_data;
+                source.m_Size = sound_data->m_StreamSize;
+                r = dmSoundCodec::NewDecoder(ss->m_CodecContext, codec_format, &source, &decoder);
+            }
+            else
+            {
+                r = dmSoundCodec::NewDecoder(ss->m_CodecContext, codec_format, sound_data->m_Data, sound_data->m_Size, &decoder);
+            }
             if (r != dmSoundCodec::RESULT_OK) {
                 dmLogError("Failed to decode sound (%d)", r);
                 return RESULT_INVALID_STREAM_DATA;
             }
 
             index = ss->m_InstancesPool.Pop();
+            if (decoded)
+            {
+                decoded->m_RefCount++;
+                decoded->m_LastUse = ++ss->m_DecodedUseCounter;
+            }
         }
 
         sound_data->m_RefCount ++;
@@ -590,37 +1535,74 @@ namespace dmSound
         si->m_Pan.Reset(0.5f);
         si->m_Looping = 0;
         si->m_EndOfStream = 0;
-        si->m_Playing = 0;
+        // Gets its voice on the first update
+        si->m_Virtual = 1;
+        si->m_Stolen = 0;
+        si->m_Skipped = 0;
+        si->m_Spatial = 0;
+        si->m_SpatialApplied = 0;
+        si->m_Priority = DEFAULT_PRIORITY;
+        si->m_RequestedPlaying = 0;
+        SetPlaying(si, false);
+        dmAtomicStore32(&si->m_PendingPlayCommands, 0);
         si->m_Decoder = decoder;
+        si->m_DecodedSound = decoded;
         si->m_Group = MASTER_GROUP_HASH;
 
+        // Streamed sounds read their data with m_Mutex held, so they aren't decoded by jobs. Nor is wav data, which needs no decoding
+        DecodeLookahead* lookahead = &si->m_Lookahead;
+        if (ss->m_LookaheadSize > 0 && codec_format != dmSoundCodec::FORMAT_WAV && !sound_data->m_GetData)
+        {
+            lookahead->m_Buffer = (char*) malloc(ss->m_LookaheadSize);
+            lookahead->m_Size = ss->m_LookaheadSize;
+            dmAtomicStore32(&lookahead->m_Write, 0);
+            dmAtomicStore32(&lookahead->m_Read, 0);
+            dmAtomicStore32(&lookahead->m_Result, (int32_t) dmSoundCodec::RESULT_OK);
+            dmAtomicStore32(&lookahead->m_EndOfStream, 0);
+        }
+
         *sound_instance = si;
 
         return RESULT_OK;
     }
 
-    static void StopNoLock(SoundSystem* sound, HSoundInstance sound_instance);
-
     Result DeleteSoundInstance(HSoundInstance sound_instance)
     {
         SoundSystem* sound = g_SoundSystem;
         DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
 
-        if (IsPlaying(sound_instance))
+        // No queued command may refer to the instance once it's deleted
+        FlushCommands(sound);
+
+        if (sound_instance->m_Playing)
         {
             dmLogError("Deleting playing sound instance (%s)", GetSoundName(sound, sound_instance));
-            StopNoLock(sound, sound_instance);
+            SetPlaying(sound_instance, false);
+        }
+
+        DecodeLookahead* lookahead = &sound_instance->m_Lookahead;
+        if (lookahead->m_Buffer)
+        {
+            CancelDecodeJob(lookahead);
+            free(lookahead->m_Buffer);
+            lookahead->m_Buffer = 0;
         }
 
         uint16_t index = sound_instance->m_Index;
         sound->m_InstancesPool.Push(index);
         sound_instance->m_Index = 0xffff;
-        DeleteSoundData(&sound->m_SoundData[sound_instance->m_SoundDataIndex]);
-        sound_instance->m_SoundDataIndex = 0xffff;
         dmSoundCodec::DeleteDecoder(sound->m_CodecContext, sound_instance->m_Decoder);
+        if (sound_instance->m_DecodedSound)
+        {
+            ReleaseDecodedSound(sound, sound_instance->m_DecodedSound);
+            sound_instance->m_DecodedSound = 0;
+        }
+        ReleaseSoundDataNoLock(sound, &sound->m_SoundData[sound_instance->m_SoundDataIndex]);
+        sound_instance->m_SoundDataIndex = 0xffff;
         sound_instance->m_Decoder = 0;
         sound_instance->m_FrameCount = 0;
         sound_instance->m_Speed = 1.0f;
+        sound_instance->m_BaseSpeed = 1.0f;
 
         return RESULT_OK;
     }
@@ -633,13 +1615,19 @@ namespace dmSound
 
     Result SetInstanceGroup(HSoundInstance instance, dmhash_t group_hash)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
+        // The groups are only added from the game thread, so the map can be read without the lock
         SoundSystem* sound = g_SoundSystem;
         int* index = sound->m_GroupMap.Get(group_hash);
         if (!index) {
             return RESULT_NO_SUCH_GROUP;
         }
-        instance->m_Group = group_hash;
+
+        Command command;
+        memset(&command, 0, sizeof(command));
+        command.m_Type = COMMAND_SET_INSTANCE_GROUP;
+        command.m_Instance = instance;
+        command.m_Group = group_hash;
+        PushCommand(sound, command);
         return RESULT_OK;
     }
 
@@ -655,42 +1643,41 @@ namespace dmSound
 
     Result SetGroupGain(dmhash_t group_hash, float gain)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
         SoundSystem* sound = g_SoundSystem;
         int* index = sound->m_GroupMap.Get(group_hash);
         if (!index) {
             return RESULT_NO_SUCH_GROUP;
         }
 
-        // If all playing sounds is currently at gain zero
-        // we can safely do a hard reset of the group gain
-        bool reset = true;
-        uint32_t instances = sound->m_Instances.Size();
-        for (uint32_t i = 0; i < instances; ++i)
-        {
-            SoundInstance* instance = &sound->m_Instances[i];
-            if (instance->m_Group != group_hash)
-            {
-                continue;
-            }
-            if (instance->m_Playing || instance->m_FrameCount > 0)
-            {
-                if (instance->m_Gain.m_Prev == 0.0)
-                {
-                    continue;
-                }
-                reset = false;
-                break;
-            }
+        sound->m_Groups[*index].m_RequestedGain = gain;
+
+        Command command;
+        memset(&command, 0, sizeof(command));
+        command.m_Type = COMMAND_SET_GROUP_GAIN;
+        command.m_Group = group_hash;
+        command.m_Value = gain;
+        PushCommand(sound, command);
+        return RESULT_OK;
+    }
+
+    Result SetGroupVoiceLimit(dmhash_t group_hash, uint32_t max_voices)
+    {
+        SoundSystem* sound = g_SoundSystem;
+        if (!sound->m_GroupMap.Get(group_hash)) {
+            return RESULT_NO_SUCH_GROUP;
         }
-        SoundGroup* group = &sound->m_Groups[*index];
-        group->m_Gain.Set(gain, reset);
+
+        Command command;
+        memset(&command, 0, sizeof(command));
+        command.m_Type = COMMAND_SET_GROUP_VOICE_LIMIT;
+        command.m_Group = group_hash;
+        command.m_Count = max_voices;
+        PushCommand(sound, command);
         return RESULT_OK;
     }
 
     Result GetGroupGain(dmhash_t group_hash, float* gain)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
         SoundSystem* sound = g_SoundSystem;
         int* index = sound->m_GroupMap.Get(group_hash);
         if (!index) {
@@ -698,7 +1685,7 @@ namespace dmSound
         }
 
         SoundGroup* group = &sound->m_Groups[*index];
-        *gain = group->m_Gain.m_Next;
+        *gain = group->m_RequestedGain;
         return RESULT_OK;
     }
 
@@ -716,17 +1703,43 @@ namespace dmSound
         return RESULT_OK;
     }
 
-    Result GetGroupRMS(dmhash_t group_hash, float window, float* rms_left, float* rms_right)
+    // Reads the last group memory published by the mixer
+    static void GetGroupMemory(SoundGroup* group, GroupMemory* memory)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
+        while (true)
+        {
+            int32_t version = dmAtomicGet32(&group->m_SnapshotVersion);
+            *memory = group->m_Snapshots[version & 1];
+            // Once the version has changed, the mixer may be writing to the snapshot we just copied
+            if (dmAtomicGet32(&group->m_SnapshotVersion) == version)
+                return;
+        }
+    }
+
+    // Called by the mixer
+    static void PublishGroupMemory(SoundSystem* sound)
+    {
+        for (uint32_t i = 0; i < MAX_GROUPS; i++) {
+            SoundGroup* g = &sound->m_Groups[i];
+            if (g->m_MixBuffer) {
+                int32_t version = dmAtomicGet32(&g->m_SnapshotVersion);
+                g->m_Snapshots[(version + 1) & 1] = g->m_Memory;
+                dmAtomicIncrement32(&g->m_SnapshotVersion);
+            }
+        }
+    }
 
+    Result GetGroupRMS(dmhash_t group_hash, float window, float* rms_left, float* rms_right)
+    {
         SoundSystem* sound = g_SoundSystem;
         int* index = sound->m_GroupMap.Get(group_hash);
         if (!index) {
             return RESULT_NO_SUCH_GROUP;
         }
 
-        SoundGroup* g = &sound->m_Groups[*index];
+        GroupMemory memory;
+        GetGroupMemory(&sound->m_Groups[*index], &memory);
+        GroupMemory* g = &memory;
         uint32_t rms_frames = (uint32_t) (sound->m_MixRate * window);
         int left = rms_frames;
         int ss_index = (g->m_NextMemorySlot - 1) % GROUP_MEMORY_BUFFER_COUNT;
@@ -750,15 +1763,15 @@ namespace dmSound
 
     Result GetGroupPeak(dmhash_t group_hash, float window, float* peak_left, float* peak_right)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-
         SoundSystem* sound = g_SoundSystem;
         int* index = sound->m_GroupMap.Get(group_hash);
         if (!index) {
             return RESULT_NO_SUCH_GROUP;
         }
 
-        SoundGroup* g = &sound->m_Groups[*index];
+        GroupMemory memory;
+        GetGroupMemory(&sound->m_Groups[*index], &memory);
+        GroupMemory* g = &memory;
         uint32_t rms_frames = (uint32_t) (sound->m_MixRate * window);
         int left = rms_frames;
         int ss_index = (g->m_NextMemorySlot - 1) % GROUP_MEMORY_BUFFER_COUNT;
@@ -780,22 +1793,13 @@ namespace dmSound
 
     Result Play(HSoundInstance sound_instance)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        sound_instance->m_Playing = 1;
+        PushPlayCommand(g_SoundSystem, sound_instance, COMMAND_PLAY, false);
         return RESULT_OK;
     }
 
-    static void StopNoLock(SoundSystem* sound, HSoundInstance sound_instance)
-    {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        sound_instance->m_Playing = 0;
-        dmSoundCodec::Reset(sound->m_CodecContext, sound_instance->m_Decoder);
-    }
-
     Result Stop(HSoundInstance sound_instance)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        StopNoLock(g_SoundSystem, sound_instance);
+        PushPlayCommand(g_SoundSystem, sound_instance, COMMAND_STOP, false);
         return RESULT_OK;
     }
 
@@ -803,8 +1807,7 @@ namespace dmSound
     {
         if (!g_SoundSystem)
             return RESULT_OK;
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        sound_instance->m_Playing = (uint8_t)!pause;
+        PushPlayCommand(g_SoundSystem, sound_instance, COMMAND_PAUSE, pause);
         return RESULT_OK;
     }
 
@@ -819,52 +1822,201 @@ namespace dmSound
 
     bool IsPlaying(HSoundInstance sound_instance)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        return sound_instance->m_Playing; // && !sound_instance->m_EndOfStream;
+        // Until the mixer has applied the queued commands, the last requested state is the answer.
+        // The mixer publishes the state before decrementing the count
+        if (dmAtomicGet32(&sound_instance->m_PendingPlayCommands) > 0)
+            return sound_instance->m_RequestedPlaying;
+        return dmAtomicGet32(&sound_instance->m_IsPlaying) != 0; // && !sound_instance->m_EndOfStream;
     }
 
     Result SetLooping(HSoundInstance sound_instance, bool looping, int8_t loopcounter)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        sound_instance->m_Looping = (uint32_t) looping;
-        sound_instance->m_Loopcounter = loopcounter;
+        Command command;
+        memset(&command, 0, sizeof(command));
+        command.m_Type = COMMAND_SET_LOOPING;
+        command.m_Instance = sound_instance;
+        command.m_Flag = looping;
+        command.m_Loopcounter = loopcounter;
+        PushCommand(g_SoundSystem, command);
+        return RESULT_OK;
+    }
+
+    Result SetPriority(HSoundInstance sound_instance, uint8_t priority)
+    {
+        Command command;
+        memset(&command, 0, sizeof(command));
+        command.m_Type = COMMAND_SET_PRIORITY;
+        command.m_Instance = sound_instance;
+        command.m_Count = priority;
+        PushCommand(g_SoundSystem, command);
+        return RESULT_OK;
+    }
+
+    void GetVoiceCounts(uint32_t* real_count, uint32_t* virtual_count)
+    {
+        SoundSystem* sound = g_SoundSystem;
+        *real_count = (uint32_t) dmAtomicGet32(&sound->m_RealVoiceCount);
+        *virtual_count = (uint32_t) dmAtomicGet32(&sound->m_VirtualVoiceCount);
+    }
+
+    float GetLatency()
+    {
+        SoundSystem* sound = g_SoundSystem;
+        if (!sound || !sound->m_Device)
+            return 0.0f;
+        return dmAtomicGet32(&sound->m_TargetBufferCount) * sound->m_FrameCount / (float) sound->m_MixRate;
+    }
+
+    Result GetGroupSoundDataSize(dmhash_t group_hash, uint32_t* size)
+    {
+        SoundSystem* sound = g_SoundSystem;
+        *size = 0;
+        if (!sound->m_GroupMap.Get(group_hash)) {
+            return RESULT_NO_SUCH_GROUP;
+        }
+
+        DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
+        // The instance groups are changed by commands
+        FlushCommands(sound);
+
+        // Each sound data is counted once, however many instances play it
+        uint32_t stamp = ++sound->m_SizeStamp;
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < sound->m_Instances.Size(); ++i)
+        {
+            SoundInstance* instance = &sound->m_Instances[i];
+            if (instance->m_Index == 0xffff || instance->m_Group != group_hash)
+                continue;
+
+            SoundData* sound_data = &sound->m_SoundData[instance->m_SoundDataIndex];
+            if (sound_data->m_SizeStamp == stamp)
+                continue;
+            sound_data->m_SizeStamp = stamp;
+            total += GetSoundResourceSize(sound_data);
+        }
+        *size = total;
         return RESULT_OK;
     }
 
+    void GetDecodedCacheSize(uint32_t* size, uint32_t* capacity)
+    {
+        SoundSystem* sound = g_SoundSystem;
+        DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
+        *size = sound->m_DecodedCacheUsage;
+        *capacity = sound->m_DecodedCacheSize;
+    }
+
     Result SetParameter(HSoundInstance sound_instance, Parameter parameter, const Vector4& value)
     {
-        bool reset = !sound_instance->m_Playing;
+        float v;
         switch(parameter)
         {
             case PARAMETER_GAIN:
-                sound_instance->m_Gain.Set(dmMath::Max(0.0f, value.getX()), reset);
+                v = dmMath::Max(0.0f, value.getX());
                 break;
             case PARAMETER_PAN:
-                {
-                    float pan = dmMath::Max(-1.0f, dmMath::Min(1.0f, value.getX()));
-                    pan = (pan + 1.0f) * 0.5f; // map [-1,1] to [0,1] for easier calculations later
-                    sound_instance->m_Pan.Set(pan, reset);
-                }
+                v = dmMath::Max(-1.0f, dmMath::Min(1.0f, value.getX()));
+                v = (v + 1.0f) * 0.5f; // map [-1,1] to [0,1] for easier calculations later
                 break;
             case PARAMETER_SPEED:
-                sound_instance->m_Speed = dmMath::Max(0.0f, dmMath::Min((float)SOUND_MAX_SPEED, value.getX()));
+                v = dmMath::Max(0.0f, dmMath::Min((float)SOUND_MAX_SPEED, value.getX()));
                 break;
             default:
                 dmLogError("Invalid parameter: %d (%s)\n", parameter, GetSoundName(g_SoundSystem, sound_instance));
                 return RESULT_INVALID_PROPERTY;
         }
+
+        Command command;
+        memset(&command, 0, sizeof(command));
+        command.m_Type = COMMAND_SET_PARAMETER;
+        command.m_Instance = sound_instance;
+        command.m_Parameter = parameter;
+        command.m_Value = v;
+        PushCommand(g_SoundSystem, command);
+        return RESULT_OK;
+    }
+
+    Result SetSpatial(HSoundInstance sound_instance, const SpatialParams* params)
+    {
+        Command command;
+        memset(&command, 0, sizeof(command));
+        command.m_Type = COMMAND_SET_SPATIAL;
+        command.m_Instance = sound_instance;
+        command.m_Flag = params != 0;
+        if (params)
+        {
+            float min_distance = dmMath::Max(0.0f, params->m_MinDistance);
+            float max_distance = dmMath::Max(min_distance, params->m_MaxDistance);
+            float rolloff = dmMath::Max(0.0f, params->m_Rolloff);
+            // See SPATIAL_ATTENUATION_A
+            float a = 0.0f;
+            float b = 0.0f;
+            switch (params->m_Attenuation)
+            {
+                case ATTENUATION_NONE:
+                    break;
+                case ATTENUATION_INVERSE:
+                    b = rolloff / dmMath::Max(min_distance, 0.0001f);
+                    break;
+                case ATTENUATION_LINEAR:
+                    if (max_distance > min_distance)
+                        a = rolloff / (max_distance - min_distance);
+                    break;
+                default:
+                    dmLogError("Invalid attenuation model: %d (%s)\n", params->m_Attenuation, GetSoundName(g_SoundSystem, sound_instance));
+                    return RESULT_INVALID_PROPERTY;
+            }
+            command.m_Vector[0] = min_distance;
+            command.m_Vector[1] = max_distance;
+            command.m_Vector[2] = a;
+            command.m_Vector[3] = b;
+            command.m_Vector[4] = dmMath::Max(0.0f, params->m_DopplerFactor);
+        }
+        PushCommand(g_SoundSystem, command);
+        return RESULT_OK;
+    }
+
+    Result SetPosition(HSoundInstance sound_instance, const Point3& position, const Vector3& velocity)
+    {
+        Command command;
+        memset(&command, 0, sizeof(command));
+        command.m_Type = COMMAND_SET_POSITION;
+        command.m_Instance = sound_instance;
+        command.m_Vector[0] = position.getX();
+        command.m_Vector[1] = position.getY();
+        command.m_Vector[2] = position.getZ();
+        command.m_Vector[3] = velocity.getX();
+        command.m_Vector[4] = velocity.getY();
+        command.m_Vector[5] = velocity.getZ();
+        PushCommand(g_SoundSystem, command);
         return RESULT_OK;
     }
 
-    static inline void GetPanScale(float pan, float* left_scale, float* right_scale)
+    void SetListener(const Point3& position, const Quat& rotation, const Vector3& velocity)
     {
-        // Constant power panning: https://www.cs.cmu.edu/~music/icm-online/readings/panlaws/index.html
-        const float theta = pan * M_PI_2;
-        *left_scale = cosf(theta);
-        *right_scale = sinf(theta);
+        // Set by the camera, whether there is a sound system or not
+        if (!g_SoundSystem)
+            return;
+
+        Vector3 right = Rotate(rotation, Vector3(1.0f, 0.0f, 0.0f));
+
+        Command command;
+        memset(&command, 0, sizeof(command));
+        command.m_Type = COMMAND_SET_LISTENER;
+        command.m_Vector[0] = position.getX();
+        command.m_Vector[1] = position.getY();
+        command.m_Vector[2] = position.getZ();
+        command.m_Vector[3] = velocity.getX();
+        command.m_Vector[4] = velocity.getY();
+        command.m_Vector[5] = velocity.getZ();
+        command.m_Vector[6] = right.getX();
+        command.m_Vector[7] = right.getY();
+        command.m_Vector[8] = right.getZ();
+        PushCommand(g_SoundSystem, command);
     }
 
     /*
+     * The mixers convert the frames to float, one block at a time, and mix them with the kernels in sound_mix.cpp
      *
      * Template parameters
      *
@@ -892,29 +2044,28 @@ namespace dmSound
 
         Ramp gain_ramp = GetRamp(mix_context, &instance->m_Gain, mix_buffer_count);
         Ramp pan_ramp = GetRamp(mix_context, &instance->m_Pan, mix_buffer_count);
-        for (uint32_t i = 0; i < mix_buffer_count; i++)
+        float samples[MIX_BLOCK_SIZE];
+        for (uint32_t start = 0; start < mix_buffer_count; start += MIX_BLOCK_SIZE)
         {
-            float gain = gain_ramp.GetValue(i);
-            float pan = pan_ramp.GetValue(i);
-            float mix = frac * range_recip; // determines the bias between two consecutive samples in the sound instance. It ranges from 0-1. A mix of 0, makes only the first sample count while a mix of 0.5 will count equally both samples.
-            T s1 = frames[index];
-            T s2 = frames[index + 1];
-            s1 = (s1 - offset) * scale;
-            s2 = (s2 - offset) * scale;
-
-            float left_scale, right_scale;
-            GetPanScale(pan, &left_scale, &right_scale);
+            uint32_t count = dmMath::Min(MIX_BLOCK_SIZE, mix_buffer_count - start);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                float mix = frac * range_recip; // determines the bias between two consecutive samples in the sound instance. It ranges from 0-1. A mix of 0, makes only the first sample count while a mix of 0.5 will count equally both samples.
+                T s1 = frames[index];
+                T s2 = frames[index + 1];
+                s1 = (s1 - offset) * scale;
+                s2 = (s2 - offset) * scale;
 
-            float s = (1.0f - mix) * s1 + mix * s2; // resulting destination sample value is a mix of two source samples since a kind of fractional indexing is used
-            mix_buffer[2 * i] += s * gain * left_scale;
-            mix_buffer[2 * i + 1] += s * gain * right_scale;
+                samples[i] = (1.0f - mix) * s1 + mix * s2; // resulting destination sample value is a mix of two source samples since a kind of fractional indexing is used
 
-            prev_index = index; // keep old index for assertion
-            frac += delta;
+                prev_index = index; // keep old index for assertion
+                frac += delta;
 
-            index += (uint32_t)(frac >> RESAMPLE_FRACTION_BITS);
+                index += (uint32_t)(frac >> RESAMPLE_FRACTION_BITS);
 
-            frac &= ((1U << RESAMPLE_FRACTION_BITS) - 1U); // Keep lower RESAMPLE_FRACTION_BITS bits. Clear higher.
+                frac &= ((1U << RESAMPLE_FRACTION_BITS) - 1U); // Keep lower RESAMPLE_FRACTION_BITS bits. Clear higher.
+            }
+            MixMono(mix_buffer + 2 * start, samples, start, count, gain_ramp, pan_ramp);
         }
         instance->m_FrameFraction = frac;
 
@@ -947,34 +2098,33 @@ namespace dmSound
 
         Ramp gain_ramp = GetRamp(mix_context, &instance->m_Gain, mix_buffer_count);
         Ramp pan_ramp = GetRamp(mix_context, &instance->m_Pan, mix_buffer_count);
-        for (uint32_t i = 0; i < mix_buffer_count; i++)
+        float samples[2 * MIX_BLOCK_SIZE];
+        for (uint32_t start = 0; start < mix_buffer_count; start += MIX_BLOCK_SIZE)
         {
-            float gain = gain_ramp.GetValue(i);
-            float pan = pan_ramp.GetValue(i);
-            float mix = frac * range_recip;
-            T sl1 = frames[2 * index];
-            T sl2 = frames[2 * index + 2];
-            sl1 = (sl1 - offset) * scale;
-            sl2 = (sl2 - offset) * scale;
-
-            T sr1 = frames[2 * index + 1];
-            T sr2 = frames[2 * index + 3];
-            sr1 = (sr1 - offset) * scale;
-            sr2 = (sr2 - offset) * scale;
+            uint32_t count = dmMath::Min(MIX_BLOCK_SIZE, mix_buffer_count - start);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                float mix = frac * range_recip;
+                T sl1 = frames[2 * index];
+                T sl2 = frames[2 * index + 2];
+                sl1 = (sl1 - offset) * scale;
+                sl2 = (sl2 - offset) * scale;
 
-            float left_scale, right_scale;
-            GetPanScale(pan, &left_scale, &right_scale);
+                T sr1 = frames[2 * index + 1];
+                T sr2 = frames[2 * index + 3];
+                sr1 = (sr1 - offset) * scale;
+                sr2 = (sr2 - offset) * scale;
 
-            float sl = (1.0f - mix) * sl1 + mix * sl2;
-            float sr = (1.0f - mix) * sr1 + mix * sr2;
-            mix_buffer[2 * i]       += sl * gain * left_scale;
-            mix_buffer[2 * i + 1]   += sr * gain * right_scale;
+                samples[2 * i]     = (1.0f - mix) * sl1 + mix * sl2;
+                samples[2 * i + 1] = (1.0f - mix) * sr1 + mix * sr2;
 
-            prev_index = index;
-            frac += delta;
-            index += (uint32_t)(frac >> RESAMPLE_FRACTION_BITS);
+                prev_index = index;
+                frac += delta;
+                index += (uint32_t)(frac >> RESAMPLE_FRACTION_BITS);
 
-            frac &= ((1U << RESAMPLE_FRACTION_BITS) - 1U);
+                frac &= ((1U << RESAMPLE_FRACTION_BITS) - 1U);
+            }
+            MixStereo(mix_buffer + 2 * start, samples, start, count, gain_ramp, pan_ramp);
         }
         instance->m_FrameFraction = frac;
 
@@ -984,6 +2134,7 @@ namespace dmSound
         instance->m_FrameCount -= index;
     }
 
+    // ConvertSamples applies the same offset and scale per sample type as the template parameters
     template <typename T, int offset, int scale>
     static void MixResampleIdentityMono(const MixContext* mix_context, SoundInstance* instance, uint32_t rate, uint32_t mix_rate, float* mix_buffer, uint32_t mix_buffer_count)
     {
@@ -994,17 +2145,12 @@ namespace dmSound
         Ramp gain_ramp = GetRamp(mix_context, &instance->m_Gain, mix_buffer_count);
         Ramp pan_ramp = GetRamp(mix_context, &instance->m_Pan, mix_buffer_count);
 
-        for (uint32_t i = 0; i < mix_buffer_count; i++)
+        float samples[MIX_BLOCK_SIZE];
+        for (uint32_t start = 0; start < mix_buffer_count; start += MIX_BLOCK_SIZE)
         {
-            float gain = gain_ramp.GetValue(i);
-            float pan = pan_ramp.GetValue(i);
-            float s = frames[i];
-            s = (s - offset) * scale * gain;
-
-            float left_scale, right_scale;
-            GetPanScale(pan, &left_scale, &right_scale);
-            mix_buffer[2 * i]       += s * left_scale;
-            mix_buffer[2 * i + 1]   += s * right_scale;
+            uint32_t count = dmMath::Min(MIX_BLOCK_SIZE, mix_buffer_count - start);
+            ConvertSamples(frames + start, samples, count);
+            MixMono(mix_buffer + 2 * start, samples, start, count, gain_ramp, pan_ramp);
         }
         instance->m_FrameCount -= mix_buffer_count;
     }
@@ -1019,19 +2165,12 @@ namespace dmSound
         Ramp gain_ramp = GetRamp(mix_context, &instance->m_Gain, mix_buffer_count);
         Ramp pan_ramp = GetRamp(mix_context, &instance->m_Pan, mix_buffer_count);
 
-        for (uint32_t i = 0; i < mix_buffer_count; i++)
+        float samples[2 * MIX_BLOCK_SIZE];
+        for (uint32_t start = 0; start < mix_buffer_count; start += MIX_BLOCK_SIZE)
         {
-            float gain = gain_ramp.GetValue(i);
-            float pan = pan_ramp.GetValue(i);
-            float s1 = frames[2 * i];
-            float s2 = frames[2 * i + 1];
-            s1 = (s1 - offset) * scale * gain;
-            s2 = (s2 - offset) * scale * gain;
-
-            float left_scale, right_scale;
-            GetPanScale(pan, &left_scale, &right_scale);
-            mix_buffer[2 * i]       += s1 * left_scale;
-            mix_buffer[2 * i + 1]   += s2 * right_scale;
+            uint32_t count = dmMath::Min(MIX_BLOCK_SIZE, mix_buffer_count - start);
+            ConvertSamples(frames + 2 * start, samples, 2 * count);
+            MixStereo(mix_buffer + 2 * start, samples, start, count, gain_ramp, pan_ramp);
         }
         instance->m_FrameCount -= mix_buffer_count;
     }
@@ -1068,7 +2207,7 @@ namespace dmSound
     static void MixResample(const MixContext* mix_context, SoundInstance* instance, const dmSoundCodec::Info* info, uint32_t mix_rate, float* mix_buffer, uint32_t mix_buffer_count)
     {
         const uint32_t rate = info->m_Rate;
-        assert(rate <= mix_rate);
+        assert(rate <= mix_rate * SOUND_MAX_DOWNSAMPLE);
 
         void (*mixer)(const MixContext* mix_context, SoundInstance* instance, uint32_t rate, uint32_t mix_rate, float* mix_buffer, uint32_t mix_buffer_count) = 0;
 
@@ -1098,14 +2237,20 @@ namespace dmSound
         mixer(mix_context, instance, rate, mix_rate, mix_buffer, mix_buffer_count);
     }
 
+    // Number of frames of the mix buffer that the decoded frames of the instance cover
+    static uint32_t GetMixCount(SoundSystem* sound, SoundInstance* instance, const dmSoundCodec::Info* info)
+    {
+        uint64_t delta = (uint32_t) ((((uint64_t) info->m_Rate) << RESAMPLE_FRACTION_BITS) / sound->m_MixRate);
+        uint32_t mix_count = ((uint64_t) (instance->m_FrameCount) << RESAMPLE_FRACTION_BITS) / (delta * instance->m_Speed);
+        return dmMath::Min(mix_count, sound->m_FrameCount);
+    }
+
     static void Mix(const MixContext* mix_context, SoundInstance* instance, const dmSoundCodec::Info* info)
     {
         DM_PROFILE(__FUNCTION__);
 
         SoundSystem* sound = g_SoundSystem;
-        uint64_t delta = (uint32_t) ((((uint64_t) info->m_Rate) << RESAMPLE_FRACTION_BITS) / sound->m_MixRate);
-        uint32_t mix_count = ((uint64_t) (instance->m_FrameCount) << RESAMPLE_FRACTION_BITS) / (delta * instance->m_Speed);
-        mix_count = dmMath::Min(mix_count, sound->m_FrameCount);
+        uint32_t mix_count = GetMixCount(sound, instance, info);
         assert(mix_count <= sound->m_FrameCount);
 
         int* index = sound->m_GroupMap.Get(instance->m_Group);
@@ -1117,6 +2262,25 @@ namespace dmSound
         }
     }
 
+    // Consumes the decoded frames of a virtual instance, as the resamplers would when mixing them
+    static void MixVirtual(SoundInstance* instance, const dmSoundCodec::Info* info)
+    {
+        SoundSystem* sound = g_SoundSystem;
+        uint32_t mix_count = GetMixCount(sound, instance, info);
+        uint32_t index = mix_count;
+        if (info->m_Rate != sound->m_MixRate || instance->m_Speed != 1.0f)
+        {
+            uint64_t delta = (((uint64_t) info->m_Rate) << RESAMPLE_FRACTION_BITS) / sound->m_MixRate;
+            delta *= instance->m_Speed;
+            uint64_t frac = instance->m_FrameFraction + delta * mix_count;
+            index = (uint32_t) (frac >> RESAMPLE_FRACTION_BITS);
+            instance->m_FrameFraction = frac & ((1U << RESAMPLE_FRACTION_BITS) - 1U);
+        }
+        // The frames of a virtual instance are silent, so they don't need to be moved
+        instance->m_FrameCount -= dmMath::Min(index, instance->m_FrameCount);
+        instance->m_Skipped = 1;
+    }
+
     static bool IsMuted(SoundInstance* instance) {
         SoundSystem* sound = g_SoundSystem;
 
@@ -1157,20 +2321,30 @@ namespace dmSound
         bool correct_num_channels = info.m_Channels == 1 || info.m_Channels == 2;
         if (!correct_bit_depth || !correct_num_channels) {
             dmLogError("Only mono/stereo with 8/16 bits per sample is supported (%s): %u bpp %u ch", GetSoundName(sound, instance), (uint32_t)info.m_BitsPerSample, (uint32_t)info.m_Channels);
-            instance->m_Playing = 0;
+            SetPlaying(instance, false);
             return;
         }
 
-        if (info.m_Rate > sound->m_MixRate) {
-            dmLogError("Sounds with rate higher than sample-rate not supported (%d hz > %d hz) (%s)", info.m_Rate, sound->m_MixRate, GetSoundName(sound, instance));
-            instance->m_Playing = 0;
+        if (info.m_Rate > sound->m_MixRate * SOUND_MAX_DOWNSAMPLE) {
+            dmLogError("Sounds with rate higher than %d times the sample-rate not supported (%d hz > %d hz) (%s)", SOUND_MAX_DOWNSAMPLE, info.m_Rate, sound->m_MixRate, GetSoundName(sound, instance));
+            SetPlaying(instance, false);
             return;
         }
 
-        bool is_muted = dmSound::IsMuted(instance);
+        // Sounds with a higher rate than the mix rate (e.g. 48 kHz Opus) consume more frames per mixed frame.
+        // Their speed is limited to what fits in the frame buffer
+        float rate_ratio = 1.0f;
+        if (info.m_Rate > sound->m_MixRate) {
+            rate_ratio = info.m_Rate / (float) sound->m_MixRate;
+            instance->m_Speed = dmMath::Min(instance->m_Speed, SOUND_MAX_SPEED / rate_ratio);
+        }
+
+        // Virtual instances skip their frames, and leave silence for when they're mixed again
+        bool is_muted = instance->m_Virtual || dmSound::IsMuted(instance);
 
         dmSoundCodec::Result r = dmSoundCodec::RESULT_OK;
-        uint32_t mixed_instance_FrameCount = ceilf(sound->m_FrameCount * dmMath::Max(1.0f, instance->m_Speed));
+        uint32_t mixed_instance_FrameCount = ceilf(sound->m_FrameCount * dmMath::Max(1.0f, instance->m_Speed * rate_ratio));
+        mixed_instance_FrameCount = dmMath::Min(mixed_instance_FrameCount, sound->m_FrameCount * SOUND_MAX_SPEED);
 
         if (instance->m_FrameCount < mixed_instance_FrameCount && instance->m_Playing) {
 
@@ -1179,15 +2353,11 @@ namespace dmSound
 
             if (!is_muted)
             {
-                r = dmSoundCodec::Decode(sound->m_CodecContext,
-                                         instance->m_Decoder,
-                                         ((char*) instance->m_Frames) + instance->m_FrameCount * stride,
-                                         n * stride,
-                                         &decoded);
+                r = DecodeInstance(sound, instance, ((char*) instance->m_Frames) + instance->m_FrameCount * stride, n * stride, &decoded);
             }
             else
             {
-                r = dmSoundCodec::Skip(sound->m_CodecContext, instance->m_Decoder, n * stride, &decoded);
+                r = DecodeInstance(sound, instance, 0, n * stride, &decoded);
                 memset(((char*) instance->m_Frames) + instance->m_FrameCount * stride, 0x00, n * stride);
             }
 
@@ -1197,7 +2367,7 @@ namespace dmSound
             if (instance->m_FrameCount < mixed_instance_FrameCount) {
 
                 if (instance->m_Looping && instance->m_Loopcounter != 0) {
-                    dmSoundCodec::Reset(sound->m_CodecContext, instance->m_Decoder);
+                    ResetInstanceDecoder(sound, instance);
                     if ( instance->m_Loopcounter > 0 ) {
                         instance->m_Loopcounter --;
                     }
@@ -1205,15 +2375,11 @@ namespace dmSound
                     uint32_t n = mixed_instance_FrameCount - instance->m_FrameCount;
                     if (!is_muted)
                     {
-                        r = dmSoundCodec::Decode(sound->m_CodecContext,
-                                                 instance->m_Decoder,
-                                                 ((char*) instance->m_Frames) + instance->m_FrameCount * stride,
-                                                 n * stride,
-                                                 &decoded);
+                        r = DecodeInstance(sound, instance, ((char*) instance->m_Frames) + instance->m_FrameCount * stride, n * stride, &decoded);
                     }
                     else
                     {
-                        r = dmSoundCodec::Skip(sound->m_CodecContext, instance->m_Decoder, n * stride, &decoded);
+                        r = DecodeInstance(sound, instance, 0, n * stride, &decoded);
                         memset(((char*) instance->m_Frames) + instance->m_FrameCount * stride, 0x00, n * stride);
                     }
 
@@ -1234,12 +2400,17 @@ namespace dmSound
 
         if (r != dmSoundCodec::RESULT_OK) {
             dmLogWarning("Unable to decode file '%s'. Result %d", GetSoundName(sound, instance), r);
-            instance->m_Playing = 0;
+            SetPlaying(instance, false);
             return;
         }
 
         if (instance->m_FrameCount > 0)
-            Mix(mix_context, instance, &info);
+        {
+            if (instance->m_Virtual)
+                MixVirtual(instance, &info);
+            else
+                Mix(mix_context, instance, &info);
+        }
 
         if (instance->m_FrameCount <= 1 && instance->m_EndOfStream) {
             // NOTE: Due to round-off errors, e.g 32000 -> 44100,
@@ -1276,11 +2447,12 @@ namespace dmSound
                     max_sq_left = dmMath::Max(max_sq_left, left_sq);
                     max_sq_right = dmMath::Max(max_sq_right, right_sq);
                 }
-                g->m_SumSquaredMemory[2 * g->m_NextMemorySlot + 0] = sum_sq_left;
-                g->m_SumSquaredMemory[2 * g->m_NextMemorySlot + 1] = sum_sq_right;
-                g->m_PeakMemorySq[2 * g->m_NextMemorySlot + 0] = max_sq_left;
-                g->m_PeakMemorySq[2 * g->m_NextMemorySlot + 1] = max_sq_right;
-                g->m_NextMemorySlot = (g->m_NextMemorySlot + 1) % GROUP_MEMORY_BUFFER_COUNT;
+                GroupMemory* memory = &g->m_Memory;
+                memory->m_SumSquaredMemory[2 * memory->m_NextMemorySlot + 0] = sum_sq_left;
+                memory->m_SumSquaredMemory[2 * memory->m_NextMemorySlot + 1] = sum_sq_right;
+                memory->m_PeakMemorySq[2 * memory->m_NextMemorySlot + 0] = max_sq_left;
+                memory->m_PeakMemorySq[2 * memory->m_NextMemorySlot + 1] = max_sq_right;
+                memory->m_NextMemorySlot = (memory->m_NextMemorySlot + 1) % GROUP_MEMORY_BUFFER_COUNT;
 
                 memset(g->m_MixBuffer, 0, sound->m_FrameCount * sizeof(float) * 2);
             }
@@ -1295,7 +2467,7 @@ namespace dmSound
             }
 
             if (instance->m_EndOfStream && instance->m_FrameCount == 0) {
-                instance->m_Playing = 0;
+                SetPlaying(instance, false);
             }
         }
     }
@@ -1332,29 +2504,11 @@ namespace dmSound
                 continue;
             }
             Ramp ramp = GetRamp(mix_context, &g->m_Gain, n);
-            for (uint32_t i = 0; i < n; i++) {
-                float gain = ramp.GetValue(i);
-                gain = dmMath::Clamp(gain, 0.0f, 1.0f);
-
-                float s1 = g->m_MixBuffer[2 * i];
-                float s2 = g->m_MixBuffer[2 * i + 1];
-                mix_buffer[2 * i] += s1 * gain;
-                mix_buffer[2 * i + 1] += s2 * gain;
-            }
+            MixGroup(mix_buffer, g->m_MixBuffer, n, ramp);
         }
 
         Ramp ramp = GetRamp(mix_context, &master->m_Gain, n);
-        for (uint32_t i = 0; i < n; i++) {
-            float gain = ramp.GetValue(i);
-            float s1 = mix_buffer[2 * i] * gain;
-            float s2 = mix_buffer[2 * i + 1] * gain;
-            s1 = dmMath::Min(32767.0f, s1);
-            s1 = dmMath::Max(-32768.0f, s1);
-            s2 = dmMath::Min(32767.0f, s2);
-            s2 = dmMath::Max(-32768.0f, s2);
-            out[2 * i] = (int16_t) s1;
-            out[2 * i + 1] = (int16_t) s2;
-        }
+        MixMaster(mix_buffer, out, n, ramp);
     }
 
     static void StepGroupValues()
@@ -1383,20 +2537,285 @@ namespace dmSound
         }
     }
 
-    static Result UpdateInternal(SoundSystem* sound)
+    /**
+     * Scales the gain, pan and speed of the playing spatial instances by their attenuation, pan and doppler shift.
+     * They are computed in one pass over all instances, see Spatialize(). Called after the values are stepped
+     */
+    static void UpdateSpatial(SoundSystem* sound)
     {
         DM_PROFILE(__FUNCTION__);
-        if (!sound->m_Device)
+
+        dmArray<uint16_t>& indices = sound->m_SpatialInstances;
+        indices.SetSize(0);
+
+        float* streams = sound->m_SpatialStreams.Begin();
+        const uint32_t stride = sound->m_Instances.Size();
+        uint32_t instances = sound->m_Instances.Size();
+        for (uint32_t i = 0; i < instances; ++i)
         {
-            return RESULT_OK;
+            SoundInstance* instance = &sound->m_Instances[i];
+            if (!instance->m_Spatial || !(instance->m_Playing || instance->m_FrameCount > 0))
+                continue;
+
+            uint32_t n = indices.Size();
+            streams[SPATIAL_POSITION_X * stride + n] = instance->m_Position[0];
+            streams[SPATIAL_POSITION_Y * stride + n] = instance->m_Position[1];
+            streams[SPATIAL_POSITION_Z * stride + n] = instance->m_Position[2];
+            streams[SPATIAL_VELOCITY_X * stride + n] = instance->m_Velocity[0];
+            streams[SPATIAL_VELOCITY_Y * stride + n] = instance->m_Velocity[1];
+            streams[SPATIAL_VELOCITY_Z * stride + n] = instance->m_Velocity[2];
+            streams[SPATIAL_MIN_DISTANCE * stride + n] = instance->m_MinDistance;
+            streams[SPATIAL_MAX_DISTANCE * stride + n] = instance->m_MaxDistance;
+            streams[SPATIAL_ATTENUATION_A * stride + n] = instance->m_AttenuationA;
+            streams[SPATIAL_ATTENUATION_B * stride + n] = instance->m_AttenuationB;
+            streams[SPATIAL_DOPPLER_FACTOR * stride + n] = instance->m_DopplerFactor;
+            indices.Push((uint16_t) i);
+        }
+
+        uint32_t count = indices.Size();
+        if (count == 0)
+            return;
+
+        Spatialize(sound->m_Listener, streams, stride, count);
+
+        for (uint32_t n = 0; n < count; ++n)
+        {
+            SoundInstance* instance = &sound->m_Instances[indices[n]];
+            float gain = streams[SPATIAL_GAIN * stride + n];
+            float pan = streams[SPATIAL_PAN * stride + n] - 0.5f;
+
+            instance->m_Gain.m_Current *= gain;
+            instance->m_Pan.m_Current = dmMath::Max(0.0f, dmMath::Min(1.0f, instance->m_Pan.m_Current + pan));
+            if (!instance->m_SpatialApplied)
+            {
+                // Don't ramp from the values without the spatial ones
+                instance->m_Gain.m_Prev = instance->m_Gain.m_Current;
+                instance->m_Pan.m_Prev = instance->m_Pan.m_Current;
+                instance->m_SpatialApplied = 1;
+            }
+
+            float speed = instance->m_BaseSpeed * streams[SPATIAL_DOPPLER * stride + n];
+            instance->m_Speed = dmMath::Min(speed, (float) SOUND_MAX_SPEED);
+        }
+    }
+
+    static bool VoiceCandidatePred(const VoiceCandidate& a, const VoiceCandidate& b)
+    {
+        if (a.m_Priority != b.m_Priority)
+            return a.m_Priority > b.m_Priority;
+        if (a.m_Gain != b.m_Gain)
+            return a.m_Gain > b.m_Gain;
+        // Prefer the instances that already have a voice, to not switch back and forth between equal ones
+        if (a.m_Real != b.m_Real)
+            return a.m_Real > b.m_Real;
+        return a.m_Index < b.m_Index;
+    }
+
+    /**
+     * Decides which instances are mixed in this update, within the global and group voice limits.
+     * The rest are virtual, and only advance their playback. Instances fade in when they get a voice,
+     * and are faded out over one update when it's stolen. Called after the values are stepped
+     */
+    static void UpdateVoices(SoundSystem* sound)
+    {
+        DM_PROFILE(__FUNCTION__);
+
+        dmArray<VoiceCandidate>& candidates = sound->m_VoiceCandidates;
+        candidates.SetSize(0);
+        uint32_t instances = sound->m_Instances.Size();
+        for (uint32_t i = 0; i < instances; ++i)
+        {
+            SoundInstance* instance = &sound->m_Instances[i];
+            if (!instance->m_Playing && instance->m_FrameCount == 0)
+                continue;
+
+            // Muted instances never need a voice
+            if (IsMuted(instance))
+            {
+                instance->m_Virtual = 1;
+                instance->m_Stolen = 0;
+                continue;
+            }
+
+            float gain = instance->m_Gain.m_Current;
+            int* group_index = sound->m_GroupMap.Get(instance->m_Group);
+            if (group_index)
+                gain *= sound->m_Groups[*group_index].m_Gain.m_Current;
+
+            VoiceCandidate candidate;
+            candidate.m_Gain = gain;
+            candidate.m_Index = (uint16_t) i;
+            candidate.m_Priority = instance->m_Priority;
+            candidate.m_Real = !instance->m_Virtual;
+            candidates.Push(candidate);
+        }
+
+        for (uint32_t i = 0; i < MAX_GROUPS; ++i)
+        {
+            sound->m_Groups[i].m_VoiceCount = 0;
+        }
+
+        std::sort(candidates.Begin(), candidates.End(), VoiceCandidatePred);
+
+        uint32_t real_count = 0;
+        uint32_t voice_count = 0;
+        for (uint32_t i = 0; i < candidates.Size(); ++i)
+        {
+            SoundInstance* instance = &sound->m_Instances[candidates[i].m_Index];
+            int* group_index = sound->m_GroupMap.Get(instance->m_Group);
+            SoundGroup* group = group_index ? &sound->m_Groups[*group_index] : 0;
+
+            bool has_voice = sound->m_MaxVoices == 0 || voice_count < sound->m_MaxVoices;
+            if (group && group->m_MaxVoices > 0 && group->m_VoiceCount >= group->m_MaxVoices)
+                has_voice = false;
+
+            if (has_voice)
+            {
+                if (instance->m_Skipped)
+                    instance->m_Gain.m_Prev = 0.0f;
+                instance->m_Virtual = 0;
+                instance->m_Skipped = 0;
+                instance->m_Stolen = 0;
+                ++voice_count;
+                ++real_count;
+                if (group)
+                    ++group->m_VoiceCount;
+            }
+            else if (!instance->m_Virtual && !instance->m_Stolen)
+            {
+                // The fade out doesn't take a voice from the others
+                instance->m_Gain.m_Current = 0.0f;
+                instance->m_Stolen = 1;
+                ++real_count;
+            }
+            else if (sound->m_VoiceStealMode == VOICE_STEAL_STOP)
+            {
+                SetPlaying(instance, false);
+                ResetInstanceDecoder(sound, instance);
+                instance->m_FrameCount = 0;
+                instance->m_Virtual = 1;
+                instance->m_Stolen = 0;
+            }
+            else
+            {
+                instance->m_Virtual = 1;
+                instance->m_Stolen = 0;
+            }
+        }
+
+        uint32_t playing_count = 0;
+        for (uint32_t i = 0; i < instances; ++i)
+        {
+            SoundInstance* instance = &sound->m_Instances[i];
+            if (instance->m_Playing || instance->m_FrameCount > 0)
+                ++playing_count;
+        }
+        dmAtomicStore32(&sound->m_RealVoiceCount, (int32_t) real_count);
+        dmAtomicStore32(&sound->m_VirtualVoiceCount, (int32_t) (playing_count - real_count));
+    }
+
+    // Reads ahead for one streamed sound data per update, without holding m_Mutex during the read
+    static void UpdateStreams(SoundSystem* sound)
+    {
+        DM_PROFILE(__FUNCTION__);
+        DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_StreamMutex);
+
+        FSoundDataGetData get_data = 0;
+        void* get_data_context = 0;
+        uint32_t chunk_index = INVALID_STREAM_CHUNK;
+        uint32_t chunk_size = 0;
+        uint32_t sound_data_index = 0;
+        {
+            DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
+            uint32_t count = sound->m_SoundData.Size();
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                sound_data_index = (sound->m_NextStreamData + i) % count;
+                SoundData* sd = &sound->m_SoundData[sound_data_index];
+                if (sd->m_Index == 0xffff || !sd->m_GetData || sd->m_PrefetchChunk == INVALID_STREAM_CHUNK)
+                    continue;
+
+                chunk_index = sd->m_PrefetchChunk;
+                sd->m_PrefetchChunk = INVALID_STREAM_CHUNK;
+                if (FindStreamChunk(sd, chunk_index))
+                    continue;
+
+                get_data = sd->m_GetData;
+                get_data_context = sd->m_GetDataContext;
+                chunk_size = GetStreamChunkSize(sd, chunk_index);
+                sound->m_NextStreamData = (uint16_t) ((sound_data_index + 1) % count);
+                break;
+            }
+        }
+
+        if (!get_data)
+            return;
+
+        uint32_t nread = 0;
+        Result r = get_data(get_data_context, chunk_index * STREAM_CHUNK_SIZE, chunk_size, sound->m_StreamBuffer, &nread);
+        if (r != RESULT_OK)
+        {
+            // Retried synchronously when the decoder gets to it
+            return;
+        }
+
+        DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
+        // The last instance may have released the sound data while we were reading
+        SoundData* sd = &sound->m_SoundData[sound_data_index];
+        if (sd->m_Index == 0xffff || sd->m_GetData != get_data || sd->m_GetDataContext != get_data_context || FindStreamChunk(sd, chunk_index))
+            return;
+
+        StreamChunk* chunk = GetLeastRecentlyUsedStreamChunk(sd);
+        memcpy(chunk->m_Data, sound->m_StreamBuffer, nread);
+        chunk->m_Index = chunk_index;
+        chunk->m_Size = nread;
+        chunk->m_LastUse = ++sd->m_StreamUseCounter;
+    }
+
+    /*
+     * In low latency mode only m_TargetBufferCount buffers are kept queued on the device, instead of all of them.
+     * When the device has played all of them, it ran dry and another buffer is kept queued. After a while
+     * without underruns, one is dropped again. Returns the number of buffers to mix now
+     */
+    static uint32_t GetLowLatencyFreeSlots(SoundSystem* sound, uint32_t free_slots)
+    {
+        uint32_t target = (uint32_t) dmAtomicGet32(&sound->m_TargetBufferCount);
+        if (free_slots >= SOUND_OUTBUFFER_COUNT && sound->m_IsDeviceFed)
+        {
+            if (target < SOUND_OUTBUFFER_COUNT)
+            {
+                ++target;
+                dmLogInfo("Sound underrun, queuing %u buffers (%.1f ms)", target, target * sound->m_FrameCount * 1000.0f / sound->m_MixRate);
+            }
+            sound->m_FramesWithoutUnderrun = 0;
+        }
+        else if (target > LOW_LATENCY_MIN_BUFFERS && sound->m_FramesWithoutUnderrun >= LOW_LATENCY_SETTLE_TIME * sound->m_MixRate)
+        {
+            --target;
+            sound->m_FramesWithoutUnderrun = 0;
         }
+        dmAtomicStore32(&sound->m_TargetBufferCount, (int32_t) target);
+
+        uint32_t queued = SOUND_OUTBUFFER_COUNT - dmMath::Min(free_slots, (uint32_t) SOUND_OUTBUFFER_COUNT);
+        return queued < target ? target - queued : 0;
+    }
 
+    static Result UpdateInternal(SoundSystem* sound)
+    {
+        DM_PROFILE(__FUNCTION__);
+        DM_MEMORY_TAG(dmMemory::TAG_SOUND);
         uint16_t active_instance_count;
         {
             DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
+            FlushCommands(sound);
             active_instance_count = sound->m_InstancesPool.Size();
         }
 
+        if (!sound->m_Device)
+        {
+            return RESULT_OK;
+        }
+
         bool currentIsAudioInterrupted = IsAudioInterrupted();
         if (!sound->m_IsAudioInterrupted && currentIsAudioInterrupted)
         {
@@ -1429,6 +2848,8 @@ namespace dmSound
 
         if (active_instance_count == 0)
         {
+            // The device runs dry, which isn't an underrun
+            sound->m_IsDeviceFed = false;
             #if defined(ANDROID)
             if (sound->m_IsDeviceStarted)
             {
@@ -1452,14 +2873,23 @@ namespace dmSound
         {
             sound->m_DeviceType->m_DeviceStart(sound->m_Device);
             sound->m_IsDeviceStarted = true;
+            sound->m_IsDeviceFed = false;
         }
 
+        UpdateStreams(sound);
+
         DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
+        FlushCommands(sound);
 
         uint32_t free_slots = sound->m_DeviceType->m_FreeBufferSlots(sound->m_Device);
+        if (sound->m_LowLatency) {
+            free_slots = GetLowLatencyFreeSlots(sound, free_slots);
+        }
         if (free_slots > 0) {
             StepGroupValues();
             StepInstanceValues();
+            UpdateSpatial(sound);
+            UpdateVoices(sound);
         }
 
         uint32_t current_buffer = 0;
@@ -1476,16 +2906,33 @@ namespace dmSound
             sound->m_DeviceType->m_Queue(sound->m_Device, (const int16_t*) sound->m_OutBuffers[sound->m_NextOutBuffer], sound->m_FrameCount);
 
             sound->m_NextOutBuffer = (sound->m_NextOutBuffer + 1) % SOUND_OUTBUFFER_COUNT;
+            sound->m_IsDeviceFed = true;
+            sound->m_FramesWithoutUnderrun += sound->m_FrameCount;
             current_buffer++;
             free_slots--;
         }
 
+        if (total_buffers > 0)
+        {
+            PublishGroupMemory(sound);
+        }
+
+        if (sound->m_JobThread)
+        {
+            ScheduleDecodeJobs(sound);
+        }
+
         return RESULT_OK;
     }
 
     static void SoundThread(void* ctx)
     {
         SoundSystem* sound = (SoundSystem*)ctx;
+        // With few buffers queued, the device is checked at least twice per buffer
+        uint32_t sleep_time = 8000;
+        if (sound->m_LowLatency)
+            sleep_time = dmMath::Min(sleep_time, (uint32_t) (sound->m_FrameCount * 500000ull / sound->m_MixRate));
+
         while (dmAtomicGet32(&sound->m_IsRunning))
         {
             Result result = RESULT_OK;
@@ -1493,7 +2940,7 @@ namespace dmSound
                 result = UpdateInternal(sound);
 
             dmAtomicStore32(&sound->m_Status, (int)result);
-            dmTime::Sleep(8000);
+            dmTime::Sleep(sleep_time);
         }
     }
 
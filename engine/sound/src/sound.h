@@ -17,6 +17,7 @@
 
 #include <dlib/configfile.h>
 #include <dlib/hash.h>
+#include <dlib/job_thread.h>
 
 #include <dmsdk/dlib/vmath.h>
 
@@ -29,6 +30,7 @@ namespace dmSound
     {
         SOUND_DATA_TYPE_WAV        = 0,
         SOUND_DATA_TYPE_OGG_VORBIS = 1,
+        SOUND_DATA_TYPE_OPUS       = 2,
     };
 
     enum Parameter
@@ -39,6 +41,42 @@ namespace dmSound
         PARAMETER_MAX   = 3
     };
 
+    // What happens to an audible instance that doesn't get a voice, when the voice limits are reached
+    enum VoiceStealMode
+    {
+        VOICE_STEAL_VIRTUALIZE = 0, // Keeps playing silently, and is mixed again once it gets a voice
+        VOICE_STEAL_STOP       = 1, // Is faded out and stopped
+    };
+
+    // How the gain of a spatial instance falls off with the distance to the listener, beyond its min distance
+    enum AttenuationModel
+    {
+        ATTENUATION_NONE    = 0, // Only panned and doppler shifted
+        ATTENUATION_INVERSE = 1, // min / (min + rolloff * (distance - min))
+        ATTENUATION_LINEAR  = 2, // 1 - rolloff * (distance - min) / (max - min)
+    };
+
+    struct SpatialParams
+    {
+        AttenuationModel m_Attenuation;
+        // Not attenuated closer than this
+        float m_MinDistance;
+        // Not attenuated further beyond this
+        float m_MaxDistance;
+        float m_Rolloff;
+        // Scales the velocities of the doppler shift. 0 disables it
+        float m_DopplerFactor;
+
+        SpatialParams()
+        : m_Attenuation(ATTENUATION_INVERSE)
+        , m_MinDistance(1.0f)
+        , m_MaxDistance(1000.0f)
+        , m_Rolloff(1.0f)
+        , m_DopplerFactor(1.0f)
+        {
+        }
+    };
+
     enum Result
     {
         RESULT_OK                 =  0,    //!< RESULT_OK
@@ -67,9 +105,6 @@ namespace dmSound
 
     const uint32_t MAX_GROUPS = 32;
 
-    // TODO:
-    // - Music streaming.
-
     struct InitializeParams;
     void SetDefaultInitializeParams(InitializeParams* params);
 
@@ -83,7 +118,20 @@ namespace dmSound
         uint32_t m_BufferSize;
         uint32_t m_FrameCount;
         uint32_t m_MaxInstances;
+        // Job workers that decode compressed sounds ahead of the mixer. If 0, or without workers, the mixer decodes
+        dmJobThread::HContext m_JobThread;
+        // Number of mix buffers decoded ahead per playing compressed sound instance
+        uint32_t m_DecodeLookahead;
+        // Max size of a compressed sound when decoded, to keep it decoded in memory instead. 0 disables it
+        uint32_t m_MaxDecodedSize;
+        // Total size of the decoded sounds kept in memory. Decoded sounds that aren't playing are evicted to make room
+        uint32_t m_DecodedCacheSize;
+        // Max number of instances mixed at the same time. 0 means no limit
+        uint32_t m_MaxVoices;
+        VoiceStealMode m_VoiceStealMode;
         bool     m_UseThread;
+        // Keeps as few buffers queued on the device as it can play without underruns, at the native burst size of the device
+        bool     m_LowLatency;
 
         InitializeParams()
         {
@@ -100,8 +148,15 @@ namespace dmSound
     // Pauses the (threaded) sound system
     Result Pause(bool pause);
 
+    // Reads size bytes of the encoded data of a streamed sound, starting at offset. Called from the sound thread
+    typedef Result (*FSoundDataGetData)(void* context, uint32_t offset, uint32_t size, void* out, uint32_t* out_size);
+
     // Thread safe
     Result NewSoundData(const void* sound_buffer, uint32_t sound_buffer_size, SoundDataType type, HSoundData* sound_data, dmhash_t name);
+    // Creates sound data that is read in chunks through the callback while playing, instead of being kept in memory.
+    // The callback context must stay valid until DeleteSoundData() has returned.
+    // Returns RESULT_UNSUPPORTED if the sound type can't be streamed on this platform
+    Result NewSoundDataStreaming(FSoundDataGetData cbk, void* cbk_ctx, uint32_t size, SoundDataType type, HSoundData* sound_data, dmhash_t name);
     Result SetSoundData(HSoundData sound_data, const void* sound_buffer, uint32_t sound_buffer_size);
     uint32_t GetSoundResourceSize(HSoundData sound_data);
     Result DeleteSoundData(HSoundData sound_data);
@@ -117,8 +172,16 @@ namespace dmSound
     Result GetGroupGain(dmhash_t group_hash, float* gain);
     Result GetGroupHashes(uint32_t* count, dmhash_t* buffer);
 
+    // Max number of instances in the group mixed at the same time. 0 means no limit
+    Result SetGroupVoiceLimit(dmhash_t group_hash, uint32_t max_voices);
+
     Result GetGroupRMS(dmhash_t group_hash, float window, float* rms_left, float* rms_right);
     Result GetGroupPeak(dmhash_t group_hash, float window, float* peak_left, float* peak_right);
+    // Memory used by the sound data the instances in the group play, including their decoded data.
+    // Sound data played in several groups is counted in each of them
+    Result GetGroupSoundDataSize(dmhash_t group_hash, uint32_t* size);
+    // Bytes used by the decoded sounds, and the budget set by sound.decoded_cache_size
+    void GetDecodedCacheSize(uint32_t* size, uint32_t* capacity);
 
     Result Play(HSoundInstance sound_instance);
     Result Stop(HSoundInstance sound_instance);
@@ -128,7 +191,24 @@ namespace dmSound
 
     Result SetLooping(HSoundInstance sound_instance, bool looping, int8_t loopcount);
 
+    // When there are more audible instances than voices, the ones with the highest priority, and then the highest gain, are mixed.
+    // The others are virtual, and only advance their playback. Default 128
+    Result SetPriority(HSoundInstance sound_instance, uint8_t priority);
+    // Number of playing instances that were mixed, and that were virtual, in the last update
+    void GetVoiceCounts(uint32_t* real_count, uint32_t* virtual_count);
+    // Time from mixing a sound until it's output, by the buffers kept queued on the device, in seconds
+    float GetLatency();
+
     Result SetParameter(HSoundInstance sound_instance, Parameter parameter, const dmVMath::Vector4& value);
+
+    // Makes the instance spatial: its gain, pan and speed are then also scaled by the attenuation, pan and doppler shift
+    // relative to the listener, computed for all spatial instances at once on each update of the mixer.
+    // Null params makes it non spatial again
+    Result SetSpatial(HSoundInstance sound_instance, const SpatialParams* params);
+    // World position and velocity (units per second) of a spatial instance
+    Result SetPosition(HSoundInstance sound_instance, const dmVMath::Point3& position, const dmVMath::Vector3& velocity);
+    // The listener of the spatial instances, usually the camera. Looks along -z, with +x to the right
+    void SetListener(const dmVMath::Point3& position, const dmVMath::Quat& rotation, const dmVMath::Vector3& velocity);
     Result GetParameter(HSoundInstance sound_instance, Parameter parameter, dmVMath::Vector4& value);
 
     // Platform dependent
@@ -150,11 +230,13 @@ namespace dmSound
      */
     struct OpenDeviceParams
     {
-        OpenDeviceParams() : m_BufferCount(0), m_FrameCount(0)
+        OpenDeviceParams() : m_BufferCount(0), m_FrameCount(0), m_LowLatency(false)
         {
         }
         uint32_t m_BufferCount;
         uint32_t m_FrameCount;
+        // The device should pick the output path with the lowest latency, and report its burst size
+        bool     m_LowLatency;
     };
 
     /**
@@ -162,7 +244,13 @@ namespace dmSound
      */
     struct DeviceInfo
     {
+        DeviceInfo() : m_MixRate(0), m_FrameCount(0)
+        {
+        }
         uint32_t m_MixRate;
+        // Native burst size of the device in low latency mode, in frames. 0 if unknown.
+        // The mixer then mixes in multiples of it, up to the frame count the device was opened with
+        uint32_t m_FrameCount;
     };
 
     /**
@@ -13,6 +13,7 @@
 // specific language governing permissions and limitations under the License.
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <dlib/array.h>
 #include <dlib/index_pool.h>
 #include <dlib/endian.h>
@@ -90,6 +91,37 @@ namespace dmSoundCodec
         return RESULT_OK;
     }
 
+    Result NewDecoder(HCodecContext context, Format format, const DataSource* source, HDecoder* decoder)
+    {
+        if (context->m_DecodersPool.Remaining() == 0) {
+            return RESULT_OUT_OF_RESOURCES;
+        }
+
+        const DecoderInfo* decoderImpl = FindBestSourceDecoder(format);
+        if (!decoderImpl) {
+            return RESULT_UNSUPPORTED;
+        }
+
+        uint16_t index = context->m_DecodersPool.Pop();
+        Decoder* d = &context->m_Decoders[index];
+        d->m_Index = index;
+        d->m_DecoderInfo = decoderImpl;
+
+        Result r = decoderImpl->m_OpenSourceStream(source, &d->m_Stream);
+        if (r != RESULT_OK) {
+            context->m_DecodersPool.Push(index);
+            return r;
+        }
+
+        *decoder = d;
+        return RESULT_OK;
+    }
+
+    bool IsDataSourceSupported(Format format)
+    {
+        return FindBestSourceDecoder(format) != 0;
+    }
+
     void GetInfo(HCodecContext context, HDecoder decoder, Info* info)
     {
         assert(decoder);
@@ -110,6 +142,61 @@ namespace dmSoundCodec
         return decoder->m_DecoderInfo->m_SkipInStream(decoder->m_Stream, bytes, skipped);
     }
 
+    Result DecodeToMemory(Format format, const void* buffer, uint32_t buffer_size, uint32_t header_size, uint32_t max_size, Info* info, char** out, uint32_t* out_size)
+    {
+        DM_PROFILE(__FUNCTION__);
+        const DecoderInfo* decoderImpl = FindBestDecoder(format);
+        if (!decoderImpl) {
+            return RESULT_UNSUPPORTED;
+        }
+
+        HDecodeStream stream;
+        Result r = decoderImpl->m_OpenStream(buffer, buffer_size, &stream);
+        if (r != RESULT_OK) {
+            return r;
+        }
+        decoderImpl->m_GetStreamInfo(stream, info);
+
+        // Decoded in chunks that are a multiple of any frame size
+        const uint32_t chunk_size = 64 * 1024;
+        uint32_t capacity = 0;
+        uint32_t size = 0;
+        char* data = 0;
+        while (r == RESULT_OK)
+        {
+            if (size == capacity)
+            {
+                // One chunk past max_size, to see if there's more data
+                if (size > max_size)
+                {
+                    r = RESULT_OUT_OF_RESOURCES;
+                    break;
+                }
+                capacity += dmMath::Max(capacity, chunk_size);
+                data = (char*) realloc(data, header_size + capacity);
+            }
+
+            uint32_t decoded = 0;
+            r = decoderImpl->m_DecodeStream(stream, data + header_size + size, dmMath::Min(chunk_size, capacity - size), &decoded);
+            if (decoded == 0)
+                break;
+            size += decoded;
+        }
+        decoderImpl->m_CloseStream(stream);
+
+        if (r == RESULT_OK && size > max_size)
+            r = RESULT_OUT_OF_RESOURCES;
+        if (r != RESULT_OK)
+        {
+            free(data);
+            return r;
+        }
+
+        *out = data;
+        *out_size = size;
+        return RESULT_OK;
+    }
+
     Result Reset(HCodecContext context, HDecoder decoder)
     {
         assert(decoder);
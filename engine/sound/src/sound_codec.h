@@ -45,6 +45,7 @@ namespace dmSoundCodec
     {
         FORMAT_WAV,   //!< FORMAT_WAV
         FORMAT_VORBIS,//!< FORMAT_VORBIS
+        FORMAT_OPUS,  //!< FORMAT_OPUS
     };
 
     /**
@@ -62,6 +63,20 @@ namespace dmSoundCodec
         uint8_t  m_BitsPerSample;
     };
 
+    /**
+     * Random access input for a decoder, for encoded data that isn't fully resident in memory
+     */
+    struct DataSource
+    {
+        /// Read up to size bytes at offset into buffer. Returns the number of bytes read,
+        /// which is less than size only at the end of the data or on error
+        uint32_t (*m_Read)(void* context, uint32_t offset, void* buffer, uint32_t size);
+        /// User context passed to m_Read
+        void*    m_Context;
+        /// Total size of the encoded data in bytes
+        uint32_t m_Size;
+    };
+
     /**
      * Parameters for new codec context
      */
@@ -100,6 +115,24 @@ namespace dmSoundCodec
      */
     Result NewDecoder(HCodecContext context, Format format, const void* buffer, uint32_t buffer_size, HDecoder* decoder);
 
+    /**
+     * Create a new decoder that reads the encoded data through a data source.
+     * The source is copied, but its context must outlive the decoder.
+     * @param context context
+     * @param format format
+     * @param source data source
+     * @param decoder decoder (out)
+     * @return RESULT_OK on success. RESULT_UNSUPPORTED if no decoder for the format can read from a data source
+     */
+    Result NewDecoder(HCodecContext context, Format format, const DataSource* source, HDecoder* decoder);
+
+    /**
+     * Check if there is a decoder for the format that can read from a data source
+     * @param format format
+     * @return true if supported
+     */
+    bool IsDataSourceSupported(Format format);
+
     /**
      * Delete decoder
      * @param context context
@@ -136,6 +169,20 @@ namespace dmSoundCodec
      */
     Result Skip(HCodecContext context, HDecoder decoder, uint32_t bytes, uint32_t* skipped);
 
+    /**
+     * Decode a whole stream in memory, without using a decoder of a context
+     * @param format format
+     * @param buffer encoded data
+     * @param buffer_size encoded data size
+     * @param header_size bytes to reserve at the start of the output, before the decoded data
+     * @param max_size max size in bytes of the decoded data
+     * @param info info of the stream (out)
+     * @param out the output, allocated with malloc (out)
+     * @param out_size size of the decoded data, not including the header (out)
+     * @return RESULT_OK on success. RESULT_OUT_OF_RESOURCES if the decoded data is larger than max_size
+     */
+    Result DecodeToMemory(Format format, const void* buffer, uint32_t buffer_size, uint32_t header_size, uint32_t max_size, Info* info, char** out, uint32_t* out_size);
+
     /**
      * Reset decoder
      * @param context context
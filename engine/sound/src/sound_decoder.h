@@ -82,6 +82,11 @@ namespace dmSoundCodec
          */
         int64_t (*m_GetInternalStreamPosition)(HDecodeStream);
 
+        /**
+         * Open a stream for decoding, reading the encoded data through a data source. Optional (may be 0)
+         */
+        Result (*m_OpenSourceStream)(const DataSource* source, HDecodeStream* out);
+
         DecoderInfo *m_Next;
     };
 
@@ -95,6 +100,24 @@ namespace dmSoundCodec
      */
     const DecoderInfo* FindBestDecoder(Format format);
 
+    /**
+     * Finds the best match among the registered decoders that can read from a data source.
+     * Returns 0 if there is none.
+     */
+    const DecoderInfo* FindBestSourceDecoder(Format format);
+
+    /**
+     * Read from a data source, clamped to the size of the source
+     */
+    static inline uint32_t ReadSource(const DataSource* source, uint32_t offset, void* buffer, uint32_t size)
+    {
+        if (offset >= source->m_Size)
+            return 0;
+        if (size > source->m_Size - offset)
+            size = source->m_Size - offset;
+        return source->m_Read(source->m_Context, offset, buffer, size);
+    }
+
     /**
      * Get by name of implementation
      */
@@ -112,7 +135,7 @@ namespace dmSoundCodec
     /**
      * Declare a new stream decoder
      */
-    #define DM_DECLARE_SOUND_DECODER(symbol, name, format, score, open, close, decode, reset, skip, getinfo, get_internal_pos) \
+    #define DM_DECLARE_SOUND_DECODER(symbol, name, format, score, open, close, decode, reset, skip, getinfo, get_internal_pos, open_source) \
             dmSoundCodec::DecoderInfo DM_SOUND_PASTE2(symbol, __LINE__) = { \
                     name, \
                     format, \
@@ -124,6 +147,7 @@ namespace dmSoundCodec
                     skip, \
                     getinfo, \
                     get_internal_pos, \
+                    open_source, \
             };\
         DM_REGISTER_SOUND_DECODER(symbol, DM_SOUND_PASTE2(symbol, __LINE__))
 }
@@ -0,0 +1,378 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "sound_mix.h"
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define DM_SOUND_MIX_SSE2
+    #include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    // The interleaving (zip) instructions are only available on AArch64 NEON
+    #define DM_SOUND_MIX_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace dmSound
+{
+#if defined(DM_SOUND_MIX_SSE2)
+    typedef __m128 Vec4f;
+    static inline Vec4f Load(const float* p)                { return _mm_loadu_ps(p); }
+    static inline void  Store(float* p, Vec4f v)            { _mm_storeu_ps(p, v); }
+    static inline Vec4f Splat(float f)                      { return _mm_set1_ps(f); }
+    static inline Vec4f Set(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)               { return _mm_add_ps(a, b); }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)               { return _mm_sub_ps(a, b); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)               { return _mm_mul_ps(a, b); }
+    static inline Vec4f Min(Vec4f a, Vec4f b)               { return _mm_min_ps(a, b); }
+    static inline Vec4f Max(Vec4f a, Vec4f b)               { return _mm_max_ps(a, b); }
+    static inline Vec4f Div(Vec4f a, Vec4f b)               { return _mm_div_ps(a, b); }
+    static inline Vec4f Sqrt(Vec4f a)                       { return _mm_sqrt_ps(a); }
+    // (a0 b0 a1 b1) and (a2 b2 a3 b3)
+    static inline Vec4f InterleaveLo(Vec4f a, Vec4f b)      { return _mm_unpacklo_ps(a, b); }
+    static inline Vec4f InterleaveHi(Vec4f a, Vec4f b)      { return _mm_unpackhi_ps(a, b); }
+#elif defined(DM_SOUND_MIX_NEON)
+    typedef float32x4_t Vec4f;
+    static inline Vec4f Load(const float* p)                { return vld1q_f32(p); }
+    static inline void  Store(float* p, Vec4f v)            { vst1q_f32(p, v); }
+    static inline Vec4f Splat(float f)                      { return vdupq_n_f32(f); }
+    static inline Vec4f Set(float a, float b, float c, float d) { float v[4] = {a, b, c, d}; return vld1q_f32(v); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)               { return vaddq_f32(a, b); }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)               { return vsubq_f32(a, b); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)               { return vmulq_f32(a, b); }
+    static inline Vec4f Min(Vec4f a, Vec4f b)               { return vminq_f32(a, b); }
+    static inline Vec4f Max(Vec4f a, Vec4f b)               { return vmaxq_f32(a, b); }
+    static inline Vec4f Div(Vec4f a, Vec4f b)               { return vdivq_f32(a, b); }
+    static inline Vec4f Sqrt(Vec4f a)                       { return vsqrtq_f32(a); }
+    static inline Vec4f InterleaveLo(Vec4f a, Vec4f b)      { return vzip1q_f32(a, b); }
+    static inline Vec4f InterleaveHi(Vec4f a, Vec4f b)      { return vzip2q_f32(a, b); }
+#else
+    struct Vec4f { float v[4]; };
+    static inline Vec4f Load(const float* p)                { Vec4f r; for (int i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+    static inline void  Store(float* p, Vec4f v)            { for (int i = 0; i < 4; ++i) p[i] = v.v[i]; }
+    static inline Vec4f Splat(float f)                      { Vec4f r; for (int i = 0; i < 4; ++i) r.v[i] = f; return r; }
+    static inline Vec4f Set(float a, float b, float c, float d) { Vec4f r = {{a, b, c, d}}; return r; }
+    static inline Vec4f Add(Vec4f a, Vec4f b)               { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)               { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)               { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+    static inline Vec4f Min(Vec4f a, Vec4f b)               { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+    static inline Vec4f Max(Vec4f a, Vec4f b)               { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return a; }
+    static inline Vec4f Div(Vec4f a, Vec4f b)               { for (int i = 0; i < 4; ++i) a.v[i] /= b.v[i]; return a; }
+    static inline Vec4f Sqrt(Vec4f a)                       { for (int i = 0; i < 4; ++i) a.v[i] = sqrtf(a.v[i]); return a; }
+    static inline Vec4f InterleaveLo(Vec4f a, Vec4f b)      { Vec4f r = {{a.v[0], b.v[0], a.v[1], b.v[1]}}; return r; }
+    static inline Vec4f InterleaveHi(Vec4f a, Vec4f b)      { Vec4f r = {{a.v[2], b.v[2], a.v[3], b.v[3]}}; return r; }
+#endif
+
+    static inline void GetPanScale(float pan, float* left_scale, float* right_scale)
+    {
+        // Constant power panning: https://www.cs.cmu.edu/~music/icm-online/readings/panlaws/index.html
+        const float theta = pan * M_PI_2;
+        *left_scale = cosf(theta);
+        *right_scale = sinf(theta);
+    }
+
+    // The ramp values of 4 lanes, for the sample indices in index. Same arithmetic as Ramp::GetValue
+    static inline Vec4f GetRampValues(const Ramp& ramp, Vec4f index)
+    {
+        return Add(Splat(ramp.m_From), Mul(Mul(index, Splat(ramp.m_TotalSamplesRecip)), Splat(ramp.m_To - ramp.m_From)));
+    }
+
+    // The pan scales of 4 frames, as (left0 left1 left2 left3) and (right0 right1 right2 right3)
+    // The cos/sin are only evaluated per frame while the pan changes
+    static inline void GetPanScales(const Ramp& pan, bool constant_pan, const Vec4f& constant_left, const Vec4f& constant_right, uint32_t i, Vec4f* left, Vec4f* right)
+    {
+        if (constant_pan)
+        {
+            *left = constant_left;
+            *right = constant_right;
+            return;
+        }
+        float l[4], r[4];
+        for (uint32_t j = 0; j < 4; ++j)
+        {
+            GetPanScale(pan.GetValue(i + j), &l[j], &r[j]);
+        }
+        *left = Load(l);
+        *right = Load(r);
+    }
+
+    void ConvertSamples(const int16_t* in, float* out, uint32_t count)
+    {
+        uint32_t i = 0;
+#if defined(DM_SOUND_MIX_SSE2)
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i s = _mm_loadu_si128((const __m128i*)(in + i));
+            // Sign extend to 32 bits by shifting down the duplicated halves
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+            _mm_storeu_ps(out + i, _mm_cvtepi32_ps(lo));
+            _mm_storeu_ps(out + i + 4, _mm_cvtepi32_ps(hi));
+        }
+#elif defined(DM_SOUND_MIX_NEON)
+        for (; i + 8 <= count; i += 8)
+        {
+            int16x8_t s = vld1q_s16(in + i);
+            vst1q_f32(out + i, vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))));
+            vst1q_f32(out + i + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            out[i] = in[i];
+        }
+    }
+
+    void ConvertSamples(const uint8_t* in, float* out, uint32_t count)
+    {
+        uint32_t i = 0;
+#if defined(DM_SOUND_MIX_SSE2) || defined(DM_SOUND_MIX_NEON)
+        const Vec4f offset = Splat(128.0f);
+        const Vec4f scale = Splat(255.0f);
+        for (; i + 16 <= count; i += 16)
+        {
+            Vec4f s[4];
+    #if defined(DM_SOUND_MIX_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            __m128i b = _mm_loadu_si128((const __m128i*)(in + i));
+            __m128i lo = _mm_unpacklo_epi8(b, zero);
+            __m128i hi = _mm_unpackhi_epi8(b, zero);
+            s[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+            s[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+            s[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+            s[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+    #else
+            uint8x16_t b = vld1q_u8(in + i);
+            uint16x8_t lo = vmovl_u8(vget_low_u8(b));
+            uint16x8_t hi = vmovl_u8(vget_high_u8(b));
+            s[0] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo)));
+            s[1] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo)));
+            s[2] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi)));
+            s[3] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi)));
+    #endif
+            for (uint32_t j = 0; j < 4; ++j)
+            {
+                Store(out + i + j * 4, Mul(Sub(s[j], offset), scale));
+            }
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            float s = in[i];
+            out[i] = (s - 128) * 255;
+        }
+    }
+
+    void MixMono(float* mix_buffer, const float* samples, uint32_t start, uint32_t count, const Ramp& gain, const Ramp& pan)
+    {
+        bool constant_pan = pan.m_From == pan.m_To;
+        float left_scale, right_scale;
+        GetPanScale(pan.m_From, &left_scale, &right_scale);
+        const Vec4f constant_left = Splat(left_scale);
+        const Vec4f constant_right = Splat(right_scale);
+
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            float index = (float)(start + i);
+            Vec4f g = GetRampValues(gain, Set(index, index + 1, index + 2, index + 3));
+            Vec4f left, right;
+            GetPanScales(pan, constant_pan, constant_left, constant_right, start + i, &left, &right);
+
+            Vec4f s = Mul(Load(samples + i), g);
+            left = Mul(s, left);
+            right = Mul(s, right);
+            float* out = mix_buffer + 2 * i;
+            Store(out, Add(Load(out), InterleaveLo(left, right)));
+            Store(out + 4, Add(Load(out + 4), InterleaveHi(left, right)));
+        }
+
+        for (; i < count; ++i)
+        {
+            float g = gain.GetValue(start + i);
+            if (!constant_pan)
+                GetPanScale(pan.GetValue(start + i), &left_scale, &right_scale);
+            float s = samples[i];
+            mix_buffer[2 * i]     += s * g * left_scale;
+            mix_buffer[2 * i + 1] += s * g * right_scale;
+        }
+    }
+
+    void MixStereo(float* mix_buffer, const float* samples, uint32_t start, uint32_t count, const Ramp& gain, const Ramp& pan)
+    {
+        bool constant_pan = pan.m_From == pan.m_To;
+        float left_scale, right_scale;
+        GetPanScale(pan.m_From, &left_scale, &right_scale);
+        const Vec4f constant_left = Splat(left_scale);
+        const Vec4f constant_right = Splat(right_scale);
+
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            float index = (float)(start + i);
+            Vec4f g_lo = GetRampValues(gain, Set(index, index, index + 1, index + 1));
+            Vec4f g_hi = GetRampValues(gain, Set(index + 2, index + 2, index + 3, index + 3));
+            Vec4f left, right;
+            GetPanScales(pan, constant_pan, constant_left, constant_right, start + i, &left, &right);
+
+            float* out = mix_buffer + 2 * i;
+            const float* in = samples + 2 * i;
+            Store(out, Add(Load(out), Mul(Mul(Load(in), g_lo), InterleaveLo(left, right))));
+            Store(out + 4, Add(Load(out + 4), Mul(Mul(Load(in + 4), g_hi), InterleaveHi(left, right))));
+        }
+
+        for (; i < count; ++i)
+        {
+            float g = gain.GetValue(start + i);
+            if (!constant_pan)
+                GetPanScale(pan.GetValue(start + i), &left_scale, &right_scale);
+            mix_buffer[2 * i]     += samples[2 * i] * g * left_scale;
+            mix_buffer[2 * i + 1] += samples[2 * i + 1] * g * right_scale;
+        }
+    }
+
+    void MixGroup(float* mix_buffer, const float* group_buffer, uint32_t count, const Ramp& gain)
+    {
+        const Vec4f zero = Splat(0.0f);
+        const Vec4f one = Splat(1.0f);
+
+        uint32_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            float index = (float)i;
+            Vec4f g = Min(Max(GetRampValues(gain, Set(index, index, index + 1, index + 1)), zero), one);
+            Store(mix_buffer + 2 * i, Add(Load(mix_buffer + 2 * i), Mul(Load(group_buffer + 2 * i), g)));
+        }
+
+        for (; i < count; ++i)
+        {
+            float g = gain.GetValue(i);
+            g = g < 0.0f ? 0.0f : (g > 1.0f ? 1.0f : g);
+            mix_buffer[2 * i]     += group_buffer[2 * i] * g;
+            mix_buffer[2 * i + 1] += group_buffer[2 * i + 1] * g;
+        }
+    }
+
+    void MixMaster(const float* mix_buffer, int16_t* out, uint32_t count, const Ramp& gain)
+    {
+        uint32_t i = 0;
+#if defined(DM_SOUND_MIX_SSE2) || defined(DM_SOUND_MIX_NEON)
+        const Vec4f min_value = Splat(-32768.0f);
+        const Vec4f max_value = Splat(32767.0f);
+        for (; i + 4 <= count; i += 4)
+        {
+            float index = (float)i;
+            Vec4f g_lo = GetRampValues(gain, Set(index, index, index + 1, index + 1));
+            Vec4f g_hi = GetRampValues(gain, Set(index + 2, index + 2, index + 3, index + 3));
+            Vec4f s_lo = Max(min_value, Min(max_value, Mul(Load(mix_buffer + 2 * i), g_lo)));
+            Vec4f s_hi = Max(min_value, Min(max_value, Mul(Load(mix_buffer + 2 * i + 4), g_hi)));
+            // Truncated like the cast to int16_t. The samples are already clamped to the range
+    #if defined(DM_SOUND_MIX_SSE2)
+            __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(s_lo), _mm_cvttps_epi32(s_hi));
+            _mm_storeu_si128((__m128i*)(out + 2 * i), packed);
+    #else
+            int16x8_t packed = vcombine_s16(vqmovn_s32(vcvtq_s32_f32(s_lo)), vqmovn_s32(vcvtq_s32_f32(s_hi)));
+            vst1q_s16(out + 2 * i, packed);
+    #endif
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            float g = gain.GetValue(i);
+            float s1 = mix_buffer[2 * i] * g;
+            float s2 = mix_buffer[2 * i + 1] * g;
+            s1 = s1 < 32767.0f ? s1 : 32767.0f;
+            s1 = s1 > -32768.0f ? s1 : -32768.0f;
+            s2 = s2 < 32767.0f ? s2 : 32767.0f;
+            s2 = s2 > -32768.0f ? s2 : -32768.0f;
+            out[2 * i] = (int16_t) s1;
+            out[2 * i + 1] = (int16_t) s2;
+        }
+    }
+
+    // Spatializes the 4 sources at the stream pointers s
+    static inline void Spatialize4(const SpatialListener& listener, float* const* s)
+    {
+        const Vec4f zero = Splat(0.0f);
+        const Vec4f half = Splat(0.5f);
+        const Vec4f one = Splat(1.0f);
+        // Below this distance, the direction to the source is too uncertain, and it isn't panned fully
+        const Vec4f min_direction_distance = Splat(0.001f);
+        // Keeps the doppler shift in the range [1/3, 3] at a doppler factor of 1
+        const Vec4f max_velocity = Splat(SPATIAL_SPEED_OF_SOUND * 0.5f);
+        const Vec4f min_velocity = Splat(SPATIAL_SPEED_OF_SOUND * -0.5f);
+        const Vec4f speed_of_sound = Splat(SPATIAL_SPEED_OF_SOUND);
+
+        Vec4f dx = Sub(Load(s[SPATIAL_POSITION_X]), Splat(listener.m_Position[0]));
+        Vec4f dy = Sub(Load(s[SPATIAL_POSITION_Y]), Splat(listener.m_Position[1]));
+        Vec4f dz = Sub(Load(s[SPATIAL_POSITION_Z]), Splat(listener.m_Position[2]));
+        Vec4f distance = Sqrt(Add(Add(Mul(dx, dx), Mul(dy, dy)), Mul(dz, dz)));
+        Vec4f inv_distance = Div(one, Max(distance, min_direction_distance));
+
+        Vec4f min_distance = Load(s[SPATIAL_MIN_DISTANCE]);
+        Vec4f d = Sub(Min(Max(distance, min_distance), Load(s[SPATIAL_MAX_DISTANCE])), min_distance);
+        Vec4f gain = Div(Sub(one, Mul(Load(s[SPATIAL_ATTENUATION_A]), d)), Add(one, Mul(Load(s[SPATIAL_ATTENUATION_B]), d)));
+        Store(s[SPATIAL_GAIN], Min(one, Max(zero, gain)));
+
+        // The sideways part of the direction to the source
+        Vec4f side = Add(Add(Mul(dx, Splat(listener.m_Right[0])), Mul(dy, Splat(listener.m_Right[1]))), Mul(dz, Splat(listener.m_Right[2])));
+        Vec4f pan = Add(half, Mul(half, Mul(side, inv_distance)));
+        Store(s[SPATIAL_PAN], Min(one, Max(zero, pan)));
+
+        // The velocities towards the source, of the listener and the source
+        Vec4f doppler_factor = Mul(Load(s[SPATIAL_DOPPLER_FACTOR]), inv_distance);
+        Vec4f vl = Add(Add(Mul(dx, Splat(listener.m_Velocity[0])), Mul(dy, Splat(listener.m_Velocity[1]))), Mul(dz, Splat(listener.m_Velocity[2])));
+        Vec4f vs = Add(Add(Mul(dx, Load(s[SPATIAL_VELOCITY_X])), Mul(dy, Load(s[SPATIAL_VELOCITY_Y]))), Mul(dz, Load(s[SPATIAL_VELOCITY_Z])));
+        vl = Min(max_velocity, Max(min_velocity, Mul(vl, doppler_factor)));
+        vs = Min(max_velocity, Max(min_velocity, Mul(vs, doppler_factor)));
+        Store(s[SPATIAL_DOPPLER], Div(Add(speed_of_sound, vl), Add(speed_of_sound, vs)));
+    }
+
+    void Spatialize(const SpatialListener& listener, float* streams, uint32_t stride, uint32_t count)
+    {
+        float* s[SPATIAL_STREAM_COUNT];
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            for (uint32_t j = 0; j < SPATIAL_STREAM_COUNT; ++j)
+            {
+                s[j] = streams + j * stride + i;
+            }
+            Spatialize4(listener, s);
+        }
+
+        if (i < count)
+        {
+            // The last sources are copied to a block of 4, padded with zeros, so they get the same arithmetic
+            float tail[SPATIAL_STREAM_COUNT][4] = {};
+            const uint32_t n = count - i;
+            for (uint32_t j = 0; j < SPATIAL_STREAM_COUNT; ++j)
+            {
+                for (uint32_t k = 0; k < n; ++k)
+                {
+                    tail[j][k] = streams[j * stride + i + k];
+                }
+                s[j] = tail[j];
+            }
+            Spatialize4(listener, s);
+            for (uint32_t j = SPATIAL_GAIN; j < SPATIAL_STREAM_COUNT; ++j)
+            {
+                for (uint32_t k = 0; k < n; ++k)
+                {
+                    streams[j * stride + i + k] = tail[j][k];
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,128 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_SOUND_MIX_H
+#define DM_SOUND_MIX_H
+
+#include <stdint.h>
+
+namespace dmSound
+{
+    // Max number of frames converted to float at a time by the mixers, before being mixed with the kernels below
+    const uint32_t MIX_BLOCK_SIZE = 256;
+
+    /**
+     * A value linearly "ramped" over a mix buffer, from the value of the previous buffer to the current
+     */
+    struct Ramp
+    {
+        float m_From, m_To, m_TotalSamplesRecip;
+
+        Ramp(float prev, float current, uint32_t buffer, uint32_t total_buffers, uint32_t total_samples)
+        {
+            float ramp_length = (current - prev) / total_buffers;
+            m_From = prev + ramp_length * buffer;
+            m_To = m_From + ramp_length;
+            m_TotalSamplesRecip = 1.0f / total_samples;
+        }
+
+        inline float GetValue(int i) const
+        {
+            float mix = i * m_TotalSamplesRecip;
+            return m_From + mix * (m_To - m_From);
+        }
+    };
+
+    /*
+     * The kernels use SSE2 or NEON where available, and plain loops otherwise. They give the same results
+     * as the scalar code, apart from the rounding of fused multiply-adds on some compilers.
+     * The buffers don't need to be aligned.
+     */
+
+    /**
+     * Converts samples to float, as (s - offset) * scale
+     */
+    void ConvertSamples(const int16_t* in, float* out, uint32_t count);
+    void ConvertSamples(const uint8_t* in, float* out, uint32_t count);
+
+    /**
+     * Adds mono samples to the interleaved stereo mix buffer, with the gain and constant power pan applied
+     * @param mix_buffer frames of the mix buffer, starting at frame start
+     * @param samples the samples to mix
+     * @param start index of the first frame in the ramps
+     * @param count number of frames
+     * @param gain gain ramp, over the whole mix buffer
+     * @param pan pan ramp, in the range [0,1]
+     */
+    void MixMono(float* mix_buffer, const float* samples, uint32_t start, uint32_t count, const Ramp& gain, const Ramp& pan);
+
+    /**
+     * Adds interleaved stereo samples to the interleaved stereo mix buffer. See MixMono
+     */
+    void MixStereo(float* mix_buffer, const float* samples, uint32_t start, uint32_t count, const Ramp& gain, const Ramp& pan);
+
+    /**
+     * Adds a group mix buffer to the master mix buffer, with the gain clamped to [0,1]
+     */
+    void MixGroup(float* mix_buffer, const float* group_buffer, uint32_t count, const Ramp& gain);
+
+    /**
+     * Applies the master gain to the interleaved stereo mix buffer, and converts it to clipped 16 bit samples
+     */
+    void MixMaster(const float* mix_buffer, int16_t* out, uint32_t count, const Ramp& gain);
+
+    // Speed of sound for the doppler shift, in world units per second
+    const float SPATIAL_SPEED_OF_SOUND = 343.3f;
+
+    /**
+     * The per source data of Spatialize(), as streams of floats (structure of arrays)
+     */
+    enum SpatialStream
+    {
+        SPATIAL_POSITION_X,
+        SPATIAL_POSITION_Y,
+        SPATIAL_POSITION_Z,
+        SPATIAL_VELOCITY_X,
+        SPATIAL_VELOCITY_Y,
+        SPATIAL_VELOCITY_Z,
+        SPATIAL_MIN_DISTANCE,
+        SPATIAL_MAX_DISTANCE,
+        // The attenuation is (1 - a * d) / (1 + b * d), for the distance d beyond the min distance
+        SPATIAL_ATTENUATION_A,
+        SPATIAL_ATTENUATION_B,
+        SPATIAL_DOPPLER_FACTOR,
+        // Output
+        SPATIAL_GAIN,
+        SPATIAL_PAN,
+        SPATIAL_DOPPLER,
+        SPATIAL_STREAM_COUNT
+    };
+
+    struct SpatialListener
+    {
+        float m_Position[3];
+        // Unit vector to the right of the listener
+        float m_Right[3];
+        float m_Velocity[3];
+    };
+
+    /**
+     * Computes the distance attenuation, pan in the range [0,1] and doppler shift (speed factor) of the sources
+     * @param streams SPATIAL_STREAM_COUNT streams of stride floats, indexed by SpatialStream
+     * @param count number of sources
+     */
+    void Spatialize(const SpatialListener& listener, float* streams, uint32_t stride, uint32_t count);
+}
+
+#endif // DM_SOUND_MIX_H
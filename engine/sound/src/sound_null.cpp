@@ -73,6 +73,11 @@ namespace dmSound
         return result;
     }
 
+    Result NewSoundDataStreaming(FSoundDataGetData cbk, void* cbk_ctx, uint32_t size, SoundDataType type, HSoundData* sound_data, dmhash_t name)
+    {
+        return RESULT_UNSUPPORTED;
+    }
+
     Result SetSoundData(HSoundData sound_data, const void* sound_buffer, uint32_t sound_buffer_size)
     {
         if (sound_data->m_Buffer != 0x0)
@@ -154,6 +159,13 @@ namespace dmSound
         return RESULT_OK;
     }
 
+    Result SetGroupVoiceLimit(dmhash_t group_hash, uint32_t max_voices)
+    {
+        // NOTE: Not supported.
+        // sound_null is deprecated and should be replaced by sound2 with null-device
+        return RESULT_OK;
+    }
+
     Result GetGroupGain(dmhash_t group_hash, float* gain)
     {
         // NOTE: Not supported.
@@ -222,6 +234,34 @@ namespace dmSound
         return RESULT_OK;
     }
 
+    Result SetPriority(HSoundInstance sound_instance, uint8_t priority)
+    {
+        return RESULT_OK;
+    }
+
+    void GetVoiceCounts(uint32_t* real_count, uint32_t* virtual_count)
+    {
+        *real_count = 0;
+        *virtual_count = 0;
+    }
+
+    float GetLatency()
+    {
+        return 0.0f;
+    }
+
+    Result GetGroupSoundDataSize(dmhash_t group_hash, uint32_t* size)
+    {
+        *size = 0;
+        return RESULT_OK;
+    }
+
+    void GetDecodedCacheSize(uint32_t* size, uint32_t* capacity)
+    {
+        *size = 0;
+        *capacity = 0;
+    }
+
     Result SetParameter(HSoundInstance sound_instance, Parameter parameter, const Vector4& value)
     {
         sound_instance->m_Parameters[parameter] = value;
@@ -234,6 +274,20 @@ namespace dmSound
         return RESULT_OK;
     }
 
+    Result SetSpatial(HSoundInstance sound_instance, const SpatialParams* params)
+    {
+        return RESULT_OK;
+    }
+
+    Result SetPosition(HSoundInstance sound_instance, const Point3& position, const Vector3& velocity)
+    {
+        return RESULT_OK;
+    }
+
+    void SetListener(const Point3& position, const Quat& rotation, const Vector3& velocity)
+    {
+    }
+
     bool IsMusicPlaying()
     {
         return false;
@@ -0,0 +1,158 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdlib.h>
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+#include <dlib/array.h>
+#include <dlib/benchmark.h>
+#include <dlib/hash.h>
+#include "../sound.h"
+
+#define DEF_EMBED(x) \
+    extern unsigned char x[]; \
+    extern uint32_t x##_SIZE;
+
+DEF_EMBED(DRUMLOOP_WAV)
+DEF_EMBED(OSC2_SIN_440HZ_WAV)
+DEF_EMBED(AMBIENCE_OGG)
+DEF_EMBED(MUSIC_OGG)
+
+#undef DEF_EMBED
+
+static const uint32_t BENCH_FRAME_COUNT = 2048;
+
+// A device that accepts one buffer per update and throws the mixed output away,
+// so that dmSound::Update() only measures decoding and mixing
+static dmSound::Result DeviceBenchOpen(const dmSound::OpenDeviceParams* params, dmSound::HDevice* device)
+{
+    *device = (dmSound::HDevice) 1;
+    return dmSound::RESULT_OK;
+}
+
+static void DeviceBenchClose(dmSound::HDevice device)
+{
+}
+
+static dmSound::Result DeviceBenchQueue(dmSound::HDevice device, const int16_t* samples, uint32_t sample_count)
+{
+    return dmSound::RESULT_OK;
+}
+
+static uint32_t DeviceBenchFreeBufferSlots(dmSound::HDevice device)
+{
+    return 1;
+}
+
+static void DeviceBenchDeviceInfo(dmSound::HDevice device, dmSound::DeviceInfo* info)
+{
+    info->m_MixRate = 44100;
+}
+
+static void DeviceBenchRestart(dmSound::HDevice device)
+{
+}
+
+static void DeviceBenchStop(dmSound::HDevice device)
+{
+}
+
+class dmSoundBench : public jc_test_base_class
+{
+public:
+    virtual void SetUp()
+    {
+        dmSound::InitializeParams params;
+        params.m_MaxBuffers = 32;
+        params.m_MaxSources = 32;
+        params.m_MaxInstances = 64;
+        params.m_OutputDevice = "bench";
+        params.m_FrameCount = BENCH_FRAME_COUNT;
+        params.m_UseThread = false;
+
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::Initialize(0, &params));
+    }
+
+    virtual void TearDown()
+    {
+        for (uint32_t i = 0; i < m_Instances.Size(); ++i)
+            dmSound::DeleteSoundInstance(m_Instances[i]);
+        for (uint32_t i = 0; i < m_SoundData.Size(); ++i)
+            dmSound::DeleteSoundData(m_SoundData[i]);
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+    }
+
+    void PlayLooping(const void* sound, uint32_t sound_size, dmSound::SoundDataType type, uint32_t count)
+    {
+        dmSound::HSoundData sd = 0;
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundData(sound, sound_size, type, &sd, dmHashBuffer64(&sound, sizeof(sound))));
+        m_SoundData.OffsetCapacity(1);
+        m_SoundData.Push(sd);
+
+        m_Instances.OffsetCapacity(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            dmSound::HSoundInstance instance = 0;
+            ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(sd, &instance));
+            dmSound::SetLooping(instance, true, -1);
+            ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(instance));
+            m_Instances.Push(instance);
+        }
+    }
+
+    dmArray<dmSound::HSoundData>     m_SoundData;
+    dmArray<dmSound::HSoundInstance> m_Instances;
+};
+
+TEST_F(dmSoundBench, MixWav)
+{
+    PlayLooping(DRUMLOOP_WAV, DRUMLOOP_WAV_SIZE, dmSound::SOUND_DATA_TYPE_WAV, 16);
+    PlayLooping(OSC2_SIN_440HZ_WAV, OSC2_SIN_440HZ_WAV_SIZE, dmSound::SOUND_DATA_TYPE_WAV, 16);
+
+    const uint32_t updates = 16;
+    for (dmBenchmark::Run run("sound.mix_wav_32", 20, updates * BENCH_FRAME_COUNT); run.Next(); )
+    {
+        for (uint32_t i = 0; i < updates; ++i)
+            dmSound::Update();
+    }
+}
+
+TEST_F(dmSoundBench, MixOgg)
+{
+    PlayLooping(AMBIENCE_OGG, AMBIENCE_OGG_SIZE, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, 4);
+    PlayLooping(MUSIC_OGG, MUSIC_OGG_SIZE, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, 4);
+
+    const uint32_t updates = 16;
+    for (dmBenchmark::Run run("sound.mix_ogg_8", 20, updates * BENCH_FRAME_COUNT); run.Next(); )
+    {
+        for (uint32_t i = 0; i < updates; ++i)
+            dmSound::Update();
+    }
+}
+
+DM_DECLARE_SOUND_DEVICE(BenchDevice, "bench", DeviceBenchOpen, DeviceBenchClose, DeviceBenchQueue, DeviceBenchFreeBufferSlots, DeviceBenchDeviceInfo, DeviceBenchRestart, DeviceBenchStop);
+
+extern "C" void dmExportedSymbols();
+
+int main(int argc, char **argv)
+{
+    dmExportedSymbols();
+    BenchDevice();
+
+    jc_test_init(&argc, argv);
+    int ret = jc_test_run_all();
+    if (ret == 0)
+        ret = dmBenchmark::Report(argc, argv, "sound");
+    return ret;
+}
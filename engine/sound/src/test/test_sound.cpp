@@ -24,9 +24,11 @@
 #include <dlib/log.h>
 #include <dlib/time.h>
 #include <dlib/math.h>
+#include <dlib/job_thread.h>
 #include "../sound.h"
 #include "../sound_private.h"
 #include "../sound_codec.h"
+#include "../sound_mix.h"
 #include "../stb_vorbis/stb_vorbis.h"
 
 #include "test/mono_tone_440_22050_44100.wav.embed.h"
@@ -36,6 +38,7 @@
 #include "test/mono_tone_440_44000_88000.wav.embed.h"
 #include "test/mono_tone_2000_44000_88000.wav.embed.h"
 #include "test/mono_tone_440_44100_88200.wav.embed.h"
+#include "test/mono_tone_440_48000_96000.wav.embed.h"
 #include "test/mono_tone_2000_44100_88200.wav.embed.h"
 
 #include "test/stereo_tone_440_22050_44100.wav.embed.h"
@@ -53,6 +56,9 @@
 
 #include "test/mono_dc_44100_88200.wav.embed.h"
 
+#include "test/mono_adpcm_tone_440_44100_88200.wav.embed.h"
+#include "test/stereo_adpcm_tone_440_44100_88200.wav.embed.h"
+
 #include "test/def2938.wav.embed.h"
 
 extern unsigned char CLICK_TRACK_OGG[];
@@ -295,6 +301,10 @@ class dmSoundMixerTest : public dmSoundTest2
 {
 };
 
+class dmSoundCommandTest : public dmSoundTest2
+{
+};
+
 // Some arbitrary process "time" for loopback-device buffers
 #define LOOPBACK_DEVICE_PROCESS_TIME (4)
 
@@ -546,6 +556,72 @@ TEST_P(dmSoundVerifyTest, Mix)
 }
 #endif
 
+struct StreamContext
+{
+    const uint8_t* m_Data;
+    uint32_t       m_Size;
+    uint32_t       m_ReadCount;
+    uint32_t       m_MaxReadSize;
+};
+
+static dmSound::Result StreamGetData(void* _ctx, uint32_t offset, uint32_t size, void* out, uint32_t* out_size)
+{
+    StreamContext* ctx = (StreamContext*) _ctx;
+    if (offset > ctx->m_Size)
+        return dmSound::RESULT_INVALID_STREAM_DATA;
+    size = dmMath::Min(size, ctx->m_Size - offset);
+    memcpy(out, ctx->m_Data + offset, size);
+    *out_size = size;
+    ctx->m_ReadCount++;
+    ctx->m_MaxReadSize = dmMath::Max(ctx->m_MaxReadSize, size);
+    return dmSound::RESULT_OK;
+}
+
+static void PlayToEnd(dmSound::HSoundData sd)
+{
+    dmSound::HSoundInstance instance = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(sd, &instance));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(instance));
+    do {
+        dmSound::Update();
+    } while (dmSound::IsPlaying(instance));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(instance));
+}
+
+#if !defined(GITHUB_CI) || (defined(GITHUB_CI) && !(defined(WIN32) || defined(__MACH__)))
+TEST_P(dmSoundVerifyTest, MixStreamed)
+{
+    TestParams params = GetParam();
+    dmSound::HSoundData sd = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundData(params.m_Sound, params.m_SoundSize, params.m_Type, &sd, 1234));
+    PlayToEnd(sd);
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd));
+
+    std::vector<int16_t> expected(g_LoopbackDevice->m_AllOutput.Begin(), g_LoopbackDevice->m_AllOutput.End());
+    g_LoopbackDevice->m_AllOutput.SetSize(0);
+
+    StreamContext ctx = { (const uint8_t*) params.m_Sound, params.m_SoundSize, 0, 0 };
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundDataStreaming(StreamGetData, &ctx, params.m_SoundSize, params.m_Type, &sd, 1234));
+    // Only a few chunks of the data are kept in memory
+    if (params.m_SoundSize > 128 * 1024)
+    {
+        ASSERT_GT(params.m_SoundSize, dmSound::GetSoundResourceSize(sd));
+    }
+    PlayToEnd(sd);
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd));
+
+    ASSERT_LT(0u, ctx.m_ReadCount);
+    ASSERT_GE(16u * 1024u, ctx.m_MaxReadSize);
+
+    // The first buffer differs, since the master gain only ramps up for the first sound played
+    ASSERT_EQ(expected.size(), (size_t) g_LoopbackDevice->m_AllOutput.Size());
+    for (uint32_t i = params.m_BufferFrameCount * 2; i < expected.size(); ++i)
+    {
+        ASSERT_EQ(expected[i], g_LoopbackDevice->m_AllOutput[i]);
+    }
+}
+#endif
+
 TEST_P(dmSoundVerifyTest, EarlyBailOnNoSoundInstances)
 {
     ASSERT_EQ(dmSound::RESULT_NOTHING_TO_PLAY, dmSound::Update());
@@ -578,6 +654,15 @@ TestParams("loopback",
             440,
             22050,
             44100,
+            2048),
+// Higher rate than the mix rate, as Opus sounds
+TestParams("loopback",
+            MONO_TONE_440_48000_96000_WAV,
+            MONO_TONE_440_48000_96000_WAV_SIZE,
+            dmSound::SOUND_DATA_TYPE_WAV,
+            440,
+            48000,
+            96000,
             2048)};
 
 /*
@@ -1610,6 +1695,667 @@ const TestParams2 params_mixer_test[] = {
 INSTANTIATE_TEST_CASE_P(dmSoundMixerTest, dmSoundMixerTest, jc_test_values_in(params_mixer_test));
 #endif
 
+TEST_P(dmSoundCommandTest, QueuedCommands)
+{
+    TestParams2 params = GetParam();
+    dmSound::Result r;
+    dmSound::HSoundData sd = 0;
+    dmSound::NewSoundData(params.m_Sound1, params.m_SoundSize1, params.m_Type1, &sd, 1234);
+
+    dmSound::HSoundInstance instance = 0;
+    r = dmSound::NewSoundInstance(sd, &instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    // The state is the requested one, until the mixer has applied the commands
+    ASSERT_FALSE(dmSound::IsPlaying(instance));
+    dmSound::Play(instance);
+    ASSERT_TRUE(dmSound::IsPlaying(instance));
+    dmSound::Pause(instance, true);
+    ASSERT_FALSE(dmSound::IsPlaying(instance));
+    dmSound::Pause(instance, false);
+    ASSERT_TRUE(dmSound::IsPlaying(instance));
+    dmSound::Stop(instance);
+    ASSERT_FALSE(dmSound::IsPlaying(instance));
+
+    r = dmSound::SetGroupGain(dmHashString64("master"), 0.5f);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    float gain = 0.0f;
+    r = dmSound::GetGroupGain(dmHashString64("master"), &gain);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    ASSERT_EQ(0.5f, gain);
+
+    // More commands than fit in the queue
+    for (uint32_t i = 0; i < 5000; ++i)
+    {
+        r = dmSound::SetParameter(instance, dmSound::PARAMETER_GAIN, dmVMath::Vector4(i / 5000.0f, 0, 0, 0));
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+    dmSound::Play(instance);
+    ASSERT_TRUE(dmSound::IsPlaying(instance));
+
+    do {
+        r = dmSound::Update();
+        if (!params.m_UseThread)
+        {
+            ASSERT_EQ(dmSound::RESULT_OK, r);
+        }
+        dmTime::Sleep(1);
+    } while (dmSound::IsPlaying(instance));
+
+    ASSERT_LT(0u, g_LoopbackDevice->m_AllOutput.Size());
+
+    r = dmSound::DeleteSoundInstance(instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    r = dmSound::DeleteSoundData(sd);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+}
+
+const TestParams2 params_command_test[] = {
+    TestParams2("loopback",
+                MONO_TONE_440_22050_44100_WAV,
+                MONO_TONE_440_22050_44100_WAV_SIZE,
+                dmSound::SOUND_DATA_TYPE_WAV,
+                440,
+                22050,
+                44100,
+                1.0f,
+                false,
+
+                MONO_TONE_440_22050_44100_WAV,
+                MONO_TONE_440_22050_44100_WAV_SIZE,
+                dmSound::SOUND_DATA_TYPE_WAV,
+                440,
+                22050,
+                44100,
+                1.0f,
+                false,
+
+                2048,
+                false),
+
+    // Threaded
+    TestParams2("loopback",
+                MONO_TONE_440_22050_44100_WAV,
+                MONO_TONE_440_22050_44100_WAV_SIZE,
+                dmSound::SOUND_DATA_TYPE_WAV,
+                440,
+                22050,
+                44100,
+                1.0f,
+                false,
+
+                MONO_TONE_440_22050_44100_WAV,
+                MONO_TONE_440_22050_44100_WAV_SIZE,
+                dmSound::SOUND_DATA_TYPE_WAV,
+                440,
+                22050,
+                44100,
+                1.0f,
+                false,
+
+                2048,
+                true),
+};
+INSTANTIATE_TEST_CASE_P(dmSoundCommandTest, dmSoundCommandTest, jc_test_values_in(params_command_test));
+
+// Plays the sound to the end, and returns the mixed output
+static void RenderSound(const void* sound, uint32_t sound_size, dmSound::SoundDataType type, dmJobThread::HContext job_thread, uint32_t max_decoded_size, dmArray<int16_t>& output)
+{
+    dmSound::InitializeParams params;
+    params.m_MaxBuffers = MAX_BUFFERS;
+    params.m_MaxSources = MAX_SOURCES;
+    params.m_OutputDevice = "loopback";
+    params.m_FrameCount = 2048;
+    params.m_UseThread = false;
+    params.m_JobThread = job_thread;
+    params.m_MaxDecodedSize = max_decoded_size;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Initialize(0, &params));
+
+    dmSound::HSoundData sd = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundData(sound, sound_size, type, &sd, 1234));
+    dmSound::HSoundInstance instance = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(sd, &instance));
+
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(instance));
+    do {
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::Update());
+    } while (dmSound::IsPlaying(instance));
+
+    output.SetCapacity(g_LoopbackDevice->m_AllOutput.Size());
+    output.PushArray(g_LoopbackDevice->m_AllOutput.Begin(), g_LoopbackDevice->m_AllOutput.Size());
+
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(instance));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+}
+
+// Decoding ahead on the job threads, or at load time, must give the same output as decoding in the mixer
+TEST(dmSoundDecodeTest, DecodeAhead)
+{
+    dmArray<int16_t> expected;
+    RenderSound(MONO_RESAMPLE_FRAMECOUNT_16000_OGG, MONO_RESAMPLE_FRAMECOUNT_16000_OGG_SIZE, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, 0, 0, expected);
+    ASSERT_LT(0u, expected.Size());
+
+    dmJobThread::JobThreadCreationParams job_thread_create_params;
+    job_thread_create_params.m_ThreadNames[0] = "test_jobthread0";
+    job_thread_create_params.m_ThreadNames[1] = "test_jobthread1";
+    job_thread_create_params.m_ThreadCount = 2;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_create_params);
+
+    dmArray<int16_t> lookahead;
+    RenderSound(MONO_RESAMPLE_FRAMECOUNT_16000_OGG, MONO_RESAMPLE_FRAMECOUNT_16000_OGG_SIZE, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, job_thread, 0, lookahead);
+    dmJobThread::Destroy(job_thread);
+
+    ASSERT_EQ(expected.Size(), lookahead.Size());
+    ASSERT_EQ(0, memcmp(expected.Begin(), lookahead.Begin(), expected.Size() * sizeof(int16_t)));
+
+    dmArray<int16_t> decoded;
+    RenderSound(MONO_RESAMPLE_FRAMECOUNT_16000_OGG, MONO_RESAMPLE_FRAMECOUNT_16000_OGG_SIZE, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, 0, 4 * 1024 * 1024, decoded);
+    ASSERT_EQ(expected.Size(), decoded.Size());
+    ASSERT_EQ(0, memcmp(expected.Begin(), decoded.Begin(), expected.Size() * sizeof(int16_t)));
+}
+
+TEST(dmSoundCodecTest, DecodeToMemory)
+{
+    dmSoundCodec::Info info;
+    char* out = 0;
+    uint32_t out_size = 0;
+    dmSoundCodec::Result r = dmSoundCodec::DecodeToMemory(dmSoundCodec::FORMAT_VORBIS, MONO_RESAMPLE_FRAMECOUNT_16000_OGG, MONO_RESAMPLE_FRAMECOUNT_16000_OGG_SIZE, 16, 4 * 1024 * 1024, &info, &out, &out_size);
+    ASSERT_EQ(dmSoundCodec::RESULT_OK, r);
+    ASSERT_EQ(1u, info.m_Channels);
+    ASSERT_EQ(16000u, info.m_Rate);
+    ASSERT_LT(0u, out_size);
+    free(out);
+
+    out = 0;
+    r = dmSoundCodec::DecodeToMemory(dmSoundCodec::FORMAT_VORBIS, MONO_RESAMPLE_FRAMECOUNT_16000_OGG, MONO_RESAMPLE_FRAMECOUNT_16000_OGG_SIZE, 16, 1024, &info, &out, &out_size);
+    ASSERT_EQ(dmSoundCodec::RESULT_OUT_OF_RESOURCES, r);
+    free(out);
+}
+
+static void InitializeDecodedCacheTest(uint32_t cache_size)
+{
+    dmSound::InitializeParams params;
+    params.m_MaxBuffers = MAX_BUFFERS;
+    params.m_MaxSources = MAX_SOURCES;
+    params.m_OutputDevice = "loopback";
+    params.m_FrameCount = 2048;
+    params.m_UseThread = false;
+    params.m_MaxDecodedSize = 4 * 1024 * 1024;
+    params.m_DecodedCacheSize = cache_size;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Initialize(0, &params));
+}
+
+// The cache fits one decoded sound. Sounds that aren't playing are evicted to make room, the others are played compressed
+TEST(dmSoundDecodeTest, DecodedCache)
+{
+    const void* ogg = MONO_RESAMPLE_FRAMECOUNT_16000_OGG;
+    const uint32_t ogg_size = MONO_RESAMPLE_FRAMECOUNT_16000_OGG_SIZE;
+
+    uint32_t decoded_size = 0;
+    uint32_t usage = 0;
+    uint32_t capacity = 0;
+    InitializeDecodedCacheTest(4 * 1024 * 1024);
+    dmSound::HSoundData sd = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundData(ogg, ogg_size, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, &sd, 1));
+    dmSound::GetDecodedCacheSize(&decoded_size, &capacity);
+    ASSERT_LT(ogg_size, decoded_size);
+    ASSERT_EQ(4u * 1024 * 1024, capacity);
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+
+    InitializeDecodedCacheTest(decoded_size + decoded_size / 2);
+
+    dmSound::HSoundData a = 0;
+    dmSound::HSoundData b = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundData(ogg, ogg_size, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, &a, 1));
+    uint32_t a_size = dmSound::GetSoundResourceSize(a);
+    // Evicts a
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundData(ogg, ogg_size, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, &b, 2));
+    dmSound::GetDecodedCacheSize(&usage, &capacity);
+    ASSERT_EQ(decoded_size, usage);
+    ASSERT_EQ(a_size - decoded_size, dmSound::GetSoundResourceSize(a));
+    ASSERT_EQ(a_size, dmSound::GetSoundResourceSize(b));
+
+    // Decodes a again, and evicts b
+    dmSound::HSoundInstance instance_a = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(a, &instance_a));
+    ASSERT_EQ(a_size, dmSound::GetSoundResourceSize(a));
+    ASSERT_EQ(a_size - decoded_size, dmSound::GetSoundResourceSize(b));
+
+    // a is in use, so b is played compressed
+    dmSound::HSoundInstance instance_b = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(b, &instance_b));
+    dmSound::GetDecodedCacheSize(&usage, &capacity);
+    ASSERT_EQ(decoded_size, usage);
+    ASSERT_EQ(a_size - decoded_size, dmSound::GetSoundResourceSize(b));
+
+    uint32_t group_size = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::GetGroupSoundDataSize(dmHashString64("master"), &group_size));
+    ASSERT_EQ(dmSound::GetSoundResourceSize(a) + dmSound::GetSoundResourceSize(b), group_size);
+    ASSERT_EQ(dmSound::RESULT_NO_SUCH_GROUP, dmSound::GetGroupSoundDataSize(dmHashString64("no_such_group"), &group_size));
+
+    // Both play to the end, decoded or not
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(instance_a));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(instance_b));
+    do {
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::Update());
+    } while (dmSound::IsPlaying(instance_a) || dmSound::IsPlaying(instance_b));
+
+    // The decoded data is kept while the instance uses it
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(a));
+    dmSound::GetDecodedCacheSize(&usage, &capacity);
+    ASSERT_EQ(decoded_size, usage);
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(instance_a));
+    dmSound::GetDecodedCacheSize(&usage, &capacity);
+    ASSERT_EQ(0u, usage);
+
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(instance_b));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(b));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+}
+
+static void TestAdpcmTone(const void* wav, uint32_t wav_size, uint32_t channels)
+{
+    const uint32_t frames = 2 * 44100;
+    dmSoundCodec::NewCodecContextParams codec_params;
+    dmSoundCodec::HCodecContext codec = dmSoundCodec::New(&codec_params);
+    dmSoundCodec::HDecoder decoder = 0;
+    ASSERT_EQ(dmSoundCodec::RESULT_OK, dmSoundCodec::NewDecoder(codec, dmSoundCodec::FORMAT_WAV, wav, wav_size, &decoder));
+
+    dmSoundCodec::Info info;
+    dmSoundCodec::GetInfo(codec, decoder, &info);
+    ASSERT_EQ(44100u, info.m_Rate);
+    ASSERT_EQ(channels, info.m_Channels);
+    ASSERT_EQ(16u, info.m_BitsPerSample);
+    // The last block is padded with silence
+    ASSERT_LE(frames * channels * 2, info.m_Size);
+
+    // Decoded in buffers that don't line up with the blocks, with a skip in the middle
+    dmArray<int16_t> output;
+    output.SetCapacity(info.m_Size / 2);
+    output.SetSize(info.m_Size / 2);
+    uint32_t offset = 0;
+    uint32_t skip_at = (info.m_Size / 3) & ~(channels * 2 - 1);
+    while (offset < info.m_Size)
+    {
+        uint32_t decoded = 0;
+        if (offset == skip_at)
+        {
+            ASSERT_EQ(dmSoundCodec::RESULT_OK, dmSoundCodec::Skip(codec, decoder, 1000 * channels * 2, &decoded));
+            ASSERT_EQ(1000 * channels * 2, decoded);
+            memset((char*) output.Begin() + offset, 0, decoded);
+        }
+        else
+        {
+            uint32_t size = dmMath::Min(333 * channels * 2, info.m_Size - offset);
+            if (offset < skip_at)
+                size = dmMath::Min(size, skip_at - offset);
+            ASSERT_EQ(dmSoundCodec::RESULT_OK, dmSoundCodec::Decode(codec, decoder, (char*) output.Begin() + offset, size, &decoded));
+            ASSERT_EQ(size, decoded);
+        }
+        offset += decoded;
+    }
+    uint32_t decoded = 0;
+    ASSERT_EQ(dmSoundCodec::RESULT_OK, dmSoundCodec::Decode(codec, decoder, (char*) output.Begin(), 64, &decoded));
+    ASSERT_EQ(0u, decoded);
+
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        uint32_t byte_offset = i * channels * 2;
+        if (byte_offset >= skip_at && byte_offset < skip_at + 1000 * channels * 2)
+            continue;
+        float expected = 0.8f * 32768 * sinf((i * 2.0f * M_PI * 440) / 44100);
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            ASSERT_NEAR(expected, output[i * channels + c], 512.0f);
+        }
+    }
+
+    dmSoundCodec::DeleteDecoder(codec, decoder);
+    dmSoundCodec::Delete(codec);
+}
+
+TEST(dmSoundCodecTest, AdpcmWav)
+{
+    TestAdpcmTone(MONO_ADPCM_TONE_440_44100_88200_WAV, MONO_ADPCM_TONE_440_44100_88200_WAV_SIZE, 1);
+    TestAdpcmTone(STEREO_ADPCM_TONE_440_44100_88200_WAV, STEREO_ADPCM_TONE_440_44100_88200_WAV_SIZE, 2);
+}
+
+// The mix kernels are compared with the scalar loops they replaced
+
+static void RefGetPanScale(float pan, float* left_scale, float* right_scale)
+{
+    const float theta = pan * M_PI_2;
+    *left_scale = cosf(theta);
+    *right_scale = sinf(theta);
+}
+
+static void FillBuffer(float* buffer, uint32_t count, float scale)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        buffer[i] = scale * sinf(i * 0.37f + scale);
+    }
+}
+
+static void AssertBuffersNear(const float* expected, const float* actual, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_NEAR(expected[i], actual[i], 0.01f);
+    }
+}
+
+static void InitializeVoiceTest(uint32_t max_voices, dmSound::VoiceStealMode steal_mode)
+{
+    dmSound::InitializeParams params;
+    params.m_MaxBuffers = MAX_BUFFERS;
+    params.m_MaxSources = MAX_SOURCES;
+    params.m_OutputDevice = "loopback";
+    params.m_FrameCount = 2048;
+    params.m_UseThread = false;
+    params.m_MaxVoices = max_voices;
+    params.m_VoiceStealMode = steal_mode;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Initialize(0, &params));
+}
+
+// Plays two instances, where the second has a higher priority, and steps until the second is done
+static void PlayVoiceTest(bool expect_low_stopped)
+{
+    dmSound::HSoundData sd = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundData(MONO_TONE_440_22050_44100_WAV, MONO_TONE_440_22050_44100_WAV_SIZE, dmSound::SOUND_DATA_TYPE_WAV, &sd, 1234));
+    dmSound::HSoundInstance low = 0;
+    dmSound::HSoundInstance high = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(sd, &low));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(sd, &high));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::SetPriority(high, 200));
+
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(low));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(high));
+
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Update());
+    uint32_t real_count = 0;
+    uint32_t virtual_count = 0;
+    dmSound::GetVoiceCounts(&real_count, &virtual_count);
+    ASSERT_EQ(1u, real_count);
+    ASSERT_EQ(expect_low_stopped ? 0u : 1u, virtual_count);
+    ASSERT_TRUE(dmSound::IsPlaying(high));
+    ASSERT_EQ(!expect_low_stopped, dmSound::IsPlaying(low));
+
+    // The virtual instance keeps its place in the sound, and ends at the same time
+    while (dmSound::IsPlaying(high))
+    {
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::Update());
+    }
+    ASSERT_FALSE(dmSound::IsPlaying(low));
+
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(low));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(high));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd));
+}
+
+TEST(dmSoundVoiceTest, MaxVoices)
+{
+    InitializeVoiceTest(1, dmSound::VOICE_STEAL_VIRTUALIZE);
+    PlayVoiceTest(false);
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+}
+
+TEST(dmSoundVoiceTest, GroupVoiceLimit)
+{
+    InitializeVoiceTest(0, dmSound::VOICE_STEAL_VIRTUALIZE);
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::SetGroupVoiceLimit(dmHashString64("master"), 1));
+    ASSERT_EQ(dmSound::RESULT_NO_SUCH_GROUP, dmSound::SetGroupVoiceLimit(dmHashString64("no_such_group"), 1));
+    PlayVoiceTest(false);
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+}
+
+TEST(dmSoundVoiceTest, StopStolen)
+{
+    InitializeVoiceTest(1, dmSound::VOICE_STEAL_STOP);
+    PlayVoiceTest(true);
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+}
+
+// A spatial instance to the right of the listener, beyond the min distance
+static void InitializeLatencyTest(bool low_latency)
+{
+    dmSound::InitializeParams params;
+    params.m_MaxBuffers = MAX_BUFFERS;
+    params.m_MaxSources = MAX_SOURCES;
+    params.m_OutputDevice = "loopback";
+    params.m_FrameCount = 2048;
+    params.m_UseThread = false;
+    params.m_LowLatency = low_latency;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Initialize(0, &params));
+}
+
+TEST(dmSoundLatencyTest, LowLatency)
+{
+    const float buffer_time = 2048 / 44100.0f;
+
+    // All buffers are kept queued
+    InitializeLatencyTest(false);
+    ASSERT_NEAR(6 * buffer_time, dmSound::GetLatency(), 0.0001f);
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+
+    InitializeLatencyTest(true);
+    ASSERT_NEAR(2 * buffer_time, dmSound::GetLatency(), 0.0001f);
+
+    dmSound::HSoundData sd = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundData(MONO_TONE_440_22050_44100_WAV, MONO_TONE_440_22050_44100_WAV_SIZE, dmSound::SOUND_DATA_TYPE_WAV, &sd, 1234));
+    dmSound::HSoundInstance instance = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(sd, &instance));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(instance));
+
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::Update());
+    }
+    ASSERT_NEAR(2 * buffer_time, dmSound::GetLatency(), 0.0001f);
+
+    // A hitch, where the device plays all its buffers before the next update
+    g_LoopbackDevice->m_Time += 100;
+    g_LoopbackDevice->m_QueueTime = g_LoopbackDevice->m_Time;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Update());
+    ASSERT_NEAR(3 * buffer_time, dmSound::GetLatency(), 0.0001f);
+
+    do {
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::Update());
+    } while (dmSound::IsPlaying(instance));
+    ASSERT_NEAR(3 * buffer_time, dmSound::GetLatency(), 0.0001f);
+
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(instance));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+}
+
+TEST(dmSoundSpatialTest, AttenuateAndPan)
+{
+    InitializeVoiceTest(0, dmSound::VOICE_STEAL_VIRTUALIZE);
+
+    dmSound::HSoundData sd = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundData(MONO_TONE_440_22050_44100_WAV, MONO_TONE_440_22050_44100_WAV_SIZE, dmSound::SOUND_DATA_TYPE_WAV, &sd, 1234));
+    dmSound::HSoundInstance instance = 0;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(sd, &instance));
+
+    dmSound::SpatialParams params;
+    params.m_Attenuation = dmSound::ATTENUATION_INVERSE;
+    params.m_MinDistance = 1.0f;
+    params.m_Rolloff = 1.0f;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::SetSpatial(instance, &params));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::SetPosition(instance, dmVMath::Point3(15.0f, 0.0f, 0.0f), dmVMath::Vector3(0.0f, 0.0f, 0.0f)));
+    // Rotated half a turn around z, so that the right of the listener is along -x
+    dmSound::SetListener(dmVMath::Point3(5.0f, 0.0f, 0.0f), dmVMath::Quat::rotationZ((float) M_PI), dmVMath::Vector3(0.0f, 0.0f, 0.0f));
+
+    params.m_Attenuation = (dmSound::AttenuationModel) 17;
+    ASSERT_EQ(dmSound::RESULT_INVALID_PROPERTY, dmSound::SetSpatial(instance, &params));
+
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(instance));
+    do {
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::Update());
+    } while (dmSound::IsPlaying(instance));
+
+    int16_t max_left = 0;
+    int16_t max_right = 0;
+    for (uint32_t i = 0; i < g_LoopbackDevice->m_AllOutput.Size(); i += 2)
+    {
+        max_left = dmMath::Max(max_left, g_LoopbackDevice->m_AllOutput[i]);
+        max_right = dmMath::Max(max_right, g_LoopbackDevice->m_AllOutput[i + 1]);
+    }
+    // Fully to the left, at a tenth of the gain
+    ASSERT_NEAR(0.8f * 32768.0f * 0.1f, max_left, 30.0f);
+    ASSERT_EQ(0, max_right);
+
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(instance));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+}
+
+TEST(dmSoundMix, ConvertSamples)
+{
+    const uint32_t count = 45;
+    int16_t s16[count];
+    uint8_t u8[count];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        s16[i] = (int16_t)(i * 1499 - 32768);
+        u8[i] = (uint8_t)(i * 17);
+    }
+
+    float out[count];
+    dmSound::ConvertSamples(s16, out, count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_EQ((float)s16[i], out[i]);
+    }
+
+    dmSound::ConvertSamples(u8, out, count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_EQ(((float)u8[i] - 128) * 255, out[i]);
+    }
+}
+
+TEST(dmSoundMix, MixMonoStereo)
+{
+    const uint32_t total = 123;
+    const uint32_t start = 37;
+    const uint32_t count = total - start;
+    dmSound::Ramp gain(0.2f, 0.9f, 1, 4, total);
+    dmSound::Ramp pans[] = {
+        dmSound::Ramp(0.3f, 0.3f, 0, 1, total),
+        dmSound::Ramp(0.0f, 1.0f, 1, 2, total),
+    };
+
+    for (uint32_t p = 0; p < DM_ARRAY_SIZE(pans); ++p)
+    {
+        const dmSound::Ramp& pan = pans[p];
+        float samples[2 * count];
+        FillBuffer(samples, 2 * count, 20000.0f);
+
+        float expected[2 * count];
+        float actual[2 * count];
+        FillBuffer(expected, 2 * count, 100.0f);
+        memcpy(actual, expected, sizeof(actual));
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            float g = gain.GetValue(start + i);
+            float left_scale, right_scale;
+            RefGetPanScale(pan.GetValue(start + i), &left_scale, &right_scale);
+            expected[2 * i]     += samples[i] * g * left_scale;
+            expected[2 * i + 1] += samples[i] * g * right_scale;
+        }
+        dmSound::MixMono(actual, samples, start, count, gain, pan);
+        AssertBuffersNear(expected, actual, 2 * count);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            float g = gain.GetValue(start + i);
+            float left_scale, right_scale;
+            RefGetPanScale(pan.GetValue(start + i), &left_scale, &right_scale);
+            expected[2 * i]     += samples[2 * i] * g * left_scale;
+            expected[2 * i + 1] += samples[2 * i + 1] * g * right_scale;
+        }
+        dmSound::MixStereo(actual, samples, start, count, gain, pan);
+        AssertBuffersNear(expected, actual, 2 * count);
+    }
+}
+
+TEST(dmSoundMix, MixGroupMaster)
+{
+    const uint32_t count = 77;
+    dmSound::Ramp gain(-0.5f, 2.0f, 0, 1, count);
+
+    float group[2 * count];
+    FillBuffer(group, 2 * count, 30000.0f);
+    float expected[2 * count];
+    float actual[2 * count];
+    FillBuffer(expected, 2 * count, 20000.0f);
+    memcpy(actual, expected, sizeof(actual));
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        float g = dmMath::Clamp(gain.GetValue(i), 0.0f, 1.0f);
+        expected[2 * i]     += group[2 * i] * g;
+        expected[2 * i + 1] += group[2 * i + 1] * g;
+    }
+    dmSound::MixGroup(actual, group, count, gain);
+    AssertBuffersNear(expected, actual, 2 * count);
+
+    // The gain goes above 1, so that some samples are clipped
+    int16_t out[2 * count];
+    dmSound::MixMaster(actual, out, count, gain);
+    for (uint32_t i = 0; i < 2 * count; ++i)
+    {
+        float s = dmMath::Clamp(actual[i] * gain.GetValue(i / 2), -32768.0f, 32767.0f);
+        ASSERT_NEAR((int16_t)s, out[i], 1);
+    }
+}
+
+TEST(dmSoundMix, Spatialize)
+{
+    // Not a multiple of 4, to also test the last partial block
+    const uint32_t count = 5;
+    float streams[dmSound::SPATIAL_STREAM_COUNT * count];
+    memset(streams, 0, sizeof(streams));
+    struct Source { float x, y, z, vz, min_distance, max_distance, a, b, gain, pan, doppler; } sources[count] = {
+        // In front, at the min distance
+        { 0.0f, 0.0f, -1.0f,  0.0f, 1.0f, 100.0f, 0.0f, 1.0f,   1.0f, 0.5f, 1.0f },
+        // Inverse attenuation, to the right
+        { 10.0f, 0.0f, 0.0f,  0.0f, 1.0f, 100.0f, 0.0f, 1.0f,   0.1f, 1.0f, 1.0f },
+        // Linear attenuation, to the left
+        { -5.0f, 0.0f, 0.0f,  0.0f, 0.0f, 10.0f, 0.1f, 0.0f,    0.5f, 0.0f, 1.0f },
+        // Beyond the max distance, behind and moving away
+        { 0.0f, 0.0f, 20.0f,  34.33f, 0.0f, 10.0f, 0.1f, 0.0f,  0.0f, 0.5f, 343.3f / (343.3f + 34.33f) },
+        // Approaching, at the listener's side
+        { 0.0f, 0.0f, -10.0f, 34.33f, 1.0f, 100.0f, 0.0f, 0.0f, 1.0f, 0.5f, 343.3f / (343.3f - 34.33f) },
+    };
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        streams[dmSound::SPATIAL_POSITION_X * count + i] = sources[i].x;
+        streams[dmSound::SPATIAL_POSITION_Y * count + i] = sources[i].y;
+        streams[dmSound::SPATIAL_POSITION_Z * count + i] = sources[i].z;
+        streams[dmSound::SPATIAL_VELOCITY_Z * count + i] = sources[i].vz;
+        streams[dmSound::SPATIAL_MIN_DISTANCE * count + i] = sources[i].min_distance;
+        streams[dmSound::SPATIAL_MAX_DISTANCE * count + i] = sources[i].max_distance;
+        streams[dmSound::SPATIAL_ATTENUATION_A * count + i] = sources[i].a;
+        streams[dmSound::SPATIAL_ATTENUATION_B * count + i] = sources[i].b;
+        streams[dmSound::SPATIAL_DOPPLER_FACTOR * count + i] = 1.0f;
+    }
+
+    dmSound::SpatialListener listener = { {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f} };
+    dmSound::Spatialize(listener, streams, count, count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_NEAR(sources[i].gain, streams[dmSound::SPATIAL_GAIN * count + i], 0.0001f);
+        ASSERT_NEAR(sources[i].pan, streams[dmSound::SPATIAL_PAN * count + i], 0.0001f);
+        ASSERT_NEAR(sources[i].doppler, streams[dmSound::SPATIAL_DOPPLER * count + i], 0.0001f);
+    }
+}
+
 DM_DECLARE_SOUND_DEVICE(LoopBackDevice, "loopback", DeviceLoopbackOpen, DeviceLoopbackClose, DeviceLoopbackQueue, DeviceLoopbackFreeBufferSlots, DeviceLoopbackDeviceInfo, DeviceLoopbackRestart, DeviceLoopbackStop);
 
 extern "C" void dmExportedSymbols();
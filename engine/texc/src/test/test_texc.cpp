@@ -14,7 +14,10 @@
 
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
+#include <dlib/dstrings.h>
 #include <dlib/image.h>
+#include <dlib/sys.h>
+#include <stdio.h>
 #include <string.h> // memcmp
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -230,12 +233,186 @@ TEST_F(TexcTest, MipMaps)
 }
 
 
+TEST_F(TexcTest, MipMapsSrgb)
+{
+    // A black and white checker averages to half the light, and not to half the sRGB value
+    uint8_t checker[2*2*4] =
+    {
+        255, 255, 255, 255,     0, 0, 0, 255,
+        0, 0, 0, 255,           255, 255, 255, 255,
+    };
+    uint8_t data[2*2*4 + 4];
+
+    dmTexc::HTexture texture = dmTexc::Create(0, 2, 2, dmTexc::PF_R8G8B8A8, dmTexc::CS_SRGB, dmTexc::CT_DEFAULT, checker);
+    ASSERT_TRUE(dmTexc::GenMipMapsThreaded(texture, dmTexc::CL_NORMAL, 4));
+    ASSERT_EQ(sizeof(data), dmTexc::GetData(texture, data, sizeof(data)));
+    ASSERT_NEAR(188, data[16], 1);
+    ASSERT_EQ(255, data[19]);
+    dmTexc::Destroy(texture);
+
+    texture = dmTexc::Create(0, 2, 2, dmTexc::PF_R8G8B8A8, dmTexc::CS_LRGB, dmTexc::CT_DEFAULT, checker);
+    ASSERT_TRUE(dmTexc::GenMipMapsThreaded(texture, dmTexc::CL_FAST, 1));
+    ASSERT_EQ(sizeof(data), dmTexc::GetData(texture, data, sizeof(data)));
+    ASSERT_NEAR(128, data[16], 1);
+    dmTexc::Destroy(texture);
+}
+
+TEST_F(TexcTest, MipMapsThreaded)
+{
+    const uint32_t size = 256;
+    uint8_t* image = new uint8_t[size*size*4];
+    for (uint32_t i = 0; i < size*size*4; ++i)
+    {
+        image[i] = (uint8_t)((i * 7) ^ (i >> 5));
+    }
+
+    const dmTexc::CompressionLevel levels[] = { dmTexc::CL_FAST, dmTexc::CL_BEST };
+    for (uint32_t l = 0; l < sizeof(levels)/sizeof(levels[0]); ++l)
+    {
+        dmTexc::HTexture single = dmTexc::Create(0, size, size, dmTexc::PF_R8G8B8A8, dmTexc::CS_SRGB, dmTexc::CT_DEFAULT, image);
+        dmTexc::HTexture threaded = dmTexc::Create(0, size, size, dmTexc::PF_R8G8B8A8, dmTexc::CS_SRGB, dmTexc::CT_DEFAULT, image);
+        ASSERT_TRUE(dmTexc::GenMipMapsThreaded(single, levels[l], 1));
+        ASSERT_TRUE(dmTexc::GenMipMapsThreaded(threaded, levels[l], 8));
+
+        dmTexc::Header header;
+        dmTexc::GetHeader(threaded, &header);
+        ASSERT_EQ(9u, header.m_MipMapCount);
+
+        // The bands of rows are filtered independently, so the result doesn't depend on the thread count
+        uint32_t data_size = dmTexc::GetTotalDataSize(single);
+        ASSERT_EQ(data_size, dmTexc::GetTotalDataSize(threaded));
+        uint8_t* a = new uint8_t[data_size];
+        uint8_t* b = new uint8_t[data_size];
+        dmTexc::GetData(single, a, data_size);
+        dmTexc::GetData(threaded, b, data_size);
+        ASSERT_EQ(0, memcmp(a, b, data_size));
+        delete[] a;
+        delete[] b;
+
+        dmTexc::Destroy(single);
+        dmTexc::Destroy(threaded);
+    }
+    delete[] image;
+}
+
 #define ASSERT_RGBA(exp, act)\
     ASSERT_EQ((exp)[0], (act)[0]);\
     ASSERT_EQ((exp)[1], (act)[1]);\
     ASSERT_EQ((exp)[2], (act)[2]);\
     ASSERT_EQ((exp)[3], (act)[3]);\
 
+TEST_F(TexcTest, EncodeASTC)
+{
+    // 6x6 isn't a multiple of the block size, the partial blocks repeat the edge pixels
+    const uint32_t size = 6;
+    uint8_t image[size*size*4];
+    for (uint32_t i = 0; i < size*size; ++i)
+    {
+        image[i*4+0] = 255;
+        image[i*4+1] = 0;
+        image[i*4+2] = 0;
+        image[i*4+3] = 255;
+    }
+
+    dmTexc::HTexture texture = dmTexc::Create(0, size, size, dmTexc::PF_R8G8B8A8, dmTexc::CS_SRGB, dmTexc::CT_ASTC, image);
+    ASSERT_NE((dmTexc::HTexture)0, texture);
+    ASSERT_TRUE(dmTexc::GenMipMaps(texture));
+    ASSERT_TRUE(dmTexc::Encode(texture, dmTexc::PF_RGBA_ASTC_4x4, dmTexc::CS_SRGB, dmTexc::CL_FAST, dmTexc::CT_ASTC, true, 4));
+
+    // 6x6 -> 2x2 blocks, 3x3 -> 1x1 block, 1x1 -> 1x1 block
+    ASSERT_EQ(4*16u, dmTexc::GetDataSizeCompressed(texture, 0));
+    ASSERT_EQ(16u, dmTexc::GetDataSizeCompressed(texture, 1));
+    ASSERT_EQ(16u, dmTexc::GetDataSizeCompressed(texture, 2));
+
+    uint32_t data_size = dmTexc::GetTotalDataSize(texture);
+    ASSERT_EQ(6*16u, data_size);
+    uint8_t data[6*16];
+    ASSERT_EQ(data_size, dmTexc::GetData(texture, data, sizeof(data)));
+
+    // A solid color is stored as a void extent block, with 16 bit colors
+    const uint8_t expected[16] = { 0xfc, 0xfd, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff };
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        ASSERT_EQ(0, memcmp(expected, &data[i*16], 16));
+    }
+
+    dmTexc::Destroy(texture);
+}
+
+static dmTexc::HTexture CreateCacheTestTexture(uint8_t seed)
+{
+    uint8_t image[16*16*4];
+    for (uint32_t i = 0; i < sizeof(image); ++i)
+    {
+        image[i] = (uint8_t)(i * 13 + seed);
+    }
+    dmTexc::HTexture texture = dmTexc::Create(0, 16, 16, dmTexc::PF_R8G8B8A8, dmTexc::CS_SRGB, dmTexc::CT_DEFAULT, image);
+    dmTexc::GenMipMaps(texture);
+    return texture;
+}
+
+TEST_F(TexcTest, EncodeCache)
+{
+    const char* dir = "build/texc_cache_test";
+    ASSERT_TRUE(dmTexc::SetCacheDirectory(dir));
+
+    dmTexc::HTexture texture = CreateCacheTestTexture(0);
+    uint64_t key = dmTexc::CalcCacheKey((dmTexc::Texture*)texture, dmTexc::PF_R5G6B5, dmTexc::CS_SRGB, dmTexc::CT_DEFAULT, dmTexc::CL_NORMAL);
+    char path[1024];
+    dmSnPrintf(path, sizeof(path), "%s/%016llx.texc", dir, (unsigned long long)key);
+    dmSys::Unlink(path);
+
+    ASSERT_TRUE(dmTexc::Encode(texture, dmTexc::PF_R5G6B5, dmTexc::CS_SRGB, dmTexc::CL_NORMAL, dmTexc::CT_DEFAULT, true, 1));
+    ASSERT_TRUE(dmSys::Exists(path));
+
+    uint32_t data_size = dmTexc::GetTotalDataSize(texture);
+    uint8_t* expected = new uint8_t[data_size];
+    dmTexc::GetData(texture, expected, data_size);
+    dmTexc::Destroy(texture);
+
+    // Other settings give another key
+    texture = CreateCacheTestTexture(0);
+    ASSERT_NE(key, dmTexc::CalcCacheKey((dmTexc::Texture*)texture, dmTexc::PF_R5G6B5, dmTexc::CS_SRGB, dmTexc::CT_DEFAULT, dmTexc::CL_BEST));
+    ASSERT_NE(key, dmTexc::CalcCacheKey((dmTexc::Texture*)texture, dmTexc::PF_R4G4B4A4, dmTexc::CS_SRGB, dmTexc::CT_DEFAULT, dmTexc::CL_NORMAL));
+    dmTexc::Destroy(texture);
+    texture = CreateCacheTestTexture(1);
+    ASSERT_NE(key, dmTexc::CalcCacheKey((dmTexc::Texture*)texture, dmTexc::PF_R5G6B5, dmTexc::CS_SRGB, dmTexc::CT_DEFAULT, dmTexc::CL_NORMAL));
+    dmTexc::Destroy(texture);
+
+    // Change the last byte of the stored data, to see that a hit returns what is in the cache
+    FILE* file = fopen(path, "r+b");
+    ASSERT_TRUE(file != 0);
+    fseek(file, -1, SEEK_END);
+    fputc(expected[data_size-1] ^ 0xFF, file);
+    fclose(file);
+
+    texture = CreateCacheTestTexture(0);
+    ASSERT_TRUE(dmTexc::Encode(texture, dmTexc::PF_R5G6B5, dmTexc::CS_SRGB, dmTexc::CL_NORMAL, dmTexc::CT_DEFAULT, true, 1));
+    ASSERT_EQ(data_size, dmTexc::GetTotalDataSize(texture));
+    uint8_t* data = new uint8_t[data_size];
+    dmTexc::GetData(texture, data, data_size);
+    ASSERT_EQ(0, memcmp(expected, data, data_size - 1));
+    ASSERT_EQ(expected[data_size-1] ^ 0xFF, data[data_size-1]);
+    dmTexc::Destroy(texture);
+
+    // A truncated file is a miss, and is replaced
+    file = fopen(path, "wb");
+    ASSERT_TRUE(file != 0);
+    fputc(0, file);
+    fclose(file);
+
+    texture = CreateCacheTestTexture(0);
+    ASSERT_TRUE(dmTexc::Encode(texture, dmTexc::PF_R5G6B5, dmTexc::CS_SRGB, dmTexc::CL_NORMAL, dmTexc::CT_DEFAULT, true, 1));
+    dmTexc::GetData(texture, data, data_size);
+    ASSERT_EQ(0, memcmp(expected, data, data_size));
+    dmTexc::Destroy(texture);
+
+    delete[] data;
+    delete[] expected;
+    dmSys::Unlink(path);
+    ASSERT_TRUE(dmTexc::SetCacheDirectory(0));
+}
+
 TEST_F(TexcTest, FlipAxis)
 {
 
@@ -443,6 +620,7 @@ struct CompileInfo
 CompileInfo compile_info[] =
 {
     {"src/test/data/a.png", dmTexc::CT_DEFAULT, dmTexc::PF_R8G8B8A8, dmTexc::PF_R5G6B5, dmTexc::CS_SRGB},
+    {"src/test/data/a.png", dmTexc::CT_ASTC, dmTexc::PF_R8G8B8A8, dmTexc::PF_RGBA_ASTC_4x4, dmTexc::CS_SRGB},
 };
 
 class TexcCompileTest : public jc_test_params_class<CompileInfo>
@@ -16,8 +16,10 @@
 #include "texc_private.h"
 #include "texc_enc_basis.h"
 #include "texc_enc_default.h"
+#include "texc_enc_astc.h"
 
 #include <assert.h>
+#include <thread>
 
 #include <dlib/log.h>
 #include <dlib/math.h>
@@ -32,6 +34,7 @@ namespace dmTexc
             case dmTexc::CT_BASIS_UASTC:
             case dmTexc::CT_BASIS_ETC1S:    GetEncoderBasis(encoder); return true;
             case dmTexc::CT_DEFAULT:        GetEncoderDefault(encoder); return true;
+            case dmTexc::CT_ASTC:           GetEncoderASTC(encoder); return true;
             default:
                 return false;
         }
@@ -114,10 +117,29 @@ namespace dmTexc
         return t->m_CompressionFlags;
     }
 
+    static uint32_t GetNumThreads(int max_threads)
+    {
+        uint32_t num_threads = max_threads;
+        if (max_threads > 1)
+        {
+            num_threads = std::thread::hardware_concurrency();
+            if (num_threads < 1)
+                num_threads = 1;
+            if (num_threads > max_threads)
+                num_threads = max_threads;
+        }
+        return num_threads;
+    }
+
     bool Resize(HTexture texture, uint32_t width, uint32_t height)
+    {
+        return ResizeThreaded(texture, width, height, 1);
+    }
+
+    bool ResizeThreaded(HTexture texture, uint32_t width, uint32_t height, int max_threads)
     {
         Texture* t = (Texture*) texture;
-        return t->m_Encoder.m_FnResize(t, width, height);
+        return t->m_Encoder.m_FnResize(t, width, height, GetNumThreads(max_threads));
     }
 
     bool PreMultiplyAlpha(HTexture texture)
@@ -127,9 +149,14 @@ namespace dmTexc
     }
 
     bool GenMipMaps(HTexture texture)
+    {
+        return GenMipMapsThreaded(texture, CL_NORMAL, 1);
+    }
+
+    bool GenMipMapsThreaded(HTexture texture, CompressionLevel quality, int max_threads)
     {
         Texture* t = (Texture*) texture;
-        return t->m_Encoder.m_FnGenMipMaps(t);
+        return t->m_Encoder.m_FnGenMipMaps(t, quality, GetNumThreads(max_threads));
     }
 
     bool Flip(HTexture texture, FlipAxis flip_axis)
@@ -143,27 +170,26 @@ namespace dmTexc
         return t->m_Encoder.m_FnFlip(t, flip_axis);
     }
 
-    static uint32_t GetNumThreads(int max_threads)
-    {
-        uint32_t num_threads = max_threads;
-        if (max_threads > 1)
-        {
-            num_threads = std::thread::hardware_concurrency();
-            if (num_threads < 1)
-                num_threads = 1;
-            if (num_threads > max_threads)
-                num_threads = max_threads;
-        }
-        return num_threads;
-    }
-
     bool Encode(HTexture texture, PixelFormat pixel_format, ColorSpace color_space,
                 CompressionLevel compression_level, CompressionType compression_type, bool mipmaps, int max_threads)
     {
         Texture* t = (Texture*) texture;
 
+        uint64_t cache_key = 0;
+        if (IsCacheEnabled())
+        {
+            cache_key = CalcCacheKey(t, pixel_format, color_space, compression_type, compression_level);
+            if (ReadCache(t, cache_key))
+                return true;
+        }
+
         uint32_t num_threads = GetNumThreads(max_threads);
-        return t->m_Encoder.m_FnEncode(t, num_threads, pixel_format, compression_type, compression_level);
+        if (!t->m_Encoder.m_FnEncode(t, num_threads, pixel_format, compression_type, compression_level))
+            return false;
+
+        if (IsCacheEnabled())
+            WriteCache(t, cache_key);
+        return true;
     }
 
 #define DM_TEXC_TRAMPOLINE1(ret, name, t1) \
@@ -222,10 +248,13 @@ namespace dmTexc
     DM_TEXC_TRAMPOLINE3(uint32_t, GetData, HTexture, void*, uint32_t);
     DM_TEXC_TRAMPOLINE1(uint64_t, GetCompressionFlags, HTexture);
     DM_TEXC_TRAMPOLINE3(bool, Resize, HTexture, uint32_t, uint32_t);
+    DM_TEXC_TRAMPOLINE4(bool, ResizeThreaded, HTexture, uint32_t, uint32_t, int);
     DM_TEXC_TRAMPOLINE1(bool, PreMultiplyAlpha, HTexture);
     DM_TEXC_TRAMPOLINE1(bool, GenMipMaps, HTexture);
+    DM_TEXC_TRAMPOLINE3(bool, GenMipMapsThreaded, HTexture, CompressionLevel, int);
     DM_TEXC_TRAMPOLINE2(bool, Flip, HTexture, FlipAxis);
     DM_TEXC_TRAMPOLINE7(bool, Encode, HTexture, PixelFormat, ColorSpace, CompressionLevel, CompressionType, bool, int);
+    DM_TEXC_TRAMPOLINE1(bool, SetCacheDirectory, const char*);
     DM_TEXC_TRAMPOLINE2(HBuffer, CompressBuffer, void*, uint32_t);
     DM_TEXC_TRAMPOLINE1(uint32_t, GetTotalBufferDataSize, HBuffer);
     DM_TEXC_TRAMPOLINE3(uint32_t, GetBufferData, HBuffer, void*, uint32_t);
@@ -71,6 +71,7 @@ namespace dmTexc
         CT_WEBP_LOSSY,  // Deprecated
         CT_BASIS_UASTC,
         CT_BASIS_ETC1S,
+        CT_ASTC,        // Native ASTC, see PF_RGBA_ASTC_4x4
     };
 
     enum CompressionFlags
@@ -172,6 +173,11 @@ namespace dmTexc
      * The texture must have format PF_R8G8B8A8 to be resized.
      */
     DM_TEXC_PROTO(bool, Resize, HTexture texture, uint32_t width, uint32_t height);
+    /**
+     * Resize a texture, see Resize, splitting the work over up to max_threads threads.
+     * sRGB textures are filtered in linear space.
+     */
+    DM_TEXC_PROTO(bool, ResizeThreaded, HTexture texture, uint32_t width, uint32_t height, int max_threads);
     /**
      * Pre-multiply the color with alpha in a texture.
      * The texture must have format PF_R8G8B8A8 for the alpha to be pre-multiplied.
@@ -182,6 +188,12 @@ namespace dmTexc
      * The texture must have format PF_R8G8B8A8 for mip maps to be generated.
      */
     DM_TEXC_PROTO(bool, GenMipMaps, HTexture texture);
+    /**
+     * Generate mip maps, see GenMipMaps, splitting the work over up to max_threads threads.
+     * sRGB textures are filtered in linear space.
+     * With CL_FAST each level is filtered from the previous level, with the other levels from the base image.
+     */
+    DM_TEXC_PROTO(bool, GenMipMapsThreaded, HTexture texture, CompressionLevel quality, int max_threads);
     /**
      * Flips a texture vertically
      */
@@ -191,6 +203,13 @@ namespace dmTexc
      */
     DM_TEXC_PROTO(bool, Encode, HTexture texture, PixelFormat pixelFormat, ColorSpace color_space, CompressionLevel compressionLevel, CompressionType compression_type, bool mipmaps, int max_threads);
 
+    /**
+     * Sets the directory of the encode cache, which is created if needed. Pass 0 to disable the cache (default).
+     * Encode then first looks for output that was stored for the same pixels, encode settings and encoder version.
+     * The directory can be shared between processes and machines.
+     */
+    DM_TEXC_PROTO(bool, SetCacheDirectory, const char* path);
+
     // Now only used for font glyphs
     // Compresses an image buffer
     DM_TEXC_PROTO(HBuffer, CompressBuffer, void* data, uint32_t size);
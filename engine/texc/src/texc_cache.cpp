@@ -0,0 +1,265 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <dlib/dstrings.h>
+#include <dlib/hash.h>
+#include <dlib/log.h>
+#include <dlib/math.h>
+#include <dlib/path.h>
+#include <dlib/sys.h>
+#include <dlib/time.h>
+
+#include "texc.h"
+#include "texc_private.h"
+
+#include <basis/encoder/basisu_comp.h> // BASISU_LIB_VERSION
+
+// A cache of encoded textures, one file per texture, named after the hash of everything that goes into the
+// encoder. The files are written to a temporary name and then renamed, so a directory can be shared by several
+// processes and machines. All the fields are stored little endian, as on all the hosts we build on.
+
+namespace dmTexc
+{
+    // Bump when an encoder change alters the output for the same input
+    static const uint32_t CACHE_VERSION = 1;
+    static const uint32_t CACHE_MAGIC   = 0x43435854; // "TXCC"
+
+    struct CacheHeader
+    {
+        uint32_t m_Magic;
+        uint32_t m_Version;
+        uint64_t m_Key;
+        uint64_t m_CompressionFlags;
+        uint32_t m_PixelFormat;
+        uint32_t m_MipMapCount;
+        uint32_t m_BasisFileSize;
+        uint32_t m_Pad;
+    };
+
+    struct CacheMipMap
+    {
+        uint32_t m_Width;
+        uint32_t m_Height;
+        uint32_t m_ByteSize;
+        uint32_t m_IsCompressed;
+    };
+
+    static char g_CacheDirectory[DMPATH_MAX_PATH] = {0};
+
+    bool SetCacheDirectory(const char* path)
+    {
+        if (path == 0 || path[0] == 0)
+        {
+            g_CacheDirectory[0] = 0;
+            return true;
+        }
+
+        if (dmSys::IsDir(path) != dmSys::RESULT_OK)
+        {
+            // Another process may have created it in between
+            dmSys::Result r = dmSys::Mkdir(path, 0755);
+            if (r != dmSys::RESULT_OK && r != dmSys::RESULT_EXIST)
+            {
+                dmLogError("Unable to create the texture cache directory '%s'", path);
+                g_CacheDirectory[0] = 0;
+                return false;
+            }
+        }
+        dmStrlCpy(g_CacheDirectory, path, sizeof(g_CacheDirectory));
+        return true;
+    }
+
+    bool IsCacheEnabled()
+    {
+        return g_CacheDirectory[0] != 0;
+    }
+
+    static void HashUint32(HashState64* state, uint32_t value)
+    {
+        dmHashUpdateBuffer64(state, &value, sizeof(value));
+    }
+
+    uint64_t CalcCacheKey(Texture* texture, PixelFormat pixel_format, ColorSpace color_space, CompressionType compression_type, CompressionLevel compression_level)
+    {
+        HashState64 state;
+        dmHashInit64(&state, false);
+        HashUint32(&state, CACHE_VERSION);
+        HashUint32(&state, BASISU_LIB_VERSION);
+        HashUint32(&state, texture->m_Width);
+        HashUint32(&state, texture->m_Height);
+        HashUint32(&state, texture->m_PixelFormat);
+        HashUint32(&state, pixel_format);
+        HashUint32(&state, color_space);
+        HashUint32(&state, compression_type);
+        HashUint32(&state, compression_level);
+
+        // Default encoders: the RGBA8888 mip levels
+        HashUint32(&state, texture->m_Mips.Size());
+        for (uint32_t i = 0; i < texture->m_Mips.Size(); ++i)
+        {
+            const TextureData& mip = texture->m_Mips[i];
+            HashUint32(&state, mip.m_Width);
+            HashUint32(&state, mip.m_Height);
+            dmHashUpdateBuffer64(&state, mip.m_Data, mip.m_ByteSize);
+        }
+
+        // Basis encoder: the base image, and whether basis generates the mip levels
+        const basisu::image& image = texture->m_BasisImage;
+        HashUint32(&state, texture->m_BasisGenMipmaps ? 1 : 0);
+        HashUint32(&state, image.get_width());
+        HashUint32(&state, image.get_height());
+        if (image.get_total_pixels())
+        {
+            dmHashUpdateBuffer64(&state, image.get_ptr(), image.get_total_pixels() * sizeof(basisu::color_rgba));
+        }
+        return dmHashFinal64(&state);
+    }
+
+    static void GetCachePath(uint64_t key, char* path, uint32_t path_size)
+    {
+        dmSnPrintf(path, path_size, "%s/%016llx.texc", g_CacheDirectory, (unsigned long long)key);
+    }
+
+    bool ReadCache(Texture* texture, uint64_t key)
+    {
+        char path[DMPATH_MAX_PATH];
+        GetCachePath(key, path, sizeof(path));
+
+        FILE* file = fopen(path, "rb");
+        if (!file)
+            return false;
+
+        CacheHeader header;
+        bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+                  header.m_Magic == CACHE_MAGIC &&
+                  header.m_Version == CACHE_VERSION &&
+                  header.m_Key == key;
+
+        dmArray<CacheMipMap> mips;
+        dmArray<TextureData> mip_data;
+        if (ok)
+        {
+            mips.SetCapacity(header.m_MipMapCount);
+            mips.SetSize(header.m_MipMapCount);
+            ok = header.m_MipMapCount == 0 || fread(mips.Begin(), sizeof(CacheMipMap), mips.Size(), file) == mips.Size();
+        }
+
+        if (ok)
+        {
+            mip_data.SetCapacity(mips.Size());
+            for (uint32_t i = 0; i < mips.Size() && ok; ++i)
+            {
+                TextureData data;
+                data.m_Width        = mips[i].m_Width;
+                data.m_Height       = mips[i].m_Height;
+                data.m_ByteSize     = mips[i].m_ByteSize;
+                data.m_IsCompressed = mips[i].m_IsCompressed != 0;
+                data.m_Data         = new uint8_t[data.m_ByteSize];
+                mip_data.Push(data);
+                ok = fread(data.m_Data, 1, data.m_ByteSize, file) == data.m_ByteSize;
+            }
+        }
+
+        dmArray<uint8_t> basis_file;
+        if (ok && header.m_BasisFileSize)
+        {
+            basis_file.SetCapacity(header.m_BasisFileSize);
+            basis_file.SetSize(header.m_BasisFileSize);
+            ok = fread(basis_file.Begin(), 1, basis_file.Size(), file) == basis_file.Size();
+        }
+        fclose(file);
+
+        if (!ok)
+        {
+            // Probably written by another version, it's replaced after the encode
+            dmLogWarning("Ignoring the invalid texture cache file '%s'", path);
+            for (uint32_t i = 0; i < mip_data.Size(); ++i)
+            {
+                delete[] mip_data[i].m_Data;
+            }
+            return false;
+        }
+
+        for (uint32_t i = 0; i < texture->m_Mips.Size(); ++i)
+        {
+            delete[] texture->m_Mips[i].m_Data;
+        }
+        texture->m_Mips.SetSize(0);
+        texture->m_Mips.SetCapacity(dmMath::Max(64U, mip_data.Size()));
+        texture->m_Mips.PushArray(mip_data.Begin(), mip_data.Size());
+
+        texture->m_BasisFile.Swap(basis_file);
+        texture->m_PixelFormat      = (PixelFormat)header.m_PixelFormat;
+        texture->m_CompressionFlags = header.m_CompressionFlags;
+        return true;
+    }
+
+    void WriteCache(Texture* texture, uint64_t key)
+    {
+        char path[DMPATH_MAX_PATH];
+        GetCachePath(key, path, sizeof(path));
+
+        // Unique per process and texture, so that concurrent writers never share a file
+        char tmp_path[DMPATH_MAX_PATH];
+        dmSnPrintf(tmp_path, sizeof(tmp_path), "%s.%llx%p.tmp", path, (unsigned long long)dmTime::GetTime(), (void*)texture);
+
+        FILE* file = fopen(tmp_path, "wb");
+        if (!file)
+        {
+            dmLogWarning("Unable to write the texture cache file '%s'", tmp_path);
+            return;
+        }
+
+        CacheHeader header;
+        memset(&header, 0, sizeof(header));
+        header.m_Magic            = CACHE_MAGIC;
+        header.m_Version          = CACHE_VERSION;
+        header.m_Key              = key;
+        header.m_CompressionFlags = texture->m_CompressionFlags;
+        header.m_PixelFormat      = texture->m_PixelFormat;
+        header.m_MipMapCount      = texture->m_Mips.Size();
+        header.m_BasisFileSize    = texture->m_BasisFile.Size();
+
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+        for (uint32_t i = 0; i < texture->m_Mips.Size() && ok; ++i)
+        {
+            const TextureData& data = texture->m_Mips[i];
+            CacheMipMap mip;
+            mip.m_Width        = data.m_Width;
+            mip.m_Height       = data.m_Height;
+            mip.m_ByteSize     = data.m_ByteSize;
+            mip.m_IsCompressed = data.m_IsCompressed;
+            ok = fwrite(&mip, sizeof(mip), 1, file) == 1;
+        }
+        for (uint32_t i = 0; i < texture->m_Mips.Size() && ok; ++i)
+        {
+            const TextureData& data = texture->m_Mips[i];
+            ok = fwrite(data.m_Data, 1, data.m_ByteSize, file) == data.m_ByteSize;
+        }
+        if (ok && texture->m_BasisFile.Size())
+        {
+            ok = fwrite(texture->m_BasisFile.Begin(), 1, texture->m_BasisFile.Size(), file) == texture->m_BasisFile.Size();
+        }
+        ok = fclose(file) == 0 && ok;
+
+        if (!ok || dmSys::Rename(path, tmp_path) != dmSys::RESULT_OK)
+        {
+            dmLogWarning("Unable to write the texture cache file '%s'", path);
+            dmSys::Unlink(tmp_path);
+        }
+    }
+}
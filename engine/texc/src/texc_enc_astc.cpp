@@ -0,0 +1,174 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <string.h>
+#include <thread>
+
+#include <dlib/log.h>
+#include <dlib/math.h>
+
+#include "texc.h"
+#include "texc_private.h"
+#include "texc_enc_astc.h"
+#include "texc_enc_default.h"
+
+#include <basis/encoder/basisu_enc.h>
+#include <basis/encoder/basisu_uastc_enc.h>
+#include <basis/transcoder/basisu_transcoder_uastc.h>
+
+// Native ASTC output. The blocks are packed as UASTC, which is a subset of ASTC, and then converted to ASTC
+// without loss. This is what the runtime would otherwise do on every load of a CT_BASIS_UASTC texture.
+// Everything but the encoding step is shared with the default encoder.
+
+namespace dmTexc
+{
+    static const uint32_t ASTC_BLOCK_SIZE = 16; // bytes per block, for all block dimensions
+
+    // The block dimensions of the pixel format. Only the 4x4 blocks can be packed from UASTC.
+    static bool GetASTCBlockDimensions(PixelFormat pixel_format, uint32_t* block_width, uint32_t* block_height)
+    {
+        switch(pixel_format)
+        {
+            case PF_RGBA_ASTC_4x4:  *block_width = 4; *block_height = 4; return true;
+            default:                return false;
+        }
+    }
+
+    static uint32_t GetUASTCFlags(CompressionLevel compression_level)
+    {
+        // Only the ASTC error matters, as the blocks are never transcoded to BC7
+        uint32_t flags = basisu::cPackUASTCFavorUASTCError;
+        switch(compression_level)
+        {
+            case CL_FAST:   return flags | basisu::cPackUASTCLevelFastest;
+            case CL_NORMAL: return flags | basisu::cPackUASTCLevelFaster;
+            case CL_HIGH:   return flags | basisu::cPackUASTCLevelDefault;
+            case CL_BEST:   return flags | basisu::cPackUASTCLevelSlower;
+            default:        return flags | basisu::cPackUASTCLevelDefault;
+        }
+    }
+
+    struct EncodeJob
+    {
+        const uint8_t* m_Image;     // RGBA8888
+        uint8_t*       m_Output;
+        uint32_t       m_Width;
+        uint32_t       m_Height;
+        uint32_t       m_BlocksX;
+        uint32_t       m_Flags;
+    };
+
+    static void EncodeBlockRows(const EncodeJob* job, uint32_t first_row, uint32_t last_row)
+    {
+        uint8_t pixels[4*4*4];
+        for (uint32_t by = first_row; by < last_row; ++by)
+        {
+            for (uint32_t bx = 0; bx < job->m_BlocksX; ++bx)
+            {
+                // The edge pixels are repeated in the blocks that are partially outside the image
+                for (uint32_t y = 0; y < 4; ++y)
+                {
+                    uint32_t sy = dmMath::Min(by * 4 + y, job->m_Height - 1);
+                    for (uint32_t x = 0; x < 4; ++x)
+                    {
+                        uint32_t sx = dmMath::Min(bx * 4 + x, job->m_Width - 1);
+                        memcpy(&pixels[(y * 4 + x) * 4], &job->m_Image[(sy * job->m_Width + sx) * 4], 4);
+                    }
+                }
+
+                basist::uastc_block block;
+                basisu::encode_uastc(pixels, block, job->m_Flags);
+                basist::transcode_uastc_to_astc(block, &job->m_Output[(by * job->m_BlocksX + bx) * ASTC_BLOCK_SIZE]);
+            }
+        }
+    }
+
+    static void EncodeImageASTC(const EncodeJob* job, uint32_t blocks_y, uint32_t num_threads)
+    {
+        num_threads = dmMath::Min(num_threads, blocks_y);
+        if (num_threads <= 1)
+        {
+            EncodeBlockRows(job, 0, blocks_y);
+            return;
+        }
+
+        // Each thread takes a band of block rows, the calling thread takes the first one
+        uint32_t rows_per_thread = (blocks_y + num_threads - 1) / num_threads;
+        std::thread* threads = new std::thread[num_threads - 1];
+        for (uint32_t i = 1; i < num_threads; ++i)
+        {
+            uint32_t row_begin = dmMath::Min(blocks_y, i * rows_per_thread);
+            uint32_t row_end = dmMath::Min(blocks_y, row_begin + rows_per_thread);
+            threads[i - 1] = std::thread(EncodeBlockRows, job, row_begin, row_end);
+        }
+        EncodeBlockRows(job, 0, dmMath::Min(blocks_y, rows_per_thread));
+        for (uint32_t i = 0; i < num_threads - 1; ++i)
+        {
+            threads[i].join();
+        }
+        delete[] threads;
+    }
+
+    static bool EncodeASTC(Texture* texture, int num_threads, PixelFormat pixel_format, CompressionType compression_type, CompressionLevel compression_level)
+    {
+        (void)compression_type;
+
+        uint32_t block_width, block_height;
+        if (!GetASTCBlockDimensions(pixel_format, &block_width, &block_height))
+        {
+            dmLogError("Unsupported ASTC pixel format: %d", (int)pixel_format);
+            return false;
+        }
+
+        static int first = 1;
+        if (first)
+        {
+            basisu::basisu_encoder_init();
+            first = 0;
+        }
+
+        EncodeJob job;
+        job.m_Flags = GetUASTCFlags(compression_level);
+
+        for (uint32_t i = 0; i < texture->m_Mips.Size(); ++i)
+        {
+            TextureData* mip_level = &texture->m_Mips[i];
+            uint32_t blocks_x = (mip_level->m_Width + block_width - 1) / block_width;
+            uint32_t blocks_y = (mip_level->m_Height + block_height - 1) / block_height;
+            uint32_t size = blocks_x * blocks_y * ASTC_BLOCK_SIZE;
+            uint8_t* packed_data = new uint8_t[size];
+
+            job.m_Image   = mip_level->m_Data;
+            job.m_Output  = packed_data;
+            job.m_Width   = mip_level->m_Width;
+            job.m_Height  = mip_level->m_Height;
+            job.m_BlocksX = blocks_x;
+            EncodeImageASTC(&job, blocks_y, (uint32_t)dmMath::Max(1, num_threads));
+
+            delete[] mip_level->m_Data;
+            mip_level->m_Data = packed_data;
+            mip_level->m_ByteSize = size;
+            mip_level->m_IsCompressed = true;
+        }
+
+        texture->m_PixelFormat = pixel_format;
+        return true;
+    }
+
+    void GetEncoderASTC(Encoder* encoder)
+    {
+        GetEncoderDefault(encoder);
+        encoder->m_FnEncode = EncodeASTC;
+    }
+}
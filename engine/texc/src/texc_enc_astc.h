@@ -0,0 +1,25 @@
+
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+#ifndef DM_TEXC_ENCODER_ASTC_H
+#define DM_TEXC_ENCODER_ASTC_H
+
+#include "texc_private.h"
+
+namespace dmTexc
+{
+    void GetEncoderASTC(Encoder* encoder);
+}
+
+#endif // DM_TEXC_ENCODER_ASTC_H
@@ -117,6 +117,7 @@ namespace dmTexc
         comp_params.m_multithreading = num_threads > 1;
         comp_params.m_uastc = compression_type == CT_BASIS_UASTC;
         comp_params.m_mip_gen = texture->m_BasisGenMipmaps;
+        comp_params.m_mip_srgb = texture->m_ColorSpace == CS_SRGB;
 
         comp_params.m_status_output = false;
         comp_params.m_debug = false;
@@ -242,16 +243,20 @@ namespace dmTexc
         (void)texture;
     }
 
-    bool GenMipMapsBasis(Texture* texture)
+    bool GenMipMapsBasis(Texture* texture, CompressionLevel quality, uint32_t num_threads)
     {
+        // The mip maps are generated by the basis compressor, on the threads given to Encode
+        (void)quality;
+        (void)num_threads;
         texture->m_BasisGenMipmaps = true;
         return true; // we're actually delaying it until later
     }
 
-    bool ResizeBasis(Texture* texture, uint32_t width, uint32_t height)
+    bool ResizeBasis(Texture* texture, uint32_t width, uint32_t height, uint32_t num_threads)
     {
         basisu::image tmp(width, height);
-        basisu::image_resample(texture->m_BasisImage, tmp);
+        ResampleRGBA8888((const uint8_t*)texture->m_BasisImage.get_ptr(), texture->m_Width, texture->m_Height,
+                         (uint8_t*)tmp.get_ptr(), width, height, texture->m_ColorSpace == CS_SRGB, num_threads);
         texture->m_BasisImage.swap(tmp);
         texture->m_Width = width;
         texture->m_Height = height;
@@ -102,46 +102,12 @@ namespace dmTexc
         }
     }
 
-    static uint8_t* GenMipMapDefault(Texture* texture, int miplevel, const basisu::image& origimage, uint32_t mip_width, uint32_t mip_height, ColorSpace color_space)
-    {
-        (void)texture;
-        (void)miplevel;
-        uint32_t num_channels = 4;
-        uint32_t size = mip_width * mip_height * num_channels;
-        uint8_t* mip_data = new uint8_t[mip_width * mip_height * num_channels];
-
-        basisu::image mipimage(mip_width, mip_height);
-
-        bool srgb = false;
-        const char* filter = "tent";
-        basisu::image_resample(origimage, mipimage, srgb, filter);
-
-        basisu::color_rgba* basisimage = mipimage.get_ptr();
-        memcpy(mip_data, basisimage, size);
-
-        // char name[256];
-        // stbi_flip_vertically_on_write(true);
-        // dmSnPrintf(name, sizeof(name), "/Users/mawe/work/projects/users/mawe/TextureCompression/mipmaps/%s_mip%02d_%s.png", texture->m_Name?texture->m_Name:"unknown", miplevel, filter);
-        // int result = stbi_write_png(name, mip_width, mip_height, 4, (void*)mip_data, mip_width*4);
-
-        // stbi_flip_vertically_on_write(false);
-        // printf("Wrote %s\n", name);
-
-        return mip_data;
-    }
-
-    static bool GenMipMapsDefault(Texture* texture)
+    static bool GenMipMapsDefault(Texture* texture, CompressionLevel quality, uint32_t num_threads)
     {
         uint32_t width = texture->m_Width;
         uint32_t height = texture->m_Height;
+        bool srgb = texture->m_ColorSpace == CS_SRGB;
 
-        // We make a straight unaltered copy of the input data as the first mip level
-        uint8_t* mip0 = texture->m_Mips[0].m_Data;
-
-        basisu::image origimage;
-        origimage.init(mip0, width, height, 4);
-
-        int level = 0;
         while (width * height != 1)
         {
             width /= 2;
@@ -149,35 +115,32 @@ namespace dmTexc
             width = dmMath::Max(1U, width);
             height = dmMath::Max(1U, height);
 
-            uint8_t* mipmap = GenMipMapDefault(texture, level, origimage, width, height, texture->m_ColorSpace);
-            level++;
+            // The fast preset filters each level from the previous one, the others from the base image
+            TextureData src = quality == CL_FAST ? texture->m_Mips.Back() : texture->m_Mips[0];
+
+            uint32_t size = width * height * 4;
+            uint8_t* mipmap = new uint8_t[size];
+            ResampleRGBA8888(src.m_Data, src.m_Width, src.m_Height, mipmap, width, height, srgb, num_threads);
 
             TextureData mip_level;
             mip_level.m_Width = width;
             mip_level.m_Height = height;
             mip_level.m_Data = mipmap;
-            mip_level.m_ByteSize = width * height * 4;
+            mip_level.m_ByteSize = size;
             mip_level.m_IsCompressed = false;
             texture->m_Mips.Push(mip_level);
         }
         return true;
     }
 
-    static bool ResizeDefault(Texture* texture, uint32_t width, uint32_t height)
+    static bool ResizeDefault(Texture* texture, uint32_t width, uint32_t height, uint32_t num_threads)
     {
         uint32_t num_channels = 4;
         uint32_t new_size = width * height * num_channels;
         uint8_t* new_data = new uint8_t[new_size];
         uint8_t* mip0 = texture->m_Mips[0].m_Data;
 
-        basisu::image origimage;
-        origimage.init(mip0, texture->m_Width, texture->m_Height, num_channels);
-
-        basisu::image mipimage(width, height);
-        basisu::image_resample(origimage, mipimage);
-
-        basisu::color_rgba* basisimage = mipimage.get_ptr();
-        memcpy(new_data, basisimage, new_size);
+        ResampleRGBA8888(mip0, texture->m_Width, texture->m_Height, new_data, width, height, texture->m_ColorSpace == CS_SRGB, num_threads);
 
         delete[] texture->m_Mips[0].m_Data;
         texture->m_Mips[0].m_Data = new_data;
@@ -35,8 +35,8 @@ namespace dmTexc
     {
         bool     (*m_FnCreate)(Texture* texture, uint32_t width, uint32_t height, PixelFormat pixel_format, ColorSpace color_space, CompressionType compression_type, void* data);
         void     (*m_FnDestroy)(Texture* texture);
-        bool     (*m_FnGenMipMaps)(Texture* texture);
-        bool     (*m_FnResize)(Texture* texture, uint32_t width, uint32_t height);
+        bool     (*m_FnGenMipMaps)(Texture* texture, CompressionLevel quality, uint32_t num_threads);
+        bool     (*m_FnResize)(Texture* texture, uint32_t width, uint32_t height, uint32_t num_threads);
         bool     (*m_FnEncode)(Texture* texture, int num_threads, PixelFormat pixel_format, CompressionType compression_type, CompressionLevel compression_level);
         uint32_t (*m_FnGetTotalDataSize)(Texture* texture);
         uint32_t (*m_FnGetData)(Texture* texture, void* out_data, uint32_t out_data_size);
@@ -101,6 +101,19 @@ namespace dmTexc
     void        DitherRGBx565(uint8_t* data, uint32_t width, uint32_t height);
 
     void        DebugPrint(uint8_t* p, uint32_t width, uint32_t height, uint32_t num_channels);
+
+    // The encode cache, see SetCacheDirectory.
+    // The key covers the pixels as they are right before the encode, and the encode settings
+    bool        IsCacheEnabled();
+    uint64_t    CalcCacheKey(Texture* texture, PixelFormat pixel_format, ColorSpace color_space, CompressionType compression_type, CompressionLevel compression_level);
+    // On a hit, the texture is put in the same state as after an encode
+    bool        ReadCache(Texture* texture, uint64_t key);
+    void        WriteCache(Texture* texture, uint64_t key);
+
+    // Resamples an RGBA8888 image with a tent filter. If srgb is set, the color is filtered in linear space.
+    // The destination rows are split in bands over up to num_threads threads
+    void        ResampleRGBA8888(const uint8_t* src, uint32_t src_width, uint32_t src_height,
+                                 uint8_t* dst, uint32_t dst_width, uint32_t dst_height, bool srgb, uint32_t num_threads);
 }
 
 #endif // DM_TEXC_PRIVATE_H
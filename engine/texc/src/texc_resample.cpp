@@ -0,0 +1,290 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <math.h>
+#include <string.h>
+#include <thread>
+
+#include <dlib/array.h>
+#include <dlib/math.h>
+
+#include "texc.h"
+#include "texc_private.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define DM_TEXC_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+    #define DM_TEXC_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace dmTexc
+{
+    // One RGBA pixel per vector
+#if defined(DM_TEXC_SSE2)
+    typedef __m128 Vec4f;
+    static inline Vec4f Load(const float* p)                    { return _mm_loadu_ps(p); }
+    static inline void  Store(float* p, Vec4f v)                { _mm_storeu_ps(p, v); }
+    static inline Vec4f Splat(float f)                          { return _mm_set1_ps(f); }
+    static inline Vec4f Set(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)                   { return _mm_add_ps(a, b); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)                   { return _mm_mul_ps(a, b); }
+    static inline Vec4f Min(Vec4f a, Vec4f b)                   { return _mm_min_ps(a, b); }
+    static inline Vec4f Max(Vec4f a, Vec4f b)                   { return _mm_max_ps(a, b); }
+#elif defined(DM_TEXC_NEON)
+    typedef float32x4_t Vec4f;
+    static inline Vec4f Load(const float* p)                    { return vld1q_f32(p); }
+    static inline void  Store(float* p, Vec4f v)                { vst1q_f32(p, v); }
+    static inline Vec4f Splat(float f)                          { return vdupq_n_f32(f); }
+    static inline Vec4f Set(float a, float b, float c, float d) { float v[4] = {a, b, c, d}; return vld1q_f32(v); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)                   { return vaddq_f32(a, b); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)                   { return vmulq_f32(a, b); }
+    static inline Vec4f Min(Vec4f a, Vec4f b)                   { return vminq_f32(a, b); }
+    static inline Vec4f Max(Vec4f a, Vec4f b)                   { return vmaxq_f32(a, b); }
+#else
+    struct Vec4f { float v[4]; };
+    static inline Vec4f Load(const float* p)                    { Vec4f r; for (int i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+    static inline void  Store(float* p, Vec4f v)                { for (int i = 0; i < 4; ++i) p[i] = v.v[i]; }
+    static inline Vec4f Splat(float f)                          { Vec4f r; for (int i = 0; i < 4; ++i) r.v[i] = f; return r; }
+    static inline Vec4f Set(float a, float b, float c, float d) { Vec4f r = {{a, b, c, d}}; return r; }
+    static inline Vec4f Add(Vec4f a, Vec4f b)                   { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)                   { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+    static inline Vec4f Min(Vec4f a, Vec4f b)                   { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+    static inline Vec4f Max(Vec4f a, Vec4f b)                   { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return a; }
+#endif
+
+    // Small enough to stay in cache, large enough for the sRGB -> linear -> sRGB round trip to be exact
+    static const uint32_t LINEAR_TO_SRGB_TABLE_SIZE = 1 << 14;
+
+    // Below this, a band of rows isn't worth a thread
+    static const uint32_t MIN_ROWS_PER_THREAD = 16;
+
+    struct ConversionTables
+    {
+        ConversionTables()
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                float v = i / 255.0f;
+                m_Unorm[i] = v;
+                m_SrgbToLinear[i] = v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+            }
+            for (uint32_t i = 0; i < LINEAR_TO_SRGB_TABLE_SIZE; ++i)
+            {
+                float v = i / (float)(LINEAR_TO_SRGB_TABLE_SIZE - 1);
+                float s = v <= 0.0031308f ? v * 12.92f : 1.055f * powf(v, 1.0f / 2.4f) - 0.055f;
+                m_LinearToSrgb[i] = (uint8_t)(dmMath::Clamp(s, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        }
+
+        float   m_Unorm[256];
+        float   m_SrgbToLinear[256];
+        uint8_t m_LinearToSrgb[LINEAR_TO_SRGB_TABLE_SIZE];
+    };
+
+    static const ConversionTables& GetConversionTables()
+    {
+        static ConversionTables tables;
+        return tables;
+    }
+
+    // The source pixels and weights contributing to one destination pixel
+    struct FilterSpan
+    {
+        uint32_t m_First;
+        uint32_t m_Count;
+        uint32_t m_WeightOffset;
+    };
+
+    struct Filter
+    {
+        dmArray<FilterSpan> m_Spans;
+        dmArray<float>      m_Weights;
+    };
+
+    // A tent filter. When minifying, the tent is widened to cover all source pixels of a destination pixel.
+    // The weights are renormalized at the edges.
+    static void CalcTentFilter(uint32_t src_size, uint32_t dst_size, Filter* filter)
+    {
+        float scale = (float)dst_size / (float)src_size;
+        float radius = scale < 1.0f ? 1.0f / scale : 1.0f;
+        uint32_t max_taps = (uint32_t)ceilf(radius * 2.0f) + 1;
+
+        filter->m_Spans.SetCapacity(dst_size);
+        filter->m_Spans.SetSize(dst_size);
+        filter->m_Weights.SetCapacity(dst_size * max_taps);
+        filter->m_Weights.SetSize(0);
+
+        for (uint32_t i = 0; i < dst_size; ++i)
+        {
+            float center = ((float)i + 0.5f) / scale - 0.5f;
+            int32_t first = dmMath::Max(0, (int32_t)ceilf(center - radius));
+            int32_t last = dmMath::Min((int32_t)src_size - 1, (int32_t)floorf(center + radius));
+
+            FilterSpan& span = filter->m_Spans[i];
+            span.m_First = (uint32_t)first;
+            span.m_Count = (uint32_t)(last - first + 1);
+            span.m_WeightOffset = filter->m_Weights.Size();
+
+            float total = 0.0f;
+            for (int32_t j = first; j <= last; ++j)
+            {
+                float w = 1.0f - fabsf((float)j - center) / radius;
+                w = dmMath::Max(0.0f, w);
+                filter->m_Weights.Push(w);
+                total += w;
+            }
+
+            float* weights = &filter->m_Weights[span.m_WeightOffset];
+            if (total > 0.0f)
+            {
+                for (uint32_t j = 0; j < span.m_Count; ++j)
+                    weights[j] /= total;
+            }
+            else
+            {
+                weights[0] = 1.0f;
+            }
+        }
+    }
+
+    struct ResampleContext
+    {
+        const uint8_t*  m_Src;
+        uint8_t*        m_Dst;
+        uint32_t        m_SrcWidth;
+        uint32_t        m_DstWidth;
+        const Filter*   m_FilterX;
+        const Filter*   m_FilterY;
+        const float*    m_ColorToLinear;
+        const ConversionTables* m_Tables;
+        bool            m_Srgb;
+    };
+
+    static inline Vec4f ToLinear(const ResampleContext* ctx, const uint8_t* p)
+    {
+        const float* color = ctx->m_ColorToLinear;
+        return Set(color[p[0]], color[p[1]], color[p[2]], ctx->m_Tables->m_Unorm[p[3]]);
+    }
+
+    static inline void FromLinear(const ResampleContext* ctx, Vec4f v, uint8_t* out)
+    {
+        float f[4];
+        Store(f, Min(Max(v, Splat(0.0f)), Splat(1.0f)));
+        if (ctx->m_Srgb)
+        {
+            const uint8_t* table = ctx->m_Tables->m_LinearToSrgb;
+            out[0] = table[(uint32_t)(f[0] * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f)];
+            out[1] = table[(uint32_t)(f[1] * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f)];
+            out[2] = table[(uint32_t)(f[2] * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f)];
+        }
+        else
+        {
+            out[0] = (uint8_t)(f[0] * 255.0f + 0.5f);
+            out[1] = (uint8_t)(f[1] * 255.0f + 0.5f);
+            out[2] = (uint8_t)(f[2] * 255.0f + 0.5f);
+        }
+        out[3] = (uint8_t)(f[3] * 255.0f + 0.5f);
+    }
+
+    // Filters each destination row vertically into a linear source-width row, and then that row horizontally
+    static void ResampleRows(const ResampleContext* ctx, uint32_t row_begin, uint32_t row_end)
+    {
+        uint32_t src_width = ctx->m_SrcWidth;
+        uint32_t dst_width = ctx->m_DstWidth;
+        float* row = new float[src_width * 4];
+
+        for (uint32_t y = row_begin; y < row_end; ++y)
+        {
+            const FilterSpan& span_y = ctx->m_FilterY->m_Spans[y];
+            const float* weights_y = &ctx->m_FilterY->m_Weights[span_y.m_WeightOffset];
+
+            memset(row, 0, src_width * 4 * sizeof(float));
+            for (uint32_t k = 0; k < span_y.m_Count; ++k)
+            {
+                const uint8_t* src_row = ctx->m_Src + (span_y.m_First + k) * src_width * 4;
+                Vec4f w = Splat(weights_y[k]);
+                for (uint32_t x = 0; x < src_width; ++x)
+                {
+                    float* p = row + x * 4;
+                    Store(p, Add(Load(p), Mul(ToLinear(ctx, src_row + x * 4), w)));
+                }
+            }
+
+            uint8_t* dst_row = ctx->m_Dst + y * dst_width * 4;
+            for (uint32_t x = 0; x < dst_width; ++x)
+            {
+                const FilterSpan& span_x = ctx->m_FilterX->m_Spans[x];
+                const float* weights_x = &ctx->m_FilterX->m_Weights[span_x.m_WeightOffset];
+                const float* p = row + span_x.m_First * 4;
+
+                Vec4f acc = Splat(0.0f);
+                for (uint32_t k = 0; k < span_x.m_Count; ++k)
+                {
+                    acc = Add(acc, Mul(Load(p + k * 4), Splat(weights_x[k])));
+                }
+                FromLinear(ctx, acc, dst_row + x * 4);
+            }
+        }
+
+        delete[] row;
+    }
+
+    void ResampleRGBA8888(const uint8_t* src, uint32_t src_width, uint32_t src_height,
+                          uint8_t* dst, uint32_t dst_width, uint32_t dst_height, bool srgb, uint32_t num_threads)
+    {
+        Filter filter_x;
+        Filter filter_y;
+        CalcTentFilter(src_width, dst_width, &filter_x);
+        CalcTentFilter(src_height, dst_height, &filter_y);
+
+        // Created before any threads are started
+        const ConversionTables& tables = GetConversionTables();
+
+        ResampleContext ctx;
+        ctx.m_Src = src;
+        ctx.m_Dst = dst;
+        ctx.m_SrcWidth = src_width;
+        ctx.m_DstWidth = dst_width;
+        ctx.m_FilterX = &filter_x;
+        ctx.m_FilterY = &filter_y;
+        ctx.m_ColorToLinear = srgb ? tables.m_SrgbToLinear : tables.m_Unorm;
+        ctx.m_Tables = &tables;
+        ctx.m_Srgb = srgb;
+
+        num_threads = dmMath::Min(num_threads, dst_height / MIN_ROWS_PER_THREAD);
+        if (num_threads <= 1)
+        {
+            ResampleRows(&ctx, 0, dst_height);
+            return;
+        }
+
+        // Each thread takes a band of rows, the calling thread takes the first one
+        uint32_t rows_per_thread = (dst_height + num_threads - 1) / num_threads;
+        std::thread* threads = new std::thread[num_threads - 1];
+        for (uint32_t i = 1; i < num_threads; ++i)
+        {
+            uint32_t row_begin = dmMath::Min(dst_height, i * rows_per_thread);
+            uint32_t row_end = dmMath::Min(dst_height, row_begin + rows_per_thread);
+            threads[i - 1] = std::thread(ResampleRows, &ctx, row_begin, row_end);
+        }
+        ResampleRows(&ctx, 0, dmMath::Min(dst_height, rows_per_thread));
+        for (uint32_t i = 0; i < num_threads - 1; ++i)
+        {
+            threads[i].join();
+        }
+        delete[] threads;
+    }
+}